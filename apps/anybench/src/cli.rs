@@ -0,0 +1,279 @@
+//! Headless command-line mode: repeated runs with JSON statistics.
+//!
+//! `anybench --json [options] [tests...]` runs each selected test `W`
+//! warm-up times (discarded) and then `N` measured times, and prints one
+//! JSON object with the median, p95, standard deviation, min and max of
+//! the per-second rate of every test.  No window is opened.
+//!
+//! Options: `--iterations N` (default 5), `--warmup W` (default 1),
+//! `--ms T` (per-run duration, default per group), `--size WxH` (GL
+//! render size, default 640x480).  Tests are given by name
+//! (`gl.fill.math`), by group prefix (`cpu`, `gl3d`, `gl`, `gl.texture`)
+//! or as `all` (the default).
+//!
+//! System tests cover the kernel (`sys.syscall`, `sys.ctxswitch`, reported
+//! in nanoseconds per operation), IPC (`ipc.pipe`, `ipc.evbus`, `ipc.shm`),
+//! file I/O per filesystem driver (`fs.<driver>.seqwrite|seqread|
+//! randwrite|randread`) and loopback TCP (`net.tcp.stream`,
+//! `net.tcp.connect`).
+//!
+//! GPU (2D canvas) and multi-core CPU tests need the window and stay
+//! GUI-only.
+
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::workloads::{
+    self, GlTarget,
+    CPU_TEST_MS, GL3D_TEST_MS, SYS_TEST_MS,
+    NUM_CPU_TESTS, NUM_GL3D_TESTS,
+    FILL_SHADERS, TEXTURE_FILTERS, VERTEX_ATTRIBS,
+    LATENCY_TESTS, IPC_TESTS, FS_TESTS, NET_TESTS,
+};
+
+const DEFAULT_ITERATIONS: u32 = 5;
+const DEFAULT_WARMUP: u32 = 1;
+const DEFAULT_SIZE: (u32, u32) = (640, 480);
+
+/// Dotted names of the CPU tests, same order as `CPU_TEST_NAMES`.
+const CPU_IDS: [&str; NUM_CPU_TESTS] = [
+    "integer", "float", "memory", "matrix", "crypto", "sort",
+];
+/// Dotted names of the 3D tests, same order as `GL3D_TEST_NAMES`.
+const GL3D_IDS: [&str; NUM_GL3D_TESTS] = [
+    "triangles", "textured", "lighting", "depth", "drawcalls",
+];
+
+#[derive(Clone, Copy)]
+enum Kind {
+    Cpu(u32),
+    Gl3d(usize),
+    Fill(usize),
+    Texture(usize),
+    Vertex(usize),
+    Latency(usize),
+    Ipc(usize),
+    /// Index into the mount list, test index.
+    Fs(usize, usize),
+    Net(usize),
+}
+
+struct Test {
+    name: String,
+    unit: &'static str,
+    kind: Kind,
+    default_ms: u32,
+}
+
+/// Unit of latency tests: their operation counts are reported inverted.
+const LATENCY_UNIT: &str = "ns/op";
+
+fn all_tests(mounts: &[(String, String)]) -> Vec<Test> {
+    let mut tests = Vec::new();
+    for (i, id) in CPU_IDS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("cpu.{}", id), unit: "ops/s",
+            kind: Kind::Cpu(i as u32 + 1), default_ms: CPU_TEST_MS,
+        });
+    }
+    for (i, id) in GL3D_IDS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("gl3d.{}", id), unit: "ops/s",
+            kind: Kind::Gl3d(i), default_ms: GL3D_TEST_MS,
+        });
+    }
+    for (i, id) in FILL_SHADERS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("gl.fill.{}", id), unit: "pixels/s",
+            kind: Kind::Fill(i), default_ms: GL3D_TEST_MS,
+        });
+    }
+    for (i, id) in TEXTURE_FILTERS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("gl.texture.{}", id), unit: "samples/s",
+            kind: Kind::Texture(i), default_ms: GL3D_TEST_MS,
+        });
+    }
+    for (i, n) in VERTEX_ATTRIBS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("gl.vertex.{}", n), unit: "vertices/s",
+            kind: Kind::Vertex(i), default_ms: GL3D_TEST_MS,
+        });
+    }
+    for (i, id) in LATENCY_TESTS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("sys.{}", id), unit: LATENCY_UNIT,
+            kind: Kind::Latency(i), default_ms: SYS_TEST_MS,
+        });
+    }
+    for (i, id) in IPC_TESTS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("ipc.{}", id), unit: if *id == "evbus" { "events/s" } else { "bytes/s" },
+            kind: Kind::Ipc(i), default_ms: SYS_TEST_MS,
+        });
+    }
+    for (m, (driver, _)) in mounts.iter().enumerate() {
+        for (i, id) in FS_TESTS.iter().enumerate() {
+            tests.push(Test {
+                name: format!("fs.{}.{}", driver, id),
+                unit: if id.starts_with("seq") { "bytes/s" } else { "ops/s" },
+                kind: Kind::Fs(m, i), default_ms: SYS_TEST_MS,
+            });
+        }
+    }
+    for (i, id) in NET_TESTS.iter().enumerate() {
+        tests.push(Test {
+            name: format!("net.tcp.{}", id), unit: if *id == "stream" { "bytes/s" } else { "connections/s" },
+            kind: Kind::Net(i), default_ms: SYS_TEST_MS,
+        });
+    }
+    tests
+}
+
+/// Whether `sel` names `name` exactly or is one of its dotted prefixes.
+fn selects(sel: &str, name: &str) -> bool {
+    sel == "all"
+        || name == sel
+        || (name.starts_with(sel) && name.as_bytes().get(sel.len()) == Some(&b'.'))
+}
+
+fn run_once(test: &Test, target: &GlTarget, mounts: &[(String, String)]) -> u64 {
+    match test.kind {
+        Kind::Cpu(id) => workloads::run_cpu_bench(id),
+        Kind::Gl3d(i) => workloads::run_gl3d_test(i, target),
+        Kind::Fill(i) => workloads::bench_gl_fill(target, i),
+        Kind::Texture(i) => workloads::bench_gl_texture(target, i),
+        Kind::Vertex(i) => workloads::bench_gl_vertex(target, i),
+        Kind::Latency(i) => workloads::bench_sys_latency(i),
+        Kind::Ipc(i) => workloads::bench_sys_ipc(i),
+        Kind::Fs(m, i) => workloads::bench_sys_fs(&mounts[m].1, i),
+        Kind::Net(i) => workloads::bench_sys_net(i),
+    }
+}
+
+/// Whether the argument string asks for CLI mode.
+pub fn requested(args: &str) -> bool {
+    args.split_ascii_whitespace().any(|a| a == "--json")
+}
+
+/// Parse `args`, run the selected tests and print the JSON report.
+pub fn run(args: &str) {
+    let mut iterations = DEFAULT_ITERATIONS;
+    let mut warmup = DEFAULT_WARMUP;
+    let mut ms = 0u32;
+    let (mut w, mut h) = DEFAULT_SIZE;
+    let mut selectors: Vec<&str> = Vec::new();
+
+    let mut it = args.split_ascii_whitespace();
+    while let Some(arg) = it.next() {
+        match arg {
+            "--json" => {}
+            "--iterations" => iterations = parse_u32(it.next()).unwrap_or(iterations).max(1),
+            "--warmup" => warmup = parse_u32(it.next()).unwrap_or(warmup),
+            "--ms" => ms = parse_u32(it.next()).unwrap_or(0),
+            "--size" => {
+                if let Some((sw, sh)) = it.next().and_then(|s| s.split_once('x')) {
+                    if let (Some(sw), Some(sh)) = (parse_u32(Some(sw)), parse_u32(Some(sh))) {
+                        if sw > 0 && sh > 0 { w = sw; h = sh; }
+                    }
+                }
+            }
+            _ if arg.starts_with("--") => {
+                anyos_std::println!("anybench: unknown option {}", arg);
+                return;
+            }
+            _ => selectors.push(arg),
+        }
+    }
+    if selectors.is_empty() {
+        selectors.push("all");
+    }
+
+    let mounts = workloads::fs_mounts();
+    let tests: Vec<Test> = all_tests(&mounts)
+        .into_iter()
+        .filter(|t| selectors.iter().any(|s| selects(s, &t.name)))
+        .collect();
+    if tests.is_empty() {
+        anyos_std::println!("anybench: no test matches the selection");
+        return;
+    }
+
+    workloads::set_test_ms(ms);
+    let target = GlTarget::headless(w, h);
+    let mut results = String::new();
+    for (n, test) in tests.iter().enumerate() {
+        let duration = workloads::test_ms(test.default_ms);
+        for _ in 0..warmup {
+            run_once(test, &target, &mounts);
+        }
+        let mut rates: Vec<f64> = Vec::with_capacity(iterations as usize);
+        for _ in 0..iterations {
+            let raw = run_once(test, &target, &mounts);
+            rates.push(if test.unit == LATENCY_UNIT {
+                if raw == 0 { 0.0 } else { duration as f64 * 1_000_000.0 / raw as f64 }
+            } else {
+                raw as f64 * 1000.0 / duration as f64
+            });
+        }
+        if n > 0 {
+            results.push_str(",\n");
+        }
+        results.push_str(&format_result(test, &mut rates));
+    }
+    workloads::set_test_ms(0);
+    for (m, (_, path)) in mounts.iter().enumerate() {
+        if tests.iter().any(|t| matches!(t.kind, Kind::Fs(tm, _) if tm == m)) {
+            workloads::fs_cleanup(path);
+        }
+    }
+
+    anyos_std::println!(
+        "{{\n  \"version\": 1,\n  \"iterations\": {},\n  \"warmup\": {},\n  \"ms\": {},\n  \
+         \"size\": [{}, {}],\n  \"results\": [\n{}\n  ]\n}}",
+        iterations, warmup, ms, w, h, results,
+    );
+}
+
+fn parse_u32(s: Option<&str>) -> Option<u32> {
+    s?.parse().ok()
+}
+
+/// One `results[]` entry; sorts `rates` in place.
+fn format_result(test: &Test, rates: &mut [f64]) -> String {
+    rates.sort_unstable_by(|a, b| a.total_cmp(b));
+    let n = rates.len();
+    let median = if n % 2 == 1 {
+        rates[n / 2]
+    } else {
+        (rates[n / 2 - 1] + rates[n / 2]) / 2.0
+    };
+    // Nearest-rank percentile.
+    let p95 = rates[((n * 95 + 99) / 100).max(1) - 1];
+    let mean = rates.iter().sum::<f64>() / n as f64;
+    let var = rates.iter().map(|r| (r - mean) * (r - mean)).sum::<f64>() / n as f64;
+
+    let mut samples = String::new();
+    for (i, r) in rates.iter().enumerate() {
+        if i > 0 { samples.push_str(", "); }
+        samples.push_str(&format!("{:.1}", r));
+    }
+    format!(
+        "    {{\"name\": \"{}\", \"unit\": \"{}\", \"median\": {:.1}, \"p95\": {:.1}, \
+         \"stddev\": {:.1}, \"min\": {:.1}, \"max\": {:.1}, \"samples\": [{}]}}",
+        test.name, test.unit, median, p95, sqrt(var), rates[0], rates[n - 1], samples,
+    )
+}
+
+/// Square root by Newton's method (no libm in `no_std`).
+fn sqrt(x: f64) -> f64 {
+    if x <= 0.0 { return 0.0; }
+    let mut r = if x > 1.0 { x } else { 1.0 };
+    for _ in 0..64 {
+        let next = 0.5 * (r + x / r);
+        if next >= r { break; }
+        r = next;
+    }
+    r
+}
@@ -21,10 +21,18 @@
 //!   3. Phong Lighting      — Gouraud-shaded sphere rendering
 //!   4. Depth Testing       — Overdraw with depth buffer
 //!   5. Draw Calls          — Per-object draw call overhead
+//!
+//! `anybench --json` runs headless instead: selected single-core CPU, 3D
+//! and libgl microbenchmarks (fill rate per shader, texture bandwidth per
+//! filter, vertex throughput per attribute count) are repeated and
+//! reported as JSON statistics, together with system tests (syscall and
+//! context-switch latency, pipe/event-bus/shared-memory throughput, file
+//! I/O per filesystem driver, loopback TCP).  See [`cli`].
 
 #![no_std]
 #![no_main]
 
+mod cli;
 mod workloads;
 
 use alloc::format;
@@ -37,7 +45,7 @@ use workloads::{
     NUM_CPU_TESTS, NUM_GPU_TESTS, NUM_GL3D_TESTS,
     CPU_BASELINES, GPU_BASELINES, GL3D_BASELINES,
     CPU_TEST_NAMES, GPU_TEST_NAMES, GL3D_TEST_NAMES,
-    run_cpu_bench, run_gpu_test, run_gl3d_test,
+    run_cpu_bench, run_gpu_test, run_gl3d_test, GlTarget,
 };
 
 anyos_std::entry!(main);
@@ -929,7 +937,7 @@ fn tick_benchmark() {
                 BENCH_STATE.store(1, Ordering::SeqCst);
 
                 a.canvas_3d.clear(tc().editor_bg);
-                let result = run_gl3d_test(a.current_test, &a.canvas_3d);
+                let result = run_gl3d_test(a.current_test, &GlTarget::canvas(&a.canvas_3d));
                 a.gl3d_raw[a.current_test] = result;
                 let score = compute_score(result, GL3D_BASELINES[a.current_test]);
                 a.gl3d_scores[a.current_test].set_text(&format!("{}", score));
@@ -1100,6 +1108,13 @@ fn finish_benchmark() {
 // ════════════════════════════════════════════════════════════════════════
 
 fn main() {
+    let mut args_buf = [0u8; 256];
+    let args = anyos_std::process::args(&mut args_buf);
+    if cli::requested(args) {
+        cli::run(args);
+        return;
+    }
+
     if !anyui::init() {
         anyos_std::println!("anybench: failed to load libanyui.so");
         return;
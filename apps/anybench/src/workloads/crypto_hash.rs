@@ -3,7 +3,7 @@
 //! Simplified SHA-256-like Merkle-Damgård hash chain, repeated for
 //! [`CPU_TEST_MS`] milliseconds. Returns number of hash iterations.
 
-use super::CPU_TEST_MS;
+use super::{CPU_TEST_MS, test_ms};
 
 /// SHA-256-like compression function benchmark.
 pub fn bench_crypto_hash() -> u64 {
@@ -14,7 +14,7 @@ pub fn bench_crypto_hash() -> u64 {
 
     let mut iterations: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < CPU_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(CPU_TEST_MS) {
         let i = iterations;
         let mut a = hash[0];
         let mut b = hash[1];
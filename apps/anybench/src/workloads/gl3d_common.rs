@@ -42,11 +42,36 @@ pub fn ensure_gl_init(w: u32, h: u32) -> bool {
     true
 }
 
-/// Copies the current GL framebuffer to an anyui Canvas for preview.
-pub fn copy_gl_to_canvas(canvas: &anyui::Canvas, w: u32, h: u32) {
+/// Where a 3D benchmark renders: the framebuffer size, and the canvas that
+/// previews the last frame (none in command-line mode).
+#[derive(Clone, Copy)]
+pub struct GlTarget<'a> {
+    pub w: u32,
+    pub h: u32,
+    pub preview: Option<&'a anyui::Canvas>,
+}
+
+impl<'a> GlTarget<'a> {
+    /// Render at the canvas size and preview into it.
+    pub fn canvas(canvas: &'a anyui::Canvas) -> Self {
+        GlTarget { w: canvas.get_stride(), h: canvas.get_height(), preview: Some(canvas) }
+    }
+
+    /// Render offscreen only.
+    pub fn headless(w: u32, h: u32) -> Self {
+        GlTarget { w, h, preview: None }
+    }
+}
+
+/// Copies the current GL framebuffer to the target's canvas for preview.
+pub fn copy_gl_to_canvas(target: &GlTarget) {
+    let canvas = match target.preview {
+        Some(c) => c,
+        None => return,
+    };
     let fb_ptr = gl::swap_buffers();
     if !fb_ptr.is_null() {
-        let pixels = unsafe { core::slice::from_raw_parts(fb_ptr, (w * h) as usize) };
+        let pixels = unsafe { core::slice::from_raw_parts(fb_ptr, (target.w * target.h) as usize) };
         canvas.copy_pixels_from(pixels);
     }
 }
@@ -5,9 +5,8 @@
 //! per-draw-call overhead including uniform updates, buffer binding, and
 //! pipeline dispatch. Returns total draw calls executed.
 
-use libanyui_client as anyui;
 use libgl_client as gl;
-use super::GL3D_TEST_MS;
+use super::{GL3D_TEST_MS, test_ms};
 use super::gl3d_common::*;
 
 const NUM_OBJECTS: u32 = 50;
@@ -33,9 +32,8 @@ void main() {
 }";
 
 /// Draw-call overhead benchmark (many small objects with unique transforms).
-pub fn bench_gl3d_drawcalls(canvas: &anyui::Canvas) -> u64 {
-    let w = canvas.get_stride();
-    let h = canvas.get_height();
+pub fn bench_gl3d_drawcalls(target: &GlTarget) -> u64 {
+    let (w, h) = (target.w, target.h);
     if !ensure_gl_init(w, h) { return 0; }
 
     let (program, vs, fs) = match compile_program(VS_SRC, FS_SRC) {
@@ -79,7 +77,7 @@ pub fn bench_gl3d_drawcalls(canvas: &anyui::Canvas) -> u64 {
     let mut frame: u32 = 0;
     let mut count: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < GL3D_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
         let t = frame as f32 * 0.02;
         frame += 1;
 
@@ -124,7 +122,7 @@ pub fn bench_gl3d_drawcalls(canvas: &anyui::Canvas) -> u64 {
         gl::swap_buffers();
     }
 
-    copy_gl_to_canvas(canvas, w, h);
+    copy_gl_to_canvas(target);
     gl::delete_buffers(&vbo);
     gl::delete_buffers(&ebo);
     cleanup_program(program, vs, fs);
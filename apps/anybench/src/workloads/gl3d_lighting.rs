@@ -5,9 +5,8 @@
 //! computation, and the full rasterisation pipeline. Returns total lit
 //! triangles rendered.
 
-use libanyui_client as anyui;
 use libgl_client as gl;
-use super::GL3D_TEST_MS;
+use super::{GL3D_TEST_MS, test_ms};
 use super::gl3d_common::*;
 
 const VS_SRC: &str =
@@ -43,9 +42,8 @@ void main() {
 }";
 
 /// Phong lighting benchmark (Gouraud-shaded sphere).
-pub fn bench_gl3d_lighting(canvas: &anyui::Canvas) -> u64 {
-    let w = canvas.get_stride();
-    let h = canvas.get_height();
+pub fn bench_gl3d_lighting(target: &GlTarget) -> u64 {
+    let (w, h) = (target.w, target.h);
     if !ensure_gl_init(w, h) { return 0; }
 
     let (program, vs, fs) = match compile_program(VS_SRC, FS_SRC) {
@@ -93,7 +91,7 @@ pub fn bench_gl3d_lighting(canvas: &anyui::Canvas) -> u64 {
     let mut frame: u32 = 0;
     let mut count: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < GL3D_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
         let t = frame as f32 * 0.03;
         frame += 1;
 
@@ -119,7 +117,7 @@ pub fn bench_gl3d_lighting(canvas: &anyui::Canvas) -> u64 {
         count += tris_per_frame as u64;
     }
 
-    copy_gl_to_canvas(canvas, w, h);
+    copy_gl_to_canvas(target);
     gl::delete_buffers(&vbo);
     gl::delete_buffers(&ebo);
     cleanup_program(program, vs, fs);
@@ -6,9 +6,8 @@
 
 use alloc::vec;
 use alloc::vec::Vec;
-use libanyui_client as anyui;
 use libgl_client as gl;
-use super::GL3D_TEST_MS;
+use super::{GL3D_TEST_MS, test_ms};
 use super::gl3d_common::*;
 
 const NUM_QUADS: u32 = 200;
@@ -55,9 +54,8 @@ fn generate_checkerboard() -> Vec<u8> {
 }
 
 /// Textured quad throughput benchmark.
-pub fn bench_gl3d_textured(canvas: &anyui::Canvas) -> u64 {
-    let w = canvas.get_stride();
-    let h = canvas.get_height();
+pub fn bench_gl3d_textured(target: &GlTarget) -> u64 {
+    let (w, h) = (target.w, target.h);
     if !ensure_gl_init(w, h) { return 0; }
 
     let (program, vs, fs) = match compile_program(VS_SRC, FS_SRC) {
@@ -124,14 +122,14 @@ pub fn bench_gl3d_textured(canvas: &anyui::Canvas) -> u64 {
     let tris_per_frame = NUM_QUADS * 2;
     let mut count: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < GL3D_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
         gl::clear(gl::GL_COLOR_BUFFER_BIT | gl::GL_DEPTH_BUFFER_BIT);
         gl::draw_arrays(gl::GL_TRIANGLES, 0, vertex_count);
         gl::swap_buffers();
         count += tris_per_frame as u64;
     }
 
-    copy_gl_to_canvas(canvas, w, h);
+    copy_gl_to_canvas(target);
     gl::delete_buffers(&vbo);
     gl::delete_textures(&tex);
     cleanup_program(program, vs, fs);
@@ -5,9 +5,8 @@
 //! rasterisation speed. Returns total triangles rendered.
 
 use alloc::vec::Vec;
-use libanyui_client as anyui;
 use libgl_client as gl;
-use super::GL3D_TEST_MS;
+use super::{GL3D_TEST_MS, test_ms};
 use super::gl3d_common::*;
 
 const NUM_TRIANGLES: u32 = 500;
@@ -29,9 +28,8 @@ void main() {
 }";
 
 /// Triangle throughput benchmark (flat-colored triangles, no textures).
-pub fn bench_gl3d_triangles(canvas: &anyui::Canvas) -> u64 {
-    let w = canvas.get_stride();
-    let h = canvas.get_height();
+pub fn bench_gl3d_triangles(target: &GlTarget) -> u64 {
+    let (w, h) = (target.w, target.h);
     if !ensure_gl_init(w, h) { return 0; }
 
     let (program, vs, fs) = match compile_program(VS_SRC, FS_SRC) {
@@ -85,14 +83,14 @@ pub fn bench_gl3d_triangles(canvas: &anyui::Canvas) -> u64 {
     let vertex_count = (NUM_TRIANGLES * 3) as i32;
     let mut count: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < GL3D_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
         gl::clear(gl::GL_COLOR_BUFFER_BIT | gl::GL_DEPTH_BUFFER_BIT);
         gl::draw_arrays(gl::GL_TRIANGLES, 0, vertex_count);
         gl::swap_buffers();
         count += NUM_TRIANGLES as u64;
     }
 
-    copy_gl_to_canvas(canvas, w, h);
+    copy_gl_to_canvas(target);
     gl::delete_buffers(&vbo);
     cleanup_program(program, vs, fs);
     gl::enable(gl::GL_CULL_FACE);
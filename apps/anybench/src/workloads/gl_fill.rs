@@ -0,0 +1,113 @@
+//! 3D Microbenchmark — Fill rate per shader complexity.
+//!
+//! Draws [`LAYERS`] overlapping full-screen quads per frame with depth
+//! testing off, so every layer shades every pixel, for [`GL3D_TEST_MS`]
+//! milliseconds.  The fragment shader ranges from a uniform colour to a
+//! math-heavy one ([`FILL_SHADERS`]).  Returns total pixels shaded.
+
+use alloc::vec::Vec;
+use libgl_client as gl;
+use super::{GL3D_TEST_MS, test_ms};
+use super::gl3d_common::*;
+
+/// Full-screen layers drawn per frame.
+const LAYERS: u32 = 4;
+
+/// Fragment shader variants, in order of cost.
+pub const FILL_SHADERS: [&str; 3] = ["flat", "varying", "math"];
+
+const VS_SRC: &str =
+"attribute vec3 aPosition;
+attribute vec3 aColor;
+varying vec3 vColor;
+void main() {
+    vColor = aColor;
+    gl_Position = vec4(aPosition, 1.0);
+}";
+
+const FS_FLAT: &str =
+"varying vec3 vColor;
+uniform vec4 uColor;
+void main() {
+    gl_FragColor = uColor;
+}";
+
+const FS_VARYING: &str =
+"varying vec3 vColor;
+void main() {
+    gl_FragColor = vec4(vColor, 1.0);
+}";
+
+const FS_MATH: &str =
+"varying vec3 vColor;
+void main() {
+    vec3 n = normalize(vColor * 2.0 - 1.0);
+    float d = max(dot(n, vec3(0.577, 0.577, 0.577)), 0.0);
+    float s = pow(d, 16.0);
+    vec3 c = vColor * (0.2 + 0.8 * d) + vec3(s, s, s) + sin(vColor * 12.0) * 0.1;
+    gl_FragColor = vec4(clamp(c, 0.0, 1.0), 1.0);
+}";
+
+/// Fill-rate benchmark with fragment shader `FILL_SHADERS[shader]`.
+pub fn bench_gl_fill(target: &GlTarget, shader: usize) -> u64 {
+    let (w, h) = (target.w, target.h);
+    if !ensure_gl_init(w, h) { return 0; }
+
+    let fs_src = match shader {
+        0 => FS_FLAT,
+        1 => FS_VARYING,
+        _ => FS_MATH,
+    };
+    let (program, vs, fs) = match compile_program(VS_SRC, fs_src) {
+        Some(p) => p,
+        None => return 0,
+    };
+    gl::use_program(program);
+
+    // LAYERS full-screen quads: pos(3) + color(3), corners coloured apart
+    let corners: [[f32; 6]; 4] = [
+        [-1.0, -1.0, 0.0, 1.0, 0.2, 0.1],
+        [ 1.0, -1.0, 0.0, 0.1, 1.0, 0.2],
+        [ 1.0,  1.0, 0.0, 0.2, 0.1, 1.0],
+        [-1.0,  1.0, 0.0, 0.9, 0.9, 0.3],
+    ];
+    let mut verts: Vec<f32> = Vec::with_capacity((LAYERS * 6 * 6) as usize);
+    for _ in 0..LAYERS {
+        for &i in &[0usize, 1, 2, 0, 2, 3] {
+            verts.extend_from_slice(&corners[i]);
+        }
+    }
+
+    let mut vbo = [0u32; 1];
+    gl::gen_buffers(1, &mut vbo);
+    gl::bind_buffer(gl::GL_ARRAY_BUFFER, vbo[0]);
+    gl::buffer_data_f32(gl::GL_ARRAY_BUFFER, &verts, gl::GL_STATIC_DRAW);
+    setup_pos_color_attribs(program);
+
+    let loc_color = gl::get_uniform_location(program, "uColor");
+    if loc_color >= 0 {
+        gl::uniform4f(loc_color, 0.3, 0.6, 0.9, 1.0);
+    }
+
+    gl::disable(gl::GL_DEPTH_TEST);
+    gl::disable(gl::GL_CULL_FACE);
+    gl::clear_color(0.0, 0.0, 0.0, 1.0);
+
+    let vertex_count = (LAYERS * 6) as i32;
+    let pixels_per_frame = (w * h * LAYERS) as u64;
+    let mut count: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
+        gl::clear(gl::GL_COLOR_BUFFER_BIT);
+        gl::draw_arrays(gl::GL_TRIANGLES, 0, vertex_count);
+        gl::swap_buffers();
+        count += pixels_per_frame;
+    }
+
+    copy_gl_to_canvas(target);
+    gl::delete_buffers(&vbo);
+    cleanup_program(program, vs, fs);
+    gl::enable(gl::GL_DEPTH_TEST);
+    gl::enable(gl::GL_CULL_FACE);
+    count
+}
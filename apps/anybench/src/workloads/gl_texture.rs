@@ -0,0 +1,121 @@
+//! 3D Microbenchmark — Texture bandwidth per filter mode.
+//!
+//! Draws a full-screen quad sampling a mipmapped 256×256 noise texture,
+//! minified about 3× so every filter mode reads scattered texels, for
+//! [`GL3D_TEST_MS`] milliseconds.  Filter modes are [`TEXTURE_FILTERS`].
+//! Returns total texture samples (one per pixel).
+
+use alloc::vec;
+use alloc::vec::Vec;
+use libgl_client as gl;
+use super::{GL3D_TEST_MS, test_ms};
+use super::gl3d_common::*;
+
+const TEX_SIZE: i32 = 256;
+/// Texture repeats across the screen.
+const UV_SCALE: f32 = 8.0;
+
+/// Minification filters, in order of cost.
+pub const TEXTURE_FILTERS: [&str; 3] = ["nearest", "linear", "trilinear"];
+
+const VS_SRC: &str =
+"attribute vec3 aPosition;
+attribute vec2 aTexCoord;
+varying vec2 vTexCoord;
+void main() {
+    vTexCoord = aTexCoord;
+    gl_Position = vec4(aPosition, 1.0);
+}";
+
+const FS_SRC: &str =
+"varying vec2 vTexCoord;
+uniform sampler2D uTexture;
+void main() {
+    gl_FragColor = texture2D(uTexture, vTexCoord);
+}";
+
+/// Pseudo-random RGBA texels (no coherence for the caches to exploit).
+fn generate_noise() -> Vec<u8> {
+    let mut data = vec![0u8; (TEX_SIZE * TEX_SIZE * 4) as usize];
+    let mut seed: u32 = 1234;
+    for px in data.chunks_exact_mut(4) {
+        seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
+        px[0] = (seed >> 16) as u8;
+        px[1] = (seed >> 8) as u8;
+        px[2] = (seed >> 24) as u8;
+        px[3] = 255;
+    }
+    data
+}
+
+/// Texture sampling benchmark with minification filter `TEXTURE_FILTERS[filter]`.
+pub fn bench_gl_texture(target: &GlTarget, filter: usize) -> u64 {
+    let (w, h) = (target.w, target.h);
+    if !ensure_gl_init(w, h) { return 0; }
+
+    let (program, vs, fs) = match compile_program(VS_SRC, FS_SRC) {
+        Some(p) => p,
+        None => return 0,
+    };
+    gl::use_program(program);
+
+    // Full-screen quad: pos(3) + uv(2)
+    let s = UV_SCALE;
+    #[rustfmt::skip]
+    let verts: [f32; 30] = [
+        -1.0, -1.0, 0.0,  0.0, 0.0,
+         1.0, -1.0, 0.0,  s,   0.0,
+         1.0,  1.0, 0.0,  s,   s,
+        -1.0, -1.0, 0.0,  0.0, 0.0,
+         1.0,  1.0, 0.0,  s,   s,
+        -1.0,  1.0, 0.0,  0.0, s,
+    ];
+    let mut vbo = [0u32; 1];
+    gl::gen_buffers(1, &mut vbo);
+    gl::bind_buffer(gl::GL_ARRAY_BUFFER, vbo[0]);
+    gl::buffer_data_f32(gl::GL_ARRAY_BUFFER, &verts, gl::GL_STATIC_DRAW);
+    setup_pos_uv_attribs(program);
+
+    let (min_filter, mag_filter) = match filter {
+        0 => (gl::GL_NEAREST, gl::GL_NEAREST),
+        1 => (gl::GL_LINEAR, gl::GL_LINEAR),
+        _ => (gl::GL_LINEAR_MIPMAP_LINEAR, gl::GL_LINEAR),
+    };
+    let tex_data = generate_noise();
+    let mut tex = [0u32; 1];
+    gl::gen_textures(1, &mut tex);
+    gl::bind_texture(gl::GL_TEXTURE_2D, tex[0]);
+    gl::tex_image_2d(
+        gl::GL_TEXTURE_2D, 0, gl::GL_RGBA as i32, TEX_SIZE, TEX_SIZE, 0,
+        gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, &tex_data,
+    );
+    gl::generate_mipmap(gl::GL_TEXTURE_2D);
+    gl::tex_parameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, min_filter as i32);
+    gl::tex_parameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, mag_filter as i32);
+    gl::tex_parameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_REPEAT as i32);
+    gl::tex_parameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_REPEAT as i32);
+
+    let loc_tex = gl::get_uniform_location(program, "uTexture");
+    gl::active_texture(gl::GL_TEXTURE0);
+    gl::uniform1i(loc_tex, 0);
+
+    gl::disable(gl::GL_DEPTH_TEST);
+    gl::disable(gl::GL_CULL_FACE);
+
+    let samples_per_frame = (w * h) as u64;
+    let mut count: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
+        gl::draw_arrays(gl::GL_TRIANGLES, 0, 6);
+        gl::swap_buffers();
+        count += samples_per_frame;
+    }
+
+    copy_gl_to_canvas(target);
+    gl::delete_buffers(&vbo);
+    gl::delete_textures(&tex);
+    cleanup_program(program, vs, fs);
+    gl::enable(gl::GL_DEPTH_TEST);
+    gl::enable(gl::GL_CULL_FACE);
+    count
+}
@@ -0,0 +1,110 @@
+//! 3D Microbenchmark — Vertex throughput per attribute count.
+//!
+//! Draws [`NUM_TRIANGLES`] back-facing triangles per frame with culling
+//! on, so the cost is vertex fetch, shading and primitive setup with no
+//! rasterization, for [`GL3D_TEST_MS`] milliseconds.  Each vertex carries
+//! `VERTEX_ATTRIBS[n]` vec4 attributes, all of which the shader reads.
+//! Returns total vertices processed.
+
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+use libgl_client as gl;
+use super::{GL3D_TEST_MS, test_ms};
+use super::gl3d_common::*;
+
+const NUM_TRIANGLES: u32 = 10_000;
+
+/// Attribute counts per variant.
+pub const VERTEX_ATTRIBS: [u32; 4] = [1, 2, 4, 8];
+
+/// Vertex shader summing `n` vec4 attributes into one varying.
+fn vertex_shader(n: u32) -> String {
+    let mut src = String::new();
+    for i in 0..n {
+        src.push_str(&format!("attribute vec4 a{};\n", i));
+    }
+    src.push_str("varying vec4 vSum;\nvoid main() {\n    vec4 sum = a0;\n");
+    for i in 1..n {
+        src.push_str(&format!("    sum = sum + a{};\n", i));
+    }
+    src.push_str("    vSum = sum;\n    gl_Position = vec4(a0.xyz, 1.0);\n}");
+    src
+}
+
+const FS_SRC: &str =
+"varying vec4 vSum;
+void main() {
+    gl_FragColor = vSum;
+}";
+
+/// Vertex throughput benchmark with `VERTEX_ATTRIBS[variant]` attributes.
+pub fn bench_gl_vertex(target: &GlTarget, variant: usize) -> u64 {
+    let (w, h) = (target.w, target.h);
+    if !ensure_gl_init(w, h) { return 0; }
+
+    let attribs = VERTEX_ATTRIBS[variant.min(VERTEX_ATTRIBS.len() - 1)];
+    let vs_src = vertex_shader(attribs);
+    let (program, vs, fs) = match compile_program(&vs_src, FS_SRC) {
+        Some(p) => p,
+        None => return 0,
+    };
+    gl::use_program(program);
+
+    // Clockwise (back-facing) triangles; a0 = position, the rest filler
+    let floats_per_vertex = (attribs * 4) as usize;
+    let mut verts: Vec<f32> = Vec::with_capacity(NUM_TRIANGLES as usize * 3 * floats_per_vertex);
+    let mut seed: u32 = 99;
+    for _ in 0..NUM_TRIANGLES {
+        seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
+        let cx = ((seed >> 16) as f32 / 32768.0) - 1.0;
+        seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
+        let cy = ((seed >> 16) as f32 / 32768.0) - 1.0;
+        let corners = [[cx, cy], [cx, cy + 0.05], [cx + 0.05, cy]];
+        for c in &corners {
+            verts.extend_from_slice(&[c[0], c[1], 0.0, 1.0]);
+            for k in 1..attribs {
+                let v = k as f32 * 0.1;
+                verts.extend_from_slice(&[v, v, v, 1.0]);
+            }
+        }
+    }
+
+    let mut vbo = [0u32; 1];
+    gl::gen_buffers(1, &mut vbo);
+    gl::bind_buffer(gl::GL_ARRAY_BUFFER, vbo[0]);
+    gl::buffer_data_f32(gl::GL_ARRAY_BUFFER, &verts, gl::GL_STATIC_DRAW);
+    let stride = (floats_per_vertex * 4) as i32;
+    let mut locs = Vec::new();
+    for i in 0..attribs {
+        let loc = gl::get_attrib_location(program, &format!("a{}", i));
+        if loc >= 0 {
+            gl::enable_vertex_attrib_array(loc as u32);
+            gl::vertex_attrib_pointer(loc as u32, 4, gl::GL_FLOAT, false, stride, (i * 16) as usize);
+            locs.push(loc as u32);
+        }
+    }
+
+    gl::disable(gl::GL_DEPTH_TEST);
+    gl::enable(gl::GL_CULL_FACE);
+    gl::cull_face(gl::GL_BACK);
+
+    let vertex_count = (NUM_TRIANGLES * 3) as i32;
+    let mut count: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GL3D_TEST_MS) {
+        gl::clear(gl::GL_COLOR_BUFFER_BIT);
+        gl::draw_arrays(gl::GL_TRIANGLES, 0, vertex_count);
+        gl::swap_buffers();
+        count += vertex_count as u64;
+    }
+
+    copy_gl_to_canvas(target);
+    for loc in locs {
+        gl::disable_vertex_attrib_array(loc);
+    }
+    gl::delete_buffers(&vbo);
+    cleanup_program(program, vs, fs);
+    gl::enable(gl::GL_DEPTH_TEST);
+    count
+}
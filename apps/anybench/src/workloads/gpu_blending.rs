@@ -6,7 +6,7 @@
 
 use alloc::vec;
 use libanyui_client as anyui;
-use super::{GPU_TEST_MS, alpha_blend};
+use super::{GPU_TEST_MS, alpha_blend, test_ms};
 
 /// Alpha-blended rectangle compositing benchmark.
 pub fn bench_gpu_blending(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
@@ -21,7 +21,7 @@ pub fn bench_gpu_blending(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
         let mut count: u64 = 0;
         let start = anyos_std::sys::uptime_ms();
         let mut seed: u32 = 99;
-        while anyos_std::sys::uptime_ms().wrapping_sub(start) < GPU_TEST_MS {
+        while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GPU_TEST_MS) {
             for _ in 0..50 {
                 seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
                 let rx = ((seed >> 16) % w) as usize;
@@ -50,7 +50,7 @@ pub fn bench_gpu_blending(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
         let mut count: u64 = 0;
         let start = anyos_std::sys::uptime_ms();
         let mut seed: u32 = 99;
-        while anyos_std::sys::uptime_ms().wrapping_sub(start) < GPU_TEST_MS {
+        while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GPU_TEST_MS) {
             for _ in 0..50 {
                 seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
                 let rx = ((seed >> 16) % w) as i32;
@@ -5,7 +5,7 @@
 
 use alloc::vec;
 use libanyui_client as anyui;
-use super::GPU_TEST_MS;
+use super::{GPU_TEST_MS, test_ms};
 
 /// Rectangle fill throughput benchmark (onscreen via Canvas API, offscreen via raw buffer).
 pub fn bench_gpu_fill_rect(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
@@ -20,7 +20,7 @@ pub fn bench_gpu_fill_rect(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
         let mut count: u64 = 0;
         let start = anyos_std::sys::uptime_ms();
         let mut seed: u32 = 1;
-        while anyos_std::sys::uptime_ms().wrapping_sub(start) < GPU_TEST_MS {
+        while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GPU_TEST_MS) {
             for _ in 0..100 {
                 seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
                 let rx = ((seed >> 16) % w) as usize;
@@ -46,7 +46,7 @@ pub fn bench_gpu_fill_rect(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
         let mut count: u64 = 0;
         let start = anyos_std::sys::uptime_ms();
         let mut seed: u32 = 1;
-        while anyos_std::sys::uptime_ms().wrapping_sub(start) < GPU_TEST_MS {
+        while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GPU_TEST_MS) {
             for _ in 0..50 {
                 seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
                 let rx = (seed >> 16) % w;
@@ -5,7 +5,7 @@
 
 use alloc::vec;
 use libanyui_client as anyui;
-use super::{GPU_TEST_MS, draw_line_bresenham};
+use super::{GPU_TEST_MS, draw_line_bresenham, test_ms};
 
 /// Line rendering throughput benchmark.
 pub fn bench_gpu_lines(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
@@ -20,7 +20,7 @@ pub fn bench_gpu_lines(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
         let mut count: u64 = 0;
         let start = anyos_std::sys::uptime_ms();
         let mut seed: u32 = 13;
-        while anyos_std::sys::uptime_ms().wrapping_sub(start) < GPU_TEST_MS {
+        while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GPU_TEST_MS) {
             for _ in 0..50 {
                 seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
                 let x0 = ((seed >> 16) % w) as i32;
@@ -42,7 +42,7 @@ pub fn bench_gpu_lines(canvas: &anyui::Canvas, offscreen: bool) -> u64 {
         let mut count: u64 = 0;
         let start = anyos_std::sys::uptime_ms();
         let mut seed: u32 = 13;
-        while anyos_std::sys::uptime_ms().wrapping_sub(start) < GPU_TEST_MS {
+        while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(GPU_TEST_MS) {
             for _ in 0..50 {
                 seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
                 let x0 = ((seed >> 16) % w) as i32;
@@ -3,7 +3,7 @@
 //! Computes escape iterations for a 256×256 grid of the Mandelbrot set,
 //! repeated for [`CPU_TEST_MS`] milliseconds. Returns cumulative iterations.
 
-use super::CPU_TEST_MS;
+use super::{CPU_TEST_MS, test_ms};
 
 /// Mandelbrot escape-time benchmark over a 256×256 grid.
 pub fn bench_mandelbrot() -> u64 {
@@ -12,7 +12,7 @@ pub fn bench_mandelbrot() -> u64 {
     const MAX_ITER: u32 = 100;
     let mut total_iter: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < CPU_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(CPU_TEST_MS) {
         for py in 0..H {
             for px in 0..W {
                 let x0 = (px as f64 / W as f64) * 3.5 - 2.5;
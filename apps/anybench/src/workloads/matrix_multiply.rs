@@ -4,7 +4,7 @@
 //! milliseconds. Returns total multiply-add operations performed.
 
 use alloc::vec;
-use super::CPU_TEST_MS;
+use super::{CPU_TEST_MS, test_ms};
 
 /// Dense 64×64 integer matrix multiplication benchmark.
 pub fn bench_matrix_multiply() -> u64 {
@@ -24,7 +24,7 @@ pub fn bench_matrix_multiply() -> u64 {
 
     let mut ops: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < CPU_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(CPU_TEST_MS) {
         for i in 0..N {
             for j in 0..N {
                 let mut sum = 0i32;
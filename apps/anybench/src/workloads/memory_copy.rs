@@ -4,7 +4,7 @@
 //! milliseconds. Returns total bytes copied.
 
 use alloc::vec;
-use super::CPU_TEST_MS;
+use super::{CPU_TEST_MS, test_ms};
 
 /// Sequential volatile buffer copy benchmark.
 pub fn bench_memory_copy() -> u64 {
@@ -13,7 +13,7 @@ pub fn bench_memory_copy() -> u64 {
     let mut dst = vec![0u8; BUF_SIZE];
     let mut total_bytes: u64 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < CPU_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(CPU_TEST_MS) {
         for i in 0..BUF_SIZE {
             unsafe {
                 let s = core::ptr::read_volatile(src.as_ptr().add(i));
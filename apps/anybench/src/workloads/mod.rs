@@ -26,6 +26,17 @@ mod gl3d_lighting;
 mod gl3d_depth;
 mod gl3d_drawcalls;
 
+// libgl microbenchmarks (CLI mode only, no baselines)
+mod gl_fill;
+mod gl_texture;
+mod gl_vertex;
+
+// System benchmarks: kernel, IPC, filesystems, TCP (CLI mode only)
+mod sys_latency;
+mod sys_ipc;
+mod sys_fs;
+mod sys_net;
+
 pub use prime_sieve::bench_prime_sieve;
 pub use mandelbrot::bench_mandelbrot;
 pub use memory_copy::bench_memory_copy;
@@ -45,6 +56,18 @@ pub use gl3d_lighting::bench_gl3d_lighting;
 pub use gl3d_depth::bench_gl3d_depth;
 pub use gl3d_drawcalls::bench_gl3d_drawcalls;
 
+pub use gl_fill::{bench_gl_fill, FILL_SHADERS};
+pub use gl_texture::{bench_gl_texture, TEXTURE_FILTERS};
+pub use gl_vertex::{bench_gl_vertex, VERTEX_ATTRIBS};
+
+pub use sys_latency::{bench_sys_latency, LATENCY_TESTS};
+pub use sys_ipc::{bench_sys_ipc, IPC_TESTS};
+pub use sys_fs::{bench_sys_fs, fs_cleanup, fs_mounts, FS_TESTS};
+pub use sys_net::{bench_sys_net, NET_TESTS};
+
+pub use gl3d_common::GlTarget;
+
+use core::sync::atomic::{AtomicU32, Ordering};
 use libanyui_client as anyui;
 
 /// Duration for each CPU benchmark in milliseconds.
@@ -59,6 +82,25 @@ pub const GPU_TEST_MS: u32 = 5000;
 /// Same as GPU — long enough for stable results through the full GL pipeline.
 pub const GL3D_TEST_MS: u32 = 5000;
 
+/// Duration for each system benchmark in milliseconds.
+pub const SYS_TEST_MS: u32 = 2000;
+
+/// Per-test duration override in milliseconds (0 = use the defaults above).
+static TEST_MS_OVERRIDE: AtomicU32 = AtomicU32::new(0);
+
+/// Override every test's duration (CLI `--ms`); 0 restores the defaults.
+pub fn set_test_ms(ms: u32) {
+    TEST_MS_OVERRIDE.store(ms, Ordering::Relaxed);
+}
+
+/// Duration a workload should run for, given its default.
+pub fn test_ms(default: u32) -> u32 {
+    match TEST_MS_OVERRIDE.load(Ordering::Relaxed) {
+        0 => default,
+        ms => ms,
+    }
+}
+
 pub const NUM_CPU_TESTS: usize = 6;
 pub const NUM_GPU_TESTS: usize = 5;
 pub const NUM_GL3D_TESTS: usize = 5;
@@ -142,13 +184,13 @@ pub fn run_gpu_test(index: usize, canvas: &anyui::Canvas, offscreen: bool) -> u6
 }
 
 /// Dispatches a 3D (libgl) benchmark by 0-based index. Returns the raw score.
-pub fn run_gl3d_test(index: usize, canvas: &anyui::Canvas) -> u64 {
+pub fn run_gl3d_test(index: usize, target: &GlTarget) -> u64 {
     match index {
-        0 => bench_gl3d_triangles(canvas),
-        1 => bench_gl3d_textured(canvas),
-        2 => bench_gl3d_lighting(canvas),
-        3 => bench_gl3d_depth(canvas),
-        4 => bench_gl3d_drawcalls(canvas),
+        0 => bench_gl3d_triangles(target),
+        1 => bench_gl3d_textured(target),
+        2 => bench_gl3d_lighting(target),
+        3 => bench_gl3d_depth(target),
+        4 => bench_gl3d_drawcalls(target),
         _ => 0,
     }
 }
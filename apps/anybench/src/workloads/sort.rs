@@ -4,7 +4,7 @@
 //! milliseconds. Returns cumulative number of elements sorted.
 
 use alloc::vec;
-use super::CPU_TEST_MS;
+use super::{CPU_TEST_MS, test_ms};
 
 /// Quicksort benchmark on pseudo-random data.
 pub fn bench_sort() -> u64 {
@@ -13,7 +13,7 @@ pub fn bench_sort() -> u64 {
     let mut total: u64 = 0;
     let mut rep: u32 = 0;
     let start = anyos_std::sys::uptime_ms();
-    while anyos_std::sys::uptime_ms().wrapping_sub(start) < CPU_TEST_MS {
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(CPU_TEST_MS) {
         let mut seed: u32 = 42u32.wrapping_add(rep);
         for v in data.iter_mut() {
             seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
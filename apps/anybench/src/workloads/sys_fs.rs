@@ -0,0 +1,185 @@
+//! System Benchmark — File I/O per filesystem driver.
+//!
+//! Runs against `anybench.tmp` in the root of one mount of every writable
+//! disk filesystem driver (see [`fs_mounts`]), an [`FILE_SIZE`] file that
+//! is created on first use and removed by [`fs_cleanup`]:
+//! * `seqwrite`  — 64 KiB writes front to back, `fsync` per pass (bytes).
+//! * `seqread`   — 64 KiB reads front to back (bytes).
+//! * `randwrite` — 4 KiB writes at random aligned offsets, `fsync` every
+//!   [`SYNC_EVERY`] writes (operations).
+//! * `randread`  — 4 KiB reads at random aligned offsets (operations).
+//!
+//! Reads mostly hit the page cache once the file is warm, which is what
+//! applications see too.
+
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+use alloc::format;
+use anyos_std::fs;
+use super::{SYS_TEST_MS, test_ms};
+
+/// Names of the file I/O tests, indexed by [`bench_sys_fs`].
+pub const FS_TESTS: [&str; 4] = ["seqwrite", "seqread", "randwrite", "randread"];
+
+const FILE_SIZE: u32 = 8 * 1024 * 1024;
+const SEQ_CHUNK: usize = 64 * 1024;
+const RAND_BLOCK: usize = 4096;
+const SYNC_EVERY: u32 = 256;
+
+/// Drivers that cannot hold the test file.
+const SKIP_DRIVERS: [&str; 2] = ["devfs", "iso9660"];
+
+/// `(driver, mount path)` of the first mount of each writable filesystem
+/// driver.
+pub fn fs_mounts() -> Vec<(String, String)> {
+    let mut buf = vec![0u8; 2048];
+    let n = fs::list_mounts(&mut buf);
+    if n == u32::MAX {
+        return Vec::new();
+    }
+    let text = core::str::from_utf8(&buf[..n as usize]).unwrap_or("");
+    let mut mounts: Vec<(String, String)> = Vec::new();
+    for line in text.lines() {
+        let Some((path, driver)) = line.split_once('\t') else { continue };
+        if SKIP_DRIVERS.contains(&driver) || mounts.iter().any(|(d, _)| d == driver) {
+            continue;
+        }
+        mounts.push((String::from(driver), String::from(path)));
+    }
+    mounts
+}
+
+fn test_file(mount: &str) -> String {
+    format!("{}/anybench.tmp", mount.trim_end_matches('/'))
+}
+
+/// Remove the test file from `mount`.
+pub fn fs_cleanup(mount: &str) {
+    fs::unlink(&test_file(mount));
+}
+
+/// Runs file I/O test `index` on `mount`.  Returns bytes (sequential) or
+/// operations (random), 0 if the file cannot be created.
+pub fn bench_sys_fs(mount: &str, index: usize) -> u64 {
+    let path = test_file(mount);
+    if index != 0 && !prepare(&path) {
+        return 0;
+    }
+    match index {
+        0 => seq_write(&path),
+        1 => seq_read(&path),
+        2 => rand_io(&path, true),
+        3 => rand_io(&path, false),
+        _ => 0,
+    }
+}
+
+fn file_size(fd: u32) -> u32 {
+    let mut st = [0u32; 4];
+    if fs::fstat(fd, &mut st) == 0 { st[1] } else { 0 }
+}
+
+/// Make sure the test file exists at full size.
+fn prepare(path: &str) -> bool {
+    let fd = fs::open(path, 0);
+    if fd != u32::MAX {
+        let size = file_size(fd);
+        fs::close(fd);
+        if size >= FILE_SIZE {
+            return true;
+        }
+    }
+    let fd = fs::open(path, fs::O_WRITE | fs::O_CREATE | fs::O_TRUNC);
+    if fd == u32::MAX {
+        return false;
+    }
+    let data = vec![0xA5u8; SEQ_CHUNK];
+    let mut ok = true;
+    for _ in 0..FILE_SIZE as usize / SEQ_CHUNK {
+        if fs::write(fd, &data) != SEQ_CHUNK as u32 {
+            ok = false;
+            break;
+        }
+    }
+    fs::fsync(fd);
+    fs::close(fd);
+    ok
+}
+
+fn seq_write(path: &str) -> u64 {
+    let fd = fs::open(path, fs::O_WRITE | fs::O_CREATE | fs::O_TRUNC);
+    if fd == u32::MAX {
+        return 0;
+    }
+    let data = vec![0x3Cu8; SEQ_CHUNK];
+    let mut bytes: u64 = 0;
+    let mut pos: u32 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        if fs::write(fd, &data) != SEQ_CHUNK as u32 {
+            break;
+        }
+        bytes += SEQ_CHUNK as u64;
+        pos += SEQ_CHUNK as u32;
+        if pos >= FILE_SIZE {
+            fs::fsync(fd);
+            fs::lseek(fd, 0, fs::SEEK_SET);
+            pos = 0;
+        }
+    }
+    fs::fsync(fd);
+    fs::close(fd);
+    bytes
+}
+
+fn seq_read(path: &str) -> u64 {
+    let fd = fs::open(path, 0);
+    if fd == u32::MAX {
+        return 0;
+    }
+    let mut buf = vec![0u8; SEQ_CHUNK];
+    let mut bytes: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        match fs::read(fd, &mut buf) {
+            u32::MAX => break,
+            0 => { fs::lseek(fd, 0, fs::SEEK_SET); }
+            n => bytes += n as u64,
+        }
+    }
+    fs::close(fd);
+    bytes
+}
+
+fn rand_io(path: &str, write: bool) -> u64 {
+    let fd = fs::open(path, if write { fs::O_WRITE } else { 0 });
+    if fd == u32::MAX {
+        return 0;
+    }
+    let mut buf = vec![0x69u8; RAND_BLOCK];
+    let blocks = FILE_SIZE / RAND_BLOCK as u32;
+    let mut rng: u32 = 0x2545_F491;
+    let mut ops: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        let offset = (rng % blocks) * RAND_BLOCK as u32;
+        fs::lseek(fd, offset as i32, fs::SEEK_SET);
+        let n = if write { fs::write(fd, &buf) } else { fs::read(fd, &mut buf) };
+        if n != RAND_BLOCK as u32 {
+            break;
+        }
+        ops += 1;
+        if write && ops % SYNC_EVERY as u64 == 0 {
+            fs::fsync(fd);
+        }
+    }
+    if write {
+        fs::fsync(fd);
+    }
+    fs::close(fd);
+    ops
+}
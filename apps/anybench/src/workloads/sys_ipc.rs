@@ -0,0 +1,211 @@
+//! System Benchmark — IPC throughput.
+//!
+//! Each test moves data from a producer thread to the measuring thread:
+//! * `pipe`  — 64 KiB writes through an anonymous pipe (bytes).
+//! * `evbus` — events emitted on a module channel and drained in batches,
+//!   at most [`EVT_WINDOW`] in flight (events).
+//! * `shm`   — 64 KiB blocks handed over through a two-slot ring in a
+//!   shared-memory region (bytes).
+
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use alloc::vec;
+use anyos_std::process::Thread;
+use anyos_std::{fs, ipc};
+use super::{SYS_TEST_MS, test_ms};
+
+/// Names of the IPC tests, indexed by [`bench_sys_ipc`].
+pub const IPC_TESTS: [&str; 3] = ["pipe", "evbus", "shm"];
+
+const CHUNK: usize = 64 * 1024;
+/// Events emitted but not yet consumed before the producer waits.
+const EVT_WINDOW: u64 = 256;
+
+static STOP: AtomicU32 = AtomicU32::new(0);
+/// Pipe write end / event channel / shared-memory address for the producer.
+static TARGET: AtomicU64 = AtomicU64::new(0);
+/// Events consumed so far (event-bus flow control).
+static CONSUMED: AtomicU64 = AtomicU64::new(0);
+
+/// Runs IPC test `index` and returns bytes or events transferred.
+pub fn bench_sys_ipc(index: usize) -> u64 {
+    STOP.store(0, Ordering::Relaxed);
+    match index {
+        0 => pipe(),
+        1 => evbus(),
+        2 => shm(),
+        _ => 0,
+    }
+}
+
+fn expired(start: u32) -> bool {
+    anyos_std::sys::uptime_ms().wrapping_sub(start) >= test_ms(SYS_TEST_MS)
+}
+
+// ── Pipe ────────────────────────────────────────────────────────────────
+
+fn pipe_writer() {
+    let fd = TARGET.load(Ordering::Acquire) as u32;
+    let data = vec![0x5Au8; CHUNK];
+    while STOP.load(Ordering::Acquire) == 0 {
+        if fs::write(fd, &data) == u32::MAX {
+            break;
+        }
+    }
+    fs::close(fd);
+}
+
+fn pipe() -> u64 {
+    let Some((rd, wr)) = fs::pipe() else { return 0 };
+    fs::set_pipe_size(rd, CHUNK as u32 * 4);
+    TARGET.store(wr as u64, Ordering::Release);
+    let thread = match Thread::spawn(pipe_writer, "bench_pipe") {
+        Ok(t) => t,
+        Err(_) => {
+            fs::close(rd);
+            fs::close(wr);
+            return 0;
+        }
+    };
+
+    let mut buf = vec![0u8; CHUNK];
+    let mut bytes: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while !expired(start) {
+        match fs::read(rd, &mut buf) {
+            0 | u32::MAX => break,
+            n => bytes += n as u64,
+        }
+    }
+    STOP.store(1, Ordering::Release);
+    // Drain until the writer sees STOP and closes its end (EOF)
+    loop {
+        match fs::read(rd, &mut buf) {
+            0 | u32::MAX => break,
+            _ => {}
+        }
+    }
+    thread.join();
+    fs::close(rd);
+    bytes
+}
+
+// ── Event bus ───────────────────────────────────────────────────────────
+
+fn evt_producer() {
+    let chan = TARGET.load(Ordering::Acquire) as u32;
+    let mut emitted: u64 = 0;
+    let mut event = [0u32; 5];
+    while STOP.load(Ordering::Acquire) == 0 {
+        if emitted - CONSUMED.load(Ordering::Acquire) >= EVT_WINDOW {
+            anyos_std::process::yield_cpu();
+            continue;
+        }
+        event[0] = 0xBE0C;
+        event[1] = emitted as u32;
+        ipc::evt_chan_emit(chan, &event);
+        emitted += 1;
+    }
+}
+
+fn evbus() -> u64 {
+    let chan = ipc::evt_chan_create("anybench:evbus");
+    let sub = ipc::evt_chan_subscribe(chan, 0);
+    CONSUMED.store(0, Ordering::Relaxed);
+    TARGET.store(chan as u64, Ordering::Release);
+    let thread = match Thread::spawn(evt_producer, "bench_evbus") {
+        Ok(t) => t,
+        Err(_) => {
+            ipc::evt_chan_unsubscribe(chan, sub);
+            ipc::evt_chan_destroy(chan);
+            return 0;
+        }
+    };
+
+    let mut batch = [[0u32; 5]; 64];
+    let mut events: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while !expired(start) {
+        let n = ipc::evt_chan_poll_batch(chan, sub, &mut batch);
+        if n == 0 {
+            ipc::evt_chan_wait(chan, sub, 10);
+            continue;
+        }
+        events += n as u64;
+        CONSUMED.store(events, Ordering::Release);
+    }
+    STOP.store(1, Ordering::Release);
+    thread.join();
+    ipc::evt_chan_unsubscribe(chan, sub);
+    ipc::evt_chan_destroy(chan);
+    events
+}
+
+// ── Shared memory ───────────────────────────────────────────────────────
+
+/// Ring header at the start of the region: sequence numbers of the blocks
+/// written and read.  Slot `seq % 2` holds block `seq`.
+#[repr(C)]
+struct ShmRing {
+    written: AtomicU64,
+    read: AtomicU64,
+}
+
+const SHM_HEADER: usize = 4096;
+
+fn shm_producer() {
+    let base = TARGET.load(Ordering::Acquire) as usize;
+    let ring = unsafe { &*(base as *const ShmRing) };
+    let mut seq: u64 = 0;
+    while STOP.load(Ordering::Acquire) == 0 {
+        if seq - ring.read.load(Ordering::Acquire) >= 2 {
+            anyos_std::process::yield_cpu();
+            continue;
+        }
+        let slot = (base + SHM_HEADER + (seq % 2) as usize * CHUNK) as *mut u8;
+        unsafe { core::ptr::write_bytes(slot, seq as u8, CHUNK) };
+        seq += 1;
+        ring.written.store(seq, Ordering::Release);
+    }
+}
+
+fn shm() -> u64 {
+    let id = ipc::shm_create((SHM_HEADER + 2 * CHUNK) as u32);
+    if id == 0 {
+        return 0;
+    }
+    let base = ipc::shm_map(id) as usize;
+    if base == 0 {
+        ipc::shm_destroy(id);
+        return 0;
+    }
+    let ring = unsafe { &*(base as *const ShmRing) };
+    ring.written.store(0, Ordering::Relaxed);
+    ring.read.store(0, Ordering::Relaxed);
+    TARGET.store(base as u64, Ordering::Release);
+
+    let mut bytes: u64 = 0;
+    if let Ok(thread) = Thread::spawn(shm_producer, "bench_shm") {
+        let mut seq: u64 = 0;
+        let mut sum: u64 = 0;
+        let start = anyos_std::sys::uptime_ms();
+        while !expired(start) {
+            if ring.written.load(Ordering::Acquire) == seq {
+                anyos_std::process::yield_cpu();
+                continue;
+            }
+            let slot = (base + SHM_HEADER + (seq % 2) as usize * CHUNK) as *const u64;
+            for i in 0..CHUNK / 8 {
+                sum = sum.wrapping_add(unsafe { core::ptr::read_volatile(slot.add(i)) });
+            }
+            seq += 1;
+            ring.read.store(seq, Ordering::Release);
+            bytes += CHUNK as u64;
+        }
+        core::hint::black_box(sum);
+        STOP.store(1, Ordering::Release);
+        thread.join();
+    }
+    ipc::shm_unmap(id);
+    ipc::shm_destroy(id);
+    bytes
+}
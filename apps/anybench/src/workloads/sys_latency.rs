@@ -0,0 +1,79 @@
+//! System Benchmark — Kernel entry and context-switch latency.
+//!
+//! `syscall` issues `getpid` in a tight loop and counts calls.
+//! `ctxswitch` ping-pongs a futex word between two threads; every hand-off
+//! blocks one thread and wakes the other, so the count is switches.
+//! Both report operations; the CLI turns them into nanoseconds per op.
+
+use core::sync::atomic::{AtomicU32, Ordering};
+use anyos_std::process::Thread;
+use anyos_std::sync::{futex_wait, futex_wake};
+use super::{SYS_TEST_MS, test_ms};
+
+/// Names of the latency tests, indexed by [`bench_sys_latency`].
+pub const LATENCY_TESTS: [&str; 2] = ["syscall", "ctxswitch"];
+
+/// Whose turn it is: 0 = main thread, 1 = partner.
+static TURN: AtomicU32 = AtomicU32::new(0);
+static STOP: AtomicU32 = AtomicU32::new(0);
+
+/// Runs latency test `index` and returns the number of operations.
+pub fn bench_sys_latency(index: usize) -> u64 {
+    match index {
+        0 => null_syscall(),
+        1 => context_switch(),
+        _ => 0,
+    }
+}
+
+fn null_syscall() -> u64 {
+    let mut calls: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        for _ in 0..1024 {
+            core::hint::black_box(anyos_std::process::getpid());
+        }
+        calls += 1024;
+    }
+    calls
+}
+
+fn partner() {
+    loop {
+        while TURN.load(Ordering::Acquire) != 1 {
+            if STOP.load(Ordering::Acquire) != 0 {
+                return;
+            }
+            futex_wait(&TURN, 0, 100);
+        }
+        TURN.store(0, Ordering::Release);
+        futex_wake(&TURN, 1);
+    }
+}
+
+fn context_switch() -> u64 {
+    TURN.store(0, Ordering::Relaxed);
+    STOP.store(0, Ordering::Relaxed);
+    let thread = match Thread::spawn(partner, "bench_pingpong") {
+        Ok(t) => t,
+        Err(_) => return 0,
+    };
+
+    let mut rounds: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        for _ in 0..64 {
+            TURN.store(1, Ordering::Release);
+            futex_wake(&TURN, 1);
+            while TURN.load(Ordering::Acquire) != 0 {
+                futex_wait(&TURN, 1, 100);
+            }
+        }
+        rounds += 64;
+    }
+
+    STOP.store(1, Ordering::Release);
+    futex_wake(&TURN, 1);
+    thread.join();
+    rounds * 2
+}
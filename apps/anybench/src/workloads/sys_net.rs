@@ -0,0 +1,132 @@
+//! System Benchmark — Loopback TCP.
+//!
+//! A server thread listens on 127.0.0.1 and the measuring thread talks to
+//! it through the kernel's loopback path (the full TCP stack, no NIC):
+//! * `stream`  — one connection, 16 KiB sends; counts bytes the server
+//!   received.
+//! * `connect` — connect and close in a loop; the server accepts and
+//!   closes; counts completed connections.
+
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use alloc::vec;
+use anyos_std::net;
+use anyos_std::process::Thread;
+use super::{SYS_TEST_MS, test_ms};
+
+/// Names of the TCP tests, indexed by [`bench_sys_net`].
+pub const NET_TESTS: [&str; 2] = ["stream", "connect"];
+
+const LOOPBACK: [u8; 4] = [127, 0, 0, 1];
+const PORT: u16 = 17_001;
+const CHUNK: usize = 16 * 1024;
+
+/// 0 = starting, 1 = listening, 2 = could not listen.
+static READY: AtomicU32 = AtomicU32::new(0);
+static STOP: AtomicU32 = AtomicU32::new(0);
+static RECEIVED: AtomicU64 = AtomicU64::new(0);
+
+/// Runs TCP test `index` and returns bytes or connections.
+pub fn bench_sys_net(index: usize) -> u64 {
+    let server: fn() = match index {
+        0 => stream_server,
+        1 => connect_server,
+        _ => return 0,
+    };
+    READY.store(0, Ordering::Relaxed);
+    STOP.store(0, Ordering::Relaxed);
+    RECEIVED.store(0, Ordering::Relaxed);
+    let thread = match Thread::spawn(server, "bench_tcp") {
+        Ok(t) => t,
+        Err(_) => return 0,
+    };
+    while READY.load(Ordering::Acquire) == 0 {
+        anyos_std::process::yield_cpu();
+    }
+    if READY.load(Ordering::Acquire) != 1 {
+        thread.join();
+        return 0;
+    }
+    let result = match index {
+        0 => stream_client(),
+        _ => connect_client(),
+    };
+    STOP.store(1, Ordering::Release);
+    if index == 1 {
+        // Unblock the accept waiting for the next client
+        let sock = net::tcp_connect(&LOOPBACK, PORT, 1000);
+        if sock != u32::MAX {
+            net::tcp_close(sock);
+        }
+    }
+    thread.join();
+    match index {
+        0 => RECEIVED.load(Ordering::Acquire),
+        _ => result,
+    }
+}
+
+fn listen() -> Option<u32> {
+    let listener = net::tcp_listen(PORT, 64);
+    READY.store(if listener == u32::MAX { 2 } else { 1 }, Ordering::Release);
+    if listener == u32::MAX { None } else { Some(listener) }
+}
+
+fn stream_server() {
+    let Some(listener) = listen() else { return };
+    let (sock, _, _) = net::tcp_accept(listener);
+    if sock != u32::MAX {
+        let mut buf = vec![0u8; CHUNK * 4];
+        loop {
+            match net::tcp_recv(sock, &mut buf) {
+                0 | u32::MAX => break,
+                n => { RECEIVED.fetch_add(n as u64, Ordering::Relaxed); }
+            }
+        }
+        net::tcp_close(sock);
+    }
+    net::tcp_close(listener);
+}
+
+fn stream_client() -> u64 {
+    let sock = net::tcp_connect(&LOOPBACK, PORT, 1000);
+    if sock == u32::MAX {
+        return 0;
+    }
+    let data = vec![0x42u8; CHUNK];
+    let mut sent: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        match net::tcp_send(sock, &data) {
+            0 | u32::MAX => break,
+            n => sent += n as u64,
+        }
+    }
+    net::tcp_close(sock);
+    sent
+}
+
+fn connect_server() {
+    let Some(listener) = listen() else { return };
+    while STOP.load(Ordering::Acquire) == 0 {
+        let (sock, _, _) = net::tcp_accept(listener);
+        if sock == u32::MAX {
+            break;
+        }
+        net::tcp_close(sock);
+    }
+    net::tcp_close(listener);
+}
+
+fn connect_client() -> u64 {
+    let mut conns: u64 = 0;
+    let start = anyos_std::sys::uptime_ms();
+    while anyos_std::sys::uptime_ms().wrapping_sub(start) < test_ms(SYS_TEST_MS) {
+        let sock = net::tcp_connect(&LOOPBACK, PORT, 1000);
+        if sock == u32::MAX {
+            break;
+        }
+        net::tcp_close(sock);
+        conns += 1;
+    }
+    conns
+}
@@ -16,6 +16,8 @@ const BG: u32 = 0xFF1E1E1E;
 const CHECKER_A: u32 = 0xFF3C3C3C;
 const CHECKER_B: u32 = 0xFF2C2C2C;
 const CHECKER_SIZE: i32 = 8;
+/// Thumbnail size looked up to tell whether the cache is current.
+const THUMB_PROBE_SIZE: u32 = 32;
 
 struct AppState {
     canvas: anyui::Canvas,
@@ -79,6 +81,12 @@ fn main() {
     drop(scratch);
     drop(data);
 
+    // Share the decode with the file browsers' thumbnail cache
+    let mut probe_thumb = [0u32; (THUMB_PROBE_SIZE * THUMB_PROBE_SIZE) as usize];
+    if libimage_client::thumbnail_lookup(path, THUMB_PROBE_SIZE, false, &mut probe_thumb).is_err() {
+        let _ = libimage_client::thumbnail_store(path, &pixels, info.width, info.height);
+    }
+
     if !anyui::init() { return; }
 
     let filename = path.rsplit('/').next().unwrap_or(path);
@@ -206,6 +206,9 @@ fn run_apkg(args: &str) -> u32 {
 /// Download a package to apkg's cache directory with progress reporting.
 /// The `callback` is called with `(received, total, userdata)` per chunk.
 /// Returns true if the file was downloaded (or already cached).
+///
+/// The file lands as `<filename>.part`, which apkg checksums and moves
+/// into place when it installs the package (resuming it if incomplete).
 pub fn download_package(
     pkg: &PackageInfo,
     callback: libhttp_client::ProgressCallback,
@@ -232,11 +235,12 @@ pub fn download_package(
         return false;
     }
 
+    let part_path = alloc::format!("{}.part", cache_path);
     let arch = "x86_64";
     for mirror in &mirrors {
         let base = mirror.trim_end_matches('/');
         let url = alloc::format!("{}/packages/{}/{}", base, arch, pkg.filename);
-        if libhttp_client::download_progress(&url, &cache_path, callback, userdata) {
+        if libhttp_client::download_progress(&url, &part_path, callback, userdata) {
             return true;
         }
     }
@@ -6,6 +6,14 @@
  *
  * Provides a simple high-level API: tls_connect / tls_send / tls_recv / tls_close.
  * Uses a "trust-all" X.509 validator (no certificate chain verification).
+ *
+ * Session parameters of completed handshakes are cached per server name, so
+ * reconnecting to a known server resumes the session (abbreviated handshake,
+ * no key exchange).  The cache can be exported/imported as a blob for
+ * callers that want to keep it on disk.
+ *
+ * Callers that speak HTTP/2 enable ALPN with tls_set_alpn_h2() and check
+ * the server's choice with tls_alpn_is_h2() after connecting.
  */
 
 #include "bearssl.h"
@@ -182,6 +190,73 @@ static unsigned char iobuf[BR_SSL_BUFSIZE_BIDI];
 static br_sslio_context ioc;
 static int tls_fd_storage;
 
+/* ALPN protocol list offered when HTTP/2 is enabled (preference order). */
+static const char *alpn_names[] = { "h2", "http/1.1" };
+static int alpn_h2;
+
+/* -------------------------------------------------------------------------- */
+/* Session cache                                                              */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * BearSSL clients resume by session ID (it does not implement tickets).
+ * Entries are replaced round-robin; servers forget sessions after a few
+ * minutes to hours anyway, and a rejected ID just means a full handshake.
+ */
+
+#define SESSION_CACHE_SIZE 8
+#define SESSION_HOST_MAX   128
+
+typedef struct {
+    char host[SESSION_HOST_MAX];
+    br_ssl_session_parameters params;
+} session_entry;
+
+static session_entry session_cache[SESSION_CACHE_SIZE];
+static int session_next;
+static int session_dirty;
+
+static int host_equal(const char *a, const char *b)
+{
+    while (*a && *a == *b) { a++; b++; }
+    return *a == *b;
+}
+
+static session_entry *session_find(const char *host)
+{
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        if (session_cache[i].host[0] && host_equal(session_cache[i].host, host))
+            return &session_cache[i];
+    }
+    return 0;
+}
+
+static void session_store(const char *host, const br_ssl_session_parameters *p)
+{
+    size_t len = strlen(host);
+    if (len == 0 || len >= SESSION_HOST_MAX || p->session_id_len == 0)
+        return;
+    session_entry *e = session_find(host);
+    if (e == 0) {
+        e = &session_cache[session_next];
+        session_next = (session_next + 1) % SESSION_CACHE_SIZE;
+        memcpy(e->host, host, len + 1);
+    } else if (memcmp(&e->params, p, sizeof *p) == 0) {
+        return; /* resumed: nothing new */
+    }
+    e->params = *p;
+    session_dirty = 1;
+}
+
+static void session_forget(const char *host)
+{
+    session_entry *e = session_find(host);
+    if (e != 0) {
+        memset(e, 0, sizeof *e);
+        session_dirty = 1;
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 /* Public API                                                                 */
 /* -------------------------------------------------------------------------- */
@@ -212,8 +287,17 @@ int tls_connect(int fd, const char *host)
     /* Set I/O buffer. */
     br_ssl_engine_set_buffer(&sc.eng, iobuf, sizeof iobuf, 1);
 
-    /* Reset the client context for a new connection. */
-    br_ssl_client_reset(&sc, host, 0);
+    /* Offer h2 via ALPN if the caller asked for it. */
+    if (alpn_h2) {
+        br_ssl_engine_set_protocol_names(&sc.eng, alpn_names, 2);
+    }
+
+    /* Reset the client context; offer a cached session for this host. */
+    session_entry *cached = session_find(host);
+    if (cached != 0) {
+        br_ssl_engine_set_session_parameters(&sc.eng, &cached->params);
+    }
+    br_ssl_client_reset(&sc, host, cached != 0);
 
     /* Initialize the sslio wrapper with our I/O callbacks. */
     br_sslio_init(&ioc, &sc.eng,
@@ -226,9 +310,15 @@ int tls_connect(int fd, const char *host)
     /* Check for errors. */
     int err = br_ssl_engine_last_error(&sc.eng);
     if (err != BR_ERR_OK) {
+        session_forget(host);
         return -err; /* return negative BearSSL error code */
     }
 
+    /* Remember the (new or resumed) session for the next connection. */
+    br_ssl_session_parameters params;
+    br_ssl_engine_get_session_parameters(&sc.eng, &params);
+    session_store(host, &params);
+
     return 0;
 }
 
@@ -275,3 +365,57 @@ int tls_last_error(void)
 {
     return br_ssl_engine_last_error(&sc.eng);
 }
+
+/*
+ * Offer "h2" (then "http/1.1") via ALPN on subsequent tls_connect() calls.
+ */
+void tls_set_alpn_h2(int enable)
+{
+    alpn_h2 = enable;
+}
+
+/*
+ * Non-zero if the server selected "h2" on the current connection.
+ */
+int tls_alpn_is_h2(void)
+{
+    const char *p = br_ssl_engine_get_selected_protocol(&sc.eng);
+    return p != 0 && p[0] == 'h' && p[1] == '2' && p[2] == 0;
+}
+
+/*
+ * Copy the session cache into `buf` (at most `len` bytes) and clear the
+ * dirty flag.  Returns the number of bytes written, or -1 if `buf` is too
+ * small.  The blob is only meaningful to the same build of this file.
+ */
+int tls_session_cache_export(void *buf, int len)
+{
+    if (len < (int)sizeof session_cache) return -1;
+    memcpy(buf, session_cache, sizeof session_cache);
+    session_dirty = 0;
+    return (int)sizeof session_cache;
+}
+
+/*
+ * Replace the session cache with a blob from tls_session_cache_export().
+ * Blobs of the wrong size are ignored.  Returns 0 on success, -1 otherwise.
+ */
+int tls_session_cache_import(const void *buf, int len)
+{
+    if (len != (int)sizeof session_cache) return -1;
+    memcpy(session_cache, buf, sizeof session_cache);
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        session_cache[i].host[SESSION_HOST_MAX - 1] = 0;
+    }
+    session_next = 0;
+    session_dirty = 0;
+    return 0;
+}
+
+/*
+ * Non-zero if a session was added or changed since the last export/import.
+ */
+int tls_session_cache_dirty(void)
+{
+    return session_dirty;
+}
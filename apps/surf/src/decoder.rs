@@ -0,0 +1,278 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Background image decode workers for the Surf browser.
+//!
+//! Fetched images are handed to a small pool of worker threads instead of
+//! being decoded on the UI thread.  The UI thread only sniffs the header
+//! (`libimage_client::probe`) so layout can reserve the image's box right
+//! away; the pixels follow once a worker is done and are picked up by the
+//! network poll timer (`drain_results`).
+//!
+//! Images shown smaller than their natural size are scaled down to the
+//! display size on the worker, so the cache and the tile blits only deal
+//! with the pixels actually visible.
+//!
+//! Raster decoding through libimage works on caller-provided buffers and
+//! runs on all workers in parallel.  libsvg keeps allocator state in the
+//! loaded library, so SVG rendering is serialized by `SVG_LOCK`.
+//!
+//! The queues use the same `AtomicBool` spinlocks as `net_worker`, since
+//! `Thread::spawn` only accepts `fn()`.
+
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+
+/// Number of decode threads.
+const DECODE_WORKERS: u32 = 2;
+
+/// Largest accepted image dimension (either axis).
+pub(crate) const MAX_IMAGE_DIM: u32 = 4096;
+
+/// SVGs without an intrinsic size are rendered at this size.
+const SVG_DEFAULT_SIZE: u32 = 256;
+
+// ═══════════════════════════════════════════════════════════
+// Job / result types
+// ═══════════════════════════════════════════════════════════
+
+/// An image to decode.
+pub(crate) struct DecodeJob {
+    pub tab_index: usize,
+    pub src: String,
+    pub body: Vec<u8>,
+    pub svg: bool,
+    /// Size to decode at if smaller than the natural size (0×0 = natural).
+    pub target: (u32, u32),
+    pub generation: u32,
+}
+
+/// A decoded image, ready for `WebView::add_image_scaled`.
+pub(crate) struct DecodedImage {
+    pub tab_index: usize,
+    pub src: String,
+    pub pixels: Vec<u32>,
+    pub pixel_w: u32,
+    pub pixel_h: u32,
+    pub width: u32,
+    pub height: u32,
+    pub generation: u32,
+}
+
+// ═══════════════════════════════════════════════════════════
+// Shared state + spinlock
+// ═══════════════════════════════════════════════════════════
+
+static JOB_LOCK: AtomicBool = AtomicBool::new(false);
+static RESULT_LOCK: AtomicBool = AtomicBool::new(false);
+static SVG_LOCK: AtomicBool = AtomicBool::new(false);
+
+static mut JOB_QUEUE: Vec<DecodeJob> = Vec::new();
+static mut RESULT_QUEUE: Vec<DecodedImage> = Vec::new();
+
+/// Number of running worker threads.
+static WORKERS: AtomicU32 = AtomicU32::new(0);
+
+/// Jobs submitted but not yet delivered as results (or dropped).
+static IN_FLIGHT: AtomicU32 = AtomicU32::new(0);
+
+fn acquire(lock: &AtomicBool) {
+    loop {
+        if lock.compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed).is_ok() {
+            return;
+        }
+        core::hint::spin_loop();
+    }
+}
+
+fn release(lock: &AtomicBool) {
+    lock.store(false, Ordering::Release);
+}
+
+// ═══════════════════════════════════════════════════════════
+// Public API (called from UI thread)
+// ═══════════════════════════════════════════════════════════
+
+/// Queue an image for decoding, starting workers as needed.
+pub(crate) fn submit(job: DecodeJob) {
+    IN_FLIGHT.fetch_add(1, Ordering::SeqCst);
+    acquire(&JOB_LOCK);
+    let queued = unsafe {
+        let q = &mut *core::ptr::addr_of_mut!(JOB_QUEUE);
+        q.push(job);
+        q.len() as u32
+    };
+    release(&JOB_LOCK);
+
+    let running = WORKERS.load(Ordering::SeqCst);
+    if running < DECODE_WORKERS && running < queued {
+        spawn_worker();
+    }
+}
+
+/// Drain all decoded images.  Cheap when nothing is ready.
+pub(crate) fn drain_results() -> Vec<DecodedImage> {
+    let maybe_empty = unsafe { (*core::ptr::addr_of!(RESULT_QUEUE)).is_empty() };
+    if maybe_empty {
+        return Vec::new();
+    }
+    acquire(&RESULT_LOCK);
+    let results = unsafe { core::mem::take(&mut *core::ptr::addr_of_mut!(RESULT_QUEUE)) };
+    release(&RESULT_LOCK);
+    IN_FLIGHT.fetch_sub(results.len() as u32, Ordering::SeqCst);
+    results
+}
+
+/// Whether decodes are still outstanding (keeps the poll timer alive).
+pub(crate) fn busy() -> bool {
+    IN_FLIGHT.load(Ordering::SeqCst) > 0
+}
+
+/// Drop queued jobs of older page loads.
+pub(crate) fn cancel_stale(generation: u32) {
+    acquire(&JOB_LOCK);
+    let dropped = unsafe {
+        let q = &mut *core::ptr::addr_of_mut!(JOB_QUEUE);
+        let before = q.len();
+        q.retain(|j| j.generation == generation);
+        before - q.len()
+    };
+    release(&JOB_LOCK);
+    IN_FLIGHT.fetch_sub(dropped as u32, Ordering::SeqCst);
+}
+
+// ═══════════════════════════════════════════════════════════
+// Worker threads
+// ═══════════════════════════════════════════════════════════
+
+fn spawn_worker() {
+    WORKERS.fetch_add(1, Ordering::SeqCst);
+    // Decoders keep their state in the heap buffers passed in; 64 KiB of
+    // stack is plenty.
+    match anyos_std::process::Thread::spawn_with_stack(worker_entry, 64 * 1024, "surf-img") {
+        Ok(handle) => core::mem::forget(handle),
+        Err(_) => {
+            anyos_std::println!("[surf-img] ERROR: failed to spawn decode thread");
+            WORKERS.fetch_sub(1, Ordering::SeqCst);
+        }
+    }
+}
+
+/// Decode jobs until the queue stays empty for ~2 seconds.
+fn worker_entry() {
+    let mut idle_count: u32 = 0;
+    loop {
+        acquire(&JOB_LOCK);
+        let job = unsafe {
+            let q = &mut *core::ptr::addr_of_mut!(JOB_QUEUE);
+            if q.is_empty() { None } else { Some(q.remove(0)) }
+        };
+        release(&JOB_LOCK);
+
+        match job {
+            Some(job) => {
+                idle_count = 0;
+                match decode(job) {
+                    Some(img) => {
+                        acquire(&RESULT_LOCK);
+                        unsafe { (*core::ptr::addr_of_mut!(RESULT_QUEUE)).push(img); }
+                        release(&RESULT_LOCK);
+                    }
+                    None => {
+                        IN_FLIGHT.fetch_sub(1, Ordering::SeqCst);
+                    }
+                }
+            }
+            None => {
+                idle_count += 1;
+                if idle_count > 400 {
+                    WORKERS.fetch_sub(1, Ordering::SeqCst);
+                    // A job queued while we were deciding saw us as running.
+                    acquire(&JOB_LOCK);
+                    let raced = unsafe { !(*core::ptr::addr_of!(JOB_QUEUE)).is_empty() };
+                    release(&JOB_LOCK);
+                    if raced {
+                        WORKERS.fetch_add(1, Ordering::SeqCst);
+                        idle_count = 0;
+                        continue;
+                    }
+                    // See net_worker: a thread must exit, not return.
+                    anyos_std::process::exit(0);
+                }
+                anyos_std::process::sleep(5);
+            }
+        }
+    }
+}
+
+fn decode(job: DecodeJob) -> Option<DecodedImage> {
+    if job.svg {
+        return decode_svg(job);
+    }
+
+    let info = libimage_client::probe(&job.body)?;
+    let (w, h) = (info.width, info.height);
+    if w == 0 || h == 0 || w > MAX_IMAGE_DIM || h > MAX_IMAGE_DIM {
+        return None;
+    }
+    let mut pixels = vec![0u32; (w * h) as usize];
+    let mut scratch = vec![0u8; info.scratch_needed as usize];
+    libimage_client::decode(&job.body, &mut pixels, &mut scratch).ok()?;
+    drop(scratch);
+
+    let (tw, th) = job.target;
+    let (pixels, pw, ph) = if tw > 0 && th > 0 && tw < w && th < h {
+        let mut scaled = vec![0u32; (tw * th) as usize];
+        if libimage_client::scale_image(&pixels, w, h, &mut scaled, tw, th, libimage_client::MODE_SCALE) {
+            (scaled, tw, th)
+        } else {
+            (pixels, w, h)
+        }
+    } else {
+        (pixels, w, h)
+    };
+
+    Some(DecodedImage {
+        tab_index: job.tab_index,
+        src: job.src,
+        pixels,
+        pixel_w: pw,
+        pixel_h: ph,
+        width: w,
+        height: h,
+        generation: job.generation,
+    })
+}
+
+fn decode_svg(job: DecodeJob) -> Option<DecodedImage> {
+    acquire(&SVG_LOCK);
+    let size = libsvg_client::probe(&job.body);
+    let (w, h) = match size {
+        Some((w, h)) => (
+            (w as u32).max(1).min(MAX_IMAGE_DIM),
+            (h as u32).max(1).min(MAX_IMAGE_DIM),
+        ),
+        None => (SVG_DEFAULT_SIZE, SVG_DEFAULT_SIZE),
+    };
+    // Vector art renders at the display size directly.
+    let (tw, th) = job.target;
+    let (rw, rh) = if tw > 0 && th > 0 && tw < w && th < h { (tw, th) } else { (w, h) };
+    let mut pixels = vec![0u32; (rw * rh) as usize];
+    let ok = libsvg_client::render_to_size(&job.body, &mut pixels, rw, rh, 0x00000000);
+    release(&SVG_LOCK);
+    if !ok {
+        return None;
+    }
+    Some(DecodedImage {
+        tab_index: job.tab_index,
+        src: job.src,
+        pixels,
+        pixel_w: rw,
+        pixel_h: rh,
+        width: w,
+        height: h,
+        generation: job.generation,
+    })
+}
@@ -3,7 +3,12 @@
 //! Built on `anyos_std::net` (tcp_connect, tcp_send, tcp_recv, tcp_close, dns).
 //! Supports GET requests with automatic redirect following (up to 20 hops),
 //! Content-Length and chunked transfer-encoding body reading, gzip/deflate
-//! content-encoding decompression, and cookie persistence.
+//! content-encoding decompression, and cookie persistence.  `fetch_streaming`
+//! additionally hands the body to the caller piece by piece as it arrives.
+//!
+//! GETs go through the shared disk cache (`libhttpcache`, also used by
+//! libhttp): fresh responses are served without a request and stale ones
+//! are revalidated with `If-None-Match` / `If-Modified-Since`.
 
 use alloc::string::String;
 use alloc::vec::Vec;
@@ -540,10 +545,49 @@ pub fn resolve_url(base: &Url, relative: &str) -> Url {
 // ---------------------------------------------------------------------------
 
 pub fn fetch(url: &Url, cookies: &mut CookieJar, pool: &mut ConnPool) -> Result<Response, FetchError> {
+    fetch_with(url, cookies, pool, None)
+}
+
+/// Like `fetch`, but hands the body of a successful, uncompressed final
+/// response to `on_body(final_url, headers, bytes)` piece by piece as it
+/// is received, so the caller can start parsing before the transfer ends.
+/// The complete body is still returned in the `Response`.
+///
+/// Compressed bodies are only delivered in the `Response`: the inflater
+/// needs the whole stream.
+pub fn fetch_streaming(
+    url: &Url,
+    cookies: &mut CookieJar,
+    pool: &mut ConnPool,
+    on_body: &mut dyn FnMut(&Url, &str, &[u8]),
+) -> Result<Response, FetchError> {
+    fetch_with(url, cookies, pool, Some(on_body))
+}
+
+fn fetch_with(
+    url: &Url,
+    cookies: &mut CookieJar,
+    pool: &mut ConnPool,
+    mut on_body: Option<&mut dyn FnMut(&Url, &str, &[u8])>,
+) -> Result<Response, FetchError> {
     let mut current = clone_url(url);
 
     for _redirect_n in 0..MAX_REDIRECTS {
         let is_https = current.scheme == "https";
+
+        // 0. Serve fresh responses from the disk cache.
+        let cache_key = libhttpcache::url_key(&current.scheme, &current.host, current.port, &current.path);
+        let cached = libhttpcache::lookup(&cache_key);
+        if let libhttpcache::Lookup::Fresh(entry) = cached {
+            anyos_std::println!("[http] cache hit {}:{}{}", current.host, current.port, current.path);
+            return Ok(Response {
+                status: entry.status,
+                headers: entry.headers,
+                body: entry.body,
+                final_url: Some(clone_url(&current)),
+            });
+        }
+
         anyos_std::println!("[http] {} GET {}:{}{}", if is_https { "HTTPS" } else { "HTTP" },
             current.host, current.port, current.path);
 
@@ -556,8 +600,9 @@ pub fn fetch(url: &Url, cookies: &mut CookieJar, pool: &mut ConnPool) -> Result<
             None => (connect_fresh(pool, &current.host, current.port, is_https)?, false),
         };
 
-        // 2. Build and send GET request.
-        let request = build_request(&current, cookies);
+        // 2. Build and send GET request (conditional if the cache has a
+        //    stale copy).
+        let request = build_request(&current, cookies, cached.stale());
         let mut send_ok = send_data(sock, request.as_bytes(), is_https);
 
         // Retry on stale pooled connection.
@@ -606,7 +651,27 @@ pub fn fetch(url: &Url, cookies: &mut CookieJar, pool: &mut ConnPool) -> Result<
         // Store cookies.
         cookies.store_from_headers(header_str, &current.host, &current.path);
 
-        // 5. Handle redirects — close connection, don't pool.
+        // 5. Not modified: no body follows, the cached copy is current.
+        if status == 304 {
+            if response_says_close(header_str) {
+                close_conn(sock, is_https);
+            } else {
+                pool.put(current.host.clone(), current.port, sock, is_https);
+            }
+            if cached.stale().is_some() {
+                if let Some(entry) = libhttpcache::refresh(&cache_key, header_str) {
+                    return Ok(Response {
+                        status: entry.status,
+                        headers: entry.headers,
+                        body: entry.body,
+                        final_url: Some(clone_url(&current)),
+                    });
+                }
+            }
+            return Ok(Response { status, headers, body: Vec::new(), final_url: Some(clone_url(&current)) });
+        }
+
+        // 6. Handle redirects — close connection, don't pool.
         if is_redirect(status) {
             close_conn(sock, is_https);
             if let Some(location) = find_header_value(header_str, "location") {
@@ -616,7 +681,7 @@ pub fn fetch(url: &Url, cookies: &mut CookieJar, pool: &mut ConnPool) -> Result<
             return Ok(Response { status, headers, body: Vec::new(), final_url: Some(clone_url(&current)) });
         }
 
-        // 6. Read body (chunked or content-length or until close).
+        // 7. Read body (chunked or content-length or until close).
         let is_chunked = find_header_value(header_str, "transfer-encoding")
             .map(|v| v.contains("chunked"))
             .unwrap_or(false);
@@ -629,19 +694,27 @@ pub fn fetch(url: &Url, cookies: &mut CookieJar, pool: &mut ConnPool) -> Result<
             trailing.extend_from_slice(&response_buf[header_end..]);
         }
 
+        // Stream the body to the caller only when it is usable as is.
+        let streamable = content_encoding.is_none() && (200..300).contains(&status);
+        let mut on_data = |data: &[u8]| {
+            if let (true, Some(f)) = (streamable, on_body.as_mut()) {
+                f(&current, header_str, data);
+            }
+        };
+
         let raw_body = if is_chunked {
             if is_https {
-                read_chunked_body_tls(&trailing)
+                read_chunked_body_tls(&trailing, &mut on_data)
             } else {
-                read_chunked_body(sock, &trailing)
+                read_chunked_body(sock, &trailing, &mut on_data)
             }
         } else if is_https {
-            read_body_tls(&trailing, content_length)
+            read_body_tls(&trailing, content_length, &mut on_data)
         } else {
-            read_body(sock, &trailing, content_length)
+            read_body(sock, &trailing, content_length, &mut on_data)
         };
 
-        // 7. Pool connection if reusable, otherwise close.
+        // 8. Pool connection if reusable, otherwise close.
         let reusable = (content_length.is_some() || is_chunked)
             && !response_says_close(header_str);
         if reusable {
@@ -650,8 +723,9 @@ pub fn fetch(url: &Url, cookies: &mut CookieJar, pool: &mut ConnPool) -> Result<
             close_conn(sock, is_https);
         }
 
-        // 8. Decompress if content-encoded.
+        // 9. Decompress if content-encoded, and cache the decoded body.
         let body = decompress_body(raw_body, &content_encoding);
+        libhttpcache::store(&cache_key, status, header_str, &body);
 
         return Ok(Response { status, headers, body, final_url: Some(clone_url(&current)) });
     }
@@ -682,7 +756,7 @@ pub fn fetch_post(url: &Url, body: &str, cookies: &mut CookieJar, pool: &mut Con
         let request = if redirect_n == 0 {
             build_post_request(&current, body, cookies)
         } else {
-            build_request(&current, cookies)
+            build_request(&current, cookies, None)
         };
 
         let mut send_ok = send_data(sock, request.as_bytes(), is_https);
@@ -748,11 +822,11 @@ pub fn fetch_post(url: &Url, body: &str, cookies: &mut CookieJar, pool: &mut Con
         }
 
         let raw_body = if is_chunked {
-            if is_https { read_chunked_body_tls(&trailing) } else { read_chunked_body(sock, &trailing) }
+            if is_https { read_chunked_body_tls(&trailing, &mut |_| {}) } else { read_chunked_body(sock, &trailing, &mut |_| {}) }
         } else if is_https {
-            read_body_tls(&trailing, content_length)
+            read_body_tls(&trailing, content_length, &mut |_| {})
         } else {
-            read_body(sock, &trailing, content_length)
+            read_body(sock, &trailing, content_length, &mut |_| {})
         };
 
         // Pool connection if reusable, otherwise close.
@@ -773,15 +847,21 @@ pub fn fetch_post(url: &Url, body: &str, cookies: &mut CookieJar, pool: &mut Con
 
 // ---------------------------------------------------------------------------
 // Body reading
+//
+// Each reader also passes every piece of body data to `on_data` as soon as
+// it is received (see `fetch_streaming`).
 // ---------------------------------------------------------------------------
 
-fn read_body(sock: u32, initial: &[u8], content_length: Option<u32>) -> Vec<u8> {
+fn read_body(sock: u32, initial: &[u8], content_length: Option<u32>, on_data: &mut dyn FnMut(&[u8])) -> Vec<u8> {
     // Pre-allocate full body size if Content-Length is known.
     let capacity = content_length
         .map(|cl| (cl as usize).min(32 * 1024 * 1024))
         .unwrap_or(65536);
     let mut body: Vec<u8> = Vec::with_capacity(capacity);
     body.extend_from_slice(initial);
+    if !initial.is_empty() {
+        on_data(initial);
+    }
 
     let mut recv_buf = [0u8; RECV_BUF_SIZE];
     loop {
@@ -791,13 +871,14 @@ fn read_body(sock: u32, initial: &[u8], content_length: Option<u32>) -> Vec<u8>
         let n = net::tcp_recv(sock, &mut recv_buf);
         if n == 0 || n == u32::MAX { break; }
         body.extend_from_slice(&recv_buf[..n as usize]);
+        on_data(&recv_buf[..n as usize]);
     }
     body
 }
 
 /// Read a chunked transfer-encoded body.
 /// Uses a cursor into the buffer to avoid repeated allocations.
-fn read_chunked_body(sock: u32, initial: &[u8]) -> Vec<u8> {
+fn read_chunked_body(sock: u32, initial: &[u8], on_data: &mut dyn FnMut(&[u8])) -> Vec<u8> {
     let mut buf: Vec<u8> = Vec::with_capacity(RECV_BUF_SIZE * 4);
     buf.extend_from_slice(initial);
     let mut cursor: usize = 0; // read position in buf
@@ -835,6 +916,7 @@ fn read_chunked_body(sock: u32, initial: &[u8]) -> Vec<u8> {
 
         let available = (buf.len() - cursor).min(chunk_size);
         body.extend_from_slice(&buf[cursor..cursor + available]);
+        on_data(&buf[cursor..cursor + available]);
         cursor += available;
 
         // Skip trailing CRLF after chunk data
@@ -861,12 +943,15 @@ fn read_chunked_body(sock: u32, initial: &[u8]) -> Vec<u8> {
 // TLS body reading (uses crate::tls::recv instead of tcp_recv)
 // ---------------------------------------------------------------------------
 
-fn read_body_tls(initial: &[u8], content_length: Option<u32>) -> Vec<u8> {
+fn read_body_tls(initial: &[u8], content_length: Option<u32>, on_data: &mut dyn FnMut(&[u8])) -> Vec<u8> {
     let capacity = content_length
         .map(|cl| (cl as usize).min(32 * 1024 * 1024))
         .unwrap_or(65536);
     let mut body: Vec<u8> = Vec::with_capacity(capacity);
     body.extend_from_slice(initial);
+    if !initial.is_empty() {
+        on_data(initial);
+    }
 
     let mut recv_buf = [0u8; RECV_BUF_SIZE];
     loop {
@@ -876,11 +961,12 @@ fn read_body_tls(initial: &[u8], content_length: Option<u32>) -> Vec<u8> {
         let n = crate::tls::recv(&mut recv_buf);
         if n <= 0 { break; }
         body.extend_from_slice(&recv_buf[..n as usize]);
+        on_data(&recv_buf[..n as usize]);
     }
     body
 }
 
-fn read_chunked_body_tls(initial: &[u8]) -> Vec<u8> {
+fn read_chunked_body_tls(initial: &[u8], on_data: &mut dyn FnMut(&[u8])) -> Vec<u8> {
     let mut buf: Vec<u8> = Vec::with_capacity(RECV_BUF_SIZE * 4);
     buf.extend_from_slice(initial);
     let mut cursor: usize = 0;
@@ -915,6 +1001,7 @@ fn read_chunked_body_tls(initial: &[u8]) -> Vec<u8> {
 
         let available = (buf.len() - cursor).min(chunk_size);
         body.extend_from_slice(&buf[cursor..cursor + available]);
+        on_data(&buf[cursor..cursor + available]);
         cursor += available;
 
         // Skip trailing CRLF
@@ -1023,15 +1110,23 @@ fn parse_content_length(headers: &str) -> Option<u32> {
     parse_u32(val)
 }
 
-fn build_request(url: &Url, cookies: &CookieJar) -> String {
-    build_request_with_method(url, "GET", None, cookies)
+fn build_request(url: &Url, cookies: &CookieJar, cached: Option<&libhttpcache::Entry>) -> String {
+    build_request_with_method(url, "GET", None, cookies, cached)
 }
 
 fn build_post_request(url: &Url, body: &str, cookies: &CookieJar) -> String {
-    build_request_with_method(url, "POST", Some(body), cookies)
+    build_request_with_method(url, "POST", Some(body), cookies, None)
 }
 
-fn build_request_with_method(url: &Url, method: &str, body: Option<&str>, cookies: &CookieJar) -> String {
+/// Build a request; a stale `cached` entry adds its validators as
+/// conditional headers.
+fn build_request_with_method(
+    url: &Url,
+    method: &str,
+    body: Option<&str>,
+    cookies: &CookieJar,
+    cached: Option<&libhttpcache::Entry>,
+) -> String {
     let mut req = String::new();
     req.push_str(method);
     req.push(' ');
@@ -1047,6 +1142,17 @@ fn build_request_with_method(url: &Url, method: &str, body: Option<&str>, cookie
     req.push_str("\r\nAccept-Encoding: gzip, deflate");
     req.push_str("\r\nConnection: keep-alive");
 
+    if let Some(entry) = cached {
+        if let Some(etag) = entry.etag() {
+            req.push_str("\r\nIf-None-Match: ");
+            req.push_str(etag);
+        }
+        if let Some(modified) = entry.last_modified() {
+            req.push_str("\r\nIf-Modified-Since: ");
+            req.push_str(modified);
+        }
+    }
+
     if let Some(body) = body {
         req.push_str("\r\nContent-Type: application/x-www-form-urlencoded");
         req.push_str("\r\nContent-Length: ");
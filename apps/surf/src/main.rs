@@ -19,6 +19,7 @@ mod ui;
 mod callbacks;
 mod ws;
 mod net_worker;
+mod decoder;
 
 anyos_std::entry!(main);
 
@@ -245,7 +246,19 @@ fn start_net_poll_timer() {
     static mut EMPTY_POLLS: u32 = 0;
     st.net_poll_timer = ui_lib::set_timer(50, || {
         let results = net_worker::drain_results();
+        let decoded = decoder::drain_results();
+        let any_decoded = !decoded.is_empty();
+        for img in decoded {
+            let tab_index = img.tab_index;
+            if handle_image_decoded(img) {
+                mark_relayout_dirty(tab_index);
+            }
+        }
         if results.is_empty() {
+            if any_decoded || decoder::busy() {
+                unsafe { EMPTY_POLLS = 0; }
+                return;
+            }
             unsafe { EMPTY_POLLS += 1; }
             if unsafe { EMPTY_POLLS } > 60 {
                 unsafe { EMPTY_POLLS = 0; }
@@ -271,13 +284,21 @@ pub(crate) fn ensure_net_poll_timer() {
 ///
 /// CSS and image results set per-tab dirty flags instead of triggering
 /// immediate relayouts.  A separate debounce timer (`flush_relayout`)
-/// coalesces all pending relayouts into one pass every 300 ms.
+/// coalesces all pending relayouts into one pass every 300 ms.  HTML of a
+/// page still loading is parsed as it arrives and rendered once per batch
+/// (see `render_streamed_page`).
 fn process_fetched_results(results: Vec<net_worker::FetchResult>) {
+    let mut streamed = false;
     for result in results {
         match result {
             net_worker::FetchResult::NavDone { response, url, cookies, generation } => {
                 handle_nav_done(response, url, cookies, generation);
             }
+            net_worker::FetchResult::NavChunk { start, data, generation } => {
+                if handle_nav_chunk(start, data, generation) {
+                    streamed = true;
+                }
+            }
             net_worker::FetchResult::NavError { error_msg, generation } => {
                 handle_nav_error(error_msg, generation);
             }
@@ -293,6 +314,9 @@ fn process_fetched_results(results: Vec<net_worker::FetchResult>) {
             }
         }
     }
+    if streamed {
+        render_streamed_page();
+    }
 }
 
 /// Mark a tab as needing a relayout and start the debounce timer if not
@@ -340,6 +364,67 @@ fn flush_relayout() {
     }
 }
 
+/// Minimum time between two partial renders of a page that is still loading.
+const PARTIAL_RENDER_MS: u32 = 200;
+
+/// Handle a piece of a navigation's HTML body: start the streamed page on
+/// the first piece, then parse each piece as it arrives.
+///
+/// Returns `true` if the piece was fed to the active tab's page.
+fn handle_nav_chunk(start: Option<(http::Url, String)>, data: Vec<u8>, generation: u32) -> bool {
+    let st = state();
+    let tab_idx = st.active_tab;
+    if st.tabs[tab_idx].nav_generation != generation {
+        return false;
+    }
+
+    if let Some((base_url, headers)) = start {
+        // Other charsets are transcoded and parsed whole in handle_nav_done().
+        if !resources::streams_as_utf8(&data, &headers) {
+            return false;
+        }
+        let url_str = ui::format_url(&base_url);
+        let tab = &mut st.tabs[tab_idx];
+        tab.webview.clear_stylesheets();
+        tab.webview.set_url(&url_str);
+        tab.webview.begin_html();
+        tab.requested.clear();
+        tab.stream = Some(tab::PageStream { generation, base_url, last_render_ms: None });
+    }
+
+    let tab = &mut st.tabs[tab_idx];
+    match &tab.stream {
+        Some(s) if s.generation == generation => {}
+        _ => return false,
+    }
+    tab.webview.feed_html(&data);
+    true
+}
+
+/// Show a page that is still loading: start fetching the subresources its
+/// parser discovered, and render what has arrived — right after the first
+/// chunk, then at most every `PARTIAL_RENDER_MS`.
+fn render_streamed_page() {
+    let st = state();
+    let tab_idx = st.active_tab;
+    let tab = &mut st.tabs[tab_idx];
+    let stream = match tab.stream.as_mut() {
+        Some(s) => s,
+        None => return,
+    };
+
+    let preloads = tab.webview.take_preloads();
+    resources::queue_preloads(preloads, &stream.base_url, tab_idx, &mut tab.requested);
+
+    let now = anyos_std::sys::uptime_ms();
+    let due = stream.last_render_ms.map_or(true, |t| now.wrapping_sub(t) >= PARTIAL_RENDER_MS);
+    if due {
+        tab.webview.render_partial();
+        stream.last_render_ms = Some(now);
+        ensure_anim_timer();
+    }
+}
+
 /// Handle a completed navigation fetch: decode body, render HTML, update
 /// history, queue external resources.
 fn handle_nav_done(
@@ -356,6 +441,12 @@ fn handle_nav_done(
         return;
     }
 
+    // Whether the body was already parsed as it arrived.
+    let was_streamed = match st.tabs[tab_idx].stream.take() {
+        Some(s) => s.generation == generation,
+        None => false,
+    };
+
     // Merge cookies that the worker collected during the fetch.
     merge_cookies(worker_cookies);
 
@@ -371,18 +462,21 @@ fn handle_nav_done(
     st.tabs[tab_idx].status_text = String::from("Rendering...");
     ui::update_status();
 
-    // Decode response body (charset detection + Latin-1 transcoding).
-    let body_text = resources::decode_http_body(&response.body, &response.headers);
-
     // Determine base URL (post-redirect URL takes precedence).
     let base_url = response.final_url.unwrap_or(original_url);
     let url_str = ui::format_url(&base_url);
 
-    // Clear stylesheets from the previous page.
-    st.tabs[tab_idx].webview.clear_stylesheets();
+    // A streamed page only needs finishing — unless it turned out not to be
+    // UTF-8 after all, in which case it is decoded and parsed again whole.
+    let streamed = was_streamed && core::str::from_utf8(&response.body).is_ok();
+    if !streamed {
+        // Clear stylesheets from the previous page.
+        st.tabs[tab_idx].webview.clear_stylesheets();
+        st.tabs[tab_idx].webview.set_url(&url_str);
+        st.tabs[tab_idx].requested.clear();
+    }
 
-    // Set URL and cookies on the JS runtime before rendering.
-    st.tabs[tab_idx].webview.set_url(&url_str);
+    // Set cookies on the JS runtime before scripts run.
     let is_secure = base_url.scheme == "https";
     if let Some(cookie_hdr) = st.cookies.cookie_header(&base_url.host, &base_url.path, is_secure) {
         st.tabs[tab_idx].webview.js_runtime().set_cookies(&cookie_hdr);
@@ -391,7 +485,13 @@ fn handle_nav_done(
     }
 
     // Parse and render the HTML document.
-    st.tabs[tab_idx].webview.set_html(&body_text);
+    if streamed {
+        st.tabs[tab_idx].webview.finish_html();
+    } else {
+        // Decode response body (charset detection + Latin-1 transcoding).
+        let body_text = resources::decode_http_body(&response.body, &response.headers);
+        st.tabs[tab_idx].webview.set_html(&body_text);
+    }
 
     // Flush JS console output to serial log.
     for line in st.tabs[tab_idx].webview.js_console() {
@@ -437,10 +537,13 @@ fn handle_nav_done(
     // Connect any WebSockets that JS requested during set_html().
     connect_pending_ws(tab_idx);
 
-    // Queue external CSS and images for async fetch via the worker thread.
-    if let Some(dom) = st.tabs[tab_idx].webview.dom() {
-        resources::queue_stylesheets(dom, &base_url, tab_idx);
-        resources::queue_images(dom, &base_url, tab_idx);
+    // Queue external CSS and images for async fetch via the worker thread
+    // (those preloaded while the page streamed in are skipped).
+    let tab = &mut st.tabs[tab_idx];
+    let _ = tab.webview.take_preloads();
+    if let Some(dom) = tab.webview.dom() {
+        resources::queue_stylesheets(dom, &base_url, tab_idx, &mut tab.requested);
+        resources::queue_images(dom, &base_url, tab_idx, &mut tab.requested);
     }
 
     // Restart animation/scroll tick timer (may have been stopped while idle).
@@ -479,10 +582,11 @@ fn handle_css_done(
     true
 }
 
-/// Handle a completed image fetch: decode SVG or raster and add to cache.
+/// Handle a completed image fetch: reserve the image's size and hand it to
+/// the decode workers.
 ///
-/// Returns `true` if the image was decoded and a relayout is needed.
-/// The caller batches relayouts to avoid redundant work.
+/// Returns `true` if layout should run to give the `<img>` boxes their
+/// natural size.  The pixels arrive later through `handle_image_decoded`.
 fn handle_image_done(
     tab_index: usize,
     src: String,
@@ -495,10 +599,39 @@ fn handle_image_done(
     if st.tabs[tab_index].nav_generation != generation { return false; }
 
     if resources::is_svg(&src, &headers) {
-        resources::decode_svg_no_relayout(&body, &src, tab_index);
-    } else {
-        resources::decode_raster_no_relayout(&body, &src, tab_index);
+        decoder::submit(decoder::DecodeJob {
+            tab_index, src, body, svg: true, target: (0, 0), generation,
+        });
+        return false;
+    }
+
+    // Header sniff only; the decode happens off the UI thread.
+    let info = match libimage_client::probe(&body) {
+        Some(i) => i,
+        None => return false,
+    };
+    let (w, h) = (info.width, info.height);
+    if w == 0 || h == 0 || w > decoder::MAX_IMAGE_DIM || h > decoder::MAX_IMAGE_DIM {
+        return false;
     }
+    let webview = &mut st.tabs[tab_index].webview;
+    webview.reserve_image(&src, w, h);
+    let target = webview.image_display_size(&src, w, h);
+    decoder::submit(decoder::DecodeJob {
+        tab_index, src, body, svg: false, target, generation,
+    });
+    true
+}
+
+/// Hand a decoded image to its tab.  Returns `true` if a relayout is needed
+/// to show it (the renderer then repaints just the image's tiles).
+fn handle_image_decoded(img: decoder::DecodedImage) -> bool {
+    let st = state();
+    if img.tab_index >= st.tabs.len() { return false; }
+    if st.tabs[img.tab_index].nav_generation != img.generation { return false; }
+    st.tabs[img.tab_index].webview.add_image_scaled(
+        &img.src, img.pixels, img.pixel_w, img.pixel_h, img.width, img.height,
+    );
     true
 }
 
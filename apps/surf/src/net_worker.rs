@@ -58,6 +58,13 @@ pub(crate) enum FetchResult {
         cookies: CookieJar,
         generation: u32,
     },
+    /// Part of the HTML body of a navigation that is still being received.
+    /// The first chunk carries the final URL and the response headers.
+    NavChunk {
+        start: Option<(Url, String)>,
+        data: Vec<u8>,
+        generation: u32,
+    },
     /// Navigation failed.
     NavError {
         error_msg: &'static str,
@@ -214,7 +221,8 @@ pub(crate) fn new_generation() -> u32 {
         if let Some(q) = RESULT_QUEUE.as_mut() {
             q.retain(|r| match r {
                 FetchResult::NavDone { .. } | FetchResult::NavError { .. } => true,
-                FetchResult::CssDone { generation, .. }
+                FetchResult::NavChunk { generation, .. }
+                | FetchResult::CssDone { generation, .. }
                 | FetchResult::ImageDone { generation, .. } => *generation == gen,
             });
         }
@@ -307,6 +315,7 @@ fn worker_entry() {
                     // Must store false BEFORE exiting so ensure_worker() can
                     // respawn.  Cannot `return` — the stack has no valid
                     // return address (mmap zeroes it), so RIP would become 0.
+                    libhttpcache::flush();
                     WORKER_STARTED.store(false, Ordering::SeqCst);
                     anyos_std::println!("[surf-net] worker idle, exiting");
                     anyos_std::process::exit(0);
@@ -368,7 +377,19 @@ fn process_request(req: FetchRequest, pool: &mut ConnPool, cache: &mut SubResour
             anyos_std::println!("[surf-net] navigate: {}://{}{}",
                 url.scheme, url.host, url.path);
 
-            match http::fetch(&url, &mut cookies, pool) {
+            // Forward the body as it arrives so the page renders progressively.
+            let mut started = false;
+            let mut on_body = |final_url: &Url, headers: &str, data: &[u8]| {
+                let start = if started {
+                    None
+                } else {
+                    Some((http::clone_url(final_url), String::from(headers)))
+                };
+                started = true;
+                enqueue_result(FetchResult::NavChunk { start, data: data.to_vec(), generation });
+            };
+
+            match http::fetch_streaming(&url, &mut cookies, pool, &mut on_body) {
                 Ok(response) => {
                     enqueue_result(FetchResult::NavDone {
                         response,
@@ -7,6 +7,7 @@
 //! - HTTP response body decoding (charset detection, Latin-1 → UTF-8)
 //! - External CSS stylesheet discovery and submission to the network worker
 //! - External image discovery and submission to the network worker
+//! - Speculative preloading of resources found while a page streams in
 //! - SVG rasterisation and raster image decoding (called from result handlers)
 
 use alloc::string::String;
@@ -42,6 +43,23 @@ pub(crate) fn decode_http_body(body: &[u8], headers: &str) -> String {
     }
 }
 
+/// Whether a document whose body starts with `head` can be parsed as it
+/// streams in, i.e. is UTF-8 (by declaration, or undeclared and valid so
+/// far).  Other charsets are transcoded once the whole body has arrived.
+pub(crate) fn streams_as_utf8(head: &[u8], headers: &str) -> bool {
+    let charset = detect_charset_from_headers(headers)
+        .or_else(|| detect_charset_from_html_bytes(head));
+    match charset.as_deref() {
+        Some("utf-8") | Some("utf8") => true,
+        // A chunk may end inside a multi-byte sequence.
+        None => match core::str::from_utf8(head) {
+            Ok(_) => true,
+            Err(e) => e.error_len().is_none(),
+        },
+        _ => false,
+    }
+}
+
 /// Extract the charset from the `Content-Type` response header, if present.
 fn detect_charset_from_headers(headers: &str) -> Option<String> {
     let ct = crate::http::find_header_value(headers, "content-type")?;
@@ -110,12 +128,14 @@ fn latin1_to_utf8(bytes: &[u8]) -> String {
 /// The page is rendered immediately with only the built-in user-agent CSS;
 /// each external stylesheet is applied and the layout refreshed as it arrives,
 /// giving a progressive-rendering effect without blocking the UI thread.
+/// Hrefs already in `requested` (preloaded while the page streamed in) are
+/// skipped.
 pub(crate) fn queue_stylesheets(
     dom: &libwebview::dom::Dom,
     base_url: &crate::http::Url,
     tab_index: usize,
+    requested: &mut Vec<String>,
 ) {
-    let generation = crate::net_worker::current_generation();
     let mut count = 0u32;
 
     for (i, node) in dom.nodes.iter().enumerate() {
@@ -129,14 +149,7 @@ pub(crate) fn queue_stylesheets(
                 continue;
             }
             if let Some(href) = dom.attr(i, "href") {
-                if !href.is_empty() {
-                    let css_url = crate::http::resolve_url(base_url, href);
-                    crate::net_worker::submit(crate::net_worker::FetchRequest::Css {
-                        tab_index,
-                        href: String::from(href),
-                        url: css_url,
-                        generation,
-                    });
+                if !href.is_empty() && submit_css(href, base_url, tab_index, requested) {
                     count += 1;
                 }
             }
@@ -149,18 +162,34 @@ pub(crate) fn queue_stylesheets(
     }
 }
 
+/// Submit one stylesheet unless it was requested already.
+fn submit_css(href: &str, base_url: &crate::http::Url, tab_index: usize, requested: &mut Vec<String>) -> bool {
+    if requested.iter().any(|r| r == href) {
+        return false;
+    }
+    requested.push(String::from(href));
+    crate::net_worker::submit(crate::net_worker::FetchRequest::Css {
+        tab_index,
+        href: String::from(href),
+        url: crate::http::resolve_url(base_url, href),
+        generation: crate::net_worker::current_generation(),
+    });
+    true
+}
+
 // ═══════════════════════════════════════════════════════════
 // Image discovery — submits to network worker
 // ═══════════════════════════════════════════════════════════
 
 /// Scan the DOM for `<img src="…">` tags and submit them to the background
-/// network worker for async fetching.
+/// network worker for async fetching.  Sources already in `requested` are
+/// skipped.
 pub(crate) fn queue_images(
     dom: &libwebview::dom::Dom,
     base_url: &crate::http::Url,
     tab_index: usize,
+    requested: &mut Vec<String>,
 ) {
-    let generation = crate::net_worker::current_generation();
     let mut count = 0u32;
 
     for (i, node) in dom.nodes.iter().enumerate() {
@@ -173,14 +202,9 @@ pub(crate) fn queue_images(
                 if src.is_empty() || src.starts_with("data:") {
                     continue;
                 }
-                let img_url = crate::http::resolve_url(base_url, src);
-                crate::net_worker::submit(crate::net_worker::FetchRequest::Image {
-                    tab_index,
-                    src: String::from(src),
-                    url: img_url,
-                    generation,
-                });
-                count += 1;
+                if submit_image(src, base_url, tab_index, requested) {
+                    count += 1;
+                }
             }
         }
     }
@@ -191,8 +215,58 @@ pub(crate) fn queue_images(
     }
 }
 
+/// Submit one image unless it was requested already.
+fn submit_image(src: &str, base_url: &crate::http::Url, tab_index: usize, requested: &mut Vec<String>) -> bool {
+    if requested.iter().any(|r| r == src) {
+        return false;
+    }
+    requested.push(String::from(src));
+    crate::net_worker::submit(crate::net_worker::FetchRequest::Image {
+        tab_index,
+        src: String::from(src),
+        url: crate::http::resolve_url(base_url, src),
+        generation: crate::net_worker::current_generation(),
+    });
+    true
+}
+
 // ═══════════════════════════════════════════════════════════
-// Image decode helpers (called from main.rs result handlers)
+// Speculative preloading
+// ═══════════════════════════════════════════════════════════
+
+/// Submit the subresources the HTML parser discovered in a document that
+/// is still streaming in, ahead of the final DOM scan.
+///
+/// External scripts are not fetched: the JS runtime only runs inline
+/// `<script>` blocks.
+pub(crate) fn queue_preloads(
+    preloads: Vec<libwebview::html::Preload>,
+    base_url: &crate::http::Url,
+    tab_index: usize,
+    requested: &mut Vec<String>,
+) {
+    use libwebview::html::PreloadKind;
+
+    let mut count = 0u32;
+    for p in preloads {
+        let submitted = match p.kind {
+            PreloadKind::Stylesheet => submit_css(&p.url, base_url, tab_index, requested),
+            PreloadKind::Image => submit_image(&p.url, base_url, tab_index, requested),
+            PreloadKind::Script => false,
+        };
+        if submitted {
+            count += 1;
+        }
+    }
+
+    if count > 0 {
+        anyos_std::println!("[surf] preloading {} resource(s)", count);
+        crate::ensure_net_poll_timer();
+    }
+}
+
+// ═══════════════════════════════════════════════════════════
+// Image helpers (called from main.rs result handlers)
 // ═══════════════════════════════════════════════════════════
 
 /// Returns `true` when the fetched resource is an SVG document, detected
@@ -213,68 +287,3 @@ pub(crate) fn is_svg(src: &str, headers: &str) -> bool {
     }
     false
 }
-
-/// Decode a raster image (PNG, JPEG, BMP, GIF) and add the result to the
-/// image cache of `tab_idx`, then relayout.
-pub(crate) fn decode_raster(data: &[u8], src: &str, tab_idx: usize) {
-    decode_raster_no_relayout(data, src, tab_idx);
-    let st = crate::state();
-    if tab_idx < st.tabs.len() {
-        st.tabs[tab_idx].webview.relayout();
-    }
-}
-
-/// Decode a raster image without triggering a relayout.
-///
-/// Used by the batch result processor which does a single relayout at the end.
-pub(crate) fn decode_raster_no_relayout(data: &[u8], src: &str, tab_idx: usize) {
-    let info = match libimage_client::probe(data) {
-        Some(i) => i,
-        None => return,
-    };
-    let w = info.width;
-    let h = info.height;
-    if w == 0 || h == 0 || w > 4096 || h > 4096 {
-        return;
-    }
-    let mut pixels = vec![0u32; (w * h) as usize];
-    let mut scratch = vec![0u8; info.scratch_needed as usize];
-    if libimage_client::decode(data, &mut pixels, &mut scratch).is_ok() {
-        let st = crate::state();
-        if tab_idx < st.tabs.len() {
-            st.tabs[tab_idx].webview.add_image(src, pixels, w, h);
-        }
-    }
-}
-
-/// Rasterise an SVG document and add the result to the image cache of
-/// `tab_idx`, then relayout.
-pub(crate) fn decode_svg(data: &[u8], src: &str, tab_idx: usize) {
-    decode_svg_no_relayout(data, src, tab_idx);
-    let st = crate::state();
-    if tab_idx < st.tabs.len() {
-        st.tabs[tab_idx].webview.relayout();
-    }
-}
-
-/// Rasterise an SVG document without triggering a relayout.
-///
-/// Used by the batch result processor which does a single relayout at the end.
-pub(crate) fn decode_svg_no_relayout(data: &[u8], src: &str, tab_idx: usize) {
-    let (rw, rh) = match libsvg_client::probe(data) {
-        Some((w, h)) => {
-            let w = (w as u32).max(1).min(4096);
-            let h = (h as u32).max(1).min(4096);
-            (w, h)
-        }
-        None => (256, 256),
-    };
-
-    let mut pixels = vec![0u32; (rw * rh) as usize];
-    if libsvg_client::render_to_size(data, &mut pixels, rw, rh, 0x00000000) {
-        let st = crate::state();
-        if tab_idx < st.tabs.len() {
-            st.tabs[tab_idx].webview.add_image(src, pixels, rw, rh);
-        }
-    }
-}
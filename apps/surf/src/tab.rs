@@ -37,13 +37,30 @@ pub(crate) struct TabState {
     /// Generation counter for the current navigation.
     /// Used to discard stale fetch results from the worker thread.
     pub(crate) nav_generation: u32,
+    /// Navigation whose HTML is being parsed while it downloads.
+    pub(crate) stream: Option<PageStream>,
+    /// Stylesheet hrefs and image srcs already submitted for this page.
+    pub(crate) requested: Vec<String>,
+}
+
+/// A page rendered progressively as its HTML arrives.
+pub(crate) struct PageStream {
+    /// Navigation generation the stream belongs to.
+    pub(crate) generation: u32,
+    /// Final (post-redirect) URL, for resolving subresources.
+    pub(crate) base_url: crate::http::Url,
+    /// Uptime in ms of the last partial render (`None` before the first).
+    pub(crate) last_render_ms: Option<u32>,
 }
 
 impl TabState {
     /// Create a new, blank tab.
     pub(crate) fn new() -> Self {
+        let mut webview = libwebview::WebView::new(900, 606);
+        // Keep compiled page scripts next to the localStorage files.
+        webview.js_runtime().set_script_cache_dir(Some("/tmp"));
         Self {
-            webview: libwebview::WebView::new(900, 606),
+            webview,
             url_text: String::new(),
             current_url: None,
             page_title: String::new(),
@@ -51,6 +68,8 @@ impl TabState {
             history_pos: 0,
             status_text: String::from("Ready"),
             nav_generation: 0,
+            stream: None,
+            requested: Vec::new(),
         }
     }
 
@@ -110,6 +129,7 @@ pub(crate) fn navigate(url_str: &str) {
 
     // Bump generation so stale resource results are discarded.
     let generation = crate::net_worker::new_generation();
+    crate::decoder::cancel_stale(generation);
     st.tabs[st.active_tab].nav_generation = generation;
 
     // Update UI to show loading state.
@@ -149,6 +169,7 @@ pub(crate) fn navigate_post(url_str: &str, body: &str) {
     cancel_pending_resources();
 
     let generation = crate::net_worker::new_generation();
+    crate::decoder::cancel_stale(generation);
     st.tabs[st.active_tab].nav_generation = generation;
 
     st.tabs[st.active_tab].status_text = String::from("Submitting...");
@@ -0,0 +1,203 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Prefetching frame decoder.
+//!
+//! Worker threads decode the frames ahead of the playhead into a ring of
+//! [`RING`] slots, so presenting a frame is a buffer swap instead of a JPEG
+//! decode on the UI thread.  Frames are named by a sequence number that
+//! keeps counting across loops (`frame = seq % num_frames`), which lets the
+//! workers run on into the next pass before the playhead wraps.
+//!
+//! Slot `seq % RING` holds frame `seq` for every `seq` in the window
+//! `base..base + RING`; `next` is the first one no worker has claimed yet.
+//! A claim is checked again once the decode finishes, so a frame the
+//! presenter gave up on — or one from before a [`seek`](Decoder::seek) —
+//! is thrown away instead of landing in a reused slot.
+
+use anyos_std::sync::{Condvar, Mutex};
+use anyos_std::{vec, Vec};
+
+/// Decoded frames kept ahead of the playhead.
+pub const RING: usize = 8;
+/// Upper bound on decode threads.
+const MAX_WORKERS: usize = 3;
+/// Stack of a decode thread (the JPEG decoder keeps its tables on it).
+const WORKER_STACK_SIZE: usize = 256 * 1024;
+
+const NONE: u64 = u64::MAX;
+
+struct Slot {
+    /// Frame held or being decoded, or [`NONE`].
+    seq: u64,
+    ready: bool,
+    pixels: Vec<u32>,
+}
+
+struct Queue {
+    data: &'static [u8],
+    num_frames: u32,
+    frame_len: usize,
+    scratch_len: usize,
+    /// Bumped by every seek; claims from an older one are stale.
+    gen: u32,
+    base: u64,
+    next: u64,
+    slots: Vec<Slot>,
+}
+
+static QUEUE: Mutex<Queue> = Mutex::new(Queue {
+    data: &[],
+    num_frames: 0,
+    frame_len: 0,
+    scratch_len: 0,
+    gen: 0,
+    base: 0,
+    next: 0,
+    slots: Vec::new(),
+});
+/// Signalled when a claim may have become possible.
+static WORK: Condvar = Condvar::new();
+
+/// Handle to the decode threads (they live as long as the process).
+pub struct Decoder;
+
+impl Decoder {
+    /// Start decoding `data` from frame 0.  Returns `None` if no decode
+    /// thread could be started.
+    pub fn start(data: &'static [u8], info: &libimage_client::VideoInfo) -> Option<Decoder> {
+        let frame_len = info.width as usize * info.height as usize;
+        {
+            let mut q = QUEUE.lock();
+            q.data = data;
+            q.num_frames = info.num_frames;
+            q.frame_len = frame_len;
+            q.scratch_len = info.scratch_needed as usize;
+            q.slots = (0..RING).map(|_| Slot { seq: NONE, ready: false, pixels: vec![0; frame_len] }).collect();
+        }
+
+        // One core stays with the UI thread
+        let cpus = anyos_std::sys::sysinfo(2, &mut [0u8; 4]) as usize;
+        let wanted = cpus.saturating_sub(1).clamp(1, MAX_WORKERS);
+        let mut started = 0;
+        for _ in 0..wanted {
+            let stack = anyos_std::process::mmap(WORKER_STACK_SIZE) as usize;
+            if stack == 0 {
+                break;
+            }
+            // x86_64 ABI: RSP must be STACK_TOP - 8 at function entry
+            let top = stack + WORKER_STACK_SIZE - 8;
+            if anyos_std::process::thread_create(worker_main, top, "vp-decode") == 0 {
+                break;
+            }
+            started += 1;
+        }
+        if started == 0 { None } else { Some(Decoder) }
+    }
+
+    /// Drop everything decoded and continue from frame `seq`.
+    pub fn seek(&self, seq: u64) {
+        let mut q = QUEUE.lock();
+        q.gen = q.gen.wrapping_add(1);
+        q.base = seq;
+        q.next = seq;
+        for slot in q.slots.iter_mut() {
+            slot.seq = NONE;
+            slot.ready = false;
+        }
+        drop(q);
+        WORK.notify_all();
+    }
+
+    /// Hand out the newest decoded frame due by `target`, swapping its
+    /// pixels into `out`.  Decoded frames older than it are dropped, and
+    /// late frames no worker has started on are skipped, so a slow decode
+    /// costs frames rather than time.  Returns the frame's sequence number,
+    /// or `None` if no new frame is ready yet.
+    pub fn take(&self, target: u64, out: &mut Vec<u32>) -> Option<u64> {
+        let mut q = QUEUE.lock();
+        let (mut base, next) = (q.base, q.next);
+
+        let mut best: Option<usize> = None;
+        for (i, slot) in q.slots.iter().enumerate() {
+            if slot.ready && slot.seq >= base && slot.seq <= target
+                && best.map_or(true, |b| slot.seq > q.slots[b].seq)
+            {
+                best = Some(i);
+            }
+        }
+        let shown = best.map(|i| {
+            let slot = &mut q.slots[i];
+            core::mem::swap(&mut slot.pixels, out);
+            slot.seq
+        });
+        if let Some(seq) = shown {
+            base = seq + 1;
+        }
+
+        // Move the window up to the first frame still worth waiting for
+        let next = next.max(target);
+        let first_claimed = q.slots.iter()
+            .map(|s| s.seq)
+            .filter(|&seq| seq != NONE && seq >= base)
+            .min()
+            .unwrap_or(next);
+        base = base.max(first_claimed.min(target));
+        for slot in q.slots.iter_mut() {
+            if slot.seq != NONE && slot.seq < base {
+                slot.seq = NONE;
+                slot.ready = false;
+            }
+        }
+        let moved = base != q.base || next != q.next;
+        q.base = base;
+        q.next = next.max(base);
+        drop(q);
+
+        if moved {
+            WORK.notify_all();
+        }
+        shown
+    }
+}
+
+fn worker_main() {
+    let (data, num_frames, frame_len, scratch_len) = {
+        let q = QUEUE.lock();
+        (q.data, q.num_frames, q.frame_len, q.scratch_len)
+    };
+    let mut pixels = vec![0u32; frame_len];
+    let mut scratch = vec![0u8; scratch_len];
+
+    loop {
+        // Claim the next frame inside the window
+        let (seq, gen) = {
+            let mut q = QUEUE.lock();
+            while q.next >= q.base + RING as u64 {
+                q = WORK.wait(q);
+            }
+            let seq = q.next;
+            q.next += 1;
+            let slot = &mut q.slots[(seq % RING as u64) as usize];
+            slot.seq = seq;
+            slot.ready = false;
+            (seq, q.gen)
+        };
+
+        let frame = (seq % num_frames as u64) as u32;
+        let ok = libimage_client::video_decode_frame(data, num_frames, frame, &mut pixels, &mut scratch).is_ok();
+
+        let mut q = QUEUE.lock();
+        let current = q.gen == gen;
+        let slot = &mut q.slots[(seq % RING as u64) as usize];
+        if current && slot.seq == seq {
+            if ok {
+                core::mem::swap(&mut slot.pixels, &mut pixels);
+                slot.ready = true;
+            } else {
+                // An undecodable frame is skipped like a late one
+                slot.seq = NONE;
+            }
+        }
+    }
+}
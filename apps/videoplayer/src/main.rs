@@ -2,13 +2,22 @@
 // SPDX-License-Identifier: MIT
 
 //! Video Player — plays MJV (Motion JPEG Video) files.
+//!
+//! Frames are decoded ahead of time by the worker threads in [`decoder`];
+//! the UI timer only picks the frame due now.  Time is kept in 48 kHz
+//! sample frames: with an audio track the clock is the sound card's DMA
+//! position, so the picture follows the sound; otherwise it is uptime.
 
 #![no_std]
 #![no_main]
 
+mod decoder;
+
 use anyos_std::{Vec, vec};
+use anyos_std::audio;
 use libanyui_client as anyui;
 use anyui::Widget;
+use decoder::Decoder;
 
 anyos_std::entry!(main);
 
@@ -16,23 +25,45 @@ const BG: u32 = 0xFF1E1E1E;
 const CONTROLS_H: u32 = 32;
 const KEY_SPACE: u32 = 0x104;
 
+/// Audio sample rate, and the unit of the playback clock.
+const SAMPLE_RATE: u64 = 48000;
+/// Audio kept queued ahead of the DMA position (200 ms).
+const AUDIO_AHEAD: u32 = 9600;
+/// Largest single audio write.
+const AUDIO_CHUNK: usize = 16 * 1024;
+
 struct AppState {
     canvas: anyui::Canvas,
-    data: Vec<u8>,
+    decoder: Decoder,
     num_frames: u32,
     fps: u32,
     vid_w: usize,
     vid_h: usize,
+    /// Frame on screen.
     pixels: Vec<u32>,
-    scratch: Vec<u8>,
     render_buf: Vec<u32>,
     current_frame: u32,
+    /// Decoder sequence number of frame 0 in the current pass.
+    seq_origin: u64,
     playing: bool,
     looping: bool,
-    start_tick: u32,
-    pause_elapsed: u32,
+    /// Clock held at `hold_time` until the next frame is on screen.
+    waiting: bool,
+    /// Playback time while paused or waiting.
+    hold_time: u64,
+    /// Playback time at the last clock start.
+    clock_origin: u64,
+    /// `audio_position()` at the last clock start.
+    clock_hw_start: u32,
+    /// `uptime()` at the last clock start.
+    clock_tick_start: u32,
+    /// The clock follows the audio DMA position.
+    audio_clock: bool,
+    /// PCM audio track (s16le stereo, 48 kHz), empty if silent.
+    audio: &'static [u8],
+    /// Bytes of `audio` queued so far.
+    audio_fed: usize,
     tick_hz: u32,
-    needs_redraw: bool,
     lbl_status: anyui::Label,
     lbl_time: anyui::Label,
     progress: anyui::ProgressBar,
@@ -70,10 +101,24 @@ fn main() {
     let vid_w = info.width as usize;
     let vid_h = info.height as usize;
     let pixels = vec![0u32; vid_w * vid_h];
-    let scratch = vec![0u8; info.scratch_needed as usize];
     let num_frames = info.num_frames;
     let fps = info.fps;
 
+    // The decode threads read the file for as long as the process runs
+    let data: &'static [u8] = data.leak();
+    let audio = if audio::audio_is_available() {
+        libimage_client::video_audio(data, &info)
+    } else {
+        &[]
+    };
+    let decoder = match Decoder::start(data, &info) {
+        Some(d) => d,
+        None => {
+            anyos_std::println!("videoplayer: cannot start decode threads");
+            return;
+        }
+    };
+
     let filename = path.rsplit('/').next().unwrap_or(path);
 
     if !anyui::init() { return; }
@@ -124,21 +169,26 @@ fn main() {
     unsafe {
         APP = Some(AppState {
             canvas,
-            data,
+            decoder,
             num_frames,
             fps,
             vid_w,
             vid_h,
             pixels,
-            scratch,
             render_buf: Vec::new(),
             current_frame: 0,
+            seq_origin: 0,
             playing: true,
             looping: true,
-            start_tick: anyos_std::sys::uptime(),
-            pause_elapsed: 0,
+            waiting: true,
+            hold_time: 0,
+            clock_origin: 0,
+            clock_hw_start: 0,
+            clock_tick_start: 0,
+            audio_clock: false,
+            audio,
+            audio_fed: 0,
             tick_hz,
-            needs_redraw: true,
             lbl_status,
             lbl_time,
             progress,
@@ -152,60 +202,72 @@ fn main() {
             KEY_SPACE => {
                 let a = app();
                 if a.playing {
-                    a.pause_elapsed = anyos_std::sys::uptime().wrapping_sub(a.start_tick);
+                    a.hold_time = clock_now();
+                    if a.audio_clock {
+                        audio::audio_stop();
+                    }
                     a.playing = false;
                     a.lbl_status.set_text(">");
                 } else {
-                    a.start_tick = anyos_std::sys::uptime().wrapping_sub(a.pause_elapsed);
                     a.playing = true;
+                    if !a.waiting {
+                        start_clock(a.hold_time);
+                    }
                     a.lbl_status.set_text("||");
                 }
             }
             anyui::KEY_LEFT => {
                 let a = app();
                 let back = a.fps;
-                a.current_frame = a.current_frame.saturating_sub(back);
-                seek_to_current();
+                seek(a.current_frame.saturating_sub(back));
             }
             anyui::KEY_RIGHT => {
                 let a = app();
                 let fwd = a.fps;
-                a.current_frame = (a.current_frame + fwd).min(a.num_frames - 1);
-                seek_to_current();
+                seek((a.current_frame + fwd).min(a.num_frames - 1));
             }
             _ => {}
         }
     });
 
-    win.on_close(|_| anyui::quit());
+    win.on_close(|_| {
+        if app().audio_clock {
+            audio::audio_stop();
+        }
+        anyui::quit()
+    });
 
     // Playback timer (16ms ~ 60fps)
     anyui::set_timer(16, || {
         let a = app();
-        if a.playing {
-            let elapsed = anyos_std::sys::uptime().wrapping_sub(a.start_tick);
-            let target_frame = (elapsed as u64 * a.fps as u64 / a.tick_hz as u64) as u32;
-            let target_frame = target_frame.min(a.num_frames - 1);
-
-            if target_frame != a.current_frame {
-                a.current_frame = target_frame;
-                a.needs_redraw = true;
-            }
+        if a.playing && !a.waiting {
+            feed_audio();
+        }
 
-            if a.current_frame >= a.num_frames - 1 {
-                if a.looping {
-                    a.current_frame = 0;
-                    a.start_tick = anyos_std::sys::uptime();
-                    a.needs_redraw = true;
-                } else {
-                    a.playing = false;
-                    a.lbl_status.set_text(">");
-                }
+        let fps = a.fps as u64;
+        let mut frame = clock_now() * fps / SAMPLE_RATE;
+        if frame >= a.num_frames as u64 {
+            if a.looping {
+                // The decoder is already working on the next pass
+                a.seq_origin += a.num_frames as u64;
+                start_clock(0);
+                frame = 0;
+            } else {
+                frame = a.num_frames as u64 - 1;
+                a.hold_time = clock_now();
+                a.playing = false;
+                a.lbl_status.set_text(">");
             }
         }
 
-        if a.needs_redraw {
-            a.needs_redraw = false;
+        if let Some(seq) = a.decoder.take(a.seq_origin + frame, &mut a.pixels) {
+            a.current_frame = (seq % a.num_frames as u64) as u32;
+            if a.waiting {
+                a.waiting = false;
+                if a.playing {
+                    start_clock(a.hold_time);
+                }
+            }
             redraw();
             update_controls();
         }
@@ -214,26 +276,73 @@ fn main() {
     anyui::run();
 }
 
-fn seek_to_current() {
+/// Current playback time in sample frames.
+fn clock_now() -> u64 {
     let a = app();
-    let frame_ticks = if a.fps > 0 {
-        (a.current_frame as u64 * a.tick_hz as u64 / a.fps as u64) as u32
-    } else { 0 };
-    if a.playing {
-        a.start_tick = anyos_std::sys::uptime().wrapping_sub(frame_ticks);
+    if !a.playing || a.waiting {
+        a.hold_time
+    } else if a.audio_clock {
+        a.clock_origin + audio::audio_position().wrapping_sub(a.clock_hw_start) as u64
     } else {
-        a.pause_elapsed = frame_ticks;
+        let ticks = anyos_std::sys::uptime().wrapping_sub(a.clock_tick_start) as u64;
+        a.clock_origin + ticks * SAMPLE_RATE / a.tick_hz.max(1) as u64
     }
-    a.needs_redraw = true;
 }
 
-fn redraw() {
+/// Run the clock from `time`, restarting the audio track there.
+fn start_clock(time: u64) {
     let a = app();
+    a.clock_origin = time;
+    a.clock_tick_start = anyos_std::sys::uptime();
+    a.audio_clock = false;
+    let offset = time as usize * 4;
+    if offset < a.audio.len() {
+        audio::audio_stop();
+        a.clock_hw_start = audio::audio_position();
+        a.audio_fed = offset;
+        a.audio_clock = true;
+        feed_audio();
+    }
+}
 
-    // Decode frame
-    let _ = libimage_client::video_decode_frame(
-        &a.data, a.num_frames, a.current_frame, &mut a.pixels, &mut a.scratch,
-    );
+/// Keep [`AUDIO_AHEAD`] of the track queued.  Once it has all played,
+/// the clock carries on from uptime.
+fn feed_audio() {
+    let a = app();
+    if !a.audio_clock {
+        return;
+    }
+    while a.audio_fed < a.audio.len() && audio::audio_buffered() < AUDIO_AHEAD {
+        let end = (a.audio_fed + AUDIO_CHUNK).min(a.audio.len());
+        let n = audio::audio_write(&a.audio[a.audio_fed..end]) as usize;
+        if n == 0 || n > end - a.audio_fed {
+            break;
+        }
+        a.audio_fed += n;
+    }
+    if a.audio_fed >= a.audio.len() && audio::audio_buffered() == 0 {
+        let now = clock_now();
+        a.audio_clock = false;
+        a.clock_origin = now;
+        a.clock_tick_start = anyos_std::sys::uptime();
+    }
+}
+
+/// Jump to `frame`; the clock waits there until it has been decoded.
+fn seek(frame: u32) {
+    let a = app();
+    if a.audio_clock {
+        audio::audio_stop();
+        a.audio_clock = false;
+    }
+    a.decoder.seek(a.seq_origin + frame as u64);
+    a.hold_time = frame as u64 * SAMPLE_RATE / a.fps.max(1) as u64;
+    a.waiting = true;
+}
+
+/// Show the frame in `pixels`, centered in the canvas.
+fn redraw() {
+    let a = app();
 
     let w = a.canvas.get_stride() as usize;
     let h = a.canvas.get_height() as usize;
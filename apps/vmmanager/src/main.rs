@@ -148,6 +148,8 @@ struct VmEntry {
     shm_ptr: *const u8,
     /// Cached instruction count (read from SHM header).
     instruction_count: u64,
+    /// Decoded-block cache hit rate in tenths of a percent (from SHM header).
+    icache_permille: u32,
 }
 
 /// Labels displaying real-time VM information.
@@ -156,6 +158,7 @@ struct VmInfoLabels {
     mode_label: anyui::Label,
     ram_label: anyui::Label,
     insn_label: anyui::Label,
+    icache_label: anyui::Label,
 }
 
 /// Controls used in the settings dialog window.
@@ -565,6 +568,7 @@ fn load_all_vms() -> (Vec<VmEntry>, SidebarLayout) {
                 shm_id: 0,
                 shm_ptr: core::ptr::null(),
                 instruction_count: 0,
+                icache_permille: 0,
             });
             loaded.push(String::from(uuid));
         }
@@ -611,6 +615,7 @@ fn load_all_vms() -> (Vec<VmEntry>, SidebarLayout) {
                             shm_id: 0,
                             shm_ptr: core::ptr::null(),
                             instruction_count: 0,
+                            icache_permille: 0,
                         });
                     }
                 }
@@ -828,6 +833,7 @@ fn update_info_labels() {
         a.info.mode_label.set_text("Mode: -");
         a.info.ram_label.set_text("RAM: -");
         a.info.insn_label.set_text("Instructions: -");
+        a.info.icache_label.set_text("Decode cache: -");
         return;
     }
 
@@ -853,9 +859,14 @@ fn update_info_labels() {
         let mut ibuf = [0u8; 40];
         let s = fmt_label_u64(&mut ibuf, "Instructions: ", entry.instruction_count);
         a.info.insn_label.set_text(s);
+
+        let p = entry.icache_permille;
+        let s = format!("Decode cache: {}.{}% hits", p / 10, p % 10);
+        a.info.icache_label.set_text(&s);
     } else {
         a.info.mode_label.set_text("Mode: -");
         a.info.insn_label.set_text("Instructions: 0");
+        a.info.icache_label.set_text("Decode cache: -");
     }
 }
 
@@ -944,6 +955,7 @@ fn start_selected_vm() {
     ipc::pipe_write(cmd_pipe, b"start");
     entry.state = VmState::Running;
     entry.instruction_count = 0;
+    entry.icache_permille = 0;
 
     rebuild_sidebar();
     update_info_labels();
@@ -1649,6 +1661,7 @@ fn create_new_vm() {
         shm_id: 0,
         shm_ptr: core::ptr::null(),
         instruction_count: 0,
+        icache_permille: 0,
     });
 
     a.selected_vm = a.vms.len() - 1;
@@ -1717,13 +1730,14 @@ fn vm_tick() {
         }
     }
 
-    // Read SHM header for instruction count and dirty flag.
+    // Read SHM header for instruction count, cache hit rate and dirty flag.
     if !entry.shm_ptr.is_null() {
         unsafe {
             let hdr = entry.shm_ptr;
             let icount_lo = (hdr.add(20) as *const u32).read_volatile();
             let icount_hi = (hdr.add(24) as *const u32).read_volatile();
             entry.instruction_count = (icount_hi as u64) << 32 | icount_lo as u64;
+            entry.icache_permille = (hdr.add(28) as *const u32).read_volatile();
 
             // Check dirty flag.
             let dirty = (hdr.add(12) as *const u32).read_volatile();
@@ -1918,6 +1932,13 @@ fn main() {
     insn_label.set_font_size(12);
     content_view.add(&insn_label);
 
+    let icache_label = anyui::Label::new("Decode cache: -");
+    icache_label.set_position(350, info_y + 44);
+    icache_label.set_size(300, 20);
+    icache_label.set_text_color(0xFFCCCCCC);
+    icache_label.set_font_size(12);
+    content_view.add(&icache_label);
+
     win.add(&content_view);
 
     // ── Load saved VMs ─────────────────────────────────────────────
@@ -1938,6 +1959,7 @@ fn main() {
                 mode_label,
                 ram_label,
                 insn_label,
+                icache_label,
             },
             content_view,
             sidebar_tree,
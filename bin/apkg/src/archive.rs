@@ -1,6 +1,6 @@
 //! Package archive extraction using libzip_client.
 //!
-//! `.tar.gz` archives are read via `TarReader`. File entries under the
+//! `.tar.gz` archives are streamed via `TarStream`. File entries under the
 //! `<name>-<version>/files/` prefix are extracted to the filesystem root.
 
 use alloc::string::String;
@@ -16,76 +16,73 @@ pub struct ExtractResult {
     pub installed_files: Vec<String>,
 }
 
-/// Extract the `pkg.json` metadata from a package archive without installing files.
-pub fn read_pkg_json(archive_path: &str) -> Option<Value> {
-    let reader = libzip_client::TarReader::open(archive_path)?;
-    let count = reader.entry_count();
+/// `pkg.json` files larger than this are rejected rather than buffered.
+const MAX_PKG_JSON: u64 = 1024 * 1024;
 
-    for i in 0..count {
-        let name = reader.entry_name(i);
-        if name.ends_with("/pkg.json") || name == "pkg.json" {
-            let data = reader.extract(i)?;
+/// Find and parse `pkg.json`.  Returns it with the path it was found at.
+fn find_pkg_json(archive_path: &str) -> Option<(Value, String)> {
+    let mut stream = libzip_client::TarStream::open(archive_path)?;
+    while let Some(entry) = stream.next_entry().ok()? {
+        if entry.name.ends_with("/pkg.json") || entry.name == "pkg.json" {
+            if entry.size > MAX_PKG_JSON {
+                return None;
+            }
+            let data = stream.read_to_vec(entry.size)?;
             let json_str = core::str::from_utf8(&data).ok()?;
-            return Value::parse(json_str).ok();
+            return Some((Value::parse(json_str).ok()?, entry.name));
         }
     }
     None
 }
 
+/// Extract the `pkg.json` metadata from a package archive without installing files.
+pub fn read_pkg_json(archive_path: &str) -> Option<Value> {
+    find_pkg_json(archive_path).map(|(json, _)| json)
+}
+
 /// Extract package files to the filesystem.
 ///
 /// Files under `<prefix>/files/` are extracted with the prefix stripped,
-/// resulting in absolute paths from the filesystem root.
+/// resulting in absolute paths from the filesystem root.  The archive is
+/// streamed twice — once up to `pkg.json`, which packages store first, and
+/// once to extract — so memory use does not grow with the package size.
 pub fn extract_package(archive_path: &str) -> Option<ExtractResult> {
-    let reader = libzip_client::TarReader::open(archive_path)?;
-    let count = reader.entry_count();
-
     // First pass: find and parse pkg.json, determine the files/ prefix
-    let mut pkg_json: Option<Value> = None;
-    let mut files_prefix: Option<String> = None;
-
-    for i in 0..count {
-        let name = reader.entry_name(i);
-        if name.ends_with("/pkg.json") {
-            if let Some(data) = reader.extract(i) {
-                if let Ok(json_str) = core::str::from_utf8(&data) {
-                    pkg_json = Value::parse(json_str).ok();
-                }
-            }
-            // Derive the files prefix from the pkg.json path
-            // e.g., "wget-1.2.0/pkg.json" → "wget-1.2.0/files/"
-            if let Some(slash) = name.rfind('/') {
-                files_prefix = Some(format!("{}/files/", &name[..slash]));
-            }
-        }
-    }
-
-    let pkg_json = pkg_json?;
-    let files_prefix = files_prefix?;
+    // e.g., "wget-1.2.0/pkg.json" → "wget-1.2.0/files/"
+    let (pkg_json, json_path) = find_pkg_json(archive_path)?;
+    let files_prefix = format!("{}/files/", &json_path[..json_path.rfind('/')?]);
 
     // Second pass: extract files
+    let mut stream = libzip_client::TarStream::open(archive_path)?;
     let mut installed_files = Vec::new();
 
-    for i in 0..count {
-        let name = reader.entry_name(i);
-        if !name.starts_with(&files_prefix) {
+    loop {
+        let entry = match stream.next_entry() {
+            Ok(Some(e)) => e,
+            Ok(None) => break,
+            Err(()) => {
+                println!("apkg: '{}': corrupt or truncated archive", archive_path);
+                break;
+            }
+        };
+        if !entry.name.starts_with(&files_prefix) {
             continue;
         }
 
         // Strip the prefix to get the absolute filesystem path
-        let rel_path = &name[files_prefix.len()..];
+        let rel_path = &entry.name[files_prefix.len()..];
         if rel_path.is_empty() {
             continue;
         }
 
         let target_path = format!("/{}", rel_path);
 
-        if reader.entry_is_dir(i) {
+        if entry.is_dir {
             ensure_dir(&target_path);
         } else {
             // Ensure parent directories exist
             ensure_parent_dirs(&target_path);
-            if reader.extract_to_file(i, &target_path) {
+            if stream.extract_to_file(&target_path) {
                 installed_files.push(target_path);
             } else {
                 println!("apkg: failed to extract '{}'", target_path);
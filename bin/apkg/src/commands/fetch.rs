@@ -0,0 +1,24 @@
+//! `apkg fetch` — fetch one file into the download cache.
+//!
+//! Run by `download::fetch_all` as one child process per file so several
+//! downloads proceed at once; exits 0 once the verified file is cached.
+
+use alloc::string::String;
+use anyos_std::{println, process};
+use crate::{config, download};
+
+/// Execute `apkg fetch <filename> <md5|-> <size>`.
+pub fn run(filename: &str, md5: &str, size: &str) -> ! {
+    if filename.is_empty() || filename.contains('/') {
+        println!("Usage: apkg fetch <filename> <md5|-> <size>");
+        process::exit(2);
+    }
+    let file = download::Fetch {
+        filename: String::from(filename),
+        md5: if md5 == "-" { String::new() } else { String::from(md5) },
+        size: size.parse().unwrap_or(0),
+    };
+    let mirrors = config::read_mirrors();
+    let ok = download::fetch(&mirrors, &file, false);
+    process::exit(if ok { 0 } else { 1 });
+}
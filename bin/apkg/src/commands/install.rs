@@ -1,8 +1,9 @@
 //! `apkg install` — install one or more packages with dependency resolution.
 
 use alloc::string::String;
+use alloc::vec::Vec;
 use alloc::format;
-use anyos_std::{println, fs, crypto};
+use anyos_std::{println, fs};
 use crate::{config, db, download, index, resolve, archive};
 use crate::db::InstalledPackage;
 
@@ -73,49 +74,35 @@ pub fn run(names: &[&str], yes: bool) {
         return;
     }
 
-    let arch = config::arch();
+    // Download everything first, several files at a time
+    let pkgs: Vec<index::PackageInfo> = plan.iter()
+        .filter_map(|item| idx.find(&item.name))
+        .collect();
+    let fetches: Vec<download::Fetch> = pkgs.iter()
+        .map(|pkg| download::Fetch {
+            filename: pkg.filename.clone(),
+            md5: pkg.md5.clone(),
+            size: pkg.size,
+        })
+        .collect();
+    let fetched = download::fetch_all(&mirrors, &fetches);
+
     let mut installed_count = 0u32;
 
     for item in &plan {
-        let pkg = match idx.find(&item.name) {
-            Some(p) => p,
+        let i = match pkgs.iter().position(|p| p.name == item.name) {
+            Some(i) => i,
             None => continue,
         };
+        let pkg = &pkgs[i];
 
         println!("Installing {}...", pkg.name);
 
-        // Download
-        let cache_path = format!("{}/{}", config::CACHE_DIR, pkg.filename);
-        if !file_exists(&cache_path) {
-            let mut downloaded = false;
-            for mirror_url in &mirrors {
-                let url = config::package_url(mirror_url, arch, &pkg.filename);
-                if download::download_verbose(&url, &cache_path) {
-                    downloaded = true;
-                    break;
-                }
-            }
-            if !downloaded {
-                println!("apkg: failed to download {}", pkg.name);
-                continue;
-            }
-        }
-
-        // Verify MD5 checksum
-        if !pkg.md5.is_empty() {
-            if let Ok(data) = fs::read_to_vec(&cache_path) {
-                let hash = crypto::md5_hex(&data);
-                let hash_str = core::str::from_utf8(&hash).unwrap_or("");
-                if hash_str != pkg.md5 {
-                    println!("apkg: checksum mismatch for {}", pkg.name);
-                    println!("  expected: {}", pkg.md5);
-                    println!("  got:      {}", hash_str);
-                    // Remove corrupted file
-                    fs::unlink(&cache_path);
-                    continue;
-                }
-            }
+        if !fetched[i] {
+            println!("apkg: failed to download {}", pkg.name);
+            continue;
         }
+        let cache_path = download::cache_path(&pkg.filename);
 
         // Extract
         let result = match archive::extract_package(&cache_path) {
@@ -127,7 +114,7 @@ pub fn run(names: &[&str], yes: bool) {
         };
 
         // Record in database
-        let depends: alloc::vec::Vec<String> = pkg.depends.clone();
+        let depends: Vec<String> = pkg.depends.clone();
         database.add(InstalledPackage {
             name: String::from(&pkg.name),
             version: String::from(&pkg.version_str),
@@ -135,6 +122,7 @@ pub fn run(names: &[&str], yes: bool) {
             depends,
             pkg_type: String::from(&pkg.pkg_type),
             auto: item.auto,
+            archive: String::from(&pkg.filename),
         });
 
         installed_count += 1;
@@ -144,12 +132,6 @@ pub fn run(names: &[&str], yes: bool) {
     println!("{} package(s) installed.", installed_count);
 }
 
-/// Check if a file exists.
-fn file_exists(path: &str) -> bool {
-    let mut stat_buf = [0u32; 7];
-    fs::stat(path, &mut stat_buf) == 0
-}
-
 /// Format a byte size into a human-readable string.
 fn format_size(bytes: u64) -> String {
     if bytes >= 1024 * 1024 {
@@ -10,3 +10,4 @@ pub mod info;
 pub mod clean;
 pub mod autoremove;
 pub mod mirror;
+pub mod fetch;
@@ -1,7 +1,11 @@
 //! `apkg update` — download the latest index.json from mirrors.
+//!
+//! The mirror's `index.bin` is fetched too; if the mirror has none, it is
+//! built locally so later commands never parse the JSON.
 
-use anyos_std::println;
-use crate::{config, download};
+use alloc::format;
+use anyos_std::{fs, println};
+use crate::{config, download, index};
 
 /// Execute `apkg update`.
 pub fn run() {
@@ -17,7 +21,11 @@ pub fn run() {
         println!("Fetching index from {}...", mirror_url);
 
         if download::download(&url, config::INDEX_PATH) {
-            println!("Package index updated successfully.");
+            fetch_binary_index(mirror_url);
+            match index::Index::load() {
+                Some(idx) => println!("Package index updated successfully ({} packages).", idx.len()),
+                None => println!("apkg: downloaded index is not valid"),
+            }
             return;
         }
         println!("  mirror unavailable, trying next...");
@@ -25,3 +33,15 @@ pub fn run() {
 
     println!("apkg: failed to fetch index from any mirror");
 }
+
+/// Replace the cached index.bin with the mirror's copy, or drop it so the
+/// next load rebuilds it from the new index.json.
+fn fetch_binary_index(mirror_url: &str) {
+    let tmp = format!("{}.tmp", config::INDEX_BIN_PATH);
+    let ok = download::download(&config::index_bin_url(mirror_url), &tmp)
+        && fs::read_to_vec(&tmp).ok().and_then(index::Index::from_bytes).is_some();
+    fs::unlink(config::INDEX_BIN_PATH);
+    if !ok || fs::rename(&tmp, config::INDEX_BIN_PATH) != 0 {
+        fs::unlink(&tmp);
+    }
+}
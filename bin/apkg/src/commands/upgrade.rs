@@ -3,8 +3,8 @@
 use alloc::string::String;
 use alloc::vec::Vec;
 use alloc::format;
-use anyos_std::{println, fs, crypto};
-use crate::{config, db, download, index, archive, version::Version};
+use anyos_std::{println, fs};
+use crate::{config, db, delta, download, index, archive, version::Version};
 use crate::db::InstalledPackage;
 
 /// Execute `apkg upgrade [name]`.
@@ -97,17 +97,60 @@ pub fn run(name: Option<&str>, yes: bool) {
         return;
     }
 
-    let arch = config::arch();
-    let mut upgraded_count = 0u32;
-
+    // Choose what to download for each package: a delta against the
+    // cached archive of the installed version when the index offers a
+    // smaller one, the full package otherwise.
+    let mut jobs: Vec<Job> = Vec::new();
     for (pkg_name, _old_ver, _new_ver) in &upgrades {
         let pkg = match idx.find(pkg_name) {
             Some(p) => p,
             None => continue,
         };
+        let mut base = String::new();
+        let mut fetch = download::Fetch {
+            filename: pkg.filename.clone(),
+            md5: pkg.md5.clone(),
+            size: pkg.size,
+        };
+        if let Some(installed) = database.get(pkg_name) {
+            let cached = download::cache_path(&installed.archive);
+            if let Some(d) = pkg.delta_from(&installed.version) {
+                if !installed.archive.is_empty() && d.size < pkg.size
+                    && download::file_exists(&cached)
+                {
+                    base = cached;
+                    fetch = download::Fetch {
+                        filename: d.filename.clone(),
+                        md5: d.md5.clone(),
+                        size: d.size,
+                    };
+                }
+            }
+        }
+        let job = Job { pkg, base, fetch };
+        jobs.push(job);
+    }
+    let fetches: Vec<download::Fetch> = jobs.iter().map(|j| j.fetch.clone()).collect();
+    let fetched = download::fetch_all(&mirrors, &fetches);
+
+    let mut upgraded_count = 0u32;
+
+    for (i, job) in jobs.iter().enumerate() {
+        let pkg = &job.pkg;
+        let pkg_name = &pkg.name;
 
         println!("Upgrading {}...", pkg.name);
 
+        // Rebuild from the delta, or fall back to the full package
+        let archive_name = match prepare_archive(job, fetched[i], &mirrors) {
+            Some(name) => name,
+            None => {
+                println!("apkg: failed to download {}", pkg.name);
+                continue;
+            }
+        };
+        let cache_path = download::cache_path(&archive_name);
+
         // Backup system packages
         if pkg.pkg_type == "system" {
             if let Some(installed) = database.get(pkg_name) {
@@ -126,36 +169,6 @@ pub fn run(name: Option<&str>, yes: bool) {
             }
         }
 
-        // Download
-        let cache_path = format!("{}/{}", config::CACHE_DIR, pkg.filename);
-        if !file_exists(&cache_path) {
-            let mut downloaded = false;
-            for mirror_url in &mirrors {
-                let url = config::package_url(mirror_url, arch, &pkg.filename);
-                if download::download_verbose(&url, &cache_path) {
-                    downloaded = true;
-                    break;
-                }
-            }
-            if !downloaded {
-                println!("apkg: failed to download {}", pkg.name);
-                continue;
-            }
-        }
-
-        // Verify MD5
-        if !pkg.md5.is_empty() {
-            if let Ok(data) = fs::read_to_vec(&cache_path) {
-                let hash = crypto::md5_hex(&data);
-                let hash_str = core::str::from_utf8(&hash).unwrap_or("");
-                if hash_str != pkg.md5 {
-                    println!("apkg: checksum mismatch for {}", pkg.name);
-                    fs::unlink(&cache_path);
-                    continue;
-                }
-            }
-        }
-
         // Extract (overwrites existing files)
         let result = match archive::extract_package(&cache_path) {
             Some(r) => r,
@@ -165,8 +178,14 @@ pub fn run(name: Option<&str>, yes: bool) {
             }
         };
 
-        // Update database record
-        let auto = database.get(pkg_name).map(|p| p.auto).unwrap_or(false);
+        // Update database record; the old version's archive is superseded
+        let (auto, old_archive) = match database.get(pkg_name) {
+            Some(p) => (p.auto, p.archive.clone()),
+            None => (false, String::new()),
+        };
+        if !old_archive.is_empty() && old_archive != archive_name {
+            fs::unlink(&download::cache_path(&old_archive));
+        }
         let depends: Vec<String> = pkg.depends.clone();
         database.add(InstalledPackage {
             name: String::from(&pkg.name),
@@ -175,6 +194,7 @@ pub fn run(name: Option<&str>, yes: bool) {
             depends,
             pkg_type: String::from(&pkg.pkg_type),
             auto,
+            archive: archive_name,
         });
 
         upgraded_count += 1;
@@ -188,8 +208,51 @@ pub fn run(name: Option<&str>, yes: bool) {
     println!("{} package(s) upgraded.", upgraded_count);
 }
 
-/// Check if a file exists.
-fn file_exists(path: &str) -> bool {
-    let mut stat_buf = [0u32; 7];
-    fs::stat(path, &mut stat_buf) == 0
+/// One package upgrade and the file fetched for it.
+struct Job {
+    pkg: index::PackageInfo,
+    /// Cached archive of the installed version when `fetch` is a delta.
+    base: String,
+    fetch: download::Fetch,
+}
+
+/// Make the new version's archive available in the cache and return its
+/// file name: the tar rebuilt from a delta, or the full package.
+fn prepare_archive(job: &Job, fetched: bool, mirrors: &[String]) -> Option<String> {
+    let pkg = &job.pkg;
+    if !job.base.is_empty() {
+        let tar_name = String::from(pkg.filename.strip_suffix(".gz").unwrap_or(&pkg.filename));
+        let tar_name = if tar_name == pkg.filename { format!("{}.tar", tar_name) } else { tar_name };
+        if download::file_exists(&download::cache_path(&tar_name)) {
+            return Some(tar_name);
+        }
+        if fetched {
+            let delta_path = download::cache_path(&job.fetch.filename);
+            let ok = delta::apply(&job.base, &delta_path, &download::cache_path(&tar_name));
+            fs::unlink(&delta_path);
+            if ok {
+                println!("  rebuilt from delta ({})", format_size(job.fetch.size));
+                return Some(tar_name);
+            }
+        }
+        println!("  delta unusable, downloading the full package");
+        let full = download::Fetch {
+            filename: pkg.filename.clone(),
+            md5: pkg.md5.clone(),
+            size: pkg.size,
+        };
+        return if download::fetch(mirrors, &full, true) { Some(pkg.filename.clone()) } else { None };
+    }
+    if fetched { Some(pkg.filename.clone()) } else { None }
+}
+
+/// Format a byte size into a human-readable string.
+fn format_size(bytes: u64) -> String {
+    if bytes >= 1024 * 1024 {
+        format!("{}.{} MiB", bytes / (1024 * 1024), (bytes % (1024 * 1024)) * 10 / (1024 * 1024))
+    } else if bytes >= 1024 {
+        format!("{}.{} KiB", bytes / 1024, (bytes % 1024) * 10 / 1024)
+    } else {
+        format!("{} B", bytes)
+    }
 }
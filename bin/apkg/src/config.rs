@@ -10,12 +10,25 @@ pub const APKG_DIR: &str = "/System/etc/apkg";
 pub const MIRRORS_PATH: &str = "/System/etc/apkg/mirrors.conf";
 /// Cached remote index.
 pub const INDEX_PATH: &str = "/System/etc/apkg/index.json";
+/// Binary form of the cached index, queried instead of parsing the JSON.
+pub const INDEX_BIN_PATH: &str = "/System/etc/apkg/index.bin";
 /// Installed package database.
 pub const INSTALLED_PATH: &str = "/System/etc/apkg/installed.json";
 /// Download cache directory.
 pub const CACHE_DIR: &str = "/System/etc/apkg/cache";
 /// Backup directory for system packages.
 pub const BACKUP_DIR: &str = "/System/etc/apkg/backup";
+/// TLS session cache, so repeated runs resume sessions with the mirrors.
+pub const TLS_SESSION_PATH: &str = "/System/etc/apkg/tls_sessions";
+/// Settings file (`key = value` lines).
+pub const CONF_PATH: &str = "/System/etc/apkg/apkg.conf";
+/// The apkg binary, spawned once per file for parallel downloads.
+pub const APKG_BIN: &str = "/System/bin/apkg";
+
+/// Downloads run at once when `parallel_downloads` is not set.
+const DEFAULT_PARALLEL_DOWNLOADS: usize = 3;
+/// Upper bound for `parallel_downloads`.
+const MAX_PARALLEL_DOWNLOADS: usize = 8;
 
 /// Ensure all apkg directories exist.
 pub fn ensure_dirs() {
@@ -42,6 +55,32 @@ pub fn read_mirrors() -> Vec<String> {
     mirrors
 }
 
+/// Look up `key` in apkg.conf.
+fn read_setting(key: &str) -> Option<String> {
+    let content = fs::read_to_string(CONF_PATH).ok()?;
+    for line in content.lines() {
+        let line = line.trim();
+        if line.starts_with('#') {
+            continue;
+        }
+        if let Some((k, v)) = line.split_once('=') {
+            if k.trim() == key {
+                return Some(String::from(v.trim()));
+            }
+        }
+    }
+    None
+}
+
+/// How many package downloads may run at once (`parallel_downloads`).
+pub fn parallel_downloads() -> usize {
+    read_setting("parallel_downloads")
+        .and_then(|v| v.parse::<usize>().ok())
+        .unwrap_or(DEFAULT_PARALLEL_DOWNLOADS)
+        .max(1)
+        .min(MAX_PARALLEL_DOWNLOADS)
+}
+
 /// Write the mirror list back to mirrors.conf, preserving comments.
 fn write_mirrors_raw(content: &str) -> bool {
     match fs::File::create(MIRRORS_PATH) {
@@ -111,6 +150,12 @@ pub fn index_url(mirror_url: &str) -> String {
     alloc::format!("{}/index.json", base)
 }
 
+/// Build the full URL for the binary index.bin on a given mirror.
+pub fn index_bin_url(mirror_url: &str) -> String {
+    let base = mirror_url.trim_end_matches('/');
+    alloc::format!("{}/index.bin", base)
+}
+
 /// Get the current architecture string.
 pub fn arch() -> &'static str {
     #[cfg(target_arch = "x86_64")]
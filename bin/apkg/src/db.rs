@@ -16,6 +16,9 @@ pub struct InstalledPackage {
     pub pkg_type: String,
     /// True if installed automatically as a dependency.
     pub auto: bool,
+    /// Cache file the package was installed from (empty if unknown);
+    /// kept as the base for delta upgrades.
+    pub archive: String,
 }
 
 /// The installed packages database.
@@ -46,6 +49,7 @@ impl Database {
                 let depends = parse_string_array(&pkg_val["depends"]);
                 let pkg_type = pkg_val["type"].as_str().unwrap_or("bin").into();
                 let auto = pkg_val["auto"].as_bool().unwrap_or(false);
+                let archive = pkg_val["archive"].as_str().unwrap_or("").into();
                 packages.push(InstalledPackage {
                     name: String::from(name),
                     version,
@@ -53,6 +57,7 @@ impl Database {
                     depends,
                     pkg_type,
                     auto,
+                    archive,
                 });
             }
         }
@@ -81,6 +86,9 @@ impl Database {
             obj.set("version", Value::from(pkg.version.as_str()));
             obj.set("type", Value::from(pkg.pkg_type.as_str()));
             obj.set("auto", Value::Bool(pkg.auto));
+            if !pkg.archive.is_empty() {
+                obj.set("archive", Value::from(pkg.archive.as_str()));
+            }
 
             let files: Vec<Value> = pkg.files.iter().map(|f| Value::from(f.as_str())).collect();
             obj.set("files", Value::Array(files));
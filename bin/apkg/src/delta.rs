@@ -0,0 +1,187 @@
+//! Delta package (`.apkd`) application.
+//!
+//! A delta rebuilds the uncompressed tar of a new package version from
+//! the uncompressed tar of the installed one (see `apkg-build -D` for the
+//! format).  The base is the cached archive the installed version came
+//! from; the result is written next to it as a plain `.tar`, which
+//! `TarStream` extracts like any other package archive.
+
+use alloc::format;
+use alloc::vec::Vec;
+use anyos_std::{crypto, fs};
+use anyos_std::fs::{Read, Write};
+
+const MAGIC: &[u8; 8] = b"APKGDLT1";
+const HEADER_LEN: usize = 88;
+
+/// Rebuild `output` (an uncompressed tar) from the `base` archive
+/// (`.tar` or `.tar.gz`) and the `delta` file.
+/// Returns false if anything does not match; `output` is then absent.
+pub fn apply(base: &str, delta: &str, output: &str) -> bool {
+    let raw_path = format!("{}.raw", delta);
+    let base_tar = format!("{}.base", output);
+    let part_path = format!("{}.part", output);
+
+    let ok = libzip_client::gzip_decompress_file(delta, &raw_path)
+        && (!base.ends_with(".gz") || libzip_client::gzip_decompress_file(base, &base_tar))
+        && rebuild(if base.ends_with(".gz") { &base_tar } else { base }, &raw_path, &part_path)
+        && fs::rename(&part_path, output) == 0;
+
+    fs::unlink(&raw_path);
+    fs::unlink(&base_tar);
+    if !ok {
+        fs::unlink(&part_path);
+    }
+    ok
+}
+
+fn rebuild(base_path: &str, raw_path: &str, out_path: &str) -> bool {
+    let mut delta = match Reader::open(raw_path) {
+        Some(r) => r,
+        None => return false,
+    };
+    let header = match delta.take(HEADER_LEN) {
+        Some(h) => h,
+        None => return false,
+    };
+    if &header[..8] != MAGIC {
+        return false;
+    }
+    let old_size = le64(&header[8..16]);
+    let new_size = le64(&header[16..24]);
+
+    let old = match fs::read_to_vec(base_path) {
+        Ok(d) => d,
+        Err(_) => return false,
+    };
+    if old.len() as u64 != old_size || crypto::md5(&old)[..] != header[24..40] {
+        return false;
+    }
+
+    let mut out = match fs::File::create(out_path) {
+        Ok(f) => f,
+        Err(_) => return false,
+    };
+    let mut md5 = crypto::Md5::new();
+    let mut written: u64 = 0;
+    let mut old_pos: i64 = 0;
+    let mut chunk: Vec<u8> = Vec::new();
+
+    while written < new_size {
+        let rec = match delta.take(12) {
+            Some(r) => r,
+            None => return false,
+        };
+        let add_len = le32(&rec[0..4]) as u64;
+        let copy_len = le32(&rec[4..8]) as u64;
+        let seek = le32(&rec[8..12]) as i32 as i64;
+        if written + add_len + copy_len > new_size {
+            return false;
+        }
+        if old_pos < 0 || old_pos as u64 + add_len > old.len() as u64 {
+            return false;
+        }
+
+        // Add: new bytes are old bytes plus the difference, bytewise.
+        let mut left = add_len as usize;
+        while left > 0 {
+            let n = left.min(Reader::BUF_SIZE);
+            if !delta.read_into(&mut chunk, n) {
+                return false;
+            }
+            let base = &old[old_pos as usize..old_pos as usize + n];
+            for (b, &o) in chunk.iter_mut().zip(base) {
+                *b = b.wrapping_add(o);
+            }
+            if !emit(&mut out, &mut md5, &chunk) {
+                return false;
+            }
+            old_pos += n as i64;
+            left -= n;
+        }
+
+        // Copy: literal new bytes.
+        let mut left = copy_len as usize;
+        while left > 0 {
+            let n = left.min(Reader::BUF_SIZE);
+            if !delta.read_into(&mut chunk, n) || !emit(&mut out, &mut md5, &chunk) {
+                return false;
+            }
+            left -= n;
+        }
+
+        written += add_len + copy_len;
+        old_pos += seek;
+    }
+
+    md5.finish()[..] == header[40..56] && delta.at_end()
+}
+
+fn emit(out: &mut fs::File, md5: &mut crypto::Md5, data: &[u8]) -> bool {
+    md5.update(data);
+    out.write_all(data).is_ok()
+}
+
+fn le32(b: &[u8]) -> u32 {
+    u32::from_le_bytes([b[0], b[1], b[2], b[3]])
+}
+
+fn le64(b: &[u8]) -> u64 {
+    let mut v = [0u8; 8];
+    v.copy_from_slice(&b[..8]);
+    u64::from_le_bytes(v)
+}
+
+/// Buffered sequential reader over the decompressed delta.
+struct Reader {
+    file: fs::File,
+    buf: Vec<u8>,
+    pos: usize,
+    len: usize,
+}
+
+impl Reader {
+    const BUF_SIZE: usize = 32 * 1024;
+
+    fn open(path: &str) -> Option<Reader> {
+        let file = fs::File::open(path).ok()?;
+        Some(Reader { file, buf: alloc::vec![0u8; Self::BUF_SIZE], pos: 0, len: 0 })
+    }
+
+    /// Refill the buffer if it is empty.  Returns false at end of file.
+    fn fill(&mut self) -> bool {
+        if self.pos < self.len {
+            return true;
+        }
+        self.pos = 0;
+        self.len = match self.file.read(&mut self.buf) {
+            Ok(n) => n,
+            Err(_) => 0,
+        };
+        self.len > 0
+    }
+
+    /// Read exactly `n` bytes into `out` (replacing its contents).
+    fn read_into(&mut self, out: &mut Vec<u8>, n: usize) -> bool {
+        out.clear();
+        while out.len() < n {
+            if !self.fill() {
+                return false;
+            }
+            let take = (n - out.len()).min(self.len - self.pos);
+            out.extend_from_slice(&self.buf[self.pos..self.pos + take]);
+            self.pos += take;
+        }
+        true
+    }
+
+    fn take(&mut self, n: usize) -> Option<Vec<u8>> {
+        let mut v = Vec::with_capacity(n);
+        if self.read_into(&mut v, n) { Some(v) } else { None }
+    }
+
+    fn at_end(&mut self) -> bool {
+        !self.fill()
+    }
+}
+
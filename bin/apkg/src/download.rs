@@ -3,25 +3,291 @@
 //! Uses `libhttp.so` shared library for native HTTP/HTTPS downloads
 //! with automatic redirect following and gzip decompression.
 //! Verbose mode shows a live progress bar on the console.
+//!
+//! Package files are fetched into the cache through a `.part` file that
+//! is hashed as it is written: an interrupted transfer resumes with an
+//! HTTP `Range` request, and only a file whose MD5 matches the index is
+//! renamed into place.  Several files are fetched at once by running one
+//! `apkg fetch` process per file (libhttp keeps per-process state), up to
+//! `config::parallel_downloads()`.
 
+use alloc::format;
 use alloc::string::String;
-use anyos_std::{print, println};
+use alloc::vec::Vec;
+use anyos_std::{crypto, fs, print, println, process};
+use anyos_std::fs::{Read, Write};
+use crate::config;
+
+/// A file to fetch from the mirrors into `config::CACHE_DIR`.
+#[derive(Clone)]
+pub struct Fetch {
+    pub filename: String,
+    /// Expected MD5 (hex); empty to skip verification.
+    pub md5: String,
+    /// Expected size in bytes; 0 if unknown.
+    pub size: u64,
+}
 
 /// Download a file from `url` to `output_path`.
 /// Returns true on success.
 pub fn download(url: &str, output_path: &str) -> bool {
-    download_inner(url, output_path, false)
+    libhttp_client::download(url, output_path)
 }
 
-/// Download a file, showing a progress bar on the console.
-pub fn download_verbose(url: &str, output_path: &str) -> bool {
-    download_inner(url, output_path, true)
+/// Path of a file in the download cache.
+pub fn cache_path(filename: &str) -> String {
+    format!("{}/{}", config::CACHE_DIR, filename)
+}
+
+/// Fetch several files into the cache, up to `config::parallel_downloads()`
+/// at a time.  Returns whether each one is now in the cache, in order.
+pub fn fetch_all(mirrors: &[String], files: &[Fetch]) -> Vec<bool> {
+    let mut done: Vec<bool> = files.iter().map(|f| file_exists(&cache_path(&f.filename))).collect();
+    let pending: Vec<usize> = (0..files.len()).filter(|&i| !done[i]).collect();
+    let jobs = config::parallel_downloads().min(pending.len());
+
+    if jobs <= 1 {
+        for i in pending {
+            done[i] = fetch(mirrors, &files[i], true);
+        }
+        return done;
+    }
+
+    println!("Fetching {} files, {} at a time...", pending.len(), jobs);
+    let mut queue = pending.into_iter();
+    let mut running: Vec<(u32, usize)> = Vec::with_capacity(jobs);
+    loop {
+        while running.len() < jobs {
+            let i = match queue.next() {
+                Some(i) => i,
+                None => break,
+            };
+            let f = &files[i];
+            let md5 = if f.md5.is_empty() { "-" } else { f.md5.as_str() };
+            let args = format!("fetch {} {} {}", f.filename, md5, f.size);
+            let tid = process::spawn(config::APKG_BIN, &args);
+            if tid == u32::MAX {
+                // No child process: fetch here instead.
+                done[i] = fetch(mirrors, f, true);
+            } else {
+                running.push((tid, i));
+            }
+        }
+        if running.is_empty() {
+            break;
+        }
+
+        let mut finished = false;
+        let mut r = 0;
+        while r < running.len() {
+            let (tid, i) = running[r];
+            let code = process::try_waitpid(tid);
+            if code == process::STILL_RUNNING {
+                r += 1;
+                continue;
+            }
+            running.swap_remove(r);
+            finished = true;
+            done[i] = code == 0 && file_exists(&cache_path(&files[i].filename));
+            if done[i] {
+                println!("  fetched {}", files[i].filename);
+            } else {
+                println!("  failed to fetch {}", files[i].filename);
+            }
+        }
+        if !finished {
+            process::sleep(50);
+        }
+    }
+    done
+}
+
+/// Fetch one file into the cache, trying each mirror in turn.
+/// A file already in the cache counts as fetched: it was verified when
+/// it was renamed into place.
+pub fn fetch(mirrors: &[String], file: &Fetch, verbose: bool) -> bool {
+    let path = cache_path(&file.filename);
+    if file_exists(&path) {
+        return true;
+    }
+    let part_path = format!("{}.part", path);
+
+    for mirror in mirrors {
+        let url = config::package_url(mirror, config::arch(), &file.filename);
+        if fetch_from(&url, &part_path, file, verbose) {
+            if fs::rename(&part_path, &path) == 0 {
+                return true;
+            }
+            if verbose {
+                println!("apkg: cannot move {} into the cache", file.filename);
+            }
+            return false;
+        }
+    }
+    false
+}
+
+/// Fetch `url` into `part_path`, resuming what is already there, and
+/// verify the complete file.  On failure a partial file is kept for the
+/// next attempt unless its content turned out to be wrong.
+fn fetch_from(url: &str, part_path: &str, file: &Fetch, verbose: bool) -> bool {
+    let mut part = match PartFile::open(part_path) {
+        Some(p) => p,
+        None => {
+            if verbose {
+                println!("apkg: cannot write {}", part_path);
+            }
+            return false;
+        }
+    };
+    if file.size > 0 && part.len > file.size {
+        part.reset();
+    }
+
+    // A range past the end (416) means the partial file is not a prefix
+    // of this one: start over once.
+    let mut attempts = 0;
+    while file.size == 0 || part.len < file.size {
+        attempts += 1;
+        let offset = part.len;
+        if verbose {
+            if offset > 0 {
+                println!("  resuming {} at {} bytes", url, offset);
+            } else {
+                println!("  downloading {}", url);
+            }
+        }
+        let progress = if verbose { Some((progress_callback as libhttp_client::ProgressCallback, offset)) } else { None };
+        let ok = libhttp_client::download_range(url, offset as u32, progress, |at, data| part.write_at(at, data));
+        if verbose {
+            println!(); // finalize progress bar line
+        }
+        if ok {
+            break;
+        }
+        if libhttp_client::last_status() == 416 && offset > 0 && attempts == 1 {
+            part.reset();
+            continue;
+        }
+        report_error(verbose);
+        return false;
+    }
+
+    let size_ok = file.size == 0 || part.len == file.size;
+    let hash = part.finish_hex();
+    let hash_str = core::str::from_utf8(&hash).unwrap_or("");
+    if !size_ok || (!file.md5.is_empty() && hash_str != file.md5) {
+        if verbose {
+            println!("apkg: checksum mismatch for {}", file.filename);
+            println!("  expected: {} ({} bytes)", file.md5, file.size);
+            println!("  got:      {} ({} bytes)", hash_str, part.len);
+        }
+        fs::unlink(part_path);
+        return false;
+    }
+    true
+}
+
+/// A `.part` download being appended to, with the MD5 of its content so far.
+struct PartFile {
+    path: String,
+    file: fs::File,
+    len: u64,
+    md5: crypto::Md5,
+    failed: bool,
+}
+
+impl PartFile {
+    /// Open (or create) a partial download and hash what it already holds.
+    fn open(path: &str) -> Option<PartFile> {
+        let mut md5 = crypto::Md5::new();
+        let mut len = 0u64;
+        if let Ok(mut existing) = fs::File::open(path) {
+            let mut buf = alloc::vec![0u8; 32 * 1024];
+            loop {
+                match existing.read(&mut buf) {
+                    Ok(0) => break,
+                    Ok(n) => {
+                        md5.update(&buf[..n]);
+                        len += n as u64;
+                    }
+                    Err(_) => return None,
+                }
+            }
+        }
+        let file = if len > 0 {
+            fs::File::open_with(path, fs::O_WRITE | fs::O_APPEND).ok()?
+        } else {
+            fs::File::create(path).ok()?
+        };
+        Some(PartFile { path: String::from(path), file, len, md5, failed: false })
+    }
+
+    /// Drop the content and start from an empty file.
+    fn reset(&mut self) {
+        match fs::File::create(&self.path) {
+            Ok(f) => self.file = f,
+            Err(_) => self.failed = true,
+        }
+        self.len = 0;
+        self.md5 = crypto::Md5::new();
+    }
+
+    /// Body sink: store `data`, which belongs at `offset`.  A server that
+    /// ignored the range restarts at 0.  Returns false to abort.
+    fn write_at(&mut self, offset: u32, data: &[u8]) -> bool {
+        if offset as u64 != self.len {
+            if offset != 0 {
+                return false;
+            }
+            self.reset();
+        }
+        if self.failed || self.file.write_all(data).is_err() {
+            self.failed = true;
+            return false;
+        }
+        self.md5.update(data);
+        self.len += data.len() as u64;
+        true
+    }
+
+    fn finish_hex(&self) -> [u8; 32] {
+        self.md5.clone().finish_hex()
+    }
+}
+
+/// Print why the last libhttp transfer failed.
+fn report_error(verbose: bool) {
+    if !verbose {
+        return;
+    }
+    let err = libhttp_client::last_error();
+    let status = libhttp_client::last_status();
+    let err_msg = match err {
+        1 => "invalid URL",
+        2 => "DNS resolution failed",
+        3 => "connection failed",
+        4 => "send failed",
+        5 => "no response",
+        6 => "too many redirects",
+        7 => "TLS handshake failed",
+        9 => "file write error",
+        _ => "unknown error",
+    };
+    if status > 0 {
+        println!("apkg: download failed: HTTP {} ({})", status, err_msg);
+    } else {
+        println!("apkg: download failed: {}", err_msg);
+    }
 }
 
 /// Progress callback for the console progress bar.
+/// `resumed` (the userdata) is the number of bytes already on disk before
+/// this transfer, so a resumed download shows its overall progress.
 /// Builds the entire line in a `String` and prints it in a single syscall.
 /// Format: `\r  [===============>              ] 45% (1.2/2.6 MB)   `
-extern "C" fn progress_callback(received: u32, total: u32, _userdata: u64) {
+extern "C" fn progress_callback(received: u32, total: u32, resumed: u64) {
+    let received = received.saturating_add(resumed as u32);
     let mut buf = String::with_capacity(80);
     buf.push('\r');
     buf.push_str("  ");
@@ -32,6 +298,7 @@ extern "C" fn progress_callback(received: u32, total: u32, _userdata: u64) {
         print!("{}", buf);
         return;
     }
+    let total = total.saturating_add(resumed as u32);
 
     let pct = ((received as u64 * 100) / total as u64).min(100) as u32;
     let bar_width: u32 = 30;
@@ -95,45 +362,8 @@ fn push_u32(buf: &mut String, val: u32) {
     }
 }
 
-/// Internal download implementation using libhttp.
-fn download_inner(url: &str, output_path: &str, verbose: bool) -> bool {
-    if verbose {
-        println!("  downloading {}", url);
-    }
-
-    let result = if verbose {
-        libhttp_client::download_progress(url, output_path, progress_callback, 0)
-    } else {
-        libhttp_client::download(url, output_path)
-    };
-
-    if verbose {
-        println!(); // finalize progress bar line
-    }
-
-    if !result {
-        let err = libhttp_client::last_error();
-        let status = libhttp_client::last_status();
-        if verbose {
-            let err_msg = match err {
-                1 => "invalid URL",
-                2 => "DNS resolution failed",
-                3 => "connection failed",
-                4 => "send failed",
-                5 => "no response",
-                6 => "too many redirects",
-                7 => "TLS handshake failed",
-                9 => "file write error",
-                _ => "unknown error",
-            };
-            if status > 0 {
-                println!("apkg: download failed: HTTP {} ({})", status, err_msg);
-            } else {
-                println!("apkg: download failed: {}", err_msg);
-            }
-        }
-        return false;
-    }
-
-    true
+/// Check if a file exists.
+pub fn file_exists(path: &str) -> bool {
+    let mut stat_buf = [0u32; 7];
+    fs::stat(path, &mut stat_buf) == 0
 }
@@ -1,6 +1,34 @@
 //! Repository index parsing and querying.
 //!
-//! Reads `index.json` from cache and provides lookup by name, search, etc.
+//! Queries run against `index.bin`, a compact binary form of `index.json`
+//! that is read in one go and binary-searched in place, so a lookup
+//! decodes only the packages it returns.  `apkg update` fetches it from the
+//! mirror alongside `index.json` (`apkg-index -b` builds it there); when it
+//! is missing or older than `index.json` it is rebuilt from the JSON and
+//! cached.
+//!
+//! # `index.bin` format
+//!
+//! All integers little-endian.  A string is a `(u32 offset, u32 length)`
+//! reference into the string pool.
+//!
+//! ```text
+//! 0   8   magic "APKGIDX1"
+//! 8   4   package count          12  4   offset of package records
+//! 16  4   provider count         20  4   offset of provider records
+//! 24  4   delta count            28  4   offset of delta records
+//! 32  4   list entry count       36  4   offset of list entries
+//! 40  4   string pool length     44  4   offset of string pool
+//! 48  8   repository name (string)
+//! ```
+//!
+//! Package records (112 bytes, sorted by name): name, version,
+//! description, category, type, arch, md5, filename, min_os_version
+//! (strings), u64 size, u64 size_installed, then `(u32 first, u32 count)`
+//! ranges of depends and provides (list entries, which are strings) and
+//! of deltas.  Provider records (12 bytes, sorted by provided name): the
+//! name and the u32 index of the providing package.  Delta records (32
+//! bytes): from, filename and md5 (strings) and a u64 size.
 
 use alloc::string::String;
 use alloc::vec::Vec;
@@ -9,6 +37,16 @@ use anyos_std::fs;
 use crate::config;
 use crate::version::Version;
 
+/// A delta package that upgrades an installed older version (see `delta`).
+#[derive(Debug, Clone)]
+pub struct DeltaInfo {
+    /// Version the delta applies to.
+    pub from: String,
+    pub filename: String,
+    pub size: u64,
+    pub md5: String,
+}
+
 /// A single package entry from the repository index.
 #[derive(Debug, Clone)]
 pub struct PackageInfo {
@@ -26,88 +64,381 @@ pub struct PackageInfo {
     pub md5: String,
     pub filename: String,
     pub min_os_version: String,
+    pub deltas: Vec<DeltaInfo>,
 }
 
-/// Parsed repository index.
+impl PackageInfo {
+    /// The delta that upgrades `version` to this package, if the repository has one.
+    pub fn delta_from(&self, version: &str) -> Option<&DeltaInfo> {
+        self.deltas.iter().find(|d| d.from == version)
+    }
+}
+
+const MAGIC: &[u8; 8] = b"APKGIDX1";
+const HEADER_LEN: usize = 56;
+const PACKAGE_LEN: usize = 112;
+const PROVIDER_LEN: usize = 12;
+const DELTA_LEN: usize = 32;
+const STR_LEN: usize = 8;
+
+/// Fields of a package record, in string-reference slots.
+const F_NAME: usize = 0;
+const F_VERSION: usize = 1;
+const F_DESCRIPTION: usize = 2;
+const F_CATEGORY: usize = 3;
+const F_TYPE: usize = 4;
+const F_ARCH: usize = 5;
+const F_MD5: usize = 6;
+const F_FILENAME: usize = 7;
+const F_MIN_OS: usize = 8;
+
+/// The repository index, as the raw bytes of `index.bin`.
 pub struct Index {
-    pub repository: String,
-    pub packages: Vec<PackageInfo>,
+    data: Vec<u8>,
+    count: usize,
+    packages: usize,
+    provider_count: usize,
+    providers: usize,
+    delta_count: usize,
+    deltas: usize,
+    list_count: usize,
+    lists: usize,
+    pool_len: usize,
+    pool: usize,
 }
 
 impl Index {
-    /// Load the cached index from disk.
+    /// Load the cached index from disk, rebuilding `index.bin` from
+    /// `index.json` first if it is missing or stale.
     pub fn load() -> Option<Index> {
+        if let Some(idx) = Self::load_binary() {
+            return Some(idx);
+        }
         let content = fs::read_to_string(config::INDEX_PATH).ok()?;
-        Self::parse(&content)
+        let data = Self::build(&content)?;
+        // Best effort: a read-only cache only costs the next run a rebuild.
+        let _ = fs::write_bytes(config::INDEX_BIN_PATH, &data);
+        Self::from_bytes(data)
     }
 
-    /// Parse an index from JSON string.
-    pub fn parse(json_str: &str) -> Option<Index> {
-        let val = Value::parse(json_str).ok()?;
-        let repository = val["repository"].as_str().unwrap_or("unknown");
-        let packages_arr = val["packages"].as_array()?;
-
-        let mut packages = Vec::with_capacity(packages_arr.len());
-        for pkg in packages_arr {
-            let name = pkg["name"].as_str().unwrap_or("").into();
-            let version_str: String = pkg["version"].as_str().unwrap_or("0.0.0").into();
-            let version = Version::parse(&version_str).unwrap_or(Version { major: 0, minor: 0, patch: 0 });
-            let description = pkg["description"].as_str().unwrap_or("").into();
-            let category = pkg["category"].as_str().unwrap_or("").into();
-            let pkg_type = pkg["type"].as_str().unwrap_or("bin").into();
-            let arch = pkg["arch"].as_str().unwrap_or("x86_64").into();
-            let size = pkg["size"].as_u64().unwrap_or(0);
-            let size_installed = pkg["size_installed"].as_u64().unwrap_or(0);
-            let md5 = pkg["md5"].as_str().unwrap_or("").into();
-            let filename = pkg["filename"].as_str().unwrap_or("").into();
-            let min_os_version = pkg["min_os_version"].as_str().unwrap_or("0.0.0").into();
-
-            let depends = parse_string_array(&pkg["depends"]);
-            let provides = parse_string_array(&pkg["provides"]);
-
-            packages.push(PackageInfo {
-                name, version, version_str, description, category, pkg_type,
-                arch, depends, provides, size, size_installed, md5, filename,
-                min_os_version,
-            });
+    /// The cached binary index, unless `index.json` has changed since.
+    fn load_binary() -> Option<Index> {
+        let mut bin_stat = [0u32; 7];
+        if fs::stat(config::INDEX_BIN_PATH, &mut bin_stat) != 0 {
+            return None;
+        }
+        let mut json_stat = [0u32; 7];
+        if fs::stat(config::INDEX_PATH, &mut json_stat) == 0 && json_stat[6] > bin_stat[6] {
+            return None;
         }
+        Self::from_bytes(fs::read_to_vec(config::INDEX_BIN_PATH).ok()?)
+    }
+
+    /// Validate the header and table bounds of a binary index.
+    pub fn from_bytes(data: Vec<u8>) -> Option<Index> {
+        if data.len() < HEADER_LEN || &data[..8] != MAGIC {
+            return None;
+        }
+        let field = |off: usize| rd32(&data, off) as usize;
+        let idx = Index {
+            count: field(8),
+            packages: field(12),
+            provider_count: field(16),
+            providers: field(20),
+            delta_count: field(24),
+            deltas: field(28),
+            list_count: field(32),
+            lists: field(36),
+            pool_len: field(40),
+            pool: field(44),
+            data,
+        };
+        let fits = |off: usize, n: usize, len: usize| {
+            n.checked_mul(len).and_then(|s| s.checked_add(off)).map_or(false, |end| end <= idx.data.len())
+        };
+        if !fits(idx.packages, idx.count, PACKAGE_LEN)
+            || !fits(idx.providers, idx.provider_count, PROVIDER_LEN)
+            || !fits(idx.deltas, idx.delta_count, DELTA_LEN)
+            || !fits(idx.lists, idx.list_count, STR_LEN)
+            || !fits(idx.pool, idx.pool_len, 1)
+        {
+            return None;
+        }
+        Some(idx)
+    }
 
-        Some(Index {
-            repository: String::from(repository),
-            packages,
-        })
+    /// Number of packages in the index.
+    pub fn len(&self) -> usize {
+        self.count
     }
 
     /// Find a package by exact name.
-    pub fn find(&self, name: &str) -> Option<&PackageInfo> {
-        self.packages.iter().find(|p| p.name == name)
+    pub fn find(&self, name: &str) -> Option<PackageInfo> {
+        self.position(name).map(|i| self.package(i))
     }
 
     /// Find a package by name or by a name that a package provides.
-    pub fn find_provider(&self, name: &str) -> Option<&PackageInfo> {
+    pub fn find_provider(&self, name: &str) -> Option<PackageInfo> {
         // Exact name match first
         if let Some(p) = self.find(name) {
             return Some(p);
         }
         // Check provides
-        self.packages.iter().find(|p| p.provides.iter().any(|prov| prov == name))
+        let key = name.as_bytes();
+        let (mut lo, mut hi) = (0, self.provider_count);
+        while lo < hi {
+            let mid = (lo + hi) / 2;
+            if self.str_at(self.providers + mid * PROVIDER_LEN).as_bytes() < key {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if lo < self.provider_count {
+            let rec = self.providers + lo * PROVIDER_LEN;
+            if self.str_at(rec) == name {
+                let i = rd32(&self.data, rec + STR_LEN) as usize;
+                if i < self.count {
+                    return Some(self.package(i));
+                }
+            }
+        }
+        None
     }
 
     /// Search packages by name or description substring (case-insensitive).
-    pub fn search(&self, term: &str) -> Vec<&PackageInfo> {
-        let term_lower = to_lower(term);
-        self.packages.iter().filter(|p| {
-            to_lower(&p.name).contains(&term_lower)
-                || to_lower(&p.description).contains(&term_lower)
-        }).collect()
+    pub fn search(&self, term: &str) -> Vec<PackageInfo> {
+        let needle: Vec<u8> = term.bytes().map(|b| b.to_ascii_lowercase()).collect();
+        (0..self.count).filter(|&i| {
+            contains_ignore_case(self.field(i, F_NAME).as_bytes(), &needle)
+                || contains_ignore_case(self.field(i, F_DESCRIPTION).as_bytes(), &needle)
+        }).map(|i| self.package(i)).collect()
     }
 
     /// List all packages filtered by architecture.
-    pub fn list_for_arch(&self, arch: &str) -> Vec<&PackageInfo> {
-        self.packages.iter().filter(|p| p.arch == arch).collect()
+    pub fn list_for_arch(&self, arch: &str) -> Vec<PackageInfo> {
+        (0..self.count).filter(|&i| self.field(i, F_ARCH) == arch)
+            .map(|i| self.package(i)).collect()
+    }
+
+    /// Index of the first package record named `name`.
+    fn position(&self, name: &str) -> Option<usize> {
+        let key = name.as_bytes();
+        let (mut lo, mut hi) = (0, self.count);
+        while lo < hi {
+            let mid = (lo + hi) / 2;
+            if self.field(mid, F_NAME).as_bytes() < key {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if lo < self.count && self.field(lo, F_NAME) == name { Some(lo) } else { None }
+    }
+
+    /// Decode package record `i`.
+    fn package(&self, i: usize) -> PackageInfo {
+        let rec = self.packages + i * PACKAGE_LEN;
+        let version_str = String::from(self.field(i, F_VERSION));
+        let version = Version::parse(&version_str).unwrap_or(Version { major: 0, minor: 0, patch: 0 });
+        let deltas = self.range(rec + 104, self.delta_count).map(|d| {
+            let at = self.deltas + d * DELTA_LEN;
+            DeltaInfo {
+                from: String::from(self.str_at(at)),
+                filename: String::from(self.str_at(at + STR_LEN)),
+                md5: String::from(self.str_at(at + 2 * STR_LEN)),
+                size: rd64(&self.data, at + 3 * STR_LEN),
+            }
+        }).collect();
+        PackageInfo {
+            name: String::from(self.field(i, F_NAME)),
+            version,
+            version_str,
+            description: String::from(self.field(i, F_DESCRIPTION)),
+            category: String::from(self.field(i, F_CATEGORY)),
+            pkg_type: String::from(self.field(i, F_TYPE)),
+            arch: String::from(self.field(i, F_ARCH)),
+            depends: self.list(rec + 88),
+            provides: self.list(rec + 96),
+            size: rd64(&self.data, rec + 72),
+            size_installed: rd64(&self.data, rec + 80),
+            md5: String::from(self.field(i, F_MD5)),
+            filename: String::from(self.field(i, F_FILENAME)),
+            min_os_version: String::from(self.field(i, F_MIN_OS)),
+            deltas,
+        }
+    }
+
+    /// String field `slot` of package record `i`.
+    fn field(&self, i: usize, slot: usize) -> &str {
+        self.str_at(self.packages + i * PACKAGE_LEN + slot * STR_LEN)
+    }
+
+    /// Resolve the string reference stored at `at` ("" if out of bounds).
+    fn str_at(&self, at: usize) -> &str {
+        let off = rd32(&self.data, at) as usize;
+        let len = rd32(&self.data, at + 4) as usize;
+        let end = match off.checked_add(len) {
+            Some(e) if e <= self.pool_len => e,
+            _ => return "",
+        };
+        core::str::from_utf8(&self.data[self.pool + off..self.pool + end]).unwrap_or("")
+    }
+
+    /// The `(first, count)` range stored at `at`, clamped to `limit`.
+    fn range(&self, at: usize, limit: usize) -> core::ops::Range<usize> {
+        let first = (rd32(&self.data, at) as usize).min(limit);
+        let count = rd32(&self.data, at + 4) as usize;
+        first..first.saturating_add(count).min(limit)
+    }
+
+    /// The string list whose range is stored at `at`.
+    fn list(&self, at: usize) -> Vec<String> {
+        self.range(at, self.list_count)
+            .map(|e| String::from(self.str_at(self.lists + e * STR_LEN)))
+            .collect()
+    }
+
+    /// Build `index.bin` from the text of `index.json`.
+    pub fn build(json_str: &str) -> Option<Vec<u8>> {
+        let val = Value::parse(json_str).ok()?;
+        let repository = val["repository"].as_str().unwrap_or("unknown");
+        let mut packages = parse_packages(val["packages"].as_array()?);
+        // Stable, so the first of several same-named entries still wins.
+        packages.sort_by(|a, b| a.name.as_bytes().cmp(b.name.as_bytes()));
+        Some(encode(repository, &packages))
     }
 }
 
+/// Parse the `packages` array of `index.json`.
+fn parse_packages(packages_arr: &[Value]) -> Vec<PackageInfo> {
+    let mut packages = Vec::with_capacity(packages_arr.len());
+    for pkg in packages_arr {
+        let name = pkg["name"].as_str().unwrap_or("").into();
+        let version_str: String = pkg["version"].as_str().unwrap_or("0.0.0").into();
+        let version = Version::parse(&version_str).unwrap_or(Version { major: 0, minor: 0, patch: 0 });
+        let description = pkg["description"].as_str().unwrap_or("").into();
+        let category = pkg["category"].as_str().unwrap_or("").into();
+        let pkg_type = pkg["type"].as_str().unwrap_or("bin").into();
+        let arch = pkg["arch"].as_str().unwrap_or("x86_64").into();
+        let size = pkg["size"].as_u64().unwrap_or(0);
+        let size_installed = pkg["size_installed"].as_u64().unwrap_or(0);
+        let md5 = pkg["md5"].as_str().unwrap_or("").into();
+        let filename = pkg["filename"].as_str().unwrap_or("").into();
+        let min_os_version = pkg["min_os_version"].as_str().unwrap_or("0.0.0").into();
+
+        let depends = parse_string_array(&pkg["depends"]);
+        let provides = parse_string_array(&pkg["provides"]);
+        let deltas = match pkg["deltas"].as_array() {
+            Some(arr) => arr.iter().map(|d| DeltaInfo {
+                from: d["from"].as_str().unwrap_or("").into(),
+                filename: d["filename"].as_str().unwrap_or("").into(),
+                size: d["size"].as_u64().unwrap_or(0),
+                md5: d["md5"].as_str().unwrap_or("").into(),
+            }).filter(|d| !d.from.is_empty() && !d.filename.is_empty()).collect(),
+            None => Vec::new(),
+        };
+
+        packages.push(PackageInfo {
+            name, version, version_str, description, category, pkg_type,
+            arch, depends, provides, size, size_installed, md5, filename,
+            min_os_version, deltas,
+        });
+    }
+    packages
+}
+
+/// Serialize packages (already sorted by name) as `index.bin`.
+fn encode(repository: &str, packages: &[PackageInfo]) -> Vec<u8> {
+    let mut pool: Vec<u8> = Vec::new();
+    let mut recs: Vec<u8> = Vec::with_capacity(packages.len() * PACKAGE_LEN);
+    let mut lists: Vec<u8> = Vec::new();
+    let mut deltas: Vec<u8> = Vec::new();
+    let mut providers: Vec<(&str, u32)> = Vec::new();
+    let (mut list_count, mut delta_count) = (0u32, 0u32);
+
+    for (i, p) in packages.iter().enumerate() {
+        for s in [&p.name, &p.version_str, &p.description, &p.category, &p.pkg_type,
+                  &p.arch, &p.md5, &p.filename, &p.min_os_version] {
+            put_str(&mut recs, &mut pool, s);
+        }
+        put64(&mut recs, p.size);
+        put64(&mut recs, p.size_installed);
+        for names in [&p.depends, &p.provides] {
+            put32(&mut recs, list_count);
+            put32(&mut recs, names.len() as u32);
+            for n in names.iter() {
+                put_str(&mut lists, &mut pool, n);
+            }
+            list_count += names.len() as u32;
+        }
+        put32(&mut recs, delta_count);
+        put32(&mut recs, p.deltas.len() as u32);
+        for d in &p.deltas {
+            put_str(&mut deltas, &mut pool, &d.from);
+            put_str(&mut deltas, &mut pool, &d.filename);
+            put_str(&mut deltas, &mut pool, &d.md5);
+            put64(&mut deltas, d.size);
+        }
+        delta_count += p.deltas.len() as u32;
+        providers.extend(p.provides.iter().map(|n| (n.as_str(), i as u32)));
+    }
+
+    providers.sort_by(|a, b| a.0.as_bytes().cmp(b.0.as_bytes()));
+    let mut prov: Vec<u8> = Vec::with_capacity(providers.len() * PROVIDER_LEN);
+    for (name, i) in &providers {
+        put_str(&mut prov, &mut pool, name);
+        put32(&mut prov, *i);
+    }
+
+    let mut out: Vec<u8> = Vec::with_capacity(HEADER_LEN + recs.len() + prov.len()
+        + deltas.len() + lists.len() + pool.len() + repository.len());
+    let packages_off = HEADER_LEN;
+    let providers_off = packages_off + recs.len();
+    let deltas_off = providers_off + prov.len();
+    let lists_off = deltas_off + deltas.len();
+    let pool_off = lists_off + lists.len();
+    let mut repo_ref: Vec<u8> = Vec::with_capacity(STR_LEN);
+    put_str(&mut repo_ref, &mut pool, repository);
+
+    out.extend_from_slice(MAGIC);
+    for v in [packages.len(), packages_off, providers.len(), providers_off,
+              delta_count as usize, deltas_off, list_count as usize, lists_off,
+              pool.len(), pool_off] {
+        put32(&mut out, v as u32);
+    }
+    out.extend_from_slice(&repo_ref);
+    out.extend_from_slice(&recs);
+    out.extend_from_slice(&prov);
+    out.extend_from_slice(&deltas);
+    out.extend_from_slice(&lists);
+    out.extend_from_slice(&pool);
+    out
+}
+
+fn put32(out: &mut Vec<u8>, v: u32) {
+    out.extend_from_slice(&v.to_le_bytes());
+}
+
+fn put64(out: &mut Vec<u8>, v: u64) {
+    out.extend_from_slice(&v.to_le_bytes());
+}
+
+/// Append `s` to the pool and its reference to `out`.
+fn put_str(out: &mut Vec<u8>, pool: &mut Vec<u8>, s: &str) {
+    put32(out, pool.len() as u32);
+    put32(out, s.len() as u32);
+    pool.extend_from_slice(s.as_bytes());
+}
+
+fn rd32(data: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes([data[off], data[off + 1], data[off + 2], data[off + 3]])
+}
+
+fn rd64(data: &[u8], off: usize) -> u64 {
+    rd32(data, off) as u64 | (rd32(data, off + 4) as u64) << 32
+}
+
 /// Parse a JSON array of strings.
 fn parse_string_array(val: &Value) -> Vec<String> {
     match val.as_array() {
@@ -116,15 +447,12 @@ fn parse_string_array(val: &Value) -> Vec<String> {
     }
 }
 
-/// Simple ASCII lowercase conversion.
-fn to_lower(s: &str) -> String {
-    let mut out = String::with_capacity(s.len());
-    for b in s.bytes() {
-        if b >= b'A' && b <= b'Z' {
-            out.push((b + 32) as char);
-        } else {
-            out.push(b as char);
-        }
+/// Whether `hay` contains `needle_lower` (already lowercase), ignoring ASCII case.
+fn contains_ignore_case(hay: &[u8], needle_lower: &[u8]) -> bool {
+    if needle_lower.is_empty() {
+        return true;
     }
-    out
+    hay.windows(needle_lower.len())
+        .any(|w| w.iter().zip(needle_lower).all(|(&h, &n)| h.to_ascii_lowercase() == n))
 }
+
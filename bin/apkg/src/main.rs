@@ -16,6 +16,12 @@
 //! apkg autoremove                      Remove unused auto-dependencies
 //! apkg mirror list|add|remove [url]    Manage mirror URLs
 //! ```
+//!
+//! Downloads run several at a time (`parallel_downloads` in
+//! `/System/etc/apkg/apkg.conf`), resume after interruption, and upgrade
+//! via delta packages when the index offers one for the installed
+//! version.  `apkg fetch <file> <md5> <size>` is the internal per-download
+//! child process.
 
 #![no_std]
 #![no_main]
@@ -29,6 +35,7 @@ mod config;
 mod index;
 mod db;
 mod download;
+mod delta;
 mod archive;
 mod resolve;
 mod commands;
@@ -48,6 +55,7 @@ fn main() {
 
     // Ensure directories exist
     config::ensure_dirs();
+    libhttp_client::set_session_cache(config::TLS_SESSION_PATH);
 
     // Parse arguments
     let mut args_buf = [0u8; 256];
@@ -109,6 +117,11 @@ fn main() {
             let arg = args.pos(2).unwrap_or("");
             commands::mirror::run(subcmd, arg);
         }
+        "fetch" => {
+            commands::fetch::run(args.pos(1).unwrap_or(""),
+                                 args.pos(2).unwrap_or("-"),
+                                 args.pos(3).unwrap_or("0"));
+        }
         "help" | "--help" | "-h" => {
             print_usage();
         }
@@ -0,0 +1,732 @@
+//! Compilation of the parsed program to bytecode.
+//!
+//! Variable and array names are resolved to slots here, so the VM never
+//! looks a name up while running.  Operands used as numbers are loaded with
+//! the `*Num` ops, which let the VM keep the parsed value next to the
+//! string (see `Value::StrNum`).  `&&` and `||` short-circuit.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::HashMap;
+
+use crate::{BinOp, Expr, Pattern, Regex, Rule, Stmt, UnaryOp};
+
+/// Built-in variables kept in dedicated VM fields.
+#[derive(Clone, Copy)]
+pub enum Special {
+    Nr,
+    Fnr,
+    Nf,
+    Fs,
+    Ofs,
+    Ors,
+}
+
+/// Built-in functions that only take and return values.
+#[derive(Clone, Copy)]
+pub enum Builtin {
+    Length,
+    Substr,
+    Index,
+    Sprintf,
+    Tolower,
+    Toupper,
+    Sin,
+    Cos,
+    Sqrt,
+    Log,
+    Exp,
+    Int,
+    Rand,
+    Srand,
+}
+
+/// One VM instruction.  Jump targets are indices into the same block.
+#[derive(Clone, Copy)]
+pub enum Op {
+    Num(f64),
+    /// Push `strings[i]`.
+    Str(u32),
+    Uninit,
+    Pop,
+    Dup,
+    Swap,
+
+    LoadVar(u16),
+    /// Push the variable as a number, caching the conversion in the slot.
+    LoadVarNum(u16),
+    /// Store the top of stack into the variable, leaving it on the stack.
+    StoreVar(u16),
+    LoadSpecial(Special),
+    StoreSpecial(Special),
+    /// `$n` for a constant n.
+    FieldConst(u32),
+    FieldConstNum(u32),
+    /// `$(top)`.
+    LoadField,
+    LoadFieldNum,
+    /// [index, value] -> [value]
+    StoreField,
+    /// [key] -> [value]
+    LoadElem(u16),
+    /// [key, value] -> [value]
+    StoreElem(u16),
+    InArray(u16),
+    DeleteElem(u16),
+    DeleteArray(u16),
+    /// Add `delta`; push the new value if `pre`, otherwise the old one.
+    IncrVar(u16, i8, bool),
+    IncrSpecial(Special, i8, bool),
+    /// [index] -> [value]
+    IncrField(i8, bool),
+    /// [key] -> [value]
+    IncrElem(u16, i8, bool),
+
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Neg,
+    Not,
+    Eq,
+    Ne,
+    Lt,
+    Gt,
+    Le,
+    Ge,
+    Concat,
+    /// Pop a string, push whether `regexes[i]` matches it.
+    Match(u32),
+    /// Push whether `regexes[i]` matches `$0`.
+    MatchRecord(u32),
+
+    Jmp(u32),
+    /// Pop; jump if false.
+    Jz(u32),
+    /// Pop; jump if true.
+    Jnz(u32),
+
+    Call(Builtin, u8),
+    /// split(str, arr[, sep]): pops sep (if present) and str, pushes the count.
+    Split(u16, bool),
+    /// [pattern, replacement, target] -> [count, result]
+    Subst(bool),
+    /// Print `n` values, to `redirects[r]` unless r == NO_REDIRECT.
+    Print(u8, u32),
+    Printf(u8, u32),
+
+    /// Start iterating over the keys of an array.
+    IterStart(u16),
+    /// Assign the next key to the variable, or end the loop and jump.
+    IterNext(u16, u32),
+
+    Next,
+    /// Exit, with the popped status if set.
+    Exit(bool),
+    Halt,
+}
+
+pub const NO_REDIRECT: u32 = u32::MAX;
+
+/// A `> file` target: a variable holding the name, else the literal name.
+pub struct Redirect {
+    pub name: String,
+    pub var: Option<u16>,
+}
+
+pub struct Program {
+    pub begin: Vec<Op>,
+    pub main: Vec<Op>,
+    pub end: Vec<Op>,
+    pub strings: Vec<String>,
+    pub regexes: Vec<Regex>,
+    pub redirects: Vec<Redirect>,
+    /// Scalar variable slots by name (for `-v` and FILENAME).
+    pub vars: HashMap<String, u16>,
+    pub num_vars: usize,
+    pub num_arrays: usize,
+    /// Whether input must be read at all (there are non-BEGIN rules).
+    pub reads_input: bool,
+}
+
+enum VarRef {
+    Special(Special),
+    Slot(u16),
+}
+
+struct Compiler {
+    code: Vec<Op>,
+    strings: Vec<String>,
+    regexes: Vec<Regex>,
+    redirects: Vec<Redirect>,
+    vars: HashMap<String, u16>,
+    arrays: HashMap<String, u16>,
+}
+
+pub fn compile(rules: &[Rule]) -> Program {
+    let mut c = Compiler {
+        code: Vec::new(),
+        strings: Vec::new(),
+        regexes: Vec::new(),
+        redirects: Vec::new(),
+        vars: HashMap::new(),
+        arrays: HashMap::new(),
+    };
+    c.slot("FILENAME");
+
+    for rule in rules {
+        if let Pattern::Begin = rule.pattern {
+            c.stmts(&rule.action);
+        }
+    }
+    let begin = c.finish();
+
+    let mut reads_input = false;
+    for rule in rules {
+        let skip = match &rule.pattern {
+            Pattern::Begin => continue,
+            Pattern::End => {
+                reads_input = true;
+                continue;
+            }
+            Pattern::All => None,
+            Pattern::Regex(pat) => {
+                let re = c.regex(pat);
+                c.code.push(Op::MatchRecord(re));
+                Some(c.jump(Op::Jz(0)))
+            }
+            Pattern::Expr(e) => {
+                c.expr(e, false);
+                Some(c.jump(Op::Jz(0)))
+            }
+        };
+        reads_input = true;
+        c.stmts(&rule.action);
+        if let Some(at) = skip {
+            c.patch(at);
+        }
+    }
+    let main = c.finish();
+
+    for rule in rules {
+        if let Pattern::End = rule.pattern {
+            c.stmts(&rule.action);
+        }
+    }
+    let end = c.finish();
+
+    Program {
+        begin,
+        main,
+        end,
+        num_vars: c.vars.len(),
+        num_arrays: c.arrays.len(),
+        strings: c.strings,
+        regexes: c.regexes,
+        redirects: c.redirects,
+        vars: c.vars,
+        reads_input,
+    }
+}
+
+impl Compiler {
+    fn finish(&mut self) -> Vec<Op> {
+        self.code.push(Op::Halt);
+        core::mem::take(&mut self.code)
+    }
+
+    fn slot(&mut self, name: &str) -> u16 {
+        let key = String::from(name);
+        if let Some(&s) = self.vars.get(&key) {
+            return s;
+        }
+        let s = self.vars.len() as u16;
+        self.vars.insert(key, s);
+        s
+    }
+
+    fn array(&mut self, name: &str) -> u16 {
+        let key = String::from(name);
+        if let Some(&s) = self.arrays.get(&key) {
+            return s;
+        }
+        let s = self.arrays.len() as u16;
+        self.arrays.insert(key, s);
+        s
+    }
+
+    fn var(&mut self, name: &str) -> VarRef {
+        match name {
+            "NR" => VarRef::Special(Special::Nr),
+            "FNR" => VarRef::Special(Special::Fnr),
+            "NF" => VarRef::Special(Special::Nf),
+            "FS" => VarRef::Special(Special::Fs),
+            "OFS" => VarRef::Special(Special::Ofs),
+            "ORS" => VarRef::Special(Special::Ors),
+            _ => VarRef::Slot(self.slot(name)),
+        }
+    }
+
+    fn string(&mut self, s: &str) -> u32 {
+        self.strings.push(String::from(s));
+        (self.strings.len() - 1) as u32
+    }
+
+    fn regex(&mut self, pat: &str) -> u32 {
+        self.regexes.push(Regex::new(pat));
+        (self.regexes.len() - 1) as u32
+    }
+
+    fn redirect(&mut self, file: &Option<String>) -> u32 {
+        match file {
+            None => NO_REDIRECT,
+            Some(name) => {
+                let var = Some(self.slot(name));
+                self.redirects.push(Redirect { name: name.clone(), var });
+                (self.redirects.len() - 1) as u32
+            }
+        }
+    }
+
+    /// Emit a jump with a placeholder target; returns its index for `patch`.
+    fn jump(&mut self, op: Op) -> usize {
+        self.code.push(op);
+        self.code.len() - 1
+    }
+
+    /// Point the jump at `at` to the next instruction.
+    fn patch(&mut self, at: usize) {
+        let here = self.code.len() as u32;
+        self.code[at] = match self.code[at] {
+            Op::Jmp(_) => Op::Jmp(here),
+            Op::Jz(_) => Op::Jz(here),
+            Op::Jnz(_) => Op::Jnz(here),
+            Op::IterNext(v, _) => Op::IterNext(v, here),
+            op => op,
+        };
+    }
+
+    fn here(&self) -> u32 {
+        self.code.len() as u32
+    }
+
+    fn stmts(&mut self, stmts: &[Stmt]) {
+        for s in stmts {
+            self.stmt(s);
+        }
+    }
+
+    fn stmt(&mut self, stmt: &Stmt) {
+        match stmt {
+            Stmt::ExprStmt(e) => {
+                self.expr(e, false);
+                self.code.push(Op::Pop);
+            }
+            Stmt::Print(exprs, file) | Stmt::Printf(exprs, file) => {
+                for e in exprs {
+                    self.expr(e, false);
+                }
+                let r = self.redirect(file);
+                let n = exprs.len() as u8;
+                self.code.push(if let Stmt::Print(..) = stmt { Op::Print(n, r) } else { Op::Printf(n, r) });
+            }
+            Stmt::If(cond, then_stmt, else_stmt) => {
+                self.expr(cond, false);
+                let to_else = self.jump(Op::Jz(0));
+                self.stmt(then_stmt);
+                match else_stmt {
+                    Some(els) => {
+                        let to_end = self.jump(Op::Jmp(0));
+                        self.patch(to_else);
+                        self.stmt(els);
+                        self.patch(to_end);
+                    }
+                    None => self.patch(to_else),
+                }
+            }
+            Stmt::While(cond, body) => {
+                let top = self.here();
+                self.expr(cond, false);
+                let exit = self.jump(Op::Jz(0));
+                self.stmt(body);
+                self.code.push(Op::Jmp(top));
+                self.patch(exit);
+            }
+            Stmt::DoWhile(body, cond) => {
+                let top = self.here();
+                self.stmt(body);
+                self.expr(cond, false);
+                self.code.push(Op::Jnz(top));
+            }
+            Stmt::For(init, cond, update, body) => {
+                self.stmt(init);
+                let top = self.here();
+                self.expr(cond, false);
+                let exit = self.jump(Op::Jz(0));
+                self.stmt(body);
+                self.stmt(update);
+                self.code.push(Op::Jmp(top));
+                self.patch(exit);
+            }
+            Stmt::ForIn(var, arr, body) => {
+                let a = self.array(arr);
+                let v = self.slot(var);
+                self.code.push(Op::IterStart(a));
+                let top = self.here();
+                let exit = self.jump(Op::IterNext(v, 0));
+                self.stmt(body);
+                self.code.push(Op::Jmp(top));
+                self.patch(exit);
+            }
+            Stmt::Block(stmts) => self.stmts(stmts),
+            Stmt::Next => self.code.push(Op::Next),
+            Stmt::Exit(code) => match code {
+                Some(e) => {
+                    self.expr(e, true);
+                    self.code.push(Op::Exit(true));
+                }
+                None => self.code.push(Op::Exit(false)),
+            },
+            Stmt::Delete(name, idx) => {
+                let a = self.array(name);
+                match idx {
+                    Expr::Str(s) if s.is_empty() => self.code.push(Op::DeleteArray(a)),
+                    _ => {
+                        self.expr(idx, false);
+                        self.code.push(Op::DeleteElem(a));
+                    }
+                }
+            }
+        }
+    }
+
+    /// Compile `e`, leaving one value on the stack.  `num` marks a numeric
+    /// context, where variables and fields are loaded as numbers.
+    fn expr(&mut self, e: &Expr, num: bool) {
+        match e {
+            Expr::Num(n) => self.code.push(Op::Num(*n)),
+            Expr::Str(s) => {
+                let i = self.string(s);
+                self.code.push(Op::Str(i));
+            }
+            Expr::Regex(pat) => {
+                let re = self.regex(pat);
+                self.code.push(Op::MatchRecord(re));
+            }
+            Expr::Field(idx) => match **idx {
+                Expr::Num(n) if n >= 0.0 => {
+                    let n = n as u32;
+                    self.code.push(if num { Op::FieldConstNum(n) } else { Op::FieldConst(n) });
+                }
+                _ => {
+                    self.expr(idx, true);
+                    self.code.push(if num { Op::LoadFieldNum } else { Op::LoadField });
+                }
+            },
+            Expr::Var(name) => match self.var(name) {
+                VarRef::Special(s) => self.code.push(Op::LoadSpecial(s)),
+                VarRef::Slot(s) => self.code.push(if num { Op::LoadVarNum(s) } else { Op::LoadVar(s) }),
+            },
+            Expr::ArrayRef(name, idx) => {
+                let a = self.array(name);
+                self.expr(idx, false);
+                self.code.push(Op::LoadElem(a));
+            }
+            Expr::BinOp(l, op, r) => self.binop(l, *op, r),
+            Expr::UnaryOp(UnaryOp::Neg, v) => {
+                self.expr(v, true);
+                self.code.push(Op::Neg);
+            }
+            Expr::UnaryOp(UnaryOp::Not, v) => {
+                self.expr(v, false);
+                self.code.push(Op::Not);
+            }
+            Expr::Assign(target, val) => self.assign(target, val),
+            Expr::CompoundAssign(target, op, val) => self.compound(target, *op, val),
+            Expr::Incr(target, pre) => self.incr(target, 1, *pre),
+            Expr::Decr(target, pre) => self.incr(target, -1, *pre),
+            Expr::Match(v, pat) | Expr::NotMatch(v, pat) => {
+                self.expr(v, false);
+                let re = self.regex(pat);
+                self.code.push(Op::Match(re));
+                if let Expr::NotMatch(..) = e {
+                    self.code.push(Op::Not);
+                }
+            }
+            Expr::Concat(a, b) => {
+                self.expr(a, false);
+                self.expr(b, false);
+                self.code.push(Op::Concat);
+            }
+            Expr::Call(name, args) => self.call(name, args),
+            Expr::Getline => self.code.push(Op::Num(0.0)),
+            Expr::In(name, idx) => {
+                let a = self.array(name);
+                self.expr(idx, false);
+                self.code.push(Op::InArray(a));
+            }
+        }
+    }
+
+    fn binop(&mut self, l: &Expr, op: BinOp, r: &Expr) {
+        let code = match op {
+            BinOp::And | BinOp::Or => {
+                // a && b: a; Jz F; b; Jz F; 1; Jmp E; F: 0; E:
+                // a || b: a; Jnz T; b; Jnz T; 0; Jmp E; T: 1; E:
+                let (branch, hit, miss) = if let BinOp::And = op {
+                    (Op::Jz(0), 0.0, 1.0)
+                } else {
+                    (Op::Jnz(0), 1.0, 0.0)
+                };
+                self.expr(l, false);
+                let j1 = self.jump(branch);
+                self.expr(r, false);
+                let j2 = self.jump(branch);
+                self.code.push(Op::Num(miss));
+                let to_end = self.jump(Op::Jmp(0));
+                self.patch(j1);
+                self.patch(j2);
+                self.code.push(Op::Num(hit));
+                self.patch(to_end);
+                return;
+            }
+            // Equality compares the string forms.
+            BinOp::Eq | BinOp::Ne => {
+                self.expr(l, false);
+                self.expr(r, false);
+                self.code.push(if let BinOp::Eq = op { Op::Eq } else { Op::Ne });
+                return;
+            }
+            BinOp::Add => Op::Add,
+            BinOp::Sub => Op::Sub,
+            BinOp::Mul => Op::Mul,
+            BinOp::Div => Op::Div,
+            BinOp::Mod => Op::Mod,
+            BinOp::Lt => Op::Lt,
+            BinOp::Gt => Op::Gt,
+            BinOp::Le => Op::Le,
+            BinOp::Ge => Op::Ge,
+        };
+        self.expr(l, true);
+        self.expr(r, true);
+        self.code.push(code);
+    }
+
+    fn assign(&mut self, target: &Expr, val: &Expr) {
+        match target {
+            Expr::Var(name) => {
+                self.expr(val, false);
+                match self.var(name) {
+                    VarRef::Special(s) => self.code.push(Op::StoreSpecial(s)),
+                    VarRef::Slot(s) => self.code.push(Op::StoreVar(s)),
+                }
+            }
+            Expr::Field(idx) => {
+                self.expr(idx, true);
+                self.expr(val, false);
+                self.code.push(Op::StoreField);
+            }
+            Expr::ArrayRef(name, key) => {
+                let a = self.array(name);
+                self.expr(key, false);
+                self.expr(val, false);
+                self.code.push(Op::StoreElem(a));
+            }
+            _ => self.expr(val, false),
+        }
+    }
+
+    fn compound(&mut self, target: &Expr, op: BinOp, val: &Expr) {
+        let arith = match op {
+            BinOp::Add => Some(Op::Add),
+            BinOp::Sub => Some(Op::Sub),
+            BinOp::Mul => Some(Op::Mul),
+            BinOp::Div => Some(Op::Div),
+            _ => None,
+        };
+        let apply = |c: &mut Compiler| {
+            match arith {
+                Some(op) => {
+                    c.expr(val, true);
+                    c.code.push(op);
+                }
+                None => {
+                    // Unsupported operator: the target keeps its value.
+                    c.expr(val, true);
+                    c.code.push(Op::Pop);
+                    c.code.push(Op::Num(0.0));
+                    c.code.push(Op::Add);
+                }
+            }
+        };
+        match target {
+            Expr::Var(name) => match self.var(name) {
+                VarRef::Special(s) => {
+                    self.code.push(Op::LoadSpecial(s));
+                    apply(self);
+                    self.code.push(Op::StoreSpecial(s));
+                }
+                VarRef::Slot(s) => {
+                    self.code.push(Op::LoadVarNum(s));
+                    apply(self);
+                    self.code.push(Op::StoreVar(s));
+                }
+            },
+            Expr::Field(idx) => {
+                self.expr(idx, true);
+                self.code.push(Op::Dup);
+                self.code.push(Op::LoadFieldNum);
+                apply(self);
+                self.code.push(Op::StoreField);
+            }
+            Expr::ArrayRef(name, key) => {
+                let a = self.array(name);
+                self.expr(key, false);
+                self.code.push(Op::Dup);
+                self.code.push(Op::LoadElem(a));
+                apply(self);
+                self.code.push(Op::StoreElem(a));
+            }
+            _ => {
+                self.expr(target, true);
+                apply(self);
+            }
+        }
+    }
+
+    fn incr(&mut self, target: &Expr, delta: i8, pre: bool) {
+        match target {
+            Expr::Var(name) => match self.var(name) {
+                VarRef::Special(s) => self.code.push(Op::IncrSpecial(s, delta, pre)),
+                VarRef::Slot(s) => self.code.push(Op::IncrVar(s, delta, pre)),
+            },
+            Expr::Field(idx) => {
+                self.expr(idx, true);
+                self.code.push(Op::IncrField(delta, pre));
+            }
+            Expr::ArrayRef(name, key) => {
+                let a = self.array(name);
+                self.expr(key, false);
+                self.code.push(Op::IncrElem(a, delta, pre));
+            }
+            _ => self.expr(target, true),
+        }
+    }
+
+    fn call(&mut self, name: &str, args: &[Expr]) {
+        let (builtin, min_args) = match name {
+            "length" => {
+                if args.is_empty() {
+                    self.code.push(Op::FieldConst(0));
+                } else {
+                    self.expr(&args[0], false);
+                }
+                self.code.push(Op::Call(Builtin::Length, 1));
+                return;
+            }
+            "split" => {
+                let arr = match args.get(1) {
+                    Some(Expr::Var(n)) => self.array(n),
+                    _ => self.array("_split"),
+                };
+                self.arg(args, 0, false);
+                if args.len() > 2 {
+                    self.expr(&args[2], false);
+                }
+                self.code.push(Op::Split(arr, args.len() > 2));
+                return;
+            }
+            "sub" | "gsub" => {
+                self.subst(args, name == "gsub");
+                return;
+            }
+            "substr" => (Builtin::Substr, 2),
+            "index" => (Builtin::Index, 2),
+            "sprintf" => (Builtin::Sprintf, 0),
+            "tolower" => (Builtin::Tolower, 1),
+            "toupper" => (Builtin::Toupper, 1),
+            "sin" => (Builtin::Sin, 1),
+            "cos" => (Builtin::Cos, 1),
+            "sqrt" => (Builtin::Sqrt, 1),
+            "log" => (Builtin::Log, 1),
+            "exp" => (Builtin::Exp, 1),
+            "int" => (Builtin::Int, 1),
+            "rand" => (Builtin::Rand, 0),
+            "srand" => (Builtin::Srand, 0),
+            _ => {
+                self.code.push(Op::Uninit);
+                return;
+            }
+        };
+        let n = args.len().max(min_args);
+        for i in 0..n {
+            self.arg(args, i, false);
+        }
+        self.code.push(Op::Call(builtin, n as u8));
+    }
+
+    /// Compile argument `i`, or push an uninitialized value if it is missing.
+    fn arg(&mut self, args: &[Expr], i: usize, num: bool) {
+        match args.get(i) {
+            Some(e) => self.expr(e, num),
+            None => self.code.push(Op::Uninit),
+        }
+    }
+
+    /// sub/gsub(pattern, replacement[, target]): leaves the count.
+    fn subst(&mut self, args: &[Expr], global: bool) {
+        match args.first() {
+            Some(Expr::Regex(pat)) => {
+                let i = self.string(pat);
+                self.code.push(Op::Str(i));
+            }
+            _ => self.arg(args, 0, false),
+        }
+        self.arg(args, 1, false);
+        match args.get(2) {
+            None => {
+                self.code.push(Op::FieldConst(0));
+                self.code.push(Op::Subst(global));
+                self.code.push(Op::Num(0.0));
+                self.code.push(Op::Swap);
+                self.code.push(Op::StoreField);
+            }
+            Some(Expr::Var(name)) => {
+                let r = self.var(name);
+                self.code.push(match r {
+                    VarRef::Special(s) => Op::LoadSpecial(s),
+                    VarRef::Slot(s) => Op::LoadVar(s),
+                });
+                self.code.push(Op::Subst(global));
+                self.code.push(match r {
+                    VarRef::Special(s) => Op::StoreSpecial(s),
+                    VarRef::Slot(s) => Op::StoreVar(s),
+                });
+            }
+            Some(Expr::Field(idx)) => {
+                self.expr(idx, true);
+                self.code.push(Op::LoadField);
+                self.code.push(Op::Subst(global));
+                self.expr(idx, true);
+                self.code.push(Op::Swap);
+                self.code.push(Op::StoreField);
+            }
+            Some(Expr::ArrayRef(name, key)) => {
+                let a = self.array(name);
+                self.expr(key, false);
+                self.code.push(Op::LoadElem(a));
+                self.code.push(Op::Subst(global));
+                self.expr(key, false);
+                self.code.push(Op::Swap);
+                self.code.push(Op::StoreElem(a));
+            }
+            Some(other) => {
+                self.expr(other, false);
+                self.code.push(Op::Subst(global));
+            }
+        }
+        // Drop the result, keep the count.
+        self.code.push(Op::Pop);
+    }
+}
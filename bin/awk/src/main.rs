@@ -9,6 +9,10 @@ use alloc::string::ToString;
 use alloc::boxed::Box;
 use alloc::vec;
 
+mod compile;
+mod record;
+mod vm;
+
 anyos_std::entry!(main);
 
 // ─── Value type ──────────────────────────────────────────────────────────────
@@ -17,21 +21,47 @@ anyos_std::entry!(main);
 enum Value {
     Str(String),
     Num(f64),
+    /// A string whose numeric value has already been computed.
+    StrNum(String, f64),
     Uninit,
 }
 
 impl Value {
     fn as_str(&self) -> String {
         match self {
-            Value::Str(s) => s.clone(),
+            Value::Str(s) | Value::StrNum(s, _) => s.clone(),
             Value::Num(n) => format_float(*n),
             Value::Uninit => String::new(),
         }
     }
 
+    fn into_string(self) -> String {
+        match self {
+            Value::Str(s) | Value::StrNum(s, _) => s,
+            other => other.as_str(),
+        }
+    }
+
+    /// Append the string form to `out`.
+    fn push_to(&self, out: &mut String) {
+        match self {
+            Value::Str(s) | Value::StrNum(s, _) => out.push_str(s),
+            Value::Num(n) => out.push_str(&format_float(*n)),
+            Value::Uninit => {}
+        }
+    }
+
+    /// Compare string forms without copying strings.
+    fn str_eq(&self, other: &Value) -> bool {
+        match (self, other) {
+            (Value::Str(a) | Value::StrNum(a, _), Value::Str(b) | Value::StrNum(b, _)) => a == b,
+            _ => self.as_str() == other.as_str(),
+        }
+    }
+
     fn as_num(&self) -> f64 {
         match self {
-            Value::Num(n) => *n,
+            Value::Num(n) | Value::StrNum(_, n) => *n,
             Value::Str(s) => parse_float(s),
             Value::Uninit => 0.0,
         }
@@ -40,7 +70,7 @@ impl Value {
     fn is_true(&self) -> bool {
         match self {
             Value::Num(n) => *n != 0.0,
-            Value::Str(s) => !s.is_empty(),
+            Value::Str(s) | Value::StrNum(s, _) => !s.is_empty(),
             Value::Uninit => false,
         }
     }
@@ -393,6 +423,8 @@ impl Lexer {
 enum Expr {
     Num(f64),
     Str(String),
+    /// A bare `/re/`: `$0 ~ /re/`, or the pattern argument of sub/gsub.
+    Regex(String),
     Field(Box<Expr>),
     Var(String),
     ArrayRef(String, Box<Expr>),
@@ -859,6 +891,7 @@ impl Parser {
         match self.peek().clone() {
             Token::Num(n) => { self.advance(); Expr::Num(n) }
             Token::Str(s) => { self.advance(); Expr::Str(s) }
+            Token::Regex(r) => { self.advance(); Expr::Regex(r) }
             Token::Field(n) => { self.advance(); Expr::Field(Box::new(Expr::Num(n as f64))) }
             Token::Var(name) => {
                 self.advance();
@@ -1080,624 +1113,35 @@ fn match_char_class(ch: Option<char>, pat: &[char], pi: usize) -> (bool, usize)
     (if negate { !matched } else { matched }, end)
 }
 
-// ─── Interpreter ─────────────────────────────────────────────────────────────
-
-struct Interpreter {
-    vars: Vec<(String, Value)>,
-    arrays: Vec<(String, Vec<(String, Value)>)>,
-    fields: Vec<String>,
-    nr: u32,
-    fnr: u32,
-    fs: String,
-    ofs: String,
-    ors: String,
-    nf: u32,
-    rng_state: u32,
+/// A pattern prepared once at compile time.  Patterns without any
+/// metacharacters are matched with a plain substring search.
+struct Regex {
+    pat: Vec<char>,
+    literal: Option<String>,
 }
 
-impl Interpreter {
-    fn new() -> Self {
-        Interpreter {
-            vars: Vec::new(),
-            arrays: Vec::new(),
-            fields: Vec::new(),
-            nr: 0,
-            fnr: 0,
-            fs: String::from(" "),
-            ofs: String::from(" "),
-            ors: String::from("\n"),
-            nf: 0,
-            rng_state: 12345,
-        }
-    }
-
-    fn get_var(&self, name: &str) -> Value {
-        match name {
-            "NR" => Value::Num(self.nr as f64),
-            "FNR" => Value::Num(self.fnr as f64),
-            "NF" => Value::Num(self.nf as f64),
-            "FS" => Value::Str(self.fs.clone()),
-            "OFS" => Value::Str(self.ofs.clone()),
-            "ORS" => Value::Str(self.ors.clone()),
-            "FILENAME" => {
-                self.vars.iter().find(|(n, _)| n == "FILENAME")
-                    .map(|(_, v)| v.clone()).unwrap_or(Value::Uninit)
-            }
-            _ => {
-                self.vars.iter().find(|(n, _)| n == name)
-                    .map(|(_, v)| v.clone()).unwrap_or(Value::Uninit)
-            }
-        }
-    }
-
-    fn set_var(&mut self, name: &str, val: Value) {
-        match name {
-            "NR" => self.nr = val.as_num() as u32,
-            "FNR" => self.fnr = val.as_num() as u32,
-            "NF" => self.nf = val.as_num() as u32,
-            "FS" => self.fs = val.as_str(),
-            "OFS" => self.ofs = val.as_str(),
-            "ORS" => self.ors = val.as_str(),
-            _ => {
-                if let Some(existing) = self.vars.iter_mut().find(|(n, _)| n == name) {
-                    existing.1 = val;
-                } else {
-                    self.vars.push((String::from(name), val));
-                }
-            }
-        }
-    }
-
-    fn get_array(&self, name: &str, key: &str) -> Value {
-        if let Some((_, entries)) = self.arrays.iter().find(|(n, _)| n == name) {
-            entries.iter().find(|(k, _)| k == key)
-                .map(|(_, v)| v.clone()).unwrap_or(Value::Uninit)
-        } else {
-            Value::Uninit
-        }
-    }
-
-    fn set_array(&mut self, name: &str, key: &str, val: Value) {
-        if let Some((_, entries)) = self.arrays.iter_mut().find(|(n, _)| n == name) {
-            if let Some(entry) = entries.iter_mut().find(|(k, _)| k == key) {
-                entry.1 = val;
-            } else {
-                entries.push((String::from(key), val));
-            }
-        } else {
-            self.arrays.push((String::from(name), alloc::vec![(String::from(key), val)]));
-        }
-    }
-
-    fn delete_array(&mut self, name: &str, key: &str) {
-        if key.is_empty() {
-            // Delete entire array
-            self.arrays.retain(|(n, _)| n != name);
-        } else if let Some((_, entries)) = self.arrays.iter_mut().find(|(n, _)| n == name) {
-            entries.retain(|(k, _)| k != key);
-        }
-    }
-
-    fn set_record(&mut self, line: &str) {
-        self.fields.clear();
-        self.fields.push(String::from(line)); // $0
-
-        if self.fs == " " {
-            // Default: split on whitespace
-            for part in line.split_whitespace() {
-                self.fields.push(String::from(part));
-            }
-        } else if self.fs.len() == 1 {
-            let sep = self.fs.chars().next().unwrap();
-            for part in line.split(sep) {
-                self.fields.push(String::from(part));
-            }
-        } else {
-            self.fields.push(String::from(line));
-        }
-        self.nf = (self.fields.len() - 1) as u32;
-    }
-
-    fn get_field(&self, n: u32) -> String {
-        if (n as usize) < self.fields.len() {
-            self.fields[n as usize].clone()
-        } else {
-            String::new()
-        }
-    }
-
-    fn set_field(&mut self, n: u32, val: &str) {
-        let idx = n as usize;
-        while self.fields.len() <= idx {
-            self.fields.push(String::new());
-        }
-        self.fields[idx] = String::from(val);
-        if n > 0 {
-            self.nf = (self.fields.len() - 1) as u32;
-            // Rebuild $0
-            let mut line = String::new();
-            for i in 1..self.fields.len() {
-                if i > 1 { line.push_str(&self.ofs); }
-                line.push_str(&self.fields[i]);
-            }
-            self.fields[0] = line;
-        }
-    }
-
-    fn eval_expr(&mut self, expr: &Expr) -> Value {
-        match expr {
-            Expr::Num(n) => Value::Num(*n),
-            Expr::Str(s) => Value::Str(s.clone()),
-            Expr::Field(e) => {
-                let n = self.eval_expr(e).as_num() as u32;
-                Value::Str(self.get_field(n))
-            }
-            Expr::Var(name) => self.get_var(name),
-            Expr::ArrayRef(name, idx) => {
-                let key = self.eval_expr(idx).as_str();
-                self.get_array(name, &key)
-            }
-            Expr::BinOp(lhs, op, rhs) => {
-                let l = self.eval_expr(lhs);
-                let r = self.eval_expr(rhs);
-                match op {
-                    BinOp::Add => Value::Num(l.as_num() + r.as_num()),
-                    BinOp::Sub => Value::Num(l.as_num() - r.as_num()),
-                    BinOp::Mul => Value::Num(l.as_num() * r.as_num()),
-                    BinOp::Div => {
-                        let d = r.as_num();
-                        if d == 0.0 { Value::Num(0.0) } else { Value::Num(l.as_num() / d) }
-                    }
-                    BinOp::Mod => {
-                        let d = r.as_num();
-                        if d == 0.0 { Value::Num(0.0) } else { Value::Num(l.as_num() % d) }
-                    }
-                    BinOp::Eq => {
-                        // String comparison if both look like strings
-                        let ls = l.as_str();
-                        let rs = r.as_str();
-                        Value::Num(if ls == rs { 1.0 } else { 0.0 })
-                    }
-                    BinOp::Ne => {
-                        let ls = l.as_str();
-                        let rs = r.as_str();
-                        Value::Num(if ls != rs { 1.0 } else { 0.0 })
-                    }
-                    BinOp::Lt => Value::Num(if l.as_num() < r.as_num() { 1.0 } else { 0.0 }),
-                    BinOp::Gt => Value::Num(if l.as_num() > r.as_num() { 1.0 } else { 0.0 }),
-                    BinOp::Le => Value::Num(if l.as_num() <= r.as_num() { 1.0 } else { 0.0 }),
-                    BinOp::Ge => Value::Num(if l.as_num() >= r.as_num() { 1.0 } else { 0.0 }),
-                    BinOp::And => Value::Num(if l.is_true() && r.is_true() { 1.0 } else { 0.0 }),
-                    BinOp::Or => Value::Num(if l.is_true() || r.is_true() { 1.0 } else { 0.0 }),
-                }
-            }
-            Expr::UnaryOp(op, e) => {
-                let v = self.eval_expr(e);
-                match op {
-                    UnaryOp::Neg => Value::Num(-v.as_num()),
-                    UnaryOp::Not => Value::Num(if v.is_true() { 0.0 } else { 1.0 }),
-                }
-            }
-            Expr::Assign(target, val) => {
-                let v = self.eval_expr(val);
-                self.assign_to(target, v.clone());
-                v
-            }
-            Expr::CompoundAssign(target, op, val) => {
-                let current = self.eval_expr(target);
-                let rhs = self.eval_expr(val);
-                let result = match op {
-                    BinOp::Add => Value::Num(current.as_num() + rhs.as_num()),
-                    BinOp::Sub => Value::Num(current.as_num() - rhs.as_num()),
-                    BinOp::Mul => Value::Num(current.as_num() * rhs.as_num()),
-                    BinOp::Div => {
-                        let d = rhs.as_num();
-                        Value::Num(if d == 0.0 { 0.0 } else { current.as_num() / d })
-                    }
-                    _ => Value::Num(current.as_num()),
-                };
-                self.assign_to(target, result.clone());
-                result
-            }
-            Expr::Incr(e, pre) => {
-                let v = self.eval_expr(e).as_num();
-                let new_v = Value::Num(v + 1.0);
-                self.assign_to(e, new_v);
-                if *pre { Value::Num(v + 1.0) } else { Value::Num(v) }
-            }
-            Expr::Decr(e, pre) => {
-                let v = self.eval_expr(e).as_num();
-                let new_v = Value::Num(v - 1.0);
-                self.assign_to(e, new_v);
-                if *pre { Value::Num(v - 1.0) } else { Value::Num(v) }
-            }
-            Expr::Match(e, pat) => {
-                let s = self.eval_expr(e).as_str();
-                Value::Num(if regex_match(&s, pat) { 1.0 } else { 0.0 })
-            }
-            Expr::NotMatch(e, pat) => {
-                let s = self.eval_expr(e).as_str();
-                Value::Num(if !regex_match(&s, pat) { 1.0 } else { 0.0 })
-            }
-            Expr::Concat(a, b) => {
-                let sa = self.eval_expr(a).as_str();
-                let sb = self.eval_expr(b).as_str();
-                Value::Str(format!("{}{}", sa, sb))
-            }
-            Expr::Call(name, args) => self.call_func(name, args),
-            Expr::Getline => Value::Num(0.0),
-            Expr::In(name, idx) => {
-                let key = self.eval_expr(idx).as_str();
-                if let Some((_, entries)) = self.arrays.iter().find(|(n, _)| n == name) {
-                    Value::Num(if entries.iter().any(|(k, _)| k == &key) { 1.0 } else { 0.0 })
-                } else {
-                    Value::Num(0.0)
-                }
-            }
-        }
-    }
-
-    fn assign_to(&mut self, target: &Expr, val: Value) {
-        match target {
-            Expr::Var(name) => self.set_var(name, val),
-            Expr::Field(e) => {
-                let n = self.eval_expr(e).as_num() as u32;
-                self.set_field(n, &val.as_str());
-            }
-            Expr::ArrayRef(name, idx) => {
-                let key = self.eval_expr(idx).as_str();
-                self.set_array(name, &key, val);
-            }
-            _ => {}
-        }
-    }
-
-    fn call_func(&mut self, name: &str, args: &[Expr]) -> Value {
-        match name {
-            "length" => {
-                let s = if args.is_empty() {
-                    self.get_field(0)
-                } else {
-                    self.eval_expr(&args[0]).as_str()
-                };
-                Value::Num(s.len() as f64)
-            }
-            "substr" => {
-                let s = self.eval_expr(&args[0]).as_str();
-                let start = (self.eval_expr(&args[1]).as_num() as usize).saturating_sub(1); // 1-indexed
-                let len = if args.len() > 2 {
-                    self.eval_expr(&args[2]).as_num() as usize
-                } else {
-                    s.len()
-                };
-                let end = (start + len).min(s.len());
-                if start < s.len() {
-                    Value::Str(String::from(&s[start..end]))
-                } else {
-                    Value::Str(String::new())
-                }
-            }
-            "index" => {
-                let s = self.eval_expr(&args[0]).as_str();
-                let needle = self.eval_expr(&args[1]).as_str();
-                match s.find(&*needle) {
-                    Some(pos) => Value::Num((pos + 1) as f64), // 1-indexed
-                    None => Value::Num(0.0),
-                }
-            }
-            "split" => {
-                let s = self.eval_expr(&args[0]).as_str();
-                let arr_name = match &args[1] {
-                    Expr::Var(n) => n.clone(),
-                    _ => String::from("_split"),
-                };
-                let sep = if args.len() > 2 {
-                    self.eval_expr(&args[2]).as_str()
-                } else {
-                    self.fs.clone()
-                };
-                // Clear array
-                self.delete_array(&arr_name, "");
-                let parts: Vec<&str> = if sep == " " {
-                    s.split_whitespace().collect()
-                } else if sep.len() == 1 {
-                    s.split(sep.chars().next().unwrap()).collect()
-                } else {
-                    alloc::vec![s.as_str()]
-                };
-                for (i, part) in parts.iter().enumerate() {
-                    let key = format!("{}", i + 1);
-                    self.set_array(&arr_name, &key, Value::Str(String::from(*part)));
-                }
-                Value::Num(parts.len() as f64)
-            }
-            "sub" | "gsub" => {
-                let pat = self.eval_expr(&args[0]).as_str();
-                let repl = self.eval_expr(&args[1]).as_str();
-                let target_str = if args.len() > 2 {
-                    self.eval_expr(&args[2]).as_str()
-                } else {
-                    self.get_field(0)
-                };
-                let global = name == "gsub";
-                let (result, count) = regex_sub(&target_str, &pat, &repl, global);
-                if args.len() > 2 {
-                    self.assign_to(&args[2], Value::Str(result));
-                } else {
-                    self.set_field(0, &result);
-                }
-                Value::Num(count as f64)
-            }
-            "sprintf" => {
-                if args.is_empty() {
-                    return Value::Str(String::new());
-                }
-                let fmt = self.eval_expr(&args[0]).as_str();
-                let vals: Vec<Value> = args[1..].iter().map(|a| self.eval_expr(a)).collect();
-                Value::Str(awk_sprintf(&fmt, &vals))
-            }
-            "tolower" => {
-                let s = self.eval_expr(&args[0]).as_str();
-                let mut result = String::new();
-                for c in s.chars() {
-                    if c >= 'A' && c <= 'Z' {
-                        result.push((c as u8 + 32) as char);
-                    } else {
-                        result.push(c);
-                    }
-                }
-                Value::Str(result)
-            }
-            "toupper" => {
-                let s = self.eval_expr(&args[0]).as_str();
-                let mut result = String::new();
-                for c in s.chars() {
-                    if c >= 'a' && c <= 'z' {
-                        result.push((c as u8 - 32) as char);
-                    } else {
-                        result.push(c);
-                    }
-                }
-                Value::Str(result)
-            }
-            "sin" => {
-                let n = self.eval_expr(&args[0]).as_num();
-                Value::Num(libm::sin(n))
-            }
-            "cos" => {
-                let n = self.eval_expr(&args[0]).as_num();
-                Value::Num(libm::cos(n))
-            }
-            "sqrt" => {
-                let n = self.eval_expr(&args[0]).as_num();
-                Value::Num(libm::sqrt(n))
-            }
-            "log" => {
-                let n = self.eval_expr(&args[0]).as_num();
-                Value::Num(libm::log(n))
-            }
-            "exp" => {
-                let n = self.eval_expr(&args[0]).as_num();
-                Value::Num(libm::exp(n))
-            }
-            "int" => {
-                let n = self.eval_expr(&args[0]).as_num();
-                Value::Num((n as i64) as f64)
-            }
-            "rand" => {
-                // Simple LCG
-                self.rng_state = self.rng_state.wrapping_mul(1103515245).wrapping_add(12345);
-                let val = ((self.rng_state >> 16) & 0x7FFF) as f64 / 32768.0;
-                Value::Num(val)
-            }
-            "srand" => {
-                let old = self.rng_state;
-                if !args.is_empty() {
-                    self.rng_state = self.eval_expr(&args[0]).as_num() as u32;
-                }
-                Value::Num(old as f64)
-            }
-            _ => Value::Uninit,
-        }
-    }
-
-    fn exec_stmt(&mut self, stmt: &Stmt) -> StmtResult {
-        match stmt {
-            Stmt::ExprStmt(expr) => {
-                self.eval_expr(expr);
-                StmtResult::Continue
-            }
-            Stmt::Print(exprs, output_file) => {
-                let mut out = String::new();
-                for (i, expr) in exprs.iter().enumerate() {
-                    if i > 0 { out.push_str(&self.ofs); }
-                    out.push_str(&self.eval_expr(expr).as_str());
-                }
-                out.push_str(&self.ors);
-                if let Some(file) = output_file {
-                    let resolved = self.get_var(file).as_str();
-                    let target = if resolved.is_empty() { file.as_str() } else { &resolved };
-                    let existing = fs::read_to_string(target).unwrap_or_default();
-                    let combined = format!("{}{}", existing, out);
-                    let _ = fs::write_bytes(target, combined.as_bytes());
-                } else {
-                    anyos_std::print!("{}", out);
-                }
-                StmtResult::Continue
-            }
-            Stmt::Printf(exprs, output_file) => {
-                if exprs.is_empty() {
-                    return StmtResult::Continue;
-                }
-                let fmt = self.eval_expr(&exprs[0]).as_str();
-                let vals: Vec<Value> = exprs[1..].iter().map(|a| self.eval_expr(a)).collect();
-                let out = awk_sprintf(&fmt, &vals);
-                if let Some(file) = output_file {
-                    let resolved = self.get_var(file).as_str();
-                    let target = if resolved.is_empty() { file.as_str() } else { &resolved };
-                    let existing = fs::read_to_string(target).unwrap_or_default();
-                    let combined = format!("{}{}", existing, out);
-                    let _ = fs::write_bytes(target, combined.as_bytes());
-                } else {
-                    anyos_std::print!("{}", out);
-                }
-                StmtResult::Continue
-            }
-            Stmt::If(cond, then_stmt, else_stmt) => {
-                let v = self.eval_expr(cond);
-                if v.is_true() {
-                    self.exec_stmt(then_stmt)
-                } else if let Some(els) = else_stmt {
-                    self.exec_stmt(els)
-                } else {
-                    StmtResult::Continue
-                }
-            }
-            Stmt::While(cond, body) => {
-                let mut limit = 100000u32;
-                while self.eval_expr(cond).is_true() && limit > 0 {
-                    limit -= 1;
-                    match self.exec_stmt(body) {
-                        StmtResult::Next => return StmtResult::Next,
-                        StmtResult::Exit(c) => return StmtResult::Exit(c),
-                        _ => {}
-                    }
-                }
-                StmtResult::Continue
-            }
-            Stmt::DoWhile(body, cond) => {
-                let mut limit = 100000u32;
-                loop {
-                    if limit == 0 { break; }
-                    limit -= 1;
-                    match self.exec_stmt(body) {
-                        StmtResult::Next => return StmtResult::Next,
-                        StmtResult::Exit(c) => return StmtResult::Exit(c),
-                        _ => {}
-                    }
-                    if !self.eval_expr(cond).is_true() { break; }
-                }
-                StmtResult::Continue
-            }
-            Stmt::For(init, cond, update, body) => {
-                self.exec_stmt(init);
-                let mut limit = 100000u32;
-                while self.eval_expr(cond).is_true() && limit > 0 {
-                    limit -= 1;
-                    match self.exec_stmt(body) {
-                        StmtResult::Next => return StmtResult::Next,
-                        StmtResult::Exit(c) => return StmtResult::Exit(c),
-                        _ => {}
-                    }
-                    self.exec_stmt(update);
-                }
-                StmtResult::Continue
-            }
-            Stmt::ForIn(var, arr_name, body) => {
-                let keys: Vec<String> = if let Some((_, entries)) = self.arrays.iter().find(|(n, _)| n == arr_name) {
-                    entries.iter().map(|(k, _)| k.clone()).collect()
-                } else {
-                    Vec::new()
-                };
-                for key in keys {
-                    self.set_var(var, Value::Str(key));
-                    match self.exec_stmt(body) {
-                        StmtResult::Next => return StmtResult::Next,
-                        StmtResult::Exit(c) => return StmtResult::Exit(c),
-                        _ => {}
-                    }
-                }
-                StmtResult::Continue
-            }
-            Stmt::Block(stmts) => {
-                for s in stmts {
-                    match self.exec_stmt(s) {
-                        StmtResult::Continue => {}
-                        other => return other,
-                    }
-                }
-                StmtResult::Continue
-            }
-            Stmt::Next => StmtResult::Next,
-            Stmt::Exit(code) => {
-                let c = code.as_ref().map(|e| self.eval_expr(e).as_num() as u32).unwrap_or(0);
-                StmtResult::Exit(c)
-            }
-            Stmt::Delete(name, idx) => {
-                let key = self.eval_expr(idx).as_str();
-                self.delete_array(name, &key);
-                StmtResult::Continue
-            }
+impl Regex {
+    fn new(pattern: &str) -> Regex {
+        let is_literal = !pattern.chars().any(|c| ".[]*+?^$\\".contains(c));
+        Regex {
+            pat: pattern.chars().collect(),
+            literal: if is_literal { Some(String::from(pattern)) } else { None },
         }
     }
 
-    fn run(&mut self, rules: &[Rule], lines: &[&str]) {
-        // Check for -v variable assignments already set
-        // Run BEGIN rules
-        for rule in rules {
-            if let Pattern::Begin = rule.pattern {
-                for stmt in &rule.action {
-                    match self.exec_stmt(stmt) {
-                        StmtResult::Exit(c) => { anyos_std::process::exit(c); }
-                        _ => {}
-                    }
-                }
-            }
-        }
-
-        // Process each line
-        'lines: for line in lines {
-            self.nr += 1;
-            self.fnr += 1;
-            self.set_record(line);
-
-            for rule in rules {
-                let matches = match &rule.pattern {
-                    Pattern::Begin | Pattern::End => false,
-                    Pattern::All => true,
-                    Pattern::Regex(pat) => regex_match(line, pat),
-                    Pattern::Expr(expr) => self.eval_expr(expr).is_true(),
-                };
-                if matches {
-                    for stmt in &rule.action {
-                        match self.exec_stmt(stmt) {
-                            StmtResult::Next => continue 'lines,
-                            StmtResult::Exit(c) => {
-                                // Run END rules before exit
-                                self.run_end(rules);
-                                anyos_std::process::exit(c);
-                            }
-                            _ => {}
-                        }
-                    }
-                }
-            }
+    fn is_match(&self, text: &str) -> bool {
+        if let Some(lit) = &self.literal {
+            return text.contains(lit.as_str());
         }
-
-        // Run END rules
-        self.run_end(rules);
-    }
-
-    fn run_end(&mut self, rules: &[Rule]) {
-        for rule in rules {
-            if let Pattern::End = rule.pattern {
-                for stmt in &rule.action {
-                    match self.exec_stmt(stmt) {
-                        StmtResult::Exit(c) => { anyos_std::process::exit(c); }
-                        _ => {}
-                    }
-                }
-            }
+        let pat = &self.pat;
+        let text_chars: Vec<char> = text.chars().collect();
+        if pat[0] == '^' {
+            return regex_match_at(&text_chars, 0, pat, 1);
         }
+        (0..=text_chars.len()).any(|i| regex_match_at(&text_chars, i, pat, 0))
     }
 }
 
-enum StmtResult {
-    Continue,
-    Next,
-    Exit(u32),
-}
-
 // ─── Helpers ─────────────────────────────────────────────────────────────────
 
 fn regex_sub(text: &str, pattern: &str, replacement: &str, global: bool) -> (String, u32) {
@@ -1993,22 +1437,56 @@ mod libm {
     }
 }
 
-// ─── Read helpers ────────────────────────────────────────────────────────────
+// ─── Input ───────────────────────────────────────────────────────────────────
 
-fn read_all(fd: u32) -> Vec<u8> {
-    let mut data = Vec::new();
-    let mut buf = [0u8; 512];
-    loop {
-        let n = fs::read(fd, &mut buf);
-        if n == 0 || n == u32::MAX { break; }
-        data.extend_from_slice(&buf[..n as usize]);
+const READ_SIZE: usize = 64 * 1024;
+
+/// Block-buffered reader splitting one input file into newline-terminated
+/// records.
+struct Input {
+    fd: u32,
+    buf: Vec<u8>,
+    pos: usize,
+    end: usize,
+}
+
+impl Input {
+    fn new(fd: u32) -> Input {
+        Input { fd, buf: vec![0u8; READ_SIZE], pos: 0, end: 0 }
+    }
+
+    /// Read the next record (without its newline) into `rec`.
+    /// Returns false at end of input.
+    fn next_record(&mut self, rec: &mut Vec<u8>) -> bool {
+        rec.clear();
+        loop {
+            if self.pos == self.end {
+                let n = fs::read(self.fd, &mut self.buf);
+                if n == 0 || n == u32::MAX {
+                    return !rec.is_empty();
+                }
+                self.pos = 0;
+                self.end = n as usize;
+            }
+            let avail = &self.buf[self.pos..self.end];
+            match avail.iter().position(|&b| b == b'\n') {
+                Some(p) => {
+                    rec.extend_from_slice(&avail[..p]);
+                    self.pos += p + 1;
+                    return true;
+                }
+                None => {
+                    rec.extend_from_slice(avail);
+                    self.pos = self.end;
+                }
+            }
+        }
     }
-    data
 }
 
 // ─── Main ────────────────────────────────────────────────────────────────────
 
-fn main() {
+fn main() -> u32 {
     let mut args_buf = [0u8; 256];
     let args_str = anyos_std::process::args(&mut args_buf);
 
@@ -2088,7 +1566,7 @@ fn main() {
         Some(p) => p,
         None => {
             anyos_std::println!("awk: no program text");
-            return;
+            return 2;
         }
     };
 
@@ -2098,38 +1576,53 @@ fn main() {
     let mut parser = Parser::new(tokens);
     let rules = parser.parse_program();
 
-    // Set up interpreter
-    let mut interp = Interpreter::new();
+    let prog = compile::compile(&rules);
+    let mut vm = vm::Vm::new(&prog);
     if let Some(ref fs) = fs_opt {
-        interp.fs = fs.clone();
+        vm.assign("FS", fs);
     }
     for (k, v) in &var_assigns {
-        interp.set_var(k, Value::Str(v.clone()));
+        vm.assign(k, v);
     }
 
-    // Read input
-    if files.is_empty() {
-        // Read from stdin
-        let data = read_all(0);
-        if let Ok(text) = core::str::from_utf8(&data) {
-            let lines: Vec<&str> = text.lines().collect();
-            interp.run(&rules, &lines);
+    // BEGIN runs once; `exit` outside END skips the remaining input but
+    // still runs END.
+    let mut status = 0;
+    let mut exited = false;
+    if let vm::Flow::Exit(c) = vm.run(&prog.begin) {
+        status = c;
+        exited = true;
+    }
+    if !exited && prog.reads_input {
+        if files.is_empty() {
+            files.push(String::from("-"));
         }
-    } else {
-        for file in &files {
-            interp.fnr = 0;
-            interp.set_var("FILENAME", Value::Str(file.clone()));
-            let fd = fs::open(file, 0);
+        let mut rec = Vec::new();
+        'files: for file in &files {
+            let fd = if file == "-" { 0 } else { fs::open(file, 0) };
             if fd == u32::MAX {
                 anyos_std::println!("awk: cannot open '{}'", file);
+                status = 2;
                 continue;
             }
-            let data = read_all(fd);
-            fs::close(fd);
-            if let Ok(text) = core::str::from_utf8(&data) {
-                let lines: Vec<&str> = text.lines().collect();
-                interp.run(&rules, &lines);
+            vm.fnr = 0;
+            vm.assign("FILENAME", if fd == 0 { "" } else { file });
+            let mut input = Input::new(fd);
+            while input.next_record(&mut rec) {
+                vm.set_record(&rec);
+                if let vm::Flow::Exit(c) = vm.run(&prog.main) {
+                    status = c;
+                    break 'files;
+                }
+            }
+            if fd != 0 {
+                fs::close(fd);
             }
         }
     }
+    if let vm::Flow::Exit(c) = vm.run(&prog.end) {
+        status = c;
+    }
+    vm.finish();
+    status
 }
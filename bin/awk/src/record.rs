@@ -0,0 +1,195 @@
+//! The current input record and its fields.
+//!
+//! Fields are split lazily, on first access, into byte ranges of the
+//! record text; nothing is copied until a field is assigned.  Numeric
+//! values of fields are parsed at most once per record.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::parse_float;
+
+pub struct Record {
+    text: String,
+    split: bool,
+    /// Field `i + 1` as a byte range of `text`, while `owned` is unset.
+    spans: Vec<(u32, u32)>,
+    /// Fields after an assignment to one of them or to NF.
+    owned: Option<Vec<String>>,
+    /// Parsed value of `$i`, NaN until first use.
+    nums: Vec<f64>,
+}
+
+fn is_blank(b: u8) -> bool {
+    b == b' ' || b == b'\t' || b == b'\n'
+}
+
+/// Split `text` on `fs` into byte ranges.  A single blank splits on runs
+/// of blanks and ignores leading and trailing ones; a single other
+/// character and longer strings split on every occurrence.
+pub fn split_spans(text: &str, fs: &str, out: &mut Vec<(u32, u32)>) {
+    out.clear();
+    let b = text.as_bytes();
+    if b.is_empty() {
+        return;
+    }
+    if fs == " " {
+        let mut i = 0;
+        loop {
+            while i < b.len() && is_blank(b[i]) {
+                i += 1;
+            }
+            if i == b.len() {
+                break;
+            }
+            let start = i;
+            while i < b.len() && !is_blank(b[i]) {
+                i += 1;
+            }
+            out.push((start as u32, i as u32));
+        }
+    } else if fs.len() == 1 {
+        let sep = fs.as_bytes()[0];
+        let mut start = 0;
+        for (i, &c) in b.iter().enumerate() {
+            if c == sep {
+                out.push((start as u32, i as u32));
+                start = i + 1;
+            }
+        }
+        out.push((start as u32, b.len() as u32));
+    } else if fs.is_empty() {
+        out.push((0, b.len() as u32));
+    } else {
+        let mut start = 0;
+        while let Some(p) = text[start..].find(fs) {
+            out.push((start as u32, (start + p) as u32));
+            start += p + fs.len();
+        }
+        out.push((start as u32, b.len() as u32));
+    }
+}
+
+impl Record {
+    pub fn new() -> Record {
+        Record { text: String::new(), split: false, spans: Vec::new(), owned: None, nums: Vec::new() }
+    }
+
+    pub fn text(&self) -> &str {
+        &self.text
+    }
+
+    /// Replace the record with `bytes`, minus a trailing carriage return.
+    pub fn set_bytes(&mut self, bytes: &[u8]) {
+        let bytes = match bytes.last() {
+            Some(b'\r') => &bytes[..bytes.len() - 1],
+            _ => bytes,
+        };
+        self.text.clear();
+        match core::str::from_utf8(bytes) {
+            Ok(s) => self.text.push_str(s),
+            Err(_) => self.text.push_str(&String::from_utf8_lossy(bytes)),
+        }
+        self.reset();
+    }
+
+    pub fn set(&mut self, text: &str) {
+        self.text.clear();
+        self.text.push_str(text);
+        self.reset();
+    }
+
+    fn reset(&mut self) {
+        self.split = false;
+        self.owned = None;
+        self.nums.clear();
+    }
+
+    /// Split now, so a later change of FS only affects the next record.
+    pub fn split(&mut self, fs: &str) {
+        if !self.split {
+            split_spans(&self.text, fs, &mut self.spans);
+            self.split = true;
+        }
+    }
+
+    pub fn nf(&mut self, fs: &str) -> usize {
+        self.split(fs);
+        match &self.owned {
+            Some(f) => f.len(),
+            None => self.spans.len(),
+        }
+    }
+
+    /// `$n`; empty beyond NF.
+    pub fn field(&mut self, n: usize, fs: &str) -> &str {
+        if n == 0 {
+            return &self.text;
+        }
+        self.split(fs);
+        match &self.owned {
+            Some(f) => f.get(n - 1).map_or("", |s| s.as_str()),
+            None => match self.spans.get(n - 1) {
+                Some(&(s, e)) => &self.text[s as usize..e as usize],
+                None => "",
+            },
+        }
+    }
+
+    /// `$n` as a number, parsed once per record.
+    pub fn field_num(&mut self, n: usize, fs: &str) -> f64 {
+        if n < self.nums.len() && !self.nums[n].is_nan() {
+            return self.nums[n];
+        }
+        let v = parse_float(self.field(n, fs));
+        if n >= self.nums.len() {
+            self.nums.resize(n + 1, f64::NAN);
+        }
+        self.nums[n] = v;
+        v
+    }
+
+    /// Take ownership of the fields so they can be modified.
+    fn fields_mut(&mut self, fs: &str) -> &mut Vec<String> {
+        self.split(fs);
+        if self.owned.is_none() {
+            let text = &self.text;
+            let fields = self.spans.iter().map(|&(s, e)| String::from(&text[s as usize..e as usize])).collect();
+            self.owned = Some(fields);
+        }
+        self.nums.clear();
+        self.owned.as_mut().unwrap()
+    }
+
+    /// Rebuild `$0` from the fields, joined with `ofs`.
+    fn rebuild(&mut self, ofs: &str) {
+        self.text.clear();
+        if let Some(fields) = &self.owned {
+            for (i, f) in fields.iter().enumerate() {
+                if i > 0 {
+                    self.text.push_str(ofs);
+                }
+                self.text.push_str(f);
+            }
+        }
+    }
+
+    pub fn set_field(&mut self, n: usize, val: &str, fs: &str, ofs: &str) {
+        if n == 0 {
+            self.set(val);
+            return;
+        }
+        let fields = self.fields_mut(fs);
+        if fields.len() < n {
+            fields.resize(n, String::new());
+        }
+        fields[n - 1].clear();
+        fields[n - 1].push_str(val);
+        self.rebuild(ofs);
+    }
+
+    pub fn set_nf(&mut self, n: usize, fs: &str, ofs: &str) {
+        self.fields_mut(fs).resize(n, String::new());
+        self.rebuild(ofs);
+    }
+}
@@ -0,0 +1,541 @@
+//! Bytecode interpreter.
+//!
+//! A plain stack machine over [`Op`]: variables and arrays live in vectors
+//! indexed by the slots the compiler assigned, and output goes through
+//! block buffers that are flushed when full and at exit.
+
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::fs;
+use anyos_std::HashMap;
+
+use crate::compile::{Builtin, Op, Program, Special, NO_REDIRECT};
+use crate::record::{self, Record};
+use crate::{awk_sprintf, libm, parse_float, regex_sub, Value};
+
+const OUT_BUF_SIZE: usize = 64 * 1024;
+
+/// How a block of code finished.
+pub enum Flow {
+    Done,
+    Next,
+    Exit(u32),
+}
+
+/// Buffered writer for stdout or a `>` file.
+struct Output {
+    fd: u32,
+    buf: Vec<u8>,
+}
+
+impl Output {
+    fn new(fd: u32) -> Output {
+        Output { fd, buf: Vec::with_capacity(OUT_BUF_SIZE) }
+    }
+
+    fn write(&mut self, data: &[u8]) {
+        if self.buf.len() + data.len() > OUT_BUF_SIZE {
+            self.flush();
+        }
+        self.buf.extend_from_slice(data);
+    }
+
+    fn flush(&mut self) {
+        let mut done = 0;
+        while done < self.buf.len() {
+            let n = fs::write(self.fd, &self.buf[done..]);
+            if n == 0 || n == u32::MAX {
+                break;
+            }
+            done += n as usize;
+        }
+        self.buf.clear();
+    }
+}
+
+pub struct Vm<'p> {
+    prog: &'p Program,
+    vars: Vec<Value>,
+    arrays: Vec<HashMap<String, Value>>,
+    stack: Vec<Value>,
+    /// Active for-in loops: the keys and the next index.
+    iters: Vec<(Vec<String>, usize)>,
+    record: Record,
+    pub nr: u32,
+    pub fnr: u32,
+    fs: String,
+    ofs: String,
+    ors: String,
+    rng_state: u32,
+    out: Output,
+    files: HashMap<String, Output>,
+    line: String,
+    spans: Vec<(u32, u32)>,
+}
+
+impl<'p> Vm<'p> {
+    pub fn new(prog: &'p Program) -> Vm<'p> {
+        let mut arrays = Vec::with_capacity(prog.num_arrays);
+        for _ in 0..prog.num_arrays {
+            arrays.push(HashMap::new());
+        }
+        Vm {
+            prog,
+            vars: alloc::vec![Value::Uninit; prog.num_vars],
+            arrays,
+            stack: Vec::new(),
+            iters: Vec::new(),
+            record: Record::new(),
+            nr: 0,
+            fnr: 0,
+            fs: String::from(" "),
+            ofs: String::from(" "),
+            ors: String::from("\n"),
+            rng_state: 12345,
+            out: Output::new(1),
+            files: HashMap::new(),
+            line: String::new(),
+            spans: Vec::new(),
+        }
+    }
+
+    /// Assign a variable by name (`-v`, `-F`, FILENAME).
+    pub fn assign(&mut self, name: &str, val: &str) {
+        match name {
+            "FS" => self.fs = String::from(val),
+            "OFS" => self.ofs = String::from(val),
+            "ORS" => self.ors = String::from(val),
+            _ => {
+                if let Some(&slot) = self.prog.vars.get(&String::from(name)) {
+                    self.vars[slot as usize] = Value::Str(String::from(val));
+                }
+            }
+        }
+    }
+
+    /// Make `bytes` the current record and count it.
+    pub fn set_record(&mut self, bytes: &[u8]) {
+        self.nr += 1;
+        self.fnr += 1;
+        self.record.set_bytes(bytes);
+    }
+
+    /// Flush stdout and every open file.
+    pub fn finish(&mut self) {
+        self.out.flush();
+        for (_, out) in self.files.iter_mut() {
+            out.flush();
+            fs::close(out.fd);
+        }
+        self.files.clear();
+    }
+
+    fn pop(&mut self) -> Value {
+        self.stack.pop().unwrap_or(Value::Uninit)
+    }
+
+    fn top(&self) -> Value {
+        self.stack.last().cloned().unwrap_or(Value::Uninit)
+    }
+
+    fn pop_index(&mut self) -> usize {
+        let n = self.pop().as_num();
+        if n > 0.0 { n as usize } else { 0 }
+    }
+
+    fn load_special(&mut self, s: Special) -> Value {
+        match s {
+            Special::Nr => Value::Num(self.nr as f64),
+            Special::Fnr => Value::Num(self.fnr as f64),
+            Special::Nf => Value::Num(self.record.nf(&self.fs) as f64),
+            Special::Fs => Value::Str(self.fs.clone()),
+            Special::Ofs => Value::Str(self.ofs.clone()),
+            Special::Ors => Value::Str(self.ors.clone()),
+        }
+    }
+
+    fn store_special(&mut self, s: Special, v: &Value) {
+        match s {
+            Special::Nr => self.nr = v.as_num() as u32,
+            Special::Fnr => self.fnr = v.as_num() as u32,
+            Special::Nf => {
+                let n = v.as_num();
+                self.record.set_nf(if n > 0.0 { n as usize } else { 0 }, &self.fs, &self.ofs);
+            }
+            Special::Fs => {
+                self.record.split(&self.fs);
+                self.fs = v.as_str();
+            }
+            Special::Ofs => self.ofs = v.as_str(),
+            Special::Ors => self.ors = v.as_str(),
+        }
+    }
+
+    fn set_field(&mut self, n: usize, v: &Value) {
+        match v {
+            Value::Str(s) | Value::StrNum(s, _) => self.record.set_field(n, s, &self.fs, &self.ofs),
+            _ => {
+                let s = v.as_str();
+                self.record.set_field(n, &s, &self.fs, &self.ofs);
+            }
+        }
+    }
+
+    /// Write `self.line` to stdout or to redirect `r`.
+    fn emit(&mut self, r: u32) {
+        if r == NO_REDIRECT {
+            self.out.write(self.line.as_bytes());
+            return;
+        }
+        let redirect = &self.prog.redirects[r as usize];
+        let mut path = match redirect.var {
+            Some(slot) => self.vars[slot as usize].as_str(),
+            None => String::new(),
+        };
+        if path.is_empty() {
+            path = redirect.name.clone();
+        }
+        if self.files.get(&path).is_none() {
+            let fd = fs::open(&path, fs::O_WRITE | fs::O_CREATE | fs::O_TRUNC);
+            if fd == u32::MAX {
+                anyos_std::println!("awk: cannot open '{}' for writing", path);
+                return;
+            }
+            self.files.insert(path.clone(), Output::new(fd));
+        }
+        if let Some(out) = self.files.get_mut(&path) {
+            out.write(self.line.as_bytes());
+        }
+    }
+
+    /// Run one block of code until it halts, or `next` or `exit`.
+    pub fn run(&mut self, code: &[Op]) -> Flow {
+        let prog = self.prog;
+        self.stack.clear();
+        self.iters.clear();
+        let mut pc = 0;
+        loop {
+            let op = code[pc];
+            pc += 1;
+            match op {
+                Op::Num(n) => self.stack.push(Value::Num(n)),
+                Op::Str(i) => self.stack.push(Value::Str(prog.strings[i as usize].clone())),
+                Op::Uninit => self.stack.push(Value::Uninit),
+                Op::Pop => {
+                    self.stack.pop();
+                }
+                Op::Dup => {
+                    let v = self.top();
+                    self.stack.push(v);
+                }
+                Op::Swap => {
+                    let n = self.stack.len();
+                    if n >= 2 {
+                        self.stack.swap(n - 1, n - 2);
+                    }
+                }
+
+                Op::LoadVar(s) => {
+                    let v = self.vars[s as usize].clone();
+                    self.stack.push(v);
+                }
+                Op::LoadVarNum(s) => {
+                    let slot = &mut self.vars[s as usize];
+                    let n = match slot {
+                        Value::Num(n) | Value::StrNum(_, n) => *n,
+                        Value::Str(st) => {
+                            let n = parse_float(st);
+                            *slot = Value::StrNum(core::mem::take(st), n);
+                            n
+                        }
+                        Value::Uninit => 0.0,
+                    };
+                    self.stack.push(Value::Num(n));
+                }
+                Op::StoreVar(s) => self.vars[s as usize] = self.top(),
+                Op::LoadSpecial(s) => {
+                    let v = self.load_special(s);
+                    self.stack.push(v);
+                }
+                Op::StoreSpecial(s) => {
+                    let v = self.top();
+                    self.store_special(s, &v);
+                }
+                Op::FieldConst(n) => {
+                    let v = Value::Str(String::from(self.record.field(n as usize, &self.fs)));
+                    self.stack.push(v);
+                }
+                Op::FieldConstNum(n) => {
+                    let v = self.record.field_num(n as usize, &self.fs);
+                    self.stack.push(Value::Num(v));
+                }
+                Op::LoadField => {
+                    let n = self.pop_index();
+                    let v = Value::Str(String::from(self.record.field(n, &self.fs)));
+                    self.stack.push(v);
+                }
+                Op::LoadFieldNum => {
+                    let n = self.pop_index();
+                    let v = self.record.field_num(n, &self.fs);
+                    self.stack.push(Value::Num(v));
+                }
+                Op::StoreField => {
+                    let v = self.pop();
+                    let n = self.pop_index();
+                    self.set_field(n, &v);
+                    self.stack.push(v);
+                }
+                Op::LoadElem(a) => {
+                    let k = self.pop().as_str();
+                    let v = self.arrays[a as usize].get(&k).cloned().unwrap_or(Value::Uninit);
+                    self.stack.push(v);
+                }
+                Op::StoreElem(a) => {
+                    let v = self.pop();
+                    let k = self.pop().as_str();
+                    self.arrays[a as usize].insert(k, v.clone());
+                    self.stack.push(v);
+                }
+                Op::InArray(a) => {
+                    let k = self.pop().as_str();
+                    let found = self.arrays[a as usize].contains_key(&k);
+                    self.stack.push(Value::Num(if found { 1.0 } else { 0.0 }));
+                }
+                Op::DeleteElem(a) => {
+                    let k = self.pop().as_str();
+                    if k.is_empty() {
+                        self.arrays[a as usize].clear();
+                    } else {
+                        self.arrays[a as usize].remove(&k);
+                    }
+                }
+                Op::DeleteArray(a) => self.arrays[a as usize].clear(),
+                Op::IncrVar(s, d, pre) => {
+                    let old = self.vars[s as usize].as_num();
+                    let new = old + d as f64;
+                    self.vars[s as usize] = Value::Num(new);
+                    self.stack.push(Value::Num(if pre { new } else { old }));
+                }
+                Op::IncrSpecial(s, d, pre) => {
+                    let old = self.load_special(s).as_num();
+                    let new = old + d as f64;
+                    self.store_special(s, &Value::Num(new));
+                    self.stack.push(Value::Num(if pre { new } else { old }));
+                }
+                Op::IncrField(d, pre) => {
+                    let n = self.pop_index();
+                    let old = self.record.field_num(n, &self.fs);
+                    let new = old + d as f64;
+                    self.set_field(n, &Value::Num(new));
+                    self.stack.push(Value::Num(if pre { new } else { old }));
+                }
+                Op::IncrElem(a, d, pre) => {
+                    let k = self.pop().as_str();
+                    let arr = &mut self.arrays[a as usize];
+                    let old = arr.get(&k).map_or(0.0, |v| v.as_num());
+                    let new = old + d as f64;
+                    arr.insert(k, Value::Num(new));
+                    self.stack.push(Value::Num(if pre { new } else { old }));
+                }
+
+                Op::Add | Op::Sub | Op::Mul | Op::Div | Op::Mod => {
+                    let r = self.pop().as_num();
+                    let l = self.pop().as_num();
+                    let v = match op {
+                        Op::Add => l + r,
+                        Op::Sub => l - r,
+                        Op::Mul => l * r,
+                        Op::Div => if r == 0.0 { 0.0 } else { l / r },
+                        _ => if r == 0.0 { 0.0 } else { l % r },
+                    };
+                    self.stack.push(Value::Num(v));
+                }
+                Op::Lt | Op::Gt | Op::Le | Op::Ge => {
+                    let r = self.pop().as_num();
+                    let l = self.pop().as_num();
+                    let t = match op {
+                        Op::Lt => l < r,
+                        Op::Gt => l > r,
+                        Op::Le => l <= r,
+                        _ => l >= r,
+                    };
+                    self.stack.push(Value::Num(if t { 1.0 } else { 0.0 }));
+                }
+                Op::Eq | Op::Ne => {
+                    let r = self.pop();
+                    let l = self.pop();
+                    let eq = l.str_eq(&r);
+                    let t = if let Op::Eq = op { eq } else { !eq };
+                    self.stack.push(Value::Num(if t { 1.0 } else { 0.0 }));
+                }
+                Op::Neg => {
+                    let v = self.pop().as_num();
+                    self.stack.push(Value::Num(-v));
+                }
+                Op::Not => {
+                    let t = self.pop().is_true();
+                    self.stack.push(Value::Num(if t { 0.0 } else { 1.0 }));
+                }
+                Op::Concat => {
+                    let r = self.pop();
+                    let mut s = self.pop().into_string();
+                    r.push_to(&mut s);
+                    self.stack.push(Value::Str(s));
+                }
+                Op::Match(re) => {
+                    let v = self.pop();
+                    let m = match &v {
+                        Value::Str(s) | Value::StrNum(s, _) => prog.regexes[re as usize].is_match(s),
+                        _ => prog.regexes[re as usize].is_match(&v.as_str()),
+                    };
+                    self.stack.push(Value::Num(if m { 1.0 } else { 0.0 }));
+                }
+                Op::MatchRecord(re) => {
+                    let m = prog.regexes[re as usize].is_match(self.record.text());
+                    self.stack.push(Value::Num(if m { 1.0 } else { 0.0 }));
+                }
+
+                Op::Jmp(t) => pc = t as usize,
+                Op::Jz(t) => {
+                    if !self.pop().is_true() {
+                        pc = t as usize;
+                    }
+                }
+                Op::Jnz(t) => {
+                    if self.pop().is_true() {
+                        pc = t as usize;
+                    }
+                }
+
+                Op::Call(b, argc) => {
+                    let base = self.stack.len() - argc as usize;
+                    let v = match b {
+                        Builtin::Rand => {
+                            // Simple LCG
+                            self.rng_state = self.rng_state.wrapping_mul(1103515245).wrapping_add(12345);
+                            Value::Num(((self.rng_state >> 16) & 0x7FFF) as f64 / 32768.0)
+                        }
+                        Builtin::Srand => {
+                            let old = self.rng_state;
+                            if argc > 0 {
+                                self.rng_state = self.stack[base].as_num() as u32;
+                            }
+                            Value::Num(old as f64)
+                        }
+                        _ => builtin(b, &self.stack[base..]),
+                    };
+                    self.stack.truncate(base);
+                    self.stack.push(v);
+                }
+                Op::Split(a, has_sep) => {
+                    let sep = if has_sep { self.pop().as_str() } else { self.fs.clone() };
+                    let s = self.pop().as_str();
+                    record::split_spans(&s, &sep, &mut self.spans);
+                    let arr = &mut self.arrays[a as usize];
+                    arr.clear();
+                    for (i, &(st, e)) in self.spans.iter().enumerate() {
+                        arr.insert(format!("{}", i + 1), Value::Str(String::from(&s[st as usize..e as usize])));
+                    }
+                    self.stack.push(Value::Num(self.spans.len() as f64));
+                }
+                Op::Subst(global) => {
+                    let target = self.pop().as_str();
+                    let repl = self.pop().as_str();
+                    let pat = self.pop().as_str();
+                    let (result, count) = regex_sub(&target, &pat, &repl, global);
+                    self.stack.push(Value::Num(count as f64));
+                    self.stack.push(Value::Str(result));
+                }
+                Op::Print(n, r) => {
+                    let base = self.stack.len() - n as usize;
+                    self.line.clear();
+                    for i in base..self.stack.len() {
+                        if i > base {
+                            self.line.push_str(&self.ofs);
+                        }
+                        self.stack[i].push_to(&mut self.line);
+                    }
+                    self.line.push_str(&self.ors);
+                    self.stack.truncate(base);
+                    self.emit(r);
+                }
+                Op::Printf(n, r) => {
+                    let base = self.stack.len() - n as usize;
+                    if n > 0 {
+                        let fmt = self.stack[base].as_str();
+                        self.line = awk_sprintf(&fmt, &self.stack[base + 1..]);
+                        self.emit(r);
+                    }
+                    self.stack.truncate(base);
+                }
+
+                Op::IterStart(a) => {
+                    let keys: Vec<String> = self.arrays[a as usize].keys().cloned().collect();
+                    self.iters.push((keys, 0));
+                }
+                Op::IterNext(v, end) => {
+                    let next = match self.iters.last_mut() {
+                        Some((keys, i)) if *i < keys.len() => {
+                            *i += 1;
+                            Some(core::mem::take(&mut keys[*i - 1]))
+                        }
+                        _ => None,
+                    };
+                    match next {
+                        Some(k) => self.vars[v as usize] = Value::Str(k),
+                        None => {
+                            self.iters.pop();
+                            pc = end as usize;
+                        }
+                    }
+                }
+
+                Op::Next => return Flow::Next,
+                Op::Exit(has_code) => {
+                    let code = if has_code { self.pop().as_num() as u32 } else { 0 };
+                    return Flow::Exit(code);
+                }
+                Op::Halt => return Flow::Done,
+            }
+        }
+    }
+}
+
+/// Built-ins that depend only on their arguments.
+fn builtin(b: Builtin, args: &[Value]) -> Value {
+    let num = |i: usize| args.get(i).map_or(0.0, |v| v.as_num());
+    let string = |i: usize| args.get(i).map_or(String::new(), |v| v.as_str());
+    match b {
+        Builtin::Length => Value::Num(string(0).len() as f64),
+        Builtin::Substr => {
+            let s = string(0);
+            let start = (num(1) as usize).saturating_sub(1); // 1-indexed
+            let len = if args.len() > 2 { num(2) as usize } else { s.len() };
+            let end = start.saturating_add(len).min(s.len());
+            Value::Str(String::from(s.get(start..end).unwrap_or("")))
+        }
+        Builtin::Index => {
+            let s = string(0);
+            let needle = string(1);
+            match s.find(&*needle) {
+                Some(pos) => Value::Num((pos + 1) as f64), // 1-indexed
+                None => Value::Num(0.0),
+            }
+        }
+        Builtin::Sprintf => match args.split_first() {
+            Some((fmt, vals)) => Value::Str(awk_sprintf(&fmt.as_str(), vals)),
+            None => Value::Str(String::new()),
+        },
+        Builtin::Tolower => Value::Str(string(0).to_ascii_lowercase()),
+        Builtin::Toupper => Value::Str(string(0).to_ascii_uppercase()),
+        Builtin::Sin => Value::Num(libm::sin(num(0))),
+        Builtin::Cos => Value::Num(libm::cos(num(0))),
+        Builtin::Sqrt => Value::Num(libm::sqrt(num(0))),
+        Builtin::Log => Value::Num(libm::log(num(0))),
+        Builtin::Exp => Value::Num(libm::exp(num(0))),
+        Builtin::Int => Value::Num((num(0) as i64) as f64),
+        Builtin::Rand | Builtin::Srand => Value::Num(0.0),
+    }
+}
+
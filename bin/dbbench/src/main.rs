@@ -0,0 +1,434 @@
+//! dbbench — libdb benchmark and regression suite.
+//!
+//! Builds a database per configuration and size, times inserts, point
+//! lookups, range scans, updates, deletes, close and reopen, checks that
+//! every step left the rows it should, and prints one JSON object so
+//! results can be compared from commit to commit.
+//!
+//! Configurations:
+//! - `indexed`: `id` primary key and an index on `v`, default settings
+//! - `noindex`: no indexes, so every lookup scans the table
+//! - `sync`: as `indexed`, but every commit syncs the log (`group_commit = 1`)
+//! - `nocache`: as `indexed`, with the smallest buffer pool (8 pages)
+//!
+//! Without an index a point operation reads the whole table, so those
+//! runs do fewer of them; `ops` in each result gives the number done.
+
+#![no_std]
+#![no_main]
+
+use anyos_std::format;
+use anyos_std::String;
+use anyos_std::Vec;
+use anyos_std::{fs, process, sys};
+use libdb_client::Database;
+
+anyos_std::entry!(main);
+
+const DEFAULT_ROWS: [u32; 3] = [10_000, 100_000, 1_000_000];
+const DEFAULT_OPS: u32 = 1000;
+const DEFAULT_DIR: &str = "/tmp";
+
+/// Rows per transaction while loading.
+const BATCH: u32 = 1000;
+/// Rows inserted one transaction each after loading.
+const COMMITS: u32 = 200;
+/// Range scans per run.
+const RANGES: u32 = 20;
+/// Distinct values of `v`; a range scan covers `RANGE_WIDTH` of them.
+const V_SPAN: i64 = 1000;
+const RANGE_WIDTH: i64 = 10;
+/// Rows a run without indexes may scan for its point operations.
+const SCAN_BUDGET: u64 = 20_000_000;
+
+struct Config {
+    name: &'static str,
+    indexed: bool,
+    group_commit: u32,
+    cache_pages: u32,
+}
+
+const CONFIGS: [Config; 4] = [
+    Config { name: "indexed", indexed: true, group_commit: 8, cache_pages: 256 },
+    Config { name: "noindex", indexed: false, group_commit: 8, cache_pages: 256 },
+    Config { name: "sync", indexed: true, group_commit: 1, cache_pages: 256 },
+    Config { name: "nocache", indexed: true, group_commit: 8, cache_pages: 8 },
+];
+
+fn usage() {
+    anyos_std::println!("Usage: dbbench [-r ROWS[,ROWS...]] [-c CONFIG[,CONFIG...]] [-n OPS] [-d DIR] [-k]");
+    anyos_std::println!("  -r  table sizes (default 10000,100000,1000000)");
+    anyos_std::println!("  -c  indexed, noindex, sync, nocache (default all)");
+    anyos_std::println!("  -n  point lookups, updates and deletes per run (default {})", DEFAULT_OPS);
+    anyos_std::println!("  -d  directory for the database files (default {})", DEFAULT_DIR);
+    anyos_std::println!("  -k  keep the database files");
+}
+
+fn main() {
+    let mut args_buf = [0u8; 256];
+    let raw = process::args(&mut args_buf);
+    let args = anyos_std::args::parse(raw, b"rcnd");
+    if args.has(b'h') || args.pos_count > 0 {
+        usage();
+        return;
+    }
+
+    let mut sizes: Vec<u32> = Vec::new();
+    match args.opt(b'r') {
+        Some(list) => {
+            for s in list.split(',') {
+                match s.trim().parse::<u32>() {
+                    Ok(n) if n >= 2 => sizes.push(n),
+                    _ => {
+                        anyos_std::println!("dbbench: bad row count '{}'", s);
+                        return;
+                    }
+                }
+            }
+        }
+        None => sizes.extend_from_slice(&DEFAULT_ROWS),
+    }
+    let configs: Vec<&Config> = match args.opt(b'c') {
+        Some(list) => {
+            let mut picked = Vec::new();
+            for name in list.split(',') {
+                match CONFIGS.iter().find(|c| c.name == name.trim()) {
+                    Some(c) => picked.push(c),
+                    None => {
+                        anyos_std::println!("dbbench: unknown configuration '{}'", name);
+                        return;
+                    }
+                }
+            }
+            picked
+        }
+        None => CONFIGS.iter().collect(),
+    };
+    let ops = args.opt_u32(b'n', DEFAULT_OPS).max(1);
+    let dir = args.opt(b'd').unwrap_or(DEFAULT_DIR).trim_end_matches('/');
+    let keep = args.has(b'k');
+
+    if !libdb_client::init() {
+        anyos_std::println!("dbbench: cannot load /Libraries/libdb.so");
+        process::exit(1);
+    }
+
+    let mut results = String::new();
+    let mut failures = 0u32;
+    for config in &configs {
+        for &rows in &sizes {
+            let path = format!("{}/dbbench-{}-{}.db", dir, config.name, rows);
+            let mut report = Report::new();
+            report.text("config", config.name);
+            report.int("rows", rows as u64);
+            report.int("cache_pages", config.cache_pages as u64);
+            report.int("group_commit", config.group_commit as u64);
+            if let Err(e) = run(config, rows, ops, &path, &mut report) {
+                report.text("error", &e);
+                failures += 1;
+            }
+            if !keep {
+                remove(&path);
+            }
+            if !results.is_empty() {
+                results.push_str(",\n");
+            }
+            results.push_str(&report.finish());
+        }
+    }
+
+    anyos_std::println!(
+        "{{\n  \"version\": 1,\n  \"ops\": {},\n  \"results\": [\n{}\n  ],\n  \"failures\": {}\n}}",
+        ops, results, failures,
+    );
+    if failures > 0 {
+        process::exit(1);
+    }
+}
+
+/// One benchmark run: build the table, time each phase and verify it.
+fn run(config: &Config, rows: u32, ops: u32, path: &str, report: &mut Report) -> Result<(), String> {
+    remove(path);
+    let db = open(path)?;
+    db.exec(&format!("PRAGMA cache_size = {}", config.cache_pages))?;
+    db.exec(&format!("PRAGMA group_commit = {}", config.group_commit))?;
+    if config.indexed {
+        db.exec("CREATE TABLE bench (id INTEGER PRIMARY KEY, v INTEGER, tag TEXT)")?;
+        db.exec("CREATE INDEX bench_v ON bench (v)")?;
+    } else {
+        db.exec("CREATE TABLE bench (id INTEGER, v INTEGER, tag TEXT)")?;
+    }
+    let keys = Keys::new(rows);
+
+    // Load in batches, ids in a scattered order
+    let start = sys::monotonic_ns();
+    {
+        let mut insert = db.prepare("INSERT INTO bench VALUES (?, ?, ?)")?;
+        let mut i = 0;
+        while i < rows {
+            db.exec("BEGIN")?;
+            for j in i..(i + BATCH).min(rows) {
+                let id = keys.get(j);
+                insert.bind_int(1, id)?;
+                insert.bind_int(2, value_of(id))?;
+                insert.bind_text(3, &tag_of(id))?;
+                insert.step()?;
+            }
+            db.exec("COMMIT")?;
+            i += BATCH;
+        }
+    }
+    let ns = elapsed(start);
+    report.int("insert_ms", ns / 1_000_000);
+    report.rate("insert_rows_per_s", rows as u64, ns);
+    expect(count(&db, "SELECT COUNT(*) FROM bench")?, rows as i64, "rows after load")?;
+
+    // One transaction per row: the cost of a commit
+    let start = sys::monotonic_ns();
+    {
+        let mut insert = db.prepare("INSERT INTO bench VALUES (?, ?, ?)")?;
+        for id in rows as i64..(rows + COMMITS) as i64 {
+            insert.bind_int(1, id)?;
+            insert.bind_int(2, value_of(id))?;
+            insert.bind_text(3, &tag_of(id))?;
+            insert.step()?;
+        }
+    }
+    report.rate("commit_rows_per_s", COMMITS as u64, elapsed(start));
+    let total = rows + COMMITS;
+
+    let point_ops = if config.indexed {
+        ops
+    } else {
+        (SCAN_BUDGET / total as u64).max(5).min(ops as u64) as u32
+    }
+    .min(rows / 2);
+    report.int("ops", point_ops as u64);
+
+    let mut rng = Rng(0x9e37_79b9_7f4a_7c15 ^ rows as u64);
+    let mut lat = Vec::with_capacity(point_ops as usize);
+    {
+        let mut lookup = db.prepare("SELECT v FROM bench WHERE id = ?")?;
+        for _ in 0..point_ops {
+            let id = rng.below(total as u64) as i64;
+            lookup.bind_int(1, id)?;
+            let start = sys::monotonic_ns();
+            let result = lookup.step_query()?;
+            lat.push(elapsed(start));
+            if result.row_count() != 1 || result.get_int(0, 0) != Some(value_of(id)) {
+                return Err(format!("lookup of id {} returned the wrong row", id));
+            }
+        }
+    }
+    report.latency("lookup", &mut lat);
+
+    lat.clear();
+    let mut scanned = 0u64;
+    {
+        let mut range = db.prepare("SELECT id FROM bench WHERE v >= ? AND v < ?")?;
+        for _ in 0..RANGES {
+            let lo = rng.below((V_SPAN - RANGE_WIDTH) as u64) as i64;
+            range.bind_int(1, lo)?;
+            range.bind_int(2, lo + RANGE_WIDTH)?;
+            let start = sys::monotonic_ns();
+            let result = range.step_query()?;
+            lat.push(elapsed(start));
+            scanned += result.row_count() as u64;
+        }
+    }
+    report.latency("range", &mut lat);
+    report.int("range_rows", scanned / RANGES as u64);
+
+    // Updates move rows out of the range of `v`; deletes take other rows
+    lat.clear();
+    db.exec("BEGIN")?;
+    {
+        let mut update = db.prepare("UPDATE bench SET v = ? WHERE id = ?")?;
+        for j in 0..point_ops {
+            let id = keys.get(j);
+            update.bind_int(1, V_SPAN + id % 7)?;
+            update.bind_int(2, id)?;
+            let start = sys::monotonic_ns();
+            let n = update.step()?;
+            lat.push(elapsed(start));
+            expect(n as i64, 1, "rows updated")?;
+        }
+    }
+    db.exec("COMMIT")?;
+    report.latency("update", &mut lat);
+
+    lat.clear();
+    db.exec("BEGIN")?;
+    {
+        let mut delete = db.prepare("DELETE FROM bench WHERE id = ?")?;
+        for j in point_ops..point_ops * 2 {
+            delete.bind_int(1, keys.get(j))?;
+            let start = sys::monotonic_ns();
+            let n = delete.step()?;
+            lat.push(elapsed(start));
+            expect(n as i64, 1, "rows deleted")?;
+        }
+    }
+    db.exec("COMMIT")?;
+    report.latency("delete", &mut lat);
+
+    let cache = db.query("PRAGMA cache_stats")?;
+    report.int("cache_hit_pct", cache.get_int(0, 2).unwrap_or(0) as u64);
+    let wal = db.query("PRAGMA wal_stats")?;
+    report.int("wal_syncs", wal.get_int(0, 1).unwrap_or(0) as u64);
+
+    let start = sys::monotonic_ns();
+    db.close();
+    report.int("close_ms", elapsed(start) / 1_000_000);
+    report.int("file_bytes", file_size(path));
+    report.int("wal_bytes", file_size(&format!("{}-wal", path)));
+
+    let start = sys::monotonic_ns();
+    let db = open(path)?;
+    let n = count(&db, "SELECT COUNT(*) FROM bench")?;
+    report.int("reopen_ms", elapsed(start) / 1_000_000);
+    expect(n, (total - point_ops) as i64, "rows after reopen")?;
+    let moved = count(&db, &format!("SELECT COUNT(*) FROM bench WHERE v >= {}", V_SPAN))?;
+    expect(moved, point_ops as i64, "updated rows after reopen")?;
+    db.close();
+    Ok(())
+}
+
+fn open(path: &str) -> Result<Database, String> {
+    Database::open(path).ok_or_else(|| format!("cannot open {}", path))
+}
+
+fn count(db: &Database, sql: &str) -> Result<i64, String> {
+    db.query(sql)?.get_int(0, 0).ok_or_else(|| String::from("COUNT(*) returned no value"))
+}
+
+fn expect(got: i64, want: i64, what: &str) -> Result<(), String> {
+    if got == want {
+        Ok(())
+    } else {
+        Err(format!("{}: got {}, want {}", what, got, want))
+    }
+}
+
+fn remove(path: &str) {
+    fs::unlink(path);
+    fs::unlink(&format!("{}-wal", path));
+}
+
+fn file_size(path: &str) -> u64 {
+    let mut stat_buf = [0u32; 7];
+    if fs::stat(path, &mut stat_buf) == 0 { stat_buf[1] as u64 } else { 0 }
+}
+
+fn elapsed(start: u64) -> u64 {
+    sys::monotonic_ns().saturating_sub(start).max(1)
+}
+
+/// The column `v` of row `id`: scattered over `0..V_SPAN`.
+fn value_of(id: i64) -> i64 {
+    ((id as u64).wrapping_mul(0x9e37_79b9_7f4a_7c15) >> 40) as i64 % V_SPAN
+}
+
+fn tag_of(id: i64) -> String {
+    format!("tag{}", id % 97)
+}
+
+/// A permutation of `0..rows`: `j * step mod rows` with `step` coprime to
+/// `rows`, so consecutive inserts land far apart in the key space.
+struct Keys {
+    rows: u64,
+    step: u64,
+}
+
+impl Keys {
+    fn new(rows: u32) -> Keys {
+        let rows = rows as u64;
+        let mut step = 7919 % rows;
+        while gcd(step, rows) != 1 {
+            step += 1;
+        }
+        Keys { rows, step }
+    }
+
+    fn get(&self, j: u32) -> i64 {
+        (j as u64 * self.step % self.rows) as i64
+    }
+}
+
+fn gcd(mut a: u64, mut b: u64) -> u64 {
+    while b != 0 {
+        let t = a % b;
+        a = b;
+        b = t;
+    }
+    a
+}
+
+/// xorshift64* — deterministic, so every run does the same operations.
+struct Rng(u64);
+
+impl Rng {
+    fn below(&mut self, n: u64) -> u64 {
+        self.0 ^= self.0 >> 12;
+        self.0 ^= self.0 << 25;
+        self.0 ^= self.0 >> 27;
+        self.0.wrapping_mul(0x2545_f491_4f6c_dd1d) % n
+    }
+}
+
+/// One `results[]` entry, built field by field.
+struct Report {
+    fields: String,
+}
+
+impl Report {
+    fn new() -> Report {
+        Report { fields: String::new() }
+    }
+
+    fn field(&mut self, key: &str, value: &str) {
+        if !self.fields.is_empty() {
+            self.fields.push_str(", ");
+        }
+        self.fields.push_str(&format!("\"{}\": {}", key, value));
+    }
+
+    fn int(&mut self, key: &str, value: u64) {
+        self.field(key, &format!("{}", value));
+    }
+
+    fn text(&mut self, key: &str, value: &str) {
+        let mut quoted = String::from("\"");
+        for c in value.chars() {
+            match c {
+                '"' | '\\' => { quoted.push('\\'); quoted.push(c); }
+                c if (c as u32) < 0x20 => quoted.push(' '),
+                c => quoted.push(c),
+            }
+        }
+        quoted.push('"');
+        self.field(key, &quoted);
+    }
+
+    /// `count` items in `ns` nanoseconds, as items per second.
+    fn rate(&mut self, key: &str, count: u64, ns: u64) {
+        self.int(key, (count as u128 * 1_000_000_000 / ns as u128) as u64);
+    }
+
+    /// Median and p95 (nearest rank) of per-operation times, in µs.
+    fn latency(&mut self, name: &str, ns: &mut [u64]) {
+        if ns.is_empty() {
+            return;
+        }
+        ns.sort_unstable();
+        let n = ns.len();
+        let median = ns[n / 2];
+        let p95 = ns[((n * 95 + 99) / 100).max(1) - 1];
+        self.field(&format!("{}_us", name), &format!("{:.1}", median as f64 / 1000.0));
+        self.field(&format!("{}_p95_us", name), &format!("{:.1}", p95 as f64 / 1000.0));
+    }
+
+    fn finish(self) -> String {
+        format!("    {{{}}}", self.fields)
+    }
+}
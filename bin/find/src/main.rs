@@ -1,6 +1,9 @@
 #![no_std]
 #![no_main]
 
+use alloc::string::String;
+use alloc::vec::Vec;
+
 anyos_std::entry!(main);
 
 fn to_lower(b: u8) -> u8 {
@@ -45,54 +48,86 @@ fn matches_pattern(name: &str, pattern: &str, ignore_case: bool) -> bool {
     pi == pat.len()
 }
 
-fn build_path(buf: &mut [u8; 512], parent: &str, name: &str) -> usize {
-    let plen = parent.len();
-    let has_slash = plen > 0 && parent.as_bytes()[plen - 1] == b'/';
-    buf[..plen].copy_from_slice(parent.as_bytes());
-    let mut pos = plen;
-    if !has_slash && plen > 0 {
-        buf[pos] = b'/';
-        pos += 1;
+fn build_path(parent: &str, name: &str) -> String {
+    if parent.ends_with('/') {
+        alloc::format!("{}{}", parent, name)
+    } else {
+        alloc::format!("{}/{}", parent, name)
     }
-    let nlen = name.len().min(512 - pos);
-    buf[pos..pos + nlen].copy_from_slice(&name.as_bytes()[..nlen]);
-    pos + nlen
 }
 
-fn find_in(path: &str, pattern: &str, ignore_case: bool, type_filter: u8) {
-    let mut buf = [0u8; 64 * 128]; // max 128 entries
-    let count = anyos_std::fs::readdir(path, &mut buf);
-    if count == u32::MAX { return; }
-
-    for i in 0..count as usize {
-        // 64-byte struct: [type:u8, name_len:u8, pad:u16, size:u32, name:56bytes]
-        let entry = &buf[i * 64..(i + 1) * 64];
-        let entry_type = entry[0];
-        let name_len = entry[1] as usize;
-        let name = core::str::from_utf8(&entry[8..8 + name_len.min(56)]).unwrap_or("");
-
-        if name.is_empty() || name == "." || name == ".." { continue; }
-
-        let mut path_buf = [0u8; 512];
-        let full_len = build_path(&mut path_buf, path, name);
-        let full_str = core::str::from_utf8(&path_buf[..full_len]).unwrap_or("");
+/// Match criteria shared by every directory visit.
+struct Query<'a> {
+    pattern: &'a str,
+    ignore_case: bool,
+    /// 0 = no filter, b'f' = regular files, b'd' = directories.
+    type_filter: u8,
+}
 
-        // Check type filter: 0=no filter, 'f'=file(0), 'd'=dir(1)
-        let type_ok = match type_filter {
-            b'f' => entry_type == 0,
-            b'd' => entry_type == 1,
+/// Search the tree below `path` and return its output, in directory order.
+/// Subdirectories are searched in parallel on the thread pool.
+fn find_in(path: &str, q: &Query) -> Vec<u8> {
+    let dir = match anyos_std::fs::read_dir(path) {
+        Ok(d) => d,
+        Err(_) => return Vec::new(),
+    };
+
+    // (full path, matched, subtree index) per entry.
+    let mut entries: Vec<(String, bool, Option<usize>)> = Vec::new();
+    let mut subdirs: Vec<String> = Vec::new();
+    for entry in dir {
+        if entry.name.is_empty() || entry.name == "." || entry.name == ".." { continue; }
+
+        let full = build_path(path, &entry.name);
+        let type_ok = match q.type_filter {
+            b'f' => entry.file_type == 0,
+            b'd' => entry.file_type == 1,
             _ => true,
         };
+        let matched = type_ok && matches_pattern(&entry.name, q.pattern, q.ignore_case);
 
-        if type_ok && matches_pattern(name, pattern, ignore_case) {
-            anyos_std::println!("{}", full_str);
-        }
+        // Symlinked directories are not followed, so a link cycle cannot
+        // make the walk endless.
+        let sub = if entry.is_dir() && !entry.is_symlink {
+            subdirs.push(full.clone());
+            Some(subdirs.len() - 1)
+        } else {
+            None
+        };
+        entries.push((full, matched, sub));
+    }
 
-        // Recurse into directories
-        if entry_type == 1 {
-            find_in(full_str, pattern, ignore_case, type_filter);
+    let mut results = find_all(&subdirs, q);
+    let mut out = Vec::new();
+    for (full, matched, sub) in entries {
+        if matched {
+            out.extend_from_slice(full.as_bytes());
+            out.push(b'\n');
+        }
+        if let Some(i) = sub {
+            out.append(&mut results[i]);
         }
     }
+    out
+}
+
+/// Search each of `dirs`, splitting the list across the pool.
+fn find_all(dirs: &[String], q: &Query) -> Vec<Vec<u8>> {
+    if dirs.len() <= 1 {
+        return dirs.iter().map(|d| find_in(d, q)).collect();
+    }
+    let (left, right) = dirs.split_at(dirs.len() / 2);
+    let (mut a, b) = anyos_std::pool::join(|| find_all(left, q), || find_all(right, q));
+    a.extend(b);
+    a
+}
+
+fn write_all(mut data: &[u8]) {
+    while !data.is_empty() {
+        let n = anyos_std::fs::write(1, &data[..data.len().min(64 * 1024)]);
+        if n == 0 || n == u32::MAX { return; }
+        data = &data[n as usize..];
+    }
 }
 
 /// Strip surrounding quotes (" or ') from a string if present.
@@ -147,5 +182,6 @@ fn main() {
         }
     }
 
-    find_in(path, pattern, ignore_case, type_filter);
+    let query = Query { pattern, ignore_case, type_filter };
+    write_all(&find_in(path, &query));
 }
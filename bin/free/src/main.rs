@@ -4,8 +4,10 @@
 anyos_std::entry!(main);
 
 fn main() {
-    // Memory info (cmd=0): [total_frames:u32, free_frames:u32, heap_used:u32, heap_total:u32]
-    let mut mem_buf = [0u8; 16];
+    // Memory info (cmd=0): [total_frames:u32, free_frames:u32, heap_used:u32, heap_total:u32,
+    //                      slab_used:u32, slab_reserved:u32,
+    //                      zero_pooled:u32, zero_hits:u32, zero_misses:u32]
+    let mut mem_buf = [0u8; 36];
     if anyos_std::sys::sysinfo(0, &mut mem_buf) != 0 {
         anyos_std::println!("Failed to get memory info.");
         return;
@@ -15,6 +17,11 @@ fn main() {
     let free = u32::from_le_bytes([mem_buf[4], mem_buf[5], mem_buf[6], mem_buf[7]]);
     let heap_used = u32::from_le_bytes([mem_buf[8], mem_buf[9], mem_buf[10], mem_buf[11]]);
     let heap_total = u32::from_le_bytes([mem_buf[12], mem_buf[13], mem_buf[14], mem_buf[15]]);
+    let slab_used = u32::from_le_bytes([mem_buf[16], mem_buf[17], mem_buf[18], mem_buf[19]]);
+    let slab_reserved = u32::from_le_bytes([mem_buf[20], mem_buf[21], mem_buf[22], mem_buf[23]]);
+    let zero_pooled = u32::from_le_bytes([mem_buf[24], mem_buf[25], mem_buf[26], mem_buf[27]]);
+    let zero_hits = u32::from_le_bytes([mem_buf[28], mem_buf[29], mem_buf[30], mem_buf[31]]);
+    let zero_misses = u32::from_le_bytes([mem_buf[32], mem_buf[33], mem_buf[34], mem_buf[35]]);
 
     let total_kb = total * 4;
     let free_kb = free * 4;
@@ -27,4 +34,46 @@ fn main() {
         heap_used / 1024,
         (heap_total - heap_used) / 1024,
     );
+    anyos_std::println!("Slab:    {:>8} KiB {:>8} KiB {:>8} KiB",
+        slab_reserved / 1024,
+        slab_used / 1024,
+        (slab_reserved - slab_used.min(slab_reserved)) / 1024,
+    );
+    let zero_allocs = zero_hits as u64 + zero_misses as u64;
+    if zero_allocs > 0 {
+        anyos_std::println!("Zeroed:  {:>8} KiB ready, {}% of zero-fill allocations pre-zeroed",
+            zero_pooled * 4,
+            zero_hits as u64 * 100 / zero_allocs,
+        );
+    }
+    // Page cache (cmd=6): [pages:u32, max_pages:u32, hits:u64, misses:u64, evictions:u64,
+    //                    readahead:u64, readahead_wasted:u64]
+    let mut pc_buf = [0u8; 48];
+    if anyos_std::sys::sysinfo(6, &mut pc_buf) == 0 {
+        let pages = u32::from_le_bytes([pc_buf[0], pc_buf[1], pc_buf[2], pc_buf[3]]);
+        let max_pages = u32::from_le_bytes([pc_buf[4], pc_buf[5], pc_buf[6], pc_buf[7]]);
+        let mut word = [0u8; 8];
+        word.copy_from_slice(&pc_buf[8..16]);
+        let hits = u64::from_le_bytes(word);
+        word.copy_from_slice(&pc_buf[16..24]);
+        let misses = u64::from_le_bytes(word);
+        let lookups = hits + misses;
+        let hit_pct = if lookups > 0 { hits * 100 / lookups } else { 0 };
+        anyos_std::println!("Cache:   {:>8} KiB {:>8} KiB {:>8} KiB  ({}% hit)",
+            max_pages * 4,
+            pages * 4,
+            (max_pages - pages.min(max_pages)) * 4,
+            hit_pct,
+        );
+        word.copy_from_slice(&pc_buf[32..40]);
+        let ahead = u64::from_le_bytes(word);
+        word.copy_from_slice(&pc_buf[40..48]);
+        let wasted = u64::from_le_bytes(word);
+        if ahead > 0 {
+            anyos_std::println!("Ahead:   {:>8} KiB read ahead, {}% evicted unread",
+                ahead * 4,
+                wasted * 100 / ahead,
+            );
+        }
+    }
 }
@@ -205,27 +205,26 @@ impl FtpClient {
     fn put(&mut self, local_path: &str, remote_path: &str) {
         self.set_binary_mode();
 
-        // Read local file
+        // Open local file; its data is streamed by the kernel
         let fd = fs::open(local_path, 0);
         if fd == u32::MAX {
             println!("Failed to open local file: {}", local_path);
             return;
         }
-
-        let mut file_data = Vec::new();
-        let mut buf = [0u8; 2048];
-        loop {
-            let n = fs::read(fd, &mut buf);
-            if n == 0 || n == u32::MAX {
-                break;
-            }
-            file_data.extend_from_slice(&buf[..n as usize]);
+        let mut stat_buf = [0u32; 4];
+        if fs::fstat(fd, &mut stat_buf) != 0 {
+            println!("Failed to stat local file: {}", local_path);
+            fs::close(fd);
+            return;
         }
-        fs::close(fd);
+        let file_size = stat_buf[1];
 
         let data_sock = match self.open_data_connection() {
             Some(s) => s,
-            None => return,
+            None => {
+                fs::close(fd);
+                return;
+            }
         };
 
         self.send_command("STOR ", remote_path);
@@ -233,26 +232,27 @@ impl FtpClient {
         if !resp.starts_with("150") && !resp.starts_with("125") {
             println!("STOR failed: {}", resp);
             net::tcp_close(data_sock);
+            fs::close(fd);
             return;
         }
 
-        // Send file data
-        let mut offset = 0;
-        while offset < file_data.len() {
-            let end = (offset + 1460).min(file_data.len());
-            let sent = net::tcp_send(data_sock, &file_data[offset..end]);
-            if sent == u32::MAX {
+        // Send file data straight from the page cache
+        let mut offset = 0u32;
+        while offset < file_size {
+            let sent = net::sendfile(fd, data_sock, offset, file_size - offset);
+            if sent == 0 || sent == u32::MAX {
                 println!("Send error at offset {}", offset);
                 break;
             }
-            offset = end;
+            offset += sent;
         }
+        fs::close(fd);
         net::tcp_close(data_sock);
 
         // Read 226 Transfer complete
         let resp = self.read_response();
         if resp.starts_with("226") {
-            println!("Uploaded {} bytes from {}", file_data.len(), local_path);
+            println!("Uploaded {} bytes from {}", offset, local_path);
         } else {
             println!("Transfer issue: {}", resp);
         }
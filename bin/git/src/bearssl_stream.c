@@ -1,6 +1,11 @@
 /*
  * BearSSL TLS stream backend for libgit2 on anyOS
  * Implements the git_stream interface using BearSSL for HTTPS support.
+ *
+ * Session parameters are cached per host and offered on the next connect,
+ * so the several connections of one clone/fetch resume the first session
+ * instead of repeating the key exchange.  With GIT_SSL_SESSION_CACHE set to
+ * a file path the cache is also kept on disk across git invocations.
  */
 
 #include <stdio.h>
@@ -120,6 +125,93 @@ static const br_x509_class nocheck_vtable = {
     nocheck_get_pkey
 };
 
+/* ---------------------------------------------------------------------------
+ * TLS session cache
+ * --------------------------------------------------------------------------- */
+
+/*
+ * BearSSL resumes by session ID only (no tickets).  A stale entry costs
+ * nothing: the server simply answers with a full handshake.
+ */
+
+#define SESSION_CACHE_SIZE 8
+#define SESSION_HOST_MAX   128
+
+typedef struct {
+    char                      host[SESSION_HOST_MAX];
+    br_ssl_session_parameters params;
+} session_entry;
+
+static session_entry session_cache[SESSION_CACHE_SIZE];
+static int session_next;
+static int session_loaded;
+
+static void session_cache_load(void)
+{
+    const char *path = getenv("GIT_SSL_SESSION_CACHE");
+    FILE *f;
+
+    if (session_loaded) return;
+    session_loaded = 1;
+    if (!path || !*path) return;
+
+    f = fopen(path, "rb");
+    if (!f) return;
+    if (fread(session_cache, 1, sizeof(session_cache), f) != sizeof(session_cache))
+        memset(session_cache, 0, sizeof(session_cache));
+    fclose(f);
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++)
+        session_cache[i].host[SESSION_HOST_MAX - 1] = '\0';
+}
+
+static void session_cache_save(void)
+{
+    const char *path = getenv("GIT_SSL_SESSION_CACHE");
+    FILE *f;
+
+    if (!path || !*path) return;
+    f = fopen(path, "wb");
+    if (!f) return;
+    fwrite(session_cache, 1, sizeof(session_cache), f);
+    fclose(f);
+}
+
+static session_entry *session_find(const char *host)
+{
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        if (session_cache[i].host[0] && strcmp(session_cache[i].host, host) == 0)
+            return &session_cache[i];
+    }
+    return NULL;
+}
+
+static void session_store(const char *host, const br_ssl_session_parameters *p)
+{
+    size_t len = strlen(host);
+    session_entry *e;
+
+    if (len >= SESSION_HOST_MAX || p->session_id_len == 0) return;
+    e = session_find(host);
+    if (!e) {
+        e = &session_cache[session_next];
+        session_next = (session_next + 1) % SESSION_CACHE_SIZE;
+        memcpy(e->host, host, len + 1);
+    } else if (memcmp(&e->params, p, sizeof(*p)) == 0) {
+        return; /* session was resumed */
+    }
+    e->params = *p;
+    session_cache_save();
+}
+
+static void session_forget(const char *host)
+{
+    session_entry *e = session_find(host);
+    if (e) {
+        memset(e, 0, sizeof(*e));
+        session_cache_save();
+    }
+}
+
 /* ---------------------------------------------------------------------------
  * BearSSL git_stream implementation
  * --------------------------------------------------------------------------- */
@@ -137,6 +229,7 @@ typedef struct {
     unsigned char         iobuf[BR_SSL_BUFSIZE_BIDI];
     br_sslio_context      ioc;
     int                   connected;
+    int                   session_saved; /* handshake done, params cached */
 } bearssl_stream;
 
 /* Low-level socket I/O callbacks used by br_sslio_init() */
@@ -211,7 +304,14 @@ static int bearssl_connect(git_stream *stream)
     br_ssl_engine_set_x509(&bs->sc.eng, &bs->xc.vtable);
 
     br_ssl_engine_set_buffer(&bs->sc.eng, bs->iobuf, sizeof(bs->iobuf), 1);
-    br_ssl_client_reset(&bs->sc, bs->host, 0);
+
+    session_cache_load();
+    session_entry *cached = session_find(bs->host);
+    if (cached) {
+        br_ssl_engine_set_session_parameters(&bs->sc.eng, &cached->params);
+        fprintf(stderr, "[bearssl] offering cached session for %s\n", bs->host);
+    }
+    br_ssl_client_reset(&bs->sc, bs->host, cached != NULL);
 
     br_sslio_init(&bs->ioc, &bs->sc.eng,
                   sock_read,  &bs->socket,
@@ -239,6 +339,8 @@ static ssize_t bearssl_read(git_stream *stream, void *data, size_t len)
         int ssl_err = (int)br_ssl_engine_last_error(&bs->sc.eng);
         fprintf(stderr, "[bearssl] read failed n=%d BearSSL_err=%d\n",
                 n, ssl_err);
+        if (!bs->session_saved && ssl_err != BR_ERR_OK)
+            session_forget(bs->host);
         git_error_set(GIT_ERROR_SSL,
             "TLS read failed (BearSSL error %d)", ssl_err);
         return -1;
@@ -256,6 +358,8 @@ static ssize_t bearssl_write(git_stream *stream, const char *data, size_t len,
     if (n < 0) {
         int ssl_err = (int)br_ssl_engine_last_error(&bs->sc.eng);
         fprintf(stderr, "[bearssl] write_all failed BearSSL_err=%d\n", ssl_err);
+        if (!bs->session_saved)
+            session_forget(bs->host);
         git_error_set(GIT_ERROR_SSL,
             "TLS write failed (BearSSL error %d)", ssl_err);
         return -1;
@@ -264,11 +368,21 @@ static ssize_t bearssl_write(git_stream *stream, const char *data, size_t len,
     if (br_sslio_flush(&bs->ioc) < 0) {
         int ssl_err = (int)br_ssl_engine_last_error(&bs->sc.eng);
         fprintf(stderr, "[bearssl] flush failed BearSSL_err=%d\n", ssl_err);
+        if (!bs->session_saved)
+            session_forget(bs->host);
         git_error_set(GIT_ERROR_SSL,
             "TLS flush failed (BearSSL error %d)", ssl_err);
         return -1;
     }
 
+    /* The first flush completed the (deferred) handshake. */
+    if (!bs->session_saved) {
+        br_ssl_session_parameters params;
+        br_ssl_engine_get_session_parameters(&bs->sc.eng, &params);
+        session_store(bs->host, &params);
+        bs->session_saved = 1;
+    }
+
     fprintf(stderr, "[bearssl] write OK (%zu bytes)\n", len);
     return (ssize_t)len;
 }
@@ -6,6 +6,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
 #include <git2.h>
 
 /* BearSSL TLS stream registration (defined in bearssl_stream.c) */
@@ -279,6 +282,97 @@ static int cmd_diff(int argc, char **argv) {
     return 0;
 }
 
+/* ---- Progress and phase timing ---- */
+
+/* Phases timed by --progress */
+enum { PH_RECEIVE, PH_DELTAS, PH_CHECKOUT, PH_SYNC, PH_COUNT };
+static const char *phase_names[PH_COUNT] = {
+    "receiving objects", "resolving deltas", "checking out files", "syncing to disk"
+};
+
+static int show_progress;
+static unsigned long phase_ms[PH_COUNT];
+static int phase_seen[PH_COUNT];
+static int cur_phase = -1;
+static unsigned long phase_start;
+static int last_pct = -1;
+
+static unsigned long now_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (unsigned long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* Switch to phase `ph` (-1 = none), charging the elapsed time to the old one. */
+static void phase_enter(int ph) {
+    if (ph == cur_phase) return;
+    unsigned long now = now_ms();
+    if (cur_phase >= 0) phase_ms[cur_phase] += now - phase_start;
+    if (ph >= 0) phase_seen[ph] = 1;
+    cur_phase = ph;
+    phase_start = now;
+    last_pct = -1;
+}
+
+static void phase_report(void) {
+    if (!show_progress) return;
+    phase_enter(-1);
+    unsigned long total = 0;
+    for (int i = 0; i < PH_COUNT; i++) {
+        if (!phase_seen[i]) continue;
+        printf("  %-20s %6lu ms\n", phase_names[i], phase_ms[i]);
+        total += phase_ms[i];
+    }
+    printf("  %-20s %6lu ms\n", "total", total);
+}
+
+/* Print a progress line only when its percentage changes: one line per
+ * object would cost more terminal output than the transfer itself. */
+static void progress_line(const char *what, unsigned int done, unsigned int total) {
+    int pct = total ? (int)(100ULL * done / total) : 100;
+    if (pct == last_pct) return;
+    last_pct = pct;
+    printf("\r%s: %3d%% (%u/%u)", what, pct, done, total);
+    if (done == total)
+        printf(", done.\n");
+    fflush(stdout);
+}
+
+/* ---- Transfer progress callback ---- */
+static int fetch_progress(const git_indexer_progress *stats, void *payload) {
+    (void)payload;
+    if (stats->received_objects > 0 && cur_phase != PH_DELTAS) {
+        phase_enter(PH_RECEIVE);
+        progress_line("Receiving objects", stats->received_objects, stats->total_objects);
+    }
+    if (show_progress && stats->received_objects == stats->total_objects
+            && stats->total_deltas > 0) {
+        phase_enter(PH_DELTAS);
+        progress_line("Resolving deltas", stats->indexed_deltas, stats->total_deltas);
+    }
+    return 0;
+}
+
+static void checkout_progress(const char *path, size_t completed, size_t total, void *payload) {
+    (void)path; (void)payload;
+    phase_enter(PH_CHECKOUT);
+    if (total > 0)
+        progress_line("Checking out files", (unsigned int)completed, (unsigned int)total);
+}
+
+/* Flush the working tree in one pass. Checkout leaves file data in the
+ * kernel's write-back cache, and fsync on any file syncs the whole mount
+ * as sorted, merged runs, instead of one write per blob. */
+static void sync_workdir(git_repository *repo) {
+    char path[512];
+    snprintf(path, sizeof(path), "%sindex", git_repository_path(repo));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    phase_enter(PH_SYNC);
+    fsync(fd);
+    close(fd);
+}
+
 /* ---- git clone ---- */
 static int cmd_clone(int argc, char **argv) {
     if (argc < 1) {
@@ -307,11 +401,16 @@ static int cmd_clone(int argc, char **argv) {
 
     git_clone_options opts = GIT_CLONE_OPTIONS_INIT;
     opts.fetch_opts.follow_redirects = GIT_REMOTE_REDIRECT_ALL;
+    opts.fetch_opts.callbacks.transfer_progress = fetch_progress;
+    if (show_progress)
+        opts.checkout_opts.progress_cb = checkout_progress;
     git_repository *repo = NULL;
     int err = git_clone(&repo, url, path, &opts);
     if (err < 0) die("git_clone", err);
+    sync_workdir(repo);
 
     printf("done.\n");
+    phase_report();
     git_repository_free(repo);
     return 0;
 }
@@ -370,19 +469,6 @@ static int cmd_remote(int argc, char **argv) {
     return 0;
 }
 
-/* ---- Transfer progress callback ---- */
-static int fetch_progress(const git_indexer_progress *stats, void *payload) {
-    (void)payload;
-    if (stats->received_objects > 0) {
-        printf("\rReceiving objects: %3d%% (%u/%u)",
-            (int)(100 * stats->received_objects / stats->total_objects),
-            stats->received_objects, stats->total_objects);
-        if (stats->received_objects == stats->total_objects)
-            printf(", done.\n");
-    }
-    return 0;
-}
-
 /* ---- git fetch ---- */
 static int cmd_fetch(int argc, char **argv) {
     const char *remote_name = (argc > 0) ? argv[0] : "origin";
@@ -403,6 +489,7 @@ static int cmd_fetch(int argc, char **argv) {
     if (err < 0) die("git_remote_fetch", err);
 
     printf("From %s\n", git_remote_url(remote));
+    phase_report();
 
     git_remote_free(remote);
     git_repository_free(repo);
@@ -473,8 +560,11 @@ static int cmd_pull(int argc, char **argv) {
         /* Checkout the new HEAD */
         git_checkout_options checkout_opts = GIT_CHECKOUT_OPTIONS_INIT;
         checkout_opts.checkout_strategy = GIT_CHECKOUT_FORCE;
+        if (show_progress)
+            checkout_opts.progress_cb = checkout_progress;
         err = git_checkout_head(repo, &checkout_opts);
         if (err < 0) die("git_checkout_head", err);
+        sync_workdir(repo);
 
         char oid_str[GIT_OID_SHA1_HEXSIZE + 1];
         git_oid_tostr(oid_str, sizeof(oid_str), &fetch_head_oid);
@@ -486,6 +576,7 @@ static int cmd_pull(int argc, char **argv) {
         fprintf(stderr, "error: non-fast-forward merge not supported\n");
         fprintf(stderr, "hint: commit your changes first, or use fast-forward merges\n");
     }
+    phase_report();
 
     git_annotated_commit_free(fetch_commit);
     git_remote_free(remote);
@@ -661,6 +752,8 @@ static void usage(void) {
     fprintf(stderr, "  pull       Fetch and merge from a remote\n");
     fprintf(stderr, "  push       Update remote refs\n");
     fprintf(stderr, "  config     Get and set repository or global options\n");
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  --progress Show per-phase progress and timings (clone, fetch, pull)\n");
 }
 
 int main(int argc, char **argv) {
@@ -686,6 +779,26 @@ int main(int argc, char **argv) {
     git_libgit2_opts(GIT_OPT_SET_SEARCH_PATH, GIT_CONFIG_LEVEL_GLOBAL, "/Users");
     git_libgit2_opts(GIT_OPT_SET_SEARCH_PATH, GIT_CONFIG_LEVEL_XDG, "/Users/.config");
 
+    /* No fsync per written object: clone and pull sync once after checkout
+     * (sync_workdir). The delta-base cache size is set when libgit2 is built
+     * (GIT_PACK_CACHE_MEMORY_LIMIT in scripts/build_libgit2.sh). */
+    git_libgit2_opts(GIT_OPT_ENABLE_FSYNC_GITDIR, 0);
+
+    /* Global flags may appear anywhere: strip them before dispatch */
+    int out = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--progress") == 0)
+            show_progress = 1;
+        else
+            argv[out++] = argv[i];
+    }
+    argc = out;
+    if (argc < 2) {
+        usage();
+        git_libgit2_shutdown();
+        return 1;
+    }
+
     const char *cmd = argv[1];
     int ret;
 
@@ -0,0 +1,174 @@
+//! Literal substring search.
+//!
+//! Candidates are filtered 16 positions at a time by comparing the first
+//! and last needle bytes (SSE2 on x86_64), so only positions where both
+//! agree are verified byte by byte.  Other architectures and block tails
+//! use Horspool.  With `-i` both sides are compared ASCII-folded without
+//! copying the haystack.
+
+/// A compiled literal pattern.
+#[derive(Clone)]
+pub struct Finder {
+    /// The needle, lowercased when ignoring case.
+    needle: alloc::vec::Vec<u8>,
+    ignore_case: bool,
+    /// Horspool shift per (folded) haystack byte.
+    shift: [u32; 256],
+}
+
+impl Finder {
+    pub fn new(needle: &[u8], ignore_case: bool) -> Finder {
+        let needle: alloc::vec::Vec<u8> = if ignore_case {
+            needle.iter().map(|b| b.to_ascii_lowercase()).collect()
+        } else {
+            needle.into()
+        };
+        let m = needle.len();
+        let mut shift = [m.max(1) as u32; 256];
+        for (i, &b) in needle.iter().enumerate().take(m.saturating_sub(1)) {
+            let s = (m - 1 - i) as u32;
+            shift[b as usize] = s;
+            if ignore_case {
+                shift[b.to_ascii_uppercase() as usize] = s;
+            }
+        }
+        Finder { needle, ignore_case, shift }
+    }
+
+    pub fn len(&self) -> usize {
+        self.needle.len()
+    }
+
+    /// Offset of the first occurrence in `hay`.
+    pub fn find(&self, hay: &[u8]) -> Option<usize> {
+        let m = self.needle.len();
+        if m == 0 {
+            return Some(0);
+        }
+        if m > hay.len() {
+            return None;
+        }
+        #[cfg(target_arch = "x86_64")]
+        {
+            let (hit, done) = unsafe { self.find_sse2(hay) };
+            if hit.is_some() {
+                return hit;
+            }
+            return self.horspool(hay, done).map(|p| p + done);
+        }
+        #[cfg(not(target_arch = "x86_64"))]
+        self.horspool(hay, 0)
+    }
+
+    /// Whether the needle occurs at `hay[at..]` (bounds already checked).
+    #[inline(always)]
+    fn verify(&self, hay: &[u8], at: usize) -> bool {
+        let cand = &hay[at..at + self.needle.len()];
+        if self.ignore_case {
+            cand.iter().zip(&self.needle).all(|(&h, &n)| h.to_ascii_lowercase() == n)
+        } else {
+            cand == &self.needle[..]
+        }
+    }
+
+    /// Horspool search of `hay[from..]`; the result is relative to `from`.
+    fn horspool(&self, hay: &[u8], from: usize) -> Option<usize> {
+        let m = self.needle.len();
+        let mut i = from;
+        while i + m <= hay.len() {
+            if self.verify(hay, i) {
+                return Some(i - from);
+            }
+            i += self.shift[hay[i + m - 1] as usize] as usize;
+        }
+        None
+    }
+
+    /// SSE2 first/last-byte filter.  Returns a hit, or how far it got
+    /// (every start before that offset has been ruled out).
+    #[cfg(target_arch = "x86_64")]
+    unsafe fn find_sse2(&self, hay: &[u8]) -> (Option<usize>, usize) {
+        use core::arch::x86_64::*;
+        let m = self.needle.len();
+        let first = self.needle[0];
+        let last = self.needle[m - 1];
+        let first_v = _mm_set1_epi8(first as i8);
+        let last_v = _mm_set1_epi8(last as i8);
+        // Letters compare as (x | 0x20) == lowercase when folding.
+        let or_first = _mm_set1_epi8(if self.ignore_case && first.is_ascii_lowercase() { 0x20 } else { 0 });
+        let or_last = _mm_set1_epi8(if self.ignore_case && last.is_ascii_lowercase() { 0x20 } else { 0 });
+
+        let p = hay.as_ptr();
+        let mut i = 0;
+        while i + m - 1 + 16 <= hay.len() {
+            let a = _mm_or_si128(_mm_loadu_si128(p.add(i) as *const __m128i), or_first);
+            let b = _mm_or_si128(_mm_loadu_si128(p.add(i + m - 1) as *const __m128i), or_last);
+            let eq = _mm_and_si128(_mm_cmpeq_epi8(a, first_v), _mm_cmpeq_epi8(b, last_v));
+            let mut mask = _mm_movemask_epi8(eq) as u32;
+            while mask != 0 {
+                let bit = mask.trailing_zeros() as usize;
+                if self.verify(hay, i + bit) {
+                    return (Some(i + bit), i);
+                }
+                mask &= mask - 1;
+            }
+            i += 16;
+        }
+        (None, i)
+    }
+}
+
+/// Offset of the first `byte` in `hay`.
+pub fn find_byte(hay: &[u8], byte: u8) -> Option<usize> {
+    let mut i = 0;
+    #[cfg(target_arch = "x86_64")]
+    unsafe {
+        use core::arch::x86_64::*;
+        let v = _mm_set1_epi8(byte as i8);
+        while i + 16 <= hay.len() {
+            let x = _mm_loadu_si128(hay.as_ptr().add(i) as *const __m128i);
+            let mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v)) as u32;
+            if mask != 0 {
+                return Some(i + mask.trailing_zeros() as usize);
+            }
+            i += 16;
+        }
+    }
+    hay[i..].iter().position(|&b| b == byte).map(|p| p + i)
+}
+
+/// Offset of the last `byte` in `hay`.
+pub fn rfind_byte(hay: &[u8], byte: u8) -> Option<usize> {
+    let mut end = hay.len();
+    #[cfg(target_arch = "x86_64")]
+    unsafe {
+        use core::arch::x86_64::*;
+        let v = _mm_set1_epi8(byte as i8);
+        while end >= 16 {
+            let x = _mm_loadu_si128(hay.as_ptr().add(end - 16) as *const __m128i);
+            let mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v)) as u32;
+            if mask != 0 {
+                return Some(end - 16 + 31 - mask.leading_zeros() as usize);
+            }
+            end -= 16;
+        }
+    }
+    hay[..end].iter().rposition(|&b| b == byte)
+}
+
+/// Number of `byte`s in `hay`.
+pub fn count_byte(hay: &[u8], byte: u8) -> usize {
+    let mut n = 0;
+    let mut i = 0;
+    #[cfg(target_arch = "x86_64")]
+    unsafe {
+        use core::arch::x86_64::*;
+        let v = _mm_set1_epi8(byte as i8);
+        while i + 16 <= hay.len() {
+            let x = _mm_loadu_si128(hay.as_ptr().add(i) as *const __m128i);
+            n += (_mm_movemask_epi8(_mm_cmpeq_epi8(x, v)) as u32).count_ones() as usize;
+            i += 16;
+        }
+    }
+    n + hay[i..].iter().filter(|&&b| b == byte).count()
+}
@@ -1,147 +1,476 @@
+//! grep — print lines matching a pattern.
+//!
+//! Input is read in large blocks and searched a block at a time: literal
+//! patterns are located directly in the block (`literal`), and only the
+//! lines around a hit are split out. `-E` patterns run through a lazily
+//! built DFA (`regex`). With `-r` files are searched by a pool of worker
+//! threads; output is still printed in file order.
+//!
+//! Usage: grep [-ivnclwErFh] PATTERN [FILE|DIR...]
+
 #![no_std]
 #![no_main]
 
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::fs;
+use anyos_std::sync::{Condvar, Mutex};
+
+mod literal;
+mod regex;
+
 anyos_std::entry!(main);
 
-fn to_lower(b: u8) -> u8 {
-    if b >= b'A' && b <= b'Z' { b + 32 } else { b }
+/// Bytes read per block.
+const BLOCK_SIZE: usize = 256 * 1024;
+/// Output is flushed once this much is buffered.
+const OUT_FLUSH: usize = 64 * 1024;
+/// Upper bound on worker threads for `-r`.
+const MAX_WORKERS: usize = 8;
+/// Worker stack size (per-file state lives on the heap).
+const WORKER_STACK: usize = 128 * 1024;
+
+#[derive(Clone, Copy)]
+struct Options {
+    invert: bool,
+    show_num: bool,
+    count_only: bool,
+    list_only: bool,
+    whole_word: bool,
+    ignore_case: bool,
 }
 
-fn find_needle(haystack: &[u8], needle: &[u8], ignore_case: bool) -> Option<usize> {
-    if needle.is_empty() { return Some(0); }
-    if needle.len() > haystack.len() { return None; }
-    for i in 0..=haystack.len() - needle.len() {
-        let mut ok = true;
-        for j in 0..needle.len() {
-            let a = if ignore_case { to_lower(haystack[i + j]) } else { haystack[i + j] };
-            let b = if ignore_case { to_lower(needle[j]) } else { needle[j] };
-            if a != b { ok = false; break; }
-        }
-        if ok { return Some(i); }
-    }
-    None
+#[derive(Clone)]
+enum Matcher {
+    Literal(literal::Finder),
+    Regex(regex::Regex),
 }
 
 fn is_word_char(b: u8) -> bool {
     (b >= b'a' && b <= b'z') || (b >= b'A' && b <= b'Z') || (b >= b'0' && b <= b'9') || b == b'_'
 }
 
-fn matches_line(line: &[u8], needle: &[u8], ignore_case: bool, whole_word: bool) -> bool {
-    if !whole_word {
-        return find_needle(line, needle, ignore_case).is_some();
+impl Matcher {
+    /// Whether `line` (without its newline) matches, ignoring `-v`.
+    fn line_matches(&mut self, line: &[u8], whole_word: bool) -> bool {
+        match self {
+            Matcher::Regex(re) => re.is_match(line),
+            Matcher::Literal(f) => find_literal(f, line, whole_word).is_some(),
+        }
     }
-    // Word boundary check
+}
+
+/// First occurrence of the literal in `hay`; with `-w` the first one that
+/// is not part of a longer word.
+fn find_literal(f: &literal::Finder, hay: &[u8], whole_word: bool) -> Option<usize> {
     let mut start = 0;
     loop {
-        match find_needle(&line[start..], needle, ignore_case) {
-            None => return false,
-            Some(pos) => {
-                let abs = start + pos;
-                let before_ok = abs == 0 || !is_word_char(line[abs - 1]);
-                let after_ok = abs + needle.len() >= line.len() || !is_word_char(line[abs + needle.len()]);
-                if before_ok && after_ok { return true; }
-                start = abs + 1;
-                if start + needle.len() > line.len() { return false; }
+        let abs = start + f.find(&hay[start..])?;
+        if !whole_word {
+            return Some(abs);
+        }
+        let end = abs + f.len();
+        let before_ok = abs == 0 || !is_word_char(hay[abs - 1]);
+        let after_ok = end >= hay.len() || !is_word_char(hay[end]);
+        if before_ok && after_ok {
+            return Some(abs);
+        }
+        start = abs + 1;
+        if start + f.len() > hay.len() {
+            return None;
+        }
+    }
+}
+
+/// Per-file search state: line counting and the output buffer.
+struct Search<'a> {
+    matcher: &'a mut Matcher,
+    opts: Options,
+    prefix: &'a str,
+    out: &'a mut Vec<u8>,
+    /// Number (1-based) of the next line to be processed.
+    line_no: u64,
+    matches: u64,
+    /// `-l`: stop at the first match.
+    done: bool,
+}
+
+impl<'a> Search<'a> {
+    /// Process `block`, which holds complete lines (the last one may lack
+    /// its newline only at end of input).
+    fn block(&mut self, block: &[u8]) {
+        if self.done {
+            return;
+        }
+        let direct = !self.opts.invert;
+        match &*self.matcher {
+            Matcher::Literal(f) if direct => {
+                let f = f.clone();
+                self.literal_block(&f, block)
+            }
+            _ => self.line_block(block),
+        }
+    }
+
+    /// Find the literal anywhere in the block, then cut out its line.
+    fn literal_block(&mut self, f: &literal::Finder, block: &[u8]) {
+        let mut pos = 0;
+        while pos < block.len() && !self.done {
+            let hit = match find_literal(f, &block[pos..], self.opts.whole_word) {
+                Some(h) => pos + h,
+                None => break,
+            };
+            let line_start = literal::rfind_byte(&block[pos..hit], b'\n').map_or(pos, |p| pos + p + 1);
+            let line_end = literal::find_byte(&block[hit..], b'\n').map_or(block.len(), |p| hit + p);
+            let line = &block[line_start..line_end];
+            self.line_no += literal::count_byte(&block[pos..line_start], b'\n') as u64;
+            self.hit(line);
+            self.line_no += 1;
+            pos = line_end + 1;
+        }
+        if !self.done && pos < block.len() {
+            self.line_no += literal::count_byte(&block[pos..], b'\n') as u64;
+            if block.last() != Some(&b'\n') {
+                self.line_no += 1;
             }
         }
     }
+
+    fn line_block(&mut self, block: &[u8]) {
+        let mut pos = 0;
+        while pos < block.len() && !self.done {
+            let end = literal::find_byte(&block[pos..], b'\n').map_or(block.len(), |p| pos + p);
+            let line = &block[pos..end];
+            if self.matcher.line_matches(line, self.opts.whole_word) != self.opts.invert {
+                self.hit(line);
+            }
+            self.line_no += 1;
+            pos = end + 1;
+        }
+    }
+
+    fn hit(&mut self, line: &[u8]) {
+        self.matches += 1;
+        if self.opts.list_only {
+            self.done = true;
+            return;
+        }
+        if self.opts.count_only {
+            return;
+        }
+        if !self.prefix.is_empty() {
+            self.out.extend_from_slice(self.prefix.as_bytes());
+            self.out.push(b':');
+        }
+        if self.opts.show_num {
+            push_num(self.out, self.line_no);
+            self.out.push(b':');
+        }
+        self.out.extend_from_slice(line);
+        self.out.push(b'\n');
+    }
 }
 
-fn read_file(fd: u32) -> anyos_std::Vec<u8> {
-    let mut file_buf = anyos_std::vec![0u8; 64 * 1024];
-    let mut total: usize = 0;
-    let mut read_buf = [0u8; 512];
+fn push_num(out: &mut Vec<u8>, mut n: u64) {
+    let mut digits = [0u8; 20];
+    let mut i = digits.len();
     loop {
-        let n = anyos_std::fs::read(fd, &mut read_buf);
-        if n == 0 || n == u32::MAX { break; }
-        let n = n as usize;
-        if total + n > file_buf.len() { break; }
-        file_buf[total..total + n].copy_from_slice(&read_buf[..n]);
-        total += n;
-    }
-    file_buf.truncate(total);
-    file_buf
-}
-
-fn grep_data(data: &[u8], needle: &[u8], ignore_case: bool, invert: bool,
-             show_num: bool, count_only: bool, list_only: bool, whole_word: bool,
-             prefix: &str) -> bool {
-    let mut match_count: u32 = 0;
-    let mut line_no: u32 = 0;
-
-    for line in data.split(|&b| b == b'\n') {
-        line_no += 1;
-        let mut hit = matches_line(line, needle, ignore_case, whole_word);
-        if invert { hit = !hit; }
-        if hit {
-            match_count += 1;
-            if !count_only && !list_only {
-                let s = core::str::from_utf8(line).unwrap_or("");
-                if !prefix.is_empty() && show_num {
-                    anyos_std::println!("{}:{}:{}", prefix, line_no, s);
-                } else if !prefix.is_empty() {
-                    anyos_std::println!("{}:{}", prefix, s);
-                } else if show_num {
-                    anyos_std::println!("{}:{}", line_no, s);
-                } else {
-                    anyos_std::println!("{}", s);
-                }
-            }
+        i -= 1;
+        digits[i] = b'0' + (n % 10) as u8;
+        n /= 10;
+        if n == 0 {
+            break;
+        }
+    }
+    out.extend_from_slice(&digits[i..]);
+}
+
+/// Search the open file `fd`, appending output to `out`.  When `flush`
+/// is set, output is written to stdout as it accumulates.
+/// Returns the number of matching lines.
+fn grep_fd(fd: u32, matcher: &mut Matcher, opts: Options, prefix: &str,
+           out: &mut Vec<u8>, flush: bool) -> u64 {
+    let mut buf: Vec<u8> = Vec::with_capacity(BLOCK_SIZE);
+    let mut search = Search { matcher, opts, prefix, out, line_no: 1, matches: 0, done: false };
+
+    loop {
+        // Top the buffer up to a full block after the carried partial line.
+        let filled = buf.len();
+        let want = if filled >= BLOCK_SIZE { filled * 2 } else { BLOCK_SIZE };
+        buf.resize(want, 0);
+        let n = fs::read(fd, &mut buf[filled..]);
+        let eof = n == 0 || n == u32::MAX;
+        let n = if eof { 0 } else { n as usize };
+        buf.truncate(filled + n);
+
+        if eof {
+            search.block(&buf);
+            break;
+        }
+        // Hand over complete lines; keep the tail for the next read.
+        if let Some(last_nl) = literal::rfind_byte(&buf[filled..], b'\n') {
+            let cut = filled + last_nl + 1;
+            search.block(&buf[..cut]);
+            buf.drain(..cut);
+        }
+        if search.done {
+            break;
+        }
+        if flush && search.out.len() >= OUT_FLUSH {
+            write_out(search.out);
         }
     }
 
-    if count_only {
+    let matches = search.matches;
+    if opts.count_only {
         if !prefix.is_empty() {
-            anyos_std::println!("{}:{}", prefix, match_count);
-        } else {
-            anyos_std::println!("{}", match_count);
+            out.extend_from_slice(prefix.as_bytes());
+            out.push(b':');
+        }
+        push_num(out, matches);
+        out.push(b'\n');
+    }
+    if opts.list_only && matches > 0 {
+        out.extend_from_slice(prefix.as_bytes());
+        out.push(b'\n');
+    }
+    matches
+}
+
+fn write_out(out: &mut Vec<u8>) {
+    if !out.is_empty() {
+        fs::write(1, out);
+        out.clear();
+    }
+}
+
+/// Collect regular files under `path` (recursively for directories).
+fn collect_files(path: &str, out: &mut Vec<String>) {
+    let mut st = [0u32; 7];
+    if fs::stat(path, &mut st) != 0 {
+        anyos_std::println!("grep: {}: No such file or directory", path);
+        return;
+    }
+    if st[0] != 1 {
+        out.push(String::from(path));
+        return;
+    }
+    let entries = match fs::read_dir(path) {
+        Ok(e) => e,
+        Err(_) => {
+            anyos_std::println!("grep: {}: cannot read directory", path);
+            return;
+        }
+    };
+    let base = path.trim_end_matches('/');
+    for entry in entries {
+        if entry.name == "." || entry.name == ".." {
+            continue;
+        }
+        let child = anyos_std::format!("{}/{}", base, entry.name);
+        if entry.is_dir() {
+            collect_files(&child, out);
+        } else if entry.file_type == 0 {
+            out.push(child);
         }
     }
-    match_count > 0
 }
 
-fn main() {
+// ── Parallel file search ────────────────────────────────────────────────
+
+/// Work shared with the worker threads (`Thread::spawn` takes `fn()`).
+struct Pool {
+    files: Vec<String>,
+    next: usize,
+    matcher: Option<Matcher>,
+    opts: Option<Options>,
+    prefix: bool,
+    /// Output and match count of each finished file, in file order.
+    results: Vec<Option<(Vec<u8>, u64)>>,
+}
+
+static POOL: Mutex<Pool> = Mutex::new(Pool {
+    files: Vec::new(),
+    next: 0,
+    matcher: None,
+    opts: None,
+    prefix: false,
+    results: Vec::new(),
+});
+static POOL_DONE: Condvar = Condvar::new();
+
+fn worker() {
+    let (mut matcher, opts, prefix) = {
+        let pool = POOL.lock();
+        match (&pool.matcher, pool.opts) {
+            (Some(m), Some(o)) => (m.clone(), o, pool.prefix),
+            _ => return,
+        }
+    };
+    loop {
+        let (i, path) = {
+            let mut pool = POOL.lock();
+            if pool.next >= pool.files.len() {
+                return;
+            }
+            pool.next += 1;
+            (pool.next - 1, pool.files[pool.next - 1].clone())
+        };
+        let (out, matches) = grep_path(&path, &mut matcher, opts, prefix);
+        POOL.lock().results[i] = Some((out, matches));
+        POOL_DONE.notify_all();
+    }
+}
+
+/// Search one file into a fresh output buffer.
+fn grep_path(path: &str, matcher: &mut Matcher, opts: Options, prefix: bool) -> (Vec<u8>, u64) {
+    let mut out = Vec::new();
+    let fd = fs::open(path, 0);
+    if fd == u32::MAX {
+        out.extend_from_slice(b"grep: ");
+        out.extend_from_slice(path.as_bytes());
+        out.extend_from_slice(b": No such file or directory\n");
+        return (out, 0);
+    }
+    let shown = if prefix || opts.list_only { path } else { "" };
+    let matches = grep_fd(fd, matcher, opts, shown, &mut out, false);
+    fs::close(fd);
+    (out, matches)
+}
+
+fn cpu_count() -> usize {
+    let mut cpu_buf = [0u8; 4];
+    if anyos_std::sys::sysinfo(2, &mut cpu_buf) == 0 {
+        u32::from_le_bytes(cpu_buf).max(1) as usize
+    } else {
+        1
+    }
+}
+
+/// Search `files` with worker threads, printing results in order.
+/// Returns the total number of matching lines.
+fn grep_parallel(files: Vec<String>, matcher: Matcher, opts: Options, prefix: bool,
+                 workers: usize) -> u64 {
+    let count = files.len();
+    {
+        let mut pool = POOL.lock();
+        pool.results = (0..count).map(|_| None).collect();
+        pool.files = files;
+        pool.next = 0;
+        pool.matcher = Some(matcher);
+        pool.opts = Some(opts);
+        pool.prefix = prefix;
+    }
+    let threads: Vec<_> = (0..workers)
+        .filter_map(|_| anyos_std::process::Thread::spawn_with_stack(worker, WORKER_STACK, "grep").ok())
+        .collect();
+    if threads.is_empty() {
+        // No threads: do the work here.
+        worker();
+    }
+
+    let mut total = 0;
+    let mut printed = 0;
+    let mut pool = POOL.lock();
+    while printed < count {
+        match pool.results[printed].take() {
+            Some((mut out, matches)) => {
+                drop(pool);
+                write_out(&mut out);
+                total += matches;
+                printed += 1;
+                pool = POOL.lock();
+            }
+            None => pool = POOL_DONE.wait(pool),
+        }
+    }
+    drop(pool);
+    for t in threads {
+        t.join();
+    }
+    total
+}
+
+fn main() -> u32 {
     let mut args_buf = [0u8; 256];
     let raw = anyos_std::process::args(&mut args_buf);
     let args = anyos_std::args::parse(raw, b"");
 
-    let ignore_case = args.has(b'i');
-    let invert = args.has(b'v');
-    let show_num = args.has(b'n');
-    let count_only = args.has(b'c');
-    let list_only = args.has(b'l');
-    let whole_word = args.has(b'w');
+    let opts = Options {
+        invert: args.has(b'v'),
+        show_num: args.has(b'n'),
+        count_only: args.has(b'c'),
+        list_only: args.has(b'l'),
+        whole_word: args.has(b'w'),
+        ignore_case: args.has(b'i'),
+    };
+    let extended = args.has(b'E');
+    let recursive = args.has(b'r');
+    let no_prefix = args.has(b'h');
 
     if args.pos_count == 0 {
-        anyos_std::println!("Usage: grep [-ivnclw] PATTERN [FILE...]");
-        return;
+        anyos_std::println!("Usage: grep [-ivnclwErFh] PATTERN [FILE|DIR...]");
+        return 2;
     }
 
     let pattern = args.positional[0];
-    let needle = pattern.as_bytes();
-    let multi = args.pos_count > 2;
+    let mut matcher = if extended {
+        let src = if opts.whole_word {
+            anyos_std::format!("(^|[^[:alnum:]_])({})([^[:alnum:]_]|$)", pattern)
+        } else {
+            String::from(pattern)
+        };
+        match regex::Regex::new(&src, opts.ignore_case) {
+            Ok(re) => Matcher::Regex(re),
+            Err(e) => {
+                anyos_std::println!("grep: {}", e);
+                return 2;
+            }
+        }
+    } else {
+        Matcher::Literal(literal::Finder::new(pattern.as_bytes(), opts.ignore_case))
+    };
 
-    if args.pos_count == 1 {
+    let mut out: Vec<u8> = Vec::with_capacity(OUT_FLUSH * 2);
+    if args.pos_count == 1 && !recursive {
         // Read from stdin
-        let data = read_file(0);
-        grep_data(&data, needle, ignore_case, invert, show_num, count_only, list_only, whole_word, "");
-        return;
+        let matches = grep_fd(0, &mut matcher, opts, "", &mut out, true);
+        write_out(&mut out);
+        return if matches > 0 { 0 } else { 1 };
     }
 
+    let mut files: Vec<String> = Vec::new();
+    if args.pos_count == 1 {
+        collect_files(".", &mut files);
+    }
     for i in 1..args.pos_count {
         let path = args.positional[i];
-        let fd = anyos_std::fs::open(path, 0);
-        if fd == u32::MAX {
-            anyos_std::println!("grep: {}: No such file or directory", path);
-            continue;
+        if recursive {
+            collect_files(path, &mut files);
+        } else {
+            files.push(String::from(path));
         }
-        let data = read_file(fd);
-        anyos_std::fs::close(fd);
+    }
+    let prefix = !no_prefix && (files.len() > 1 || recursive);
 
-        let prefix = if multi { path } else { "" };
-        let found = grep_data(&data, needle, ignore_case, invert, show_num, count_only, list_only, whole_word, prefix);
-        if list_only && found {
-            anyos_std::println!("{}", path);
+    let workers = cpu_count().min(MAX_WORKERS).min(files.len());
+    let total = if recursive && workers > 1 {
+        grep_parallel(files, matcher, opts, prefix, workers)
+    } else {
+        let mut total = 0;
+        for path in &files {
+            let fd = fs::open(path, 0);
+            if fd == u32::MAX {
+                write_out(&mut out);
+                anyos_std::println!("grep: {}: No such file or directory", path);
+                continue;
+            }
+            let shown = if prefix || opts.list_only { path.as_str() } else { "" };
+            total += grep_fd(fd, &mut matcher, opts, shown, &mut out, true);
+            fs::close(fd);
         }
-    }
+        write_out(&mut out);
+        total
+    };
+    if total > 0 { 0 } else { 1 }
 }
@@ -0,0 +1,583 @@
+//! Extended regular expressions (`grep -E`).
+//!
+//! The pattern is compiled to a Thompson NFA, which is run as a lazily
+//! built DFA: each DFA state is a set of NFA states, created the first
+//! time a line reaches it and cached with its 256 transitions, so a
+//! steady-state search costs one table lookup per byte.  If the cache
+//! grows past `MAX_STATES` it is flushed and rebuilt on demand.
+//!
+//! Supported syntax: literals, `.`, `[...]` (ranges, negation, POSIX
+//! classes such as `[:alpha:]`), `^`, `$`, `(...)`, `|`, `*`, `+`, `?`,
+//! `{n}`, `{n,}`, `{n,m}`, and the escapes `\w \W \d \D \s \S` plus `\`
+//! before any other character to quote it.  Matching is per line: the
+//! search only answers whether a line contains a match.
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+use anyos_std::HashMap;
+
+/// Upper bound on compiled program size (bounded repeats expand).
+const MAX_INSTS: usize = 20_000;
+/// Cached DFA states before the cache is flushed.
+const MAX_STATES: usize = 1024;
+/// Transition not computed yet.
+const UNKNOWN: u32 = u32::MAX;
+
+/// A set of bytes.
+#[derive(Clone, Copy, PartialEq, Eq)]
+struct ByteSet([u32; 8]);
+
+impl ByteSet {
+    const fn empty() -> ByteSet {
+        ByteSet([0; 8])
+    }
+    fn add(&mut self, b: u8) {
+        self.0[(b >> 5) as usize] |= 1 << (b & 31);
+    }
+    fn add_range(&mut self, lo: u8, hi: u8) {
+        for b in lo..=hi {
+            self.add(b);
+        }
+    }
+    fn has(&self, b: u8) -> bool {
+        self.0[(b >> 5) as usize] & (1 << (b & 31)) != 0
+    }
+    fn negate(&mut self) {
+        for w in self.0.iter_mut() {
+            *w = !*w;
+        }
+    }
+    fn union(&mut self, other: &ByteSet) {
+        for (a, b) in self.0.iter_mut().zip(other.0.iter()) {
+            *a |= *b;
+        }
+    }
+    /// Add the other case of every ASCII letter.
+    fn fold_case(&mut self) {
+        for b in b'a'..=b'z' {
+            if self.has(b) || self.has(b - 32) {
+                self.add(b);
+                self.add(b - 32);
+            }
+        }
+    }
+}
+
+enum Node {
+    Set(ByteSet),
+    Empty,
+    Bol,
+    Eol,
+    Concat(Vec<Node>),
+    Alt(Vec<Node>),
+    Repeat(Box<Node>, u32, Option<u32>),
+}
+
+#[derive(Clone, Copy)]
+enum Inst {
+    /// Consume a byte in `sets[n]`.
+    Set(u32),
+    Split(u32, u32),
+    Jmp(u32),
+    Bol,
+    Eol,
+    Match,
+}
+
+#[derive(Clone)]
+struct State {
+    /// NFA positions (Set, Eol and Match instructions), sorted.
+    insts: Vec<u32>,
+    /// Contains Match: the line matches.
+    matched: bool,
+    /// A match completes if the line ends here.
+    matched_at_eol: bool,
+    next: Box<[u32; 256]>,
+}
+
+/// A compiled pattern with its DFA cache.
+#[derive(Clone)]
+pub struct Regex {
+    prog: Vec<Inst>,
+    sets: Vec<ByteSet>,
+    states: Vec<State>,
+    ids: HashMap<(Vec<u32>, bool), u32>,
+    /// DFA state at the start of a line.
+    start: u32,
+    /// NFA closure of the program start away from the line start, merged
+    /// into every state to find matches at any offset.
+    restart: Vec<u32>,
+    // Scratch for closures.
+    stack: Vec<u32>,
+    mark: Vec<u32>,
+    generation: u32,
+}
+
+impl Regex {
+    pub fn new(pattern: &str, ignore_case: bool) -> Result<Regex, String> {
+        let mut parser = Parser { pat: pattern.as_bytes(), pos: 0, ignore_case };
+        let node = parser.parse_alt()?;
+        if parser.pos < parser.pat.len() {
+            return Err(String::from("unmatched )"));
+        }
+        let mut c = Compiler { prog: Vec::new(), sets: Vec::new() };
+        c.emit_node(&node)?;
+        c.push(Inst::Match)?;
+
+        let n = c.prog.len();
+        let mut re = Regex {
+            prog: c.prog,
+            sets: c.sets,
+            states: Vec::new(),
+            ids: HashMap::new(),
+            start: 0,
+            restart: Vec::new(),
+            stack: Vec::new(),
+            mark: vec![0; n],
+            generation: 0,
+        };
+        re.reset_cache();
+        Ok(re)
+    }
+
+    /// Whether `line` (without its newline) contains a match.
+    pub fn is_match(&mut self, line: &[u8]) -> bool {
+        let mut s = self.start;
+        for &b in line {
+            if self.states[s as usize].matched {
+                return true;
+            }
+            let t = self.states[s as usize].next[b as usize];
+            s = if t != UNKNOWN { t } else { self.step(s, b) };
+        }
+        let st = &self.states[s as usize];
+        st.matched || st.matched_at_eol
+    }
+
+    fn reset_cache(&mut self) {
+        self.states.clear();
+        self.ids.clear();
+        let mut restart = Vec::new();
+        self.closure(&[0], false, false, &mut restart);
+        self.restart = restart;
+        let mut start = Vec::new();
+        self.closure(&[0], true, false, &mut start);
+        self.start = self.intern(start, true);
+    }
+
+    /// Compute and cache the transition of state `s` on byte `b`.
+    fn step(&mut self, s: u32, b: u8) -> u32 {
+        let mut targets: Vec<u32> = Vec::new();
+        for &pc in &self.states[s as usize].insts {
+            if let Inst::Set(i) = self.prog[pc as usize] {
+                if self.sets[i as usize].has(b) {
+                    targets.push(pc + 1);
+                }
+            }
+        }
+        let mut set = Vec::new();
+        self.closure(&targets, false, false, &mut set);
+        self.merge_restart(&mut set);
+
+        if self.states.len() >= MAX_STATES {
+            // Flush; the caller continues from the new state, which does
+            // not depend on anything that was cached.
+            self.reset_cache();
+            return self.intern(set, false);
+        }
+        let t = self.intern(set, false);
+        self.states[s as usize].next[b as usize] = t;
+        t
+    }
+
+    fn merge_restart(&self, set: &mut Vec<u32>) {
+        set.extend_from_slice(&self.restart);
+        set.sort_unstable();
+        set.dedup();
+    }
+
+    /// DFA state for an NFA position set (sorted), creating it if needed.
+    fn intern(&mut self, insts: Vec<u32>, bol: bool) -> u32 {
+        let key = (insts, bol);
+        if let Some(&id) = self.ids.get(&key) {
+            return id;
+        }
+        let insts = key.0.clone();
+        let matched = insts.iter().any(|&pc| matches!(self.prog[pc as usize], Inst::Match));
+        let eol: Vec<u32> = insts.iter().copied()
+            .filter(|&pc| matches!(self.prog[pc as usize], Inst::Eol))
+            .collect();
+        let mut after_eol = Vec::new();
+        self.closure(&eol, bol, true, &mut after_eol);
+        let matched_at_eol = after_eol.iter().any(|&pc| matches!(self.prog[pc as usize], Inst::Match));
+
+        let id = self.states.len() as u32;
+        self.states.push(State { insts, matched, matched_at_eol, next: Box::new([UNKNOWN; 256]) });
+        self.ids.insert(key, id);
+        id
+    }
+
+    /// Follow empty transitions from `from`.  `Bol`/`Eol` pass when the
+    /// position is at the start/end of the line; otherwise `Eol` stays in
+    /// the set (resolved by `matched_at_eol`) and `Bol` dies.
+    fn closure(&mut self, from: &[u32], at_bol: bool, at_eol: bool, out: &mut Vec<u32>) {
+        self.generation = self.generation.wrapping_add(1);
+        if self.generation == 0 {
+            self.mark.iter_mut().for_each(|m| *m = 0);
+            self.generation = 1;
+        }
+        let gen = self.generation;
+        self.stack.clear();
+        self.stack.extend(from.iter().rev());
+        while let Some(pc) = self.stack.pop() {
+            if self.mark[pc as usize] == gen {
+                continue;
+            }
+            self.mark[pc as usize] = gen;
+            match self.prog[pc as usize] {
+                Inst::Set(_) | Inst::Match => out.push(pc),
+                Inst::Jmp(t) => self.stack.push(t),
+                Inst::Split(a, b) => {
+                    self.stack.push(b);
+                    self.stack.push(a);
+                }
+                Inst::Bol => {
+                    if at_bol {
+                        self.stack.push(pc + 1);
+                    }
+                }
+                Inst::Eol => {
+                    if at_eol {
+                        self.stack.push(pc + 1);
+                    } else {
+                        out.push(pc);
+                    }
+                }
+            }
+        }
+        out.sort_unstable();
+    }
+}
+
+// ── Compiler ────────────────────────────────────────────────────────────
+
+struct Compiler {
+    prog: Vec<Inst>,
+    sets: Vec<ByteSet>,
+}
+
+impl Compiler {
+    fn push(&mut self, inst: Inst) -> Result<u32, String> {
+        if self.prog.len() >= MAX_INSTS {
+            return Err(String::from("pattern too large"));
+        }
+        self.prog.push(inst);
+        Ok(self.prog.len() as u32 - 1)
+    }
+
+    fn pc(&self) -> u32 {
+        self.prog.len() as u32
+    }
+
+    fn emit_node(&mut self, node: &Node) -> Result<(), String> {
+        match node {
+            Node::Empty => {}
+            Node::Bol => { self.push(Inst::Bol)?; }
+            Node::Eol => { self.push(Inst::Eol)?; }
+            Node::Set(set) => {
+                let i = match self.sets.iter().position(|s| s == set) {
+                    Some(i) => i,
+                    None => {
+                        self.sets.push(*set);
+                        self.sets.len() - 1
+                    }
+                };
+                self.push(Inst::Set(i as u32))?;
+            }
+            Node::Concat(nodes) => {
+                for n in nodes {
+                    self.emit_node(n)?;
+                }
+            }
+            Node::Alt(nodes) => {
+                // split L1, next; L1: a; jmp end; next: split L2, ...
+                let mut jumps = Vec::new();
+                for (i, n) in nodes.iter().enumerate() {
+                    if i + 1 < nodes.len() {
+                        let split = self.push(Inst::Split(0, 0))?;
+                        self.emit_node(n)?;
+                        jumps.push(self.push(Inst::Jmp(0))?);
+                        let next = self.pc();
+                        self.prog[split as usize] = Inst::Split(split + 1, next);
+                    } else {
+                        self.emit_node(n)?;
+                    }
+                }
+                let end = self.pc();
+                for j in jumps {
+                    self.prog[j as usize] = Inst::Jmp(end);
+                }
+            }
+            Node::Repeat(n, min, max) => {
+                for _ in 0..*min {
+                    self.emit_node(n)?;
+                }
+                match max {
+                    None => {
+                        // L: split body, end; body; jmp L
+                        let split = self.push(Inst::Split(0, 0))?;
+                        self.emit_node(n)?;
+                        self.push(Inst::Jmp(split))?;
+                        let end = self.pc();
+                        self.prog[split as usize] = Inst::Split(split + 1, end);
+                    }
+                    Some(max) => {
+                        // Nested optionals: (x(x(x)?)?)?
+                        let mut splits = Vec::new();
+                        for _ in *min..*max {
+                            splits.push(self.push(Inst::Split(0, 0))?);
+                            self.emit_node(n)?;
+                        }
+                        let end = self.pc();
+                        for s in splits {
+                            self.prog[s as usize] = Inst::Split(s + 1, end);
+                        }
+                    }
+                }
+            }
+        }
+        Ok(())
+    }
+}
+
+// ── Parser ──────────────────────────────────────────────────────────────
+
+struct Parser<'a> {
+    pat: &'a [u8],
+    pos: usize,
+    ignore_case: bool,
+}
+
+impl<'a> Parser<'a> {
+    fn peek(&self) -> Option<u8> {
+        self.pat.get(self.pos).copied()
+    }
+
+    fn parse_alt(&mut self) -> Result<Node, String> {
+        let mut alts = vec![self.parse_concat()?];
+        while self.peek() == Some(b'|') {
+            self.pos += 1;
+            alts.push(self.parse_concat()?);
+        }
+        Ok(if alts.len() == 1 { alts.pop().unwrap() } else { Node::Alt(alts) })
+    }
+
+    fn parse_concat(&mut self) -> Result<Node, String> {
+        let mut items = Vec::new();
+        while let Some(c) = self.peek() {
+            if c == b'|' || c == b')' {
+                break;
+            }
+            let atom = self.parse_atom()?;
+            items.push(self.parse_repeat(atom)?);
+        }
+        Ok(match items.len() {
+            0 => Node::Empty,
+            1 => items.pop().unwrap(),
+            _ => Node::Concat(items),
+        })
+    }
+
+    fn parse_repeat(&mut self, mut atom: Node) -> Result<Node, String> {
+        loop {
+            let (min, max) = match self.peek() {
+                Some(b'*') => { self.pos += 1; (0, None) }
+                Some(b'+') => { self.pos += 1; (1, None) }
+                Some(b'?') => { self.pos += 1; (0, Some(1)) }
+                Some(b'{') => match self.parse_bounds() {
+                    Some(b) => b,
+                    None => return Ok(atom), // literal '{'
+                },
+                _ => return Ok(atom),
+            };
+            if let Some(max) = max {
+                if max < min {
+                    return Err(String::from("invalid repeat bounds"));
+                }
+            }
+            if min > 1000 || max.map_or(false, |m| m > 1000) {
+                return Err(String::from("repeat count too large"));
+            }
+            atom = Node::Repeat(Box::new(atom), min, max);
+        }
+    }
+
+    /// `{n}`, `{n,}` or `{n,m}` at the current position.
+    fn parse_bounds(&mut self) -> Option<(u32, Option<u32>)> {
+        let save = self.pos;
+        self.pos += 1;
+        let min = self.parse_number();
+        let result = match (min, self.peek()) {
+            (Some(n), Some(b'}')) => Some((n, Some(n))),
+            (Some(n), Some(b',')) => {
+                self.pos += 1;
+                let max = self.parse_number();
+                if self.peek() == Some(b'}') { Some((n, max)) } else { None }
+            }
+            _ => None,
+        };
+        match result {
+            Some(r) => {
+                self.pos += 1;
+                Some(r)
+            }
+            None => {
+                self.pos = save;
+                None
+            }
+        }
+    }
+
+    fn parse_number(&mut self) -> Option<u32> {
+        let start = self.pos;
+        let mut n: u32 = 0;
+        while let Some(c @ b'0'..=b'9') = self.peek() {
+            n = n.saturating_mul(10).saturating_add((c - b'0') as u32);
+            self.pos += 1;
+        }
+        if self.pos > start { Some(n) } else { None }
+    }
+
+    fn parse_atom(&mut self) -> Result<Node, String> {
+        let c = self.peek().unwrap();
+        self.pos += 1;
+        match c {
+            b'(' => {
+                let inner = self.parse_alt()?;
+                if self.peek() != Some(b')') {
+                    return Err(String::from("unmatched ("));
+                }
+                self.pos += 1;
+                Ok(inner)
+            }
+            b'^' => Ok(Node::Bol),
+            b'$' => Ok(Node::Eol),
+            b'.' => {
+                let mut set = ByteSet::empty();
+                set.negate();
+                Ok(Node::Set(set))
+            }
+            b'[' => self.parse_bracket(),
+            b'*' | b'+' | b'?' => Err(String::from("repeat operator without operand")),
+            b'\\' => {
+                let e = self.peek().ok_or_else(|| String::from("trailing backslash"))?;
+                self.pos += 1;
+                let mut set = ByteSet::empty();
+                match e {
+                    b'w' | b'W' => add_class(&mut set, "word"),
+                    b'd' | b'D' => add_class(&mut set, "digit"),
+                    b's' | b'S' => add_class(&mut set, "space"),
+                    _ => {
+                        set.add(e);
+                        return Ok(self.literal_set(set));
+                    }
+                };
+                if e.is_ascii_uppercase() {
+                    set.negate();
+                }
+                Ok(Node::Set(set))
+            }
+            _ => {
+                let mut set = ByteSet::empty();
+                set.add(c);
+                Ok(self.literal_set(set))
+            }
+        }
+    }
+
+    fn literal_set(&self, mut set: ByteSet) -> Node {
+        if self.ignore_case {
+            set.fold_case();
+        }
+        Node::Set(set)
+    }
+
+    /// Bracket expression; the opening `[` is consumed.
+    fn parse_bracket(&mut self) -> Result<Node, String> {
+        let mut set = ByteSet::empty();
+        let negate = self.peek() == Some(b'^');
+        if negate {
+            self.pos += 1;
+        }
+        let mut first = true;
+        loop {
+            let c = self.peek().ok_or_else(|| String::from("unmatched ["))?;
+            self.pos += 1;
+            if c == b']' && !first {
+                break;
+            }
+            first = false;
+            if c == b'[' && self.peek() == Some(b':') {
+                let rest = &self.pat[self.pos + 1..];
+                let end = rest.windows(2).position(|w| w == b":]")
+                    .ok_or_else(|| String::from("unterminated character class"))?;
+                let name = core::str::from_utf8(&rest[..end]).unwrap_or("");
+                if !add_class(&mut set, name) {
+                    return Err(alloc::format!("unknown character class [:{}:]", name));
+                }
+                self.pos += 1 + end + 2;
+                continue;
+            }
+            let lo = c;
+            if self.peek() == Some(b'-') && self.pat.get(self.pos + 1).map_or(false, |&n| n != b']') {
+                let hi = self.pat[self.pos + 1];
+                self.pos += 2;
+                if hi < lo {
+                    return Err(String::from("invalid range in [...]"));
+                }
+                set.add_range(lo, hi);
+            } else {
+                set.add(lo);
+            }
+        }
+        if self.ignore_case {
+            set.fold_case();
+        }
+        if negate {
+            set.negate();
+        }
+        Ok(Node::Set(set))
+    }
+}
+
+/// Add a named class (`alpha`, `digit`, ... and `word`).
+fn add_class(set: &mut ByteSet, name: &str) -> bool {
+    let mut s = ByteSet::empty();
+    match name {
+        "alpha" => { s.add_range(b'a', b'z'); s.add_range(b'A', b'Z'); }
+        "digit" => s.add_range(b'0', b'9'),
+        "alnum" => { s.add_range(b'a', b'z'); s.add_range(b'A', b'Z'); s.add_range(b'0', b'9'); }
+        "word" => { s.add_range(b'a', b'z'); s.add_range(b'A', b'Z'); s.add_range(b'0', b'9'); s.add(b'_'); }
+        "upper" => s.add_range(b'A', b'Z'),
+        "lower" => s.add_range(b'a', b'z'),
+        "space" => { for &b in b" \t\n\r\x0b\x0c" { s.add(b); } }
+        "blank" => { s.add(b' '); s.add(b'\t'); }
+        "punct" => {
+            for b in 0x21..=0x7eu8 {
+                if !b.is_ascii_alphanumeric() {
+                    s.add(b);
+                }
+            }
+        }
+        "xdigit" => { s.add_range(b'0', b'9'); s.add_range(b'a', b'f'); s.add_range(b'A', b'F'); }
+        "cntrl" => { s.add_range(0, 0x1f); s.add(0x7f); }
+        "print" => s.add_range(0x20, 0x7e),
+        "graph" => s.add_range(0x21, 0x7e),
+        _ => return false,
+    }
+    set.union(&s);
+    true
+}
+
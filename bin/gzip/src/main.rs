@@ -3,14 +3,27 @@
 
 use alloc::format;
 use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+use anyos_std::fs;
+use libzip_client::{Format, Stream, DICT_SIZE, SEGMENT_SIZE};
 
 anyos_std::entry!(main);
 
+/// Read/write chunk of streamed decompression.
+const CHUNK: usize = 64 * 1024;
+/// Segments in flight per thread: keeps every core busy while the batch
+/// of compressed pieces stays small.
+const SEGMENTS_PER_THREAD: usize = 2;
+
 fn usage() {
-    anyos_std::println!("Usage: gzip [-d] [-k] file [file...]");
-    anyos_std::println!("       gunzip [-k] file [file...]");
+    anyos_std::println!("Usage: gzip [-d] [-k] [-c] [-p threads] [-1..-9] file [file...]");
+    anyos_std::println!("       gunzip [-k] [-c] file [file...]");
     anyos_std::println!("  -d  Decompress (same as gunzip)");
     anyos_std::println!("  -k  Keep original file");
+    anyos_std::println!("  -c  Write to standard output, keep original file");
+    anyos_std::println!("  -p  Compression threads (default: all CPUs)");
+    anyos_std::println!("  -1  Compress faster ... -9  Compress better (default -6)");
 }
 
 fn main() {
@@ -31,7 +44,7 @@ fn main() {
 
     let mut args_buf = [0u8; 256];
     let raw = anyos_std::process::args(&mut args_buf);
-    let args = anyos_std::args::parse(raw, b"");
+    let args = anyos_std::args::parse(raw, b"p");
 
     if args.pos_count < 1 {
         usage();
@@ -39,44 +52,196 @@ fn main() {
     }
 
     let decompress = is_gunzip || args.has(b'd');
-    let keep = args.has(b'k');
+    let to_stdout = args.has(b'c');
+    let keep = args.has(b'k') || to_stdout;
+    let level = (1..=9).rev().find(|&d| args.has(b'0' + d)).unwrap_or(6) as u32;
+    let threads = match args.opt_u32(b'p', 0) {
+        0 => anyos_std::pool::current_num_threads(),
+        n => n as usize,
+    };
 
     for i in 0..args.pos_count {
         let path = args.positional[i];
 
-        if decompress {
+        let out_path = if !decompress {
+            // Compress: file → file.gz
+            format!("{}.gz", path)
+        } else if path.ends_with(".gz") {
             // Decompress: file.gz → file
-            let out_path = if path.ends_with(".gz") {
-                String::from(&path[..path.len() - 3])
-            } else if path.ends_with(".tgz") {
-                let mut s = String::from(&path[..path.len() - 4]);
-                s.push_str(".tar");
-                s
-            } else {
-                anyos_std::println!("gzip: '{}': unknown suffix -- ignored", path);
-                continue;
-            };
+            String::from(&path[..path.len() - 3])
+        } else if path.ends_with(".tgz") {
+            let mut s = String::from(&path[..path.len() - 4]);
+            s.push_str(".tar");
+            s
+        } else {
+            anyos_std::println!("gzip: '{}': unknown suffix -- ignored", path);
+            continue;
+        };
 
-            if libzip_client::gzip_decompress_file(path, &out_path) {
-                anyos_std::println!("{} -> {}", path, out_path);
-                if !keep {
-                    anyos_std::fs::unlink(path);
+        let input = match fs::File::open(path) {
+            Ok(f) => f,
+            Err(_) => {
+                anyos_std::println!("gzip: '{}': cannot open", path);
+                continue;
+            }
+        };
+        let output = if to_stdout {
+            None
+        } else {
+            match fs::File::create(&out_path) {
+                Ok(f) => Some(f),
+                Err(_) => {
+                    anyos_std::println!("gzip: '{}': cannot create", out_path);
+                    continue;
                 }
-            } else {
-                anyos_std::println!("gzip: '{}': decompression failed", path);
             }
+        };
+        let out_fd = output.as_ref().map_or(1, |f| f.fd());
+
+        let ok = if decompress {
+            decompress_fd(input.fd(), out_fd)
         } else {
-            // Compress: file → file.gz
-            let out_path = format!("{}.gz", path);
+            compress_fd(input.fd(), out_fd, level, threads)
+        };
+        drop(input);
+        drop(output);
 
-            if libzip_client::gzip_compress_file(path, &out_path) {
+        if ok {
+            if !to_stdout {
                 anyos_std::println!("{} -> {}", path, out_path);
-                if !keep {
-                    anyos_std::fs::unlink(path);
-                }
-            } else {
-                anyos_std::println!("gzip: '{}': compression failed", path);
             }
+            if !keep {
+                fs::unlink(path);
+            }
+        } else {
+            if !to_stdout {
+                fs::unlink(&out_path);
+            }
+            let what = if decompress { "decompression" } else { "compression" };
+            anyos_std::println!("gzip: '{}': {} failed", path, what);
+        }
+    }
+}
+
+fn write_all(fd: u32, mut data: &[u8]) -> bool {
+    while !data.is_empty() {
+        let n = fs::write(fd, data);
+        if n == 0 || n == u32::MAX {
+            return false;
+        }
+        data = &data[n as usize..];
+    }
+    true
+}
+
+/// Read until `buf` is full or the input ends.  Returns the bytes read, or
+/// `None` on a read error.
+fn read_full(fd: u32, buf: &mut [u8]) -> Option<usize> {
+    let mut len = 0;
+    while len < buf.len() {
+        let n = fs::read(fd, &mut buf[len..]);
+        if n == u32::MAX {
+            return None;
+        }
+        if n == 0 {
+            break;
+        }
+        len += n as usize;
+    }
+    Some(len)
+}
+
+/// Compress to a single gzip member, pigz style: the input is cut into
+/// 128 KiB segments, each compressed on its own thread with the 32 KiB
+/// before it as history, and the pieces are written in order.
+fn compress_fd(in_fd: u32, out_fd: u32, level: u32, threads: usize) -> bool {
+    let header = [
+        0x1F, 0x8B, 8, 0, 0, 0, 0, 0,
+        match level { 9 => 2, 1 => 4, _ => 0 },
+        0xFF,
+    ];
+    if !write_all(out_fd, &header) {
+        return false;
+    }
+
+    let batch = threads.max(1) * SEGMENTS_PER_THREAD * SEGMENT_SIZE;
+    // History (the first `dict` bytes) followed by the batch's input
+    let mut buf = vec![0u8; DICT_SIZE + batch];
+    let mut dict = 0;
+    let mut crc = 0u32;
+    let mut total = 0u32;
+    loop {
+        let n = match read_full(in_fd, &mut buf[dict..dict + batch]) {
+            Some(n) => n,
+            None => return false,
+        };
+        let end = dict + n;
+        let eof = n < batch;
+        crc = libzip_client::crc32_update(crc, &buf[dict..end]);
+        total = total.wrapping_add(n as u32);
+
+        // An empty input still needs its final (empty) segment
+        let segments = n.div_ceil(SEGMENT_SIZE).max(eof as usize);
+        let mut pieces: Vec<Option<Vec<u8>>> = (0..segments).map(|_| None).collect();
+        let data = &buf[..end];
+        anyos_std::pool::par_chunks_mut(&mut pieces, 1, |i, piece| {
+            let start = dict + i * SEGMENT_SIZE;
+            let seg_end = (start + SEGMENT_SIZE).min(end);
+            let from = start - start.min(DICT_SIZE);
+            let last = eof && i == segments - 1;
+            piece[0] = libzip_client::deflate_segment(&data[from..seg_end], start - from, level, last);
+        });
+        for piece in &pieces {
+            match piece {
+                Some(p) if write_all(out_fd, p) => {}
+                _ => return false,
+            }
+        }
+
+        if eof {
+            break;
+        }
+        buf.copy_within(end - DICT_SIZE..end, 0);
+        dict = DICT_SIZE;
+    }
+
+    let mut trailer = [0u8; 8];
+    trailer[..4].copy_from_slice(&crc.to_le_bytes());
+    trailer[4..].copy_from_slice(&total.to_le_bytes());
+    write_all(out_fd, &trailer)
+}
+
+/// Decompress a gzip file in fixed-size chunks.
+fn decompress_fd(in_fd: u32, out_fd: u32) -> bool {
+    let mut stream = match Stream::inflate(Format::Gzip) {
+        Some(s) => s,
+        None => return false,
+    };
+    let mut input = vec![0u8; CHUNK];
+    let mut output = vec![0u8; CHUNK];
+    let (mut pos, mut len) = (0, 0);
+    let mut eof = false;
+    while !stream.is_done() {
+        if pos == len && !eof {
+            len = match read_full(in_fd, &mut input) {
+                Some(n) => n,
+                None => return false,
+            };
+            pos = 0;
+            eof = len < input.len();
+        }
+        let (consumed, produced) = match stream.process(&input[pos..len], eof, &mut output) {
+            Some(r) => r,
+            None => return false,
+        };
+        pos += consumed;
+        if !write_all(out_fd, &output[..produced]) {
+            return false;
+        }
+        if consumed == 0 && produced == 0 && pos == len && eof {
+            // Finished input but no end of stream
+            return false;
         }
     }
+    true
 }
@@ -5,7 +5,6 @@ anyos_std::entry!(main);
 
 const MAX_TASKS: usize = 64;
 const MAX_CPUS: usize = 16;
-const THREAD_ENTRY_SIZE: usize = 60;
 const REFRESH_MS: u32 = 2000;
 
 // ─── Terminal size ───────────────────────────────────────────────────────────
@@ -52,12 +51,6 @@ const BRIGHT_WHITE: &str = "\x1B[97m";
 
 // ─── Data Structures ─────────────────────────────────────────────────────────
 
-struct PrevTicks {
-    entries: [(u32, u32); MAX_TASKS],
-    count: usize,
-    prev_total: u32,
-}
-
 struct CpuState {
     num_cpus: u32,
     total_sched_ticks: u32,
@@ -87,7 +80,7 @@ impl CpuState {
 #[derive(Clone, Copy)]
 struct TaskEntry {
     tid: u32,
-    name: [u8; 24],
+    name: [u8; 32],
     name_len: usize,
     state: u8,
     priority: u8,
@@ -203,48 +196,25 @@ fn fetch_cpu(state: &mut CpuState) {
     }
 }
 
-/// Fetch thread list with per-thread CPU% delta.
-fn fetch_tasks(
-    raw: &mut [u8; THREAD_ENTRY_SIZE * MAX_TASKS],
-    prev: &mut PrevTicks,
-    total_sched_ticks: u32,
-    out: &mut [TaskEntry; MAX_TASKS],
-) -> usize {
-    let count = anyos_std::sys::sysinfo(1, raw);
-    if count == u32::MAX || count == 0 { return 0; }
-    let n = (count as usize).min(MAX_TASKS);
-    let dt = total_sched_ticks.wrapping_sub(prev.prev_total);
-
-    for i in 0..n {
-        let off = i * THREAD_ENTRY_SIZE;
-        let tid = u32::from_le_bytes([raw[off], raw[off+1], raw[off+2], raw[off+3]]);
-        let prio = raw[off + 4];
-        let state = raw[off + 5];
-        let mut name = [0u8; 24];
-        name.copy_from_slice(&raw[off + 8..off + 32]);
-        let name_len = name.iter().position(|&b| b == 0).unwrap_or(24);
-        let user_pages = u32::from_le_bytes([raw[off+32], raw[off+33], raw[off+34], raw[off+35]]);
-        let cpu_ticks = u32::from_le_bytes([raw[off+36], raw[off+37], raw[off+38], raw[off+39]]);
-        let uid = u16::from_le_bytes([raw[off + 56], raw[off + 57]]);
-
-        let prev_ticks = prev.entries[..prev.count]
-            .iter().find(|e| e.0 == tid).map(|e| e.1).unwrap_or(cpu_ticks);
-        let d_ticks = cpu_ticks.wrapping_sub(prev_ticks);
-        let cpu_pct_x10 = if dt > 0 && d_ticks > 0 {
-            (d_ticks as u64 * 1000 / dt as u64).min(1000) as u32
+/// Fetch thread list with per-thread CPU% delta (the kernel fills in the
+/// ticks since the previous snapshot kept in `snap`).
+fn fetch_tasks(snap: &mut anyos_std::sys::ThreadSnapshot, out: &mut [TaskEntry; MAX_TASKS]) -> usize {
+    if !snap.refresh() { return 0; }
+    let dt = snap.ticks_delta();
+    let threads = snap.threads();
+    let n = threads.len().min(MAX_TASKS);
+
+    for (i, t) in threads[..n].iter().enumerate() {
+        let name_len = t.name.iter().position(|&b| b == 0).unwrap_or(t.name.len());
+        let cpu_pct_x10 = if dt > 0 && t.tick_delta > 0 {
+            (t.tick_delta as u64 * 1000 / dt as u64).min(1000) as u32
         } else { 0 };
 
-        out[i] = TaskEntry { tid, name, name_len, state, priority: prio, uid, user_pages, cpu_pct_x10 };
-    }
-
-    prev.count = n;
-    for i in 0..n {
-        let off = i * THREAD_ENTRY_SIZE;
-        let tid = u32::from_le_bytes([raw[off], raw[off+1], raw[off+2], raw[off+3]]);
-        let cpu_ticks = u32::from_le_bytes([raw[off+36], raw[off+37], raw[off+38], raw[off+39]]);
-        prev.entries[i] = (tid, cpu_ticks);
+        out[i] = TaskEntry {
+            tid: t.tid, name: t.name, name_len, state: t.state, priority: t.priority,
+            uid: t.uid, user_pages: t.user_pages, cpu_pct_x10,
+        };
     }
-    prev.prev_total = total_sched_ticks;
     n
 }
 
@@ -299,12 +269,11 @@ fn print_bar(label: &str, pct: u32, color: &str, bar_width: usize) {
 // ─── Main ────────────────────────────────────────────────────────────────────
 
 fn main() {
-    let mut raw_buf = [0u8; THREAD_ENTRY_SIZE * MAX_TASKS];
-    let mut prev = PrevTicks { entries: [(0, 0); MAX_TASKS], count: 0, prev_total: 0 };
+    let mut snap = anyos_std::sys::ThreadSnapshot::new();
     let mut cpu_state = CpuState::new();
 
     const EMPTY_TASK: TaskEntry = TaskEntry {
-        tid: 0, name: [0; 24], name_len: 0, state: 0,
+        tid: 0, name: [0; 32], name_len: 0, state: 0,
         priority: 0, uid: 0, user_pages: 0, cpu_pct_x10: 0,
     };
     let mut tasks = [EMPTY_TASK; MAX_TASKS];
@@ -318,7 +287,7 @@ fn main() {
 
     loop {
         fetch_cpu(&mut cpu_state);
-        let task_count = fetch_tasks(&mut raw_buf, &mut prev, cpu_state.total_sched_ticks, &mut tasks);
+        let task_count = fetch_tasks(&mut snap, &mut tasks);
         sort_by_cpu_desc(&mut tasks, task_count);
 
         // Resolve usernames
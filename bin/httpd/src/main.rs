@@ -8,7 +8,11 @@ use anyos_std::net;
 use anyos_std::process;
 use anyos_std::println;
 use anyos_std::fs;
-use anyos_std::{String, Vec, format, vec};
+use anyos_std::pool;
+use anyos_std::sync::Mutex;
+use anyos_std::sys;
+use anyos_std::{HashMap, String, Vec, format, vec};
+use alloc::sync::Arc;
 
 // ─── Constants ──────────────────────────────────────────────────────
 
@@ -19,13 +23,25 @@ const IPC_PIPE_NAME: &str = "httpd";
 const SERVER_NAME: &str = "anyOS-httpd/1.0";
 const MAX_REQUEST_SIZE: usize = 8192;
 const MAX_RESPONSE_HEADER: usize = 1024;
-const FILE_READ_BUF: usize = 4096;
+const MAX_WORKERS: usize = 16;
+const LISTEN_BACKLOG: u16 = 128;
+const MAX_CONNS: usize = 256;             // open connections per worker
+const MAX_EVENTS: usize = 64;             // readiness events per poll_wait
+const ACCEPT_BATCH: usize = 16;           // connections accepted per wake-up
+const MAX_KEEPALIVE_REQUESTS: u32 = 100;  // requests per connection
+const SWEEP_INTERVAL_MS: u32 = 1000;      // idle connection check period
+const CACHE_MAX_ENTRIES: usize = 256;
+const CACHE_REVALIDATE_MS: u32 = 1000;    // re-stat cached files at most this often
+const LISTENER_TOKEN: u64 = u64::MAX;
 
 // ─── Data Structures ────────────────────────────────────────────────
 
 struct GlobalConfig {
     default_index: Vec<String>,
     log: bool,
+    workers: usize, // worker processes per port, sharing its listener group
+    keepalive_timeout: u32, // seconds an idle connection is kept open
+    gzip_static: bool,      // serve `file.gz` to clients that accept gzip
 }
 
 struct RewriteRule {
@@ -54,6 +70,9 @@ fn parse_global_config() -> GlobalConfig {
     let mut cfg = GlobalConfig {
         default_index: vec![String::from("index.html"), String::from("index.htm")],
         log: true,
+        workers: 2,
+        keepalive_timeout: 15,
+        gzip_static: false,
     };
 
     if let Ok(content) = fs::read_to_string(GLOBAL_CONFIG) {
@@ -72,6 +91,16 @@ fn parse_global_config() -> GlobalConfig {
                 }
             } else if let Some(val) = line.strip_prefix("log=") {
                 cfg.log = val.trim() == "true";
+            } else if let Some(val) = line.strip_prefix("workers=") {
+                if let Ok(n) = val.trim().parse::<usize>() {
+                    cfg.workers = n.clamp(1, MAX_WORKERS);
+                }
+            } else if let Some(val) = line.strip_prefix("keepalive_timeout=") {
+                if let Ok(n) = val.trim().parse::<u32>() {
+                    cfg.keepalive_timeout = n;
+                }
+            } else if let Some(val) = line.strip_prefix("gzip_static=") {
+                cfg.gzip_static = val.trim() == "true";
             }
         }
     }
@@ -235,10 +264,30 @@ struct HttpRequest<'a> {
     method: &'a str,
     path: String,
     host: &'a str,
+    keep_alive: bool,
+    accept_gzip: bool,
 }
 
-fn parse_request(buf: &[u8], len: usize) -> Option<HttpRequest<'_>> {
-    let text = core::str::from_utf8(&buf[..len]).ok()?;
+/// Length of the request head including the blank line, if complete.
+fn find_header_end(buf: &[u8]) -> Option<usize> {
+    buf.windows(4).position(|w| w == b"\r\n\r\n").map(|p| p + 4)
+}
+
+/// Value of header `name` (case-insensitive), trimmed.
+fn header_value<'a>(text: &'a str, name: &str) -> Option<&'a str> {
+    for line in text.split('\n').skip(1) {
+        let line = line.trim_end_matches('\r');
+        if let Some(colon) = line.find(':') {
+            if line[..colon].eq_ignore_ascii_case(name) {
+                return Some(line[colon + 1..].trim());
+            }
+        }
+    }
+    None
+}
+
+fn parse_request(head: &[u8]) -> Option<HttpRequest<'_>> {
+    let text = core::str::from_utf8(head).ok()?;
 
     // Parse request line: "GET /path HTTP/1.1\r\n"
     let first_line_end = text.find('\r').or_else(|| text.find('\n'))?;
@@ -246,26 +295,28 @@ fn parse_request(buf: &[u8], len: usize) -> Option<HttpRequest<'_>> {
     let mut parts = first_line.split(' ');
     let method = parts.next()?;
     let raw_path = parts.next()?;
+    let version = parts.next().unwrap_or("HTTP/1.0");
 
     // URL-decode path and strip query string
     let path_no_query = raw_path.split('?').next().unwrap_or(raw_path);
     let path = url_decode(path_no_query);
 
-    // Parse Host header
-    let mut host = "";
-    for line in text.split('\n') {
-        let line = line.trim_end_matches('\r');
-        if let Some(val) = line.strip_prefix("Host:").or_else(|| line.strip_prefix("host:")) {
-            host = val.trim();
-            // Strip port from host
-            if let Some(colon) = host.rfind(':') {
-                host = &host[..colon];
-            }
-            break;
-        }
+    // Host header, without port
+    let mut host = header_value(text, "Host").unwrap_or("");
+    if let Some(colon) = host.rfind(':') {
+        host = &host[..colon];
     }
 
-    Some(HttpRequest { method, path, host })
+    // HTTP/1.1 keeps the connection open unless told otherwise; 1.0 only on request
+    let keep_alive = match header_value(text, "Connection") {
+        Some(v) if v.eq_ignore_ascii_case("close") => false,
+        Some(v) if v.eq_ignore_ascii_case("keep-alive") => true,
+        _ => version == "HTTP/1.1",
+    };
+    let accept_gzip = header_value(text, "Accept-Encoding")
+        .map_or(false, |v| v.split(',').any(|e| e.trim().starts_with("gzip")));
+
+    Some(HttpRequest { method, path, host, keep_alive, accept_gzip })
 }
 
 fn url_decode(s: &str) -> String {
@@ -333,125 +384,276 @@ fn is_safe_path(path: &str) -> bool {
     true
 }
 
+// ─── File Cache ─────────────────────────────────────────────────────
+
+/// One servable representation of a file: an open fd plus the complete
+/// response head for both connection modes, built once when opened.
+struct CachedBody {
+    fd: u32,
+    size: u32,
+    mtime: u32,
+    head_keep: Vec<u8>,
+    head_close: Vec<u8>,
+}
+
+impl CachedBody {
+    fn open(path: &str, content_type: &str, extra_headers: &str) -> Option<CachedBody> {
+        let mut st = [0u32; 7];
+        if fs::stat(path, &mut st) != 0 || st[0] != 0 {
+            return None;
+        }
+        let fd = fs::open(path, 0);
+        if fd == u32::MAX {
+            return None;
+        }
+        let head = format!(
+            "HTTP/1.1 200 OK\r\n\
+             Content-Type: {}\r\n\
+             Content-Length: {}\r\n\
+             {}Server: {}\r\n\
+             Connection: ",
+            content_type, st[1], extra_headers, SERVER_NAME
+        );
+        Some(CachedBody {
+            fd,
+            size: st[1],
+            mtime: st[6],
+            head_keep: format!("{}keep-alive\r\n\r\n", head).into_bytes(),
+            head_close: format!("{}close\r\n\r\n", head).into_bytes(),
+        })
+    }
+
+    /// True if `path` still has the size and mtime this body was built from.
+    fn is_current(&self, path: &str) -> bool {
+        let mut st = [0u32; 7];
+        fs::stat(path, &mut st) == 0 && st[0] == 0 && st[1] == self.size && st[6] == self.mtime
+    }
+}
+
+impl Drop for CachedBody {
+    fn drop(&mut self) {
+        fs::close(self.fd);
+    }
+}
+
+/// A resolved file with its optional precompressed `.gz` sibling.
+struct CachedFile {
+    fs_path: String,
+    plain: CachedBody,
+    gz: Option<CachedBody>,
+}
+
+impl CachedFile {
+    fn open(fs_path: String, gzip_static: bool) -> Option<CachedFile> {
+        let content_type = mime_type_for(&fs_path);
+        let gz = if gzip_static {
+            let gz_path = format!("{}.gz", fs_path);
+            CachedBody::open(&gz_path, content_type,
+                "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n")
+        } else {
+            None
+        };
+        let extra = if gz.is_some() { "Vary: Accept-Encoding\r\n" } else { "" };
+        let plain = CachedBody::open(&fs_path, content_type, extra)?;
+        // A stale .gz (older than the original) is not served
+        let gz = gz.filter(|g| g.mtime >= plain.mtime);
+        Some(CachedFile { fs_path, plain, gz })
+    }
+
+    fn is_current(&self) -> bool {
+        if !self.plain.is_current(&self.fs_path) {
+            return false;
+        }
+        match self.gz {
+            Some(ref g) => g.is_current(&format!("{}.gz", self.fs_path)),
+            None => true,
+        }
+    }
+}
+
+struct CacheSlot {
+    file: Arc<CachedFile>,
+    checked_ms: u32,
+    last_used: u64,
+}
+
+/// Request path → open file, shared by the threads of a worker. Entries are
+/// re-stat'ed at most every `CACHE_REVALIDATE_MS` and dropped when their size
+/// or mtime changed; the least recently used entry is evicted when full.
+/// Fds are closed when the last in-flight response releases the entry.
+struct FileCache {
+    slots: HashMap<String, CacheSlot>,
+    clock: u64,
+}
+
+impl FileCache {
+    fn new() -> Self {
+        FileCache { slots: HashMap::new(), clock: 0 }
+    }
+
+    fn get(&mut self, key: &String, now: u32) -> Option<Arc<CachedFile>> {
+        self.clock += 1;
+        let clock = self.clock;
+        let slot = self.slots.get_mut(key)?;
+        slot.last_used = clock;
+        if now.wrapping_sub(slot.checked_ms) >= CACHE_REVALIDATE_MS {
+            if !slot.file.is_current() {
+                self.slots.remove(key);
+                return None;
+            }
+            slot.checked_ms = now;
+        }
+        Some(slot.file.clone())
+    }
+
+    fn insert(&mut self, key: String, file: Arc<CachedFile>, now: u32) {
+        if self.slots.len() >= CACHE_MAX_ENTRIES {
+            let oldest = self.slots.iter()
+                .min_by_key(|(_, s)| s.last_used)
+                .map(|(k, _)| k.clone());
+            if let Some(k) = oldest {
+                self.slots.remove(&k);
+            }
+        }
+        self.clock += 1;
+        self.slots.insert(key, CacheSlot { file, checked_ms: now, last_used: self.clock });
+    }
+}
+
 // ─── HTTP Response ──────────────────────────────────────────────────
 
-fn send_error(sock: u32, code: u16, reason: &str) {
+fn connection_header(keep_alive: bool) -> &'static str {
+    if keep_alive { "keep-alive" } else { "close" }
+}
+
+fn send_error(sock: u32, code: u16, reason: &str, keep_alive: bool) {
     let body = format!(
         "<!DOCTYPE html><html><head><title>{} {}</title></head>\
          <body><h1>{} {}</h1><hr><p>{}</p></body></html>",
         code, reason, code, reason, SERVER_NAME
     );
-    let header = format!(
+    let response = format!(
         "HTTP/1.1 {} {}\r\n\
          Content-Type: text/html; charset=utf-8\r\n\
          Content-Length: {}\r\n\
          Server: {}\r\n\
-         Connection: close\r\n\r\n",
-        code, reason, body.len(), SERVER_NAME
+         Connection: {}\r\n\r\n{}",
+        code, reason, body.len(), SERVER_NAME, connection_header(keep_alive), body
     );
-    net::tcp_send(sock, header.as_bytes());
-    net::tcp_send(sock, body.as_bytes());
+    net::tcp_send(sock, response.as_bytes());
 }
 
-fn send_redirect(sock: u32, location: &str) {
+fn send_redirect(sock: u32, location: &str, keep_alive: bool) {
     let body = format!(
         "<!DOCTYPE html><html><head><title>301 Moved</title></head>\
          <body><h1>301 Moved Permanently</h1><p><a href=\"{}\">{}</a></p></body></html>",
         location, location
     );
-    let header = format!(
+    let response = format!(
         "HTTP/1.1 301 Moved Permanently\r\n\
          Location: {}\r\n\
          Content-Type: text/html; charset=utf-8\r\n\
          Content-Length: {}\r\n\
          Server: {}\r\n\
-         Connection: close\r\n\r\n",
-        location, body.len(), SERVER_NAME
+         Connection: {}\r\n\r\n{}",
+        location, body.len(), SERVER_NAME, connection_header(keep_alive), body
     );
-    net::tcp_send(sock, header.as_bytes());
-    net::tcp_send(sock, body.as_bytes());
+    net::tcp_send(sock, response.as_bytes());
 }
 
-fn serve_file(sock: u32, file_path: &str, file_size: u32) {
-    let content_type = mime_type_for(file_path);
-    let header = format!(
-        "HTTP/1.1 200 OK\r\n\
-         Content-Type: {}\r\n\
-         Content-Length: {}\r\n\
-         Server: {}\r\n\
-         Connection: close\r\n\r\n",
-        content_type, file_size, SERVER_NAME
-    );
-    net::tcp_send(sock, header.as_bytes());
-
-    // Stream file content in chunks
-    let fd = fs::open(file_path, 0);
-    if fd == u32::MAX {
-        return;
+/// Send a cached file's head and (unless `head_only`) its body straight
+/// from the page cache. Returns false if the connection failed.
+fn send_body(sock: u32, body: &CachedBody, keep_alive: bool, head_only: bool) -> bool {
+    let head = if keep_alive { &body.head_keep } else { &body.head_close };
+    if net::tcp_send(sock, head) == u32::MAX {
+        return false;
     }
-    let mut buf = [0u8; FILE_READ_BUF];
-    loop {
-        let n = fs::read(fd, &mut buf);
-        if n == 0 || n == u32::MAX {
-            break;
-        }
-        let sent = net::tcp_send(sock, &buf[..n as usize]);
-        if sent == u32::MAX {
-            break;
+    if head_only {
+        return true;
+    }
+    let mut offset = 0u32;
+    while offset < body.size {
+        let sent = net::sendfile(body.fd, sock, offset, body.size - offset);
+        if sent == 0 || sent == u32::MAX {
+            return false;
         }
+        offset += sent;
     }
-    fs::close(fd);
+    true
 }
 
 // ─── Request Handler ────────────────────────────────────────────────
 
-fn handle_request(sock: u32, sites: &[SiteConfig], port: u16) {
-    let mut buf = [0u8; MAX_REQUEST_SIZE];
-    let mut total = 0usize;
+/// Per-worker state shared by the threads serving its connections.
+struct WorkerCtx {
+    port: u16,
+    sites: Vec<SiteConfig>,
+    cache: Mutex<FileCache>,
+    gzip_static: bool,
+}
 
-    // Read request (may arrive in multiple tcp_recv calls)
-    loop {
-        if total >= MAX_REQUEST_SIZE {
-            break;
-        }
-        let n = net::tcp_recv(sock, &mut buf[total..]);
-        if n == 0 || n == u32::MAX {
-            if total == 0 {
-                return; // No data at all
-            }
-            break;
-        }
-        total += n as usize;
+/// Map a request path to a regular file, following directory index rules.
+/// On failure the error response has already been sent.
+fn resolve_file(sock: u32, site: &SiteConfig, path: &str, keep_alive: bool) -> Option<String> {
+    // Build filesystem path
+    let mut fs_path = format!("{}{}", site.root, path);
 
-        // Check if we have the full headers (ends with \r\n\r\n)
-        if total >= 4 {
-            let tail = &buf[..total];
-            if tail.windows(4).any(|w| w == b"\r\n\r\n") {
+    // Check if it's a directory
+    let mut stat_buf = [0u32; 7];
+    if fs::stat(&fs_path, &mut stat_buf) != 0 {
+        send_error(sock, 404, "Not Found", keep_alive);
+        return None;
+    }
+    if stat_buf[0] == 1 {
+        // Directory — redirect if no trailing slash
+        if !path.ends_with('/') {
+            send_redirect(sock, &format!("{}/", path), keep_alive);
+            return None;
+        }
+        // Try index files
+        let mut found = false;
+        for idx in &site.index_files {
+            let idx_path = format!("{}{}", fs_path, idx);
+            if fs::stat(&idx_path, &mut stat_buf) == 0 && stat_buf[0] == 0 {
+                fs_path = idx_path;
+                found = true;
                 break;
             }
         }
+        if !found {
+            send_error(sock, 403, "Forbidden", keep_alive);
+            return None;
+        }
+    } else if stat_buf[0] != 0 {
+        send_error(sock, 404, "Not Found", keep_alive);
+        return None;
     }
+    Some(fs_path)
+}
 
-    if total == 0 {
-        return;
-    }
-
-    let request = match parse_request(&buf, total) {
+/// Answer one request whose head is `head`. `allow_keep` is false when the
+/// connection must close afterwards regardless of what the client asked.
+/// Returns true if the connection stays open.
+fn handle_request(sock: u32, head: &[u8], ctx: &WorkerCtx, allow_keep: bool) -> bool {
+    let request = match parse_request(head) {
         Some(r) => r,
         None => {
-            send_error(sock, 400, "Bad Request");
-            return;
+            send_error(sock, 400, "Bad Request", false);
+            return false;
         }
     };
+    let keep_alive = request.keep_alive && allow_keep;
 
     // Only support GET and HEAD
     if request.method != "GET" && request.method != "HEAD" {
-        send_error(sock, 405, "Method Not Allowed");
-        return;
+        send_error(sock, 405, "Method Not Allowed", false);
+        return false;
     }
 
     // Find matching site for this port (first match wins; if multiple sites
     // share a port, match by Host header)
+    let port = ctx.port;
+    let sites = &ctx.sites;
     let site = sites.iter().find(|s| {
         if s.port != port {
             return false;
@@ -469,8 +671,8 @@ fn handle_request(sock: u32, sites: &[SiteConfig], port: u16) {
             match sites.iter().find(|s| s.port == port) {
                 Some(s) => s,
                 None => {
-                    send_error(sock, 404, "Not Found");
-                    return;
+                    send_error(sock, 404, "Not Found", keep_alive);
+                    return keep_alive;
                 }
             }
         }
@@ -481,91 +683,298 @@ fn handle_request(sock: u32, sites: &[SiteConfig], port: u16) {
 
     // Security check
     if !is_safe_path(&path) {
-        send_error(sock, 403, "Forbidden");
-        return;
+        send_error(sock, 403, "Forbidden", keep_alive);
+        return keep_alive;
     }
 
-    // Build filesystem path
-    let mut fs_path = format!("{}{}", site.root, path);
-
-    // Check if it's a directory
-    let mut stat_buf = [0u32; 7];
-    if fs::stat(&fs_path, &mut stat_buf) == 0 {
-        if stat_buf[0] == 1 {
-            // Directory — redirect if no trailing slash
-            if !path.ends_with('/') {
-                send_redirect(sock, &format!("{}/", path));
-                return;
-            }
-            // Try index files
-            let mut found = false;
-            for idx in &site.index_files {
-                let idx_path = format!("{}{}", fs_path, idx);
-                if fs::stat(&idx_path, &mut stat_buf) == 0 && stat_buf[0] == 0 {
-                    fs_path = idx_path;
-                    found = true;
-                    break;
+    let key = format!("{}{}", site.root, path);
+    let now = sys::uptime_ms();
+    let cached = ctx.cache.lock().get(&key, now);
+    let file = match cached {
+        Some(f) => f,
+        None => {
+            let fs_path = match resolve_file(sock, site, &path, keep_alive) {
+                Some(p) => p,
+                None => return keep_alive,
+            };
+            let file = match CachedFile::open(fs_path, ctx.gzip_static) {
+                Some(f) => Arc::new(f),
+                None => {
+                    send_error(sock, 404, "Not Found", keep_alive);
+                    return keep_alive;
                 }
-            }
-            if !found {
-                send_error(sock, 403, "Forbidden");
-                return;
-            }
+            };
+            ctx.cache.lock().insert(key, file.clone(), now);
+            file
         }
-    } else {
-        send_error(sock, 404, "Not Found");
-        return;
-    }
+    };
 
-    // Verify it's a regular file and get size
-    if fs::stat(&fs_path, &mut stat_buf) != 0 || stat_buf[0] != 0 {
-        send_error(sock, 404, "Not Found");
-        return;
+    let body = match file.gz {
+        Some(ref gz) if request.accept_gzip => gz,
+        _ => &file.plain,
+    };
+    send_body(sock, body, keep_alive, request.method == "HEAD") && keep_alive
+}
+
+// ─── Connections ────────────────────────────────────────────────────
+
+/// A client connection held open between requests.
+struct Conn {
+    sock: u32,
+    buf: Vec<u8>,
+    len: usize,
+    last_active: u32,
+    served: u32,
+    ready: bool, // readable in the current poll round
+    close: bool, // close after this round
+}
+
+impl Conn {
+    fn new(sock: u32, now: u32) -> Self {
+        Conn {
+            sock,
+            buf: vec![0u8; MAX_REQUEST_SIZE],
+            len: 0,
+            last_active: now,
+            served: 0,
+            ready: false,
+            close: false,
+        }
     }
+}
 
-    let file_size = stat_buf[1];
+/// Read what a readable connection has buffered and answer every complete
+/// request in it (pipelined requests included). Never blocks on input.
+fn serve_conn(conn: &mut Conn, ctx: &WorkerCtx, now: u32) {
+    let mut eof = false;
+    loop {
+        let avail = net::tcp_recv_available(conn.sock);
+        if avail == 0 {
+            break;
+        }
+        if avail >= u32::MAX - 1 {
+            eof = true;
+            break;
+        }
+        if conn.len == conn.buf.len() {
+            send_error(conn.sock, 400, "Bad Request", false);
+            conn.close = true;
+            return;
+        }
+        let n = net::tcp_recv(conn.sock, &mut conn.buf[conn.len..]);
+        if n == 0 || n == u32::MAX {
+            eof = true;
+            break;
+        }
+        conn.len += n as usize;
+    }
 
-    if request.method == "HEAD" {
-        let content_type = mime_type_for(&fs_path);
-        let header = format!(
-            "HTTP/1.1 200 OK\r\n\
-             Content-Type: {}\r\n\
-             Content-Length: {}\r\n\
-             Server: {}\r\n\
-             Connection: close\r\n\r\n",
-            content_type, file_size, SERVER_NAME
-        );
-        net::tcp_send(sock, header.as_bytes());
-    } else {
-        serve_file(sock, &fs_path, file_size);
+    while let Some(end) = find_header_end(&conn.buf[..conn.len]) {
+        let allow_keep = !eof && conn.served + 1 < MAX_KEEPALIVE_REQUESTS;
+        let keep = handle_request(conn.sock, &conn.buf[..end], ctx, allow_keep);
+        conn.served += 1;
+        conn.buf.copy_within(end..conn.len, 0);
+        conn.len -= end;
+        if !keep {
+            conn.close = true;
+            return;
+        }
+    }
+    if eof {
+        conn.close = true;
     }
+    conn.last_active = now;
 }
 
 // ─── Worker Process ─────────────────────────────────────────────────
 
-fn worker_main(port: u16, sites: Vec<SiteConfig>) -> ! {
-    let listener = net::tcp_listen(port, 16);
+/// Settings a worker takes from the global config.
+#[derive(Clone, Copy)]
+struct WorkerConfig {
+    keepalive_ms: u32,
+    gzip_static: bool,
+}
+
+/// Accept pending connections on `listener` and register them in `set`.
+fn accept_pending(listener: u32, set: u32, conns: &mut Vec<Option<Conn>>, free: &mut Vec<usize>,
+                  now: u32) {
+    let mut probe = [ipc::PollItem {
+        kind: ipc::POLL_TCP,
+        id: listener,
+        events: ipc::POLLIN,
+        ..Default::default()
+    }];
+    for _ in 0..ACCEPT_BATCH {
+        let (sock, _ip, _rport) = net::tcp_accept(listener);
+        if sock == u32::MAX {
+            break;
+        }
+        if conns.len() - free.len() >= MAX_CONNS {
+            send_error(sock, 503, "Service Unavailable", false);
+            net::tcp_close(sock);
+        } else {
+            let idx = match free.pop() {
+                Some(i) => i,
+                None => {
+                    conns.push(None);
+                    conns.len() - 1
+                }
+            };
+            let item = ipc::PollItem {
+                kind: ipc::POLL_TCP,
+                id: sock,
+                events: ipc::POLLIN,
+                data: idx as u64,
+                ..Default::default()
+            };
+            ipc::poll_ctl(set, ipc::POLL_CTL_ADD, &item);
+            conns[idx] = Some(Conn::new(sock, now));
+        }
+        // More connections queued?
+        probe[0].revents = 0;
+        if ipc::poll_once(&mut probe, 0) != 1 || probe[0].revents & ipc::POLLIN == 0 {
+            break;
+        }
+    }
+}
+
+fn worker_main(port: u16, sites: Vec<SiteConfig>, cfg: WorkerConfig) -> ! {
+    // Every worker of a port joins the same listener group; the kernel
+    // spreads incoming connections across them.
+    let listener = net::tcp_listen_shared(port, LISTEN_BACKLOG);
     if listener == u32::MAX {
         println!("httpd: worker failed to listen on port {}", port);
         process::exit(1);
     }
+    let set = ipc::poll_create();
+    if set == u32::MAX {
+        println!("httpd: worker failed to create wait set");
+        process::exit(1);
+    }
+    let listen_item = ipc::PollItem {
+        kind: ipc::POLL_TCP,
+        id: listener,
+        events: ipc::POLLIN,
+        data: LISTENER_TOKEN,
+        ..Default::default()
+    };
+    ipc::poll_ctl(set, ipc::POLL_CTL_ADD, &listen_item);
 
     println!("httpd: worker listening on port {}", port);
 
+    let ctx = WorkerCtx {
+        port,
+        sites,
+        cache: Mutex::new(FileCache::new()),
+        gzip_static: cfg.gzip_static,
+    };
+    let mut conns: Vec<Option<Conn>> = Vec::new();
+    let mut free: Vec<usize> = Vec::new();
+    let mut events = [ipc::PollItem::default(); MAX_EVENTS];
+
     loop {
-        let (sock, ip, rport) = net::tcp_accept(listener);
-        if sock == u32::MAX {
-            // Timeout — just retry
-            continue;
+        let n = ipc::poll_wait(set, &mut events, SWEEP_INTERVAL_MS);
+        let now = sys::uptime_ms();
+
+        let mut ready = 0usize;
+        let mut accept = false;
+        if n != u32::MAX {
+            for ev in &events[..n as usize] {
+                if ev.data == LISTENER_TOKEN {
+                    accept = true;
+                } else if let Some(Some(c)) = conns.get_mut(ev.data as usize) {
+                    c.ready = true;
+                    ready += 1;
+                }
+            }
+        }
+        if accept {
+            accept_pending(listener, set, &mut conns, &mut free, now);
+        }
+
+        // Serve readable connections; several at once go to the thread pool
+        if ready == 1 {
+            if let Some(c) = conns.iter_mut().flatten().find(|c| c.ready) {
+                serve_conn(c, &ctx, now);
+            }
+        } else if ready > 1 {
+            let ctx = &ctx;
+            pool::scope(|s| {
+                for c in conns.iter_mut().flatten().filter(|c| c.ready) {
+                    s.spawn(move |_| serve_conn(c, ctx, now));
+                }
+            });
         }
 
-        handle_request(sock, &sites, port);
-        net::tcp_close(sock);
+        // Drop finished and idle keep-alive connections
+        for idx in 0..conns.len() {
+            let done = match conns[idx] {
+                Some(ref mut c) => {
+                    c.ready = false;
+                    c.close || now.wrapping_sub(c.last_active) >= cfg.keepalive_ms
+                }
+                None => false,
+            };
+            if done {
+                let c = conns[idx].take().unwrap();
+                let item = ipc::PollItem {
+                    kind: ipc::POLL_TCP,
+                    id: c.sock,
+                    ..Default::default()
+                };
+                ipc::poll_ctl(set, ipc::POLL_CTL_DEL, &item);
+                net::tcp_close(c.sock);
+                free.push(idx);
+            }
+        }
     }
 }
 
 // ─── Master Process ─────────────────────────────────────────────────
 
+/// Fork `cfg.workers` workers for each port in `ports`. The workers of a port
+/// share one listener group, so the kernel balances connections among them.
+fn spawn_workers(sites: &[SiteConfig], ports: &[u16], cfg: &GlobalConfig,
+                 workers: &mut Vec<WorkerInfo>, verbose: bool) {
+    let worker_cfg = WorkerConfig {
+        keepalive_ms: cfg.keepalive_timeout.saturating_mul(1000),
+        gzip_static: cfg.gzip_static,
+    };
+    for &port in ports {
+        for _ in 0..cfg.workers {
+            // Collect sites for this port
+            let port_sites: Vec<SiteConfig> = sites
+                .iter()
+                .filter(|s| s.port == port)
+                .map(|s| SiteConfig {
+                    name: s.name.clone(),
+                    port: s.port,
+                    root: s.root.clone(),
+                    index_files: s.index_files.clone(),
+                    enabled: s.enabled,
+                    rewrites: s.rewrites.iter().map(|r| RewriteRule {
+                        pattern: r.pattern.clone(),
+                        target: r.target.clone(),
+                        is_prefix: r.is_prefix,
+                    }).collect(),
+                })
+                .collect();
+
+            let tid = process::fork();
+            if tid == 0 {
+                // Child process — run worker
+                worker_main(port, port_sites, worker_cfg);
+            } else {
+                // Parent — record worker
+                workers.push(WorkerInfo { port, tid });
+                if verbose {
+                    println!("httpd: forked worker pid {} for port {}", tid, port);
+                }
+            }
+        }
+    }
+}
+
 fn main() {
     let mut args_buf = [0u8; 256];
     let args = process::args(&mut args_buf);
@@ -607,40 +1016,12 @@ fn main() {
     // Create IPC pipe for management commands
     let pipe_id = ipc::pipe_create(IPC_PIPE_NAME);
 
-    // Fork a worker for each unique port
+    // Fork the configured number of workers for each unique port
     let mut workers: Vec<WorkerInfo> = Vec::new();
-
-    for &port in &ports {
-        // Collect sites for this port
-        let port_sites: Vec<SiteConfig> = sites
-            .iter()
-            .filter(|s| s.port == port)
-            .map(|s| SiteConfig {
-                name: s.name.clone(),
-                port: s.port,
-                root: s.root.clone(),
-                index_files: s.index_files.clone(),
-                enabled: s.enabled,
-                rewrites: s.rewrites.iter().map(|r| RewriteRule {
-                    pattern: r.pattern.clone(),
-                    target: r.target.clone(),
-                    is_prefix: r.is_prefix,
-                }).collect(),
-            })
-            .collect();
-
-        let tid = process::fork();
-        if tid == 0 {
-            // Child process — run worker
-            worker_main(port, port_sites);
-        } else {
-            // Parent — record worker
-            workers.push(WorkerInfo { port, tid });
-            println!("httpd: forked worker pid {} for port {}", tid, port);
-        }
-    }
+    spawn_workers(&sites, &ports, &global_cfg, &mut workers, true);
 
     println!("httpd: ready ({} worker(s))", workers.len());
+    ipc::notify_ready();
 
     // Master loop: handle IPC commands
     let mut cmd_buf = [0u8; 256];
@@ -678,39 +1059,17 @@ fn main() {
                         }
 
                         // Fork new workers
-                        for &port in &new_ports {
-                            let port_sites: Vec<SiteConfig> = sites
-                                .iter()
-                                .filter(|s| s.port == port)
-                                .map(|s| SiteConfig {
-                                    name: s.name.clone(),
-                                    port: s.port,
-                                    root: s.root.clone(),
-                                    index_files: s.index_files.clone(),
-                                    enabled: s.enabled,
-                                    rewrites: s.rewrites.iter().map(|r| RewriteRule {
-                                        pattern: r.pattern.clone(),
-                                        target: r.target.clone(),
-                                        is_prefix: r.is_prefix,
-                                    }).collect(),
-                                })
-                                .collect();
-
-                            let tid = process::fork();
-                            if tid == 0 {
-                                worker_main(port, port_sites);
-                            } else {
-                                workers.push(WorkerInfo { port, tid });
-                            }
-                        }
+                        spawn_workers(&sites, &new_ports, &global_cfg, &mut workers, false);
                         println!("httpd: reloaded ({} workers)", workers.len());
                     }
                     "status" => {
                         // Write status back to pipe
+                        let mut ports: Vec<u16> = workers.iter().map(|w| w.port).collect();
+                        ports.dedup();
                         let status = format!(
                             "running workers={} ports={:?}",
                             workers.len(),
-                            workers.iter().map(|w| w.port).collect::<Vec<_>>()
+                            ports
                         );
                         ipc::pipe_write(pipe_id, status.as_bytes());
                     }
@@ -0,0 +1,87 @@
+#![no_std]
+#![no_main]
+
+use anyos_std::sys::{IRQ_FLAG_BALANCED, IRQ_FLAG_PINNED, IRQ_KIND_LINE, IRQ_KIND_MSI};
+
+anyos_std::entry!(main);
+
+fn parse_u32(s: &str) -> Option<u32> {
+    let mut n: u32 = 0;
+    for &b in s.as_bytes() {
+        if b < b'0' || b > b'9' { return None; }
+        n = n.checked_mul(10)?.checked_add((b - b'0') as u32)?;
+    }
+    Some(n)
+}
+
+fn set_affinity(irq: &str, cpu: &str) {
+    let Some(irq) = parse_u32(irq) else {
+        anyos_std::println!("Invalid IRQ: {}", irq);
+        return;
+    };
+    let cpu = if cpu == "auto" {
+        None
+    } else {
+        match parse_u32(cpu) {
+            Some(c) => Some(c),
+            None => {
+                anyos_std::println!("Invalid CPU: {}", cpu);
+                return;
+            }
+        }
+    };
+    if !anyos_std::sys::set_irq_affinity(irq, cpu) {
+        anyos_std::println!("Cannot move IRQ {} (not a device vector, bad CPU, or not root)", irq);
+        return;
+    }
+    match cpu {
+        Some(c) => anyos_std::println!("IRQ {} pinned to CPU{}", irq, c),
+        None => anyos_std::println!("IRQ {} balanced automatically", irq),
+    }
+}
+
+fn main() {
+    let mut buf = [0u8; 256];
+    let args = anyos_std::process::args(&mut buf);
+    let mut words = args.split_ascii_whitespace();
+    match (words.next(), words.next()) {
+        (Some(irq), Some(cpu)) => return set_affinity(irq, cpu),
+        (Some(_), None) => {
+            anyos_std::println!("Usage: irqstat [<irq> <cpu|auto>]");
+            return;
+        }
+        _ => {}
+    }
+
+    let Some((cpus, irqs)) = anyos_std::sys::irq_stats() else {
+        anyos_std::println!("Interrupt statistics not available.");
+        return;
+    };
+    let cpus = (cpus as usize).clamp(1, 16);
+
+    anyos_std::print!(" IRQ  type  ");
+    for c in 0..cpus {
+        anyos_std::print!("{:>10}", anyos_std::format!("CPU{}", c));
+    }
+    anyos_std::println!("  dest    source");
+    for r in irqs.iter() {
+        let kind = match r.kind {
+            IRQ_KIND_LINE => "line",
+            IRQ_KIND_MSI => "msi",
+            _ => "local",
+        };
+        anyos_std::print!("{:>4}  {:<5} ", r.irq, kind);
+        for c in 0..cpus {
+            anyos_std::print!("{:>10}", r.counts[c]);
+        }
+        let dest = if r.cpu == 0xFF { anyos_std::format!("all") } else { anyos_std::format!("CPU{}", r.cpu) };
+        let mode = if r.flags & IRQ_FLAG_PINNED != 0 {
+            "pinned"
+        } else if r.flags & IRQ_FLAG_BALANCED != 0 {
+            "auto"
+        } else {
+            ""
+        };
+        anyos_std::println!("  {:<6}  {} {}", dest, r.name_str(), mode);
+    }
+}
@@ -4,7 +4,7 @@
 use alloc::format;
 use alloc::string::String;
 use alloc::vec::Vec;
-use anyos_std::fs::Write as FsWrite;
+use anyos_std::fs::{Read as FsRead, Write as FsWrite};
 
 anyos_std::entry!(main);
 
@@ -15,10 +15,18 @@ const DEFAULT_LOG_DIR: &str = "/System/logs";
 const DEFAULT_MAX_SIZE: u32 = 1_048_576; // 1 MiB
 const DEFAULT_MAX_FILES: u32 = 4;
 const DEFAULT_FLUSH_INTERVAL: u32 = 5000; // ms
+/// Gzip level of rotated files: rotation runs inside the logging loop.
+const ROTATE_LEVEL: u32 = 6;
+/// Read/write chunk when compressing a rotated file.
+const ROTATE_CHUNK: usize = 16 * 1024;
 const CONFIG_PATH: &str = "/System/etc/logd.conf";
 
 /// Named pipe for application log messages.
 const LOG_PIPE_NAME: &str = "log";
+/// Records drained from one ring per loop iteration.
+const RING_BATCH: usize = 256;
+/// A ring with no records for this long is unmapped until its app logs again.
+const RING_IDLE_MS: u32 = 30_000;
 
 /// Parsed daemon configuration.
 struct Config {
@@ -27,6 +35,7 @@ struct Config {
     max_files: u32,
     kernel: bool,
     flush_interval: u32,
+    compress: bool,
 }
 
 impl Config {
@@ -38,6 +47,7 @@ impl Config {
             max_files: DEFAULT_MAX_FILES,
             kernel: true,
             flush_interval: DEFAULT_FLUSH_INTERVAL,
+            compress: true,
         };
 
         if let Ok(content) = anyos_std::fs::read_to_string(CONFIG_PATH) {
@@ -56,6 +66,8 @@ impl Config {
                     cfg.kernel = val.trim() == "true";
                 } else if let Some(val) = line.strip_prefix("flush_interval=") {
                     cfg.flush_interval = parse_u32(val.trim(), DEFAULT_FLUSH_INTERVAL);
+                } else if let Some(val) = line.strip_prefix("compress=") {
+                    cfg.compress = val.trim() == "true";
                 }
             }
         }
@@ -128,6 +140,9 @@ struct LogWriter {
     max_files: u32,
     current_size: u32,
     buffer: Vec<u8>,
+    /// Gzip rotated files; cleared if libzip cannot be loaded.
+    compress: bool,
+    zip_loaded: bool,
 }
 
 impl LogWriter {
@@ -145,6 +160,8 @@ impl LogWriter {
             max_files: cfg.max_files,
             current_size,
             buffer: Vec::new(),
+            compress: cfg.compress,
+            zip_loaded: false,
         }
     }
 
@@ -182,35 +199,92 @@ impl LogWriter {
     }
 
     /// Rotate log files: system.log -> .1 -> .2 -> ... -> delete oldest.
+    /// With `compress`, rotated files are gzipped (`system.log.1.gz`, ...);
+    /// plain files left by an earlier configuration are shifted as well.
     fn rotate(&mut self) {
-        // Delete the oldest file
-        if self.max_files > 1 {
-            let oldest = format!("{}/system.log.{}", self.log_dir, self.max_files - 1);
-            anyos_std::fs::unlink(&oldest);
+        let current = format!("{}/system.log", self.log_dir);
+        if self.max_files <= 1 {
+            // Only 1 file allowed — truncate
+            anyos_std::fs::truncate(&current);
+            self.current_size = 0;
+            return;
         }
 
+        // Delete the oldest file
+        let oldest = format!("{}/system.log.{}", self.log_dir, self.max_files - 1);
+        anyos_std::fs::unlink(&oldest);
+        anyos_std::fs::unlink(&format!("{}.gz", oldest));
+
         // Shift existing rotated files
-        let mut i = self.max_files.saturating_sub(1);
+        let mut i = self.max_files - 1;
         while i >= 2 {
             let from = format!("{}/system.log.{}", self.log_dir, i - 1);
             let to = format!("{}/system.log.{}", self.log_dir, i);
             anyos_std::fs::rename(&from, &to);
+            anyos_std::fs::rename(&format!("{}.gz", from), &format!("{}.gz", to));
             i -= 1;
         }
 
-        // Rename current to .1
-        if self.max_files > 1 {
-            let current = format!("{}/system.log", self.log_dir);
-            let rotated = format!("{}/system.log.1", self.log_dir);
-            anyos_std::fs::rename(&current, &rotated);
+        // Compress current to .1.gz, or rename it to .1
+        let rotated = format!("{}/system.log.1", self.log_dir);
+        let gz = format!("{}.gz", rotated);
+        if self.compress && self.load_zip() && gzip_file(&current, &gz) {
+            anyos_std::fs::unlink(&current);
         } else {
-            // Only 1 file allowed — truncate
-            let current = format!("{}/system.log", self.log_dir);
-            anyos_std::fs::truncate(&current);
+            anyos_std::fs::unlink(&gz);
+            anyos_std::fs::rename(&current, &rotated);
         }
 
         self.current_size = 0;
     }
+
+    /// Load libzip on first use; rotation falls back to renaming without it.
+    fn load_zip(&mut self) -> bool {
+        if !self.zip_loaded {
+            if !libzip_client::init() {
+                anyos_std::println!("logd: libzip.so not available, rotated logs stay uncompressed");
+                self.compress = false;
+                return false;
+            }
+            self.zip_loaded = true;
+        }
+        true
+    }
+}
+
+/// Gzip `src` into `dst` in fixed-size chunks.
+fn gzip_file(src: &str, dst: &str) -> bool {
+    let mut stream = match libzip_client::Stream::deflate(libzip_client::Format::Gzip, ROTATE_LEVEL) {
+        Some(s) => s,
+        None => return false,
+    };
+    let (mut input, mut output) = match (anyos_std::fs::File::open(src), anyos_std::fs::File::create(dst)) {
+        (Ok(i), Ok(o)) => (i, o),
+        _ => return false,
+    };
+    let mut in_buf = alloc::vec![0u8; ROTATE_CHUNK];
+    let mut out_buf = alloc::vec![0u8; ROTATE_CHUNK];
+    let (mut pos, mut len) = (0, 0);
+    let mut eof = false;
+    while !stream.is_done() {
+        if pos == len && !eof {
+            len = match input.read(&mut in_buf) {
+                Ok(n) => n,
+                Err(_) => return false,
+            };
+            pos = 0;
+            eof = len == 0;
+        }
+        let (consumed, produced) = match stream.process(&in_buf[pos..len], eof, &mut out_buf) {
+            Some(r) => r,
+            None => return false,
+        };
+        pos += consumed;
+        if output.write_all(&out_buf[..produced]).is_err() {
+            return false;
+        }
+    }
+    true
 }
 
 /// Get the size of a file, or 0 if it doesn't exist.
@@ -262,6 +336,94 @@ impl DmesgTracker {
     }
 }
 
+// ─── Application Rings ──────────────────────────────────────────────────────
+
+/// A process's shared-memory log ring (see `anyos_std::log::Ring`).
+struct AppRing {
+    shm_id: u32,
+    ring: anyos_std::log::Ring,
+    last_active: u32,
+}
+
+/// Map and attach the ring announced by a `RING|<shm_id>` pipe line.
+fn register_ring(rings: &mut Vec<AppRing>, arg: &[u8]) {
+    let shm_id = match core::str::from_utf8(arg) {
+        Ok(s) => parse_u32(s.trim(), 0),
+        Err(_) => 0,
+    };
+    if shm_id == 0 {
+        return;
+    }
+    let now = anyos_std::sys::uptime_ms();
+    if let Some(r) = rings.iter_mut().find(|r| r.shm_id == shm_id) {
+        r.ring.attach();
+        r.last_active = now;
+        return;
+    }
+    let addr = anyos_std::ipc::shm_map(shm_id);
+    if addr == 0 {
+        return;
+    }
+    let ring = unsafe { anyos_std::log::Ring::from_addr(addr as usize) };
+    if !ring.is_valid() || ring.shm_id() != shm_id {
+        anyos_std::ipc::shm_unmap(shm_id);
+        return;
+    }
+    ring.attach();
+    rings.push(AppRing { shm_id, ring, last_active: now });
+}
+
+/// Drain up to `RING_BATCH` records from every ring, report dropped
+/// records, and unmap rings that have been idle for `RING_IDLE_MS`.
+/// Returns true if anything was written.
+fn drain_rings(rings: &mut Vec<AppRing>, writer: &mut LogWriter) -> bool {
+    let now = anyos_std::sys::uptime_ms();
+    let mut got_data = false;
+    let mut formatted = Vec::new();
+    let mut i = 0;
+    while i < rings.len() {
+        let r = &mut rings[i];
+        let mut n = r.ring.drain(RING_BATCH, |rec| {
+            formatted.clear();
+            format_app_message(rec, &mut formatted);
+            writer.append(&formatted);
+        });
+        let dropped = r.ring.take_dropped();
+        if dropped > 0 {
+            formatted.clear();
+            let mut ts_buf = [0u8; 22];
+            let ts_len = format_timestamp(&mut ts_buf);
+            formatted.extend_from_slice(&ts_buf[..ts_len]);
+            formatted.extend_from_slice(b"WARN  ");
+            formatted.extend_from_slice(r.ring.source());
+            formatted.extend_from_slice(format!(": {} log messages dropped (ring full)\n", dropped).as_bytes());
+            writer.append(&formatted);
+            n += 1;
+        }
+        if n > 0 {
+            got_data = true;
+            r.last_active = now;
+        } else if now.wrapping_sub(r.last_active) >= RING_IDLE_MS && r.ring.try_detach() {
+            anyos_std::ipc::shm_unmap(r.shm_id);
+            rings.swap_remove(i);
+            continue;
+        }
+        i += 1;
+    }
+    got_data
+}
+
+/// Handle one line from the log pipe: a ring announcement or a message.
+fn handle_pipe_line(line: &[u8], rings: &mut Vec<AppRing>, writer: &mut LogWriter) {
+    if let Some(arg) = line.strip_prefix(b"RING|") {
+        register_ring(rings, arg);
+        return;
+    }
+    let mut formatted = Vec::new();
+    format_app_message(line, &mut formatted);
+    writer.append(&formatted);
+}
+
 // ─── Pipe Message Parser ────────────────────────────────────────────────────
 
 /// Format an application log message from pipe data.
@@ -342,6 +504,7 @@ fn main() {
     let mut writer = LogWriter::new(&cfg);
     let mut dmesg = if cfg.kernel { Some(DmesgTracker::new()) } else { None };
     let mut pipe_buf = [0u8; 4096];
+    let mut rings: Vec<AppRing> = Vec::new();
     let mut last_flush = anyos_std::sys::uptime_ms();
 
     // Write startup message
@@ -352,6 +515,7 @@ fn main() {
     startup_line.extend_from_slice(b"INFO  logd: logging daemon started\n");
     writer.append(&startup_line);
     writer.flush();
+    anyos_std::ipc::notify_ready();
 
     loop {
         let mut got_data = false;
@@ -366,23 +530,22 @@ fn main() {
             for i in 0..data.len() {
                 if data[i] == b'\n' {
                     if i > line_start {
-                        let line = &data[line_start..i];
-                        let mut formatted = Vec::new();
-                        format_app_message(line, &mut formatted);
-                        writer.append(&formatted);
+                        handle_pipe_line(&data[line_start..i], &mut rings, &mut writer);
                     }
                     line_start = i + 1;
                 }
             }
             // Handle trailing data without newline
             if line_start < data.len() {
-                let line = &data[line_start..];
-                let mut formatted = Vec::new();
-                format_app_message(line, &mut formatted);
-                writer.append(&formatted);
+                handle_pipe_line(&data[line_start..], &mut rings, &mut writer);
             }
         }
 
+        // Drain application rings
+        if drain_rings(&mut rings, &mut writer) {
+            got_data = true;
+        }
+
         // Poll kernel dmesg for new messages
         if let Some(ref mut dmesg_tracker) = dmesg {
             let new_data = dmesg_tracker.poll_new();
@@ -98,47 +98,35 @@ fn build_path(parent: &str, name: &str) -> anyos_std::String {
 /// List the contents of a single directory, optionally recursing into subdirectories.
 fn list_directory(path: &str, long: bool, all: bool, one_per_line: bool,
                   human: bool, sort_size: bool, reverse: bool, recursive: bool) {
-    let mut buf = [0u8; 64 * 128];
-    let count = anyos_std::fs::readdir(path, &mut buf);
-
-    if count == u32::MAX {
-        anyos_std::println!("ls: cannot access '{}': No such file or directory", path);
-        return;
-    }
+    // Entries carry their stat attributes, so -l needs no per-entry stat.
+    let dir = match anyos_std::fs::read_dir(path) {
+        Ok(d) => d,
+        Err(_) => {
+            anyos_std::println!("ls: cannot access '{}': No such file or directory", path);
+            return;
+        }
+    };
 
     let mut entries = anyos_std::Vec::new();
-    let max_entries = buf.len() / 64;
-    let actual = (count as usize).min(max_entries);
-    for i in 0..actual {
-        let raw_entry = &buf[i * 64..(i + 1) * 64];
-        let entry_type = raw_entry[0];
-        let name_len = raw_entry[1] as usize;
-        let flags = raw_entry[2];
-        let is_symlink = flags & 1 != 0;
-        let size = u32::from_le_bytes([raw_entry[4], raw_entry[5], raw_entry[6], raw_entry[7]]);
+    for de in dir {
         let mut name = [0u8; 56];
-        let nlen = name_len.min(56);
-        name[..nlen].copy_from_slice(&raw_entry[8..8 + nlen]);
+        let nlen = de.name.len().min(56);
+        name[..nlen].copy_from_slice(&de.name.as_bytes()[..nlen]);
 
         if !all && nlen > 0 && name[0] == b'.' {
             continue;
         }
 
-        // Get uid/gid/mode via stat if long format
-        let (uid, gid, mode) = if long {
-            let name_str = core::str::from_utf8(&name[..nlen]).unwrap_or("");
-            let full_path = build_path(path, name_str);
-            let mut stat_buf = [0u32; 7];
-            if anyos_std::fs::stat(&full_path, &mut stat_buf) == 0 {
-                (stat_buf[3] as u16, stat_buf[4] as u16, stat_buf[5])
-            } else {
-                (0u16, 0u16, 0u32)
-            }
-        } else {
-            (0, 0, 0)
-        };
-
-        entries.push(Entry { name, name_len: nlen, size, entry_type, is_symlink, uid, gid, mode });
+        entries.push(Entry {
+            name,
+            name_len: nlen,
+            size: de.size,
+            entry_type: de.file_type,
+            is_symlink: de.is_symlink,
+            uid: de.uid,
+            gid: de.gid,
+            mode: de.mode as u32,
+        });
     }
 
     // Sort
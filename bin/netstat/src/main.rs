@@ -108,7 +108,7 @@ fn print_usage() {
     println!("  -l, --listening    Show only listening sockets");
     println!("  -a, --all          Show all sockets (listening and non-listening)");
     println!("  -p, --program      Show PID/program name");
-    println!("  -e, --extend       Show extended info (user)");
+    println!("  -e, --extend       Show extended info (user, cwnd, SRTT/RTO in ms)");
     println!("  -n, --numeric      Show numerical addresses (no DNS)");
     println!("  -r, --route        Show routing table");
     println!("  -i, --interfaces   Show interface table");
@@ -389,6 +389,13 @@ fn show_statistics(show_tcp: bool, show_udp: bool) {
     if stats.tx_errors > 0 {
         println!("    {} outgoing errors", stats.tx_errors);
     }
+    if stats.rx_passes > 0 {
+        println!("    {} receive passes, {} packets/pass avg, {} max",
+            stats.rx_passes, stats.rx_pass_frames / stats.rx_passes, stats.rx_pass_max);
+        if stats.rx_budget_exhausted > 0 {
+            println!("    {} passes hit the receive budget", stats.rx_budget_exhausted);
+        }
+    }
 
     if show_tcp {
         println!("Tcp:");
@@ -441,6 +448,9 @@ fn show_sockets(flags: &Flags) {
         header.push_str(" User       ");
     }
     header.push_str(" RecvQ");
+    if flags.extend {
+        header.push_str("     Cwnd  SRTT   RTO");
+    }
 
     let sep_len = header.len();
     let sep: alloc::string::String = (0..sep_len).map(|_| '-').collect();
@@ -489,6 +499,9 @@ fn show_sockets(flags: &Flags) {
             }
 
             line.push_str(&alloc::format!(" {:>5}", c.recv_buf_len));
+            if flags.extend && !is_listen {
+                line.push_str(&alloc::format!(" {:>8} {:>5} {:>5}", c.cwnd, c.srtt_ms, c.rto_ms));
+            }
             println!("{}", line);
             total += 1;
         }
@@ -52,7 +52,7 @@ fn main() {
     match anyos_std::audio::play_wav(&data) {
         Ok(()) => {
             // Wait for playback to finish
-            while anyos_std::audio::audio_is_playing() {
+            while anyos_std::audio::audio_buffered() > 0 {
                 anyos_std::process::sleep(10); // poll audio status, not busy-wait
             }
             anyos_std::println!("Done.");
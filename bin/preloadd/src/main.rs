@@ -0,0 +1,196 @@
+//! preloadd — keeps the standard libraries and the most launched apps warm.
+//!
+//! - At boot it loads the shared libraries every GUI app maps. The kernel
+//!   keeps a loaded library registered system-wide, so apps started later
+//!   map the resident pages instead of reading and relocating the file.
+//! - It reads the bundles of the apps launched most often (by the launch
+//!   history) once, at low priority, so their first launch is served from
+//!   the page cache.
+//! - libanyui reports the first frame of every process on
+//!   `ipc::LAUNCH_CHANNEL`; for app bundles the daemon logs the
+//!   spawn-to-first-frame time and counts the launch in the history.
+
+#![no_std]
+#![no_main]
+
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::fs::{Read as FsRead, Write as FsWrite};
+use anyos_std::{fs, ipc, println, process, sys, vec};
+
+anyos_std::entry!(main);
+
+// ─── Configuration ──────────────────────────────────────────────────────────
+
+/// Shared libraries loaded at startup.
+const STANDARD_LIBS: &[&str] = &[
+    "/Libraries/libanyui.so",
+    "/Libraries/libfont.so",
+    "/Libraries/libsvg.so",
+];
+const APPS_DIR: &str = "/Applications";
+const HISTORY_DIR: &str = "/System/var";
+/// Launch history: one `<count> <app name>` line per app.
+const HISTORY_PATH: &str = "/System/var/preload.history";
+/// Apps kept in the history.
+const MAX_HISTORY: usize = 32;
+/// Apps warmed at startup.
+const WARM_APPS: usize = 8;
+/// Bytes read from one bundle at most.
+const WARM_BUDGET: usize = 16 * 1024 * 1024;
+const READ_CHUNK: usize = 64 * 1024;
+/// Priority while warming (0-127); the daemon only waits afterwards.
+const WARM_PRIORITY: u8 = 10;
+
+// ─── Launch history ─────────────────────────────────────────────────────────
+
+struct App {
+    name: String,
+    launches: u32,
+}
+
+/// Apps by launch count, most launched first.
+fn load_history() -> Vec<App> {
+    let mut apps = Vec::new();
+    if let Ok(content) = fs::read_to_string(HISTORY_PATH) {
+        for line in content.split('\n') {
+            let Some((count, name)) = line.trim().split_once(' ') else {
+                continue;
+            };
+            if let Ok(launches) = count.parse() {
+                apps.push(App { name: String::from(name.trim()), launches });
+            }
+        }
+    }
+    apps.sort_by(|a, b| b.launches.cmp(&a.launches));
+    apps.truncate(MAX_HISTORY);
+    apps
+}
+
+fn save_history(apps: &[App]) {
+    let mut out = String::new();
+    for app in apps {
+        out.push_str(&format!("{} {}\n", app.launches, app.name));
+    }
+    fs::mkdir(HISTORY_DIR);
+    if let Ok(mut f) = fs::File::create(HISTORY_PATH) {
+        let _ = f.write_all(out.as_bytes());
+    }
+}
+
+/// Count a launch of `name`, keeping the list sorted and bounded.
+fn record_launch(apps: &mut Vec<App>, name: &str) {
+    match apps.iter().position(|a| a.name == name) {
+        Some(i) => apps[i].launches += 1,
+        None => {
+            if apps.len() >= MAX_HISTORY {
+                apps.pop();
+            }
+            apps.push(App { name: String::from(name), launches: 1 });
+        }
+    }
+    apps.sort_by(|a, b| b.launches.cmp(&a.launches));
+}
+
+// ─── Warming ────────────────────────────────────────────────────────────────
+
+fn bundle_path(name: &str) -> String {
+    format!("{}/{}.app", APPS_DIR, name)
+}
+
+/// Read the files of `dir` (and one level of subdirectories) into the page
+/// cache. Returns the bytes read.
+fn warm_dir(dir: &str, buf: &mut [u8], budget: usize, depth: u32) -> usize {
+    let Ok(entries) = fs::read_dir(dir) else {
+        return 0;
+    };
+    let mut total = 0;
+    for e in entries {
+        if total >= budget {
+            break;
+        }
+        let path = format!("{}/{}", dir, e.name);
+        if e.is_dir() {
+            if depth > 0 {
+                total += warm_dir(&path, buf, budget - total, depth - 1);
+            }
+        } else if e.is_file() {
+            let Ok(mut f) = fs::File::open(&path) else {
+                continue;
+            };
+            while total < budget {
+                match f.read(buf) {
+                    Ok(n) if n > 0 => total += n,
+                    _ => break,
+                }
+            }
+        }
+    }
+    total
+}
+
+fn warm(apps: &[App]) {
+    let mut buf = vec![0u8; READ_CHUNK];
+    for app in apps.iter().take(WARM_APPS) {
+        let t0 = sys::uptime_ms();
+        let bytes = warm_dir(&bundle_path(&app.name), &mut buf, WARM_BUDGET, 1);
+        if bytes > 0 {
+            println!("preloadd: warmed {} ({} KiB, {} ms)",
+                app.name, bytes / 1024, sys::uptime_ms().wrapping_sub(t0));
+        }
+    }
+}
+
+// ─── Main ───────────────────────────────────────────────────────────────────
+
+/// Name of the running thread `tid`, if it still exists.
+fn thread_name(tid: u32) -> Option<String> {
+    let mut snap = sys::ThreadSnapshot::new();
+    if !snap.refresh() {
+        return None;
+    }
+    snap.threads().iter().find(|t| t.tid == tid).map(|t| String::from(t.name_str()))
+}
+
+fn main() {
+    process::set_priority(0, WARM_PRIORITY);
+
+    for path in STANDARD_LIBS {
+        if anyos_std::dll::dll_load(path) == 0 {
+            println!("preloadd: cannot load {}", path);
+        }
+    }
+
+    // Subscribe before warming so no launch report is missed
+    let chan = ipc::evt_chan_create(ipc::LAUNCH_CHANNEL);
+    let sub = ipc::evt_chan_subscribe(chan, ipc::EVT_FIRST_FRAME);
+
+    let mut apps = load_history();
+    warm(&apps);
+
+    let mut event = [0u32; 5];
+    loop {
+        ipc::evt_chan_wait(chan, sub, u32::MAX);
+        let mut changed = false;
+        while ipc::evt_chan_poll(chan, sub, &mut event) {
+            if event[0] != ipc::EVT_FIRST_FRAME {
+                continue;
+            }
+            // App processes are named after their bundle
+            let Some(name) = thread_name(event[1]) else {
+                continue;
+            };
+            let mut st = [0u32; 7];
+            if fs::stat(&bundle_path(&name), &mut st) != 0 || st[0] != 1 {
+                continue;
+            }
+            println!("preloadd: {} first frame {} ms after spawn", name, event[2]);
+            record_launch(&mut apps, &name);
+            changed = true;
+        }
+        if changed {
+            save_history(&apps);
+        }
+    }
+}
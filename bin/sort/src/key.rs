@@ -0,0 +1,148 @@
+//! Sort keys.
+//!
+//! Each line's key is located (and parsed, for `-n`) once when the line is
+//! read; comparisons then only look at the precomputed [`Rec`].
+
+use core::cmp::Ordering;
+
+/// Ordering options shared by every comparison.
+#[derive(Clone, Copy)]
+pub struct Order {
+    pub numeric: bool,
+    pub fold_case: bool,
+    pub reverse: bool,
+    /// `-k START[,END]`: 1-based fields, `key_end == 0` means end of line.
+    pub key_start: u32,
+    pub key_end: u32,
+    /// `-t`: field separator; fields are blank-separated when unset.
+    pub separator: Option<u8>,
+}
+
+/// A line and its precomputed key.  Offsets are into the buffer holding
+/// the line; `key_*` are relative to the start of the line.
+#[derive(Clone, Copy)]
+pub struct Rec {
+    pub off: u32,
+    pub len: u32,
+    pub key_off: u32,
+    pub key_len: u32,
+    /// Leading integer of the key (`-n` only).
+    pub num: i64,
+}
+
+fn is_blank(b: u8) -> bool {
+    b == b' ' || b == b'\t'
+}
+
+/// Byte range `[start, end)` of the key within `line`.
+fn key_range(line: &[u8], order: &Order) -> (usize, usize) {
+    if order.key_start == 0 {
+        return (0, line.len());
+    }
+    let field_start = |n: u32| -> usize {
+        // Start of field n (1-based), or line.len() if there are fewer.
+        let mut i = 0;
+        for _ in 1..n {
+            match order.separator {
+                Some(sep) => match line[i..].iter().position(|&b| b == sep) {
+                    Some(p) => i += p + 1,
+                    None => return line.len(),
+                },
+                None => {
+                    while i < line.len() && is_blank(line[i]) { i += 1; }
+                    while i < line.len() && !is_blank(line[i]) { i += 1; }
+                    if i == line.len() { return i; }
+                }
+            }
+        }
+        i
+    };
+    let field_end = |start: usize| -> usize {
+        match order.separator {
+            Some(sep) => line[start..].iter().position(|&b| b == sep).map_or(line.len(), |p| start + p),
+            None => {
+                let mut i = start;
+                while i < line.len() && is_blank(line[i]) { i += 1; }
+                while i < line.len() && !is_blank(line[i]) { i += 1; }
+                i
+            }
+        }
+    };
+
+    let mut start = field_start(order.key_start);
+    let end = if order.key_end == 0 {
+        line.len()
+    } else if order.key_end < order.key_start {
+        start
+    } else {
+        field_end(field_start(order.key_end))
+    };
+    // Leading blanks of a blank-separated field are not part of the key.
+    if order.separator.is_none() {
+        while start < end && is_blank(line[start]) { start += 1; }
+    }
+    (start, end.max(start))
+}
+
+fn parse_leading_int(s: &[u8]) -> i64 {
+    let mut i = 0;
+    while i < s.len() && is_blank(s[i]) { i += 1; }
+    let neg = if i < s.len() && s[i] == b'-' { i += 1; true } else { false };
+    let mut n: i64 = 0;
+    while i < s.len() && s[i] >= b'0' && s[i] <= b'9' {
+        n = n.wrapping_mul(10).wrapping_add((s[i] - b'0') as i64);
+        i += 1;
+    }
+    if neg { -n } else { n }
+}
+
+/// Build the record for `line`, which starts at `off` in its buffer.
+pub fn make_rec(line: &[u8], off: usize, order: &Order) -> Rec {
+    let (ks, ke) = key_range(line, order);
+    let num = if order.numeric { parse_leading_int(&line[ks..ke]) } else { 0 };
+    Rec { off: off as u32, len: line.len() as u32, key_off: ks as u32, key_len: (ke - ks) as u32, num }
+}
+
+fn to_lower(b: u8) -> u8 {
+    if b >= b'A' && b <= b'Z' { b + 32 } else { b }
+}
+
+fn cmp_folded(a: &[u8], b: &[u8]) -> Ordering {
+    let min = if a.len() < b.len() { a.len() } else { b.len() };
+    for i in 0..min {
+        let la = to_lower(a[i]);
+        let lb = to_lower(b[i]);
+        if la != lb { return la.cmp(&lb); }
+    }
+    a.len().cmp(&b.len())
+}
+
+/// The line bytes of `rec` in buffer `buf`.
+#[inline]
+pub fn line<'a>(buf: &'a [u8], rec: &Rec) -> &'a [u8] {
+    &buf[rec.off as usize..(rec.off + rec.len) as usize]
+}
+
+/// Compare keys only (what `-u` considers equal), honouring `-r`.
+pub fn cmp_keys(order: &Order, a_buf: &[u8], a: &Rec, b_buf: &[u8], b: &Rec) -> Ordering {
+    let ord = if order.numeric {
+        a.num.cmp(&b.num)
+    } else {
+        let ak = &a_buf[(a.off + a.key_off) as usize..(a.off + a.key_off + a.key_len) as usize];
+        let bk = &b_buf[(b.off + b.key_off) as usize..(b.off + b.key_off + b.key_len) as usize];
+        if order.fold_case { cmp_folded(ak, bk) } else { ak.cmp(bk) }
+    };
+    if order.reverse { ord.reverse() } else { ord }
+}
+
+/// Full comparison: keys, then the whole line as a tie-break, so the
+/// output does not depend on how the input was split into runs.
+pub fn cmp_recs(order: &Order, a_buf: &[u8], a: &Rec, b_buf: &[u8], b: &Rec) -> Ordering {
+    match cmp_keys(order, a_buf, a, b_buf, b) {
+        Ordering::Equal => {
+            let ord = line(a_buf, a).cmp(line(b_buf, b));
+            if order.reverse { ord.reverse() } else { ord }
+        }
+        ord => ord,
+    }
+}
@@ -1,96 +1,339 @@
+//! sort — sort lines of text files.
+//!
+//! Input is read into a chunk of at most `-S` bytes (lines plus their
+//! precomputed keys).  A chunk is sorted in parallel on the thread pool;
+//! if the input does not fit in one chunk, each sorted chunk is spilled to
+//! a temporary run file and the runs are merged k ways at the end.
+//!
+//! Usage: sort [-rnuf] [-k START[,END]] [-t SEP] [-S SIZE] [-T DIR] [FILE...]
+
 #![no_std]
 #![no_main]
 
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::fs;
+
+mod key;
+mod merge;
+
+use key::{Order, Rec};
+
 anyos_std::entry!(main);
 
-fn to_lower(b: u8) -> u8 {
-    if b >= b'A' && b <= b'Z' { b + 32 } else { b }
+/// Default memory limit for one chunk.
+const DEFAULT_MEM: usize = 16 * 1024 * 1024;
+/// Smallest accepted `-S`.
+const MIN_MEM: usize = 64 * 1024;
+/// Bytes requested per read.
+const READ_SIZE: usize = 64 * 1024;
+/// Output is written in pieces of this size.
+const OUT_BUF_SIZE: usize = 64 * 1024;
+/// Most runs merged at once; more are merged in several passes.
+const MERGE_FANIN: usize = 16;
+const DEFAULT_TMP: &str = "/tmp";
+
+/// Buffered line writer.
+pub struct Output {
+    fd: u32,
+    buf: Vec<u8>,
+    failed: bool,
 }
 
-fn parse_leading_int(s: &str) -> i64 {
-    let bytes = s.as_bytes();
-    let mut i = 0;
-    let neg = if !bytes.is_empty() && bytes[0] == b'-' { i = 1; true } else { false };
-    let mut n: i64 = 0;
-    while i < bytes.len() && bytes[i] >= b'0' && bytes[i] <= b'9' {
-        n = n * 10 + (bytes[i] - b'0') as i64;
-        i += 1;
+impl Output {
+    fn new(fd: u32) -> Output {
+        Output { fd, buf: Vec::with_capacity(OUT_BUF_SIZE), failed: false }
+    }
+
+    /// Append `line` and a newline.
+    pub fn line(&mut self, line: &[u8]) {
+        if self.buf.len() + line.len() + 1 > OUT_BUF_SIZE {
+            self.flush();
+        }
+        self.buf.extend_from_slice(line);
+        self.buf.push(b'\n');
+    }
+
+    fn flush(&mut self) {
+        let mut done = 0;
+        while done < self.buf.len() && !self.failed {
+            let n = fs::write(self.fd, &self.buf[done..]);
+            if n == 0 || n == u32::MAX {
+                self.failed = true;
+            } else {
+                done += n as usize;
+            }
+        }
+        self.buf.clear();
+    }
+
+    /// Flush and report whether everything was written.
+    fn finish(&mut self) -> bool {
+        self.flush();
+        !self.failed
     }
-    if neg { -n } else { n }
 }
 
-fn read_all(fd: u32) -> (anyos_std::Vec<u8>, usize) {
-    let mut file_buf = anyos_std::vec![0u8; 64 * 1024];
-    let mut total: usize = 0;
-    let mut read_buf = [0u8; 512];
-    loop {
-        let n = anyos_std::fs::read(fd, &mut read_buf);
-        if n == 0 || n == u32::MAX { break; }
-        let n = n as usize;
-        if total + n > file_buf.len() { break; }
-        file_buf[total..total + n].copy_from_slice(&read_buf[..n]);
-        total += n;
+/// The concatenated input files.
+struct Input {
+    fds: Vec<u32>,
+    next: usize,
+}
+
+impl Input {
+    /// Append up to `READ_SIZE` bytes to `data`.  A file that does not end
+    /// in a newline gets one.  Returns false once all input is consumed.
+    fn fill(&mut self, data: &mut Vec<u8>) -> bool {
+        while self.next < self.fds.len() {
+            let filled = data.len();
+            data.resize(filled + READ_SIZE, 0);
+            let n = fs::read(self.fds[self.next], &mut data[filled..]);
+            let n = if n == u32::MAX { 0 } else { n as usize };
+            data.truncate(filled + n);
+            if n > 0 {
+                return true;
+            }
+            if data.last().map_or(false, |&b| b != b'\n') {
+                data.push(b'\n');
+            }
+            self.next += 1;
+        }
+        false
+    }
+}
+
+impl Drop for Input {
+    fn drop(&mut self) {
+        for &fd in &self.fds {
+            if fd != 0 {
+                fs::close(fd);
+            }
+        }
+    }
+}
+
+/// `-S` value: a byte count with an optional K, M or G suffix.
+fn parse_size(s: &str) -> Option<usize> {
+    let (digits, mul) = match s.as_bytes().last()? {
+        b'k' | b'K' => (&s[..s.len() - 1], 1024),
+        b'm' | b'M' => (&s[..s.len() - 1], 1024 * 1024),
+        b'g' | b'G' => (&s[..s.len() - 1], 1024 * 1024 * 1024),
+        b'b' => (&s[..s.len() - 1], 1),
+        _ => (s, 1),
+    };
+    let n: usize = digits.parse().ok()?;
+    n.checked_mul(mul)
+}
+
+/// `-k` value: `START[,END]` field numbers.
+fn parse_key(s: &str) -> Option<(u32, u32)> {
+    let (start, end) = match s.find(',') {
+        Some(p) => (&s[..p], &s[p + 1..]),
+        None => (s, ""),
+    };
+    let start: u32 = start.parse().ok()?;
+    let end: u32 = if end.is_empty() { 0 } else { end.parse().ok()? };
+    if start == 0 { None } else { Some((start, end)) }
+}
+
+/// Write the sorted `recs` over `data`, dropping key duplicates with `-u`.
+fn emit(data: &[u8], recs: &[Rec], order: &Order, unique: bool, out: &mut Output) {
+    let mut prev: Option<&Rec> = None;
+    for rec in recs {
+        if unique {
+            if let Some(p) = prev {
+                if key::cmp_keys(order, data, p, data, rec) == core::cmp::Ordering::Equal {
+                    continue;
+                }
+            }
+            prev = Some(rec);
+        }
+        out.line(key::line(data, rec));
+    }
+}
+
+/// Temporary run files; removed when dropped.
+struct Runs {
+    dir: String,
+    paths: Vec<String>,
+    counter: u32,
+}
+
+impl Runs {
+    /// Create the next run file and return its path and writer.
+    fn create(&mut self) -> Option<(String, Output)> {
+        let path = format!("{}/sort.{}.{}", self.dir.trim_end_matches('/'), anyos_std::process::getpid(), self.counter);
+        self.counter += 1;
+        let fd = fs::open(&path, fs::O_WRITE | fs::O_CREATE | fs::O_TRUNC);
+        if fd == u32::MAX {
+            anyos_std::println!("sort: cannot create temporary file '{}'", path);
+            return None;
+        }
+        Some((path, Output::new(fd)))
+    }
+
+    /// Close a finished run and remember it.  Returns false on a write error.
+    fn finish(&mut self, path: String, mut out: Output) -> bool {
+        let ok = out.finish();
+        fs::close(out.fd);
+        self.paths.push(path);
+        if !ok {
+            anyos_std::println!("sort: write error on temporary file");
+        }
+        ok
+    }
+
+    /// Merge runs `MERGE_FANIN` at a time until one pass can finish.
+    fn reduce(&mut self, order: &Order, unique: bool) -> bool {
+        while self.paths.len() > MERGE_FANIN {
+            let batch: Vec<String> = self.paths.drain(..MERGE_FANIN).collect();
+            let (path, mut out) = match self.create() {
+                Some(r) => r,
+                None => return false,
+            };
+            let ok = merge::merge(&batch, order, unique, &mut out);
+            for p in &batch {
+                fs::unlink(p);
+            }
+            if !self.finish(path, out) || !ok {
+                return false;
+            }
+        }
+        true
+    }
+}
+
+impl Drop for Runs {
+    fn drop(&mut self) {
+        for p in &self.paths {
+            fs::unlink(p);
+        }
     }
-    (file_buf, total)
 }
 
-fn main() {
+fn main() -> u32 {
     let mut args_buf = [0u8; 256];
     let raw = anyos_std::process::args(&mut args_buf);
-    let args = anyos_std::args::parse(raw, b"");
+    let args = anyos_std::args::parse(raw, b"kStT");
 
-    let reverse = args.has(b'r');
-    let numeric = args.has(b'n');
+    let (key_start, key_end) = match args.opt(b'k') {
+        Some(k) => match parse_key(k) {
+            Some(k) => k,
+            None => {
+                anyos_std::println!("sort: invalid key '{}'", k);
+                return 2;
+            }
+        },
+        None => (0, 0),
+    };
+    let separator = match args.opt(b't') {
+        Some(t) if t.len() == 1 => Some(t.as_bytes()[0]),
+        Some(t) => {
+            anyos_std::println!("sort: separator must be one character: '{}'", t);
+            return 2;
+        }
+        None => None,
+    };
+    let mem_limit = match args.opt(b'S') {
+        Some(s) => match parse_size(s) {
+            Some(n) => n.max(MIN_MEM),
+            None => {
+                anyos_std::println!("sort: invalid buffer size '{}'", s);
+                return 2;
+            }
+        },
+        None => DEFAULT_MEM,
+    };
+    let order = Order {
+        numeric: args.has(b'n'),
+        fold_case: args.has(b'f'),
+        reverse: args.has(b'r'),
+        key_start,
+        key_end,
+        separator,
+    };
     let unique = args.has(b'u');
-    let fold_case = args.has(b'f');
 
-    let fd = if args.pos_count > 0 {
-        let path = args.positional[0];
-        let f = anyos_std::fs::open(path, 0);
+    let mut fds = Vec::new();
+    for i in 0..args.pos_count {
+        let path = args.positional[i];
+        if path == "-" {
+            fds.push(0);
+            continue;
+        }
+        let f = fs::open(path, 0);
         if f == u32::MAX {
             anyos_std::println!("sort: cannot open '{}'", path);
-            return;
+            return 2;
         }
-        f
-    } else {
-        0 // stdin
+        fds.push(f);
+    }
+    if fds.is_empty() {
+        fds.push(0); // stdin
+    }
+    let mut input = Input { fds, next: 0 };
+    let mut runs = Runs {
+        dir: String::from(args.opt(b'T').unwrap_or(DEFAULT_TMP)),
+        paths: Vec::new(),
+        counter: 0,
     };
 
-    let (file_buf, total) = read_all(fd);
-    if fd != 0 { anyos_std::fs::close(fd); }
-
-    let text = core::str::from_utf8(&file_buf[..total]).unwrap_or("");
-    let mut lines: alloc::vec::Vec<&str> = text.lines().collect();
-
-    if numeric {
-        lines.sort_unstable_by(|a, b| {
-            parse_leading_int(a).cmp(&parse_leading_int(b))
-        });
-    } else if fold_case {
-        lines.sort_unstable_by(|a, b| {
-            let ab = a.as_bytes();
-            let bb = b.as_bytes();
-            let min = if ab.len() < bb.len() { ab.len() } else { bb.len() };
-            for i in 0..min {
-                let la = to_lower(ab[i]);
-                let lb = to_lower(bb[i]);
-                if la < lb { return core::cmp::Ordering::Less; }
-                if la > lb { return core::cmp::Ordering::Greater; }
+    let mut data: Vec<u8> = Vec::new();
+    let mut recs: Vec<Rec> = Vec::new();
+    let mut scanned = 0;
+    loop {
+        let more = input.fill(&mut data);
+        while let Some(p) = data[scanned..].iter().position(|&b| b == b'\n') {
+            recs.push(key::make_rec(&data[scanned..scanned + p], scanned, &order));
+            scanned += p + 1;
+        }
+        if !more {
+            break;
+        }
+        let used = data.len() + recs.len() * core::mem::size_of::<Rec>();
+        if used >= mem_limit && !recs.is_empty() {
+            // Chunk full: sort it, spill it and keep only the partial line.
+            anyos_std::pool::par_sort_unstable_by(&mut recs, |a, b| key::cmp_recs(&order, &data, a, &data, b));
+            let (path, mut out) = match runs.create() {
+                Some(r) => r,
+                None => return 2,
+            };
+            emit(&data, &recs, &order, unique, &mut out);
+            if !runs.finish(path, out) || !runs.reduce(&order, unique) {
+                return 2;
             }
-            ab.len().cmp(&bb.len())
-        });
-    } else {
-        lines.sort_unstable();
-    }
-
-    if reverse {
-        lines.reverse();
-    }
-    if unique {
-        lines.dedup();
+            data.drain(..scanned);
+            recs.clear();
+            scanned = 0;
+        }
     }
+    drop(input);
 
-    for line in &lines {
-        anyos_std::println!("{}", line);
+    anyos_std::pool::par_sort_unstable_by(&mut recs, |a, b| key::cmp_recs(&order, &data, a, &data, b));
+    let mut out = Output::new(1);
+    if runs.paths.is_empty() {
+        emit(&data, &recs, &order, unique, &mut out);
+    } else {
+        if !recs.is_empty() {
+            let (path, mut run_out) = match runs.create() {
+                Some(r) => r,
+                None => return 2,
+            };
+            emit(&data, &recs, &order, unique, &mut run_out);
+            if !runs.finish(path, run_out) {
+                return 2;
+            }
+        }
+        drop(recs);
+        drop(data);
+        if !runs.reduce(&order, unique) {
+            return 2;
+        }
+        if !merge::merge(&runs.paths, &order, unique, &mut out) {
+            anyos_std::println!("sort: cannot reopen temporary file");
+            return 2;
+        }
     }
+    if out.finish() { 0 } else { 2 }
 }
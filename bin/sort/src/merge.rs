@@ -0,0 +1,139 @@
+//! K-way merge of sorted runs.
+//!
+//! Every run is read through its own block buffer; a binary heap of run
+//! indices, ordered by each run's current line, yields the next line.
+
+use alloc::vec::Vec;
+use anyos_std::fs;
+use core::cmp::Ordering;
+
+use crate::key::{self, Order, Rec};
+use crate::Output;
+
+const RUN_BUF_SIZE: usize = 32 * 1024;
+
+/// Sequential line reader over one run file.
+struct Run {
+    fd: u32,
+    buf: Vec<u8>,
+    pos: usize,
+    end: usize,
+    /// Current line (without newline) and its key.
+    line: Vec<u8>,
+    rec: Rec,
+}
+
+impl Run {
+    fn open(path: &str) -> Option<Run> {
+        let fd = fs::open(path, 0);
+        if fd == u32::MAX {
+            return None;
+        }
+        let rec = Rec { off: 0, len: 0, key_off: 0, key_len: 0, num: 0 };
+        Some(Run { fd, buf: alloc::vec![0u8; RUN_BUF_SIZE], pos: 0, end: 0, line: Vec::new(), rec })
+    }
+
+    /// Advance to the next line.  Returns false at end of run.
+    fn advance(&mut self, order: &Order) -> bool {
+        self.line.clear();
+        loop {
+            if self.pos == self.end {
+                let n = fs::read(self.fd, &mut self.buf);
+                if n == 0 || n == u32::MAX {
+                    // Runs are written with a newline after every line.
+                    return false;
+                }
+                self.pos = 0;
+                self.end = n as usize;
+            }
+            let avail = &self.buf[self.pos..self.end];
+            match avail.iter().position(|&b| b == b'\n') {
+                Some(p) => {
+                    self.line.extend_from_slice(&avail[..p]);
+                    self.pos += p + 1;
+                    self.rec = key::make_rec(&self.line, 0, order);
+                    return true;
+                }
+                None => {
+                    self.line.extend_from_slice(avail);
+                    self.pos = self.end;
+                }
+            }
+        }
+    }
+}
+
+impl Drop for Run {
+    fn drop(&mut self) {
+        fs::close(self.fd);
+    }
+}
+
+fn less(runs: &[Run], order: &Order, a: usize, b: usize) -> bool {
+    let (ra, rb) = (&runs[a], &runs[b]);
+    key::cmp_recs(order, &ra.line, &ra.rec, &rb.line, &rb.rec) == Ordering::Less
+}
+
+fn sift_down(heap: &mut [usize], runs: &[Run], order: &Order, mut i: usize) {
+    loop {
+        let l = 2 * i + 1;
+        if l >= heap.len() {
+            return;
+        }
+        let r = l + 1;
+        let c = if r < heap.len() && less(runs, order, heap[r], heap[l]) { r } else { l };
+        if !less(runs, order, heap[c], heap[i]) {
+            return;
+        }
+        heap.swap(i, c);
+        i = c;
+    }
+}
+
+/// Merge the sorted run files `paths` into `out`.  With `unique`, only
+/// the first of each group of lines with equal keys is kept.
+/// Returns false if a run could not be opened.
+pub fn merge(paths: &[alloc::string::String], order: &Order, unique: bool, out: &mut Output) -> bool {
+    let mut runs: Vec<Run> = Vec::with_capacity(paths.len());
+    for p in paths {
+        match Run::open(p) {
+            Some(r) => runs.push(r),
+            None => return false,
+        }
+    }
+    let mut heap: Vec<usize> = Vec::with_capacity(runs.len());
+    for i in 0..runs.len() {
+        if runs[i].advance(order) {
+            heap.push(i);
+        }
+    }
+    for i in (0..heap.len() / 2).rev() {
+        sift_down(&mut heap, &runs, order, i);
+    }
+
+    let mut last: Vec<u8> = Vec::new();
+    let mut last_rec: Option<Rec> = None;
+    while !heap.is_empty() {
+        let top = heap[0];
+        let run = &runs[top];
+        let dup = unique && match &last_rec {
+            Some(lr) => key::cmp_keys(order, &last, lr, &run.line, &run.rec) == Ordering::Equal,
+            None => false,
+        };
+        if !dup {
+            out.line(&run.line);
+            if unique {
+                last.clear();
+                last.extend_from_slice(&run.line);
+                last_rec = Some(run.rec);
+            }
+        }
+        if !runs[top].advance(order) {
+            let tail = heap.len() - 1;
+            heap.swap(0, tail);
+            heap.pop();
+        }
+        sift_down(&mut heap, &runs, order, 0);
+    }
+    true
+}
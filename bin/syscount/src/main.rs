@@ -0,0 +1,174 @@
+#![no_std]
+#![no_main]
+
+use anyos_std::format;
+use anyos_std::String;
+use anyos_std::Vec;
+use anyos_std::debug::{self, SyscallStat, SyscallStats};
+use anyos_std::{fs, process};
+
+anyos_std::entry!(main);
+
+fn usage() {
+    anyos_std::println!("Usage: syscount <command> [args...]   run command, show its syscalls");
+    anyos_std::println!("       syscount on | off | reset        control system-wide recording");
+    anyos_std::println!("       syscount [-s]                    per-syscall table since reset");
+    anyos_std::println!("       syscount -p                      per-thread totals since reset");
+}
+
+/// Resolve a command name via PATH, falling back to /System/bin.
+fn resolve_command(cmd: &str) -> String {
+    if cmd.starts_with('/') {
+        return String::from(cmd);
+    }
+    let mut path_buf = [0u8; 256];
+    let len = anyos_std::env::get("PATH", &mut path_buf);
+    if len != u32::MAX {
+        if let Ok(path_str) = core::str::from_utf8(&path_buf[..len as usize]) {
+            let mut stat_buf = [0u32; 7];
+            for dir in path_str.split(':') {
+                let dir = dir.trim();
+                if dir.is_empty() { continue; }
+                let candidate = format!("{}/{}", dir, cmd);
+                if fs::stat(&candidate, &mut stat_buf) == 0 && stat_buf[0] == 0 {
+                    return candidate;
+                }
+            }
+        }
+    }
+    format!("/System/bin/{}", cmd)
+}
+
+/// Cycles to microseconds.
+fn cycles_us(cycles: u64, hz: u64) -> u64 {
+    if hz == 0 { return 0; }
+    (cycles as u128 * 1_000_000 / hz as u128) as u64
+}
+
+/// Smallest histogram bucket below which `pct` percent of calls fall,
+/// returned as the bucket's upper bound in cycles.
+fn percentile_cycles(stat: &SyscallStat, pct: u64) -> u64 {
+    let target = (stat.calls * pct + 99) / 100;
+    let mut seen = 0u64;
+    for (i, &n) in stat.hist.iter().enumerate() {
+        seen += n as u64;
+        if seen >= target {
+            return 1u64 << (i + 1);
+        }
+    }
+    1u64 << stat.hist.len()
+}
+
+fn print_syscalls(stats: &SyscallStats) {
+    let mut rows: Vec<&SyscallStat> = stats.syscalls.iter().collect();
+    rows.sort_unstable_by(|a, b| b.cycles.cmp(&a.cycles));
+    let total: u64 = rows.iter().map(|s| s.cycles).sum();
+    let total_calls: u64 = rows.iter().map(|s| s.calls).sum();
+    let hz = stats.cycle_hz;
+
+    anyos_std::println!("{:>6} {:>12} {:>10} {:>9} {:>9} {:>9}  {}",
+        "% time", "usecs", "calls", "us/call", "p50 us", "p99 us", "syscall");
+    anyos_std::println!("{}", "-------------------------------------------------------------------------");
+    for s in &rows {
+        let pct10 = if total > 0 { s.cycles * 1000 / total } else { 0 };
+        let name = s.name_str();
+        let label = if name == "unknown" { format!("#{}", s.num) } else { String::from(name) };
+        anyos_std::println!("{:>4}.{} {:>12} {:>10} {:>9} {:>9} {:>9}  {}",
+            pct10 / 10, pct10 % 10,
+            cycles_us(s.cycles, hz),
+            s.calls,
+            cycles_us(s.cycles / s.calls.max(1), hz),
+            cycles_us(percentile_cycles(s, 50), hz),
+            cycles_us(percentile_cycles(s, 99), hz),
+            label);
+    }
+    anyos_std::println!("{}", "-------------------------------------------------------------------------");
+    anyos_std::println!("100.0 {:>12} {:>10} {:>9} {:>9} {:>9}  total",
+        cycles_us(total, hz), total_calls, "", "", "");
+}
+
+/// Thread names by TID (sysinfo cmd=1, 60-byte entries, name at offset 8).
+fn thread_names() -> Vec<(u32, String)> {
+    let mut buf = anyos_std::vec![0u8; 60 * 256];
+    let count = anyos_std::sys::sysinfo(1, &mut buf);
+    let mut out = Vec::new();
+    if count == u32::MAX {
+        return out;
+    }
+    for i in 0..(count as usize).min(256) {
+        let off = i * 60;
+        let tid = u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]]);
+        let name = &buf[off + 8..off + 32];
+        let len = name.iter().position(|&b| b == 0).unwrap_or(24);
+        out.push((tid, String::from(core::str::from_utf8(&name[..len]).unwrap_or("???"))));
+    }
+    out
+}
+
+fn print_threads(stats: &SyscallStats) {
+    let names = thread_names();
+    let mut rows: Vec<_> = stats.threads.iter().collect();
+    rows.sort_unstable_by(|a, b| b.cycles.cmp(&a.cycles));
+    anyos_std::println!("{:<6} {:>10} {:>12} {:>9}  {}", "TID", "calls", "usecs", "us/call", "NAME");
+    anyos_std::println!("{}", "------------------------------------------------------");
+    for t in rows {
+        let name = names.iter().find(|(tid, _)| *tid == t.tid).map(|(_, n)| n.as_str()).unwrap_or("(exited)");
+        anyos_std::println!("{:<6} {:>10} {:>12} {:>9}  {}",
+            t.tid, t.calls,
+            cycles_us(t.cycles, stats.cycle_hz),
+            cycles_us(t.cycles / t.calls.max(1), stats.cycle_hz),
+            name);
+    }
+}
+
+fn main() {
+    let mut args_buf = [0u8; 256];
+    let args = process::args(&mut args_buf).trim();
+    let first = args.split_whitespace().next().unwrap_or("");
+
+    match first {
+        "-h" | "--help" => usage(),
+        "on" => {
+            debug::syscall_stats(debug::SYSCALL_STATS_ENABLE | debug::SYSCALL_STATS_FILTER, 0);
+            anyos_std::println!("syscount: recording all syscalls");
+        }
+        "off" => {
+            debug::syscall_stats(debug::SYSCALL_STATS_DISABLE, 0);
+            anyos_std::println!("syscount: recording stopped");
+        }
+        "reset" => {
+            debug::syscall_stats(debug::SYSCALL_STATS_RESET, 0);
+        }
+        "" | "-s" | "-p" => {
+            let stats = debug::syscall_stats(0, 0);
+            if !stats.enabled && stats.syscalls.is_empty() {
+                anyos_std::println!("syscount: recording is off (start it with 'syscount on')");
+                return;
+            }
+            if first == "-p" { print_threads(&stats) } else { print_syscalls(&stats) }
+        }
+        cmd => {
+            // Record only the child: enabling before the spawn and filtering
+            // right after means the first few syscalls may be attributed to
+            // whichever thread ran in between.
+            let was_enabled = debug::syscall_stats(0, 0).enabled;
+            debug::syscall_stats(debug::SYSCALL_STATS_RESET | debug::SYSCALL_STATS_ENABLE, 0);
+            let path = resolve_command(cmd);
+            let tid = process::spawn(&path, args);
+            if tid == u32::MAX {
+                debug::syscall_stats(debug::SYSCALL_STATS_FILTER
+                    | if was_enabled { 0 } else { debug::SYSCALL_STATS_DISABLE }, 0);
+                anyos_std::println!("syscount: cannot run '{}'", cmd);
+                return;
+            }
+            debug::syscall_stats(debug::SYSCALL_STATS_FILTER, tid);
+            process::waitpid(tid);
+            let stats = debug::syscall_stats(
+                debug::SYSCALL_STATS_FILTER | if was_enabled { 0 } else { debug::SYSCALL_STATS_DISABLE },
+                0,
+            );
+            anyos_std::println!("");
+            print_syscalls(&stats);
+        }
+    }
+}
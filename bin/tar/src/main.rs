@@ -2,7 +2,7 @@
 #![no_main]
 
 use alloc::format;
-use alloc::string::String;
+use libzip_client::{TarStream, TarStreamWriter};
 
 anyos_std::entry!(main);
 
@@ -37,24 +37,20 @@ fn basename(path: &str) -> &str {
     }
 }
 
-/// Add a file to the tar writer.
-fn add_file(writer: &libzip_client::TarWriter, path: &str, archive_name: &str) {
-    match anyos_std::fs::read_to_vec(path) {
-        Ok(data) => {
-            if writer.add_file(archive_name, &data) {
-                anyos_std::println!("a {}", archive_name);
-            } else {
-                anyos_std::println!("tar: error adding '{}'", archive_name);
-            }
-        }
-        Err(_) => {
-            anyos_std::println!("tar: cannot read '{}'", path);
-        }
+/// Compression level of `-z` archives.
+const GZIP_LEVEL: u32 = 6;
+
+/// Add a file to the tar writer; its data is streamed from disk.
+fn add_file(writer: &TarStreamWriter, path: &str, archive_name: &str) {
+    if writer.add_file(archive_name, path) {
+        anyos_std::println!("a {}", archive_name);
+    } else {
+        anyos_std::println!("tar: error adding '{}'", archive_name);
     }
 }
 
 /// Add a directory recursively.
-fn add_dir_recursive(writer: &libzip_client::TarWriter, path: &str, prefix: &str) {
+fn add_dir_recursive(writer: &TarStreamWriter, path: &str, prefix: &str) {
     let dir_name = if prefix.is_empty() {
         format!("{}/", basename(path))
     } else {
@@ -108,11 +104,12 @@ fn main() {
     };
 
     if create {
-        // Create archive
-        let writer = match libzip_client::TarWriter::new() {
+        // Create archive, written out as entries are added
+        let level = if gzip { GZIP_LEVEL } else { 0 };
+        let writer = match TarStreamWriter::create(archive_path, level) {
             Some(w) => w,
             None => {
-                anyos_std::println!("tar: failed to create archive");
+                anyos_std::println!("tar: cannot create '{}'", archive_path);
                 return;
             }
         };
@@ -129,62 +126,59 @@ fn main() {
             }
         }
 
-        if writer.write_to_file(archive_path, gzip) {
+        if writer.finish() {
             anyos_std::println!("tar: created '{}'", archive_path);
         } else {
             anyos_std::println!("tar: failed to write '{}'", archive_path);
         }
     } else {
-        // List or extract — open archive
-        let reader = match libzip_client::TarReader::open(archive_path) {
-            Some(r) => r,
+        // List or extract, one entry at a time as the archive streams by
+        let mut stream = match TarStream::open(archive_path) {
+            Some(s) => s,
             None => {
                 anyos_std::println!("tar: cannot open '{}'", archive_path);
                 return;
             }
         };
 
-        let count = reader.entry_count();
+        let mut extracted = 0u32;
+        let mut errors = 0u32;
+        loop {
+            let entry = match stream.next_entry() {
+                Ok(Some(e)) => e,
+                Ok(None) => break,
+                Err(()) => {
+                    anyos_std::println!("tar: '{}': corrupt or truncated archive", archive_path);
+                    errors += 1;
+                    break;
+                }
+            };
+            let name = &entry.name;
 
-        if list {
-            for i in 0..count {
-                let name = reader.entry_name(i);
-                let size = reader.entry_size(i);
-                let is_dir = reader.entry_is_dir(i);
-                if is_dir {
+            if list {
+                if entry.is_dir {
                     anyos_std::println!("drwxr-xr-x  0 {}", name);
                 } else {
-                    anyos_std::println!("-rw-r--r--  {} {}", size, name);
+                    anyos_std::println!("-rw-r--r--  {} {}", entry.size, name);
                 }
-            }
-        } else {
-            // Extract
-            let mut extracted = 0u32;
-            let mut errors = 0u32;
-
-            for i in 0..count {
-                let name = reader.entry_name(i);
-                let is_dir = reader.entry_is_dir(i);
-
-                if is_dir {
-                    anyos_std::println!("x {}", name);
-                    ensure_parent_dirs(&name);
-                    anyos_std::fs::mkdir(&name);
+            } else if entry.is_dir {
+                anyos_std::println!("x {}", name);
+                ensure_parent_dirs(name);
+                anyos_std::fs::mkdir(name);
+            } else {
+                anyos_std::println!("x {}", name);
+                ensure_parent_dirs(name);
+                if stream.extract_to_file(name) {
+                    extracted += 1;
                 } else {
-                    anyos_std::println!("x {}", name);
-                    ensure_parent_dirs(&name);
-                    if reader.extract_to_file(i, &name) {
-                        extracted += 1;
-                    } else {
-                        anyos_std::println!("tar: error extracting '{}'", name);
-                        errors += 1;
-                    }
+                    anyos_std::println!("tar: error extracting '{}'", name);
+                    errors += 1;
                 }
             }
+        }
 
-            if errors > 0 {
-                anyos_std::println!("tar: {} extracted, {} errors", extracted, errors);
-            }
+        if errors > 0 && extract {
+            anyos_std::println!("tar: {} extracted, {} errors", extracted, errors);
         }
     }
 }
@@ -18,7 +18,8 @@
 //! | 16     | 4    | vm_state (0=stopped, 1=running, 2=halted, 3=error) |
 //! | 20     | 4    | instruction_count low 32 bits |
 //! | 24     | 4    | instruction_count high 32 bits |
-//! | 28     | 36   | reserved |
+//! | 28     | 4    | decoded-block cache hit rate, in tenths of a percent |
+//! | 32     | 32   | reserved |
 //! | 64     | ...  | payload (text: 80*25*2 bytes, gfx: w*h*bpp/8 bytes) |
 
 #![no_std]
@@ -133,6 +134,8 @@ fn update_shm_framebuffer(inst: &VmInstance) {
     }
 
     let icount = inst.handle.instruction_count();
+    let icache_permille = inst.handle.icache_stats().hit_permille();
+    unsafe { shm_write_u32(inst.shm_ptr, 28, icache_permille); }
 
     // Try text mode first.
     if let Some(text_buf) = inst.handle.vga_text_buffer() {
@@ -264,7 +267,11 @@ const VMS_DIR: &str = "/System/shared/vmmanager/vms";
 struct VmConfigInfo {
     name: String,
     ram_mb: u32,
+    cpus: u32,
     disk_image: String,
+    /// Attach the disk as a virtio block device (`disk_bus=virtio`)
+    /// instead of on the IDE controller.
+    disk_virtio: bool,
     iso_image: String,
 }
 
@@ -307,7 +314,9 @@ fn read_vm_config(uuid: &str) -> Option<VmConfigInfo> {
     let text = core::str::from_utf8(&data).unwrap_or("");
     let mut name = String::new();
     let mut ram_mb: u32 = 64;
+    let mut cpus: u32 = 1;
     let mut disk_image = String::new();
+    let mut disk_virtio = false;
     let mut iso_image = String::new();
 
     for line in text.split('\n') {
@@ -322,8 +331,12 @@ fn read_vm_config(uuid: &str) -> Option<VmConfigInfo> {
             if ram_mb == 0 {
                 ram_mb = 64;
             }
+        } else if let Some(val) = line.strip_prefix("cpus=") {
+            cpus = parse_u32(val).max(1);
         } else if let Some(val) = line.strip_prefix("disk=") {
             disk_image = String::from(val);
+        } else if let Some(val) = line.strip_prefix("disk_bus=") {
+            disk_virtio = val == "virtio";
         } else if let Some(val) = line.strip_prefix("iso=") {
             iso_image = String::from(val);
         }
@@ -336,7 +349,9 @@ fn read_vm_config(uuid: &str) -> Option<VmConfigInfo> {
     Some(VmConfigInfo {
         name,
         ram_mb,
+        cpus,
         disk_image,
+        disk_virtio,
         iso_image,
     })
 }
@@ -381,6 +396,12 @@ fn cmd_create(uuid: &str) {
     // Set up standard PC devices.
     handle.setup_standard_devices();
     handle.setup_ide();
+    if config.disk_virtio {
+        handle.setup_virtio_blk();
+    }
+    if config.cpus > 1 {
+        handle.setup_smp(config.cpus);
+    }
 
     // Create shared memory for VGA framebuffer.
     let shm_id = ipc::shm_create(SHM_SIZE);
@@ -407,10 +428,21 @@ fn cmd_create(uuid: &str) {
     // Report success with SHM ID BEFORE loading disk/ISO.
     // vmmanager needs the SHM ID promptly; disk/ISO loading can be slow.
     send_status(&format!("created 0 {}", shm_id));
-    anyos_std::println!("[vmd] VM '{}' created ({} MiB RAM, shm={})", config.name, config.ram_mb, shm_id);
-
-    // Attach disk image if configured.
-    if !config.disk_image.is_empty() {
+    anyos_std::println!(
+        "[vmd] VM '{}' created ({} MiB RAM, {} vCPU, shm={})",
+        config.name, config.ram_mb, config.cpus, shm_id
+    );
+
+    // Attach disk image if configured. A virtio disk is used in place
+    // from the file; an IDE disk is loaded into memory.
+    if !config.disk_image.is_empty() && config.disk_virtio {
+        let ok = d.vm.as_ref().map_or(false, |inst| inst.handle.virtio_blk_attach_file(&config.disk_image));
+        if ok {
+            anyos_std::println!("[vmd] attached virtio disk: {}", config.disk_image);
+        } else {
+            send_status(&format!("error 0 failed to open disk image: {}", config.disk_image));
+        }
+    } else if !config.disk_image.is_empty() {
         let data = read_file(&config.disk_image);
         if !data.is_empty() {
             if let Some(ref inst) = d.vm {
@@ -522,6 +554,36 @@ fn cmd_mouse(dx: i16, dy: i16, buttons: u8) {
     }
 }
 
+/// Handle `snapshot <path> [inc]` command — save the VM's state between
+/// batches. With `inc`, only RAM changed since the last snapshot is written.
+fn cmd_snapshot(path: &str, incremental: bool) {
+    let d = daemon();
+    if let Some(ref inst) = d.vm {
+        if inst.handle.snapshot_save(path, incremental) {
+            send_status(&format!("snapshot 0 {}", path));
+            anyos_std::println!("[vmd] VM '{}' saved to {}", inst.name, path);
+        } else {
+            send_status(&format!("error 0 failed to save snapshot: {}", path));
+        }
+    }
+}
+
+/// Handle `restore <path>` command — replace the VM's state with a
+/// snapshot and resume it where it was saved (the BIOS is not reloaded).
+fn cmd_restore(path: &str) {
+    let d = daemon();
+    if let Some(ref mut inst) = d.vm {
+        if !inst.handle.snapshot_restore(path) {
+            send_status(&format!("error 0 failed to restore snapshot: {}", path));
+            return;
+        }
+        inst.running = true;
+        update_shm_state(inst, STATE_RUNNING);
+        send_status("state 0 running");
+        anyos_std::println!("[vmd] VM '{}' restored from {}", inst.name, path);
+    }
+}
+
 // ── Command dispatch ───────────────────────────────────────────────────
 
 /// Parse and execute a single command line.
@@ -550,6 +612,16 @@ fn dispatch_command(line: &str) {
             d.vm = None;
             send_status("state 0 destroyed");
         }
+        "snapshot" => {
+            if parts.len() >= 2 {
+                cmd_snapshot(parts[1], parts.get(2) == Some(&"inc"));
+            }
+        }
+        "restore" => {
+            if parts.len() >= 2 {
+                cmd_restore(parts[1]);
+            }
+        }
         "key" => {
             if parts.len() >= 2 {
                 let sc = parse_u32(parts[1]) as u8;
@@ -603,6 +675,13 @@ fn run_vm_batch() -> bool {
     // Execute instructions.
     let exit = inst.handle.run(BATCH_SIZE);
 
+    // Deliver interrupts raised by the virtio devices during the batch.
+    let mut lines = inst.handle.virtio_take_irqs();
+    while lines != 0 {
+        inst.handle.pic_raise_irq(lines.trailing_zeros() as u8);
+        lines &= lines - 1;
+    }
+
     match exit {
         ExitReason::Halted => {
             // HLT pauses until the next interrupt — deliver a PIT tick
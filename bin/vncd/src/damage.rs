@@ -0,0 +1,173 @@
+//! Compositor damage map client.
+//!
+//! The compositor publishes, for every 64×64 screen tile, the sequence
+//! number of the last frame that changed it (`CMD_SET_DAMAGE_MAP`).
+//! `send_dirty_update` only compares the RFB tiles covered by changed
+//! compositor tiles instead of the whole screen.
+//!
+//! Map layout (u32 words): `[tile_size, cols, rows, frame_seq,
+//! move_seq, layer_id, x, y, width, height, old_x, old_y, tile_seq...]`.
+//! The compositor writes `frame_seq` last, so every tile changed up to that
+//! frame is visible once it has been read.  The move words describe the last
+//! window move; `take_move` turns it into a CopyRect candidate.
+
+use anyos_std::ipc;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// Attach/detach a damage map: [CMD, shm_id, size_words (0 = detach), 0, 0]
+/// (mirrors compositor/src/ipc_protocol.rs).
+pub const CMD_SET_DAMAGE_MAP: u32 = 0x1018;
+
+/// Compositor damage tile edge in pixels.
+pub const MAP_TILE_SIZE: usize = 64;
+
+const HEADER_WORDS: usize = 12;
+
+/// Word index of the move record.
+const MOVE_WORD: usize = 4;
+
+/// A window move since the previous scan: the `w`×`h` pixels at
+/// `src_x, src_y` (as the client last saw them) are now at `dst_x, dst_y`.
+pub struct Move {
+    pub src_x: i32,
+    pub src_y: i32,
+    pub dst_x: i32,
+    pub dst_y: i32,
+    pub w: usize,
+    pub h: usize,
+}
+
+/// A damage map shared with the compositor for the session's lifetime.
+pub struct DamageMap {
+    comp_chan: u32,
+    shm_id: u32,
+    base: *const u32,
+    cols: usize,
+    rows: usize,
+    /// The compositor has been seen publishing into this map and one full
+    /// comparison was made afterwards; before that every tile is compared.
+    synced: bool,
+    /// `frame_seq` at the start of the last scan.
+    last_seq: u32,
+    /// Layer id and position of the last move record seen.
+    last_move: Option<(u32, i32, i32)>,
+}
+
+impl DamageMap {
+    /// Create a map for a `sw`×`sh` screen and register it with the compositor.
+    pub fn attach(comp_chan: u32, sw: usize, sh: usize) -> Option<Self> {
+        let cols = (sw + MAP_TILE_SIZE - 1) / MAP_TILE_SIZE;
+        let rows = (sh + MAP_TILE_SIZE - 1) / MAP_TILE_SIZE;
+        let words = HEADER_WORDS + cols * rows;
+        let shm_id = ipc::shm_create((words * 4) as u32);
+        if shm_id == 0 {
+            return None;
+        }
+        let addr = ipc::shm_map(shm_id);
+        if addr == 0 {
+            ipc::shm_destroy(shm_id);
+            return None;
+        }
+        ipc::evt_chan_emit(comp_chan, &[CMD_SET_DAMAGE_MAP, shm_id, words as u32, 0, 0]);
+        Some(DamageMap {
+            comp_chan,
+            shm_id,
+            base: addr as usize as *const u32,
+            cols,
+            rows,
+            synced: false,
+            last_seq: 0,
+            last_move: None,
+        })
+    }
+
+    fn word(&self, i: usize) -> u32 {
+        unsafe { self.base.add(i).read_volatile() }
+    }
+
+    /// Start a scan.  Returns the frame sequence to pass to [`end_scan`], or
+    /// `None` if every tile must be compared this time (map not yet written
+    /// by the compositor, resolution mismatch, or first scan after sync).
+    ///
+    /// [`end_scan`]: DamageMap::end_scan
+    pub fn begin_scan(&mut self) -> Option<u32> {
+        let valid = self.word(0) as usize == MAP_TILE_SIZE
+            && self.word(1) as usize == self.cols
+            && self.word(2) as usize == self.rows;
+        if !valid {
+            self.synced = false;
+            return None;
+        }
+        let seq = unsafe { (*(self.base.add(3) as *const AtomicU32)).load(Ordering::Acquire) };
+        if !self.synced {
+            // Bring prev up to date with a full comparison; from now on every
+            // change is published.
+            self.synced = true;
+            self.last_seq = seq;
+            return None;
+        }
+        Some(seq)
+    }
+
+    /// Whether the pixel rect `x, y, w, h` overlaps a tile changed since the
+    /// previous scan.
+    pub fn changed(&self, x: usize, y: usize, w: usize, h: usize) -> bool {
+        let tx1 = (x + w - 1) / MAP_TILE_SIZE;
+        let ty1 = (y + h - 1) / MAP_TILE_SIZE;
+        for ty in y / MAP_TILE_SIZE..=ty1.min(self.rows - 1) {
+            for tx in x / MAP_TILE_SIZE..=tx1.min(self.cols - 1) {
+                let s = self.word(HEADER_WORDS + ty * self.cols + tx);
+                if s.wrapping_sub(self.last_seq) as i32 > 0 {
+                    return true;
+                }
+            }
+        }
+        false
+    }
+
+    /// The window move published since the previous scan, if any.  Call
+    /// between [`begin_scan`] and [`end_scan`] with the same `seq`.
+    ///
+    /// The source is where this session last saw the layer, so several
+    /// compositor frames of one drag between two scans combine into one move.
+    ///
+    /// [`begin_scan`]: DamageMap::begin_scan
+    /// [`end_scan`]: DamageMap::end_scan
+    pub fn take_move(&mut self, seq: u32) -> Option<Move> {
+        let move_seq = self.word(MOVE_WORD);
+        if move_seq.wrapping_sub(self.last_seq) as i32 <= 0 || move_seq.wrapping_sub(seq) as i32 > 0 {
+            return None;
+        }
+        let mut r = [0u32; 7];
+        for (i, w) in r.iter_mut().enumerate() {
+            *w = self.word(MOVE_WORD + 1 + i);
+        }
+        if self.word(MOVE_WORD) != move_seq {
+            return None; // rewritten while reading; seen next scan
+        }
+        let [layer, x, y, w, h, old_x, old_y] = r;
+        let (x, y) = (x as i32, y as i32);
+        let (src_x, src_y) = match self.last_move {
+            Some((id, lx, ly)) if id == layer => (lx, ly),
+            _ => (old_x as i32, old_y as i32),
+        };
+        self.last_move = Some((layer, x, y));
+        if (src_x, src_y) == (x, y) {
+            return None;
+        }
+        Some(Move { src_x, src_y, dst_x: x, dst_y: y, w: w as usize, h: h as usize })
+    }
+
+    /// Finish a scan started with `seq`.
+    pub fn end_scan(&mut self, seq: u32) {
+        self.last_seq = seq;
+    }
+}
+
+impl Drop for DamageMap {
+    fn drop(&mut self) {
+        ipc::evt_chan_emit(self.comp_chan, &[CMD_SET_DAMAGE_MAP, self.shm_id, 0, 0, 0]);
+        ipc::shm_unmap(self.shm_id);
+        ipc::shm_destroy(self.shm_id);
+    }
+}
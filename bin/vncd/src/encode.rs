@@ -0,0 +1,440 @@
+//! Rectangle encoders for FramebufferUpdate messages.
+//!
+//! Every changed rect is sent with the cheapest encoding the client announced
+//! in SetEncodings:
+//!
+//! - **Solid** rects: Tight fill (14 bytes) or RRE with no subrects (20 bytes).
+//! - **Photo-like** rects (most pixels differ from their left neighbour):
+//!   Tight/JPEG via `libimage`, if the client sent a JPEG quality level.
+//! - **Everything else**: ZRLE — 64×64 subtiles coded as solid, packed
+//!   palette, plain RLE or palette RLE (whichever is smallest), compressed
+//!   with one zlib stream for the whole session via `libzip`.
+//! - Raw when the client supports none of the above or an encoder fails.
+//!
+//! Pixels are ARGB8888 little-endian (the server pixel format), so a ZRLE
+//! CPIXEL is the low three bytes of a pixel and a Tight TPIXEL is R, G, B.
+
+use anyos_std::Vec;
+
+// ── Encoding numbers ──────────────────────────────────────────────────────────
+
+const ENC_RAW: i32 = 0;
+pub const ENC_COPY_RECT: i32 = 1;
+const ENC_RRE: i32 = 2;
+const ENC_TIGHT: i32 = 7;
+const ENC_ZRLE: i32 = 16;
+/// Pseudo-encodings -32..=-23: JPEG quality level 0..=9.
+const ENC_QUALITY_LEVEL_0: i32 = -32;
+/// Pseudo-encodings -256..=-247: compression level 0..=9.
+const ENC_COMPRESS_LEVEL_0: i32 = -256;
+
+/// ZRLE subtile edge (fixed by the protocol).
+const ZRLE_TILE: usize = 64;
+
+/// Largest palette a ZRLE palette-RLE subtile can carry.
+const ZRLE_MAX_PALETTE: usize = 127;
+
+/// zlib stream header (deflate, 32 KiB window, fastest level).
+const ZLIB_HEADER: [u8; 2] = [0x78, 0x01];
+
+/// Smallest rect worth a JPEG: below this the ~620 header bytes dominate.
+const JPEG_MIN_PIXELS: usize = 64 * 32;
+
+/// Share (in percent) of pixels differing from their left neighbour above
+/// which a rect counts as photo-like.
+const PHOTO_CHANGE_PERCENT: usize = 60;
+
+/// Largest value a Tight compact length can carry.
+const TIGHT_MAX_LEN: usize = (1 << 22) - 1;
+
+// ── Helpers ───────────────────────────────────────────────────────────────────
+
+/// Append an RFB rectangle header.
+pub fn push_rect_header(out: &mut Vec<u8>, x: usize, y: usize, w: usize, h: usize, encoding: i32) {
+    out.extend_from_slice(&(x as u16).to_be_bytes());
+    out.extend_from_slice(&(y as u16).to_be_bytes());
+    out.extend_from_slice(&(w as u16).to_be_bytes());
+    out.extend_from_slice(&(h as u16).to_be_bytes());
+    out.extend_from_slice(&encoding.to_be_bytes());
+}
+
+/// Check if every pixel in a rect is the same solid color.
+/// Returns Some(color) if solid, None if mixed.
+fn solid_color(fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize) -> Option<u32> {
+    let first = fb[y * stride + x];
+    for row in y..y + h {
+        let off = row * stride + x;
+        if fb[off..off + w].iter().any(|&p| p != first) {
+            return None;
+        }
+    }
+    Some(first)
+}
+
+/// Whether a rect looks like a photo or gradient rather than UI or text,
+/// judged on every fourth row.
+fn is_photo_like(fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize) -> bool {
+    if w * h < JPEG_MIN_PIXELS || w < 2 {
+        return false;
+    }
+    let mut changes = 0usize;
+    let mut samples = 0usize;
+    for row in (y..y + h).step_by(4) {
+        let line = &fb[row * stride + x..][..w];
+        changes += line.windows(2).filter(|p| p[0] != p[1]).count();
+        samples += w - 1;
+    }
+    changes * 100 > samples * PHOTO_CHANGE_PERCENT
+}
+
+/// Append a ZRLE CPIXEL (blue, green, red).
+fn push_cpixel(out: &mut Vec<u8>, c: u32) {
+    out.extend_from_slice(&c.to_le_bytes()[..3]);
+}
+
+/// Append a ZRLE run length: `len - 1` as 255-bytes plus a final byte.
+fn push_run_len(out: &mut Vec<u8>, len: usize) {
+    let mut n = len - 1;
+    while n >= 255 {
+        out.push(255);
+        n -= 255;
+    }
+    out.push(n as u8);
+}
+
+/// Bytes taken by a ZRLE run length.
+fn run_len_bytes(len: usize) -> usize {
+    (len - 1) / 255 + 1
+}
+
+/// Call `f(color, length)` for each run of equal pixels in a rect, scanning
+/// rows left to right and top to bottom (runs continue across rows).
+fn for_each_run(fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize,
+                mut f: impl FnMut(u32, usize)) {
+    let mut cur = fb[y * stride + x] & 0x00FF_FFFF;
+    let mut len = 0usize;
+    for row in y..y + h {
+        for &p in &fb[row * stride + x..][..w] {
+            let p = p & 0x00FF_FFFF;
+            if p == cur {
+                len += 1;
+            } else {
+                f(cur, len);
+                cur = p;
+                len = 1;
+            }
+        }
+    }
+    f(cur, len);
+}
+
+// ── ZRLE palette ──────────────────────────────────────────────────────────────
+
+/// Open-addressed color → palette index map for one ZRLE subtile.
+struct Palette {
+    keys: [u32; 256],
+    index: [u8; 256],
+    colors: [u32; ZRLE_MAX_PALETTE],
+    len: usize,
+}
+
+const PALETTE_EMPTY: u32 = u32::MAX;
+
+impl Palette {
+    fn new() -> Self {
+        Palette {
+            keys: [PALETTE_EMPTY; 256],
+            index: [0; 256],
+            colors: [0; ZRLE_MAX_PALETTE],
+            len: 0,
+        }
+    }
+
+    fn clear(&mut self) {
+        self.keys = [PALETTE_EMPTY; 256];
+        self.len = 0;
+    }
+
+    fn slot(&self, c: u32) -> usize {
+        let mut i = (c.wrapping_mul(0x9E37_79B1) >> 24) as usize;
+        while self.keys[i] != PALETTE_EMPTY && self.keys[i] != c {
+            i = (i + 1) & 255;
+        }
+        i
+    }
+
+    /// Add `c`; false once the palette is full.
+    fn insert(&mut self, c: u32) -> bool {
+        let i = self.slot(c);
+        if self.keys[i] == c {
+            return true;
+        }
+        if self.len == ZRLE_MAX_PALETTE {
+            return false;
+        }
+        self.keys[i] = c;
+        self.index[i] = self.len as u8;
+        self.colors[self.len] = c;
+        self.len += 1;
+        true
+    }
+
+    fn lookup(&self, c: u32) -> u8 {
+        self.index[self.slot(c)]
+    }
+}
+
+/// Append one ZRLE subtile, choosing its smallest subencoding.
+fn zrle_tile(out: &mut Vec<u8>, fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize,
+             pal: &mut Palette) {
+    pal.clear();
+    let mut pal_ok = true;
+    let mut rle = 0usize;
+    let mut palette_rle = 0usize;
+    for_each_run(fb, stride, x, y, w, h, |c, len| {
+        pal_ok = pal_ok && pal.insert(c);
+        rle += 3 + run_len_bytes(len);
+        palette_rle += if len == 1 { 1 } else { 1 + run_len_bytes(len) };
+    });
+
+    if pal_ok && pal.len == 1 {
+        out.push(1);
+        push_cpixel(out, pal.colors[0]);
+        return;
+    }
+
+    // (subencoding, size); raw CPIXELs are the baseline.
+    let mut best = (0u8, w * h * 3);
+    if pal_ok && pal.len <= 16 {
+        let bits = match pal.len { 2 => 1, 3..=4 => 2, _ => 4 };
+        let packed = pal.len * 3 + h * ((w * bits + 7) / 8);
+        if packed < best.1 {
+            best = (pal.len as u8, packed);
+        }
+    }
+    if rle < best.1 {
+        best = (128, rle);
+    }
+    if pal_ok && pal.len * 3 + palette_rle < best.1 {
+        best = (128 + pal.len as u8, pal.len * 3 + palette_rle);
+    }
+
+    out.push(best.0);
+    match best.0 {
+        0 => {
+            for row in y..y + h {
+                for &p in &fb[row * stride + x..][..w] {
+                    push_cpixel(out, p);
+                }
+            }
+        }
+        128 => for_each_run(fb, stride, x, y, w, h, |c, len| {
+            push_cpixel(out, c);
+            push_run_len(out, len);
+        }),
+        n if n > 128 => {
+            for &c in &pal.colors[..pal.len] {
+                push_cpixel(out, c);
+            }
+            for_each_run(fb, stride, x, y, w, h, |c, len| {
+                let i = pal.lookup(c);
+                if len == 1 {
+                    out.push(i);
+                } else {
+                    out.push(i | 128);
+                    push_run_len(out, len);
+                }
+            });
+        }
+        _ => {
+            for &c in &pal.colors[..pal.len] {
+                push_cpixel(out, c);
+            }
+            let bits = match pal.len { 2 => 1, 3..=4 => 2, _ => 4 };
+            for row in y..y + h {
+                let mut acc = 0u8;
+                let mut used = 0;
+                for &p in &fb[row * stride + x..][..w] {
+                    acc = (acc << bits) | pal.lookup(p & 0x00FF_FFFF);
+                    used += bits;
+                    if used == 8 {
+                        out.push(acc);
+                        acc = 0;
+                        used = 0;
+                    }
+                }
+                if used > 0 {
+                    out.push(acc << (8 - used));
+                }
+            }
+        }
+    }
+}
+
+// ── Encoder ───────────────────────────────────────────────────────────────────
+
+/// Per-session encoder state: client capabilities and the ZRLE zlib stream.
+pub struct Encoder {
+    copy_rect: bool,
+    zrle: bool,
+    tight: bool,
+    /// JPEG quality (1-100) from the client's quality-level pseudo-encoding.
+    jpeg_quality: Option<u32>,
+    zlib_level: u32,
+    /// `libzip` could be loaded.
+    zlib_available: bool,
+    /// The zlib header was sent; the stream continues across rects.
+    zrle_started: bool,
+    /// ZRLE plaintext: the last 32 KiB sent (deflate history), followed by
+    /// the rect being encoded.
+    zrle_window: Vec<u8>,
+    jpeg_buf: Vec<u8>,
+    palette: Palette,
+}
+
+impl Encoder {
+    pub fn new() -> Self {
+        Encoder {
+            copy_rect: false,
+            zrle: false,
+            tight: false,
+            jpeg_quality: None,
+            zlib_level: 1,
+            zlib_available: libzip_client::init(),
+            zrle_started: false,
+            zrle_window: Vec::new(),
+            jpeg_buf: Vec::new(),
+            palette: Palette::new(),
+        }
+    }
+
+    /// Apply a SetEncodings list.  The zlib stream is kept: ZRLE's stream
+    /// lives as long as the connection.
+    pub fn set_encodings(&mut self, encodings: &[i32]) {
+        self.copy_rect = false;
+        self.zrle = false;
+        self.tight = false;
+        self.jpeg_quality = None;
+        for &e in encodings {
+            match e {
+                ENC_COPY_RECT => self.copy_rect = true,
+                ENC_ZRLE => self.zrle = self.zlib_available,
+                ENC_TIGHT => self.tight = true,
+                q if (ENC_QUALITY_LEVEL_0..ENC_QUALITY_LEVEL_0 + 10).contains(&q) => {
+                    self.jpeg_quality = Some(10 + (q - ENC_QUALITY_LEVEL_0) as u32 * 9);
+                }
+                c if (ENC_COMPRESS_LEVEL_0..ENC_COMPRESS_LEVEL_0 + 10).contains(&c) => {
+                    self.zlib_level = ((c - ENC_COMPRESS_LEVEL_0) as u32).max(1);
+                }
+                _ => {}
+            }
+        }
+    }
+
+    /// Whether the client accepts CopyRect.
+    pub fn copy_rect(&self) -> bool {
+        self.copy_rect
+    }
+
+    /// Append one rectangle (header + payload) for `fb[x..x+w, y..y+h]`.
+    pub fn append_rect(&mut self, out: &mut Vec<u8>, fb: &[u32], stride: usize,
+                       x: usize, y: usize, w: usize, h: usize) {
+        if let Some(color) = solid_color(fb, stride, x, y, w, h) {
+            if self.tight {
+                push_rect_header(out, x, y, w, h, ENC_TIGHT);
+                out.push(0x80); // fill compression
+                let [b, g, r, _] = color.to_le_bytes();
+                out.extend_from_slice(&[r, g, b]);
+            } else {
+                push_rect_header(out, x, y, w, h, ENC_RRE);
+                out.extend_from_slice(&0u32.to_be_bytes()); // zero subrectangles
+                out.extend_from_slice(&color.to_le_bytes()); // background pixel
+            }
+            return;
+        }
+        if self.tight && self.jpeg_quality.is_some() && is_photo_like(fb, stride, x, y, w, h)
+            && self.append_tight_jpeg(out, fb, stride, x, y, w, h)
+        {
+            return;
+        }
+        if self.zrle && self.append_zrle(out, fb, stride, x, y, w, h) {
+            return;
+        }
+        push_rect_header(out, x, y, w, h, ENC_RAW);
+        for row in y..y + h {
+            let off = row * stride + x;
+            let row_bytes = unsafe {
+                core::slice::from_raw_parts(fb[off..].as_ptr() as *const u8, w * 4)
+            };
+            out.extend_from_slice(row_bytes);
+        }
+    }
+
+    /// Tight/JPEG rect; false (nothing appended) if the JPEG would not be
+    /// smaller than half the raw size.
+    fn append_tight_jpeg(&mut self, out: &mut Vec<u8>, fb: &[u32], stride: usize,
+                         x: usize, y: usize, w: usize, h: usize) -> bool {
+        let quality = match self.jpeg_quality { Some(q) => q, None => return false };
+        let cap = (w * h * 2).min(TIGHT_MAX_LEN);
+        if self.jpeg_buf.len() < cap {
+            self.jpeg_buf.resize(cap, 0);
+        }
+        let n = match libimage_client::encode_jpeg(
+            &fb[y * stride + x..], w as u32, h as u32, stride as u32, quality,
+            &mut self.jpeg_buf[..cap],
+        ) {
+            Ok(n) => n,
+            Err(_) => return false,
+        };
+        push_rect_header(out, x, y, w, h, ENC_TIGHT);
+        out.push(0x90); // JPEG compression
+        // Compact length: 7 bits per byte, high bit = more follows.
+        if n < 0x80 {
+            out.push(n as u8);
+        } else if n < 0x4000 {
+            out.extend_from_slice(&[n as u8 | 0x80, (n >> 7) as u8]);
+        } else {
+            out.extend_from_slice(&[n as u8 | 0x80, (n >> 7) as u8 | 0x80, (n >> 14) as u8]);
+        }
+        out.extend_from_slice(&self.jpeg_buf[..n]);
+        true
+    }
+
+    /// ZRLE rect; false (nothing appended, stream untouched) if deflate fails.
+    fn append_zrle(&mut self, out: &mut Vec<u8>, fb: &[u32], stride: usize,
+                   x: usize, y: usize, w: usize, h: usize) -> bool {
+        let history = self.zrle_window.len();
+        for ty in (y..y + h).step_by(ZRLE_TILE) {
+            let th = ZRLE_TILE.min(y + h - ty);
+            for tx in (x..x + w).step_by(ZRLE_TILE) {
+                let tw = ZRLE_TILE.min(x + w - tx);
+                zrle_tile(&mut self.zrle_window, fb, stride, tx, ty, tw, th, &mut self.palette);
+            }
+        }
+        // A non-final segment ends byte-aligned (sync flush), so the client
+        // can inflate exactly this rect and keep the stream open.
+        let data = match libzip_client::deflate_segment(&self.zrle_window, history, self.zlib_level, false) {
+            Some(d) => d,
+            None => {
+                self.zrle_window.truncate(history);
+                return false;
+            }
+        };
+
+        let header = if self.zrle_started { 0 } else { ZLIB_HEADER.len() };
+        push_rect_header(out, x, y, w, h, ENC_ZRLE);
+        out.extend_from_slice(&((header + data.len()) as u32).to_be_bytes());
+        if !self.zrle_started {
+            out.extend_from_slice(&ZLIB_HEADER);
+            self.zrle_started = true;
+        }
+        out.extend_from_slice(&data);
+
+        let keep = libzip_client::DICT_SIZE;
+        if self.zrle_window.len() > keep {
+            let drop = self.zrle_window.len() - keep;
+            self.zrle_window.drain(..drop);
+        }
+        true
+    }
+}
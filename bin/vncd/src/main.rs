@@ -22,7 +22,9 @@ anyos_std::entry!(main);
 use anyos_std::{ipc, net, process, println};
 
 mod config;
+mod damage;
 mod des;
+mod encode;
 mod font;
 mod input;
 mod login_ui;
@@ -88,6 +90,8 @@ fn main() {
     let mut children = [0u32; MAX_CLIENTS];
     let mut child_count = 0usize;
 
+    ipc::notify_ready();
+
     // Main accept / control loop.
     let mut current_listener = listener;
     loop {
@@ -18,6 +18,9 @@
 //! `MAX_LOGIN_ATTEMPTS` failures are allowed before the connection is closed.
 //!
 //! **MainLoop** — real desktop pixels are streamed via `capture_screen`.
+//! Only tiles the compositor's damage map reports as changed are compared,
+//! window moves it reports are replayed as CopyRect, and changed rects are
+//! encoded by `encode.rs` (Tight, ZRLE, RRE or Raw per rect).
 //! Keyboard events are mapped with `input::map_keysym` and injected via
 //! `CMD_INJECT_KEY`.  Mouse events go via `CMD_INJECT_POINTER`.
 
@@ -27,7 +30,9 @@ use anyos_std::sys;
 use anyos_std::println;
 
 use crate::config::VncConfig;
+use crate::damage::{DamageMap, Move};
 use crate::des;
+use crate::encode::{self, Encoder};
 use crate::input::{self, ModifierState};
 use crate::login_ui::{self, LoginState, LOGIN_H, LOGIN_W};
 
@@ -49,7 +54,8 @@ const IDLE_THRESHOLD: u32 = 5;
 const MAX_SCREEN_DIM: usize = 2048;
 
 /// Tile size for dirty-rectangle detection (pixels).
-/// Smaller tiles = more granular updates (4 KB/tile vs 16 KB at 64px).
+/// Smaller tiles = more granular updates; adjacent dirty tiles are merged
+/// into larger rects before encoding.
 const TILE_SIZE: usize = 32;
 
 // ── Big-endian wire helpers ───────────────────────────────────────────────────
@@ -133,96 +139,6 @@ fn pixel_format_block() -> [u8; 16] {
 
 // ── FramebufferUpdate helpers ─────────────────────────────────────────────────
 
-/// Send a FramebufferUpdate with a single Raw-encoded rectangle covering the full screen.
-/// Assembles header + rect header + pixel data into `send_buf` for a single TCP write.
-fn send_full_update(sock: u32, w: u16, h: u16, pixels: &[u32], send_buf: &mut anyos_std::Vec<u8>) -> bool {
-    let n_pixels = w as usize * h as usize;
-    if pixels.len() < n_pixels {
-        return false;
-    }
-
-    send_buf.clear();
-
-    // FramebufferUpdate header: type=0, padding=0, number-of-rectangles=1
-    send_buf.extend_from_slice(&[0, 0, 0, 1]);
-
-    // Rectangle header: x=0, y=0, w, h, encoding=0 (Raw)
-    let mut rect_hdr = [0u8; 12];
-    rect_hdr[4..6].copy_from_slice(&be16(w));
-    rect_hdr[6..8].copy_from_slice(&be16(h));
-    send_buf.extend_from_slice(&rect_hdr);
-
-    // Pixel data.
-    let byte_data = unsafe {
-        core::slice::from_raw_parts(pixels.as_ptr() as *const u8, n_pixels * 4)
-    };
-    send_buf.extend_from_slice(byte_data);
-
-    send_all(sock, send_buf)
-}
-
-/// Check if every pixel in a tile is the same solid color.
-/// Returns Some(color) if solid, None if mixed.
-fn tile_solid_color(fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize) -> Option<u32> {
-    let first = fb[y * stride + x];
-    for row in y..y + h {
-        let off = row * stride + x;
-        for col in 0..w {
-            if fb[off + col] != first {
-                return None;
-            }
-        }
-    }
-    Some(first)
-}
-
-/// Append an RRE-encoded rectangle for a solid-color tile.
-///
-/// RRE (Rise-and-Run-length Encoding, encoding type 2) with zero subrects
-/// sends just the background color — 20 bytes total vs 16 KB for a 64x64 Raw tile.
-/// All VNC clients support RRE.
-fn append_rre_solid_rect(out: &mut anyos_std::Vec<u8>, x: usize, y: usize, w: usize, h: usize, color: u32) {
-    // Rectangle header: x, y, w, h (BE16 each), encoding=2 (RRE, BE32)
-    out.extend_from_slice(&be16(x as u16));
-    out.extend_from_slice(&be16(y as u16));
-    out.extend_from_slice(&be16(w as u16));
-    out.extend_from_slice(&be16(h as u16));
-    out.extend_from_slice(&be32(2)); // encoding = RRE
-
-    // RRE payload: num-subrects (BE32) = 0, background-pixel (4 bytes LE)
-    out.extend_from_slice(&be32(0)); // zero subrectangles
-    out.extend_from_slice(&color.to_le_bytes()); // background pixel (same byte order as Raw)
-}
-
-/// Append a raw rectangle (header + pixel data) to a byte buffer.
-fn append_raw_rect(out: &mut anyos_std::Vec<u8>, fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize) {
-    // Rectangle header: x, y, w, h (BE16 each), encoding=0 (Raw, BE32)
-    out.extend_from_slice(&be16(x as u16));
-    out.extend_from_slice(&be16(y as u16));
-    out.extend_from_slice(&be16(w as u16));
-    out.extend_from_slice(&be16(h as u16));
-    out.extend_from_slice(&[0, 0, 0, 0]); // encoding = Raw
-
-    // Pixel data row by row.
-    for row in y..y + h {
-        let off = row * stride + x;
-        let row_bytes = unsafe {
-            core::slice::from_raw_parts(fb[off..].as_ptr() as *const u8, w * 4)
-        };
-        out.extend_from_slice(row_bytes);
-    }
-}
-
-/// Append the best encoding for a dirty tile: RRE for solid-color, Raw otherwise.
-fn append_tile_rect(out: &mut anyos_std::Vec<u8>, fb: &[u32], stride: usize, x: usize, y: usize, w: usize, h: usize) {
-    if let Some(color) = tile_solid_color(fb, stride, x, y, w, h) {
-        // Solid color: 20 bytes (RRE) instead of ~16 KB (Raw). ~800x smaller.
-        append_rre_solid_rect(out, x, y, w, h, color);
-    } else {
-        append_raw_rect(out, fb, stride, x, y, w, h);
-    }
-}
-
 /// Check if a tile differs between `cur` and `prev` framebuffers.
 fn tile_dirty(cur: &[u32], prev: &[u32], stride: usize, tx: usize, ty: usize, tw: usize, th: usize) -> bool {
     for row in ty..ty + th {
@@ -234,15 +150,66 @@ fn tile_dirty(cur: &[u32], prev: &[u32], stride: usize, tx: usize, ty: usize, tw
     false
 }
 
-/// Send a FramebufferUpdate containing only the dirty tiles.
-/// All tile data is collected into one buffer and sent in a single TCP write.
+/// Replay a compositor-reported window move as a CopyRect.
+///
+/// The moved area is clipped so source and destination lie on screen, and
+/// used only if at least half of its rows arrive unchanged (the window may be
+/// partly covered or repainting while dragged).  `prev` receives the same
+/// copy the client performs, so the tile scan afterwards sends only what
+/// the copy got wrong plus the uncovered area.
+fn append_copy_rect(out: &mut anyos_std::Vec<u8>, cur: &[u32], prev: &mut [u32],
+                    sw: usize, sh: usize, mv: &Move) -> bool {
+    let (sw_i, sh_i) = (sw as i32, sh as i32);
+    let dx = mv.dst_x - mv.src_x;
+    let dy = mv.dst_y - mv.src_y;
+    let x0 = mv.dst_x.max(0).max(dx);
+    let x1 = (mv.dst_x + mv.w as i32).min(sw_i).min(sw_i + dx);
+    let y0 = mv.dst_y.max(0).max(dy);
+    let y1 = (mv.dst_y + mv.h as i32).min(sh_i).min(sh_i + dy);
+    if x1 <= x0 || y1 <= y0 {
+        return false;
+    }
+    let (x, y) = (x0 as usize, y0 as usize);
+    let (w, h) = ((x1 - x0) as usize, (y1 - y0) as usize);
+    let (sx, sy) = ((x0 - dx) as usize, (y0 - dy) as usize);
+
+    let intact = (0..h)
+        .filter(|&r| cur[(y + r) * sw + x..][..w] == prev[(sy + r) * sw + sx..][..w])
+        .count();
+    if intact * 2 < h {
+        return false;
+    }
+
+    encode::push_rect_header(out, x, y, w, h, encode::ENC_COPY_RECT);
+    out.extend_from_slice(&be16(sx as u16));
+    out.extend_from_slice(&be16(sy as u16));
+
+    // Walk rows away from the overlap so no source row is overwritten first.
+    let mut copy_row = |r: usize| {
+        let src = (sy + r) * sw + sx;
+        prev.copy_within(src..src + w, (y + r) * sw + x);
+    };
+    if dy > 0 {
+        (0..h).rev().for_each(&mut copy_row);
+    } else {
+        (0..h).for_each(&mut copy_row);
+    }
+    true
+}
+
+/// Send a FramebufferUpdate containing only the changed parts of the screen.
+/// All rect data is collected into one buffer and sent in a single TCP write.
 ///
 /// Returns:
 ///   -1  — connection error (caller should break)
 ///    0  — nothing dirty, nothing was sent
-///   >0  — number of dirty tiles sent
+///   >0  — number of rectangles sent
 ///
-/// Updates `prev` with `cur` for dirty regions.
+/// Dirty tiles are merged into horizontal runs, and runs spanning the same
+/// columns in consecutive tile rows into one rect, before `enc` picks an
+/// encoding for each.  Updates `prev` with `cur` for dirty regions.  With a
+/// synced `map`, tiles the compositor has not touched since the previous scan
+/// are skipped, and its last window move is sent first as a CopyRect.
 fn send_dirty_update(
     sock: u32,
     cur: &[u32],
@@ -251,58 +218,139 @@ fn send_dirty_update(
     sh: usize,
     full: bool,
     send_buf: &mut anyos_std::Vec<u8>,
+    map: Option<&mut DamageMap>,
+    enc: &mut Encoder,
 ) -> i32 {
+    send_buf.clear();
+    // Reserve space for the FramebufferUpdate header (4 bytes).
+    // We'll fill in the rectangle count after encoding.
+    send_buf.extend_from_slice(&[0u8; 4]);
+
     if full {
-        // Full (non-incremental) update: send everything in one call.
+        // Full (non-incremental) update: one rect covering the screen.
         prev.copy_from_slice(&cur[..sw * sh]);
-        return if send_full_update(sock, sw as u16, sh as u16, cur, send_buf) { 1 } else { -1 };
+        enc.append_rect(send_buf, cur, sw, 0, 0, sw, sh);
+        send_buf[3] = 1;
+        return if send_all(sock, send_buf) { 1 } else { -1 };
     }
 
-    send_buf.clear();
+    let (mut map, seq) = match map {
+        Some(m) => {
+            let seq = m.begin_scan();
+            (Some(m), seq)
+        }
+        None => (None, None),
+    };
+    let mut n_rects: u16 = 0;
 
-    // Scan for dirty tiles and build the complete message in send_buf.
+    if let (Some(m), Some(seq)) = (map.as_deref_mut(), seq) {
+        if let Some(mv) = m.take_move(seq) {
+            if enc.copy_rect() && append_copy_rect(send_buf, cur, prev, sw, sh, &mv) {
+                n_rects += 1;
+            }
+        }
+    }
+
+    // Scan for dirty tiles, merging them into rects.
     let tiles_x = (sw + TILE_SIZE - 1) / TILE_SIZE;
     let tiles_y = (sh + TILE_SIZE - 1) / TILE_SIZE;
-    let mut n_dirty: u16 = 0;
-
-    // Reserve space for the FramebufferUpdate header (4 bytes).
-    // We'll fill in the rectangle count after scanning.
-    send_buf.extend_from_slice(&[0u8; 4]);
+    let mut rects: anyos_std::Vec<[usize; 4]> = anyos_std::Vec::new();
+    let mut open: anyos_std::Vec<usize> = anyos_std::Vec::new();
+    let mut next_open: anyos_std::Vec<usize> = anyos_std::Vec::new();
 
     for ty_idx in 0..tiles_y {
-        for tx_idx in 0..tiles_x {
+        let ty = ty_idx * TILE_SIZE;
+        let th = TILE_SIZE.min(sh - ty);
+        let tile_changed = |tx_idx: usize| {
             let tx = tx_idx * TILE_SIZE;
-            let ty = ty_idx * TILE_SIZE;
             let tw = TILE_SIZE.min(sw - tx);
-            let th = TILE_SIZE.min(sh - ty);
-
-            if tile_dirty(cur, prev, sw, tx, ty, tw, th) {
-                // Append this tile's rect — uses RRE for solid tiles, Raw otherwise.
-                append_tile_rect(send_buf, cur, sw, tx, ty, tw, th);
-                n_dirty += 1;
+            if let (Some(m), Some(_)) = (map.as_deref(), seq) {
+                if !m.changed(tx, ty, tw, th) {
+                    return false;
+                }
+            }
+            tile_dirty(cur, prev, sw, tx, ty, tw, th)
+        };
 
-                // Update prev buffer for this tile.
-                for row in ty..ty + th {
-                    let off = row * sw + tx;
-                    prev[off..off + tw].copy_from_slice(&cur[off..off + tw]);
+        next_open.clear();
+        let mut oi = 0usize;
+        let mut tx_idx = 0usize;
+        while tx_idx < tiles_x {
+            if !tile_changed(tx_idx) {
+                tx_idx += 1;
+                continue;
+            }
+            let start = tx_idx;
+            while tx_idx < tiles_x && tile_changed(tx_idx) {
+                tx_idx += 1;
+            }
+            let x = start * TILE_SIZE;
+            let w = (tx_idx * TILE_SIZE).min(sw) - x;
+            // Runs are sorted by x, so the open rects are scanned once per row.
+            while oi < open.len() && rects[open[oi]][0] < x {
+                oi += 1;
+            }
+            match open.get(oi) {
+                Some(&idx) if rects[idx][0] == x && rects[idx][2] == w => {
+                    rects[idx][3] += th;
+                    next_open.push(idx);
+                    oi += 1;
+                }
+                _ => {
+                    next_open.push(rects.len());
+                    rects.push([x, ty, w, th]);
                 }
             }
         }
+        core::mem::swap(&mut open, &mut next_open);
     }
 
-    if n_dirty == 0 {
+    if let (Some(m), Some(seq)) = (map, seq) {
+        m.end_scan(seq);
+    }
+
+    for &[x, y, w, h] in &rects {
+        enc.append_rect(send_buf, cur, sw, x, y, w, h);
+        for row in y..y + h {
+            let off = row * sw + x;
+            prev[off..off + w].copy_from_slice(&cur[off..off + w]);
+        }
+    }
+    n_rects += rects.len() as u16;
+
+    if n_rects == 0 {
         // Nothing changed — don't send anything.
         // The caller keeps update_requested=true and checks again later.
         return 0;
     }
 
     // Patch the rectangle count into the header.
-    let count_bytes = be16(n_dirty);
+    let count_bytes = be16(n_rects);
     send_buf[2] = count_bytes[0];
     send_buf[3] = count_bytes[1];
 
     // Single TCP send for the entire update.
-    if send_all(sock, send_buf) { n_dirty as i32 } else { -1 }
+    if send_all(sock, send_buf) { n_rects as i32 } else { -1 }
+}
+
+/// Read the body of a SetEncodings message (type 2) and apply it to `enc`.
+/// Returns `false` on EOF.
+fn recv_set_encodings(sock: u32, enc: &mut Encoder) -> bool {
+    let mut enc_hdr = [0u8; 3]; // pad(1) + count(2)
+    if !recv_exact(sock, &mut enc_hdr) {
+        return false;
+    }
+    let count = from_be16(&enc_hdr[1..3]) as usize;
+    let mut list = anyos_std::Vec::with_capacity(count);
+    let mut enc_buf = [0u8; 4];
+    for _ in 0..count {
+        if !recv_exact(sock, &mut enc_buf) {
+            return false;
+        }
+        list.push(from_be32(&enc_buf) as i32);
+    }
+    enc.set_encodings(&list);
+    true
 }
 
 // ── Login screen helpers ──────────────────────────────────────────────────────
@@ -460,6 +508,9 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
     let mut login_send_buf: anyos_std::Vec<u8> = anyos_std::Vec::new();
     let mut login_first_frame = true;
 
+    // Encoder state lives for the whole connection (ZRLE's zlib stream does).
+    let mut encoder = Encoder::new();
+
     // ── 8. OS login screen phase ──────────────────────────────────────────────
     let mut username_buf = [0u8; 64];
     let mut username_len = 0usize;
@@ -497,7 +548,7 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
             render_login_overlay(&mut screen_buf, sw, sh, &state, &mut login_panel);
             let rc = send_dirty_update(
                 sock, &screen_buf, &mut login_prev, sw, sh,
-                login_first_frame, &mut login_send_buf,
+                login_first_frame, &mut login_send_buf, None, &mut encoder,
             );
             login_first_frame = false;
             if rc < 0 {
@@ -653,21 +704,12 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
                     return;
                 }
             }
-            // SetEncodings (type 2): read and discard.
+            // SetEncodings (type 2): remember what the client can decode.
             2 => {
-                let mut enc_hdr = [0u8; 3]; // pad(1) + count(2)
-                if !recv_exact(sock, &mut enc_hdr) {
+                if !recv_set_encodings(sock, &mut encoder) {
                     net::tcp_close(sock);
                     return;
                 }
-                let count = from_be16(&enc_hdr[1..3]) as usize;
-                let mut enc_buf = [0u8; 4];
-                for _ in 0..count {
-                    if !recv_exact(sock, &mut enc_buf) {
-                        net::tcp_close(sock);
-                        return;
-                    }
-                }
             }
             _ => {
                 // Unknown message type — close for safety.
@@ -706,6 +748,10 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
     let fb_pitch: usize = if screen_info[2] > 0 { screen_info[2] as usize } else { sw * 4 };
     let fb_contiguous = fb_pitch == sw * 4;
 
+    // Compositor damage map: skip comparing tiles that did not change.
+    // Detached when the session ends (Drop).
+    let mut damage_map = DamageMap::attach(comp_chan, sw, sh);
+
     loop {
         // ── Phase A: drain ALL queued client messages ─────────────────────────
         // Processing all pending messages before sending a frame ensures that
@@ -728,15 +774,9 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
                     let mut _rest = [0u8; 19];
                     if !recv_exact(sock, &mut _rest) { net::tcp_close(sock); return; }
                 }
-                // SetEncodings (type 2): read and discard.
+                // SetEncodings (type 2).
                 2 => {
-                    let mut enc_hdr = [0u8; 3];
-                    if !recv_exact(sock, &mut enc_hdr) { net::tcp_close(sock); return; }
-                    let count = from_be16(&enc_hdr[1..3]) as usize;
-                    let mut enc_buf = [0u8; 4];
-                    for _ in 0..count {
-                        if !recv_exact(sock, &mut enc_buf) { net::tcp_close(sock); return; }
-                    }
+                    if !recv_set_encodings(sock, &mut encoder) { net::tcp_close(sock); return; }
                 }
                 // FramebufferUpdateRequest (type 3).
                 3 => {
@@ -802,7 +842,7 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
                         break;
                     }
                     fb_mapped = true;
-                    send_dirty_update(sock, &screen_buf, &mut prev_buf, sw, sh, need_full, &mut send_buf)
+                    send_dirty_update(sock, &screen_buf, &mut prev_buf, sw, sh, need_full, &mut send_buf, damage_map.as_mut(), &mut encoder)
                 } else {
                     // Subsequent frames: read directly from the mapped GPU
                     // framebuffer — zero-copy when pitch == width*4.
@@ -826,7 +866,7 @@ pub fn run_session(sock: u32, cfg: &VncConfig, comp_chan: u32) {
                         }
                         &screen_buf
                     };
-                    send_dirty_update(sock, cur, &mut prev_buf, sw, sh, need_full, &mut send_buf)
+                    send_dirty_update(sock, cur, &mut prev_buf, sw, sh, need_full, &mut send_buf, damage_map.as_mut(), &mut encoder)
                 };
 
                 if rc < 0 {
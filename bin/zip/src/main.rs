@@ -7,8 +7,9 @@ use alloc::string::String;
 anyos_std::entry!(main);
 
 fn usage() {
-    anyos_std::println!("Usage: zip [-0] [-r] archive.zip file [file...]");
+    anyos_std::println!("Usage: zip [-0..-9] [-r] archive.zip file [file...]");
     anyos_std::println!("  -0  Store only (no compression)");
+    anyos_std::println!("  -1  Compress faster ... -9  Compress better (default -6)");
     anyos_std::println!("  -r  Recurse into directories");
 }
 
@@ -80,6 +81,7 @@ fn main() {
     let store_only = args.has(b'0');
     let recursive = args.has(b'r');
     let compress = !store_only;
+    let level = (1..=9).rev().find(|&d| args.has(b'0' + d));
 
     let archive_path = args.positional[0];
 
@@ -90,6 +92,9 @@ fn main() {
             return;
         }
     };
+    if let Some(level) = level {
+        writer.set_level(level as u32);
+    }
 
     for i in 1..args.pos_count {
         let path = args.positional[i];
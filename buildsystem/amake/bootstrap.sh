@@ -18,6 +18,8 @@ cc -Wall -O2 -std=c99 -o "$OUT" \
     "${SRC}/parser.c" \
     "${SRC}/glob.c" \
     "${SRC}/track.c" \
+    "${SRC}/state.c" \
+    "${SRC}/cache.c" \
     "${SRC}/eval.c" \
     "${SRC}/graph.c" \
     "${SRC}/exec.c"
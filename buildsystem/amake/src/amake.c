@@ -1,9 +1,13 @@
 /*
  * amake — anyOS build system (CMake + Ninja replacement)
  *
- * Parses CMakeLists.txt, builds a dependency graph, tracks file timestamps,
+ * Parses CMakeLists.txt, builds a dependency graph, tracks file content,
  * and executes builds in parallel. Replaces both cmake and ninja.
  *
+ * The evaluated graph and per-rule content hashes persist in the build
+ * directory (.amake_graph, .amake_state), so a no-op build neither
+ * re-parses the build files nor rebuilds anything that was merely touched.
+ *
  * Written in C99 for TCC compatibility (self-hosting on anyOS).
  *
  * Usage:
@@ -16,6 +20,9 @@
  *   -j N            Parallel jobs (default: 4)
  *   -f FILE         CMakeLists.txt path
  *   --clean         Force full rebuild
+ *   --cache DIR     Action cache directory (or $AMAKE_CACHE_DIR)
+ *   --cache-shared DIR  Second, shared cache, e.g. on an SMB share
+ *                   (or $AMAKE_CACHE_SHARED)
  *   --verbose       Show commands being executed
  *   --version       Print version
  *   --help          Print usage
@@ -33,6 +40,8 @@
 #include "parser.c"
 #include "glob.c"
 #include "track.c"
+#include "state.c"
+#include "cache.c"
 #include "eval.c"
 #include "graph.c"
 #include "exec.c"
@@ -338,6 +347,10 @@ static void usage(void) {
         "  -j N            Parallel jobs (default: CPU count)\n"
         "  -f FILE         CMakeLists.txt path (default: ./CMakeLists.txt)\n"
         "  --clean         Force full rebuild\n"
+        "  --cache DIR     Action cache directory (default: $AMAKE_CACHE_DIR)\n"
+        "  --cache-shared DIR\n"
+        "                  Shared cache searched after the local one, e.g. on an\n"
+        "                  SMB share (default: $AMAKE_CACHE_SHARED)\n"
         "  --verbose       Show commands being executed\n"
         "  --version       Print version\n"
         "  --help          Print this help\n\n"
@@ -379,6 +392,8 @@ int main(int argc, char **argv) {
     int define_count = 0;
     char **targets = NULL;
     int target_count = 0;
+    const char *cache_dir = getenv("AMAKE_CACHE_DIR");
+    const char *cache_shared = getenv("AMAKE_CACHE_SHARED");
 
     /* Parse CLI */
     int i;
@@ -410,6 +425,12 @@ int main(int argc, char **argv) {
         else if (strcmp(argv[i], "--clean") == 0) {
             clean = 1;
         }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache-shared") == 0 && i + 1 < argc) {
+            cache_shared = argv[++i];
+        }
         else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
             verbose = 1;
         }
@@ -458,30 +479,16 @@ int main(int argc, char **argv) {
     char *abs_build = get_absolute_path(build_dir);
     free(source_dir);
 
-    /* Read CMakeLists.txt */
+    /* Locate CMakeLists.txt */
     char *cmake_path;
     if (cmake_file[0] == '/')
         cmake_path = amake_strdup(cmake_file);
     else
         cmake_path = amake_path_join(abs_source, cmake_file);
 
-    size_t file_size;
-    char *source = amake_read_file(cmake_path, &file_size);
-    if (!source)
-        amake_fatal("cannot read %s", cmake_path);
-
     /* Ensure build directory exists */
     amake_mkdir_p(abs_build);
 
-    /* Phase 1: Tokenize */
-    TokenList tokens;
-    lexer_tokenize(source, file_size, &tokens);
-    free(source);
-
-    /* Phase 2: Parse */
-    AstNode *ast = parser_parse(&tokens);
-
-    /* Phase 3: Evaluate */
     AmakeCtx ctx;
     memset(&ctx, 0, sizeof(ctx));
     ctx.source_dir = abs_source;
@@ -498,11 +505,41 @@ int main(int argc, char **argv) {
     ctx.target_count = target_count;
     graph_init(&ctx.graph);
 
-    eval_run(&ctx, ast);
+    char *graph_path = amake_path_join(abs_build, ".amake_graph");
+    char *state_path = amake_path_join(abs_build, ".amake_state");
+    uint64_t graph_key = graph_cache_key(&ctx);
+    TokenList tokens;
+    AstNode *ast = NULL;
+    memset(&tokens, 0, sizeof(tokens));
 
-    if (verbose) {
-        fprintf(stderr, "amake: evaluated %d rules, %d targets\n",
-                ctx.graph.rule_count, ctx.graph.target_count);
+    if (graph_cache_load(&ctx, graph_path, graph_key)) {
+        if (verbose) {
+            fprintf(stderr, "amake: using cached graph: %d rules, %d targets\n",
+                    ctx.graph.rule_count, ctx.graph.target_count);
+        }
+    } else {
+        /* Read CMakeLists.txt */
+        size_t file_size;
+        char *source = amake_read_file(cmake_path, &file_size);
+        if (!source)
+            amake_fatal("cannot read %s", cmake_path);
+
+        /* Phase 1: Tokenize */
+        lexer_tokenize(source, file_size, &tokens);
+        free(source);
+
+        /* Phase 2: Parse */
+        ast = parser_parse(&tokens);
+
+        /* Phase 3: Evaluate */
+        eval_run(&ctx, ast);
+
+        if (verbose) {
+            fprintf(stderr, "amake: evaluated %d rules, %d targets\n",
+                    ctx.graph.rule_count, ctx.graph.target_count);
+        }
+        if (graph_cache_save(&ctx, graph_path, graph_key) != 0)
+            fprintf(stderr, "amake: warning: cannot write %s\n", graph_path);
     }
 
     /* Phase 4: Link dependency graph */
@@ -511,7 +548,10 @@ int main(int argc, char **argv) {
     /* Phase 5: Dirty detection */
     MtimeCache mc;
     mtime_cache_init(&mc);
-    graph_mark_dirty(&ctx.graph, &mc);
+    BuildState state;
+    state_init(&state, &mc, verbose);
+    state_load(&state, state_path);
+    graph_mark_dirty(&ctx.graph, &mc, &state);
 
     /* Phase 6: Collect dirty rules */
     BuildRule **dirty = NULL;
@@ -550,12 +590,19 @@ int main(int argc, char **argv) {
     int result = 0;
     if (dirty_count > 0) {
         Executor ex;
+        ActionCache cache;
         exec_init(&ex, max_jobs, verbose, ctx.amake_path);
+        ex.state = &state;
+        cache_init(&cache, &mc, cache_dir, cache_shared, ctx.amake_path, verbose);
+        if (cache.dir_count > 0) ex.cache = &cache;
         result = exec_run(&ex, dirty, dirty_count);
         exec_free(&ex);
+        cache_free(&cache);
     } else {
         fprintf(stderr, "Nothing to do.\n");
     }
+    if (state_save(&state, state_path) != 0)
+        fprintf(stderr, "amake: warning: cannot write %s\n", state_path);
 
     /* Run COMMAND targets (like "run", "debug") after building */
     if (result == 0 && target_count > 0) {
@@ -573,11 +620,15 @@ int main(int argc, char **argv) {
 
     /* Cleanup */
     free(dirty);
+    state_free(&state);
     mtime_cache_free(&mc);
     graph_free(&ctx.graph);
     ast_free(ast);
     token_list_free(&tokens);
     scope_free(ctx.global_scope);
+    ctx_free_notes(&ctx);
+    free(graph_path);
+    free(state_path);
     free(ctx.amake_path);
     free(abs_source);
     free(abs_build);
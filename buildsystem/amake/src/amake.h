@@ -2,7 +2,7 @@
  * amake.h — anyOS build system (CMake + Ninja replacement)
  *
  * Parses CMakeLists.txt (the subset used by anyOS), builds a dependency graph,
- * and executes builds in parallel with mtime-based dirty detection.
+ * and executes builds in parallel with content-hash dirty detection.
  *
  * Written in C99 for TCC compatibility (self-hosting on anyOS).
  */
@@ -26,6 +26,7 @@
 #define MAX_COMMANDS   64
 #define MAX_OUTPUTS    32
 #define MAX_DEPENDS   256
+#define STATE_BUCKETS 4096
 
 /* ── Tokens (lexer.c) ────────────────────────────────────────────────── */
 
@@ -117,6 +118,10 @@ struct BuildRule {
     char    *working_dir;
 
     /* State */
+    uint64_t cmd_hash;      /* hash of commands + working dir (state.c) */
+    int      self_dirty;    /* dirty on its own inputs, not just via blockers */
+    uint64_t cache_key;     /* action cache key (cache.c) */
+    int      cache_miss;    /* looked up and missed: store after success */
     int      dirty;
     int      building;
     int      done;
@@ -147,7 +152,11 @@ typedef struct {
 typedef struct MtimeEntry {
     char               *path;
     time_t              mtime;   /* 0 = file does not exist */
-    int                 valid;
+    long long           size;    /* -1 = file does not exist */
+    int                 is_dir;
+    int                 valid;   /* 0 = re-stat on next lookup */
+    int                 hashed;
+    uint64_t            hash;    /* content hash, once hashed */
     struct MtimeEntry  *next;
 } MtimeEntry;
 
@@ -155,6 +164,44 @@ typedef struct {
     MtimeEntry *buckets[HASH_BUCKETS];
 } MtimeCache;
 
+/* ── Build State (state.c) ──────────────────────────────────────────── */
+
+typedef struct {
+    char      *path;
+    time_t     mtime;       /* 0 = mtime not trusted, always rehash */
+    long long  size;        /* -1 = file did not exist */
+    uint64_t   hash;
+} StateFile;
+
+typedef struct StateRecord {
+    char       *key;        /* first output of the rule */
+    uint64_t    cmd_hash;
+    StateFile  *inputs;     int input_count;
+    StateFile  *outputs;    int output_count;
+    struct StateRecord *next;
+} StateRecord;
+
+typedef struct {
+    StateRecord *buckets[STATE_BUCKETS];
+    MtimeCache  *mc;
+    int          loaded;    /* a state file existed: records are complete */
+    int          changed;   /* needs to be written back */
+    int          verbose;
+} BuildState;
+
+/* ── Action Cache (cache.c) ─────────────────────────────────────────── */
+
+typedef struct {
+    char       *dirs[2];    /* local, then optional shared (e.g. SMB mount) */
+    int         dir_count;
+    MtimeCache *mc;
+    const char *amake_path;
+    int         hits;
+    int         misses;
+    int         stores;
+    int         verbose;
+} ActionCache;
+
 /* ── Executor (exec.c) ──────────────────────────────────────────────── */
 
 #ifndef _WIN32
@@ -179,9 +226,12 @@ typedef struct {
     int          ready_cap;
     int          failed_count;
     int          built_count;
+    int          skipped_count; /* early cutoff: inputs unchanged after all */
     int          total_dirty;
     int          verbose;
     const char  *amake_path;   /* for detecting -E builtins */
+    BuildState  *state;        /* optional: records and re-checks rules */
+    ActionCache *cache;        /* optional: restores outputs of known actions */
 } Executor;
 
 /* ── User-defined function ───────────────────────────────────────────── */
@@ -215,6 +265,14 @@ typedef struct {
     /* Build graph */
     BuildGraph  graph;
 
+    /* Inputs the graph was evaluated from (for the graph cache) */
+    char      **env_names;      /* $ENV{} / PATH lookups */
+    int         env_count;
+    char      **made_dirs;      /* file(MAKE_DIRECTORY) side effects */
+    int         made_dir_count;
+    char      **probes;         /* paths tested by if(EXISTS) / find_program */
+    int         probe_count;
+
     /* CLI overrides (-D) */
     char      **cli_defines;    /* "VAR=VAL" strings */
     int         cli_define_count;
@@ -274,12 +332,47 @@ void      expand_args(AmakeCtx *ctx, char **args, int argc,
 void  amake_glob(const char *pattern, char ***out_files, int *out_count);
 void  amake_glob_recurse(const char *base_dir, const char *pattern,
                          char ***out_files, int *out_count);
+void  amake_glob_scanned(char ***out_dirs, int *out_count);
 
 /* ── Track (track.c) ─────────────────────────────────────────────────── */
 
 void    mtime_cache_init(MtimeCache *mc);
 void    mtime_cache_free(MtimeCache *mc);
 time_t  mtime_get(MtimeCache *mc, const char *path);
+MtimeEntry *mtime_lookup(MtimeCache *mc, const char *path);
+void    mtime_invalidate(MtimeCache *mc, const char *path);
+uint64_t content_hash_get(MtimeCache *mc, const char *path);
+uint64_t amake_hash_bytes(uint64_t h, const void *data, size_t len);
+uint64_t amake_hash_str(uint64_t h, const char *s);
+int     amake_hash_file(const char *path, uint64_t *out_hash);
+
+/* ── State (state.c) ─────────────────────────────────────────────────── */
+
+void  state_init(BuildState *st, MtimeCache *mc, int verbose);
+void  state_load(BuildState *st, const char *path);
+int   state_save(BuildState *st, const char *path);
+void  state_free(BuildState *st);
+uint64_t state_command_hash(const BuildRule *rule);
+int   state_rule_dirty(BuildState *st, BuildRule *rule);
+void  state_record_rule(BuildState *st, BuildRule *rule);
+void  state_forget_rule(BuildState *st, BuildRule *rule);
+
+/* ── Action cache (cache.c) ──────────────────────────────────────────── */
+
+void  cache_init(ActionCache *ac, MtimeCache *mc, const char *local,
+                 const char *remote, const char *amake_path, int verbose);
+void  cache_free(ActionCache *ac);
+int   cache_fetch(ActionCache *ac, BuildRule *rule);
+void  cache_store(ActionCache *ac, BuildRule *rule);
+void  cache_store_in(ActionCache *ac, BuildRule *rule, const char *dir);
+
+uint64_t graph_cache_key(const AmakeCtx *ctx);
+int   graph_cache_load(AmakeCtx *ctx, const char *path, uint64_t key);
+int   graph_cache_save(const AmakeCtx *ctx, const char *path, uint64_t key);
+void  ctx_note_env(AmakeCtx *ctx, const char *name);
+void  ctx_note_made_dir(AmakeCtx *ctx, const char *path);
+void  ctx_note_probe(AmakeCtx *ctx, const char *path);
+void  ctx_free_notes(AmakeCtx *ctx);
 
 /* ── Eval (eval.c) ───────────────────────────────────────────────────── */
 
@@ -292,7 +385,7 @@ BuildRule *graph_add_rule(BuildGraph *g);
 BuildTarget *graph_add_target(BuildGraph *g);
 BuildRule *graph_find_rule_for_output(BuildGraph *g, const char *path);
 void       graph_link(BuildGraph *g);
-void       graph_mark_dirty(BuildGraph *g, MtimeCache *mc);
+void       graph_mark_dirty(BuildGraph *g, MtimeCache *mc, BuildState *st);
 int        graph_collect_dirty_for_target(BuildGraph *g, const char *target_name,
                                           BuildRule ***out_dirty, int *out_count);
 int        graph_collect_dirty_all(BuildGraph *g,
@@ -0,0 +1,349 @@
+/*
+ * cache.c — Shared action cache for amake
+ *
+ * Keyed by a hash of a rule's commands, its output paths, the content of
+ * its inputs and the identity of the tools it runs. A hit restores the
+ * outputs from the cache instead of running the rule.
+ *
+ * Entries live under DIR/<xx>/<key>/ as one blob per output plus a
+ * manifest with each blob's size and hash. Up to two directories are
+ * searched: a local one, then an optional shared one (e.g. an SMB share
+ * mounted by several machines). The manifest is written last and every
+ * blob is verified on fetch, so a half-written entry — the shared
+ * filesystem may not support atomic rename — just reads as a miss.
+ */
+#include "amake.h"
+
+#define CACHE_MAGIC "amake-cache 1"
+
+/* ── Setup ───────────────────────────────────────────────────────────── */
+
+void cache_init(ActionCache *ac, MtimeCache *mc, const char *local,
+                const char *remote, const char *amake_path, int verbose)
+{
+    memset(ac, 0, sizeof(ActionCache));
+    ac->mc = mc;
+    ac->amake_path = amake_path;
+    ac->verbose = verbose;
+    if (local && local[0]) ac->dirs[ac->dir_count++] = amake_strdup(local);
+    if (remote && remote[0]) ac->dirs[ac->dir_count++] = amake_strdup(remote);
+}
+
+void cache_free(ActionCache *ac) {
+    int i;
+    for (i = 0; i < ac->dir_count; i++) free(ac->dirs[i]);
+    memset(ac, 0, sizeof(ActionCache));
+}
+
+/* ── Key computation ─────────────────────────────────────────────────── */
+
+/*
+ * Split off the next shell word (double quotes respected).
+ * Returns a heap copy, or NULL at end of string.
+ */
+static char *next_word(const char **pp) {
+    const char *p = *pp;
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p) {
+        *pp = p;
+        return NULL;
+    }
+
+    char *w = amake_malloc(strlen(p) + 1);
+    size_t n = 0;
+    int quoted = 0;
+    while (*p && (quoted || (*p != ' ' && *p != '\t'))) {
+        if (*p == '"') quoted = !quoted;
+        else w[n++] = *p;
+        p++;
+    }
+    w[n] = '\0';
+    *pp = p;
+    return w;
+}
+
+/*
+ * The program a command runs: its first word, looking through
+ * "amake -E env VAR=VAL ... prog" to the real program.
+ */
+static char *command_tool(ActionCache *ac, const char *cmd) {
+    const char *p = cmd;
+    char *w = next_word(&p);
+    if (!w || !ac->amake_path || strcmp(w, ac->amake_path) != 0)
+        return w;
+
+    char *sub = next_word(&p);
+    char *name = sub ? next_word(&p) : NULL;
+    if (!sub || !name || strcmp(sub, "-E") != 0 || strcmp(name, "env") != 0) {
+        free(sub);
+        free(name);
+        return w; /* another builtin: amake itself is the tool */
+    }
+    free(sub);
+    free(name);
+
+    char *t;
+    while ((t = next_word(&p)) != NULL && strchr(t, '='))
+        free(t);
+    if (!t) return w;
+    free(w);
+    return t;
+}
+
+/* Resolve a program name the way /bin/sh would. */
+static char *resolve_tool(const char *name) {
+    if (strchr(name, '/')) return amake_strdup(name);
+
+    const char *path_env = getenv("PATH");
+    if (!path_env) return NULL;
+
+    const char *p = path_env;
+    while (*p) {
+        const char *colon = strchr(p, ':');
+        size_t len = colon ? (size_t)(colon - p) : strlen(p);
+        char *dir = len ? amake_strndup(p, len) : amake_strdup(".");
+        char *full = amake_path_join(dir, name);
+        free(dir);
+        struct stat st;
+        if (stat(full, &st) == 0 && !S_ISDIR(st.st_mode) &&
+            (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+            return full;
+        free(full);
+        if (!colon) break;
+        p = colon + 1;
+    }
+    return NULL;
+}
+
+/*
+ * Fold in a tool's identity: resolved path, size and mtime (a compiler
+ * upgrade changes at least one of them; hashing a 100 MB binary per run
+ * would not pay for itself).
+ */
+static uint64_t hash_tool(ActionCache *ac, uint64_t h, const char *cmd) {
+    char *name = command_tool(ac, cmd);
+    if (!name) return h;
+
+    char *path = resolve_tool(name);
+    h = amake_hash_str(h, path ? path : name);
+    if (path) {
+        MtimeEntry *e = mtime_lookup(ac->mc, path);
+        long long stamp[2];
+        stamp[0] = (long long)e->mtime;
+        stamp[1] = e->size;
+        h = amake_hash_bytes(h, stamp, sizeof(stamp));
+    }
+    free(path);
+    free(name);
+    return h;
+}
+
+static uint64_t action_key(ActionCache *ac, BuildRule *rule) {
+    uint64_t h = amake_hash_str(0, CACHE_MAGIC);
+    int i;
+
+    h = amake_hash_bytes(h, &rule->cmd_hash, sizeof(rule->cmd_hash));
+    for (i = 0; i < rule->command_count; i++)
+        h = hash_tool(ac, h, rule->commands[i]);
+    for (i = 0; i < rule->output_count; i++)
+        h = amake_hash_str(h, rule->outputs[i]);
+    for (i = 0; i < rule->depend_count; i++) {
+        uint64_t ch = content_hash_get(ac->mc, rule->depends[i]);
+        h = amake_hash_str(h, rule->depends[i]);
+        h = amake_hash_bytes(h, &ch, sizeof(ch));
+    }
+    return h;
+}
+
+static char *entry_dir(const char *dir, uint64_t key) {
+    return amake_sprintf("%s/%02x/%016llx", dir, (unsigned)(key >> 56),
+                         (unsigned long long)key);
+}
+
+/* ── Fetch ───────────────────────────────────────────────────────────── */
+
+/*
+ * Parse a manifest and check that it describes this rule.
+ * Fills sizes[] and hashes[] (one per output).
+ */
+static int read_manifest(const char *path, BuildRule *rule,
+                         long long *sizes, uint64_t *hashes)
+{
+    size_t len;
+    char *data = amake_read_file(path, &len);
+    if (!data) return -1;
+
+    int ok = 0;
+    char *line = data;
+    char *nl = strchr(line, '\n');
+    if (nl && (size_t)(nl - line) == strlen(CACHE_MAGIC) &&
+        strncmp(line, CACHE_MAGIC, strlen(CACHE_MAGIC)) == 0) {
+        char *end;
+        uint64_t cmd = (uint64_t)strtoull(nl + 1, &end, 16);
+        long n = strtol(end, &end, 10);
+        ok = *end == '\n' && cmd == rule->cmd_hash && n == rule->output_count;
+
+        int i;
+        line = end + 1;
+        for (i = 0; ok && i < rule->output_count; i++) {
+            nl = strchr(line, '\n');
+            if (!nl) { ok = 0; break; }
+            *nl = '\0';
+            sizes[i] = strtoll(line, &end, 10);
+            if (*end != ' ') { ok = 0; break; }
+            hashes[i] = (uint64_t)strtoull(end + 1, &end, 16);
+            ok = *end == ' ' && strcmp(end + 1, rule->outputs[i]) == 0;
+            line = nl + 1;
+        }
+    }
+    free(data);
+    return ok ? 0 : -1;
+}
+
+/* Copy src to dst via dst.tmp, verifying size and hash before the rename. */
+static int restore_blob(const char *src, const char *dst,
+                        long long size, uint64_t hash)
+{
+    char *tmp = amake_sprintf("%s.tmp", dst);
+    uint64_t h;
+    struct stat st;
+    int ok = amake_copy_file(src, tmp) == 0 &&
+             stat(tmp, &st) == 0 && (long long)st.st_size == size &&
+             amake_hash_file(tmp, &h) == 0 && h == hash &&
+             rename(tmp, dst) == 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok ? 0 : -1;
+}
+
+static int fetch_from(ActionCache *ac, BuildRule *rule, const char *dir) {
+    char *edir = entry_dir(dir, rule->cache_key);
+    char *manifest = amake_path_join(edir, "manifest");
+    long long *sizes = amake_malloc(sizeof(long long) * (rule->output_count + 1));
+    uint64_t *hashes = amake_malloc(sizeof(uint64_t) * (rule->output_count + 1));
+    int i, ok = read_manifest(manifest, rule, sizes, hashes) == 0;
+
+    for (i = 0; ok && i < rule->output_count; i++) {
+        char *blob = amake_sprintf("%s/%d", edir, i);
+        char *parent = amake_strdup(rule->outputs[i]);
+        char *slash = strrchr(parent, '/');
+        if (slash && slash != parent) {
+            *slash = '\0';
+            amake_mkdir_p(parent);
+        }
+        ok = restore_blob(blob, rule->outputs[i], sizes[i], hashes[i]) == 0;
+        mtime_invalidate(ac->mc, rule->outputs[i]);
+        free(parent);
+        free(blob);
+    }
+
+    free(hashes);
+    free(sizes);
+    free(manifest);
+    free(edir);
+    return ok;
+}
+
+/*
+ * Try to satisfy a rule from the cache.
+ * Returns 1 if its outputs were restored, 0 if it has to run.
+ */
+int cache_fetch(ActionCache *ac, BuildRule *rule) {
+    int i;
+    rule->cache_miss = 0;
+    if (ac->dir_count == 0 || rule->command_count == 0 || rule->output_count == 0)
+        return 0;
+
+    rule->cache_key = action_key(ac, rule);
+    for (i = 0; i < ac->dir_count; i++) {
+        if (fetch_from(ac, rule, ac->dirs[i])) {
+            ac->hits++;
+            if (ac->verbose)
+                fprintf(stderr, "amake: cache hit %016llx in %s\n",
+                        (unsigned long long)rule->cache_key, ac->dirs[i]);
+            /* Pull shared hits into the local cache */
+            if (i > 0) {
+                int j;
+                for (j = 0; j < i; j++)
+                    cache_store_in(ac, rule, ac->dirs[j]);
+            }
+            return 1;
+        }
+    }
+
+    ac->misses++;
+    rule->cache_miss = 1;
+    return 0;
+}
+
+/* ── Store ───────────────────────────────────────────────────────────── */
+
+/*
+ * Store a rule's outputs into one cache directory. Directories or
+ * missing outputs make a rule uncacheable.
+ */
+void cache_store_in(ActionCache *ac, BuildRule *rule, const char *dir) {
+    int i;
+    struct stat st;
+
+    for (i = 0; i < rule->output_count; i++) {
+        if (stat(rule->outputs[i], &st) != 0 || !S_ISREG(st.st_mode))
+            return;
+    }
+
+    char *edir = entry_dir(dir, rule->cache_key);
+    char *manifest = amake_path_join(edir, "manifest");
+    char *tmp = amake_sprintf("%s.tmp", manifest);
+    amake_mkdir_p(edir);
+
+    /* Blobs first; the manifest makes the entry visible */
+    FILE *f = NULL;
+    int ok = 1;
+    for (i = 0; ok && i < rule->output_count; i++) {
+        char *blob = amake_sprintf("%s/%d", edir, i);
+        ok = amake_copy_file(rule->outputs[i], blob) == 0;
+        free(blob);
+    }
+    if (ok) f = fopen(tmp, "w");
+    if (f) {
+        fprintf(f, "%s\n%llx %d\n", CACHE_MAGIC,
+                (unsigned long long)rule->cmd_hash, rule->output_count);
+        for (i = 0; i < rule->output_count && ok; i++) {
+            uint64_t h;
+            ok = stat(rule->outputs[i], &st) == 0 &&
+                 amake_hash_file(rule->outputs[i], &h) == 0;
+            if (ok)
+                fprintf(f, "%lld %llx %s\n", (long long)st.st_size,
+                        (unsigned long long)h, rule->outputs[i]);
+        }
+        if (ferror(f)) ok = 0;
+        if (fclose(f) != 0) ok = 0;
+        /* Shares without rename get the manifest copied into place */
+        if (ok && rename(tmp, manifest) != 0)
+            ok = amake_copy_file(tmp, manifest) == 0;
+        remove(tmp);
+    } else {
+        ok = 0;
+    }
+
+    if (ok) {
+        ac->stores++;
+    } else if (ac->verbose) {
+        fprintf(stderr, "amake: warning: cannot store %s in cache %s\n",
+                rule->outputs[0], dir);
+    }
+    free(tmp);
+    free(manifest);
+    free(edir);
+}
+
+/*
+ * Store the outputs of a rule that missed and then ran successfully.
+ */
+void cache_store(ActionCache *ac, BuildRule *rule) {
+    int i;
+    if (!rule->cache_miss) return;
+    rule->cache_miss = 0;
+    for (i = 0; i < ac->dir_count; i++)
+        cache_store_in(ac, rule, ac->dirs[i]);
+}
@@ -174,10 +174,12 @@ static int eval_condition(AmakeCtx *ctx, char **raw_args, int argc) {
     /* Unary operators */
     if (argc == 2) {
         if (streqi(args[0], "EXISTS")) {
+            ctx_note_probe(ctx, args[1]);
             result = amake_file_exists(args[1]) || amake_is_directory(args[1]);
             goto done;
         }
         if (streqi(args[0], "IS_DIRECTORY")) {
+            ctx_note_probe(ctx, args[1]);
             result = amake_is_directory(args[1]);
             goto done;
         }
@@ -290,14 +292,16 @@ static void cmd_message(AmakeCtx *ctx, char **args, int argc) {
 
 /* ── Command: find_program() ─────────────────────────────────────────── */
 
-static int is_executable(const char *path) {
+static int is_executable(AmakeCtx *ctx, const char *path) {
     struct stat st;
+    ctx_note_probe(ctx, path);
     if (stat(path, &st) != 0) return 0;
     return (st.st_mode & S_IXUSR) || (st.st_mode & S_IXGRP) || (st.st_mode & S_IXOTH);
 }
 
-static char *find_in_path(const char *name) {
+static char *find_in_path(AmakeCtx *ctx, const char *name) {
     const char *path_env = getenv("PATH");
+    ctx_note_env(ctx, "PATH");
     if (!path_env) return NULL;
 
     char *path_copy = amake_strdup(path_env);
@@ -306,7 +310,7 @@ static char *find_in_path(const char *name) {
 
     while (dir) {
         char *full = amake_path_join(dir, name);
-        if (is_executable(full)) {
+        if (is_executable(ctx, full)) {
             free(path_copy);
             return full;
         }
@@ -344,7 +348,7 @@ static void cmd_find_program(AmakeCtx *ctx, char **args, int argc) {
             /* Each hint is a directory */
             for (i = names_start; i < names_end; i++) {
                 char *full = amake_path_join(args[j], args[i]);
-                if (is_executable(full)) {
+                if (is_executable(ctx, full)) {
                     scope_set(ctx->current_scope, var, full);
                     free(full);
                     return;
@@ -356,7 +360,7 @@ static void cmd_find_program(AmakeCtx *ctx, char **args, int argc) {
 
     /* Search PATH */
     for (i = names_start; i < names_end; i++) {
-        char *found = find_in_path(args[i]);
+        char *found = find_in_path(ctx, args[i]);
         if (found) {
             scope_set(ctx->current_scope, var, found);
             free(found);
@@ -419,8 +423,10 @@ static void cmd_file(AmakeCtx *ctx, char **args, int argc) {
     }
     else if (streqi(args[0], "MAKE_DIRECTORY")) {
         int i;
-        for (i = 1; i < argc; i++)
+        for (i = 1; i < argc; i++) {
             amake_mkdir_p(args[i]);
+            ctx_note_made_dir(ctx, args[i]);
+        }
     }
 }
 
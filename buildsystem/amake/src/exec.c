@@ -257,11 +257,7 @@ static pid_t spawn_command(const char *cmd, const char *working_dir) {
 
 /* ── Complete a rule ─────────────────────────────────────────────────── */
 
-static void rule_completed(Executor *ex, BuildRule *rule) {
-    rule->done = 1;
-    ex->built_count++;
-
-    /* Unblock dependents */
+static void unblock_dependents(Executor *ex, BuildRule *rule) {
     int i;
     for (i = 0; i < rule->blocked_count; i++) {
         BuildRule *dep = rule->blocked[i];
@@ -272,10 +268,27 @@ static void rule_completed(Executor *ex, BuildRule *rule) {
     }
 }
 
+static void rule_completed(Executor *ex, BuildRule *rule) {
+    rule->done = 1;
+    ex->built_count++;
+    if (ex->cache) cache_store(ex->cache, rule);
+    if (ex->state) state_record_rule(ex->state, rule);
+    unblock_dependents(ex, rule);
+}
+
+/* Early cutoff: the rule was only dirty through blockers whose outputs
+ * turned out unchanged, so there is nothing to run. */
+static void rule_skipped(Executor *ex, BuildRule *rule) {
+    rule->done = 1;
+    ex->skipped_count++;
+    unblock_dependents(ex, rule);
+}
+
 static void rule_failed(Executor *ex, BuildRule *rule) {
     rule->failed = 1;
     rule->done = 1;
     ex->failed_count++;
+    if (ex->state) state_forget_rule(ex->state, rule);
 }
 
 /* ── Main execution loop ─────────────────────────────────────────────── */
@@ -312,6 +325,12 @@ int exec_run(Executor *ex, BuildRule **dirty, int dirty_count) {
             BuildRule *rule = ready_pop(ex);
             if (!rule) break;
 
+            if (!rule->self_dirty && ex->state &&
+                state_rule_dirty(ex->state, rule) == 0) {
+                rule_skipped(ex, rule);
+                continue;
+            }
+
             if (rule->command_count == 0) {
                 /* No commands — just mark done (phony-like target) */
                 rule_completed(ex, rule);
@@ -321,14 +340,21 @@ int exec_run(Executor *ex, BuildRule **dirty, int dirty_count) {
             /* Print comment or first output */
             if (rule->comment) {
                 fprintf(stderr, "[%d/%d] %s\n",
-                        ex->built_count + ex->job_count + 1,
+                        ex->built_count + ex->skipped_count + ex->job_count + 1,
                         ex->total_dirty, rule->comment);
             } else if (rule->output_count > 0) {
                 fprintf(stderr, "[%d/%d] Building %s\n",
-                        ex->built_count + ex->job_count + 1,
+                        ex->built_count + ex->skipped_count + ex->job_count + 1,
                         ex->total_dirty, rule->outputs[0]);
             }
 
+            if (ex->cache && cache_fetch(ex->cache, rule)) {
+                if (ex->verbose)
+                    fprintf(stderr, "  (restored from cache)\n");
+                rule_completed(ex, rule);
+                continue;
+            }
+
             if (ex->verbose && rule->command_count > 0) {
                 fprintf(stderr, "  > %s\n", rule->commands[0]);
             }
@@ -477,13 +503,21 @@ int exec_run(Executor *ex, BuildRule **dirty, int dirty_count) {
 #endif
 
     /* Summary */
+    if (ex->cache && ex->cache->hits + ex->cache->misses > 0) {
+        fprintf(stderr, "amake: cache: %d hits, %d misses, %d stored\n",
+                ex->cache->hits, ex->cache->misses, ex->cache->stores);
+    }
     if (ex->failed_count > 0) {
         fprintf(stderr, "\namake: %d of %d rules FAILED\n",
                 ex->failed_count, ex->total_dirty);
         return 1;
     }
 
-    fprintf(stderr, "Build complete: %d rules executed.\n", ex->built_count);
+    if (ex->skipped_count > 0)
+        fprintf(stderr, "Build complete: %d rules executed, %d up to date.\n",
+                ex->built_count, ex->skipped_count);
+    else
+        fprintf(stderr, "Build complete: %d rules executed.\n", ex->built_count);
     return 0;
 }
 
@@ -99,9 +99,21 @@ static void split_glob_path(const char *glob_path, char **out_dir,
 
 /* ── Directory scanning ──────────────────────────────────────────────── */
 
+/* Every directory listed this session; a new or removed file changes its
+ * mtime, so the graph cache revalidates globs by stat()ing these. */
+static FileList scanned_dirs;
+
+static void note_scanned(const char *dir) {
+    int i;
+    for (i = 0; i < scanned_dirs.count; i++)
+        if (strcmp(scanned_dirs.files[i], dir) == 0) return;
+    fl_push(&scanned_dirs, dir);
+}
+
 static void scan_dir(const char *dir, const char *pattern, int recurse,
                      FileList *fl)
 {
+    note_scanned(dir);
     DIR *dp = opendir(dir);
     if (!dp) return;
 
@@ -176,3 +188,11 @@ void amake_glob_recurse(const char *base_dir, const char *glob_path,
 
     (void)base_dir; /* unused — dir is extracted from pattern */
 }
+
+/*
+ * Directories scanned by globs so far (owned by glob.c).
+ */
+void amake_glob_scanned(char ***out_dirs, int *out_count) {
+    *out_dirs = scanned_dirs.files;
+    *out_count = scanned_dirs.count;
+}
@@ -2,7 +2,7 @@
  * graph.c — Dependency graph for amake
  *
  * Links BuildRules and BuildTargets into a DAG, performs topological sort,
- * and marks dirty nodes based on file mtimes.
+ * and marks dirty nodes based on recorded content hashes or file mtimes.
  */
 #include "amake.h"
 
@@ -98,15 +98,22 @@ void graph_link(BuildGraph *g) {
 /* ── Dirty detection ─────────────────────────────────────────────────── */
 
 /*
- * Check if a rule needs rebuilding based on file mtimes.
- * A rule is dirty if:
+ * Check if a rule needs rebuilding on its own account.
+ * With a state record, a rule is dirty if an output is missing, its
+ * command changed, or an input's content differs from the last build.
+ * Without one, it falls back to mtimes and is dirty if:
  *   - Any output file doesn't exist
  *   - Any source-file dependency is newer than the oldest output
- *   - Any blocker rule is dirty (transitive)
+ * Blockers are handled by graph_mark_dirty().
  */
-static int check_rule_dirty(BuildRule *rule, MtimeCache *mc) {
+static int check_rule_dirty(BuildRule *rule, MtimeCache *mc, BuildState *st) {
     int j;
 
+    if (st) {
+        int d = state_rule_dirty(st, rule);
+        if (d >= 0) return d;
+    }
+
     /* Find oldest output mtime */
     time_t oldest_output = 0;
     int all_outputs_exist = 1;
@@ -131,18 +138,25 @@ static int check_rule_dirty(BuildRule *rule, MtimeCache *mc) {
             return 1;
     }
 
+    /* Clean by mtime: start tracking it so later touches are seen through */
+    if (st) state_record_rule(st, rule);
     return 0;
 }
 
-void graph_mark_dirty(BuildGraph *g, MtimeCache *mc) {
+void graph_mark_dirty(BuildGraph *g, MtimeCache *mc, BuildState *st) {
     int i;
 
     /* First pass: check each rule's own files */
     for (i = 0; i < g->rule_count; i++) {
-        g->rules[i]->dirty = check_rule_dirty(g->rules[i], mc);
+        BuildRule *rule = g->rules[i];
+        rule->cmd_hash = state_command_hash(rule);
+        rule->self_dirty = check_rule_dirty(rule, mc, st);
+        rule->dirty = rule->self_dirty;
     }
 
-    /* Propagate dirty flag: if a blocker is dirty, the dependent is dirty too.
+    /* Propagate dirty flag: if a blocker is dirty, the dependent may be too.
+     * With state, the executor re-checks such rules once their blockers
+     * finish and skips them if the blockers' outputs came out unchanged.
      * Iterate until no changes (simple fixpoint). */
     int changed = 1;
     while (changed) {
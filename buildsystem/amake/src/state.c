@@ -0,0 +1,729 @@
+/*
+ * state.c — Persistent build state for amake
+ *
+ * Two files live in the build directory:
+ *
+ *   .amake_state  One record per rule, keyed by its first output: a hash of
+ *                 its command lines, and the mtime, size and content hash of
+ *                 every input and output as of its last successful run.
+ *   .amake_graph  The evaluated build graph, stamped with everything the
+ *                 evaluation looked at (build file, glob directories, probed
+ *                 paths, environment), so an unchanged project skips the
+ *                 lexer, parser and evaluator entirely.
+ *
+ * A rule is rebuilt when its command changes or an input's content does;
+ * touching a file without changing it costs one hash, not a rebuild.
+ * Because dependents compare content rather than mtimes, a rule whose
+ * outputs come out byte-identical stops the rebuild from propagating
+ * (early cutoff).
+ */
+#include "amake.h"
+
+#define STATE_MAGIC "amake-state 1"
+#define GRAPH_MAGIC "amake-graph 1"
+
+/* ── Helpers ─────────────────────────────────────────────────────────── */
+
+static unsigned int key_hash(const char *s) {
+    unsigned int h = 5381;
+    while (*s)
+        h = h * 33 + (unsigned char)*s++;
+    return h % STATE_BUCKETS;
+}
+
+/*
+ * A file written in the current second can change again without its
+ * mtime moving, so such an mtime must not let the fast path skip hashing.
+ */
+static time_t trusted_mtime(time_t mt) {
+    return mt + 1 >= time(NULL) ? 0 : mt;
+}
+
+static char *tmp_path(const char *path) {
+    return amake_sprintf("%s.tmp", path);
+}
+
+/* ── Command hash ────────────────────────────────────────────────────── */
+
+uint64_t state_command_hash(const BuildRule *rule) {
+    uint64_t h = amake_hash_str(0, rule->working_dir);
+    int i;
+    for (i = 0; i < rule->command_count; i++)
+        h = amake_hash_str(h, rule->commands[i]);
+    return h;
+}
+
+/* ── Records ─────────────────────────────────────────────────────────── */
+
+void state_init(BuildState *st, MtimeCache *mc, int verbose) {
+    memset(st, 0, sizeof(BuildState));
+    st->mc = mc;
+    st->verbose = verbose;
+}
+
+static void free_files(StateFile *files, int count) {
+    int i;
+    for (i = 0; i < count; i++) free(files[i].path);
+    free(files);
+}
+
+static void free_record(StateRecord *rec) {
+    free(rec->key);
+    free_files(rec->inputs, rec->input_count);
+    free_files(rec->outputs, rec->output_count);
+    free(rec);
+}
+
+void state_free(BuildState *st) {
+    int i;
+    for (i = 0; i < STATE_BUCKETS; i++) {
+        StateRecord *rec = st->buckets[i];
+        while (rec) {
+            StateRecord *next = rec->next;
+            free_record(rec);
+            rec = next;
+        }
+        st->buckets[i] = NULL;
+    }
+}
+
+static StateRecord *find_record(BuildState *st, const char *key) {
+    StateRecord *rec = st->buckets[key_hash(key)];
+    while (rec) {
+        if (strcmp(rec->key, key) == 0) return rec;
+        rec = rec->next;
+    }
+    return NULL;
+}
+
+static StateRecord *add_record(BuildState *st, const char *key) {
+    unsigned int h = key_hash(key);
+    StateRecord *rec = amake_malloc(sizeof(StateRecord));
+    memset(rec, 0, sizeof(StateRecord));
+    rec->key = amake_strdup(key);
+    rec->next = st->buckets[h];
+    st->buckets[h] = rec;
+    return rec;
+}
+
+/* ── Load / save ─────────────────────────────────────────────────────── */
+
+/* Parse "<mtime> <size> <hash> <path>" into *sf. */
+static int parse_file_line(char *p, StateFile *sf) {
+    char *end;
+    sf->mtime = (time_t)strtoll(p, &end, 10);
+    if (*end != ' ') return -1;
+    sf->size = strtoll(end + 1, &end, 10);
+    if (*end != ' ') return -1;
+    sf->hash = (uint64_t)strtoull(end + 1, &end, 16);
+    if (*end != ' ') return -1;
+    sf->path = amake_strdup(end + 1);
+    return 0;
+}
+
+/*
+ * Load .amake_state. A missing or malformed file just means every rule
+ * falls back to mtime comparison for this run.
+ */
+void state_load(BuildState *st, const char *path) {
+    size_t size;
+    char *data = amake_read_file(path, &size);
+    if (!data) return;
+
+    char *line = data;
+    char *nl = strchr(line, '\n');
+    if (!nl || (size_t)(nl - line) != strlen(STATE_MAGIC) ||
+        strncmp(line, STATE_MAGIC, strlen(STATE_MAGIC)) != 0) {
+        free(data);
+        return;
+    }
+    st->loaded = 1;
+
+    StateRecord *rec = NULL;
+    int in_cap = 0, out_cap = 0;
+    for (line = nl + 1; *line; line = nl + 1) {
+        nl = strchr(line, '\n');
+        if (!nl) break;
+        *nl = '\0';
+
+        if (line[0] == 'R' && line[1] == ' ') {
+            /* R <cmd_hash> <inputs> <outputs> <key> */
+            char *end;
+            uint64_t cmd = (uint64_t)strtoull(line + 2, &end, 16);
+            int nin = (int)strtol(end, &end, 10);
+            int nout = (int)strtol(end, &end, 10);
+            if (*end != ' ' || nin < 0 || nout < 0 || find_record(st, end + 1)) {
+                rec = NULL;
+                continue;
+            }
+            rec = add_record(st, end + 1);
+            rec->cmd_hash = cmd;
+            in_cap = nin;
+            out_cap = nout;
+            rec->inputs = amake_malloc(sizeof(StateFile) * (nin + 1));
+            rec->outputs = amake_malloc(sizeof(StateFile) * (nout + 1));
+        } else if (rec && line[0] == 'I' && line[1] == ' ' &&
+                   rec->input_count < in_cap) {
+            if (parse_file_line(line + 2, &rec->inputs[rec->input_count]) == 0)
+                rec->input_count++;
+        } else if (rec && line[0] == 'O' && line[1] == ' ' &&
+                   rec->output_count < out_cap) {
+            if (parse_file_line(line + 2, &rec->outputs[rec->output_count]) == 0)
+                rec->output_count++;
+        }
+    }
+    free(data);
+}
+
+static void write_file_line(FILE *f, char tag, const StateFile *sf) {
+    fprintf(f, "%c %lld %lld %llx %s\n", tag, (long long)sf->mtime, sf->size,
+            (unsigned long long)sf->hash, sf->path);
+}
+
+/*
+ * Write the state back if anything changed. The file is replaced
+ * atomically so an interrupted build never leaves a torn database.
+ */
+int state_save(BuildState *st, const char *path) {
+    if (!st->changed) return 0;
+
+    char *tmp = tmp_path(path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        free(tmp);
+        return -1;
+    }
+
+    fprintf(f, "%s\n", STATE_MAGIC);
+    int i, j;
+    for (i = 0; i < STATE_BUCKETS; i++) {
+        StateRecord *rec;
+        for (rec = st->buckets[i]; rec; rec = rec->next) {
+            fprintf(f, "R %llx %d %d %s\n", (unsigned long long)rec->cmd_hash,
+                    rec->input_count, rec->output_count, rec->key);
+            for (j = 0; j < rec->input_count; j++)
+                write_file_line(f, 'I', &rec->inputs[j]);
+            for (j = 0; j < rec->output_count; j++)
+                write_file_line(f, 'O', &rec->outputs[j]);
+        }
+    }
+
+    int err = ferror(f);
+    if (fclose(f) != 0) err = 1;
+    if (err || rename(tmp, path) != 0) {
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    st->changed = 0;
+    return 0;
+}
+
+/* ── Dirty check ─────────────────────────────────────────────────────── */
+
+/*
+ * Has this file kept the content recorded in *sf? Matching mtime and size
+ * is taken on trust; otherwise the file is hashed, and a touched but
+ * identical file has its new mtime recorded so the next run skips the hash.
+ */
+static int file_unchanged(BuildState *st, StateFile *sf) {
+    MtimeEntry *e = mtime_lookup(st->mc, sf->path);
+
+    if (e->size < 0 || sf->size < 0)
+        return e->size < 0 && sf->size < 0;
+    if (e->size != sf->size)
+        return 0;
+    if (sf->mtime != 0 && e->mtime == sf->mtime)
+        return 1;
+    if (content_hash_get(st->mc, sf->path) != sf->hash)
+        return 0;
+
+    time_t mt = trusted_mtime(e->mtime);
+    if (mt != sf->mtime) {
+        sf->mtime = mt;
+        st->changed = 1;
+    }
+    return 1;
+}
+
+/*
+ * Decide from the recorded state whether a rule must run.
+ * Returns 1 if dirty, 0 if clean, -1 if there is no state to go by.
+ * Once a state file exists, a rule without a record has never finished
+ * successfully (or is new), so it is dirty even if stale outputs exist.
+ */
+int state_rule_dirty(BuildState *st, BuildRule *rule) {
+    int j;
+    if (rule->output_count == 0) return -1;
+
+    StateRecord *rec = find_record(st, rule->outputs[0]);
+    if (!rec) return st->loaded ? 1 : -1;
+
+    if (rec->cmd_hash != rule->cmd_hash) {
+        if (st->verbose)
+            fprintf(stderr, "amake: %s: command changed\n", rule->outputs[0]);
+        return 1;
+    }
+    if (rec->input_count != rule->depend_count ||
+        rec->output_count != rule->output_count)
+        return 1;
+
+    for (j = 0; j < rule->output_count; j++) {
+        if (strcmp(rec->outputs[j].path, rule->outputs[j]) != 0)
+            return 1;
+        if (mtime_lookup(st->mc, rule->outputs[j])->size < 0)
+            return 1;
+    }
+
+    for (j = 0; j < rule->depend_count; j++) {
+        if (strcmp(rec->inputs[j].path, rule->depends[j]) != 0)
+            return 1;
+        if (!file_unchanged(st, &rec->inputs[j])) {
+            if (st->verbose)
+                fprintf(stderr, "amake: %s: %s changed\n",
+                        rule->outputs[0], rule->depends[j]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ── Recording ───────────────────────────────────────────────────────── */
+
+static void fill_file(BuildState *st, StateFile *sf, const char *path) {
+    MtimeEntry *e = mtime_lookup(st->mc, path);
+    sf->path = amake_strdup(path);
+    sf->size = e->size;
+    sf->mtime = e->size < 0 ? 0 : trusted_mtime(e->mtime);
+    sf->hash = content_hash_get(st->mc, path);
+}
+
+/*
+ * Record a rule as up to date with its current inputs and outputs.
+ * Called after it ran successfully, or when mtimes show it is clean but
+ * it has no record yet.
+ */
+void state_record_rule(BuildState *st, BuildRule *rule) {
+    int j;
+
+    for (j = 0; j < rule->output_count; j++)
+        mtime_invalidate(st->mc, rule->outputs[j]);
+    if (rule->output_count == 0) return;
+
+    StateRecord *rec = find_record(st, rule->outputs[0]);
+    if (!rec) rec = add_record(st, rule->outputs[0]);
+
+    StateFile *old_outputs = rec->outputs;
+    int old_output_count = rec->output_count;
+
+    free_files(rec->inputs, rec->input_count);
+    rec->cmd_hash = rule->cmd_hash;
+    rec->input_count = rule->depend_count;
+    rec->inputs = amake_malloc(sizeof(StateFile) * (rule->depend_count + 1));
+    for (j = 0; j < rule->depend_count; j++)
+        fill_file(st, &rec->inputs[j], rule->depends[j]);
+
+    rec->output_count = rule->output_count;
+    rec->outputs = amake_malloc(sizeof(StateFile) * (rule->output_count + 1));
+    for (j = 0; j < rule->output_count; j++)
+        fill_file(st, &rec->outputs[j], rule->outputs[j]);
+
+    if (st->verbose && old_output_count == rec->output_count) {
+        int same = 1;
+        for (j = 0; j < rec->output_count && same; j++)
+            same = old_outputs[j].size >= 0 &&
+                   old_outputs[j].hash == rec->outputs[j].hash;
+        if (same)
+            fprintf(stderr, "amake: %s unchanged\n", rule->outputs[0]);
+    }
+    free_files(old_outputs, old_output_count);
+    st->changed = 1;
+}
+
+/*
+ * Drop a rule's record after it failed, so it reruns next time.
+ */
+void state_forget_rule(BuildState *st, BuildRule *rule) {
+    int j;
+    for (j = 0; j < rule->output_count; j++)
+        mtime_invalidate(st->mc, rule->outputs[j]);
+    if (rule->output_count == 0) return;
+
+    StateRecord **pp = &st->buckets[key_hash(rule->outputs[0])];
+    while (*pp) {
+        if (strcmp((*pp)->key, rule->outputs[0]) == 0) {
+            StateRecord *rec = *pp;
+            *pp = rec->next;
+            free_record(rec);
+            st->changed = 1;
+            return;
+        }
+        pp = &(*pp)->next;
+    }
+}
+
+/* ── Evaluation inputs ───────────────────────────────────────────────── */
+
+static void note_unique(char ***list, int *count, const char *s) {
+    int i;
+    for (i = 0; i < *count; i++)
+        if (strcmp((*list)[i], s) == 0) return;
+    *list = amake_realloc(*list, sizeof(char *) * (*count + 1));
+    (*list)[(*count)++] = amake_strdup(s);
+}
+
+void ctx_note_env(AmakeCtx *ctx, const char *name) {
+    note_unique(&ctx->env_names, &ctx->env_count, name);
+}
+
+void ctx_note_made_dir(AmakeCtx *ctx, const char *path) {
+    note_unique(&ctx->made_dirs, &ctx->made_dir_count, path);
+}
+
+void ctx_note_probe(AmakeCtx *ctx, const char *path) {
+    note_unique(&ctx->probes, &ctx->probe_count, path);
+}
+
+void ctx_free_notes(AmakeCtx *ctx) {
+    int i;
+    for (i = 0; i < ctx->env_count; i++) free(ctx->env_names[i]);
+    free(ctx->env_names);
+    for (i = 0; i < ctx->made_dir_count; i++) free(ctx->made_dirs[i]);
+    free(ctx->made_dirs);
+    for (i = 0; i < ctx->probe_count; i++) free(ctx->probes[i]);
+    free(ctx->probes);
+    ctx->env_names = ctx->made_dirs = ctx->probes = NULL;
+    ctx->env_count = ctx->made_dir_count = ctx->probe_count = 0;
+}
+
+/* 0 = missing, 1 = file, 2 = executable file, 3 = directory */
+static int probe_kind(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    if (S_ISDIR(st.st_mode)) return 3;
+    if (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) return 2;
+    return 1;
+}
+
+/* ── Graph cache: serialization ──────────────────────────────────────── */
+
+/*
+ * The graph file is a flat sequence of newline-terminated decimal numbers
+ * and length-prefixed strings ("<len> <bytes>\n", or "-1\n" for NULL), so
+ * commands and comments may contain any byte.
+ */
+
+static void wr_num(FILE *f, long long v) {
+    fprintf(f, "%lld\n", v);
+}
+
+static void wr_str(FILE *f, const char *s) {
+    if (!s) {
+        fputs("-1\n", f);
+        return;
+    }
+    size_t n = strlen(s);
+    fprintf(f, "%lld ", (long long)n);
+    fwrite(s, 1, n, f);
+    fputc('\n', f);
+}
+
+static void wr_strs(FILE *f, char **v, int n) {
+    int i;
+    wr_num(f, n);
+    for (i = 0; i < n; i++) wr_str(f, v[i]);
+}
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int         bad;
+} Reader;
+
+static long long rd_num(Reader *r) {
+    char *e;
+    if (r->bad || r->p >= r->end) {
+        r->bad = 1;
+        return 0;
+    }
+    long long v = strtoll(r->p, &e, 10);
+    if (e == r->p || e >= r->end || (*e != '\n' && *e != ' ')) {
+        r->bad = 1;
+        return 0;
+    }
+    r->p = e + 1;
+    return v;
+}
+
+static char *rd_str(Reader *r) {
+    long long n = rd_num(r);
+    if (r->bad || n < 0) return NULL;
+    if (r->p[-1] != ' ' || n >= r->end - r->p || r->p[n] != '\n') {
+        r->bad = 1;
+        return NULL;
+    }
+    char *s = amake_strndup(r->p, (size_t)n);
+    r->p += n + 1;
+    return s;
+}
+
+/* Read a counted string list; counts are sanity-checked against the file. */
+static char **rd_strs(Reader *r, int *out_count) {
+    long long n = rd_num(r);
+    *out_count = 0;
+    if (r->bad || n < 0 || n > r->end - r->p) {
+        r->bad = 1;
+        return NULL;
+    }
+    char **v = amake_malloc(sizeof(char *) * (size_t)(n + 1));
+    int i;
+    for (i = 0; i < n && !r->bad; i++) {
+        v[i] = rd_str(r);
+        if (!v[i]) r->bad = 1;
+        else (*out_count)++;
+    }
+    if (n == 0) {
+        free(v);
+        return NULL;
+    }
+    return v;
+}
+
+/* ── Graph cache: key and validation ─────────────────────────────────── */
+
+/*
+ * Everything outside the filesystem that evaluation depends on: paths,
+ * -D defines, and the amake binary itself.
+ */
+uint64_t graph_cache_key(const AmakeCtx *ctx) {
+    uint64_t h = amake_hash_str(0, GRAPH_MAGIC);
+    h = amake_hash_str(h, AMAKE_VERSION);
+    h = amake_hash_str(h, ctx->source_dir);
+    h = amake_hash_str(h, ctx->binary_dir);
+    h = amake_hash_str(h, ctx->cmake_file);
+    h = amake_hash_str(h, ctx->amake_path);
+
+    struct stat st;
+    if (stat(ctx->amake_path, &st) == 0) {
+        long long stamp[2];
+        stamp[0] = (long long)st.st_mtime;
+        stamp[1] = (long long)st.st_size;
+        h = amake_hash_bytes(h, stamp, sizeof(stamp));
+    }
+
+    int i;
+    for (i = 0; i < ctx->cli_define_count; i++)
+        h = amake_hash_str(h, ctx->cli_defines[i]);
+    return h;
+}
+
+int graph_cache_save(const AmakeCtx *ctx, const char *path, uint64_t key) {
+    struct stat st;
+    int i;
+
+    char *tmp = tmp_path(path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        free(tmp);
+        return -1;
+    }
+
+    fprintf(f, "%s\n", GRAPH_MAGIC);
+    wr_num(f, (long long)key);
+
+    /* Build file: mtime (0 if untrusted), size, content hash */
+    uint64_t h = 0;
+    long long mt = 0, size = -1;
+    if (stat(ctx->cmake_file, &st) == 0 && amake_hash_file(ctx->cmake_file, &h) == 0) {
+        mt = (long long)trusted_mtime(st.st_mtime);
+        size = (long long)st.st_size;
+    }
+    wr_str(f, ctx->cmake_file);
+    wr_num(f, mt);
+    wr_num(f, size);
+    wr_num(f, (long long)h);
+
+    /* Environment variables and their values */
+    wr_num(f, ctx->env_count);
+    for (i = 0; i < ctx->env_count; i++) {
+        wr_str(f, ctx->env_names[i]);
+        wr_str(f, getenv(ctx->env_names[i]));
+    }
+
+    /* Glob directories; -1 forces re-evaluation if the mtime is racy */
+    char **dirs;
+    int dir_count;
+    amake_glob_scanned(&dirs, &dir_count);
+    wr_num(f, dir_count);
+    for (i = 0; i < dir_count; i++) {
+        wr_str(f, dirs[i]);
+        if (stat(dirs[i], &st) != 0) wr_num(f, 0);
+        else if (trusted_mtime(st.st_mtime) == 0) wr_num(f, -1);
+        else wr_num(f, (long long)st.st_mtime);
+    }
+
+    /* Probed paths and what they were */
+    wr_num(f, ctx->probe_count);
+    for (i = 0; i < ctx->probe_count; i++) {
+        wr_str(f, ctx->probes[i]);
+        wr_num(f, probe_kind(ctx->probes[i]));
+    }
+
+    wr_strs(f, ctx->made_dirs, ctx->made_dir_count);
+
+    /* Rules */
+    const BuildGraph *g = &ctx->graph;
+    wr_num(f, g->rule_count);
+    for (i = 0; i < g->rule_count; i++) {
+        const BuildRule *r = g->rules[i];
+        wr_strs(f, r->outputs, r->output_count);
+        wr_strs(f, r->commands, r->command_count);
+        wr_strs(f, r->depends, r->depend_count);
+        wr_str(f, r->comment);
+        wr_str(f, r->working_dir);
+    }
+
+    /* Targets */
+    wr_num(f, g->target_count);
+    for (i = 0; i < g->target_count; i++) {
+        const BuildTarget *t = g->targets[i];
+        wr_str(f, t->name);
+        wr_strs(f, t->depends, t->depend_count);
+        wr_strs(f, t->commands, t->command_count);
+        wr_str(f, t->comment);
+        wr_num(f, t->is_default);
+        wr_num(f, t->uses_terminal);
+    }
+
+    int err = ferror(f);
+    if (fclose(f) != 0) err = 1;
+    if (err || rename(tmp, path) != 0) {
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    return 0;
+}
+
+/* Check the stamps at the head of the graph file against the filesystem. */
+static int graph_cache_fresh(AmakeCtx *ctx, Reader *r, uint64_t key) {
+    struct stat st;
+    long long i, n;
+    int fresh;
+
+    if ((uint64_t)rd_num(r) != key || r->bad) return 0;
+
+    /* Build file: same size, and same mtime or same content */
+    char *file = rd_str(r);
+    long long mt = rd_num(r);
+    long long size = rd_num(r);
+    uint64_t h = (uint64_t)rd_num(r);
+    fresh = !r->bad && file && strcmp(file, ctx->cmake_file) == 0 &&
+            stat(file, &st) == 0 && (long long)st.st_size == size;
+    if (fresh && (mt == 0 || (long long)st.st_mtime != mt)) {
+        uint64_t now_h;
+        fresh = amake_hash_file(file, &now_h) == 0 && now_h == h;
+    }
+    free(file);
+    if (!fresh) return 0;
+
+    /* Environment */
+    n = rd_num(r);
+    for (i = 0; i < n && fresh && !r->bad; i++) {
+        char *name = rd_str(r);
+        char *val = rd_str(r);
+        const char *cur = name ? getenv(name) : NULL;
+        if ((cur == NULL) != (val == NULL) || (cur && strcmp(cur, val) != 0))
+            fresh = 0;
+        free(name);
+        free(val);
+    }
+    if (!fresh) return 0;
+
+    /* Glob directories */
+    n = rd_num(r);
+    for (i = 0; i < n && fresh && !r->bad; i++) {
+        char *dir = rd_str(r);
+        long long dmt = rd_num(r);
+        long long cur = dir && stat(dir, &st) == 0 ? (long long)st.st_mtime : 0;
+        if (!dir || dmt < 0 || cur != dmt) fresh = 0;
+        free(dir);
+    }
+    if (!fresh) return 0;
+
+    /* Probed paths */
+    n = rd_num(r);
+    for (i = 0; i < n && fresh && !r->bad; i++) {
+        char *p = rd_str(r);
+        long long kind = rd_num(r);
+        if (!p || probe_kind(p) != kind) fresh = 0;
+        free(p);
+    }
+
+    return fresh && !r->bad;
+}
+
+/*
+ * Load the cached graph into ctx if it is still valid.
+ * Returns 1 on success, 0 if the project must be re-evaluated.
+ */
+int graph_cache_load(AmakeCtx *ctx, const char *path, uint64_t key) {
+    size_t size;
+    char *data = amake_read_file(path, &size);
+    if (!data) return 0;
+
+    Reader r;
+    size_t mlen = strlen(GRAPH_MAGIC);
+    r.p = data;
+    r.end = data + size;
+    r.bad = 0;
+    if (size <= mlen || strncmp(data, GRAPH_MAGIC, mlen) != 0 || data[mlen] != '\n' ||
+        (r.p = data + mlen + 1, !graph_cache_fresh(ctx, &r, key))) {
+        free(data);
+        return 0;
+    }
+
+    int made_count;
+    char **made = rd_strs(&r, &made_count);
+
+    long long i, n = rd_num(&r);
+    for (i = 0; i < n && !r.bad; i++) {
+        BuildRule *rule = graph_add_rule(&ctx->graph);
+        rule->outputs = rd_strs(&r, &rule->output_count);
+        rule->commands = rd_strs(&r, &rule->command_count);
+        rule->depends = rd_strs(&r, &rule->depend_count);
+        rule->comment = rd_str(&r);
+        rule->working_dir = rd_str(&r);
+    }
+
+    n = rd_num(&r);
+    for (i = 0; i < n && !r.bad; i++) {
+        BuildTarget *t = graph_add_target(&ctx->graph);
+        t->name = rd_str(&r);
+        t->depends = rd_strs(&r, &t->depend_count);
+        t->commands = rd_strs(&r, &t->command_count);
+        t->comment = rd_str(&r);
+        t->is_default = (int)rd_num(&r);
+        t->uses_terminal = (int)rd_num(&r);
+        if (!t->name) r.bad = 1;
+    }
+    free(data);
+
+    if (r.bad) {
+        for (i = 0; i < made_count; i++) free(made[i]);
+        free(made);
+        graph_free(&ctx->graph);
+        graph_init(&ctx->graph);
+        return 0;
+    }
+
+    /* Replay evaluation side effects */
+    for (i = 0; i < made_count; i++) {
+        amake_mkdir_p(made[i]);
+        free(made[i]);
+    }
+    free(made);
+    return 1;
+}
@@ -1,7 +1,8 @@
 /*
- * track.c — File mtime tracking for amake
+ * track.c — File mtime and content tracking for amake
  *
- * Caches stat() results to avoid redundant syscalls during dirty detection.
+ * Caches stat() results and content hashes to avoid redundant syscalls and
+ * reads during dirty detection.
  */
 #include "amake.h"
 
@@ -35,34 +36,130 @@ void mtime_cache_free(MtimeCache *mc) {
 }
 
 /*
- * Get mtime for a path. Returns 0 if file does not exist.
- * Results are cached per session.
+ * Look up (and stat on first use) the cache entry for a path.
+ * Results are cached per session until mtime_invalidate().
  */
-time_t mtime_get(MtimeCache *mc, const char *path) {
+MtimeEntry *mtime_lookup(MtimeCache *mc, const char *path) {
     unsigned int h = path_hash(path);
     MtimeEntry *e = mc->buckets[h];
 
     /* Check cache */
     while (e) {
         if (strcmp(e->path, path) == 0)
-            return e->mtime;
+            break;
         e = e->next;
     }
+    if (e && e->valid)
+        return e;
+
+    if (!e) {
+        e = amake_malloc(sizeof(MtimeEntry));
+        e->path = amake_strdup(path);
+        e->next = mc->buckets[h];
+        mc->buckets[h] = e;
+    }
 
     /* Cache miss — stat the file */
     struct stat st;
-    time_t mt = 0;
+    e->mtime = 0;
+    e->size = -1;
+    e->is_dir = 0;
     if (stat(path, &st) == 0) {
-        mt = st.st_mtime;
+        e->mtime = st.st_mtime;
+        e->size = (long long)st.st_size;
+        e->is_dir = S_ISDIR(st.st_mode) ? 1 : 0;
     }
-
-    /* Cache the result */
-    e = amake_malloc(sizeof(MtimeEntry));
-    e->path = amake_strdup(path);
-    e->mtime = mt;
     e->valid = 1;
-    e->next = mc->buckets[h];
-    mc->buckets[h] = e;
+    e->hashed = 0;
+    e->hash = 0;
+
+    return e;
+}
+
+/*
+ * Get mtime for a path. Returns 0 if file does not exist.
+ */
+time_t mtime_get(MtimeCache *mc, const char *path) {
+    return mtime_lookup(mc, path)->mtime;
+}
+
+/*
+ * Forget what we know about a path (after a rule rewrote it).
+ */
+void mtime_invalidate(MtimeCache *mc, const char *path) {
+    MtimeEntry *e = mc->buckets[path_hash(path)];
+    while (e) {
+        if (strcmp(e->path, path) == 0) {
+            e->valid = 0;
+            return;
+        }
+        e = e->next;
+    }
+}
+
+/* ── Content hashing ─────────────────────────────────────────────────── */
+
+/* 64-bit FNV-1a */
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+uint64_t amake_hash_bytes(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    size_t i;
+    if (h == 0) h = FNV_OFFSET;
+    for (i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
 
-    return mt;
+/* Hash a string including its terminator, so "ab","c" != "a","bc". */
+uint64_t amake_hash_str(uint64_t h, const char *s) {
+    if (!s) return amake_hash_bytes(h, "\xff", 1);
+    return amake_hash_bytes(h, s, strlen(s) + 1);
+}
+
+/*
+ * Hash a file's contents. Returns 0 on success, -1 if unreadable.
+ */
+int amake_hash_file(const char *path, uint64_t *out_hash) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    char *buf = amake_malloc(65536);
+    uint64_t h = FNV_OFFSET;
+    size_t n;
+    while ((n = fread(buf, 1, 65536, f)) > 0)
+        h = amake_hash_bytes(h, buf, n);
+    int err = ferror(f);
+    fclose(f);
+    free(buf);
+    if (err) return -1;
+
+    *out_hash = h;
+    return 0;
+}
+
+/*
+ * Content hash of a path, computed at most once per session.
+ * Missing files hash to 0; directories hash their mtime (their "content"
+ * is a listing we do not track).
+ */
+uint64_t content_hash_get(MtimeCache *mc, const char *path) {
+    MtimeEntry *e = mtime_lookup(mc, path);
+    if (e->hashed) return e->hash;
+
+    uint64_t h = 0;
+    if (e->size < 0) {
+        h = 0;
+    } else if (e->is_dir) {
+        long long mt = (long long)e->mtime;
+        h = amake_hash_bytes(0, &mt, sizeof(mt));
+    } else if (amake_hash_file(path, &h) != 0) {
+        h = 0;
+    }
+    e->hash = h;
+    e->hashed = 1;
+    return h;
 }
@@ -136,6 +136,7 @@ char *expand_vars(AmakeCtx *ctx, const char *input) {
             }
             char *envname = amake_strndup(start, (size_t)(q - start));
             const char *val = getenv(envname);
+            ctx_note_env(ctx, envname);
             free(envname);
             if (val) {
                 size_t vlen = strlen(val);
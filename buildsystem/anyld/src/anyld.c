@@ -12,6 +12,11 @@
  */
 #include "anyld.h"
 
+#ifdef ANYLD_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #ifdef ONE_SOURCE
 /* Single-source compilation mode (for TCC on anyOS) */
 #include "defs.c"
@@ -118,15 +123,49 @@ void buf_free(Buf *b) {
 
 /* ── Symbol table operations ────────────────────────────────────────── */
 
-int find_global_sym(Ctx *ctx, const char *name) {
-    /* Linear search — fine for typical library sizes.
-     * Could add a hash table if this becomes a bottleneck. */
-    for (int i = 0; i < ctx->nsyms; i++) {
-        if (ctx->syms[i].name && strcmp(ctx->syms[i].name, name) == 0 &&
-            ctx->syms[i].bind != STB_LOCAL)
-            return i;
+/* Slot in ctx->sym_hash holding `name`, or the empty slot where it
+ * would go.  The table is never full (see sym_hash_insert). */
+static uint32_t sym_hash_slot(Ctx *ctx, const char *name, uint32_t h) {
+    uint32_t i = h & ctx->sym_hash_mask;
+    for (;;) {
+        int idx = ctx->sym_hash[i] - 1;
+        if (idx < 0) return i;
+        Symbol *s = &ctx->syms[idx];
+        if (s->hash == h && strcmp(s->name, name) == 0) return i;
+        i = (i + 1) & ctx->sym_hash_mask;
     }
-    return -1;
+}
+
+/* Index a non-local symbol; an existing entry of the same name wins. */
+static void sym_hash_insert(Ctx *ctx, int idx) {
+    /* Keep the load factor at or below 1/2 */
+    if (!ctx->sym_hash ||
+        (uint32_t)(ctx->sym_hash_used + 1) * 2 > ctx->sym_hash_mask + 1) {
+        uint32_t cap = ctx->sym_hash ? (ctx->sym_hash_mask + 1) * 2 : 4096;
+        int *old = ctx->sym_hash;
+        uint32_t old_cap = old ? ctx->sym_hash_mask + 1 : 0;
+        ctx->sym_hash = calloc(cap, sizeof(int));
+        if (!ctx->sym_hash) fatal("out of memory (symbol hash)");
+        ctx->sym_hash_mask = cap - 1;
+        for (uint32_t i = 0; i < old_cap; i++) {
+            if (!old[i]) continue;
+            Symbol *s = &ctx->syms[old[i] - 1];
+            ctx->sym_hash[sym_hash_slot(ctx, s->name, s->hash)] = old[i];
+        }
+        free(old);
+    }
+
+    Symbol *s = &ctx->syms[idx];
+    uint32_t slot = sym_hash_slot(ctx, s->name, s->hash);
+    if (!ctx->sym_hash[slot]) {
+        ctx->sym_hash[slot] = idx + 1;
+        ctx->sym_hash_used++;
+    }
+}
+
+int find_global_sym(Ctx *ctx, const char *name) {
+    if (!ctx->sym_hash) return -1;
+    return ctx->sym_hash[sym_hash_slot(ctx, name, gnu_hash(name))] - 1;
 }
 
 int add_global_sym(Ctx *ctx, const char *name, uint8_t bind, uint8_t type,
@@ -142,6 +181,7 @@ int add_global_sym(Ctx *ctx, const char *name, uint8_t bind, uint8_t type,
     Symbol *s = &ctx->syms[idx];
     memset(s, 0, sizeof(*s));
     s->name     = strdup(name ? name : "");
+    s->hash     = gnu_hash(s->name);
     s->bind     = bind;
     s->type     = type;
     s->defined  = defined;
@@ -150,9 +190,78 @@ int add_global_sym(Ctx *ctx, const char *name, uint8_t bind, uint8_t type,
     s->sec_off  = sec_off;
     s->size     = size;
     s->out_sec  = SEC_NONE;
+    /* Locals never take part in name resolution */
+    if (bind != STB_LOCAL) sym_hash_insert(ctx, idx);
     return idx;
 }
 
+/* ── Parallel loop ──────────────────────────────────────────────────── */
+
+#ifdef ANYLD_THREADS
+typedef struct {
+    void          (*fn)(void *arg, int i);
+    void           *arg;
+    int             n;
+    int             next;   /* Next unclaimed index, guarded by lock */
+    pthread_mutex_t lock;
+} ParJob;
+
+static void *parallel_worker(void *p) {
+    ParJob *job = p;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        int i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (i >= job->n) return NULL;
+        job->fn(job->arg, i);
+    }
+}
+#endif
+
+void parallel_for(Ctx *ctx, int n, void (*fn)(void *arg, int i), void *arg) {
+#ifdef ANYLD_THREADS
+    int nthreads = ctx->jobs < n ? ctx->jobs : n;
+    if (nthreads > 1) {
+        ParJob job;
+        job.fn = fn;
+        job.arg = arg;
+        job.n = n;
+        job.next = 0;
+        pthread_mutex_init(&job.lock, NULL);
+
+        /* The calling thread works too */
+        pthread_t tids[64];
+        if (nthreads > 64) nthreads = 64;
+        int started = 0;
+        for (int t = 1; t < nthreads; t++) {
+            if (pthread_create(&tids[started], NULL, parallel_worker, &job) != 0)
+                break;
+            started++;
+        }
+        parallel_worker(&job);
+        for (int t = 0; t < started; t++)
+            pthread_join(tids[t], NULL);
+        pthread_mutex_destroy(&job.lock);
+        return;
+    }
+#else
+    (void)ctx;
+#endif
+    for (int i = 0; i < n; i++)
+        fn(arg, i);
+}
+
+/* Default worker count: one per online CPU, at most 16. */
+static int default_jobs(void) {
+#ifdef ANYLD_THREADS
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 16) n = 16;
+    return n > 0 ? (int)n : 1;
+#else
+    return 1;
+#endif
+}
+
 /* ── Detect file type by content ────────────────────────────────────── */
 
 static int is_archive(const uint8_t *data, size_t size) {
@@ -166,6 +275,19 @@ static int is_elf_object(const uint8_t *data, size_t size) {
            data[2] == ELFMAG2 && data[3] == ELFMAG3;
 }
 
+/* ── Input file read by a parallel_for worker ───────────────────────── */
+
+typedef struct {
+    const char *path;
+    uint8_t    *data;   /* NULL if the read failed */
+    size_t      size;
+} InputFile;
+
+static void read_input_file(void *arg, int i) {
+    InputFile *f = &((InputFile *)arg)[i];
+    f->data = read_file(f->path, &f->size);
+}
+
 /* ── Parse a hex address string (0x prefix optional) ────────────────── */
 
 static uint64_t parse_address(const char *str) {
@@ -195,7 +317,10 @@ static void usage(void) {
         "Options:\n"
         "  -o <file>    Output file (required)\n"
         "  -b <addr>    Base virtual address (default: 0, kernel allocates)\n"
+        "  -l <addr>    Fail if the image extends past this address\n"
+        "               (end of a prelinked library's slot)\n"
         "  -e <file>    Export symbol definition file (.def)\n"
+        "  -j <n>       Worker threads (default: one per CPU)\n"
         "  -v           Verbose output\n"
         "  -q           Quiet (suppress summary output)\n"
         "  -h           Show this help\n"
@@ -218,6 +343,7 @@ int main(int argc, char **argv) {
     Ctx ctx;
     memset(&ctx, 0, sizeof(ctx));
     ctx.base_addr = 0;  /* Default: 0 (kernel allocates dynamically) */
+    ctx.jobs = default_jobs();
 
     const char *def_path = NULL;
     int verbose = 0;
@@ -237,9 +363,16 @@ int main(int argc, char **argv) {
             } else if (strcmp(argv[i], "-b") == 0) {
                 if (++i >= argc) fatal("-b requires an argument");
                 ctx.base_addr = parse_address(argv[i]);
+            } else if (strcmp(argv[i], "-l") == 0) {
+                if (++i >= argc) fatal("-l requires an argument");
+                ctx.limit_addr = parse_address(argv[i]);
             } else if (strcmp(argv[i], "-e") == 0) {
                 if (++i >= argc) fatal("-e requires an argument");
                 def_path = argv[i];
+            } else if (strcmp(argv[i], "-j") == 0) {
+                if (++i >= argc) fatal("-j requires an argument");
+                ctx.jobs = atoi(argv[i]);
+                if (ctx.jobs < 1) ctx.jobs = 1;
             } else if (strcmp(argv[i], "-v") == 0) {
                 verbose = 1;
             } else if (strcmp(argv[i], "-q") == 0) {
@@ -277,14 +410,23 @@ int main(int argc, char **argv) {
     }
 
     /* ── Step 2: Read input files ───────────────────────────────────── */
+    /* File reads run in parallel; objects are registered in command-line
+     * order so the output does not depend on -j. */
+    InputFile files[512];
+    for (int j = 0; j < ninputs; j++) {
+        files[j].path = inputs[j];
+        files[j].data = NULL;
+        files[j].size = 0;
+    }
+    parallel_for(&ctx, ninputs, read_input_file, files);
+
     for (int j = 0; j < ninputs; j++) {
-        size_t probe_size;
-        uint8_t *probe = read_file(inputs[j], &probe_size);
+        size_t probe_size = files[j].size;
+        uint8_t *probe = files[j].data;
         if (!probe) fatal("cannot read '%s'", inputs[j]);
 
         if (is_archive(probe, probe_size)) {
-            free(probe);  /* read_archive reads it again */
-            if (read_archive(&ctx, inputs[j]) != 0)
+            if (read_archive_data(&ctx, inputs[j], probe, probe_size) != 0)
                 fatal("failed to read archive '%s'", inputs[j]);
         } else if (is_elf_object(probe, probe_size)) {
             if (parse_object(&ctx, inputs[j], probe, probe_size, 1) != 0)
@@ -339,6 +481,14 @@ int main(int argc, char **argv) {
     if (compute_layout(&ctx) != 0)
         fatal("layout computation failed");
 
+    if (ctx.limit_addr) {
+        uint64_t end = (ctx.bss_vaddr + ctx.bss_size + 0xFFF) & ~0xFFFULL;
+        if (end > ctx.limit_addr)
+            fatal("image ends at 0x%llx, past the limit 0x%llx",
+                  (unsigned long long)end,
+                  (unsigned long long)ctx.limit_addr);
+    }
+
     /* ── Step 7: Apply relocations ──────────────────────────────────── */
     if (apply_relocations(&ctx) != 0)
         fatal("relocation failed");
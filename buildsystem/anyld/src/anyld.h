@@ -69,6 +69,7 @@ typedef struct {
 
 typedef struct {
     char       *name;       /* strdup'd */
+    uint32_t    hash;       /* gnu_hash(name), for sym_hash probes */
     uint64_t    value;      /* Virtual address (set during layout) */
     uint64_t    size;
     uint8_t     bind;       /* STB_LOCAL, STB_GLOBAL, STB_WEAK */
@@ -104,6 +105,12 @@ typedef struct {
     int         nsyms;
     int         syms_cap;
 
+    /* Open-addressed index of non-local symbols by name:
+     * slot holds sym index + 1, 0 = empty.  Capacity is mask + 1. */
+    int        *sym_hash;
+    uint32_t    sym_hash_mask;
+    int         sym_hash_used;
+
     /* Pending relocations */
     Reloc      *relocs;
     int         nrelocs;
@@ -118,6 +125,7 @@ typedef struct {
 
     /* Virtual address layout (set by layout) */
     uint64_t    base_addr;
+    uint64_t    limit_addr; /* Image must end at or below this (-l), 0 = none */
     uint64_t    text_vaddr;
     uint64_t    rodata_vaddr;
     uint64_t    data_vaddr;
@@ -137,6 +145,7 @@ typedef struct {
     /* Paths */
     const char *output_path;
     int         quiet;
+    int         jobs;       /* Worker threads for parallel phases (-j) */
 
     /* Architecture (detected from first input object) */
     uint16_t    e_machine;
@@ -148,6 +157,8 @@ int  parse_object(Ctx *ctx, const char *filename, uint8_t *data,
                   size_t size, int data_owned);
 int  read_object_file(Ctx *ctx, const char *path);
 int  read_archive(Ctx *ctx, const char *path);
+int  read_archive_data(Ctx *ctx, const char *path, uint8_t *ar_data,
+                       size_t ar_size);
 
 /* ── link.c ─────────────────────────────────────────────────────────── */
 
@@ -179,4 +190,9 @@ int      add_global_sym(Ctx *ctx, const char *name, uint8_t bind,
 /* Find a global symbol by name, return index or -1 */
 int      find_global_sym(Ctx *ctx, const char *name);
 
+/* Run fn(arg, i) for i in [0, n), spread over ctx->jobs threads when
+ * built with ANYLD_THREADS.  Calls for different i must not conflict. */
+void     parallel_for(Ctx *ctx, int n, void (*fn)(void *arg, int i),
+                      void *arg);
+
 #endif /* ANYLD_H */
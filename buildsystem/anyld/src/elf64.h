@@ -89,6 +89,7 @@ typedef struct {
 #define SHT_NOBITS        8
 #define SHT_REL           9
 #define SHT_DYNSYM        11
+#define SHT_GNU_HASH      0x6FFFFFF6
 
 /* sh_flags values */
 #define SHF_WRITE         0x1
@@ -239,6 +240,7 @@ typedef struct {
 #define DT_RELAENT  9   /* Size of one Rela reloc entry */
 #define DT_SONAME   14  /* Shared object name */
 #define DT_RELACOUNT 0x6FFFFFF9  /* Count of RELATIVE relocs */
+#define DT_GNU_HASH  0x6FFFFEF5  /* Address of GNU-style hash table */
 
 /* ── ELF hash function ──────────────────────────────────────────────── */
 
@@ -254,6 +256,16 @@ static inline uint32_t elf_hash(const char *name) {
     return h;
 }
 
+/* ── GNU hash function (DJB, h * 33 + c) ────────────────────────────── */
+
+static inline uint32_t gnu_hash(const char *name) {
+    uint32_t h = 5381;
+    const unsigned char *p = (const unsigned char *)name;
+    while (*p)
+        h = (h << 5) + h + *p++;
+    return h;
+}
+
 /* ── AR archive format ──────────────────────────────────────────────── */
 
 #define AR_MAGIC  "!<arch>\n"
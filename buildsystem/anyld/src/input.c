@@ -130,7 +130,13 @@ int read_archive(Ctx *ctx, const char *path) {
     size_t ar_size;
     uint8_t *ar_data = read_file(path, &ar_size);
     if (!ar_data) return -1;
+    return read_archive_data(ctx, path, ar_data, ar_size);
+}
+
+/* ── Parse an AR archive already read into memory (takes ownership) ─── */
 
+int read_archive_data(Ctx *ctx, const char *path, uint8_t *ar_data,
+                      size_t ar_size) {
     if (ar_size < AR_MAGIC_LEN ||
         memcmp(ar_data, AR_MAGIC, AR_MAGIC_LEN) != 0) {
         fprintf(stderr, "anyld: %s: not an AR archive\n", path);
@@ -248,59 +248,88 @@ int resolve_symbols(Ctx *ctx) {
 
 /* ── Collect relocations from all objects ───────────────────────────── */
 
-static int collect_relocs(Ctx *ctx) {
-    for (int i = 0; i < ctx->nobjs; i++) {
-        InputObj *obj = &ctx->objs[i];
-
-        for (uint16_t j = 0; j < obj->nshdr; j++) {
-            Elf64_Shdr *sh = &obj->shdrs[j];
-            if (sh->sh_type != SHT_RELA) continue;
-
-            /* sh_info = index of section being relocated */
-            uint32_t target_shndx = sh->sh_info;
-            if (target_shndx >= obj->nshdr) continue;
-
-            /* Check if target section was merged */
-            int out_sec = obj->sec_map[target_shndx].out_sec;
-            uint64_t sec_base = obj->sec_map[target_shndx].out_off;
-            if (out_sec == SEC_NONE) continue;
-
-            /* Process each relocation entry */
-            uint32_t nrela = (uint32_t)(sh->sh_size / sizeof(Elf64_Rela));
-            Elf64_Rela *relas =
-                (Elf64_Rela *)(obj->data + sh->sh_offset);
-
-            for (uint32_t k = 0; k < nrela; k++) {
-                Elf64_Rela *rela = &relas[k];
-                uint32_t sym_idx = (uint32_t)ELF64_R_SYM(rela->r_info);
-                uint32_t rtype   = (uint32_t)ELF64_R_TYPE(rela->r_info);
-
-                if (rtype == R_X86_64_NONE || rtype == R_AARCH64_NONE)
-                    continue;
+typedef struct {
+    Ctx *ctx;
+    int *first;     /* Array[nobjs + 1]: first Reloc index of each object */
+    int  fill;      /* 0 = count pass, 1 = fill pass */
+} RelocScan;
+
+/* Count (fill == 0) or emit (fill == 1) the relocations of one object.
+ * Each object writes its own slice of ctx->relocs, so objects can be
+ * scanned in parallel. */
+static void scan_obj_relocs(void *arg, int i) {
+    RelocScan *scan = arg;
+    Ctx *ctx = scan->ctx;
+    InputObj *obj = &ctx->objs[i];
+    int n = 0;
+    Reloc *out = scan->fill ? &ctx->relocs[scan->first[i]] : NULL;
+
+    for (uint16_t j = 0; j < obj->nshdr; j++) {
+        Elf64_Shdr *sh = &obj->shdrs[j];
+        if (sh->sh_type != SHT_RELA) continue;
+
+        /* sh_info = index of section being relocated */
+        uint32_t target_shndx = sh->sh_info;
+        if (target_shndx >= obj->nshdr) continue;
+
+        /* Check if target section was merged */
+        int out_sec = obj->sec_map[target_shndx].out_sec;
+        uint64_t sec_base = obj->sec_map[target_shndx].out_off;
+        if (out_sec == SEC_NONE) continue;
+
+        /* Process each relocation entry */
+        uint32_t nrela = (uint32_t)(sh->sh_size / sizeof(Elf64_Rela));
+        Elf64_Rela *relas =
+            (Elf64_Rela *)(obj->data + sh->sh_offset);
+
+        for (uint32_t k = 0; k < nrela; k++) {
+            Elf64_Rela *rela = &relas[k];
+            uint32_t sym_idx = (uint32_t)ELF64_R_SYM(rela->r_info);
+            uint32_t rtype   = (uint32_t)ELF64_R_TYPE(rela->r_info);
+
+            if (rtype == R_X86_64_NONE || rtype == R_AARCH64_NONE)
+                continue;
 
+            if (out) {
                 /* Map local sym index → global sym index */
                 uint32_t gsym = 0;
                 if (sym_idx < obj->nsym) {
                     gsym = obj->sym_map[sym_idx];
                 }
 
-                /* Grow relocs array */
-                if (ctx->nrelocs >= ctx->relocs_cap) {
-                    ctx->relocs_cap = ctx->relocs_cap
-                                      ? ctx->relocs_cap * 2 : 4096;
-                    ctx->relocs = realloc(ctx->relocs,
-                                          ctx->relocs_cap * sizeof(Reloc));
-                }
-
-                Reloc *r = &ctx->relocs[ctx->nrelocs++];
+                Reloc *r = &out[n];
                 r->out_sec  = out_sec;
                 r->offset   = sec_base + rela->r_offset;
                 r->type     = rtype;
                 r->addend   = rela->r_addend;
                 r->sym_idx  = gsym;
             }
+            n++;
         }
     }
+
+    if (!scan->fill) scan->first[i + 1] = n;
+}
+
+static int collect_relocs(Ctx *ctx) {
+    RelocScan scan;
+    scan.ctx = ctx;
+    scan.first = calloc(ctx->nobjs + 1, sizeof(int));
+    if (!scan.first) fatal("out of memory (relocs)");
+
+    scan.fill = 0;
+    parallel_for(ctx, ctx->nobjs, scan_obj_relocs, &scan);
+    for (int i = 0; i < ctx->nobjs; i++)
+        scan.first[i + 1] += scan.first[i];
+
+    ctx->nrelocs = scan.first[ctx->nobjs];
+    ctx->relocs_cap = ctx->nrelocs ? ctx->nrelocs : 1;
+    ctx->relocs = realloc(ctx->relocs, ctx->relocs_cap * sizeof(Reloc));
+    if (!ctx->relocs) fatal("out of memory (relocs)");
+
+    scan.fill = 1;
+    parallel_for(ctx, ctx->nobjs, scan_obj_relocs, &scan);
+    free(scan.first);
     return 0;
 }
 
@@ -363,10 +392,28 @@ static void finalize_symbol_values(Ctx *ctx) {
 
 /* ── Apply all collected relocations to output section buffers ──────── */
 
-static int apply_relocs(Ctx *ctx) {
+/* Relocations per parallel work item */
+#define RELOC_CHUNK 8192
+
+/* One slice of ctx->relocs, with the runtime relocations it produced */
+typedef struct {
+    Buf rela;
+    int nrela;
+    int errors;
+} RelocChunk;
+
+typedef struct {
+    Ctx        *ctx;
+    RelocChunk *chunks;
+} RelocApply;
+
+/* Apply ctx->relocs[lo, hi), appending runtime relocations to `out`.
+ * Distinct relocations patch distinct bytes, so slices can run
+ * concurrently. */
+static int apply_reloc_range(Ctx *ctx, int lo, int hi, RelocChunk *out) {
     int errors = 0;
 
-    for (int i = 0; i < ctx->nrelocs; i++) {
+    for (int i = lo; i < hi; i++) {
         Reloc *r = &ctx->relocs[i];
 
         /* Symbol value (S) */
@@ -410,8 +457,8 @@ static int apply_relocs(Ctx *ctx) {
                     rr.r_offset = P;
                     rr.r_info   = ELF64_R_INFO(0, R_X86_64_RELATIVE);
                     rr.r_addend = *(int64_t *)patch;
-                    buf_append(&ctx->rela_dyn, &rr, sizeof(rr));
-                    ctx->nrela_dyn++;
+                    buf_append(&out->rela, &rr, sizeof(rr));
+                    out->nrela++;
                 }
                 break;
 
@@ -453,8 +500,8 @@ static int apply_relocs(Ctx *ctx) {
                         rr.r_offset = P;
                         rr.r_info   = ELF64_R_INFO(0, R_X86_64_32);
                         rr.r_addend = (int64_t)val;
-                        buf_append(&ctx->rela_dyn, &rr, sizeof(rr));
-                        ctx->nrela_dyn++;
+                        buf_append(&out->rela, &rr, sizeof(rr));
+                        out->nrela++;
                     }
                 }
                 break;
@@ -479,8 +526,8 @@ static int apply_relocs(Ctx *ctx) {
                         rr.r_offset = P;
                         rr.r_info   = ELF64_R_INFO(0, R_X86_64_32S);
                         rr.r_addend = val;
-                        buf_append(&ctx->rela_dyn, &rr, sizeof(rr));
-                        ctx->nrela_dyn++;
+                        buf_append(&out->rela, &rr, sizeof(rr));
+                        out->nrela++;
                     }
                 }
                 break;
@@ -544,8 +591,8 @@ static int apply_relocs(Ctx *ctx) {
                     rr.r_offset = P;
                     rr.r_info   = ELF64_R_INFO(0, R_AARCH64_RELATIVE);
                     rr.r_addend = *(int64_t *)patch;
-                    buf_append(&ctx->rela_dyn, &rr, sizeof(rr));
-                    ctx->nrela_dyn++;
+                    buf_append(&out->rela, &rr, sizeof(rr));
+                    out->nrela++;
                 }
                 break;
 
@@ -568,8 +615,8 @@ static int apply_relocs(Ctx *ctx) {
                         rr.r_offset = P;
                         rr.r_info   = ELF64_R_INFO(0, R_AARCH64_ABS32);
                         rr.r_addend = (int64_t)val;
-                        buf_append(&ctx->rela_dyn, &rr, sizeof(rr));
-                        ctx->nrela_dyn++;
+                        buf_append(&out->rela, &rr, sizeof(rr));
+                        out->nrela++;
                     }
                 }
                 break;
@@ -741,6 +788,37 @@ static int apply_relocs(Ctx *ctx) {
         errors++;
     }
 
+    return errors;
+}
+
+static void apply_reloc_chunk(void *arg, int i) {
+    RelocApply *job = arg;
+    RelocChunk *c = &job->chunks[i];
+    int lo = i * RELOC_CHUNK;
+    int hi = lo + RELOC_CHUNK < job->ctx->nrelocs
+             ? lo + RELOC_CHUNK : job->ctx->nrelocs;
+    c->errors = apply_reloc_range(job->ctx, lo, hi, c);
+}
+
+static int apply_relocs(Ctx *ctx) {
+    int nchunks = (ctx->nrelocs + RELOC_CHUNK - 1) / RELOC_CHUNK;
+    RelocApply job;
+    job.ctx = ctx;
+    job.chunks = calloc(nchunks ? nchunks : 1, sizeof(RelocChunk));
+    if (!job.chunks) fatal("out of memory (relocs)");
+
+    parallel_for(ctx, nchunks, apply_reloc_chunk, &job);
+
+    /* Stitch .rela.dyn together in relocation order */
+    int errors = 0;
+    for (int i = 0; i < nchunks; i++) {
+        RelocChunk *c = &job.chunks[i];
+        buf_append(&ctx->rela_dyn, c->rela.data, c->rela.size);
+        ctx->nrela_dyn += c->nrela;
+        errors += c->errors;
+        buf_free(&c->rela);
+    }
+    free(job.chunks);
     return errors > 0 ? -1 : 0;
 }
 
@@ -5,7 +5,8 @@
  *   File Offset    Virtual Address     Content
  *   ──────────────────────────────────────────────────────
  *   0x0000         base+0x0000         ELF header + PHDRs
- *   0x00E8+        base+0x00E8+        .dynsym, .dynstr, .hash, .rela.dyn
+ *   0x00E8+        base+0x00E8+        .dynsym, .dynstr, .hash, .gnu.hash,
+ *                                      .rela.dyn
  *   pad to 0x1000  base+0x1000         .text
  *   after text                         .rodata (16-byte aligned)
  *   pad to page    base+N*0x1000       .data
@@ -27,15 +28,78 @@
 #define SHIDX_HASH      7
 #define SHIDX_RELADYN   8
 #define SHIDX_DYNAMIC   9
-#define SHIDX_SHSTRTAB  10
-#define NUM_SECTIONS    11
+#define SHIDX_GNU_HASH  10
+#define SHIDX_SHSTRTAB  11
+#define NUM_SECTIONS    12
 
 #define NUM_PHDRS       3  /* PT_LOAD (RX), PT_LOAD (RW), PT_DYNAMIC */
 
+/* Number of .gnu.hash buckets for `nexports` exported symbols. */
+static uint32_t gnu_nbuckets(int nexports) {
+    return nexports < 4 ? 1 : (uint32_t)(nexports / 2) | 1;
+}
+
+/* ── Build a suffix-merged string table ─────────────────────────────── */
+
+typedef struct {
+    const char *str;
+    size_t      len;
+    int         idx;    /* Position in the caller's names[] */
+} StrEnt;
+
+/* Order by reversed string, so every string sorts directly before the
+ * strings it is a suffix of. */
+static int cmp_reversed(const void *pa, const void *pb) {
+    const StrEnt *a = pa, *b = pb;
+    size_t i = a->len, j = b->len;
+    while (i > 0 && j > 0) {
+        unsigned char ca = (unsigned char)a->str[--i];
+        unsigned char cb = (unsigned char)b->str[--j];
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    if (a->len != b->len) return a->len < b->len ? -1 : 1;
+    return a->idx - b->idx;
+}
+
+/*
+ * Append names[0..n) to `strtab` and store each one's offset in offs[].
+ * Duplicates are stored once, and a name that is the tail of another
+ * ("init" of "lib_init") points into the longer one.  The result only
+ * depends on the set of names.
+ */
+static void merge_strings(Buf *strtab, const char **names, int n,
+                          uint32_t *offs) {
+    StrEnt *ents = malloc((n ? n : 1) * sizeof(StrEnt));
+    for (int i = 0; i < n; i++) {
+        ents[i].str = names[i];
+        ents[i].len = strlen(names[i]);
+        ents[i].idx = i;
+    }
+    qsort(ents, n, sizeof(StrEnt), cmp_reversed);
+
+    const StrEnt *prev = NULL;
+    uint32_t prev_off = 0;
+    for (int k = n - 1; k >= 0; k--) {
+        const StrEnt *e = &ents[k];
+        if (e->len == 0) {
+            offs[e->idx] = 0;   /* The leading NUL */
+        } else if (prev && prev->len >= e->len &&
+                   memcmp(prev->str + prev->len - e->len, e->str, e->len) == 0) {
+            offs[e->idx] = prev_off + (uint32_t)(prev->len - e->len);
+        } else {
+            prev = e;
+            prev_off = (uint32_t)strtab->size;
+            offs[e->idx] = prev_off;
+            buf_append(strtab, e->str, e->len + 1);
+        }
+    }
+    free(ents);
+}
+
 /* ── Build .dynsym and .dynstr from exported symbols ────────────────── */
 
 static void build_dynsym(Ctx *ctx, Buf *dynsym, Buf *dynstr,
-                         int *out_nsyms) {
+                         int *out_nsyms, uint32_t *out_soname_off) {
     buf_init(dynsym);
     buf_init(dynstr);
 
@@ -49,20 +113,45 @@ static void build_dynsym(Ctx *ctx, Buf *dynsym, Buf *dynstr,
     buf_append(dynsym, &null_sym, sizeof(null_sym));
     int count = 1;
 
-    /* Add SONAME string if library name is set */
-    uint32_t soname_off = 0;
-    if (ctx->lib_name && ctx->lib_name[0]) {
-        soname_off = (uint32_t)dynstr->size;
-        buf_append(dynstr, ctx->lib_name, strlen(ctx->lib_name) + 1);
+    /* Exported symbols, grouped by .gnu.hash bucket (the GNU hash table
+     * requires each bucket's symbols to be contiguous in .dynsym).
+     * Counting sort keeps input order within a bucket. */
+    int nexports = 0;
+    for (int i = 0; i < ctx->nsyms; i++)
+        if (ctx->syms[i].is_export && ctx->syms[i].defined) nexports++;
+    uint32_t nbuckets = gnu_nbuckets(nexports);
+    int *order = malloc((nexports ? nexports : 1) * sizeof(int));
+    uint32_t *start = calloc(nbuckets + 1, sizeof(uint32_t));
+    for (int i = 0; i < ctx->nsyms; i++) {
+        Symbol *s = &ctx->syms[i];
+        if (s->is_export && s->defined)
+            start[s->hash % nbuckets + 1]++;
     }
-
-    /* Add all exported symbols */
+    for (uint32_t b = 0; b < nbuckets; b++)
+        start[b + 1] += start[b];
     for (int i = 0; i < ctx->nsyms; i++) {
         Symbol *s = &ctx->syms[i];
-        if (!s->is_export || !s->defined) continue;
+        if (s->is_export && s->defined)
+            order[start[s->hash % nbuckets]++] = i;
+    }
+    free(start);
+
+    /* One merged .dynstr for the SONAME and every exported name */
+    int has_soname = ctx->lib_name && ctx->lib_name[0];
+    int nnames = nexports + has_soname;
+    const char **names = malloc((nnames ? nnames : 1) * sizeof(char *));
+    uint32_t *offs = malloc((nnames ? nnames : 1) * sizeof(uint32_t));
+    for (int k = 0; k < nexports; k++)
+        names[k] = ctx->syms[order[k]].name;
+    if (has_soname) names[nexports] = ctx->lib_name;
+    merge_strings(dynstr, names, nnames, offs);
+    *out_soname_off = has_soname ? offs[nexports] : 0;
+
+    for (int k = 0; k < nexports; k++) {
+        Symbol *s = &ctx->syms[order[k]];
 
         Elf64_Sym esym;
-        esym.st_name  = (Elf64_Word)dynstr->size;
+        esym.st_name  = (Elf64_Word)offs[k];
         esym.st_info  = ELF64_ST_INFO(STB_GLOBAL, s->type);
         esym.st_other = STV_DEFAULT;
         esym.st_value = s->value;
@@ -78,14 +167,13 @@ static void build_dynsym(Ctx *ctx, Buf *dynsym, Buf *dynstr,
         }
 
         buf_append(dynsym, &esym, sizeof(esym));
-
-        /* Add name to .dynstr */
-        buf_append(dynstr, s->name, strlen(s->name) + 1);
         count++;
     }
+    free(order);
+    free(names);
+    free(offs);
 
     *out_nsyms = count;
-    (void)soname_off;  /* Used later in build_dynamic */
 }
 
 /* ── Build .hash section (ELF hash table) ───────────────────────────── */
@@ -122,11 +210,63 @@ static void build_hash(Buf *hash_buf, Buf *dynsym_buf, Buf *dynstr_buf,
     free(chains);
 }
 
+/* ── Build .gnu.hash section (GNU hash table with Bloom filter) ─────── */
+
+static void build_gnu_hash(Buf *gnu_buf, Buf *dynsym_buf, Buf *dynstr_buf,
+                           int nsyms) {
+    buf_init(gnu_buf);
+
+    /* Symbol 0 (NULL) is not hashed; .dynsym is already bucket-sorted */
+    uint32_t symoffset   = 1;
+    uint32_t nexports    = (uint32_t)nsyms - symoffset;
+    uint32_t nbuckets    = gnu_nbuckets((int)nexports);
+    /* Two filter bits per symbol, about 1/32 words per symbol */
+    uint32_t bloom_size  = 1;
+    while (bloom_size * 32 < nexports) bloom_size <<= 1;
+    uint32_t bloom_shift = 6;
+
+    uint64_t *bloom   = calloc(bloom_size, sizeof(uint64_t));
+    uint32_t *buckets = calloc(nbuckets, sizeof(uint32_t));
+    uint32_t *chain   = calloc(nexports ? nexports : 1, sizeof(uint32_t));
+
+    Elf64_Sym *syms = (Elf64_Sym *)dynsym_buf->data;
+    char *strs = (char *)dynstr_buf->data;
+
+    for (uint32_t i = symoffset; i < (uint32_t)nsyms; i++) {
+        uint32_t h = gnu_hash(strs + syms[i].st_name);
+        uint32_t b = h % nbuckets;
+        bloom[(h / 64) % bloom_size] |= (1ULL << (h % 64))
+                                      | (1ULL << ((h >> bloom_shift) % 64));
+        if (buckets[b] == 0) buckets[b] = i;
+        /* Chain values are hashes with bit 0 marking a bucket's last symbol */
+        chain[i - symoffset] = h & ~1u;
+        if (i + 1 == (uint32_t)nsyms
+            || gnu_hash(strs + syms[i + 1].st_name) % nbuckets != b)
+            chain[i - symoffset] |= 1;
+    }
+
+    /* Write: nbuckets, symoffset, bloom_size, bloom_shift,
+     *        bloom[], buckets[], chain[] */
+    buf_append(gnu_buf, &nbuckets, 4);
+    buf_append(gnu_buf, &symoffset, 4);
+    buf_append(gnu_buf, &bloom_size, 4);
+    buf_append(gnu_buf, &bloom_shift, 4);
+    buf_append(gnu_buf, bloom, bloom_size * sizeof(uint64_t));
+    buf_append(gnu_buf, buckets, nbuckets * 4);
+    buf_append(gnu_buf, chain, nexports * 4);
+
+    free(bloom);
+    free(buckets);
+    free(chain);
+}
+
 /* ── Build .dynamic section ─────────────────────────────────────────── */
 
 static void build_dynamic(Ctx *ctx, Buf *dyn_buf,
                           uint64_t dynsym_vaddr, uint64_t dynstr_vaddr,
-                          uint64_t dynstr_size, uint64_t hash_vaddr,
+                          uint64_t dynstr_size, uint32_t soname_off,
+                          uint64_t hash_vaddr,
+                          uint64_t gnu_hash_vaddr,
                           uint64_t rela_vaddr, uint64_t rela_size,
                           int rela_count) {
     buf_init(dyn_buf);
@@ -137,6 +277,11 @@ static void build_dynamic(Ctx *ctx, Buf *dyn_buf,
     d.d_un.d_ptr = hash_vaddr;
     buf_append(dyn_buf, &d, sizeof(d));
 
+    /* DT_GNU_HASH */
+    d.d_tag = DT_GNU_HASH;
+    d.d_un.d_ptr = gnu_hash_vaddr;
+    buf_append(dyn_buf, &d, sizeof(d));
+
     /* DT_STRTAB */
     d.d_tag = DT_STRTAB;
     d.d_un.d_ptr = dynstr_vaddr;
@@ -178,10 +323,8 @@ static void build_dynamic(Ctx *ctx, Buf *dyn_buf,
 
     /* DT_SONAME (if library name set) */
     if (ctx->lib_name && ctx->lib_name[0]) {
-        /* SONAME offset in dynstr: right after the empty string byte.
-         * We added it as the first string in build_dynsym. */
         d.d_tag = DT_SONAME;
-        d.d_un.d_val = 1;  /* offset 1 in .dynstr */
+        d.d_un.d_val = soname_off;
         buf_append(dyn_buf, &d, sizeof(d));
     }
 
@@ -204,6 +347,7 @@ typedef struct {
     uint32_t hash_off;
     uint32_t reladyn_off;
     uint32_t dynamic_off;
+    uint32_t gnu_hash_off;
     uint32_t shstrtab_off;
 } ShstrOffsets;
 
@@ -229,6 +373,7 @@ static void build_shstrtab(Buf *shstrtab, ShstrOffsets *off) {
     ADD_NAME(hash_off,     ".hash");
     ADD_NAME(reladyn_off,  ".rela.dyn");
     ADD_NAME(dynamic_off,  ".dynamic");
+    ADD_NAME(gnu_hash_off, ".gnu.hash");
     ADD_NAME(shstrtab_off, ".shstrtab");
 
     #undef ADD_NAME
@@ -241,27 +386,32 @@ int compute_layout(Ctx *ctx) {
 
     /*
      * Metadata region: offset 0x0000 → just before .text
-     * [ELF header][PHDRs][.dynsym][.dynstr][.hash][.rela.dyn][pad to page]
+     * [ELF header][PHDRs][.dynsym][.dynstr][.hash][.gnu.hash][.rela.dyn]
+     * [pad to page]
      *
      * Build temporary dynsym/dynstr/hash just to determine sizes
      * (symbol values don't matter — only entry count affects size).
      */
     uint64_t meta_off = sizeof(Elf64_Ehdr) + NUM_PHDRS * sizeof(Elf64_Phdr);
 
-    Buf tmp_dynsym, tmp_dynstr, tmp_hash;
+    Buf tmp_dynsym, tmp_dynstr, tmp_hash, tmp_gnu_hash;
     int tmp_count;
-    build_dynsym(ctx, &tmp_dynsym, &tmp_dynstr, &tmp_count);
+    uint32_t tmp_soname;
+    build_dynsym(ctx, &tmp_dynsym, &tmp_dynstr, &tmp_count, &tmp_soname);
     build_hash(&tmp_hash, &tmp_dynsym, &tmp_dynstr, tmp_count);
+    build_gnu_hash(&tmp_gnu_hash, &tmp_dynsym, &tmp_dynstr, tmp_count);
 
     uint64_t dynsym_off = (meta_off + 7) & ~7ULL;
     uint64_t dynstr_off = dynsym_off + tmp_dynsym.size;
     uint64_t hash_off   = (dynstr_off + tmp_dynstr.size + 3) & ~3ULL;
-    uint64_t rela_off   = (hash_off + tmp_hash.size + 7) & ~7ULL;
+    uint64_t gnu_off    = (hash_off + tmp_hash.size + 7) & ~7ULL;
+    uint64_t rela_off   = (gnu_off + tmp_gnu_hash.size + 7) & ~7ULL;
     uint64_t meta_end   = rela_off + ctx->rela_dyn.size;
 
     buf_free(&tmp_dynsym);
     buf_free(&tmp_dynstr);
     buf_free(&tmp_hash);
+    buf_free(&tmp_gnu_hash);
 
     /* .text starts at next page */
     uint64_t text_off = PAGE_ALIGN(meta_end);
@@ -282,8 +432,8 @@ int compute_layout(Ctx *ctx) {
     dyn_off = (dyn_off + 7) & ~7ULL;
     ctx->dynamic_vaddr = base + dyn_off;
 
-    /* Estimate .dynamic size (11 entries * 16 bytes = 176 max) */
-    uint64_t dyn_size_est = 11 * sizeof(Elf64_Dyn);
+    /* Estimate .dynamic size (12 entries * 16 bytes = 192 max) */
+    uint64_t dyn_size_est = 12 * sizeof(Elf64_Dyn);
     uint64_t rw_file_end  = dyn_off + dyn_size_est;
 
     /* .bss follows at next page boundary */
@@ -302,23 +452,27 @@ int write_output(Ctx *ctx) {
 
     /*
      * Metadata region: offset 0x0000 → just before .text
-     * [ELF header][PHDRs][.dynsym][.dynstr][.hash][.rela.dyn][pad to page]
+     * [ELF header][PHDRs][.dynsym][.dynstr][.hash][.gnu.hash][.rela.dyn]
+     * [pad to page]
      */
     uint64_t meta_off = sizeof(Elf64_Ehdr) + NUM_PHDRS * sizeof(Elf64_Phdr);
 
     /* Build export tables (need sizes for layout) */
-    Buf dynsym_buf, dynstr_buf, hash_buf, dyn_buf, shstrtab_buf;
+    Buf dynsym_buf, dynstr_buf, hash_buf, gnu_hash_buf, dyn_buf, shstrtab_buf;
     int dynsym_count;
+    uint32_t soname_off;
 
     /* Build dynsym/dynstr/hash with final symbol values */
-    build_dynsym(ctx, &dynsym_buf, &dynstr_buf, &dynsym_count);
+    build_dynsym(ctx, &dynsym_buf, &dynstr_buf, &dynsym_count, &soname_off);
     build_hash(&hash_buf, &dynsym_buf, &dynstr_buf, dynsym_count);
+    build_gnu_hash(&gnu_hash_buf, &dynsym_buf, &dynstr_buf, dynsym_count);
 
     /* Metadata layout (all within page 0) */
     uint64_t dynsym_off  = (meta_off + 7) & ~7ULL;  /* 8-byte align */
     uint64_t dynstr_off  = dynsym_off + dynsym_buf.size;
     uint64_t hash_off    = (dynstr_off + dynstr_buf.size + 3) & ~3ULL;
-    uint64_t reladyn_off = (hash_off + hash_buf.size + 7) & ~7ULL;
+    uint64_t gnu_off     = (hash_off + hash_buf.size + 7) & ~7ULL;  /* 64-bit Bloom words */
+    uint64_t reladyn_off = (gnu_off + gnu_hash_buf.size + 7) & ~7ULL;
     uint64_t meta_end    = reladyn_off + ctx->rela_dyn.size;
 
     /* .text starts at next page */
@@ -344,7 +498,9 @@ int write_output(Ctx *ctx) {
                   base + dynsym_off,
                   base + dynstr_off,
                   dynstr_buf.size,
+                  soname_off,
                   base + hash_off,
+                  base + gnu_off,
                   base + reladyn_off,
                   ctx->rela_dyn.size,
                   ctx->nrela_dyn);
@@ -356,13 +512,16 @@ int write_output(Ctx *ctx) {
     uint64_t bss_off_virt = PAGE_ALIGN(rw_file_end);
     ctx->bss_vaddr = base + bss_off_virt;
 
-    build_dynsym(ctx, &dynsym_buf, &dynstr_buf, &dynsym_count);
+    build_dynsym(ctx, &dynsym_buf, &dynstr_buf, &dynsym_count, &soname_off);
     build_hash(&hash_buf, &dynsym_buf, &dynstr_buf, dynsym_count);
+    build_gnu_hash(&gnu_hash_buf, &dynsym_buf, &dynstr_buf, dynsym_count);
     build_dynamic(ctx, &dyn_buf,
                   base + dynsym_off,
                   base + dynstr_off,
                   dynstr_buf.size,
+                  soname_off,
                   base + hash_off,
+                  base + gnu_off,
                   base + reladyn_off,
                   ctx->rela_dyn.size,
                   ctx->nrela_dyn);
@@ -470,6 +629,9 @@ int write_output(Ctx *ctx) {
     PAD_TO(hash_off);
     fwrite(hash_buf.data, 1, hash_buf.size, fp);
 
+    PAD_TO(gnu_off);
+    fwrite(gnu_hash_buf.data, 1, gnu_hash_buf.size, fp);
+
     /* .rela.dyn */
     PAD_TO(reladyn_off);
     if (ctx->rela_dyn.size > 0)
@@ -616,7 +778,19 @@ int write_output(Ctx *ctx) {
     shdr.sh_entsize   = sizeof(Elf64_Dyn);
     fwrite(&shdr, sizeof(shdr), 1, fp);
 
-    /* Section 10: .shstrtab */
+    /* Section 10: .gnu.hash */
+    memset(&shdr, 0, sizeof(shdr));
+    shdr.sh_name      = shstr_off.gnu_hash_off;
+    shdr.sh_type      = SHT_GNU_HASH;
+    shdr.sh_flags     = SHF_ALLOC;
+    shdr.sh_addr      = base + gnu_off;
+    shdr.sh_offset    = gnu_off;
+    shdr.sh_size      = gnu_hash_buf.size;
+    shdr.sh_link      = SHIDX_DYNSYM;
+    shdr.sh_addralign = 8;
+    fwrite(&shdr, sizeof(shdr), 1, fp);
+
+    /* Section 11: .shstrtab */
     memset(&shdr, 0, sizeof(shdr));
     shdr.sh_name      = shstr_off.shstrtab_off;
     shdr.sh_type      = SHT_STRTAB;
@@ -658,6 +832,7 @@ int write_output(Ctx *ctx) {
     buf_free(&dynsym_buf);
     buf_free(&dynstr_buf);
     buf_free(&hash_buf);
+    buf_free(&gnu_hash_buf);
     buf_free(&dyn_buf);
     buf_free(&shstrtab_buf);
     return 0;
@@ -666,6 +841,7 @@ err:
     buf_free(&dynsym_buf);
     buf_free(&dynstr_buf);
     buf_free(&hash_buf);
+    buf_free(&gnu_hash_buf);
     buf_free(&dyn_buf);
     buf_free(&shstrtab_buf);
     return -1;
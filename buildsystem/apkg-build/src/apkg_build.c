@@ -8,6 +8,7 @@
  * Usage:
  *   apkg-build -d <package-dir> -o <output.tar.gz>
  *   apkg-build -d <package-dir>                      (auto-name from pkg.json)
+ *   apkg-build -D <old.tar.gz> -N <new.tar.gz> [-o <output.apkd>]
  *
  * Package directory layout:
  *   <package-dir>/
@@ -18,10 +19,15 @@
  * The archive will contain:
  *   <name>-<version>/pkg.json
  *   <name>-<version>/files/...
+ *
+ * With -D/-N a binary delta package is built instead, which lets apkg
+ * upgrade from the old version by downloading only what changed. See
+ * "Delta packages" below for the format.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -187,6 +193,516 @@ static void collect_files(const char *base_dir, const char *arc_prefix)
     closedir(dir);
 }
 
+/* ── MD5 implementation (RFC 1321) ─────────────────────────────────── */
+
+typedef struct {
+    unsigned int state[4];
+    unsigned long long count;
+    unsigned char buffer[64];
+} MD5_CTX;
+
+#define F(x,y,z) (((x)&(y))|((~(x))&(z)))
+#define G(x,y,z) (((x)&(z))|((y)&(~(z))))
+#define H(x,y,z) ((x)^(y)^(z))
+#define I(x,y,z) ((y)^((x)|(~(z))))
+#define ROTL(x,n) (((x)<<(n))|((x)>>(32-(n))))
+
+static const unsigned int md5_k[64] = {
+    0xd76aa478,0xe8c7b756,0x242070db,0xc1bdceee,0xf57c0faf,0x4787c62a,
+    0xa8304613,0xfd469501,0x698098d8,0x8b44f7af,0xffff5bb1,0x895cd7be,
+    0x6b901122,0xfd987193,0xa679438e,0x49b40821,0xf61e2562,0xc040b340,
+    0x265e5a51,0xe9b6c7aa,0xd62f105d,0x02441453,0xd8a1e681,0xe7d3fbc8,
+    0x21e1cde6,0xc33707d6,0xf4d50d87,0x455a14ed,0xa9e3e905,0xfcefa3f8,
+    0x676f02d9,0x8d2a4c8a,0xfffa3942,0x8771f681,0x6d9d6122,0xfde5380c,
+    0xa4beea44,0x4bdecfa9,0xf6bb4b60,0xbebfbc70,0x289b7ec6,0xeaa127fa,
+    0xd4ef3085,0x04881d05,0xd9d4d039,0xe6db99e5,0x1fa27cf8,0xc4ac5665,
+    0xf4292244,0x432aff97,0xab9423a7,0xfc93a039,0x655b59c3,0x8f0ccc92,
+    0xffeff47d,0x85845dd1,0x6fa87e4f,0xfe2ce6e0,0xa3014314,0x4e0811a1,
+    0xf7537e82,0xbd3af235,0x2ad7d2bb,0xeb86d391
+};
+static const int md5_s[64] = {
+    7,12,17,22,7,12,17,22,7,12,17,22,7,12,17,22,
+    5,9,14,20,5,9,14,20,5,9,14,20,5,9,14,20,
+    4,11,16,23,4,11,16,23,4,11,16,23,4,11,16,23,
+    6,10,15,21,6,10,15,21,6,10,15,21,6,10,15,21
+};
+
+static void md5_transform(MD5_CTX *ctx, const unsigned char *block)
+{
+    unsigned int a = ctx->state[0], b = ctx->state[1];
+    unsigned int c = ctx->state[2], d = ctx->state[3];
+    unsigned int m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = (unsigned int)block[i*4] | ((unsigned int)block[i*4+1]<<8)
+             | ((unsigned int)block[i*4+2]<<16) | ((unsigned int)block[i*4+3]<<24);
+    }
+    for (int i = 0; i < 64; i++) {
+        unsigned int f, g;
+        if (i < 16)      { f = F(b,c,d); g = i; }
+        else if (i < 32) { f = G(b,c,d); g = (5*i+1)%16; }
+        else if (i < 48) { f = H(b,c,d); g = (3*i+5)%16; }
+        else              { f = I(b,c,d); g = (7*i)%16; }
+        unsigned int temp = d;
+        d = c; c = b;
+        b = b + ROTL(a + f + md5_k[i] + m[g], md5_s[i]);
+        a = temp;
+    }
+    ctx->state[0] += a; ctx->state[1] += b;
+    ctx->state[2] += c; ctx->state[3] += d;
+}
+
+static void md5_init(MD5_CTX *ctx)
+{
+    ctx->state[0] = 0x67452301; ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe; ctx->state[3] = 0x10325476;
+    ctx->count = 0;
+}
+
+static void md5_update(MD5_CTX *ctx, const unsigned char *data, size_t len)
+{
+    size_t idx = (size_t)(ctx->count % 64);
+    ctx->count += len;
+    for (size_t i = 0; i < len; i++) {
+        ctx->buffer[idx++] = data[i];
+        if (idx == 64) { md5_transform(ctx, ctx->buffer); idx = 0; }
+    }
+}
+
+static void md5_final(MD5_CTX *ctx, unsigned char digest[16])
+{
+    unsigned long long bits = ctx->count * 8;
+    size_t idx = (size_t)(ctx->count % 64);
+    ctx->buffer[idx++] = 0x80;
+    if (idx > 56) {
+        while (idx < 64) ctx->buffer[idx++] = 0;
+        md5_transform(ctx, ctx->buffer);
+        idx = 0;
+    }
+    while (idx < 56) ctx->buffer[idx++] = 0;
+    for (int i = 0; i < 8; i++)
+        ctx->buffer[56+i] = (unsigned char)(bits >> (8*i));
+    md5_transform(ctx, ctx->buffer);
+    for (int i = 0; i < 4; i++) {
+        digest[i*4]   = (unsigned char)(ctx->state[i]);
+        digest[i*4+1] = (unsigned char)(ctx->state[i]>>8);
+        digest[i*4+2] = (unsigned char)(ctx->state[i]>>16);
+        digest[i*4+3] = (unsigned char)(ctx->state[i]>>24);
+    }
+}
+
+static void md5_buffer(const unsigned char *data, size_t len, unsigned char digest[16])
+{
+    MD5_CTX ctx;
+    md5_init(&ctx);
+    md5_update(&ctx, data, len);
+    md5_final(&ctx, digest);
+}
+
+/* ── Delta packages ────────────────────────────────────────────────── */
+
+/*
+ * A delta package (.apkd) rebuilds the uncompressed tar of a new package
+ * version from the uncompressed tar of an old one, bsdiff-style. Diffing
+ * the tars rather than the .tar.gz files matters: compression scatters
+ * even a one-byte change across the rest of the stream.
+ *
+ * The file is gzip-compressed as a whole. Decompressed, all integers
+ * little-endian:
+ *
+ *   0   8   magic "APKGDLT1"
+ *   8   8   size of the old tar
+ *   16  8   size of the new tar
+ *   24  16  MD5 of the old tar
+ *   40  16  MD5 of the new tar
+ *   56  32  old version string, NUL-padded
+ *   88  ..  records until the new tar is complete:
+ *             u32 add_len, u32 copy_len, i32 seek
+ *             add_len bytes, each added to the next old byte
+ *             copy_len bytes copied literally
+ *           after which the old position moves by seek.
+ *
+ * Add bytes are mostly zero where the versions agree, which is why the
+ * whole thing compresses well.
+ */
+
+#define DELTA_MAGIC "APKGDLT1"
+#define DELTA_VERSION_LEN 32
+
+/*
+ * Decompress a .tar.gz into memory (via the system gzip command).
+ * Returns a malloc'd buffer, or NULL.
+ */
+static unsigned char *gunzip_to_memory(const char *path, size_t *size_out)
+{
+    char tmpfile[] = "/tmp/apkg-build-XXXXXX";
+    int fd = mkstemp(tmpfile);
+    if (fd < 0) return NULL;
+    close(fd);
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "gzip -dc '%s' > '%s'", path, tmpfile);
+    if (system(cmd) != 0) { unlink(tmpfile); return NULL; }
+
+    FILE *f = fopen(tmpfile, "rb");
+    if (!f) { unlink(tmpfile); return NULL; }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *buf = malloc(len > 0 ? (size_t)len : 1);
+    if (!buf || (len > 0 && fread(buf, 1, (size_t)len, f) != (size_t)len)) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    unlink(tmpfile);
+    *size_out = len > 0 ? (size_t)len : 0;
+    return buf;
+}
+
+/*
+ * Find "version" in the pkg.json of an uncompressed package tar.
+ * Returns 0 on success.
+ */
+static int tar_pkg_version(const unsigned char *tar, size_t size, char *version, size_t version_sz)
+{
+    size_t off = 0;
+    while (off + TAR_BLOCK <= size && tar[off] != '\0') {
+        char name[TAR_NAME_LEN + 1];
+        char size_field[13];
+        memcpy(name, tar + off, TAR_NAME_LEN);
+        name[TAR_NAME_LEN] = '\0';
+        memcpy(size_field, tar + off + 124, 12);
+        size_field[12] = '\0';
+        size_t entry_size = (size_t)strtoul(size_field, NULL, 8);
+        size_t data = off + TAR_BLOCK;
+        if (data + entry_size > size) return -1;
+
+        size_t name_len = strlen(name);
+        if (name_len >= 9 && strcmp(name + name_len - 9, "/pkg.json") == 0) {
+            char *json = malloc(entry_size + 1);
+            if (!json) return -1;
+            memcpy(json, tar + data, entry_size);
+            json[entry_size] = '\0';
+            int found = json_get_string(json, "version", version, version_sz) != NULL;
+            free(json);
+            return found ? 0 : -1;
+        }
+        off = data + (entry_size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+    }
+    return -1;
+}
+
+/* Suffix sorting (Larsson & Sadakane), as used by bsdiff. */
+static void split(int64_t *sa, int64_t *rank, int64_t start, int64_t len, int64_t h)
+{
+    int64_t i, j, k, x, tmp, jj, kk;
+
+    if (len < 16) {
+        for (k = start; k < start + len; k += j) {
+            j = 1;
+            x = rank[sa[k] + h];
+            for (i = 1; k + i < start + len; i++) {
+                if (rank[sa[k + i] + h] < x) {
+                    x = rank[sa[k + i] + h];
+                    j = 0;
+                }
+                if (rank[sa[k + i] + h] == x) {
+                    tmp = sa[k + j]; sa[k + j] = sa[k + i]; sa[k + i] = tmp;
+                    j++;
+                }
+            }
+            for (i = 0; i < j; i++) rank[sa[k + i]] = k + j - 1;
+            if (j == 1) sa[k] = -1;
+        }
+        return;
+    }
+
+    x = rank[sa[start + len / 2] + h];
+    jj = 0;
+    kk = 0;
+    for (i = start; i < start + len; i++) {
+        if (rank[sa[i] + h] < x) jj++;
+        if (rank[sa[i] + h] == x) kk++;
+    }
+    jj += start;
+    kk += jj;
+
+    i = start;
+    j = 0;
+    k = 0;
+    while (i < jj) {
+        if (rank[sa[i] + h] < x) {
+            i++;
+        } else if (rank[sa[i] + h] == x) {
+            tmp = sa[i]; sa[i] = sa[jj + j]; sa[jj + j] = tmp;
+            j++;
+        } else {
+            tmp = sa[i]; sa[i] = sa[kk + k]; sa[kk + k] = tmp;
+            k++;
+        }
+    }
+    while (jj + j < kk) {
+        if (rank[sa[jj + j] + h] == x) {
+            j++;
+        } else {
+            tmp = sa[jj + j]; sa[jj + j] = sa[kk + k]; sa[kk + k] = tmp;
+            k++;
+        }
+    }
+
+    if (jj > start) split(sa, rank, start, jj - start, h);
+
+    for (i = 0; i < kk - jj; i++) rank[sa[jj + i]] = kk - 1;
+    if (jj == kk - 1) sa[jj] = -1;
+
+    if (start + len > kk) split(sa, rank, kk, start + len - kk, h);
+}
+
+static void qsufsort(int64_t *sa, int64_t *rank, const unsigned char *old, int64_t oldsize)
+{
+    int64_t buckets[256];
+    int64_t i, h, len;
+
+    for (i = 0; i < 256; i++) buckets[i] = 0;
+    for (i = 0; i < oldsize; i++) buckets[old[i]]++;
+    for (i = 1; i < 256; i++) buckets[i] += buckets[i - 1];
+    for (i = 255; i > 0; i--) buckets[i] = buckets[i - 1];
+    buckets[0] = 0;
+
+    for (i = 0; i < oldsize; i++) sa[++buckets[old[i]]] = i;
+    sa[0] = oldsize;
+    for (i = 0; i < oldsize; i++) rank[i] = buckets[old[i]];
+    rank[oldsize] = 0;
+    for (i = 1; i < 256; i++)
+        if (buckets[i] == buckets[i - 1] + 1) sa[buckets[i]] = -1;
+    sa[0] = -1;
+
+    for (h = 1; sa[0] != -(oldsize + 1); h += h) {
+        len = 0;
+        for (i = 0; i < oldsize + 1;) {
+            if (sa[i] < 0) {
+                len -= sa[i];
+                i -= sa[i];
+            } else {
+                if (len) sa[i - len] = -len;
+                len = rank[sa[i]] + 1 - i;
+                split(sa, rank, i, len, h);
+                i += len;
+                len = 0;
+            }
+        }
+        if (len) sa[i - len] = -len;
+    }
+
+    for (i = 0; i < oldsize + 1; i++) sa[rank[i]] = i;
+}
+
+static int64_t match_len(const unsigned char *a, int64_t alen, const unsigned char *b, int64_t blen)
+{
+    int64_t i;
+    for (i = 0; i < alen && i < blen; i++)
+        if (a[i] != b[i]) break;
+    return i;
+}
+
+/* Longest match of new[0..newsize) among the old suffixes sa[st..en]. */
+static int64_t search(const int64_t *sa, const unsigned char *old, int64_t oldsize,
+                      const unsigned char *new_data, int64_t newsize,
+                      int64_t st, int64_t en, int64_t *pos)
+{
+    while (en - st >= 2) {
+        int64_t x = st + (en - st) / 2;
+        int64_t n = oldsize - sa[x] < newsize ? oldsize - sa[x] : newsize;
+        if (memcmp(old + sa[x], new_data, (size_t)n) < 0)
+            st = x;
+        else
+            en = x;
+    }
+    int64_t x = match_len(old + sa[st], oldsize - sa[st], new_data, newsize);
+    int64_t y = match_len(old + sa[en], oldsize - sa[en], new_data, newsize);
+    if (x > y) {
+        *pos = sa[st];
+        return x;
+    }
+    *pos = sa[en];
+    return y;
+}
+
+static void put_le(FILE *f, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        fputc((int)((v >> (8 * i)) & 0xFF), f);
+}
+
+/* Emit the bsdiff records turning old into new. */
+static void delta_records(FILE *out, const unsigned char *old, int64_t oldsize,
+                          const unsigned char *new_data, int64_t newsize, const int64_t *sa)
+{
+    int64_t scan = 0, len = 0, pos = 0;
+    int64_t lastscan = 0, lastpos = 0, lastoffset = 0;
+
+    while (scan < newsize) {
+        int64_t oldscore = 0;
+        int64_t scsc;
+
+        for (scsc = scan += len; scan < newsize; scan++) {
+            len = search(sa, old, oldsize, new_data + scan, newsize - scan, 0, oldsize, &pos);
+            for (; scsc < scan + len; scsc++)
+                if (scsc + lastoffset < oldsize && old[scsc + lastoffset] == new_data[scsc])
+                    oldscore++;
+            if ((len == oldscore && len != 0) || len > oldscore + 8) break;
+            if (scan + lastoffset < oldsize && old[scan + lastoffset] == new_data[scan])
+                oldscore--;
+        }
+
+        if (len == oldscore && scan != newsize) continue;
+
+        /* Extend the previous match forwards and this one backwards */
+        int64_t s = 0, sf = 0, lenf = 0, i;
+        for (i = 0; lastscan + i < scan && lastpos + i < oldsize;) {
+            if (old[lastpos + i] == new_data[lastscan + i]) s++;
+            i++;
+            if (s * 2 - i > sf * 2 - lenf) { sf = s; lenf = i; }
+        }
+
+        int64_t lenb = 0;
+        if (scan < newsize) {
+            int64_t sb = 0;
+            s = 0;
+            for (i = 1; scan >= lastscan + i && pos >= i; i++) {
+                if (old[pos - i] == new_data[scan - i]) s++;
+                if (s * 2 - i > sb * 2 - lenb) { sb = s; lenb = i; }
+            }
+        }
+
+        /* Split an overlap where it scores best */
+        if (lastscan + lenf > scan - lenb) {
+            int64_t overlap = (lastscan + lenf) - (scan - lenb);
+            int64_t ss = 0, lens = 0;
+            s = 0;
+            for (i = 0; i < overlap; i++) {
+                if (new_data[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]) s++;
+                if (new_data[scan - lenb + i] == old[pos - lenb + i]) s--;
+                if (s > ss) { ss = s; lens = i + 1; }
+            }
+            lenf += lens - overlap;
+            lenb -= lens;
+        }
+
+        int64_t copy_len = (scan - lenb) - (lastscan + lenf);
+        int64_t seek = (pos - lenb) - (lastpos + lenf);
+        put_le(out, (uint64_t)lenf, 4);
+        put_le(out, (uint64_t)copy_len, 4);
+        put_le(out, (uint64_t)(uint32_t)(int32_t)seek, 4);
+        for (i = 0; i < lenf; i++)
+            fputc((new_data[lastscan + i] - old[lastpos + i]) & 0xFF, out);
+        fwrite(new_data + lastscan + lenf, 1, (size_t)copy_len, out);
+
+        lastscan = scan - lenb;
+        lastpos = pos - lenb;
+        lastoffset = pos - scan;
+    }
+}
+
+static int gzip_file(const char *in_path, const char *out_path);
+
+/*
+ * Build a delta package that upgrades old_path to new_path.
+ * Returns the process exit code.
+ */
+static int make_delta(const char *old_path, const char *new_path, const char *output)
+{
+    size_t oldsize, newsize;
+    unsigned char *old = gunzip_to_memory(old_path, &oldsize);
+    unsigned char *new_data = old ? gunzip_to_memory(new_path, &newsize) : NULL;
+    if (!old || !new_data) {
+        fprintf(stderr, "apkg-build: cannot decompress '%s'\n", old ? new_path : old_path);
+        free(old);
+        return 1;
+    }
+    if (oldsize > 0x7FFFFFFF || newsize > 0x7FFFFFFF) {
+        fprintf(stderr, "apkg-build: packages over 2 GiB cannot be delta-encoded\n");
+        free(old);
+        free(new_data);
+        return 1;
+    }
+
+    char old_version[DELTA_VERSION_LEN];
+    char new_version[64];
+    if (tar_pkg_version(old, oldsize, old_version, sizeof(old_version)) != 0 ||
+        tar_pkg_version(new_data, newsize, new_version, sizeof(new_version)) != 0) {
+        fprintf(stderr, "apkg-build: cannot read pkg.json version from both packages\n");
+        free(old);
+        free(new_data);
+        return 1;
+    }
+
+    /* Default name: <new archive without .tar.gz>.from-<old version>.apkd */
+    char output_buf[512];
+    if (!output) {
+        size_t base_len = strlen(new_path);
+        if (base_len > 7 && strcmp(new_path + base_len - 7, ".tar.gz") == 0)
+            base_len -= 7;
+        snprintf(output_buf, sizeof(output_buf), "%.*s.from-%s.apkd",
+                 (int)base_len, new_path, old_version);
+        output = output_buf;
+    }
+
+    int64_t *sa = malloc(sizeof(int64_t) * (oldsize + 1));
+    int64_t *rank = malloc(sizeof(int64_t) * (oldsize + 1));
+    if (!sa || !rank) {
+        fprintf(stderr, "apkg-build: out of memory\n");
+        free(sa); free(rank); free(old); free(new_data);
+        return 1;
+    }
+    qsufsort(sa, rank, old, (int64_t)oldsize);
+    free(rank);
+
+    char raw_path[512];
+    snprintf(raw_path, sizeof(raw_path), "%s.raw.tmp", output);
+    FILE *raw = fopen(raw_path, "wb");
+    if (!raw) {
+        fprintf(stderr, "apkg-build: cannot create %s\n", raw_path);
+        free(sa); free(old); free(new_data);
+        return 1;
+    }
+
+    unsigned char digest[16];
+    char version_field[DELTA_VERSION_LEN];
+    fwrite(DELTA_MAGIC, 1, 8, raw);
+    put_le(raw, oldsize, 8);
+    put_le(raw, newsize, 8);
+    md5_buffer(old, oldsize, digest);
+    fwrite(digest, 1, 16, raw);
+    md5_buffer(new_data, newsize, digest);
+    fwrite(digest, 1, 16, raw);
+    memset(version_field, 0, sizeof(version_field));
+    snprintf(version_field, sizeof(version_field), "%s", old_version);
+    fwrite(version_field, 1, sizeof(version_field), raw);
+
+    delta_records(raw, old, (int64_t)oldsize, new_data, (int64_t)newsize, sa);
+    free(sa);
+    free(old);
+    free(new_data);
+
+    if (fclose(raw) != 0 || gzip_file(raw_path, output) != 0) {
+        fprintf(stderr, "apkg-build: cannot write %s\n", output);
+        unlink(raw_path);
+        return 1;
+    }
+    unlink(raw_path);
+
+    struct stat st_delta, st_full;
+    if (stat(output, &st_delta) == 0 && stat(new_path, &st_full) == 0 && st_full.st_size > 0) {
+        printf("apkg-build: created %s (%s -> %s, %ld bytes, %ld%% of the full package)\n",
+               output, old_version, new_version, (long)st_delta.st_size,
+               (long)(st_delta.st_size * 100 / st_full.st_size));
+    } else {
+        printf("apkg-build: created %s (%s -> %s)\n", output, old_version, new_version);
+    }
+    return 0;
+}
+
 /* ── Gzip wrapper (uses system gzip command) ──────────────────────── */
 
 static int gzip_file(const char *in_path, const char *out_path)
@@ -202,8 +718,10 @@ static void usage(void)
 {
     fprintf(stderr,
         "Usage: apkg-build -d <package-dir> [-o <output.tar.gz>]\n"
+        "       apkg-build -D <old.tar.gz> -N <new.tar.gz> [-o <output.apkd>]\n"
         "\n"
-        "Create an anyOS package archive from a package directory.\n"
+        "Create an anyOS package archive from a package directory, or a\n"
+        "delta package that upgrades an old version of a package.\n"
         "\n"
         "The package directory must contain:\n"
         "  pkg.json    Package metadata\n"
@@ -212,6 +730,9 @@ static void usage(void)
         "Options:\n"
         "  -d <dir>    Package source directory (required)\n"
         "  -o <file>   Output .tar.gz file (default: <name>-<version>.tar.gz)\n"
+        "  -D <file>   Old package archive to build a delta from\n"
+        "  -N <file>   New package archive the delta upgrades to\n"
+        "              (default output: <new>.from-<old-version>.apkd)\n"
         "  -h          Show this help\n"
     );
 }
@@ -220,12 +741,18 @@ int main(int argc, char **argv)
 {
     const char *pkg_dir = NULL;
     const char *output = NULL;
+    const char *delta_old = NULL;
+    const char *delta_new = NULL;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
             pkg_dir = argv[++i];
         } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
             output = argv[++i];
+        } else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            delta_old = argv[++i];
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc) {
+            delta_new = argv[++i];
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             usage();
             return 0;
@@ -236,6 +763,15 @@ int main(int argc, char **argv)
         }
     }
 
+    if (delta_old || delta_new) {
+        if (!delta_old || !delta_new) {
+            fprintf(stderr, "apkg-build: -D and -N go together\n");
+            usage();
+            return 1;
+        }
+        return make_delta(delta_old, delta_new, output);
+    }
+
     if (!pkg_dir) {
         fprintf(stderr, "apkg-build: -d <package-dir> is required\n");
         usage();
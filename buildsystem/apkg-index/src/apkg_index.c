@@ -3,13 +3,19 @@
  *
  * Scans a directory of .tar.gz package archives, extracts pkg.json metadata
  * from each, computes MD5 checksums, and writes a consolidated index.json.
+ * Delta packages built by `apkg-build -D/-N` next to an archive
+ * (<archive-stem>.from-<version>.apkd) are listed under its "deltas".
+ * With -b the same index is also written in apkg's binary form
+ * (index.bin), which clients search without parsing.
  *
  * Usage:
- *   apkg-index -d <packages-dir> -o <index.json> [-n <repo-name>] [-a <arch>]
+ *   apkg-index -d <packages-dir> -o <index.json> [-b <index.bin>]
+ *              [-n <repo-name>] [-a <arch>]
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -230,6 +236,112 @@ static char *extract_pkg_json(const char *archive_path)
     return buf;
 }
 
+/* ── Delta packages ────────────────────────────────────────────────── */
+
+#define DELTA_MAGIC "APKGDLT1"
+#define DELTA_HEADER_LEN 88
+#define DELTA_VERSION_OFF 56
+#define DELTA_VERSION_LEN 32
+
+/**
+ * Read the old version a delta package upgrades from (see apkg-build for
+ * the format). Returns 0 on success.
+ */
+static int delta_from_version(const char *delta_path, char *version, size_t version_sz)
+{
+    char cmd[1024];
+    char tmpfile[] = "/tmp/apkg-index-XXXXXX";
+    int fd = mkstemp(tmpfile);
+    if (fd < 0) return -1;
+    close(fd);
+
+    snprintf(cmd, sizeof(cmd), "gzip -dc '%s' 2>/dev/null | head -c %d > '%s'",
+             delta_path, DELTA_HEADER_LEN, tmpfile);
+    system(cmd);
+
+    unsigned char header[DELTA_HEADER_LEN];
+    FILE *f = fopen(tmpfile, "rb");
+    size_t n = f ? fread(header, 1, sizeof(header), f) : 0;
+    if (f) fclose(f);
+    unlink(tmpfile);
+
+    if (n != sizeof(header) || memcmp(header, DELTA_MAGIC, 8) != 0)
+        return -1;
+    size_t len = 0;
+    while (len < DELTA_VERSION_LEN && len + 1 < version_sz &&
+           header[DELTA_VERSION_OFF + len] != '\0') {
+        version[len] = (char)header[DELTA_VERSION_OFF + len];
+        len++;
+    }
+    version[len] = '\0';
+    return len > 0 ? 0 : -1;
+}
+
+typedef struct {
+    char *from;
+    char *filename;
+    long size;
+    char md5[33];
+} DeltaEntry;
+
+/**
+ * Collect the delta packages for the archive `archive_name`: every
+ * <archive-stem>.from-<version>.apkd in pkg_dir. Returns the count.
+ */
+static int collect_deltas(const char *pkg_dir, const char *archive_name, DeltaEntry **deltas)
+{
+    size_t stem_len = strlen(archive_name) - 7; /* strip ".tar.gz" */
+    int count = 0, cap = 0;
+
+    *deltas = NULL;
+    DIR *dir = opendir(pkg_dir);
+    struct dirent *ent;
+    while (dir && (ent = readdir(dir)) != NULL) {
+        size_t namelen = strlen(ent->d_name);
+        if (namelen <= stem_len + 11 ||
+            strncmp(ent->d_name, archive_name, stem_len) != 0 ||
+            strncmp(ent->d_name + stem_len, ".from-", 6) != 0 ||
+            strcmp(ent->d_name + namelen - 5, ".apkd") != 0)
+            continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", pkg_dir, ent->d_name);
+        struct stat st;
+        char from[DELTA_VERSION_LEN + 1];
+        if (stat(path, &st) != 0 || delta_from_version(path, from, sizeof(from)) != 0) {
+            fprintf(stderr, "apkg-index: warning: '%s' is not a delta package\n", ent->d_name);
+            continue;
+        }
+        if (count == cap) {
+            cap = cap ? cap * 2 : 4;
+            *deltas = realloc(*deltas, cap * sizeof(DeltaEntry));
+            if (!*deltas) { perror("realloc"); exit(1); }
+        }
+        DeltaEntry *d = &(*deltas)[count++];
+        d->from = strdup(from);
+        d->filename = strdup(ent->d_name);
+        d->size = (long)st.st_size;
+        md5_file(path, d->md5);
+    }
+    if (dir) closedir(dir);
+    return count;
+}
+
+static void json_write_escaped(FILE *out, const char *s);
+
+/** Write a package's "deltas" array. */
+static void write_deltas(FILE *out, const DeltaEntry *deltas, int count)
+{
+    fprintf(out, "[");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%s\n        {", i > 0 ? "," : "");
+        fprintf(out, "\"from\": "); json_write_escaped(out, deltas[i].from);
+        fprintf(out, ", \"filename\": "); json_write_escaped(out, deltas[i].filename);
+        fprintf(out, ", \"size\": %ld, \"md5\": \"%s\"}", deltas[i].size, deltas[i].md5);
+    }
+    fprintf(out, count > 0 ? "\n      ]" : "]");
+}
+
 /* ── JSON string escaping ──────────────────────────────────────────── */
 
 static void json_write_escaped(FILE *out, const char *s)
@@ -282,18 +394,273 @@ static void json_copy_array(FILE *out, const char *arr_start)
     } while (depth > 0 && *p);
 }
 
+/**
+ * Parse a JSON array of strings (as returned by json_get_array).
+ * Returns a malloc'd array of malloc'd strings and sets *count.
+ */
+static char **json_parse_string_array(const char *arr_start, int *count)
+{
+    char **items = NULL;
+    int n = 0, cap = 0;
+    const char *p = arr_start;
+
+    *count = 0;
+    if (*p != '[') return NULL;
+    p++;
+    while (*p && *p != ']') {
+        if (*p != '"') { p++; continue; }
+        p++;
+        const char *start = p;
+        size_t len = 0;
+        while (*p && *p != '"') {
+            if (*p == '\\' && *(p + 1)) p++;
+            p++;
+            len++;
+        }
+        char *item = malloc(len + 1);
+        if (!item) { perror("malloc"); exit(1); }
+        size_t i = 0;
+        for (const char *q = start; q < p; q++) {
+            if (*q == '\\' && q + 1 < p) q++;
+            item[i++] = *q;
+        }
+        item[i] = '\0';
+        if (n == cap) {
+            cap = cap ? cap * 2 : 4;
+            items = realloc(items, cap * sizeof(char *));
+            if (!items) { perror("realloc"); exit(1); }
+        }
+        items[n++] = item;
+        if (*p) p++;
+    }
+    *count = n;
+    return items;
+}
+
+/* ── Binary index ──────────────────────────────────────────────────── */
+
+/*
+ * index.bin carries the same packages as index.json in a form apkg
+ * binary-searches in place: fixed-size records sorted by name, a string
+ * pool, dependency/provides lists and a sorted provider table. The
+ * layout is documented in bin/apkg/src/index.rs, which also builds it
+ * from index.json (byte for byte the same) when a mirror has none.
+ */
+
+#define BIN_MAGIC "APKGIDX1"
+#define BIN_HEADER_LEN 56
+#define BIN_STRINGS 9
+
+/** Everything index.bin records about one package. */
+typedef struct {
+    /* name, version, description, category, type, arch, md5, filename,
+     * min_os_version: the record's string order */
+    char *str[BIN_STRINGS];
+    long size;
+    long size_installed;
+    char **depends;
+    int depend_count;
+    char **provides;
+    int provide_count;
+    DeltaEntry *deltas;
+    int delta_count;
+    int order; /* position in index.json: the first same-named entry wins */
+} IndexEntry;
+
+typedef struct {
+    unsigned char *data;
+    size_t len, cap;
+} ByteBuf;
+
+static void buf_add(ByteBuf *b, const void *p, size_t n)
+{
+    if (b->len + n > b->cap) {
+        while (b->len + n > b->cap) b->cap = b->cap ? b->cap * 2 : 4096;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data) { perror("realloc"); exit(1); }
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void buf_u32(ByteBuf *b, uint32_t v)
+{
+    unsigned char le[4] = { v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24 };
+    buf_add(b, le, 4);
+}
+
+static void buf_u64(ByteBuf *b, uint64_t v)
+{
+    buf_u32(b, (uint32_t)v);
+    buf_u32(b, (uint32_t)(v >> 32));
+}
+
+/** Append s to the pool and its (offset, length) reference to b. */
+static void buf_str(ByteBuf *b, ByteBuf *pool, const char *s)
+{
+    size_t len = strlen(s);
+    buf_u32(b, (uint32_t)pool->len);
+    buf_u32(b, (uint32_t)len);
+    buf_add(pool, s, len);
+}
+
+static int cmp_entry(const void *a, const void *b)
+{
+    const IndexEntry *x = *(const IndexEntry * const *)a;
+    const IndexEntry *y = *(const IndexEntry * const *)b;
+    int c = strcmp(x->str[0], y->str[0]);
+    return c ? c : x->order - y->order;
+}
+
+typedef struct {
+    const char *name;
+    uint32_t package;
+    int order;
+} Provider;
+
+static int cmp_provider(const void *a, const void *b)
+{
+    const Provider *x = a, *y = b;
+    int c = strcmp(x->name, y->name);
+    return c ? c : x->order - y->order;
+}
+
+/** Write index.bin for the collected entries. Returns 0 on success. */
+static int write_binary_index(const char *path, const char *repo_name,
+                              IndexEntry *entries, int count)
+{
+    IndexEntry **sorted = malloc((count + 1) * sizeof(IndexEntry *));
+    if (!sorted) { perror("malloc"); exit(1); }
+    for (int i = 0; i < count; i++) sorted[i] = &entries[i];
+    qsort(sorted, count, sizeof(IndexEntry *), cmp_entry);
+
+    ByteBuf recs = {0}, lists = {0}, deltas = {0}, provs = {0}, pool = {0}, repo = {0};
+    Provider *providers = NULL;
+    int provider_count = 0, provider_cap = 0;
+    uint32_t list_count = 0, delta_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        IndexEntry *e = sorted[i];
+        for (int f = 0; f < BIN_STRINGS; f++)
+            buf_str(&recs, &pool, e->str[f]);
+        buf_u64(&recs, (uint64_t)e->size);
+        buf_u64(&recs, (uint64_t)e->size_installed);
+
+        buf_u32(&recs, list_count);
+        buf_u32(&recs, (uint32_t)e->depend_count);
+        for (int j = 0; j < e->depend_count; j++)
+            buf_str(&lists, &pool, e->depends[j]);
+        list_count += e->depend_count;
+
+        buf_u32(&recs, list_count);
+        buf_u32(&recs, (uint32_t)e->provide_count);
+        for (int j = 0; j < e->provide_count; j++)
+            buf_str(&lists, &pool, e->provides[j]);
+        list_count += e->provide_count;
+
+        buf_u32(&recs, delta_count);
+        buf_u32(&recs, (uint32_t)e->delta_count);
+        for (int j = 0; j < e->delta_count; j++) {
+            buf_str(&deltas, &pool, e->deltas[j].from);
+            buf_str(&deltas, &pool, e->deltas[j].filename);
+            buf_str(&deltas, &pool, e->deltas[j].md5);
+            buf_u64(&deltas, (uint64_t)e->deltas[j].size);
+        }
+        delta_count += e->delta_count;
+
+        for (int j = 0; j < e->provide_count; j++) {
+            if (provider_count == provider_cap) {
+                provider_cap = provider_cap ? provider_cap * 2 : 16;
+                providers = realloc(providers, provider_cap * sizeof(Provider));
+                if (!providers) { perror("realloc"); exit(1); }
+            }
+            providers[provider_count].name = e->provides[j];
+            providers[provider_count].package = (uint32_t)i;
+            providers[provider_count].order = provider_count;
+            provider_count++;
+        }
+    }
+
+    if (provider_count > 0)
+        qsort(providers, provider_count, sizeof(Provider), cmp_provider);
+    for (int i = 0; i < provider_count; i++) {
+        buf_str(&provs, &pool, providers[i].name);
+        buf_u32(&provs, providers[i].package);
+    }
+    buf_str(&repo, &pool, repo_name);
+
+    uint32_t packages_off = BIN_HEADER_LEN;
+    uint32_t providers_off = packages_off + (uint32_t)recs.len;
+    uint32_t deltas_off = providers_off + (uint32_t)provs.len;
+    uint32_t lists_off = deltas_off + (uint32_t)deltas.len;
+    uint32_t pool_off = lists_off + (uint32_t)lists.len;
+
+    ByteBuf out = {0};
+    buf_add(&out, BIN_MAGIC, 8);
+    buf_u32(&out, (uint32_t)count);
+    buf_u32(&out, packages_off);
+    buf_u32(&out, (uint32_t)provider_count);
+    buf_u32(&out, providers_off);
+    buf_u32(&out, delta_count);
+    buf_u32(&out, deltas_off);
+    buf_u32(&out, list_count);
+    buf_u32(&out, lists_off);
+    buf_u32(&out, (uint32_t)pool.len);
+    buf_u32(&out, pool_off);
+    buf_add(&out, repo.data, repo.len);
+    buf_add(&out, recs.data, recs.len);
+    buf_add(&out, provs.data, provs.len);
+    buf_add(&out, deltas.data, deltas.len);
+    buf_add(&out, lists.data, lists.len);
+    buf_add(&out, pool.data, pool.len);
+
+    int rc = -1;
+    FILE *f = fopen(path, "wb");
+    if (f) {
+        if (fwrite(out.data, 1, out.len, f) == out.len) rc = 0;
+        if (fclose(f) != 0) rc = -1;
+    }
+
+    free(out.data);
+    free(recs.data);
+    free(lists.data);
+    free(deltas.data);
+    free(provs.data);
+    free(pool.data);
+    free(repo.data);
+    free(providers);
+    free(sorted);
+    return rc;
+}
+
+static void free_entry(IndexEntry *e)
+{
+    for (int f = 0; f < BIN_STRINGS; f++) free(e->str[f]);
+    for (int j = 0; j < e->depend_count; j++) free(e->depends[j]);
+    for (int j = 0; j < e->provide_count; j++) free(e->provides[j]);
+    for (int j = 0; j < e->delta_count; j++) {
+        free(e->deltas[j].from);
+        free(e->deltas[j].filename);
+    }
+    free(e->depends);
+    free(e->provides);
+    free(e->deltas);
+}
+
 /* ── Main ──────────────────────────────────────────────────────────── */
 
 static void usage(void)
 {
     fprintf(stderr,
-        "Usage: apkg-index -d <packages-dir> -o <index.json> [-n <name>] [-a <arch>]\n"
+        "Usage: apkg-index -d <packages-dir> -o <index.json> [-b <index.bin>]\n"
+        "                  [-n <name>] [-a <arch>]\n"
         "\n"
         "Generate a repository index from .tar.gz package archives.\n"
         "\n"
         "Options:\n"
         "  -d <dir>    Directory containing .tar.gz packages (required)\n"
         "  -o <file>   Output index.json file (required)\n"
+        "  -b <file>   Also write the binary index (index.bin)\n"
         "  -n <name>   Repository name (default: \"anyOS Packages\")\n"
         "  -a <arch>   Architecture filter (default: all)\n"
         "  -h          Show this help\n"
@@ -304,6 +671,7 @@ int main(int argc, char **argv)
 {
     const char *pkg_dir = NULL;
     const char *output = NULL;
+    const char *bin_output = NULL;
     const char *repo_name = "anyOS Packages";
     const char *arch_filter = NULL;
 
@@ -312,6 +680,8 @@ int main(int argc, char **argv)
             pkg_dir = argv[++i];
         else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
             output = argv[++i];
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            bin_output = argv[++i];
         else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
             repo_name = argv[++i];
         else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
@@ -359,6 +729,8 @@ int main(int argc, char **argv)
     fprintf(out, "  \"packages\": [\n");
 
     int pkg_count = 0;
+    IndexEntry *entries = NULL;
+    int entry_cap = 0;
     struct dirent *ent;
 
     while ((ent = readdir(dir)) != NULL) {
@@ -415,6 +787,9 @@ int main(int argc, char **argv)
             continue;
         }
 
+        DeltaEntry *deltas;
+        int delta_count = collect_deltas(pkg_dir, ent->d_name, &deltas);
+
         /* Write package entry */
         if (pkg_count > 0) fprintf(out, ",\n");
 
@@ -431,9 +806,28 @@ int main(int argc, char **argv)
         fprintf(out, "      \"size_installed\": %ld,\n", size_installed);
         fprintf(out, "      \"md5\": \"%s\",\n", md5);
         fprintf(out, "      \"filename\": "); json_write_escaped(out, ent->d_name); fprintf(out, ",\n");
+        fprintf(out, "      \"deltas\": "); write_deltas(out, deltas, delta_count); fprintf(out, ",\n");
         fprintf(out, "      \"min_os_version\": "); json_write_escaped(out, min_os_version); fprintf(out, "\n");
         fprintf(out, "    }");
 
+        /* Keep what index.bin needs */
+        if (pkg_count == entry_cap) {
+            entry_cap = entry_cap ? entry_cap * 2 : 64;
+            entries = realloc(entries, entry_cap * sizeof(IndexEntry));
+            if (!entries) { perror("realloc"); exit(1); }
+        }
+        IndexEntry *e = &entries[pkg_count];
+        const char *strs[BIN_STRINGS] = { name, version, description, category,
+                                          type, arch, md5, ent->d_name, min_os_version };
+        for (int f = 0; f < BIN_STRINGS; f++) e->str[f] = strdup(strs[f]);
+        e->size = (long)st.st_size;
+        e->size_installed = size_installed;
+        e->depends = json_parse_string_array(json_get_array(pkg_json, "depends"), &e->depend_count);
+        e->provides = json_parse_string_array(json_get_array(pkg_json, "provides"), &e->provide_count);
+        e->deltas = deltas;
+        e->delta_count = delta_count;
+        e->order = pkg_count;
+
         pkg_count++;
         free(pkg_json);
     }
@@ -446,5 +840,17 @@ int main(int argc, char **argv)
     closedir(dir);
 
     printf("apkg-index: generated %s (%d packages)\n", output, pkg_count);
-    return 0;
+
+    int rc = 0;
+    if (bin_output) {
+        if (write_binary_index(bin_output, repo_name, entries, pkg_count) == 0) {
+            printf("apkg-index: generated %s\n", bin_output);
+        } else {
+            fprintf(stderr, "apkg-index: cannot write '%s'\n", bin_output);
+            rc = 1;
+        }
+    }
+    for (int i = 0; i < pkg_count; i++) free_entry(&entries[i]);
+    free(entries);
+    return rc;
 }
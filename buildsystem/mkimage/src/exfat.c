@@ -9,6 +9,7 @@
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <time.h>
 
 /* ═══════════════════════════════════════════════════════════════════════════
  * Internal helpers
@@ -24,14 +25,14 @@ static uint32_t exfat_abs_offset(const ExFat *fs, uint32_t rel_sector)
 static void exfat_write_sector(ExFat *fs, uint32_t rel, const uint8_t *data)
 {
     uint32_t offset = exfat_abs_offset(fs, rel);
-    memcpy(fs->image + offset, data, SECTOR_SIZE);
+    image_put(fs->img, offset, data, SECTOR_SIZE);
 }
 
 /* Read 512 bytes from a filesystem-relative sector into out[]. */
 static void exfat_read_sector(const ExFat *fs, uint32_t rel, uint8_t *out)
 {
     uint32_t offset = exfat_abs_offset(fs, rel);
-    memcpy(out, fs->image + offset, SECTOR_SIZE);
+    memcpy(out, image_read(fs->img, offset, SECTOR_SIZE), SECTOR_SIZE);
 }
 
 /* Convert cluster number (>=2) to filesystem-relative sector. */
@@ -210,6 +211,34 @@ static uint16_t exfat_name_hash(const uint16_t *utf16, uint32_t len)
     return h;
 }
 
+/*
+ * Encode a host mtime as an exFAT timestamp (UTC — the kernel keeps no
+ * timezone); odd seconds go into the 10 ms increment byte.  Returns 0
+ * ("unknown") for files modified within the last second or so: a second
+ * change in the same second would leave the timestamp alone, so the next
+ * incremental run must compare such a file's content.
+ */
+static uint32_t exfat_timestamp(int64_t mtime, uint8_t *ms10)
+{
+    time_t     t = (time_t)mtime;
+    struct tm *tm;
+
+    *ms10 = 0;
+    if (mtime <= 0 || mtime >= (int64_t)time(NULL) - 1)
+        return 0;
+    tm = gmtime(&t);
+    if (!tm || tm->tm_year < 80 || tm->tm_year > 207)
+        return 0;
+
+    *ms10 = (uint8_t)((tm->tm_sec & 1) ? 100 : 0);
+    return ((uint32_t)(tm->tm_year - 80) << 25) |
+           ((uint32_t)(tm->tm_mon + 1)   << 21) |
+           ((uint32_t)tm->tm_mday        << 16) |
+           ((uint32_t)tm->tm_hour        << 11) |
+           ((uint32_t)tm->tm_min         << 5)  |
+           ((uint32_t)tm->tm_sec / 2);
+}
+
 /*
  * Build a complete exFAT directory entry set (File + Stream + FileName entries).
  *
@@ -219,6 +248,7 @@ static uint16_t exfat_name_hash(const uint16_t *utf16, uint32_t len)
  * data_length  — file/dir data length in bytes
  * contiguous   — set EXFAT_FLAG_CONTIGUOUS if true
  * uid, gid, mode — VFS permissions stored in reserved fields
+ * mtime, mtime_10ms — LastModified timestamp (0 = unknown)
  * out_buf      — caller-supplied buffer (must be >= (2 + fn_entries) * 32 bytes)
  * out_len      — receives byte count written
  *
@@ -228,6 +258,7 @@ static void exfat_build_entry_set(const char *name, uint16_t attrs,
                                   uint32_t first_cluster, uint64_t data_length,
                                   int contiguous,
                                   uint16_t uid, uint16_t gid, uint16_t mode,
+                                  uint32_t mtime, uint8_t mtime_10ms,
                                   uint8_t *out_buf, uint32_t *out_len)
 {
     /* Build UTF-16 array from name (ASCII only) */
@@ -263,6 +294,8 @@ static void exfat_build_entry_set(const char *name, uint16_t attrs,
     write_le16(out_buf + 6,  uid);
     write_le16(out_buf + 8,  gid);
     write_le16(out_buf + 10, mode);
+    write_le32(out_buf + 12, mtime);
+    out_buf[21] = mtime_10ms;
 
     /* ── Stream Extension (0xC0) ──────────────────────────────────── */
     {
@@ -401,13 +434,14 @@ static void exfat_add_entry_to_dir(ExFat *fs, uint32_t dir_cluster,
  * Initialise exFAT parameters and allocate in-memory caches.
  * Mirrors ExFatFormatter.__init__().
  */
-void exfat_init(ExFat *fs, uint8_t *image, uint32_t fs_start,
+void exfat_init(ExFat *fs, Image *img, uint32_t fs_start,
                 uint32_t fs_sectors, uint32_t spc)
 {
     uint32_t est_clusters;
     uint32_t fat_bytes;
 
-    fs->image      = image;
+    fs->img        = img;
+    fs->jobs       = 1;
     fs->fs_start   = fs_start;
     fs->fs_sectors = fs_sectors;
     fs->spc        = spc;
@@ -664,8 +698,13 @@ void exfat_init_fs(ExFat *fs)
     free(root_data);
 
     /* Update VBR root cluster field in both main and backup boot sectors */
-    write_le32(fs->image + exfat_abs_offset(fs, 0)  + 96, fs->root_cluster);
-    write_le32(fs->image + exfat_abs_offset(fs, 12) + 96, fs->root_cluster);
+    {
+        uint8_t vbr[SECTOR_SIZE];
+        exfat_read_sector(fs, 0, vbr);
+        write_le32(vbr + 96, fs->root_cluster);
+        exfat_write_sector(fs, 0, vbr);
+        exfat_write_sector(fs, 12, vbr);
+    }
 
     printf("  exFAT: bitmap=cluster %u, upcase=cluster %u, root=cluster %u\n",
            fs->bitmap_cluster, upcase_cluster, fs->root_cluster);
@@ -695,7 +734,7 @@ uint32_t exfat_create_dir(ExFat *fs, uint32_t parent, const char *name,
     }
 
     exfat_build_entry_set(name, EXFAT_ATTR_DIR, dir_cluster, 0,
-                          0 /* not contiguous */, uid, gid, mode,
+                          0 /* not contiguous */, uid, gid, mode, 0, 0,
                           entry_buf, &entry_len);
 
     if (parent == 0)
@@ -712,17 +751,19 @@ uint32_t exfat_create_dir(ExFat *fs, uint32_t parent, const char *name,
  */
 void exfat_add_file(ExFat *fs, uint32_t parent, const char *name,
                     const uint8_t *data, size_t size,
-                    uint16_t uid, uint16_t gid, uint16_t mode)
+                    uint16_t uid, uint16_t gid, uint16_t mode, int64_t mtime)
 {
     uint8_t  entry_buf[32 * (1 + 1 + ((255 + 14) / 15))];
     uint32_t entry_len;
+    uint8_t  ms10;
+    uint32_t ts = exfat_timestamp(mtime, &ms10);
 
     if (parent == 0)
         parent = fs->root_cluster;
 
     if (size == 0) {
         exfat_build_entry_set(name, EXFAT_ATTR_ARCHIVE, 0, 0,
-                              1 /* contiguous */, uid, gid, mode,
+                              1 /* contiguous */, uid, gid, mode, ts, ms10,
                               entry_buf, &entry_len);
         exfat_add_entry_to_dir(fs, parent, entry_buf, entry_len);
         return;
@@ -737,7 +778,7 @@ void exfat_add_file(ExFat *fs, uint32_t parent, const char *name,
 
         exfat_build_entry_set(name, EXFAT_ATTR_ARCHIVE, first_cluster,
                               (uint64_t)size,
-                              1 /* contiguous */, uid, gid, mode,
+                              1 /* contiguous */, uid, gid, mode, ts, ms10,
                               entry_buf, &entry_len);
         exfat_add_entry_to_dir(fs, parent, entry_buf, entry_len);
 
@@ -776,106 +817,193 @@ static int is_root_only(const char *virt_path)
     return 0;
 }
 
+/* ── Host directory scanning ──────────────────────────────────────────────── */
+
+/* Files read per parallel batch; bounds the memory held at once. */
+#define HOST_BATCH 64
+
 /*
- * Internal recursive worker.
- * Mirrors ExFatFormatter._populate_dir().
+ * A host directory entry.  Entries are stat'ed up front so that the file
+ * contents a directory needs can be read in parallel batches; allocation
+ * and writing stay serial so the image layout does not depend on -j.
  */
-static void exfat_populate_dir(ExFat *fs, const char *host_path,
-                               uint32_t parent_cluster,
-                               const char *virt_path)
+typedef struct {
+    char        *name;
+    char        *path;
+    struct stat  st;
+    int          ok;        /* stat succeeded */
+    int          want;      /* regular file whose content is needed */
+    int          loaded;
+    uint8_t     *data;
+    size_t       size;
+} HostEntry;
+
+/*
+ * List a host directory: non-hidden entries in ASCII order (matches
+ * Python sorted()), each stat'ed.  Returns NULL if it cannot be opened.
+ */
+static HostEntry *exfat_scan_host_dir(const char *host_path, int *out_count)
 {
     DIR           *d;
     struct dirent *ent;
-    char         **names      = NULL;
-    int            name_count = 0;
-    int            name_cap   = 0;
+    HostEntry     *ents  = NULL;
+    int            count = 0;
+    int            cap   = 0;
     int            i;
 
     d = opendir(host_path);
     if (!d) {
         fprintf(stderr, "  WARNING: Cannot open directory %s\n", host_path);
-        return;
+        return NULL;
     }
 
-    /* Collect non-hidden entry names */
     while ((ent = readdir(d)) != NULL) {
-        const char *n = ent->d_name;
-
         /* Skip "." and ".." (and all dot-files per Python: entry_name.startswith('.')) */
-        if (n[0] == '.')
+        if (ent->d_name[0] == '.')
             continue;
 
-        /* Grow array */
-        if (name_count >= name_cap) {
-            int    new_cap = (name_cap == 0) ? 64 : name_cap * 2;
-            char **tmp     = (char **)realloc(names,
-                                              (size_t)new_cap * sizeof(char *));
+        if (count >= cap) {
+            int        new_cap = (cap == 0) ? 64 : cap * 2;
+            HostEntry *tmp     = (HostEntry *)realloc(ents,
+                                     (size_t)new_cap * sizeof(HostEntry));
             if (!tmp)
-                fatal("exfat_populate_dir: realloc failed");
-            names    = tmp;
-            name_cap = new_cap;
+                fatal("exfat_scan_host_dir: realloc failed");
+            ents = tmp;
+            cap  = new_cap;
         }
-        names[name_count++] = strdup(n);
+        memset(&ents[count], 0, sizeof(HostEntry));
+        ents[count++].name = strdup(ent->d_name);
     }
     closedir(d);
 
-    /* Sort (ASCII order, matches Python sorted()) */
-    for (i = 0; i < name_count - 1; ++i) {
+    /* Sort (ASCII order) */
+    for (i = 0; i < count - 1; ++i) {
         int j;
-        for (j = i + 1; j < name_count; ++j) {
-            if (strcmp(names[i], names[j]) > 0) {
-                char *tmp  = names[i];
-                names[i]   = names[j];
-                names[j]   = tmp;
+        for (j = i + 1; j < count; ++j) {
+            if (strcmp(ents[i].name, ents[j].name) > 0) {
+                HostEntry tmp = ents[i];
+                ents[i]       = ents[j];
+                ents[j]       = tmp;
             }
         }
     }
 
+    for (i = 0; i < count; ++i) {
+        size_t len = strlen(host_path) + strlen(ents[i].name) + 2;
+        ents[i].path = (char *)malloc(len);
+        if (!ents[i].path)
+            fatal("exfat_scan_host_dir: malloc failed");
+        snprintf(ents[i].path, len, "%s/%s", host_path, ents[i].name);
+        ents[i].ok = stat(ents[i].path, &ents[i].st) == 0;
+    }
+
+    *out_count = count;
+    return ents;
+}
+
+static void exfat_free_host_dir(HostEntry *ents, int count)
+{
+    int i;
+    for (i = 0; i < count; ++i) {
+        free(ents[i].name);
+        free(ents[i].path);
+        free(ents[i].data);
+    }
+    free(ents);
+}
+
+static void exfat_read_host_file(void *arg, int i)
+{
+    HostEntry *e = ((HostEntry **)arg)[i];
+    e->data = read_file(e->path, &e->size);
+    if (!e->data)
+        e->size = 0;
+    e->loaded = 1;
+}
+
+/*
+ * Make sure ents[from] is loaded, reading it together with the next
+ * wanted files of the directory (up to HOST_BATCH) on fs->jobs threads.
+ */
+static void exfat_prefetch(ExFat *fs, HostEntry *ents, int from, int count)
+{
+    HostEntry *batch[HOST_BATCH];
+    int        n = 0;
+    int        i;
+
+    if (ents[from].loaded)
+        return;
+    for (i = from; i < count && n < HOST_BATCH; ++i) {
+        if (ents[i].want && !ents[i].loaded)
+            batch[n++] = &ents[i];
+    }
+    parallel_for(fs->jobs, n, exfat_read_host_file, batch);
+}
+
+/* Release a file's content once it has been written. */
+static void exfat_drop_host_file(HostEntry *e)
+{
+    free(e->data);
+    e->data = NULL;
+    e->size = 0;
+}
+
+/*
+ * Internal recursive worker.
+ * Mirrors ExFatFormatter._populate_dir().
+ */
+static void exfat_populate_dir(ExFat *fs, const char *host_path,
+                               uint32_t parent_cluster,
+                               const char *virt_path)
+{
+    HostEntry *ents;
+    int        count = 0;
+    int        i;
+
+    ents = exfat_scan_host_dir(host_path, &count);
+    if (!ents)
+        return;
+
+    for (i = 0; i < count; ++i)
+        ents[i].want = ents[i].ok && S_ISREG(ents[i].st.st_mode);
+
     /* Process each entry */
-    for (i = 0; i < name_count; ++i) {
-        const char *entry_name = names[i];
-        char        full_path[4096];
+    for (i = 0; i < count; ++i) {
+        HostEntry  *e = &ents[i];
         char        child_virt[4096];
-        struct stat st;
         uint16_t    uid, gid, mode;
 
-        snprintf(full_path,  sizeof(full_path),  "%s/%s", host_path, entry_name);
-
         /* Build virtual path: "parentvirt/entryname" or just "entryname" at root */
         if (virt_path[0] == '\0')
-            snprintf(child_virt, sizeof(child_virt), "%s", entry_name);
+            snprintf(child_virt, sizeof(child_virt), "%s", e->name);
         else
-            snprintf(child_virt, sizeof(child_virt), "%s/%s", virt_path, entry_name);
+            snprintf(child_virt, sizeof(child_virt), "%s/%s", virt_path, e->name);
 
-        if (stat(full_path, &st) != 0) {
-            free(names[i]);
+        if (!e->ok)
             continue;
-        }
 
         /* Determine permissions */
         uid  = 0;
         gid  = 0;
         mode = is_root_only(child_virt) ? 0xF00 : 0xFFF;
 
-        if (S_ISDIR(st.st_mode)) {
+        if (S_ISDIR(e->st.st_mode)) {
             uint32_t dir_cluster = exfat_create_dir(fs, parent_cluster,
-                                                    entry_name, uid, gid, mode);
+                                                    e->name, uid, gid, mode);
             printf("    Dir:  %s/ (cluster=%u)%s\n",
-                   entry_name, dir_cluster,
+                   e->name, dir_cluster,
                    (mode == 0xF00) ? " [root-only]" : "");
-            exfat_populate_dir(fs, full_path, dir_cluster, child_virt);
-        } else if (S_ISREG(st.st_mode)) {
-            size_t   file_size;
-            uint8_t *file_data = read_file(full_path, &file_size);
-            exfat_add_file(fs, parent_cluster, entry_name,
-                           file_data, file_size, uid, gid, mode);
-            free(file_data);
+            exfat_populate_dir(fs, e->path, dir_cluster, child_virt);
+        } else if (S_ISREG(e->st.st_mode)) {
+            exfat_prefetch(fs, ents, i, count);
+            exfat_add_file(fs, parent_cluster, e->name,
+                           e->data, e->size, uid, gid, mode,
+                           (int64_t)e->st.st_mtime);
+            exfat_drop_host_file(e);
         }
-
-        free(names[i]);
     }
 
-    free(names);
+    exfat_free_host_dir(ents, count);
 }
 
 /*
@@ -970,16 +1098,18 @@ void exfat_free(ExFat *fs)
  * Loads FAT cache and allocation bitmap from the image data.
  * After this call, the ExFat struct is ready for sync operations.
  */
-void exfat_open_existing(ExFat *fs, uint8_t *image, uint32_t fs_start)
+void exfat_open_existing(ExFat *fs, Image *img, uint32_t fs_start)
 {
-    uint8_t *vbr = image + (size_t)fs_start * SECTOR_SIZE;
+    const uint8_t *vbr = image_read(img, (size_t)fs_start * SECTOR_SIZE,
+                                    SECTOR_SIZE);
 
     /* Verify exFAT signature */
     if (memcmp(vbr + 3, "EXFAT   ", 8) != 0)
         fatal("exfat_open_existing: not an exFAT filesystem at sector %u", fs_start);
 
-    fs->image    = image;
+    fs->img      = img;
     fs->fs_start = fs_start;
+    fs->jobs     = 1;
 
     /* Parse VBR fields */
     fs->fs_sectors         = (uint32_t)read_le64(vbr + 72);
@@ -996,7 +1126,8 @@ void exfat_open_existing(ExFat *fs, uint8_t *image, uint32_t fs_start)
     fs->fat_cache = (uint8_t *)malloc(fat_bytes);
     if (!fs->fat_cache) fatal("exfat_open_existing: malloc fat_cache failed");
     memcpy(fs->fat_cache,
-           image + (size_t)(fs_start + fs->fat_offset) * SECTOR_SIZE,
+           image_read(img, (size_t)(fs_start + fs->fat_offset) * SECTOR_SIZE,
+                      fat_bytes),
            fat_bytes);
 
     /* Load allocation bitmap from cluster 2 */
@@ -1012,7 +1143,8 @@ void exfat_open_existing(ExFat *fs, uint8_t *image, uint32_t fs_start)
         uint32_t chunk = fs->bitmap_bytes - bm_offset;
         if (chunk > fs->cluster_size) chunk = fs->cluster_size;
         memcpy(fs->bitmap + bm_offset,
-               image + (size_t)(fs_start + bm_sector + i * fs->spc) * SECTOR_SIZE,
+               image_read(img, (size_t)(fs_start + bm_sector + i * fs->spc) * SECTOR_SIZE,
+                          chunk),
                chunk);
         bm_offset += fs->cluster_size;
     }
@@ -1051,7 +1183,8 @@ static uint8_t *exfat_read_cluster_data(ExFat *fs, uint32_t first_cluster,
         uint32_t abs_off = (fs->fs_start + sector) * SECTOR_SIZE;
         uint64_t chunk = length - offset;
         if (chunk > fs->cluster_size) chunk = fs->cluster_size;
-        memcpy(data + offset, fs->image + abs_off, (size_t)chunk);
+        memcpy(data + offset, image_read(fs->img, abs_off, (size_t)chunk),
+               (size_t)chunk);
         offset += fs->cluster_size;
 
         if (contiguous) {
@@ -1117,6 +1250,7 @@ ExFatNode *exfat_read_dir_tree(ExFat *fs, uint32_t dir_cluster)
                 uint16_t uid   = read_le16(dir_data + off + 6);
                 uint16_t gid   = read_le16(dir_data + off + 8);
                 uint16_t mode  = read_le16(dir_data + off + 10);
+                uint32_t mtime = read_le32(dir_data + off + 12);
 
                 /* Parse stream extension (second entry) */
                 uint32_t stream_off = off + 32;
@@ -1149,6 +1283,8 @@ ExFatNode *exfat_read_dir_tree(ExFat *fs, uint32_t dir_cluster)
                 node->uid           = uid;
                 node->gid           = gid;
                 node->mode          = mode;
+                node->mtime         = mtime;
+                node->mtime_10ms    = dir_data[off + 21];
                 node->contiguous    = (flags & EXFAT_FLAG_CONTIGUOUS) ? 1 : 0;
                 node->dir_cluster   = cluster;  /* actual cluster containing this entry */
                 node->entry_offset  = off;
@@ -1236,7 +1372,8 @@ int exfat_file_matches(ExFat *fs, ExFatNode *node,
         size_t chunk = new_size - offset;
         if (chunk > fs->cluster_size) chunk = fs->cluster_size;
 
-        if (memcmp(fs->image + abs_off, new_data + offset, chunk) != 0)
+        if (memcmp(image_read(fs->img, abs_off, chunk),
+                   new_data + offset, chunk) != 0)
             return 0;
 
         offset += fs->cluster_size;
@@ -1302,111 +1439,148 @@ void exfat_delete_entry(ExFat *fs, ExFatNode *node)
     uint32_t abs_off = (fs->fs_start + sector) * SECTOR_SIZE + offset;
 
     /* Mark each entry in the set as deleted (clear bit 7 of type byte) */
-    uint32_t num_entries = node->entry_set_len / 32;
-    for (uint32_t i = 0; i < num_entries; i++) {
-        fs->image[abs_off + i * 32] &= 0x7F;
+    uint8_t entries[32 * (1 + 1 + ((255 + 14) / 15))];
+    uint32_t len = node->entry_set_len;
+    if (len > sizeof(entries)) len = sizeof(entries);
+    memcpy(entries, image_read(fs->img, abs_off, len), len);
+    for (uint32_t i = 0; i < len / 32; i++) {
+        entries[i * 32] &= 0x7F;
     }
+    image_put(fs->img, abs_off, entries, len);
 }
 
+/*
+ * Rewrite the LastModified timestamp of an entry set in place and fix up
+ * its checksum.  Used when a file's content is unchanged but the image
+ * holds an older (or no) timestamp for it.
+ */
+static void exfat_touch_entry(ExFat *fs, ExFatNode *node,
+                              uint32_t mtime, uint8_t mtime_10ms)
+{
+    uint32_t sector  = exfat_cluster_to_sector(fs, node->dir_cluster);
+    uint32_t abs_off = (fs->fs_start + sector) * SECTOR_SIZE + node->entry_offset;
+    uint8_t  entries[32 * (1 + 1 + ((255 + 14) / 15))];
+    uint32_t len = node->entry_set_len;
+
+    if (len > sizeof(entries))
+        return;
+    memcpy(entries, image_read(fs->img, abs_off, len), len);
+    write_le32(entries + 12, mtime);
+    entries[21] = mtime_10ms;
+    write_le16(entries + 2, exfat_entry_set_checksum(entries, len));
+    image_put(fs->img, abs_off, entries, len);
+
+    node->mtime      = mtime;
+    node->mtime_10ms = mtime_10ms;
+}
+
+/* Counters reported by exfat_sync_sysroot(). */
+typedef struct {
+    int unchanged;
+    int skipped;    /* unchanged by size + timestamp, never read */
+    int updated;
+    int added;
+} SyncStats;
+
 /*
  * Internal: sync a single directory, comparing sysroot entries with
  * existing filesystem entries.
+ *
+ * A file whose size and mtime match its entry's LastModified timestamp is
+ * taken as unchanged without being read, so a no-op sync only stats the
+ * sysroot.  Everything else is read (in parallel) and compared with the
+ * image content.
  */
 static void exfat_sync_dir(ExFat *fs, const char *host_path,
                             uint32_t parent_cluster, ExFatNode *existing,
-                            const char *virt_path,
-                            int *n_unchanged, int *n_updated, int *n_added)
+                            const char *virt_path, SyncStats *stats)
 {
-    DIR *d = opendir(host_path);
-    if (!d) {
-        fprintf(stderr, "  WARNING: Cannot open directory %s\n", host_path);
+    int        count = 0;
+    HostEntry *ents  = exfat_scan_host_dir(host_path, &count);
+    if (!ents)
         return;
-    }
-
-    /* Collect and sort names (same as exfat_populate_dir) */
-    char **names = NULL;
-    int name_count = 0, name_cap = 0;
-    struct dirent *ent;
-
-    while ((ent = readdir(d)) != NULL) {
-        if (ent->d_name[0] == '.') continue;
-        if (name_count >= name_cap) {
-            int new_cap = (name_cap == 0) ? 64 : name_cap * 2;
-            names = (char **)realloc(names, (size_t)new_cap * sizeof(char *));
-            if (!names) fatal("exfat_sync_dir: realloc failed");
-            name_cap = new_cap;
-        }
-        names[name_count++] = strdup(ent->d_name);
-    }
-    closedir(d);
 
-    /* Sort ASCII */
-    for (int i = 0; i < name_count - 1; i++) {
-        for (int j = i + 1; j < name_count; j++) {
-            if (strcmp(names[i], names[j]) > 0) {
-                char *tmp = names[i]; names[i] = names[j]; names[j] = tmp;
-            }
-        }
+    /* Decide which files have to be read before reading any of them */
+    for (int i = 0; i < count; i++) {
+        HostEntry *e = &ents[i];
+        if (!e->ok || !S_ISREG(e->st.st_mode))
+            continue;
+        ExFatNode *child = exfat_find_child(existing, e->name);
+        uint8_t ms10;
+        uint32_t ts = exfat_timestamp((int64_t)e->st.st_mtime, &ms10);
+        e->want = !(child && !(child->attrs & EXFAT_ATTR_DIR) && ts != 0 &&
+                    child->mtime == ts && child->mtime_10ms == ms10 &&
+                    child->data_length == (uint64_t)e->st.st_size);
     }
 
-    for (int i = 0; i < name_count; i++) {
-        char full_path[4096], child_virt[4096];
-        snprintf(full_path, sizeof(full_path), "%s/%s", host_path, names[i]);
+    for (int i = 0; i < count; i++) {
+        HostEntry *e = &ents[i];
+        char child_virt[4096];
 
         if (virt_path[0] == '\0')
-            snprintf(child_virt, sizeof(child_virt), "%s", names[i]);
+            snprintf(child_virt, sizeof(child_virt), "%s", e->name);
         else
-            snprintf(child_virt, sizeof(child_virt), "%s/%s", virt_path, names[i]);
+            snprintf(child_virt, sizeof(child_virt), "%s/%s", virt_path, e->name);
 
-        struct stat st;
-        if (stat(full_path, &st) != 0) { free(names[i]); continue; }
+        if (!e->ok) continue;
 
         uint16_t uid = 0, gid = 0;
         uint16_t mode = is_root_only(child_virt) ? 0xF00 : 0xFFF;
 
-        ExFatNode *child = exfat_find_child(existing, names[i]);
+        ExFatNode *child = exfat_find_child(existing, e->name);
 
-        if (S_ISDIR(st.st_mode)) {
+        if (S_ISDIR(e->st.st_mode)) {
             if (child && (child->attrs & EXFAT_ATTR_DIR)) {
                 /* Directory exists — recurse */
-                exfat_sync_dir(fs, full_path, child->first_cluster, child,
-                               child_virt, n_unchanged, n_updated, n_added);
+                exfat_sync_dir(fs, e->path, child->first_cluster, child,
+                               child_virt, stats);
             } else {
                 /* New directory */
                 uint32_t dir_cl = exfat_create_dir(fs, parent_cluster,
-                                                    names[i], uid, gid, mode);
-                printf("    Dir+: %s/ (cluster=%u)\n", names[i], dir_cl);
+                                                    e->name, uid, gid, mode);
+                printf("    Dir+: %s/ (cluster=%u)\n", e->name, dir_cl);
                 /* Populate new directory fully */
-                exfat_populate_dir(fs, full_path, dir_cl, child_virt);
-                (*n_added)++;
+                exfat_populate_dir(fs, e->path, dir_cl, child_virt);
+                stats->added++;
             }
-        } else if (S_ISREG(st.st_mode)) {
-            size_t file_size;
-            uint8_t *file_data = read_file(full_path, &file_size);
+        } else if (S_ISREG(e->st.st_mode)) {
+            int64_t mtime = (int64_t)e->st.st_mtime;
+
+            if (!e->want) {
+                /* Size and timestamp match — not even read */
+                stats->unchanged++;
+                stats->skipped++;
+                continue;
+            }
+
+            exfat_prefetch(fs, ents, i, count);
 
             if (child && !(child->attrs & EXFAT_ATTR_DIR)) {
                 /* File exists — check if content changed */
-                if (exfat_file_matches(fs, child, file_data, file_size)) {
-                    (*n_unchanged)++;
+                if (exfat_file_matches(fs, child, e->data, e->size)) {
+                    uint8_t ms10;
+                    uint32_t ts = exfat_timestamp(mtime, &ms10);
+                    if (child->mtime != ts || child->mtime_10ms != ms10)
+                        exfat_touch_entry(fs, child, ts, ms10);
+                    stats->unchanged++;
                 } else {
                     /* Changed — delete old, add new */
                     exfat_free_clusters(fs, child);
                     exfat_delete_entry(fs, child);
-                    exfat_add_file(fs, parent_cluster, names[i],
-                                   file_data, file_size, uid, gid, mode);
-                    (*n_updated)++;
+                    exfat_add_file(fs, parent_cluster, e->name,
+                                   e->data, e->size, uid, gid, mode, mtime);
+                    stats->updated++;
                 }
             } else {
                 /* New file */
-                exfat_add_file(fs, parent_cluster, names[i],
-                               file_data, file_size, uid, gid, mode);
-                (*n_added)++;
+                exfat_add_file(fs, parent_cluster, e->name,
+                               e->data, e->size, uid, gid, mode, mtime);
+                stats->added++;
             }
-            free(file_data);
+            exfat_drop_host_file(e);
         }
-        free(names[i]);
     }
-    free(names);
+    exfat_free_host_dir(ents, count);
 }
 
 /*
@@ -1426,13 +1600,13 @@ void exfat_sync_sysroot(ExFat *fs, const char *sysroot_path)
     /* Read existing directory tree */
     ExFatNode *root = exfat_read_dir_tree(fs, fs->root_cluster);
 
-    int n_unchanged = 0, n_updated = 0, n_added = 0;
+    SyncStats stats;
+    memset(&stats, 0, sizeof(stats));
 
-    exfat_sync_dir(fs, sysroot_path, fs->root_cluster, root, "",
-                   &n_unchanged, &n_updated, &n_added);
+    exfat_sync_dir(fs, sysroot_path, fs->root_cluster, root, "", &stats);
 
-    printf("  exFAT sync: %d unchanged, %d updated, %d added\n",
-           n_unchanged, n_updated, n_added);
+    printf("  exFAT sync: %d unchanged (%d by timestamp), %d updated, %d added\n",
+           stats.unchanged, stats.skipped, stats.updated, stats.added);
 
     exfat_free_tree(root);
 }
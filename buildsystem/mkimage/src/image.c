@@ -0,0 +1,204 @@
+/*
+ * image.c — Disk image buffer with demand loading and dirty tracking
+ *
+ * A fresh image lives entirely in memory and is written out sparsely:
+ * all-zero chunks are skipped with fseek, so an empty 1 GiB data
+ * partition costs neither write time nor disk space.
+ *
+ * An existing image being updated is loaded one IMAGE_CHUNK at a time on
+ * first access, and only chunks whose content actually changed are
+ * written back. A no-op incremental build therefore reads the metadata
+ * it walks and writes nothing, independent of the image size.
+ *
+ * Written in C99 for TCC compatibility.
+ */
+#include "mkimage.h"
+
+#define CHUNK_LOADED 0x01
+#define CHUNK_DIRTY  0x02
+
+/* ── Setup ────────────────────────────────────────────────────────────── */
+
+static void image_alloc(Image *img, size_t size, uint8_t chunk_state) {
+    memset(img, 0, sizeof(Image));
+    img->size = size;
+    img->chunk_count = (size + IMAGE_CHUNK - 1) / IMAGE_CHUNK;
+    img->data = calloc(1, size ? size : 1);
+    img->state = malloc(img->chunk_count ? img->chunk_count : 1);
+    if (!img->data || !img->state)
+        fatal("out of memory for image (%zu bytes)", size);
+    memset(img->state, chunk_state, img->chunk_count);
+}
+
+/* Start a blank, fully resident image. */
+void image_create(Image *img, size_t size) {
+    image_alloc(img, size, CHUNK_LOADED);
+}
+
+/*
+ * Open an existing image for in-place update. Nothing is read yet.
+ * Returns 0 on success, -1 if the file cannot be opened read-write.
+ */
+int image_open(Image *img, const char *path, size_t size) {
+    FILE *fp = fopen(path, "r+b");
+    if (!fp) return -1;
+    image_alloc(img, size, 0);
+    img->fp = fp;
+    return 0;
+}
+
+void image_free(Image *img) {
+    if (img->fp) fclose(img->fp);
+    free(img->data);
+    free(img->state);
+    memset(img, 0, sizeof(Image));
+}
+
+/* ── Access ───────────────────────────────────────────────────────────── */
+
+/* Make sure chunks covering [off, off+len) hold the file contents. */
+static void image_load(Image *img, size_t off, size_t len) {
+    if (!img->fp || len == 0) return;
+    if (off + len > img->size)
+        fatal("image access out of range (%zu+%zu > %zu)", off, len, img->size);
+
+    size_t c = off / IMAGE_CHUNK;
+    size_t last = (off + len - 1) / IMAGE_CHUNK;
+    while (c <= last) {
+        if (img->state[c] & CHUNK_LOADED) {
+            c++;
+            continue;
+        }
+        /* Read the whole run of missing chunks in one go */
+        size_t run = c;
+        while (run <= last && !(img->state[run] & CHUNK_LOADED))
+            run++;
+        size_t start = c * IMAGE_CHUNK;
+        size_t end = run * IMAGE_CHUNK;
+        if (end > img->size) end = img->size;
+        if (fseek(img->fp, (long)start, SEEK_SET) != 0 ||
+            fread(img->data + start, 1, end - start, img->fp) != end - start)
+            fatal("short read on existing image at offset %zu", start);
+        img->bytes_read += end - start;
+        for (; c < run; c++)
+            img->state[c] |= CHUNK_LOADED;
+    }
+}
+
+/* Pointer to len bytes at off, valid until the image is freed. */
+const uint8_t *image_read(Image *img, size_t off, size_t len) {
+    image_load(img, off, len);
+    return img->data + off;
+}
+
+/*
+ * Store len bytes at off. In update mode a chunk only becomes dirty if
+ * its content really changes, so rewriting unchanged metadata is free.
+ */
+void image_put(Image *img, size_t off, const void *src, size_t len) {
+    if (!img->fp) {
+        if (off + len > img->size)
+            fatal("image write out of range (%zu+%zu > %zu)", off, len, img->size);
+        memcpy(img->data + off, src, len);
+        return;
+    }
+
+    const uint8_t *p = src;
+    while (len > 0) {
+        size_t c = off / IMAGE_CHUNK;
+        size_t n = IMAGE_CHUNK - off % IMAGE_CHUNK;
+        if (n > len) n = len;
+        image_load(img, off, n);
+        if (memcmp(img->data + off, p, n) != 0) {
+            memcpy(img->data + off, p, n);
+            img->state[c] |= CHUNK_DIRTY;
+        }
+        off += n;
+        p += n;
+        len -= n;
+    }
+}
+
+/* ── Output ───────────────────────────────────────────────────────────── */
+
+static int chunk_is_zero(const uint8_t *p, size_t len) {
+    size_t i;
+    for (i = 0; i < len; i++)
+        if (p[i]) return 0;
+    return 1;
+}
+
+/*
+ * Write a whole buffer to path, seeking over all-zero chunks so the file
+ * comes out sparse where the host filesystem supports holes.
+ */
+void write_sparse(const char *path, const uint8_t *data, size_t size) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) fatal("cannot create '%s'", path);
+
+    size_t off = 0;
+    size_t written = 0;
+    int pending_seek = 0;
+    while (off < size) {
+        size_t n = size - off < IMAGE_CHUNK ? size - off : IMAGE_CHUNK;
+        if (chunk_is_zero(data + off, n)) {
+            pending_seek = 1;
+        } else {
+            if (pending_seek && fseek(fp, (long)off, SEEK_SET) != 0)
+                fatal("seek failed on '%s'", path);
+            pending_seek = 0;
+            if (fwrite(data + off, 1, n, fp) != n)
+                fatal("write failed on '%s'", path);
+            written += n;
+        }
+        off += n;
+    }
+    /* A trailing hole still has to extend the file to its full size */
+    if (pending_seek) {
+        if (fseek(fp, (long)(size - 1), SEEK_SET) != 0 || fputc(0, fp) == EOF)
+            fatal("write failed on '%s'", path);
+    }
+    if (fclose(fp) != 0)
+        fatal("write failed on '%s'", path);
+
+    printf("  Wrote %zu KiB of %zu KiB (rest sparse)\n",
+           written / 1024, size / 1024);
+}
+
+/*
+ * Save the image: a fresh one is written sparsely to path, an updated
+ * one gets its dirty chunks written back in place.
+ */
+void image_save(Image *img, const char *path) {
+    if (!img->fp) {
+        write_sparse(path, img->data, img->size);
+        return;
+    }
+
+    size_t c = 0;
+    size_t runs = 0;
+    while (c < img->chunk_count) {
+        if (!(img->state[c] & CHUNK_DIRTY)) {
+            c++;
+            continue;
+        }
+        size_t run = c;
+        while (run < img->chunk_count && (img->state[run] & CHUNK_DIRTY))
+            img->state[run++] &= (uint8_t)~CHUNK_DIRTY;
+        size_t start = c * IMAGE_CHUNK;
+        size_t end = run * IMAGE_CHUNK;
+        if (end > img->size) end = img->size;
+        if (fseek(img->fp, (long)start, SEEK_SET) != 0 ||
+            fwrite(img->data + start, 1, end - start, img->fp) != end - start)
+            fatal("write failed on '%s'", path);
+        img->bytes_written += end - start;
+        runs++;
+        c = run;
+    }
+    if (fflush(img->fp) != 0)
+        fatal("write failed on '%s'", path);
+
+    printf("  Read %zu KiB, wrote %zu KiB in %zu run(s) of %zu KiB image\n",
+           img->bytes_read / 1024, img->bytes_written / 1024, runs,
+           img->size / 1024);
+}
@@ -1028,14 +1028,7 @@ void create_iso_image(const Args *args)
     }
 
     /* ── Write output image ──────────────────────────────────────────────── */
-    {
-        FILE *fp = fopen(args->output, "wb");
-        if (!fp)
-            fatal("Cannot open output file: %s", args->output);
-        if (fwrite(image, 1, image_size, fp) != image_size)
-            fatal("Failed to write ISO image to %s", args->output);
-        fclose(fp);
-    }
+    write_sparse(args->output, image, image_size);
 
     {
         double iso_size_mb = (double)image_size / (1024.0 * 1024.0);
@@ -17,8 +17,14 @@
 #include "mkimage.h"
 #include <time.h>
 
+#ifdef MKIMAGE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #ifdef ONE_SOURCE
 /* Single-source compilation mode (for TCC on anyOS) */
+#include "image.c"
 #include "elf.c"
 #include "fat16.c"
 #include "exfat.c"
@@ -140,6 +146,152 @@ uint64_t read_le64(const uint8_t *p) {
     return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
 }
 
+/* ── Parallel loop ────────────────────────────────────────────────────── */
+
+#ifdef MKIMAGE_THREADS
+typedef struct {
+    void          (*fn)(void *arg, int i);
+    void           *arg;
+    int             n;
+    int             next;   /* Next unclaimed index, guarded by lock */
+    pthread_mutex_t lock;
+} ParJob;
+
+static void *parallel_worker(void *p) {
+    ParJob *job = p;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        int i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (i >= job->n) return NULL;
+        job->fn(job->arg, i);
+    }
+}
+#endif
+
+/* Run fn(arg, 0..n-1) on up to `jobs` threads; serial without MKIMAGE_THREADS. */
+void parallel_for(int jobs, int n, void (*fn)(void *arg, int i), void *arg) {
+#ifdef MKIMAGE_THREADS
+    int nthreads = jobs < n ? jobs : n;
+    if (nthreads > 1) {
+        ParJob job;
+        job.fn = fn;
+        job.arg = arg;
+        job.n = n;
+        job.next = 0;
+        pthread_mutex_init(&job.lock, NULL);
+
+        /* The calling thread works too */
+        pthread_t tids[64];
+        if (nthreads > 64) nthreads = 64;
+        int started = 0;
+        for (int t = 1; t < nthreads; t++) {
+            if (pthread_create(&tids[started], NULL, parallel_worker, &job) != 0)
+                break;
+            started++;
+        }
+        parallel_worker(&job);
+        for (int t = 0; t < started; t++)
+            pthread_join(tids[t], NULL);
+        pthread_mutex_destroy(&job.lock);
+        return;
+    }
+#else
+    (void)jobs;
+#endif
+    for (int i = 0; i < n; i++)
+        fn(arg, i);
+}
+
+/* Default worker count: one per online CPU, at most 16. */
+int default_jobs(void) {
+#ifdef MKIMAGE_THREADS
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 16) n = 16;
+    return n > 0 ? (int)n : 1;
+#else
+    return 1;
+#endif
+}
+
+/* ── Output image ─────────────────────────────────────────────────────── */
+
+/*
+ * Open the output image. An existing image of the same size is updated in
+ * place (not with --reset, or without a sysroot to sync); otherwise a
+ * blank image is started. Returns 1 for an incremental update.
+ */
+static int open_output_image(const Args *args, Image *img, size_t image_size) {
+    if (!args->reset && args->sysroot) {
+        FILE *f = fopen(args->output, "rb");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            long existing_size = ftell(f);
+            fclose(f);
+            if (existing_size > 0 && (size_t)existing_size == image_size) {
+                if (image_open(img, args->output, image_size) != 0)
+                    fatal("cannot open existing image '%s'", args->output);
+                printf("\nIncremental update mode (use --reset for full rebuild)\n");
+                return 1;
+            }
+        }
+    }
+
+    image_create(img, image_size);
+    if (args->reset)
+        printf("\nFull rebuild (--reset)\n");
+    return 0;
+}
+
+/*
+ * Partition tables and the ESP are regenerated on every run by code that
+ * writes into a flat buffer. A blank image is that buffer; an update
+ * builds them in a blank scratch copy and merges the regions back with
+ * image_put(), so only chunks that actually changed are written.
+ */
+static uint8_t *layout_begin(Image *img) {
+    if (!img->fp) return img->data;
+    uint8_t *buf = calloc(1, img->size);
+    if (!buf) fatal("out of memory for image (%zu bytes)", img->size);
+    return buf;
+}
+
+static void layout_merge(Image *img, const uint8_t *buf, size_t off, size_t len) {
+    if (buf != img->data)
+        image_put(img, off, buf + off, len);
+}
+
+static void layout_end(Image *img, uint8_t *buf) {
+    if (buf != img->data) free(buf);
+}
+
+/* Populate or sync the exFAT data partition at fs_start. */
+static void build_data_fs(const Args *args, Image *img, int incremental,
+                          uint32_t fs_start, uint32_t fs_sectors) {
+    ExFat exfat;
+    if (incremental) {
+        /* Incremental: open existing FS, sync sysroot */
+        exfat_open_existing(&exfat, img, fs_start);
+        exfat.jobs = args->jobs;
+        if (args->sysroot) {
+            exfat_sync_sysroot(&exfat, args->sysroot);
+        }
+    } else {
+        /* Full rebuild: format + populate */
+        exfat_init(&exfat, img, fs_start, fs_sectors, 8);
+        exfat.jobs = args->jobs;
+        exfat_write_boot(&exfat);
+        exfat_init_fs(&exfat);
+
+        if (args->sysroot) {
+            printf("  Populating from sysroot: %s\n", args->sysroot);
+            exfat_populate_sysroot(&exfat, args->sysroot);
+        }
+    }
+    exfat_flush(&exfat);
+    exfat_free(&exfat);
+}
+
 /* ── BIOS image creation ──────────────────────────────────────────────── */
 
 void create_bios_image(const Args *args) {
@@ -186,39 +338,12 @@ void create_bios_image(const Args *args) {
 
     /* Create or load image */
     size_t image_size = (size_t)args->image_size * 1024 * 1024;
-    int incremental = 0;
-    uint8_t *image = NULL;
-
-    /* Check for incremental update: existing image of same size, not --reset */
-    if (!args->reset && args->sysroot) {
-        FILE *f = fopen(args->output, "rb");
-        if (f) {
-            fseek(f, 0, SEEK_END);
-            long existing_size = ftell(f);
-            fclose(f);
-            if (existing_size > 0 && (size_t)existing_size == image_size) {
-                incremental = 1;
-            }
-        }
-    }
-
-    if (incremental) {
-        /* Load existing image for incremental update */
-        size_t dummy;
-        image = read_file(args->output, &dummy);
-        if (!image) fatal("cannot read existing image '%s'", args->output);
-        printf("\nIncremental update mode (use --reset for full rebuild)\n");
-    } else {
-        image = calloc(1, image_size);
-        if (!image) fatal("out of memory for image (%zu bytes)", image_size);
-        if (args->reset)
-            printf("\nFull rebuild (--reset)\n");
-    }
+    Image img;
+    int incremental = open_output_image(args, &img, image_size);
 
     /* Always write boot sectors + kernel (even in incremental mode) */
-    memcpy(image, s1, s1_size);
-    memcpy(image + SECTOR_SIZE, s2, s2_size);
-    memcpy(image + (size_t)kernel_start * SECTOR_SIZE, kernel, flat_size);
+    image_put(&img, SECTOR_SIZE, s2, s2_size);
+    image_put(&img, (size_t)kernel_start * SECTOR_SIZE, kernel, flat_size);
 
     /* Write MBR partition table (bytes 446-509 of sector 0).
      * Stage 1 bootloader code occupies bytes 0-~106, so this is safe.
@@ -227,7 +352,7 @@ void create_bios_image(const Args *args) {
     {
         uint32_t part_sectors = (uint32_t)(image_size / SECTOR_SIZE)
                                 - (uint32_t)args->fs_start;
-        uint8_t *entry = image + 446;
+        uint8_t *entry = s1 + 446;
         memset(entry, 0, 64);  /* zero all 4 partition entries */
 
         /* Entry 1: data partition (exFAT) */
@@ -239,6 +364,7 @@ void create_bios_image(const Args *args) {
         entry[5] = 0xFE; entry[6] = 0xFF; entry[7] = 0xFF;
         write_le32(entry + 8, (uint32_t)args->fs_start);
         write_le32(entry + 12, part_sectors);
+        image_put(&img, 0, s1, s1_size);
 
         printf("\nMBR partition table:\n");
         printf("  Partition 1: type=0x07 (exFAT) start=%d sectors=%u\n",
@@ -255,37 +381,11 @@ void create_bios_image(const Args *args) {
     printf("  Size: %u sectors (%u MiB)\n",
            fs_sectors, fs_sectors * SECTOR_SIZE / (1024 * 1024));
 
-    if (incremental) {
-        /* Incremental: open existing FS, sync sysroot */
-        ExFat exfat;
-        exfat_open_existing(&exfat, image, (uint32_t)args->fs_start);
-        if (args->sysroot) {
-            exfat_sync_sysroot(&exfat, args->sysroot);
-        }
-        exfat_flush(&exfat);
-        exfat_free(&exfat);
-    } else {
-        /* Full rebuild: format + populate */
-        ExFat exfat;
-        exfat_init(&exfat, image, (uint32_t)args->fs_start, fs_sectors, 8);
-        exfat_write_boot(&exfat);
-        exfat_init_fs(&exfat);
-
-        if (args->sysroot) {
-            printf("  Populating from sysroot: %s\n", args->sysroot);
-            exfat_populate_sysroot(&exfat, args->sysroot);
-        }
-
-        exfat_flush(&exfat);
-        exfat_free(&exfat);
-    }
+    build_data_fs(args, &img, incremental, (uint32_t)args->fs_start, fs_sectors);
 
     /* Write image */
-    FILE *fp = fopen(args->output, "wb");
-    if (!fp) fatal("cannot create '%s'", args->output);
-    fwrite(image, 1, image_size, fp);
-    fclose(fp);
-    free(image);
+    image_save(&img, args->output);
+    image_free(&img);
 
     printf("\nDisk image %s: %s (%d MiB)\n",
            incremental ? "updated" : "created", args->output, args->image_size);
@@ -342,33 +442,9 @@ void create_uefi_image(const Args *args) {
            (unsigned long long)(data_sectors * 512 / (1024 * 1024)));
 
     /* Create or load image */
-    int incremental = 0;
-    uint8_t *image = NULL;
-
-    /* Check for incremental update */
-    if (!args->reset && args->sysroot) {
-        FILE *f = fopen(args->output, "rb");
-        if (f) {
-            fseek(f, 0, SEEK_END);
-            long existing_size = ftell(f);
-            fclose(f);
-            if (existing_size > 0 && (size_t)existing_size == image_size) {
-                incremental = 1;
-            }
-        }
-    }
-
-    if (incremental) {
-        size_t dummy;
-        image = read_file(args->output, &dummy);
-        if (!image) fatal("cannot read existing image '%s'", args->output);
-        printf("\nIncremental update mode (use --reset for full rebuild)\n");
-    } else {
-        image = calloc(1, image_size);
-        if (!image) fatal("out of memory for image (%zu bytes)", image_size);
-        if (args->reset)
-            printf("\nFull rebuild (--reset)\n");
-    }
+    Image img;
+    int incremental = open_output_image(args, &img, image_size);
+    uint8_t *image = layout_begin(&img);
 
     /* Always write GPT + ESP (boot sectors change with kernel updates) */
     write_protective_mbr(image, total_sectors);
@@ -410,43 +486,24 @@ void create_uefi_image(const Args *args) {
 
     free(efi_data);
 
+    /* MBR + primary GPT, ESP, backup GPT */
+    layout_merge(&img, image, 0, (size_t)(1 + 1 + entry_sectors) * SECTOR_SIZE);
+    layout_merge(&img, image, (size_t)esp_start * SECTOR_SIZE,
+                 (size_t)esp_sectors * SECTOR_SIZE);
+    layout_merge(&img, image, (size_t)(data_end + 1) * SECTOR_SIZE,
+                 image_size - (size_t)(data_end + 1) * SECTOR_SIZE);
+    layout_end(&img, image);
+
     /* Data partition as exFAT */
     printf("\nData filesystem (exFAT):\n");
-
-    if (incremental) {
-        /* Incremental: open existing FS, sync sysroot */
-        ExFat data_exfat;
-        exfat_open_existing(&data_exfat, image, (uint32_t)data_start);
-        if (args->sysroot) {
-            exfat_sync_sysroot(&data_exfat, args->sysroot);
-        }
-        exfat_flush(&data_exfat);
-        exfat_free(&data_exfat);
-    } else {
-        /* Full rebuild: format + populate */
-        ExFat data_exfat;
-        exfat_init(&data_exfat, image, (uint32_t)data_start,
-                   (uint32_t)data_sectors, 8);
-        exfat_write_boot(&data_exfat);
-        exfat_init_fs(&data_exfat);
-
-        if (args->sysroot) {
-            printf("  Populating from sysroot: %s\n", args->sysroot);
-            exfat_populate_sysroot(&data_exfat, args->sysroot);
-        }
-
-        exfat_flush(&data_exfat);
-        exfat_free(&data_exfat);
-    }
+    build_data_fs(args, &img, incremental, (uint32_t)data_start,
+                  (uint32_t)data_sectors);
 
     if (kernel_flat) free(kernel_flat);
 
     /* Write image */
-    FILE *fp = fopen(args->output, "wb");
-    if (!fp) fatal("cannot create '%s'", args->output);
-    fwrite(image, 1, image_size, fp);
-    fclose(fp);
-    free(image);
+    image_save(&img, args->output);
+    image_free(&img);
 
     printf("\nUEFI disk image %s: %s (%d MiB)\n",
            incremental ? "updated" : "created", args->output, args->image_size);
@@ -486,32 +543,9 @@ void create_arm64_image(const Args *args) {
            (unsigned long long)(data_sectors * 512 / (1024 * 1024)));
 
     /* Create or load image */
-    int incremental = 0;
-    uint8_t *image = NULL;
-
-    if (!args->reset && args->sysroot) {
-        FILE *f = fopen(args->output, "rb");
-        if (f) {
-            fseek(f, 0, SEEK_END);
-            long existing_size = ftell(f);
-            fclose(f);
-            if (existing_size > 0 && (size_t)existing_size == image_size) {
-                incremental = 1;
-            }
-        }
-    }
-
-    if (incremental) {
-        size_t dummy;
-        image = read_file(args->output, &dummy);
-        if (!image) fatal("cannot read existing image '%s'", args->output);
-        printf("\nIncremental update mode (use --reset for full rebuild)\n");
-    } else {
-        image = calloc(1, image_size);
-        if (!image) fatal("out of memory for image (%zu bytes)", image_size);
-        if (args->reset)
-            printf("\nFull rebuild (--reset)\n");
-    }
+    Image img;
+    int incremental = open_output_image(args, &img, image_size);
+    uint8_t *image = layout_begin(&img);
 
     /* Write protective MBR + GPT */
     write_protective_mbr(image, total_sectors);
@@ -525,39 +559,19 @@ void create_arm64_image(const Args *args) {
 
     create_gpt(image, total_sectors, parts, 1);
 
+    layout_merge(&img, image, 0, (size_t)(1 + 1 + entry_sectors) * SECTOR_SIZE);
+    layout_merge(&img, image, (size_t)(data_end + 1) * SECTOR_SIZE,
+                 image_size - (size_t)(data_end + 1) * SECTOR_SIZE);
+    layout_end(&img, image);
+
     /* exFAT data partition */
     printf("\nData filesystem (exFAT):\n");
-
-    if (incremental) {
-        ExFat data_exfat;
-        exfat_open_existing(&data_exfat, image, (uint32_t)data_start);
-        if (args->sysroot) {
-            exfat_sync_sysroot(&data_exfat, args->sysroot);
-        }
-        exfat_flush(&data_exfat);
-        exfat_free(&data_exfat);
-    } else {
-        ExFat data_exfat;
-        exfat_init(&data_exfat, image, (uint32_t)data_start,
-                   (uint32_t)data_sectors, 8);
-        exfat_write_boot(&data_exfat);
-        exfat_init_fs(&data_exfat);
-
-        if (args->sysroot) {
-            printf("  Populating from sysroot: %s\n", args->sysroot);
-            exfat_populate_sysroot(&data_exfat, args->sysroot);
-        }
-
-        exfat_flush(&data_exfat);
-        exfat_free(&data_exfat);
-    }
+    build_data_fs(args, &img, incremental, (uint32_t)data_start,
+                  (uint32_t)data_sectors);
 
     /* Write image */
-    FILE *fp = fopen(args->output, "wb");
-    if (!fp) fatal("cannot create '%s'", args->output);
-    fwrite(image, 1, image_size, fp);
-    fclose(fp);
-    free(image);
+    image_save(&img, args->output);
+    image_free(&img);
 
     printf("\nARM64 disk image %s: %s (%d MiB)\n",
            incremental ? "updated" : "created", args->output, args->image_size);
@@ -588,6 +602,7 @@ static void usage(void) {
         "\n"
         "Options:\n"
         "  --reset   Force full image rebuild (default: incremental update)\n"
+        "  -j N      Threads for reading sysroot files (default: one per CPU)\n"
     );
     exit(1);
 }
@@ -598,6 +613,7 @@ static int parse_args(int argc, char **argv, Args *args) {
     memset(args, 0, sizeof(*args));
     args->image_size = 64;
     args->fs_start = 8192;
+    args->jobs = default_jobs();
 
     int i = 1;
     while (i < argc) {
@@ -625,6 +641,9 @@ static int parse_args(int argc, char **argv, Args *args) {
             args->fs_start = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--reset") == 0) {
             args->reset = 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            args->jobs = atoi(argv[++i]);
+            if (args->jobs < 1) args->jobs = 1;
         } else if (strcmp(argv[i], "-h") == 0 ||
                    strcmp(argv[i], "--help") == 0) {
             usage();
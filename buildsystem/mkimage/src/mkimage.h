@@ -102,8 +102,23 @@ typedef struct {
     int         image_size; /* MiB */
     int         fs_start;   /* sector */
     int         reset;      /* 1 = force full rebuild, 0 = incremental if possible */
+    int         jobs;       /* worker threads for reading sysroot files */
 } Args;
 
+/* ── Disk image buffer ────────────────────────────────────────────────── */
+
+#define IMAGE_CHUNK   (64 * 1024)   /* unit of demand loading and write-back */
+
+typedef struct {
+    uint8_t *data;          /* whole image; in update mode filled on demand */
+    size_t   size;
+    FILE    *fp;            /* existing image being updated, or NULL */
+    uint8_t *state;         /* per chunk: loaded / dirty flags */
+    size_t   chunk_count;
+    size_t   bytes_read;
+    size_t   bytes_written;
+} Image;
+
 /* ── FAT16 formatter state ────────────────────────────────────────────── */
 
 typedef struct {
@@ -127,7 +142,7 @@ typedef struct {
 /* ── exFAT formatter state ────────────────────────────────────────────── */
 
 typedef struct {
-    uint8_t *image;
+    Image   *img;
     uint32_t fs_start;
     uint32_t fs_sectors;
     uint32_t spc;           /* sectors per cluster */
@@ -142,6 +157,7 @@ typedef struct {
     uint8_t *fat_cache;     /* in-memory FAT */
     uint8_t *bitmap;        /* in-memory allocation bitmap */
     uint32_t bitmap_bytes;
+    int      jobs;          /* worker threads for reading host files */
 } ExFat;
 
 /* ── Short name collision tracker ─────────────────────────────────────── */
@@ -162,6 +178,18 @@ void     write_be32(uint8_t *p, uint32_t v);
 uint16_t read_le16(const uint8_t *p);
 uint32_t read_le32(const uint8_t *p);
 uint64_t read_le64(const uint8_t *p);
+void     parallel_for(int jobs, int n, void (*fn)(void *arg, int i), void *arg);
+int      default_jobs(void);
+
+/* ── Image buffer functions (image.c) ─────────────────────────────────── */
+
+void           image_create(Image *img, size_t size);
+int            image_open(Image *img, const char *path, size_t size);
+const uint8_t *image_read(Image *img, size_t off, size_t len);
+void           image_put(Image *img, size_t off, const void *src, size_t len);
+void           image_save(Image *img, const char *path);
+void           image_free(Image *img);
+void           write_sparse(const char *path, const uint8_t *data, size_t size);
 
 /* ── ELF functions (elf.c) ────────────────────────────────────────────── */
 
@@ -189,6 +217,8 @@ typedef struct ExFatNode {
     uint32_t      first_cluster;
     uint64_t      data_length;
     uint16_t      uid, gid, mode;  /* VFS permissions */
+    uint32_t      mtime;           /* LastModified timestamp, 0 = unknown */
+    uint8_t       mtime_10ms;      /* LastModified10msIncrement */
     int           contiguous;      /* EXFAT_FLAG_CONTIGUOUS set */
     uint32_t      dir_cluster;     /* cluster of parent dir containing this entry */
     uint32_t      entry_offset;    /* byte offset of entry set in dir cluster chain */
@@ -202,7 +232,7 @@ typedef struct ExFatNode {
 /* ── exFAT functions (exfat.c) ────────────────────────────────────────── */
 
 /* Format + populate (full rebuild) */
-void     exfat_init(ExFat *fs, uint8_t *image, uint32_t fs_start,
+void     exfat_init(ExFat *fs, Image *img, uint32_t fs_start,
                     uint32_t fs_sectors, uint32_t spc);
 void     exfat_write_boot(ExFat *fs);
 void     exfat_init_fs(ExFat *fs);
@@ -210,13 +240,14 @@ uint32_t exfat_create_dir(ExFat *fs, uint32_t parent, const char *name,
                           uint16_t uid, uint16_t gid, uint16_t mode);
 void     exfat_add_file(ExFat *fs, uint32_t parent, const char *name,
                         const uint8_t *data, size_t size,
-                        uint16_t uid, uint16_t gid, uint16_t mode);
+                        uint16_t uid, uint16_t gid, uint16_t mode,
+                        int64_t mtime);
 void     exfat_populate_sysroot(ExFat *fs, const char *sysroot_path);
 void     exfat_flush(ExFat *fs);
 void     exfat_free(ExFat *fs);
 
 /* Incremental update */
-void       exfat_open_existing(ExFat *fs, uint8_t *image, uint32_t fs_start);
+void       exfat_open_existing(ExFat *fs, Image *img, uint32_t fs_start);
 ExFatNode *exfat_read_dir_tree(ExFat *fs, uint32_t dir_cluster);
 ExFatNode *exfat_find_child(ExFatNode *parent, const char *name);
 int        exfat_file_matches(ExFat *fs, ExFatNode *node,
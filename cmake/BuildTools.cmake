@@ -33,8 +33,9 @@ file(GLOB MKIMAGE_SRCS "${BUILDSYSTEM_DIR}/mkimage/src/*.c" "${BUILDSYSTEM_DIR}/
 add_custom_command(
   OUTPUT ${MKIMAGE_EXECUTABLE}
   COMMAND ${CMAKE_COMMAND} -E make_directory "${CMAKE_BINARY_DIR}/buildsystem"
-  COMMAND cc -w -O2 -std=c99 ${POSIX_FLAG} -o ${MKIMAGE_EXECUTABLE}
+  COMMAND cc -w -O2 -std=c99 ${POSIX_FLAG} -DMKIMAGE_THREADS -pthread -o ${MKIMAGE_EXECUTABLE}
     ${BUILDSYSTEM_DIR}/mkimage/src/mkimage.c
+    ${BUILDSYSTEM_DIR}/mkimage/src/image.c
     ${BUILDSYSTEM_DIR}/mkimage/src/elf.c
     ${BUILDSYSTEM_DIR}/mkimage/src/fat16.c
     ${BUILDSYSTEM_DIR}/mkimage/src/exfat.c
@@ -50,7 +51,7 @@ file(GLOB ANYLD_SRCS "${BUILDSYSTEM_DIR}/anyld/src/*.c" "${BUILDSYSTEM_DIR}/anyl
 add_custom_command(
   OUTPUT ${ANYLD_EXECUTABLE}
   COMMAND ${CMAKE_COMMAND} -E make_directory "${CMAKE_BINARY_DIR}/buildsystem"
-  COMMAND cc -w -O2 -std=c99 ${POSIX_FLAG} -o ${ANYLD_EXECUTABLE}
+  COMMAND cc -w -O2 -std=c99 ${POSIX_FLAG} -DANYLD_THREADS -pthread -o ${ANYLD_EXECUTABLE}
     ${BUILDSYSTEM_DIR}/anyld/src/anyld.c
     ${BUILDSYSTEM_DIR}/anyld/src/input.c
     ${BUILDSYSTEM_DIR}/anyld/src/link.c
@@ -75,9 +75,17 @@ add_custom_command(
 # ============================================================
 # 4. Kernel (Cargo build)
 # ============================================================
-set(CARGO_FEATURES_ARG "")
+set(KERNEL_FEATURES "")
 if(ANYOS_DEBUG_VERBOSE)
-  set(CARGO_FEATURES_ARG "--features;debug_verbose")
+  list(APPEND KERNEL_FEATURES "debug_verbose")
+endif()
+if(ANYOS_LOCK_PROFILE)
+  list(APPEND KERNEL_FEATURES "lock_profile")
+endif()
+set(CARGO_FEATURES_ARG "")
+if(KERNEL_FEATURES)
+  list(JOIN KERNEL_FEATURES "," KERNEL_FEATURES_CSV)
+  set(CARGO_FEATURES_ARG "--features;${KERNEL_FEATURES_CSV}")
 endif()
 
 # Collect all kernel .rs source files so CMake re-invokes Cargo when any change.
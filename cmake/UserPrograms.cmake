@@ -236,6 +236,8 @@ endfunction()
 # DLLs use custom link.ld scripts, so they share their own target dir
 # (separate from user programs to avoid linker script conflicts).
 set(DLL_TARGET_DIR "${CMAKE_BINARY_DIR}/dll-target")
+# Shared inflate core linked into libimage, libzip, libfont and libhttp
+file(GLOB_RECURSE _LIBINFLATE_RS CONFIGURE_DEPENDS "${CMAKE_SOURCE_DIR}/libs/libinflate/src/*.rs")
 function(add_dll NAME SRC_DIR)
   set(DLL_ELF "${DLL_TARGET_DIR}/${USER_TARGET_TRIPLE}/release/${NAME}.elf")
   file(GLOB_RECURSE _DLL_RS CONFIGURE_DEPENDS "${SRC_DIR}/src/*.rs")
@@ -250,6 +252,7 @@ function(add_dll NAME SRC_DIR)
       ${SRC_DIR}/Cargo.toml
       ${SRC_DIR}/build.rs
       ${_DLL_RS}
+      ${_LIBINFLATE_RS}
       ${SRC_DIR}/link.ld
       ${USER_TARGET_JSON}
     WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
@@ -310,8 +313,18 @@ add_dll(libcompositor ${CMAKE_SOURCE_DIR}/libs/libcompositor)
 
 # Shared libraries (.so) — built via Cargo -> .a -> anyld -> ET_DYN .so
 # These use -Z build-std so they share a separate target dir from user programs.
+# PRELINK <base> <end> links the library at a fixed slot below the kernel's
+# dynamic load area (0x05000000), so loading it needs no relocation pass;
+# anyld fails the build if the image outgrows its slot.
 set(SHLIB_TARGET_DIR "${CMAKE_BINARY_DIR}/shlib-target")
 function(add_shared_lib NAME SRC_DIR)
+  cmake_parse_arguments(_SL "" "" "PRELINK" ${ARGN})
+  set(_SL_BASE_ARGS "")
+  if(_SL_PRELINK)
+    list(GET _SL_PRELINK 0 _SL_BASE)
+    list(GET _SL_PRELINK 1 _SL_END)
+    set(_SL_BASE_ARGS -b ${_SL_BASE} -l ${_SL_END})
+  endif()
   set(LIB_A "${SHLIB_TARGET_DIR}/${USER_TARGET_TRIPLE}/release/lib${NAME}.a")
   set(LIB_SO "${CMAKE_BINARY_DIR}/shlib/${NAME}.so")
   file(GLOB_RECURSE _SL_RS CONFIGURE_DEPENDS "${SRC_DIR}/src/*.rs")
@@ -327,14 +340,17 @@ function(add_shared_lib NAME SRC_DIR)
     DEPENDS
       ${SRC_DIR}/Cargo.toml
       ${_SL_RS}
+      ${_LIBINFLATE_RS}
       ${USER_TARGET_JSON}
     WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
     COMMENT "Building shared library: ${NAME} (Cargo)"
   )
-  # Step 2: anyld -> .so (ET_DYN shared object, base=0 for dynamic loading)
+  # Step 2: anyld -> .so (ET_DYN shared object, base=0 for dynamic loading
+  # unless prelinked)
   add_custom_command(
     OUTPUT ${LIB_SO}
     COMMAND ${ANYLD_EXECUTABLE} -q
+      ${_SL_BASE_ARGS}
       -o ${LIB_SO}
       -e ${SRC_DIR}/exports.def
       ${LIB_A}
@@ -351,11 +367,13 @@ function(add_shared_lib NAME SRC_DIR)
   set(DLL_BINS ${DLL_BINS} ${SYSROOT_DIR}/Libraries/${NAME}.so PARENT_SCOPE)
 endfunction()
 
-add_shared_lib(libanyui ${CMAKE_SOURCE_DIR}/libs/libanyui)
+# Every GUI app maps libanyui and libsvg: prelink them. libfont is mostly
+# embedded font data with few relocations and stays dynamic.
+add_shared_lib(libanyui ${CMAKE_SOURCE_DIR}/libs/libanyui PRELINK 0x04400000 0x04F00000)
 add_shared_lib(libfont ${CMAKE_SOURCE_DIR}/libs/libfont)
 add_shared_lib(libdb ${CMAKE_SOURCE_DIR}/libs/libdb)
 add_shared_lib(libzip ${CMAKE_SOURCE_DIR}/libs/libzip)
-add_shared_lib(libsvg ${CMAKE_SOURCE_DIR}/libs/libsvg)
+add_shared_lib(libsvg ${CMAKE_SOURCE_DIR}/libs/libsvg PRELINK 0x04F00000 0x05000000)
 add_shared_lib(libgl ${CMAKE_SOURCE_DIR}/libs/libgl)
 add_shared_lib(libm ${CMAKE_SOURCE_DIR}/libs/libm)
 if(NOT ANYOS_ARCH STREQUAL "arm64")
@@ -373,6 +391,7 @@ if(NOT ANYOS_ARCH STREQUAL "arm64")
   set(_LIBHTTP_SO "${CMAKE_BINARY_DIR}/shlib/libhttp.so")
   set(_BEARSSL_X64_A "${CMAKE_SOURCE_DIR}/third_party/bearssl/build_x64/libbearssl_x64.a")
   file(GLOB_RECURSE _LIBHTTP_RS CONFIGURE_DEPENDS "${_LIBHTTP_SRC}/src/*.rs")
+  file(GLOB_RECURSE _LIBHTTPCACHE_RS CONFIGURE_DEPENDS "${CMAKE_SOURCE_DIR}/libs/libhttpcache/src/*.rs")
 
   # Step 1: Cargo → static archive (.a)
   add_custom_command(
@@ -386,6 +405,8 @@ if(NOT ANYOS_ARCH STREQUAL "arm64")
     DEPENDS
       ${_LIBHTTP_SRC}/Cargo.toml
       ${_LIBHTTP_RS}
+      ${_LIBHTTPCACHE_RS}
+      ${_LIBINFLATE_RS}
       ${USER_TARGET_JSON}
     WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
     COMMENT "Building shared library: libhttp (Cargo)"
@@ -444,10 +465,13 @@ add_rust_user_program(echo)
 add_rust_user_program(ps)
 add_rust_user_program(top)
 add_rust_user_program(htop)
+add_rust_user_program(syscount)
+add_rust_user_program(dbbench)
 add_rust_user_program(kill)
 add_rust_user_program(killall)
 add_rust_user_program(nice)
 add_rust_user_program(free)
+add_rust_user_program(irqstat)
 add_rust_user_program(uptime)
 add_rust_user_program(uname)
 add_rust_user_program(pwd)
@@ -491,6 +515,7 @@ add_rust_user_program(logd)
 add_rust_user_program(ami)
 add_rust_user_program(vi)
 add_rust_user_program(crond)
+add_rust_user_program(preloadd)
 add_rust_user_program(crontab)
 add_rust_user_program(sed)
 add_rust_user_program(xargs)
@@ -57,6 +57,11 @@
 #define SYS_TICK_HZ         34
 #define SYS_UPTIME_MS       35
 
+/* ---- Readiness wait sets ---- */
+#define SYS_POLL_CREATE     37
+#define SYS_POLL_CTL        38
+#define SYS_POLL_WAIT       39
+
 /* ---- Networking (general) ---- */
 #define SYS_NET_CONFIG      40
 #define SYS_NET_PING        41
@@ -123,6 +128,7 @@
 #define SYS_FSTAT          106
 #define SYS_FTRUNCATE      107
 #define SYS_ISATTY         108
+#define SYS_FSYNC          109
 
 /* ---- Display (resolution) ---- */
 #define SYS_SET_RESOLUTION  110
@@ -175,6 +181,9 @@
 #define SYS_THREAD_CREATE  170
 #define SYS_SET_PRIORITY   171
 #define SYS_SET_CRITICAL   172
+#define SYS_FUTEX_WAIT     173
+#define SYS_FUTEX_WAKE     174
+#define SYS_SLEEP_NS       175
 
 /* ---- Pipe listing ---- */
 #define SYS_PIPE_LIST      180
@@ -263,5 +272,7 @@
 #define SYS_GPU_3D_SYNC            514
 #define SYS_GPU_3D_SURFACE_DMA     515
 #define SYS_GPU_3D_SURFACE_DMA_READ 516
+#define SYS_GPU_3D_GMR_CREATE      517
+#define SYS_GPU_3D_GMR_RELEASE     518
 
 #endif /* _SYS_SYSCALL_H */
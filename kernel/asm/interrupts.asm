@@ -77,7 +77,7 @@ ISR_NOERRCODE 30    ; Reserved
 ISR_NOERRCODE 31    ; Reserved
 
 ; =============================================================================
-; IRQ stubs - Hardware Interrupts (INT 32-55)
+; IRQ stubs - Hardware Interrupts (INT 32-95)
 ; =============================================================================
 %macro IRQ 2
 global irq%1
@@ -111,9 +111,31 @@ IRQ 18, 50      ; Reserved
 IRQ 19, 51      ; Reserved
 IRQ 20, 52      ; IPI: TLB shootdown
 IRQ 21, 53      ; IPI: Halt
-IRQ 22, 54      ; Reserved
+IRQ 22, 54      ; IPI: Timer restart
 IRQ 23, 55      ; LAPIC Spurious
 
+; MSI / MSI-X vectors (INT 56-95), allocated by arch::x86::irq::alloc_irq
+%assign i 24
+%rep 40
+global irq %+ i
+irq %+ i:
+    push qword 0            ; Dummy error code
+    push qword i+32         ; Interrupt number (32 + IRQ#)
+    jmp irq_common_stub
+%assign i i+1
+%endrep
+
+; Stub addresses of the MSI vectors, for the IDT setup
+section .rodata
+global irq_msi_stubs
+irq_msi_stubs:
+%assign i 24
+%rep 40
+    dq irq %+ i
+%assign i i+1
+%endrep
+section .text
+
 ; =============================================================================
 ; Common ISR stub - saves all GPRs, calls Rust isr_handler, restores state
 ; =============================================================================
@@ -60,9 +60,11 @@ pub extern "C" fn arm64_irq_handler() {
         // blocks all further interrupts of equal/lower priority.
         super::gic::eoi(intid);
         let handler = unsafe { IRQ_HANDLERS[intid as usize] };
+        crate::task::tracepoints::emit(crate::task::tracepoints::IRQ_ENTRY, intid as u64, 0);
         if let Some(h) = handler {
             h();
         }
+        crate::task::tracepoints::emit(crate::task::tracepoints::IRQ_EXIT, intid as u64, 0);
     }
 }
 
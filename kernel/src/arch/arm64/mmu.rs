@@ -2,6 +2,24 @@
 //!
 //! Configures TCR_EL1, MAIR_EL1, and provides helpers for TTBR0/TTBR1 management.
 //! The actual page table manipulation (map/unmap/walk) lives in `memory::paging::arm64`.
+//!
+//! # ASIDs
+//!
+//! Every user address space gets an ASID, loaded into TTBR0_EL1[63:48] with
+//! its table, so TLB entries of different processes (user pages are nG) can
+//! coexist and a context switch does not flush anything.  ASIDs are handed
+//! out in generations: when the 8- or 16-bit space runs out, the generation
+//! is bumped and each CPU flushes its TLB once before it loads an ASID of
+//! the new generation.  The address space each CPU is running at that
+//! moment keeps its ASID (it may still have entries cached under it).
+//!
+//! Each ASID also records the CPUs it has run on since it was assigned;
+//! while that is only the current CPU, invalidations stay local instead of
+//! being broadcast to the inner-shareable domain.
+
+use crate::arch::arm64::smp::MAX_CPUS;
+use crate::sync::spinlock::Spinlock;
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
 
 /// MAIR_EL1 attribute indices.
 pub const MAIR_DEVICE_NGNRNE: u8 = 0; // Device-nGnRnE (strongly-ordered MMIO)
@@ -53,22 +71,47 @@ const TCR_VALUE: u64 = {
         | (ips << 32)
 };
 
+/// TCR_EL1.AS: 16-bit ASIDs (TCR_EL1.A1 stays 0, so TTBR0 holds the ASID).
+const TCR_AS: u64 = 1 << 36;
+
+/// TTBR0_EL1[47:1] is the table address, [63:48] the ASID.
+const TTBR_ASID_SHIFT: u32 = 48;
+const TTBR_BADDR_MASK: u64 = (1 << TTBR_ASID_SHIFT) - 1;
+
 /// Initialize the MMU configuration registers (TCR_EL1, MAIR_EL1).
 ///
 /// This must be called early in boot, before enabling the MMU.
 /// The actual TTBR0/TTBR1 setup and SCTLR_EL1.M enable happens in boot.S.
 pub fn init() {
+    // ID_AA64MMFR0_EL1.ASIDBits: 0b0010 = 16 bits, otherwise 8.
+    let mmfr0: u64;
+    unsafe { core::arch::asm!("mrs {}, id_aa64mmfr0_el1", out(reg) mmfr0, options(nomem, nostack)); }
+    let wide = (mmfr0 >> 4) & 0xF == 0b0010;
+    let tcr = if wide { TCR_VALUE | TCR_AS } else { TCR_VALUE };
+    ASID_BITS.store(if wide { 16 } else { 8 }, Ordering::Relaxed);
+    BOOT_TTBR0.store(read_ttbr0() & TTBR_BADDR_MASK, Ordering::Relaxed);
+
     unsafe {
         // Set MAIR_EL1
         core::arch::asm!("msr mair_el1, {}", in(reg) MAIR_VALUE, options(nostack));
 
         // Set TCR_EL1
-        core::arch::asm!("msr tcr_el1, {}", in(reg) TCR_VALUE, options(nostack));
+        core::arch::asm!("msr tcr_el1, {}", in(reg) tcr, options(nostack));
 
-        // Barrier to ensure configuration is visible
-        core::arch::asm!("isb", options(nostack));
+        // Barrier to ensure configuration is visible; entries cached under
+        // the old ASID size must go.
+        core::arch::asm!(
+            "isb",
+            "tlbi vmalle1",
+            "dsb nsh",
+            "isb",
+            options(nostack),
+        );
     }
-    crate::serial_println!("[OK] MMU configured: TCR={:#018x} MAIR={:#018x}", TCR_VALUE, MAIR_VALUE);
+    crate::serial_println!(
+        "[OK] MMU configured: TCR={:#018x} MAIR={:#018x} ASID={} bits",
+        tcr, MAIR_VALUE, ASID_BITS.load(Ordering::Relaxed),
+    );
 }
 
 /// Read TTBR0_EL1 (user page table base).
@@ -113,7 +156,7 @@ pub fn write_ttbr1(val: u64) {
     }
 }
 
-/// Invalidate the entire TLB on this core (all ASIDs).
+/// Invalidate the entire TLB on all cores (all ASIDs).
 #[inline]
 pub fn flush_tlb_all() {
     unsafe {
@@ -126,16 +169,348 @@ pub fn flush_tlb_all() {
     }
 }
 
-/// Invalidate TLB entry for a specific virtual address.
-#[inline]
+/// Invalidate the TLB entry for `vaddr` in the current address space.
+///
+/// The invalidation is tagged with the ASID in TTBR0_EL1 and stays on this
+/// core while the address space has not run anywhere else.
 pub fn flush_tlb_va(vaddr: u64) {
+    // Publish the table update to every walker first: another core may
+    // start running this address space right after `only_here` returned.
+    unsafe { core::arch::asm!("dsb ishst", options(nostack)); }
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let ttbr0 = read_ttbr0();
+    let asid = ttbr0 >> TTBR_ASID_SHIFT;
+    let arg = (asid << TTBR_ASID_SHIFT) | ((vaddr >> 12) & ((1 << 44) - 1));
     unsafe {
-        core::arch::asm!(
-            "tlbi vale1is, {}",
-            "dsb ish",
-            "isb",
-            in(reg) vaddr >> 12,
-            options(nostack),
-        );
+        if asid != 0 && only_here(ttbr0 & TTBR_BADDR_MASK) {
+            core::arch::asm!(
+                "tlbi vae1, {}",
+                "dsb nsh",
+                "isb",
+                in(reg) arg,
+                options(nostack),
+            );
+        } else {
+            core::arch::asm!(
+                "tlbi vae1is, {}",
+                "dsb ish",
+                "isb",
+                in(reg) arg,
+                options(nostack),
+            );
+        }
+    }
+    crate::arch::hal::restore_interrupt_state(flags);
+}
+
+/// Invalidate every TLB entry of the address space `pd`, on each core that
+/// may hold some.  Without an ASID for `pd` the whole TLB is flushed.
+pub fn flush_tlb_asid(pd: u64) {
+    let pd = pd & TTBR_BADDR_MASK;
+    unsafe { core::arch::asm!("dsb ishst", options(nostack)); }
+    let state = ASIDS.lock();
+    let tagged = state.find(pd).map(|i| state.slots[i]).filter(|s| s.asid >> 16 == state.generation);
+    let Some(AsidSlot { asid, cpus, .. }) = tagged else {
+        drop(state);
+        flush_tlb_all();
+        return;
+    };
+    let arg = (asid & 0xFFFF) << TTBR_ASID_SHIFT;
+    unsafe {
+        if cpus == 1 << crate::arch::arm64::smp::current_cpu_id() {
+            core::arch::asm!(
+                "tlbi aside1, {}",
+                "dsb nsh",
+                "isb",
+                in(reg) arg,
+                options(nostack),
+            );
+        } else {
+            core::arch::asm!(
+                "tlbi aside1is, {}",
+                "dsb ish",
+                "isb",
+                in(reg) arg,
+                options(nostack),
+            );
+        }
     }
 }
+
+// =============================================================================
+// ASID allocation
+// =============================================================================
+
+/// Width of TTBR0_EL1.ASID on this CPU (8 or 16), set by [`init`].
+static ASID_BITS: AtomicU32 = AtomicU32::new(8);
+
+/// TTBR0 table installed by boot.S (identity map, global entries only).
+static BOOT_TTBR0: AtomicU64 = AtomicU64::new(0);
+
+/// Address spaces tracked at once; beyond that, switches fall back to
+/// ASID 0 with a local flush, as before ASIDs.
+const ASID_SLOTS: usize = 1024;
+
+/// Table to load on the next [`context_switch`] of each CPU, written by
+/// [`activate`] just before.  Layout is read by context_switch.S.
+#[repr(C)]
+pub struct SwitchSlot {
+    /// TTBR0_EL1 value: table address | ASID << 48.
+    ttbr0: AtomicU64,
+    /// Non-zero: flush this CPU's TLB after loading `ttbr0`.
+    flush: AtomicU64,
+}
+
+/// Read by context_switch.S, indexed by MPIDR_EL1.Aff0.
+#[no_mangle]
+pub static ARM64_SWITCH_SLOTS: [SwitchSlot; MAX_CPUS] = {
+    const EMPTY: SwitchSlot = SwitchSlot { ttbr0: AtomicU64::new(0), flush: AtomicU64::new(0) };
+    [EMPTY; MAX_CPUS]
+};
+
+#[derive(Clone, Copy)]
+struct AsidSlot {
+    /// Table address (0 = free).
+    pd: u64,
+    /// generation << 16 | ASID.
+    asid: u64,
+    /// CPUs that ran `pd` under `asid`.
+    cpus: u64,
+}
+
+struct AsidState {
+    generation: u64,
+    /// Next ASID to try in this generation.
+    next: u64,
+    /// ASIDs taken in this generation.  Bits stay set after the address
+    /// space is gone, so an ASID is not reused before every TLB was flushed.
+    used: [u64; 65536 / 64],
+    /// Open-addressed (linear probing) map from table address to ASID.
+    slots: [AsidSlot; ASID_SLOTS],
+    /// Table each CPU is running (0 = a kernel table).
+    active: [u64; MAX_CPUS],
+    /// CPUs that must flush their TLB before using this generation.
+    flush_pending: u64,
+}
+
+const FREE_SLOT: AsidSlot = AsidSlot { pd: 0, asid: 0, cpus: 0 };
+
+static ASIDS: Spinlock<AsidState> = Spinlock::new(AsidState {
+    generation: 1,
+    next: 1,
+    used: [0; 65536 / 64],
+    slots: [FREE_SLOT; ASID_SLOTS],
+    active: [0; MAX_CPUS],
+    flush_pending: 0,
+});
+
+impl AsidState {
+    fn home(pd: u64) -> usize {
+        ((pd >> 12).wrapping_mul(0x9E37_79B9_7F4A_7C15) >> 54) as usize & (ASID_SLOTS - 1)
+    }
+
+    fn find(&self, pd: u64) -> Option<usize> {
+        let mut i = Self::home(pd);
+        for _ in 0..ASID_SLOTS {
+            match self.slots[i].pd {
+                0 => return None,
+                p if p == pd => return Some(i),
+                _ => i = (i + 1) & (ASID_SLOTS - 1),
+            }
+        }
+        None
+    }
+
+    fn insert(&mut self, pd: u64, asid: u64, cpus: u64) -> Option<usize> {
+        let mut i = Self::home(pd);
+        for _ in 0..ASID_SLOTS {
+            if self.slots[i].pd == 0 || self.slots[i].pd == pd {
+                self.slots[i] = AsidSlot { pd, asid, cpus };
+                return Some(i);
+            }
+            i = (i + 1) & (ASID_SLOTS - 1);
+        }
+        None
+    }
+
+    /// Remove slot `i`, shifting later entries of its probe run back.
+    fn remove(&mut self, mut i: usize) {
+        let mut j = i;
+        loop {
+            self.slots[i] = FREE_SLOT;
+            loop {
+                j = (j + 1) & (ASID_SLOTS - 1);
+                if self.slots[j].pd == 0 {
+                    return;
+                }
+                let h = Self::home(self.slots[j].pd);
+                // Entry j may move to i unless its home lies in (i, j].
+                let stays = if i <= j { i < h && h <= j } else { i < h || h <= j };
+                if !stays {
+                    break;
+                }
+            }
+            self.slots[i] = self.slots[j];
+            i = j;
+        }
+    }
+
+    fn take(&mut self, asid: u64) {
+        self.used[asid as usize / 64] |= 1 << (asid % 64);
+    }
+
+    /// A free ASID of this generation, starting a new one if none is left.
+    fn allocate(&mut self) -> u64 {
+        let limit = 1u64 << ASID_BITS.load(Ordering::Relaxed);
+        loop {
+            while self.next < limit {
+                let a = self.next;
+                self.next += 1;
+                if self.used[a as usize / 64] & (1 << (a % 64)) == 0 {
+                    self.take(a);
+                    return a;
+                }
+            }
+            self.rollover();
+        }
+    }
+
+    /// Start a new generation.  Address spaces running right now keep their
+    /// ASID; everything else gets a new one on its next switch.
+    fn rollover(&mut self) {
+        self.generation += 1;
+        self.next = 1;
+        self.used.fill(0);
+        let mut keep = [FREE_SLOT; MAX_CPUS];
+        for (cpu, &pd) in self.active.iter().enumerate() {
+            if pd == 0 {
+                continue;
+            }
+            if let Some(i) = self.find(pd) {
+                keep[cpu] = self.slots[i];
+            }
+        }
+        self.slots.fill(FREE_SLOT);
+        for k in keep.iter().filter(|k| k.pd != 0) {
+            let asid = k.asid & 0xFFFF;
+            let cpus = self.active.iter().enumerate()
+                .filter(|&(_, &pd)| pd == k.pd)
+                .fold(0u64, |m, (c, _)| m | 1 << c);
+            self.take(asid);
+            self.insert(k.pd, self.generation << 16 | asid, cpus);
+        }
+        self.flush_pending = (1u64 << MAX_CPUS) - 1;
+    }
+}
+
+fn is_kernel_table(pd: u64) -> bool {
+    pd == 0 || pd == BOOT_TTBR0.load(Ordering::Relaxed) || pd == read_ttbr1() & TTBR_BADDR_MASK
+}
+
+/// Whether the address space `pd` has only run on this CPU (so TLB
+/// maintenance for it need not be broadcast).  Call with IRQs disabled.
+fn only_here(pd: u64) -> bool {
+    let state = ASIDS.lock();
+    let cpu = crate::arch::arm64::smp::current_cpu_id();
+    match state.find(pd) {
+        Some(i) => state.slots[i].asid >> 16 == state.generation && state.slots[i].cpus == 1 << cpu,
+        None => false,
+    }
+}
+
+/// Pick the TTBR0 value for running `page_table` on `cpu` and note it in
+/// the CPU's [`SwitchSlot`].  Returns `(ttbr0, flush)`.  IRQs must be off.
+pub fn activate(cpu: usize, page_table: u64) -> (u64, bool) {
+    if cpu >= MAX_CPUS {
+        return (page_table & TTBR_BADDR_MASK, true);
+    }
+    let pd = page_table & TTBR_BADDR_MASK;
+    let (ttbr0, flush) = {
+        let mut state = ASIDS.lock();
+        let me = 1u64 << cpu;
+        let (ttbr0, untagged) = if is_kernel_table(pd) {
+            state.active[cpu] = 0;
+            (pd, false)
+        } else {
+            let slot = match state.find(pd) {
+                Some(i) if state.slots[i].asid >> 16 == state.generation => Some(i),
+                _ => {
+                    let asid = state.allocate();
+                    let tagged = state.generation << 16 | asid;
+                    // A rollover in `allocate` rebuilds the table and may have
+                    // kept `pd` (running elsewhere) under its old ASID.
+                    match state.find(pd) {
+                        Some(i) if state.slots[i].asid >> 16 == state.generation => Some(i),
+                        Some(i) => {
+                            state.slots[i] = AsidSlot { pd, asid: tagged, cpus: 0 };
+                            Some(i)
+                        }
+                        None => state.insert(pd, tagged, 0),
+                    }
+                }
+            };
+            match slot {
+                Some(i) => {
+                    state.slots[i].cpus |= me;
+                    state.active[cpu] = pd;
+                    (pd | (state.slots[i].asid & 0xFFFF) << TTBR_ASID_SHIFT, false)
+                }
+                // Table full: run untagged and flush, like before ASIDs.
+                None => {
+                    state.active[cpu] = 0;
+                    (pd, true)
+                }
+            }
+        };
+        let pending = state.flush_pending & me != 0;
+        state.flush_pending &= !me;
+        (ttbr0, untagged || pending)
+    };
+    let slot = &ARM64_SWITCH_SLOTS[cpu];
+    slot.ttbr0.store(ttbr0, Ordering::Relaxed);
+    slot.flush.store(flush as u64, Ordering::Relaxed);
+    (ttbr0, flush)
+}
+
+/// Load `page_table` into TTBR0_EL1 outside of a context switch (exec,
+/// cross-address-space copies), with its ASID.
+pub fn switch_ttbr0(page_table: u64) {
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let cpu = crate::arch::arm64::smp::current_cpu_id();
+    let (ttbr0, flush) = activate(cpu, page_table);
+    if ttbr0 != read_ttbr0() {
+        write_ttbr0(ttbr0);
+    }
+    if flush {
+        unsafe {
+            core::arch::asm!(
+                "tlbi vmalle1",
+                "dsb nsh",
+                "isb",
+                options(nostack),
+            );
+        }
+    }
+    crate::arch::hal::restore_interrupt_state(flags);
+}
+
+/// Forget the ASID of a page table that is being freed.  Its ASID stays
+/// taken until the next rollover, so stale entries under it are never hit.
+pub fn release_asid(page_table: u64) {
+    let pd = page_table & TTBR_BADDR_MASK;
+    let mut state = ASIDS.lock();
+    if let Some(i) = state.find(pd) {
+        state.remove(i);
+    }
+    for a in state.active.iter_mut() {
+        if *a == pd {
+            *a = 0;
+        }
+    }
+}
+
+/// Table address in a TTBR0_EL1 value (without the ASID).
+#[inline]
+pub fn ttbr_table(ttbr: u64) -> u64 {
+    ttbr & TTBR_BADDR_MASK
+}
@@ -192,6 +192,100 @@ pub fn timer_frequency_hz() -> u64 {
     1000 // Ticks are normalized to 1000 Hz (millisecond granularity)
 }
 
+/// Nanoseconds since boot (same epoch as `timer_current_ticks()`).
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn monotonic_ns() -> u64 {
+    crate::arch::x86::pit::monotonic_ns()
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn monotonic_ns() -> u64 {
+    let cnt = crate::arch::arm64::generic_timer::read_counter();
+    let freq = crate::arch::arm64::generic_timer::frequency() as u64;
+    if freq == 0 { return 0; }
+    (cnt as u128 * 1_000_000_000 / freq as u128) as u64
+}
+
+/// Raw cycle counter (TSC on x86, CNTPCT_EL0 on ARM64) for fine-grained
+/// timing; see [`cycle_counter_hz`].
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+pub fn cycle_counter() -> u64 {
+    crate::arch::x86::pit::rdtsc()
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline(always)]
+pub fn cycle_counter() -> u64 {
+    crate::arch::arm64::generic_timer::read_counter()
+}
+
+/// Frequency of [`cycle_counter`] in Hz (0 = not yet calibrated).
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn cycle_counter_hz() -> u64 {
+    crate::arch::x86::pit::tsc_hz()
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn cycle_counter_hz() -> u64 {
+    crate::arch::arm64::generic_timer::frequency() as u64
+}
+
+/// Re-arm this CPU's scheduler timer after a scheduling decision.
+///
+/// `keep_tick == false` lets a tickless timer stop the periodic tick until
+/// the next deadline or kick. Called with the SCHEDULER lock held.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn timer_reprogram(cpu: usize, keep_tick: bool) {
+    crate::arch::x86::lapic_timer::reprogram(cpu, keep_tick);
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn timer_reprogram(_cpu: usize, _keep_tick: bool) {
+    // ARM64: generic timer stays periodic
+}
+
+/// A thread became ready on `cpu`: restart a stopped tick so it gets run.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn timer_kick(cpu: usize) {
+    crate::arch::x86::lapic_timer::kick(cpu);
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn timer_kick(_cpu: usize) {}
+
+/// Restart `cpu`'s tick if it is stopped (for lock-free deferred work).
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn timer_wake(cpu: usize) {
+    crate::arch::x86::lapic_timer::wake_cpu(cpu);
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn timer_wake(_cpu: usize) {}
+
+/// Publish the earliest sleeper deadline (`monotonic_ns()`, `u64::MAX` = none).
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn timer_set_next_event(ns: u64) {
+    crate::arch::x86::lapic_timer::set_next_event(ns);
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn timer_set_next_event(_ns: u64) {
+    // ARM64: sleepers are woken on the periodic tick
+}
+
 /// Busy-wait delay in milliseconds.
 #[cfg(target_arch = "x86_64")]
 #[inline]
@@ -326,9 +420,21 @@ pub fn current_page_table() -> u64 {
 #[cfg(target_arch = "aarch64")]
 #[inline]
 pub fn current_page_table() -> u64 {
-    let ttbr0: u64;
-    unsafe { core::arch::asm!("mrs {}, ttbr0_el1", out(reg) ttbr0, options(nomem, nostack)); }
-    ttbr0
+    crate::arch::arm64::mmu::ttbr_table(crate::arch::arm64::mmu::read_ttbr0())
+}
+
+/// Tell the TLB shootdown logic that `cpu` is about to run on `page_table`.
+/// Called by the scheduler (IF=0) right before the context switch.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn activate_address_space(cpu: usize, page_table: u64) {
+    crate::arch::x86::smp::activate_address_space(cpu, page_table);
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+pub fn activate_address_space(cpu: usize, page_table: u64) {
+    crate::arch::arm64::mmu::activate(cpu, page_table);
 }
 
 /// Switch to a different page table.
@@ -341,14 +447,7 @@ pub fn switch_page_table(addr: u64) {
 #[cfg(target_arch = "aarch64")]
 #[inline]
 pub fn switch_page_table(addr: u64) {
-    unsafe {
-        core::arch::asm!(
-            "msr ttbr0_el1, {}",
-            "isb",
-            in(reg) addr,
-            options(nostack),
-        );
-    }
+    crate::arch::arm64::mmu::switch_ttbr0(addr);
 }
 
 /// Flush TLB for a single virtual address.
@@ -361,15 +460,7 @@ pub fn flush_tlb(vaddr: u64) {
 #[cfg(target_arch = "aarch64")]
 #[inline]
 pub fn flush_tlb(vaddr: u64) {
-    unsafe {
-        core::arch::asm!(
-            "tlbi vale1is, {}",
-            "dsb ish",
-            "isb",
-            in(reg) vaddr >> 12,
-            options(nostack),
-        );
-    }
+    crate::arch::arm64::mmu::flush_tlb_va(vaddr);
 }
 
 /// Flush the entire TLB.
@@ -6,7 +6,7 @@
 /// - Inter-Processor Interrupts (IPI) for SMP coordination
 /// - EOI (End of Interrupt) signaling
 
-use core::sync::atomic::{AtomicU32, AtomicBool, Ordering};
+use core::sync::atomic::{AtomicU32, AtomicU64, AtomicBool, Ordering};
 
 // LAPIC register offsets
 const LAPIC_ID: u32        = 0x020;
@@ -17,6 +17,7 @@ const LAPIC_SVR: u32       = 0x0F0;  // Spurious Interrupt Vector Register
 const LAPIC_ICR_LOW: u32   = 0x300;  // Interrupt Command Register (low)
 const LAPIC_ICR_HIGH: u32  = 0x310;  // Interrupt Command Register (high)
 const LAPIC_TIMER: u32     = 0x320;  // LVT Timer Register
+const LAPIC_PERF: u32      = 0x340;  // LVT Performance Counter
 const LAPIC_LINT0: u32     = 0x350;  // LVT LINT0
 const LAPIC_LINT1: u32     = 0x360;  // LVT LINT1
 const LAPIC_TIMER_INIT: u32 = 0x380; // Timer Initial Count
@@ -28,8 +29,15 @@ const SVR_ENABLE: u32 = 1 << 8;
 
 // Timer modes
 const TIMER_PERIODIC: u32 = 1 << 17;
+const TIMER_TSC_DEADLINE: u32 = 2 << 17;
 const TIMER_MASKED: u32   = 1 << 16;
 
+// LVT delivery mode NMI.
+const LVT_NMI: u32 = 4 << 8;
+
+/// IA32_TSC_DEADLINE MSR (TSC-deadline timer mode; 0 disarms).
+const MSR_TSC_DEADLINE: u32 = 0x6E0;
+
 // ICR delivery modes
 const ICR_INIT: u32    = 5 << 8;
 const ICR_STARTUP: u32 = 6 << 8;
@@ -37,7 +45,7 @@ const ICR_LEVEL: u32   = 1 << 14;
 const ICR_ASSERT: u32  = 1 << 15;
 const ICR_DEASSERT: u32 = 0;
 
-/// Interrupt vector for the LAPIC periodic timer (INT 48).
+/// Interrupt vector for the LAPIC timer (INT 48).
 pub const VECTOR_TIMER: u8    = 48;
 /// Interrupt vector for spurious interrupts (INT 255).
 pub const VECTOR_SPURIOUS: u8 = 255;
@@ -45,6 +53,8 @@ pub const VECTOR_SPURIOUS: u8 = 255;
 pub const VECTOR_IPI_HALT: u8 = 53;
 /// IPI vector used for TLB shootdown across cores (INT 52 = IRQ 20).
 pub const VECTOR_IPI_TLB: u8  = 52;
+/// IPI vector that restarts the timer on a tickless idle CPU (INT 54 = IRQ 22).
+pub const VECTOR_IPI_TIMER: u8 = 54;
 
 /// Virtual address where LAPIC MMIO is mapped
 const LAPIC_VIRT_BASE: u64 = 0xFFFF_FFFF_D010_0000;
@@ -107,7 +117,9 @@ pub fn init_ap() {
 
         // Start LAPIC timer using calibrated count from BSP
         let count = timer_initial_count();
-        if count > 0 {
+        if count > 0 && crate::arch::x86::lapic_timer::start_cpu() {
+            crate::serial_println!("  LAPIC: AP id={} one-shot timer started", lapic_id());
+        } else if count > 0 {
             start_timer_with_count(count);
             crate::serial_println!("  LAPIC: AP id={} timer started (count={})", lapic_id(), count);
         } else {
@@ -120,11 +132,14 @@ pub fn init_ap() {
     crate::serial_println!("  LAPIC: AP id={} initialized", id);
 }
 
-/// Calibrate and start the LAPIC timer for periodic scheduling.
+/// Calibrate and start the LAPIC timer for scheduling.
 ///
 /// Uses the TSC (already calibrated via PIT channel 2) to measure the
 /// LAPIC timer decrement rate over a 10ms window. This avoids depending
 /// on PIT IRQ delivery which is unreliable in UEFI/APIC mode.
+///
+/// The timer then runs in one-shot mode under [`lapic_timer`](super::lapic_timer)
+/// (tickless idle); periodic mode at `target_hz` is the fallback.
 pub fn calibrate_timer(target_hz: u32) {
     let tsc_hz = crate::arch::x86::pit::tsc_hz();
     if tsc_hz == 0 {
@@ -162,13 +177,52 @@ pub fn calibrate_timer(target_hz: u32) {
             elapsed, initial_count, target_hz);
 
         // Store calibrated value for APs
+        TIMER_RATE_HZ.store(ticks_per_second, Ordering::SeqCst);
         TIMER_INITIAL_COUNT.store(initial_count, Ordering::SeqCst);
 
-        // Start periodic timer
-        start_timer_with_count(initial_count);
+        if !crate::arch::x86::lapic_timer::start_cpu() {
+            start_timer_with_count(initial_count);
+        }
     }
 }
 
+/// LAPIC timer decrement rate in Hz at divide-by-16 (0 = not calibrated).
+static TIMER_RATE_HZ: AtomicU64 = AtomicU64::new(0);
+
+/// Calibrated LAPIC timer rate (ticks per second, divide-by-16).
+pub fn timer_rate_hz() -> u64 {
+    TIMER_RATE_HZ.load(Ordering::Relaxed)
+}
+
+/// Switch this CPU's LAPIC timer to one-shot (`tsc_deadline == false`) or
+/// TSC-deadline mode. The timer is left disarmed.
+pub fn timer_set_oneshot(tsc_deadline: bool) {
+    unsafe {
+        write(LAPIC_TIMER_DIV, 0x03);
+        write(LAPIC_TIMER_INIT, 0);
+        let mode = if tsc_deadline { TIMER_TSC_DEADLINE } else { 0 };
+        write(LAPIC_TIMER, mode | VECTOR_TIMER as u32);
+        if tsc_deadline {
+            // SDM 10.5.4.1: the LVT write must be ordered before the first
+            // IA32_TSC_DEADLINE write, or the deadline may be ignored.
+            core::arch::asm!("mfence", options(nostack));
+            crate::arch::x86::power::wrmsr(MSR_TSC_DEADLINE, 0);
+        }
+    }
+}
+
+/// Arm the TSC-deadline timer to fire at absolute TSC value `tsc`.
+#[inline]
+pub fn timer_arm_deadline(tsc: u64) {
+    unsafe { crate::arch::x86::power::wrmsr(MSR_TSC_DEADLINE, tsc.max(1)); }
+}
+
+/// Arm the one-shot timer to fire after `count` LAPIC ticks.
+#[inline]
+pub fn timer_arm_count(count: u32) {
+    unsafe { write(LAPIC_TIMER_INIT, count.max(1)); }
+}
+
 static TIMER_INITIAL_COUNT: AtomicU32 = AtomicU32::new(0);
 
 fn timer_initial_count() -> u32 {
@@ -184,6 +238,14 @@ unsafe fn start_timer_with_count(initial_count: u32) {
     write(LAPIC_TIMER_INIT, initial_count);
 }
 
+/// Route (or mask) this CPU's performance-counter overflow as an NMI.
+/// Delivery sets the LVT mask bit, so the PMU handler calls this again.
+pub fn set_perf_lvt_nmi(enabled: bool) {
+    if LAPIC_INITIALIZED.load(Ordering::Relaxed) {
+        unsafe { write(LAPIC_PERF, if enabled { LVT_NMI } else { LVT_NMI | TIMER_MASKED }); }
+    }
+}
+
 /// Get this CPU's LAPIC ID.
 pub fn lapic_id() -> u8 {
     unsafe { ((read(LAPIC_ID) >> 24) & 0xFF) as u8 }
@@ -264,6 +326,9 @@ pub fn is_initialized() -> bool {
 }
 
 /// LAPIC timer IRQ handler (IRQ 16): scheduling only (no tick counting).
+/// One-shot CPUs go through [`lapic_timer::on_interrupt`](super::lapic_timer::on_interrupt).
 pub fn timer_irq_handler(_irq: u8) {
-    crate::task::scheduler::schedule_tick();
+    if !crate::arch::x86::lapic_timer::on_interrupt() {
+        crate::task::scheduler::schedule_tick();
+    }
 }
@@ -37,6 +37,7 @@ pub struct CpuFeatures {
     pub rdrand: bool,
     pub pcid: bool,
     pub mwait: bool,
+    pub tsc_deadline: bool,
     // Extended leaf 0x80000001 EDX
     pub nx: bool,
     pub syscall: bool,
@@ -46,8 +47,11 @@ pub struct CpuFeatures {
     pub fsgsbase: bool,
     pub bmi1: bool,
     pub bmi2: bool,
+    pub invpcid: bool,
     // Leaf 7 ECX
     pub rdpid: bool,
+    // Leaf 7 EDX
+    pub fsrm: bool,
     // Leaf 7 EBX (supervisor-mode protection)
     pub smep: bool,
     // Leaf 0xD: XSAVE area size (bytes) for all enabled components.
@@ -72,6 +76,7 @@ impl CpuFeatures {
             rdrand: false,
             pcid: false,
             mwait: false,
+            tsc_deadline: false,
             nx: false,
             syscall: false,
             avx2: false,
@@ -79,7 +84,9 @@ impl CpuFeatures {
             fsgsbase: false,
             bmi1: false,
             bmi2: false,
+            invpcid: false,
             rdpid: false,
+            fsrm: false,
             smep: false,
             xsave_size: 0,
         }
@@ -141,6 +148,7 @@ pub fn detect() {
     f.rdrand = ecx & (1 << 30) != 0;
     f.pcid = ecx & (1 << 17) != 0;
     f.mwait = ecx & (1 << 3) != 0;
+    f.tsc_deadline = ecx & (1 << 24) != 0;
 
     // Extended leaf 0x80000001: NX, SYSCALL
     let max_ext = cpuid(0x80000000, 0).0;
@@ -167,14 +175,16 @@ pub fn detect() {
     // Leaf 7 subleaf 0: structured extended features
     let max_leaf = cpuid(0, 0).0;
     if max_leaf >= 7 {
-        let (_eax, ebx, ecx, _edx) = cpuid(7, 0);
+        let (_eax, ebx, ecx, edx) = cpuid(7, 0);
         f.fsgsbase = ebx & (1 << 0) != 0;
         f.bmi1 = ebx & (1 << 3) != 0;
         f.smep = ebx & (1 << 7) != 0;
         f.avx2 = ebx & (1 << 5) != 0;
         f.bmi2 = ebx & (1 << 8) != 0;
         f.erms = ebx & (1 << 9) != 0;
+        f.invpcid = ebx & (1 << 10) != 0;
         f.rdpid = ecx & (1 << 22) != 0;
+        f.fsrm = edx & (1 << 4) != 0;
     }
 
     // Leaf 0xD subleaf 0: XSAVE area size for all XCR0-enabled components
@@ -215,12 +225,12 @@ pub fn detect() {
         f.avx, f.avx2, f.aes_ni, f.xsave
     );
     crate::serial_println!(
-        "  NX={} SYSCALL={} PCID={} RDRAND={} MWAIT={}",
-        f.nx, f.syscall, f.pcid, f.rdrand, f.mwait
+        "  NX={} SYSCALL={} PCID={} RDRAND={} MWAIT={} TSC-DEADLINE={}",
+        f.nx, f.syscall, f.pcid, f.rdrand, f.mwait, f.tsc_deadline
     );
     crate::serial_println!(
-        "  ERMS={} FSGSBASE={} BMI1={} BMI2={} SMEP={}",
-        f.erms, f.fsgsbase, f.bmi1, f.bmi2, f.smep
+        "  ERMS={} FSRM={} FSGSBASE={} BMI1={} BMI2={} SMEP={} INVPCID={}",
+        f.erms, f.fsrm, f.fsgsbase, f.bmi1, f.bmi2, f.smep, f.invpcid
     );
 
     // Assert mandatory features for x86_64
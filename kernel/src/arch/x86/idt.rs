@@ -151,6 +151,9 @@ extern "C" {
     fn irq20(); fn irq21(); fn irq22(); fn irq23();
 
     fn syscall_entry();
+
+    /// Stubs of the MSI vectors (IRQ 24-63).
+    static irq_msi_stubs: [u64; crate::arch::x86::irq::MSI_IRQ_COUNT];
 }
 
 /// Populate the IDT with exception, IRQ, and syscall gates, then load via `lidt`.
@@ -214,9 +217,16 @@ pub fn init() {
     set_gate(51, irq19, KERNEL_CODE_SEG, GATE_INTERRUPT);
     set_gate(52, irq20, KERNEL_CODE_SEG, GATE_INTERRUPT); // IPI: TLB
     set_gate(53, irq21, KERNEL_CODE_SEG, GATE_INTERRUPT); // IPI: Halt
-    set_gate(54, irq22, KERNEL_CODE_SEG, GATE_INTERRUPT);
+    set_gate(54, irq22, KERNEL_CODE_SEG, GATE_INTERRUPT); // IPI: Timer
     set_gate(55, irq23, KERNEL_CODE_SEG, GATE_INTERRUPT); // Spurious
 
+    // MSI / MSI-X vectors (INT 56-95)
+    for i in 0..crate::arch::x86::irq::MSI_IRQ_COUNT {
+        let stub = unsafe { (*core::ptr::addr_of!(irq_msi_stubs))[i] };
+        let stub: unsafe extern "C" fn() = unsafe { core::mem::transmute(stub as *const ()) };
+        set_gate(32 + crate::arch::x86::irq::MSI_IRQ_BASE as usize + i, stub, KERNEL_CODE_SEG, GATE_INTERRUPT);
+    }
+
     // Syscall: int 0x80 - DPL=3 trap gate so Ring 3 code can invoke it
     set_gate(0x80, syscall_entry, KERNEL_CODE_SEG, GATE_TRAP_DPL3);
 
@@ -457,6 +467,11 @@ pub extern "C" fn isr_handler(frame: &InterruptFrame) {
         }
     }
 
+    // Sampling-profiler counter overflow (lock-free, before anything else).
+    if frame.int_no == 2 && crate::task::profiler::on_nmi(frame) {
+        return;
+    }
+
     // Garbled frame detection: CS must be a valid segment selector.
     // If CS contains a kernel heap address instead of 0x08/0x1B/0x2B, the
     // exception frame was pushed to wrong memory (stale TSS.RSP0 pointing
@@ -833,6 +848,7 @@ pub extern "C" fn isr_handler(frame: &InterruptFrame) {
         14 => {
             let cr2: u64;
             unsafe { core::arch::asm!("mov {}, cr2", out(reg) cr2); }
+            crate::task::tracepoints::emit(crate::task::tracepoints::PAGE_FAULT, cr2, frame.err_code);
 
             // Demand paging: if page not present and address is in committed heap range,
             // allocate a frame and map it transparently, then retry the instruction.
@@ -854,6 +870,40 @@ pub extern "C" fn isr_handler(frame: &InterruptFrame) {
                 }
             }
 
+            // Swapped-out user page: read it back.  Only a page in the swap
+            // file needs to block, which requires IF to have been set.
+            if err_not_present
+                && cr2 < 0x0000_8000_0000_0000
+                && crate::memory::virtual_mem::handle_swap_fault(cr2, is_user_mode || frame.rflags & 0x200 != 0)
+            {
+                return; // Page restored — retry the access
+            }
+
+            // File-backed mapping: read the page from the file.  Kernel-mode
+            // faults qualify only if IF was set (no spinlock held), since
+            // the read may block.
+            if err_not_present && (is_user_mode || frame.rflags & 0x200 != 0) {
+                let err_write = (frame.err_code & 0b10) != 0;
+                if crate::memory::file_map::handle_fault(cr2, err_write) {
+                    return; // File page mapped — retry the access
+                }
+            }
+
+            // Copy-on-write: a write to a present page shared after fork.
+            // Kernel-mode faults count too (syscall writing a user buffer).
+            let err_write_protect = (frame.err_code & 0b11) == 0b11;
+            if err_write_protect && crate::memory::virtual_mem::handle_cow_fault(cr2) {
+                // Other threads of this process may still cache the old
+                // read-only mapping. Only shoot down from user mode: a kernel
+                // fault may hold locks that remote CPUs spin on with IF=0.
+                if is_user_mode && crate::task::scheduler::has_live_pd_siblings() {
+                    crate::arch::x86::smp::tlb_shootdown(
+                        crate::arch::x86::smp::TLB_FLUSH_ALL_CONTEXTS,
+                    );
+                }
+                return; // Private copy mapped — retry the write
+            }
+
             // User-mode page fault: print diagnostics and kill the thread
             if is_user_mode {
                 let tid = crate::task::scheduler::current_tid();
@@ -1036,12 +1086,17 @@ pub extern "C" fn irq_handler(frame: &InterruptFrame) {
         // contiguous on all hypervisors (e.g., VirtualBox can assign 0,2,4,6).
         let cpu_id = crate::arch::x86::smp::current_cpu_id() as usize;
 
-        // Periodic uptime summary every 60s (CPU 0 only, LAPIC at 1000Hz)
+        // Sampling profiler: PMU arm/disarm, or a timer-driven sample.
+        crate::task::profiler::on_timer(frame);
+
+        // Periodic uptime summary every 60s (CPU 0 only). Keyed on elapsed
+        // time, not interrupt count — the one-shot timer does not tick at a
+        // fixed rate while idle.
         if cpu_id == 0 {
-            static LAPIC_TICK_CTR: AtomicU32 = AtomicU32::new(0);
-            let ctr = LAPIC_TICK_CTR.fetch_add(1, Ordering::Relaxed) + 1;
-            if ctr % 60_000 == 0 {
-                let uptime_ms = crate::arch::x86::pit::get_ticks();
+            static LAST_UPTIME_MIN: AtomicU32 = AtomicU32::new(0);
+            let uptime_ms = crate::arch::x86::pit::get_ticks();
+            let minute = uptime_ms / 60_000;
+            if minute != LAST_UPTIME_MIN.swap(minute, Ordering::Relaxed) {
                 let secs = uptime_ms / 1000;
                 let mins = secs / 60;
                 let hrs = mins / 60;
@@ -178,6 +178,24 @@ pub fn set_destination(gsi: u32, lapic_id: u8) {
     write_redir(gsi, entry);
 }
 
+/// Re-aim an ISA/PCI IRQ line at `lapic_id`, respecting ISO overrides.
+/// The entry is masked while it is rewritten so no interrupt is delivered
+/// to a half-updated destination.
+pub fn set_irq_destination(irq: u8, lapic_id: u8) {
+    let gsi = if (irq as usize) < 16 {
+        unsafe { IRQ_TO_GSI[irq as usize] }
+    } else {
+        irq as u32
+    };
+    let max = unsafe { IOAPIC_MAX_ENTRIES };
+    if gsi >= max { return; }
+
+    let entry = read_redir(gsi);
+    write_redir(gsi, entry | REDIR_MASKED);
+    let entry = (entry & 0x00FFFFFF_FFFFFFFF) | ((lapic_id as u64) << 56);
+    write_redir(gsi, entry);
+}
+
 // Low-level I/O APIC register access (indirect via IOREGSEL/IOWIN)
 
 fn read_reg(reg: u32) -> u32 {
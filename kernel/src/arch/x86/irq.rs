@@ -1,17 +1,26 @@
 /// Dynamic IRQ handler registration.
 /// Uses AtomicPtr for lock-free access from interrupt context.
 /// Supports shared IRQs: up to 2 handlers per IRQ line (primary + chained).
+/// IRQs 24-63 are a pool of MSI / MSI-X vectors handed out by [`alloc_irq`].
+/// Every dispatch is counted per IRQ and CPU ([`count`]).
 
-use core::sync::atomic::{AtomicPtr, Ordering};
+use core::sync::atomic::{AtomicPtr, AtomicU32, Ordering};
+use crate::arch::x86::smp::MAX_CPUS;
 
 /// IRQ handler function type. Takes the IRQ number as parameter.
 pub type IrqHandler = fn(irq: u8);
 
-const MAX_IRQS: usize = 32;
+pub const MAX_IRQS: usize = 64;
+
+/// First IRQ of the MSI vector pool (INT 56).
+pub const MSI_IRQ_BASE: u8 = 24;
+/// Number of MSI vectors (INT 56-95).
+pub const MSI_IRQ_COUNT: usize = MAX_IRQS - MSI_IRQ_BASE as usize;
 
 /// Primary handler per IRQ line. Null means no handler registered.
-/// IRQ 0-15: legacy PIC / I/O APIC (INT 32-47)
-/// IRQ 16+:  LAPIC vectors (INT 48+): 16=LAPIC timer, etc.
+/// IRQ 0-15:  legacy PIC / I/O APIC (INT 32-47)
+/// IRQ 16-23: LAPIC vectors (INT 48-55): 16=LAPIC timer, etc.
+/// IRQ 24-63: MSI / MSI-X vectors (INT 56-95)
 static IRQ_HANDLERS: [AtomicPtr<()>; MAX_IRQS] = {
     const NULL: AtomicPtr<()> = AtomicPtr::new(core::ptr::null_mut());
     [NULL; MAX_IRQS]
@@ -23,6 +32,13 @@ static IRQ_CHAIN: [AtomicPtr<()>; MAX_IRQS] = {
     [NULL; MAX_IRQS]
 };
 
+/// Interrupts dispatched per IRQ and CPU (wrapping).
+static IRQ_COUNTS: [[AtomicU32; MAX_CPUS]; MAX_IRQS] = {
+    const ZERO: AtomicU32 = AtomicU32::new(0);
+    const ROW: [AtomicU32; MAX_CPUS] = [ZERO; MAX_CPUS];
+    [ROW; MAX_IRQS]
+};
+
 /// Register an IRQ handler. Replaces any previous handler for that IRQ.
 pub fn register_irq(irq: u8, handler: IrqHandler) {
     if (irq as usize) < MAX_IRQS {
@@ -38,6 +54,20 @@ pub fn register_irq_chain(irq: u8, handler: IrqHandler) {
     }
 }
 
+/// Allocate an unused MSI vector and install `handler` on it.
+/// Returns the IRQ number (the CPU vector is `IRQ + 32`).
+pub fn alloc_irq(handler: IrqHandler) -> Option<u8> {
+    for irq in MSI_IRQ_BASE as usize..MAX_IRQS {
+        if IRQ_HANDLERS[irq]
+            .compare_exchange(core::ptr::null_mut(), handler as *mut (), Ordering::SeqCst, Ordering::SeqCst)
+            .is_ok()
+        {
+            return Some(irq as u8);
+        }
+    }
+    None
+}
+
 /// Unregister an IRQ handler.
 pub fn unregister_irq(irq: u8) {
     if (irq as usize) < MAX_IRQS {
@@ -52,6 +82,10 @@ pub fn dispatch_irq(irq: u8) -> bool {
         return false;
     }
 
+    let cpu = crate::arch::x86::smp::current_cpu_id() as usize;
+    IRQ_COUNTS[irq as usize][cpu].fetch_add(1, Ordering::Relaxed);
+    crate::task::tracepoints::emit(crate::task::tracepoints::IRQ_ENTRY, irq as u64, 0);
+
     let mut handled = false;
 
     let primary = IRQ_HANDLERS[irq as usize].load(Ordering::SeqCst);
@@ -68,5 +102,22 @@ pub fn dispatch_irq(irq: u8) -> bool {
         handled = true;
     }
 
+    crate::task::tracepoints::emit(crate::task::tracepoints::IRQ_EXIT, irq as u64, 0);
     handled
 }
+
+/// Interrupts of `irq` taken by `cpu` so far (wraps at 2^32).
+pub fn count(irq: u8, cpu: usize) -> u32 {
+    if (irq as usize) < MAX_IRQS && cpu < MAX_CPUS {
+        IRQ_COUNTS[irq as usize][cpu].load(Ordering::Relaxed)
+    } else {
+        0
+    }
+}
+
+/// Whether a handler is installed on `irq`.
+pub fn is_registered(irq: u8) -> bool {
+    (irq as usize) < MAX_IRQS
+        && (!IRQ_HANDLERS[irq as usize].load(Ordering::Relaxed).is_null()
+            || !IRQ_CHAIN[irq as usize].load(Ordering::Relaxed).is_null())
+}
@@ -0,0 +1,288 @@
+//! Interrupt balancing across CPUs.
+//!
+//! Every dispatched interrupt is counted per IRQ and CPU ([`irq::count`]).
+//! About once a second [`balance`] turns those counters into rates and
+//! moves busy device vectors — MSI / MSI-X messages and the I/O APIC lines
+//! of PCI storage, network and USB controllers — off CPUs that take more
+//! than their share.  A vector only moves when that clearly evens out the
+//! load, so a handler keeps running on the CPU whose caches hold its data.
+//!
+//! Fixed vectors are never moved: MSI-X queues bound to the CPU that
+//! consumes their completions (`IrqAffinity::Cpu`), vectors pinned through
+//! [`set_affinity`], legacy ISA lines and the LAPIC vectors (16-23).
+
+use crate::arch::x86::irq::{self, MAX_IRQS, MSI_IRQ_BASE};
+use crate::arch::x86::smp::{self, MAX_CPUS};
+use crate::arch::x86::{apic, ioapic};
+use crate::drivers::pci::{self, IrqAffinity};
+use crate::sync::spinlock::Spinlock;
+use alloc::vec::Vec;
+
+/// Interrupts per second below which a vector is not worth moving.
+const MIN_RATE: u32 = 200;
+
+/// `IrqRecord::kind`: I/O APIC line (IRQ 0-15).
+pub const KIND_LINE: u8 = 0;
+/// `IrqRecord::kind`: MSI / MSI-X vector.
+pub const KIND_MSI: u8 = 1;
+/// `IrqRecord::kind`: LAPIC vector (timer, IPIs).
+pub const KIND_LOCAL: u8 = 2;
+
+/// `IrqRecord::flags`: the vector is bound to one CPU.
+pub const FLAG_PINNED: u8 = 1 << 0;
+/// `IrqRecord::flags`: the balancer may move the vector.
+pub const FLAG_BALANCED: u8 = 1 << 1;
+
+/// One IRQ as reported by `SYS_IRQ_STATS`.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct IrqRecord {
+    pub irq: u8,
+    pub kind: u8,
+    /// CPU the vector is delivered to (0xFF: every CPU, LAPIC vectors).
+    pub cpu: u8,
+    pub flags: u8,
+    /// NUL-padded source name ("network", "storage", "tlb-ipi", ...).
+    pub name: [u8; 12],
+    /// Interrupts taken per CPU since boot (wrapping).
+    pub counts: [u32; MAX_CPUS],
+}
+
+#[derive(Clone, Copy)]
+struct Line {
+    /// CPU the redirection entry points at.
+    cpu: u8,
+    pinned: bool,
+}
+
+struct Balancer {
+    /// Counters at the previous pass.
+    prev: [[u32; MAX_CPUS]; MAX_IRQS],
+    /// Destination of IRQ 0-15 (all start on the BSP).
+    lines: [Line; 16],
+    /// Timer tick of the previous pass.
+    last_tick: u32,
+}
+
+static BALANCER: Spinlock<Balancer> = Spinlock::new(Balancer {
+    prev: [[0; MAX_CPUS]; MAX_IRQS],
+    lines: [Line { cpu: 0, pinned: false }; 16],
+    last_tick: 0,
+});
+
+/// Short name for the interrupts of a PCI class.
+fn class_label(class: u8, subclass: u8) -> &'static str {
+    match (class, subclass) {
+        (0x01, _) => "storage",
+        (0x02, _) => "network",
+        (0x03, _) => "display",
+        (0x04, _) => "audio",
+        (0x0C, 0x03) => "usb",
+        _ => "pci",
+    }
+}
+
+/// Whether PCI devices of this class may have their INTx line moved.
+fn movable_class(class: u8, subclass: u8) -> bool {
+    matches!((class, subclass), (0x01, _) | (0x02, _) | (0x0C, 0x03))
+}
+
+fn local_label(irq: u8) -> &'static str {
+    match irq {
+        0 => "timer",
+        1 => "keyboard",
+        4 => "serial",
+        12 => "mouse",
+        16 => "lapic-timer",
+        20 => "tlb-ipi",
+        21 => "halt-ipi",
+        22 => "kick-ipi",
+        _ => "",
+    }
+}
+
+/// The PCI device class behind IRQ line `irq`, if any.
+fn line_owner(devices: &[pci::PciDevice], irq: u8) -> Option<(u8, u8)> {
+    devices.iter()
+        .find(|d| d.interrupt_pin != 0 && d.interrupt_line == irq)
+        .map(|d| (d.class_code, d.subclass))
+}
+
+/// How the balancer may treat an IRQ.
+enum Placement {
+    /// Counts towards the load of whichever CPU took it.
+    Fixed,
+    /// Delivered to one CPU that the balancer may change.
+    Movable { cpu: usize, msi: bool },
+}
+
+fn placement(b: &Balancer, devices: &[pci::PciDevice], msi: &[pci::MsiInfo], irq: u8) -> Placement {
+    if irq < 16 {
+        let line = b.lines[irq as usize];
+        match line_owner(devices, irq) {
+            Some((c, s)) if !line.pinned && movable_class(c, s) && irq::is_registered(irq) => {
+                Placement::Movable { cpu: line.cpu as usize, msi: false }
+            }
+            _ => Placement::Fixed,
+        }
+    } else if irq >= MSI_IRQ_BASE {
+        match msi.iter().find(|m| m.irq == irq) {
+            Some(m) if m.affinity == IrqAffinity::Spread => Placement::Movable { cpu: m.cpu, msi: true },
+            _ => Placement::Fixed,
+        }
+    } else {
+        Placement::Fixed
+    }
+}
+
+fn move_irq(b: &mut Balancer, irq: u8, cpu: usize, msi: bool) {
+    if msi {
+        pci::set_irq_affinity(irq, cpu);
+    } else {
+        ioapic::set_irq_destination(irq, smp::lapic_id_of(cpu));
+        b.lines[irq as usize].cpu = cpu as u8;
+    }
+}
+
+/// One balancing pass.  Called periodically by the `cpu_monitor` thread.
+pub fn balance() {
+    let cpus = (smp::cpu_count() as usize).min(MAX_CPUS);
+    if !apic::is_initialized() || cpus < 2 {
+        return;
+    }
+    let devices = pci::devices();
+    let msi = pci::msi_routes();
+
+    let mut b = BALANCER.lock();
+    let now = crate::arch::hal::timer_current_ticks();
+    let elapsed = now.wrapping_sub(b.last_tick).max(1);
+    b.last_tick = now;
+    let hz = crate::arch::hal::timer_frequency_hz() as u64;
+    let per_sec = |n: u32| (n as u64 * hz / elapsed as u64).min(u32::MAX as u64) as u32;
+
+    // Interrupt rate per CPU from fixed vectors, and the movable candidates
+    let mut load = [0u32; MAX_CPUS];
+    let mut movable: Vec<(u8, u32, usize, bool)> = Vec::new();
+    for irq in 0..MAX_IRQS as u8 {
+        let mut total = 0u32;
+        let mut delta = [0u32; MAX_CPUS];
+        for cpu in 0..cpus {
+            let c = irq::count(irq, cpu);
+            delta[cpu] = c.wrapping_sub(b.prev[irq as usize][cpu]);
+            b.prev[irq as usize][cpu] = c;
+            total = total.saturating_add(delta[cpu]);
+        }
+        if total == 0 {
+            continue;
+        }
+        match placement(&b, &devices, &msi, irq) {
+            Placement::Fixed => {
+                for cpu in 0..cpus {
+                    load[cpu] = load[cpu].saturating_add(per_sec(delta[cpu]));
+                }
+            }
+            Placement::Movable { cpu, msi } => movable.push((irq, per_sec(total), cpu, msi)),
+        }
+    }
+
+    // Place the busiest vectors first; each stays unless moving it to the
+    // least loaded CPU takes a real share of the imbalance away.
+    movable.sort_unstable_by(|a, b| b.1.cmp(&a.1));
+    for (irq, rate, cur, msi) in movable {
+        let cur = cur.min(cpus - 1);
+        let best = (0..cpus).min_by_key(|&c| load[c]).unwrap_or(cur);
+        let target = if rate >= MIN_RATE && load[cur] > load[best].saturating_add(rate / 2) {
+            best
+        } else {
+            cur
+        };
+        if target != cur {
+            move_irq(&mut b, irq, target, msi);
+            crate::serial_println!("  IRQ {}: CPU{} -> CPU{} ({}/s)", irq, cur, target, rate);
+        }
+        load[target] = load[target].saturating_add(rate);
+    }
+}
+
+/// Bind `irq` to `cpu`, or hand it back to the balancer with `None`.
+/// Only device vectors can be moved; returns false for anything else.
+pub fn set_affinity(irq: u8, cpu: Option<usize>) -> bool {
+    let cpus = smp::cpu_count() as usize;
+    if matches!(cpu, Some(c) if c >= cpus) || !apic::is_initialized() {
+        return false;
+    }
+    if irq >= MSI_IRQ_BASE {
+        let affinity = match cpu {
+            Some(c) => IrqAffinity::Cpu(c),
+            None => IrqAffinity::Spread,
+        };
+        return pci::pin_irq(irq, affinity);
+    }
+    if irq >= 16 {
+        return false;
+    }
+    let devices = pci::devices();
+    if line_owner(&devices, irq).is_none() || !irq::is_registered(irq) {
+        return false;
+    }
+    let mut b = BALANCER.lock();
+    b.lines[irq as usize].pinned = cpu.is_some();
+    if let Some(c) = cpu {
+        move_irq(&mut b, irq, c, false);
+    }
+    true
+}
+
+/// Fill `out` with every IRQ that has a handler or has fired.
+/// Returns the number of records available (may exceed `out.len()`).
+pub fn snapshot(out: &mut [IrqRecord]) -> usize {
+    let devices = pci::devices();
+    let msi = pci::msi_routes();
+    let b = BALANCER.lock();
+    let cpus = (smp::cpu_count() as usize).clamp(1, MAX_CPUS);
+
+    let mut n = 0;
+    for irq in 0..MAX_IRQS as u8 {
+        let mut counts = [0u32; MAX_CPUS];
+        for cpu in 0..cpus {
+            counts[cpu] = irq::count(irq, cpu);
+        }
+        if !irq::is_registered(irq) && counts.iter().all(|&c| c == 0) {
+            continue;
+        }
+
+        let (kind, cpu, label) = if irq < 16 {
+            let label = match line_owner(&devices, irq) {
+                Some((c, s)) => class_label(c, s),
+                None => local_label(irq),
+            };
+            (KIND_LINE, b.lines[irq as usize].cpu, label)
+        } else if irq < MSI_IRQ_BASE {
+            (KIND_LOCAL, 0xFF, local_label(irq))
+        } else {
+            match msi.iter().find(|m| m.irq == irq) {
+                Some(m) => (KIND_MSI, m.cpu as u8, class_label(m.class, m.subclass)),
+                None => (KIND_MSI, 0, ""),
+            }
+        };
+        let mut flags = 0;
+        if kind == KIND_LINE && b.lines[irq as usize].pinned {
+            flags |= FLAG_PINNED;
+        }
+        if msi.iter().any(|m| m.irq == irq && matches!(m.affinity, IrqAffinity::Cpu(_))) {
+            flags |= FLAG_PINNED;
+        }
+        if let Placement::Movable { .. } = placement(&b, &devices, &msi, irq) {
+            flags |= FLAG_BALANCED;
+        }
+
+        if n < out.len() {
+            let mut name = [0u8; 12];
+            let len = label.len().min(name.len());
+            name[..len].copy_from_slice(&label.as_bytes()[..len]);
+            out[n] = IrqRecord { irq, kind, cpu, flags, name, counts };
+        }
+        n += 1;
+    }
+    n
+}
@@ -0,0 +1,246 @@
+//! Tickless one-shot LAPIC timer.
+//!
+//! The LAPIC timer runs in one-shot mode instead of periodic.  A CPU with
+//! work re-arms it for the next point of its 1 ms scheduler-tick grid, so
+//! busy CPUs are preempted exactly as before.  A CPU that goes idle while no
+//! run queue holds work *stops its tick*: it arms only for the next sleeper
+//! deadline (CPU 0) or [`IDLE_MAX_MS`], and is woken early by a kick IPI when
+//! a thread is made ready.  Grid points skipped while stopped are credited
+//! as idle ticks, so CPU-load accounting does not change.
+//!
+//! Sleeper deadlines come from the scheduler's timer heap in nanoseconds
+//! ([`set_next_event`]).  CPU 0 owns them and arms for
+//! `min(next tick, next deadline)`, which gives sub-millisecond sleeps
+//! without raising the tick rate.
+//!
+//! TSC-deadline mode (CPUID.1:ECX[24]) is preferred — deadlines are absolute
+//! TSC values.  Otherwise the one-shot count is derived from the LAPIC rate
+//! measured in [`apic::calibrate_timer`](super::apic::calibrate_timer).
+
+use crate::arch::x86::apic;
+use crate::arch::x86::pit::{self, rdtsc, TICK_HZ};
+use crate::arch::x86::smp::{current_cpu_id, MAX_CPUS};
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
+
+/// Longest a stopped CPU sleeps without a timer event (keeps reaping,
+/// deferred page-directory destruction and watchdogs alive).
+const IDLE_MAX_MS: u64 = 1000;
+
+/// CPUs running the one-shot timer (bit per CPU index).
+static ACTIVE: AtomicU32 = AtomicU32::new(0);
+/// CPUs whose scheduler tick is stopped (idle, nothing queued anywhere).
+static STOPPED: AtomicU32 = AtomicU32::new(0);
+/// CPUs with a kick IPI in flight (dedups kicks until the target re-arms).
+static KICK_PENDING: AtomicU32 = AtomicU32::new(0);
+/// TSC-deadline mode (true) or LAPIC count mode (false); same on all CPUs.
+static DEADLINE_MODE: AtomicBool = AtomicBool::new(false);
+/// TSC cycles per scheduler tick.
+static TSC_PER_TICK: AtomicU64 = AtomicU64::new(0);
+/// Earliest sleeper deadline as absolute TSC (`u64::MAX` = none).
+static NEXT_EVENT: AtomicU64 = AtomicU64::new(u64::MAX);
+
+/// Next tick-grid point per CPU (absolute TSC).
+static NEXT_TICK: [AtomicU64; MAX_CPUS] = {
+    const INIT: AtomicU64 = AtomicU64::new(0);
+    [INIT; MAX_CPUS]
+};
+/// Deadline the hardware timer is currently armed for, per CPU.
+static ARMED: [AtomicU64; MAX_CPUS] = {
+    const INIT: AtomicU64 = AtomicU64::new(u64::MAX);
+    [INIT; MAX_CPUS]
+};
+
+/// Register the kick IPI handler (IRQ 22 = INT 54).
+pub fn register_kick_ipi() {
+    crate::arch::x86::irq::register_irq(22, kick_ipi_handler);
+}
+
+/// IRQ 22 handler: a stopped CPU was given work (or CPU 0 a new deadline).
+fn kick_ipi_handler(_irq: u8) {
+    let cpu = current_cpu_id() as usize;
+    if is_active(cpu) {
+        // Tick again from here on, so a kick whose schedule_inner bails on
+        // a contended lock is retried on the next grid point.
+        let crossed = advance_grid(cpu, rdtsc());
+        if STOPPED.load(Ordering::Relaxed) & (1 << cpu) != 0 {
+            crate::task::scheduler::account_idle_ticks(cpu, crossed);
+        }
+        arm(cpu, NEXT_TICK[cpu].load(Ordering::Relaxed));
+    }
+    crate::task::scheduler::schedule_timer_event();
+}
+
+#[inline]
+fn is_active(cpu: usize) -> bool {
+    cpu < MAX_CPUS && ACTIVE.load(Ordering::Relaxed) & (1 << cpu) != 0
+}
+
+/// Switch the calling CPU's LAPIC timer to one-shot operation.
+///
+/// Returns `false` (caller falls back to the periodic timer) when the TSC is
+/// uncalibrated or, without TSC-deadline support, the LAPIC rate is unknown.
+pub fn start_cpu() -> bool {
+    let tsc_hz = pit::tsc_hz();
+    let deadline_mode = crate::arch::x86::cpuid::features().tsc_deadline;
+    if tsc_hz == 0 || (!deadline_mode && apic::timer_rate_hz() == 0) {
+        return false;
+    }
+    let cpu = current_cpu_id() as usize;
+    if cpu >= MAX_CPUS {
+        return false;
+    }
+
+    let per_tick = tsc_hz / TICK_HZ as u64;
+    TSC_PER_TICK.store(per_tick, Ordering::Relaxed);
+    DEADLINE_MODE.store(deadline_mode, Ordering::Relaxed);
+    apic::timer_set_oneshot(deadline_mode);
+
+    let first = rdtsc() + per_tick;
+    NEXT_TICK[cpu].store(first, Ordering::Relaxed);
+    ACTIVE.fetch_or(1 << cpu, Ordering::Release);
+    arm(cpu, first);
+
+    if cpu == 0 {
+        crate::serial_println!(
+            "  LAPIC timer: tickless one-shot ({} mode)",
+            if deadline_mode { "TSC-deadline" } else { "count" },
+        );
+    }
+    true
+}
+
+/// Program the calling CPU's timer for absolute TSC `deadline`.
+fn arm(cpu: usize, deadline: u64) {
+    ARMED[cpu].store(deadline, Ordering::Relaxed);
+    if DEADLINE_MODE.load(Ordering::Relaxed) {
+        apic::timer_arm_deadline(deadline);
+    } else {
+        let delta = deadline.saturating_sub(rdtsc());
+        let count = delta as u128 * apic::timer_rate_hz() as u128 / pit::tsc_hz().max(1) as u128;
+        apic::timer_arm_count(count.min(u32::MAX as u128) as u32);
+    }
+}
+
+/// Move `cpu`'s tick grid past `now`; returns the number of grid points
+/// crossed.  A small slack absorbs count-mode interrupts that land early.
+fn advance_grid(cpu: usize, now: u64) -> u32 {
+    let per_tick = TSC_PER_TICK.load(Ordering::Relaxed);
+    let next = NEXT_TICK[cpu].load(Ordering::Relaxed);
+    let now = now + per_tick / 64;
+    if now < next {
+        return 0;
+    }
+    let crossed = (now - next) / per_tick + 1;
+    NEXT_TICK[cpu].store(next + crossed * per_tick, Ordering::Relaxed);
+    crossed.min(u32::MAX as u64) as u32
+}
+
+/// LAPIC timer interrupt.  Returns `false` if this CPU runs the periodic
+/// timer, in which case the caller does a plain `schedule_tick()`.
+pub fn on_interrupt() -> bool {
+    let cpu = current_cpu_id() as usize;
+    if !is_active(cpu) {
+        return false;
+    }
+    let crossed = advance_grid(cpu, rdtsc());
+    // Stay armed even if the scheduler below bails (re-entered or lock
+    // contended); schedule_inner re-arms for idle or a deadline as needed.
+    arm(cpu, NEXT_TICK[cpu].load(Ordering::Relaxed));
+
+    if STOPPED.load(Ordering::Relaxed) & (1 << cpu) != 0 {
+        crate::task::scheduler::account_idle_ticks(cpu, crossed);
+        crate::task::scheduler::schedule_timer_event();
+    } else if crossed > 0 {
+        crate::task::scheduler::schedule_tick();
+    } else {
+        // Sleeper deadline between two ticks.
+        crate::task::scheduler::schedule_timer_event();
+    }
+    true
+}
+
+/// Re-arm `cpu` (the caller's CPU) at the end of a scheduling decision.
+///
+/// `keep_tick` is true when the CPU runs a thread or any run queue holds
+/// work it might steal; otherwise the tick is stopped.  Must be called with
+/// the SCHEDULER lock held, so a concurrent [`kick`] either sees the CPU
+/// stopped or the CPU sees the newly queued thread.
+pub fn reprogram(cpu: usize, keep_tick: bool) {
+    if !is_active(cpu) {
+        return;
+    }
+    let bit = 1u32 << cpu;
+    let now = rdtsc();
+    let crossed = advance_grid(cpu, now);
+    if STOPPED.load(Ordering::Relaxed) & bit != 0 {
+        crate::task::scheduler::account_idle_ticks(cpu, crossed);
+    }
+
+    let mut deadline = if keep_tick {
+        STOPPED.fetch_and(!bit, Ordering::Relaxed);
+        NEXT_TICK[cpu].load(Ordering::Relaxed)
+    } else {
+        STOPPED.fetch_or(bit, Ordering::Relaxed);
+        now + IDLE_MAX_MS * (pit::tsc_hz() / 1000)
+    };
+    KICK_PENDING.fetch_and(!bit, Ordering::Relaxed);
+    if cpu == 0 {
+        deadline = deadline.min(NEXT_EVENT.load(Ordering::Relaxed));
+    }
+    if ARMED[cpu].load(Ordering::Relaxed) != deadline || deadline <= now {
+        arm(cpu, deadline);
+    }
+}
+
+/// A thread was made ready on `cpu`'s queue: make sure someone will run it.
+///
+/// Wakes `cpu` if its tick is stopped; otherwise wakes one stopped CPU so
+/// it keeps ticking and can steal the work.
+pub fn kick(cpu: usize) {
+    let stopped = STOPPED.load(Ordering::Relaxed);
+    if stopped == 0 {
+        return;
+    }
+    let target = if cpu < MAX_CPUS && stopped & (1 << cpu) != 0 {
+        cpu
+    } else {
+        stopped.trailing_zeros() as usize
+    };
+    wake_cpu(target);
+}
+
+/// Restart the tick on `cpu` if it is stopped.
+pub fn wake_cpu(cpu: usize) {
+    if cpu >= MAX_CPUS || STOPPED.load(Ordering::Relaxed) & (1 << cpu) == 0 {
+        return;
+    }
+    send_kick(cpu);
+}
+
+fn send_kick(cpu: usize) {
+    if KICK_PENDING.fetch_or(1 << cpu, Ordering::Relaxed) & (1 << cpu) != 0 {
+        return;
+    }
+    if cpu == current_cpu_id() as usize {
+        // Fires as soon as this CPU re-enables interrupts.
+        arm(cpu, rdtsc());
+    } else {
+        apic::send_ipi(crate::arch::x86::smp::lapic_id_of(cpu), apic::VECTOR_IPI_TIMER);
+    }
+}
+
+/// Publish the earliest sleeper deadline (`monotonic_ns`, `u64::MAX` = none).
+///
+/// CPU 0 picks it up on its next re-arm; when the new deadline is earlier
+/// than what CPU 0 is armed for and another CPU set it, CPU 0 is kicked.
+pub fn set_next_event(ns: u64) {
+    let tsc = pit::ns_to_tsc(ns);
+    let old = NEXT_EVENT.swap(tsc, Ordering::Relaxed);
+    if tsc < old
+        && is_active(0)
+        && tsc < ARMED[0].load(Ordering::Relaxed)
+        && current_cpu_id() != 0
+    {
+        send_kick(0);
+    }
+}
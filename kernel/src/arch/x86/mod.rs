@@ -10,9 +10,12 @@ pub mod gdt;
 pub mod idt;
 pub mod ioapic;
 pub mod irq;
+pub mod irq_balance;
+pub mod lapic_timer;
 pub mod pat;
 pub mod pic;
 pub mod pit;
+pub mod pmu;
 pub mod port;
 pub mod smp;
 pub mod power;
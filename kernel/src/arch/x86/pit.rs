@@ -205,6 +205,12 @@ pub fn tsc_hz() -> u64 {
     TSC_HZ.load(Ordering::Relaxed)
 }
 
+/// Return the TSC value that corresponds to tick 0 (0 before calibration).
+#[inline]
+pub fn tsc_boot() -> u64 {
+    TSC_BOOT.load(Ordering::Relaxed)
+}
+
 /// Busy-wait for the specified number of milliseconds.
 /// Uses tick-based polling so the CPU stays responsive to NMIs.
 pub fn delay_ms(ms: u32) {
@@ -245,3 +251,43 @@ pub fn real_ms_since_boot() -> u64 {
         TICK_COUNT.load(Ordering::Relaxed) as u64
     }
 }
+
+/// Nanoseconds since boot, computed from TSC (same epoch as `get_ticks()`).
+///
+/// Falls back to the PIT IRQ counter (millisecond resolution) before TSC
+/// calibration.
+#[inline]
+pub fn monotonic_ns() -> u64 {
+    let tsc_hz = TSC_HZ.load(Ordering::Acquire);
+    if tsc_hz > 0 {
+        let delta = rdtsc().wrapping_sub(TSC_BOOT.load(Ordering::Relaxed));
+        (delta as u128 * 1_000_000_000 / tsc_hz as u128) as u64
+    } else {
+        TICK_COUNT.load(Ordering::Relaxed) as u64 * 1_000_000
+    }
+}
+
+/// Convert a [`monotonic_ns`] timestamp to an absolute TSC value.
+/// Returns `u64::MAX` for `u64::MAX` (no deadline) or before calibration.
+#[inline]
+pub fn ns_to_tsc(ns: u64) -> u64 {
+    let tsc_hz = TSC_HZ.load(Ordering::Acquire);
+    if ns == u64::MAX || tsc_hz == 0 {
+        return u64::MAX;
+    }
+    let delta = (ns as u128 * tsc_hz as u128 / 1_000_000_000) as u64;
+    TSC_BOOT.load(Ordering::Relaxed).saturating_add(delta)
+}
+
+/// Stop taking PIT IRQ 0 once the TSC is calibrated (APIC mode only).
+///
+/// After calibration nothing reads `TICK_COUNT` and the boot spinner is gone,
+/// so the 1000 Hz PIT interrupt is pure overhead on CPU 0.  With TSC
+/// calibration broken the PIT stays the timebase and is left running.
+pub fn retire_irq() {
+    if TSC_HZ.load(Ordering::Acquire) == 0 || !crate::arch::x86::apic::is_initialized() {
+        return;
+    }
+    crate::arch::x86::ioapic::mask_irq(0);
+    crate::serial_println!("[OK] PIT IRQ 0 masked (TSC is the timebase)");
+}
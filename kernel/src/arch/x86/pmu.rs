@@ -0,0 +1,134 @@
+//! Architectural performance-monitoring counters (Intel PMU, CPUID leaf 0xA).
+//!
+//! Only general-purpose counter 0 is used, counting unhalted core cycles.
+//! [`arm`] loads it with `-period` and routes its overflow to the LAPIC
+//! performance-counter LVT as an NMI, so a sample is taken every `period`
+//! cycles even inside IRQ-disabled kernel code.  CPUs without an
+//! architectural PMU (AMD, most emulators) report [`available`] `false`; the
+//! MSRs are never touched there.
+//!
+//! All functions act on the calling CPU only.
+
+use crate::arch::x86::apic;
+use crate::arch::x86::power::{rdmsr, wrmsr};
+use core::sync::atomic::{AtomicU32, Ordering};
+
+const IA32_PMC0: u32 = 0x0C1;
+const IA32_PERFEVTSEL0: u32 = 0x186;
+const IA32_PERF_GLOBAL_STATUS: u32 = 0x38E;
+const IA32_PERF_GLOBAL_CTRL: u32 = 0x38F;
+const IA32_PERF_GLOBAL_OVF_CTRL: u32 = 0x390;
+
+/// UnHalted Core Cycles (event 0x3C, umask 0).
+const EVENT_CORE_CYCLES: u64 = 0x3C;
+const EVTSEL_USR: u64 = 1 << 16;
+const EVTSEL_OS: u64 = 1 << 17;
+const EVTSEL_INT: u64 = 1 << 20;
+const EVTSEL_EN: u64 = 1 << 22;
+
+/// Longest period a 32-bit counter write can hold (writes sign-extend bit 31).
+pub const MAX_PERIOD: u64 = 0x7FFF_FFFF;
+
+/// PMU version (0 = none usable), set by [`init`].
+static VERSION: AtomicU32 = AtomicU32::new(0);
+/// Counter width in bits.
+static WIDTH: AtomicU32 = AtomicU32::new(0);
+/// CPUs with counter 0 armed (bit per CPU index).
+static ARMED: AtomicU32 = AtomicU32::new(0);
+
+fn cpu_bit() -> u32 {
+    1 << (crate::arch::x86::smp::current_cpu_id() as u32 % 32)
+}
+
+/// Detect the architectural PMU (BSP, once).
+pub fn init() {
+    if crate::arch::x86::cpuid::cpuid(0, 0).0 < 0xA {
+        return;
+    }
+    let (eax, ebx, _, _) = crate::arch::x86::cpuid::cpuid(0xA, 0);
+    let version = eax & 0xFF;
+    let counters = (eax >> 8) & 0xFF;
+    let width = (eax >> 16) & 0xFF;
+    let ebx_len = (eax >> 24) & 0xFF;
+    // EBX bit 0 set = core-cycles event not available
+    let cycles_ok = ebx_len > 0 && ebx & 1 == 0;
+    if version == 0 || counters == 0 || width < 32 || !cycles_ok {
+        return;
+    }
+    WIDTH.store(width, Ordering::Relaxed);
+    VERSION.store(version, Ordering::Relaxed);
+    crate::serial_println!("  PMU: arch perfmon v{}, {} counters x {} bits", version, counters, width);
+}
+
+/// True if overflow sampling can be used.
+pub fn available() -> bool {
+    VERSION.load(Ordering::Relaxed) != 0
+}
+
+/// Start counter 0: overflow NMI every `period` unhalted cycles.
+pub fn arm(period: u64) {
+    if !available() {
+        return;
+    }
+    let version = VERSION.load(Ordering::Relaxed);
+    unsafe {
+        wrmsr(IA32_PERFEVTSEL0, 0);
+        wrmsr(IA32_PMC0, reload_value(period));
+        apic::set_perf_lvt_nmi(true);
+        wrmsr(IA32_PERFEVTSEL0, EVENT_CORE_CYCLES | EVTSEL_USR | EVTSEL_OS | EVTSEL_INT | EVTSEL_EN);
+        if version >= 2 {
+            wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+            let ctrl = rdmsr(IA32_PERF_GLOBAL_CTRL);
+            wrmsr(IA32_PERF_GLOBAL_CTRL, ctrl | 1);
+        }
+    }
+    ARMED.fetch_or(cpu_bit(), Ordering::Relaxed);
+}
+
+/// Stop counter 0 and mask its NMI.
+pub fn disarm() {
+    if !available() {
+        return;
+    }
+    ARMED.fetch_and(!cpu_bit(), Ordering::Relaxed);
+    unsafe {
+        wrmsr(IA32_PERFEVTSEL0, 0);
+        if VERSION.load(Ordering::Relaxed) >= 2 {
+            wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+        }
+    }
+    apic::set_perf_lvt_nmi(false);
+}
+
+/// NMI path: if counter 0 overflowed, acknowledge it and return `true`.
+/// The caller then reloads with [`reload`] or stops with [`disarm`].
+pub fn take_overflow() -> bool {
+    if !available() || ARMED.load(Ordering::Relaxed) & cpu_bit() == 0 {
+        return false;
+    }
+    unsafe {
+        if VERSION.load(Ordering::Relaxed) >= 2 {
+            if rdmsr(IA32_PERF_GLOBAL_STATUS) & 1 == 0 {
+                return false;
+            }
+            wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+            true
+        } else {
+            // v1 has no status register: an armed counter is negative, so a
+            // clear top bit means it wrapped.
+            let width = WIDTH.load(Ordering::Relaxed);
+            rdmsr(IA32_PMC0) & (1u64 << (width - 1)) == 0
+        }
+    }
+}
+
+/// Reload counter 0 after an overflow and unmask the LVT (delivery masks it).
+pub fn reload(period: u64) {
+    unsafe { wrmsr(IA32_PMC0, reload_value(period)); }
+    apic::set_perf_lvt_nmi(true);
+}
+
+fn reload_value(period: u64) -> u64 {
+    // Only bits 31:0 are written; bit 31 is sign-extended to the width.
+    period.clamp(1, MAX_PERIOD).wrapping_neg() & 0xFFFF_FFFF
+}
@@ -5,6 +5,7 @@
 
 use core::sync::atomic::{AtomicU8, AtomicU32, AtomicU64, Ordering};
 use crate::arch::x86::acpi::ProcessorInfo;
+use crate::sync::spinlock::Spinlock;
 
 /// Maximum number of CPUs supported
 pub const MAX_CPUS: usize = 16;
@@ -225,6 +226,10 @@ extern "C" fn ap_entry() -> ! {
     // Without this, context_switch's `mov cr3, rax` with PCID bits would #GP.
     crate::memory::virtual_mem::enable_pcid();
 
+    // CR0.WP is per-CPU too: without it ring-0 writes ignore read-only PTEs
+    // and would scribble over frames shared copy-on-write after fork.
+    crate::memory::virtual_mem::enable_write_protect();
+
     // Initialize per-AP power management (HWP / P-state)
     crate::arch::x86::power::init_ap();
 
@@ -309,6 +314,11 @@ pub fn cpu_count() -> u8 {
     CPU_COUNT.load(Ordering::SeqCst)
 }
 
+/// LAPIC ID of the CPU with logical index `cpu`.
+pub fn lapic_id_of(cpu: usize) -> u8 {
+    unsafe { CPU_DATA[cpu].lapic_id }
+}
+
 /// Get the current CPU's index (0 = BSP).
 ///
 /// Three tiers, fastest first:
@@ -353,12 +363,85 @@ pub fn is_bsp() -> bool {
     current_cpu_id() == 0
 }
 
-/// Virtual address to invalidate in the TLB shootdown IPI handler.
-/// `u64::MAX` means "full TLB flush" (invpcid/CR3 reload).
-static TLB_FLUSH_VA: AtomicU64 = AtomicU64::new(u64::MAX);
+// =============================================================================
+// TLB shootdown
+// =============================================================================
+//
+// Every CPU owns a small queue of pending invalidations.  A sender appends a
+// range to the queue of each CPU that may cache the address space, sends one
+// IPI per CPU whose queue was empty (a non-empty queue already has an IPI in
+// flight), and waits until that CPU's completion generation passes the one
+// its entry was queued under.  Concurrent senders therefore share IPIs, and a
+// whole `munmap` costs one IPI per CPU instead of one per page.
+//
+// User ranges only go to CPUs whose `ACTIVE_PD` is the address space being
+// changed.  With PCID, CPUs that ran it earlier may still hold entries tagged
+// with its PCID; those get a bit in `PCID_STALE` instead of an IPI and flush
+// that PCID when they next switch to it (see `activate_address_space`).
+
+/// Shootdown sentinel: flush all TLB entries of all PCIDs (including globals).
+///
+/// Needed when page tables of an address space that is *not* necessarily
+/// current on the remote CPU change, e.g. fork marking the parent's pages
+/// copy-on-write: with PCID the remote CPU may still hold tagged entries for
+/// that address space and would reuse them on its next NOFLUSH CR3 load.
+pub const TLB_FLUSH_ALL_CONTEXTS: u64 = u64::MAX - 1;
+
+/// Ranges longer than this are flushed with a CR3 reload instead of invlpg.
+const TLB_RANGE_FULL_FLUSH: u64 = 32;
+/// Pending ranges per CPU before the queue collapses into a full flush.
+const TLB_QUEUE_LEN: usize = 8;
+/// User page directories are physical addresses; 0 tags kernel-half ranges.
+const TLB_KERNEL_PD: u64 = 0;
+/// Physical-address bits of CR3.
+const CR3_ADDR_MASK: u64 = 0x000F_FFFF_FFFF_F000;
+
+#[derive(Clone, Copy)]
+struct TlbRange {
+    /// PML4 physical address the range belongs to (`TLB_KERNEL_PD` = any).
+    pd: u64,
+    start: u64,
+    /// Page count; `u64::MAX` requests a flush of the whole address space.
+    pages: u64,
+}
 
-/// Number of CPUs that still need to acknowledge the TLB shootdown.
-static TLB_ACK_COUNT: AtomicU32 = AtomicU32::new(0);
+struct TlbQueue {
+    ranges: [TlbRange; TLB_QUEUE_LEN],
+    len: usize,
+    /// Overflowed or explicitly requested: drop every PCID's entries.
+    flush_all: bool,
+    /// Generation of the newest queued request.
+    gen: u64,
+}
+
+static TLB_QUEUES: [Spinlock<TlbQueue>; MAX_CPUS] = {
+    const INIT: Spinlock<TlbQueue> = Spinlock::new(TlbQueue {
+        ranges: [TlbRange { pd: 0, start: 0, pages: 0 }; TLB_QUEUE_LEN],
+        len: 0,
+        flush_all: false,
+        gen: 0,
+    });
+    [INIT; MAX_CPUS]
+};
+
+/// Highest queue generation each CPU has finished flushing.
+static TLB_DONE_GEN: [AtomicU64; MAX_CPUS] = {
+    const INIT: AtomicU64 = AtomicU64::new(0);
+    [INIT; MAX_CPUS]
+};
+
+/// PML4 physical address each CPU currently runs on (0 = not yet known).
+static ACTIVE_PD: [AtomicU64; MAX_CPUS] = {
+    const INIT: AtomicU64 = AtomicU64::new(0);
+    [INIT; MAX_CPUS]
+};
+
+/// Per-CPU bitmap of PCIDs whose cached entries may be stale (4096 bits).
+static PCID_STALE: [[AtomicU64; 64]; MAX_CPUS] = {
+    const BIT: AtomicU64 = AtomicU64::new(0);
+    const ROW: [AtomicU64; 64] = [BIT; 64];
+    [ROW; MAX_CPUS]
+};
 
 /// Register the TLB shootdown IPI handler (IRQ 20 = INT 52).
 /// Must be called after IDT is initialized (same time as halt IPI).
@@ -366,63 +449,233 @@ pub fn register_tlb_shootdown_ipi() {
     crate::arch::x86::irq::register_irq(20, tlb_shootdown_ipi_handler);
 }
 
-/// IRQ 20 handler: invalidate the TLB entry for `TLB_FLUSH_VA` and acknowledge.
+/// IRQ 20 handler: drain this CPU's shootdown queue.
 fn tlb_shootdown_ipi_handler(_irq: u8) {
-    let va = TLB_FLUSH_VA.load(Ordering::Acquire);
-    unsafe {
-        if va == u64::MAX {
-            // Full TLB flush via CR3 reload (flushes all non-global entries)
-            let cr3: u64;
-            core::arch::asm!("mov {}, cr3", out(reg) cr3, options(nostack, nomem));
-            core::arch::asm!("mov cr3, {}", in(reg) cr3, options(nostack, nomem));
-        } else {
-            core::arch::asm!("invlpg [{}]", in(reg) va, options(nostack, preserves_flags));
+    drain_tlb_queue(current_cpu_id() as usize);
+}
+
+/// Perform and acknowledge every invalidation queued for `cpu` (the caller's CPU).
+fn drain_tlb_queue(cpu: usize) {
+    let (ranges, len, flush_all, gen) = {
+        let mut q = TLB_QUEUES[cpu].lock();
+        let snapshot = (q.ranges, q.len, q.flush_all, q.gen);
+        q.len = 0;
+        q.flush_all = false;
+        snapshot
+    };
+
+    if flush_all {
+        crate::memory::virtual_mem::flush_tlb_all_contexts();
+    } else {
+        let cr3: u64;
+        unsafe { core::arch::asm!("mov {}, cr3", out(reg) cr3, options(nostack, nomem)); }
+        flush_ranges_local(&ranges[..len], cr3);
+    }
+
+    TLB_DONE_GEN[cpu].fetch_max(gen, Ordering::Release);
+}
+
+/// Apply `ranges` to this CPU's TLB, which is running on page table `cr3`.
+fn flush_ranges_local(ranges: &[TlbRange], cr3: u64) {
+    let current_pd = cr3 & CR3_ADDR_MASK;
+    // CR3 reload drops the current PCID's non-global entries; a PGE toggle
+    // drops everything.
+    let mut user_flushed = false;
+    let mut all_flushed = false;
+    for r in ranges {
+        if all_flushed {
+            break;
+        }
+        let kernel = r.pd == TLB_KERNEL_PD;
+        if !kernel && (user_flushed || r.pd != current_pd) {
+            // A range of another address space means we switched away since
+            // the sender looked; its stale-PCID bit covers us.
+            continue;
+        }
+        if r.pages > TLB_RANGE_FULL_FLUSH {
+            if kernel {
+                crate::memory::virtual_mem::flush_tlb_all_contexts();
+                all_flushed = true;
+            } else {
+                unsafe { core::arch::asm!("mov cr3, {}", in(reg) cr3, options(nostack)); }
+                user_flushed = true;
+            }
+            continue;
+        }
+        for p in 0..r.pages {
+            let va = r.start + p * 4096;
+            unsafe { core::arch::asm!("invlpg [{}]", in(reg) va, options(nostack, preserves_flags)); }
         }
     }
-    TLB_ACK_COUNT.fetch_sub(1, Ordering::Release);
 }
 
-/// Send a TLB shootdown IPI to all other online CPUs and wait for acknowledgment.
-///
-/// `va` is the virtual address to invalidate.  Pass `u64::MAX` to request a
-/// full TLB flush on each remote CPU.  The caller must have already performed
-/// its own `invlpg` (or CR3 reload) for the same address.
+/// Queue `range` (or a full flush) on `cpu`; returns the generation to wait
+/// for and whether an IPI must be sent.
+fn enqueue_tlb(cpu: usize, range: Option<TlbRange>) -> (u64, bool) {
+    let mut q = TLB_QUEUES[cpu].lock();
+    let was_idle = q.len == 0 && !q.flush_all;
+    match range {
+        Some(r) if q.len < TLB_QUEUE_LEN && !q.flush_all => {
+            let n = q.len;
+            q.ranges[n] = r;
+            q.len = n + 1;
+        }
+        _ => {
+            q.flush_all = true;
+            q.len = 0;
+        }
+    }
+    q.gen += 1;
+    (q.gen, was_idle)
+}
+
+fn pcid_stale_bit(pcid: u16) -> (usize, u64) {
+    ((pcid as usize >> 6) & 63, 1u64 << (pcid & 63))
+}
+
+/// Record that `cpu` is about to run on page table `cr3` (PML4 | PCID).
 ///
-/// **Must not be called with IF=0 when other CPUs also have IF=0**, as the
-/// IPI delivery is held pending until the receiver enables interrupts — which
-/// would cause a deadlock.  All callers in this kernel (Thread::new/drop,
-/// unmap_page) run with IF=1 in kernel thread context.
-pub fn tlb_shootdown(va: u64) {
-    if !crate::arch::x86::apic::is_initialized() {
-        return; // Single-CPU or APIC not yet up
+/// Called by the scheduler with interrupts disabled right before the context
+/// switch loads CR3.  If a shootdown for this PCID was skipped while another
+/// address space was active here, the PCID is flushed first so none of its
+/// stale entries survive the NOFLUSH CR3 load.
+pub fn activate_address_space(cpu: usize, cr3: u64) {
+    if cpu >= MAX_CPUS {
+        return;
     }
-    let count = cpu_count() as u32;
-    if count <= 1 {
-        return; // Nothing to shoot down
+    let pd = cr3 & CR3_ADDR_MASK;
+    if ACTIVE_PD[cpu].load(Ordering::Relaxed) == pd {
+        return; // Still targeted by shootdowns for this address space
+    }
+    ACTIVE_PD[cpu].store(pd, Ordering::SeqCst);
+    // Pairs with the fence in `tlb_shootdown_range`: either the sender sees
+    // our new ACTIVE_PD and sends an IPI, or we see its stale bit here.
+    core::sync::atomic::fence(Ordering::SeqCst);
+    let pcid = (cr3 & 0xFFF) as u16;
+    if pcid == 0 {
+        return;
+    }
+    let (word, bit) = pcid_stale_bit(pcid);
+    if PCID_STALE[cpu][word].fetch_and(!bit, Ordering::AcqRel) & bit != 0 {
+        crate::memory::virtual_mem::flush_pcid(pcid);
     }
+}
 
-    let my_cpu = current_cpu_id();
-    let others = count - 1;
+/// Wait (with interrupts in any state) until each CPU has flushed up to its
+/// generation in `wait_gen` (0 = nothing queued there).
+///
+/// Keeps draining our own queue meanwhile, so two CPUs shooting down at
+/// each other with IF=0 cannot deadlock.
+fn wait_tlb_acks(wait_gen: &[u64; MAX_CPUS]) {
+    for (cpu, &gen) in wait_gen.iter().enumerate() {
+        while gen != 0 && TLB_DONE_GEN[cpu].load(Ordering::Acquire) < gen {
+            // Re-read the CPU each time: with IF=1 we may have migrated.
+            let flags = crate::arch::hal::save_and_disable_interrupts();
+            let me = current_cpu_id() as usize;
+            let pending = {
+                let q = TLB_QUEUES[me].lock();
+                q.len != 0 || q.flush_all
+            };
+            if pending {
+                drain_tlb_queue(me);
+            }
+            crate::arch::hal::restore_interrupt_state(flags);
+            core::hint::spin_loop();
+        }
+    }
+}
 
-    TLB_FLUSH_VA.store(va, Ordering::Release);
-    TLB_ACK_COUNT.store(others, Ordering::Release);
+fn send_tlb_ipi(cpu: usize) {
+    let lapic_id = unsafe { CPU_DATA[cpu].lapic_id };
+    crate::arch::x86::apic::send_ipi(lapic_id, crate::arch::x86::apic::VECTOR_IPI_TLB);
+}
 
-    // Ensure the stores are visible to other CPUs before IPIs arrive
-    core::sync::atomic::fence(Ordering::SeqCst);
+/// Invalidate `pages` pages starting at `start` on this CPU and on every
+/// other CPU that may have them cached.
+///
+/// User-half ranges refer to the current address space and only reach CPUs
+/// running it (others are flushed lazily per PCID); kernel-half ranges go to
+/// all CPUs.  Callers can therefore clear a whole batch of PTEs without
+/// per-page invlpg and flush once.  Must not be called while holding a
+/// spinlock that other CPUs may spin on with IF=0.
+pub fn tlb_shootdown_range(start: u64, pages: u64) {
+    if pages == 0 {
+        return;
+    }
+    // Pin to this CPU while flushing locally and queueing remote work, so a
+    // preemption cannot leave the CPU we end up on out of the target set.
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let cr3: u64;
+    unsafe { core::arch::asm!("mov {}, cr3", out(reg) cr3, options(nostack, nomem)); }
+    let pd = if start >= 0x0000_8000_0000_0000 { TLB_KERNEL_PD } else { cr3 & CR3_ADDR_MASK };
+    let range = TlbRange { pd, start, pages };
+    flush_ranges_local(core::slice::from_ref(&range), cr3);
+
+    let count = cpu_count() as usize;
+    let mut wait_gen = [0u64; MAX_CPUS];
+    if crate::arch::x86::apic::is_initialized() && count > 1 {
+        let my_cpu = current_cpu_id() as usize;
+        let pcid = (cr3 & 0xFFF) as u16;
+        if pd != TLB_KERNEL_PD && pcid != 0 {
+            let (word, bit) = pcid_stale_bit(pcid);
+            for cpu in (0..count).filter(|&c| c != my_cpu) {
+                PCID_STALE[cpu][word].fetch_or(bit, Ordering::Relaxed);
+            }
+        }
+        core::sync::atomic::fence(Ordering::SeqCst);
 
-    // Send IPI to every other online CPU
-    for i in 0..count as usize {
-        if i as u8 == my_cpu {
-            continue;
+        for cpu in (0..count).filter(|&c| c != my_cpu) {
+            if pd != TLB_KERNEL_PD && ACTIVE_PD[cpu].load(Ordering::SeqCst) != pd {
+                continue;
+            }
+            let (gen, need_ipi) = enqueue_tlb(cpu, Some(range));
+            wait_gen[cpu] = gen;
+            if need_ipi {
+                send_tlb_ipi(cpu);
+            }
         }
-        let lapic_id = unsafe { CPU_DATA[i].lapic_id };
-        crate::arch::x86::apic::send_ipi(lapic_id, crate::arch::x86::apic::VECTOR_IPI_TLB);
     }
+    crate::arch::hal::restore_interrupt_state(flags);
+    wait_tlb_acks(&wait_gen);
+}
 
-    // Spin until all remote CPUs have acknowledged
-    while TLB_ACK_COUNT.load(Ordering::Acquire) > 0 {
-        core::hint::spin_loop();
+/// Broadcast a single-address (or full) TLB invalidation to all CPUs.
+///
+/// `va` is the virtual address to invalidate.  Pass `u64::MAX` to request a
+/// full flush of the current address space, or [`TLB_FLUSH_ALL_CONTEXTS`] to
+/// make every other CPU drop entries of all PCIDs (the caller must already
+/// have flushed its own TLB in that case).
+pub fn tlb_shootdown(va: u64) {
+    if va == TLB_FLUSH_ALL_CONTEXTS {
+        tlb_shootdown_all_contexts();
+    } else if va == u64::MAX {
+        tlb_shootdown_range(0, u64::MAX);
+    } else {
+        tlb_shootdown_range(va & !0xFFF, 1);
+    }
+}
+
+/// Make every other CPU drop all TLB entries of all PCIDs.
+fn tlb_shootdown_all_contexts() {
+    if !crate::arch::x86::apic::is_initialized() {
+        return;
+    }
+    let count = cpu_count() as usize;
+    if count <= 1 {
+        return;
+    }
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let my_cpu = current_cpu_id() as usize;
+    let mut wait_gen = [0u64; MAX_CPUS];
+    for cpu in (0..count).filter(|&c| c != my_cpu) {
+        let (gen, need_ipi) = enqueue_tlb(cpu, None);
+        wait_gen[cpu] = gen;
+        if need_ipi {
+            send_tlb_ipi(cpu);
+        }
     }
+    crate::arch::hal::restore_interrupt_state(flags);
+    wait_tlb_acks(&wait_gen);
 }
 
 /// Register the halt IPI handler (IRQ 21 = INT 53).
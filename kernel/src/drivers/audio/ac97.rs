@@ -5,11 +5,13 @@
 //!
 //! Supports the Intel 82801AA AC'97 Audio Controller (PCI 8086:2415) and
 //! compatible devices. Uses DMA with a 32-entry Buffer Descriptor List (BDL)
-//! for PCM output at 48 kHz, 16-bit stereo.
+//! for PCM output at 48 kHz, 16-bit stereo, fed period by period from the
+//! [`super::mixer`].
 //!
 //! QEMU: `-device AC97 -audiodev coreaudio,id=audio0`
 
 use alloc::boxed::Box;
+use super::mixer::{self, PERIODS};
 use crate::arch::x86::port;
 use crate::memory::physical;
 use crate::sync::spinlock::Spinlock;
@@ -59,16 +61,12 @@ const GC_GPO_INT_ENABLE: u32 = 0x01;
 const GC_COLD_RESET: u32 = 0x02;
 const GC_WARM_RESET: u32 = 0x04;
 
-// BDL constants
+// BDL constants.  Entry `i` plays period buffer `i % PERIODS`, so the 32
+// entries loop over the period buffers.
 const BDL_ENTRIES: usize = 32;
 const BDL_IOC: u32 = 1 << 31;   // Interrupt On Completion
 const BDL_BUP: u32 = 1 << 30;   // Buffer Underrun Policy (fill with last sample)
 
-// Audio buffer size per BDL entry (in bytes)
-// 4096 bytes = 1024 sample frames (at 4 bytes each: L16 + R16)
-const BUF_SIZE: usize = 4096;
-const SAMPLES_PER_BUF: u32 = (BUF_SIZE / 2) as u32; // 16-bit samples count
-
 /// Buffer Descriptor List entry (8 bytes, must be #[repr(C)]).
 #[repr(C)]
 #[derive(Copy, Clone)]
@@ -83,8 +81,11 @@ struct Ac97State {
     nambar: u16,                  // Mixer I/O base (BAR0)
     nabmbar: u16,                 // Bus Master I/O base (BAR1)
     bdl_phys: u32,                // BDL physical address
-    bufs_phys: [u32; BDL_ENTRIES],// Audio buffer physical addresses
+    bufs_phys: [u32; PERIODS],    // Period buffer physical addresses (4 KiB each)
     write_idx: u8,                // Next BDL entry to fill
+    period: u32,                  // Period size of the current run (frames)
+    filled: u64,                  // Sample frames mixed since init
+    idle: u32,                    // Silent periods mixed in a row
     volume: u8,                   // 0-100
     playing: bool,
     irq: u8,
@@ -175,9 +176,9 @@ pub fn init_from_pci(pci: &PciDevice) {
         core::ptr::write_bytes(bdl_phys as *mut u8, 0, 4096);
     }
 
-    // Allocate audio buffers (one frame per BDL entry)
-    let mut bufs_phys = [0u32; BDL_ENTRIES];
-    for i in 0..BDL_ENTRIES {
+    // Allocate the period buffers (one page each)
+    let mut bufs_phys = [0u32; PERIODS];
+    for i in 0..PERIODS {
         let buf_frame = match physical::alloc_frame() {
             Some(f) => f,
             None => {
@@ -192,12 +193,12 @@ pub fn init_from_pci(pci: &PciDevice) {
         }
     }
 
-    // Set up BDL entries
+    // Set up BDL entries (lengths are set when the ring starts)
     let bdl_ptr = bdl_phys as *mut BdlEntry;
     for i in 0..BDL_ENTRIES {
         unsafe {
-            (*bdl_ptr.add(i)).buf_addr = bufs_phys[i];
-            (*bdl_ptr.add(i)).ctl_len = SAMPLES_PER_BUF | BDL_IOC;
+            (*bdl_ptr.add(i)).buf_addr = bufs_phys[i % PERIODS];
+            (*bdl_ptr.add(i)).ctl_len = BDL_IOC;
         }
     }
 
@@ -233,6 +234,9 @@ pub fn init_from_pci(pci: &PciDevice) {
             bdl_phys,
             bufs_phys,
             write_idx: 0,
+            period: mixer::period_frames(),
+            filled: 0,
+            idle: 0,
             volume: 80,
             playing: false,
             irq,
@@ -253,81 +257,139 @@ pub fn init_from_pci(pci: &PciDevice) {
     super::register(Box::new(Ac97Driver));
 }
 
-/// Write PCM data to the next available DMA buffer.
+// ── PCM Playback ────────────────────────────────────────────────────────────
+//
+// Entries CIV through LVI are queued.  Each completion interrupt fills the
+// entries after LVI until `PERIODS` are queued again, mixing into the
+// period buffer the completed entry used, and moves LVI along.  Once a
+// whole ring of silent periods is queued LVI stays put and the engine
+// halts at it; the next write starts it again.
+
+/// Entries and sample frames the DMA engine has still to play.
 ///
-/// `data` must contain 16-bit signed LE stereo samples (4 bytes per frame).
-/// Returns the number of bytes actually consumed.
-pub fn write_pcm(data: &[u8]) -> usize {
-    let mut guard = AC97.lock();
-    let state = match guard.as_mut() {
-        Some(s) => s,
-        None => return 0,
-    };
+/// The current entry has PICB samples left.  A halted engine has played
+/// everything.
+fn pending(state: &Ac97State) -> (usize, u64) {
+    if !state.playing {
+        return (0, 0);
+    }
+    let sr = unsafe { port::inw(state.nabmbar + NABM_PO_SR) };
+    if sr & SR_DCH != 0 {
+        return (0, 0);
+    }
+    let civ = unsafe { port::inb(state.nabmbar + NABM_PO_CIV) } as usize % BDL_ENTRIES;
+    let entries = (state.write_idx as usize + BDL_ENTRIES - civ) % BDL_ENTRIES;
+    let picb = unsafe { port::inw(state.nabmbar + NABM_PO_PICB) } as u64 / 2;
+    (entries, picb + entries.saturating_sub(1) as u64 * state.period as u64)
+}
 
-    let mut written = 0usize;
+/// Mix the next period into entry `write_idx` and make it the last valid.
+fn fill_entry(state: &mut Ac97State) {
+    let idx = state.write_idx as usize;
+    // Physical = virtual in identity-mapped low memory
+    let out = unsafe {
+        core::slice::from_raw_parts_mut(state.bufs_phys[idx % PERIODS] as *mut u32, state.period as usize)
+    };
+    if mixer::mix(out) {
+        state.idle = 0;
+    } else {
+        state.idle += 1;
+    }
+    unsafe {
+        port::outb(state.nabmbar + NABM_PO_LVI, idx as u8);
+    }
+    state.filled += state.period as u64;
+    state.write_idx = ((idx + 1) % BDL_ENTRIES) as u8;
+}
 
-    while written < data.len() {
-        let remaining = data.len() - written;
-        let chunk = remaining.min(BUF_SIZE);
+/// Refill completed entries; notice a halted engine.
+fn refill(state: &mut Ac97State) {
+    if !state.playing {
+        return;
+    }
+    let (queued, _) = pending(state);
+    if queued == 0 {
+        state.playing = false;
+        return;
+    }
+    let mut queued = queued;
+    while queued < PERIODS && (state.idle as usize) < PERIODS {
+        fill_entry(state);
+        queued += 1;
+    }
+}
 
-        let idx = state.write_idx as usize;
-        let buf_ptr = state.bufs_phys[idx] as *mut u8;
+/// Reset the PCM Out channel so CIV restarts at 0.
+unsafe fn reset_channel(state: &Ac97State) {
+    let cr = port::inb(state.nabmbar + NABM_PO_CR);
+    port::outb(state.nabmbar + NABM_PO_CR, cr & !CR_RPBM);
+    port::outb(state.nabmbar + NABM_PO_CR, CR_RR);
+    for _ in 0..100 {
+        port::io_wait();
+    }
+    port::outb(state.nabmbar + NABM_PO_CR, 0);
+    port::outl(state.nabmbar + NABM_PO_BDBAR, state.bdl_phys);
+    port::outw(state.nabmbar + NABM_PO_SR, SR_LVBCI | SR_BCIS | SR_FIFOE);
+}
 
-        // Copy PCM data into DMA buffer
-        unsafe {
-            core::ptr::copy_nonoverlapping(
-                data[written..].as_ptr(),
-                buf_ptr,
-                chunk,
-            );
-            // If chunk < BUF_SIZE, zero the remainder
-            if chunk < BUF_SIZE {
-                core::ptr::write_bytes(buf_ptr.add(chunk), 0, BUF_SIZE - chunk);
-            }
-        }
+/// Start the ring with the mixer's current period size, prefilled.
+pub fn start() {
+    let mut guard = AC97.lock();
+    let state = match guard.as_mut() {
+        Some(s) => s,
+        None => return,
+    };
+    refill(state);
+    if state.playing {
+        return;
+    }
 
-        // Update BDL entry sample count
-        let sample_count = (chunk / 2) as u32; // 16-bit samples
+    state.period = mixer::period_frames();
+    unsafe {
+        reset_channel(state);
         let bdl_ptr = state.bdl_phys as *mut BdlEntry;
-        unsafe {
-            (*bdl_ptr.add(idx)).ctl_len = sample_count | BDL_IOC;
-        }
-
-        // Advance LVI to tell hardware about the new buffer
-        unsafe {
-            port::outb(state.nabmbar + NABM_PO_LVI, state.write_idx);
-        }
-
-        state.write_idx = ((state.write_idx as usize + 1) % BDL_ENTRIES) as u8;
-        written += chunk;
-
-        // Start playback if not already running
-        if !state.playing {
-            unsafe {
-                let cr = port::inb(state.nabmbar + NABM_PO_CR);
-                port::outb(state.nabmbar + NABM_PO_CR, cr | CR_RPBM | CR_IOCE | CR_LVBIE);
-            }
-            state.playing = true;
+        for i in 0..BDL_ENTRIES {
+            (*bdl_ptr.add(i)).ctl_len = (state.period * 2) | BDL_IOC;
         }
     }
+    state.write_idx = 0;
+    state.idle = 0;
+    mixer::resync(state.filled);
+    for _ in 0..PERIODS {
+        fill_entry(state);
+    }
 
-    written
+    unsafe {
+        let cr = port::inb(state.nabmbar + NABM_PO_CR);
+        port::outb(state.nabmbar + NABM_PO_CR, cr | CR_RPBM | CR_IOCE | CR_LVBIE);
+    }
+    state.playing = true;
 }
 
-/// Stop PCM playback.
-pub fn stop() {
+/// Halt the ring, dropping the mixed periods not played yet.
+pub fn halt() {
     let mut guard = AC97.lock();
     if let Some(state) = guard.as_mut() {
-        unsafe {
-            // Clear Run/Pause bit
-            let cr = port::inb(state.nabmbar + NABM_PO_CR);
-            port::outb(state.nabmbar + NABM_PO_CR, cr & !CR_RPBM);
-        }
+        let (_, dropped) = pending(state);
+        state.filled -= dropped;
+        unsafe { reset_channel(state); }
         state.playing = false;
         state.write_idx = 0;
     }
 }
 
+/// Sample frames played since the driver started.
+pub fn position() -> u64 {
+    let mut guard = AC97.lock();
+    match guard.as_mut() {
+        Some(state) => {
+            refill(state);
+            state.filled - pending(state).1
+        }
+        None => 0,
+    }
+}
+
 /// Set master volume (0 = mute, 100 = max).
 pub fn set_volume(vol: u8) {
     let mut guard = AC97.lock();
@@ -380,29 +442,31 @@ pub struct Ac97Driver;
 
 impl super::AudioDriver for Ac97Driver {
     fn name(&self) -> &str { "Intel AC'97" }
-    fn write_pcm(&mut self, data: &[u8]) -> usize { write_pcm(data) }
-    fn stop(&mut self) { stop(); }
+    fn start(&mut self) { start(); }
+    fn halt(&mut self) { halt(); }
     fn set_volume(&mut self, vol: u8) { set_volume(vol); }
     fn get_volume(&self) -> u8 { get_volume() }
     fn is_playing(&self) -> bool { is_playing() }
-    fn sample_rate(&self) -> u32 { 48000 }
+    fn sample_rate(&self) -> u32 { mixer::OUTPUT_RATE }
+    fn position(&self) -> u64 { position() }
 }
 
-/// AC'97 IRQ handler — acknowledges buffer completion interrupts.
+/// AC'97 IRQ handler — acknowledges completions and mixes the next periods.
 fn ac97_irq_handler(_irq: u8) {
     if let Some(mut guard) = AC97.try_lock() {
         if let Some(state) = guard.as_mut() {
             let sr = unsafe { port::inw(state.nabmbar + NABM_PO_SR) };
 
             if sr & SR_BCIS != 0 {
-                // Buffer completed — acknowledge
+                // Period completed — acknowledge and mix the next ones
                 unsafe {
                     port::outw(state.nabmbar + NABM_PO_SR, SR_BCIS);
                 }
+                refill(state);
             }
 
             if sr & SR_LVBCI != 0 {
-                // Last valid buffer completed — playback finished
+                // Last valid buffer completed — the ring ran dry
                 unsafe {
                     port::outw(state.nabmbar + NABM_PO_SR, SR_LVBCI);
                 }
@@ -5,12 +5,13 @@
 //!
 //! Supports Intel ICH6/ICH9 HDA controllers as found in VirtualBox and QEMU.
 //! Uses CORB/RIRB for codec communication and BDL-based DMA for PCM output
-//! at 48 kHz, 16-bit stereo.
+//! at 48 kHz, 16-bit stereo, fed period by period from the [`super::mixer`].
 //!
 //! VirtualBox: uses ICH6 HDA (8086:2668) or ICH9 (8086:293E)
 //! QEMU: `-device intel-hda -device hda-output`
 
 use alloc::boxed::Box;
+use super::mixer::{self, PERIODS};
 use crate::memory::address::PhysAddr;
 use crate::memory::{physical, virtual_mem};
 use crate::drivers::pci::PciDevice;
@@ -104,9 +105,7 @@ const WIDGET_TYPE_AUDIO_MIXER: u32  = 0x2;
 const WIDGET_TYPE_AUDIO_SELECTOR: u32 = 0x3;
 const WIDGET_TYPE_PIN_COMPLEX: u32  = 0x4;
 
-// BDL constants
-const BDL_ENTRIES: usize = 32;
-const BUF_SIZE: usize = 4096; // 4 KiB per buffer = 1024 sample frames at 4 bytes/frame
+// BDL constants: one entry per mixer period, each in its own 4 KiB page
 const IOC_FLAG: u32 = 1; // Interrupt On Completion flag in BDL entry
 
 /// BDL entry (16 bytes each, must be aligned to 128 bytes total).
@@ -130,8 +129,13 @@ struct HdaState {
     out_stream_base: u32,           // MMIO offset of output stream 0
     bdl_virt: u64,                  // BDL virtual address (CPU access)
     bdl_phys: u64,                  // BDL physical address (for DMA)
-    bufs_phys: [u64; BDL_ENTRIES],  // PCM buffer physical addresses
-    write_idx: u8,                  // Next BDL entry to fill
+    bufs_phys: [u64; PERIODS],      // PCM buffer physical addresses
+    period_bytes: u32,              // Period size of the current run
+    filled: u64,                    // Bytes mixed into the ring since the stream started
+    hw_pos: u64,                    // Bytes DMA'd since the stream started
+    last_lpib: u32,                 // LPIB at the last position update
+    played_before: u64,             // Bytes played in earlier runs of the stream
+    idle: u32,                      // Silent periods mixed in a row
     volume: u8,                     // 0-100
     playing: bool,
     codec_addr: u8,                 // Detected codec address (usually 0)
@@ -419,8 +423,13 @@ pub fn init_from_pci(pci: &PciDevice) {
         out_stream_base,
         bdl_virt: 0,
         bdl_phys: 0,
-        bufs_phys: [0; BDL_ENTRIES],
-        write_idx: 0,
+        bufs_phys: [0; PERIODS],
+        period_bytes: 0,
+        filled: 0,
+        hw_pos: 0,
+        last_lpib: 0,
+        played_before: 0,
+        idle: 0,
         volume: 80,
         playing: false,
         codec_addr,
@@ -551,7 +560,7 @@ pub fn init_from_pci(pci: &PciDevice) {
     unsafe { core::ptr::write_bytes(bdl_virt as *mut u8, 0, 4096); }
 
     // Allocate PCM buffers
-    for i in 0..BDL_ENTRIES {
+    for i in 0..PERIODS {
         let buf_frame = match physical::alloc_frame() {
             Some(f) => f,
             None => {
@@ -563,54 +572,9 @@ pub fn init_from_pci(pci: &PciDevice) {
         unsafe { core::ptr::write_bytes(buf_frame.as_u64() as *mut u8, 0, 4096); }
     }
 
-    // Set up BDL entries
-    let bdl_ptr = bdl_virt as *mut BdlEntry;
-    for i in 0..BDL_ENTRIES {
-        unsafe {
-            (*bdl_ptr.add(i)).addr_low = state.bufs_phys[i] as u32;
-            (*bdl_ptr.add(i)).addr_high = (state.bufs_phys[i] >> 32) as u32;
-            (*bdl_ptr.add(i)).length = BUF_SIZE as u32;
-            (*bdl_ptr.add(i)).ioc = IOC_FLAG;
-        }
-    }
-
     // ── Configure Output Stream 0 ──
-    let sd = out_stream_base;
-    unsafe {
-        // Reset stream
-        let ctl = mmio_read32(mmio, sd + SD_CTL) & 0xFF;
-        mmio_write32(mmio, sd + SD_CTL, ctl | SD_CTL_SRST);
-        for _ in 0..10_000 {
-            if mmio_read32(mmio, sd + SD_CTL) & SD_CTL_SRST != 0 { break; }
-            core::hint::spin_loop();
-        }
-        // Clear reset
-        mmio_write32(mmio, sd + SD_CTL, ctl & !SD_CTL_SRST);
-        for _ in 0..10_000 {
-            if mmio_read32(mmio, sd + SD_CTL) & SD_CTL_SRST == 0 { break; }
-            core::hint::spin_loop();
-        }
-
-        // Set stream format
-        mmio_write16(mmio, sd + SD_FMT, FMT_48KHZ_16BIT_STEREO);
-
-        // Set cyclic buffer length (total bytes in all BDL entries)
-        let total_len = (BDL_ENTRIES * BUF_SIZE) as u32;
-        mmio_write32(mmio, sd + SD_CBL, total_len);
-
-        // Set last valid index
-        mmio_write16(mmio, sd + SD_LVI, (BDL_ENTRIES - 1) as u16);
-
-        // Set BDL pointer
-        mmio_write32(mmio, sd + SD_BDLPL, state.bdl_phys as u32);
-        mmio_write32(mmio, sd + SD_BDLPU, (state.bdl_phys >> 32) as u32);
-
-        // Set stream ID (stream 1 in bits [23:20] of CTL)
-        let ctl_val = mmio_read32(mmio, sd + SD_CTL);
-        // Clear old stream number, set stream 1
-        let ctl_val = (ctl_val & 0xFF0FFFFF) | (1 << 20);
-        mmio_write32(mmio, sd + SD_CTL, ctl_val | SD_CTL_IOCE);
-    }
+    state.period_bytes = mixer::period_frames() * 4;
+    unsafe { reset_stream(&state); }
 
     // Enable global interrupts
     unsafe {
@@ -640,76 +604,171 @@ pub fn init_from_pci(pci: &PciDevice) {
 }
 
 // ── PCM Playback ────────────────────────────────────────────────────────────
+//
+// The BDL holds one entry per mixer period, each with IOC set, and the
+// stream loops over them.  `filled` counts the bytes mixed into the ring
+// and `hw_pos` (sampled from LPIB on every completion and every call here)
+// the bytes the DMA has read; every period the DMA has completed is mixed
+// afresh right away, so the ring always holds `PERIODS - 1` periods ahead
+// of the one playing.  Once every period in the ring is silent the stream
+// is halted; the next write starts it again.
+
+/// Reset output stream 0 and program its format, cyclic buffer and BDL
+/// for `state.period_bytes` periods.
+unsafe fn reset_stream(state: &HdaState) {
+    let (mmio, sd) = (state.mmio, state.out_stream_base);
+    let ctl = mmio_read32(mmio, sd + SD_CTL) & 0xFF & !SD_CTL_RUN;
+    mmio_write32(mmio, sd + SD_CTL, ctl | SD_CTL_SRST);
+    for _ in 0..10_000 {
+        if mmio_read32(mmio, sd + SD_CTL) & SD_CTL_SRST != 0 { break; }
+        core::hint::spin_loop();
+    }
+    // Clear reset
+    mmio_write32(mmio, sd + SD_CTL, ctl & !SD_CTL_SRST);
+    for _ in 0..10_000 {
+        if mmio_read32(mmio, sd + SD_CTL) & SD_CTL_SRST == 0 { break; }
+        core::hint::spin_loop();
+    }
 
-/// Write PCM data to the next available DMA buffer.
-pub fn write_pcm(data: &[u8]) -> usize {
-    let mut guard = HDA.lock();
-    let state = match guard.as_mut() {
-        Some(s) => s,
-        None => return 0,
-    };
+    // One BDL entry per period
+    let bdl_ptr = state.bdl_virt as *mut BdlEntry;
+    for i in 0..PERIODS {
+        (*bdl_ptr.add(i)).addr_low = state.bufs_phys[i] as u32;
+        (*bdl_ptr.add(i)).addr_high = (state.bufs_phys[i] >> 32) as u32;
+        (*bdl_ptr.add(i)).length = state.period_bytes;
+        (*bdl_ptr.add(i)).ioc = IOC_FLAG;
+    }
 
-    let bdl_virt = state.bdl_virt;
-    let mut written = 0usize;
+    // Set stream format
+    mmio_write16(mmio, sd + SD_FMT, FMT_48KHZ_16BIT_STEREO);
 
-    while written < data.len() {
-        let remaining = data.len() - written;
-        let chunk = remaining.min(BUF_SIZE);
+    // Cyclic buffer length (total bytes in all BDL entries) and last valid index
+    mmio_write32(mmio, sd + SD_CBL, ring_size(state) as u32);
+    mmio_write16(mmio, sd + SD_LVI, (PERIODS - 1) as u16);
 
-        let idx = state.write_idx as usize;
-        let buf_virt = state.bufs_phys[idx]; // Physical = virtual in identity-mapped low memory
+    // Set BDL pointer
+    mmio_write32(mmio, sd + SD_BDLPL, state.bdl_phys as u32);
+    mmio_write32(mmio, sd + SD_BDLPU, (state.bdl_phys >> 32) as u32);
 
-        // Copy PCM data
-        unsafe {
-            core::ptr::copy_nonoverlapping(
-                data[written..].as_ptr(),
-                buf_virt as *mut u8,
-                chunk,
-            );
-            if chunk < BUF_SIZE {
-                core::ptr::write_bytes((buf_virt as *mut u8).add(chunk), 0, BUF_SIZE - chunk);
-            }
-        }
+    // Set stream ID (stream 1 in bits [23:20] of CTL)
+    let ctl_val = mmio_read32(mmio, sd + SD_CTL);
+    let ctl_val = (ctl_val & 0xFF0FFFFF) | (1 << 20);
+    mmio_write32(mmio, sd + SD_CTL, ctl_val | SD_CTL_IOCE);
+}
 
-        // Update BDL entry length
-        let bdl_ptr = bdl_virt as *mut BdlEntry;
-        unsafe {
-            (*bdl_ptr.add(idx)).length = chunk as u32;
-        }
+fn ring_size(state: &HdaState) -> u64 {
+    state.period_bytes as u64 * PERIODS as u64
+}
 
-        // Update LVI
-        unsafe {
-            mmio_write16(state.mmio, state.out_stream_base + SD_LVI, state.write_idx as u16);
-        }
+/// Mix the next period into the ring.
+fn fill_period(state: &mut HdaState) {
+    let pb = state.period_bytes as u64;
+    let idx = (state.filled / pb) as usize % PERIODS;
+    // Physical = virtual in identity-mapped low memory
+    let out = unsafe {
+        core::slice::from_raw_parts_mut(state.bufs_phys[idx] as *mut u32, pb as usize / 4)
+    };
+    if mixer::mix(out) {
+        state.idle = 0;
+    } else {
+        state.idle += 1;
+    }
+    state.filled += pb;
+}
 
-        state.write_idx = ((state.write_idx as usize + 1) % BDL_ENTRIES) as u8;
-        written += chunk;
+/// Advance `hw_pos` from LPIB, refill the periods the DMA has completed
+/// and halt the stream once the whole ring is silent.
+fn update_position(state: &mut HdaState) {
+    if !state.playing {
+        return;
+    }
+    let sd = state.out_stream_base;
+    let ring = ring_size(state);
+    let lpib = unsafe { mmio_read32(state.mmio, sd + SD_LPIB) } as u64 % ring;
+    let delta = (lpib + ring - state.last_lpib as u64) % ring;
+    state.last_lpib = lpib as u32;
+    state.hw_pos += delta;
 
-        // Start playback if not already running
-        if !state.playing {
-            unsafe {
-                let sd = state.out_stream_base;
-                let ctl = mmio_read32(state.mmio, sd + SD_CTL);
-                mmio_write32(state.mmio, sd + SD_CTL, ctl | SD_CTL_RUN | SD_CTL_IOCE);
-            }
-            state.playing = true;
-        }
+    // The period being played starts at `current`; all others are free
+    let pb = state.period_bytes as u64;
+    let current = state.hw_pos / pb * pb;
+    while state.filled + pb <= current + ring {
+        fill_period(state);
     }
 
-    written
+    if state.idle as usize >= PERIODS {
+        halt_stream(state);
+    }
 }
 
-/// Stop playback.
-pub fn stop() {
+fn halt_stream(state: &mut HdaState) {
+    unsafe {
+        let sd = state.out_stream_base;
+        let ctl = mmio_read32(state.mmio, sd + SD_CTL);
+        mmio_write32(state.mmio, sd + SD_CTL, ctl & !SD_CTL_RUN);
+    }
+    state.played_before += state.hw_pos.min(state.filled);
+    state.playing = false;
+}
+
+/// Frames played since the driver started.
+fn played_frames(state: &HdaState) -> u64 {
+    let now = if state.playing { state.hw_pos.min(state.filled) } else { 0 };
+    (state.played_before + now) / 4
+}
+
+/// Start the ring with the mixer's current period size, prefilled.
+pub fn start() {
+    let mut guard = HDA.lock();
+    let state = match guard.as_mut() {
+        Some(s) => s,
+        None => return,
+    };
+    update_position(state);
+    if state.playing {
+        return;
+    }
+
+    state.period_bytes = mixer::period_frames() * 4;
+    unsafe { reset_stream(state); }
+    state.filled = 0;
+    state.hw_pos = 0;
+    state.last_lpib = 0;
+    state.idle = 0;
+    mixer::resync(played_frames(state));
+    for _ in 0..PERIODS {
+        fill_period(state);
+    }
+
+    unsafe {
+        let sd = state.out_stream_base;
+        let ctl = mmio_read32(state.mmio, sd + SD_CTL);
+        mmio_write32(state.mmio, sd + SD_CTL, ctl | SD_CTL_RUN | SD_CTL_IOCE);
+    }
+    state.playing = true;
+}
+
+/// Halt the ring, dropping the mixed periods not played yet.
+pub fn halt() {
     let mut guard = HDA.lock();
     if let Some(state) = guard.as_mut() {
-        unsafe {
-            let sd = state.out_stream_base;
-            let ctl = mmio_read32(state.mmio, sd + SD_CTL);
-            mmio_write32(state.mmio, sd + SD_CTL, ctl & !SD_CTL_RUN);
+        update_position(state);
+        if state.playing {
+            halt_stream(state);
+            unsafe { reset_stream(state); }
         }
-        state.playing = false;
-        state.write_idx = 0;
+    }
+}
+
+/// Sample frames played since the driver started.
+pub fn position() -> u64 {
+    let mut guard = HDA.lock();
+    match guard.as_mut() {
+        Some(state) => {
+            update_position(state);
+            played_frames(state)
+        }
+        None => 0,
     }
 }
 
@@ -772,12 +831,13 @@ pub struct HdaDriver;
 
 impl super::AudioDriver for HdaDriver {
     fn name(&self) -> &str { "Intel HDA" }
-    fn write_pcm(&mut self, data: &[u8]) -> usize { write_pcm(data) }
-    fn stop(&mut self) { stop(); }
+    fn start(&mut self) { start(); }
+    fn halt(&mut self) { halt(); }
     fn set_volume(&mut self, vol: u8) { set_volume(vol); }
     fn get_volume(&self) -> u8 { get_volume() }
     fn is_playing(&self) -> bool { is_playing() }
-    fn sample_rate(&self) -> u32 { 48000 }
+    fn sample_rate(&self) -> u32 { mixer::OUTPUT_RATE }
+    fn position(&self) -> u64 { position() }
 }
 
 // ── IRQ handler ─────────────────────────────────────────────────────────────
@@ -798,10 +858,11 @@ fn hda_irq_handler(_irq: u8) {
             let sts = unsafe { mmio_read8(mmio, sd + SD_STS) };
 
             if sts & SD_STS_BCIS != 0 {
-                // Buffer completion — acknowledge
+                // Period completion — acknowledge and mix the next one
                 unsafe {
                     mmio_write8(mmio, sd + SD_STS, SD_STS_BCIS);
                 }
+                update_position(state);
             }
 
             // Clear global interrupt status
@@ -0,0 +1,304 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Software mixer between audio clients and the output DMA ring.
+//!
+//! Every thread that writes PCM gets its own stream: a ring of 48 kHz
+//! 16-bit stereo frames. Input at another sample rate is converted on
+//! write (linear interpolation), so the mixer itself only sums.
+//!
+//! The drivers run a cyclic ring of [`PERIODS`] DMA periods of
+//! [`period_frames`] each and call [`mix`] from their completion interrupt
+//! to refill the period that has just played. A frame mixed now is heard
+//! `PERIODS - 1` periods later ([`hw_latency`]), about 10 ms with the
+//! default period. Once every period of the ring is silent the driver
+//! halts the DMA; the next [`write`] starts it again.
+//!
+//! Lock order: driver state, then `MIXER`. The mixer never calls into a
+//! driver.
+
+use alloc::vec::Vec;
+use crate::sync::spinlock::Spinlock;
+
+/// Output sample rate of the mixer and the hardware.
+pub const OUTPUT_RATE: u32 = 48000;
+/// DMA periods in the hardware ring (divides the AC'97 32-entry BDL).
+pub const PERIODS: usize = 4;
+/// Default period: 160 frames, 3.3 ms, about 10 ms from mix to output.
+pub const DEFAULT_PERIOD_FRAMES: u32 = 160;
+pub const MIN_PERIOD_FRAMES: u32 = 64;
+/// One 4 KiB DMA buffer per period.
+pub const MAX_PERIOD_FRAMES: u32 = 1024;
+/// Periods must keep DMA buffers 128-byte aligned (HDA BDL rule).
+const PERIOD_ALIGN: u32 = 32;
+
+/// Frames queued per stream at most (~341 ms).
+const STREAM_FRAMES: usize = 16384;
+const STREAM_MASK: u64 = STREAM_FRAMES as u64 - 1;
+const MAX_STREAMS: usize = 16;
+const MIN_RATE: u32 = 8000;
+const MAX_RATE: u32 = 192000;
+/// 1.0 in the 16.16 resampler phase.
+const ONE: u32 = 1 << 16;
+
+/// Frames are packed as in the DMA buffers: left in the low half.
+#[inline]
+fn unpack(f: u32) -> (i32, i32) {
+    (f as u16 as i16 as i32, (f >> 16) as u16 as i16 as i32)
+}
+
+#[inline]
+fn pack(l: i32, r: i32) -> u32 {
+    let l = l.clamp(i16::MIN as i32, i16::MAX as i32) as u16 as u32;
+    let r = r.clamp(i16::MIN as i32, i16::MAX as i32) as u16 as u32;
+    l | (r << 16)
+}
+
+struct Stream {
+    tid: u32,
+    /// Input frames per output frame, 16.16.
+    step: u32,
+    /// Position of the next output frame between `prev` and the next input.
+    phase: u32,
+    /// Last input frame (resampling only).
+    prev: u32,
+    ring: Vec<u32>,
+    /// Frames taken by the mixer.
+    head: u64,
+    /// Frames written.
+    tail: u64,
+    /// Mixer output position just past this stream's last mixed frame.
+    mix_end: u64,
+}
+
+impl Stream {
+    fn new(tid: u32) -> Self {
+        Stream {
+            tid,
+            step: ONE,
+            phase: 0,
+            prev: 0,
+            ring: alloc::vec![0u32; STREAM_FRAMES],
+            head: 0,
+            tail: 0,
+            mix_end: 0,
+        }
+    }
+
+    fn space(&self) -> usize {
+        STREAM_FRAMES - (self.tail - self.head) as usize
+    }
+
+    fn push(&mut self, f: u32) {
+        self.ring[(self.tail & STREAM_MASK) as usize] = f;
+        self.tail += 1;
+    }
+
+    /// Queue as much of `data` (input-rate frames) as fits; returns the
+    /// bytes consumed.
+    fn write(&mut self, data: &[u8]) -> usize {
+        let frames = data.chunks_exact(4)
+            .map(|b| u32::from_le_bytes([b[0], b[1], b[2], b[3]]));
+        let mut used = 0;
+        if self.step == ONE {
+            for f in frames.take(self.space()) {
+                self.push(f);
+                used += 1;
+            }
+            return used * 4;
+        }
+        for cur in frames {
+            // Output frames falling between `prev` and `cur`
+            let count = if self.phase < ONE {
+                ((ONE - self.phase + self.step - 1) / self.step) as usize
+            } else {
+                0
+            };
+            if count > self.space() {
+                break;
+            }
+            let (pl, pr) = unpack(self.prev);
+            let (cl, cr) = unpack(cur);
+            let lerp = |a: i32, b: i32, t: u32| a + (((b - a) as i64 * t as i64) >> 16) as i32;
+            for _ in 0..count {
+                self.push(pack(lerp(pl, cl, self.phase), lerp(pr, cr, self.phase)));
+                self.phase += self.step;
+            }
+            self.phase -= ONE;
+            self.prev = cur;
+            used += 1;
+        }
+        used * 4
+    }
+
+    /// Frames mixed but not played yet, given the hardware position.
+    fn unplayed(&self, played: u64) -> u64 {
+        self.mix_end.saturating_sub(played).min(self.head)
+    }
+}
+
+struct Mixer {
+    streams: Vec<Stream>,
+    /// Sum buffer for one period (L, R interleaved).
+    acc: Vec<i32>,
+    period_frames: u32,
+    /// Frames mixed for the hardware, on the driver's position scale.
+    mixed: u64,
+}
+
+static MIXER: Spinlock<Mixer> = Spinlock::new(Mixer {
+    streams: Vec::new(),
+    acc: Vec::new(),
+    period_frames: DEFAULT_PERIOD_FRAMES,
+    mixed: 0,
+});
+
+// ── Client side ─────────────────────────────────────────────────────────────
+
+/// Create `tid`'s stream if it has none. Returns false if there are too
+/// many streams.
+fn ensure_stream(tid: u32) -> bool {
+    if MIXER.lock().streams.iter().any(|s| s.tid == tid) {
+        return true;
+    }
+    // Allocate outside the lock (interrupts are off while it is held)
+    let stream = Stream::new(tid);
+    let acc = alloc::vec![0i32; 2 * MAX_PERIOD_FRAMES as usize];
+    let mut m = MIXER.lock();
+    if m.acc.is_empty() {
+        m.acc = acc;
+    }
+    if m.streams.iter().any(|s| s.tid == tid) {
+        return true;
+    }
+    if m.streams.len() >= MAX_STREAMS {
+        return false;
+    }
+    m.streams.push(stream);
+    true
+}
+
+fn with_stream<R>(tid: u32, f: impl FnOnce(&mut Stream) -> R) -> Option<R> {
+    MIXER.lock().streams.iter_mut().find(|s| s.tid == tid).map(f)
+}
+
+/// Queue PCM for `tid`'s stream, creating it on first use. Returns the
+/// bytes consumed (0 if the ring is full or there are too many streams).
+pub fn write(tid: u32, data: &[u8]) -> usize {
+    if !ensure_stream(tid) {
+        return 0;
+    }
+    with_stream(tid, |s| s.write(data)).unwrap_or(0)
+}
+
+/// Set the sample rate of `tid`'s stream. Returns false if out of range.
+pub fn set_rate(tid: u32, rate: u32) -> bool {
+    if !(MIN_RATE..=MAX_RATE).contains(&rate) || !ensure_stream(tid) {
+        return false;
+    }
+    with_stream(tid, |s| {
+        s.step = (((rate as u64) << 16) / OUTPUT_RATE as u64) as u32;
+        s.phase = 0;
+        s.prev = 0;
+    })
+    .is_some()
+}
+
+/// Drop the frames of `tid` that have not been mixed yet.
+pub fn stop(tid: u32) {
+    with_stream(tid, |s| {
+        s.tail = s.head;
+        s.phase = 0;
+        s.prev = 0;
+    });
+}
+
+/// Frames of `tid` played so far, given the hardware position `played`.
+pub fn position(tid: u32, played: u64) -> u64 {
+    with_stream(tid, |s| s.head - s.unplayed(played)).unwrap_or(0)
+}
+
+/// Frames of `tid` written but not played yet.
+pub fn buffered(tid: u32, played: u64) -> u32 {
+    with_stream(tid, |s| (s.tail - s.head + s.unplayed(played)) as u32).unwrap_or(0)
+}
+
+/// Remove the stream of an exiting thread.
+pub fn remove(tid: u32) {
+    let stream = {
+        let mut m = MIXER.lock();
+        m.streams.iter().position(|s| s.tid == tid).map(|i| m.streams.swap_remove(i))
+    };
+    // Freed outside the lock
+    drop(stream);
+}
+
+/// Frames between mixing and output: the periods queued ahead of the
+/// one the hardware is playing.
+pub fn hw_latency() -> u32 {
+    MIXER.lock().period_frames * (PERIODS as u32 - 1)
+}
+
+pub fn period_frames() -> u32 {
+    MIXER.lock().period_frames
+}
+
+/// Set the period size (rounded and clamped); the driver picks it up at
+/// its next start. Returns the size applied.
+pub fn set_period_frames(frames: u32) -> u32 {
+    let frames = (frames / PERIOD_ALIGN * PERIOD_ALIGN).clamp(MIN_PERIOD_FRAMES, MAX_PERIOD_FRAMES);
+    MIXER.lock().period_frames = frames;
+    frames
+}
+
+// ── Driver side ─────────────────────────────────────────────────────────────
+
+/// Restart the output position at the hardware position `played` (the
+/// driver is starting its ring; anything mixed before was dropped).
+pub fn resync(played: u64) {
+    let mut m = MIXER.lock();
+    m.mixed = played;
+    for s in m.streams.iter_mut() {
+        s.mix_end = s.mix_end.min(played);
+    }
+}
+
+/// Mix the next period into `out` (one packed frame per element).
+/// Returns false if no stream had data (`out` is then silent).
+pub fn mix(out: &mut [u32]) -> bool {
+    let mut guard = MIXER.lock();
+    let m = &mut *guard;
+    let n = out.len().min(m.acc.len() / 2);
+    let base = m.mixed;
+    m.mixed += out.len() as u64;
+
+    let acc = &mut m.acc[..2 * n];
+    let mut active = false;
+    for s in m.streams.iter_mut() {
+        let take = ((s.tail - s.head) as usize).min(n);
+        if take == 0 {
+            continue;
+        }
+        if !active {
+            acc.fill(0);
+            active = true;
+        }
+        for i in 0..take {
+            let (l, r) = unpack(s.ring[((s.head + i as u64) & STREAM_MASK) as usize]);
+            acc[2 * i] += l;
+            acc[2 * i + 1] += r;
+        }
+        s.head += take as u64;
+        s.mix_end = base + take as u64;
+    }
+
+    if !active {
+        out.fill(0);
+        return false;
+    }
+    for (i, f) in out[..n].iter_mut().enumerate() {
+        *f = pack(acc[2 * i], acc[2 * i + 1]);
+    }
+    out[n..].fill(0);
+    true
+}
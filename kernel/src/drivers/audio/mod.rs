@@ -6,29 +6,40 @@
 //! Provides a unified [`AudioDriver`] trait for audio output drivers (AC'97, Intel HDA, etc.).
 //! Drivers register dynamically via PCI detection in the HAL.
 //! Userspace accesses audio through SYS_AUDIO_WRITE / SYS_AUDIO_CTL syscalls.
+//!
+//! Clients never touch the DMA buffers: each writing thread has a stream in
+//! the [`mixer`], and the driver pulls mixed periods from it.
 
 pub mod ac97;
 pub mod hda;
+pub mod mixer;
 
 use alloc::boxed::Box;
 use crate::sync::spinlock::Spinlock;
 
 /// Unified audio driver interface.
+///
+/// A driver plays a cyclic ring of [`mixer::PERIODS`] periods of
+/// [`mixer::period_frames`] 16-bit stereo frames at 48 kHz, refilling each
+/// completed period with [`mixer::mix`] from its interrupt handler.
 pub trait AudioDriver: Send {
     /// Human-readable driver name.
     fn name(&self) -> &str;
-    /// Write PCM samples (16-bit signed LE stereo, 48 kHz). Returns bytes consumed.
-    fn write_pcm(&mut self, data: &[u8]) -> usize;
-    /// Stop all playback.
-    fn stop(&mut self);
+    /// Start the ring if it is halted: program the current period size,
+    /// call [`mixer::resync`] and prefill every period.
+    fn start(&mut self);
+    /// Halt the ring. Mixed periods not played yet are dropped.
+    fn halt(&mut self);
     /// Set master volume (0–100).
     fn set_volume(&mut self, vol: u8);
     /// Get current master volume (0–100).
     fn get_volume(&self) -> u8;
-    /// Check if playback is currently active.
+    /// Check if the ring is running.
     fn is_playing(&self) -> bool;
     /// Get the sample rate in Hz (typically 48000).
     fn sample_rate(&self) -> u32;
+    /// Sample frames the DMA engine has played since the driver started.
+    fn position(&self) -> u64;
 }
 
 /// Global audio driver instance, set during PCI probe.
@@ -51,17 +62,41 @@ where
     Some(f(driver.as_mut()))
 }
 
-/// Write PCM samples to the audio output.
+fn current_tid() -> u32 {
+    crate::task::scheduler::current_tid()
+}
+
+/// Frames the hardware has played since the driver started.
+fn hw_position() -> u64 {
+    with_audio(|d| d.position()).unwrap_or(0)
+}
+
+/// Queue PCM samples on the calling thread's stream.
 ///
-/// `data` must contain 16-bit signed little-endian stereo samples at 48 kHz
-/// (4 bytes per sample frame: L16 + R16). Returns number of bytes accepted.
+/// `data` must contain 16-bit signed little-endian stereo samples at the
+/// stream's rate (48 kHz unless changed with [`set_rate`]; 4 bytes per
+/// sample frame: L16 + R16). Returns number of bytes accepted;
+/// the rest must be offered again once some of the queue has played.
 pub fn write_pcm(data: &[u8]) -> usize {
-    with_audio(|d| d.write_pcm(data)).unwrap_or(0)
+    if !is_available() {
+        return 0;
+    }
+    let n = mixer::write(current_tid(), data);
+    if n > 0 {
+        with_audio(|d| d.start());
+    }
+    n
 }
 
-/// Stop all audio playback.
+/// Drop what the calling thread has queued and not played yet.
 pub fn stop() {
-    with_audio(|d| d.stop());
+    mixer::stop(current_tid());
+}
+
+/// Set the sample rate of the calling thread's stream (8–192 kHz); its
+/// input is resampled to 48 kHz. Returns false if out of range.
+pub fn set_rate(rate: u32) -> bool {
+    is_available() && mixer::set_rate(current_tid(), rate)
 }
 
 /// Set master volume (0–100).
@@ -79,11 +114,46 @@ pub fn is_available() -> bool {
     AUDIO.lock().is_some()
 }
 
-/// Check if playback is currently active.
+/// Check if the output is running (any stream is playing).
 pub fn is_playing() -> bool {
     with_audio(|d| d.is_playing()).unwrap_or(false)
 }
 
+/// Sample frames of the calling thread's stream played so far. Advances at
+/// the sample rate while the stream plays, so it serves as the clock to
+/// time other output against.
+pub fn position() -> u64 {
+    mixer::position(current_tid(), hw_position())
+}
+
+/// Sample frames the calling thread has written but not played yet.
+pub fn buffered() -> u32 {
+    mixer::buffered(current_tid(), hw_position())
+}
+
+/// Frames from mixing to output (the periods queued in the DMA ring).
+pub fn latency() -> u32 {
+    mixer::hw_latency()
+}
+
+/// Set the DMA period size in frames (64–1024, multiple of 32). A running
+/// ring is restarted with it. Returns the size applied.
+pub fn set_period(frames: u32) -> u32 {
+    let frames = mixer::set_period_frames(frames);
+    with_audio(|d| {
+        if d.is_playing() {
+            d.halt();
+            d.start();
+        }
+    });
+    frames
+}
+
+/// Release the stream of an exiting thread.
+pub fn cleanup_for_thread(tid: u32) {
+    mixer::remove(tid);
+}
+
 // ── HAL integration ─────────────────────────────────────────────────────────
 
 use crate::drivers::hal::{Driver, DriverType, DriverError,
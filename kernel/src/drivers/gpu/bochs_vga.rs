@@ -11,6 +11,10 @@ use alloc::boxed::Box;
 const VBE_DISPI_IOPORT_INDEX: u16 = 0x01CE;
 const VBE_DISPI_IOPORT_DATA: u16 = 0x01CF;
 
+/// VGA input status register 1 (color mode); bit 3 = vertical retrace.
+const VGA_INPUT_STATUS_1: u16 = 0x03DA;
+const VGA_ST01_V_RETRACE: u8 = 0x08;
+
 // DISPI register indices
 const VBE_DISPI_INDEX_XRES: u16 = 0x01;
 const VBE_DISPI_INDEX_YRES: u16 = 0x02;
@@ -135,6 +139,21 @@ impl GpuDriver for BochsVgaGpu {
         dispi_write(VBE_DISPI_INDEX_Y_OFFSET, y_offset as u16);
     }
 
+    fn set_scanout(&mut self, line: Option<u32>) -> bool {
+        let y = line.unwrap_or(self.front_page * self.height);
+        let virt_height = dispi_read(VBE_DISPI_INDEX_VIRT_HEIGHT) as u32;
+        if y > u16::MAX as u32 || y + self.height > virt_height {
+            return false;
+        }
+        dispi_write(VBE_DISPI_INDEX_Y_OFFSET, y as u16);
+        dispi_read(VBE_DISPI_INDEX_Y_OFFSET) as u32 == y
+    }
+
+    fn in_vblank(&self) -> Option<bool> {
+        let st = unsafe { crate::arch::x86::port::inb(VGA_INPUT_STATUS_1) };
+        Some(st & VGA_ST01_V_RETRACE != 0)
+    }
+
     fn back_buffer_phys(&self) -> Option<u32> {
         if !self.double_buffered {
             return None;
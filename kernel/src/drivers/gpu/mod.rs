@@ -106,6 +106,20 @@ pub trait GpuDriver: Send {
     /// Synchronize: wait for GPU to process all pending FIFO commands.
     fn sync(&mut self) {}
 
+    /// Queue a fence behind the commands issued so far.  Returns a device
+    /// fence id, or 0 if that work has already completed (devices that
+    /// execute commands synchronously, or without fence support).
+    fn insert_fence(&mut self) -> u32 {
+        self.sync();
+        0
+    }
+
+    /// Whether device fence `id` has passed.
+    fn fence_passed(&mut self, _id: u32) -> bool { true }
+
+    /// Block until device fence `id` has passed.
+    fn wait_fence(&mut self, _id: u32) {}
+
     /// Total VRAM size in bytes (0 if unknown).
     fn vram_size(&self) -> u32 { 0 }
 
@@ -146,6 +160,18 @@ pub trait GpuDriver: Send {
     /// Get the physical address of the current back buffer.
     fn back_buffer_phys(&self) -> Option<u32> { None }
 
+    /// Scan the display out of VRAM starting at row `line` (framebuffer
+    /// pitch) instead of the front page, or restore it with `None`.
+    /// Returns false if the device cannot (used for direct scanout of
+    /// fullscreen VRAM surfaces).
+    fn set_scanout(&mut self, _line: Option<u32>) -> bool { false }
+
+    // ── Display Timing ───────────────────────────────────
+
+    /// Whether the display is in vertical retrace, or `None` if the device
+    /// does not report it (the compositor then paces frames with a timer).
+    fn in_vblank(&self) -> Option<bool> { None }
+
     // ── 3D Acceleration ──────────────────────────────────
 
     /// Returns true if SVGA3D hardware acceleration is available.
@@ -169,6 +195,16 @@ pub trait GpuDriver: Send {
     /// `width`, `height`: surface dimensions (for DMA copy box).
     /// Returns true on success.
     fn dma_surface_download(&mut self, _sid: u32, _buf: &mut [u8], _width: u32, _height: u32) -> bool { false }
+
+    /// Define a guest memory region over `phys_pages` that 3D command
+    /// streams may name as a `SURFACE_DMA` source or target.
+    /// Returns the region (GMR) ID, or `None` if unsupported.
+    fn define_guest_region(&mut self, _phys_pages: &[u64]) -> Option<u32> { None }
+
+    /// Wait for pending commands, then drop a region from
+    /// [`define_guest_region`](GpuDriver::define_guest_region); its pages
+    /// may be freed once this returns.
+    fn release_guest_region(&mut self, _gmr_id: u32) {}
 }
 
 // ──────────────────────────────────────────────
@@ -5,6 +5,13 @@
 //! and cursorq (cursor updates). Supports damage-based display updates via
 //! TRANSFER_TO_HOST_2D + RESOURCE_FLUSH, and full-color ARGB hardware cursor.
 //!
+//! Display updates are asynchronous: transfers and flushes are queued on the
+//! controlq into per-request slots and the device is notified once per
+//! flush, with the flush carrying `VIRTIO_GPU_FLAG_FENCE`.  Requests complete
+//! in the background; `insert_fence`/`wait_fence` (and `sync`) wait for them,
+//! sleeping on the virtio interrupt when the device has one.  Other control
+//! commands stay synchronous and first drain the requests in flight.
+//!
 //! QEMU: `-vga virtio` (virtio-vga with VGA BIOS compat) or `-device virtio-gpu-pci`.
 
 use super::GpuDriver;
@@ -14,6 +21,7 @@ use crate::drivers::pci::PciDevice;
 use crate::drivers::virtio::{self, VirtioDevice, VIRTIO_F_VERSION_1};
 use crate::drivers::virtio::virtqueue::VirtQueue;
 use crate::memory::physical;
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
 
 // ──────────────────────────────────────────────
 // VirtIO GPU Command Types
@@ -38,6 +46,43 @@ const VIRTIO_GPU_CMD_MOVE_CURSOR: u32          = 0x0301;
 const VIRTIO_GPU_RESP_OK_NODATA: u32           = 0x1100;
 const VIRTIO_GPU_RESP_OK_DISPLAY_INFO: u32     = 0x1101;
 
+/// Header flag: complete the request only once the host has finished it.
+const VIRTIO_GPU_FLAG_FENCE: u32               = 1 << 0;
+
+// ──────────────────────────────────────────────
+// Asynchronous Submission
+// ──────────────────────────────────────────────
+
+/// Control requests that may be in flight at once.
+const ASYNC_SLOTS: usize = 32;
+/// Bytes per request and per response slot (one page each for all slots).
+const ASYNC_SLOT_SIZE: u64 = 128;
+/// Polls before giving up on an in-flight request.
+const ASYNC_TIMEOUT_SPINS: u32 = 10_000_000;
+
+/// ISR status address for the interrupt handler (0 = no interrupt).
+static VIRTIO_GPU_ISR: AtomicU64 = AtomicU64::new(0);
+/// TID of the thread waiting for a request to complete (0 = none).
+static VIRTIO_GPU_WAITER: AtomicU32 = AtomicU32::new(0);
+
+/// INTx handler (possibly shared): reading the ISR acknowledges the device,
+/// and a used-buffer interrupt wakes the thread waiting on a fence.
+fn virtio_gpu_irq_handler(_irq: u8) {
+    let isr_addr = VIRTIO_GPU_ISR.load(Ordering::Relaxed);
+    if isr_addr == 0 || virtio::mmio_read8(isr_addr) & 1 == 0 {
+        return;
+    }
+    let tid = VIRTIO_GPU_WAITER.load(Ordering::Acquire);
+    if tid != 0 && !crate::task::scheduler::try_wake_thread(tid) {
+        crate::task::scheduler::deferred_wake(tid);
+    }
+}
+
+/// Whether sequence number `a` is at or after `b` (wrapping).
+fn seq_reached(a: u32, b: u32) -> bool {
+    (a.wrapping_sub(b) as i32) >= 0
+}
+
 // ──────────────────────────────────────────────
 // VirtIO GPU Pixel Formats
 // ──────────────────────────────────────────────
@@ -243,6 +288,21 @@ pub struct VirtioGpu {
     // when the kernel writes to them during a syscall under user CR3.
     cursor_buf_phys: u64,
 
+    // Asynchronous controlq requests: ASYNC_SLOTS request/response slots of
+    // ASYNC_SLOT_SIZE bytes, allocated during init like cmd_buf.
+    async_cmd_buf: u64,
+    async_resp_buf: u64,
+    /// Per slot: (head descriptor, submission seq); seq 0 = free.
+    inflight: [(u16, u32); ASYNC_SLOTS],
+    /// Seq of the last submitted request (never 0 once used).
+    submit_seq: u32,
+    /// Requests queued since the device was last notified.
+    unkicked: bool,
+    /// controlq notification address.
+    ctrl_notify: u64,
+    /// The controlq interrupt is routed to `virtio_gpu_irq_handler`.
+    irq_active: bool,
+
     // Supported display modes (native first, then filtered COMMON_MODES)
     supported: Vec<(u32, u32)>,
 }
@@ -256,6 +316,8 @@ impl VirtioGpu {
     /// Send a control command and wait for response.
     /// Returns the response type code.
     fn send_ctrl_cmd(&mut self, cmd: &[u8]) -> u32 {
+        // execute_sync takes the next used buffer as its own response.
+        self.wait_idle();
         let cmd_len = cmd.len();
         if cmd_len > 4096 {
             crate::serial_println!("  VirtIO GPU: command too large ({} bytes)", cmd_len);
@@ -515,7 +577,121 @@ impl VirtioGpu {
         resp == VIRTIO_GPU_RESP_OK_NODATA
     }
 
-    fn cmd_transfer_to_host_2d(&mut self, resource_id: u32, x: u32, y: u32, w: u32, h: u32) -> bool {
+
+    // ── Asynchronous control requests ──
+
+    /// Collect completed asynchronous requests and free their slots.
+    fn reap_async(&mut self) {
+        while let Some((head, _)) = self.controlq.poll_used() {
+            let slot = match self.inflight.iter().position(|&(h, seq)| seq != 0 && h == head) {
+                Some(i) => i,
+                None => continue,
+            };
+            self.inflight[slot].1 = 0;
+            let resp = unsafe {
+                core::ptr::read_volatile((self.async_resp_buf + slot as u64 * ASYNC_SLOT_SIZE) as *const u32)
+            };
+            if resp != VIRTIO_GPU_RESP_OK_NODATA {
+                crate::serial_println!("  VirtIO GPU: async request failed (resp={:#x})", resp);
+            }
+        }
+    }
+
+    /// Queue a control request without waiting for its response.  The
+    /// device is notified by `kick_async`.  Returns the request's seq.
+    fn submit_async(&mut self, cmd: &[u8], fence: bool) -> u32 {
+        let slot = loop {
+            self.reap_async();
+            if self.controlq.num_free() >= 2 {
+                if let Some(i) = self.inflight.iter().position(|&(_, seq)| seq == 0) {
+                    break i;
+                }
+            }
+            // Every slot is busy: wait for the oldest request.
+            let oldest = self.inflight.iter().map(|&(_, seq)| seq)
+                .filter(|&seq| seq != 0)
+                .min_by_key(|&seq| seq.wrapping_sub(self.submit_seq) as i32)
+                .unwrap_or(self.submit_seq);
+            self.wait_async(oldest);
+        };
+        self.submit_seq = self.submit_seq.wrapping_add(1).max(1);
+        let seq = self.submit_seq;
+        let cmd_phys = self.async_cmd_buf + slot as u64 * ASYNC_SLOT_SIZE;
+        let resp_phys = self.async_resp_buf + slot as u64 * ASYNC_SLOT_SIZE;
+        let len = cmd.len().min(ASYNC_SLOT_SIZE as usize);
+        unsafe {
+            core::ptr::copy_nonoverlapping(cmd.as_ptr(), cmd_phys as *mut u8, len);
+            core::ptr::write_bytes(resp_phys as *mut u8, 0, 24);
+            if fence {
+                let hdr = &mut *(cmd_phys as *mut GpuCtrlHdr);
+                hdr.flags |= VIRTIO_GPU_FLAG_FENCE;
+                hdr.fence_id = seq as u64;
+            }
+        }
+        match self.controlq.push(&[(cmd_phys, len as u32)], &[(resp_phys, 24)]) {
+            Some(head) => {
+                self.inflight[slot] = (head, seq);
+                self.unkicked = true;
+            }
+            None => crate::serial_println!("  VirtIO GPU: controlq full"),
+        }
+        seq
+    }
+
+    /// Notify the device of queued requests.
+    fn kick_async(&mut self) {
+        if self.unkicked {
+            self.unkicked = false;
+            if self.controlq.kick_needed() {
+                virtio::mmio_write16(self.ctrl_notify, 0);
+            }
+        }
+    }
+
+    /// Whether every request up to seq `seq` has completed.
+    fn async_done(&self, seq: u32) -> bool {
+        !self.inflight.iter().any(|&(_, s)| s != 0 && seq_reached(seq, s))
+    }
+
+    /// Wait until every request up to seq `seq` has completed: sleep on the
+    /// interrupt once if there is one, then poll.
+    fn wait_async(&mut self, seq: u32) {
+        self.kick_async();
+        let mut slept = false;
+        let mut spins = 0u32;
+        loop {
+            self.reap_async();
+            if self.async_done(seq) {
+                return;
+            }
+            let tid = crate::task::scheduler::current_tid();
+            if self.irq_active && !slept && tid > 0 {
+                slept = true;
+                VIRTIO_GPU_WAITER.store(tid, Ordering::Release);
+                if self.controlq.enable_interrupts() {
+                    crate::task::scheduler::block_current_thread();
+                }
+                self.controlq.disable_interrupts();
+                VIRTIO_GPU_WAITER.store(0, Ordering::Release);
+                continue;
+            }
+            core::hint::spin_loop();
+            spins += 1;
+            if spins > ASYNC_TIMEOUT_SPINS {
+                crate::serial_println!("  VirtIO GPU: timeout waiting for request {}", seq);
+                return;
+            }
+        }
+    }
+
+    /// Wait for every asynchronous request.
+    fn wait_idle(&mut self) {
+        if self.inflight.iter().any(|&(_, seq)| seq != 0) {
+            self.wait_async(self.submit_seq);
+        }
+    }
+
+    fn transfer_cmd(&self, resource_id: u32, x: u32, y: u32, w: u32, h: u32) -> TransferToHost2d {
         // VirtIO GPU TRANSFER_TO_HOST_2D reads the backing store as "tightly packed":
         // row stride = r_width * bpp. For the framebuffer resource, our backing store
         // has stride = resource_width * bpp (pitch). Transfer full-width rows so the
@@ -527,7 +703,7 @@ impl VirtioGpu {
         } else {
             (x, y, w, 0u64)
         };
-        let cmd = TransferToHost2d {
+        TransferToHost2d {
             hdr: GpuCtrlHdr::new(VIRTIO_GPU_CMD_TRANSFER_TO_HOST_2D),
             r_x,
             r_y,
@@ -536,16 +712,11 @@ impl VirtioGpu {
             offset,
             resource_id,
             padding: 0,
-        };
-        let bytes = unsafe {
-            core::slice::from_raw_parts(&cmd as *const _ as *const u8, core::mem::size_of::<TransferToHost2d>())
-        };
-        let resp = self.send_ctrl_cmd(bytes);
-        resp == VIRTIO_GPU_RESP_OK_NODATA
+        }
     }
 
-    fn cmd_resource_flush(&mut self, resource_id: u32, x: u32, y: u32, w: u32, h: u32) -> bool {
-        let cmd = ResourceFlush {
+    fn flush_cmd(&self, resource_id: u32, x: u32, y: u32, w: u32, h: u32) -> ResourceFlush {
+        ResourceFlush {
             hdr: GpuCtrlHdr::new(VIRTIO_GPU_CMD_RESOURCE_FLUSH),
             r_x: x,
             r_y: y,
@@ -553,7 +724,39 @@ impl VirtioGpu {
             r_height: h,
             resource_id,
             padding: 0,
+        }
+    }
+
+    /// Queue a transfer of a scanout rect to the host resource.
+    fn queue_transfer(&mut self, x: u32, y: u32, w: u32, h: u32) {
+        let cmd = self.transfer_cmd(self.scanout_resource_id, x, y, w, h);
+        let bytes = unsafe {
+            core::slice::from_raw_parts(&cmd as *const _ as *const u8, core::mem::size_of::<TransferToHost2d>())
+        };
+        self.submit_async(bytes, false);
+    }
+
+    /// Queue a fenced flush of a scanout rect and notify the device.
+    fn queue_flush(&mut self, x: u32, y: u32, w: u32, h: u32) {
+        let cmd = self.flush_cmd(self.scanout_resource_id, x, y, w, h);
+        let bytes = unsafe {
+            core::slice::from_raw_parts(&cmd as *const _ as *const u8, core::mem::size_of::<ResourceFlush>())
+        };
+        self.submit_async(bytes, true);
+        self.kick_async();
+    }
+
+    fn cmd_transfer_to_host_2d(&mut self, resource_id: u32, x: u32, y: u32, w: u32, h: u32) -> bool {
+        let cmd = self.transfer_cmd(resource_id, x, y, w, h);
+        let bytes = unsafe {
+            core::slice::from_raw_parts(&cmd as *const _ as *const u8, core::mem::size_of::<TransferToHost2d>())
         };
+        let resp = self.send_ctrl_cmd(bytes);
+        resp == VIRTIO_GPU_RESP_OK_NODATA
+    }
+
+    fn cmd_resource_flush(&mut self, resource_id: u32, x: u32, y: u32, w: u32, h: u32) -> bool {
+        let cmd = self.flush_cmd(resource_id, x, y, w, h);
         let bytes = unsafe {
             core::slice::from_raw_parts(&cmd as *const _ as *const u8, core::mem::size_of::<ResourceFlush>())
         };
@@ -751,10 +954,9 @@ impl GpuDriver for VirtioGpu {
             return;
         }
 
-        // Transfer dirty region from guest RAM to device resource
-        self.cmd_transfer_to_host_2d(self.scanout_resource_id, x, y, w, h);
-        // Flush to display
-        self.cmd_resource_flush(self.scanout_resource_id, x, y, w, h);
+        // Transfer dirty region from guest RAM to device resource, then flush to display
+        self.queue_transfer(x, y, w, h);
+        self.queue_flush(x, y, w, h);
     }
 
     fn transfer_rect(&mut self, x: u32, y: u32, w: u32, h: u32) {
@@ -768,8 +970,8 @@ impl GpuDriver for VirtioGpu {
         if w == 0 || h == 0 {
             return;
         }
-        // Only transfer — no flush
-        self.cmd_transfer_to_host_2d(self.scanout_resource_id, x, y, w, h);
+        // Only transfer — no flush; the device is notified with the flush
+        self.queue_transfer(x, y, w, h);
     }
 
     fn flush_display(&mut self, x: u32, y: u32, w: u32, h: u32) {
@@ -783,8 +985,27 @@ impl GpuDriver for VirtioGpu {
         if w == 0 || h == 0 {
             return;
         }
-        // Only flush — all transfers already done
-        self.cmd_resource_flush(self.scanout_resource_id, x, y, w, h);
+        // Only flush — the transfers are queued ahead of it
+        self.queue_flush(x, y, w, h);
+    }
+
+    fn sync(&mut self) {
+        self.wait_idle();
+    }
+
+    fn insert_fence(&mut self) -> u32 {
+        self.kick_async();
+        self.reap_async();
+        if self.async_done(self.submit_seq) { 0 } else { self.submit_seq }
+    }
+
+    fn fence_passed(&mut self, id: u32) -> bool {
+        self.reap_async();
+        self.async_done(id)
+    }
+
+    fn wait_fence(&mut self, id: u32) {
+        self.wait_async(id);
     }
 
     fn has_hw_cursor(&self) -> bool {
@@ -972,6 +1193,18 @@ pub fn init_and_register(pci_dev: &PciDevice) -> bool {
         }
     };
 
+    let async_bufs = (physical::alloc_frame(), physical::alloc_frame());
+    let (async_cmd_buf, async_resp_buf) = match async_bufs {
+        (Some(c), Some(r)) => (c.as_u64(), r.as_u64()),
+        _ => {
+            crate::serial_println!("  VirtIO GPU: failed to allocate async buffers");
+            return false;
+        }
+    };
+    device.select_queue(0);
+    let ctrl_notify = device.notify_base
+        + device.read_queue_notify_off() as u64 * device.notify_off_mul as u64;
+
     // 8. Set DRIVER_OK
     device.set_driver_ok();
 
@@ -1014,6 +1247,13 @@ pub fn init_and_register(pci_dev: &PciDevice) -> bool {
         cmd_buf,
         resp_buf,
         cursor_buf_phys,
+        async_cmd_buf,
+        async_resp_buf,
+        inflight: [(0, 0); ASYNC_SLOTS],
+        submit_seq: 0,
+        unkicked: false,
+        ctrl_notify,
+        irq_active: false,
         supported: Vec::new(),
     };
 
@@ -1081,7 +1321,22 @@ pub fn init_and_register(pci_dev: &PciDevice) -> bool {
     gpu.cmd_transfer_to_host_2d(gpu.scanout_resource_id, 0, 0, width, height);
     gpu.cmd_resource_flush(gpu.scanout_resource_id, 0, 0, width, height);
 
-    crate::serial_println!("[OK] VirtIO GPU: {}x{} (fb={:#x})", width, height, gpu.fb_phys);
+    // Completions are polled; the interrupt only wakes fence waiters.
+    let irq = pci_dev.interrupt_line;
+    if irq > 0 && irq < 32 {
+        gpu.controlq.disable_interrupts();
+        VIRTIO_GPU_ISR.store(gpu.device.isr_addr, Ordering::Relaxed);
+        crate::arch::x86::irq::register_irq_chain(irq, virtio_gpu_irq_handler);
+        if crate::arch::x86::apic::is_initialized() {
+            crate::arch::x86::ioapic::unmask_irq(irq);
+        } else {
+            crate::arch::x86::pic::unmask(irq);
+        }
+        gpu.irq_active = true;
+    }
+
+    crate::serial_println!("[OK] VirtIO GPU: {}x{} (fb={:#x}, irq={})", width, height, gpu.fb_phys,
+        if gpu.irq_active { irq as i32 } else { -1 });
 
     // Register as the active GPU driver
     super::register(Box::new(gpu));
@@ -231,8 +231,12 @@ pub struct VmwareSvgaGpu {
     gmr_max_pages: u32,
     back_buffer_gmr: Option<u32>,
     back_buffer_offset: u32,
+    /// VRAM byte offset the screen is blitted from (0, or a direct-scanout surface).
+    scanout_offset: u32,
     gmr_pages: Vec<u64>,
     next_gmr_id: u32,
+    /// Undefined GMR IDs, reused before `next_gmr_id` advances.
+    free_gmr_ids: Vec<u32>,
 
     // Pre-allocated DMA staging buffer (identity-mapped, allocated at init)
     dma_staging_phys: u64,
@@ -562,17 +566,22 @@ impl VmwareSvgaGpu {
         if !self.has_gmr2 || phys_pages.is_empty() {
             return None;
         }
-        let gmr_id = self.next_gmr_id;
-        if gmr_id >= self.gmr_max_ids {
-            crate::serial_println!("  SVGA: GMR ID limit reached ({})", self.gmr_max_ids);
-            return None;
-        }
         let num_pages = phys_pages.len() as u32;
         if num_pages > self.gmr_max_pages {
             crate::serial_println!("  SVGA: GMR too large ({} > {} pages)", num_pages, self.gmr_max_pages);
             return None;
         }
-        self.next_gmr_id += 1;
+        let gmr_id = match self.free_gmr_ids.pop() {
+            Some(id) => id,
+            None if self.next_gmr_id < self.gmr_max_ids => {
+                self.next_gmr_id += 1;
+                self.next_gmr_id - 1
+            }
+            None => {
+                crate::serial_println!("  SVGA: GMR ID limit reached ({})", self.gmr_max_ids);
+                return None;
+            }
+        };
 
         // 1. DEFINE_GMR2: declare the region's total page count
         self.fifo_write_cmd(&[SVGA_CMD_DEFINE_GMR2, gmr_id, num_pages]);
@@ -602,6 +611,7 @@ impl VmwareSvgaGpu {
     /// Undefine a GMR2 (set numPages=0 to release).
     fn gmr2_undefine(&mut self, gmr_id: u32) {
         self.fifo_write_cmd(&[SVGA_CMD_DEFINE_GMR2, gmr_id, 0]);
+        self.free_gmr_ids.push(gmr_id);
     }
 
     /// Set the GMRFB (off-screen surface pointer) for blit operations.
@@ -676,6 +686,7 @@ impl GpuDriver for VmwareSvgaGpu {
     }
 
     fn set_mode(&mut self, width: u32, height: u32, bpp: u32) -> Option<(u32, u32, u32, u32)> {
+        self.scanout_offset = 0;
         self.reg_write(SVGA_REG_WIDTH, width);
         self.reg_write(SVGA_REG_HEIGHT, height);
         self.reg_write(SVGA_REG_BPP, bpp);
@@ -756,7 +767,7 @@ impl GpuDriver for VmwareSvgaGpu {
             } else {
                 // No GMR: blit from VRAM → Screen Object 0
                 // (SVGA_CMD_UPDATE is deprecated in Screen Object mode)
-                self.define_gmrfb(SVGA_GMR_FRAMEBUFFER, 0, self.pitch, 32);
+                self.define_gmrfb(SVGA_GMR_FRAMEBUFFER, self.scanout_offset, self.pitch, 32);
             }
             self.blit_gmrfb_to_screen(
                 x as i32, y as i32,
@@ -867,10 +878,42 @@ impl GpuDriver for VmwareSvgaGpu {
         }
     }
 
+    fn insert_fence(&mut self) -> u32 {
+        if !self.has_fences {
+            self.sync_fifo();
+            return 0;
+        }
+        let fence = self.fence_insert();
+        self.ring_doorbell();
+        fence
+    }
+
+    fn fence_passed(&mut self, id: u32) -> bool {
+        self.fence_has_passed(id)
+    }
+
+    fn wait_fence(&mut self, id: u32) {
+        self.fence_sync(id);
+    }
+
     fn vram_size(&self) -> u32 {
         self.vram_size_bytes
     }
 
+    fn set_scanout(&mut self, line: Option<u32>) -> bool {
+        // Screen updates are host blits from a GMRFB; pointing the GMRFB at
+        // the surface scans it out.  Legacy UPDATE always reads offset 0.
+        if !self.has_screen_object || self.back_buffer_gmr.is_some() {
+            return line.is_none();
+        }
+        let offset = line.unwrap_or(0) as u64 * self.pitch as u64;
+        if offset + self.pitch as u64 * self.height as u64 > self.vram_size_bytes as u64 {
+            return false;
+        }
+        self.scanout_offset = offset as u32;
+        true
+    }
+
     fn register_back_buffer(&mut self, phys_pages: &[u64], sub_page_offset: u32) -> bool {
         if !self.has_gmr2 || !self.has_screen_object || phys_pages.is_empty() {
             return false;
@@ -964,6 +1007,22 @@ impl GpuDriver for VmwareSvgaGpu {
         true
     }
 
+    fn define_guest_region(&mut self, phys_pages: &[u64]) -> Option<u32> {
+        if !self.has_3d() {
+            return None;
+        }
+        let gmr_id = self.gmr2_define(phys_pages)?;
+        self.sync_fifo();
+        Some(gmr_id)
+    }
+
+    fn release_guest_region(&mut self, gmr_id: u32) {
+        // Commands already queued may still DMA from the region.
+        self.sync_fifo();
+        self.gmr2_undefine(gmr_id);
+        self.sync_fifo();
+    }
+
     fn dma_surface_download(&mut self, sid: u32, buf: &mut [u8], width: u32, height: u32) -> bool {
         if !self.has_3d() || !self.has_gmr2 || !self.has_screen_object || buf.is_empty() {
             return false;
@@ -1106,8 +1165,10 @@ pub fn init_and_register(pci_dev: &PciDevice) -> bool {
         gmr_max_pages: 0,
         back_buffer_gmr: None,
         back_buffer_offset: 0,
+        scanout_offset: 0,
         gmr_pages: Vec::new(),
         next_gmr_id: 0,
+        free_gmr_ids: Vec::new(),
         dma_staging_phys: 0,
         dma_staging_pages: 0,
         dma_staging_gmr: None,
@@ -231,7 +231,8 @@ pub fn count_by_type(dtype: DriverType) -> usize {
     }
 }
 
-/// Return all PCI devices that already have bound drivers.
+/// Return all PCI devices that already have bound drivers (or a built-in
+/// driver whose deferred probe has not finished yet).
 #[cfg(target_arch = "x86_64")]
 pub fn bound_pci_devices() -> Vec<PciDevice> {
     let hal = HAL.lock();
@@ -243,6 +244,9 @@ pub fn bound_pci_devices() -> Vec<PciDevice> {
             }
         }
     }
+    drop(hal);
+    // Devices queued for a deferred probe already have a built-in driver
+    result.extend(DEFERRED.lock().pending.iter().cloned());
     result
 }
 
@@ -287,65 +291,212 @@ pub fn make_device_path(dtype: DriverType, index: usize) -> String {
 // PCI probe (delegates to pci_drivers table)
 // ──────────────────────────────────────────────
 
+/// Deferred-probe worker threads at most (one per PCI class group).
+#[cfg(target_arch = "x86_64")]
+const MAX_PROBE_WORKERS: usize = 4;
+
+/// A PCI device whose driver is probed after the APs come up.
+#[cfg(target_arch = "x86_64")]
+struct ProbeJob {
+    pci: PciDevice,
+    factory: fn(&PciDevice) -> Option<Box<dyn Driver>>,
+}
+
+#[cfg(target_arch = "x86_64")]
+struct DeferredProbes {
+    /// Unclaimed jobs, one group per PCI class in bus order.  A worker takes
+    /// a whole group, so drivers sharing controller state (EHCI and its
+    /// companions, two audio codecs) never probe concurrently.
+    groups: Vec<Vec<ProbeJob>>,
+    /// Devices queued or being probed.
+    pending: Vec<PciDevice>,
+    /// Workers still running.
+    workers: usize,
+    /// `monotonic_ns` when the workers were started.
+    started_ns: u64,
+}
+
+#[cfg(target_arch = "x86_64")]
+static DEFERRED: Spinlock<DeferredProbes> = Spinlock::new(DeferredProbes {
+    groups: Vec::new(),
+    pending: Vec::new(),
+    workers: 0,
+    started_ns: 0,
+});
+
+/// Next device index per `DriverType` discriminant (10 variants), shared
+/// by the BSP and the probe workers.
+#[cfg(target_arch = "x86_64")]
+static TYPE_COUNTERS: Spinlock<[usize; 10]> = Spinlock::new([0; 10]);
+
+/// Probe time of every PCI driver factory, `(name, bus, device, function, us)`.
+#[cfg(target_arch = "x86_64")]
+static PROBE_TIMES: Spinlock<Vec<(String, u8, u8, u8, u64)>> = Spinlock::new(Vec::new());
+
+/// Best matching driver entry for `pci_dev` (highest specificity wins).
+#[cfg(target_arch = "x86_64")]
+fn match_driver(pci_dev: &PciDevice) -> Option<&'static crate::drivers::pci_drivers::PciDriverEntry> {
+    use crate::drivers::pci_drivers::{PCI_DRIVER_TABLE, matches_pci};
+
+    let mut best: Option<&crate::drivers::pci_drivers::PciDriverEntry> = None;
+    for entry in PCI_DRIVER_TABLE {
+        if matches_pci(&entry.match_rule, pci_dev) {
+            if best.is_none() || entry.specificity > best.unwrap().specificity {
+                best = Some(entry);
+            }
+        }
+    }
+    best
+}
+
+/// Run one driver factory, initialize and register the driver.  Records
+/// and logs the time it took.  Returns `true` if a driver was bound.
+#[cfg(target_arch = "x86_64")]
+fn probe_one(pci_dev: &PciDevice, factory: fn(&PciDevice) -> Option<Box<dyn Driver>>) -> bool {
+    let t0 = crate::arch::hal::monotonic_ns();
+    let Some(mut driver) = factory(pci_dev) else {
+        let us = crate::arch::hal::monotonic_ns().saturating_sub(t0) / 1000;
+        crate::serial_println!(
+            "  HAL: probe of PCI {:02x}:{:02x}.{} found no device ({} us)",
+            pci_dev.bus, pci_dev.device, pci_dev.function, us
+        );
+        return false;
+    };
+    if let Err(e) = driver.init() {
+        crate::serial_println!(
+            "  HAL: WARN - driver '{}' init failed: {:?}",
+            driver.name(), e
+        );
+    }
+    let us = crate::arch::hal::monotonic_ns().saturating_sub(t0) / 1000;
+    crate::serial_println!(
+        "  HAL: probed '{}' at PCI {:02x}:{:02x}.{} in {} us (CPU {})",
+        driver.name(), pci_dev.bus, pci_dev.device, pci_dev.function,
+        us, crate::arch::hal::cpu_id()
+    );
+    PROBE_TIMES.lock().push((
+        String::from(driver.name()), pci_dev.bus, pci_dev.device, pci_dev.function, us,
+    ));
+
+    let dtype = driver.driver_type();
+    let dev_index = {
+        let mut counters = TYPE_COUNTERS.lock();
+        let index = counters[dtype as usize];
+        counters[dtype as usize] += 1;
+        index
+    };
+    let path = make_device_path(dtype, dev_index);
+    register_device(&path, driver, Some(pci_dev.clone()));
+    true
+}
+
 /// Probe all PCI devices and bind matching drivers.
 /// Skips bridges (class 0x06) since they don't need a user-facing driver.
+///
+/// Boot-stage drivers (storage, display) are probed here, on the BSP, so
+/// the root disk exists before it is mounted.  Deferred-stage drivers are
+/// queued for [`start_deferred_probes`].
 #[cfg(target_arch = "x86_64")]
 pub fn probe_and_bind_all() {
-    use crate::drivers::pci_drivers::{PCI_DRIVER_TABLE, matches_pci};
+    use crate::drivers::pci_drivers::ProbeStage;
 
     let pci_devices = crate::drivers::pci::devices();
     let mut bound = 0u32;
-    let mut type_counters = [0usize; 10]; // indexed by DriverType discriminant (10 variants)
+    let mut deferred = 0u32;
+    let t0 = crate::arch::hal::monotonic_ns();
 
     crate::serial_println!("  HAL: Probing {} PCI device(s) for drivers...", pci_devices.len());
 
+    let mut queue = DEFERRED.lock();
     for pci_dev in &pci_devices {
         // Skip bridges — they don't need a user-facing driver
         if pci_dev.class_code == 0x06 {
             continue;
         }
 
-        // Find best matching driver entry (highest specificity wins)
-        let mut best: Option<&crate::drivers::pci_drivers::PciDriverEntry> = None;
-        for entry in PCI_DRIVER_TABLE {
-            if matches_pci(&entry.match_rule, pci_dev) {
-                if best.is_none() || entry.specificity > best.unwrap().specificity {
-                    best = Some(entry);
+        match match_driver(pci_dev) {
+            Some(entry) if entry.stage == ProbeStage::Deferred => {
+                let job = ProbeJob { pci: pci_dev.clone(), factory: entry.factory };
+                match queue.groups.iter_mut().find(|g| g[0].pci.class_code == pci_dev.class_code) {
+                    Some(group) => group.push(job),
+                    None => queue.groups.push(alloc::vec![job]),
+                }
+                queue.pending.push(pci_dev.clone());
+                deferred += 1;
+            }
+            Some(entry) => {
+                if probe_one(pci_dev, entry.factory) {
+                    bound += 1;
                 }
             }
+            None => {
+                crate::debug_println!(
+                    "  HAL: no driver for PCI {:02x}:{:02x}.{} ({:04x}:{:04x} class {:02x}:{:02x})",
+                    pci_dev.bus, pci_dev.device, pci_dev.function,
+                    pci_dev.vendor_id, pci_dev.device_id,
+                    pci_dev.class_code, pci_dev.subclass
+                );
+            }
         }
+    }
+    drop(queue);
 
-        if let Some(entry) = best {
-            if let Some(mut driver) = (entry.factory)(pci_dev) {
-                let dtype = driver.driver_type();
-                let type_idx = dtype as usize;
-                let dev_index = type_counters[type_idx];
-                type_counters[type_idx] += 1;
-
-                let path = make_device_path(dtype, dev_index);
-
-                // Initialize the driver
-                if let Err(e) = driver.init() {
-                    crate::serial_println!(
-                        "  HAL: WARN - driver '{}' init failed: {:?}",
-                        driver.name(), e
-                    );
-                }
+    crate::serial_println!(
+        "  HAL: Bound {} PCI driver(s) in {} ms, {} deferred",
+        bound, crate::arch::hal::monotonic_ns().saturating_sub(t0) / 1_000_000, deferred
+    );
+}
 
-                register_device(&path, driver, Some(pci_dev.clone()));
-                bound += 1;
-            }
-        } else {
-            crate::debug_println!(
-                "  HAL: no driver for PCI {:02x}:{:02x}.{} ({:04x}:{:04x} class {:02x}:{:02x})",
-                pci_dev.bus, pci_dev.device, pci_dev.function,
-                pci_dev.vendor_id, pci_dev.device_id,
-                pci_dev.class_code, pci_dev.subclass
-            );
+/// Spawn the workers that probe the deferred-stage drivers.  Called with
+/// the other boot kernel threads after the APs are running, so the probes
+/// (USB port resets, codec discovery) overlap with each other and with
+/// userspace startup instead of delaying the root mount.
+#[cfg(target_arch = "x86_64")]
+pub fn start_deferred_probes() {
+    let workers = {
+        let mut queue = DEFERRED.lock();
+        let cpus = crate::arch::hal::cpu_count().max(1);
+        let workers = queue.groups.len().min(cpus).min(MAX_PROBE_WORKERS);
+        queue.workers = workers;
+        queue.started_ns = crate::arch::hal::monotonic_ns();
+        workers
+    };
+    for _ in 0..workers {
+        crate::task::scheduler::spawn(probe_worker, 45, "pci_probe");
+    }
+}
+
+/// Deferred-probe worker: claims class groups until none are left.
+#[cfg(target_arch = "x86_64")]
+extern "C" fn probe_worker() {
+    loop {
+        let group = DEFERRED.lock().groups.pop();
+        let Some(group) = group else { break };
+        for job in &group {
+            probe_one(&job.pci, job.factory);
+            DEFERRED.lock().pending.retain(|d| {
+                d.bus != job.pci.bus || d.device != job.pci.device || d.function != job.pci.function
+            });
         }
     }
 
-    crate::serial_println!("  HAL: Bound {} PCI driver(s)", bound);
+    let (last, started_ns) = {
+        let mut queue = DEFERRED.lock();
+        queue.workers -= 1;
+        (queue.workers == 0, queue.started_ns)
+    };
+    if last {
+        let mut times = PROBE_TIMES.lock().clone();
+        times.sort_unstable_by(|a, b| b.4.cmp(&a.4));
+        crate::serial_println!(
+            "[OK] HAL: deferred probes done after {} ms; slowest:",
+            crate::arch::hal::monotonic_ns().saturating_sub(started_ns) / 1_000_000
+        );
+        for (name, bus, device, function, us) in times.iter().take(5) {
+            crate::serial_println!("    {:>8} us  {} ({:02x}:{:02x}.{})", us, name, bus, device, function);
+        }
+    }
+    crate::task::scheduler::exit_current(0);
 }
 
 // ──────────────────────────────────────────────
@@ -1,7 +1,7 @@
 //! Device drivers for hardware peripherals.
 //!
 //! Includes serial, framebuffer, VGA text, input (keyboard/mouse), storage (ATA),
-//! GPU (Bochs VGA, VMware SVGA II), networking (E1000), PCI bus, RTC, and the HAL registry.
+//! GPU (Bochs VGA, VMware SVGA II), networking (E1000, VirtIO-Net), PCI bus, RTC, and the HAL registry.
 
 // x86-only hardware drivers
 #[cfg(target_arch = "x86_64")]
@@ -1,8 +1,10 @@
 //! Intel E1000 NIC driver (82540EM / 82545EM).
 //!
 //! MMIO-based Ethernet controller with DMA ring buffers for RX/TX.
-//! Supports IRQ-driven and polled packet reception, transmit via descriptor rings,
-//! and MAC address reading from EEPROM/RAL registers.
+//! Reception is NAPI-style: the (ITR-throttled) RX interrupt only masks
+//! itself and wakes the `net_rx` thread, which reaps the ring in budgeted
+//! passes (see `net::rx`).  Transmit via descriptor rings, MAC address
+//! reading from EEPROM/RAL registers.
 //! Supports: 82540EM (8086:100E, QEMU) and 82545EM (8086:100F, VMware).
 
 use alloc::boxed::Box;
@@ -12,6 +14,9 @@ use crate::drivers::pci::PciDevice;
 use crate::sync::spinlock::Spinlock;
 use crate::memory::address::{PhysAddr, VirtAddr};
 use crate::memory::{physical, virtual_mem, FRAME_SIZE};
+use crate::net::checksum::TxOffload;
+use crate::net::pktbuf::PacketBuf;
+use core::sync::atomic::{AtomicBool, Ordering};
 
 // ──────────────────────────────────────────────
 // E1000 Register Offsets
@@ -21,6 +26,7 @@ const REG_CTRL: u32       = 0x0000; // Device Control
 const REG_STATUS: u32     = 0x0008; // Device Status
 const REG_EERD: u32       = 0x0014; // EEPROM Read
 const REG_ICR: u32        = 0x00C0; // Interrupt Cause Read
+const REG_ITR: u32        = 0x00C4; // Interrupt Throttling
 const REG_IMS: u32        = 0x00D0; // Interrupt Mask Set
 const REG_IMC: u32        = 0x00D8; // Interrupt Mask Clear
 const REG_RCTL: u32       = 0x0100; // Receive Control
@@ -39,6 +45,7 @@ const REG_RAL0: u32       = 0x5400; // Receive Address Low (MAC bytes 0-3)
 const REG_RAH0: u32       = 0x5404; // Receive Address High (MAC bytes 4-5 + flags)
 const REG_MTA: u32        = 0x5200; // Multicast Table Array (128 u32s)
 const REG_TIPG: u32       = 0x0410; // Transmit IPG
+const REG_RXCSUM: u32     = 0x5000; // RX Checksum Control
 
 // CTRL bits
 const CTRL_SLU: u32       = 1 << 6;  // Set Link Up
@@ -50,6 +57,10 @@ const RCTL_BAM: u32       = 1 << 15; // Broadcast Accept Mode
 const RCTL_BSIZE_2048: u32 = 0;      // Buffer size 2048 (bits 16-17 = 00)
 const RCTL_SECRC: u32     = 1 << 26; // Strip Ethernet CRC
 
+// RXCSUM bits
+const RXCSUM_IPOFL: u32   = 1 << 8;  // IPv4 header checksum offload
+const RXCSUM_TUOFL: u32   = 1 << 9;  // TCP/UDP checksum offload
+
 // TCTL bits
 const TCTL_EN: u32        = 1 << 1;  // Transmit Enable
 const TCTL_PSP: u32       = 1 << 3;  // Pad Short Packets
@@ -61,10 +72,23 @@ const ICR_TXDW: u32       = 1 << 0;  // TX Descriptor Written Back
 const ICR_RXT0: u32       = 1 << 7;  // RX Timer Interrupt
 const ICR_LSC: u32        = 1 << 2;  // Link Status Change
 
+/// Minimum gap between interrupts in ITR units of 256 ns (~8000 IRQs/s).
+const ITR_INTERVAL: u32   = 488;
+
 // TX descriptor command bits
 const TDESC_CMD_EOP: u8   = 1 << 0;  // End of Packet
 const TDESC_CMD_IFCS: u8  = 1 << 1;  // Insert FCS
 const TDESC_CMD_RS: u8    = 1 << 3;  // Report Status
+const TDESC_CMD_DEXT: u8  = 1 << 5;  // Extended descriptor (context / data)
+
+// Extended TX data descriptor: DTYP in the upper nibble of byte 10, POPTS
+const TDESC_DTYP_DATA: u8 = 1 << 4;  // DTYP = 0001 (data)
+const TDESC_POPTS_IXSM: u8 = 1 << 0; // Insert IPv4 checksum
+const TDESC_POPTS_TXSM: u8 = 1 << 1; // Insert TCP/UDP checksum
+
+// TX context descriptor TUCMD bits
+const TCTX_TUCMD_TCP: u8  = 1 << 0;  // TCP (clear = UDP)
+const TCTX_TUCMD_IP: u8   = 1 << 1;  // IPv4
 
 // TX descriptor status bits
 const TDESC_STA_DD: u8    = 1 << 0;  // Descriptor Done
@@ -72,6 +96,13 @@ const TDESC_STA_DD: u8    = 1 << 0;  // Descriptor Done
 // RX descriptor status bits
 const RDESC_STA_DD: u8    = 1 << 0;  // Descriptor Done
 const RDESC_STA_EOP: u8   = 1 << 1;  // End of Packet
+const RDESC_STA_IXSM: u8  = 1 << 2;  // Ignore checksum indication
+const RDESC_STA_TCPCS: u8 = 1 << 5;  // TCP/UDP checksum calculated
+const RDESC_STA_IPCS: u8  = 1 << 6;  // IPv4 checksum calculated
+
+// RX descriptor error bits
+const RDESC_ERR_TCPE: u8  = 1 << 5;  // TCP/UDP checksum error
+const RDESC_ERR_IPE: u8   = 1 << 6;  // IPv4 checksum error
 
 // ──────────────────────────────────────────────
 // DMA Descriptors
@@ -84,8 +115,12 @@ const NUM_RX_DESC: usize = 256;
 /// Number of transmit descriptors in the TX ring.
 /// 256 descriptors allows batching many segments with a single tail update.
 const NUM_TX_DESC: usize = 256;
-/// Size of each receive buffer in bytes.
-const RX_BUFFER_SIZE: usize = 2048;
+/// Size of each receive buffer in bytes (one packet pool buffer).
+const RX_BUFFER_SIZE: usize = crate::net::pktbuf::BUF_SIZE;
+/// Received frames queued for the network stack before new ones are dropped.
+const RX_QUEUE_LIMIT: usize = 1024;
+/// Minimum Ethernet frame length without FCS; shorter frames are zero-padded.
+const MIN_FRAME_LEN: usize = 60;
 
 #[repr(C)]
 #[derive(Clone, Copy)]
@@ -110,6 +145,26 @@ struct TxDescriptor {
     special: u16,      // Special field
 }
 
+/// TX context descriptor: loads the checksum offsets that following
+/// extended data descriptors use.  Same 16-byte slot as [`TxDescriptor`]
+/// (the DD status byte is at the same offset).
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct TxContextDescriptor {
+    ipcss: u8,         // IPv4 checksum start
+    ipcso: u8,         // IPv4 checksum field offset
+    ipcse: u16,        // IPv4 checksum end (inclusive)
+    tucss: u8,         // TCP/UDP checksum start
+    tucso: u8,         // TCP/UDP checksum field offset
+    tucse: u16,        // TCP/UDP checksum end (0 = end of packet)
+    paylen: u16,       // Payload length (TSO only)
+    dtyp: u8,          // DTYP = 0000 (context) in upper nibble
+    tucmd: u8,         // Command field
+    status: u8,        // Status bits
+    hdrlen: u8,        // Header length (TSO only)
+    mss: u16,          // MSS (TSO only)
+}
+
 /// 6-byte MAC address type alias.
 pub type MacBytes = [u8; 6];
 
@@ -127,7 +182,7 @@ struct E1000 {
     // RX ring
     rx_descs_phys: u32,   // Physical address of RX descriptor ring (32-bit DMA)
     rx_descs_virt: u64,   // Virtual address of RX descriptor ring
-    rx_bufs_phys: [u32; NUM_RX_DESC], // Physical addr of each RX buffer (32-bit DMA)
+    rx_bufs: Vec<PacketBuf>, // Pool buffer posted to each RX descriptor
     rx_tail: u16,
 
     // TX ring
@@ -136,9 +191,10 @@ struct E1000 {
     tx_bufs_phys: [u32; NUM_TX_DESC], // Physical addr of each TX buffer (32-bit DMA)
     tx_bufs_virt: [u64; NUM_TX_DESC], // Virtual addr of each TX buffer (for memcpy)
     tx_tail: u16,
+    tx_ctx: Option<TxOffload>, // Checksum context last loaded into the NIC
 
     // Received packets queue
-    rx_queue: VecDeque<Vec<u8>>,
+    rx_queue: VecDeque<PacketBuf>,
 
     // IRQ line
     irq: u8,
@@ -154,6 +210,9 @@ struct E1000 {
 
 static E1000_STATE: Spinlock<Option<E1000>> = Spinlock::new(None);
 
+/// Whether TX checksum offload is enabled (set once the rings are up).
+static TX_CSUM_OFFLOAD: AtomicBool = AtomicBool::new(false);
+
 // ──────────────────────────────────────────────
 // MMIO helpers
 // ──────────────────────────────────────────────
@@ -274,21 +333,19 @@ pub fn init() -> bool {
         core::ptr::write_bytes(rx_descs_virt as *mut u8, 0, FRAME_SIZE);
     }
 
-    // Allocate RX buffers (one 4K page per buffer, each buffer is 2048 bytes)
-    let mut rx_bufs_phys = [0u32; NUM_RX_DESC];
+    // Post a packet pool buffer to every RX descriptor; the hardware DMAs
+    // frames straight into buffers the network stack then consumes in place.
+    crate::net::pktbuf::init();
+    let mut rx_bufs = Vec::with_capacity(NUM_RX_DESC);
     for i in 0..NUM_RX_DESC {
-        let buf_frame = physical::alloc_frame().expect("E1000: failed to alloc RX buffer");
-        rx_bufs_phys[i] = buf_frame.as_u32();
-        // Zero the buffer
-        unsafe {
-            core::ptr::write_bytes(buf_frame.as_u64() as *mut u8, 0, FRAME_SIZE);
-        }
+        let buf = PacketBuf::alloc().expect("E1000: failed to alloc RX buffer");
         // Write descriptor
         unsafe {
             let desc_ptr = (rx_descs_virt as *mut RxDescriptor).add(i);
-            (*desc_ptr).buffer_addr = buf_frame.as_u64();
+            (*desc_ptr).buffer_addr = buf.phys();
             (*desc_ptr).status = 0;
         }
+        rx_bufs.push(buf);
     }
 
     // --- Allocate TX descriptor ring and buffers ---
@@ -339,6 +396,11 @@ pub fn init() -> bool {
         mmio_write(mmio_virt, REG_TIPG, 10 | (8 << 10) | (6 << 20));
     }
 
+    // --- RX checksum offload: verify IPv4 and TCP/UDP checksums in hardware ---
+    unsafe {
+        mmio_write(mmio_virt, REG_RXCSUM, RXCSUM_IPOFL | RXCSUM_TUOFL);
+    }
+
     // --- Enable RX ---
     unsafe {
         mmio_write(mmio_virt, REG_RCTL,
@@ -356,6 +418,7 @@ pub fn init() -> bool {
 
     // --- Enable interrupts ---
     unsafe {
+        mmio_write(mmio_virt, REG_ITR, ITR_INTERVAL);
         mmio_read(mmio_virt, REG_ICR); // Clear any pending
         mmio_write(mmio_virt, REG_IMS, ICR_RXT0 | ICR_LSC | ICR_TXDW);
     }
@@ -366,14 +429,15 @@ pub fn init() -> bool {
         mac,
         rx_descs_phys: rx_descs_phys,
         rx_descs_virt: rx_descs_virt,
-        rx_bufs_phys,
+        rx_bufs,
         rx_tail: (NUM_RX_DESC - 1) as u16,
         tx_descs_phys: tx_descs_phys,
         tx_descs_virt: tx_descs_virt,
         tx_bufs_phys,
         tx_bufs_virt,
         tx_tail: 0,
-        rx_queue: VecDeque::new(),
+        tx_ctx: None,
+        rx_queue: VecDeque::with_capacity(RX_QUEUE_LIMIT),
         irq,
         rx_packets: 0,
         tx_packets: 0,
@@ -388,12 +452,19 @@ pub fn init() -> bool {
         *state = Some(e1000);
     }
 
-    // Register IRQ handler
-    crate::arch::x86::irq::register_irq(irq, e1000_irq_handler);
-    if crate::arch::x86::apic::is_initialized() {
-        crate::arch::x86::ioapic::unmask_irq(irq);
+    // Register IRQ handler: an MSI vector of its own if the device has the
+    // capability, else the (possibly shared) INTx line
+    let irq_mode = crate::drivers::pci::msi_enable(&pci_dev, e1000_irq_handler,
+        crate::drivers::pci::IrqAffinity::Spread);
+    if let Some(vector) = irq_mode {
+        crate::serial_println!("  E1000: MSI (IRQ {})", vector);
     } else {
-        crate::arch::x86::pic::unmask(irq);
+        crate::arch::x86::irq::register_irq(irq, e1000_irq_handler);
+        if crate::arch::x86::apic::is_initialized() {
+            crate::arch::x86::ioapic::unmask_irq(irq);
+        } else {
+            crate::arch::x86::pic::unmask(irq);
+        }
     }
 
     // Check link status
@@ -402,8 +473,11 @@ pub fn init() -> bool {
     crate::serial_println!("[OK] E1000 NIC initialized ({} RX + {} TX descriptors)",
         NUM_RX_DESC, NUM_TX_DESC);
 
+    TX_CSUM_OFFLOAD.store(true, Ordering::Relaxed);
+
     // Register with the generic network subsystem
     super::register(Box::new(E1000NetworkDriver));
+    super::set_backend(super::NicBackend::E1000);
 
     true
 }
@@ -411,7 +485,24 @@ pub fn init() -> bool {
 /// Transmit a raw Ethernet frame (including Ethernet header).
 /// Returns true on success.
 pub fn transmit(data: &[u8]) -> bool {
-    if data.len() > RX_BUFFER_SIZE {
+    transmit_parts(&[data], None)
+}
+
+/// Whether the NIC inserts IPv4 and TCP/UDP checksums on transmit.
+pub fn tx_checksum_offload() -> bool {
+    TX_CSUM_OFFLOAD.load(Ordering::Relaxed)
+}
+
+/// Transmit one Ethernet frame given as consecutive pieces (e.g. Ethernet
+/// header, IPv4 header, payload), gathered straight into the descriptor's
+/// DMA buffer and zero-padded to the minimum frame length.  Saves the
+/// protocol layers from assembling the frame in a temporary buffer first.
+///
+/// With `offload` the NIC computes the IPv4 and TCP/UDP checksums; a
+/// context descriptor is queued first whenever the offsets change.
+pub fn transmit_parts(parts: &[&[u8]], offload: Option<TxOffload>) -> bool {
+    let len: usize = parts.iter().map(|p| p.len()).sum();
+    if len == 0 || len > RX_BUFFER_SIZE {
         return false;
     }
 
@@ -421,32 +512,77 @@ pub fn transmit(data: &[u8]) -> bool {
         None => return false,
     };
 
-    let idx = e1000.tx_tail as usize;
-    let desc_ptr = (e1000.tx_descs_virt as *mut TxDescriptor).wrapping_add(idx);
+    let new_ctx = offload.is_some() && offload != e1000.tx_ctx;
+    let mut idx = e1000.tx_tail as usize;
+    let descs = e1000.tx_descs_virt as *mut TxDescriptor;
+    let desc_ptr = |i: usize| descs.wrapping_add(i);
 
-    // Check if descriptor is available (DD bit set means hardware is done with it)
-    let status = unsafe { core::ptr::read_volatile(&(*desc_ptr).status) };
-    if status & TDESC_STA_DD == 0 {
-        // Descriptor not yet processed by hardware
-        return false;
+    // Check if descriptors are available (DD bit set means hardware is done with them)
+    let needed = if new_ctx { 2 } else { 1 };
+    for k in 0..needed {
+        let d = desc_ptr((idx + k) % NUM_TX_DESC);
+        let status = unsafe { core::ptr::read_volatile(&(*d).status) };
+        if status & TDESC_STA_DD == 0 {
+            // Descriptor not yet processed by hardware
+            return false;
+        }
     }
 
-    // Copy data to TX buffer
+    if let (true, Some(o)) = (new_ctx, offload) {
+        let ctx = TxContextDescriptor {
+            ipcss: o.ip_start,
+            ipcso: o.ip_start + 10,
+            ipcse: o.l4_start as u16 - 1,
+            tucss: o.l4_start,
+            tucso: o.l4_csum,
+            tucse: 0,
+            paylen: 0,
+            dtyp: 0,
+            tucmd: TDESC_CMD_DEXT | TDESC_CMD_RS | TCTX_TUCMD_IP
+                | if o.tcp { TCTX_TUCMD_TCP } else { 0 },
+            status: 0,
+            hdrlen: 0,
+            mss: 0,
+        };
+        unsafe { core::ptr::write_volatile(desc_ptr(idx) as *mut TxContextDescriptor, ctx); }
+        e1000.tx_ctx = offload;
+        idx = (idx + 1) % NUM_TX_DESC;
+    }
+
+    // Gather the pieces into the TX buffer
     let buf_virt = e1000.tx_bufs_virt[idx] as *mut u8;
+    let mut off = 0usize;
     unsafe {
-        core::ptr::copy_nonoverlapping(data.as_ptr(), buf_virt, data.len());
+        for part in parts {
+            core::ptr::copy_nonoverlapping(part.as_ptr(), buf_virt.add(off), part.len());
+            off += part.len();
+        }
+        if off < MIN_FRAME_LEN {
+            core::ptr::write_bytes(buf_virt.add(off), 0, MIN_FRAME_LEN - off);
+            off = MIN_FRAME_LEN;
+        }
     }
 
-    // Update descriptor
-    unsafe {
-        (*desc_ptr).length = data.len() as u16;
-        (*desc_ptr).cmd = TDESC_CMD_EOP | TDESC_CMD_IFCS | TDESC_CMD_RS;
-        (*desc_ptr).status = 0; // Clear DD
-    }
+    // Update descriptor (the slot may last have held a context descriptor,
+    // so every field is rewritten)
+    let (dtyp, dext, popts) = match offload {
+        Some(_) => (TDESC_DTYP_DATA, TDESC_CMD_DEXT, TDESC_POPTS_IXSM | TDESC_POPTS_TXSM),
+        None => (0, 0, 0),
+    };
+    let desc = TxDescriptor {
+        buffer_addr: e1000.tx_bufs_phys[idx] as u64,
+        length: off as u16,
+        cso: dtyp,
+        cmd: TDESC_CMD_EOP | TDESC_CMD_IFCS | TDESC_CMD_RS | dext,
+        status: 0, // Clear DD
+        css: popts,
+        special: 0,
+    };
+    unsafe { core::ptr::write_volatile(desc_ptr(idx), desc); }
 
     // Statistics
     e1000.tx_packets += 1;
-    e1000.tx_bytes += data.len() as u64;
+    e1000.tx_bytes += off as u64;
 
     // Advance tail
     e1000.tx_tail = ((idx + 1) % NUM_TX_DESC) as u16;
@@ -495,12 +631,18 @@ pub fn transmit_batch(frames: &[&[u8]]) -> usize {
             core::ptr::copy_nonoverlapping(frame.as_ptr(), buf_virt, frame.len());
         }
 
-        // Update descriptor
-        unsafe {
-            (*desc_ptr).length = frame.len() as u16;
-            (*desc_ptr).cmd = TDESC_CMD_EOP | TDESC_CMD_IFCS | TDESC_CMD_RS;
-            (*desc_ptr).status = 0;
-        }
+        // Update descriptor (legacy format; the slot may have held a
+        // context or extended descriptor)
+        let desc = TxDescriptor {
+            buffer_addr: e1000.tx_bufs_phys[idx] as u64,
+            length: frame.len() as u16,
+            cso: 0,
+            cmd: TDESC_CMD_EOP | TDESC_CMD_IFCS | TDESC_CMD_RS,
+            status: 0,
+            css: 0,
+            special: 0,
+        };
+        unsafe { core::ptr::write_volatile(desc_ptr, desc); }
 
         // Statistics
         e1000.tx_packets += 1;
@@ -522,7 +664,7 @@ pub fn transmit_batch(frames: &[&[u8]]) -> usize {
 }
 
 /// Dequeue a received packet. Returns None if no packets available.
-pub fn recv_packet() -> Option<Vec<u8>> {
+pub fn recv_packet() -> Option<PacketBuf> {
     let mut state = E1000_STATE.lock();
     let e1000 = state.as_mut()?;
     e1000.rx_queue.pop_front()
@@ -531,15 +673,13 @@ pub fn recv_packet() -> Option<Vec<u8>> {
 /// Drain all received packets from the queue in a single lock acquisition.
 /// Much more efficient than calling recv_packet() in a loop when processing
 /// a burst of packets.
-pub fn recv_all_packets(out: &mut Vec<Vec<u8>>) {
+pub fn recv_all_packets(out: &mut Vec<PacketBuf>) {
     let mut state = E1000_STATE.lock();
     let e1000 = match state.as_mut() {
         Some(e) => e,
         None => return,
     };
-    while let Some(pkt) = e1000.rx_queue.pop_front() {
-        out.push(pkt);
-    }
+    out.extend(e1000.rx_queue.drain(..));
 }
 
 /// Get the MAC address of the NIC.
@@ -608,24 +748,53 @@ pub fn get_stats() -> (u64, u64, u64, u64, u64, u64) {
     }
 }
 
-/// Poll for received packets (non-interrupt driven).
-/// Call this to process any packets that arrived since last check.
-pub fn poll_rx() {
+/// Poll for received packets (non-interrupt driven): reap at most `budget`
+/// descriptors into the RX queue.  Returns the number reaped.
+pub fn poll_rx(budget: usize) -> usize {
     let mut state = E1000_STATE.lock();
     let e1000 = match state.as_mut() {
         Some(e) => e,
-        None => return,
+        None => return 0,
+    };
+    process_rx_ring(e1000, budget)
+}
+
+/// Unmask (or mask) the RX interrupt.  Unmasking returns false, leaving the
+/// interrupt masked, if the next descriptor is already done.
+pub fn set_rx_irq(enabled: bool) -> bool {
+    let state = E1000_STATE.lock();
+    let e1000 = match state.as_ref() {
+        Some(e) => e,
+        None => return true,
     };
-    process_rx_ring(e1000);
+    if !enabled {
+        unsafe { mmio_write(e1000.mmio_base, REG_IMC, ICR_RXT0); }
+        return true;
+    }
+    unsafe { mmio_write(e1000.mmio_base, REG_IMS, ICR_RXT0); }
+    if rx_pending(e1000) {
+        unsafe { mmio_write(e1000.mmio_base, REG_IMC, ICR_RXT0); }
+        return false;
+    }
+    true
 }
 
 // ──────────────────────────────────────────────
 // Internal: RX ring processing
 // ──────────────────────────────────────────────
 
-fn process_rx_ring(e1000: &mut E1000) {
+/// Whether the descriptor after the tail has been filled.
+fn rx_pending(e1000: &E1000) -> bool {
+    let idx = ((e1000.rx_tail + 1) % NUM_RX_DESC as u16) as usize;
+    let desc_ptr = (e1000.rx_descs_virt as *const RxDescriptor).wrapping_add(idx);
+    unsafe { core::ptr::read_volatile(&(*desc_ptr).status) & RDESC_STA_DD != 0 }
+}
+
+/// Reap up to `budget` completed descriptors; returns how many.
+fn process_rx_ring(e1000: &mut E1000, budget: usize) -> usize {
     let mut new_tail = e1000.rx_tail;
-    loop {
+    let mut reaped = 0;
+    while reaped < budget {
         let idx = ((new_tail + 1) % NUM_RX_DESC as u16) as usize;
         let desc_ptr = (e1000.rx_descs_virt as *mut RxDescriptor).wrapping_add(idx);
 
@@ -635,30 +804,40 @@ fn process_rx_ring(e1000: &mut E1000) {
         }
 
         let length = unsafe { core::ptr::read_volatile(&(*desc_ptr).length) } as usize;
-        if length > 0 && length <= RX_BUFFER_SIZE && (status & RDESC_STA_EOP != 0) {
-            let buf_phys = e1000.rx_bufs_phys[idx] as u64;
-            let buf_ptr = buf_phys as *const u8;
-
-            let mut packet = Vec::with_capacity(length);
-            unsafe {
-                packet.set_len(length);
-                core::ptr::copy_nonoverlapping(buf_ptr, packet.as_mut_ptr(), length);
-            }
-
+        let errors = unsafe { core::ptr::read_volatile(&(*desc_ptr).errors) };
+        if errors & (RDESC_ERR_IPE | RDESC_ERR_TCPE) != 0 && status & RDESC_STA_IXSM == 0 {
+            // Bad IPv4 or TCP/UDP checksum: drop, keep the buffer posted
+            e1000.rx_errors += 1;
+        } else if length > 0 && length <= RX_BUFFER_SIZE && (status & RDESC_STA_EOP != 0) {
             e1000.rx_packets += 1;
             e1000.rx_bytes += length as u64;
 
-            if e1000.rx_queue.len() < 1024 {
-                e1000.rx_queue.push_back(packet);
-            } else {
-                e1000.rx_errors += 1;
+            // Hand the filled buffer up and post a fresh one in its place.
+            // With the pool or the queue exhausted the frame is dropped and
+            // the descriptor keeps its buffer.
+            let fresh = if e1000.rx_queue.len() < RX_QUEUE_LIMIT { PacketBuf::alloc() } else { None };
+            match fresh {
+                Some(fresh) => {
+                    unsafe { (*desc_ptr).buffer_addr = fresh.phys(); }
+                    let mut packet = core::mem::replace(&mut e1000.rx_bufs[idx], fresh).truncated(length);
+                    let verified = RDESC_STA_IPCS | RDESC_STA_TCPCS;
+                    if status & RDESC_STA_IXSM == 0 && status & verified == verified {
+                        packet = packet.with_csum_verified();
+                    }
+                    e1000.rx_queue.push_back(packet);
+                }
+                None => e1000.rx_errors += 1,
             }
         } else if length > 0 {
             e1000.rx_errors += 1;
         }
 
-        unsafe { (*desc_ptr).status = 0; }
+        unsafe {
+            (*desc_ptr).status = 0;
+            (*desc_ptr).errors = 0;
+        }
         new_tail = idx as u16;
+        reaped += 1;
     }
 
     // Batch: single MMIO write after processing all descriptors
@@ -666,6 +845,7 @@ fn process_rx_ring(e1000: &mut E1000) {
         e1000.rx_tail = new_tail;
         unsafe { mmio_write(e1000.mmio_base, REG_RDT, new_tail as u32); }
     }
+    reaped
 }
 
 // ──────────────────────────────────────────────
@@ -688,20 +868,16 @@ fn e1000_irq_handler(_irq: u8) {
             }
 
             if icr & ICR_RXT0 != 0 {
-                process_rx_ring(e1000);
-                has_rx = !e1000.rx_queue.is_empty();
+                // Stay quiet until the net_rx thread has drained the ring
+                unsafe { mmio_write(e1000.mmio_base, REG_IMC, ICR_RXT0); }
+                has_rx = true;
             }
         }
     }
     // E1000_STATE lock dropped here
 
-    // Process received packets through the network stack (Ethernet → IP → TCP).
-    // Use per-packet recv_packet() to avoid Vec<Vec<u8>> heap allocation in
-    // IRQ context (allocator lock could deadlock if interrupted thread holds it).
     if has_rx {
-        while let Some(packet) = recv_packet() {
-            crate::net::ethernet::handle_frame(&packet);
-        }
+        crate::net::rx::schedule();
     }
 }
 
@@ -5,11 +5,18 @@
 //!
 //! Provides a unified [`NetworkDriver`] trait for NIC drivers (E1000, VirtIO-Net, etc.).
 //! Drivers register dynamically via PCI detection in the HAL.
-//! RX polling remains driver-specific (IRQ-driven, not routed through the trait).
+//! The data path (gathered transmit, zero-copy receive, checksum offload)
+//! is dispatched to the active [`NicBackend`] by the free functions below,
+//! so the network stack never names a particular driver.
 
 pub mod e1000;
+pub mod virtio_net;
 
 use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, AtomicU8, Ordering};
+use crate::net::checksum::TxOffload;
+use crate::net::pktbuf::PacketBuf;
 use crate::sync::spinlock::Spinlock;
 
 /// Unified network driver interface.
@@ -64,6 +71,160 @@ pub fn link_up() -> bool {
     with_net(|d| d.link_up()).unwrap_or(false)
 }
 
+// ── Data path dispatch ──────────────────────────────────────────────────────
+
+/// NIC driving the data path.
+#[repr(u8)]
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum NicBackend {
+    None = 0,
+    E1000 = 1,
+    VirtioNet = 2,
+}
+
+static BACKEND: AtomicU8 = AtomicU8::new(NicBackend::None as u8);
+
+/// Select the active NIC (called by the driver at the end of its init).
+pub fn set_backend(backend: NicBackend) {
+    BACKEND.store(backend as u8, Ordering::Release);
+}
+
+#[inline]
+fn backend() -> NicBackend {
+    match BACKEND.load(Ordering::Acquire) {
+        1 => NicBackend::E1000,
+        2 => NicBackend::VirtioNet,
+        _ => NicBackend::None,
+    }
+}
+
+/// Transmit one frame given as consecutive pieces, optionally with
+/// checksum offload (see [`tx_checksum_offload`]).
+pub fn transmit_parts(parts: &[&[u8]], offload: Option<TxOffload>) -> bool {
+    match backend() {
+        NicBackend::E1000 => e1000::transmit_parts(parts, offload),
+        NicBackend::VirtioNet => virtio_net::transmit_parts(parts, offload),
+        NicBackend::None => false,
+    }
+}
+
+/// Whether the active NIC completes TCP/UDP checksums on transmit.
+pub fn tx_checksum_offload() -> bool {
+    match backend() {
+        NicBackend::E1000 => e1000::tx_checksum_offload(),
+        NicBackend::VirtioNet => virtio_net::tx_checksum_offload(),
+        NicBackend::None => false,
+    }
+}
+
+/// Receive passes that reaped at least one frame, the frames they reaped,
+/// the largest pass, and the passes that used their whole budget.
+static RX_PASSES: AtomicU64 = AtomicU64::new(0);
+static RX_PASS_FRAMES: AtomicU64 = AtomicU64::new(0);
+static RX_PASS_MAX: AtomicU64 = AtomicU64::new(0);
+static RX_BUDGET_EXHAUSTED: AtomicU64 = AtomicU64::new(0);
+
+/// Reap at most `budget` frames from the NIC's receive ring(s) into its
+/// queue without waiting for an interrupt.  Returns the number reaped.
+pub fn poll_rx(budget: usize) -> usize {
+    let n = match backend() {
+        NicBackend::E1000 => e1000::poll_rx(budget),
+        NicBackend::VirtioNet => virtio_net::poll_rx(budget),
+        NicBackend::None => 0,
+    };
+    if n > 0 {
+        RX_PASSES.fetch_add(1, Ordering::Relaxed);
+        RX_PASS_FRAMES.fetch_add(n as u64, Ordering::Relaxed);
+        RX_PASS_MAX.fetch_max(n as u64, Ordering::Relaxed);
+        if n >= budget {
+            RX_BUDGET_EXHAUSTED.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+    n
+}
+
+/// Unmask (or mask) the NIC's receive interrupt.  Unmasking returns false
+/// if frames are already waiting in the ring; the interrupt then stays
+/// masked and the caller must poll again.
+pub fn set_rx_irq(enabled: bool) -> bool {
+    match backend() {
+        NicBackend::E1000 => e1000::set_rx_irq(enabled),
+        NicBackend::VirtioNet => virtio_net::set_rx_irq(enabled),
+        NicBackend::None => true,
+    }
+}
+
+/// Drain all received frames into `out`.
+pub fn recv_all_packets(out: &mut Vec<PacketBuf>) {
+    match backend() {
+        NicBackend::E1000 => e1000::recv_all_packets(out),
+        NicBackend::VirtioNet => virtio_net::recv_all_packets(out),
+        NicBackend::None => {}
+    }
+}
+
+/// Enable or disable RX/TX. Returns true if a NIC exists.
+pub fn set_enabled(enabled: bool) -> bool {
+    match backend() {
+        NicBackend::E1000 => e1000::set_enabled(enabled),
+        NicBackend::VirtioNet => virtio_net::set_enabled(enabled),
+        NicBackend::None => false,
+    }
+}
+
+/// Check if RX/TX is enabled.
+pub fn is_enabled() -> bool {
+    match backend() {
+        NicBackend::E1000 => e1000::is_enabled(),
+        NicBackend::VirtioNet => virtio_net::is_enabled(),
+        NicBackend::None => false,
+    }
+}
+
+/// Check if the active NIC is initialized and its link is up.
+pub fn is_link_up() -> bool {
+    match backend() {
+        NicBackend::E1000 => e1000::is_link_up(),
+        NicBackend::VirtioNet => virtio_net::is_link_up(),
+        NicBackend::None => false,
+    }
+}
+
+/// NIC counters returned by [`get_stats`].
+#[derive(Clone, Copy, Default)]
+pub struct NicStats {
+    pub rx_packets: u64,
+    pub tx_packets: u64,
+    pub rx_bytes: u64,
+    pub tx_bytes: u64,
+    pub rx_errors: u64,
+    pub tx_errors: u64,
+    /// Receive passes ([`poll_rx`]) that reaped at least one frame.
+    pub rx_passes: u64,
+    /// Frames reaped by those passes.
+    pub rx_pass_frames: u64,
+    /// Most frames reaped by a single pass.
+    pub rx_pass_max: u64,
+    /// Passes that used their whole budget (the ring was still busy).
+    pub rx_budget_exhausted: u64,
+}
+
+/// NIC statistics, including the per-pass receive counters.
+pub fn get_stats() -> NicStats {
+    let (rx_packets, tx_packets, rx_bytes, tx_bytes, rx_errors, tx_errors) = match backend() {
+        NicBackend::E1000 => e1000::get_stats(),
+        NicBackend::VirtioNet => virtio_net::get_stats(),
+        NicBackend::None => (0, 0, 0, 0, 0, 0),
+    };
+    NicStats {
+        rx_packets, tx_packets, rx_bytes, tx_bytes, rx_errors, tx_errors,
+        rx_passes: RX_PASSES.load(Ordering::Relaxed),
+        rx_pass_frames: RX_PASS_FRAMES.load(Ordering::Relaxed),
+        rx_pass_max: RX_PASS_MAX.load(Ordering::Relaxed),
+        rx_budget_exhausted: RX_BUDGET_EXHAUSTED.load(Ordering::Relaxed),
+    }
+}
+
 // ── HAL integration ─────────────────────────────────────────────────────────
 
 use crate::drivers::hal::{Driver, DriverType, DriverError};
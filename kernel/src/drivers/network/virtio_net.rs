@@ -0,0 +1,729 @@
+//! VirtIO network device driver (PCI modern transport).
+//!
+//! Drives a virtio-net device (`1AF4:1041`, or the transitional `1AF4:1000`
+//! when it exposes the modern capabilities).  On KVM every e1000 register
+//! access is a VM exit; virtio-net exchanges frames through shared rings and,
+//! with `VIRTIO_RING_F_EVENT_IDX`, notifies the host only when it asks for it.
+//!
+//! - RX: packet pool buffers are posted to the receive queues and handed up
+//!   the stack in place, as a view past the 12-byte virtio-net header.  With
+//!   `VIRTIO_NET_F_MRG_RXBUF` the device may spread a frame over several
+//!   buffers; no receive-side segment coalescing (GUEST_TSO) is negotiated,
+//!   so frames never exceed the MTU and a 2 KiB buffer always holds one.
+//!   `VIRTIO_NET_F_GUEST_CSUM` marks frames the device already validated.
+//! - TX: each frame is gathered behind its header into a per-slot DMA
+//!   buffer.  With `VIRTIO_NET_F_CSUM` the device completes TCP/UDP
+//!   checksums; the driver fills in the IPv4 header checksum itself.
+//! - Multiqueue (`VIRTIO_NET_F_MQ`): one RX/TX queue pair per CPU, each
+//!   side behind its own lock.  A CPU transmits on its own pair; receive
+//!   queues are reaped on the (shared) INTx line or when polled.  Only pair
+//!   0 is active until [`enable_cpu_queues`] runs after SMP bring-up.
+//!
+//! For QEMU/KVM `-device virtio-net-pci[,mq=on,vectors=…]`.
+
+use alloc::boxed::Box;
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use crate::drivers::pci::PciDevice;
+use crate::drivers::virtio::{self, VirtioDevice, virtqueue::VirtQueue};
+use crate::memory::physical;
+use crate::net::checksum::{self, TxOffload};
+use crate::net::pktbuf::{self, PacketBuf};
+use crate::sync::spinlock::Spinlock;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+
+// ── Feature Bits ────────────────────────────────────
+
+const VIRTIO_NET_F_CSUM: u64 = 1 << 0;
+const VIRTIO_NET_F_GUEST_CSUM: u64 = 1 << 1;
+const VIRTIO_NET_F_MAC: u64 = 1 << 5;
+const VIRTIO_NET_F_MRG_RXBUF: u64 = 1 << 15;
+const VIRTIO_NET_F_STATUS: u64 = 1 << 16;
+const VIRTIO_NET_F_CTRL_VQ: u64 = 1 << 17;
+const VIRTIO_NET_F_MQ: u64 = 1 << 22;
+const VIRTIO_RING_F_EVENT_IDX: u64 = 1 << 29;
+
+// ── Device Config Offsets ───────────────────────────
+
+const CFG_MAC: u64 = 0x00;       // [u8; 6]
+const CFG_STATUS: u64 = 0x06;    // u16
+const CFG_MAX_PAIRS: u64 = 0x08; // u16, max_virtqueue_pairs
+
+const NET_S_LINK_UP: u16 = 1;
+
+// ── Packet Header ───────────────────────────────────
+
+/// `struct virtio_net_hdr` (with `num_buffers`, always present on
+/// VERSION_1 devices): flags, gso_type, hdr_len, gso_size, csum_start,
+/// csum_offset, num_buffers.
+const NET_HDR_LEN: usize = 12;
+const HDR_FLAGS: usize = 0;
+const HDR_CSUM_START: usize = 6;
+const HDR_CSUM_OFFSET: usize = 8;
+const HDR_NUM_BUFFERS: usize = 10;
+
+/// The device must complete the checksum at csum_start + csum_offset.
+const HDR_F_NEEDS_CSUM: u8 = 1;
+/// The device validated the packet's checksums.
+const HDR_F_DATA_VALID: u8 = 2;
+
+// ── Control Queue ───────────────────────────────────
+
+const CTRL_MQ: u8 = 4;
+const CTRL_MQ_VQ_PAIRS_SET: u8 = 0;
+const CTRL_OK: u8 = 0;
+
+/// Control page layout: class, command, data, ack.
+const CTRL_DATA: u64 = 2;
+const CTRL_ACK: u64 = 16;
+
+// ── Limits ──────────────────────────────────────────
+
+/// Queue pairs driven at most (one per CPU).
+const MAX_PAIRS: usize = crate::arch::x86::smp::MAX_CPUS;
+/// Ring size cap of `VirtioDevice::setup_queue`.
+const MAX_QUEUE_SIZE: usize = 128;
+/// Received frames queued per pair before new ones are dropped.
+const RX_QUEUE_LIMIT: usize = 512;
+const BUF_SIZE: usize = pktbuf::BUF_SIZE;
+
+// ── Driver State ────────────────────────────────────
+
+/// One receive queue, serialized by `QueuePair::rx`.
+struct RxQueue {
+    vq: VirtQueue,
+    /// Pool buffer posted at each ring head.
+    posted: Vec<Option<PacketBuf>>,
+    /// Completed buffers still to discard that belong to an oversized
+    /// merged frame.
+    skip: u16,
+    /// Frames waiting for the network stack.
+    ready: VecDeque<PacketBuf>,
+}
+
+/// One transmit queue, serialized by `QueuePair::tx`.
+struct TxQueue {
+    vq: VirtQueue,
+    /// DMA buffer of each slot (identity-mapped, `BUF_SIZE` bytes).
+    slots: Vec<u64>,
+    /// Free slot indices.
+    free: Vec<u16>,
+    /// Slot held by each in-flight ring head.
+    owner: [u16; MAX_QUEUE_SIZE],
+}
+
+struct QueuePair {
+    /// Receive queue index (the transmit queue is `index + 1`).
+    index: u16,
+    rx_notify: u64,
+    tx_notify: u64,
+    rx: Spinlock<RxQueue>,
+    tx: Spinlock<TxQueue>,
+}
+
+struct CtrlQueue {
+    vq: VirtQueue,
+    index: u16,
+    notify: u64,
+    /// Command buffer frame (identity-mapped).
+    page: u64,
+}
+
+struct VirtioNet {
+    dev: VirtioDevice,
+    mac: [u8; 6],
+    pairs: Vec<QueuePair>,
+    ctrl: Option<Spinlock<CtrlQueue>>,
+    /// TX checksum offload negotiated.
+    csum: bool,
+    /// RX buffers may be merged (num_buffers is meaningful).
+    mrg_rxbuf: bool,
+    /// Link status is reported in the config space.
+    status: bool,
+    /// Receive completions interrupt on INTx.
+    irq_enabled: bool,
+}
+
+static AVAILABLE: AtomicBool = AtomicBool::new(false);
+static mut NET: Option<VirtioNet> = None;
+/// Queue pairs in use; CPUs transmit on `cpu % ACTIVE_PAIRS`.
+static ACTIVE_PAIRS: AtomicUsize = AtomicUsize::new(1);
+/// RX/TX enabled (`set_enabled`).
+static ENABLED: AtomicBool = AtomicBool::new(true);
+
+static RX_PACKETS: AtomicU64 = AtomicU64::new(0);
+static TX_PACKETS: AtomicU64 = AtomicU64::new(0);
+static RX_BYTES: AtomicU64 = AtomicU64::new(0);
+static TX_BYTES: AtomicU64 = AtomicU64::new(0);
+static RX_ERRORS: AtomicU64 = AtomicU64::new(0);
+static TX_ERRORS: AtomicU64 = AtomicU64::new(0);
+
+#[inline]
+fn device() -> Option<&'static VirtioNet> {
+    if !AVAILABLE.load(Ordering::Acquire) {
+        return None;
+    }
+    unsafe { (*core::ptr::addr_of!(NET)).as_ref() }
+}
+
+/// Notification address of queue `idx`.
+fn notify_addr(dev: &VirtioDevice, idx: u16) -> u64 {
+    dev.select_queue(idx);
+    dev.notify_base + dev.read_queue_notify_off() as u64 * dev.notify_off_mul as u64
+}
+
+// ── RX ──────────────────────────────────────────────
+
+impl RxQueue {
+    /// Post `buf` as a receive buffer.  Returns false if the ring is full.
+    fn post(&mut self, buf: PacketBuf) -> bool {
+        match self.vq.push(&[], &[(buf.phys(), BUF_SIZE as u32)]) {
+            Some(head) => {
+                self.posted[head as usize] = Some(buf);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Post pool buffers until the ring or the pool runs out.
+    fn fill(&mut self) {
+        while self.vq.num_free() > 0 {
+            match PacketBuf::alloc() {
+                Some(buf) => {
+                    if !self.post(buf) {
+                        break;
+                    }
+                }
+                None => break,
+            }
+        }
+    }
+
+    /// Reap up to `budget` completed receive buffers into `ready`,
+    /// reposting a fresh pool buffer for each.  Returns the number reaped.
+    fn reap(&mut self, net: &VirtioNet, budget: usize) -> usize {
+        let mut reaped = 0;
+        while reaped < budget {
+            let (head, len) = match self.vq.poll_used() {
+                Some(used) => used,
+                None => break,
+            };
+            let buf = match self.posted[head as usize].take() {
+                Some(b) => b,
+                None => continue,
+            };
+            reaped += 1;
+            let len = len as usize;
+
+            if self.skip > 0 {
+                // Tail of a frame that did not fit one buffer
+                self.skip -= 1;
+                self.post(buf);
+                continue;
+            }
+            let num_buffers = if net.mrg_rxbuf {
+                u16::from_le_bytes([buf[HDR_NUM_BUFFERS], buf[HDR_NUM_BUFFERS + 1]])
+            } else {
+                1
+            };
+            if num_buffers > 1 || len <= NET_HDR_LEN || len > BUF_SIZE {
+                self.skip = num_buffers.saturating_sub(1);
+                RX_ERRORS.fetch_add(1, Ordering::Relaxed);
+                self.post(buf);
+                continue;
+            }
+            if !ENABLED.load(Ordering::Relaxed) {
+                self.post(buf);
+                continue;
+            }
+
+            // Hand the filled buffer up and post a fresh one in its
+            // place; with the pool or the queue exhausted the frame is
+            // dropped and its buffer reposted.
+            let fresh = if self.ready.len() < RX_QUEUE_LIMIT { PacketBuf::alloc() } else { None };
+            match fresh {
+                Some(fresh) => {
+                    self.post(fresh);
+                    let flags = buf[HDR_FLAGS];
+                    let packet = buf.truncated(len);
+                    let mut frame = packet.view(&packet[NET_HDR_LEN..]);
+                    // NEEDS_CSUM: a local peer left the checksum to the
+                    // (virtual) wire, the data itself is intact.
+                    if flags & (HDR_F_DATA_VALID | HDR_F_NEEDS_CSUM) != 0 {
+                        frame = frame.with_csum_verified();
+                    }
+                    RX_PACKETS.fetch_add(1, Ordering::Relaxed);
+                    RX_BYTES.fetch_add((len - NET_HDR_LEN) as u64, Ordering::Relaxed);
+                    self.ready.push_back(frame);
+                }
+                None => {
+                    RX_ERRORS.fetch_add(1, Ordering::Relaxed);
+                    self.post(buf);
+                }
+            }
+        }
+        reaped
+    }
+}
+
+/// Reap up to `budget` frames from the receive queue of one pair.
+fn reap_pair(net: &VirtioNet, pair: &QueuePair, budget: usize) -> usize {
+    let mut rx = pair.rx.lock();
+    let n = rx.reap(net, budget);
+    if n > 0 && rx.vq.kick_needed() {
+        virtio::mmio_write16(pair.rx_notify, pair.index);
+    }
+    n
+}
+
+/// Poll the receive queues for new frames (non-interrupt driven), reaping
+/// at most `budget` in total.  Returns the number reaped.
+pub fn poll_rx(budget: usize) -> usize {
+    let net = match device() {
+        Some(n) => n,
+        None => return 0,
+    };
+    let mut reaped = 0;
+    for pair in net.pairs.iter() {
+        reaped += reap_pair(net, pair, budget - reaped);
+        if reaped >= budget {
+            break;
+        }
+    }
+    reaped
+}
+
+/// Re-arm (or suppress) the receive interrupts of every queue.  Re-arming
+/// returns false if a queue completed buffers meanwhile; those queues stay
+/// suppressed and the caller must poll again.
+pub fn set_rx_irq(enabled: bool) -> bool {
+    let net = match device() {
+        Some(n) => n,
+        None => return true,
+    };
+    if !net.irq_enabled {
+        return true;
+    }
+    let mut armed = true;
+    for pair in net.pairs.iter() {
+        let mut rx = pair.rx.lock();
+        if enabled && rx.vq.enable_interrupts() {
+            continue;
+        }
+        rx.vq.disable_interrupts();
+        armed &= !enabled;
+    }
+    armed
+}
+
+/// Dequeue a received frame. Returns None if no frames are waiting.
+pub fn recv_packet() -> Option<PacketBuf> {
+    let net = device()?;
+    for pair in net.pairs.iter() {
+        if let Some(p) = pair.rx.lock().ready.pop_front() {
+            return Some(p);
+        }
+    }
+    None
+}
+
+/// Drain all received frames of every queue pair.
+pub fn recv_all_packets(out: &mut Vec<PacketBuf>) {
+    let net = match device() {
+        Some(n) => n,
+        None => return,
+    };
+    for pair in net.pairs.iter() {
+        out.extend(pair.rx.lock().ready.drain(..));
+    }
+}
+
+// ── TX ──────────────────────────────────────────────
+
+impl TxQueue {
+    /// Return the slots of transmitted frames to the free list.
+    fn reclaim(&mut self) {
+        while let Some((head, _)) = self.vq.poll_used() {
+            self.free.push(self.owner[head as usize]);
+        }
+    }
+}
+
+/// Transmit a raw Ethernet frame (including Ethernet header).
+/// Returns true on success.
+pub fn transmit(data: &[u8]) -> bool {
+    transmit_parts(&[data], None)
+}
+
+/// Whether the device completes TCP/UDP checksums on transmit.
+pub fn tx_checksum_offload() -> bool {
+    device().map_or(false, |n| n.csum)
+}
+
+/// Transmit one Ethernet frame given as consecutive pieces, gathered
+/// directly behind the virtio-net header in a TX slot, on the current
+/// CPU's queue pair.
+///
+/// With `offload` the device completes the TCP/UDP checksum (its field
+/// preloaded with the pseudo-header sum); the IPv4 header checksum is
+/// computed here.
+pub fn transmit_parts(parts: &[&[u8]], offload: Option<TxOffload>) -> bool {
+    let net = match device() {
+        Some(n) => n,
+        None => return false,
+    };
+    let len: usize = parts.iter().map(|p| p.len()).sum();
+    if len == 0 || NET_HDR_LEN + len > BUF_SIZE || !ENABLED.load(Ordering::Relaxed) {
+        return false;
+    }
+
+    let active = ACTIVE_PAIRS.load(Ordering::Relaxed).max(1);
+    let pair = &net.pairs[crate::arch::hal::cpu_id() % active];
+    let mut tx = pair.tx.lock();
+    tx.reclaim();
+    let slot = match tx.free.pop() {
+        Some(s) => s,
+        None => {
+            TX_ERRORS.fetch_add(1, Ordering::Relaxed);
+            return false;
+        }
+    };
+
+    let buf = unsafe { core::slice::from_raw_parts_mut(tx.slots[slot as usize] as *mut u8, NET_HDR_LEN + len) };
+    buf[..NET_HDR_LEN].fill(0);
+    let mut off = NET_HDR_LEN;
+    for p in parts {
+        buf[off..off + p.len()].copy_from_slice(p);
+        off += p.len();
+    }
+
+    if let Some(o) = offload {
+        let frame = &mut buf[NET_HDR_LEN..];
+        let (ip, l4, field) = (o.ip_start as usize, o.l4_start as usize, o.l4_csum as usize);
+        if l4 <= frame.len() && field + 2 <= frame.len() {
+            let ip_csum = checksum::internet_checksum(&frame[ip..l4]);
+            frame[ip + 10..ip + 12].copy_from_slice(&ip_csum.to_be_bytes());
+            if net.csum {
+                buf[HDR_FLAGS] = HDR_F_NEEDS_CSUM;
+                buf[HDR_CSUM_START..HDR_CSUM_START + 2].copy_from_slice(&(l4 as u16).to_le_bytes());
+                buf[HDR_CSUM_OFFSET..HDR_CSUM_OFFSET + 2].copy_from_slice(&((field - l4) as u16).to_le_bytes());
+            } else {
+                // The field holds the pseudo-header sum: summing the
+                // segment including it yields the checksum
+                let sum = checksum::finish(checksum::partial_sum(&frame[l4..], 0));
+                frame[field..field + 2].copy_from_slice(&sum.to_be_bytes());
+            }
+        }
+    }
+
+    let phys = tx.slots[slot as usize];
+    let head = match tx.vq.push(&[(phys, (NET_HDR_LEN + len) as u32)], &[]) {
+        Some(h) => h,
+        None => {
+            tx.free.push(slot);
+            TX_ERRORS.fetch_add(1, Ordering::Relaxed);
+            return false;
+        }
+    };
+    tx.owner[head as usize] = slot;
+    if tx.vq.kick_needed() {
+        virtio::mmio_write16(pair.tx_notify, pair.index + 1);
+    }
+    TX_PACKETS.fetch_add(1, Ordering::Relaxed);
+    TX_BYTES.fetch_add(len as u64, Ordering::Relaxed);
+    true
+}
+
+// ── Status ──────────────────────────────────────────
+
+/// Get the MAC address of the NIC.
+pub fn get_mac() -> Option<[u8; 6]> {
+    device().map(|n| n.mac)
+}
+
+/// Check if a virtio-net device was detected and initialized.
+pub fn is_available() -> bool {
+    device().is_some()
+}
+
+/// Check if the device is initialized and reports link up.
+pub fn is_link_up() -> bool {
+    match device() {
+        Some(n) if n.status && n.dev.device_cfg != 0 => {
+            virtio::mmio_read16(n.dev.device_cfg + CFG_STATUS) & NET_S_LINK_UP != 0
+        }
+        Some(_) => true,
+        None => false,
+    }
+}
+
+/// Enable or disable RX/TX. Returns true if the device exists.
+pub fn set_enabled(enabled: bool) -> bool {
+    ENABLED.store(enabled, Ordering::Relaxed);
+    is_available()
+}
+
+/// Check if RX/TX is enabled.
+pub fn is_enabled() -> bool {
+    is_available() && ENABLED.load(Ordering::Relaxed)
+}
+
+/// Get NIC statistics: (rx_packets, tx_packets, rx_bytes, tx_bytes, rx_errors, tx_errors).
+pub fn get_stats() -> (u64, u64, u64, u64, u64, u64) {
+    (
+        RX_PACKETS.load(Ordering::Relaxed),
+        TX_PACKETS.load(Ordering::Relaxed),
+        RX_BYTES.load(Ordering::Relaxed),
+        TX_BYTES.load(Ordering::Relaxed),
+        RX_ERRORS.load(Ordering::Relaxed),
+        TX_ERRORS.load(Ordering::Relaxed),
+    )
+}
+
+// ── IRQ Handler ─────────────────────────────────────
+
+/// INTx handler (possibly shared): reading the ISR acknowledges the device.
+fn virtio_net_irq_handler(_irq: u8) {
+    let net = match device() {
+        Some(n) => n,
+        None => return,
+    };
+    let isr = virtio::mmio_read8(net.dev.isr_addr);
+    if isr & 2 != 0 {
+        crate::serial_println!("  virtio-net: link status changed: {}",
+            if is_link_up() { "UP" } else { "DOWN" });
+    }
+    if isr & 1 == 0 {
+        return;
+    }
+
+    // Suppress further RX interrupts until the net_rx thread has drained
+    // the queues (try_lock: the interrupted thread may hold a queue lock;
+    // it is then reaping anyway)
+    for pair in net.pairs.iter() {
+        if let Some(mut rx) = pair.rx.try_lock() {
+            rx.vq.disable_interrupts();
+        }
+    }
+    crate::net::rx::schedule();
+}
+
+// ── Multiqueue ──────────────────────────────────────
+
+/// Send a control command with `data`; returns true if the device acked it.
+fn ctrl_command(net: &VirtioNet, class: u8, cmd: u8, data: &[u8]) -> bool {
+    let ctrl = match net.ctrl.as_ref() {
+        Some(c) => c,
+        None => return false,
+    };
+    let mut c = ctrl.lock();
+    let page = c.page;
+    unsafe {
+        let p = page as *mut u8;
+        *p = class;
+        *p.add(1) = cmd;
+        core::ptr::copy_nonoverlapping(data.as_ptr(), p.add(CTRL_DATA as usize), data.len());
+        *p.add(CTRL_ACK as usize) = 0xFF;
+    }
+    let (notify, index) = (c.notify, c.index);
+    let ok = c.vq.execute_sync(
+        &[(page, 2), (page + CTRL_DATA, data.len() as u32)],
+        &[(page + CTRL_ACK, 1)],
+        || virtio::mmio_write16(notify, index),
+    );
+    ok.is_some() && unsafe { core::ptr::read_volatile((page + CTRL_ACK) as *const u8) } == CTRL_OK
+}
+
+/// Spread traffic over one queue pair per CPU.
+///
+/// Called once after `smp::start_aps`; before that all CPUs share pair 0.
+pub fn enable_cpu_queues() {
+    let net = match device() {
+        Some(n) => n,
+        None => return,
+    };
+    let want = crate::arch::hal::cpu_count().clamp(1, net.pairs.len());
+    if want > 1 && ctrl_command(net, CTRL_MQ, CTRL_MQ_VQ_PAIRS_SET, &(want as u16).to_le_bytes()) {
+        ACTIVE_PAIRS.store(want, Ordering::Release);
+    }
+    crate::serial_println!("[OK] virtio-net: {} queue pair(s) active", ACTIVE_PAIRS.load(Ordering::Relaxed));
+}
+
+// ── Init ────────────────────────────────────────────
+
+/// Set up receive queue `2 * i` and transmit queue `2 * i + 1`.
+fn setup_pair(dev: &VirtioDevice, i: usize, event_idx: bool, irq_enabled: bool) -> Option<QueuePair> {
+    let index = (2 * i) as u16;
+    let mut rx_vq = dev.setup_queue(index)?;
+    let mut tx_vq = dev.setup_queue(index + 1)?;
+    rx_vq.set_event_idx(event_idx);
+    tx_vq.set_event_idx(event_idx);
+    // Transmit completions are reclaimed lazily on the next send
+    tx_vq.disable_interrupts();
+    if irq_enabled {
+        rx_vq.enable_interrupts();
+    }
+
+    // Two TX slots per frame, one per ring descriptor
+    let mut slots = Vec::with_capacity(MAX_QUEUE_SIZE);
+    while slots.len() < tx_vq.num_free() as usize {
+        let frame = physical::alloc_frame()?.as_u64();
+        slots.push(frame);
+        slots.push(frame + BUF_SIZE as u64);
+    }
+    slots.truncate(tx_vq.num_free() as usize);
+    let free = (0..slots.len() as u16).rev().collect();
+
+    let mut posted = Vec::with_capacity(MAX_QUEUE_SIZE);
+    posted.resize_with(MAX_QUEUE_SIZE, || None);
+    let mut rx = RxQueue { vq: rx_vq, posted, skip: 0, ready: VecDeque::with_capacity(RX_QUEUE_LIMIT) };
+    rx.fill();
+
+    Some(QueuePair {
+        index,
+        rx_notify: notify_addr(dev, index),
+        tx_notify: notify_addr(dev, index + 1),
+        rx: Spinlock::new(rx),
+        tx: Spinlock::new(TxQueue { vq: tx_vq, slots, free, owner: [0; MAX_QUEUE_SIZE] }),
+    })
+}
+
+/// Initialize the first virtio-net device on the PCI bus and make it the
+/// active NIC.  Call after PCI scan, heap init, and virtual memory init.
+pub fn init() -> bool {
+    let pci = match crate::drivers::pci::find_by_id(0x1AF4, 0x1041)
+        .or_else(|| crate::drivers::pci::find_by_id(0x1AF4, 0x1000))
+    {
+        Some(dev) => dev,
+        None => return false,
+    };
+    crate::serial_println!("  virtio-net: found at PCI {:02x}:{:02x}.{}",
+        pci.bus, pci.device, pci.function);
+
+    let caps = match virtio::find_capabilities(&pci) {
+        Some(c) => c,
+        None => {
+            crate::serial_println!("  virtio-net: no modern PCI capabilities (legacy-only device)");
+            return false;
+        }
+    };
+    let dev = VirtioDevice::new(&pci, &caps);
+
+    let desired = virtio::VIRTIO_F_VERSION_1 | VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM
+        | VIRTIO_NET_F_MAC | VIRTIO_NET_F_MRG_RXBUF | VIRTIO_NET_F_STATUS
+        | VIRTIO_NET_F_CTRL_VQ | VIRTIO_NET_F_MQ | VIRTIO_RING_F_EVENT_IDX;
+    let features = match dev.init_device(desired) {
+        Ok(f) => f,
+        Err(e) => {
+            crate::serial_println!("  virtio-net: init failed: {}", e);
+            return false;
+        }
+    };
+    let has = |f: u64| features & f != 0;
+    let cfg = dev.device_cfg;
+
+    let mut mac = [0x52, 0x54, 0x00, 0x12, 0x34, 0x56];
+    if has(VIRTIO_NET_F_MAC) && cfg != 0 {
+        for (i, b) in mac.iter_mut().enumerate() {
+            *b = virtio::mmio_read8(cfg + CFG_MAC + i as u64);
+        }
+    } else {
+        crate::serial_println!("  virtio-net: no MAC in config space, using default");
+    }
+
+    // Queue layout: pairs at (2i, 2i+1), control queue after the device's
+    // last possible pair
+    let mq = has(VIRTIO_NET_F_MQ) && has(VIRTIO_NET_F_CTRL_VQ) && cfg != 0;
+    let dev_pairs = if mq { virtio::mmio_read16(cfg + CFG_MAX_PAIRS).max(1) as usize } else { 1 };
+    let event_idx = has(VIRTIO_RING_F_EVENT_IDX);
+    let irq = pci.interrupt_line;
+    let irq_enabled = irq > 0 && irq < 32;
+
+    pktbuf::init();
+    let mut pairs = Vec::new();
+    for i in 0..dev_pairs.min(MAX_PAIRS) {
+        match setup_pair(&dev, i, event_idx, irq_enabled) {
+            Some(p) => pairs.push(p),
+            None => break,
+        }
+    }
+    if pairs.is_empty() {
+        crate::serial_println!("  virtio-net: failed to set up queue pair 0");
+        dev.write_device_status(virtio::STATUS_FAILED);
+        return false;
+    }
+
+    let ctrl = if has(VIRTIO_NET_F_CTRL_VQ) {
+        let index = if mq { (2 * dev_pairs) as u16 } else { 2 };
+        let page = physical::alloc_frame().map(|f| f.as_u64());
+        match (dev.setup_queue(index), page) {
+            (Some(vq), Some(page)) => {
+                let notify = notify_addr(&dev, index);
+                Some(Spinlock::new(CtrlQueue { vq, index, notify, page }))
+            }
+            _ => None,
+        }
+    } else {
+        None
+    };
+
+    unsafe {
+        NET = Some(VirtioNet {
+            dev,
+            mac,
+            pairs,
+            ctrl,
+            csum: has(VIRTIO_NET_F_CSUM),
+            mrg_rxbuf: has(VIRTIO_NET_F_MRG_RXBUF),
+            status: has(VIRTIO_NET_F_STATUS),
+            irq_enabled,
+        });
+    }
+    let net = unsafe { (*core::ptr::addr_of!(NET)).as_ref().unwrap() };
+    net.dev.set_driver_ok();
+    AVAILABLE.store(true, Ordering::Release);
+
+    // Receive buffers were posted before DRIVER_OK; tell the device now
+    for pair in net.pairs.iter() {
+        virtio::mmio_write16(pair.rx_notify, pair.index);
+    }
+
+    if irq_enabled {
+        crate::arch::x86::irq::register_irq(irq, virtio_net_irq_handler);
+        if crate::arch::x86::apic::is_initialized() {
+            crate::arch::x86::ioapic::unmask_irq(irq);
+        } else {
+            crate::arch::x86::pic::unmask(irq);
+        }
+    }
+
+    crate::serial_println!("  virtio-net: MAC = {:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
+        mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    crate::serial_println!(
+        "[OK] virtio-net initialized ({} queue pair(s), csum={} guest_csum={} mrg_rxbuf={} event_idx={} irq={})",
+        net.pairs.len(), net.csum, has(VIRTIO_NET_F_GUEST_CSUM), net.mrg_rxbuf, event_idx,
+        if irq_enabled { irq as i32 } else { -1 }
+    );
+
+    super::register(Box::new(VirtioNetDriver));
+    super::set_backend(super::NicBackend::VirtioNet);
+    true
+}
+
+// ── NetworkDriver trait implementation ──────────────────────────────────────
+
+/// Thin wrapper that delegates to the virtio-net static state.
+pub struct VirtioNetDriver;
+
+impl super::NetworkDriver for VirtioNetDriver {
+    fn name(&self) -> &str { "VirtIO Network" }
+    fn transmit(&mut self, data: &[u8]) -> bool { transmit(data) }
+    fn get_mac(&self) -> [u8; 6] { get_mac().unwrap_or([0; 6]) }
+    fn link_up(&self) -> bool { is_link_up() }
+}
+
+/// Probe: return a HAL driver wrapper for the virtio-net controller.
+pub fn probe(_pci: &PciDevice) -> Option<Box<dyn crate::drivers::hal::Driver>> {
+    super::create_hal_driver("VirtIO Network Device")
+}
@@ -2,7 +2,16 @@
 //!
 //! Scans all 256 PCI buses to discover devices, reads their BARs and capabilities,
 //! and provides lookup functions by class/subclass or vendor/device ID.
+//!
+//! Also programs message-signalled interrupts: [`msi_enable`] (one MSI
+//! vector) and [`msix_enable`] / [`MsixTable::bind`] (one vector per table
+//! entry).  Each message gets a vector of its own from the
+//! `arch::x86::irq` MSI pool, so handlers need not poll shared status, and
+//! is aimed at one CPU's LAPIC according to its [`IrqAffinity`];
+//! [`spread_irqs`] distributes the vectors across the CPUs once the APs
+//! are online.
 
+use crate::arch::x86::irq::{self, IrqHandler};
 use crate::arch::x86::port::{inl, outl};
 use crate::sync::spinlock::Spinlock;
 use alloc::vec::Vec;
@@ -72,6 +81,58 @@ pub fn pci_config_write32(bus: u8, device: u8, function: u8, offset: u8, value:
     }
 }
 
+/// Write a 16-bit value to PCI configuration space (read-modify-write of
+/// the containing dword).
+pub fn pci_config_write16(bus: u8, device: u8, function: u8, offset: u8, value: u16) {
+    let shift = (offset & 2) * 8;
+    let dword = pci_config_read32(bus, device, function, offset & 0xFC);
+    let dword = (dword & !(0xFFFF << shift)) | (value as u32) << shift;
+    pci_config_write32(bus, device, function, offset & 0xFC, dword);
+}
+
+/// Iterator over a device's capability list, yielding `(id, offset)`.
+pub struct Capabilities {
+    bus: u8,
+    device: u8,
+    function: u8,
+    offset: u8,
+    /// Guard against malformed (looping) lists.
+    remaining: u8,
+}
+
+impl Iterator for Capabilities {
+    type Item = (u8, u8);
+
+    fn next(&mut self) -> Option<(u8, u8)> {
+        if self.offset == 0 || self.remaining == 0 {
+            return None;
+        }
+        self.remaining -= 1;
+        let at = self.offset;
+        let id = pci_config_read8(self.bus, self.device, self.function, at);
+        self.offset = pci_config_read8(self.bus, self.device, self.function, at + 1) & 0xFC;
+        Some((id, at))
+    }
+}
+
+/// Walk the device's PCI capability list.
+pub fn capabilities(dev: &PciDevice) -> Capabilities {
+    // Status register bit 4: capabilities list present
+    let present = pci_config_read16(dev.bus, dev.device, dev.function, 0x06) & (1 << 4) != 0;
+    let offset = if present {
+        pci_config_read8(dev.bus, dev.device, dev.function, 0x34) & 0xFC
+    } else {
+        0
+    };
+    Capabilities { bus: dev.bus, device: dev.device, function: dev.function, offset, remaining: 48 }
+}
+
+/// Find capability `cap_id` in the device's PCI capability list.
+/// Returns its config-space offset.
+pub fn find_capability(dev: &PciDevice, cap_id: u8) -> Option<u8> {
+    capabilities(dev).find(|&(id, _)| id == cap_id).map(|(_, offset)| offset)
+}
+
 fn read_bars(bus: u8, device: u8, function: u8) -> [u32; 6] {
     let mut bars = [0u32; 6];
     for i in 0..6 {
@@ -242,3 +303,274 @@ pub fn enable_bus_master(dev: &PciDevice) {
     let cmd = pci_config_read16(dev.bus, dev.device, dev.function, 0x04);
     pci_config_write32(dev.bus, dev.device, dev.function, 0x04, (cmd | 0x04) as u32);
 }
+
+
+// ── MSI / MSI-X ─────────────────────────────────────
+
+/// MSI capability ID.
+pub const PCI_CAP_MSI: u8 = 0x05;
+/// MSI-X capability ID.
+pub const PCI_CAP_MSIX: u8 = 0x11;
+
+const CMD_INTX_DISABLE: u16 = 1 << 10;
+
+const MSI_CTRL_ENABLE: u16 = 1 << 0;
+const MSI_CTRL_MME_MASK: u16 = 7 << 4;
+const MSI_CTRL_64BIT: u16 = 1 << 7;
+
+const MSIX_CTRL_ENABLE: u16 = 1 << 15;
+const MSIX_CTRL_FUNC_MASK: u16 = 1 << 14;
+const MSIX_ENTRY_MASKED: u32 = 1 << 0;
+
+/// Where a message-signalled interrupt is delivered.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum IrqAffinity {
+    /// Always this CPU (e.g. the completions of a per-CPU queue).
+    Cpu(usize),
+    /// Any CPU: starts on the BSP, placed by [`spread_irqs`] and then
+    /// moved by the interrupt balancer.
+    Spread,
+}
+
+#[derive(Clone, Copy)]
+enum MsiTarget {
+    /// MSI capability at `cap`; the data register follows the address.
+    Msi { bus: u8, device: u8, function: u8, cap: u8, is_64bit: bool },
+    /// Virtual address of an MSI-X table entry.
+    MsixEntry(u64),
+}
+
+struct MsiRoute {
+    irq: u8,
+    affinity: IrqAffinity,
+    cpu: usize,
+    target: MsiTarget,
+    /// Class and subclass of the device raising it.
+    class: (u8, u8),
+}
+
+/// Snapshot of one programmed MSI / MSI-X vector.
+#[derive(Debug, Clone, Copy)]
+pub struct MsiInfo {
+    pub irq: u8,
+    pub affinity: IrqAffinity,
+    /// CPU the message is delivered to.
+    pub cpu: usize,
+    pub class: u8,
+    pub subclass: u8,
+}
+
+/// Every programmed message, for re-targeting.
+static MSI_ROUTES: Spinlock<Vec<MsiRoute>> = Spinlock::new(Vec::new());
+
+/// Message address and data delivering `irq` to `cpu`'s LAPIC
+/// (fixed delivery, physical destination, edge-triggered).
+fn msi_message(irq: u8, cpu: usize) -> (u32, u32) {
+    let lapic = crate::arch::x86::smp::lapic_id_of(cpu) as u32;
+    (0xFEE0_0000 | lapic << 12, irq as u32 + 32)
+}
+
+fn program(target: MsiTarget, irq: u8, cpu: usize) {
+    let (addr, data) = msi_message(irq, cpu);
+    match target {
+        MsiTarget::Msi { bus, device, function, cap, is_64bit } => {
+            pci_config_write32(bus, device, function, cap + 4, addr);
+            if is_64bit {
+                pci_config_write32(bus, device, function, cap + 8, 0);
+                pci_config_write16(bus, device, function, cap + 12, data as u16);
+            } else {
+                pci_config_write16(bus, device, function, cap + 8, data as u16);
+            }
+        }
+        MsiTarget::MsixEntry(e) => unsafe {
+            // Mask while the entry is rewritten so no torn message is sent
+            let ctrl = e + 12;
+            let vector_ctrl = core::ptr::read_volatile(ctrl as *const u32);
+            core::ptr::write_volatile(ctrl as *mut u32, vector_ctrl | MSIX_ENTRY_MASKED);
+            core::ptr::write_volatile(e as *mut u32, addr);
+            core::ptr::write_volatile((e + 4) as *mut u32, 0);
+            core::ptr::write_volatile((e + 8) as *mut u32, data);
+            core::ptr::write_volatile(ctrl as *mut u32, vector_ctrl & !MSIX_ENTRY_MASKED);
+        },
+    }
+}
+
+/// CPU an interrupt with `affinity` is delivered to right now.
+fn initial_cpu(affinity: IrqAffinity) -> usize {
+    match affinity {
+        IrqAffinity::Cpu(cpu) if cpu < crate::arch::x86::smp::cpu_count() as usize => cpu,
+        _ => 0,
+    }
+}
+
+/// Allocate a vector for `handler`, aim `target` at it and remember the route.
+fn bind(target: MsiTarget, class: (u8, u8), handler: IrqHandler, affinity: IrqAffinity) -> Option<u8> {
+    if !crate::arch::x86::apic::is_initialized() {
+        return None;
+    }
+    let irq = irq::alloc_irq(handler)?;
+    let cpu = initial_cpu(affinity);
+    program(target, irq, cpu);
+    MSI_ROUTES.lock().push(MsiRoute { irq, affinity, cpu, target, class });
+    Some(irq)
+}
+
+/// Stop legacy INTx assertion once messages are in use.
+fn disable_intx(dev: &PciDevice) {
+    let cmd = pci_config_read16(dev.bus, dev.device, dev.function, 0x04);
+    pci_config_write16(dev.bus, dev.device, dev.function, 0x04, cmd | CMD_INTX_DISABLE);
+}
+
+/// Switch the device to a single MSI message delivering to `handler`.
+/// Returns the IRQ, or None without an MSI capability or free vector
+/// (the caller keeps using INTx).
+pub fn msi_enable(dev: &PciDevice, handler: IrqHandler, affinity: IrqAffinity) -> Option<u8> {
+    let cap = find_capability(dev, PCI_CAP_MSI)?;
+    let (bus, device, function) = (dev.bus, dev.device, dev.function);
+    let ctrl = pci_config_read16(bus, device, function, cap + 2);
+    let target = MsiTarget::Msi { bus, device, function, cap, is_64bit: ctrl & MSI_CTRL_64BIT != 0 };
+    let irq = bind(target, (dev.class_code, dev.subclass), handler, affinity)?;
+    // One message (MME = 0), then enable
+    let ctrl = (ctrl & !MSI_CTRL_MME_MASK) | MSI_CTRL_ENABLE;
+    pci_config_write16(bus, device, function, cap + 2, ctrl);
+    disable_intx(dev);
+    Some(irq)
+}
+
+/// A device's MSI-X table, mapped and enabled with every entry masked.
+#[derive(Clone, Copy)]
+pub struct MsixTable {
+    virt: u64,
+    entries: u16,
+    class: (u8, u8),
+}
+
+/// Map the device's MSI-X table, mask every entry and enable MSI-X.
+/// Entries are then unmasked one by one through [`MsixTable::bind`].
+pub fn msix_enable(dev: &PciDevice) -> Option<MsixTable> {
+    if !crate::arch::x86::apic::is_initialized() {
+        return None;
+    }
+    let cap = find_capability(dev, PCI_CAP_MSIX)?;
+    let (bus, device, function) = (dev.bus, dev.device, dev.function);
+    let msg_ctrl = pci_config_read16(bus, device, function, cap + 2);
+    let entries = (msg_ctrl & 0x7FF) + 1;
+
+    let table = pci_config_read32(bus, device, function, cap + 4);
+    let bir = (table & 7) as usize;
+    if bir >= 6 || dev.bars[bir] & 1 != 0 {
+        return None;
+    }
+    let bar = dev.bars[bir];
+    let mut bar_phys = (bar & 0xFFFF_FFF0) as u64;
+    if (bar >> 1) & 3 == 2 && bir < 5 {
+        bar_phys |= (dev.bars[bir + 1] as u64) << 32;
+    }
+    let table_phys = bar_phys + (table & !7) as u64;
+    let pages = ((table_phys & 0xFFF) as usize + entries as usize * 16 + 4095) / 4096;
+    let virt = crate::memory::virtual_mem::map_mmio(
+        crate::memory::address::PhysAddr::new(table_phys & !0xFFF), pages,
+    )?.as_u64() + (table_phys & 0xFFF);
+
+    for i in 0..entries as u64 {
+        unsafe { core::ptr::write_volatile((virt + i * 16 + 12) as *mut u32, MSIX_ENTRY_MASKED); }
+    }
+    let msg_ctrl = (msg_ctrl | MSIX_CTRL_ENABLE) & !MSIX_CTRL_FUNC_MASK;
+    pci_config_write16(bus, device, function, cap + 2, msg_ctrl);
+    disable_intx(dev);
+    Some(MsixTable { virt, entries, class: (dev.class_code, dev.subclass) })
+}
+
+impl MsixTable {
+    /// Number of table entries.
+    pub fn entries(&self) -> u16 {
+        self.entries
+    }
+
+    /// Give table entry `entry` its own vector delivering to `handler`,
+    /// and unmask it.  Returns the IRQ.
+    pub fn bind(&self, entry: u16, handler: IrqHandler, affinity: IrqAffinity) -> Option<u8> {
+        if entry >= self.entries {
+            return None;
+        }
+        bind(MsiTarget::MsixEntry(self.virt + entry as u64 * 16), self.class, handler, affinity)
+    }
+}
+
+/// Re-aim the message of `irq` at `cpu`.  Returns false for an unknown
+/// IRQ or CPU.
+pub fn set_irq_affinity(irq: u8, cpu: usize) -> bool {
+    if cpu >= crate::arch::x86::smp::cpu_count() as usize {
+        return false;
+    }
+    let mut routes = MSI_ROUTES.lock();
+    match routes.iter_mut().find(|r| r.irq == irq) {
+        Some(r) => {
+            r.cpu = cpu;
+            program(r.target, irq, cpu);
+            true
+        }
+        None => false,
+    }
+}
+
+/// Change the affinity of `irq` and deliver it accordingly: `Cpu(n)`
+/// moves it to CPU `n` for good, `Spread` hands it back to the balancer.
+/// Returns false for an unknown IRQ or CPU.
+pub fn pin_irq(irq: u8, affinity: IrqAffinity) -> bool {
+    let cpus = crate::arch::x86::smp::cpu_count() as usize;
+    if matches!(affinity, IrqAffinity::Cpu(cpu) if cpu >= cpus) {
+        return false;
+    }
+    let mut routes = MSI_ROUTES.lock();
+    match routes.iter_mut().find(|r| r.irq == irq) {
+        Some(r) => {
+            r.affinity = affinity;
+            if let IrqAffinity::Cpu(cpu) = affinity {
+                if cpu != r.cpu {
+                    r.cpu = cpu;
+                    program(r.target, irq, cpu);
+                }
+            }
+            true
+        }
+        None => false,
+    }
+}
+
+/// Every programmed MSI / MSI-X vector.
+pub fn msi_routes() -> Vec<MsiInfo> {
+    MSI_ROUTES.lock().iter().map(|r| MsiInfo {
+        irq: r.irq,
+        affinity: r.affinity,
+        cpu: r.cpu,
+        class: r.class.0,
+        subclass: r.class.1,
+    }).collect()
+}
+
+/// Distribute `Spread` interrupts round-robin over the online CPUs and
+/// move `Cpu(n)` ones whose CPU has come up.  Call after `smp::start_aps`.
+pub fn spread_irqs() {
+    let cpus = crate::arch::x86::smp::cpu_count().max(1) as usize;
+    let mut next = 1 % cpus; // leave the BSP to the legacy IRQs first
+    let mut routes = MSI_ROUTES.lock();
+    for r in routes.iter_mut() {
+        let cpu = match r.affinity {
+            IrqAffinity::Cpu(cpu) if cpu < cpus => cpu,
+            IrqAffinity::Cpu(_) => continue,
+            IrqAffinity::Spread => {
+                let cpu = next;
+                next = (next + 1) % cpus;
+                cpu
+            }
+        };
+        if cpu != r.cpu {
+            r.cpu = cpu;
+            program(r.target, r.irq, cpu);
+        }
+    }
+    if !routes.is_empty() {
+        crate::serial_println!("[OK] PCI: {} MSI vector(s) across {} CPU(s)", routes.len(), cpus);
+    }
+}
@@ -15,6 +15,13 @@
 //! - **Class** (specificity 1): PCI class:subclass match — fallback for generic drivers.
 //!
 //! When multiple entries match, the highest specificity wins.
+//!
+//! ## Probe Stages
+//! - **Boot**: probed on the BSP before the root filesystem is mounted —
+//!   storage (the root disk), display (the compositor) and VMMDev (which
+//!   the VBox GPU checks for its hardware cursor).
+//! - **Deferred**: probed on worker threads once the APs are up, while
+//!   userspace starts (see `hal::start_deferred_probes`).
 
 use alloc::boxed::Box;
 use crate::drivers::pci::PciDevice;
@@ -34,6 +41,16 @@ pub(super) struct PciDriverEntry {
     pub factory: fn(&PciDevice) -> Option<Box<dyn Driver>>,
     /// Higher = more specific match (vendor/device beats class)
     pub specificity: u8,
+    pub stage: ProbeStage,
+}
+
+/// When a driver is probed relative to the root mount.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub(super) enum ProbeStage {
+    /// Needed before the root filesystem is mounted.
+    Boot,
+    /// Probed in parallel with the rest of boot and userspace startup.
+    Deferred,
 }
 
 pub(super) fn matches_pci(rule: &PciMatch, dev: &PciDevice) -> bool {
@@ -57,6 +74,8 @@ pub(super) fn matches_pci(rule: &PciMatch, dev: &PciDevice) -> bool {
 // │ VendorDevice │ 80EE:BEEF│ VBoxVGA / VBoxSVGA (GPU, auto-detect)         │
 // │ VendorDevice │ 15AD:0405│ VMware SVGA II (GPU)                          │
 // │ VendorDevice │ 1AF4:1050│ VirtIO GPU                                    │
+// │ VendorDevice │ 1AF4:1042│ VirtIO Block (Storage)                        │
+// │ VendorDevice │ 1AF4:1001│ VirtIO Block, transitional (Storage)          │
 // │ VendorDevice │ 8086:100E│ Intel 82540EM Ethernet (Network, QEMU)        │
 // │ VendorDevice │ 8086:100F│ Intel 82545EM Ethernet (Network, VMware)      │
 // │ VendorDevice │ 1000:0030│ LSI Logic Fusion-MPT SCSI (Storage)           │
@@ -82,46 +101,79 @@ pub(super) static PCI_DRIVER_TABLE: &[PciDriverEntry] = &[
         match_rule: PciMatch::VendorDevice { vendor: 0x1234, device: 0x1111 },
         factory: |pci| crate::drivers::gpu::bochs_probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x80EE, device: 0xBEEF },
         factory: |pci| crate::drivers::gpu::vbox_probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x15AD, device: 0x0405 },
         factory: |pci| crate::drivers::gpu::vmware_svga::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x1AF4, device: 0x1050 },
         factory: |pci| crate::drivers::gpu::virtio_gpu::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
+    },
+    PciDriverEntry {
+        match_rule: PciMatch::VendorDevice { vendor: 0x1AF4, device: 0x1042 },
+        factory: |pci| crate::drivers::storage::virtio_blk::probe(pci),
+        specificity: 2,
+        stage: ProbeStage::Boot,
+    },
+    PciDriverEntry {
+        match_rule: PciMatch::VendorDevice { vendor: 0x1AF4, device: 0x1001 },
+        factory: |pci| crate::drivers::storage::virtio_blk::probe(pci),
+        specificity: 2,
+        stage: ProbeStage::Boot,
+    },
+    PciDriverEntry {
+        match_rule: PciMatch::VendorDevice { vendor: 0x1AF4, device: 0x1041 },
+        factory: |pci| crate::drivers::network::virtio_net::probe(pci),
+        specificity: 2,
+        stage: ProbeStage::Deferred,
+    },
+    PciDriverEntry {
+        match_rule: PciMatch::VendorDevice { vendor: 0x1AF4, device: 0x1000 },
+        factory: |pci| crate::drivers::network::virtio_net::probe(pci),
+        specificity: 2,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x8086, device: 0x100E },
         factory: |pci| crate::drivers::network::e1000::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x8086, device: 0x100F },
         factory: |pci| crate::drivers::network::e1000::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x1000, device: 0x0030 },
         factory: |pci| crate::drivers::storage::lsi_scsi::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x80EE, device: 0x4E56 },
         factory: |pci| crate::drivers::storage::nvme::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::VendorDevice { vendor: 0x80EE, device: 0xCAFE },
         factory: |pci| crate::drivers::vmmdev::probe(pci),
         specificity: 2,
+        stage: ProbeStage::Boot,
     },
 
     // ── Class-based matches (specificity 1) ──
@@ -130,45 +182,54 @@ pub(super) static PCI_DRIVER_TABLE: &[PciDriverEntry] = &[
         match_rule: PciMatch::Class { class: 0x01, subclass: 0x01 },
         factory: |pci| crate::drivers::storage::ide_probe(pci),
         specificity: 1,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x01, subclass: 0x06 },
         factory: |pci| crate::drivers::storage::ahci::probe(pci),
         specificity: 1,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x01, subclass: 0x08 },
         factory: |pci| crate::drivers::storage::nvme::probe(pci),
         specificity: 1,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x02, subclass: 0x00 },
         factory: |pci| crate::drivers::network::e1000::probe(pci),
         specificity: 1,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x03, subclass: 0x00 },
         factory: |pci| crate::drivers::gpu::generic_vga_probe(pci),
         specificity: 1,
+        stage: ProbeStage::Boot,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x04, subclass: 0x01 },
         factory: |pci| crate::drivers::audio::ac97::probe(pci),
         specificity: 1,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x04, subclass: 0x03 },
         factory: |pci| crate::drivers::audio::hda::probe(pci),
         specificity: 1,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x0C, subclass: 0x03 },
         factory: |pci| crate::drivers::usb::probe(pci),
         specificity: 1,
+        stage: ProbeStage::Deferred,
     },
     PciDriverEntry {
         match_rule: PciMatch::Class { class: 0x0C, subclass: 0x05 },
         factory: |pci| crate::drivers::usb::smbus_probe(pci),
         specificity: 1,
+        stage: ProbeStage::Deferred,
     },
 ];
@@ -83,6 +83,20 @@ pub fn read_datetime() -> (u16, u8, u8, u8, u8, u8) {
     (t.year, t.month, t.day, t.hours, t.minutes, t.seconds)
 }
 
+/// Read the current time as seconds since 1970-01-01 (the RTC is taken as UTC).
+pub fn unix_time() -> u64 {
+    let t = read_time();
+    // Days from civil date, with the year starting in March so the leap
+    // day is the last day of the year
+    let (y, m) = if t.month <= 2 {
+        (t.year as u64 - 1, t.month as u64 + 9)
+    } else {
+        (t.year as u64, t.month as u64 - 3)
+    };
+    let days = 365 * y + y / 4 - y / 100 + y / 400 + (153 * m + 2) / 5 + t.day as u64 - 1 - 719_468;
+    days * 86400 + t.hours as u64 * 3600 + t.minutes as u64 * 60 + t.seconds as u64
+}
+
 /// Initialize the RTC driver and log the current date/time.
 pub fn init() {
     let time = read_time();
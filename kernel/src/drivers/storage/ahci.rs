@@ -2,11 +2,26 @@
 //!
 //! Supports AHCI 1.0+ host controllers (PCI class 01:06, prog IF 01).
 //! Uses DMA transfers via MMIO, replacing legacy ATA PIO when available.
+//!
+//! When both the HBA and the disk support Native Command Queuing, reads and
+//! writes are issued as READ/WRITE FPDMA QUEUED in up to 32 command slots at
+//! once; otherwise one READ/WRITE DMA EXT at a time.  Requests go through a
+//! [`RequestQueue`] elevator that merges adjacent LBAs, and completions are
+//! reaped by the IRQ handler, which wakes the submitting threads (polled
+//! during boot or without an IRQ line).
+//!
+//! Kernel buffers are DMA'd in place through the PRDT; user-space and
+//! odd-aligned buffers go through the bounce buffer.
 
 use alloc::boxed::Box;
+use super::blockdev::{Batch, RequestQueue, Segment};
 use crate::drivers::pci::{PciDevice, pci_config_read32, pci_config_write32};
 use crate::memory::address::{PhysAddr, VirtAddr};
 use crate::memory::{virtual_mem, physical};
+use crate::sync::mutex::Mutex;
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
 
 // AHCI MMIO virtual base — after E1000 (0xD000_0000) and VMware SVGA FIFO (0xD002_0000)
 const AHCI_MMIO_VIRT: u64 = 0xFFFF_FFFF_D006_0000;
@@ -21,6 +36,8 @@ const REG_VS: u64 = 0x10;
 
 const GHC_AE: u32 = 1 << 31;
 
+const CAP_SNCQ: u32 = 1 << 30; // Supports Native Command Queuing
+
 // ── Per-Port Registers (base = 0x100 + port * 0x80) ─
 const PORT_CLB: u64 = 0x00;
 const PORT_CLBU: u64 = 0x04;
@@ -33,8 +50,18 @@ const PORT_TFD: u64 = 0x20;
 const PORT_SIG: u64 = 0x24;
 const PORT_SSTS: u64 = 0x28;
 const PORT_SERR: u64 = 0x30;
+const PORT_SACT: u64 = 0x34;
 const PORT_CI: u64 = 0x38;
 
+// PxIS / PxIE bits
+const IS_DHRS: u32 = 1 << 0;  // D2H Register FIS (non-queued command done)
+const IS_SDBS: u32 = 1 << 3;  // Set Device Bits FIS (NCQ commands done)
+const IS_IFS: u32 = 1 << 27;  // Interface Fatal Error
+const IS_HBDS: u32 = 1 << 28; // Host Bus Data Error
+const IS_HBFS: u32 = 1 << 29; // Host Bus Fatal Error
+const IS_TFES: u32 = 1 << 30; // Task File Error
+const IS_ERRORS: u32 = IS_IFS | IS_HBDS | IS_HBFS | IS_TFES;
+
 const CMD_ST: u32 = 1 << 0;
 const CMD_FRE: u32 = 1 << 4;
 const CMD_FR: u32 = 1 << 14;
@@ -43,6 +70,8 @@ const CMD_CR: u32 = 1 << 15;
 // ── ATA Commands ────────────────────────────────────
 const ATA_CMD_READ_DMA_EXT: u8 = 0x25;
 const ATA_CMD_WRITE_DMA_EXT: u8 = 0x35;
+const ATA_CMD_READ_FPDMA_QUEUED: u8 = 0x60;
+const ATA_CMD_WRITE_FPDMA_QUEUED: u8 = 0x61;
 const ATA_CMD_FLUSH_EXT: u8 = 0xEA;
 const ATA_CMD_IDENTIFY: u8 = 0xEC;
 
@@ -55,7 +84,29 @@ const BOUNCE_BUF_SECTORS: u32 = 256;
 const BOUNCE_BUF_SIZE: usize = BOUNCE_BUF_SECTORS as usize * 512;
 const BOUNCE_BUF_FRAMES: usize = BOUNCE_BUF_SIZE / 4096; // 32
 
-const MAX_PRDT: usize = 8;
+/// PRDT entries per command table (one table per slot, 1152 bytes).
+const MAX_PRDT: usize = 64;
+/// Bytes one PRDT entry can describe.
+const PRD_MAX_BYTES: u64 = 4 * 1024 * 1024;
+/// Largest command handed to the disk (128 KiB).
+const MAX_CMD_SECTORS: u32 = 256;
+/// Command slots per port (AHCI maximum).
+const MAX_SLOTS: usize = 32;
+
+/// Give up on a command after this long (ms).
+const IO_TIMEOUT_MS: u32 = 5000;
+/// Polls before timing out when the tick counter is not running yet.
+const IO_TIMEOUT_POLLS: u32 = 10_000_000;
+/// Polls before a thread that can sleep blocks on its completion.
+const SPIN_POLLS: u32 = 50_000;
+/// A blocked waiter re-checks its slot at least this often (ms).
+const BLOCK_SLICE_MS: u32 = 10;
+
+const PTE_PRESENT: u64  = 1 << 0;
+const PTE_WRITABLE: u64 = 1 << 1;
+const PTE_PHYS_MASK: u64 = 0x000F_FFFF_FFFF_F000;
+/// Start of the kernel half; only buffers above it are DMA'd in place.
+const KERNEL_SPACE: u64 = 0xFFFF_8000_0000_0000;
 
 // ── HBA Data Structures (all DMA-accessible) ────────
 
@@ -112,25 +163,52 @@ const GHC_IE: u32 = 1 << 1;
 
 // ── Controller State ────────────────────────────────
 
+/// Completion state of one command slot.
+struct CmdSlot {
+    /// Set by the reaper once the command finished (or was aborted).
+    done: AtomicBool,
+    ok: AtomicBool,
+    /// TID blocked on this slot (0 = nobody).
+    waiter: AtomicU32,
+    /// Physical address of this slot's command table.
+    table_phys: u64,
+}
+
+/// Slot bookkeeping, protected by `AhciController::port`.
+struct PortState {
+    /// Slots available for new commands.
+    free: u32,
+    /// Slots issued to the HBA and not yet reaped.
+    issued: u32,
+    /// A non-queued command waits for the port to go idle; no new claims.
+    draining: bool,
+}
+
 struct AhciController {
     mmio_base: u64,
     active_port: u32,
     clb_phys: u64,
     fb_phys: u64,
-    ctba_phys: u64,
     bounce_phys: u64,
     bounce_virt: u64,   // = bounce_phys (identity-mapped)
     total_sectors: u64,
     irq: u8,
+    /// Completions are signalled by the IRQ handler.
+    irq_enabled: bool,
+    /// Reads/writes use FPDMA QUEUED commands.
+    ncq: bool,
+    /// Slots usable at once (NCQ depth, or 1).
+    depth: usize,
+    port: Spinlock<PortState>,
+    slots: [CmdSlot; MAX_SLOTS],
+    /// Serializes users of the bounce buffer.
+    bounce: Mutex<()>,
 }
 
 static mut AHCI: Option<AhciController> = None;
 
-/// TID of the thread currently waiting for AHCI I/O completion.
-/// 0 means no thread is waiting.
-static AHCI_WAITER: core::sync::atomic::AtomicU32 = core::sync::atomic::AtomicU32::new(0);
-/// Set to true by the IRQ handler when the command completes.
-static AHCI_IRQ_FIRED: core::sync::atomic::AtomicBool = core::sync::atomic::AtomicBool::new(false);
+/// Elevator in front of the port.
+static QUEUE: RequestQueue = RequestQueue::new();
 
 // ── MMIO Helpers ────────────────────────────────────
 
@@ -210,8 +288,6 @@ unsafe fn start_port(base: u64, port: u32) {
 // ── IRQ Handler ─────────────────────────────────────
 
 fn ahci_irq_handler(_irq: u8) {
-    use core::sync::atomic::Ordering;
-
     let ahci = match unsafe { AHCI.as_ref() } {
         Some(a) => a,
         None => return,
@@ -224,56 +300,235 @@ fn ahci_irq_handler(_irq: u8) {
             return; // Not our port
         }
 
-        // Clear port interrupt status
-        let port_is = port_read(ahci.mmio_base, ahci.active_port, PORT_IS);
-        port_write(ahci.mmio_base, ahci.active_port, PORT_IS, port_is);
+        // Reap finished slots (clears the port interrupt status)
+        {
+            let mut st = ahci.port.lock();
+            reap(ahci, &mut st, true);
+        }
 
         // Clear HBA global interrupt status
         mmio_write32(ahci.mmio_base, REG_IS, hba_is);
+    }
+}
+
+// ── Completion ──────────────────────────────────────
+
+/// Whether the caller may yield or block.
+#[inline]
+fn can_sleep() -> bool {
+    scheduler::current_tid() != 0 && crate::arch::hal::interrupts_enabled()
+}
+
+/// Wake `tid`; from IRQ context without spinning on SCHEDULER.
+#[inline]
+fn wake(tid: u32, in_irq: bool) {
+    if !in_irq {
+        scheduler::wake_thread(tid);
+    } else if !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
+
+/// Mark the slots in `mask` finished and wake their waiters.
+fn complete(ahci: &AhciController, st: &mut PortState, mask: u32, ok: bool, in_irq: bool) {
+    st.issued &= !mask;
+    let mut bits = mask;
+    while bits != 0 {
+        let slot = bits.trailing_zeros() as usize;
+        bits &= bits - 1;
+        let s = &ahci.slots[slot];
+        s.ok.store(ok, Ordering::Relaxed);
+        s.done.store(true, Ordering::Release);
+        let tid = s.waiter.swap(0, Ordering::AcqRel);
+        if tid != 0 {
+            wake(tid, in_irq);
+        }
+    }
+}
+
+/// Collect finished commands.  Caller holds `ahci.port`.
+///
+/// A slot is finished once its bit left both PxSACT and PxCI.  On an error
+/// the port is restarted, which aborts everything in flight: all issued
+/// slots fail (NCQ error recovery via READ LOG EXT is not implemented).
+unsafe fn reap(ahci: &AhciController, st: &mut PortState, in_irq: bool) {
+    let (base, port) = (ahci.mmio_base, ahci.active_port);
+    let is = port_read(base, port, PORT_IS);
+    if is != 0 {
+        port_write(base, port, PORT_IS, is);
+    }
+    if st.issued == 0 {
+        return;
+    }
+
+    let tfd = port_read(base, port, PORT_TFD);
+    if is & IS_ERRORS != 0 || (!ahci.ncq && tfd & 0x81 == 0x01) {
+        crate::serial_println!(
+            "AHCI: command error, IS={:#x} TFD={:#x}, aborting {} command(s)",
+            is, tfd, st.issued.count_ones()
+        );
+        reset_port(ahci);
+        let issued = st.issued;
+        complete(ahci, st, issued, false, in_irq);
+        return;
+    }
+
+    let busy = port_read(base, port, PORT_SACT) | port_read(base, port, PORT_CI);
+    let finished = st.issued & !busy;
+    if finished != 0 {
+        complete(ahci, st, finished, true, in_irq);
+    }
+}
+
+/// Restart the port after an error or timeout (clears PxCI and PxSACT).
+unsafe fn reset_port(ahci: &AhciController) {
+    let (base, port) = (ahci.mmio_base, ahci.active_port);
+    stop_port(base, port);
+    port_write(base, port, PORT_SERR, 0xFFFF_FFFF);
+    port_write(base, port, PORT_IS, 0xFFFF_FFFF);
+    start_port(base, port);
+}
+
+// ── Slots ───────────────────────────────────────────
+
+fn try_claim(ahci: &AhciController) -> Option<usize> {
+    let mut st = ahci.port.lock();
+    if st.draining || st.free == 0 {
+        return None;
+    }
+    let slot = st.free.trailing_zeros() as usize;
+    st.free &= !(1 << slot);
+    Some(slot)
+}
 
-        // Only signal completion when the command is actually done (CI bit 0 clear)
-        let ci = port_read(ahci.mmio_base, ahci.active_port, PORT_CI);
-        if ci & 1 != 0 {
-            return; // Command still in progress — mid-transfer interrupt, ignore
+/// Claim a slot, waiting while all usable ones are busy.
+fn claim(ahci: &AhciController) -> usize {
+    loop {
+        if let Some(slot) = try_claim(ahci) {
+            return slot;
         }
+        back_off(ahci);
     }
+}
+
+fn release(ahci: &AhciController, slot: usize) {
+    ahci.port.lock().free |= 1 << slot;
+}
+
+/// Nothing to do until other commands finish: reap, then let them run.
+fn back_off(ahci: &AhciController) {
+    if let Some(mut st) = ahci.port.try_lock() {
+        unsafe { reap(ahci, &mut st, false); }
+    }
+    if can_sleep() {
+        scheduler::schedule();
+    } else {
+        core::hint::spin_loop();
+    }
+}
+
+#[inline]
+fn slot_mask(depth: usize) -> u32 {
+    if depth >= 32 { u32::MAX } else { (1u32 << depth) - 1 }
+}
 
-    // Command complete — signal and wake
-    AHCI_IRQ_FIRED.store(true, Ordering::Release);
+// ── DMA Addressing ──────────────────────────────────
+
+/// Physical address of `va`, if mapped (and writable when the device writes
+/// to memory).
+#[inline]
+fn dma_addr(va: u64, to_memory: bool) -> Option<u64> {
+    let pte = virtual_mem::read_pte(VirtAddr::new(va & !0xFFF));
+    if pte & PTE_PRESENT == 0 || (to_memory && pte & PTE_WRITABLE == 0) {
+        return None;
+    }
+    Some((pte & PTE_PHYS_MASK) | (va & 0xFFF))
+}
+
+/// Whether `[va, va + len)` can be handed to the HBA as is.
+///
+/// Touches every page first so demand-paged heap pages are present when
+/// their PTEs are read.
+fn dma_capable(va: u64, len: usize, to_memory: bool) -> bool {
+    if va < KERNEL_SPACE || va & 1 != 0 {
+        return false;
+    }
+    let end = va + len as u64;
+    let mut page = va & !0xFFF;
+    while page < end {
+        let p = page.max(va) as *mut u8;
+        unsafe {
+            let v = core::ptr::read_volatile(p);
+            if to_memory {
+                core::ptr::write_volatile(p, v);
+            }
+        }
+        if dma_addr(page, to_memory).is_none() {
+            return false;
+        }
+        page += 4096;
+    }
+    true
+}
 
-    let tid = AHCI_WAITER.load(Ordering::Acquire);
-    if tid != 0 {
-        crate::task::scheduler::wake_thread(tid);
+/// Describe `segments` in the PRDT of `table`, merging physically
+/// contiguous pages.  Returns the entry count.
+unsafe fn build_prdt(table: *mut CmdTable, segments: &[Segment], to_memory: bool) -> Option<u16> {
+    let prdt = &mut (*table).prdt;
+    let mut n = 0usize;
+    let mut run_end = u64::MAX;
+    for seg in segments {
+        let mut va = seg.addr;
+        let end = seg.addr + seg.bytes as u64;
+        while va < end {
+            let chunk = ((va & !0xFFF) + 4096).min(end) - va;
+            let pa = dma_addr(va, to_memory)?;
+            let cur_len = if n > 0 { (prdt[n - 1].dbc & 0x3F_FFFF) as u64 + 1 } else { 0 };
+            if n > 0 && pa == run_end && cur_len + chunk <= PRD_MAX_BYTES {
+                prdt[n - 1].dbc = (cur_len + chunk - 1) as u32;
+            } else {
+                if n == MAX_PRDT {
+                    return None;
+                }
+                prdt[n].dba = pa as u32;
+                prdt[n].dbau = (pa >> 32) as u32;
+                prdt[n]._reserved = 0;
+                prdt[n].dbc = (chunk - 1) as u32;
+                n += 1;
+            }
+            run_end = pa + chunk;
+            va += chunk;
+        }
     }
+    Some(n as u16)
 }
 
-// ── Command Issue (IRQ-driven, slot 0 only) ─────────
+// ── Command Issue ───────────────────────────────────
 
-unsafe fn issue_command(
+/// Fill `slot`'s command header and table.  For FPDMA QUEUED commands the
+/// sector count goes into FEATURES and the tag (= slot) into COUNT.
+unsafe fn prepare_slot(
     ahci: &AhciController,
+    slot: usize,
     command: u8,
     lba: u64,
-    count: u16,
-    dma_phys: u64,
-    dma_size: u32,
+    count: u32,
+    segments: &[Segment],
     write: bool,
 ) -> bool {
-    // Set up command header (slot 0)
-    let cmd_header = ahci.clb_phys as *mut CmdHeader;
-    let cfl: u16 = 5; // 5 DWORDs for Register H2D FIS
-    let w_bit: u16 = if write { 1 << 6 } else { 0 };
-    (*cmd_header).flags = cfl | w_bit;
-    (*cmd_header).prdtl = if dma_size > 0 { 1 } else { 0 };
-    (*cmd_header).prdbc = 0;
-    // ctba/ctbau already set during init
-
-    // Set up command table
-    let cmd_table = ahci.ctba_phys as *mut CmdTable;
+    let cmd_table = ahci.slots[slot].table_phys as *mut CmdTable;
 
     // Zero CFIS + ACMD
     core::ptr::write_bytes((*cmd_table).cfis.as_mut_ptr(), 0, 64);
     core::ptr::write_bytes((*cmd_table).acmd.as_mut_ptr(), 0, 16);
 
+    let queued = command == ATA_CMD_READ_FPDMA_QUEUED || command == ATA_CMD_WRITE_FPDMA_QUEUED;
+    let (count_field, features) = if queued {
+        ((slot as u16) << 3, count as u16)
+    } else {
+        (count as u16, 0)
+    };
+
     // Fill Register H2D FIS
     let fis = (*cmd_table).cfis.as_mut_ptr() as *mut FisRegH2D;
     (*fis).fis_type = FIS_TYPE_REG_H2D;
@@ -286,193 +541,218 @@ unsafe fn issue_command(
     (*fis).lba3 = ((lba >> 24) & 0xFF) as u8;
     (*fis).lba4 = ((lba >> 32) & 0xFF) as u8;
     (*fis).lba5 = ((lba >> 40) & 0xFF) as u8;
-    (*fis).count_lo = (count & 0xFF) as u8;
-    (*fis).count_hi = ((count >> 8) & 0xFF) as u8;
-    (*fis).features_lo = 0;
-    (*fis).features_hi = 0;
-
-    // Fill PRDT[0] if data transfer
-    if dma_size > 0 {
-        (*cmd_table).prdt[0].dba = dma_phys as u32;
-        (*cmd_table).prdt[0].dbau = (dma_phys >> 32) as u32;
-        (*cmd_table).prdt[0]._reserved = 0;
-        (*cmd_table).prdt[0].dbc = (dma_size - 1) | (1 << 31); // IOC + byte count
-    }
-
-    // Clear port interrupt status
-    port_write(ahci.mmio_base, ahci.active_port, PORT_IS, 0xFFFF_FFFF);
+    (*fis).count_lo = (count_field & 0xFF) as u8;
+    (*fis).count_hi = ((count_field >> 8) & 0xFF) as u8;
+    (*fis).features_lo = (features & 0xFF) as u8;
+    (*fis).features_hi = ((features >> 8) & 0xFF) as u8;
 
-    // Reset IRQ completion flag
-    AHCI_IRQ_FIRED.store(false, core::sync::atomic::Ordering::Release);
+    let prdtl = match build_prdt(cmd_table, segments, !write) {
+        Some(n) => n,
+        None => return false,
+    };
 
-    // Issue command (slot 0)
-    port_write(ahci.mmio_base, ahci.active_port, PORT_CI, 1);
+    // Set up command header (ctba/ctbau already set during init)
+    let cmd_header = (ahci.clb_phys as *mut CmdHeader).add(slot);
+    let cfl: u16 = 5; // 5 DWORDs for Register H2D FIS
+    let w_bit: u16 = if write { 1 << 6 } else { 0 };
+    (*cmd_header).flags = cfl | w_bit;
+    (*cmd_header).prdtl = prdtl;
+    (*cmd_header).prdbc = 0;
+    true
+}
 
-    // Fast path: spin-wait for command completion.
-    for _ in 0..50_000 {
-        let ci = port_read(ahci.mmio_base, ahci.active_port, PORT_CI);
-        if ci & 1 == 0 {
-            let tfd = port_read(ahci.mmio_base, ahci.active_port, PORT_TFD);
-            if tfd & 0x01 != 0 {
-                crate::serial_println!("AHCI: command error, TFD={:#x}", tfd);
-                return false;
-            }
-            return true;
-        }
-        core::hint::spin_loop();
+/// Hand a prepared slot to the HBA.
+unsafe fn issue(ahci: &AhciController, slot: usize, queued: bool) {
+    let s = &ahci.slots[slot];
+    s.done.store(false, Ordering::Relaxed);
+    s.ok.store(false, Ordering::Relaxed);
+    s.waiter.store(0, Ordering::Relaxed);
+
+    let mut st = ahci.port.lock();
+    st.issued |= 1 << slot;
+    if queued {
+        // PxSACT must be set before PxCI for FPDMA commands
+        port_write(ahci.mmio_base, ahci.active_port, PORT_SACT, 1 << slot);
     }
+    port_write(ahci.mmio_base, ahci.active_port, PORT_CI, 1 << slot);
+}
 
-    // Slow path: block on IRQ, with timeout fallback.
-    let tid = crate::task::scheduler::current_tid();
-    if tid > 0 {
-        if ahci.irq > 0 {
-            AHCI_WAITER.store(tid, core::sync::atomic::Ordering::Release);
+/// Wait for the command in `slot` and free the slot.
+///
+/// Spins briefly, then (with an IRQ and a thread that can sleep) blocks
+/// until the IRQ handler reaps the slot; otherwise keeps polling.  A
+/// timed-out command resets the port, failing everything in flight.
+fn wait_slot(ahci: &AhciController, slot: usize) -> bool {
+    let s = &ahci.slots[slot];
+    let tid = scheduler::current_tid();
+    let can_block = ahci.irq_enabled && can_sleep();
+    let start = crate::arch::x86::pit::get_ticks();
+    let mut polls = 0u32;
+
+    while !s.done.load(Ordering::Acquire) {
+        let elapsed = crate::arch::x86::pit::get_ticks().wrapping_sub(start);
+        if polls >= IO_TIMEOUT_POLLS || elapsed > IO_TIMEOUT_MS {
+            let mut st = ahci.port.lock();
+            if !s.done.load(Ordering::Acquire) {
+                crate::serial_println!("AHCI: command timeout (slot {})", slot);
+                unsafe { reset_port(ahci); }
+                let issued = st.issued;
+                complete(ahci, &mut st, issued, false, false);
+            }
+            break;
         }
-
-        crate::task::scheduler::block_current_thread();
-
-        AHCI_WAITER.store(0, core::sync::atomic::Ordering::Release);
-
-        let ci = port_read(ahci.mmio_base, ahci.active_port, PORT_CI);
-        if ci & 1 == 0 {
-            let tfd = port_read(ahci.mmio_base, ahci.active_port, PORT_TFD);
-            if tfd & 0x01 != 0 {
-                crate::serial_println!("AHCI: command error, TFD={:#x}", tfd);
-                return false;
+        if can_block && polls >= SPIN_POLLS {
+            // Publish the waiter under the port lock: the IRQ handler reaps
+            // under the same lock, so it either ran before (and `done` is
+            // visible here) or will see our TID.
+            let mut st = ahci.port.lock();
+            unsafe { reap(ahci, &mut st, false); }
+            if s.done.load(Ordering::Acquire) {
+                break;
             }
-            return true;
+            s.waiter.store(tid, Ordering::Release);
+            let wake_at = crate::arch::x86::pit::get_ticks().wrapping_add(BLOCK_SLICE_MS);
+            scheduler::prepare_block_current(Some(wake_at));
+            drop(st);
+            scheduler::schedule();
+            s.waiter.store(0, Ordering::Relaxed);
+        } else {
+            if let Some(mut st) = ahci.port.try_lock() {
+                unsafe { reap(ahci, &mut st, false); }
+            }
+            polls += 1;
+            core::hint::spin_loop();
         }
     }
 
-    // Fallback: extended poll (boot thread or no IRQ)
-    poll_completion(ahci)
+    let ok = s.ok.load(Ordering::Relaxed);
+    release(ahci, slot);
+    ok
 }
 
-/// Polled completion check (used during boot or as IRQ timeout fallback).
-unsafe fn poll_completion(ahci: &AhciController) -> bool {
-    for _ in 0..10_000_000 {
-        let ci = port_read(ahci.mmio_base, ahci.active_port, PORT_CI);
-        if ci & 1 == 0 {
-            let tfd = port_read(ahci.mmio_base, ahci.active_port, PORT_TFD);
-            if tfd & 0x01 != 0 {
-                crate::serial_println!("AHCI: command error, TFD={:#x}", tfd);
-                return false;
+/// Run a non-queued command (IDENTIFY, FLUSH) with the port otherwise
+/// idle: NCQ and non-queued commands must not be outstanding together.
+fn issue_exclusive(ahci: &AhciController, command: u8, lba: u64, count: u16, data: Option<Segment>) -> bool {
+    // Become the drainer, then wait until every slot is back.
+    loop {
+        {
+            let mut st = ahci.port.lock();
+            if !st.draining {
+                st.draining = true;
+                break;
+            }
+        }
+        back_off(ahci);
+    }
+    let all = slot_mask(ahci.depth);
+    loop {
+        {
+            let mut st = ahci.port.lock();
+            if st.free & all == all {
+                st.free &= !1;
+                break;
             }
-            return true;
         }
+        back_off(ahci);
+    }
 
-        let is = port_read(ahci.mmio_base, ahci.active_port, PORT_IS);
-        if is & (1 << 30) != 0 {
-            crate::serial_println!("AHCI: task file error, IS={:#x}", is);
-            return false;
+    let segments = data.as_ref().map(core::slice::from_ref).unwrap_or(&[]);
+    let ok = unsafe {
+        if prepare_slot(ahci, 0, command, lba, count as u32, segments, false) {
+            issue(ahci, 0, false);
+            wait_slot(ahci, 0)
+        } else {
+            release(ahci, 0);
+            false
         }
+    };
+    ahci.port.lock().draining = false;
+    ok
+}
 
-        core::hint::spin_loop();
+/// Run one (possibly merged) read or write from the request queue.
+fn exec_batch(ahci: &AhciController, batch: &Batch) -> bool {
+    let command = match (ahci.ncq, batch.write) {
+        (true, false) => ATA_CMD_READ_FPDMA_QUEUED,
+        (true, true) => ATA_CMD_WRITE_FPDMA_QUEUED,
+        (false, false) => ATA_CMD_READ_DMA_EXT,
+        (false, true) => ATA_CMD_WRITE_DMA_EXT,
+    };
+    let slot = claim(ahci);
+    unsafe {
+        if !prepare_slot(ahci, slot, command, batch.lba, batch.count, batch.segments, batch.write) {
+            release(ahci, slot);
+            return false;
+        }
+        issue(ahci, slot, ahci.ncq);
     }
-
-    crate::serial_println!("AHCI: command timeout");
-    false
+    wait_slot(ahci, slot)
 }
 
 // ── Public Read / Write API ─────────────────────────
 
-/// Read `count` sectors starting at `lba` into `buf` via AHCI DMA.
-pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
-    let ahci = match unsafe { AHCI.as_ref() } {
-        Some(a) => a,
-        None => return false,
-    };
-
-    let mut offset = 0usize;
-    let mut remaining = count;
-    let mut cur_lba = lba as u64;
-
-    while remaining > 0 {
-        let batch = remaining.min(BOUNCE_BUF_SECTORS);
-        let byte_count = batch as usize * 512;
-
-        let ok = unsafe {
-            issue_command(
-                ahci,
-                ATA_CMD_READ_DMA_EXT,
-                cur_lba,
-                batch as u16,
-                ahci.bounce_phys,
-                byte_count as u32,
-                false,
-            )
-        };
+/// Transfer `count` sectors to/from the `len` bytes at `addr` through the
+/// request queue, in place when possible, else via the bounce buffer.
+fn transfer(ahci: &'static AhciController, lba: u64, count: u32, addr: u64, len: usize, write: bool) -> bool {
+    let exec = |b: &Batch| exec_batch(ahci, b);
+    let bytes = count as usize * 512;
+    if len >= bytes && dma_capable(addr, bytes, !write) {
+        return QUEUE.submit(lba, count, addr, write, &exec);
+    }
 
-        if !ok {
+    let _bounce = ahci.bounce.lock();
+    let mut done = 0u32;
+    while done < count {
+        let batch = (count - done).min(BOUNCE_BUF_SECTORS);
+        let offset = done as usize * 512;
+        let copy_len = (offset + batch as usize * 512).min(len).saturating_sub(offset);
+
+        if write && copy_len > 0 {
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    (addr + offset as u64) as *const u8, ahci.bounce_virt as *mut u8, copy_len,
+                );
+            }
+        }
+        if !QUEUE.submit(lba + done as u64, batch, ahci.bounce_virt, write, &exec) {
             return false;
         }
-
-        // Copy from bounce buffer to caller buffer
-        unsafe {
-            core::ptr::copy_nonoverlapping(
-                ahci.bounce_virt as *const u8,
-                buf.as_mut_ptr().add(offset),
-                byte_count,
-            );
+        if !write && copy_len > 0 {
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    ahci.bounce_virt as *const u8, (addr + offset as u64) as *mut u8, copy_len,
+                );
+            }
         }
-
-        offset += byte_count;
-        cur_lba += batch as u64;
-        remaining -= batch;
+        done += batch;
     }
-
     true
 }
 
+/// Read `count` sectors starting at `lba` into `buf` via AHCI DMA.
+///
+/// Safe to call from several CPUs at once; the storage layer does not
+/// serialize AHCI requests.
+pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    let ahci = match unsafe { AHCI.as_ref() } {
+        Some(a) => a,
+        None => return false,
+    };
+    transfer(ahci, lba as u64, count, buf.as_mut_ptr() as u64, buf.len(), false)
+}
+
 /// Write `count` sectors starting at `lba` from `buf` via AHCI DMA.
 pub fn write_sectors(lba: u32, count: u32, buf: &[u8]) -> bool {
     let ahci = match unsafe { AHCI.as_ref() } {
         Some(a) => a,
         None => return false,
     };
-
-    let mut offset = 0usize;
-    let mut remaining = count;
-    let mut cur_lba = lba as u64;
-
-    while remaining > 0 {
-        let batch = remaining.min(BOUNCE_BUF_SECTORS);
-        let byte_count = batch as usize * 512;
-
-        // Copy caller data to bounce buffer
-        unsafe {
-            core::ptr::copy_nonoverlapping(
-                buf.as_ptr().add(offset),
-                ahci.bounce_virt as *mut u8,
-                byte_count,
-            );
-        }
-
-        let ok = unsafe {
-            issue_command(
-                ahci,
-                ATA_CMD_WRITE_DMA_EXT,
-                cur_lba,
-                batch as u16,
-                ahci.bounce_phys,
-                byte_count as u32,
-                true,
-            )
-        };
-
-        if !ok {
-            return false;
-        }
-
-        offset += byte_count;
-        cur_lba += batch as u64;
-        remaining -= batch;
+    if !transfer(ahci, lba as u64, count, buf.as_ptr() as u64, buf.len(), true) {
+        return false;
     }
 
     // Flush cache
-    unsafe {
-        let _ = issue_command(ahci, ATA_CMD_FLUSH_EXT, 0, 0, 0, 0, false);
-    }
+    let _ = issue_exclusive(ahci, ATA_CMD_FLUSH_EXT, 0, 0, None);
 
     true
 }
@@ -576,14 +856,18 @@ pub fn init_and_register(pci: &PciDevice) {
             }
         };
 
-        // Command Table: ~256 bytes (1 frame, 128-byte aligned by nature of 4K frame)
-        let ctba_phys = match physical::alloc_frame() {
-            Some(f) => f.as_u64(),
-            None => {
-                crate::serial_println!("  AHCI: Failed to allocate CT frame");
-                return;
-            }
-        };
+        // Command Tables: one frame per slot the HBA implements (CAP.NCS)
+        let num_slots = (((cap >> 8) & 0x1F) + 1) as usize;
+        let mut tables = [0u64; MAX_SLOTS];
+        for table in tables.iter_mut().take(num_slots) {
+            *table = match physical::alloc_frame() {
+                Some(f) => f.as_u64(),
+                None => {
+                    crate::serial_println!("  AHCI: Failed to allocate CT frame");
+                    return;
+                }
+            };
+        }
 
         // Bounce buffer: 128 KiB = 32 contiguous frames
         let bounce_phys = match physical::alloc_contiguous(BOUNCE_BUF_FRAMES) {
@@ -597,13 +881,15 @@ pub fn init_and_register(pci: &PciDevice) {
         // Zero all DMA structures
         core::ptr::write_bytes(clb_phys as *mut u8, 0, 4096);
         core::ptr::write_bytes(fb_phys as *mut u8, 0, 4096);
-        core::ptr::write_bytes(ctba_phys as *mut u8, 0, 4096);
         core::ptr::write_bytes(bounce_phys as *mut u8, 0, BOUNCE_BUF_SIZE);
 
-        // Pre-configure CmdHeader[0] to point to our command table
-        let cmd_header = clb_phys as *mut CmdHeader;
-        (*cmd_header).ctba = ctba_phys as u32;
-        (*cmd_header).ctbau = (ctba_phys >> 32) as u32;
+        // Pre-configure each CmdHeader to point to its slot's command table
+        for (slot, &table) in tables.iter().enumerate().take(num_slots) {
+            core::ptr::write_bytes(table as *mut u8, 0, 4096);
+            let cmd_header = (clb_phys as *mut CmdHeader).add(slot);
+            (*cmd_header).ctba = table as u32;
+            (*cmd_header).ctbau = (table >> 32) as u32;
+        }
 
         // Configure port DMA addresses
         port_write(mmio_base, active_port, PORT_CLB, clb_phys as u32);
@@ -621,28 +907,36 @@ pub fn init_and_register(pci: &PciDevice) {
         // Get PCI interrupt line for IRQ-driven I/O
         let irq = pci.interrupt_line;
 
-        // Store controller state
+        // Store controller state (one slot until IDENTIFY tells us about NCQ)
         AHCI = Some(AhciController {
             mmio_base,
             active_port,
             clb_phys,
             fb_phys,
-            ctba_phys,
             bounce_phys,
             bounce_virt: bounce_phys, // identity-mapped
             total_sectors: 0,
             irq,
+            irq_enabled: false,
+            ncq: false,
+            depth: 1,
+            port: Spinlock::new(PortState { free: 1, issued: 0, draining: false }),
+            slots: core::array::from_fn(|i| CmdSlot {
+                done: AtomicBool::new(false),
+                ok: AtomicBool::new(false),
+                waiter: AtomicU32::new(0),
+                table_phys: tables[i],
+            }),
+            bounce: Mutex::new(()),
         });
 
         // Issue IDENTIFY DEVICE (polled — scheduler not yet running)
-        let identify_ok = issue_command(
+        let identify_ok = issue_exclusive(
             AHCI.as_ref().unwrap(),
             ATA_CMD_IDENTIFY,
             0,  // LBA = 0
             1,  // count = 1
-            bounce_phys,
-            512,
-            false,
+            Some(Segment { addr: bounce_phys, bytes: 512 }),
         );
 
         if identify_ok {
@@ -664,42 +958,66 @@ pub fn init_and_register(pci: &PciDevice) {
                 total_sectors = (*identify.add(60) as u64) | ((*identify.add(61) as u64) << 16);
             }
 
+            // NCQ: word 76 bit 8 = supported, word 75 bits 4:0 = depth - 1
+            let dev_ncq = *identify.add(76) & (1 << 8) != 0;
+            let dev_depth = (*identify.add(75) & 0x1F) as usize + 1;
+            let ncq = dev_ncq && cap & CAP_SNCQ != 0;
+            let depth = if ncq { dev_depth.min(num_slots) } else { 1 };
+
             if let Some(ahci) = AHCI.as_mut() {
                 ahci.total_sectors = total_sectors;
+                ahci.ncq = ncq;
+                ahci.depth = depth;
+                ahci.port.lock().free = slot_mask(depth);
             }
+            QUEUE.configure(depth, MAX_CMD_SECTORS);
 
             let model_str = core::str::from_utf8(&model).unwrap_or("???").trim();
             crate::serial_println!(
-                "  AHCI: '{}', {} sectors ({} MiB)",
+                "  AHCI: '{}', {} sectors ({} MiB), {}",
                 model_str,
                 total_sectors,
-                total_sectors / 2048
+                total_sectors / 2048,
+                if ncq { "NCQ" } else { "no NCQ" }
             );
+            if ncq {
+                crate::serial_println!("  AHCI: NCQ depth {} ({} slots)", depth, num_slots);
+            }
         } else {
             crate::serial_println!("  AHCI: IDENTIFY DEVICE failed");
         }
 
-        // Enable interrupt-driven I/O
-        if irq > 0 && irq < 32 {
+        // Enable interrupt-driven I/O: an MSI vector of its own if the HBA
+        // has the capability, else the (possibly shared) INTx line
+        let msi_irq = crate::drivers::pci::msi_enable(pci, ahci_irq_handler,
+            crate::drivers::pci::IrqAffinity::Spread);
+        if msi_irq.is_some() || (irq > 0 && irq < 32) {
             // Only enable command-completion + error interrupts
             // (NOT PIO Setup / DMA Setup which fire mid-transfer)
-            let port_ie = (1u32 << 0)  // D2H Register FIS Interrupt (command complete)
-                        | (1 << 30)    // Task File Error Status
-                        | (1 << 31);   // Host Bus Fatal Error
+            let port_ie = IS_DHRS   // D2H Register FIS (non-queued command complete)
+                        | IS_SDBS   // Set Device Bits FIS (NCQ commands complete)
+                        | IS_ERRORS;
             port_write(mmio_base, active_port, PORT_IE, port_ie);
+            if let Some(ahci) = AHCI.as_mut() {
+                ahci.irq_enabled = true;
+            }
 
             // Enable HBA global interrupts
             let ghc = mmio_read32(mmio_base, REG_GHC);
             mmio_write32(mmio_base, REG_GHC, ghc | GHC_IE);
 
-            // Register shared IRQ handler (IRQ 11 may be shared with E1000)
-            crate::arch::x86::irq::register_irq_chain(irq, ahci_irq_handler);
-            if crate::arch::x86::apic::is_initialized() {
-                crate::arch::x86::ioapic::unmask_irq(irq);
+            if let Some(vector) = msi_irq {
+                crate::serial_println!("  AHCI: MSI (IRQ {}) registered (interrupt-driven I/O)", vector);
             } else {
-                crate::arch::x86::pic::unmask(irq);
+                // Register shared IRQ handler (IRQ 11 may be shared with E1000)
+                crate::arch::x86::irq::register_irq_chain(irq, ahci_irq_handler);
+                if crate::arch::x86::apic::is_initialized() {
+                    crate::arch::x86::ioapic::unmask_irq(irq);
+                } else {
+                    crate::arch::x86::pic::unmask(irq);
+                }
+                crate::serial_println!("  AHCI: IRQ {} registered (interrupt-driven I/O)", irq);
             }
-            crate::serial_println!("  AHCI: IRQ {} registered (interrupt-driven I/O)", irq);
         } else {
             crate::serial_println!("  AHCI: No valid IRQ ({}), using polled I/O", irq);
         }
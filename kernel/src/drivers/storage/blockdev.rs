@@ -3,8 +3,12 @@
 //! Each block device represents either a whole disk or a single partition.
 //! Partition block devices translate relative LBAs to absolute disk LBAs
 //! and enforce bounds checking.
+//!
+//! Also provides [`RequestQueue`], the elevator used by drivers that can keep
+//! several commands in flight (AHCI NCQ).
 
 use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU8, AtomicUsize, Ordering};
 use crate::serial_println;
 use crate::sync::spinlock::Spinlock;
 
@@ -43,7 +47,7 @@ impl BlockDevice {
                 let f = handler.read_fn;
                 let did = self.disk_id;
                 drop(overrides);
-                return f(did, abs_lba, count, buf);
+                return super::traced_io(did, abs_lba, count, false, || f(did, abs_lba, count, buf));
             }
         }
         super::read_sectors(abs_lba, count, buf)
@@ -68,7 +72,7 @@ impl BlockDevice {
                 let f = handler.write_fn;
                 let did = self.disk_id;
                 drop(overrides);
-                return f(did, abs_lba, count, buf);
+                return super::traced_io(did, abs_lba, count, true, || f(did, abs_lba, count, buf));
             }
         }
         super::write_sectors(abs_lba, count, buf)
@@ -211,3 +215,254 @@ pub fn parse_device_path(path: &str) -> Option<(u8, Option<u8>)> {
         Some((disk_id, None))
     }
 }
+
+// ── Request Queue ───────────────────────────────────────────────────────────
+
+/// Most caller requests merged into one dispatched command.
+pub const MAX_SEGMENTS: usize = 16;
+
+/// One caller buffer of a dispatched command.
+#[derive(Clone, Copy)]
+pub struct Segment {
+    /// Kernel virtual address of the buffer.
+    pub addr: u64,
+    pub bytes: usize,
+}
+
+/// A command handed to the driver: `count` sectors starting at `lba`, whose
+/// data is the concatenation of `segments`.
+pub struct Batch<'a> {
+    pub lba: u64,
+    pub count: u32,
+    pub write: bool,
+    pub segments: &'a [Segment],
+}
+
+const REQ_QUEUED: u8 = 0;
+const REQ_DISPATCHED: u8 = 1;
+const REQ_DONE: u8 = 2;
+
+/// A queued piece of a caller's transfer (lives on the caller's heap until
+/// it is done).
+struct Request {
+    lba: u64,
+    count: u32,
+    addr: u64,
+    write: bool,
+    state: AtomicU8,
+    ok: AtomicBool,
+}
+
+struct QueueState {
+    /// Queued requests, sorted by LBA.
+    pending: Vec<*const Request>,
+    /// Commands handed to the driver and not yet completed.
+    inflight: usize,
+    /// LBA just past the last dispatched command (elevator position).
+    head: u64,
+    /// Threads waiting for a completion.
+    sleepers: Vec<u32>,
+}
+
+// SAFETY: the raw pointers refer to requests whose submitters stay blocked
+// in `submit` until the request is done and removed.
+unsafe impl Send for QueueState {}
+
+/// Elevator request queue for one disk.
+///
+/// Callers queue their transfer (split at the driver's per-command limit)
+/// and then either dispatch work themselves — when fewer than `depth`
+/// commands are in flight — or sleep until a completion.  Whoever
+/// dispatches takes the next request in C-LOOK order (lowest LBA at or past
+/// the last dispatched one, wrapping around) and merges queued requests
+/// that are adjacent in front of or behind it into the same command, so
+/// concurrent sequential readers end up as a few large commands.  The
+/// dispatcher runs the command on its own thread and completes every
+/// request merged into it.
+///
+/// Before the scheduler runs, or with interrupts disabled, requests bypass
+/// the queue.
+pub struct RequestQueue {
+    state: Spinlock<QueueState>,
+    depth: AtomicUsize,
+    max_sectors: AtomicU32,
+}
+
+impl RequestQueue {
+    pub const fn new() -> Self {
+        RequestQueue {
+            state: Spinlock::new(QueueState {
+                pending: Vec::new(),
+                inflight: 0,
+                head: 0,
+                sleepers: Vec::new(),
+            }),
+            depth: AtomicUsize::new(1),
+            max_sectors: AtomicU32::new(256),
+        }
+    }
+
+    /// Set the number of commands the driver runs concurrently and the
+    /// largest command it accepts.
+    pub fn configure(&self, depth: usize, max_sectors: u32) {
+        self.depth.store(depth.max(1), Ordering::Relaxed);
+        self.max_sectors.store(max_sectors.max(1), Ordering::Relaxed);
+    }
+
+    /// Transfer `count` sectors at `lba` to or from the buffer at `addr`,
+    /// running commands through `exec`.  Returns `true` if every part
+    /// succeeded.
+    pub fn submit(
+        &self, lba: u64, count: u32, addr: u64, write: bool, exec: &dyn Fn(&Batch) -> bool,
+    ) -> bool {
+        let max = self.max_sectors.load(Ordering::Relaxed);
+        let tid = crate::task::scheduler::current_tid();
+        if tid == 0 || !crate::arch::hal::interrupts_enabled() {
+            return self.submit_direct(lba, count, addr, write, max, exec);
+        }
+
+        let mut parts = Vec::new();
+        let mut done = 0u32;
+        while done < count {
+            let n = (count - done).min(max);
+            parts.push(Request {
+                lba: lba + done as u64,
+                count: n,
+                addr: addr + done as u64 * 512,
+                write,
+                state: AtomicU8::new(REQ_QUEUED),
+                ok: AtomicBool::new(false),
+            });
+            done += n;
+        }
+        if parts.is_empty() {
+            return true;
+        }
+
+        let mut st = self.state.lock();
+        for r in &parts {
+            let pos = st.pending.partition_point(|&p| unsafe { (*p).lba } <= r.lba);
+            st.pending.insert(pos, r as *const Request);
+        }
+
+        loop {
+            st.sleepers.retain(|&t| t != tid);
+            if parts.iter().all(|r| r.state.load(Ordering::Acquire) == REQ_DONE) {
+                break;
+            }
+            let ours_queued = parts.iter().any(|r| r.state.load(Ordering::Relaxed) == REQ_QUEUED);
+            if ours_queued && st.inflight < self.depth.load(Ordering::Relaxed) {
+                let mut reqs = [core::ptr::null::<Request>(); MAX_SEGMENTS];
+                let n = take_batch(&mut st, max, &mut reqs);
+                st.inflight += 1;
+                drop(st);
+
+                let mut segments = [Segment { addr: 0, bytes: 0 }; MAX_SEGMENTS];
+                for (seg, &r) in segments.iter_mut().zip(&reqs[..n]) {
+                    let r = unsafe { &*r };
+                    *seg = Segment { addr: r.addr, bytes: r.count as usize * 512 };
+                }
+                let first = unsafe { &*reqs[0] };
+                let ok = exec(&Batch {
+                    lba: first.lba,
+                    count: segments[..n].iter().map(|s| (s.bytes / 512) as u32).sum(),
+                    write: first.write,
+                    segments: &segments[..n],
+                });
+
+                st = self.state.lock();
+                st.inflight -= 1;
+                for &r in &reqs[..n] {
+                    let r = unsafe { &*r };
+                    r.ok.store(ok, Ordering::Relaxed);
+                    r.state.store(REQ_DONE, Ordering::Release);
+                }
+                // Owners of merged requests and callers waiting for a free
+                // slot re-check.
+                for t in st.sleepers.drain(..) {
+                    crate::task::scheduler::wake_thread(t);
+                }
+                continue;
+            }
+
+            // Nothing we can dispatch: sleep until a command completes.  A
+            // timeout keeps a lost wake from stalling the queue.
+            st.sleepers.push(tid);
+            let wake_at = crate::arch::hal::timer_current_ticks().wrapping_add(10);
+            crate::task::scheduler::prepare_block_current(Some(wake_at));
+            drop(st);
+            crate::task::scheduler::schedule();
+            st = self.state.lock();
+        }
+        drop(st);
+
+        parts.iter().all(|r| r.ok.load(Ordering::Relaxed))
+    }
+
+    /// Run the transfer on the calling thread, one command per chunk.
+    fn submit_direct(
+        &self, lba: u64, count: u32, addr: u64, write: bool, max: u32, exec: &dyn Fn(&Batch) -> bool,
+    ) -> bool {
+        let mut done = 0u32;
+        while done < count {
+            let n = (count - done).min(max);
+            let seg = [Segment { addr: addr + done as u64 * 512, bytes: n as usize * 512 }];
+            if !exec(&Batch { lba: lba + done as u64, count: n, write, segments: &seg }) {
+                return false;
+            }
+            done += n;
+        }
+        true
+    }
+}
+
+/// Remove the next request in C-LOOK order from `st.pending` together with
+/// adjacent requests it can be merged with.  Fills `out` in LBA order and
+/// returns the count.
+fn take_batch(st: &mut QueueState, max: u32, out: &mut [*const Request; MAX_SEGMENTS]) -> usize {
+    let req = |p: *const Request| unsafe { &*p };
+    let mut idx = st
+        .pending
+        .iter()
+        .position(|&p| req(p).lba >= st.head)
+        .unwrap_or(0);
+    let first = req(st.pending.remove(idx));
+    first.state.store(REQ_DISPATCHED, Ordering::Relaxed);
+    let write = first.write;
+    let (mut start, mut end, mut total) = (first.lba, first.lba + first.count as u64, first.count);
+    out[0] = first;
+    let mut n = 1;
+
+    // Back merges: requests starting where the batch ends.
+    while n < MAX_SEGMENTS && idx < st.pending.len() {
+        let r = req(st.pending[idx]);
+        if r.lba != end || r.write != write || total + r.count > max {
+            break;
+        }
+        st.pending.remove(idx);
+        r.state.store(REQ_DISPATCHED, Ordering::Relaxed);
+        out[n] = r;
+        n += 1;
+        end += r.count as u64;
+        total += r.count;
+    }
+
+    // Front merges: requests ending where the batch starts.
+    while n < MAX_SEGMENTS && idx > 0 {
+        let r = req(st.pending[idx - 1]);
+        if r.lba + r.count as u64 != start || r.write != write || total + r.count > max {
+            break;
+        }
+        idx -= 1;
+        st.pending.remove(idx);
+        r.state.store(REQ_DISPATCHED, Ordering::Relaxed);
+        out.copy_within(0..n, 1);
+        out[0] = r;
+        n += 1;
+        start = r.lba;
+        total += r.count;
+    }
+
+    st.head = end;
+    n
+}
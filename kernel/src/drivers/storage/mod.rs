@@ -3,8 +3,11 @@
 //! Routes read/write requests to the active storage backend (ATA PIO or AHCI DMA).
 //! The backend is selected at boot based on hardware detection.
 //!
-//! All I/O is serialized via `IO_LOCK` — ATA PIO and AHCI both use a single
-//! channel that cannot handle concurrent commands from multiple CPUs.
+//! ATA PIO and LSI SCSI I/O is serialized via `IO_LOCK` — they use a single
+//! channel that cannot handle concurrent commands from multiple CPUs.  NVMe
+//! (per-CPU queues), AHCI (NCQ slots behind a request queue) and virtio-blk
+//! (several requests on one virtqueue) bypass the lock and handle
+//! concurrency themselves.
 
 pub mod ata;
 pub mod ahci;
@@ -12,6 +15,7 @@ pub mod atapi;
 pub mod blockdev;
 pub mod nvme;
 pub mod lsi_scsi;
+pub mod virtio_blk;
 
 use alloc::vec::Vec;
 use core::sync::atomic::{AtomicBool, Ordering};
@@ -59,6 +63,7 @@ enum StorageBackend {
     Ahci,
     Nvme,
     LsiScsi,
+    VirtioBlk,
 }
 
 static mut BACKEND: StorageBackend = StorageBackend::Ata;
@@ -97,11 +102,38 @@ pub fn set_backend_lsi() {
     unsafe { BACKEND = StorageBackend::LsiScsi; }
 }
 
+/// Switch the active storage backend to virtio-blk.
+pub fn set_backend_virtio_blk() {
+    unsafe { BACKEND = StorageBackend::VirtioBlk; }
+}
+
+/// Run one transfer of `count` sectors at `lba` on `disk` between the
+/// block I/O tracepoints.
+pub(crate) fn traced_io(disk: u8, lba: u32, count: u32, write: bool, io: impl FnOnce() -> bool) -> bool {
+    use crate::task::tracepoints::{self, BLOCK_COMPLETE, BLOCK_SUBMIT};
+    let key = (disk as u64) << 56 | lba as u64;
+    let info = count as u64 | (write as u64) << 32;
+    tracepoints::emit(BLOCK_SUBMIT, key, info);
+    let ok = io();
+    tracepoints::emit(BLOCK_COMPLETE, key, info | (!ok as u64) << 33);
+    ok
+}
+
 /// Read `count` sectors starting at `lba` into `buf`.
 ///
 /// Dispatches to the active backend. For ATA, automatically batches into
-/// 255-sector chunks. For AHCI, uses DMA with a bounce buffer.
+/// 255-sector chunks. For AHCI, NVMe and virtio-blk, uses DMA (in place or bounced).
 pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    traced_io(0, lba, count, false, || read_backend(lba, count, buf))
+}
+
+fn read_backend(lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    match unsafe { BACKEND } {
+        StorageBackend::Nvme => return nvme::read_sectors(lba, count, buf),
+        StorageBackend::Ahci => return ahci::read_sectors(lba, count, buf),
+        StorageBackend::VirtioBlk => return virtio_blk::read_sectors(lba, count, buf),
+        _ => {}
+    }
     crate::debug_println!("  [storage] read_sectors: lba={} count={} (acquiring io_lock)", lba, count);
     io_lock_acquire();
     crate::debug_println!("  [storage] read_sectors: io_lock acquired, dispatching");
@@ -126,8 +158,9 @@ pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
             }
             ok
         }
-        StorageBackend::Ahci => ahci::read_sectors(lba, count, buf),
-        StorageBackend::Nvme => nvme::read_sectors(lba, count, buf),
+        StorageBackend::Ahci | StorageBackend::Nvme | StorageBackend::VirtioBlk => {
+            unreachable!() // handled above, without IO_LOCK
+        }
         StorageBackend::LsiScsi => lsi_scsi::read_sectors(lba, count, buf),
 
     };
@@ -139,8 +172,18 @@ pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
 /// Write `count` sectors starting at `lba` from `buf`.
 ///
 /// Dispatches to the active backend. For ATA, automatically batches into
-/// 255-sector chunks. For AHCI, uses DMA with a bounce buffer.
+/// 255-sector chunks. For AHCI, NVMe and virtio-blk, uses DMA (in place or bounced).
 pub fn write_sectors(lba: u32, count: u32, buf: &[u8]) -> bool {
+    traced_io(0, lba, count, true, || write_backend(lba, count, buf))
+}
+
+fn write_backend(lba: u32, count: u32, buf: &[u8]) -> bool {
+    match unsafe { BACKEND } {
+        StorageBackend::Nvme => return nvme::write_sectors(lba, count, buf),
+        StorageBackend::Ahci => return ahci::write_sectors(lba, count, buf),
+        StorageBackend::VirtioBlk => return virtio_blk::write_sectors(lba, count, buf),
+        _ => {}
+    }
     io_lock_acquire();
     let result = match unsafe { BACKEND } {
         StorageBackend::Ata => {
@@ -160,8 +203,9 @@ pub fn write_sectors(lba: u32, count: u32, buf: &[u8]) -> bool {
             }
             ok
         }
-        StorageBackend::Ahci => ahci::write_sectors(lba, count, buf),
-        StorageBackend::Nvme => nvme::write_sectors(lba, count, buf),
+        StorageBackend::Ahci | StorageBackend::Nvme | StorageBackend::VirtioBlk => {
+            unreachable!() // handled above, without IO_LOCK
+        }
         StorageBackend::LsiScsi => lsi_scsi::write_sectors(lba, count, buf),
 
     };
@@ -1,15 +1,35 @@
 //! NVMe (Non-Volatile Memory Express) storage driver.
 //!
-//! Supports NVMe 1.0+ controllers over PCIe. Uses submission/completion queue
-//! pairs for command submission and polled completion.
+//! Supports NVMe 1.0+ controllers over PCIe.  Every CPU gets its own I/O
+//! submission/completion queue pair, so CPUs submit without sharing a queue,
+//! and up to [`MAX_INFLIGHT`] commands are outstanding per queue.  Queue
+//! memory for all granted queues is allocated at probe time; queue 1 (CPU 0)
+//! is created on the device right away, the others by [`enable_cpu_queues`]
+//! once the APs are online.
+//!
+//! Completions are signalled by MSI-X: each I/O queue has its own table
+//! entry and vector ([`pci::MsixTable::bind`]), aimed at the LAPIC of the
+//! queue's CPU, so the handler knows which queue to reap.  The submitting
+//! thread blocks until the handler reaps its command.  Without MSI-X (or a
+//! free vector), or before the scheduler runs, completions are polled.
+//!
+//! Kernel buffers are transferred in place (PRP1/PRP2, or a per-command PRP
+//! list beyond two pages), and a large request is split into several
+//! commands that run concurrently.  Buffers the device cannot safely target
+//! go through a bounce buffer: user-space pointers (a concurrent `munmap`
+//! could free the frames mid-transfer) and non-dword-aligned ones.
 //!
 //! Tested with VirtualBox NVMe (`80EE:4E56`) and QEMU NVMe.
 
 use alloc::boxed::Box;
-use crate::drivers::pci::{PciDevice, pci_config_read32, pci_config_write32};
+use crate::arch::x86::{pit, smp};
+use crate::drivers::pci::{self, IrqAffinity, PciDevice, pci_config_read32, pci_config_write32};
 use crate::memory::address::{PhysAddr, VirtAddr};
 use crate::memory::{virtual_mem, physical};
-use core::sync::atomic::{AtomicBool, Ordering};
+use crate::sync::mutex::Mutex;
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+use core::sync::atomic::{AtomicBool, AtomicU8, AtomicU16, AtomicU32, AtomicUsize, Ordering};
 
 // ── MMIO virtual base ───────────────────────────────
 
@@ -44,6 +64,14 @@ const CSTS_RDY: u32    = 1 << 0;  // Ready
 const ADMIN_IDENTIFY: u8           = 0x06;
 const ADMIN_CREATE_IO_CQ: u8      = 0x05;
 const ADMIN_CREATE_IO_SQ: u8      = 0x01;
+const ADMIN_SET_FEATURES: u8      = 0x09;
+
+// Set Features feature IDs
+const FEAT_NUM_QUEUES: u32 = 0x07;
+
+// Create I/O CQ flags (CDW11)
+const CQ_PHYS_CONTIG: u32 = 1 << 0;
+const CQ_IRQ_ENABLE: u32  = 1 << 1;
 
 // NVM I/O commands
 const NVM_CMD_READ: u8  = 0x02;
@@ -93,30 +121,111 @@ struct NvmeCompletion {
     status: u16,       // Status field (bit 0 = phase tag, bits 1-15 = status)
 }
 
+// ── Queue Sizes and Limits ──────────────────────────
+
+const ADMIN_QUEUE_SIZE: u16 = 16;
+const IO_QUEUE_SIZE: u16 = 64;
+
+/// Upper bound on I/O queue pairs (one per CPU).
+const MAX_IO_QUEUES: usize = smp::MAX_CPUS;
+/// Commands outstanding per I/O queue.  The command ID is the slot index;
+/// staying below `IO_QUEUE_SIZE` means the SQ can never overflow.
+const MAX_INFLIGHT: usize = 32;
+/// Commands a single request keeps in flight before waiting for its oldest.
+const REQUEST_DEPTH: usize = 8;
+/// Largest transfer per command (further limited by the controller's MDTS).
+const MAX_CMD_BYTES: usize = 128 * 1024;
+/// PRP list bytes per slot: 64 entries cover `MAX_CMD_BYTES` at any offset.
+const PRP_LIST_BYTES: usize = 512;
+const PRP_LISTS_PER_PAGE: usize = 4096 / PRP_LIST_BYTES;
+
+// Bounce buffer: 128 KiB (256 sectors of 512 bytes)
+const BOUNCE_SECTORS: u32 = 256;
+const BOUNCE_SIZE: usize = BOUNCE_SECTORS as usize * 512;
+const BOUNCE_PAGES: usize = BOUNCE_SIZE / 4096; // 32 pages
+
+/// Give up on a command after this long (ms).
+const IO_TIMEOUT_MS: u32 = 5000;
+/// Polls before timing out when the tick counter is not running yet.
+const IO_TIMEOUT_POLLS: u32 = 10_000_000;
+/// Polls before a thread that can sleep blocks on its completion.
+const SPIN_POLLS: u32 = 2000;
+/// A blocked waiter re-checks its slot at least this often (ms), in case a
+/// wake from the IRQ handler was dropped.
+const BLOCK_SLICE_MS: u32 = 10;
+
+const PTE_PRESENT: u64  = 1 << 0;
+const PTE_WRITABLE: u64 = 1 << 1;
+const PTE_PHYS_MASK: u64 = 0x000F_FFFF_FFFF_F000;
+/// Start of the kernel half; only buffers above it are DMA'd in place.
+const KERNEL_SPACE: u64 = 0xFFFF_8000_0000_0000;
+
 // ── Controller State ────────────────────────────────
 
+/// Admin queue pair (polled, serialized by `NvmeController::admin`).
+struct AdminQueue {
+    sq_phys: u64,
+    cq_phys: u64,
+    sq_tail: u16,
+    cq_head: u16,
+    phase: bool,
+    next_cmd_id: u16,
+}
+
+/// Completion state of one I/O command slot.
+struct CmdSlot {
+    /// Set by the reaper once the completion entry arrived.
+    done: AtomicBool,
+    /// Status code of the completion (CQE status >> 1).
+    status: AtomicU16,
+    /// TID blocked on this slot (0 = nobody).
+    waiter: AtomicU32,
+    /// Physical address of this slot's PRP list.
+    prp_list: u64,
+}
+
+/// Submission side of an I/O queue.
+struct SqState {
+    tail: u16,
+    /// Bitmap of free command slots.
+    free: u32,
+}
+
+/// Completion side of an I/O queue.
+struct CqState {
+    head: u16,
+    phase: bool,
+}
+
+/// One I/O submission/completion queue pair.
+struct IoQueue {
+    qid: u16,
+    sq_phys: u64,
+    cq_phys: u64,
+    /// CPU that submits here and receives this queue's interrupt.
+    cpu: usize,
+    /// IRQ of this queue's MSI-X vector (0 = completions polled).
+    irq: AtomicU8,
+    sq: Spinlock<SqState>,
+    cq: Spinlock<CqState>,
+    slots: [CmdSlot; MAX_INFLIGHT],
+}
+
 struct NvmeController {
     mmio_base: u64,
     /// Doorbell stride (in bytes). Read from CAP.DSTRD.
     doorbell_stride: u32,
-    /// Admin SQ/CQ physical addresses
-    asq_phys: u64,
-    acq_phys: u64,
-    /// I/O SQ/CQ physical addresses
-    iosq_phys: u64,
-    iocq_phys: u64,
-    /// Bounce buffer for DMA
+    admin: Spinlock<AdminQueue>,
+    /// MSI-X table (None = completions polled).
+    msix: Option<pci::MsixTable>,
+    /// I/O queue pairs allocated in `QUEUES` (what the controller granted).
+    queues_allocated: usize,
+    /// Largest transfer per I/O command in bytes.
+    max_cmd_bytes: usize,
+    /// Bounce buffer for buffers that cannot be DMA'd in place
+    /// (identity-mapped).  The mutex serializes its users.
+    bounce: Mutex<()>,
     bounce_phys: u64,
-    bounce_virt: u64,
-    /// Queue depths
-    admin_sq_tail: u16,
-    admin_cq_head: u16,
-    admin_phase: bool,
-    io_sq_tail: u16,
-    io_cq_head: u16,
-    io_phase: bool,
-    /// Command ID counter
-    next_cmd_id: u16,
     /// Namespace 1 sector count
     ns1_sectors: u64,
     /// Sector size (usually 512)
@@ -126,14 +235,43 @@ struct NvmeController {
 static AVAILABLE: AtomicBool = AtomicBool::new(false);
 static mut CTRL: Option<NvmeController> = None;
 
-// Queue size (entries)
-const ADMIN_QUEUE_SIZE: u16 = 16;
-const IO_QUEUE_SIZE: u16 = 64;
+/// I/O queues, filled at probe time and never modified afterwards.
+static mut QUEUES: [Option<IoQueue>; MAX_IO_QUEUES] = {
+    const NONE: Option<IoQueue> = None;
+    [NONE; MAX_IO_QUEUES]
+};
+/// Queues of `QUEUES` that exist on the device (`QUEUES[..n]`).
+static ACTIVE_QUEUES: AtomicUsize = AtomicUsize::new(0);
 
-// Bounce buffer: 128 KiB (256 sectors of 512 bytes)
-const BOUNCE_SECTORS: u32 = 256;
-const BOUNCE_SIZE: usize = BOUNCE_SECTORS as usize * 512;
-const BOUNCE_PAGES: usize = BOUNCE_SIZE / 4096; // 32 pages
+#[inline]
+fn controller() -> Option<&'static NvmeController> {
+    if !AVAILABLE.load(Ordering::Acquire) {
+        return None;
+    }
+    unsafe { (*core::ptr::addr_of!(CTRL)).as_ref() }
+}
+
+#[inline]
+fn io_queue(idx: usize) -> &'static IoQueue {
+    unsafe {
+        (*core::ptr::addr_of!(QUEUES))[idx]
+            .as_ref()
+            .expect("NVMe: I/O queue not allocated")
+    }
+}
+
+/// The calling CPU's queue (CPUs share when fewer queues were granted).
+#[inline]
+fn queue_for_cpu() -> &'static IoQueue {
+    let n = ACTIVE_QUEUES.load(Ordering::Acquire).max(1);
+    io_queue(smp::current_cpu_id() as usize % n)
+}
+
+/// Whether the caller may yield or block.
+#[inline]
+fn can_sleep() -> bool {
+    scheduler::current_tid() != 0 && crate::arch::hal::interrupts_enabled()
+}
 
 // ── MMIO Helpers ────────────────────────────────────
 
@@ -178,28 +316,38 @@ unsafe fn write_cq_doorbell(ctrl: &NvmeController, qid: u16, head: u16) {
 
 // ── Admin Command Submission ────────────────────────
 
-unsafe fn admin_submit(ctrl: &mut NvmeController, cmd: &NvmeCommand) -> Option<NvmeCompletion> {
+unsafe fn admin_submit(ctrl: &NvmeController, aq: &mut AdminQueue, cmd: &NvmeCommand) -> Option<NvmeCompletion> {
+    let mut cmd = *cmd;
+    cmd.command_id = aq.next_cmd_id;
+    aq.next_cmd_id = aq.next_cmd_id.wrapping_add(1);
+
     // Write command to admin SQ
-    let sq_entry = (ctrl.asq_phys + ctrl.admin_sq_tail as u64 * 64) as *mut NvmeCommand;
+    let sq_entry = (aq.sq_phys + aq.sq_tail as u64 * 64) as *mut NvmeCommand;
     // Use identity-mapped virtual = physical for queue access
-    core::ptr::write_volatile(sq_entry, *cmd);
+    core::ptr::write_volatile(sq_entry, cmd);
 
     // Advance tail
-    ctrl.admin_sq_tail = (ctrl.admin_sq_tail + 1) % ADMIN_QUEUE_SIZE;
-    write_sq_doorbell(ctrl, 0, ctrl.admin_sq_tail);
+    aq.sq_tail = (aq.sq_tail + 1) % ADMIN_QUEUE_SIZE;
+    write_sq_doorbell(ctrl, 0, aq.sq_tail);
 
     // Poll CQ for completion
-    let cq_entry_ptr = (ctrl.acq_phys + ctrl.admin_cq_head as u64 * 16) as *const NvmeCompletion;
+    let cq_entry_ptr = (aq.cq_phys + aq.cq_head as u64 * 16) as *const NvmeCompletion;
     for _ in 0..1_000_000 {
         let cqe = core::ptr::read_volatile(cq_entry_ptr);
         let phase = (cqe.status & 1) != 0;
-        if phase == ctrl.admin_phase {
+        if phase == aq.phase {
             // Advance CQ head
-            ctrl.admin_cq_head = (ctrl.admin_cq_head + 1) % ADMIN_QUEUE_SIZE;
-            if ctrl.admin_cq_head == 0 {
-                ctrl.admin_phase = !ctrl.admin_phase;
+            aq.cq_head = (aq.cq_head + 1) % ADMIN_QUEUE_SIZE;
+            if aq.cq_head == 0 {
+                aq.phase = !aq.phase;
+            }
+            write_cq_doorbell(ctrl, 0, aq.cq_head);
+
+            let sc = (cqe.status >> 1) & 0x7FFF;
+            if sc != 0 {
+                crate::serial_println!("NVMe: admin command {:#04x} failed, status={:#06x}", cmd.opcode, sc);
+                return None;
             }
-            write_cq_doorbell(ctrl, 0, ctrl.admin_cq_head);
             return Some(cqe);
         }
         core::hint::spin_loop();
@@ -208,142 +356,489 @@ unsafe fn admin_submit(ctrl: &mut NvmeController, cmd: &NvmeCommand) -> Option<N
     None
 }
 
-/// Submit an I/O command and wait for completion.
-unsafe fn io_submit(ctrl: &mut NvmeController, cmd: &NvmeCommand) -> Option<NvmeCompletion> {
-    let sq_entry = (ctrl.iosq_phys + ctrl.io_sq_tail as u64 * 64) as *mut NvmeCommand;
-    core::ptr::write_volatile(sq_entry, *cmd);
+impl NvmeController {
+    /// Run one admin command to completion.
+    fn admin_cmd(&self, cmd: &NvmeCommand) -> Option<NvmeCompletion> {
+        let mut aq = self.admin.lock();
+        unsafe { admin_submit(self, &mut aq, cmd) }
+    }
+}
 
-    ctrl.io_sq_tail = (ctrl.io_sq_tail + 1) % IO_QUEUE_SIZE;
-    write_sq_doorbell(ctrl, 1, ctrl.io_sq_tail);
+// ── I/O Queues ──────────────────────────────────────
 
-    let cq_entry_ptr = (ctrl.iocq_phys + ctrl.io_cq_head as u64 * 16) as *const NvmeCompletion;
-    for _ in 0..10_000_000 {
-        let cqe = core::ptr::read_volatile(cq_entry_ptr);
-        let phase = (cqe.status & 1) != 0;
-        if phase == ctrl.io_phase {
-            ctrl.io_cq_head = (ctrl.io_cq_head + 1) % IO_QUEUE_SIZE;
-            if ctrl.io_cq_head == 0 {
-                ctrl.io_phase = !ctrl.io_phase;
-            }
-            write_cq_doorbell(ctrl, 1, ctrl.io_cq_head);
+/// Wake `tid`; from IRQ context without spinning on SCHEDULER.
+#[inline]
+fn wake(tid: u32, in_irq: bool) {
+    if !in_irq {
+        scheduler::wake_thread(tid);
+    } else if !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
 
-            // Check status (bits 1-15, shift right 1)
-            let sc = (cqe.status >> 1) & 0x7FFF;
-            if sc != 0 {
-                crate::serial_println!("NVMe: I/O error, status={:#06x}", sc);
-                return None;
+impl IoQueue {
+    fn try_claim(&self) -> Option<usize> {
+        let mut sq = self.sq.lock();
+        if sq.free == 0 {
+            return None;
+        }
+        let slot = sq.free.trailing_zeros() as usize;
+        sq.free &= !(1 << slot);
+        Some(slot)
+    }
+
+    /// Claim a slot, waiting while all of them are in flight.
+    fn claim(&self, ctrl: &NvmeController) -> usize {
+        loop {
+            if let Some(slot) = self.try_claim() {
+                return slot;
             }
-            return Some(cqe);
+            self.back_off(ctrl);
         }
-        core::hint::spin_loop();
     }
-    crate::serial_println!("NVMe: I/O command timeout");
-    None
-}
 
-// ── Public API ──────────────────────────────────────
+    fn release(&self, slot: usize) {
+        self.sq.lock().free |= 1 << slot;
+    }
 
-/// Read sectors from NVMe namespace 1.
-pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
-    if !AVAILABLE.load(Ordering::Relaxed) {
-        return false;
+    /// Nothing to do until other commands finish: reap, then let them run.
+    fn back_off(&self, ctrl: &NvmeController) {
+        if let Some(mut cq) = self.cq.try_lock() {
+            self.reap(ctrl, &mut cq, false);
+        }
+        if can_sleep() {
+            scheduler::schedule();
+        } else {
+            core::hint::spin_loop();
+        }
+    }
+
+    /// Queue `cmd` under `slot`'s command ID and ring the doorbell.
+    fn submit(&self, ctrl: &NvmeController, slot: usize, mut cmd: NvmeCommand) {
+        cmd.command_id = slot as u16;
+        let s = &self.slots[slot];
+        s.done.store(false, Ordering::Relaxed);
+        s.waiter.store(0, Ordering::Relaxed);
+
+        let mut sq = self.sq.lock();
+        unsafe {
+            let entry = (self.sq_phys + sq.tail as u64 * 64) as *mut NvmeCommand;
+            core::ptr::write_volatile(entry, cmd);
+            sq.tail = (sq.tail + 1) % IO_QUEUE_SIZE;
+            write_sq_doorbell(ctrl, self.qid, sq.tail);
+        }
+    }
+
+    /// Consume all new completion entries: mark their slots done and wake
+    /// the threads waiting on them.  Caller holds `self.cq`.
+    fn reap(&self, ctrl: &NvmeController, cq: &mut CqState, in_irq: bool) {
+        let mut reaped = false;
+        loop {
+            let cqe = unsafe {
+                core::ptr::read_volatile((self.cq_phys + cq.head as u64 * 16) as *const NvmeCompletion)
+            };
+            if ((cqe.status & 1) != 0) != cq.phase {
+                break;
+            }
+            cq.head = (cq.head + 1) % IO_QUEUE_SIZE;
+            if cq.head == 0 {
+                cq.phase = !cq.phase;
+            }
+            reaped = true;
+
+            if let Some(s) = self.slots.get(cqe.command_id as usize) {
+                s.status.store((cqe.status >> 1) & 0x7FFF, Ordering::Relaxed);
+                s.done.store(true, Ordering::Release);
+                let tid = s.waiter.swap(0, Ordering::AcqRel);
+                if tid != 0 {
+                    wake(tid, in_irq);
+                }
+            }
+        }
+        if reaped {
+            unsafe { write_cq_doorbell(ctrl, self.qid, cq.head); }
+        }
     }
 
-    let ctrl = unsafe { CTRL.as_mut().unwrap() };
-    let mut offset = 0usize;
-    let mut remaining = count;
-    let mut cur_lba = lba as u64;
-
-    while remaining > 0 {
-        let batch = remaining.min(BOUNCE_SECTORS);
-        let byte_count = batch as usize * ctrl.sector_size as usize;
-
-        let mut cmd = NvmeCommand::zeroed();
-        cmd.opcode = NVM_CMD_READ;
-        cmd.command_id = ctrl.next_cmd_id;
-        ctrl.next_cmd_id = ctrl.next_cmd_id.wrapping_add(1);
-        cmd.nsid = 1;
-        cmd.prp1 = ctrl.bounce_phys;
-        // PRP2: for transfers > 4 KiB, point to next page
-        if byte_count > 4096 {
-            cmd.prp2 = ctrl.bounce_phys + 4096;
+    /// Wait for the command in `slot` and free the slot.  Returns `false`
+    /// on an error status or timeout.
+    ///
+    /// Threads that can sleep block after a short spin and are woken by the
+    /// MSI-X handler; everyone else polls the CQ.  A timed-out slot is never
+    /// handed out again, since the device may still complete into it.
+    fn wait(&self, ctrl: &NvmeController, slot: usize) -> bool {
+        let s = &self.slots[slot];
+        let tid = scheduler::current_tid();
+        let can_block = self.irq.load(Ordering::Relaxed) != 0 && can_sleep();
+        let start = pit::get_ticks();
+        let mut polls = 0u32;
+
+        while !s.done.load(Ordering::Acquire) {
+            if polls >= IO_TIMEOUT_POLLS || pit::get_ticks().wrapping_sub(start) > IO_TIMEOUT_MS {
+                crate::serial_println!("NVMe: I/O command timeout (queue {}, slot {})", self.qid, slot);
+                return false;
+            }
+            if can_block && polls >= SPIN_POLLS {
+                // Publish the waiter under the CQ lock: the IRQ handler
+                // reaps under the same lock, so it either ran before (and
+                // `done` is visible here) or will see our TID.
+                let mut cq = self.cq.lock();
+                self.reap(ctrl, &mut cq, false);
+                if s.done.load(Ordering::Acquire) {
+                    break;
+                }
+                s.waiter.store(tid, Ordering::Release);
+                scheduler::prepare_block_current(Some(pit::get_ticks().wrapping_add(BLOCK_SLICE_MS)));
+                drop(cq);
+                scheduler::schedule();
+                s.waiter.store(0, Ordering::Relaxed);
+            } else {
+                if let Some(mut cq) = self.cq.try_lock() {
+                    self.reap(ctrl, &mut cq, false);
+                }
+                polls += 1;
+                core::hint::spin_loop();
+            }
         }
-        cmd.cdw10 = cur_lba as u32;         // Starting LBA (low 32)
-        cmd.cdw11 = (cur_lba >> 32) as u32; // Starting LBA (high 32)
-        cmd.cdw12 = batch - 1;              // Number of logical blocks (0-based)
 
-        let ok = unsafe { io_submit(ctrl, &cmd).is_some() };
-        if !ok {
+        let status = s.status.load(Ordering::Relaxed);
+        self.release(slot);
+        if status != 0 {
+            crate::serial_println!("NVMe: I/O error, status={:#06x}", status);
             return false;
         }
+        true
+    }
+}
 
-        // Copy from bounce buffer to caller's buffer
-        let src = ctrl.bounce_virt as *const u8;
-        let end = (offset + byte_count).min(buf.len());
-        let copy_len = end - offset;
-        unsafe {
-            core::ptr::copy_nonoverlapping(src, buf[offset..].as_mut_ptr(), copy_len);
+/// MSI-X completion interrupt: reap the queue that owns vector `irq`.
+fn nvme_irq_handler(irq: u8) {
+    let ctrl = match controller() {
+        Some(c) => c,
+        None => return,
+    };
+    for i in 0..ACTIVE_QUEUES.load(Ordering::Acquire) {
+        let q = io_queue(i);
+        if q.irq.load(Ordering::Relaxed) == irq {
+            let mut cq = q.cq.lock();
+            q.reap(ctrl, &mut cq, true);
+            return;
         }
+    }
+}
 
-        offset += byte_count;
-        cur_lba += batch as u64;
-        remaining -= batch;
+// ── DMA Addressing ──────────────────────────────────
+
+/// Device address of `va`, if mapped (and writable when the device writes
+/// to memory).
+#[inline]
+fn dma_addr(va: u64, to_memory: bool) -> Option<u64> {
+    let pte = virtual_mem::read_pte(VirtAddr::new(va & !0xFFF));
+    if pte & PTE_PRESENT == 0 || (to_memory && pte & PTE_WRITABLE == 0) {
+        return None;
     }
+    Some((pte & PTE_PHYS_MASK) | (va & 0xFFF))
+}
 
+/// Whether `[va, va + len)` can be handed to the device as is.
+///
+/// Touches every page first so demand-paged heap pages are present when
+/// their PTEs are read.
+fn dma_capable(va: u64, len: usize, to_memory: bool) -> bool {
+    if va < KERNEL_SPACE || va & 3 != 0 {
+        return false;
+    }
+    let end = va + len as u64;
+    let mut page = va & !0xFFF;
+    while page < end {
+        let p = page.max(va) as *mut u8;
+        unsafe {
+            let v = core::ptr::read_volatile(p);
+            if to_memory {
+                core::ptr::write_volatile(p, v);
+            }
+        }
+        if dma_addr(page, to_memory).is_none() {
+            return false;
+        }
+        page += 4096;
+    }
     true
 }
 
-/// Write sectors to NVMe namespace 1.
-pub fn write_sectors(lba: u32, count: u32, buf: &[u8]) -> bool {
-    if !AVAILABLE.load(Ordering::Relaxed) {
-        return false;
+/// Build PRP1/PRP2 for `len` bytes at `va`, using `prp_list` (one slot's
+/// list) when the range spans more than two pages.
+fn build_prps(va: u64, len: usize, prp_list: u64, to_memory: bool) -> Option<(u64, u64)> {
+    let prp1 = dma_addr(va, to_memory)?;
+    let first = 4096 - (va & 0xFFF) as usize;
+    if len <= first {
+        return Some((prp1, 0));
+    }
+    let mut page = (va & !0xFFF) + 4096;
+    if len <= first + 4096 {
+        return Some((prp1, dma_addr(page, to_memory)?));
+    }
+    let end = va + len as u64;
+    let list = prp_list as *mut u64;
+    let mut i = 0;
+    while page < end {
+        unsafe { list.add(i).write_volatile(dma_addr(page, to_memory)?); }
+        i += 1;
+        page += 4096;
     }
+    Some((prp1, prp_list))
+}
 
-    let ctrl = unsafe { CTRL.as_mut().unwrap() };
-    let mut offset = 0usize;
-    let mut remaining = count;
-    let mut cur_lba = lba as u64;
+fn rw_command(write: bool, lba: u64, sectors: u32, prps: (u64, u64)) -> NvmeCommand {
+    let mut cmd = NvmeCommand::zeroed();
+    cmd.opcode = if write { NVM_CMD_WRITE } else { NVM_CMD_READ };
+    cmd.nsid = 1;
+    cmd.prp1 = prps.0;
+    cmd.prp2 = prps.1;
+    cmd.cdw10 = lba as u32;         // Starting LBA (low 32)
+    cmd.cdw11 = (lba >> 32) as u32; // Starting LBA (high 32)
+    cmd.cdw12 = sectors - 1;        // Number of logical blocks (0-based)
+    cmd
+}
 
-    while remaining > 0 {
-        let batch = remaining.min(BOUNCE_SECTORS);
-        let byte_count = batch as usize * ctrl.sector_size as usize;
+// ── Transfers ───────────────────────────────────────
 
-        // Copy data to bounce buffer
-        let dst = ctrl.bounce_virt as *mut u8;
-        let end = (offset + byte_count).min(buf.len());
-        let copy_len = end - offset;
-        unsafe {
-            core::ptr::copy_nonoverlapping(buf[offset..].as_ptr(), dst, copy_len);
+/// Transfer `count` sectors between the device and the `len` bytes at `addr`.
+fn transfer(lba: u64, count: u32, addr: u64, len: usize, write: bool) -> bool {
+    let ctrl = match controller() {
+        Some(c) => c,
+        None => return false,
+    };
+    let bytes = count as usize * ctrl.sector_size as usize;
+    if bytes == 0 {
+        return true;
+    }
+    let q = queue_for_cpu();
+    if len >= bytes && dma_capable(addr, bytes, !write) {
+        transfer_direct(ctrl, q, lba, count, addr, write)
+    } else {
+        transfer_bounce(ctrl, q, lba, count, addr, len, write)
+    }
+}
+
+/// DMA straight to/from the caller's buffer, up to [`REQUEST_DEPTH`]
+/// commands at a time.
+fn transfer_direct(ctrl: &NvmeController, q: &IoQueue, lba: u64, count: u32, addr: u64, write: bool) -> bool {
+    let ss = ctrl.sector_size as usize;
+    let per_cmd = (ctrl.max_cmd_bytes / ss).max(1) as u32;
+    let mut pending = [0usize; REQUEST_DEPTH];
+    let (mut head, mut inflight) = (0usize, 0usize);
+    let mut ok = true;
+    let mut done = 0u32;
+
+    while done < count && ok {
+        if inflight == REQUEST_DEPTH {
+            ok &= q.wait(ctrl, pending[head]);
+            head = (head + 1) % REQUEST_DEPTH;
+            inflight -= 1;
+            continue;
         }
+        let slot = match q.try_claim() {
+            Some(s) => s,
+            None if inflight > 0 => {
+                // Retire our own oldest command rather than wait on others
+                // (several requests each holding slots would deadlock).
+                ok &= q.wait(ctrl, pending[head]);
+                head = (head + 1) % REQUEST_DEPTH;
+                inflight -= 1;
+                continue;
+            }
+            None => {
+                q.back_off(ctrl);
+                continue;
+            }
+        };
+
+        let batch = (count - done).min(per_cmd);
+        let va = addr + done as u64 * ss as u64;
+        let prps = match build_prps(va, batch as usize * ss, q.slots[slot].prp_list, !write) {
+            Some(p) => p,
+            None => {
+                q.release(slot);
+                ok = false;
+                break;
+            }
+        };
+        q.submit(ctrl, slot, rw_command(write, lba + done as u64, batch, prps));
+        pending[(head + inflight) % REQUEST_DEPTH] = slot;
+        inflight += 1;
+        done += batch;
+    }
 
-        let mut cmd = NvmeCommand::zeroed();
-        cmd.opcode = NVM_CMD_WRITE;
-        cmd.command_id = ctrl.next_cmd_id;
-        ctrl.next_cmd_id = ctrl.next_cmd_id.wrapping_add(1);
-        cmd.nsid = 1;
-        cmd.prp1 = ctrl.bounce_phys;
-        if byte_count > 4096 {
-            cmd.prp2 = ctrl.bounce_phys + 4096;
+    // The device may still be writing into the buffer: always drain.
+    while inflight > 0 {
+        ok &= q.wait(ctrl, pending[head]);
+        head = (head + 1) % REQUEST_DEPTH;
+        inflight -= 1;
+    }
+    ok
+}
+
+/// Copy through the bounce buffer, one command at a time.
+fn transfer_bounce(
+    ctrl: &NvmeController, q: &IoQueue, lba: u64, count: u32, addr: u64, len: usize, write: bool,
+) -> bool {
+    let _bounce = ctrl.bounce.lock();
+    let ss = ctrl.sector_size as usize;
+    let per_cmd = (BOUNCE_SIZE.min(ctrl.max_cmd_bytes) / ss).max(1) as u32;
+    let mut done = 0u32;
+
+    while done < count {
+        let batch = (count - done).min(per_cmd);
+        let offset = done as usize * ss;
+        let byte_count = batch as usize * ss;
+        let copy_len = (offset + byte_count).min(len).saturating_sub(offset);
+
+        if write && copy_len > 0 {
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    (addr + offset as u64) as *const u8, ctrl.bounce_phys as *mut u8, copy_len,
+                );
+            }
         }
-        cmd.cdw10 = cur_lba as u32;
-        cmd.cdw11 = (cur_lba >> 32) as u32;
-        cmd.cdw12 = batch - 1;
 
-        let ok = unsafe { io_submit(ctrl, &cmd).is_some() };
-        if !ok {
+        let slot = q.claim(ctrl);
+        let prps = match build_prps(ctrl.bounce_phys, byte_count, q.slots[slot].prp_list, !write) {
+            Some(p) => p,
+            None => {
+                q.release(slot);
+                return false;
+            }
+        };
+        q.submit(ctrl, slot, rw_command(write, lba + done as u64, batch, prps));
+        if !q.wait(ctrl, slot) {
             return false;
         }
 
-        offset += byte_count;
-        cur_lba += batch as u64;
-        remaining -= batch;
+        if !write && copy_len > 0 {
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    ctrl.bounce_phys as *const u8, (addr + offset as u64) as *mut u8, copy_len,
+                );
+            }
+        }
+        done += batch;
     }
-
     true
 }
 
+// ── Public API ──────────────────────────────────────
+
+/// Read sectors from NVMe namespace 1.
+///
+/// Safe to call from several CPUs at once; the storage layer does not
+/// serialize NVMe requests.
+pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    transfer(lba as u64, count, buf.as_mut_ptr() as u64, buf.len(), false)
+}
+
+/// Write sectors to NVMe namespace 1.
+pub fn write_sectors(lba: u32, count: u32, buf: &[u8]) -> bool {
+    transfer(lba as u64, count, buf.as_ptr() as u64, buf.len(), true)
+}
+
+/// Create the I/O queues of the application processors.
+///
+/// Called once after `smp::start_aps`; before that only CPU 0's queue
+/// exists and every CPU submits there.
+pub fn enable_cpu_queues() {
+    let ctrl = match controller() {
+        Some(c) => c,
+        None => return,
+    };
+    let want = (smp::cpu_count() as usize).clamp(1, ctrl.queues_allocated);
+    let mut active = ACTIVE_QUEUES.load(Ordering::Acquire);
+    while active < want {
+        if !create_io_queue(ctrl, active) {
+            break;
+        }
+        active += 1;
+        ACTIVE_QUEUES.store(active, Ordering::Release);
+    }
+    crate::serial_println!(
+        "[OK] NVMe: {} I/O queue pair(s), {} completions",
+        active,
+        if ctrl.msix.is_some() { "MSI-X" } else { "polled" },
+    );
+}
+
 // ── Init ────────────────────────────────────────────
 
+/// Allocate and zero an identity-mapped page.
+fn alloc_queue_page() -> Option<u64> {
+    let phys = physical::alloc_frame()?.as_u64();
+    virtual_mem::map_page(VirtAddr::new(phys), PhysAddr::new(phys), 0x03);
+    unsafe { core::ptr::write_bytes(phys as *mut u8, 0, 4096); }
+    Some(phys)
+}
+
+/// Allocate the memory of I/O queue `idx` (QID `idx + 1`, serving CPU `idx`).
+fn alloc_io_queue(idx: usize) -> Option<IoQueue> {
+    let sq_phys = alloc_queue_page()?;
+    let cq_phys = alloc_queue_page()?;
+    let mut prp_pages = [0u64; MAX_INFLIGHT / PRP_LISTS_PER_PAGE];
+    for page in prp_pages.iter_mut() {
+        *page = alloc_queue_page()?;
+    }
+    Some(IoQueue {
+        qid: idx as u16 + 1,
+        sq_phys,
+        cq_phys,
+        cpu: idx,
+        irq: AtomicU8::new(0),
+        sq: Spinlock::new(SqState { tail: 0, free: u32::MAX >> (32 - MAX_INFLIGHT) }),
+        cq: Spinlock::new(CqState { head: 0, phase: true }),
+        slots: core::array::from_fn(|i| CmdSlot {
+            done: AtomicBool::new(false),
+            status: AtomicU16::new(0),
+            waiter: AtomicU32::new(0),
+            prp_list: prp_pages[i / PRP_LISTS_PER_PAGE]
+                + ((i % PRP_LISTS_PER_PAGE) * PRP_LIST_BYTES) as u64,
+        }),
+    })
+}
+
+/// Create I/O queue `idx` on the device.
+fn create_io_queue(ctrl: &NvmeController, idx: usize) -> bool {
+    let q = io_queue(idx);
+
+    let mut cq_flags = CQ_PHYS_CONTIG;
+    if let Some(msix) = ctrl.msix.as_ref() {
+        // Interrupt vector N = MSI-X entry N = QID (entry 0 is the admin
+        // CQ's), each with a CPU vector of its own.
+        if let Some(irq) = msix.bind(q.qid, nvme_irq_handler, IrqAffinity::Cpu(q.cpu)) {
+            q.irq.store(irq, Ordering::Release);
+            cq_flags |= CQ_IRQ_ENABLE | (q.qid as u32) << 16;
+        }
+    }
+
+    let mut cmd = NvmeCommand::zeroed();
+    cmd.opcode = ADMIN_CREATE_IO_CQ;
+    cmd.prp1 = q.cq_phys;
+    cmd.cdw10 = ((IO_QUEUE_SIZE - 1) as u32) << 16 | q.qid as u32; // QID, Size
+    cmd.cdw11 = cq_flags;
+    if ctrl.admin_cmd(&cmd).is_none() {
+        crate::serial_println!("  NVMe: Create I/O CQ {} failed", q.qid);
+        return false;
+    }
+
+    let mut cmd = NvmeCommand::zeroed();
+    cmd.opcode = ADMIN_CREATE_IO_SQ;
+    cmd.prp1 = q.sq_phys;
+    cmd.cdw10 = ((IO_QUEUE_SIZE - 1) as u32) << 16 | q.qid as u32; // QID, Size
+    cmd.cdw11 = (q.qid as u32) << 16 | 1; // CQID = QID, Physically contiguous
+    if ctrl.admin_cmd(&cmd).is_none() {
+        crate::serial_println!("  NVMe: Create I/O SQ {} failed", q.qid);
+        return false;
+    }
+    true
+}
+
 /// Initialize NVMe controller from PCI probe. Called by HAL.
 pub fn init_and_register(pci: &PciDevice) {
     // BAR0 = MMIO registers
@@ -393,32 +888,19 @@ pub fn init_and_register(pci: &PciDevice) {
         }
     }
 
-    // Allocate queues (identity-mapped, low memory)
-    // Admin SQ: ADMIN_QUEUE_SIZE * 64 bytes (1 page)
-    let asq_phys = match physical::alloc_frame() {
-        Some(p) => p.as_u64(),
-        None => { crate::serial_println!("  NVMe: alloc ASQ failed"); return; }
-    };
-    // Admin CQ: ADMIN_QUEUE_SIZE * 16 bytes (1 page)
-    let acq_phys = match physical::alloc_frame() {
-        Some(p) => p.as_u64(),
-        None => { crate::serial_println!("  NVMe: alloc ACQ failed"); return; }
+    // Allocate admin queues (identity-mapped, low memory)
+    let (asq_phys, acq_phys) = match (alloc_queue_page(), alloc_queue_page()) {
+        (Some(sq), Some(cq)) => (sq, cq),
+        _ => { crate::serial_println!("  NVMe: alloc admin queues failed"); return; }
     };
 
-    // Identity-map queue pages
-    for &phys in &[asq_phys, acq_phys] {
-        virtual_mem::map_page(VirtAddr::new(phys), PhysAddr::new(phys), 0x03);
+    // MSI-X if available; otherwise mask all interrupts (polled mode).
+    // INTMS must not be touched once MSI-X is enabled.
+    let msix = pci::msix_enable(pci);
+    if msix.is_none() {
+        unsafe { mmio_write32(base, REG_INTMS, 0xFFFF_FFFF); }
     }
 
-    // Zero queues
-    unsafe {
-        core::ptr::write_bytes(asq_phys as *mut u8, 0, 4096);
-        core::ptr::write_bytes(acq_phys as *mut u8, 0, 4096);
-    }
-
-    // Mask all interrupts (we use polled mode)
-    unsafe { mmio_write32(base, REG_INTMS, 0xFFFF_FFFF); }
-
     // Configure admin queues
     let aqa = ((ADMIN_QUEUE_SIZE - 1) as u32) << 16 | (ADMIN_QUEUE_SIZE - 1) as u32;
     unsafe {
@@ -444,23 +926,6 @@ pub fn init_and_register(pci: &PciDevice) {
     }
     crate::serial_println!("  NVMe: controller enabled and ready");
 
-    // Allocate I/O queues
-    let iosq_phys = match physical::alloc_frame() {
-        Some(p) => p.as_u64(),
-        None => { crate::serial_println!("  NVMe: alloc IOSQ failed"); return; }
-    };
-    let iocq_phys = match physical::alloc_frame() {
-        Some(p) => p.as_u64(),
-        None => { crate::serial_println!("  NVMe: alloc IOCQ failed"); return; }
-    };
-    for &phys in &[iosq_phys, iocq_phys] {
-        virtual_mem::map_page(VirtAddr::new(phys), PhysAddr::new(phys), 0x03);
-    }
-    unsafe {
-        core::ptr::write_bytes(iosq_phys as *mut u8, 0, 4096);
-        core::ptr::write_bytes(iocq_phys as *mut u8, 0, 4096);
-    }
-
     // Allocate bounce buffer (identity-mapped)
     let bounce_phys = match physical::alloc_contiguous(BOUNCE_PAGES) {
         Some(p) => p.as_u64(),
@@ -474,39 +939,35 @@ pub fn init_and_register(pci: &PciDevice) {
     let mut ctrl = NvmeController {
         mmio_base: base,
         doorbell_stride: dstrd as u32,
-        asq_phys,
-        acq_phys,
-        iosq_phys,
-        iocq_phys,
+        admin: Spinlock::new(AdminQueue {
+            sq_phys: asq_phys,
+            cq_phys: acq_phys,
+            sq_tail: 0,
+            cq_head: 0,
+            phase: true,
+            next_cmd_id: 1,
+        }),
+        msix,
+        queues_allocated: 0,
+        max_cmd_bytes: MAX_CMD_BYTES,
+        bounce: Mutex::new(()),
         bounce_phys,
-        bounce_virt: bounce_phys, // identity-mapped
-        admin_sq_tail: 0,
-        admin_cq_head: 0,
-        admin_phase: true,
-        io_sq_tail: 0,
-        io_cq_head: 0,
-        io_phase: true,
-        next_cmd_id: 1,
         ns1_sectors: 0,
         sector_size: 512,
     };
 
     // Identify Controller (admin command)
-    let identify_phys = match physical::alloc_frame() {
-        Some(p) => p.as_u64(),
+    let identify_phys = match alloc_queue_page() {
+        Some(p) => p,
         None => { crate::serial_println!("  NVMe: alloc identify failed"); return; }
     };
-    virtual_mem::map_page(VirtAddr::new(identify_phys), PhysAddr::new(identify_phys), 0x03);
-    unsafe { core::ptr::write_bytes(identify_phys as *mut u8, 0, 4096); }
 
     let mut cmd = NvmeCommand::zeroed();
     cmd.opcode = ADMIN_IDENTIFY;
-    cmd.command_id = ctrl.next_cmd_id;
-    ctrl.next_cmd_id += 1;
     cmd.prp1 = identify_phys;
     cmd.cdw10 = 1; // CNS=1 → Identify Controller
 
-    if unsafe { admin_submit(&mut ctrl, &cmd) }.is_none() {
+    if ctrl.admin_cmd(&cmd).is_none() {
         crate::serial_println!("  NVMe: Identify Controller failed");
         return;
     }
@@ -523,17 +984,21 @@ pub fn init_and_register(pci: &PciDevice) {
     };
     crate::serial_println!("  NVMe: Controller: {}", model);
 
+    // Maximum Data Transfer Size (byte 77): 2^MDTS pages, 0 = unlimited
+    let mdts = unsafe { *((identify_phys + 77) as *const u8) };
+    if mdts != 0 && mdts < 20 {
+        ctrl.max_cmd_bytes = ctrl.max_cmd_bytes.min(4096usize << mdts);
+    }
+
     // Identify Namespace 1 (CNS=0, NSID=1)
     unsafe { core::ptr::write_bytes(identify_phys as *mut u8, 0, 4096); }
     let mut cmd = NvmeCommand::zeroed();
     cmd.opcode = ADMIN_IDENTIFY;
-    cmd.command_id = ctrl.next_cmd_id;
-    ctrl.next_cmd_id += 1;
     cmd.nsid = 1;
     cmd.prp1 = identify_phys;
     cmd.cdw10 = 0; // CNS=0 → Identify Namespace
 
-    if unsafe { admin_submit(&mut ctrl, &cmd) }.is_none() {
+    if ctrl.admin_cmd(&cmd).is_none() {
         crate::serial_println!("  NVMe: Identify Namespace 1 failed");
         return;
     }
@@ -556,35 +1021,42 @@ pub fn init_and_register(pci: &PciDevice) {
         nsze, sector_size, size_mb
     );
 
-    // Create I/O Completion Queue (QID=1)
+    // Number of Queues: ask for one pair per possible CPU; the completion
+    // carries how many the controller granted (0-based).
     let mut cmd = NvmeCommand::zeroed();
-    cmd.opcode = ADMIN_CREATE_IO_CQ;
-    cmd.command_id = ctrl.next_cmd_id;
-    ctrl.next_cmd_id += 1;
-    cmd.prp1 = iocq_phys;
-    cmd.cdw10 = ((IO_QUEUE_SIZE - 1) as u32) << 16 | 1; // QID=1, Size
-    cmd.cdw11 = 1; // Physically contiguous
-
-    if unsafe { admin_submit(&mut ctrl, &cmd) }.is_none() {
-        crate::serial_println!("  NVMe: Create I/O CQ failed");
-        return;
+    cmd.opcode = ADMIN_SET_FEATURES;
+    cmd.cdw10 = FEAT_NUM_QUEUES;
+    cmd.cdw11 = ((MAX_IO_QUEUES - 1) << 16 | (MAX_IO_QUEUES - 1)) as u32;
+    let mut granted = match ctrl.admin_cmd(&cmd) {
+        Some(cqe) => ((cqe.result & 0xFFFF).min(cqe.result >> 16) as usize + 1).min(MAX_IO_QUEUES),
+        None => 1,
+    };
+    if let Some(msix) = msix {
+        // Entry 0 belongs to the admin queue
+        granted = granted.min(msix.entries() as usize - 1).max(1);
     }
 
-    // Create I/O Submission Queue (QID=1, linked to CQ 1)
-    let mut cmd = NvmeCommand::zeroed();
-    cmd.opcode = ADMIN_CREATE_IO_SQ;
-    cmd.command_id = ctrl.next_cmd_id;
-    ctrl.next_cmd_id += 1;
-    cmd.prp1 = iosq_phys;
-    cmd.cdw10 = ((IO_QUEUE_SIZE - 1) as u32) << 16 | 1; // QID=1, Size
-    cmd.cdw11 = (1 << 16) | 1; // CQID=1, Physically contiguous
-
-    if unsafe { admin_submit(&mut ctrl, &cmd) }.is_none() {
-        crate::serial_println!("  NVMe: Create I/O SQ failed");
+    // Allocate queue memory now, while identity-mapped low frames are easy
+    // to come by; APs' queues are created on the device later.
+    for idx in 0..granted {
+        match alloc_io_queue(idx) {
+            Some(q) => unsafe { (*core::ptr::addr_of_mut!(QUEUES))[idx] = Some(q); },
+            None if idx > 0 => break,
+            None => { crate::serial_println!("  NVMe: alloc I/O queue failed"); return; }
+        }
+        ctrl.queues_allocated = idx + 1;
+    }
+
+    if !create_io_queue(&ctrl, 0) {
         return;
     }
+    ACTIVE_QUEUES.store(1, Ordering::Release);
 
-    crate::serial_println!("[OK] NVMe: I/O queues created (SQ={}, CQ={})", IO_QUEUE_SIZE, IO_QUEUE_SIZE);
+    crate::serial_println!(
+        "[OK] NVMe: I/O queue 1 created (SQ={}, CQ={}, {} granted, MSI-X {}, max {} KiB/cmd)",
+        IO_QUEUE_SIZE, IO_QUEUE_SIZE, ctrl.queues_allocated,
+        if ctrl.msix.is_some() { "on" } else { "off" }, ctrl.max_cmd_bytes / 1024,
+    );
 
     // Store controller and switch backend
     unsafe { CTRL = Some(ctrl); }
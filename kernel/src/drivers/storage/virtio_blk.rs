@@ -0,0 +1,738 @@
+//! VirtIO block device driver (PCI modern transport).
+//!
+//! Drives the request queue of a virtio-blk device (`1AF4:1042`, or the
+//! transitional `1AF4:1001` when it exposes the modern capabilities).  Up to
+//! [`MAX_INFLIGHT`] requests are outstanding at once.  Each request owns a
+//! slot frame holding its header, its status byte and, with
+//! `VIRTIO_RING_F_INDIRECT_DESC`, an indirect descriptor table, so a request
+//! costs one ring descriptor however many pages its buffer spans.
+//!
+//! Completions arrive on the PCI INTx line.  With `VIRTIO_RING_F_EVENT_IDX`
+//! the device is only notified when it asks for it (`avail_event`), and
+//! interrupts are only requested while a thread is blocked on a request;
+//! spinning waiters and early boot poll the used ring instead.
+//!
+//! Kernel buffers are transferred in place, split into one descriptor per
+//! physically contiguous run; user-space pointers go through a bounce buffer
+//! (a concurrent `munmap` could free the frames mid-transfer).
+//!
+//! Tested with QEMU `-device virtio-blk-pci`.
+
+use alloc::boxed::Box;
+use crate::arch::x86::pit;
+use crate::drivers::pci::PciDevice;
+use crate::drivers::virtio::{self, VirtioDevice, virtqueue::VirtQueue};
+use crate::memory::address::VirtAddr;
+use crate::memory::{virtual_mem, physical};
+use crate::sync::mutex::Mutex;
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+
+// ── Feature Bits ────────────────────────────────────
+
+const VIRTIO_BLK_F_SIZE_MAX: u64 = 1 << 1;
+const VIRTIO_BLK_F_SEG_MAX: u64 = 1 << 2;
+const VIRTIO_BLK_F_RO: u64 = 1 << 5;
+const VIRTIO_RING_F_INDIRECT_DESC: u64 = 1 << 28;
+const VIRTIO_RING_F_EVENT_IDX: u64 = 1 << 29;
+
+// ── Device Config Offsets ───────────────────────────
+
+const CFG_CAPACITY: u64 = 0x00; // u64, in 512-byte sectors
+const CFG_SIZE_MAX: u64 = 0x08; // u32, max bytes per segment
+const CFG_SEG_MAX: u64 = 0x0C;  // u32, max segments per request
+
+// ── Request Types / Status ──────────────────────────
+
+const VIRTIO_BLK_T_IN: u32 = 0;
+const VIRTIO_BLK_T_OUT: u32 = 1;
+const VIRTIO_BLK_S_OK: u8 = 0;
+
+/// Request header (device-readable, 16 bytes).
+#[repr(C)]
+struct BlkReqHeader {
+    type_: u32,
+    reserved: u32,
+    sector: u64,
+}
+
+// ── Limits ──────────────────────────────────────────
+
+/// Request slots (bitmap in a u32).
+const MAX_INFLIGHT: usize = 32;
+/// Requests one transfer keeps in flight.
+const REQUEST_DEPTH: usize = 8;
+/// Largest request in sectors (128 KiB).
+const MAX_CMD_SECTORS: u32 = 256;
+/// Data segments per request: one per page of an unaligned 128 KiB buffer.
+const MAX_SEGMENTS: usize = MAX_CMD_SECTORS as usize * 512 / 4096 + 1;
+/// Descriptors per request besides the data: header and status.
+const EXTRA_DESCS: usize = 2;
+/// Ring size assumed when mapping ring heads back to slots.
+const MAX_QUEUE_SIZE: usize = 128;
+/// Marks a ring head that belongs to no slot.
+const NO_SLOT: u8 = 0xFF;
+
+/// Slot frame layout: header, status byte, indirect table.
+const SLOT_STATUS: u64 = 16;
+const SLOT_TABLE: u64 = 64;
+
+const BOUNCE_SECTORS: u32 = MAX_CMD_SECTORS;
+const BOUNCE_SIZE: usize = BOUNCE_SECTORS as usize * 512;
+const BOUNCE_PAGES: usize = BOUNCE_SIZE / 4096;
+
+/// Timeout for a single request (milliseconds).
+const IO_TIMEOUT_MS: u32 = 5000;
+/// Poll bound for when the PIT is not ticking yet (early boot).
+const IO_TIMEOUT_POLLS: u32 = 10_000_000;
+/// Polls before a waiter that can sleep blocks.
+const SPIN_POLLS: u32 = 2000;
+/// Longest single block before re-checking (covers a lost interrupt).
+const BLOCK_SLICE_MS: u32 = 10;
+
+const PTE_PRESENT: u64  = 1 << 0;
+const PTE_WRITABLE: u64 = 1 << 1;
+const PTE_PHYS_MASK: u64 = 0x000F_FFFF_FFFF_F000;
+
+const KERNEL_SPACE: u64 = 0xFFFF_8000_0000_0000;
+
+// ── Driver State ────────────────────────────────────
+
+/// Completion state of one request slot.
+struct Slot {
+    /// Set by the reaper once the device returned the request.
+    done: AtomicBool,
+    /// TID blocked on this slot (0 = nobody).
+    waiter: AtomicU32,
+    /// Physical address of the slot frame (identity-mapped).
+    page: u64,
+}
+
+/// Ring state, serialized by `VirtioBlk::ring`.
+struct RingState {
+    vq: VirtQueue,
+    /// Bitmap of free request slots.
+    free: u32,
+    /// Slot that owns each in-flight ring head (`NO_SLOT` = none).
+    owner: [u8; MAX_QUEUE_SIZE],
+    /// Threads blocked waiting for a completion interrupt.
+    sleepers: u32,
+}
+
+struct VirtioBlk {
+    dev: VirtioDevice,
+    /// Notification address of the request queue.
+    notify_addr: u64,
+    ring: Spinlock<RingState>,
+    slots: [Slot; MAX_INFLIGHT],
+    /// Requests go through per-slot indirect tables.
+    indirect: bool,
+    /// Completion interrupt is registered (otherwise all waits poll).
+    irq_enabled: bool,
+    /// Data descriptors allowed per request.
+    max_segments: usize,
+    /// Largest single data descriptor in bytes.
+    max_segment_bytes: u32,
+    /// Device capacity in 512-byte sectors.
+    capacity: u64,
+    /// Bounce buffer for user-space buffers (identity-mapped).  The mutex
+    /// serializes its users.
+    bounce: Mutex<()>,
+    bounce_phys: u64,
+}
+
+static AVAILABLE: AtomicBool = AtomicBool::new(false);
+static mut BLK: Option<VirtioBlk> = None;
+
+#[inline]
+fn device() -> Option<&'static VirtioBlk> {
+    if !AVAILABLE.load(Ordering::Acquire) {
+        return None;
+    }
+    unsafe { (*core::ptr::addr_of!(BLK)).as_ref() }
+}
+
+/// Whether the caller may yield or block.
+#[inline]
+fn can_sleep() -> bool {
+    scheduler::current_tid() != 0 && crate::arch::hal::interrupts_enabled()
+}
+
+/// Wake `tid`; from IRQ context without spinning on SCHEDULER.
+#[inline]
+fn wake(tid: u32, in_irq: bool) {
+    if !in_irq {
+        scheduler::wake_thread(tid);
+    } else if !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
+
+// ── Request Slots ───────────────────────────────────
+
+impl VirtioBlk {
+    fn try_claim(&self) -> Option<usize> {
+        let mut ring = self.ring.lock();
+        if ring.free == 0 {
+            return None;
+        }
+        let slot = ring.free.trailing_zeros() as usize;
+        ring.free &= !(1 << slot);
+        Some(slot)
+    }
+
+    /// Claim a slot, waiting while all of them are in flight.
+    fn claim(&self) -> usize {
+        loop {
+            if let Some(slot) = self.try_claim() {
+                return slot;
+            }
+            self.back_off();
+        }
+    }
+
+    fn release(&self, slot: usize) {
+        self.ring.lock().free |= 1 << slot;
+    }
+
+    /// Nothing to do until other requests finish: reap, then let them run.
+    fn back_off(&self) {
+        if let Some(mut ring) = self.ring.try_lock() {
+            self.reap(&mut ring, false);
+        }
+        if can_sleep() {
+            scheduler::schedule();
+        } else {
+            core::hint::spin_loop();
+        }
+    }
+
+    /// Queue a request for `slot` and notify the device if it wants to be.
+    ///
+    /// `segs` are the data buffers as (physical address, length).  Without
+    /// indirect descriptors the ring may be short of descriptors, in which
+    /// case this backs off until in-flight requests return theirs.
+    fn submit(&self, slot: usize, write: bool, sector: u64, segs: &[(u64, u32)]) {
+        let s = &self.slots[slot];
+        s.done.store(false, Ordering::Relaxed);
+        s.waiter.store(0, Ordering::Relaxed);
+        unsafe {
+            (s.page as *mut BlkReqHeader).write_volatile(BlkReqHeader {
+                type_: if write { VIRTIO_BLK_T_OUT } else { VIRTIO_BLK_T_IN },
+                reserved: 0,
+                sector,
+            });
+            ((s.page + SLOT_STATUS) as *mut u8).write_volatile(0xFF);
+        }
+
+        // Header first, status last; data is device-readable for writes.
+        let header = (s.page, core::mem::size_of::<BlkReqHeader>() as u32);
+        let status = (s.page + SLOT_STATUS, 1u32);
+        let mut readable = [(0u64, 0u32); MAX_SEGMENTS + 1];
+        let mut writable = [(0u64, 0u32); MAX_SEGMENTS + 1];
+        readable[0] = header;
+        let (nr, nw) = if write {
+            readable[1..=segs.len()].copy_from_slice(segs);
+            writable[0] = status;
+            (segs.len() + 1, 1)
+        } else {
+            writable[..segs.len()].copy_from_slice(segs);
+            writable[segs.len()] = status;
+            (1, segs.len() + 1)
+        };
+
+        loop {
+            let mut ring = self.ring.lock();
+            let head = if self.indirect {
+                ring.vq.push_indirect(s.page + SLOT_TABLE, &readable[..nr], &writable[..nw])
+            } else {
+                ring.vq.push(&readable[..nr], &writable[..nw])
+            };
+            if let Some(head) = head {
+                ring.owner[head as usize] = slot as u8;
+                if ring.vq.kick_needed() {
+                    virtio::mmio_write16(self.notify_addr, 0);
+                }
+                return;
+            }
+            drop(ring);
+            self.back_off();
+        }
+    }
+
+    /// Consume all used buffers: mark their slots done and wake the threads
+    /// waiting on them.  Leaves the completion interrupt armed exactly when
+    /// some thread is still blocked.  Caller holds `self.ring`.
+    fn reap(&self, ring: &mut RingState, in_irq: bool) {
+        loop {
+            while let Some((head, _len)) = ring.vq.poll_used() {
+                let owner = match ring.owner.get_mut(head as usize) {
+                    Some(o) => o,
+                    None => continue,
+                };
+                let slot = core::mem::replace(owner, NO_SLOT);
+                if let Some(s) = self.slots.get(slot as usize) {
+                    s.done.store(true, Ordering::Release);
+                    let tid = s.waiter.swap(0, Ordering::AcqRel);
+                    if tid != 0 {
+                        ring.sleepers -= 1;
+                        wake(tid, in_irq);
+                    }
+                }
+            }
+            if ring.sleepers == 0 {
+                ring.vq.disable_interrupts();
+                return;
+            }
+            if ring.vq.enable_interrupts() {
+                return;
+            }
+            // Buffers were used while arming: consume them first.
+        }
+    }
+
+    /// Wait for the request in `slot` and free the slot.  Returns `false`
+    /// on an error status or timeout.
+    ///
+    /// Threads that can sleep block after a short spin and are woken by the
+    /// interrupt handler; everyone else polls the used ring.  A timed-out
+    /// slot is never handed out again, since the device may still complete
+    /// into it.
+    fn wait(&self, slot: usize) -> bool {
+        let s = &self.slots[slot];
+        let tid = scheduler::current_tid();
+        let can_block = self.irq_enabled && can_sleep();
+        let start = pit::get_ticks();
+        let mut polls = 0u32;
+
+        while !s.done.load(Ordering::Acquire) {
+            if polls >= IO_TIMEOUT_POLLS || pit::get_ticks().wrapping_sub(start) > IO_TIMEOUT_MS {
+                crate::serial_println!("virtio-blk: request timeout (slot {})", slot);
+                return false;
+            }
+            if can_block && polls >= SPIN_POLLS {
+                // Publish the waiter under the ring lock: the IRQ handler
+                // reaps under the same lock, so it either ran before (and
+                // `done` is visible here) or will see our TID.
+                let mut ring = self.ring.lock();
+                s.waiter.store(tid, Ordering::Release);
+                ring.sleepers += 1;
+                self.reap(&mut ring, false);
+                if s.done.load(Ordering::Acquire) {
+                    break;
+                }
+                scheduler::prepare_block_current(Some(pit::get_ticks().wrapping_add(BLOCK_SLICE_MS)));
+                drop(ring);
+                scheduler::schedule();
+
+                // Woken by the reaper, or by the block timeout.
+                let mut ring = self.ring.lock();
+                if s.waiter.swap(0, Ordering::AcqRel) != 0 {
+                    ring.sleepers -= 1;
+                }
+            } else {
+                if let Some(mut ring) = self.ring.try_lock() {
+                    self.reap(&mut ring, false);
+                }
+                polls += 1;
+                core::hint::spin_loop();
+            }
+        }
+
+        let status = unsafe { ((s.page + SLOT_STATUS) as *const u8).read_volatile() };
+        self.release(slot);
+        if status != VIRTIO_BLK_S_OK {
+            crate::serial_println!("virtio-blk: I/O error, status={}", status);
+            return false;
+        }
+        true
+    }
+}
+
+/// INTx handler (possibly shared): reading the ISR acknowledges the device.
+fn virtio_blk_irq_handler(_irq: u8) {
+    let blk = match device() {
+        Some(b) => b,
+        None => return,
+    };
+    let isr = virtio::mmio_read8(blk.dev.isr_addr);
+    if isr & 1 == 0 {
+        return; // Not ours (or a config change)
+    }
+    let mut ring = blk.ring.lock();
+    blk.reap(&mut ring, true);
+}
+
+// ── DMA Addressing ──────────────────────────────────
+
+/// Device address of `va`, if mapped (and writable when the device writes
+/// to memory).
+#[inline]
+fn dma_addr(va: u64, to_memory: bool) -> Option<u64> {
+    let pte = virtual_mem::read_pte(VirtAddr::new(va & !0xFFF));
+    if pte & PTE_PRESENT == 0 || (to_memory && pte & PTE_WRITABLE == 0) {
+        return None;
+    }
+    Some((pte & PTE_PHYS_MASK) | (va & 0xFFF))
+}
+
+/// Whether `[va, va + len)` can be handed to the device as is.
+///
+/// Touches every page first so demand-paged heap pages are present when
+/// their PTEs are read.
+fn dma_capable(va: u64, len: usize, to_memory: bool) -> bool {
+    if va < KERNEL_SPACE {
+        return false;
+    }
+    let end = va + len as u64;
+    let mut page = va & !0xFFF;
+    while page < end {
+        let p = page.max(va) as *mut u8;
+        unsafe {
+            let v = core::ptr::read_volatile(p);
+            if to_memory {
+                core::ptr::write_volatile(p, v);
+            }
+        }
+        if dma_addr(page, to_memory).is_none() {
+            return false;
+        }
+        page += 4096;
+    }
+    true
+}
+
+/// Split `len` bytes at `va` into physically contiguous segments of at most
+/// `max_bytes`.  Returns the number written to `out`, or `None` if a page is
+/// unmapped or the buffer needs more than `out.len()` segments.
+fn build_segments(va: u64, len: usize, to_memory: bool, max_bytes: u32, out: &mut [(u64, u32)]) -> Option<usize> {
+    let mut n = 0usize;
+    let mut off = 0usize;
+    while off < len {
+        let cur = va + off as u64;
+        let chunk = (4096 - (cur & 0xFFF) as usize).min(len - off);
+        let phys = dma_addr(cur, to_memory)?;
+        match out[..n].last_mut() {
+            Some(last) if last.0 + last.1 as u64 == phys && last.1 as usize + chunk <= max_bytes as usize => {
+                last.1 += chunk as u32;
+            }
+            _ => {
+                *out.get_mut(n)? = (phys, chunk as u32);
+                n += 1;
+            }
+        }
+        off += chunk;
+    }
+    Some(n)
+}
+
+// ── Transfers ───────────────────────────────────────
+
+/// Transfer `count` sectors between the device and the `len` bytes at `addr`.
+fn transfer(lba: u64, count: u32, addr: u64, len: usize, write: bool) -> bool {
+    let blk = match device() {
+        Some(b) => b,
+        None => return false,
+    };
+    let bytes = count as usize * 512;
+    if bytes == 0 {
+        return true;
+    }
+    if lba + count as u64 > blk.capacity {
+        crate::serial_println!("virtio-blk: LBA {} + {} beyond capacity {}", lba, count, blk.capacity);
+        return false;
+    }
+    if len >= bytes && dma_capable(addr, bytes, !write) {
+        transfer_direct(blk, lba, count, addr, write)
+    } else {
+        transfer_bounce(blk, lba, count, addr, len, write)
+    }
+}
+
+/// DMA straight to/from the caller's buffer, up to [`REQUEST_DEPTH`]
+/// requests at a time.
+fn transfer_direct(blk: &VirtioBlk, lba: u64, count: u32, addr: u64, write: bool) -> bool {
+    let mut pending = [0usize; REQUEST_DEPTH];
+    let (mut head, mut inflight) = (0usize, 0usize);
+    let mut ok = true;
+    let mut done = 0u32;
+    let mut segs = [(0u64, 0u32); MAX_SEGMENTS];
+
+    while done < count && ok {
+        if inflight == REQUEST_DEPTH {
+            ok &= blk.wait(pending[head]);
+            head = (head + 1) % REQUEST_DEPTH;
+            inflight -= 1;
+            continue;
+        }
+        let slot = match blk.try_claim() {
+            Some(s) => s,
+            None if inflight > 0 => {
+                // Retire our own oldest request rather than wait on others
+                // (several transfers each holding slots would deadlock).
+                ok &= blk.wait(pending[head]);
+                head = (head + 1) % REQUEST_DEPTH;
+                inflight -= 1;
+                continue;
+            }
+            None => {
+                blk.back_off();
+                continue;
+            }
+        };
+
+        // Shorten the request until its buffer fits the segment limit
+        // (only physically scattered buffers on a small `seg_max`).
+        let mut batch = (count - done).min(MAX_CMD_SECTORS);
+        let va = addr + done as u64 * 512;
+        let n = loop {
+            let limit = &mut segs[..blk.max_segments];
+            match build_segments(va, batch as usize * 512, !write, blk.max_segment_bytes, limit) {
+                Some(n) => break Some(n),
+                None if batch > 1 => batch /= 2,
+                None => break None,
+            }
+        };
+        let n = match n {
+            Some(n) => n,
+            None => {
+                blk.release(slot);
+                ok = false;
+                break;
+            }
+        };
+        blk.submit(slot, write, lba + done as u64, &segs[..n]);
+        pending[(head + inflight) % REQUEST_DEPTH] = slot;
+        inflight += 1;
+        done += batch;
+    }
+
+    // The device may still be writing into the buffer: always drain.
+    while inflight > 0 {
+        ok &= blk.wait(pending[head]);
+        head = (head + 1) % REQUEST_DEPTH;
+        inflight -= 1;
+    }
+    ok
+}
+
+/// Copy through the bounce buffer, one request at a time.
+fn transfer_bounce(blk: &VirtioBlk, lba: u64, count: u32, addr: u64, len: usize, write: bool) -> bool {
+    let _bounce = blk.bounce.lock();
+    let mut done = 0u32;
+
+    while done < count {
+        let batch = (count - done).min(BOUNCE_SECTORS);
+        let offset = done as usize * 512;
+        let byte_count = batch as usize * 512;
+        let copy_len = (offset + byte_count).min(len).saturating_sub(offset);
+
+        if write && copy_len > 0 {
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    (addr + offset as u64) as *const u8, blk.bounce_phys as *mut u8, copy_len,
+                );
+            }
+        }
+
+        // The bounce buffer is physically contiguous: split only at size_max.
+        let mut segs = [(0u64, 0u32); MAX_SEGMENTS];
+        let mut n = 0usize;
+        let mut off = 0usize;
+        while off < byte_count {
+            let chunk = (byte_count - off).min(blk.max_segment_bytes as usize);
+            segs[n] = (blk.bounce_phys + off as u64, chunk as u32);
+            n += 1;
+            off += chunk;
+        }
+
+        let slot = blk.claim();
+        blk.submit(slot, write, lba + done as u64, &segs[..n]);
+        if !blk.wait(slot) {
+            return false;
+        }
+
+        if !write && copy_len > 0 {
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    blk.bounce_phys as *const u8, (addr + offset as u64) as *mut u8, copy_len,
+                );
+            }
+        }
+        done += batch;
+    }
+    true
+}
+
+// ── Public API ──────────────────────────────────────
+
+/// Read sectors from the virtio-blk device.
+///
+/// Safe to call from several CPUs at once; the storage layer does not
+/// serialize virtio-blk requests.
+pub fn read_sectors(lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    transfer(lba as u64, count, buf.as_mut_ptr() as u64, buf.len(), false)
+}
+
+/// Write sectors to the virtio-blk device.
+pub fn write_sectors(lba: u32, count: u32, buf: &[u8]) -> bool {
+    transfer(lba as u64, count, buf.as_ptr() as u64, buf.len(), true)
+}
+
+// ── Initialization ──────────────────────────────────
+
+/// Initialize a virtio-blk device and make it the active storage backend.
+/// Returns `false` if the device cannot be used.
+pub fn init_and_register(pci: &PciDevice) -> bool {
+    crate::serial_println!("  virtio-blk: probing {:02x}:{:02x}.{}", pci.bus, pci.device, pci.function);
+
+    let caps = match virtio::find_capabilities(pci) {
+        Some(c) => c,
+        None => {
+            crate::serial_println!("  virtio-blk: no modern PCI capabilities (legacy-only device), skipping");
+            return false;
+        }
+    };
+    let dev = VirtioDevice::new(pci, &caps);
+    if dev.device_cfg == 0 {
+        crate::serial_println!("  virtio-blk: no device configuration structure");
+        return false;
+    }
+
+    let wanted = virtio::VIRTIO_F_VERSION_1 | VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX
+        | VIRTIO_BLK_F_RO | VIRTIO_RING_F_INDIRECT_DESC | VIRTIO_RING_F_EVENT_IDX;
+    let features = match dev.init_device(wanted) {
+        Ok(f) => f,
+        Err(e) => {
+            crate::serial_println!("  virtio-blk: init failed: {}", e);
+            return false;
+        }
+    };
+
+    let cfg = dev.device_cfg;
+    let capacity = virtio::mmio_read32(cfg + CFG_CAPACITY) as u64
+        | (virtio::mmio_read32(cfg + CFG_CAPACITY + 4) as u64) << 32;
+    let indirect = features & VIRTIO_RING_F_INDIRECT_DESC != 0;
+    let event_idx = features & VIRTIO_RING_F_EVENT_IDX != 0;
+
+    let mut vq = match dev.setup_queue(0) {
+        Some(q) => q,
+        None => {
+            dev.write_device_status(virtio::STATUS_FAILED);
+            return false;
+        }
+    };
+    vq.set_event_idx(event_idx);
+    let queue_size = vq.num_free() as usize;
+
+    // Data descriptors per request: our own limit, the device's seg_max,
+    // and, without indirect tables, what fits the ring.
+    let mut max_segments = MAX_SEGMENTS;
+    if features & VIRTIO_BLK_F_SEG_MAX != 0 {
+        let seg_max = virtio::mmio_read32(cfg + CFG_SEG_MAX) as usize;
+        if seg_max > 0 {
+            max_segments = max_segments.min(seg_max);
+        }
+    }
+    if !indirect {
+        max_segments = max_segments.min(queue_size.saturating_sub(EXTRA_DESCS));
+    }
+    let mut max_segment_bytes = u32::MAX;
+    if features & VIRTIO_BLK_F_SIZE_MAX != 0 {
+        let size_max = virtio::mmio_read32(cfg + CFG_SIZE_MAX);
+        if size_max >= 4096 {
+            max_segment_bytes = size_max;
+        }
+    }
+    if max_segments == 0 || (max_segment_bytes as usize) * max_segments < BOUNCE_SIZE {
+        crate::serial_println!("  virtio-blk: request limits too small (seg_max={}, size_max={})",
+            max_segments, max_segment_bytes);
+        dev.write_device_status(virtio::STATUS_FAILED);
+        return false;
+    }
+
+    // Request slot frames and bounce buffer (identity-mapped).
+    const NO_SLOT_PAGE: Slot = Slot { done: AtomicBool::new(false), waiter: AtomicU32::new(0), page: 0 };
+    let mut slots = [NO_SLOT_PAGE; MAX_INFLIGHT];
+    for s in slots.iter_mut() {
+        s.page = match physical::alloc_frame() {
+            Some(f) => f.as_u64(),
+            None => {
+                crate::serial_println!("  virtio-blk: failed to allocate request slots");
+                dev.write_device_status(virtio::STATUS_FAILED);
+                return false;
+            }
+        };
+        unsafe { core::ptr::write_bytes(s.page as *mut u8, 0, 4096); }
+    }
+    let bounce_phys = match physical::alloc_contiguous(BOUNCE_PAGES) {
+        Some(f) => f.as_u64(),
+        None => {
+            crate::serial_println!("  virtio-blk: failed to allocate bounce buffer ({} frames)", BOUNCE_PAGES);
+            dev.write_device_status(virtio::STATUS_FAILED);
+            return false;
+        }
+    };
+
+    dev.select_queue(0);
+    let notify_addr = dev.notify_base + dev.read_queue_notify_off() as u64 * dev.notify_off_mul as u64;
+
+    let irq = pci.interrupt_line;
+    let irq_enabled = irq > 0 && irq < 32;
+    unsafe {
+        BLK = Some(VirtioBlk {
+            dev,
+            notify_addr,
+            ring: Spinlock::new(RingState {
+                vq,
+                free: u32::MAX,
+                owner: [NO_SLOT; MAX_QUEUE_SIZE],
+                sleepers: 0,
+            }),
+            slots,
+            indirect,
+            irq_enabled,
+            max_segments,
+            max_segment_bytes,
+            capacity,
+            bounce: Mutex::new(()),
+            bounce_phys,
+        });
+    }
+    let blk = unsafe { (*core::ptr::addr_of!(BLK)).as_ref().unwrap() };
+    blk.dev.set_driver_ok();
+    AVAILABLE.store(true, Ordering::Release);
+
+    if irq_enabled {
+        // Shared with whatever else sits on this INTx line.
+        crate::arch::x86::irq::register_irq_chain(irq, virtio_blk_irq_handler);
+        if crate::arch::x86::apic::is_initialized() {
+            crate::arch::x86::ioapic::unmask_irq(irq);
+        } else {
+            crate::arch::x86::pic::unmask(irq);
+        }
+        crate::serial_println!("  virtio-blk: IRQ {} registered (interrupt-driven I/O)", irq);
+    } else {
+        crate::serial_println!("  virtio-blk: No valid IRQ ({}), using polled I/O", irq);
+    }
+
+    crate::serial_println!(
+        "  virtio-blk: {} sectors ({} MiB){}, indirect={} event_idx={} seg_max={}",
+        capacity, capacity / 2048,
+        if features & VIRTIO_BLK_F_RO != 0 { " read-only" } else { "" },
+        indirect, event_idx, max_segments
+    );
+
+    super::set_backend_virtio_blk();
+    crate::serial_println!("[OK] virtio-blk initialized");
+    true
+}
+
+/// Probe: initialize the virtio-blk device and return a HAL driver.
+pub fn probe(pci: &PciDevice) -> Option<Box<dyn crate::drivers::hal::Driver>> {
+    if !init_and_register(pci) {
+        return None;
+    }
+    super::create_hal_driver("VirtIO Block Device")
+}
@@ -146,14 +146,26 @@ pub fn probe(dev: &UsbDevice, iface: &UsbInterface) {
         }
     };
 
-    // 3. Find the companion Data Interface (class 0x0A)
-    let data_iface = match dev.interfaces.iter().find(|i| i.class == 0x0A) {
+    // 3. Find the companion Data Interface (class 0x0A). Its endpoints are
+    // usually on alternate setting 1 (alt 0 has none while idle).
+    let data_iface = match dev.interfaces.iter()
+        .filter(|i| i.class == 0x0A)
+        .max_by_key(|i| i.endpoints.len())
+    {
         Some(di) => di,
         None => {
             crate::serial_println!("  CDC-ECM: no Data Interface (class 0x0A) found");
             return;
         }
     };
+    if data_iface.alt != 0 {
+        if let Err(e) = super::host(dev.controller).set_interface(
+            dev.address, dev.speed, dev.max_packet_size, data_iface,
+        ) {
+            crate::serial_println!("  CDC-ECM: SET_INTERFACE failed: {}", e);
+            return;
+        }
+    }
 
     // 4. Find bulk IN and bulk OUT endpoints on the Data Interface
     let bulk_in = data_iface.endpoints.iter().find(|ep| {
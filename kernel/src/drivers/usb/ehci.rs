@@ -3,12 +3,20 @@
 //! MMIO-based controller. Uses BAR0 for register access.
 //! Supports high-speed (480 Mbps) devices. Ports that fail high-speed
 //! handshake are released to companion controllers (UHCI/OHCI).
+//!
+//! Control transfers run one at a time on the async head QH and are polled.
+//! Bulk transfers are queued per endpoint and completed by interrupt (see
+//! "Bulk Queues").
 
 use crate::arch::x86::pit::delay_ms;
 use crate::drivers::pci::{PciDevice, pci_config_read32, pci_config_write32};
 use crate::memory::address::PhysAddr;
 use crate::memory::physical;
 use crate::memory::virtual_mem;
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+use alloc::vec::Vec;
+use core::sync::atomic::Ordering;
 use super::*;
 
 // ── EHCI MMIO Virtual Address ──────────────────
@@ -42,6 +50,7 @@ const OP_PORTSC_BASE: u32 = 0x44;
 const CMD_RUN: u32 = 1 << 0;
 const CMD_HCRESET: u32 = 1 << 1;
 const CMD_ASYNC_ENABLE: u32 = 1 << 5;
+const CMD_IAAD: u32 = 1 << 6; // Interrupt on Async Advance Doorbell
 const CMD_PERIODIC_ENABLE: u32 = 1 << 4;
 const CMD_ITC_8: u32 = 8 << 16; // Interrupt threshold = 8 microframes
 
@@ -65,6 +74,10 @@ const PORTSC_PO: u32 = 1 << 13;    // Port Owner (1=companion)
 
 // QH/qTD link pointer bits
 const QH_TYPE_QH: u32 = 1 << 1;
+
+// QH characteristics bits
+const QH_HEAD: u32 = 1 << 15; // Head of Reclamation List
+const QH_DTC: u32 = 1 << 14;  // Data Toggle Control (toggle from qTD)
 const LP_T: u32 = 1;  // Terminate
 
 // qTD token bits
@@ -74,6 +87,7 @@ const QTD_PID_OUT: u32 = 0 << 8;
 const QTD_PID_IN: u32 = 1 << 8;
 const QTD_PID_SETUP: u32 = 2 << 8;
 const QTD_ERR_MASK: u32 = 0x7C; // bits 6-2: error flags
+const QTD_HALTED: u32 = 1 << 6;
 const QTD_DT: u32 = 1 << 31;    // Data Toggle
 
 // ── DMA Structures ─────────────────────────────
@@ -115,8 +129,7 @@ struct EhciController {
     port_connected: [bool; EHCI_MAX_PORTS], // per-port connection state
 }
 
-static EHCI_CTRL: crate::sync::spinlock::Spinlock<Option<EhciController>> =
-    crate::sync::spinlock::Spinlock::new(None);
+static EHCI_CTRL: Spinlock<Option<EhciController>> = Spinlock::new(None);
 
 fn mmio_read32(base: u64, offset: u32) -> u32 {
     unsafe { core::ptr::read_volatile((base + offset as u64) as *const u32) }
@@ -134,7 +147,7 @@ fn mmio_read8(base: u64, offset: u32) -> u8 {
 
 fn make_qh_chars(dev_addr: u8, endpoint: u8, speed: UsbSpeed, max_packet: u16) -> u32 {
     let eps = match speed {
-        UsbSpeed::High => 2u32,
+        UsbSpeed::High | UsbSpeed::Super => 2u32, // no SuperSpeed on EHCI
         UsbSpeed::Full => 0u32,
         UsbSpeed::Low => 1u32,
     };
@@ -334,162 +347,543 @@ fn read_transfer_data(ctrl: &EhciController, buf: &mut [u8], len: usize) {
     }
 }
 
-// ── Bulk Transfer ──────────────────────────────
+// ── Bulk Queues ────────────────────────────────
+//
+// Every bulk endpoint gets a QH of its own in the async schedule, with a
+// ring of qTDs in the same page. The ring is linked in a circle and the
+// qTD at `tail` is always inactive, so the controller stops there; a new
+// transfer is written behind it and its first qTD activated last. Several
+// transfers can be queued on an endpoint, and on different endpoints at
+// once. The last qTD of a transfer interrupts on completion; the IRQ
+// handler reaps finished transfers and wakes their waiters (polled during
+// boot or without an IRQ line).
+//
+// The QH keeps the data toggle (DTC=0). A caller's toggle is loaded into
+// it when the endpoint is idle and written back when it goes idle again.
+
+/// qTDs per endpoint ring (one is always the inactive tail).
+const RING_TDS: usize = 64;
+/// Offset of the qTD ring in the endpoint page (after the 64-byte QH).
+const RING_OFFSET: u64 = 64;
+/// Transfers in flight on all endpoints together.
+const MAX_TRANSFERS: usize = 32;
+/// Give up on a bulk transfer after this long (ms).
+const BULK_TIMEOUT_MS: u32 = 5000;
+/// Polls before timing out when the tick counter is not running yet.
+const BULK_TIMEOUT_POLLS: u32 = 10_000_000;
+/// Polls before a thread that can sleep blocks on its transfer.
+const SPIN_POLLS: u32 = 2_000;
+/// A blocked waiter re-checks its transfer at least this often (ms).
+const BLOCK_SLICE_MS: u32 = 10;
+/// Polls for the async advance doorbell before unlinking anyway.
+const ASYNC_ADVANCE_POLLS: u32 = 100_000;
+
+#[derive(Clone, Copy, PartialEq)]
+enum SlotState {
+    Free,
+    Busy,
+    Done,
+}
+
+/// A bulk transfer, from submit until its waiter collects the result.
+#[derive(Clone, Copy)]
+struct XferSlot {
+    state: SlotState,
+    dev_addr: u8,
+    endpoint: u8,
+    /// First qTD in the endpoint ring, and the number of qTDs.
+    first: usize,
+    count: usize,
+    result: Result<usize, &'static str>,
+    /// TID blocked on this transfer (0 = nobody).
+    waiter: u32,
+}
+
+const FREE_SLOT: XferSlot = XferSlot {
+    state: SlotState::Free,
+    dev_addr: 0,
+    endpoint: 0,
+    first: 0,
+    count: 0,
+    result: Ok(0),
+    waiter: 0,
+};
+
+/// QH and qTD ring of one bulk endpoint.
+struct EndpointQueue {
+    dev_addr: u8,
+    /// Endpoint address (bit 7 = IN).
+    endpoint: u8,
+    /// Page holding the QH and the ring.
+    page_phys: u64,
+    /// Oldest qTD in flight.
+    head: usize,
+    /// Next free qTD (always inactive).
+    tail: usize,
+    /// Bytes each qTD was queued with.
+    lens: [u32; RING_TDS],
+    /// Slots of the transfers in flight, oldest first.
+    inflight: Vec<usize>,
+}
+
+impl EndpointQueue {
+    fn qh(&self) -> *mut EhciQh {
+        self.page_phys as *mut EhciQh
+    }
+
+    fn qtd_phys(&self, i: usize) -> u64 {
+        self.page_phys + RING_OFFSET + (i % RING_TDS) as u64 * 32
+    }
+
+    fn qtd(&self, i: usize) -> *mut EhciQtd {
+        self.qtd_phys(i) as *mut EhciQtd
+    }
+
+    fn used(&self) -> usize {
+        (self.tail + RING_TDS - self.head) % RING_TDS
+    }
 
-/// Execute a bulk transfer on a non-zero endpoint.
+    /// Empty the ring and point the QH overlay at its start. Only while the
+    /// controller does not execute the QH (halted, or not linked).
+    fn reset_ring(&mut self) {
+        unsafe {
+            for i in 0..RING_TDS {
+                let qtd = self.qtd(i);
+                core::ptr::write_bytes(qtd, 0, 1);
+                (*qtd).next_qtd = self.qtd_phys(i + 1) as u32;
+                (*qtd).alt_next_qtd = LP_T;
+            }
+            let qh = self.qh();
+            core::ptr::write_volatile(&mut (*qh).current_qtd, 0);
+            core::ptr::write_volatile(&mut (*qh).next_qtd, self.qtd_phys(0) as u32);
+            core::ptr::write_volatile(&mut (*qh).alt_next_qtd, LP_T);
+            core::ptr::write_volatile(&mut (*qh).token, 0);
+        }
+        self.head = 0;
+        self.tail = 0;
+    }
+}
+
+struct BulkState {
+    /// Operational registers (0 until the controller runs).
+    op_base: u64,
+    async_qh_phys: u64,
+    /// Completions are signalled by the IRQ handler.
+    irq_enabled: bool,
+    queues: Vec<EndpointQueue>,
+    slots: [XferSlot; MAX_TRANSFERS],
+}
+
+/// Bulk endpoint queues, shared by submitters, waiters and the IRQ handler.
+/// Separate from `EHCI_CTRL`, which port polling holds across enumeration.
+static BULK: Spinlock<BulkState> = Spinlock::new(BulkState {
+    op_base: 0,
+    async_qh_phys: 0,
+    irq_enabled: false,
+    queues: Vec::new(),
+    slots: [FREE_SLOT; MAX_TRANSFERS],
+});
+
+/// Whether the caller may yield or block.
+#[inline]
+fn can_sleep() -> bool {
+    scheduler::current_tid() != 0 && crate::arch::hal::interrupts_enabled()
+}
+
+/// Wake `tid`; from IRQ context without spinning on SCHEDULER.
+#[inline]
+fn wake(tid: u32, in_irq: bool) {
+    if !in_irq {
+        scheduler::wake_thread(tid);
+    } else if !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
+
+fn complete(st: &mut BulkState, slot: usize, result: Result<usize, &'static str>, in_irq: bool) {
+    let s = &mut st.slots[slot];
+    s.result = result;
+    s.state = SlotState::Done;
+    let tid = core::mem::replace(&mut s.waiter, 0);
+    if tid != 0 {
+        wake(tid, in_irq);
+    }
+}
+
+fn find_queue(st: &BulkState, dev_addr: u8, endpoint: u8) -> Option<usize> {
+    st.queues.iter().position(|q| q.dev_addr == dev_addr && q.endpoint == endpoint)
+}
+
+/// Queue of an endpoint, created and linked into the async schedule on
+/// first use.
+fn queue_for(
+    st: &mut BulkState,
+    dev_addr: u8,
+    speed: UsbSpeed,
+    endpoint: u8,
+    max_packet: u16,
+) -> Result<usize, &'static str> {
+    if let Some(qi) = find_queue(st, dev_addr, endpoint) {
+        return Ok(qi);
+    }
+    let page_phys = physical::alloc_frame().ok_or("EHCI: out of memory")?.as_u64();
+    let mut q = EndpointQueue {
+        dev_addr,
+        endpoint,
+        page_phys,
+        head: 0,
+        tail: 0,
+        lens: [0; RING_TDS],
+        inflight: Vec::new(),
+    };
+    let mps = if max_packet == 0 { 8 } else { max_packet };
+    unsafe {
+        let qh = q.qh();
+        core::ptr::write_bytes(qh, 0, 1);
+        // Not the reclamation head; the toggle lives in the QH overlay
+        (*qh).characteristics =
+            make_qh_chars(dev_addr, endpoint & 0x0F, speed, mps) & !(QH_HEAD | QH_DTC);
+        (*qh).capabilities = make_qh_caps(speed);
+    }
+    q.reset_ring();
+
+    // Link right behind the head: fill in our link before publishing it
+    unsafe {
+        let head = st.async_qh_phys as *mut EhciQh;
+        (*q.qh()).horiz_link = core::ptr::read_volatile(&(*head).horiz_link);
+        core::sync::atomic::fence(Ordering::SeqCst);
+        core::ptr::write_volatile(&mut (*head).horiz_link, (page_phys as u32) | QH_TYPE_QH);
+    }
+    st.queues.push(q);
+    Ok(st.queues.len() - 1)
+}
+
+/// Take the QH of `st.queues[qi]` out of the async schedule and wait until
+/// the controller no longer caches it.
+fn unlink_queue(st: &BulkState, qi: usize) {
+    let target = st.queues[qi].page_phys as u32;
+    unsafe {
+        let mut prev = st.async_qh_phys as *mut EhciQh;
+        loop {
+            let link = core::ptr::read_volatile(&(*prev).horiz_link);
+            let next = link & !0x1F;
+            if next == target {
+                let after = core::ptr::read_volatile(&(*st.queues[qi].qh()).horiz_link);
+                core::ptr::write_volatile(&mut (*prev).horiz_link, after);
+                break;
+            }
+            if next == st.async_qh_phys as u32 {
+                return; // not linked
+            }
+            prev = next as u64 as *mut EhciQh;
+        }
+    }
+    // Async advance doorbell: set once the controller has let go of it
+    let cmd = mmio_read32(st.op_base, OP_USBCMD);
+    mmio_write32(st.op_base, OP_USBCMD, cmd | CMD_IAAD);
+    for _ in 0..ASYNC_ADVANCE_POLLS {
+        if mmio_read32(st.op_base, OP_USBSTS) & STS_ASYNC_ADVANCE != 0 {
+            break;
+        }
+        core::hint::spin_loop();
+    }
+    mmio_write32(st.op_base, OP_USBSTS, STS_ASYNC_ADVANCE);
+}
+
+fn relink_queue(st: &BulkState, qi: usize) {
+    unsafe {
+        let head = st.async_qh_phys as *mut EhciQh;
+        let qh = st.queues[qi].qh();
+        (*qh).horiz_link = core::ptr::read_volatile(&(*head).horiz_link);
+        core::sync::atomic::fence(Ordering::SeqCst);
+        core::ptr::write_volatile(&mut (*head).horiz_link, (st.queues[qi].page_phys as u32) | QH_TYPE_QH);
+    }
+}
+
+/// Fail everything queued on `st.queues[qi]` and empty its ring. The QH
+/// must not be executing (halted or unlinked).
+fn fail_queue(st: &mut BulkState, qi: usize, err: &'static str, in_irq: bool) {
+    let slots = core::mem::take(&mut st.queues[qi].inflight);
+    for slot in slots {
+        complete(st, slot, Err(err), in_irq);
+    }
+    st.queues[qi].reset_ring();
+}
+
+/// Collect the finished transfers of `st.queues[qi]`, oldest first.
+fn reap_queue(st: &mut BulkState, qi: usize, in_irq: bool) {
+    while let Some(&slot) = st.queues[qi].inflight.first() {
+        let (first, count) = (st.slots[slot].first, st.slots[slot].count);
+        let q = &st.queues[qi];
+        let mut actual = 0usize;
+        let mut finished = true;
+        let mut halted = false;
+        let mut short = false;
+        for k in 0..count {
+            let token = unsafe { core::ptr::read_volatile(&(*q.qtd(first + k)).token) };
+            if token & QTD_ACTIVE != 0 {
+                finished = false;
+                break;
+            }
+            if token & QTD_HALTED != 0 {
+                halted = true;
+                break;
+            }
+            let left = ((token >> 16) & 0x7FFF) as usize;
+            actual += (q.lens[(first + k) % RING_TDS] as usize).saturating_sub(left);
+            if left != 0 {
+                // Short packet: the controller went on at alt_next,
+                // skipping the rest of this transfer
+                short = k + 1 < count;
+                break;
+            }
+        }
+
+        if halted {
+            // The QH is halted (stall or bus error); the controller skips
+            // it, so the ring can be reset in place
+            fail_queue(st, qi, "EHCI bulk transfer error", in_irq);
+            return;
+        }
+        if !finished {
+            return;
+        }
+        let q = &mut st.queues[qi];
+        if short {
+            for k in 0..count {
+                unsafe { core::ptr::write_volatile(&mut (*q.qtd(first + k)).token, 0); }
+            }
+        }
+        q.head = (first + count) % RING_TDS;
+        q.inflight.remove(0);
+        complete(st, slot, Ok(actual), in_irq);
+    }
+}
+
+fn reap_all(st: &mut BulkState, in_irq: bool) {
+    for qi in 0..st.queues.len() {
+        if !st.queues[qi].inflight.is_empty() {
+            reap_queue(st, qi, in_irq);
+        }
+    }
+}
+
+fn ehci_irq_handler(_irq: u8) {
+    let mut st = BULK.lock();
+    if st.op_base == 0 {
+        return;
+    }
+    let sts = mmio_read32(st.op_base, OP_USBSTS) & (STS_INT | STS_ERROR);
+    if sts == 0 {
+        return; // not ours (shared line)
+    }
+    mmio_write32(st.op_base, OP_USBSTS, sts);
+    reap_all(&mut st, true);
+}
+
+/// Queue a bulk transfer without waiting for it. Finish it with
+/// [`bulk_wait`], which every submitted transfer needs.
 /// `endpoint`: endpoint address (bit 7 = direction: 0x80=IN, 0x00=OUT)
-/// `toggle`: pointer to caller's data toggle state (0 or 1), updated on return
-/// `data_phys`: physical address of DMA-accessible buffer
-/// `len`: number of bytes to transfer
-/// Returns number of bytes actually transferred.
-fn bulk_transfer_inner(
-    ctrl: &EhciController,
+/// `toggle`: caller's data toggle, loaded if the endpoint is idle
+/// `data_phys`: physical address of DMA-accessible buffer (below 4 GiB)
+/// Returns the transfer's slot.
+pub fn bulk_submit(
     dev_addr: u8,
     speed: UsbSpeed,
     endpoint: u8,
     max_packet: u16,
-    toggle: &mut u8,
+    toggle: u8,
     data_phys: u64,
     len: usize,
 ) -> Result<usize, &'static str> {
-    if len == 0 { return Ok(0); }
+    let mut guard = BULK.lock();
+    let st = &mut *guard;
+    if st.op_base == 0 {
+        return Err("EHCI not initialized");
+    }
+    let slot = st.slots.iter().position(|s| s.state == SlotState::Free)
+        .ok_or("EHCI: too many bulk transfers")?;
+    if len == 0 {
+        st.slots[slot] = XferSlot { state: SlotState::Done, ..FREE_SLOT };
+        return Ok(slot);
+    }
+    let qi = queue_for(st, dev_addr, speed, endpoint, max_packet)?;
+    let q = &mut st.queues[qi];
     let max_pkt = (max_packet as usize).max(1);
-
-    let qh_phys = ctrl.async_qh_phys;
-    let td_base = ctrl.td_pool_phys;
-    let ep_num = endpoint & 0x0F;
-    let is_in = (endpoint & 0x80) != 0;
+    let is_in = endpoint & 0x80 != 0;
     let pid = if is_in { QTD_PID_IN } else { QTD_PID_OUT };
 
-    // Max qTDs: (4096 - 256) / 32 = 120
-    let max_tds: usize = 120;
-    let num_tds = ((len + max_pkt - 1) / max_pkt).min(max_tds);
-
-    // Build qTD chain
-    for i in 0..num_tds {
-        let this_qtd = td_base + (i as u64) * 32;
-        let offset = i * max_pkt;
-        let chunk = if i == num_tds - 1 {
-            (len - offset).min(max_pkt)
-        } else {
-            max_pkt
-        };
-
-        let next_link = if i + 1 < num_tds {
-            (td_base + ((i + 1) as u64) * 32) as u32
-        } else {
-            LP_T
-        };
+    // Split into qTDs of up to 5 pages; all but the last end on a packet
+    // boundary so a short packet always ends the transfer
+    let mut pieces = [0u32; RING_TDS];
+    let mut count = 0;
+    let mut off = 0usize;
+    while off < len {
+        if count + 1 >= RING_TDS - q.used() {
+            return Err("EHCI: bulk queue full");
+        }
+        let addr = data_phys + off as u64;
+        let room = 5 * 4096 - (addr & 0xFFF) as usize;
+        let mut n = (len - off).min(room);
+        if off + n < len {
+            n -= n % max_pkt;
+        }
+        pieces[count] = n as u32;
+        count += 1;
+        off += n;
+    }
 
-        let mut token = make_qtd_token(pid, *toggle, chunk as u16);
-        if i + 1 == num_tds { token |= QTD_IOC; }
+    if q.inflight.is_empty() {
+        // Idle: the overlay takes the caller's toggle
+        unsafe {
+            core::ptr::write_volatile(&mut (*q.qh()).token, (toggle as u32 & 1) << 31);
+        }
+    }
 
+    let first = q.tail;
+    let after = q.qtd_phys(first + count);
+    let mut off = 0u64;
+    for k in 0..count {
+        let n = pieces[k];
+        let addr = data_phys + off;
+        let mut token = make_qtd_token(pid, 0, n as u16);
+        if k + 1 == count {
+            token |= QTD_IOC;
+        }
+        if k == 0 {
+            token &= !QTD_ACTIVE; // activated last
+        }
         unsafe {
-            let qtd = this_qtd as *mut EhciQtd;
-            (*qtd).next_qtd = next_link;
-            (*qtd).alt_next_qtd = LP_T;
-            (*qtd).token = token;
-            (*qtd).buffer[0] = (data_phys + offset as u64) as u32;
-            // EHCI buffer pointers are per-4K page; set additional pages if crossing
-            let start_page = (data_phys + offset as u64) & !0xFFF;
+            let qtd = q.qtd(first + k);
+            (*qtd).next_qtd = q.qtd_phys(first + k + 1) as u32;
+            // A short IN packet skips the rest of the transfer
+            (*qtd).alt_next_qtd = if is_in && k + 1 < count { after as u32 } else { LP_T };
+            (*qtd).buffer[0] = addr as u32;
+            let page = addr & !0xFFF;
             for b in 1..5u64 {
-                (*qtd).buffer[b as usize] = (start_page + b * 4096) as u32;
+                (*qtd).buffer[b as usize] = (page + b * 4096) as u32;
             }
+            core::ptr::write_volatile(&mut (*qtd).token, token);
         }
-        *toggle ^= 1;
+        q.lens[(first + k) % RING_TDS] = n;
+        off += n as u64;
     }
-
-    // Configure QH for this endpoint
-    let mps = if max_packet == 0 { 8 } else { max_packet };
+    q.tail = (first + count) % RING_TDS;
     unsafe {
-        let qh = qh_phys as *mut EhciQh;
-        // Keep H=1, DTC=1, set endpoint, device address, speed, max packet
-        (*qh).characteristics = make_qh_chars(dev_addr, ep_num, speed, mps);
-        (*qh).capabilities = make_qh_caps(speed);
-        (*qh).current_qtd = 0;
-        (*qh).next_qtd = td_base as u32;
-        (*qh).alt_next_qtd = LP_T;
-        (*qh).token = 0; // clear overlay
-        for b in &mut (*qh).buffer { *b = 0; }
+        // The new tail stays inactive; the controller stops there
+        core::ptr::write_volatile(&mut (*q.qtd(q.tail)).token, 0);
+        core::sync::atomic::fence(Ordering::SeqCst);
+        let qtd = q.qtd(first);
+        let token = core::ptr::read_volatile(&(*qtd).token);
+        core::ptr::write_volatile(&mut (*qtd).token, token | QTD_ACTIVE);
     }
+    q.inflight.push(slot);
+    st.slots[slot] = XferSlot {
+        state: SlotState::Busy,
+        dev_addr,
+        endpoint,
+        first,
+        count,
+        result: Ok(0),
+        waiter: 0,
+    };
 
-    // Ensure async schedule is enabled
-    let usbcmd = mmio_read32(ctrl.op_base, OP_USBCMD);
+    let usbcmd = mmio_read32(st.op_base, OP_USBCMD);
     if usbcmd & CMD_ASYNC_ENABLE == 0 {
-        mmio_write32(ctrl.op_base, OP_USBCMD, usbcmd | CMD_ASYNC_ENABLE);
+        mmio_write32(st.op_base, OP_USBCMD, usbcmd | CMD_ASYNC_ENABLE);
     }
+    Ok(slot)
+}
 
-    // Poll last qTD for completion
-    let last_qtd = td_base + ((num_tds - 1) as u64) * 32;
-    let timeout = 5000u32; // 5 seconds
+/// Wait for a transfer from [`bulk_submit`] and free its slot. If the
+/// endpoint went idle, its toggle is written back to `toggle`.
+/// Returns number of bytes actually transferred.
+pub fn bulk_wait(slot: usize, toggle: &mut u8) -> Result<usize, &'static str> {
+    let tid = scheduler::current_tid();
     let start = crate::arch::x86::pit::get_ticks();
-
+    let mut polls = 0u32;
     loop {
-        let token = unsafe {
-            let qtd = last_qtd as *mut EhciQtd;
-            core::ptr::read_volatile(&(*qtd).token)
-        };
+        let mut guard = BULK.lock();
+        let st = &mut *guard;
+        let (dev_addr, endpoint) = (st.slots[slot].dev_addr, st.slots[slot].endpoint);
+        let qi = find_queue(st, dev_addr, endpoint);
+        if st.slots[slot].state == SlotState::Busy {
+            if let Some(qi) = qi {
+                reap_queue(st, qi, false);
+            }
+        }
 
-        if token & QTD_ACTIVE == 0 {
-            if token & QTD_ERR_MASK != 0 {
-                // Deactivate QH
-                unsafe {
-                    let qh = qh_phys as *mut EhciQh;
-                    (*qh).next_qtd = LP_T;
-                    (*qh).token = 0;
+        if st.slots[slot].state != SlotState::Busy {
+            let result = st.slots[slot].result;
+            st.slots[slot] = FREE_SLOT;
+            if let Some(qi) = qi {
+                let q = &st.queues[qi];
+                if q.inflight.is_empty() {
+                    let token = unsafe { core::ptr::read_volatile(&(*q.qh()).token) };
+                    *toggle = (token >> 31) as u8;
                 }
-                return Err("EHCI bulk transfer error");
             }
-            break;
+            return result;
         }
 
-        if crate::arch::x86::pit::get_ticks().wrapping_sub(start) > timeout {
-            unsafe {
-                let qh = qh_phys as *mut EhciQh;
-                (*qh).next_qtd = LP_T;
-                (*qh).token = 0;
+        let elapsed = crate::arch::x86::pit::get_ticks().wrapping_sub(start);
+        if polls >= BULK_TIMEOUT_POLLS || elapsed > BULK_TIMEOUT_MS {
+            if let Some(qi) = qi {
+                unlink_queue(st, qi);
+                fail_queue(st, qi, "EHCI bulk transfer timeout", false);
+                relink_queue(st, qi);
             }
-            return Err("EHCI bulk transfer timeout");
+            continue;
         }
 
-        core::hint::spin_loop();
-    }
-
-    // Deactivate QH
-    unsafe {
-        let qh = qh_phys as *mut EhciQh;
-        (*qh).next_qtd = LP_T;
-        (*qh).token = 0;
+        if st.irq_enabled && can_sleep() && polls >= SPIN_POLLS {
+            // Publish the waiter under the lock the IRQ handler reaps under
+            st.slots[slot].waiter = tid;
+            let wake_at = crate::arch::x86::pit::get_ticks().wrapping_add(BLOCK_SLICE_MS);
+            scheduler::prepare_block_current(Some(wake_at));
+            drop(guard);
+            scheduler::schedule();
+            BULK.lock().slots[slot].waiter = 0;
+        } else {
+            drop(guard);
+            polls += 1;
+            core::hint::spin_loop();
+        }
     }
+}
 
-    // Calculate actual bytes transferred from qTD token fields
-    let mut total = 0usize;
-    for i in 0..num_tds {
-        let qtd_phys = td_base + (i as u64) * 32;
-        let token = unsafe {
-            let qtd = qtd_phys as *mut EhciQtd;
-            core::ptr::read_volatile(&(*qtd).token)
-        };
-        if token & QTD_ACTIVE != 0 {
-            break;
-        }
-        let bytes_left = ((token >> 16) & 0x7FFF) as usize;
-        let expected = if i == num_tds - 1 {
-            (len - i * max_pkt).min(max_pkt)
-        } else {
-            max_pkt
-        };
-        let actual = expected.saturating_sub(bytes_left);
-        total += actual;
-        if actual < max_pkt {
-            break; // short packet
+/// Cancel everything queued on an endpoint (error recovery). The waiters
+/// get an error.
+pub fn bulk_flush(dev_addr: u8, endpoint: u8) {
+    let mut guard = BULK.lock();
+    let st = &mut *guard;
+    if let Some(qi) = find_queue(st, dev_addr, endpoint) {
+        if !st.queues[qi].inflight.is_empty() {
+            unlink_queue(st, qi);
+            fail_queue(st, qi, "EHCI bulk transfer cancelled", false);
+            relink_queue(st, qi);
         }
     }
+}
 
-    Ok(total)
+/// Remove the endpoint queues of a device that went away.
+pub fn release_device(dev_addr: u8) {
+    let mut guard = BULK.lock();
+    let st = &mut *guard;
+    while let Some(qi) = st.queues.iter().position(|q| q.dev_addr == dev_addr) {
+        unlink_queue(st, qi);
+        fail_queue(st, qi, "USB device removed", false);
+        let q = st.queues.swap_remove(qi);
+        physical::free_frame(PhysAddr(q.page_phys));
+    }
 }
 
-/// Public bulk transfer. Locks EHCI_CTRL internally.
+/// Execute a bulk transfer and wait for it.
+/// `endpoint`: endpoint address (bit 7 = direction: 0x80=IN, 0x00=OUT)
+/// `toggle`: pointer to caller's data toggle state (0 or 1), updated on return
+/// `data_phys`: physical address of DMA-accessible buffer
+/// `len`: number of bytes to transfer
+/// Returns number of bytes actually transferred.
 pub fn bulk_transfer(
     dev_addr: u8,
     speed: UsbSpeed,
@@ -499,9 +893,8 @@ pub fn bulk_transfer(
     data_phys: u64,
     len: usize,
 ) -> Result<usize, &'static str> {
-    let guard = EHCI_CTRL.lock();
-    let ctrl = guard.as_ref().ok_or("EHCI not initialized")?;
-    bulk_transfer_inner(ctrl, dev_addr, speed, endpoint, max_packet, toggle, data_phys, len)
+    let slot = bulk_submit(dev_addr, speed, endpoint, max_packet, *toggle, data_phys, len)?;
+    bulk_wait(slot, toggle)
 }
 
 // ── Device Enumeration ─────────────────────────
@@ -889,7 +1282,7 @@ pub fn init_controller(pci: &PciDevice) {
     // Set frame index to 0
     mmio_write32(op_base, OP_FRINDEX, 0);
 
-    // Disable interrupts (we poll)
+    // No interrupts until the bulk queues are set up
     mmio_write32(op_base, OP_USBINTR, 0);
 
     // Set CONFIGFLAG = 1 (route all ports to EHCI)
@@ -912,6 +1305,34 @@ pub fn init_controller(pci: &PciDevice) {
 
     crate::serial_println!("  EHCI: controller running");
 
+    {
+        let mut bulk = BULK.lock();
+        bulk.op_base = op_base;
+        bulk.async_qh_phys = async_qh_phys;
+    }
+
+    // Bulk completions by interrupt: MSI if the controller has it, else
+    // the (usually shared) INTx line
+    let irq = pci.interrupt_line;
+    let msi_irq = crate::drivers::pci::msi_enable(pci, ehci_irq_handler,
+        crate::drivers::pci::IrqAffinity::Spread);
+    if msi_irq.is_some() || (irq > 0 && irq < 32) {
+        if msi_irq.is_none() {
+            crate::arch::x86::irq::register_irq_chain(irq, ehci_irq_handler);
+            if crate::arch::x86::apic::is_initialized() {
+                crate::arch::x86::ioapic::unmask_irq(irq);
+            } else {
+                crate::arch::x86::pic::unmask(irq);
+            }
+        }
+        mmio_write32(op_base, OP_USBINTR, STS_INT | STS_ERROR);
+        BULK.lock().irq_enabled = true;
+        crate::serial_println!("  EHCI: IRQ {} registered (interrupt-driven bulk I/O)",
+            msi_irq.unwrap_or(irq));
+    } else {
+        crate::serial_println!("  EHCI: no valid IRQ ({}), bulk transfers polled", irq);
+    }
+
     let mut ctrl = EhciController {
         mmio_base,
         op_base,
@@ -969,7 +1390,8 @@ pub fn poll_ports() {
             // Clear status change bits
             mmio_write32(ctrl.op_base, port_offset, portsc | PORTSC_CSC | PORTSC_PEC);
 
-            // Clean up class drivers and USB device registry
+            // Clean up class drivers and USB device registry (which also
+            // drops the endpoint queues)
             let port_num = (i + 1) as u8;
             super::hub::disconnect(port_num, super::ControllerType::Ehci);
             super::cdc_acm::disconnect(port_num, super::ControllerType::Ehci);
@@ -1,13 +1,14 @@
 //! USB Hub class driver (class 0x09).
 //!
 //! Enumerates downstream ports, powers them, resets connected devices,
-//! and runs the standard USB enumeration sequence for each.
+//! and runs the standard USB enumeration sequence for each. Addressing
+//! and configuration go through the controller's [`super::HostController`],
+//! since xHCI does them with commands of its own.
 
 use super::{
-    ControllerType, SetupPacket, UsbDevice, UsbInterface, UsbSpeed,
-    hid_control_transfer, alloc_address, register_device, parse_config,
-    REQ_GET_DESCRIPTOR, REQ_SET_ADDRESS, REQ_SET_CONFIGURATION,
-    DESC_DEVICE, DESC_CONFIG, DIR_DEVICE_TO_HOST, DIR_HOST_TO_DEVICE,
+    ControllerType, HubPort, SetupPacket, UsbDevice, UsbInterface, UsbSpeed,
+    hid_control_transfer, register_device, parse_config,
+    REQ_GET_DESCRIPTOR, DESC_DEVICE, DESC_CONFIG, DIR_DEVICE_TO_HOST,
 };
 use crate::memory::physical;
 use crate::sync::spinlock::Spinlock;
@@ -46,7 +47,7 @@ const PORT_CHANGE_CONNECTION: u16 = 1 << 0;
 
 // ── Hub State ────────────────────────────────────
 
-struct HubPort {
+struct PortState {
     connected: bool,
 }
 
@@ -57,7 +58,7 @@ struct HubDevice {
     max_packet: u16,
     port: u8,
     num_ports: u8,
-    ports: Vec<HubPort>,
+    ports: Vec<PortState>,
     data_phys: u64,
 }
 
@@ -168,41 +169,19 @@ fn reset_hub_port(hub: &HubDevice, port: u8) -> Result<UsbSpeed, &'static str> {
 fn enumerate_downstream(hub: &HubDevice, hub_port: u8, speed: UsbSpeed) {
     let controller = hub.controller;
 
-    // Step 1: GET_DESCRIPTOR to address 0 (first 8 bytes for max packet size)
-    let setup_dev8 = SetupPacket {
-        bm_request_type: DIR_DEVICE_TO_HOST,
-        b_request: REQ_GET_DESCRIPTOR,
-        w_value: DESC_DEVICE,
-        w_index: 0,
-        w_length: 8,
-    };
-    let data8 = match hid_control_transfer(0, controller, speed, 8, &setup_dev8, true, 8) {
-        Ok(d) if d.len() >= 8 => d,
-        _ => {
-            crate::serial_println!("  Hub: downstream port {} — GET_DESCRIPTOR(8) failed", hub_port);
+    let host = super::host(controller);
+
+    // Steps 1-2: address the device (GET_DESCRIPTOR(8) + SET_ADDRESS, or
+    // the controller's own way)
+    let (new_addr, max_packet) = match host.address_device(
+        HubPort { hub_addr: hub.usb_addr, port: hub_port }, speed,
+    ) {
+        Ok(v) => v,
+        Err(e) => {
+            crate::serial_println!("  Hub: downstream port {} — addressing failed: {}", hub_port, e);
             return;
         }
     };
-    let max_packet = data8[7] as u16;
-    if max_packet == 0 {
-        crate::serial_println!("  Hub: downstream port {} — max_packet=0", hub_port);
-        return;
-    }
-
-    // Step 2: SET_ADDRESS
-    let new_addr = alloc_address();
-    let setup_addr = SetupPacket {
-        bm_request_type: DIR_HOST_TO_DEVICE,
-        b_request: REQ_SET_ADDRESS,
-        w_value: new_addr as u16,
-        w_index: 0,
-        w_length: 0,
-    };
-    if hid_control_transfer(0, controller, speed, max_packet, &setup_addr, false, 0).is_err() {
-        crate::serial_println!("  Hub: downstream port {} — SET_ADDRESS failed", hub_port);
-        return;
-    }
-    crate::arch::x86::pit::delay_ms(5);
 
     // Step 3: GET_DESCRIPTOR full (18 bytes)
     let setup_dev18 = SetupPacket {
@@ -253,7 +232,7 @@ fn enumerate_downstream(hub: &HubDevice, hub_port: u8, speed: UsbSpeed) {
         w_length: total_len,
     };
     let config_data = match hid_control_transfer(new_addr, controller, speed, max_packet, &setup_cfg_full, true, total_len) {
-        Ok(d) if d.len() >= 9 => d,
+        Ok(d) if d.len() >= total_len as usize => d,
         _ => {
             crate::serial_println!("  Hub: device {} — full config failed", new_addr);
             return;
@@ -264,14 +243,8 @@ fn enumerate_downstream(hub: &HubDevice, hub_port: u8, speed: UsbSpeed) {
 
     // Step 6: SET_CONFIGURATION
     let config_val = if config_data.len() > 5 { config_data[5] } else { 1 };
-    let setup_setcfg = SetupPacket {
-        bm_request_type: DIR_HOST_TO_DEVICE,
-        b_request: REQ_SET_CONFIGURATION,
-        w_value: config_val as u16,
-        w_index: 0,
-        w_length: 0,
-    };
-    if hid_control_transfer(new_addr, controller, speed, max_packet, &setup_setcfg, false, 0).is_err() {
+    let config_raw = &config_data[..total_len as usize];
+    if host.set_configuration(new_addr, speed, max_packet, config_raw, config_val).is_err() {
         crate::serial_println!("  Hub: device {} — SET_CONFIGURATION failed", new_addr);
         return;
     }
@@ -300,7 +273,7 @@ fn enumerate_downstream(hub: &HubDevice, hub_port: u8, speed: UsbSpeed) {
         protocol: dev_protocol,
         num_configs: b_num_configurations,
         interfaces,
-        config_raw: config_data[..total_len as usize].to_vec(),
+        config_raw: config_raw.to_vec(),
     };
 
     crate::serial_println!(
@@ -348,10 +321,11 @@ pub fn probe(dev: &UsbDevice, _iface: &UsbInterface) {
     };
     hub.num_ports = num_ports;
     crate::serial_println!("  Hub: {} ports, power-on delay {}ms", num_ports, pwr_delay as u32 * 2);
+    super::host(dev.controller).hub_attached(dev.address, num_ports);
 
     // Initialize port state
     for _ in 0..num_ports {
-        hub.ports.push(HubPort { connected: false });
+        hub.ports.push(PortState { connected: false });
     }
 
     // Power all ports
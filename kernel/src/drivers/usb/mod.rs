@@ -1,10 +1,15 @@
 //! USB subsystem — host controller drivers and class drivers.
 //!
-//! Supports UHCI (USB 1.x, I/O port based) and EHCI (USB 2.0, MMIO based).
-//! Class drivers: HID, Mass Storage, Hub, CDC-ACM (serial), CDC-ECM (Ethernet).
+//! Supports UHCI (USB 1.x, I/O port based), EHCI (USB 2.0, MMIO based) and
+//! xHCI (USB 3.x, MMIO based). Class drivers: HID, Mass Storage (BOT and
+//! UAS), Hub, CDC-ACM (serial), CDC-ECM (Ethernet).
+//!
+//! Class drivers reach the controller of a device through the
+//! [`HostController`] trait (see [`host`]).
 
 pub mod uhci;
 pub mod ehci;
+pub mod xhci;
 pub mod hid;
 pub mod storage;
 pub mod hub;
@@ -22,6 +27,7 @@ pub enum UsbSpeed {
     Low,  // 1.5 Mbps (USB 1.0)
     Full, // 12 Mbps (USB 1.1)
     High, // 480 Mbps (USB 2.0)
+    Super, // 5+ Gbps (USB 3.x)
 }
 
 // ── USB Controller Type ──────────────────────────
@@ -30,6 +36,7 @@ pub enum UsbSpeed {
 pub enum ControllerType {
     Uhci,
     Ehci,
+    Xhci,
 }
 
 // ── USB Device ───────────────────────────────────
@@ -55,6 +62,8 @@ pub struct UsbDevice {
 #[derive(Debug, Clone)]
 pub struct UsbInterface {
     pub number: u8,
+    /// Alternate setting (every alternate is listed separately).
+    pub alt: u8,
     pub class: u8,
     pub subclass: u8,
     pub protocol: u8,
@@ -67,6 +76,11 @@ pub struct UsbEndpoint {
     pub attributes: u8, // bits1-0 = transfer type (0=control, 1=iso, 2=bulk, 3=interrupt)
     pub max_packet_size: u16,
     pub interval: u8,
+    /// SuperSpeed companion: max burst, and log2 of the bulk streams.
+    pub max_burst: u8,
+    pub max_streams: u8,
+    /// UAS pipe ID (1=command, 2=status, 3=data-in, 4=data-out; 0=none).
+    pub uas_pipe: u8,
 }
 
 // ── Global Device List ───────────────────────────
@@ -123,10 +137,12 @@ pub fn remove_device(port: u8, controller: ControllerType) {
     let mut devs = USB_DEVICES.lock();
     if let Some(pos) = devs.iter().position(|d| d.port == port && d.controller == controller) {
         let dev = devs.remove(pos);
+        drop(devs);
         crate::serial_println!(
             "  USB: removed device {} (port {}, {:04x}:{:04x})",
             dev.address, port, dev.vendor_id, dev.product_id,
         );
+        host(controller).release_device(dev.address);
     }
 }
 
@@ -134,6 +150,7 @@ pub fn remove_device(port: u8, controller: ControllerType) {
 pub fn poll_all_controllers() {
     uhci::poll_ports();
     ehci::poll_ports();
+    xhci::poll_ports();
 }
 
 /// USB polling kernel thread: HID input every 10ms, port hot-plug every 500ms.
@@ -162,6 +179,233 @@ pub extern "C" fn poll_thread() {
     }
 }
 
+// ── Host Controller Interface ────────────────────
+
+/// Hub port a device was found on.
+#[derive(Debug, Clone, Copy)]
+pub struct HubPort {
+    /// Address of the hub.
+    pub hub_addr: u8,
+    /// Port on the hub (1-based).
+    pub port: u8,
+}
+
+/// What the class drivers need from a host controller driver. The
+/// defaults do it the USB 1/2 way, over control transfers alone; xHCI
+/// overrides them because the controller owns device addresses and
+/// endpoint state.
+pub trait HostController: Sync {
+    /// Control transfer on endpoint 0. Returns the data read (IN) or an
+    /// empty Vec (OUT).
+    fn control_transfer(
+        &self,
+        addr: u8,
+        speed: UsbSpeed,
+        max_packet: u16,
+        setup: &SetupPacket,
+        data_in: bool,
+        data_len: u16,
+    ) -> Result<Vec<u8>, &'static str>;
+
+    /// Start a bulk transfer (see [`bulk_submit`]). `stream` is the bulk
+    /// stream ID, 0 for an endpoint without streams.
+    fn bulk_submit(
+        &self,
+        addr: u8,
+        speed: UsbSpeed,
+        endpoint: u8,
+        max_packet: u16,
+        stream: u16,
+        toggle: &mut u8,
+        data_phys: u64,
+        len: usize,
+    ) -> BulkHandle;
+
+    /// Wait for a transfer queued by `bulk_submit`.
+    fn bulk_wait(&self, _xfer: usize, _toggle: &mut u8) -> Result<usize, &'static str> {
+        Err("USB: transfer not queued")
+    }
+
+    /// Cancel the transfers queued on an endpoint.
+    fn bulk_flush(&self, _addr: u8, _endpoint: u8) {}
+
+    /// Give the device just reset on a hub port an address. Returns the
+    /// address and the max packet size of endpoint 0.
+    fn address_device(&self, _hub: HubPort, speed: UsbSpeed) -> Result<(u8, u16), &'static str> {
+        let setup_dev8 = SetupPacket {
+            bm_request_type: DIR_DEVICE_TO_HOST,
+            b_request: REQ_GET_DESCRIPTOR,
+            w_value: DESC_DEVICE,
+            w_index: 0,
+            w_length: 8,
+        };
+        let data8 = self.control_transfer(0, speed, 8, &setup_dev8, true, 8)?;
+        let max_packet = if data8.len() >= 8 { data8[7] as u16 } else { 0 };
+        if max_packet == 0 {
+            return Err("bad device descriptor");
+        }
+        let new_addr = alloc_address();
+        let setup_addr = SetupPacket {
+            bm_request_type: DIR_HOST_TO_DEVICE,
+            b_request: REQ_SET_ADDRESS,
+            w_value: new_addr as u16,
+            w_index: 0,
+            w_length: 0,
+        };
+        self.control_transfer(0, speed, max_packet, &setup_addr, false, 0)?;
+        crate::arch::x86::pit::delay_ms(5);
+        Ok((new_addr, max_packet))
+    }
+
+    /// Select configuration `value` (`config_raw` is its descriptor).
+    fn set_configuration(
+        &self,
+        addr: u8,
+        speed: UsbSpeed,
+        max_packet: u16,
+        _config_raw: &[u8],
+        value: u8,
+    ) -> Result<(), &'static str> {
+        let setup = SetupPacket {
+            bm_request_type: DIR_HOST_TO_DEVICE,
+            b_request: REQ_SET_CONFIGURATION,
+            w_value: value as u16,
+            w_index: 0,
+            w_length: 0,
+        };
+        self.control_transfer(addr, speed, max_packet, &setup, false, 0).map(|_| ())
+    }
+
+    /// Select the alternate setting `iface` of its interface.
+    fn set_interface(
+        &self,
+        addr: u8,
+        speed: UsbSpeed,
+        max_packet: u16,
+        iface: &UsbInterface,
+    ) -> Result<(), &'static str> {
+        let setup = SetupPacket {
+            bm_request_type: 0x01, // Standard, Interface, Host-to-Device
+            b_request: REQ_SET_INTERFACE,
+            w_value: iface.alt as u16,
+            w_index: iface.number as u16,
+            w_length: 0,
+        };
+        self.control_transfer(addr, speed, max_packet, &setup, false, 0).map(|_| ())
+    }
+
+    /// The device at `addr` is a hub with `num_ports` downstream ports.
+    fn hub_attached(&self, _addr: u8, _num_ports: u8) {}
+
+    /// Whether bulk streams can be used with the device at `addr`.
+    fn supports_streams(&self, _addr: u8) -> bool {
+        false
+    }
+
+    /// Free what the controller keeps for a device that went away.
+    fn release_device(&self, _addr: u8) {}
+}
+
+struct UhciHost;
+
+impl HostController for UhciHost {
+    fn control_transfer(
+        &self,
+        addr: u8,
+        _speed: UsbSpeed,
+        _max_packet: u16,
+        setup: &SetupPacket,
+        data_in: bool,
+        data_len: u16,
+    ) -> Result<Vec<u8>, &'static str> {
+        uhci::hid_control_transfer(addr, setup, data_in, data_len)
+    }
+
+    fn bulk_submit(
+        &self,
+        addr: u8,
+        _speed: UsbSpeed,
+        endpoint: u8,
+        max_packet: u16,
+        _stream: u16,
+        toggle: &mut u8,
+        data_phys: u64,
+        len: usize,
+    ) -> BulkHandle {
+        // One call moves at most the UHCI TD pool; go on until a short
+        // packet or the end
+        let max_pkt = (max_packet as usize).max(1);
+        let mut done = 0usize;
+        while done < len {
+            match uhci::bulk_transfer(
+                addr, endpoint, max_packet, toggle,
+                data_phys + done as u64, len - done,
+            ) {
+                Ok(n) => {
+                    done += n;
+                    if n == 0 || n % max_pkt != 0 { break; }
+                }
+                Err(e) => return BulkHandle::Done(Err(e)),
+            }
+        }
+        BulkHandle::Done(Ok(done))
+    }
+}
+
+struct EhciHost;
+
+impl HostController for EhciHost {
+    fn control_transfer(
+        &self,
+        addr: u8,
+        speed: UsbSpeed,
+        max_packet: u16,
+        setup: &SetupPacket,
+        data_in: bool,
+        data_len: u16,
+    ) -> Result<Vec<u8>, &'static str> {
+        ehci::hid_control_transfer(addr, speed, max_packet, setup, data_in, data_len)
+    }
+
+    fn bulk_submit(
+        &self,
+        addr: u8,
+        speed: UsbSpeed,
+        endpoint: u8,
+        max_packet: u16,
+        _stream: u16,
+        toggle: &mut u8,
+        data_phys: u64,
+        len: usize,
+    ) -> BulkHandle {
+        match ehci::bulk_submit(addr, speed, endpoint, max_packet, *toggle, data_phys, len) {
+            Ok(slot) => BulkHandle::Queued(ControllerType::Ehci, slot),
+            Err(e) => BulkHandle::Done(Err(e)),
+        }
+    }
+
+    fn bulk_wait(&self, xfer: usize, toggle: &mut u8) -> Result<usize, &'static str> {
+        ehci::bulk_wait(xfer, toggle)
+    }
+
+    fn bulk_flush(&self, addr: u8, endpoint: u8) {
+        ehci::bulk_flush(addr, endpoint);
+    }
+
+    fn release_device(&self, addr: u8) {
+        ehci::release_device(addr);
+    }
+}
+
+/// The driver of a controller type.
+pub fn host(controller: ControllerType) -> &'static dyn HostController {
+    match controller {
+        ControllerType::Uhci => &UhciHost,
+        ControllerType::Ehci => &EhciHost,
+        ControllerType::Xhci => &xhci::XhciHost,
+    }
+}
+
 /// Perform a control transfer to a USB device (for HID GET_REPORT / SET_PROTOCOL).
 /// Dispatches to the correct controller driver based on `controller` type.
 pub fn hid_control_transfer(
@@ -173,10 +417,7 @@ pub fn hid_control_transfer(
     data_in: bool,
     data_len: u16,
 ) -> Result<Vec<u8>, &'static str> {
-    match controller {
-        ControllerType::Uhci => uhci::hid_control_transfer(addr, setup, data_in, data_len),
-        ControllerType::Ehci => ehci::hid_control_transfer(addr, speed, max_packet, setup, data_in, data_len),
-    }
+    host(controller).control_transfer(addr, speed, max_packet, setup, data_in, data_len)
 }
 
 /// Perform a bulk transfer to/from a USB device.
@@ -194,16 +435,65 @@ pub fn bulk_transfer(
     data_phys: u64,
     len: usize,
 ) -> Result<usize, &'static str> {
-    match controller {
-        ControllerType::Uhci => uhci::bulk_transfer(
-            dev_addr, endpoint, max_packet, toggle, data_phys, len,
-        ),
-        ControllerType::Ehci => ehci::bulk_transfer(
-            dev_addr, speed, endpoint, max_packet, toggle, data_phys, len,
-        ),
+    let handle = bulk_submit(dev_addr, controller, speed, endpoint, max_packet, toggle, data_phys, len);
+    bulk_wait(handle, toggle)
+}
+
+/// A bulk transfer started with [`bulk_submit`]; finish it with [`bulk_wait`].
+pub enum BulkHandle {
+    /// Already finished at submit (UHCI transfers run synchronously).
+    Done(Result<usize, &'static str>),
+    /// Queued on the controller (transfer slot of its driver).
+    Queued(ControllerType, usize),
+}
+
+/// Start a bulk transfer without waiting for it, so transfers on several
+/// endpoints (e.g. a command, its data and its status) are queued at once.
+/// `toggle` is loaded if the endpoint is idle; [`bulk_wait`] writes it back
+/// (xHCI keeps the toggle itself).
+pub fn bulk_submit(
+    dev_addr: u8,
+    controller: ControllerType,
+    speed: UsbSpeed,
+    endpoint: u8,
+    max_packet: u16,
+    toggle: &mut u8,
+    data_phys: u64,
+    len: usize,
+) -> BulkHandle {
+    host(controller).bulk_submit(dev_addr, speed, endpoint, max_packet, 0, toggle, data_phys, len)
+}
+
+/// [`bulk_submit`] on bulk stream `stream` of an endpoint configured with
+/// streams (UAS).
+pub fn bulk_submit_stream(
+    dev_addr: u8,
+    controller: ControllerType,
+    speed: UsbSpeed,
+    endpoint: u8,
+    max_packet: u16,
+    stream: u16,
+    data_phys: u64,
+    len: usize,
+) -> BulkHandle {
+    let mut toggle = 0;
+    host(controller).bulk_submit(dev_addr, speed, endpoint, max_packet, stream, &mut toggle, data_phys, len)
+}
+
+/// Wait for a transfer from [`bulk_submit`]. Returns bytes transferred.
+pub fn bulk_wait(handle: BulkHandle, toggle: &mut u8) -> Result<usize, &'static str> {
+    match handle {
+        BulkHandle::Done(result) => result,
+        BulkHandle::Queued(controller, xfer) => host(controller).bulk_wait(xfer, toggle),
     }
 }
 
+/// Cancel the bulk transfers queued on an endpoint (error recovery); their
+/// [`bulk_wait`] fails.
+pub fn bulk_flush(dev_addr: u8, controller: ControllerType, endpoint: u8) {
+    host(controller).bulk_flush(dev_addr, endpoint);
+}
+
 fn class_name(class: u8) -> &'static str {
     match class {
         0x00 => "Composite",
@@ -227,6 +517,7 @@ fn speed_name(speed: UsbSpeed) -> &'static str {
         UsbSpeed::Low => "Low-Speed",
         UsbSpeed::Full => "Full-Speed",
         UsbSpeed::High => "High-Speed",
+        UsbSpeed::Super => "SuperSpeed",
     }
 }
 
@@ -305,6 +596,7 @@ pub struct SetupPacket {
 pub const REQ_GET_DESCRIPTOR: u8 = 0x06;
 pub const REQ_SET_ADDRESS: u8 = 0x05;
 pub const REQ_SET_CONFIGURATION: u8 = 0x09;
+pub const REQ_SET_INTERFACE: u8 = 0x0B;
 pub const REQ_SET_PROTOCOL: u8 = 0x0B;
 
 // Descriptor types
@@ -340,6 +632,7 @@ pub fn parse_config(data: &[u8]) -> Vec<UsbInterface> {
             4 if len >= 9 => {
                 let iface = UsbInterface {
                     number: data[offset + 2],
+                    alt: data[offset + 3],
                     class: data[offset + 5],
                     subclass: data[offset + 6],
                     protocol: data[offset + 7],
@@ -355,10 +648,29 @@ pub fn parse_config(data: &[u8]) -> Vec<UsbInterface> {
                         attributes: data[offset + 3],
                         max_packet_size: u16::from_le_bytes([data[offset + 4], data[offset + 5]]),
                         interval: data[offset + 6],
+                        max_burst: 0,
+                        max_streams: 0,
+                        uas_pipe: 0,
                     };
                     iface.endpoints.push(ep);
                 }
             }
+            // SuperSpeed endpoint companion (type 0x30), after its endpoint
+            0x30 if len >= 6 => {
+                if let Some(ep) = interfaces.last_mut().and_then(|i| i.endpoints.last_mut()) {
+                    ep.max_burst = data[offset + 2];
+                    if ep.attributes & 0x03 == 2 {
+                        ep.max_streams = data[offset + 3] & 0x1F;
+                    }
+                }
+            }
+            // UAS pipe usage (type 0x24), after its endpoint
+            0x24 if len >= 4 => {
+                let uas = interfaces.last_mut().filter(|i| i.class == 0x08 && i.protocol == 0x62);
+                if let Some(ep) = uas.and_then(|i| i.endpoints.last_mut()) {
+                    ep.uas_pipe = data[offset + 2];
+                }
+            }
             _ => {}
         }
 
@@ -484,7 +796,8 @@ pub fn init(pci: &PciDevice) {
             crate::serial_println!("  USB: OHCI controller detected (prog_if=0x10) — not supported");
         }
         0x30 => {
-            crate::serial_println!("  USB: xHCI controller detected (prog_if=0x30) — not supported");
+            crate::serial_println!("  USB: xHCI controller detected (prog_if=0x30)");
+            xhci::init_controller(pci);
         }
         _ => {
             crate::serial_println!("  USB: unknown controller type (prog_if={:#04x})", pci.prog_if);
@@ -1,14 +1,25 @@
-//! USB Mass Storage class driver (Bulk-Only Transport).
+//! USB Mass Storage class driver (Bulk-Only Transport and UAS).
 //!
 //! Supports SCSI transparent command set (subclass 0x06) and ATAPI
-//! (subclass 0x02, for CD/DVD-ROM) with bulk-only transport (protocol 0x50).
+//! (subclass 0x02, for CD/DVD-ROM) with bulk-only transport (protocol 0x50),
+//! and USB Attached SCSI (protocol 0x62) on SuperSpeed ports with streams.
 //!
 //! Implements: INQUIRY, TEST_UNIT_READY, READ_CAPACITY, READ_10, WRITE_10,
 //! REQUEST_SENSE, START_STOP_UNIT (eject).
-
-use super::{UsbDevice, UsbInterface, ControllerType, UsbSpeed};
+//!
+//! Every command queues its command, data and status transfers at once,
+//! so the host controller runs it without the CPU. Bulk-Only runs one
+//! command at a time: the next one is already transferring while the data
+//! of the last one is copied. UAS tags each command with its own bulk
+//! stream and keeps up to [`UAS_DEPTH`] of them in flight. Commands use
+//! the bounce slots round-robin, so a slot is only reused once its command
+//! has been copied out.
+
+use super::{BulkHandle, UsbDevice, UsbInterface, ControllerType, UsbSpeed};
 use crate::memory::physical;
+use crate::sync::mutex::Mutex;
 use crate::sync::spinlock::Spinlock;
+use alloc::collections::VecDeque;
 use alloc::vec::Vec;
 
 /// USB mass storage Command Block Wrapper (31 bytes).
@@ -39,6 +50,18 @@ const CSW_SIGNATURE: u32 = 0x53425355;
 const CBW_FLAG_IN: u8 = 0x80;
 const CBW_FLAG_OUT: u8 = 0x00;
 
+// UAS information units
+const UAS_COMMAND_IU: u8 = 0x01;
+const UAS_SENSE_IU: u8 = 0x03;
+const UAS_RESPONSE_IU: u8 = 0x04;
+const UAS_COMMAND_IU_LEN: usize = 32;
+
+// UAS pipe usage (Pipe Usage descriptor)
+const UAS_PIPE_COMMAND: u8 = 1;
+const UAS_PIPE_STATUS: u8 = 2;
+const UAS_PIPE_DATA_IN: u8 = 3;
+const UAS_PIPE_DATA_OUT: u8 = 4;
+
 // SCSI commands
 const SCSI_TEST_UNIT_READY: u8 = 0x00;
 const SCSI_REQUEST_SENSE: u8 = 0x03;
@@ -51,9 +74,22 @@ const SCSI_WRITE_10: u8 = 0x2A;
 /// SCSI device type from INQUIRY byte 0 (bits 4:0).
 const SCSI_DEVTYPE_CDROM: u8 = 0x05;
 
-/// Bounce buffer size: 64 KiB (128 sectors).
-const BOUNCE_PAGES: usize = 16;
+/// Bounce buffer: 512 KiB, four slots of 128 KiB (256 sectors) each.
+const BOUNCE_PAGES: usize = 128;
 const BOUNCE_SIZE: usize = BOUNCE_PAGES * 4096;
+const BOUNCE_SLOTS: usize = 4;
+const BOUNCE_SLOT: usize = BOUNCE_SIZE / BOUNCE_SLOTS;
+
+/// UAS commands in flight per device (one slot is left for copying).
+const UAS_DEPTH: usize = BOUNCE_SLOTS - 1;
+/// Streams each UAS pipe must offer: stream = tag = slot + 1.
+const UAS_MIN_STREAMS: u8 = 3; // 2^3
+
+/// Per-slot command/status buffers in the command page.
+const IU_STRIDE: u64 = 128;
+/// Status (CSW, UAS sense IU) after the command (CBW, UAS command IU).
+const STATUS_OFFSET: u64 = 32;
+const STATUS_MAX: usize = 96;
 
 // ── Device State ─────────────────────────────────
 
@@ -63,18 +99,29 @@ struct UsbStorageDevice {
     controller: ControllerType,
     speed: UsbSpeed,
     port: u8,
+    /// Bulk IN / OUT (UAS: the data-in and data-out pipes).
     ep_in: u8,
     ep_out: u8,
     max_packet_in: u16,
     max_packet_out: u16,
     toggle_in: u8,
     toggle_out: u8,
+    /// UAS: command and status pipes; commands are tagged by stream.
+    uas: bool,
+    ep_cmd: u8,
+    ep_status: u8,
+    max_packet_cmd: u16,
+    max_packet_status: u16,
+    /// Sense data of the last failed UAS command (UAS returns it with the
+    /// status instead of on REQUEST_SENSE).
+    sense: [u8; 18],
     tag: u32,
     block_count: u32,
     block_size: u32,
-    /// 1 page: CBW at offset 0 (31 bytes), CSW at offset 64 (13 bytes).
+    /// 1 page: per bounce slot, the command at `slot * 128` and the status
+    /// 32 bytes after it.
     cbw_csw_phys: u64,
-    /// 64 KiB bounce buffer for sector data (16 contiguous pages).
+    /// 512 KiB bounce buffer for sector data (128 contiguous pages).
     bounce_phys: u64,
     /// Assigned disk_id in the block device registry.
     disk_id: u8,
@@ -92,10 +139,24 @@ impl UsbStorageDevice {
         self.tag = self.tag.wrapping_add(1);
         t
     }
+
+    fn slot_phys(&self, slot: usize) -> u64 {
+        self.bounce_phys + (slot * BOUNCE_SLOT) as u64
+    }
+
+    fn iu_phys(&self, slot: usize) -> u64 {
+        self.cbw_csw_phys + slot as u64 * IU_STRIDE
+    }
+
+    /// Commands kept in flight by the read/write pipelines.
+    fn depth(&self) -> usize {
+        if self.uas { UAS_DEPTH } else { 1 }
+    }
 }
 
-/// Global registry of USB storage devices.
-static USB_STORAGE_DEVICES: Spinlock<Vec<UsbStorageDevice>> = Spinlock::new(Vec::new());
+/// Global registry of USB storage devices. A yielding mutex: it is held
+/// across whole commands, which sleep on their transfers.
+static USB_STORAGE_DEVICES: Mutex<Vec<UsbStorageDevice>> = Mutex::new(Vec::new());
 
 /// Next available disk_id for USB storage (boot disk is 0).
 static NEXT_USB_DISK_ID: Spinlock<u8> = Spinlock::new(1);
@@ -117,37 +178,185 @@ fn alloc_cdrom_index() -> u8 {
     i
 }
 
-// ── CBW / CSW Transfer ───────────────────────────
+// ── Command Transport ────────────────────────────
+
+/// A SCSI command whose command, data and status transfers are queued.
+struct Command {
+    tag: u32,
+    slot: usize,
+    write: bool,
+    cmd: BulkHandle,
+    data: BulkHandle,
+    status: BulkHandle,
+}
 
-fn send_cbw(dev: &mut UsbStorageDevice, cbw: &Cbw) -> Result<(), &'static str> {
-    // Copy CBW to DMA buffer at cbw_csw_phys
+/// Queue the SCSI command block `cb` with `len` bytes of data (written
+/// from, or read into, bounce slot `slot`). Finish it with [`finish`].
+fn submit(dev: &mut UsbStorageDevice, cb: &[u8], write: bool, len: usize, slot: usize) -> Command {
+    if dev.uas {
+        submit_uas(dev, cb, write, len, slot)
+    } else {
+        submit_bot(dev, cb, write, len, slot)
+    }
+}
+
+fn submit_bot(dev: &mut UsbStorageDevice, cb: &[u8], write: bool, len: usize, slot: usize) -> Command {
+    let tag = dev.next_tag();
+    let iu = dev.iu_phys(slot);
+    let mut block = [0u8; 16];
+    block[..cb.len()].copy_from_slice(cb);
+    let cbw = Cbw {
+        signature: CBW_SIGNATURE, tag,
+        data_transfer_length: len as u32,
+        flags: if write { CBW_FLAG_OUT } else { CBW_FLAG_IN },
+        lun: 0, cb_length: cb.len() as u8, cb: block,
+    };
     unsafe {
-        core::ptr::copy_nonoverlapping(
-            cbw as *const Cbw as *const u8,
-            dev.cbw_csw_phys as *mut u8,
-            31,
-        );
+        core::ptr::copy_nonoverlapping(&cbw as *const Cbw as *const u8, iu as *mut u8, 31);
     }
-    let sent = super::bulk_transfer(
+
+    let failed = |h: &BulkHandle| matches!(h, BulkHandle::Done(Err(_)));
+    let cmd = super::bulk_submit(
         dev.usb_addr, dev.controller, dev.speed,
-        dev.ep_out, dev.max_packet_out,
-        &mut dev.toggle_out,
-        dev.cbw_csw_phys, 31,
-    )?;
-    if sent < 31 { return Err("CBW short write"); }
-    Ok(())
+        dev.ep_out, dev.max_packet_out, &mut dev.toggle_out,
+        iu, 31,
+    );
+    let data_phys = dev.slot_phys(slot);
+    let data = if failed(&cmd) {
+        BulkHandle::Done(Err("CBW failed"))
+    } else if len == 0 {
+        BulkHandle::Done(Ok(0))
+    } else if write {
+        super::bulk_submit(
+            dev.usb_addr, dev.controller, dev.speed,
+            dev.ep_out, dev.max_packet_out, &mut dev.toggle_out,
+            data_phys, len,
+        )
+    } else {
+        super::bulk_submit(
+            dev.usb_addr, dev.controller, dev.speed,
+            dev.ep_in, dev.max_packet_in, &mut dev.toggle_in,
+            data_phys, len,
+        )
+    };
+    let status = if failed(&data) {
+        BulkHandle::Done(Err("data phase failed"))
+    } else {
+        super::bulk_submit(
+            dev.usb_addr, dev.controller, dev.speed,
+            dev.ep_in, dev.max_packet_in, &mut dev.toggle_in,
+            iu + STATUS_OFFSET, 13,
+        )
+    };
+    Command { tag, slot, write, cmd, data, status }
 }
 
-fn recv_csw(dev: &mut UsbStorageDevice, expected_tag: u32) -> Result<Csw, &'static str> {
-    // CSW at cbw_csw_phys + 64 (avoid overlap with CBW)
-    let csw_phys = dev.cbw_csw_phys + 64;
-    let read = super::bulk_transfer(
+/// UAS: the status and data transfers wait on stream `tag` before the
+/// command IU goes out, so the device can answer at once.
+fn submit_uas(dev: &mut UsbStorageDevice, cb: &[u8], write: bool, len: usize, slot: usize) -> Command {
+    let tag = slot as u32 + 1;
+    let iu = dev.iu_phys(slot);
+    let mut cmd_iu = [0u8; UAS_COMMAND_IU_LEN];
+    cmd_iu[0] = UAS_COMMAND_IU;
+    cmd_iu[2..4].copy_from_slice(&(tag as u16).to_be_bytes());
+    // Task attribute SIMPLE (0), LUN 0 at [8..16]
+    cmd_iu[16..16 + cb.len()].copy_from_slice(cb);
+    unsafe {
+        core::ptr::copy_nonoverlapping(cmd_iu.as_ptr(), iu as *mut u8, UAS_COMMAND_IU_LEN);
+        core::ptr::write_bytes((iu + STATUS_OFFSET) as *mut u8, 0, STATUS_MAX);
+    }
+
+    let failed = |h: &BulkHandle| matches!(h, BulkHandle::Done(Err(_)));
+    let stream = tag as u16;
+    let status = super::bulk_submit_stream(
         dev.usb_addr, dev.controller, dev.speed,
-        dev.ep_in, dev.max_packet_in,
-        &mut dev.toggle_in,
-        csw_phys, 13,
-    )?;
-    if read < 13 { return Err("CSW short read"); }
+        dev.ep_status, dev.max_packet_status, stream,
+        iu + STATUS_OFFSET, STATUS_MAX,
+    );
+    let data_phys = dev.slot_phys(slot);
+    let data = if failed(&status) {
+        BulkHandle::Done(Err("status pipe failed"))
+    } else if len == 0 {
+        BulkHandle::Done(Ok(0))
+    } else if write {
+        super::bulk_submit_stream(
+            dev.usb_addr, dev.controller, dev.speed,
+            dev.ep_out, dev.max_packet_out, stream,
+            data_phys, len,
+        )
+    } else {
+        super::bulk_submit_stream(
+            dev.usb_addr, dev.controller, dev.speed,
+            dev.ep_in, dev.max_packet_in, stream,
+            data_phys, len,
+        )
+    };
+    let cmd = if failed(&data) {
+        BulkHandle::Done(Err("data phase failed"))
+    } else {
+        let mut toggle = 0;
+        super::bulk_submit(
+            dev.usb_addr, dev.controller, dev.speed,
+            dev.ep_cmd, dev.max_packet_cmd, &mut toggle,
+            iu, UAS_COMMAND_IU_LEN,
+        )
+    };
+    Command { tag, slot, write, cmd, data, status }
+}
+
+/// Cancel everything queued on the device's pipes.
+fn flush_pipes(dev: &UsbStorageDevice) {
+    super::bulk_flush(dev.usb_addr, dev.controller, dev.ep_out);
+    super::bulk_flush(dev.usb_addr, dev.controller, dev.ep_in);
+    if dev.uas {
+        super::bulk_flush(dev.usb_addr, dev.controller, dev.ep_cmd);
+        super::bulk_flush(dev.usb_addr, dev.controller, dev.ep_status);
+    }
+}
+
+/// Wait for a command from [`submit`] and check its status. Returns the
+/// bytes of data moved. After the first failed transfer the rest are
+/// cancelled instead of timing out.
+fn finish(dev: &mut UsbStorageDevice, c: Command) -> Result<usize, &'static str> {
+    let (cmd_len, mut scratch) = (if dev.uas { UAS_COMMAND_IU_LEN } else { 31 }, 0u8);
+    let uas = dev.uas;
+
+    let cmd_toggle = if uas { &mut scratch } else { &mut dev.toggle_out };
+    let sent = super::bulk_wait(c.cmd, cmd_toggle);
+    let ok = matches!(sent, Ok(n) if n == cmd_len);
+    if !ok {
+        flush_pipes(dev);
+    }
+    let data_toggle = match (uas, c.write) {
+        (true, _) => &mut scratch,
+        (false, true) => &mut dev.toggle_out,
+        (false, false) => &mut dev.toggle_in,
+    };
+    let data = super::bulk_wait(c.data, data_toggle);
+    if ok && data.is_err() {
+        flush_pipes(dev);
+    }
+    let status_toggle = if uas { &mut scratch } else { &mut dev.toggle_in };
+    let read = super::bulk_wait(c.status, status_toggle);
+
+    match sent {
+        Ok(n) if n == cmd_len => {}
+        Ok(_) => return Err("command short write"),
+        Err(e) => return Err(e),
+    }
+    let moved = data?;
+    let read = read?;
+    let status_phys = dev.iu_phys(c.slot) + STATUS_OFFSET;
+    if uas {
+        check_sense_iu(dev, status_phys, read, c.tag)?;
+    } else {
+        if read < 13 { return Err("CSW short read"); }
+        check_csw(status_phys, c.tag)?;
+    }
+    Ok(moved)
+}
+
+fn check_csw(csw_phys: u64, expected_tag: u32) -> Result<Csw, &'static str> {
     let csw: Csw = unsafe { core::ptr::read_unaligned(csw_phys as *const Csw) };
     if csw.signature != CSW_SIGNATURE { return Err("CSW bad signature"); }
     if csw.tag != expected_tag { return Err("CSW tag mismatch"); }
@@ -155,185 +364,97 @@ fn recv_csw(dev: &mut UsbStorageDevice, expected_tag: u32) -> Result<Csw, &'stat
     Ok(csw)
 }
 
+/// Check the UAS status of a command: a sense IU with GOOD status. The
+/// sense data of a failed command is kept for REQUEST_SENSE.
+fn check_sense_iu(dev: &mut UsbStorageDevice, phys: u64, len: usize, tag: u32) -> Result<(), &'static str> {
+    let iu = unsafe { core::slice::from_raw_parts(phys as *const u8, STATUS_MAX) };
+    if len < 8 { return Err("UAS status short read"); }
+    if u16::from_be_bytes([iu[2], iu[3]]) as u32 != tag { return Err("UAS tag mismatch"); }
+    match iu[0] {
+        UAS_SENSE_IU if iu[6] == 0 => Ok(()),
+        UAS_SENSE_IU => {
+            let sense_len = (u16::from_be_bytes([iu[14], iu[15]]) as usize).min(18);
+            dev.sense = [0; 18];
+            dev.sense[..sense_len].copy_from_slice(&iu[16..16 + sense_len]);
+            Err("UAS command failed")
+        }
+        UAS_RESPONSE_IU => Err("UAS command rejected"),
+        _ => Err("UAS bad status IU"),
+    }
+}
+
 // ── SCSI Commands ────────────────────────────────
 
+/// Run a command with up to one bounce slot of data (slot 0); returns the
+/// bytes moved. Read data is left in the slot.
+fn scsi_exec(dev: &mut UsbStorageDevice, cb: &[u8], write: bool, len: usize) -> Result<usize, &'static str> {
+    let c = submit(dev, cb, write, len, 0);
+    finish(dev, c)
+}
+
+/// Copy `N` bytes of the data read into slot 0.
+fn slot_data<const N: usize>(dev: &UsbStorageDevice) -> [u8; N] {
+    let mut b = [0u8; N];
+    unsafe {
+        core::ptr::copy_nonoverlapping(dev.slot_phys(0) as *const u8, b.as_mut_ptr(), N);
+    }
+    b
+}
+
 fn scsi_test_unit_ready(dev: &mut UsbStorageDevice) -> Result<(), &'static str> {
-    let tag = dev.next_tag();
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: 0,
-        flags: CBW_FLAG_OUT, lun: 0, cb_length: 6,
-        cb: [SCSI_TEST_UNIT_READY, 0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0],
-    };
-    send_cbw(dev, &cbw)?;
-    recv_csw(dev, tag)?;
+    scsi_exec(dev, &[SCSI_TEST_UNIT_READY, 0, 0, 0, 0, 0], false, 0)?;
     Ok(())
 }
 
 fn scsi_inquiry(dev: &mut UsbStorageDevice) -> Result<[u8; 36], &'static str> {
-    let tag = dev.next_tag();
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: 36,
-        flags: CBW_FLAG_IN, lun: 0, cb_length: 6,
-        cb: [SCSI_INQUIRY, 0, 0, 0, 36, 0, 0,0,0,0,0,0,0,0,0,0],
-    };
-    send_cbw(dev, &cbw)?;
-    // Data phase: read 36 bytes into bounce buffer
-    super::bulk_transfer(
-        dev.usb_addr, dev.controller, dev.speed,
-        dev.ep_in, dev.max_packet_in,
-        &mut dev.toggle_in,
-        dev.bounce_phys, 36,
-    )?;
-    let mut result = [0u8; 36];
-    unsafe {
-        core::ptr::copy_nonoverlapping(dev.bounce_phys as *const u8, result.as_mut_ptr(), 36);
-    }
-    recv_csw(dev, tag)?;
-    Ok(result)
+    scsi_exec(dev, &[SCSI_INQUIRY, 0, 0, 0, 36, 0], false, 36)?;
+    Ok(slot_data(dev))
 }
 
 fn scsi_read_capacity(dev: &mut UsbStorageDevice) -> Result<(u32, u32), &'static str> {
-    let tag = dev.next_tag();
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: 8,
-        flags: CBW_FLAG_IN, lun: 0, cb_length: 10,
-        cb: [SCSI_READ_CAPACITY, 0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0],
-    };
-    send_cbw(dev, &cbw)?;
-    super::bulk_transfer(
-        dev.usb_addr, dev.controller, dev.speed,
-        dev.ep_in, dev.max_packet_in,
-        &mut dev.toggle_in,
-        dev.bounce_phys, 8,
-    )?;
-    let buf: [u8; 8] = unsafe {
-        let mut b = [0u8; 8];
-        core::ptr::copy_nonoverlapping(dev.bounce_phys as *const u8, b.as_mut_ptr(), 8);
-        b
-    };
-    recv_csw(dev, tag)?;
+    scsi_exec(dev, &[SCSI_READ_CAPACITY, 0, 0, 0, 0, 0, 0, 0, 0, 0], false, 8)?;
+    let buf: [u8; 8] = slot_data(dev);
     let last_lba = u32::from_be_bytes([buf[0], buf[1], buf[2], buf[3]]);
     let block_size = u32::from_be_bytes([buf[4], buf[5], buf[6], buf[7]]);
     Ok((last_lba.wrapping_add(1), block_size))
 }
 
-fn scsi_read_10(dev: &mut UsbStorageDevice, lba: u32, count: u16) -> Result<(), &'static str> {
-    let byte_count = count as u32 * dev.block_size;
-    let tag = dev.next_tag();
-    let mut cb = [0u8; 16];
-    cb[0] = SCSI_READ_10;
-    cb[2] = (lba >> 24) as u8;
-    cb[3] = (lba >> 16) as u8;
-    cb[4] = (lba >> 8) as u8;
-    cb[5] = lba as u8;
-    cb[7] = (count >> 8) as u8;
-    cb[8] = count as u8;
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: byte_count,
-        flags: CBW_FLAG_IN, lun: 0, cb_length: 10, cb,
-    };
-    send_cbw(dev, &cbw)?;
-
-    // Data phase: may need multiple bulk transfers
-    let mut received = 0usize;
-    while received < byte_count as usize {
-        let remaining = byte_count as usize - received;
-        let chunk = remaining.min(dev.max_packet_in as usize);
-        let got = super::bulk_transfer(
-            dev.usb_addr, dev.controller, dev.speed,
-            dev.ep_in, dev.max_packet_in,
-            &mut dev.toggle_in,
-            dev.bounce_phys + received as u64, chunk,
-        )?;
-        received += got;
-        if got < chunk { break; } // short packet
-    }
-
-    recv_csw(dev, tag)?;
-    Ok(())
-}
-
-fn scsi_write_10(dev: &mut UsbStorageDevice, lba: u32, count: u16) -> Result<(), &'static str> {
-    let byte_count = count as u32 * dev.block_size;
-    let tag = dev.next_tag();
-    let mut cb = [0u8; 16];
-    cb[0] = SCSI_WRITE_10;
-    cb[2] = (lba >> 24) as u8;
-    cb[3] = (lba >> 16) as u8;
-    cb[4] = (lba >> 8) as u8;
-    cb[5] = lba as u8;
-    cb[7] = (count >> 8) as u8;
-    cb[8] = count as u8;
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: byte_count,
-        flags: CBW_FLAG_OUT, lun: 0, cb_length: 10, cb,
-    };
-    send_cbw(dev, &cbw)?;
-
-    // Data phase: send data from bounce buffer
-    let mut sent = 0usize;
-    while sent < byte_count as usize {
-        let remaining = byte_count as usize - sent;
-        let chunk = remaining.min(dev.max_packet_out as usize);
-        let wrote = super::bulk_transfer(
-            dev.usb_addr, dev.controller, dev.speed,
-            dev.ep_out, dev.max_packet_out,
-            &mut dev.toggle_out,
-            dev.bounce_phys + sent as u64, chunk,
-        )?;
-        sent += wrote;
-        if wrote < chunk { break; }
-    }
-
-    recv_csw(dev, tag)?;
-    Ok(())
-}
-
 fn scsi_request_sense(dev: &mut UsbStorageDevice) -> Result<[u8; 18], &'static str> {
-    let tag = dev.next_tag();
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: 18,
-        flags: CBW_FLAG_IN, lun: 0, cb_length: 6,
-        cb: [SCSI_REQUEST_SENSE, 0, 0, 0, 18, 0, 0,0,0,0,0,0,0,0,0,0],
-    };
-    send_cbw(dev, &cbw)?;
-    super::bulk_transfer(
-        dev.usb_addr, dev.controller, dev.speed,
-        dev.ep_in, dev.max_packet_in,
-        &mut dev.toggle_in,
-        dev.bounce_phys, 18,
-    )?;
-    let mut result = [0u8; 18];
-    unsafe {
-        core::ptr::copy_nonoverlapping(dev.bounce_phys as *const u8, result.as_mut_ptr(), 18);
+    if dev.uas {
+        // Reported with the status of the failed command
+        return Ok(dev.sense);
     }
-    recv_csw(dev, tag)?;
-    Ok(result)
+    scsi_exec(dev, &[SCSI_REQUEST_SENSE, 0, 0, 0, 18, 0], false, 18)?;
+    Ok(slot_data(dev))
 }
 
 /// START STOP UNIT — start/stop the drive motor, or eject media.
 /// `start`: 1 = start motor, 0 = stop motor.
 /// `loej`: 1 = load/eject (with start=0 → eject, start=1 → load).
 fn scsi_start_stop_unit(dev: &mut UsbStorageDevice, start: bool, loej: bool) -> Result<(), &'static str> {
-    let tag = dev.next_tag();
     let byte4 = (start as u8) | ((loej as u8) << 1);
-    let cbw = Cbw {
-        signature: CBW_SIGNATURE, tag,
-        data_transfer_length: 0,
-        flags: CBW_FLAG_OUT, lun: 0, cb_length: 6,
-        cb: [SCSI_START_STOP_UNIT, 0, 0, 0, byte4, 0, 0,0,0,0,0,0,0,0,0,0],
-    };
-    send_cbw(dev, &cbw)?;
-    recv_csw(dev, tag)?;
+    scsi_exec(dev, &[SCSI_START_STOP_UNIT, 0, 0, 0, byte4, 0], false, 0)?;
     Ok(())
 }
 
+/// Queue READ(10) (`write` false) or WRITE(10) of `count` blocks at `lba`
+/// with its data in bounce slot `slot`.
+fn submit_rw(dev: &mut UsbStorageDevice, write: bool, lba: u32, count: u16, slot: usize) -> Command {
+    let mut cb = [0u8; 10];
+    cb[0] = if write { SCSI_WRITE_10 } else { SCSI_READ_10 };
+    cb[2..6].copy_from_slice(&lba.to_be_bytes());
+    cb[7..9].copy_from_slice(&count.to_be_bytes());
+    let len = count as usize * dev.block_size as usize;
+    submit(dev, &cb, write, len, slot)
+}
+
+/// Run a failed READ(10)/WRITE(10) once more after error recovery.
+fn retry_rw(dev: &mut UsbStorageDevice, write: bool, lba: u32, count: u16, slot: usize) -> bool {
+    error_recovery(dev);
+    let c = submit_rw(dev, write, lba, count, slot);
+    finish(dev, c).is_ok()
+}
+
 // ── Error Recovery ───────────────────────────────
 
 /// Bulk-Only Mass Storage Reset (class request 0xFF).
@@ -371,12 +492,25 @@ fn clear_halt(dev: &UsbStorageDevice, endpoint: u8) -> Result<(), &'static str>
     Ok(())
 }
 
-/// Full BOT error recovery sequence:
+/// Error recovery before a retry.
+///
+/// Bulk-Only:
 /// 1. Bulk-Only Mass Storage Reset
 /// 2. CLEAR_FEATURE(ENDPOINT_HALT) on bulk IN
 /// 3. CLEAR_FEATURE(ENDPOINT_HALT) on bulk OUT
 /// 4. Reset data toggles
-fn bot_error_recovery(dev: &mut UsbStorageDevice) {
+///
+/// UAS has no class reset: cancel what is queued and unstall all four
+/// pipes.
+fn error_recovery(dev: &mut UsbStorageDevice) {
+    if dev.uas {
+        crate::serial_println!("  USB Storage: UAS error recovery (disk {})", dev.disk_id);
+        flush_pipes(dev);
+        for ep in [dev.ep_cmd, dev.ep_status, dev.ep_in, dev.ep_out] {
+            let _ = clear_halt(dev, ep);
+        }
+        return;
+    }
     crate::serial_println!("  USB Storage: BOT error recovery (disk {})", dev.disk_id);
     let _ = bot_reset(dev);
     let _ = clear_halt(dev, dev.ep_in);
@@ -387,6 +521,23 @@ fn bot_error_recovery(dev: &mut UsbStorageDevice) {
 
 // ── Block Device Read/Write Dispatch ─────────────
 
+/// A READ(10)/WRITE(10) of the pipeline.
+struct Queued {
+    cmd: Command,
+    lba: u32,
+    count: u32,
+    /// Submission number; the bounce slot is `seq % BOUNCE_SLOTS`.
+    seq: usize,
+}
+
+/// Cancel the commands queued behind a failed one.
+fn abort_queued(dev: &mut UsbStorageDevice, inflight: &mut VecDeque<Queued>) {
+    flush_pipes(dev);
+    while let Some(q) = inflight.pop_front() {
+        let _ = finish(dev, q.cmd);
+    }
+}
+
 /// Read sectors from a USB storage device. Registered as I/O override.
 pub fn usb_storage_read(disk_id: u8, lba: u32, count: u32, buf: &mut [u8]) -> bool {
     let mut devs = USB_STORAGE_DEVICES.lock();
@@ -396,33 +547,47 @@ pub fn usb_storage_read(disk_id: u8, lba: u32, count: u32, buf: &mut [u8]) -> bo
     };
 
     let bs = dev.block_size as usize;
-    let max_sectors = (BOUNCE_SIZE / bs) as u32;
-    let mut offset = 0usize;
-    let mut remaining = count;
-    let mut cur_lba = lba;
-
-    while remaining > 0 {
-        let batch = remaining.min(max_sectors);
-        let mut ok = false;
-        for _retry in 0..2 {
-            if scsi_read_10(dev, cur_lba, batch as u16).is_ok() {
-                ok = true;
-                break;
+    let max_sectors = (BOUNCE_SLOT / bs) as u32;
+    let depth = dev.depth();
+    let mut inflight: VecDeque<Queued> = VecDeque::with_capacity(depth);
+    let mut next_lba = lba;
+    let mut seq = 0usize;
+    let end = lba + count;
+
+    let fill = |dev: &mut UsbStorageDevice, inflight: &mut VecDeque<Queued>, next_lba: &mut u32, seq: &mut usize| {
+        while inflight.len() < depth && *next_lba < end {
+            let n = (end - *next_lba).min(max_sectors);
+            let cmd = submit_rw(dev, false, *next_lba, n as u16, *seq % BOUNCE_SLOTS);
+            inflight.push_back(Queued { cmd, lba: *next_lba, count: n, seq: *seq });
+            *next_lba += n;
+            *seq += 1;
+        }
+    };
+
+    fill(dev, &mut inflight, &mut next_lba, &mut seq);
+    while let Some(q) = inflight.pop_front() {
+        let slot = q.seq % BOUNCE_SLOTS;
+        if finish(dev, q.cmd).is_err() {
+            // Drop the commands behind it and go on after the retry
+            abort_queued(dev, &mut inflight);
+            if !retry_rw(dev, false, q.lba, q.count as u16, slot) {
+                return false;
             }
-            bot_error_recovery(dev);
+            next_lba = q.lba + q.count;
+            seq = q.seq + 1;
         }
-        if !ok { return false; }
-        let bytes = batch as usize * bs;
+
+        // Keep the pipeline full, then copy this one
+        fill(dev, &mut inflight, &mut next_lba, &mut seq);
+        let offset = (q.lba - lba) as usize * bs;
+        let bytes = q.count as usize * bs;
         unsafe {
             core::ptr::copy_nonoverlapping(
-                dev.bounce_phys as *const u8,
+                dev.slot_phys(slot) as *const u8,
                 buf[offset..].as_mut_ptr(),
                 bytes,
             );
         }
-        offset += bytes;
-        cur_lba += batch;
-        remaining -= batch;
     }
     true
 }
@@ -441,47 +606,82 @@ pub fn usb_storage_write(disk_id: u8, lba: u32, count: u32, buf: &[u8]) -> bool
     };
 
     let bs = dev.block_size as usize;
-    let max_sectors = (BOUNCE_SIZE / bs) as u32;
-    let mut offset = 0usize;
-    let mut remaining = count;
-    let mut cur_lba = lba;
-
-    while remaining > 0 {
-        let batch = remaining.min(max_sectors);
-        let bytes = batch as usize * bs;
+    let max_sectors = (BOUNCE_SLOT / bs) as u32;
+    let depth = dev.depth();
+    let mut inflight: VecDeque<Queued> = VecDeque::with_capacity(depth);
+    let mut next_lba = lba;
+    let mut seq = 0usize;
+    let end = lba + count;
+    // The next command's data is already in its slot
+    let mut staged = false;
+
+    let stage = |dev: &UsbStorageDevice, next_lba: u32, seq: usize| {
+        let n = (end - next_lba).min(max_sectors);
+        let offset = (next_lba - lba) as usize * bs;
         unsafe {
             core::ptr::copy_nonoverlapping(
                 buf[offset..].as_ptr(),
-                dev.bounce_phys as *mut u8,
-                bytes,
+                dev.slot_phys(seq % BOUNCE_SLOTS) as *mut u8,
+                n as usize * bs,
             );
         }
-        let mut ok = false;
-        for _retry in 0..2 {
-            if scsi_write_10(dev, cur_lba, batch as u16).is_ok() {
-                ok = true;
-                break;
+    };
+
+    loop {
+        while inflight.len() < depth && next_lba < end {
+            if !staged {
+                stage(dev, next_lba, seq);
             }
-            // Re-copy data to bounce buffer after recovery (toggles reset)
-            unsafe {
-                core::ptr::copy_nonoverlapping(
-                    buf[offset..].as_ptr(),
-                    dev.bounce_phys as *mut u8,
-                    bytes,
-                );
+            staged = false;
+            let n = (end - next_lba).min(max_sectors);
+            let cmd = submit_rw(dev, true, next_lba, n as u16, seq % BOUNCE_SLOTS);
+            inflight.push_back(Queued { cmd, lba: next_lba, count: n, seq });
+            next_lba += n;
+            seq += 1;
+        }
+        let Some(q) = inflight.pop_front() else { break };
+
+        // Fill the next slot while the queued commands transfer
+        if !staged && next_lba < end {
+            stage(dev, next_lba, seq);
+            staged = true;
+        }
+
+        if finish(dev, q.cmd).is_err() {
+            abort_queued(dev, &mut inflight);
+            if !retry_rw(dev, true, q.lba, q.count as u16, q.seq % BOUNCE_SLOTS) {
+                return false;
             }
-            bot_error_recovery(dev);
+            // The slots behind it are refilled from `buf`
+            next_lba = q.lba + q.count;
+            seq = q.seq + 1;
+            staged = false;
         }
-        if !ok { return false; }
-        offset += bytes;
-        cur_lba += batch;
-        remaining -= batch;
     }
     true
 }
 
 // ── Probe + Initialization ───────────────────────
 
+/// The UAS pipe of `iface` with usage `pipe`.
+fn uas_pipe(iface: &UsbInterface, pipe: u8) -> Option<&super::UsbEndpoint> {
+    iface.endpoints.iter().find(|ep| ep.uas_pipe == pipe && (ep.attributes & 0x03) == 2)
+}
+
+/// Whether the UAS alternate `iface` can be driven: the host runs bulk
+/// streams for the device and all four pipes have enough of them.
+/// Without streams (high speed) the Bulk-Only alternate is used.
+fn uas_usable(dev: &UsbDevice, iface: &UsbInterface) -> bool {
+    if iface.protocol != 0x62 || !super::host(dev.controller).supports_streams(dev.address) {
+        return false;
+    }
+    let streams = |pipe| uas_pipe(iface, pipe).map_or(false, |ep| ep.max_streams >= UAS_MIN_STREAMS);
+    uas_pipe(iface, UAS_PIPE_COMMAND).is_some()
+        && streams(UAS_PIPE_STATUS)
+        && streams(UAS_PIPE_DATA_IN)
+        && streams(UAS_PIPE_DATA_OUT)
+}
+
 /// Called when a mass storage interface is detected during USB enumeration.
 pub fn probe(dev: &UsbDevice, iface: &UsbInterface) {
     let subclass_desc = match iface.subclass {
@@ -509,16 +709,42 @@ pub fn probe(dev: &UsbDevice, iface: &UsbInterface) {
         dev.address,
     );
 
-    // Find bulk IN and bulk OUT endpoints
-    let bulk_in = iface.endpoints.iter().find(|ep| {
-        (ep.attributes & 0x03) == 2    // Bulk transfer type
-            && (ep.address & 0x80) != 0 // IN direction
-    });
+    // UAS devices offer Bulk-Only and UAS as alternates of one interface;
+    // exactly one of them is driven
+    let uas = iface.protocol == 0x62;
+    if uas && !uas_usable(dev, iface) {
+        crate::serial_println!("  USB Storage: UAS needs SuperSpeed bulk streams, using Bulk-Only");
+        return;
+    }
+    if !uas && dev.interfaces.iter().any(|i| i.number == iface.number && uas_usable(dev, i)) {
+        crate::serial_println!("  USB Storage: using the UAS alternate setting");
+        return;
+    }
 
-    let bulk_out = iface.endpoints.iter().find(|ep| {
-        (ep.attributes & 0x03) == 2    // Bulk transfer type
-            && (ep.address & 0x80) == 0 // OUT direction
-    });
+    // Support SCSI transparent (0x06) and ATAPI (0x02) with Bulk-Only
+    // (0x50) or UAS (0x62)
+    if (iface.subclass != 0x06 && iface.subclass != 0x02) || (iface.protocol != 0x50 && !uas) {
+        crate::serial_println!(
+            "  USB Storage: unsupported subclass/protocol combination"
+        );
+        return;
+    }
+
+    // Find bulk IN and bulk OUT endpoints (UAS: the data pipes)
+    let (bulk_in, bulk_out) = if uas {
+        (uas_pipe(iface, UAS_PIPE_DATA_IN), uas_pipe(iface, UAS_PIPE_DATA_OUT))
+    } else {
+        (
+            iface.endpoints.iter().find(|ep| {
+                (ep.attributes & 0x03) == 2    // Bulk transfer type
+                    && (ep.address & 0x80) != 0 // IN direction
+            }),
+            iface.endpoints.iter().find(|ep| {
+                (ep.attributes & 0x03) == 2    // Bulk transfer type
+                    && (ep.address & 0x80) == 0 // OUT direction
+            }),
+        )
+    };
 
     let (ep_in, ep_out) = match (bulk_in, bulk_out) {
         (Some(i), Some(o)) => {
@@ -534,18 +760,23 @@ pub fn probe(dev: &UsbDevice, iface: &UsbInterface) {
             return;
         }
     };
-
-    // Support SCSI transparent (0x06) and ATAPI (0x02) with Bulk-Only (0x50)
-    if (iface.subclass != 0x06 && iface.subclass != 0x02) || iface.protocol != 0x50 {
-        crate::serial_println!(
-            "  USB Storage: unsupported subclass/protocol combination"
-        );
-        return;
-    }
+    let (ep_cmd, ep_status) = match (uas_pipe(iface, UAS_PIPE_COMMAND), uas_pipe(iface, UAS_PIPE_STATUS)) {
+        (Some(c), Some(s)) if uas => ((c.address, c.max_packet_size), (s.address, s.max_packet_size)),
+        _ => ((0, 0), (0, 0)),
+    };
 
     let is_atapi_subclass = iface.subclass == 0x02;
 
-    // Allocate DMA memory for CBW/CSW (1 page, identity-mapped)
+    if uas {
+        // Switch to the UAS alternate (the host sets up the streams)
+        let host = super::host(dev.controller);
+        if let Err(e) = host.set_interface(dev.address, dev.speed, dev.max_packet_size, iface) {
+            crate::serial_println!("  USB Storage: UAS SET_INTERFACE failed: {}", e);
+            return;
+        }
+    }
+
+    // Allocate DMA memory for command/status IUs (1 page, identity-mapped)
     let cbw_csw_phys = match physical::alloc_frame() {
         Some(f) => f.as_u64(),
         None => {
@@ -556,7 +787,7 @@ pub fn probe(dev: &UsbDevice, iface: &UsbInterface) {
     // Zero the page
     unsafe { core::ptr::write_bytes(cbw_csw_phys as *mut u8, 0, 4096); }
 
-    // Allocate bounce buffer (16 contiguous pages = 64 KiB)
+    // Allocate bounce buffer (128 contiguous pages = 512 KiB)
     let bounce_phys = match physical::alloc_contiguous(BOUNCE_PAGES) {
         Some(p) => p.as_u64(),
         None => {
@@ -577,6 +808,12 @@ pub fn probe(dev: &UsbDevice, iface: &UsbInterface) {
         max_packet_out: ep_out.max_packet_size,
         toggle_in: 0,
         toggle_out: 0,
+        uas,
+        ep_cmd: ep_cmd.0,
+        ep_status: ep_status.0,
+        max_packet_cmd: ep_cmd.1,
+        max_packet_status: ep_status.1,
+        sense: [0; 18],
         tag: 1,
         block_count: 0,
         block_size: 512,
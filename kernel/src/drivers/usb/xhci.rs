@@ -0,0 +1,1796 @@
+//! xHCI (eXtensible Host Controller Interface) driver — USB 3.x.
+//!
+//! MMIO-based controller for every speed from low to SuperSpeed on its own
+//! root ports (no companion controllers). Uses BAR0 for register access.
+//!
+//! The controller is driven through rings of TRBs in memory:
+//!
+//! - a command ring (Enable Slot, Address Device, Configure Endpoint, ...),
+//!   one command at a time;
+//! - one event ring on interrupter 0 (MSI-X, else MSI, else INTx), on
+//!   which commands and transfers complete;
+//! - a transfer ring per endpoint, or a ring per stream for bulk endpoints
+//!   with streams (UAS). Several transfers may be queued on a ring.
+//!
+//! Every device gets a slot with an output (device) context the controller
+//! maintains and an input context for commands. The controller assigns
+//! the USB address itself, so class drivers see the slot ID as the device
+//! address. Devices behind hubs are addressed by route string, and low or
+//! full speed ones below a high-speed hub through the hub's TT.
+//!
+//! Waiters block on their command or transfer until the IRQ handler
+//! consumes its event (polled during boot or without an IRQ), as in the
+//! EHCI bulk queues. Port hot-plug is polled.
+
+use crate::arch::x86::pit::delay_ms;
+use crate::drivers::pci::{PciDevice, pci_config_read32, pci_config_write32};
+use crate::memory::address::PhysAddr;
+use crate::memory::physical;
+use crate::memory::virtual_mem;
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+use alloc::vec::Vec;
+use core::sync::atomic::Ordering;
+use super::*;
+
+/// Registers mapped: capability, operational, runtime and doorbells.
+const XHCI_MMIO_PAGES: usize = 16; // 64 KiB
+/// Device slots enabled (the controller may offer up to 255).
+const MAX_SLOTS: u8 = 64;
+
+// ── Capability Register Offsets ────────────────
+
+const CAP_CAPLENGTH: u32 = 0x00;  // 8-bit
+const CAP_HCSPARAMS1: u32 = 0x04;
+const CAP_HCSPARAMS2: u32 = 0x08;
+const CAP_HCCPARAMS1: u32 = 0x10;
+const CAP_DBOFF: u32 = 0x14;
+const CAP_RTSOFF: u32 = 0x18;
+
+// HCCPARAMS1 bits
+const HCC_CSZ: u32 = 1 << 2;  // 64-byte contexts
+const HCC_PPC: u32 = 1 << 3;  // Port Power Control
+
+// ── Operational Register Offsets (from op base) ──
+
+const OP_USBCMD: u32 = 0x00;
+const OP_USBSTS: u32 = 0x04;
+const OP_CRCR: u32 = 0x18;
+const OP_DCBAAP: u32 = 0x30;
+const OP_CONFIG: u32 = 0x38;
+const OP_PORTSC_BASE: u32 = 0x400; // + 0x10 per port
+
+// USBCMD bits
+const CMD_RUN: u32 = 1 << 0;
+const CMD_HCRST: u32 = 1 << 1;
+const CMD_INTE: u32 = 1 << 2;
+
+// USBSTS bits
+const STS_HCH: u32 = 1 << 0;  // HC Halted
+const STS_EINT: u32 = 1 << 3; // Event Interrupt
+const STS_CNR: u32 = 1 << 11; // Controller Not Ready
+
+// PORTSC bits
+const PORTSC_CCS: u32 = 1 << 0;   // Current Connect Status
+const PORTSC_PED: u32 = 1 << 1;   // Port Enabled (write 1 disables)
+const PORTSC_PR: u32 = 1 << 4;    // Port Reset
+const PORTSC_PP: u32 = 1 << 9;    // Port Power
+const PORTSC_SPEED_SHIFT: u32 = 10;
+const PORTSC_CSC: u32 = 1 << 17;  // Connect Status Change
+const PORTSC_PRC: u32 = 1 << 21;  // Port Reset Change
+/// Change bits (write 1 to clear).
+const PORTSC_CHANGES: u32 = 0x7F << 17;
+/// Bits written back unchanged; everything else is written as 0.
+const PORTSC_KEEP: u32 = PORTSC_PP | (7 << 25); // PP, wake enables
+
+// ── Runtime Registers (interrupter 0) ──────────
+
+const IR0: u32 = 0x20;
+const IR_IMAN: u32 = IR0;
+const IR_IMOD: u32 = IR0 + 0x04;
+const IR_ERSTSZ: u32 = IR0 + 0x08;
+const IR_ERSTBA: u32 = IR0 + 0x10;
+const IR_ERDP: u32 = IR0 + 0x18;
+
+const IMAN_IP: u32 = 1 << 0;
+const IMAN_IE: u32 = 1 << 1;
+const ERDP_EHB: u64 = 1 << 3;
+/// Interrupt moderation: 40 µs (250 ns units).
+const IMOD_INTERVAL: u32 = 160;
+
+// ── TRBs ───────────────────────────────────────
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct Trb {
+    param: u64,
+    status: u32,
+    control: u32,
+}
+
+impl Trb {
+    const EMPTY: Trb = Trb { param: 0, status: 0, control: 0 };
+}
+
+// TRB control bits
+const TRB_CYCLE: u32 = 1 << 0;
+const LINK_TC: u32 = 1 << 1;     // Link: toggle cycle
+const TRB_ISP: u32 = 1 << 2;     // Interrupt on Short Packet
+const TRB_CHAIN: u32 = 1 << 4;
+const TRB_IOC: u32 = 1 << 5;     // Interrupt On Completion
+const TRB_IDT: u32 = 1 << 6;     // Immediate Data
+const TRB_DIR_IN: u32 = 1 << 16; // Data/Status stage direction
+
+// TRB types
+const TRB_NORMAL: u32 = 1;
+const TRB_SETUP: u32 = 2;
+const TRB_DATA: u32 = 3;
+const TRB_STATUS: u32 = 4;
+const TRB_LINK: u32 = 6;
+const TRB_ENABLE_SLOT: u32 = 9;
+const TRB_DISABLE_SLOT: u32 = 10;
+const TRB_ADDRESS_DEVICE: u32 = 11;
+const TRB_CONFIGURE_EP: u32 = 12;
+const TRB_EVALUATE_CTX: u32 = 13;
+const TRB_RESET_EP: u32 = 14;
+const TRB_STOP_EP: u32 = 15;
+const TRB_SET_TR_DEQUEUE: u32 = 16;
+const EV_TRANSFER: u32 = 32;
+const EV_COMMAND: u32 = 33;
+
+// Completion codes
+const CC_SUCCESS: u8 = 1;
+const CC_STALL: u8 = 6;
+const CC_SHORT_PACKET: u8 = 13;
+const CC_STOPPED: u8 = 26;
+const CC_STOPPED_LENGTH: u8 = 27;
+
+#[inline]
+fn trb_type(t: u32) -> u32 {
+    t << 10
+}
+
+/// Control word of a command on an endpoint.
+#[inline]
+fn ep_command(t: u32, slot_id: u8, dci: u8) -> u32 {
+    trb_type(t) | (slot_id as u32) << 24 | (dci as u32) << 16
+}
+
+/// Device context index of an endpoint address (EP0 is 1).
+#[inline]
+fn ep_dci(endpoint: u8) -> u8 {
+    (endpoint & 0x0F) * 2 + (endpoint >> 7)
+}
+
+// ── Rings ──────────────────────────────────────
+
+/// TRBs per ring page; the last one links back to the first.
+const RING_TRBS: usize = 256;
+/// TRBs per event ring segment (one page).
+const EVENT_TRBS: usize = 256;
+/// TRBs of one TD at most (a transfer up to 1 MiB).
+const MAX_TD_TRBS: usize = 16;
+/// A Normal TRB must not cross a 64 KiB boundary.
+const TRB_MAX_BYTES: u64 = 0x10000;
+/// Stream context type "primary transfer ring" (Set TR Dequeue, stream array).
+const SCT_PRIMARY: u64 = 1 << 1;
+
+#[inline]
+fn trb_ptr(ring_phys: u64, i: usize) -> *mut Trb {
+    (ring_phys + (i * 16) as u64) as *mut Trb
+}
+
+/// Zeroed DMA page.
+fn alloc_page() -> Option<u64> {
+    let phys = physical::alloc_contiguous(1)?.as_u64();
+    unsafe { core::ptr::write_bytes(phys as *mut u8, 0, 4096); }
+    Some(phys)
+}
+
+fn free_page(phys: u64) {
+    if phys != 0 {
+        physical::free_contiguous(PhysAddr(phys), 1);
+    }
+}
+
+/// A command or transfer ring: one page of TRBs, the last one a link back
+/// to the start that toggles the producer cycle state.
+struct Ring {
+    phys: u64,
+    /// Next TRB to write.
+    enqueue: usize,
+    cycle: bool,
+}
+
+impl Ring {
+    fn alloc() -> Option<Ring> {
+        let phys = alloc_page()?;
+        unsafe {
+            let link = trb_ptr(phys, RING_TRBS - 1);
+            (*link).param = phys;
+            (*link).control = trb_type(TRB_LINK) | LINK_TC;
+        }
+        Some(Ring { phys, enqueue: 0, cycle: true })
+    }
+
+    /// Write a TRB at the enqueue pointer and return its index. With `hold`
+    /// the controller does not own it until [`Ring::release`].
+    fn push(&mut self, trb: &Trb, hold: bool) -> usize {
+        let i = self.enqueue;
+        let cycle = (self.cycle != hold) as u32;
+        unsafe {
+            let p = trb_ptr(self.phys, i);
+            core::ptr::write_volatile(&mut (*p).param, trb.param);
+            core::ptr::write_volatile(&mut (*p).status, trb.status);
+            core::sync::atomic::fence(Ordering::Release);
+            core::ptr::write_volatile(&mut (*p).control, (trb.control & !TRB_CYCLE) | cycle);
+        }
+        self.enqueue += 1;
+        if self.enqueue == RING_TRBS - 1 {
+            // A TD going on past the link keeps its chain through it
+            let control = trb_type(TRB_LINK) | LINK_TC | (trb.control & TRB_CHAIN) | self.cycle as u32;
+            unsafe {
+                core::ptr::write_volatile(&mut (*trb_ptr(self.phys, RING_TRBS - 1)).control, control);
+            }
+            self.cycle = !self.cycle;
+            self.enqueue = 0;
+        }
+        i
+    }
+
+    /// Hand a TRB written with `hold` to the controller.
+    fn release(&self, i: usize) {
+        core::sync::atomic::fence(Ordering::SeqCst);
+        unsafe {
+            let p = trb_ptr(self.phys, i);
+            let control = core::ptr::read_volatile(&(*p).control);
+            core::ptr::write_volatile(&mut (*p).control, control ^ TRB_CYCLE);
+        }
+    }
+
+    /// Dequeue pointer (with cycle state) just past everything written.
+    fn dequeue_ptr(&self) -> u64 {
+        (self.phys + (self.enqueue * 16) as u64) | self.cycle as u64
+    }
+}
+
+// ── Devices ────────────────────────────────────
+
+/// A configured endpoint of a device.
+struct Endpoint {
+    dci: u8,
+    /// Interface the endpoint belongs to (EP0: 0xFF).
+    iface: u8,
+    /// One ring, or with streams the ring of stream `i + 1` at `i`.
+    rings: Vec<Ring>,
+    streams: bool,
+    /// Stream context array (0 without streams).
+    stream_array: u64,
+    /// Halted by an error; reset before it takes transfers again.
+    halted: bool,
+}
+
+impl Endpoint {
+    fn ring(&mut self, stream: u16) -> Option<&mut Ring> {
+        match (self.streams, stream) {
+            (false, 0) => self.rings.get_mut(0),
+            (true, s) if s > 0 => self.rings.get_mut(s as usize - 1),
+            _ => None,
+        }
+    }
+
+    fn free(&self) {
+        for r in &self.rings {
+            free_page(r.phys);
+        }
+        free_page(self.stream_array);
+    }
+}
+
+struct Device {
+    slot_id: u8,
+    speed: UsbSpeed,
+    root_port: u8,
+    route: u32,
+    /// Hubs between the device and its root port.
+    depth: u8,
+    /// Slot and port of the high-speed hub whose TT serves the device.
+    tt: Option<(u8, u8)>,
+    /// Output context, maintained by the controller.
+    out_ctx: u64,
+    /// Input context for commands.
+    in_ctx: u64,
+    /// Data stage buffer of control transfers.
+    ctrl_buf: u64,
+    /// A control transfer owns `ctrl_buf` and EP0.
+    ctrl_busy: bool,
+    eps: Vec<Endpoint>,
+}
+
+// ── Controller State ───────────────────────────
+
+/// Transfers in flight on all endpoints together.
+const MAX_TRANSFERS: usize = 64;
+/// Give up on a command after this long (ms).
+const COMMAND_TIMEOUT_MS: u32 = 5000;
+/// Give up on a control transfer after this long (ms).
+const CONTROL_TIMEOUT_MS: u32 = 1000;
+/// Give up on a bulk transfer after this long (ms).
+const BULK_TIMEOUT_MS: u32 = 5000;
+/// Polls before timing out when the tick counter is not running yet.
+const TIMEOUT_POLLS: u32 = 10_000_000;
+/// Polls before a thread that can sleep blocks.
+const SPIN_POLLS: u32 = 2_000;
+/// A blocked waiter re-checks at least this often (ms).
+const BLOCK_SLICE_MS: u32 = 10;
+/// Stream IDs per UAS endpoint at most (stream array entries).
+const MAX_STREAMS: usize = 16;
+
+#[derive(Clone, Copy, PartialEq)]
+enum SlotState {
+    Free,
+    Busy,
+    Done,
+}
+
+/// A transfer (one TD), from submit until its waiter collects the result.
+#[derive(Clone, Copy)]
+struct Xfer {
+    state: SlotState,
+    slot_id: u8,
+    dci: u8,
+    /// Page of the ring the TD is on.
+    ring_phys: u64,
+    /// Ring index and bytes of each TRB of the TD.
+    trbs: [(u16, u32); MAX_TD_TRBS],
+    count: usize,
+    /// Control transfer: a short data stage completes with the status stage.
+    control: bool,
+    short: Option<usize>,
+    result: Result<usize, &'static str>,
+    /// TID blocked on this transfer (0 = nobody).
+    waiter: u32,
+}
+
+const FREE_XFER: Xfer = Xfer {
+    state: SlotState::Free,
+    slot_id: 0,
+    dci: 0,
+    ring_phys: 0,
+    trbs: [(0, 0); MAX_TD_TRBS],
+    count: 0,
+    control: false,
+    short: None,
+    result: Ok(0),
+    waiter: 0,
+};
+
+/// The command in flight (one at a time).
+struct Command {
+    state: SlotState,
+    trb_phys: u64,
+    code: u8,
+    slot_id: u8,
+    waiter: u32,
+}
+
+/// Who to publish as the waiter while blocking.
+#[derive(Clone, Copy)]
+enum Waiter {
+    Nobody,
+    Command,
+    Transfer(usize),
+}
+
+struct Xhci {
+    op: u64,
+    rt: u64,
+    db: u64,
+    /// Context entry size (32 or 64 bytes).
+    ctx_size: usize,
+    n_ports: u8,
+    /// Stream context array entries the controller supports (0 = none).
+    max_streams: usize,
+    dcbaa_phys: u64,
+    cmd_ring: Ring,
+    event_phys: u64,
+    event_dequeue: usize,
+    event_cycle: bool,
+    /// Completions are signalled by the IRQ handler.
+    irq_enabled: bool,
+    cmd: Command,
+    devices: Vec<Device>,
+    xfers: [Xfer; MAX_TRANSFERS],
+    port_connected: Vec<bool>,
+}
+
+/// Controller state, shared by submitters, waiters and the IRQ handler.
+/// Never held across a wait, so port polling enumerates without it.
+static XHCI: Spinlock<Option<Xhci>> = Spinlock::new(None);
+
+fn mmio_read32(base: u64, offset: u32) -> u32 {
+    unsafe { core::ptr::read_volatile((base + offset as u64) as *const u32) }
+}
+
+fn mmio_write32(base: u64, offset: u32, val: u32) {
+    unsafe { core::ptr::write_volatile((base + offset as u64) as *mut u32, val) }
+}
+
+fn mmio_write64(base: u64, offset: u32, val: u64) {
+    mmio_write32(base, offset, val as u32);
+    mmio_write32(base, offset + 4, (val >> 32) as u32);
+}
+
+/// Run `f` on the controller state, if there is a controller.
+fn with<R>(f: impl FnOnce(&mut Xhci) -> R) -> Option<R> {
+    XHCI.lock().as_mut().map(f)
+}
+
+/// Whether the caller may yield or block.
+#[inline]
+fn can_sleep() -> bool {
+    scheduler::current_tid() != 0 && crate::arch::hal::interrupts_enabled()
+}
+
+/// Wake `tid`; from IRQ context without spinning on SCHEDULER.
+#[inline]
+fn wake(tid: u32, in_irq: bool) {
+    if !in_irq {
+        scheduler::wake_thread(tid);
+    } else if !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
+
+impl Xhci {
+    fn device(&self, slot_id: u8) -> Option<&Device> {
+        self.devices.iter().find(|d| d.slot_id == slot_id)
+    }
+
+    fn device_mut(&mut self, slot_id: u8) -> Option<&mut Device> {
+        self.devices.iter_mut().find(|d| d.slot_id == slot_id)
+    }
+
+    fn endpoint_mut(&mut self, slot_id: u8, dci: u8) -> Option<&mut Endpoint> {
+        self.device_mut(slot_id)?.eps.iter_mut().find(|e| e.dci == dci)
+    }
+
+    /// Context `i` of a context page (output: 0 = slot, DCI = endpoint;
+    /// input: 0 = control, 1 = slot, DCI + 1 = endpoint).
+    fn ctx(&self, page: u64, i: usize) -> *mut u32 {
+        (page + (i * self.ctx_size) as u64) as *mut u32
+    }
+
+    /// Clear the input context of `dev` and copy its slot context in.
+    fn prepare_input(&self, dev: &Device) {
+        unsafe {
+            core::ptr::write_bytes(dev.in_ctx as *mut u8, 0, 4096);
+            core::ptr::copy_nonoverlapping(
+                self.ctx(dev.out_ctx, 0) as *const u8,
+                self.ctx(dev.in_ctx, 1) as *mut u8,
+                self.ctx_size,
+            );
+        }
+    }
+
+    fn waiter_mut(&mut self, w: Waiter) -> Option<&mut u32> {
+        match w {
+            Waiter::Nobody => None,
+            Waiter::Command => Some(&mut self.cmd.waiter),
+            Waiter::Transfer(xi) => Some(&mut self.xfers[xi].waiter),
+        }
+    }
+
+    fn ring_doorbell(&self, slot_id: u8, target: u32) {
+        core::sync::atomic::fence(Ordering::SeqCst);
+        mmio_write32(self.db, slot_id as u32 * 4, target);
+    }
+
+    fn complete(&mut self, xi: usize, result: Result<usize, &'static str>, in_irq: bool) {
+        let x = &mut self.xfers[xi];
+        x.result = result;
+        x.state = SlotState::Done;
+        let tid = core::mem::replace(&mut x.waiter, 0);
+        if tid != 0 {
+            wake(tid, in_irq);
+        }
+    }
+
+    /// Fail every transfer queued on an endpoint.
+    fn fail_endpoint(&mut self, slot_id: u8, dci: u8, err: &'static str, in_irq: bool) {
+        for xi in 0..MAX_TRANSFERS {
+            let x = &self.xfers[xi];
+            if x.state == SlotState::Busy && x.slot_id == slot_id && x.dci == dci {
+                self.complete(xi, Err(err), in_irq);
+            }
+        }
+    }
+
+    /// TRBs of the transfers queued on a ring.
+    fn ring_used(&self, ring_phys: u64) -> usize {
+        self.xfers.iter()
+            .filter(|x| x.state == SlotState::Busy && x.ring_phys == ring_phys)
+            .map(|x| x.count)
+            .sum()
+    }
+
+    /// Queue a TD on an endpoint (stream 0: no streams) and ring its
+    /// doorbell. The first TRB is handed over last. Returns the transfer.
+    fn queue_td(
+        &mut self,
+        slot_id: u8,
+        dci: u8,
+        stream: u16,
+        trbs: &[Trb],
+        control: bool,
+    ) -> Result<usize, &'static str> {
+        let xi = self.xfers.iter().position(|x| x.state == SlotState::Free)
+            .ok_or("xHCI: too many transfers")?;
+        let ring_phys = {
+            let ep = self.endpoint_mut(slot_id, dci).ok_or("xHCI: endpoint not configured")?;
+            if ep.halted {
+                return Err("xHCI: endpoint halted");
+            }
+            ep.ring(stream).ok_or("xHCI: no such stream")?.phys
+        };
+        if self.ring_used(ring_phys) + trbs.len() > RING_TRBS - 2 {
+            return Err("xHCI: transfer ring full");
+        }
+
+        let ring = self.endpoint_mut(slot_id, dci).and_then(|e| e.ring(stream)).unwrap();
+        let mut rec = [(0u16, 0u32); MAX_TD_TRBS];
+        let mut first = 0;
+        for (k, trb) in trbs.iter().enumerate() {
+            let len = match (trb.control >> 10) & 0x3F {
+                TRB_NORMAL | TRB_DATA => trb.status & 0x1_FFFF,
+                _ => 0,
+            };
+            let i = ring.push(trb, k == 0);
+            if k == 0 {
+                first = i;
+            }
+            rec[k] = (i as u16, len);
+        }
+        ring.release(first);
+
+        self.xfers[xi] = Xfer {
+            state: SlotState::Busy,
+            slot_id,
+            dci,
+            ring_phys,
+            trbs: rec,
+            count: trbs.len(),
+            control,
+            short: None,
+            result: Ok(0),
+            waiter: 0,
+        };
+        self.ring_doorbell(slot_id, dci as u32 | (stream as u32) << 16);
+        Ok(xi)
+    }
+
+    fn transfer_event(&mut self, ev: &Trb, in_irq: bool) {
+        let code = (ev.status >> 24) as u8;
+        let residual = ev.status & 0xFF_FFFF;
+        let slot_id = (ev.control >> 24) as u8;
+        let dci = ((ev.control >> 16) & 0x1F) as u8;
+        let ring_phys = ev.param & !0xFFF;
+        let idx = ((ev.param & 0xFFF) / 16) as u16;
+
+        let found = self.xfers.iter().enumerate().find_map(|(xi, x)| {
+            if x.state != SlotState::Busy || x.slot_id != slot_id || x.dci != dci || x.ring_phys != ring_phys {
+                return None;
+            }
+            x.trbs[..x.count].iter().position(|t| t.0 == idx).map(|k| (xi, k))
+        });
+
+        match code {
+            CC_SUCCESS | CC_SHORT_PACKET => {
+                // Not found: the TD already completed on a short packet
+                let Some((xi, k)) = found else { return };
+                let x = &mut self.xfers[xi];
+                let before: u32 = x.trbs[..k].iter().map(|t| t.1).sum();
+                let moved = (before + x.trbs[k].1.saturating_sub(residual)) as usize;
+                let last = k + 1 == x.count;
+                if !last && x.control {
+                    // Short data stage; the status stage completes the transfer
+                    x.short = Some(moved);
+                    return;
+                }
+                let bytes = if last { x.short.unwrap_or(moved) } else { moved };
+                self.complete(xi, Ok(bytes), in_irq);
+            }
+            CC_STOPPED | CC_STOPPED_LENGTH => {
+                if let Some((xi, _)) = found {
+                    self.complete(xi, Err("xHCI transfer cancelled"), in_irq);
+                }
+            }
+            _ => {
+                // The endpoint halted; nothing queued on it runs any more
+                if let Some(ep) = self.endpoint_mut(slot_id, dci) {
+                    ep.halted = true;
+                }
+                let err = if code == CC_STALL { "xHCI: endpoint stalled" } else { "xHCI transfer error" };
+                self.fail_endpoint(slot_id, dci, err, in_irq);
+            }
+        }
+    }
+
+    fn command_event(&mut self, ev: &Trb, in_irq: bool) {
+        let cmd = &mut self.cmd;
+        if cmd.state != SlotState::Busy || ev.param != cmd.trb_phys {
+            return; // completion of a command that timed out
+        }
+        cmd.code = (ev.status >> 24) as u8;
+        cmd.slot_id = (ev.control >> 24) as u8;
+        cmd.state = SlotState::Done;
+        let tid = core::mem::replace(&mut cmd.waiter, 0);
+        if tid != 0 {
+            wake(tid, in_irq);
+        }
+    }
+
+    /// Consume the event ring. Port status changes are left to polling.
+    fn reap_events(&mut self, in_irq: bool) {
+        loop {
+            let ev = unsafe {
+                let p = trb_ptr(self.event_phys, self.event_dequeue);
+                let control = core::ptr::read_volatile(&(*p).control);
+                if (control & TRB_CYCLE != 0) != self.event_cycle {
+                    break;
+                }
+                core::sync::atomic::fence(Ordering::Acquire);
+                Trb {
+                    param: core::ptr::read_volatile(&(*p).param),
+                    status: core::ptr::read_volatile(&(*p).status),
+                    control,
+                }
+            };
+            match (ev.control >> 10) & 0x3F {
+                EV_TRANSFER => self.transfer_event(&ev, in_irq),
+                EV_COMMAND => self.command_event(&ev, in_irq),
+                _ => {}
+            }
+            self.event_dequeue += 1;
+            if self.event_dequeue == EVENT_TRBS {
+                self.event_dequeue = 0;
+                self.event_cycle = !self.event_cycle;
+            }
+        }
+        let erdp = self.event_phys + (self.event_dequeue * 16) as u64;
+        mmio_write64(self.rt, IR_ERDP, erdp | ERDP_EHB);
+    }
+}
+
+fn xhci_irq_handler(_irq: u8) {
+    let mut guard = XHCI.lock();
+    let Some(x) = guard.as_mut() else { return };
+    let iman = mmio_read32(x.rt, IR_IMAN);
+    let sts = mmio_read32(x.op, OP_USBSTS);
+    if iman & IMAN_IP == 0 && sts & STS_EINT == 0 {
+        return; // not ours (shared line)
+    }
+    mmio_write32(x.op, OP_USBSTS, STS_EINT);
+    mmio_write32(x.rt, IR_IMAN, iman | IMAN_IP);
+    x.reap_events(true);
+}
+
+// ── Waiting ────────────────────────────────────
+
+/// Wait until `done` holds (it may claim what it checks), reaping events
+/// meanwhile. With an IRQ, a thread that can sleep blocks as `waiter`
+/// until the IRQ handler wakes it. Returns false on timeout.
+fn wait_for(timeout_ms: u32, waiter: Waiter, mut done: impl FnMut(&mut Xhci) -> bool) -> bool {
+    let tid = scheduler::current_tid();
+    let start = crate::arch::x86::pit::get_ticks();
+    let mut polls = 0u32;
+    loop {
+        let mut guard = XHCI.lock();
+        let Some(x) = guard.as_mut() else { return false };
+        if done(x) {
+            return true;
+        }
+        x.reap_events(false);
+        if done(x) {
+            return true;
+        }
+
+        let elapsed = crate::arch::x86::pit::get_ticks().wrapping_sub(start);
+        if polls >= TIMEOUT_POLLS || elapsed > timeout_ms {
+            return false;
+        }
+
+        if x.irq_enabled && can_sleep() && polls >= SPIN_POLLS {
+            // Publish the waiter under the lock the IRQ handler reaps under
+            if let Some(w) = x.waiter_mut(waiter) {
+                *w = tid;
+            }
+            let wake_at = crate::arch::x86::pit::get_ticks().wrapping_add(BLOCK_SLICE_MS);
+            scheduler::prepare_block_current(Some(wake_at));
+            drop(guard);
+            scheduler::schedule();
+            with(|x| x.waiter_mut(waiter).map(|w| *w = 0));
+        } else {
+            drop(guard);
+            polls += 1;
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// Run a command and wait for it. Returns the slot ID of its completion.
+fn command(param: u64, status: u32, control: u32) -> Result<u8, &'static str> {
+    let claimed = wait_for(COMMAND_TIMEOUT_MS, Waiter::Nobody, |x| {
+        if x.cmd.state != SlotState::Free {
+            return false;
+        }
+        let trb = Trb { param, status, control };
+        let i = x.cmd_ring.push(&trb, false);
+        x.cmd = Command {
+            state: SlotState::Busy,
+            trb_phys: x.cmd_ring.phys + (i * 16) as u64,
+            code: 0,
+            slot_id: 0,
+            waiter: 0,
+        };
+        x.ring_doorbell(0, 0);
+        true
+    });
+    if !claimed {
+        return Err("xHCI: command ring busy");
+    }
+    let done = wait_for(COMMAND_TIMEOUT_MS, Waiter::Command, |x| x.cmd.state == SlotState::Done);
+    let (code, slot_id) = with(|x| {
+        let r = (x.cmd.code, x.cmd.slot_id);
+        x.cmd.state = SlotState::Free;
+        r
+    }).unwrap_or((0, 0));
+    if !done {
+        return Err("xHCI: command timeout");
+    }
+    if code != CC_SUCCESS {
+        crate::serial_println!("  xHCI: command type {} failed (code {})", (control >> 10) & 0x3F, code);
+        return Err("xHCI: command failed");
+    }
+    Ok(slot_id)
+}
+
+/// Wait for a transfer and free it. A transfer that times out is
+/// cancelled; an endpoint that halted is reset for the next one.
+fn wait_xfer(xi: usize, timeout_ms: u32) -> Result<usize, &'static str> {
+    let done = wait_for(timeout_ms, Waiter::Transfer(xi), |x| x.xfers[xi].state != SlotState::Busy);
+    let Some((slot_id, dci)) = with(|x| (x.xfers[xi].slot_id, x.xfers[xi].dci)) else {
+        return Err("xHCI not initialized");
+    };
+    if !done {
+        reset_endpoint(slot_id, dci);
+    }
+    let (result, halted) = with(|x| {
+        let result = if done { x.xfers[xi].result } else { Err("xHCI transfer timeout") };
+        x.xfers[xi] = FREE_XFER;
+        (result, x.endpoint_mut(slot_id, dci).map_or(false, |e| e.halted))
+    }).unwrap_or((Err("xHCI not initialized"), false));
+    if halted {
+        reset_endpoint(slot_id, dci);
+    }
+    result
+}
+
+/// Cancel what is queued on an endpoint and make it usable again: stop
+/// it (or reset it if it halted), fail its transfers and move the
+/// dequeue pointer of each of its rings past everything queued.
+fn reset_endpoint(slot_id: u8, dci: u8) {
+    let Some(mut halted) = with(|x| x.endpoint_mut(slot_id, dci).map(|e| e.halted)).flatten() else {
+        return;
+    };
+    if !halted && command(0, 0, ep_command(TRB_STOP_EP, slot_id, dci)).is_err() {
+        // Not running: it may have halted since we looked
+        halted = with(|x| {
+            x.reap_events(false);
+            x.endpoint_mut(slot_id, dci).map_or(false, |e| e.halted)
+        }).unwrap_or(false);
+    }
+    if halted {
+        let _ = command(0, 0, ep_command(TRB_RESET_EP, slot_id, dci));
+    }
+
+    let dequeues: Vec<(u16, u64)> = with(|x| {
+        x.fail_endpoint(slot_id, dci, "xHCI transfer cancelled", false);
+        let Some(ep) = x.endpoint_mut(slot_id, dci) else { return Vec::new() };
+        ep.halted = false;
+        let streams = ep.streams;
+        ep.rings.iter().enumerate().map(|(i, r)| {
+            if streams {
+                ((i + 1) as u16, r.dequeue_ptr() | SCT_PRIMARY)
+            } else {
+                (0, r.dequeue_ptr())
+            }
+        }).collect()
+    }).unwrap_or_default();
+    for (stream, ptr) in dequeues {
+        let _ = command(ptr, (stream as u32) << 16, ep_command(TRB_SET_TR_DEQUEUE, slot_id, dci));
+    }
+}
+
+// ── Transfers ──────────────────────────────────
+
+/// Control transfer on EP0 of `slot_id`. Returns the data read (IN) or an
+/// empty Vec. OUT data stages send zeroes, as on UHCI/EHCI.
+fn control_transfer(
+    slot_id: u8,
+    setup: &SetupPacket,
+    data_in: bool,
+    data_len: u16,
+) -> Result<Vec<u8>, &'static str> {
+    if data_len as usize > 4096 {
+        return Err("xHCI: control transfer too long");
+    }
+    // One control transfer per device at a time (they share its buffer)
+    let claimed = wait_for(CONTROL_TIMEOUT_MS, Waiter::Nobody, |x| match x.device_mut(slot_id) {
+        Some(d) if d.ctrl_busy => false,
+        Some(d) => {
+            d.ctrl_busy = true;
+            true
+        }
+        None => true,
+    });
+    if !claimed {
+        return Err("xHCI: control endpoint busy");
+    }
+
+    let queued = with(|x| {
+        let buf = x.device(slot_id).ok_or("xHCI: no such device")?.ctrl_buf;
+        let setup_bytes: u64 = unsafe { core::mem::transmute_copy(setup) };
+        let trt = match (data_len, data_in) {
+            (0, _) => 0,
+            (_, false) => 2,
+            (_, true) => 3,
+        };
+        let mut trbs = [Trb::EMPTY; 3];
+        let mut n = 0;
+        trbs[n] = Trb {
+            param: setup_bytes,
+            status: 8,
+            control: trb_type(TRB_SETUP) | TRB_IDT | trt << 16,
+        };
+        n += 1;
+        if data_len > 0 {
+            unsafe { core::ptr::write_bytes(buf as *mut u8, 0, data_len as usize); }
+            trbs[n] = Trb {
+                param: buf,
+                status: data_len as u32,
+                control: trb_type(TRB_DATA) | if data_in { TRB_DIR_IN | TRB_ISP } else { 0 },
+            };
+            n += 1;
+        }
+        // Status stage runs opposite to the data stage (IN without one)
+        let status_in = data_len == 0 || !data_in;
+        trbs[n] = Trb {
+            param: 0,
+            status: 0,
+            control: trb_type(TRB_STATUS) | TRB_IOC | if status_in { TRB_DIR_IN } else { 0 },
+        };
+        n += 1;
+        x.queue_td(slot_id, 1, 0, &trbs[..n], true).map(|xi| (xi, buf))
+    }).unwrap_or(Err("xHCI not initialized"));
+
+    let result = queued.and_then(|(xi, buf)| {
+        let bytes = wait_xfer(xi, CONTROL_TIMEOUT_MS)?.min(data_len as usize);
+        let mut data = Vec::new();
+        if data_in && bytes > 0 {
+            data.resize(bytes, 0);
+            unsafe { core::ptr::copy_nonoverlapping(buf as *const u8, data.as_mut_ptr(), bytes); }
+        }
+        Ok(data)
+    });
+    with(|x| x.device_mut(slot_id).map(|d| d.ctrl_busy = false));
+    result
+}
+
+/// Queue a bulk transfer; finish it with [`wait_xfer`].
+fn bulk_submit(
+    slot_id: u8,
+    endpoint: u8,
+    max_packet: u16,
+    stream: u16,
+    data_phys: u64,
+    len: usize,
+) -> Result<usize, &'static str> {
+    let is_in = endpoint & 0x80 != 0;
+    let max_pkt = (max_packet as usize).max(1);
+
+    // Split at 64 KiB boundaries; TD Size counts the packets still to come
+    let mut trbs = [Trb::EMPTY; MAX_TD_TRBS];
+    let mut n = 0;
+    let mut off = 0usize;
+    while off < len {
+        if n == MAX_TD_TRBS {
+            return Err("xHCI: bulk transfer too large");
+        }
+        let addr = data_phys + off as u64;
+        let chunk = (len - off).min((TRB_MAX_BYTES - (addr & (TRB_MAX_BYTES - 1))) as usize);
+        let after = len - off - chunk;
+        let td_size = ((after + max_pkt - 1) / max_pkt).min(31) as u32;
+        let mut control = trb_type(TRB_NORMAL);
+        if is_in {
+            control |= TRB_ISP;
+        }
+        control |= if after > 0 { TRB_CHAIN } else { TRB_IOC };
+        trbs[n] = Trb { param: addr, status: chunk as u32 | td_size << 17, control };
+        n += 1;
+        off += chunk;
+    }
+    with(|x| x.queue_td(slot_id, ep_dci(endpoint), stream, &trbs[..n], false))
+        .unwrap_or(Err("xHCI not initialized"))
+}
+
+// ── Slots and Contexts ─────────────────────────
+
+/// Speed ID of the default protocol speed table.
+fn speed_id(speed: UsbSpeed) -> u32 {
+    match speed {
+        UsbSpeed::Full => 1,
+        UsbSpeed::Low => 2,
+        UsbSpeed::High => 3,
+        UsbSpeed::Super => 4,
+    }
+}
+
+fn speed_from_id(id: u32) -> UsbSpeed {
+    match id {
+        2 => UsbSpeed::Low,
+        3 => UsbSpeed::High,
+        1 => UsbSpeed::Full,
+        _ => UsbSpeed::Super,
+    }
+}
+
+/// EP0 max packet size until the device descriptor says otherwise.
+fn default_max_packet(speed: UsbSpeed) -> u16 {
+    match speed {
+        UsbSpeed::Low | UsbSpeed::Full => 8,
+        UsbSpeed::High => 64,
+        UsbSpeed::Super => 512,
+    }
+}
+
+/// Fill endpoint context `c` (8 dwords) for `ep`. `pstreams` is the
+/// MaxPStreams field (0 without streams); `dequeue` the ring (with cycle
+/// state) or the stream context array.
+unsafe fn write_ep_ctx(c: *mut u32, ep: &UsbEndpoint, speed: UsbSpeed, dequeue: u64, pstreams: u32) {
+    let xfer_type = ep.attributes & 0x03;
+    let is_in = ep.address & 0x80 != 0;
+    let ep_type: u32 = match (xfer_type, is_in) {
+        (0, _) => 4,
+        (1, false) => 1,
+        (2, false) => 2,
+        (3, false) => 3,
+        (1, true) => 5,
+        (2, true) => 6,
+        _ => 7,
+    };
+    let max_packet = (ep.max_packet_size & 0x7FF) as u32;
+    let burst = match speed {
+        UsbSpeed::Super => ep.max_burst as u32,
+        UsbSpeed::High if xfer_type & 1 == 1 => ((ep.max_packet_size >> 11) & 3) as u32,
+        _ => 0,
+    };
+    // Periodic endpoints: interval as 2^n × 125 µs
+    let interval = match (xfer_type & 1, speed) {
+        (0, _) => 0,
+        (_, UsbSpeed::High | UsbSpeed::Super) => (ep.interval.max(1) as u32 - 1).min(15),
+        _ => (31 - (ep.interval.max(1) as u32 * 8).leading_zeros()).clamp(3, 10),
+    };
+    let avg_trb = match xfer_type {
+        0 => 8,
+        2 => 3072,
+        _ => max_packet * (burst + 1),
+    };
+    let esit = if xfer_type & 1 == 1 { max_packet * (burst + 1) } else { 0 };
+    let lsa = if pstreams > 0 { 1 << 15 } else { 0 };
+
+    core::ptr::write_volatile(c, interval << 16 | lsa | pstreams << 10);
+    core::ptr::write_volatile(c.add(1), 3 << 1 | ep_type << 3 | burst << 8 | max_packet << 16);
+    core::ptr::write_volatile(c.add(2), dequeue as u32);
+    core::ptr::write_volatile(c.add(3), (dequeue >> 32) as u32);
+    core::ptr::write_volatile(c.add(4), avg_trb | (esit & 0xFFFF) << 16);
+}
+
+fn ep0_descriptor(max_packet: u16) -> UsbEndpoint {
+    UsbEndpoint {
+        address: 0,
+        attributes: 0,
+        max_packet_size: max_packet,
+        interval: 0,
+        max_burst: 0,
+        max_streams: 0,
+        uas_pipe: 0,
+    }
+}
+
+/// Enable a slot for a device just reset, address it and learn its EP0
+/// max packet size. Returns the slot ID (the device's address) and it.
+fn new_device(
+    speed: UsbSpeed,
+    root_port: u8,
+    route: u32,
+    depth: u8,
+    tt: Option<(u8, u8)>,
+) -> Result<(u8, u16), &'static str> {
+    let slot_id = command(0, 0, trb_type(TRB_ENABLE_SLOT))?;
+    let pages = (alloc_page(), alloc_page(), alloc_page(), Ring::alloc());
+    let (Some(out_ctx), Some(in_ctx), Some(ctrl_buf), Some(ep0)) = pages else {
+        free_page(pages.0.unwrap_or(0));
+        free_page(pages.1.unwrap_or(0));
+        free_page(pages.2.unwrap_or(0));
+        free_page(pages.3.map_or(0, |r| r.phys));
+        let _ = command(0, 0, trb_type(TRB_DISABLE_SLOT) | (slot_id as u32) << 24);
+        return Err("xHCI: out of memory");
+    };
+
+    let mps0 = default_max_packet(speed);
+    with(|x| {
+        unsafe {
+            core::ptr::write_volatile((x.dcbaa_phys as *mut u64).add(slot_id as usize), out_ctx);
+            let icc = x.ctx(in_ctx, 0);
+            core::ptr::write_volatile(icc.add(1), 0b11); // add slot + EP0
+            let slot = x.ctx(in_ctx, 1);
+            core::ptr::write_volatile(slot, route | speed_id(speed) << 20 | 1 << 27);
+            core::ptr::write_volatile(slot.add(1), (root_port as u32) << 16);
+            if let Some((hub_slot, hub_port)) = tt {
+                core::ptr::write_volatile(slot.add(2), hub_slot as u32 | (hub_port as u32) << 8);
+            }
+            write_ep_ctx(x.ctx(in_ctx, 2), &ep0_descriptor(mps0), speed, ep0.dequeue_ptr(), 0);
+        }
+        x.devices.push(Device {
+            slot_id,
+            speed,
+            root_port,
+            route,
+            depth,
+            tt,
+            out_ctx,
+            in_ctx,
+            ctrl_buf,
+            ctrl_busy: false,
+            eps: alloc::vec![Endpoint {
+                dci: 1,
+                iface: 0xFF,
+                rings: alloc::vec![ep0],
+                streams: false,
+                stream_array: 0,
+                halted: false,
+            }],
+        });
+    });
+
+    let addressed = command(in_ctx, 0, trb_type(TRB_ADDRESS_DEVICE) | (slot_id as u32) << 24)
+        .and_then(|_| {
+            delay_ms(2);
+            let setup = SetupPacket {
+                bm_request_type: DIR_DEVICE_TO_HOST,
+                b_request: REQ_GET_DESCRIPTOR,
+                w_value: DESC_DEVICE,
+                w_index: 0,
+                w_length: 8,
+            };
+            let data8 = control_transfer(slot_id, &setup, true, 8)?;
+            if data8.len() < 8 {
+                return Err("short device descriptor");
+            }
+            Ok(match (speed, data8[7]) {
+                (_, 0) => mps0,
+                (UsbSpeed::Super, exp) => 1u16 << exp.min(9),
+                (_, mps) => mps as u16,
+            })
+        });
+    let max_packet = match addressed {
+        Ok(mps) => mps,
+        Err(e) => {
+            release_device(slot_id);
+            return Err(e);
+        }
+    };
+
+    if max_packet != mps0 {
+        // Full-speed EP0 is 8 to 64 bytes: tell the controller
+        let in_ctx = with(|x| {
+            let dev = x.device(slot_id)?;
+            x.prepare_input(dev);
+            unsafe {
+                core::ptr::write_volatile(x.ctx(dev.in_ctx, 0).add(1), 0b10);
+                let ring = dev.eps[0].rings[0].dequeue_ptr();
+                write_ep_ctx(x.ctx(dev.in_ctx, 2), &ep0_descriptor(max_packet), speed, ring, 0);
+            }
+            Some(dev.in_ctx)
+        }).flatten().ok_or("xHCI: no such device")?;
+        if let Err(e) = command(in_ctx, 0, trb_type(TRB_EVALUATE_CTX) | (slot_id as u32) << 24) {
+            release_device(slot_id);
+            return Err(e);
+        }
+    }
+    Ok((slot_id, max_packet))
+}
+
+/// Configure endpoints of a device: those of interface `iface` (all
+/// interfaces if `None`) are replaced by `eps`. Bulk endpoints with
+/// streams get a stream array if `streams` and the controller has them.
+fn configure_endpoints(
+    slot_id: u8,
+    iface: Option<u8>,
+    eps: &[(u8, UsbEndpoint)],
+    streams: bool,
+) -> Result<(), &'static str> {
+    let (in_ctx, added) = with(|x| -> Result<(u64, Vec<Endpoint>), &'static str> {
+        let ctx_size = x.ctx_size;
+        let max_streams = x.max_streams.min(MAX_STREAMS);
+        let dev = x.device(slot_id).ok_or("xHCI: no such device")?;
+        let speed = dev.speed;
+        x.prepare_input(dev);
+        let icc = x.ctx(dev.in_ctx, 0);
+        let ep_ctx = |dci: u8| (dev.in_ctx + ((dci as usize + 1) * ctx_size) as u64) as *mut u32;
+
+        let mut drop_flags = 0u32;
+        let mut add_flags = 1u32; // slot context (Context Entries)
+        let mut last_dci = 1u8;
+        for ep in dev.eps.iter().filter(|e| e.dci > 1) {
+            if iface.map_or(true, |i| ep.iface == i) {
+                drop_flags |= 1 << ep.dci;
+            } else {
+                last_dci = last_dci.max(ep.dci);
+            }
+        }
+
+        let mut added = Vec::new();
+        for &(num, ep) in eps {
+            // Isochronous endpoints are not used by any class driver
+            if ep.attributes & 0x03 == 1 {
+                continue;
+            }
+            let dci = ep_dci(ep.address);
+            if dev.eps.iter().any(|e| e.dci == dci) {
+                drop_flags |= 1 << dci;
+            }
+            let n_streams = if streams && speed == UsbSpeed::Super && ep.max_streams > 0 && max_streams >= 8 {
+                (1usize << ep.max_streams.min(15)).min(max_streams)
+            } else {
+                0
+            };
+            let mut new = Endpoint {
+                dci,
+                iface: num,
+                rings: Vec::new(),
+                streams: n_streams > 0,
+                stream_array: 0,
+                halted: false,
+            };
+            let dequeue = if n_streams == 0 {
+                let ring = Ring::alloc().ok_or("xHCI: out of memory")?;
+                let ptr = ring.dequeue_ptr();
+                new.rings.push(ring);
+                ptr
+            } else {
+                new.stream_array = alloc_page().ok_or("xHCI: out of memory")?;
+                for s in 1..n_streams {
+                    let ring = Ring::alloc().ok_or("xHCI: out of memory")?;
+                    unsafe {
+                        let entry = (new.stream_array + s as u64 * 16) as *mut u64;
+                        core::ptr::write_volatile(entry, ring.dequeue_ptr() | SCT_PRIMARY);
+                    }
+                    new.rings.push(ring);
+                }
+                new.stream_array
+            };
+            let pstreams = if n_streams > 0 { n_streams.trailing_zeros() - 1 } else { 0 };
+            unsafe { write_ep_ctx(ep_ctx(dci), &ep, speed, dequeue, pstreams); }
+            add_flags |= 1 << dci;
+            last_dci = last_dci.max(dci);
+            added.push(new);
+        }
+
+        unsafe {
+            core::ptr::write_volatile(icc, drop_flags);
+            core::ptr::write_volatile(icc.add(1), add_flags);
+            let slot = x.ctx(dev.in_ctx, 1);
+            let dw0 = core::ptr::read_volatile(slot);
+            core::ptr::write_volatile(slot, (dw0 & !(0x1F << 27)) | (last_dci as u32) << 27);
+        }
+        Ok((dev.in_ctx, added))
+    }).unwrap_or(Err("xHCI not initialized"))?;
+
+    if let Err(e) = command(in_ctx, 0, trb_type(TRB_CONFIGURE_EP) | (slot_id as u32) << 24) {
+        for ep in &added {
+            ep.free();
+        }
+        return Err(e);
+    }
+
+    with(|x| {
+        let Some(dev) = x.device_mut(slot_id) else { return };
+        let mut i = 0;
+        while i < dev.eps.len() {
+            let e = &dev.eps[i];
+            let replaced = added.iter().any(|a| a.dci == e.dci);
+            if e.dci > 1 && (replaced || iface.map_or(true, |n| e.iface == n)) {
+                dev.eps.swap_remove(i).free();
+            } else {
+                i += 1;
+            }
+        }
+        dev.eps.extend(added);
+    });
+    Ok(())
+}
+
+/// Disable the slot of a device and free what it used.
+fn release_device(slot_id: u8) {
+    let known = with(|x| x.device(slot_id).is_some()).unwrap_or(false);
+    if !known {
+        return;
+    }
+    let _ = command(0, 0, trb_type(TRB_DISABLE_SLOT) | (slot_id as u32) << 24);
+    let dev = with(|x| {
+        for xi in 0..MAX_TRANSFERS {
+            if x.xfers[xi].state == SlotState::Busy && x.xfers[xi].slot_id == slot_id {
+                x.complete(xi, Err("USB device removed"), false);
+            }
+        }
+        unsafe {
+            core::ptr::write_volatile((x.dcbaa_phys as *mut u64).add(slot_id as usize), 0);
+        }
+        let i = x.devices.iter().position(|d| d.slot_id == slot_id)?;
+        Some(x.devices.swap_remove(i))
+    }).flatten();
+    if let Some(dev) = dev {
+        for ep in &dev.eps {
+            ep.free();
+        }
+        free_page(dev.out_ctx);
+        free_page(dev.in_ctx);
+        free_page(dev.ctrl_buf);
+    }
+}
+
+// ── Host Controller Interface ──────────────────
+
+/// xHCI implementation of the class drivers' [`HostController`].
+pub struct XhciHost;
+
+impl HostController for XhciHost {
+    fn control_transfer(
+        &self,
+        addr: u8,
+        _speed: UsbSpeed,
+        _max_packet: u16,
+        setup: &SetupPacket,
+        data_in: bool,
+        data_len: u16,
+    ) -> Result<Vec<u8>, &'static str> {
+        control_transfer(addr, setup, data_in, data_len)
+    }
+
+    fn bulk_submit(
+        &self,
+        addr: u8,
+        _speed: UsbSpeed,
+        endpoint: u8,
+        max_packet: u16,
+        stream: u16,
+        _toggle: &mut u8,
+        data_phys: u64,
+        len: usize,
+    ) -> BulkHandle {
+        if len == 0 {
+            return BulkHandle::Done(Ok(0));
+        }
+        match bulk_submit(addr, endpoint, max_packet, stream, data_phys, len) {
+            Ok(xi) => BulkHandle::Queued(ControllerType::Xhci, xi),
+            Err(e) => BulkHandle::Done(Err(e)),
+        }
+    }
+
+    fn bulk_wait(&self, xfer: usize, _toggle: &mut u8) -> Result<usize, &'static str> {
+        wait_xfer(xfer, BULK_TIMEOUT_MS)
+    }
+
+    fn bulk_flush(&self, addr: u8, endpoint: u8) {
+        let dci = ep_dci(endpoint);
+        let pending = with(|x| {
+            let busy = x.xfers.iter().any(|t| t.state == SlotState::Busy && t.slot_id == addr && t.dci == dci);
+            busy || x.endpoint_mut(addr, dci).map_or(false, |e| e.halted)
+        }).unwrap_or(false);
+        if pending {
+            reset_endpoint(addr, dci);
+        }
+    }
+
+    fn address_device(&self, hub: HubPort, speed: UsbSpeed) -> Result<(u8, u16), &'static str> {
+        let (root_port, route, depth, tt) = with(|x| {
+            let parent = x.device(hub.hub_addr).ok_or("xHCI: unknown hub")?;
+            if parent.depth >= 5 {
+                return Err("xHCI: hub tier too deep");
+            }
+            let route = parent.route | ((hub.port.min(15) as u32) << (4 * parent.depth));
+            let tt = match speed {
+                UsbSpeed::Low | UsbSpeed::Full if parent.speed == UsbSpeed::High => {
+                    Some((parent.slot_id, hub.port))
+                }
+                UsbSpeed::Low | UsbSpeed::Full => parent.tt,
+                _ => None,
+            };
+            Ok((parent.root_port, route, parent.depth + 1, tt))
+        }).unwrap_or(Err("xHCI not initialized"))?;
+        new_device(speed, root_port, route, depth, tt)
+    }
+
+    fn set_configuration(
+        &self,
+        addr: u8,
+        _speed: UsbSpeed,
+        _max_packet: u16,
+        config_raw: &[u8],
+        value: u8,
+    ) -> Result<(), &'static str> {
+        // The controller needs the endpoints before the device uses them
+        let eps: Vec<(u8, UsbEndpoint)> = parse_config(config_raw).iter()
+            .filter(|i| i.alt == 0)
+            .flat_map(|i| i.endpoints.iter().map(move |e| (i.number, *e)))
+            .collect();
+        configure_endpoints(addr, None, &eps, false)?;
+        let setup = SetupPacket {
+            bm_request_type: DIR_HOST_TO_DEVICE,
+            b_request: REQ_SET_CONFIGURATION,
+            w_value: value as u16,
+            w_index: 0,
+            w_length: 0,
+        };
+        control_transfer(addr, &setup, false, 0).map(|_| ())
+    }
+
+    fn set_interface(
+        &self,
+        addr: u8,
+        _speed: UsbSpeed,
+        _max_packet: u16,
+        iface: &UsbInterface,
+    ) -> Result<(), &'static str> {
+        let eps: Vec<(u8, UsbEndpoint)> = iface.endpoints.iter().map(|e| (iface.number, *e)).collect();
+        configure_endpoints(addr, Some(iface.number), &eps, true)?;
+        let setup = SetupPacket {
+            bm_request_type: 0x01, // Standard, Interface, Host-to-Device
+            b_request: REQ_SET_INTERFACE,
+            w_value: iface.alt as u16,
+            w_index: iface.number as u16,
+            w_length: 0,
+        };
+        control_transfer(addr, &setup, false, 0).map(|_| ())
+    }
+
+    fn hub_attached(&self, addr: u8, num_ports: u8) {
+        // Mark the slot as a hub (Configure Endpoint with the slot context)
+        let in_ctx = with(|x| {
+            let dev = x.device(addr)?;
+            x.prepare_input(dev);
+            unsafe {
+                core::ptr::write_volatile(x.ctx(dev.in_ctx, 0).add(1), 1);
+                let slot = x.ctx(dev.in_ctx, 1);
+                let dw0 = core::ptr::read_volatile(slot);
+                core::ptr::write_volatile(slot, dw0 | 1 << 26);
+                let dw1 = core::ptr::read_volatile(slot.add(1));
+                core::ptr::write_volatile(slot.add(1), (dw1 & 0x00FF_FFFF) | (num_ports as u32) << 24);
+            }
+            Some(dev.in_ctx)
+        }).flatten();
+        if let Some(in_ctx) = in_ctx {
+            if let Err(e) = command(in_ctx, 0, trb_type(TRB_CONFIGURE_EP) | (addr as u32) << 24) {
+                crate::serial_println!("  xHCI: hub slot {} not configured: {}", addr, e);
+            }
+        }
+    }
+
+    fn supports_streams(&self, addr: u8) -> bool {
+        with(|x| {
+            x.max_streams >= 8 && x.device(addr).map_or(false, |d| d.speed == UsbSpeed::Super)
+        }).unwrap_or(false)
+    }
+
+    fn release_device(&self, addr: u8) {
+        release_device(addr);
+    }
+}
+
+// ── Device Enumeration ─────────────────────────
+
+/// Read the descriptors of an addressed device on a root port, configure
+/// it and hand it to the class drivers.
+fn enumerate_device(port: u8, speed: UsbSpeed) {
+    let (slot_id, max_packet) = match new_device(speed, port, 0, 0, None) {
+        Ok(v) => v,
+        Err(e) => {
+            crate::serial_println!("  xHCI: port {} — addressing failed: {}", port, e);
+            return;
+        }
+    };
+    if let Err(e) = configure_device(slot_id, port, speed, max_packet) {
+        crate::serial_println!("  xHCI: device {} — {}", slot_id, e);
+        release_device(slot_id);
+    }
+}
+
+fn configure_device(slot_id: u8, port: u8, speed: UsbSpeed, max_packet: u16) -> Result<(), &'static str> {
+    let get_descriptor = |w_value: u16, len: u16| {
+        let setup = SetupPacket {
+            bm_request_type: DIR_DEVICE_TO_HOST,
+            b_request: REQ_GET_DESCRIPTOR,
+            w_value,
+            w_index: 0,
+            w_length: len,
+        };
+        control_transfer(slot_id, &setup, true, len)
+    };
+
+    let desc_buf = get_descriptor(DESC_DEVICE, 18)?;
+    if desc_buf.len() < 18 {
+        return Err("short device descriptor");
+    }
+    let dev_desc: DeviceDescriptor = unsafe { core::ptr::read_unaligned(desc_buf.as_ptr() as *const _) };
+
+    let hdr = get_descriptor(DESC_CONFIG, 9)?;
+    if hdr.len() < 9 {
+        return Err("config descriptor header failed");
+    }
+    // UAS devices list both alternates with companions: allow more than 256
+    let config_len = u16::from_le_bytes([hdr[2], hdr[3]]).min(1024);
+    let config_buf = get_descriptor(DESC_CONFIG, config_len)?;
+    if config_buf.len() < 9 {
+        return Err("full config descriptor failed");
+    }
+    let interfaces = parse_config(&config_buf);
+
+    XhciHost.set_configuration(slot_id, speed, max_packet, &config_buf, config_buf[5])
+        .map_err(|_| "SET_CONFIGURATION failed")?;
+
+    let first = interfaces.first();
+    let dev_class = if dev_desc.b_device_class != 0 {
+        dev_desc.b_device_class
+    } else {
+        first.map(|i| i.class).unwrap_or(0)
+    };
+    let dev_subclass = if dev_desc.b_device_sub_class != 0 {
+        dev_desc.b_device_sub_class
+    } else {
+        first.map(|i| i.subclass).unwrap_or(0)
+    };
+    let dev_protocol = if dev_desc.b_device_protocol != 0 {
+        dev_desc.b_device_protocol
+    } else {
+        first.map(|i| i.protocol).unwrap_or(0)
+    };
+
+    register_device(UsbDevice {
+        address: slot_id,
+        speed,
+        port,
+        controller: ControllerType::Xhci,
+        max_packet_size: max_packet,
+        vendor_id: dev_desc.id_vendor,
+        product_id: dev_desc.id_product,
+        class: dev_class,
+        subclass: dev_subclass,
+        protocol: dev_protocol,
+        num_configs: dev_desc.b_num_configurations,
+        interfaces,
+        config_raw: config_buf,
+    });
+    Ok(())
+}
+
+// ── Port Reset + Scan ──────────────────────────
+
+fn portsc_offset(port: u8) -> u32 {
+    OP_PORTSC_BASE + (port as u32 - 1) * 0x10
+}
+
+/// Reset a root port with a device (1-based) and return its speed. USB 3
+/// ports train by themselves and are enabled already.
+fn reset_port(op: u64, port: u8) -> Option<UsbSpeed> {
+    let reg = portsc_offset(port);
+    let portsc = mmio_read32(op, reg);
+    if portsc & PORTSC_CCS == 0 {
+        return None;
+    }
+    mmio_write32(op, reg, (portsc & PORTSC_KEEP) | (portsc & PORTSC_CHANGES));
+
+    if portsc & PORTSC_PED == 0 {
+        mmio_write32(op, reg, (portsc & PORTSC_KEEP) | PORTSC_PR);
+        let mut done = false;
+        for _ in 0..50 {
+            delay_ms(10);
+            let portsc = mmio_read32(op, reg);
+            if portsc & PORTSC_PRC != 0 {
+                mmio_write32(op, reg, (portsc & PORTSC_KEEP) | PORTSC_PRC);
+                done = true;
+                break;
+            }
+        }
+        if !done {
+            crate::serial_println!("  xHCI: port {} — reset timeout", port);
+            return None;
+        }
+    }
+    delay_ms(10);
+
+    let portsc = mmio_read32(op, reg);
+    if portsc & PORTSC_PED == 0 {
+        crate::serial_println!("  xHCI: port {} — not enabled after reset", port);
+        return None;
+    }
+    Some(speed_from_id((portsc >> PORTSC_SPEED_SHIFT) & 0xF))
+}
+
+fn connect_port(op: u64, port: u8) {
+    if let Some(speed) = reset_port(op, port) {
+        crate::serial_println!("  xHCI: port {} — enabled ({})", port, super::speed_name(speed));
+        enumerate_device(port, speed);
+    }
+}
+
+fn disconnect_port(port: u8) {
+    // Clean up class drivers and USB device registry (which also
+    // disables the slot)
+    super::hub::disconnect(port, ControllerType::Xhci);
+    super::cdc_acm::disconnect(port, ControllerType::Xhci);
+    super::cdc_ecm::disconnect(port, ControllerType::Xhci);
+    super::storage::disconnect(port, ControllerType::Xhci);
+    super::remove_device(port, ControllerType::Xhci);
+}
+
+// ── Controller Init ────────────────────────────
+
+/// Take the controller from the BIOS (USB Legacy Support capability).
+fn bios_handoff(base: u64, hccparams: u32) {
+    let mut off = ((hccparams >> 16) & 0xFFFF) << 2;
+    while off != 0 {
+        let cap = mmio_read32(base, off);
+        if cap & 0xFF == 1 {
+            if cap & (1 << 16) != 0 {
+                mmio_write32(base, off, cap | (1 << 24)); // OS owned
+                for _ in 0..100 {
+                    if mmio_read32(base, off) & (1 << 16) == 0 {
+                        break;
+                    }
+                    delay_ms(10);
+                }
+            }
+            // No more SMIs: clear the enables, acknowledge the events
+            let ctlsts = mmio_read32(base, off + 4);
+            mmio_write32(base, off + 4, ctlsts & 0xE000_0000);
+            return;
+        }
+        let next = (cap >> 8) & 0xFF;
+        off = if next == 0 { 0 } else { off + (next << 2) };
+    }
+}
+
+pub fn init_controller(pci: &PciDevice) {
+    if XHCI.lock().is_some() {
+        crate::serial_println!("  xHCI: one controller already active, skipping");
+        return;
+    }
+    let bar0 = pci.bars[0];
+    let mut phys_base = (bar0 & 0xFFFF_FFF0) as u64;
+    if (bar0 >> 1) & 3 == 2 {
+        phys_base |= (pci.bars[1] as u64) << 32;
+    }
+    if phys_base == 0 {
+        crate::serial_println!("  xHCI: BAR0 is zero, cannot initialize");
+        return;
+    }
+
+    let base = match virtual_mem::map_mmio(PhysAddr::new(phys_base), XHCI_MMIO_PAGES) {
+        Some(v) => v.as_u64(),
+        None => {
+            crate::serial_println!("  xHCI: cannot map registers");
+            return;
+        }
+    };
+
+    // Enable bus mastering + memory space
+    let cmd = pci_config_read32(pci.bus, pci.device, pci.function, 0x04);
+    pci_config_write32(pci.bus, pci.device, pci.function, 0x04, cmd | 0x06);
+
+    let caplength = (mmio_read32(base, CAP_CAPLENGTH) & 0xFF) as u64;
+    let op = base + caplength;
+    let rt = base + (mmio_read32(base, CAP_RTSOFF) & !0x1F) as u64;
+    let db = base + (mmio_read32(base, CAP_DBOFF) & !0x3) as u64;
+    let hcs1 = mmio_read32(base, CAP_HCSPARAMS1);
+    let hcs2 = mmio_read32(base, CAP_HCSPARAMS2);
+    let hcc1 = mmio_read32(base, CAP_HCCPARAMS1);
+    let max_slots = ((hcs1 & 0xFF) as u8).min(MAX_SLOTS);
+    let n_ports = (hcs1 >> 24) as u8;
+    let ctx_size = if hcc1 & HCC_CSZ != 0 { 64 } else { 32 };
+    let psa = (hcc1 >> 12) & 0xF;
+    let max_streams = if psa == 0 { 0 } else { 1usize << (psa + 1) };
+    let scratchpads = (((hcs2 >> 21) & 0x1F) << 5 | (hcs2 >> 27) & 0x1F) as usize;
+
+    crate::serial_println!(
+        "  xHCI: controller at phys {:#x}, {} port(s), {} slot(s), {}-byte contexts",
+        phys_base, n_ports, max_slots, ctx_size
+    );
+
+    bios_handoff(base, hcc1);
+
+    // Stop, then reset
+    mmio_write32(op, OP_USBCMD, mmio_read32(op, OP_USBCMD) & !CMD_RUN);
+    for _ in 0..100 {
+        if mmio_read32(op, OP_USBSTS) & STS_HCH != 0 {
+            break;
+        }
+        delay_ms(1);
+    }
+    mmio_write32(op, OP_USBCMD, CMD_HCRST);
+    for _ in 0..1000 {
+        if mmio_read32(op, OP_USBCMD) & CMD_HCRST == 0 && mmio_read32(op, OP_USBSTS) & STS_CNR == 0 {
+            break;
+        }
+        delay_ms(1);
+    }
+    if mmio_read32(op, OP_USBSTS) & STS_CNR != 0 {
+        crate::serial_println!("  xHCI: controller not ready after reset");
+        return;
+    }
+
+    // Device context base array, with the scratchpad array in entry 0
+    let Some(dcbaa_phys) = alloc_page() else {
+        crate::serial_println!("  xHCI: failed to allocate DCBAA");
+        return;
+    };
+    if scratchpads > 0 {
+        let Some(array) = alloc_page() else {
+            crate::serial_println!("  xHCI: failed to allocate scratchpad array");
+            return;
+        };
+        for i in 0..scratchpads.min(512) {
+            let Some(page) = alloc_page() else {
+                crate::serial_println!("  xHCI: failed to allocate scratchpad buffers");
+                return;
+            };
+            unsafe { core::ptr::write_volatile((array as *mut u64).add(i), page); }
+        }
+        unsafe { core::ptr::write_volatile(dcbaa_phys as *mut u64, array); }
+    }
+
+    let (Some(cmd_ring), Some(event_phys), Some(erst_phys)) = (Ring::alloc(), alloc_page(), alloc_page()) else {
+        crate::serial_println!("  xHCI: failed to allocate rings");
+        return;
+    };
+    unsafe {
+        // One event ring segment
+        core::ptr::write_volatile(erst_phys as *mut u64, event_phys);
+        core::ptr::write_volatile((erst_phys + 8) as *mut u32, EVENT_TRBS as u32);
+    }
+
+    mmio_write32(op, OP_CONFIG, max_slots as u32);
+    mmio_write64(op, OP_DCBAAP, dcbaa_phys);
+    mmio_write64(op, OP_CRCR, cmd_ring.phys | 1); // RCS = 1
+    mmio_write32(rt, IR_ERSTSZ, 1);
+    mmio_write64(rt, IR_ERDP, event_phys);
+    mmio_write64(rt, IR_ERSTBA, erst_phys);
+    mmio_write32(rt, IR_IMOD, IMOD_INTERVAL);
+
+    *XHCI.lock() = Some(Xhci {
+        op,
+        rt,
+        db,
+        ctx_size,
+        n_ports,
+        max_streams,
+        dcbaa_phys,
+        cmd_ring,
+        event_phys,
+        event_dequeue: 0,
+        event_cycle: true,
+        irq_enabled: false,
+        cmd: Command { state: SlotState::Free, trb_phys: 0, code: 0, slot_id: 0, waiter: 0 },
+        devices: Vec::new(),
+        xfers: [FREE_XFER; MAX_TRANSFERS],
+        port_connected: alloc::vec![false; n_ports as usize],
+    });
+
+    // Completions by interrupt: MSI-X entry 0 (interrupter 0), else MSI,
+    // else the (usually shared) INTx line
+    let irq = pci.interrupt_line;
+    let msix_irq = crate::drivers::pci::msix_enable(pci)
+        .and_then(|t| t.bind(0, xhci_irq_handler, crate::drivers::pci::IrqAffinity::Spread));
+    let msi_irq = msix_irq.or_else(|| crate::drivers::pci::msi_enable(pci, xhci_irq_handler,
+        crate::drivers::pci::IrqAffinity::Spread));
+    let mut usbcmd = CMD_RUN;
+    if msi_irq.is_some() || (irq > 0 && irq < 32) {
+        if msi_irq.is_none() {
+            crate::arch::x86::irq::register_irq_chain(irq, xhci_irq_handler);
+            if crate::arch::x86::apic::is_initialized() {
+                crate::arch::x86::ioapic::unmask_irq(irq);
+            } else {
+                crate::arch::x86::pic::unmask(irq);
+            }
+        }
+        mmio_write32(rt, IR_IMAN, IMAN_IE | IMAN_IP);
+        usbcmd |= CMD_INTE;
+        with(|x| x.irq_enabled = true);
+        crate::serial_println!("  xHCI: IRQ {} registered ({})",
+            msi_irq.unwrap_or(irq),
+            if msix_irq.is_some() { "MSI-X" } else if msi_irq.is_some() { "MSI" } else { "INTx" });
+    } else {
+        crate::serial_println!("  xHCI: no valid IRQ ({}), transfers polled", irq);
+    }
+
+    mmio_write32(op, OP_USBCMD, usbcmd);
+    delay_ms(10);
+    let sts = mmio_read32(op, OP_USBSTS);
+    if sts & STS_HCH != 0 {
+        crate::serial_println!("  xHCI: controller failed to start (STS={:#010x})", sts);
+        *XHCI.lock() = None;
+        return;
+    }
+
+    if hcc1 & HCC_PPC != 0 {
+        for port in 1..=n_ports {
+            let portsc = mmio_read32(op, portsc_offset(port));
+            if portsc & PORTSC_PP == 0 {
+                mmio_write32(op, portsc_offset(port), (portsc & PORTSC_KEEP) | PORTSC_PP);
+            }
+        }
+    }
+    // Allow ports to power up and USB 3 links to train
+    delay_ms(100);
+    crate::serial_println!("  xHCI: controller running");
+
+    for port in 1..=n_ports {
+        let portsc = mmio_read32(op, portsc_offset(port));
+        if portsc & PORTSC_CCS == 0 {
+            continue;
+        }
+        with(|x| x.port_connected[port as usize - 1] = true);
+        crate::serial_println!("  xHCI: port {} — device connected, resetting...", port);
+        connect_port(op, port);
+    }
+}
+
+/// Poll xHCI root ports for hot-plug events. Called periodically from the
+/// USB poll thread.
+pub fn poll_ports() {
+    let Some((op, changes)) = with(|x| {
+        let mut changes = Vec::new();
+        for port in 1..=x.n_ports {
+            let reg = portsc_offset(port);
+            let portsc = mmio_read32(x.op, reg);
+            let connected = portsc & PORTSC_CCS != 0;
+            let was_connected = x.port_connected[port as usize - 1];
+            if portsc & PORTSC_CSC != 0 {
+                mmio_write32(x.op, reg, (portsc & PORTSC_KEEP) | PORTSC_CSC);
+                // Unplugged and plugged again between two polls
+                if connected && was_connected {
+                    changes.push((port, false));
+                    changes.push((port, true));
+                }
+            }
+            if connected != was_connected {
+                changes.push((port, connected));
+            }
+            x.port_connected[port as usize - 1] = connected;
+        }
+        (x.op, changes)
+    }) else {
+        return;
+    };
+
+    for (port, connected) in changes {
+        if connected {
+            crate::serial_println!("  xHCI: hot-plug — device connected on port {}", port);
+            connect_port(op, port);
+        } else {
+            crate::serial_println!("  xHCI: hot-unplug — device removed from port {}", port);
+            disconnect_port(port);
+        }
+    }
+}
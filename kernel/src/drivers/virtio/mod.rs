@@ -6,7 +6,7 @@
 pub mod virtqueue;
 
 use crate::drivers::pci::{self, PciDevice};
-use crate::memory::address::{PhysAddr, VirtAddr};
+use crate::memory::address::PhysAddr;
 use crate::memory::virtual_mem;
 
 // ──────────────────────────────────────────────
@@ -65,16 +65,17 @@ const COMMON_QUEUE_USED_LO: usize = 0x30;
 const COMMON_QUEUE_USED_HI: usize = 0x34;
 
 // ──────────────────────────────────────────────
-// MMIO Virtual Address Base for VirtIO Devices
+// BAR Mappings
 // ──────────────────────────────────────────────
 
-/// Base virtual address for mapping VirtIO BARs (after AHCI ABAR).
-const VIRTIO_MMIO_VIRT_BASE: u64 = 0xFFFF_FFFF_D008_0000;
 /// Maximum pages to map per BAR.
 const VIRTIO_MMIO_MAX_PAGES: usize = 16; // 64 KiB
+/// Maximum number of distinct BARs mapped (across all VirtIO devices).
+const MAX_MAPPED_BARS: usize = 12;
 
-// Track mapped BARs to avoid double-mapping
-static mut MAPPED_BARS: [u64; 6] = [0; 6]; // virt addr per BAR index, 0 = not mapped
+// Track mapped BARs to avoid double-mapping: (physical base, virtual base),
+// keyed by physical address so several VirtIO devices can coexist.
+static mut MAPPED_BARS: [(u64, u64); MAX_MAPPED_BARS] = [(0, 0); MAX_MAPPED_BARS];
 
 // ──────────────────────────────────────────────
 // Discovered PCI Capabilities
@@ -198,13 +199,6 @@ pub fn map_bar(pci: &PciDevice, bar_idx: u8) -> u64 {
         return 0;
     }
 
-    // Check if already mapped
-    unsafe {
-        if MAPPED_BARS[idx] != 0 {
-            return MAPPED_BARS[idx];
-        }
-    }
-
     let bar_value = pci.bars[idx];
     if bar_value == 0 {
         return 0;
@@ -228,19 +222,27 @@ pub fn map_bar(pci: &PciDevice, bar_idx: u8) -> u64 {
         phys_base
     };
 
-    // Calculate virtual address for this BAR
-    let virt_base = VIRTIO_MMIO_VIRT_BASE + (idx as u64) * (VIRTIO_MMIO_MAX_PAGES as u64 * 4096);
-
-    // Map pages
-    for i in 0..VIRTIO_MMIO_MAX_PAGES {
-        let virt = VirtAddr::new(virt_base + (i as u64) * 4096);
-        let phys = PhysAddr::new(phys_base + (i as u64) * 4096);
-        virtual_mem::map_page(virt, phys, 0x03); // Present | Writable
+    // Check if already mapped
+    let mapped = unsafe { &mut *core::ptr::addr_of_mut!(MAPPED_BARS) };
+    if let Some(&(_, virt)) = mapped.iter().find(|&&(phys, _)| phys == phys_base) {
+        return virt;
     }
+    let free = match mapped.iter_mut().find(|e| e.0 == 0) {
+        Some(e) => e,
+        None => {
+            crate::serial_println!("  VirtIO: too many BARs mapped, cannot map BAR{}", bar_idx);
+            return 0;
+        }
+    };
 
-    unsafe {
-        MAPPED_BARS[idx] = virt_base;
-    }
+    let virt_base = match virtual_mem::map_mmio(PhysAddr::new(phys_base), VIRTIO_MMIO_MAX_PAGES) {
+        Some(v) => v.as_u64(),
+        None => {
+            crate::serial_println!("  VirtIO: MMIO window exhausted, cannot map BAR{}", bar_idx);
+            return 0;
+        }
+    };
+    *free = (phys_base, virt_base);
 
     crate::serial_println!("  VirtIO: BAR{} phys={:#x} mapped to virt={:#x} ({} pages)",
         bar_idx, phys_base, virt_base, VIRTIO_MMIO_MAX_PAGES);
@@ -1,7 +1,10 @@
 //! Split virtqueue implementation for VirtIO devices.
 //!
 //! Implements the split ring layout: descriptor table, available ring, used ring.
-//! Supports synchronous polled I/O with descriptor chaining for request/response pairs.
+//! Supports synchronous polled I/O with descriptor chaining for request/response pairs,
+//! and for drivers with several requests in flight: indirect descriptor tables
+//! (`VIRTIO_RING_F_INDIRECT_DESC`), deferred notification and interrupt control
+//! through the event indices (`VIRTIO_RING_F_EVENT_IDX`).
 
 use crate::memory::physical;
 
@@ -13,6 +16,16 @@ use crate::memory::physical;
 const VIRTQ_DESC_F_NEXT: u16 = 1;
 /// Buffer is device-writable (response/read-back).
 const VIRTQ_DESC_F_WRITE: u16 = 2;
+/// Buffer holds a table of indirect descriptors.
+const VIRTQ_DESC_F_INDIRECT: u16 = 4;
+
+/// Available ring flag: driver does not want interrupts.
+const VIRTQ_AVAIL_F_NO_INTERRUPT: u16 = 1;
+/// Used ring flag: device does not need notifications.
+const VIRTQ_USED_F_NO_NOTIFY: u16 = 1;
+
+/// Size in bytes of one descriptor (ring or indirect table entry).
+pub const VIRTQ_DESC_SIZE: usize = 16;
 
 // ──────────────────────────────────────────────
 // Descriptor Entry (16 bytes)
@@ -52,6 +65,10 @@ pub struct VirtQueue {
     last_used_idx: u16,
     /// Number of free descriptors available.
     num_free: u16,
+    /// Use `used_event`/`avail_event` instead of the ring flags.
+    event_idx: bool,
+    /// Available index at the last device notification.
+    kicked_idx: u16,
 }
 
 // VirtQueue contains raw pointers but is only accessed under a Spinlock
@@ -111,9 +128,8 @@ impl VirtQueue {
         // are unnecessary. Without this, every completed command asserts the PCI
         // INTx line. Since no ISR handler deasserts it, level-triggered delivery
         // causes an interrupt storm that starves the main thread.
-        // VIRTQ_AVAIL_F_NO_INTERRUPT = 1
         unsafe {
-            core::ptr::write_volatile(avail, 1u16);
+            core::ptr::write_volatile(avail, VIRTQ_AVAIL_F_NO_INTERRUPT);
         }
 
         Some(VirtQueue {
@@ -127,6 +143,8 @@ impl VirtQueue {
             free_head: 0,
             last_used_idx: 0,
             num_free: queue_size,
+            event_idx: false,
+            kicked_idx: 0,
         })
     }
 
@@ -154,6 +172,11 @@ impl VirtQueue {
         unsafe { core::ptr::write_volatile(self.avail.add(1), val); }
     }
 
+    /// Write `used_event` (the slot after the last available ring entry).
+    fn set_used_event(&self, val: u16) {
+        unsafe { core::ptr::write_volatile(self.avail.add(2 + self.queue_size as usize), val); }
+    }
+
     /// Write to available ring entry at position `pos`.
     fn set_avail_ring(&self, pos: u16, desc_idx: u16) {
         // ring starts at offset 2 (after flags and idx)
@@ -168,6 +191,17 @@ impl VirtQueue {
         unsafe { core::ptr::read_volatile(ptr) }
     }
 
+    /// Read used ring flags.
+    fn used_flags(&self) -> u16 {
+        unsafe { core::ptr::read_volatile(self.used as *const u16) }
+    }
+
+    /// Read `avail_event` (the slot after the last used ring entry).
+    fn avail_event(&self) -> u16 {
+        let ptr = (self.used as u64 + 4 + self.queue_size as u64 * 8) as *const u16;
+        unsafe { core::ptr::read_volatile(ptr) }
+    }
+
     /// Read used ring entry at position `pos`: returns (descriptor id, bytes written).
     fn used_ring_entry(&self, pos: u16) -> (u32, u32) {
         // Used ring entries start at offset 4: each entry is {id:u32, len:u32} = 8 bytes
@@ -273,6 +307,54 @@ impl VirtQueue {
             desc.flags &= !VIRTQ_DESC_F_NEXT;
         }
 
+        self.publish(head);
+        Some(head)
+    }
+
+    /// Submit a request-response pair through an indirect descriptor table.
+    ///
+    /// The chain is written to the table at `table_phys` (identity-mapped,
+    /// room for `readable.len() + writable.len()` descriptors) and costs a
+    /// single ring descriptor.  Requires `VIRTIO_RING_F_INDIRECT_DESC`; the
+    /// table must stay untouched until the request completes.
+    pub fn push_indirect(
+        &mut self,
+        table_phys: u64,
+        readable: &[(u64, u32)],
+        writable: &[(u64, u32)],
+    ) -> Option<u16> {
+        let total = readable.len() + writable.len();
+        if total == 0 {
+            return None;
+        }
+        let head = self.alloc_desc()?;
+
+        let table = table_phys as *mut VirtqDesc;
+        let entries = readable.iter().map(|&e| (e, 0)).chain(writable.iter().map(|&e| (e, VIRTQ_DESC_F_WRITE)));
+        for (i, ((addr, len), flags)) in entries.enumerate() {
+            let next = i + 1 < total;
+            unsafe {
+                table.add(i).write_volatile(VirtqDesc {
+                    addr,
+                    len,
+                    flags: flags | if next { VIRTQ_DESC_F_NEXT } else { 0 },
+                    next: if next { (i + 1) as u16 } else { 0 },
+                });
+            }
+        }
+
+        let desc = unsafe { &mut *self.desc.add(head as usize) };
+        desc.addr = table_phys;
+        desc.len = (total * VIRTQ_DESC_SIZE) as u32;
+        desc.flags = VIRTQ_DESC_F_INDIRECT;
+        desc.next = 0;
+
+        self.publish(head);
+        Some(head)
+    }
+
+    /// Make the chain starting at `head` available to the device.
+    fn publish(&mut self, head: u16) {
         // Memory fence to ensure descriptor writes are visible before avail ring update
         core::sync::atomic::fence(core::sync::atomic::Ordering::Release);
 
@@ -284,8 +366,57 @@ impl VirtQueue {
         core::sync::atomic::fence(core::sync::atomic::Ordering::Release);
 
         self.set_avail_idx(avail_idx.wrapping_add(1));
+    }
 
-        Some(head)
+    /// Number of free ring descriptors.
+    pub fn num_free(&self) -> u16 { self.num_free }
+
+    /// Switch to event-index suppression (`VIRTIO_RING_F_EVENT_IDX` negotiated).
+    pub fn set_event_idx(&mut self, enabled: bool) {
+        self.event_idx = enabled;
+    }
+
+    /// Whether the device must be notified of the buffers published since
+    /// the last call.  Call after one or more `push`es; notify when true.
+    pub fn kick_needed(&mut self) -> bool {
+        // Our avail_idx store must be visible before we read the device's
+        // suppression state, or both sides could wait for each other.
+        core::sync::atomic::fence(core::sync::atomic::Ordering::SeqCst);
+        let new = self.avail_idx();
+        let old = core::mem::replace(&mut self.kicked_idx, new);
+        if self.event_idx {
+            // vring_need_event(): did avail_event fall in (old, new]?
+            new.wrapping_sub(self.avail_event()).wrapping_sub(1) < new.wrapping_sub(old)
+        } else {
+            self.used_flags() & VIRTQ_USED_F_NO_NOTIFY == 0
+        }
+    }
+
+    /// Ask for an interrupt at the next used buffer.
+    ///
+    /// Returns `false` if buffers were used meanwhile: the device may have
+    /// passed the event before it was armed, so the caller must poll again
+    /// rather than wait for an interrupt.
+    pub fn enable_interrupts(&mut self) -> bool {
+        if self.event_idx {
+            self.set_used_event(self.last_used_idx);
+        } else {
+            unsafe { core::ptr::write_volatile(self.avail, 0); }
+        }
+        core::sync::atomic::fence(core::sync::atomic::Ordering::SeqCst);
+        self.used_idx() == self.last_used_idx
+    }
+
+    /// Suppress used-buffer interrupts (best effort, the device may still
+    /// send one that was already pending).
+    pub fn disable_interrupts(&mut self) {
+        if self.event_idx {
+            // Park the event half a ring-index space away; it is re-armed
+            // long before the used index could get there.
+            self.set_used_event(self.last_used_idx.wrapping_add(0x8000));
+        } else {
+            unsafe { core::ptr::write_volatile(self.avail, VIRTQ_AVAIL_F_NO_INTERRUPT); }
+        }
     }
 
     /// Check the used ring for completed requests.
@@ -0,0 +1,72 @@
+//! Directory entry lookup cache for the FAT and exFAT drivers.
+//!
+//! Maps `(directory first cluster, name)` to the parsed entry, or to "not
+//! present" (negative entry), so repeated `open`/`stat` of the same paths
+//! walk memory instead of reading and scanning directory clusters.  Names
+//! are keyed ASCII-uppercased, matching the drivers' case-insensitive
+//! comparisons.
+//!
+//! The owning driver keeps the cache coherent: every change to a directory
+//! entry forgets that `(dir, name)`, and freeing a cluster chain forgets
+//! every entry cached under it, since the cluster may later start a new
+//! directory.  Like the drivers' other caches it is only touched under the
+//! VFS lock.
+
+use alloc::collections::BTreeMap;
+use alloc::string::String;
+
+/// Cached entries per mount before the least recently used is evicted.
+const CAPACITY: usize = 1024;
+
+/// LRU cache of directory lookups; `None` values are negative entries.
+pub struct DentryCache<T: Clone> {
+    map: BTreeMap<(u32, String), (Option<T>, u32)>,
+    tick: u32,
+}
+
+fn key(dir: u32, name: &str) -> (u32, String) {
+    (dir, name.to_ascii_uppercase())
+}
+
+impl<T: Clone> DentryCache<T> {
+    pub const fn new() -> Self {
+        DentryCache { map: BTreeMap::new(), tick: 0 }
+    }
+
+    /// `Some(entry)` for a cached lookup (`entry` is `None` when the name is
+    /// known not to exist), `None` on a miss.
+    pub fn get(&mut self, dir: u32, name: &str) -> Option<Option<T>> {
+        self.tick = self.tick.wrapping_add(1);
+        let tick = self.tick;
+        let slot = self.map.get_mut(&key(dir, name))?;
+        slot.1 = tick;
+        Some(slot.0.clone())
+    }
+
+    /// Record the result of a directory scan for `name`.
+    pub fn insert(&mut self, dir: u32, name: &str, entry: Option<T>) {
+        if self.map.len() >= CAPACITY {
+            let oldest = self.map.iter()
+                .max_by_key(|(_, (_, used))| self.tick.wrapping_sub(*used))
+                .map(|(k, _)| k.clone());
+            if let Some(k) = oldest {
+                self.map.remove(&k);
+            }
+        }
+        self.tick = self.tick.wrapping_add(1);
+        self.map.insert(key(dir, name), (entry, self.tick));
+    }
+
+    /// Drop the cached lookup of `name` in `dir` (entry created, changed,
+    /// renamed or deleted).
+    pub fn forget(&mut self, dir: u32, name: &str) {
+        self.map.remove(&key(dir, name));
+    }
+
+    /// Drop every lookup cached under directory `dir` (its clusters were freed).
+    pub fn forget_dir(&mut self, dir: u32) {
+        if !self.map.is_empty() {
+            self.map.retain(|(d, _), _| *d != dir);
+        }
+    }
+}
@@ -92,7 +92,7 @@ impl DevFs {
                 file_type: FileType::Device,
                 size: 0,
                 is_symlink: false,
-                uid: 0, gid: 0, mode: 0xFFF,
+                uid: 0, gid: 0, mode: 0xFFF, mtime: 0,
             })
             .collect()
     }
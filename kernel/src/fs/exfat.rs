@@ -2,8 +2,10 @@
 //! Supports reading and writing files/directories on an exFAT partition.
 //! Designed to coexist with the FAT16 driver — VFS auto-detects which to use.
 
-use crate::fs::file::{DirEntry, FileType};
+use crate::fs::file::{DirEntry, FileType, RangeReadPlan};
 use crate::fs::vfs::FsError;
+use crate::fs::dentry::DentryCache;
+use crate::fs::writeback::{self, DirtyClusters, DirtySectors};
 use alloc::string::String;
 use alloc::vec;
 use alloc::vec::Vec;
@@ -42,6 +44,9 @@ fn storage_write_sectors(abs_lba: u32, count: u32, buf: &[u8]) -> bool {
 /// 16 slots × cluster_size (typically 4 KiB) = 64 KiB of cached directory data.
 const CLUSTER_CACHE_SLOTS: usize = 16;
 
+/// A pending tail is given clusters once it holds this many bytes.
+const TAIL_LIMIT: usize = 1024 * 1024;
+
 struct CacheEntry {
     /// Cluster number (0 = empty; valid exFAT clusters start at 2).
     cluster: u32,
@@ -203,6 +208,7 @@ pub fn decode_inode(inode: u32) -> (u32, bool) {
 }
 
 /// Information about a found exFAT directory entry set.
+#[derive(Clone)]
 struct FoundEntry {
     first_cluster: u32,
     data_length: u64,
@@ -244,6 +250,36 @@ pub struct ExFatFs {
     /// requiring `&mut self`.  Safe because `ExFatFs` is always accessed while
     /// the VFS `Mutex` is held — at most one CPU touches this at a time.
     cluster_cache: core::cell::UnsafeCell<ClusterCache>,
+    /// FAT sectors changed since the last sync.
+    dirty_fat: DirtySectors,
+    /// Bitmap sectors changed since the last sync.
+    dirty_bitmap: DirtySectors,
+    /// Written cluster contents not yet on disk (same `UnsafeCell`
+    /// rationale as `cluster_cache`).
+    dirty: core::cell::UnsafeCell<DirtyClusters>,
+    /// `writeback::now_ms()` of the oldest unsynced change (0 = clean).
+    dirty_since: core::cell::Cell<u32>,
+    /// Data appended past the end of a file's cluster chain.  Clusters are
+    /// only allocated when the tail is placed, so a file written in many
+    /// small appends still gets one contiguous run.
+    pending: Vec<PendingTail>,
+    /// Free clusters according to the bitmap.
+    free_clusters: u32,
+    /// Clusters promised to pending tails.
+    reserved: u32,
+    /// Path component lookups (same `UnsafeCell` rationale as `cluster_cache`).
+    dentries: core::cell::UnsafeCell<DentryCache<FoundEntry>>,
+}
+
+/// Unallocated data at the end of a file (delayed allocation).
+struct PendingTail {
+    /// First cluster of the file (its inode).
+    first: u32,
+    /// Last allocated cluster of the chain.
+    last: u32,
+    /// File offset of `data[0]`: the end of the allocated chain.
+    base: u32,
+    data: Vec<u8>,
 }
 
 /// Pre-computed read plan for exFAT files (matches FAT16 FileReadPlan pattern).
@@ -363,6 +399,14 @@ impl ExFatFs {
             bitmap_cluster: 0,
             bitmap_contiguous: true,
             cluster_cache: core::cell::UnsafeCell::new(ClusterCache::new()),
+            dirty_fat: DirtySectors::new(),
+            dirty_bitmap: DirtySectors::new(),
+            dirty: core::cell::UnsafeCell::new(DirtyClusters::new()),
+            dirty_since: core::cell::Cell::new(0),
+            pending: Vec::new(),
+            free_clusters: 0,
+            reserved: 0,
+            dentries: core::cell::UnsafeCell::new(DentryCache::new()),
         };
 
         // Scan root directory for the allocation bitmap entry
@@ -425,6 +469,9 @@ impl ExFatFs {
         // SAFETY: ExFatFs is always accessed while the VFS Mutex is held,
         // guaranteeing single-threaded access to the cache.
         let cache = unsafe { &mut *self.cluster_cache.get() };
+        if unsafe { &*self.dirty.get() }.get(cluster, buf) {
+            return Ok(());
+        }
         if cache.lookup(cluster, buf) {
             crate::debug_println!("  [exFAT] read_cluster: CACHE HIT cluster={}", cluster);
             return Ok(());
@@ -436,20 +483,32 @@ impl ExFatFs {
         Ok(())
     }
 
+    /// Buffer new contents for `cluster`; they reach the disk at the next
+    /// flush (see [`writeback`]).
     fn write_cluster(&self, cluster: u32, buf: &[u8]) -> Result<(), FsError> {
-        // Invalidate cached copy so next read reflects the new on-disk content.
+        // The dirty copy supersedes any cached one.
         // SAFETY: same as read_cluster — VFS mutex ensures single-threaded access.
         let cache = unsafe { &mut *self.cluster_cache.get() };
         cache.invalidate(cluster);
 
-        let lba = self.cluster_to_lba(cluster);
         let cs = self.cluster_size() as usize;
-        if buf.len() >= cs {
-            self.write_sectors(lba, self.sectors_per_cluster(), &buf[..cs])
-        } else {
-            let mut tmp = vec![0u8; cs];
-            tmp[..buf.len()].copy_from_slice(buf);
-            self.write_sectors(lba, self.sectors_per_cluster(), &tmp)
+        let mut data = vec![0u8; cs];
+        let n = buf.len().min(cs);
+        data[..n].copy_from_slice(&buf[..n]);
+        let dirty = unsafe { &mut *self.dirty.get() };
+        dirty.put(cluster, data);
+        self.touch();
+        if dirty.bytes() > writeback::DIRTY_LIMIT {
+            self.flush_clusters()?;
+        }
+        Ok(())
+    }
+
+    /// Record that unsynced changes exist.
+    #[inline]
+    fn touch(&self) {
+        if self.dirty_since.get() == 0 {
+            self.dirty_since.set(writeback::now_ms().max(1));
         }
     }
 
@@ -476,7 +535,8 @@ impl ExFatFs {
         }
     }
 
-    /// Write an entry to the in-memory FAT cache and flush that sector to disk.
+    /// Write an entry to the in-memory FAT cache; the sector is written
+    /// back at the next sync.
     fn write_fat_entry(&mut self, cluster: u32, value: u32) -> Result<(), FsError> {
         let off = (cluster as usize) * 4;
         if off + 3 >= self.fat_cache.len() {
@@ -484,14 +544,9 @@ impl ExFatFs {
         }
         let bytes = value.to_le_bytes();
         self.fat_cache[off..off + 4].copy_from_slice(&bytes);
-
-        // Write-through: flush the containing 512-byte sector
-        let sector_idx = off / 512;
-        let sector_start = sector_idx * 512;
-        let mut sector_buf = [0u8; 512];
-        sector_buf.copy_from_slice(&self.fat_cache[sector_start..sector_start + 512]);
-        let abs_lba = self.partition_start_lba + self.fat_offset + sector_idx as u32;
-        self.write_sectors(abs_lba, 1, &sector_buf)
+        self.dirty_fat.mark((off / 512) as u32);
+        self.touch();
+        Ok(())
     }
 
     // =================================================================
@@ -545,6 +600,9 @@ impl ExFatFs {
                     self.read_sectors(lba, total_sectors, &mut raw)?;
                     raw.truncate(bm_size as usize);
                     self.bitmap = raw;
+                    self.free_clusters = (0..self.cluster_count as usize)
+                        .filter(|&i| i / 8 < self.bitmap.len() && self.bitmap[i / 8] & (1 << (i % 8)) == 0)
+                        .count() as u32;
 
                     crate::serial_println!(
                         "  exFAT: allocation bitmap at cluster {}, {} bytes",
@@ -572,33 +630,53 @@ impl ExFatFs {
         Err(FsError::IoError)
     }
 
-    /// Flush a single modified byte of the bitmap back to disk.
-    fn flush_bitmap_byte(&self, byte_idx: usize) -> Result<(), FsError> {
-        let cs = self.cluster_size() as usize;
-        let cluster_idx = byte_idx / cs;
-        let offset_in_cluster = byte_idx % cs;
-        let target_cluster = self.bitmap_cluster + cluster_idx as u32;
-
-        let sector_in_cluster = offset_in_cluster / 512;
-        let lba = self.cluster_to_lba(target_cluster) + sector_in_cluster as u32;
+    /// Whether bitmap entry `idx` (cluster `idx + 2`) is free.
+    #[inline]
+    fn bitmap_free(&self, idx: u32) -> bool {
+        let byte = idx as usize / 8;
+        byte < self.bitmap.len() && self.bitmap[byte] & (1 << (idx % 8)) == 0
+    }
 
-        let mut sector_buf = [0u8; 512];
-        self.read_sectors(lba, 1, &mut sector_buf)?;
-        sector_buf[offset_in_cluster % 512] = self.bitmap[byte_idx];
-        self.write_sectors(lba, 1, &sector_buf)
+    /// Set or clear bitmap entry `idx`; the sector is written back at sync.
+    fn set_bitmap(&mut self, idx: u32, used: bool) {
+        let byte = idx as usize / 8;
+        if byte >= self.bitmap.len() {
+            return;
+        }
+        let bit = 1u8 << (idx % 8);
+        let was_used = self.bitmap[byte] & bit != 0;
+        if was_used == used {
+            return;
+        }
+        if used {
+            self.bitmap[byte] |= bit;
+            self.free_clusters -= 1;
+        } else {
+            self.bitmap[byte] &= !bit;
+            self.free_clusters += 1;
+        }
+        self.dirty_bitmap.mark((byte / 512) as u32);
+        self.touch();
     }
 
     /// Allocate a single cluster. Marks bitmap + writes EOC to FAT.
+    /// Clusters reserved for pending tails are not handed out.
     fn alloc_cluster(&mut self) -> Result<u32, FsError> {
-        for i in 0..self.cluster_count {
-            let byte_idx = i as usize / 8;
-            let bit_idx = i as usize % 8;
-            if byte_idx >= self.bitmap.len() {
-                break;
-            }
-            if self.bitmap[byte_idx] & (1 << bit_idx) == 0 {
-                self.bitmap[byte_idx] |= 1 << bit_idx;
-                self.flush_bitmap_byte(byte_idx)?;
+        if self.free_clusters <= self.reserved {
+            return Err(FsError::NoSpace);
+        }
+        self.alloc_cluster_from(0)
+    }
+
+    /// Next-fit allocation: the first free cluster at or after bitmap entry
+    /// `hint`, wrapping around.
+    fn alloc_cluster_from(&mut self, hint: u32) -> Result<u32, FsError> {
+        let n = self.cluster_count;
+        let start = if hint < n { hint } else { 0 };
+        for k in 0..n {
+            let i = (start + k) % n;
+            if self.bitmap_free(i) {
+                self.set_bitmap(i, true);
                 let cluster = i + 2;
                 self.write_fat_entry(cluster, EXFAT_EOC)?;
                 return Ok(cluster);
@@ -607,6 +685,32 @@ impl ExFatFs {
         Err(FsError::NoSpace)
     }
 
+    /// Find `count` consecutive free bitmap entries, preferring the first
+    /// run at or after `hint`.  Returns the first entry.
+    fn find_free_run(&self, hint: u32, count: u32) -> Option<u32> {
+        let n = self.cluster_count;
+        let scan = |from: u32, to: u32| -> Option<u32> {
+            let mut run_start = from;
+            let mut run_len = 0u32;
+            for i in from..to {
+                if self.bitmap_free(i) {
+                    if run_len == 0 {
+                        run_start = i;
+                    }
+                    run_len += 1;
+                    if run_len == count {
+                        return Some(run_start);
+                    }
+                } else {
+                    run_len = 0;
+                }
+            }
+            None
+        };
+        let hint = hint.min(n);
+        scan(hint, n).or_else(|| scan(0, n))
+    }
+
     /// Free a cluster chain (FAT-chained or contiguous).
     fn free_chain(
         &mut self,
@@ -617,29 +721,28 @@ impl ExFatFs {
         if start < 2 {
             return Ok(());
         }
+        // A freed directory's lookups must not outlive its clusters.
+        unsafe { &mut *self.dentries.get() }.forget_dir(start);
+        // Unwritten data of the file dies with it.
+        if let Some(i) = self.pending.iter().position(|t| t.first == start) {
+            let tail = self.pending.swap_remove(i);
+            self.reserved -= self.clusters_for(tail.data.len());
+        }
+        // SAFETY: VFS mutex held (see `cluster_cache`).
+        let dirty = unsafe { &mut *self.dirty.get() };
         if contiguous {
             let cs = self.cluster_size() as u64;
             let n = ((data_length + cs - 1) / cs) as u32;
             for j in 0..n {
-                let idx = (start - 2 + j) as usize;
-                let byte = idx / 8;
-                let bit = idx % 8;
-                if byte < self.bitmap.len() {
-                    self.bitmap[byte] &= !(1 << bit);
-                    self.flush_bitmap_byte(byte)?;
-                }
+                self.set_bitmap(start - 2 + j, false);
+                dirty.remove(start + j);
             }
         } else {
             let mut c = start;
             loop {
                 let next = self.next_cluster(c);
-                let idx = (c - 2) as usize;
-                let byte = idx / 8;
-                let bit = idx % 8;
-                if byte < self.bitmap.len() {
-                    self.bitmap[byte] &= !(1 << bit);
-                    self.flush_bitmap_byte(byte)?;
-                }
+                self.set_bitmap(c - 2, false);
+                dirty.remove(c);
                 self.write_fat_entry(c, EXFAT_FREE)?;
                 match next {
                     Some(n) => c = n,
@@ -650,6 +753,137 @@ impl ExFatFs {
         Ok(())
     }
 
+    // =================================================================
+    // Write-back
+    // =================================================================
+
+    /// Clusters needed to hold `bytes`.
+    #[inline]
+    fn clusters_for(&self, bytes: usize) -> u32 {
+        let cs = self.cluster_size() as usize;
+        ((bytes + cs - 1) / cs) as u32
+    }
+
+    /// Write all dirty clusters to disk in merged runs.  On failure the
+    /// unwritten clusters stay dirty.
+    fn flush_clusters(&self) -> Result<(), FsError> {
+        // SAFETY: VFS mutex held (see `cluster_cache`).
+        let dirty = unsafe { &mut *self.dirty.get() };
+        if dirty.is_empty() {
+            return Ok(());
+        }
+        let cs = self.cluster_size() as usize;
+        let mut runs = dirty.take_runs().into_iter();
+        while let Some((cluster, data)) = runs.next() {
+            let lba = self.cluster_to_lba(cluster);
+            if self.write_sectors(lba, (data.len() / 512) as u32, &data).is_err() {
+                for (c, d) in core::iter::once((cluster, data)).chain(runs) {
+                    for (i, chunk) in d.chunks(cs).enumerate() {
+                        dirty.put(c + i as u32, chunk.to_vec());
+                    }
+                }
+                return Err(FsError::IoError);
+            }
+        }
+        Ok(())
+    }
+
+    /// Write the dirty bitmap sectors (the bitmap is contiguous on disk).
+    fn flush_bitmap(&mut self) -> Result<(), FsError> {
+        let base = self.cluster_to_lba(self.bitmap_cluster);
+        for (first, count) in self.dirty_bitmap.take_runs() {
+            let from = first as usize * 512;
+            let to = (from + count as usize * 512).min(self.bitmap.len());
+            let mut buf = vec![0u8; count as usize * 512];
+            buf[..to - from].copy_from_slice(&self.bitmap[from..to]);
+            if let Err(e) = self.write_sectors(base + first, count, &buf) {
+                for s in first..first + count {
+                    self.dirty_bitmap.mark(s);
+                }
+                return Err(e);
+            }
+        }
+        Ok(())
+    }
+
+    /// Write the dirty FAT sectors.
+    fn flush_fat(&mut self) -> Result<(), FsError> {
+        let base = self.partition_start_lba + self.fat_offset;
+        for (first, count) in self.dirty_fat.take_runs() {
+            let from = first as usize * 512;
+            let to = from + count as usize * 512;
+            if let Err(e) = self.write_sectors(base + first, count, &self.fat_cache[from..to]) {
+                for s in first..first + count {
+                    self.dirty_fat.mark(s);
+                }
+                return Err(e);
+            }
+        }
+        Ok(())
+    }
+
+    /// Allocate clusters for pending tail `idx` — one contiguous run after
+    /// the chain's last cluster when the bitmap has one — link them and
+    /// move the data into the dirty cluster buffer.
+    fn place_tail(&mut self, idx: usize) -> Result<(), FsError> {
+        let tail = self.pending.swap_remove(idx);
+        let n = self.clusters_for(tail.data.len());
+        self.reserved -= n;
+        if n == 0 {
+            return Ok(());
+        }
+        let cs = self.cluster_size() as usize;
+        let run = self.find_free_run(tail.last - 1, n);
+        let mut prev = tail.last;
+        for (i, chunk) in tail.data.chunks(cs).enumerate() {
+            let c = match run {
+                Some(first) => {
+                    let c = first + 2 + i as u32;
+                    self.set_bitmap(c - 2, true);
+                    self.write_fat_entry(c, EXFAT_EOC)?;
+                    c
+                }
+                None => self.alloc_cluster_from(prev - 1)?,
+            };
+            self.write_fat_entry(prev, c)?;
+            self.write_cluster(c, chunk)?;
+            prev = c;
+        }
+        Ok(())
+    }
+
+    /// Put the data of the file starting at `inode` on disk so a read plan
+    /// built from the FAT sees it.
+    fn settle_file(&mut self, inode: u32) {
+        let (first, _) = decode_inode(inode);
+        let placed = match self.pending.iter().position(|t| t.first == first) {
+            Some(i) => self.place_tail(i),
+            None => Ok(()),
+        };
+        if let Err(e) = placed.and_then(|_| self.flush_clusters()) {
+            crate::serial_println!("  exFAT: write-back before read failed: {:?}", e);
+        }
+    }
+
+    /// Write every buffered change to disk: pending tails get clusters,
+    /// then data clusters, the bitmap and the FAT are written in that order.
+    pub fn sync(&mut self) -> Result<(), FsError> {
+        while !self.pending.is_empty() {
+            self.place_tail(self.pending.len() - 1)?;
+        }
+        self.flush_clusters()?;
+        self.flush_bitmap()?;
+        self.flush_fat()?;
+        self.dirty_since.set(0);
+        Ok(())
+    }
+
+    /// Whether the oldest unsynced change is older than `writeback::EXPIRE_MS`.
+    pub fn writeback_due(&self, now: u32) -> bool {
+        let since = self.dirty_since.get();
+        since != 0 && now.wrapping_sub(since) >= writeback::EXPIRE_MS
+    }
+
     // =================================================================
     // Directory entry parsing
     // =================================================================
@@ -703,6 +937,26 @@ impl ExFatFs {
         Ok(result)
     }
 
+    /// Find `name` in the directory starting at `dir_cluster`, consulting the
+    /// dentry cache before scanning the directory.
+    fn find_entry(&self, dir_cluster: u32, name: &str) -> Result<Option<FoundEntry>, FsError> {
+        // SAFETY: VFS mutex held (see `cluster_cache`).
+        let dentries = unsafe { &mut *self.dentries.get() };
+        if let Some(hit) = dentries.get(dir_cluster, name) {
+            return Ok(hit);
+        }
+        let raw = self.read_dir_raw(dir_cluster)?;
+        let found = self.find_entry_in_buf(&raw, name);
+        dentries.insert(dir_cluster, name, found.clone());
+        Ok(found)
+    }
+
+    /// Drop the cached lookup of `name` in `dir_cluster` before its entry changes.
+    #[inline]
+    fn forget_entry(&self, dir_cluster: u32, name: &str) {
+        unsafe { &mut *self.dentries.get() }.forget(dir_cluster, name);
+    }
+
     /// Collect the UTF-16 name from an entry set starting at `base_offset` in `buf`.
     fn collect_name(buf: &[u8], base_offset: usize, secondary_count: u8, name_length: usize) -> Vec<u16> {
         let total = 1 + secondary_count as usize;
@@ -854,6 +1108,7 @@ impl ExFatFs {
             let mode = u16::from_le_bytes([buf[i + 10], buf[i + 11]]);
             // Default mode 0xFFF if unset (all zeros on disk means legacy/unset)
             let mode = if mode == 0 { 0xFFF } else { mode };
+            let mtime = exfat_timestamp_to_unix(u32::from_le_bytes(buf[i + 12..i + 16].try_into().unwrap()));
 
             entries.push(DirEntry {
                 name: name_str,
@@ -863,6 +1118,7 @@ impl ExFatFs {
                 uid,
                 gid,
                 mode,
+                mtime,
             });
 
             i += total * 32;
@@ -899,9 +1155,7 @@ impl ExFatFs {
 
         for (idx, component) in components.iter().enumerate() {
             let is_last = idx == components.len() - 1;
-            let dir_data = self.read_dir_raw(current_cluster)?;
-
-            match self.find_entry_in_buf(&dir_data, component) {
+            match self.find_entry(current_cluster, component)? {
                 Some(found) => {
                     let is_dir = found.attributes & ATTR_DIRECTORY != 0;
                     if is_last {
@@ -934,8 +1188,7 @@ impl ExFatFs {
         dir_cluster: u32,
         name: &str,
     ) -> Result<(u32, FileType, u32, bool, u16, u16, u16, u32), FsError> {
-        let raw = self.read_dir_raw(dir_cluster)?;
-        match self.find_entry_in_buf(&raw, name) {
+        match self.find_entry(dir_cluster, name)? {
             Some(found) => {
                 let is_symlink = found.attributes & ATTR_SYMLINK != 0;
                 let is_dir = found.attributes & ATTR_DIRECTORY != 0;
@@ -960,9 +1213,7 @@ impl ExFatFs {
 
         for (idx, component) in components.iter().enumerate() {
             let is_last = idx == components.len() - 1;
-            let dir_data = self.read_dir_raw(current_cluster)?;
-
-            match self.find_entry_in_buf(&dir_data, component) {
+            match self.find_entry(current_cluster, component)? {
                 Some(found) => {
                     if is_last {
                         return Ok((found.uid, found.gid, found.mode));
@@ -1019,6 +1270,8 @@ impl ExFatFs {
             }
         };
 
+        self.forget_entry(parent_cluster, filename);
+
         // Walk clusters to find the entry and modify it in-place
         let cs = self.cluster_size() as usize;
         let mut cur = parent_cluster;
@@ -1077,6 +1330,8 @@ impl ExFatFs {
         if start_cluster < 2 || buf.is_empty() {
             return Ok(0);
         }
+        // Reads below go straight to the sectors.
+        self.flush_clusters()?;
 
         let cs = self.cluster_size();
         let spc = self.sectors_per_cluster();
@@ -1221,8 +1476,10 @@ impl ExFatFs {
         Ok(bytes_read)
     }
 
-    /// Build a read plan (for lock-free I/O in `read_file_to_vec`).
-    pub fn get_file_read_plan(&self, inode: u32, file_size: u32) -> ExFatReadPlan {
+    /// Build a read plan (for lock-free I/O in `read_file_to_vec`).  The
+    /// file's buffered data is written out first.
+    pub fn get_file_read_plan(&mut self, inode: u32, file_size: u32) -> ExFatReadPlan {
+        self.settle_file(inode);
         let (start_cluster, contiguous) = decode_inode(inode);
         let spc = self.sectors_per_cluster();
         let mut runs = Vec::new();
@@ -1264,13 +1521,38 @@ impl ExFatFs {
         ExFatReadPlan { runs, file_size: file_size_u64 }
     }
 
+    /// Build a read plan for `len` bytes at `offset`.  Buffered writes are
+    /// written out first; the plan itself reads after the VFS lock is dropped.
+    pub fn get_range_read_plan(&mut self, inode: u32, offset: u32, len: usize) -> RangeReadPlan {
+        self.settle_file(inode);
+        let (start_cluster, contiguous) = decode_inode(inode);
+        if contiguous {
+            // No FAT chain: clusters follow each other on disk.
+            RangeReadPlan::from_chain(
+                start_cluster, self.sectors_per_cluster(), offset, len,
+                |c| self.cluster_to_lba(c), |c| Some(c + 1),
+            )
+        } else {
+            RangeReadPlan::from_chain(
+                start_cluster, self.sectors_per_cluster(), offset, len,
+                |c| self.cluster_to_lba(c), |c| self.next_cluster(c),
+            )
+        }
+    }
+
     // =================================================================
     // Public API — file write
     // =================================================================
 
-    /// Write data to a file at the given offset, allocating clusters as needed.
+    /// Write data to a file at the given offset.
     /// Returns `(new_inode, new_size)`. The returned inode does NOT have the
     /// contiguous bit set (writes may fragment the file).
+    ///
+    /// Bytes inside the allocated chain go to the dirty cluster buffer.
+    /// Bytes past it go to the file's pending tail and only get clusters
+    /// when the tail is placed (delayed allocation); space for them is
+    /// reserved up front so placement cannot fail with `NoSpace`.  The first
+    /// cluster of an empty file is allocated immediately: it is the inode.
     pub fn write_file(
         &mut self,
         inode: u32,
@@ -1278,75 +1560,116 @@ impl ExFatFs {
         data: &[u8],
         old_size: u32,
     ) -> Result<(u32, u32), FsError> {
-        let (start_cluster, _) = decode_inode(inode);
+        let (start_cluster, contiguous) = decode_inode(inode);
         if data.is_empty() {
             return Ok((start_cluster, old_size));
         }
+        let end = offset.checked_add(data.len() as u32).ok_or(FsError::NoSpace)?;
 
-        let cs = self.cluster_size();
         let first = if start_cluster < 2 {
-            self.alloc_cluster()?
+            let c = self.alloc_cluster()?;
+            self.write_cluster(c, &[])?;
+            c
         } else {
+            if contiguous {
+                // The directory entry loses its NoFatChain flag on the next
+                // update_entry, so give the clusters a real chain now.
+                self.link_contiguous(start_cluster, old_size)?;
+            }
             start_cluster
         };
 
-        let mut cluster = first;
-        let mut cluster_offset = 0u32;
+        let (base, last) = match self.pending.iter().find(|t| t.first == first) {
+            Some(t) => (t.base, t.last),
+            None => {
+                let mut last = first;
+                let mut n = 1u32;
+                while let Some(next) = self.next_cluster(last) {
+                    last = next;
+                    n += 1;
+                }
+                (n * self.cluster_size(), last)
+            }
+        };
 
-        // Skip to the cluster containing `offset`
-        while cluster_offset + cs <= offset {
-            cluster_offset += cs;
-            match self.next_cluster(cluster) {
-                Some(next) => cluster = next,
+        if offset < base {
+            let n = (end.min(base) - offset) as usize;
+            self.write_chain(first, offset, &data[..n])?;
+        }
+
+        if end > base {
+            let from = offset.max(base);
+            let src = &data[(from - offset) as usize..];
+            let idx = match self.pending.iter().position(|t| t.first == first) {
+                Some(i) => i,
                 None => {
-                    let new = self.alloc_cluster()?;
-                    self.write_fat_entry(cluster, new)?;
-                    let zeros = vec![0u8; cs as usize];
-                    self.write_cluster(new, &zeros)?;
-                    cluster = new;
+                    self.pending.push(PendingTail { first, last, base, data: Vec::new() });
+                    self.pending.len() - 1
                 }
+            };
+            let old_len = self.pending[idx].data.len();
+            let new_len = ((end - base) as usize).max(old_len);
+            let need = self.clusters_for(new_len) - self.clusters_for(old_len);
+            if need > self.free_clusters.saturating_sub(self.reserved) {
+                if old_len == 0 {
+                    self.pending.swap_remove(idx);
+                }
+                return Err(FsError::NoSpace);
+            }
+            self.reserved += need;
+            let tail = &mut self.pending[idx];
+            tail.data.resize(new_len, 0);
+            let at = (from - base) as usize;
+            tail.data[at..at + src.len()].copy_from_slice(src);
+            let full = tail.data.len() >= TAIL_LIMIT;
+            self.touch();
+            if full {
+                self.place_tail(idx)?;
             }
         }
 
-        let mut written = 0usize;
-        let mut cur = cluster;
+        let new_size = end.max(old_size);
+        Ok((first, new_size))
+    }
 
-        loop {
-            let start_in = if cluster_offset < offset {
-                (offset - cluster_offset) as usize
-            } else {
-                0
-            };
-            let space = cs as usize - start_in;
-            let to_write = space.min(data.len() - written);
+    /// Overwrite bytes of the allocated chain starting at `first`.
+    fn write_chain(&mut self, first: u32, offset: u32, data: &[u8]) -> Result<(), FsError> {
+        let cs = self.cluster_size();
+        let mut cur = first;
+        let mut cluster_offset = 0u32;
+        while cluster_offset + cs <= offset {
+            cluster_offset += cs;
+            cur = self.next_cluster(cur).ok_or(FsError::IoError)?;
+        }
 
-            let mut cbuf = vec![0u8; cs as usize];
-            self.read_cluster(cur, &mut cbuf)?;
+        let mut written = 0usize;
+        let mut cbuf = vec![0u8; cs as usize];
+        loop {
+            let start_in = offset.saturating_sub(cluster_offset) as usize;
+            let to_write = (cs as usize - start_in).min(data.len() - written);
+            if start_in != 0 || to_write != cs as usize {
+                self.read_cluster(cur, &mut cbuf)?;
+            }
             cbuf[start_in..start_in + to_write]
                 .copy_from_slice(&data[written..written + to_write]);
             self.write_cluster(cur, &cbuf)?;
 
             written += to_write;
             cluster_offset += cs;
-
             if written >= data.len() {
-                break;
-            }
-
-            match self.next_cluster(cur) {
-                Some(next) => cur = next,
-                None => {
-                    let new = self.alloc_cluster()?;
-                    self.write_fat_entry(cur, new)?;
-                    let zeros = vec![0u8; cs as usize];
-                    self.write_cluster(new, &zeros)?;
-                    cur = new;
-                }
+                return Ok(());
             }
+            cur = self.next_cluster(cur).ok_or(FsError::IoError)?;
         }
+    }
 
-        let new_size = (offset + data.len() as u32).max(old_size);
-        Ok((first, new_size))
+    /// Write FAT links for a NoFatChain file of `size` bytes at `start`.
+    fn link_contiguous(&mut self, start: u32, size: u32) -> Result<(), FsError> {
+        let n = self.clusters_for(size as usize).max(1);
+        for j in 0..n - 1 {
+            self.write_fat_entry(start + j, start + j + 1)?;
+        }
+        self.write_fat_entry(start + n - 1, EXFAT_EOC)
     }
 
     // =================================================================
@@ -1469,6 +1792,7 @@ impl ExFatFs {
         let num = entry_set.len() / 32;
         let cs = self.cluster_size() as usize;
         let mut cur = parent_cluster;
+        self.forget_entry(parent_cluster, name);
 
         loop {
             let mut cbuf = vec![0u8; cs];
@@ -1496,8 +1820,7 @@ impl ExFatFs {
 
     /// Create a new empty file.
     pub fn create_file(&mut self, parent_cluster: u32, name: &str) -> Result<(), FsError> {
-        let raw = self.read_dir_raw(parent_cluster)?;
-        if self.find_entry_in_buf(&raw, name).is_some() {
+        if self.find_entry(parent_cluster, name)?.is_some() {
             return Err(FsError::AlreadyExists);
         }
         self.create_entry(parent_cluster, name, false, 0, 0)
@@ -1505,8 +1828,7 @@ impl ExFatFs {
 
     /// Create a new subdirectory. Returns the new cluster.
     pub fn create_dir(&mut self, parent_cluster: u32, name: &str) -> Result<u32, FsError> {
-        let raw = self.read_dir_raw(parent_cluster)?;
-        if self.find_entry_in_buf(&raw, name).is_some() {
+        if self.find_entry(parent_cluster, name)?.is_some() {
             return Err(FsError::AlreadyExists);
         }
         let cluster = self.alloc_cluster()?;
@@ -1520,12 +1842,12 @@ impl ExFatFs {
     /// Rename (move) a file: remove old entry (keeping clusters), create new entry.
     pub fn rename_entry(&mut self, old_parent: u32, old_name: &str, new_parent: u32, new_name: &str) -> Result<(), FsError> {
         // Find old entry to get metadata
-        let raw = self.read_dir_raw(old_parent)?;
-        let found = self.find_entry_in_buf(&raw, old_name)
+        let found = self.find_entry(old_parent, old_name)?
             .ok_or(FsError::NotFound)?;
         let cluster = found.first_cluster;
         let size = found.data_length;
         let is_dir = (found.attributes & 0x10) != 0;
+        self.forget_entry(old_parent, old_name);
         // Delete old directory entries WITHOUT freeing cluster chain
         let cs = self.cluster_size() as usize;
         let mut cur = old_parent;
@@ -1558,6 +1880,7 @@ impl ExFatFs {
     pub fn delete_file(&mut self, parent_cluster: u32, name: &str) -> Result<(), FsError> {
         let cs = self.cluster_size() as usize;
         let mut cur = parent_cluster;
+        self.forget_entry(parent_cluster, name);
 
         loop {
             let mut cbuf = vec![0u8; cs];
@@ -1597,6 +1920,7 @@ impl ExFatFs {
     ) -> Result<(), FsError> {
         let cs = self.cluster_size() as usize;
         let mut cur = parent_cluster;
+        self.forget_entry(parent_cluster, name);
 
         loop {
             let mut cbuf = vec![0u8; cs];
@@ -1636,8 +1960,7 @@ impl ExFatFs {
 
     /// Truncate a file to zero length.
     pub fn truncate_file(&mut self, parent_cluster: u32, name: &str) -> Result<(), FsError> {
-        let raw = self.read_dir_raw(parent_cluster)?;
-        let found = self.find_entry_in_buf(&raw, name).ok_or(FsError::NotFound)?;
+        let found = self.find_entry(parent_cluster, name)?.ok_or(FsError::NotFound)?;
         if found.first_cluster >= 2 {
             self.free_chain(found.first_cluster, found.contiguous, found.data_length)?;
         }
@@ -1655,8 +1978,7 @@ impl ExFatFs {
         name: &str,
         target: &str,
     ) -> Result<(), FsError> {
-        let raw = self.read_dir_raw(parent_cluster)?;
-        if self.find_entry_in_buf(&raw, name).is_some() {
+        if self.find_entry(parent_cluster, name)?.is_some() {
             return Err(FsError::AlreadyExists);
         }
 
@@ -1683,21 +2005,26 @@ impl ExFatFs {
     }
 
     /// Read the target of a symbolic link. `inode` is the encoded inode of the link.
+    /// Link targets fit in one cluster (see `create_symlink`), so this goes
+    /// through the cluster cache.
     pub fn readlink(&self, inode: u32, size: u32) -> Result<String, FsError> {
-        let mut buf = vec![0u8; size as usize];
-        let n = self.read_file(inode, 0, &mut buf)?;
-        let s = core::str::from_utf8(&buf[..n]).map_err(|_| FsError::IoError)?;
+        let (cluster, _) = decode_inode(inode);
+        let cs = self.cluster_size() as usize;
+        if cluster < 2 || size as usize > cs {
+            return Err(FsError::IoError);
+        }
+        let mut buf = vec![0u8; cs];
+        self.read_cluster(cluster, &mut buf)?;
+        let s = core::str::from_utf8(&buf[..size as usize]).map_err(|_| FsError::IoError)?;
         Ok(String::from(s))
     }
 
     /// Check if a given entry is a symlink by looking up its attributes.
     pub fn is_symlink(&self, parent_cluster: u32, name: &str) -> bool {
-        if let Ok(raw) = self.read_dir_raw(parent_cluster) {
-            if let Some(found) = self.find_entry_in_buf(&raw, name) {
-                return found.attributes & ATTR_SYMLINK != 0;
-            }
+        match self.find_entry(parent_cluster, name) {
+            Ok(Some(found)) => found.attributes & ATTR_SYMLINK != 0,
+            _ => false,
         }
-        false
     }
 
     /// Create a directory entry with explicit attributes.
@@ -1715,6 +2042,7 @@ impl ExFatFs {
         let num = entry_set.len() / 32;
         let cs = self.cluster_size() as usize;
         let mut cur = parent_cluster;
+        self.forget_entry(parent_cluster, name);
 
         loop {
             let mut cbuf = vec![0u8; cs];
@@ -12,6 +12,7 @@ use super::lfn::{lfn_checksum, lfn_extract_chars, lfn_name_matches, lfn_to_strin
                   needs_lfn, make_lfn_entries};
 
 /// Information about a found directory entry.
+#[derive(Clone)]
 pub(super) struct FoundEntry {
     /// Byte offset of the 8.3 entry in the directory data buffer.
     pub offset: usize,
@@ -60,6 +61,42 @@ impl FatFs {
         }
     }
 
+    // =================================================================
+    // Lookup cache
+    // =================================================================
+
+    /// Dentry cache key of a directory: the FAT32 root is reachable both
+    /// as cluster 0 and as `root_cluster`.
+    #[inline]
+    fn dir_key(&self, cluster: u32) -> u32 {
+        if cluster == self.root_cluster { 0 } else { cluster }
+    }
+
+    /// Find `name` in directory `dir_cluster`, consulting the dentry cache
+    /// before scanning the directory.
+    pub(super) fn find_entry(&self, dir_cluster: u32, name: &str) -> Result<Option<FoundEntry>, FsError> {
+        // SAFETY: VFS mutex held (see `dentries`).
+        let dentries = unsafe { &mut *self.dentries.get() };
+        let key = self.dir_key(dir_cluster);
+        if let Some(hit) = dentries.get(key, name) {
+            return Ok(hit);
+        }
+        let dir_data = self.read_dir_raw(dir_cluster)?;
+        let found = self.find_entry_in_buf(&dir_data, name);
+        dentries.insert(key, name, found.clone());
+        Ok(found)
+    }
+
+    /// Drop the cached lookup of `name` in `dir_cluster` before its entry changes.
+    pub(crate) fn forget_entry(&self, dir_cluster: u32, name: &str) {
+        unsafe { &mut *self.dentries.get() }.forget(self.dir_key(dir_cluster), name);
+    }
+
+    /// Drop every lookup cached under the freed directory `cluster`.
+    pub(crate) fn forget_dir(&self, cluster: u32) {
+        unsafe { &mut *self.dentries.get() }.forget_dir(self.dir_key(cluster));
+    }
+
     // =================================================================
     // 8.3 name handling
     // =================================================================
@@ -304,12 +341,16 @@ impl FatFs {
                 FileType::Regular
             };
             let file_size = u32::from_le_bytes([buf[i + 28], buf[i + 29], buf[i + 30], buf[i + 31]]);
+            let mtime = dos_datetime_to_unix(
+                u16::from_le_bytes([buf[i + 24], buf[i + 25]]),
+                u16::from_le_bytes([buf[i + 22], buf[i + 23]]),
+            );
             entries.push(DirEntry {
                 name,
                 file_type,
                 size: file_size,
                 is_symlink: false,
-                uid: 0, gid: 0, mode: 0xFFF,
+                uid: 0, gid: 0, mode: 0xFFF, mtime,
             });
 
             i += 32;
@@ -340,9 +381,7 @@ impl FatFs {
 
         for (idx, component) in components.iter().enumerate() {
             let is_last = idx == components.len() - 1;
-            let dir_data = self.read_dir_raw(current_cluster)?;
-
-            match self.find_entry_in_buf(&dir_data, component) {
+            match self.find_entry(current_cluster, component)? {
                 Some(found) => {
                     if is_last {
                         let ft = if found.is_dir { FileType::Directory } else { FileType::Regular };
@@ -370,8 +409,7 @@ impl FatFs {
         let mut current_cluster: u32 = 0;
         for (idx, component) in components.iter().enumerate() {
             let is_last = idx == components.len() - 1;
-            let dir_data = self.read_dir_raw(current_cluster)?;
-            match self.find_entry_in_buf(&dir_data, component) {
+            match self.find_entry(current_cluster, component)? {
                 Some(found) => {
                     if is_last {
                         let ft = if found.is_dir { FileType::Directory } else { FileType::Regular };
@@ -490,6 +528,7 @@ impl FatFs {
 
     /// Create a new directory entry (with LFN entries if needed).
     pub fn create_entry(&mut self, parent_cluster: u32, name: &str, attr: u8, first_cluster: u32, size: u32) -> Result<(), FsError> {
+        self.forget_entry(parent_cluster, name);
         let use_lfn = needs_lfn(name);
         let name83 = if use_lfn {
             Self::generate_short_name(name)
@@ -577,6 +616,7 @@ impl FatFs {
     /// Delete the 8.3 and any associated LFN entries for a file by name.
     /// Returns `(start_cluster, file_size)` of the deleted entry.
     pub fn delete_entry(&self, parent_cluster: u32, name: &str) -> Result<(u32, u32), FsError> {
+        self.forget_entry(parent_cluster, name);
         if parent_cluster == 0 && self.fat_type != FatType::Fat32 {
             // FAT12/16: fixed root directory area
             let root_size = (self.root_dir_sectors * 512) as usize;
@@ -649,6 +689,7 @@ impl FatFs {
 
     /// Update the size, starting cluster, and modification time of an existing directory entry.
     pub fn update_entry(&self, parent_cluster: u32, name: &str, new_size: u32, new_cluster: u32) -> Result<(), FsError> {
+        self.forget_entry(parent_cluster, name);
         let (date, time) = current_dos_datetime();
         if parent_cluster == 0 && self.fat_type != FatType::Fat32 {
             // FAT12/16: fixed root directory area
@@ -707,8 +748,7 @@ impl FatFs {
 
     /// Create a new empty file in the given parent directory.
     pub fn create_file(&mut self, parent_cluster: u32, name: &str) -> Result<(), FsError> {
-        let dir_data = self.read_dir_raw(parent_cluster)?;
-        if self.find_entry_in_buf(&dir_data, name).is_some() {
+        if self.find_entry(parent_cluster, name)?.is_some() {
             return Err(FsError::AlreadyExists);
         }
         self.create_entry(parent_cluster, name, ATTR_ARCHIVE, 0, 0)
@@ -716,8 +756,7 @@ impl FatFs {
 
     /// Create a new subdirectory with `.` and `..` entries. Returns the new cluster.
     pub fn create_dir(&mut self, parent_cluster: u32, name: &str) -> Result<u32, FsError> {
-        let dir_data = self.read_dir_raw(parent_cluster)?;
-        if self.find_entry_in_buf(&dir_data, name).is_some() {
+        if self.find_entry(parent_cluster, name)?.is_some() {
             return Err(FsError::AlreadyExists);
         }
 
@@ -747,8 +786,7 @@ impl FatFs {
     /// Rename (move) a file: remove old dir entry (keeping clusters), create new entry.
     pub fn rename_entry(&mut self, old_parent: u32, old_name: &str, new_parent: u32, new_name: &str) -> Result<(), FsError> {
         // Look up old entry to get cluster and size
-        let dir_data = self.read_dir_raw(old_parent)?;
-        let found = self.find_entry_in_buf(&dir_data, old_name)
+        let found = self.find_entry(old_parent, old_name)?
             .ok_or(FsError::NotFound)?;
         let cluster = found.cluster;
         let size = found.size;
@@ -763,8 +801,7 @@ impl FatFs {
 
     /// Truncate a file to zero length: free its cluster chain and update the directory entry.
     pub fn truncate_file(&mut self, parent_cluster: u32, name: &str) -> Result<(), FsError> {
-        let dir_data = self.read_dir_raw(parent_cluster)?;
-        let found = self.find_entry_in_buf(&dir_data, name)
+        let found = self.find_entry(parent_cluster, name)?
             .ok_or(FsError::NotFound)?;
 
         if found.cluster >= 2 {
@@ -1,5 +1,6 @@
 //! File read/write operations on FAT filesystems.
 
+use crate::fs::file::RangeReadPlan;
 use crate::fs::vfs::FsError;
 use alloc::vec;
 use alloc::vec::Vec;
@@ -56,6 +57,8 @@ impl FatFs {
         if start_cluster < 2 || buf.is_empty() {
             return Ok(0);
         }
+        // Reads below go straight to the sectors.
+        self.flush_clusters()?;
         let spc = self.sectors_per_cluster;
         let cluster_size = spc * 512;
         let mut cluster = start_cluster;
@@ -147,8 +150,10 @@ impl FatFs {
     /// Build a read plan for the given file by walking the in-memory FAT cache.
     ///
     /// This collects contiguous (absolute_lba, sector_count) runs without
-    /// touching the disk, so it is safe to call while holding the VFS spinlock.
+    /// reading the disk, so it is safe to call while holding the VFS lock.
+    /// Buffered writes are written out first so the plan sees them.
     pub fn get_file_read_plan(&self, start_cluster: u32, file_size: u32) -> FileReadPlan {
+        self.flush_before_plan();
         let spc = self.sectors_per_cluster;
         let mut runs = Vec::new();
 
@@ -184,6 +189,21 @@ impl FatFs {
         FileReadPlan { runs, file_size }
     }
 
+    /// Build a read plan for `len` bytes at `offset` (flushes buffered writes).
+    pub fn get_range_read_plan(&self, start_cluster: u32, offset: u32, len: usize) -> RangeReadPlan {
+        self.flush_before_plan();
+        RangeReadPlan::from_chain(
+            start_cluster, self.sectors_per_cluster, offset, len,
+            |c| self.partition_start_lba + self.cluster_to_lba(c), |c| self.next_cluster(c),
+        )
+    }
+
+    fn flush_before_plan(&self) {
+        if let Err(e) = self.flush_clusters() {
+            crate::serial_println!("  FAT: write-back before read failed: {:?}", e);
+        }
+    }
+
     /// Write data to a file at the given offset, allocating clusters as needed.
     /// Returns `(first_cluster, new_size)`.
     pub fn write_file(&mut self, start_cluster: u32, offset: u32, data: &[u8], old_size: u32) -> Result<(u32, u32), FsError> {
@@ -21,6 +21,8 @@ pub use datetime::{dos_datetime_to_unix, unix_to_dos_datetime};
 pub use file::FileReadPlan;
 
 use crate::fs::vfs::FsError;
+use crate::fs::dentry::DentryCache;
+use crate::fs::writeback::{self, DirtyClusters, DirtySectors};
 use alloc::vec;
 use alloc::vec::Vec;
 
@@ -46,6 +48,20 @@ pub struct FatFs {
     /// Cached FAT table in memory for fast cluster chain lookups.
     /// For FAT12/16: entire FAT. For FAT32: entire FAT (up to ~4 MB).
     pub(crate) fat_cache: Vec<u8>,
+    /// FAT sectors changed since the last sync (written to every FAT copy).
+    pub(crate) dirty_fat: DirtySectors,
+    /// Written cluster contents not yet on disk.
+    ///
+    /// `UnsafeCell` lets the `&self` directory helpers buffer writes.  Safe
+    /// because `FatFs` is only accessed while the VFS `Mutex` is held.
+    dirty: core::cell::UnsafeCell<DirtyClusters>,
+    /// `writeback::now_ms()` of the oldest unsynced change (0 = clean).
+    dirty_since: core::cell::Cell<u32>,
+    /// Next-fit allocation cursor, so growing files stay contiguous.
+    pub(crate) alloc_hint: u32,
+    /// Path component lookups, keyed by directory cluster (root = 0).
+    /// Same `UnsafeCell` rationale as `dirty`.
+    dentries: core::cell::UnsafeCell<DentryCache<dir::FoundEntry>>,
 }
 
 /// FAT variant detected from the cluster count.
@@ -169,6 +185,11 @@ impl FatFs {
             root_cluster,
             fsinfo_sector,
             fat_cache,
+            dirty_fat: DirtySectors::new(),
+            dirty: core::cell::UnsafeCell::new(DirtyClusters::new()),
+            dirty_since: core::cell::Cell::new(0),
+            alloc_hint: 2,
+            dentries: core::cell::UnsafeCell::new(DentryCache::new()),
         })
     }
 
@@ -219,21 +240,83 @@ impl FatFs {
     }
 
     pub(crate) fn read_cluster(&self, cluster: u32, buf: &mut [u8]) -> Result<usize, FsError> {
-        let lba = self.cluster_to_lba(cluster);
         let size = self.sectors_per_cluster * 512;
+        if self.dirty_clusters().get(cluster, &mut buf[..size as usize]) {
+            return Ok(size as usize);
+        }
+        let lba = self.cluster_to_lba(cluster);
         self.read_sectors(lba, self.sectors_per_cluster, &mut buf[..size as usize])?;
         Ok(size as usize)
     }
 
+    /// Buffer new contents for `cluster`; they reach the disk at the next
+    /// flush (see [`writeback`]).
     pub(crate) fn write_cluster(&self, cluster: u32, data: &[u8]) -> Result<(), FsError> {
-        let lba = self.cluster_to_lba(cluster);
         let cluster_size = (self.sectors_per_cluster * 512) as usize;
-        if data.len() >= cluster_size {
-            self.write_sectors(lba, self.sectors_per_cluster, &data[..cluster_size])
-        } else {
-            let mut buf = vec![0u8; cluster_size];
-            buf[..data.len()].copy_from_slice(data);
-            self.write_sectors(lba, self.sectors_per_cluster, &buf)
+        let mut buf = vec![0u8; cluster_size];
+        let n = data.len().min(cluster_size);
+        buf[..n].copy_from_slice(&data[..n]);
+        let dirty = self.dirty_clusters();
+        dirty.put(cluster, buf);
+        self.touch();
+        if dirty.bytes() > writeback::DIRTY_LIMIT {
+            self.flush_clusters()?;
         }
+        Ok(())
+    }
+
+    #[inline]
+    pub(crate) fn dirty_clusters(&self) -> &mut DirtyClusters {
+        // SAFETY: VFS mutex held (see `dirty`).
+        unsafe { &mut *self.dirty.get() }
+    }
+
+    /// Record that unsynced changes exist.
+    #[inline]
+    pub(crate) fn touch(&self) {
+        if self.dirty_since.get() == 0 {
+            self.dirty_since.set(writeback::now_ms().max(1));
+        }
+    }
+
+    // =================================================================
+    // Write-back
+    // =================================================================
+
+    /// Write all dirty clusters to disk in merged runs.  On failure the
+    /// unwritten clusters stay dirty.
+    pub(crate) fn flush_clusters(&self) -> Result<(), FsError> {
+        let dirty = self.dirty_clusters();
+        if dirty.is_empty() {
+            return Ok(());
+        }
+        let cluster_size = (self.sectors_per_cluster * 512) as usize;
+        let mut runs = dirty.take_runs().into_iter();
+        while let Some((cluster, data)) = runs.next() {
+            let lba = self.cluster_to_lba(cluster);
+            if self.write_sectors(lba, (data.len() / 512) as u32, &data).is_err() {
+                for (c, d) in core::iter::once((cluster, data)).chain(runs) {
+                    for (i, chunk) in d.chunks(cluster_size).enumerate() {
+                        dirty.put(c + i as u32, chunk.to_vec());
+                    }
+                }
+                return Err(FsError::IoError);
+            }
+        }
+        Ok(())
+    }
+
+    /// Write every buffered change to disk: data clusters first, then the FAT.
+    pub fn sync(&mut self) -> Result<(), FsError> {
+        self.flush_clusters()?;
+        self.flush_fat()?;
+        self.dirty_since.set(0);
+        Ok(())
+    }
+
+    /// Whether the oldest unsynced change is older than `writeback::EXPIRE_MS`.
+    pub fn writeback_due(&self, now: u32) -> bool {
+        let since = self.dirty_since.get();
+        since != 0 && now.wrapping_sub(since) >= writeback::EXPIRE_MS
     }
 }
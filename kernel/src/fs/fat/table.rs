@@ -70,18 +70,28 @@ impl FatFs {
             _ => {}
         }
 
-        // Write through to disk (both FAT copies)
-        let fat_sector_rel = fat_offset as u32 / 512;
-        let sector_start = (fat_sector_rel * 512) as usize;
-        let mut sector_buf = [0u8; 512];
-        sector_buf.copy_from_slice(&self.fat_cache[sector_start..sector_start + 512]);
-
-        let fat1_sector = self.first_fat_sector + fat_sector_rel;
-        self.write_sectors(fat1_sector, 1, &sector_buf)?;
+        // Written back (to both FAT copies) by flush_fat
+        self.dirty_fat.mark(fat_offset as u32 / 512);
+        self.touch();
+        Ok(())
+    }
 
-        if self.num_fats > 1 {
-            let fat2_sector = self.first_fat_sector + self.fat_size + fat_sector_rel;
-            self.write_sectors(fat2_sector, 1, &sector_buf)?;
+    /// Write the dirty FAT sectors to every FAT copy.
+    pub(crate) fn flush_fat(&mut self) -> Result<(), FsError> {
+        for (first, count) in self.dirty_fat.take_runs() {
+            let from = first as usize * 512;
+            let to = from + count as usize * 512;
+            let mut result = Ok(());
+            for copy in 0..self.num_fats.max(1) {
+                let lba = self.first_fat_sector + copy * self.fat_size + first;
+                result = result.and(self.write_sectors(lba, count, &self.fat_cache[from..to]));
+            }
+            if let Err(e) = result {
+                for s in first..first + count {
+                    self.dirty_fat.mark(s);
+                }
+                return Err(e);
+            }
         }
         Ok(())
     }
@@ -129,11 +139,18 @@ impl FatFs {
     }
 
     /// Allocate a free cluster, mark it as end-of-chain.
+    ///
+    /// Next-fit: the search starts after the previous allocation and wraps,
+    /// so consecutive allocations of a growing file are usually adjacent.
     pub(crate) fn alloc_cluster(&mut self) -> Result<u32, FsError> {
-        for cluster in 2..self.total_clusters + 2 {
+        let n = self.total_clusters;
+        let start = self.alloc_hint.saturating_sub(2) % n.max(1);
+        for k in 0..n {
+            let cluster = 2 + (start + k) % n;
             let entry = self.read_fat_entry(cluster)?;
             if entry == 0 {
                 self.write_fat_entry(cluster, self.eoc_mark())?;
+                self.alloc_hint = cluster + 1;
                 return Ok(cluster);
             }
         }
@@ -145,10 +162,13 @@ impl FatFs {
         if start_cluster < 2 {
             return Ok(());
         }
+        // A freed directory's lookups must not outlive its clusters.
+        self.forget_dir(start_cluster);
         let mut cluster = start_cluster;
         loop {
             let next = self.read_fat_entry(cluster)?;
             self.write_fat_entry(cluster, 0)?;
+            self.dirty_clusters().remove(cluster);
             if self.is_eoc(next) || next == 0 {
                 break;
             }
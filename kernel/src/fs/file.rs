@@ -1,4 +1,8 @@
+use crate::fs::page_cache::Readahead;
+use crate::fs::vfs::FsError;
 use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
 
 pub type FileDescriptor = u32;
 
@@ -66,6 +70,8 @@ pub struct OpenFile {
     /// Reference count: how many per-process FD table entries point to this slot.
     /// Slot is freed when refcount drops to 0.
     pub refcount: u32,
+    /// Sequential-read detection and readahead window (page cache).
+    pub readahead: Readahead,
 }
 
 #[derive(Debug, Clone)]
@@ -81,4 +87,120 @@ pub struct DirEntry {
     pub gid: u16,
     /// Permission mode (12-bit: owner[8-11] | group[4-7] | others[0-3]).
     pub mode: u16,
+    /// Modification time as Unix timestamp (0 if the filesystem has none).
+    pub mtime: u32,
+}
+
+/// Sector runs covering a byte range of a cluster-chained file.
+///
+/// Like the whole-file read plans of the FAT and exFAT drivers, it is built
+/// from the in-memory FAT while the VFS lock is held and executed after the
+/// lock is dropped, so concurrent readers overlap their disk I/O.
+pub struct RangeReadPlan {
+    /// Contiguous (absolute_lba, sector_count) runs.
+    pub runs: Vec<(u32, u32)>,
+    /// Bytes to skip at the start of the first run.
+    pub skip: usize,
+    /// Bytes of file data the plan delivers.
+    pub len: usize,
+}
+
+impl RangeReadPlan {
+    /// Plan `len` bytes at `offset` of the chain starting at `start_cluster`.
+    ///
+    /// `lba_of` maps a cluster to its absolute LBA and `next` follows the
+    /// chain.  The plan is cut short if the chain ends first.
+    pub fn from_chain(
+        start_cluster: u32,
+        sectors_per_cluster: u32,
+        offset: u32,
+        len: usize,
+        lba_of: impl Fn(u32) -> u32,
+        next: impl Fn(u32) -> Option<u32>,
+    ) -> Self {
+        let mut plan = RangeReadPlan { runs: Vec::new(), skip: 0, len: 0 };
+        let cluster_bytes = sectors_per_cluster as u64 * 512;
+        if start_cluster < 2 || len == 0 || cluster_bytes == 0 {
+            return plan;
+        }
+
+        let mut cluster = start_cluster;
+        let mut skipped = 0u64;
+        while skipped + cluster_bytes <= offset as u64 {
+            skipped += cluster_bytes;
+            match next(cluster) {
+                Some(n) => cluster = n,
+                None => return plan,
+            }
+        }
+        plan.skip = (offset as u64 - skipped) as usize;
+        let want = (plan.skip as u64 + len as u64 + cluster_bytes - 1) / cluster_bytes;
+
+        let mut have = 0u64;
+        loop {
+            let lba = lba_of(cluster);
+            let mut run = 1u32;
+            let mut last = cluster;
+            while have + (run as u64) < want {
+                match next(last) {
+                    Some(n) if n == last + 1 => {
+                        run += 1;
+                        last = n;
+                    }
+                    _ => break,
+                }
+            }
+            plan.runs.push((lba, run * sectors_per_cluster));
+            have += run as u64;
+            if have >= want {
+                break;
+            }
+            match next(last) {
+                Some(n) => cluster = n,
+                None => break,
+            }
+        }
+
+        plan.len = len.min((have * cluster_bytes) as usize - plan.skip);
+        plan
+    }
+
+    /// Read the planned range into `buf[..self.len]`; returns `self.len`.
+    ///
+    /// **Must be called WITHOUT the VFS lock held.**
+    pub fn execute_into(&self, buf: &mut [u8]) -> Result<usize, FsError> {
+        let total: usize = self.runs.iter().map(|(_, sc)| *sc as usize * 512).sum();
+        if self.skip == 0 && total == self.len && buf.len() >= total {
+            // Cluster-aligned range: read straight into the caller's buffer
+            read_runs(&self.runs, &mut buf[..total])?;
+        } else {
+            let mut tmp = vec![0u8; total];
+            read_runs(&self.runs, &mut tmp)?;
+            buf[..self.len].copy_from_slice(&tmp[self.skip..self.skip + self.len]);
+        }
+        Ok(self.len)
+    }
+}
+
+fn read_runs(runs: &[(u32, u32)], buf: &mut [u8]) -> Result<(), FsError> {
+    let mut offset = 0usize;
+    for &(abs_lba, sector_count) in runs {
+        let bytes = sector_count as usize * 512;
+        if !storage_read_sectors(abs_lba, sector_count, &mut buf[offset..offset + bytes]) {
+            return Err(FsError::IoError);
+        }
+        offset += bytes;
+    }
+    Ok(())
+}
+
+/// Arch-abstracted storage read.
+#[cfg(target_arch = "x86_64")]
+fn storage_read_sectors(abs_lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    crate::drivers::storage::read_sectors(abs_lba, count, buf)
+}
+
+#[cfg(target_arch = "aarch64")]
+fn storage_read_sectors(abs_lba: u32, count: u32, buf: &mut [u8]) -> bool {
+    crate::drivers::arm::storage::read_sectors(abs_lba, count, buf)
 }
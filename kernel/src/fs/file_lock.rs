@@ -0,0 +1,115 @@
+//! Advisory whole-file locks (`flock`).
+//!
+//! A lock is held by an open file slot (shared by descriptors duplicated
+//! with `dup` or inherited across `fork`) and covers the file itself,
+//! identified by its page-cache identity `(mount, inode)` or, on uncached
+//! backends, by its path — so two processes that open the same file
+//! contend.  Any number of slots may hold a shared lock on a file, or one
+//! slot an exclusive lock.  Freeing a slot (its last descriptor closed, or
+//! its process exited) releases its lock.
+//!
+//! Blocked lockers queue on the table under its spinlock; every release
+//! wakes them all to retry.  Lock tables are small and waits rare, so the
+//! thundering herd is cheaper than per-file queues.
+//!
+//! Lock order: VFS → file lock table → SCHEDULER.
+
+use crate::sync::spinlock::Spinlock;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+/// Take a shared lock.
+pub const LOCK_SH: u32 = 1;
+/// Take an exclusive lock.
+pub const LOCK_EX: u32 = 2;
+/// With `LOCK_SH`/`LOCK_EX`: fail instead of waiting.
+pub const LOCK_NB: u32 = 4;
+/// Release the lock.
+pub const LOCK_UN: u32 = 8;
+
+/// Identity of a locked file.
+#[derive(Clone, PartialEq, Eq)]
+pub enum FileKey {
+    /// Page-cache identity `(mount, inode)`.
+    Cached(u32, u32),
+    /// Path of a file on an uncached backend.
+    Path(String),
+}
+
+/// Why [`lock`] did not take the lock.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum LockError {
+    /// `LOCK_NB` was given and another slot holds a conflicting lock.
+    WouldBlock,
+}
+
+struct Holder {
+    slot: u32,
+    key: FileKey,
+    exclusive: bool,
+}
+
+struct LockTable {
+    holders: Vec<Holder>,
+    /// TIDs blocked in [`lock`].
+    waiters: Vec<u32>,
+}
+
+static LOCKS: Spinlock<LockTable> = Spinlock::new(LockTable {
+    holders: Vec::new(),
+    waiters: Vec::new(),
+});
+
+/// Lock the file `key` for `slot`, shared or exclusive.  A lock the slot
+/// already holds is converted (released first, as with BSD `flock`).  With
+/// `wait`, blocks until no other slot holds a conflicting lock.
+///
+/// **Must be called from a syscall context** when `wait` is set.
+pub fn lock(slot: u32, key: FileKey, exclusive: bool, wait: bool) -> Result<(), LockError> {
+    let tid = crate::task::scheduler::current_tid();
+    loop {
+        {
+            let mut table = LOCKS.lock();
+            table.waiters.retain(|&t| t != tid);
+            let released = match table.holders.iter().position(|h| h.slot == slot) {
+                Some(pos) => {
+                    table.holders.swap_remove(pos);
+                    true
+                }
+                None => false,
+            };
+            let conflict = table.holders.iter()
+                .any(|h| h.key == key && (exclusive || h.exclusive));
+            if !conflict {
+                table.holders.push(Holder { slot, key, exclusive });
+                return Ok(());
+            }
+            if released {
+                // Giving up the old lock may unblock others
+                wake_all(&mut table);
+            }
+            if !wait {
+                return Err(LockError::WouldBlock);
+            }
+            table.waiters.push(tid);
+            crate::task::scheduler::prepare_block_current(None);
+        }
+        crate::task::scheduler::schedule();
+    }
+}
+
+/// Release the lock held by `slot`, if any.
+pub fn unlock(slot: u32) {
+    let mut table = LOCKS.lock();
+    let before = table.holders.len();
+    table.holders.retain(|h| h.slot != slot);
+    if table.holders.len() != before {
+        wake_all(&mut table);
+    }
+}
+
+fn wake_all(table: &mut LockTable) {
+    for tid in table.waiters.drain(..) {
+        crate::task::scheduler::wake_thread(tid);
+    }
+}
@@ -1,14 +1,18 @@
 //! Filesystem subsystem -- FAT, exFAT, NTFS, device filesystem, VFS layer, and path utilities.
 
+pub mod dentry;
 pub mod devfs;
 pub mod exfat;
 pub mod fat;
 pub mod fd_table;
 pub mod file;
+pub mod file_lock;
 pub mod iso9660;
 pub mod ntfs;
+pub mod page_cache;
 pub mod partition;
 pub mod path;
 pub mod permissions;
 pub mod smbfs;
 pub mod vfs;
+pub mod writeback;
@@ -170,6 +170,8 @@ pub(super) struct FileName {
     pub namespace: u8,
     pub flags: u32,
     pub real_size: u64,
+    /// File modification time (NTFS FILETIME) as of the last name update.
+    pub modified: u64,
 }
 
 impl FileName {
@@ -192,6 +194,11 @@ impl FileName {
             data[0x38], data[0x39], data[0x3A], data[0x3B],
         ]);
 
+        let modified = u64::from_le_bytes([
+            data[0x10], data[0x11], data[0x12], data[0x13],
+            data[0x14], data[0x15], data[0x16], data[0x17],
+        ]);
+
         let name_length = data[0x40] as usize;
         let namespace = data[0x41];
 
@@ -218,6 +225,7 @@ impl FileName {
             namespace,
             flags,
             real_size,
+            modified,
         })
     }
 
@@ -248,6 +248,7 @@ impl NtfsFs {
             uid: 0,
             gid: 0,
             mode: if is_dir { 0o755 } else { 0o644 },
+            mtime: filetime_to_unix(ie.file_name.modified),
         }
     }
 
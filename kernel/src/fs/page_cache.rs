@@ -0,0 +1,663 @@
+//! Unified page cache for file data, shared by all disk-backed filesystems.
+//!
+//! Pages are 4 KiB of file content keyed by `(mount, inode, page index)`,
+//! where `mount` is the VFS `fs_id` of the backend (FAT, ISO 9660, exFAT,
+//! NTFS) and `inode` the backend's stable file identifier (first cluster,
+//! extent LBA or MFT record).  [`read`] serves hits from the cache and fills
+//! runs of missing pages with one backend read; the VFS invalidates an
+//! inode on every write, truncate or delete that touches it.
+//!
+//! Each cached page is a physical frame of its own.  On x86_64 it is mapped
+//! into a dedicated kernel window ([`WINDOW_BASE`], one fixed slot per
+//! page); on ARM64 it is reached through the linear RAM mapping.  The cache
+//! grows up to [`budget`] pages while free frames stay above a low
+//! watermark; below it, new pages recycle the oldest inactive page and a
+//! batch of inactive pages is unmapped and returned to the frame allocator.
+//! The reclaim thread ([`shrink`]) trims the cache the same way.
+//!
+//! Pages sit on one of two LRU lists.  New pages enter the inactive list;
+//! a hit marks an inactive page referenced, and a second hit promotes it to
+//! the active list.  Whenever the active list outgrows the inactive one,
+//! its oldest pages are demoted again.  Eviction takes the inactive tail,
+//! so a large file streamed once cannot push out pages that are read over
+//! and over.
+//!
+//! Sequential readers get readahead: each open file carries a [`Readahead`]
+//! state, and a read that continues where the previous one ended extends
+//! its backend fill past the request by a window that doubles (from
+//! [`RA_MIN_PAGES`] up to [`RA_MAX_PAGES`]) as the stream goes on.  Pages
+//! brought in ahead are flagged until first read; one evicted unread counts
+//! as wasted, and a stream that sees new waste shrinks its window instead.
+//!
+//! Lock order: VFS → PAGE_CACHE → physical allocator.  The cache lock is a
+//! yielding [`Mutex`] (never taken from IRQ context), so the TLB shootdown
+//! on unmap runs with interrupts enabled.
+
+use crate::fs::vfs::FsError;
+use crate::memory::address::PhysAddr;
+#[cfg(target_arch = "x86_64")]
+use crate::memory::address::VirtAddr;
+use crate::memory::physical;
+use crate::sync::mutex::Mutex;
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+/// Bytes per cached page.
+pub const PAGE_SIZE: usize = 4096;
+
+/// Kernel VA window holding the cached pages (between the heap and the
+/// external-driver range).
+#[cfg(target_arch = "x86_64")]
+const WINDOW_BASE: u64 = 0xFFFF_FFFF_A200_0000;
+/// Slots in the window (224 MiB).
+#[cfg(target_arch = "x86_64")]
+const WINDOW_SLOTS: usize = (0xFFFF_FFFF_B000_0000 - WINDOW_BASE) as usize / PAGE_SIZE;
+#[cfg(target_arch = "aarch64")]
+const WINDOW_SLOTS: usize = 1 << 16;
+
+/// Longest run of missing pages filled by a single backend read.
+const MAX_FILL_PAGES: u32 = 64;
+/// First readahead window of a sequential stream (16 KiB).
+pub const RA_MIN_PAGES: u32 = 4;
+/// Largest readahead window (1 MiB).
+pub const RA_MAX_PAGES: u32 = 256;
+/// Pages handed back to the frame allocator when memory runs low.
+const RECLAIM_BATCH: usize = 32;
+
+/// `(mount, inode, page index)`.
+type Key = (u32, u32, u32);
+
+/// Slot index meaning "none" in the LRU links.
+const NIL: u32 = u32::MAX;
+
+struct Slot {
+    key: Key,
+    /// Valid bytes (a file's last page is short).
+    len: u16,
+    /// Brought in by readahead and not read yet.
+    ahead: bool,
+    /// On the active list (else the inactive one).
+    active: bool,
+    /// Hit once while inactive; the next hit promotes it.
+    referenced: bool,
+    /// Neighbours towards the MRU (`prev`) and LRU (`next`) end.
+    prev: u32,
+    next: u32,
+    /// Backing frame (0 = none).
+    frame: u64,
+}
+
+/// Links of one LRU list.
+struct List {
+    /// Most / least recently used slot.
+    head: u32,
+    tail: u32,
+    len: usize,
+}
+
+impl List {
+    const fn new() -> Self {
+        List { head: NIL, tail: NIL, len: 0 }
+    }
+}
+
+struct PageCache {
+    map: BTreeMap<Key, u32>,
+    slots: Vec<Slot>,
+    /// Pages hit at least twice since they last left the active list.
+    active: List,
+    /// New, readahead and demoted pages; evicted from the tail.
+    inactive: List,
+    /// Slots with a frame but no key (left by invalidation).
+    idle: Vec<u32>,
+    /// Slots without a frame (left by reclaim).
+    empty: Vec<u32>,
+    /// Slots currently owning a frame.
+    resident: usize,
+}
+
+static PAGE_CACHE: Mutex<PageCache> = Mutex::new(PageCache {
+    map: BTreeMap::new(),
+    slots: Vec::new(),
+    active: List::new(),
+    inactive: List::new(),
+    idle: Vec::new(),
+    empty: Vec::new(),
+    resident: 0,
+});
+
+static HITS: AtomicU64 = AtomicU64::new(0);
+static MISSES: AtomicU64 = AtomicU64::new(0);
+static EVICTIONS: AtomicU64 = AtomicU64::new(0);
+static RA_PAGES: AtomicU64 = AtomicU64::new(0);
+static RA_WASTED: AtomicU64 = AtomicU64::new(0);
+/// Bumped by every invalidation (see [`insert_file`]).
+static GENERATION: AtomicU64 = AtomicU64::new(0);
+
+/// Counters reported by `sysinfo` (cmd 6).
+pub struct PageCacheStats {
+    /// Pages currently holding a frame.
+    pub pages: u32,
+    /// Cached pages on the active / inactive list.
+    pub active: u32,
+    pub inactive: u32,
+    /// Current size limit in pages.
+    pub budget: u32,
+    pub hits: u64,
+    pub misses: u64,
+    /// Pages dropped to make room or under memory pressure.
+    pub evictions: u64,
+    /// Pages read ahead of sequential readers.
+    pub readahead: u64,
+    /// Readahead pages evicted before anyone read them.
+    pub readahead_wasted: u64,
+}
+
+/// Per-open-file readahead state (copied out under the VFS lock for a
+/// read and written back after it).
+#[derive(Clone, Copy)]
+pub struct Readahead {
+    /// Page holding the byte after the previous read.
+    next: u32,
+    /// Current window in pages (0 = no sequential stream).
+    window: u32,
+    /// First page not covered by readahead yet.
+    ahead_end: u32,
+    /// `RA_WASTED` when the window was last resized.
+    wasted_seen: u64,
+}
+
+impl Readahead {
+    pub const fn new() -> Self {
+        Readahead { next: 0, window: 0, ahead_end: 0, wasted_seen: 0 }
+    }
+
+    /// Account a read of pages `first..=last` (file of `pages` pages) and
+    /// return the page the backend fill may extend to (exclusive): the end
+    /// of a newly opened window, else just past the request.
+    fn advance(&mut self, first: u32, last: u32, pages: u32) -> u32 {
+        if first != self.next {
+            // Not where the last read stopped: no readahead until the new
+            // position proves sequential.
+            self.window = 0;
+            self.ahead_end = 0;
+            return last + 1;
+        }
+        if self.window == 0 {
+            self.window = RA_MIN_PAGES;
+            self.ahead_end = last + 1;
+            self.wasted_seen = RA_WASTED.load(Ordering::Relaxed);
+        }
+        // Open the next window once the reader is halfway into this one.
+        if last + 1 + self.window / 2 >= self.ahead_end {
+            let wasted = RA_WASTED.load(Ordering::Relaxed);
+            if wasted != self.wasted_seen {
+                // Readahead pages are being evicted unread: back off.
+                self.window = (self.window / 2).max(RA_MIN_PAGES);
+                self.wasted_seen = wasted;
+            } else if self.ahead_end > last + 1 {
+                self.window = (self.window * 2).min(RA_MAX_PAGES);
+            }
+            self.ahead_end = (last + 1 + self.window).min(pages);
+            return self.ahead_end.max(last + 1);
+        }
+        last + 1
+    }
+}
+
+/// Maximum number of cached pages: 1/8 of RAM, bounded by the window.
+pub fn budget() -> usize {
+    (physical::total_frames() / 8).min(WINDOW_SLOTS)
+}
+
+/// True when free frames are below the low watermark (1/32 of RAM, at
+/// least 512 frames).
+fn under_pressure() -> bool {
+    physical::free_frames() < (physical::total_frames() / 32).max(512)
+}
+
+/// Kernel pointer to the data of slot `idx` backed by `frame`.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+fn slot_ptr(idx: u32, _frame: u64) -> *mut u8 {
+    (WINDOW_BASE + idx as u64 * PAGE_SIZE as u64) as *mut u8
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline]
+fn slot_ptr(_idx: u32, frame: u64) -> *mut u8 {
+    (frame + crate::memory::virtual_mem::PHYS_TO_VIRT_OFFSET) as *mut u8
+}
+
+#[cfg(target_arch = "x86_64")]
+fn map_slot(idx: u32, frame: u64) {
+    // Present | Writable, not executable.
+    let flags = 0x03 | crate::memory::virtual_mem::page_nx_flag();
+    crate::memory::virtual_mem::map_page(
+        VirtAddr::new(slot_ptr(idx, frame) as u64), PhysAddr::new(frame), flags,
+    );
+}
+
+#[cfg(target_arch = "aarch64")]
+fn map_slot(_idx: u32, _frame: u64) {}
+
+#[cfg(target_arch = "x86_64")]
+fn unmap_slot(idx: u32, frame: u64) {
+    crate::memory::virtual_mem::unmap_range(VirtAddr::new(slot_ptr(idx, frame) as u64), 1);
+}
+
+#[cfg(target_arch = "aarch64")]
+fn unmap_slot(_idx: u32, _frame: u64) {}
+
+impl PageCache {
+    fn list(&mut self, active: bool) -> &mut List {
+        if active { &mut self.active } else { &mut self.inactive }
+    }
+
+    fn unlink(&mut self, idx: u32) {
+        let (prev, next, active) = {
+            let s = &self.slots[idx as usize];
+            (s.prev, s.next, s.active)
+        };
+        if prev != NIL { self.slots[prev as usize].next = next; } else { self.list(active).head = next; }
+        if next != NIL { self.slots[next as usize].prev = prev; } else { self.list(active).tail = prev; }
+        self.list(active).len -= 1;
+        let s = &mut self.slots[idx as usize];
+        s.prev = NIL;
+        s.next = NIL;
+    }
+
+    fn push_front(&mut self, idx: u32, active: bool) {
+        let old = self.list(active).head;
+        {
+            let s = &mut self.slots[idx as usize];
+            s.prev = NIL;
+            s.next = old;
+            s.active = active;
+            s.referenced = false;
+        }
+        if old != NIL { self.slots[old as usize].prev = idx; } else { self.list(active).tail = idx; }
+        let list = self.list(active);
+        list.head = idx;
+        list.len += 1;
+    }
+
+    /// Account a hit: active pages move to the front, an inactive page is
+    /// marked referenced on its first hit and promoted on the second.
+    fn touch(&mut self, idx: u32) {
+        let s = &mut self.slots[idx as usize];
+        if !s.active && !s.referenced {
+            s.referenced = true;
+            return;
+        }
+        if !(s.active && self.active.head == idx) {
+            self.unlink(idx);
+            self.push_front(idx, true);
+            self.balance();
+        }
+    }
+
+    /// Demote the oldest active pages while the active list is the longer.
+    fn balance(&mut self) {
+        while self.active.len > self.inactive.len {
+            let idx = self.active.tail;
+            self.unlink(idx);
+            self.push_front(idx, false);
+        }
+    }
+
+    /// Drop the mapping of `key` but keep its frame for reuse.
+    fn forget(&mut self, key: &Key) {
+        if let Some(idx) = self.map.remove(key) {
+            self.unlink(idx);
+            self.slots[idx as usize].ahead = false;
+            self.idle.push(idx);
+        }
+    }
+
+    /// Detach the oldest inactive page (the oldest active one if the
+    /// inactive list is empty) from its key.
+    fn evict_lru(&mut self) -> Option<u32> {
+        let idx = if self.inactive.tail != NIL { self.inactive.tail } else { self.active.tail };
+        if idx == NIL {
+            return None;
+        }
+        let key = self.slots[idx as usize].key;
+        self.map.remove(&key);
+        self.unlink(idx);
+        EVICTIONS.fetch_add(1, Ordering::Relaxed);
+        if core::mem::replace(&mut self.slots[idx as usize].ahead, false) {
+            RA_WASTED.fetch_add(1, Ordering::Relaxed);
+        }
+        Some(idx)
+    }
+
+    /// A slot with a frame to hold a new page, growing the cache only while
+    /// under budget and not short of memory.
+    fn take_slot(&mut self, pressure: bool) -> Option<u32> {
+        if let Some(idx) = self.idle.pop() {
+            return Some(idx);
+        }
+        if !pressure && self.resident < budget() {
+            let idx = match self.empty.pop() {
+                Some(idx) => idx,
+                None if self.slots.len() < WINDOW_SLOTS => {
+                    self.slots.push(Slot {
+                        key: (0, 0, 0), len: 0, ahead: false, active: false, referenced: false,
+                        prev: NIL, next: NIL, frame: 0,
+                    });
+                    (self.slots.len() - 1) as u32
+                }
+                None => return self.evict_lru(),
+            };
+            if let Some(frame) = physical::alloc_frame() {
+                map_slot(idx, frame.as_u64());
+                self.slots[idx as usize].frame = frame.as_u64();
+                self.resident += 1;
+                return Some(idx);
+            }
+            self.empty.push(idx);
+        }
+        self.evict_lru()
+    }
+
+    /// Return up to `count` frames (idle ones first, then inactive pages).
+    fn reclaim(&mut self, count: usize) -> usize {
+        let mut freed = 0;
+        while freed < count {
+            let idx = match self.idle.pop() {
+                Some(idx) => idx,
+                None => match self.evict_lru() {
+                    Some(idx) => idx,
+                    None => break,
+                },
+            };
+            let frame = self.slots[idx as usize].frame;
+            unmap_slot(idx, frame);
+            physical::free_frame(PhysAddr::new(frame));
+            self.slots[idx as usize].frame = 0;
+            self.empty.push(idx);
+            self.resident -= 1;
+            freed += 1;
+        }
+        freed
+    }
+
+    /// Copy `dst.len()` bytes at `in_page` out of a cached page.
+    fn copy_out(&mut self, key: &Key, in_page: usize, dst: &mut [u8]) -> bool {
+        let idx = match self.map.get(key) {
+            Some(&idx) => idx,
+            None => return false,
+        };
+        let (len, frame) = {
+            let s = &mut self.slots[idx as usize];
+            s.ahead = false;
+            (s.len as usize, s.frame)
+        };
+        if in_page + dst.len() > len {
+            return false;
+        }
+        unsafe {
+            crate::memory::memops::copy(dst.as_mut_ptr(), slot_ptr(idx, frame).add(in_page), dst.len());
+        }
+        self.touch(idx);
+        true
+    }
+
+    fn insert(&mut self, key: Key, data: &[u8], ahead: bool, pressure: bool) {
+        self.forget(&key);
+        let idx = match self.take_slot(pressure) {
+            Some(idx) => idx,
+            None => return,
+        };
+        let frame = self.slots[idx as usize].frame;
+        unsafe {
+            crate::memory::memops::copy(slot_ptr(idx, frame), data.as_ptr(), data.len());
+        }
+        let s = &mut self.slots[idx as usize];
+        s.key = key;
+        s.len = data.len() as u16;
+        s.ahead = ahead;
+        self.map.insert(key, idx);
+        self.push_front(idx, false);
+    }
+
+    fn forget_range(&mut self, lo: Key, hi: Key) {
+        GENERATION.fetch_add(1, Ordering::Release);
+        let keys: Vec<Key> = self.map.range(lo..=hi).map(|(k, _)| *k).collect();
+        for key in &keys {
+            self.forget(key);
+        }
+    }
+}
+
+/// Store `data` (whole pages from page `first` on; the last may be short),
+/// unless anything was invalidated since `gen` was sampled — a write may
+/// have raced with the backend read, so `data` could already be stale.
+/// Pages from `ahead_from` on are flagged as readahead.
+fn insert_pages(mount: u32, inode: u32, first: u32, data: &[u8], ahead_from: u32, gen: u64) {
+    let pressure = under_pressure();
+    let mut cache = PAGE_CACHE.lock();
+    if GENERATION.load(Ordering::Acquire) != gen {
+        return;
+    }
+    for (i, chunk) in data.chunks(PAGE_SIZE).enumerate() {
+        let page = first + i as u32;
+        cache.insert((mount, inode, page), chunk, page >= ahead_from, pressure);
+    }
+    if pressure {
+        cache.reclaim(RECLAIM_BATCH);
+    }
+}
+
+/// First page at or after `from` (and before `to`) that is not cached.
+fn first_missing(mount: u32, inode: u32, from: u32, to: u32) -> u32 {
+    let cache = PAGE_CACHE.lock();
+    (from..to).find(|&p| !cache.map.contains_key(&(mount, inode, p))).unwrap_or(to)
+}
+
+/// Fill pages `page..` from the backend with one read, extending over
+/// uncached pages up to `limit` (exclusive, at most `max_run`) and caching
+/// them; pages from `ahead_from` on count as readahead.  Returns the run
+/// buffer and the bytes the backend delivered.
+fn fill_run(
+    mount: u32,
+    inode: u32,
+    file_size: u32,
+    page: u32,
+    limit: u32,
+    max_run: u32,
+    ahead_from: u32,
+    fill: &mut dyn FnMut(u32, &mut [u8]) -> Result<usize, FsError>,
+) -> Result<(Vec<u8>, usize), FsError> {
+    let ps = PAGE_SIZE as u32;
+    let mut run_end = page + 1;
+    {
+        let cache = PAGE_CACHE.lock();
+        while run_end < limit
+            && run_end - page < max_run
+            && !cache.map.contains_key(&(mount, inode, run_end))
+        {
+            run_end += 1;
+        }
+    }
+    let wanted = run_end.min(ahead_from.max(page));
+    MISSES.fetch_add((wanted - page) as u64, Ordering::Relaxed);
+    RA_PAGES.fetch_add((run_end - wanted) as u64, Ordering::Relaxed);
+
+    let run_start = page * ps;
+    let run_bytes = ((run_end as u64 * ps as u64).min(file_size as u64) - run_start as u64) as usize;
+    let mut tmp = alloc::vec![0u8; run_bytes];
+    let gen = generation();
+    let got = fill(run_start, &mut tmp)?;
+    if got == run_bytes {
+        insert_pages(mount, inode, page, &tmp, ahead_from, gen);
+    }
+    Ok((tmp, got))
+}
+
+/// Read file data through the cache.  May run without the VFS lock.
+///
+/// Behaves like a backend `read_file(inode, offset, buf)` clamped to
+/// `file_size`.  `fill(offset, buf)` reads from the backend; it is only
+/// called with page-aligned offsets, for whole pages (or up to EOF).
+/// `ra` is the open file's readahead state: for a sequential stream the
+/// fills reach past the request, up to the end of its window.
+/// `inode == 0` (file without data clusters) bypasses the cache.
+pub fn read(
+    mount: u32,
+    inode: u32,
+    file_size: u32,
+    offset: u32,
+    buf: &mut [u8],
+    ra: &mut Readahead,
+    fill: &mut dyn FnMut(u32, &mut [u8]) -> Result<usize, FsError>,
+) -> Result<usize, FsError> {
+    if offset >= file_size || buf.is_empty() {
+        return Ok(0);
+    }
+    let end = (offset as u64 + buf.len() as u64).min(file_size as u64) as u32;
+    if inode == 0 {
+        return fill(offset, &mut buf[..(end - offset) as usize]);
+    }
+    let ps = PAGE_SIZE as u32;
+    let last_page = (end - 1) / ps;
+    let file_pages = ((file_size as u64 + ps as u64 - 1) / ps as u64) as u32;
+    let fill_end = ra.advance(offset / ps, last_page, file_pages);
+    ra.next = end / ps;
+    let max_run = if fill_end > last_page + 1 { RA_MAX_PAGES } else { MAX_FILL_PAGES };
+    let mut pos = offset;
+
+    while pos < end {
+        let page = pos / ps;
+        let in_page = (pos % ps) as usize;
+        let n = (ps - pos % ps).min(end - pos) as usize;
+        let dst_off = (pos - offset) as usize;
+        if PAGE_CACHE.lock().copy_out(&(mount, inode, page), in_page, &mut buf[dst_off..dst_off + n]) {
+            HITS.fetch_add(1, Ordering::Relaxed);
+            pos += n as u32;
+            continue;
+        }
+
+        // Fill the miss together with the following uncached pages of the
+        // request and, for a sequential stream, of the readahead window.
+        let (tmp, got) = fill_run(mount, inode, file_size, page, fill_end, max_run, last_page + 1, fill)?;
+
+        // Copy the requested part of the run (stops early on a short read).
+        let want_end = ((end - page * ps) as usize).min(got);
+        if want_end <= in_page {
+            break;
+        }
+        let copied = want_end - in_page;
+        buf[dst_off..dst_off + copied].copy_from_slice(&tmp[in_page..want_end]);
+        pos += copied as u32;
+        if got < tmp.len() {
+            break;
+        }
+    }
+
+    // The request hit the cache: read the rest of the window ahead now,
+    // as one large fill instead of many small ones later.
+    let mut page = if pos == end { first_missing(mount, inode, last_page + 1, fill_end) } else { fill_end };
+    while page < fill_end {
+        let pages = match fill_run(mount, inode, file_size, page, fill_end, RA_MAX_PAGES, page, fill) {
+            Ok((tmp, got)) if got == tmp.len() => (tmp.len() + PAGE_SIZE - 1) / PAGE_SIZE,
+            _ => break, // readahead is best effort
+        };
+        page = first_missing(mount, inode, page + pages as u32, fill_end);
+    }
+    Ok((pos - offset) as usize)
+}
+
+/// The whole file from the cache, if every page of it is present.
+pub fn read_whole(mount: u32, inode: u32, size: u32) -> Option<Vec<u8>> {
+    if inode == 0 || size == 0 {
+        return None;
+    }
+    let pages = (size as usize + PAGE_SIZE - 1) / PAGE_SIZE;
+    {
+        let cache = PAGE_CACHE.lock();
+        if !(0..pages as u32).all(|p| cache.map.contains_key(&(mount, inode, p))) {
+            return None;
+        }
+    }
+    let mut data = alloc::vec![0u8; size as usize];
+    for (p, chunk) in data.chunks_mut(PAGE_SIZE).enumerate() {
+        if !PAGE_CACHE.lock().copy_out(&(mount, inode, p as u32), 0, chunk) {
+            // Evicted in between — let the caller read the file.
+            MISSES.fetch_add(1, Ordering::Relaxed);
+            return None;
+        }
+    }
+    HITS.fetch_add(pages as u64, Ordering::Relaxed);
+    Some(data)
+}
+
+/// Invalidation generation; sample it under the VFS lock before reading a
+/// file outside it and pass it to [`insert_file`].
+pub fn generation() -> u64 {
+    GENERATION.load(Ordering::Acquire)
+}
+
+/// Cache the complete contents of a file read around the cache
+/// (skipped if anything was invalidated since `gen`).
+pub fn insert_file(mount: u32, inode: u32, data: &[u8], gen: u64) {
+    if inode == 0 || data.is_empty() {
+        return;
+    }
+    MISSES.fetch_add(((data.len() + PAGE_SIZE - 1) / PAGE_SIZE) as u64, Ordering::Relaxed);
+    insert_pages(mount, inode, 0, data, u32::MAX, gen);
+}
+
+/// Forget every page of one file (and its cached executable image).
+pub fn invalidate_inode(mount: u32, inode: u32) {
+    PAGE_CACHE.lock().forget_range((mount, inode, 0), (mount, inode, u32::MAX));
+    #[cfg(target_arch = "x86_64")]
+    crate::task::image_cache::forget_inode(mount, inode);
+}
+
+/// Forget every page of one mount (media change, unmount).
+pub fn invalidate_mount(mount: u32) {
+    PAGE_CACHE.lock().forget_range((mount, 0, 0), (mount, u32::MAX, u32::MAX));
+    #[cfg(target_arch = "x86_64")]
+    crate::task::image_cache::forget_mount(mount);
+}
+
+/// Forget everything (raw writes to a block device).
+pub fn invalidate_all() {
+    let mut cache = PAGE_CACHE.lock();
+    GENERATION.fetch_add(1, Ordering::Release);
+    let keys: Vec<Key> = cache.map.keys().copied().collect();
+    for key in &keys {
+        cache.forget(key);
+    }
+    drop(cache);
+    #[cfg(target_arch = "x86_64")]
+    crate::task::image_cache::forget_all();
+}
+
+/// Return up to `frames` cached pages to the frame allocator, oldest
+/// inactive pages first.  Returns the number freed.
+pub fn shrink(frames: usize) -> usize {
+    PAGE_CACHE.lock().reclaim(frames)
+}
+
+/// Snapshot of the cache counters.
+pub fn stats() -> PageCacheStats {
+    let (pages, active, inactive) = {
+        let cache = PAGE_CACHE.lock();
+        (cache.resident, cache.active.len, cache.inactive.len)
+    };
+    PageCacheStats {
+        pages: pages as u32,
+        active: active as u32,
+        inactive: inactive as u32,
+        budget: budget() as u32,
+        hits: HITS.load(Ordering::Relaxed),
+        misses: MISSES.load(Ordering::Relaxed),
+        evictions: EVICTIONS.load(Ordering::Relaxed),
+        readahead: RA_PAGES.load(Ordering::Relaxed),
+        readahead_wasted: RA_WASTED.load(Ordering::Relaxed),
+    }
+}
@@ -20,9 +20,19 @@ pub const DEFAULT_MODE: u16 = 0xFFF;
 ///
 /// Returns true if the operation is allowed.
 pub fn check_permission(file_uid: u16, file_gid: u16, mode: u16, needed: u16) -> bool {
-    let thread_uid = crate::task::scheduler::current_thread_uid();
-    let thread_gid = crate::task::scheduler::current_thread_gid();
+    check_permission_as(
+        crate::task::scheduler::current_thread_uid(),
+        crate::task::scheduler::current_thread_gid(),
+        file_uid, file_gid, mode, needed,
+    )
+}
 
+/// Like [`check_permission`], for an explicit `thread_uid`/`thread_gid`
+/// (kernel workers acting on behalf of a user thread).
+pub fn check_permission_as(
+    thread_uid: u16, thread_gid: u16,
+    file_uid: u16, file_gid: u16, mode: u16, needed: u16,
+) -> bool {
     // Root bypasses everything
     if thread_uid == 0 {
         return true;
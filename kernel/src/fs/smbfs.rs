@@ -1,13 +1,20 @@
 //! SMB2 network filesystem client -- mounts remote SMB/CIFS shares via TCP.
 //!
-//! Implements a minimal SMB2 (dialect 0x0202) client that connects over TCP port 445,
+//! Implements a minimal SMB2 (dialect 0x0202 / 0x0210) client that connects over TCP port 445,
 //! performs negotiate + session setup (anonymous/guest) + tree connect, then provides
 //! standard Filesystem trait operations (lookup, read, write, readdir, create, delete).
+//!
+//! Large reads and writes are split into READ/WRITE requests of up to the negotiated
+//! MaxReadSize/MaxWriteSize (up to 1 MiB with SMB 2.1 LARGE_MTU) and pipelined: as many
+//! as the credits granted by the server allow are kept in flight, and responses are
+//! matched back by MessageId.  File data is cached client-side (see `ReadCache`).
 
 use crate::fs::file::{DirEntry, FileType};
 use crate::fs::vfs::FsError;
+use crate::fs::writeback;
 use crate::net::tcp;
 use crate::net::types::Ipv4Addr;
+use alloc::collections::BTreeMap;
 use alloc::string::String;
 use alloc::vec;
 use alloc::vec::Vec;
@@ -37,6 +44,30 @@ const SMB2_SET_INFO: u16 = 17;
 const STATUS_SUCCESS: u32 = 0;
 const STATUS_MORE_PROCESSING_REQUIRED: u32 = 0xC0000016;
 const STATUS_NO_MORE_FILES: u32 = 0x80000006;
+const STATUS_PENDING: u32 = 0x00000103;
+const STATUS_END_OF_FILE: u32 = 0xC0000011;
+
+// SMB2 dialects we offer; 2.1 adds multi-credit (large MTU) requests
+const DIALECT_SMB2_0_2: u16 = 0x0202;
+const DIALECT_SMB2_1: u16 = 0x0210;
+
+// Negotiate capabilities and header flags
+const SMB2_GLOBAL_CAP_LARGE_MTU: u32 = 0x00000004;
+const SMB2_FLAGS_ASYNC_COMMAND: u32 = 0x00000002;
+
+/// Payload bytes covered by one credit (multi-credit READ/WRITE).
+const CREDIT_UNIT: usize = 65536;
+/// Largest READ/WRITE payload we issue, even if the server allows more.
+const MAX_IO_SIZE: u32 = 1024 * 1024;
+/// Credits asked for on every request, so the window grows to allow pipelining.
+const CREDIT_REQUEST: u16 = 64;
+/// READ/WRITE requests kept in flight by one call.
+const MAX_IN_FLIGHT: usize = 8;
+
+// Client read cache: block size, lifetime without revalidation, byte budget
+const CACHE_BLOCK: u32 = 64 * 1024;
+const CACHE_TTL_MS: u32 = 1000;
+const CACHE_LIMIT: usize = 8 * 1024 * 1024;
 
 // SMB2 CREATE disposition
 const FILE_OPEN: u32 = 1;
@@ -93,6 +124,130 @@ struct SmbHandle {
     path: String,
 }
 
+/// A cached block of file data and when it was fetched.
+struct CachedBlock {
+    data: Vec<u8>,
+    loaded: u32,
+}
+
+/// Client-side cache of file data read from the server, in `CACHE_BLOCK`
+/// blocks keyed by `(inode, block index)`.  A block shorter than
+/// `CACHE_BLOCK` ends at end of file.
+///
+/// Without leases, blocks are trusted for `CACHE_TTL_MS` and the file's
+/// size and LastWriteTime (seen on every CREATE) are checked against the
+/// ones the blocks were read under; our own writes and deletes invalidate
+/// directly.  A lease or oplock break would call [`SmbFs::invalidate_cache`].
+struct ReadCache {
+    blocks: BTreeMap<(u32, u32), CachedBlock>,
+    /// `(end_of_file, last_write_time)` the cached blocks of an inode belong to.
+    versions: BTreeMap<u32, (u64, u64)>,
+    bytes: usize,
+}
+
+impl ReadCache {
+    const fn new() -> Self {
+        ReadCache { blocks: BTreeMap::new(), versions: BTreeMap::new(), bytes: 0 }
+    }
+
+    /// Copy `[offset, offset + buf.len())` of `inode` into `buf` if every
+    /// block it needs is cached and fresh.  Returns the bytes served, which
+    /// is short only at end of file.
+    fn read(&self, inode: u32, offset: u32, buf: &mut [u8]) -> Option<usize> {
+        if self.blocks.is_empty() {
+            return None;
+        }
+        let now = writeback::now_ms();
+        let end = offset as u64 + buf.len() as u64;
+        let mut pos = offset as u64;
+        while pos < end {
+            let index = (pos / CACHE_BLOCK as u64) as u32;
+            let block = self.blocks.get(&(inode, index))?;
+            if now.wrapping_sub(block.loaded) >= CACHE_TTL_MS {
+                return None;
+            }
+            let in_block = (pos - index as u64 * CACHE_BLOCK as u64) as usize;
+            if in_block >= block.data.len() {
+                break;
+            }
+            let n = (block.data.len() - in_block).min((end - pos) as usize);
+            let dst = (pos - offset as u64) as usize;
+            buf[dst..dst + n].copy_from_slice(&block.data[in_block..in_block + n]);
+            pos += n as u64;
+            if block.data.len() < CACHE_BLOCK as usize {
+                break;
+            }
+        }
+        Some((pos - offset as u64) as usize)
+    }
+
+    /// Cache `data`, read from the block-aligned offset `start`.  `to_eof`
+    /// says the read stopped at end of file, so its last block is final.
+    fn store(&mut self, inode: u32, start: u32, data: &[u8], to_eof: bool) {
+        if data.len() > CACHE_LIMIT / 2 {
+            return;
+        }
+        let now = writeback::now_ms();
+        let mut index = start / CACHE_BLOCK;
+        for chunk in data.chunks(CACHE_BLOCK as usize) {
+            if chunk.len() < CACHE_BLOCK as usize && !to_eof {
+                break;
+            }
+            let block = CachedBlock { data: Vec::from(chunk), loaded: now };
+            self.bytes += chunk.len();
+            if let Some(old) = self.blocks.insert((inode, index), block) {
+                self.bytes -= old.data.len();
+            }
+            index += 1;
+        }
+        while self.bytes > CACHE_LIMIT {
+            let oldest = self.blocks.iter()
+                .max_by_key(|(_, b)| now.wrapping_sub(b.loaded))
+                .map(|(k, _)| *k);
+            match oldest {
+                Some(k) => {
+                    if let Some(old) = self.blocks.remove(&k) {
+                        self.bytes -= old.data.len();
+                    }
+                }
+                None => break,
+            }
+        }
+    }
+
+    /// Record the server's current size and LastWriteTime of `inode`,
+    /// dropping its blocks if the file changed since they were read.
+    fn revalidate(&mut self, inode: u32, end_of_file: u64, last_write: u64) {
+        match self.versions.insert(inode, (end_of_file, last_write)) {
+            Some(v) if v != (end_of_file, last_write) => self.drop_blocks(inode),
+            _ => {}
+        }
+    }
+
+    /// Forget everything cached for `inode`.
+    fn invalidate(&mut self, inode: u32) {
+        self.versions.remove(&inode);
+        self.drop_blocks(inode);
+    }
+
+    fn drop_blocks(&mut self, inode: u32) {
+        let keys: Vec<(u32, u32)> = self.blocks.range((inode, 0)..=(inode, u32::MAX))
+            .map(|(k, _)| *k)
+            .collect();
+        for k in keys {
+            if let Some(old) = self.blocks.remove(&k) {
+                self.bytes -= old.data.len();
+            }
+        }
+    }
+
+    fn clear(&mut self) {
+        self.blocks.clear();
+        self.versions.clear();
+        self.bytes = 0;
+    }
+}
+
 /// SMB2 network filesystem instance.
 pub struct SmbFs {
     /// Kernel TCP socket id.
@@ -113,6 +268,12 @@ pub struct SmbFs {
     max_read_size: u32,
     /// Max write size from negotiate response.
     max_write_size: u32,
+    /// Dialect 2.1 with LARGE_MTU: READ/WRITE may charge several credits.
+    large_mtu: bool,
+    /// Credits currently granted by the server (requests we may have in flight).
+    credits: u32,
+    /// Client-side cache of file data.
+    cache: ReadCache,
 }
 
 impl SmbFs {
@@ -147,6 +308,9 @@ impl SmbFs {
             path_map: Vec::new(),
             max_read_size: 65536,
             max_write_size: 65536,
+            large_mtu: false,
+            credits: 1,
+            cache: ReadCache::new(),
         };
 
         // SMB2 Negotiate
@@ -170,7 +334,7 @@ impl SmbFs {
     }
 
     /// Disconnect from the server (close TCP).
-    pub fn disconnect(self) {
+    pub fn disconnect(&self) {
         tcp::close(self.socket_id);
     }
 
@@ -178,28 +342,33 @@ impl SmbFs {
     // SMB2 Protocol Operations
     // -----------------------------------------------------------------------
 
-    /// Build an SMB2 header for the given command.
+    /// Build an SMB2 header for the given command (credit charge 1).
     fn build_header(&mut self, command: u16) -> [u8; SMB2_HEADER_SIZE] {
+        self.build_header_charged(command, 1)
+    }
+
+    /// Build an SMB2 header for a request consuming `charge` credits.
+    fn build_header_charged(&mut self, command: u16, charge: u16) -> [u8; SMB2_HEADER_SIZE] {
         let mut hdr = [0u8; SMB2_HEADER_SIZE];
         // Protocol ID
         hdr[0..4].copy_from_slice(&SMB2_MAGIC);
         // Structure size = 64
         put_u16_le(&mut hdr[4..6], 64);
-        // Credit charge = 1
-        put_u16_le(&mut hdr[6..8], 1);
+        // Credit charge
+        put_u16_le(&mut hdr[6..8], charge);
         // Status = 0
         put_u32_le(&mut hdr[8..12], 0);
         // Command
         put_u16_le(&mut hdr[12..14], command);
-        // Credit request = 1
-        put_u16_le(&mut hdr[14..16], 1);
+        // Credit request: ask for enough to keep several requests in flight
+        put_u16_le(&mut hdr[14..16], CREDIT_REQUEST);
         // Flags = 0
         put_u32_le(&mut hdr[16..20], 0);
         // NextCommand = 0
         put_u32_le(&mut hdr[20..24], 0);
-        // Message ID
+        // Message ID; a multi-credit request consumes `charge` ids
         put_u64_le(&mut hdr[24..32], self.message_id);
-        self.message_id += 1;
+        self.message_id += charge.max(1) as u64;
         // Reserved
         put_u32_le(&mut hdr[32..36], 0);
         // Tree ID
@@ -210,8 +379,29 @@ impl SmbFs {
         hdr
     }
 
-    /// Send an SMB2 message (NetBIOS length prefix + header + payload) and receive response.
+    /// Credits a READ/WRITE of `len` bytes is charged.
+    fn io_charge(&self, len: usize) -> u16 {
+        if self.large_mtu {
+            ((len + CREDIT_UNIT - 1) / CREDIT_UNIT).max(1) as u16
+        } else {
+            1
+        }
+    }
+
+    /// Send an SMB2 message and receive its response.
     fn transact(&mut self, header: &[u8; SMB2_HEADER_SIZE], payload: &[u8]) -> Result<Vec<u8>, FsError> {
+        let id = self.send_request(header, payload)?;
+        loop {
+            let resp = self.recv_response()?;
+            if resp.len() < SMB2_HEADER_SIZE || Self::response_message_id(&resp) == id {
+                return Ok(resp);
+            }
+        }
+    }
+
+    /// Send an SMB2 message (NetBIOS length prefix + header + payload)
+    /// without waiting for the response.  Returns its message id.
+    fn send_request(&mut self, header: &[u8; SMB2_HEADER_SIZE], payload: &[u8]) -> Result<u64, FsError> {
         let total_len = SMB2_HEADER_SIZE + payload.len();
 
         // Build packet: 4-byte NetBIOS length + header + payload
@@ -230,34 +420,53 @@ impl SmbFs {
             crate::serial_println!("[SMBFS] send failed");
             return Err(FsError::IoError);
         }
+        let charge = get_u16_le(&header[6..8]).max(1) as u32;
+        self.credits = self.credits.saturating_sub(charge);
+        Ok(get_u64_le(&header[24..32]))
+    }
 
-        // Receive response: first read 4-byte NetBIOS header
-        let mut nb_hdr = [0u8; 4];
-        let n = tcp::recv(self.socket_id, &mut nb_hdr, SMB_TIMEOUT);
-        if n == u32::MAX || n < 4 {
-            crate::serial_println!("[SMBFS] recv NetBIOS header failed (got {})", n);
-            return Err(FsError::IoError);
-        }
-
-        let resp_len = ((nb_hdr[1] as usize) << 16) | ((nb_hdr[2] as usize) << 8) | (nb_hdr[3] as usize);
-        if resp_len == 0 || resp_len > 1024 * 1024 {
-            crate::serial_println!("[SMBFS] invalid response length: {}", resp_len);
-            return Err(FsError::IoError);
-        }
+    /// Receive the next final SMB2 response, in whatever order the server
+    /// completes requests.  Interim STATUS_PENDING responses of requests
+    /// the server finishes asynchronously are skipped; every response
+    /// returns the credits it grants to the window.
+    fn recv_response(&mut self) -> Result<Vec<u8>, FsError> {
+        loop {
+            // Receive response: first read 4-byte NetBIOS header
+            let mut nb_hdr = [0u8; 4];
+            let n = tcp::recv(self.socket_id, &mut nb_hdr, SMB_TIMEOUT);
+            if n == u32::MAX || n < 4 {
+                crate::serial_println!("[SMBFS] recv NetBIOS header failed (got {})", n);
+                return Err(FsError::IoError);
+            }
 
-        // Read full response
-        let mut response = vec![0u8; resp_len];
-        let mut received = 0usize;
-        while received < resp_len {
-            let n = tcp::recv(self.socket_id, &mut response[received..], SMB_TIMEOUT);
-            if n == u32::MAX || n == 0 {
-                crate::serial_println!("[SMBFS] recv body failed at {}/{}", received, resp_len);
+            let resp_len = ((nb_hdr[1] as usize) << 16) | ((nb_hdr[2] as usize) << 8) | (nb_hdr[3] as usize);
+            if resp_len == 0 || resp_len > MAX_IO_SIZE as usize + 4096 {
+                crate::serial_println!("[SMBFS] invalid response length: {}", resp_len);
                 return Err(FsError::IoError);
             }
-            received += n as usize;
-        }
 
-        Ok(response)
+            // Read full response
+            let mut response = vec![0u8; resp_len];
+            let mut received = 0usize;
+            while received < resp_len {
+                let n = tcp::recv(self.socket_id, &mut response[received..], SMB_TIMEOUT);
+                if n == u32::MAX || n == 0 {
+                    crate::serial_println!("[SMBFS] recv body failed at {}/{}", received, resp_len);
+                    return Err(FsError::IoError);
+                }
+                received += n as usize;
+            }
+
+            if response.len() < SMB2_HEADER_SIZE {
+                return Ok(response);
+            }
+            self.credits = self.credits.saturating_add(get_u16_le(&response[14..16]) as u32);
+            let flags = get_u32_le(&response[16..20]);
+            if Self::response_status(&response) == STATUS_PENDING && flags & SMB2_FLAGS_ASYNC_COMMAND != 0 {
+                continue;
+            }
+            return Ok(response);
+        }
     }
 
     /// Parse response status from an SMB2 response.
@@ -268,6 +477,14 @@ impl SmbFs {
         get_u32_le(&response[8..12])
     }
 
+    /// Extract the MessageId a response answers.
+    fn response_message_id(response: &[u8]) -> u64 {
+        if response.len() < SMB2_HEADER_SIZE {
+            return u64::MAX;
+        }
+        get_u64_le(&response[24..32])
+    }
+
     /// Extract session_id from a response header.
     fn response_session_id(response: &[u8]) -> u64 {
         if response.len() < SMB2_HEADER_SIZE {
@@ -289,16 +506,16 @@ impl SmbFs {
         let hdr = self.build_header(SMB2_NEGOTIATE);
 
         // Negotiate request body:
-        // StructureSize(2)=36, DialectCount(2)=1, SecurityMode(2)=0,
-        // Reserved(2)=0, Capabilities(4)=0, ClientGuid(16)=0, ClientStartTime(8)=0,
-        // Dialects(2)=0x0202
+        // StructureSize(2)=36, DialectCount(2)=2, SecurityMode(2)=0,
+        // Reserved(2)=0, Capabilities(4)=LARGE_MTU, ClientGuid(16)=0,
+        // ClientStartTime(8)=0, Dialects(2 each)=0x0202, 0x0210
         let mut body = vec![0u8; 36];
         put_u16_le(&mut body[0..2], 36); // StructureSize
-        put_u16_le(&mut body[2..4], 1);  // DialectCount
-        // SecurityMode, Reserved, Capabilities, ClientGuid, ClientStartTime are 0
-        // Append dialect 0x0202 (SMB 2.0.2)
-        body.push(0x02);
-        body.push(0x02);
+        put_u16_le(&mut body[2..4], 2);  // DialectCount
+        put_u32_le(&mut body[8..12], SMB2_GLOBAL_CAP_LARGE_MTU); // Capabilities
+        // SecurityMode, Reserved, ClientGuid, ClientStartTime are 0
+        body.extend_from_slice(&DIALECT_SMB2_0_2.to_le_bytes());
+        body.extend_from_slice(&DIALECT_SMB2_1.to_le_bytes());
 
         let resp = self.transact(&hdr, &body)?;
         let status = Self::response_status(&resp);
@@ -307,19 +524,24 @@ impl SmbFs {
             return Err(FsError::IoError);
         }
 
-        // Parse negotiate response for MaxReadSize, MaxWriteSize
-        // Response body starts at offset 64 (after header)
+        // Parse negotiate response for DialectRevision, Capabilities,
+        // MaxReadSize, MaxWriteSize.  Response body starts at offset 64.
+        let mut dialect = DIALECT_SMB2_0_2;
         if resp.len() >= SMB2_HEADER_SIZE + 65 {
             let body = &resp[SMB2_HEADER_SIZE..];
-            // Offset 32: MaxTransactSize(4), MaxReadSize(4), MaxWriteSize(4)
-            if body.len() >= 40 {
-                self.max_read_size = get_u32_le(&body[32..36]).min(1024 * 1024);
-                self.max_write_size = get_u32_le(&body[36..40]).min(1024 * 1024);
-            }
+            // Offset 4: DialectRevision(2); offset 24: Capabilities(4);
+            // offset 28: MaxTransactSize(4), MaxReadSize(4), MaxWriteSize(4)
+            dialect = get_u16_le(&body[4..6]);
+            let caps = get_u32_le(&body[24..28]);
+            self.large_mtu = dialect >= DIALECT_SMB2_1 && caps & SMB2_GLOBAL_CAP_LARGE_MTU != 0;
+            // Without multi-credit requests one READ/WRITE carries at most 64 KiB.
+            let limit = if self.large_mtu { MAX_IO_SIZE } else { CREDIT_UNIT as u32 };
+            self.max_read_size = get_u32_le(&body[32..36]).clamp(4096, limit);
+            self.max_write_size = get_u32_le(&body[36..40]).clamp(4096, limit);
         }
 
-        crate::serial_println!("[SMBFS] Negotiate OK, max_read={}, max_write={}",
-            self.max_read_size, self.max_write_size);
+        crate::serial_println!("[SMBFS] Negotiate OK, dialect=0x{:04X}, large_mtu={}, max_read={}, max_write={}",
+            dialect, self.large_mtu, self.max_read_size, self.max_write_size);
         Ok(())
     }
 
@@ -410,7 +632,8 @@ impl SmbFs {
     }
 
     /// SMB2 CREATE — open a file or directory on the share.
-    /// Returns (file_id_persistent[8], file_id_volatile[8], end_of_file, file_attributes).
+    /// Returns (file_id_persistent[8], file_id_volatile[8], end_of_file, file_attributes,
+    /// last_write_time).
     fn smb2_create(
         &mut self,
         path: &str,
@@ -418,7 +641,7 @@ impl SmbFs {
         share_access: u32,
         disposition: u32,
         options: u32,
-    ) -> Result<([u8; 16], u64, u32), FsError> {
+    ) -> Result<([u8; 16], u64, u32, u64), FsError> {
         // Convert path to UTF-16LE (strip leading /)
         let clean = path.trim_start_matches('/');
         // SMB paths use backslashes
@@ -484,7 +707,10 @@ impl SmbFs {
         // EndOfFile at offset 48
         let end_of_file = get_u64_le(&rbody[48..56]);
 
-        Ok((file_id, end_of_file, attrs))
+        // LastWriteTime at offset 24
+        let last_write = get_u64_le(&rbody[24..32]);
+
+        Ok((file_id, end_of_file, attrs, last_write))
     }
 
     /// SMB2 CLOSE — close a file handle.
@@ -501,15 +727,13 @@ impl SmbFs {
         Ok(())
     }
 
-    /// SMB2 READ — read data from a file.
-    fn smb2_read(&mut self, file_id: &[u8; 16], offset: u64, length: u32) -> Result<Vec<u8>, FsError> {
-        let read_len = length.min(self.max_read_size);
-
+    /// SMB2 READ request for `length` bytes at `offset`.
+    fn read_request(&mut self, file_id: &[u8; 16], offset: u64, length: u32) -> ([u8; SMB2_HEADER_SIZE], Vec<u8>) {
         let mut body = vec![0u8; 48]; // Fixed size before file_id
         put_u16_le(&mut body[0..2], 49); // StructureSize
         body[2] = 0; // Padding
         body[3] = 0; // Flags
-        put_u32_le(&mut body[4..8], read_len); // Length
+        put_u32_le(&mut body[4..8], length); // Length
         put_u64_le(&mut body[8..16], offset); // Offset
         body[16..32].copy_from_slice(file_id); // FileId
         put_u32_le(&mut body[32..36], 0); // MinimumCount
@@ -520,13 +744,16 @@ impl SmbFs {
         // Add 1 byte of padding (StructureSize is 49 = odd, so body needs a buffer byte)
         body.push(0);
 
-        let hdr = self.build_header(SMB2_READ);
-        let resp = self.transact(&hdr, &body)?;
-        let status = Self::response_status(&resp);
+        let charge = self.io_charge(length as usize);
+        (self.build_header_charged(SMB2_READ, charge), body)
+    }
 
+    /// Extract the data of an SMB2 READ response (empty at end of file).
+    fn parse_read_response(resp: &[u8]) -> Result<&[u8], FsError> {
+        let status = Self::response_status(resp);
         if status != STATUS_SUCCESS {
-            if status == 0xC0000011 { // STATUS_END_OF_FILE
-                return Ok(Vec::new());
+            if status == STATUS_END_OF_FILE {
+                return Ok(&[]);
             }
             crate::serial_println!("[SMBFS] Read failed: 0x{:08X}", status);
             return Err(FsError::IoError);
@@ -544,23 +771,77 @@ impl SmbFs {
         if data_offset < SMB2_HEADER_SIZE || data_offset + data_len > resp.len() {
             // Fallback: data might be right after the response body header
             if rbody.len() >= 16 + data_len {
-                return Ok(Vec::from(&rbody[16..16 + data_len]));
+                return Ok(&rbody[16..16 + data_len]);
             }
             return Err(FsError::IoError);
         }
 
-        Ok(Vec::from(&resp[data_offset..data_offset + data_len]))
+        Ok(&resp[data_offset..data_offset + data_len])
     }
 
-    /// SMB2 WRITE — write data to a file.
-    fn smb2_write(&mut self, file_id: &[u8; 16], offset: u64, data: &[u8]) -> Result<u32, FsError> {
-        let write_len = data.len().min(self.max_write_size as usize);
+    /// Read `length` bytes at `offset` with up to `MAX_IN_FLIGHT` READ
+    /// requests outstanding, as far as the granted credits allow.  The
+    /// result is short only at end of file.
+    fn smb2_read(&mut self, file_id: &[u8; 16], offset: u64, length: usize) -> Result<Vec<u8>, FsError> {
+        let mut out = vec![0u8; length];
+        // Bytes known to exist; lowered when a chunk comes back short (EOF).
+        let mut valid = length;
+        let mut next = 0usize;
+        // (message id, offset in `out`, requested length)
+        let mut in_flight: Vec<(u64, usize, usize)> = Vec::new();
+        let mut error = None;
+
+        loop {
+            while error.is_none() && next < valid && in_flight.len() < MAX_IN_FLIGHT {
+                let chunk = (valid - next).min(self.max_read_size as usize);
+                if !in_flight.is_empty() && self.io_charge(chunk) as u32 > self.credits {
+                    break;
+                }
+                let (hdr, body) = self.read_request(file_id, offset + next as u64, chunk as u32);
+                match self.send_request(&hdr, &body) {
+                    Ok(id) => in_flight.push((id, next, chunk)),
+                    Err(e) => error = Some(e),
+                }
+                next += chunk;
+            }
+            if in_flight.is_empty() {
+                break;
+            }
+
+            // A receive failure leaves the connection unusable; give up.
+            let resp = self.recv_response()?;
+            let id = Self::response_message_id(&resp);
+            let (_, rel, chunk) = match in_flight.iter().position(|f| f.0 == id) {
+                Some(i) => in_flight.swap_remove(i),
+                None => continue,
+            };
+            match Self::parse_read_response(&resp) {
+                Ok(data) => {
+                    let n = data.len().min(chunk);
+                    out[rel..rel + n].copy_from_slice(&data[..n]);
+                    if n < chunk {
+                        valid = valid.min(rel + n);
+                    }
+                }
+                Err(e) => error = Some(e),
+            }
+        }
+
+        if let Some(e) = error {
+            return Err(e);
+        }
+        out.truncate(valid);
+        Ok(out)
+    }
 
-        let mut body = vec![0u8; 48];
+    /// SMB2 WRITE request for `data` at `offset`.
+    fn write_request(&mut self, file_id: &[u8; 16], offset: u64, data: &[u8]) -> ([u8; SMB2_HEADER_SIZE], Vec<u8>) {
+        let mut body = Vec::with_capacity(48 + data.len());
+        body.resize(48, 0);
         put_u16_le(&mut body[0..2], 49); // StructureSize
         // DataOffset = 112 (header 64 + body 48)
         put_u16_le(&mut body[2..4], 112);
-        put_u32_le(&mut body[4..8], write_len as u32); // Length
+        put_u32_le(&mut body[4..8], data.len() as u32); // Length
         put_u64_le(&mut body[8..16], offset); // Offset
         body[16..32].copy_from_slice(file_id); // FileId
         put_u32_le(&mut body[32..36], 0); // Channel
@@ -568,23 +849,65 @@ impl SmbFs {
         put_u16_le(&mut body[40..42], 0); // WriteChannelInfoOffset
         put_u16_le(&mut body[42..44], 0); // WriteChannelInfoLength
         put_u32_le(&mut body[44..48], 0); // Flags
-        body.extend_from_slice(&data[..write_len]);
+        body.extend_from_slice(data);
 
-        let hdr = self.build_header(SMB2_WRITE);
-        let resp = self.transact(&hdr, &body)?;
-        let status = Self::response_status(&resp);
+        let charge = self.io_charge(data.len());
+        (self.build_header_charged(SMB2_WRITE, charge), body)
+    }
 
-        if status != STATUS_SUCCESS {
-            crate::serial_println!("[SMBFS] Write failed: 0x{:08X}", status);
-            return Err(FsError::IoError);
+    /// Write `data` at `offset` with up to `MAX_IN_FLIGHT` WRITE requests
+    /// outstanding.  Returns the bytes written contiguously from `offset`.
+    fn smb2_write(&mut self, file_id: &[u8; 16], offset: u64, data: &[u8]) -> Result<usize, FsError> {
+        let mut written = data.len();
+        let mut next = 0usize;
+        let mut in_flight: Vec<(u64, usize, usize)> = Vec::new();
+        let mut error = None;
+
+        loop {
+            while error.is_none() && next < written && in_flight.len() < MAX_IN_FLIGHT {
+                let chunk = (written - next).min(self.max_write_size as usize);
+                if !in_flight.is_empty() && self.io_charge(chunk) as u32 > self.credits {
+                    break;
+                }
+                let (hdr, body) = self.write_request(file_id, offset + next as u64, &data[next..next + chunk]);
+                match self.send_request(&hdr, &body) {
+                    Ok(id) => in_flight.push((id, next, chunk)),
+                    Err(e) => {
+                        written = next;
+                        error = Some(e);
+                    }
+                }
+                next += chunk;
+            }
+            if in_flight.is_empty() {
+                break;
+            }
+
+            let resp = self.recv_response()?;
+            let id = Self::response_message_id(&resp);
+            let (_, rel, chunk) = match in_flight.iter().position(|f| f.0 == id) {
+                Some(i) => in_flight.swap_remove(i),
+                None => continue,
+            };
+            let status = Self::response_status(&resp);
+            if status != STATUS_SUCCESS {
+                crate::serial_println!("[SMBFS] Write failed: 0x{:08X}", status);
+                written = written.min(rel);
+                error = Some(FsError::IoError);
+                continue;
+            }
+            // Parse response: BytesWritten at offset 4 in body
+            let rbody = &resp[SMB2_HEADER_SIZE..];
+            let n = if rbody.len() >= 8 { get_u32_le(&rbody[4..8]) as usize } else { chunk };
+            if n < chunk {
+                written = written.min(rel + n);
+            }
         }
 
-        // Parse response: BytesWritten at offset 4 in body
-        let rbody = &resp[SMB2_HEADER_SIZE..];
-        if rbody.len() >= 8 {
-            Ok(get_u32_le(&rbody[4..8]))
-        } else {
-            Ok(write_len as u32)
+        match error {
+            // Report what landed before the failure, if anything did.
+            Some(e) if written == 0 => Err(e),
+            _ => Ok(written),
         }
     }
 
@@ -684,6 +1007,7 @@ impl SmbFs {
                     uid: 0,
                     gid: 0,
                     mode: 0o755,
+                    mtime: 0,
                 });
             }
 
@@ -759,7 +1083,7 @@ impl SmbFs {
         }
 
         // Open file to get attributes, then immediately close
-        let (file_id, end_of_file, attrs) = self.smb2_create(
+        let (file_id, end_of_file, attrs, mtime) = self.smb2_create(
             &clean,
             GENERIC_READ,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
@@ -775,27 +1099,49 @@ impl SmbFs {
         };
 
         let inode = self.path_to_inode(&clean);
+        if file_type == FileType::Regular {
+            // Opening a file revalidates its cached data (close-to-open).
+            self.cache.revalidate(inode, end_of_file, mtime);
+        }
         Ok((inode, file_type, end_of_file as u32))
     }
 
     /// Read bytes from a file at the given offset.
+    ///
+    /// Served from the read cache when possible; otherwise the enclosing
+    /// cache blocks are fetched with pipelined READs and cached.
     pub fn read_file(&mut self, inode: u32, offset: u32, buf: &mut [u8]) -> Result<usize, FsError> {
+        if let Some(n) = self.cache.read(inode, offset, buf) {
+            return Ok(n);
+        }
+
         let path = String::from(self.inode_to_path(inode)
             .ok_or(FsError::NotFound)?);
 
-        let (file_id, _eof, _attrs) = self.smb2_create(
+        let (file_id, eof, _attrs, mtime) = self.smb2_create(
             &path,
             GENERIC_READ,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             FILE_OPEN,
             FILE_NON_DIRECTORY_FILE,
         )?;
+        self.cache.revalidate(inode, eof, mtime);
 
-        let data = self.smb2_read(&file_id, offset as u64, buf.len() as u32)?;
+        // Round out to whole cache blocks, but never read past end of file.
+        let start = offset / CACHE_BLOCK * CACHE_BLOCK;
+        let want_end = (offset as u64 + buf.len() as u64 + CACHE_BLOCK as u64 - 1)
+            / CACHE_BLOCK as u64 * CACHE_BLOCK as u64;
+        let end = want_end.min(eof).max(offset as u64 + buf.len() as u64);
+        let len = end.saturating_sub(start as u64) as usize;
+
+        let data = self.smb2_read(&file_id, start as u64, len);
         let _ = self.smb2_close(&file_id);
+        let data = data?;
+        self.cache.store(inode, start, &data, start as u64 + data.len() as u64 >= eof);
 
-        let n = data.len().min(buf.len());
-        buf[..n].copy_from_slice(&data[..n]);
+        let skip = (offset - start) as usize;
+        let n = data.len().saturating_sub(skip).min(buf.len());
+        buf[..n].copy_from_slice(&data[skip..skip + n]);
         Ok(n)
     }
 
@@ -804,7 +1150,8 @@ impl SmbFs {
         let path = String::from(self.inode_to_path(inode)
             .ok_or(FsError::NotFound)?);
 
-        let (file_id, _eof, _attrs) = self.smb2_create(
+        self.cache.invalidate(inode);
+        let (file_id, _eof, _attrs, _mtime) = self.smb2_create(
             &path,
             GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
@@ -812,10 +1159,19 @@ impl SmbFs {
             FILE_NON_DIRECTORY_FILE,
         )?;
 
-        let written = self.smb2_write(&file_id, offset as u64, data)?;
+        let written = self.smb2_write(&file_id, offset as u64, data);
         let _ = self.smb2_close(&file_id);
 
-        Ok(written as usize)
+        written
+    }
+
+    /// Drop cached data of `inode` (from every inode if `None`), e.g. when
+    /// the server breaks a lease or oplock.
+    pub fn invalidate_cache(&mut self, inode: Option<u32>) {
+        match inode {
+            Some(i) => self.cache.invalidate(i),
+            None => self.cache.clear(),
+        }
     }
 
     /// Read directory entries.
@@ -823,7 +1179,7 @@ impl SmbFs {
         let path = String::from(self.inode_to_path(inode)
             .ok_or(FsError::NotFound)?);
 
-        let (file_id, _eof, _attrs) = self.smb2_create(
+        let (file_id, _eof, _attrs, _mtime) = self.smb2_create(
             &path,
             FILE_LIST_DIRECTORY | GENERIC_READ,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
@@ -859,7 +1215,7 @@ impl SmbFs {
             FILE_NON_DIRECTORY_FILE
         };
 
-        let (file_id, _eof, _attrs) = self.smb2_create(
+        let (file_id, _eof, _attrs, _mtime) = self.smb2_create(
             &full_path,
             GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
@@ -889,7 +1245,7 @@ impl SmbFs {
         };
 
         // Open with DELETE access and FILE_DELETE_ON_CLOSE
-        let (file_id, _eof, _attrs) = self.smb2_create(
+        let (file_id, _eof, _attrs, _mtime) = self.smb2_create(
             &full_path,
             DELETE | GENERIC_READ,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
@@ -898,6 +1254,10 @@ impl SmbFs {
         )?;
         let _ = self.smb2_close(&file_id);
 
+        // Deleting a directory removes everything below it; drop the
+        // whole (small, short-lived) cache rather than walk it by path.
+        self.cache.clear();
+
         // Remove from path map
         self.path_map.retain(|h| {
             let hp = h.path.as_str();
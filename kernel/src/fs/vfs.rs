@@ -8,8 +8,10 @@ use crate::fs::iso9660::Iso9660Fs;
 use crate::fs::ntfs::NtfsFs;
 use crate::fs::smbfs::SmbFs;
 use crate::fs::file::{DirEntry, FileDescriptor, FileFlags, FileType, OpenFile};
+use crate::fs::page_cache::{self, Readahead};
 use crate::sync::mutex::Mutex;
 use alloc::string::String;
+use alloc::sync::Arc;
 use alloc::vec::Vec;
 
 /// Maximum number of simultaneously open file descriptors (system-wide).
@@ -37,6 +39,13 @@ pub fn root_partition_lba() -> u32 {
 /// Maximum depth for symlink resolution (prevents infinite loops).
 const MAX_SYMLINK_DEPTH: u32 = 20;
 
+/// Global VFS state: open-file table, mount table and filesystem instances.
+///
+/// Held for path resolution and metadata updates, but not across file data
+/// I/O: `read()` builds a sector plan (exFAT/FAT) or clones the instance
+/// (`Arc` for the read-only ISO 9660 / NTFS drivers, per-share lock for SMB)
+/// and performs the I/O after dropping it.  Lock order: VFS → SMB share →
+/// PAGE_CACHE.
 static VFS: Mutex<Option<VfsState>> = Mutex::new(None);
 
 struct VfsState {
@@ -44,12 +53,14 @@ struct VfsState {
     mount_points: Vec<MountPoint>,
     exfat_fs: Option<ExFatFs>,
     fat_fs: Option<FatFs>,
-    iso9660_fs: Option<Iso9660Fs>,
-    ntfs_fs: Option<NtfsFs>,
+    /// Read-only drivers, shared with readers that run without the VFS lock.
+    iso9660_fs: Option<Arc<Iso9660Fs>>,
+    ntfs_fs: Option<Arc<NtfsFs>>,
     devfs: Option<DevFs>,
     /// SMB network filesystem instances (mount_path, instance).
     /// Vec because multiple different SMB shares can be mounted simultaneously.
-    smbfs: Vec<(String, SmbFs)>,
+    /// Each share has its own lock so network round trips do not hold VFS.
+    smbfs: Vec<(String, Arc<Mutex<SmbFs>>)>,
 }
 
 impl VfsState {
@@ -415,7 +426,7 @@ pub fn mount(path: &str, fs_type: FsType, device_id: u32) {
                 crate::debug_println!("  [VFS] mount: detected NTFS");
                 match NtfsFs::new(device_id, root_partition_lba()) {
                     Ok(ntfs) => {
-                        state.ntfs_fs = Some(ntfs);
+                        state.ntfs_fs = Some(Arc::new(ntfs));
                         crate::serial_println!("  Mounted NTFS (read-only) at '{}'", path);
                     }
                     Err(_e) => {
@@ -447,7 +458,7 @@ pub fn mount(path: &str, fs_type: FsType, device_id: u32) {
     } else if fs_type == FsType::Iso9660 {
         match Iso9660Fs::new() {
             Ok(iso) => {
-                state.iso9660_fs = Some(iso);
+                state.iso9660_fs = Some(Arc::new(iso));
                 crate::serial_println!("  Mounted ISO 9660 at '{}'", path);
             }
             Err(_) => {
@@ -516,6 +527,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
             inode: idx as u32,
             parent_cluster: 0,
             refcount: 1,
+            readahead: Readahead::new(),
         };
 
         state.open_files[slot_id as usize] = Some(file);
@@ -540,6 +552,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
                         inode,
                         parent_cluster: 0,
                         refcount: 1,
+                        readahead: Readahead::new(),
                     };
                     state.open_files[slot_id as usize] = Some(file);
                     return Ok(slot_id);
@@ -564,6 +577,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
                         inode,
                         parent_cluster: 0,
                         refcount: 1,
+                        readahead: Readahead::new(),
                     };
                     state.open_files[slot_id as usize] = Some(file);
                     return Ok(slot_id);
@@ -573,26 +587,28 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
             FsType::Smb => {
                 let mount_path_owned = String::from(mount_path);
                 let relative_path_owned = String::from(relative_path);
-                let smb = state.smbfs.iter_mut()
-                    .find(|(p, _)| *p == mount_path_owned)
-                    .map(|(_, s)| s)
-                    .ok_or(FsError::IoError)?;
-                let lookup_result = smb.lookup(&relative_path_owned);
-                let (inode, file_type, size) = match lookup_result {
-                    Ok(r) => r,
-                    Err(FsError::NotFound) if flags.create => {
-                        // Create file on the SMB share
-                        let rel = relative_path_owned.trim_end_matches('/');
-                        let (parent, name) = match rel.rfind('/') {
-                            Some(0) => ("/", &rel[1..]),
-                            Some(pos) => (&rel[..pos], &rel[pos + 1..]),
-                            None => ("/", rel),
-                        };
-                        let (parent_inode, _, _) = smb.lookup(parent)?;
-                        let new_inode = smb.create_entry(parent_inode, name, FileType::Regular)?;
-                        (new_inode, FileType::Regular, 0)
+                let (inode, file_type, size) = {
+                    let mut smb = state.smbfs.iter()
+                        .find(|(p, _)| *p == mount_path_owned)
+                        .map(|(_, s)| s.lock())
+                        .ok_or(FsError::IoError)?;
+                    let lookup_result = smb.lookup(&relative_path_owned);
+                    match lookup_result {
+                        Ok(r) => r,
+                        Err(FsError::NotFound) if flags.create => {
+                            // Create file on the SMB share
+                            let rel = relative_path_owned.trim_end_matches('/');
+                            let (parent, name) = match rel.rfind('/') {
+                                Some(0) => ("/", &rel[1..]),
+                                Some(pos) => (&rel[..pos], &rel[pos + 1..]),
+                                None => ("/", rel),
+                            };
+                            let (parent_inode, _, _) = smb.lookup(parent)?;
+                            let new_inode = smb.create_entry(parent_inode, name, FileType::Regular)?;
+                            (new_inode, FileType::Regular, 0)
+                        }
+                        Err(e) => return Err(e),
                     }
-                    Err(e) => return Err(e),
                 };
                 let slot_id = state.alloc_slot().ok_or(FsError::TooManyOpenFiles)?;
                 let file = OpenFile {
@@ -606,6 +622,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
                     inode,
                     parent_cluster: 0,
                     refcount: 1,
+                    readahead: Readahead::new(),
                 };
                 state.open_files[slot_id as usize] = Some(file);
                 return Ok(slot_id);
@@ -627,6 +644,9 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
                     let (parent_path, filename) = split_parent_name(path)?;
                     let pr = resolve_exfat_path(exfat, parent_path, true)?;
                     let (pc, _) = crate::fs::exfat::decode_inode(pr.inode);
+                    if let Some((mount, inode)) = cache_id(3, r.inode) {
+                        page_cache::invalidate_inode(mount, inode);
+                    }
                     exfat.truncate_file(pc, filename)?;
                     (0u32, r.file_type, 0u32, pc)
                 } else {
@@ -667,6 +687,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
             inode,
             parent_cluster,
             refcount: 1,
+            readahead: Readahead::new(),
         };
         state.open_files[slot_id as usize] = Some(file);
         return Ok(slot_id);
@@ -682,6 +703,9 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
                 if flags.truncate && flags.write {
                     let (parent_path, filename) = split_parent_name(path)?;
                     let (parent_cluster, _, _) = fat.lookup(parent_path)?;
+                    if let Some((mount, inode)) = cache_id(0, inode) {
+                        page_cache::invalidate_inode(mount, inode);
+                    }
                     fat.truncate_file(parent_cluster, filename)?;
                     (0u32, file_type, 0u32, parent_cluster)
                 } else {
@@ -721,6 +745,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
             inode,
             parent_cluster,
             refcount: 1,
+            readahead: Readahead::new(),
         };
 
         state.open_files[slot_id as usize] = Some(file);
@@ -745,6 +770,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
             inode,
             parent_cluster: 0,
             refcount: 1,
+            readahead: Readahead::new(),
         };
         state.open_files[slot_id as usize] = Some(file);
         return Ok(slot_id);
@@ -768,6 +794,7 @@ pub fn open(path: &str, flags: FileFlags) -> Result<FileDescriptor, FsError> {
             inode,
             parent_cluster: 0,
             refcount: 1,
+            readahead: Readahead::new(),
         };
         state.open_files[slot_id as usize] = Some(file);
         return Ok(slot_id);
@@ -787,6 +814,8 @@ pub fn close(slot_id: FileDescriptor) -> Result<(), FsError> {
             file.refcount -= 1;
         } else {
             *entry = None;
+            drop(vfs);
+            crate::fs::file_lock::unlock(slot_id);
         }
         Ok(())
     } else {
@@ -808,6 +837,7 @@ pub fn incref(slot_id: u32) {
 /// Frees the slot if refcount drops to 0.
 pub fn decref(slot_id: u32) {
     let mut vfs = VFS.lock();
+    let mut freed = false;
     if let Some(state) = vfs.as_mut() {
         if let Some(entry) = state.open_files.get_mut(slot_id as usize) {
             if let Some(file) = entry {
@@ -815,101 +845,208 @@ pub fn decref(slot_id: u32) {
                     file.refcount -= 1;
                 } else {
                     *entry = None;
+                    freed = true;
                 }
             }
         }
     }
+    drop(vfs);
+    if freed {
+        crate::fs::file_lock::unlock(slot_id);
+    }
 }
 
 /// Read bytes from an open file into `buf`. `slot_id` is the global open_files index.
 /// Returns the number of bytes read (0 at EOF).
-pub fn read(slot_id: FileDescriptor, buf: &mut [u8]) -> Result<usize, FsError> {
-    let mut vfs = VFS.lock();
-    let state = vfs.as_mut().ok_or(FsError::IoError)?;
+/// Page-cache identity `(mount, inode)` of a file on `fs_id`, or `None` if the
+/// backend is not cached (DevFs, SMB).  exFAT pages are keyed by the first
+/// cluster so the contiguity flag in the inode does not split a file.
+fn cache_id(fs_id: u32, inode: u32) -> Option<(u32, u32)> {
+    match fs_id {
+        0 | 2 | 4 if inode != 0 => Some((fs_id, inode)),
+        3 if inode != 0 => Some((fs_id, crate::fs::exfat::decode_inode(inode).0)),
+        _ => None,
+    }
+}
 
-    // Direct index lookup
-    let file = state.open_files.get_mut(slot_id as usize)
-        .and_then(|e| e.as_mut())
-        .ok_or(FsError::BadFd)?;
+/// Open-file fields a data read needs, copied out under the VFS lock.
+#[derive(Clone, Copy)]
+struct ReadTarget {
+    fs_id: u32,
+    file_type: FileType,
+    inode: u32,
+    size: u32,
+    position: u32,
+}
 
-    // --- DevFs file ---
-    if file.fs_id == 1 {
-        let name = dev_name(&file.path);
-        let devfs = state.devfs.as_ref().ok_or(FsError::IoError)?;
-        return devfs.read(name, buf).ok_or(FsError::IoError);
-    }
+/// Backend pinned for a read that runs without the VFS lock.
+enum ReadBackend {
+    Iso(Arc<Iso9660Fs>),
+    Ntfs(Arc<NtfsFs>),
+    Smb(Arc<Mutex<SmbFs>>),
+    /// exFAT / FAT: sector plans are built under the VFS lock per request.
+    Chain,
+}
 
-    // --- ISO 9660 file ---
-    if file.fs_id == 2 {
-        if file.position >= file.size {
-            return Ok(0);
+/// Read from `t` at its position through the page cache (regular files,
+/// with readahead state `ra`) or straight from `fill`.  Does not advance
+/// the position.
+fn read_cached(
+    t: &ReadTarget,
+    buf: &mut [u8],
+    ra: &mut Readahead,
+    fill: &mut dyn FnMut(u32, &mut [u8]) -> Result<usize, FsError>,
+) -> Result<usize, FsError> {
+    match cache_id(t.fs_id, t.inode) {
+        Some((mount, inode)) if t.file_type == FileType::Regular => {
+            page_cache::read(mount, inode, t.size, t.position, buf, ra, fill)
+        }
+        _ => {
+            let to_read = buf.len().min((t.size - t.position) as usize);
+            fill(t.position, &mut buf[..to_read])
         }
-        let iso = state.iso9660_fs.as_ref().ok_or(FsError::IoError)?;
-        let bytes_read = iso.read_file(file.inode, file.position, buf, file.size)?;
-        file.position += bytes_read as u32;
-        return Ok(bytes_read);
     }
+}
 
-    // --- NTFS file (read-only) ---
-    if file.fs_id == 4 {
-        if file.position >= file.size {
-            return Ok(0);
+/// Read an exFAT/FAT byte range: plan under the VFS lock, I/O after it.
+fn read_chain(t: &ReadTarget, offset: u32, buf: &mut [u8]) -> Result<usize, FsError> {
+    let plan = {
+        let mut vfs = VFS.lock();
+        let state = vfs.as_mut().ok_or(FsError::IoError)?;
+        if t.fs_id == 3 {
+            let exfat = state.exfat_fs.as_mut().ok_or(FsError::IoError)?;
+            exfat.get_range_read_plan(t.inode, offset, buf.len())
+        } else {
+            let fat = state.fat_fs.as_ref().ok_or(FsError::IoError)?;
+            fat.get_range_read_plan(t.inode, offset, buf.len())
         }
-        let remaining = (file.size - file.position) as usize;
-        let to_read = buf.len().min(remaining);
-        let ntfs = state.ntfs_fs.as_ref().ok_or(FsError::IoError)?;
-        let bytes_read = ntfs.read_file(file.inode, file.position, &mut buf[..to_read])?;
-        file.position += bytes_read as u32;
-        return Ok(bytes_read);
-    }
+    };
+    plan.execute_into(buf)
+}
 
-    // --- SMB file (network) ---
-    if file.fs_id == 5 {
-        if file.position >= file.size {
-            return Ok(0);
+/// Drop cached pages of the exFAT/FAT file at `path` before its clusters
+/// are freed (truncate, delete).
+fn invalidate_entry(state: &VfsState, path: &str) {
+    if let Some(ref exfat) = state.exfat_fs {
+        if let Ok(r) = resolve_exfat_path(exfat, path, false) {
+            if let Some((mount, inode)) = cache_id(3, r.inode) {
+                page_cache::invalidate_inode(mount, inode);
+            }
+        }
+    } else if let Some(ref fat) = state.fat_fs {
+        if let Ok((cluster, _, _)) = fat.lookup(path) {
+            if let Some((mount, inode)) = cache_id(0, cluster) {
+                page_cache::invalidate_inode(mount, inode);
+            }
         }
-        let remaining = (file.size - file.position) as usize;
-        let to_read = buf.len().min(remaining);
-        let file_inode = file.inode;
-        let file_position = file.position;
-        let file_path = file.path.clone();
-        let smb = state.smbfs.iter_mut()
-            .find(|(p, _)| file_path.starts_with(p.as_str()))
-            .map(|(_, s)| s)
-            .ok_or(FsError::IoError)?;
-        let bytes_read = smb.read_file(file_inode, file_position, &mut buf[..to_read])?;
-        // Re-borrow file after mutable smb use
-        let file = state.open_files.get_mut(slot_id as usize)
-            .and_then(|e| e.as_mut())
-            .ok_or(FsError::BadFd)?;
-        file.position += bytes_read as u32;
-        return Ok(bytes_read);
     }
+}
 
-    // --- exFAT / FAT file ---
-    if file.position >= file.size {
-        return Ok(0); // EOF
-    }
+pub fn read(slot_id: FileDescriptor, buf: &mut [u8]) -> Result<usize, FsError> {
+    read_impl(slot_id, None, buf)
+}
 
-    let remaining = (file.size - file.position) as usize;
-    let to_read = buf.len().min(remaining);
+/// Read from an open file at byte `offset` without moving its position
+/// (pread; used by file-backed mappings).  Returns 0 at or past EOF.
+pub fn read_at(slot_id: FileDescriptor, offset: u32, buf: &mut [u8]) -> Result<usize, FsError> {
+    read_impl(slot_id, Some(offset), buf)
+}
 
-    let bytes_read = if file.fs_id == 3 {
-        let exfat = state.exfat_fs.as_ref().ok_or(FsError::IoError)?;
-        exfat.read_file(file.inode, file.position, &mut buf[..to_read])?
-    } else if let Some(ref fat) = state.fat_fs {
-        fat.read_file(file.inode, file.position, &mut buf[..to_read])?
-    } else {
-        return Err(FsError::IoError);
+/// Shared body of [`read`] and [`read_at`]: `at` overrides the position.
+fn read_impl(slot_id: FileDescriptor, at: Option<u32>, buf: &mut [u8]) -> Result<usize, FsError> {
+    // Phase 1: Under VFS lock — snapshot the file and pin its backend
+    let (t, backend, mut ra) = {
+        let vfs = VFS.lock();
+        let state = vfs.as_ref().ok_or(FsError::IoError)?;
+
+        // Direct index lookup
+        let file = state.open_files.get(slot_id as usize)
+            .and_then(|e| e.as_ref())
+            .ok_or(FsError::BadFd)?;
+
+        // --- DevFs file (in-memory, stays under the lock) ---
+        if file.fs_id == 1 {
+            let name = dev_name(&file.path);
+            let devfs = state.devfs.as_ref().ok_or(FsError::IoError)?;
+            return devfs.read(name, buf).ok_or(FsError::IoError);
+        }
+
+        let position = at.unwrap_or(file.position);
+        if position >= file.size {
+            return Ok(0); // EOF
+        }
+
+        let backend = match file.fs_id {
+            2 => ReadBackend::Iso(state.iso9660_fs.clone().ok_or(FsError::IoError)?),
+            4 => ReadBackend::Ntfs(state.ntfs_fs.clone().ok_or(FsError::IoError)?),
+            5 => ReadBackend::Smb(
+                state.smbfs.iter()
+                    .find(|(p, _)| file.path.starts_with(p.as_str()))
+                    .map(|(_, s)| s.clone())
+                    .ok_or(FsError::IoError)?,
+            ),
+            3 if state.exfat_fs.is_some() => ReadBackend::Chain,
+            0 if state.fat_fs.is_some() => ReadBackend::Chain,
+            _ => return Err(FsError::IoError),
+        };
+        let t = ReadTarget {
+            fs_id: file.fs_id,
+            file_type: file.file_type,
+            inode: file.inode,
+            size: file.size,
+            position,
+        };
+        (t, backend, file.readahead)
+    }; // VFS lock dropped
+
+    // Phase 2: Without lock — data I/O (other files stay accessible)
+    let bytes_read = match backend {
+        ReadBackend::Iso(iso) => {
+            read_cached(&t, buf, &mut ra, &mut |off, dst| iso.read_file(t.inode, off, dst, t.size))?
+        }
+        ReadBackend::Ntfs(ntfs) => {
+            read_cached(&t, buf, &mut ra, &mut |off, dst| ntfs.read_file(t.inode, off, dst))?
+        }
+        ReadBackend::Smb(smb) => {
+            let to_read = buf.len().min((t.size - t.position) as usize);
+            smb.lock().read_file(t.inode, t.position, &mut buf[..to_read])?
+        }
+        ReadBackend::Chain => {
+            read_cached(&t, buf, &mut ra, &mut |off, dst| read_chain(&t, off, dst))?
+        }
     };
 
-    file.position += bytes_read as u32;
+    // Phase 3: Advance the position and keep the readahead state, unless
+    // the slot now holds another file
+    let mut vfs = VFS.lock();
+    if let Some(file) = vfs.as_mut()
+        .and_then(|state| state.open_files.get_mut(slot_id as usize))
+        .and_then(|e| e.as_mut())
+    {
+        if file.fs_id == t.fs_id && file.inode == t.inode {
+            if at.is_none() {
+                file.position = t.position + bytes_read as u32;
+            }
+            file.readahead = ra;
+        }
+    }
     Ok(bytes_read)
 }
 
 /// Write bytes from `buf` to an open file. `slot_id` is the global open_files index.
 /// Returns the number of bytes written.
 pub fn write(slot_id: FileDescriptor, buf: &[u8]) -> Result<usize, FsError> {
+    write_impl(slot_id, None, buf)
+}
+
+/// Write to an open file at byte `offset` without moving its position
+/// (pwrite; used to write back shared file mappings).
+pub fn write_at(slot_id: FileDescriptor, offset: u32, buf: &[u8]) -> Result<usize, FsError> {
+    write_impl(slot_id, Some(offset), buf)
+}
+
+/// Shared body of [`write`] and [`write_at`]: `at` overrides the position.
+fn write_impl(slot_id: FileDescriptor, at: Option<u32>, buf: &[u8]) -> Result<usize, FsError> {
     let mut vfs = VFS.lock();
     let state = vfs.as_mut().ok_or(FsError::IoError)?;
 
@@ -934,23 +1071,30 @@ pub fn write(slot_id: FileDescriptor, buf: &[u8]) -> Result<usize, FsError> {
         return Err(FsError::PermissionDenied);
     }
 
-    // --- SMB file (network) ---
+    // --- SMB file (network): round trip under the share lock only ---
     if file.fs_id == 5 {
         let file_inode = file.inode;
-        let file_position = file.position;
-        let file_path = file.path.clone();
-        let smb = state.smbfs.iter_mut()
-            .find(|(p, _)| file_path.starts_with(p.as_str()))
-            .map(|(_, s)| s)
+        let file_position = at.unwrap_or(file.position);
+        let smb = state.smbfs.iter()
+            .find(|(p, _)| file.path.starts_with(p.as_str()))
+            .map(|(_, s)| s.clone())
             .ok_or(FsError::IoError)?;
-        let bytes_written = smb.write_file(file_inode, file_position, buf)?;
-        // Re-borrow file after mutable smb use
-        let file = state.open_files.get_mut(slot_id as usize)
+        drop(vfs);
+        let bytes_written = smb.lock().write_file(file_inode, file_position, buf)?;
+        let mut vfs = VFS.lock();
+        if let Some(file) = vfs.as_mut()
+            .and_then(|state| state.open_files.get_mut(slot_id as usize))
             .and_then(|e| e.as_mut())
-            .ok_or(FsError::BadFd)?;
-        file.position += bytes_written as u32;
-        if file.position > file.size {
-            file.size = file.position;
+        {
+            if file.fs_id == 5 && file.inode == file_inode {
+                let end = file_position + bytes_written as u32;
+                if at.is_none() {
+                    file.position = end;
+                }
+                if end > file.size {
+                    file.size = end;
+                }
+            }
         }
         return Ok(bytes_written);
     }
@@ -958,7 +1102,7 @@ pub fn write(slot_id: FileDescriptor, buf: &[u8]) -> Result<usize, FsError> {
     // --- exFAT / FAT file ---
     let old_inode = file.inode;
     let old_size = file.size;
-    let position = file.position;
+    let position = at.unwrap_or(file.position);
     let parent_cluster = file.parent_cluster;
     let fs_id = file.fs_id;
 
@@ -966,6 +1110,11 @@ pub fn write(slot_id: FileDescriptor, buf: &[u8]) -> Result<usize, FsError> {
     let path_clone = file.path.clone();
     let filename = path_clone.rsplit('/').next().unwrap_or("");
 
+    // Write-through: cached pages of the file are stale from here on.
+    if let Some((mount, inode)) = cache_id(fs_id, old_inode) {
+        page_cache::invalidate_inode(mount, inode);
+    }
+
     if fs_id == 3 {
         let exfat = state.exfat_fs.as_mut().ok_or(FsError::IoError)?;
         let (new_cluster, new_size) = exfat.write_file(old_inode, position, buf, old_size)?;
@@ -977,7 +1126,14 @@ pub fn write(slot_id: FileDescriptor, buf: &[u8]) -> Result<usize, FsError> {
             .ok_or(FsError::BadFd)?;
         file.inode = new_cluster;
         file.size = new_size;
-        file.position = position + buf.len() as u32;
+        if at.is_none() {
+            file.position = position + buf.len() as u32;
+        }
+        if new_cluster != old_inode {
+            if let Some((mount, inode)) = cache_id(3, new_cluster) {
+                page_cache::invalidate_inode(mount, inode);
+            }
+        }
     } else {
         let fat = state.fat_fs.as_mut().ok_or(FsError::IoError)?;
         let (new_cluster, new_size) = fat.write_file(old_inode, position, buf, old_size)?;
@@ -989,7 +1145,14 @@ pub fn write(slot_id: FileDescriptor, buf: &[u8]) -> Result<usize, FsError> {
             .ok_or(FsError::BadFd)?;
         file.inode = new_cluster;
         file.size = new_size;
-        file.position = position + buf.len() as u32;
+        if at.is_none() {
+            file.position = position + buf.len() as u32;
+        }
+        if new_cluster != old_inode {
+            if let Some((mount, inode)) = cache_id(0, new_cluster) {
+                page_cache::invalidate_inode(mount, inode);
+            }
+        }
     }
 
     Ok(buf.len())
@@ -1019,7 +1182,7 @@ pub fn read_dir(path: &str) -> Result<Vec<DirEntry>, FsError> {
                         file_type: FileType::Directory,
                         size: 0,
                         is_symlink: false,
-                        uid: 0, gid: 0, mode: 0xFFF,
+                        uid: 0, gid: 0, mode: 0xFFF, mtime: 0,
                     });
                 }
             }
@@ -1052,9 +1215,9 @@ pub fn read_dir(path: &str) -> Result<Vec<DirEntry>, FsError> {
             }
             FsType::Smb => {
                 let mount_path_owned = String::from(mount_path);
-                let smb = state.smbfs.iter_mut()
+                let mut smb = state.smbfs.iter()
                     .find(|(p, _)| *p == mount_path_owned)
-                    .map(|(_, s)| s)
+                    .map(|(_, s)| s.lock())
                     .ok_or(FsError::IoError)?;
                 let (inode, file_type, _size) = smb.lookup(relative_path)?;
                 if file_type != FileType::Directory {
@@ -1087,12 +1250,16 @@ pub fn read_dir(path: &str) -> Result<Vec<DirEntry>, FsError> {
         };
         for entry in entries.iter_mut() {
             if entry.is_symlink {
-                // Try to resolve target to get the real file type
+                // Resolve the target so type and attributes match stat()
                 let mut entry_path = dir_path.clone();
                 entry_path.push_str(&entry.name);
                 if let Ok(resolved) = resolve_exfat_path(exfat, &entry_path, true) {
                     entry.file_type = resolved.file_type;
                     entry.size = resolved.size;
+                    entry.uid = resolved.uid;
+                    entry.gid = resolved.gid;
+                    entry.mode = resolved.mode;
+                    entry.mtime = resolved.mtime;
                 }
                 // If resolution fails (broken symlink), keep original type
             }
@@ -1154,7 +1321,7 @@ fn add_virtual_root_entries(state: &VfsState, entries: &mut Vec<DirEntry>) {
             file_type: FileType::Directory,
             size: 0,
             is_symlink: false,
-            uid: 0, gid: 0, mode: 0xFFF,
+            uid: 0, gid: 0, mode: 0xFFF, mtime: 0,
         });
     }
     if state.mount_points.iter().any(|mp| mp.path.starts_with("/mnt/")) {
@@ -1163,7 +1330,7 @@ fn add_virtual_root_entries(state: &VfsState, entries: &mut Vec<DirEntry>) {
             file_type: FileType::Directory,
             size: 0,
             is_symlink: false,
-            uid: 0, gid: 0, mode: 0xFFF,
+            uid: 0, gid: 0, mode: 0xFFF, mtime: 0,
         });
     }
 }
@@ -1200,17 +1367,21 @@ pub fn read_file_to_vec(path: &str) -> Result<Vec<u8>, FsError> {
         if let Some((mount_path, relative_path, mnt_fs_type)) = find_mnt_mount(path, &state.mount_points) {
             match mnt_fs_type {
                 FsType::Iso9660 => {
-                    if let Some(ref iso) = state.iso9660_fs {
+                    if let Some(iso) = state.iso9660_fs.clone() {
+                        drop(vfs);
                         return iso.read_file_to_vec(relative_path);
                     }
                     return Err(FsError::NotFound);
                 }
                 FsType::Smb => {
                     let mount_path_owned = String::from(mount_path);
-                    let smb = state.smbfs.iter_mut()
+                    let smb = state.smbfs.iter()
                         .find(|(p, _)| *p == mount_path_owned)
-                        .map(|(_, s)| s)
+                        .map(|(_, s)| s.clone())
                         .ok_or(FsError::IoError)?;
+                    // Network round trips under the share lock only
+                    drop(vfs);
+                    let mut smb = smb.lock();
                     let (inode, file_type, size) = smb.lookup(relative_path)?;
                     if file_type == FileType::Directory {
                         return Err(FsError::IsADirectory);
@@ -1227,35 +1398,44 @@ pub fn read_file_to_vec(path: &str) -> Result<Vec<u8>, FsError> {
 
     // Phase 1: Under VFS lock — lookup + build read plan (no disk I/O)
     crate::debug_println!("  [VFS] read_file_to_vec: phase1 lookup '{}'", path);
-    let plan = {
-        let vfs = VFS.lock();
-        let state = vfs.as_ref().ok_or(FsError::IoError)?;
-        if let Some(ref exfat) = state.exfat_fs {
+    let (plan, cached, gen) = {
+        let mut vfs = VFS.lock();
+        let gen = page_cache::generation();
+        let state = vfs.as_mut().ok_or(FsError::IoError)?;
+        if let Some(ref mut exfat) = state.exfat_fs {
             let r = resolve_exfat_path(exfat, path, true)?;
             if r.file_type == FileType::Directory {
                 return Err(FsError::IsADirectory);
             }
             crate::debug_println!("  [VFS] read_file_to_vec: inode={:#x} size={} building read plan", r.inode, r.size);
-            ReadPlan::ExFat(exfat.get_file_read_plan(r.inode, r.size))
+            (ReadPlan::ExFat(exfat.get_file_read_plan(r.inode, r.size)), cache_id(3, r.inode).map(|c| (c, r.size)), gen)
         } else if let Some(ref ntfs) = state.ntfs_fs {
             let (mft_rec, file_type, size) = ntfs.lookup(path)?;
             if file_type == FileType::Directory {
                 return Err(FsError::IsADirectory);
             }
-            ReadPlan::Ntfs(ntfs.get_file_read_plan(mft_rec, size))
+            (ReadPlan::Ntfs(ntfs.get_file_read_plan(mft_rec, size)), cache_id(4, mft_rec).map(|c| (c, size)), gen)
         } else if let Some(ref fat) = state.fat_fs {
             let (cluster, file_type, size) = fat.lookup(path)?;
             if file_type == FileType::Directory {
                 return Err(FsError::IsADirectory);
             }
-            ReadPlan::Fat(fat.get_file_read_plan(cluster, size))
-        } else if let Some(ref iso) = state.iso9660_fs {
+            (ReadPlan::Fat(fat.get_file_read_plan(cluster, size)), cache_id(0, cluster).map(|c| (c, size)), gen)
+        } else if let Some(iso) = state.iso9660_fs.clone() {
+            drop(vfs);
             return iso.read_file_to_vec(path);
         } else {
             return Err(FsError::NotFound);
         }
     }; // VFS lock dropped — interrupts re-enabled
 
+    // Whole file already in the page cache: no disk I/O at all
+    if let Some(((mount, inode), size)) = cached {
+        if let Some(data) = page_cache::read_whole(mount, inode, size) {
+            return Ok(data);
+        }
+    }
+
     // Phase 2: Without lock — perform disk I/O with interrupts enabled
     crate::debug_println!("  [VFS] read_file_to_vec: phase2 disk I/O '{}'", path);
     let result = match plan {
@@ -1263,6 +1443,11 @@ pub fn read_file_to_vec(path: &str) -> Result<Vec<u8>, FsError> {
         ReadPlan::ExFat(p) => p.execute(),
         ReadPlan::Ntfs(p) => p.execute(),
     };
+    if let (Ok(data), Some(((mount, inode), size))) = (&result, cached) {
+        if data.len() == size as usize {
+            page_cache::insert_file(mount, inode, data, gen);
+        }
+    }
     crate::debug_println!("  [VFS] read_file_to_vec: done '{}' ok={}", path, result.is_ok());
     result
 }
@@ -1286,9 +1471,9 @@ pub fn delete(path: &str) -> Result<(), FsError> {
                     None => ("/", rel),
                 }
             };
-            let smb = state.smbfs.iter_mut()
+            let mut smb = state.smbfs.iter()
                 .find(|(p, _)| *p == mount_path_owned)
-                .map(|(_, s)| s)
+                .map(|(_, s)| s.lock())
                 .ok_or(FsError::IoError)?;
             let (parent_inode, _, _) = smb.lookup(rel_parent_name.0)?;
             return smb.delete_entry(parent_inode, rel_parent_name.1);
@@ -1297,6 +1482,7 @@ pub fn delete(path: &str) -> Result<(), FsError> {
     }
 
     let (parent_path, filename) = split_parent_name(path)?;
+    invalidate_entry(state, path);
     if let Some(ref mut exfat) = state.exfat_fs {
         // Resolve parent with symlink following, but the filename itself is not followed
         let pr = resolve_exfat_path(exfat, parent_path, true)?;
@@ -1469,9 +1655,9 @@ fn stat_inner(path: &str, follow_last: bool) -> Result<StatResult, FsError> {
             }
             FsType::Smb => {
                 let mount_path_owned = String::from(mount_path);
-                let smb = state.smbfs.iter_mut()
+                let mut smb = state.smbfs.iter()
                     .find(|(p, _)| *p == mount_path_owned)
-                    .map(|(_, s)| s)
+                    .map(|(_, s)| s.lock())
                     .ok_or(FsError::IoError)?;
                 let (_inode, file_type, size) = smb.lookup(relative_path)?;
                 return Ok(default_stat(file_type, size, false));
@@ -1540,6 +1726,50 @@ pub fn fstat(slot_id: FileDescriptor) -> Result<(FileType, u32, u32, u32), FsErr
     Ok((ft, sz, pos, mtime))
 }
 
+/// Size and write permission of an open regular file, for `mmap`.
+/// Directories and device files cannot be mapped.
+pub fn map_info(slot_id: FileDescriptor) -> Result<(u32, bool), FsError> {
+    let vfs = VFS.lock();
+    let state = vfs.as_ref().ok_or(FsError::IoError)?;
+    let file = state.open_files.get(slot_id as usize)
+        .and_then(|e| e.as_ref())
+        .ok_or(FsError::BadFd)?;
+    if file.file_type != FileType::Regular || file.fs_id == 1 {
+        return Err(FsError::PermissionDenied);
+    }
+    Ok((file.size, file.flags.write))
+}
+
+/// Page-cache identity `(mount, inode)` and size of an open regular file.
+/// `None` for uncached backends, whose contents can change unseen.
+pub fn file_identity(slot_id: FileDescriptor) -> Option<(u32, u32, u32)> {
+    let vfs = VFS.lock();
+    let file = vfs.as_ref()?.open_files.get(slot_id as usize)?.as_ref()?;
+    if file.file_type != FileType::Regular {
+        return None;
+    }
+    let (mount, inode) = cache_id(file.fs_id, file.inode)?;
+    Some((mount, inode, file.size))
+}
+
+/// Identity of an open regular file for [`file_lock`](crate::fs::file_lock):
+/// its page-cache identity, or its path on uncached backends.
+pub fn lock_key(slot_id: FileDescriptor) -> Result<crate::fs::file_lock::FileKey, FsError> {
+    use crate::fs::file_lock::FileKey;
+    let vfs = VFS.lock();
+    let state = vfs.as_ref().ok_or(FsError::IoError)?;
+    let file = state.open_files.get(slot_id as usize)
+        .and_then(|e| e.as_ref())
+        .ok_or(FsError::BadFd)?;
+    if file.file_type != FileType::Regular {
+        return Err(FsError::IsADirectory);
+    }
+    Ok(match cache_id(file.fs_id, file.inode) {
+        Some((mount, inode)) => FileKey::Cached(mount, inode),
+        None => FileKey::Path(file.path.clone()),
+    })
+}
+
 /// Get the path associated with an open file descriptor.
 pub fn get_fd_path(slot_id: FileDescriptor) -> Result<alloc::string::String, FsError> {
     let vfs = VFS.lock();
@@ -1557,6 +1787,7 @@ pub fn truncate(path: &str) -> Result<(), FsError> {
     let state = vfs.as_mut().ok_or(FsError::IoError)?;
 
     let (parent_path, filename) = split_parent_name(path)?;
+    invalidate_entry(state, path);
     if let Some(ref mut exfat) = state.exfat_fs {
         let pr = resolve_exfat_path(exfat, parent_path, true)?;
         let (pc, _) = crate::fs::exfat::decode_inode(pr.inode);
@@ -1567,6 +1798,60 @@ pub fn truncate(path: &str) -> Result<(), FsError> {
     fat.truncate_file(parent_cluster, filename)
 }
 
+/// Write every buffered FAT/exFAT change to disk (`sync`, shutdown).
+pub fn sync_all() -> Result<(), FsError> {
+    let mut vfs = VFS.lock();
+    let state = vfs.as_mut().ok_or(FsError::IoError)?;
+    let mut result = Ok(());
+    if let Some(ref mut exfat) = state.exfat_fs {
+        result = result.and(exfat.sync());
+    }
+    if let Some(ref mut fat) = state.fat_fs {
+        result = result.and(fat.sync());
+    }
+    result
+}
+
+/// Flush the filesystem holding the open file `slot_id` to disk.  The whole
+/// mount is synced: a file's FAT and bitmap sectors are shared with others.
+pub fn fsync(slot_id: FileDescriptor) -> Result<(), FsError> {
+    let mut vfs = VFS.lock();
+    let state = vfs.as_mut().ok_or(FsError::IoError)?;
+    let fs_id = state.open_files.get(slot_id as usize)
+        .and_then(|e| e.as_ref())
+        .ok_or(FsError::BadFd)?
+        .fs_id;
+    match fs_id {
+        3 => state.exfat_fs.as_mut().ok_or(FsError::IoError)?.sync(),
+        0 => state.fat_fs.as_mut().ok_or(FsError::IoError)?.sync(),
+        _ => Ok(()),
+    }
+}
+
+/// Sync mounts whose oldest buffered change has expired (flusher thread).
+pub fn writeback_expired() {
+    let now = crate::fs::writeback::now_ms();
+    let mut vfs = VFS.lock();
+    let state = match vfs.as_mut() {
+        Some(s) => s,
+        None => return,
+    };
+    if let Some(ref mut exfat) = state.exfat_fs {
+        if exfat.writeback_due(now) {
+            if let Err(e) = exfat.sync() {
+                crate::serial_println!("  exFAT: write-back failed: {:?}", e);
+            }
+        }
+    }
+    if let Some(ref mut fat) = state.fat_fs {
+        if fat.writeback_due(now) {
+            if let Err(e) = fat.sync() {
+                crate::serial_println!("  FAT: write-back failed: {:?}", e);
+            }
+        }
+    }
+}
+
 /// Mount a filesystem at the given path from userspace (syscall handler).
 ///
 /// `mount_path`: where to mount (e.g. "/mnt/cdrom0")
@@ -1597,7 +1882,9 @@ pub fn mount_fs(mount_path: &str, device: &str, fs_type_id: u32) -> Result<(), F
             } else {
                 match Iso9660Fs::new() {
                     Ok(iso) => {
-                        state.iso9660_fs = Some(iso);
+                        // New medium: extents of the previous disc are stale.
+                        page_cache::invalidate_mount(2);
+                        state.iso9660_fs = Some(Arc::new(iso));
                     }
                     Err(e) => return Err(e),
                 }
@@ -1617,7 +1904,8 @@ pub fn mount_fs(mount_path: &str, device: &str, fs_type_id: u32) -> Result<(), F
             } else {
                 match NtfsFs::new(0, root_partition_lba()) {
                     Ok(ntfs) => {
-                        state.ntfs_fs = Some(ntfs);
+                        page_cache::invalidate_mount(4);
+                        state.ntfs_fs = Some(Arc::new(ntfs));
                     }
                     Err(e) => return Err(e),
                 }
@@ -1651,7 +1939,7 @@ pub fn mount_fs(mount_path: &str, device: &str, fs_type_id: u32) -> Result<(), F
                 fs_type: FsType::Smb,
                 device_id: 0,
             });
-            state.smbfs.push((String::from(mount_path), smb));
+            state.smbfs.push((String::from(mount_path), Arc::new(Mutex::new(smb))));
             crate::serial_println!("  Mounted SMB at '{}'", mount_path);
             Ok(())
         }
@@ -1679,6 +1967,7 @@ pub fn umount_fs(mount_path: &str) -> Result<(), FsError> {
             let has_other_iso = state.mount_points.iter().any(|m| m.fs_type == FsType::Iso9660);
             if !has_other_iso {
                 state.iso9660_fs = None;
+                page_cache::invalidate_mount(2);
             }
         }
 
@@ -1688,7 +1977,7 @@ pub fn umount_fs(mount_path: &str) -> Result<(), FsError> {
                 let (_, smb) = state.smbfs.remove(idx);
                 // Drop VFS lock before TCP close (which may do network I/O)
                 drop(vfs);
-                smb.disconnect();
+                smb.lock().disconnect();
                 // Re-log after disconnect
                 crate::serial_println!("  Unmounted SMB '{}'", mount_path);
                 return Ok(());
@@ -0,0 +1,146 @@
+//! Write-back bookkeeping shared by the FAT and exFAT drivers, and the
+//! flusher kernel thread.
+//!
+//! Writes land in memory: FAT/bitmap updates mark their cached sector dirty
+//! ([`DirtySectors`]) and file/directory data is kept per cluster
+//! ([`DirtyClusters`]).  Everything is written out in sorted, merged runs by
+//! the driver's `sync`, which runs when
+//! - data has been dirty for longer than [`EXPIRE_MS`] (flusher thread),
+//! - a driver holds more than [`DIRTY_LIMIT`] bytes of dirty clusters,
+//! - a read has to go to disk (read plans execute without the VFS lock),
+//! - `fsync`, `sync_all` or shutdown ask for it.
+
+use alloc::collections::{BTreeMap, BTreeSet};
+use alloc::vec::Vec;
+use crate::task::scheduler;
+
+/// Maximum age of dirty data before the flusher writes it out.
+pub const EXPIRE_MS: u32 = 2000;
+/// Dirty cluster bytes a mount may hold before writes flush synchronously.
+pub const DIRTY_LIMIT: usize = 8 * 1024 * 1024;
+/// Largest single write issued when merging adjacent dirty clusters.
+pub const MAX_RUN_BYTES: usize = 128 * 1024;
+/// Flusher wake-up interval.
+const FLUSH_INTERVAL_MS: u32 = 500;
+
+/// Milliseconds since boot (the system timer runs at ~1000 Hz).
+#[inline]
+pub fn now_ms() -> u32 {
+    let hz = crate::arch::hal::timer_frequency_hz() as u32;
+    let ticks = crate::arch::hal::timer_current_ticks();
+    if hz == 1000 { ticks } else { (ticks as u64 * 1000 / hz.max(1) as u64) as u32 }
+}
+
+/// Set of dirty 512-byte sectors of an in-memory metadata copy (FAT table,
+/// allocation bitmap), indexed relative to its start.
+pub struct DirtySectors {
+    set: BTreeSet<u32>,
+}
+
+impl DirtySectors {
+    pub const fn new() -> Self {
+        DirtySectors { set: BTreeSet::new() }
+    }
+
+    #[inline]
+    pub fn mark(&mut self, sector: u32) {
+        self.set.insert(sector);
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.set.is_empty()
+    }
+
+    /// Remove every dirty sector and return them as `(first, count)` runs
+    /// of consecutive sectors.
+    pub fn take_runs(&mut self) -> Vec<(u32, u32)> {
+        let mut runs: Vec<(u32, u32)> = Vec::new();
+        for s in core::mem::take(&mut self.set) {
+            match runs.last_mut() {
+                Some((first, count)) if *first + *count == s => *count += 1,
+                _ => runs.push((s, 1)),
+            }
+        }
+        runs
+    }
+}
+
+/// Dirty cluster contents, keyed by cluster number.
+pub struct DirtyClusters {
+    map: BTreeMap<u32, Vec<u8>>,
+    bytes: usize,
+}
+
+impl DirtyClusters {
+    pub const fn new() -> Self {
+        DirtyClusters { map: BTreeMap::new(), bytes: 0 }
+    }
+
+    /// Copy the buffered contents of `cluster` into `buf`, if dirty.
+    pub fn get(&self, cluster: u32, buf: &mut [u8]) -> bool {
+        match self.map.get(&cluster) {
+            Some(data) => {
+                let n = data.len().min(buf.len());
+                buf[..n].copy_from_slice(&data[..n]);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Buffer the full contents of `cluster`.
+    pub fn put(&mut self, cluster: u32, data: Vec<u8>) {
+        self.bytes += data.len();
+        if let Some(old) = self.map.insert(cluster, data) {
+            self.bytes -= old.len();
+        }
+    }
+
+    /// Drop the buffered contents of a freed cluster.
+    pub fn remove(&mut self, cluster: u32) {
+        if let Some(old) = self.map.remove(&cluster) {
+            self.bytes -= old.len();
+        }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.map.is_empty()
+    }
+
+    /// Bytes currently buffered.
+    #[inline]
+    pub fn bytes(&self) -> usize {
+        self.bytes
+    }
+
+    /// Remove every dirty cluster and return them as `(first_cluster, data)`
+    /// runs of consecutive clusters, each at most [`MAX_RUN_BYTES`].
+    pub fn take_runs(&mut self) -> Vec<(u32, Vec<u8>)> {
+        self.bytes = 0;
+        let mut runs: Vec<(u32, Vec<u8>)> = Vec::new();
+        let mut next = 0u32;
+        for (cluster, data) in core::mem::take(&mut self.map) {
+            match runs.last_mut() {
+                Some((_, buf)) if cluster == next && buf.len() + data.len() <= MAX_RUN_BYTES => {
+                    buf.extend_from_slice(&data);
+                }
+                _ => runs.push((cluster, data)),
+            }
+            next = cluster + 1;
+        }
+        runs
+    }
+}
+
+/// Entry point for the fs_flush kernel thread: periodically writes back
+/// mounts whose oldest dirty data has expired.
+pub extern "C" fn flusher_thread() {
+    loop {
+        let sleep_ticks = crate::arch::hal::timer_frequency_hz() as u32 * FLUSH_INTERVAL_MS / 1000;
+        let wake_at = crate::arch::hal::timer_current_ticks().wrapping_add(sleep_ticks);
+        scheduler::sleep_until(wake_at);
+        crate::fs::vfs::writeback_expired();
+    }
+}
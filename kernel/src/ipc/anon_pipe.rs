@@ -1,84 +1,203 @@
 //! Anonymous (POSIX) pipes for inter-process communication.
 //!
-//! Each pipe has a 4 KiB circular buffer, separate read/write reference counts,
-//! and a list of blocked reader/writer TIDs for blocking I/O.
+//! Each pipe buffers its data in a queue of page-sized segments that are
+//! allocated as data arrives and freed as it is read, with separate
+//! read/write reference counts and lists of blocked reader/writer TIDs.
+//! Data, space and close changes are also reported to wait sets via
+//! `poll_set::notify`.
+//!
+//! Capacity starts at [`PIPE_DEFAULT_SIZE`] and doubles, up to
+//! [`PIPE_AUTO_MAX`], whenever a writer finds the pipe full;
+//! `F_SETPIPE_SZ` ([`set_capacity`]) sets it anywhere up to
+//! [`PIPE_MAX_SIZE`].  [`splice_in`] and [`splice_out`] move whole segments
+//! between a pipe and a kernel-side source or sink (file, socket), so data
+//! never round-trips through user space.
 //!
 //! **SMP safety:**
-//! - All operations go through the `PIPES` Spinlock.
-//! - Blocking uses `save_complete = 0` before `Blocked` (per save_complete race fix).
-//! - Never hold the lock during `serial_println!` or `schedule()`.
-
-use alloc::collections::VecDeque;
-use crate::sync::spinlock::Spinlock;
+//! - `PIPES` maps ids to pipes and is held only to look up, insert or
+//!   remove one; each pipe's state has its own spinlock.
+//! - A thread blocks by publishing its TID and calling
+//!   `prepare_block_current` under the pipe lock, then drops the lock and
+//!   calls `schedule()`, so a wake-up cannot be lost in between.
+//! - Never hold a pipe lock during `serial_println!`, VFS/socket I/O or
+//!   `schedule()`; wakes are issued after the lock is dropped.
+
+use alloc::collections::{BTreeMap, VecDeque};
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use crate::sync::spinlock::{Spinlock, SpinlockGuard};
 use core::sync::atomic::{AtomicU32, Ordering};
 
 /// Maximum number of concurrent anonymous pipes system-wide.
-const MAX_PIPES: usize = 64;
+const MAX_PIPES: usize = 1024;
 
-/// Pipe buffer capacity in bytes.
+/// POSIX `PIPE_BUF`; a pipe never holds less than this.
 pub const PIPE_BUF_SIZE: usize = 4096;
 
-/// Maximum blocked TIDs per side (readers or writers).
-const MAX_BLOCKED: usize = 8;
+/// Capacity of a new pipe.
+pub const PIPE_DEFAULT_SIZE: usize = 16384;
+
+/// Automatic growth stops here; larger pipes need `F_SETPIPE_SZ`.
+const PIPE_AUTO_MAX: usize = 262144;
+
+/// Largest capacity `F_SETPIPE_SZ` accepts (1 MiB).
+pub const PIPE_MAX_SIZE: usize = 1 << 20;
+
+/// Bytes per buffer segment.
+const SEG_SIZE: usize = 4096;
 
 static NEXT_PIPE_ID: AtomicU32 = AtomicU32::new(1);
 
-/// A single anonymous pipe.
-struct AnonPipe {
-    id: u32,
-    buffer: VecDeque<u8>,
+/// A run of buffered bytes: `data[start..]` is still unread.
+struct Segment {
+    data: Vec<u8>,
+    start: usize,
+}
+
+impl Segment {
+    fn len(&self) -> usize {
+        self.data.len() - self.start
+    }
+
+    fn bytes(&self) -> &[u8] {
+        &self.data[self.start..]
+    }
+}
+
+/// Mutable state of a pipe, behind the pipe's own lock.
+struct PipeState {
+    segments: VecDeque<Segment>,
+    /// Bytes buffered across all segments.
+    len: usize,
+    /// Current limit on `len`.
+    capacity: usize,
     /// Number of open read-end FDs referencing this pipe.
     read_refs: u32,
     /// Number of open write-end FDs referencing this pipe.
     write_refs: u32,
     /// TIDs blocked waiting to read (pipe was empty).
-    blocked_readers: [u32; MAX_BLOCKED],
-    blocked_reader_count: usize,
+    blocked_readers: Vec<u32>,
     /// TIDs blocked waiting to write (pipe was full).
-    blocked_writers: [u32; MAX_BLOCKED],
-    blocked_writer_count: usize,
+    blocked_writers: Vec<u32>,
+}
+
+impl PipeState {
+    fn space(&self) -> usize {
+        self.capacity.saturating_sub(self.len)
+    }
+
+    /// Free space, growing a full pipe (up to `PIPE_AUTO_MAX`) first.
+    fn space_or_grow(&mut self) -> usize {
+        if self.space() == 0 && self.capacity < PIPE_AUTO_MAX {
+            self.capacity = (self.capacity * 2).min(PIPE_AUTO_MAX);
+        }
+        self.space()
+    }
+
+    /// Append `data`, filling the last segment before starting new ones.
+    fn push(&mut self, mut data: &[u8]) {
+        self.len += data.len();
+        if let Some(last) = self.segments.back_mut() {
+            let room = SEG_SIZE.saturating_sub(last.data.len());
+            let n = room.min(data.len());
+            last.data.extend_from_slice(&data[..n]);
+            data = &data[n..];
+        }
+        for chunk in data.chunks(SEG_SIZE) {
+            let mut seg = Vec::with_capacity(SEG_SIZE);
+            seg.extend_from_slice(chunk);
+            self.segments.push_back(Segment { data: seg, start: 0 });
+        }
+    }
+
+    /// Copy up to `buf.len()` bytes out, freeing drained segments.
+    fn pop(&mut self, buf: &mut [u8]) -> usize {
+        let mut n = 0;
+        while n < buf.len() {
+            let seg = match self.segments.front_mut() {
+                Some(s) => s,
+                None => break,
+            };
+            let take = seg.len().min(buf.len() - n);
+            buf[n..n + take].copy_from_slice(&seg.bytes()[..take]);
+            seg.start += take;
+            n += take;
+            if seg.len() == 0 {
+                self.segments.pop_front();
+            }
+        }
+        self.len -= n;
+        n
+    }
+
+    /// Detach whole segments holding up to `max` bytes (splitting the last
+    /// one if needed).
+    fn take_segments(&mut self, max: usize) -> Vec<Segment> {
+        let mut out = Vec::new();
+        let mut n = 0;
+        while n < max {
+            let seg = match self.segments.pop_front() {
+                Some(s) => s,
+                None => break,
+            };
+            if seg.len() <= max - n {
+                n += seg.len();
+                out.push(seg);
+            } else {
+                let take = max - n;
+                let head = seg.bytes()[..take].to_vec();
+                self.segments.push_front(Segment { start: seg.start + take, ..seg });
+                out.push(Segment { data: head, start: 0 });
+                n += take;
+            }
+        }
+        self.len -= n;
+        out
+    }
 }
 
-/// Fixed-size table of anonymous pipes. No heap allocation for the table itself.
-static PIPES: Spinlock<[Option<AnonPipe>; MAX_PIPES]> = Spinlock::new([const { None }; MAX_PIPES]);
+/// A single anonymous pipe.
+struct AnonPipe {
+    state: Spinlock<PipeState>,
+}
+
+/// All live pipes by id.  Each pipe is locked on its own.
+static PIPES: Spinlock<BTreeMap<u32, Arc<AnonPipe>>> = Spinlock::new(BTreeMap::new());
 
 /// Create a new anonymous pipe. Returns the pipe_id (>0), or 0 on failure (table full).
 pub fn create() -> u32 {
     let id = NEXT_PIPE_ID.fetch_add(1, Ordering::Relaxed);
-    let pipe = AnonPipe {
-        id,
-        buffer: VecDeque::with_capacity(PIPE_BUF_SIZE),
-        read_refs: 1,
-        write_refs: 1,
-        blocked_readers: [0; MAX_BLOCKED],
-        blocked_reader_count: 0,
-        blocked_writers: [0; MAX_BLOCKED],
-        blocked_writer_count: 0,
-    };
-
-    let mut guard = PIPES.lock();
-    for slot in guard.iter_mut() {
-        if slot.is_none() {
-            *slot = Some(pipe);
-            return id;
-        }
+    let pipe = Arc::new(AnonPipe {
+        state: Spinlock::new(PipeState {
+            segments: VecDeque::new(),
+            len: 0,
+            capacity: PIPE_DEFAULT_SIZE,
+            read_refs: 1,
+            write_refs: 1,
+            blocked_readers: Vec::new(),
+            blocked_writers: Vec::new(),
+        }),
+    });
+
+    let mut pipes = PIPES.lock();
+    if pipes.len() >= MAX_PIPES {
+        return 0; // table full
     }
-    0 // table full
+    pipes.insert(id, pipe);
+    id
 }
 
 /// Increment the read-end reference count (for fork/dup).
 pub fn incref_read(pipe_id: u32) {
-    let mut guard = PIPES.lock();
-    if let Some(pipe) = find_pipe(&mut guard, pipe_id) {
-        pipe.read_refs += 1;
+    if let Some(pipe) = find_pipe(pipe_id) {
+        pipe.state.lock().read_refs += 1;
     }
 }
 
 /// Increment the write-end reference count (for fork/dup).
 pub fn incref_write(pipe_id: u32) {
-    let mut guard = PIPES.lock();
-    if let Some(pipe) = find_pipe(&mut guard, pipe_id) {
-        pipe.write_refs += 1;
+    if let Some(pipe) = find_pipe(pipe_id) {
+        pipe.state.lock().write_refs += 1;
     }
 }
 
@@ -86,63 +205,41 @@ pub fn incref_write(pipe_id: u32) {
 /// If read_refs drops to 0, wake all blocked writers (they'll get EPIPE).
 /// If both refs are 0, destroy the pipe.
 pub fn decref_read(pipe_id: u32) {
-    let mut writers_to_wake: [u32; MAX_BLOCKED] = [0; MAX_BLOCKED];
-    let mut wake_count = 0;
-
-    {
-        let mut guard = PIPES.lock();
-        let slot = find_pipe_slot(&mut guard, pipe_id);
-        if let Some(Some(pipe)) = slot {
-            if pipe.read_refs > 0 {
-                pipe.read_refs -= 1;
-            }
-            if pipe.read_refs == 0 {
-                // No more readers — wake blocked writers so they see EPIPE
-                wake_count = pipe.blocked_writer_count;
-                writers_to_wake[..wake_count].copy_from_slice(&pipe.blocked_writers[..wake_count]);
-                pipe.blocked_writer_count = 0;
-            }
-            if pipe.read_refs == 0 && pipe.write_refs == 0 {
-                *slot.unwrap() = None; // SAFETY: slot is Some from the if-let
-            }
-        }
-    }
-
-    // Wake outside the lock
-    for i in 0..wake_count {
-        crate::task::scheduler::wake_thread(writers_to_wake[i]);
-    }
+    decref(pipe_id, true);
 }
 
 /// Decrement the write-end reference count.
 /// If write_refs drops to 0, wake all blocked readers (they'll get EOF = 0 bytes).
 /// If both refs are 0, destroy the pipe.
 pub fn decref_write(pipe_id: u32) {
-    let mut readers_to_wake: [u32; MAX_BLOCKED] = [0; MAX_BLOCKED];
-    let mut wake_count = 0;
-
-    {
-        let mut guard = PIPES.lock();
-        let slot = find_pipe_slot(&mut guard, pipe_id);
-        if let Some(Some(pipe)) = slot {
-            if pipe.write_refs > 0 {
-                pipe.write_refs -= 1;
-            }
-            if pipe.write_refs == 0 {
-                // No more writers — wake blocked readers so they see EOF
-                wake_count = pipe.blocked_reader_count;
-                readers_to_wake[..wake_count].copy_from_slice(&pipe.blocked_readers[..wake_count]);
-                pipe.blocked_reader_count = 0;
-            }
-            if pipe.read_refs == 0 && pipe.write_refs == 0 {
-                *slot.unwrap() = None;
-            }
-        }
-    }
+    decref(pipe_id, false);
+}
 
-    for i in 0..wake_count {
-        crate::task::scheduler::wake_thread(readers_to_wake[i]);
+fn decref(pipe_id: u32, read_end: bool) {
+    let pipe = match find_pipe(pipe_id) {
+        Some(p) => p,
+        None => return,
+    };
+    let (to_wake, dead) = {
+        let mut guard = pipe.state.lock();
+        let st = &mut *guard;
+        let (refs, waiters) = if read_end {
+            (&mut st.read_refs, &mut st.blocked_writers)
+        } else {
+            (&mut st.write_refs, &mut st.blocked_readers)
+        };
+        *refs = refs.saturating_sub(1);
+        // Last reader gone: writers see EPIPE; last writer gone: readers see EOF
+        let to_wake = if *refs == 0 { core::mem::take(waiters) } else { Vec::new() };
+        (to_wake, st.read_refs == 0 && st.write_refs == 0)
+    };
+    if dead {
+        PIPES.lock().remove(&pipe_id);
     }
+
+    // Wake outside the lock
+    wake_all(&to_wake);
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Pipe(pipe_id));
 }
 
 /// Read from a pipe. Blocks if the buffer is empty and writers still exist.
@@ -153,60 +250,28 @@ pub fn read(pipe_id: u32, buf: &mut [u8]) -> u32 {
     if buf.is_empty() {
         return 0;
     }
+    let pipe = match find_pipe(pipe_id) {
+        Some(p) => p,
+        None => return 0, // pipe destroyed
+    };
 
     loop {
-        let readers_to_wake: [u32; MAX_BLOCKED] = [0; MAX_BLOCKED];
-        let r_wake = 0;
-        let mut writers_to_wake: [u32; MAX_BLOCKED] = [0; MAX_BLOCKED];
-        let mut w_wake = 0;
-
-        let result = {
-            let mut guard = PIPES.lock();
-            let pipe = match find_pipe(&mut guard, pipe_id) {
-                Some(p) => p,
-                None => return 0, // pipe destroyed
-            };
-
-            if !pipe.buffer.is_empty() {
-                // Data available — drain up to buf.len()
-                let n = buf.len().min(pipe.buffer.len());
-                for i in 0..n {
-                    buf[i] = pipe.buffer.pop_front().unwrap();
-                }
-                // Wake any blocked writers since we freed buffer space
-                w_wake = pipe.blocked_writer_count;
-                writers_to_wake[..w_wake].copy_from_slice(&pipe.blocked_writers[..w_wake]);
-                pipe.blocked_writer_count = 0;
-                Ok(n as u32)
-            } else if pipe.write_refs == 0 {
-                // EOF — no writers left
-                Ok(0)
-            } else {
-                // Buffer empty, writers exist — need to block
-                let tid = crate::task::scheduler::current_tid();
-                if pipe.blocked_reader_count < MAX_BLOCKED {
-                    pipe.blocked_readers[pipe.blocked_reader_count] = tid;
-                    pipe.blocked_reader_count += 1;
-                }
-                Err(()) // signal: must block
-            }
-        };
-
-        // Wake outside the lock
-        for i in 0..w_wake {
-            crate::task::scheduler::wake_thread(writers_to_wake[i]);
+        let mut st = pipe.state.lock();
+        if st.len > 0 {
+            let n = st.pop(buf);
+            // Wake any blocked writers since we freed buffer space
+            let to_wake = core::mem::take(&mut st.blocked_writers);
+            drop(st);
+            wake_all(&to_wake);
+            // Buffer space freed: writers polling for POLLOUT
+            crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Pipe(pipe_id));
+            return n as u32;
         }
-        for i in 0..r_wake {
-            crate::task::scheduler::wake_thread(readers_to_wake[i]);
-        }
-
-        match result {
-            Ok(n) => return n,
-            Err(()) => {
-                // Block this thread and retry after wake
-                crate::task::scheduler::block_current_thread();
-            }
+        if st.write_refs == 0 {
+            return 0; // EOF — no writers left
         }
+        // Buffer empty, writers exist — block and retry after wake
+        block_on(st, false);
     }
 }
 
@@ -218,77 +283,178 @@ pub fn write(pipe_id: u32, data: &[u8]) -> u32 {
     if data.is_empty() {
         return 0;
     }
+    let pipe = match find_pipe(pipe_id) {
+        Some(p) => p,
+        None => return u32::MAX, // pipe destroyed (EPIPE)
+    };
 
     let mut written = 0usize;
-
     loop {
-        let mut readers_to_wake: [u32; MAX_BLOCKED] = [0; MAX_BLOCKED];
-        let mut r_wake = 0;
-
-        let result = {
-            let mut guard = PIPES.lock();
-            let pipe = match find_pipe(&mut guard, pipe_id) {
-                Some(p) => p,
-                None => return u32::MAX, // pipe destroyed (EPIPE)
-            };
+        let mut st = pipe.state.lock();
+        if st.read_refs == 0 {
+            drop(st);
+            return epipe();
+        }
 
-            if pipe.read_refs == 0 {
-                // No readers — send SIGPIPE to current thread, return EPIPE
-                let tid = crate::task::scheduler::current_tid();
-                crate::task::scheduler::send_signal_to_thread(tid, crate::ipc::signal::SIGPIPE);
-                return u32::MAX;
+        // Write as much as we can fit
+        let space = st.space_or_grow();
+        if space > 0 {
+            let n = (data.len() - written).min(space);
+            st.push(&data[written..written + n]);
+            written += n;
+
+            // Wake blocked readers since we added data
+            let to_wake = core::mem::take(&mut st.blocked_readers);
+            drop(st);
+            wake_all(&to_wake);
+            crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Pipe(pipe_id));
+            if written >= data.len() {
+                return written as u32;
             }
+            // Buffer full but still have data — retry, blocking if still full
+            continue;
+        }
 
-            // Write as much as we can fit
-            let space = PIPE_BUF_SIZE.saturating_sub(pipe.buffer.len());
-            if space > 0 {
-                let remaining = &data[written..];
-                let n = remaining.len().min(space);
-                for i in 0..n {
-                    pipe.buffer.push_back(remaining[i]);
-                }
-                written += n;
-
-                // Wake blocked readers since we added data
-                r_wake = pipe.blocked_reader_count;
-                readers_to_wake[..r_wake].copy_from_slice(&pipe.blocked_readers[..r_wake]);
-                pipe.blocked_reader_count = 0;
-
-                if written >= data.len() {
-                    Ok(written as u32)
-                } else {
-                    // Buffer full but still have data — need to block and retry
-                    let tid = crate::task::scheduler::current_tid();
-                    if pipe.blocked_writer_count < MAX_BLOCKED {
-                        pipe.blocked_writers[pipe.blocked_writer_count] = tid;
-                        pipe.blocked_writer_count += 1;
-                    }
-                    Err(()) // signal: must block to write more
-                }
-            } else {
-                // Buffer completely full — block
-                let tid = crate::task::scheduler::current_tid();
-                if pipe.blocked_writer_count < MAX_BLOCKED {
-                    pipe.blocked_writers[pipe.blocked_writer_count] = tid;
-                    pipe.blocked_writer_count += 1;
+        // Buffer completely full — block
+        block_on(st, true);
+    }
+}
+
+/// Move up to `max` bytes from `source` into the pipe, without a user-space
+/// buffer.  Blocks while the pipe is full.
+///
+/// `source` fills the slice it is given and returns the byte count (0 at
+/// end of input) or `None` on error; it runs without the pipe lock held, so
+/// it may block.  Each call fills one fresh segment, which is appended to
+/// the pipe as is.  Stops early on a short fill.  Returns the bytes moved,
+/// or u32::MAX on EPIPE or if `source` failed before producing anything.
+pub fn splice_in<F>(pipe_id: u32, max: usize, mut source: F) -> u32
+where
+    F: FnMut(&mut [u8]) -> Option<usize>,
+{
+    if max == 0 {
+        return 0;
+    }
+    let pipe = match find_pipe(pipe_id) {
+        Some(p) => p,
+        None => return u32::MAX,
+    };
+
+    // Wait for room
+    let want = loop {
+        let mut st = pipe.state.lock();
+        if st.read_refs == 0 {
+            drop(st);
+            return epipe();
+        }
+        let space = st.space_or_grow();
+        if space > 0 {
+            break max.min(space);
+        }
+        block_on(st, true);
+    };
+
+    // Fill segments outside the lock
+    let mut segments: Vec<Segment> = Vec::new();
+    let mut moved = 0;
+    let mut failed = false;
+    while moved < want {
+        let ask = SEG_SIZE.min(want - moved);
+        let mut data = alloc::vec![0u8; ask];
+        match source(&mut data) {
+            Some(0) => break,
+            Some(n) => {
+                let n = n.min(ask);
+                data.truncate(n);
+                segments.push(Segment { data, start: 0 });
+                moved += n;
+                if n < ask {
+                    break;
                 }
-                Err(()) // signal: must block
             }
-        };
-
-        // Wake outside the lock
-        for i in 0..r_wake {
-            crate::task::scheduler::wake_thread(readers_to_wake[i]);
+            None => {
+                failed = true;
+                break;
+            }
         }
+    }
+    if moved == 0 {
+        return if failed { u32::MAX } else { 0 };
+    }
 
-        match result {
-            Ok(n) => return n,
-            Err(()) => {
-                // Block this thread and retry after wake
-                crate::task::scheduler::block_current_thread();
+    let to_wake = {
+        let mut st = pipe.state.lock();
+        st.len += moved;
+        st.segments.extend(segments);
+        core::mem::take(&mut st.blocked_readers)
+    };
+    wake_all(&to_wake);
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Pipe(pipe_id));
+    moved as u32
+}
+
+/// Move up to `max` bytes out of the pipe into `sink`, without a user-space
+/// buffer.  Blocks while the pipe is empty and writers exist.
+///
+/// Whole segments are detached from the pipe and handed to `sink` one at a
+/// time, without the pipe lock held; `sink` returns how many bytes it
+/// consumed, or `None` on error.  Whatever it does not consume is returned
+/// to the front of the pipe.  Returns the bytes moved, 0 at EOF, or
+/// u32::MAX if `sink` failed before consuming anything.
+pub fn splice_out<F>(pipe_id: u32, max: usize, mut sink: F) -> u32
+where
+    F: FnMut(&[u8]) -> Option<usize>,
+{
+    if max == 0 {
+        return 0;
+    }
+    let pipe = match find_pipe(pipe_id) {
+        Some(p) => p,
+        None => return 0,
+    };
+
+    let (segments, to_wake) = loop {
+        let mut st = pipe.state.lock();
+        if st.len > 0 {
+            let segments = st.take_segments(max);
+            break (segments, core::mem::take(&mut st.blocked_writers));
+        }
+        if st.write_refs == 0 {
+            return 0; // EOF
+        }
+        block_on(st, false);
+    };
+    wake_all(&to_wake);
+
+    let mut moved = 0;
+    let mut failed = false;
+    let mut rest = segments.into_iter();
+    let mut unsent: Option<Segment> = None;
+    for mut seg in rest.by_ref() {
+        match sink(seg.bytes()) {
+            Some(n) if n >= seg.len() => moved += seg.len(),
+            result => {
+                let n = result.unwrap_or(0).min(seg.len());
+                failed = result.is_none();
+                moved += n;
+                seg.start += n;
+                unsent = Some(seg);
+                break;
             }
         }
     }
+
+    // Put back what the sink did not take, in order
+    if unsent.is_some() {
+        let mut st = pipe.state.lock();
+        for seg in unsent.into_iter().chain(rest).collect::<Vec<_>>().into_iter().rev() {
+            st.len += seg.len();
+            st.segments.push_front(seg);
+        }
+    }
+
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Pipe(pipe_id));
+    if moved == 0 && failed { u32::MAX } else { moved as u32 }
 }
 
 /// Return the number of bytes currently buffered in the pipe (non-blocking).
@@ -297,14 +463,7 @@ pub fn write(pipe_id: u32, data: &[u8]) -> u32 {
 /// Callers can use this together with `is_write_closed()` to distinguish
 /// "empty but more data may arrive" from "empty and at EOF".
 pub fn bytes_available(pipe_id: u32) -> u32 {
-    let guard = PIPES.lock();
-    guard.iter()
-        .find_map(|slot| {
-            slot.as_ref()
-                .filter(|p| p.id == pipe_id)
-                .map(|p| p.buffer.len() as u32)
-        })
-        .unwrap_or(0)
+    find_pipe(pipe_id).map_or(0, |p| p.state.lock().len as u32)
 }
 
 /// Return true if the write end of the pipe has been fully closed.
@@ -313,24 +472,87 @@ pub fn bytes_available(pipe_id: u32) -> u32 {
 /// (EOF).  A `poll()` caller can combine this with `bytes_available() == 0`
 /// to report `POLLHUP`.
 pub fn is_write_closed(pipe_id: u32) -> bool {
-    let guard = PIPES.lock();
-    guard.iter()
-        .find_map(|slot| {
-            slot.as_ref()
-                .filter(|p| p.id == pipe_id)
-                .map(|p| p.write_refs == 0)
-        })
-        .unwrap_or(true) // pipe not found → treat as closed
+    // pipe not found → treat as closed
+    find_pipe(pipe_id).map_or(true, |p| p.state.lock().write_refs == 0)
+}
+
+/// Return the free space in the pipe buffer (non-blocking); 0 if the pipe
+/// does not exist.  A full pipe that may still grow reports its next step.
+pub fn space_available(pipe_id: u32) -> u32 {
+    find_pipe(pipe_id).map_or(0, |p| {
+        let st = p.state.lock();
+        if st.space() == 0 && st.capacity < PIPE_AUTO_MAX {
+            st.capacity as u32
+        } else {
+            st.space() as u32
+        }
+    })
+}
+
+/// Return true if the read end of the pipe has been fully closed (writes
+/// fail with EPIPE).
+pub fn is_read_closed(pipe_id: u32) -> bool {
+    find_pipe(pipe_id).map_or(true, |p| p.state.lock().read_refs == 0)
+}
+
+/// Current capacity of the pipe in bytes (`F_GETPIPE_SZ`); 0 if it does
+/// not exist.
+pub fn capacity(pipe_id: u32) -> u32 {
+    find_pipe(pipe_id).map_or(0, |p| p.state.lock().capacity as u32)
+}
+
+/// Set the capacity of the pipe (`F_SETPIPE_SZ`), rounded up to whole
+/// segments.  Returns the new capacity, or `None` if the pipe does not
+/// exist, `size` exceeds [`PIPE_MAX_SIZE`], or more than `size` bytes are
+/// buffered (EBUSY).
+pub fn set_capacity(pipe_id: u32, size: usize) -> Option<u32> {
+    if size > PIPE_MAX_SIZE {
+        return None;
+    }
+    let size = size.max(PIPE_BUF_SIZE).div_ceil(SEG_SIZE) * SEG_SIZE;
+    let pipe = find_pipe(pipe_id)?;
+    let to_wake = {
+        let mut st = pipe.state.lock();
+        if st.len > size {
+            return None;
+        }
+        let grew = size > st.capacity;
+        st.capacity = size;
+        if grew { core::mem::take(&mut st.blocked_writers) } else { Vec::new() }
+    };
+    wake_all(&to_wake);
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Pipe(pipe_id));
+    Some(size as u32)
 }
 
 // ---- Internal helpers ----
 
-fn find_pipe<'a>(slots: &'a mut [Option<AnonPipe>; MAX_PIPES], id: u32) -> Option<&'a mut AnonPipe> {
-    slots.iter_mut()
-        .find_map(|slot| slot.as_mut().filter(|p| p.id == id))
+fn find_pipe(id: u32) -> Option<Arc<AnonPipe>> {
+    PIPES.lock().get(&id).cloned()
+}
+
+/// Send SIGPIPE to the current thread and return EPIPE.
+fn epipe() -> u32 {
+    let tid = crate::task::scheduler::current_tid();
+    crate::task::scheduler::send_signal_to_thread(tid, crate::ipc::signal::SIGPIPE);
+    u32::MAX
 }
 
-fn find_pipe_slot<'a>(slots: &'a mut [Option<AnonPipe>; MAX_PIPES], id: u32) -> Option<&'a mut Option<AnonPipe>> {
-    slots.iter_mut()
-        .find(|slot| slot.as_ref().map_or(false, |p| p.id == id))
+fn wake_all(tids: &[u32]) {
+    for &tid in tids {
+        crate::task::scheduler::wake_thread(tid);
+    }
+}
+
+/// Publish the current thread as a blocked reader (or writer) of the pipe
+/// held by `st`, then unlock and yield until woken.
+fn block_on(mut st: SpinlockGuard<PipeState>, writer: bool) {
+    let tid = crate::task::scheduler::current_tid();
+    let list = if writer { &mut st.blocked_writers } else { &mut st.blocked_readers };
+    if !list.contains(&tid) {
+        list.push(tid);
+    }
+    crate::task::scheduler::prepare_block_current(None);
+    drop(st);
+    crate::task::scheduler::schedule();
 }
@@ -3,12 +3,20 @@
 //! Two independent buses exist: the **system bus** (kernel-only emitters, e.g. process
 //! lifecycle and hardware events) and the **module bus** (named channels that any process
 //! can create, subscribe to, and emit events on). Each subscriber has a bounded per-sub
-//! queue; oldest events are dropped when the queue is full.
+//! queue; oldest events are dropped when the queue is full.  A channel subscriber can
+//! also map an [`EventRing`] and read its events from shared memory without a syscall;
+//! the kernel queue then only holds what does not fit in the ring.
 //!
-//! **Blocking wait support**: Subscribers can register a waiter TID. When an event is
-//! emitted, blocked waiters are collected under the bus lock and woken *outside* the lock
-//! via `scheduler::wake_thread()` (same pattern as pipe blocking).
+//! **Blocking wait support**: A waiter publishes its TID on the subscription and marks
+//! itself Blocked under the bus lock (`prepare_block_current`), so an emit either runs
+//! first (the waiter sees the event) or finds the TID.  Emit collects the waiters of a
+//! broadcast under the bus lock and wakes them *outside* it, one batch per emit rather
+//! than one wake per queued event.  Channel emits are also reported to wait sets via
+//! `poll_set::notify`.
+//!
+//! Lock order: MODULE_BUS / SYSTEM_BUS → SCHEDULER.
 
+use crate::ipc::event_ring::EventRing;
 use crate::sync::spinlock::Spinlock;
 use alloc::collections::BTreeMap;
 use alloc::collections::VecDeque;
@@ -65,12 +73,114 @@ impl EventData {
 struct Subscription {
     id: u32,
     filter: Option<u32>, // None = all events, Some(type) = only that type
+    /// Events not (yet) in the ring; all events if there is no ring.
     queue: VecDeque<EventData>,
+    /// Shared-memory ring, read by the subscriber without a syscall.
+    ring: Option<EventRing>,
     /// TID of thread blocked in `evt_chan_wait` / `evt_sys_wait` on this subscription.
     /// Cleared by emit (collected for wake) or by the waiter itself on timeout/return.
     waiter_tid: Option<u32>,
 }
 
+impl Subscription {
+    fn new(id: u32, filter: Option<u32>) -> Self {
+        Subscription { id, filter, queue: VecDeque::new(), ring: None, waiter_tid: None }
+    }
+
+    fn matches(&self, event: &EventData) -> bool {
+        self.filter.is_none() || self.filter == Some(event.event_type())
+    }
+
+    /// Queue `event`, in the ring while nothing older is waiting in the
+    /// kernel queue, and collect the waiter for waking.
+    fn deliver(&mut self, event: EventData, wake: &mut Wakeups) {
+        self.refill();
+        let in_ring = self.queue.is_empty() && self.ring.as_ref().map_or(false, |r| r.push(&event));
+        if !in_ring {
+            if self.queue.len() >= MAX_QUEUE_DEPTH {
+                self.queue.pop_front(); // Drop oldest
+                if let Some(ring) = &self.ring {
+                    ring.note_dropped();
+                }
+            }
+            self.queue.push_back(event);
+            if let Some(ring) = &self.ring {
+                ring.set_spilled(self.queue.len());
+            }
+        }
+        if let Some(tid) = self.waiter_tid.take() {
+            wake.add(tid);
+        }
+    }
+
+    /// Move spilled events into the ring as far as it has room.
+    fn refill(&mut self) {
+        if let Some(ring) = &self.ring {
+            if self.queue.is_empty() {
+                return;
+            }
+            while let Some(ev) = self.queue.front() {
+                if !ring.push(ev) {
+                    break;
+                }
+                self.queue.pop_front();
+            }
+            ring.set_spilled(self.queue.len());
+        }
+    }
+
+    /// Take the oldest event: ring entries precede the kernel queue.
+    fn take(&mut self) -> Option<EventData> {
+        if let Some(ev) = self.ring.as_ref().and_then(|r| r.pop()) {
+            return Some(ev);
+        }
+        let ev = self.queue.pop_front();
+        self.refill();
+        ev
+    }
+
+    fn has_events(&self) -> bool {
+        !self.queue.is_empty() || self.ring.as_ref().map_or(false, |r| !r.is_empty())
+    }
+}
+
+/// Waiters collected under a bus lock, woken after it is dropped.
+struct Wakeups {
+    tids: [u32; 8],
+    count: usize,
+}
+
+impl Wakeups {
+    const fn new() -> Self {
+        Wakeups { tids: [0; 8], count: 0 }
+    }
+
+    fn add(&mut self, tid: u32) {
+        if self.count < self.tids.len() {
+            self.tids[self.count] = tid;
+            self.count += 1;
+        } else {
+            // Lock-free; drained by the next timer tick
+            crate::task::scheduler::deferred_wake(tid);
+        }
+    }
+
+    fn wake(&self) {
+        for &tid in &self.tids[..self.count] {
+            crate::task::scheduler::wake_thread(tid);
+        }
+    }
+}
+
+/// Release the rings of subscriptions removed from a bus (no lock held).
+fn release_rings(subs: Vec<Subscription>) {
+    for sub in subs {
+        if let Some(ring) = sub.ring {
+            ring.release();
+        }
+    }
+}
+
 // ── System Bus ──
 
 static SYSTEM_BUS: Spinlock<Vec<Subscription>> = Spinlock::new(Vec::new());
@@ -81,28 +191,16 @@ static NEXT_SUB_ID: AtomicU32 = AtomicU32::new(1);
 /// Collects blocked waiter TIDs under the lock, wakes them outside
 /// to avoid holding SYSTEM_BUS while acquiring SCHEDULER lock.
 pub fn system_emit(event: EventData) {
-    let mut tids_to_wake = [0u32; 8];
-    let mut wake_count = 0usize;
+    let mut wake = Wakeups::new();
     {
         let mut bus = SYSTEM_BUS.lock();
         for sub in bus.iter_mut() {
-            if sub.filter.is_none() || sub.filter == Some(event.event_type()) {
-                if sub.queue.len() >= MAX_QUEUE_DEPTH {
-                    sub.queue.pop_front(); // Drop oldest
-                }
-                sub.queue.push_back(event);
-                if let Some(tid) = sub.waiter_tid.take() {
-                    if wake_count < 8 {
-                        tids_to_wake[wake_count] = tid;
-                        wake_count += 1;
-                    }
-                }
+            if sub.matches(&event) {
+                sub.deliver(event, &mut wake);
             }
         }
     }
-    for i in 0..wake_count {
-        crate::task::scheduler::wake_thread(tids_to_wake[i]);
-    }
+    wake.wake();
     // Also wake compositor — it may be blocked on a channel subscription,
     // not the system bus, but still needs to process system events.
     crate::syscall::handlers::wake_compositor_if_blocked();
@@ -114,23 +212,14 @@ pub fn system_subscribe(filter: u32) -> u32 {
     let id = NEXT_SUB_ID.fetch_add(1, Ordering::Relaxed);
     let filter = if filter == 0 { None } else { Some(filter) };
     let mut bus = SYSTEM_BUS.lock();
-    bus.push(Subscription {
-        id,
-        filter,
-        queue: VecDeque::new(),
-        waiter_tid: None,
-    });
+    bus.push(Subscription::new(id, filter));
     id
 }
 
 /// Poll for the next event on a system subscription.
 pub fn system_poll(sub_id: u32) -> Option<EventData> {
     let mut bus = SYSTEM_BUS.lock();
-    if let Some(sub) = bus.iter_mut().find(|s| s.id == sub_id) {
-        sub.queue.pop_front()
-    } else {
-        None
-    }
+    bus.iter_mut().find(|s| s.id == sub_id)?.take()
 }
 
 /// Unsubscribe from the system bus.
@@ -173,12 +262,7 @@ pub fn channel_subscribe(channel_id: u32, filter: u32) -> u32 {
     let filter = if filter == 0 { None } else { Some(filter) };
     let mut bus = MODULE_BUS.lock();
     if let Some(channel) = bus.get_mut(&channel_id) {
-        channel.subs.push(Subscription {
-            id: sub_id,
-            filter,
-            queue: VecDeque::new(),
-            waiter_tid: None,
-        });
+        channel.subs.push(Subscription::new(sub_id, filter));
     }
     sub_id
 }
@@ -188,30 +272,19 @@ pub fn channel_subscribe(channel_id: u32, filter: u32) -> u32 {
 /// Collects blocked waiter TIDs under the lock, wakes them outside
 /// to avoid holding MODULE_BUS while acquiring SCHEDULER lock.
 pub fn channel_emit(channel_id: u32, event: EventData) {
-    let mut tids_to_wake = [0u32; 8];
-    let mut wake_count = 0usize;
+    let mut wake = Wakeups::new();
     {
         let mut bus = MODULE_BUS.lock();
         if let Some(channel) = bus.get_mut(&channel_id) {
             for sub in channel.subs.iter_mut() {
-                if sub.filter.is_none() || sub.filter == Some(event.event_type()) {
-                    if sub.queue.len() >= MAX_QUEUE_DEPTH {
-                        sub.queue.pop_front();
-                    }
-                    sub.queue.push_back(event);
-                    if let Some(tid) = sub.waiter_tid.take() {
-                        if wake_count < 8 {
-                            tids_to_wake[wake_count] = tid;
-                            wake_count += 1;
-                        }
-                    }
+                if sub.matches(&event) {
+                    sub.deliver(event, &mut wake);
                 }
             }
         }
     }
-    for i in 0..wake_count {
-        crate::task::scheduler::wake_thread(tids_to_wake[i]);
-    }
+    wake.wake();
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Chan(channel_id));
 }
 
 /// Emit an event to a specific subscriber on a module channel (unicast).
@@ -220,50 +293,118 @@ pub fn channel_emit(channel_id: u32, event: EventData) {
 /// preventing other apps from receiving keyboard/mouse events for windows
 /// they don't own.
 pub fn channel_emit_to(channel_id: u32, target_sub_id: u32, event: EventData) {
-    let mut tid_to_wake: Option<u32> = None;
+    let mut wake = Wakeups::new();
     {
         let mut bus = MODULE_BUS.lock();
         if let Some(channel) = bus.get_mut(&channel_id) {
-            for sub in channel.subs.iter_mut() {
-                if sub.id == target_sub_id {
-                    if sub.queue.len() >= MAX_QUEUE_DEPTH {
-                        sub.queue.pop_front();
-                    }
-                    sub.queue.push_back(event);
-                    tid_to_wake = sub.waiter_tid.take();
-                    break;
-                }
+            if let Some(sub) = channel.subs.iter_mut().find(|s| s.id == target_sub_id) {
+                sub.deliver(event, &mut wake);
             }
         }
     }
-    if let Some(tid) = tid_to_wake {
-        crate::task::scheduler::wake_thread(tid);
-    }
+    wake.wake();
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Chan(channel_id));
 }
 
 /// Poll for the next event on a module channel subscription.
 pub fn channel_poll(channel_id: u32, sub_id: u32) -> Option<EventData> {
     let mut bus = MODULE_BUS.lock();
-    if let Some(channel) = bus.get_mut(&channel_id) {
-        if let Some(sub) = channel.subs.iter_mut().find(|s| s.id == sub_id) {
-            return sub.queue.pop_front();
+    bus.get_mut(&channel_id)?.subs.iter_mut().find(|s| s.id == sub_id)?.take()
+}
+
+/// Take up to `out.len()` events from a module channel subscription in one
+/// lock hold.  Returns how many were stored.
+pub fn channel_poll_batch(channel_id: u32, sub_id: u32, out: &mut [EventData]) -> usize {
+    let mut bus = MODULE_BUS.lock();
+    let sub = match bus.get_mut(&channel_id).and_then(|c| c.subs.iter_mut().find(|s| s.id == sub_id)) {
+        Some(s) => s,
+        None => return 0,
+    };
+    let mut n = 0;
+    while n < out.len() {
+        match sub.take() {
+            Some(ev) => {
+                out[n] = ev;
+                n += 1;
+            }
+            None => break,
+        }
+    }
+    n
+}
+
+/// Give a module channel subscription a shared-memory ring mapped into the
+/// calling process, moving its queued events into it.  Returns the ring's
+/// user address (the existing one if it already has a ring), or 0.
+///
+/// **Must be called from a syscall context** (not from IRQ handler).
+pub fn channel_attach_ring(channel_id: u32, sub_id: u32) -> u64 {
+    {
+        let mut bus = MODULE_BUS.lock();
+        match bus.get_mut(&channel_id).and_then(|c| c.subs.iter_mut().find(|s| s.id == sub_id)) {
+            Some(sub) => {
+                if let Some(ring) = &sub.ring {
+                    return ring.user_addr;
+                }
+            }
+            None => return 0,
+        }
+    }
+    // Mapping takes SHM and page-table locks: done without the bus lock.
+    let ring = match EventRing::create() {
+        Some(r) => r,
+        None => return 0,
+    };
+    let user_addr = ring.user_addr;
+    let unused = {
+        let mut bus = MODULE_BUS.lock();
+        match bus.get_mut(&channel_id).and_then(|c| c.subs.iter_mut().find(|s| s.id == sub_id)) {
+            Some(sub) if sub.ring.is_none() => {
+                sub.ring = Some(ring);
+                sub.refill();
+                None
+            }
+            _ => Some(ring), // unsubscribed or raced with another attach
+        }
+    };
+    match unused {
+        Some(ring) => {
+            ring.release();
+            channel_ring_addr(channel_id, sub_id)
         }
+        None => user_addr,
     }
-    None
+}
+
+fn channel_ring_addr(channel_id: u32, sub_id: u32) -> u64 {
+    let bus = MODULE_BUS.lock();
+    bus.get(&channel_id)
+        .and_then(|c| c.subs.iter().find(|s| s.id == sub_id))
+        .and_then(|s| s.ring.as_ref())
+        .map_or(0, |r| r.user_addr)
 }
 
 /// Unsubscribe from a module channel.
 pub fn channel_unsubscribe(channel_id: u32, sub_id: u32) {
-    let mut bus = MODULE_BUS.lock();
-    if let Some(channel) = bus.get_mut(&channel_id) {
-        channel.subs.retain(|s| s.id != sub_id);
-    }
+    let removed: Vec<Subscription> = {
+        let mut bus = MODULE_BUS.lock();
+        match bus.get_mut(&channel_id) {
+            Some(channel) => match channel.subs.iter().position(|s| s.id == sub_id) {
+                Some(pos) => alloc::vec![channel.subs.remove(pos)],
+                None => Vec::new(),
+            },
+            None => Vec::new(),
+        }
+    };
+    release_rings(removed);
 }
 
 /// Destroy a module channel and all its subscriptions.
 pub fn channel_destroy(channel_id: u32) {
-    let mut bus = MODULE_BUS.lock();
-    bus.remove(&channel_id);
+    let removed = MODULE_BUS.lock().remove(&channel_id);
+    if let Some(channel) = removed {
+        release_rings(channel.subs);
+    }
 }
 
 /// Lock-free check if SYSTEM_BUS or MODULE_BUS lock is currently held.
@@ -273,29 +414,36 @@ pub fn is_any_bus_locked() -> bool {
 
 // ── Blocking wait helpers ──
 
-/// Register a waiter TID on a channel subscription. Returns `false` if the
-/// subscription already has queued events (caller should not block).
-pub fn channel_register_waiter(channel_id: u32, sub_id: u32, tid: u32) -> bool {
-    let mut bus = MODULE_BUS.lock();
-    if let Some(channel) = bus.get_mut(&channel_id) {
-        if let Some(sub) = channel.subs.iter_mut().find(|s| s.id == sub_id) {
-            if !sub.queue.is_empty() {
-                return false; // Events already queued — don't block
-            }
-            sub.waiter_tid = Some(tid);
-            return true; // Registered — caller should block
+/// Block until a channel subscription has events, `wake_at` (PIT tick)
+/// passes, or the thread is woken otherwise (e.g. the compositor by input).
+/// Returns `true` if events are available.
+///
+/// **Must be called from a syscall context** (not from IRQ handler).
+pub fn channel_wait(channel_id: u32, sub_id: u32, wake_at: Option<u32>) -> bool {
+    let tid = crate::task::scheduler::current_tid();
+    {
+        let mut bus = MODULE_BUS.lock();
+        let sub = match bus.get_mut(&channel_id).and_then(|c| c.subs.iter_mut().find(|s| s.id == sub_id)) {
+            Some(s) => s,
+            None => return false,
+        };
+        if sub.has_events() {
+            return true;
         }
+        sub.waiter_tid = Some(tid);
+        crate::task::scheduler::prepare_block_current(wake_at);
     }
-    false
-}
+    crate::task::scheduler::schedule();
 
-/// Clear the waiter TID on a channel subscription (called after waking).
-pub fn channel_unregister_waiter(channel_id: u32, sub_id: u32) {
     let mut bus = MODULE_BUS.lock();
-    if let Some(channel) = bus.get_mut(&channel_id) {
-        if let Some(sub) = channel.subs.iter_mut().find(|s| s.id == sub_id) {
-            sub.waiter_tid = None;
+    match bus.get_mut(&channel_id).and_then(|c| c.subs.iter_mut().find(|s| s.id == sub_id)) {
+        Some(sub) => {
+            if sub.waiter_tid == Some(tid) {
+                sub.waiter_tid = None; // timeout or foreign wake
+            }
+            sub.has_events()
         }
+        None => false,
     }
 }
 
@@ -304,7 +452,7 @@ pub fn channel_has_events(channel_id: u32, sub_id: u32) -> bool {
     let bus = MODULE_BUS.lock();
     if let Some(channel) = bus.get(&channel_id) {
         if let Some(sub) = channel.subs.iter().find(|s| s.id == sub_id) {
-            return !sub.queue.is_empty();
+            return sub.has_events();
         }
     }
     false
@@ -0,0 +1,214 @@
+//! Shared-memory event rings for event-bus subscribers.
+//!
+//! A subscriber can ask for its queue to be exposed as a single-producer /
+//! single-consumer ring in one page of its own address space, so events are
+//! read without a syscall.  The page is a kernel-owned SHM region (so it
+//! survives, and is never freed by, process teardown) that is also mapped
+//! into a kernel window, where `event_bus` writes under its bus lock.
+//!
+//! Layout (mirrored in libsyscall `evt_ring_pop`):
+//!
+//! | Offset | Field | Writer |
+//! |--------|-------|--------|
+//! | 0  | `head` u32: next slot to read | consumer |
+//! | 4  | `tail` u32: next slot to write | kernel |
+//! | 8  | `capacity` u32 ([`RING_CAPACITY`]) | kernel |
+//! | 12 | `spilled` u32: events waiting in the kernel queue | kernel |
+//! | 16 | `dropped` u32: events lost to overflow | kernel |
+//! | 64 | `capacity` events of 5 x u32 | kernel |
+//!
+//! The consumer reads slot `head % capacity` while `head != tail` (acquire
+//! load of `tail`) and publishes `head + 1` with a release store.  When the
+//! ring is full, events spill into the subscription's kernel queue and
+//! `spilled` says how many; the consumer then drains them with a poll
+//! syscall, which also refills the ring.
+
+use crate::ipc::event_bus::EventData;
+use crate::ipc::shared_memory;
+use crate::memory::address::PhysAddr;
+#[cfg(target_arch = "x86_64")]
+use crate::memory::address::VirtAddr;
+use crate::memory::FRAME_SIZE;
+use crate::sync::spinlock::Spinlock;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// Events per ring.
+pub const RING_CAPACITY: u32 = 128;
+
+const HEADER_SIZE: usize = 64;
+const EVENT_SIZE: usize = 20;
+
+/// Kernel VA window for ring pages (between the external-driver range and
+/// the page-table scratch pages).
+#[cfg(target_arch = "x86_64")]
+const WINDOW_BASE: u64 = 0xFFFF_FFFF_BFE0_0000;
+/// Rings system-wide (one window page each).
+const WINDOW_SLOTS: usize = 256;
+
+/// Occupied window slots.
+static SLOTS: Spinlock<[u64; WINDOW_SLOTS / 64]> = Spinlock::new([0; WINDOW_SLOTS / 64]);
+
+#[repr(C)]
+struct Header {
+    head: AtomicU32,
+    tail: AtomicU32,
+    capacity: AtomicU32,
+    spilled: AtomicU32,
+    dropped: AtomicU32,
+}
+
+/// A subscriber's ring.  Owned by its `Subscription`; [`EventRing::release`]
+/// must run once it has been removed from the bus.
+pub struct EventRing {
+    shm_id: u32,
+    slot: u32,
+    base: *mut u8,
+    /// Address of the ring in the subscriber's address space.
+    pub user_addr: u64,
+}
+
+// SAFETY: `base` points into a kernel window page owned by this ring; it is
+// only dereferenced under the event-bus lock that owns the subscription.
+unsafe impl Send for EventRing {}
+
+#[cfg(target_arch = "x86_64")]
+fn slot_ptr(slot: u32, _frame: PhysAddr) -> *mut u8 {
+    (WINDOW_BASE + slot as u64 * FRAME_SIZE as u64) as *mut u8
+}
+
+#[cfg(target_arch = "aarch64")]
+fn slot_ptr(_slot: u32, frame: PhysAddr) -> *mut u8 {
+    (frame.as_u64() + crate::memory::virtual_mem::PHYS_TO_VIRT_OFFSET) as *mut u8
+}
+
+#[cfg(target_arch = "x86_64")]
+fn map_slot(slot: u32, frame: PhysAddr) {
+    // Present | Writable, not executable.
+    let flags = 0x03 | crate::memory::virtual_mem::page_nx_flag();
+    crate::memory::virtual_mem::map_page(VirtAddr::new(slot_ptr(slot, frame) as u64), frame, flags);
+}
+
+#[cfg(target_arch = "aarch64")]
+fn map_slot(_slot: u32, _frame: PhysAddr) {}
+
+#[cfg(target_arch = "x86_64")]
+fn unmap_slot(slot: u32) {
+    let va = WINDOW_BASE + slot as u64 * FRAME_SIZE as u64;
+    crate::memory::virtual_mem::unmap_range(VirtAddr::new(va), 1);
+}
+
+#[cfg(target_arch = "aarch64")]
+fn unmap_slot(_slot: u32) {}
+
+fn alloc_slot() -> Option<u32> {
+    let mut slots = SLOTS.lock();
+    for (w, word) in slots.iter_mut().enumerate() {
+        if *word != u64::MAX {
+            let bit = (!*word).trailing_zeros();
+            *word |= 1 << bit;
+            return Some(w as u32 * 64 + bit);
+        }
+    }
+    None
+}
+
+fn free_slot(slot: u32) {
+    SLOTS.lock()[slot as usize / 64] &= !(1 << (slot % 64));
+}
+
+impl EventRing {
+    /// Allocate a ring and map it into the calling process.
+    ///
+    /// **Must be called from a syscall context** with no spinlock held.
+    pub fn create() -> Option<EventRing> {
+        let slot = alloc_slot()?;
+        let shm_id = match shared_memory::create(FRAME_SIZE, shared_memory::KERNEL_OWNER) {
+            Some(id) => id,
+            None => {
+                free_slot(slot);
+                return None;
+            }
+        };
+        let frame = shared_memory::region_frame(shm_id);
+        let user_addr = shared_memory::map_into_current(shm_id);
+        let frame = match frame {
+            Some(f) if user_addr != 0 => f,
+            _ => {
+                shared_memory::destroy(shm_id, shared_memory::KERNEL_OWNER);
+                free_slot(slot);
+                return None;
+            }
+        };
+        map_slot(slot, frame);
+        let ring = EventRing { shm_id, slot, base: slot_ptr(slot, frame), user_addr };
+        ring.header().capacity.store(RING_CAPACITY, Ordering::Release);
+        Some(ring)
+    }
+
+    fn header(&self) -> &Header {
+        unsafe { &*(self.base as *const Header) }
+    }
+
+    fn event_ptr(&self, index: u32) -> *mut u32 {
+        let off = HEADER_SIZE + (index % RING_CAPACITY) as usize * EVENT_SIZE;
+        unsafe { self.base.add(off) as *mut u32 }
+    }
+
+    /// Append an event.  Returns `false` if the ring is full.
+    pub fn push(&self, event: &EventData) -> bool {
+        let h = self.header();
+        let tail = h.tail.load(Ordering::Relaxed);
+        if tail.wrapping_sub(h.head.load(Ordering::Acquire)) >= RING_CAPACITY {
+            return false;
+        }
+        let p = self.event_ptr(tail);
+        for (i, w) in event.words.iter().enumerate() {
+            unsafe { core::ptr::write_volatile(p.add(i), *w) };
+        }
+        h.tail.store(tail.wrapping_add(1), Ordering::Release);
+        true
+    }
+
+    /// Take the oldest event on behalf of the consumer (poll syscalls).
+    pub fn pop(&self) -> Option<EventData> {
+        let h = self.header();
+        let head = h.head.load(Ordering::Relaxed);
+        if head == h.tail.load(Ordering::Acquire) {
+            return None;
+        }
+        let p = self.event_ptr(head);
+        let mut words = [0u32; 5];
+        for (i, w) in words.iter_mut().enumerate() {
+            *w = unsafe { core::ptr::read_volatile(p.add(i)) };
+        }
+        h.head.store(head.wrapping_add(1), Ordering::Release);
+        Some(EventData { words })
+    }
+
+    pub fn is_empty(&self) -> bool {
+        let h = self.header();
+        h.head.load(Ordering::Acquire) == h.tail.load(Ordering::Acquire)
+    }
+
+    /// Publish the length of the kernel spill queue.
+    pub fn set_spilled(&self, n: usize) {
+        self.header().spilled.store(n as u32, Ordering::Release);
+    }
+
+    /// Count an event dropped because the spill queue was full too.
+    pub fn note_dropped(&self) {
+        self.header().dropped.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Tear the ring down.  Call on a ring already detached from the bus,
+    /// with no spinlock held (the window unmap is a TLB shootdown).  The
+    /// user mapping is removed if the caller is the thread that created the
+    /// ring; otherwise it goes with the subscriber process, and the page is
+    /// freed once no process maps it.
+    pub fn release(self) {
+        unmap_slot(self.slot);
+        free_slot(self.slot);
+        shared_memory::unmap_from_current(self.shm_id);
+        shared_memory::destroy(self.shm_id, shared_memory::KERNEL_OWNER);
+    }
+}
@@ -0,0 +1,161 @@
+//! Fast user-space mutexes (futexes).
+//!
+//! A futex is an aligned 32-bit word in user memory.  User space does all
+//! uncontended locking with atomics on that word and only enters the kernel
+//! to sleep on it ([`wait`]) or to wake sleepers ([`wake`]).
+//!
+//! Waiters are keyed by the *physical* address of the word, so threads of
+//! different processes that map the same shared-memory region rendezvous on
+//! the same key.  Keys hash into a fixed set of buckets, each a spinlock-
+//! protected FIFO of (key, TID) pairs.  The value check in [`wait`], the
+//! enqueue, and marking the thread Blocked all happen under the bucket lock,
+//! and [`wake`] takes the same lock, so a store + wake racing with a wait
+//! either changes the value before the waiter looks or finds it queued.
+//!
+//! A key goes stale when the reclaim thread swaps its page out: the reclaim
+//! thread then wakes every waiter on the frame ([`wake_frames`]), and a
+//! waiter that finds its page no longer at the keyed frame returns
+//! [`FUTEX_EAGAIN`]; either way user space re-checks and waits again.
+//!
+//! Lock order: futex bucket → SCHEDULER; futex bucket → COW lock (reading
+//! the word may fault a page in transit back in).
+
+use crate::sync::spinlock::Spinlock;
+use alloc::vec::Vec;
+
+/// Woken by [`wake`] (or spuriously — callers must re-check the word).
+pub const FUTEX_WOKEN: u32 = 0;
+/// The word did not hold the expected value; nothing was queued (EAGAIN).
+pub const FUTEX_EAGAIN: u32 = u32::MAX - 10;
+/// The timeout expired before a wake (ETIMEDOUT).
+pub const FUTEX_ETIMEDOUT: u32 = u32::MAX - 109;
+/// The address is unaligned, outside user space, or unmapped.
+pub const FUTEX_EFAULT: u32 = u32::MAX;
+
+/// Number of hash buckets (power of two).
+const BUCKET_BITS: u32 = 6;
+const NUM_BUCKETS: usize = 1 << BUCKET_BITS;
+
+#[derive(Clone, Copy)]
+struct Waiter {
+    key: u64,
+    tid: u32,
+}
+
+static BUCKETS: [Spinlock<Vec<Waiter>>; NUM_BUCKETS] = {
+    const INIT: Spinlock<Vec<Waiter>> = Spinlock::new(Vec::new());
+    [INIT; NUM_BUCKETS]
+};
+
+fn bucket(key: u64) -> &'static Spinlock<Vec<Waiter>> {
+    // Fibonacci hash: words within one page differ only in low bits.
+    let h = (key >> 2).wrapping_mul(0x9E37_79B9_7F4A_7C15);
+    &BUCKETS[(h >> (64 - BUCKET_BITS)) as usize]
+}
+
+/// Validate `uaddr` and translate it to its physical key.
+fn key_for(uaddr: u64) -> Option<u64> {
+    if uaddr == 0 || uaddr & 3 != 0 || uaddr + 4 > 0x0000_8000_0000_0000 {
+        return None;
+    }
+    crate::memory::virtual_mem::user_frame_key(uaddr)
+}
+
+/// Sleep while the word at `uaddr` holds `expected`.
+///
+/// `timeout_ms == u32::MAX` waits indefinitely.  Returns [`FUTEX_WOKEN`],
+/// [`FUTEX_EAGAIN`], [`FUTEX_ETIMEDOUT`] or [`FUTEX_EFAULT`].
+///
+/// **Must be called from a syscall context** (not from IRQ handler).
+pub fn wait(uaddr: u64, expected: u32, timeout_ms: u32) -> u32 {
+    let key = match key_for(uaddr) {
+        Some(k) => k,
+        None => return FUTEX_EFAULT,
+    };
+    let tid = crate::task::scheduler::current_tid();
+
+    let wake_at = if timeout_ms == u32::MAX {
+        None
+    } else {
+        let hz = crate::arch::hal::timer_frequency_hz() as u64;
+        let ticks = ((timeout_ms as u64 * hz / 1000) as u32).max(1);
+        Some(crate::arch::hal::timer_current_ticks().wrapping_add(ticks))
+    };
+
+    {
+        let mut queue = bucket(key).lock();
+        #[cfg(target_arch = "x86_64")]
+        {
+            let pte = crate::memory::virtual_mem::read_pte(
+                crate::memory::address::VirtAddr::new(uaddr & !0xFFF),
+            );
+            if pte & 1 == 0 || pte & 0x000F_FFFF_FFFF_F000 != key & !0xFFF {
+                return FUTEX_EAGAIN; // Swapped out since the key was taken
+            }
+        }
+        let current = unsafe { core::ptr::read_volatile(uaddr as *const u32) };
+        if current != expected {
+            return FUTEX_EAGAIN;
+        }
+        queue.push(Waiter { key, tid });
+        crate::task::scheduler::prepare_block_current(wake_at);
+    }
+    crate::task::scheduler::schedule();
+
+    // A waker removes the entry before waking us; still queued means the
+    // deadline fired (or something else woke the thread).
+    let mut queue = bucket(key).lock();
+    match queue.iter().position(|w| w.tid == tid && w.key == key) {
+        Some(pos) => {
+            queue.remove(pos);
+            if wake_at.is_some() { FUTEX_ETIMEDOUT } else { FUTEX_WOKEN }
+        }
+        None => FUTEX_WOKEN,
+    }
+}
+
+/// Wake up to `count` threads sleeping on the word at `uaddr`, oldest first.
+///
+/// Returns the number of threads woken, or [`FUTEX_EFAULT`].
+pub fn wake(uaddr: u64, count: u32) -> u32 {
+    let key = match key_for(uaddr) {
+        Some(k) => k,
+        None => return FUTEX_EFAULT,
+    };
+    let mut woken = 0u32;
+    let mut queue = bucket(key).lock();
+    let mut i = 0;
+    while i < queue.len() && woken < count {
+        if queue[i].key != key {
+            i += 1;
+            continue;
+        }
+        let tid = queue.remove(i).tid;
+        // Entries of exited threads, or of waiters already woken by their
+        // deadline, are dropped without using up the wake count.
+        if crate::task::scheduler::wake_thread(tid) {
+            woken += 1;
+        }
+    }
+    woken
+}
+
+/// Wake every waiter keyed on one of `frames` (sorted physical frame
+/// addresses), after the reclaim thread moved those pages to swap.
+pub fn wake_frames(frames: &[u64]) {
+    if frames.is_empty() {
+        return;
+    }
+    for b in BUCKETS.iter() {
+        let mut queue = b.lock();
+        let mut i = 0;
+        while i < queue.len() {
+            if frames.binary_search(&(queue[i].key & !0xFFF)).is_ok() {
+                let tid = queue.remove(i).tid;
+                crate::task::scheduler::wake_thread(tid);
+            } else {
+                i += 1;
+            }
+        }
+    }
+}
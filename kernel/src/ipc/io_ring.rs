@@ -0,0 +1,382 @@
+//! Asynchronous I/O rings: batched submission, completion by a worker pool.
+//!
+//! A ring is a kernel object reached through an fd of kind `FdKind::IoRing`.
+//! Its submission and completion queues live in user memory registered with
+//! `SYS_IO_RING_SETUP`; `SYS_IO_RING_ENTER` consumes new submissions, turns
+//! each into an [`Op`] that owns kernel buffers, and queues it for the
+//! `io_worker` threads.  Workers never touch user memory: data read lands in
+//! a kernel buffer, and the syscall layer copies it to the submission's
+//! buffer when it posts the [`Completion`], in the submitter's address space.
+//!
+//! Operations are independent and may complete in any order.  Every
+//! completion notifies `poll_set` with [`Key::Ring`], so a wait set can watch
+//! a ring next to sockets, pipes and channels.
+//!
+//! A ring holds at most `cq_entries` operations in flight or finished but
+//! not yet posted, so a process cannot queue unbounded kernel memory.
+//!
+//! Lock order: RINGS → SCHEDULER and QUEUE → SCHEDULER; RINGS and QUEUE are
+//! never held together.
+
+use crate::fs::file::FileFlags;
+use crate::fs::vfs::{FsError, StatResult};
+use crate::ipc::poll_set::{self, Key};
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+use alloc::collections::VecDeque;
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+
+/// Number of `io_worker` kernel threads, started with the first ring.
+const WORKERS: usize = 4;
+/// Scheduling priority of the workers.
+const WORKER_PRIORITY: u8 = 50;
+
+/// A unit of work, resolved and validated in the submitter's context.
+pub enum Op {
+    /// Open `path` (absolute) with the submitter's identity.
+    Open { path: String, flags: FileFlags, cloexec: bool, uid: u16, gid: u16 },
+    /// Read up to `len` bytes at the file position.  `file` holds a VFS reference.
+    Read { file: u32, len: usize },
+    /// Write `data` at the file position.  `file` holds a VFS reference.
+    Write { file: u32, data: Vec<u8> },
+    /// Stat an absolute path.
+    Stat { path: String },
+    /// Drop the VFS reference of an fd already removed from the fd table.
+    Close { file: u32 },
+    TcpSend { socket: u32, data: Vec<u8>, timeout_ticks: u32 },
+    TcpRecv { socket: u32, len: usize, timeout_ticks: u32 },
+}
+
+/// Result of an [`Op`], turned into a CQE by the syscall layer.
+pub enum Output {
+    /// Final result code: byte count, 0, or an error code.
+    Code(u32),
+    /// File system error, mapped to an errno when posted.
+    Fs(FsError),
+    /// Bytes for the submission's buffer.
+    Data(Vec<u8>),
+    /// STAT result for the submission's stat buffer.
+    Stat(StatResult),
+    /// New VFS slot; the fd is allocated when the completion is posted.
+    Opened { file: u32, cloexec: bool },
+}
+
+impl Output {
+    /// Release kernel resources of a completion that is never posted.
+    fn discard(self) {
+        if let Output::Opened { file, .. } = self {
+            crate::fs::vfs::decref(file);
+        }
+    }
+}
+
+/// A finished operation waiting to be posted.
+pub struct Completion {
+    pub user_data: u64,
+    /// User buffer named by the submission (READ / TCP_RECV / STAT).
+    pub addr: u64,
+    pub output: Output,
+}
+
+struct Job {
+    ring: u32,
+    user_data: u64,
+    addr: u64,
+    op: Op,
+}
+
+struct IoRing {
+    id: u32,
+    /// Open fds referring to this ring.
+    refs: u32,
+    /// Page directory of the creating process; only it may enter the ring.
+    owner_pd: u64,
+    /// User address and geometry of the shared ring memory.
+    region: u64,
+    sq_entries: u32,
+    cq_entries: u32,
+    /// Operations queued or running.
+    inflight: u32,
+    done: VecDeque<Completion>,
+    /// TID blocked in [`wait`] (0 = none).
+    waiter: u32,
+}
+
+/// Geometry of a ring's user memory, as registered at setup.
+#[derive(Clone, Copy)]
+pub struct Region {
+    pub addr: u64,
+    pub sq_entries: u32,
+    pub cq_entries: u32,
+}
+
+struct Queue {
+    jobs: VecDeque<Job>,
+    /// TIDs of idle workers.
+    idle: Vec<u32>,
+}
+
+static RINGS: Spinlock<Vec<IoRing>> = Spinlock::new(Vec::new());
+static QUEUE: Spinlock<Queue> = Spinlock::new(Queue { jobs: VecDeque::new(), idle: Vec::new() });
+static NEXT_ID: AtomicU32 = AtomicU32::new(1);
+static WORKERS_STARTED: AtomicBool = AtomicBool::new(false);
+
+fn wake(tid: u32) {
+    if !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
+
+/// Create a ring over the user memory `region` with one reference.
+/// Returns its id.
+pub fn create(region: Region, owner_pd: u64) -> u32 {
+    if !WORKERS_STARTED.swap(true, Ordering::AcqRel) {
+        for _ in 0..WORKERS {
+            scheduler::spawn(worker, WORKER_PRIORITY, "io_worker");
+        }
+    }
+    let id = NEXT_ID.fetch_add(1, Ordering::Relaxed);
+    RINGS.lock().push(IoRing {
+        id,
+        refs: 1,
+        owner_pd,
+        region: region.addr,
+        sq_entries: region.sq_entries,
+        cq_entries: region.cq_entries,
+        inflight: 0,
+        done: VecDeque::new(),
+        waiter: 0,
+    });
+    id
+}
+
+/// Add a reference (fd dup/fork).
+pub fn incref(ring_id: u32) {
+    if let Some(r) = RINGS.lock().iter_mut().find(|r| r.id == ring_id) {
+        r.refs += 1;
+    }
+}
+
+/// Drop a reference; the ring is destroyed with its last fd.  Operations
+/// still running finish and their results are discarded.
+pub fn decref(ring_id: u32) {
+    let ring = {
+        let mut rings = RINGS.lock();
+        let pos = match rings.iter().position(|r| r.id == ring_id) {
+            Some(p) => p,
+            None => return,
+        };
+        rings[pos].refs = rings[pos].refs.saturating_sub(1);
+        if rings[pos].refs > 0 {
+            return;
+        }
+        rings.swap_remove(pos)
+    };
+    if ring.waiter != 0 {
+        wake(ring.waiter);
+    }
+    for c in ring.done {
+        c.output.discard();
+    }
+}
+
+/// The ring's user memory, if `pd` is the address space that created it.
+pub fn region(ring_id: u32, pd: u64) -> Option<Region> {
+    let rings = RINGS.lock();
+    let r = rings.iter().find(|r| r.id == ring_id && r.owner_pd == pd)?;
+    Some(Region { addr: r.region, sq_entries: r.sq_entries, cq_entries: r.cq_entries })
+}
+
+/// Reserve room for one more operation.  Returns `false` when the ring
+/// already holds `cq_entries` unposted operations.
+pub fn reserve(ring_id: u32) -> bool {
+    let mut rings = RINGS.lock();
+    match rings.iter_mut().find(|r| r.id == ring_id) {
+        Some(r) if r.inflight + (r.done.len() as u32) < r.cq_entries => {
+            r.inflight += 1;
+            true
+        }
+        _ => false,
+    }
+}
+
+/// Queue a reserved operation for the workers.
+pub fn submit(ring_id: u32, user_data: u64, addr: u64, op: Op) {
+    let idle = {
+        let mut q = QUEUE.lock();
+        q.jobs.push_back(Job { ring: ring_id, user_data, addr, op });
+        q.idle.pop()
+    };
+    if let Some(tid) = idle {
+        scheduler::wake_thread(tid);
+    }
+}
+
+/// Finish a reserved operation with `output`, waking the ring's waiter.
+pub fn complete(ring_id: u32, user_data: u64, addr: u64, output: Output) {
+    let waiter = {
+        let mut rings = RINGS.lock();
+        match rings.iter_mut().find(|r| r.id == ring_id) {
+            Some(r) => {
+                r.inflight = r.inflight.saturating_sub(1);
+                r.done.push_back(Completion { user_data, addr, output });
+                core::mem::replace(&mut r.waiter, 0)
+            }
+            None => {
+                // Ring closed while the operation ran
+                drop(rings);
+                output.discard();
+                return;
+            }
+        }
+    };
+    if waiter != 0 {
+        wake(waiter);
+    }
+    poll_set::notify(Key::Ring(ring_id));
+}
+
+/// Take the oldest finished operation for posting.
+pub fn take_completion(ring_id: u32) -> Option<Completion> {
+    RINGS.lock().iter_mut().find(|r| r.id == ring_id)?.done.pop_front()
+}
+
+/// True if finished operations are waiting to be posted.
+pub fn has_completions(ring_id: u32) -> bool {
+    RINGS.lock().iter().find(|r| r.id == ring_id).map_or(false, |r| !r.done.is_empty())
+}
+
+/// Block until `count` operations have finished, none are left in flight,
+/// or `timeout_ms` expires (`u32::MAX` = no timeout).
+///
+/// **Must be called from a syscall context** (not from IRQ handler).
+pub fn wait(ring_id: u32, count: u32, timeout_ms: u32) {
+    let hz = crate::arch::hal::timer_frequency_hz() as u64;
+    let deadline = match timeout_ms {
+        u32::MAX => None,
+        ms => Some(crate::arch::hal::timer_current_ticks()
+            .wrapping_add(((ms as u64 * hz / 1000) as u32).max(1))),
+    };
+    loop {
+        {
+            let mut rings = RINGS.lock();
+            let r = match rings.iter_mut().find(|r| r.id == ring_id) {
+                Some(r) => r,
+                None => return,
+            };
+            if r.done.len() as u32 >= count || r.inflight == 0 {
+                return;
+            }
+            if let Some(d) = deadline {
+                if d.wrapping_sub(crate::arch::hal::timer_current_ticks()) as i32 <= 0 {
+                    return;
+                }
+            }
+            // Published under RINGS: `complete` either ran before and we
+            // saw its result, or it finds our TID once we are Blocked.
+            r.waiter = scheduler::current_tid();
+            scheduler::prepare_block_current(deadline);
+        }
+        scheduler::schedule();
+        if let Some(r) = RINGS.lock().iter_mut().find(|r| r.id == ring_id) {
+            if r.waiter == scheduler::current_tid() {
+                r.waiter = 0;
+            }
+        }
+    }
+}
+
+/// Entry point of the `io_worker` kernel threads.
+extern "C" fn worker() {
+    let tid = scheduler::current_tid();
+    loop {
+        let job = {
+            let mut q = QUEUE.lock();
+            match q.jobs.pop_front() {
+                Some(job) => job,
+                None => {
+                    // Published under QUEUE: `submit` pops our TID after
+                    // pushing a job and wakes us once we are Blocked.
+                    q.idle.push(tid);
+                    scheduler::prepare_block_current(None);
+                    drop(q);
+                    scheduler::schedule();
+                    continue;
+                }
+            }
+        };
+        let output = execute(job.op);
+        complete(job.ring, job.user_data, job.addr, output);
+    }
+}
+
+fn execute(op: Op) -> Output {
+    use crate::fs::vfs;
+    match op {
+        Op::Open { path, flags, cloexec, uid, gid } => {
+            use crate::fs::permissions::*;
+            if let Ok((f_uid, f_gid, mode)) = vfs::get_permissions(&path) {
+                let needed = if flags.write { PERM_READ | PERM_MODIFY } else { PERM_READ };
+                if !check_permission_as(uid, gid, f_uid, f_gid, mode, needed) {
+                    return Output::Code(u32::MAX);
+                }
+            } else if flags.create {
+                if let Some(parent) = path.rfind('/') {
+                    let parent_path = if parent == 0 { "/" } else { &path[..parent] };
+                    if let Ok((f_uid, f_gid, mode)) = vfs::get_permissions(parent_path) {
+                        if !check_permission_as(uid, gid, f_uid, f_gid, mode, PERM_CREATE) {
+                            return Output::Code(u32::MAX);
+                        }
+                    }
+                }
+            }
+            match vfs::open(&path, flags) {
+                Ok(file) => Output::Opened { file, cloexec },
+                Err(e) => Output::Fs(e),
+            }
+        }
+        Op::Read { file, len } => {
+            let mut buf = alloc::vec![0u8; len];
+            let res = vfs::read(file, &mut buf);
+            vfs::decref(file);
+            match res {
+                Ok(n) => {
+                    buf.truncate(n);
+                    Output::Data(buf)
+                }
+                Err(e) => Output::Fs(e),
+            }
+        }
+        Op::Write { file, data } => {
+            let res = vfs::write(file, &data);
+            vfs::decref(file);
+            match res {
+                Ok(n) => Output::Code(n as u32),
+                Err(e) => Output::Fs(e),
+            }
+        }
+        Op::Stat { path } => match vfs::stat(&path) {
+            Ok(st) => Output::Stat(st),
+            Err(e) => Output::Fs(e),
+        },
+        Op::Close { file } => {
+            vfs::decref(file);
+            Output::Code(0)
+        }
+        Op::TcpSend { socket, data, timeout_ticks } => {
+            Output::Code(crate::net::tcp::send(socket, &data, timeout_ticks))
+        }
+        Op::TcpRecv { socket, len, timeout_ticks } => {
+            let mut buf = alloc::vec![0u8; len];
+            match crate::net::tcp::recv(socket, &mut buf, timeout_ticks) {
+                n if n as usize <= len => {
+                    buf.truncate(n as usize);
+                    Output::Data(buf)
+                }
+                err => Output::Code(err),
+            }
+        }
+    }
+}
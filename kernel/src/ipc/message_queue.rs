@@ -3,7 +3,13 @@
 //! Each queue holds up to [`MAX_QUEUE_DEPTH`] messages of at most [`MAX_MSG_SIZE`] bytes.
 //! Sending is non-blocking (returns false if full); receiving is non-blocking (returns None
 //! if empty). Thread-safe via an internal spinlock.
+//!
+//! Larger payloads travel as a shared-memory grant: the message names a region
+//! the sender owns, sending hands it over ([`shared_memory::grant`]) and
+//! receiving maps it into the receiver ([`shared_memory::claim`]), so the
+//! bytes themselves are never copied.
 
+use crate::ipc::shared_memory;
 use crate::sync::spinlock::Spinlock;
 use alloc::collections::VecDeque;
 use alloc::vec::Vec;
@@ -22,6 +28,24 @@ pub struct Message {
     pub msg_type: u32,
     /// Variable-length payload (up to [`MAX_MSG_SIZE`] bytes).
     pub data: Vec<u8>,
+    /// SHM region handed to the receiver with the message (0 = none).
+    pub grant: u32,
+    /// Where the granted region was mapped in the receiver (set by
+    /// [`MessageQueue::receive`]; 0 if the grant could not be claimed).
+    pub grant_addr: u64,
+}
+
+impl Message {
+    /// Message with an inline payload only.
+    pub fn new(sender_pid: u32, msg_type: u32, data: Vec<u8>) -> Self {
+        Message { sender_pid, msg_type, data, grant: 0, grant_addr: 0 }
+    }
+
+    /// Message carrying the shared memory region `shm_id`, which the sender
+    /// must own.
+    pub fn with_grant(sender_pid: u32, msg_type: u32, shm_id: u32) -> Self {
+        Message { sender_pid, msg_type, data: Vec::new(), grant: shm_id, grant_addr: 0 }
+    }
 }
 
 /// Thread-safe bounded message queue protected by a spinlock.
@@ -45,13 +69,25 @@ impl MessageQueue {
         }
     }
 
-    /// Send a message. Returns false if queue is full.
+    /// Send a message. Returns false if queue is full, the payload is too
+    /// large, or the caller does not own the granted region.
+    ///
+    /// A grant is handed over before the message is queued, so call from the
+    /// sender's syscall context with no spinlock held.
     pub fn send(&self, msg: Message) -> bool {
-        let mut inner = self.inner.lock();
-        if inner.messages.len() >= inner.max_depth {
+        if msg.data.len() > MAX_MSG_SIZE || self.message_count() >= MAX_QUEUE_DEPTH {
             return false;
         }
-        if msg.data.len() > MAX_MSG_SIZE {
+        if msg.grant != 0 {
+            let tid = crate::task::scheduler::current_tid();
+            if !shared_memory::grant(msg.grant, tid) {
+                return false;
+            }
+        }
+        let mut inner = self.inner.lock();
+        // Lost a race for the last slot: a granted region is released by the
+        // grant timeout.
+        if inner.messages.len() >= inner.max_depth {
             return false;
         }
         inner.messages.push_back(msg);
@@ -59,9 +95,14 @@ impl MessageQueue {
     }
 
     /// Receive a message (non-blocking). Returns None if empty.
+    ///
+    /// A granted region is claimed for, and mapped into, the calling process.
     pub fn receive(&self) -> Option<Message> {
-        let mut inner = self.inner.lock();
-        inner.messages.pop_front()
+        let mut msg = self.inner.lock().messages.pop_front()?;
+        if msg.grant != 0 {
+            msg.grant_addr = shared_memory::claim(msg.grant);
+        }
+        Some(msg)
     }
 
     /// Check if there are pending messages.
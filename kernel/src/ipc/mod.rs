@@ -1,11 +1,16 @@
 //! Inter-process communication primitives.
 //!
 //! Provides named pipes, a system/module event bus, POSIX-style signals,
-//! shared memory regions, and message queues for kernel and user-space IPC.
+//! shared memory regions, message queues, futexes, readiness wait sets and
+//! asynchronous I/O rings for kernel and user-space IPC.
 
 pub mod anon_pipe;
 pub mod event_bus;
+pub mod event_ring;
+pub mod futex;
+pub mod io_ring;
 pub mod message_queue;
 pub mod pipe;
+pub mod poll_set;
 pub mod shared_memory;
 pub mod signal;
@@ -0,0 +1,510 @@
+//! Readiness notification: epoll-style wait sets.
+//!
+//! A wait set is a kernel object reached through an fd of kind
+//! `FdKind::PollSet`.  It holds a list of interests -- TCP sockets (connected
+//! or listening), bound UDP ports, anonymous pipe ends, event-bus channel
+//! subscriptions and I/O rings with completions to collect.  [`wait`] is level-triggered: it evaluates every interest
+//! and returns the ready ones; only if none is ready does the thread block,
+//! until a source notifies, the timeout expires or a safety slice elapses.
+//! libc `poll`/`select` use [`wait_oneshot`], a temporary set built from the
+//! call's arguments, so a call costs one syscall however many fds it watches.
+//!
+//! Sources call [`notify`] with their [`Key`] after every state change that
+//! can make an interest ready (data queued, buffer space freed, connection
+//! established or reset, event emitted).  TCP and UDP input run in the NIC IRQ
+//! handler, so `notify` never allocates, holds only the `SETS` spinlock, and
+//! wakes with `try_wake_thread`, deferring to the next tick when the
+//! scheduler lock is contended.
+//!
+//! A wake-up cannot be lost: a waiter samples its set's generation before
+//! evaluating readiness, and publishes itself and marks itself Blocked
+//! (`prepare_block_current`) under `SETS` only if the generation is
+//! unchanged.  `notify` bumps the generation under the same lock, so it
+//! either runs first (the waiter re-evaluates) or finds the waiter.
+//!
+//! Lock order: SETS → SCHEDULER.  Sources notify after dropping their own locks.
+
+use crate::sync::spinlock::Spinlock;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// Interest kinds (`PollItem::kind`).
+/// TCP socket or listener; `id` = socket id.
+pub const POLL_TCP: u32 = 1;
+/// Bound UDP port; `id` = port.
+pub const POLL_UDP: u32 = 2;
+/// File descriptor; `id` = fd.  Pipe ends are tracked, files and Tty are always ready.
+pub const POLL_FD: u32 = 3;
+/// Event-bus channel subscription; `id` = channel id, `aux` = subscription id.
+pub const POLL_CHAN: u32 = 4;
+
+/// `ctl` operations.
+pub const POLL_CTL_ADD: u32 = 1;
+pub const POLL_CTL_MOD: u32 = 2;
+pub const POLL_CTL_DEL: u32 = 3;
+
+/// Event bits (same values as `<poll.h>`).
+pub const POLLIN: u16 = 0x001;
+pub const POLLOUT: u16 = 0x004;
+pub const POLLERR: u16 = 0x008;
+pub const POLLHUP: u16 = 0x010;
+pub const POLLNVAL: u16 = 0x020;
+
+/// Size of a [`PollItem`] in user memory.
+pub const ITEM_SIZE: usize = 24;
+
+/// Threads that may block on one set at a time; further waiters fall back
+/// to the safety slice.
+const MAX_WAITERS: usize = 4;
+
+/// Longest block while watching TCP/UDP.  NIC interrupts wake waiters at
+/// once; the slice drives `net::poll` for TCP retransmissions and for
+/// devices without RX interrupts (CDC-ECM), as the old libc poll loop did.
+const NET_SLICE_MS: u32 = 10;
+/// Longest block otherwise: re-evaluate in case a deferred wake was dropped.
+const IDLE_SLICE_MS: u32 = 1000;
+
+/// One interest as exchanged with user space (24 bytes, little-endian):
+/// `kind:u32, id:u32, aux:u32, events:u16, revents:u16, data:u64`.
+#[derive(Clone, Copy)]
+pub struct PollItem {
+    pub kind: u32,
+    pub id: u32,
+    pub aux: u32,
+    pub events: u16,
+    pub revents: u16,
+    /// Caller's cookie, returned unchanged with the item.
+    pub data: u64,
+}
+
+impl PollItem {
+    /// Decode an item from its user-memory representation.
+    pub fn read(b: &[u8]) -> Self {
+        let u32_at = |o: usize| u32::from_le_bytes([b[o], b[o + 1], b[o + 2], b[o + 3]]);
+        let u16_at = |o: usize| u16::from_le_bytes([b[o], b[o + 1]]);
+        let mut data = [0u8; 8];
+        data.copy_from_slice(&b[16..24]);
+        PollItem {
+            kind: u32_at(0),
+            id: u32_at(4),
+            aux: u32_at(8),
+            events: u16_at(12),
+            revents: u16_at(14),
+            data: u64::from_le_bytes(data),
+        }
+    }
+
+    /// Encode the item into its user-memory representation.
+    pub fn write(&self, b: &mut [u8]) {
+        b[0..4].copy_from_slice(&self.kind.to_le_bytes());
+        b[4..8].copy_from_slice(&self.id.to_le_bytes());
+        b[8..12].copy_from_slice(&self.aux.to_le_bytes());
+        b[12..14].copy_from_slice(&self.events.to_le_bytes());
+        b[14..16].copy_from_slice(&self.revents.to_le_bytes());
+        b[16..24].copy_from_slice(&self.data.to_le_bytes());
+    }
+
+    fn same_source(&self, other: &PollItem) -> bool {
+        self.kind == other.kind && self.id == other.id && self.aux == other.aux
+    }
+}
+
+/// Notification key of an event source.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum Key {
+    Tcp(u32),
+    Udp(u16),
+    Pipe(u32),
+    Chan(u32),
+    Ring(u32),
+}
+
+/// What an interest watches, resolved when it is added.
+#[derive(Clone, Copy)]
+enum Target {
+    Tcp(u32),
+    Udp(u16),
+    PipeRead(u32),
+    PipeWrite(u32),
+    Chan(u32, u32),
+    Ring(u32),
+    /// Regular file or Tty: always readable and writable.
+    Always,
+    /// Bad fd or kind: reports POLLNVAL.
+    Invalid,
+}
+
+impl Target {
+    fn key(&self) -> Option<Key> {
+        match *self {
+            Target::Tcp(id) => Some(Key::Tcp(id)),
+            Target::Udp(port) => Some(Key::Udp(port)),
+            Target::PipeRead(p) | Target::PipeWrite(p) => Some(Key::Pipe(p)),
+            Target::Chan(c, _) => Some(Key::Chan(c)),
+            Target::Ring(r) => Some(Key::Ring(r)),
+            Target::Always | Target::Invalid => None,
+        }
+    }
+
+    fn is_net(&self) -> bool {
+        matches!(self, Target::Tcp(_) | Target::Udp(_))
+    }
+
+    /// Resolve `item` in the calling thread's context.
+    fn resolve(item: &PollItem) -> Target {
+        use crate::fs::fd_table::FdKind;
+        match item.kind {
+            POLL_TCP => Target::Tcp(item.id),
+            POLL_UDP if item.id <= 0xFFFF => Target::Udp(item.id as u16),
+            POLL_CHAN => Target::Chan(item.id, item.aux),
+            POLL_FD => match crate::task::scheduler::current_fd_get(item.id) {
+                Some(e) => match e.kind {
+                    FdKind::PipeRead { pipe_id } => Target::PipeRead(pipe_id),
+                    FdKind::PipeWrite { pipe_id } => Target::PipeWrite(pipe_id),
+                    FdKind::IoRing { ring_id } => Target::Ring(ring_id),
+                    FdKind::File { .. } | FdKind::Tty => Target::Always,
+                    FdKind::PollSet { .. } | FdKind::None => Target::Invalid,
+                },
+                // 0-2 of kernel-spawned threads without an FD table
+                None if item.id < 3 => Target::Always,
+                None => Target::Invalid,
+            },
+            _ => Target::Invalid,
+        }
+    }
+}
+
+#[derive(Clone, Copy)]
+struct Interest {
+    item: PollItem,
+    target: Target,
+}
+
+struct PollSet {
+    id: u32,
+    /// Open fds referring to this set (0 for one-shot sets).
+    refs: u32,
+    interests: Vec<Interest>,
+    /// Bumped by every notification that concerns one of the interests.
+    generation: u32,
+    /// TIDs blocked in `wait` (0 = free slot).
+    waiters: [u32; MAX_WAITERS],
+}
+
+static SETS: Spinlock<Vec<PollSet>> = Spinlock::new(Vec::new());
+static NEXT_ID: AtomicU32 = AtomicU32::new(1);
+/// Interests with a notification key, system-wide; 0 keeps [`notify`] to a
+/// single load.
+static WATCHED: AtomicU32 = AtomicU32::new(0);
+
+fn keyed(interests: &[Interest]) -> u32 {
+    interests.iter().filter(|i| i.target.key().is_some()).count() as u32
+}
+
+fn wake(tid: u32) {
+    if !crate::task::scheduler::try_wake_thread(tid) {
+        crate::task::scheduler::deferred_wake(tid);
+    }
+}
+
+/// Create an empty wait set with one reference.  Returns its id.
+pub fn create() -> u32 {
+    let id = NEXT_ID.fetch_add(1, Ordering::Relaxed);
+    SETS.lock().push(PollSet {
+        id,
+        refs: 1,
+        interests: Vec::new(),
+        generation: 0,
+        waiters: [0; MAX_WAITERS],
+    });
+    id
+}
+
+/// Add a reference (fd dup/fork).
+pub fn incref(set_id: u32) {
+    if let Some(set) = SETS.lock().iter_mut().find(|s| s.id == set_id) {
+        set.refs += 1;
+    }
+}
+
+/// Drop a reference; the set is destroyed with its last fd.  Threads still
+/// waiting on it return with no events.
+pub fn decref(set_id: u32) {
+    let waiters;
+    {
+        let mut sets = SETS.lock();
+        let pos = match sets.iter().position(|s| s.id == set_id) {
+            Some(p) => p,
+            None => return,
+        };
+        sets[pos].refs = sets[pos].refs.saturating_sub(1);
+        if sets[pos].refs > 0 {
+            return;
+        }
+        let set = sets.swap_remove(pos);
+        WATCHED.fetch_sub(keyed(&set.interests), Ordering::Relaxed);
+        waiters = set.waiters;
+    }
+    for &tid in waiters.iter().filter(|&&t| t != 0) {
+        wake(tid);
+    }
+}
+
+/// Add, modify or remove the interest `item` of set `set_id`.  Interests are
+/// identified by `(kind, id, aux)`.  Returns `false` if the set does not
+/// exist, ADD finds the source already present, or MOD/DEL do not find it.
+pub fn ctl(set_id: u32, op: u32, item: PollItem) -> bool {
+    let target = Target::resolve(&item);
+    let mut sets = SETS.lock();
+    let set = match sets.iter_mut().find(|s| s.id == set_id) {
+        Some(s) => s,
+        None => return false,
+    };
+    let pos = set.interests.iter().position(|i| i.item.same_source(&item));
+    match (op, pos) {
+        (POLL_CTL_ADD, None) => {
+            if target.key().is_some() {
+                WATCHED.fetch_add(1, Ordering::Relaxed);
+            }
+            set.interests.push(Interest { item, target });
+        }
+        (POLL_CTL_MOD, Some(p)) => {
+            set.interests[p].item.events = item.events;
+            set.interests[p].item.data = item.data;
+        }
+        (POLL_CTL_DEL, Some(p)) => {
+            let old = set.interests.swap_remove(p);
+            if old.target.key().is_some() {
+                WATCHED.fetch_sub(1, Ordering::Relaxed);
+            }
+        }
+        _ => return false,
+    }
+    // Let a concurrent waiter pick up the changed interest list.
+    set.generation = set.generation.wrapping_add(1);
+    true
+}
+
+/// Wait for interests of set `set_id` to become ready.  Up to `out.len()`
+/// ready items (with `revents` set) are stored in `out`; returns how many,
+/// 0 on timeout, or `None` if the set does not exist.
+///
+/// `timeout_ms == u32::MAX` waits indefinitely.
+///
+/// **Must be called from a syscall context** (not from IRQ handler).
+pub fn wait(set_id: u32, out: &mut [PollItem], timeout_ms: u32) -> Option<usize> {
+    let (interests, ready) = wait_ready(set_id, timeout_ms)?;
+    let n = ready.len().min(out.len());
+    for (slot, &(idx, revents)) in out.iter_mut().zip(ready.iter()) {
+        *slot = interests[idx].item;
+        slot.revents = revents;
+    }
+    Some(n)
+}
+
+/// `poll(2)` semantics: wait on a temporary set made of `items` and set each
+/// item's `revents`.  Returns the number of items with events.
+///
+/// **Must be called from a syscall context** (not from IRQ handler).
+pub fn wait_oneshot(items: &mut [PollItem], timeout_ms: u32) -> usize {
+    let interests: Vec<Interest> = items.iter()
+        .map(|item| Interest { item: *item, target: Target::resolve(item) })
+        .collect();
+    let id = NEXT_ID.fetch_add(1, Ordering::Relaxed);
+    WATCHED.fetch_add(keyed(&interests), Ordering::Relaxed);
+    SETS.lock().push(PollSet {
+        id,
+        refs: 0,
+        interests,
+        generation: 0,
+        waiters: [0; MAX_WAITERS],
+    });
+
+    let ready = wait_ready(id, timeout_ms);
+
+    {
+        let mut sets = SETS.lock();
+        if let Some(pos) = sets.iter().position(|s| s.id == id) {
+            let set = sets.swap_remove(pos);
+            WATCHED.fetch_sub(keyed(&set.interests), Ordering::Relaxed);
+        }
+    }
+
+    for item in items.iter_mut() {
+        item.revents = 0;
+    }
+    match ready {
+        Some((_, ready)) => {
+            for &(idx, revents) in ready.iter() {
+                items[idx].revents = revents;
+            }
+            ready.len()
+        }
+        None => 0,
+    }
+}
+
+/// Report a state change of `key` to every set watching it.  IRQ-safe.
+pub fn notify(key: Key) {
+    if WATCHED.load(Ordering::Relaxed) == 0 {
+        return;
+    }
+    let mut tids = [0u32; 8];
+    let mut n = 0;
+    {
+        let mut sets = SETS.lock();
+        for set in sets.iter_mut() {
+            if !set.interests.iter().any(|i| i.target.key() == Some(key)) {
+                continue;
+            }
+            set.generation = set.generation.wrapping_add(1);
+            for t in set.waiters.iter_mut() {
+                if *t != 0 && n < tids.len() {
+                    tids[n] = *t;
+                    n += 1;
+                    *t = 0;
+                }
+            }
+        }
+    }
+    for &tid in &tids[..n] {
+        wake(tid);
+    }
+}
+
+/// Block until at least one interest of `set_id` is ready or the timeout
+/// expires.  Returns the interests evaluated last and the `(index, revents)`
+/// of the ready ones.
+fn wait_ready(set_id: u32, timeout_ms: u32) -> Option<(Vec<Interest>, Vec<(usize, u16)>)> {
+    let hz = crate::arch::hal::timer_frequency_hz() as u64;
+    let ms_to_ticks = |ms: u32| ((ms as u64 * hz / 1000) as u32).max(1);
+    let start = crate::arch::hal::timer_current_ticks();
+    let deadline = match timeout_ms {
+        u32::MAX => None,
+        0 => Some(start),
+        ms => Some(start.wrapping_add(ms_to_ticks(ms))),
+    };
+    let tid = crate::task::scheduler::current_tid();
+
+    loop {
+        let (generation, interests) = {
+            let sets = SETS.lock();
+            let set = sets.iter().find(|s| s.id == set_id)?;
+            (set.generation, set.interests.clone())
+        };
+
+        let net = interests.iter().any(|i| i.target.is_net());
+        if net {
+            crate::net::poll();
+        }
+        let mut ready = Vec::new();
+        for (idx, interest) in interests.iter().enumerate() {
+            let revents = readiness(&interest.target, interest.item.events);
+            if revents != 0 {
+                ready.push((idx, revents));
+            }
+        }
+        if !ready.is_empty() {
+            return Some((interests, ready));
+        }
+
+        let now = crate::arch::hal::timer_current_ticks();
+        let remaining = match deadline {
+            Some(d) => {
+                let left = d.wrapping_sub(now) as i32;
+                if left <= 0 {
+                    return Some((interests, ready));
+                }
+                left as u32
+            }
+            None => u32::MAX,
+        };
+        let slice = ms_to_ticks(if net { NET_SLICE_MS } else { IDLE_SLICE_MS });
+        let wake_at = now.wrapping_add(remaining.min(slice));
+
+        {
+            let mut sets = SETS.lock();
+            let set = sets.iter_mut().find(|s| s.id == set_id)?;
+            if set.generation != generation {
+                continue; // something changed since we sampled: re-evaluate
+            }
+            if let Some(slot) = set.waiters.iter_mut().find(|t| **t == 0) {
+                *slot = tid;
+            }
+            crate::task::scheduler::prepare_block_current(Some(wake_at));
+        }
+        crate::task::scheduler::schedule();
+
+        // notify clears our slot before waking us; after a timeout it is still set.
+        if let Some(set) = SETS.lock().iter_mut().find(|s| s.id == set_id) {
+            for t in set.waiters.iter_mut().filter(|t| **t == tid) {
+                *t = 0;
+            }
+        }
+    }
+}
+
+/// Current events of `target`, restricted to `events` plus the conditions
+/// that are always reported.
+fn readiness(target: &Target, events: u16) -> u16 {
+    let current = match *target {
+        Target::Tcp(id) => tcp_events(id),
+        Target::Udp(port) => match crate::net::udp::pending(port) {
+            Some(0) => POLLOUT,
+            Some(_) => POLLIN | POLLOUT,
+            None => POLLNVAL,
+        },
+        Target::PipeRead(p) => {
+            use crate::ipc::anon_pipe;
+            if anon_pipe::bytes_available(p) > 0 {
+                POLLIN
+            } else if anon_pipe::is_write_closed(p) {
+                POLLIN | POLLHUP
+            } else {
+                0
+            }
+        }
+        Target::PipeWrite(p) => {
+            use crate::ipc::anon_pipe;
+            if anon_pipe::is_read_closed(p) {
+                POLLERR
+            } else if anon_pipe::space_available(p) > 0 {
+                POLLOUT
+            } else {
+                0
+            }
+        }
+        Target::Chan(chan, sub) => {
+            if crate::ipc::event_bus::channel_has_events(chan, sub) { POLLIN } else { 0 }
+        }
+        Target::Ring(r) => {
+            if crate::ipc::io_ring::has_completions(r) { POLLIN } else { 0 }
+        }
+        Target::Always => POLLIN | POLLOUT,
+        Target::Invalid => POLLNVAL,
+    };
+    current & (events | POLLERR | POLLHUP | POLLNVAL)
+}
+
+fn tcp_events(id: u32) -> u16 {
+    use crate::net::tcp::{self, TcpState};
+    if let Some(pending) = tcp::accept_ready(id) {
+        return if pending { POLLIN } else { 0 };
+    }
+    let state = tcp::status(id);
+    if state == u32::MAX {
+        return POLLERR;
+    }
+    let mut ev = match tcp::recv_available(id) {
+        u32::MAX => POLLIN | POLLERR | POLLHUP, // reset
+        0 => 0,
+        _ => POLLIN, // data or EOF
+    };
+    if state == TcpState::Established as u32 || state == TcpState::CloseWait as u32 {
+        ev |= POLLOUT;
+    }
+    if state == TcpState::Closed as u32 {
+        ev |= POLLHUP;
+    }
+    ev
+}
@@ -4,6 +4,12 @@
 //! process address spaces. Reference counting ensures frames are freed only when
 //! all mappings are released and the owner has destroyed the region.
 //!
+//! A region can also be *granted*: its owner hands it over with [`grant`],
+//! losing its own mapping, and the next process to [`claim`] it becomes the
+//! owner with the pages mapped in one step.  Large payloads (clipboard data,
+//! images) move between processes this way with no copy and no
+//! sender-side guess about when the receiver is done.
+//!
 //! Virtual address allocation for SHM mappings starts at [`SHM_BASE`] (0x10000000)
 //! and bumps upward per-process, well above DLLs (0x04000000) and program code
 //! (0x08000000).
@@ -18,6 +24,19 @@ use alloc::vec::Vec;
 /// Base virtual address for SHM mappings in user processes.
 const SHM_BASE: u64 = 0x1000_0000;
 
+/// `owner_tid` of regions the kernel owns on behalf of a process (e.g. event
+/// rings): exiting processes never release them, only [`destroy`] does.
+pub const KERNEL_OWNER: u32 = u32::MAX;
+
+/// `owner_tid` of a granted region waiting for [`claim`].
+const GRANT_OWNER: u32 = u32::MAX - 1;
+
+/// Unclaimed grants are freed after this many milliseconds.
+const GRANT_TIMEOUT_MS: u64 = 5000;
+
+/// Buddy order of a 2 MiB block (512 frames).
+const HUGE_ORDER: usize = 9;
+
 /// Tracks where an SHM region is mapped in a specific process.
 struct ShmMapping {
     tid: u32,
@@ -41,6 +60,9 @@ pub struct SharedRegion {
     /// user CR3 context where physical frames above 64 MiB are not accessible
     /// via identity mapping.
     needs_zeroing: bool,
+    /// Tick after which an unclaimed grant is released (valid while
+    /// `owner_tid == GRANT_OWNER`).
+    grant_deadline: u32,
 }
 
 static SHARED_REGIONS: Spinlock<Vec<SharedRegion>> = Spinlock::new(Vec::new());
@@ -54,8 +76,23 @@ pub fn create(size: usize, owner_tid: u32) -> Option<u32> {
         return None;
     }
 
+    // Each whole 2 MiB stretch is one buddy block when available, so
+    // `map_into_current` can map it as a huge page (window surfaces of a
+    // full-screen window are several MiB).
     let mut frames = Vec::new();
-    for _ in 0..pages {
+    let mut try_huge = true;
+    while frames.len() < pages {
+        if try_huge && pages - frames.len() >= virtual_mem::PAGES_PER_HUGE_PAGE {
+            match physical::alloc_block(HUGE_ORDER) {
+                Some(block) => {
+                    for i in 0..virtual_mem::PAGES_PER_HUGE_PAGE {
+                        frames.push(PhysAddr::new(block.as_u64() + (i * FRAME_SIZE) as u64));
+                    }
+                    continue;
+                }
+                None => try_huge = false,
+            }
+        }
         match physical::alloc_frame() {
             Some(frame) => frames.push(frame),
             None => {
@@ -81,6 +118,7 @@ pub fn create(size: usize, owner_tid: u32) -> Option<u32> {
         owner_tid,
         mappings: Vec::new(),
         needs_zeroing: true,
+        grant_deadline: 0,
     };
 
     SHARED_REGIONS.lock().push(region);
@@ -108,14 +146,21 @@ pub fn map_into_current(region_id: u32) -> u64 {
     }
 
     // Find a free virtual address for this mapping
-    let vaddr = find_free_shm_addr(tid, &regions);
+    let vaddr = find_free_shm_addr(tid, regions[idx].size, &regions);
     let pages = regions[idx].physical_frames.len();
 
-    // Map each page into the current process's address space
-    for i in 0..pages {
+    // Map each page into the current process's address space, 2 MiB at a
+    // time where `create` got a whole block (Present + Writable + User).
+    let mut i = 0;
+    while i < pages {
         let frame = regions[idx].physical_frames[i];
         let va = VirtAddr::new(vaddr + (i * FRAME_SIZE) as u64);
-        virtual_mem::map_page(va, frame, 0x07); // Present + Writable + User
+        if is_huge_run(&regions[idx].physical_frames[i..]) && virtual_mem::map_huge_page(va, frame, 0x07) {
+            i += virtual_mem::PAGES_PER_HUGE_PAGE;
+            continue;
+        }
+        virtual_mem::map_page(va, frame, 0x07);
+        i += 1;
     }
 
     // Zero frames on first mapping to prevent information leaks.
@@ -141,37 +186,53 @@ pub fn map_into_current(region_id: u32) -> u64 {
 
 /// Unmap a shared memory region from the calling process's address space.
 ///
-/// Clears PTEs via recursive mapping on the current CR3. Physical frames are
-/// NOT freed here — they remain owned by the [`SharedRegion`] until the last
-/// mapping is removed and the owner has released the region.
+/// Clears PTEs via recursive mapping on the current CR3 and flushes them from
+/// other CPUs in one ranged shootdown. Physical frames are NOT freed here —
+/// they remain owned by the [`SharedRegion`] until the last mapping is
+/// removed and the owner has released the region.
 pub fn unmap_from_current(region_id: u32) -> bool {
     let tid = crate::task::scheduler::current_tid();
-    let mut regions = SHARED_REGIONS.lock();
-
-    let idx = match regions.iter().position(|r| r.id == region_id) {
-        Some(i) => i,
-        None => return false,
-    };
-
-    let mapping_pos = match regions[idx].mappings.iter().position(|m| m.tid == tid) {
-        Some(p) => p,
-        None => return false,
+    // The TLB shootdown waits for other CPUs, so it runs after the lock drops.
+    let (vaddr, pages, dead) = {
+        let mut regions = SHARED_REGIONS.lock();
+        match detach_mapping(&mut regions, region_id, tid) {
+            Some(t) => t,
+            None => return false,
+        }
     };
 
-    let vaddr = regions[idx].mappings[mapping_pos].vaddr;
-    let pages = regions[idx].physical_frames.len();
+    virtual_mem::unmap_range(VirtAddr::new(vaddr), pages);
 
-    // Clear PTEs in the current address space
-    for i in 0..pages {
-        virtual_mem::unmap_page(VirtAddr::new(vaddr + (i * FRAME_SIZE) as u64));
+    if let Some(region) = dead {
+        for frame in &region.physical_frames {
+            physical::free_frame(*frame);
+        }
     }
+    true
+}
 
-    regions[idx].mappings.remove(mapping_pos);
+/// Remove `tid`'s mapping of `region_id`, returning (vaddr, pages) and the
+/// region itself if that was its last user. Called with `SHARED_REGIONS` held.
+fn detach_mapping(
+    regions: &mut Vec<SharedRegion>,
+    region_id: u32,
+    tid: u32,
+) -> Option<(u64, usize, Option<SharedRegion>)> {
+    let idx = regions.iter().position(|r| r.id == region_id)?;
+    let mapping_pos = regions[idx].mappings.iter().position(|m| m.tid == tid)?;
 
-    // Free region if no mappings and no owner
-    maybe_free_region(&mut regions, idx);
+    let vaddr = regions[idx].mappings[mapping_pos].vaddr;
+    let pages = regions[idx].physical_frames.len();
+    regions[idx].mappings.remove(mapping_pos);
 
-    true
+    // Evict the region if no mappings and no owner remain; its frames are
+    // freed by the caller once the pages are unmapped everywhere.
+    let dead = if regions[idx].mappings.is_empty() && regions[idx].owner_tid == 0 {
+        Some(regions.remove(idx))
+    } else {
+        None
+    };
+    Some((vaddr, pages, dead))
 }
 
 /// Destroy a shared memory region (owner only).
@@ -201,6 +262,73 @@ pub fn destroy(region_id: u32, caller_tid: u32) -> bool {
     true
 }
 
+/// Hand a region over to whichever process claims it next (owner only).
+///
+/// The caller's own mapping is removed, so the region moves rather than
+/// being shared.  A grant nobody claims within [`GRANT_TIMEOUT_MS`] is
+/// released.  **Must be called with no spinlock held** (the unmap is a TLB
+/// shootdown).
+pub fn grant(region_id: u32, caller_tid: u32) -> bool {
+    let now = crate::arch::hal::timer_current_ticks();
+    let hz = crate::arch::hal::timer_frequency_hz() as u64;
+    let timeout = (GRANT_TIMEOUT_MS * hz / 1000).max(1) as u32;
+    {
+        let mut regions = SHARED_REGIONS.lock();
+        expire_grants(&mut regions, now);
+        let region = match regions.iter_mut().find(|r| r.id == region_id) {
+            Some(r) => r,
+            None => return false,
+        };
+        if region.owner_tid != caller_tid || caller_tid == KERNEL_OWNER {
+            return false;
+        }
+        region.owner_tid = GRANT_OWNER;
+        region.grant_deadline = now.wrapping_add(timeout);
+    }
+    unmap_from_current(region_id);
+    true
+}
+
+/// Take ownership of a granted region and map it into the calling process.
+///
+/// Returns the virtual address, or 0 if the region is not (or no longer)
+/// granted.  Only one claim succeeds per grant.
+pub fn claim(region_id: u32) -> u64 {
+    let tid = crate::task::scheduler::current_tid();
+    let now = crate::arch::hal::timer_current_ticks();
+    {
+        let mut regions = SHARED_REGIONS.lock();
+        expire_grants(&mut regions, now);
+        match regions.iter_mut().find(|r| r.id == region_id && r.owner_tid == GRANT_OWNER) {
+            Some(r) => r.owner_tid = tid,
+            None => return 0,
+        }
+    }
+    let vaddr = map_into_current(region_id);
+    if vaddr == 0 {
+        destroy(region_id, tid);
+    }
+    vaddr
+}
+
+/// Release grants whose deadline has passed.  Called with `SHARED_REGIONS`
+/// held; a granted region has no mappings, so it is freed on the spot.
+fn expire_grants(regions: &mut Vec<SharedRegion>, now: u32) {
+    let mut i = 0;
+    while i < regions.len() {
+        if regions[i].owner_tid == GRANT_OWNER
+            && now.wrapping_sub(regions[i].grant_deadline) as i32 >= 0
+        {
+            regions[i].owner_tid = 0;
+            if regions[i].mappings.is_empty() {
+                maybe_free_region(regions, i);
+                continue;
+            }
+        }
+        i += 1;
+    }
+}
+
 /// Return the size of a shared memory region in bytes, or 0 if not found.
 pub fn region_size(region_id: u32) -> usize {
     let regions = SHARED_REGIONS.lock();
@@ -211,6 +339,24 @@ pub fn region_size(region_id: u32) -> usize {
         .unwrap_or(0)
 }
 
+/// Return the first physical frame of a region, or `None` if not found.
+pub fn region_frame(region_id: u32) -> Option<PhysAddr> {
+    let regions = SHARED_REGIONS.lock();
+    regions.iter().find(|r| r.id == region_id)?.physical_frames.first().copied()
+}
+
+/// Return all physical frames of a region in page order (empty if not found).
+pub fn region_frames(region_id: u32) -> Vec<PhysAddr> {
+    let regions = SHARED_REGIONS.lock();
+    regions.iter().find(|r| r.id == region_id).map(|r| r.physical_frames.clone()).unwrap_or_default()
+}
+
+/// True if the region exists and is owned by [`KERNEL_OWNER`].
+pub fn is_kernel_owned(region_id: u32) -> bool {
+    let regions = SHARED_REGIONS.lock();
+    regions.iter().any(|r| r.id == region_id && r.owner_tid == KERNEL_OWNER)
+}
+
 /// Clean up all shared memory for a process that is exiting.
 ///
 /// **Must be called while the process's page directory is still active**
@@ -274,9 +420,7 @@ pub fn cleanup_process(tid: u32) {
     // Caller guarantees the dying process's CR3 is active, so unmap_page clears
     // the correct PTEs via recursive mapping.
     for &(vaddr, pages) in &unmap_buf[..n_unmap] {
-        for p in 0..pages {
-            virtual_mem::unmap_page(VirtAddr::new(vaddr + (p * FRAME_SIZE) as u64));
-        }
+        virtual_mem::unmap_range(VirtAddr::new(vaddr), pages);
     }
 
     // ── Phase 3 (no lock): free physical frames of evicted regions ──
@@ -332,11 +476,24 @@ pub fn is_shm_locked() -> bool {
     SHARED_REGIONS.is_locked()
 }
 
-/// Find a free virtual address for a new SHM mapping for the given TID.
+/// True if `frames` starts with a 2 MiB-aligned run of contiguous frames
+/// long enough for one huge page.
+fn is_huge_run(frames: &[PhysAddr]) -> bool {
+    let n = virtual_mem::PAGES_PER_HUGE_PAGE;
+    if frames.len() < n || frames[0].as_u64() & (virtual_mem::HUGE_PAGE_SIZE as u64 - 1) != 0 {
+        return false;
+    }
+    let base = frames[0].as_u64();
+    frames[..n].iter().enumerate().all(|(i, f)| f.as_u64() == base + (i * FRAME_SIZE) as u64)
+}
+
+/// Find a free virtual address for a new SHM mapping of `size` bytes for the
+/// given TID.
 ///
 /// Scans all existing mappings for this TID and returns the next page-aligned
-/// address above the highest existing mapping.
-fn find_free_shm_addr(tid: u32, regions: &[SharedRegion]) -> u64 {
+/// address above the highest existing mapping (2 MiB-aligned for regions
+/// large enough to use huge pages).
+fn find_free_shm_addr(tid: u32, size: usize, regions: &[SharedRegion]) -> u64 {
     let mut next = SHM_BASE;
     for region in regions {
         for mapping in &region.mappings {
@@ -348,6 +505,11 @@ fn find_free_shm_addr(tid: u32, regions: &[SharedRegion]) -> u64 {
             }
         }
     }
-    // Ensure page alignment (should already be, but safety)
-    (next + 0xFFF) & !0xFFF
+    let align = if size >= virtual_mem::HUGE_PAGE_SIZE {
+        virtual_mem::HUGE_PAGE_SIZE as u64
+    } else {
+        // Ensure page alignment (should already be, but safety)
+        FRAME_SIZE as u64
+    };
+    (next + align - 1) & !(align - 1)
 }
@@ -109,6 +109,7 @@ pub extern "C" fn kernel_main(boot_info_addr: u64) -> ! {
 
         arch::x86::cpuid::detect();
         arch::x86::cpuid::enable_smep();
+        memory::memops::init();
 
         arch::x86::pit::init();
         serial_println!("[OK] PIT configured at {} Hz", arch::x86::pit::TICK_HZ);
@@ -158,6 +159,8 @@ pub extern "C" fn kernel_main(boot_info_addr: u64) -> ! {
     }
     memory::heap::init();
     serial_println!("[OK] Heap allocator initialized");
+    memory::physical::init_frame_refs();
+    memory::virtual_mem::enable_write_protect();
 
     // Phase 4: Test heap allocation
     {
@@ -187,7 +190,9 @@ pub extern "C" fn kernel_main(boot_info_addr: u64) -> ! {
             arch::x86::smp::init_bsp();
             arch::x86::smp::register_halt_ipi();
             arch::x86::smp::register_tlb_shootdown_ipi();
+            arch::x86::lapic_timer::register_kick_ipi();
             arch::x86::syscall_msr::init_bsp();
+            arch::x86::pmu::init();
         } else {
             serial_println!("  ACPI not found, using legacy PIC");
         }
@@ -212,8 +217,8 @@ pub extern "C" fn kernel_main(boot_info_addr: u64) -> ! {
         drivers::pci::print_devices();
         drivers::boot_console::tick_spinner();
 
-        // Phase 5c: E1000 NIC + Network Stack
-        if drivers::network::e1000::init() {
+        // Phase 5c: NIC (VirtIO-Net, else E1000) + Network Stack
+        if drivers::network::virtio_net::init() || drivers::network::e1000::init() {
             net::init();
         }
         drivers::boot_console::tick_spinner();
@@ -341,8 +346,12 @@ pub extern "C" fn kernel_main(boot_info_addr: u64) -> ! {
                 arch::x86::smp::start_aps(&info.processors);
             }
         }
+        drivers::storage::nvme::enable_cpu_queues();
+        drivers::network::virtio_net::enable_cpu_queues();
+        drivers::pci::spread_irqs();
 
-        // Phase 8c: Load shared DLIBs
+        // Phase 8c: Shared time page and DLIBs (mapped into every process)
+        task::timepage::init();
         const DLLS: [(&str, u64); 4] = [
             ("/Libraries/uisys.dlib", 0x0400_0000u64),
             ("/Libraries/libimage.dlib", 0x0410_0000u64),
@@ -383,9 +392,15 @@ pub extern "C" fn kernel_main(boot_info_addr: u64) -> ! {
             arch::hal::disable_interrupts();
             task::scheduler::spawn(task::cpu_monitor::start, 10, "cpu_monitor");
             task::scheduler::spawn(drivers::usb::poll_thread, 50, "usb_poll");
+            task::scheduler::spawn(fs::writeback::flusher_thread, 40, "fs_flush");
+            task::scheduler::spawn(net::rx::rx_thread, 60, "net_rx");
+            task::scheduler::spawn(memory::zero_pool::zero_thread, 1, "zero_pages");
+            task::scheduler::spawn(memory::reclaim::reclaim_thread, 40, "kswapd");
+            drivers::hal::start_deferred_probes();
             #[cfg(feature = "debug_verbose")]
             task::scheduler::spawn(task::stress_test::stress_master, 30, "stress");
             drivers::boot_console::stop_spinner();
+            arch::x86::pit::retire_irq();
 
             match task::loader::load_and_run("/System/compositor/compositor", "compositor") {
                 Ok(tid) => serial_println!("[OK] Userspace compositor spawned (TID={})", tid),
@@ -0,0 +1,282 @@
+//! File-backed user mappings: demand paging from the page cache and
+//! write-back of shared mappings.
+//!
+//! Regions are recorded in the VMA registry with a [`FileBacking`].  Nothing
+//! is mapped up front: the first access to a page faults, the contents are
+//! read through `vfs::read_at` (page cache + readahead) with interrupts
+//! enabled, and a private frame holding them is installed.  Pages never
+//! alias page-cache frames, so unmap and exit free them like anonymous
+//! memory.  Dirty pages of `MAP_SHARED` regions are written back with
+//! `vfs::write_at` on `munmap` and process exit.
+//!
+//! Kernel code touching a not-yet-faulted page (a syscall copying from a
+//! user buffer) may hold the VFS lock, so syscalls prefault file-backed
+//! buffers through [`prefault`] before taking any locks.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, Ordering};
+use crate::memory::address::{PhysAddr, VirtAddr};
+use crate::memory::virtual_mem;
+use crate::memory::vma::{self, FileBacking, Vma};
+
+const PAGE_SIZE: u32 = 4096;
+/// PTE flags: PAGE_WRITABLE, PAGE_USER.
+const FLAG_WRITABLE: u32 = 0x02;
+const FLAG_USER: u32 = 0x04;
+
+/// Live file-backed regions system-wide; 0 keeps the fault and prefault
+/// hooks to a single load.
+static REGIONS: AtomicU32 = AtomicU32::new(0);
+
+/// Contents of a dirty shared page, copied out for write-back.
+pub struct DirtyPage {
+    slot: u32,
+    offset: u32,
+    data: Vec<u8>,
+}
+
+/// Whether any file-backed region exists.
+#[inline]
+pub fn active() -> bool {
+    REGIONS.load(Ordering::Relaxed) != 0
+}
+
+/// Map `len` bytes of the open file `slot` from `offset` into the mmap area
+/// of `pd`.  Bytes past `file_size` read as zeros.  Returns the address.
+pub fn map(
+    pd: PhysAddr, slot: u32, offset: u32, len: u32, file_size: u32,
+    writable: bool, shared: bool, exec: bool,
+) -> Option<u32> {
+    let size = len.checked_add(PAGE_SIZE - 1)? & !(PAGE_SIZE - 1);
+    let file = FileBacking {
+        slot,
+        offset,
+        file_len: file_size.saturating_sub(offset).min(len),
+        shared,
+        exec,
+    };
+    crate::fs::vfs::incref(slot);
+    match vma::alloc_file_region(pd, size, region_flags(writable), file) {
+        Some(addr) => {
+            REGIONS.fetch_add(1, Ordering::Relaxed);
+            Some(addr)
+        }
+        None => {
+            crate::fs::vfs::decref(slot);
+            None
+        }
+    }
+}
+
+/// Map a private file region at the fixed page-aligned address `start`
+/// (ELF segments).  `file_len` bytes come from `offset`, the rest of the
+/// `size` bytes is zero-filled.
+pub fn map_fixed(
+    pd: PhysAddr, start: u32, size: u32, slot: u32, offset: u32, file_len: u32,
+    writable: bool, exec: bool,
+) -> bool {
+    let file = FileBacking { slot, offset, file_len, shared: false, exec };
+    crate::fs::vfs::incref(slot);
+    if vma::insert_file_region(pd, start, size, region_flags(writable), file) {
+        REGIONS.fetch_add(1, Ordering::Relaxed);
+        true
+    } else {
+        crate::fs::vfs::decref(slot);
+        false
+    }
+}
+
+/// Resolve a not-present fault at `vaddr` in a file-backed region of the
+/// current process.  The interrupted context must have had IF=1 (user mode,
+/// or a syscall outside spinlocks): the page is read with interrupts on.
+///
+/// Returns `true` if the faulting access can be retried.
+pub fn handle_fault(vaddr: u64, write: bool) -> bool {
+    if !active() || vaddr >= 0x1_0000_0000 {
+        return false;
+    }
+    let pd = match crate::task::scheduler::current_thread_page_directory() {
+        Some(pd) => pd,
+        None => return false,
+    };
+    let vma = match vma::find_file_region(pd, vaddr as u32) {
+        Some(v) => v,
+        None => return false,
+    };
+    if write && vma.flags & FLAG_WRITABLE == 0 {
+        return false;
+    }
+    crate::arch::hal::enable_interrupts();
+    let ok = fill_page(&vma, vaddr as u32 & !(PAGE_SIZE - 1));
+    crate::arch::hal::disable_interrupts();
+    ok
+}
+
+/// Fault in every not-present file-backed page of the user buffer
+/// `[ptr, ptr + len)` so a syscall can access it under its locks.
+pub fn prefault(ptr: u64, len: u64) {
+    if !active() || len == 0 || !crate::arch::hal::interrupts_enabled() {
+        return;
+    }
+    let end = match ptr.checked_add(len) {
+        Some(e) if e <= 0x1_0000_0000 => e,
+        _ => return,
+    };
+    let mut regions: Option<Vec<Vma>> = None;
+    let mut page = ptr & !(PAGE_SIZE as u64 - 1);
+    while page < end {
+        if virtual_mem::read_pte(VirtAddr::new(page)) & 1 == 0 {
+            let list = regions.get_or_insert_with(|| {
+                match crate::task::scheduler::current_thread_page_directory() {
+                    Some(pd) => vma::file_regions(pd, page as u32, (end - page) as u32),
+                    None => Vec::new(),
+                }
+            });
+            if list.is_empty() {
+                return;
+            }
+            let p = page as u32;
+            if let Some(v) = list.iter().find(|v| p >= v.start && p - v.start < v.size) {
+                if !fill_page(v, p) {
+                    return;
+                }
+            }
+        }
+        page += PAGE_SIZE as u64;
+    }
+}
+
+/// Write back the dirty shared pages of `[addr, addr + size)` in the
+/// current address space (`munmap`, before the PTEs are cleared).
+pub fn writeback_range(pd: PhysAddr, addr: u32, size: u32) {
+    if !active() {
+        return;
+    }
+    let regions = vma::file_regions(pd, addr, size);
+    flush(collect_dirty(&regions));
+}
+
+/// Apply the open-file reference changes reported by `vma::free_region`.
+pub fn release_refs(refs: &[(u32, i32)]) {
+    for &(slot, delta) in refs {
+        if delta > 0 {
+            REGIONS.fetch_add(delta as u32, Ordering::Relaxed);
+            for _ in 0..delta {
+                crate::fs::vfs::incref(slot);
+            }
+        } else {
+            REGIONS.fetch_sub((-delta) as u32, Ordering::Relaxed);
+            for _ in 0..-delta {
+                crate::fs::vfs::decref(slot);
+            }
+        }
+    }
+}
+
+/// Give the forked child `dst_pd` the parent's regions (and one more
+/// reference per file-backed region).  Pages not yet faulted in by the
+/// parent are faulted in by the child from the file.
+pub fn clone_for_fork(src_pd: PhysAddr, dst_pd: PhysAddr) {
+    let slots = vma::clone_for_fork(src_pd, dst_pd);
+    REGIONS.fetch_add(slots.len() as u32, Ordering::Relaxed);
+    for slot in slots {
+        crate::fs::vfs::incref(slot);
+    }
+}
+
+/// Detach every file-backed region of the dying process `pd`.  Pass the
+/// result to [`collect_dirty`] while `pd` is the active address space, then
+/// to [`finish`].
+pub fn detach_process(pd: PhysAddr) -> Vec<Vma> {
+    if !active() {
+        return Vec::new();
+    }
+    vma::take_file_regions(pd)
+}
+
+/// Copy out the dirty pages of the shared regions in `regions`.  Must run
+/// in their address space; does not block.
+pub fn collect_dirty(regions: &[Vma]) -> Vec<DirtyPage> {
+    let mut dirty = Vec::new();
+    for v in regions {
+        let f = match v.file {
+            Some(f) if f.shared && v.flags & FLAG_WRITABLE != 0 => f,
+            _ => continue,
+        };
+        let mut rel = 0;
+        while rel < v.size && rel < f.file_len {
+            let page = v.start + rel;
+            if virtual_mem::user_page_dirty(page as u64) {
+                let n = (f.file_len - rel).min(PAGE_SIZE) as usize;
+                let src = unsafe { core::slice::from_raw_parts(page as *const u8, n) };
+                dirty.push(DirtyPage { slot: f.slot, offset: f.offset + rel, data: src.to_vec() });
+            }
+            rel += PAGE_SIZE;
+        }
+    }
+    dirty
+}
+
+/// Write `dirty` back to the files (may block).
+pub fn flush(dirty: Vec<DirtyPage>) {
+    for page in dirty {
+        if let Err(e) = crate::fs::vfs::write_at(page.slot, page.offset, &page.data) {
+            crate::serial_println!(
+                "file_map: write-back of slot {} at {:#x} failed: {:?}",
+                page.slot, page.offset, e
+            );
+        }
+    }
+}
+
+/// Write back `dirty` and drop the file references of the detached `regions`.
+pub fn finish(regions: Vec<Vma>, dirty: Vec<DirtyPage>) {
+    flush(dirty);
+    REGIONS.fetch_sub(regions.len() as u32, Ordering::Relaxed);
+    for v in regions {
+        if let Some(f) = v.file {
+            crate::fs::vfs::decref(f.slot);
+        }
+    }
+}
+
+/// Tear down the file mappings of the exiting current process `pd`.
+pub fn release_current(pd: PhysAddr) {
+    let regions = detach_process(pd);
+    if regions.is_empty() {
+        return;
+    }
+    let dirty = collect_dirty(&regions);
+    finish(regions, dirty);
+}
+
+fn region_flags(writable: bool) -> u32 {
+    FLAG_USER | if writable { FLAG_WRITABLE } else { 0 }
+}
+
+/// Read the page at `page` of region `v` from its file and map it.
+fn fill_page(v: &Vma, page: u32) -> bool {
+    let f = match v.file {
+        Some(f) => f,
+        None => return false,
+    };
+    let rel = page - v.start;
+    let n = f.file_len.saturating_sub(rel).min(PAGE_SIZE) as usize;
+    let mut buf = vec![0u8; n];
+    if n > 0 {
+        if let Err(e) = crate::fs::vfs::read_at(f.slot, f.offset + rel, &mut buf) {
+            crate::serial_println!("file_map: fault at {:#x} failed to read: {:?}", page, e);
+            return false;
+        }
+    }
+    let mut flags = v.flags as u64;
+    if !f.exec {
+        flags |= virtual_mem::page_nx_flag();
+    }
+    if !virtual_mem::install_user_page(page as u64, &buf, flags) {
+        return false;
+    }
+    crate::task::scheduler::adjust_current_user_pages(1);
+    true
+}
@@ -7,9 +7,13 @@
 //! The lock is IRQ-safe: interrupts are disabled while the heap lock is held.
 //! This prevents deadlock when `reap_terminated()` frees a kernel stack from
 //! within the timer ISR while the preempted thread was holding the heap lock.
+//!
+//! Allocations of up to 4 KiB are served by the per-CPU slab caches in
+//! [`super::slab`] and only reach the free list when a slab chunk is carved.
 
 use crate::memory::address::{PhysAddr, VirtAddr};
 use crate::memory::physical;
+use crate::memory::slab;
 use crate::memory::virtual_mem;
 use crate::memory::FRAME_SIZE;
 use core::alloc::{GlobalAlloc, Layout};
@@ -128,6 +132,10 @@ unsafe impl GlobalAlloc for LockedHeap {
             return core::ptr::null_mut();
         }
 
+        if let Some(class) = slab::class_for(layout.size(), layout.align()) {
+            return slab::alloc(class);
+        }
+
         let flags = self.acquire();
         let mut result = alloc_inner(layout);
 
@@ -144,12 +152,34 @@ unsafe impl GlobalAlloc for LockedHeap {
     }
 
     unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        if let Some(class) = slab::class_for(layout.size(), layout.align()) {
+            slab::dealloc(ptr, class);
+            return;
+        }
+
         let flags = self.acquire();
         dealloc_inner(ptr, layout);
         self.release(flags);
     }
 }
 
+/// Carve a raw chunk for a slab depot from the free-list heap.
+///
+/// Takes the global heap lock (growing the heap if needed). The chunk is
+/// 16-byte aligned and is never returned to the free list.
+pub(super) fn alloc_slab_chunk(size: usize) -> *mut u8 {
+    unsafe {
+        let layout = Layout::from_size_align_unchecked(size, 16);
+        let flags = HEAP_ALLOCATOR.acquire();
+        let mut result = alloc_inner(layout);
+        if result.is_null() && grow_heap(align_up(size, 16)) {
+            result = alloc_inner(layout);
+        }
+        HEAP_ALLOCATOR.release(flags);
+        result
+    }
+}
+
 /// Check if the heap lock is currently held (lock-free diagnostic).
 /// Used by the timer heartbeat to detect if the heap is part of a deadlock chain.
 #[inline]
@@ -417,7 +447,8 @@ fn align_up(value: usize, align: usize) -> usize {
 
 /// Returns (used_bytes, total_committed_bytes) for the kernel heap.
 ///
-/// Acquires the heap lock to read the free list consistently.
+/// Acquires the heap lock to read the free list consistently. Slab chunks
+/// count as used; see [`slab::slab_totals`] for how much of that is live.
 pub fn heap_stats() -> (usize, usize) {
     unsafe {
         let flags = HEAP_ALLOCATOR.acquire();
@@ -485,6 +516,10 @@ pub fn validate_heap() {
         crate::serial_println!("  Heap check: {} free block(s), {} KiB free / {} KiB committed",
             count, total_free / 1024, HEAP_COMMITTED.load(Ordering::Acquire) / 1024);
         HEAP_ALLOCATOR.release(flags);
+
+        let (slab_used, slab_reserved) = slab::slab_totals();
+        crate::serial_println!("  Slab: {} KiB live / {} KiB reserved ({} heap refills)",
+            slab_used / 1024, slab_reserved / 1024, slab::heap_refills());
     }
 }
 
@@ -0,0 +1,183 @@
+//! LZ4 block compression for swapped-out pages.
+//!
+//! Implements the raw LZ4 *block* format (no frame header, no checksum):
+//! a stream of sequences, each a token byte (literal length in the high
+//! nibble, match length minus 4 in the low one), optional length extension
+//! bytes, the literals and a 16-bit little-endian match offset.  The last
+//! sequence carries literals only.  Output is readable by any LZ4 block
+//! decoder.
+//!
+//! The compressor is the greedy single-probe variant of the reference
+//! `LZ4_compress_fast`: one hash table of recent positions, no chains, and
+//! a search step that grows while no match is found, so incompressible
+//! data is skipped quickly.  It is meant for inputs of at most 64 KiB (a
+//! page here); positions are stored as `u16`.
+
+/// log2 of the hash table size.
+const HASH_LOG: u32 = 12;
+/// Entries in the hash table the caller provides.
+pub const HASH_SIZE: usize = 1 << HASH_LOG;
+
+const MIN_MATCH: usize = 4;
+/// The last 5 bytes are always literals.
+const LAST_LITERALS: usize = 5;
+/// A match must start at least 12 bytes before the end of the input.
+const MF_LIMIT: usize = 12;
+/// Largest offset a sequence can encode.
+const MAX_DISTANCE: usize = 65535;
+/// Failed probes before the search step grows by one byte.
+const SKIP_TRIGGER: u32 = 6;
+
+#[inline(always)]
+fn read_u32(src: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes([src[at], src[at + 1], src[at + 2], src[at + 3]])
+}
+
+#[inline(always)]
+fn hash(seq: u32) -> usize {
+    (seq.wrapping_mul(2_654_435_761) >> (32 - HASH_LOG)) as usize
+}
+
+/// Append a length extension (`len` beyond the nibble's 15).
+fn put_len(dst: &mut [u8], out: &mut usize, mut len: usize) {
+    while len >= 255 {
+        dst[*out] = 255;
+        *out += 1;
+        len -= 255;
+    }
+    dst[*out] = len as u8;
+    *out += 1;
+}
+
+/// Append one sequence: `lit`, then a match of `mlen` bytes at `offset`
+/// (`mlen == 0`: literals only, the final sequence).  `None` if `dst` is
+/// too small.
+fn put_sequence(dst: &mut [u8], out: &mut usize, lit: &[u8], offset: usize, mlen: usize) -> Option<()> {
+    let ll = lit.len();
+    let ml = mlen.saturating_sub(MIN_MATCH);
+    let need = 1 + ll / 255 + 1 + ll + if mlen > 0 { 2 + ml / 255 + 1 } else { 0 };
+    if *out + need > dst.len() {
+        return None;
+    }
+    let token = (ll.min(15) as u8) << 4 | if mlen > 0 { ml.min(15) as u8 } else { 0 };
+    dst[*out] = token;
+    *out += 1;
+    if ll >= 15 {
+        put_len(dst, out, ll - 15);
+    }
+    dst[*out..*out + ll].copy_from_slice(lit);
+    *out += ll;
+    if mlen > 0 {
+        dst[*out..*out + 2].copy_from_slice(&(offset as u16).to_le_bytes());
+        *out += 2;
+        if ml >= 15 {
+            put_len(dst, out, ml - 15);
+        }
+    }
+    Some(())
+}
+
+/// Compress `src` (at most 64 KiB) into `dst`.  `table` is scratch space
+/// (contents ignored).  Returns the compressed length, or `None` if the
+/// result does not fit in `dst` — callers pass a `dst` smaller than `src`
+/// to give up early on data not worth compressing.
+pub fn compress(src: &[u8], dst: &mut [u8], table: &mut [u16; HASH_SIZE]) -> Option<usize> {
+    let n = src.len();
+    let mut out = 0;
+    let mut anchor = 0;
+    if n > MF_LIMIT {
+        table.fill(0);
+        let limit = n - MF_LIMIT;
+        let match_limit = n - LAST_LITERALS;
+        let mut i = 1;
+        let mut probes = 1u32 << SKIP_TRIGGER;
+        while i <= limit {
+            let seq = read_u32(src, i);
+            let h = hash(seq);
+            let cand = table[h] as usize;
+            table[h] = i as u16;
+            if cand >= i || i - cand > MAX_DISTANCE || read_u32(src, cand) != seq {
+                i += (probes >> SKIP_TRIGGER) as usize;
+                probes += 1;
+                continue;
+            }
+            // Extend the match backwards over pending literals, then forwards.
+            let (mut s, mut c) = (i, cand);
+            while s > anchor && c > 0 && src[s - 1] == src[c - 1] {
+                s -= 1;
+                c -= 1;
+            }
+            let mut len = MIN_MATCH + (i - s);
+            while s + len < match_limit && src[c + len] == src[s + len] {
+                len += 1;
+            }
+            put_sequence(dst, &mut out, &src[anchor..s], s - c, len)?;
+            i = s + len;
+            anchor = i;
+            probes = 1 << SKIP_TRIGGER;
+        }
+    }
+    put_sequence(dst, &mut out, &src[anchor..], 0, 0)?;
+    Some(out)
+}
+
+/// Decompress the LZ4 block `src` into `dst`.  Returns the decompressed
+/// length, or `None` if the block is malformed or does not fit in `dst`.
+pub fn decompress(src: &[u8], dst: &mut [u8]) -> Option<usize> {
+    let mut ip = 0;
+    let mut op = 0;
+    loop {
+        let token = *src.get(ip)?;
+        ip += 1;
+
+        let mut ll = (token >> 4) as usize;
+        if ll == 15 {
+            loop {
+                let b = *src.get(ip)?;
+                ip += 1;
+                ll += b as usize;
+                if b != 255 {
+                    break;
+                }
+            }
+        }
+        if ip + ll > src.len() || op + ll > dst.len() {
+            return None;
+        }
+        dst[op..op + ll].copy_from_slice(&src[ip..ip + ll]);
+        ip += ll;
+        op += ll;
+        if ip == src.len() {
+            return Some(op);
+        }
+
+        if ip + 2 > src.len() {
+            return None;
+        }
+        let offset = u16::from_le_bytes([src[ip], src[ip + 1]]) as usize;
+        ip += 2;
+        if offset == 0 || offset > op {
+            return None;
+        }
+        let mut ml = (token & 0x0F) as usize;
+        if ml == 15 {
+            loop {
+                let b = *src.get(ip)?;
+                ip += 1;
+                ml += b as usize;
+                if b != 255 {
+                    break;
+                }
+            }
+        }
+        ml += MIN_MATCH;
+        if op + ml > dst.len() {
+            return None;
+        }
+        // Byte by byte: the source may overlap the bytes being written.
+        for k in op..op + ml {
+            dst[k] = dst[k - offset];
+        }
+        op += ml;
+    }
+}
@@ -0,0 +1,184 @@
+//! Block copy and fill primitives chosen by CPU feature at boot.
+//!
+//! [`init`] reads CPUID once and picks how the kernel moves bulk data:
+//! - **ERMS** (enhanced `rep movsb`/`rep stosb`): microcoded fast strings
+//!   that move whole cache lines; one `rep movsb` beats any loop for blocks
+//!   of a few hundred bytes and up.
+//! - **FSRM** (fast short `rep movsb`): the same instruction is also cheap
+//!   for short copies, so it is used for every length.
+//! - Neither: `rep movsq`/`rep stosq` for whole pages, the compiler-builtins
+//!   `memcpy`/`memset` for everything else.
+//!
+//! [`zero_page_nt`] clears a page with `movnti` non-temporal stores.  It is
+//! meant for pages nobody reads soon (the pre-zeroed frame pool): the zeros
+//! go straight to memory instead of evicting the cache.  `movnti` is SSE2,
+//! which every x86_64 CPU has.
+//!
+//! Only general-purpose registers are touched.  Kernel code does not save
+//! the interrupted thread's AVX state, so AVX2 copies are not used even when
+//! the CPU has them.  On ARM64 every primitive is the plain `core::ptr`
+//! operation.
+
+use crate::memory::FRAME_SIZE;
+#[cfg(target_arch = "x86_64")]
+use core::sync::atomic::{AtomicBool, Ordering};
+
+/// `rep movsb`/`stosb` has fast microcode (ERMS).
+#[cfg(target_arch = "x86_64")]
+static ERMS: AtomicBool = AtomicBool::new(false);
+/// `rep movsb`/`stosb` is also fast for short lengths (FSRM).
+#[cfg(target_arch = "x86_64")]
+static FSRM: AtomicBool = AtomicBool::new(false);
+
+/// Shortest block for `rep movsb`/`stosb` without FSRM: below this the
+/// string startup cost outweighs the unrolled compiler-builtins loop.
+#[cfg(target_arch = "x86_64")]
+const REP_MIN: usize = 256;
+
+/// Select the primitives for this CPU.  Call after `cpuid::detect`.
+#[cfg(target_arch = "x86_64")]
+pub fn init() {
+    let f = crate::arch::x86::cpuid::features();
+    ERMS.store(f.erms, Ordering::Relaxed);
+    FSRM.store(f.erms && f.fsrm, Ordering::Relaxed);
+    let strategy = match (f.erms, f.fsrm) {
+        (true, true) => "rep movsb (ERMS+FSRM)",
+        (true, false) => "rep movsb (ERMS) above 256 bytes",
+        _ => "rep movsq pages",
+    };
+    crate::serial_println!("[OK] memops: {}, non-temporal page clear", strategy);
+}
+
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+fn use_rep(len: usize) -> bool {
+    FSRM.load(Ordering::Relaxed) || (len >= REP_MIN && ERMS.load(Ordering::Relaxed))
+}
+
+/// Copy `len` bytes from `src` to `dst` (non-overlapping).
+///
+/// # Safety
+/// Same as `core::ptr::copy_nonoverlapping`.
+#[inline]
+pub unsafe fn copy(dst: *mut u8, src: *const u8, len: usize) {
+    #[cfg(target_arch = "x86_64")]
+    if use_rep(len) {
+        core::arch::asm!(
+            "rep movsb",
+            inout("rcx") len => _,
+            inout("rdi") dst => _,
+            inout("rsi") src => _,
+            options(nostack, preserves_flags),
+        );
+        return;
+    }
+    core::ptr::copy_nonoverlapping(src, dst, len);
+}
+
+/// Set `len` bytes at `dst` to `val`.
+///
+/// # Safety
+/// Same as `core::ptr::write_bytes`.
+#[inline]
+pub unsafe fn fill(dst: *mut u8, val: u8, len: usize) {
+    #[cfg(target_arch = "x86_64")]
+    if use_rep(len) {
+        core::arch::asm!(
+            "rep stosb",
+            inout("rcx") len => _,
+            inout("rdi") dst => _,
+            in("al") val,
+            options(nostack, preserves_flags),
+        );
+        return;
+    }
+    core::ptr::write_bytes(dst, val, len);
+}
+
+/// Copy one 4 KiB page.
+///
+/// # Safety
+/// `dst` and `src` must be valid, distinct, mapped pages.
+#[inline]
+pub unsafe fn copy_page(dst: *mut u8, src: *const u8) {
+    #[cfg(target_arch = "x86_64")]
+    {
+        if ERMS.load(Ordering::Relaxed) {
+            core::arch::asm!(
+                "rep movsb",
+                inout("rcx") FRAME_SIZE => _,
+                inout("rdi") dst => _,
+                inout("rsi") src => _,
+                options(nostack, preserves_flags),
+            );
+        } else {
+            core::arch::asm!(
+                "rep movsq",
+                inout("rcx") FRAME_SIZE / 8 => _,
+                inout("rdi") dst => _,
+                inout("rsi") src => _,
+                options(nostack, preserves_flags),
+            );
+        }
+    }
+    #[cfg(target_arch = "aarch64")]
+    core::ptr::copy_nonoverlapping(src, dst, FRAME_SIZE);
+}
+
+/// Clear one 4 KiB page through the cache (the caller uses it next).
+///
+/// # Safety
+/// `dst` must be a valid, mapped, writable page.
+#[inline]
+pub unsafe fn zero_page(dst: *mut u8) {
+    #[cfg(target_arch = "x86_64")]
+    {
+        if ERMS.load(Ordering::Relaxed) {
+            core::arch::asm!(
+                "rep stosb",
+                inout("rcx") FRAME_SIZE => _,
+                inout("rdi") dst => _,
+                in("al") 0u8,
+                options(nostack, preserves_flags),
+            );
+        } else {
+            core::arch::asm!(
+                "rep stosq",
+                inout("rcx") FRAME_SIZE / 8 => _,
+                inout("rdi") dst => _,
+                in("rax") 0u64,
+                options(nostack, preserves_flags),
+            );
+        }
+    }
+    #[cfg(target_arch = "aarch64")]
+    core::ptr::write_bytes(dst, 0, FRAME_SIZE);
+}
+
+/// Clear one 4 KiB page with non-temporal stores, bypassing the cache.
+/// The stores are fenced, so the zeros are visible to every CPU on return.
+///
+/// # Safety
+/// `dst` must be a valid, mapped, writable, 64-byte aligned page.
+#[cfg(target_arch = "x86_64")]
+pub unsafe fn zero_page_nt(dst: *mut u8) {
+    core::arch::asm!(
+        "2:",
+        "movnti [{p}], {z}",
+        "movnti [{p} + 8], {z}",
+        "movnti [{p} + 16], {z}",
+        "movnti [{p} + 24], {z}",
+        "movnti [{p} + 32], {z}",
+        "movnti [{p} + 40], {z}",
+        "movnti [{p} + 48], {z}",
+        "movnti [{p} + 56], {z}",
+        "add {p}, 64",
+        "cmp {p}, {end}",
+        "jne 2b",
+        "sfence",
+        p = inout(reg) dst => _,
+        end = in(reg) dst.add(FRAME_SIZE),
+        z = in(reg) 0u64,
+        options(nostack),
+    );
+}
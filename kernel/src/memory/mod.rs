@@ -4,15 +4,26 @@
 //! and typed address wrappers for safe physical/virtual address manipulation.
 
 pub mod address;
+pub mod file_map;
 pub mod heap;
+#[cfg(target_arch = "x86_64")]
+pub mod lz4;
+pub mod memops;
 pub mod physical;
 #[cfg(target_arch = "x86_64")]
+pub mod reclaim;
+pub mod slab;
+#[cfg(target_arch = "x86_64")]
+pub mod swap;
+#[cfg(target_arch = "x86_64")]
 pub mod virtual_mem;
 #[cfg(target_arch = "aarch64")]
 pub mod virtual_mem_stub;
 #[cfg(target_arch = "aarch64")]
 pub use virtual_mem_stub as virtual_mem;
 pub mod vma;
+#[cfg(target_arch = "x86_64")]
+pub mod zero_pool;
 
 /// Size of a single memory page/frame in bytes (4 KiB).
 pub const FRAME_SIZE: usize = 4096;
@@ -1,24 +1,54 @@
-//! Physical frame allocator using a bitmap.
+//! Physical frame allocator: binary buddy system with per-CPU hot lists.
 //!
-//! Manages 4 KiB physical frames up to 64 GiB of RAM. The bitmap tracks
-//! free/used state for each frame, initialized from the BIOS E820 memory map.
-//! All operations are protected by an IRQ-safe spinlock for SMP safety.
+//! Manages 4 KiB physical frames up to 64 GiB of RAM. Free memory is kept as
+//! maximal, naturally aligned power-of-two blocks of order 0 (4 KiB) through
+//! [`MAX_ORDER`] (4 MiB).  Each order has a hierarchical free bitmap — four
+//! 64-ary levels — so finding the lowest free block of an order, marking a
+//! block free or used, and testing a buddy are all O(log64 n).  Allocating an
+//! order-k block therefore costs O(MAX_ORDER) bitmap operations regardless of
+//! where in RAM it lands.
 //!
-//! The bitmap is a static array in BSS (2 MiB), so it costs nothing until
-//! the pages containing it are demand-faulted. With QEMU `-m 1024M`, only
-//! the first 32 KiB of the bitmap is actually used.
+//! Single-frame traffic (demand faults, page tables, fork copies) is served
+//! from a small per-CPU hot list that refills from / flushes to the buddy in
+//! batches.  Each hot list has its own spinlock, normally only touched by its
+//! CPU, so the common path never contends on the global buddy lock.
+//!
+//! All bitmaps are static arrays in BSS (~4 MiB for 64 GiB). With QEMU
+//! `-m 1024M` only a small prefix of each level is ever touched.
+//!
+//! Frames that anonymous memory needs cleared are usually taken from the
+//! pre-zeroed pool in [`super::zero_pool`], which also counts as free.
+//!
+//! Frames shared copy-on-write between address spaces carry a reference
+//! count in a heap-allocated table (see [`init_frame_refs`]).  The count is
+//! the number of *extra* owners, so [`free_frame`] on a shared frame only
+//! drops a reference and the frame returns to the allocator with its last
+//! owner.
 
+use crate::arch::hal::MAX_CPUS;
 use crate::boot_info::{BootInfo, E820_TYPE_USABLE};
 use crate::memory::address::PhysAddr;
 use crate::memory::FRAME_SIZE;
 use crate::sync::spinlock::Spinlock;
+use crate::sync::ticket_lock::TicketLock;
+use core::sync::atomic::{AtomicPtr, AtomicU16, AtomicUsize, Ordering};
 
 /// Maximum supported physical memory (64 GiB).
 const MAX_MEMORY: usize = 64 * 1024 * 1024 * 1024;
-/// Total number of frames that can be tracked in the bitmap.
+/// Total number of frames that can be tracked.
 const MAX_FRAMES: usize = MAX_MEMORY / FRAME_SIZE;
-/// Size of the bitmap in bytes (1 bit per frame, 2 MiB for 64 GiB).
-const BITMAP_SIZE: usize = MAX_FRAMES / 8;
+
+/// Largest buddy block order (2^10 frames = 4 MiB).
+pub const MAX_ORDER: usize = 10;
+/// Number of buddy orders (0..=MAX_ORDER).
+const NUM_ORDERS: usize = MAX_ORDER + 1;
+/// Levels of each per-order summary bitmap (64^4 = 2^24 = MAX_FRAMES).
+const LEVELS: usize = 4;
+
+/// Frames cached per CPU hot list.
+const HOT_CAPACITY: usize = 64;
+/// Frames moved between a hot list and the buddy in one batch.
+const HOT_BATCH: usize = HOT_CAPACITY / 2;
 
 // Kernel virtual base (must match link.ld and boot.asm)
 const KERNEL_VIRT_BASE: u64 = 0xFFFF_FFFF_8000_0000;
@@ -30,42 +60,280 @@ extern "C" {
     static _kernel_end: u8;
 }
 
-/// Physical frame allocator state.
+// ── Bitmap geometry (computed at compile time) ──────────────────────────
+
+/// Number of u64 words in `level` of the bitmap for `order`.
+const fn level_words(order: usize, level: usize) -> usize {
+    let mut bits = MAX_FRAMES >> order;
+    let mut l = 0;
+    loop {
+        let words = (bits + 63) / 64;
+        if l == level {
+            return words;
+        }
+        bits = words;
+        l += 1;
+    }
+}
+
+/// Word offset of each (order, level) bitmap inside [`BuddyAllocator::words`].
+const OFFSETS: [[usize; LEVELS]; NUM_ORDERS] = {
+    let mut table = [[0usize; LEVELS]; NUM_ORDERS];
+    let mut off = 0usize;
+    let mut order = 0;
+    while order < NUM_ORDERS {
+        let mut level = 0;
+        while level < LEVELS {
+            table[order][level] = off;
+            off += level_words(order, level);
+            level += 1;
+        }
+        order += 1;
+    }
+    table
+};
+
+/// Total words across all orders and levels.
+const TOTAL_WORDS: usize = OFFSETS[MAX_ORDER][LEVELS - 1] + level_words(MAX_ORDER, LEVELS - 1);
+
+/// Buddy allocator state.
 ///
-/// Field order matters: `total_frames`/`free_frames` are placed BEFORE the
-/// 2 MiB bitmap so they sit at the start of BSS.  The boot stack now lives in
-/// a dedicated .boot_stack linker section above BSS, so stack overflow cannot
-/// silently corrupt BSS statics.  The field ordering remains as an extra
-/// safety margin in case of unexpected memory pressure.
+/// `words` holds, for each order, a four-level bitmap: level 0 has one bit
+/// per block (set = block is a maximal free block), each higher level has one
+/// bit per non-zero word of the level below.  A block is free at exactly one
+/// order; any free block's buddy is never free at the same order (it would
+/// have been merged).
+///
+/// Field order matters: the counters are placed BEFORE the bitmaps so they
+/// sit at the start of BSS, as an extra safety margin in case of unexpected
+/// memory pressure.
 #[repr(C)]
-struct FrameAllocator {
+struct BuddyAllocator {
     total_frames: usize,
-    free_frames: usize,
-    next_search: usize,
-    bitmap: [u8; BITMAP_SIZE],
+    /// Frames free in the buddy bitmaps (excludes hot-list frames).
+    buddy_free: usize,
+    words: [u64; TOTAL_WORDS],
 }
 
-impl FrameAllocator {
-    fn set_used(&mut self, frame: usize) {
-        self.bitmap[frame / 8] |= 1 << (frame % 8);
+impl BuddyAllocator {
+    #[inline]
+    fn test(&self, order: usize, block: usize) -> bool {
+        self.words[OFFSETS[order][0] + block / 64] & (1u64 << (block % 64)) != 0
+    }
+
+    /// Set the free bit of `block` at `order`, propagating to summary levels.
+    fn set(&mut self, order: usize, block: usize) {
+        let mut idx = block;
+        for level in 0..LEVELS {
+            let w = &mut self.words[OFFSETS[order][level] + idx / 64];
+            let was_zero = *w == 0;
+            *w |= 1u64 << (idx % 64);
+            if !was_zero {
+                break;
+            }
+            idx /= 64;
+        }
+    }
+
+    /// Clear the free bit of `block` at `order`, propagating to summary levels.
+    fn clear(&mut self, order: usize, block: usize) {
+        let mut idx = block;
+        for level in 0..LEVELS {
+            let w = &mut self.words[OFFSETS[order][level] + idx / 64];
+            *w &= !(1u64 << (idx % 64));
+            if *w != 0 {
+                break;
+            }
+            idx /= 64;
+        }
+    }
+
+    /// Lowest-addressed free block of exactly `order`.
+    fn find_first(&self, order: usize) -> Option<usize> {
+        let top = self.words[OFFSETS[order][LEVELS - 1]];
+        if top == 0 {
+            return None;
+        }
+        let mut idx = top.trailing_zeros() as usize;
+        for level in (0..LEVELS - 1).rev() {
+            let w = self.words[OFFSETS[order][level] + idx];
+            idx = idx * 64 + w.trailing_zeros() as usize;
+        }
+        Some(idx)
     }
 
-    fn set_free(&mut self, frame: usize) {
-        self.bitmap[frame / 8] &= !(1 << (frame % 8));
+    /// Order of the free block containing `frame`, if the frame is free.
+    fn free_order_of(&self, frame: usize) -> Option<usize> {
+        (0..NUM_ORDERS).find(|&k| self.test(k, frame >> k))
     }
 
-    fn is_used(&self, frame: usize) -> bool {
-        self.bitmap[frame / 8] & (1 << (frame % 8)) != 0
+    /// Whether any frame of block (`order`, `block`) is already free.
+    fn overlaps_free(&self, order: usize, block: usize) -> bool {
+        // Free ancestors (or the block itself).
+        for k in order..NUM_ORDERS {
+            if self.test(k, block >> (k - order)) {
+                return true;
+            }
+        }
+        // Free descendants: scan the covered bit range of each lower order.
+        for k in 0..order {
+            let first = block << (order - k);
+            let count = 1usize << (order - k);
+            let base = OFFSETS[k][0];
+            if count >= 64 {
+                for w in first / 64..(first + count) / 64 {
+                    if self.words[base + w] != 0 {
+                        return true;
+                    }
+                }
+            } else {
+                let mask = ((1u64 << count) - 1) << (first % 64);
+                if self.words[base + first / 64] & mask != 0 {
+                    return true;
+                }
+            }
+        }
+        false
+    }
+
+    /// Allocate a block of `order`, splitting a larger block if needed.
+    /// Only blocks starting below `limit_frame` are considered.
+    fn alloc_block(&mut self, order: usize, limit_frame: usize) -> Option<usize> {
+        for k in order..NUM_ORDERS {
+            let block = match self.find_first(k) {
+                Some(b) => b,
+                None => continue,
+            };
+            if (block << k) + (1usize << order) > limit_frame {
+                continue;
+            }
+            self.clear(k, block);
+            // Split down to the requested order, freeing the upper halves.
+            let mut b = block;
+            for j in (order..k).rev() {
+                b <<= 1;
+                self.set(j, b + 1);
+            }
+            self.buddy_free -= 1usize << order;
+            return Some(b << order);
+        }
+        None
+    }
+
+    /// Return block (`order`, first frame `frame`) to the buddy, coalescing.
+    fn free_block(&mut self, frame: usize, order: usize) {
+        let mut block = frame >> order;
+        let mut k = order;
+        while k < MAX_ORDER {
+            let buddy = block ^ 1;
+            if !self.test(k, buddy) {
+                break;
+            }
+            self.clear(k, buddy);
+            block >>= 1;
+            k += 1;
+        }
+        self.set(k, block);
+        self.buddy_free += 1usize << order;
+    }
+
+    /// Free `[start, end)` as maximal aligned blocks, skipping frames that
+    /// are already free (overlapping E820 entries).
+    fn free_range(&mut self, start: usize, end: usize) {
+        let mut f = start;
+        while f < end {
+            let mut order = MAX_ORDER;
+            while order > 0 && (f & ((1usize << order) - 1) != 0 || f + (1usize << order) > end) {
+                order -= 1;
+            }
+            // Narrow down until the block does not overlap existing free memory.
+            while order > 0 && self.overlaps_free(order, f >> order) {
+                order -= 1;
+            }
+            if !self.overlaps_free(order, f >> order) {
+                self.free_block(f, order);
+            }
+            f += 1usize << order;
+        }
+    }
+
+    /// Mark a single free frame as used, splitting its free block.
+    /// Returns false if the frame was not free in the buddy.
+    fn take_frame(&mut self, frame: usize) -> bool {
+        let order = match self.free_order_of(frame) {
+            Some(k) => k,
+            None => return false,
+        };
+        let mut block = frame >> order;
+        self.clear(order, block);
+        // Walk down towards `frame`, freeing the half that doesn't contain it.
+        for j in (0..order).rev() {
+            block <<= 1;
+            if (frame >> j) & 1 == 0 {
+                self.set(j, block + 1);
+            } else {
+                self.set(j, block);
+                block += 1;
+            }
+        }
+        self.buddy_free -= 1;
+        true
+    }
+
+    /// First run of `blocks` consecutive free MAX_ORDER blocks below `limit_frame`.
+    fn find_max_order_run(&self, blocks: usize, limit_frame: usize) -> Option<usize> {
+        let limit_block = (limit_frame >> MAX_ORDER).min(MAX_FRAMES >> MAX_ORDER);
+        let mut run_start = 0usize;
+        let mut run_len = 0usize;
+        for b in 0..limit_block {
+            if self.test(MAX_ORDER, b) {
+                if run_len == 0 {
+                    run_start = b;
+                }
+                run_len += 1;
+                if run_len == blocks {
+                    return Some(run_start);
+                }
+            } else {
+                run_len = 0;
+            }
+        }
+        None
     }
 }
 
-static ALLOCATOR: Spinlock<FrameAllocator> = Spinlock::new(FrameAllocator {
-    bitmap:    [0; BITMAP_SIZE], // Zero-init → lives in BSS
+/// FIFO ticket lock; the per-CPU hot lists absorb most order-0 traffic.
+static ALLOCATOR: TicketLock<BuddyAllocator> = TicketLock::new(BuddyAllocator {
     total_frames: 0,
-    free_frames: 0,
-    next_search: 0,
+    buddy_free: 0,
+    words: [0; TOTAL_WORDS], // Zero-init → lives in BSS
 });
 
+/// Per-CPU cache of free order-0 frames (frame indices).
+struct HotList {
+    count: usize,
+    frames: [u32; HOT_CAPACITY],
+}
+
+static HOT_LISTS: [Spinlock<HotList>; MAX_CPUS] = {
+    const INIT: Spinlock<HotList> = Spinlock::new(HotList { count: 0, frames: [0; HOT_CAPACITY] });
+    [INIT; MAX_CPUS]
+};
+
+/// Free frames, including those parked in hot lists. Lock-free to read.
+static FREE_FRAMES: AtomicUsize = AtomicUsize::new(0);
+/// Total frames tracked (highest usable frame + 1).
+static TOTAL_FRAMES: AtomicUsize = AtomicUsize::new(0);
+
+/// Per-frame extra-owner counts, `TOTAL_FRAMES` entries. Null until
+/// [`init_frame_refs`] runs; before that no frame can be shared.
+static FRAME_REFS: AtomicPtr<AtomicU16> = AtomicPtr::new(core::ptr::null_mut());
+
+#[inline]
+fn frame_addr(frame: usize) -> PhysAddr {
+    PhysAddr::new((frame * FRAME_SIZE) as u64)
+}
+
 /// Initialize the physical frame allocator from the E820 memory map.
 ///
 /// Marks usable regions as free, then reserves the first 2 MiB (legacy/bootloader area)
@@ -75,7 +343,7 @@ pub fn init(boot_info: &BootInfo) {
 
     let mut alloc = ALLOCATOR.lock();
 
-    // First pass: find highest usable address to size the bitmap.
+    // First pass: find highest usable address.
     // Only consider USABLE entries — reserved MMIO regions (IOAPIC, LAPIC, etc.)
     // can have addresses far above actual RAM and would bloat total_frames.
     let mut max_usable_addr: u64 = 0;
@@ -94,17 +362,9 @@ pub fn init(boot_info: &BootInfo) {
     }
 
     alloc.total_frames = (max_usable_addr as usize) / FRAME_SIZE;
-    alloc.free_frames = 0;
+    alloc.buddy_free = 0;
 
-    // Fill bitmap with 0xFF (all used) for the actual RAM range only.
-    // The bitmap is zero-initialized in BSS — we only touch the bytes
-    // corresponding to real physical memory, not the full 2 MiB.
-    let bitmap_bytes_needed = (alloc.total_frames + 7) / 8;
-    for byte in alloc.bitmap[..bitmap_bytes_needed].iter_mut() {
-        *byte = 0xFF;
-    }
-
-    // Mark usable regions as free
+    // Hand usable regions to the buddy as maximal aligned blocks
     for entry in memory_map {
         if entry.entry_type != E820_TYPE_USABLE {
             continue;
@@ -117,15 +377,9 @@ pub fn init(boot_info: &BootInfo) {
             continue;
         }
 
-        let start_frame = start.frame_index();
-        let end_frame = end.frame_index();
-
-        for frame in start_frame..end_frame {
-            if frame < MAX_FRAMES {
-                alloc.set_free(frame);
-                alloc.free_frames += 1;
-            }
-        }
+        let start_frame = start.frame_index().min(MAX_FRAMES);
+        let end_frame = end.frame_index().min(MAX_FRAMES);
+        alloc.free_range(start_frame, end_frame);
     }
 
     // Re-mark reserved regions as used:
@@ -133,10 +387,7 @@ pub fn init(boot_info: &BootInfo) {
     //   kernel at 1MB, and kernel stack growing down from physical 0x200000)
     let first_mb_frames = (2 * 1024 * 1024) / FRAME_SIZE;
     for frame in 0..first_mb_frames {
-        if !alloc.is_used(frame) {
-            alloc.set_used(frame);
-            alloc.free_frames -= 1;
-        }
+        alloc.take_frame(frame);
     }
 
     // - Kernel region (including BSS which is not in the flat binary)
@@ -158,71 +409,234 @@ pub fn init(boot_info: &BootInfo) {
         kernel_start.as_u64(), kernel_end.as_u64()
     );
     for frame in kernel_start.frame_index()..kernel_end.frame_index() {
-        if frame < MAX_FRAMES && !alloc.is_used(frame) {
-            alloc.set_used(frame);
-            alloc.free_frames -= 1;
+        if frame < MAX_FRAMES {
+            alloc.take_frame(frame);
         }
     }
 
+    TOTAL_FRAMES.store(alloc.total_frames, Ordering::Relaxed);
+    FREE_FRAMES.store(alloc.buddy_free, Ordering::Relaxed);
+
     crate::serial_println!(
-        "Physical memory: {} MiB total, {} frames free ({} MiB)",
+        "Physical memory: {} MiB total, {} frames free ({} MiB), buddy orders 0-{}",
         alloc.total_frames * FRAME_SIZE / (1024 * 1024),
-        alloc.free_frames,
-        alloc.free_frames * FRAME_SIZE / (1024 * 1024)
+        alloc.buddy_free,
+        alloc.buddy_free * FRAME_SIZE / (1024 * 1024),
+        MAX_ORDER
     );
 }
 
 /// Allocate a single 4 KiB physical frame, returning its physical address.
 ///
-/// Uses next-fit: resumes scanning from where the last allocation left off.
-/// This makes sequential allocations O(1) amortized instead of O(n).
+/// Pops from this CPU's hot list; an empty hot list is refilled with
+/// `HOT_BATCH` frames from the buddy under the global lock.
 pub fn alloc_frame() -> Option<PhysAddr> {
-    let mut alloc = ALLOCATOR.lock();
-    let total = alloc.total_frames;
-    if alloc.free_frames == 0 {
-        return None;
+    let cpu = crate::arch::hal::cpu_id();
+    if cpu >= MAX_CPUS {
+        return alloc_block(0);
     }
-    let start = alloc.next_search;
-    // Search from next_search to end
-    for i in start..total {
-        if !alloc.is_used(i) {
-            alloc.set_used(i);
-            alloc.free_frames -= 1;
-            alloc.next_search = i + 1;
-            return Some(PhysAddr::new((i * FRAME_SIZE) as u64));
+
+    let mut hot = HOT_LISTS[cpu].lock();
+    if hot.count == 0 {
+        let mut alloc = ALLOCATOR.lock();
+        while hot.count < HOT_BATCH {
+            match alloc.alloc_block(0, usize::MAX) {
+                Some(f) => {
+                    let n = hot.count;
+                    hot.frames[n] = f as u32;
+                    hot.count += 1;
+                }
+                None => break,
+            }
         }
     }
-    // Wrap around: search from 0 to start
-    for i in 0..start {
-        if !alloc.is_used(i) {
-            alloc.set_used(i);
-            alloc.free_frames -= 1;
-            alloc.next_search = i + 1;
-            return Some(PhysAddr::new((i * FRAME_SIZE) as u64));
-        }
+    if hot.count == 0 {
+        drop(hot);
+        // Out of free frames: fall back to the pre-zeroed pool.
+        #[cfg(target_arch = "x86_64")]
+        return super::zero_pool::take_any();
+        #[cfg(not(target_arch = "x86_64"))]
+        return None;
     }
-    None
+    hot.count -= 1;
+    let frame = hot.frames[hot.count] as usize;
+    drop(hot);
+
+    FREE_FRAMES.fetch_sub(1, Ordering::Relaxed);
+    Some(frame_addr(frame))
 }
 
 /// Free a physical frame, returning it to the allocator pool.
 ///
-/// Has no effect if the frame is already free.
+/// Has no effect if the frame is already free (checked against this CPU's
+/// hot list immediately and against the buddy when the hot list flushes).
 pub fn free_frame(addr: PhysAddr) {
-    let mut alloc = ALLOCATOR.lock();
     let frame = addr.frame_index();
-    if alloc.is_used(frame) {
-        alloc.set_free(frame);
-        alloc.free_frames += 1;
-        // Hint allocator to reuse freed region sooner
-        if frame < alloc.next_search {
-            alloc.next_search = frame;
+    if frame >= TOTAL_FRAMES.load(Ordering::Relaxed) {
+        return; // Not RAM we manage (MMIO, VRAM above the top of memory)
+    }
+    if let Some(rc) = frame_ref(frame) {
+        // Shared copy-on-write frame: drop one reference instead of freeing.
+        if rc.fetch_update(Ordering::AcqRel, Ordering::Acquire, |n| n.checked_sub(1)).is_ok() {
+            return;
         }
     }
+    let cpu = crate::arch::hal::cpu_id();
+    if cpu >= MAX_CPUS {
+        free_contiguous(addr, 1);
+        return;
+    }
+
+    let mut hot = HOT_LISTS[cpu].lock();
+    if hot.frames[..hot.count].contains(&(frame as u32)) {
+        return; // Double free into the same hot list
+    }
+    if hot.count == HOT_CAPACITY {
+        let mut alloc = ALLOCATOR.lock();
+        flush_hot(&mut hot, &mut alloc, HOT_BATCH);
+    }
+    let n = hot.count;
+    hot.frames[n] = frame as u32;
+    hot.count += 1;
+    FREE_FRAMES.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Allocate the per-frame reference count table from the kernel heap.
+///
+/// Must run after `heap::init()`.  Until then [`share_frame`] refuses every
+/// request, so early forks fall back to copying.
+pub fn init_frame_refs() {
+    let total = TOTAL_FRAMES.load(Ordering::Relaxed);
+    let mut table: alloc::vec::Vec<AtomicU16> = alloc::vec::Vec::with_capacity(total);
+    table.resize_with(total, || AtomicU16::new(0));
+    let ptr = alloc::boxed::Box::leak(table.into_boxed_slice()).as_mut_ptr();
+    FRAME_REFS.store(ptr, Ordering::Release);
+    crate::serial_println!("[OK] Frame reference counts: {} KiB", total * 2 / 1024);
+}
+
+#[inline]
+fn frame_ref(frame: usize) -> Option<&'static AtomicU16> {
+    let table = FRAME_REFS.load(Ordering::Acquire);
+    if table.is_null() || frame >= TOTAL_FRAMES.load(Ordering::Relaxed) {
+        return None;
+    }
+    // SAFETY: the table is never freed and has TOTAL_FRAMES entries.
+    Some(unsafe { &*table.add(frame) })
+}
+
+/// Add an owner to an allocated frame (copy-on-write fork).
+///
+/// Returns `false` if the frame cannot be shared — refcounts not yet set up,
+/// frame outside managed RAM, or the count would overflow — in which case
+/// the caller must copy the page instead.
+pub fn share_frame(addr: PhysAddr) -> bool {
+    match frame_ref(addr.frame_index()) {
+        Some(rc) => rc
+            .fetch_update(Ordering::AcqRel, Ordering::Acquire, |n| n.checked_add(1))
+            .is_ok(),
+        None => false,
+    }
+}
+
+/// Number of owners beyond the first (0 = private frame).
+pub fn frame_ref_count(addr: PhysAddr) -> u16 {
+    frame_ref(addr.frame_index()).map_or(0, |rc| rc.load(Ordering::Acquire))
+}
+
+/// Move the `n` oldest frames of a hot list into the buddy.
+fn flush_hot(hot: &mut HotList, alloc: &mut BuddyAllocator, n: usize) {
+    let n = n.min(hot.count);
+    for i in 0..n {
+        let frame = hot.frames[i] as usize;
+        if alloc.free_order_of(frame).is_some() {
+            // Already free in the buddy — this was a double free.
+            FREE_FRAMES.fetch_sub(1, Ordering::Relaxed);
+        } else {
+            alloc.free_block(frame, 0);
+        }
+    }
+    hot.frames.copy_within(n..hot.count, 0);
+    hot.count -= n;
+}
+
+/// Return every CPU's hot-list frames to the buddy so they can merge.
+///
+/// Used before large contiguous allocations fail and by reservations, which
+/// must see every free frame.
+fn drain_hot_lists() {
+    for list in HOT_LISTS.iter() {
+        let mut hot = list.lock();
+        if hot.count > 0 {
+            let mut alloc = ALLOCATOR.lock();
+            let n = hot.count;
+            flush_hot(&mut hot, &mut alloc, n);
+        }
+    }
+}
+
+/// Allocate a naturally aligned block of 2^`order` frames anywhere in RAM.
+///
+/// Returns the physical address of the first frame. Free with
+/// [`free_contiguous`] (or frame by frame with [`free_frame`]).
+pub fn alloc_block(order: usize) -> Option<PhysAddr> {
+    alloc_block_below(order, usize::MAX)
+}
+
+fn alloc_block_below(order: usize, limit_frame: usize) -> Option<PhysAddr> {
+    if order > MAX_ORDER {
+        return None;
+    }
+    let first_try = ALLOCATOR.lock().alloc_block(order, limit_frame);
+    let frame = match first_try {
+        Some(f) => f,
+        None => {
+            // Frames parked in hot lists may complete a buddy pair.
+            drain_hot_lists();
+            ALLOCATOR.lock().alloc_block(order, limit_frame)?
+        }
+    };
+    FREE_FRAMES.fetch_sub(1usize << order, Ordering::Relaxed);
+    Some(frame_addr(frame))
+}
+
+/// Free `count` frames starting at `addr`, coalescing as aligned blocks.
+pub fn free_contiguous(addr: PhysAddr, count: usize) {
+    let start = addr.frame_index();
+    let end = (start + count).min(TOTAL_FRAMES.load(Ordering::Relaxed));
+    let mut alloc = ALLOCATOR.lock();
+    let mut f = start;
+    while f < end {
+        let mut order = MAX_ORDER;
+        while order > 0 && (f & ((1usize << order) - 1) != 0 || f + (1usize << order) > end) {
+            order -= 1;
+        }
+        // Skip (double-freed) blocks that already overlap free memory.
+        while order > 0 && alloc.overlaps_free(order, f >> order) {
+            order -= 1;
+        }
+        if !alloc.overlaps_free(order, f >> order) {
+            alloc.free_block(f, order);
+            FREE_FRAMES.fetch_add(1usize << order, Ordering::Relaxed);
+        }
+        f += 1usize << order;
+    }
+}
+
+/// Account for `n` free frames leaving a side pool (the pre-zeroed pool)
+/// that counts them as free.
+pub fn note_frames_taken(n: usize) {
+    FREE_FRAMES.fetch_sub(n, Ordering::Relaxed);
+}
+
+/// Account for `n` allocated frames parked in a side pool that counts them
+/// as free.
+pub fn note_frames_returned(n: usize) {
+    FREE_FRAMES.fetch_add(n, Ordering::Relaxed);
 }
 
 /// Returns the number of free physical frames currently available.
 pub fn free_frame_count() -> usize {
-    ALLOCATOR.lock().free_frames
+    FREE_FRAMES.load(Ordering::Relaxed)
 }
 
 /// Lock-free check if the physical frame allocator lock is currently held.
@@ -230,23 +644,30 @@ pub fn is_allocator_locked() -> bool {
     ALLOCATOR.is_locked()
 }
 
-/// Check if this CPU holds the allocator lock.
+/// Check if this CPU holds the buddy lock or its own hot-list lock.
 pub fn is_allocator_locked_by_cpu(cpu: u32) -> bool {
     ALLOCATOR.is_held_by_cpu(cpu)
+        || ((cpu as usize) < MAX_CPUS && HOT_LISTS[cpu as usize].is_held_by_cpu(cpu))
 }
 
-/// Force-release the allocator lock unconditionally.
+/// Force-release the allocator locks held by the current CPU.
 ///
 /// # Safety
 /// Must only be called when `is_allocator_locked_by_cpu(cpu)` returns true
 /// for the current CPU. The allocator's internal state may be inconsistent.
 pub unsafe fn force_unlock_allocator() {
-    ALLOCATOR.force_unlock();
+    let cpu = crate::arch::hal::cpu_id();
+    if cpu < MAX_CPUS && HOT_LISTS[cpu].is_held_by_cpu(cpu as u32) {
+        HOT_LISTS[cpu].force_unlock();
+    }
+    if ALLOCATOR.is_held_by_cpu(cpu as u32) {
+        ALLOCATOR.force_unlock();
+    }
 }
 
 /// Returns the number of free physical frames (alias for [`free_frame_count`]).
 pub fn free_frames() -> usize {
-    ALLOCATOR.lock().free_frames
+    FREE_FRAMES.load(Ordering::Relaxed)
 }
 
 /// Maximum physical address for contiguous allocations (128 MiB).
@@ -265,41 +686,82 @@ const CONTIGUOUS_MAX_FRAME: usize = MAX_FRAMES;
 
 /// Allocate `count` physically contiguous 4 KiB frames.
 ///
-/// Scans the bitmap for a run of `count` consecutive free frames (first-fit),
-/// constrained to the identity-mapped region (< 128 MiB) so the result is
+/// Constrained to the identity-mapped region (< 128 MiB) so the result is
 /// safely accessible via identity mapping from any CR3 context.
 /// Returns the physical address of the first frame, or `None` if unavailable.
 pub fn alloc_contiguous(count: usize) -> Option<PhysAddr> {
+    alloc_contiguous_below(count, CONTIGUOUS_MAX_FRAME)
+}
+
+/// Allocate `count` physically contiguous frames anywhere in RAM.
+///
+/// For callers that map the result themselves (large DMA rings, 2 MiB pages)
+/// rather than relying on the low identity map.
+pub fn alloc_contiguous_anywhere(count: usize) -> Option<PhysAddr> {
+    alloc_contiguous_below(count, usize::MAX)
+}
+
+fn alloc_contiguous_below(count: usize, limit_frame: usize) -> Option<PhysAddr> {
     if count == 0 {
         return None;
     }
-    let mut alloc = ALLOCATOR.lock();
-    let limit = alloc.total_frames.min(CONTIGUOUS_MAX_FRAME);
-    let mut run_start = 0usize;
-    let mut run_len = 0usize;
-    for i in 0..limit {
-        if !alloc.is_used(i) {
-            if run_len == 0 {
-                run_start = i;
-            }
-            run_len += 1;
-            if run_len >= count {
-                for j in run_start..run_start + count {
-                    alloc.set_used(j);
-                    alloc.free_frames -= 1;
-                }
-                return Some(PhysAddr::new((run_start * FRAME_SIZE) as u64));
-            }
-        } else {
-            run_len = 0;
+    let limit = limit_frame.min(TOTAL_FRAMES.load(Ordering::Relaxed));
+
+    if count <= (1usize << MAX_ORDER) {
+        // Round up to a power-of-two block and give back the unused tail.
+        let order = (usize::BITS - (count - 1).leading_zeros()) as usize;
+        let addr = alloc_block_below(order, limit)?;
+        let block_frames = 1usize << order;
+        if block_frames > count {
+            let tail = PhysAddr::new(addr.as_u64() + (count * FRAME_SIZE) as u64);
+            free_contiguous(tail, block_frames - count);
         }
+        return Some(addr);
     }
-    None
+
+    // Larger than one MAX_ORDER block: claim a run of adjacent max blocks.
+    let blocks = (count + (1usize << MAX_ORDER) - 1) >> MAX_ORDER;
+    let claim = |alloc: &mut BuddyAllocator| -> Option<usize> {
+        let first = alloc.find_max_order_run(blocks, limit)?;
+        for b in first..first + blocks {
+            alloc.clear(MAX_ORDER, b);
+        }
+        alloc.buddy_free -= blocks << MAX_ORDER;
+        Some(first << MAX_ORDER)
+    };
+    let first_try = claim(&mut ALLOCATOR.lock());
+    let frame = match first_try {
+        Some(f) => f,
+        None => {
+            drain_hot_lists();
+            claim(&mut ALLOCATOR.lock())?
+        }
+    };
+    FREE_FRAMES.fetch_sub(blocks << MAX_ORDER, Ordering::Relaxed);
+    let claimed = blocks << MAX_ORDER;
+    if claimed > count {
+        free_contiguous(frame_addr(frame + count), claimed - count);
+    }
+    Some(frame_addr(frame))
 }
 
 /// Returns the total number of physical frames tracked by the allocator.
 pub fn total_frames() -> usize {
-    ALLOCATOR.lock().total_frames
+    TOTAL_FRAMES.load(Ordering::Relaxed)
+}
+
+/// Free frames per buddy order (hot-list frames are not included).
+pub fn buddy_stats() -> [usize; NUM_ORDERS] {
+    let alloc = ALLOCATOR.lock();
+    let mut out = [0usize; NUM_ORDERS];
+    for (k, count) in out.iter_mut().enumerate() {
+        let base = OFFSETS[k][0];
+        let words = (alloc.total_frames >> k) / 64 + 1;
+        for w in 0..words.min(level_words(k, 0)) {
+            *count += alloc.words[base + w].count_ones() as usize;
+        }
+    }
+    out
 }
 
 /// Reserve (mark as used) a specific physical frame.
@@ -308,11 +770,23 @@ pub fn total_frames() -> usize {
 /// and the backing frames must be excluded from allocation.
 /// Has no effect if the frame is already marked as used.
 pub fn reserve_frame(addr: PhysAddr) {
-    let mut alloc = ALLOCATOR.lock();
     let frame = addr.frame_index();
-    if frame < MAX_FRAMES && !alloc.is_used(frame) {
-        alloc.set_used(frame);
-        alloc.free_frames -= 1;
+    if frame >= MAX_FRAMES {
+        return;
+    }
+    // The frame may be cached in any CPU's hot list.
+    for list in HOT_LISTS.iter() {
+        let mut hot = list.lock();
+        let n = hot.count;
+        if let Some(pos) = hot.frames[..n].iter().position(|&f| f as usize == frame) {
+            hot.frames.copy_within(pos + 1..n, pos);
+            hot.count -= 1;
+            FREE_FRAMES.fetch_sub(1, Ordering::Relaxed);
+            return;
+        }
+    }
+    if ALLOCATOR.lock().take_frame(frame) {
+        FREE_FRAMES.fetch_sub(1, Ordering::Relaxed);
     }
 }
 
@@ -327,48 +801,31 @@ pub fn init_arm64(ram_base: u64, ram_size: u64) {
 
     let ram_end = ram_base + ram_size;
     let start_frame = (ram_base as usize) / FRAME_SIZE;
-    let end_frame = (ram_end as usize) / FRAME_SIZE;
+    let end_frame = ((ram_end as usize) / FRAME_SIZE).min(MAX_FRAMES);
 
     let mut alloc = ALLOCATOR.lock();
 
     alloc.total_frames = end_frame;
-    alloc.free_frames = 0;
-
-    // Mark everything up to end_frame as used (0xFF = all bits set).
-    let bitmap_bytes = (end_frame + 7) / 8;
-    for byte in alloc.bitmap[..bitmap_bytes].iter_mut() {
-        *byte = 0xFF;
-    }
-
-    // Free the RAM region.
-    for frame in start_frame..end_frame {
-        if frame < MAX_FRAMES {
-            alloc.set_free(frame);
-            alloc.free_frames += 1;
-        }
-    }
+    alloc.buddy_free = 0;
 
     // Reserve kernel region: from RAM base to _kernel_end (physical).
     let kernel_end_virt = unsafe { &_kernel_end as *const u8 as u64 };
     let kernel_end_phys = kernel_end_virt - ARM64_PHYS_TO_VIRT;
     let kernel_end_frame = ((kernel_end_phys as usize) + FRAME_SIZE - 1) / FRAME_SIZE;
 
-    for frame in start_frame..kernel_end_frame {
-        if frame < MAX_FRAMES && !alloc.is_used(frame) {
-            alloc.set_used(frame);
-            alloc.free_frames -= 1;
-        }
-    }
+    // Free the RAM region above the kernel.
+    alloc.free_range(kernel_end_frame.max(start_frame), end_frame);
 
-    alloc.next_search = kernel_end_frame;
+    TOTAL_FRAMES.store(alloc.total_frames, Ordering::Relaxed);
+    FREE_FRAMES.store(alloc.buddy_free, Ordering::Relaxed);
 
     crate::serial_println!(
         "Physical memory: {} MiB RAM ({:#010x}-{:#010x}), {} frames free ({} MiB)",
         ram_size / (1024 * 1024),
         ram_base,
         ram_end,
-        alloc.free_frames,
-        alloc.free_frames * FRAME_SIZE / (1024 * 1024)
+        alloc.buddy_free,
+        alloc.buddy_free * FRAME_SIZE / (1024 * 1024)
     );
     crate::serial_println!(
         "  Kernel region reserved: {:#010x}-{:#010x}",
@@ -376,4 +833,3 @@ pub fn init_arm64(ram_base: u64, ram_size: u64) {
         kernel_end_phys
     );
 }
-
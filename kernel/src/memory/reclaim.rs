@@ -0,0 +1,187 @@
+//! Page reclaim thread.
+//!
+//! [`reclaim_thread`] keeps free memory above a low watermark (1/32 of RAM,
+//! at least 2 MiB).  Below it, frames are taken back in order of cost until
+//! free memory reaches the high watermark (twice the low one):
+//! 1. clean page-cache pages, inactive list first (`fs::page_cache`);
+//! 2. cached exec images no process maps (`task::image_cache`);
+//! 3. cold anonymous user pages, saved to swap (`memory::swap`).
+//!
+//! Anonymous pages are aged by their accessed bits while free memory is
+//! below four times the low watermark (see `virtual_mem::scan_user_pages`),
+//! so a page has to stay untouched for two scans before it is swapped.
+//! Every pass also counts each process's resident and swapped-out pages,
+//! which `sysinfo` reports per process.
+//!
+//! `sbrk` and `mmap` call [`direct_reclaim`] when the allocator is empty,
+//! which drops cached pages synchronously.
+//!
+//! While the thread works on an address space it *pins* it: the deferred
+//! destroy queue skips a pinned page directory, and `exec` waits for the
+//! pin ([`wait_unpinned`]) before freeing the old one.
+
+use crate::memory::address::PhysAddr;
+use crate::memory::{physical, swap, virtual_mem};
+use crate::sync::spinlock::Spinlock;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+/// How often the thread checks free memory.
+const POLL_NS: u64 = 100_000_000;
+/// Polls between passes while memory is plentiful (1 s).
+const IDLE_POLLS: u32 = 10;
+/// Pages swapped out of one address space per pass.
+const SWAP_BATCH: usize = 256;
+/// Frames [`direct_reclaim`] tries to free.
+const DIRECT_BATCH: usize = 64;
+
+/// Page directory the thread is working on (0 = none).
+static PINNED: AtomicU64 = AtomicU64::new(0);
+
+static RUNS: AtomicU64 = AtomicU64::new(0);
+static CACHE_RECLAIMED: AtomicU64 = AtomicU64::new(0);
+static IMAGE_RECLAIMED: AtomicU64 = AtomicU64::new(0);
+static DIRECT: AtomicU64 = AtomicU64::new(0);
+
+/// Per-process memory from the last pass.
+static PROCESS_MEMORY: Spinlock<Vec<ProcessMemory>> = Spinlock::new(Vec::new());
+
+/// Resident and swapped-out pages of one process.
+#[derive(Clone, Copy)]
+pub struct ProcessMemory {
+    pub tid: u32,
+    pub resident: u32,
+    pub swapped: u32,
+}
+
+/// Reclaim counters since boot.
+pub struct ReclaimStats {
+    /// Passes that found free memory below the low watermark.
+    pub runs: u64,
+    pub cache_reclaimed: u64,
+    pub image_reclaimed: u64,
+    /// [`direct_reclaim`] calls.
+    pub direct: u64,
+}
+
+/// Whether the reclaim thread is working on the address space `pd`.
+pub fn is_pinned(pd: PhysAddr) -> bool {
+    PINNED.load(Ordering::SeqCst) == pd.as_u64()
+}
+
+/// Sleep until the reclaim thread no longer works on `pd`.  Call after the
+/// last thread dropped `pd`, so it cannot be pinned again.
+pub fn wait_unpinned(pd: PhysAddr) {
+    while is_pinned(pd) {
+        crate::task::scheduler::sleep_ns(1_000_000);
+    }
+}
+
+/// Free up to `frames` frames from the page cache, then the exec image
+/// cache.  Returns the number freed.
+pub fn shrink_caches(frames: usize) -> usize {
+    let cache = crate::fs::page_cache::shrink(frames);
+    CACHE_RECLAIMED.fetch_add(cache as u64, Ordering::Relaxed);
+    let mut freed = cache;
+    if freed < frames {
+        let images = crate::task::image_cache::shrink(frames - freed);
+        IMAGE_RECLAIMED.fetch_add(images as u64, Ordering::Relaxed);
+        freed += images;
+    }
+    freed
+}
+
+/// Synchronous reclaim for an allocation that found no free frame.
+pub fn direct_reclaim() -> usize {
+    DIRECT.fetch_add(1, Ordering::Relaxed);
+    shrink_caches(DIRECT_BATCH)
+}
+
+/// Snapshot of the reclaim counters.
+pub fn stats() -> ReclaimStats {
+    ReclaimStats {
+        runs: RUNS.load(Ordering::Relaxed),
+        cache_reclaimed: CACHE_RECLAIMED.load(Ordering::Relaxed),
+        image_reclaimed: IMAGE_RECLAIMED.load(Ordering::Relaxed),
+        direct: DIRECT.load(Ordering::Relaxed),
+    }
+}
+
+/// Per-process resident/swapped page counts from the last pass.
+pub fn process_memory() -> Vec<ProcessMemory> {
+    PROCESS_MEMORY.lock().clone()
+}
+
+/// Reclaim thread ("kswapd").  Reads the swap configuration, then checks
+/// free memory every [`POLL_NS`].
+pub extern "C" fn reclaim_thread() {
+    swap::configure();
+    let low = (physical::total_frames() / 32).max(512);
+    let mut scratch = swap::Scratch::new();
+    let mut polls = IDLE_POLLS;
+    loop {
+        polls += 1;
+        if polls >= IDLE_POLLS || physical::free_frame_count() < low {
+            polls = 0;
+            pass(low, &mut scratch);
+        }
+        crate::task::scheduler::sleep_ns(POLL_NS);
+    }
+}
+
+/// One reclaim pass: caches first, then every address space (aging and
+/// swap-out as memory requires, counting resident pages always).
+fn pass(low: usize, scratch: &mut swap::Scratch) {
+    let high = low * 2;
+    let free = physical::free_frame_count();
+    let mut need = 0;
+    if free < low {
+        RUNS.fetch_add(1, Ordering::Relaxed);
+        need = (high - free).saturating_sub(shrink_caches(high - free));
+    }
+    let age = physical::free_frame_count() < low * 4;
+
+    let shm = crate::ipc::shared_memory::collect_sorted_shm_frames();
+    let mut table = Vec::new();
+    for (tid, pd) in crate::task::scheduler::user_address_spaces() {
+        let want = need.min(SWAP_BATCH);
+        if let Some((resident, swapped, freed)) = scan_process(pd, age, want, &shm, scratch) {
+            need = need.saturating_sub(freed);
+            table.push(ProcessMemory { tid, resident: resident as u32, swapped: swapped as u32 });
+        }
+    }
+    *PROCESS_MEMORY.lock() = table;
+}
+
+/// Age `pd` and swap out up to `want` of its cold pages.  Returns its
+/// resident and swapped-out pages and the frames freed, or `None` if the
+/// address space went away.
+fn scan_process(
+    pd: PhysAddr,
+    age: bool,
+    want: usize,
+    shm: &[PhysAddr],
+    scratch: &mut swap::Scratch,
+) -> Option<(usize, usize, usize)> {
+    if !crate::task::scheduler::pin_if_live(pd, &PINNED) {
+        return None;
+    }
+    let (keep, want) = match crate::memory::vma::swap_exclusions(pd) {
+        Some(keep) => (keep, want),
+        None => (Vec::new(), 0),
+    };
+    let mut pages = Vec::new();
+    let (resident, mut swapped) = virtual_mem::scan_user_pages(pd, age, want, &keep, shm, &mut pages);
+    let mut gone = Vec::new();
+    if !pages.is_empty() {
+        let slots: Vec<Option<u32>> = pages.iter().map(|p| swap::store(p.frame, scratch)).collect();
+        virtual_mem::finish_swap_out(pd, &pages, &slots, &mut gone);
+        let stored = slots.iter().filter(|s| s.is_some()).count();
+        swapped += stored;
+        gone.sort_unstable();
+        crate::ipc::futex::wake_frames(&gone);
+    }
+    PINNED.store(0, Ordering::SeqCst);
+    let freed = gone.len();
+    Some((resident.saturating_sub(freed), swapped, freed))
+}
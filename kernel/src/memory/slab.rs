@@ -0,0 +1,254 @@
+//! Size-class slab caches with per-CPU magazines in front of the kernel heap.
+//!
+//! Small allocations (up to 4 KiB, alignment ≤ 16) are served from one of
+//! nine power-of-two size classes.  Each CPU owns a small *magazine* of free
+//! objects per class which it pops/pushes with interrupts disabled and without
+//! taking any lock — the common case is O(1) and touches no shared cache line.
+//!
+//! When a magazine runs empty it refills half a magazine from the class
+//! *depot* (a per-class spinlock-protected free list).  When a magazine fills
+//! up it flushes half into the depot.  Only when the depot itself runs dry is
+//! a new slab chunk carved from the linked-list heap, which is the only point
+//! where the global heap lock is taken.
+//!
+//! Slab memory is never returned to the free-list heap; the per-class
+//! counters below make that overhead visible via [`slab_stats`].
+
+use crate::arch::hal::MAX_CPUS;
+use crate::sync::spinlock::Spinlock;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+/// Object sizes of the slab classes (bytes).
+pub const CLASS_SIZES: [usize; NUM_CLASSES] = [16, 32, 64, 128, 256, 512, 1024, 2048, 4096];
+/// Number of size classes.
+pub const NUM_CLASSES: usize = 9;
+/// Largest allocation served by the slab caches.
+pub const MAX_SLAB_SIZE: usize = 4096;
+
+/// Objects held per per-CPU magazine.
+const MAG_CAPACITY: usize = 32;
+/// Objects moved between a magazine and the depot in one transfer.
+const MAG_BATCH: usize = MAG_CAPACITY / 2;
+/// Bytes carved from the free-list heap each time a depot runs dry.
+const SLAB_CHUNK: usize = 32 * 1024;
+
+/// Intrusive free-list link stored inside each free object.
+#[repr(C)]
+struct FreeObj {
+    next: *mut FreeObj,
+}
+
+/// Per-CPU stack of free objects for one size class.
+#[derive(Clone, Copy)]
+struct Magazine {
+    count: usize,
+    objs: [*mut u8; MAG_CAPACITY],
+}
+
+impl Magazine {
+    const EMPTY: Magazine = Magazine { count: 0, objs: [core::ptr::null_mut(); MAG_CAPACITY] };
+}
+
+/// Shared per-class free list, refilled from the heap in `SLAB_CHUNK` pieces.
+struct Depot {
+    head: *mut FreeObj,
+    free: usize,
+}
+
+// SAFETY: the raw pointers only ever reference kernel heap memory and are
+// accessed under the depot spinlock.
+unsafe impl Send for Depot {}
+
+/// Per-CPU magazines, indexed `[cpu][class]`.
+///
+/// Only ever touched by the owning CPU with interrupts disabled, so no lock
+/// is needed: there is no preemption and no same-CPU ISR re-entry.
+static mut MAGAZINES: [[Magazine; NUM_CLASSES]; MAX_CPUS] =
+    [[Magazine::EMPTY; NUM_CLASSES]; MAX_CPUS];
+
+static DEPOTS: [Spinlock<Depot>; NUM_CLASSES] = {
+    const INIT: Spinlock<Depot> = Spinlock::new(Depot { head: core::ptr::null_mut(), free: 0 });
+    [INIT; NUM_CLASSES]
+};
+
+/// Bytes carved from the heap per class (never shrinks).
+static RESERVED: [AtomicUsize; NUM_CLASSES] = {
+    const INIT: AtomicUsize = AtomicUsize::new(0);
+    [INIT; NUM_CLASSES]
+};
+/// Objects currently handed out per class.
+static IN_USE: [AtomicUsize; NUM_CLASSES] = {
+    const INIT: AtomicUsize = AtomicUsize::new(0);
+    [INIT; NUM_CLASSES]
+};
+/// Depot refills that had to fall through to the free-list heap.
+static HEAP_REFILLS: AtomicUsize = AtomicUsize::new(0);
+
+/// Usage counters for a single size class.
+#[derive(Clone, Copy, Default)]
+pub struct SlabClassStats {
+    /// Object size of this class in bytes.
+    pub obj_size: usize,
+    /// Bytes carved from the kernel heap for this class.
+    pub reserved_bytes: usize,
+    /// Objects currently allocated from this class.
+    pub in_use: usize,
+}
+
+/// Map a layout to its size class, or `None` if it must go to the free-list heap.
+#[inline]
+pub fn class_for(size: usize, align: usize) -> Option<usize> {
+    if size > MAX_SLAB_SIZE || align > 16 {
+        return None;
+    }
+    let size = size.max(CLASS_SIZES[0]);
+    // Classes are consecutive powers of two starting at 16 (2^4).
+    let class = (usize::BITS - (size - 1).leading_zeros()) as usize - 4;
+    Some(class)
+}
+
+/// Allocate one object of the given class. Returns null on heap exhaustion.
+///
+/// # Safety
+/// Caller must pass a class index obtained from [`class_for`].
+pub unsafe fn alloc(class: usize) -> *mut u8 {
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let cpu = crate::arch::hal::cpu_id();
+
+    let ptr = if cpu < MAX_CPUS {
+        let mag = &mut MAGAZINES[cpu][class];
+        if mag.count == 0 {
+            refill_magazine(class, mag);
+        }
+        if mag.count > 0 {
+            mag.count -= 1;
+            mag.objs[mag.count]
+        } else {
+            core::ptr::null_mut()
+        }
+    } else {
+        depot_pop_one(class)
+    };
+
+    if !ptr.is_null() {
+        IN_USE[class].fetch_add(1, Ordering::Relaxed);
+    }
+    crate::arch::hal::restore_interrupt_state(flags);
+    ptr
+}
+
+/// Return one object to its class.
+///
+/// # Safety
+/// `ptr` must have been returned by [`alloc`] for the same `class`.
+pub unsafe fn dealloc(ptr: *mut u8, class: usize) {
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let cpu = crate::arch::hal::cpu_id();
+
+    if cpu < MAX_CPUS {
+        let mag = &mut MAGAZINES[cpu][class];
+        if mag.count == MAG_CAPACITY {
+            flush_magazine(class, mag);
+        }
+        mag.objs[mag.count] = ptr;
+        mag.count += 1;
+    } else {
+        let mut depot = DEPOTS[class].lock();
+        push_depot(&mut depot, ptr);
+    }
+
+    IN_USE[class].fetch_sub(1, Ordering::Relaxed);
+    crate::arch::hal::restore_interrupt_state(flags);
+}
+
+/// Move up to `MAG_BATCH` objects from the depot into an empty magazine,
+/// carving a fresh slab chunk from the heap if the depot is empty.
+unsafe fn refill_magazine(class: usize, mag: &mut Magazine) {
+    let mut depot = DEPOTS[class].lock();
+    if depot.head.is_null() && !grow_depot(class, &mut depot) {
+        return;
+    }
+    while mag.count < MAG_BATCH && !depot.head.is_null() {
+        let obj = depot.head;
+        depot.head = (*obj).next;
+        depot.free -= 1;
+        mag.objs[mag.count] = obj as *mut u8;
+        mag.count += 1;
+    }
+}
+
+/// Move the older half of a full magazine back into the depot.
+unsafe fn flush_magazine(class: usize, mag: &mut Magazine) {
+    let mut depot = DEPOTS[class].lock();
+    for i in 0..MAG_BATCH {
+        push_depot(&mut depot, mag.objs[i]);
+    }
+    mag.objs.copy_within(MAG_BATCH..MAG_CAPACITY, 0);
+    mag.count -= MAG_BATCH;
+}
+
+/// Slow path for CPUs without a magazine slot: pop straight from the depot.
+unsafe fn depot_pop_one(class: usize) -> *mut u8 {
+    let mut depot = DEPOTS[class].lock();
+    if depot.head.is_null() && !grow_depot(class, &mut depot) {
+        return core::ptr::null_mut();
+    }
+    let obj = depot.head;
+    depot.head = (*obj).next;
+    depot.free -= 1;
+    obj as *mut u8
+}
+
+#[inline]
+unsafe fn push_depot(depot: &mut Depot, ptr: *mut u8) {
+    let obj = ptr as *mut FreeObj;
+    (*obj).next = depot.head;
+    depot.head = obj;
+    depot.free += 1;
+}
+
+/// Carve one `SLAB_CHUNK` from the free-list heap and thread it onto the depot.
+/// Called with the depot lock held; takes the global heap lock internally.
+unsafe fn grow_depot(class: usize, depot: &mut Depot) -> bool {
+    let chunk = super::heap::alloc_slab_chunk(SLAB_CHUNK);
+    if chunk.is_null() {
+        return false;
+    }
+    HEAP_REFILLS.fetch_add(1, Ordering::Relaxed);
+    RESERVED[class].fetch_add(SLAB_CHUNK, Ordering::Relaxed);
+
+    let obj_size = CLASS_SIZES[class];
+    let count = SLAB_CHUNK / obj_size;
+    // Thread back-to-front so the depot hands out ascending addresses.
+    for i in (0..count).rev() {
+        push_depot(depot, chunk.add(i * obj_size));
+    }
+    true
+}
+
+/// Per-class slab usage counters (lock-free snapshot).
+pub fn slab_stats() -> [SlabClassStats; NUM_CLASSES] {
+    let mut out = [SlabClassStats::default(); NUM_CLASSES];
+    for (i, s) in out.iter_mut().enumerate() {
+        s.obj_size = CLASS_SIZES[i];
+        s.reserved_bytes = RESERVED[i].load(Ordering::Relaxed);
+        s.in_use = IN_USE[i].load(Ordering::Relaxed);
+    }
+    out
+}
+
+/// Returns (bytes_in_use, bytes_reserved) summed over all slab classes.
+pub fn slab_totals() -> (usize, usize) {
+    let mut used = 0usize;
+    let mut reserved = 0usize;
+    for i in 0..NUM_CLASSES {
+        used += IN_USE[i].load(Ordering::Relaxed) * CLASS_SIZES[i];
+        reserved += RESERVED[i].load(Ordering::Relaxed);
+    }
+    (used, reserved)
+}
+
+/// Number of depot refills that fell through to the free-list heap.
+pub fn heap_refills() -> usize {
+    HEAP_REFILLS.load(Ordering::Relaxed)
+}
@@ -0,0 +1,573 @@
+//! Swap space for anonymous user pages.
+//!
+//! The reclaim thread ([`crate::memory::reclaim`]) hands idle anonymous
+//! pages to [`store`], which keeps their contents in a *swap slot* and
+//! returns its number; the page table entry then holds the slot instead of
+//! a frame (see `virtual_mem::PTE_SWAP`).  A later fault on the page calls
+//! back into this module to fill a fresh frame.
+//!
+//! A page is kept, in order of preference:
+//! - as a single 64-bit pattern, if every word of it is the same (mostly
+//!   zero pages: untouched heap and stacks);
+//! - LZ4-compressed in RAM ("zram"), if it shrinks to at most
+//!   [`MAX_ZRAM_OBJECT`] bytes and the compressed store is below its limit.
+//!   Compressed pages are packed two to a frame, one at each end (zbud), so
+//!   a frame is freed as soon as both of its pages are gone;
+//! - uncompressed in the swap file, if one is configured.
+//!
+//! Pages that fit nowhere stay resident (the store is *rejected*).
+//!
+//! Slots are reference-counted: fork gives the child's entry its own
+//! reference ([`dup`]), and swapping a page back in or unmapping it drops
+//! one ([`release`]).
+//!
+//! Configuration comes from `/System/etc/swap.conf` (read by [`configure`]
+//! when the reclaim thread starts):
+//!
+//! | Key | Meaning | Default |
+//! |-----|---------|---------|
+//! | `zram_percent` | compressed store limit, % of RAM (0 = off) | 25 |
+//! | `swapfile` | path of the swap file (empty = none) | none |
+//! | `swapfile_mb` | size the swap file is created with | 64 |
+//!
+//! Lock order: COW lock (`virtual_mem`) → SWAP → physical allocator.  The
+//! swap file is only read and written with no lock held.
+
+use crate::memory::address::{PhysAddr, VirtAddr};
+use crate::memory::{lz4, physical, virtual_mem, FRAME_SIZE};
+use crate::sync::spinlock::Spinlock;
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+
+/// Largest compressed page kept in RAM; anything bigger saves too little.
+pub const MAX_ZRAM_OBJECT: usize = 3072;
+
+/// zbud allocation granule.
+const CHUNK: usize = 64;
+const CHUNKS: usize = FRAME_SIZE / CHUNK;
+
+/// Kernel temp VA a page being swapped out is read through.
+const SWAPOUT_TEMP: u64 = 0xFFFF_FFFF_BFF0_A000;
+/// Kernel temp VA zbud frames are accessed through (only under SWAP).
+const ZBUD_TEMP: u64 = 0xFFFF_FFFF_BFF0_B000;
+
+const CONF_PATH: &str = "/System/etc/swap.conf";
+
+/// Where a slot's page lives.
+#[derive(Clone, Copy)]
+enum Loc {
+    Free,
+    /// Every 8-byte word of the page holds this value.
+    Same(u64),
+    /// `len` compressed bytes at the start (`last == false`) or the end of
+    /// zbud frame `zf`.
+    Zbud { zf: u32, last: bool, len: u16 },
+    /// Page `idx` of the swap file.
+    Disk(u32),
+}
+
+struct Slot {
+    loc: Loc,
+    refs: u32,
+}
+
+/// A frame of the compressed store holding up to two pages.
+struct ZFrame {
+    /// Backing frame (0 = entry unused).
+    frame: u64,
+    /// Compressed length of the first / last buddy (0 = free).
+    first: u16,
+    last: u16,
+}
+
+impl ZFrame {
+    fn free_chunks(&self) -> usize {
+        CHUNKS - chunks(self.first as usize) - chunks(self.last as usize)
+    }
+}
+
+fn chunks(len: usize) -> usize {
+    (len + CHUNK - 1) / CHUNK
+}
+
+struct DiskSwap {
+    /// Open-file slot of the swap file.
+    file: u32,
+    /// One bit per page of the file.
+    used: Vec<u64>,
+    pages: u32,
+    in_use: u32,
+    /// Where the next free-page search starts.
+    hint: u32,
+}
+
+impl DiskSwap {
+    fn alloc(&mut self) -> Option<u32> {
+        if self.in_use >= self.pages {
+            return None;
+        }
+        for k in 0..self.pages {
+            let i = (self.hint + k) % self.pages;
+            let (w, b) = ((i / 64) as usize, i % 64);
+            if self.used[w] & (1 << b) == 0 {
+                self.used[w] |= 1 << b;
+                self.in_use += 1;
+                self.hint = i + 1;
+                return Some(i);
+            }
+        }
+        None
+    }
+
+    fn free(&mut self, i: u32) {
+        let (w, b) = ((i / 64) as usize, i % 64);
+        if self.used[w] & (1 << b) != 0 {
+            self.used[w] &= !(1 << b);
+            self.in_use -= 1;
+        }
+    }
+}
+
+struct Swap {
+    slots: Vec<Slot>,
+    free_slots: Vec<u32>,
+    zframes: Vec<ZFrame>,
+    free_zframes: Vec<u32>,
+    /// zbud frames with one buddy in use, by free chunks.
+    unbuddied: [Vec<u32>; CHUNKS + 1],
+    /// Compressed store limit in frames.
+    zram_limit: usize,
+    zram_frames: usize,
+    /// Pages held in RAM (compressed or same-filled) and their bytes.
+    zram_pages: usize,
+    zram_bytes: usize,
+    disk: Option<DiskSwap>,
+}
+
+const NO_FRAMES: Vec<u32> = Vec::new();
+
+static SWAP: Spinlock<Swap> = Spinlock::new(Swap {
+    slots: Vec::new(),
+    free_slots: Vec::new(),
+    zframes: Vec::new(),
+    free_zframes: Vec::new(),
+    unbuddied: [NO_FRAMES; CHUNKS + 1],
+    zram_limit: 0,
+    zram_frames: 0,
+    zram_pages: 0,
+    zram_bytes: 0,
+    disk: None,
+});
+
+/// Guards the `SWAPOUT_TEMP` window.
+static SWAPOUT_LOCK: Spinlock<()> = Spinlock::new(());
+
+/// Page table entries pointing at a slot (sum of all references).
+static ENTRIES: AtomicU64 = AtomicU64::new(0);
+/// Pages in the swap file; nonzero lets syscalls prefault user buffers.
+static DISK_PAGES: AtomicU32 = AtomicU32::new(0);
+static SWAP_OUTS: AtomicU64 = AtomicU64::new(0);
+static SWAP_INS: AtomicU64 = AtomicU64::new(0);
+static REJECTS: AtomicU64 = AtomicU64::new(0);
+
+/// Buffers for [`store`], owned by its caller (12 KiB, too big for a stack).
+pub struct Scratch {
+    page: [u8; FRAME_SIZE],
+    out: [u8; MAX_ZRAM_OBJECT],
+    table: [u16; lz4::HASH_SIZE],
+}
+
+impl Scratch {
+    pub fn new() -> Box<Scratch> {
+        // SAFETY: all-zero is a valid `Scratch` (plain arrays).
+        unsafe { Box::new_zeroed().assume_init() }
+    }
+}
+
+/// Counters reported by `sysinfo` (cmd 9).
+pub struct SwapStats {
+    /// Page table entries referring to swap.
+    pub entries: u64,
+    /// Pages kept in RAM, compressed or same-filled, and their size.
+    pub zram_pages: u32,
+    pub zram_bytes: u32,
+    /// Frames used by the compressed store and its limit.
+    pub zram_frames: u32,
+    pub zram_limit: u32,
+    /// Swap file pages in use and in total.
+    pub disk_used: u32,
+    pub disk_pages: u32,
+    pub swap_outs: u64,
+    pub swap_ins: u64,
+    /// Pages the store turned down (incompressible, no room).
+    pub rejects: u64,
+}
+
+/// Read the configuration and set up the swap file.  Called once by the
+/// reclaim thread (may block on file I/O).
+pub fn configure() {
+    let mut zram_percent = 25usize;
+    let mut swapfile = alloc::string::String::new();
+    let mut swapfile_mb = 64u32;
+    if let Ok(data) = crate::fs::vfs::read_file_to_vec(CONF_PATH) {
+        if let Ok(text) = core::str::from_utf8(&data) {
+            for line in text.split('\n') {
+                let line = line.trim();
+                if line.is_empty() || line.starts_with('#') {
+                    continue;
+                }
+                if let Some(idx) = line.find('=') {
+                    let val = line[idx + 1..].trim();
+                    match line[..idx].trim() {
+                        "zram_percent" => zram_percent = val.parse().unwrap_or(zram_percent).min(75),
+                        "swapfile" => swapfile = alloc::string::String::from(val),
+                        "swapfile_mb" => swapfile_mb = val.parse().unwrap_or(swapfile_mb).clamp(1, 4095),
+                        _ => {}
+                    }
+                }
+            }
+        }
+    }
+    let limit = physical::total_frames() * zram_percent / 100;
+    SWAP.lock().zram_limit = limit;
+
+    let disk = if swapfile.is_empty() { None } else { open_swapfile(&swapfile, swapfile_mb) };
+    let disk_pages = disk.as_ref().map_or(0, |d| d.pages);
+    SWAP.lock().disk = disk;
+    DISK_PAGES.store(disk_pages, Ordering::Release);
+    crate::serial_println!(
+        "[OK] swap: compressed store up to {} MiB, swap file {} MiB",
+        limit * FRAME_SIZE / (1024 * 1024),
+        disk_pages as usize * FRAME_SIZE / (1024 * 1024),
+    );
+}
+
+/// Open (creating and zero-filling if needed) a swap file of `mb` MiB.
+fn open_swapfile(path: &str, mb: u32) -> Option<DiskSwap> {
+    use crate::fs::file::FileFlags;
+    let flags = FileFlags { read: true, write: true, append: false, create: true, truncate: false };
+    let file = match crate::fs::vfs::open(path, flags) {
+        Ok(f) => f,
+        Err(e) => {
+            crate::serial_println!("swap: cannot open {}: {:?}", path, e);
+            return None;
+        }
+    };
+    let pages = mb * (1024 * 1024 / FRAME_SIZE as u32);
+    let size = crate::fs::vfs::fstat(file).map_or(0, |(_, size, _, _)| size);
+    // Allocate the whole file up front: swapping out must not need new
+    // clusters while memory is short.
+    let zeros = alloc::vec![0u8; 64 * 1024];
+    let mut off = size / zeros.len() as u32 * zeros.len() as u32;
+    let want = pages * FRAME_SIZE as u32;
+    while off < want {
+        let n = (want - off).min(zeros.len() as u32) as usize;
+        if !matches!(crate::fs::vfs::write_at(file, off, &zeros[..n]), Ok(w) if w == n) {
+            crate::serial_println!("swap: cannot grow {} to {} MiB", path, mb);
+            let _ = crate::fs::vfs::close(file);
+            return None;
+        }
+        off += n as u32;
+    }
+    Some(DiskSwap { file, used: alloc::vec![0; (pages as usize + 63) / 64], pages, in_use: 0, hint: 0 })
+}
+
+/// Whether any page may live in the swap file (its pages can only be read
+/// back with interrupts enabled).
+pub fn disk_enabled() -> bool {
+    DISK_PAGES.load(Ordering::Relaxed) != 0
+}
+
+/// Read back every swapped-out page of the user buffer `[ptr, ptr + len)`
+/// so a syscall can access it under its locks (where a swap-file read
+/// could not block).
+pub fn prefault(ptr: u64, len: u64) {
+    if len == 0 || !crate::arch::hal::interrupts_enabled() {
+        return;
+    }
+    let end = ptr.saturating_add(len).min(0x0000_8000_0000_0000);
+    let mut page = ptr & !(FRAME_SIZE as u64 - 1);
+    while page < end {
+        let pte = virtual_mem::read_pte(VirtAddr::new(page));
+        if pte & virtual_mem::PTE_SWAP != 0 && !virtual_mem::handle_swap_fault(page, true) {
+            return;
+        }
+        page += FRAME_SIZE as u64;
+    }
+}
+
+impl Swap {
+    fn new_slot(&mut self, loc: Loc) -> u32 {
+        let slot = Slot { loc, refs: 1 };
+        match self.free_slots.pop() {
+            Some(i) => {
+                self.slots[i as usize] = slot;
+                i
+            }
+            None => {
+                self.slots.push(slot);
+                (self.slots.len() - 1) as u32
+            }
+        }
+    }
+
+    /// Place `data` in a zbud frame.  Returns `(frame index, last)`.
+    fn zbud_alloc(&mut self, len: usize) -> Option<(u32, bool)> {
+        let need = chunks(len);
+        let found = (need..=CHUNKS).find(|&c| !self.unbuddied[c].is_empty());
+        if let Some(c) = found {
+            let zf = self.unbuddied[c].pop().unwrap();
+            let z = &mut self.zframes[zf as usize];
+            let last = z.first != 0;
+            if last { z.last = len as u16 } else { z.first = len as u16 }
+            return Some((zf, last));
+        }
+        if self.zram_frames >= self.zram_limit {
+            return None;
+        }
+        let frame = physical::alloc_frame()?;
+        let z = ZFrame { frame: frame.as_u64(), first: len as u16, last: 0 };
+        let zf = match self.free_zframes.pop() {
+            Some(i) => {
+                self.zframes[i as usize] = z;
+                i
+            }
+            None => {
+                self.zframes.push(z);
+                (self.zframes.len() - 1) as u32
+            }
+        };
+        self.zram_frames += 1;
+        self.unbuddied[CHUNKS - need].push(zf);
+        Some((zf, false))
+    }
+
+    fn zbud_free(&mut self, zf: u32, last: bool) {
+        let free_before = self.zframes[zf as usize].free_chunks();
+        let z = &mut self.zframes[zf as usize];
+        let both = z.first != 0 && z.last != 0;
+        if last { z.last = 0 } else { z.first = 0 }
+        if both {
+            let c = self.zframes[zf as usize].free_chunks();
+            self.unbuddied[c].push(zf);
+            return;
+        }
+        // Its only page is gone: take it off the unbuddied list and free it.
+        let list = &mut self.unbuddied[free_before];
+        if let Some(pos) = list.iter().position(|&i| i == zf) {
+            list.swap_remove(pos);
+        }
+        let frame = core::mem::replace(&mut self.zframes[zf as usize].frame, 0);
+        physical::free_frame(PhysAddr::new(frame));
+        self.free_zframes.push(zf);
+        self.zram_frames -= 1;
+    }
+
+    /// Kernel pointer to a zbud object, through the `ZBUD_TEMP` window
+    /// (mapped by the caller).
+    fn zbud_ptr(&self, zf: u32, last: bool, len: usize) -> *mut u8 {
+        let off = if last { FRAME_SIZE - chunks(len) * CHUNK } else { 0 };
+        let frame = self.zframes[zf as usize].frame;
+        virtual_mem::map_page(VirtAddr::new(ZBUD_TEMP), PhysAddr::new(frame), 0x02);
+        (ZBUD_TEMP + off as u64) as *mut u8
+    }
+
+    fn free_loc(&mut self, loc: Loc) {
+        match loc {
+            Loc::Free | Loc::Same(_) => {}
+            Loc::Zbud { zf, last, len } => {
+                self.zram_bytes -= len as usize;
+                self.zbud_free(zf, last);
+            }
+            Loc::Disk(idx) => {
+                if let Some(d) = self.disk.as_mut() {
+                    d.free(idx);
+                }
+            }
+        }
+        if !matches!(loc, Loc::Disk(_) | Loc::Free) {
+            self.zram_pages -= 1;
+        }
+    }
+}
+
+/// Save the contents of `frame` (an anonymous page the caller has unmapped
+/// everywhere) in a new slot.  Returns the slot, or `None` if the page has
+/// to stay resident.  May write the swap file: call with IF=1 and no lock.
+pub fn store(frame: PhysAddr, scratch: &mut Scratch) -> Option<u32> {
+    {
+        let _window = SWAPOUT_LOCK.lock();
+        let temp = VirtAddr::new(SWAPOUT_TEMP);
+        virtual_mem::map_page(temp, frame, 0x02);
+        unsafe {
+            crate::memory::memops::copy_page(scratch.page.as_mut_ptr(), SWAPOUT_TEMP as *const u8);
+        }
+        virtual_mem::unmap_page(temp);
+    }
+
+    let first = u64::from_ne_bytes(scratch.page[..8].try_into().unwrap());
+    let same = scratch.page.chunks_exact(8).all(|w| u64::from_ne_bytes(w.try_into().unwrap()) == first);
+    let packed = if same {
+        None
+    } else {
+        lz4::compress(&scratch.page, &mut scratch.out, &mut scratch.table)
+    };
+
+    let disk_idx = {
+        let mut swap = SWAP.lock();
+        if same {
+            swap.zram_pages += 1;
+            let slot = swap.new_slot(Loc::Same(first));
+            drop(swap);
+            return Some(stored(slot));
+        }
+        if let Some(len) = packed {
+            if let Some((zf, last)) = swap.zbud_alloc(len) {
+                let dst = swap.zbud_ptr(zf, last, len);
+                unsafe { core::ptr::copy_nonoverlapping(scratch.out.as_ptr(), dst, len) };
+                virtual_mem::unmap_page(VirtAddr::new(ZBUD_TEMP));
+                swap.zram_pages += 1;
+                swap.zram_bytes += len;
+                let slot = swap.new_slot(Loc::Zbud { zf, last, len: len as u16 });
+                drop(swap);
+                return Some(stored(slot));
+            }
+        }
+        match swap.disk.as_mut().and_then(|d| d.alloc().map(|i| (d.file, i))) {
+            Some(at) => at,
+            None => {
+                drop(swap);
+                REJECTS.fetch_add(1, Ordering::Relaxed);
+                return None;
+            }
+        }
+    };
+
+    let (file, idx) = disk_idx;
+    let off = idx * FRAME_SIZE as u32;
+    if !matches!(crate::fs::vfs::write_at(file, off, &scratch.page), Ok(FRAME_SIZE)) {
+        if let Some(d) = SWAP.lock().disk.as_mut() {
+            d.free(idx);
+        }
+        REJECTS.fetch_add(1, Ordering::Relaxed);
+        return None;
+    }
+    let slot = SWAP.lock().new_slot(Loc::Disk(idx));
+    Some(stored(slot))
+}
+
+fn stored(slot: u32) -> u32 {
+    ENTRIES.fetch_add(1, Ordering::Relaxed);
+    SWAP_OUTS.fetch_add(1, Ordering::Relaxed);
+    slot
+}
+
+/// Whether `slot` is held in RAM (readable in any context).
+pub fn in_ram(slot: u32) -> bool {
+    let swap = SWAP.lock();
+    swap.slots.get(slot as usize).map_or(false, |s| !matches!(s.loc, Loc::Disk(_) | Loc::Free))
+}
+
+/// Fill the page at `dst` from a RAM-held `slot`.  Returns `false` if the
+/// slot is not in RAM or its data is corrupt.
+///
+/// # Safety
+/// `dst` must be a mapped, writable page.
+pub unsafe fn load_ram(slot: u32, dst: *mut u8) -> bool {
+    let swap = SWAP.lock();
+    let loc = match swap.slots.get(slot as usize) {
+        Some(s) => s.loc,
+        None => return false,
+    };
+    let ok = match loc {
+        Loc::Same(v) => {
+            let words = dst as *mut u64;
+            for i in 0..FRAME_SIZE / 8 {
+                words.add(i).write(v);
+            }
+            true
+        }
+        Loc::Zbud { zf, last, len } => {
+            let src = swap.zbud_ptr(zf, last, len as usize);
+            let src = core::slice::from_raw_parts(src, len as usize);
+            let out = core::slice::from_raw_parts_mut(dst, FRAME_SIZE);
+            let n = lz4::decompress(src, out);
+            virtual_mem::unmap_page(VirtAddr::new(ZBUD_TEMP));
+            n == Some(FRAME_SIZE)
+        }
+        Loc::Disk(_) | Loc::Free => false,
+    };
+    if ok {
+        SWAP_INS.fetch_add(1, Ordering::Relaxed);
+    }
+    ok
+}
+
+/// Read a slot held in the swap file into `buf`.  Blocks: call with IF=1,
+/// no lock held, and a reference on `slot` so it cannot be reused meanwhile.
+pub fn load_disk(slot: u32, buf: &mut [u8]) -> bool {
+    let at = {
+        let swap = SWAP.lock();
+        match (swap.slots.get(slot as usize).map(|s| s.loc), swap.disk.as_ref()) {
+            (Some(Loc::Disk(idx)), Some(d)) => Some((d.file, idx)),
+            _ => None,
+        }
+    };
+    let Some((file, idx)) = at else { return false };
+    let mut done = 0;
+    while done < FRAME_SIZE {
+        let off = idx * FRAME_SIZE as u32 + done as u32;
+        match crate::fs::vfs::read_at(file, off, &mut buf[done..FRAME_SIZE]) {
+            Ok(0) | Err(_) => return false,
+            Ok(n) => done += n,
+        }
+    }
+    SWAP_INS.fetch_add(1, Ordering::Relaxed);
+    true
+}
+
+/// Add a reference to `slot` (fork copies the entry, or a swap-in holds
+/// the slot across a file read).
+pub fn dup(slot: u32) {
+    let mut swap = SWAP.lock();
+    if let Some(s) = swap.slots.get_mut(slot as usize) {
+        s.refs += 1;
+        ENTRIES.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Drop a reference to `slot`; the last one frees its storage.
+pub fn release(slot: u32) {
+    let mut swap = SWAP.lock();
+    let loc = match swap.slots.get_mut(slot as usize) {
+        Some(s) if s.refs > 0 => {
+            s.refs -= 1;
+            ENTRIES.fetch_sub(1, Ordering::Relaxed);
+            if s.refs > 0 {
+                return;
+            }
+            core::mem::replace(&mut s.loc, Loc::Free)
+        }
+        _ => return,
+    };
+    swap.free_loc(loc);
+    swap.free_slots.push(slot);
+}
+
+/// Snapshot of the swap counters.
+pub fn stats() -> SwapStats {
+    let swap = SWAP.lock();
+    SwapStats {
+        entries: ENTRIES.load(Ordering::Relaxed),
+        zram_pages: swap.zram_pages as u32,
+        zram_bytes: swap.zram_bytes as u32,
+        zram_frames: swap.zram_frames as u32,
+        zram_limit: swap.zram_limit as u32,
+        disk_used: swap.disk.as_ref().map_or(0, |d| d.in_use),
+        disk_pages: swap.disk.as_ref().map_or(0, |d| d.pages),
+        swap_outs: SWAP_OUTS.load(Ordering::Relaxed),
+        swap_ins: SWAP_INS.load(Ordering::Relaxed),
+        rejects: REJECTS.load(Ordering::Relaxed),
+    }
+}
@@ -9,10 +9,11 @@
 
 use crate::boot_info::BootInfo;
 use crate::memory::address::{PhysAddr, VirtAddr};
-use crate::memory::physical;
+use crate::memory::{memops, physical};
 use crate::memory::FRAME_SIZE;
 use core::arch::asm;
-use core::sync::atomic::{AtomicBool, AtomicU16, Ordering};
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU16, AtomicU64, Ordering};
 
 /// Spinlock for serializing demand page faults across CPUs.
 /// Prevents TOCTOU race where two CPUs fault on the same unmapped page simultaneously,
@@ -78,6 +79,66 @@ pub fn enable_pcid() {
     crate::serial_println!("[OK] PCID enabled (CR4.PCIDE=1) — TLB preserved across context switches");
 }
 
+/// Flush every TLB entry on this CPU, for all PCIDs and including global pages.
+///
+/// A CR3 reload only drops the current PCID's entries; toggling CR4.PGE
+/// invalidates everything.  Used after rewriting PTEs of an address space
+/// that may be cached under another PCID (copy-on-write fork).
+pub fn flush_tlb_all_contexts() {
+    // Any CR4 write that changes PGE flushes all PCIDs; flip it and restore.
+    unsafe {
+        let cr4: u64;
+        asm!("mov {}, cr4", out(reg) cr4, options(nostack, nomem, preserves_flags));
+        asm!("mov cr4, {}", in(reg) cr4 ^ CR4_PGE, options(nostack, preserves_flags));
+        asm!("mov cr4, {}", in(reg) cr4, options(nostack, preserves_flags));
+    }
+}
+
+/// Flush every TLB entry tagged with `pcid` on this CPU (other PCIDs keep
+/// theirs).  Uses INVPCID single-context when available, otherwise falls
+/// back to [`flush_tlb_all_contexts`].
+pub fn flush_pcid(pcid: u16) {
+    #[cfg(target_arch = "x86_64")]
+    if crate::arch::x86::cpuid::features().invpcid {
+        let desc: [u64; 2] = [pcid as u64, 0];
+        unsafe {
+            asm!("invpcid {}, [{}]", in(reg) 1u64, in(reg) desc.as_ptr(), options(nostack, preserves_flags));
+        }
+        return;
+    }
+    flush_tlb_all_contexts();
+}
+
+/// CR4.PGE (global pages enable).
+const CR4_PGE: u64 = 1 << 7;
+/// CR0.WP (supervisor write protect).
+const CR0_WP: u64 = 1 << 16;
+
+/// Make ring-0 writes honour read-only PTEs (CR0.WP=1).
+///
+/// Required for copy-on-write: a syscall writing into a user buffer that is
+/// still shared with a forked process must fault so the page gets copied.
+/// Called on the BSP once the heap is up and on each AP in `ap_entry()`.
+pub fn enable_write_protect() {
+    set_write_protect(true);
+}
+
+/// Set or clear CR0.WP on this CPU. Returns the previous state.
+///
+/// The ELF loader clears it briefly to fill read-only segments of a freshly
+/// created address space (no frame there is shared yet).
+pub fn set_write_protect(enabled: bool) -> bool {
+    unsafe {
+        let cr0: u64;
+        asm!("mov {}, cr0", out(reg) cr0, options(nostack, nomem, preserves_flags));
+        let new = if enabled { cr0 | CR0_WP } else { cr0 & !CR0_WP };
+        if new != cr0 {
+            asm!("mov cr0, {}", in(reg) new, options(nostack, preserves_flags));
+        }
+        cr0 & CR0_WP != 0
+    }
+}
+
 /// Page table entry flag: page is present in physical memory.
 const PAGE_PRESENT: u64 = 1 << 0;
 /// Page table entry flag: page is writable.
@@ -87,6 +148,19 @@ const PAGE_USER: u64 = 1 << 2;
 /// Page table entry flag: Page-level Write-Through.
 /// With PAT1 reprogrammed to WC, PWT=1 selects Write-Combining.
 const PAGE_PWT: u64 = 1 << 3;
+/// Page table entry flag: Page-level Cache Disable.
+const PAGE_PCD: u64 = 1 << 4;
+/// Page table entry flag: set by the CPU on any access to the page.
+const PAGE_ACCESSED: u64 = 1 << 5;
+/// Page table entry flag: set by the CPU on the first write to the page.
+const PAGE_DIRTY: u64 = 1 << 6;
+/// Page-size bit of a PDE: the entry maps a 2 MiB page instead of a PT.
+const PAGE_HUGE: u64 = 1 << 7;
+/// PAT bit of a 4K PTE.  The same bit is PAGE_HUGE in a PDE, so a huge
+/// PDE carries PAT in bit 12 ([`PDE_PAT`]) instead.
+const PTE_PAT: u64 = 1 << 7;
+/// PAT bit of a 2 MiB PDE.
+const PDE_PAT: u64 = 1 << 12;
 
 /// OS-available PTE bit 9: VRAM page — do NOT free_frame on process exit.
 /// Used for pages mapped from the GPU's framebuffer into user processes.
@@ -100,6 +174,31 @@ pub const PTE_VRAM: u64 = 1 << 9;
 /// new frame, letting the kernel page-fault handler report a stack overflow.
 pub const PTE_GUARD: u64 = 1 << 10;
 
+/// OS-available PTE bit 11: copy-on-write page.
+///
+/// Set together with PAGE_WRITABLE=0 on private pages shared between a
+/// forked parent and child.  A write fault on such a page is resolved by
+/// [`handle_cow_fault`]; the frame is reference-counted in `physical`.
+pub const PTE_COW: u64 = 1 << 11;
+
+/// OS-available PTE bit 52: swapped-out user page.
+///
+/// Set with PAGE_PRESENT=0.  Bits 12-51 hold the swap slot (see
+/// `memory::swap`) instead of a frame; the other bits keep the page's
+/// flags.  A fault on the page reads it back ([`handle_swap_fault`]).
+pub const PTE_SWAP: u64 = 1 << 52;
+
+/// OS-available PTE bit 53: user page being swapped out.
+///
+/// Set with PAGE_PRESENT=0 while the reclaim thread copies the page to
+/// swap; the frame stays in bits 12-51.  A fault in this window simply
+/// makes the page present again, and the reclaim thread then keeps it.
+pub const PTE_SWAP_PENDING: u64 = 1 << 53;
+
+/// OS-available PTE bit 54: the page was not accessed between the last two
+/// reclaim scans; the next scan that finds it still unaccessed swaps it.
+const PTE_IDLE: u64 = 1 << 54;
+
 /// Page table entry flag: No-Execute (NX / Execute Disable).
 /// Bit 63 of a leaf PTE. Requires EFER.NXE=1 (set in syscall_msr::setup_msrs).
 /// Without EFER.NXE the CPU treats bit 63 as reserved and raises #GP on access.
@@ -123,6 +222,15 @@ const ENTRIES_PER_TABLE: usize = 512;
 /// Mask to extract the physical address from a page table entry (bits 12..51).
 const ADDR_MASK: u64 = 0x000F_FFFF_FFFF_F000;
 
+/// Mask to extract the physical address from a 2 MiB PDE (bits 21..51).
+const HUGE_ADDR_MASK: u64 = 0x000F_FFFF_FFE0_0000;
+
+/// Size of a 2 MiB huge page.
+pub const HUGE_PAGE_SIZE: usize = 2 * 1024 * 1024;
+
+/// Number of 4K pages covered by one huge page.
+pub const PAGES_PER_HUGE_PAGE: usize = HUGE_PAGE_SIZE / FRAME_SIZE;
+
 /// Kernel higher-half virtual base (must match link.ld).
 const KERNEL_VIRT_BASE: u64 = 0xFFFF_FFFF_8000_0000;
 
@@ -396,58 +504,116 @@ fn ensure_table_entry(table: *mut u64, index: usize, flags: u64) -> u64 {
     }
 }
 
-/// Map a single 4K page: virtual -> physical.
+/// Ensure the PDPT and PD covering `virt` exist in the current address space
+/// and return a pointer to the PDE slot for `virt`.
 ///
-/// Uses recursive mapping via PML4[510] to access page table structures.
-pub fn map_page(virt: VirtAddr, phys: PhysAddr, flags: u64) {
+/// Newly created tables are zeroed through the recursive mapping; existing
+/// upper-level entries are promoted to user-accessible when `flags` has
+/// PAGE_USER.
+unsafe fn ensure_pd(virt: VirtAddr, flags: u64) -> *mut u64 {
     let pml4_ptr = RECURSIVE_PML4_BASE as *mut u64;
     let pml4i = virt.pml4_index();
     let pdpti = virt.pdpt_index();
-    let pdi = virt.pd_index();
+
+    // Ensure PDPT exists
+    let pml4e = pml4_ptr.add(pml4i).read_volatile();
+    if pml4e & PAGE_PRESENT == 0 {
+        let new_frame = physical::alloc_frame().expect("Failed to allocate PDPT");
+        pml4_ptr.add(pml4i).write_volatile(new_frame.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (flags & PAGE_USER));
+        // Zero the new PDPT via recursive mapping
+        let pdpt_base = recursive_pdpt_base(virt) as *mut u8;
+        // Flush TLB for the recursive address so we can access the new table
+        asm!("invlpg [{}]", in(reg) pdpt_base, options(nostack, preserves_flags));
+        core::ptr::write_bytes(pdpt_base, 0, FRAME_SIZE);
+    } else if flags & PAGE_USER != 0 && pml4e & PAGE_USER == 0 {
+        // Promote existing entry to user-accessible
+        pml4_ptr.add(pml4i).write_volatile(pml4e | PAGE_USER);
+    }
+
+    // Ensure PD exists
+    let pdpt_ptr = recursive_pdpt_base(virt) as *mut u64;
+    let pdpte = pdpt_ptr.add(pdpti).read_volatile();
+    if pdpte & PAGE_PRESENT == 0 {
+        let new_frame = physical::alloc_frame().expect("Failed to allocate PD");
+        pdpt_ptr.add(pdpti).write_volatile(new_frame.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (flags & PAGE_USER));
+        let pd_base = recursive_pd_base(virt) as *mut u8;
+        asm!("invlpg [{}]", in(reg) pd_base, options(nostack, preserves_flags));
+        core::ptr::write_bytes(pd_base, 0, FRAME_SIZE);
+    } else if flags & PAGE_USER != 0 && pdpte & PAGE_USER == 0 {
+        // Promote existing entry to user-accessible
+        pdpt_ptr.add(pdpti).write_volatile(pdpte | PAGE_USER);
+    }
+
+    (recursive_pd_base(virt) as *mut u64).add(virt.pd_index())
+}
+
+/// Pointer to the PDE slot for `virt` in the current address space, or
+/// `None` if its PML4 or PDPT entry is not present.
+unsafe fn pde_slot(virt: VirtAddr) -> Option<*mut u64> {
+    let pml4_ptr = RECURSIVE_PML4_BASE as *const u64;
+    if pml4_ptr.add(virt.pml4_index()).read_volatile() & PAGE_PRESENT == 0 {
+        return None;
+    }
+    let pdpt_ptr = recursive_pdpt_base(virt) as *const u64;
+    if pdpt_ptr.add(virt.pdpt_index()).read_volatile() & PAGE_PRESENT == 0 {
+        return None;
+    }
+    Some((recursive_pd_base(virt) as *mut u64).add(virt.pd_index()))
+}
+
+/// Pointer to the 4K PTE slot for `virt` in the current address space, or
+/// `None` if no page table covers it (unmapped, or inside a 2 MiB page).
+unsafe fn pte_slot(virt: VirtAddr) -> Option<*mut u64> {
+    let pde = pde_slot(virt)?.read_volatile();
+    if pde & (PAGE_PRESENT | PAGE_HUGE) != PAGE_PRESENT {
+        return None;
+    }
+    Some((recursive_pt_base(virt) as *mut u64).add(virt.pt_index()))
+}
+
+/// True if `pde` is a present 2 MiB mapping rather than a page table pointer.
+#[inline]
+fn is_huge_pde(pde: u64) -> bool {
+    pde & (PAGE_PRESENT | PAGE_HUGE) == PAGE_PRESENT | PAGE_HUGE
+}
+
+/// The 4K PTE equivalent to 4K page `pti` of the huge mapping `pde`.
+#[inline]
+fn huge_pde_to_pte(pde: u64, pti: usize) -> u64 {
+    let pat = if pde & PDE_PAT != 0 { PTE_PAT } else { 0 };
+    ((pde & HUGE_ADDR_MASK) + ((pti as u64) << 12))
+        | (pde & 0xFFF & !PAGE_HUGE)
+        | pat
+        | (pde & PAGE_NX)
+}
+
+/// Map a single 4K page: virtual -> physical.
+///
+/// Uses recursive mapping via PML4[510] to access page table structures.
+/// A 2 MiB page covering `virt` is split first (see [`split_huge_page`]).
+pub fn map_page(virt: VirtAddr, phys: PhysAddr, flags: u64) {
     let pti = virt.pt_index();
 
     unsafe {
-        // Ensure PDPT exists
-        let pml4e = pml4_ptr.add(pml4i).read_volatile();
-        if pml4e & PAGE_PRESENT == 0 {
-            let new_frame = physical::alloc_frame().expect("Failed to allocate PDPT");
-            pml4_ptr.add(pml4i).write_volatile(new_frame.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (flags & PAGE_USER));
-            // Zero the new PDPT via recursive mapping
-            let pdpt_base = recursive_pdpt_base(virt) as *mut u8;
-            // Flush TLB for the recursive address so we can access the new table
-            asm!("invlpg [{}]", in(reg) pdpt_base, options(nostack, preserves_flags));
-            core::ptr::write_bytes(pdpt_base, 0, FRAME_SIZE);
-        } else if flags & PAGE_USER != 0 && pml4e & PAGE_USER == 0 {
-            // Promote existing entry to user-accessible
-            pml4_ptr.add(pml4i).write_volatile(pml4e | PAGE_USER);
-        }
-
-        // Ensure PD exists
-        let pdpt_ptr = recursive_pdpt_base(virt) as *mut u64;
-        let pdpte = pdpt_ptr.add(pdpti).read_volatile();
-        if pdpte & PAGE_PRESENT == 0 {
-            let new_frame = physical::alloc_frame().expect("Failed to allocate PD");
-            pdpt_ptr.add(pdpti).write_volatile(new_frame.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (flags & PAGE_USER));
-            let pd_base = recursive_pd_base(virt) as *mut u8;
-            asm!("invlpg [{}]", in(reg) pd_base, options(nostack, preserves_flags));
-            core::ptr::write_bytes(pd_base, 0, FRAME_SIZE);
-        } else if flags & PAGE_USER != 0 && pdpte & PAGE_USER == 0 {
-            // Promote existing entry to user-accessible
-            pdpt_ptr.add(pdpti).write_volatile(pdpte | PAGE_USER);
-        }
+        let pde_ptr = ensure_pd(virt, flags);
 
         // Ensure PT exists
-        let pd_ptr = recursive_pd_base(virt) as *mut u64;
-        let pde = pd_ptr.add(pdi).read_volatile();
+        let mut pde = pde_ptr.read_volatile();
+        if is_huge_pde(pde) {
+            if !split_huge_page(virt) {
+                panic!("Failed to allocate PT");
+            }
+            pde = pde_ptr.read_volatile();
+        }
         if pde & PAGE_PRESENT == 0 {
             let new_frame = physical::alloc_frame().expect("Failed to allocate PT");
-            pd_ptr.add(pdi).write_volatile(new_frame.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (flags & PAGE_USER));
+            pde_ptr.write_volatile(new_frame.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (flags & PAGE_USER));
             let pt_base = recursive_pt_base(virt) as *mut u8;
             asm!("invlpg [{}]", in(reg) pt_base, options(nostack, preserves_flags));
             core::ptr::write_bytes(pt_base, 0, FRAME_SIZE);
         } else if flags & PAGE_USER != 0 && pde & PAGE_USER == 0 {
             // Promote existing entry to user-accessible
-            pd_ptr.add(pdi).write_volatile(pde | PAGE_USER);
+            pde_ptr.write_volatile(pde | PAGE_USER);
         }
 
         // Set the PTE
@@ -459,34 +625,122 @@ pub fn map_page(virt: VirtAddr, phys: PhysAddr, flags: u64) {
     }
 }
 
-/// Unmap a single 4K page.
-pub fn unmap_page(virt: VirtAddr) {
-    let pml4i = virt.pml4_index();
-    let pdpti = virt.pdpt_index();
-    let pdi = virt.pd_index();
-    let pti = virt.pt_index();
+/// Map a 2 MiB page: `virt` and `phys` must both be 2 MiB aligned.
+///
+/// `flags` use the 4K PTE layout; the PAT bit is moved to its PDE position.
+/// An existing huge mapping of the slot is replaced.  Returns `false`
+/// without changing anything if the addresses are misaligned or the slot
+/// already holds a page table — the caller then falls back to [`map_page`].
+pub fn map_huge_page(virt: VirtAddr, phys: PhysAddr, flags: u64) -> bool {
+    let mask = HUGE_PAGE_SIZE as u64 - 1;
+    if virt.as_u64() & mask != 0 || phys.as_u64() & mask != 0 {
+        return false;
+    }
+    unsafe {
+        let pde_ptr = ensure_pd(virt, flags);
+        let pde = pde_ptr.read_volatile();
+        if pde & PAGE_PRESENT != 0 && pde & PAGE_HUGE == 0 {
+            return false;
+        }
+        let pat = if flags & PTE_PAT != 0 { PDE_PAT } else { 0 };
+        pde_ptr.write_volatile(phys.as_u64() | (flags & !PTE_PAT) | pat | PAGE_HUGE | PAGE_PRESENT);
+        asm!("invlpg [{}]", in(reg) virt.as_u64(), options(nostack, preserves_flags));
+    }
+    true
+}
+
+/// Map `pages` 4K pages of the physically contiguous range at `phys` to
+/// `virt`, using 2 MiB pages wherever both addresses are 2 MiB aligned and a
+/// whole huge page remains, and 4K pages elsewhere.
+///
+/// For device memory (framebuffers, VRAM apertures) whose frames the
+/// allocator does not own.
+pub fn map_contiguous(virt: VirtAddr, phys: PhysAddr, pages: usize, flags: u64) {
+    let mut i = 0;
+    while i < pages {
+        let va = VirtAddr::new(virt.as_u64() + (i * FRAME_SIZE) as u64);
+        let pa = PhysAddr::new(phys.as_u64() + (i * FRAME_SIZE) as u64);
+        if pages - i >= PAGES_PER_HUGE_PAGE && map_huge_page(va, pa, flags) {
+            i += PAGES_PER_HUGE_PAGE;
+        } else {
+            map_page(va, pa, flags);
+            i += 1;
+        }
+    }
+}
+
+/// Kernel temp VA used by [`split_huge_page`] to fill the new page table.
+const SPLIT_TEMP: u64 = 0xFFFF_FFFF_BFF0_6000;
 
+/// Serializes huge page splits and guards the `SPLIT_TEMP` window.
+///
+/// Lock order: COW_LOCK → SPLIT_LOCK → physical allocator.
+static SPLIT_LOCK: Spinlock<()> = Spinlock::new(());
+
+/// Demote the 2 MiB page covering `virt` to a page table of 512 4K PTEs with
+/// the same translation and flags.  No-op if `virt` is not in a huge page.
+///
+/// The table is fully populated before it replaces the PDE, so a CPU walking
+/// concurrently sees either the huge page or identical 4K pages and no
+/// shootdown is needed; only the local huge TLB entry is dropped.  Other
+/// CPUs may keep using their huge entry until the caller's own flush for the
+/// change that required the split.
+///
+/// Returns `false` if no frame is left for the page table.
+pub fn split_huge_page(virt: VirtAddr) -> bool {
+    let _guard = SPLIT_LOCK.lock();
     unsafe {
-        // Check PML4
-        let pml4_ptr = RECURSIVE_PML4_BASE as *mut u64;
-        let pml4e = pml4_ptr.add(pml4i).read_volatile();
-        if pml4e & PAGE_PRESENT == 0 {
-            return;
+        let pde_ptr = match pde_slot(virt) {
+            Some(p) => p,
+            None => return true,
+        };
+        let pde = pde_ptr.read_volatile();
+        if !is_huge_pde(pde) {
+            return true;
         }
+        let pt = match physical::alloc_frame() {
+            Some(f) => f,
+            None => return false,
+        };
 
-        // Check PDPT
-        let pdpt_ptr = recursive_pdpt_base(virt) as *mut u64;
-        let pdpte = pdpt_ptr.add(pdpti).read_volatile();
-        if pdpte & PAGE_PRESENT == 0 {
-            return;
+        let temp = VirtAddr::new(SPLIT_TEMP);
+        map_page(temp, pt, PAGE_WRITABLE);
+        let table = SPLIT_TEMP as *mut u64;
+        for pti in 0..ENTRIES_PER_TABLE {
+            table.add(pti).write_volatile(huge_pde_to_pte(pde, pti));
         }
+        unmap_page(temp);
+
+        pde_ptr.write_volatile(pt.as_u64() | PAGE_PRESENT | PAGE_WRITABLE | (pde & PAGE_USER));
+        let huge_base = virt.as_u64() & !(HUGE_PAGE_SIZE as u64 - 1);
+        asm!("invlpg [{}]", in(reg) huge_base, options(nostack, preserves_flags));
+        asm!("invlpg [{}]", in(reg) recursive_pt_base(virt), options(nostack, preserves_flags));
+    }
+    true
+}
+
+/// Unmap a single 4K page.
+///
+/// A 2 MiB page covering `virt` is split first, leaving its other 511 pages
+/// mapped.
+pub fn unmap_page(virt: VirtAddr) {
+    let pti = virt.pt_index();
+
+    unsafe {
+        // Check PML4 and PDPT
+        let pde_ptr = match pde_slot(virt) {
+            Some(p) => p,
+            None => return,
+        };
 
         // Check PD
-        let pd_ptr = recursive_pd_base(virt) as *mut u64;
-        let pde = pd_ptr.add(pdi).read_volatile();
+        let pde = pde_ptr.read_volatile();
         if pde & PAGE_PRESENT == 0 {
             return;
         }
+        if pde & PAGE_HUGE != 0 && !split_huge_page(virt) {
+            panic!("Failed to allocate PT for huge page split");
+        }
 
         // Clear PTE
         let pt_ptr = recursive_pt_base(virt) as *mut u64;
@@ -496,62 +750,69 @@ pub fn unmap_page(virt: VirtAddr) {
     }
 }
 
+/// Unmap `pages` consecutive 4K pages starting at `virt` and flush them from
+/// every CPU's TLB with one batched shootdown.
+///
+/// Prefer this over a loop of [`unmap_page`] for user mappings: the single
+/// ranged shootdown reaches only CPUs running this address space, whereas
+/// per-page unmaps leave other CPUs' TLBs untouched.  Huge pages the range
+/// covers entirely are dropped as a whole; partially covered ones are split.
+/// Frames mapped in the range may be freed once this returns.  Needs IF=1 or
+/// no spinlock held.
+pub fn unmap_range(virt: VirtAddr, pages: usize) {
+    let mut va = virt.as_u64() & !0xFFF;
+    let end = va + (pages * FRAME_SIZE) as u64;
+    while va < end {
+        let page = VirtAddr::new(va);
+        unsafe {
+            if let Some(pde_ptr) = pde_slot(page) {
+                if is_huge_pde(pde_ptr.read_volatile()) {
+                    if va & (HUGE_PAGE_SIZE as u64 - 1) == 0 && end - va >= HUGE_PAGE_SIZE as u64 {
+                        pde_ptr.write_volatile(0);
+                        va += HUGE_PAGE_SIZE as u64;
+                        continue;
+                    }
+                    if !split_huge_page(page) {
+                        panic!("Failed to allocate PT for huge page split");
+                    }
+                }
+            }
+            if read_pte(page) & PAGE_PRESENT != 0 {
+                let pte_ptr = (recursive_pt_base(page) as *mut u64).add(page.pt_index());
+                pte_ptr.write_volatile(0);
+            }
+        }
+        va += FRAME_SIZE as u64;
+    }
+    // Flushes this CPU as well.
+    crate::arch::x86::smp::tlb_shootdown_range(virt.as_u64() & !0xFFF, pages as u64);
+}
+
 /// Check if a virtual address is mapped in the current page directory.
 /// Walks the 4-level page table via recursive mapping.
 pub fn is_page_mapped(virt: VirtAddr) -> bool {
-    let pml4i = virt.pml4_index();
-    let pdpti = virt.pdpt_index();
-    let pdi = virt.pd_index();
-    let pti = virt.pt_index();
-
-    unsafe {
-        let pml4_ptr = RECURSIVE_PML4_BASE as *const u64;
-        let pml4e = pml4_ptr.add(pml4i).read_volatile();
-        if pml4e & PAGE_PRESENT == 0 {
-            return false;
-        }
-
-        let pdpt_ptr = recursive_pdpt_base(virt) as *const u64;
-        let pdpte = pdpt_ptr.add(pdpti).read_volatile();
-        if pdpte & PAGE_PRESENT == 0 {
-            return false;
-        }
-
-        let pd_ptr = recursive_pd_base(virt) as *const u64;
-        let pde = pd_ptr.add(pdi).read_volatile();
-        if pde & PAGE_PRESENT == 0 {
-            return false;
-        }
-
-        let pt_ptr = recursive_pt_base(virt) as *const u64;
-        let pte = pt_ptr.add(pti).read_volatile();
-        pte & PAGE_PRESENT != 0
-    }
+    read_pte(virt) & PAGE_PRESENT != 0
 }
 
 /// Read the raw PTE value for a virtual address.
 /// Returns 0 if any level of the page table hierarchy is not present.
+///
+/// Inside a 2 MiB page the equivalent 4K PTE is returned (physical address
+/// of the 4K page, same flags, PAT in its PTE position).
 pub fn read_pte(virt: VirtAddr) -> u64 {
-    let pml4i = virt.pml4_index();
-    let pdpti = virt.pdpt_index();
-    let pdi = virt.pd_index();
-    let pti = virt.pt_index();
-
     unsafe {
-        let pml4_ptr = RECURSIVE_PML4_BASE as *const u64;
-        if pml4_ptr.add(pml4i).read_volatile() & PAGE_PRESENT == 0 {
+        let pde = match pde_slot(virt) {
+            Some(p) => p.read_volatile(),
+            None => return 0,
+        };
+        if pde & PAGE_PRESENT == 0 {
             return 0;
         }
-        let pdpt_ptr = recursive_pdpt_base(virt) as *const u64;
-        if pdpt_ptr.add(pdpti).read_volatile() & PAGE_PRESENT == 0 {
-            return 0;
-        }
-        let pd_ptr = recursive_pd_base(virt) as *const u64;
-        if pd_ptr.add(pdi).read_volatile() & PAGE_PRESENT == 0 {
-            return 0;
+        if pde & PAGE_HUGE != 0 {
+            return huge_pde_to_pte(pde, virt.pt_index());
         }
         let pt_ptr = recursive_pt_base(virt) as *const u64;
-        pt_ptr.add(pti).read_volatile()
+        pt_ptr.add(virt.pt_index()).read_volatile()
     }
 }
 
@@ -743,14 +1004,45 @@ pub fn create_user_page_directory() -> Option<PhysAddr> {
 /// when two CPUs fork concurrently.
 static CLONE_TEMP_LOCK: core::sync::atomic::AtomicBool = core::sync::atomic::AtomicBool::new(false);
 
+/// Serializes copy-on-write PTE transitions: fork marking a parent's pages
+/// COW, and the write-fault handler breaking COW.  Also guards the
+/// `COW_TEMP` copy window.
+static COW_LOCK: crate::sync::spinlock::Spinlock<()> = crate::sync::spinlock::Spinlock::new(());
+
+/// Kernel temp VA used by [`handle_cow_fault`] to fill the private copy.
+const COW_TEMP: u64 = 0xFFFF_FFFF_BFF0_5000;
+
+/// How the child gets a parent's page in `clone_user_page_directory`.
+#[derive(Clone, Copy, PartialEq)]
+enum CloneKind {
+    /// Same physical frame, no refcount (DLL read-only pages owned by the DLL loader).
+    Share,
+    /// Same physical frame with one more reference (COW or private read-only page).
+    ShareRef,
+    /// Fresh frame with a copy of the contents (SHM, VRAM, or refcount overflow).
+    Copy,
+    /// Swapped-out page: the child's entry refers to the same swap slot,
+    /// which gains a reference.  `parent_phys`/`child_flags` hold the raw entry.
+    Swap,
+}
+
 /// Clone a user process's entire address space for fork().
 ///
 /// Creates a new PML4 with copied kernel mappings (like create_user_page_directory),
-/// then walks the parent's user-space page tables and copies all user pages:
+/// then walks the parent's user-space page tables:
 /// - Identity-map entries (PD[0..31]): skipped (shared with kernel)
 /// - DLL RO pages (PD[32..63], no PAGE_WRITABLE): shared (same physical frame)
-/// - DLL writable pages (.data/.bss): copied (new frame)
-/// - All other user pages: copied (new frame)
+/// - Writable private pages: shared copy-on-write — both PTEs become
+///   read-only with [`PTE_COW`] and the frame's refcount is raised
+/// - Read-only private pages: shared with a refcount
+/// - Shared-memory and VRAM pages: copied (new frame), as before
+/// - Swapped-out pages: the child shares the swap slot; a page being
+///   swapped out right now is made present again in the parent first
+/// - 2 MiB pages: split in the parent first, then treated as above
+///
+/// No page contents are copied for private memory, so fork cost scales with
+/// the number of mapped PTEs rather than resident memory.  The write fault
+/// that later breaks sharing is handled by [`handle_cow_fault`].
 ///
 /// Returns the physical address of the child's new PML4, or None on OOM.
 pub fn clone_user_page_directory(parent_pd: PhysAddr) -> Option<PhysAddr> {
@@ -761,6 +1053,9 @@ pub fn clone_user_page_directory(parent_pd: PhysAddr) -> Option<PhysAddr> {
     let temp_src = VirtAddr::new(0xFFFF_FFFF_BFF0_3000);
     let temp_dst = VirtAddr::new(0xFFFF_FFFF_BFF0_4000);
 
+    // Pre-collect SHM frames before cli: the lookup takes the SHM lock.
+    let shm_frames = crate::ipc::shared_memory::collect_sorted_shm_frames();
+
     // Acquire clone temp lock (spin, interrupts may be enabled here)
     while CLONE_TEMP_LOCK.compare_exchange_weak(
         false, true, Ordering::Acquire, Ordering::Relaxed
@@ -768,152 +1063,731 @@ pub fn clone_user_page_directory(parent_pd: PhysAddr) -> Option<PhysAddr> {
         core::hint::spin_loop();
     }
 
-    // Collect pages to copy/share: (vaddr, parent_phys, flags, is_shared)
+    // Collect pages to share/copy: (vaddr, parent_phys, child_flags, kind)
     // We do this in two phases:
     //   Phase A: Walk parent tables under cli (CR3 switched), collect page info
-    //   Phase B: Copy page contents with kernel CR3 (temp mappings)
+    //            and write-protect the parent's COW pages in place
+    //   Phase B: Map the child's PTEs (batched CR3 switches), copying only
+    //            the few pages that cannot be shared
     // This minimizes the time spent with interrupts disabled.
 
     // Use a Vec on the heap to avoid stack overflow (could be thousands of pages)
-    let mut pages_to_copy: alloc::vec::Vec<(u64, u64, u64, bool)> = alloc::vec::Vec::new();
+    let mut pages: alloc::vec::Vec<(u64, u64, u64, CloneKind)> = alloc::vec::Vec::new();
+    let mut marked_cow = false;
 
-    unsafe {
-        // Phase A: Walk parent's page tables
-        let old_cr3 = current_cr3();
-        let rflags: u64;
-        asm!("pushfq; pop {}", out(reg) rflags, options(nomem));
-        asm!("cli", options(nomem, nostack));
-        asm!("mov cr3, {}", in(reg) parent_pd.as_u64());
-
-        let pml4_ptr = RECURSIVE_PML4_BASE as *const u64;
+    {
+        // Held across Phase A so a sibling thread's COW fault cannot rewrite
+        // a parent PTE between our read and our write-protect.
+        let _cow = COW_LOCK.lock();
+        unsafe {
+            // Phase A: Walk parent's page tables
+            let old_cr3 = current_cr3();
+            asm!("mov cr3, {}", in(reg) parent_pd.as_u64());
 
-        for pml4i in 0..256usize {
-            let pml4e = pml4_ptr.add(pml4i).read_volatile();
-            if pml4e & PAGE_PRESENT == 0 {
-                continue;
-            }
+            let pml4_ptr = RECURSIVE_PML4_BASE as *const u64;
 
-            let pdpt_base = sign_extend(
-                (RECURSIVE_INDEX as u64) << 39
-                    | (RECURSIVE_INDEX as u64) << 30
-                    | (RECURSIVE_INDEX as u64) << 21
-                    | (pml4i as u64) << 12,
-            );
-            let pdpt_ptr = pdpt_base as *const u64;
-
-            for pdpti in 0..ENTRIES_PER_TABLE {
-                let pdpte = pdpt_ptr.add(pdpti).read_volatile();
-                if pdpte & PAGE_PRESENT == 0 {
+            for pml4i in 0..256usize {
+                let pml4e = pml4_ptr.add(pml4i).read_volatile();
+                if pml4e & PAGE_PRESENT == 0 {
                     continue;
                 }
 
-                let pd_base = sign_extend(
+                let pdpt_base = sign_extend(
                     (RECURSIVE_INDEX as u64) << 39
                         | (RECURSIVE_INDEX as u64) << 30
-                        | (pml4i as u64) << 21
-                        | (pdpti as u64) << 12,
+                        | (RECURSIVE_INDEX as u64) << 21
+                        | (pml4i as u64) << 12,
                 );
-                let pd_ptr = pd_base as *const u64;
-
-                for pdi in 0..ENTRIES_PER_TABLE {
-                    let pde = pd_ptr.add(pdi).read_volatile();
-                    if pde & PAGE_PRESENT == 0 {
-                        continue;
-                    }
+                let pdpt_ptr = pdpt_base as *const u64;
 
-                    // Skip identity-map entries (kernel-owned)
-                    let is_identity_map = pml4i == 0 && pdpti == 0 && pdi < 32;
-                    if is_identity_map {
+                for pdpti in 0..ENTRIES_PER_TABLE {
+                    let pdpte = pdpt_ptr.add(pdpti).read_volatile();
+                    if pdpte & PAGE_PRESENT == 0 {
                         continue;
                     }
 
-                    let is_dll = pml4i == 0 && pdpti == 0 && pdi >= 32 && pdi <= 63;
-
-                    let pt_base = sign_extend(
+                    let pd_base = sign_extend(
                         (RECURSIVE_INDEX as u64) << 39
-                            | (pml4i as u64) << 30
-                            | (pdpti as u64) << 21
-                            | (pdi as u64) << 12,
+                            | (RECURSIVE_INDEX as u64) << 30
+                            | (pml4i as u64) << 21
+                            | (pdpti as u64) << 12,
                     );
-                    let pt_ptr = pt_base as *const u64;
+                    let pd_ptr = pd_base as *const u64;
 
-                    for pti in 0..ENTRIES_PER_TABLE {
-                        let pte = pt_ptr.add(pti).read_volatile();
-                        if pte & PAGE_PRESENT == 0 {
+                    for pdi in 0..ENTRIES_PER_TABLE {
+                        let pde = pd_ptr.add(pdi).read_volatile();
+                        if pde & PAGE_PRESENT == 0 {
                             continue;
                         }
 
-                        let parent_phys = pte & ADDR_MASK;
-                        // Preserve bits 0-11 (standard flags) and bit 63 (NX).
-                        // A plain `& 0xFFF` would strip the NX bit, causing the
-                        // child's pages to become executable even when the parent
-                        // mapped them as non-executable (data/stack segments).
-                        let pte_flags = (pte & 0xFFF) | (pte & PAGE_NX);
+                        // Skip identity-map entries (kernel-owned)
+                        let is_identity_map = pml4i == 0 && pdpti == 0 && pdi < 32;
+                        if is_identity_map {
+                            continue;
+                        }
 
-                        // Compute virtual address
-                        let vaddr = (pml4i as u64) << 39
-                            | (pdpti as u64) << 30
-                            | (pdi as u64) << 21
-                            | (pti as u64) << 12;
+                        let is_dll = pml4i == 0 && pdpti == 0 && pdi >= 32 && pdi <= 63;
+
+                        // COW and the per-page kinds below need 4K PTEs:
+                        // demote the parent's huge page first.  Without a
+                        // frame for the table, leave it whole and give the
+                        // child private copies instead.
+                        if pde & PAGE_HUGE != 0 {
+                            let huge_va = (pml4i as u64) << 39
+                                | (pdpti as u64) << 30
+                                | (pdi as u64) << 21;
+                            if !split_huge_page(VirtAddr::new(huge_va)) {
+                                for pti in 0..ENTRIES_PER_TABLE {
+                                    let pte = huge_pde_to_pte(pde, pti);
+                                    pages.push((
+                                        huge_va | (pti as u64) << 12,
+                                        pte & ADDR_MASK,
+                                        (pte & 0xFFF) | (pte & PAGE_NX),
+                                        CloneKind::Copy,
+                                    ));
+                                }
+                                continue;
+                            }
+                        }
 
-                        // DLL RO pages: share same physical frame
-                        let shared = is_dll && (pte & PAGE_WRITABLE == 0);
+                        let pt_base = sign_extend(
+                            (RECURSIVE_INDEX as u64) << 39
+                                | (pml4i as u64) << 30
+                                | (pdpti as u64) << 21
+                                | (pdi as u64) << 12,
+                        );
+                        let pt_ptr = pt_base as *mut u64;
+
+                        for pti in 0..ENTRIES_PER_TABLE {
+                            let mut pte = pt_ptr.add(pti).read_volatile();
+                            if pte & PAGE_PRESENT == 0 {
+                                if pte & PTE_SWAP_PENDING != 0 {
+                                    // Cancel the swap-out: the reclaim thread
+                                    // keeps the page when it sees it present.
+                                    pte = (pte & !PTE_SWAP_PENDING) | PAGE_PRESENT;
+                                    pt_ptr.add(pti).write_volatile(pte);
+                                } else {
+                                    if pte & PTE_SWAP != 0 {
+                                        crate::memory::swap::dup(((pte & ADDR_MASK) >> 12) as u32);
+                                        let vaddr = (pml4i as u64) << 39
+                                            | (pdpti as u64) << 30
+                                            | (pdi as u64) << 21
+                                            | (pti as u64) << 12;
+                                        pages.push((vaddr, pte & ADDR_MASK, pte & !ADDR_MASK, CloneKind::Swap));
+                                    }
+                                    continue;
+                                }
+                            }
 
-                        pages_to_copy.push((vaddr, parent_phys, pte_flags, shared));
+                            let parent_phys = pte & ADDR_MASK;
+                            // Preserve bits 0-11 (standard flags) and bit 63 (NX).
+                            // A plain `& 0xFFF` would strip the NX bit, causing the
+                            // child's pages to become executable even when the parent
+                            // mapped them as non-executable (data/stack segments).
+                            let mut pte_flags = (pte & 0xFFF) | (pte & PAGE_NX);
+
+                            // Compute virtual address
+                            let vaddr = (pml4i as u64) << 39
+                                | (pdpti as u64) << 30
+                                | (pdi as u64) << 21
+                                | (pti as u64) << 12;
+
+                            let writable = pte & (PAGE_WRITABLE | PTE_COW) != 0;
+                            let kind = if is_dll && !writable {
+                                // DLL RO pages: owned by the DLL loader
+                                CloneKind::Share
+                            } else if pte & PTE_VRAM != 0
+                                || crate::ipc::shared_memory::is_shm_frame_sorted(
+                                    &shm_frames, PhysAddr::new(parent_phys))
+                            {
+                                CloneKind::Copy
+                            } else if physical::share_frame(PhysAddr::new(parent_phys)) {
+                                if writable {
+                                    pte_flags = (pte_flags & !PAGE_WRITABLE) | PTE_COW;
+                                    if pte & PAGE_WRITABLE != 0 {
+                                        pt_ptr.add(pti).write_volatile(
+                                            (pte & !PAGE_WRITABLE) | PTE_COW,
+                                        );
+                                        marked_cow = true;
+                                    }
+                                }
+                                CloneKind::ShareRef
+                            } else {
+                                CloneKind::Copy
+                            };
+
+                            pages.push((vaddr, parent_phys, pte_flags, kind));
+                        }
                     }
                 }
             }
-        }
 
-        // Restore CR3 and interrupts
-        asm!("mov cr3, {}", in(reg) old_cr3);
-        asm!("push {}; popfq", in(reg) rflags, options(nomem));
+            // Restore CR3 and drop any writable TLB entries of the parent —
+            // on this CPU under every PCID, and on all other CPUs.
+            asm!("mov cr3, {}", in(reg) old_cr3);
+            if marked_cow {
+                flush_tlb_all_contexts();
+            }
+        }
+    }
+    if marked_cow {
+        crate::arch::x86::smp::tlb_shootdown(crate::arch::x86::smp::TLB_FLUSH_ALL_CONTEXTS);
     }
 
-    // Phase B: Copy page contents and map in child PD
-    for &(vaddr, parent_phys, pte_flags, shared) in pages_to_copy.iter() {
-        if shared {
-            // DLL RO page — share same frame in child
-            map_page_in_pd(
-                child_pd,
-                VirtAddr::new(vaddr),
-                PhysAddr::new(parent_phys),
-                pte_flags,
-            );
-        } else {
-            // Allocate new frame for child
-            let child_phys = match physical::alloc_frame() {
-                Some(f) => f,
-                None => {
-                    // OOM — clean up child PD and release lock
-                    CLONE_TEMP_LOCK.store(false, Ordering::Release);
-                    destroy_user_page_directory(child_pd);
-                    return None;
+    // Phase B1: map all shared pages in the child, 64 PTEs per CR3 switch.
+    const CHUNK_SIZE: usize = 64;
+    let shared: alloc::vec::Vec<&(u64, u64, u64, CloneKind)> =
+        pages.iter().filter(|p| p.3 != CloneKind::Copy).collect();
+    for chunk in shared.chunks(CHUNK_SIZE) {
+        unsafe {
+            let rflags: u64;
+            asm!("pushfq; pop {}", out(reg) rflags, options(nomem));
+            asm!("cli", options(nomem, nostack));
+            let old_cr3 = current_cr3();
+            asm!("mov cr3, {}", in(reg) child_pd.as_u64());
+            for &&(vaddr, parent_phys, pte_flags, kind) in chunk {
+                map_page(VirtAddr::new(vaddr), PhysAddr::new(parent_phys), pte_flags);
+                if kind == CloneKind::Swap {
+                    // map_page made the entry present: store the raw swap entry.
+                    let pte_ptr = (recursive_pt_base(VirtAddr::new(vaddr)) as *mut u64)
+                        .add(VirtAddr::new(vaddr).pt_index());
+                    pte_ptr.write_volatile(parent_phys | pte_flags);
+                    asm!("invlpg [{}]", in(reg) vaddr, options(nostack, preserves_flags));
                 }
-            };
+            }
+            asm!("mov cr3, {}", in(reg) old_cr3);
+            asm!("push {}; popfq", in(reg) rflags, options(nomem));
+        }
+    }
 
-            // Copy page contents via temp mappings (kernel CR3 is fine)
-            unsafe {
-                map_page(temp_src, PhysAddr::new(parent_phys), PAGE_WRITABLE);
-                map_page(temp_dst, child_phys, PAGE_WRITABLE);
-                core::ptr::copy_nonoverlapping(
-                    temp_src.as_u64() as *const u8,
-                    temp_dst.as_u64() as *mut u8,
-                    FRAME_SIZE,
-                );
-                unmap_page(temp_src);
-                unmap_page(temp_dst);
+    // Phase B2: copy the pages that must stay private to each process
+    for &(vaddr, parent_phys, pte_flags, kind) in pages.iter() {
+        if kind != CloneKind::Copy {
+            continue;
+        }
+        // Allocate new frame for child
+        let child_phys = match physical::alloc_frame() {
+            Some(f) => f,
+            None => {
+                // OOM — clean up child PD and release lock
+                CLONE_TEMP_LOCK.store(false, Ordering::Release);
+                destroy_user_page_directory(child_pd);
+                return None;
             }
+        };
 
-            // Map new frame in child's PD
-            map_page_in_pd(child_pd, VirtAddr::new(vaddr), child_phys, pte_flags);
+        // Copy page contents via temp mappings (kernel CR3 is fine)
+        unsafe {
+            map_page(temp_src, PhysAddr::new(parent_phys), PAGE_WRITABLE);
+            map_page(temp_dst, child_phys, PAGE_WRITABLE);
+            memops::copy_page(temp_dst.as_u64() as *mut u8, temp_src.as_u64() as *const u8);
+            unmap_page(temp_src);
+            unmap_page(temp_dst);
         }
+
+        // Map new frame in child's PD (a private copy is never COW)
+        map_page_in_pd(
+            child_pd,
+            VirtAddr::new(vaddr),
+            child_phys,
+            if pte_flags & PTE_COW != 0 { (pte_flags & !PTE_COW) | PAGE_WRITABLE } else { pte_flags },
+        );
     }
 
     CLONE_TEMP_LOCK.store(false, Ordering::Release);
     Some(child_pd)
 }
 
+/// Resolve a write fault on a copy-on-write page of the current address space.
+///
+/// Called from the #PF handler for present+write faults (user mode, or kernel
+/// mode writing a user buffer).  If the frame has no other owner left the
+/// page is simply made writable again; otherwise its contents are copied to
+/// a fresh frame and the shared frame loses one reference.
+///
+/// Returns `true` if the faulting instruction can be retried.
+pub fn handle_cow_fault(vaddr: u64) -> bool {
+    if vaddr >= 0x0000_8000_0000_0000 {
+        return false; // COW is only used for user mappings
+    }
+    let page = VirtAddr::new(vaddr & !0xFFF);
+    let _cow = COW_LOCK.lock();
+
+    let pte = read_pte(page);
+    if pte & PAGE_PRESENT == 0 {
+        return false;
+    }
+    if pte & PAGE_WRITABLE != 0 {
+        // Another thread of this process broke the COW first; our TLB entry
+        // is just stale.
+        unsafe { asm!("invlpg [{}]", in(reg) page.as_u64(), options(nostack, preserves_flags)); }
+        return true;
+    }
+    if pte & PTE_COW == 0 {
+        return false; // Genuinely read-only page
+    }
+
+    let old_phys = PhysAddr::new(pte & ADDR_MASK);
+    let flags = ((pte & !ADDR_MASK) & !PTE_COW) | PAGE_WRITABLE;
+    let pte_ptr = unsafe { (recursive_pt_base(page) as *mut u64).add(page.pt_index()) };
+
+    if physical::frame_ref_count(old_phys) == 0 {
+        // Last owner: take the frame back without copying.
+        unsafe {
+            pte_ptr.write_volatile(old_phys.as_u64() | flags);
+            asm!("invlpg [{}]", in(reg) page.as_u64(), options(nostack, preserves_flags));
+        }
+        return true;
+    }
+
+    let new_phys = match physical::alloc_frame() {
+        Some(f) => f,
+        None => return false,
+    };
+    let temp = VirtAddr::new(COW_TEMP);
+    map_page(temp, new_phys, PAGE_WRITABLE);
+    unsafe { memops::copy_page(temp.as_u64() as *mut u8, page.as_u64() as *const u8) };
+    unmap_page(temp);
+    unsafe {
+        pte_ptr.write_volatile(new_phys.as_u64() | flags);
+        asm!("invlpg [{}]", in(reg) page.as_u64(), options(nostack, preserves_flags));
+    }
+    physical::free_frame(old_phys);
+    true
+}
+
+/// Map a fresh frame holding `data` (at most one page, zero-padded) at the
+/// not-present user page containing `vaddr` in the current address space.
+///
+/// Used by the file-mapping fault path, which reads the contents with
+/// interrupts enabled and installs them here.  If another thread of the
+/// process mapped the page in the meantime nothing is changed.
+///
+/// Returns `true` if the page is mapped afterwards.
+pub fn install_user_page(vaddr: u64, data: &[u8], flags: u64) -> bool {
+    if vaddr >= 0x0000_8000_0000_0000 {
+        return false;
+    }
+    let page = VirtAddr::new(vaddr & !0xFFF);
+    let _cow = COW_LOCK.lock();
+    if read_pte(page) & PAGE_PRESENT != 0 {
+        return true;
+    }
+    let frame = match physical::alloc_frame() {
+        Some(f) => f,
+        None => return false,
+    };
+    let n = data.len().min(FRAME_SIZE);
+    let temp = VirtAddr::new(COW_TEMP);
+    map_page(temp, frame, PAGE_WRITABLE);
+    unsafe {
+        memops::copy(temp.as_u64() as *mut u8, data.as_ptr(), n);
+        memops::fill((temp.as_u64() as *mut u8).add(n), 0, FRAME_SIZE - n);
+    }
+    unmap_page(temp);
+    map_page(page, frame, flags | PAGE_USER);
+    true
+}
+
+/// Whether the present user page containing `vaddr` has been written
+/// since it was mapped (PTE dirty bit), for shared file write-back.
+pub fn user_page_dirty(vaddr: u64) -> bool {
+    let pte = read_pte(VirtAddr::new(vaddr & !0xFFF));
+    pte & PAGE_PRESENT != 0 && pte & PAGE_DIRTY != 0
+}
+
+/// Physical address backing a user virtual address of the current address
+/// space, for use as a wait-queue key (see `ipc::futex`).
+///
+/// A pending copy-on-write share is broken first: otherwise the first write
+/// after the lookup would move the page to a new frame and the key would no
+/// longer match the one a later waker computes.  Must be called with IF=1
+/// (syscall context) since breaking a share may need a TLB shootdown.
+///
+/// A swapped-out page is read back in first.
+///
+/// Returns `None` if the address is not mapped.
+pub fn user_frame_key(vaddr: u64) -> Option<u64> {
+    if vaddr >= 0x0000_8000_0000_0000 {
+        return None;
+    }
+    let page = VirtAddr::new(vaddr & !0xFFF);
+    let mut pte = read_pte(page);
+    if pte & PAGE_PRESENT == 0 && pte & (PTE_SWAP | PTE_SWAP_PENDING) != 0 && handle_swap_fault(vaddr, true) {
+        pte = read_pte(page);
+    }
+    if pte & PAGE_PRESENT == 0 {
+        return None;
+    }
+    if pte & PTE_COW != 0 {
+        if !handle_cow_fault(vaddr) {
+            return None;
+        }
+        if crate::task::scheduler::has_live_pd_siblings() {
+            crate::arch::x86::smp::tlb_shootdown(crate::arch::x86::smp::TLB_FLUSH_ALL_CONTEXTS);
+        }
+    }
+    let pte = read_pte(page);
+    if pte & PAGE_PRESENT == 0 {
+        return None;
+    }
+    Some((pte & ADDR_MASK) | (vaddr & 0xFFF))
+}
+
+/// Whether the user page containing `virt` holds data in the current
+/// address space: mapped, or swapped out.
+pub fn is_user_page_backed(virt: VirtAddr) -> bool {
+    read_pte(virt) & (PAGE_PRESENT | PTE_SWAP | PTE_SWAP_PENDING) != 0
+}
+
+/// Unmap `pages` user pages starting at `virt` in the current address space
+/// like [`unmap_range`], dropping swapped-out pages as well.
+///
+/// Returns the frames that were mapped, for the caller to free (the range
+/// is already shot down), and the number of pages removed, swapped-out ones
+/// included.  A page the reclaim thread is swapping out right now is
+/// removed but its frame is left to the reclaim thread.  Needs IF=1.
+pub fn take_user_range(virt: VirtAddr, pages: usize) -> (Vec<PhysAddr>, usize) {
+    let mut frames = Vec::new();
+    let mut slots = Vec::new();
+    let mut removed = 0;
+    {
+        let _cow = COW_LOCK.lock();
+        let mut va = virt.as_u64() & !0xFFF;
+        let end = va + (pages * FRAME_SIZE) as u64;
+        while va < end {
+            let page = VirtAddr::new(va);
+            unsafe {
+                if let Some(pde_ptr) = pde_slot(page) {
+                    let pde = pde_ptr.read_volatile();
+                    if is_huge_pde(pde) {
+                        if va & (HUGE_PAGE_SIZE as u64 - 1) == 0 && end - va >= HUGE_PAGE_SIZE as u64 {
+                            for pti in 0..ENTRIES_PER_TABLE {
+                                frames.push(PhysAddr::new(huge_pde_to_pte(pde, pti) & ADDR_MASK));
+                            }
+                            pde_ptr.write_volatile(0);
+                            removed += PAGES_PER_HUGE_PAGE;
+                            va += HUGE_PAGE_SIZE as u64;
+                            continue;
+                        }
+                        if !split_huge_page(page) {
+                            panic!("Failed to allocate PT for huge page split");
+                        }
+                    }
+                }
+                if let Some(pte_ptr) = pte_slot(page) {
+                    let pte = pte_ptr.read_volatile();
+                    if pte & (PAGE_PRESENT | PTE_SWAP | PTE_SWAP_PENDING) != 0 {
+                        if pte & PAGE_PRESENT != 0 {
+                            frames.push(PhysAddr::new(pte & ADDR_MASK));
+                        } else if pte & PTE_SWAP != 0 {
+                            slots.push(((pte & ADDR_MASK) >> 12) as u32);
+                        }
+                        pte_ptr.write_volatile(0);
+                        removed += 1;
+                    }
+                }
+            }
+            va += FRAME_SIZE as u64;
+        }
+    }
+    for slot in slots {
+        crate::memory::swap::release(slot);
+    }
+    // Flushes this CPU as well.
+    crate::arch::x86::smp::tlb_shootdown_range(virt.as_u64() & !0xFFF, pages as u64);
+    (frames, removed)
+}
+
+/// A page [`scan_user_pages`] took out of its address space to swap it out.
+pub struct SwapCandidate {
+    pub vaddr: u64,
+    pub frame: PhysAddr,
+    /// The transit entry left in the page table.
+    transit: u64,
+}
+
+/// Call `f(base, pt)` for every page table of the current user address
+/// space, `base` being the first address it maps.  `pt` is `None` for a
+/// 2 MiB page.  The identity map and the DLL range (PD[0..63] of the first
+/// GiB) are skipped.
+unsafe fn for_each_user_pt(mut f: impl FnMut(u64, Option<*mut u64>)) {
+    let pml4_ptr = RECURSIVE_PML4_BASE as *const u64;
+    for pml4i in 0..256usize {
+        if pml4_ptr.add(pml4i).read_volatile() & PAGE_PRESENT == 0 {
+            continue;
+        }
+        let pdpt_ptr = sign_extend(
+            (RECURSIVE_INDEX as u64) << 39
+                | (RECURSIVE_INDEX as u64) << 30
+                | (RECURSIVE_INDEX as u64) << 21
+                | (pml4i as u64) << 12,
+        ) as *const u64;
+        for pdpti in 0..ENTRIES_PER_TABLE {
+            if pdpt_ptr.add(pdpti).read_volatile() & PAGE_PRESENT == 0 {
+                continue;
+            }
+            let pd_ptr = sign_extend(
+                (RECURSIVE_INDEX as u64) << 39
+                    | (RECURSIVE_INDEX as u64) << 30
+                    | (pml4i as u64) << 21
+                    | (pdpti as u64) << 12,
+            ) as *const u64;
+            for pdi in 0..ENTRIES_PER_TABLE {
+                let pde = pd_ptr.add(pdi).read_volatile();
+                if pde & PAGE_PRESENT == 0 || (pml4i == 0 && pdpti == 0 && pdi < 64) {
+                    continue;
+                }
+                let base = (pml4i as u64) << 39 | (pdpti as u64) << 30 | (pdi as u64) << 21;
+                if pde & PAGE_HUGE != 0 {
+                    f(base, None);
+                    continue;
+                }
+                let pt_ptr = sign_extend(
+                    (RECURSIVE_INDEX as u64) << 39
+                        | (pml4i as u64) << 30
+                        | (pdpti as u64) << 21
+                        | (pdi as u64) << 12,
+                ) as *mut u64;
+                f(base, Some(pt_ptr));
+            }
+        }
+    }
+}
+
+/// Whether the present user page `pte` at `vaddr` may be swapped out: a
+/// writable private frame of the allocator that is not shared memory,
+/// device memory, or in one of the `keep` ranges.
+fn swappable(pte: u64, vaddr: u64, keep: &[(u64, u64)], shm: &[PhysAddr]) -> bool {
+    let frame = PhysAddr::new(pte & ADDR_MASK);
+    pte & PAGE_USER != 0
+        && pte & (PAGE_WRITABLE | PTE_COW) != 0
+        && pte & (PTE_VRAM | PAGE_PWT | PAGE_PCD) == 0
+        && !keep.iter().any(|&(start, end)| vaddr >= start && vaddr < end)
+        && frame.frame_index() < physical::total_frames()
+        && physical::frame_ref_count(frame) == 0
+        && !crate::ipc::shared_memory::is_shm_frame_sorted(shm, frame)
+}
+
+/// Reclaim scan of the user address space `pd`: age its pages and take out
+/// up to `want` cold ones for swap-out.
+///
+/// The accessed bit approximates LRU: a page accessed since the previous
+/// scan has the bit cleared, one that was not is marked [`PTE_IDLE`], and an
+/// idle page still unaccessed now is cold.  A cold page that is
+/// [`swappable`] is left as a [`PTE_SWAP_PENDING`] entry and pushed to
+/// `out`; the caller saves it and calls [`finish_swap_out`].  With `age`
+/// false the scan only counts.  The accessed bits are cleared without a TLB
+/// flush, so a page hot in some TLB may look idle a little longer.
+///
+/// `shm` comes from `collect_sorted_shm_frames`.  `pd` must stay alive
+/// meanwhile (see `reclaim`).  Returns the resident and swapped-out page
+/// counts.  Needs IF=1 and no lock held.
+pub fn scan_user_pages(
+    pd: PhysAddr,
+    age: bool,
+    want: usize,
+    keep: &[(u64, u64)],
+    shm: &[PhysAddr],
+    out: &mut Vec<SwapCandidate>,
+) -> (usize, usize) {
+    let first = out.len();
+    let mut resident = 0;
+    let mut swapped = 0;
+    {
+        let _cow = COW_LOCK.lock();
+        unsafe {
+            let old_cr3 = current_cr3();
+            asm!("mov cr3, {}", in(reg) pd.as_u64());
+            for_each_user_pt(|base, pt| {
+                let Some(pt) = pt else {
+                    resident += ENTRIES_PER_TABLE;
+                    return;
+                };
+                for pti in 0..ENTRIES_PER_TABLE {
+                    // The CPU sets A/D bits concurrently: update with atomics.
+                    let entry = &*(pt.add(pti) as *const AtomicU64);
+                    let pte = entry.load(Ordering::Relaxed);
+                    if pte & PAGE_PRESENT == 0 {
+                        if pte & (PTE_SWAP | PTE_SWAP_PENDING) != 0 {
+                            swapped += 1;
+                        }
+                        continue;
+                    }
+                    resident += 1;
+                    if !age {
+                        continue;
+                    }
+                    if pte & PAGE_ACCESSED != 0 {
+                        entry.fetch_and(!(PAGE_ACCESSED | PTE_IDLE), Ordering::Relaxed);
+                        continue;
+                    }
+                    if pte & PTE_IDLE == 0 {
+                        entry.fetch_or(PTE_IDLE, Ordering::Relaxed);
+                        continue;
+                    }
+                    let vaddr = base | (pti as u64) << 12;
+                    if out.len() - first >= want || !swappable(pte, vaddr, keep, shm) {
+                        continue;
+                    }
+                    let transit = (pte & !(PAGE_PRESENT | PTE_IDLE)) | PTE_SWAP_PENDING;
+                    if entry.compare_exchange(pte, transit, Ordering::AcqRel, Ordering::Relaxed).is_ok() {
+                        out.push(SwapCandidate { vaddr, frame: PhysAddr::new(pte & ADDR_MASK), transit });
+                    }
+                }
+            });
+            asm!("mov cr3, {}", in(reg) old_cr3);
+            if out.len() > first {
+                flush_tlb_all_contexts();
+            }
+        }
+    }
+    if out.len() > first {
+        crate::arch::x86::smp::tlb_shootdown(crate::arch::x86::smp::TLB_FLUSH_ALL_CONTEXTS);
+    }
+    (resident, swapped)
+}
+
+/// Complete the swap-out of `pages`, taken from `pd` by [`scan_user_pages`];
+/// `slots[i]` is where page `i` was saved (`None`: it must stay resident).
+///
+/// A page whose transit entry is unchanged becomes a [`PTE_SWAP`] entry and
+/// its frame is freed, or is made present again if it has no slot.  A page
+/// faulted back in or unmapped meanwhile keeps or frees its frame and its
+/// slot is dropped.  The frames that left are appended to `gone` (futex
+/// waiters keyed on them must be woken).
+pub fn finish_swap_out(pd: PhysAddr, pages: &[SwapCandidate], slots: &[Option<u32>], gone: &mut Vec<u64>) {
+    let mut dropped = Vec::new();
+    {
+        let _cow = COW_LOCK.lock();
+        unsafe {
+            let old_cr3 = current_cr3();
+            asm!("mov cr3, {}", in(reg) pd.as_u64());
+            for (page, &slot) in pages.iter().zip(slots) {
+                let pte_ptr = pte_slot(VirtAddr::new(page.vaddr));
+                let pte = pte_ptr.map_or(0, |p| p.read_volatile());
+                if let (Some(p), true) = (pte_ptr, pte == page.transit) {
+                    match slot {
+                        Some(slot) => {
+                            let flags = page.transit & !(ADDR_MASK | PTE_SWAP_PENDING);
+                            p.write_volatile(PTE_SWAP | (slot as u64) << 12 | flags);
+                            physical::free_frame(page.frame);
+                            gone.push(page.frame.as_u64());
+                        }
+                        None => p.write_volatile((page.transit & !PTE_SWAP_PENDING) | PAGE_PRESENT),
+                    }
+                    continue;
+                }
+                // Faulted back in (same frame, kept) or unmapped.  The frame
+                // cannot have been reused: nobody else frees a transit frame.
+                if pte & PAGE_PRESENT == 0 || pte & ADDR_MASK != page.frame.as_u64() {
+                    physical::free_frame(page.frame);
+                    gone.push(page.frame.as_u64());
+                }
+                dropped.extend(slot);
+            }
+            asm!("mov cr3, {}", in(reg) old_cr3);
+        }
+    }
+    for slot in dropped {
+        crate::memory::swap::release(slot);
+    }
+}
+
+/// Bring back the swapped-out user page containing `vaddr` in the current
+/// address space.
+///
+/// Called from the #PF handler for not-present faults, and before the
+/// kernel uses a user page by its frame.  A page in transit is simply made
+/// present again.  Pages kept in RAM are restored in place; one in the swap
+/// file needs `can_block` (IF was set at the fault) since the read sleeps.
+///
+/// Returns `true` if the access can be retried, `false` if the page is not
+/// swapped out or cannot be restored.
+pub fn handle_swap_fault(vaddr: u64, can_block: bool) -> bool {
+    use crate::memory::swap;
+    if vaddr >= 0x0000_8000_0000_0000 {
+        return false;
+    }
+    let page = VirtAddr::new(vaddr & !0xFFF);
+    let cow = COW_LOCK.lock();
+    let pte_ptr = match unsafe { pte_slot(page) } {
+        Some(p) => p,
+        None => return false,
+    };
+    let pte = unsafe { pte_ptr.read_volatile() };
+    if pte & PAGE_PRESENT != 0 {
+        // Another thread of this process was first.
+        unsafe { asm!("invlpg [{}]", in(reg) page.as_u64(), options(nostack, preserves_flags)); }
+        return true;
+    }
+    if pte & PTE_SWAP_PENDING != 0 {
+        unsafe { pte_ptr.write_volatile((pte & !PTE_SWAP_PENDING) | PAGE_PRESENT) };
+        return true;
+    }
+    if pte & PTE_SWAP == 0 {
+        return false;
+    }
+    let slot = ((pte & ADDR_MASK) >> 12) as u32;
+    let flags = (pte & !(ADDR_MASK | PTE_SWAP)) | PAGE_PRESENT;
+
+    if swap::in_ram(slot) {
+        let frame = match physical::alloc_frame() {
+            Some(f) => f,
+            None => return false,
+        };
+        let temp = VirtAddr::new(COW_TEMP);
+        map_page(temp, frame, PAGE_WRITABLE);
+        let ok = unsafe { swap::load_ram(slot, temp.as_u64() as *mut u8) };
+        unmap_page(temp);
+        if !ok {
+            physical::free_frame(frame);
+            return false;
+        }
+        unsafe { pte_ptr.write_volatile(frame.as_u64() | flags) };
+        drop(cow);
+        swap::release(slot);
+        return true;
+    }
+    if !can_block {
+        return false;
+    }
+
+    // In the swap file: read it with the lock dropped, holding a reference
+    // so the slot stays ours, then install it unless the entry changed.
+    swap::dup(slot);
+    drop(cow);
+    let saved = crate::arch::hal::save_and_disable_interrupts();
+    crate::arch::hal::enable_interrupts();
+    let mut buf = alloc::vec![0u8; FRAME_SIZE];
+    let ok = swap::load_disk(slot, &mut buf);
+    crate::arch::hal::restore_interrupt_state(saved);
+    let mut installed = false;
+    if ok {
+        let _cow = COW_LOCK.lock();
+        if let Some(p) = unsafe { pte_slot(page) } {
+            if unsafe { p.read_volatile() } == pte {
+                let Some(frame) = physical::alloc_frame() else {
+                    drop(_cow);
+                    swap::release(slot);
+                    return false;
+                };
+                let temp = VirtAddr::new(COW_TEMP);
+                map_page(temp, frame, PAGE_WRITABLE);
+                unsafe { memops::copy_page(temp.as_u64() as *mut u8, buf.as_ptr()) };
+                unmap_page(temp);
+                unsafe { p.write_volatile(frame.as_u64() | flags) };
+                installed = true;
+            }
+        }
+    }
+    if installed {
+        swap::release(slot);
+    }
+    swap::release(slot);
+    ok
+}
+
 /// Map a page in a specific page directory (not necessarily the current one).
 /// Temporarily switches CR3 to the target PML4.
 ///
@@ -933,6 +1807,22 @@ pub fn map_page_in_pd(pd_phys: PhysAddr, virt: VirtAddr, phys: PhysAddr, flags:
     }
 }
 
+/// [`map_contiguous`] in a specific page directory (not necessarily the
+/// current one), with interrupts disabled across the CR3 switch as in
+/// [`map_page_in_pd`].
+pub fn map_contiguous_in_pd(pd_phys: PhysAddr, virt: VirtAddr, phys: PhysAddr, pages: usize, flags: u64) {
+    unsafe {
+        let rflags: u64;
+        asm!("pushfq; pop {}", out(reg) rflags, options(nomem));
+        asm!("cli", options(nomem, nostack));
+        let old_cr3 = current_cr3();
+        asm!("mov cr3, {}", in(reg) pd_phys.as_u64());
+        map_contiguous(virt, phys, pages, flags);
+        asm!("mov cr3, {}", in(reg) old_cr3);
+        asm!("push {}; popfq", in(reg) rflags, options(nomem));
+    }
+}
+
 /// Map `count` consecutive 4K pages starting at `start_virt` in the target PD.
 /// Allocates physical frames internally. Uses chunked CR3 switches (64 pages
 /// per chunk) to avoid long interrupt-disabled windows while still being much
@@ -968,11 +1858,16 @@ pub fn map_pages_range_in_pd(
             let mut err = false;
             for j in i..chunk_end {
                 let virt = VirtAddr::new(start_virt.as_u64() + j * FRAME_SIZE as u64);
-                match physical::alloc_frame() {
-                    Some(phys) => {
+                let frame = if zero {
+                    crate::memory::zero_pool::alloc_zeroed_frame()
+                } else {
+                    physical::alloc_frame().map(|f| (f, false))
+                };
+                match frame {
+                    Some((phys, zeroed)) => {
                         map_page(virt, phys, flags);
-                        if zero {
-                            core::ptr::write_bytes(virt.as_u64() as *mut u8, 0, FRAME_SIZE);
+                        if zero && !zeroed {
+                            memops::zero_page(virt.as_u64() as *mut u8);
                         }
                         mapped += 1;
                     }
@@ -1017,7 +1912,9 @@ pub fn is_mapped_in_pd(pd_phys: PhysAddr, virt: VirtAddr) -> bool {
             if pdpte & PAGE_PRESENT != 0 {
                 let pd_ptr = recursive_pd_base(virt) as *const u64;
                 let pde = pd_ptr.add(virt.pd_index()).read_volatile();
-                if pde & PAGE_PRESENT != 0 {
+                if is_huge_pde(pde) {
+                    true
+                } else if pde & PAGE_PRESENT != 0 {
                     let pt_ptr = recursive_pt_base(virt) as *const u64;
                     pt_ptr.add(virt.pt_index()).read_volatile() & PAGE_PRESENT != 0
                 } else {
@@ -1116,6 +2013,20 @@ pub fn destroy_user_page_directory(pml4_phys: PhysAddr) {
                         continue; // Skip entirely — kernel owns these PTs
                     }
 
+                    // 2 MiB page: no page table to free, only its frames
+                    // (same ownership rules as 4K pages; DLLs are never huge).
+                    if pde & PAGE_HUGE != 0 {
+                        if pde & PTE_VRAM == 0 {
+                            for pti in 0..ENTRIES_PER_TABLE {
+                                let frame = PhysAddr::new(huge_pde_to_pte(pde, pti) & ADDR_MASK);
+                                if !crate::ipc::shared_memory::is_shm_frame_sorted(&shm_frames, frame) {
+                                    physical::free_frame(frame);
+                                }
+                            }
+                        }
+                        continue;
+                    }
+
                     let pt_base = sign_extend(
                         (RECURSIVE_INDEX as u64) << 39
                             | (pml4i as u64) << 30
@@ -1126,6 +2037,12 @@ pub fn destroy_user_page_directory(pml4_phys: PhysAddr) {
 
                     for pti in 0..ENTRIES_PER_TABLE {
                         let pte = pt_ptr.add(pti).read_volatile();
+                        // Swapped-out page: drop the slot.  (No transit
+                        // entries here: the reclaim thread pins the PD.)
+                        if pte & (PAGE_PRESENT | PTE_SWAP) == PTE_SWAP {
+                            crate::memory::swap::release(((pte & ADDR_MASK) >> 12) as u32);
+                            continue;
+                        }
                         if pte & PAGE_PRESENT != 0 {
                             // VRAM pages: physical frames belong to GPU, not our allocator.
                             if pte & PTE_VRAM != 0 {
@@ -1143,7 +2060,7 @@ pub fn destroy_user_page_directory(pml4_phys: PhysAddr) {
                             // In DLL range: free ONLY per-process writable pages (.data/.bss).
                             // Shared RO pages (no PAGE_WRITABLE) are owned by the global
                             // LOADED_DLLS registry and must NOT be freed.
-                            if !is_dll || (pte & PAGE_WRITABLE != 0) {
+                            if !is_dll || (pte & (PAGE_WRITABLE | PTE_COW) != 0) {
                                 physical::free_frame(frame);
                             }
                         }
@@ -1220,9 +2137,9 @@ pub fn handle_heap_demand_page(vaddr: u64) -> bool {
         return true;
     }
 
-    // Allocate a physical frame
-    let phys = match physical::alloc_frame() {
-        Some(p) => p,
+    // Allocate a physical frame, pre-zeroed if the pool has one
+    let (phys, zeroed) = match crate::memory::zero_pool::alloc_zeroed_frame() {
+        Some(f) => f,
         None => {
             DEMAND_PAGE_LOCK.store(false, Ordering::Release);
             return false;
@@ -1233,8 +2150,8 @@ pub fn handle_heap_demand_page(vaddr: u64) -> bool {
     map_page(page_addr, phys, 0x03);
 
     // Zero the page (demand-paged pages must be zeroed for security/correctness)
-    unsafe {
-        core::ptr::write_bytes(page_addr.as_u64() as *mut u8, 0, FRAME_SIZE);
+    if !zeroed {
+        unsafe { memops::zero_page(page_addr.as_u64() as *mut u8) };
     }
 
     DEMAND_PAGE_LOCK.store(false, Ordering::Release);
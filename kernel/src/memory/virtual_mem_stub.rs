@@ -11,6 +11,7 @@ use crate::boot_info::BootInfo;
 use crate::memory::address::{PhysAddr, VirtAddr};
 use crate::memory::physical;
 use crate::memory::FRAME_SIZE;
+use alloc::vec::Vec;
 
 // ==========================================================================
 // Page flag constants (x86-compatible interface used by rest of kernel)
@@ -267,6 +268,15 @@ pub fn init(_boot_info: &BootInfo) {
 /// Enable PCID (x86-only concept — no-op on ARM64).
 pub fn enable_pcid() {}
 
+/// Enable supervisor write protection (x86 CR0.WP — no-op on ARM64, where
+/// fork still copies every page and nothing is shared copy-on-write).
+pub fn enable_write_protect() {}
+
+/// Toggle supervisor write protection (no-op on ARM64). Returns the previous state.
+pub fn set_write_protect(_enabled: bool) -> bool {
+    false
+}
+
 /// Get the NX flag value for page table entries.
 #[inline]
 pub fn page_nx_flag() -> u64 {
@@ -282,13 +292,9 @@ pub fn kernel_cr3() -> u64 {
     ttbr1
 }
 
-/// Get the current user page table base (TTBR0_EL1).
+/// Get the current user page table base (TTBR0_EL1, without the ASID).
 pub fn current_cr3() -> u64 {
-    let ttbr0: u64;
-    unsafe {
-        core::arch::asm!("mrs {}, ttbr0_el1", out(reg) ttbr0, options(nomem, nostack));
-    }
-    ttbr0
+    crate::arch::arm64::mmu::ttbr_table(crate::arch::arm64::mmu::read_ttbr0())
 }
 
 /// Check if a virtual address is mapped.
@@ -341,6 +347,94 @@ pub fn unmap_page(virt: VirtAddr) {
     }
 }
 
+/// Ranges longer than this are invalidated with one ASID-wide TLBI instead
+/// of one TLBI per page.
+const RANGE_FLUSH_PAGES: usize = 64;
+
+/// Unmap `pages` consecutive 4K pages starting at `virt`.
+///
+/// Short ranges go through [`unmap_page`] (one TLBI each); longer ones
+/// clear all entries first and then drop the address space's ASID.
+pub fn unmap_range(virt: VirtAddr, pages: usize) {
+    let base = virt.as_u64() & !0xFFF;
+    let ttbr0 = current_cr3();
+    if pages <= RANGE_FLUSH_PAGES || ttbr0 == 0 {
+        for i in 0..pages as u64 {
+            unmap_page(VirtAddr::new(base + i * 4096));
+        }
+        return;
+    }
+    for i in 0..pages as u64 {
+        let va = base + i * 4096;
+        if is_kernel_addr(va) {
+            continue;
+        }
+        if let Some(l3_phys) = walk_to_l3(ttbr0, va, false) {
+            unsafe { write_entry(l3_phys, l3_index(va), 0); }
+        }
+    }
+    crate::arch::arm64::mmu::flush_tlb_asid(ttbr0);
+}
+
+/// Whether the user page containing `virt` holds data (AArch64 does not
+/// swap, so: whether it is mapped).
+pub fn is_user_page_backed(virt: VirtAddr) -> bool {
+    is_page_mapped(virt)
+}
+
+/// Unmap `pages` user pages starting at `virt`; returns the frames that were
+/// mapped, for the caller to free, and how many pages were removed.
+pub fn take_user_range(virt: VirtAddr, pages: usize) -> (Vec<PhysAddr>, usize) {
+    let base = virt.as_u64() & !0xFFF;
+    let mut frames = Vec::new();
+    for i in 0..pages as u64 {
+        let desc = read_pte(VirtAddr::new(base + i * 4096));
+        if is_valid(desc) {
+            frames.push(PhysAddr::new(desc_addr(desc)));
+        }
+    }
+    unmap_range(virt, pages);
+    let removed = frames.len();
+    (frames, removed)
+}
+
+/// Size of a 2 MiB huge page.
+pub const HUGE_PAGE_SIZE: usize = 2 * 1024 * 1024;
+
+/// Number of 4K pages covered by one huge page.
+pub const PAGES_PER_HUGE_PAGE: usize = HUGE_PAGE_SIZE / FRAME_SIZE;
+
+/// Map a 2 MiB page.
+///
+/// L2 block descriptors are not used yet; always returns `false` so callers
+/// fall back to 4 KiB pages.
+pub fn map_huge_page(_virt: VirtAddr, _phys: PhysAddr, _flags: u64) -> bool {
+    false
+}
+
+/// Map `pages` 4K pages of the physically contiguous range at `phys`.
+pub fn map_contiguous(virt: VirtAddr, phys: PhysAddr, pages: usize, flags: u64) {
+    for i in 0..pages as u64 {
+        map_page(
+            VirtAddr::new(virt.as_u64() + i * FRAME_SIZE as u64),
+            PhysAddr::new(phys.as_u64() + i * FRAME_SIZE as u64),
+            flags,
+        );
+    }
+}
+
+/// Map a physically contiguous range in a specific user page directory.
+pub fn map_contiguous_in_pd(pd_phys: PhysAddr, virt: VirtAddr, phys: PhysAddr, pages: usize, flags: u64) {
+    for i in 0..pages as u64 {
+        map_page_in_pd(
+            pd_phys,
+            VirtAddr::new(virt.as_u64() + i * FRAME_SIZE as u64),
+            PhysAddr::new(phys.as_u64() + i * FRAME_SIZE as u64),
+            flags,
+        );
+    }
+}
+
 /// Read the raw page table entry for a virtual address.
 pub fn read_pte(virt: VirtAddr) -> u64 {
     let va = virt.as_u64();
@@ -354,6 +448,51 @@ pub fn read_pte(virt: VirtAddr) -> u64 {
     }
 }
 
+/// Physical address backing a user virtual address (futex wait-queue key).
+///
+/// AArch64 has no copy-on-write sharing yet, so the mapping is stable.
+pub fn user_frame_key(vaddr: u64) -> Option<u64> {
+    if vaddr >= 0x0000_8000_0000_0000 {
+        return None;
+    }
+    let desc = read_pte(VirtAddr::new(vaddr & !0xFFF));
+    if !is_valid(desc) {
+        return None;
+    }
+    Some((desc & 0x0000_FFFF_FFFF_F000) | (vaddr & 0xFFF))
+}
+
+/// Map a fresh frame holding `data` (zero-padded) at the not-present user
+/// page containing `vaddr` (file-mapping fault path).
+pub fn install_user_page(vaddr: u64, data: &[u8], flags: u64) -> bool {
+    if vaddr >= 0x0000_8000_0000_0000 {
+        return false;
+    }
+    let page = vaddr & !0xFFF;
+    if is_valid(read_pte(VirtAddr::new(page))) {
+        return true;
+    }
+    let frame = match physical::alloc_frame() {
+        Some(f) => f,
+        None => return false,
+    };
+    let n = data.len().min(FRAME_SIZE);
+    let dst = (frame.as_u64() + PHYS_TO_VIRT_OFFSET) as *mut u8;
+    unsafe {
+        core::ptr::copy_nonoverlapping(data.as_ptr(), dst, n);
+        core::ptr::write_bytes(dst.add(n), 0, FRAME_SIZE - n);
+    }
+    map_page(VirtAddr::new(page), frame, flags | PAGE_USER);
+    true
+}
+
+/// Whether the user page containing `vaddr` may have been written.
+///
+/// The stage-1 tables here keep no dirty state, so every mapped page counts.
+pub fn user_page_dirty(vaddr: u64) -> bool {
+    is_valid(read_pte(VirtAddr::new(vaddr & !0xFFF)))
+}
+
 /// Check if a page is mapped in a specific user page directory.
 pub fn is_mapped_in_pd(pd_phys: PhysAddr, virt: VirtAddr) -> bool {
     let l0 = pd_phys.as_u64();
@@ -518,6 +657,7 @@ pub fn destroy_user_page_directory(pd: PhysAddr) {
         physical::free_frame(PhysAddr::new(l1));
     }
     physical::free_frame(PhysAddr::new(l0));
+    crate::arch::arm64::mmu::release_asid(l0);
 }
 
 /// Mark a page as not-present (guard page).
@@ -5,6 +5,12 @@
 //! split/trim for `sys_munmap`, deep-clone for `sys_fork`, and bulk cleanup for
 //! process exit.
 //!
+//! A region may be backed by an open file ([`FileBacking`]); its pages are
+//! then filled on first access by `memory::file_map`.  Each file-backed
+//! region holds one reference on its global open-file slot, so splitting or
+//! removing regions reports the reference changes for the caller to apply
+//! outside the registry lock.
+//!
 //! Replaces the old bump-pointer (`mmap_next`) allocator that could never reuse
 //! freed virtual address space.
 
@@ -17,6 +23,8 @@ use crate::sync::spinlock::Spinlock;
 const MMAP_BASE: u32 = 0x7000_0000;
 /// End (exclusive) of the user-space mmap virtual address region.
 const MMAP_LIMIT: u32 = 0xBF00_0000;
+/// Start alignment for regions large enough for a 2 MiB page.
+const HUGE_ALIGN: u32 = 0x20_0000;
 
 /// A single contiguous mapped region in user virtual address space.
 #[derive(Clone)]
@@ -27,6 +35,44 @@ pub struct Vma {
     pub size: u32,
     /// Page table flags used when mapping (PAGE_WRITABLE | PAGE_USER, etc.).
     pub flags: u32,
+    /// File contents behind the region, or `None` for anonymous memory.
+    pub file: Option<FileBacking>,
+}
+
+/// File backing of a mapped region.
+#[derive(Clone, Copy)]
+pub struct FileBacking {
+    /// Global open-file slot (one reference held per region).
+    pub slot: u32,
+    /// File offset of the region's first byte.
+    pub offset: u32,
+    /// Bytes from the region start that come from the file; the rest of the
+    /// region reads as zeros (ELF .bss, mappings past EOF).
+    pub file_len: u32,
+    /// MAP_SHARED: dirty pages are written back to the file.
+    pub shared: bool,
+    /// Pages may be executed (no NX bit).
+    pub exec: bool,
+}
+
+impl Vma {
+    /// The part of this region within `[lo, hi)`, with the file backing
+    /// shifted to match.
+    fn clip(&self, lo: u32, hi: u32) -> Vma {
+        let start = self.start.max(lo);
+        let end = (self.start + self.size).min(hi);
+        let skip = start - self.start;
+        Vma {
+            start,
+            size: end - start,
+            flags: self.flags,
+            file: self.file.map(|f| FileBacking {
+                offset: f.offset + skip,
+                file_len: f.file_len.saturating_sub(skip),
+                ..f
+            }),
+        }
+    }
 }
 
 /// Per-process VMA state, identified by page directory physical address.
@@ -37,6 +83,8 @@ struct ProcessVmas {
     vmas: BTreeMap<u32, Vma>,
     /// Hint for next allocation search (replaces the old mmap_next bump pointer).
     mmap_hint: u32,
+    /// Pages must stay resident (a device reads them by physical address).
+    no_swap: bool,
 }
 
 /// Global registry of per-process VMA tables.
@@ -55,14 +103,16 @@ static VMA_REGISTRY: Spinlock<Vec<ProcessVmas>> = Spinlock::new(Vec::new());
 /// `mmap_hint` includes ASLR randomization.
 pub fn init_process(pd: PhysAddr, mmap_hint: u32) {
     let mut reg = VMA_REGISTRY.lock();
-    // Guard: don't double-init (shouldn't happen, but be safe).
-    if reg.iter().any(|p| p.pd == pd) {
+    // The loader may already have registered file-backed segments.
+    if let Some(proc) = reg.iter_mut().find(|p| p.pd == pd) {
+        proc.mmap_hint = mmap_hint.max(MMAP_BASE);
         return;
     }
     reg.push(ProcessVmas {
         pd,
         vmas: BTreeMap::new(),
         mmap_hint: mmap_hint.max(MMAP_BASE),
+        no_swap: false,
     });
 }
 
@@ -72,23 +122,60 @@ pub fn init_process(pd: PhysAddr, mmap_hint: u32) {
 /// beyond the hint, wraps around to `MMAP_BASE` for a second pass.
 /// Returns the start address on success, or `None` if the address space is
 /// truly exhausted.
+///
+/// Regions of 2 MiB or more start on a 2 MiB boundary so `sys_mmap` can
+/// back them with huge pages.
 pub fn alloc_region(pd: PhysAddr, size: u32) -> Option<u32> {
+    alloc_vma(pd, size, 0x02 | 0x04, None)
+}
+
+/// Allocate a region like [`alloc_region`] backed by `file` (`sys_mmap_file`).
+/// The region takes over the caller's reference on `file.slot`.
+pub fn alloc_file_region(pd: PhysAddr, size: u32, flags: u32, file: FileBacking) -> Option<u32> {
+    alloc_vma(pd, size, flags, Some(file))
+}
+
+/// Register a file-backed region at the fixed address `start` (ELF
+/// segments).  Creates the process table if the loader runs before
+/// [`init_process`].  Returns `false` if the range overlaps a region.
+pub fn insert_file_region(pd: PhysAddr, start: u32, size: u32, flags: u32, file: FileBacking) -> bool {
+    let end = match start.checked_add(size) {
+        Some(e) if size > 0 => e,
+        _ => return false,
+    };
+    let mut reg = VMA_REGISTRY.lock();
+    if !reg.iter().any(|p| p.pd == pd) {
+        reg.push(ProcessVmas { pd, vmas: BTreeMap::new(), mmap_hint: MMAP_BASE, no_swap: false });
+    }
+    let proc = match reg.iter_mut().find(|p| p.pd == pd) {
+        Some(p) => p,
+        None => return false,
+    };
+    if proc.vmas.range(..end).any(|(_, v)| v.start + v.size > start) {
+        return false;
+    }
+    proc.vmas.insert(start, Vma { start, size, flags, file: Some(file) });
+    true
+}
+
+fn alloc_vma(pd: PhysAddr, size: u32, flags: u32, file: Option<FileBacking>) -> Option<u32> {
     if size == 0 {
         return None;
     }
+    let align = if size >= HUGE_ALIGN { HUGE_ALIGN } else { 0x1000 };
     let mut reg = VMA_REGISTRY.lock();
     let proc = reg.iter_mut().find(|p| p.pd == pd)?;
 
     // Try from hint first, then wrap around.
-    if let Some(addr) = find_gap(&proc.vmas, proc.mmap_hint, size) {
-        proc.vmas.insert(addr, Vma { start: addr, size, flags: 0x02 | 0x04 });
+    if let Some(addr) = find_gap(&proc.vmas, proc.mmap_hint, size, align) {
+        proc.vmas.insert(addr, Vma { start: addr, size, flags, file });
         proc.mmap_hint = addr + size;
         return Some(addr);
     }
     // Wrap-around: search from MMAP_BASE up to the original hint.
     if proc.mmap_hint > MMAP_BASE {
-        if let Some(addr) = find_gap(&proc.vmas, MMAP_BASE, size) {
-            proc.vmas.insert(addr, Vma { start: addr, size, flags: 0x02 | 0x04 });
+        if let Some(addr) = find_gap(&proc.vmas, MMAP_BASE, size, align) {
+            proc.vmas.insert(addr, Vma { start: addr, size, flags, file });
             proc.mmap_hint = addr + size;
             return Some(addr);
         }
@@ -99,15 +186,18 @@ pub fn alloc_region(pd: PhysAddr, size: u32) -> Option<u32> {
 /// Remove a VMA allocation, supporting partial unmaps (trim / hole-punch).
 ///
 /// The physical page unmap + free is done by the caller (`sys_munmap`); this
-/// function only updates the bookkeeping.
-pub fn free_region(pd: PhysAddr, addr: u32, size: u32) {
+/// function only updates the bookkeeping.  Returns the open-file reference
+/// changes `(slot, delta)` caused by removing or splitting file-backed
+/// regions, to be applied with `vfs::incref` / `vfs::decref`.
+pub fn free_region(pd: PhysAddr, addr: u32, size: u32) -> Vec<(u32, i32)> {
+    let mut refs = Vec::new();
     if size == 0 {
-        return;
+        return refs;
     }
     let mut reg = VMA_REGISTRY.lock();
     let proc = match reg.iter_mut().find(|p| p.pd == pd) {
         Some(p) => p,
-        None => return,
+        None => return refs,
     };
 
     let free_end = addr + size;
@@ -124,43 +214,89 @@ pub fn free_region(pd: PhysAddr, addr: u32, size: u32) {
             None => continue,
         };
         let vma_end = vma.start + vma.size;
+        let mut pieces = 0i32;
 
         // Left remainder: [vma.start, addr) survives.
         if vma.start < addr {
-            proc.vmas.insert(vma.start, Vma {
-                start: vma.start,
-                size: addr - vma.start,
-                flags: vma.flags,
-            });
+            proc.vmas.insert(vma.start, vma.clip(vma.start, addr));
+            pieces += 1;
         }
         // Right remainder: [free_end, vma_end) survives.
         if vma_end > free_end {
-            proc.vmas.insert(free_end, Vma {
-                start: free_end,
-                size: vma_end - free_end,
-                flags: vma.flags,
-            });
+            proc.vmas.insert(free_end, vma.clip(free_end, vma_end));
+            pieces += 1;
         }
+        if let Some(f) = vma.file {
+            if pieces != 1 {
+                refs.push((f.slot, pieces - 1));
+            }
+        }
+    }
+    refs
+}
+
+/// File-backed parts of `[addr, addr + size)`, clipped to the range.
+pub fn file_regions(pd: PhysAddr, addr: u32, size: u32) -> Vec<Vma> {
+    let end = addr.saturating_add(size);
+    let reg = VMA_REGISTRY.lock();
+    match reg.iter().find(|p| p.pd == pd) {
+        Some(proc) => proc.vmas.range(..end)
+            .filter(|(_, v)| v.file.is_some() && v.start + v.size > addr)
+            .map(|(_, v)| v.clip(addr, end))
+            .collect(),
+        None => Vec::new(),
+    }
+}
+
+/// The file-backed region containing `addr`, if any (page fault path).
+pub fn find_file_region(pd: PhysAddr, addr: u32) -> Option<Vma> {
+    let reg = VMA_REGISTRY.lock();
+    let proc = reg.iter().find(|p| p.pd == pd)?;
+    let (_, v) = proc.vmas.range(..=addr).next_back()?;
+    if v.file.is_some() && addr - v.start < v.size {
+        Some(v.clone())
+    } else {
+        None
     }
 }
 
+/// Remove and return every file-backed region of `pd` (process teardown).
+/// The caller writes back shared pages and drops the file references.
+pub fn take_file_regions(pd: PhysAddr) -> Vec<Vma> {
+    let mut reg = VMA_REGISTRY.lock();
+    let proc = match reg.iter_mut().find(|p| p.pd == pd) {
+        Some(p) => p,
+        None => return Vec::new(),
+    };
+    let keys: Vec<u32> = proc.vmas.iter()
+        .filter(|(_, v)| v.file.is_some())
+        .map(|(&k, _)| k)
+        .collect();
+    keys.iter().filter_map(|k| proc.vmas.remove(k)).collect()
+}
+
 /// Deep-copy all VMAs from `src_pd` to `dst_pd` (fork).
 ///
 /// The child inherits the same VMA layout and `mmap_hint` as the parent.
-pub fn clone_for_fork(src_pd: PhysAddr, dst_pd: PhysAddr) {
+/// Returns the open-file slots of the copied file-backed regions; the caller
+/// takes one more reference on each for the child.
+pub fn clone_for_fork(src_pd: PhysAddr, dst_pd: PhysAddr) -> Vec<u32> {
     let mut reg = VMA_REGISTRY.lock();
     // Find source and clone its data.
-    let (cloned_vmas, hint) = match reg.iter().find(|p| p.pd == src_pd) {
-        Some(src) => (src.vmas.clone(), src.mmap_hint),
-        None => (BTreeMap::new(), MMAP_BASE),
+    let (cloned_vmas, hint, no_swap) = match reg.iter().find(|p| p.pd == src_pd) {
+        Some(src) => (src.vmas.clone(), src.mmap_hint, src.no_swap),
+        None => (BTreeMap::new(), MMAP_BASE, false),
     };
     // Remove stale entry for dst_pd if one exists (shouldn't, but be safe).
     reg.retain(|p| p.pd != dst_pd);
+    let slots = cloned_vmas.values().filter_map(|v| v.file.map(|f| f.slot)).collect();
     reg.push(ProcessVmas {
         pd: dst_pd,
         vmas: cloned_vmas,
         mmap_hint: hint,
+        no_swap,
     });
+    slots
 }
 
 /// Remove the entire VMA table for a terminated process.
@@ -171,6 +307,34 @@ pub fn destroy_process(pd: PhysAddr) {
     reg.retain(|p| p.pd != pd);
 }
 
+/// Keep every page of `pd` resident from now on (its memory is handed to
+/// a device by physical address, e.g. a GPU back buffer).
+pub fn set_no_swap(pd: PhysAddr) {
+    let mut reg = VMA_REGISTRY.lock();
+    match reg.iter_mut().find(|p| p.pd == pd) {
+        Some(proc) => proc.no_swap = true,
+        None => reg.push(ProcessVmas { pd, vmas: BTreeMap::new(), mmap_hint: MMAP_BASE, no_swap: true }),
+    }
+}
+
+/// User ranges `[start, end)` of `pd` the reclaim thread must not swap out
+/// (its file-backed regions, which `file_map` fills and writes back), or
+/// `None` if no page of `pd` may be swapped.
+pub fn swap_exclusions(pd: PhysAddr) -> Option<Vec<(u64, u64)>> {
+    let reg = VMA_REGISTRY.lock();
+    let proc = match reg.iter().find(|p| p.pd == pd) {
+        Some(p) => p,
+        None => return Some(Vec::new()),
+    };
+    if proc.no_swap {
+        return None;
+    }
+    Some(proc.vmas.values()
+        .filter(|v| v.file.is_some())
+        .map(|v| (v.start as u64, v.start as u64 + v.size as u64))
+        .collect())
+}
+
 /// Read the current mmap_hint for a process (used by fork snapshot).
 pub fn get_mmap_hint(pd: PhysAddr) -> u32 {
     let reg = VMA_REGISTRY.lock();
@@ -192,9 +356,11 @@ pub fn set_mmap_hint(pd: PhysAddr, hint: u32) {
 /// First-fit gap search within `[start_from, MMAP_LIMIT)`.
 ///
 /// Walks the sorted VMA map and looks for gaps between consecutive regions
-/// (and before the first / after the last region) that can fit `size` bytes.
-fn find_gap(vmas: &BTreeMap<u32, Vma>, start_from: u32, size: u32) -> Option<u32> {
+/// (and before the first / after the last region) that can fit `size` bytes
+/// starting at a multiple of `align` (a power of two).
+fn find_gap(vmas: &BTreeMap<u32, Vma>, start_from: u32, size: u32, align: u32) -> Option<u32> {
     let start_from = start_from.max(MMAP_BASE);
+    let align_up = |a: u32| a.checked_add(align - 1).map(|a| a & !(align - 1));
 
     // Check gap before the first VMA (or the entire range if empty).
     let mut cursor = start_from;
@@ -211,10 +377,9 @@ fn find_gap(vmas: &BTreeMap<u32, Vma>, start_from: u32, size: u32) -> Option<u32
         }
 
         // If this VMA starts after cursor, there's a gap [cursor, vma.start).
-        if vma.start > cursor {
-            let gap = vma.start - cursor;
-            if gap >= size {
-                return Some(cursor);
+        if let Some(start) = align_up(cursor) {
+            if vma.start > start && vma.start - start >= size {
+                return Some(start);
             }
         }
 
@@ -223,10 +388,9 @@ fn find_gap(vmas: &BTreeMap<u32, Vma>, start_from: u32, size: u32) -> Option<u32
     }
 
     // Check trailing gap after all VMAs.
-    if cursor < MMAP_LIMIT {
-        let gap = MMAP_LIMIT - cursor;
-        if gap >= size {
-            return Some(cursor);
+    if let Some(start) = align_up(cursor) {
+        if start < MMAP_LIMIT && MMAP_LIMIT - start >= size {
+            return Some(start);
         }
     }
 
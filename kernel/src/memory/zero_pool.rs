@@ -0,0 +1,125 @@
+//! Pool of pre-zeroed physical frames.
+//!
+//! Anonymous memory (user heap and `mmap`, demand-paged kernel heap, fresh
+//! stacks) must be cleared before it is handed out.  Instead of paying the
+//! 4 KiB clear on the fault or syscall path, a lowest-priority kernel thread
+//! ([`zero_thread`]) runs when a CPU has nothing else to do, takes frames
+//! from the allocator, clears them with non-temporal stores and parks them
+//! here.  [`alloc_zeroed_frame`] pops one if available and otherwise falls
+//! back to a plain frame the caller clears itself.
+//!
+//! Parked frames still count as free memory: the pool stops filling when
+//! memory runs low, and the allocator takes them back (see
+//! [`take_any`]) before it reports out-of-memory.
+
+use crate::memory::address::{PhysAddr, VirtAddr};
+use crate::memory::{memops, physical, virtual_mem, FRAME_SIZE};
+use crate::sync::spinlock::Spinlock;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// Frames kept ready (1 MiB).
+const CAPACITY: usize = 256;
+
+/// Do not fill the pool while fewer frames than this (16 MiB) are free.
+const RESERVE_FRAMES: usize = 4096;
+
+/// How often the thread looks at the pool when it is full.
+const REFILL_INTERVAL_NS: u64 = 50_000_000;
+
+/// Kernel temp VA the zeroing thread maps each frame at.
+const ZERO_TEMP: u64 = 0xFFFF_FFFF_BFF0_9000;
+
+struct Pool {
+    count: usize,
+    frames: [u32; CAPACITY],
+}
+
+static POOL: Spinlock<Pool> = Spinlock::new(Pool { count: 0, frames: [0; CAPACITY] });
+
+/// Guards the `ZERO_TEMP` window.  Held (interrupts off) from map to unmap,
+/// so the thread cannot migrate while the mapping is live.
+static ZERO_TEMP_LOCK: Spinlock<()> = Spinlock::new(());
+
+/// Allocations served from the pool / that had to clear the page.
+static HITS: AtomicU32 = AtomicU32::new(0);
+static MISSES: AtomicU32 = AtomicU32::new(0);
+
+/// Allocate a frame for memory that must start out zeroed.  Returns the
+/// frame and whether it is already zero; if not, the caller clears it
+/// (with [`memops::zero_page`]) once it is mapped.
+pub fn alloc_zeroed_frame() -> Option<(PhysAddr, bool)> {
+    if let Some(frame) = pop() {
+        HITS.fetch_add(1, Ordering::Relaxed);
+        return Some((frame, true));
+    }
+    MISSES.fetch_add(1, Ordering::Relaxed);
+    physical::alloc_frame().map(|f| (f, false))
+}
+
+/// Take any parked frame (the allocator's last resort when it is empty).
+pub fn take_any() -> Option<PhysAddr> {
+    pop()
+}
+
+/// Frames currently parked.
+pub fn pooled() -> usize {
+    POOL.lock().count
+}
+
+/// `(allocations served pre-zeroed, allocations that cleared the page)`.
+pub fn stats() -> (u32, u32) {
+    (HITS.load(Ordering::Relaxed), MISSES.load(Ordering::Relaxed))
+}
+
+fn pop() -> Option<PhysAddr> {
+    let mut pool = POOL.lock();
+    if pool.count == 0 {
+        return None;
+    }
+    pool.count -= 1;
+    let frame = pool.frames[pool.count];
+    drop(pool);
+    physical::note_frames_taken(1);
+    Some(PhysAddr::new(frame as u64 * FRAME_SIZE as u64))
+}
+
+/// Park a zeroed frame.  Returns `false` (frame not taken) if the pool is full.
+fn push(frame: PhysAddr) -> bool {
+    let mut pool = POOL.lock();
+    if pool.count == CAPACITY {
+        return false;
+    }
+    let n = pool.count;
+    pool.frames[n] = frame.frame_index() as u32;
+    pool.count += 1;
+    drop(pool);
+    physical::note_frames_returned(1);
+    true
+}
+
+/// Clear `frame` through the `ZERO_TEMP` window.
+fn clear(frame: PhysAddr) {
+    let _window = ZERO_TEMP_LOCK.lock();
+    let temp = VirtAddr::new(ZERO_TEMP);
+    virtual_mem::map_page(temp, frame, 0x02); // PAGE_WRITABLE
+    unsafe { memops::zero_page_nt(temp.as_u64() as *mut u8) };
+    virtual_mem::unmap_page(temp);
+}
+
+/// Background zeroing thread (priority 1: runs only when the CPU is
+/// otherwise idle).  Tops the pool up, then sleeps.
+pub extern "C" fn zero_thread() {
+    loop {
+        while pooled() < CAPACITY
+            && physical::free_frame_count().saturating_sub(pooled()) > RESERVE_FRAMES
+        {
+            let Some(frame) = physical::alloc_frame() else { break };
+            clear(frame);
+            if !push(frame) {
+                physical::free_frame(frame);
+                break;
+            }
+        }
+        crate::task::scheduler::sleep_ns(REFILL_INTERVAL_NS);
+    }
+}
@@ -1,14 +1,18 @@
 //! Ethernet frame handling: parse incoming frames and build outgoing ones.
 
-use alloc::vec::Vec;
 use super::types::MacAddr;
+use super::checksum::TxOffload;
+use super::pktbuf::PacketBuf;
 
 /// EtherType value for ARP frames.
 pub const ETHERTYPE_ARP: u16  = 0x0806;
 /// EtherType value for IPv4 frames.
 pub const ETHERTYPE_IPV4: u16 = 0x0800;
 
-const ETH_HEADER_LEN: usize = 14;
+/// Length of the Ethernet header (no VLAN tag).
+pub const ETH_HEADER_LEN: usize = 14;
+/// Most payload pieces [`send_frame_parts`] gathers into one frame.
+pub const MAX_PARTS: usize = 3;
 
 /// A parsed Ethernet frame with references into the original packet buffer.
 pub struct EthFrame<'a> {
@@ -32,39 +36,47 @@ pub fn parse(data: &[u8]) -> Option<EthFrame<'_>> {
     Some(EthFrame { dst, src, ethertype, payload })
 }
 
-/// Build an Ethernet frame: dst + src + ethertype + payload
-pub fn build_frame(dst: MacAddr, src: MacAddr, ethertype: u16, payload: &[u8]) -> Vec<u8> {
-    let mut frame = Vec::with_capacity(ETH_HEADER_LEN + payload.len());
-    frame.extend_from_slice(&dst.0);
-    frame.extend_from_slice(&src.0);
-    frame.push((ethertype >> 8) as u8);
-    frame.push((ethertype & 0xFF) as u8);
-    frame.extend_from_slice(payload);
-    // Pad to minimum Ethernet frame size (60 bytes without FCS)
-    while frame.len() < 60 {
-        frame.push(0);
-    }
-    frame
+/// Build an Ethernet header: dst + src + ethertype
+pub fn build_header(dst: MacAddr, src: MacAddr, ethertype: u16) -> [u8; ETH_HEADER_LEN] {
+    let mut hdr = [0u8; ETH_HEADER_LEN];
+    hdr[0..6].copy_from_slice(&dst.0);
+    hdr[6..12].copy_from_slice(&src.0);
+    hdr[12] = (ethertype >> 8) as u8;
+    hdr[13] = (ethertype & 0xFF) as u8;
+    hdr
 }
 
-/// Dispatch an incoming Ethernet frame to the appropriate protocol handler
-pub fn handle_frame(data: &[u8]) {
-    let frame = match parse(data) {
+/// Dispatch an incoming Ethernet frame to the appropriate protocol handler.
+/// Protocol layers receive counted views of `buf`, never copies.
+pub fn handle_frame(buf: &PacketBuf) {
+    let frame = match parse(buf) {
         Some(f) => f,
         None => return,
     };
 
     match frame.ethertype {
         ETHERTYPE_ARP => super::arp::handle_arp(frame.payload),
-        ETHERTYPE_IPV4 => super::ipv4::handle_ipv4(frame.payload),
+        ETHERTYPE_IPV4 => super::ipv4::handle_ipv4(&buf.view(frame.payload)),
         _ => {}
     }
 }
 
 /// Send a raw Ethernet frame.
 pub fn send_frame(dst: MacAddr, ethertype: u16, payload: &[u8]) {
+    send_frame_parts(dst, ethertype, &[payload], None);
+}
+
+/// Send an Ethernet frame whose payload is given in up to [`MAX_PARTS`]
+/// pieces (e.g. IPv4 header + transport segment).  The NIC gathers header
+/// and pieces directly into its transmit buffer and pads short frames.
+/// `offload` asks the NIC to insert the frame's checksums.
+pub fn send_frame_parts(dst: MacAddr, ethertype: u16, parts: &[&[u8]], offload: Option<TxOffload>) {
     let our_mac = super::config().mac;
-    let _frame = build_frame(dst, our_mac, ethertype, payload);
+    let hdr = build_header(dst, our_mac, ethertype);
+    let n = parts.len().min(MAX_PARTS);
+    let mut _pieces: [&[u8]; MAX_PARTS + 1] = [&[]; MAX_PARTS + 1];
+    _pieces[0] = &hdr;
+    _pieces[1..=n].copy_from_slice(&parts[..n]);
     #[cfg(target_arch = "x86_64")]
-    crate::drivers::network::e1000::transmit(&_frame);
+    crate::drivers::network::transmit_parts(&_pieces[..=n], offload);
 }
@@ -1,10 +1,10 @@
 //! IPv4 packet handling: build and parse IPv4 headers, route outgoing packets.
 //! Performs next-hop resolution via ARP before handing frames to the Ethernet layer.
 
-use alloc::vec::Vec;
 use super::types::{Ipv4Addr, MacAddr};
 use super::checksum;
 use super::ethernet;
+use super::pktbuf::PacketBuf;
 
 const IPV4_HEADER_LEN: usize = 20;
 /// IP protocol number for ICMP.
@@ -51,6 +51,25 @@ pub fn parse(data: &[u8]) -> Option<Ipv4Packet<'_>> {
 
 /// Build and send an IPv4 packet
 pub fn send_ipv4(dst: Ipv4Addr, protocol: u8, payload: &[u8]) -> bool {
+    send_ipv4_with(dst, protocol, payload, None)
+}
+
+/// Build and send an IPv4 packet whose header checksum and TCP/UDP checksum
+/// (field at `l4_csum_off` in `payload`, preloaded with the folded
+/// pseudo-header sum) are filled in by the NIC.  Only valid when
+/// [`checksum::tx_offload`] is true.
+pub fn send_ipv4_offload(dst: Ipv4Addr, protocol: u8, payload: &[u8], l4_csum_off: usize) -> bool {
+    let l4_start = ethernet::ETH_HEADER_LEN + IPV4_HEADER_LEN;
+    let offload = checksum::TxOffload {
+        ip_start: ethernet::ETH_HEADER_LEN as u8,
+        l4_start: l4_start as u8,
+        l4_csum: (l4_start + l4_csum_off) as u8,
+        tcp: protocol == PROTO_TCP,
+    };
+    send_ipv4_with(dst, protocol, payload, Some(offload))
+}
+
+fn send_ipv4_with(dst: Ipv4Addr, protocol: u8, payload: &[u8], offload: Option<checksum::TxOffload>) -> bool {
     let cfg = super::config();
     let total_len = IPV4_HEADER_LEN + payload.len();
     if total_len > 1500 { return false; }
@@ -73,20 +92,30 @@ pub fn send_ipv4(dst: Ipv4Addr, protocol: u8, payload: &[u8]) -> bool {
     // Checksum = 0 initially
     header[10] = 0;
     header[11] = 0;
-    // Source IP
-    header[12..16].copy_from_slice(&cfg.ip.0);
+    // Source IP (a 127.0.0.0/8 destination answers from itself, so both
+    // ends of a loopback connection see the same peer address)
+    let loopback = dst.0[0] == 127 || (dst == cfg.ip && cfg.ip != Ipv4Addr::ZERO);
+    let src = if dst.0[0] == 127 { dst } else { cfg.ip };
+    header[12..16].copy_from_slice(&src.0);
     // Destination IP
     header[16..20].copy_from_slice(&dst.0);
 
-    // Compute header checksum
-    let cksum = checksum::internet_checksum(&header);
-    header[10] = (cksum >> 8) as u8;
-    header[11] = (cksum & 0xFF) as u8;
+    // Compute header checksum (unless the NIC inserts it)
+    if offload.is_none() {
+        let cksum = checksum::internet_checksum(&header);
+        header[10] = (cksum >> 8) as u8;
+        header[11] = (cksum & 0xFF) as u8;
+    }
 
-    // Build full packet
-    let mut packet = Vec::with_capacity(total_len);
-    packet.extend_from_slice(&header);
-    packet.extend_from_slice(payload);
+    // Loopback never reaches the NIC: hand the frame to the receive path,
+    // with checksums marked verified as nothing could corrupt it
+    if loopback {
+        let eth = ethernet::build_header(cfg.mac, cfg.mac, ethernet::ETHERTYPE_IPV4);
+        return match PacketBuf::gather(&[&eth, &header, payload]) {
+            Some(frame) => super::rx::loopback(frame.with_csum_verified()),
+            None => false,
+        };
+    }
 
     // Resolve destination MAC
     let next_hop = if cfg.is_local(dst) || dst == Ipv4Addr::BROADCAST || dst.is_multicast() {
@@ -109,7 +138,7 @@ pub fn send_ipv4(dst: Ipv4Addr, protocol: u8, payload: &[u8]) -> bool {
         }
     };
 
-    ethernet::send_frame(dst_mac, ethernet::ETHERTYPE_IPV4, &packet);
+    ethernet::send_frame_parts(dst_mac, ethernet::ETHERTYPE_IPV4, &[&header, payload], offload);
     true
 }
 
@@ -136,24 +165,24 @@ pub fn send_ipv4_raw(src_ip: Ipv4Addr, dst_ip: Ipv4Addr, dst_mac: MacAddr, proto
     header[10] = (cksum >> 8) as u8;
     header[11] = (cksum & 0xFF) as u8;
 
-    let mut packet = Vec::with_capacity(total_len);
-    packet.extend_from_slice(&header);
-    packet.extend_from_slice(payload);
-
-    ethernet::send_frame(dst_mac, ethernet::ETHERTYPE_IPV4, &packet);
+    ethernet::send_frame_parts(dst_mac, ethernet::ETHERTYPE_IPV4, &[&header, payload], None);
     true
 }
 
-/// Handle an incoming IPv4 packet
-pub fn handle_ipv4(data: &[u8]) {
-    let pkt = match parse(data) {
+/// Handle an incoming IPv4 packet (`buf` is a view of the packet bytes)
+pub fn handle_ipv4(buf: &PacketBuf) {
+    let pkt = match parse(buf) {
         Some(p) => p,
         None => return,
     };
+    // Header checksum, unless the NIC already verified it
+    if !buf.csum_verified() && checksum::internet_checksum(&buf[..pkt.header_len]) != 0 {
+        return;
+    }
 
     match pkt.protocol {
         PROTO_ICMP => super::icmp::handle_icmp(&pkt),
-        PROTO_TCP => super::tcp::handle_tcp(&pkt),
+        PROTO_TCP => super::tcp::handle_tcp(&pkt, buf),
         PROTO_UDP => super::udp::handle_udp(&pkt),
         _ => {}
     }
@@ -2,6 +2,7 @@
 //! Provides global network configuration, packet polling, and sub-module access.
 
 pub mod types;
+pub mod pktbuf;
 pub mod checksum;
 pub mod ethernet;
 pub mod arp;
@@ -12,6 +13,8 @@ pub mod dhcp;
 pub mod dns;
 pub mod tcp;
 pub mod interfaces;
+#[cfg(target_arch = "x86_64")]
+pub mod rx;
 
 #[allow(unused_imports)]
 use alloc::vec::Vec;
@@ -26,7 +29,7 @@ static NET_CONFIG: Spinlock<NetConfig> = Spinlock::new(NetConfig::new());
 pub fn init() {
     // Get MAC from NIC driver
     #[cfg(target_arch = "x86_64")]
-    let mac_bytes = crate::drivers::network::e1000::get_mac().unwrap_or([0; 6]);
+    let mac_bytes = crate::drivers::network::get_mac().unwrap_or([0; 6]);
     #[cfg(target_arch = "aarch64")]
     let mac_bytes = [0u8; 6];
     let mac = MacAddr(mac_bytes);
@@ -81,7 +84,7 @@ pub fn poll() {
     poll_rx();
 
     // Rate-limit retransmission checks (every 10 ticks = 100ms).
-    // This avoids expensive TCP_CONNECTIONS lock acquisition on every poll.
+    // This avoids walking every connection on every poll.
     let now = crate::arch::hal::timer_current_ticks();
     let last = LAST_RETRANSMIT_CHECK.load(Ordering::Relaxed);
     if now.wrapping_sub(last) >= 10 {
@@ -91,28 +94,31 @@ pub fn poll() {
 }
 
 /// Fast path: process incoming packets only, no retransmission checks.
-/// Used by recv/send hot paths and IRQ handler for maximum throughput.
+/// Used by the recv/send hot paths; takes at most one [`rx::RX_BUDGET`]
+/// pass from the NIC ring, the `net_rx` thread handles the rest.
 pub fn poll_rx() {
     #[cfg(target_arch = "x86_64")]
     {
-        // Batch-drain E1000 rx_queue (single lock acquisition)
-        let mut packets: Vec<Vec<u8>> = Vec::new();
-        crate::drivers::network::e1000::recv_all_packets(&mut packets);
-        for packet in packets.iter() {
-            ethernet::handle_frame(packet);
+        // Batch-drain the NIC's rx_queue (single lock acquisition)
+        let mut packets: Vec<pktbuf::PacketBuf> = Vec::new();
+        crate::drivers::network::recv_all_packets(&mut packets);
+        for packet in packets.drain(..) {
+            ethernet::handle_frame(&packet);
         }
 
         // Poll hardware RX ring in case IRQs were missed, then drain again
-        crate::drivers::network::e1000::poll_rx();
-        packets.clear();
-        crate::drivers::network::e1000::recv_all_packets(&mut packets);
-        for packet in packets.iter() {
-            ethernet::handle_frame(packet);
+        crate::drivers::network::poll_rx(rx::RX_BUDGET);
+        crate::drivers::network::recv_all_packets(&mut packets);
+        for packet in packets.drain(..) {
+            ethernet::handle_frame(&packet);
         }
 
-        // Process CDC-ECM (USB Ethernet) RX packets
+        // Process CDC-ECM (USB Ethernet) RX packets; it has no ring of pool
+        // buffers, so each frame is copied into one here
         while let Some(packet) = crate::drivers::usb::cdc_ecm::recv_packet() {
-            ethernet::handle_frame(&packet);
+            if let Some(buf) = pktbuf::PacketBuf::copy_from(&packet) {
+                ethernet::handle_frame(&buf);
+            }
         }
     }
 }
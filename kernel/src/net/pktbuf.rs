@@ -0,0 +1,190 @@
+//! Preallocated, reference-counted packet buffers.
+//!
+//! The pool hands out fixed 2 KiB buffers carved two per 4 KiB physical
+//! frame.  The NIC RX rings (e1000, virtio-net) DMA straight into them: a
+//! filled descriptor's buffer is handed up the stack and a fresh one from
+//! the pool takes its place, so a received frame is never copied on its way through
+//! Ethernet → IPv4 → TCP.
+//!
+//! A [`PacketBuf`] is a view (`offset`, `len`) of one pool buffer.  Cloning
+//! or narrowing a view ([`PacketBuf::view`]) only bumps the buffer's
+//! reference count; the buffer returns to the pool when the last view is
+//! dropped.  Buffers are read-only once shared — only the driver writes
+//! them, while it holds the sole reference.
+//!
+//! The free list is preallocated, so allocating and releasing buffers
+//! (including from the NIC IRQ handler) never touches the heap.
+
+use alloc::vec::Vec;
+use core::ops::Deref;
+use core::sync::atomic::{AtomicBool, AtomicU16, AtomicUsize, Ordering};
+use crate::memory::physical;
+use crate::sync::spinlock::Spinlock;
+
+/// Size of one packet buffer (matches the e1000 2048-byte RX buffer size; holds
+/// an MTU frame behind the 12-byte virtio-net header).
+pub const BUF_SIZE: usize = 2048;
+/// Number of buffers in the pool (1 MiB per 512 buffers).
+const POOL_BUFS: usize = 1024;
+const BUFS_PER_FRAME: usize = 4096 / BUF_SIZE;
+const POOL_FRAMES: usize = POOL_BUFS / BUFS_PER_FRAME;
+
+/// Free buffers below which long-lived holders (TCP out-of-order queues)
+/// stop pinning buffers, so the RX ring can always be refilled.
+pub const LOW_WATER: usize = POOL_BUFS / 4;
+
+/// Identity-mapped physical address of each pool frame (set once by `init`).
+static FRAMES: [AtomicUsize; POOL_FRAMES] = [const { AtomicUsize::new(0) }; POOL_FRAMES];
+/// References held on each buffer; 0 while it sits on the free list.
+static REFS: [AtomicU16; POOL_BUFS] = [const { AtomicU16::new(0) }; POOL_BUFS];
+/// Indices of free buffers.
+static FREE: Spinlock<Vec<u16>> = Spinlock::new(Vec::new());
+static READY: AtomicBool = AtomicBool::new(false);
+
+/// Allocate the pool's frames.  Idempotent; returns false if physical
+/// memory ran out (the pool then holds whatever was allocated).
+pub fn init() -> bool {
+    if READY.swap(true, Ordering::AcqRel) {
+        return true;
+    }
+    let mut free = Vec::with_capacity(POOL_BUFS);
+    let mut ok = true;
+    for f in 0..POOL_FRAMES {
+        let frame = match physical::alloc_frame() {
+            Some(frame) => frame,
+            None => {
+                ok = false;
+                break;
+            }
+        };
+        FRAMES[f].store(frame.as_u64() as usize, Ordering::Release);
+        for b in 0..BUFS_PER_FRAME {
+            free.push((f * BUFS_PER_FRAME + b) as u16);
+        }
+    }
+    crate::serial_println!("  pktbuf: {} x {} byte packet buffers", free.len(), BUF_SIZE);
+    *FREE.lock() = free;
+    ok
+}
+
+/// Number of buffers currently free.
+pub fn available() -> usize {
+    FREE.lock().len()
+}
+
+#[inline]
+fn buf_addr(idx: u16) -> usize {
+    let i = idx as usize;
+    FRAMES[i / BUFS_PER_FRAME].load(Ordering::Relaxed) + (i % BUFS_PER_FRAME) * BUF_SIZE
+}
+
+/// A counted view of a pool buffer.
+pub struct PacketBuf {
+    idx: u16,
+    off: u16,
+    len: u16,
+    /// The NIC verified the IPv4 header and TCP/UDP checksums.
+    csum_ok: bool,
+}
+
+impl PacketBuf {
+    /// Take a buffer from the pool, spanning all [`BUF_SIZE`] bytes.
+    pub fn alloc() -> Option<PacketBuf> {
+        let idx = FREE.lock().pop()?;
+        REFS[idx as usize].store(1, Ordering::Relaxed);
+        Some(PacketBuf { idx, off: 0, len: BUF_SIZE as u16, csum_ok: false })
+    }
+
+    /// Copy `data` into a fresh buffer (for drivers without a DMA ring).
+    pub fn copy_from(data: &[u8]) -> Option<PacketBuf> {
+        if data.len() > BUF_SIZE {
+            return None;
+        }
+        let buf = Self::alloc()?;
+        unsafe {
+            core::ptr::copy_nonoverlapping(data.as_ptr(), buf_addr(buf.idx) as *mut u8, data.len());
+        }
+        Some(buf.truncated(data.len()))
+    }
+
+    /// Copy the concatenation of `parts` into a fresh buffer (loopback).
+    pub fn gather(parts: &[&[u8]]) -> Option<PacketBuf> {
+        let len: usize = parts.iter().map(|p| p.len()).sum();
+        if len > BUF_SIZE {
+            return None;
+        }
+        let buf = Self::alloc()?;
+        let mut dst = buf_addr(buf.idx) as *mut u8;
+        for part in parts {
+            unsafe {
+                core::ptr::copy_nonoverlapping(part.as_ptr(), dst, part.len());
+                dst = dst.add(part.len());
+            }
+        }
+        Some(buf.truncated(len))
+    }
+
+    /// Physical address of the buffer start, for DMA descriptors.
+    #[inline]
+    pub fn phys(&self) -> u64 {
+        buf_addr(self.idx) as u64
+    }
+
+    /// Shrink the view to its first `len` bytes.
+    pub fn truncated(mut self, len: usize) -> PacketBuf {
+        self.len = self.len.min(len as u16);
+        self
+    }
+
+    /// Mark the frame's checksums as verified by hardware (RX offload).
+    pub fn with_csum_verified(mut self) -> PacketBuf {
+        self.csum_ok = true;
+        self
+    }
+
+    /// Whether the NIC already verified the IPv4 and TCP/UDP checksums, so
+    /// the stack can skip summing the packet.
+    #[inline]
+    pub fn csum_verified(&self) -> bool {
+        self.csum_ok
+    }
+
+    /// Counted view of `sub`, which must be a subslice of this buffer's
+    /// bytes (e.g. a parsed header's payload).
+    pub fn view(&self, sub: &[u8]) -> PacketBuf {
+        let base = self.as_ptr() as usize;
+        let start = sub.as_ptr() as usize;
+        assert!(start >= base && start + sub.len() <= base + self.len as usize,
+            "pktbuf: view outside buffer");
+        let mut v = self.clone();
+        v.off += (start - base) as u16;
+        v.len = sub.len() as u16;
+        v
+    }
+}
+
+impl Deref for PacketBuf {
+    type Target = [u8];
+
+    #[inline]
+    fn deref(&self) -> &[u8] {
+        unsafe {
+            core::slice::from_raw_parts((buf_addr(self.idx) + self.off as usize) as *const u8, self.len as usize)
+        }
+    }
+}
+
+impl Clone for PacketBuf {
+    fn clone(&self) -> Self {
+        REFS[self.idx as usize].fetch_add(1, Ordering::Relaxed);
+        PacketBuf { idx: self.idx, off: self.off, len: self.len, csum_ok: self.csum_ok }
+    }
+}
+
+impl Drop for PacketBuf {
+    fn drop(&mut self) {
+        if REFS[self.idx as usize].fetch_sub(1, Ordering::AcqRel) == 1 {
+            FREE.lock().push(self.idx);
+        }
+    }
+}
@@ -0,0 +1,125 @@
+//! NAPI-style receive processing.
+//!
+//! NIC interrupt handlers no longer walk their receive rings.  On an RX
+//! interrupt the driver masks further RX interrupts and calls [`schedule`];
+//! the `net_rx` kernel thread then reaps the ring in passes of at most
+//! [`RX_BUDGET`] frames and runs each batch through the stack in thread
+//! context.  A pass that uses its whole budget yields the CPU and polls
+//! again with interrupts still masked, so a flood costs one thread's share
+//! of a CPU instead of live-locking it in interrupt context.  A short pass
+//! unmasks the interrupt and puts the thread back to sleep.
+//!
+//! Packets the stack sends to itself (127.0.0.0/8 or its own address) are
+//! queued by [`loopback`] and fed through the same passes, so loopback
+//! traffic never re-enters the stack from inside a send.
+
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use crate::net::ethernet;
+use crate::net::pktbuf::PacketBuf;
+use crate::sync::spinlock::Spinlock;
+use crate::task::scheduler;
+
+/// Frames taken from the NIC per pass.
+pub const RX_BUDGET: usize = 64;
+
+/// Idle sleep of the thread in ticks.  Bounds the delay if a wake-up is
+/// lost (`deferred_wake` may overwrite a slot) or the NIC has no interrupt.
+const RX_IDLE_TICKS: u32 = 100;
+
+struct RxWait {
+    /// An RX interrupt arrived since the thread last looked.
+    pending: bool,
+    /// TID of the sleeping `net_rx` thread (0 = not sleeping).
+    tid: u32,
+}
+
+static RX_WAIT: Spinlock<RxWait> = Spinlock::new(RxWait { pending: false, tid: 0 });
+
+/// Loopback frames queued beyond this are dropped (TCP retransmits).
+const LOOPBACK_MAX: usize = 256;
+
+/// Frames sent to ourselves, waiting for the `net_rx` thread.
+static LOOPBACK: Spinlock<VecDeque<PacketBuf>> = Spinlock::new(VecDeque::new());
+
+/// Queue a frame the stack sent to itself for receive processing.
+/// Returns false if the queue is full.
+pub fn loopback(frame: PacketBuf) -> bool {
+    {
+        let mut q = LOOPBACK.lock();
+        if q.len() >= LOOPBACK_MAX {
+            return false;
+        }
+        q.push_back(frame);
+    }
+    schedule();
+    true
+}
+
+/// Hand receive processing to the `net_rx` thread.  Called by NIC drivers
+/// from their interrupt handler after masking RX interrupts.
+pub fn schedule() {
+    let tid = {
+        let mut w = RX_WAIT.lock();
+        w.pending = true;
+        core::mem::replace(&mut w.tid, 0)
+    };
+    if tid != 0 && !scheduler::try_wake_thread(tid) {
+        scheduler::deferred_wake(tid);
+    }
+}
+
+/// Sleep until [`schedule`] is called or the idle timeout expires.
+fn wait() {
+    let mut w = RX_WAIT.lock();
+    if !w.pending {
+        // Publish ourselves under RX_WAIT: `schedule` either already set
+        // `pending` or will find our TID after we are marked Blocked.
+        w.tid = scheduler::current_tid();
+        let wake_at = crate::arch::hal::timer_current_ticks().wrapping_add(RX_IDLE_TICKS);
+        scheduler::prepare_block_current(Some(wake_at));
+        drop(w);
+        scheduler::schedule();
+        w = RX_WAIT.lock();
+        w.tid = 0;
+    }
+    w.pending = false;
+}
+
+/// Run one pass: reap up to [`RX_BUDGET`] frames from the ring and as
+/// many from the loopback queue, and process everything queued.  Returns
+/// the number of frames taken.
+fn pass(packets: &mut Vec<PacketBuf>) -> usize {
+    let mut n = crate::drivers::network::poll_rx(RX_BUDGET);
+    crate::drivers::network::recv_all_packets(packets);
+    {
+        let mut q = LOOPBACK.lock();
+        let take = q.len().min(RX_BUDGET);
+        packets.extend(q.drain(..take));
+        n = n.max(take);
+    }
+    for packet in packets.drain(..) {
+        ethernet::handle_frame(&packet);
+    }
+    n
+}
+
+/// Entry point for the `net_rx` kernel thread.
+pub extern "C" fn rx_thread() {
+    let mut packets: Vec<PacketBuf> = Vec::with_capacity(RX_BUDGET);
+    loop {
+        wait();
+        loop {
+            if pass(&mut packets) >= RX_BUDGET {
+                // Budget spent: let other threads run, stay in polling mode
+                scheduler::schedule();
+                continue;
+            }
+            // Ring drained: back to interrupt mode, unless frames slipped
+            // in before the interrupt was unmasked
+            if crate::drivers::network::set_rx_irq(true) {
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,226 @@
+//! Congestion control and retransmission timing.
+//!
+//! - RTO estimation per RFC 6298: one segment per window is timed, samples
+//!   from retransmitted segments are discarded (Karn), and the RTO backs
+//!   off exponentially on consecutive timeouts.
+//! - NewReno congestion control (RFC 5681 / RFC 6582): slow start,
+//!   congestion avoidance, fast retransmit on the third duplicate ACK and
+//!   fast recovery with partial-ACK retransmission.
+//! - A SACK scoreboard (RFC 2018) of ranges the peer reported, so fast
+//!   recovery retransmits every hole once instead of one segment per RTT.
+//!
+//! All times are in timer ticks.  Everything here runs under the
+//! connection's lock and never sends; callers transmit the returned
+//! sequence ranges after unlocking.
+
+use alloc::vec::Vec;
+use super::tcb::*;
+use super::util::{is_seq_gt, is_seq_gte, is_seq_lte};
+
+/// Bytes sent but not yet acknowledged.
+#[inline]
+pub(crate) fn flight_size(tcb: &Tcb) -> u32 {
+    tcb.snd_nxt.wrapping_sub(tcb.snd_una)
+}
+
+/// Bytes `send` may have in flight: the smaller of the peer's window and
+/// the congestion window.
+pub(crate) fn send_window(tcb: &Tcb) -> usize {
+    let peer = (tcb.snd_wnd as usize).max(MSS);
+    peer.min(tcb.cwnd as usize).min(MAX_IN_FLIGHT)
+}
+
+// ── RTT estimation (RFC 6298) ───────────────────────────────────────
+
+/// Time the segment ending at `end_seq` unless a sample is already running.
+pub(crate) fn start_rtt(tcb: &mut Tcb, end_seq: u32, now: u32) {
+    if !tcb.rtt_timing {
+        tcb.rtt_timing = true;
+        tcb.rtt_seq = end_seq;
+        tcb.rtt_start = now;
+    }
+}
+
+/// Fold one round-trip measurement into SRTT / RTTVAR and recompute RTO.
+pub(crate) fn rtt_sample(tcb: &mut Tcb, rtt: u32) {
+    let r = rtt.max(1);
+    if tcb.srtt == 0 {
+        // First measurement: SRTT = R, RTTVAR = R/2
+        tcb.srtt = r << 3;
+        tcb.rttvar = r << 1;
+    } else {
+        // SRTT += (R - SRTT)/8, RTTVAR += (|R - SRTT| - RTTVAR)/4
+        let delta = r as i32 - (tcb.srtt >> 3) as i32;
+        tcb.srtt = (tcb.srtt as i32 + delta).max(8) as u32;
+        tcb.rttvar = tcb.rttvar - (tcb.rttvar >> 2) + delta.unsigned_abs();
+    }
+    // RTO = SRTT + max(G, 4 * RTTVAR), G = one tick
+    tcb.rto = ((tcb.srtt >> 3) + tcb.rttvar.max(1)).clamp(RTO_MIN, RTO_MAX);
+}
+
+/// Current retransmission timeout including exponential backoff.
+pub(crate) fn backed_off_rto(tcb: &Tcb) -> u32 {
+    tcb.rto.saturating_mul(1 << tcb.retransmit_count.min(6)).min(RTO_MAX)
+}
+
+// ── ACK processing ──────────────────────────────────────────────────
+
+/// Account for an ACK that advanced `snd_una` by `acked` bytes (`snd_una`
+/// already updated).  Returns true when the segment at the new `snd_una`
+/// should be retransmitted: a NewReno partial ACK, or an ACK that still
+/// falls short of what was outstanding when the retransmission timer fired.
+pub(crate) fn on_new_ack(tcb: &mut Tcb, acked: u32, now: u32) -> bool {
+    if tcb.rtt_timing && is_seq_gte(tcb.snd_una, tcb.rtt_seq) {
+        tcb.rtt_timing = false;
+        rtt_sample(tcb, now.wrapping_sub(tcb.rtt_start));
+    }
+    tcb.retransmit_count = 0;
+    tcb.dup_ack_count = 0;
+    sack_trim(tcb);
+
+    let mss = MSS as u32;
+    if tcb.in_recovery {
+        if is_seq_gte(tcb.snd_una, tcb.recover) {
+            // Full ACK: leave fast recovery with the window deflated
+            tcb.in_recovery = false;
+            tcb.cwnd = tcb.ssthresh.min(flight_size(tcb) + mss).max(mss);
+            false
+        } else {
+            // Partial ACK: the next hole is lost too
+            tcb.cwnd = tcb.cwnd.saturating_sub(acked).saturating_add(mss).max(mss);
+            let next = tcb.snd_una.wrapping_add(mss);
+            if is_seq_gt(next, tcb.high_rxt) {
+                tcb.high_rxt = next;
+            }
+            true
+        }
+    } else {
+        if tcb.cwnd < tcb.ssthresh {
+            // Slow start (appropriate byte counting, L = 2 * SMSS)
+            tcb.cwnd = tcb.cwnd.saturating_add(acked.min(2 * mss));
+        } else {
+            // Congestion avoidance: about one SMSS per round trip
+            tcb.cwnd = tcb.cwnd.saturating_add((mss * mss / tcb.cwnd).max(1));
+        }
+        tcb.recover_valid && is_seq_gt(tcb.recover, tcb.snd_una)
+    }
+}
+
+/// Account for a duplicate ACK.  Returns the sequence number of a segment
+/// to retransmit, if any: `snd_una` on the third duplicate (fast
+/// retransmit), or the next un-SACKed hole during SACK recovery.
+pub(crate) fn on_dup_ack(tcb: &mut Tcb) -> Option<u32> {
+    tcb.dup_ack_count += 1;
+    let mss = MSS as u32;
+
+    if tcb.in_recovery {
+        // Each duplicate means a segment left the network
+        tcb.cwnd = tcb.cwnd.saturating_add(mss);
+        return next_hole(tcb);
+    }
+    if tcb.dup_ack_count != 3 {
+        return None;
+    }
+    // RFC 6582 §3.2: no new recovery for duplicates of an older window
+    if tcb.recover_valid && !is_seq_gt(tcb.snd_una, tcb.recover) {
+        return None;
+    }
+
+    tcb.ssthresh = (flight_size(tcb) / 2).max(2 * mss);
+    tcb.cwnd = tcb.ssthresh + 3 * mss;
+    tcb.recover = tcb.snd_nxt;
+    tcb.recover_valid = true;
+    tcb.in_recovery = true;
+    tcb.rtt_timing = false; // Karn: no sample across retransmission
+    tcb.high_rxt = tcb.snd_una.wrapping_add(mss);
+    Some(tcb.snd_una)
+}
+
+/// Retransmission timeout fired: collapse the window to one segment.
+pub(crate) fn on_timeout(tcb: &mut Tcb) {
+    let mss = MSS as u32;
+    tcb.ssthresh = (flight_size(tcb) / 2).max(2 * mss);
+    tcb.cwnd = mss;
+    tcb.in_recovery = false;
+    tcb.recover = tcb.snd_nxt;
+    tcb.recover_valid = true;
+    tcb.rtt_timing = false;
+    tcb.dup_ack_count = 0;
+    // RFC 6675 §5.1: the receiver may have reneged; forget the scoreboard
+    tcb.sacked.clear();
+}
+
+// ── SACK scoreboard ─────────────────────────────────────────────────
+
+/// Merge the SACK blocks of an incoming ACK into the scoreboard.
+pub(crate) fn sack_update(tcb: &mut Tcb, blocks: &[(u32, u32)]) {
+    for &(left, right) in blocks {
+        // Ignore blocks that are stale or beyond what we sent
+        if !is_seq_gt(right, left) || !is_seq_gt(right, tcb.snd_una) || is_seq_gt(right, tcb.snd_nxt) {
+            continue;
+        }
+        let left = if is_seq_gt(tcb.snd_una, left) { tcb.snd_una } else { left };
+        sack_insert(&mut tcb.sacked, left, right);
+    }
+}
+
+fn sack_insert(board: &mut Vec<(u32, u32)>, mut left: u32, mut right: u32) {
+    // Absorb every range overlapping or touching [left, right)
+    let mut i = 0;
+    while i < board.len() {
+        let (l, r) = board[i];
+        if is_seq_lte(l, right) && is_seq_gte(r, left) {
+            if is_seq_gt(left, l) { left = l; }
+            if is_seq_gt(r, right) { right = r; }
+            board.remove(i);
+        } else {
+            i += 1;
+        }
+    }
+    if board.len() >= MAX_SACK_RANGES {
+        return;
+    }
+    let pos = board.iter().position(|&(l, _)| is_seq_gt(l, left)).unwrap_or(board.len());
+    board.insert(pos, (left, right));
+}
+
+/// Drop scoreboard ranges the cumulative ACK has overtaken.
+fn sack_trim(tcb: &mut Tcb) {
+    let una = tcb.snd_una;
+    tcb.sacked.retain(|&(_, r)| is_seq_gt(r, una));
+    if let Some(first) = tcb.sacked.first_mut() {
+        if is_seq_gt(una, first.0) {
+            first.0 = una;
+        }
+    }
+}
+
+/// Next lost segment to retransmit during SACK recovery: the first
+/// un-SACKed byte at or after `high_rxt` that lies below a SACKed range.
+fn next_hole(tcb: &mut Tcb) -> Option<u32> {
+    let mut seq = if is_seq_gt(tcb.snd_una, tcb.high_rxt) { tcb.snd_una } else { tcb.high_rxt };
+    for &(l, r) in tcb.sacked.iter() {
+        if is_seq_gt(l, seq) {
+            tcb.high_rxt = seq.wrapping_add((l.wrapping_sub(seq)).min(MSS as u32));
+            return Some(seq);
+        }
+        if is_seq_gt(r, seq) {
+            seq = r;
+        }
+    }
+    None
+}
+
+/// Length of the retransmission starting at `seq`: up to one MSS, stopping
+/// at the next SACKed range and at the end of the buffered data.
+pub(crate) fn retransmit_len(tcb: &Tcb, seq: u32) -> usize {
+    let offset = seq.wrapping_sub(tcb.snd_una) as usize;
+    let mut len = tcb.send_buf.len().saturating_sub(offset).min(MSS);
+    for &(l, _) in tcb.sacked.iter() {
+        if is_seq_gt(l, seq) {
+            len = len.min(l.wrapping_sub(seq) as usize);
+            break;
+        }
+    }
+    len
+}
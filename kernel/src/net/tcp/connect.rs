@@ -4,10 +4,12 @@
 //! `close_listener()`, `shutdown_write()`, and `status()`.
 
 use core::sync::atomic::Ordering;
+use alloc::vec::Vec;
 use super::tcb::*;
-use super::send::{send_segment, send_syn_segment};
+use super::send::{send_segment, send_syn_segment, SynOpts};
+use super::table::{self, ConnKey};
 use super::util::alloc_ephemeral_port;
-use super::{TCP_CONNECTIONS, TCP_ACTIVE_OPENS, TCP_PASSIVE_OPENS};
+use super::{TCP_ACTIVE_OPENS, TCP_PASSIVE_OPENS};
 use crate::net::types::Ipv4Addr;
 
 /// Active open: connect to a remote host. Returns socket ID or u32::MAX on error.
@@ -16,42 +18,22 @@ pub fn connect(remote_ip: Ipv4Addr, remote_port: u16, timeout_ticks: u32) -> u32
     let local_port = alloc_ephemeral_port();
     let tid = crate::task::scheduler::current_tid();
 
-    // Find a free slot and insert TCB
-    let slot_id = {
-        let mut conns = TCP_CONNECTIONS.lock();
-        let table = match conns.as_mut() {
-            Some(t) => t,
-            None => return u32::MAX,
-        };
-        let mut found = None;
-        for (i, slot) in table.iter_mut().enumerate() {
-            if slot.is_none() {
-                let mut tcb = Tcb::new(cfg.ip, local_port, remote_ip, remote_port);
-                tcb.state = TcpState::SynSent;
-                tcb.snd_nxt = tcb.snd_iss.wrapping_add(1);
-                tcb.last_send_tick = crate::arch::hal::timer_current_ticks();
-                tcb.owner_tid = tid;
-                *slot = Some(tcb);
-                found = Some(i);
-                break;
-            }
-        }
-        match found {
-            Some(id) => id,
-            None => return u32::MAX,
-        }
-    };
-
-    // Send SYN (outside lock!)
-    let iss = {
-        let conns = TCP_CONNECTIONS.lock();
-        let table = conns.as_ref().unwrap();
-        table[slot_id].as_ref().unwrap().snd_iss
+    // Insert the TCB
+    let mut tcb = Tcb::new(cfg.ip, local_port, remote_ip, remote_port);
+    tcb.state = TcpState::SynSent;
+    tcb.snd_nxt = tcb.snd_iss.wrapping_add(1);
+    tcb.last_send_tick = crate::arch::hal::timer_current_ticks();
+    tcb.owner_tid = tid;
+    let iss = tcb.snd_iss;
+    let (slot_id, tcb_ref) = match table::insert(tcb) {
+        Some(t) => t,
+        None => return u32::MAX,
     };
 
     crate::serial_println!("TCP: connecting to {}:{} from port {}", remote_ip, remote_port, local_port);
     TCP_ACTIVE_OPENS.fetch_add(1, Ordering::Relaxed);
-    send_syn_segment(cfg.ip, local_port, remote_ip, remote_port, iss, 0, SYN);
+    send_syn_segment(cfg.ip, local_port, remote_ip, remote_port, iss, 0, SYN,
+                     SynOpts { wscale: true, sack: true });
 
     // Wait for connection to establish (blocking)
     let start = crate::arch::hal::timer_current_ticks();
@@ -61,38 +43,38 @@ pub fn connect(remote_ip: Ipv4Addr, remote_port: u16, timeout_ticks: u32) -> u32
 
     loop {
         {
-            let mut conns = TCP_CONNECTIONS.lock();
-            let table = conns.as_mut().unwrap();
-            if let Some(tcb) = table[slot_id].as_mut() {
-                match tcb.state {
-                    TcpState::Established => {
-                        tcb.waiting_tid = 0;
-                        crate::serial_println!("TCP: connected socket {}", slot_id);
-                        return slot_id as u32;
-                    }
-                    TcpState::Closed => {
-                        tcb.waiting_tid = 0;
-                        crate::serial_println!("TCP: connection refused");
-                        return u32::MAX;
-                    }
-                    _ => {}
-                }
-                if tcb.reset_received {
-                    table[slot_id] = None;
-                    return u32::MAX;
+            let mut tcb = tcb_ref.lock();
+            if tcb.detached {
+                return u32::MAX;
+            }
+            match tcb.state {
+                TcpState::Established => {
+                    tcb.waiting_tid = 0;
+                    crate::serial_println!("TCP: connected socket {}", slot_id);
+                    return slot_id;
                 }
-
-                let now = crate::arch::hal::timer_current_ticks();
-                if now.wrapping_sub(start) >= timeout_ticks {
-                    crate::serial_println!("TCP: connect timeout");
-                    table[slot_id] = None;
+                TcpState::Closed => {
+                    tcb.waiting_tid = 0;
+                    crate::serial_println!("TCP: connection refused");
                     return u32::MAX;
                 }
+                _ => {}
+            }
+            if tcb.reset_received {
+                drop(tcb);
+                table::discard(slot_id, &tcb_ref);
+                return u32::MAX;
+            }
 
-                tcb.waiting_tid = tid;
-            } else {
+            let now = crate::arch::hal::timer_current_ticks();
+            if now.wrapping_sub(start) >= timeout_ticks {
+                crate::serial_println!("TCP: connect timeout");
+                drop(tcb);
+                table::discard(slot_id, &tcb_ref);
                 return u32::MAX;
             }
+
+            tcb.waiting_tid = tid;
         }
 
         let wake_at = crate::arch::hal::timer_current_ticks() + 1;
@@ -102,46 +84,52 @@ pub fn connect(remote_ip: Ipv4Addr, remote_port: u16, timeout_ticks: u32) -> u32
 }
 
 /// Passive open: listen on a local port. Returns listener socket ID or u32::MAX.
-pub fn listen(port: u16, _backlog: u16) -> u32 {
+///
+/// `backlog` bounds the connections pending on the listener (0 selects
+/// [`DEFAULT_BACKLOG`], larger values are clamped to [`MAX_BACKLOG`]).
+/// Calling `listen` again on a port the thread already listens on changes
+/// that listener's backlog in place and returns its id, so a server can
+/// grow its backlog under load.  With `reuse_port`, the listener joins the
+/// port's group if every existing member was opened with `reuse_port` as
+/// well, and incoming connections are spread across the group.
+pub fn listen(port: u16, backlog: u16, reuse_port: bool) -> u32 {
     let cfg = crate::net::config();
     let tid = crate::task::scheduler::current_tid();
-    let mut conns = TCP_CONNECTIONS.lock();
-    let table = match conns.as_mut() {
-        Some(t) => t,
-        None => return u32::MAX,
+    let backlog = match backlog as usize {
+        0 => DEFAULT_BACKLOG,
+        n => n.min(MAX_BACKLOG),
     };
 
-    // Check if port is already in use
-    for (i, slot) in table.iter().enumerate() {
-        if let Some(tcb) = slot {
-            if tcb.local_port == port && tcb.state == TcpState::Listen {
-                crate::serial_println!("TCP: port {} already listening (slot {} owner_tid={})",
-                    port, i, tcb.owner_tid);
-                return u32::MAX;
-            }
+    let key = ConnKey { local_port: port, remote_ip: Ipv4Addr([0, 0, 0, 0]), remote_port: 0 };
+    let existing = table::listeners(&key);
+    for (id, listener) in &existing {
+        let mut l = listener.lock();
+        if l.owner_tid == tid && l.state == TcpState::Listen && !l.detached {
+            l.backlog = backlog;
+            crate::serial_println!("TCP: backlog of listener {} on port {} set to {}", id, port, backlog);
+            return *id;
         }
     }
 
-    // Find a free slot
-    let mut found = None;
-    for (i, slot) in table.iter_mut().enumerate() {
-        if slot.is_none() {
-            let mut tcb = Tcb::new(cfg.ip, port, Ipv4Addr([0, 0, 0, 0]), 0);
-            tcb.state = TcpState::Listen;
-            tcb.owner_tid = tid;
-            *slot = Some(tcb);
-            found = Some(i);
-            break;
+    let mut tcb = Tcb::new(cfg.ip, port, Ipv4Addr([0, 0, 0, 0]), 0);
+    tcb.state = TcpState::Listen;
+    tcb.owner_tid = tid;
+    tcb.backlog = backlog;
+    tcb.reuse_port = reuse_port;
+    match table::insert(tcb) {
+        Some((id, _)) => {
+            crate::serial_println!("TCP: listening on port {} (socket {}, backlog {}{})",
+                port, id, backlog, if reuse_port { ", shared" } else { "" });
+            id
         }
-    }
-
-    match found {
-        Some(id) => {
-            crate::serial_println!("TCP: listening on port {} (socket {})", port, id);
-            id as u32
+        None if !existing.is_empty() => {
+            let (id, l) = &existing[0];
+            crate::serial_println!("TCP: port {} already listening (slot {} owner_tid={})",
+                port, id, l.lock().owner_tid);
+            u32::MAX
         }
         None => {
-            crate::serial_println!("TCP: no free slots for listen");
+            crate::serial_println!("TCP: no free slots for listen on port {}", port);
             u32::MAX
         }
     }
@@ -150,10 +138,10 @@ pub fn listen(port: u16, _backlog: u16) -> u32 {
 /// Accept a connection from a listening socket.
 /// Blocks until a connection is established or timeout.
 pub fn accept(listener_id: u32, timeout_ticks: u32) -> (u32, Ipv4Addr, u16) {
-    let lid = listener_id as usize;
-    if lid >= MAX_CONNECTIONS {
-        return (u32::MAX, Ipv4Addr([0; 4]), 0);
-    }
+    let listener = match table::get(listener_id) {
+        Some(l) => l,
+        None => return (u32::MAX, Ipv4Addr([0; 4]), 0),
+    };
 
     let tid = crate::task::scheduler::current_tid();
     let start = crate::arch::hal::timer_current_ticks();
@@ -162,60 +150,52 @@ pub fn accept(listener_id: u32, timeout_ticks: u32) -> (u32, Ipv4Addr, u16) {
     crate::net::poll();
 
     loop {
-        {
-            let mut conns = TCP_CONNECTIONS.lock();
-            let table = match conns.as_mut() {
-                Some(t) => t,
-                None => return (u32::MAX, Ipv4Addr([0; 4]), 0),
-            };
+        let candidate = {
+            let mut l = listener.lock();
 
             // Verify listener is still valid
-            let listen_valid = table[lid].as_ref()
-                .map(|t| t.state == TcpState::Listen)
-                .unwrap_or(false);
-            if !listen_valid {
-                if let Some(tcb) = table[lid].as_mut() {
-                    tcb.waiting_tid = 0;
-                }
+            if l.state != TcpState::Listen || l.detached {
+                l.waiting_tid = 0;
                 return (u32::MAX, Ipv4Addr([0; 4]), 0);
             }
 
-            // Find a ready connection spawned by this listener
-            for i in 0..table.len() {
-                let ready = table[i].as_ref().map(|tcb| {
-                    tcb.parent_listener == Some(lid as u8)
-                        && tcb.state == TcpState::Established
-                        && !tcb.accepted
-                }).unwrap_or(false);
+            match l.accept_queue.pop_front() {
+                Some(cid) => {
+                    l.waiting_tid = 0;
+                    Some(cid)
+                }
+                None => {
+                    // Check timeout
+                    let now = crate::arch::hal::timer_current_ticks();
+                    if now.wrapping_sub(start) >= timeout_ticks {
+                        l.waiting_tid = 0;
+                        return (u32::MAX, Ipv4Addr([0; 4]), 0);
+                    }
+                    l.waiting_tid = tid;
+                    None
+                }
+            }
+        };
 
+        if let Some(cid) = candidate {
+            // Take over the queued child unless it was reset meanwhile.
+            if let Some(child) = table::get(cid) {
+                let mut tcb = child.lock();
+                let ready = tcb.parent_listener == Some(listener_id)
+                    && !tcb.accepted
+                    && matches!(tcb.state, TcpState::Established | TcpState::CloseWait);
                 if ready {
-                    let tcb = table[i].as_mut().unwrap();
                     tcb.accepted = true;
                     tcb.parent_listener = None;
-                    tcb.owner_tid = crate::task::scheduler::current_tid();
+                    tcb.owner_tid = tid;
                     let rip = tcb.remote_ip;
                     let rport = tcb.remote_port;
-                    if let Some(listener) = table[lid].as_mut() {
-                        listener.waiting_tid = 0;
-                    }
-                    crate::serial_println!("TCP: accepted socket {} from {}:{}", i, rip, rport);
+                    crate::serial_println!("TCP: accepted socket {} from {}:{}", cid, rip, rport);
                     TCP_PASSIVE_OPENS.fetch_add(1, Ordering::Relaxed);
-                    return (i as u32, rip, rport);
-                }
-            }
-
-            // Check timeout
-            let now = crate::arch::hal::timer_current_ticks();
-            if now.wrapping_sub(start) >= timeout_ticks {
-                if let Some(tcb) = table[lid].as_mut() {
-                    tcb.waiting_tid = 0;
+                    return (cid, rip, rport);
                 }
-                return (u32::MAX, Ipv4Addr([0; 4]), 0);
-            }
-
-            if let Some(tcb) = table[lid].as_mut() {
-                tcb.waiting_tid = tid;
             }
+            continue;
         }
 
         let wake_at = crate::arch::hal::timer_current_ticks() + 1;
@@ -224,75 +204,73 @@ pub fn accept(listener_id: u32, timeout_ticks: u32) -> (u32, Ipv4Addr, u16) {
     }
 }
 
-/// Close a listening socket. Also cleans up any pending (unaccepted) connections.
-pub fn close_listener(socket_id: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS {
-        return u32::MAX;
+/// Whether `accept` on a listening socket would return a connection without
+/// blocking.  `None` if `socket_id` is not a listening socket.
+pub fn accept_ready(socket_id: u32) -> Option<bool> {
+    let listener = table::get(socket_id)?;
+    let l = listener.lock();
+    if l.state != TcpState::Listen {
+        return None;
     }
+    Some(!l.accept_queue.is_empty())
+}
 
-    let mut conns = TCP_CONNECTIONS.lock();
-    let table = match conns.as_mut() {
-        Some(t) => t,
+/// Close a listening socket. Also cleans up any pending (unaccepted) connections.
+pub fn close_listener(socket_id: u32) -> u32 {
+    let listener = match table::get(socket_id) {
+        Some(l) => l,
         None => return u32::MAX,
     };
 
-    let is_listener = table[id].as_ref()
-        .map(|t| t.state == TcpState::Listen)
-        .unwrap_or(false);
-
-    if !is_listener {
-        return u32::MAX;
-    }
+    let pending = match take_listener(&listener) {
+        Some(p) => p,
+        None => return u32::MAX,
+    };
 
     // Clean up pending connections
-    for i in 0..table.len() {
-        let is_pending = table[i].as_ref().map(|tcb| {
-            tcb.parent_listener == Some(id as u8) && !tcb.accepted
-        }).unwrap_or(false);
-        if is_pending {
-            table[i] = None;
+    for cid in pending {
+        if let Some(child) = table::get(cid) {
+            table::discard(cid, &child);
         }
     }
 
-    table[id] = None;
-    crate::serial_println!("TCP: listener socket {} closed", id);
+    table::discard(socket_id, &listener);
+    crate::serial_println!("TCP: listener socket {} closed", socket_id);
     0
 }
 
+/// Stop `listener` accepting and return its not yet accepted children.
+/// `None` if it is not listening.
+pub(crate) fn take_listener(listener: &table::TcbRef) -> Option<Vec<u32>> {
+    let mut l = listener.lock();
+    if l.state != TcpState::Listen {
+        return None;
+    }
+    l.state = TcpState::Closed;
+    let mut pending = core::mem::take(&mut l.syn_queue);
+    pending.extend(l.accept_queue.drain(..));
+    Some(pending)
+}
+
 /// Close a TCP connection. Sends FIN, waits for ACK.
 pub fn close(socket_id: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS {
-        return u32::MAX;
-    }
+    let id = socket_id;
+    let tcb_ref = match table::get(id) {
+        Some(t) => t,
+        None => return u32::MAX,
+    };
 
     // Check if it's a listener
-    {
-        let conns = TCP_CONNECTIONS.lock();
-        if let Some(table) = conns.as_ref() {
-            if let Some(tcb) = &table[id] {
-                if tcb.state == TcpState::Listen {
-                    drop(conns);
-                    return close_listener(socket_id);
-                }
-            }
-        }
+    let is_listener = tcb_ref.lock().state == TcpState::Listen;
+    if is_listener {
+        return close_listener(socket_id);
     }
 
     // Get info and update state
     let send_info = {
-        let mut conns = TCP_CONNECTIONS.lock();
-        let table = match conns.as_mut() {
-            Some(t) => t,
-            None => return u32::MAX,
-        };
-        let tcb = match table[id].as_mut() {
-            Some(t) => t,
-            None => return u32::MAX,
-        };
-
-        match tcb.state {
+        let mut tcb = tcb_ref.lock();
+        let state = tcb.state;
+        match state {
             TcpState::Established => {
                 tcb.state = TcpState::FinWait1;
                 let info = (tcb.local_ip, tcb.local_port, tcb.remote_ip, tcb.remote_port,
@@ -311,12 +289,9 @@ pub fn close(socket_id: u32) -> u32 {
                 tcb.snd_nxt = tcb.snd_nxt.wrapping_add(1);
                 Some(info)
             }
-            TcpState::Closed => {
-                table[id] = None;
-                return 0;
-            }
             _ => {
-                table[id] = None;
+                drop(tcb);
+                table::discard(id, &tcb_ref);
                 return 0;
             }
         }
@@ -333,26 +308,22 @@ pub fn close(socket_id: u32) -> u32 {
         crate::net::poll();
 
         {
-            let mut conns = TCP_CONNECTIONS.lock();
-            let table = match conns.as_mut() {
-                Some(t) => t,
-                None => return 0,
-            };
-            if let Some(tcb) = &table[id] {
-                match tcb.state {
-                    TcpState::Closed | TcpState::TimeWait => {
-                        if tcb.state == TcpState::Closed {
-                            table[id] = None;
-                        }
-                        return 0;
-                    }
-                    _ => {}
-                }
-                if tcb.reset_received {
-                    table[id] = None;
+            let tcb = tcb_ref.lock();
+            if tcb.detached {
+                return 0;
+            }
+            match tcb.state {
+                TcpState::Closed => {
+                    drop(tcb);
+                    table::discard(id, &tcb_ref);
                     return 0;
                 }
-            } else {
+                TcpState::TimeWait => return 0,
+                _ => {}
+            }
+            if tcb.reset_received {
+                drop(tcb);
+                table::discard(id, &tcb_ref);
                 return 0;
             }
         }
@@ -360,19 +331,13 @@ pub fn close(socket_id: u32) -> u32 {
         let now = crate::arch::hal::timer_current_ticks();
         if now.wrapping_sub(start) >= timeout {
             // Force close with RST
-            let rst_info = {
-                let mut conns = TCP_CONNECTIONS.lock();
-                let table = conns.as_mut().unwrap();
-                let info = table[id].as_ref().map(|tcb| {
-                    (tcb.local_ip, tcb.local_port, tcb.remote_ip, tcb.remote_port,
-                     tcb.snd_nxt, tcb.rcv_nxt)
-                });
-                table[id] = None;
-                info
+            let (lip, lp, rip, rp, sn, rn) = {
+                let tcb = tcb_ref.lock();
+                (tcb.local_ip, tcb.local_port, tcb.remote_ip, tcb.remote_port,
+                 tcb.snd_nxt, tcb.rcv_nxt)
             };
-            if let Some((lip, lp, rip, rp, sn, rn)) = rst_info {
-                send_segment(lip, lp, rip, rp, sn, rn, RST, 0, &[]);
-            }
+            table::discard(id, &tcb_ref);
+            send_segment(lip, lp, rip, rp, sn, rn, RST, 0, &[]);
             return 0;
         }
 
@@ -383,39 +348,21 @@ pub fn close(socket_id: u32) -> u32 {
 
 /// Get connection state. Returns TcpState as u32, or u32::MAX if not found.
 pub fn status(socket_id: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS {
-        return u32::MAX;
-    }
-    let conns = TCP_CONNECTIONS.lock();
-    let table = match conns.as_ref() {
-        Some(t) => t,
-        None => return u32::MAX,
-    };
-    match &table[id] {
-        Some(tcb) => tcb.state as u32,
+    match table::get(socket_id) {
+        Some(tcb) => tcb.lock().state as u32,
         None => u32::MAX,
     }
 }
 
 /// Half-close (SHUT_WR): send FIN but don't block. Connection can still receive.
 pub fn shutdown_write(socket_id: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS {
-        return u32::MAX;
-    }
+    let tcb_ref = match table::get(socket_id) {
+        Some(t) => t,
+        None => return u32::MAX,
+    };
 
     let send_info = {
-        let mut conns = TCP_CONNECTIONS.lock();
-        let table = match conns.as_mut() {
-            Some(t) => t,
-            None => return u32::MAX,
-        };
-        let tcb = match table[id].as_mut() {
-            Some(t) => t,
-            None => return u32::MAX,
-        };
-
+        let mut tcb = tcb_ref.lock();
         match tcb.state {
             TcpState::Established => {
                 tcb.state = TcpState::FinWait1;
@@ -2,241 +2,199 @@
 //!
 //! Handles all incoming TCP segments: SYN (passive open), SYN-ACK
 //! (active open), data/ACK in ESTABLISHED, FIN handling, and RST.
-//! Implements fast retransmit on 3 duplicate ACKs.
+//! ACKs drive the congestion controller in `cc`: fast retransmit on 3
+//! duplicate ACKs, NewReno / SACK recovery, and RTT samples.
 
 use core::sync::atomic::Ordering;
 use super::tcb::*;
-use super::send::{send_segment, send_syn_segment};
-use super::recv::accept_data_deferred;
+use super::cc;
+use super::send::{send_segment, send_segment_opts, send_syn_segment, SynOpts};
+use super::recv::{accept_data_deferred, sack_option};
 use super::util::{is_seq_gt, is_seq_gte, is_seq_lte, send_rst};
-use super::{TCP_CONNECTIONS, TCP_SEGMENTS_RECV, TCP_RETRANSMITS};
-
-/// Handle an incoming TCP segment. Called from ipv4::handle_ipv4().
-pub fn handle_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) {
-    let seg = match parse_tcp(pkt) {
+use super::table::{self, ConnKey, TcbRef};
+use crate::net::pktbuf::PacketBuf;
+use crate::net::types::Ipv4Addr;
+use super::{TCP_SEGMENTS_RECV, TCP_RETRANSMITS};
+
+/// Handle an incoming TCP segment. Called from ipv4::handle_ipv4() with
+/// `buf`, the packet buffer `pkt` was parsed from.
+pub fn handle_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>, buf: &PacketBuf) {
+    let seg = match parse_tcp(pkt, buf) {
         Some(s) => s,
         None => return,
     };
     TCP_SEGMENTS_RECV.fetch_add(1, Ordering::Relaxed);
-
-    // Process segment under lock, collect deferred sends and wake TIDs.
-    let mut wake_tid: u32 = 0;
-    let mut wake_listener_tid: u32 = 0;
-    let deferred: Option<DeferredSend> = {
-        let mut conns = TCP_CONNECTIONS.lock();
-        let table = match conns.as_mut() {
-            Some(t) => t,
-            None => return,
-        };
-
-        // Find matching connection (exact match on 4-tuple)
-        let slot_idx = table.iter().position(|slot| {
-            if let Some(tcb) = slot {
-                tcb.local_port == seg.dst_port
-                    && tcb.remote_port == seg.src_port
-                    && tcb.remote_ip == seg.src_ip
-                    && tcb.state != TcpState::Listen
-            } else {
-                false
-            }
-        });
-
-        let idx = match slot_idx {
-            Some(i) => i,
-            None => {
-                // No exact match — check for a listening socket on this port
-                if seg.flags & SYN != 0 && seg.flags & ACK == 0 {
-                    let listener_idx = table.iter().position(|slot| {
-                        if let Some(tcb) = slot {
-                            tcb.state == TcpState::Listen && tcb.local_port == seg.dst_port
-                        } else {
-                            false
-                        }
-                    });
-
-                    if let Some(lid) = listener_idx {
-                        // Count pending connections for this listener
-                        let pending_count = table.iter().filter(|s| {
-                            s.as_ref().map(|t| {
-                                t.parent_listener == Some(lid as u8) && !t.accepted
-                            }).unwrap_or(false)
-                        }).count();
-
-                        if pending_count >= MAX_BACKLOG {
-                            return; // Backlog full — silently drop SYN
-                        }
-
-                        let cfg = crate::net::config();
-                        let mut new_slot = None;
-                        for (i, slot) in table.iter_mut().enumerate() {
-                            if slot.is_none() {
-                                let mut tcb = Tcb::new(cfg.ip, seg.dst_port, seg.src_ip, seg.src_port);
-                                tcb.state = TcpState::SynReceived;
-                                tcb.rcv_irs = seg.seq;
-                                tcb.rcv_nxt = seg.seq.wrapping_add(1);
-                                tcb.snd_nxt = tcb.snd_iss.wrapping_add(1);
-                                tcb.parent_listener = Some(lid as u8);
-                                tcb.last_send_tick = crate::arch::hal::timer_current_ticks();
-                                // Store peer's window scale if present (RFC 7323)
-                                if let Some(shift) = seg.wscale {
-                                    tcb.snd_wnd_shift = shift;
-                                    tcb.rcv_wnd_shift = OUR_WINDOW_SHIFT;
-                                }
-                                *slot = Some(tcb);
-                                new_slot = Some(i);
-                                break;
-                            }
-                        }
-
-                        if let Some(ns) = new_slot {
-                            let tcb = table[ns].as_ref().unwrap();
-                            let (lip, lp, rip, rp) = (tcb.local_ip, tcb.local_port,
-                                tcb.remote_ip, tcb.remote_port);
-                            let iss = tcb.snd_iss;
-                            let rcv_nxt = tcb.rcv_nxt;
-                            let use_wscale = tcb.rcv_wnd_shift > 0;
-                            crate::serial_println!("TCP: SYN on listener {} -> new conn slot {} from {}:{} (wscale={})",
-                                lid, ns, seg.src_ip, seg.src_port,
-                                if use_wscale { tcb.snd_wnd_shift } else { 0 });
-                            drop(conns);
-                            if use_wscale {
-                                send_syn_segment(lip, lp, rip, rp, iss, rcv_nxt, SYN | ACK);
-                            } else {
-                                send_segment(lip, lp, rip, rp, iss, rcv_nxt, SYN | ACK, 65535, &[]);
-                            }
-                            return;
-                        }
-                        return; // No free slots
-                    }
+    crate::task::tracepoints::emit(
+        crate::task::tracepoints::TCP_RECV,
+        (seg.dst_port as u64) << 48 | (seg.src_port as u64) << 32 | seg.seq as u64,
+        seg.payload.len() as u64 | (seg.flags as u64) << 32,
+    );
+
+    // Find matching connection (exact match on 4-tuple)
+    let key = ConnKey { local_port: seg.dst_port, remote_ip: seg.src_ip, remote_port: seg.src_port };
+    let (idx, tcb_ref) = match table::lookup(&key) {
+        Some(found) => found,
+        None => {
+            // No exact match — check for a listening socket on this port
+            if seg.flags & SYN != 0 && seg.flags & ACK == 0 {
+                let listeners = table::listeners(&key);
+                if !listeners.is_empty() {
+                    passive_open(&seg, &listeners);
+                    return;
                 }
-                // No matching connection and no listener — send RST
-                drop(conns);
-                send_rst(&seg);
-                return;
             }
-        };
+            // No matching connection and no listener — send RST
+            send_rst(&seg);
+            return;
+        }
+    };
+
+    // Process segment under the connection's lock, collect deferred sends and wake TIDs.
+    let mut wake_tid: u32 = 0;
+    let mut established_child = false;
+    let mut rtx = Retransmit::new();
+    let mut sack = [0u8; 40];
+    let mut sack_len = 0usize;
+    let (deferred, parent): (Option<DeferredSend>, Option<u32>) = {
+        let mut guard = tcb_ref.lock();
+        let tcb = &mut *guard;
 
         // RST handling — always process
         if seg.flags & RST != 0 {
             crate::serial_println!("TCP: RST received on socket {}", idx);
-            let tcb = table[idx].as_mut().unwrap();
             tcb.reset_received = true;
             tcb.state = TcpState::Closed;
             wake_tid = tcb.waiting_tid;
             tcb.waiting_tid = 0;
-            drop(conns);
+            drop(guard);
             if wake_tid != 0 {
                 crate::task::scheduler::try_wake_thread(wake_tid);
             }
+            crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Tcp(idx));
             return;
         }
 
-        // Read state before borrowing tcb mutably (needed for SynReceived
-        // which also needs to access the listener in the table).
-        let state = table[idx].as_ref().unwrap().state;
         let now = crate::arch::hal::timer_current_ticks();
 
-        // SynReceived needs access to both tcb AND the parent listener in table,
-        // so handle it separately to avoid double-mutable-borrow.
-        let match_result = if state == TcpState::SynReceived {
-            handle_syn_received(idx, &seg, table, &mut wake_listener_tid)
-        } else {
-            let tcb = table[idx].as_mut().unwrap();
-            match tcb.state {
-                TcpState::SynSent => {
-                    handle_syn_sent(tcb, &seg)
-                }
+        let match_result = match tcb.state {
+            TcpState::SynReceived => {
+                handle_syn_received(idx, tcb, &seg, &mut established_child)
+            }
 
-                TcpState::Established => {
-                    handle_established(tcb, &seg)
-                }
+            TcpState::SynSent => {
+                handle_syn_sent(tcb, &seg, now)
+            }
 
-                TcpState::FinWait1 => {
-                    if seg.flags & ACK != 0 {
-                        if is_seq_gte(seg.ack, tcb.snd_nxt) {
-                            tcb.snd_una = seg.ack;
-                            tcb.state = TcpState::FinWait2;
-                        }
-                    }
-                    let data_ack = accept_data_deferred(tcb, &seg);
-                    if seg.flags & FIN != 0 {
-                        tcb.rcv_nxt = tcb.rcv_nxt.wrapping_add(1);
-                        tcb.fin_received = true;
-                        tcb.state = TcpState::TimeWait;
-                        tcb.time_wait_start = now;
-                        Some(DeferredSend {
-                            local_ip: tcb.local_ip, local_port: tcb.local_port,
-                            remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
-                            seq: tcb.snd_nxt, ack_num: tcb.rcv_nxt, flags: ACK,
-                            window: tcb.advertised_window(),
-                        })
-                    } else {
-                        data_ack
-                    }
-                }
+            TcpState::Established => {
+                handle_established(tcb, &seg, now, &mut rtx)
+            }
 
-                TcpState::FinWait2 => {
-                    let data_ack = accept_data_deferred(tcb, &seg);
-                    if seg.flags & FIN != 0 {
-                        tcb.rcv_nxt = tcb.rcv_nxt.wrapping_add(1);
-                        tcb.fin_received = true;
-                        tcb.state = TcpState::TimeWait;
-                        tcb.time_wait_start = now;
-                        Some(DeferredSend {
-                            local_ip: tcb.local_ip, local_port: tcb.local_port,
-                            remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
-                            seq: tcb.snd_nxt, ack_num: tcb.rcv_nxt, flags: ACK,
-                            window: tcb.advertised_window(),
-                        })
-                    } else {
-                        data_ack
+            TcpState::FinWait1 => {
+                if seg.flags & ACK != 0 {
+                    if is_seq_gte(seg.ack, tcb.snd_nxt) {
+                        tcb.snd_una = seg.ack;
+                        tcb.state = TcpState::FinWait2;
                     }
                 }
+                let data_ack = accept_data_deferred(tcb, &seg);
+                if seg.flags & FIN != 0 {
+                    tcb.rcv_nxt = tcb.rcv_nxt.wrapping_add(1);
+                    tcb.fin_received = true;
+                    tcb.state = TcpState::TimeWait;
+                    tcb.time_wait_start = now;
+                    Some(DeferredSend {
+                        local_ip: tcb.local_ip, local_port: tcb.local_port,
+                        remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
+                        seq: tcb.snd_nxt, ack_num: tcb.rcv_nxt, flags: ACK,
+                        window: tcb.advertised_window(),
+                    })
+                } else {
+                    data_ack
+                }
+            }
 
-                TcpState::CloseWait => {
-                    if seg.flags & ACK != 0 {
-                        tcb.snd_una = seg.ack;
-                    }
-                    None
+            TcpState::FinWait2 => {
+                let data_ack = accept_data_deferred(tcb, &seg);
+                if seg.flags & FIN != 0 {
+                    tcb.rcv_nxt = tcb.rcv_nxt.wrapping_add(1);
+                    tcb.fin_received = true;
+                    tcb.state = TcpState::TimeWait;
+                    tcb.time_wait_start = now;
+                    Some(DeferredSend {
+                        local_ip: tcb.local_ip, local_port: tcb.local_port,
+                        remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
+                        seq: tcb.snd_nxt, ack_num: tcb.rcv_nxt, flags: ACK,
+                        window: tcb.advertised_window(),
+                    })
+                } else {
+                    data_ack
                 }
+            }
 
-                TcpState::LastAck => {
-                    if seg.flags & ACK != 0 {
-                        if is_seq_gte(seg.ack, tcb.snd_nxt) {
-                            tcb.state = TcpState::Closed;
-                        }
-                    }
-                    None
+            TcpState::CloseWait => {
+                if seg.flags & ACK != 0 {
+                    tcb.snd_una = seg.ack;
                 }
+                None
+            }
 
-                TcpState::TimeWait => {
-                    if seg.flags & FIN != 0 {
-                        tcb.time_wait_start = now;
-                        Some(DeferredSend {
-                            local_ip: tcb.local_ip, local_port: tcb.local_port,
-                            remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
-                            seq: tcb.snd_nxt, ack_num: tcb.rcv_nxt, flags: ACK,
-                            window: tcb.advertised_window(),
-                        })
-                    } else {
-                        None
+            TcpState::LastAck => {
+                if seg.flags & ACK != 0 {
+                    if is_seq_gte(seg.ack, tcb.snd_nxt) {
+                        tcb.state = TcpState::Closed;
                     }
                 }
+                None
+            }
 
-                TcpState::SynReceived | TcpState::Listen | TcpState::Closed => None,
+            TcpState::TimeWait => {
+                if seg.flags & FIN != 0 {
+                    tcb.time_wait_start = now;
+                    Some(DeferredSend {
+                        local_ip: tcb.local_ip, local_port: tcb.local_port,
+                        remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
+                        seq: tcb.snd_nxt, ack_num: tcb.rcv_nxt, flags: ACK,
+                        window: tcb.advertised_window(),
+                    })
+                } else {
+                    None
+                }
             }
+
+            TcpState::Listen | TcpState::Closed => None,
         };
 
+        // Report out-of-order data we hold on every ACK (RFC 2018)
+        if let Some(ds) = &match_result {
+            if ds.flags == ACK && tcb.sack_ok && !tcb.ooo_buf.is_empty() {
+                sack_len = sack_option(tcb, &mut sack);
+            }
+        }
+
         // Collect waiting_tid — wake after lock drop
-        let tcb = table[idx].as_mut().unwrap();
         if tcb.waiting_tid != 0 {
             wake_tid = tcb.waiting_tid;
             tcb.waiting_tid = 0;
         }
 
-        match_result
+        (match_result, tcb.parent_listener)
     }; // lock dropped here
 
+    // A finished handshake makes the child acceptable: queue it on the
+    // listener (child lock already released) and wake accept().
+    let mut wake_listener_tid: u32 = 0;
+    if let (true, Some(lid)) = (established_child, parent) {
+        if let Some(listener) = table::get(lid) {
+            let mut l = listener.lock();
+            if let Some(pos) = l.syn_queue.iter().position(|&c| c == idx) {
+                l.syn_queue.swap_remove(pos);
+                l.accept_queue.push_back(idx);
+            }
+            wake_listener_tid = l.waiting_tid;
+            l.waiting_tid = 0;
+        }
+    }
+
     // Wake blocked threads outside lock
     if wake_tid != 0 {
         crate::task::scheduler::try_wake_thread(wake_tid);
@@ -244,18 +202,93 @@ pub fn handle_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) {
     if wake_listener_tid != 0 {
         crate::task::scheduler::try_wake_thread(wake_listener_tid);
     }
+    crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Tcp(idx));
+    if let (true, Some(lid)) = (established_child, parent) {
+        crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Tcp(lid));
+    }
 
-    // Send deferred segment outside lock
-    if let Some(ds) = deferred {
+    // Send deferred segments outside lock
+    if rtx.len > 0 {
+        let ds = &rtx.hdr;
         send_segment(ds.local_ip, ds.local_port, ds.remote_ip, ds.remote_port,
-                    ds.seq, ds.ack_num, ds.flags, ds.window, &[]);
+                     ds.seq, ds.ack_num, ds.flags, ds.window, &rtx.data[..rtx.len]);
+    }
+    if let Some(ds) = deferred {
+        send_segment_opts(ds.local_ip, ds.local_port, ds.remote_ip, ds.remote_port,
+                          ds.seq, ds.ack_num, ds.flags, ds.window, &sack[..sack_len], &[]);
     }
 }
 
+/// SYN on a listening port: create a SynReceived child, queue it on one of
+/// the port's `listeners` and answer with SYN-ACK.  Drops the SYN if every
+/// backlog or the connection table is full.
+fn passive_open(seg: &TcpSegment, listeners: &[(u32, TcbRef)]) {
+    // Hand the SYN to the least loaded listener of the port's group, the
+    // hashed-to member winning ties.
+    let mut best: Option<(usize, &(u32, TcbRef))> = None;
+    for entry in listeners {
+        let l = entry.1.lock();
+        if l.state != TcpState::Listen {
+            continue;
+        }
+        let pending = l.syn_queue.len() + l.accept_queue.len();
+        if pending < l.backlog && best.map_or(true, |(p, _)| pending < p) {
+            best = Some((pending, entry));
+        }
+    }
+    let (lid, listener) = match best {
+        Some((_, (lid, listener))) => (*lid, listener),
+        None => return, // Every backlog full — silently drop SYN
+    };
+
+    let cfg = crate::net::config();
+    let mut tcb = Tcb::new(cfg.ip, seg.dst_port, seg.src_ip, seg.src_port);
+    tcb.state = TcpState::SynReceived;
+    tcb.rcv_irs = seg.seq;
+    tcb.rcv_nxt = seg.seq.wrapping_add(1);
+    tcb.snd_nxt = tcb.snd_iss.wrapping_add(1);
+    tcb.parent_listener = Some(lid);
+    tcb.last_send_tick = crate::arch::hal::timer_current_ticks();
+    // Store peer's window scale if present (RFC 7323)
+    if let Some(shift) = seg.wscale {
+        tcb.snd_wnd_shift = shift;
+        tcb.rcv_wnd_shift = OUR_WINDOW_SHIFT;
+    }
+    tcb.sack_ok = seg.sack_permitted;
+    let (lip, lp, rip, rp) = (tcb.local_ip, tcb.local_port, tcb.remote_ip, tcb.remote_port);
+    let iss = tcb.snd_iss;
+    let rcv_nxt = tcb.rcv_nxt;
+    let opts = SynOpts { wscale: tcb.rcv_wnd_shift > 0, sack: tcb.sack_ok };
+    let wscale = if opts.wscale { tcb.snd_wnd_shift } else { 0 };
+
+    // Fails when the table is full or a duplicate SYN raced us to the 4-tuple.
+    let (cid, child) = match table::insert(tcb) {
+        Some(c) => c,
+        None => return,
+    };
+    let queued = {
+        let mut l = listener.lock();
+        if l.state == TcpState::Listen {
+            l.syn_queue.push(cid);
+            true
+        } else {
+            false
+        }
+    };
+    if !queued {
+        table::discard(cid, &child); // listener closed meanwhile
+        return;
+    }
+
+    crate::serial_println!("TCP: SYN on listener {} -> new conn slot {} from {}:{} (wscale={} sack={})",
+        lid, cid, seg.src_ip, seg.src_port, wscale, opts.sack);
+    send_syn_segment(lip, lp, rip, rp, iss, rcv_nxt, SYN | ACK, opts);
+}
+
 // ── State-specific handlers ─────────────────────────────────────────
 
 /// Handle segment in SYN_SENT state (active open, waiting for SYN-ACK).
-fn handle_syn_sent(tcb: &mut Tcb, seg: &TcpSegment) -> Option<DeferredSend> {
+fn handle_syn_sent(tcb: &mut Tcb, seg: &TcpSegment, now: u32) -> Option<DeferredSend> {
     if seg.flags & SYN != 0 && seg.flags & ACK != 0 {
         if seg.ack == tcb.snd_nxt {
             tcb.rcv_irs = seg.seq;
@@ -267,6 +300,11 @@ fn handle_syn_sent(tcb: &mut Tcb, seg: &TcpSegment) -> Option<DeferredSend> {
                 tcb.snd_wnd_shift = shift;
                 tcb.rcv_wnd_shift = OUR_WINDOW_SHIFT;
             }
+            tcb.sack_ok = seg.sack_permitted;
+            // The SYN round trip is the first RTT sample (unless it was resent)
+            if tcb.retransmit_count == 0 {
+                cc::rtt_sample(tcb, now.wrapping_sub(tcb.last_send_tick));
+            }
             tcb.state = TcpState::Established;
             tcb.send_buf.clear();
             tcb.retransmit_count = 0;
@@ -293,29 +331,64 @@ fn handle_syn_sent(tcb: &mut Tcb, seg: &TcpSegment) -> Option<DeferredSend> {
     }
 }
 
-/// Handle data/ACK/FIN in ESTABLISHED state with fast retransmit.
-fn handle_established(tcb: &mut Tcb, seg: &TcpSegment) -> Option<DeferredSend> {
+/// A data segment to resend once the connection lock is dropped.
+struct Retransmit {
+    hdr: DeferredSend,
+    len: usize,
+    data: [u8; MSS],
+}
+
+impl Retransmit {
+    fn new() -> Self {
+        Retransmit {
+            hdr: DeferredSend {
+                local_ip: Ipv4Addr::ZERO, local_port: 0,
+                remote_ip: Ipv4Addr::ZERO, remote_port: 0,
+                seq: 0, ack_num: 0, flags: 0, window: 0,
+            },
+            len: 0,
+            data: [0u8; MSS],
+        }
+    }
+}
+
+/// Handle data/ACK/FIN in ESTABLISHED state, feeding ACKs to the
+/// congestion controller.  A segment chosen for fast retransmit or
+/// recovery is copied into `rtx`.
+fn handle_established(
+    tcb: &mut Tcb,
+    seg: &TcpSegment,
+    now: u32,
+    rtx: &mut Retransmit,
+) -> Option<DeferredSend> {
     // ── Process ACK ──
     if seg.flags & ACK != 0 {
+        if tcb.sack_ok && seg.sack_count > 0 {
+            cc::sack_update(tcb, &seg.sack[..seg.sack_count]);
+        }
         if is_seq_gt(seg.ack, tcb.snd_una) && is_seq_lte(seg.ack, tcb.snd_nxt) {
             // New ACK — advances snd_una
-            let acked = seg.ack.wrapping_sub(tcb.snd_una) as usize;
+            let acked = seg.ack.wrapping_sub(tcb.snd_una);
             tcb.snd_una = seg.ack;
             tcb.snd_wnd = (seg.window as u32) << tcb.snd_wnd_shift;
 
             // Drain acknowledged bytes from send buffer
-            let drain = acked.min(tcb.send_buf.len());
+            let drain = (acked as usize).min(tcb.send_buf.len());
             if drain > 0 {
                 tcb.send_buf.drain(..drain);
             }
 
-            // Reset fast retransmit state
-            tcb.dup_ack_count = 0;
+            let resend = cc::on_new_ack(tcb, acked, now);
 
             if tcb.snd_una == tcb.snd_nxt {
                 // All data acknowledged
                 tcb.send_buf.clear();
-                tcb.retransmit_count = 0;
+            } else {
+                // Restart the retransmission timer (RFC 6298 §5.3)
+                tcb.last_send_tick = now;
+                if resend {
+                    fast_retransmit(tcb, tcb.snd_una, rtx);
+                }
             }
         } else if seg.ack == tcb.snd_una && !seg.payload.is_empty() {
             // Data segment with same ACK — not a dup ACK, just piggybacked
@@ -325,11 +398,8 @@ fn handle_established(tcb: &mut Tcb, seg: &TcpSegment) -> Option<DeferredSend> {
             && tcb.snd_una != tcb.snd_nxt
         {
             // ── Duplicate ACK (RFC 5681) ──
-            tcb.dup_ack_count += 1;
-
-            if tcb.dup_ack_count == 3 {
-                // Fast retransmit: resend from snd_una
-                fast_retransmit(tcb);
+            if let Some(seq) = cc::on_dup_ack(tcb) {
+                fast_retransmit(tcb, seq, rtx);
             }
         }
     }
@@ -353,76 +423,56 @@ fn handle_established(tcb: &mut Tcb, seg: &TcpSegment) -> Option<DeferredSend> {
     }
 }
 
-/// Fast retransmit: resend one MSS from the send buffer at snd_una.
-///
-/// Called when 3 duplicate ACKs are received, indicating a lost segment.
-/// Sends outside the critical section would require collecting deferred data,
-/// but since we're already inside handle_tcp's lock scope, we record the
-/// retransmit and let the timer path handle the actual send.
-fn fast_retransmit(tcb: &mut Tcb) {
-    if tcb.send_buf.is_empty() {
+/// Fast retransmit: copy up to one MSS of the send buffer at `seq` into
+/// `rtx`, which `handle_tcp` sends after releasing the connection lock.
+fn fast_retransmit(tcb: &mut Tcb, seq: u32, rtx: &mut Retransmit) {
+    let len = cc::retransmit_len(tcb, seq);
+    if len == 0 {
         return;
     }
-
-    TCP_RETRANSMITS.fetch_add(1, Ordering::Relaxed);
-    tcb.retransmit_count = 0; // Reset — fast retransmit is not a timeout
-    tcb.last_send_tick = crate::arch::hal::timer_current_ticks();
-
-    // Extract first MSS of send_buf for retransmission
-    let len = tcb.send_buf.len().min(MSS);
-    let mut data = [0u8; 1460];
-    let (front, back) = tcb.send_buf.as_slices();
-    let front_n = front.len().min(len);
-    data[..front_n].copy_from_slice(&front[..front_n]);
-    if front_n < len {
-        data[front_n..len].copy_from_slice(&back[..len - front_n]);
+    let offset = seq.wrapping_sub(tcb.snd_una) as usize;
+    for (dst, &b) in rtx.data[..len].iter_mut().zip(tcb.send_buf.range(offset..offset + len)) {
+        *dst = b;
     }
 
-    let win = tcb.advertised_window();
-
-    // We cannot call send_segment here (would need to drop the lock first).
-    // Instead, we use the deferred retransmit path: set a flag so the
-    // next check_retransmissions() call sends immediately.
-    // Actually — handle_tcp's caller sends the deferred segment, but that's
-    // only for ACKs. For fast retransmit data, we need to send now.
-    // Since the lock is held by our caller, and send_segment doesn't need
-    // TCP_CONNECTIONS, we can call it directly here.
-    send_segment(tcb.local_ip, tcb.local_port, tcb.remote_ip, tcb.remote_port,
-                 tcb.snd_una, tcb.rcv_nxt, PSH | ACK, win, &data[..len]);
+    TCP_RETRANSMITS.fetch_add(1, Ordering::Relaxed);
+    tcb.rtt_timing = false; // Karn: never time a retransmitted segment
+    rtx.len = len;
+    rtx.hdr = DeferredSend {
+        local_ip: tcb.local_ip, local_port: tcb.local_port,
+        remote_ip: tcb.remote_ip, remote_port: tcb.remote_port,
+        seq, ack_num: tcb.rcv_nxt, flags: PSH | ACK,
+        window: tcb.advertised_window(),
+    };
 
-    crate::serial_println!("TCP: fast retransmit seq={} len={}", tcb.snd_una, len);
+    crate::serial_println!("TCP: fast retransmit seq={} len={} cwnd={}", seq, len, tcb.cwnd);
 }
 
 /// Handle SynReceived state (server-side 3-way handshake completion).
 ///
-/// Takes `idx` and indexes into `table` directly to avoid the double-mutable-borrow
-/// problem (needs to update both the connection TCB and the parent listener).
+/// Sets `established` when the handshake completes; the caller then moves
+/// the child to its listener's accept queue once this lock is released.
 fn handle_syn_received(
-    idx: usize,
+    idx: u32,
+    tcb: &mut Tcb,
     seg: &TcpSegment,
-    table: &mut [Option<Tcb>],
-    wake_listener_tid: &mut u32,
+    established: &mut bool,
 ) -> Option<DeferredSend> {
-    let tcb = table[idx].as_mut().unwrap();
-
     if seg.flags & ACK != 0 {
         if seg.ack == tcb.snd_nxt {
             tcb.snd_una = seg.ack;
             // ACK completing handshake: window IS scaled (RFC 7323)
             tcb.snd_wnd = (seg.window as u32) << tcb.snd_wnd_shift;
+            if tcb.retransmit_count == 0 {
+                let now = crate::arch::hal::timer_current_ticks();
+                cc::rtt_sample(tcb, now.wrapping_sub(tcb.last_send_tick));
+            }
             tcb.state = TcpState::Established;
             tcb.send_buf.clear();
             tcb.retransmit_count = 0;
             tcb.dup_ack_count = 0;
-            let parent = tcb.parent_listener;
             crate::serial_println!("TCP: SynReceived -> Established on socket {}", idx);
-            // Wake the accept() thread on the parent listener
-            if let Some(lid) = parent {
-                if let Some(listener) = table[lid as usize].as_mut() {
-                    *wake_listener_tid = listener.waiting_tid;
-                    listener.waiting_tid = 0;
-                }
-            }
+            *established = true;
             None
         } else {
             crate::serial_println!("TCP: SynReceived bad ACK {} expected {}", seg.ack, tcb.snd_nxt);
@@ -1,14 +1,17 @@
 //! TCP (Transmission Control Protocol) — connection-oriented, reliable transport.
 //!
 //! Supports both active open (connect) and passive open (listen/accept).
-//! Sliding-window send with batched locking. 64-slot connection table with
-//! retransmission (exponential backoff), delayed ACKs, out-of-order reassembly,
-//! fast retransmit, dynamic window advertisement, and TIME_WAIT cleanup.
+//! Sliding-window send with batched locking and NewReno congestion control. Hash-indexed connection table
+//! (up to 4096 sockets, one lock per connection) with retransmission
+//! (RFC 6298 RTO with exponential backoff), delayed ACKs, out-of-order
+//! reassembly with SACK, fast retransmit / recovery, dynamic window advertisement, and TIME_WAIT cleanup.
 //!
 //! ## Module structure
 //!
 //! - `tcb` — Transmission Control Block, types, constants, parsing
+//! - `table` — Socket ids, 4-tuple hash index, listener index, per-TCB locks
 //! - `send` — Segment construction and data sending
+//! - `cc` — RTT estimation, congestion window, SACK scoreboard
 //! - `recv` — Receive path with OOO reassembly
 //! - `input` — Incoming segment dispatch and state machine
 //! - `connect` — Connection lifecycle (connect/listen/accept/close)
@@ -16,27 +19,32 @@
 //! - `util` — Sequence helpers, RST, port allocation, cleanup, netstat
 
 pub(crate) mod tcb;
+pub(crate) mod table;
 pub(crate) mod send;
+pub(crate) mod cc;
 pub(crate) mod recv;
 pub(crate) mod input;
 pub(crate) mod connect;
 pub(crate) mod timer;
 pub(crate) mod util;
 
-use alloc::vec::Vec;
-use crate::sync::spinlock::Spinlock;
-use tcb::{Tcb, MAX_CONNECTIONS};
+use crate::sync::ticket_lock::TicketLock;
+use tcb::MAX_CONNECTIONS;
+use table::TcpTable;
 use core::sync::atomic::{AtomicU64, Ordering};
 
 // ── Re-exports (public API — must match old tcp.rs signatures) ──────
 
 pub use tcb::TcpState;
+pub use send::SendSource;
 #[allow(unused_imports)]
 pub use util::{cleanup_for_thread, list_connections, TcpConnInfo};
 
 // ── Global TCP connection table ─────────────────────────────────────
 
-pub(crate) static TCP_CONNECTIONS: Spinlock<Option<Vec<Option<Tcb>>>> = Spinlock::new(None);
+/// Socket id → TCB map and lookup indexes.  Held only for lookups and
+/// insert/remove; connection state is behind each TCB's own lock.
+pub(crate) static TCP_CONNECTIONS: TicketLock<Option<TcpTable>> = TicketLock::new(None);
 
 // ── Global TCP statistics ───────────────────────────────────────────
 
@@ -52,13 +60,8 @@ pub(crate) static TCP_CONN_ERRORS: AtomicU64 = AtomicU64::new(0);
 
 /// Initialize the TCP connection table. Must be called before `connect()`.
 pub fn init() {
-    let mut conns = TCP_CONNECTIONS.lock();
-    let mut table = Vec::with_capacity(MAX_CONNECTIONS);
-    for _ in 0..MAX_CONNECTIONS {
-        table.push(None);
-    }
-    *conns = Some(table);
-    crate::serial_println!("[OK] TCP initialized ({} slots, OOO buffering, fast retransmit)", MAX_CONNECTIONS);
+    *TCP_CONNECTIONS.lock() = Some(TcpTable::new());
+    crate::serial_println!("[OK] TCP initialized (up to {} sockets, OOO buffering, fast retransmit)", MAX_CONNECTIONS);
 }
 
 // ── Statistics ───────────────────────────────────────────────────────
@@ -77,13 +80,9 @@ pub struct TcpStats {
 
 /// Get a snapshot of TCP protocol statistics.
 pub fn get_stats() -> TcpStats {
-    let conns = TCP_CONNECTIONS.lock();
-    let established = match conns.as_ref() {
-        Some(table) => table.iter()
-            .filter(|s| s.as_ref().map(|t| t.state == TcpState::Established).unwrap_or(false))
-            .count() as u32,
-        None => 0,
-    };
+    let established = table::entries().iter()
+        .filter(|(_, tcb)| tcb.lock().state == TcpState::Established)
+        .count() as u32;
     TcpStats {
         active_opens: TCP_ACTIVE_OPENS.load(Ordering::Relaxed),
         passive_opens: TCP_PASSIVE_OPENS.load(Ordering::Relaxed),
@@ -105,9 +104,10 @@ pub fn connect(remote_ip: crate::net::types::Ipv4Addr, remote_port: u16, timeout
     connect::connect(remote_ip, remote_port, timeout_ticks)
 }
 
-/// Passive open: listen on a local port.
-pub fn listen(port: u16, backlog: u16) -> u32 {
-    connect::listen(port, backlog)
+/// Passive open: listen on a local port; `reuse_port` lets other
+/// `reuse_port` listeners share it.
+pub fn listen(port: u16, backlog: u16, reuse_port: bool) -> u32 {
+    connect::listen(port, backlog, reuse_port)
 }
 
 /// Accept a connection from a listening socket.
@@ -115,11 +115,21 @@ pub fn accept(listener_id: u32, timeout_ticks: u32) -> (u32, crate::net::types::
     connect::accept(listener_id, timeout_ticks)
 }
 
+/// Whether a listening socket has a connection ready to accept.
+pub fn accept_ready(socket_id: u32) -> Option<bool> {
+    connect::accept_ready(socket_id)
+}
+
 /// Send data on an established connection.
 pub fn send(socket_id: u32, data: &[u8], timeout_ticks: u32) -> u32 {
     send::send(socket_id, data, timeout_ticks)
 }
 
+/// Send `total` bytes pulled from `source` in batches (see [`SendSource`]).
+pub fn send_stream<S: SendSource>(socket_id: u32, total: usize, source: &mut S, timeout_ticks: u32) -> u32 {
+    send::send_stream(socket_id, total, source, timeout_ticks)
+}
+
 /// Receive data from an established connection.
 pub fn recv(socket_id: u32, buf: &mut [u8], timeout_ticks: u32) -> u32 {
     recv::recv(socket_id, buf, timeout_ticks)
@@ -150,9 +160,9 @@ pub fn shutdown_write(socket_id: u32) -> u32 {
     connect::shutdown_write(socket_id)
 }
 
-/// Handle an incoming TCP segment.
-pub fn handle_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) {
-    input::handle_tcp(pkt)
+/// Handle an incoming TCP segment (`buf` holds the IPv4 packet bytes).
+pub fn handle_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>, buf: &crate::net::pktbuf::PacketBuf) {
+    input::handle_tcp(pkt, buf)
 }
 
 /// Check retransmissions, flush delayed ACKs, TIME_WAIT cleanup.
@@ -6,7 +6,8 @@
 use super::tcb::*;
 use super::send::send_segment;
 use super::util::is_seq_gt;
-use super::TCP_CONNECTIONS;
+use super::table;
+use crate::net::pktbuf::{self, PacketBuf};
 
 // ── Out-of-order reassembly ─────────────────────────────────────────
 
@@ -75,7 +76,7 @@ pub(crate) fn accept_data_deferred(tcb: &mut Tcb, seg: &TcpSegment) -> Option<De
 }
 
 /// Insert a segment into the OOO buffer, merging overlaps.
-fn insert_ooo(tcb: &mut Tcb, seq: u32, data: &[u8]) {
+fn insert_ooo(tcb: &mut Tcb, seq: u32, data: &PacketBuf) {
     if data.is_empty() {
         return;
     }
@@ -99,6 +100,13 @@ fn insert_ooo(tcb: &mut Tcb, seq: u32, data: &[u8]) {
         // Drop oldest (lowest seq) to make room — remote will retransmit if needed
         return;
     }
+    // Queued segments pin their packet buffers; stop queueing before the
+    // pool runs too low to refill the NIC's RX ring.
+    if pktbuf::available() < pktbuf::LOW_WATER {
+        return;
+    }
+
+    tcb.last_ooo_seq = seq;
 
     // Find insertion point to keep sorted by seq
     let pos = tcb.ooo_buf.iter().position(|s| is_seq_gt(s.seq, seq))
@@ -106,10 +114,57 @@ fn insert_ooo(tcb: &mut Tcb, seq: u32, data: &[u8]) {
 
     tcb.ooo_buf.insert(pos, OooSegment {
         seq,
-        data: data.to_vec(),
+        data: data.clone(),
     });
 }
 
+/// Build a SACK option (RFC 2018) describing the out-of-order data held
+/// in `ooo_buf` into `out`; returns its length (0 if there is none).
+///
+/// The block holding the most recently queued segment comes first, the
+/// rest follow in sequence order, up to [`MAX_SACK_BLOCKS`].
+pub(crate) fn sack_option(tcb: &Tcb, out: &mut [u8; 40]) -> usize {
+    // Merge queued segments into contiguous ranges
+    let mut ranges = [(0u32, 0u32); MAX_SACK_BLOCKS + 1];
+    let mut n = 0usize;
+    let mut first = usize::MAX;
+    for s in tcb.ooo_buf.iter() {
+        let (left, right) = (s.seq, s.seq.wrapping_add(s.data.len() as u32));
+        if n > 0 && !is_seq_gt(left, ranges[n - 1].1) {
+            if is_seq_gt(right, ranges[n - 1].1) {
+                ranges[n - 1].1 = right;
+            }
+        } else if n < ranges.len() {
+            ranges[n] = (left, right);
+            n += 1;
+        } else {
+            break;
+        }
+        let (l, r) = ranges[n - 1];
+        if !is_seq_gt(l, tcb.last_ooo_seq) && is_seq_gt(r, tcb.last_ooo_seq) {
+            first = n - 1;
+        }
+    }
+    if n == 0 {
+        return 0;
+    }
+    if first < n {
+        ranges[..=first].rotate_right(1);
+    }
+    let blocks = n.min(MAX_SACK_BLOCKS);
+
+    // NOP, NOP, Kind=5, Len, then (left, right) edge pairs
+    out[0] = 1;
+    out[1] = 1;
+    out[2] = 5;
+    out[3] = (2 + 8 * blocks) as u8;
+    for (i, &(l, r)) in ranges[..blocks].iter().enumerate() {
+        out[4 + i * 8..8 + i * 8].copy_from_slice(&l.to_be_bytes());
+        out[8 + i * 8..12 + i * 8].copy_from_slice(&r.to_be_bytes());
+    }
+    4 + 8 * blocks
+}
+
 /// Drain contiguous segments from the OOO buffer into recv_buf.
 fn drain_ooo(tcb: &mut Tcb) {
     loop {
@@ -151,10 +206,13 @@ fn drain_ooo(tcb: &mut Tcb) {
 /// Blocks the calling thread until data arrives, the connection closes,
 /// or the timeout expires. Zero CPU usage while waiting.
 pub fn recv(socket_id: u32, buf: &mut [u8], timeout_ticks: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS || buf.is_empty() {
+    if buf.is_empty() {
         return u32::MAX;
     }
+    let tcb_ref = match table::get(socket_id) {
+        Some(t) => t,
+        None => return u32::MAX,
+    };
 
     let tid = crate::task::scheduler::current_tid();
     let start = crate::arch::hal::timer_current_ticks();
@@ -164,15 +222,11 @@ pub fn recv(socket_id: u32, buf: &mut [u8], timeout_ticks: u32) -> u32 {
 
     loop {
         {
-            let mut conns = TCP_CONNECTIONS.lock();
-            let table = match conns.as_mut() {
-                Some(t) => t,
-                None => return u32::MAX,
-            };
-            let tcb = match table[id].as_mut() {
-                Some(t) => t,
-                None => return u32::MAX,
-            };
+            let mut guard = tcb_ref.lock();
+            if guard.detached {
+                return u32::MAX;
+            }
+            let tcb = &mut *guard;
 
             if tcb.reset_received {
                 tcb.waiting_tid = 0;
@@ -212,7 +266,7 @@ pub fn recv(socket_id: u32, buf: &mut [u8], timeout_ticks: u32) -> u32 {
                 };
 
                 // Drop lock before sending
-                drop(conns);
+                drop(guard);
 
                 // Send window update outside the lock
                 if let Some(ref wu) = window_update {
@@ -269,31 +323,22 @@ pub fn recv(socket_id: u32, buf: &mut [u8], timeout_ticks: u32) -> u32 {
 /// Check bytes available to read on a TCP connection.
 /// Returns: >0 = bytes in recv_buf, 0 = no data yet, u32::MAX-1 = EOF/FIN, u32::MAX = error.
 pub fn recv_available(socket_id: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS {
-        return u32::MAX;
-    }
-    let conns = TCP_CONNECTIONS.lock();
-    let table = match conns.as_ref() {
+    let tcb_ref = match table::get(socket_id) {
         Some(t) => t,
         None => return u32::MAX,
     };
-    match &table[id] {
-        Some(tcb) => {
-            if tcb.reset_received {
-                return u32::MAX;
-            }
-            if !tcb.recv_buf.is_empty() {
-                return tcb.recv_buf.len() as u32;
-            }
-            if tcb.fin_received {
-                return u32::MAX - 1;
-            }
-            match tcb.state {
-                TcpState::CloseWait | TcpState::Closed => u32::MAX - 1,
-                _ => 0,
-            }
-        }
-        None => u32::MAX,
+    let tcb = tcb_ref.lock();
+    if tcb.reset_received {
+        return u32::MAX;
+    }
+    if !tcb.recv_buf.is_empty() {
+        return tcb.recv_buf.len() as u32;
+    }
+    if tcb.fin_received {
+        return u32::MAX - 1;
+    }
+    match tcb.state {
+        TcpState::CloseWait | TcpState::Closed => u32::MAX - 1,
+        _ => 0,
     }
 }
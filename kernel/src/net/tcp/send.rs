@@ -2,11 +2,17 @@
 //!
 //! Provides low-level segment building (`send_segment`, `send_syn_segment`)
 //! with dynamic receive window advertisement, and the high-level `send()`
-//! function with sliding window, batched locking, and send buffer tracking.
+//! function with sliding window (bounded by the congestion window), batched
+//! locking, and send buffer tracking.  [`send_stream`] runs the same loop
+//! over a [`SendSource`] that is refilled between batches, so a file can be
+//! streamed without its whole length in memory (`SYS_SENDFILE`).
 
 use core::sync::atomic::Ordering;
 use super::tcb::*;
-use super::{TCP_CONNECTIONS, TCP_SEGMENTS_SENT, TCP_RESETS_SENT};
+use super::cc;
+use super::table;
+use super::{TCP_SEGMENTS_SENT, TCP_RESETS_SENT};
+use crate::net::checksum;
 use crate::net::types::Ipv4Addr;
 
 // ── Low-level segment construction ──────────────────────────────────
@@ -26,9 +32,33 @@ pub(crate) fn send_segment(
     window: u16,
     payload: &[u8],
 ) -> bool {
-    let tcp_len = TCP_HEADER_LEN + payload.len();
+    send_segment_opts(local_ip, local_port, remote_ip, remote_port,
+                      seq, ack_num, flags, window, &[], payload)
+}
+
+/// [`send_segment`] with TCP options (`options.len()` a multiple of 4,
+/// at most 40 bytes), e.g. SACK blocks on an ACK.
+pub(crate) fn send_segment_opts(
+    local_ip: Ipv4Addr,
+    local_port: u16,
+    remote_ip: Ipv4Addr,
+    remote_port: u16,
+    seq: u32,
+    ack_num: u32,
+    flags: u8,
+    window: u16,
+    options: &[u8],
+    payload: &[u8],
+) -> bool {
+    crate::task::tracepoints::emit(
+        crate::task::tracepoints::TCP_SEND,
+        (local_port as u64) << 48 | (remote_port as u64) << 32 | seq as u64,
+        payload.len() as u64 | (flags as u64) << 32,
+    );
+    let hdr_len = TCP_HEADER_LEN + options.len();
+    let tcp_len = hdr_len + payload.len();
     let mut segment = [0u8; 1536]; // stack buffer, fits MTU
-    if tcp_len > segment.len() { return false; }
+    if tcp_len > segment.len() || options.len() > 40 || options.len() % 4 != 0 { return false; }
 
     // Source port
     segment[0] = (local_port >> 8) as u8;
@@ -46,8 +76,8 @@ pub(crate) fn send_segment(
     segment[9] = (ack_num >> 16) as u8;
     segment[10] = (ack_num >> 8) as u8;
     segment[11] = ack_num as u8;
-    // Data offset (5 = 20 bytes / 4) + reserved
-    segment[12] = 0x50;
+    // Data offset (header length / 4) + reserved
+    segment[12] = ((hdr_len / 4) as u8) << 4;
     // Flags
     segment[13] = flags;
     // Window (dynamic — reflects actual recv buffer space)
@@ -56,15 +86,26 @@ pub(crate) fn send_segment(
     // Checksum placeholder (already 0)
     // Urgent pointer (already 0)
 
-    // Payload
+    // Options, then payload
+    segment[TCP_HEADER_LEN..hdr_len].copy_from_slice(options);
     if !payload.is_empty() {
-        segment[TCP_HEADER_LEN..tcp_len].copy_from_slice(payload);
+        segment[hdr_len..tcp_len].copy_from_slice(payload);
     }
 
     tcp_checksum_and_send(local_ip, remote_ip, &mut segment[..tcp_len], flags)
 }
 
-/// Build and send a SYN or SYN-ACK segment with TCP options (MSS + Window Scale).
+/// Options offered on a SYN or SYN-ACK besides MSS.
+#[derive(Clone, Copy)]
+pub(crate) struct SynOpts {
+    /// Window Scale (on a SYN-ACK only if the peer sent it).
+    pub wscale: bool,
+    /// SACK Permitted (on a SYN-ACK only if the peer sent it).
+    pub sack: bool,
+}
+
+/// Build and send a SYN or SYN-ACK segment with TCP options (MSS, and
+/// Window Scale / SACK Permitted as selected by `opts`).
 ///
 /// SYN segments advertise the unscaled window per RFC 7323.
 pub(crate) fn send_syn_segment(
@@ -75,62 +116,41 @@ pub(crate) fn send_syn_segment(
     seq: u32,
     ack_num: u32,
     flags: u8,
+    opts: SynOpts,
 ) -> bool {
-    // Options: MSS (4 bytes) + NOP (1) + Window Scale (3 bytes) = 8 bytes
-    // Total header: 20 + 8 = 28 bytes, data_offset = 7
-    const OPT_LEN: usize = 8;
-    let tcp_len = TCP_HEADER_LEN + OPT_LEN;
-    let mut segment = [0u8; 28];
-
-    // Source port
-    segment[0] = (local_port >> 8) as u8;
-    segment[1] = (local_port & 0xFF) as u8;
-    // Dest port
-    segment[2] = (remote_port >> 8) as u8;
-    segment[3] = (remote_port & 0xFF) as u8;
-    // Sequence number
-    segment[4] = (seq >> 24) as u8;
-    segment[5] = (seq >> 16) as u8;
-    segment[6] = (seq >> 8) as u8;
-    segment[7] = seq as u8;
-    // Ack number
-    segment[8] = (ack_num >> 24) as u8;
-    segment[9] = (ack_num >> 16) as u8;
-    segment[10] = (ack_num >> 8) as u8;
-    segment[11] = ack_num as u8;
-    // Data offset: 7 (28 bytes / 4) + reserved
-    segment[12] = 0x70;
-    // Flags
-    segment[13] = flags;
-    // Window (SYN window is NOT scaled per RFC 7323)
-    let window: u16 = 65535;
-    segment[14] = (window >> 8) as u8;
-    segment[15] = (window & 0xFF) as u8;
-    // Checksum placeholder (bytes 16-17, already 0)
-    // Urgent pointer (bytes 18-19, already 0)
-
-    // TCP Options (8 bytes):
+    // Options: MSS (4 bytes) [+ NOP + Window Scale (4)] [+ 2 NOP + SACK Permitted (4)]
+    let mut options = [0u8; 12];
     // MSS option: Kind=2, Len=4, MSS=1460
-    segment[20] = 2;
-    segment[21] = 4;
-    segment[22] = (MSS >> 8) as u8;
-    segment[23] = (MSS & 0xFF) as u8;
-    // NOP padding
-    segment[24] = 1;
-    // Window Scale option: Kind=3, Len=3, Shift=OUR_WINDOW_SHIFT
-    segment[25] = 3;
-    segment[26] = 3;
-    segment[27] = OUR_WINDOW_SHIFT;
+    options[0] = 2;
+    options[1] = 4;
+    options[2] = (MSS >> 8) as u8;
+    options[3] = (MSS & 0xFF) as u8;
+    let mut len = 4;
+    if opts.wscale {
+        // NOP padding + Window Scale option: Kind=3, Len=3, Shift=OUR_WINDOW_SHIFT
+        options[len..len + 4].copy_from_slice(&[1, 3, 3, OUR_WINDOW_SHIFT]);
+        len += 4;
+    }
+    if opts.sack {
+        // NOP, NOP, SACK Permitted: Kind=4, Len=2
+        options[len..len + 4].copy_from_slice(&[1, 1, 4, 2]);
+        len += 4;
+    }
 
-    tcp_checksum_and_send(local_ip, remote_ip, &mut segment[..tcp_len], flags)
+    // Window (SYN window is NOT scaled per RFC 7323)
+    send_segment_opts(local_ip, local_port, remote_ip, remote_port,
+                      seq, ack_num, flags, 65535, &options[..len], &[])
 }
 
 /// Compute TCP checksum and send via IPv4.
+///
+/// With NIC checksum offload only the pseudo-header sum is placed in the
+/// checksum field and the hardware sums the segment.
 fn tcp_checksum_and_send(local_ip: Ipv4Addr, remote_ip: Ipv4Addr, segment: &mut [u8], flags: u8) -> bool {
     let tcp_len = segment.len();
 
     // Compute checksum with pseudo-header
-    let pseudo_sum = crate::net::checksum::pseudo_header_checksum(
+    let pseudo_sum = checksum::pseudo_header_checksum(
         local_ip.as_bytes(),
         remote_ip.as_bytes(),
         crate::net::ipv4::PROTO_TCP,
@@ -141,73 +161,108 @@ fn tcp_checksum_and_send(local_ip: Ipv4Addr, remote_ip: Ipv4Addr, segment: &mut
     segment[16] = 0;
     segment[17] = 0;
 
-    let mut sum = pseudo_sum;
-    let mut i = 0;
-    while i + 1 < tcp_len {
-        sum += ((segment[i] as u32) << 8) | (segment[i + 1] as u32);
-        i += 2;
-    }
-    if i < tcp_len {
-        sum += (segment[i] as u32) << 8;
-    }
-    while sum >> 16 != 0 {
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
-    let cksum = !(sum as u16);
-    segment[16] = (cksum >> 8) as u8;
-    segment[17] = (cksum & 0xFF) as u8;
+    let offload = checksum::tx_offload();
+    let field = if offload {
+        checksum::partial_sum(&[], pseudo_sum) as u16
+    } else {
+        checksum::finish(checksum::partial_sum(segment, pseudo_sum))
+    };
+    segment[16] = (field >> 8) as u8;
+    segment[17] = (field & 0xFF) as u8;
 
     TCP_SEGMENTS_SENT.fetch_add(1, Ordering::Relaxed);
     if flags & RST != 0 {
         TCP_RESETS_SENT.fetch_add(1, Ordering::Relaxed);
     }
-    crate::net::ipv4::send_ipv4(remote_ip, crate::net::ipv4::PROTO_TCP, segment)
+    if offload {
+        crate::net::ipv4::send_ipv4_offload(remote_ip, crate::net::ipv4::PROTO_TCP, segment, 16)
+    } else {
+        crate::net::ipv4::send_ipv4(remote_ip, crate::net::ipv4::PROTO_TCP, segment)
+    }
 }
 
 // ── High-level send ─────────────────────────────────────────────────
 
+/// Bytes of a stream handed to [`send_stream`].
+pub trait SendSource {
+    /// Make the stream bytes from `offset` on available to [`bytes`],
+    /// up to `offset + max`.  Called without any lock held, so it may
+    /// block.  Returns the end of the available range (`offset` on error).
+    ///
+    /// [`bytes`]: SendSource::bytes
+    fn prepare(&mut self, offset: usize, max: usize) -> usize;
+    /// Stream bytes `[start, end)`, within the range last prepared.
+    fn bytes(&self, start: usize, end: usize) -> &[u8];
+}
+
+/// A stream that is entirely in memory.
+struct SliceSource<'a>(&'a [u8]);
+
+impl SendSource for SliceSource<'_> {
+    fn prepare(&mut self, _offset: usize, _max: usize) -> usize {
+        self.0.len()
+    }
+    fn bytes(&self, start: usize, end: usize) -> &[u8] {
+        &self.0[start..end]
+    }
+}
+
 /// Send data on an established connection. Returns bytes sent or u32::MAX on error.
 ///
 /// Uses sliding window with batched locking. Data is appended to the
 /// connection's send buffer for retransmission support.
 pub fn send(socket_id: u32, data: &[u8], timeout_ticks: u32) -> u32 {
-    let id = socket_id as usize;
-    if id >= MAX_CONNECTIONS || data.is_empty() {
-        return if data.is_empty() { 0 } else { u32::MAX };
+    send_stream(socket_id, data.len(), &mut SliceSource(data), timeout_ticks)
+}
+
+/// Send `total` bytes taken from `source`, refilling it before each batch
+/// of up to [`SEND_BATCH_SIZE`] segments.  Returns once every byte is
+/// acknowledged: bytes sent, or u32::MAX on error.  Times out after
+/// `timeout_ticks` without an ACK advancing.
+pub fn send_stream<S: SendSource>(socket_id: u32, total: usize, source: &mut S, timeout_ticks: u32) -> u32 {
+    if total == 0 {
+        return 0;
     }
+    let tcb_ref = match table::get(socket_id) {
+        Some(t) => t,
+        None => return u32::MAX,
+    };
 
     // Record the base sequence number at the start of our data.
     let send_base_seq = {
-        let conns = TCP_CONNECTIONS.lock();
-        let table = match conns.as_ref() {
-            Some(t) => t,
-            None => return u32::MAX,
-        };
-        match &table[id] {
-            Some(tcb) if tcb.state == TcpState::Established => tcb.snd_nxt,
-            _ => return u32::MAX,
+        let tcb = tcb_ref.lock();
+        if tcb.state != TcpState::Established {
+            return u32::MAX;
         }
+        tcb.snd_nxt
     };
 
-    let start = crate::arch::hal::timer_current_ticks();
+    let mut start = crate::arch::hal::timer_current_ticks();
     let mut send_offset = 0usize;
+    let mut last_ack_offset = 0usize;
 
     // Stack-allocated batch buffer — avoids heap alloc per segment.
     let mut batch: [core::mem::MaybeUninit<BatchSegment>; SEND_BATCH_SIZE] =
         unsafe { core::mem::MaybeUninit::uninit().assume_init() };
 
     loop {
+        // Stage the next batch's bytes before locking
+        let available = if send_offset < total {
+            source.prepare(send_offset, SEND_BATCH_SIZE * MSS).min(total)
+        } else {
+            total
+        };
+        if available <= send_offset && send_offset < total {
+            return if send_offset > 0 { send_offset as u32 } else { u32::MAX };
+        }
+
         // ── Single lock acquisition: compute ack_offset, prepare batch ──
         let (ack_offset, batch_count) = {
-            let mut conns = TCP_CONNECTIONS.lock();
-            let table = match conns.as_mut() {
-                Some(t) => t,
-                None => return u32::MAX,
-            };
-            let tcb = match table[id].as_mut() {
-                Some(t) => t,
-                None => return u32::MAX,
-            };
+            let mut guard = tcb_ref.lock();
+            if guard.detached {
+                return u32::MAX;
+            }
+            let tcb = &mut *guard;
 
             if tcb.reset_received || tcb.state == TcpState::Closed {
                 return if send_offset > 0 { send_offset as u32 } else { u32::MAX };
@@ -216,35 +271,29 @@ pub fn send(socket_id: u32, data: &[u8], timeout_ticks: u32) -> u32 {
                 return if send_offset > 0 { send_offset as u32 } else { u32::MAX };
             }
 
-            // Drain acknowledged bytes from send buffer
+            // Bytes of the stream acknowledged so far (input trims send_buf)
             let acked_bytes = tcb.snd_una.wrapping_sub(send_base_seq) as usize;
-            let ack_offset = acked_bytes.min(data.len());
-
-            // Trim send_buf: remove data that has been ACKed
-            let buf_acked = acked_bytes.min(tcb.send_buf.len());
-            if buf_acked > 0 {
-                tcb.send_buf.drain(..buf_acked);
-            }
+            let ack_offset = acked_bytes.min(total);
 
             // All data acknowledged?
-            if ack_offset >= data.len() {
-                return data.len() as u32;
+            if ack_offset >= total {
+                return total as u32;
             }
 
-            let snd_wnd = (tcb.snd_wnd as usize).max(MSS);
-            let window = snd_wnd.min(MAX_IN_FLIGHT);
+            // Peer window limited by the congestion window
+            let window = cc::send_window(tcb);
             let now = crate::arch::hal::timer_current_ticks();
             let win_val = tcb.advertised_window();
 
             // Prepare up to SEND_BATCH_SIZE segments under this single lock.
             let mut count = 0usize;
-            while send_offset < data.len() && count < SEND_BATCH_SIZE {
-                let in_flight = send_offset - ack_offset;
+            while send_offset < available && count < SEND_BATCH_SIZE {
+                let in_flight = cc::flight_size(tcb) as usize;
                 if in_flight >= window {
                     break; // window full
                 }
                 let remaining_window = window - in_flight;
-                let chunk_end = (send_offset + MSS).min(data.len()).min(send_offset + remaining_window);
+                let chunk_end = (send_offset + MSS).min(available).min(send_offset + remaining_window);
 
                 let seg = BatchSegment {
                     local_ip: tcb.local_ip,
@@ -259,16 +308,20 @@ pub fn send(socket_id: u32, data: &[u8], timeout_ticks: u32) -> u32 {
                 };
 
                 // Append to send buffer for retransmission
-                let chunk = &data[send_offset..chunk_end];
+                let chunk = source.bytes(send_offset, chunk_end);
                 let chunk_len = chunk.len();
                 if tcb.send_buf.len() + chunk_len <= MAX_SEND_BUF {
                     tcb.send_buf.extend(chunk.iter());
                 }
 
-                // Update TCB for this segment
-                tcb.snd_nxt = tcb.snd_nxt.wrapping_add(chunk_len as u32);
-                tcb.last_send_tick = now;
-                tcb.retransmit_count = 0;
+                // Update TCB for this segment; the retransmission timer
+                // runs from the oldest unacknowledged segment
+                if tcb.snd_una == tcb.snd_nxt {
+                    tcb.last_send_tick = now;
+                }
+                let end = tcb.snd_nxt.wrapping_add(chunk_len as u32);
+                tcb.snd_nxt = end;
+                cc::start_rtt(tcb, end, now);
 
                 batch[count].write(seg);
                 count += 1;
@@ -283,19 +336,23 @@ pub fn send(socket_id: u32, data: &[u8], timeout_ticks: u32) -> u32 {
             let seg = unsafe { batch[i].assume_init_ref() };
             send_segment(seg.local_ip, seg.local_port, seg.remote_ip, seg.remote_port,
                          seg.seq, seg.ack_num, PSH | ACK, seg.window,
-                         &data[seg.data_start..seg.data_end]);
+                         source.bytes(seg.data_start, seg.data_end));
         }
 
         // All data acknowledged?
-        if ack_offset >= data.len() {
-            return data.len() as u32;
+        if ack_offset >= total {
+            return total as u32;
         }
 
         // Poll network for incoming ACKs (fast path).
         crate::net::poll_rx();
 
-        // Check timeout.
+        // Check timeout (restarted by every ACK that makes progress).
         let now = crate::arch::hal::timer_current_ticks();
+        if ack_offset > last_ack_offset {
+            last_ack_offset = ack_offset;
+            start = now;
+        }
         if now.wrapping_sub(start) >= timeout_ticks {
             crate::serial_println!("TCP: send timeout on socket {}", socket_id);
             return if ack_offset > 0 { ack_offset as u32 } else { u32::MAX };
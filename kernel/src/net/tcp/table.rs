@@ -0,0 +1,273 @@
+//! TCP connection table — socket ids, 4-tuple hash index, listener index.
+//!
+//! Every TCB sits behind its own spinlock ([`TcbRef`]).  `TCP_CONNECTIONS`
+//! only guards the id → TCB mapping and the two indexes, and is held just
+//! long enough to look up, insert or remove a reference.  Segment input,
+//! `send`, `recv` and the timers therefore serialize per connection instead
+//! of on one global lock.
+//!
+//! Lock rule: never hold two of these locks at once.  Take the table lock
+//! with no TCB locked (these helpers), and lock at most one TCB at a time;
+//! cross-connection work (listener ↔ child) drops one lock before taking
+//! the next.
+//!
+//! Socket ids index a growable slot vector of up to [`MAX_CONNECTIONS`]
+//! entries.  Freed ids are reused oldest-first, so a stale id held by user
+//! space is unlikely to name a new connection soon after a close.
+//!
+//! A port normally has one listener.  Listeners opened with `reuse_port`
+//! form a group on their port instead; each incoming SYN is offered to the
+//! group starting at a member chosen by the 4-tuple hash (see
+//! [`listeners`]), so forked server workers share the load.
+
+use alloc::collections::{BTreeMap, VecDeque};
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use crate::net::types::Ipv4Addr;
+use crate::sync::spinlock::Spinlock;
+use super::tcb::{Tcb, TcpState, MAX_CONNECTIONS};
+use super::TCP_CONNECTIONS;
+
+/// Shared, individually locked connection state.
+pub(crate) type TcbRef = Arc<Spinlock<Tcb>>;
+
+/// Initial hash bucket count (power of two); doubles as connections grow.
+const INITIAL_BUCKETS: usize = 64;
+
+/// Demultiplexing key of a connection (the local address is the single
+/// configured interface address).
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub(crate) struct ConnKey {
+    pub local_port: u16,
+    pub remote_ip: Ipv4Addr,
+    pub remote_port: u16,
+}
+
+impl ConnKey {
+    pub fn of(tcb: &Tcb) -> Self {
+        ConnKey { local_port: tcb.local_port, remote_ip: tcb.remote_ip, remote_port: tcb.remote_port }
+    }
+
+    fn hash(&self) -> usize {
+        let ports = ((self.remote_port as u32) << 16) | self.local_port as u32;
+        let h = (u32::from_be_bytes(self.remote_ip.0) ^ ports.rotate_left(11))
+            .wrapping_mul(0x9E37_79B1);
+        (h ^ (h >> 16)) as usize
+    }
+}
+
+/// How a slot is reachable besides its id.
+#[derive(Clone, Copy)]
+enum Index {
+    Conn(ConnKey),
+    Listen(u16),
+}
+
+struct Slot {
+    tcb: TcbRef,
+    index: Index,
+}
+
+/// The listening sockets bound to one port.
+struct ListenGroup {
+    /// All members were opened with `reuse_port`; more may join.
+    shared: bool,
+    ids: Vec<u32>,
+}
+
+/// Slot vector plus the 4-tuple and listener indexes.
+pub(crate) struct TcpTable {
+    slots: Vec<Option<Slot>>,
+    free: VecDeque<u32>,
+    buckets: Vec<Vec<(ConnKey, u32)>>,
+    conns: usize,
+    listeners: BTreeMap<u16, ListenGroup>,
+}
+
+impl TcpTable {
+    pub fn new() -> Self {
+        let mut buckets = Vec::with_capacity(INITIAL_BUCKETS);
+        buckets.resize_with(INITIAL_BUCKETS, Vec::new);
+        TcpTable {
+            slots: Vec::new(),
+            free: VecDeque::new(),
+            buckets,
+            conns: 0,
+            listeners: BTreeMap::new(),
+        }
+    }
+
+    fn get(&self, id: u32) -> Option<TcbRef> {
+        self.slots.get(id as usize)?.as_ref().map(|s| s.tcb.clone())
+    }
+
+    fn lookup(&self, key: &ConnKey) -> Option<(u32, TcbRef)> {
+        let bucket = &self.buckets[key.hash() & (self.buckets.len() - 1)];
+        let &(_, id) = bucket.iter().find(|(k, _)| k == key)?;
+        Some((id, self.get(id)?))
+    }
+
+    /// The listeners on `key.local_port`, rotated to start at the member
+    /// `key` hashes to.
+    fn listeners(&self, key: &ConnKey) -> Vec<(u32, TcbRef)> {
+        let ids = match self.listeners.get(&key.local_port) {
+            Some(g) => &g.ids,
+            None => return Vec::new(),
+        };
+        let start = key.hash() % ids.len();
+        ids[start..].iter().chain(&ids[..start])
+            .filter_map(|&id| Some((id, self.get(id)?)))
+            .collect()
+    }
+
+    /// Insert `tcb`, indexed by port if it is listening, by 4-tuple
+    /// otherwise.  Fails if the table is full or the 4-tuple is taken, or
+    /// the port is taken and not shared by `reuse_port` listeners.
+    fn insert(&mut self, tcb: Tcb) -> Option<(u32, TcbRef)> {
+        let shared = tcb.reuse_port;
+        let index = if tcb.state == TcpState::Listen {
+            if let Some(g) = self.listeners.get(&tcb.local_port) {
+                if !(g.shared && shared) {
+                    return None;
+                }
+            }
+            Index::Listen(tcb.local_port)
+        } else {
+            let key = ConnKey::of(&tcb);
+            if self.lookup(&key).is_some() {
+                return None;
+            }
+            Index::Conn(key)
+        };
+        let id = match self.free.pop_front() {
+            Some(id) => id,
+            None if self.slots.len() < MAX_CONNECTIONS => {
+                self.slots.push(None);
+                (self.slots.len() - 1) as u32
+            }
+            None => return None,
+        };
+        let tcb: TcbRef = Arc::new(Spinlock::new(tcb));
+        match index {
+            Index::Listen(port) => {
+                self.listeners.entry(port)
+                    .or_insert_with(|| ListenGroup { shared, ids: Vec::new() })
+                    .ids.push(id);
+            }
+            Index::Conn(key) => {
+                if self.conns >= self.buckets.len() * 2 {
+                    self.grow();
+                }
+                let mask = self.buckets.len() - 1;
+                self.buckets[key.hash() & mask].push((key, id));
+                self.conns += 1;
+            }
+        }
+        self.slots[id as usize] = Some(Slot { tcb: tcb.clone(), index });
+        Some((id, tcb))
+    }
+
+    /// Remove slot `id` if it still holds `tcb`.
+    fn remove(&mut self, id: u32, tcb: &TcbRef) -> bool {
+        let slot = match self.slots.get_mut(id as usize) {
+            Some(s) if s.as_ref().map_or(false, |s| Arc::ptr_eq(&s.tcb, tcb)) => s.take().unwrap(),
+            _ => return false,
+        };
+        match slot.index {
+            Index::Listen(port) => {
+                if let Some(g) = self.listeners.get_mut(&port) {
+                    g.ids.retain(|&i| i != id);
+                    if g.ids.is_empty() {
+                        self.listeners.remove(&port);
+                    }
+                }
+            }
+            Index::Conn(key) => {
+                let mask = self.buckets.len() - 1;
+                let bucket = &mut self.buckets[key.hash() & mask];
+                if let Some(pos) = bucket.iter().position(|&(_, i)| i == id) {
+                    bucket.swap_remove(pos);
+                }
+                self.conns -= 1;
+            }
+        }
+        self.free.push_back(id);
+        true
+    }
+
+    fn grow(&mut self) {
+        let n = self.buckets.len() * 2;
+        let mut buckets: Vec<Vec<(ConnKey, u32)>> = Vec::with_capacity(n);
+        buckets.resize_with(n, Vec::new);
+        for (key, id) in self.buckets.drain(..).flatten() {
+            buckets[key.hash() & (n - 1)].push((key, id));
+        }
+        self.buckets = buckets;
+    }
+
+    fn entries(&self) -> Vec<(u32, TcbRef)> {
+        self.slots.iter().enumerate()
+            .filter_map(|(i, s)| s.as_ref().map(|s| (i as u32, s.tcb.clone())))
+            .collect()
+    }
+}
+
+// ── Table operations (take and release TCP_CONNECTIONS) ─────────────
+
+/// The connection with socket id `id`.
+pub(crate) fn get(id: u32) -> Option<TcbRef> {
+    TCP_CONNECTIONS.lock().as_ref()?.get(id)
+}
+
+/// The connection matching an incoming segment's 4-tuple.
+pub(crate) fn lookup(key: &ConnKey) -> Option<(u32, TcbRef)> {
+    TCP_CONNECTIONS.lock().as_ref()?.lookup(key)
+}
+
+/// The sockets listening on the local port of `key`, in the order an
+/// incoming SYN for `key` should try them (empty if there are none).
+pub(crate) fn listeners(key: &ConnKey) -> Vec<(u32, TcbRef)> {
+    match TCP_CONNECTIONS.lock().as_ref() {
+        Some(t) => t.listeners(key),
+        None => Vec::new(),
+    }
+}
+
+/// Add a connection or listener; returns its socket id.
+pub(crate) fn insert(tcb: Tcb) -> Option<(u32, TcbRef)> {
+    TCP_CONNECTIONS.lock().as_mut()?.insert(tcb)
+}
+
+/// Snapshot of every socket, for the timers, cleanup and netstat.
+pub(crate) fn entries() -> Vec<(u32, TcbRef)> {
+    match TCP_CONNECTIONS.lock().as_ref() {
+        Some(t) => t.entries(),
+        None => Vec::new(),
+    }
+}
+
+/// Remove socket `id` (if it is still `tcb`), mark it detached for threads
+/// still holding a reference, and drop it from its listener's queues.
+///
+/// The caller must not hold `tcb`'s lock.
+pub(crate) fn discard(id: u32, tcb: &TcbRef) {
+    let removed = match TCP_CONNECTIONS.lock().as_mut() {
+        Some(t) => t.remove(id, tcb),
+        None => false,
+    };
+    if !removed {
+        return;
+    }
+    let parent = {
+        let mut t = tcb.lock();
+        t.detached = true;
+        if t.accepted { None } else { t.parent_listener }
+    };
+    if let Some(lid) = parent {
+        if let Some(listener) = get(lid) {
+            let mut l = listener.lock();
+            l.syn_queue.retain(|&c| c != id);
+            l.accept_queue.retain(|&c| c != id);
+        }
+    }
+}
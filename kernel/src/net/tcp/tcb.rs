@@ -5,6 +5,7 @@
 
 use alloc::collections::VecDeque;
 use alloc::vec::Vec;
+use crate::net::pktbuf::PacketBuf;
 use crate::net::types::Ipv4Addr;
 
 // ── TCP header flags ─────────────────────────────────────────────────
@@ -16,20 +17,35 @@ pub(crate) const ACK: u8 = 0x10;
 
 // ── Protocol constants ──────────────────────────────────────────────
 pub(crate) const TCP_HEADER_LEN: usize = 20;
-pub(crate) const MAX_CONNECTIONS: usize = 64;
-/// Receive buffer size per connection (256 KB).
+/// Upper bound on open sockets (connections + listeners).
+pub(crate) const MAX_CONNECTIONS: usize = 4096;
+/// Receive buffer limit per connection (256 KB); the buffer grows on demand.
 pub(crate) const RECV_BUF_SIZE: usize = 262144;
 /// Maximum segment size (standard Ethernet MTU minus IP+TCP headers).
 pub(crate) const MSS: usize = 1460;
-/// Base retransmission timeout in ticks (3 seconds at 100 Hz).
-pub(crate) const RETRANSMIT_TICKS: u32 = 300;
+/// Retransmission timeout before the first RTT sample, in ticks (1 s at
+/// 1000 Hz, RFC 6298 §2.1).
+pub(crate) const RTO_INITIAL: u32 = 1000;
+/// Lower bound of the computed RTO (200 ms; RFC 6298 suggests 1 s, which
+/// is far too slow on a LAN).
+pub(crate) const RTO_MIN: u32 = 200;
+/// Upper bound of the RTO including backoff (60 s).
+pub(crate) const RTO_MAX: u32 = 60_000;
+/// Initial congestion window in segments (RFC 6928).
+pub(crate) const INITIAL_CWND_SEGMENTS: u32 = 10;
+/// SACK blocks carried per ACK (4 fit without the timestamp option).
+pub(crate) const MAX_SACK_BLOCKS: usize = 4;
+/// Ranges kept on the sender's SACK scoreboard.
+pub(crate) const MAX_SACK_RANGES: usize = 16;
 /// Maximum retransmission attempts before giving up.
 pub(crate) const MAX_RETRANSMITS: u32 = 5;
 /// TIME_WAIT duration in ticks (2 seconds at 100 Hz).
 pub(crate) const TIME_WAIT_TICKS: u32 = 200;
-/// Maximum pending connections per listener.
-pub(crate) const MAX_BACKLOG: usize = 16;
-/// Maximum bytes in flight (sliding window send limit, 1 MB).
+/// Pending connections per listener when `listen` is given a backlog of 0.
+pub(crate) const DEFAULT_BACKLOG: usize = 16;
+/// Upper bound on a listener's backlog (SYN queue + accept queue).
+pub(crate) const MAX_BACKLOG: usize = 1024;
+/// Maximum bytes in flight (upper bound on min(cwnd, peer window), 1 MB).
 pub(crate) const MAX_IN_FLIGHT: usize = 1_048_576;
 /// Our TCP Window Scale shift count (RFC 7323).
 /// WINDOW_SIZE << 4 = ~1 MB effective receive window.
@@ -64,10 +80,11 @@ pub enum TcpState {
 
 // ── Out-of-order segment ────────────────────────────────────────────
 
-/// A buffered out-of-order TCP segment awaiting reassembly.
+/// A buffered out-of-order TCP segment awaiting reassembly; `data` is a
+/// view of the received packet buffer.
 pub(crate) struct OooSegment {
     pub seq: u32,
-    pub data: Vec<u8>,
+    pub data: PacketBuf,
 }
 
 // ── Parsed TCP segment ──────────────────────────────────────────────
@@ -80,12 +97,18 @@ pub(crate) struct TcpSegment {
     pub ack: u32,
     pub flags: u8,
     pub window: u16,
-    pub payload: Vec<u8>,
+    /// View of the payload bytes in the received packet buffer.
+    pub payload: PacketBuf,
     pub src_ip: Ipv4Addr,
     /// TCP Window Scale option (Kind=3), present only in SYN segments.
     pub wscale: Option<u8>,
     /// MSS option (Kind=2), present only in SYN segments.
     pub peer_mss: Option<u16>,
+    /// SACK-permitted option (Kind=4), present only in SYN segments.
+    pub sack_permitted: bool,
+    /// SACK blocks (Kind=5) as `[left, right)` sequence ranges.
+    pub sack: [(u32, u32); MAX_SACK_BLOCKS],
+    pub sack_count: usize,
 }
 
 // ── Deferred send info ──────────────────────────────────────────────
@@ -152,9 +175,30 @@ pub(crate) struct Tcb {
     pub retransmit_count: u32,
     pub last_send_tick: u32,
 
+    // ── RTT estimation (RFC 6298, ticks) ──
+    pub srtt: u32,          // smoothed RTT << 3 (0 = no sample yet)
+    pub rttvar: u32,        // RTT variation << 2
+    pub rto: u32,           // retransmission timeout before backoff
+    pub rtt_timing: bool,   // a segment is being timed
+    pub rtt_seq: u32,       // ACK of this sequence ends the sample
+    pub rtt_start: u32,     // tick the timed segment was sent
+
+    // ── Congestion control (NewReno) ──
+    pub cwnd: u32,          // congestion window in bytes
+    pub ssthresh: u32,      // slow start threshold in bytes
+    pub in_recovery: bool,  // in fast recovery
+    pub recover: u32,       // snd_nxt when recovery / the last timeout began
+    pub recover_valid: bool,
+    pub high_rxt: u32,      // next byte SACK recovery may retransmit from
+
     // ── Fast retransmit ──
     pub dup_ack_count: u32,
 
+    // ── SACK (RFC 2018) ──
+    pub sack_ok: bool,               // negotiated on the handshake
+    pub sacked: Vec<(u32, u32)>,     // peer-reported ranges above snd_una
+    pub last_ooo_seq: u32,           // latest out-of-order arrival (first block)
+
     // ── State flags ──
     pub fin_received: bool,
     pub reset_received: bool,
@@ -168,8 +212,19 @@ pub(crate) struct Tcb {
     pub time_wait_start: u32,
 
     // ── Server socket support ──
-    pub parent_listener: Option<u8>,
+    pub parent_listener: Option<u32>,
     pub accepted: bool,
+    /// Listener only: children still in the handshake.
+    pub syn_queue: Vec<u32>,
+    /// Listener only: established children waiting for `accept`.
+    pub accept_queue: VecDeque<u32>,
+    /// Listener only: limit on `syn_queue` + `accept_queue`.
+    pub backlog: usize,
+    /// Listener only: the port may be shared with other `reuse_port` listeners.
+    pub reuse_port: bool,
+
+    /// Removed from the connection table; the socket id is no longer valid.
+    pub detached: bool,
 
     // ── Ownership tracking ──
     pub owner_tid: u32,
@@ -196,12 +251,27 @@ impl Tcb {
             rcv_nxt: 0,
             snd_wnd_shift: 0,
             rcv_wnd_shift: 0,
-            recv_buf: VecDeque::with_capacity(RECV_BUF_SIZE),
+            recv_buf: VecDeque::new(),
             ooo_buf: Vec::new(),
             send_buf: VecDeque::new(),
             retransmit_count: 0,
             last_send_tick: 0,
+            srtt: 0,
+            rttvar: 0,
+            rto: RTO_INITIAL,
+            rtt_timing: false,
+            rtt_seq: 0,
+            rtt_start: 0,
+            cwnd: INITIAL_CWND_SEGMENTS * MSS as u32,
+            ssthresh: MAX_IN_FLIGHT as u32,
+            in_recovery: false,
+            recover: iss,
+            recover_valid: false,
+            high_rxt: iss,
             dup_ack_count: 0,
+            sack_ok: false,
+            sacked: Vec::new(),
+            last_ooo_seq: 0,
             fin_received: false,
             reset_received: false,
             pending_ack: false,
@@ -210,6 +280,11 @@ impl Tcb {
             time_wait_start: 0,
             parent_listener: None,
             accepted: false,
+            syn_queue: Vec::new(),
+            accept_queue: VecDeque::new(),
+            backlog: DEFAULT_BACKLOG,
+            reuse_port: false,
+            detached: false,
             owner_tid: 0,
             waiting_tid: 0,
         }
@@ -225,12 +300,21 @@ impl Tcb {
 
 // ── Parsing ─────────────────────────────────────────────────────────
 
-/// Parse a TCP segment from an IPv4 packet payload.
-pub(crate) fn parse_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) -> Option<TcpSegment> {
+/// Parse a TCP segment from an IPv4 packet payload; `buf` is the packet
+/// buffer `pkt` was parsed from.
+pub(crate) fn parse_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>, buf: &PacketBuf) -> Option<TcpSegment> {
     let data = pkt.payload;
     if data.len() < TCP_HEADER_LEN {
         return None;
     }
+    // Segment checksum, unless the NIC already verified it
+    if !buf.csum_verified() {
+        let pseudo = crate::net::checksum::pseudo_header_checksum(
+            pkt.src.as_bytes(), pkt.dst.as_bytes(), crate::net::ipv4::PROTO_TCP, data.len() as u16);
+        if crate::net::checksum::finish(crate::net::checksum::partial_sum(data, pseudo)) != 0 {
+            return None;
+        }
+    }
 
     let src_port = ((data[0] as u16) << 8) | data[1] as u16;
     let dst_port = ((data[2] as u16) << 8) | data[3] as u16;
@@ -249,6 +333,9 @@ pub(crate) fn parse_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) -> Option<TcpSeg
     // Parse TCP options (between fixed header and payload).
     let mut wscale = None;
     let mut peer_mss = None;
+    let mut sack_permitted = false;
+    let mut sack = [(0u32, 0u32); MAX_SACK_BLOCKS];
+    let mut sack_count = 0usize;
     if data_offset > TCP_HEADER_LEN {
         let opts = &data[TCP_HEADER_LEN..data_offset];
         let mut i = 0;
@@ -268,6 +355,25 @@ pub(crate) fn parse_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) -> Option<TcpSeg
                     }
                     i += if i + 1 < opts.len() { opts[i + 1] as usize } else { 2 };
                 }
+                4 => {             // SACK Permitted (Kind=4, Len=2)
+                    sack_permitted = i + 1 < opts.len() && opts[i + 1] == 2;
+                    i += 2;
+                }
+                5 => {             // SACK (Kind=5, Len=2+8n)
+                    let len = if i + 1 < opts.len() { opts[i + 1] as usize } else { break };
+                    if len < 2 || i + len > opts.len() {
+                        break;
+                    }
+                    for block in opts[i + 2..i + len].chunks_exact(8) {
+                        if sack_count < MAX_SACK_BLOCKS {
+                            let left = u32::from_be_bytes([block[0], block[1], block[2], block[3]]);
+                            let right = u32::from_be_bytes([block[4], block[5], block[6], block[7]]);
+                            sack[sack_count] = (left, right);
+                            sack_count += 1;
+                        }
+                    }
+                    i += len;
+                }
                 _ => {             // Unknown option — skip using length field
                     if i + 1 < opts.len() && opts[i + 1] >= 2 {
                         i += opts[i + 1] as usize;
@@ -279,11 +385,7 @@ pub(crate) fn parse_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) -> Option<TcpSeg
         }
     }
 
-    let payload = if data_offset < data.len() {
-        Vec::from(&data[data_offset..])
-    } else {
-        Vec::new()
-    };
+    let payload = buf.view(&data[data_offset..]);
 
     Some(TcpSegment {
         src_port,
@@ -296,5 +398,8 @@ pub(crate) fn parse_tcp(pkt: &crate::net::ipv4::Ipv4Packet<'_>) -> Option<TcpSeg
         src_ip: pkt.src,
         wscale,
         peer_mss,
+        sack_permitted,
+        sack,
+        sack_count,
     })
 }
@@ -8,8 +8,9 @@ use alloc::vec::Vec;
 use crate::net::types::Ipv4Addr;
 use crate::sync::spinlock::Spinlock;
 use super::tcb::*;
+use super::connect::take_listener;
 use super::send::send_segment;
-use super::TCP_CONNECTIONS;
+use super::table;
 
 // ── Sequence number comparison (wrapping-safe) ──────────────────────
 
@@ -66,74 +67,58 @@ pub(crate) fn send_rst(seg: &TcpSegment) {
 /// Called from sys_exit() when a process terminates.
 /// Sends RST for established connections and frees listener slots + pending connections.
 pub fn cleanup_for_thread(tid: u32) {
-    let mut rst_list: [(Ipv4Addr, u16, Ipv4Addr, u16, u32, u32); 16] =
-        [(Ipv4Addr([0; 4]), 0, Ipv4Addr([0; 4]), 0, 0, 0); 16];
-    let mut rst_count = 0usize;
-
-    {
-        let mut conns = TCP_CONNECTIONS.lock();
-        let table = match conns.as_mut() {
-            Some(t) => t,
-            None => return,
+    let mut rst_list: Vec<(Ipv4Addr, u16, Ipv4Addr, u16, u32, u32)> = Vec::new();
+    let entries = table::entries();
+
+    // First pass: close listeners and their pending (unaccepted) connections
+    for (i, listener) in entries.iter() {
+        let pending = {
+            if listener.lock().owner_tid != tid {
+                continue;
+            }
+            match take_listener(listener) {
+                Some(p) => p,
+                None => continue,
+            }
         };
-
-        // First pass: close listeners and their pending (unaccepted) connections
-        for i in 0..table.len() {
-            let is_owned_listener = table[i].as_ref().map(|tcb| {
-                tcb.owner_tid == tid && tcb.state == TcpState::Listen
-            }).unwrap_or(false);
-
-            if is_owned_listener {
-                let lid = i as u8;
-                for j in 0..table.len() {
-                    let is_pending = table[j].as_ref().map(|tcb| {
-                        tcb.parent_listener == Some(lid) && !tcb.accepted
-                    }).unwrap_or(false);
-                    if is_pending {
-                        if let Some(tcb) = &table[j] {
-                            if tcb.state != TcpState::Closed && rst_count < rst_list.len() {
-                                rst_list[rst_count] = (tcb.local_ip, tcb.local_port,
-                                    tcb.remote_ip, tcb.remote_port, tcb.snd_nxt, tcb.rcv_nxt);
-                                rst_count += 1;
-                            }
-                        }
-                        table[j] = None;
+        for cid in pending {
+            if let Some(child) = table::get(cid) {
+                {
+                    let tcb = child.lock();
+                    if tcb.state != TcpState::Closed {
+                        rst_list.push((tcb.local_ip, tcb.local_port,
+                            tcb.remote_ip, tcb.remote_port, tcb.snd_nxt, tcb.rcv_nxt));
                     }
                 }
-                table[i] = None;
-                crate::serial_println!("TCP: cleanup listener socket {} for TID {}", i, tid);
+                table::discard(cid, &child);
             }
         }
+        table::discard(*i, listener);
+        crate::serial_println!("TCP: cleanup listener socket {} for TID {}", i, tid);
+    }
 
-        // Second pass: close active connections owned by this thread
-        for i in 0..table.len() {
-            let is_owned = table[i].as_ref().map(|tcb| {
-                tcb.owner_tid == tid
-            }).unwrap_or(false);
-
-            if is_owned {
-                if let Some(tcb) = &table[i] {
-                    match tcb.state {
-                        TcpState::Established | TcpState::SynSent | TcpState::SynReceived
-                        | TcpState::FinWait1 | TcpState::FinWait2 | TcpState::CloseWait => {
-                            if rst_count < rst_list.len() {
-                                rst_list[rst_count] = (tcb.local_ip, tcb.local_port,
-                                    tcb.remote_ip, tcb.remote_port, tcb.snd_nxt, tcb.rcv_nxt);
-                                rst_count += 1;
-                            }
-                        }
-                        _ => {}
-                    }
+    // Second pass: close active connections owned by this thread
+    for (i, conn) in entries.iter() {
+        {
+            let tcb = conn.lock();
+            if tcb.owner_tid != tid || tcb.detached {
+                continue;
+            }
+            match tcb.state {
+                TcpState::Established | TcpState::SynSent | TcpState::SynReceived
+                | TcpState::FinWait1 | TcpState::FinWait2 | TcpState::CloseWait => {
+                    rst_list.push((tcb.local_ip, tcb.local_port,
+                        tcb.remote_ip, tcb.remote_port, tcb.snd_nxt, tcb.rcv_nxt));
                 }
-                table[i] = None;
-                crate::serial_println!("TCP: cleanup socket {} for TID {}", i, tid);
+                _ => {}
             }
         }
+        table::discard(*i, conn);
+        crate::serial_println!("TCP: cleanup socket {} for TID {}", i, tid);
     }
 
-    // Send RSTs outside the lock
-    for k in 0..rst_count {
-        let (lip, lp, rip, rp, seq, ack) = rst_list[k];
+    // Send RSTs outside the locks
+    for &(lip, lp, rip, rp, seq, ack) in rst_list.iter() {
         if rp != 0 {
             send_segment(lip, lp, rip, rp, seq, ack, RST | ACK, 0, &[]);
         }
@@ -151,30 +136,29 @@ pub struct TcpConnInfo {
     pub state: TcpState,
     pub owner_tid: u32,
     pub recv_buf_len: usize,
+    /// Congestion window in bytes.
+    pub cwnd: u32,
+    /// Smoothed RTT in ticks (0 before the first sample).
+    pub srtt_ticks: u32,
+    /// Current retransmission timeout in ticks.
+    pub rto_ticks: u32,
 }
 
 /// List all active TCP connections and listeners.
 pub fn list_connections() -> Vec<TcpConnInfo> {
-    let mut result = Vec::new();
-    let conns = TCP_CONNECTIONS.lock();
-    let table = match conns.as_ref() {
-        Some(t) => t,
-        None => return result,
-    };
-
-    for slot in table.iter() {
-        if let Some(tcb) = slot {
-            result.push(TcpConnInfo {
-                local_ip: tcb.local_ip,
-                local_port: tcb.local_port,
-                remote_ip: tcb.remote_ip,
-                remote_port: tcb.remote_port,
-                state: tcb.state,
-                owner_tid: tcb.owner_tid,
-                recv_buf_len: tcb.recv_buf.len(),
-            });
+    table::entries().iter().map(|(_, tcb)| {
+        let tcb = tcb.lock();
+        TcpConnInfo {
+            local_ip: tcb.local_ip,
+            local_port: tcb.local_port,
+            remote_ip: tcb.remote_ip,
+            remote_port: tcb.remote_port,
+            state: tcb.state,
+            owner_tid: tcb.owner_tid,
+            recv_buf_len: tcb.recv_buf.len(),
+            cwnd: tcb.cwnd,
+            srtt_ticks: tcb.srtt >> 3,
+            rto_ticks: tcb.rto,
         }
-    }
-
-    result
+    }).collect()
 }
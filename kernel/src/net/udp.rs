@@ -184,6 +184,12 @@ pub fn recv(port: u16) -> Option<UdpDatagram> {
     None
 }
 
+/// Number of datagrams queued on a bound port, or `None` if it is not bound.
+pub fn pending(port: u16) -> Option<usize> {
+    let ports = UDP_PORTS.lock();
+    ports.as_ref()?.get(&port).map(|cfg| cfg.queue.len())
+}
+
 /// Receive a UDP datagram with timeout (blocking with polling)
 pub fn recv_timeout(port: u16, timeout_ticks: u32) -> Option<UdpDatagram> {
     let start = crate::arch::hal::timer_current_ticks();
@@ -216,18 +222,25 @@ pub fn handle_udp(pkt: &Ipv4Packet<'_>) {
 
     let payload = &data[UDP_HEADER_LEN..(length as usize)];
 
-    let mut ports = UDP_PORTS.lock();
-    if let Some(map) = ports.as_mut() {
-        if let Some(cfg) = map.get_mut(&dst_port) {
-            if cfg.queue.len() < MAX_QUEUE_LEN {
-                cfg.queue.push_back(UdpDatagram {
-                    src_ip: pkt.src,
-                    src_port,
-                    data: Vec::from(payload),
-                });
+    let mut queued = false;
+    {
+        let mut ports = UDP_PORTS.lock();
+        if let Some(map) = ports.as_mut() {
+            if let Some(cfg) = map.get_mut(&dst_port) {
+                if cfg.queue.len() < MAX_QUEUE_LEN {
+                    cfg.queue.push_back(UdpDatagram {
+                        src_ip: pkt.src,
+                        src_port,
+                        data: Vec::from(payload),
+                    });
+                    queued = true;
+                }
             }
         }
     }
+    if queued {
+        crate::ipc::poll_set::notify(crate::ipc::poll_set::Key::Udp(dst_port));
+    }
 }
 
 /// List all bound UDP ports with owner and queue info.
@@ -0,0 +1,247 @@
+//! Per-call-site lock contention profiler (cargo feature `lock_profile`).
+//!
+//! When the feature is enabled, every [`Spinlock`](super::spinlock::Spinlock),
+//! [`TicketLock`](super::ticket_lock::TicketLock) and
+//! [`Mutex`](super::mutex::Mutex) acquisition is attributed to the source
+//! location of its `lock()` call (via `#[track_caller]`) and counted in a
+//! fixed, lock-free site table: acquires, contended acquires, cycles spent
+//! waiting, cycles held, and the longest single hold.  Cycles come from
+//! [`hal::cycle_counter`](crate::arch::hal::cycle_counter).
+//!
+//! The table is read through `SYS_LOCK_STATS` (anyTrace "Locks" tab).
+//! Without the feature all hooks compile to nothing and the syscall reports
+//! the profiler as disabled.
+
+use core::panic::Location;
+
+/// Whether this kernel was built with the lock profiler.
+pub const ENABLED: bool = cfg!(feature = "lock_profile");
+
+/// Lock flavour recorded per site.
+pub const KIND_SPIN: u32 = 0;
+pub const KIND_TICKET: u32 = 1;
+pub const KIND_MUTEX: u32 = 2;
+
+/// Bytes of the source path kept per record (the tail, NUL-padded).
+pub const FILE_LEN: usize = 40;
+
+/// One call site as returned by `SYS_LOCK_STATS` (96 bytes, must match
+/// `anyos_std::debug::LockStat`).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct LockStatRecord {
+    pub file: [u8; FILE_LEN],
+    pub line: u32,
+    pub kind: u32,
+    /// Address of the last lock acquired at this site.
+    pub lock_addr: u64,
+    pub acquires: u64,
+    /// Acquisitions that found the lock taken.
+    pub contended: u64,
+    pub spin_cycles: u64,
+    pub hold_cycles: u64,
+    pub max_hold_cycles: u64,
+}
+
+impl LockStatRecord {
+    pub const fn zeroed() -> Self {
+        LockStatRecord {
+            file: [0; FILE_LEN], line: 0, kind: 0, lock_addr: 0,
+            acquires: 0, contended: 0, spin_cycles: 0, hold_cycles: 0, max_hold_cycles: 0,
+        }
+    }
+}
+
+/// Profiling state carried by a lock guard (zero-sized without the feature).
+#[derive(Clone, Copy)]
+pub struct Held {
+    #[cfg(feature = "lock_profile")]
+    site: usize,
+    #[cfg(feature = "lock_profile")]
+    since: u64,
+}
+
+impl Held {
+    /// Guard state for an acquisition that is not attributed to any site.
+    pub const NONE: Held = Held {
+        #[cfg(feature = "lock_profile")]
+        site: usize::MAX,
+        #[cfg(feature = "lock_profile")]
+        since: 0,
+    };
+}
+
+/// Timestamp taken before trying to acquire (0 without the feature).
+#[inline(always)]
+pub fn start() -> u64 {
+    #[cfg(feature = "lock_profile")]
+    {
+        crate::arch::hal::cycle_counter()
+    }
+    #[cfg(not(feature = "lock_profile"))]
+    {
+        0
+    }
+}
+
+#[cfg(feature = "lock_profile")]
+mod imp {
+    use super::*;
+    use core::sync::atomic::{AtomicU32, AtomicU64, AtomicUsize, Ordering};
+
+    /// Site table size (power of two).  Sites beyond it are not recorded.
+    const SITES: usize = 256;
+
+    pub(super) struct Site {
+        /// `&'static Location` address; 0 = free slot.
+        key: AtomicUsize,
+        kind: AtomicU32,
+        lock_addr: AtomicUsize,
+        acquires: AtomicU64,
+        contended: AtomicU64,
+        spin_cycles: AtomicU64,
+        hold_cycles: AtomicU64,
+        max_hold_cycles: AtomicU64,
+    }
+
+    pub(super) static TABLE: [Site; SITES] = {
+        const INIT: Site = Site {
+            key: AtomicUsize::new(0),
+            kind: AtomicU32::new(0),
+            lock_addr: AtomicUsize::new(0),
+            acquires: AtomicU64::new(0),
+            contended: AtomicU64::new(0),
+            spin_cycles: AtomicU64::new(0),
+            hold_cycles: AtomicU64::new(0),
+            max_hold_cycles: AtomicU64::new(0),
+        };
+        [INIT; SITES]
+    };
+
+    /// Find or claim the slot for `loc` (open addressing, linear probe).
+    fn slot(loc: &'static Location<'static>, kind: u32) -> usize {
+        let key = loc as *const Location as usize;
+        let mut i = (key >> 3).wrapping_mul(0x9E37_79B9) & (SITES - 1);
+        for _ in 0..SITES {
+            let site = &TABLE[i];
+            match site.key.compare_exchange(0, key, Ordering::AcqRel, Ordering::Acquire) {
+                Ok(_) => {
+                    site.kind.store(kind, Ordering::Relaxed);
+                    return i;
+                }
+                Err(k) if k == key => return i,
+                Err(_) => i = (i + 1) & (SITES - 1),
+            }
+        }
+        usize::MAX
+    }
+
+    pub(super) fn acquired(
+        loc: &'static Location<'static>, kind: u32, lock_addr: usize, t0: u64, contended: bool,
+    ) -> Held {
+        let now = crate::arch::hal::cycle_counter();
+        let idx = slot(loc, kind);
+        if let Some(site) = TABLE.get(idx) {
+            site.lock_addr.store(lock_addr, Ordering::Relaxed);
+            site.acquires.fetch_add(1, Ordering::Relaxed);
+            if contended {
+                site.contended.fetch_add(1, Ordering::Relaxed);
+                site.spin_cycles.fetch_add(now.wrapping_sub(t0), Ordering::Relaxed);
+            }
+        }
+        Held { site: idx, since: now }
+    }
+
+    pub(super) fn released(held: &Held) {
+        if let Some(site) = TABLE.get(held.site) {
+            let cycles = crate::arch::hal::cycle_counter().wrapping_sub(held.since);
+            site.hold_cycles.fetch_add(cycles, Ordering::Relaxed);
+            site.max_hold_cycles.fetch_max(cycles, Ordering::Relaxed);
+        }
+    }
+
+    pub(super) fn snapshot(emit: &mut dyn FnMut(usize, &LockStatRecord)) -> usize {
+        let mut total = 0;
+        for site in TABLE.iter() {
+            let key = site.key.load(Ordering::Acquire);
+            if key == 0 {
+                continue;
+            }
+            // SAFETY: keys are only ever set from `&'static Location`.
+            let loc = unsafe { &*(key as *const Location<'static>) };
+            let path = loc.file().as_bytes();
+            let tail = &path[path.len().saturating_sub(FILE_LEN)..];
+            let mut rec = LockStatRecord::zeroed();
+            rec.file[..tail.len()].copy_from_slice(tail);
+            rec.line = loc.line();
+            rec.kind = site.kind.load(Ordering::Relaxed);
+            rec.lock_addr = site.lock_addr.load(Ordering::Relaxed) as u64;
+            rec.acquires = site.acquires.load(Ordering::Relaxed);
+            rec.contended = site.contended.load(Ordering::Relaxed);
+            rec.spin_cycles = site.spin_cycles.load(Ordering::Relaxed);
+            rec.hold_cycles = site.hold_cycles.load(Ordering::Relaxed);
+            rec.max_hold_cycles = site.max_hold_cycles.load(Ordering::Relaxed);
+            emit(total, &rec);
+            total += 1;
+        }
+        total
+    }
+
+    pub(super) fn reset() {
+        // Sites stay claimed (guards in flight still point at them).
+        for site in TABLE.iter() {
+            site.acquires.store(0, Ordering::Relaxed);
+            site.contended.store(0, Ordering::Relaxed);
+            site.spin_cycles.store(0, Ordering::Relaxed);
+            site.hold_cycles.store(0, Ordering::Relaxed);
+            site.max_hold_cycles.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+/// Record a completed acquisition of `lock_addr` from `loc`.
+///
+/// `t0` is the [`start`] timestamp; `contended` says whether the first
+/// attempt failed (only then is the wait counted as spin time).
+#[inline(always)]
+#[allow(unused_variables)]
+pub fn acquired(
+    loc: &'static Location<'static>, kind: u32, lock_addr: usize, t0: u64, contended: bool,
+) -> Held {
+    #[cfg(feature = "lock_profile")]
+    {
+        imp::acquired(loc, kind, lock_addr, t0, contended)
+    }
+    #[cfg(not(feature = "lock_profile"))]
+    {
+        Held::NONE
+    }
+}
+
+/// Account the hold time of a guard being released.
+#[inline(always)]
+#[allow(unused_variables)]
+pub fn released(held: &Held) {
+    #[cfg(feature = "lock_profile")]
+    imp::released(held);
+}
+
+/// Pass every recorded site to `emit` as `(index, record)`; returns the
+/// number of sites.  Always 0 without the feature.
+#[allow(unused_variables)]
+pub fn snapshot(emit: &mut dyn FnMut(usize, &LockStatRecord)) -> usize {
+    #[cfg(feature = "lock_profile")]
+    {
+        imp::snapshot(emit)
+    }
+    #[cfg(not(feature = "lock_profile"))]
+    {
+        0
+    }
+}
+
+/// Zero all counters.
+pub fn reset() {
+    #[cfg(feature = "lock_profile")]
+    imp::reset();
+}
@@ -1,8 +1,12 @@
 //! Synchronization primitives for the kernel.
 //!
-//! Provides an IRQ-safe [`spinlock::Spinlock`], a sleeping [`mutex::Mutex`],
-//! and a counting [`semaphore::Semaphore`].
+//! Provides an IRQ-safe [`spinlock::Spinlock`], a fair FIFO
+//! [`ticket_lock::TicketLock`] for the most contended locks, a sleeping
+//! [`mutex::Mutex`], and a counting [`semaphore::Semaphore`].
+//! [`lock_profile`] optionally records contention per call site.
 
 pub mod spinlock;
+pub mod ticket_lock;
+pub mod lock_profile;
 pub mod mutex;
 pub mod semaphore;
@@ -2,18 +2,26 @@
 //! with interrupts disabled, so other threads (including the compositor)
 //! keep running while the caller waits.
 //!
-//! Internally a brief [`Spinlock`] protects the `locked` flag.  When the
+//! The `locked` flag is a single atomic taken with compare-and-swap, so an
+//! uncontended lock/unlock never touches the interrupt flag.  When the
 //! mutex is contended the thread does a voluntary `schedule()` (yield)
 //! which puts it back in the ready queue.  The timer will reschedule it,
 //! and it retries the lock.  This avoids the lost-wakeup race inherent
 //! in block/wake designs and requires zero heap allocation.
 //!
+//! Acquisition is deliberately not FIFO: a waiter can be killed while it
+//! is yielding, and a queued ticket it never redeems would wedge every
+//! later caller.  With the `lock_profile` feature, waits (including the
+//! yields) and hold times are recorded per call site like the spinlocks.
+//!
 //! **Must NOT be used from interrupt handlers** — only from preemptible
 //! kernel context (syscalls, kernel threads).
 
-use crate::sync::spinlock::Spinlock;
+use crate::sync::lock_profile;
 use core::cell::UnsafeCell;
 use core::ops::{Deref, DerefMut};
+use core::panic::Location;
+use core::sync::atomic::{AtomicBool, Ordering};
 
 /// A yielding mutex that gives up its time slice when contended.
 ///
@@ -21,7 +29,7 @@ use core::ops::{Deref, DerefMut};
 /// events are processed normally even during long-held locks (e.g. VFS
 /// disk I/O).
 pub struct Mutex<T> {
-    inner: Spinlock<bool>,
+    locked: AtomicBool,
     data: UnsafeCell<T>,
 }
 
@@ -34,32 +42,37 @@ unsafe impl<T: Send> Send for Mutex<T> {}
 /// the mutex when dropped.
 pub struct MutexGuard<'a, T> {
     mutex: &'a Mutex<T>,
+    held: lock_profile::Held,
 }
 
 impl<T> Mutex<T> {
     /// Create a new unlocked mutex wrapping the given data.
     pub const fn new(data: T) -> Self {
         Mutex {
-            inner: Spinlock::new(false),
+            locked: AtomicBool::new(false),
             data: UnsafeCell::new(data),
         }
     }
 
     /// Acquire the mutex, yielding the current time slice if contended.
+    #[cfg_attr(feature = "lock_profile", track_caller)]
     pub fn lock(&self) -> MutexGuard<T> {
-        loop {
-            {
-                let mut locked = self.inner.lock();
-                if !*locked {
-                    *locked = true;
-                    return MutexGuard { mutex: self };
-                }
-            } // Spinlock released — interrupts re-enabled
-
+        let t0 = lock_profile::start();
+        let mut contended = false;
+        while self
+            .locked
+            .compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            contended = true;
             // Yield our time slice so other threads (including the lock
             // holder) can run.  We stay Ready and will be rescheduled.
             crate::task::scheduler::schedule();
         }
+        let held = lock_profile::acquired(
+            Location::caller(), lock_profile::KIND_MUTEX, self as *const _ as usize, t0, contended,
+        );
+        MutexGuard { mutex: self, held }
     }
 }
 
@@ -78,7 +91,7 @@ impl<'a, T> DerefMut for MutexGuard<'a, T> {
 
 impl<'a, T> Drop for MutexGuard<'a, T> {
     fn drop(&mut self) {
-        let mut locked = self.mutex.inner.lock();
-        *locked = false;
+        lock_profile::released(&self.held);
+        self.mutex.locked.store(false, Ordering::Release);
     }
 }
@@ -4,18 +4,20 @@
 //! interrupt state on drop, preventing deadlocks from IRQ handlers trying
 //! to acquire an already-held lock on a single-core system.
 
+use crate::sync::lock_profile;
 use core::cell::UnsafeCell;
 use core::ops::{Deref, DerefMut};
+use core::panic::Location;
 use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
 
 /// No CPU owns this lock.
-const NO_OWNER: u32 = u32::MAX;
+pub(crate) const NO_OWNER: u32 = u32::MAX;
 
 /// After this many inner-loop iterations, print a deadlock diagnostic via
 /// direct UART.  10M iterations × ~10-40 ns/PAUSE ≈ 100-400 ms — long enough
 /// that normal contention never triggers it, short enough to fire before
 /// the system appears frozen.
-const SPIN_TIMEOUT: u32 = 10_000_000;
+pub(crate) const SPIN_TIMEOUT: u32 = 10_000_000;
 
 // ── Lock-free UART helpers (bypass ALL software locks) ──────────────────
 
@@ -74,6 +76,31 @@ fn diag_dec(mut n: u32) {
     }
 }
 
+/// Print a SPIN TIMEOUT diagnostic for the lock at `lock_addr` whose owner
+/// is CPU `owner` (`u32::MAX` = none).  Shared with [`TicketLock`].
+///
+/// [`TicketLock`]: super::ticket_lock::TicketLock
+#[cold]
+pub(crate) fn report_spin_timeout(lock_addr: u64, owner: u32) {
+    let me = cpu_id();
+    diag_puts(b"\n!!! SPIN TIMEOUT lock=");
+    diag_hex(lock_addr);
+    diag_puts(b" cpu=");
+    diag_dec(me);
+    diag_puts(b" owner=");
+    if owner == NO_OWNER {
+        diag_puts(b"NONE");
+    } else {
+        diag_dec(owner);
+        // Print the SCHEDULER lock phase of the owner CPU so we
+        // know which function is holding the lock for 100-400 ms.
+        let phase = crate::sched_diag::get(owner as usize);
+        diag_puts(b" phase=");
+        diag_puts(crate::sched_diag::name(phase));
+    }
+    diag_putc(b'\n');
+}
+
 /// An IRQ-safe spinlock protecting data of type `T`.
 ///
 /// Automatically disables interrupts while held and restores the previous
@@ -99,6 +126,7 @@ unsafe impl<T: Send> Send for Spinlock<T> {}
 pub struct SpinlockGuard<'a, T> {
     lock: &'a Spinlock<T>,
     irq_was_enabled: bool,
+    held: lock_profile::Held,
 }
 
 /// Check if interrupts are currently enabled.
@@ -140,6 +168,7 @@ impl<T> Spinlock<T> {
     /// Disables interrupts before spinning to prevent single-core deadlocks.
     /// If spinning exceeds `SPIN_TIMEOUT` iterations, prints a diagnostic
     /// via direct UART (lock-free) to identify the deadlocking lock and CPUs.
+    #[cfg_attr(feature = "lock_profile", track_caller)]
     pub fn lock(&self) -> SpinlockGuard<T> {
         // Save interrupt state and disable interrupts BEFORE acquiring the lock.
         // This prevents deadlock: if we hold the lock and a timer/device IRQ fires,
@@ -149,12 +178,15 @@ impl<T> Spinlock<T> {
 
         let mut spin_count: u32 = 0;
         let mut reported = false;
+        let t0 = lock_profile::start();
+        let mut contended = false;
 
         while self
             .lock
             .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
             .is_err()
         {
+            contended = true;
             // Exponential PAUSE backoff: 1, 2, 4, 8, 16, 32, 64 PAUSEs per check.
             // Reduces cache-line bouncing under contention and helps VMware's
             // "PAUSE Loop Exiting" (PLE) detect spin-waiting vCPUs.
@@ -170,37 +202,26 @@ impl<T> Spinlock<T> {
 
                 if !reported && spin_count >= SPIN_TIMEOUT {
                     reported = true;
-                    let lock_addr = self as *const _ as u64;
-                    let me = cpu_id();
-                    let owner = self.owner_cpu.load(Ordering::Relaxed);
-                    diag_puts(b"\n!!! SPIN TIMEOUT lock=");
-                    diag_hex(lock_addr);
-                    diag_puts(b" cpu=");
-                    diag_dec(me);
-                    diag_puts(b" owner=");
-                    if owner == NO_OWNER {
-                        diag_puts(b"NONE");
-                    } else {
-                        diag_dec(owner);
-                        // Print the SCHEDULER lock phase of the owner CPU so we
-                        // know which function is holding the lock for 100-400 ms.
-                        let phase = crate::sched_diag::get(owner as usize);
-                        diag_puts(b" phase=");
-                        diag_puts(crate::sched_diag::name(phase));
-                    }
-                    diag_putc(b'\n');
+                    report_spin_timeout(
+                        self as *const _ as u64,
+                        self.owner_cpu.load(Ordering::Relaxed),
+                    );
                 }
             }
         }
 
         self.owner_cpu.store(cpu_id(), Ordering::Relaxed);
-        SpinlockGuard { lock: self, irq_was_enabled: was_enabled }
+        let held = lock_profile::acquired(
+            Location::caller(), lock_profile::KIND_SPIN, self as *const _ as usize, t0, contended,
+        );
+        SpinlockGuard { lock: self, irq_was_enabled: was_enabled, held }
     }
 
     /// Try to acquire the lock without blocking.
     ///
     /// Returns `Some(guard)` if the lock was acquired, `None` otherwise.
     /// Restores interrupt state on failure.
+    #[cfg_attr(feature = "lock_profile", track_caller)]
     pub fn try_lock(&self) -> Option<SpinlockGuard<T>> {
         let was_enabled = interrupts_enabled();
         cli();
@@ -211,7 +232,11 @@ impl<T> Spinlock<T> {
             .is_ok()
         {
             self.owner_cpu.store(cpu_id(), Ordering::Relaxed);
-            Some(SpinlockGuard { lock: self, irq_was_enabled: was_enabled })
+            let held = lock_profile::acquired(
+                Location::caller(), lock_profile::KIND_SPIN, self as *const _ as usize,
+                0, false,
+            );
+            Some(SpinlockGuard { lock: self, irq_was_enabled: was_enabled, held })
         } else {
             // Failed to acquire — restore interrupt state
             if was_enabled {
@@ -289,6 +314,7 @@ impl<'a, T> SpinlockGuard<'a, T> {
     /// Interrupts remain disabled after this call.
     /// Used by schedule() to keep IF=0 from lock acquisition through context_switch.
     pub fn release_no_irq_restore(self) {
+        lock_profile::released(&self.held);
         self.lock.owner_cpu.store(NO_OWNER, Ordering::Relaxed);
         self.lock.lock.store(false, Ordering::Release);
         core::mem::forget(self); // Skip Drop (which would restore IF)
@@ -297,6 +323,7 @@ impl<'a, T> SpinlockGuard<'a, T> {
 
 impl<'a, T> Drop for SpinlockGuard<'a, T> {
     fn drop(&mut self) {
+        lock_profile::released(&self.held);
         self.lock.owner_cpu.store(NO_OWNER, Ordering::Relaxed);
         self.lock.lock.store(false, Ordering::Release);
         // Restore interrupt state AFTER releasing the lock.
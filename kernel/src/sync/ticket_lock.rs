@@ -0,0 +1,190 @@
+//! IRQ-safe FIFO ticket spinlock for heavily contended kernel locks.
+//!
+//! A plain test-and-set [`Spinlock`](super::spinlock::Spinlock) lets whichever
+//! CPU wins the cache-line race take the lock, so under load one CPU can
+//! starve the others.  A ticket lock hands the lock out strictly in arrival
+//! order: `lock()` takes a ticket from `next` and spins until `serving`
+//! reaches it; unlock bumps `serving`.  Waiters only *read* `serving` while
+//! spinning and back off in proportion to their distance from the head of
+//! the queue, which keeps the line quiet until their turn approaches.
+//!
+//! The API mirrors `Spinlock` (including owner tracking for fault-handler
+//! recovery and the SPIN TIMEOUT diagnostic), so a static can switch between
+//! the two by changing its type.  Used for SCHEDULER, the physical frame
+//! ALLOCATOR and TCP_CONNECTIONS.
+
+use crate::sync::lock_profile;
+use crate::sync::spinlock::{report_spin_timeout, NO_OWNER, SPIN_TIMEOUT};
+use core::cell::UnsafeCell;
+use core::ops::{Deref, DerefMut};
+use core::panic::Location;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// PAUSEs per waiter ahead of us between reads of `serving`.
+const BACKOFF_PER_WAITER: u32 = 16;
+/// Upper bound on a single backoff round.
+const BACKOFF_MAX: u32 = 256;
+
+/// An IRQ-safe FIFO spinlock protecting data of type `T`.
+///
+/// Interrupts are disabled from the moment a ticket is taken until the guard
+/// is dropped.  [`try_lock`](TicketLock::try_lock) only succeeds when nobody
+/// is queued, so it never jumps the queue.
+pub struct TicketLock<T> {
+    next: AtomicU32,
+    serving: AtomicU32,
+    owner_cpu: AtomicU32,
+    data: UnsafeCell<T>,
+}
+
+unsafe impl<T: Send> Sync for TicketLock<T> {}
+unsafe impl<T: Send> Send for TicketLock<T> {}
+
+/// RAII guard for a held [`TicketLock`].
+///
+/// On drop, passes the lock to the next ticket and restores the interrupt
+/// state saved at acquisition time.
+pub struct TicketLockGuard<'a, T> {
+    lock: &'a TicketLock<T>,
+    irq_was_enabled: bool,
+    held: lock_profile::Held,
+}
+
+impl<T> TicketLock<T> {
+    /// Create a new unlocked ticket lock wrapping the given data.
+    pub const fn new(data: T) -> Self {
+        TicketLock {
+            next: AtomicU32::new(0),
+            serving: AtomicU32::new(0),
+            owner_cpu: AtomicU32::new(NO_OWNER),
+            data: UnsafeCell::new(data),
+        }
+    }
+
+    /// Take a ticket and spin until it is served.
+    ///
+    /// Disables interrupts first (a ticket holder that took an IRQ which
+    /// re-entered the lock would wait on itself forever).
+    #[cfg_attr(feature = "lock_profile", track_caller)]
+    pub fn lock(&self) -> TicketLockGuard<'_, T> {
+        let was_enabled = crate::arch::hal::interrupts_enabled();
+        crate::arch::hal::disable_interrupts();
+
+        let t0 = lock_profile::start();
+        let ticket = self.next.fetch_add(1, Ordering::Relaxed);
+        let mut serving = self.serving.load(Ordering::Acquire);
+        let contended = serving != ticket;
+        let mut spin_count: u32 = 0;
+        let mut reported = false;
+
+        while serving != ticket {
+            let ahead = ticket.wrapping_sub(serving);
+            let backoff = ahead.saturating_mul(BACKOFF_PER_WAITER).min(BACKOFF_MAX);
+            for _ in 0..backoff {
+                core::hint::spin_loop();
+            }
+            spin_count = spin_count.saturating_add(backoff);
+            if !reported && spin_count >= SPIN_TIMEOUT {
+                reported = true;
+                report_spin_timeout(self as *const _ as u64, self.owner_cpu.load(Ordering::Relaxed));
+            }
+            serving = self.serving.load(Ordering::Acquire);
+        }
+
+        self.owner_cpu.store(crate::arch::hal::cpu_id() as u32, Ordering::Relaxed);
+        let held = lock_profile::acquired(
+            Location::caller(), lock_profile::KIND_TICKET, self as *const _ as usize, t0, contended,
+        );
+        TicketLockGuard { lock: self, irq_was_enabled: was_enabled, held }
+    }
+
+    /// Acquire the lock only if it is free and nobody is queued.
+    ///
+    /// Restores interrupt state on failure.
+    #[cfg_attr(feature = "lock_profile", track_caller)]
+    pub fn try_lock(&self) -> Option<TicketLockGuard<'_, T>> {
+        let was_enabled = crate::arch::hal::interrupts_enabled();
+        crate::arch::hal::disable_interrupts();
+
+        let serving = self.serving.load(Ordering::Relaxed);
+        if self
+            .next
+            .compare_exchange(serving, serving.wrapping_add(1), Ordering::Acquire, Ordering::Relaxed)
+            .is_ok()
+        {
+            self.owner_cpu.store(crate::arch::hal::cpu_id() as u32, Ordering::Relaxed);
+            let held = lock_profile::acquired(
+                Location::caller(), lock_profile::KIND_TICKET, self as *const _ as usize,
+                0, false,
+            );
+            Some(TicketLockGuard { lock: self, irq_was_enabled: was_enabled, held })
+        } else {
+            if was_enabled {
+                crate::arch::hal::enable_interrupts();
+            }
+            None
+        }
+    }
+
+    /// Check if this lock is currently held by the given CPU.
+    #[inline]
+    pub fn is_held_by_cpu(&self, cpu: u32) -> bool {
+        self.owner_cpu.load(Ordering::Relaxed) == cpu
+    }
+
+    /// Check if this lock is currently held (or has waiters).
+    #[inline]
+    pub fn is_locked(&self) -> bool {
+        self.next.load(Ordering::Relaxed) != self.serving.load(Ordering::Relaxed)
+    }
+
+    /// Force-release the lock, passing it to the next ticket. Used by the
+    /// fault handler to recover from a fault while this CPU held the lock.
+    ///
+    /// # Safety
+    /// Caller must ensure this CPU actually holds the lock (check `is_held_by_cpu` first).
+    /// The protected data may be in a partially-modified state.
+    pub unsafe fn force_unlock(&self) {
+        self.unlock();
+    }
+
+    #[inline(always)]
+    fn unlock(&self) {
+        self.owner_cpu.store(NO_OWNER, Ordering::Relaxed);
+        self.serving.fetch_add(1, Ordering::Release);
+    }
+}
+
+impl<'a, T> Deref for TicketLockGuard<'a, T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        unsafe { &*self.lock.data.get() }
+    }
+}
+
+impl<'a, T> DerefMut for TicketLockGuard<'a, T> {
+    fn deref_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.lock.data.get() }
+    }
+}
+
+impl<'a, T> TicketLockGuard<'a, T> {
+    /// Release the lock WITHOUT restoring the saved interrupt state.
+    /// Interrupts remain disabled after this call.
+    /// Used by schedule() to keep IF=0 from lock acquisition through context_switch.
+    pub fn release_no_irq_restore(self) {
+        lock_profile::released(&self.held);
+        self.lock.unlock();
+        core::mem::forget(self); // Skip Drop (which would restore IF)
+    }
+}
+
+impl<'a, T> Drop for TicketLockGuard<'a, T> {
+    fn drop(&mut self) {
+        lock_profile::released(&self.held);
+        self.lock.unlock();
+        if self.irq_was_enabled {
+            crate::arch::hal::enable_interrupts();
+        }
+    }
+}
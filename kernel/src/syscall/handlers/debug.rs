@@ -2,7 +2,9 @@
 //!
 //! Provides process debugging primitives: attach/detach, suspend/resume,
 //! register and memory inspection, software breakpoints, single-step,
-//! memory map queries, debug event polling, and extended thread info.
+//! memory map queries, debug event polling, extended thread info, the
+//! kernel lock contention profile, per-syscall latency statistics, the
+//! sampling profiler and the kernel tracepoints.
 //!
 //! All handlers require `CAP_DEBUG`.
 
@@ -267,3 +269,214 @@ pub fn sys_thread_info_ex(tid: u32, buf_ptr: u32, size: u32) -> u32 {
 
     scheduler::thread_info_ex(tid, buf, size)
 }
+
+// =========================================================================
+// SYS_LOCK_STATS (314) — Lock contention profile
+// =========================================================================
+
+/// Size of the header written before the records: enabled (u32),
+/// site count (u32), cycle counter frequency in Hz (u64).
+const LOCK_STATS_HEADER: usize = 16;
+
+/// Flag: zero the counters after reading them.
+const LOCK_STATS_RESET: u32 = 1;
+
+/// Copy the per-call-site lock profile into `buf`: a 16-byte header
+/// followed by as many 96-byte records as fit.  With `buf_ptr == 0` only
+/// the count is returned (and `flags` applied).
+///
+/// Returns the total number of recorded sites (may exceed what fit), or
+/// u32::MAX on error.  Kernels built without the `lock_profile` feature
+/// report `enabled = 0` and no sites.
+pub fn sys_lock_stats(buf_ptr: u32, size: u32, flags: u32) -> u32 {
+    use crate::sync::lock_profile::{self, LockStatRecord};
+    let buf = buf_ptr as u64;
+    let size = size as usize;
+    let rec_size = core::mem::size_of::<LockStatRecord>();
+
+    let total = if buf == 0 {
+        lock_profile::snapshot(&mut |_, _| {})
+    } else {
+        if size < LOCK_STATS_HEADER || !is_valid_user_ptr(buf, size as u64) {
+            return u32::MAX;
+        }
+        let cap = (size - LOCK_STATS_HEADER) / rec_size;
+        let recs = (buf as usize + LOCK_STATS_HEADER) as *mut LockStatRecord;
+        let total = lock_profile::snapshot(&mut |i, rec| {
+            if i < cap {
+                unsafe { core::ptr::write_unaligned(recs.add(i), *rec) };
+            }
+        });
+        unsafe {
+            core::ptr::write_unaligned(buf as *mut u32, lock_profile::ENABLED as u32);
+            core::ptr::write_unaligned((buf + 4) as *mut u32, total as u32);
+            core::ptr::write_unaligned((buf + 8) as *mut u64, crate::arch::hal::cycle_counter_hz());
+        }
+        total
+    };
+
+    if flags & LOCK_STATS_RESET != 0 {
+        lock_profile::reset();
+    }
+    total as u32
+}
+
+// =========================================================================
+// SYS_SYSCALL_STATS (315) — Per-syscall counts and latency histograms
+// =========================================================================
+
+/// Size of the header written before the records: enabled (u32), syscall
+/// records written (u32), thread records written (u32), thread filter (u32),
+/// cycle counter frequency in Hz (u64), reserved (u64).
+const SYSCALL_STATS_HEADER: usize = 32;
+
+/// Flag: zero the counters after reading them.
+const SYSCALL_STATS_RESET: u32 = 1;
+/// Flag: start recording.
+const SYSCALL_STATS_ENABLE: u32 = 2;
+/// Flag: stop recording.
+const SYSCALL_STATS_DISABLE: u32 = 4;
+/// Flag: record only the thread given in `tid` (0 = all threads).
+const SYSCALL_STATS_FILTER: u32 = 8;
+
+/// Copy the syscall statistics into `buf`: a 32-byte header, then one
+/// 176-byte record per syscall number that has been called, then one
+/// 24-byte record per thread seen, as many of each as fit.  `flags` are
+/// applied after reading.  With `buf_ptr == 0` only `flags` are applied.
+///
+/// Returns the buffer size needed for everything, or u32::MAX on error.
+pub fn sys_syscall_stats(buf_ptr: u32, size: u32, flags: u32, tid: u32) -> u32 {
+    use crate::syscall::stats::{self, SyscallStatRecord, ThreadStatRecord};
+    let buf = buf_ptr as u64;
+    let size = size as usize;
+    let sys_size = core::mem::size_of::<SyscallStatRecord>();
+    let thr_size = core::mem::size_of::<ThreadStatRecord>();
+
+    let syscalls = stats::snapshot_syscalls();
+    let threads = stats::snapshot_threads();
+    let needed = SYSCALL_STATS_HEADER + syscalls.len() * sys_size + threads.len() * thr_size;
+
+    if buf != 0 {
+        if size < SYSCALL_STATS_HEADER || !is_valid_user_ptr(buf, size as u64) {
+            return u32::MAX;
+        }
+        let mut off = SYSCALL_STATS_HEADER;
+        let n_sys = syscalls.len().min((size - off) / sys_size);
+        for rec in &syscalls[..n_sys] {
+            unsafe { core::ptr::write_unaligned((buf as usize + off) as *mut SyscallStatRecord, *rec) };
+            off += sys_size;
+        }
+        let n_thr = threads.len().min((size - off) / thr_size);
+        for rec in &threads[..n_thr] {
+            unsafe { core::ptr::write_unaligned((buf as usize + off) as *mut ThreadStatRecord, *rec) };
+            off += thr_size;
+        }
+        unsafe {
+            core::ptr::write_unaligned(buf as *mut u32, stats::enabled() as u32);
+            core::ptr::write_unaligned((buf + 4) as *mut u32, n_sys as u32);
+            core::ptr::write_unaligned((buf + 8) as *mut u32, n_thr as u32);
+            core::ptr::write_unaligned((buf + 12) as *mut u32, stats::filter());
+            core::ptr::write_unaligned((buf + 16) as *mut u64, crate::arch::hal::cycle_counter_hz());
+            core::ptr::write_unaligned((buf + 24) as *mut u64, 0);
+        }
+    }
+
+    if flags & SYSCALL_STATS_RESET != 0 {
+        stats::reset();
+    }
+    if flags & SYSCALL_STATS_FILTER != 0 {
+        stats::set_filter(tid);
+    }
+    if flags & SYSCALL_STATS_DISABLE != 0 {
+        stats::disable();
+    } else if flags & SYSCALL_STATS_ENABLE != 0 {
+        stats::enable();
+    }
+    needed as u32
+}
+
+// =========================================================================
+// SYS_PROF_START (316) / SYS_PROF_STOP (317) — Sampling profiler
+// =========================================================================
+
+/// Start system-wide sampling at `hz` samples per second per CPU (0 = 1000,
+/// at most 10000) and map the sample rings into the caller.  Restarting
+/// clears them.  Returns the user address of the buffer (layout in
+/// `task::profiler`), or 0 on failure.
+pub fn sys_prof_start(hz: u32) -> u32 {
+    #[cfg(target_arch = "x86_64")]
+    { crate::task::profiler::start(hz) as u32 }
+    #[cfg(not(target_arch = "x86_64"))]
+    { let _ = hz; 0 }
+}
+
+/// Stop sampling.  The buffer stays mapped for draining.  Returns 0.
+pub fn sys_prof_stop() -> u32 {
+    #[cfg(target_arch = "x86_64")]
+    crate::task::profiler::stop();
+    0
+}
+
+// =========================================================================
+// SYS_TRACE_CTL (326) / SYS_TRACE_READ (327) — Kernel tracepoints
+// =========================================================================
+
+/// Flag: enable exactly the events in `mask` (bit = `task::tracepoints`
+/// event number; 0 turns tracing off).
+const TRACE_CTL_SET: u32 = 1;
+/// Flag: discard pending records.
+const TRACE_CTL_RESET: u32 = 2;
+
+/// Size of the header written before the records: enabled event mask
+/// (u32), CPUs with a ring (u32), records written (u32), records lost since
+/// the previous read (u32), cycle counter frequency in Hz (u64), records
+/// per CPU ring (u32), record size (u32).
+const TRACE_READ_HEADER: usize = 32;
+
+/// Apply `flags` (`TRACE_CTL_*`) to the kernel tracepoints.  Returns the
+/// event mask that was enabled before the call.
+pub fn sys_trace_ctl(mask: u32, flags: u32) -> u32 {
+    use crate::task::tracepoints;
+    let prev = tracepoints::mask();
+    if flags & TRACE_CTL_SET != 0 {
+        tracepoints::set_mask(mask);
+    }
+    if flags & TRACE_CTL_RESET != 0 {
+        tracepoints::reset();
+    }
+    prev
+}
+
+/// Drain pending tracepoint records into `buf`: a 32-byte header, then as
+/// many 32-byte records as fit, grouped by CPU and in order within a CPU.
+///
+/// Returns the number of records written, or u32::MAX on error.
+pub fn sys_trace_read(buf_ptr: u32, size: u32) -> u32 {
+    use crate::task::tracepoints::{self, TraceRecord};
+    let buf = buf_ptr as u64;
+    let size = size as usize;
+    let rec_size = core::mem::size_of::<TraceRecord>();
+    if size < TRACE_READ_HEADER || !is_valid_user_ptr(buf, size as u64) {
+        return u32::MAX;
+    }
+
+    let rings = tracepoints::ring_count();
+    let max = ((size - TRACE_READ_HEADER) / rec_size).min(rings * tracepoints::CAPACITY as usize);
+    let zero = TraceRecord { tsc: 0, tid: 0, cpu: 0, event: 0, arg0: 0, arg1: 0 };
+    let mut records = alloc::vec![zero; max];
+    let (n, lost) = tracepoints::drain(&mut records);
+    for (i, rec) in records[..n].iter().enumerate() {
+        let off = TRACE_READ_HEADER + i * rec_size;
+        unsafe { core::ptr::write_unaligned((buf as usize + off) as *mut TraceRecord, *rec) };
+    }
+    unsafe {
+        core::ptr::write_unaligned(buf as *mut u32, tracepoints::mask());
+        core::ptr::write_unaligned((buf + 4) as *mut u32, rings as u32);
+        core::ptr::write_unaligned((buf + 8) as *mut u32, n as u32);
+        core::ptr::write_unaligned((buf + 12) as *mut u32, lost);
+        core::ptr::write_unaligned((buf + 16) as *mut u64, crate::arch::hal::cycle_counter_hz());
+        core::ptr::write_unaligned((buf + 24) as *mut u32, tracepoints::CAPACITY);
+        core::ptr::write_unaligned((buf + 28) as *mut u32, rec_size as u32);
+    }
+    n as u32
+}
@@ -153,6 +153,8 @@ pub fn sys_disk_write(device_id: u32, lba: u32, count: u32, buf_ptr: u32, buf_si
 
     let buf = unsafe { core::slice::from_raw_parts(buf_ptr as *const u8, needed as usize) };
     if dev.write_sectors(lba, count, buf) {
+        // Raw sectors may belong to any cached file.
+        crate::fs::page_cache::invalidate_all();
         count
     } else {
         u32::MAX
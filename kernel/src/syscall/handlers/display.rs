@@ -195,7 +195,7 @@ pub fn sys_gpu_has_hw_cursor() -> u32 {
 // Audio
 // =========================================================================
 
-/// SYS_AUDIO_WRITE: Write PCM data to audio output.
+/// SYS_AUDIO_WRITE: Queue PCM data on the caller's mixer stream.
 /// arg1 = pointer to PCM data buffer, arg2 = length in bytes.
 /// Returns number of bytes written.
 #[cfg(target_arch = "x86_64")]
@@ -221,6 +221,13 @@ pub fn sys_audio_write(_buf_ptr: u32, _buf_len: u32) -> u32 {
 ///   2 = get volume (returns 0-100)
 ///   3 = get status (returns 1 if playing, 0 if not)
 ///   4 = is available (returns 1 if audio hw present)
+///   5 = get position (sample frames played, wrapping u32)
+///   6 = get buffered (sample frames written but not played yet)
+///   7 = set stream sample rate (arg2 = Hz, 8000-192000; 0 or u32::MAX)
+///   8 = get output latency (frames from mixing to output)
+///   9 = set period size (arg2 = frames; returns the size applied)
+///  10 = get period size (frames)
+/// Stop, position, buffered and rate apply to the caller's own stream.
 #[cfg(target_arch = "x86_64")]
 pub fn sys_audio_ctl(cmd: u32, arg: u32) -> u32 {
     match cmd {
@@ -229,6 +236,12 @@ pub fn sys_audio_ctl(cmd: u32, arg: u32) -> u32 {
         2 => crate::drivers::audio::get_volume() as u32,
         3 => if crate::drivers::audio::is_playing() { 1 } else { 0 },
         4 => if crate::drivers::audio::is_available() { 1 } else { 0 },
+        5 => crate::drivers::audio::position() as u32,
+        6 => crate::drivers::audio::buffered(),
+        7 => if crate::drivers::audio::set_rate(arg) { 0 } else { u32::MAX },
+        8 => crate::drivers::audio::latency(),
+        9 => crate::drivers::audio::set_period(arg),
+        10 => crate::drivers::audio::mixer::period_frames(),
         _ => u32::MAX,
     }
 }
@@ -309,16 +322,14 @@ pub fn sys_map_framebuffer(out_info_ptr: u32) -> u32 {
     let fb_map_size: usize = 16 * 1024 * 1024;
     let pages = fb_map_size / crate::memory::FRAME_SIZE;
 
-    for i in 0..pages {
-        let phys_addr = crate::memory::address::PhysAddr::new(
-            fb_phys as u64 + (i * crate::memory::FRAME_SIZE) as u64,
-        );
-        let virt_addr = crate::memory::address::VirtAddr::new(
-            fb_user_base + (i * crate::memory::FRAME_SIZE) as u64,
-        );
-        // Present + Writable + User + Write-Through (0x0F)
-        crate::memory::virtual_mem::map_page(virt_addr, phys_addr, 0x0F);
-    }
+    // Present + Writable + User + Write-Through (0x0F).  2 MiB pages where
+    // the aperture is aligned: the blit loops sweep the whole buffer.
+    crate::memory::virtual_mem::map_contiguous(
+        crate::memory::address::VirtAddr::new(fb_user_base),
+        crate::memory::address::PhysAddr::new(fb_phys as u64),
+        pages,
+        0x0F,
+    );
 
     // Write FbMapInfo struct to user memory
     if out_info_ptr != 0 {
@@ -347,7 +358,8 @@ pub fn sys_map_framebuffer(_out_info_ptr: u32) -> u32 {
 ///
 /// Each command is 36 bytes: { cmd_type: u32, args: [u32; 8] }
 /// Command types: 1=UPDATE, 2=FILL_RECT, 3=COPY_RECT, 4=CURSOR_MOVE,
-///                5=CURSOR_SHOW, 6=DEFINE_CURSOR, 7=FLIP
+///                5=CURSOR_SHOW, 6=DEFINE_CURSOR, 7=FLIP, 8=SYNC,
+///                10=SCANOUT, 11=FENCE (command ring only)
 #[cfg(target_arch = "x86_64")]
 pub fn sys_gpu_command(cmd_buf_ptr: u32, cmd_count: u32) -> u32 {
     if !is_compositor() {
@@ -366,99 +378,318 @@ pub fn sys_gpu_command(cmd_buf_ptr: u32, cmd_count: u32) -> u32 {
         core::slice::from_raw_parts(cmd_buf_ptr as *const [u32; 9], count)
     };
 
-    // Process all commands in a single GPU lock acquisition.
-    // UPDATE commands use transfer_rect (no flush) and accumulate a
-    // bounding box; a single flush_display at the end covers them all.
-    let result = crate::drivers::gpu::with_gpu(|g| {
-        let mut executed = 0u32;
-        // Bounding box for batched UPDATE transfers
-        let mut flush_x0 = u32::MAX;
-        let mut flush_y0 = u32::MAX;
-        let mut flush_x1 = 0u32;
-        let mut flush_y1 = 0u32;
-
-        for cmd in cmds {
-            let cmd_type = cmd[0];
-            let ok = match cmd_type {
-                1 => { // UPDATE(x, y, w, h) — accumulate bbox, defer transfer+flush
-                    let (x, y, w, h) = (cmd[1], cmd[2], cmd[3], cmd[4]);
-                    // Only expand bounding box; transfer is batched at the end
-                    if w > 0 && h > 0 {
-                        flush_x0 = flush_x0.min(x);
-                        flush_y0 = flush_y0.min(y);
-                        flush_x1 = flush_x1.max(x + w);
-                        flush_y1 = flush_y1.max(y + h);
-                    }
-                    true
-                }
-                2 => { // FILL_RECT(x, y, w, h, color)
-                    g.accel_fill_rect(cmd[1], cmd[2], cmd[3], cmd[4], cmd[5])
-                }
-                3 => { // COPY_RECT(sx, sy, dx, dy, w, h)
-                    g.accel_copy_rect(cmd[1], cmd[2], cmd[3], cmd[4], cmd[5], cmd[6])
+    crate::drivers::gpu::with_gpu(|g| run_gpu_commands(g, cmds.iter().copied(), None))
+        .unwrap_or(0)
+}
+
+/// Execute compositor GPU commands in a single GPU lock acquisition.
+/// UPDATE commands use transfer_rect (no flush) and accumulate a
+/// bounding box; a single flush_display covers them all, issued at the end
+/// or before a FENCE so the fence covers the transfer.
+#[cfg(target_arch = "x86_64")]
+fn run_gpu_commands(
+    g: &mut dyn crate::drivers::gpu::GpuDriver,
+    cmds: impl Iterator<Item = [u32; 9]>,
+    mut ring: Option<&mut GpuRing>,
+) -> u32 {
+    let mut executed = 0u32;
+    // Bounding box [x0, y0, x1, y1] for batched UPDATE transfers
+    let mut bbox = [u32::MAX, u32::MAX, 0u32, 0u32];
+    fn flush_updates(g: &mut dyn crate::drivers::gpu::GpuDriver, bbox: &mut [u32; 4]) {
+        let [x0, y0, x1, y1] = *bbox;
+        if x0 < x1 && y0 < y1 {
+            g.transfer_rect(x0, y0, x1 - x0, y1 - y0);
+            g.flush_display(x0, y0, x1 - x0, y1 - y0);
+        }
+        *bbox = [u32::MAX, u32::MAX, 0, 0];
+    }
+
+    for cmd in cmds {
+        let cmd_type = cmd[0];
+        let ok = match cmd_type {
+            1 => { // UPDATE(x, y, w, h) — accumulate bbox, defer transfer+flush
+                let (x, y, w, h) = (cmd[1], cmd[2], cmd[3], cmd[4]);
+                // Only expand bounding box; transfer is batched at the end
+                if w > 0 && h > 0 {
+                    bbox = [bbox[0].min(x), bbox[1].min(y), bbox[2].max(x + w), bbox[3].max(y + h)];
                 }
-                4 => { // CURSOR_MOVE(x, y)
-                    if !crate::drivers::gpu::is_splash_cursor_active() {
-                        g.move_cursor(cmd[1], cmd[2]);
-                    }
-                    true
+                true
+            }
+            2 => { // FILL_RECT(x, y, w, h, color)
+                g.accel_fill_rect(cmd[1], cmd[2], cmd[3], cmd[4], cmd[5])
+            }
+            3 => { // COPY_RECT(sx, sy, dx, dy, w, h)
+                g.accel_copy_rect(cmd[1], cmd[2], cmd[3], cmd[4], cmd[5], cmd[6])
+            }
+            4 => { // CURSOR_MOVE(x, y)
+                if !crate::drivers::gpu::is_splash_cursor_active() {
+                    g.move_cursor(cmd[1], cmd[2]);
                 }
-                5 => { // CURSOR_SHOW(visible)
-                    g.show_cursor(cmd[1] != 0);
+                true
+            }
+            5 => { // CURSOR_SHOW(visible)
+                g.show_cursor(cmd[1] != 0);
+                true
+            }
+            6 => { // DEFINE_CURSOR(w, h, hotx, hoty, pixels_ptr_lo, pixels_ptr_hi, pixel_count)
+                let w = cmd[1];
+                let h = cmd[2];
+                let hotx = cmd[3];
+                let hoty = cmd[4];
+                let ptr = (cmd[5] as u64) | ((cmd[6] as u64) << 32);
+                let count = cmd[7] as usize;
+                if w == 0 || h == 0 || count == 0 || ptr == 0 {
+                    false
+                } else if count != (w * h) as usize {
+                    false
+                } else if !is_valid_user_ptr(ptr, (count * 4) as u64) {
+                    crate::serial_println!("GPU DEFINE_CURSOR: invalid pixel ptr {:#x} count={}", ptr, count);
+                    false
+                } else {
+                    let pixels = unsafe {
+                        core::slice::from_raw_parts(ptr as *const u32, count)
+                    };
+                    g.define_cursor(w, h, hotx, hoty, pixels);
                     true
                 }
-                6 => { // DEFINE_CURSOR(w, h, hotx, hoty, pixels_ptr_lo, pixels_ptr_hi, pixel_count)
-                    let w = cmd[1];
-                    let h = cmd[2];
-                    let hotx = cmd[3];
-                    let hoty = cmd[4];
-                    let ptr = (cmd[5] as u64) | ((cmd[6] as u64) << 32);
-                    let count = cmd[7] as usize;
-                    if w == 0 || h == 0 || count == 0 || ptr == 0 {
-                        false
-                    } else if count != (w * h) as usize {
-                        false
-                    } else if !is_valid_user_ptr(ptr, (count * 4) as u64) {
-                        crate::serial_println!("GPU DEFINE_CURSOR: invalid pixel ptr {:#x} count={}", ptr, count);
-                        false
-                    } else {
-                        let pixels = unsafe {
-                            core::slice::from_raw_parts(ptr as *const u32, count)
-                        };
-                        g.define_cursor(w, h, hotx, hoty, pixels);
+            }
+            7 => { // FLIP
+                g.flip();
+                true
+            }
+            8 => { // SYNC
+                g.sync();
+                true
+            }
+            9 => { // VRAM_INFO
+                true
+            }
+            10 => { // SCANOUT(enable, vram_line)
+                g.set_scanout(if cmd[1] != 0 { Some(cmd[2]) } else { None })
+            }
+            11 => { // FENCE(value)
+                match ring.as_deref_mut() {
+                    Some(r) => {
+                        flush_updates(g, &mut bbox);
+                        r.fence(g, cmd[1]);
                         true
                     }
+                    None => false,
                 }
-                7 => { // FLIP
-                    g.flip();
-                    true
-                }
-                8 => { // SYNC
-                    g.sync();
-                    true
-                }
-                9 => { // VRAM_INFO
-                    true
-                }
-                _ => false,
-            };
-            if ok {
-                executed += 1;
             }
+            _ => false,
+        };
+        if ok {
+            executed += 1;
         }
+    }
 
-        // Single batched transfer + flush for all UPDATE rects
-        if flush_x0 < flush_x1 && flush_y0 < flush_y1 {
-            let bw = flush_x1 - flush_x0;
-            let bh = flush_y1 - flush_y0;
-            g.transfer_rect(flush_x0, flush_y0, bw, bh);
-            g.flush_display(flush_x0, flush_y0, bw, bh);
+    // Single batched transfer + flush for all UPDATE rects
+    flush_updates(g, &mut bbox);
+    executed
+}
+
+// =========================================================================
+// GPU command ring
+// =========================================================================
+
+/// Header words before the ring's command slots.
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_HEADER_WORDS: usize = 16;
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_ENTRIES: usize = 0;
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_HEAD: usize = 1;
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_TAIL: usize = 2;
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_COMPLETED: usize = 3;
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_MAX_ENTRIES: u32 = 1024;
+/// Device fences tracked at once; further fences merge into the newest.
+#[cfg(target_arch = "x86_64")]
+const GPU_RING_MAX_PENDING: usize = 16;
+
+/// Command ring registered by the compositor (`SYS_GPU_RING_SETUP`).
+///
+/// The ring lives in compositor memory: `GPU_RING_HEADER_WORDS` header
+/// words `[entries, head, tail, completed_fence, ...]` followed by
+/// `entries` commands in the `SYS_GPU_COMMAND` format.  The compositor
+/// fills slots and advances `tail` (free-running); the doorbell executes
+/// everything up to `tail` and advances `head`.  FENCE(value) completes
+/// when the device has finished every earlier command, and the kernel then
+/// stores `value` in `completed_fence`, so the compositor waits only on the
+/// fences it needs.
+#[cfg(target_arch = "x86_64")]
+struct GpuRing {
+    base: u64,
+    entries: u32,
+    /// (compositor fence, device fence) not yet passed, oldest first.
+    pending: [(u32, u32); GPU_RING_MAX_PENDING],
+    pending_len: usize,
+    completed: u32,
+}
+
+#[cfg(target_arch = "x86_64")]
+static GPU_RING: crate::sync::spinlock::Spinlock<Option<GpuRing>> =
+    crate::sync::spinlock::Spinlock::new(None);
+
+/// Whether fence value `a` is at or after `b` (wrapping).
+#[cfg(target_arch = "x86_64")]
+fn fence_reached(a: u32, b: u32) -> bool {
+    (a.wrapping_sub(b) as i32) >= 0
+}
+
+#[cfg(target_arch = "x86_64")]
+impl GpuRing {
+    fn bytes(&self) -> u64 {
+        ((GPU_RING_HEADER_WORDS + self.entries as usize * 9) * 4) as u64
+    }
+
+    fn word(&self, i: usize) -> u32 {
+        unsafe { core::ptr::read_volatile((self.base as *const u32).add(i)) }
+    }
+
+    fn set_word(&self, i: usize, v: u32) {
+        unsafe { core::ptr::write_volatile((self.base as *mut u32).add(i), v) }
+    }
+
+    /// Command in slot `idx` (free-running) of the ring at `base`.
+    fn slot(base: u64, entries: u32, idx: u32) -> [u32; 9] {
+        let off = GPU_RING_HEADER_WORDS + (idx % entries) as usize * 9;
+        unsafe { core::ptr::read_volatile((base as *const u32).add(off) as *const [u32; 9]) }
+    }
+
+    /// Record a FENCE(value) behind the commands executed so far.
+    fn fence(&mut self, g: &mut dyn crate::drivers::gpu::GpuDriver, value: u32) {
+        let dev = g.insert_fence();
+        if dev == 0 {
+            // The device is idle: everything before this fence has completed.
+            self.pending_len = 0;
+            self.completed = value;
+        } else if self.pending_len == GPU_RING_MAX_PENDING {
+            self.pending[GPU_RING_MAX_PENDING - 1] = (value, dev);
+        } else {
+            self.pending[self.pending_len] = (value, dev);
+            self.pending_len += 1;
+        }
+    }
+
+    /// Advance `completed` past every device fence that has passed.
+    fn retire(&mut self, g: &mut dyn crate::drivers::gpu::GpuDriver) {
+        let mut n = 0;
+        while n < self.pending_len && g.fence_passed(self.pending[n].1) {
+            self.completed = self.pending[n].0;
+            n += 1;
         }
+        self.pending.copy_within(n..self.pending_len, 0);
+        self.pending_len -= n;
+        self.set_word(GPU_RING_COMPLETED, self.completed);
+    }
+}
 
-        executed
+/// SYS_GPU_RING_SETUP (319): Register the compositor's GPU command ring.
+/// arg1 = ring_ptr (4-byte aligned, 0 = unregister), arg2 = ring_bytes.
+/// Initializes the header and returns the number of command slots, or 0 on
+/// failure.
+#[cfg(target_arch = "x86_64")]
+pub fn sys_gpu_ring_setup(ring_ptr: u32, ring_bytes: u32) -> u32 {
+    if !is_compositor() {
+        return 0;
+    }
+    let mut guard = GPU_RING.lock();
+    *guard = None;
+    if ring_ptr == 0 || ring_ptr & 3 != 0 || !is_valid_user_ptr(ring_ptr as u64, ring_bytes as u64) {
+        return 0;
+    }
+    let words = ring_bytes as usize / 4;
+    if words < GPU_RING_HEADER_WORDS + 9 {
+        return 0;
+    }
+    let entries = (((words - GPU_RING_HEADER_WORDS) / 9) as u32).min(GPU_RING_MAX_ENTRIES);
+    let ring = GpuRing {
+        base: ring_ptr as u64,
+        entries,
+        pending: [(0, 0); GPU_RING_MAX_PENDING],
+        pending_len: 0,
+        completed: 0,
+    };
+    ring.set_word(GPU_RING_ENTRIES, entries);
+    ring.set_word(GPU_RING_HEAD, 0);
+    ring.set_word(GPU_RING_TAIL, 0);
+    ring.set_word(GPU_RING_COMPLETED, 0);
+    *guard = Some(ring);
+    entries
+}
+
+/// SYS_GPU_RING_DOORBELL (320): Execute the ring's commands up to `tail`.
+/// Returns the completed fence value, or u32::MAX if no ring is registered.
+#[cfg(target_arch = "x86_64")]
+pub fn sys_gpu_ring_doorbell() -> u32 {
+    if !is_compositor() {
+        return u32::MAX;
+    }
+    let mut guard = GPU_RING.lock();
+    let ring = match guard.as_mut() {
+        Some(r) if is_valid_user_ptr(r.base, r.bytes()) => r,
+        _ => return u32::MAX,
+    };
+    let head = ring.word(GPU_RING_HEAD);
+    let tail = ring.word(GPU_RING_TAIL);
+    core::sync::atomic::fence(Ordering::Acquire);
+    let count = tail.wrapping_sub(head).min(ring.entries);
+    let (base, entries) = (ring.base, ring.entries);
+    crate::drivers::gpu::with_gpu(|g| {
+        let cmds = (0..count).map(|i| GpuRing::slot(base, entries, head.wrapping_add(i)));
+        run_gpu_commands(g, cmds, Some(&mut *ring));
+        ring.retire(g);
     });
+    ring.set_word(GPU_RING_HEAD, head.wrapping_add(count));
+    ring.completed
+}
 
-    result.unwrap_or(0)
+/// SYS_GPU_FENCE_WAIT (321): Block until ring fence `fence` has completed.
+/// Returns the completed fence value (earlier than `fence` if it was never
+/// submitted), or u32::MAX if no ring is registered.
+#[cfg(target_arch = "x86_64")]
+pub fn sys_gpu_fence_wait(fence: u32) -> u32 {
+    if !is_compositor() {
+        return u32::MAX;
+    }
+    loop {
+        // Pick the device fence to wait on, then wait without the ring lock.
+        let dev = {
+            let mut guard = GPU_RING.lock();
+            let ring = match guard.as_mut() {
+                Some(r) if is_valid_user_ptr(r.base, r.bytes()) => r,
+                _ => return u32::MAX,
+            };
+            crate::drivers::gpu::with_gpu(|g| ring.retire(g));
+            if fence_reached(ring.completed, fence) || ring.pending_len == 0 {
+                return ring.completed;
+            }
+            let pending = &ring.pending[..ring.pending_len];
+            pending.iter().find(|p| fence_reached(p.0, fence)).unwrap_or(&pending[pending.len() - 1]).1
+        };
+        if crate::drivers::gpu::with_gpu(|g| g.wait_fence(dev)).is_none() {
+            return u32::MAX;
+        }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+pub fn sys_gpu_ring_setup(_ring_ptr: u32, _ring_bytes: u32) -> u32 {
+    0
+}
+
+#[cfg(target_arch = "aarch64")]
+pub fn sys_gpu_ring_doorbell() -> u32 {
+    u32::MAX
+}
+
+#[cfg(target_arch = "aarch64")]
+pub fn sys_gpu_fence_wait(_fence: u32) -> u32 {
+    u32::MAX
 }
 
 #[cfg(target_arch = "aarch64")]
@@ -696,6 +927,9 @@ pub fn sys_gpu_vram_size() -> u32 {
 /// arg3 = num_bytes (rounded up to pages)
 ///
 /// Maps VRAM at user VA 0x18000000 in the target process with Write-Through + PTE_VRAM.
+/// Calling it again for the same thread replaces the mapping (the compositor
+/// relocates surfaces when compacting VRAM); TLBs on all CPUs are flushed so
+/// the app's next write lands at the new offset.
 /// Returns 0x18000000 on success, 0 on failure.
 #[cfg(target_arch = "x86_64")]
 pub fn sys_vram_map(target_tid: u32, vram_offset: u32, num_bytes: u32) -> u32 {
@@ -727,15 +961,23 @@ pub fn sys_vram_map(target_tid: u32, vram_offset: u32, num_bytes: u32) -> u32 {
     // Map VRAM pages into the target's address space
     // Flags: Present + Writable + User + Write-Through + PTE_VRAM
     let flags: u64 = 0x0F | crate::memory::virtual_mem::PTE_VRAM; // 0x20F
+    let remap = crate::memory::virtual_mem::is_mapped_in_pd(
+        pd_phys,
+        crate::memory::address::VirtAddr::new(user_va_base),
+    );
 
-    for i in 0..pages {
-        let phys = crate::memory::address::PhysAddr::new(
-            fb_phys + vram_offset as u64 + (i * 4096) as u64,
-        );
-        let virt = crate::memory::address::VirtAddr::new(
-            user_va_base + (i * 4096) as u64,
-        );
-        crate::memory::virtual_mem::map_page_in_pd(pd_phys, virt, phys, flags);
+    // 2 MiB pages wherever the VRAM offset and remaining size allow it.
+    crate::memory::virtual_mem::map_contiguous_in_pd(
+        pd_phys,
+        crate::memory::address::VirtAddr::new(user_va_base),
+        crate::memory::address::PhysAddr::new(fb_phys + vram_offset as u64),
+        pages,
+        flags,
+    );
+    if remap {
+        // The target may be running on another CPU with the old surface cached.
+        crate::memory::virtual_mem::flush_tlb_all_contexts();
+        crate::arch::x86::smp::tlb_shootdown(crate::arch::x86::smp::TLB_FLUSH_ALL_CONTEXTS);
     }
 
     crate::serial_println!(
@@ -778,12 +1020,22 @@ pub fn sys_gpu_register_backbuffer(buf_ptr: u32, buf_size: u32) -> u32 {
     let page_base = (buf_ptr as u64) & !0xFFF; // align down to page boundary
     let mut phys_pages: alloc::vec::Vec<u64> = alloc::vec::Vec::with_capacity(pages);
 
+    // The GPU keeps the physical pages: the compositor's memory must never
+    // be swapped out again.  Let a reclaim pass already scanning it finish.
+    if let Some(pd) = crate::task::scheduler::current_thread_page_directory() {
+        crate::memory::vma::set_no_swap(pd);
+        crate::memory::reclaim::wait_unpinned(pd);
+    }
+
     // Walk page tables to collect physical addresses for each page
     for i in 0..pages {
         let va = page_base + (i as u64) * 4096;
-        let pte = crate::memory::virtual_mem::read_pte(
+        let mut pte = crate::memory::virtual_mem::read_pte(
             crate::memory::address::VirtAddr::new(va),
         );
+        if pte & 1 == 0 && crate::memory::virtual_mem::handle_swap_fault(va, true) {
+            pte = crate::memory::virtual_mem::read_pte(crate::memory::address::VirtAddr::new(va));
+        }
         if pte & 1 == 0 {
             // Page not present — cannot register
             crate::serial_println!(
@@ -822,6 +1074,42 @@ pub fn sys_gpu_register_backbuffer(_buf_ptr: u32, _buf_size: u32) -> u32 {
     u32::MAX
 }
 
+/// SYS_GPU_WAIT_VBLANK (318): Wait for the start of the next vertical retrace.
+/// Compositor-only; used to lock the frame clock's phase to the display.
+///
+/// arg1 = timeout in milliseconds
+///
+/// Returns 0 at the retrace edge, 1 on timeout, u32::MAX if the GPU does
+/// not report retrace status.
+#[cfg(target_arch = "x86_64")]
+pub fn sys_gpu_wait_vblank(timeout_ms: u32) -> u32 {
+    if !is_compositor() {
+        return u32::MAX;
+    }
+    let status = || crate::drivers::gpu::with_gpu(|g| g.in_vblank()).flatten();
+    let mut prev = match status() {
+        Some(v) => v,
+        None => return u32::MAX,
+    };
+    let deadline = crate::arch::x86::pit::real_ms_since_boot() + timeout_ms as u64;
+    loop {
+        let cur = status().unwrap_or(false);
+        if cur && !prev {
+            return 0;
+        }
+        prev = cur;
+        if crate::arch::x86::pit::real_ms_since_boot() >= deadline {
+            return 1;
+        }
+        core::hint::spin_loop();
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+pub fn sys_gpu_wait_vblank(_timeout_ms: u32) -> u32 {
+    u32::MAX
+}
+
 // =========================================================================
 // GPU 3D Acceleration (SVGA3D)
 // =========================================================================
@@ -848,11 +1136,13 @@ pub fn sys_gpu_3d_query(_query_type: u32) -> u32 {
 /// buf_ptr: pointer to u32 word array in user memory
 /// word_count: number of u32 words
 ///
-/// Validates that all command IDs are in the SVGA3D range (1040..1099)
-/// and that command sizes don't exceed the buffer.
+/// Validates that all command IDs are in the SVGA3D range (1040..1099),
+/// that command sizes don't exceed the buffer, and that `SURFACE_DMA`
+/// commands only name guest regions the caller created.
 #[cfg(target_arch = "x86_64")]
 pub fn sys_gpu_3d_submit(buf_ptr: u32, word_count: u32) -> u32 {
     use crate::drivers::gpu::vmware_svga::{SVGA_3D_CMD_MIN, SVGA_3D_CMD_MAX};
+    const CMD_SURFACE_DMA: u32 = 1044;
 
     if buf_ptr == 0 || word_count == 0 {
         return u32::MAX;
@@ -871,6 +1161,11 @@ pub fn sys_gpu_3d_submit(buf_ptr: u32, word_count: u32) -> u32 {
         core::slice::from_raw_parts(buf_ptr as *const u32, count)
     };
 
+    // Held through the submit so a region cannot be released (and its GMR
+    // ID reused) between validation and the FIFO write.
+    let regions = GUEST_REGIONS.lock();
+    let pd = current_pd();
+
     // Validate command buffer structure:
     // Each SVGA3D command is [cmd_id, size_bytes, payload...]
     // where size_bytes is the byte count of the payload only.
@@ -893,13 +1188,23 @@ pub fn sys_gpu_3d_submit(buf_ptr: u32, word_count: u32) -> u32 {
             return u32::MAX;
         }
 
+        // SURFACE_DMA payload starts with the guest GMR ID
+        if cmd_id == CMD_SURFACE_DMA {
+            let gmr_id = if payload_words > 0 { words[offset + 2] } else { u32::MAX };
+            if !regions.iter().any(|r| r.gmr_id == gmr_id && r.owner_pd == pd) {
+                return u32::MAX;
+            }
+        }
+
         offset += 2 + payload_words;
     }
 
     // Submit validated buffer to GPU
-    crate::drivers::gpu::with_gpu(|g| {
+    let ret = crate::drivers::gpu::with_gpu(|g| {
         if g.submit_3d_commands(words) { 0u32 } else { u32::MAX }
-    }).unwrap_or(u32::MAX)
+    }).unwrap_or(u32::MAX);
+    drop(regions);
+    ret
 }
 
 #[cfg(target_arch = "aarch64")]
@@ -967,3 +1272,148 @@ pub fn sys_gpu_3d_surface_dma_read(sid: u32, buf_ptr: u32, buf_len: u32, width:
 pub fn sys_gpu_3d_surface_dma_read(_sid: u32, _buf_ptr: u32, _buf_len: u32, _width: u32, _height: u32) -> u32 {
     u32::MAX
 }
+
+// ── Guest memory regions ─────────────────────────────────
+
+/// Largest guest region a process may create (bytes).
+#[cfg(target_arch = "x86_64")]
+const GUEST_REGION_MAX: u32 = 4 * 1024 * 1024;
+/// Guest regions per process.
+#[cfg(target_arch = "x86_64")]
+const GUEST_REGIONS_PER_PROCESS: usize = 4;
+
+/// A GMR backed by a kernel-owned SHM region mapped into its creator.
+///
+/// The frames are kernel-owned so an exiting process only loses its
+/// mapping; they are freed once the GMR is undefined, which happens on
+/// `SYS_GPU_3D_GMR_RELEASE` or when a later create finds the owner gone.
+#[cfg(target_arch = "x86_64")]
+struct GuestRegion {
+    gmr_id: u32,
+    shm_id: u32,
+    owner_tid: u32,
+    owner_pd: u64,
+}
+
+#[cfg(target_arch = "x86_64")]
+static GUEST_REGIONS: crate::sync::spinlock::Spinlock<alloc::vec::Vec<GuestRegion>> =
+    crate::sync::spinlock::Spinlock::new(alloc::vec::Vec::new());
+
+/// Physical address of the current page directory.
+#[cfg(target_arch = "x86_64")]
+fn current_pd() -> u64 {
+    let cr3: u64;
+    unsafe { core::arch::asm!("mov {}, cr3", out(reg) cr3); }
+    cr3 & !0xFFF
+}
+
+/// Release the regions of processes that have exited.
+#[cfg(target_arch = "x86_64")]
+fn reap_guest_regions() {
+    let mut dead = alloc::vec::Vec::new();
+    {
+        let mut regions = GUEST_REGIONS.lock();
+        let mut i = 0;
+        while i < regions.len() {
+            if crate::task::scheduler::thread_exists(regions[i].owner_tid) {
+                i += 1;
+                continue;
+            }
+            let r = regions.remove(i);
+            crate::drivers::gpu::with_gpu(|g| g.release_guest_region(r.gmr_id));
+            dead.push(r.shm_id);
+        }
+    }
+    for shm_id in dead {
+        crate::ipc::shared_memory::destroy(shm_id, crate::ipc::shared_memory::KERNEL_OWNER);
+    }
+}
+
+/// SYS_GPU_3D_GMR_CREATE (517): Create a persistent guest memory region.
+/// arg1: size in bytes (rounded up to pages, at most 4 MiB)
+/// arg2: user pointer receiving the region's virtual address (u32)
+///
+/// The region is mapped into the caller and defined as a GMR, so uploads
+/// can be written in place and named by `SURFACE_DMA` commands in
+/// `SYS_GPU_3D_SUBMIT` streams.  Returns the GMR ID, or u32::MAX.
+#[cfg(target_arch = "x86_64")]
+pub fn sys_gpu_3d_gmr_create(size: u32, out_ptr: u32) -> u32 {
+    use crate::ipc::shared_memory::{self, KERNEL_OWNER};
+
+    if size == 0 || size > GUEST_REGION_MAX || !is_valid_user_ptr(out_ptr as u64, 4) {
+        return u32::MAX;
+    }
+    reap_guest_regions();
+    let tid = crate::task::scheduler::current_tid();
+    let pd = current_pd();
+    if GUEST_REGIONS.lock().iter().filter(|r| r.owner_pd == pd).count() >= GUEST_REGIONS_PER_PROCESS {
+        return u32::MAX;
+    }
+
+    let shm_id = match shared_memory::create(size as usize, KERNEL_OWNER) {
+        Some(id) => id,
+        None => return u32::MAX,
+    };
+    let vaddr = shared_memory::map_into_current(shm_id);
+    if vaddr == 0 {
+        shared_memory::destroy(shm_id, KERNEL_OWNER);
+        return u32::MAX;
+    }
+    let phys: alloc::vec::Vec<u64> = shared_memory::region_frames(shm_id)
+        .iter()
+        .map(|f| f.as_u64())
+        .collect();
+
+    let gmr_id = {
+        let mut regions = GUEST_REGIONS.lock();
+        let id = crate::drivers::gpu::with_gpu(|g| g.define_guest_region(&phys)).flatten();
+        if let Some(gmr_id) = id {
+            regions.push(GuestRegion { gmr_id, shm_id, owner_tid: tid, owner_pd: pd });
+        }
+        id
+    };
+    match gmr_id {
+        Some(id) => {
+            unsafe { *(out_ptr as *mut u32) = vaddr as u32; }
+            id
+        }
+        None => {
+            shared_memory::unmap_from_current(shm_id);
+            shared_memory::destroy(shm_id, KERNEL_OWNER);
+            u32::MAX
+        }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+pub fn sys_gpu_3d_gmr_create(_size: u32, _out_ptr: u32) -> u32 {
+    u32::MAX
+}
+
+/// SYS_GPU_3D_GMR_RELEASE (518): Release a region from SYS_GPU_3D_GMR_CREATE.
+/// arg1: GMR ID.  Waits for queued commands, then unmaps and frees it.
+#[cfg(target_arch = "x86_64")]
+pub fn sys_gpu_3d_gmr_release(gmr_id: u32) -> u32 {
+    use crate::ipc::shared_memory::{self, KERNEL_OWNER};
+
+    let pd = current_pd();
+    let shm_id = {
+        let mut regions = GUEST_REGIONS.lock();
+        let idx = match regions.iter().position(|r| r.gmr_id == gmr_id && r.owner_pd == pd) {
+            Some(i) => i,
+            None => return u32::MAX,
+        };
+        let r = regions.remove(idx);
+        crate::drivers::gpu::with_gpu(|g| g.release_guest_region(r.gmr_id));
+        r.shm_id
+    };
+    // TLB shootdown: outside the lock.
+    shared_memory::unmap_from_current(shm_id);
+    shared_memory::destroy(shm_id, KERNEL_OWNER);
+    0
+}
+
+#[cfg(target_arch = "aarch64")]
+pub fn sys_gpu_3d_gmr_release(_gmr_id: u32) -> u32 {
+    u32::MAX
+}
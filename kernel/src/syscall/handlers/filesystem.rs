@@ -1,6 +1,6 @@
 //! Filesystem (VFS) syscall handlers.
 //!
-//! Covers path-based operations: readdir, stat, lstat, symlink, readlink,
+//! Covers path-based operations: readdir, getdents, stat, lstat, symlink, readlink,
 //! getcwd, chdir, mkdir, unlink, truncate, rename, mount, umount.
 
 use alloc::string::String;
@@ -50,6 +50,77 @@ pub fn sys_readdir(path_ptr: u32, buf_ptr: u32, buf_size: u32) -> u32 {
     }
 }
 
+/// Fixed part of a `getdents` record; the name follows.
+const DIRENT_HEADER: usize = 20;
+
+/// Fill `buf` with directory entries and their attributes, starting at the
+/// entry index stored at `cookie_ptr`; the index of the next entry is
+/// written back.  Returns the number of records (0 once the directory is
+/// exhausted).
+///
+/// Each record, little-endian and 4-byte aligned:
+/// [reclen:u16, type:u8, flags:u8, size:u32, uid:u16, gid:u16, mode:u16,
+///  name_len:u16, mtime:u32, name bytes, NUL, padding].
+/// type and flags are as in `readdir`; the attributes are those `stat`
+/// would report (symlinks resolved).
+pub fn sys_getdents(path_ptr: u32, buf_ptr: u32, buf_size: u32, cookie_ptr: u32) -> u32 {
+    if !is_valid_user_ptr(buf_ptr as u64, buf_size as u64)
+        || !is_valid_user_ptr(cookie_ptr as u64, 4)
+    {
+        return u32::MAX;
+    }
+    let path = resolve_path(unsafe { read_user_str(path_ptr) });
+
+    if let Ok((uid, gid, mode)) = crate::fs::vfs::get_permissions(&path) {
+        if !crate::fs::permissions::check_permission(uid, gid, mode, crate::fs::permissions::PERM_READ) {
+            return fs_err(crate::fs::vfs::FsError::PermissionDenied);
+        }
+    }
+
+    let entries = match crate::fs::vfs::read_dir(&path) {
+        Ok(e) => e,
+        Err(e) => return fs_err(e),
+    };
+    let cookie = unsafe { core::ptr::read_unaligned(cookie_ptr as *const u32) } as usize;
+    let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, buf_size as usize) };
+
+    let mut off = 0;
+    let mut next = cookie;
+    for entry in entries.iter().skip(cookie) {
+        let name = entry.name.as_bytes();
+        let reclen = (DIRENT_HEADER + name.len() + 1 + 3) & !3;
+        if off + reclen > buf.len() || reclen > u16::MAX as usize {
+            break;
+        }
+        let rec = &mut buf[off..off + reclen];
+        rec[0..2].copy_from_slice(&(reclen as u16).to_le_bytes());
+        rec[2] = match entry.file_type {
+            crate::fs::file::FileType::Regular => 0,
+            crate::fs::file::FileType::Directory => 1,
+            crate::fs::file::FileType::Device => 2,
+        };
+        rec[3] = if entry.is_symlink { 1 } else { 0 };
+        rec[4..8].copy_from_slice(&entry.size.to_le_bytes());
+        rec[8..10].copy_from_slice(&entry.uid.to_le_bytes());
+        rec[10..12].copy_from_slice(&entry.gid.to_le_bytes());
+        rec[12..14].copy_from_slice(&entry.mode.to_le_bytes());
+        rec[14..16].copy_from_slice(&(name.len() as u16).to_le_bytes());
+        rec[16..20].copy_from_slice(&entry.mtime.to_le_bytes());
+        rec[DIRENT_HEADER..DIRENT_HEADER + name.len()].copy_from_slice(name);
+        for b in &mut rec[DIRENT_HEADER + name.len()..] {
+            *b = 0;
+        }
+        off += reclen;
+        next += 1;
+    }
+    if next == cookie && next < entries.len() {
+        // Not even one record fits.
+        return fs_err(crate::fs::vfs::FsError::InvalidPath);
+    }
+    unsafe { core::ptr::write_unaligned(cookie_ptr as *mut u32, next as u32) };
+    (next - cookie) as u32
+}
+
 pub fn sys_stat(path_ptr: u32, buf_ptr: u32) -> u32 {
     let raw_path = unsafe { read_user_str(path_ptr) };
     let path = resolve_path(raw_path);
@@ -57,27 +128,7 @@ pub fn sys_stat(path_ptr: u32, buf_ptr: u32) -> u32 {
     match crate::fs::vfs::stat(&path) {
         Ok(st) => {
             if buf_ptr != 0 {
-                let type_val: u32 = match st.file_type {
-                    crate::fs::file::FileType::Directory => 1,
-                    crate::fs::file::FileType::Device => 2,
-                    _ => 0, // Regular
-                };
-                let flags: u32 = if st.is_symlink { 1 } else { 0 };
-                // Filesystems without UID storage (FAT, NTFS, ISO) always return
-                // uid=0.  Substitute the caller's real UID so that ownership
-                // checks (e.g. libgit2) work correctly for non-root users.
-                let caller_uid = crate::task::scheduler::current_thread_uid() as u32;
-                let file_uid = if st.uid == 0 { caller_uid } else { st.uid as u32 };
-                unsafe {
-                    let buf = buf_ptr as *mut u32;
-                    *buf = type_val;
-                    *buf.add(1) = st.size;
-                    *buf.add(2) = flags;
-                    *buf.add(3) = file_uid;
-                    *buf.add(4) = st.gid as u32;
-                    *buf.add(5) = st.mode as u32;
-                    *buf.add(6) = st.mtime;
-                }
+                write_stat(buf_ptr as u64, &st);
             }
             0
         }
@@ -92,24 +143,7 @@ pub fn sys_lstat(path_ptr: u32, buf_ptr: u32) -> u32 {
     match crate::fs::vfs::lstat(&path) {
         Ok(st) => {
             if buf_ptr != 0 {
-                let type_val: u32 = match st.file_type {
-                    crate::fs::file::FileType::Directory => 1,
-                    crate::fs::file::FileType::Device => 2,
-                    _ => 0, // Regular
-                };
-                let flags: u32 = if st.is_symlink { 1 } else { 0 };
-                let caller_uid = crate::task::scheduler::current_thread_uid() as u32;
-                let file_uid = if st.uid == 0 { caller_uid } else { st.uid as u32 };
-                unsafe {
-                    let buf = buf_ptr as *mut u32;
-                    *buf = type_val;
-                    *buf.add(1) = st.size;
-                    *buf.add(2) = flags;
-                    *buf.add(3) = file_uid;
-                    *buf.add(4) = st.gid as u32;
-                    *buf.add(5) = st.mode as u32;
-                    *buf.add(6) = st.mtime;
-                }
+                write_stat(buf_ptr as u64, &st);
             }
             0
         }
@@ -117,6 +151,32 @@ pub fn sys_lstat(path_ptr: u32, buf_ptr: u32) -> u32 {
     }
 }
 
+/// Encode `st` into a user stat buffer:
+/// [type, size, flags, uid, gid, mode, mtime] as u32 = 28 bytes.
+pub(super) fn write_stat(buf_ptr: u64, st: &crate::fs::vfs::StatResult) {
+    let type_val: u32 = match st.file_type {
+        crate::fs::file::FileType::Directory => 1,
+        crate::fs::file::FileType::Device => 2,
+        _ => 0, // Regular
+    };
+    let flags: u32 = if st.is_symlink { 1 } else { 0 };
+    // Filesystems without UID storage (FAT, NTFS, ISO) always return
+    // uid=0.  Substitute the caller's real UID so that ownership
+    // checks (e.g. libgit2) work correctly for non-root users.
+    let caller_uid = crate::task::scheduler::current_thread_uid() as u32;
+    let file_uid = if st.uid == 0 { caller_uid } else { st.uid as u32 };
+    unsafe {
+        let buf = buf_ptr as *mut u32;
+        *buf = type_val;
+        *buf.add(1) = st.size;
+        *buf.add(2) = flags;
+        *buf.add(3) = file_uid;
+        *buf.add(4) = st.gid as u32;
+        *buf.add(5) = st.mode as u32;
+        *buf.add(6) = st.mtime;
+    }
+}
+
 pub fn sys_symlink(target_ptr: u32, link_path_ptr: u32) -> u32 {
     let target = unsafe { read_user_str(target_ptr) };
     let raw_link = unsafe { read_user_str(link_path_ptr) };
@@ -45,6 +45,10 @@ pub(super) fn fs_err(e: crate::fs::vfs::FsError) -> u32 {
 
 /// Validate that a user pointer is in user address space (below kernel half).
 /// Returns false if the pointer is NULL, in kernel space, or if ptr+len overflows.
+///
+/// A valid buffer inside a file mapping, or swapped out to the swap file,
+/// is faulted in here, before the syscall takes locks the file read would
+/// need.
 #[inline]
 pub(super) fn is_valid_user_ptr(ptr: u64, len: u64) -> bool {
     if ptr == 0 {
@@ -52,10 +56,18 @@ pub(super) fn is_valid_user_ptr(ptr: u64, len: u64) -> bool {
     }
     // User space is below 0x0000_8000_0000_0000 (canonical lower half)
     let end = ptr.checked_add(len);
-    match end {
+    let valid = match end {
         Some(e) => e <= 0x0000_8000_0000_0000,
         None => false, // overflow
+    };
+    if valid && crate::memory::file_map::active() {
+        crate::memory::file_map::prefault(ptr, len);
+    }
+    #[cfg(target_arch = "x86_64")]
+    if valid && crate::memory::swap::disk_enabled() {
+        crate::memory::swap::prefault(ptr, len);
     }
+    valid
 }
 
 /// Read a null-terminated string from user memory (max 4096 bytes).
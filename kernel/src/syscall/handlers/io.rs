@@ -1,7 +1,8 @@
 //! File descriptor I/O syscall handlers.
 //!
 //! Covers FD-based operations: read, write, open, close, lseek, fstat,
-//! isatty, ftruncate, and POSIX FD duplication (pipe2, dup, dup2, fcntl).
+//! isatty, ftruncate, POSIX FD duplication (pipe2, dup, dup2, fcntl) and
+//! splice.
 
 use super::helpers::{fs_err, is_valid_user_ptr, read_user_str_safe, resolve_path};
 use crate::fs::permissions::{check_permission, PERM_CREATE};
@@ -35,9 +36,9 @@ pub fn sys_write(fd: u32, buf_ptr: u32, len: u32) -> u32 {
                 FdKind::PipeWrite { pipe_id } => {
                     if entry.flags.nonblock {
                         // O_NONBLOCK: return EAGAIN if no buffer space available
-                        use crate::ipc::anon_pipe::PIPE_BUF_SIZE;
-                        let avail = crate::ipc::anon_pipe::bytes_available(pipe_id);
-                        if avail >= PIPE_BUF_SIZE as u32 {
+                        if crate::ipc::anon_pipe::space_available(pipe_id) == 0
+                            && !crate::ipc::anon_pipe::is_read_closed(pipe_id)
+                        {
                             return u32::MAX - 10; // EAGAIN sentinel
                         }
                     }
@@ -56,7 +57,8 @@ pub fn sys_write(fd: u32, buf_ptr: u32, len: u32) -> u32 {
                     crate::drivers::serial::output_lock_release(lock_state);
                     len
                 }
-                FdKind::PipeRead { .. } | FdKind::None => u32::MAX,
+                FdKind::PipeRead { .. } | FdKind::PollSet { .. } | FdKind::IoRing { .. }
+                | FdKind::None => u32::MAX,
             }
         }
         None => {
@@ -126,7 +128,8 @@ pub fn sys_read(fd: u32, buf_ptr: u32, len: u32) -> u32 {
                         0 // no stdin
                     }
                 }
-                FdKind::PipeWrite { .. } | FdKind::None => u32::MAX,
+                FdKind::PipeWrite { .. } | FdKind::PollSet { .. } | FdKind::IoRing { .. }
+                | FdKind::None => u32::MAX,
             }
         }
         None => {
@@ -223,6 +226,14 @@ pub fn sys_close(fd: u32) -> u32 {
             crate::ipc::anon_pipe::decref_write(pipe_id);
             0
         }
+        Some(FdKind::PollSet { set_id }) => {
+            crate::ipc::poll_set::decref(set_id);
+            0
+        }
+        Some(FdKind::IoRing { ring_id }) => {
+            crate::ipc::io_ring::decref(ring_id);
+            0
+        }
         Some(FdKind::Tty) => {
             0 // Tty slot cleared, no resource to decref
         }
@@ -282,8 +293,9 @@ pub fn sys_fstat(fd: u32, buf_ptr: u32) -> u32 {
     let global_id = match crate::task::scheduler::current_fd_get(fd) {
         Some(entry) => match entry.kind {
             FdKind::File { global_id } => Some(global_id),
-            FdKind::PipeRead { .. } | FdKind::PipeWrite { .. } | FdKind::Tty => {
-                // Pipe/Tty FDs: report as character device, size 0
+            FdKind::PipeRead { .. } | FdKind::PipeWrite { .. } | FdKind::PollSet { .. }
+            | FdKind::IoRing { .. } | FdKind::Tty => {
+                // Pipe/Tty/wait-set FDs: report as character device, size 0
                 unsafe {
                     let buf = buf_ptr as *mut u32;
                     *buf = 2; // device
@@ -344,6 +356,7 @@ pub fn sys_isatty(fd: u32) -> u32 {
         Some(entry) => match entry.kind {
             FdKind::Tty => 1,
             FdKind::File { .. } | FdKind::PipeRead { .. } | FdKind::PipeWrite { .. } => 0,
+            FdKind::PollSet { .. } | FdKind::IoRing { .. } => 0,
             FdKind::None => 0,
         },
         None => {
@@ -379,6 +392,57 @@ pub fn sys_ftruncate(fd: u32, _length: u32) -> u32 {
     }
 }
 
+/// sys_flock - Take or release an advisory lock on an open file.
+/// arg1 = fd, arg2 = operation: LOCK_SH (1) or LOCK_EX (2), optionally
+/// | LOCK_NB (4), or LOCK_UN (8).  Returns 0 on success, EAGAIN
+/// (`u32::MAX - 10`) if LOCK_NB was given and the file is locked.
+pub fn sys_flock(fd: u32, op: u32) -> u32 {
+    use crate::fs::fd_table::FdKind;
+    use crate::fs::file_lock::{self, LOCK_EX, LOCK_NB, LOCK_SH, LOCK_UN};
+    let global_id = match crate::task::scheduler::current_fd_get(fd) {
+        Some(entry) => match entry.kind {
+            FdKind::File { global_id } => global_id,
+            _ => return u32::MAX,
+        },
+        None => return u32::MAX,
+    };
+    let exclusive = match op & !LOCK_NB {
+        LOCK_UN => {
+            file_lock::unlock(global_id);
+            return 0;
+        }
+        LOCK_SH => false,
+        LOCK_EX => true,
+        _ => return u32::MAX,
+    };
+    let key = match crate::fs::vfs::lock_key(global_id) {
+        Ok(key) => key,
+        Err(e) => return fs_err(e),
+    };
+    match file_lock::lock(global_id, key, exclusive, op & LOCK_NB == 0) {
+        Ok(()) => 0,
+        Err(file_lock::LockError::WouldBlock) => u32::MAX - 10, // EAGAIN sentinel
+    }
+}
+
+/// sys_fsync - Write buffered data of the file's filesystem to disk.
+/// arg1 = fd.  Returns 0 on success.
+pub fn sys_fsync(fd: u32) -> u32 {
+    use crate::fs::fd_table::FdKind;
+    let global_id = match crate::task::scheduler::current_fd_get(fd) {
+        Some(entry) => match entry.kind {
+            FdKind::File { global_id } => global_id,
+            // Pipes, sockets and terminals have nothing to flush.
+            _ => return 0,
+        },
+        None => return u32::MAX,
+    };
+    match crate::fs::vfs::fsync(global_id) {
+        Ok(()) => 0,
+        Err(e) => fs_err(e),
+    }
+}
+
 /// sys_pipe2 - Create an anonymous pipe.
 /// arg1 = user pointer to int[2] (receives [read_fd, write_fd]).
 /// arg2 = flags (O_CLOEXEC = 0x10).
@@ -503,6 +567,8 @@ pub fn sys_fcntl(fd: u32, cmd: u32, arg: u32) -> u32 {
     const F_GETFL: u32 = 3;
     const F_SETFL: u32 = 4;
     const F_DUPFD_CLOEXEC: u32 = 1030;
+    const F_SETPIPE_SZ: u32 = 1031;
+    const F_GETPIPE_SZ: u32 = 1032;
     const FD_CLOEXEC: u32 = 1;
 
     match cmd {
@@ -549,10 +615,119 @@ pub fn sys_fcntl(fd: u32, cmd: u32, arg: u32) -> u32 {
             crate::task::scheduler::current_fd_set_nonblock(fd, (arg & O_NONBLOCK) != 0);
             0
         }
+        F_SETPIPE_SZ | F_GETPIPE_SZ => {
+            use crate::fs::fd_table::FdKind;
+            let pipe_id = match crate::task::scheduler::current_fd_get(fd).map(|e| e.kind) {
+                Some(FdKind::PipeRead { pipe_id }) | Some(FdKind::PipeWrite { pipe_id }) => pipe_id,
+                _ => return u32::MAX,
+            };
+            if cmd == F_GETPIPE_SZ {
+                crate::ipc::anon_pipe::capacity(pipe_id)
+            } else {
+                crate::ipc::anon_pipe::set_capacity(pipe_id, arg as usize).unwrap_or(u32::MAX)
+            }
+        }
         _ => u32::MAX,
     }
 }
 
+/// Flag in sys_splice's flags: `fd_in` is a TCP socket id, not an FD.
+const SPLICE_SOCKET_IN: u32 = 1 << 0;
+/// Flag in sys_splice's flags: `fd_out` is a TCP socket id, not an FD.
+const SPLICE_SOCKET_OUT: u32 = 1 << 1;
+
+/// Endpoint of a splice that is not the pipe.
+#[derive(Clone, Copy)]
+enum SpliceEnd {
+    File(u32),
+    Socket(u32),
+}
+
+/// sys_splice - Move data between a pipe and a file or TCP socket in the
+/// kernel, without a user-space buffer.
+/// arg1=fd_in, arg2=fd_out, arg3=len, arg4=flags (SPLICE_SOCKET_IN /
+/// SPLICE_SOCKET_OUT: the matching end is a TCP socket id).
+/// Exactly one end must be an anonymous pipe.  Files are read or written
+/// at, and advance, their current position.
+/// Returns bytes moved, 0 at EOF, or u32::MAX on error.
+pub fn sys_splice(fd_in: u32, fd_out: u32, len: u32, flags: u32) -> u32 {
+    use crate::fs::fd_table::FdKind;
+    use crate::ipc::anon_pipe;
+
+    if len == 0 {
+        return 0;
+    }
+    if flags & (SPLICE_SOCKET_IN | SPLICE_SOCKET_OUT) != 0 {
+        use crate::task::capabilities::CAP_NETWORK;
+        if crate::task::scheduler::current_thread_capabilities() & CAP_NETWORK == 0 {
+            return u32::MAX;
+        }
+    }
+    let kind = |fd: u32| crate::task::scheduler::current_fd_get(fd).map(|e| e.kind);
+    let end = |fd: u32, socket: bool| {
+        if socket {
+            return Some(SpliceEnd::Socket(fd));
+        }
+        match kind(fd) {
+            Some(FdKind::File { global_id }) => Some(SpliceEnd::File(global_id)),
+            _ => None,
+        }
+    };
+
+    let pipe_in = if flags & SPLICE_SOCKET_IN == 0 {
+        match kind(fd_in) {
+            Some(FdKind::PipeRead { pipe_id }) => Some(pipe_id),
+            _ => None,
+        }
+    } else {
+        None
+    };
+    let pipe_out = if flags & SPLICE_SOCKET_OUT == 0 {
+        match kind(fd_out) {
+            Some(FdKind::PipeWrite { pipe_id }) => Some(pipe_id),
+            _ => None,
+        }
+    } else {
+        None
+    };
+
+    let moved = match (pipe_in, pipe_out) {
+        // pipe -> file / socket
+        (Some(pipe_id), None) => {
+            let sink = match end(fd_out, flags & SPLICE_SOCKET_OUT != 0) {
+                Some(s) => s,
+                None => return u32::MAX,
+            };
+            anon_pipe::splice_out(pipe_id, len as usize, |data| match sink {
+                SpliceEnd::File(file) => crate::fs::vfs::write(file, data).ok(),
+                SpliceEnd::Socket(sock) => match crate::net::tcp::send(sock, data, 1000) {
+                    u32::MAX => None,
+                    n => Some(n as usize),
+                },
+            })
+        }
+        // file / socket -> pipe
+        (None, Some(pipe_id)) => {
+            let source = match end(fd_in, flags & SPLICE_SOCKET_IN != 0) {
+                Some(s) => s,
+                None => return u32::MAX,
+            };
+            anon_pipe::splice_in(pipe_id, len as usize, |buf| match source {
+                SpliceEnd::File(file) => crate::fs::vfs::read(file, buf).ok(),
+                SpliceEnd::Socket(sock) => match crate::net::tcp::recv(sock, buf, 3000) {
+                    u32::MAX => None,
+                    n => Some(n as usize),
+                },
+            })
+        }
+        _ => return u32::MAX,
+    };
+    if moved != u32::MAX {
+        crate::task::scheduler::record_io_read(moved as u64);
+    }
+    moved
+}
+
 /// Increment the reference count for an FdKind resource.
 fn incref_fd_kind(kind: crate::fs::fd_table::FdKind) {
     use crate::fs::fd_table::FdKind;
@@ -560,6 +735,8 @@ fn incref_fd_kind(kind: crate::fs::fd_table::FdKind) {
         FdKind::File { global_id } => crate::fs::vfs::incref(global_id),
         FdKind::PipeRead { pipe_id } => crate::ipc::anon_pipe::incref_read(pipe_id),
         FdKind::PipeWrite { pipe_id } => crate::ipc::anon_pipe::incref_write(pipe_id),
+        FdKind::PollSet { set_id } => crate::ipc::poll_set::incref(set_id),
+        FdKind::IoRing { ring_id } => crate::ipc::io_ring::incref(ring_id),
         FdKind::Tty | FdKind::None => {}
     }
 }
@@ -571,6 +748,8 @@ fn decref_fd_kind(kind: crate::fs::fd_table::FdKind) {
         FdKind::File { global_id } => crate::fs::vfs::decref(global_id),
         FdKind::PipeRead { pipe_id } => crate::ipc::anon_pipe::decref_read(pipe_id),
         FdKind::PipeWrite { pipe_id } => crate::ipc::anon_pipe::decref_write(pipe_id),
+        FdKind::PollSet { set_id } => crate::ipc::poll_set::decref(set_id),
+        FdKind::IoRing { ring_id } => crate::ipc::io_ring::decref(ring_id),
         FdKind::Tty | FdKind::None => {}
     }
 }
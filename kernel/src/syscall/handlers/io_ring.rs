@@ -0,0 +1,333 @@
+//! Asynchronous I/O ring syscall handlers.
+//!
+//! Covers io_ring_setup and io_ring_enter.  The ring memory is ordinary user
+//! memory laid out as a 32-byte header, `sq_entries` 40-byte submission
+//! entries (SQEs) and `cq_entries` 16-byte completion entries (CQEs); see
+//! docs/syscalls.md.  The kernel reads SQEs and writes CQEs only inside
+//! io_ring_enter, in the owning address space; `ipc::io_ring` runs the work.
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, Ordering};
+use crate::fs::fd_table::FdKind;
+use crate::ipc::io_ring::{self, Op, Output, Region};
+use super::filesystem::write_stat;
+use super::helpers::{fs_err, is_valid_user_ptr, read_user_str_safe, resolve_path};
+
+/// Largest ring accepted by io_ring_setup (submission entries).
+const MAX_ENTRIES: u32 = 256;
+/// Largest READ / WRITE / TCP_SEND / TCP_RECV transfer per entry.
+const MAX_IO_LEN: u32 = 1024 * 1024;
+
+const HEADER_SIZE: u64 = 32;
+const SQE_SIZE: u64 = 40;
+const CQE_SIZE: u64 = 16;
+/// Size of the STAT output buffer (see `write_stat`).
+const STAT_SIZE: u64 = 28;
+
+// Header word offsets (u32 units).
+const SQ_HEAD: usize = 0;
+const SQ_TAIL: usize = 1;
+const CQ_HEAD: usize = 2;
+const CQ_TAIL: usize = 3;
+const SQ_ENTRIES: usize = 4;
+const CQ_ENTRIES: usize = 5;
+
+const OP_OPEN: u8 = 1;
+const OP_READ: u8 = 2;
+const OP_WRITE: u8 = 3;
+const OP_STAT: u8 = 4;
+const OP_CLOSE: u8 = 5;
+const OP_TCP_SEND: u8 = 6;
+const OP_TCP_RECV: u8 = 7;
+
+const EBADF: u32 = (-9i32) as u32;
+const EFAULT: u32 = (-14i32) as u32;
+const EINVAL: u32 = (-22i32) as u32;
+const EPERM: u32 = (-1i32) as u32;
+
+/// Submission entry as laid out in ring memory.
+struct Sqe {
+    opcode: u8,
+    fd: u32,
+    addr: u64,
+    addr2: u64,
+    len: u32,
+    op_flags: u32,
+    user_data: u64,
+}
+
+fn region_size(sq_entries: u32, cq_entries: u32) -> u64 {
+    HEADER_SIZE + sq_entries as u64 * SQE_SIZE + cq_entries as u64 * CQE_SIZE
+}
+
+/// Header word `idx` of the ring at `base`, shared with user space.
+fn header(base: u64, idx: usize) -> &'static AtomicU32 {
+    unsafe { &*((base as *const AtomicU32).add(idx)) }
+}
+
+fn read_sqe(region: &Region, index: u32) -> Sqe {
+    let p = region.addr + HEADER_SIZE + (index & (region.sq_entries - 1)) as u64 * SQE_SIZE;
+    unsafe {
+        Sqe {
+            opcode: core::ptr::read_volatile(p as *const u8),
+            fd: core::ptr::read_volatile((p + 4) as *const u32),
+            addr: core::ptr::read_volatile((p + 8) as *const u64),
+            addr2: core::ptr::read_volatile((p + 16) as *const u64),
+            len: core::ptr::read_volatile((p + 24) as *const u32),
+            op_flags: core::ptr::read_volatile((p + 28) as *const u32),
+            user_data: core::ptr::read_volatile((p + 32) as *const u64),
+        }
+    }
+}
+
+/// sys_io_ring_setup - Create an I/O ring over user memory.
+/// arg1=sq_entries (power of two, 1..=256), arg2=region_ptr, arg3=region_len.
+/// The completion queue gets 2 * sq_entries entries; the region must hold
+/// 32 + sq_entries*40 + cq_entries*16 bytes.  The kernel initializes the header.
+/// Returns an fd for io_ring_enter / poll sets, or u32::MAX on error.
+pub fn sys_io_ring_setup(sq_entries: u32, region_ptr: u32, region_len: u32) -> u32 {
+    if sq_entries == 0 || sq_entries > MAX_ENTRIES || !sq_entries.is_power_of_two() {
+        return u32::MAX;
+    }
+    let cq_entries = sq_entries * 2;
+    let needed = region_size(sq_entries, cq_entries);
+    let base = region_ptr as u64;
+    if (region_len as u64) < needed || base & 7 != 0 || !is_valid_user_ptr(base, needed) {
+        return u32::MAX;
+    }
+    let pd = match crate::task::scheduler::current_thread_page_directory() {
+        Some(pd) => pd.as_u64(),
+        None => return u32::MAX,
+    };
+    unsafe {
+        core::ptr::write_bytes(base as *mut u8, 0, HEADER_SIZE as usize);
+    }
+    header(base, SQ_ENTRIES).store(sq_entries, Ordering::Relaxed);
+    header(base, CQ_ENTRIES).store(cq_entries, Ordering::Release);
+
+    let ring_id = io_ring::create(Region { addr: base, sq_entries, cq_entries }, pd);
+    match crate::task::scheduler::current_fd_alloc(FdKind::IoRing { ring_id }) {
+        Some(fd) => fd,
+        None => {
+            io_ring::decref(ring_id);
+            u32::MAX
+        }
+    }
+}
+
+/// sys_io_ring_enter - Post finished operations, submit new ones, and
+/// optionally wait.
+/// arg1=fd, arg2=to_submit (max SQEs to consume), arg3=min_complete (CQEs to
+/// wait for), arg4=timeout_ms (u32::MAX = no timeout).
+/// Completions are written to the CQ only during this call; with
+/// min_complete = 0 it never blocks.
+/// Returns the number of SQEs consumed, or u32::MAX on error.
+pub fn sys_io_ring_enter(fd: u32, to_submit: u32, min_complete: u32, timeout_ms: u32) -> u32 {
+    let ring_id = match crate::task::scheduler::current_fd_get(fd).map(|e| e.kind) {
+        Some(FdKind::IoRing { ring_id }) => ring_id,
+        _ => return u32::MAX,
+    };
+    let pd = match crate::task::scheduler::current_thread_page_directory() {
+        Some(pd) => pd.as_u64(),
+        None => return u32::MAX,
+    };
+    let region = match io_ring::region(ring_id, pd) {
+        Some(r) => r,
+        None => return u32::MAX,
+    };
+    if !is_valid_user_ptr(region.addr, region_size(region.sq_entries, region.cq_entries)) {
+        return u32::MAX;
+    }
+
+    let posted = post_completions(ring_id, &region);
+
+    let mut head = header(region.addr, SQ_HEAD).load(Ordering::Relaxed);
+    let tail = header(region.addr, SQ_TAIL).load(Ordering::Acquire);
+    let pending = tail.wrapping_sub(head).min(region.sq_entries);
+    let mut submitted = 0;
+    while submitted < to_submit.min(pending) {
+        if !io_ring::reserve(ring_id) {
+            break; // CQ would overflow; caller must reap first
+        }
+        let sqe = read_sqe(&region, head);
+        submit(ring_id, &sqe);
+        head = head.wrapping_add(1);
+        submitted += 1;
+    }
+    header(region.addr, SQ_HEAD).store(head, Ordering::Release);
+
+    if min_complete > posted {
+        io_ring::wait(ring_id, min_complete - posted, timeout_ms);
+        post_completions(ring_id, &region);
+    }
+    submitted
+}
+
+/// Validate `sqe` in the submitter's context and hand it to the workers, or
+/// complete it at once if it fails validation or needs no worker.
+fn submit(ring_id: u32, sqe: &Sqe) {
+    let mut addr = sqe.addr;
+    let op = match sqe.opcode {
+        OP_OPEN => user_path(sqe.addr).map(|path| {
+            let flags = sqe.op_flags;
+            Op::Open {
+                path,
+                flags: crate::fs::file::FileFlags {
+                    read: true,
+                    write: (flags & 1) != 0,
+                    append: (flags & 2) != 0,
+                    create: (flags & 4) != 0,
+                    truncate: (flags & 8) != 0,
+                },
+                cloexec: (flags & 0x10) != 0, // O_CLOEXEC
+                uid: crate::task::scheduler::current_thread_uid(),
+                gid: crate::task::scheduler::current_thread_gid(),
+            }
+        }),
+        OP_READ | OP_WRITE => file_of(sqe.fd).and_then(|file| {
+            let len = sqe.len.min(MAX_IO_LEN) as usize;
+            if len > 0 && !is_valid_user_ptr(sqe.addr, len as u64) {
+                return Err(EFAULT);
+            }
+            crate::fs::vfs::incref(file);
+            Ok(if sqe.opcode == OP_READ {
+                Op::Read { file, len }
+            } else {
+                Op::Write { file, data: user_bytes(sqe.addr, len) }
+            })
+        }),
+        OP_STAT => {
+            addr = sqe.addr2;
+            if is_valid_user_ptr(sqe.addr2, STAT_SIZE) {
+                user_path(sqe.addr).map(|path| Op::Stat { path })
+            } else {
+                Err(EFAULT)
+            }
+        }
+        OP_CLOSE => match crate::task::scheduler::current_fd_get(sqe.fd).map(|e| e.kind) {
+            Some(FdKind::File { .. }) => match crate::task::scheduler::current_fd_close(sqe.fd) {
+                Some(FdKind::File { global_id }) => Ok(Op::Close { file: global_id }),
+                _ => Err(EBADF),
+            },
+            // Pipes, wait sets, rings: nothing to do off-thread
+            Some(_) => Err(super::sys_close(sqe.fd)),
+            None => Err(EBADF),
+        },
+        OP_TCP_SEND | OP_TCP_RECV => {
+            use crate::task::capabilities::CAP_NETWORK;
+            let len = sqe.len.min(MAX_IO_LEN) as usize;
+            if crate::task::scheduler::current_thread_capabilities() & CAP_NETWORK == 0 {
+                Err(EPERM)
+            } else if len == 0 || !is_valid_user_ptr(sqe.addr, len as u64) {
+                Err(EFAULT)
+            } else if sqe.opcode == OP_TCP_SEND {
+                Ok(Op::TcpSend {
+                    socket: sqe.fd,
+                    data: user_bytes(sqe.addr, len),
+                    timeout_ticks: timeout_ticks(sqe.op_flags, 1000),
+                })
+            } else {
+                Ok(Op::TcpRecv {
+                    socket: sqe.fd,
+                    len,
+                    timeout_ticks: timeout_ticks(sqe.op_flags, 3000),
+                })
+            }
+        }
+        _ => Err(EINVAL),
+    };
+    match op {
+        Ok(op) => io_ring::submit(ring_id, sqe.user_data, addr, op),
+        Err(code) => io_ring::complete(ring_id, sqe.user_data, addr, Output::Code(code)),
+    }
+}
+
+/// Write finished operations to the CQ until it is full.  Returns the count.
+fn post_completions(ring_id: u32, region: &Region) -> u32 {
+    let mut tail = header(region.addr, CQ_TAIL).load(Ordering::Relaxed);
+    let mut posted = 0;
+    loop {
+        let head = header(region.addr, CQ_HEAD).load(Ordering::Acquire);
+        if tail.wrapping_sub(head) >= region.cq_entries {
+            break;
+        }
+        let c = match io_ring::take_completion(ring_id) {
+            Some(c) => c,
+            None => break,
+        };
+        let result = match c.output {
+            Output::Code(n) => n,
+            Output::Fs(e) => fs_err(e),
+            Output::Data(buf) => {
+                if !buf.is_empty() {
+                    unsafe {
+                        core::ptr::copy_nonoverlapping(buf.as_ptr(), c.addr as *mut u8, buf.len());
+                    }
+                }
+                buf.len() as u32
+            }
+            Output::Stat(st) => {
+                write_stat(c.addr, &st);
+                0
+            }
+            Output::Opened { file, cloexec } => {
+                match crate::task::scheduler::current_fd_alloc(FdKind::File { global_id: file }) {
+                    Some(fd) => {
+                        if cloexec {
+                            crate::task::scheduler::current_fd_set_cloexec(fd, true);
+                        }
+                        fd
+                    }
+                    None => {
+                        crate::fs::vfs::decref(file);
+                        u32::MAX
+                    }
+                }
+            }
+        };
+        let cqe = region.addr + HEADER_SIZE + region.sq_entries as u64 * SQE_SIZE
+            + (tail & (region.cq_entries - 1)) as u64 * CQE_SIZE;
+        unsafe {
+            core::ptr::write_volatile(cqe as *mut u64, c.user_data);
+            core::ptr::write_volatile((cqe + 8) as *mut u32, result);
+            core::ptr::write_volatile((cqe + 12) as *mut u32, 0);
+        }
+        tail = tail.wrapping_add(1);
+        header(region.addr, CQ_TAIL).store(tail, Ordering::Release);
+        posted += 1;
+    }
+    posted
+}
+
+/// Global VFS slot of a file fd.
+fn file_of(fd: u32) -> Result<u32, u32> {
+    match crate::task::scheduler::current_fd_get(fd).map(|e| e.kind) {
+        Some(FdKind::File { global_id }) => Ok(global_id),
+        _ => Err(EBADF),
+    }
+}
+
+/// Absolute path from a NUL-terminated user string.
+fn user_path(ptr: u64) -> Result<alloc::string::String, u32> {
+    if ptr > u32::MAX as u64 {
+        return Err(EFAULT);
+    }
+    read_user_str_safe(ptr as u32).map(resolve_path).ok_or(EFAULT)
+}
+
+/// Copy `len` bytes of validated user memory into a kernel buffer.
+fn user_bytes(ptr: u64, len: usize) -> Vec<u8> {
+    if len == 0 {
+        return Vec::new();
+    }
+    unsafe { core::slice::from_raw_parts(ptr as *const u8, len) }.to_vec()
+}
+
+/// SQE timeout in ms to PIT ticks; 0 selects the blocking syscall's default.
+fn timeout_ticks(ms: u32, default_ticks: u32) -> u32 {
+    if ms == 0 {
+        return default_ticks;
+    }
+    let hz = crate::arch::hal::timer_frequency_hz() as u64;
+    ((ms as u64 * hz / 1000) as u32).max(1)
+}
@@ -1,11 +1,13 @@
 //! Inter-process communication syscall handlers.
 //!
 //! Covers named pipes, the event bus (system + channel events),
-//! shared memory, and compositor wake helper.
+//! shared memory, futexes, readiness wait sets, and compositor wake helper.
 
 use super::helpers::{is_valid_user_ptr, read_user_str};
 
 use crate::ipc::event_bus::{self, EventData};
+use crate::ipc::poll_set;
+use alloc::vec::Vec;
 use core::sync::atomic::Ordering;
 
 // =========================================================================
@@ -165,41 +167,46 @@ pub fn sys_evt_chan_emit_to(chan_id: u32, sub_id: u32, event_ptr: u32) -> u32 {
 /// Block until an event is available on a channel subscription, or timeout.
 ///
 /// Returns 1 if events are available, 0 on timeout/spurious wake.
-/// `timeout_ms` = `u32::MAX` means wait indefinitely (capped at 60s safety net).
+/// `timeout_ms` = `u32::MAX` means wait indefinitely.
 pub fn sys_evt_chan_wait(chan_id: u32, sub_id: u32, timeout_ms: u32) -> u32 {
-    // Fast path: events already queued — return immediately.
-    if event_bus::channel_has_events(chan_id, sub_id) {
-        return 1;
-    }
-
-    let tid = crate::task::scheduler::current_tid();
-
-    // Register this thread as a waiter on the subscription.
-    // Returns false if events arrived between our check and the registration.
-    if !event_bus::channel_register_waiter(chan_id, sub_id, tid) {
-        return 1; // Events arrived — don't block
-    }
-
-    // Compute wake tick. Cap indefinite waits at 60 seconds as safety net.
-    let effective_ms = if timeout_ms == u32::MAX { 60_000 } else { timeout_ms };
-    let pit_hz = crate::arch::hal::timer_frequency_hz() as u32;
-    let ticks = (effective_ms as u64 * pit_hz as u64 / 1000) as u32;
-    let ticks = if ticks == 0 { 1 } else { ticks };
-    let now = crate::arch::hal::timer_current_ticks();
-    let wake_at = now.wrapping_add(ticks);
+    let wake_at = if timeout_ms == u32::MAX {
+        None
+    } else {
+        let pit_hz = crate::arch::hal::timer_frequency_hz() as u32;
+        let ticks = (timeout_ms as u64 * pit_hz as u64 / 1000) as u32;
+        let ticks = if ticks == 0 { 1 } else { ticks };
+        Some(crate::arch::hal::timer_current_ticks().wrapping_add(ticks))
+    };
 
-    // Block — thread sleeps until: emit wakes us, input IRQ wakes us, or timeout.
-    crate::task::scheduler::sleep_until(wake_at);
+    // Sleeps until: emit wakes us, input IRQ wakes us (compositor), or timeout.
+    // A spurious or foreign wake returns 0 — caller should check all event sources.
+    if event_bus::channel_wait(chan_id, sub_id, wake_at) { 1 } else { 0 }
+}
 
-    // Clean up waiter registration (may already be cleared by emit).
-    event_bus::channel_unregister_waiter(chan_id, sub_id);
+/// Most events returned by one sys_evt_chan_poll_batch call.
+const EVT_BATCH_MAX: usize = 64;
 
-    // Check if events are available (handles spurious wakes gracefully).
-    if event_bus::channel_has_events(chan_id, sub_id) {
-        1
-    } else {
-        0 // Timeout or spurious wake — caller should check all event sources
+/// Drain up to `max` events from a channel subscription.
+/// ebx=chan_id, r10=sub_id, rdx=buf_ptr (max * 20 bytes), r8=max.
+/// Returns the number of events stored.
+pub fn sys_evt_chan_poll_batch(chan_id: u32, sub_id: u32, buf_ptr: u32, max: u32) -> u32 {
+    let max = (max as usize).min(EVT_BATCH_MAX);
+    if max == 0 || !is_valid_user_ptr(buf_ptr as u64, (max * 20) as u64) {
+        return 0;
+    }
+    let mut events = [EventData { words: [0; 5] }; EVT_BATCH_MAX];
+    let n = event_bus::channel_poll_batch(chan_id, sub_id, &mut events[..max]);
+    let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut [u32; 5], n) };
+    for (dst, ev) in buf.iter_mut().zip(&events[..n]) {
+        *dst = ev.words;
     }
+    n as u32
+}
+
+/// Map a channel subscription's event ring into the caller. ebx=chan_id,
+/// r10=sub_id. Returns the ring's address, or 0 on failure (keep polling).
+pub fn sys_evt_chan_ring(chan_id: u32, sub_id: u32) -> u32 {
+    event_bus::channel_attach_ring(chan_id, sub_id) as u32
 }
 
 /// Wake the compositor's management thread if it is blocked.
@@ -225,7 +232,8 @@ pub fn wake_compositor_if_blocked() {
 }
 
 // =========================================================================
-// Shared memory (SYS_SHM_CREATE, SYS_SHM_MAP, SYS_SHM_UNMAP, SYS_SHM_DESTROY)
+// Shared memory (SYS_SHM_CREATE, SYS_SHM_MAP, SYS_SHM_UNMAP, SYS_SHM_DESTROY,
+// SYS_SHM_GRANT, SYS_SHM_CLAIM)
 // =========================================================================
 
 /// Create a shared memory region. ebx=size (bytes, rounded up to page).
@@ -241,12 +249,19 @@ pub fn sys_shm_create(size: u32) -> u32 {
 /// Map a shared memory region into the caller's address space.
 /// ebx=shm_id. Returns virtual address (u32) or 0 on failure.
 pub fn sys_shm_map(shm_id: u32) -> u32 {
+    // Kernel-owned regions (event rings) are mapped only by their subsystem
+    if crate::ipc::shared_memory::is_kernel_owned(shm_id) {
+        return 0;
+    }
     crate::ipc::shared_memory::map_into_current(shm_id) as u32
 }
 
 /// Unmap a shared memory region from the caller's address space.
 /// ebx=shm_id. Returns 0 on success, u32::MAX on failure.
 pub fn sys_shm_unmap(shm_id: u32) -> u32 {
+    if crate::ipc::shared_memory::is_kernel_owned(shm_id) {
+        return u32::MAX;
+    }
     if crate::ipc::shared_memory::unmap_from_current(shm_id) {
         0
     } else {
@@ -264,3 +279,122 @@ pub fn sys_shm_destroy(shm_id: u32) -> u32 {
         u32::MAX
     }
 }
+
+/// Hand a region over to the next process that claims it (owner only).
+/// ebx=shm_id. Unmaps it from the caller. Returns 0 on success, u32::MAX on
+/// failure.
+pub fn sys_shm_grant(shm_id: u32) -> u32 {
+    let tid = crate::task::scheduler::current_tid();
+    if crate::ipc::shared_memory::grant(shm_id, tid) {
+        0
+    } else {
+        u32::MAX
+    }
+}
+
+/// Take ownership of a granted region and map it. ebx=shm_id.
+/// Returns virtual address (u32) or 0 if the region is not granted.
+pub fn sys_shm_claim(shm_id: u32) -> u32 {
+    crate::ipc::shared_memory::claim(shm_id) as u32
+}
+
+// =========================================================================
+// Futexes (SYS_FUTEX_*)
+// =========================================================================
+
+/// sys_futex_wait - Sleep while the u32 at `uaddr` equals `expected`.
+/// arg3 = timeout in ms (u32::MAX = forever). Returns 0 when woken,
+/// EAGAIN (-11) on value mismatch, ETIMEDOUT (-110), or u32::MAX on a bad address.
+pub fn sys_futex_wait(uaddr: u32, expected: u32, timeout_ms: u32) -> u32 {
+    crate::ipc::futex::wait(uaddr as u64, expected, timeout_ms)
+}
+
+/// sys_futex_wake - Wake up to `count` waiters on `uaddr`.
+/// Returns the number woken, or u32::MAX on a bad address.
+pub fn sys_futex_wake(uaddr: u32, count: u32) -> u32 {
+    crate::ipc::futex::wake(uaddr as u64, count)
+}
+
+// =========================================================================
+// Readiness wait sets (SYS_POLL_*)
+// =========================================================================
+
+/// Most items a single SYS_POLL_WAIT call accepts.
+const POLL_MAX_ITEMS: u32 = 1024;
+
+/// sys_poll_create - Create an empty wait set. Returns its fd, or u32::MAX.
+pub fn sys_poll_create() -> u32 {
+    use crate::fs::fd_table::FdKind;
+    let set_id = poll_set::create();
+    match crate::task::scheduler::current_fd_alloc(FdKind::PollSet { set_id }) {
+        Some(fd) => fd,
+        None => {
+            poll_set::decref(set_id);
+            u32::MAX
+        }
+    }
+}
+
+/// sys_poll_ctl - Add (1), modify (2) or remove (3) an interest.
+/// arg1=set fd, arg2=op, arg3=item_ptr (24-byte PollItem).
+/// Returns 0 on success, u32::MAX on failure.
+pub fn sys_poll_ctl(fd: u32, op: u32, item_ptr: u32) -> u32 {
+    let set_id = match poll_set_of(fd) {
+        Some(id) => id,
+        None => return u32::MAX,
+    };
+    if !is_valid_user_ptr(item_ptr as u64, poll_set::ITEM_SIZE as u64) {
+        return u32::MAX;
+    }
+    let raw = unsafe { core::slice::from_raw_parts(item_ptr as *const u8, poll_set::ITEM_SIZE) };
+    if poll_set::ctl(set_id, op, poll_set::PollItem::read(raw)) { 0 } else { u32::MAX }
+}
+
+/// sys_poll_wait - Wait for readiness. arg3=item count, arg4=timeout in ms
+/// (u32::MAX = forever).
+/// - arg1=set fd: up to arg3 ready items are stored at arg2.
+/// - arg1=u32::MAX: arg2 holds arg3 interests, waited on once; `revents` is
+///   filled in place (poll(2) semantics).
+/// Returns the number of ready items (0 on timeout), or u32::MAX on error.
+pub fn sys_poll_wait(fd: u32, items_ptr: u32, count: u32, timeout_ms: u32) -> u32 {
+    if count > POLL_MAX_ITEMS {
+        return u32::MAX;
+    }
+    let len = count as usize * poll_set::ITEM_SIZE;
+    if count > 0 && !is_valid_user_ptr(items_ptr as u64, len as u64) {
+        return u32::MAX;
+    }
+    // Work on a kernel copy: the wait blocks, and resolving fds takes locks.
+    let mut items: Vec<poll_set::PollItem> = Vec::with_capacity(count as usize);
+    if count > 0 {
+        let raw = unsafe { core::slice::from_raw_parts(items_ptr as *const u8, len) };
+        items.extend(raw.chunks_exact(poll_set::ITEM_SIZE).map(poll_set::PollItem::read));
+    }
+    let n = if fd == u32::MAX {
+        poll_set::wait_oneshot(&mut items, timeout_ms)
+    } else {
+        let set_id = match poll_set_of(fd) {
+            Some(id) => id,
+            None => return u32::MAX,
+        };
+        match poll_set::wait(set_id, &mut items, timeout_ms) {
+            Some(n) => n,
+            None => return u32::MAX,
+        }
+    };
+    let written = if fd == u32::MAX { items.len() } else { n };
+    if written > 0 {
+        let raw = unsafe { core::slice::from_raw_parts_mut(items_ptr as *mut u8, len) };
+        for (item, chunk) in items[..written].iter().zip(raw.chunks_exact_mut(poll_set::ITEM_SIZE)) {
+            item.write(chunk);
+        }
+    }
+    n as u32
+}
+
+fn poll_set_of(fd: u32) -> Option<u32> {
+    match crate::task::scheduler::current_fd_get(fd)?.kind {
+        crate::fs::fd_table::FdKind::PollSet { set_id } => Some(set_id),
+        _ => None,
+    }
+}
@@ -7,6 +7,7 @@
 mod helpers;
 mod process;
 mod io;
+mod io_ring;
 mod filesystem;
 mod net;
 mod ipc;
@@ -20,6 +21,7 @@ mod debug;
 
 pub use process::*;
 pub use io::*;
+pub use io_ring::*;
 pub use filesystem::*;
 pub use net::*;
 pub use ipc::*;
@@ -19,7 +19,7 @@ pub fn sys_net_config(cmd: u32, buf_ptr: u32) -> u32 {
             if buf_ptr == 0 { return u32::MAX; }
             let cfg = crate::net::config();
             #[cfg(target_arch = "x86_64")]
-            let link_up = crate::drivers::network::e1000::is_link_up();
+            let link_up = crate::drivers::network::is_link_up();
             #[cfg(target_arch = "aarch64")]
             let link_up = false;
             unsafe {
@@ -54,26 +54,26 @@ pub fn sys_net_config(cmd: u32, buf_ptr: u32) -> u32 {
         2 => {
             // Disable NIC
             #[cfg(target_arch = "x86_64")]
-            crate::drivers::network::e1000::set_enabled(false);
+            crate::drivers::network::set_enabled(false);
             0
         }
         3 => {
             // Enable NIC
             #[cfg(target_arch = "x86_64")]
-            crate::drivers::network::e1000::set_enabled(true);
+            crate::drivers::network::set_enabled(true);
             0
         }
         4 => {
             // Query enabled state
             #[cfg(target_arch = "x86_64")]
-            { if crate::drivers::network::e1000::is_enabled() { 1 } else { 0 } }
+            { if crate::drivers::network::is_enabled() { 1 } else { 0 } }
             #[cfg(target_arch = "aarch64")]
             { 0 }
         }
         5 => {
             // Query hardware availability
             #[cfg(target_arch = "x86_64")]
-            { if crate::drivers::network::e1000::is_available() { 1 } else { 0 } }
+            { if crate::drivers::network::is_available() { 1 } else { 0 } }
             #[cfg(target_arch = "aarch64")]
             { 0 }
         }
@@ -202,6 +202,87 @@ pub fn sys_tcp_send(socket_id: u32, buf_ptr: u32, len: u32) -> u32 {
     crate::net::tcp::send(socket_id, buf, 1000) // 10s timeout
 }
 
+/// File bytes staged per batch of segments in [`sys_sendfile`].
+const SENDFILE_STAGE: usize = crate::net::tcp::tcb::SEND_BATCH_SIZE * crate::net::tcp::tcb::MSS;
+
+/// Open file feeding a TCP stream through a kernel staging buffer that
+/// is refilled from the page cache as the send window advances.
+struct FileSource {
+    /// Global VFS slot of the file.
+    file: u32,
+    /// File offset of stream byte 0.
+    start: u32,
+    stage: alloc::vec::Vec<u8>,
+    /// Stream offset of `stage[0]`.
+    base: usize,
+    /// Valid bytes in `stage`.
+    filled: usize,
+}
+
+impl crate::net::tcp::SendSource for FileSource {
+    fn prepare(&mut self, offset: usize, max: usize) -> usize {
+        let want = max.min(self.stage.len());
+        if offset < self.base || offset > self.base + self.filled {
+            self.base = offset;
+            self.filled = 0;
+        } else if offset + want > self.base + self.filled {
+            // Keep the staged tail, top up behind it
+            let keep = offset - self.base;
+            self.stage.copy_within(keep..self.filled, 0);
+            self.filled -= keep;
+            self.base = offset;
+        }
+        while self.filled < want {
+            let pos = self.start as usize + self.base + self.filled;
+            match crate::fs::vfs::read_at(self.file, pos as u32, &mut self.stage[self.filled..want]) {
+                Ok(n) if n > 0 => self.filled += n,
+                _ => break,
+            }
+        }
+        self.base + self.filled
+    }
+
+    fn bytes(&self, start: usize, end: usize) -> &[u8] {
+        &self.stage[start - self.base..end - self.base]
+    }
+}
+
+/// sys_sendfile - Send file data on a TCP connection without a user-space copy.
+/// arg1=fd, arg2=socket_id, arg3=offset, arg4=len.
+/// Reads through the page cache in batches of SEND_BATCH_SIZE segments; the
+/// file position is not moved.  Returns bytes sent (short at EOF), or
+/// u32::MAX on error.
+pub fn sys_sendfile(fd: u32, socket_id: u32, offset: u32, len: u32) -> u32 {
+    use crate::fs::fd_table::FdKind;
+    let file = match crate::task::scheduler::current_fd_get(fd) {
+        Some(entry) => match entry.kind {
+            FdKind::File { global_id } => global_id,
+            _ => return u32::MAX,
+        },
+        None => return u32::MAX,
+    };
+    let size = match crate::fs::vfs::fstat(file) {
+        Ok((_, size, _, _)) => size,
+        Err(_) => return u32::MAX,
+    };
+    let total = len.min(size.saturating_sub(offset)) as usize;
+    if total == 0 {
+        return 0;
+    }
+    let mut source = FileSource {
+        file,
+        start: offset,
+        stage: alloc::vec![0u8; SENDFILE_STAGE.min(total)],
+        base: 0,
+        filled: 0,
+    };
+    let sent = crate::net::tcp::send_stream(socket_id, total, &mut source, 1000);
+    if sent != u32::MAX {
+        crate::task::scheduler::record_io_read(sent as u64);
+    }
+    sent
+}
+
 /// sys_tcp_recv - Receive data from TCP connection.
 /// arg1=socket_id, arg2=buf_ptr, arg3=len
 /// Returns bytes received, 0=EOF, u32::MAX=error.
@@ -234,11 +315,19 @@ pub fn sys_tcp_shutdown_wr(socket_id: u32) -> u32 {
     crate::net::tcp::shutdown_write(socket_id)
 }
 
+/// Flag in sys_tcp_listen's backlog letting several listeners share the port.
+const TCP_LISTEN_REUSEPORT: u32 = 0x8000_0000;
+
 /// sys_tcp_listen - Listen on a TCP port for incoming connections.
-/// arg1=port, arg2=backlog. Returns listener socket_id or u32::MAX on error.
+/// arg1=port, arg2=backlog (0 = default, clamped to 1024; bit 31 shares the
+/// port with other listeners that set it). Listening again on a port the
+/// caller already listens on updates the backlog.
+/// Returns listener socket_id or u32::MAX on error.
 pub fn sys_tcp_listen(port: u32, backlog: u32) -> u32 {
     if port == 0 || port > 65535 { return u32::MAX; }
-    crate::net::tcp::listen(port as u16, backlog.min(16) as u16)
+    let reuse_port = backlog & TCP_LISTEN_REUSEPORT != 0;
+    let backlog = (backlog & !TCP_LISTEN_REUSEPORT).min(u16::MAX as u32);
+    crate::net::tcp::listen(port as u16, backlog as u16, reuse_port)
 }
 
 /// sys_tcp_accept - Accept a connection from a listening socket.
@@ -264,18 +353,28 @@ pub fn sys_tcp_accept(listener_id: u32, result_ptr: u32) -> u32 {
     0
 }
 
+/// Flag in sys_tcp_list's max_entries selecting the extended entry format.
+const TCP_LIST_EXTENDED: u32 = 0x8000_0000;
+
 /// sys_tcp_list - List all TCP connections.
 /// arg1=buf_ptr, arg2=max_entries. Each entry is 16 bytes:
 ///   [local_ip:4, local_port:u16, remote_ip:4, remote_port:u16, state:u8, owner_tid_lo:u8, recv_buf_hi:u16]
+/// With bit 31 of max_entries set, entries are 32 bytes: the above followed by
+///   [cwnd:u32, srtt_ms:u32, rto_ms:u32, reserved:4]
 /// Returns number of entries written.
 pub fn sys_tcp_list(buf_ptr: u32, max_entries: u32) -> u32 {
+    let extended = max_entries & TCP_LIST_EXTENDED != 0;
+    let max_entries = max_entries & !TCP_LIST_EXTENDED;
     if buf_ptr == 0 || max_entries == 0 { return 0; }
     let conns = crate::net::tcp::list_connections();
     let count = conns.len().min(max_entries as usize);
-    let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, count * 16) };
+    let stride = if extended { 32 } else { 16 };
+    let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, count * stride) };
+    let hz = (crate::arch::hal::timer_frequency_hz() as u32).max(1);
+    let to_ms = |ticks: u32| (ticks as u64 * 1000 / hz as u64) as u32;
 
     for (i, info) in conns.iter().take(count).enumerate() {
-        let off = i * 16;
+        let off = i * stride;
         buf[off..off+4].copy_from_slice(info.local_ip.as_bytes());
         let lp = info.local_port.to_be_bytes();
         buf[off+4] = lp[0];
@@ -289,6 +388,12 @@ pub fn sys_tcp_list(buf_ptr: u32, max_entries: u32) -> u32 {
         let recv_len = (info.recv_buf_len as u16).to_le_bytes();
         buf[off+14] = recv_len[0];
         buf[off+15] = recv_len[1];
+        if extended {
+            buf[off+16..off+20].copy_from_slice(&info.cwnd.to_le_bytes());
+            buf[off+20..off+24].copy_from_slice(&to_ms(info.srtt_ticks).to_le_bytes());
+            buf[off+24..off+28].copy_from_slice(&to_ms(info.rto_ticks).to_le_bytes());
+            buf[off+28..off+32].fill(0);
+        }
     }
 
     count as u32
@@ -428,6 +533,14 @@ pub fn sys_udp_list(buf_ptr: u32, max_entries: u32) -> u32 {
     count as u32
 }
 
+/// NIC counters on targets without a NIC driver.
+#[cfg(target_arch = "aarch64")]
+#[derive(Default)]
+struct NicCounters {
+    rx_packets: u64, tx_packets: u64, rx_bytes: u64, tx_bytes: u64, rx_errors: u64, tx_errors: u64,
+    rx_passes: u64, rx_pass_frames: u64, rx_pass_max: u64, rx_budget_exhausted: u64,
+}
+
 /// sys_net_stats - Get network protocol statistics.
 /// arg1=buf_ptr, arg2=buf_size (must be >= 104).
 /// Buffer layout (all little-endian):
@@ -445,22 +558,34 @@ pub fn sys_udp_list(buf_ptr: u32, max_entries: u32) -> u32 {
 ///   [88..96] tcp_resets_sent (u64)
 ///   [96..100] tcp_curr_established (u32)
 ///   [100..104] tcp_conn_errors_lo (u32)
+/// With buf_size >= 136, the receive pass counters follow:
+///   [104..112] rx_passes (u64)     — NIC polls that reaped frames
+///   [112..120] rx_pass_frames (u64)
+///   [120..128] rx_pass_max (u64)
+///   [128..136] rx_budget_exhausted (u64)
 /// Returns 0 on success.
 pub fn sys_net_stats(buf_ptr: u32, buf_size: u32) -> u32 {
     if buf_ptr == 0 || buf_size < 104 { return u32::MAX; }
-    let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, 104) };
+    let len = if buf_size >= 136 { 136 } else { 104 };
+    let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, len) };
 
     // NIC stats
     #[cfg(target_arch = "x86_64")]
-    let (rxp, txp, rxb, txb, rxe, txe) = crate::drivers::network::e1000::get_stats();
+    let nic = crate::drivers::network::get_stats();
     #[cfg(target_arch = "aarch64")]
-    let (rxp, txp, rxb, txb, rxe, txe): (u64, u64, u64, u64, u64, u64) = (0, 0, 0, 0, 0, 0);
-    buf[0..8].copy_from_slice(&rxp.to_le_bytes());
-    buf[8..16].copy_from_slice(&txp.to_le_bytes());
-    buf[16..24].copy_from_slice(&rxb.to_le_bytes());
-    buf[24..32].copy_from_slice(&txb.to_le_bytes());
-    buf[32..40].copy_from_slice(&rxe.to_le_bytes());
-    buf[40..48].copy_from_slice(&txe.to_le_bytes());
+    let nic = NicCounters::default();
+    buf[0..8].copy_from_slice(&nic.rx_packets.to_le_bytes());
+    buf[8..16].copy_from_slice(&nic.tx_packets.to_le_bytes());
+    buf[16..24].copy_from_slice(&nic.rx_bytes.to_le_bytes());
+    buf[24..32].copy_from_slice(&nic.tx_bytes.to_le_bytes());
+    buf[32..40].copy_from_slice(&nic.rx_errors.to_le_bytes());
+    buf[40..48].copy_from_slice(&nic.tx_errors.to_le_bytes());
+    if len >= 136 {
+        buf[104..112].copy_from_slice(&nic.rx_passes.to_le_bytes());
+        buf[112..120].copy_from_slice(&nic.rx_pass_frames.to_le_bytes());
+        buf[120..128].copy_from_slice(&nic.rx_pass_max.to_le_bytes());
+        buf[128..136].copy_from_slice(&nic.rx_budget_exhausted.to_le_bytes());
+    }
 
     // TCP stats
     let ts = crate::net::tcp::get_stats();
@@ -1,7 +1,7 @@
 //! Process management syscall handlers.
 //!
 //! Covers process lifecycle (exit, kill, spawn, fork, exec),
-//! scheduling (yield, sleep), memory (sbrk, mmap, munmap),
+//! scheduling (yield, sleep), memory (sbrk, heap_report, mmap, munmap),
 //! waiting (waitpid), and threading.
 
 #[allow(unused_imports)]
@@ -12,7 +12,7 @@ use super::helpers::{is_valid_user_ptr, read_user_str, read_user_str_safe, resol
 /// sys_exit - Terminate the current process
 pub fn sys_exit(status: u32) -> u32 {
     // Single atomic lock acquisition — no TOCTOU gaps between reads
-    let (tid, pd, _) = crate::task::scheduler::current_exit_info();
+    let (tid, pd, can_destroy) = crate::task::scheduler::current_exit_info();
     crate::debug_println!("sys_exit({}) TID={}", status, tid);
 
     // Close all open file descriptors and decref global resources.
@@ -31,6 +31,12 @@ pub fn sys_exit(status: u32) -> u32 {
                 FdKind::PipeWrite { pipe_id } => {
                     crate::ipc::anon_pipe::decref_write(*pipe_id);
                 }
+                FdKind::PollSet { set_id } => {
+                    crate::ipc::poll_set::decref(*set_id);
+                }
+                FdKind::IoRing { ring_id } => {
+                    crate::ipc::io_ring::decref(*ring_id);
+                }
                 FdKind::Tty | FdKind::None => {}
             }
         }
@@ -43,8 +49,16 @@ pub fn sys_exit(status: u32) -> u32 {
         crate::ipc::shared_memory::cleanup_process(tid);
     }
 
+    // Last thread of the process: write back shared file mappings and drop
+    // their file references (also needs the user PD).
+    if let Some(pd_phys) = pd.filter(|_| can_destroy) {
+        crate::memory::file_map::release_current(pd_phys);
+    }
+
     // Clean up TCP connections/listeners owned by this thread
     crate::net::tcp::cleanup_for_thread(tid);
+    #[cfg(target_arch = "x86_64")]
+    crate::drivers::audio::cleanup_for_thread(tid);
 
     // Clean up environment variables for this process
     if let Some(pd_phys) = pd {
@@ -64,15 +78,10 @@ pub fn sys_exit(status: u32) -> u32 {
             core::arch::asm!("mov cr3, {}", in(reg) kernel_cr3);
         }
         #[cfg(target_arch = "aarch64")]
-        unsafe {
+        {
             // ARM64: switch TTBR0_EL1 to kernel page table before destroying user PD
             let kernel_ttbr = crate::memory::virtual_mem::kernel_cr3();
-            core::arch::asm!(
-                "msr ttbr0_el1, {}",
-                "isb",
-                in(reg) kernel_ttbr,
-                options(nostack),
-            );
+            crate::arch::arm64::mmu::switch_ttbr0(kernel_ttbr);
         }
     }
 
@@ -141,10 +150,22 @@ pub fn sys_sleep(ms: u32) -> u32 {
     0
 }
 
+/// sys_sleep_ns - Sleep for a 64-bit nanosecond count (`lo | hi << 32`).
+///
+/// Unlike `sys_sleep`, the deadline is not rounded to the scheduler tick.
+pub fn sys_sleep_ns(lo: u32, hi: u32) -> u32 {
+    let ns = lo as u64 | (hi as u64) << 32;
+    if ns == 0 {
+        return 0;
+    }
+    crate::task::scheduler::sleep_ns(ns);
+    0
+}
+
 /// sys_sbrk - Grow/shrink the process heap
 pub fn sys_sbrk(increment: i32) -> u32 {
     use crate::memory::address::VirtAddr;
-    use crate::memory::physical;
+    use crate::memory::memops;
     use crate::memory::virtual_mem;
 
     let old_brk = crate::task::scheduler::current_thread_brk();
@@ -179,11 +200,14 @@ pub fn sys_sbrk(increment: i32) -> u32 {
         let mut addr = old_page_end;
         let mut pages_mapped = 0u32;
         while addr < new_page_end {
-            // Skip pages already mapped (another thread sharing this PD may have mapped them)
-            if !virtual_mem::is_page_mapped(VirtAddr::new(addr as u64)) {
-                if let Some(phys) = physical::alloc_frame() {
+            // Skip pages already mapped (another thread sharing this PD may
+            // have mapped them) or swapped out.
+            if !virtual_mem::is_user_page_backed(VirtAddr::new(addr as u64)) {
+                if let Some((phys, zeroed)) = alloc_user_frame() {
                     virtual_mem::map_page(VirtAddr::new(addr as u64), phys, 0x02 | 0x04);
-                    unsafe { core::ptr::write_bytes(addr as *mut u8, 0, page_size as usize); }
+                    if !zeroed {
+                        unsafe { memops::zero_page(addr as *mut u8); }
+                    }
                     pages_mapped += 1;
                 } else {
                     return u32::MAX;
@@ -208,6 +232,35 @@ pub fn sys_sbrk(increment: i32) -> u32 {
     }
 }
 
+/// A zeroed frame for user memory (see `zero_pool::alloc_zeroed_frame`).
+/// When memory is exhausted, drop clean cached pages and try once more
+/// before the caller fails the allocation.
+fn alloc_user_frame() -> Option<(crate::memory::address::PhysAddr, bool)> {
+    crate::memory::zero_pool::alloc_zeroed_frame().or_else(|| {
+        crate::memory::reclaim::direct_reclaim();
+        crate::memory::zero_pool::alloc_zeroed_frame()
+    })
+}
+
+/// sys_heap_report - Record the calling process's heap usage.
+/// arg1=buf_ptr (HEAP_STATS_WORDS u32 words: heap_bytes, in_use, free,
+/// largest_free, free_blocks, mapped), arg2=buf_size.  Returns 0 or u32::MAX.
+///
+/// The record is read back by other processes through sysinfo cmd 8.
+pub fn sys_heap_report(buf_ptr: u32, buf_size: u32) -> u32 {
+    use crate::task::thread::HEAP_STATS_WORDS;
+    let len = HEAP_STATS_WORDS * 4;
+    if (buf_size as usize) < len || !is_valid_user_ptr(buf_ptr as u64, len as u64) {
+        return u32::MAX;
+    }
+    let mut stats = [0u32; HEAP_STATS_WORDS];
+    for (i, w) in stats.iter_mut().enumerate() {
+        *w = unsafe { core::ptr::read_unaligned((buf_ptr as usize + i * 4) as *const u32) };
+    }
+    crate::task::scheduler::set_current_heap_stats(stats);
+    0
+}
+
 /// sys_mmap - Map anonymous pages into user address space.
 /// arg1=size (bytes, rounded up to page boundary). Returns virtual address or u32::MAX on error.
 ///
@@ -244,27 +297,44 @@ pub fn sys_mmap(size: u32) -> u32 {
         }
     };
 
-    // Allocate and map physical pages.
+    // Allocate and map physical pages.  2 MiB-aligned stretches of large
+    // regions (the VMA allocator aligns them) get one buddy block mapped as
+    // a huge page; the rest, or everything once no block is left, 4K frames.
+    const HUGE_ORDER: usize = 9; // 512 frames = 2 MiB
+    let huge_size = virtual_mem::HUGE_PAGE_SIZE as u32;
+    let end = base + aligned_size;
+    let mut try_huge = true;
     let mut addr = base;
-    for _ in 0..num_pages {
-        if let Some(phys) = physical::alloc_frame() {
+    while addr < end {
+        if try_huge && addr & (huge_size - 1) == 0 && end - addr >= huge_size {
+            match physical::alloc_block(HUGE_ORDER) {
+                Some(block) => {
+                    if virtual_mem::map_huge_page(VirtAddr::new(addr as u64), block, 0x02 | 0x04) {
+                        unsafe { core::ptr::write_bytes(addr as *mut u8, 0, huge_size as usize); }
+                        addr += huge_size;
+                        continue;
+                    }
+                    // A page table already covers this slot.
+                    physical::free_contiguous(block, virtual_mem::PAGES_PER_HUGE_PAGE);
+                }
+                None => try_huge = false,
+            }
+        }
+        if let Some((phys, zeroed)) = alloc_user_frame() {
             virtual_mem::map_page(
                 VirtAddr::new(addr as u64),
                 phys,
                 0x02 | 0x04, // PAGE_WRITABLE | PAGE_USER
             );
-            unsafe { core::ptr::write_bytes(addr as *mut u8, 0, PAGE_SIZE as usize); }
+            if !zeroed {
+                unsafe { crate::memory::memops::zero_page(addr as *mut u8); }
+            }
         } else {
             // Out of physical memory — unmap what we already mapped and free VMA.
-            let mut cleanup = base;
-            while cleanup < addr {
-                let pte = virtual_mem::read_pte(VirtAddr::new(cleanup as u64));
-                if pte & 1 != 0 {
-                    let phys_addr = crate::memory::address::PhysAddr::new(pte & 0x000F_FFFF_FFFF_F000);
-                    virtual_mem::unmap_page(VirtAddr::new(cleanup as u64));
-                    physical::free_frame(phys_addr);
-                }
-                cleanup += PAGE_SIZE;
+            let mapped_pages = (addr - base) / PAGE_SIZE;
+            let (frames, _) = virtual_mem::take_user_range(VirtAddr::new(base as u64), mapped_pages as usize);
+            for frame in frames {
+                physical::free_frame(frame);
             }
             crate::memory::vma::free_region(pd, base, aligned_size);
             crate::serial_println!("sys_mmap: out of physical memory");
@@ -280,6 +350,61 @@ pub fn sys_mmap(size: u32) -> u32 {
     base
 }
 
+/// sys_mmap_file - Map an open file into the address space.
+/// arg1=fd, arg2=offset (page-aligned), arg3=len, arg4=prot (PROT_WRITE=2,
+/// PROT_EXEC=4), arg5=flags (MAP_SHARED=1 or MAP_PRIVATE=2).
+///
+/// Pages are read from the page cache on first access.  Writes to a
+/// MAP_SHARED mapping reach the file on munmap/exit; MAP_PRIVATE writes stay
+/// private.  Returns the address, or u32::MAX on error.
+pub fn sys_mmap_file(fd: u32, offset: u32, len: u32, prot: u32, flags: u32) -> u32 {
+    use crate::fs::fd_table::FdKind;
+
+    const PROT_WRITE: u32 = 2;
+    const PROT_EXEC: u32 = 4;
+    const MAP_SHARED: u32 = 1;
+    const MAP_PRIVATE: u32 = 2;
+
+    if len == 0 || offset & 0xFFF != 0 {
+        return u32::MAX;
+    }
+    let shared = match flags & (MAP_SHARED | MAP_PRIVATE) {
+        MAP_SHARED => true,
+        MAP_PRIVATE => false,
+        _ => return u32::MAX,
+    };
+    let writable = prot & PROT_WRITE != 0;
+
+    let slot = match crate::task::scheduler::current_fd_get(fd) {
+        Some(entry) => match entry.kind {
+            FdKind::File { global_id } => global_id,
+            _ => return u32::MAX,
+        },
+        None => return u32::MAX,
+    };
+    let (file_size, fd_writable) = match crate::fs::vfs::map_info(slot) {
+        Ok(info) => info,
+        Err(_) => return u32::MAX,
+    };
+    if shared && writable && !fd_writable {
+        return u32::MAX;
+    }
+
+    let pd = match crate::task::scheduler::current_thread_page_directory() {
+        Some(pd) => pd,
+        None => return u32::MAX,
+    };
+    match crate::memory::file_map::map(
+        pd, slot, offset, len, file_size, writable, shared, prot & PROT_EXEC != 0,
+    ) {
+        Some(base) => base,
+        None => {
+            crate::serial_println!("sys_mmap_file: out of mmap virtual address space");
+            u32::MAX
+        }
+    }
+}
+
 /// sys_munmap - Unmap pages from user address space, freeing physical frames.
 /// arg1=addr (must be page-aligned), arg2=size (bytes, rounded up to pages).
 /// Returns 0 on success, u32::MAX on error.
@@ -305,19 +430,22 @@ pub fn sys_munmap(addr: u32, size: u32) -> u32 {
         return u32::MAX;
     }
 
+    let pd = crate::task::scheduler::current_thread_page_directory();
+
+    // Shared file mappings: write dirty pages back while they are mapped.
+    if let Some(pd) = pd {
+        crate::memory::file_map::writeback_range(pd, addr, aligned_size);
+    }
+
     let num_pages = aligned_size / PAGE_SIZE;
-    let mut freed = 0u32;
-    let mut page_addr = addr;
-
-    for _ in 0..num_pages {
-        let pte = virtual_mem::read_pte(VirtAddr::new(page_addr as u64));
-        if pte & 1 != 0 {
-            let phys_addr = crate::memory::address::PhysAddr::new(pte & 0x000F_FFFF_FFFF_F000);
-            virtual_mem::unmap_page(VirtAddr::new(page_addr as u64));
-            physical::free_frame(phys_addr);
-            freed += 1;
-        }
-        page_addr += PAGE_SIZE;
+
+    // Clear all PTEs (swapped-out pages included) and shoot the range down
+    // once; only then may sibling threads' CPUs no longer reach the frames
+    // through stale TLB entries.
+    let (frames, removed) = virtual_mem::take_user_range(VirtAddr::new(addr as u64), num_pages as usize);
+    let freed = removed as u32;
+    for frame in frames {
+        physical::free_frame(frame);
     }
 
     if freed > 0 {
@@ -325,8 +453,9 @@ pub fn sys_munmap(addr: u32, size: u32) -> u32 {
     }
 
     // Update VMA bookkeeping so the freed virtual addresses can be reused.
-    if let Some(pd) = crate::task::scheduler::current_thread_page_directory() {
-        crate::memory::vma::free_region(pd, addr, aligned_size);
+    if let Some(pd) = pd {
+        let refs = crate::memory::vma::free_region(pd, addr, aligned_size);
+        crate::memory::file_map::release_refs(&refs);
     }
 
     0
@@ -512,8 +641,9 @@ pub fn sys_fork(regs: &super::super::SyscallRegs) -> u32 {
     };
     let t_fork_cloned = crate::arch::hal::timer_current_ticks();
 
-    // Clone VMA table from parent to child process.
-    crate::memory::vma::clone_for_fork(snap.pd, child_pd);
+    // Clone VMA table from parent to child process (file mappings take
+    // one more reference on their open files).
+    crate::memory::file_map::clone_for_fork(snap.pd, child_pd);
 
     // 3. Build child name: "parent_name(fork)"
     let name_len = snap.name.iter().position(|&b| b == 0).unwrap_or(snap.name.len());
@@ -578,6 +708,12 @@ pub fn sys_fork(regs: &super::super::SyscallRegs) -> u32 {
                 FdKind::PipeWrite { pipe_id } => {
                     crate::ipc::anon_pipe::incref_write(pipe_id);
                 }
+                FdKind::PollSet { set_id } => {
+                    crate::ipc::poll_set::incref(set_id);
+                }
+                FdKind::IoRing { ring_id } => {
+                    crate::ipc::io_ring::incref(ring_id);
+                }
                 FdKind::Tty | FdKind::None => {}
             }
         }
@@ -651,6 +787,13 @@ pub fn sys_exec(path_ptr: u32, args_ptr: u32) -> u32 {
         crate::task::scheduler::current_tid(), path, args
     );
 
+    // Recently run ELF64 images come from the image cache without a read
+    #[cfg(target_arch = "x86_64")]
+    if let Some(err) = crate::task::loader::exec_current_process_cached(&path, args) {
+        crate::serial_println!("sys_exec: FAILED: {}", err);
+        return u32::MAX;
+    }
+
     // Read the binary from the filesystem
     let data = match crate::fs::vfs::read_file_to_vec(&path) {
         Ok(d) => d,
@@ -63,12 +63,16 @@ pub fn sys_dmesg(buf_ptr: u32, buf_size: u32) -> u32 {
 }
 
 /// sys_sysinfo - Get system information.
-/// arg1=cmd: 0=memory, 1=threads, 2=cpus, 3=cpu_load
+/// arg1=cmd: 0=memory, 1=threads, 2=cpus, 3=cpu_load, 4=hardware, 5=migrations,
+///           6=page cache, 7=ms since the caller was spawned, 8=heap stats,
+///           9=reclaim and swap, 10=per-process resident/swapped pages
 /// arg2=buf_ptr, arg3=buf_size
 pub fn sys_sysinfo(cmd: u32, buf_ptr: u32, buf_size: u32) -> u32 {
     match cmd {
         0 => {
             // Memory: [total_frames:u32, free_frames:u32, heap_used:u32, heap_total:u32] = 16 bytes
+            //         optional [slab_used:u32, slab_reserved:u32] = 24 bytes
+            //         optional [zero_pooled:u32, zero_hits:u32, zero_misses:u32] = 36 bytes
             if buf_ptr != 0 && buf_size >= 8 {
                 unsafe {
                     let buf = buf_ptr as *mut u32;
@@ -79,6 +83,18 @@ pub fn sys_sysinfo(cmd: u32, buf_ptr: u32, buf_size: u32) -> u32 {
                         *buf.add(2) = heap_used as u32;
                         *buf.add(3) = heap_total as u32;
                     }
+                    if buf_size >= 24 {
+                        let (slab_used, slab_reserved) = crate::memory::slab::slab_totals();
+                        *buf.add(4) = slab_used as u32;
+                        *buf.add(5) = slab_reserved as u32;
+                    }
+                    #[cfg(target_arch = "x86_64")]
+                    if buf_size >= 36 {
+                        let (hits, misses) = crate::memory::zero_pool::stats();
+                        *buf.add(6) = crate::memory::zero_pool::pooled() as u32;
+                        *buf.add(7) = hits;
+                        *buf.add(8) = misses;
+                    }
                 }
             }
             0
@@ -229,10 +245,298 @@ pub fn sys_sysinfo(cmd: u32, buf_ptr: u32, buf_size: u32) -> u32 {
 
             actual_size as u32
         }
+        5 => {
+            // Scheduler migration counters:
+            //   [0] num_cpus          (u32)
+            //   [1] steal_hot_skips   (u32) — steals refused, all candidates cache-hot
+            //   [2] affinity_rebalances (u32) — periodic rebalancer moves
+            //   [3] reserved          (u32)
+            //   [4..4+num_cpus*2] steals_in[i], steals_out[i] pairs
+            // Minimum 16 bytes for header, +8 per CPU
+            let num_cpus = crate::arch::hal::cpu_count();
+            if buf_ptr == 0 || buf_size < 16 { return u32::MAX; }
+            if !is_valid_user_ptr(buf_ptr as u64, buf_size as u64) { return u32::MAX; }
+            unsafe {
+                let buf = buf_ptr as *mut u32;
+                *buf = num_cpus as u32;
+                *buf.add(1) = crate::task::scheduler::steal_hot_skips();
+                *buf.add(2) = crate::task::scheduler::affinity_rebalances();
+                *buf.add(3) = 0;
+                for i in 0..num_cpus {
+                    let off = 4 + i * 2;
+                    if (off + 2) * 4 <= buf_size as usize {
+                        let (steals_in, steals_out) = crate::task::scheduler::per_cpu_steals(i);
+                        *buf.add(off) = steals_in;
+                        *buf.add(off + 1) = steals_out;
+                    }
+                }
+            }
+            0
+        }
+        6 => {
+            // Page cache: [pages:u32, max_pages:u32, hits:u64, misses:u64, evictions:u64,
+            //              readahead:u64, readahead_wasted:u64 (if buf_size >= 48)]
+            if buf_ptr == 0 || buf_size < 32 { return u32::MAX; }
+            let len = if buf_size >= 48 { 48 } else { 32 };
+            if !is_valid_user_ptr(buf_ptr as u64, len) { return u32::MAX; }
+            let st = crate::fs::page_cache::stats();
+            unsafe {
+                let buf = buf_ptr as *mut u32;
+                *buf = st.pages;
+                *buf.add(1) = st.budget;
+                let buf = buf_ptr as *mut u64;
+                *buf.add(1) = st.hits;
+                *buf.add(2) = st.misses;
+                *buf.add(3) = st.evictions;
+                if len >= 48 {
+                    *buf.add(4) = st.readahead;
+                    *buf.add(5) = st.readahead_wasted;
+                }
+            }
+            0
+        }
+        7 => {
+            // Milliseconds since the calling thread was spawned or exec'd
+            // (app launch metric, e.g. spawn-to-first-frame)
+            let ticks = crate::arch::hal::timer_current_ticks()
+                .wrapping_sub(crate::task::scheduler::current_spawn_tick());
+            let hz = (crate::arch::hal::timer_frequency_hz() as u64).max(1);
+            (ticks as u64 * 1000 / hz) as u32
+        }
+        8 => {
+            // Heap stats reported via SYS_HEAP_REPORT, one 28-byte entry per
+            // thread: [tid, heap_bytes, in_use, free, largest_free,
+            //          free_blocks, mapped] (all u32). Returns entry count.
+            use crate::task::thread::HEAP_STATS_WORDS;
+            const ENTRY: usize = 4 + HEAP_STATS_WORDS * 4;
+            let mut snap = [(0u32, [0u32; HEAP_STATS_WORDS]); 64];
+            let count = crate::task::scheduler::heap_stats_snapshot(&mut snap);
+            if buf_ptr != 0 && buf_size > 0 {
+                if !is_valid_user_ptr(buf_ptr as u64, buf_size as u64) { return u32::MAX; }
+                let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, buf_size as usize) };
+                for (i, (tid, stats)) in snap[..count].iter().enumerate() {
+                    let off = i * ENTRY;
+                    if off + ENTRY > buf.len() { break; }
+                    buf[off..off + 4].copy_from_slice(&tid.to_le_bytes());
+                    for (j, w) in stats.iter().enumerate() {
+                        let o = off + 4 + j * 4;
+                        buf[o..o + 4].copy_from_slice(&w.to_le_bytes());
+                    }
+                }
+            }
+            count as u32
+        }
+        #[cfg(target_arch = "x86_64")]
+        9 => {
+            // Reclaim and swap, 16 u32s (64 bytes):
+            // [cache_active, cache_inactive, cache_reclaimed, image_reclaimed,
+            //  reclaim_runs, swap_entries, zram_pages, zram_frames, zram_bytes,
+            //  zram_limit_frames, disk_used, disk_pages, swap_outs, swap_ins,
+            //  swap_rejects, direct_reclaims]
+            if buf_ptr == 0 || buf_size < 64 { return u32::MAX; }
+            if !is_valid_user_ptr(buf_ptr as u64, 64) { return u32::MAX; }
+            let cache = crate::fs::page_cache::stats();
+            let rc = crate::memory::reclaim::stats();
+            let sw = crate::memory::swap::stats();
+            let words = [
+                cache.active, cache.inactive,
+                rc.cache_reclaimed as u32, rc.image_reclaimed as u32, rc.runs as u32,
+                sw.entries as u32, sw.zram_pages, sw.zram_frames, sw.zram_bytes, sw.zram_limit,
+                sw.disk_used, sw.disk_pages,
+                sw.swap_outs as u32, sw.swap_ins as u32, sw.rejects as u32,
+                rc.direct as u32,
+            ];
+            let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u32, 16) };
+            buf.copy_from_slice(&words);
+            0
+        }
+        #[cfg(target_arch = "x86_64")]
+        10 => {
+            // Per-process memory from the last reclaim pass, one 12-byte
+            // entry per process: [tid, resident_pages, swapped_pages].
+            // Returns entry count.
+            let procs = crate::memory::reclaim::process_memory();
+            if buf_ptr != 0 && buf_size > 0 {
+                if !is_valid_user_ptr(buf_ptr as u64, buf_size as u64) { return u32::MAX; }
+                let buf = unsafe { core::slice::from_raw_parts_mut(buf_ptr as *mut u8, buf_size as usize) };
+                for (i, p) in procs.iter().enumerate() {
+                    let off = i * 12;
+                    if off + 12 > buf.len() { break; }
+                    buf[off..off + 4].copy_from_slice(&p.tid.to_le_bytes());
+                    buf[off + 4..off + 8].copy_from_slice(&p.resident.to_le_bytes());
+                    buf[off + 8..off + 12].copy_from_slice(&p.swapped.to_le_bytes());
+                }
+            }
+            procs.len() as u32
+        }
         _ => u32::MAX,
     }
 }
 
+// =========================================================================
+// SYS_THREAD_SNAPSHOT (323) — All threads in one scheduler pass
+// =========================================================================
+
+/// Size of the header written before the records: version, record size,
+/// live threads, records written, total and idle scheduler ticks, total
+/// ticks since the previous snapshot, CPU count (u32 each).
+const THREAD_SNAPSHOT_HEADER: usize = 32;
+
+/// Flag: the buffer holds the caller's previous snapshot; fill in
+/// `tick_delta` of each thread (and the header's tick delta) against it.
+const THREAD_SNAPSHOT_DELTA: u32 = 1;
+
+/// Most records copied per call.
+const THREAD_SNAPSHOT_MAX: usize = 1024;
+
+/// Write a consistent snapshot of every live thread into `buf`: a 32-byte
+/// header followed by as many `ThreadSnapRecord`s as fit, taken in one
+/// pass under the scheduler lock.  With `buf_ptr == 0` only the count is
+/// returned.
+///
+/// Deltas are computed against the caller's own previous snapshot, so any
+/// number of monitors can poll at their own rate without sharing state.
+///
+/// Returns the number of live threads (may exceed what fit), or u32::MAX
+/// on error.
+pub fn sys_thread_snapshot(buf_ptr: u32, buf_size: u32, flags: u32) -> u32 {
+    use crate::task::scheduler::{thread_snapshot, ThreadSnapRecord, THREAD_SNAPSHOT_VERSION};
+    let buf = buf_ptr as usize;
+    let size = buf_size as usize;
+    let rec_size = core::mem::size_of::<ThreadSnapRecord>();
+
+    if buf == 0 {
+        return thread_snapshot(&mut alloc::vec::Vec::new()).0 as u32;
+    }
+    if size < THREAD_SNAPSHOT_HEADER || !is_valid_user_ptr(buf as u64, size as u64) {
+        return u32::MAX;
+    }
+    let word = |i: usize| unsafe { core::ptr::read_unaligned((buf + i * 4) as *const u32) };
+    let cap = ((size - THREAD_SNAPSHOT_HEADER) / rec_size).min(THREAD_SNAPSHOT_MAX);
+    let recs = (buf + THREAD_SNAPSHOT_HEADER) as *mut ThreadSnapRecord;
+
+    // (tid, cpu_ticks) of the previous snapshot, sorted by tid
+    let mut prev: alloc::vec::Vec<(u32, u32)> = alloc::vec::Vec::new();
+    let mut prev_ticks = None;
+    if flags & THREAD_SNAPSHOT_DELTA != 0
+        && word(0) == THREAD_SNAPSHOT_VERSION
+        && word(1) as usize == rec_size
+    {
+        let n = (word(3) as usize).min(cap);
+        prev.reserve(n);
+        for i in 0..n {
+            let r = unsafe { core::ptr::read_unaligned(recs.add(i)) };
+            prev.push((r.tid, r.cpu_ticks));
+        }
+        prev.sort_unstable_by_key(|&(tid, _)| tid);
+        prev_ticks = Some(word(4));
+    }
+
+    let mut snap = alloc::vec::Vec::with_capacity(cap);
+    let (total, total_ticks, idle_ticks) = thread_snapshot(&mut snap);
+
+    for (i, r) in snap.iter_mut().enumerate() {
+        if prev_ticks.is_some() {
+            // A thread new since the previous snapshot ran all its ticks since
+            let before = prev.binary_search_by_key(&r.tid, |&(tid, _)| tid)
+                .map_or(0, |j| prev[j].1);
+            r.tick_delta = r.cpu_ticks.wrapping_sub(before);
+        }
+        unsafe { core::ptr::write_unaligned(recs.add(i), *r) };
+    }
+    let header = [
+        THREAD_SNAPSHOT_VERSION,
+        rec_size as u32,
+        total as u32,
+        snap.len() as u32,
+        total_ticks,
+        idle_ticks,
+        prev_ticks.map_or(0, |t| total_ticks.wrapping_sub(t)),
+        crate::arch::hal::cpu_count() as u32,
+    ];
+    for (i, w) in header.iter().enumerate() {
+        unsafe { core::ptr::write_unaligned((buf + i * 4) as *mut u32, *w) };
+    }
+    total as u32
+}
+
+// =========================================================================
+// SYS_IRQ_STATS (324) / SYS_IRQ_AFFINITY (325) — Interrupt counters
+// =========================================================================
+
+/// Version of the `SYS_IRQ_STATS` layout.
+const IRQ_STATS_VERSION: u32 = 1;
+
+/// Header before the records: version, record size, IRQs, CPU count.
+const IRQ_STATS_HEADER: usize = 16;
+
+/// Write the per-CPU interrupt counters of every active IRQ into `buf`:
+/// a 16-byte header followed by as many `IrqRecord`s as fit.
+///
+/// Returns the number of IRQs (may exceed what fit), or u32::MAX on error.
+pub fn sys_irq_stats(buf_ptr: u32, buf_size: u32) -> u32 {
+    #[cfg(target_arch = "x86_64")]
+    {
+        use crate::arch::x86::irq::MAX_IRQS;
+        use crate::arch::x86::irq_balance::{snapshot, IrqRecord};
+        let buf = buf_ptr as usize;
+        let size = buf_size as usize;
+        let rec_size = core::mem::size_of::<IrqRecord>();
+        if size < IRQ_STATS_HEADER || !is_valid_user_ptr(buf as u64, size as u64) {
+            return u32::MAX;
+        }
+
+        let mut recs = alloc::vec![IrqRecord {
+            irq: 0, kind: 0, cpu: 0, flags: 0, name: [0; 12], counts: [0; crate::arch::x86::smp::MAX_CPUS],
+        }; MAX_IRQS];
+        let total = snapshot(&mut recs);
+        let fit = total.min((size - IRQ_STATS_HEADER) / rec_size);
+        let out = (buf + IRQ_STATS_HEADER) as *mut IrqRecord;
+        for (i, r) in recs[..fit].iter().enumerate() {
+            unsafe { core::ptr::write_unaligned(out.add(i), *r) };
+        }
+        let header = [
+            IRQ_STATS_VERSION,
+            rec_size as u32,
+            fit as u32,
+            crate::arch::hal::cpu_count() as u32,
+        ];
+        for (i, w) in header.iter().enumerate() {
+            unsafe { core::ptr::write_unaligned((buf + i * 4) as *mut u32, *w) };
+        }
+        total as u32
+    }
+    #[cfg(not(target_arch = "x86_64"))]
+    {
+        let _ = (buf_ptr, buf_size);
+        u32::MAX
+    }
+}
+
+/// Deliver device interrupt `irq` to `cpu` only, or hand it back to the
+/// interrupt balancer with `cpu == u32::MAX`.  Root only.
+///
+/// Returns 0 on success, u32::MAX for an unknown IRQ/CPU or a vector that
+/// cannot be moved (LAPIC and legacy ISA interrupts).
+pub fn sys_irq_affinity(irq: u32, cpu: u32) -> u32 {
+    if crate::task::scheduler::current_thread_uid() != 0 {
+        return u32::MAX;
+    }
+    #[cfg(target_arch = "x86_64")]
+    {
+        if irq >= crate::arch::x86::irq::MAX_IRQS as u32 {
+            return u32::MAX;
+        }
+        let cpu = if cpu == u32::MAX { None } else { Some(cpu as usize) };
+        if crate::arch::x86::irq_balance::set_affinity(irq as u8, cpu) { 0 } else { u32::MAX }
+    }
+    #[cfg(not(target_arch = "x86_64"))]
+    {
+        let _ = (irq, cpu);
+        u32::MAX
+    }
+}
+
 // =========================================================================
 // Environment Variables (SYS_SETENV, SYS_GETENV, SYS_LISTENV)
 // =========================================================================
@@ -575,8 +879,9 @@ pub fn sys_set_hostname(name_ptr: u32, name_len: u32) -> u32 {
 /// The compositor is expected to have already drawn a shutdown screen and
 /// killed user processes before invoking this syscall. The kernel's job is:
 /// 1. Kill any remaining user threads (safety net).
-/// 2. Halt all other CPUs via IPI.
-/// 3. Power off (ACPI) or reboot (keyboard controller reset).
+/// 2. Write buffered filesystem changes to disk.
+/// 3. Halt all other CPUs via IPI.
+/// 4. Power off (ACPI) or reboot (keyboard controller reset).
 ///
 /// This function does not return.
 pub fn sys_shutdown(mode: u32) -> u32 {
@@ -597,12 +902,17 @@ pub fn sys_shutdown(mode: u32) -> u32 {
         crate::serial_println!("kernel: terminated {} remaining threads", killed);
     }
 
-    // ── Phase 2: Halt all other CPUs ──
+    // ── Phase 2: Flush write-back buffers (needs interrupts for disk I/O) ──
+    if let Err(e) = crate::fs::vfs::sync_all() {
+        crate::serial_println!("kernel: filesystem sync failed: {:?}", e);
+    }
+
+    // ── Phase 3: Halt all other CPUs ──
     crate::serial_println!("kernel: halting other CPUs...");
     crate::arch::hal::halt_other_cpus();
     crate::arch::hal::disable_interrupts();
 
-    // ── Phase 3: Power off or reboot ──
+    // ── Phase 4: Power off or reboot ──
     #[cfg(target_arch = "x86_64")]
     {
         if mode == 1 {
@@ -13,6 +13,7 @@
 //!   but the separation allows future widening without touching the 32-bit path).
 
 pub mod handlers;
+pub mod stats;
 pub mod table;
 
 // =========================================================================
@@ -66,6 +67,14 @@ pub const SYS_DMESG: u32 = 33;
 pub const SYS_TICK_HZ: u32 = 34;
 pub const SYS_UPTIME_MS: u32 = 35;
 
+// File mappings
+pub const SYS_MMAP_FILE: u32 = 36;
+
+// Readiness wait sets
+pub const SYS_POLL_CREATE: u32 = 37;
+pub const SYS_POLL_CTL: u32 = 38;
+pub const SYS_POLL_WAIT: u32 = 39;
+
 // Networking
 pub const SYS_NET_CONFIG: u32 = 40;
 pub const SYS_NET_PING: u32 = 41;
@@ -101,6 +110,9 @@ pub const SYS_LSEEK: u32 = 105;
 pub const SYS_FSTAT: u32 = 106;
 pub const SYS_FTRUNCATE: u32 = 107;
 pub const SYS_ISATTY: u32 = 108;
+pub const SYS_FSYNC: u32 = 109;
+pub const SYS_FLOCK: u32 = 113;
+pub const SYS_GETDENTS: u32 = 114;
 
 // TCP networking
 pub const SYS_TCP_CONNECT: u32 = 100;
@@ -113,6 +125,7 @@ pub const SYS_TCP_SHUTDOWN_WR: u32 = 131;
 pub const SYS_TCP_LISTEN: u32 = 132;
 pub const SYS_TCP_ACCEPT: u32 = 133;
 pub const SYS_TCP_LIST: u32 = 134;
+pub const SYS_SENDFILE: u32 = 136;
 
 // Network polling
 pub const SYS_NET_POLL: u32 = 50;
@@ -132,6 +145,8 @@ pub const SYS_EVT_CHAN_UNSUBSCRIBE: u32 = 67;
 pub const SYS_EVT_CHAN_DESTROY: u32 = 68;
 pub const SYS_EVT_CHAN_EMIT_TO: u32 = 69;
 pub const SYS_EVT_CHAN_WAIT: u32 = 70;
+pub const SYS_EVT_CHAN_POLL_BATCH: u32 = 71;
+pub const SYS_EVT_CHAN_RING: u32 = 73;
 
 // Display / GPU
 pub const SYS_SCREEN_SIZE: u32 = 72;
@@ -151,6 +166,8 @@ pub const SYS_SHM_CREATE: u32 = 140;
 pub const SYS_SHM_MAP: u32 = 141;
 pub const SYS_SHM_UNMAP: u32 = 142;
 pub const SYS_SHM_DESTROY: u32 = 143;
+pub const SYS_SHM_GRANT: u32 = 74;
+pub const SYS_SHM_CLAIM: u32 = 75;
 
 // UDP networking
 pub const SYS_UDP_BIND: u32 = 150;
@@ -179,6 +196,9 @@ pub const SYS_CAPTURE_SCREEN: u32 = 161;
 pub const SYS_THREAD_CREATE: u32 = 170;
 pub const SYS_SET_PRIORITY: u32 = 171;
 pub const SYS_SET_CRITICAL: u32 = 172;
+pub const SYS_FUTEX_WAIT: u32 = 173;
+pub const SYS_FUTEX_WAKE: u32 = 174;
+pub const SYS_SLEEP_NS: u32 = 175;
 
 // Pipe listing
 pub const SYS_PIPE_LIST: u32 = 180;
@@ -223,6 +243,11 @@ pub const SYS_PIPE2: u32 = 240;
 pub const SYS_DUP: u32 = 241;
 pub const SYS_DUP2: u32 = 242;
 pub const SYS_FCNTL: u32 = 243;
+pub const SYS_SPLICE: u32 = 248;
+
+// Asynchronous I/O rings
+pub const SYS_IO_RING_SETUP: u32 = 261;
+pub const SYS_IO_RING_ENTER: u32 = 262;
 
 // POSIX signals
 pub const SYS_SIGACTION: u32 = 244;
@@ -253,6 +278,8 @@ pub const SYS_GPU_3D_QUERY: u32  = 513;
 pub const SYS_GPU_3D_SYNC: u32   = 514;
 pub const SYS_GPU_3D_SURFACE_DMA: u32 = 515;
 pub const SYS_GPU_3D_SURFACE_DMA_READ: u32 = 516;
+pub const SYS_GPU_3D_GMR_CREATE: u32 = 517;
+pub const SYS_GPU_3D_GMR_RELEASE: u32 = 518;
 
 // Disk / partition management
 pub const SYS_DISK_LIST: u32 = 270;
@@ -285,6 +312,20 @@ pub const SYS_DEBUG_SINGLE_STEP: u32    = 310;
 pub const SYS_DEBUG_GET_MEM_MAP: u32    = 311;
 pub const SYS_DEBUG_WAIT_EVENT: u32     = 312;
 pub const SYS_THREAD_INFO_EX: u32       = 313;
+pub const SYS_LOCK_STATS: u32           = 314;
+pub const SYS_SYSCALL_STATS: u32        = 315;
+pub const SYS_PROF_START: u32           = 316;
+pub const SYS_PROF_STOP: u32            = 317;
+pub const SYS_GPU_WAIT_VBLANK: u32      = 318;
+pub const SYS_GPU_RING_SETUP: u32       = 319;
+pub const SYS_GPU_RING_DOORBELL: u32    = 320;
+pub const SYS_GPU_FENCE_WAIT: u32       = 321;
+pub const SYS_HEAP_REPORT: u32          = 322;
+pub const SYS_THREAD_SNAPSHOT: u32      = 323;
+pub const SYS_IRQ_STATS: u32            = 324;
+pub const SYS_IRQ_AFFINITY: u32         = 325;
+pub const SYS_TRACE_CTL: u32            = 326;
+pub const SYS_TRACE_READ: u32           = 327;
 
 /// Register frame pushed by `syscall_entry.asm` / `syscall_fast.asm`.
 ///
@@ -345,6 +386,10 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         }
     }
 
+    // Latency accounting (SYS_SYSCALL_STATS); 0 = not recording.
+    let stats_t0 = if stats::enabled() { crate::arch::hal::cycle_counter() } else { 0 };
+    crate::task::tracepoints::emit(crate::task::tracepoints::SYSCALL_ENTRY, syscall_num as u64, arg1 as u64);
+
     let result = match syscall_num {
         // Process management
         SYS_EXIT => handlers::sys_exit(arg1),
@@ -358,6 +403,10 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_SBRK => handlers::sys_sbrk(arg1 as i32),
         SYS_MMAP => handlers::sys_mmap(arg1),
         SYS_MUNMAP => handlers::sys_munmap(arg1, arg2),
+        SYS_MMAP_FILE => handlers::sys_mmap_file(arg1, arg2, arg3, arg4, arg5),
+        SYS_POLL_CREATE => handlers::sys_poll_create(),
+        SYS_POLL_CTL => handlers::sys_poll_ctl(arg1, arg2, arg3),
+        SYS_POLL_WAIT => handlers::sys_poll_wait(arg1, arg2, arg3, arg4),
         SYS_WAITPID => handlers::sys_waitpid(arg1, arg2, arg3),
         SYS_KILL => handlers::sys_kill(arg1, arg2),
         SYS_SPAWN => handlers::sys_spawn(arg1, arg2, arg3, arg4),
@@ -376,6 +425,7 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
 
         // Filesystem
         SYS_READDIR => handlers::sys_readdir(arg1, arg2, arg3),
+        SYS_GETDENTS => handlers::sys_getdents(arg1, arg2, arg3, arg4),
         SYS_STAT => handlers::sys_stat(arg1, arg2),
         SYS_GETCWD => handlers::sys_getcwd(arg1, arg2),
         SYS_CHDIR => handlers::sys_chdir(arg1),
@@ -393,6 +443,8 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_FSTAT => handlers::sys_fstat(arg1, arg2),
         SYS_FTRUNCATE => handlers::sys_ftruncate(arg1, arg2),
         SYS_ISATTY => handlers::sys_isatty(arg1),
+        SYS_FSYNC => handlers::sys_fsync(arg1),
+        SYS_FLOCK => handlers::sys_flock(arg1, arg2),
 
         // System info
         SYS_TIME => handlers::sys_time(arg1),
@@ -420,6 +472,7 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_TCP_LISTEN => handlers::sys_tcp_listen(arg1, arg2),
         SYS_TCP_ACCEPT => handlers::sys_tcp_accept(arg1, arg2),
         SYS_TCP_LIST => handlers::sys_tcp_list(arg1, arg2),
+        SYS_SENDFILE => handlers::sys_sendfile(arg1, arg2, arg3, arg4),
 
         // Network polling
         SYS_NET_POLL => handlers::sys_net_poll(),
@@ -456,6 +509,8 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_EVT_CHAN_DESTROY => handlers::sys_evt_chan_destroy(arg1),
         SYS_EVT_CHAN_EMIT_TO => handlers::sys_evt_chan_emit_to(arg1, arg2, arg3),
         SYS_EVT_CHAN_WAIT => handlers::sys_evt_chan_wait(arg1, arg2, arg3),
+        SYS_EVT_CHAN_POLL_BATCH => handlers::sys_evt_chan_poll_batch(arg1, arg2, arg3, arg4),
+        SYS_EVT_CHAN_RING => handlers::sys_evt_chan_ring(arg1, arg2),
 
         // Display / GPU
         SYS_SCREEN_SIZE => handlers::sys_screen_size(arg1),
@@ -475,6 +530,8 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_SHM_MAP => handlers::sys_shm_map(arg1),
         SYS_SHM_UNMAP => handlers::sys_shm_unmap(arg1),
         SYS_SHM_DESTROY => handlers::sys_shm_destroy(arg1),
+        SYS_SHM_GRANT => handlers::sys_shm_grant(arg1),
+        SYS_SHM_CLAIM => handlers::sys_shm_claim(arg1),
 
         // Compositor-privileged
         SYS_MAP_FRAMEBUFFER => handlers::sys_map_framebuffer(arg1),
@@ -490,6 +547,9 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_THREAD_CREATE => handlers::sys_thread_create(arg1, arg2, arg3, arg4, arg5),
         SYS_SET_PRIORITY => handlers::sys_set_priority(arg1, arg2),
         SYS_SET_CRITICAL => handlers::sys_set_critical(),
+        SYS_FUTEX_WAIT => handlers::sys_futex_wait(arg1, arg2, arg3),
+        SYS_FUTEX_WAKE => handlers::sys_futex_wake(arg1, arg2),
+        SYS_SLEEP_NS => handlers::sys_sleep_ns(arg1, arg2),
 
         // Pipe listing
         SYS_PIPE_LIST => handlers::sys_pipe_list(arg1, arg2),
@@ -534,6 +594,11 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_DUP => handlers::sys_dup(arg1),
         SYS_DUP2 => handlers::sys_dup2(arg1, arg2),
         SYS_FCNTL => handlers::sys_fcntl(arg1, arg2, arg3),
+        SYS_SPLICE => handlers::sys_splice(arg1, arg2, arg3, arg4),
+
+        // Asynchronous I/O rings
+        SYS_IO_RING_SETUP => handlers::sys_io_ring_setup(arg1, arg2, arg3),
+        SYS_IO_RING_ENTER => handlers::sys_io_ring_enter(arg1, arg2, arg3, arg4),
 
         // POSIX signals (SYS_SIGRETURN intercepted at dispatch level, not here)
         SYS_SIGACTION => handlers::sys_sigaction(arg1, arg2),
@@ -572,6 +637,8 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_GPU_3D_SYNC => handlers::sys_gpu_3d_sync(),
         SYS_GPU_3D_SURFACE_DMA => handlers::sys_gpu_3d_surface_dma(arg1, arg2, arg3, arg4, arg5),
         SYS_GPU_3D_SURFACE_DMA_READ => handlers::sys_gpu_3d_surface_dma_read(arg1, arg2, arg3, arg4, arg5),
+        SYS_GPU_3D_GMR_CREATE => handlers::sys_gpu_3d_gmr_create(arg1, arg2),
+        SYS_GPU_3D_GMR_RELEASE => handlers::sys_gpu_3d_gmr_release(arg1),
 
         // Hostname
         SYS_GET_HOSTNAME => handlers::sys_get_hostname(arg1, arg2),
@@ -595,6 +662,20 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         SYS_DEBUG_GET_MEM_MAP => handlers::sys_debug_get_mem_map(arg1, arg2, arg3),
         SYS_DEBUG_WAIT_EVENT => handlers::sys_debug_wait_event(arg1, arg2, arg3),
         SYS_THREAD_INFO_EX => handlers::sys_thread_info_ex(arg1, arg2, arg3),
+        SYS_LOCK_STATS => handlers::sys_lock_stats(arg1, arg2, arg3),
+        SYS_SYSCALL_STATS => handlers::sys_syscall_stats(arg1, arg2, arg3, arg4),
+        SYS_PROF_START => handlers::sys_prof_start(arg1),
+        SYS_PROF_STOP => handlers::sys_prof_stop(),
+        SYS_GPU_WAIT_VBLANK => handlers::sys_gpu_wait_vblank(arg1),
+        SYS_GPU_RING_SETUP => handlers::sys_gpu_ring_setup(arg1, arg2),
+        SYS_GPU_RING_DOORBELL => handlers::sys_gpu_ring_doorbell(),
+        SYS_GPU_FENCE_WAIT => handlers::sys_gpu_fence_wait(arg1),
+        SYS_HEAP_REPORT => handlers::sys_heap_report(arg1, arg2),
+        SYS_THREAD_SNAPSHOT => handlers::sys_thread_snapshot(arg1, arg2, arg3),
+        SYS_IRQ_STATS => handlers::sys_irq_stats(arg1, arg2),
+        SYS_IRQ_AFFINITY => handlers::sys_irq_affinity(arg1, arg2),
+        SYS_TRACE_CTL => handlers::sys_trace_ctl(arg1, arg2),
+        SYS_TRACE_READ => handlers::sys_trace_read(arg1, arg2),
 
         _ => {
             crate::serial_println!("Unknown syscall: {}", syscall_num);
@@ -613,6 +694,11 @@ pub(crate) fn dispatch_inner(syscall_num: u32, arg1: u32, arg2: u32, arg3: u32,
         }
     }
 
+    if stats_t0 != 0 {
+        stats::record(syscall_num, stats_t0);
+    }
+    crate::task::tracepoints::emit(crate::task::tracepoints::SYSCALL_EXIT, syscall_num as u64, result as u64);
+
     // Post-syscall stack canary check: catch overflows before returning to user
     crate::task::scheduler::check_current_stack_canary(syscall_num);
 
@@ -0,0 +1,246 @@
+//! Per-syscall call counts and latency histograms.
+//!
+//! Off by default; `SYS_SYSCALL_STATS` switches it on at run time.  While
+//! enabled, [`dispatch_inner`](super::dispatch_inner) times every syscall
+//! with [`hal::cycle_counter`](crate::arch::hal::cycle_counter) and records
+//! it in two places:
+//!
+//! - a per-CPU table indexed by syscall number: calls, total cycles, and a
+//!   log2 histogram (bucket `i` counts calls of `[2^i, 2^(i+1))` cycles), so
+//!   CPUs never contend for a cache line;
+//! - a small per-thread table of call and cycle totals (the "per process"
+//!   view: anyOS processes are threads, keyed by TID).
+//!
+//! Latency is measured from dispatch to return, so syscalls that block
+//! (sleep, waits) include the blocked time.  The per-CPU tables are
+//! allocated on first enable and never freed; a disabled kernel pays one
+//! relaxed load per syscall.
+
+use crate::arch::hal::MAX_CPUS;
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicPtr, AtomicU32, AtomicU64, Ordering};
+
+/// Syscall numbers tracked (higher numbers are not recorded).
+pub const NSYS: usize = 320;
+
+/// Histogram buckets (cycle counts of 2^31 and up share the last one).
+pub const BUCKETS: usize = 32;
+
+/// Threads tracked in the per-thread table.  Threads beyond it are only
+/// counted in the per-syscall tables.
+const THREAD_SLOTS: usize = 256;
+
+/// Bytes of the syscall name kept per record (NUL-padded).
+pub const NAME_LEN: usize = 24;
+
+/// One syscall number as returned by `SYS_SYSCALL_STATS` (176 bytes, must
+/// match `anyos_std::debug::SyscallStat`).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct SyscallStatRecord {
+    pub name: [u8; NAME_LEN],
+    pub num: u32,
+    pub _pad: u32,
+    pub calls: u64,
+    pub cycles: u64,
+    pub hist: [u32; BUCKETS],
+}
+
+/// Per-thread totals as returned by `SYS_SYSCALL_STATS` (24 bytes, must
+/// match `anyos_std::debug::SyscallThreadStat`).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct ThreadStatRecord {
+    pub tid: u32,
+    pub _pad: u32,
+    pub calls: u64,
+    pub cycles: u64,
+}
+
+struct Entry {
+    calls: AtomicU64,
+    cycles: AtomicU64,
+    hist: [AtomicU32; BUCKETS],
+}
+
+struct CpuTable {
+    entries: [Entry; NSYS],
+}
+
+struct ThreadSlot {
+    /// 0 = free slot.
+    tid: AtomicU32,
+    calls: AtomicU64,
+    cycles: AtomicU64,
+}
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// Only syscalls of this TID are recorded (0 = all threads).
+static FILTER_TID: AtomicU32 = AtomicU32::new(0);
+
+static CPU_TABLES: [AtomicPtr<CpuTable>; MAX_CPUS] = {
+    const INIT: AtomicPtr<CpuTable> = AtomicPtr::new(core::ptr::null_mut());
+    [INIT; MAX_CPUS]
+};
+
+static THREADS: [ThreadSlot; THREAD_SLOTS] = {
+    const INIT: ThreadSlot = ThreadSlot {
+        tid: AtomicU32::new(0),
+        calls: AtomicU64::new(0),
+        cycles: AtomicU64::new(0),
+    };
+    [INIT; THREAD_SLOTS]
+};
+
+/// True while syscalls are being recorded.
+#[inline(always)]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// Start recording.  Allocates the per-CPU tables on first use, so call
+/// with no spinlock held.
+pub fn enable() {
+    let cpus = crate::arch::hal::cpu_count().min(MAX_CPUS);
+    for table in CPU_TABLES[..cpus].iter() {
+        if table.load(Ordering::Acquire).is_null() {
+            // SAFETY: all-zero is a valid `CpuTable` (atomics only).
+            let fresh: Box<CpuTable> = unsafe { Box::new_zeroed().assume_init() };
+            let ptr = Box::into_raw(fresh);
+            if table
+                .compare_exchange(core::ptr::null_mut(), ptr, Ordering::AcqRel, Ordering::Acquire)
+                .is_err()
+            {
+                drop(unsafe { Box::from_raw(ptr) });
+            }
+        }
+    }
+    ENABLED.store(true, Ordering::Release);
+}
+
+pub fn disable() {
+    ENABLED.store(false, Ordering::Release);
+}
+
+/// Restrict recording to one thread (0 = all threads).
+pub fn set_filter(tid: u32) {
+    FILTER_TID.store(tid, Ordering::Relaxed);
+}
+
+pub fn filter() -> u32 {
+    FILTER_TID.load(Ordering::Relaxed)
+}
+
+/// Account one syscall that started at cycle `t0`.
+pub fn record(num: u32, t0: u64) {
+    let cycles = crate::arch::hal::cycle_counter().wrapping_sub(t0);
+    let cpu = crate::arch::hal::cpu_id();
+    let tid = crate::task::scheduler::per_cpu_current_tid(cpu);
+    let filter = FILTER_TID.load(Ordering::Relaxed);
+    if filter != 0 && tid != filter {
+        return;
+    }
+
+    if (num as usize) < NSYS && cpu < MAX_CPUS {
+        let table = CPU_TABLES[cpu].load(Ordering::Acquire);
+        if !table.is_null() {
+            // SAFETY: tables are never freed once published.
+            let e = unsafe { &(*table).entries[num as usize] };
+            let bucket = (63 - (cycles | 1).leading_zeros() as usize).min(BUCKETS - 1);
+            e.calls.fetch_add(1, Ordering::Relaxed);
+            e.cycles.fetch_add(cycles, Ordering::Relaxed);
+            e.hist[bucket].fetch_add(1, Ordering::Relaxed);
+        }
+    }
+
+    if tid != 0 {
+        if let Some(slot) = thread_slot(tid) {
+            slot.calls.fetch_add(1, Ordering::Relaxed);
+            slot.cycles.fetch_add(cycles, Ordering::Relaxed);
+        }
+    }
+}
+
+/// Find or claim the slot for `tid` (open addressing, linear probe).
+fn thread_slot(tid: u32) -> Option<&'static ThreadSlot> {
+    let mut i = (tid as usize).wrapping_mul(0x9E37_79B9) & (THREAD_SLOTS - 1);
+    for _ in 0..THREAD_SLOTS {
+        let slot = &THREADS[i];
+        match slot.tid.compare_exchange(0, tid, Ordering::AcqRel, Ordering::Acquire) {
+            Ok(_) => return Some(slot),
+            Err(t) if t == tid => return Some(slot),
+            Err(_) => i = (i + 1) & (THREAD_SLOTS - 1),
+        }
+    }
+    None
+}
+
+/// Sum the per-CPU tables into one record per syscall number that has
+/// been called.
+pub fn snapshot_syscalls() -> Vec<SyscallStatRecord> {
+    let mut out = Vec::new();
+    for num in 0..NSYS {
+        let mut rec = SyscallStatRecord {
+            name: [0; NAME_LEN], num: num as u32, _pad: 0, calls: 0, cycles: 0, hist: [0; BUCKETS],
+        };
+        for table in CPU_TABLES.iter() {
+            let table = table.load(Ordering::Acquire);
+            if table.is_null() {
+                continue;
+            }
+            let e = unsafe { &(*table).entries[num] };
+            rec.calls += e.calls.load(Ordering::Relaxed);
+            rec.cycles += e.cycles.load(Ordering::Relaxed);
+            for (b, h) in rec.hist.iter_mut().zip(e.hist.iter()) {
+                *b += h.load(Ordering::Relaxed);
+            }
+        }
+        if rec.calls != 0 {
+            let name = super::table::syscall_name(num as u32).as_bytes();
+            let n = name.len().min(NAME_LEN - 1);
+            rec.name[..n].copy_from_slice(&name[..n]);
+            out.push(rec);
+        }
+    }
+    out
+}
+
+/// Per-thread totals of every thread seen since the last reset.
+pub fn snapshot_threads() -> Vec<ThreadStatRecord> {
+    THREADS
+        .iter()
+        .filter_map(|s| {
+            let tid = s.tid.load(Ordering::Acquire);
+            (tid != 0).then(|| ThreadStatRecord {
+                tid,
+                _pad: 0,
+                calls: s.calls.load(Ordering::Relaxed),
+                cycles: s.cycles.load(Ordering::Relaxed),
+            })
+        })
+        .collect()
+}
+
+/// Zero all counters and forget the threads seen so far.
+pub fn reset() {
+    for table in CPU_TABLES.iter() {
+        let table = table.load(Ordering::Acquire);
+        if table.is_null() {
+            continue;
+        }
+        for e in unsafe { (*table).entries.iter() } {
+            e.calls.store(0, Ordering::Relaxed);
+            e.cycles.store(0, Ordering::Relaxed);
+            for h in e.hist.iter() {
+                h.store(0, Ordering::Relaxed);
+            }
+        }
+    }
+    for slot in THREADS.iter() {
+        slot.calls.store(0, Ordering::Relaxed);
+        slot.cycles.store(0, Ordering::Relaxed);
+        slot.tid.store(0, Ordering::Release);
+    }
+}
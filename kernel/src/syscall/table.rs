@@ -34,6 +34,7 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_DEVIOCTL, "devioctl"),
     (SYS_IRQWAIT, "irqwait"),
     (SYS_READDIR, "readdir"),
+    (SYS_GETDENTS, "getdents"),
     (SYS_STAT, "stat"),
     (SYS_GETCWD, "getcwd"),
     (SYS_CHDIR, "chdir"),
@@ -46,12 +47,19 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_DMESG, "dmesg"),
     (SYS_TICK_HZ, "tick_hz"),
     (SYS_UPTIME_MS, "uptime_ms"),
+    (SYS_MMAP_FILE, "mmap_file"),
+    (SYS_POLL_CREATE, "poll_create"),
+    (SYS_POLL_CTL, "poll_ctl"),
+    (SYS_POLL_WAIT, "poll_wait"),
     (SYS_PIPE_CREATE, "pipe_create"),
     (SYS_PIPE_READ, "pipe_read"),
     (SYS_PIPE_CLOSE, "pipe_close"),
     (SYS_PIPE_WRITE, "pipe_write"),
     (SYS_PIPE_OPEN, "pipe_open"),
     (SYS_PIPE_LIST, "pipe_list"),
+    (SYS_FUTEX_WAIT, "futex_wait"),
+    (SYS_FUTEX_WAKE, "futex_wake"),
+    (SYS_SLEEP_NS, "sleep_ns"),
     (SYS_KBD_GET_LAYOUT, "kbd_get_layout"),
     (SYS_KBD_SET_LAYOUT, "kbd_set_layout"),
     (SYS_KBD_LIST_LAYOUTS, "kbd_list_layouts"),
@@ -60,6 +68,8 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_LSTAT, "lstat"),
     (SYS_RENAME, "rename"),
     (SYS_FTRUNCATE, "ftruncate"),
+    (SYS_FSYNC, "fsync"),
+    (SYS_FLOCK, "flock"),
     (SYS_GET_CAPABILITIES, "get_capabilities"),
     (SYS_BOOT_READY, "boot_ready"),
     (SYS_GETUID, "getuid"),
@@ -79,6 +89,9 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_DUP, "dup"),
     (SYS_DUP2, "dup2"),
     (SYS_FCNTL, "fcntl"),
+    (SYS_SPLICE, "splice"),
+    (SYS_IO_RING_SETUP, "io_ring_setup"),
+    (SYS_IO_RING_ENTER, "io_ring_enter"),
     (SYS_SIGACTION, "sigaction"),
     (SYS_SIGPROCMASK, "sigprocmask"),
     (SYS_SIGRETURN, "sigreturn"),
@@ -102,6 +115,7 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_TCP_LISTEN, "tcp_listen"),
     (SYS_TCP_ACCEPT, "tcp_accept"),
     (SYS_TCP_LIST, "tcp_list"),
+    (SYS_SENDFILE, "sendfile"),
     (SYS_UDP_LIST, "udp_list"),
     (SYS_NET_STATS, "net_stats"),
     (SYS_PIPE_BYTES_AVAILABLE, "pipe_bytes_available"),
@@ -110,6 +124,8 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_GPU_3D_SYNC, "gpu_3d_sync"),
     (SYS_GPU_3D_SURFACE_DMA, "gpu_3d_surface_dma"),
     (SYS_GPU_3D_SURFACE_DMA_READ, "gpu_3d_surface_dma_read"),
+    (SYS_GPU_3D_GMR_CREATE, "gpu_3d_gmr_create"),
+    (SYS_GPU_3D_GMR_RELEASE, "gpu_3d_gmr_release"),
     (SYS_GET_HOSTNAME, "get_hostname"),
     (SYS_SET_HOSTNAME, "set_hostname"),
     (SYS_SHUTDOWN, "shutdown"),
@@ -128,6 +144,90 @@ pub const SYSCALL_TABLE: &[(u32, &str)] = &[
     (SYS_DEBUG_GET_MEM_MAP, "debug_get_mem_map"),
     (SYS_DEBUG_WAIT_EVENT, "debug_wait_event"),
     (SYS_THREAD_INFO_EX, "thread_info_ex"),
+    (SYS_LOCK_STATS, "lock_stats"),
+    (SYS_SYSCALL_STATS, "syscall_stats"),
+    (SYS_PROF_START, "prof_start"),
+    (SYS_PROF_STOP, "prof_stop"),
+    (SYS_GPU_WAIT_VBLANK, "gpu_wait_vblank"),
+    (SYS_GPU_RING_SETUP, "gpu_ring_setup"),
+    (SYS_GPU_RING_DOORBELL, "gpu_ring_doorbell"),
+    (SYS_GPU_FENCE_WAIT, "gpu_fence_wait"),
+    (SYS_HEAP_REPORT, "heap_report"),
+    (SYS_THREAD_SNAPSHOT, "thread_snapshot"),
+    (SYS_IRQ_STATS, "irq_stats"),
+    (SYS_IRQ_AFFINITY, "irq_affinity"),
+    (SYS_TRACE_CTL, "trace_ctl"),
+    (SYS_TRACE_READ, "trace_read"),
+    (SYS_NET_CONFIG, "net_config"),
+    (SYS_NET_PING, "net_ping"),
+    (SYS_NET_DHCP, "net_dhcp"),
+    (SYS_NET_DNS, "net_dns"),
+    (SYS_NET_ARP, "net_arp"),
+    (SYS_MKDIR, "mkdir"),
+    (SYS_UNLINK, "unlink"),
+    (SYS_TRUNCATE, "truncate"),
+    (SYS_MOUNT, "mount"),
+    (SYS_UMOUNT, "umount"),
+    (SYS_LIST_MOUNTS, "list_mounts"),
+    (SYS_LSEEK, "lseek"),
+    (SYS_FSTAT, "fstat"),
+    (SYS_ISATTY, "isatty"),
+    (SYS_NET_POLL, "net_poll"),
+    (SYS_DLL_LOAD, "dll_load"),
+    (SYS_EVT_SYS_SUBSCRIBE, "evt_sys_subscribe"),
+    (SYS_EVT_SYS_POLL, "evt_sys_poll"),
+    (SYS_EVT_SYS_UNSUBSCRIBE, "evt_sys_unsubscribe"),
+    (SYS_EVT_CHAN_CREATE, "evt_chan_create"),
+    (SYS_EVT_CHAN_SUBSCRIBE, "evt_chan_subscribe"),
+    (SYS_EVT_CHAN_EMIT, "evt_chan_emit"),
+    (SYS_EVT_CHAN_POLL, "evt_chan_poll"),
+    (SYS_EVT_CHAN_UNSUBSCRIBE, "evt_chan_unsubscribe"),
+    (SYS_EVT_CHAN_DESTROY, "evt_chan_destroy"),
+    (SYS_EVT_CHAN_EMIT_TO, "evt_chan_emit_to"),
+    (SYS_EVT_CHAN_WAIT, "evt_chan_wait"),
+    (SYS_EVT_CHAN_POLL_BATCH, "evt_chan_poll_batch"),
+    (SYS_EVT_CHAN_RING, "evt_chan_ring"),
+    (SYS_SCREEN_SIZE, "screen_size"),
+    (SYS_SET_RESOLUTION, "set_resolution"),
+    (SYS_LIST_RESOLUTIONS, "list_resolutions"),
+    (SYS_GPU_INFO, "gpu_info"),
+    (SYS_GPU_HAS_ACCEL, "gpu_has_accel"),
+    (SYS_GPU_HAS_HW_CURSOR, "gpu_has_hw_cursor"),
+    (SYS_AUDIO_WRITE, "audio_write"),
+    (SYS_AUDIO_CTL, "audio_ctl"),
+    (SYS_SHM_CREATE, "shm_create"),
+    (SYS_SHM_MAP, "shm_map"),
+    (SYS_SHM_UNMAP, "shm_unmap"),
+    (SYS_SHM_DESTROY, "shm_destroy"),
+    (SYS_SHM_GRANT, "shm_grant"),
+    (SYS_SHM_CLAIM, "shm_claim"),
+    (SYS_UDP_BIND, "udp_bind"),
+    (SYS_UDP_UNBIND, "udp_unbind"),
+    (SYS_UDP_SENDTO, "udp_sendto"),
+    (SYS_UDP_RECVFROM, "udp_recvfrom"),
+    (SYS_UDP_SET_OPT, "udp_set_opt"),
+    (SYS_MAP_FRAMEBUFFER, "map_framebuffer"),
+    (SYS_GPU_COMMAND, "gpu_command"),
+    (SYS_INPUT_POLL, "input_poll"),
+    (SYS_REGISTER_COMPOSITOR, "register_compositor"),
+    (SYS_CURSOR_TAKEOVER, "cursor_takeover"),
+    (SYS_CAPTURE_SCREEN, "capture_screen"),
+    (SYS_THREAD_CREATE, "thread_create"),
+    (SYS_SET_PRIORITY, "set_priority"),
+    (SYS_SET_CRITICAL, "set_critical"),
+    (SYS_SETENV, "setenv"),
+    (SYS_GETENV, "getenv"),
+    (SYS_LISTENV, "listenv"),
+    (SYS_SET_DLL_U32, "set_dll_u32"),
+    (SYS_RANDOM, "random"),
+    (SYS_CHPASSWD, "chpasswd"),
+    (SYS_DISK_LIST, "disk_list"),
+    (SYS_DISK_PARTITIONS, "disk_partitions"),
+    (SYS_DISK_READ, "disk_read"),
+    (SYS_DISK_WRITE, "disk_write"),
+    (SYS_PARTITION_CREATE, "partition_create"),
+    (SYS_PARTITION_DELETE, "partition_delete"),
+    (SYS_PARTITION_RESCAN, "partition_rescan"),
 ];
 
 /// Look up the human-readable name for a syscall number.
@@ -87,6 +87,7 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_GETPID
         | syscall::SYS_YIELD
         | syscall::SYS_SLEEP
+        | syscall::SYS_SLEEP_NS
         | syscall::SYS_SBRK
         | syscall::SYS_GETARGS
         | syscall::SYS_TIME
@@ -113,6 +114,7 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_WRITE
         | syscall::SYS_CLOSE
         | syscall::SYS_READDIR
+        | syscall::SYS_GETDENTS
         | syscall::SYS_STAT
         | syscall::SYS_LSTAT
         | syscall::SYS_MKDIR
@@ -131,11 +133,16 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_CHOWN
         | syscall::SYS_RENAME
         | syscall::SYS_FTRUNCATE
+        // I/O rings — always allowed; TCP entries check CAP_NETWORK per entry
+        | syscall::SYS_IO_RING_SETUP
+        | syscall::SYS_IO_RING_ENTER
         // Shared memory — always allowed (GUI apps need SHM for window surfaces)
         | syscall::SYS_SHM_CREATE
         | syscall::SYS_SHM_MAP
         | syscall::SYS_SHM_UNMAP
         | syscall::SYS_SHM_DESTROY
+        | syscall::SYS_SHM_GRANT
+        | syscall::SYS_SHM_CLAIM
         // Crash info — always allowed
         | syscall::SYS_GET_CRASH_INFO
         // Uptime (TSC-based ms) — always allowed
@@ -150,7 +157,9 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_GPU_3D_QUERY
         | syscall::SYS_GPU_3D_SYNC
         | syscall::SYS_GPU_3D_SURFACE_DMA
-        | syscall::SYS_GPU_3D_SURFACE_DMA_READ => 0,
+        | syscall::SYS_GPU_3D_SURFACE_DMA_READ
+        | syscall::SYS_GPU_3D_GMR_CREATE
+        | syscall::SYS_GPU_3D_GMR_RELEASE => 0,
 
         // Networking
         syscall::SYS_NET_CONFIG
@@ -167,7 +176,8 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_TCP_CLOSE
         | syscall::SYS_TCP_STATUS
         | syscall::SYS_TCP_RECV_AVAILABLE
-        | syscall::SYS_TCP_SHUTDOWN_WR => CAP_NETWORK,
+        | syscall::SYS_TCP_SHUTDOWN_WR
+        | syscall::SYS_SENDFILE => CAP_NETWORK,
 
         // UDP
         syscall::SYS_UDP_BIND
@@ -217,6 +227,8 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_EVT_CHAN_SUBSCRIBE
         | syscall::SYS_EVT_CHAN_EMIT
         | syscall::SYS_EVT_CHAN_POLL
+        | syscall::SYS_EVT_CHAN_POLL_BATCH
+        | syscall::SYS_EVT_CHAN_RING
         | syscall::SYS_EVT_CHAN_UNSUBSCRIBE
         | syscall::SYS_EVT_CHAN_DESTROY
         | syscall::SYS_EVT_CHAN_EMIT_TO => CAP_EVENT,
@@ -234,6 +246,9 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
 
         // System admin
         syscall::SYS_SYSINFO
+        | syscall::SYS_THREAD_SNAPSHOT
+        | syscall::SYS_IRQ_STATS
+        | syscall::SYS_IRQ_AFFINITY
         | syscall::SYS_DMESG
         | syscall::SYS_SETENV
         | syscall::SYS_LISTENV
@@ -275,7 +290,13 @@ pub fn required_cap(syscall_num: u32) -> CapSet {
         | syscall::SYS_DEBUG_SINGLE_STEP
         | syscall::SYS_DEBUG_GET_MEM_MAP
         | syscall::SYS_DEBUG_WAIT_EVENT
-        | syscall::SYS_THREAD_INFO_EX => CAP_DEBUG,
+        | syscall::SYS_THREAD_INFO_EX
+        | syscall::SYS_LOCK_STATS
+        | syscall::SYS_SYSCALL_STATS
+        | syscall::SYS_PROF_START
+        | syscall::SYS_PROF_STOP
+        | syscall::SYS_TRACE_CTL
+        | syscall::SYS_TRACE_READ => CAP_DEBUG,
 
         // Unknown syscalls — let the dispatch handle it (returns u32::MAX)
         _ => 0,
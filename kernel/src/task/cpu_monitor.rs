@@ -2,7 +2,8 @@
 //!
 //! Samples scheduler tick counters every ~100 ms, computes the CPU busy percentage,
 //! and writes the result to the `sys:cpu_load` named pipe for consumption by userspace
-//! (e.g. the Settings or system monitor application).
+//! (e.g. the Settings or system monitor application).  On x86 it also runs
+//! the interrupt balancer once a second.
 
 use crate::ipc::pipe;
 use crate::task::scheduler;
@@ -24,6 +25,8 @@ pub extern "C" fn start() {
 
     let mut prev_total = scheduler::total_sched_ticks();
     let mut prev_idle = scheduler::idle_sched_ticks();
+    #[cfg(target_arch = "x86_64")]
+    let mut samples: u32 = 0;
 
     loop {
         // Sleep ~100ms using blocking sleep (no CPU waste)
@@ -59,5 +62,13 @@ pub extern "C" fn start() {
         pipe::clear(freq_pipe);
         let freq_bytes = freq.to_le_bytes();
         pipe::write(freq_pipe, &freq_bytes);
+
+        #[cfg(target_arch = "x86_64")]
+        {
+            samples = samples.wrapping_add(1);
+            if samples % 10 == 0 {
+                crate::arch::x86::irq_balance::balance();
+            }
+        }
     }
 }
@@ -24,14 +24,21 @@ const PAGE_USER: u64 = 0x04;
 const PAGE_WRITABLE: u64 = 0x02;
 
 /// Next available virtual address for dynamically loaded DLIBs.
-/// Starts after the last boot-time DLIB (0x0440_0000), incremented per load.
-static NEXT_DYNAMIC_BASE: AtomicU64 = AtomicU64::new(0x0440_0000);
+/// Starts after the prelinked .so slots (libanyui 0x0440_0000, libsvg
+/// 0x04F0_0000, see `add_shared_lib` in cmake/UserPrograms.cmake), so a
+/// base-0 library can never take the range of a prelinked one that has
+/// not been loaded yet. Incremented per load.
+static NEXT_DYNAMIC_BASE: AtomicU64 = AtomicU64::new(0x0500_0000);
 
 /// DLIB virtual address range: 0x04000000 - 0x07FFFFFF.
 /// In x86-64 4-level paging, these are PML4[0], PDPT[0], PD[32..63].
 pub const DLL_PD_START: usize = 32; // 0x04000000 >> 21 & 0x1FF
 pub const DLL_PD_END: usize = 63; // 0x07FFFFFF >> 21 & 0x1FF
 
+/// End of the range available to DLIBs and .so files.  The last page of the
+/// region is the shared time page (see [`crate::task::timepage`]).
+const DLL_REGION_END: u64 = 0x07FF_F000;
+
 /// Temp virtual addresses for demand-page copy operations.
 /// Used only while LOADED_DLLS lock is held (serialized).
 #[cfg(target_arch = "x86_64")]
@@ -132,6 +139,7 @@ const DT_STRTAB: i64 = 5;
 const DT_SYMTAB: i64 = 6;
 const DT_RELA: i64 = 7;
 const DT_RELASZ: i64 = 8;
+const DT_GNU_HASH: i64 = 0x6FFF_FEF5;
 
 const R_X86_64_RELATIVE: u32 = 8;
 const R_X86_64_32: u32 = 10;
@@ -436,7 +444,7 @@ fn apply_elf_relocations(
         let d_tag = read_u64_le(file_data, pos) as i64;
         let d_val = read_u64_le(file_data, pos + 8);
 
-        let needs_fixup = matches!(d_tag, DT_HASH | DT_STRTAB | DT_SYMTAB | DT_RELA);
+        let needs_fixup = matches!(d_tag, DT_HASH | DT_GNU_HASH | DT_STRTAB | DT_SYMTAB | DT_RELA);
 
         if needs_fixup && d_val != 0 {
             let new_val = d_val + load_bias;
@@ -570,7 +578,7 @@ fn load_elf64_so(data: &[u8], path: &str) -> Option<u64> {
         };
         let aligned_size = (total_vsize + PAGE_SIZE - 1) & !(PAGE_SIZE - 1);
         let b = NEXT_DYNAMIC_BASE.fetch_add(aligned_size, Ordering::SeqCst);
-        if b + aligned_size > 0x0800_0000 {
+        if b + aligned_size > DLL_REGION_END {
             crate::serial_println!("  dload: address space exhausted");
             return None;
         }
@@ -599,7 +607,7 @@ fn load_elf64_so(data: &[u8], path: &str) -> Option<u64> {
     let total_pages = ro_page_count + data_page_count + bss_page_count;
 
     let end_vaddr = actual_base + (total_pages as u64) * PAGE_SIZE;
-    if end_vaddr > 0x0800_0000 {
+    if end_vaddr > DLL_REGION_END {
         crate::serial_println!("  dload: .so at {:#x} exceeds DLIB range", actual_base);
         return None;
     }
@@ -810,9 +818,9 @@ pub fn load_dll(path: &str, expected_base: u64) -> Result<u32, &'static str> {
     Ok(total)
 }
 
-/// Map all loaded DLIBs' shared RO pages into a process page directory.
-/// Per-process .data/.bss pages are NOT pre-mapped — they are demand-paged
-/// via handle_dll_demand_page() on first access.
+/// Map all loaded DLIBs' shared RO pages, and the shared time page, into a
+/// process page directory.  Per-process .data/.bss pages are NOT pre-mapped —
+/// they are demand-paged via handle_dll_demand_page() on first access.
 pub fn map_all_dlls_into(pd_phys: PhysAddr) {
     // Phase 1: Under lock — collect (virt, phys) pairs for RO pages only
     let page_maps: Vec<(VirtAddr, PhysAddr)> = {
@@ -833,6 +841,9 @@ pub fn map_all_dlls_into(pd_phys: PhysAddr) {
     for &(virt, phys) in &page_maps {
         virtual_mem::map_page_in_pd(pd_phys, virt, phys, PAGE_USER);
     }
+
+    #[cfg(target_arch = "x86_64")]
+    crate::task::timepage::map_into(pd_phys);
 }
 
 /// Handle a demand-page fault for DLIB pages.
@@ -969,7 +980,7 @@ fn load_dlib_v3_dynamic(data: &[u8], path: &str) -> Option<u64> {
     } else {
         let aligned_size = (total as u64) * PAGE_SIZE;
         let b = NEXT_DYNAMIC_BASE.fetch_add(aligned_size, Ordering::SeqCst);
-        if b + aligned_size > 0x0800_0000 {
+        if b + aligned_size > DLL_REGION_END {
             crate::serial_println!("  dload: DLIB address space exhausted at {:#x}", b);
             return None;
         }
@@ -977,7 +988,7 @@ fn load_dlib_v3_dynamic(data: &[u8], path: &str) -> Option<u64> {
     };
 
     // Sanity check: stay within DLIB range
-    if base + (total as u64) * PAGE_SIZE > 0x0800_0000 {
+    if base + (total as u64) * PAGE_SIZE > DLL_REGION_END {
         crate::serial_println!("  dload: DLIB at {:#x} exceeds range", base);
         return None;
     }
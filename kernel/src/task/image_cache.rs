@@ -0,0 +1,344 @@
+//! Executable image cache: recently run ELF64 binaries kept in memory.
+//!
+//! Spawning or exec'ing a binary normally re-reads its program headers and
+//! gives every process its own copy of each segment.  Images seen before are
+//! instead served from this cache, which holds the program headers already
+//! resolved into page runs and one set of physical frames per image:
+//!
+//! - read-only segments (`.text`, `.rodata`) are mapped straight into every
+//!   process, read-only, like DLIB `.text` (see [`crate::task::dll`]);
+//! - writable segments (`.data`) are a template mapped read-only with
+//!   [`PTE_COW`](virtual_mem::PTE_COW), so each process copies a page on its
+//!   first write to it;
+//! - pages past the file data of a writable segment (`.bss`) are fresh
+//!   zeroed frames per process.
+//!
+//! A cached spawn therefore only builds page tables.  Sharing uses the frame
+//! reference counts of copy-on-write fork: each mapping adds one owner and
+//! process teardown drops it, so an evicted image's frames are freed once
+//! the last process using them exits.
+//!
+//! Images are keyed by their page-cache identity `(mount, inode)` and size.
+//! The page cache forgets an image whenever it invalidates the file (write,
+//! truncate, delete, media change).  The cache is bounded by
+//! [`MAX_IMAGES`] and [`MAX_FRAMES`] and evicts the least recently used
+//! image; under memory pressure the reclaim thread also drops idle images
+//! ([`shrink`]).
+
+use crate::memory::address::{PhysAddr, VirtAddr};
+use crate::memory::{physical, virtual_mem};
+use crate::sync::spinlock::Spinlock;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+const PAGE_SIZE: u64 = 4096;
+const PAGE_WRITABLE: u64 = 0x02;
+const PAGE_USER: u64 = 0x04;
+
+/// Images kept at most.
+const MAX_IMAGES: usize = 16;
+/// Frames held by all cached images together (16 MiB).
+const MAX_FRAMES: usize = 4096;
+/// Larger images are never cached; they keep the demand-paged path.
+const MAX_IMAGE_FRAMES: usize = MAX_FRAMES / 4;
+
+/// Kernel alias used to fill image frames (only under [`FILL_LOCK`]).
+const FILL_TEMP: u64 = 0xFFFF_FFFF_BFF0_8000;
+static FILL_LOCK: Spinlock<()> = Spinlock::new(());
+
+/// A PT_LOAD segment as given by the loader (already validated).
+pub struct Segment {
+    pub vaddr: u64,
+    pub memsz: u64,
+    pub filesz: u64,
+    pub offset: u64,
+    pub writable: bool,
+    pub exec: bool,
+}
+
+struct CachedSegment {
+    /// First user page of the segment.
+    page_start: u64,
+    /// Shared frames from `page_start` on (file data, zero-padded).
+    frames: Vec<PhysAddr>,
+    /// Per-process zeroed pages after `frames` (writable segments only).
+    zero_pages: u64,
+    writable: bool,
+    exec: bool,
+}
+
+/// A cached executable.  Dropping the last reference releases the cache's
+/// own share of every frame.
+pub struct CachedImage {
+    key: (u32, u32, u32),
+    pub entry: u64,
+    /// End of the last segment, page-aligned (initial program break).
+    pub brk: u64,
+    segments: Vec<CachedSegment>,
+}
+
+impl CachedImage {
+    fn frame_count(&self) -> usize {
+        self.segments.iter().map(|s| s.frames.len()).sum()
+    }
+}
+
+impl Drop for CachedImage {
+    fn drop(&mut self) {
+        for seg in &self.segments {
+            for &frame in &seg.frames {
+                physical::free_frame(frame);
+            }
+        }
+    }
+}
+
+struct Cache {
+    /// Images with the clock value of their last use.
+    images: Vec<(Arc<CachedImage>, u64)>,
+    frames: usize,
+    clock: u64,
+}
+
+static CACHE: Spinlock<Cache> = Spinlock::new(Cache { images: Vec::new(), frames: 0, clock: 0 });
+
+/// The cached image of the open file `slot`, if any.
+pub fn lookup(slot: u32) -> Option<Arc<CachedImage>> {
+    let key = crate::fs::vfs::file_identity(slot)?;
+    let mut cache = CACHE.lock();
+    cache.clock += 1;
+    let now = cache.clock;
+    let (image, last_use) = cache.images.iter_mut().find(|(img, _)| img.key == key)?;
+    *last_use = now;
+    Some(image.clone())
+}
+
+/// Build the image of the open file `slot` from its PT_LOAD `segments` and
+/// add it to the cache.  Returns `None` (nothing cached) if the file has no
+/// stable identity, the image is too large, memory is short, or a read
+/// fails; the caller then loads the file the usual way.
+pub fn load(slot: u32, entry: u64, segments: &[Segment]) -> Option<Arc<CachedImage>> {
+    let key = crate::fs::vfs::file_identity(slot)?;
+    let gen = crate::fs::page_cache::generation();
+
+    // Shared frames per segment: all of a read-only one, the file-backed
+    // pages of a writable one.
+    let plan: Vec<(u64, u64, u64)> = segments
+        .iter()
+        .map(|s| {
+            let lead = s.vaddr & 0xFFF;
+            let page_start = s.vaddr - lead;
+            let pages = (lead + s.memsz + PAGE_SIZE - 1) / PAGE_SIZE;
+            let shared = if !s.writable {
+                pages
+            } else if s.filesz == 0 {
+                0
+            } else {
+                (lead + s.filesz + PAGE_SIZE - 1) / PAGE_SIZE
+            };
+            (page_start, pages, shared)
+        })
+        .collect();
+    let needed: u64 = plan.iter().map(|&(_, _, shared)| shared).sum();
+    if needed as usize > MAX_IMAGE_FRAMES
+        || physical::free_frames() < (physical::total_frames() / 32).max(512) + needed as usize
+    {
+        return None;
+    }
+
+    let mut image = CachedImage { key, entry, brk: 0, segments: Vec::with_capacity(segments.len()) };
+    let mut buf = alloc::vec![0u8; PAGE_SIZE as usize];
+    for (s, &(page_start, pages, shared)) in segments.iter().zip(plan.iter()) {
+        let lead = s.vaddr & 0xFFF;
+        // Bytes before p_vaddr in the first page come from the file, as
+        // with the demand-paged mapping.
+        let file_start = s.offset - lead;
+        let file_len = lead + s.filesz;
+        let mut seg = CachedSegment {
+            page_start,
+            frames: Vec::with_capacity(shared as usize),
+            zero_pages: pages - shared,
+            writable: s.writable,
+            exec: s.exec,
+        };
+        for p in 0..shared {
+            let off = p * PAGE_SIZE;
+            let n = file_len.saturating_sub(off).min(PAGE_SIZE) as usize;
+            buf.fill(0);
+            if n > 0 && !read_fully(slot, (file_start + off) as u32, &mut buf[..n]) {
+                image.segments.push(seg);
+                return None;
+            }
+            let frame = match physical::alloc_frame() {
+                Some(f) => f,
+                None => {
+                    image.segments.push(seg);
+                    return None;
+                }
+            };
+            fill_frame(frame, &buf);
+            seg.frames.push(frame);
+        }
+        image.brk = image.brk.max(s.vaddr + s.memsz);
+        image.segments.push(seg);
+    }
+    image.brk = (image.brk + PAGE_SIZE - 1) & !0xFFF;
+    let image = Arc::new(image);
+
+    // A write racing with the reads above may have left a stale image; it
+    // can still serve this spawn but is not kept.
+    if crate::fs::page_cache::generation() == gen {
+        insert(image.clone());
+    }
+    Some(image)
+}
+
+/// `read_at` until `buf` is full.  Returns `false` on error or early EOF.
+fn read_fully(slot: u32, offset: u32, buf: &mut [u8]) -> bool {
+    let mut done = 0;
+    while done < buf.len() {
+        match crate::fs::vfs::read_at(slot, offset + done as u32, &mut buf[done..]) {
+            Ok(0) | Err(_) => return false,
+            Ok(n) => done += n,
+        }
+    }
+    true
+}
+
+/// Copy one page into `frame` through the fill alias.
+fn fill_frame(frame: PhysAddr, data: &[u8]) {
+    let _guard = FILL_LOCK.lock();
+    let temp = VirtAddr::new(FILL_TEMP);
+    virtual_mem::map_page(temp, frame, PAGE_WRITABLE);
+    unsafe {
+        core::ptr::copy_nonoverlapping(data.as_ptr(), FILL_TEMP as *mut u8, PAGE_SIZE as usize);
+    }
+    virtual_mem::unmap_page(temp);
+}
+
+fn insert(image: Arc<CachedImage>) {
+    let frames = image.frame_count();
+    let mut evicted = Vec::new();
+    {
+        let mut cache = CACHE.lock();
+        if let Some(i) = cache.images.iter().position(|(img, _)| img.key == image.key) {
+            let (old, _) = cache.images.swap_remove(i);
+            cache.frames -= old.frame_count();
+            evicted.push(old);
+        }
+        while !cache.images.is_empty()
+            && (cache.images.len() >= MAX_IMAGES || cache.frames + frames > MAX_FRAMES)
+        {
+            let lru = cache
+                .images
+                .iter()
+                .enumerate()
+                .min_by_key(|(_, (_, last_use))| *last_use)
+                .map(|(i, _)| i)
+                .unwrap();
+            let (old, _) = cache.images.swap_remove(lru);
+            cache.frames -= old.frame_count();
+            evicted.push(old);
+        }
+        cache.clock += 1;
+        let now = cache.clock;
+        cache.frames += frames;
+        cache.images.push((image, now));
+    }
+    // Frames are released outside the cache lock.
+    drop(evicted);
+}
+
+/// Map `image` into the fresh address space `pd_phys`.  Returns the number
+/// of pages mapped.
+pub fn map_into(image: &CachedImage, pd_phys: PhysAddr) -> Result<u32, &'static str> {
+    let mut mapped = 0u32;
+    for seg in &image.segments {
+        let nx = if seg.exec { 0 } else { virtual_mem::page_nx_flag() };
+        let shared_flags = PAGE_USER | nx | if seg.writable { virtual_mem::PTE_COW } else { 0 };
+        for (i, &frame) in seg.frames.iter().enumerate() {
+            if !physical::share_frame(frame) {
+                return Err("Too many owners of a cached image frame");
+            }
+            let virt = VirtAddr::new(seg.page_start + i as u64 * PAGE_SIZE);
+            virtual_mem::map_page_in_pd(pd_phys, virt, frame, shared_flags);
+        }
+        mapped += seg.frames.len() as u32;
+        if seg.zero_pages > 0 {
+            let start = seg.page_start + seg.frames.len() as u64 * PAGE_SIZE;
+            mapped += virtual_mem::map_pages_range_in_pd(
+                pd_phys,
+                VirtAddr::new(start),
+                seg.zero_pages,
+                PAGE_USER | PAGE_WRITABLE | nx,
+                true,
+            )?;
+        }
+    }
+    Ok(mapped)
+}
+
+/// Drop cached images matching `pred`.
+fn forget(pred: impl Fn(&(u32, u32, u32)) -> bool) {
+    let mut evicted = Vec::new();
+    {
+        let mut cache = CACHE.lock();
+        let mut i = 0;
+        while i < cache.images.len() {
+            if pred(&cache.images[i].0.key) {
+                let (old, _) = cache.images.swap_remove(i);
+                cache.frames -= old.frame_count();
+                evicted.push(old);
+            } else {
+                i += 1;
+            }
+        }
+    }
+    drop(evicted);
+}
+
+/// Drop least recently used images that no running process maps until
+/// about `frames` frames are freed (called by the reclaim thread).  Images
+/// still mapped somewhere are kept: dropping them frees nothing until the
+/// processes exit.  Returns the number of frames freed.
+pub fn shrink(frames: usize) -> usize {
+    let mut evicted = Vec::new();
+    let mut freed = 0;
+    {
+        let mut cache = CACHE.lock();
+        while freed < frames {
+            let idle = cache
+                .images
+                .iter()
+                .enumerate()
+                .filter(|(_, (img, _))| {
+                    img.segments.iter().all(|s| s.frames.iter().all(|&f| physical::frame_ref_count(f) == 0))
+                })
+                .min_by_key(|(_, (_, last_use))| *last_use)
+                .map(|(i, _)| i);
+            let Some(i) = idle else { break };
+            let (old, _) = cache.images.swap_remove(i);
+            let n = old.frame_count();
+            cache.frames -= n;
+            freed += n;
+            evicted.push(old);
+        }
+    }
+    drop(evicted);
+    freed
+}
+
+/// Forget the image of one file (called by the page cache on invalidation).
+pub fn forget_inode(mount: u32, inode: u32) {
+    forget(|k| k.0 == mount && k.1 == inode);
+}
+
+/// Forget every image on one mount.
+pub fn forget_mount(mount: u32) {
+    forget(|k| k.0 == mount);
+}
+
+/// Forget every image.
+pub fn forget_all() {
+    forget(|_| true);
+}
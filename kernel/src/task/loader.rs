@@ -478,10 +478,13 @@ fn load_elf64(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
         core::arch::asm!("mov cr3, {}", in(reg) pd_phys.as_u64());
         #[cfg(target_arch = "aarch64")]
         {
-            core::arch::asm!("msr ttbr0_el1, {}", in(reg) pd_phys.as_u64(), options(nomem, nostack));
-            core::arch::asm!("isb", options(nomem, nostack));
+            crate::arch::arm64::mmu::switch_ttbr0(pd_phys.as_u64());
         }
 
+        // Code/rodata pages are mapped read-only and CR0.WP is set; this is a
+        // fresh address space with no shared frames, so lift it for the copy.
+        let wp = virtual_mem::set_write_protect(false);
+
         for i in 0..ph_num {
             let ph_offset = ph_off + i * ph_size;
             let phdr = &*(data.as_ptr().add(ph_offset) as *const Elf64Phdr);
@@ -510,6 +513,8 @@ fn load_elf64(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
             }
         }
 
+        virtual_mem::set_write_protect(wp);
+
         #[cfg(target_arch = "x86_64")]
         {
             core::arch::asm!("mov cr3, {}", in(reg) old_pt);
@@ -517,8 +522,7 @@ fn load_elf64(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
         }
         #[cfg(target_arch = "aarch64")]
         {
-            core::arch::asm!("msr ttbr0_el1, {}", in(reg) old_pt, options(nomem, nostack));
-            core::arch::asm!("isb", options(nomem, nostack));
+            crate::arch::arm64::mmu::switch_ttbr0(old_pt);
             core::arch::asm!("msr daif, {}", in(reg) saved_daif, options(nomem, nostack));
         }
     }
@@ -527,6 +531,154 @@ fn load_elf64(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
     Ok(ElfLoadResult { entry, brk, pages_mapped: total_pages })
 }
 
+/// An ELF64 executable whose segments are mapped from the file instead of
+/// copied: the open file plus its first page (ELF + program headers).
+/// Dropping it releases the loader's own reference on the file; the
+/// segment mappings hold theirs.
+struct MappedElf {
+    slot: u32,
+    headers: alloc::vec::Vec<u8>,
+    /// The image in the executable image cache; when set, `headers` is
+    /// empty and the segments are mapped from the cached frames.
+    #[cfg(target_arch = "x86_64")]
+    cached: Option<alloc::sync::Arc<crate::task::image_cache::CachedImage>>,
+}
+
+impl Drop for MappedElf {
+    fn drop(&mut self) {
+        let _ = crate::fs::vfs::close(self.slot);
+    }
+}
+
+/// Program headers of `headers` (which must hold the whole table).
+fn elf64_phdrs(headers: &[u8]) -> Option<impl Iterator<Item = Elf64Phdr> + '_> {
+    if headers.len() < 64 {
+        return None;
+    }
+    let hdr = unsafe { &*(headers.as_ptr() as *const Elf64Header) };
+    let ph_off = hdr.e_phoff as usize;
+    let ph_size = hdr.e_phentsize as usize;
+    let ph_num = hdr.e_phnum as usize;
+    if ph_size < core::mem::size_of::<Elf64Phdr>()
+        || ph_off.checked_add(ph_size.checked_mul(ph_num)?)? > headers.len()
+    {
+        return None;
+    }
+    Some((0..ph_num).map(move |i| unsafe {
+        core::ptr::read_unaligned(headers.as_ptr().add(ph_off + i * ph_size) as *const Elf64Phdr)
+    }))
+}
+
+/// Open `path` for segment mapping if it is an ELF64 image the page-fault
+/// path can serve directly: program headers in the first page, every
+/// PT_LOAD congruent to its file offset modulo the page size, below 4 GiB,
+/// inside the file, and not sharing a page with another segment.
+/// Anything else returns `None` and is loaded by copying.
+///
+/// Images found in the executable image cache skip the header read; others
+/// are added to it when they fit.
+fn open_mapped_elf64(path: &str) -> Option<MappedElf> {
+    let slot = crate::fs::vfs::open(path, crate::fs::file::FileFlags::READ_ONLY).ok()?;
+    let mut image = MappedElf {
+        slot,
+        headers: alloc::vec::Vec::new(),
+        #[cfg(target_arch = "x86_64")]
+        cached: None,
+    };
+    let (size, _) = crate::fs::vfs::map_info(slot).ok()?;
+    #[cfg(target_arch = "x86_64")]
+    if let Some(cached) = crate::task::image_cache::lookup(slot) {
+        image.cached = Some(cached);
+        return Some(image);
+    }
+    image.headers = alloc::vec![0u8; (size as usize).min(PAGE_SIZE as usize)];
+    if crate::fs::vfs::read_at(slot, 0, &mut image.headers).ok()? != image.headers.len() {
+        return None;
+    }
+    if !is_elf(&image.headers) || elf_class(&image.headers) != ELFCLASS64 {
+        return None;
+    }
+
+    let mut ranges: alloc::vec::Vec<(u64, u64)> = alloc::vec::Vec::new();
+    for ph in elf64_phdrs(&image.headers)? {
+        if ph.p_type != PT_LOAD || ph.p_memsz == 0 {
+            continue;
+        }
+        let page_start = ph.p_vaddr & !0xFFF;
+        let page_end = ph.p_vaddr.checked_add(ph.p_memsz)?.checked_add(PAGE_SIZE - 1)? & !0xFFF;
+        if ph.p_vaddr & 0xFFF != ph.p_offset & 0xFFF
+            || ph.p_filesz > ph.p_memsz
+            || ph.p_offset + ph.p_filesz > size as u64
+            || page_end > 0xFFFF_F000
+            || ranges.iter().any(|&(s, e)| page_start < e && s < page_end)
+        {
+            return None;
+        }
+        ranges.push((page_start, page_end));
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    {
+        let hdr = unsafe { &*(image.headers.as_ptr() as *const Elf64Header) };
+        let segments: alloc::vec::Vec<crate::task::image_cache::Segment> = elf64_phdrs(&image.headers)?
+            .filter(|ph| ph.p_type == PT_LOAD && ph.p_memsz != 0)
+            .map(|ph| crate::task::image_cache::Segment {
+                vaddr: ph.p_vaddr,
+                memsz: ph.p_memsz,
+                filesz: ph.p_filesz,
+                offset: ph.p_offset,
+                writable: ph.p_flags & PF_W != 0,
+                exec: ph.p_flags & PF_X != 0,
+            })
+            .collect();
+        image.cached = crate::task::image_cache::load(slot, hdr.e_entry, &segments);
+    }
+    Some(image)
+}
+
+/// Map the PT_LOAD segments of `image` into `pd_phys` as private file
+/// regions.  Nothing is read here: pages are faulted in from the page cache
+/// on first access and the tail past `p_filesz` (.bss) is zero-filled.
+/// Images from the executable image cache are mapped from its frames.
+fn map_elf64(image: &MappedElf, pd_phys: crate::memory::address::PhysAddr) -> Result<ElfLoadResult, &'static str> {
+    #[cfg(target_arch = "x86_64")]
+    if let Some(ref cached) = image.cached {
+        let pages = crate::task::image_cache::map_into(cached, pd_phys)?;
+        return Ok(ElfLoadResult { entry: cached.entry, brk: cached.brk, pages_mapped: pages });
+    }
+
+    let hdr = unsafe { &*(image.headers.as_ptr() as *const Elf64Header) };
+    let mut max_vaddr_end: u64 = 0;
+
+    for ph in elf64_phdrs(&image.headers).ok_or("ELF64 program header out of bounds")? {
+        if ph.p_type != PT_LOAD || ph.p_memsz == 0 {
+            continue;
+        }
+        // Page-aligned file window: the bytes before p_vaddr in the first
+        // page come from the file as well (as with any mmap-based loader).
+        let lead = ph.p_vaddr & 0xFFF;
+        let page_start = ph.p_vaddr - lead;
+        let page_end = (ph.p_vaddr + ph.p_memsz + PAGE_SIZE - 1) & !0xFFF;
+        let ok = crate::memory::file_map::map_fixed(
+            pd_phys,
+            page_start as u32,
+            (page_end - page_start) as u32,
+            image.slot,
+            (ph.p_offset - lead) as u32,
+            (lead + ph.p_filesz) as u32,
+            ph.p_flags & PF_W != 0,
+            ph.p_flags & PF_X != 0,
+        );
+        if !ok {
+            return Err("Failed to map ELF64 segment");
+        }
+        max_vaddr_end = max_vaddr_end.max(ph.p_vaddr + ph.p_memsz);
+    }
+
+    let brk = (max_vaddr_end + PAGE_SIZE - 1) & !0xFFF;
+    Ok(ElfLoadResult { entry: hdr.e_entry, brk, pages_mapped: 0 })
+}
+
 /// Load an ELF32 binary into a user PML4 (for 32-bit compatibility mode).
 fn load_elf32(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<ElfLoadResult, &'static str> {
     if data.len() < 52 {
@@ -616,10 +768,13 @@ fn load_elf32(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
         core::arch::asm!("mov cr3, {}", in(reg) pd_phys.as_u64());
         #[cfg(target_arch = "aarch64")]
         {
-            core::arch::asm!("msr ttbr0_el1, {}", in(reg) pd_phys.as_u64(), options(nomem, nostack));
-            core::arch::asm!("isb", options(nomem, nostack));
+            crate::arch::arm64::mmu::switch_ttbr0(pd_phys.as_u64());
         }
 
+        // Code/rodata pages are mapped read-only and CR0.WP is set; this is a
+        // fresh address space with no shared frames, so lift it for the copy.
+        let wp = virtual_mem::set_write_protect(false);
+
         for i in 0..ph_num {
             let ph_offset = ph_off + i * ph_size;
             let phdr = &*(data.as_ptr().add(ph_offset) as *const Elf32Phdr);
@@ -646,6 +801,8 @@ fn load_elf32(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
             }
         }
 
+        virtual_mem::set_write_protect(wp);
+
         #[cfg(target_arch = "x86_64")]
         {
             core::arch::asm!("mov cr3, {}", in(reg) old_pt);
@@ -653,8 +810,7 @@ fn load_elf32(data: &[u8], pd_phys: crate::memory::address::PhysAddr) -> Result<
         }
         #[cfg(target_arch = "aarch64")]
         {
-            core::arch::asm!("msr ttbr0_el1, {}", in(reg) old_pt, options(nomem, nostack));
-            core::arch::asm!("isb", options(nomem, nostack));
+            crate::arch::arm64::mmu::switch_ttbr0(old_pt);
             core::arch::asm!("msr daif, {}", in(reg) saved_daif, options(nomem, nostack));
         }
     }
@@ -790,8 +946,7 @@ pub fn load_binary_into_pd(
             core::arch::asm!("mov cr3, {}", in(reg) pd_phys.as_u64());
             #[cfg(target_arch = "aarch64")]
             {
-                core::arch::asm!("msr ttbr0_el1, {}", in(reg) pd_phys.as_u64(), options(nomem, nostack));
-                core::arch::asm!("isb", options(nomem, nostack));
+                crate::arch::arm64::mmu::switch_ttbr0(pd_phys.as_u64());
             }
 
             let dest = PROGRAM_LOAD_ADDR as *mut u8;
@@ -804,8 +959,7 @@ pub fn load_binary_into_pd(
             }
             #[cfg(target_arch = "aarch64")]
             {
-                core::arch::asm!("msr ttbr0_el1, {}", in(reg) old_pt, options(nomem, nostack));
-                core::arch::asm!("isb", options(nomem, nostack));
+                crate::arch::arm64::mmu::switch_ttbr0(old_pt);
                 core::arch::asm!("msr daif, {}", in(reg) saved_daif, options(nomem, nostack));
             }
         }
@@ -829,6 +983,48 @@ pub fn load_binary_into_pd(
 /// On success, never returns (jumps to user mode in new address space).
 /// On failure, returns an error string and the old process continues.
 pub fn exec_current_process(data: &[u8], args: &str) -> &'static str {
+    exec_with(args, |pd| load_binary_into_pd(data, pd))
+}
+
+/// Replace the current process with the ELF64 executable at `path` if it is
+/// (or can be put) in the executable image cache: no file read and no
+/// segment copy, only page tables are built.  Returns `None` when the image
+/// is not cacheable, in which case the caller reads the file and uses
+/// [`exec_current_process`]; otherwise behaves like it.
+#[cfg(target_arch = "x86_64")]
+pub fn exec_current_process_cached(path: &str, args: &str) -> Option<&'static str> {
+    let image = open_mapped_elf64(path)?;
+    let cached = image.cached.clone()?;
+    drop(image);
+    // The closure owns the image reference and releases it once mapped:
+    // exec does not return to drop it.
+    Some(exec_with(args, move |pd| {
+        let stack_aslr_offset = random_page_offset(ASLR_STACK_MAX_PAGES) as u64 * PAGE_SIZE;
+        let aslr_stack_top = USER_STACK_TOP - stack_aslr_offset;
+        let stack_mapped = virtual_mem::map_pages_range_in_pd(
+            pd,
+            VirtAddr::new(aslr_stack_top - USER_STACK_PAGES * PAGE_SIZE),
+            USER_STACK_PAGES,
+            PAGE_WRITABLE | PAGE_USER | virtual_mem::page_nx_flag(),
+            true,
+        )?;
+        let pages = crate::task::image_cache::map_into(&cached, pd)?;
+        Ok(LoadResult {
+            entry: cached.entry,
+            brk: cached.brk,
+            is_compat32: false,
+            user_pages: pages + stack_mapped,
+            stack_top: aslr_stack_top - 8,
+        })
+    }))
+}
+
+/// Body of exec: build a new address space with `load`, switch the current
+/// thread to it and enter user mode.
+fn exec_with(
+    args: &str,
+    load: impl FnOnce(crate::memory::address::PhysAddr) -> Result<LoadResult, &'static str>,
+) -> &'static str {
     let tid = crate::task::scheduler::current_tid();
 
     // Get old PD before we replace it
@@ -844,7 +1040,7 @@ pub fn exec_current_process(data: &[u8], args: &str) -> &'static str {
     };
 
     // Load binary into new PD
-    let result = match load_binary_into_pd(data, new_pd) {
+    let result = match load(new_pd) {
         Ok(r) => r,
         Err(e) => {
             virtual_mem::destroy_user_page_directory(new_pd);
@@ -873,6 +1069,15 @@ pub fn exec_current_process(data: &[u8], args: &str) -> &'static str {
     // Rekey environment from old PD to new PD (move entries in-place)
     crate::task::env::rekey_env(old_pd.0, new_pd.0);
 
+    // Write back and release the old image's file mappings while its
+    // address space is still active.
+    crate::memory::file_map::release_current(old_pd);
+
+    // The thread no longer owns the old PD, so the reclaim thread cannot
+    // pin it again; let a pass already scanning it finish.
+    #[cfg(target_arch = "x86_64")]
+    crate::memory::reclaim::wait_unpinned(old_pd);
+
     // Switch page table to new address space and destroy old one
     unsafe {
         #[cfg(target_arch = "x86_64")]
@@ -883,8 +1088,7 @@ pub fn exec_current_process(data: &[u8], args: &str) -> &'static str {
         #[cfg(target_arch = "aarch64")]
         {
             core::arch::asm!("msr daifset, #0xf", options(nomem, nostack));
-            core::arch::asm!("msr ttbr0_el1, {}", in(reg) new_pd.as_u64(), options(nomem, nostack));
-            core::arch::asm!("isb", options(nomem, nostack));
+            crate::arch::arm64::mmu::switch_ttbr0(new_pd.as_u64());
         }
     }
 
@@ -1000,16 +1204,23 @@ pub fn load_and_run_with_args(path: &str, name: &str, args: &str) -> Result<u32,
         }
     }
 
-    // Read the binary from the filesystem
-    let data = match crate::fs::vfs::read_file_to_vec(actual_path) {
-        Ok(d) => d,
-        Err(e) => {
-            crate::serial_println!("  load_and_run: read_file_to_vec('{}') failed: {:?}", actual_path, e);
-            return Err("Failed to read program file");
+    // ELF64 executables are mapped from the executable image cache or from
+    // the file (demand-paged through the page cache); other images are read
+    // whole and copied.
+    let image = open_mapped_elf64(actual_path);
+    let data = if image.is_some() {
+        alloc::vec::Vec::new()
+    } else {
+        match crate::fs::vfs::read_file_to_vec(actual_path) {
+            Ok(d) => d,
+            Err(e) => {
+                crate::serial_println!("  load_and_run: read_file_to_vec('{}') failed: {:?}", actual_path, e);
+                return Err("Failed to read program file");
+            }
         }
     };
 
-    if data.is_empty() {
+    if image.is_none() && data.is_empty() {
         return Err("Program file is empty");
     }
 
@@ -1027,7 +1238,7 @@ pub fn load_and_run_with_args(path: &str, name: &str, args: &str) -> Result<u32,
     // Stack is data — writable but never executed.
     let stack_flags = PAGE_WRITABLE | PAGE_USER | virtual_mem::page_nx_flag();
 
-    let class = elf_class(&data);
+    let class = if image.is_some() { ELFCLASS64 } else { elf_class(&data) };
     if class == ELFCLASS64 {
         // ---- ELF64 binary path ----
 
@@ -1048,8 +1259,11 @@ pub fn load_and_run_with_args(path: &str, name: &str, args: &str) -> Result<u32,
         // Per-process .data/.bss pages are still demand-paged on first access.
         crate::task::dll::map_all_dlls_into(pd_phys);
 
-        // Load ELF64 segments
-        let elf_result = load_elf64(&data, pd_phys)?;
+        // Map ELF64 segments (or copy them if the file cannot be mapped)
+        let elf_result = match image {
+            Some(ref image) => map_elf64(image, pd_phys)?,
+            None => load_elf64(&data, pd_phys)?,
+        };
         entry_point = elf_result.entry;
         brk = elf_result.brk;
         total_user_pages += elf_result.pages_mapped + stack_mapped;
@@ -1121,8 +1335,7 @@ pub fn load_and_run_with_args(path: &str, name: &str, args: &str) -> Result<u32,
             core::arch::asm!("mov cr3, {}", in(reg) pd_phys.as_u64());
             #[cfg(target_arch = "aarch64")]
             {
-                core::arch::asm!("msr ttbr0_el1, {}", in(reg) pd_phys.as_u64(), options(nomem, nostack));
-                core::arch::asm!("isb", options(nomem, nostack));
+                crate::arch::arm64::mmu::switch_ttbr0(pd_phys.as_u64());
             }
 
             let dest = PROGRAM_LOAD_ADDR as *mut u8;
@@ -1135,8 +1348,7 @@ pub fn load_and_run_with_args(path: &str, name: &str, args: &str) -> Result<u32,
             }
             #[cfg(target_arch = "aarch64")]
             {
-                core::arch::asm!("msr ttbr0_el1, {}", in(reg) old_pt, options(nomem, nostack));
-                core::arch::asm!("isb", options(nomem, nostack));
+                crate::arch::arm64::mmu::switch_ttbr0(old_pt);
                 core::arch::asm!("msr daif, {}", in(reg) saved_daif, options(nomem, nostack));
             }
         }
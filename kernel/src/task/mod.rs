@@ -10,6 +10,10 @@ pub mod crash_info;
 pub mod cpu_monitor;
 pub mod dll;
 pub mod env;
+#[cfg(target_arch = "x86_64")]
+pub mod image_cache;
+#[cfg(target_arch = "x86_64")]
+pub mod profiler;
 pub mod loader;
 pub mod permissions;
 pub mod process;
@@ -17,4 +21,7 @@ pub mod scheduler;
 #[cfg(feature = "debug_verbose")]
 pub mod stress_test;
 pub mod thread;
+#[cfg(target_arch = "x86_64")]
+pub mod timepage;
+pub mod tracepoints;
 pub mod users;
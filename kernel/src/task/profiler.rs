@@ -0,0 +1,323 @@
+//! System-wide sampling profiler.
+//!
+//! While a session runs, every CPU records what it is executing into its own
+//! ring: the interrupted RIP, TID, kernel/user mode and a short frame-pointer
+//! call chain.  Samples come from the performance-counter overflow NMI
+//! ([`pmu`](crate::arch::x86::pmu)) at the requested rate (1 Hz - 10 kHz),
+//! which also sees IRQ-disabled kernel code.  Without a usable PMU the
+//! scheduler's LAPIC timer interrupt samples instead, at the tick rate on
+//! busy CPUs.
+//!
+//! The rings live in one kernel-owned SHM region that `SYS_PROF_START` maps
+//! into the caller (anyTrace), so samples are read without syscalls.  The
+//! kernel writes through a window of its own, from NMI context, without
+//! locks.
+//!
+//! Layout (mirrored in `anyos_std::debug::Profiler`):
+//!
+//! | Offset | Field |
+//! |--------|-------|
+//! | 0  | `magic` u32 ([`MAGIC`]) |
+//! | 4  | `ncpus` u32 |
+//! | 8  | `source` u32: 0 = stopped, 1 = PMU NMI, 2 = LAPIC timer |
+//! | 12 | `sample_hz` u32 (effective rate) |
+//! | 16 | `capacity` u32: records per CPU ring |
+//! | 20 | `record_size` u32 (128) |
+//! | 24 | `cycle_hz` u64: rate of the record timestamps |
+//! | 64 + 64*cpu | per-CPU `head` u32 (consumer), `tail` u32, `lost` u32 |
+//! | 4096 * (1 + RING_PAGES*cpu) | CPU `cpu`'s ring of [`SampleRecord`] |
+//!
+//! The consumer reads record `head % capacity` while `head != tail`
+//! (acquire load of `tail`) and publishes `head + 1`.  A full ring drops
+//! samples and counts them in `lost`.
+
+use crate::arch::x86::idt::InterruptFrame;
+use crate::arch::x86::pmu;
+use crate::arch::hal::MAX_CPUS;
+use crate::ipc::shared_memory;
+use crate::memory::address::VirtAddr;
+use crate::memory::{virtual_mem, FRAME_SIZE};
+use crate::sync::spinlock::Spinlock;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
+
+pub const MAGIC: u32 = 0x464F_5250; // "PROF"
+
+/// Return addresses kept per sample (fills the 128-byte record).
+pub const CHAIN_DEPTH: usize = 13;
+/// Pages per CPU ring (2048 records, 200 ms at 10 kHz).
+const RING_PAGES: usize = 64;
+const CAPACITY: u32 = (RING_PAGES * FRAME_SIZE / core::mem::size_of::<SampleRecord>()) as u32;
+
+pub const MAX_HZ: u32 = 10_000;
+const DEFAULT_HZ: u32 = 1000;
+
+pub const SOURCE_STOPPED: u32 = 0;
+pub const SOURCE_PMU: u32 = 1;
+pub const SOURCE_TIMER: u32 = 2;
+
+/// Record flag: the CPU was in kernel mode.
+pub const FLAG_KERNEL: u16 = 1;
+/// Record flag: 32-bit compatibility-mode process (chain holds 32-bit PCs).
+pub const FLAG_COMPAT: u16 = 2;
+
+/// Kernel window for the buffer (below the MMIO windows at `0xD000_0000`).
+const WINDOW_BASE: u64 = 0xFFFF_FFFF_C000_0000;
+
+/// One sample (128 bytes, must match the userspace mirror).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct SampleRecord {
+    /// Cycle counter at the sample.
+    pub tsc: u64,
+    pub rip: u64,
+    pub tid: u32,
+    pub flags: u16,
+    /// Valid entries in `chain`.
+    pub depth: u16,
+    /// Return addresses, innermost first.
+    pub chain: [u64; CHAIN_DEPTH],
+}
+
+#[repr(C)]
+struct RingCtl {
+    head: AtomicU32,
+    tail: AtomicU32,
+    lost: AtomicU32,
+}
+
+/// The buffer, once allocated.  Kept for the kernel's lifetime.
+struct Buffer {
+    shm_id: u32,
+}
+
+static BUFFER: Spinlock<Option<Buffer>> = Spinlock::new(None);
+/// CPUs with a ring (fixed at allocation); 0 = no buffer yet.
+static NCPUS: AtomicU32 = AtomicU32::new(0);
+
+static ACTIVE: AtomicBool = AtomicBool::new(false);
+static SOURCE: AtomicU32 = AtomicU32::new(SOURCE_STOPPED);
+/// PMU period in cycles.
+static PERIOD: AtomicU64 = AtomicU64::new(0);
+/// Bumped on every start/stop; each CPU reprograms itself when it sees a
+/// new value (see [`sync_cpu`]).
+static GENERATION: AtomicU32 = AtomicU32::new(0);
+static CPU_GENERATION: [AtomicU32; MAX_CPUS] = {
+    const INIT: AtomicU32 = AtomicU32::new(0);
+    [INIT; MAX_CPUS]
+};
+
+fn header_u32(offset: usize) -> *mut u32 {
+    (WINDOW_BASE as usize + offset) as *mut u32
+}
+
+fn ring_ctl(cpu: usize) -> &'static RingCtl {
+    unsafe { &*((WINDOW_BASE as usize + 64 + cpu * 64) as *const RingCtl) }
+}
+
+fn record_ptr(cpu: usize, index: u32) -> *mut SampleRecord {
+    let ring = WINDOW_BASE as usize + FRAME_SIZE * (1 + cpu * RING_PAGES);
+    (ring + (index % CAPACITY) as usize * core::mem::size_of::<SampleRecord>()) as *mut SampleRecord
+}
+
+/// Allocate the buffer and map it into the kernel window (first start).
+fn ensure_buffer() -> Option<u32> {
+    let mut buf = BUFFER.lock();
+    if let Some(ref b) = *buf {
+        return Some(b.shm_id);
+    }
+    let ncpus = crate::arch::hal::cpu_count().clamp(1, MAX_CPUS);
+    let pages = 1 + ncpus * RING_PAGES;
+    let shm_id = shared_memory::create(pages * FRAME_SIZE, shared_memory::KERNEL_OWNER)?;
+    let frames = shared_memory::region_frames(shm_id);
+    if frames.len() != pages {
+        shared_memory::destroy(shm_id, shared_memory::KERNEL_OWNER);
+        return None;
+    }
+    let flags = 0x03 | virtual_mem::page_nx_flag();
+    for (i, &frame) in frames.iter().enumerate() {
+        let va = WINDOW_BASE + (i * FRAME_SIZE) as u64;
+        virtual_mem::map_page(VirtAddr::new(va), frame, flags);
+        unsafe { core::ptr::write_bytes(va as *mut u8, 0, FRAME_SIZE) };
+    }
+    NCPUS.store(ncpus as u32, Ordering::Release);
+    *buf = Some(Buffer { shm_id });
+    Some(shm_id)
+}
+
+/// Start (or restart) a session at `hz` samples per second per CPU and map
+/// the buffer into the caller.  Returns its user address, or 0.
+pub fn start(hz: u32) -> u64 {
+    let shm_id = match ensure_buffer() {
+        Some(id) => id,
+        None => return 0,
+    };
+    let user_addr = shared_memory::map_into_current(shm_id);
+    if user_addr == 0 {
+        return 0;
+    }
+
+    ACTIVE.store(false, Ordering::SeqCst);
+    let hz = if hz == 0 { DEFAULT_HZ } else { hz.min(MAX_HZ) };
+    let cycle_hz = crate::arch::hal::cycle_counter_hz();
+    let (source, rate) = if pmu::available() {
+        PERIOD.store((cycle_hz / hz as u64).clamp(1, pmu::MAX_PERIOD), Ordering::Relaxed);
+        (SOURCE_PMU, hz)
+    } else {
+        (SOURCE_TIMER, crate::arch::x86::pit::TICK_HZ)
+    };
+    let ncpus = NCPUS.load(Ordering::Acquire) as usize;
+    unsafe {
+        header_u32(0).write_volatile(MAGIC);
+        header_u32(4).write_volatile(ncpus as u32);
+        header_u32(8).write_volatile(source);
+        header_u32(12).write_volatile(rate);
+        header_u32(16).write_volatile(CAPACITY);
+        header_u32(20).write_volatile(core::mem::size_of::<SampleRecord>() as u32);
+        (header_u32(24) as *mut u64).write_volatile(cycle_hz);
+    }
+    for cpu in 0..ncpus {
+        let ctl = ring_ctl(cpu);
+        ctl.head.store(0, Ordering::Relaxed);
+        ctl.tail.store(0, Ordering::Relaxed);
+        ctl.lost.store(0, Ordering::Relaxed);
+    }
+    SOURCE.store(source, Ordering::Relaxed);
+    ACTIVE.store(true, Ordering::SeqCst);
+    GENERATION.fetch_add(1, Ordering::Release);
+    sync_cpu_irqsafe();
+    user_addr
+}
+
+/// Stop the session.  The buffer stays mapped so the last samples can be
+/// drained.
+pub fn stop() {
+    ACTIVE.store(false, Ordering::SeqCst);
+    SOURCE.store(SOURCE_STOPPED, Ordering::Relaxed);
+    if NCPUS.load(Ordering::Acquire) != 0 {
+        unsafe { header_u32(8).write_volatile(SOURCE_STOPPED) };
+    }
+    GENERATION.fetch_add(1, Ordering::Release);
+    sync_cpu_irqsafe();
+}
+
+fn sync_cpu_irqsafe() {
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    sync_cpu();
+    crate::arch::hal::restore_interrupt_state(flags);
+}
+
+/// Bring this CPU's counter in line with the current session.  Other CPUs
+/// pick up a start or stop on their next timer interrupt.
+fn sync_cpu() {
+    let cpu = crate::arch::hal::cpu_id();
+    if cpu >= MAX_CPUS {
+        return;
+    }
+    let gen = GENERATION.load(Ordering::Acquire);
+    if CPU_GENERATION[cpu].swap(gen, Ordering::Relaxed) == gen {
+        return;
+    }
+    if ACTIVE.load(Ordering::Acquire) && SOURCE.load(Ordering::Relaxed) == SOURCE_PMU {
+        pmu::arm(PERIOD.load(Ordering::Relaxed));
+    } else {
+        pmu::disarm();
+    }
+}
+
+/// LAPIC timer interrupt hook (IRQ 16, interrupts disabled).
+pub fn on_timer(frame: &InterruptFrame) {
+    sync_cpu();
+    if ACTIVE.load(Ordering::Relaxed) && SOURCE.load(Ordering::Relaxed) == SOURCE_TIMER {
+        record(frame);
+    }
+}
+
+/// NMI hook.  Returns `true` if the NMI was a counter overflow (consumed).
+pub fn on_nmi(frame: &InterruptFrame) -> bool {
+    if !pmu::take_overflow() {
+        return false;
+    }
+    if ACTIVE.load(Ordering::Relaxed) && SOURCE.load(Ordering::Relaxed) == SOURCE_PMU {
+        record(frame);
+        pmu::reload(PERIOD.load(Ordering::Relaxed));
+    } else {
+        pmu::disarm();
+    }
+    true
+}
+
+fn record(frame: &InterruptFrame) {
+    let cpu = crate::arch::hal::cpu_id();
+    if cpu >= NCPUS.load(Ordering::Acquire) as usize {
+        return;
+    }
+    let ctl = ring_ctl(cpu);
+    let tail = ctl.tail.load(Ordering::Relaxed);
+    if tail.wrapping_sub(ctl.head.load(Ordering::Acquire)) >= CAPACITY {
+        ctl.lost.fetch_add(1, Ordering::Relaxed);
+        return;
+    }
+
+    let kernel = frame.cs & 3 == 0;
+    let compat = frame.cs == 0x1B;
+    let mut rec = SampleRecord {
+        tsc: crate::arch::hal::cycle_counter(),
+        rip: frame.rip,
+        tid: crate::task::scheduler::debug_current_tid(),
+        flags: if kernel { FLAG_KERNEL } else if compat { FLAG_COMPAT } else { 0 },
+        depth: 0,
+        chain: [0; CHAIN_DEPTH],
+    };
+    rec.depth = if kernel {
+        let (bottom, top) = crate::task::scheduler::get_stack_bounds(cpu);
+        walk_chain(frame.rbp, 8, &mut rec.chain, |fp| fp >= bottom && fp + 16 <= top)
+    } else if compat {
+        walk_chain(frame.rbp & 0xFFFF_FFFF, 4, &mut rec.chain, user_readable)
+    } else {
+        walk_chain(frame.rbp, 8, &mut rec.chain, user_readable)
+    };
+
+    unsafe { core::ptr::write_volatile(record_ptr(cpu, tail), rec) };
+    ctl.tail.store(tail.wrapping_add(1), Ordering::Release);
+}
+
+/// True if the two words at `fp` are mapped user memory (checked without
+/// faulting: this runs in NMI context).
+fn user_readable(fp: u64) -> bool {
+    const PRESENT_USER: u64 = 0x01 | 0x04;
+    if fp >= 0x0000_8000_0000_0000 - 16 {
+        return false;
+    }
+    let page_ok = |va: u64| virtual_mem::read_pte(VirtAddr::new(va)) & PRESENT_USER == PRESENT_USER;
+    page_ok(fp) && ((fp & 0xFFF) <= 0xFF0 || page_ok((fp + 16) & !0xFFF))
+}
+
+/// Follow saved frame pointers from `fp` (frame = saved fp, return address;
+/// `word` bytes each) while `readable` accepts the frame.
+fn walk_chain(mut fp: u64, word: u64, chain: &mut [u64; CHAIN_DEPTH], readable: impl Fn(u64) -> bool) -> u16 {
+    let mut depth = 0;
+    while depth < CHAIN_DEPTH {
+        if fp == 0 || fp % word != 0 || !readable(fp) {
+            break;
+        }
+        let (next, ret) = unsafe {
+            if word == 8 {
+                (core::ptr::read_volatile(fp as *const u64), core::ptr::read_volatile((fp + 8) as *const u64))
+            } else {
+                (core::ptr::read_volatile(fp as *const u32) as u64,
+                 core::ptr::read_volatile((fp + 4) as *const u32) as u64)
+            }
+        };
+        if ret == 0 {
+            break;
+        }
+        chain[depth] = ret;
+        depth += 1;
+        // The stack grows down: callers' frames are above.
+        if next <= fp {
+            break;
+        }
+        fp = next;
+    }
+    depth as u16
+}
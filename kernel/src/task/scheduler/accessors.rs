@@ -30,6 +30,18 @@ pub fn is_current_thread_user() -> bool {
 }
 
 /// Get the current thread's name.
+/// Timer tick at which the current thread was spawned or last exec'd.
+pub fn current_spawn_tick() -> u32 {
+    let guard = SCHEDULER.lock();
+    let cpu_id = get_cpu_id();
+    if let Some(sched) = guard.as_ref() {
+        if let Some(idx) = sched.current_idx(cpu_id) {
+            return sched.threads[idx].spawn_tick;
+        }
+    }
+    0
+}
+
 pub fn current_thread_name() -> [u8; 32] {
     let guard = SCHEDULER.lock();
     let cpu_id = get_cpu_id();
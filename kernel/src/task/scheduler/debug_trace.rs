@@ -28,7 +28,7 @@ pub fn debug_attach(debugger_tid: u32, target_tid: u32) -> u32 {
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -80,7 +80,7 @@ pub fn debug_detach(debugger_tid: u32, target_tid: u32) -> u32 {
             None => return u32::MAX,
         };
 
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -114,7 +114,8 @@ pub fn debug_detach(debugger_tid: u32, target_tid: u32) -> u32 {
             let cpu = sched.threads[idx].affinity_cpu;
             let n = sched.num_cpus();
             let target_cpu = if cpu < n { cpu } else { 0 };
-            sched.per_cpu[target_cpu].run_queue.enqueue(target_tid, sched.threads[idx].priority);
+            let pri = sched.threads[idx].priority;
+            sched.make_ready(target_cpu, target_tid, pri);
         }
     }
 
@@ -136,7 +137,7 @@ pub fn debug_suspend(debugger_tid: u32, target_tid: u32) -> u32 {
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -172,7 +173,7 @@ pub fn debug_resume(debugger_tid: u32, target_tid: u32) -> u32 {
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -199,7 +200,8 @@ pub fn debug_resume(debugger_tid: u32, target_tid: u32) -> u32 {
         let cpu = sched.threads[idx].affinity_cpu;
         let n = sched.num_cpus();
         let target_cpu = if cpu < n { cpu } else { 0 };
-        sched.per_cpu[target_cpu].run_queue.enqueue(target_tid, sched.threads[idx].priority);
+        let pri = sched.threads[idx].priority;
+        sched.make_ready(target_cpu, target_tid, pri);
     }
 
     0
@@ -240,7 +242,7 @@ pub fn debug_get_regs(debugger_tid: u32, target_tid: u32, buf_ptr: u64, size: u3
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -333,7 +335,7 @@ pub fn debug_set_regs(debugger_tid: u32, target_tid: u32, buf_ptr: u64, size: u3
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -396,7 +398,7 @@ pub fn debug_read_mem(debugger_tid: u32, target_tid: u32, addr: u64, buf_ptr: u6
             None => return u32::MAX,
         };
 
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -429,7 +431,7 @@ pub fn debug_write_mem(debugger_tid: u32, target_tid: u32, addr: u64, buf_ptr: u
             None => return u32::MAX,
         };
 
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -461,7 +463,7 @@ pub fn debug_set_breakpoint(debugger_tid: u32, target_tid: u32, addr: u64) -> u3
             None => return u32::MAX,
         };
 
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -513,7 +515,7 @@ pub fn debug_set_breakpoint(debugger_tid: u32, target_tid: u32, addr: u64) -> u3
             Some(s) => s,
             None => return u32::MAX,
         };
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -538,7 +540,7 @@ pub fn debug_clr_breakpoint(debugger_tid: u32, target_tid: u32, addr: u64) -> u3
             None => return u32::MAX,
         };
 
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -587,7 +589,7 @@ pub fn debug_single_step(debugger_tid: u32, target_tid: u32) -> u32 {
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -613,7 +615,8 @@ pub fn debug_single_step(debugger_tid: u32, target_tid: u32) -> u32 {
         let cpu = sched.threads[idx].affinity_cpu;
         let n = sched.num_cpus();
         let target_cpu = if cpu < n { cpu } else { 0 };
-        sched.per_cpu[target_cpu].run_queue.enqueue(target_tid, sched.threads[idx].priority);
+        let pri = sched.threads[idx].priority;
+        sched.make_ready(target_cpu, target_tid, pri);
     }
 
     0
@@ -632,7 +635,7 @@ pub fn debug_get_mem_map(debugger_tid: u32, target_tid: u32, buf_ptr: u64, size:
             None => return u32::MAX,
         };
 
-        let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+        let idx = match sched.find_idx(target_tid) {
             Some(i) => i,
             None => return u32::MAX,
         };
@@ -678,7 +681,7 @@ pub fn debug_wait_event(debugger_tid: u32, target_tid: u32, buf_ptr: u64, size:
         None => return u32::MAX,
     };
 
-    let idx = match sched.threads.iter().position(|t| t.tid == target_tid) {
+    let idx = match sched.find_idx(target_tid) {
         Some(i) => i,
         None => return u32::MAX,
     };
@@ -737,7 +740,7 @@ pub fn thread_info_ex(target_tid: u32, buf_ptr: u64, size: u32) -> u32 {
         None => return u32::MAX,
     };
 
-    let thread = match sched.threads.iter().find(|t| t.tid == target_tid) {
+    let thread = match sched.thread(target_tid) {
         Some(t) => t,
         None => return u32::MAX,
     };
@@ -828,7 +831,7 @@ pub fn debug_auto_suspend(tid: u32, event_type: u32, addr: u64) {
     // Must use try_lock since we're in interrupt context
     if let Some(mut guard) = SCHEDULER.try_lock() {
         if let Some(sched) = guard.as_mut() {
-            if let Some(idx) = sched.threads.iter().position(|t| t.tid == tid) {
+            if let Some(idx) = sched.find_idx(tid) {
                 if sched.threads[idx].debug_attached_by != 0 {
                     sched.threads[idx].debug_suspended = true;
                     sched.threads[idx].debug_event = Some((event_type, addr));
@@ -869,7 +872,7 @@ pub fn is_debug_attached_current() -> bool {
     // Must use try_lock since this may be called from ISR context
     if let Some(guard) = SCHEDULER.try_lock() {
         if let Some(sched) = guard.as_ref() {
-            if let Some(thread) = sched.threads.iter().find(|t| t.tid == tid) {
+            if let Some(thread) = sched.thread(tid) {
                 return thread.debug_attached_by != 0;
             }
         }
@@ -27,7 +27,15 @@ impl DeferredPdQueue {
         // Queue full (64 pending PDs) — drain one slot synchronously.
         // This is a last-resort fallback for pathological fork storms.
         crate::serial_println!("WARNING: deferred PD queue full, destroying one synchronously");
-        if let Some(Some((old_pd, old_tid))) = self.entries.iter_mut().find(|s| s.is_some()).map(|s| s.take()) {
+        // Skip a PD the reclaim thread has pinned.
+        let victim = self.entries.iter_mut().find(|s| match s {
+            #[cfg(target_arch = "x86_64")]
+            Some((pd, _)) => !crate::memory::reclaim::is_pinned(*pd),
+            #[cfg(not(target_arch = "x86_64"))]
+            Some(_) => true,
+            None => false,
+        });
+        if let Some(Some((old_pd, old_tid))) = victim.map(|s| s.take()) {
             if old_tid != 0 {
                 let rflags = crate::arch::hal::save_and_disable_interrupts();
                 let saved_cr3 = crate::arch::hal::current_page_table();
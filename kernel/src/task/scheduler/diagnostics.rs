@@ -1,7 +1,7 @@
 //! Thread info / diagnostics, lock management, and I/O accounting.
 
 use super::{get_cpu_id, SCHEDULER};
-use crate::task::thread::ThreadState;
+use crate::task::thread::{ThreadState, HEAP_STATS_WORDS};
 use alloc::vec::Vec;
 
 /// Snapshot of a thread's state for the `ps` / sysinfo syscall.
@@ -83,6 +83,133 @@ pub fn list_threads() -> Vec<ThreadInfo> {
     result
 }
 
+/// Copy `(tid, heap_stats)` for every live thread whose process has reported
+/// heap usage into `out`.  Returns the number of entries written.
+pub fn heap_stats_snapshot(out: &mut [(u32, [u32; HEAP_STATS_WORDS])]) -> usize {
+    let mut count = 0;
+    let guard = SCHEDULER.lock();
+    if let Some(sched) = guard.as_ref() {
+        for thread in &sched.threads {
+            if count >= out.len() { break; }
+            if thread.state == ThreadState::Terminated || thread.heap_stats == [0; HEAP_STATS_WORDS] { continue; }
+            out[count] = (thread.tid, thread.heap_stats);
+            count += 1;
+        }
+    }
+    count
+}
+
+/// Version of the [`ThreadSnapRecord`] layout reported by `SYS_THREAD_SNAPSHOT`.
+pub const THREAD_SNAPSHOT_VERSION: u32 = 1;
+
+/// [`ThreadSnapRecord::flags`]: a per-CPU idle thread.
+pub const SNAP_FLAG_IDLE: u8 = 1;
+/// [`ThreadSnapRecord::flags`]: a critical system thread.
+pub const SNAP_FLAG_CRITICAL: u8 = 2;
+/// [`ThreadSnapRecord::flags`]: a user-mode thread.
+pub const SNAP_FLAG_USER: u8 = 4;
+
+/// One thread in a `SYS_THREAD_SNAPSHOT` buffer (96 bytes, version 1).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct ThreadSnapRecord {
+    pub tid: u32,
+    /// TID of the thread owning the address space (the process).
+    pub pid: u32,
+    pub parent_tid: u32,
+    /// 0=ready, 1=running, 2=blocked.
+    pub state: u8,
+    pub priority: u8,
+    /// 0=x86_64, 1=x86.
+    pub arch_mode: u8,
+    /// `SNAP_FLAG_*`.
+    pub flags: u8,
+    pub last_cpu: u16,
+    pub uid: u16,
+    pub gid: u16,
+    pub _pad: u16,
+    pub cpu_ticks: u32,
+    /// Ticks since the caller's previous snapshot (filled in by the syscall).
+    pub tick_delta: u32,
+    pub user_pages: u32,
+    /// Heap bytes in use as last reported through `SYS_HEAP_REPORT`.
+    pub heap_in_use: u32,
+    /// Free heap bytes and the largest free block, from the same report.
+    pub heap_free: u32,
+    pub heap_largest_free: u32,
+    pub io_read_bytes: u64,
+    pub io_write_bytes: u64,
+    /// NUL-padded.
+    pub name: [u8; 32],
+}
+
+/// Copy every live thread into `out`, up to its capacity, in one pass
+/// under the scheduler lock; `out` is never grown, so nothing is allocated
+/// while the lock is held.  Returns `(live threads, total scheduler ticks,
+/// idle scheduler ticks)`, the tick counters read in the same pass.
+pub fn thread_snapshot(out: &mut Vec<ThreadSnapRecord>) -> (usize, u32, u32) {
+    // Address space of each record, to resolve the owning process below
+    let mut spaces: Vec<(u64, bool)> = Vec::with_capacity(out.capacity());
+    let mut total = 0;
+    let (total_ticks, idle_ticks);
+    {
+        let guard = SCHEDULER.lock();
+        total_ticks = super::total_sched_ticks();
+        idle_ticks = super::idle_sched_ticks();
+        if let Some(sched) = guard.as_ref() {
+            let online_cpus = crate::arch::hal::cpu_count();
+            for thread in &sched.threads {
+                if thread.state == ThreadState::Terminated { continue; }
+                if thread.is_idle && !sched.idle_tid[..online_cpus].contains(&thread.tid) { continue; }
+                total += 1;
+                if out.len() == out.capacity() { continue; }
+                let state = match thread.state {
+                    ThreadState::Ready => 0,
+                    ThreadState::Running => 1,
+                    _ => 2,
+                };
+                let flags = if thread.is_idle { SNAP_FLAG_IDLE } else { 0 }
+                    | if thread.critical { SNAP_FLAG_CRITICAL } else { 0 }
+                    | if thread.is_user { SNAP_FLAG_USER } else { 0 };
+                out.push(ThreadSnapRecord {
+                    tid: thread.tid,
+                    pid: thread.tid,
+                    parent_tid: thread.parent_tid,
+                    state,
+                    priority: thread.priority,
+                    arch_mode: thread.arch_mode as u8,
+                    flags,
+                    last_cpu: thread.last_cpu as u16,
+                    uid: thread.uid,
+                    gid: thread.gid,
+                    _pad: 0,
+                    cpu_ticks: thread.cpu_ticks,
+                    tick_delta: 0,
+                    user_pages: thread.user_pages,
+                    heap_in_use: thread.heap_stats[1],
+                    heap_free: thread.heap_stats[2],
+                    heap_largest_free: thread.heap_stats[3],
+                    io_read_bytes: thread.io_read_bytes,
+                    io_write_bytes: thread.io_write_bytes,
+                    name: thread.name,
+                });
+                let pd = thread.page_directory.map_or(0, |pd| pd.as_u64());
+                spaces.push((pd, thread.pd_shared));
+            }
+        }
+    }
+
+    // Threads sharing an address space belong to the thread that owns it
+    for i in 0..out.len() {
+        let (pd, shared) = spaces[i];
+        if !shared { continue; }
+        out[i].pid = spaces.iter()
+            .position(|&(p, s)| p == pd && !s)
+            .map_or(out[i].parent_tid, |j| out[j].tid);
+    }
+    (total, total_ticks, idle_ticks)
+}
+
 // =============================================================================
 // Lock management
 // =============================================================================
@@ -124,7 +251,7 @@ pub fn record_io_write(bytes: u64) {
 pub fn adjust_thread_user_pages(tid: u32, delta: i32) {
     let mut guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_mut() {
-        if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread_mut(tid) {
             if delta >= 0 {
                 thread.user_pages = thread.user_pages.saturating_add(delta as u32);
             } else {
@@ -86,7 +86,7 @@ pub fn set_thread_fd_table(tid: u32, table: FdTable) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_GET_THREAD_INFO);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.fd_table = table;
     }
 }
@@ -124,7 +124,7 @@ pub fn close_all_fds_for_thread(tid: u32) -> [FdKind; MAX_FDS] {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_GET_THREAD_INFO);
     let mut guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_mut() {
-        if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread_mut(tid) {
             thread.fd_table.close_all(&mut out);
         }
     }
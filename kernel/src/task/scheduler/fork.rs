@@ -61,7 +61,7 @@ pub fn current_thread_fork_snapshot() -> Option<ForkSnapshot> {
 pub fn set_thread_fpu_state(tid: u32, data: &[u8; crate::task::thread::FPU_STATE_SIZE]) {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.fpu_state.data = *data;
     }
 }
@@ -70,7 +70,7 @@ pub fn set_thread_fpu_state(tid: u32, data: &[u8; crate::task::thread::FPU_STATE
 pub fn set_thread_mmap_next(tid: u32, val: u32) {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.mmap_next = val;
     }
 }
@@ -79,7 +79,7 @@ pub fn set_thread_mmap_next(tid: u32, val: u32) {
 pub fn set_thread_user_pages(tid: u32, val: u32) {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.user_pages = val;
     }
 }
@@ -94,7 +94,7 @@ pub fn exec_update_thread(
 ) {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.page_directory = Some(new_pd);
         #[cfg(target_arch = "x86_64")]
         {
@@ -112,6 +112,7 @@ pub fn exec_update_thread(
         thread.fpu_state = crate::task::thread::FxState::new_default();
         thread.user_pages = user_pages;
         thread.arch_mode = arch_mode;
+        thread.spawn_tick = crate::arch::hal::timer_current_ticks();
         thread.context.checksum = thread.context.compute_checksum();
     }
 }
@@ -373,11 +373,23 @@ pub fn kill_thread(tid: u32) -> u32 {
                 FdKind::PipeWrite { pipe_id } => {
                     crate::ipc::anon_pipe::decref_write(*pipe_id);
                 }
+                FdKind::PollSet { set_id } => {
+                    crate::ipc::poll_set::decref(*set_id);
+                }
+                FdKind::IoRing { ring_id } => {
+                    crate::ipc::io_ring::decref(*ring_id);
+                }
                 FdKind::Tty | FdKind::None => {}
             }
         }
     }
     if let Some(pd) = pd_to_destroy {
+        // File mappings: dirty shared pages are copied out in the victim's
+        // address space and written back once it is switched away again.
+        // A thread killing itself is already Terminated and must not block
+        // on file I/O, so its shared pages are dropped unwritten.
+        let mapped = crate::memory::file_map::detach_process(pd);
+        let mut dirty = alloc::vec::Vec::new();
         if is_current {
             crate::ipc::shared_memory::cleanup_process(tid);
         } else if !running_on_other_cpu {
@@ -386,12 +398,16 @@ pub fn kill_thread(tid: u32) -> u32 {
                 let old_cr3 = crate::arch::hal::current_page_table();
                 crate::arch::hal::switch_page_table(pd.as_u64());
                 crate::ipc::shared_memory::cleanup_process(tid);
+                dirty = crate::memory::file_map::collect_dirty(&mapped);
                 crate::arch::hal::switch_page_table(old_cr3);
                 crate::arch::hal::restore_interrupt_state(rflags);
             }
         }
+        crate::memory::file_map::finish(mapped, dirty);
     }
     crate::net::tcp::cleanup_for_thread(tid);
+    #[cfg(target_arch = "x86_64")]
+    crate::drivers::audio::cleanup_for_thread(tid);
     if let Some(pd) = pd_to_destroy {
         crate::task::env::cleanup(pd.as_u64());
     }
@@ -5,6 +5,10 @@
 //! steal work from the busiest CPU. Lazy FPU/SSE/AVX switching via CR0.TS avoids
 //! saving/restoring XSAVE state (832 bytes with AVX) on every context switch —
 //! only threads that actually use FPU/SSE/AVX pay the cost.
+//!
+//! Threads are found by TID through a radix table ([`tid_table`]) and timed
+//! sleepers sit in a deadline heap, so nothing done under the scheduler lock
+//! on the per-tick path scans the whole thread list.
 
 // --- Submodules ---
 mod run_queue;
@@ -22,6 +26,7 @@ mod fd_table;
 mod signals;
 mod lifecycle;
 mod debug_trace;
+mod tid_table;
 
 // Re-export all public API functions from submodules.
 pub use fpu::*;
@@ -38,7 +43,7 @@ pub use signals::*;
 pub use lifecycle::*;
 pub use debug_trace::*;
 
-use crate::sync::spinlock::Spinlock;
+use crate::sync::ticket_lock::TicketLock;
 use crate::task::context::CpuContext;
 use crate::task::thread::{Thread, ThreadState};
 use crate::arch::hal::MAX_CPUS;
@@ -47,6 +52,9 @@ use alloc::vec::Vec;
 use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
 use run_queue::RunQueue;
 use deferred::DEFERRED_PD_DESTROY;
+use tid_table::TidTable;
+use alloc::collections::BinaryHeap;
+use core::cmp::Reverse;
 
 /// Number of discrete priority levels (Mach-style, like macOS).
 const NUM_PRIORITIES: usize = 128;
@@ -86,7 +94,8 @@ fn clamp_priority(priority: u8, context: &str) -> u8 {
 // Global state
 // =============================================================================
 
-static SCHEDULER: Spinlock<Option<Scheduler>> = Spinlock::new(None);
+/// FIFO ticket lock so no CPU starves on the hottest lock in the kernel.
+static SCHEDULER: TicketLock<Option<Scheduler>> = TicketLock::new(None);
 
 // =============================================================================
 // Per-CPU atomics (lock-free, read by ISR/panic handlers)
@@ -197,6 +206,9 @@ static DEFERRED_WAKE_TIDS: [AtomicU32; 4] = {
 /// Overwrites the oldest slot if all slots are occupied.  Missing a wake
 /// is acceptable — the compositor's 16ms timeout provides a safety net.
 pub fn deferred_wake(tid: u32) {
+    // Slots are drained by the next schedule_inner on any CPU; make sure
+    // this one has a timer event coming even if its tick is stopped.
+    crate::arch::hal::timer_wake(crate::arch::hal::cpu_id());
     for slot in &DEFERRED_WAKE_TIDS {
         // Try to claim an empty slot (0 → tid).
         if slot.compare_exchange(0, tid, Ordering::Release, Ordering::Relaxed).is_ok() {
@@ -226,6 +238,29 @@ static PER_CPU_IDLE: [AtomicU32; MAX_CPUS] = {
     [INIT; MAX_CPUS]
 };
 /// Busy ticks accumulated while the scheduler lock was contended.
+/// Threads this CPU took from a peer's queue while idle (per CPU).
+static PER_CPU_STEALS_IN: [AtomicU32; MAX_CPUS] = {
+    const INIT: AtomicU32 = AtomicU32::new(0);
+    [INIT; MAX_CPUS]
+};
+/// Threads peers took from this CPU's queue (per CPU).
+static PER_CPU_STEALS_OUT: [AtomicU32; MAX_CPUS] = {
+    const INIT: AtomicU32 = AtomicU32::new(0);
+    [INIT; MAX_CPUS]
+};
+/// Steal attempts abandoned because every candidate was still cache-hot.
+static STEAL_HOT_SKIPS: AtomicU32 = AtomicU32::new(0);
+/// Affinity moves made by the periodic rebalancer.
+static AFFINITY_REBALANCES: AtomicU32 = AtomicU32::new(0);
+
+/// A thread that left its CPU less than this many ticks ago is cache-hot and
+/// is only stolen from a clearly overloaded peer (see [`STEAL_FORCE_QUEUE`]).
+const STEAL_HOT_TICKS: u32 = 4;
+/// Victim queue length at which cache-hot threads may be stolen too.
+const STEAL_FORCE_QUEUE: usize = 3;
+/// Queue entries examined per steal attempt.
+const STEAL_SCAN: usize = 8;
+
 static PER_CPU_CONTENDED_BUSY: [AtomicU32; MAX_CPUS] = {
     const INIT: AtomicU32 = AtomicU32::new(0);
     [INIT; MAX_CPUS]
@@ -233,9 +268,9 @@ static PER_CPU_CONTENDED_BUSY: [AtomicU32; MAX_CPUS] = {
 
 /// True when this CPU is inside schedule_inner (either timer or voluntary path).
 /// Checked by the timer handler to prevent re-entrant schedule_tick() calls.
-/// Without this, a timer firing during the voluntary schedule's try_lock loop
+/// Without this, a timer firing during the voluntary schedule's lock wait
 /// nests schedule_inner → context_switch, which can corrupt saved contexts
-/// and cause deadlocks when the restored thread re-enters the try_lock loop.
+/// and cause deadlocks when the restored thread re-enters the lock wait.
 static PER_CPU_IN_SCHEDULER: [AtomicBool; MAX_CPUS] = {
     const INIT: AtomicBool = AtomicBool::new(false);
     [INIT; MAX_CPUS]
@@ -291,6 +326,16 @@ pub struct Scheduler {
     per_cpu: Vec<PerCpuState>,
     /// Per-CPU idle thread TIDs. Always valid — never reaped.
     idle_tid: [u32; MAX_CPUS],
+    /// TID → index into `threads`, kept in sync on push/swap_remove.
+    tid_index: TidTable,
+    /// Pending sleep deadlines as (`monotonic_ns`, TID, wake_at_tick),
+    /// earliest first.  Entries are validated against the thread on expiry,
+    /// so early wakes and reaps just leave a stale entry behind.  The head
+    /// is published to the timer ([`hal::timer_set_next_event`]), which
+    /// fires between ticks for sub-millisecond deadlines.
+    ///
+    /// [`hal::timer_set_next_event`]: crate::arch::hal::timer_set_next_event
+    sleepers: BinaryHeap<Reverse<(u64, u32, u32)>>,
 }
 
 /// Idle thread entry point. Uses MONITOR/MWAIT when available (faster wake-up,
@@ -352,6 +397,8 @@ impl Scheduler {
             threads: Vec::with_capacity(128),
             per_cpu,
             idle_tid: [0; MAX_CPUS],
+            tid_index: TidTable::new(),
+            sleepers: BinaryHeap::new(),
         };
 
         // Create per-CPU idle threads (priority 0 = lowest).
@@ -367,16 +414,96 @@ impl Scheduler {
             thread.is_idle = true;
             let tid = thread.tid;
             sched.idle_tid[cpu] = tid;
-            sched.threads.push(Box::new(thread));
+            sched.push_thread(Box::new(thread));
         }
 
         sched
     }
 
-    /// Find a thread's index in the threads Vec by TID. O(n) linear scan.
+    /// Find a thread's index in the threads Vec by TID. O(1) via `tid_index`.
     #[inline]
     fn find_idx(&self, tid: u32) -> Option<usize> {
-        self.threads.iter().position(|t| t.tid == tid)
+        self.tid_index.get(tid)
+    }
+
+    /// Look up a thread by TID.
+    #[inline]
+    fn thread(&self, tid: u32) -> Option<&Thread> {
+        self.find_idx(tid).map(|i| &*self.threads[i])
+    }
+
+    /// Look up a thread by TID for modification.
+    #[inline]
+    fn thread_mut(&mut self, tid: u32) -> Option<&mut Thread> {
+        match self.find_idx(tid) {
+            Some(i) => Some(&mut *self.threads[i]),
+            None => None,
+        }
+    }
+
+    /// Append a thread to `threads` and index it.
+    fn push_thread(&mut self, thread: Box<Thread>) {
+        self.tid_index.insert(thread.tid, self.threads.len());
+        self.threads.push(thread);
+    }
+
+    /// Register a `sleep_until` deadline for `tid` (absolute raw tick).
+    fn add_sleeper(&mut self, tid: u32, wake_at: u32) {
+        // Deadlines already in the past (wrapping distance ≥ 2^31) expire now,
+        // matching the `wrapping_sub < 0x8000_0000` test used on expiry.
+        let delta = wake_at.wrapping_sub(crate::arch::hal::timer_current_ticks());
+        let delta = if delta < 0x8000_0000 { delta as u64 } else { 0 };
+        let ns_per_tick = 1_000_000_000 / crate::arch::hal::timer_frequency_hz();
+        let deadline = crate::arch::hal::monotonic_ns() + delta * ns_per_tick;
+        self.add_sleeper_ns(tid, deadline, wake_at);
+    }
+
+    /// Register a nanosecond deadline for `tid`; `tag` must equal the
+    /// thread's `wake_at_tick` for the entry to wake it.
+    fn add_sleeper_ns(&mut self, tid: u32, deadline_ns: u64, tag: u32) {
+        self.sleepers.push(Reverse((deadline_ns, tid, tag)));
+        self.publish_next_sleeper();
+    }
+
+    /// Hand the earliest pending deadline to the timer.
+    fn publish_next_sleeper(&self) {
+        let next = self.sleepers.peek().map_or(u64::MAX, |r| (r.0).0);
+        crate::arch::hal::timer_set_next_event(next);
+    }
+
+    /// Enqueue a Ready thread on `cpu` and make sure a CPU will run it
+    /// (restarts a stopped tick, see [`hal::timer_kick`]).
+    ///
+    /// [`hal::timer_kick`]: crate::arch::hal::timer_kick
+    fn make_ready(&mut self, cpu: usize, tid: u32, priority: u8) {
+        self.per_cpu[cpu].run_queue.enqueue(tid, priority);
+        crate::arch::hal::timer_kick(cpu);
+    }
+
+    /// Make every sleeper whose deadline has passed Ready again.
+    fn wake_expired_sleepers(&mut self) {
+        let now = crate::arch::hal::monotonic_ns();
+        let n_cpus = self.num_cpus();
+        while let Some(&Reverse((deadline, tid, wake_at))) = self.sleepers.peek() {
+            if deadline > now {
+                break;
+            }
+            self.sleepers.pop();
+            if let Some(idx) = self.find_idx(tid) {
+                let t = &mut self.threads[idx];
+                if t.state == ThreadState::Blocked && t.wake_at_tick == Some(wake_at) {
+                    let pri = t.priority;
+                    let aff = t.affinity_cpu;
+                    let target_cpu = if aff < n_cpus { aff } else { 0 };
+                    t.state = ThreadState::Ready;
+                    t.wake_at_tick = None;
+                    self.make_ready(target_cpu, tid, pri);
+                    crate::task::tracepoints::emit(
+                        crate::task::tracepoints::SCHED_WAKEUP, tid as u64, target_cpu as u64);
+                }
+            }
+        }
+        self.publish_next_sleeper();
     }
 
     /// Get index of the current thread on the given CPU.
@@ -435,8 +562,8 @@ impl Scheduler {
         let pri = thread.priority;
         thread.last_cpu = cpu;
         thread.affinity_cpu = cpu;
-        self.threads.push(thread);
-        self.per_cpu[cpu].run_queue.enqueue(tid, pri);
+        self.push_thread(thread);
+        self.make_ready(cpu, tid, pri);
         tid
     }
 
@@ -450,7 +577,7 @@ impl Scheduler {
         let cpu = self.least_loaded_cpu();
         thread.last_cpu = cpu;
         thread.affinity_cpu = cpu;
-        self.threads.push(thread);
+        self.push_thread(thread);
         tid
     }
 
@@ -523,10 +650,12 @@ impl Scheduler {
                     // (see schedule_inner) so dealloc doesn't contend the ALLOCATOR
                     // while we hold the lock.
                     let thread = self.threads.swap_remove(i);
-                    // Maintain current_idx caches: swap_remove moved the
-                    // last element into position i.
+                    self.tid_index.remove(tid);
+                    // Maintain current_idx caches and the TID index:
+                    // swap_remove moved the last element into position i.
                     let moved_from = self.threads.len();
                     if i < self.threads.len() {
+                        self.tid_index.insert(self.threads[i].tid, i);
                         for cpu in 0..MAX_CPUS {
                             if self.per_cpu[cpu].current_idx == Some(moved_from) {
                                 self.per_cpu[cpu].current_idx = Some(i);
@@ -555,10 +684,20 @@ impl Scheduler {
         if let Some(tid) = self.pick_eligible(cpu_id) {
             return Some(tid);
         }
-        // 2. Work stealing: find the busiest CPU and steal only when the
-        //    imbalance is large enough to justify cache-line invalidation.
-        //    With few threads and many CPUs, overeager stealing causes
-        //    constant migration of heavy threads (DOOM, compositor).
+        // 2. Nothing local — about to go idle, so try to steal.
+        self.steal_work(cpu_id)
+    }
+
+    /// Idle-time work stealing: take the highest-priority runnable thread
+    /// from the peer with the longest ready queue.
+    ///
+    /// Cache-affinity hysteresis: a thread that left the victim CPU within
+    /// `STEAL_HOT_TICKS` still has a warm cache there and is skipped unless
+    /// the victim has `STEAL_FORCE_QUEUE`+ threads waiting.  This keeps two
+    /// threads ping-ponging on one CPU (DOOM + compositor) from bouncing
+    /// between cores, while a queue of compile jobs drains onto idle CPUs
+    /// within a few ticks.  A stolen thread's affinity moves with it.
+    fn steal_work(&mut self, cpu_id: usize) -> Option<u32> {
         let n = self.num_cpus();
         let mut max_count = 0;
         let mut victim = cpu_id;
@@ -571,14 +710,45 @@ impl Scheduler {
                 }
             }
         }
-        // Only steal when the victim has 3+ queued threads — this keeps 2 for
-        // the victim (1 running + 1 queued) before we take one.  Prevents
-        // thrashing when 2 threads share a CPU via affinity.
-        if max_count >= 3 {
-            self.pick_eligible(victim)
-        } else {
-            None
+        if max_count == 0 {
+            return None;
         }
+
+        let now = crate::arch::hal::timer_current_ticks();
+        let allow_hot = max_count >= STEAL_FORCE_QUEUE;
+        let mut hot_skipped = false;
+        let threads = &self.threads;
+        let tid_index = &self.tid_index;
+        let stolen = self.per_cpu[victim].run_queue.take_highest_matching(STEAL_SCAN, |tid| {
+            let t = match tid_index.get(tid) {
+                Some(i) => &threads[i],
+                None => return false,
+            };
+            if t.is_idle || t.state != ThreadState::Ready || t.context.save_complete == 0 {
+                return false;
+            }
+            if !allow_hot && now.wrapping_sub(t.last_run_tick) < STEAL_HOT_TICKS {
+                hot_skipped = true;
+                return false;
+            }
+            true
+        });
+
+        let tid = match stolen {
+            Some(t) => t,
+            None => {
+                if hot_skipped {
+                    STEAL_HOT_SKIPS.fetch_add(1, Ordering::Relaxed);
+                }
+                return None;
+            }
+        };
+        if let Some(t) = self.thread_mut(tid) {
+            t.affinity_cpu = cpu_id;
+        }
+        PER_CPU_STEALS_IN[cpu_id].fetch_add(1, Ordering::Relaxed);
+        PER_CPU_STEALS_OUT[victim].fetch_add(1, Ordering::Relaxed);
+        Some(tid)
     }
 
     /// Dequeue the highest-priority eligible thread from a CPU's queue.
@@ -608,16 +778,25 @@ impl Scheduler {
     }
 
     /// Wake a blocked thread, enqueuing on its stable `affinity_cpu`.
-    fn wake_thread_inner(&mut self, tid: u32) {
+    /// Returns `true` if the thread was Blocked.
+    fn wake_thread_inner(&mut self, tid: u32) -> bool {
         if let Some(idx) = self.find_idx(tid) {
             if self.threads[idx].state == ThreadState::Blocked {
                 self.threads[idx].state = ThreadState::Ready;
+                // A pending deadline is moot once woken; clearing it keeps the
+                // stale sleeper entry from waking a later, unrelated block.
+                self.threads[idx].wake_at_tick = None;
                 let cpu = self.threads[idx].affinity_cpu;
                 let n = self.num_cpus();
                 let target = if cpu < n { cpu } else { 0 };
-                self.per_cpu[target].run_queue.enqueue(tid, self.threads[idx].priority);
+                let pri = self.threads[idx].priority;
+                self.make_ready(target, tid, pri);
+                crate::task::tracepoints::emit(
+                    crate::task::tracepoints::SCHED_WAKEUP, tid as u64, target as u64);
+                return true;
             }
         }
+        false
     }
 }
 
@@ -657,6 +836,22 @@ pub fn per_cpu_idle_ticks(cpu: usize) -> u32 {
     if cpu < MAX_CPUS { PER_CPU_IDLE[cpu].load(Ordering::Relaxed) } else { 0 }
 }
 
+/// Work-stealing counters for one CPU: (threads stolen by it, threads stolen from it).
+pub fn per_cpu_steals(cpu: usize) -> (u32, u32) {
+    if cpu < MAX_CPUS {
+        (PER_CPU_STEALS_IN[cpu].load(Ordering::Relaxed),
+         PER_CPU_STEALS_OUT[cpu].load(Ordering::Relaxed))
+    } else {
+        (0, 0)
+    }
+}
+
+/// Steal attempts skipped because all candidates were cache-hot.
+pub fn steal_hot_skips() -> u32 { STEAL_HOT_SKIPS.load(Ordering::Relaxed) }
+
+/// Affinity changes made by the periodic rebalancer.
+pub fn affinity_rebalances() -> u32 { AFFINITY_REBALANCES.load(Ordering::Relaxed) }
+
 // =============================================================================
 // Scheduling
 // =============================================================================
@@ -678,14 +873,42 @@ pub fn schedule_tick() -> bool {
         }
         return false;
     }
-    schedule_inner(true);
+    schedule_inner(true, true);
+    true
+}
+
+/// Called from a timer interrupt that is not a scheduler tick: a sleeper
+/// deadline between ticks, or a kick that restarts a stopped tick.  Runs
+/// the timer-path work (sleepers, deferred wakes, reaping) without CPU
+/// tick accounting.  Returns false if this CPU is already scheduling.
+pub fn schedule_timer_event() -> bool {
+    let cpu_id = crate::arch::hal::cpu_id();
+    if cpu_id < MAX_CPUS && PER_CPU_IN_SCHEDULER[cpu_id].load(Ordering::Relaxed) {
+        return false;
+    }
+    schedule_inner(true, false);
     true
 }
 
+/// Credit `ticks` idle ticks to `cpu` for time spent with its tick stopped,
+/// so load figures match a CPU that took every tick in the idle thread.
+pub fn account_idle_ticks(cpu: usize, ticks: u32) {
+    if ticks == 0 || cpu >= MAX_CPUS {
+        return;
+    }
+    TOTAL_SCHED_TICKS.fetch_add(ticks, Ordering::Relaxed);
+    PER_CPU_TOTAL[cpu].fetch_add(ticks, Ordering::Relaxed);
+    IDLE_SCHED_TICKS.fetch_add(ticks, Ordering::Relaxed);
+    PER_CPU_IDLE[cpu].fetch_add(ticks, Ordering::Relaxed);
+}
+
 /// Voluntary yield: reschedule without incrementing CPU accounting counters.
-pub fn schedule() { schedule_inner(false); }
+pub fn schedule() { schedule_inner(false, false); }
 
-fn schedule_inner(from_timer: bool) {
+/// `from_timer`: interrupt context (try_lock, sleeper/reap housekeeping).
+/// `tick`: a scheduler tick — counts toward CPU accounting and the
+/// tick-rate-limited checks. Implies `from_timer`.
+fn schedule_inner(from_timer: bool, tick: bool) {
     // Read CPU ID and set in-scheduler flag atomically w.r.t. timer interrupts.
     // For from_timer=true, IF is already 0 (inside IRQ handler) — no race.
     // For from_timer=false (voluntary), we MUST briefly disable interrupts to
@@ -724,6 +947,13 @@ fn schedule_inner(from_timer: bool) {
         let pds = DEFERRED_PD_DESTROY.lock().drain();
         for entry in pds.iter().flatten() {
             let (pd, tid) = *entry;
+            // The reclaim thread is scanning this address space: retry
+            // on a later tick.
+            #[cfg(target_arch = "x86_64")]
+            if crate::memory::reclaim::is_pinned(pd) {
+                DEFERRED_PD_DESTROY.lock().push(pd, tid);
+                continue;
+            }
             if tid != 0 {
                 // Thread was still running on another CPU at kill time.
                 // cleanup_process hasn't run yet; do it now with the correct CR3.
@@ -742,13 +972,13 @@ fn schedule_inner(from_timer: bool) {
         }
     }
 
-    // Tick counters (timer path only)
-    if from_timer {
+    // Tick counters (tick path only)
+    if tick {
         TOTAL_SCHED_TICKS.fetch_add(1, Ordering::Relaxed);
         PER_CPU_TOTAL[cpu_id_early].fetch_add(1, Ordering::Relaxed);
     }
 
-    // Lock acquisition: try_lock for timer (non-blocking), spin for voluntary
+    // Lock acquisition: try_lock for timer (non-blocking), FIFO wait for voluntary
     crate::sched_diag::set(cpu_id_early, if from_timer {
         crate::sched_diag::PHASE_SCHEDULE_TIMER
     } else {
@@ -757,6 +987,10 @@ fn schedule_inner(from_timer: bool) {
     let mut guard = if from_timer {
         match SCHEDULER.try_lock() {
             Some(s) => s,
+            None if !tick => {
+                PER_CPU_IN_SCHEDULER[cpu_id_early].store(false, Ordering::Relaxed);
+                return;
+            }
             None => {
                 if !PER_CPU_HAS_THREAD[cpu_id_early].load(Ordering::Relaxed) {
                     IDLE_SCHED_TICKS.fetch_add(1, Ordering::Relaxed);
@@ -769,12 +1003,8 @@ fn schedule_inner(from_timer: bool) {
             }
         }
     } else {
-        loop {
-            match SCHEDULER.try_lock() {
-                Some(s) => break s,
-                None => core::hint::spin_loop(),
-            }
-        }
+        // Queue for a ticket: a try_lock loop would starve behind waiters.
+        SCHEDULER.lock()
     };
 
     // Re-read CPU ID under lock (interrupts disabled — can't migrate)
@@ -819,7 +1049,7 @@ fn schedule_inner(from_timer: bool) {
         // Rate-limited to every 100 ticks (~100ms) to avoid holding the lock
         // too long with serial output. Only reports first corrupt thread found
         // to keep the critical section short.
-        if from_timer && cpu_id == 0 {
+        if tick && cpu_id == 0 {
             static CANARY_CHECK_CTR: AtomicU32 = AtomicU32::new(0);
             let ctr = CANARY_CHECK_CTR.fetch_add(1, Ordering::Relaxed);
             if ctr % 100 == 0 {
@@ -850,25 +1080,10 @@ fn schedule_inner(from_timer: bool) {
             }
         }
 
-        // Wake expired sleepers
+        // Wake expired sleepers (heap ordered by deadline — no thread scan)
         let n_cpus = sched.num_cpus();
         if from_timer {
-            let current_tick = crate::arch::hal::timer_current_ticks();
-            for i in 0..sched.threads.len() {
-                if sched.threads[i].state == ThreadState::Blocked {
-                    if let Some(wake_tick) = sched.threads[i].wake_at_tick {
-                        if current_tick.wrapping_sub(wake_tick) < 0x8000_0000 {
-                            let tid = sched.threads[i].tid;
-                            let pri = sched.threads[i].priority;
-                            let aff = sched.threads[i].affinity_cpu;
-                            let target_cpu = if aff < n_cpus { aff } else { 0 };
-                            sched.threads[i].state = ThreadState::Ready;
-                            sched.threads[i].wake_at_tick = None;
-                            sched.per_cpu[target_cpu].run_queue.enqueue(tid, pri);
-                        }
-                    }
-                }
-            }
+            sched.wake_expired_sleepers();
         }
 
         // --- Periodic affinity rebalancing (CPU 0 only, every ~1 second) ---
@@ -876,7 +1091,7 @@ fn schedule_inner(from_timer: bool) {
         // If any CPU is overloaded (3+ more than the lightest), migrate one
         // thread's affinity to the lightest CPU.  This is the ONLY place
         // where affinity_cpu changes after spawn.
-        if from_timer && cpu_id == 0 {
+        if tick && cpu_id == 0 {
             static REBALANCE_CTR: AtomicU32 = AtomicU32::new(0);
             let ctr = REBALANCE_CTR.fetch_add(1, Ordering::Relaxed);
             if ctr % 1000 == 0 {
@@ -927,6 +1142,7 @@ fn schedule_inner(from_timer: bool) {
                     }
                     if let Some(vi) = victim_idx {
                         sched.threads[vi].affinity_cpu = lightest_cpu;
+                        AFFINITY_REBALANCES.fetch_add(1, Ordering::Relaxed);
                     }
                 }
             }
@@ -952,7 +1168,7 @@ fn schedule_inner(from_timer: bool) {
         }
 
         // CPU tick accounting
-        if from_timer {
+        if tick {
             if outgoing_is_idle {
                 IDLE_SCHED_TICKS.fetch_add(1, Ordering::Relaxed);
                 PER_CPU_IDLE[cpu_id].fetch_add(1, Ordering::Relaxed);
@@ -968,6 +1184,7 @@ fn schedule_inner(from_timer: bool) {
             if let Some(idx) = outgoing_idx {
                 // ALWAYS mark context as unsaved for non-idle outgoing threads.
                 sched.threads[idx].context.save_complete = 0;
+                sched.threads[idx].last_run_tick = crate::arch::hal::timer_current_ticks();
                 if sched.threads[idx].state == ThreadState::Running {
                     sched.threads[idx].state = ThreadState::Ready;
                     sched.threads[idx].last_cpu = cpu_id;
@@ -1213,6 +1430,13 @@ fn schedule_inner(from_timer: bool) {
             }
         }
 
+        // Re-arm the timer while still holding the lock: a waker enqueues
+        // under this lock, so it either sees this CPU's tick stopped (and
+        // kicks it) or the CPU sees its thread here and keeps ticking.
+        let keep_tick = PER_CPU_HAS_THREAD[cpu_id].load(Ordering::Relaxed)
+            || sched.per_cpu.iter().any(|p| p.run_queue.total_count() > 0);
+        crate::arch::hal::timer_reprogram(cpu_id, keep_tick);
+
     } // sched borrow ends here
 
     // Release lock WITHOUT restoring IF — keeps interrupts disabled through context_switch
@@ -1269,7 +1493,10 @@ fn schedule_inner(from_timer: bool) {
     drop(reaped_threads);
 
     // Context switch with lock released, interrupts still disabled
-    if let Some((old_ctx, new_ctx, old_fpu, _new_fpu, outgoing_tid, _next_tid)) = switch_info {
+    if let Some((old_ctx, new_ctx, old_fpu, _new_fpu, outgoing_tid, next_tid)) = switch_info {
+        crate::task::tracepoints::emit(
+            crate::task::tracepoints::SCHED_SWITCH, outgoing_tid as u64, next_tid as u64);
+
         // --- Lazy FPU: save outgoing thread's state if this CPU owns it ---
         let fpu_owner = PER_CPU_FPU_OWNER[cpu_id].load(Ordering::Relaxed);
         if fpu_owner != 0 && fpu_owner == outgoing_tid {
@@ -1293,6 +1520,7 @@ fn schedule_inner(from_timer: bool) {
             let next_sp = unsafe { (*new_ctx).get_sp() };
             let _ = unsafe { (*new_ctx).x[30] };
         }
+        crate::arch::hal::activate_address_space(cpu_id, unsafe { (*new_ctx).get_page_table() });
         unsafe { crate::task::context::context_switch(old_ctx, new_ctx); }
     }
 
@@ -14,12 +14,13 @@ pub fn set_thread_priority(tid: u32, priority: u8) {
     }
 }
 
-/// Wake a blocked thread by TID.
-pub fn wake_thread(tid: u32) {
+/// Wake a blocked thread by TID. Returns `true` if it was Blocked.
+pub fn wake_thread(tid: u32) -> bool {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_WAKE_THREAD);
     let mut guard = SCHEDULER.lock();
-    if let Some(sched) = guard.as_mut() {
-        sched.wake_thread_inner(tid);
+    match guard.as_mut() {
+        Some(sched) => sched.wake_thread_inner(tid),
+        None => false,
     }
 }
 
@@ -46,7 +47,7 @@ pub fn set_thread_critical(tid: u32) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_GET_THREAD_INFO);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.critical = true;
         crate::serial_println!("  Thread '{}' (TID={}) marked as critical", thread.name_str(), tid);
     }
@@ -69,7 +70,7 @@ pub fn set_thread_capabilities(tid: u32, caps: crate::task::capabilities::CapSet
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_GET_THREAD_INFO);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.capabilities = caps;
     }
 }
@@ -101,7 +102,7 @@ pub fn current_thread_gid() -> u16 {
 pub fn set_thread_identity(tid: u32, uid: u16, gid: u16) {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.uid = uid;
         thread.gid = gid;
     }
@@ -114,7 +115,7 @@ pub fn set_process_identity(tid: u32, uid: u16, gid: u16) {
     let sched = guard.as_mut().expect("Scheduler not initialized");
     // Find the page directory of the target thread
     let pd = {
-        let thread = match sched.threads.iter().find(|t| t.tid == tid) {
+        let thread = match sched.thread(tid) {
             Some(t) => t,
             None => return,
         };
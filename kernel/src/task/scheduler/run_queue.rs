@@ -62,6 +62,34 @@ impl RunQueue {
         Some(tid)
     }
 
+    /// Remove and return the highest-priority TID accepted by `pred`,
+    /// examining at most `max_scan` entries (highest level first, FIFO
+    /// order within a level).  Rejected entries keep their queue position.
+    pub(super) fn take_highest_matching(
+        &mut self,
+        max_scan: usize,
+        mut pred: impl FnMut(u32) -> bool,
+    ) -> Option<u32> {
+        let mut budget = max_scan;
+        let mut p = self.highest_priority()?;
+        loop {
+            let len = self.levels[p].len();
+            if let Some(pos) = self.levels[p].iter().take(budget).position(|&t| pred(t)) {
+                let tid = self.levels[p].remove(pos)?;
+                if self.levels[p].is_empty() {
+                    self.bits[p / 64] &= !(1u64 << (p % 64));
+                }
+                self.count -= 1;
+                return Some(tid);
+            }
+            budget = budget.saturating_sub(len);
+            if budget == 0 {
+                return None;
+            }
+            p = self.highest_below(p)?;
+        }
+    }
+
     /// Remove a specific TID from all priority levels.
     pub(super) fn remove(&mut self, tid: u32) {
         for p in 0..NUM_PRIORITIES {
@@ -97,6 +125,19 @@ impl RunQueue {
         }
     }
 
+    /// Highest non-empty priority level strictly below `p`.
+    fn highest_below(&self, p: usize) -> Option<usize> {
+        if p > 64 {
+            let m = self.bits[1] & ((1u64 << (p - 64)) - 1);
+            if m != 0 {
+                return Some(127 - m.leading_zeros() as usize);
+            }
+            return (self.bits[0] != 0).then(|| 63 - self.bits[0].leading_zeros() as usize);
+        }
+        let m = if p == 64 { self.bits[0] } else { self.bits[0] & ((1u64 << p) - 1) };
+        (m != 0).then(|| 63 - m.leading_zeros() as usize)
+    }
+
     /// Lowest priority level that has queued threads.
     fn lowest_priority(&self) -> Option<usize> {
         if self.bits[0] != 0 {
@@ -8,7 +8,7 @@ use alloc::vec::Vec;
 pub fn send_signal_to_thread(tid: u32, sig: u32) -> bool {
     let mut guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_mut() {
-        if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread_mut(tid) {
             thread.signals.send(sig);
             return true;
         }
@@ -95,7 +95,7 @@ pub fn set_thread_parent_tid(tid: u32, parent: u32) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_GET_THREAD_INFO);
     let mut guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_mut() {
-        if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread_mut(tid) {
             thread.parent_tid = parent;
         }
     }
@@ -117,7 +117,7 @@ pub fn current_parent_tid() -> u32 {
 pub fn set_thread_signals(tid: u32, signals: crate::ipc::signal::SignalState) {
     let mut guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_mut() {
-        if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread_mut(tid) {
             // Fork child inherits handler table and blocked mask, but pending signals are cleared
             thread.signals.handlers = signals.handlers;
             thread.signals.blocked = signals.blocked;
@@ -130,7 +130,7 @@ pub fn set_thread_signals(tid: u32, signals: crate::ipc::signal::SignalState) {
 pub fn thread_exists(tid: u32) -> bool {
     let guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_ref() {
-        return sched.threads.iter().any(|t| t.tid == tid && t.state != ThreadState::Terminated);
+        return sched.thread(tid).map_or(false, |t| t.state != ThreadState::Terminated);
     }
     false
 }
@@ -139,7 +139,7 @@ pub fn thread_exists(tid: u32) -> bool {
 pub fn get_thread_parent_tid(tid: u32) -> u32 {
     let guard = SCHEDULER.lock();
     if let Some(sched) = guard.as_ref() {
-        if let Some(thread) = sched.threads.iter().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread(tid) {
             return thread.parent_tid;
         }
     }
@@ -81,7 +81,7 @@ pub fn create_thread_in_current_process(entry_rip: u64, user_rsp: u64, name: &st
         crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_CREATE_THREAD);
         let mut guard = SCHEDULER.lock();
         let sched = guard.as_mut().expect("Scheduler not initialized");
-        if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(thread) = sched.thread_mut(tid) {
             thread.page_directory = Some(pd);
             thread.pcid = parent_pcid; // Same address space = same PCID
             #[cfg(target_arch = "x86_64")]
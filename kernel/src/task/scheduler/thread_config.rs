@@ -1,17 +1,17 @@
 //! Thread configuration: user info, arch mode, page directory, brk, mmap,
-//! args, cwd, stdout/stdin pipes.
+//! heap stats, args, cwd, stdout/stdin pipes.
 
 use super::{get_cpu_id, SCHEDULER};
 use crate::fs::fd_table::FdKind;
 use crate::memory::address::PhysAddr;
-use crate::task::thread::ThreadState;
+use crate::task::thread::{ThreadState, HEAP_STATS_WORDS};
 
 /// Configure a thread as a user process.
 pub fn set_thread_user_info(tid: u32, pd: PhysAddr, brk: u32) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_GET_THREAD_INFO);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.page_directory = Some(pd);
         #[cfg(target_arch = "x86_64")]
         {
@@ -34,7 +34,7 @@ pub fn set_thread_user_info(tid: u32, pd: PhysAddr, brk: u32) {
 pub fn set_thread_arch_mode(tid: u32, mode: crate::task::thread::ArchMode) {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.arch_mode = mode;
     }
 }
@@ -62,6 +62,38 @@ pub fn thread_page_directory(tid: u32) -> Option<PhysAddr> {
     None
 }
 
+/// Address spaces of live user processes: `(tid, page directory)` of each
+/// thread that owns its page directory (threads sharing one are skipped).
+pub fn user_address_spaces() -> alloc::vec::Vec<(u32, PhysAddr)> {
+    let guard = SCHEDULER.lock();
+    let mut out = alloc::vec::Vec::new();
+    if let Some(sched) = guard.as_ref() {
+        for t in sched.threads.iter() {
+            if let (Some(pd), false) = (t.page_directory, t.pd_shared) {
+                if t.state != ThreadState::Terminated {
+                    out.push((t.tid, pd));
+                }
+            }
+        }
+    }
+    out
+}
+
+/// Store `pd` in `pin` if a live thread still uses it; returns whether it
+/// did.  Checked and stored under the scheduler lock: a page directory is
+/// queued for destruction only after its last thread dropped it (under the
+/// same lock), so the drain then sees the pin (see `memory::reclaim`).
+pub fn pin_if_live(pd: PhysAddr, pin: &core::sync::atomic::AtomicU64) -> bool {
+    let guard = SCHEDULER.lock();
+    let live = guard.as_ref().map_or(false, |sched| {
+        sched.threads.iter().any(|t| t.page_directory == Some(pd) && t.state != ThreadState::Terminated)
+    });
+    if live {
+        pin.store(pd.as_u64(), core::sync::atomic::Ordering::SeqCst);
+    }
+    live
+}
+
 /// Check if the current thread has a shared page directory.
 pub fn current_thread_pd_shared() -> bool {
     let guard = SCHEDULER.lock();
@@ -164,6 +196,26 @@ pub fn current_thread_mmap_next() -> u32 {
     0
 }
 
+/// Store a heap usage record for the current process, syncing across
+/// sibling threads (they share the allocator).
+pub fn set_current_heap_stats(stats: [u32; HEAP_STATS_WORDS]) {
+    let mut guard = SCHEDULER.lock();
+    let cpu_id = get_cpu_id();
+    if let Some(sched) = guard.as_mut() {
+        if let Some(idx) = sched.current_idx(cpu_id) {
+            sched.threads[idx].heap_stats = stats;
+            if let Some(pd) = sched.threads[idx].page_directory {
+                let current_tid = sched.threads[idx].tid;
+                for thread in sched.threads.iter_mut() {
+                    if thread.tid != current_tid && thread.page_directory == Some(pd) {
+                        thread.heap_stats = stats;
+                    }
+                }
+            }
+        }
+    }
+}
+
 /// Set the current thread's mmap bump pointer, syncing across sibling threads.
 pub fn set_current_thread_mmap_next(val: u32) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_SET_THREAD_MMAP);
@@ -189,7 +241,7 @@ pub fn set_thread_args(tid: u32, args: &str) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_SET_THREAD_ARGS);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         let bytes = args.as_bytes();
         let len = bytes.len().min(255);
         thread.args[..len].copy_from_slice(&bytes[..len]);
@@ -219,7 +271,7 @@ pub fn set_thread_cwd(tid: u32, cwd: &str) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_SET_THREAD_CWD);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         let bytes = cwd.as_bytes();
         let len = bytes.len().min(511);
         thread.cwd[..len].copy_from_slice(&bytes[..len]);
@@ -249,7 +301,7 @@ pub fn set_thread_stdout_pipe(tid: u32, pipe_id: u32) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_SET_THREAD_PIPE);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.stdout_pipe = pipe_id;
     }
 }
@@ -272,7 +324,7 @@ pub fn set_thread_stdin_pipe(tid: u32, pipe_id: u32) {
     crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_SET_THREAD_PIPE);
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
-    if let Some(thread) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(thread) = sched.thread_mut(tid) {
         thread.stdin_pipe = pipe_id;
     }
 }
@@ -0,0 +1,74 @@
+//! TID → `Scheduler::threads` slot lookup as a two-level radix table.
+//!
+//! TIDs are allocated monotonically, so live TIDs cluster in a few leaves
+//! near the top of the range.  A leaf covers 1024 consecutive TIDs and is
+//! allocated on first insert and freed when its last TID is removed; the
+//! top level costs one pointer per 1024 TIDs ever handed out.  Lookup,
+//! insert and remove are O(1).
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+
+/// TIDs per leaf (log2).
+const LEAF_BITS: u32 = 10;
+/// TIDs per leaf.
+const LEAF_SIZE: usize = 1 << LEAF_BITS;
+
+/// Slot value meaning "no thread" (real indices are stored +1).
+const EMPTY: u32 = 0;
+
+pub(super) struct TidTable {
+    /// Leaf `i` maps TIDs `i*LEAF_SIZE ..< (i+1)*LEAF_SIZE` to `index + 1`.
+    leaves: Vec<Option<Box<[u32; LEAF_SIZE]>>>,
+    /// Occupied slots per leaf, so empty leaves can be released.
+    used: Vec<u16>,
+}
+
+impl TidTable {
+    pub(super) const fn new() -> Self {
+        TidTable { leaves: Vec::new(), used: Vec::new() }
+    }
+
+    #[inline]
+    fn split(tid: u32) -> (usize, usize) {
+        ((tid >> LEAF_BITS) as usize, tid as usize & (LEAF_SIZE - 1))
+    }
+
+    /// Slot index of `tid` in the threads Vec, if present.
+    #[inline]
+    pub(super) fn get(&self, tid: u32) -> Option<usize> {
+        let (hi, lo) = Self::split(tid);
+        match self.leaves.get(hi) {
+            Some(Some(leaf)) if leaf[lo] != EMPTY => Some(leaf[lo] as usize - 1),
+            _ => None,
+        }
+    }
+
+    /// Record (or update) the slot index of `tid`.
+    pub(super) fn insert(&mut self, tid: u32, idx: usize) {
+        let (hi, lo) = Self::split(tid);
+        if hi >= self.leaves.len() {
+            self.leaves.resize_with(hi + 1, || None);
+            self.used.resize(hi + 1, 0);
+        }
+        let leaf = self.leaves[hi].get_or_insert_with(|| Box::new([EMPTY; LEAF_SIZE]));
+        if leaf[lo] == EMPTY {
+            self.used[hi] += 1;
+        }
+        leaf[lo] = idx as u32 + 1;
+    }
+
+    /// Forget `tid`. Frees its leaf when that was the last entry in it.
+    pub(super) fn remove(&mut self, tid: u32) {
+        let (hi, lo) = Self::split(tid);
+        if let Some(Some(leaf)) = self.leaves.get_mut(hi) {
+            if leaf[lo] != EMPTY {
+                leaf[lo] = EMPTY;
+                self.used[hi] -= 1;
+                if self.used[hi] == 0 {
+                    self.leaves[hi] = None;
+                }
+            }
+        }
+    }
+}
@@ -1,4 +1,5 @@
-//! Waiting / sleeping: waitpid, sleep_until, block_current_thread.
+//! Waiting / sleeping: waitpid, sleep_until, block_current_thread,
+//! prepare_block_current.
 
 use super::{get_cpu_id, SCHEDULER, schedule};
 use crate::task::thread::ThreadState;
@@ -10,7 +11,7 @@ pub fn waitpid(tid: u32) -> u32 {
         let mut guard = SCHEDULER.lock();
         let cpu_id = get_cpu_id();
         let sched = guard.as_mut().expect("Scheduler not initialized");
-        if let Some(target) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+        if let Some(target) = sched.thread_mut(tid) {
             if target.state == ThreadState::Terminated {
                 let code = target.exit_code.unwrap_or(0);
                 target.exit_code = None;
@@ -18,7 +19,7 @@ pub fn waitpid(tid: u32) -> u32 {
             }
         } else { return u32::MAX; }
         if let Some(current_tid) = sched.per_cpu[cpu_id].current_tid {
-            if let Some(target) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+            if let Some(target) = sched.thread_mut(tid) {
                 target.waiting_tid = Some(current_tid);
             }
             if let Some(idx) = sched.current_idx(cpu_id) {
@@ -39,7 +40,7 @@ pub fn waitpid(tid: u32) -> u32 {
             crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_WAITPID);
             let mut guard = SCHEDULER.lock();
             if let Some(sched) = guard.as_mut() {
-                if let Some(target) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+                if let Some(target) = sched.thread_mut(tid) {
                     if target.state == ThreadState::Terminated {
                         let code = target.exit_code.unwrap_or(0);
                         target.exit_code = None;
@@ -159,7 +160,7 @@ pub fn try_waitpid(tid: u32) -> u32 {
     let mut guard = SCHEDULER.lock();
     let sched = guard.as_mut().expect("Scheduler not initialized");
     let caller_tid = sched.per_cpu[get_cpu_id()].current_tid.unwrap_or(0);
-    if let Some(target) = sched.threads.iter_mut().find(|t| t.tid == tid) {
+    if let Some(target) = sched.thread_mut(tid) {
         if target.state == ThreadState::Terminated {
             let code = target.exit_code.unwrap_or(0);
             target.exit_code = None;
@@ -187,6 +188,35 @@ pub fn sleep_until(wake_at: u32) {
             sched.threads[idx].context.save_complete = 0;
             sched.threads[idx].wake_at_tick = Some(wake_at);
             sched.threads[idx].state = ThreadState::Blocked;
+            let tid = sched.threads[idx].tid;
+            sched.add_sleeper(tid, wake_at);
+        }
+    }
+    schedule();
+}
+
+/// Block the current thread for `ns` nanoseconds.
+///
+/// The deadline goes into the timer heap at full resolution; on x86 the
+/// one-shot LAPIC timer fires for it between scheduler ticks.
+pub fn sleep_ns(ns: u64) {
+    let deadline = crate::arch::hal::monotonic_ns().saturating_add(ns);
+    // Tick the deadline falls in: tags the heap entry, like `sleep_until`.
+    let hz = crate::arch::hal::timer_frequency_hz();
+    let ticks = (ns as u128 * hz as u128).div_ceil(1_000_000_000).min(0x7FFF_FFFF) as u32;
+    let tag = crate::arch::hal::timer_current_ticks().wrapping_add(ticks);
+    {
+        crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_SLEEP_UNTIL);
+        let mut guard = SCHEDULER.lock();
+        let cpu_id = get_cpu_id();
+        let sched = guard.as_mut().expect("Scheduler not initialized");
+        if let Some(idx) = sched.current_idx(cpu_id) {
+            // CRITICAL: Mark context as unsaved before Blocked (same race as waitpid).
+            sched.threads[idx].context.save_complete = 0;
+            sched.threads[idx].wake_at_tick = Some(tag);
+            sched.threads[idx].state = ThreadState::Blocked;
+            let tid = sched.threads[idx].tid;
+            sched.add_sleeper_ns(tid, deadline, tag);
         }
     }
     schedule();
@@ -207,3 +237,27 @@ pub fn block_current_thread() {
     }
     schedule();
 }
+
+/// Mark the current thread Blocked without yielding; the caller must call
+/// [`schedule`] next.  `wake_at` optionally adds a PIT-tick deadline.
+///
+/// Lets a caller publish itself on a wait list and block while still holding
+/// that list's lock (lock order: wait list → SCHEDULER), so a waker that takes
+/// the list lock afterwards always finds the thread Blocked and the wake-up
+/// cannot be lost.
+pub fn prepare_block_current(wake_at: Option<u32>) {
+    crate::sched_diag::set(get_cpu_id(), crate::sched_diag::PHASE_BLOCK_CURRENT);
+    let mut guard = SCHEDULER.lock();
+    let cpu_id = get_cpu_id();
+    let sched = guard.as_mut().expect("Scheduler not initialized");
+    if let Some(idx) = sched.current_idx(cpu_id) {
+        // CRITICAL: Mark context as unsaved before Blocked (same race as waitpid).
+        sched.threads[idx].context.save_complete = 0;
+        sched.threads[idx].wake_at_tick = wake_at;
+        sched.threads[idx].state = ThreadState::Blocked;
+        if let Some(wake_at) = wake_at {
+            let tid = sched.threads[idx].tid;
+            sched.add_sleeper(tid, wake_at);
+        }
+    }
+}
@@ -161,6 +161,8 @@ pub struct Thread {
     pub wake_at_tick: Option<u32>,
     /// PIT tick at which this thread was terminated (for auto-reap grace period).
     pub terminated_at_tick: Option<u32>,
+    /// Timer tick at which this thread was created or last exec'd (launch-time metric).
+    pub spawn_tick: u32,
     /// True if this thread shares its page directory with another thread (intra-process child).
     /// When true, sys_exit must NOT destroy the page directory.
     pub pd_shared: bool,
@@ -170,8 +172,11 @@ pub struct Thread {
     pub last_cpu: usize,
     /// Stable CPU affinity — set at spawn to `least_loaded_cpu()`.
     /// Wake-ups always target this CPU.  Only changed by the periodic
-    /// load rebalancer when this CPU is genuinely overloaded.
+    /// load rebalancer when this CPU is genuinely overloaded, and by
+    /// idle-time work stealing when another CPU takes the thread.
     pub affinity_cpu: usize,
+    /// Tick at which this thread last left a CPU (cache-hotness for work stealing).
+    pub last_run_tick: u32,
     /// True for per-CPU idle threads (never reaped, never killed, never enqueued).
     pub is_idle: bool,
     /// True for critical system threads (compositor) that must not be killed by RSP recovery.
@@ -183,6 +188,10 @@ pub struct Thread {
     /// Number of user-space pages mapped for this process (heap, stack, code).
     /// Excludes identity-mapped kernel pages and shared DLL pages.
     pub user_pages: u32,
+    /// Last heap usage record pushed by the process allocator via
+    /// SYS_HEAP_REPORT: [heap_bytes, in_use, free, largest_free,
+    /// free_blocks, mapped].  All zero until the first report.
+    pub heap_stats: [u32; HEAP_STATS_WORDS],
     /// Next virtual address for mmap allocations (bump pointer in the mmap region).
     /// Starts at MMAP_BASE (0x20000000) and grows upward.
     pub mmap_next: u32,
@@ -230,6 +239,9 @@ const KERNEL_STACK_SIZE: usize = 512 * 1024; // 512 KiB per thread
 /// Written at `ptr + PAGE_SIZE`; if overwritten, the stack has grown into the guard zone.
 pub const STACK_CANARY: u64 = 0xDEAD_BEEF_CAFE_BABE;
 
+/// Number of u32 words in a SYS_HEAP_REPORT record.
+pub const HEAP_STATS_WORDS: usize = 6;
+
 impl Thread {
     /// Create a new kernel thread that will begin executing at `entry`.
     ///
@@ -296,9 +308,7 @@ impl Thread {
             // PSTATE: 0x0 for EL0 (no DAIF mask bits set — interrupts enabled)
             context.set_flags(0x0);
             // Use the current page table base (kernel TTBR0_EL1)
-            let ttbr0: u64;
-            unsafe { core::arch::asm!("mrs {}, ttbr0_el1", out(reg) ttbr0, options(nomem, nostack)); }
-            context.set_page_table(ttbr0);
+            context.set_page_table(crate::arch::hal::current_page_table());
         }
         // Recompute checksum after modifying fields above
         context.checksum = context.compute_checksum();
@@ -329,15 +339,18 @@ impl Thread {
             fpu_state: FxState::new_default(),
             wake_at_tick: None,
             terminated_at_tick: None,
+            spawn_tick: crate::arch::hal::timer_current_ticks(),
             pd_shared: false,
             pcid: 0,
             last_cpu: 0,
             affinity_cpu: 0,
+            last_run_tick: 0,
             is_idle: false,
             critical: false,
             io_read_bytes: 0,
             io_write_bytes: 0,
             user_pages: 0,
+            heap_stats: [0; HEAP_STATS_WORDS],
             mmap_next: 0x7000_0000,
             cwd: {
                 let mut c = [0u8; 512];
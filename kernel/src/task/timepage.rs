@@ -0,0 +1,103 @@
+//! Shared time page: clock reads from user space without a syscall.
+//!
+//! One read-only page at [`TIME_PAGE_ADDR`] (the last page of the DLIB
+//! region) is mapped into every process alongside the DLIBs.  It carries the
+//! TSC calibration from `pit.rs` and the wall-clock time at boot, so
+//! `anyos_std::sys` and libc64 `clock_gettime` turn a `rdtsc` into uptime and
+//! real time directly.
+//!
+//! Readers use the seqlock in [`TimePage::seq`]: read `seq`, retry while it
+//! is odd, read the fields, and retry if `seq` has changed.  A zero
+//! `tsc_hz` means the TSC is not the timebase and readers must fall back to
+//! `SYS_UPTIME_MS` / `SYS_TIME`.
+
+use crate::memory::address::{PhysAddr, VirtAddr};
+use crate::memory::{physical, virtual_mem};
+use core::sync::atomic::{fence, AtomicU64, Ordering};
+
+/// User virtual address of the time page in every process.
+pub const TIME_PAGE_ADDR: u64 = 0x07FF_F000;
+
+/// Layout version published in [`TimePage::version`].
+pub const TIME_PAGE_VERSION: u32 = 1;
+
+/// Kernel alias of the page, the only writable mapping.
+const TIME_PAGE_KVA: u64 = 0xFFFF_FFFF_BFF0_7000;
+
+const PAGE_USER: u64 = 0x04;
+const PAGE_WRITABLE: u64 = 0x02;
+
+/// Layout of the time page (mirrored in `anyos_std::sys` and libc64 `time.c`).
+#[repr(C)]
+struct TimePage {
+    /// Seqlock counter, odd while the kernel is rewriting the page.
+    seq: u32,
+    /// [`TIME_PAGE_VERSION`].
+    version: u32,
+    /// TSC frequency in Hz (0 = TSC not calibrated, use syscalls).
+    tsc_hz: u64,
+    /// TSC value at uptime 0, the epoch of `SYS_UPTIME` and `SYS_UPTIME_MS`.
+    tsc_boot: u64,
+    /// Unix time in nanoseconds at uptime 0 (0 = wall clock unknown).
+    realtime_offset_ns: u64,
+    /// `SYS_UPTIME` tick rate in Hz.
+    tick_hz: u32,
+}
+
+/// Physical frame of the time page (0 = not yet allocated).
+static TIME_FRAME: AtomicU64 = AtomicU64::new(0);
+
+/// Allocate the time page and publish the current calibration.  Must run
+/// after TSC calibration and RTC init, before the first user process.
+pub fn init() {
+    let frame = physical::alloc_frame().expect("OOM allocating time page");
+    virtual_mem::map_page(VirtAddr::new(TIME_PAGE_KVA), frame, PAGE_WRITABLE);
+    unsafe {
+        core::ptr::write_bytes(TIME_PAGE_KVA as *mut u8, 0, 4096);
+    }
+
+    let tsc_hz = crate::arch::x86::pit::tsc_hz();
+    let tsc_boot = crate::arch::x86::pit::tsc_boot();
+    let realtime_offset_ns = crate::drivers::rtc::unix_time()
+        .saturating_mul(1_000_000_000)
+        .saturating_sub(crate::arch::x86::pit::monotonic_ns());
+    publish(tsc_hz, tsc_boot, realtime_offset_ns);
+
+    TIME_FRAME.store(frame.as_u64(), Ordering::Release);
+    crate::serial_println!(
+        "[OK] Time page at {:#010x} (TSC {} MHz)",
+        TIME_PAGE_ADDR,
+        tsc_hz / 1_000_000,
+    );
+}
+
+/// Rewrite the page under the seqlock.  The kernel is the single writer.
+fn publish(tsc_hz: u64, tsc_boot: u64, realtime_offset_ns: u64) {
+    let page = TIME_PAGE_KVA as *mut TimePage;
+    unsafe {
+        let seq = core::ptr::addr_of!((*page).seq).read_volatile();
+        core::ptr::addr_of_mut!((*page).seq).write_volatile(seq.wrapping_add(1));
+        fence(Ordering::Release);
+        core::ptr::addr_of_mut!((*page).version).write_volatile(TIME_PAGE_VERSION);
+        core::ptr::addr_of_mut!((*page).tsc_hz).write_volatile(tsc_hz);
+        core::ptr::addr_of_mut!((*page).tsc_boot).write_volatile(tsc_boot);
+        core::ptr::addr_of_mut!((*page).realtime_offset_ns).write_volatile(realtime_offset_ns);
+        core::ptr::addr_of_mut!((*page).tick_hz).write_volatile(crate::arch::x86::pit::TICK_HZ);
+        fence(Ordering::Release);
+        core::ptr::addr_of_mut!((*page).seq).write_volatile(seq.wrapping_add(2));
+    }
+}
+
+/// Map the time page read-only into a process page directory.
+pub fn map_into(pd_phys: PhysAddr) {
+    let frame = TIME_FRAME.load(Ordering::Acquire);
+    if frame == 0 {
+        return;
+    }
+    virtual_mem::map_page_in_pd(
+        pd_phys,
+        VirtAddr::new(TIME_PAGE_ADDR),
+        PhysAddr::new(frame),
+        PAGE_USER | virtual_mem::page_nx_flag(),
+    );
+}
@@ -0,0 +1,212 @@
+//! Static kernel tracepoints.
+//!
+//! Fixed points in the scheduler, interrupt and syscall paths, the page
+//! fault handler, the block layer and TCP call [`emit`] with an event number
+//! and two arguments.  While the event is enabled, the call appends a
+//! 32-byte [`TraceRecord`] stamped with the cycle counter to the current
+//! CPU's ring; otherwise it costs one relaxed load and a branch.
+//!
+//! Events are switched on and off at run time with a bit mask
+//! (`SYS_TRACE_CTL`); the per-CPU rings are allocated the first time any
+//! event is enabled and never freed.  `SYS_TRACE_READ` drains them.
+//!
+//! Each ring has a single producer, its own CPU, which writes with
+//! interrupts disabled so a nested tracepoint (an IRQ during a syscall
+//! entry) cannot interleave with it; tracepoints are not called from NMI
+//! context.  The consumer is serialized by [`DRAIN`].  A full ring drops
+//! new records and counts them in `lost`.
+//!
+//! Events and their arguments (mirrored in `anyos_std::debug`):
+//!
+//! | Event | `arg0` | `arg1` |
+//! |-------|--------|--------|
+//! | [`SCHED_SWITCH`] | outgoing TID | incoming TID |
+//! | [`SCHED_WAKEUP`] | woken TID | CPU it is queued on |
+//! | [`IRQ_ENTRY`] / [`IRQ_EXIT`] | IRQ | 0 |
+//! | [`SYSCALL_ENTRY`] | syscall number | first argument |
+//! | [`SYSCALL_EXIT`] | syscall number | return value |
+//! | [`PAGE_FAULT`] | faulting address | error code |
+//! | [`BLOCK_SUBMIT`] | `disk << 56 \| lba` | sectors, bit 32 = write |
+//! | [`BLOCK_COMPLETE`] | `disk << 56 \| lba` | sectors, bit 32 = write, bit 33 = failed |
+//! | [`TCP_SEND`] / [`TCP_RECV`] | `local port << 48 \| remote port << 32 \| seq` | payload bytes, TCP flags << 32 |
+//!
+//! Timestamps of different CPUs are comparable on CPUs with an invariant,
+//! synchronized cycle counter.  An IRQ whose handler switches threads
+//! (the timer tick) records its exit only when the interrupted thread runs
+//! again.
+
+use crate::arch::hal::MAX_CPUS;
+use crate::sync::spinlock::Spinlock;
+use alloc::boxed::Box;
+use core::cell::UnsafeCell;
+use core::sync::atomic::{AtomicPtr, AtomicU32, Ordering};
+
+pub const SCHED_SWITCH: u16 = 0;
+pub const SCHED_WAKEUP: u16 = 1;
+pub const IRQ_ENTRY: u16 = 2;
+pub const IRQ_EXIT: u16 = 3;
+pub const SYSCALL_ENTRY: u16 = 4;
+pub const SYSCALL_EXIT: u16 = 5;
+pub const PAGE_FAULT: u16 = 6;
+pub const BLOCK_SUBMIT: u16 = 7;
+pub const BLOCK_COMPLETE: u16 = 8;
+pub const TCP_SEND: u16 = 9;
+pub const TCP_RECV: u16 = 10;
+/// Number of events; valid mask bits are `(1 << EVENT_COUNT) - 1`.
+pub const EVENT_COUNT: u16 = 11;
+
+/// Records per CPU ring (256 KiB).
+pub const CAPACITY: u32 = 8192;
+
+/// One event (32 bytes, must match `anyos_std::debug::TraceEvent`).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct TraceRecord {
+    /// Cycle counter when the event fired.
+    pub tsc: u64,
+    /// Thread current on the CPU (for `SCHED_SWITCH` see the arguments).
+    pub tid: u32,
+    pub cpu: u16,
+    pub event: u16,
+    pub arg0: u64,
+    pub arg1: u64,
+}
+
+struct Ring {
+    /// Next record the consumer reads.
+    head: AtomicU32,
+    /// Next record the producer writes.
+    tail: AtomicU32,
+    /// Records dropped because the ring was full.
+    lost: AtomicU32,
+    records: UnsafeCell<[TraceRecord; CAPACITY as usize]>,
+}
+
+impl Ring {
+    fn slot(&self, index: u32) -> *mut TraceRecord {
+        unsafe { (self.records.get() as *mut TraceRecord).add((index % CAPACITY) as usize) }
+    }
+}
+
+/// Enabled events, one bit per event number.
+static MASK: AtomicU32 = AtomicU32::new(0);
+
+static RINGS: [AtomicPtr<Ring>; MAX_CPUS] = {
+    const INIT: AtomicPtr<Ring> = AtomicPtr::new(core::ptr::null_mut());
+    [INIT; MAX_CPUS]
+};
+
+/// Serializes consumers (drain, reset).
+static DRAIN: Spinlock<()> = Spinlock::new(());
+
+/// Record `event` if it is enabled.
+#[inline(always)]
+pub fn emit(event: u16, arg0: u64, arg1: u64) {
+    if MASK.load(Ordering::Relaxed) & (1 << event) != 0 {
+        record(event, arg0, arg1);
+    }
+}
+
+#[cold]
+#[inline(never)]
+fn record(event: u16, arg0: u64, arg1: u64) {
+    let flags = crate::arch::hal::save_and_disable_interrupts();
+    let cpu = crate::arch::hal::cpu_id();
+    if cpu < MAX_CPUS {
+        let ring = RINGS[cpu].load(Ordering::Acquire);
+        if !ring.is_null() {
+            // SAFETY: rings are never freed once published, and only this
+            // CPU writes records (with interrupts off).
+            let ring = unsafe { &*ring };
+            let tail = ring.tail.load(Ordering::Relaxed);
+            if tail.wrapping_sub(ring.head.load(Ordering::Acquire)) >= CAPACITY {
+                ring.lost.fetch_add(1, Ordering::Relaxed);
+            } else {
+                let rec = TraceRecord {
+                    tsc: crate::arch::hal::cycle_counter(),
+                    tid: crate::task::scheduler::per_cpu_current_tid(cpu),
+                    cpu: cpu as u16,
+                    event,
+                    arg0,
+                    arg1,
+                };
+                unsafe { core::ptr::write_volatile(ring.slot(tail), rec) };
+                ring.tail.store(tail.wrapping_add(1), Ordering::Release);
+            }
+        }
+    }
+    crate::arch::hal::restore_interrupt_state(flags);
+}
+
+/// Currently enabled events.
+pub fn mask() -> u32 {
+    MASK.load(Ordering::Relaxed)
+}
+
+/// Enable exactly the events in `mask` (0 = tracing off).  Allocates the
+/// rings on first use, so call with no spinlock held.
+pub fn set_mask(mask: u32) {
+    let mask = mask & ((1 << EVENT_COUNT) - 1);
+    if mask != 0 {
+        let cpus = crate::arch::hal::cpu_count().clamp(1, MAX_CPUS);
+        for slot in RINGS[..cpus].iter() {
+            if !slot.load(Ordering::Acquire).is_null() {
+                continue;
+            }
+            // SAFETY: all-zero is a valid `Ring` (atomics and plain data).
+            let fresh: Box<Ring> = unsafe { Box::new_zeroed().assume_init() };
+            let ptr = Box::into_raw(fresh);
+            if slot
+                .compare_exchange(core::ptr::null_mut(), ptr, Ordering::AcqRel, Ordering::Acquire)
+                .is_err()
+            {
+                drop(unsafe { Box::from_raw(ptr) });
+            }
+        }
+    }
+    MASK.store(mask, Ordering::Release);
+}
+
+/// Discard every pending record and the lost counts.
+pub fn reset() {
+    let _guard = DRAIN.lock();
+    for slot in RINGS.iter() {
+        let ring = slot.load(Ordering::Acquire);
+        if ring.is_null() {
+            continue;
+        }
+        let ring = unsafe { &*ring };
+        ring.head.store(ring.tail.load(Ordering::Acquire), Ordering::Release);
+        ring.lost.store(0, Ordering::Relaxed);
+    }
+}
+
+/// CPUs with a ring.
+pub fn ring_count() -> usize {
+    RINGS.iter().filter(|r| !r.load(Ordering::Acquire).is_null()).count()
+}
+
+/// Move pending records into `out`, CPU by CPU (each CPU's records in
+/// order).  Returns `(records written, records lost since the last drain)`.
+pub fn drain(out: &mut [TraceRecord]) -> (usize, u32) {
+    let _guard = DRAIN.lock();
+    let mut n = 0;
+    let mut lost = 0u32;
+    for slot in RINGS.iter() {
+        let ring = slot.load(Ordering::Acquire);
+        if ring.is_null() {
+            continue;
+        }
+        let ring = unsafe { &*ring };
+        lost = lost.saturating_add(ring.lost.swap(0, Ordering::Relaxed));
+        let mut head = ring.head.load(Ordering::Relaxed);
+        let tail = ring.tail.load(Ordering::Acquire);
+        while head != tail && n < out.len() {
+            out[n] = unsafe { core::ptr::read_volatile(ring.slot(head)) };
+            head = head.wrapping_add(1);
+            n += 1;
+        }
+        ring.head.store(head, Ordering::Release);
+    }
+    (n, lost)
+}
@@ -1,8 +1,13 @@
 //! Minimal user-space dynamic linker for anyOS.
 //!
 //! Provides `dl_open()` and `dl_sym()` for loading ELF64 ET_DYN shared objects
-//! linked by anyld. Symbol lookup uses the ELF hash table directly from mapped
-//! memory — no kernel syscall needed beyond the initial `SYS_DLL_LOAD`.
+//! linked by anyld. Symbol lookup uses the GNU hash table (`DT_GNU_HASH`, with
+//! its Bloom filter rejecting most misses) directly from mapped memory, or the
+//! SysV ELF hash table for objects linked before anyld emitted one — no kernel
+//! syscall needed beyond the initial `SYS_DLL_LOAD`.
+//!
+//! [`LazySym`] defers a lookup to the first call, so clients with large
+//! function tables do not pay for symbols they never use.
 //!
 //! # Usage
 //! ```no_run
@@ -17,8 +22,26 @@
 
 mod elf;
 
+use core::marker::PhantomData;
+use core::sync::atomic::{AtomicUsize, Ordering};
 use elf::{Elf64Dyn, Elf64Ehdr, Elf64Phdr, Elf64Sym};
 
+const DT_GNU_HASH: i64 = 0x6FFF_FEF5;
+
+/// GNU hash table in mapped memory.
+struct GnuHash {
+    nbuckets: u32,
+    /// Index of the first hashed .dynsym entry.
+    symoffset: u32,
+    /// Bloom filter size in 64-bit words (a power of two).
+    bloom_size: u32,
+    bloom_shift: u32,
+    bloom: *const u64,
+    buckets: *const u32,
+    /// One hash per symbol from `symoffset` on; bit 0 ends a bucket's run.
+    chain: *const u32,
+}
+
 /// Handle to a loaded shared library.
 pub struct DlHandle {
     /// Base virtual address where the .so is mapped.
@@ -27,11 +50,13 @@ pub struct DlHandle {
     symtab: *const Elf64Sym,
     /// Pointer to .dynstr in mapped memory.
     strtab: *const u8,
+    /// GNU hash table, used when present.
+    gnu: Option<GnuHash>,
     /// Pointer to ELF hash table buckets (after the [nbuckets, nchain] header).
     buckets: *const u32,
     /// Pointer to ELF hash table chains.
     chains: *const u32,
-    /// Number of hash buckets.
+    /// Number of hash buckets (0 = no SysV hash table).
     nbuckets: u32,
 }
 
@@ -101,10 +126,11 @@ pub fn dl_open(path: &str) -> Option<DlHandle> {
     };
     dynamic_va += load_bias;
 
-    // Walk .dynamic entries to find DT_SYMTAB, DT_STRTAB, DT_HASH
+    // Walk .dynamic entries to find DT_SYMTAB, DT_STRTAB, DT_HASH, DT_GNU_HASH
     let mut symtab_va: u64 = 0;
     let mut strtab_va: u64 = 0;
     let mut hash_va: u64 = 0;
+    let mut gnu_hash_va: u64 = 0;
 
     let dyn_ptr = dynamic_va as *const Elf64Dyn;
     for i in 0..128 {
@@ -113,26 +139,57 @@ pub fn dl_open(path: &str) -> Option<DlHandle> {
             6 => symtab_va = d.d_val,  // DT_SYMTAB
             5 => strtab_va = d.d_val,  // DT_STRTAB
             4 => hash_va = d.d_val,    // DT_HASH
+            DT_GNU_HASH => gnu_hash_va = d.d_val,
             0 => break,                // DT_NULL
             _ => {}
         }
     }
 
-    if symtab_va == 0 || strtab_va == 0 || hash_va == 0 {
+    if symtab_va == 0 || strtab_va == 0 || (hash_va == 0 && gnu_hash_va == 0) {
+        return None;
+    }
+
+    // GNU hash header: [nbuckets, symoffset, bloom_size, bloom_shift: u32],
+    // then bloom[bloom_size]: u64, buckets[nbuckets]: u32, chain[]: u32
+    let gnu = if gnu_hash_va != 0 {
+        let hdr = gnu_hash_va as *const u32;
+        unsafe {
+            let nbuckets = *hdr;
+            let bloom_size = *hdr.add(2);
+            let bloom = hdr.add(4) as *const u64;
+            let buckets = bloom.add(bloom_size as usize) as *const u32;
+            Some(GnuHash {
+                nbuckets,
+                symoffset: *hdr.add(1),
+                bloom_size,
+                bloom_shift: *hdr.add(3),
+                bloom,
+                buckets,
+                chain: buckets.add(nbuckets as usize),
+            })
+        }
+    } else {
+        None
+    };
+    if matches!(gnu, Some(ref g) if g.nbuckets == 0 || g.bloom_size == 0) {
         return None;
     }
 
     // Parse hash table header: [nbuckets: u32, nchain: u32]
-    let hash_ptr = hash_va as *const u32;
-    let nbuckets = unsafe { *hash_ptr };
-    let _nchain = unsafe { *hash_ptr.add(1) };
-    let buckets = unsafe { hash_ptr.add(2) };
-    let chains = unsafe { buckets.add(nbuckets as usize) };
+    let (nbuckets, buckets, chains) = if hash_va != 0 {
+        let hash_ptr = hash_va as *const u32;
+        let nbuckets = unsafe { *hash_ptr };
+        let buckets = unsafe { hash_ptr.add(2) };
+        (nbuckets, buckets, unsafe { buckets.add(nbuckets as usize) })
+    } else {
+        (0, core::ptr::null(), core::ptr::null())
+    };
 
     Some(DlHandle {
         base,
         symtab: symtab_va as *const Elf64Sym,
         strtab: strtab_va as *const u8,
+        gnu,
         buckets,
         chains,
         nbuckets,
@@ -144,6 +201,12 @@ pub fn dl_open(path: &str) -> Option<DlHandle> {
 /// Returns the symbol's virtual address as a raw pointer, or `None` if not found.
 /// The caller must cast to the appropriate function pointer type.
 pub fn dl_sym(handle: &DlHandle, name: &str) -> Option<*const ()> {
+    if let Some(ref gnu) = handle.gnu {
+        return unsafe { gnu_lookup(handle, gnu, name.as_bytes()) };
+    }
+    if handle.nbuckets == 0 {
+        return None;
+    }
     let h = elf_hash(name.as_bytes());
     let bucket_idx = h % handle.nbuckets;
 
@@ -162,6 +225,45 @@ pub fn dl_sym(handle: &DlHandle, name: &str) -> Option<*const ()> {
     None
 }
 
+/// Look `name` up in the GNU hash table of `handle`.
+unsafe fn gnu_lookup(handle: &DlHandle, gnu: &GnuHash, name: &[u8]) -> Option<*const ()> {
+    let h = gnu_hash(name);
+
+    // Bloom filter: both bits must be set for the name to possibly exist
+    let word = unsafe { *gnu.bloom.add(((h / 64) % gnu.bloom_size) as usize) };
+    let mask = (1u64 << (h % 64)) | (1u64 << ((h >> gnu.bloom_shift) % 64));
+    if word & mask != mask {
+        return None;
+    }
+
+    let mut idx = unsafe { *gnu.buckets.add((h % gnu.nbuckets) as usize) };
+    if idx < gnu.symoffset {
+        return None; // Empty bucket
+    }
+    loop {
+        let chain_hash = unsafe { *gnu.chain.add((idx - gnu.symoffset) as usize) };
+        if (chain_hash | 1) == (h | 1) {
+            let sym = unsafe { &*handle.symtab.add(idx as usize) };
+            if sym.st_value != 0 && unsafe { cstr_eq(handle.strtab.add(sym.st_name as usize), name) } {
+                return Some(sym.st_value as *const ());
+            }
+        }
+        if chain_hash & 1 != 0 {
+            return None; // End of this bucket's run
+        }
+        idx += 1;
+    }
+}
+
+/// GNU hash function (DJB: `h * 33 + c`).
+fn gnu_hash(name: &[u8]) -> u32 {
+    let mut h: u32 = 5381;
+    for &b in name {
+        h = (h << 5).wrapping_add(h).wrapping_add(b as u32);
+    }
+    h
+}
+
 /// ELF hash function (SysV ABI).
 fn elf_hash(name: &[u8]) -> u32 {
     let mut h: u32 = 0;
@@ -187,3 +289,54 @@ unsafe fn cstr_eq(cstr: *const u8, name: &[u8]) -> bool {
     // Check that the C string is also terminated here
     unsafe { *cstr.add(name.len()) == 0 }
 }
+
+/// A function or data symbol bound on first use (lazy binding).
+///
+/// anyld objects export plain symbols and clients keep tables of function
+/// pointers; a `LazySym` field in such a table resolves its symbol the first
+/// time it is dereferenced and caches the address, so
+/// `(table.field)(args)` works unchanged.  `F` must be pointer-sized (a
+/// function pointer type).  A missing symbol panics on first use.
+pub struct LazySym<F: Copy> {
+    lib: &'static DlHandle,
+    name: &'static str,
+    addr: AtomicUsize,
+    _f: PhantomData<F>,
+}
+
+impl<F: Copy> LazySym<F> {
+    pub const fn new(lib: &'static DlHandle, name: &'static str) -> Self {
+        assert!(core::mem::size_of::<F>() == core::mem::size_of::<usize>());
+        LazySym { lib, name, addr: AtomicUsize::new(0), _f: PhantomData }
+    }
+
+    /// The bound symbol, resolving it if this is the first use.
+    #[inline]
+    pub fn get(&self) -> F {
+        *core::ops::Deref::deref(self)
+    }
+
+    #[cold]
+    fn bind(&self) -> usize {
+        let addr = match dl_sym(self.lib, self.name) {
+            Some(p) => p as usize,
+            None => panic!("dynlink: symbol '{}' not found", self.name),
+        };
+        self.addr.store(addr, Ordering::Release);
+        addr
+    }
+}
+
+impl<F: Copy> core::ops::Deref for LazySym<F> {
+    type Target = F;
+
+    #[inline]
+    fn deref(&self) -> &F {
+        if self.addr.load(Ordering::Acquire) == 0 {
+            self.bind();
+        }
+        // SAFETY: `addr` holds a resolved, non-zero address and `F` is a
+        // pointer-sized function pointer type (checked in `new`).
+        unsafe { &*(&self.addr as *const AtomicUsize as *const F) }
+    }
+}
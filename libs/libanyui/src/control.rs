@@ -42,9 +42,11 @@ pub const EVENT_MOUSE_DOWN: u32 = 14;
 pub const EVENT_MOUSE_UP: u32 = 15;
 pub const EVENT_MOUSE_MOVE: u32 = 16;
 pub const EVENT_SUBMIT: u32 = 17;
+/// A virtual DataGrid needs rows it does not hold (see `anyui_datagrid_get_data_request`).
+pub const EVENT_DATA_REQUEST: u32 = 18;
 
-/// Number of callback slots (EVENT_CLICK=1 .. EVENT_SUBMIT=17, index 0 unused).
-const NUM_CALLBACK_SLOTS: usize = 18;
+/// Number of callback slots (EVENT_CLICK=1 .. EVENT_DATA_REQUEST=18, index 0 unused).
+const NUM_CALLBACK_SLOTS: usize = 19;
 
 // ── Key codes (must match compositor's encode_scancode output) ───────
 
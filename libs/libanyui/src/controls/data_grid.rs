@@ -75,6 +75,91 @@ enum DragMode {
     Reordering { col_index: usize, drag_start_x: i32, current_x: i32 },
 }
 
+/// Rows per block of the virtual-mode row cache.
+const VIRTUAL_BLOCK_ROWS: usize = 64;
+
+/// A block of rows supplied by the data owner in virtual mode.
+struct RowBlock {
+    /// First row of the block (a multiple of `VIRTUAL_BLOCK_ROWS`).
+    first: usize,
+    /// Row text (cells separated by 0x1F); `None` until supplied.
+    rows: Vec<Option<Vec<u8>>>,
+    /// Per-cell text colors (row-major within the block, 0 = default).
+    /// Empty if the owner supplied none.
+    colors: Vec<u32>,
+}
+
+/// Virtual data source: the grid holds only the rows around the viewport
+/// and asks the owner (via `EVENT_DATA_REQUEST`) for the ones it lacks.
+/// The owner also sorts and filters; row indices are the owner's order.
+struct VirtualSource {
+    blocks: Vec<RowBlock>,
+    /// Row range of the outstanding request, cleared once it is all cached.
+    requested: Option<(usize, usize)>,
+}
+
+/// Set of rows stored as sorted, disjoint half-open ranges, so selecting
+/// a range of a million rows costs one entry.
+struct RowSet {
+    ranges: Vec<(usize, usize)>,
+}
+
+impl RowSet {
+    const fn new() -> Self {
+        Self { ranges: Vec::new() }
+    }
+
+    fn contains(&self, row: usize) -> bool {
+        let i = self.ranges.partition_point(|r| r.1 <= row);
+        i < self.ranges.len() && self.ranges[i].0 <= row
+    }
+
+    /// Add rows `lo..hi`, merging with touching ranges.
+    fn insert_range(&mut self, mut lo: usize, mut hi: usize) {
+        if lo >= hi { return; }
+        let start = self.ranges.partition_point(|r| r.1 < lo);
+        let mut end = start;
+        while end < self.ranges.len() && self.ranges[end].0 <= hi {
+            lo = lo.min(self.ranges[end].0);
+            hi = hi.max(self.ranges[end].1);
+            end += 1;
+        }
+        self.ranges.splice(start..end, core::iter::once((lo, hi)));
+    }
+
+    fn remove(&mut self, row: usize) {
+        let i = self.ranges.partition_point(|r| r.1 <= row);
+        if i >= self.ranges.len() || self.ranges[i].0 > row { return; }
+        let (lo, hi) = self.ranges[i];
+        if lo < row && row + 1 < hi {
+            self.ranges[i].1 = row;
+            self.ranges.insert(i + 1, (row + 1, hi));
+        } else if lo < row {
+            self.ranges[i].1 = row;
+        } else if row + 1 < hi {
+            self.ranges[i].0 = row + 1;
+        } else {
+            self.ranges.remove(i);
+        }
+    }
+
+    /// Drop every row >= `n`.
+    fn truncate(&mut self, n: usize) {
+        self.ranges.retain(|r| r.0 < n);
+        if let Some(last) = self.ranges.last_mut() {
+            last.1 = last.1.min(n);
+        }
+    }
+
+    fn first(&self) -> Option<usize> {
+        self.ranges.first().map(|r| r.0)
+    }
+
+    fn clear(&mut self) {
+        self.ranges.clear();
+    }
+}
+
 /// Connector line between rows (drawn in a specific column).
 pub struct ConnectorLine {
     pub start_row: usize,
@@ -103,7 +188,7 @@ pub struct DataGrid {
     pub(crate) scroll_y: i32,
     scroll_x: i32,
     selection_mode: SelectionMode,
-    selected_rows: Vec<u8>,
+    selected_rows: RowSet,
     anchor_row: Option<usize>,
     drag_mode: DragMode,
     hovered_row: Option<usize>,
@@ -118,6 +203,8 @@ pub struct DataGrid {
     connector_lines: Vec<ConnectorLine>,
     /// Column index (display) in which connector lines are drawn.
     connector_column: usize,
+    /// Virtual data source; `None` in the default (all cells held) mode.
+    virt: Option<VirtualSource>,
 }
 
 impl DataGrid {
@@ -139,7 +226,7 @@ impl DataGrid {
             scroll_y: 0,
             scroll_x: 0,
             selection_mode: SelectionMode::Single,
-            selected_rows: Vec::new(),
+            selected_rows: RowSet::new(),
             anchor_row: None,
             drag_mode: DragMode::None,
             hovered_row: None,
@@ -150,6 +237,7 @@ impl DataGrid {
             last_click_col: -1,
             connector_lines: Vec::new(),
             connector_column: 2,
+            virt: None,
         }
     }
 
@@ -196,6 +284,7 @@ impl DataGrid {
     // ── Cell data API ──────────────────────────────────────────────
 
     pub fn set_data_from_encoded(&mut self, data: &[u8]) {
+        if self.virt.is_some() { return; }
         self.cell_data.clear();
         self.row_count = 0;
         let col_count = self.columns.len().max(1);
@@ -212,12 +301,21 @@ impl DataGrid {
             self.row_count += 1;
         }
         self.clamp_scroll();
-        self.ensure_selection_bits();
+        self.selected_rows.truncate(self.row_count);
         self.rebuild_sort();
         self.base.mark_dirty();
     }
 
     pub fn set_row_count(&mut self, count: usize) {
+        if let Some(v) = self.virt.as_mut() {
+            v.blocks.retain(|b| b.first < count);
+            v.requested = None;
+            self.row_count = count;
+            self.clamp_scroll();
+            self.selected_rows.truncate(count);
+            self.base.mark_dirty();
+            return;
+        }
         let col_count = self.columns.len().max(1);
         if count > self.row_count {
             for _ in self.row_count * col_count..count * col_count {
@@ -228,7 +326,7 @@ impl DataGrid {
         }
         self.row_count = count;
         self.clamp_scroll();
-        self.ensure_selection_bits();
+        self.selected_rows.truncate(count);
         self.rebuild_sort();
         self.base.mark_dirty();
     }
@@ -246,6 +344,9 @@ impl DataGrid {
     }
 
     pub fn get_cell(&self, row: usize, col: usize) -> &[u8] {
+        if self.virt.is_some() {
+            return self.virtual_cell(row, col).0;
+        }
         let col_count = self.columns.len().max(1);
         let idx = row * col_count + col;
         self.cell_data.get(idx).map(|v| v.as_slice()).unwrap_or(&[])
@@ -315,10 +416,157 @@ impl DataGrid {
 
     /// Get the first selected row index, or None.
     pub fn selected_row(&self) -> Option<usize> {
-        for r in 0..self.row_count {
-            if self.is_row_selected(r) { return Some(r); }
+        self.selected_rows.first().filter(|&r| r < self.row_count)
+    }
+
+    // ── Virtual mode ───────────────────────────────────────────────
+
+    /// Switch between holding all cells (default) and virtual mode, where
+    /// only rows near the viewport are kept and the owner supplies them on
+    /// request. Either way the grid starts empty.
+    pub fn set_virtual(&mut self, enabled: bool) {
+        if enabled == self.virt.is_some() { return; }
+        self.virt = if enabled {
+            Some(VirtualSource { blocks: Vec::new(), requested: None })
+        } else {
+            None
+        };
+        self.cell_data = Vec::new();
+        self.cell_colors = Vec::new();
+        self.cell_bg_colors = Vec::new();
+        self.char_colors = Vec::new();
+        self.char_color_offsets = Vec::new();
+        self.cell_icons = Vec::new();
+        self.sorted_rows = Vec::new();
+        self.row_count = 0;
+        self.scroll_y = 0;
+        self.selected_rows.clear();
+        self.base.mark_dirty();
+    }
+
+    pub fn is_virtual(&self) -> bool { self.virt.is_some() }
+
+    /// Virtual mode: store rows `first..` from `data` (rows separated by
+    /// 0x1E, cells by 0x1F). `colors` optionally holds one text color per
+    /// cell (row-major, 0 = default). Rows past the row count are dropped.
+    pub fn set_rows(&mut self, first: usize, data: &[u8], colors: &[u32]) {
+        let col_count = self.columns.len().max(1);
+        let row_count = self.row_count;
+        let v = match self.virt.as_mut() { Some(v) => v, None => return };
+        for (i, row) in data.split(|&b| b == 0x1E).enumerate() {
+            let r = first + i;
+            if r >= row_count { break; }
+            let start = r / VIRTUAL_BLOCK_ROWS * VIRTUAL_BLOCK_ROWS;
+            let bi = match v.blocks.iter().position(|b| b.first == start) {
+                Some(bi) => bi,
+                None => {
+                    v.blocks.push(RowBlock { first: start, rows: vec![None; VIRTUAL_BLOCK_ROWS], colors: Vec::new() });
+                    v.blocks.len() - 1
+                }
+            };
+            let block = &mut v.blocks[bi];
+            let slot = r - start;
+            match &mut block.rows[slot] {
+                Some(text) => { text.clear(); text.extend_from_slice(row); }
+                none => *none = Some(row.to_vec()),
+            }
+            let src = i * col_count;
+            if src < colors.len() || !block.colors.is_empty() {
+                if block.colors.is_empty() {
+                    block.colors = vec![0; VIRTUAL_BLOCK_ROWS * col_count];
+                }
+                for c in 0..col_count {
+                    block.colors[slot * col_count + c] = colors.get(src + c).copied().unwrap_or(0);
+                }
+            }
+        }
+        self.base.mark_dirty();
+    }
+
+    /// Virtual mode: drop all cached rows (the owner's data changed); they
+    /// are requested again on the next frame.
+    pub fn invalidate_rows(&mut self) {
+        if let Some(v) = self.virt.as_mut() {
+            v.blocks.clear();
+            v.requested = None;
+            self.base.mark_dirty();
+        }
+    }
+
+    /// Text and text color (0 = default) of a cached cell in virtual mode.
+    fn virtual_cell(&self, row: usize, col: usize) -> (&[u8], u32) {
+        let v = match self.virt.as_ref() { Some(v) => v, None => return (&[], 0) };
+        let start = row / VIRTUAL_BLOCK_ROWS * VIRTUAL_BLOCK_ROWS;
+        let block = match v.blocks.iter().find(|b| b.first == start) { Some(b) => b, None => return (&[], 0) };
+        let slot = row - start;
+        let text = match &block.rows[slot] { Some(t) => t.as_slice(), None => return (&[], 0) };
+        let col_count = self.columns.len().max(1);
+        let color = block.colors.get(slot * col_count + col).copied().unwrap_or(0);
+        (text.split(|&b| b == 0x1F).nth(col).unwrap_or(&[]), color)
+    }
+
+    /// Virtual mode: work out which rows the viewport needs (one page of
+    /// margin either side), evict blocks far from it, and record a request
+    /// for the missing span. Returns true if the owner should be asked,
+    /// i.e. the span differs from the one already requested.
+    pub(crate) fn poll_data_request(&mut self) -> bool {
+        let rh = self.row_height.max(1) as usize;
+        let view_h = (self.base.h as i32 - self.header_height as i32).max(0) as usize;
+        let page = view_h / rh + 1;
+        let first_vis = self.scroll_y.max(0) as usize / rh;
+        let lo = first_vis.saturating_sub(page);
+        let hi = (first_vis + 2 * page).min(self.row_count);
+        let row_count = self.row_count;
+        let v = match self.virt.as_mut() { Some(v) => v, None => return false };
+        if lo >= hi {
+            v.requested = None;
+            return false;
+        }
+
+        let b_lo = lo / VIRTUAL_BLOCK_ROWS;
+        let b_hi = (hi + VIRTUAL_BLOCK_ROWS - 1) / VIRTUAL_BLOCK_ROWS;
+        // Keep a window's worth of blocks either side for scrolling back.
+        let span = b_hi - b_lo;
+        let keep_lo = b_lo.saturating_sub(span) * VIRTUAL_BLOCK_ROWS;
+        let keep_hi = (b_hi + span) * VIRTUAL_BLOCK_ROWS;
+        v.blocks.retain(|b| b.first >= keep_lo && b.first < keep_hi);
+
+        let mut missing: Option<(usize, usize)> = None;
+        for bi in b_lo..b_hi {
+            let start = bi * VIRTUAL_BLOCK_ROWS;
+            if !v.blocks.iter().any(|b| b.first == start) {
+                let end = (start + VIRTUAL_BLOCK_ROWS).min(row_count);
+                missing = Some(match missing { Some((m, _)) => (m, end), None => (start, end) });
+            }
+        }
+        match missing {
+            None => {
+                v.requested = None;
+                false
+            }
+            Some(m) if v.requested == Some(m) => false,
+            Some(m) => {
+                v.requested = Some(m);
+                true
+            }
         }
-        None
+    }
+
+    /// The outstanding request as `(first_row, count, sort_column,
+    /// sort_direction)`: the column is logical (`u32::MAX` = unsorted) and
+    /// the direction 0 = none, 1 = ascending, 2 = descending.
+    pub fn data_request(&self) -> Option<(u32, u32, u32, u32)> {
+        let (first, end) = self.virt.as_ref()?.requested?;
+        let col = match (self.sort_direction, self.sort_column) {
+            (SortDirection::None, _) | (_, None) => u32::MAX,
+            (_, Some(dc)) => self.display_order.get(dc).map(|&c| c as u32).unwrap_or(u32::MAX),
+        };
+        let dir = match self.sort_direction {
+            SortDirection::None => 0,
+            SortDirection::Ascending => 1,
+            SortDirection::Descending => 2,
+        };
+        Some((first as u32, (end - first) as u32, col, dir))
     }
 
     /// Clamp scroll_y so the viewport doesn't extend past the last row.
@@ -337,32 +585,21 @@ impl DataGrid {
         self.selection_mode = mode;
     }
 
-    fn ensure_selection_bits(&mut self) {
-        let bytes_needed = (self.row_count + 7) / 8;
-        self.selected_rows.resize(bytes_needed, 0);
-    }
-
     pub fn is_row_selected(&self, row: usize) -> bool {
-        if row >= self.row_count { return false; }
-        let byte = row / 8;
-        let bit = row % 8;
-        byte < self.selected_rows.len() && (self.selected_rows[byte] & (1 << bit)) != 0
+        row < self.row_count && self.selected_rows.contains(row)
     }
 
     pub(crate) fn set_row_selected(&mut self, row: usize, selected: bool) {
         if row >= self.row_count { return; }
-        self.ensure_selection_bits();
-        let byte = row / 8;
-        let bit = row % 8;
         if selected {
-            self.selected_rows[byte] |= 1 << bit;
+            self.selected_rows.insert_range(row, row + 1);
         } else {
-            self.selected_rows[byte] &= !(1 << bit);
+            self.selected_rows.remove(row);
         }
     }
 
     pub(crate) fn clear_selection(&mut self) {
-        self.selected_rows.fill(0);
+        self.selected_rows.clear();
     }
 
     // ── Sort ───────────────────────────────────────────────────────
@@ -375,6 +612,13 @@ impl DataGrid {
     }
 
     fn rebuild_sort(&mut self) {
+        if self.virt.is_some() {
+            // The owner sorts: refetch rows in the new order.
+            self.sorted_rows.clear();
+            self.clear_selection();
+            self.invalidate_rows();
+            return;
+        }
         if self.sort_direction == SortDirection::None || self.sort_column.is_none() {
             self.sorted_rows.clear();
             return;
@@ -564,10 +808,15 @@ impl Control for DataGrid {
                         }
                     }
 
-                    if cell_idx < self.cell_data.len() && !self.cell_data[cell_idx].is_empty() {
-                        let text = &self.cell_data[cell_idx];
-                        let default_color = if cell_idx < self.cell_colors.len() && self.cell_colors[cell_idx] != 0 {
-                            self.cell_colors[cell_idx]
+                    let (text, color) = if self.virt.is_some() {
+                        self.virtual_cell(data_row, logical_col)
+                    } else {
+                        (self.cell_data.get(cell_idx).map(|t| t.as_slice()).unwrap_or(&[]),
+                         self.cell_colors.get(cell_idx).copied().unwrap_or(0))
+                    };
+                    if !text.is_empty() {
+                        let default_color = if color != 0 {
+                            color
                         } else if selected {
                             0xFFFFFFFF
                         } else {
@@ -898,9 +1147,7 @@ impl Control for DataGrid {
                             let lo = anchor.min(data_row);
                             let hi = anchor.max(data_row);
                             self.clear_selection();
-                            for r in lo..=hi {
-                                self.set_row_selected(r, true);
-                            }
+                            self.selected_rows.insert_range(lo, (hi + 1).min(self.row_count));
                         } else {
                             // Plain click: select only this row
                             self.clear_selection();
@@ -1,9 +1,10 @@
 //! TextEditor — code editor control with syntax highlighting, line numbers,
 //! auto-indent, and smooth scrolling.
 
-use alloc::vec;
 use alloc::vec::Vec;
+use core::cell::RefCell;
 use crate::control::{Control, ControlBase, ControlKind, EventResponse};
+use crate::text_buffer::TextBuffer;
 
 // ── Selection ────────────────────────────────────────────────────────
 
@@ -57,6 +58,8 @@ pub(crate) struct SyntaxDef {
     comment_color: u32,
     number_color: u32,
     operator_color: u32,
+    /// Hashed lookup over keywords, types and builtins.
+    words: WordTable,
 }
 
 impl SyntaxDef {
@@ -77,6 +80,7 @@ impl SyntaxDef {
             comment_color: 0xFF6A737D,
             number_color: 0xFF9B59B6,
             operator_color: 0xFF56B6C2,
+            words: WordTable::new(),
         };
 
         // Split data into lines
@@ -132,20 +136,230 @@ impl SyntaxDef {
             start = end + 1;
         }
 
+        // Earlier classes win when a word is listed twice.
+        let mut words = WordTable::with_capacity(
+            syn.keywords.len() + syn.types.len() + syn.builtins.len(),
+        );
+        for w in &syn.keywords { words.insert(w, WORD_KEYWORD); }
+        for w in &syn.types { words.insert(w, WORD_TYPE); }
+        for w in &syn.builtins { words.insert(w, WORD_BUILTIN); }
+        syn.words = words;
+
         Some(syn)
     }
 }
 
+// ── Word table ──────────────────────────────────────────────────────
+
+const WORD_KEYWORD: u8 = 1;
+const WORD_TYPE: u8 = 2;
+const WORD_BUILTIN: u8 = 3;
+
+/// Open-addressing hash table (FNV-1a, linear probing) mapping identifiers
+/// to their highlight class, so each identifier costs one probe sequence
+/// instead of a scan over every keyword list.
+struct WordTable {
+    /// Index + 1 into `words`; 0 marks an empty slot.
+    slots: Vec<u32>,
+    words: Vec<(Vec<u8>, u8)>,
+}
+
+impl WordTable {
+    fn new() -> Self {
+        Self { slots: Vec::new(), words: Vec::new() }
+    }
+
+    fn with_capacity(n: usize) -> Self {
+        let size = (n * 2).max(8).next_power_of_two();
+        let mut slots = Vec::new();
+        slots.resize(size, 0);
+        Self { slots, words: Vec::with_capacity(n) }
+    }
+
+    fn insert(&mut self, word: &[u8], class: u8) {
+        let mask = self.slots.len() - 1;
+        let mut i = word_hash(word) as usize & mask;
+        loop {
+            match self.slots[i] {
+                0 => {
+                    self.words.push((word.to_vec(), class));
+                    self.slots[i] = self.words.len() as u32;
+                    return;
+                }
+                n if self.words[n as usize - 1].0 == word => return,
+                _ => i = (i + 1) & mask,
+            }
+        }
+    }
+
+    fn get(&self, word: &[u8]) -> u8 {
+        if self.words.is_empty() {
+            return 0;
+        }
+        let mask = self.slots.len() - 1;
+        let mut i = word_hash(word) as usize & mask;
+        loop {
+            match self.slots[i] {
+                0 => return 0,
+                n => {
+                    let (ref w, class) = self.words[n as usize - 1];
+                    if w.as_slice() == word {
+                        return class;
+                    }
+                    i = (i + 1) & mask;
+                }
+            }
+        }
+    }
+}
+
+fn word_hash(word: &[u8]) -> u32 {
+    let mut h: u32 = 0x811C_9DC5;
+    for &b in word {
+        h ^= b as u32;
+        h = h.wrapping_mul(0x0100_0193);
+    }
+    h
+}
+
 // ── Undo / Redo ─────────────────────────────────────────────────────
 
 const MAX_UNDO: usize = 50;
 
+/// One primitive change: `removed` was replaced by `inserted` at `offset`.
+struct Edit {
+    offset: usize,
+    removed: Vec<u8>,
+    inserted: Vec<u8>,
+}
+
+/// Edits undone and redone as one step, plus the cursor to restore.
+/// Only the changed text is kept, never a copy of the document.
 struct UndoState {
-    lines: Vec<Vec<u8>>,
+    edits: Vec<Edit>,
     cursor_row: usize,
     cursor_col: usize,
 }
 
+// ── Highlight cache ─────────────────────────────────────────────────
+
+/// Tokenizer state per line, kept parallel to the buffer's lines.
+///
+/// An edit lowers `valid` to the edited line. The next paint re-derives
+/// start states from there and stops as soon as a recomputed state matches
+/// the cached one past the edited region, so a keystroke re-tokenizes only
+/// the edited line and the lines whose comment state it actually changed.
+struct HighlightCache {
+    /// Whether each line starts inside a block comment.
+    in_comment: Vec<bool>,
+    /// Start states of lines `..valid` are known correct (line 0 always is).
+    valid: usize,
+    /// Start states of lines `..scanned` were computed at some point.
+    scanned: usize,
+    /// Last line touched by an edit since `valid` was lowered.
+    edited_hi: usize,
+    /// Spans of the rows last painted; `spans[i]` belongs to `span_first + i`.
+    spans: Vec<Option<Vec<ColorSpan>>>,
+    span_first: usize,
+}
+
+impl HighlightCache {
+    fn new(line_count: usize) -> Self {
+        let mut in_comment = Vec::new();
+        in_comment.resize(line_count, false);
+        Self { in_comment, valid: 1, scanned: 1, edited_hi: 0, spans: Vec::new(), span_first: 0 }
+    }
+
+    /// The text of `row` changed and lines `row+1..=row+removed` were
+    /// replaced by `inserted` new lines.
+    fn edit(&mut self, row: usize, removed: usize, inserted: usize) {
+        let end = row + 1 + removed;
+        self.in_comment.splice(row + 1..end, (0..inserted).map(|_| false));
+
+        let hi = row + inserted;
+        self.edited_hi = if self.valid < self.scanned {
+            // An unfinished re-scan leaves the state below `valid` possibly
+            // inconsistent, so keep it inside the edited region.
+            let old = self.edited_hi.max(self.valid - 1);
+            let old = if old >= end { old - removed + inserted } else if old > row { hi } else { old };
+            old.max(hi)
+        } else {
+            hi
+        };
+        self.scanned = if self.scanned > end {
+            self.scanned - removed + inserted
+        } else {
+            self.scanned.min(row + 1)
+        };
+        self.valid = self.valid.min(row + 1);
+
+        if removed == 0 && inserted == 0 {
+            self.drop_spans(row);
+        } else {
+            // Rows below a change in line count shift, so drop theirs too.
+            let skip = row.saturating_sub(self.span_first);
+            for s in self.spans.iter_mut().skip(skip) {
+                *s = None;
+            }
+        }
+    }
+
+    fn drop_spans(&mut self, row: usize) {
+        if row >= self.span_first {
+            if let Some(s) = self.spans.get_mut(row - self.span_first) {
+                *s = None;
+            }
+        }
+    }
+
+    /// Bring the start states of lines `..upto` up to date.
+    fn ensure(&mut self, upto: usize, buf: &TextBuffer, syn: &SyntaxDef) {
+        if syn.block_comment_start.is_empty() {
+            // No block comments: every line starts outside one.
+            self.valid = self.in_comment.len();
+            return;
+        }
+        let upto = upto.min(self.in_comment.len());
+        let mut line = Vec::new();
+        while self.valid < upto {
+            let i = self.valid - 1;
+            buf.line_into(i, &mut line);
+            let (_, end) = tokenize_line(&line, self.in_comment[i], syn);
+            let j = i + 1;
+            if j > self.edited_hi && j < self.scanned && self.in_comment[j] == end {
+                // Converged: everything below was computed from the same state.
+                self.valid = self.scanned;
+                continue;
+            }
+            if self.in_comment[j] != end {
+                self.in_comment[j] = end;
+                self.drop_spans(j);
+            }
+            self.valid = j + 1;
+            self.scanned = self.scanned.max(self.valid);
+        }
+    }
+
+    /// Re-base the span cache on rows `first..end`, keeping overlapping rows.
+    fn set_window(&mut self, first: usize, end: usize) {
+        let end = end.max(first);
+        if first == self.span_first && end - first == self.spans.len() {
+            return;
+        }
+        let mut spans = Vec::with_capacity(end - first);
+        for row in first..end {
+            let old = if row >= self.span_first {
+                self.spans.get_mut(row - self.span_first).and_then(|s| s.take())
+            } else {
+                None
+            };
+            spans.push(old);
+        }
+        self.spans = spans;
+        self.span_first = first;
+    }
+}
+
 // ── TextEditor ───────────────────────────────────────────────────────
 
 /// A line highlight entry: line index + background color.
@@ -156,7 +370,7 @@ struct LineHighlight {
 
 pub struct TextEditor {
     pub(crate) base: ControlBase,
-    lines: Vec<Vec<u8>>,
+    buf: TextBuffer,
     pub(crate) cursor_row: usize,
     pub(crate) cursor_col: usize,
     scroll_y: i32,
@@ -164,6 +378,8 @@ pub struct TextEditor {
     focused: bool,
     selection: Option<Selection>,
     syntax: Option<SyntaxDef>,
+    /// Updated during paint, which only has `&self`.
+    highlight: RefCell<HighlightCache>,
     pub(crate) show_line_numbers: bool,
     gutter_width: u32,
     pub(crate) line_height: u32,
@@ -185,7 +401,7 @@ impl TextEditor {
         let char_width = if cw > 0 { cw } else { 8 };
         Self {
             base,
-            lines: vec![Vec::new()],
+            buf: TextBuffer::new(),
             cursor_row: 0,
             cursor_col: 0,
             scroll_y: 0,
@@ -193,6 +409,7 @@ impl TextEditor {
             focused: false,
             selection: None,
             syntax: None,
+            highlight: RefCell::new(HighlightCache::new(1)),
             show_line_numbers: true,
             gutter_width: 40,
             line_height: 20,
@@ -207,13 +424,13 @@ impl TextEditor {
         }
     }
 
-    /// Snapshot current state onto the undo stack before a mutation.
+    /// Start a new undo step before a mutation.
     pub(crate) fn push_undo(&mut self) {
         if self.undo_stack.len() >= MAX_UNDO {
             self.undo_stack.remove(0);
         }
         self.undo_stack.push(UndoState {
-            lines: self.lines.clone(),
+            edits: Vec::new(),
             cursor_row: self.cursor_row,
             cursor_col: self.cursor_col,
         });
@@ -221,17 +438,55 @@ impl TextEditor {
         self.redo_stack.clear();
     }
 
-    /// Undo the last edit.
-    fn undo(&mut self) -> bool {
-        if let Some(state) = self.undo_stack.pop() {
-            // Save current state to redo stack.
-            self.redo_stack.push(UndoState {
-                lines: core::mem::replace(&mut self.lines, state.lines),
+    /// Replace `remove_len` bytes at `offset` with `text` and keep the
+    /// highlight cache in step. Returns the removed bytes.
+    fn apply_edit(&mut self, offset: usize, remove_len: usize, text: &[u8]) -> Vec<u8> {
+        let row = self.buf.row_of(offset.min(self.buf.len()));
+        let mut removed = Vec::new();
+        self.buf.delete(offset, offset + remove_len, &mut removed);
+        self.buf.insert(offset, text);
+        let removed_lines = removed.iter().filter(|&&b| b == b'\n').count();
+        let inserted_lines = text.iter().filter(|&&b| b == b'\n').count();
+        self.highlight.get_mut().edit(row, removed_lines, inserted_lines);
+        removed
+    }
+
+    /// Apply an edit and record it in the current undo step.
+    fn replace(&mut self, offset: usize, remove_len: usize, text: &[u8]) {
+        let offset = offset.min(self.buf.len());
+        let removed = self.apply_edit(offset, remove_len, text);
+        if removed.is_empty() && text.is_empty() {
+            return;
+        }
+        // Edits made without push_undo() join the previous step; the redo
+        // history no longer matches the buffer either way.
+        self.redo_stack.clear();
+        if self.undo_stack.is_empty() {
+            self.undo_stack.push(UndoState {
+                edits: Vec::new(),
                 cursor_row: self.cursor_row,
                 cursor_col: self.cursor_col,
             });
-            self.cursor_row = state.cursor_row;
-            self.cursor_col = state.cursor_col;
+        }
+        if let Some(step) = self.undo_stack.last_mut() {
+            step.edits.push(Edit { offset, removed, inserted: text.to_vec() });
+        }
+    }
+
+    /// Undo the last edit.
+    fn undo(&mut self) -> bool {
+        if let Some(mut state) = self.undo_stack.pop() {
+            for e in state.edits.iter().rev() {
+                self.apply_edit(e.offset, e.inserted.len(), &e.removed);
+            }
+            // Save current cursor for redo.
+            let (row, col) = (state.cursor_row, state.cursor_col);
+            state.cursor_row = self.cursor_row;
+            state.cursor_col = self.cursor_col;
+            self.redo_stack.push(state);
+            self.cursor_row = row;
+            self.cursor_col = col;
+            self.clamp_cursor();
             self.selection = None;
             self.update_gutter_width();
             self.ensure_cursor_visible();
@@ -244,14 +499,17 @@ impl TextEditor {
 
     /// Redo the last undone edit.
     fn redo(&mut self) -> bool {
-        if let Some(state) = self.redo_stack.pop() {
-            self.undo_stack.push(UndoState {
-                lines: core::mem::replace(&mut self.lines, state.lines),
-                cursor_row: self.cursor_row,
-                cursor_col: self.cursor_col,
-            });
-            self.cursor_row = state.cursor_row;
-            self.cursor_col = state.cursor_col;
+        if let Some(mut state) = self.redo_stack.pop() {
+            for e in state.edits.iter() {
+                self.apply_edit(e.offset, e.removed.len(), &e.inserted);
+            }
+            let (row, col) = (state.cursor_row, state.cursor_col);
+            state.cursor_row = self.cursor_row;
+            state.cursor_col = self.cursor_col;
+            self.undo_stack.push(state);
+            self.cursor_row = row;
+            self.cursor_col = col;
+            self.clamp_cursor();
             self.selection = None;
             self.update_gutter_width();
             self.ensure_cursor_visible();
@@ -263,17 +521,8 @@ impl TextEditor {
     }
 
     pub fn set_text(&mut self, text: &[u8]) {
-        self.lines.clear();
-        let mut line = Vec::new();
-        for &b in text {
-            if b == b'\n' {
-                self.lines.push(line);
-                line = Vec::new();
-            } else if b != b'\r' {
-                line.push(b);
-            }
-        }
-        self.lines.push(line);
+        self.buf = TextBuffer::from_bytes(text);
+        *self.highlight.get_mut() = HighlightCache::new(self.buf.line_count());
         self.cursor_row = 0;
         self.cursor_col = 0;
         self.scroll_y = 0;
@@ -304,7 +553,7 @@ impl TextEditor {
     /// Scroll the view so that the given line is visible (centered if possible).
     pub fn ensure_line_visible(&mut self, line: u32) {
         let row = line as usize;
-        if row >= self.lines.len() { return; }
+        if row >= self.buf.line_count() { return; }
         let line_h = self.line_height as i32;
         let visible_h = self.base.h as i32 - 2;
         let row_top = row as i32 * line_h;
@@ -317,14 +566,7 @@ impl TextEditor {
     }
 
     pub fn get_text(&self) -> Vec<u8> {
-        let mut out = Vec::new();
-        for (i, line) in self.lines.iter().enumerate() {
-            if i > 0 {
-                out.push(b'\n');
-            }
-            out.extend_from_slice(line);
-        }
-        out
+        self.buf.to_vec()
     }
 
     pub fn set_syntax(&mut self, data: &[u8]) {
@@ -336,12 +578,13 @@ impl TextEditor {
         } else {
             crate::log!("[SYNTAX-SERVER] parse returned None");
         }
+        *self.highlight.get_mut() = HighlightCache::new(self.buf.line_count());
         self.base.mark_dirty();
     }
 
     pub fn set_cursor(&mut self, row: usize, col: usize) {
-        self.cursor_row = row.min(self.lines.len().saturating_sub(1));
-        self.cursor_col = col.min(self.lines[self.cursor_row].len());
+        self.cursor_row = row.min(self.buf.line_count() - 1);
+        self.cursor_col = col.min(self.buf.line_len(self.cursor_row));
         self.ensure_cursor_visible();
         self.base.mark_dirty();
     }
@@ -350,25 +593,28 @@ impl TextEditor {
         (self.cursor_row, self.cursor_col)
     }
 
+    /// Byte offset of the cursor in the buffer.
+    fn cursor_offset(&self) -> usize {
+        self.buf.offset_of(self.cursor_row, self.cursor_col)
+    }
+
+    fn set_cursor_offset(&mut self, offset: usize) {
+        let (row, col) = self.buf.position_of(offset);
+        self.cursor_row = row;
+        self.cursor_col = col;
+    }
+
     pub fn insert_text_at_cursor(&mut self, text: &[u8]) {
-        for &b in text {
-            if b == b'\n' {
-                let rest = self.lines[self.cursor_row].split_off(self.cursor_col);
-                self.cursor_row += 1;
-                self.lines.insert(self.cursor_row, rest);
-                self.cursor_col = 0;
-            } else {
-                self.lines[self.cursor_row].insert(self.cursor_col, b);
-                self.cursor_col += 1;
-            }
-        }
+        let offset = self.cursor_offset();
+        self.replace(offset, 0, text);
+        self.set_cursor_offset(offset + text.len());
         self.update_gutter_width();
         self.ensure_cursor_visible();
         self.base.mark_dirty();
     }
 
     pub fn line_count(&self) -> usize {
-        self.lines.len()
+        self.buf.line_count()
     }
 
     fn update_gutter_width(&mut self) {
@@ -376,13 +622,14 @@ impl TextEditor {
             self.gutter_width = 0;
             return;
         }
-        let digits = if self.lines.len() < 10 {
+        let lines = self.buf.line_count();
+        let digits = if lines < 10 {
             1
-        } else if self.lines.len() < 100 {
+        } else if lines < 100 {
             2
-        } else if self.lines.len() < 1000 {
+        } else if lines < 1000 {
             3
-        } else if self.lines.len() < 10000 {
+        } else if lines < 10000 {
             4
         } else {
             5
@@ -412,57 +659,50 @@ impl TextEditor {
     }
 
     fn content_height(&self) -> i32 {
-        (self.lines.len() as i32) * self.line_height as i32
+        (self.buf.line_count() as i32) * self.line_height as i32
     }
 
     pub fn clamp_cursor(&mut self) {
-        if self.cursor_row >= self.lines.len() {
-            self.cursor_row = self.lines.len().saturating_sub(1);
+        if self.cursor_row >= self.buf.line_count() {
+            self.cursor_row = self.buf.line_count() - 1;
         }
-        if self.cursor_col > self.lines[self.cursor_row].len() {
-            self.cursor_col = self.lines[self.cursor_row].len();
+        if self.cursor_col > self.buf.line_len(self.cursor_row) {
+            self.cursor_col = self.buf.line_len(self.cursor_row);
         }
     }
 
     /// Convert local pixel coordinates to (row, col) in the buffer.
     fn pixel_to_cursor(&self, lx: i32, ly: i32) -> (usize, usize) {
         let row = ((ly - 1 + self.scroll_y) / self.line_height as i32).max(0) as usize;
-        let row = row.min(self.lines.len().saturating_sub(1));
+        let row = row.min(self.buf.line_count() - 1);
         let text_lx = lx - self.gutter_width as i32 - 1 + self.scroll_x;
         let col = (text_lx / self.char_width as i32).max(0) as usize;
-        let col = col.min(self.lines[row].len());
+        let col = col.min(self.buf.line_len(row));
         (row, col)
     }
 
-    /// Extract selected text as bytes. Returns None if no selection.
-    pub fn extract_selected_text(&self) -> Option<Vec<u8>> {
+    /// Byte range covered by the selection, or None if there is none.
+    fn selection_range(&self) -> Option<(usize, usize)> {
         let sel = self.selection.as_ref()?;
         if sel.is_empty() {
             return None;
         }
         let (sr, sc, er, ec) = sel.ordered();
+        Some((self.buf.offset_of(sr, sc), self.buf.offset_of(er, ec)))
+    }
+
+    /// Extract selected text as bytes. Returns None if no selection.
+    pub fn extract_selected_text(&self) -> Option<Vec<u8>> {
+        let (start, end) = self.selection_range()?;
         let mut out = Vec::new();
-        for row in sr..=er {
-            if row >= self.lines.len() {
-                break;
-            }
-            let line = &self.lines[row];
-            let c0 = if row == sr { sc.min(line.len()) } else { 0 };
-            let c1 = if row == er { ec.min(line.len()) } else { line.len() };
-            if c0 <= c1 {
-                out.extend_from_slice(&line[c0..c1]);
-            }
-            if row < er {
-                out.push(b'\n');
-            }
-        }
+        self.buf.append_range(start, end, &mut out);
         if out.is_empty() { None } else { Some(out) }
     }
 
     /// Select all text.
     pub fn select_all(&mut self) {
-        let last_row = self.lines.len().saturating_sub(1);
-        let last_col = self.lines[last_row].len();
+        let last_row = self.buf.line_count() - 1;
+        let last_col = self.buf.line_len(last_row);
         self.selection = Some(Selection {
             start_row: 0,
             start_col: 0,
@@ -475,41 +715,16 @@ impl TextEditor {
 
     /// Delete the selected text and place cursor at the start of the selection.
     pub fn delete_selection(&mut self) -> bool {
-        let sel = match self.selection.take() {
-            Some(s) if !s.is_empty() => s,
-            _ => return false,
-        };
-        let (sr, sc, er, ec) = sel.ordered();
-        if sr == er {
-            // Single line deletion
-            if sr < self.lines.len() {
-                let end = ec.min(self.lines[sr].len());
-                let start = sc.min(end);
-                self.lines[sr].drain(start..end);
-            }
-        } else {
-            // Multi-line deletion
-            let end_col = ec.min(self.lines.get(er).map_or(0, |l| l.len()));
-            // Keep tail of last line
-            let tail: Vec<u8> = if er < self.lines.len() {
-                self.lines[er][end_col..].to_vec()
-            } else {
-                Vec::new()
-            };
-            // Remove lines from sr+1 to er (inclusive)
-            let remove_end = (er + 1).min(self.lines.len());
-            if sr + 1 <= remove_end {
-                self.lines.drain(sr + 1..remove_end);
-            }
-            // Truncate first line at sc and append tail
-            if sr < self.lines.len() {
-                let start = sc.min(self.lines[sr].len());
-                self.lines[sr].truncate(start);
-                self.lines[sr].extend_from_slice(&tail);
+        let (start, end) = match self.selection_range() {
+            Some(r) => r,
+            None => {
+                self.selection = None;
+                return false;
             }
-        }
-        self.cursor_row = sr.min(self.lines.len().saturating_sub(1));
-        self.cursor_col = sc.min(self.lines[self.cursor_row].len());
+        };
+        self.selection = None;
+        self.replace(start, end - start, &[]);
+        self.set_cursor_offset(start);
         self.update_gutter_width();
         self.ensure_cursor_visible();
         self.base.mark_dirty();
@@ -563,22 +778,21 @@ impl Control for TextEditor {
 
         let visible_start = (s_scroll_y / s_line_h as i32).max(0) as usize;
         let visible_end = ((s_scroll_y + h as i32) / s_line_h as i32 + 1)
-            .min(self.lines.len() as i32) as usize;
+            .min(self.buf.line_count() as i32) as usize;
 
         let text_x_base = x + 1 + s_gutter_w as i32;
 
-        // Track block comment state: pre-scan lines before visible_start
-        let mut in_block_comment = false;
-        if self.syntax.is_some() {
-            for i in 0..visible_start {
-                if let Some(ref syn) = self.syntax {
-                    let (_, still_in) = tokenize_line(&self.lines[i], in_block_comment, syn);
-                    in_block_comment = still_in;
-                }
-            }
+        // Only lines whose comment state is stale get re-tokenized.
+        let mut hl_ref = self.highlight.borrow_mut();
+        let hl = &mut *hl_ref;
+        if let Some(ref syn) = self.syntax {
+            hl.ensure(visible_end, &self.buf, syn);
+            hl.set_window(visible_start, visible_end);
         }
 
+        let mut line = Vec::new();
         for row in visible_start..visible_end {
+            self.buf.line_into(row, &mut line);
             let row_y = y + 1 + (row as i32) * s_line_h as i32 - s_scroll_y;
 
             // Per-line highlights (debugger breakpoints, current RIP, etc.)
@@ -612,7 +826,7 @@ impl Control for TextEditor {
                 if !sel.is_empty() {
                     let (sr, sc, er, ec) = sel.ordered();
                     if row >= sr && row <= er {
-                        let line_len = self.lines[row].len();
+                        let line_len = line.len();
                         let sel_start = if row == sr { sc.min(line_len) } else { 0 };
                         let sel_end = if row == er { ec.min(line_len) } else { line_len };
                         if sel_start < sel_end || (row > sr && row < er) {
@@ -664,12 +878,13 @@ impl Control for TextEditor {
             }
 
             // Text content
-            let line = &self.lines[row];
             if !line.is_empty() {
                 if let Some(ref syn) = self.syntax {
-                    let (spans, still_in) = tokenize_line(line, in_block_comment, syn);
-                    in_block_comment = still_in;
-                    for span in &spans {
+                    let slot = &mut hl.spans[row - hl.span_first];
+                    if slot.is_none() {
+                        *slot = Some(tokenize_line(&line, hl.in_comment[row], syn).0);
+                    }
+                    for span in slot.iter().flatten() {
                         let text_slice = &line[span.start..span.end];
                         let span_x = text_x_base + (span.start as i32) * s_char_w as i32
                             - s_scroll_x;
@@ -690,14 +905,11 @@ impl Control for TextEditor {
                         text_x,
                         row_y + s_text_pad,
                         tc.text,
-                        line,
+                        &line,
                         self.font_id,
                         s_font_size,
                     );
                 }
-            } else if let Some(ref syn) = self.syntax {
-                let (_, still_in) = tokenize_line(line, in_block_comment, syn);
-                in_block_comment = still_in;
             }
 
             // Cursor
@@ -868,8 +1080,8 @@ impl Control for TextEditor {
             }
             // Ctrl+A: select all
             if char_code == b'a' as u32 || char_code == b'A' as u32 {
-                let last_row = self.lines.len().saturating_sub(1);
-                let last_col = self.lines[last_row].len();
+                let last_row = self.buf.line_count() - 1;
+                let last_col = self.buf.line_len(last_row);
                 self.selection = Some(Selection {
                     start_row: 0,
                     start_col: 0,
@@ -903,13 +1115,13 @@ impl Control for TextEditor {
                         self.cursor_col -= 1;
                     } else if self.cursor_row > 0 {
                         self.cursor_row -= 1;
-                        self.cursor_col = self.lines[self.cursor_row].len();
+                        self.cursor_col = self.buf.line_len(self.cursor_row);
                     }
                 }
                 KEY_RIGHT => {
-                    if self.cursor_col < self.lines[self.cursor_row].len() {
+                    if self.cursor_col < self.buf.line_len(self.cursor_row) {
                         self.cursor_col += 1;
-                    } else if self.cursor_row + 1 < self.lines.len() {
+                    } else if self.cursor_row + 1 < self.buf.line_count() {
                         self.cursor_row += 1;
                         self.cursor_col = 0;
                     }
@@ -917,17 +1129,17 @@ impl Control for TextEditor {
                 KEY_UP => {
                     if self.cursor_row > 0 {
                         self.cursor_row -= 1;
-                        self.cursor_col = self.cursor_col.min(self.lines[self.cursor_row].len());
+                        self.cursor_col = self.cursor_col.min(self.buf.line_len(self.cursor_row));
                     }
                 }
                 KEY_DOWN => {
-                    if self.cursor_row + 1 < self.lines.len() {
+                    if self.cursor_row + 1 < self.buf.line_count() {
                         self.cursor_row += 1;
-                        self.cursor_col = self.cursor_col.min(self.lines[self.cursor_row].len());
+                        self.cursor_col = self.cursor_col.min(self.buf.line_len(self.cursor_row));
                     }
                 }
                 KEY_HOME => { self.cursor_col = 0; }
-                KEY_END => { self.cursor_col = self.lines[self.cursor_row].len(); }
+                KEY_END => { self.cursor_col = self.buf.line_len(self.cursor_row); }
                 _ => {}
             }
             // Update selection endpoint
@@ -986,7 +1198,8 @@ impl Control for TextEditor {
         // Printable ASCII
         if char_code >= 0x20 && char_code < 0x7F {
             self.clamp_cursor();
-            self.lines[self.cursor_row].insert(self.cursor_col, char_code as u8);
+            let offset = self.cursor_offset();
+            self.replace(offset, 0, &[char_code as u8]);
             self.cursor_col += 1;
             self.ensure_cursor_visible();
             self.base.mark_dirty();
@@ -995,19 +1208,16 @@ impl Control for TextEditor {
         // Enter
         if keycode == KEY_ENTER {
             self.clamp_cursor();
-            let indent = self.lines[self.cursor_row]
-                .iter()
-                .take_while(|&&b| b == b' ')
-                .count();
-            let rest = self.lines[self.cursor_row].split_off(self.cursor_col);
+            let mut text = Vec::new();
+            self.buf.line_into(self.cursor_row, &mut text);
+            let indent = text.iter().take_while(|&&b| b == b' ').count();
+            text.clear();
+            text.push(b'\n');
+            text.resize(1 + indent, b' ');
+            let offset = self.cursor_offset();
+            self.replace(offset, 0, &text);
             self.cursor_row += 1;
-            let mut new_line = Vec::new();
-            for _ in 0..indent {
-                new_line.push(b' ');
-            }
-            new_line.extend_from_slice(&rest);
             self.cursor_col = indent;
-            self.lines.insert(self.cursor_row, new_line);
             self.update_gutter_width();
             self.ensure_cursor_visible();
             self.base.mark_dirty();
@@ -1016,14 +1226,10 @@ impl Control for TextEditor {
         // Backspace
         if keycode == KEY_BACKSPACE {
             self.clamp_cursor();
-            if self.cursor_col > 0 {
-                self.cursor_col -= 1;
-                self.lines[self.cursor_row].remove(self.cursor_col);
-            } else if self.cursor_row > 0 {
-                let current_line = self.lines.remove(self.cursor_row);
-                self.cursor_row -= 1;
-                self.cursor_col = self.lines[self.cursor_row].len();
-                self.lines[self.cursor_row].extend_from_slice(&current_line);
+            let offset = self.cursor_offset();
+            if offset > 0 {
+                self.replace(offset - 1, 1, &[]);
+                self.set_cursor_offset(offset - 1);
                 self.update_gutter_width();
             }
             self.ensure_cursor_visible();
@@ -1033,11 +1239,9 @@ impl Control for TextEditor {
         // Delete
         if keycode == KEY_DELETE {
             self.clamp_cursor();
-            if self.cursor_col < self.lines[self.cursor_row].len() {
-                self.lines[self.cursor_row].remove(self.cursor_col);
-            } else if self.cursor_row + 1 < self.lines.len() {
-                let next_line = self.lines.remove(self.cursor_row + 1);
-                self.lines[self.cursor_row].extend_from_slice(&next_line);
+            let offset = self.cursor_offset();
+            if offset < self.buf.len() {
+                self.replace(offset, 1, &[]);
                 self.update_gutter_width();
             }
             self.base.mark_dirty();
@@ -1046,10 +1250,11 @@ impl Control for TextEditor {
         // Tab
         if keycode == KEY_TAB {
             self.clamp_cursor();
-            for _ in 0..self.tab_width {
-                self.lines[self.cursor_row].insert(self.cursor_col, b' ');
-                self.cursor_col += 1;
-            }
+            let mut spaces = Vec::new();
+            spaces.resize(self.tab_width as usize, b' ');
+            let offset = self.cursor_offset();
+            self.replace(offset, 0, &spaces);
+            self.cursor_col += spaces.len();
             self.ensure_cursor_visible();
             self.base.mark_dirty();
             return EventResponse::CHANGED;
@@ -1060,7 +1265,7 @@ impl Control for TextEditor {
                 self.cursor_col -= 1;
             } else if self.cursor_row > 0 {
                 self.cursor_row -= 1;
-                self.cursor_col = self.lines[self.cursor_row].len();
+                self.cursor_col = self.buf.line_len(self.cursor_row);
             }
             self.ensure_cursor_visible();
             self.base.mark_dirty();
@@ -1068,9 +1273,9 @@ impl Control for TextEditor {
         }
         // Right arrow
         if keycode == KEY_RIGHT {
-            if self.cursor_col < self.lines[self.cursor_row].len() {
+            if self.cursor_col < self.buf.line_len(self.cursor_row) {
                 self.cursor_col += 1;
-            } else if self.cursor_row + 1 < self.lines.len() {
+            } else if self.cursor_row + 1 < self.buf.line_count() {
                 self.cursor_row += 1;
                 self.cursor_col = 0;
             }
@@ -1082,7 +1287,7 @@ impl Control for TextEditor {
         if keycode == KEY_UP {
             if self.cursor_row > 0 {
                 self.cursor_row -= 1;
-                self.cursor_col = self.cursor_col.min(self.lines[self.cursor_row].len());
+                self.cursor_col = self.cursor_col.min(self.buf.line_len(self.cursor_row));
             }
             self.ensure_cursor_visible();
             self.base.mark_dirty();
@@ -1090,9 +1295,9 @@ impl Control for TextEditor {
         }
         // Down arrow
         if keycode == KEY_DOWN {
-            if self.cursor_row + 1 < self.lines.len() {
+            if self.cursor_row + 1 < self.buf.line_count() {
                 self.cursor_row += 1;
-                self.cursor_col = self.cursor_col.min(self.lines[self.cursor_row].len());
+                self.cursor_col = self.cursor_col.min(self.buf.line_len(self.cursor_row));
             }
             self.ensure_cursor_visible();
             self.base.mark_dirty();
@@ -1107,7 +1312,7 @@ impl Control for TextEditor {
         }
         // End
         if keycode == KEY_END {
-            self.cursor_col = self.lines[self.cursor_row].len();
+            self.cursor_col = self.buf.line_len(self.cursor_row);
             self.ensure_cursor_visible();
             self.base.mark_dirty();
             return EventResponse::CONSUMED;
@@ -1117,7 +1322,7 @@ impl Control for TextEditor {
             self.selection = None;
             let page = (self.base.h / self.line_height).max(1) as usize;
             self.cursor_row = self.cursor_row.saturating_sub(page);
-            self.cursor_col = self.cursor_col.min(self.lines[self.cursor_row].len());
+            self.cursor_col = self.cursor_col.min(self.buf.line_len(self.cursor_row));
             self.ensure_cursor_visible();
             self.base.mark_dirty();
             return EventResponse::CONSUMED;
@@ -1126,8 +1331,8 @@ impl Control for TextEditor {
         if keycode == KEY_PAGE_DOWN {
             self.selection = None;
             let page = (self.base.h / self.line_height).max(1) as usize;
-            self.cursor_row = (self.cursor_row + page).min(self.lines.len().saturating_sub(1));
-            self.cursor_col = self.cursor_col.min(self.lines[self.cursor_row].len());
+            self.cursor_row = (self.cursor_row + page).min(self.buf.line_count() - 1);
+            self.cursor_col = self.cursor_col.min(self.buf.line_len(self.cursor_row));
             self.ensure_cursor_visible();
             self.base.mark_dirty();
             return EventResponse::CONSUMED;
@@ -1274,15 +1479,11 @@ fn tokenize_line(line: &[u8], in_block_comment: bool, syn: &SyntaxDef) -> (Vec<C
             while i < line.len() && (line[i].is_ascii_alphanumeric() || line[i] == b'_') {
                 i += 1;
             }
-            let word = &line[start..i];
-            let color = if syn.keywords.iter().any(|k| k.as_slice() == word) {
-                syn.keyword_color
-            } else if syn.types.iter().any(|t| t.as_slice() == word) {
-                syn.type_color
-            } else if syn.builtins.iter().any(|b| b.as_slice() == word) {
-                syn.builtin_color
-            } else {
-                default_color
+            let color = match syn.words.get(&line[start..i]) {
+                WORD_KEYWORD => syn.keyword_color,
+                WORD_TYPE => syn.type_color,
+                WORD_BUILTIN => syn.builtin_color,
+                _ => default_color,
             };
             spans.push(ColorSpan { start, end: i, color });
             continue;
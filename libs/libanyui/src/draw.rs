@@ -128,6 +128,7 @@ fn ensure_libfont() {
 }
 
 /// Mini ELF64 symbol resolver — resolves a single symbol from a loaded .so.
+/// Uses the GNU hash table when the object has one, else the SysV table.
 unsafe fn resolve_sym<T: Copy>(base: u64, name: &[u8]) -> Option<T> {
     // ELF64 header
     let ehdr = base as *const u8;
@@ -155,10 +156,11 @@ unsafe fn resolve_sym<T: Copy>(base: u64, name: &[u8]) -> Option<T> {
     let load_bias = if link_base != u64::MAX { base - link_base } else { 0 };
     dynamic_va += load_bias;
 
-    // Walk .dynamic for DT_SYMTAB(6), DT_STRTAB(5), DT_HASH(4)
+    // Walk .dynamic for DT_SYMTAB(6), DT_STRTAB(5), DT_HASH(4), DT_GNU_HASH
     let mut symtab: u64 = 0;
     let mut strtab: u64 = 0;
     let mut hash: u64 = 0;
+    let mut gnu_hash: u64 = 0;
     let dyn_ptr = dynamic_va as *const u8;
     for i in 0..128 {
         let entry = dyn_ptr.add(i * 16);
@@ -168,11 +170,16 @@ unsafe fn resolve_sym<T: Copy>(base: u64, name: &[u8]) -> Option<T> {
             6 => symtab = d_val,
             5 => strtab = d_val,
             4 => hash = d_val,
+            0x6FFF_FEF5 => gnu_hash = d_val,
             0 => break,
             _ => {}
         }
     }
-    if symtab == 0 || strtab == 0 || hash == 0 { return None; }
+    if symtab == 0 || strtab == 0 { return None; }
+    if gnu_hash != 0 {
+        return gnu_lookup(symtab, strtab, gnu_hash, name);
+    }
+    if hash == 0 { return None; }
 
     // ELF hash lookup
     let nbuckets = *(hash as *const u32);
@@ -194,6 +201,41 @@ unsafe fn resolve_sym<T: Copy>(base: u64, name: &[u8]) -> Option<T> {
     None
 }
 
+/// GNU hash table lookup: Bloom filter check, then the bucket's hash run.
+unsafe fn gnu_lookup<T: Copy>(symtab: u64, strtab: u64, table: u64, name: &[u8]) -> Option<T> {
+    // Header: nbuckets, symoffset, bloom_size, bloom_shift
+    let hdr = table as *const u32;
+    let (nbuckets, symoffset, bloom_size, bloom_shift) = (*hdr, *hdr.add(1), *hdr.add(2), *hdr.add(3));
+    if nbuckets == 0 || bloom_size == 0 { return None; }
+    let bloom = hdr.add(4) as *const u64;
+    let buckets = bloom.add(bloom_size as usize) as *const u32;
+    let chain = buckets.add(nbuckets as usize);
+
+    let mut h: u32 = 5381;
+    for &b in name {
+        h = (h << 5).wrapping_add(h).wrapping_add(b as u32);
+    }
+    let word = *bloom.add(((h / 64) % bloom_size) as usize);
+    let mask = (1u64 << (h % 64)) | (1u64 << ((h >> bloom_shift) % 64));
+    if word & mask != mask { return None; }
+
+    let mut idx = *buckets.add((h % nbuckets) as usize);
+    if idx < symoffset { return None; }
+    loop {
+        let chain_hash = *chain.add((idx - symoffset) as usize);
+        if (chain_hash | 1) == (h | 1) {
+            let sym = (symtab + idx as u64 * 24) as *const u8;
+            let st_name = *(sym as *const u32);
+            let st_value = *(sym.add(8) as *const u64);
+            if st_value != 0 && cstr_eq(strtab as *const u8, st_name as usize, name) {
+                return Some(core::mem::transmute_copy::<u64, T>(&st_value));
+            }
+        }
+        if chain_hash & 1 != 0 { return None; }
+        idx += 1;
+    }
+}
+
 /// SysV ELF hash function.
 fn elf_hash(name: &[u8]) -> u32 {
     let mut h: u32 = 0;
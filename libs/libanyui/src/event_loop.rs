@@ -19,12 +19,24 @@
 
 use alloc::boxed::Box;
 use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, Ordering};
 use crate::compositor;
 use crate::control::{self, ControlId, ControlKind, Control, Callback};
 
 /// Double-click threshold in milliseconds (standard: 400ms).
 const DOUBLE_CLICK_MS: u32 = 400;
 
+/// Set once the first frame is presented; the spawn-to-first-frame time is
+/// logged then (measure app launch with it).
+static FIRST_FRAME_LOGGED: AtomicBool = AtomicBool::new(false);
+
+/// Channel on which the first frame of every process is reported
+/// (`anyos_std::ipc::LAUNCH_CHANNEL`; preloadd keeps its launch history
+/// from it).
+const LAUNCH_CHANNEL: &[u8] = b"sys:launch";
+/// `[EVT_FIRST_FRAME, tid, ms_since_spawn, uptime_ms, 0]`
+const EVT_FIRST_FRAME: u32 = 0x0120;
+
 /// A pending callback to fire after all event processing.
 struct PendingCallback {
     id: ControlId,
@@ -70,6 +82,87 @@ pub fn run() {
     }
 }
 
+/// Collect every pending compositor event: from the shared ring without a
+/// syscall, then whatever spilled into the kernel queue in batches.
+fn drain_events(channel_id: u32, sub_id: u32, ring: usize, out: &mut Vec<[u32; 5]>) {
+    let mut batch = [[0u32; 5]; 64];
+    loop {
+        if ring != 0 {
+            let mut tmp = [0u32; 5];
+            while crate::syscall::evt_ring_pop(ring, &mut tmp) {
+                out.push(tmp);
+            }
+            if crate::syscall::evt_ring_spilled(ring) == 0 {
+                return;
+            }
+        }
+        let n = crate::syscall::evt_chan_poll_batch(channel_id, sub_id, &mut batch) as usize;
+        out.extend_from_slice(&batch[..n]);
+        if n == 0 || (ring == 0 && n < batch.len()) {
+            return;
+        }
+    }
+}
+
+/// Fold bursts of input that only matter as their latest state, so a fast
+/// drag or resize costs one hit test / one relayout per loop turn instead of
+/// one per event. Folded events are marked consumed (`ev[0] = 0`).
+///
+/// - Mouse moves: an earlier move is dropped when a later one for the same
+///   window follows with no other input in between, so button transitions,
+///   keys and scrolls still see the exact pointer position they had.
+/// - Scrolls: consecutive scrolls for a window are summed into the last one.
+/// - Resizes: only the last size per window is kept. Layout runs once after
+///   all events anyway, so intermediate sizes are never observable.
+fn coalesce_input(events: &mut [[u32; 5]]) {
+    // (comp window id, index of pending move, index of pending scroll, index of last resize)
+    let mut pending: Vec<(u32, Option<usize>, Option<usize>, Option<usize>)> = Vec::new();
+    for i in 0..events.len() {
+        let kind = events[i][0];
+        if kind < 0x3000 || kind == compositor::EVT_FRAME_ACK {
+            continue;
+        }
+        let win = events[i][1];
+        let slot = match pending.iter().position(|p| p.0 == win) {
+            Some(s) => s,
+            None => {
+                pending.push((win, None, None, None));
+                pending.len() - 1
+            }
+        };
+        let p = &mut pending[slot];
+        match kind {
+            compositor::EVT_MOUSE_MOVE => {
+                if let Some(prev) = p.1 {
+                    events[prev][0] = 0;
+                }
+                p.1 = Some(i);
+                p.2 = None;
+            }
+            compositor::EVT_MOUSE_SCROLL => {
+                if let Some(prev) = p.2 {
+                    let dz = (events[prev][2] as i32).wrapping_add(events[i][2] as i32);
+                    events[i][2] = dz as u32;
+                    events[prev][0] = 0;
+                }
+                p.2 = Some(i);
+                p.1 = None;
+            }
+            compositor::EVT_RESIZE => {
+                if let Some(prev) = p.3 {
+                    events[prev][0] = 0;
+                }
+                p.3 = Some(i);
+            }
+            _ => {
+                // Buttons, keys, focus and close keep their exact order.
+                p.1 = None;
+                p.2 = None;
+            }
+        }
+    }
+}
+
 /// Process one frame of events + rendering. Returns 1 if windows remain, 0 if done.
 pub fn run_once() -> u32 {
     let mut pending_cbs: Vec<PendingCallback> = Vec::new();
@@ -108,13 +201,8 @@ pub fn run_once() -> u32 {
     // This avoids the compositor's poll_event discarding events for other
     // windows when multiple windows share the same event channel.
     let mut all_events: Vec<[u32; 5]> = Vec::new();
-    {
-        let mut tmp = [0u32; 5];
-        while crate::syscall::evt_chan_poll(st.channel_id, st.sub_id, &mut tmp) {
-            all_events.push(tmp);
-            tmp = [0u32; 5];
-        }
-    }
+    drain_events(st.channel_id, st.sub_id, st.evt_ring, &mut all_events);
+    coalesce_input(&mut all_events);
 
     // ── Phase 1.1: Process popup events (before per-window dispatch) ──
     // Context menu popups are separate compositor windows. Their events must
@@ -959,16 +1047,38 @@ pub fn run_once() -> u32 {
         st.needs_layout = false;
     }
 
+    // ── Phase 3.65: Virtual DataGrid row requests ──────────────────
+    // A virtual grid scrolled or resized onto rows it does not hold asks
+    // its owner for them. Owners normally answer inside the callback
+    // (anyui_datagrid_set_rows), so this frame already shows the rows.
+    if st.needs_repaint {
+        let mut data_cbs: Vec<PendingCallback> = Vec::new();
+        for i in 0..st.controls.len() {
+            let id = st.controls[i].id();
+            let wants = match crate::as_data_grid(&mut st.controls[i]) {
+                Some(dg) => dg.is_virtual() && dg.poll_data_request(),
+                None => false,
+            };
+            if wants {
+                fire_event_callback(&st.controls, id, control::EVENT_DATA_REQUEST, &mut data_cbs);
+            }
+        }
+        for pcb in data_cbs {
+            (pcb.cb)(pcb.id, pcb.event_type, pcb.userdata);
+        }
+    }
+    let st = crate::state();
+
     // ── Phase 3.7: Compute per-window dirty flags + dirty rects ─────
     // Push-based: only scan when mark_dirty() was called since last render.
     // On idle frames (no events, no timers), this entire phase is skipped.
-    // Walks the control tree to compute absolute positions and union dirty
+    // Walks the control tree to compute absolute positions and collect dirty
     // rects — enabling selective rendering in Phase 4 (only controls that
-    // intersect the dirty rect are re-rendered).
+    // intersect a dirty rect are re-rendered).
     if st.needs_repaint {
         for cw in st.comp_windows.iter_mut() {
             cw.dirty = false;
-            cw.dirty_rect = None;
+            cw.dirty_region.clear();
         }
         for wi in 0..st.windows.len() {
             let win_id = st.windows[wi];
@@ -978,9 +1088,9 @@ pub fn run_once() -> u32 {
     }
 
     // ── Phase 4: Render dirty windows (with VSync back-pressure) ───
-    // Incremental rendering: only re-render controls that intersect the dirty
-    // rect, copy only the dirty region to SHM, and tell the compositor which
-    // rect changed. For typical interactions (hover, click, typing) this is
+    // Incremental rendering: only re-render controls that intersect a dirty
+    // rect, copy only those rects to SHM, and tell the compositor which
+    // rects changed. For typical interactions (hover, click, typing) this is
     // 50-500x faster than a full-window redraw.
     let channel_id = st.channel_id;
     for wi in 0..st.windows.len() {
@@ -1007,57 +1117,72 @@ pub fn run_once() -> u32 {
         let sh = st.comp_windows[wi].height;
         let comp_window_id = st.comp_windows[wi].window_id;
         let shm_id = st.comp_windows[wi].shm_id;
-        let dirty_rect = st.comp_windows[wi].dirty_rect;
+        let region = st.comp_windows[wi].dirty_region;
         let logical_w = st.comp_windows[wi].logical_width;
         let logical_h = st.comp_windows[wi].logical_height;
 
-        // Clamp dirty rect in logical space (for render_tree intersection tests)
-        let logical_dr = dirty_rect.map(|(dx, dy, dw, dh)| {
-            let x0 = dx.max(0) as u32;
-            let y0 = dy.max(0) as u32;
-            let x1 = ((dx + dw as i32).max(0) as u32).min(logical_w);
-            let y1 = ((dy + dh as i32).max(0) as u32).min(logical_h);
-            (x0 as i32, y0 as i32, x1.saturating_sub(x0), y1.saturating_sub(y0))
-        }).filter(|&(_, _, w, h)| w > 0 && h > 0);
-
-        // Scale dirty rect to physical space (for Surface clip, SHM copy, present_rect)
-        let physical_dr = logical_dr.map(|(dx, dy, dw, dh)| {
-            let px = crate::theme::scale_i32(dx);
-            let py = crate::theme::scale_i32(dy);
-            let pw = crate::theme::scale(dw as u32);
-            let ph = crate::theme::scale(dh as u32);
-            // Clamp to physical surface bounds
-            let px = px.max(0);
-            let py = py.max(0);
-            let pw = pw.min(sw.saturating_sub(px as u32));
-            let ph = ph.min(sh.saturating_sub(py as u32));
-            (px, py, pw, ph)
-        }).filter(|&(_, _, w, h)| w > 0 && h > 0);
-
         // Double-buffered rendering: draw to a local back buffer first, then
-        // copy the changed region to SHM in one shot.
+        // copy the changed rects to SHM in one shot.
         let back_buf = st.comp_windows[wi].back_buffer.as_mut_ptr();
         let full_surf = crate::draw::Surface::new(back_buf, sw, sh);
 
-        // CRITICAL: Clip the surface to the PHYSICAL dirty rect so that Window::render()
-        // (which fills the entire background) only touches pixels inside the dirty
-        // region. Pixels outside are retained from the previous frame.
-        let surf = if let Some((dx, dy, dw, dh)) = physical_dr {
-            full_surf.with_clip(dx, dy, dw, dh)
-        } else {
-            full_surf
-        };
+        // (logical, physical) rect pairs to repaint; empty for a full redraw.
+        let mut parts: [((i32, i32, u32, u32), (i32, i32, u32, u32)); MAX_DIRTY_RECTS] =
+            [((0, 0, 0, 0), (0, 0, 0, 0)); MAX_DIRTY_RECTS];
+        let mut part_count = 0;
+        if !region.is_full() {
+            for &(dx, dy, dw, dh) in region.rects() {
+                // Clamp in logical space (for render_tree intersection tests)
+                let x0 = dx.max(0) as u32;
+                let y0 = dy.max(0) as u32;
+                let x1 = ((dx + dw as i32).max(0) as u32).min(logical_w);
+                let y1 = ((dy + dh as i32).max(0) as u32).min(logical_h);
+                let (lw, lh) = (x1.saturating_sub(x0), y1.saturating_sub(y0));
+                if lw == 0 || lh == 0 {
+                    continue;
+                }
+                // Scale to physical space (for Surface clip, SHM copy, present_rect)
+                let px = crate::theme::scale_i32(x0 as i32).max(0);
+                let py = crate::theme::scale_i32(y0 as i32).max(0);
+                let pw = crate::theme::scale(lw).min(sw.saturating_sub(px as u32));
+                let ph = crate::theme::scale(lh).min(sh.saturating_sub(py as u32));
+                if pw == 0 || ph == 0 {
+                    continue;
+                }
+                parts[part_count] = ((x0 as i32, y0 as i32, lw, lh), (px, py, pw, ph));
+                part_count += 1;
+            }
+            if part_count == 0 {
+                // Only off-window or zero-sized controls changed.
+                clear_dirty(&mut st.controls, win_id);
+                st.comp_windows[wi].dirty = false;
+                st.comp_windows[wi].dirty_region.clear();
+                continue;
+            }
+        }
 
-        // Render control tree — only controls intersecting the LOGICAL dirty rect
-        // are drawn. The surface's physical clip rect ensures drawing ops outside
-        // the dirty region are discarded at the pixel level.
-        render_tree(&st.controls, win_id, &surf, 0, 0, logical_dr);
+        if part_count == 0 {
+            render_tree(&st.controls, win_id, &full_surf, 0, 0, None);
+        }
+        for &(logical_dr, (dx, dy, dw, dh)) in &parts[..part_count] {
+            // CRITICAL: Clip the surface to the PHYSICAL dirty rect so that Window::render()
+            // (which fills the entire background) only touches pixels inside the dirty
+            // region. Pixels outside are retained from the previous frame.
+            let surf = full_surf.with_clip(dx, dy, dw, dh);
+            // Only controls intersecting the LOGICAL dirty rect are drawn.
+            render_tree(&st.controls, win_id, &surf, 0, 0, Some(logical_dr));
+        }
 
-        // Copy back buffer → SHM: either the dirty region or the full buffer.
-        // Uses PHYSICAL dirty rect for pixel-level copy offsets.
+        // Copy back buffer → SHM: either the dirty rects or the full buffer.
+        // Uses PHYSICAL dirty rects for pixel-level copy offsets.
         unsafe {
-            if let Some((dx, dy, dw, dh)) = physical_dr {
-                // Partial copy: only the dirty region (row by row)
+            if part_count == 0 {
+                // Full copy (fallback for first frame, resize, etc.)
+                let pixel_count = (sw as usize) * (sh as usize);
+                core::ptr::copy_nonoverlapping(back_buf, surface_ptr, pixel_count);
+            }
+            for &(_, (dx, dy, dw, dh)) in &parts[..part_count] {
+                // Partial copy: only the dirty rect (row by row)
                 let dx = dx as usize;
                 let dy = dy as usize;
                 let dw = dw as usize;
@@ -1070,10 +1195,6 @@ pub fn run_once() -> u32 {
                         dw,
                     );
                 }
-            } else {
-                // Full copy (fallback for first frame, resize, etc.)
-                let pixel_count = (sw as usize) * (sh as usize);
-                core::ptr::copy_nonoverlapping(back_buf, surface_ptr, pixel_count);
             }
         }
 
@@ -1085,20 +1206,24 @@ pub fn run_once() -> u32 {
         // control calls mark_dirty() after clear_dirty), causing an infinite
         // render→present→frame_ack→render loop (~42 fps idle).
         st.comp_windows[wi].dirty = false;
-        st.comp_windows[wi].dirty_rect = None;
+        st.comp_windows[wi].dirty_region.clear();
 
-        // Present via compositor DLL — pass physical dirty rect if available so
-        // the compositor only copies and recomposites the changed region.
-        if let Some((dx, dy, dw, dh)) = physical_dr {
+        // Present via compositor DLL — one present_rect per physical dirty rect
+        // so the compositor only copies and recomposites the changed regions.
+        if part_count == 0 {
+            compositor::present(channel_id, comp_window_id, shm_id);
+        }
+        for &(_, (dx, dy, dw, dh)) in &parts[..part_count] {
             compositor::present_rect(
                 channel_id, comp_window_id, shm_id,
                 dx as u32, dy as u32, dw, dh,
             );
-        } else {
-            compositor::present(channel_id, comp_window_id, shm_id);
         }
         st.comp_windows[wi].frame_presented = true;
         st.comp_windows[wi].last_present_ms = crate::syscall::uptime_ms();
+        if !FIRST_FRAME_LOGGED.swap(true, Ordering::Relaxed) {
+            report_first_frame();
+        }
     }
 
     // ── Phase 4.1: Render popup (if active and dirty) ──────────────
@@ -1144,6 +1269,15 @@ pub fn run_once() -> u32 {
 
 // ── Helper functions ────────────────────────────────────────────────
 
+/// Log the spawn-to-first-frame time and report it on [`LAUNCH_CHANNEL`].
+fn report_first_frame() {
+    let ms = crate::syscall::ms_since_spawn();
+    crate::log!("[anyui] first frame {} ms after spawn", ms);
+    let chan = libsyscall::evt_chan_create(LAUNCH_CHANNEL.as_ptr(), LAUNCH_CHANNEL.len() as u32);
+    let event = [EVT_FIRST_FRAME, libsyscall::get_tid(), ms, crate::syscall::uptime_ms(), 0];
+    crate::syscall::evt_chan_emit(chan, &event);
+}
+
 fn fire_event_callback(
     controls: &[Box<dyn Control>],
     id: ControlId,
@@ -1315,29 +1449,104 @@ fn clear_dirty(controls: &mut [Box<dyn Control>], id: ControlId) {
 
 // ── Dirty rect collection ───────────────────────────────────────────
 
-/// Union two rects: expand `existing` to also cover `(x, y, w, h)`.
-fn union_rect(existing: Option<(i32, i32, u32, u32)>, x: i32, y: i32, w: u32, h: u32) -> (i32, i32, u32, u32) {
-    if w == 0 || h == 0 { return existing.unwrap_or((x, y, w, h)); }
-    match existing {
-        None => (x, y, w, h),
-        Some((ex, ey, ew, eh)) => {
-            let x0 = ex.min(x);
-            let y0 = ey.min(y);
-            let x1 = (ex + ew as i32).max(x + w as i32);
-            let y1 = (ey + eh as i32).max(y + h as i32);
-            (x0, y0, (x1 - x0).max(0) as u32, (y1 - y0).max(0) as u32)
+/// Maximum number of separate rects tracked per window per frame.
+const MAX_DIRTY_RECTS: usize = 4;
+
+/// Extra area (logical px²) two rects may waste when merged before they are
+/// kept apart. Neighbouring controls still merge into one rect.
+const DIRTY_MERGE_SLACK: u64 = 32 * 32;
+
+type Rect = (i32, i32, u32, u32);
+
+/// Dirty area of a window: either a full redraw, or up to `MAX_DIRTY_RECTS`
+/// rects. Far-apart changes (a caret blinking on one side, a hover on the
+/// other) stay separate, so neither drags the other's surroundings into
+/// the repaint.
+#[derive(Clone, Copy)]
+pub(crate) struct DirtyRegion {
+    rects: [Rect; MAX_DIRTY_RECTS],
+    count: usize,
+    full: bool,
+}
+
+impl DirtyRegion {
+    pub const fn full() -> Self {
+        Self { rects: [(0, 0, 0, 0); MAX_DIRTY_RECTS], count: 0, full: true }
+    }
+
+    pub fn clear(&mut self) {
+        self.count = 0;
+        self.full = false;
+    }
+
+    pub fn set_full(&mut self) {
+        self.count = 0;
+        self.full = true;
+    }
+
+    pub fn is_full(&self) -> bool {
+        self.full
+    }
+
+    pub fn rects(&self) -> &[Rect] {
+        &self.rects[..self.count]
+    }
+
+    /// Add a rect, merging it with any rect it overlaps or nearly touches.
+    /// When all slots are taken it merges with the rect it grows least.
+    pub fn add(&mut self, x: i32, y: i32, w: u32, h: u32) {
+        if self.full || w == 0 || h == 0 {
+            return;
+        }
+        let mut cur = (x, y, w, h);
+        loop {
+            let near = (0..self.count).find(|&i| {
+                let r = self.rects[i];
+                rects_intersect(r.0, r.1, r.2, r.3, cur.0, cur.1, cur.2, cur.3)
+                    || rect_area(union_rect(r, cur)) <= rect_area(r) + rect_area(cur) + DIRTY_MERGE_SLACK
+            });
+            let merge = match near {
+                Some(i) => Some(i),
+                None if self.count == MAX_DIRTY_RECTS => (0..self.count)
+                    .min_by_key(|&i| rect_area(union_rect(self.rects[i], cur)) - rect_area(self.rects[i])),
+                None => None,
+            };
+            match merge {
+                Some(i) => {
+                    // The grown rect may now reach others: re-insert it.
+                    cur = union_rect(self.rects[i], cur);
+                    self.count -= 1;
+                    self.rects[i] = self.rects[self.count];
+                }
+                None => break,
+            }
         }
+        self.rects[self.count] = cur;
+        self.count += 1;
     }
 }
 
+/// Smallest rect covering both `a` and `b`.
+fn union_rect(a: Rect, b: Rect) -> Rect {
+    let x0 = a.0.min(b.0);
+    let y0 = a.1.min(b.1);
+    let x1 = (a.0 + a.2 as i32).max(b.0 + b.2 as i32);
+    let y1 = (a.1 + a.3 as i32).max(b.1 + b.3 as i32);
+    (x0, y0, (x1 - x0).max(0) as u32, (y1 - y0).max(0) as u32)
+}
+
+fn rect_area(r: Rect) -> u64 {
+    r.2 as u64 * r.3 as u64
+}
+
 /// Check if two rectangles intersect.
 fn rects_intersect(ax: i32, ay: i32, aw: u32, ah: u32, bx: i32, by: i32, bw: u32, bh: u32) -> bool {
     ax < bx + bw as i32 && ax + aw as i32 > bx && ay < by + bh as i32 && ay + ah as i32 > by
 }
 
-/// Walk the control tree, compute absolute positions, and union dirty controls'
-/// bounding rects into `cw.dirty_rect`. If the root Window control itself is dirty,
-/// forces a full-window redraw (dirty_rect = None).
+/// Walk the control tree, compute absolute positions, and add dirty controls'
+/// bounding rects to `cw.dirty_region`. If the root Window control itself is
+/// dirty, forces a full-window redraw.
 fn collect_dirty_rects(
     controls: &[Box<dyn Control>],
     id: ControlId,
@@ -1358,7 +1567,7 @@ fn collect_dirty_rects(
             cw.dirty = true;
             let abs_x = parent_abs_x + b.x;
             let abs_y = parent_abs_y + b.y;
-            cw.dirty_rect = Some(union_rect(cw.dirty_rect, abs_x, abs_y, b.w, b.h));
+            cw.dirty_region.add(abs_x, abs_y, b.w, b.h);
         }
         return;
     }
@@ -1373,18 +1582,17 @@ fn collect_dirty_rects(
         // If the top-level Window control itself is dirty, force full redraw
         // (covers resize, theme changes, initial render).
         if controls[idx].kind() == ControlKind::Window {
-            cw.dirty_rect = None;
+            cw.dirty_region.set_full();
             return; // No need to recurse — full render
         }
 
-        // Union current bounds with dirty rect
-        cw.dirty_rect = Some(union_rect(cw.dirty_rect, abs_x, abs_y, b.w, b.h));
+        cw.dirty_region.add(abs_x, abs_y, b.w, b.h);
 
-        // If position or size changed, also union the old bounds to repaint the vacated area.
+        // If position or size changed, also add the old bounds to repaint the vacated area.
         if b.prev_x != b.x || b.prev_y != b.y || b.prev_w != b.w || b.prev_h != b.h {
             let prev_abs_x = parent_abs_x + b.prev_x;
             let prev_abs_y = parent_abs_y + b.prev_y;
-            cw.dirty_rect = Some(union_rect(cw.dirty_rect, prev_abs_x, prev_abs_y, b.prev_w, b.prev_h));
+            cw.dirty_region.add(prev_abs_x, prev_abs_y, b.prev_w, b.prev_h);
         }
     }
 
@@ -66,6 +66,7 @@ pub mod draw;
 mod event_loop;
 pub mod font_bitmap;
 mod layout;
+mod text_buffer;
 mod marshal;
 pub mod syscall;
 mod timer;
@@ -103,10 +104,10 @@ pub(crate) struct CompWindow {
     /// Window-level dirty flag: true if any control in this window's subtree is dirty.
     /// Computed in a flat O(n) scan, replacing the O(n²) recursive any_dirty() tree walk.
     pub dirty: bool,
-    /// Accumulated dirty region (union of all dirty controls' bounding rects).
-    /// `None` means full-window redraw (first frame, resize, etc.).
-    /// `Some((x, y, w, h))` in window-local coordinates for partial redraw.
-    pub dirty_rect: Option<(i32, i32, u32, u32)>,
+    /// Accumulated dirty region: a few rects in window-local logical
+    /// coordinates covering all dirty controls, or a full-window redraw
+    /// (first frame, resize, etc.).
+    pub dirty_region: event_loop::DirtyRegion,
     /// Local back buffer for flicker-free rendering. All drawing goes here first,
     /// then a single memcpy to SHM before present() — the compositor never sees
     /// a half-rendered frame (no background flash, no partial content).
@@ -153,6 +154,8 @@ pub(crate) struct AnyuiState {
     // ── Compositor connection ────────────────────────────────────────
     pub channel_id: u32,
     pub sub_id: u32,
+    /// Shared event ring of `sub_id` (0 = none, poll with syscalls).
+    pub evt_ring: usize,
 
     // ── Event tracking ──────────────────────────────────────────────
     /// Currently focused control (receives keyboard events).
@@ -271,6 +274,7 @@ pub extern "C" fn anyui_init() -> u32 {
             quit_requested: false,
             channel_id,
             sub_id,
+            evt_ring: syscall::evt_chan_ring(channel_id, sub_id),
             focused: None,
             pressed: None,
             hovered: None,
@@ -379,7 +383,7 @@ pub extern "C" fn anyui_create_window(
         frame_presented: false,
         last_present_ms: 0,
         dirty: true,
-        dirty_rect: None,
+        dirty_region: event_loop::DirtyRegion::full(),
         back_buffer: alloc::vec![0u32; pixel_count],
     });
     id
@@ -1212,7 +1216,7 @@ pub extern "C" fn anyui_iconbutton_set_pixels(id: ControlId, data: *const u32, w
 
 // ── DataGrid ─────────────────────────────────────────────────────────
 
-fn as_data_grid(ctrl: &mut alloc::boxed::Box<dyn Control>) -> Option<&mut controls::data_grid::DataGrid> {
+pub(crate) fn as_data_grid(ctrl: &mut alloc::boxed::Box<dyn Control>) -> Option<&mut controls::data_grid::DataGrid> {
     if ctrl.kind() == ControlKind::DataGrid {
         let raw: *mut dyn Control = &mut **ctrl;
         Some(unsafe { &mut *(raw as *mut controls::data_grid::DataGrid) })
@@ -1582,6 +1586,82 @@ pub extern "C" fn anyui_datagrid_set_connector_column(id: ControlId, col: u32) {
     }
 }
 
+// ── DataGrid virtual mode ───────────────────────────────────────
+
+/// Switch a DataGrid into (enabled=1) or out of virtual mode. In virtual
+/// mode the grid keeps only rows near the viewport; set the total with
+/// `anyui_datagrid_set_row_count` and answer `EVENT_DATA_REQUEST` with
+/// `anyui_datagrid_set_rows`. The owner sorts and filters.
+#[no_mangle]
+pub extern "C" fn anyui_datagrid_set_virtual(id: ControlId, enabled: u32) {
+    let st = state();
+    if let Some(ctrl) = st.controls.iter_mut().find(|c| c.id() == id) {
+        if let Some(dg) = as_data_grid(ctrl) {
+            dg.set_virtual(enabled != 0);
+        }
+    }
+}
+
+/// Read the outstanding row request into `out[0..4]`: first row, row count,
+/// sort column (logical, u32::MAX = unsorted), sort direction (0 none,
+/// 1 ascending, 2 descending). Returns 0 if there is none.
+#[no_mangle]
+pub extern "C" fn anyui_datagrid_get_data_request(id: ControlId, out: *mut u32) -> u32 {
+    let st = state();
+    if let Some(ctrl) = st.controls.iter().find(|c| c.id() == id) {
+        if let Some(dg) = as_data_grid_ref(ctrl) {
+            if let Some((first, count, col, dir)) = dg.data_request() {
+                if !out.is_null() {
+                    unsafe {
+                        *out = first;
+                        *out.add(1) = count;
+                        *out.add(2) = col;
+                        *out.add(3) = dir;
+                    }
+                }
+                return 1;
+            }
+        }
+    }
+    0
+}
+
+/// Supply rows `first..` of a virtual DataGrid (rows separated by 0x1E,
+/// cells by 0x1F). `colors` holds optional per-cell text colors
+/// (row-major, 0 = default); pass null/0 for none.
+#[no_mangle]
+pub extern "C" fn anyui_datagrid_set_rows(
+    id: ControlId, first: u32, data: *const u8, len: u32, colors: *const u32, color_count: u32,
+) {
+    let st = state();
+    if let Some(ctrl) = st.controls.iter_mut().find(|c| c.id() == id) {
+        if let Some(dg) = as_data_grid(ctrl) {
+            let data = if !data.is_null() && len > 0 {
+                unsafe { core::slice::from_raw_parts(data, len as usize) }
+            } else {
+                &[]
+            };
+            let colors = if !colors.is_null() && color_count > 0 {
+                unsafe { core::slice::from_raw_parts(colors, color_count as usize) }
+            } else {
+                &[]
+            };
+            dg.set_rows(first as usize, data, colors);
+        }
+    }
+}
+
+/// Drop the cached rows of a virtual DataGrid (its data changed).
+#[no_mangle]
+pub extern "C" fn anyui_datagrid_invalidate_rows(id: ControlId) {
+    let st = state();
+    if let Some(ctrl) = st.controls.iter_mut().find(|c| c.id() == id) {
+        if let Some(dg) = as_data_grid(ctrl) {
+            dg.invalidate_rows();
+        }
+    }
+}
+
 // ── TextEditor ────────────────────────────────────────────────────────
 
 fn as_text_editor(ctrl: &mut alloc::boxed::Box<dyn Control>) -> Option<&mut controls::text_editor::TextEditor> {
@@ -2411,7 +2491,7 @@ pub extern "C" fn anyui_resize_window(win_id: ControlId, new_w: u32, new_h: u32)
         let new_count = (phys_w as usize) * (phys_h as usize);
         cw.back_buffer.resize(new_count, 0);
         cw.dirty = true;
-        cw.dirty_rect = None; // full redraw
+        cw.dirty_region.set_full();
     }
     // Control tree uses logical dimensions.
     if let Some(ctrl) = st.controls.iter_mut().find(|c| c.id() == win_id) {
@@ -1,9 +1,10 @@
 //! Syscall wrappers for libanyui — delegates to libsyscall.
 
 pub use libsyscall::{
-    exit, yield_cpu, sleep, sbrk, mmap, munmap, uptime_ms,
+    exit, yield_cpu, sleep, sbrk, mmap, munmap, uptime_ms, ms_since_spawn,
     dll_load, readdir, getcwd, write, open, read, close,
     evt_chan_poll, evt_chan_wait, evt_chan_emit,
+    evt_chan_poll_batch, evt_chan_ring, evt_ring_pop, evt_ring_spilled,
 };
 
 /// Create a directory (accepts &[u8] path).
@@ -0,0 +1,238 @@
+//! TextBuffer — piece table with a line index, backing the TextEditor control.
+//!
+//! The document is described by a list of pieces, each referencing a span of
+//! either the immutable `original` text (as loaded by `set_text`) or the
+//! append-only `added` buffer that receives every inserted byte. Inserting or
+//! deleting only splits and removes pieces; file contents are never moved.
+//!
+//! `line_starts` holds the byte offset of every line start, so row/column to
+//! offset conversions are O(1) and offset to row is a binary search. An edit
+//! shifts the entries after the edited line and splices in or out the starts
+//! of inserted or removed lines.
+
+use alloc::vec;
+use alloc::vec::Vec;
+
+#[derive(Clone, Copy, PartialEq)]
+enum Source {
+    Original,
+    Added,
+}
+
+#[derive(Clone, Copy)]
+struct Piece {
+    src: Source,
+    start: usize,
+    len: usize,
+}
+
+pub(crate) struct TextBuffer {
+    original: Vec<u8>,
+    added: Vec<u8>,
+    pieces: Vec<Piece>,
+    /// Offset of the first byte of each line; `line_starts[0]` is always 0.
+    line_starts: Vec<usize>,
+    len: usize,
+}
+
+impl TextBuffer {
+    pub fn new() -> Self {
+        Self {
+            original: Vec::new(),
+            added: Vec::new(),
+            pieces: Vec::new(),
+            line_starts: vec![0],
+            len: 0,
+        }
+    }
+
+    /// Build a buffer from `text`, dropping carriage returns.
+    pub fn from_bytes(text: &[u8]) -> Self {
+        let mut original = Vec::with_capacity(text.len());
+        let mut line_starts = vec![0];
+        for &b in text {
+            if b == b'\r' {
+                continue;
+            }
+            original.push(b);
+            if b == b'\n' {
+                line_starts.push(original.len());
+            }
+        }
+        let len = original.len();
+        let pieces = if len > 0 {
+            vec![Piece { src: Source::Original, start: 0, len }]
+        } else {
+            Vec::new()
+        };
+        Self { original, added: Vec::new(), pieces, line_starts, len }
+    }
+
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    pub fn line_count(&self) -> usize {
+        self.line_starts.len()
+    }
+
+    /// Length of `row` in bytes, excluding its newline.
+    pub fn line_len(&self, row: usize) -> usize {
+        let start = self.line_starts[row];
+        let end = match self.line_starts.get(row + 1) {
+            Some(&next) => next - 1,
+            None => self.len,
+        };
+        end - start
+    }
+
+    /// Byte offset of (row, col), clamped to the document and the line.
+    pub fn offset_of(&self, row: usize, col: usize) -> usize {
+        let row = row.min(self.line_count() - 1);
+        self.line_starts[row] + col.min(self.line_len(row))
+    }
+
+    /// Row containing byte `offset`.
+    pub fn row_of(&self, offset: usize) -> usize {
+        match self.line_starts.binary_search(&offset) {
+            Ok(row) => row,
+            Err(next) => next - 1,
+        }
+    }
+
+    /// (row, col) of byte `offset`.
+    pub fn position_of(&self, offset: usize) -> (usize, usize) {
+        let offset = offset.min(self.len);
+        let row = self.row_of(offset);
+        (row, offset - self.line_starts[row])
+    }
+
+    /// Replace `out` with the contents of `row`, excluding its newline.
+    pub fn line_into(&self, row: usize, out: &mut Vec<u8>) {
+        out.clear();
+        let start = self.line_starts[row];
+        self.append_range(start, start + self.line_len(row), out);
+    }
+
+    /// Append bytes `start..end` of the document to `out`.
+    pub fn append_range(&self, start: usize, end: usize, out: &mut Vec<u8>) {
+        let end = end.min(self.len);
+        if start >= end {
+            return;
+        }
+        let mut pos = 0;
+        for p in &self.pieces {
+            let p_end = pos + p.len;
+            if p_end > start {
+                let from = start.max(pos) - pos;
+                let to = end.min(p_end) - pos;
+                let data = self.source(p.src);
+                out.extend_from_slice(&data[p.start + from..p.start + to]);
+            }
+            if p_end >= end {
+                break;
+            }
+            pos = p_end;
+        }
+    }
+
+    pub fn to_vec(&self) -> Vec<u8> {
+        let mut out = Vec::with_capacity(self.len);
+        self.append_range(0, self.len, &mut out);
+        out
+    }
+
+    /// Insert `text` at byte `offset` (clamped to the end of the document).
+    pub fn insert(&mut self, offset: usize, text: &[u8]) {
+        if text.is_empty() {
+            return;
+        }
+        let offset = offset.min(self.len);
+        let add_start = self.added.len();
+        self.added.extend_from_slice(text);
+
+        // Typing appends to the piece that was just inserted: grow it in
+        // place instead of adding a new piece for every keystroke.
+        let mut extended = false;
+        let mut pos = 0;
+        for p in self.pieces.iter_mut() {
+            pos += p.len;
+            if pos == offset {
+                if p.src == Source::Added && p.start + p.len == add_start {
+                    p.len += text.len();
+                    extended = true;
+                }
+                break;
+            }
+            if pos > offset {
+                break;
+            }
+        }
+        if !extended {
+            let idx = self.split_at(offset);
+            self.pieces.insert(idx, Piece { src: Source::Added, start: add_start, len: text.len() });
+        }
+
+        let row = self.row_of(offset);
+        for s in &mut self.line_starts[row + 1..] {
+            *s += text.len();
+        }
+        let new_starts = text
+            .iter()
+            .enumerate()
+            .filter(|&(_, &b)| b == b'\n')
+            .map(|(i, _)| offset + i + 1);
+        self.line_starts.splice(row + 1..row + 1, new_starts);
+        self.len += text.len();
+    }
+
+    /// Delete bytes `start..end`, appending the removed text to `removed`.
+    pub fn delete(&mut self, start: usize, end: usize, removed: &mut Vec<u8>) {
+        let end = end.min(self.len);
+        if start >= end {
+            return;
+        }
+        let first_removed = removed.len();
+        self.append_range(start, end, removed);
+        let newlines = removed[first_removed..].iter().filter(|&&b| b == b'\n').count();
+
+        let i0 = self.split_at(start);
+        let i1 = self.split_at(end);
+        self.pieces.drain(i0..i1);
+
+        let row = self.row_of(start);
+        self.line_starts.drain(row + 1..row + 1 + newlines);
+        let n = end - start;
+        for s in &mut self.line_starts[row + 1..] {
+            *s -= n;
+        }
+        self.len -= n;
+    }
+
+    fn source(&self, src: Source) -> &[u8] {
+        match src {
+            Source::Original => &self.original,
+            Source::Added => &self.added,
+        }
+    }
+
+    /// Ensure a piece boundary at `offset` and return the index of the first
+    /// piece starting there (`pieces.len()` at the end of the document).
+    fn split_at(&mut self, offset: usize) -> usize {
+        let mut pos = 0;
+        for i in 0..self.pieces.len() {
+            if pos == offset {
+                return i;
+            }
+            let p = self.pieces[i];
+            if offset < pos + p.len {
+                let head = offset - pos;
+                self.pieces[i].len = head;
+                self.pieces.insert(i + 1, Piece { src: p.src, start: p.start + head, len: p.len - head });
+                return i + 1;
+            }
+            pos += p.len;
+        }
+        self.pieces.len()
+    }
+}
@@ -1,6 +1,6 @@
 use alloc::vec::Vec;
 use crate::{Control, Widget, lib, events, KIND_DATA_GRID};
-use crate::events::SelectionChangedEvent;
+use crate::events::{DataRequestEvent, SelectionChangedEvent};
 
 leaf_control!(DataGrid, KIND_DATA_GRID);
 
@@ -270,6 +270,64 @@ impl DataGrid {
     pub fn set_connector_column(&self, col: u32) {
         (lib().datagrid_set_connector_column)(self.ctrl.id, col);
     }
+
+    // ── Virtual mode ──
+
+    /// Switch to virtual mode: the grid keeps only rows near the viewport
+    /// and asks for the rest through `on_data_request`. Set the total with
+    /// `set_row_count`. Sorting is delegated: a header click (or `sort`)
+    /// drops the cached rows and requests them again with the new sort
+    /// column, which the owner applies to its data. Filtering is the
+    /// owner's too: change the row count and call `invalidate_rows`.
+    pub fn set_virtual(&self, enabled: bool) {
+        (lib().datagrid_set_virtual)(self.ctrl.id, enabled as u32);
+    }
+
+    /// Register the virtual-mode row supplier. Answer with `set_rows` for
+    /// `first..first + count`, normally before returning.
+    pub fn on_data_request(&self, mut f: impl FnMut(&DataRequestEvent) + 'static) {
+        let (thunk, ud) = events::register(move |id, _| {
+            let mut req = [0u32; 4];
+            if (lib().datagrid_get_data_request)(id, req.as_mut_ptr()) != 0 {
+                f(&DataRequestEvent {
+                    id,
+                    first: req[0],
+                    count: req[1],
+                    sort_column: req[2],
+                    sort_direction: req[3],
+                });
+            }
+        });
+        (lib().on_event_fn)(self.ctrl.id, crate::EVENT_DATA_REQUEST, thunk, ud);
+    }
+
+    /// Virtual mode: supply rows starting at `first`.
+    pub fn set_rows(&self, first: u32, rows: &[Vec<&str>]) {
+        let mut buf = Vec::new();
+        for (ri, row) in rows.iter().enumerate() {
+            if ri > 0 { buf.push(0x1E); }
+            for (ci, cell) in row.iter().enumerate() {
+                if ci > 0 { buf.push(0x1F); }
+                buf.extend_from_slice(cell.as_bytes());
+            }
+        }
+        self.set_rows_raw(first, &buf, &[]);
+    }
+
+    /// Virtual mode: supply pre-encoded rows starting at `first` (rows
+    /// separated by 0x1E, cells by 0x1F), with optional per-cell ARGB text
+    /// colors (row-major over the supplied rows, 0 = default).
+    pub fn set_rows_raw(&self, first: u32, data: &[u8], colors: &[u32]) {
+        (lib().datagrid_set_rows)(
+            self.ctrl.id, first, data.as_ptr(), data.len() as u32,
+            colors.as_ptr(), colors.len() as u32,
+        );
+    }
+
+    /// Virtual mode: drop the cached rows; visible rows are requested again.
+    pub fn invalidate_rows(&self) {
+        (lib().datagrid_invalidate_rows)(self.ctrl.id);
+    }
 }
 
 fn write_u32_ascii(buf: &mut Vec<u8>, val: u32) {
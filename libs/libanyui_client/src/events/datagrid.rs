@@ -0,0 +1,14 @@
+/// Data request event — fired by a DataGrid in virtual mode when the
+/// viewport reaches rows it does not hold.
+pub struct DataRequestEvent {
+    /// The control ID.
+    pub id: u32,
+    /// First requested row (in the owner's sorted, filtered order).
+    pub first: u32,
+    /// Number of requested rows.
+    pub count: u32,
+    /// Column to sort by (logical index), or `u32::MAX` if unsorted.
+    pub sort_column: u32,
+    /// SORT_NONE, SORT_ASCENDING or SORT_DESCENDING.
+    pub sort_direction: u32,
+}
@@ -11,10 +11,12 @@ use alloc::vec::Vec;
 
 pub mod shared;
 mod color;
+mod datagrid;
 
 // Re-export all event types at the events:: level
 pub use shared::*;
 pub use color::ColorSelectedEvent;
+pub use datagrid::DataRequestEvent;
 
 // ══════════════════════════════════════════════════════════════════════
 //  Closure Registry
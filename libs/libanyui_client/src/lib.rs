@@ -38,7 +38,7 @@ pub use icon::{Icon, IconType};
 
 pub mod theme;
 
-use dynlink::{DlHandle, dl_open, dl_sym};
+use dynlink::{DlHandle, LazySym, dl_open};
 
 // ── Control kind constants (match libanyui's ControlKind enum) ───────
 
@@ -119,6 +119,7 @@ pub const EVENT_MOUSE_DOWN: u32 = 14;
 pub const EVENT_MOUSE_UP: u32 = 15;
 pub const EVENT_MOUSE_MOVE: u32 = 16;
 pub const EVENT_SUBMIT: u32 = 17;
+pub const EVENT_DATA_REQUEST: u32 = 18;
 
 /// Callback type: extern "C" fn(control_id: u32, event_type: u32, userdata: u64)
 pub type Callback = extern "C" fn(u32, u32, u64);
@@ -128,233 +129,228 @@ pub type Callback = extern "C" fn(u32, u32, u64);
 // ══════════════════════════════════════════════════════════════════════
 
 struct AnyuiLib {
-    _handle: DlHandle,
     // Core
-    init: extern "C" fn() -> u32,
-    shutdown: extern "C" fn(),
-    create_window: extern "C" fn(*const u8, u32, i32, i32, u32, u32, u32) -> u32,
-    add_control: extern "C" fn(u32, u32, i32, i32, u32, u32, *const u8, u32) -> u32,
-    create_control: extern "C" fn(u32, *const u8, u32) -> u32,
-    add_child: extern "C" fn(u32, u32),
-    set_text: extern "C" fn(u32, *const u8, u32),
-    get_text: extern "C" fn(u32, *mut u8, u32) -> u32,
-    set_position: extern "C" fn(u32, i32, i32),
-    set_size: extern "C" fn(u32, u32, u32),
-    set_visible: extern "C" fn(u32, u32),
-    set_color: extern "C" fn(u32, u32),
-    set_state: extern "C" fn(u32, u32),
-    get_state: extern "C" fn(u32) -> u32,
-    on_event_fn: extern "C" fn(u32, u32, Callback, u64),
-    on_click_fn: extern "C" fn(u32, Callback, u64),
-    on_change_fn: extern "C" fn(u32, Callback, u64),
-    on_submit_fn: extern "C" fn(u32, Callback, u64),
-    run_fn: extern "C" fn(),
-    run_once_fn: extern "C" fn() -> u32,
-    quit_fn: extern "C" fn(),
-    remove_fn: extern "C" fn(u32),
-    remove_child_fn: extern "C" fn(u32, u32),
-    clear_children_fn: extern "C" fn(u32),
-    destroy_window: extern "C" fn(u32),
-    resize_window: extern "C" fn(u32, u32, u32),
-    move_window: extern "C" fn(u32, i32, i32),
-    minimize_window: extern "C" fn(u32),
+    init: LazySym<extern "C" fn() -> u32>,
+    shutdown: LazySym<extern "C" fn()>,
+    create_window: LazySym<extern "C" fn(*const u8, u32, i32, i32, u32, u32, u32) -> u32>,
+    add_control: LazySym<extern "C" fn(u32, u32, i32, i32, u32, u32, *const u8, u32) -> u32>,
+    create_control: LazySym<extern "C" fn(u32, *const u8, u32) -> u32>,
+    add_child: LazySym<extern "C" fn(u32, u32)>,
+    set_text: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    get_text: LazySym<extern "C" fn(u32, *mut u8, u32) -> u32>,
+    set_position: LazySym<extern "C" fn(u32, i32, i32)>,
+    set_size: LazySym<extern "C" fn(u32, u32, u32)>,
+    set_visible: LazySym<extern "C" fn(u32, u32)>,
+    set_color: LazySym<extern "C" fn(u32, u32)>,
+    set_state: LazySym<extern "C" fn(u32, u32)>,
+    get_state: LazySym<extern "C" fn(u32) -> u32>,
+    on_event_fn: LazySym<extern "C" fn(u32, u32, Callback, u64)>,
+    on_click_fn: LazySym<extern "C" fn(u32, Callback, u64)>,
+    on_change_fn: LazySym<extern "C" fn(u32, Callback, u64)>,
+    on_submit_fn: LazySym<extern "C" fn(u32, Callback, u64)>,
+    run_fn: LazySym<extern "C" fn()>,
+    run_once_fn: LazySym<extern "C" fn() -> u32>,
+    quit_fn: LazySym<extern "C" fn()>,
+    remove_fn: LazySym<extern "C" fn(u32)>,
+    remove_child_fn: LazySym<extern "C" fn(u32, u32)>,
+    clear_children_fn: LazySym<extern "C" fn(u32)>,
+    destroy_window: LazySym<extern "C" fn(u32)>,
+    resize_window: LazySym<extern "C" fn(u32, u32, u32)>,
+    move_window: LazySym<extern "C" fn(u32, i32, i32)>,
+    minimize_window: LazySym<extern "C" fn(u32)>,
     // Layout
-    set_padding: extern "C" fn(u32, i32, i32, i32, i32),
-    set_margin: extern "C" fn(u32, i32, i32, i32, i32),
-    set_dock: extern "C" fn(u32, u32),
-    set_disabled: extern "C" fn(u32, u32),
-    set_auto_size: extern "C" fn(u32, u32),
-    set_min_size: extern "C" fn(u32, u32, u32),
-    set_max_size: extern "C" fn(u32, u32, u32),
+    set_padding: LazySym<extern "C" fn(u32, i32, i32, i32, i32)>,
+    set_margin: LazySym<extern "C" fn(u32, i32, i32, i32, i32)>,
+    set_dock: LazySym<extern "C" fn(u32, u32)>,
+    set_disabled: LazySym<extern "C" fn(u32, u32)>,
+    set_auto_size: LazySym<extern "C" fn(u32, u32)>,
+    set_min_size: LazySym<extern "C" fn(u32, u32, u32)>,
+    set_max_size: LazySym<extern "C" fn(u32, u32, u32)>,
     // Text styling
-    set_font_size: extern "C" fn(u32, u32),
-    get_font_size: extern "C" fn(u32) -> u32,
-    set_font: extern "C" fn(u32, u32),
-    set_text_color: extern "C" fn(u32, u32),
+    set_font_size: LazySym<extern "C" fn(u32, u32)>,
+    get_font_size: LazySym<extern "C" fn(u32) -> u32>,
+    set_font: LazySym<extern "C" fn(u32, u32)>,
+    set_text_color: LazySym<extern "C" fn(u32, u32)>,
     // Container properties
-    set_orientation: extern "C" fn(u32, u32),
-    set_columns: extern "C" fn(u32, u32),
-    set_row_height: extern "C" fn(u32, u32),
-    set_column_widths: extern "C" fn(u32, *const u32, u32),
+    set_orientation: LazySym<extern "C" fn(u32, u32)>,
+    set_columns: LazySym<extern "C" fn(u32, u32)>,
+    set_row_height: LazySym<extern "C" fn(u32, u32)>,
+    set_column_widths: LazySym<extern "C" fn(u32, *const u32, u32)>,
     // SplitView properties
-    set_split_ratio: extern "C" fn(u32, u32),
-    set_min_split: extern "C" fn(u32, u32),
-    set_max_split: extern "C" fn(u32, u32),
+    set_split_ratio: LazySym<extern "C" fn(u32, u32)>,
+    set_min_split: LazySym<extern "C" fn(u32, u32)>,
+    set_max_split: LazySym<extern "C" fn(u32, u32)>,
     // Canvas
-    canvas_set_pixel: extern "C" fn(u32, i32, i32, u32),
-    canvas_clear: extern "C" fn(u32, u32),
-    canvas_fill_rect: extern "C" fn(u32, i32, i32, u32, u32, u32),
-    canvas_draw_line: extern "C" fn(u32, i32, i32, i32, i32, u32),
-    canvas_draw_rect: extern "C" fn(u32, i32, i32, u32, u32, u32, u32),
-    canvas_draw_circle: extern "C" fn(u32, i32, i32, i32, u32),
-    canvas_fill_circle: extern "C" fn(u32, i32, i32, i32, u32),
-    canvas_get_buffer: extern "C" fn(u32) -> *mut u32,
-    canvas_get_stride: extern "C" fn(u32) -> u32,
-    canvas_get_height: extern "C" fn(u32) -> u32,
+    canvas_set_pixel: LazySym<extern "C" fn(u32, i32, i32, u32)>,
+    canvas_clear: LazySym<extern "C" fn(u32, u32)>,
+    canvas_fill_rect: LazySym<extern "C" fn(u32, i32, i32, u32, u32, u32)>,
+    canvas_draw_line: LazySym<extern "C" fn(u32, i32, i32, i32, i32, u32)>,
+    canvas_draw_rect: LazySym<extern "C" fn(u32, i32, i32, u32, u32, u32, u32)>,
+    canvas_draw_circle: LazySym<extern "C" fn(u32, i32, i32, i32, u32)>,
+    canvas_fill_circle: LazySym<extern "C" fn(u32, i32, i32, i32, u32)>,
+    canvas_get_buffer: LazySym<extern "C" fn(u32) -> *mut u32>,
+    canvas_get_stride: LazySym<extern "C" fn(u32) -> u32>,
+    canvas_get_height: LazySym<extern "C" fn(u32) -> u32>,
     // Canvas extensions
-    canvas_set_interactive: extern "C" fn(u32, u32),
-    canvas_get_mouse: extern "C" fn(u32, *mut i32, *mut i32, *mut u32),
-    canvas_fill_ellipse: extern "C" fn(u32, i32, i32, i32, i32, u32),
-    canvas_draw_ellipse: extern "C" fn(u32, i32, i32, i32, i32, u32),
-    canvas_flood_fill: extern "C" fn(u32, i32, i32, u32),
-    canvas_draw_thick_line: extern "C" fn(u32, i32, i32, i32, i32, u32, u32),
-    canvas_get_pixel: extern "C" fn(u32, i32, i32) -> u32,
-    canvas_copy_from: extern "C" fn(u32, *const u32, u32),
-    canvas_copy_to: extern "C" fn(u32, *mut u32, u32) -> u32,
+    canvas_set_interactive: LazySym<extern "C" fn(u32, u32)>,
+    canvas_get_mouse: LazySym<extern "C" fn(u32, *mut i32, *mut i32, *mut u32)>,
+    canvas_fill_ellipse: LazySym<extern "C" fn(u32, i32, i32, i32, i32, u32)>,
+    canvas_draw_ellipse: LazySym<extern "C" fn(u32, i32, i32, i32, i32, u32)>,
+    canvas_flood_fill: LazySym<extern "C" fn(u32, i32, i32, u32)>,
+    canvas_draw_thick_line: LazySym<extern "C" fn(u32, i32, i32, i32, i32, u32, u32)>,
+    canvas_get_pixel: LazySym<extern "C" fn(u32, i32, i32) -> u32>,
+    canvas_copy_from: LazySym<extern "C" fn(u32, *const u32, u32)>,
+    canvas_copy_to: LazySym<extern "C" fn(u32, *mut u32, u32) -> u32>,
     // TextField-specific
-    textfield_set_prefix: extern "C" fn(u32, u32),
-    textfield_set_postfix: extern "C" fn(u32, u32),
-    textfield_set_password: extern "C" fn(u32, u32),
-    textfield_set_placeholder: extern "C" fn(u32, *const u8, u32),
-    textfield_select_all: extern "C" fn(u32),
+    textfield_set_prefix: LazySym<extern "C" fn(u32, u32)>,
+    textfield_set_postfix: LazySym<extern "C" fn(u32, u32)>,
+    textfield_set_password: LazySym<extern "C" fn(u32, u32)>,
+    textfield_set_placeholder: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    textfield_select_all: LazySym<extern "C" fn(u32)>,
     // Marshal (cross-thread)
-    marshal_set_text: extern "C" fn(u32, *const u8, u32),
-    marshal_set_color: extern "C" fn(u32, u32),
-    marshal_set_state: extern "C" fn(u32, u32),
-    marshal_set_visible: extern "C" fn(u32, u32),
-    marshal_set_position: extern "C" fn(u32, i32, i32),
-    marshal_set_size: extern "C" fn(u32, u32, u32),
-    marshal_dispatch: extern "C" fn(extern "C" fn(u64), u64),
+    marshal_set_text: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    marshal_set_color: LazySym<extern "C" fn(u32, u32)>,
+    marshal_set_state: LazySym<extern "C" fn(u32, u32)>,
+    marshal_set_visible: LazySym<extern "C" fn(u32, u32)>,
+    marshal_set_position: LazySym<extern "C" fn(u32, i32, i32)>,
+    marshal_set_size: LazySym<extern "C" fn(u32, u32, u32)>,
+    marshal_dispatch: LazySym<extern "C" fn(extern "C" fn(u64), u64)>,
     // Context menu
-    set_context_menu: extern "C" fn(u32, u32),
+    set_context_menu: LazySym<extern "C" fn(u32, u32)>,
     // Tooltip
-    set_tooltip: extern "C" fn(u32, *const u8, u32),
+    set_tooltip: LazySym<extern "C" fn(u32, *const u8, u32)>,
     // MessageBox
-    message_box: extern "C" fn(u32, *const u8, u32, *const u8, u32),
+    message_box: LazySym<extern "C" fn(u32, *const u8, u32, *const u8, u32)>,
     // IconButton
-    iconbutton_set_pixels: extern "C" fn(u32, *const u32, u32, u32),
+    iconbutton_set_pixels: LazySym<extern "C" fn(u32, *const u32, u32, u32)>,
     // ImageView
-    imageview_set_pixels: extern "C" fn(u32, *const u32, u32, u32),
-    imageview_set_scale_mode: extern "C" fn(u32, u32),
-    imageview_get_image_size: extern "C" fn(u32, *mut u32, *mut u32) -> u32,
-    imageview_clear: extern "C" fn(u32),
+    imageview_set_pixels: LazySym<extern "C" fn(u32, *const u32, u32, u32)>,
+    imageview_set_scale_mode: LazySym<extern "C" fn(u32, u32)>,
+    imageview_get_image_size: LazySym<extern "C" fn(u32, *mut u32, *mut u32) -> u32>,
+    imageview_clear: LazySym<extern "C" fn(u32)>,
     // DataGrid
-    datagrid_set_columns: extern "C" fn(u32, *const u8, u32),
-    datagrid_get_column_count: extern "C" fn(u32) -> u32,
-    datagrid_set_column_width: extern "C" fn(u32, u32, u32),
-    datagrid_set_column_sort_type: extern "C" fn(u32, u32, u32),
-    datagrid_set_data: extern "C" fn(u32, *const u8, u32),
-    datagrid_set_cell: extern "C" fn(u32, u32, u32, *const u8, u32),
-    datagrid_get_cell: extern "C" fn(u32, u32, u32, *mut u8, u32) -> u32,
-    datagrid_set_cell_colors: extern "C" fn(u32, *const u32, u32),
-    datagrid_set_cell_bg_colors: extern "C" fn(u32, *const u32, u32),
-    datagrid_set_row_count: extern "C" fn(u32, u32),
-    datagrid_get_row_count: extern "C" fn(u32) -> u32,
-    datagrid_set_selection_mode: extern "C" fn(u32, u32),
-    datagrid_get_selected_row: extern "C" fn(u32) -> u32,
-    datagrid_set_selected_row: extern "C" fn(u32, u32),
-    datagrid_is_row_selected: extern "C" fn(u32, u32) -> u32,
-    datagrid_sort: extern "C" fn(u32, u32, u32),
-    datagrid_set_row_height: extern "C" fn(u32, u32),
-    datagrid_set_header_height: extern "C" fn(u32, u32),
-    datagrid_set_char_colors: extern "C" fn(u32, *const u32, u32, *const u32, u32),
-    datagrid_set_cell_icon: extern "C" fn(u32, u32, u32, *const u32, u32, u32),
-    datagrid_set_minimap: extern "C" fn(u32, *const u32, u32),
-    datagrid_get_click_col: extern "C" fn(u32) -> i32,
-    datagrid_set_connectors: extern "C" fn(u32, *const u8, u32),
-    datagrid_set_connector_column: extern "C" fn(u32, u32),
+    datagrid_set_columns: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    datagrid_get_column_count: LazySym<extern "C" fn(u32) -> u32>,
+    datagrid_set_column_width: LazySym<extern "C" fn(u32, u32, u32)>,
+    datagrid_set_column_sort_type: LazySym<extern "C" fn(u32, u32, u32)>,
+    datagrid_set_data: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    datagrid_set_cell: LazySym<extern "C" fn(u32, u32, u32, *const u8, u32)>,
+    datagrid_get_cell: LazySym<extern "C" fn(u32, u32, u32, *mut u8, u32) -> u32>,
+    datagrid_set_cell_colors: LazySym<extern "C" fn(u32, *const u32, u32)>,
+    datagrid_set_cell_bg_colors: LazySym<extern "C" fn(u32, *const u32, u32)>,
+    datagrid_set_row_count: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_get_row_count: LazySym<extern "C" fn(u32) -> u32>,
+    datagrid_set_selection_mode: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_get_selected_row: LazySym<extern "C" fn(u32) -> u32>,
+    datagrid_set_selected_row: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_is_row_selected: LazySym<extern "C" fn(u32, u32) -> u32>,
+    datagrid_sort: LazySym<extern "C" fn(u32, u32, u32)>,
+    datagrid_set_row_height: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_set_header_height: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_set_char_colors: LazySym<extern "C" fn(u32, *const u32, u32, *const u32, u32)>,
+    datagrid_set_cell_icon: LazySym<extern "C" fn(u32, u32, u32, *const u32, u32, u32)>,
+    datagrid_set_minimap: LazySym<extern "C" fn(u32, *const u32, u32)>,
+    datagrid_get_click_col: LazySym<extern "C" fn(u32) -> i32>,
+    datagrid_set_connectors: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    datagrid_set_connector_column: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_set_virtual: LazySym<extern "C" fn(u32, u32)>,
+    datagrid_get_data_request: LazySym<extern "C" fn(u32, *mut u32) -> u32>,
+    datagrid_set_rows: LazySym<extern "C" fn(u32, u32, *const u8, u32, *const u32, u32)>,
+    datagrid_invalidate_rows: LazySym<extern "C" fn(u32)>,
     // TextEditor
-    texteditor_set_text: extern "C" fn(u32, *const u8, u32),
-    texteditor_get_text: extern "C" fn(u32, *mut u8, u32) -> u32,
-    texteditor_set_syntax: extern "C" fn(u32, *const u8, u32),
-    texteditor_set_cursor: extern "C" fn(u32, u32, u32),
-    texteditor_get_cursor: extern "C" fn(u32, *mut u32, *mut u32),
-    texteditor_set_line_height: extern "C" fn(u32, u32),
-    texteditor_set_tab_width: extern "C" fn(u32, u32),
-    texteditor_set_show_line_numbers: extern "C" fn(u32, u32),
-    texteditor_set_font: extern "C" fn(u32, u32, u32),
-    texteditor_insert_text: extern "C" fn(u32, *const u8, u32),
-    texteditor_get_line_count: extern "C" fn(u32) -> u32,
-    texteditor_copy: extern "C" fn(u32) -> u32,
-    texteditor_cut: extern "C" fn(u32) -> u32,
-    texteditor_paste: extern "C" fn(u32) -> u32,
-    texteditor_select_all: extern "C" fn(u32),
-    texteditor_highlight_line: extern "C" fn(u32, u32, u32),
-    texteditor_clear_highlights: extern "C" fn(u32),
-    texteditor_set_read_only: extern "C" fn(u32, u32),
-    texteditor_ensure_line_visible: extern "C" fn(u32, u32),
+    texteditor_set_text: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    texteditor_get_text: LazySym<extern "C" fn(u32, *mut u8, u32) -> u32>,
+    texteditor_set_syntax: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    texteditor_set_cursor: LazySym<extern "C" fn(u32, u32, u32)>,
+    texteditor_get_cursor: LazySym<extern "C" fn(u32, *mut u32, *mut u32)>,
+    texteditor_set_line_height: LazySym<extern "C" fn(u32, u32)>,
+    texteditor_set_tab_width: LazySym<extern "C" fn(u32, u32)>,
+    texteditor_set_show_line_numbers: LazySym<extern "C" fn(u32, u32)>,
+    texteditor_set_font: LazySym<extern "C" fn(u32, u32, u32)>,
+    texteditor_insert_text: LazySym<extern "C" fn(u32, *const u8, u32)>,
+    texteditor_get_line_count: LazySym<extern "C" fn(u32) -> u32>,
+    texteditor_copy: LazySym<extern "C" fn(u32) -> u32>,
+    texteditor_cut: LazySym<extern "C" fn(u32) -> u32>,
+    texteditor_paste: LazySym<extern "C" fn(u32) -> u32>,
+    texteditor_select_all: LazySym<extern "C" fn(u32)>,
+    texteditor_highlight_line: LazySym<extern "C" fn(u32, u32, u32)>,
+    texteditor_clear_highlights: LazySym<extern "C" fn(u32)>,
+    texteditor_set_read_only: LazySym<extern "C" fn(u32, u32)>,
+    texteditor_ensure_line_visible: LazySym<extern "C" fn(u32, u32)>,
     // TreeView
-    treeview_add_node: extern "C" fn(u32, u32, *const u8, u32) -> u32,
-    treeview_remove_node: extern "C" fn(u32, u32),
-    treeview_set_node_text: extern "C" fn(u32, u32, *const u8, u32),
-    treeview_set_node_icon: extern "C" fn(u32, u32, *const u32, u32, u32),
-    treeview_set_node_style: extern "C" fn(u32, u32, u32),
-    treeview_set_node_text_color: extern "C" fn(u32, u32, u32),
-    treeview_set_expanded: extern "C" fn(u32, u32, u32),
-    treeview_get_expanded: extern "C" fn(u32, u32) -> u32,
-    treeview_get_selected: extern "C" fn(u32) -> u32,
-    treeview_set_selected: extern "C" fn(u32, u32),
-    treeview_clear: extern "C" fn(u32),
-    treeview_get_node_count: extern "C" fn(u32) -> u32,
-    treeview_set_indent_width: extern "C" fn(u32, u32),
-    treeview_set_row_height: extern "C" fn(u32, u32),
+    treeview_add_node: LazySym<extern "C" fn(u32, u32, *const u8, u32) -> u32>,
+    treeview_remove_node: LazySym<extern "C" fn(u32, u32)>,
+    treeview_set_node_text: LazySym<extern "C" fn(u32, u32, *const u8, u32)>,
+    treeview_set_node_icon: LazySym<extern "C" fn(u32, u32, *const u32, u32, u32)>,
+    treeview_set_node_style: LazySym<extern "C" fn(u32, u32, u32)>,
+    treeview_set_node_text_color: LazySym<extern "C" fn(u32, u32, u32)>,
+    treeview_set_expanded: LazySym<extern "C" fn(u32, u32, u32)>,
+    treeview_get_expanded: LazySym<extern "C" fn(u32, u32) -> u32>,
+    treeview_get_selected: LazySym<extern "C" fn(u32) -> u32>,
+    treeview_set_selected: LazySym<extern "C" fn(u32, u32)>,
+    treeview_clear: LazySym<extern "C" fn(u32)>,
+    treeview_get_node_count: LazySym<extern "C" fn(u32) -> u32>,
+    treeview_set_indent_width: LazySym<extern "C" fn(u32, u32)>,
+    treeview_set_row_height: LazySym<extern "C" fn(u32, u32)>,
     // Timer
-    set_timer_fn: extern "C" fn(u32, Callback, u64) -> u32,
-    kill_timer_fn: extern "C" fn(u32),
+    set_timer_fn: LazySym<extern "C" fn(u32, Callback, u64) -> u32>,
+    kill_timer_fn: LazySym<extern "C" fn(u32)>,
     // File dialogs
-    open_folder_fn: extern "C" fn(*mut u8, u32) -> u32,
-    open_file_fn: extern "C" fn(*mut u8, u32) -> u32,
-    save_file_fn: extern "C" fn(*mut u8, u32, *const u8, u32) -> u32,
-    create_folder_fn: extern "C" fn(*mut u8, u32) -> u32,
+    open_folder_fn: LazySym<extern "C" fn(*mut u8, u32) -> u32>,
+    open_file_fn: LazySym<extern "C" fn(*mut u8, u32) -> u32>,
+    save_file_fn: LazySym<extern "C" fn(*mut u8, u32, *const u8, u32) -> u32>,
+    create_folder_fn: LazySym<extern "C" fn(*mut u8, u32) -> u32>,
     // Blur-behind
-    set_blur_behind: extern "C" fn(u32, u32),
+    set_blur_behind: LazySym<extern "C" fn(u32, u32)>,
     // Focus management
-    set_focus: extern "C" fn(u32),
-    set_tab_index: extern "C" fn(u32, u32),
+    set_focus: LazySym<extern "C" fn(u32)>,
+    set_tab_index: LazySym<extern "C" fn(u32, u32)>,
     // Screen size
-    screen_size: extern "C" fn(*mut u32, *mut u32),
+    screen_size: LazySym<extern "C" fn(*mut u32, *mut u32)>,
     // Notifications
-    show_notification: extern "C" fn(*const u8, u32, *const u8, u32, *const u32, u32),
+    show_notification: LazySym<extern "C" fn(*const u8, u32, *const u8, u32, *const u32, u32)>,
     // Theme
-    pub(crate) set_theme: extern "C" fn(u32),
-    pub(crate) get_theme: extern "C" fn() -> u32,
-    pub(crate) get_theme_colors_ptr: extern "C" fn() -> *const u8,
-    pub(crate) apply_accent_style: extern "C" fn(u32, u32, u32, u32),
+    pub(crate) set_theme: LazySym<extern "C" fn(u32)>,
+    pub(crate) get_theme: LazySym<extern "C" fn() -> u32>,
+    pub(crate) get_theme_colors_ptr: LazySym<extern "C" fn() -> *const u8>,
+    pub(crate) apply_accent_style: LazySym<extern "C" fn(u32, u32, u32, u32)>,
     // Font smoothing
-    pub(crate) set_font_smoothing: extern "C" fn(u32),
-    pub(crate) get_font_smoothing: extern "C" fn() -> u32,
+    pub(crate) set_font_smoothing: LazySym<extern "C" fn(u32)>,
+    pub(crate) get_font_smoothing: LazySym<extern "C" fn() -> u32>,
     // DPI scale factor
-    pub(crate) set_scale_factor: extern "C" fn(u32),
-    pub(crate) get_scale_factor: extern "C" fn() -> u32,
+    pub(crate) set_scale_factor: LazySym<extern "C" fn(u32)>,
+    pub(crate) get_scale_factor: LazySym<extern "C" fn() -> u32>,
     // Window title
-    set_title: extern "C" fn(u32, *const u8, u32),
+    set_title: LazySym<extern "C" fn(u32, *const u8, u32)>,
     // Key event info
-    get_key_info: extern "C" fn(*mut u32, *mut u32, *mut u32),
+    get_key_info: LazySym<extern "C" fn(*mut u32, *mut u32, *mut u32)>,
     // Clipboard
-    clipboard_set: extern "C" fn(*const u8, u32),
-    clipboard_get: extern "C" fn(*mut u8, u32) -> u32,
+    clipboard_set: LazySym<extern "C" fn(*const u8, u32)>,
+    clipboard_get: LazySym<extern "C" fn(*mut u8, u32) -> u32>,
     // Size/Position query
-    get_size: extern "C" fn(u32, *mut u32, *mut u32),
-    get_position: extern "C" fn(u32, *mut i32, *mut i32),
+    get_size: LazySym<extern "C" fn(u32, *mut u32, *mut u32)>,
+    get_position: LazySym<extern "C" fn(u32, *mut i32, *mut i32)>,
     // DataGrid scroll
-    datagrid_get_scroll_offset: extern "C" fn(u32) -> u32,
-    datagrid_set_scroll_offset: extern "C" fn(u32, u32),
+    datagrid_get_scroll_offset: LazySym<extern "C" fn(u32) -> u32>,
+    datagrid_set_scroll_offset: LazySym<extern "C" fn(u32, u32)>,
     // Text measurement
-    measure_text_fn: extern "C" fn(*const u8, u32, u16, u16) -> u64,
+    measure_text_fn: LazySym<extern "C" fn(*const u8, u32, u16, u16) -> u64>,
     // Compositor channel access
-    get_compositor_channel_fn: extern "C" fn() -> u32,
+    get_compositor_channel_fn: LazySym<extern "C" fn() -> u32>,
     // Window lifecycle callbacks
-    on_window_opened_fn: extern "C" fn(Callback, u64),
-    on_window_closed_fn: extern "C" fn(Callback, u64),
+    on_window_opened_fn: LazySym<extern "C" fn(Callback, u64)>,
+    on_window_closed_fn: LazySym<extern "C" fn(Callback, u64)>,
     // Focus by task ID
-    focus_by_tid_fn: extern "C" fn(u32),
+    focus_by_tid_fn: LazySym<extern "C" fn(u32)>,
 }
 
 static mut LIB: Option<AnyuiLib> = None;
+static mut HANDLE: Option<DlHandle> = None;
 
 pub fn lib() -> &'static AnyuiLib {
     unsafe { LIB.as_ref().expect("libanyui not loaded") }
 }
 
-/// Resolve a function pointer from the loaded library, or panic.
-unsafe fn resolve<T: Copy>(handle: &DlHandle, name: &str) -> T {
-    let ptr = match dl_sym(handle, name) {
-        Some(p) => p,
-        None => panic!("symbol '{}' not found in libanyui.so", name),
-    };
-    core::mem::transmute_copy::<*const (), T>(&ptr)
-}
-
 // ══════════════════════════════════════════════════════════════════════
 //  Public API — init / shutdown / run
 // ══════════════════════════════════════════════════════════════════════
@@ -367,214 +363,220 @@ pub fn init() -> bool {
         None => return false,
     };
 
+    // Symbols are bound on first call (see `dynlink::LazySym`).
     unsafe {
+        HANDLE = Some(handle);
+        let h = HANDLE.as_ref().unwrap();
         let lib = AnyuiLib {
             // Core
-            init: resolve(&handle, "anyui_init"),
-            shutdown: resolve(&handle, "anyui_shutdown"),
-            create_window: resolve(&handle, "anyui_create_window"),
-            add_control: resolve(&handle, "anyui_add_control"),
-            create_control: resolve(&handle, "anyui_create_control"),
-            add_child: resolve(&handle, "anyui_add_child"),
-            set_text: resolve(&handle, "anyui_set_text"),
-            get_text: resolve(&handle, "anyui_get_text"),
-            set_position: resolve(&handle, "anyui_set_position"),
-            set_size: resolve(&handle, "anyui_set_size"),
-            set_visible: resolve(&handle, "anyui_set_visible"),
-            set_color: resolve(&handle, "anyui_set_color"),
-            set_state: resolve(&handle, "anyui_set_state"),
-            get_state: resolve(&handle, "anyui_get_state"),
-            on_event_fn: resolve(&handle, "anyui_on_event"),
-            on_click_fn: resolve(&handle, "anyui_on_click"),
-            on_change_fn: resolve(&handle, "anyui_on_change"),
-            on_submit_fn: resolve(&handle, "anyui_on_submit"),
-            run_fn: resolve(&handle, "anyui_run"),
-            run_once_fn: resolve(&handle, "anyui_run_once"),
-            quit_fn: resolve(&handle, "anyui_quit"),
-            remove_fn: resolve(&handle, "anyui_remove"),
-            remove_child_fn: resolve(&handle, "anyui_remove_child"),
-            clear_children_fn: resolve(&handle, "anyui_clear_children"),
-            destroy_window: resolve(&handle, "anyui_destroy_window"),
-            resize_window: resolve(&handle, "anyui_resize_window"),
-            move_window: resolve(&handle, "anyui_move_window"),
-            minimize_window: resolve(&handle, "anyui_minimize_window"),
+            init: LazySym::new(h, "anyui_init"),
+            shutdown: LazySym::new(h, "anyui_shutdown"),
+            create_window: LazySym::new(h, "anyui_create_window"),
+            add_control: LazySym::new(h, "anyui_add_control"),
+            create_control: LazySym::new(h, "anyui_create_control"),
+            add_child: LazySym::new(h, "anyui_add_child"),
+            set_text: LazySym::new(h, "anyui_set_text"),
+            get_text: LazySym::new(h, "anyui_get_text"),
+            set_position: LazySym::new(h, "anyui_set_position"),
+            set_size: LazySym::new(h, "anyui_set_size"),
+            set_visible: LazySym::new(h, "anyui_set_visible"),
+            set_color: LazySym::new(h, "anyui_set_color"),
+            set_state: LazySym::new(h, "anyui_set_state"),
+            get_state: LazySym::new(h, "anyui_get_state"),
+            on_event_fn: LazySym::new(h, "anyui_on_event"),
+            on_click_fn: LazySym::new(h, "anyui_on_click"),
+            on_change_fn: LazySym::new(h, "anyui_on_change"),
+            on_submit_fn: LazySym::new(h, "anyui_on_submit"),
+            run_fn: LazySym::new(h, "anyui_run"),
+            run_once_fn: LazySym::new(h, "anyui_run_once"),
+            quit_fn: LazySym::new(h, "anyui_quit"),
+            remove_fn: LazySym::new(h, "anyui_remove"),
+            remove_child_fn: LazySym::new(h, "anyui_remove_child"),
+            clear_children_fn: LazySym::new(h, "anyui_clear_children"),
+            destroy_window: LazySym::new(h, "anyui_destroy_window"),
+            resize_window: LazySym::new(h, "anyui_resize_window"),
+            move_window: LazySym::new(h, "anyui_move_window"),
+            minimize_window: LazySym::new(h, "anyui_minimize_window"),
             // Layout
-            set_padding: resolve(&handle, "anyui_set_padding"),
-            set_margin: resolve(&handle, "anyui_set_margin"),
-            set_dock: resolve(&handle, "anyui_set_dock"),
-            set_disabled: resolve(&handle, "anyui_set_disabled"),
-            set_auto_size: resolve(&handle, "anyui_set_auto_size"),
-            set_min_size: resolve(&handle, "anyui_set_min_size"),
-            set_max_size: resolve(&handle, "anyui_set_max_size"),
+            set_padding: LazySym::new(h, "anyui_set_padding"),
+            set_margin: LazySym::new(h, "anyui_set_margin"),
+            set_dock: LazySym::new(h, "anyui_set_dock"),
+            set_disabled: LazySym::new(h, "anyui_set_disabled"),
+            set_auto_size: LazySym::new(h, "anyui_set_auto_size"),
+            set_min_size: LazySym::new(h, "anyui_set_min_size"),
+            set_max_size: LazySym::new(h, "anyui_set_max_size"),
             // Text styling
-            set_font_size: resolve(&handle, "anyui_set_font_size"),
-            get_font_size: resolve(&handle, "anyui_get_font_size"),
-            set_font: resolve(&handle, "anyui_set_font"),
-            set_text_color: resolve(&handle, "anyui_set_text_color"),
+            set_font_size: LazySym::new(h, "anyui_set_font_size"),
+            get_font_size: LazySym::new(h, "anyui_get_font_size"),
+            set_font: LazySym::new(h, "anyui_set_font"),
+            set_text_color: LazySym::new(h, "anyui_set_text_color"),
             // Container properties
-            set_orientation: resolve(&handle, "anyui_set_orientation"),
-            set_columns: resolve(&handle, "anyui_set_columns"),
-            set_row_height: resolve(&handle, "anyui_set_row_height"),
-            set_column_widths: resolve(&handle, "anyui_set_column_widths"),
+            set_orientation: LazySym::new(h, "anyui_set_orientation"),
+            set_columns: LazySym::new(h, "anyui_set_columns"),
+            set_row_height: LazySym::new(h, "anyui_set_row_height"),
+            set_column_widths: LazySym::new(h, "anyui_set_column_widths"),
             // SplitView properties
-            set_split_ratio: resolve(&handle, "anyui_set_split_ratio"),
-            set_min_split: resolve(&handle, "anyui_set_min_split"),
-            set_max_split: resolve(&handle, "anyui_set_max_split"),
+            set_split_ratio: LazySym::new(h, "anyui_set_split_ratio"),
+            set_min_split: LazySym::new(h, "anyui_set_min_split"),
+            set_max_split: LazySym::new(h, "anyui_set_max_split"),
             // Canvas
-            canvas_set_pixel: resolve(&handle, "anyui_canvas_set_pixel"),
-            canvas_clear: resolve(&handle, "anyui_canvas_clear"),
-            canvas_fill_rect: resolve(&handle, "anyui_canvas_fill_rect"),
-            canvas_draw_line: resolve(&handle, "anyui_canvas_draw_line"),
-            canvas_draw_rect: resolve(&handle, "anyui_canvas_draw_rect"),
-            canvas_draw_circle: resolve(&handle, "anyui_canvas_draw_circle"),
-            canvas_fill_circle: resolve(&handle, "anyui_canvas_fill_circle"),
-            canvas_get_buffer: resolve(&handle, "anyui_canvas_get_buffer"),
-            canvas_get_stride: resolve(&handle, "anyui_canvas_get_stride"),
-            canvas_get_height: resolve(&handle, "anyui_canvas_get_height"),
+            canvas_set_pixel: LazySym::new(h, "anyui_canvas_set_pixel"),
+            canvas_clear: LazySym::new(h, "anyui_canvas_clear"),
+            canvas_fill_rect: LazySym::new(h, "anyui_canvas_fill_rect"),
+            canvas_draw_line: LazySym::new(h, "anyui_canvas_draw_line"),
+            canvas_draw_rect: LazySym::new(h, "anyui_canvas_draw_rect"),
+            canvas_draw_circle: LazySym::new(h, "anyui_canvas_draw_circle"),
+            canvas_fill_circle: LazySym::new(h, "anyui_canvas_fill_circle"),
+            canvas_get_buffer: LazySym::new(h, "anyui_canvas_get_buffer"),
+            canvas_get_stride: LazySym::new(h, "anyui_canvas_get_stride"),
+            canvas_get_height: LazySym::new(h, "anyui_canvas_get_height"),
             // Canvas extensions
-            canvas_set_interactive: resolve(&handle, "anyui_canvas_set_interactive"),
-            canvas_get_mouse: resolve(&handle, "anyui_canvas_get_mouse"),
-            canvas_fill_ellipse: resolve(&handle, "anyui_canvas_fill_ellipse"),
-            canvas_draw_ellipse: resolve(&handle, "anyui_canvas_draw_ellipse"),
-            canvas_flood_fill: resolve(&handle, "anyui_canvas_flood_fill"),
-            canvas_draw_thick_line: resolve(&handle, "anyui_canvas_draw_thick_line"),
-            canvas_get_pixel: resolve(&handle, "anyui_canvas_get_pixel"),
-            canvas_copy_from: resolve(&handle, "anyui_canvas_copy_from"),
-            canvas_copy_to: resolve(&handle, "anyui_canvas_copy_to"),
+            canvas_set_interactive: LazySym::new(h, "anyui_canvas_set_interactive"),
+            canvas_get_mouse: LazySym::new(h, "anyui_canvas_get_mouse"),
+            canvas_fill_ellipse: LazySym::new(h, "anyui_canvas_fill_ellipse"),
+            canvas_draw_ellipse: LazySym::new(h, "anyui_canvas_draw_ellipse"),
+            canvas_flood_fill: LazySym::new(h, "anyui_canvas_flood_fill"),
+            canvas_draw_thick_line: LazySym::new(h, "anyui_canvas_draw_thick_line"),
+            canvas_get_pixel: LazySym::new(h, "anyui_canvas_get_pixel"),
+            canvas_copy_from: LazySym::new(h, "anyui_canvas_copy_from"),
+            canvas_copy_to: LazySym::new(h, "anyui_canvas_copy_to"),
             // TextField-specific
-            textfield_set_prefix: resolve(&handle, "anyui_textfield_set_prefix"),
-            textfield_set_postfix: resolve(&handle, "anyui_textfield_set_postfix"),
-            textfield_set_password: resolve(&handle, "anyui_textfield_set_password"),
-            textfield_set_placeholder: resolve(&handle, "anyui_textfield_set_placeholder"),
-            textfield_select_all: resolve(&handle, "anyui_textfield_select_all"),
+            textfield_set_prefix: LazySym::new(h, "anyui_textfield_set_prefix"),
+            textfield_set_postfix: LazySym::new(h, "anyui_textfield_set_postfix"),
+            textfield_set_password: LazySym::new(h, "anyui_textfield_set_password"),
+            textfield_set_placeholder: LazySym::new(h, "anyui_textfield_set_placeholder"),
+            textfield_select_all: LazySym::new(h, "anyui_textfield_select_all"),
             // Marshal (cross-thread)
-            marshal_set_text: resolve(&handle, "anyui_marshal_set_text"),
-            marshal_set_color: resolve(&handle, "anyui_marshal_set_color"),
-            marshal_set_state: resolve(&handle, "anyui_marshal_set_state"),
-            marshal_set_visible: resolve(&handle, "anyui_marshal_set_visible"),
-            marshal_set_position: resolve(&handle, "anyui_marshal_set_position"),
-            marshal_set_size: resolve(&handle, "anyui_marshal_set_size"),
-            marshal_dispatch: resolve(&handle, "anyui_marshal_dispatch"),
+            marshal_set_text: LazySym::new(h, "anyui_marshal_set_text"),
+            marshal_set_color: LazySym::new(h, "anyui_marshal_set_color"),
+            marshal_set_state: LazySym::new(h, "anyui_marshal_set_state"),
+            marshal_set_visible: LazySym::new(h, "anyui_marshal_set_visible"),
+            marshal_set_position: LazySym::new(h, "anyui_marshal_set_position"),
+            marshal_set_size: LazySym::new(h, "anyui_marshal_set_size"),
+            marshal_dispatch: LazySym::new(h, "anyui_marshal_dispatch"),
             // Context menu
-            set_context_menu: resolve(&handle, "anyui_set_context_menu"),
+            set_context_menu: LazySym::new(h, "anyui_set_context_menu"),
             // Tooltip
-            set_tooltip: resolve(&handle, "anyui_set_tooltip"),
+            set_tooltip: LazySym::new(h, "anyui_set_tooltip"),
             // MessageBox
-            message_box: resolve(&handle, "anyui_message_box"),
+            message_box: LazySym::new(h, "anyui_message_box"),
             // IconButton
-            iconbutton_set_pixels: resolve(&handle, "anyui_iconbutton_set_pixels"),
+            iconbutton_set_pixels: LazySym::new(h, "anyui_iconbutton_set_pixels"),
             // ImageView
-            imageview_set_pixels: resolve(&handle, "anyui_imageview_set_pixels"),
-            imageview_set_scale_mode: resolve(&handle, "anyui_imageview_set_scale_mode"),
-            imageview_get_image_size: resolve(&handle, "anyui_imageview_get_image_size"),
-            imageview_clear: resolve(&handle, "anyui_imageview_clear"),
+            imageview_set_pixels: LazySym::new(h, "anyui_imageview_set_pixels"),
+            imageview_set_scale_mode: LazySym::new(h, "anyui_imageview_set_scale_mode"),
+            imageview_get_image_size: LazySym::new(h, "anyui_imageview_get_image_size"),
+            imageview_clear: LazySym::new(h, "anyui_imageview_clear"),
             // DataGrid
-            datagrid_set_columns: resolve(&handle, "anyui_datagrid_set_columns"),
-            datagrid_get_column_count: resolve(&handle, "anyui_datagrid_get_column_count"),
-            datagrid_set_column_width: resolve(&handle, "anyui_datagrid_set_column_width"),
-            datagrid_set_column_sort_type: resolve(&handle, "anyui_datagrid_set_column_sort_type"),
-            datagrid_set_data: resolve(&handle, "anyui_datagrid_set_data"),
-            datagrid_set_cell: resolve(&handle, "anyui_datagrid_set_cell"),
-            datagrid_get_cell: resolve(&handle, "anyui_datagrid_get_cell"),
-            datagrid_set_cell_colors: resolve(&handle, "anyui_datagrid_set_cell_colors"),
-            datagrid_set_cell_bg_colors: resolve(&handle, "anyui_datagrid_set_cell_bg_colors"),
-            datagrid_set_row_count: resolve(&handle, "anyui_datagrid_set_row_count"),
-            datagrid_get_row_count: resolve(&handle, "anyui_datagrid_get_row_count"),
-            datagrid_set_selection_mode: resolve(&handle, "anyui_datagrid_set_selection_mode"),
-            datagrid_get_selected_row: resolve(&handle, "anyui_datagrid_get_selected_row"),
-            datagrid_set_selected_row: resolve(&handle, "anyui_datagrid_set_selected_row"),
-            datagrid_is_row_selected: resolve(&handle, "anyui_datagrid_is_row_selected"),
-            datagrid_sort: resolve(&handle, "anyui_datagrid_sort"),
-            datagrid_set_row_height: resolve(&handle, "anyui_datagrid_set_row_height"),
-            datagrid_set_header_height: resolve(&handle, "anyui_datagrid_set_header_height"),
-            datagrid_set_char_colors: resolve(&handle, "anyui_datagrid_set_char_colors"),
-            datagrid_set_cell_icon: resolve(&handle, "anyui_datagrid_set_cell_icon"),
-            datagrid_set_minimap: resolve(&handle, "anyui_datagrid_set_minimap"),
-            datagrid_get_click_col: resolve(&handle, "anyui_datagrid_get_click_col"),
-            datagrid_set_connectors: resolve(&handle, "anyui_datagrid_set_connectors"),
-            datagrid_set_connector_column: resolve(&handle, "anyui_datagrid_set_connector_column"),
+            datagrid_set_columns: LazySym::new(h, "anyui_datagrid_set_columns"),
+            datagrid_get_column_count: LazySym::new(h, "anyui_datagrid_get_column_count"),
+            datagrid_set_column_width: LazySym::new(h, "anyui_datagrid_set_column_width"),
+            datagrid_set_column_sort_type: LazySym::new(h, "anyui_datagrid_set_column_sort_type"),
+            datagrid_set_data: LazySym::new(h, "anyui_datagrid_set_data"),
+            datagrid_set_cell: LazySym::new(h, "anyui_datagrid_set_cell"),
+            datagrid_get_cell: LazySym::new(h, "anyui_datagrid_get_cell"),
+            datagrid_set_cell_colors: LazySym::new(h, "anyui_datagrid_set_cell_colors"),
+            datagrid_set_cell_bg_colors: LazySym::new(h, "anyui_datagrid_set_cell_bg_colors"),
+            datagrid_set_row_count: LazySym::new(h, "anyui_datagrid_set_row_count"),
+            datagrid_get_row_count: LazySym::new(h, "anyui_datagrid_get_row_count"),
+            datagrid_set_selection_mode: LazySym::new(h, "anyui_datagrid_set_selection_mode"),
+            datagrid_get_selected_row: LazySym::new(h, "anyui_datagrid_get_selected_row"),
+            datagrid_set_selected_row: LazySym::new(h, "anyui_datagrid_set_selected_row"),
+            datagrid_is_row_selected: LazySym::new(h, "anyui_datagrid_is_row_selected"),
+            datagrid_sort: LazySym::new(h, "anyui_datagrid_sort"),
+            datagrid_set_row_height: LazySym::new(h, "anyui_datagrid_set_row_height"),
+            datagrid_set_header_height: LazySym::new(h, "anyui_datagrid_set_header_height"),
+            datagrid_set_char_colors: LazySym::new(h, "anyui_datagrid_set_char_colors"),
+            datagrid_set_cell_icon: LazySym::new(h, "anyui_datagrid_set_cell_icon"),
+            datagrid_set_minimap: LazySym::new(h, "anyui_datagrid_set_minimap"),
+            datagrid_get_click_col: LazySym::new(h, "anyui_datagrid_get_click_col"),
+            datagrid_set_connectors: LazySym::new(h, "anyui_datagrid_set_connectors"),
+            datagrid_set_connector_column: LazySym::new(h, "anyui_datagrid_set_connector_column"),
+            datagrid_set_virtual: LazySym::new(h, "anyui_datagrid_set_virtual"),
+            datagrid_get_data_request: LazySym::new(h, "anyui_datagrid_get_data_request"),
+            datagrid_set_rows: LazySym::new(h, "anyui_datagrid_set_rows"),
+            datagrid_invalidate_rows: LazySym::new(h, "anyui_datagrid_invalidate_rows"),
             // TextEditor
-            texteditor_set_text: resolve(&handle, "anyui_texteditor_set_text"),
-            texteditor_get_text: resolve(&handle, "anyui_texteditor_get_text"),
-            texteditor_set_syntax: resolve(&handle, "anyui_texteditor_set_syntax"),
-            texteditor_set_cursor: resolve(&handle, "anyui_texteditor_set_cursor"),
-            texteditor_get_cursor: resolve(&handle, "anyui_texteditor_get_cursor"),
-            texteditor_set_line_height: resolve(&handle, "anyui_texteditor_set_line_height"),
-            texteditor_set_tab_width: resolve(&handle, "anyui_texteditor_set_tab_width"),
-            texteditor_set_show_line_numbers: resolve(&handle, "anyui_texteditor_set_show_line_numbers"),
-            texteditor_set_font: resolve(&handle, "anyui_texteditor_set_font"),
-            texteditor_insert_text: resolve(&handle, "anyui_texteditor_insert_text"),
-            texteditor_get_line_count: resolve(&handle, "anyui_texteditor_get_line_count"),
-            texteditor_copy: resolve(&handle, "anyui_texteditor_copy"),
-            texteditor_cut: resolve(&handle, "anyui_texteditor_cut"),
-            texteditor_paste: resolve(&handle, "anyui_texteditor_paste"),
-            texteditor_select_all: resolve(&handle, "anyui_texteditor_select_all"),
-            texteditor_highlight_line: resolve(&handle, "anyui_texteditor_highlight_line"),
-            texteditor_clear_highlights: resolve(&handle, "anyui_texteditor_clear_highlights"),
-            texteditor_set_read_only: resolve(&handle, "anyui_texteditor_set_read_only"),
-            texteditor_ensure_line_visible: resolve(&handle, "anyui_texteditor_ensure_line_visible"),
+            texteditor_set_text: LazySym::new(h, "anyui_texteditor_set_text"),
+            texteditor_get_text: LazySym::new(h, "anyui_texteditor_get_text"),
+            texteditor_set_syntax: LazySym::new(h, "anyui_texteditor_set_syntax"),
+            texteditor_set_cursor: LazySym::new(h, "anyui_texteditor_set_cursor"),
+            texteditor_get_cursor: LazySym::new(h, "anyui_texteditor_get_cursor"),
+            texteditor_set_line_height: LazySym::new(h, "anyui_texteditor_set_line_height"),
+            texteditor_set_tab_width: LazySym::new(h, "anyui_texteditor_set_tab_width"),
+            texteditor_set_show_line_numbers: LazySym::new(h, "anyui_texteditor_set_show_line_numbers"),
+            texteditor_set_font: LazySym::new(h, "anyui_texteditor_set_font"),
+            texteditor_insert_text: LazySym::new(h, "anyui_texteditor_insert_text"),
+            texteditor_get_line_count: LazySym::new(h, "anyui_texteditor_get_line_count"),
+            texteditor_copy: LazySym::new(h, "anyui_texteditor_copy"),
+            texteditor_cut: LazySym::new(h, "anyui_texteditor_cut"),
+            texteditor_paste: LazySym::new(h, "anyui_texteditor_paste"),
+            texteditor_select_all: LazySym::new(h, "anyui_texteditor_select_all"),
+            texteditor_highlight_line: LazySym::new(h, "anyui_texteditor_highlight_line"),
+            texteditor_clear_highlights: LazySym::new(h, "anyui_texteditor_clear_highlights"),
+            texteditor_set_read_only: LazySym::new(h, "anyui_texteditor_set_read_only"),
+            texteditor_ensure_line_visible: LazySym::new(h, "anyui_texteditor_ensure_line_visible"),
             // TreeView
-            treeview_add_node: resolve(&handle, "anyui_treeview_add_node"),
-            treeview_remove_node: resolve(&handle, "anyui_treeview_remove_node"),
-            treeview_set_node_text: resolve(&handle, "anyui_treeview_set_node_text"),
-            treeview_set_node_icon: resolve(&handle, "anyui_treeview_set_node_icon"),
-            treeview_set_node_style: resolve(&handle, "anyui_treeview_set_node_style"),
-            treeview_set_node_text_color: resolve(&handle, "anyui_treeview_set_node_text_color"),
-            treeview_set_expanded: resolve(&handle, "anyui_treeview_set_expanded"),
-            treeview_get_expanded: resolve(&handle, "anyui_treeview_get_expanded"),
-            treeview_get_selected: resolve(&handle, "anyui_treeview_get_selected"),
-            treeview_set_selected: resolve(&handle, "anyui_treeview_set_selected"),
-            treeview_clear: resolve(&handle, "anyui_treeview_clear"),
-            treeview_get_node_count: resolve(&handle, "anyui_treeview_get_node_count"),
-            treeview_set_indent_width: resolve(&handle, "anyui_treeview_set_indent_width"),
-            treeview_set_row_height: resolve(&handle, "anyui_treeview_set_row_height"),
+            treeview_add_node: LazySym::new(h, "anyui_treeview_add_node"),
+            treeview_remove_node: LazySym::new(h, "anyui_treeview_remove_node"),
+            treeview_set_node_text: LazySym::new(h, "anyui_treeview_set_node_text"),
+            treeview_set_node_icon: LazySym::new(h, "anyui_treeview_set_node_icon"),
+            treeview_set_node_style: LazySym::new(h, "anyui_treeview_set_node_style"),
+            treeview_set_node_text_color: LazySym::new(h, "anyui_treeview_set_node_text_color"),
+            treeview_set_expanded: LazySym::new(h, "anyui_treeview_set_expanded"),
+            treeview_get_expanded: LazySym::new(h, "anyui_treeview_get_expanded"),
+            treeview_get_selected: LazySym::new(h, "anyui_treeview_get_selected"),
+            treeview_set_selected: LazySym::new(h, "anyui_treeview_set_selected"),
+            treeview_clear: LazySym::new(h, "anyui_treeview_clear"),
+            treeview_get_node_count: LazySym::new(h, "anyui_treeview_get_node_count"),
+            treeview_set_indent_width: LazySym::new(h, "anyui_treeview_set_indent_width"),
+            treeview_set_row_height: LazySym::new(h, "anyui_treeview_set_row_height"),
             // Timer
-            set_timer_fn: resolve(&handle, "anyui_set_timer"),
-            kill_timer_fn: resolve(&handle, "anyui_kill_timer"),
+            set_timer_fn: LazySym::new(h, "anyui_set_timer"),
+            kill_timer_fn: LazySym::new(h, "anyui_kill_timer"),
             // File dialogs
-            open_folder_fn: resolve(&handle, "anyui_open_folder"),
-            open_file_fn: resolve(&handle, "anyui_open_file"),
-            save_file_fn: resolve(&handle, "anyui_save_file"),
-            create_folder_fn: resolve(&handle, "anyui_create_folder"),
+            open_folder_fn: LazySym::new(h, "anyui_open_folder"),
+            open_file_fn: LazySym::new(h, "anyui_open_file"),
+            save_file_fn: LazySym::new(h, "anyui_save_file"),
+            create_folder_fn: LazySym::new(h, "anyui_create_folder"),
             // Blur-behind
-            set_blur_behind: resolve(&handle, "anyui_set_blur_behind"),
+            set_blur_behind: LazySym::new(h, "anyui_set_blur_behind"),
             // Focus management
-            set_focus: resolve(&handle, "anyui_set_focus"),
-            set_tab_index: resolve(&handle, "anyui_set_tab_index"),
+            set_focus: LazySym::new(h, "anyui_set_focus"),
+            set_tab_index: LazySym::new(h, "anyui_set_tab_index"),
             // Screen size
-            screen_size: resolve(&handle, "anyui_screen_size"),
+            screen_size: LazySym::new(h, "anyui_screen_size"),
             // Notifications
-            show_notification: resolve(&handle, "anyui_show_notification"),
+            show_notification: LazySym::new(h, "anyui_show_notification"),
             // Theme
-            set_theme: resolve(&handle, "anyui_set_theme"),
-            get_theme: resolve(&handle, "anyui_get_theme"),
-            get_theme_colors_ptr: resolve(&handle, "anyui_get_theme_colors_ptr"),
-            apply_accent_style: resolve(&handle, "anyui_apply_accent_style"),
+            set_theme: LazySym::new(h, "anyui_set_theme"),
+            get_theme: LazySym::new(h, "anyui_get_theme"),
+            get_theme_colors_ptr: LazySym::new(h, "anyui_get_theme_colors_ptr"),
+            apply_accent_style: LazySym::new(h, "anyui_apply_accent_style"),
             // Font smoothing
-            set_font_smoothing: resolve(&handle, "anyui_set_font_smoothing"),
-            get_font_smoothing: resolve(&handle, "anyui_get_font_smoothing"),
+            set_font_smoothing: LazySym::new(h, "anyui_set_font_smoothing"),
+            get_font_smoothing: LazySym::new(h, "anyui_get_font_smoothing"),
             // DPI scale factor
-            set_scale_factor: resolve(&handle, "anyui_set_scale_factor"),
-            get_scale_factor: resolve(&handle, "anyui_get_scale_factor"),
+            set_scale_factor: LazySym::new(h, "anyui_set_scale_factor"),
+            get_scale_factor: LazySym::new(h, "anyui_get_scale_factor"),
             // Window title
-            set_title: resolve(&handle, "anyui_set_title"),
+            set_title: LazySym::new(h, "anyui_set_title"),
             // Key event info
-            get_key_info: resolve(&handle, "anyui_get_key_info"),
+            get_key_info: LazySym::new(h, "anyui_get_key_info"),
             // Clipboard
-            clipboard_set: resolve(&handle, "anyui_clipboard_set"),
-            clipboard_get: resolve(&handle, "anyui_clipboard_get"),
+            clipboard_set: LazySym::new(h, "anyui_clipboard_set"),
+            clipboard_get: LazySym::new(h, "anyui_clipboard_get"),
             // Size/Position query
-            get_size: resolve(&handle, "anyui_get_size"),
-            get_position: resolve(&handle, "anyui_get_position"),
+            get_size: LazySym::new(h, "anyui_get_size"),
+            get_position: LazySym::new(h, "anyui_get_position"),
             // DataGrid scroll
-            datagrid_get_scroll_offset: resolve(&handle, "anyui_datagrid_get_scroll_offset"),
-            datagrid_set_scroll_offset: resolve(&handle, "anyui_datagrid_set_scroll_offset"),
-            measure_text_fn: resolve(&handle, "anyui_measure_text"),
-            get_compositor_channel_fn: resolve(&handle, "anyui_get_compositor_channel"),
-            on_window_opened_fn: resolve(&handle, "anyui_on_window_opened"),
-            on_window_closed_fn: resolve(&handle, "anyui_on_window_closed"),
-            focus_by_tid_fn: resolve(&handle, "anyui_focus_by_tid"),
-            _handle: handle,
+            datagrid_get_scroll_offset: LazySym::new(h, "anyui_datagrid_get_scroll_offset"),
+            datagrid_set_scroll_offset: LazySym::new(h, "anyui_datagrid_set_scroll_offset"),
+            measure_text_fn: LazySym::new(h, "anyui_measure_text"),
+            get_compositor_channel_fn: LazySym::new(h, "anyui_get_compositor_channel"),
+            on_window_opened_fn: LazySym::new(h, "anyui_on_window_opened"),
+            on_window_closed_fn: LazySym::new(h, "anyui_on_window_closed"),
+            focus_by_tid_fn: LazySym::new(h, "anyui_focus_by_tid"),
         };
         (lib.init)();
         LIB = Some(lib);
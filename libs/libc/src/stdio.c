@@ -16,10 +16,36 @@
 #include <errno.h>
 #include <sys/syscall.h>
 
-/* Static FILE objects for stdin/stdout/stderr */
-static FILE _stdin  = { .fd = 0, .flags = 0, .eof = 0, .error = 0, .ungot = -1 };
-static FILE _stdout = { .fd = 1, .flags = 1, .eof = 0, .error = 0, .ungot = -1 };
-static FILE _stderr = { .fd = 2, .flags = 1, .eof = 0, .error = 0, .ungot = -1 };
+/*
+ * Streams are buffered.  Each FILE owns one buffer that holds either
+ * read-ahead or pending output, never both: `dir` says which, and
+ * switching direction flushes (or, for input, seeks back over) it.
+ *
+ *   _IOFBF  regular files and pipes, FILE_BUFSIZ bytes
+ *   _IOLBF  terminals, BUFSIZ bytes, flushed at each newline
+ *   _IONBF  stderr; output goes straight to write()
+ *
+ * The buffer is allocated on first use, so setvbuf() may still pick the
+ * mode and size before then.  Refilling an interactive input stream
+ * flushes stdout first, so prompts appear before the read blocks.
+ * exit() flushes every open stream.
+ */
+
+#define FILE_BUFSIZ 32768
+
+/* FILE.flags bits */
+#define F_WRITE   1     /* opened for writing */
+#define F_BUFSET  2     /* mode and buffer chosen */
+#define F_OWNBUF  4     /* buf came from malloc */
+
+/* FILE.dir */
+#define DIR_NONE  0
+#define DIR_READ  1
+#define DIR_WRITE 2
+
+static FILE _stderr = { .fd = 2, .flags = F_WRITE, .ungot = -1 };
+static FILE _stdout = { .fd = 1, .flags = F_WRITE, .ungot = -1, .next = &_stderr };
+static FILE _stdin  = { .fd = 0, .flags = 0, .ungot = -1, .next = &_stdout };
 
 FILE *stdin  = &_stdin;
 FILE *stdout = &_stdout;
@@ -27,6 +53,151 @@ FILE *stderr = &_stderr;
 
 int errno = 0;
 
+/* All open streams, newest first (for fflush(NULL) and exit).
+ * Single-threaded library, so FILE.lock is unused. */
+static FILE *stream_list = &_stdin;
+
+#define LOCK(f)   ((void)(f))
+#define UNLOCK(f) ((void)(f))
+
+static void link_stream(FILE *f) {
+    f->next = stream_list;
+    stream_list = f;
+}
+
+static void unlink_stream(FILE *f) {
+    for (FILE **pp = &stream_list; *pp; pp = &(*pp)->next) {
+        if (*pp == f) { *pp = f->next; break; }
+    }
+}
+
+static void release_buf(FILE *f) {
+    if (f->flags & F_OWNBUF) free(f->buf);
+    f->buf = NULL;
+    f->buf_size = 0;
+    f->flags &= ~(F_BUFSET | F_OWNBUF);
+}
+
+/* Pick the default mode and allocate the buffer. */
+static void setup_buf(FILE *f) {
+    if (f->flags & F_BUFSET) return;
+    f->flags |= F_BUFSET;
+    int tty = isatty(f->fd) > 0;
+    f->mode = f == &_stderr ? _IONBF : tty ? _IOLBF : _IOFBF;
+    if (f->mode != _IONBF) {
+        size_t size = tty ? BUFSIZ : FILE_BUFSIZ;
+        f->buf = malloc(size);
+        if (f->buf) {
+            f->buf_size = size;
+            f->flags |= F_OWNBUF;
+            return;
+        }
+        f->mode = _IONBF;
+    }
+    /* Unbuffered: a one-byte buffer keeps fgetc() on the common path. */
+    f->buf = f->nbuf;
+    f->buf_size = 1;
+}
+
+static int write_all(FILE *f, const unsigned char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(f->fd, p, len);
+        if (n <= 0) { f->error = 1; return EOF; }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Write out pending output. */
+static int flush_out(FILE *f) {
+    if (f->dir != DIR_WRITE) return 0;
+    int ret = write_all(f, f->buf, f->buf_pos);
+    f->buf_pos = 0;
+    f->dir = DIR_NONE;
+    return ret;
+}
+
+/* Drop read-ahead, moving the file offset back to the logical position. */
+static void drop_input(FILE *f) {
+    if (f->dir != DIR_READ) return;
+    long ahead = (long)(f->buf_len - f->buf_pos) + (f->ungot >= 0);
+    if (ahead > 0) lseek(f->fd, -ahead, SEEK_CUR);   /* fails harmlessly on pipes */
+    f->buf_pos = f->buf_len = 0;
+    f->ungot = -1;
+    f->dir = DIR_NONE;
+}
+
+/* Make `f` ready for output; returns EOF if it is not writable. */
+static int begin_write(FILE *f) {
+    if (!(f->flags & F_WRITE)) { f->error = 1; return EOF; }
+    setup_buf(f);
+    if (f->dir == DIR_READ) drop_input(f);
+    f->dir = DIR_WRITE;
+    return 0;
+}
+
+/* Refill the read buffer.  Returns 0, or EOF at end of file / on error. */
+static int fill_in(FILE *f) {
+    setup_buf(f);
+    if (f->dir == DIR_WRITE && flush_out(f)) return EOF;
+    f->dir = DIR_READ;
+    if (f->mode != _IOFBF && f != &_stdout)
+        flush_out(&_stdout);
+    ssize_t n = read(f->fd, f->buf, f->buf_size);
+    f->buf_pos = 0;
+    if (n <= 0) {
+        f->buf_len = 0;
+        if (n == 0) f->eof = 1;
+        else f->error = 1;
+        return EOF;
+    }
+    f->buf_len = (size_t)n;
+    return 0;
+}
+
+static int getc_locked(FILE *f) {
+    if (f->ungot >= 0) {
+        int c = f->ungot;
+        f->ungot = -1;
+        return c;
+    }
+    if (f->dir != DIR_READ || f->buf_pos >= f->buf_len) {
+        if (fill_in(f)) return EOF;
+    }
+    return f->buf[f->buf_pos++];
+}
+
+static size_t write_locked(FILE *f, const unsigned char *p, size_t len) {
+    if (begin_write(f)) return 0;
+    if (f->mode == _IONBF)
+        return write_all(f, p, len) ? 0 : len;
+
+    size_t room = f->buf_size - f->buf_pos;
+    if (len <= room) {
+        memcpy(f->buf + f->buf_pos, p, len);
+        f->buf_pos += len;
+    } else {
+        /* No writev in the kernel: top up, flush, then either buffer the
+         * tail or, if it is at least a buffer's worth, write it directly. */
+        memcpy(f->buf + f->buf_pos, p, room);
+        f->buf_pos += room;
+        if (flush_out(f)) return room;
+        size_t rest = len - room;
+        if (rest >= f->buf_size) {
+            if (write_all(f, p + room, rest)) return room;
+        } else {
+            memcpy(f->buf, p + room, rest);
+            f->buf_pos = rest;
+            f->dir = DIR_WRITE;
+        }
+    }
+    if (f->mode == _IOLBF && f->dir == DIR_WRITE && memchr(p, '\n', len)) {
+        if (flush_out(f)) return 0;
+    }
+    return len;
+}
+
 FILE *fopen(const char *path, const char *mode) {
     int flags = 0;
     if (strcmp(mode, "r") == 0) flags = O_RDONLY;
@@ -44,58 +215,106 @@ FILE *fopen(const char *path, const char *mode) {
     FILE *f = calloc(1, sizeof(FILE));
     if (!f) { close(fd); return NULL; }
     f->fd = fd;
-    f->flags = (flags & O_WRONLY) || (flags & O_RDWR) ? 1 : 0;
+    f->flags = (flags & O_WRONLY) || (flags & O_RDWR) ? F_WRITE : 0;
     f->ungot = -1;
+    link_stream(f);
     return f;
 }
 
 int fclose(FILE *stream) {
     if (!stream) return EOF;
-    fflush(stream);
+    LOCK(stream);
+    int err = flush_out(stream);
+    release_buf(stream);
     int ret = close(stream->fd);
-    if (stream != stdin && stream != stdout && stream != stderr)
+    UNLOCK(stream);
+    if (stream != stdin && stream != stdout && stream != stderr) {
+        unlink_stream(stream);
         free(stream);
-    return ret < 0 ? EOF : 0;
+    }
+    return ret < 0 || err ? EOF : 0;
 }
 
 size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream) {
     if (!stream || size == 0 || nmemb == 0) return 0;
     size_t total = size * nmemb;
-    ssize_t n = read(stream->fd, ptr, total);
-    if (n <= 0) {
-        if (n == 0) stream->eof = 1;
-        else stream->error = 1;
-        return 0;
+    unsigned char *out = ptr;
+    size_t got = 0;
+
+    LOCK(stream);
+    setup_buf(stream);
+    if (stream->ungot >= 0 && got < total) {
+        out[got++] = (unsigned char)stream->ungot;
+        stream->ungot = -1;
     }
-    return n / size;
+    while (got < total) {
+        if (stream->dir == DIR_READ && stream->buf_pos < stream->buf_len) {
+            size_t n = stream->buf_len - stream->buf_pos;
+            if (n > total - got) n = total - got;
+            memcpy(out + got, stream->buf + stream->buf_pos, n);
+            stream->buf_pos += n;
+            got += n;
+        } else if (total - got >= stream->buf_size) {
+            /* Large read: go straight into the caller's buffer. */
+            if (stream->dir == DIR_WRITE && flush_out(stream)) break;
+            stream->dir = DIR_READ;
+            stream->buf_pos = stream->buf_len = 0;
+            ssize_t n = read(stream->fd, out + got, total - got);
+            if (n <= 0) {
+                if (n == 0) stream->eof = 1;
+                else stream->error = 1;
+                break;
+            }
+            got += (size_t)n;
+        } else if (fill_in(stream)) {
+            break;
+        }
+    }
+    UNLOCK(stream);
+    return got / size;
 }
 
 size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
     if (!stream || size == 0 || nmemb == 0) return 0;
-    size_t total = size * nmemb;
-    ssize_t n = write(stream->fd, ptr, total);
-    if (n < 0) { stream->error = 1; return 0; }
+    LOCK(stream);
+    size_t n = write_locked(stream, ptr, size * nmemb);
+    UNLOCK(stream);
     return n / size;
 }
 
 int fseek(FILE *stream, long offset, int whence) {
     if (!stream) return -1;
-    int ret = lseek(stream->fd, offset, whence);
-    if (ret < 0) return -1;
-    stream->eof = 0;
-    return 0;
+    LOCK(stream);
+    if (whence == SEEK_CUR && stream->dir == DIR_READ)
+        offset -= (long)(stream->buf_len - stream->buf_pos) + (stream->ungot >= 0);
+    if (stream->dir == DIR_READ) {
+        stream->buf_pos = stream->buf_len = 0;
+        stream->ungot = -1;
+        stream->dir = DIR_NONE;
+    }
+    int err = flush_out(stream);
+    long ret = lseek(stream->fd, offset, whence);
+    if (ret >= 0) stream->eof = 0;
+    UNLOCK(stream);
+    return ret < 0 || err ? -1 : 0;
 }
 
 long ftell(FILE *stream) {
     if (!stream) return -1;
-    return lseek(stream->fd, 0, SEEK_CUR);
+    LOCK(stream);
+    long pos = (long)lseek(stream->fd, 0, SEEK_CUR);
+    if (pos >= 0) {
+        if (stream->dir == DIR_READ)
+            pos -= (long)(stream->buf_len - stream->buf_pos) + (stream->ungot >= 0);
+        else if (stream->dir == DIR_WRITE)
+            pos += (long)stream->buf_pos;
+    }
+    UNLOCK(stream);
+    return pos;
 }
 
 void rewind(FILE *stream) {
-    if (stream) {
-        fseek(stream, 0, SEEK_SET);
-        stream->error = 0;
-    }
+    if (stream) { fseek(stream, 0, SEEK_SET); stream->error = 0; }
 }
 
 int feof(FILE *stream) { return stream ? stream->eof : 0; }
@@ -103,43 +322,87 @@ int ferror(FILE *stream) { return stream ? stream->error : 0; }
 void clearerr(FILE *stream) { if (stream) { stream->eof = 0; stream->error = 0; } }
 
 int fflush(FILE *stream) {
-    (void)stream;
-    return 0; /* unbuffered for now */
+    if (stream) {
+        LOCK(stream);
+        int ret = stream->dir == DIR_READ ? (drop_input(stream), 0) : flush_out(stream);
+        UNLOCK(stream);
+        return ret;
+    }
+    /* NULL: flush every output stream. */
+    int ret = 0;
+    for (FILE *f = stream_list; f; f = f->next) {
+        if (flush_out(f)) ret = EOF;
+    }
+    return ret;
 }
 
 int fgetc(FILE *stream) {
-    if (stream->ungot >= 0) {
-        int c = stream->ungot;
-        stream->ungot = -1;
-        return c;
-    }
-    unsigned char c;
-    if (fread(&c, 1, 1, stream) == 1) return c;
-    return EOF;
+    LOCK(stream);
+    int c = getc_locked(stream);
+    UNLOCK(stream);
+    return c;
 }
 
 int ungetc(int c, FILE *stream) {
     if (c == EOF || !stream) return EOF;
+    LOCK(stream);
+    if (stream->dir == DIR_WRITE) flush_out(stream);
+    /* The pushback is part of the read position, so mark the stream as
+     * reading even before the first refill. */
+    if (stream->dir == DIR_NONE) {
+        stream->buf_pos = stream->buf_len = 0;
+        stream->dir = DIR_READ;
+    }
     stream->ungot = (unsigned char)c;
     stream->eof = 0;
+    UNLOCK(stream);
     return c;
 }
 
 int fputc(int c, FILE *stream) {
     unsigned char ch = (unsigned char)c;
-    if (fwrite(&ch, 1, 1, stream) == 1) return c;
-    return EOF;
+    LOCK(stream);
+    int ret = c & 0xFF;
+    if (stream->dir == DIR_WRITE && stream->mode != _IONBF && stream->buf_pos < stream->buf_size) {
+        stream->buf[stream->buf_pos++] = ch;
+        if ((stream->mode == _IOLBF && ch == '\n') || stream->buf_pos == stream->buf_size) {
+            if (flush_out(stream)) ret = EOF;
+        }
+    } else if (write_locked(stream, &ch, 1) != 1) {
+        ret = EOF;
+    }
+    UNLOCK(stream);
+    return ret;
 }
 
 char *fgets(char *s, int size, FILE *stream) {
     if (size <= 0) return NULL;
+    if (size == 1) { s[0] = '\0'; return s; }
     int i = 0;
+    LOCK(stream);
+    if (stream->ungot >= 0) {
+        s[i++] = (char)stream->ungot;
+        stream->ungot = -1;
+        if (s[0] == '\n') goto done;
+    }
     while (i < size - 1) {
-        int c = fgetc(stream);
-        if (c == EOF) { if (i == 0) return NULL; break; }
-        s[i++] = c;
-        if (c == '\n') break;
+        if (stream->dir != DIR_READ || stream->buf_pos >= stream->buf_len) {
+            if (fill_in(stream)) break;
+        }
+        /* Copy up to the newline in one go. */
+        const unsigned char *p = stream->buf + stream->buf_pos;
+        size_t n = stream->buf_len - stream->buf_pos;
+        if (n > (size_t)(size - 1 - i)) n = (size_t)(size - 1 - i);
+        const unsigned char *nl = memchr(p, '\n', n);
+        if (nl) n = (size_t)(nl - p) + 1;
+        memcpy(s + i, p, n);
+        stream->buf_pos += n;
+        i += (int)n;
+        if (nl) break;
     }
+done:
+    UNLOCK(stream);
+    if (i == 0) return NULL;
     s[i] = '\0';
     return s;
 }
@@ -153,7 +416,15 @@ int getc(FILE *stream) { return fgetc(stream); }
 int putc(int c, FILE *stream) { return fputc(c, stream); }
 int getchar(void) { return fgetc(stdin); }
 int putchar(int c) { return fputc(c, stdout); }
-int puts(const char *s) { fputs(s, stdout); fputc('\n', stdout); return 0; }
+
+int puts(const char *s) {
+    LOCK(stdout);
+    size_t len = strlen(s);
+    int ret = write_locked(stdout, (const unsigned char *)s, len) == len
+           && write_locked(stdout, (const unsigned char *)"\n", 1) == 1 ? 0 : EOF;
+    UNLOCK(stdout);
+    return ret;
+}
 
 /* --- printf implementation --- */
 
@@ -518,8 +789,9 @@ FILE *fdopen(int fd, const char *mode) {
     FILE *f = calloc(1, sizeof(FILE));
     if (!f) return NULL;
     f->fd = fd;
-    f->flags = (mode[0] == 'w' || mode[0] == 'a' || (mode[0] == 'r' && mode[1] == '+')) ? 1 : 0;
+    f->flags = (mode[0] == 'w' || mode[0] == 'a' || (mode[0] == 'r' && mode[1] == '+')) ? F_WRITE : 0;
     f->ungot = -1;
+    link_stream(f);
     return f;
 }
 
@@ -529,8 +801,33 @@ int fileno(FILE *stream) {
 }
 
 int setvbuf(FILE *stream, char *buf, int mode, size_t size) {
-    (void)stream; (void)buf; (void)mode; (void)size;
-    return 0; /* unbuffered */
+    if (!stream || (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)) return -1;
+    int ret = flush_out(stream);
+    drop_input(stream);
+    release_buf(stream);
+    stream->flags |= F_BUFSET;
+    stream->mode = mode;
+    if (mode != _IONBF && buf && size > 0) {
+        stream->buf = (unsigned char *)buf;
+        stream->buf_size = size;
+    } else if (mode != _IONBF && (stream->buf = malloc(size ? size : BUFSIZ)) != NULL) {
+        stream->buf_size = size ? size : BUFSIZ;
+        stream->flags |= F_OWNBUF;
+    } else {
+        if (mode != _IONBF) ret = -1;
+        stream->mode = _IONBF;
+        stream->buf = stream->nbuf;
+        stream->buf_size = 1;
+    }
+    return ret ? -1 : 0;
+}
+
+void setbuf(FILE *stream, char *buf) {
+    setvbuf(stream, buf, buf ? _IOFBF : _IONBF, BUFSIZ);
+}
+
+void setlinebuf(FILE *stream) {
+    setvbuf(stream, NULL, _IOLBF, 0);
 }
 
 FILE *freopen(const char *path, const char *mode, FILE *stream) {
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdio.h>
 #include <sys/syscall.h>
 
 /* Arena-based malloc: requests memory from sbrk in large chunks, suballocates
@@ -119,7 +120,11 @@ void free(void *ptr) {
     blk->free = 1;
 }
 
+extern void __run_atexit(void);
+
 void exit(int status) {
+    __run_atexit();
+    fflush(NULL);
     _exit(status);
     __builtin_unreachable();
 }
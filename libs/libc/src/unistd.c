@@ -192,6 +192,12 @@ int ftruncate(int fd, unsigned int length) {
     return 0;
 }
 
+int fsync(int fd) {
+    int r = _syscall(SYS_FSYNC, fd, 0, 0, 0);
+    if (r < 0) { errno = -r; return -1; }
+    return 0;
+}
+
 ssize_t pread(int fd, void *buf, size_t count, long offset) {
     int saved = lseek(fd, 0, SEEK_CUR);
     if (saved < 0) return -1;
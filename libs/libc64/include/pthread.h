@@ -4,8 +4,8 @@
  *
  * libc64 — POSIX threads (pthreads) interface for anyOS.
  *
- * Provides thread creation/join, spinlock-based mutexes (no futex syscall),
- * spin-wait condition variables, thread-local storage, and once semantics.
+ * Provides thread creation/join, futex-backed mutexes, condition variables,
+ * read-write locks and barriers, thread-local storage, and once semantics.
  */
 
 #ifndef _PTHREAD_H
@@ -14,6 +14,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <sched.h>
+#include <time.h>
 
 /* ── Thread handle ── */
 
@@ -35,18 +36,21 @@ typedef struct {
 /* ── Mutex ── */
 
 /**
- * Spinlock-based mutex (no futex available).
- * The lock word is atomically exchanged; owner stores the locking TID
- * for debugging purposes.
+ * Futex-backed mutex.
+ * Lockers spin briefly on the lock word, then sleep in SYS_FUTEX_WAIT.
+ * owner and count are maintained only for recursive and error-checking
+ * mutexes.
  */
 typedef struct {
-    volatile int    lock;   /**< 0 = unlocked, 1 = locked. */
-    unsigned long   owner;  /**< TID of the thread holding the lock (informational). */
+    volatile unsigned int lock;   /**< 0 = unlocked, 1 = locked, 2 = locked with sleepers. */
+    int             type;   /**< PTHREAD_MUTEX_NORMAL, _RECURSIVE or _ERRORCHECK. */
+    unsigned int    count;  /**< Recursion depth of the owner. */
+    volatile unsigned long owner;  /**< TID of the owning thread (non-normal types). */
 } pthread_mutex_t;
 
-/** Mutex attributes (reserved for future use). */
+/** Mutex attributes. */
 typedef struct {
-    int             type;   /**< Mutex type (currently unused). */
+    int             type;   /**< Mutex type (PTHREAD_MUTEX_*). */
 } pthread_mutexattr_t;
 
 /** Mutex type constants. */
@@ -55,15 +59,18 @@ typedef struct {
 #define PTHREAD_MUTEX_ERRORCHECK 2
 #define PTHREAD_MUTEX_DEFAULT    PTHREAD_MUTEX_NORMAL
 
-/** Static initializer for pthread_mutex_t. */
-#define PTHREAD_MUTEX_INITIALIZER { 0, 0 }
+/** Static initializers for pthread_mutex_t. */
+#define PTHREAD_MUTEX_INITIALIZER { 0, PTHREAD_MUTEX_NORMAL, 0, 0 }
+#define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP { 0, PTHREAD_MUTEX_RECURSIVE, 0, 0 }
+#define PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP { 0, PTHREAD_MUTEX_ERRORCHECK, 0, 0 }
 
 /* ── Read-write lock ── */
 
-/** Spinlock-based read-write lock. */
+/** Futex-backed, reader-preferring read-write lock. */
 typedef struct {
-    volatile int    readers;  /**< Number of active readers. */
-    volatile int    writer;   /**< 1 if writer holds lock, 0 otherwise. */
+    volatile unsigned int state;    /**< Reader count, or 0xFFFFFFFF while write-locked. */
+    volatile unsigned int seq;      /**< Futex word bumped when the lock becomes free. */
+    volatile unsigned int waiters;  /**< Threads sleeping on seq. */
 } pthread_rwlock_t;
 
 /** Read-write lock attributes (reserved). */
@@ -72,17 +79,18 @@ typedef struct {
 } pthread_rwlockattr_t;
 
 /** Static initializer for pthread_rwlock_t. */
-#define PTHREAD_RWLOCK_INITIALIZER { 0, 0 }
+#define PTHREAD_RWLOCK_INITIALIZER { 0, 0, 0 }
 
 /* ── Condition variable ── */
 
 /**
- * Spin-wait condition variable.
- * Waiters observe an atomic sequence counter; signal/broadcast increments it
- * to wake spinners.
+ * Futex-backed condition variable.
+ * Waiters sleep on an atomic sequence counter; signal/broadcast increments it
+ * and wakes one or all sleepers.
  */
 typedef struct {
-    volatile unsigned int seq;  /**< Monotonically increasing sequence number. */
+    volatile unsigned int seq;      /**< Monotonically increasing sequence number. */
+    volatile unsigned int waiters;  /**< Threads currently waiting. */
 } pthread_cond_t;
 
 /** Condition variable attributes (reserved for future use). */
@@ -91,7 +99,24 @@ typedef struct {
 } pthread_condattr_t;
 
 /** Static initializer for pthread_cond_t. */
-#define PTHREAD_COND_INITIALIZER { 0 }
+#define PTHREAD_COND_INITIALIZER { 0, 0 }
+
+/* ── Barrier ── */
+
+/** Futex-backed reusable barrier. */
+typedef struct {
+    unsigned int    count;          /**< Threads required to release the barrier. */
+    volatile unsigned int arrived;  /**< Threads waiting in the current round. */
+    volatile unsigned int gen;      /**< Round counter; waiters sleep on it. */
+} pthread_barrier_t;
+
+/** Barrier attributes (reserved). */
+typedef struct {
+    int             _unused;
+} pthread_barrierattr_t;
+
+/** Returned by pthread_barrier_wait to exactly one thread per round. */
+#define PTHREAD_BARRIER_SERIAL_THREAD (-1)
 
 /* ── Once ── */
 
@@ -233,9 +258,10 @@ int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
 int pthread_mutex_destroy(pthread_mutex_t *mutex);
 
 /**
- * Lock a mutex, spinning with yield on contention.
+ * Lock a mutex, spinning briefly and then sleeping on contention.
  *
- * @return 0 on success.
+ * @return 0 on success, EDEADLK if an error-checking mutex is already
+ *         held by the caller.
  */
 int pthread_mutex_lock(pthread_mutex_t *mutex);
 
@@ -249,7 +275,8 @@ int pthread_mutex_trylock(pthread_mutex_t *mutex);
 /**
  * Unlock a mutex.
  *
- * @return 0 on success.
+ * @return 0 on success, EPERM if a recursive or error-checking mutex is
+ *         not held by the caller.
  */
 int pthread_mutex_unlock(pthread_mutex_t *mutex);
 
@@ -304,12 +331,18 @@ int pthread_cond_destroy(pthread_cond_t *cond);
 /**
  * Atomically unlock the mutex, wait for a signal on cond, then re-lock.
  *
- * Uses spin-waiting with yield since no futex syscall is available.
- *
  * @return 0 on success.
  */
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
 
+/**
+ * Like pthread_cond_wait, but give up at the CLOCK_REALTIME deadline abstime.
+ *
+ * @return 0 on wakeup, ETIMEDOUT once the deadline has passed.
+ */
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime);
+
 /**
  * Wake at least one thread waiting on the condition variable.
  *
@@ -396,6 +429,27 @@ int pthread_rwlock_unlock(pthread_rwlock_t *rwlock);
 int pthread_rwlockattr_init(pthread_rwlockattr_t *attr);
 int pthread_rwlockattr_destroy(pthread_rwlockattr_t *attr);
 
+/* ── Barriers ── */
+
+/**
+ * Initialize a barrier that releases once count threads have arrived.
+ *
+ * @return 0 on success, EINVAL if count is 0.
+ */
+int pthread_barrier_init(pthread_barrier_t *barrier,
+                         const pthread_barrierattr_t *attr, unsigned int count);
+int pthread_barrier_destroy(pthread_barrier_t *barrier);
+
+/**
+ * Block until count threads have called pthread_barrier_wait.
+ *
+ * @return PTHREAD_BARRIER_SERIAL_THREAD in one thread, 0 in the others.
+ */
+int pthread_barrier_wait(pthread_barrier_t *barrier);
+
+int pthread_barrierattr_init(pthread_barrierattr_t *attr);
+int pthread_barrierattr_destroy(pthread_barrierattr_t *attr);
+
 /* ── Thread naming (non-portable extensions) ── */
 
 /**
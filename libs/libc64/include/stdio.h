@@ -10,7 +10,7 @@
 #include <stdarg.h>
 
 #define EOF (-1)
-#define BUFSIZ 1024
+#define BUFSIZ 4096
 #define FILENAME_MAX 256
 
 #define SEEK_SET 0
@@ -22,10 +22,16 @@ typedef struct _FILE {
     int flags;
     int eof;
     int error;
-    unsigned char buf[BUFSIZ];
-    int buf_pos;
-    int buf_len;
+    unsigned char *buf;     /* stream buffer (allocated on first use) */
+    size_t buf_size;
+    size_t buf_pos;         /* next byte to read / bytes waiting to be written */
+    size_t buf_len;         /* valid bytes while reading */
+    int mode;               /* _IOFBF, _IOLBF or _IONBF */
+    int dir;                /* buffer holds: 0 nothing, 1 input, 2 output */
     int ungot;  /* ungetc character, -1 if none */
+    volatile int lock;
+    struct _FILE *next;     /* open-stream list (fflush(NULL), exit) */
+    unsigned char nbuf[1];  /* buffer for _IONBF streams */
 } FILE;
 
 #ifdef __cplusplus
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2024-2026 Christian Moeller
+ * SPDX-License-Identifier: MIT
+ *
+ * libc64 — x86_64 memory allocator.
+ *
+ * Boundary-tag allocator with segregated free lists:
+ *   - Every chunk starts with two words: the size of the previous chunk
+ *     (valid only while that chunk is free) and its own size, whose low
+ *     bits say whether it and its predecessor are in use.  free() merges a
+ *     chunk with free neighbours at once, so the heap cannot splinter into
+ *     runs of small free blocks.
+ *   - Free chunks below 1 KiB sit in exact-size bins (16-byte steps),
+ *     larger ones in four bins per power of two.  A bitmap of non-empty
+ *     bins finds the smallest bin that fits without walking any list.
+ *   - The heap grows from the untouched end ("top") in 64 KiB sbrk steps,
+ *     falling back to SYS_MMAP segments once sbrk hits the DLIB region.
+ *   - Requests of MMAP_THRESHOLD and up get a mapping of their own, given
+ *     back to the kernel with SYS_MUNMAP on free.
+ *   - realloc() grows in place into a free neighbour or the top.
+ *
+ * One spinlock guards the heap.  Per-thread caches would need a futex to
+ * sleep on; until the kernel has one, contention yields like
+ * pthread_mutex_lock.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <sys/syscall.h>
+
+extern long _syscall(long num, long a1, long a2, long a3, long a4, long a5);
+
+typedef struct chunk {
+    size_t prev_size;       /* size of the previous chunk, if it is free */
+    size_t head;            /* size | CINUSE | PINUSE | MMAPPED */
+    struct chunk *fd;       /* bin links, only while free */
+    struct chunk *bk;
+} chunk_t;
+
+#define CINUSE          1   /* this chunk is allocated */
+#define PINUSE          2   /* the previous chunk is allocated */
+#define MMAPPED         4   /* this chunk is a mapping of its own */
+#define FLAG_BITS       7
+
+#define CHUNK_OVERHEAD  16  /* header words in front of the payload */
+#define MIN_CHUNK       32  /* header + bin links */
+#define FENCE_SIZE      16  /* in-use stub closing a heap segment */
+#define ARENA_CHUNK     65536           /* grow the heap 64 KiB at a time */
+#define MMAP_THRESHOLD  (128 * 1024)    /* own mapping from this size up */
+#define MAX_REQUEST     0xFFFF0000UL    /* SYS_MMAP takes a 32-bit size */
+#define PAGE_SIZE       4096
+
+#define NSMALL          64              /* exact bins below SMALL_LIMIT */
+#define SMALL_LIMIT     (NSMALL * 16)
+#define NBINS           128
+
+#define ALIGN_UP(x, a)  (((x) + (a) - 1) & ~((size_t)(a) - 1))
+#define chunk_size(c)   ((c)->head & ~(size_t)FLAG_BITS)
+#define chunk_at(c, o)  ((chunk_t *)((char *)(c) + (o)))
+#define mem2chunk(p)    ((chunk_t *)((char *)(p) - CHUNK_OVERHEAD))
+#define chunk2mem(c)    ((void *)((char *)(c) + CHUNK_OVERHEAD))
+
+static chunk_t *bins[NBINS];
+static uint64_t binmap[NBINS / 64];
+
+static chunk_t *top = NULL;     /* untouched end of the current segment */
+static size_t top_size = 0;
+
+static volatile int heap_lock = 0;
+
+static void lock_heap(void) {
+    int spins = 0;
+    while (__atomic_exchange_n(&heap_lock, 1, __ATOMIC_ACQUIRE) != 0) {
+        if (++spins >= 16) {
+            _syscall(SYS_YIELD, 0, 0, 0, 0, 0);
+            spins = 0;
+        }
+    }
+}
+
+static void unlock_heap(void) {
+    __atomic_store_n(&heap_lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Chunk size for an n-byte request.  An allocated chunk's payload runs
+ * into the next chunk's prev_size word, which only a free chunk uses. */
+static size_t request_size(size_t n) {
+    size_t nb = ALIGN_UP(n + sizeof(size_t), 16);
+    return nb < MIN_CHUNK ? MIN_CHUNK : nb;
+}
+
+/* Payload bytes an allocated chunk can hold. */
+static size_t usable_size(chunk_t *c) {
+    if (c->head & MMAPPED) return chunk_size(c) - CHUNK_OVERHEAD;
+    return chunk_size(c) - CHUNK_OVERHEAD + sizeof(size_t);
+}
+
+/* ── Bins ── */
+
+static unsigned bin_index(size_t size) {
+    if (size < SMALL_LIMIT) return (unsigned)(size >> 4);
+    unsigned log = 63 - (unsigned)__builtin_clzl(size);
+    unsigned idx = NSMALL + (log - 10) * 4 + (unsigned)((size >> (log - 2)) & 3);
+    return idx < NBINS ? idx : NBINS - 1;
+}
+
+static void bin_insert(chunk_t *c) {
+    unsigned idx = bin_index(chunk_size(c));
+    c->bk = NULL;
+    c->fd = bins[idx];
+    if (c->fd) c->fd->bk = c;
+    bins[idx] = c;
+    binmap[idx / 64] |= 1UL << (idx % 64);
+}
+
+static void bin_unlink(chunk_t *c) {
+    unsigned idx = bin_index(chunk_size(c));
+    if (c->bk) c->bk->fd = c->fd;
+    else bins[idx] = c->fd;
+    if (c->fd) c->fd->bk = c->bk;
+    if (!bins[idx]) binmap[idx / 64] &= ~(1UL << (idx % 64));
+}
+
+/* First non-empty bin at or above idx, or NBINS. */
+static unsigned next_bin(unsigned idx) {
+    while (idx < NBINS) {
+        uint64_t bits = binmap[idx / 64] & (~0UL << (idx % 64));
+        if (bits) return (idx & ~63u) + (unsigned)__builtin_ctzl(bits);
+        idx = (idx & ~63u) + 64;
+    }
+    return NBINS;
+}
+
+/* Take a free chunk of at least nb bytes out of the bins. */
+static chunk_t *bin_take(size_t nb) {
+    unsigned idx = bin_index(nb);
+    chunk_t *best = NULL;
+    if (idx >= NSMALL) {
+        /* Large bins hold a range of sizes: best fit within the first. */
+        for (chunk_t *c = bins[idx]; c; c = c->fd) {
+            size_t cs = chunk_size(c);
+            if (cs >= nb && (!best || cs < chunk_size(best))) {
+                best = c;
+                if (cs == nb) break;
+            }
+        }
+        idx++;
+    }
+    if (!best) {
+        /* Every chunk in a higher bin is big enough. */
+        idx = next_bin(idx);
+        if (idx == NBINS) return NULL;
+        best = bins[idx];
+    }
+    bin_unlink(best);
+    return best;
+}
+
+/* ── Chunk operations ── */
+
+/* Mark free chunk c (of its current size) allocated, splitting nb bytes
+ * off its front if the rest is big enough to stand alone. */
+static void use_chunk(chunk_t *c, size_t nb) {
+    size_t cs = chunk_size(c);
+    if (cs - nb >= MIN_CHUNK) {
+        c->head = nb | CINUSE | (c->head & PINUSE);
+        chunk_t *rest = chunk_at(c, nb);
+        rest->head = (cs - nb) | PINUSE;
+        chunk_at(rest, cs - nb)->prev_size = cs - nb;
+        bin_insert(rest);
+    } else {
+        c->head |= CINUSE;
+        chunk_at(c, cs)->head |= PINUSE;
+    }
+}
+
+/* Free heap chunk c, merging it with free neighbours or the top. */
+static void free_chunk(chunk_t *c) {
+    size_t size = chunk_size(c);
+    chunk_t *next = chunk_at(c, size);
+
+    if (!(c->head & PINUSE)) {
+        chunk_t *prev = chunk_at(c, -(long)c->prev_size);
+        bin_unlink(prev);
+        size += c->prev_size;
+        c = prev;
+    }
+    if (next == top) {
+        top = c;
+        top_size += size;
+        top->head = top_size | PINUSE;
+        return;
+    }
+    if (!(next->head & CINUSE)) {
+        bin_unlink(next);
+        size += chunk_size(next);
+    } else {
+        next->head &= ~(size_t)PINUSE;
+    }
+    c->head = size | PINUSE;
+    chunk_at(c, size)->prev_size = size;
+    bin_insert(c);
+}
+
+/* Shrink allocated heap chunk c to nb bytes, freeing the tail. */
+static void trim_chunk(chunk_t *c, size_t nb) {
+    size_t cs = chunk_size(c);
+    if (cs - nb < MIN_CHUNK) return;
+    c->head = nb | CINUSE | (c->head & PINUSE);
+    chunk_t *rest = chunk_at(c, nb);
+    rest->head = (cs - nb) | CINUSE | PINUSE;
+    free_chunk(rest);
+}
+
+/* SYS_MMAP wrapper: zeroed pages, or NULL. */
+static void *map_pages(size_t len) {
+    long addr = _syscall(SYS_MMAP, (long)len, 0, 0, 0, 0);
+    if (addr == (long)0xFFFFFFFF || addr == 0) return NULL;
+    return (void *)(uintptr_t)addr;
+}
+
+/* Give an n-byte request a mapping of its own. */
+static chunk_t *map_chunk(size_t n) {
+    size_t len = ALIGN_UP(n + CHUNK_OVERHEAD, PAGE_SIZE);
+    chunk_t *c = map_pages(len);
+    if (!c) return NULL;
+    c->prev_size = 0;   /* distance back to the start of the mapping */
+    c->head = len | MMAPPED | CINUSE;
+    return c;
+}
+
+static void unmap_chunk(chunk_t *c) {
+    _syscall(SYS_MUNMAP, (long)(uintptr_t)((char *)c - c->prev_size),
+             (long)(chunk_size(c) + c->prev_size), 0, 0, 0);
+}
+
+/* Make the top at least nb + MIN_CHUNK bytes.  Extends the top when sbrk
+ * returns memory right after it; otherwise the old top is freed behind a
+ * fence and the new memory becomes the top. */
+static int grow_heap(size_t nb) {
+    size_t need = nb + MIN_CHUNK + FENCE_SIZE + 16;
+    size_t len = ALIGN_UP(need, ARENA_CHUNK);
+    char *p = sbrk((long)len);
+    if (p == (char *)-1) {
+        p = map_pages(len);
+        if (!p) return 0;
+    }
+
+    /* The top ends up to 15 bytes short of the break when the first
+     * sbrk returned an unaligned address; that gap stays put. */
+    if (top && (size_t)(p - ((char *)top + top_size)) < 16) {
+        top_size += len;
+        top->head = top_size | PINUSE;
+        return 1;
+    }
+
+    if (top) {
+        if (top_size >= MIN_CHUNK + FENCE_SIZE) {
+            chunk_t *fence = chunk_at(top, top_size - FENCE_SIZE);
+            fence->prev_size = top_size - FENCE_SIZE;
+            fence->head = FENCE_SIZE | CINUSE;
+            top->head = (top_size - FENCE_SIZE) | PINUSE;
+            bin_insert(top);
+        } else {
+            top->head = top_size | CINUSE | PINUSE;
+        }
+    }
+    char *start = (char *)ALIGN_UP((uintptr_t)p, 16);
+    top = (chunk_t *)start;
+    top_size = (len - (size_t)(start - p)) & ~(size_t)15;
+    top->head = top_size | PINUSE;
+    return 1;
+}
+
+/* malloc() with the heap lock held. */
+static void *malloc_locked(size_t n) {
+    if (n > MAX_REQUEST) return NULL;
+    if (n >= MMAP_THRESHOLD) {
+        chunk_t *c = map_chunk(n);
+        if (c) return chunk2mem(c);
+    }
+
+    size_t nb = request_size(n);
+    chunk_t *c = bin_take(nb);
+    if (c) {
+        use_chunk(c, nb);
+        return chunk2mem(c);
+    }
+
+    if (!top || top_size < nb + MIN_CHUNK) {
+        if (!grow_heap(nb)) return NULL;
+    }
+    c = top;
+    c->head = nb | CINUSE | (top->head & PINUSE);
+    top = chunk_at(c, nb);
+    top_size -= nb;
+    top->head = top_size | PINUSE;
+    return chunk2mem(c);
+}
+
+static void free_locked(void *ptr) {
+    chunk_t *c = mem2chunk(ptr);
+    if (c->head & MMAPPED) unmap_chunk(c);
+    else free_chunk(c);
+}
+
+/* Grow or shrink heap chunk c to nb bytes without moving it. */
+static int resize_in_place(chunk_t *c, size_t nb) {
+    size_t cs = chunk_size(c);
+    if (cs >= nb) {
+        trim_chunk(c, nb);
+        return 1;
+    }
+    chunk_t *next = chunk_at(c, cs);
+    if (next == top) {
+        if (cs + top_size < nb + MIN_CHUNK) return 0;
+        top_size -= nb - cs;
+        c->head = nb | CINUSE | (c->head & PINUSE);
+        top = chunk_at(c, nb);
+        top->head = top_size | PINUSE;
+        return 1;
+    }
+    if (next->head & CINUSE || cs + chunk_size(next) < nb) return 0;
+    bin_unlink(next);
+    cs += chunk_size(next);
+    c->head = cs | CINUSE | (c->head & PINUSE);
+    chunk_at(c, cs)->head |= PINUSE;
+    trim_chunk(c, nb);
+    return 1;
+}
+
+/* ── Public interface ── */
+
+void *malloc(size_t size) {
+    lock_heap();
+    void *p = malloc_locked(size);
+    unlock_heap();
+    if (!p) errno = ENOMEM;
+    return p;
+}
+
+void free(void *ptr) {
+    if (!ptr) return;
+    lock_heap();
+    free_locked(ptr);
+    unlock_heap();
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(nmemb, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    void *p = malloc(total);
+    /* Fresh mappings come zeroed from the kernel. */
+    if (p && !(mem2chunk(p)->head & MMAPPED)) memset(p, 0, total);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    if (size == 0) { free(ptr); return NULL; }
+    if (size > MAX_REQUEST) { errno = ENOMEM; return NULL; }
+
+    lock_heap();
+    chunk_t *c = mem2chunk(ptr);
+    if (c->head & MMAPPED) {
+        /* Keep the mapping while the block still needs most of it. */
+        if (size <= usable_size(c) && size >= usable_size(c) / 2) {
+            unlock_heap();
+            return ptr;
+        }
+    } else if (resize_in_place(c, request_size(size))) {
+        unlock_heap();
+        return ptr;
+    }
+
+    void *p = malloc_locked(size);
+    if (p) {
+        size_t old = usable_size(c);
+        memcpy(p, ptr, old < size ? old : size);
+        free_locked(ptr);
+    }
+    unlock_heap();
+    if (!p) errno = ENOMEM;
+    return p;
+}
+
+/* Allocate size bytes aligned to align (a power of two). */
+static void *memalign_locked(size_t align, size_t size) {
+    if (align <= 16) return malloc_locked(size);
+    if (size > MAX_REQUEST - align - MIN_CHUNK) return NULL;
+
+    char *p = malloc_locked(size + align + MIN_CHUNK);
+    if (!p) return NULL;
+    chunk_t *c = mem2chunk(p);
+    if (((uintptr_t)p & (align - 1)) == 0) {
+        if (!(c->head & MMAPPED)) trim_chunk(c, request_size(size));
+        return p;
+    }
+
+    /* Move the chunk start up to the next aligned payload that leaves
+     * room for a chunk in front of it. */
+    char *a = (char *)ALIGN_UP((uintptr_t)p, align);
+    if ((size_t)(a - p) < MIN_CHUNK) a += align;
+    chunk_t *ac = mem2chunk(a);
+    size_t lead = (size_t)((char *)ac - (char *)c);
+    size_t rest = chunk_size(c) - lead;
+
+    if (c->head & MMAPPED) {
+        ac->prev_size = c->prev_size + lead;
+        ac->head = rest | MMAPPED | CINUSE;
+        return a;
+    }
+    ac->head = rest | CINUSE | PINUSE;
+    c->head = lead | CINUSE | (c->head & PINUSE);
+    free_chunk(c);
+    trim_chunk(ac, request_size(size));
+    return a;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    lock_heap();
+    void *p = memalign_locked(alignment, size);
+    unlock_heap();
+    if (!p) errno = ENOMEM;
+    return p;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1))) return EINVAL;
+    lock_heap();
+    void *p = memalign_locked(alignment, size);
+    unlock_heap();
+    if (!p) return ENOMEM;
+    *memptr = p;
+    return 0;
+}
@@ -5,7 +5,8 @@
  * libc64 — POSIX threads (pthreads) implementation for anyOS.
  *
  * Constraints:
- *   - No futex syscall — mutexes use atomic spinlocks with yield-on-contention.
+ *   - Mutexes, condition variables, rwlocks, barriers and pthread_once
+ *     spin briefly, then sleep on SYS_FUTEX_WAIT; see "Futex helpers".
  *   - No proper TLS segment — thread-local storage uses a static array indexed
  *     by (tid % MAX_THREADS).
  *   - Stacks are allocated via SYS_MMAP (kernel page allocator) and freed via
@@ -16,6 +17,7 @@
 #include <errno.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 #include <sys/syscall.h>
 
@@ -410,54 +412,172 @@ int pthread_attr_getdetachstate(const pthread_attr_t *attr, int *detachstate) {
 }
 
 /* ──────────────────────────────────────────────────────────────────────
- *  Mutexes (spinlock-based — no futex available)
+ *  Futex helpers
+ *
+ *  SYS_FUTEX_WAIT sleeps only while the 32-bit word still holds the
+ *  expected value, so a wake that lands between our load and the
+ *  syscall is never lost.  Every blocking primitive below spins briefly
+ *  on its lock word first: critical sections are usually shorter than
+ *  a trip through the scheduler.
  * ────────────────────────────────────────────────────────────────────── */
 
+#define SPIN_LIMIT      100             /* Polls before sleeping in the kernel */
+#define FUTEX_FOREVER   0xFFFFFFFFu     /* timeout_ms value: wait indefinitely */
+#define FUTEX_TIMEDOUT  (0xFFFFFFFFu - 109)
+#define WAKE_ALL        0x7FFFFFFF
+
+static inline void _cpu_relax(void) {
+    __asm__ volatile("pause" ::: "memory");
+}
+
+/** Sleep while *addr == val.  Returns the raw kernel status. */
+static unsigned int _futex_wait(volatile unsigned int *addr, unsigned int val,
+                                unsigned int timeout_ms) {
+    return (unsigned int)_syscall(SYS_FUTEX_WAIT, (long)(uintptr_t)addr,
+                                  (long)val, (long)timeout_ms, 0, 0);
+}
+
+/** Wake up to count threads sleeping on addr. */
+static void _futex_wake(volatile unsigned int *addr, int count) {
+    _syscall(SYS_FUTEX_WAKE, (long)(uintptr_t)addr, (long)count, 0, 0, 0);
+}
+
+/**
+ * Convert an absolute CLOCK_REALTIME deadline into a futex timeout.
+ *
+ * @return Milliseconds left (rounded up, at least 1), or 0 if the
+ *         deadline has already passed.
+ */
+static unsigned int _deadline_ms(const struct timespec *abstime) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long long ns = (long long)(abstime->tv_sec - now.tv_sec) * 1000000000LL
+                 + (abstime->tv_nsec - now.tv_nsec);
+    if (ns <= 0) return 0;
+    long long ms = (ns + 999999) / 1000000;
+    if (ms >= (long long)FUTEX_FOREVER) ms = FUTEX_FOREVER - 1;
+    return (unsigned int)ms;
+}
+
+/* ──────────────────────────────────────────────────────────────────────
+ *  Mutexes
+ *
+ *  The lock word has three states: 0 = unlocked, 1 = locked with no
+ *  sleepers, 2 = locked and somebody may be sleeping.  Unlock only
+ *  enters the kernel when it sees 2, so an uncontended lock/unlock pair
+ *  is two atomic instructions.  Only recursive and error-checking
+ *  mutexes need the owner TID, so normal mutexes never ask for it.
+ * ────────────────────────────────────────────────────────────────────── */
+
+/**
+ * Acquire the lock word.
+ *
+ * @param contended  Start in state 2 — used when re-locking after a
+ *                   condition wait, where other sleepers may exist.
+ */
+static void _lock_word(volatile unsigned int *lock, int contended) {
+    unsigned int c = 0;
+    if (!contended) {
+        if (__atomic_compare_exchange_n(lock, &c, 1, 0, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED))
+            return;
+        for (int i = 0; i < SPIN_LIMIT && c != 2; i++) {
+            _cpu_relax();
+            c = 0;
+            if (__atomic_compare_exchange_n(lock, &c, 1, 0, __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED))
+                return;
+        }
+    }
+    /* Announce a sleeper; whoever unlocks from 2 must wake us. */
+    while (__atomic_exchange_n(lock, 2, __ATOMIC_ACQUIRE) != 0) {
+        _futex_wait(lock, 2, FUTEX_FOREVER);
+    }
+}
+
+/** Release the lock word, waking one sleeper if any. */
+static void _unlock_word(volatile unsigned int *lock) {
+    if (__atomic_exchange_n(lock, 0, __ATOMIC_RELEASE) == 2) {
+        _futex_wake(lock, 1);
+    }
+}
+
+static unsigned long _self_tid(void) {
+    return (unsigned long)_syscall(SYS_GETPID, 0, 0, 0, 0, 0);
+}
+
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
-    (void)attr;
     if (!mutex) return EINVAL;
     mutex->lock = 0;
+    mutex->type = attr ? attr->type : PTHREAD_MUTEX_DEFAULT;
+    mutex->count = 0;
     mutex->owner = 0;
     return 0;
 }
 
 int pthread_mutex_destroy(pthread_mutex_t *mutex) {
-    (void)mutex;
+    if (!mutex) return EINVAL;
+    if (__atomic_load_n(&mutex->lock, __ATOMIC_RELAXED) != 0) return EBUSY;
     return 0;
 }
 
 int pthread_mutex_lock(pthread_mutex_t *mutex) {
     if (!mutex) return EINVAL;
 
-    /*
-     * Spin with CAS.  After several failed attempts, yield to the
-     * scheduler so we do not burn CPU cycles indefinitely.  This is
-     * the best we can do without a futex/wait queue.
-     */
-    int spins = 0;
-    while (__atomic_exchange_n(&mutex->lock, 1, __ATOMIC_ACQUIRE) != 0) {
-        if (++spins >= 16) {
-            _syscall(SYS_YIELD, 0, 0, 0, 0, 0);
-            spins = 0;
-        }
+    if (mutex->type == PTHREAD_MUTEX_NORMAL) {
+        _lock_word(&mutex->lock, 0);
+        return 0;
+    }
+
+    unsigned long self = _self_tid();
+    if (__atomic_load_n(&mutex->owner, __ATOMIC_RELAXED) == self) {
+        if (mutex->type == PTHREAD_MUTEX_ERRORCHECK) return EDEADLK;
+        if (mutex->count == 0xFFFFFFFFu) return EAGAIN;
+        mutex->count++;
+        return 0;
     }
-    mutex->owner = (unsigned long)_syscall(SYS_GETPID, 0, 0, 0, 0, 0);
+    _lock_word(&mutex->lock, 0);
+    __atomic_store_n(&mutex->owner, self, __ATOMIC_RELAXED);
+    mutex->count = 1;
     return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t *mutex) {
     if (!mutex) return EINVAL;
-    if (__atomic_exchange_n(&mutex->lock, 1, __ATOMIC_ACQUIRE) != 0) {
+
+    unsigned long self = 0;
+    if (mutex->type != PTHREAD_MUTEX_NORMAL) {
+        self = _self_tid();
+        if (__atomic_load_n(&mutex->owner, __ATOMIC_RELAXED) == self) {
+            if (mutex->type == PTHREAD_MUTEX_ERRORCHECK) return EBUSY;
+            if (mutex->count == 0xFFFFFFFFu) return EAGAIN;
+            mutex->count++;
+            return 0;
+        }
+    }
+
+    unsigned int c = 0;
+    if (!__atomic_compare_exchange_n(&mutex->lock, &c, 1, 0, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_RELAXED)) {
         return EBUSY;
     }
-    mutex->owner = (unsigned long)_syscall(SYS_GETPID, 0, 0, 0, 0, 0);
+    if (self) {
+        __atomic_store_n(&mutex->owner, self, __ATOMIC_RELAXED);
+        mutex->count = 1;
+    }
     return 0;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex) {
     if (!mutex) return EINVAL;
-    mutex->owner = 0;
-    __atomic_store_n(&mutex->lock, 0, __ATOMIC_RELEASE);
+
+    if (mutex->type != PTHREAD_MUTEX_NORMAL) {
+        if (__atomic_load_n(&mutex->owner, __ATOMIC_RELAXED) != _self_tid())
+            return EPERM;
+        if (--mutex->count != 0) return 0;
+        __atomic_store_n(&mutex->owner, 0, __ATOMIC_RELAXED);
+    }
+    _unlock_word(&mutex->lock);
     return 0;
 }
 
@@ -465,7 +585,7 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex) {
 
 int pthread_mutexattr_init(pthread_mutexattr_t *attr) {
     if (!attr) return EINVAL;
-    attr->type = 0;
+    attr->type = PTHREAD_MUTEX_DEFAULT;
     return 0;
 }
 
@@ -474,53 +594,109 @@ int pthread_mutexattr_destroy(pthread_mutexattr_t *attr) {
     return 0;
 }
 
+int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int type) {
+    if (!attr) return EINVAL;
+    if (type != PTHREAD_MUTEX_NORMAL && type != PTHREAD_MUTEX_RECURSIVE &&
+        type != PTHREAD_MUTEX_ERRORCHECK) return EINVAL;
+    attr->type = type;
+    return 0;
+}
+
+int pthread_mutexattr_gettype(const pthread_mutexattr_t *attr, int *type) {
+    if (!attr || !type) return EINVAL;
+    *type = attr->type;
+    return 0;
+}
+
 /* ──────────────────────────────────────────────────────────────────────
- *  Condition variables (spin-wait based — no futex available)
+ *  Condition variables
+ *
+ *  Waiters sleep on a sequence counter that every signal/broadcast
+ *  bumps.  The snapshot is taken while the caller still holds the
+ *  mutex, so a signal issued after the unlock changes the word and
+ *  FUTEX_WAIT returns immediately instead of missing it.  The waiter
+ *  count lets signal/broadcast skip the syscall when nobody sleeps.
  * ────────────────────────────────────────────────────────────────────── */
 
 int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr) {
     (void)attr;
     if (!cond) return EINVAL;
     cond->seq = 0;
+    cond->waiters = 0;
     return 0;
 }
 
 int pthread_cond_destroy(pthread_cond_t *cond) {
-    (void)cond;
+    if (!cond) return EINVAL;
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_RELAXED) != 0) return EBUSY;
     return 0;
 }
 
-int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
-    if (!cond || !mutex) return EINVAL;
+/**
+ * Common body of pthread_cond_wait / pthread_cond_timedwait.
+ *
+ * A recursive mutex is released completely and its depth restored
+ * afterwards, as POSIX requires.
+ */
+static int _cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                      unsigned int timeout_ms) {
+    unsigned int depth = 0;
+    unsigned long owner = 0;
+
+    if (mutex->type != PTHREAD_MUTEX_NORMAL) {
+        owner = _self_tid();
+        if (__atomic_load_n(&mutex->owner, __ATOMIC_RELAXED) != owner)
+            return EPERM;
+        depth = mutex->count;
+        mutex->count = 0;
+        __atomic_store_n(&mutex->owner, 0, __ATOMIC_RELAXED);
+    }
 
-    /* Snapshot the current sequence number before releasing the mutex. */
-    unsigned int seq = __atomic_load_n(&cond->seq, __ATOMIC_ACQUIRE);
+    __atomic_fetch_add(&cond->waiters, 1, __ATOMIC_SEQ_CST);
+    unsigned int seq = __atomic_load_n(&cond->seq, __ATOMIC_SEQ_CST);
+    _unlock_word(&mutex->lock);
 
-    /* Release the mutex so other threads can make progress. */
-    pthread_mutex_unlock(mutex);
+    unsigned int r = _futex_wait(&cond->seq, seq, timeout_ms);
 
-    /*
-     * Spin until the sequence counter changes (indicating a signal or
-     * broadcast).  Yield on every iteration to avoid burning CPU.
-     */
-    while (__atomic_load_n(&cond->seq, __ATOMIC_ACQUIRE) == seq) {
-        _syscall(SYS_YIELD, 0, 0, 0, 0, 0);
+    __atomic_fetch_sub(&cond->waiters, 1, __ATOMIC_RELAXED);
+    _lock_word(&mutex->lock, 1);
+
+    if (depth) {
+        __atomic_store_n(&mutex->owner, owner, __ATOMIC_RELAXED);
+        mutex->count = depth;
     }
+    return r == FUTEX_TIMEDOUT ? ETIMEDOUT : 0;
+}
 
-    /* Re-acquire the mutex before returning, per POSIX semantics. */
-    pthread_mutex_lock(mutex);
-    return 0;
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    if (!cond || !mutex) return EINVAL;
+    return _cond_wait(cond, mutex, FUTEX_FOREVER);
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime) {
+    if (!cond || !mutex || !abstime) return EINVAL;
+    if (abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000L) return EINVAL;
+    unsigned int ms = _deadline_ms(abstime);
+    if (ms == 0) return ETIMEDOUT;
+    return _cond_wait(cond, mutex, ms);
 }
 
 int pthread_cond_signal(pthread_cond_t *cond) {
     if (!cond) return EINVAL;
-    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_SEQ_CST) != 0) {
+        _futex_wake(&cond->seq, 1);
+    }
     return 0;
 }
 
 int pthread_cond_broadcast(pthread_cond_t *cond) {
     if (!cond) return EINVAL;
-    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_SEQ_CST) != 0) {
+        _futex_wake(&cond->seq, WAKE_ALL);
+    }
     return 0;
 }
 
@@ -600,29 +776,198 @@ void *pthread_getspecific(pthread_key_t key) {
  *  pthread_once
  *
  *  Three states: 0 = not started, 1 = in progress, 2 = complete.
- *  The first thread to CAS 0→1 runs the routine; other threads spin
- *  until the state becomes 2.
+ *  The first thread to CAS 0→1 runs the routine; latecomers sleep on
+ *  the control word until the initializer stores 2 and wakes them.
  * ────────────────────────────────────────────────────────────────────── */
 
 int pthread_once(pthread_once_t *once_control, void (*init_routine)(void)) {
     if (!once_control || !init_routine) return EINVAL;
+    volatile unsigned int *word = (volatile unsigned int *)once_control;
 
     /* Fast path: already initialized. */
-    if (__atomic_load_n(once_control, __ATOMIC_ACQUIRE) == 2) return 0;
+    if (__atomic_load_n(word, __ATOMIC_ACQUIRE) == 2) return 0;
 
     /* Try to become the initializer. */
-    int expected = 0;
-    if (__atomic_compare_exchange_n(once_control, &expected, 1,
+    unsigned int expected = 0;
+    if (__atomic_compare_exchange_n(word, &expected, 1,
                                     0 /* strong */, __ATOMIC_ACQ_REL,
                                     __ATOMIC_ACQUIRE)) {
         init_routine();
-        __atomic_store_n(once_control, 2, __ATOMIC_RELEASE);
+        __atomic_store_n(word, 2, __ATOMIC_RELEASE);
+        _futex_wake(word, WAKE_ALL);
         return 0;
     }
 
-    /* Another thread is initializing — spin until complete. */
-    while (__atomic_load_n(once_control, __ATOMIC_ACQUIRE) != 2) {
-        _syscall(SYS_YIELD, 0, 0, 0, 0, 0);
+    /* Another thread is initializing — wait until it completes. */
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) == 2) return 0;
+        _cpu_relax();
+    }
+    while (__atomic_load_n(word, __ATOMIC_ACQUIRE) != 2) {
+        _futex_wait(word, 1, FUTEX_FOREVER);
+    }
+    return 0;
+}
+
+/* ──────────────────────────────────────────────────────────────────────
+ *  Read-write locks
+ *
+ *  The state word holds the reader count, or RW_WRITER while a writer
+ *  owns the lock.  Blocked threads sleep on a separate sequence word;
+ *  the thread that drops the state to zero bumps it and wakes every
+ *  sleeper so readers and writers can race for the free lock.  The
+ *  lock prefers readers, so a thread may take a read lock it already
+ *  holds while a writer waits.
+ * ────────────────────────────────────────────────────────────────────── */
+
+#define RW_WRITER  0xFFFFFFFFu
+
+int pthread_rwlock_init(pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr) {
+    (void)attr;
+    if (!rwlock) return EINVAL;
+    rwlock->state = 0;
+    rwlock->seq = 0;
+    rwlock->waiters = 0;
+    return 0;
+}
+
+int pthread_rwlock_destroy(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    if (__atomic_load_n(&rwlock->state, __ATOMIC_RELAXED) != 0) return EBUSY;
+    return 0;
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    unsigned int s = __atomic_load_n(&rwlock->state, __ATOMIC_RELAXED);
+    do {
+        if (s == RW_WRITER) return EBUSY;
+        if (s == RW_WRITER - 1) return EAGAIN;
+    } while (!__atomic_compare_exchange_n(&rwlock->state, &s, s + 1, 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    return 0;
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    unsigned int s = 0;
+    if (!__atomic_compare_exchange_n(&rwlock->state, &s, RW_WRITER, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return EBUSY;
+    return 0;
+}
+
+/**
+ * Spin, then sleep, until try_lock succeeds or fails with something
+ * other than EBUSY.
+ */
+static int _rwlock_acquire(pthread_rwlock_t *rwlock,
+                           int (*try_lock)(pthread_rwlock_t *)) {
+    int r;
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        if ((r = try_lock(rwlock)) != EBUSY) return r;
+        _cpu_relax();
+    }
+    for (;;) {
+        /* Register before the final retry so an unlock in between sees us. */
+        __atomic_fetch_add(&rwlock->waiters, 1, __ATOMIC_SEQ_CST);
+        unsigned int seq = __atomic_load_n(&rwlock->seq, __ATOMIC_SEQ_CST);
+        r = try_lock(rwlock);
+        if (r == EBUSY) _futex_wait(&rwlock->seq, seq, FUTEX_FOREVER);
+        __atomic_fetch_sub(&rwlock->waiters, 1, __ATOMIC_RELAXED);
+        if (r != EBUSY) return r;
+    }
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    return _rwlock_acquire(rwlock, pthread_rwlock_tryrdlock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    return _rwlock_acquire(rwlock, pthread_rwlock_trywrlock);
+}
+
+int pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    unsigned int s = __atomic_load_n(&rwlock->state, __ATOMIC_RELAXED);
+    if (s == 0) return EPERM;
+    if (s == RW_WRITER) {
+        __atomic_store_n(&rwlock->state, 0, __ATOMIC_SEQ_CST);
+    } else if (__atomic_sub_fetch(&rwlock->state, 1, __ATOMIC_SEQ_CST) != 0) {
+        return 0;   /* Other readers remain; nobody can enter yet. */
+    }
+    if (__atomic_load_n(&rwlock->waiters, __ATOMIC_SEQ_CST) != 0) {
+        __atomic_fetch_add(&rwlock->seq, 1, __ATOMIC_SEQ_CST);
+        _futex_wake(&rwlock->seq, WAKE_ALL);
     }
     return 0;
 }
+
+int pthread_rwlockattr_init(pthread_rwlockattr_t *attr) {
+    if (!attr) return EINVAL;
+    attr->_unused = 0;
+    return 0;
+}
+
+int pthread_rwlockattr_destroy(pthread_rwlockattr_t *attr) {
+    (void)attr;
+    return 0;
+}
+
+/* ──────────────────────────────────────────────────────────────────────
+ *  Barriers
+ *
+ *  Threads sleep on a generation counter.  The last arrival resets the
+ *  arrival count for the next round before bumping the generation, so
+ *  the barrier is reusable as soon as pthread_barrier_wait returns.
+ * ────────────────────────────────────────────────────────────────────── */
+
+int pthread_barrier_init(pthread_barrier_t *barrier,
+                         const pthread_barrierattr_t *attr, unsigned int count) {
+    (void)attr;
+    if (!barrier || count == 0) return EINVAL;
+    barrier->count = count;
+    barrier->arrived = 0;
+    barrier->gen = 0;
+    return 0;
+}
+
+int pthread_barrier_destroy(pthread_barrier_t *barrier) {
+    if (!barrier) return EINVAL;
+    if (__atomic_load_n(&barrier->arrived, __ATOMIC_RELAXED) != 0) return EBUSY;
+    return 0;
+}
+
+int pthread_barrier_wait(pthread_barrier_t *barrier) {
+    if (!barrier) return EINVAL;
+
+    unsigned int gen = __atomic_load_n(&barrier->gen, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&barrier->arrived, 1, __ATOMIC_ACQ_REL) == barrier->count) {
+        __atomic_store_n(&barrier->arrived, 0, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&barrier->gen, 1, __ATOMIC_RELEASE);
+        _futex_wake(&barrier->gen, WAKE_ALL);
+        return PTHREAD_BARRIER_SERIAL_THREAD;
+    }
+
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        if (__atomic_load_n(&barrier->gen, __ATOMIC_ACQUIRE) != gen) return 0;
+        _cpu_relax();
+    }
+    while (__atomic_load_n(&barrier->gen, __ATOMIC_ACQUIRE) == gen) {
+        _futex_wait(&barrier->gen, gen, FUTEX_FOREVER);
+    }
+    return 0;
+}
+
+int pthread_barrierattr_init(pthread_barrierattr_t *attr) {
+    if (!attr) return EINVAL;
+    attr->_unused = 0;
+    return 0;
+}
+
+int pthread_barrierattr_destroy(pthread_barrierattr_t *attr) {
+    (void)attr;
+    return 0;
+}
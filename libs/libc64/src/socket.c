@@ -450,73 +450,155 @@ int getsockname(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
 
 /* =========================================================================
  * select() / poll()
+ *
+ * Both map their fds to kernel interests and block once in SYS_POLL_WAIT
+ * (one-shot form: fd = 0xFFFFFFFF, revents filled in place).  The kernel
+ * wakes the caller when a socket, pipe or port changes state.
  * ========================================================================= */
 
-static int __select_check(int nfds, fd_set *readfds, fd_set *writefds,
-                          fd_set *exceptfds,
-                          fd_set *rd_result, fd_set *wr_result, fd_set *ex_result) {
+/* Interest record of SYS_POLL_WAIT (24 bytes, matches the kernel layout). */
+typedef struct {
+    uint32_t kind;
+    uint32_t id;
+    uint32_t aux;
+    uint16_t events;
+    uint16_t revents;
+    uint64_t data;
+} __poll_item_t;
+
+#define __POLL_KIND_TCP 1
+#define __POLL_KIND_UDP 2
+#define __POLL_KIND_FD  3
+
+/* Fill in the interest for fds[i].  Returns 0 when the fd has no kernel
+ * event source; *local then holds the events to report for it. */
+static int __poll_item(const struct pollfd *pfd, __poll_item_t *it, short *local) {
+    *local = 0;
+    if (pfd->fd < 0) return 0;
+    memset(it, 0, sizeof(*it));
+    it->events = (uint16_t)pfd->events;
+
+    /* Non-socket FDs (files, pipes, Tty) are below SOCKET_FD_BASE */
+    if (pfd->fd < SOCKET_FD_BASE) {
+        it->kind = __POLL_KIND_FD;
+        it->id = (uint32_t)pfd->fd;
+        return 1;
+    }
+
+    socket_entry_t *s = get_socket(pfd->fd);
+    if (!s) {
+        *local = POLLNVAL;
+        return 0;
+    }
+    if (s->type == SOCK_STREAM && s->tcp_sock_id >= 0) {
+        it->kind = __POLL_KIND_TCP;
+        it->id = (uint32_t)s->tcp_sock_id;
+        return 1;
+    }
+    if (s->type == SOCK_DGRAM) {
+        if (s->udp_port == 0) {
+            /* Unbound: nothing to receive, sending always possible */
+            *local = pfd->events & POLLOUT;
+            return 0;
+        }
+        it->kind = __POLL_KIND_UDP;
+        it->id = s->udp_port;
+        return 1;
+    }
+    return 0;   /* TCP socket not yet connected or listening */
+}
+
+static int __poll_wait(struct pollfd *fds, nfds_t nfds, int timeout) {
+    __poll_item_t *items = NULL;
+    if (nfds > 0) {
+        items = (__poll_item_t *)malloc(nfds * sizeof(__poll_item_t));
+        if (!items) { errno = ENOMEM; return -1; }
+    }
+
+    unsigned int count = 0;
     int ready = 0;
-    _syscall(SYS_NET_POLL, 0, 0, 0, 0, 0);
-
-    for (int fd = 0; fd < nfds && fd < FD_SETSIZE; fd++) {
-        socket_entry_t *s = get_socket(fd);
-        if (!s) continue;
-        if (s->type == SOCK_STREAM && s->tcp_sock_id >= 0) {
-            long st = _syscall(SYS_TCP_STATUS, s->tcp_sock_id, 0, 0, 0, 0);
-            if (readfds && FD_ISSET(fd, readfds)) {
-                long avail = _syscall(SYS_TCP_RECV_AVAILABLE, s->tcp_sock_id, 0, 0, 0, 0);
-                if (avail > 0 || avail == (long)0xFFFFFFFEu || avail == (long)0xFFFFFFFFu) {
-                    FD_SET(fd, rd_result);
-                    ready++;
-                }
-            }
-            if (writefds && FD_ISSET(fd, writefds)) {
-                if (st == TCP_STATE_ESTABLISHED) { FD_SET(fd, wr_result); ready++; }
-            }
-            if (exceptfds && FD_ISSET(fd, exceptfds)) {
-                if (st == (long)0xFFFFFFFFu) { FD_SET(fd, ex_result); ready++; }
-            }
-        } else if (s->type == SOCK_DGRAM) {
-            if (readfds && FD_ISSET(fd, readfds)) { FD_SET(fd, rd_result); ready++; }
-            if (writefds && FD_ISSET(fd, writefds)) { FD_SET(fd, wr_result); ready++; }
+    for (nfds_t i = 0; i < nfds; i++) {
+        short local;
+        if (__poll_item(&fds[i], &items[count], &local)) {
+            items[count].data = i;
+            count++;
         }
+        fds[i].revents = local;
+        if (local) ready++;
     }
+
+    /* Something is already ready: only collect the rest without blocking */
+    unsigned int tmo = ready > 0 ? 0 : (timeout < 0 ? 0xFFFFFFFFu : (unsigned int)timeout);
+    long r = _syscall(SYS_POLL_WAIT, 0xFFFFFFFFu, (long)items, count, tmo, 0);
+    if (r == (long)0xFFFFFFFFu) {
+        free(items);
+        errno = EINVAL;
+        return -1;
+    }
+    for (unsigned int k = 0; k < count; k++) {
+        fds[items[k].data].revents = (short)items[k].revents;
+        if (items[k].revents) ready++;
+    }
+    free(items);
     return ready;
 }
 
 int select(int nfds, fd_set *readfds, fd_set *writefds,
            fd_set *exceptfds, struct timeval *timeout) {
-    fd_set rd_result, wr_result, ex_result;
-    long timeout_ms = -1;
-    if (timeout) timeout_ms = timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
-
-    long elapsed = 0;
-    while (1) {
-        FD_ZERO(&rd_result);
-        FD_ZERO(&wr_result);
-        FD_ZERO(&ex_result);
-        int ready = __select_check(nfds, readfds, writefds, exceptfds,
-                                   &rd_result, &wr_result, &ex_result);
-        if (ready > 0 || timeout_ms == 0) {
-            if (readfds)   memcpy(readfds, &rd_result, sizeof(fd_set));
-            if (writefds)  memcpy(writefds, &wr_result, sizeof(fd_set));
-            if (exceptfds) memcpy(exceptfds, &ex_result, sizeof(fd_set));
-            return ready;
+    if (nfds > FD_SETSIZE) nfds = FD_SETSIZE;
+
+    struct pollfd *pfds = NULL;
+    nfds_t n = 0;
+    if (nfds > 0) {
+        pfds = (struct pollfd *)malloc((size_t)nfds * sizeof(struct pollfd));
+        if (!pfds) { errno = ENOMEM; return -1; }
+    }
+    for (int fd = 0; fd < nfds; fd++) {
+        short events = 0;
+        if (readfds && FD_ISSET(fd, readfds)) events |= POLLIN;
+        if (writefds && FD_ISSET(fd, writefds)) events |= POLLOUT;
+        if (exceptfds && FD_ISSET(fd, exceptfds)) events |= POLLPRI; /* marks exceptfds only */
+        if (events == 0) continue;
+        pfds[n].fd = fd;
+        pfds[n].events = events;
+        pfds[n].revents = 0;
+        n++;
+    }
+
+    int timeout_ms = -1; /* infinite */
+    if (timeout) timeout_ms = (int)(timeout->tv_sec * 1000 + timeout->tv_usec / 1000);
+
+    int r = __poll_wait(pfds, n, timeout_ms);
+    if (r < 0) { free(pfds); return -1; }
+    for (nfds_t i = 0; i < n; i++) {
+        if (pfds[i].revents & POLLNVAL) {
+            free(pfds);
+            errno = EBADF;
+            return -1;
         }
-        if (timeout_ms > 0 && elapsed >= timeout_ms) {
-            if (readfds)   memcpy(readfds, &rd_result, sizeof(fd_set));
-            if (writefds)  memcpy(writefds, &wr_result, sizeof(fd_set));
-            if (exceptfds) memcpy(exceptfds, &ex_result, sizeof(fd_set));
-            return 0;
+    }
+
+    if (readfds)   FD_ZERO(readfds);
+    if (writefds)  FD_ZERO(writefds);
+    if (exceptfds) FD_ZERO(exceptfds);
+    int ready = 0;
+    for (nfds_t i = 0; i < n; i++) {
+        short ev = pfds[i].events, rev = pfds[i].revents;
+        if ((ev & POLLIN) && (rev & (POLLIN | POLLHUP | POLLERR))) {
+            FD_SET(pfds[i].fd, readfds);
+            ready++;
+        }
+        if ((ev & POLLOUT) && (rev & (POLLOUT | POLLERR))) {
+            FD_SET(pfds[i].fd, writefds);
+            ready++;
         }
-        int sleep_ms = 10;
-        if (timeout_ms > 0) {
-            long remaining = timeout_ms - elapsed;
-            if (remaining < sleep_ms) sleep_ms = (int)remaining;
+        if ((ev & POLLPRI) && (rev & POLLERR)) {
+            FD_SET(pfds[i].fd, exceptfds);
+            ready++;
         }
-        _syscall(SYS_SLEEP, sleep_ms, 0, 0, 0, 0);
-        elapsed += sleep_ms;
     }
+    free(pfds);
+    return ready;
 }
 
 int pselect(int nfds, fd_set *readfds, fd_set *writefds,
@@ -534,41 +616,7 @@ int pselect(int nfds, fd_set *readfds, fd_set *writefds,
 }
 
 int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
-    long elapsed = 0;
-    while (1) {
-        int ready = 0;
-        _syscall(SYS_NET_POLL, 0, 0, 0, 0, 0);
-        for (nfds_t i = 0; i < nfds; i++) {
-            fds[i].revents = 0;
-            socket_entry_t *s = get_socket(fds[i].fd);
-            if (!s) { fds[i].revents = POLLNVAL; continue; }
-            if (s->type == SOCK_STREAM && s->tcp_sock_id >= 0) {
-                long st = _syscall(SYS_TCP_STATUS, s->tcp_sock_id, 0, 0, 0, 0);
-                if (fds[i].events & POLLIN) {
-                    long avail = _syscall(SYS_TCP_RECV_AVAILABLE, s->tcp_sock_id, 0, 0, 0, 0);
-                    if (avail > 0 || avail == (long)0xFFFFFFFEu || avail == (long)0xFFFFFFFFu)
-                        fds[i].revents |= POLLIN;
-                }
-                if (fds[i].events & POLLOUT) {
-                    if (st == TCP_STATE_ESTABLISHED) fds[i].revents |= POLLOUT;
-                }
-                if (st == (long)0xFFFFFFFFu) fds[i].revents |= POLLERR;
-            } else if (s->type == SOCK_DGRAM) {
-                if (fds[i].events & POLLIN) fds[i].revents |= POLLIN;
-                if (fds[i].events & POLLOUT) fds[i].revents |= POLLOUT;
-            }
-            if (fds[i].revents) ready++;
-        }
-        if (ready > 0 || timeout == 0) return ready;
-        if (timeout > 0 && elapsed >= timeout) return 0;
-        int sleep_ms = 10;
-        if (timeout > 0) {
-            long remaining = timeout - elapsed;
-            if (remaining < sleep_ms) sleep_ms = (int)remaining;
-        }
-        _syscall(SYS_SLEEP, sleep_ms, 0, 0, 0, 0);
-        elapsed += sleep_ms;
-    }
+    return __poll_wait(fds, nfds, timeout);
 }
 
 /* =========================================================================
@@ -8,114 +8,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdio.h>
 
-/* Arena-based malloc: requests memory from sbrk in large chunks, suballocates
- * locally. This avoids a syscall for every malloc — critical for complex C
- * programs that do tens of thousands of small allocations. */
-
-typedef struct block_header {
-    size_t size;        /* payload size (not including header) */
-    int free;
-    struct block_header *next;
-} block_header_t;
-
-#define HEADER_SIZE (sizeof(block_header_t))
-#define ALIGN(x) (((x) + 15) & ~15)  /* 16-byte alignment for x86_64 */
-#define ARENA_CHUNK 65536  /* request 64 KiB from sbrk at a time */
-
-static block_header_t *free_list = NULL;
-
-/* Arena: current position and remaining bytes in the current sbrk chunk */
-static char *arena_ptr = NULL;
-static size_t arena_remaining = 0;
-
-/* Allocate raw memory from the arena, calling sbrk only when needed */
-static void *arena_alloc(size_t total) {
-    if (total > arena_remaining) {
-        /* Request a new chunk from sbrk — at least ARENA_CHUNK or the
-         * requested size, whichever is larger */
-        size_t chunk = total > ARENA_CHUNK ? total : ARENA_CHUNK;
-        void *p = sbrk((long)chunk);
-        if (p == (void *)-1) return NULL;
-        arena_ptr = (char *)p;
-        arena_remaining = chunk;
-    }
-    void *result = arena_ptr;
-    arena_ptr += total;
-    arena_remaining -= total;
-    return result;
-}
-
-void *malloc(size_t size) {
-    if (size == 0) return NULL;
-    size = ALIGN(size);
-
-    /* Search free list for a reusable block */
-    block_header_t *prev = NULL;
-    block_header_t *curr = free_list;
-    while (curr) {
-        if (curr->free && curr->size >= size) {
-            /* Split if the block is significantly larger */
-            if (curr->size >= size + HEADER_SIZE + 16) {
-                block_header_t *split = (block_header_t *)((char *)curr + HEADER_SIZE + size);
-                split->size = curr->size - size - HEADER_SIZE;
-                split->free = 1;
-                split->next = curr->next;
-                curr->size = size;
-                curr->next = split;
-            }
-            curr->free = 0;
-            return (void *)((char *)curr + HEADER_SIZE);
-        }
-        prev = curr;
-        curr = curr->next;
-    }
-
-    /* Allocate from arena (batched sbrk) */
-    size_t total = HEADER_SIZE + size;
-    void *p = arena_alloc(total);
-    if (!p) return NULL;
-
-    block_header_t *blk = (block_header_t *)p;
-    blk->size = size;
-    blk->free = 0;
-    blk->next = NULL;
-
-    if (prev) prev->next = blk;
-    else free_list = blk;
-
-    return (void *)((char *)blk + HEADER_SIZE);
-}
-
-void *calloc(size_t nmemb, size_t size) {
-    size_t total = nmemb * size;
-    void *p = malloc(total);
-    if (p) memset(p, 0, total);
-    return p;
-}
-
-void *realloc(void *ptr, size_t size) {
-    if (!ptr) return malloc(size);
-    if (size == 0) { free(ptr); return NULL; }
-
-    block_header_t *blk = (block_header_t *)((char *)ptr - HEADER_SIZE);
-    size = ALIGN(size);
-    if (blk->size >= size) return ptr;
-
-    void *new_ptr = malloc(size);
-    if (!new_ptr) return NULL;
-    memcpy(new_ptr, ptr, blk->size);
-    free(ptr);
-    return new_ptr;
-}
-
-void free(void *ptr) {
-    if (!ptr) return;
-    block_header_t *blk = (block_header_t *)((char *)ptr - HEADER_SIZE);
-    blk->free = 1;
-}
+extern void __run_atexit(void);
 
 void exit(int status) {
+    __run_atexit();
+    fflush(NULL);
     _exit(status);
     __builtin_unreachable();
 }
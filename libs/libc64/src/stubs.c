@@ -356,6 +356,12 @@ int atexit(void (*function)(void)) {
     return 0;
 }
 
+/* Called by exit(): run handlers in reverse order of registration. */
+void __run_atexit(void) {
+    while (_atexit_count > 0)
+        _atexit_funcs[--_atexit_count]();
+}
+
 int setenv(const char *name, const char *value, int overwrite) {
     if (!name || !*name || strchr(name, '=')) { errno = EINVAL; return -1; }
     if (!overwrite) {
@@ -432,22 +438,14 @@ char *realpath(const char *path, char *resolved_path) {
 
 int nanosleep(const struct timespec *req, struct timespec *rem) {
     if (!req) { errno = EINVAL; return -1; }
-    unsigned long ms = (unsigned long)(req->tv_sec * 1000 + req->tv_nsec / 1000000);
-    if (ms > 0) _syscall(8 /*SYS_SLEEP*/, (long)ms, 0, 0, 0, 0);
+    if (req->tv_nsec < 0 || req->tv_nsec >= 1000000000L) { errno = EINVAL; return -1; }
+    /* SYS_SLEEP_NS (175) takes the 64-bit nanosecond count as lo, hi */
+    unsigned long ns = (unsigned long)req->tv_sec * 1000000000UL + (unsigned long)req->tv_nsec;
+    if (ns > 0) _syscall(175 /*SYS_SLEEP_NS*/, (long)(ns & 0xFFFFFFFFUL), (long)(ns >> 32), 0, 0, 0);
     if (rem) { rem->tv_sec = 0; rem->tv_nsec = 0; }
     return 0;
 }
 
-/* ── stdio: setbuf / setlinebuf ── */
-
-void setbuf(FILE *stream, char *buf) {
-    (void)stream; (void)buf;
-}
-
-void setlinebuf(FILE *stream) {
-    (void)stream;
-}
-
 /* ── POSIX filesystem stubs ── */
 #include <sys/stat.h>
 #include <dirent.h>
@@ -522,8 +520,7 @@ int posix_spawnattr_destroy(posix_spawnattr_t *attr) { (void)attr; return 0; }
 
 /* ── POSIX stubs ── */
 
-int fsync(int fd) { (void)fd; return 0; }
-int fdatasync(int fd) { (void)fd; return 0; }
+int fdatasync(int fd) { return fsync(fd); }
 
 int chmod(const char *path, unsigned int mode) {
     if (!path) { errno = EINVAL; return -1; }
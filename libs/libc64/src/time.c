@@ -7,6 +7,7 @@
 
 #include <time.h>
 #include <sys/time.h>
+#include <errno.h>
 
 #include <sys/syscall.h>
 
@@ -14,6 +15,62 @@ extern long _syscall(long num, long a1, long a2, long a3, long a4, long a5);
 
 static struct tm _tm;
 
+/* Shared time page, mapped read-only into every process by the kernel
+ * (layout must match kernel/src/task/timepage.rs). */
+#define TIME_PAGE_ADDR 0x07FFF000UL
+
+struct _time_page {
+    volatile unsigned int  seq;         /* seqlock, odd while updating */
+    volatile unsigned int  version;
+    volatile unsigned long tsc_hz;      /* 0 = TSC unusable, use syscalls */
+    volatile unsigned long tsc_boot;    /* TSC at uptime 0 */
+    volatile unsigned long realtime_offset_ns; /* Unix ns at uptime 0 */
+    volatile unsigned int  tick_hz;
+};
+
+/* Read nanoseconds since boot and the boot wall-clock offset from the time
+ * page without entering the kernel.  Returns 0 if the TSC is unusable. */
+static int _time_page_read(unsigned long *mono_ns, unsigned long *offset_ns) {
+    const struct _time_page *tp = (const struct _time_page *)TIME_PAGE_ADDR;
+    for (;;) {
+        unsigned int seq = tp->seq;
+        if (seq & 1) continue;
+        __asm__ volatile("" ::: "memory");
+        unsigned int version = tp->version;
+        unsigned long hz = tp->tsc_hz;
+        unsigned long boot = tp->tsc_boot;
+        unsigned long off = tp->realtime_offset_ns;
+        unsigned int lo, hi;
+        __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+        __asm__ volatile("" ::: "memory");
+        if (tp->seq != seq) continue;
+        if (version != 1 || hz == 0) return 0;
+        unsigned long d = (((unsigned long)hi << 32) | lo) - boot;
+        *mono_ns = d / hz * 1000000000UL + d % hz * 1000000000UL / hz;
+        *offset_ns = off;
+        return 1;
+    }
+}
+
+int clock_gettime(clockid_t clk_id, struct timespec *tp) {
+    unsigned long ns, off;
+    if (clk_id != CLOCK_REALTIME && clk_id != CLOCK_MONOTONIC) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!_time_page_read(&ns, &off)) {
+        ns = (unsigned long)_syscall(SYS_UPTIME_MS, 0, 0, 0, 0, 0) * 1000000UL;
+        off = 0;
+    }
+    /* Without a wall-clock offset CLOCK_REALTIME counts from boot */
+    if (clk_id == CLOCK_REALTIME) ns += off;
+    if (tp) {
+        tp->tv_sec = (time_t)(ns / 1000000000UL);
+        tp->tv_nsec = (long)(ns % 1000000000UL);
+    }
+    return 0;
+}
+
 time_t time(time_t *tloc) {
     unsigned char buf[8];
     _syscall(SYS_TIME, (long)buf, 0, 0, 0, 0);
@@ -193,11 +250,10 @@ char *ctime(const time_t *timer) {
 
 int gettimeofday(struct timeval *tv, struct timezone *tz) {
     if (tv) {
-        unsigned long ticks = (unsigned long)_syscall(SYS_UPTIME, 0, 0, 0, 0, 0);
-        unsigned long hz = (unsigned long)_syscall(SYS_TICK_HZ, 0, 0, 0, 0, 0);
-        if (hz == 0) hz = 1000;
-        tv->tv_sec = (long)(ticks / hz);
-        tv->tv_usec = (long)((ticks % hz) * (1000000 / hz));
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        tv->tv_sec = ts.tv_sec;
+        tv->tv_usec = ts.tv_nsec / 1000;
     }
     if (tz) {
         tz->tz_minuteswest = 0;
@@ -166,6 +166,12 @@ int ftruncate(int fd, off_t length) {
     return 0;
 }
 
+int fsync(int fd) {
+    long r = _syscall(SYS_FSYNC, fd, 0, 0, 0, 0);
+    if (r < 0) { errno = (int)-r; return -1; }
+    return 0;
+}
+
 ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
     off_t saved = lseek(fd, 0, SEEK_CUR);
     if (saved < 0) return -1;
@@ -25,15 +25,23 @@ const CMD_SET_CLIPBOARD: u32 = 0x1011;
 const CMD_GET_CLIPBOARD: u32 = 0x1012;
 const CMD_GET_WINDOW_POS: u32 = 0x1013;
 const CMD_MINIMIZE_WINDOW: u32 = 0x1015;
+const CMD_GET_FRAME_STATS: u32 = 0x1019;
+const CMD_GET_PERF_METRICS: u32 = 0x101A;
+const CMD_SET_PERF_HUD: u32 = 0x101B;
 const CMD_SHOW_NOTIFICATION: u32 = 0x1020;
 const CMD_DISMISS_NOTIFICATION: u32 = 0x1021;
 const RESP_WINDOW_CREATED: u32 = 0x2001;
 const RESP_VRAM_WINDOW_CREATED: u32 = 0x2004;
 const RESP_VRAM_WINDOW_FAILED: u32 = 0x2005;
 const RESP_WINDOW_POS: u32 = 0x2006;
+const RESP_FRAME_STATS: u32 = 0x2007;
+const RESP_PERF_METRICS: u32 = 0x2008;
 const RESP_CLIPBOARD_DATA: u32 = 0x2010;
 
-const NUM_EXPORTS: u32 = 24;
+/// Largest clipboard payload (matches the compositor's limit).
+const MAX_CLIPBOARD_SIZE: u32 = 4 * 1024 * 1024;
+
+const NUM_EXPORTS: u32 = 27;
 
 #[repr(C)]
 pub struct LibcompositorExports {
@@ -175,6 +183,19 @@ pub struct LibcompositorExports {
 
     /// Minimize a window (move off-screen, save bounds for later restore).
     pub minimize_window: extern "C" fn(channel_id: u32, window_id: u32),
+
+    /// Get compositor frame-time percentiles over the last 256 frames.
+    /// Fills out_us with [p50, p95, p99] in microseconds.
+    /// Returns 1 on success, 0 on failure/timeout.
+    pub get_frame_stats: extern "C" fn(channel_id: u32, sub_id: u32, out_us: *mut [u32; 3]) -> u32,
+
+    /// Copy the compositor's per-second performance history into `out`
+    /// (`cap_words` u32 words, layout as documented for CMD_GET_PERF_METRICS).
+    /// Returns the number of words written, 0 on failure/timeout.
+    pub get_perf_metrics: extern "C" fn(channel_id: u32, sub_id: u32, out: *mut u32, cap_words: u32) -> u32,
+
+    /// Show (1) or hide (0) the compositor's performance HUD.
+    pub set_perf_hud: extern "C" fn(channel_id: u32, visible: u32),
 }
 
 #[link_section = ".exports"]
@@ -209,6 +230,9 @@ pub static LIBCOMPOSITOR_EXPORTS: LibcompositorExports = LibcompositorExports {
     dismiss_notification: export_dismiss_notification,
     get_window_position: export_get_window_position,
     minimize_window: export_minimize_window,
+    get_frame_stats: export_get_frame_stats,
+    get_perf_metrics: export_get_perf_metrics,
+    set_perf_hud: export_set_perf_hud,
 };
 
 // ── Export Implementations ───────────────────────────────────────────────────
@@ -396,14 +420,16 @@ extern "C" fn export_set_wallpaper(channel_id: u32, path_ptr: *const u8, path_le
         *dst.add(path_len as usize) = 0; // null terminator
     }
 
+    // Hand the region to the compositor, which claims and frees it
+    if syscall::shm_grant(shm_id) != 0 {
+        syscall::shm_unmap(shm_id);
+        syscall::shm_destroy(shm_id);
+        return;
+    }
+
     // Send CMD_SET_WALLPAPER: [CMD, shm_id, 0, 0, 0]
     let cmd: [u32; 5] = [CMD_SET_WALLPAPER, shm_id, 0, 0, 0];
     syscall::evt_chan_emit(channel_id, &cmd);
-
-    // Wait for compositor to read the SHM, then free it
-    syscall::sleep(32);
-    syscall::shm_unmap(shm_id);
-    syscall::shm_destroy(shm_id);
 }
 
 extern "C" fn export_move_window(channel_id: u32, window_id: u32, x: i32, y: i32) {
@@ -556,7 +582,7 @@ extern "C" fn export_set_blur_behind(channel_id: u32, window_id: u32, radius: u3
 }
 
 extern "C" fn export_set_clipboard(channel_id: u32, data_ptr: *const u8, data_len: u32, format: u32) {
-    if data_ptr.is_null() || data_len == 0 || data_len > 65536 {
+    if data_ptr.is_null() || data_len == 0 || data_len > MAX_CLIPBOARD_SIZE {
         return;
     }
 
@@ -575,12 +601,15 @@ extern "C" fn export_set_clipboard(channel_id: u32, data_ptr: *const u8, data_le
         core::ptr::copy_nonoverlapping(data_ptr, dst, data_len as usize);
     }
 
+    // Hand the region to the compositor, which claims and frees it
+    if syscall::shm_grant(shm_id) != 0 {
+        syscall::shm_unmap(shm_id);
+        syscall::shm_destroy(shm_id);
+        return;
+    }
+
     let cmd: [u32; 5] = [CMD_SET_CLIPBOARD, shm_id, data_len, format, 0];
     syscall::evt_chan_emit(channel_id, &cmd);
-
-    syscall::sleep(32);
-    syscall::shm_unmap(shm_id);
-    syscall::shm_destroy(shm_id);
 }
 
 extern "C" fn export_get_clipboard(
@@ -820,3 +849,70 @@ extern "C" fn export_minimize_window(channel_id: u32, window_id: u32) {
     let cmd: [u32; 5] = [CMD_MINIMIZE_WINDOW, window_id, 0, 0, 0];
     syscall::evt_chan_emit(channel_id, &cmd);
 }
+
+extern "C" fn export_get_frame_stats(channel_id: u32, sub_id: u32, out_us: *mut [u32; 3]) -> u32 {
+    let tid = syscall::get_tid();
+    let cmd: [u32; 5] = [CMD_GET_FRAME_STATS, tid, 0, 0, 0];
+    syscall::evt_chan_emit(channel_id, &cmd);
+
+    // Poll for RESP_FRAME_STATS
+    let mut response = [0u32; 5];
+    for _ in 0..50 {
+        while syscall::evt_chan_poll(channel_id, sub_id, &mut response) {
+            if response[0] == RESP_FRAME_STATS && response[4] == tid {
+                unsafe {
+                    *out_us = [response[1], response[2], response[3]];
+                }
+                return 1;
+            }
+        }
+        syscall::sleep(5);
+    }
+    0 // Timeout
+}
+
+extern "C" fn export_get_perf_metrics(channel_id: u32, sub_id: u32, out: *mut u32, cap_words: u32) -> u32 {
+    if out.is_null() || cap_words < 5 {
+        return 0;
+    }
+    let cap_bytes = cap_words * 4;
+    let shm_id = syscall::shm_create(cap_bytes);
+    if shm_id == 0 {
+        return 0;
+    }
+    let shm_addr = syscall::shm_map(shm_id);
+    if shm_addr == 0 {
+        syscall::shm_destroy(shm_id);
+        return 0;
+    }
+
+    let tid = syscall::get_tid();
+    let cmd: [u32; 5] = [CMD_GET_PERF_METRICS, tid, shm_id, cap_bytes, 0];
+    syscall::evt_chan_emit(channel_id, &cmd);
+
+    // Poll for RESP_PERF_METRICS
+    let mut response = [0u32; 5];
+    let mut written = 0u32;
+    'wait: for _ in 0..50 {
+        while syscall::evt_chan_poll(channel_id, sub_id, &mut response) {
+            if response[0] == RESP_PERF_METRICS && response[4] == tid {
+                if response[1] == shm_id && (response[2] != 0 || response[3] != 0) {
+                    let src = shm_addr as *const u32;
+                    let sample_words = unsafe { *src.add(2) };
+                    written = (5 + response[2] * sample_words + response[3] * 3).min(cap_words);
+                    unsafe { core::ptr::copy_nonoverlapping(src, out, written as usize); }
+                }
+                break 'wait;
+            }
+        }
+        syscall::sleep(5);
+    }
+    syscall::shm_unmap(shm_id);
+    syscall::shm_destroy(shm_id);
+    written
+}
+
+extern "C" fn export_set_perf_hud(channel_id: u32, visible: u32) {
+    let cmd: [u32; 5] = [CMD_SET_PERF_HUD, (visible != 0) as u32, 0, 0, 0];
+    syscall::evt_chan_emit(channel_id, &cmd);
+}
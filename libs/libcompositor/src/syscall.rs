@@ -2,6 +2,6 @@
 
 pub use libsyscall::{
     get_tid, sleep, screen_size,
-    shm_create, shm_map, shm_unmap, shm_destroy,
+    shm_create, shm_map, shm_unmap, shm_destroy, shm_grant,
     evt_chan_create, evt_chan_subscribe, evt_chan_emit, evt_chan_poll, evt_chan_emit_to,
 };
@@ -106,6 +106,77 @@ pub struct Event {
     pub arg3: u32,
 }
 
+/// Compositor frame-time percentiles (compose + flush per frame).
+#[derive(Clone, Copy, Debug)]
+pub struct FrameStats {
+    pub p50_us: u32,
+    pub p95_us: u32,
+    pub p99_us: u32,
+}
+
+/// One second of compositor metrics (counters are totals over the second).
+#[derive(Clone, Copy, Debug)]
+pub struct PerfSample {
+    pub uptime_s: u32,
+    pub frames: u32,
+    pub compose_us_avg: u32,
+    pub compose_us_max: u32,
+    pub damaged_px: u32,
+    pub layers_visited: u32,
+    pub occlusion_skips: u32,
+    pub shadow_us: u32,
+    pub blur_us: u32,
+    pub flush_us: u32,
+}
+
+/// Present rate of one window over the last second.
+#[derive(Clone, Copy, Debug)]
+pub struct ClientRate {
+    pub window_id: u32,
+    pub owner_tid: u32,
+    pub presents_per_sec: u32,
+}
+
+/// Performance history returned by [`CompositorClient::perf_metrics`],
+/// borrowing the caller's buffer.
+pub struct PerfMetrics<'a> {
+    words: &'a [u32],
+}
+
+impl<'a> PerfMetrics<'a> {
+    const HEADER: usize = 5;
+
+    fn sample_words(&self) -> usize {
+        self.words[2] as usize
+    }
+
+    /// Per-second samples, oldest first.
+    pub fn samples(&self) -> impl Iterator<Item = PerfSample> + 'a {
+        let n = self.words[1] as usize;
+        let sw = self.sample_words();
+        let words = self.words;
+        (0..n).filter(move |_| sw >= 10).map(move |i| {
+            let w = &words[Self::HEADER + i * sw..];
+            PerfSample {
+                uptime_s: w[0], frames: w[1], compose_us_avg: w[2], compose_us_max: w[3],
+                damaged_px: w[4], layers_visited: w[5], occlusion_skips: w[6],
+                shadow_us: w[7], blur_us: w[8], flush_us: w[9],
+            }
+        })
+    }
+
+    /// Present rates of the last second, busiest first.
+    pub fn clients(&self) -> impl Iterator<Item = ClientRate> + 'a {
+        let base = Self::HEADER + self.words[1] as usize * self.sample_words();
+        let n = self.words[3] as usize;
+        let words = self.words;
+        (0..n).map(move |i| {
+            let w = &words[base + i * 3..];
+            ClientRate { window_id: w[0], owner_tid: w[1], presents_per_sec: w[2] }
+        })
+    }
+}
+
 /// Compositor client connection.
 pub struct CompositorClient {
     pub channel_id: u32,
@@ -356,6 +427,41 @@ impl CompositorClient {
         (raw::exports().set_wallpaper)(self.channel_id, bytes.as_ptr(), bytes.len() as u32);
     }
 
+    /// Query frame-time percentiles over the compositor's last 256 frames.
+    /// Returns None if the compositor did not answer.
+    pub fn frame_stats(&self) -> Option<FrameStats> {
+        let mut us = [0u32; 3];
+        if (raw::exports().get_frame_stats)(self.channel_id, self.sub_id, &mut us) == 0 {
+            return None;
+        }
+        Some(FrameStats { p50_us: us[0], p95_us: us[1], p99_us: us[2] })
+    }
+
+    /// Query the compositor's per-second performance history (up to the
+    /// last 60 seconds) into `buf`; 1024 words hold the full history.
+    /// Returns None if the compositor did not answer.
+    pub fn perf_metrics<'a>(&self, buf: &'a mut [u32]) -> Option<PerfMetrics<'a>> {
+        let n = (raw::exports().get_perf_metrics)(
+            self.channel_id, self.sub_id, buf.as_mut_ptr(), buf.len() as u32,
+        ) as usize;
+        if n < PerfMetrics::HEADER {
+            return None;
+        }
+        let words = &buf[..n];
+        let needed = PerfMetrics::HEADER
+            + words[1] as usize * words[2] as usize
+            + words[3] as usize * 3;
+        if needed > n {
+            return None;
+        }
+        Some(PerfMetrics { words })
+    }
+
+    /// Show or hide the compositor's performance HUD.
+    pub fn set_perf_hud(&self, visible: bool) {
+        (raw::exports().set_perf_hud)(self.channel_id, visible as u32);
+    }
+
     /// Resize a window's shared memory surface to new dimensions.
     /// Updates the WindowHandle in-place with the new SHM id, surface pointer,
     /// and dimensions. Returns true on success.
@@ -100,6 +100,16 @@ pub struct LibcompositorExports {
     ),
 
     pub dismiss_notification: extern "C" fn(channel_id: u32, notification_id: u32),
+
+    pub get_window_position: extern "C" fn(channel_id: u32, sub_id: u32, window_id: u32, out_x: *mut i32, out_y: *mut i32) -> u32,
+
+    pub minimize_window: extern "C" fn(channel_id: u32, window_id: u32),
+
+    pub get_frame_stats: extern "C" fn(channel_id: u32, sub_id: u32, out_us: *mut [u32; 3]) -> u32,
+
+    pub get_perf_metrics: extern "C" fn(channel_id: u32, sub_id: u32, out: *mut u32, cap_words: u32) -> u32,
+
+    pub set_perf_hud: extern "C" fn(channel_id: u32, visible: u32),
 }
 
 /// Get a reference to the libcompositor export table.
@@ -0,0 +1,417 @@
+//! Decoded basic-block cache.
+//!
+//! Decoding is the most expensive step of the fetch-decode-execute loop,
+//! and most guest code runs the same instructions over and over. The
+//! [`BlockCache`] keeps runs of already-decoded instructions ("blocks"),
+//! keyed by the physical address of their first instruction and the
+//! decoder mode they were decoded in, so the CPU only decodes each
+//! instruction once until its bytes change.
+//!
+//! A block is built on the first fetch from an address that has none. It
+//! covers straight-line code and ends after a control transfer (jump,
+//! call, return, interrupt, HLT, ...), at [`MAX_BLOCK_INSTS`], or before an
+//! instruction that would leave the block's 4 KiB page. Only a block's
+//! first instruction may straddle a page boundary, so every block starts
+//! at most 15 bytes before the page it ends in.
+//!
+//! The cache only memoizes decoding: the CPU still translates every fetch
+//! address and steps through a block only while each fetch lands exactly
+//! after the previous instruction in the same decoder mode. Anything else
+//! (a taken branch, an interrupt, a mode switch) looks up the block at the
+//! new address.
+//!
+//! Pages blocks are decoded from are marked in [`GuestMemory`]; a write to
+//! a marked page (self-modifying code, a loader reusing the page, device
+//! DMA) is reported back and [`invalidate`](BlockCache::invalidate) drops
+//! every block on it before the next fetch. Code in MMIO regions is never
+//! cached. When the instruction arena or block table fills up, the whole
+//! cache is flushed and refills from the code that is running.
+//!
+//! Blocks also count how often they are entered; hot ones are translated
+//! by the [`jit`](crate::jit) tier, and the CPU runs their translation
+//! instead of stepping through them. Translations live and die with their
+//! blocks.
+
+use alloc::collections::BTreeMap;
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::decoder::{CpuMode, Decoder};
+use crate::error::Result;
+use crate::instruction::{DecodedInst, OpcodeMap};
+use crate::jit::{self, JitCode};
+use crate::memory::{GuestMemory, PAGE_SIZE};
+use crate::registers::RegisterFile;
+
+/// Maximum number of instructions in one block.
+pub const MAX_BLOCK_INSTS: usize = 64;
+
+/// Decoded instructions held across all blocks before a flush.
+const ARENA_INSTS: usize = 16384;
+
+/// Blocks held before a flush.
+const MAX_BLOCKS: usize = 4096;
+
+/// Slots in the direct-mapped lookup table (a power of two).
+const LOOKUP_SLOTS: usize = 4096;
+
+/// Empty lookup slot / no current block / not translated yet.
+const NONE: u32 = u32::MAX;
+
+/// Translation attempted and found not worthwhile.
+const COLD: u32 = u32::MAX - 1;
+
+/// Longest x86 instruction encoding.
+const MAX_INST_LEN: u64 = 15;
+
+/// One run of decoded instructions.
+struct Block {
+    /// Physical address of the first instruction.
+    phys: u64,
+    /// Physical address just past the last instruction.
+    end: u64,
+    /// Index of the first instruction in the arena.
+    first: u32,
+    /// Number of instructions; 0 once invalidated.
+    len: u32,
+    /// Decoder mode the block was decoded in.
+    mode: CpuMode,
+    /// Entries from the interpreter, until translated.
+    heat: u32,
+    /// Translation index, `NONE` or `COLD`.
+    jit: u32,
+}
+
+/// Cache effectiveness counters, cumulative since the VM was created.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct BlockCacheStats {
+    /// Instruction fetches served by the cache or the decoder.
+    pub fetches: u64,
+    /// Instructions the decoder was run on (when blocks were built, or
+    /// for uncacheable code).
+    pub decodes: u64,
+    /// Blocks dropped because their code was written.
+    pub invalidations: u64,
+    /// Times the whole cache was emptied.
+    pub flushes: u64,
+    /// Blocks translated by the JIT tier.
+    pub translations: u64,
+    /// Instructions executed by translated code (not counted as fetches).
+    pub jit_instructions: u64,
+}
+
+impl BlockCacheStats {
+    /// Fetches that did not need a decode, in tenths of a percent.
+    pub fn hit_permille(&self) -> u32 {
+        if self.fetches == 0 {
+            return 0;
+        }
+        let hits = self.fetches.saturating_sub(self.decodes);
+        (hits.saturating_mul(1000) / self.fetches) as u32
+    }
+}
+
+/// Cache of decoded instruction blocks.
+pub struct BlockCache {
+    /// Decoded instructions of all blocks, each block contiguous.
+    insts: Vec<DecodedInst>,
+    blocks: Vec<Block>,
+    /// Live blocks by [`key`], for lookup misses and invalidation.
+    by_addr: BTreeMap<u64, u32>,
+    /// Direct-mapped block index by [`key`] hash, checked against the block.
+    lookup: Vec<u32>,
+    /// Translations of hot blocks.
+    jit: Vec<JitCode>,
+    /// Whether hot blocks are translated and run as host code.
+    pub jit_enabled: bool,
+    /// Block the last fetch was served from, or `NONE`.
+    cur: u32,
+    /// Position of the next instruction in `cur`.
+    pos: u32,
+    /// Physical address of the next instruction in `cur`.
+    next_phys: u64,
+    /// Effectiveness counters.
+    pub stats: BlockCacheStats,
+}
+
+/// Map key: physical address and mode.
+fn key(phys: u64, mode: CpuMode) -> u64 {
+    let m = match mode {
+        CpuMode::Real16 => 0,
+        CpuMode::Protected32 => 1,
+        CpuMode::Long64 => 2,
+    };
+    phys << 2 | m
+}
+
+fn slot(key: u64) -> usize {
+    ((key ^ (key >> 14)) as usize) & (LOOKUP_SLOTS - 1)
+}
+
+/// Whether `inst` ends a block: anything that may transfer control, or
+/// stops the CPU.
+fn ends_block(inst: &DecodedInst) -> bool {
+    match inst.opcode_map {
+        OpcodeMap::Primary => match inst.opcode {
+            // Jcc, CALL far, RET/RETF, INT3/INT/INTO/IRET, LOOP/JCXZ,
+            // CALL/JMP near and far, HLT
+            0x70..=0x7F | 0x9A | 0xC2 | 0xC3 | 0xCA..=0xCF | 0xE0..=0xE3
+            | 0xE8..=0xEB | 0xF4 => true,
+            // Group 5: CALL/JMP indirect (near and far)
+            0xFF => matches!(inst.modrm.map(|m| (m >> 3) & 7), Some(2..=5)),
+            _ => false,
+        },
+        OpcodeMap::Secondary => matches!(
+            inst.opcode,
+            // Jcc rel, SYSCALL/SYSRET, SYSENTER/SYSEXIT, UD2, RSM
+            0x0F80..=0x0F8F | 0x0F05 | 0x0F07 | 0x0F34 | 0x0F35 | 0x0F0B | 0x0FAA
+        ),
+        _ => false,
+    }
+}
+
+impl BlockCache {
+    /// Create an empty cache.
+    pub fn new() -> Self {
+        BlockCache {
+            insts: Vec::new(),
+            blocks: Vec::new(),
+            by_addr: BTreeMap::new(),
+            lookup: vec![NONE; LOOKUP_SLOTS],
+            jit: Vec::new(),
+            jit_enabled: cfg!(target_arch = "x86_64"),
+            cur: NONE,
+            pos: 0,
+            next_phys: 0,
+            stats: BlockCacheStats::default(),
+        }
+    }
+
+    /// Number of live blocks.
+    pub fn block_count(&self) -> usize {
+        self.by_addr.len()
+    }
+
+    /// Return the instruction at physical address `phys`, decoding it (and
+    /// the rest of its block) only if no cached block has it.
+    ///
+    /// Errors are the decoder's, for the instruction at `phys` itself.
+    #[inline]
+    pub fn fetch(
+        &mut self,
+        decoder: &Decoder,
+        memory: &mut GuestMemory,
+        phys: u64,
+    ) -> Result<DecodedInst> {
+        self.stats.fetches += 1;
+        let mode = decoder.mode();
+
+        // Straight-line execution through the current block.
+        if self.cur != NONE && phys == self.next_phys {
+            if let Some(inst) = self.step(self.cur, mode) {
+                return Ok(inst);
+            }
+        }
+
+        if let Some(b) = self.find(phys, mode) {
+            self.warm(b);
+            self.cur = b;
+            self.pos = 0;
+            self.next_phys = phys;
+            if let Some(inst) = self.step(b, mode) {
+                return Ok(inst);
+            }
+        }
+
+        self.build(decoder, memory, phys, mode)
+    }
+
+    /// The block starting at `phys` in `mode` if it has been translated
+    /// and the CPU is not in the middle of stepping through a block.
+    #[inline]
+    pub fn translated(&mut self, phys: u64, mode: CpuMode) -> Option<u32> {
+        if !self.jit_enabled {
+            return None;
+        }
+        if self.cur != NONE && phys == self.next_phys && self.pos < self.blocks[self.cur as usize].len {
+            return None;
+        }
+        let b = self.find(phys, mode)?;
+        if self.blocks[b as usize].jit < COLD { Some(b) } else { None }
+    }
+
+    /// Run the translation of block `b` on `regs`. Returns the number of
+    /// guest instructions executed. If the code stopped where its
+    /// translated prefix ends, the next fetch continues in the block.
+    pub fn run_translated(&mut self, b: u32, regs: &mut RegisterFile, rip_mask: u64) -> u64 {
+        let block = &self.blocks[b as usize];
+        let code = &self.jit[block.jit as usize];
+        let n = code.run(regs, rip_mask);
+        self.cur = b;
+        self.pos = code.insts;
+        self.next_phys = block.phys + code.bytes as u64;
+        self.stats.jit_instructions += n;
+        n
+    }
+
+    /// Count an interpreter entry into block `b`; translate it once hot.
+    #[inline]
+    fn warm(&mut self, b: u32) {
+        let block = &mut self.blocks[b as usize];
+        if !self.jit_enabled || block.jit != NONE {
+            return;
+        }
+        block.heat += 1;
+        if block.heat < jit::HOT_THRESHOLD {
+            return;
+        }
+        let insts = &self.insts[block.first as usize..(block.first + block.len) as usize];
+        block.jit = match jit::compile(insts, block.mode) {
+            Some(code) => {
+                self.jit.push(code);
+                self.stats.translations += 1;
+                (self.jit.len() - 1) as u32
+            }
+            None => COLD,
+        };
+    }
+
+    /// Serve the next instruction of block `b`, if it has one in `mode`.
+    #[inline]
+    fn step(&mut self, b: u32, mode: CpuMode) -> Option<DecodedInst> {
+        let block = &self.blocks[b as usize];
+        if block.mode != mode || self.pos >= block.len {
+            return None;
+        }
+        let inst = self.insts[(block.first + self.pos) as usize].clone();
+        self.pos += 1;
+        self.next_phys += inst.length as u64;
+        Some(inst)
+    }
+
+    /// The live block starting at `phys` in `mode`.
+    fn find(&mut self, phys: u64, mode: CpuMode) -> Option<u32> {
+        let k = key(phys, mode);
+        let s = slot(k);
+        let b = self.lookup[s];
+        if b != NONE {
+            let block = &self.blocks[b as usize];
+            if block.phys == phys && block.mode == mode && block.len > 0 {
+                return Some(b);
+            }
+        }
+        let b = *self.by_addr.get(&k)?;
+        self.lookup[s] = b;
+        Some(b)
+    }
+
+    /// Decode a new block at `phys` and return its first instruction.
+    fn build(
+        &mut self,
+        decoder: &Decoder,
+        memory: &mut GuestMemory,
+        phys: u64,
+        mode: CpuMode,
+    ) -> Result<DecodedInst> {
+        self.stats.decodes += 1;
+        let first = decoder.decode(&*memory, phys)?;
+        let mut end = phys + first.length as u64;
+        if !memory.is_cacheable(phys, end) {
+            self.cur = NONE;
+            return Ok(first);
+        }
+
+        if self.insts.len() + MAX_BLOCK_INSTS > ARENA_INSTS || self.blocks.len() >= MAX_BLOCKS {
+            self.flush();
+            memory.clear_code_pages();
+        }
+
+        let start = self.insts.len();
+        let page_end = (phys / PAGE_SIZE + 1) * PAGE_SIZE;
+        let mut done = ends_block(&first);
+        self.insts.push(first.clone());
+        while !done && self.insts.len() - start < MAX_BLOCK_INSTS && end < page_end {
+            // Decoding ahead must not touch MMIO (reads can have side effects).
+            if !memory.is_cacheable(end, end + MAX_INST_LEN) {
+                break;
+            }
+            let inst = match decoder.decode(&*memory, end) {
+                Ok(inst) => inst,
+                Err(_) => break,
+            };
+            self.stats.decodes += 1;
+            let inst_end = end + inst.length as u64;
+            if inst_end > page_end {
+                break;
+            }
+            done = ends_block(&inst);
+            self.insts.push(inst);
+            end = inst_end;
+        }
+
+        let b = self.blocks.len() as u32;
+        let k = key(phys, mode);
+        self.blocks.push(Block {
+            phys,
+            end,
+            first: start as u32,
+            len: (self.insts.len() - start) as u32,
+            mode,
+            heat: 0,
+            jit: NONE,
+        });
+        self.by_addr.insert(k, b);
+        self.lookup[slot(k)] = b;
+        memory.mark_code(phys, end);
+
+        self.cur = b;
+        self.pos = 1;
+        self.next_phys = phys + first.length as u64;
+        Ok(first)
+    }
+
+    /// Drop the blocks on the code pages written since the last call.
+    pub fn invalidate(&mut self, memory: &mut GuestMemory) {
+        let pages = memory.take_code_writes();
+        self.invalidate_pages(&pages);
+    }
+
+    /// Drop the blocks decoded from any of the code `pages` (page numbers).
+    pub fn invalidate_pages(&mut self, pages: &[u64]) {
+        for &page in pages {
+            let lo = page * PAGE_SIZE;
+            let hi = lo + PAGE_SIZE;
+            let from = key(lo.saturating_sub(MAX_INST_LEN), CpuMode::Real16);
+            let to = key(hi, CpuMode::Real16);
+            let dead: Vec<u64> = self
+                .by_addr
+                .range(from..to)
+                .filter(|&(_, &b)| self.blocks[b as usize].end > lo)
+                .map(|(&k, _)| k)
+                .collect();
+            for k in dead {
+                if let Some(b) = self.by_addr.remove(&k) {
+                    self.blocks[b as usize].len = 0;
+                    if self.lookup[slot(k)] == b {
+                        self.lookup[slot(k)] = NONE;
+                    }
+                    if self.cur == b {
+                        self.cur = NONE;
+                    }
+                    self.stats.invalidations += 1;
+                }
+            }
+        }
+    }
+
+    /// Empty the cache (the counters are kept).
+    pub fn flush(&mut self) {
+        self.insts.clear();
+        self.blocks.clear();
+        self.by_addr.clear();
+        self.lookup.fill(NONE);
+        self.jit.clear();
+        self.cur = NONE;
+        self.stats.flushes += 1;
+    }
+}
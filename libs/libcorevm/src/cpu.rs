@@ -3,8 +3,11 @@
 //! The `Cpu` struct holds all architectural state (registers, FPU, SSE)
 //! and implements the fetch-decode-execute cycle. The execution loop
 //! catches instruction errors and routes them to the guest's IDT as
-//! hardware exceptions.
+//! hardware exceptions. Decoded instructions are reused through the
+//! [`BlockCache`] while their code is unchanged, and hot blocks run as
+//! host code translated by the [`jit`](crate::jit) tier.
 
+use crate::block_cache::BlockCache;
 use crate::decoder::{CpuMode, Decoder};
 use crate::error::{Result, VmError};
 use crate::fpu_state::FpuState;
@@ -15,6 +18,7 @@ use crate::registers::SegmentDescriptor;
 use crate::registers::{
     RegisterFile, SegReg, CR0_PE, CR0_PG, EFER_LMA, EFER_LME, MSR_EFER,
 };
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::sse_state::SseState;
 
 /// CPU execution mode.
@@ -53,6 +57,8 @@ pub struct Cpu {
     pub sse: SseState,
     /// Instruction decoder.
     pub decoder: Decoder,
+    /// Cache of decoded instruction blocks.
+    pub icache: BlockCache,
     /// Current CPU mode.
     pub mode: Mode,
     /// Number of instructions executed since last reset.
@@ -69,6 +75,10 @@ pub struct Cpu {
     pub last_opcode: u16,
     /// Physical address of the last decoded instruction.
     pub last_fetch_addr: u64,
+    /// Local APIC ID reported by CPUID.
+    pub apic_id: u8,
+    /// vCPUs in the VM, or 0 if there is no local APIC.
+    pub apic_cpus: u8,
 }
 
 impl Cpu {
@@ -79,6 +89,7 @@ impl Cpu {
             fpu: FpuState::new(),
             sse: SseState::new(),
             decoder: Decoder::new(CpuMode::Real16),
+            icache: BlockCache::new(),
             mode: Mode::RealMode,
             instruction_count: 0,
             stop_requested: false,
@@ -87,6 +98,8 @@ impl Cpu {
             last_exec_cs: 0,
             last_opcode: 0,
             last_fetch_addr: 0,
+            apic_id: 0,
+            apic_cpus: 0,
         }
     }
 
@@ -97,6 +110,7 @@ impl Cpu {
         self.sse = SseState::new();
         self.mode = Mode::RealMode;
         self.decoder.set_mode(CpuMode::Real16);
+        self.icache.flush();
         self.instruction_count = 0;
         self.stop_requested = false;
         self.last_exec_rip = 0;
@@ -254,6 +268,9 @@ impl Cpu {
     /// * `interrupts` — Interrupt controller
     /// * `io` — Port I/O dispatcher
     /// * `max_instructions` — Stop after this many instructions (0 = unlimited)
+    ///
+    /// Deferred arithmetic flags are folded into RFLAGS before returning, so
+    /// callers always see the complete register.
     pub fn run(
         &mut self,
         memory: &mut GuestMemory,
@@ -261,6 +278,19 @@ impl Cpu {
         interrupts: &mut InterruptController,
         io: &mut IoDispatch,
         max_instructions: u64,
+    ) -> ExitReason {
+        let exit = self.run_loop(memory, mmu, interrupts, io, max_instructions);
+        self.regs.materialize_flags();
+        exit
+    }
+
+    fn run_loop(
+        &mut self,
+        memory: &mut GuestMemory,
+        mmu: &mut Mmu,
+        interrupts: &mut InterruptController,
+        io: &mut IoDispatch,
+        max_instructions: u64,
     ) -> ExitReason {
         // Compute absolute target so the limit applies per-call, not cumulatively.
         let target = if max_instructions > 0 {
@@ -268,10 +298,13 @@ impl Cpu {
         } else {
             0
         };
+        let mut next_poll = self.instruction_count;
         loop {
             // Check stop request and instruction limit periodically (every 256 instructions)
-            // to reduce branch overhead in the hot loop.
-            if self.instruction_count & 0xFF == 0 {
+            // to reduce branch overhead in the hot loop. Translated code runs
+            // many instructions at once, so the count may step past a multiple.
+            if self.instruction_count >= next_poll {
+                next_poll = (self.instruction_count | 0xFF) + 1;
                 if self.stop_requested {
                     self.stop_requested = false;
                     return ExitReason::StopRequested;
@@ -281,6 +314,12 @@ impl Cpu {
                 }
             }
 
+            // Drop cached blocks whose code the last instruction (or a
+            // device) overwrote.
+            if memory.code_written() {
+                self.icache.invalidate(memory);
+            }
+
             // Sync MMU state from control registers (fast-path: skips if unchanged).
             mmu.update_from_regs(self.regs.cr0, self.regs.cr4, self.regs.efer);
 
@@ -333,10 +372,18 @@ impl Cpu {
             self.last_exec_cs = self.regs.seg[SegReg::Cs as usize].selector;
             self.last_fetch_addr = phys_addr;
 
+            // Hot block: run its translation instead.
+            if let Some(block) = self.icache.translated(phys_addr, self.decoder.mode()) {
+                self.regs.materialize_flags();
+                let rip_mask = crate::executor::control::mask_rip(self, u64::MAX);
+                self.instruction_count += self.icache.run_translated(block, &mut self.regs, rip_mask);
+                continue;
+            }
+
             // Fetch & decode — use physical address for flat memory read
             // Note: for simplicity, we decode from physical memory directly.
             // A proper implementation would handle page-crossing instruction fetches.
-            let inst = match self.decoder.decode(&*memory, phys_addr) {
+            let inst = match self.icache.fetch(&self.decoder, memory, phys_addr) {
                 Ok(inst) => inst,
                 Err(VmError::FetchFault(_addr)) => {
                     let pf = VmError::PageFault {
@@ -377,6 +424,10 @@ impl Cpu {
 
             self.last_opcode = inst.opcode;
 
+            if self.regs.lazy.is_pending() && !crate::executor::keeps_lazy_flags(&inst) {
+                self.regs.materialize_flags();
+            }
+
             // Execute the decoded instruction
             match crate::executor::execute(self, &inst, memory, mmu, io, interrupts) {
                 Ok(()) => {
@@ -485,6 +536,8 @@ impl Cpu {
         mmu: &mut Mmu,
         interrupts: &mut InterruptController,
     ) -> Result<()> {
+        // The handlers push RFLAGS.
+        self.regs.materialize_flags();
         match self.mode {
             Mode::RealMode => {
                 self.deliver_interrupt_real(vector, memory, mmu)
@@ -727,3 +780,142 @@ impl Cpu {
         Ok(())
     }
 }
+
+impl Snapshot for Cpu {
+    fn save(&self, w: &mut StateWriter) {
+        let regs = &self.regs;
+        for &gpr in &regs.gpr {
+            w.u64(gpr);
+        }
+        w.u64(regs.rip);
+        w.u64(regs.flags());
+        for seg in &regs.seg {
+            w.u16(seg.selector);
+            w.u64(seg.base);
+            w.u32(seg.limit);
+            w.u8(seg.access);
+            w.u8(seg.flags);
+            w.u8(seg.dpl);
+            let bits = [
+                seg.present, seg.is_code, seg.is_conforming, seg.readable,
+                seg.writable, seg.big, seg.long_mode, seg.granularity,
+            ];
+            w.u8(bits.iter().enumerate().fold(0, |acc, (i, &b)| acc | (b as u8) << i));
+        }
+        for cr in [regs.cr0, regs.cr2, regs.cr3, regs.cr4, regs.cr8] {
+            w.u64(cr);
+        }
+        for &dr in &regs.dr {
+            w.u64(dr);
+        }
+        for table in [regs.gdtr, regs.idtr] {
+            w.u64(table.base);
+            w.u16(table.limit);
+        }
+        w.u16(regs.ldtr);
+        w.u16(regs.tr);
+        w.u32(regs.msr.len() as u32);
+        for (&index, &val) in &regs.msr {
+            w.u32(index);
+            w.u64(val);
+        }
+        w.u8(regs.cpl);
+
+        let fpu = &self.fpu;
+        for st in fpu.st {
+            w.u64(st.to_bits());
+        }
+        w.u8(fpu.top);
+        w.u16(fpu.fcw);
+        w.u16(fpu.fsw);
+        w.u16(fpu.ftw);
+        w.u64(fpu.fip);
+        w.u64(fpu.fdp);
+        w.u16(fpu.fop);
+
+        for xmm in &self.sse.xmm {
+            w.u64(xmm.lo);
+            w.u64(xmm.hi);
+        }
+        w.u32(self.sse.mxcsr);
+
+        w.bool(self.a20_enabled);
+        w.u64(self.instruction_count);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        let mut regs = RegisterFile::new();
+        for gpr in regs.gpr.iter_mut() {
+            *gpr = r.u64()?;
+        }
+        regs.rip = r.u64()?;
+        regs.rflags = r.u64()?;
+        for seg in regs.seg.iter_mut() {
+            seg.selector = r.u16()?;
+            seg.base = r.u64()?;
+            seg.limit = r.u32()?;
+            seg.access = r.u8()?;
+            seg.flags = r.u8()?;
+            seg.dpl = r.u8()?;
+            let bits = r.u8()?;
+            let bit = |i: u8| bits & (1 << i) != 0;
+            seg.present = bit(0);
+            seg.is_code = bit(1);
+            seg.is_conforming = bit(2);
+            seg.readable = bit(3);
+            seg.writable = bit(4);
+            seg.big = bit(5);
+            seg.long_mode = bit(6);
+            seg.granularity = bit(7);
+        }
+        regs.cr0 = r.u64()?;
+        regs.cr2 = r.u64()?;
+        regs.cr3 = r.u64()?;
+        regs.cr4 = r.u64()?;
+        regs.cr8 = r.u64()?;
+        for dr in regs.dr.iter_mut() {
+            *dr = r.u64()?;
+        }
+        for table in [&mut regs.gdtr, &mut regs.idtr] {
+            table.base = r.u64()?;
+            table.limit = r.u16()?;
+        }
+        regs.ldtr = r.u16()?;
+        regs.tr = r.u16()?;
+        for _ in 0..r.u32()? {
+            let index = r.u32()?;
+            let val = r.u64()?;
+            regs.write_msr(index, val);
+        }
+        regs.cpl = r.u8()?;
+
+        let mut fpu = FpuState::new();
+        for st in fpu.st.iter_mut() {
+            *st = f64::from_bits(r.u64()?);
+        }
+        fpu.top = r.u8()? & 7;
+        fpu.fcw = r.u16()?;
+        fpu.fsw = r.u16()?;
+        fpu.ftw = r.u16()?;
+        fpu.fip = r.u64()?;
+        fpu.fdp = r.u64()?;
+        fpu.fop = r.u16()?;
+
+        let mut sse = SseState::new();
+        for xmm in sse.xmm.iter_mut() {
+            xmm.lo = r.u64()?;
+            xmm.hi = r.u64()?;
+        }
+        sse.mxcsr = r.u32()?;
+
+        self.a20_enabled = r.bool()?;
+        self.instruction_count = r.u64()?;
+        self.regs = regs;
+        self.fpu = fpu;
+        self.sse = sse;
+        self.stop_requested = false;
+        self.update_mode();
+        self.icache.flush();
+        Ok(())
+    }
+}
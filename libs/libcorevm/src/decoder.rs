@@ -60,6 +60,12 @@ impl Decoder {
         self.mode = mode;
     }
 
+    /// The mode instructions are currently decoded in.
+    #[inline]
+    pub fn mode(&self) -> CpuMode {
+        self.mode
+    }
+
     /// Decode one instruction starting at `rip`.
     ///
     /// Returns a [`DecodedInst`] describing the opcode, operands, prefixes, and
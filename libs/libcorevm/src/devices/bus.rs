@@ -41,7 +41,8 @@
 //! | 0x3D | 1 | Interrupt Pin |
 
 use alloc::vec::Vec;
-use crate::error::Result;
+use crate::error::{Result, VmError};
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 /// A single PCI device with a 256-byte configuration space (header type 0).
@@ -59,6 +60,8 @@ pub struct PciDevice {
     /// all-ones to a BAR, the device returns the size mask so the guest
     /// can determine the BAR's required address space size.
     bar_sizes: [u32; 6],
+    /// BAR values the guest cannot move (see [`set_fixed_bar`](Self::set_fixed_bar)).
+    fixed_bars: [Option<u32>; 6],
 }
 
 impl PciDevice {
@@ -102,6 +105,7 @@ impl PciDevice {
             function: 0,
             config_space,
             bar_sizes: [0; 6],
+            fixed_bars: [None; 6],
         }
     }
 
@@ -138,6 +142,21 @@ impl PciDevice {
         }
     }
 
+    /// Configure a BAR whose address the guest cannot change.
+    ///
+    /// Size probing works as for [`set_bar`](Self::set_bar), but any
+    /// address the guest (or firmware) writes afterwards is replaced by
+    /// `address` again. Used for devices whose handlers are registered at
+    /// a fixed location in the I/O or MMIO dispatch.
+    pub fn set_fixed_bar(&mut self, bar_index: usize, address: u32, size: u32, is_mmio: bool) {
+        if bar_index >= 6 {
+            return;
+        }
+        self.set_bar(bar_index, address, size, is_mmio);
+        let offset = 0x10 + bar_index * 4;
+        self.fixed_bars[bar_index] = Some(config_read_u32(&self.config_space, offset));
+    }
+
     /// Set the interrupt line and pin.
     ///
     /// - `line`: interrupt line (IRQ number, 0-255)
@@ -187,6 +206,15 @@ impl PciBus {
         self.devices.push(pci_device);
     }
 
+    /// Interrupt line of device `device` on bus 0, as last programmed by
+    /// the guest (firmware rewrites it according to its IRQ routing).
+    pub fn interrupt_line(&self, device: u8) -> Option<u8> {
+        self.devices
+            .iter()
+            .find(|d| d.bus == 0 && d.device == device && d.function == 0)
+            .map(|d| d.config_space[0x3C])
+    }
+
     /// Find the device matching the bus/device/function from the current
     /// config address.
     fn find_device(&mut self, bus: u8, device: u8, function: u8) -> Option<&mut PciDevice> {
@@ -253,6 +281,10 @@ impl PciBus {
                         config_write_u32(&mut dev.config_space, register, dev.bar_sizes[bar_index]);
                         return;
                     }
+                    if let Some(fixed) = dev.fixed_bars[bar_index] {
+                        config_write_u32(&mut dev.config_space, register, fixed);
+                        return;
+                    }
                     // Normal BAR write: preserve type bits (bit 0 for I/O,
                     // bits 0-3 for MMIO).
                     let type_bits = dev.config_space[register] & 0x0F;
@@ -371,3 +403,30 @@ fn config_write_u16(data: &mut [u8], offset: usize, val: u16) {
     data[offset] = val as u8;
     data[offset + 1] = (val >> 8) as u8;
 }
+
+impl Snapshot for PciBus {
+    /// The address latch and every function's configuration space. The
+    /// restoring VM must have the same devices in the same order.
+    fn save(&self, w: &mut StateWriter) {
+        w.u32(self.config_address);
+        w.u32(self.devices.len() as u32);
+        for dev in &self.devices {
+            w.bytes(&[dev.bus, dev.device, dev.function]);
+            w.bytes(&dev.config_space);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.config_address = r.u32()?;
+        if r.u32()? as usize != self.devices.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        for dev in self.devices.iter_mut() {
+            if r.bytes(3)? != [dev.bus, dev.device, dev.function] {
+                return Err(VmError::InvalidSnapshot);
+            }
+            r.fill(&mut dev.config_space)?;
+        }
+        Ok(())
+    }
+}
@@ -23,6 +23,7 @@
 //! - `0x34-0x35`: Extended memory above 16 MB (64 KB units)
 
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 /// CMOS RTC and NVRAM controller.
@@ -147,3 +148,18 @@ impl IoHandler for Cmos {
         Ok(())
     }
 }
+
+impl Snapshot for Cmos {
+    fn save(&self, w: &mut StateWriter) {
+        w.u8(self.index);
+        w.bytes(&self.data);
+        w.bool(self.nmi_disabled);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.index = r.u8()?;
+        r.fill(&mut self.data)?;
+        self.nmi_disabled = r.bool()?;
+        Ok(())
+    }
+}
@@ -35,7 +35,8 @@
 use alloc::collections::VecDeque;
 use alloc::vec;
 use alloc::vec::Vec;
-use crate::error::Result;
+use crate::error::{Result, VmError};
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::memory::mmio::MmioHandler;
 
 // Register offsets (dword-aligned).
@@ -284,3 +285,32 @@ impl MmioHandler for E1000 {
         Ok(())
     }
 }
+
+impl Snapshot for E1000 {
+    /// Registers, MAC address and EEPROM. Packets queued between the host
+    /// and the device are not machine state and are left alone.
+    fn save(&self, w: &mut StateWriter) {
+        w.u32(self.regs.len() as u32);
+        for &reg in &self.regs {
+            w.u32(reg);
+        }
+        w.bytes(&self.mac_address);
+        for &word in &self.eeprom {
+            w.u16(word);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        if r.u32()? as usize != self.regs.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        for reg in self.regs.iter_mut() {
+            *reg = r.u32()?;
+        }
+        r.fill(&mut self.mac_address)?;
+        for word in self.eeprom.iter_mut() {
+            *word = r.u16()?;
+        }
+        Ok(())
+    }
+}
@@ -19,6 +19,7 @@
 
 use alloc::vec::Vec;
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 // Well-known fw_cfg selector keys.
@@ -61,6 +62,8 @@ pub struct FwCfg {
     offset: usize,
     /// Guest RAM size in bytes.
     ram_size: u64,
+    /// Number of vCPUs.
+    cpus: u16,
     /// File directory entries.
     files: Vec<FwCfgFileEntry>,
 }
@@ -83,10 +86,17 @@ impl FwCfg {
             selector: 0,
             offset: 0,
             ram_size,
+            cpus: 1,
             files: Vec::new(),
         }
     }
 
+    /// Set the vCPU count reported to the firmware (SeaBIOS waits for this
+    /// many CPUs to answer its startup IPI and lists them in the MADT).
+    pub fn set_cpu_count(&mut self, cpus: u16) {
+        self.cpus = cpus.max(1);
+    }
+
     /// Add a named file to the fw_cfg file directory.
     ///
     /// The file will be assigned the next available selector key (starting at 0x0020).
@@ -126,12 +136,12 @@ impl FwCfg {
                 0u16.to_le_bytes().to_vec()
             }
             FW_CFG_NB_CPUS => {
-                // 1 CPU.
-                1u16.to_le_bytes().to_vec()
+                // vCPUs present at boot.
+                self.cpus.to_le_bytes().to_vec()
             }
             FW_CFG_MAX_CPUS => {
-                // Max 1 APIC ID.
-                1u16.to_le_bytes().to_vec()
+                // APIC IDs 0..cpus.
+                self.cpus.to_le_bytes().to_vec()
             }
             FW_CFG_BOOT_MENU => {
                 // No boot menu.
@@ -241,3 +251,18 @@ impl IoHandler for FwCfg {
         Ok(())
     }
 }
+
+impl Snapshot for FwCfg {
+    /// The selector and read position; the items themselves are set up by
+    /// the host and identical in the restoring VM.
+    fn save(&self, w: &mut StateWriter) {
+        w.u16(self.selector);
+        w.u32(self.offset as u32);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.selector = r.u16()?;
+        self.offset = r.u32()? as usize;
+        Ok(())
+    }
+}
@@ -2,7 +2,8 @@
 //!
 //! Emulates a single-channel ATA controller with one drive (master)
 //! attached. Supports PIO data transfers used by BIOS INT 13h and
-//! early Linux boot (before DMA drivers are loaded).
+//! early Linux boot, and, once [`Ide::enable_bus_master`] has given it
+//! guest RAM, PCI bus-master DMA as on the PIIX3 IDE function.
 //!
 //! # I/O Ports
 //!
@@ -10,6 +11,20 @@
 //! |------------|-------------|
 //! | 0x1F0-0x1F7 | Primary ATA command block |
 //! | 0x3F6-0x3F7 | Primary ATA control block |
+//! | BAR4 + 0x00-0x07 | Primary channel bus-master registers |
+//! | BAR4 + 0x08-0x0F | Secondary channel bus-master registers (no drive) |
+//!
+//! # Bus-Master DMA
+//!
+//! The driver points the bus-master PRD register at a table of physical
+//! region descriptors (address, byte count, end-of-table flag), issues a
+//! DMA command and sets the start bit. The whole transfer then runs at
+//! once: each region is copied between the disk image and guest RAM with
+//! a single `memcpy` (in place, for regions in plain RAM), and the drive
+//! raises one interrupt at the end instead of one per sector. The
+//! controller reaches guest RAM through a raw pointer to the VM's
+//! [`GuestMemory`], like the virtio devices; port handlers run between
+//! instructions, so nothing else borrows it meanwhile.
 //!
 //! # Supported Commands
 //!
@@ -20,13 +35,19 @@
 //! | WRITE SECTORS | 0x30 | PIO write (28-bit LBA) |
 //! | READ SECTORS EXT | 0x24 | PIO read (48-bit LBA) |
 //! | WRITE SECTORS EXT | 0x34 | PIO write (48-bit LBA) |
+//! | READ DMA | 0xC8 | DMA read (28-bit LBA) |
+//! | WRITE DMA | 0xCA | DMA write (28-bit LBA) |
+//! | READ DMA EXT | 0x25 | DMA read (48-bit LBA) |
+//! | WRITE DMA EXT | 0x35 | DMA write (48-bit LBA) |
 //! | SET FEATURES | 0xEF | Feature configuration |
 //! | FLUSH CACHE | 0xE7 | Flush write cache |
 //! | DEVICE RESET | 0x08 | Software reset |
 
 use alloc::vec::Vec;
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
+use crate::memory::{GuestMemory, MemoryBus};
 
 // ── ATA status register bits ──
 
@@ -63,6 +84,36 @@ const CMD_READ_MULTIPLE: u8 = 0xC4;
 const CMD_WRITE_MULTIPLE: u8 = 0xC5;
 const CMD_SET_MULTIPLE: u8 = 0xC6;
 const CMD_NOP: u8 = 0x00;
+const CMD_READ_DMA: u8 = 0xC8;
+const CMD_WRITE_DMA: u8 = 0xCA;
+const CMD_READ_DMA_EXT: u8 = 0x25;
+const CMD_WRITE_DMA_EXT: u8 = 0x35;
+
+/// SET FEATURES subcommand: set transfer mode (mode in sector count).
+const FEAT_XFER_MODE: u8 = 0x03;
+
+// ── Bus-master registers ──
+
+/// Size of the bus-master I/O BAR (two channels of 8 registers).
+pub const BM_BAR_SIZE: u16 = 16;
+/// Command register: start/stop bus master.
+const BM_CMD_START: u8 = 0x01;
+/// Command register: transfer direction (set = device to memory).
+const BM_CMD_READ: u8 = 0x08;
+/// Status register: bus master active.
+const BM_ST_ACTIVE: u8 = 0x01;
+/// Status register: DMA error (write 1 to clear).
+const BM_ST_ERROR: u8 = 0x02;
+/// Status register: interrupt raised (write 1 to clear).
+const BM_ST_INTERRUPT: u8 = 0x04;
+/// Status register: drive 0 / drive 1 DMA capable (software-owned).
+const BM_ST_CAPABLE: u8 = 0x60;
+/// Status register: drive 0 DMA capable.
+const BM_ST_DRIVE0_DMA: u8 = 0x20;
+/// PRD flag: last entry of the table.
+const PRD_EOT: u16 = 0x8000;
+/// Longest PRD table walked (a 64 KiB table holds 8192 entries).
+const PRD_MAX_ENTRIES: u32 = 8192;
 
 /// Sector size in bytes.
 const SECTOR_SIZE: usize = 512;
@@ -125,6 +176,24 @@ pub struct Ide {
     irq_pending: bool,
     /// Multiple sector count for READ/WRITE MULTIPLE.
     multiple_count: u8,
+    /// Transfer mode selected with SET FEATURES (0 = default PIO).
+    xfer_mode: u8,
+
+    // ── Bus-master DMA ──
+
+    /// Guest RAM DMA transfers go to (null while bus mastering is off).
+    memory: *mut GuestMemory,
+    /// First port of the bus-master BAR (0 = bus mastering off).
+    bm_base: u16,
+    /// Primary channel bus-master command register.
+    bm_command: u8,
+    /// Primary channel bus-master status register.
+    bm_status: u8,
+    /// Physical address of the PRD table.
+    prd_addr: u32,
+    /// DMA command waiting for the start bit: first LBA and sector count.
+    /// The direction is in `is_write`.
+    dma_pending: Option<(u64, u32)>,
 }
 
 impl Ide {
@@ -153,9 +222,25 @@ impl Ide {
             is_write: false,
             irq_pending: false,
             multiple_count: 1,
+            xfer_mode: 0,
+            memory: core::ptr::null_mut(),
+            bm_base: 0,
+            bm_command: 0,
+            bm_status: 0,
+            prd_addr: 0,
+            dma_pending: None,
         }
     }
 
+    /// Enable bus-master DMA through the registers at `base`
+    /// ([`BM_BAR_SIZE`] ports) into `memory`, which must outlive the
+    /// controller. DMA is advertised in IDENTIFY from then on.
+    pub fn enable_bus_master(&mut self, memory: *mut GuestMemory, base: u16) {
+        self.memory = memory;
+        self.bm_base = base;
+        self.bm_status = BM_ST_DRIVE0_DMA;
+    }
+
     /// Attach a disk image. The image is a flat sector dump.
     ///
     /// The image length is rounded down to the nearest sector boundary.
@@ -298,8 +383,9 @@ impl Ide {
         // Word 47: Max sectors per READ/WRITE MULTIPLE.
         w(&mut self.buffer, 47, 0x8010); // max 16 sectors
 
-        // Word 49: Capabilities — LBA supported, DMA not supported.
-        w(&mut self.buffer, 49, 0x0200); // LBA supported
+        // Word 49: Capabilities — LBA supported, DMA if bus mastering is on.
+        let dma = self.bm_base != 0;
+        w(&mut self.buffer, 49, if dma { 0x0300 } else { 0x0200 });
 
         // Word 53: Fields validity — words 54-58, 64-70, 88 valid.
         w(&mut self.buffer, 53, 0x0007);
@@ -319,6 +405,18 @@ impl Ide {
         w(&mut self.buffer, 60, lba28_max as u16);
         w(&mut self.buffer, 61, (lba28_max >> 16) as u16);
 
+        // Word 63: Multiword DMA modes 0-2 supported, bits 10:8 selected.
+        // Word 88: Ultra DMA modes 0-5 supported, bits 13:8 selected.
+        if dma {
+            let (mwdma, udma) = match self.xfer_mode & 0xF8 {
+                0x20 => (1u16 << (8 + (self.xfer_mode & 7).min(2)), 0u16),
+                0x40 => (0, 1u16 << (8 + (self.xfer_mode & 7).min(5))),
+                _ => (0, 0),
+            };
+            w(&mut self.buffer, 63, 0x0007 | mwdma);
+            w(&mut self.buffer, 88, 0x003F | udma);
+        }
+
         // Word 80: ATA major version — ATA-6.
         w(&mut self.buffer, 80, 0x0040);
 
@@ -420,7 +518,29 @@ impl Ide {
                 self.irq_pending = true;
             }
 
-            CMD_SET_FEATURES | CMD_INIT_DRIVE_PARAMS | CMD_NOP => {
+            CMD_READ_DMA | CMD_WRITE_DMA => {
+                let count = if self.sector_count == 0 { 256u32 } else { self.sector_count as u32 };
+                let lba = self.lba28();
+                self.start_dma(lba, count, cmd == CMD_WRITE_DMA);
+            }
+
+            CMD_READ_DMA_EXT | CMD_WRITE_DMA_EXT => {
+                let c = ((self.hob_sector_count as u32) << 8) | self.sector_count as u32;
+                let count = if c == 0 { 65536u32 } else { c };
+                let lba = self.lba48();
+                self.start_dma(lba, count, cmd == CMD_WRITE_DMA_EXT);
+            }
+
+            CMD_SET_FEATURES => {
+                if self.features == FEAT_XFER_MODE {
+                    self.xfer_mode = self.sector_count;
+                }
+                self.status = SR_DRDY | SR_DSC;
+                self.error = 0;
+                self.irq_pending = true;
+            }
+
+            CMD_INIT_DRIVE_PARAMS | CMD_NOP => {
                 // Accept and do nothing meaningful.
                 self.status = SR_DRDY | SR_DSC;
                 self.error = 0;
@@ -471,6 +591,156 @@ impl Ide {
         self.irq_pending = true;
     }
 
+    /// Begin a DMA transfer; it runs when the bus master is started (or
+    /// right away if it already is).
+    fn start_dma(&mut self, lba: u64, count: u32, write: bool) {
+        if self.bm_base == 0 || lba >= self.total_sectors {
+            self.status = SR_DRDY | SR_ERR;
+            self.error = ER_ABRT;
+            self.irq_pending = true;
+            return;
+        }
+        self.dma_pending = Some((lba, count));
+        self.is_write = write;
+        self.sectors_remaining = 0;
+        self.status = SR_BSY | SR_DRDY | SR_DSC;
+        self.error = 0;
+        if self.bm_command & BM_CMD_START != 0 {
+            self.run_dma();
+        }
+    }
+
+    /// Carry out the pending DMA transfer through the PRD table.
+    fn run_dma(&mut self) {
+        let (lba, count) = match self.dma_pending.take() {
+            Some(p) => p,
+            None => return,
+        };
+        // Safety: see the module docs.
+        let mem = unsafe { &mut *self.memory };
+        let mut disk_off = lba as usize * SECTOR_SIZE;
+        let mut left = count as usize * SECTOR_SIZE;
+        let mut prd = self.prd_addr as u64 & !3;
+        let mut eot = false;
+        for _ in 0..PRD_MAX_ENTRIES {
+            if left == 0 || eot {
+                break;
+            }
+            let addr = mem.read_u32(prd).unwrap_or(0) as u64 & !1;
+            let bytes = mem.read_u16(prd + 4).unwrap_or(0);
+            eot = mem.read_u16(prd + 6).unwrap_or(PRD_EOT) & PRD_EOT != 0;
+            prd += 8;
+            let len = (if bytes == 0 { 0x10000 } else { bytes as usize }).min(left);
+            if self.is_write {
+                self.dma_to_disk(mem, addr, disk_off, len);
+            } else {
+                self.dma_from_disk(mem, addr, disk_off, len);
+            }
+            disk_off += len;
+            left -= len;
+        }
+
+        // A table shorter than the transfer is an error; a longer one
+        // leaves the bus master active, as on real hardware.
+        self.bm_status |= BM_ST_INTERRUPT;
+        if left > 0 {
+            self.bm_status |= BM_ST_ERROR;
+            self.bm_status &= !BM_ST_ACTIVE;
+            self.status = SR_DRDY | SR_DSC | SR_ERR;
+            self.error = ER_ABRT;
+        } else {
+            if eot {
+                self.bm_status &= !BM_ST_ACTIVE;
+            }
+            self.status = SR_DRDY | SR_DSC;
+        }
+        self.is_write = false;
+        self.irq_pending = true;
+    }
+
+    /// Copy `len` disk bytes at `disk_off` to guest RAM at `addr`. Bytes
+    /// beyond the image read as zeros.
+    fn dma_from_disk(&self, mem: &mut GuestMemory, addr: u64, disk_off: usize, len: usize) {
+        let avail = self.disk.len().saturating_sub(disk_off).min(len);
+        let src = &self.disk[disk_off.min(self.disk.len())..][..avail];
+        match mem.dma_slice_mut(addr, len) {
+            Some(dst) => {
+                dst[..avail].copy_from_slice(src);
+                dst[avail..].fill(0);
+            }
+            None => {
+                let mut buf = alloc::vec![0u8; len];
+                buf[..avail].copy_from_slice(src);
+                let _ = mem.write_bytes(addr, &buf);
+            }
+        }
+    }
+
+    /// Copy `len` bytes of guest RAM at `addr` to the disk at `disk_off`.
+    /// Bytes beyond the image are dropped.
+    fn dma_to_disk(&mut self, mem: &GuestMemory, addr: u64, disk_off: usize, len: usize) {
+        let avail = self.disk.len().saturating_sub(disk_off).min(len);
+        if avail == 0 {
+            return;
+        }
+        let dst = &mut self.disk[disk_off..disk_off + avail];
+        match mem.dma_slice(addr, avail) {
+            Some(src) => dst.copy_from_slice(src),
+            None => {
+                let _ = mem.read_bytes(addr, dst);
+            }
+        }
+    }
+
+    /// Read a bus-master register (`offset` from the BAR).
+    fn bm_read(&mut self, offset: u16, size: u8) -> u32 {
+        match offset {
+            0 => self.bm_command as u32,
+            2 => self.bm_status as u32,
+            4 => match size {
+                1 => self.prd_addr & 0xFF,
+                2 => self.prd_addr & 0xFFFF,
+                _ => self.prd_addr,
+            },
+            // Secondary channel: no drive, registers read as zero.
+            _ => 0,
+        }
+    }
+
+    /// Write a bus-master register (`offset` from the BAR).
+    fn bm_write(&mut self, offset: u16, size: u8, val: u32) {
+        match offset {
+            0 => {
+                let v = val as u8 & (BM_CMD_START | BM_CMD_READ);
+                let was_started = self.bm_command & BM_CMD_START != 0;
+                self.bm_command = v;
+                if v & BM_CMD_START == 0 {
+                    // Stopping the bus master aborts a transfer in flight.
+                    self.bm_status &= !BM_ST_ACTIVE;
+                } else if !was_started {
+                    self.bm_status |= BM_ST_ACTIVE;
+                    self.run_dma();
+                }
+            }
+            2 => {
+                let v = val as u8;
+                self.bm_status = (self.bm_status & !(BM_ST_CAPABLE | (v & (BM_ST_ERROR | BM_ST_INTERRUPT))))
+                    | (v & BM_ST_CAPABLE);
+            }
+            4..=7 => {
+                let shift = (offset - 4) * 8;
+                let mask = match size {
+                    1 => 0xFFu32,
+                    2 => 0xFFFF,
+                    _ => 0xFFFF_FFFF,
+                } << shift;
+                self.prd_addr = (self.prd_addr & !mask) | ((val << shift) & mask);
+                self.prd_addr &= !3;
+            }
+            _ => {}
+        }
+    }
+
     /// Handle a 16-bit read from the data register (port 0x1F0).
     fn read_data_word(&mut self) -> u16 {
         if self.status & SR_DRQ == 0 {
@@ -543,6 +813,9 @@ impl Ide {
 
 impl IoHandler for Ide {
     fn read(&mut self, port: u16, size: u8) -> Result<u32> {
+        if self.bm_base != 0 && port.wrapping_sub(self.bm_base) < BM_BAR_SIZE {
+            return Ok(self.bm_read(port - self.bm_base, size));
+        }
         match port {
             // Data register — 16-bit PIO reads.
             0x1F0 => {
@@ -579,7 +852,11 @@ impl IoHandler for Ide {
         }
     }
 
-    fn write(&mut self, port: u16, _size: u8, val: u32) -> Result<()> {
+    fn write(&mut self, port: u16, size: u8, val: u32) -> Result<()> {
+        if self.bm_base != 0 && port.wrapping_sub(self.bm_base) < BM_BAR_SIZE {
+            self.bm_write(port - self.bm_base, size, val);
+            return Ok(());
+        }
         let v = val as u8;
         match port {
             // Data register — 16-bit PIO writes.
@@ -661,3 +938,139 @@ impl IoHandler for Ide {
         Ok(())
     }
 }
+
+impl Snapshot for Ide {
+    /// Registers (bus-master ones included) and the transfer in progress,
+    /// but not the guest RAM pointer. The disk image belongs to
+    /// the host, which attaches the same one to the restoring VM.
+    fn save(&self, w: &mut StateWriter) {
+        w.bytes(&[
+            self.error, self.features, self.sector_count, self.sector_number,
+            self.cylinder_low, self.cylinder_high, self.drive_head, self.status,
+            self.hob_sector_count, self.hob_sector_number, self.hob_cylinder_low,
+            self.hob_cylinder_high, self.device_control, self.multiple_count,
+        ]);
+        w.bool(self.hob_toggle);
+        w.bytes(&self.buffer);
+        w.u32(self.buffer_offset as u32);
+        w.u32(self.sectors_remaining);
+        w.bool(self.is_write);
+        w.bool(self.irq_pending);
+        w.u8(self.xfer_mode);
+        w.u8(self.bm_command);
+        w.u8(self.bm_status);
+        w.u32(self.prd_addr);
+        let (lba, count) = self.dma_pending.unwrap_or((0, 0));
+        w.bool(self.dma_pending.is_some());
+        w.u64(lba);
+        w.u32(count);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        let mut regs = [0u8; 14];
+        r.fill(&mut regs)?;
+        [
+            self.error, self.features, self.sector_count, self.sector_number,
+            self.cylinder_low, self.cylinder_high, self.drive_head, self.status,
+            self.hob_sector_count, self.hob_sector_number, self.hob_cylinder_low,
+            self.hob_cylinder_high, self.device_control, self.multiple_count,
+        ] = regs;
+        self.hob_toggle = r.bool()?;
+        r.fill(&mut self.buffer)?;
+        self.buffer_offset = (r.u32()? as usize).min(SECTOR_SIZE);
+        self.sectors_remaining = r.u32()?;
+        self.is_write = r.bool()?;
+        self.irq_pending = r.bool()?;
+        self.xfer_mode = r.u8()?;
+        self.bm_command = r.u8()?;
+        self.bm_status = r.u8()?;
+        self.prd_addr = r.u32()?;
+        let pending = r.bool()?;
+        let lba = r.u64()?;
+        let count = r.u32()?;
+        self.dma_pending = if pending { Some((lba, count)) } else { None };
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const BM: u16 = 0xC080;
+    const PRD: u64 = 0x10000;
+
+    fn setup(mem: &mut GuestMemory) -> Ide {
+        let mut ide = Ide::new();
+        ide.attach_disk((0..8192u32).map(|i| (i / 512) as u8).collect());
+        ide.enable_bus_master(mem as *mut GuestMemory, BM);
+        ide.write(BM + 4, 4, PRD as u32).unwrap();
+        ide
+    }
+
+    fn command(ide: &mut Ide, cmd: u8, lba: u8, count: u8) {
+        ide.write(0x1F2, 1, count as u32).unwrap();
+        ide.write(0x1F3, 1, lba as u32).unwrap();
+        ide.write(0x1F4, 1, 0).unwrap();
+        ide.write(0x1F5, 1, 0).unwrap();
+        ide.write(0x1F6, 1, 0xE0).unwrap();
+        ide.write(0x1F7, 1, cmd as u32).unwrap();
+    }
+
+    #[test]
+    fn test_dma_read_write_through_prd_table() {
+        let mut mem = GuestMemory::new(1 << 20);
+        let mut ide = setup(&mut mem);
+
+        // Two regions, the second ending the table.
+        mem.write_u32(PRD, 0x20000).unwrap();
+        mem.write_u32(PRD + 4, 512).unwrap();
+        mem.write_u32(PRD + 8, 0x30000).unwrap();
+        mem.write_u32(PRD + 12, 0x8000_0200).unwrap();
+        ide.write(BM, 1, BM_CMD_READ as u32).unwrap();
+        command(&mut ide, CMD_READ_DMA, 3, 2);
+        assert_ne!(ide.read(0x3F6, 1).unwrap() as u8 & SR_BSY, 0);
+        assert!(!ide.irq_raised());
+        ide.write(BM, 1, (BM_CMD_READ | BM_CMD_START) as u32).unwrap();
+        assert_eq!(mem.read_u8(0x20000).unwrap(), 3);
+        assert_eq!(mem.read_u8(0x301FF).unwrap(), 4);
+        assert!(ide.irq_raised());
+        assert_eq!(ide.read(BM + 2, 1).unwrap() as u8 & 0x07, BM_ST_INTERRUPT);
+        assert_eq!(ide.read(0x1F7, 1).unwrap() as u8, SR_DRDY | SR_DSC);
+        // Writing back what was read acknowledges and keeps the capable bits.
+        let st = ide.read(BM + 2, 1).unwrap();
+        ide.write(BM + 2, 1, st).unwrap();
+        assert_eq!(ide.read(BM + 2, 1).unwrap() as u8, BM_ST_DRIVE0_DMA);
+
+        // Start already set: the command runs at once. 48-bit write.
+        ide.write(BM, 1, 0).unwrap();
+        mem.write_bytes(0x20000, &[0xAA; 512]).unwrap();
+        mem.write_u32(PRD + 4, 0x8000_0200).unwrap();
+        ide.write(BM, 1, BM_CMD_START as u32).unwrap();
+        command(&mut ide, CMD_WRITE_DMA_EXT, 5, 1);
+        assert_eq!(ide.disk[5 * 512 + 7], 0xAA);
+        assert_eq!(ide.disk[6 * 512], 6);
+        assert!(ide.irq_raised());
+    }
+
+    #[test]
+    fn test_dma_short_prd_table_and_identify() {
+        let mut mem = GuestMemory::new(1 << 20);
+        let mut ide = setup(&mut mem);
+        mem.write_u32(PRD, 0x20000).unwrap();
+        mem.write_u32(PRD + 4, 0x8000_0200).unwrap();
+        ide.write(BM, 1, (BM_CMD_READ | BM_CMD_START) as u32).unwrap();
+        command(&mut ide, CMD_READ_DMA, 0, 2);
+        assert_eq!(ide.read(BM + 2, 1).unwrap() as u8 & 0x07, BM_ST_INTERRUPT | BM_ST_ERROR);
+        assert_ne!(ide.read(0x1F7, 1).unwrap() as u8 & SR_ERR, 0);
+
+        // UDMA mode 5 selected through SET FEATURES shows up in IDENTIFY.
+        ide.write(0x1F1, 1, FEAT_XFER_MODE as u32).unwrap();
+        ide.write(0x1F2, 1, 0x45).unwrap();
+        ide.write(0x1F7, 1, CMD_SET_FEATURES as u32).unwrap();
+        ide.write(0x1F7, 1, CMD_IDENTIFY as u32).unwrap();
+        let words: alloc::vec::Vec<u16> = (0..256).map(|_| ide.read(0x1F0, 2).unwrap() as u16).collect();
+        assert_ne!(words[49] & 0x0100, 0);
+        assert_eq!(words[88], 0x203F);
+    }
+}
@@ -21,6 +21,7 @@
 //! | 0x10-0x3F | Redirection table (24 entries × 2 dwords each) |
 
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::memory::mmio::MmioHandler;
 
 /// Number of interrupt redirection entries (IRQ 0-23).
@@ -145,3 +146,22 @@ impl MmioHandler for IoApic {
         Ok(())
     }
 }
+
+impl Snapshot for IoApic {
+    fn save(&self, w: &mut StateWriter) {
+        w.u32(self.reg_select);
+        w.u32(self.id);
+        for &entry in &self.redir_table {
+            w.u64(entry);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.reg_select = r.u32()?;
+        self.id = r.u32()?;
+        for entry in self.redir_table.iter_mut() {
+            *entry = r.u64()?;
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,442 @@
+//! Local APIC emulation for SMP guests.
+//!
+//! Every vCPU has its own local APIC, but they all appear at the same
+//! physical address (0xFEE00000): an access reaches the APIC of the vCPU
+//! that made it. [`ApicBus`] owns all of them and is registered as the one
+//! MMIO handler for the window; the engine sets
+//! [`current`](ApicBus::current) before it runs each vCPU.
+//!
+//! Interrupts a local APIC accepts (fixed IPIs and its timer) are collected
+//! in a per-vCPU request bitmap that the engine moves into that vCPU's
+//! [`InterruptController`](crate::interrupts::InterruptController) before
+//! the vCPU runs again. Priority (TPR/PPR) and the in-service register are
+//! not modelled, so EOI is accepted and ignored; NMI and SMI IPIs are
+//! dropped.
+//!
+//! # MMIO Registers
+//!
+//! | Offset | Register |
+//! |--------|----------|
+//! | 0x020 | Local APIC ID |
+//! | 0x030 | Version |
+//! | 0x080 | Task priority |
+//! | 0x0B0 | EOI |
+//! | 0x0D0 | Logical destination |
+//! | 0x0E0 | Destination format |
+//! | 0x0F0 | Spurious interrupt vector |
+//! | 0x200-0x270 | Interrupt request register |
+//! | 0x280 | Error status |
+//! | 0x300 / 0x310 | Interrupt command (low / high) |
+//! | 0x320-0x370 | LVT timer, thermal, perf, LINT0, LINT1, error |
+//! | 0x380 / 0x390 | Timer initial / current count |
+//! | 0x3E0 | Timer divide configuration |
+
+use alloc::vec::Vec;
+
+use crate::error::{Result, VmError};
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
+use crate::memory::mmio::MmioHandler;
+
+/// Physical base of the local APIC window.
+pub const LAPIC_BASE: u64 = 0xFEE0_0000;
+
+/// Size of the local APIC window.
+pub const LAPIC_SIZE: u64 = 0x1000;
+
+/// IA32_APIC_BASE MSR.
+pub const MSR_APIC_BASE: u32 = 0x1B;
+
+/// IA32_APIC_BASE: this is the bootstrap processor.
+pub const APIC_BASE_BSP: u64 = 1 << 8;
+/// IA32_APIC_BASE: the APIC is globally enabled.
+pub const APIC_BASE_ENABLE: u64 = 1 << 11;
+
+/// LVT mask bit.
+const LVT_MASKED: u32 = 1 << 16;
+/// LVT timer periodic mode.
+const LVT_TIMER_PERIODIC: u32 = 1 << 17;
+
+// ICR delivery modes (bits 10:8).
+const DM_FIXED: u32 = 0;
+const DM_LOWEST: u32 = 1;
+const DM_INIT: u32 = 5;
+const DM_STARTUP: u32 = 6;
+
+/// ICR level bit: clear on the de-assert half of a level-triggered INIT.
+const ICR_LEVEL_ASSERT: u32 = 1 << 14;
+
+/// Events for one vCPU that the engine must act on before it runs again.
+#[derive(Debug, Default)]
+pub struct ApicEvents {
+    /// INIT received: reset and wait for a startup IPI.
+    pub init: bool,
+    /// Startup IPI vector received (code runs at `vector << 12`).
+    pub sipi: Option<u8>,
+    /// Fixed-vector interrupts accepted (bit N of word N/64 = vector N).
+    pub irr: [u64; 4],
+}
+
+impl ApicEvents {
+    fn request(&mut self, vector: u8) {
+        self.irr[(vector >> 6) as usize] |= 1 << (vector & 63);
+    }
+}
+
+/// One vCPU's local APIC register state.
+#[derive(Debug)]
+pub struct LocalApic {
+    /// APIC ID (bits 31:24 of the ID register).
+    pub id: u8,
+    /// Task priority register (stored, not enforced).
+    tpr: u32,
+    /// Logical destination register.
+    ldr: u32,
+    /// Destination format register.
+    dfr: u32,
+    /// Spurious interrupt vector register (bit 8 = software enable).
+    svr: u32,
+    /// Error status register.
+    esr: u32,
+    /// Interrupt command register, low and high dwords.
+    icr: [u32; 2],
+    /// LVT entries: timer, thermal, perf, LINT0, LINT1, error.
+    lvt: [u32; 6],
+    /// Timer initial count.
+    timer_initial: u32,
+    /// Timer current count.
+    timer_current: u32,
+    /// Timer divide configuration register.
+    timer_divide: u32,
+    /// Instructions executed toward the next timer decrement.
+    timer_accum: u64,
+    /// Pending events for this vCPU.
+    pub events: ApicEvents,
+}
+
+impl LocalApic {
+    /// Create a local APIC in its power-on state.
+    pub fn new(id: u8) -> Self {
+        LocalApic {
+            id,
+            tpr: 0,
+            ldr: 0,
+            dfr: 0xFFFF_FFFF,
+            svr: 0xFF,
+            esr: 0,
+            icr: [0; 2],
+            lvt: [LVT_MASKED; 6],
+            timer_initial: 0,
+            timer_current: 0,
+            timer_divide: 0,
+            timer_accum: 0,
+            events: ApicEvents::default(),
+        }
+    }
+
+    /// Reset the registers an INIT resets (the ID survives).
+    fn init(&mut self) {
+        let events = core::mem::take(&mut self.events);
+        *self = LocalApic::new(self.id);
+        self.events = events;
+    }
+
+    /// Timer decrements once per `1 << shift` instructions.
+    fn timer_shift(&self) -> u32 {
+        // Divide configuration bits 3,1,0: 0b000 = /2 ... 0b110 = /128, 0b111 = /1.
+        let code = (self.timer_divide & 0b11) | (self.timer_divide & 0b1000) >> 1;
+        (code + 1) & 7
+    }
+
+    /// Whether this APIC accepts an IPI for `dest` in logical mode.
+    fn matches_logical(&self, dest: u8) -> bool {
+        let ldr = (self.ldr >> 24) as u8;
+        if self.dfr >> 28 == 0xF {
+            // Flat model: one bit per APIC.
+            ldr & dest != 0
+        } else {
+            // Cluster model: high nibble selects the cluster.
+            ldr >> 4 == dest >> 4 && ldr & dest & 0x0F != 0
+        }
+    }
+
+    /// Advance the timer by `instructions` executed on this vCPU.
+    pub fn tick(&mut self, instructions: u64) {
+        if self.timer_current == 0 {
+            return;
+        }
+        let shift = self.timer_shift();
+        self.timer_accum += instructions;
+        let steps = self.timer_accum >> shift;
+        self.timer_accum &= (1 << shift) - 1;
+        if steps < self.timer_current as u64 {
+            self.timer_current -= steps as u32;
+            return;
+        }
+        let lvt = self.lvt[0];
+        if lvt & LVT_MASKED == 0 {
+            self.events.request(lvt as u8);
+        }
+        self.timer_current = if lvt & LVT_TIMER_PERIODIC != 0 { self.timer_initial } else { 0 };
+    }
+
+    fn read_reg(&self, offset: u64) -> u32 {
+        match offset {
+            0x020 => (self.id as u32) << 24,
+            // Version 0x14, six LVT entries.
+            0x030 => 0x0005_0014,
+            0x080 => self.tpr,
+            0x0D0 => self.ldr,
+            0x0E0 => self.dfr,
+            0x0F0 => self.svr,
+            0x200..=0x270 => {
+                let word = ((offset - 0x200) >> 4) as usize;
+                (self.events.irr[word / 2] >> (32 * (word % 2))) as u32
+            }
+            0x280 => self.esr,
+            // Delivery status (bit 12) is always idle: IPIs are sent at once.
+            0x300 => self.icr[0] & !(1 << 12),
+            0x310 => self.icr[1],
+            0x320..=0x370 => self.lvt[((offset - 0x320) >> 4) as usize],
+            0x380 => self.timer_initial,
+            0x390 => self.timer_current,
+            0x3E0 => self.timer_divide,
+            _ => 0,
+        }
+    }
+}
+
+/// All local APICs of a VM behind the shared MMIO window.
+pub struct ApicBus {
+    /// Local APIC of each vCPU, indexed by vCPU number (= APIC ID).
+    pub apics: Vec<LocalApic>,
+    /// vCPU whose accesses the window currently serves.
+    pub current: usize,
+}
+
+impl ApicBus {
+    /// Create `count` local APICs with IDs `0..count`.
+    pub fn new(count: usize) -> Self {
+        ApicBus {
+            apics: (0..count).map(|i| LocalApic::new(i as u8)).collect(),
+            current: 0,
+        }
+    }
+
+    /// Take the events pending for vCPU `cpu`.
+    pub fn take_events(&mut self, cpu: usize) -> ApicEvents {
+        core::mem::take(&mut self.apics[cpu].events)
+    }
+
+    /// Send the IPI just written to the current APIC's ICR.
+    fn send_ipi(&mut self) {
+        let from = self.current;
+        let [low, high] = self.apics[from].icr;
+        let vector = low as u8;
+        let mode = (low >> 8) & 7;
+        let logical = low & (1 << 11) != 0;
+        let shorthand = (low >> 18) & 3;
+        let dest = (high >> 24) as u8;
+
+        if mode == DM_INIT && low & ICR_LEVEL_ASSERT == 0 {
+            // INIT level de-assert: no effect on modern APICs.
+            return;
+        }
+        let mut lowest_done = false;
+        for i in 0..self.apics.len() {
+            let hit = match shorthand {
+                1 => i == from,
+                2 => true,
+                3 => i != from,
+                _ if logical => self.apics[i].matches_logical(dest),
+                _ => dest == 0xFF || self.apics[i].id == dest,
+            };
+            if !hit {
+                continue;
+            }
+            let target = &mut self.apics[i];
+            match mode {
+                DM_FIXED => target.events.request(vector),
+                DM_LOWEST => {
+                    // No priorities to arbitrate: the first match wins.
+                    if !lowest_done {
+                        target.events.request(vector);
+                        lowest_done = true;
+                    }
+                }
+                DM_INIT => {
+                    target.init();
+                    target.events.init = true;
+                    target.events.sipi = None;
+                }
+                DM_STARTUP => target.events.sipi = Some(vector),
+                // SMI, NMI and the reserved modes are not modelled.
+                _ => {}
+            }
+        }
+    }
+}
+
+impl MmioHandler for ApicBus {
+    fn read(&mut self, offset: u64, _size: u8) -> Result<u64> {
+        Ok(self.apics[self.current].read_reg(offset & 0xFF0) as u64)
+    }
+
+    fn write(&mut self, offset: u64, _size: u8, val: u64) -> Result<()> {
+        let val = val as u32;
+        let apic = &mut self.apics[self.current];
+        match offset & 0xFF0 {
+            0x080 => apic.tpr = val & 0xFF,
+            // EOI: no in-service state to clear.
+            0x0B0 => {}
+            0x0D0 => apic.ldr = val & 0xFF00_0000,
+            0x0E0 => apic.dfr = val | 0x0FFF_FFFF,
+            0x0F0 => apic.svr = val & 0x3FF,
+            0x280 => apic.esr = 0,
+            0x300 => {
+                apic.icr[0] = val;
+                self.send_ipi();
+            }
+            0x310 => apic.icr[1] = val,
+            0x320..=0x370 => apic.lvt[((offset & 0xFF0) - 0x320) as usize >> 4] = val,
+            0x380 => {
+                apic.timer_initial = val;
+                apic.timer_current = val;
+                apic.timer_accum = 0;
+            }
+            0x3E0 => apic.timer_divide = val & 0b1011,
+            // ID, version, IRR and current count are read-only here.
+            _ => {}
+        }
+        Ok(())
+    }
+}
+
+impl Snapshot for ApicBus {
+    fn save(&self, w: &mut StateWriter) {
+        w.u32(self.apics.len() as u32);
+        for apic in &self.apics {
+            w.u8(apic.id);
+            for reg in [apic.tpr, apic.ldr, apic.dfr, apic.svr, apic.esr, apic.icr[0], apic.icr[1]] {
+                w.u32(reg);
+            }
+            for &lvt in &apic.lvt {
+                w.u32(lvt);
+            }
+            w.u32(apic.timer_initial);
+            w.u32(apic.timer_current);
+            w.u32(apic.timer_divide);
+            w.u64(apic.timer_accum);
+            w.bool(apic.events.init);
+            w.bool(apic.events.sipi.is_some());
+            w.u8(apic.events.sipi.unwrap_or(0));
+            for &word in &apic.events.irr {
+                w.u64(word);
+            }
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        if r.u32()? as usize != self.apics.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        for apic in self.apics.iter_mut() {
+            apic.id = r.u8()?;
+            for reg in [&mut apic.tpr, &mut apic.ldr, &mut apic.dfr, &mut apic.svr, &mut apic.esr] {
+                *reg = r.u32()?;
+            }
+            apic.icr = [r.u32()?, r.u32()?];
+            for lvt in apic.lvt.iter_mut() {
+                *lvt = r.u32()?;
+            }
+            apic.timer_initial = r.u32()?;
+            apic.timer_current = r.u32()?;
+            apic.timer_divide = r.u32()?;
+            apic.timer_accum = r.u64()?;
+            apic.events.init = r.bool()?;
+            let has_sipi = r.bool()?;
+            let sipi = r.u8()?;
+            apic.events.sipi = if has_sipi { Some(sipi) } else { None };
+            for word in apic.events.irr.iter_mut() {
+                *word = r.u64()?;
+            }
+        }
+        self.current = 0;
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn icr(bus: &mut ApicBus, from: usize, high: u32, low: u32) {
+        bus.current = from;
+        bus.write(0x310, 4, high as u64).unwrap();
+        bus.write(0x300, 4, low as u64).unwrap();
+    }
+
+    fn has(bus: &ApicBus, cpu: usize, vector: u8) -> bool {
+        bus.apics[cpu].events.irr[(vector >> 6) as usize] & (1 << (vector & 63)) != 0
+    }
+
+    #[test]
+    fn test_ipi_routing() {
+        let mut bus = ApicBus::new(4);
+        // Physical destination 2.
+        icr(&mut bus, 0, 2 << 24, 0x41);
+        assert!((0..4).all(|i| has(&bus, i, 0x41) == (i == 2)));
+        // All excluding self.
+        icr(&mut bus, 1, 0, 0x000C_0042);
+        assert!((0..4).all(|i| has(&bus, i, 0x42) == (i != 1)));
+        // Logical flat: APICs 1 and 3 answer to bits 0x02 and 0x08.
+        for (i, ldr) in [(1, 0x02u32), (3, 0x08)] {
+            bus.current = i;
+            bus.write(0x0D0, 4, (ldr << 24) as u64).unwrap();
+        }
+        icr(&mut bus, 0, 0x0A << 24, 0x0843);
+        assert!((0..4).all(|i| has(&bus, i, 0x43) == (i == 1 || i == 3)));
+
+        // INIT assert, then de-assert (ignored), then SIPI.
+        icr(&mut bus, 0, 0, 0x000C_4500);
+        icr(&mut bus, 0, 0, 0x000C_8500);
+        icr(&mut bus, 0, 0, 0x000C_4610);
+        let ev = bus.take_events(3);
+        assert!(ev.init);
+        assert_eq!(ev.sipi, Some(0x10));
+        assert!(!bus.take_events(0).init);
+    }
+
+    #[test]
+    fn test_timer_one_shot_and_periodic() {
+        let mut apic = LocalApic::new(0);
+        // Divide by 1, one-shot, vector 0x30.
+        apic.timer_divide = 0b1011;
+        apic.lvt[0] = 0x30;
+        apic.timer_initial = 100;
+        apic.timer_current = 100;
+        apic.tick(99);
+        assert_eq!(apic.events.irr[0], 0);
+        assert_eq!(apic.timer_current, 1);
+        apic.tick(1);
+        assert_eq!(apic.events.irr[0], 1 << 0x30);
+        assert_eq!(apic.timer_current, 0);
+
+        // Divide by 4, periodic: reloads after every 4 * 10 instructions.
+        apic.events.irr = [0; 4];
+        apic.timer_divide = 0b0001;
+        apic.lvt[0] = 0x31 | LVT_TIMER_PERIODIC;
+        apic.timer_initial = 10;
+        apic.timer_current = 10;
+        apic.tick(39);
+        assert_eq!(apic.events.irr[0], 0);
+        apic.tick(1);
+        assert_eq!(apic.events.irr[0], 1 << 0x31);
+        assert_eq!(apic.timer_current, 10);
+
+        // Masked: counts down without raising anything.
+        apic.events.irr = [0; 4];
+        apic.lvt[0] |= LVT_MASKED;
+        apic.tick(40);
+        assert_eq!(apic.events.irr[0], 0);
+    }
+}
@@ -13,6 +13,8 @@
 //! - [`svga`] — Simple VGA/SVGA framebuffer
 //! - [`e1000`] — Intel E1000 network card
 //! - [`bus`] — PCI configuration space and system bus
+//! - [`lapic`] — Local APICs of SMP guests, with IPIs and the APIC timer
+//! - [`virtio`] — Paravirtual virtio-pci block device and network card
 
 pub mod pic;
 pub mod pit;
@@ -26,3 +28,5 @@ pub mod fw_cfg;
 pub mod ide;
 pub mod debug_port;
 pub mod ioapic;
+pub mod lapic;
+pub mod virtio;
@@ -14,6 +14,7 @@
 //! | 0xA1 | Slave data |
 
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 /// State for a single 8259A PIC chip.
@@ -279,3 +280,32 @@ impl IoHandler for PicPair {
         Ok(())
     }
 }
+
+impl Snapshot for PicPair {
+    fn save(&self, w: &mut StateWriter) {
+        for pic in [&self.master, &self.slave] {
+            w.u8(pic.irr);
+            w.u8(pic.isr);
+            w.u8(pic.imr);
+            w.bytes(&pic.icw);
+            w.u8(pic.icw_step);
+            w.u8(pic.vector_offset);
+            w.bool(pic.read_isr);
+            w.bool(pic.auto_eoi);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        for pic in [&mut self.master, &mut self.slave] {
+            pic.irr = r.u8()?;
+            pic.isr = r.u8()?;
+            pic.imr = r.u8()?;
+            r.fill(&mut pic.icw)?;
+            pic.icw_step = r.u8()?;
+            pic.vector_offset = r.u8()?;
+            pic.read_isr = r.bool()?;
+            pic.auto_eoi = r.bool()?;
+        }
+        Ok(())
+    }
+}
@@ -15,6 +15,7 @@
 //! | 0x43 | Mode/command register |
 
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 /// State of a single PIT counter channel.
@@ -289,3 +290,40 @@ impl IoHandler for Pit {
         Ok(())
     }
 }
+
+impl Snapshot for Pit {
+    fn save(&self, w: &mut StateWriter) {
+        for ch in &self.channels {
+            w.u16(ch.count);
+            w.bool(ch.output);
+            w.u8(ch.mode);
+            w.u8(ch.access_mode);
+            w.bool(ch.bcd);
+            w.u16(ch.latch);
+            w.bool(ch.latched);
+            w.bool(ch.read_hi);
+            w.bool(ch.write_hi);
+            w.bool(ch.gate);
+            w.bool(ch.enabled);
+            w.u16(ch.current);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        for ch in self.channels.iter_mut() {
+            ch.count = r.u16()?;
+            ch.output = r.bool()?;
+            ch.mode = r.u8()?;
+            ch.access_mode = r.u8()?;
+            ch.bcd = r.bool()?;
+            ch.latch = r.u16()?;
+            ch.latched = r.bool()?;
+            ch.read_hi = r.bool()?;
+            ch.write_hi = r.bool()?;
+            ch.gate = r.bool()?;
+            ch.enabled = r.bool()?;
+            ch.current = r.u16()?;
+        }
+        Ok(())
+    }
+}
@@ -22,6 +22,7 @@
 
 use alloc::collections::VecDeque;
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 /// Intel 8042-compatible PS/2 controller.
@@ -379,3 +380,53 @@ impl IoHandler for Ps2Controller {
         Ok(())
     }
 }
+
+/// Encode an `Option<u8>` as a presence byte and the value.
+fn save_opt(w: &mut StateWriter, v: Option<u8>) {
+    w.bool(v.is_some());
+    w.u8(v.unwrap_or(0));
+}
+
+fn load_opt(r: &mut StateReader) -> Result<Option<u8>> {
+    let some = r.bool()?;
+    let v = r.u8()?;
+    Ok(if some { Some(v) } else { None })
+}
+
+fn load_queue(r: &mut StateReader) -> Result<VecDeque<u8>> {
+    Ok(r.blob()?.iter().copied().collect())
+}
+
+impl Snapshot for Ps2Controller {
+    fn save(&self, w: &mut StateWriter) {
+        for queue in [&self.output_buffer, &self.mouse_buffer, &self.keyboard_buffer] {
+            let (a, b) = queue.as_slices();
+            w.u32((a.len() + b.len()) as u32);
+            w.bytes(a);
+            w.bytes(b);
+        }
+        w.u8(self.status);
+        w.u8(self.command_byte);
+        save_opt(w, self.expecting_data);
+        w.bool(self.mouse_enabled);
+        w.bool(self.keyboard_enabled);
+        w.u8(self.scancode_set);
+        w.bool(self.write_to_mouse);
+        save_opt(w, self.kbd_expecting_param);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.output_buffer = load_queue(r)?;
+        self.mouse_buffer = load_queue(r)?;
+        self.keyboard_buffer = load_queue(r)?;
+        self.status = r.u8()?;
+        self.command_byte = r.u8()?;
+        self.expecting_data = load_opt(r)?;
+        self.mouse_enabled = r.bool()?;
+        self.keyboard_enabled = r.bool()?;
+        self.scancode_set = r.u8()?;
+        self.write_to_mouse = r.bool()?;
+        self.kbd_expecting_param = load_opt(r)?;
+        Ok(())
+    }
+}
@@ -24,6 +24,7 @@
 use alloc::collections::VecDeque;
 use alloc::vec::Vec;
 use crate::error::Result;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 
 /// Line Status Register bit masks.
@@ -212,3 +213,29 @@ impl IoHandler for Serial {
         Ok(())
     }
 }
+
+impl Snapshot for Serial {
+    /// The registers and unread input. Output the host has not drained yet
+    /// is not part of the machine state and is left alone.
+    fn save(&self, w: &mut StateWriter) {
+        w.bytes(&[
+            self.rbr, self.thr, self.ier, self.iir, self.fcr, self.lcr,
+            self.mcr, self.lsr, self.msr, self.scratch, self.dll, self.dlm,
+        ]);
+        let (a, b) = self.input.as_slices();
+        w.u32((a.len() + b.len()) as u32);
+        w.bytes(a);
+        w.bytes(b);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        let mut regs = [0u8; 12];
+        r.fill(&mut regs)?;
+        [
+            self.rbr, self.thr, self.ier, self.iir, self.fcr, self.lcr,
+            self.mcr, self.lsr, self.msr, self.scratch, self.dll, self.dlm,
+        ] = regs;
+        self.input = r.blob()?.iter().copied().collect::<VecDeque<u8>>();
+        Ok(())
+    }
+}
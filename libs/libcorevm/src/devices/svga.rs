@@ -27,7 +27,8 @@
 
 use alloc::vec;
 use alloc::vec::Vec;
-use crate::error::Result;
+use crate::error::{Result, VmError};
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 use crate::io::IoHandler;
 use crate::memory::mmio::MmioHandler;
 
@@ -541,3 +542,118 @@ impl MmioHandler for Svga {
         Ok(())
     }
 }
+
+/// Granularity of the sparse framebuffer encoding in snapshots.
+const FB_PAGE: usize = 4096;
+
+impl Snapshot for Svga {
+    /// Mode, registers and video memory. Only the framebuffer pages that
+    /// are not all zero are stored. The framebuffer was sized when the
+    /// adapter was created; a snapshot from a differently sized one is
+    /// rejected.
+    fn save(&self, w: &mut StateWriter) {
+        match self.mode {
+            VgaMode::Text80x25 => w.u8(0),
+            VgaMode::Graphics320x200x256 => w.u8(1),
+            VgaMode::Graphics640x480x16 => w.u8(2),
+            VgaMode::LinearFramebuffer { width, height, bpp } => {
+                w.u8(3);
+                w.u32(width);
+                w.u32(height);
+                w.u8(bpp);
+            }
+        }
+        w.u32(self.framebuffer.len() as u32);
+        let used: Vec<(usize, &[u8])> = self
+            .framebuffer
+            .chunks(FB_PAGE)
+            .enumerate()
+            .filter(|(_, page)| page.iter().any(|&b| b != 0))
+            .collect();
+        w.u32(used.len() as u32);
+        for (index, page) in used {
+            w.u32(index as u32);
+            w.blob(page);
+        }
+        w.u32(self.text_buffer.len() as u32);
+        for &cell in &self.text_buffer {
+            w.u16(cell);
+        }
+        for rgb in &self.dac_palette {
+            w.bytes(rgb);
+        }
+        w.bytes(&[self.dac_write_index, self.dac_read_index, self.dac_component]);
+        w.u8(self.crtc_index);
+        w.bytes(&self.crtc_regs);
+        w.u8(self.seq_index);
+        w.bytes(&self.seq_regs);
+        w.u8(self.gc_index);
+        w.bytes(&self.gc_regs);
+        w.u8(self.attr_index);
+        w.bytes(&self.attr_regs);
+        w.bool(self.attr_flip_flop);
+        w.u8(self.misc_output);
+        w.u32(self.width);
+        w.u32(self.height);
+        w.u8(self.bpp);
+        w.u16(self.vbe_index);
+        for &reg in &self.vbe_regs {
+            w.u16(reg);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.mode = match r.u8()? {
+            0 => VgaMode::Text80x25,
+            1 => VgaMode::Graphics320x200x256,
+            2 => VgaMode::Graphics640x480x16,
+            3 => VgaMode::LinearFramebuffer { width: r.u32()?, height: r.u32()?, bpp: r.u8()? },
+            _ => return Err(VmError::InvalidSnapshot),
+        };
+        if r.u32()? as usize != self.framebuffer.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        self.framebuffer.fill(0);
+        for _ in 0..r.u32()? {
+            let offset = r.u32()? as usize * FB_PAGE;
+            let page = r.blob()?;
+            let dest = self
+                .framebuffer
+                .get_mut(offset..offset + page.len())
+                .ok_or(VmError::InvalidSnapshot)?;
+            dest.copy_from_slice(page);
+        }
+        if r.u32()? as usize != self.text_buffer.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        for cell in self.text_buffer.iter_mut() {
+            *cell = r.u16()?;
+        }
+        for rgb in self.dac_palette.iter_mut() {
+            r.fill(rgb)?;
+        }
+        self.dac_write_index = r.u8()?;
+        self.dac_read_index = r.u8()?;
+        self.dac_component = r.u8()?;
+        self.crtc_index = r.u8()?;
+        r.fill(&mut self.crtc_regs)?;
+        self.seq_index = r.u8()?;
+        r.fill(&mut self.seq_regs)?;
+        self.gc_index = r.u8()?;
+        r.fill(&mut self.gc_regs)?;
+        self.attr_index = r.u8()?;
+        r.fill(&mut self.attr_regs)?;
+        self.attr_flip_flop = r.bool()?;
+        self.misc_output = r.u8()?;
+        self.width = r.u32()?;
+        self.height = r.u32()?;
+        self.bpp = r.u8()?;
+        self.vbe_index = r.u16()?;
+        for reg in self.vbe_regs.iter_mut() {
+            *reg = r.u16()?;
+        }
+        // The host sees every byte as new.
+        self.mmio_write_count += 1;
+        Ok(())
+    }
+}
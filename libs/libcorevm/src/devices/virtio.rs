@@ -0,0 +1,929 @@
+//! Paravirtual virtio block and network devices.
+//!
+//! Both devices use the legacy virtio-pci transport (virtio 0.9.5): an I/O
+//! BAR holding the common registers followed by the device-specific
+//! configuration, and split virtqueues that the driver places in guest RAM
+//! by page frame number. Drivers ship with Linux, the BSDs and SeaBIOS,
+//! which can boot from virtio-blk.
+//!
+//! | PCI ID | Device |
+//! |--------|--------|
+//! | 1AF4:1001 (subsystem 2) | [`VirtioBlk`] — block device |
+//! | 1AF4:1000 (subsystem 1) | [`VirtioNet`] — network card |
+//!
+//! # I/O Registers (offset from BAR0)
+//!
+//! | Offset | Size | Register |
+//! |--------|------|----------|
+//! | 0x00 | 4 | Host features (read-only) |
+//! | 0x04 | 4 | Guest features |
+//! | 0x08 | 4 | Queue PFN (selected queue) |
+//! | 0x0C | 2 | Queue size (read-only) |
+//! | 0x0E | 2 | Queue select |
+//! | 0x10 | 2 | Queue notify (doorbell) |
+//! | 0x12 | 1 | Device status (0 = reset) |
+//! | 0x13 | 1 | ISR status (cleared on read) |
+//! | 0x14+ | — | Device configuration |
+//!
+//! # Queue Processing
+//!
+//! A doorbell write processes every buffer the driver has made available on
+//! that queue since the last one, publishes them all in the used ring with a
+//! single index update, and raises at most one interrupt. A driver that
+//! queues many requests before notifying pays for one exit into the device
+//! rather than one per request. Buffers in plain RAM are read and written in
+//! place, without a bounce copy.
+//!
+//! The devices reach guest RAM through a raw pointer to the VM's
+//! [`GuestMemory`], in the same way the device proxies in `lib.rs` reach
+//! the devices. Safety: the emulator is single-threaded, and port I/O
+//! handlers run between instructions, so no other borrow of guest RAM is
+//! in use while a queue is processed.
+
+use alloc::collections::VecDeque;
+use alloc::vec;
+use alloc::vec::Vec;
+use crate::error::{Result, VmError};
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
+use crate::io::IoHandler;
+use crate::memory::{GuestMemory, MemoryBus};
+
+/// PCI vendor ID shared by all virtio devices.
+pub const VIRTIO_VENDOR_ID: u16 = 0x1AF4;
+/// Legacy PCI device ID of the network card.
+pub const VIRTIO_NET_DEVICE_ID: u16 = 0x1000;
+/// Legacy PCI device ID of the block device.
+pub const VIRTIO_BLK_DEVICE_ID: u16 = 0x1001;
+/// Size of the I/O BAR (common registers plus device configuration).
+pub const VIRTIO_BAR_SIZE: u16 = 0x40;
+
+// Register offsets.
+const REG_HOST_FEATURES: u16 = 0x00;
+const REG_GUEST_FEATURES: u16 = 0x04;
+const REG_QUEUE_PFN: u16 = 0x08;
+const REG_QUEUE_SIZE: u16 = 0x0C;
+const REG_QUEUE_SELECT: u16 = 0x0E;
+const REG_QUEUE_NOTIFY: u16 = 0x10;
+const REG_STATUS: u16 = 0x12;
+const REG_ISR: u16 = 0x13;
+const REG_CONFIG: u16 = 0x14;
+
+/// ISR bit 0: a queue has new used buffers.
+const ISR_QUEUE: u8 = 0x01;
+
+/// Entries in every virtqueue. SeaBIOS refuses queues larger than 128.
+const QUEUE_SIZE: u16 = 128;
+/// Alignment of the used ring in the legacy layout.
+const VRING_ALIGN: u64 = 4096;
+
+/// Descriptor flag: the chain continues at `next`.
+const VRING_DESC_F_NEXT: u16 = 1;
+/// Descriptor flag: the buffer is device-writable.
+const VRING_DESC_F_WRITE: u16 = 2;
+/// Available ring flag: the driver does not want interrupts.
+const VRING_AVAIL_F_NO_INTERRUPT: u16 = 1;
+
+// ── Virtqueue ──
+
+/// One descriptor of a buffer chain.
+#[derive(Debug, Clone, Copy)]
+pub struct Desc {
+    /// Guest physical address of the buffer.
+    pub addr: u64,
+    /// Buffer length in bytes.
+    pub len: u32,
+    /// Whether the device writes (rather than reads) the buffer.
+    pub write: bool,
+}
+
+/// A split virtqueue in the legacy layout: the descriptor table, then the
+/// available ring, then the used ring at the next 4 KiB boundary.
+#[derive(Debug, Clone)]
+pub struct Virtqueue {
+    /// Page frame number of the descriptor table (0 = not set up).
+    pfn: u32,
+    /// Available ring index of the next buffer to take.
+    last_avail: u16,
+    /// Used ring index the next used buffer goes to.
+    used_idx: u16,
+}
+
+impl Virtqueue {
+    fn new() -> Self {
+        Virtqueue { pfn: 0, last_avail: 0, used_idx: 0 }
+    }
+
+    fn desc_addr(&self) -> u64 {
+        (self.pfn as u64) << 12
+    }
+
+    fn avail_addr(&self) -> u64 {
+        self.desc_addr() + 16 * QUEUE_SIZE as u64
+    }
+
+    fn used_addr(&self) -> u64 {
+        // flags, idx, ring[QUEUE_SIZE], used_event
+        let avail_end = self.avail_addr() + 6 + 2 * QUEUE_SIZE as u64;
+        (avail_end + VRING_ALIGN - 1) & !(VRING_ALIGN - 1)
+    }
+
+    /// Take the next available buffer, filling `chain` with its
+    /// descriptors. Returns the head index, or `None` if the driver has
+    /// made no more buffers available. A malformed chain (bad index or a
+    /// loop) comes back empty and should be returned unused.
+    pub fn pop(&mut self, mem: &GuestMemory, chain: &mut Vec<Desc>) -> Option<u16> {
+        if self.pfn == 0 {
+            return None;
+        }
+        let avail = self.avail_addr();
+        let avail_idx = mem.read_u16(avail + 2).ok()?;
+        if avail_idx == self.last_avail {
+            return None;
+        }
+        let slot = (self.last_avail % QUEUE_SIZE) as u64;
+        let head = mem.read_u16(avail + 4 + 2 * slot).ok()?;
+        self.last_avail = self.last_avail.wrapping_add(1);
+
+        chain.clear();
+        let mut index = head;
+        loop {
+            if index >= QUEUE_SIZE || chain.len() >= QUEUE_SIZE as usize {
+                chain.clear();
+                break;
+            }
+            let d = self.desc_addr() + 16 * index as u64;
+            let (Ok(addr), Ok(len), Ok(flags), Ok(next)) = (
+                mem.read_u64(d),
+                mem.read_u32(d + 8),
+                mem.read_u16(d + 12),
+                mem.read_u16(d + 14),
+            ) else {
+                chain.clear();
+                break;
+            };
+            chain.push(Desc { addr, len, write: flags & VRING_DESC_F_WRITE != 0 });
+            if flags & VRING_DESC_F_NEXT == 0 {
+                break;
+            }
+            index = next;
+        }
+        Some(head)
+    }
+
+    /// Return the buffer at `head` to the driver, `len` bytes written to
+    /// it. Not visible to the driver until [`publish`](Self::publish).
+    pub fn push_used(&mut self, mem: &mut GuestMemory, head: u16, len: u32) {
+        let elem = self.used_addr() + 4 + 8 * (self.used_idx % QUEUE_SIZE) as u64;
+        let _ = mem.write_u32(elem, head as u32);
+        let _ = mem.write_u32(elem + 4, len);
+        self.used_idx = self.used_idx.wrapping_add(1);
+    }
+
+    /// Make the buffers pushed so far visible to the driver.
+    fn publish(&self, mem: &mut GuestMemory) {
+        let _ = mem.write_u16(self.used_addr() + 2, self.used_idx);
+    }
+
+    /// Whether the driver wants an interrupt for new used buffers.
+    fn wants_interrupt(&self, mem: &GuestMemory) -> bool {
+        mem.read_u16(self.avail_addr())
+            .map_or(true, |flags| flags & VRING_AVAIL_F_NO_INTERRUPT == 0)
+    }
+}
+
+/// The guest memory ranges of the readable (`write == false`) or writable
+/// descriptors of `chain`, dropping the first `skip` bytes.
+fn segments(chain: &[Desc], write: bool, skip: usize) -> Vec<(u64, usize)> {
+    let mut skip = skip;
+    let mut out = Vec::new();
+    for d in chain.iter().filter(|d| d.write == write) {
+        let len = d.len as usize;
+        if skip >= len {
+            skip -= len;
+            continue;
+        }
+        out.push((d.addr + skip as u64, len - skip));
+        skip = 0;
+    }
+    out
+}
+
+/// Copy the device-readable bytes of `chain` after the first `skip` into
+/// `out`, up to `out.len()`. Returns the number copied.
+fn gather(mem: &GuestMemory, chain: &[Desc], skip: usize, out: &mut [u8]) -> usize {
+    let mut done = 0;
+    for (addr, len) in segments(chain, false, skip) {
+        let n = len.min(out.len() - done);
+        if mem.read_bytes(addr, &mut out[done..done + n]).is_err() {
+            break;
+        }
+        done += n;
+        if done == out.len() {
+            break;
+        }
+    }
+    done
+}
+
+/// Copy `data` into the device-writable buffers of `chain`. Returns the
+/// number of bytes that fit.
+fn scatter(mem: &mut GuestMemory, chain: &[Desc], data: &[u8]) -> usize {
+    let mut done = 0;
+    for (addr, len) in segments(chain, true, 0) {
+        let n = len.min(data.len() - done);
+        if mem.write_bytes(addr, &data[done..done + n]).is_err() {
+            break;
+        }
+        done += n;
+        if done == data.len() {
+            break;
+        }
+    }
+    done
+}
+
+// ── Transport ──
+
+/// A device model behind the virtio-pci transport.
+pub trait VirtioDevice {
+    /// Feature bits offered to the driver.
+    fn features(&self) -> u32;
+
+    /// Number of virtqueues.
+    fn queue_count(&self) -> usize;
+
+    /// Byte `offset` of the device configuration space.
+    fn config_byte(&self, offset: usize) -> u8;
+
+    /// Process the buffers available on `queue` and push the finished ones
+    /// to its used ring. Returns whether any were pushed.
+    fn process(&mut self, queue: usize, vq: &mut Virtqueue, mem: &mut GuestMemory) -> bool;
+
+    /// Drop in-flight state when the driver resets the device.
+    fn reset(&mut self) {}
+}
+
+/// A virtio device on the legacy virtio-pci transport.
+pub struct VirtioPci<D: VirtioDevice> {
+    /// The device model.
+    pub device: D,
+    /// First port of the I/O BAR.
+    base: u16,
+    /// Guest RAM the virtqueues live in (see the module docs).
+    memory: *mut GuestMemory,
+    guest_features: u32,
+    queues: Vec<Virtqueue>,
+    queue_select: u16,
+    status: u8,
+    isr: u8,
+    /// Whether the current ISR assertion was reported by [`take_irq`](Self::take_irq).
+    irq_reported: bool,
+}
+
+impl<D: VirtioDevice> VirtioPci<D> {
+    /// Put `device` behind an I/O BAR at `base`, with its queues in
+    /// `memory`, which must outlive the device.
+    pub fn new(device: D, base: u16, memory: *mut GuestMemory) -> Self {
+        let queues = vec![Virtqueue::new(); device.queue_count()];
+        VirtioPci {
+            device,
+            base,
+            memory,
+            guest_features: 0,
+            queues,
+            queue_select: 0,
+            status: 0,
+            isr: 0,
+            irq_reported: false,
+        }
+    }
+
+    /// Whether the device is asserting its interrupt (ISR non-zero).
+    pub fn irq_raised(&self) -> bool {
+        self.isr != 0
+    }
+
+    /// Returns `true` once per interrupt assertion, so a host that polls
+    /// after every run delivers each one as a single edge.
+    pub fn take_irq(&mut self) -> bool {
+        if self.isr != 0 && !self.irq_reported {
+            self.irq_reported = true;
+            return true;
+        }
+        false
+    }
+
+    /// Process everything available on `queue` as one batch.
+    pub fn notify(&mut self, queue: usize) {
+        let Some(vq) = self.queues.get_mut(queue) else {
+            return;
+        };
+        if vq.pfn == 0 {
+            return;
+        }
+        // Safety: see the module docs.
+        let mem = unsafe { &mut *self.memory };
+        if self.device.process(queue, vq, mem) {
+            vq.publish(mem);
+            if vq.wants_interrupt(mem) {
+                self.isr |= ISR_QUEUE;
+            }
+        }
+    }
+
+    fn reset(&mut self) {
+        self.guest_features = 0;
+        for vq in self.queues.iter_mut() {
+            *vq = Virtqueue::new();
+        }
+        self.queue_select = 0;
+        self.status = 0;
+        self.isr = 0;
+        self.irq_reported = false;
+        self.device.reset();
+    }
+
+    fn read_byte(&mut self, offset: u16) -> u8 {
+        let (pfn, size) = match self.queues.get(self.queue_select as usize) {
+            Some(q) => (q.pfn, QUEUE_SIZE as u32),
+            None => (0, 0),
+        };
+        let (reg, value): (u16, u32) = match offset {
+            0x00..=0x03 => (REG_HOST_FEATURES, self.device.features()),
+            0x04..=0x07 => (REG_GUEST_FEATURES, self.guest_features),
+            0x08..=0x0B => (REG_QUEUE_PFN, pfn),
+            0x0C..=0x0D => (REG_QUEUE_SIZE, size),
+            0x0E..=0x0F => (REG_QUEUE_SELECT, self.queue_select as u32),
+            0x10..=0x11 => (REG_QUEUE_NOTIFY, 0),
+            REG_STATUS => (REG_STATUS, self.status as u32),
+            REG_ISR => {
+                let isr = self.isr;
+                self.isr = 0;
+                self.irq_reported = false;
+                return isr;
+            }
+            _ => return self.device.config_byte((offset - REG_CONFIG) as usize),
+        };
+        (value >> ((offset - reg) * 8)) as u8
+    }
+}
+
+impl<D: VirtioDevice> IoHandler for VirtioPci<D> {
+    fn read(&mut self, port: u16, size: u8) -> Result<u32> {
+        let offset = port.wrapping_sub(self.base);
+        let mut val = 0u32;
+        for i in 0..size.min(4) as u16 {
+            val |= (self.read_byte(offset + i) as u32) << (i * 8);
+        }
+        Ok(val)
+    }
+
+    fn write(&mut self, port: u16, _size: u8, val: u32) -> Result<()> {
+        match port.wrapping_sub(self.base) {
+            REG_GUEST_FEATURES => self.guest_features = val & self.device.features(),
+            REG_QUEUE_PFN => {
+                if let Some(vq) = self.queues.get_mut(self.queue_select as usize) {
+                    *vq = Virtqueue::new();
+                    vq.pfn = val;
+                }
+            }
+            REG_QUEUE_SELECT => self.queue_select = val as u16,
+            REG_QUEUE_NOTIFY => self.notify(val as u16 as usize),
+            REG_STATUS => {
+                if val as u8 == 0 {
+                    self.reset();
+                } else {
+                    self.status = val as u8;
+                }
+            }
+            _ => {}
+        }
+        Ok(())
+    }
+}
+
+// ── Block device ──
+
+/// Feature: the device supports `VIRTIO_BLK_T_FLUSH`.
+const VIRTIO_BLK_F_FLUSH: u32 = 1 << 9;
+
+const VIRTIO_BLK_T_IN: u32 = 0;
+const VIRTIO_BLK_T_OUT: u32 = 1;
+const VIRTIO_BLK_T_FLUSH: u32 = 4;
+const VIRTIO_BLK_T_GET_ID: u32 = 8;
+
+const VIRTIO_BLK_S_OK: u8 = 0;
+const VIRTIO_BLK_S_IOERR: u8 = 1;
+const VIRTIO_BLK_S_UNSUPP: u8 = 2;
+
+/// Request header: type (u32), reserved (u32), sector (u64).
+const BLK_HEADER_LEN: usize = 16;
+/// Serial number reported for `VIRTIO_BLK_T_GET_ID`.
+const BLK_ID: &[u8; 20] = b"corevm-virtio-blk\0\0\0";
+
+/// Storage behind a [`VirtioBlk`].
+#[derive(Debug)]
+pub enum BlockBacking {
+    /// No medium: every request fails.
+    None,
+    /// An image held in host memory.
+    Image(Vec<u8>),
+    /// A host file read and written through the VFS (and its page cache).
+    /// Offsets are limited to 2 GiB by the seek interface.
+    File { fd: u32, size: u64 },
+}
+
+/// Virtio block device with a single request queue.
+#[derive(Debug)]
+pub struct VirtioBlk {
+    backing: BlockBacking,
+    /// Scratch descriptor chain, kept to avoid reallocating per request.
+    chain: Vec<Desc>,
+}
+
+impl VirtioBlk {
+    /// Create a block device with no medium.
+    pub fn new() -> Self {
+        VirtioBlk { backing: BlockBacking::None, chain: Vec::new() }
+    }
+
+    /// Replace the medium (closing a previously attached file).
+    pub fn attach(&mut self, backing: BlockBacking) {
+        if let BlockBacking::File { fd, .. } = self.backing {
+            libsyscall::close(fd);
+        }
+        self.backing = backing;
+    }
+
+    /// Capacity in bytes.
+    pub fn size(&self) -> u64 {
+        match &self.backing {
+            BlockBacking::None => 0,
+            BlockBacking::Image(image) => image.len() as u64,
+            BlockBacking::File { size, .. } => *size,
+        }
+    }
+
+    fn read_at(&mut self, offset: u64, buf: &mut [u8]) -> bool {
+        match &self.backing {
+            BlockBacking::None => false,
+            BlockBacking::Image(image) => {
+                let start = offset as usize;
+                buf.copy_from_slice(&image[start..start + buf.len()]);
+                true
+            }
+            BlockBacking::File { fd, .. } => {
+                if libsyscall::lseek(*fd, offset as i32, libsyscall::SEEK_SET) != offset as u32 {
+                    return false;
+                }
+                let mut done = 0;
+                while done < buf.len() {
+                    let n = libsyscall::read(*fd, &mut buf[done..]);
+                    if n == 0 || n == u32::MAX {
+                        return false;
+                    }
+                    done += n as usize;
+                }
+                true
+            }
+        }
+    }
+
+    fn write_at(&mut self, offset: u64, buf: &[u8]) -> bool {
+        match &mut self.backing {
+            BlockBacking::None => false,
+            BlockBacking::Image(image) => {
+                let start = offset as usize;
+                image[start..start + buf.len()].copy_from_slice(buf);
+                true
+            }
+            BlockBacking::File { fd, .. } => {
+                if libsyscall::lseek(*fd, offset as i32, libsyscall::SEEK_SET) != offset as u32 {
+                    return false;
+                }
+                let mut done = 0;
+                while done < buf.len() {
+                    let n = libsyscall::write(*fd, &buf[done..]);
+                    if n == 0 || n == u32::MAX {
+                        return false;
+                    }
+                    done += n as usize;
+                }
+                true
+            }
+        }
+    }
+
+    fn flush(&mut self) -> bool {
+        match self.backing {
+            BlockBacking::None => false,
+            BlockBacking::Image(_) => true,
+            BlockBacking::File { fd, .. } => libsyscall::fsync(fd) == 0,
+        }
+    }
+
+    /// Carry out one request. Returns the number of bytes written to the
+    /// chain's device-writable buffers (data plus the status byte).
+    fn request(&mut self, mem: &mut GuestMemory, chain: &[Desc]) -> u32 {
+        let mut header = [0u8; BLK_HEADER_LEN];
+        if gather(mem, chain, 0, &mut header) < BLK_HEADER_LEN {
+            return 0;
+        }
+        // The status byte is the last byte of the last descriptor.
+        let Some(last) = chain.last().filter(|d| d.write && d.len > 0) else {
+            return 0;
+        };
+        let status_addr = last.addr + last.len as u64 - 1;
+        let kind = u32::from_le_bytes([header[0], header[1], header[2], header[3]]);
+        let sector = u64::from_le_bytes([
+            header[8], header[9], header[10], header[11],
+            header[12], header[13], header[14], header[15],
+        ]);
+
+        let mut written = 0u32;
+        let status = match kind {
+            VIRTIO_BLK_T_IN | VIRTIO_BLK_T_OUT => {
+                let inbound = kind == VIRTIO_BLK_T_IN;
+                let mut segs = if inbound {
+                    segments(chain, true, 0)
+                } else {
+                    segments(chain, false, BLK_HEADER_LEN)
+                };
+                if inbound {
+                    // Leave the status byte out of the data.
+                    if let Some(seg) = segs.last_mut() {
+                        seg.1 -= 1;
+                    }
+                }
+                let total: u64 = segs.iter().map(|s| s.1 as u64).sum();
+                let start = sector.checked_mul(512);
+                match start {
+                    Some(start) if start.saturating_add(total) <= self.size() => {
+                        let mut offset = start;
+                        let mut ok = true;
+                        for &(addr, len) in &segs {
+                            ok = if inbound {
+                                self.read_to_guest(mem, offset, addr, len)
+                            } else {
+                                self.write_from_guest(mem, offset, addr, len)
+                            };
+                            if !ok {
+                                break;
+                            }
+                            offset += len as u64;
+                        }
+                        if inbound && ok {
+                            written = total as u32;
+                        }
+                        if ok { VIRTIO_BLK_S_OK } else { VIRTIO_BLK_S_IOERR }
+                    }
+                    _ => VIRTIO_BLK_S_IOERR,
+                }
+            }
+            VIRTIO_BLK_T_FLUSH => {
+                if self.flush() { VIRTIO_BLK_S_OK } else { VIRTIO_BLK_S_IOERR }
+            }
+            VIRTIO_BLK_T_GET_ID => {
+                let mut segs = segments(chain, true, 0);
+                if let Some(seg) = segs.last_mut() {
+                    seg.1 -= 1;
+                }
+                let room: usize = segs.iter().map(|s| s.1).sum();
+                let id = &BLK_ID[..room.min(BLK_ID.len())];
+                written = scatter(mem, chain, id) as u32;
+                VIRTIO_BLK_S_OK
+            }
+            _ => VIRTIO_BLK_S_UNSUPP,
+        };
+        let _ = mem.write_u8(status_addr, status);
+        written + 1
+    }
+
+    /// Read `len` bytes at `offset` of the medium into guest RAM at `addr`.
+    fn read_to_guest(&mut self, mem: &mut GuestMemory, offset: u64, addr: u64, len: usize) -> bool {
+        if let Some(buf) = mem.dma_slice_mut(addr, len) {
+            return self.read_at(offset, buf);
+        }
+        let mut bounce = vec![0u8; len];
+        self.read_at(offset, &mut bounce) && mem.write_bytes(addr, &bounce).is_ok()
+    }
+
+    /// Write `len` bytes of guest RAM at `addr` to the medium at `offset`.
+    fn write_from_guest(&mut self, mem: &mut GuestMemory, offset: u64, addr: u64, len: usize) -> bool {
+        if let Some(buf) = mem.dma_slice(addr, len) {
+            return self.write_at(offset, buf);
+        }
+        let mut bounce = vec![0u8; len];
+        mem.read_bytes(addr, &mut bounce).is_ok() && self.write_at(offset, &bounce)
+    }
+}
+
+impl VirtioDevice for VirtioBlk {
+    fn features(&self) -> u32 {
+        VIRTIO_BLK_F_FLUSH
+    }
+
+    fn queue_count(&self) -> usize {
+        1
+    }
+
+    /// Configuration: capacity in 512-byte sectors (u64).
+    fn config_byte(&self, offset: usize) -> u8 {
+        let capacity = self.size() / 512;
+        if offset < 8 { (capacity >> (offset * 8)) as u8 } else { 0 }
+    }
+
+    fn process(&mut self, _queue: usize, vq: &mut Virtqueue, mem: &mut GuestMemory) -> bool {
+        let mut chain = core::mem::take(&mut self.chain);
+        let mut used = false;
+        while let Some(head) = vq.pop(mem, &mut chain) {
+            let written = if chain.is_empty() { 0 } else { self.request(mem, &chain) };
+            vq.push_used(mem, head, written);
+            used = true;
+        }
+        self.chain = chain;
+        used
+    }
+}
+
+impl Drop for VirtioBlk {
+    fn drop(&mut self) {
+        self.attach(BlockBacking::None);
+    }
+}
+
+// ── Network card ──
+
+/// Feature: the configuration space holds the MAC address.
+const VIRTIO_NET_F_MAC: u32 = 1 << 5;
+
+/// Header preceding every packet (`virtio_net_hdr` without mergeable
+/// receive buffers). No offloads are offered, so it is all zeroes.
+const NET_HEADER_LEN: usize = 10;
+/// Received packets held while the guest has no receive buffers posted.
+const RX_PENDING_MAX: usize = 256;
+/// Largest frame accepted for transmission.
+const TX_FRAME_MAX: usize = 65536;
+
+const RX_QUEUE: usize = 0;
+const TX_QUEUE: usize = 1;
+
+/// Virtio network card with a receive and a transmit queue.
+///
+/// Like the [`E1000`](super::e1000::E1000), the card exchanges raw
+/// Ethernet frames with the host through packet queues.
+#[derive(Debug)]
+pub struct VirtioNet {
+    /// MAC address (6 bytes).
+    pub mac_address: [u8; 6],
+    /// Packets received from the network, waiting for guest receive buffers.
+    pub rx_pending: VecDeque<Vec<u8>>,
+    /// Packets transmitted by the guest, waiting for the host to send.
+    pub tx_packets: Vec<Vec<u8>>,
+    chain: Vec<Desc>,
+}
+
+impl VirtioNet {
+    /// Create a network card with the specified MAC address.
+    pub fn new(mac: [u8; 6]) -> Self {
+        VirtioNet {
+            mac_address: mac,
+            rx_pending: VecDeque::new(),
+            tx_packets: Vec::new(),
+            chain: Vec::new(),
+        }
+    }
+
+    /// Drain and return all packets transmitted by the guest.
+    pub fn take_tx_packets(&mut self) -> Vec<Vec<u8>> {
+        core::mem::take(&mut self.tx_packets)
+    }
+
+    fn receive(&mut self, vq: &mut Virtqueue, mem: &mut GuestMemory, chain: &mut Vec<Desc>) -> bool {
+        let mut used = false;
+        while !self.rx_pending.is_empty() {
+            let Some(head) = vq.pop(mem, chain) else {
+                break;
+            };
+            let packet = self.rx_pending.pop_front().unwrap();
+            let mut frame = vec![0u8; NET_HEADER_LEN];
+            frame.extend_from_slice(&packet);
+            let written = scatter(mem, chain, &frame);
+            vq.push_used(mem, head, written as u32);
+            used = true;
+        }
+        used
+    }
+
+    fn transmit(&mut self, vq: &mut Virtqueue, mem: &mut GuestMemory, chain: &mut Vec<Desc>) -> bool {
+        let mut used = false;
+        while let Some(head) = vq.pop(mem, chain) {
+            let len: usize = segments(chain, false, NET_HEADER_LEN).iter().map(|s| s.1).sum();
+            if len > 0 && len <= TX_FRAME_MAX {
+                let mut packet = vec![0u8; len];
+                let n = gather(mem, chain, NET_HEADER_LEN, &mut packet);
+                packet.truncate(n);
+                self.tx_packets.push(packet);
+            }
+            vq.push_used(mem, head, 0);
+            used = true;
+        }
+        used
+    }
+}
+
+impl VirtioDevice for VirtioNet {
+    fn features(&self) -> u32 {
+        VIRTIO_NET_F_MAC
+    }
+
+    fn queue_count(&self) -> usize {
+        2
+    }
+
+    /// Configuration: MAC address (6 bytes).
+    fn config_byte(&self, offset: usize) -> u8 {
+        self.mac_address.get(offset).copied().unwrap_or(0)
+    }
+
+    fn process(&mut self, queue: usize, vq: &mut Virtqueue, mem: &mut GuestMemory) -> bool {
+        let mut chain = core::mem::take(&mut self.chain);
+        let used = match queue {
+            RX_QUEUE => self.receive(vq, mem, &mut chain),
+            TX_QUEUE => self.transmit(vq, mem, &mut chain),
+            _ => false,
+        };
+        self.chain = chain;
+        used
+    }
+
+    fn reset(&mut self) {
+        self.rx_pending.clear();
+    }
+}
+
+impl VirtioPci<VirtioNet> {
+    /// Enqueue a packet received from the network and deliver it (with
+    /// any earlier ones still waiting) if the guest has receive buffers
+    /// posted. Packets beyond [`RX_PENDING_MAX`] are dropped.
+    pub fn receive_packet(&mut self, data: &[u8]) {
+        if self.device.rx_pending.len() >= RX_PENDING_MAX {
+            return;
+        }
+        self.device.rx_pending.push_back(data.to_vec());
+        self.notify(RX_QUEUE);
+    }
+}
+
+impl<D: VirtioDevice> Snapshot for VirtioPci<D> {
+    /// The transport: negotiated features, status and queue positions.
+    /// The queues themselves live in guest RAM. Device backends (a disk
+    /// file, packets waiting in either direction) belong to the host,
+    /// which attaches them to the restoring VM.
+    fn save(&self, w: &mut StateWriter) {
+        w.u32(self.guest_features);
+        w.u16(self.queue_select);
+        w.u8(self.status);
+        w.u8(self.isr);
+        w.bool(self.irq_reported);
+        w.u32(self.queues.len() as u32);
+        for q in &self.queues {
+            w.u32(q.pfn);
+            w.u16(q.last_avail);
+            w.u16(q.used_idx);
+        }
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        self.guest_features = r.u32()?;
+        self.queue_select = r.u16()?;
+        self.status = r.u8()?;
+        self.isr = r.u8()?;
+        self.irq_reported = r.bool()?;
+        if r.u32()? as usize != self.queues.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        for q in self.queues.iter_mut() {
+            q.pfn = r.u32()?;
+            q.last_avail = r.u16()?;
+            q.used_idx = r.u16()?;
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const RING: u64 = 0x10000;
+    const BUFS: u64 = 0x20000;
+
+    /// Post a chain of `(addr, len, write)` buffers on the queue at `RING`.
+    fn post(mem: &mut GuestMemory, slot: u16, first: u16, bufs: &[(u64, u32, bool)]) {
+        let q = Virtqueue { pfn: (RING >> 12) as u32, last_avail: 0, used_idx: 0 };
+        for (i, &(addr, len, write)) in bufs.iter().enumerate() {
+            let d = q.desc_addr() + 16 * (first as u64 + i as u64);
+            let mut flags = if write { VRING_DESC_F_WRITE } else { 0 };
+            if i + 1 < bufs.len() {
+                flags |= VRING_DESC_F_NEXT;
+            }
+            mem.write_u64(d, addr).unwrap();
+            mem.write_u32(d + 8, len).unwrap();
+            mem.write_u16(d + 12, flags).unwrap();
+            mem.write_u16(d + 14, first + i as u16 + 1).unwrap();
+        }
+        mem.write_u16(q.avail_addr() + 4 + 2 * slot as u64, first).unwrap();
+        mem.write_u16(q.avail_addr() + 2, slot + 1).unwrap();
+    }
+
+    fn used_idx(mem: &GuestMemory) -> u16 {
+        let q = Virtqueue { pfn: (RING >> 12) as u32, last_avail: 0, used_idx: 0 };
+        mem.read_u16(q.used_addr() + 2).unwrap()
+    }
+
+    fn setup<D: VirtioDevice>(device: D, mem: &mut GuestMemory, queue: u16) -> VirtioPci<D> {
+        let mut dev = VirtioPci::new(device, 0xC000, mem as *mut GuestMemory);
+        dev.write(0xC000 + REG_QUEUE_SELECT, 2, queue as u32).unwrap();
+        dev.write(0xC000 + REG_QUEUE_PFN, 4, (RING >> 12) as u32).unwrap();
+        dev
+    }
+
+    fn blk_header(kind: u32, sector: u64) -> [u8; 16] {
+        let mut h = [0u8; 16];
+        h[..4].copy_from_slice(&kind.to_le_bytes());
+        h[8..].copy_from_slice(&sector.to_le_bytes());
+        h
+    }
+
+    #[test]
+    fn test_blk_batch_read_write() {
+        let mut mem = GuestMemory::new(1 << 20);
+        let mut image = vec![0u8; 4096];
+        image[1024..1536].fill(0xAB);
+        let mut blk = VirtioBlk::new();
+        blk.attach(BlockBacking::Image(image));
+        let mut dev = setup(blk, &mut mem, 0);
+        assert_eq!(dev.read(0xC000 + REG_CONFIG, 4).unwrap(), 8);
+
+        // Two requests, one doorbell: read sector 2, write sector 5.
+        mem.write_bytes(BUFS, &blk_header(VIRTIO_BLK_T_IN, 2)).unwrap();
+        post(&mut mem, 0, 0, &[(BUFS, 16, false), (BUFS + 0x100, 512, true), (BUFS + 0x400, 1, true)]);
+        mem.write_bytes(BUFS + 0x800, &blk_header(VIRTIO_BLK_T_OUT, 5)).unwrap();
+        mem.write_bytes(BUFS + 0x900, &[0x5Au8; 512]).unwrap();
+        mem.write_u8(BUFS + 0x401, 0xFF).unwrap();
+        post(&mut mem, 1, 3, &[(BUFS + 0x800, 16, false), (BUFS + 0x900, 512, false), (BUFS + 0x401, 1, true)]);
+        dev.write(0xC000 + REG_QUEUE_NOTIFY, 2, 0).unwrap();
+
+        assert_eq!(used_idx(&mem), 2);
+        assert_eq!(mem.read_u8(BUFS + 0x100).unwrap(), 0xAB);
+        assert_eq!(mem.read_u8(BUFS + 0x400).unwrap(), VIRTIO_BLK_S_OK);
+        assert_eq!(mem.read_u8(BUFS + 0x401).unwrap(), VIRTIO_BLK_S_OK);
+        match &dev.device.backing {
+            BlockBacking::Image(image) => assert_eq!(image[5 * 512 + 7], 0x5A),
+            _ => unreachable!(),
+        }
+        assert!(dev.take_irq());
+        assert!(!dev.take_irq());
+        assert_eq!(dev.read(0xC000 + REG_ISR, 1).unwrap(), ISR_QUEUE as u32);
+        assert!(!dev.irq_raised());
+
+        // Past the end of the medium.
+        mem.write_bytes(BUFS, &blk_header(VIRTIO_BLK_T_IN, 8)).unwrap();
+        post(&mut mem, 2, 6, &[(BUFS, 16, false), (BUFS + 0x100, 512, true), (BUFS + 0x400, 1, true)]);
+        dev.write(0xC000 + REG_QUEUE_NOTIFY, 2, 0).unwrap();
+        assert_eq!(mem.read_u8(BUFS + 0x400).unwrap(), VIRTIO_BLK_S_IOERR);
+    }
+
+    #[test]
+    fn test_net_rx_waits_for_buffers_and_tx_strips_header() {
+        let mut mem = GuestMemory::new(1 << 20);
+        let mut dev = setup(VirtioNet::new([2, 0, 0, 0, 0, 1]), &mut mem, RX_QUEUE as u16);
+        assert_eq!(dev.read(0xC000 + REG_CONFIG + 4, 2).unwrap(), 0x0100);
+
+        dev.receive_packet(&[1, 2, 3]);
+        assert_eq!(used_idx(&mem), 0);
+        post(&mut mem, 0, 0, &[(BUFS, 2048, true)]);
+        dev.write(0xC000 + REG_QUEUE_NOTIFY, 2, RX_QUEUE as u32).unwrap();
+        assert_eq!(used_idx(&mem), 1);
+        assert_eq!(mem.read_u8(BUFS + NET_HEADER_LEN as u64 + 2).unwrap(), 3);
+
+        // Transmit on a ring of its own.
+        dev.write(0xC000 + REG_QUEUE_SELECT, 2, TX_QUEUE as u32).unwrap();
+        dev.write(0xC000 + REG_QUEUE_PFN, 4, 0x30).unwrap();
+        let tx = Virtqueue { pfn: 0x30, last_avail: 0, used_idx: 0 };
+        mem.write_bytes(BUFS + 0x1000, &[0u8; NET_HEADER_LEN]).unwrap();
+        mem.write_bytes(BUFS + 0x1100, &[9, 8, 7, 6]).unwrap();
+        for (i, (addr, len, flags)) in [(BUFS + 0x1000, 10u32, VRING_DESC_F_NEXT), (BUFS + 0x1100, 4, 0)].iter().enumerate() {
+            let d = tx.desc_addr() + 16 * i as u64;
+            mem.write_u64(d, *addr).unwrap();
+            mem.write_u32(d + 8, *len).unwrap();
+            mem.write_u16(d + 12, *flags).unwrap();
+            mem.write_u16(d + 14, 1).unwrap();
+        }
+        mem.write_u16(tx.avail_addr() + 4, 0).unwrap();
+        mem.write_u16(tx.avail_addr() + 2, 1).unwrap();
+        dev.write(0xC000 + REG_QUEUE_NOTIFY, 2, TX_QUEUE as u32).unwrap();
+        assert_eq!(dev.device.take_tx_packets(), vec![vec![9, 8, 7, 6]]);
+    }
+}
@@ -6,7 +6,7 @@
 
 use crate::cpu::Cpu;
 use crate::error::{Result, VmError};
-use crate::flags::{self, OperandSize};
+use crate::flags::{self, FlagOp, OperandSize};
 use crate::instruction::DecodedInst;
 use crate::memory::{GuestMemory, Mmu};
 
@@ -26,8 +26,7 @@ pub fn exec_add(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_add(dst_val, src_val, result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Add, dst_val, src_val, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -69,8 +68,7 @@ pub fn exec_sub(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_sub(dst_val, src_val, result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Sub, dst_val, src_val, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -110,8 +108,7 @@ pub fn exec_cmp(
     let size = inst.operand_size;
     let result = dst_val.wrapping_sub(src_val) & size.mask();
 
-    let f = flags::flags_sub(dst_val, src_val, result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Sub, dst_val, src_val, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -130,8 +127,8 @@ pub fn exec_inc(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_inc(dst_val, result, size);
-    flags::update_flags_preserve_cf(&mut cpu.regs.rflags, f);
+    let cf = cpu.regs.carry() as u64;
+    cpu.regs.set_lazy_flags(FlagOp::Inc, dst_val, cf, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -150,8 +147,8 @@ pub fn exec_dec(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_dec(dst_val, result, size);
-    flags::update_flags_preserve_cf(&mut cpu.regs.rflags, f);
+    let cf = cpu.regs.carry() as u64;
+    cpu.regs.set_lazy_flags(FlagOp::Dec, dst_val, cf, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -66,7 +66,7 @@ pub fn exec_jmp_far(
 /// short 0x7x and near 0x0F 8x forms).
 pub fn exec_jcc(cpu: &mut Cpu, inst: &DecodedInst) -> Result<()> {
     let cc = (inst.opcode as u8) & 0x0F;
-    let condition_met = flags::eval_cc(cc, cpu.regs.rflags);
+    let condition_met = cpu.regs.eval_cc(cc);
 
     let next_rip = cpu.regs.rip.wrapping_add(inst.length as u64);
 
@@ -510,7 +510,7 @@ pub fn exec_iret(
 // ── Helpers ──
 
 /// Mask RIP to the appropriate width for the current CPU mode.
-fn mask_rip(cpu: &Cpu, rip: u64) -> u64 {
+pub(crate) fn mask_rip(cpu: &Cpu, rip: u64) -> u64 {
     match cpu.mode {
         Mode::RealMode => rip & 0xFFFF,
         Mode::ProtectedMode => {
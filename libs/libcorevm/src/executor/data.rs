@@ -219,7 +219,7 @@ pub fn exec_cmov(
     mmu: &Mmu,
 ) -> Result<()> {
     let cc = (inst.opcode as u8) & 0x0F;
-    let condition_met = flags::eval_cc(cc, cpu.regs.rflags);
+    let condition_met = cpu.regs.eval_cc(cc);
 
     if condition_met {
         let src = read_operand(cpu, inst, &inst.operands[1], memory, mmu)?;
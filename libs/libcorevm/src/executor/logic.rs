@@ -5,7 +5,7 @@
 
 use crate::cpu::Cpu;
 use crate::error::Result;
-use crate::flags::{self, OperandSize};
+use crate::flags::{self, FlagOp, OperandSize};
 use crate::instruction::DecodedInst;
 use crate::memory::{GuestMemory, Mmu};
 
@@ -27,8 +27,7 @@ pub fn exec_and(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_logic(result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Logic, 0, 0, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -48,8 +47,7 @@ pub fn exec_or(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_logic(result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Logic, 0, 0, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -69,8 +67,7 @@ pub fn exec_xor(
 
     write_operand(cpu, inst, &inst.operands[0], result, memory, mmu)?;
 
-    let f = flags::flags_logic(result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Logic, 0, 0, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
@@ -105,8 +102,7 @@ pub fn exec_test(
     let size = inst.operand_size;
     let result = (dst_val & src_val) & size.mask();
 
-    let f = flags::flags_logic(result, size);
-    flags::update_flags(&mut cpu.regs.rflags, f);
+    cpu.regs.set_lazy_flags(FlagOp::Logic, 0, 0, result, size);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
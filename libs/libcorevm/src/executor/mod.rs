@@ -58,6 +58,43 @@ pub fn execute(
     }
 }
 
+/// Whether `inst` can run with the flags still deferred in
+/// [`cpu.regs.lazy`](crate::registers::RegisterFile::lazy).
+///
+/// True for instructions whose handlers touch the arithmetic flags only
+/// through the lazy accessors (`set_lazy_flags`, `carry`, `eval_cc`) or not
+/// at all: the deferring ALU operations themselves, `Jcc`/`SETcc`/`CMOVcc`,
+/// and the plain moves, pushes, pops, calls and jumps between them. Every
+/// other instruction gets the flags folded into RFLAGS first.
+#[inline]
+pub fn keeps_lazy_flags(inst: &DecodedInst) -> bool {
+    let op = inst.opcode as u8;
+    let digit = inst.modrm_reg() & 7;
+    match inst.opcode_map {
+        OpcodeMap::Primary => match op {
+            // ADD, OR, AND, SUB, XOR, CMP (not ADC/SBB or the segment push/pops)
+            0x00..=0x05 | 0x08..=0x0D | 0x20..=0x25 | 0x28..=0x2D | 0x30..=0x35 | 0x38..=0x3D => true,
+            // INC/DEC r (REX prefixes in long mode, never decoded as opcodes)
+            0x40..=0x4F => true,
+            0x50..=0x5F => true,
+            0x70..=0x7F => true,
+            0x80..=0x83 => !matches!(digit, 2 | 3),
+            0x84..=0x8B | 0x8D | 0x90..=0x97 => true,
+            0xA8 | 0xA9 | 0xB0..=0xBF => true,
+            0xC2 | 0xC3 | 0xC6 | 0xC7 => true,
+            0xE2 | 0xE8 | 0xE9 | 0xEB => true,
+            // TEST, NOT
+            0xF6 | 0xF7 => matches!(digit, 0 | 2),
+            // INC, DEC, CALL near, JMP near, PUSH
+            0xFE => digit <= 1,
+            0xFF => matches!(digit, 0 | 1 | 2 | 4 | 6),
+            _ => false,
+        },
+        OpcodeMap::Secondary => matches!(op, 0x40..=0x4F | 0x80..=0x9F | 0xB6 | 0xB7 | 0xBE | 0xBF),
+        _ => false,
+    }
+}
+
 // ── Primary opcode dispatch (one-byte map) ──
 
 /// Dispatch a primary (one-byte) opcode.
@@ -613,7 +650,7 @@ fn exec_secondary(
         }
 
         // ── MOV r, CRn / MOV CRn, r ──
-        0x20 | 0x22 => system::exec_mov_cr(cpu, inst),
+        0x20 | 0x22 => system::exec_mov_cr(cpu, inst, mmu),
 
         // ── MOV r, DRn / MOV DRn, r ──
         0x21 | 0x23 => system::exec_mov_dr(cpu, inst),
@@ -851,7 +888,7 @@ pub fn write_operand(
     mmu: &Mmu,
 ) -> Result<()> {
     match operand {
-        Operand::Register(reg_op) => write_reg_operand(cpu, inst, reg_op, val),
+        Operand::Register(reg_op) => write_reg_operand(cpu, inst, reg_op, val, mmu),
         Operand::Memory(mem_op) => {
             let linear = compute_effective_address(cpu, mem_op, inst)?;
             translate_and_write(cpu, linear, mem_op.size, val, mmu, memory)
@@ -891,6 +928,7 @@ fn write_reg_operand(
     inst: &DecodedInst,
     reg: &RegOperand,
     val: u64,
+    mmu: &Mmu,
 ) -> Result<()> {
     match reg {
         RegOperand::Gpr(idx) => {
@@ -910,7 +948,10 @@ fn write_reg_operand(
             match cr {
                 0 => cpu.regs.cr0 = val,
                 2 => cpu.regs.cr2 = val,
-                3 => cpu.regs.cr3 = val,
+                3 => {
+                    cpu.regs.cr3 = val;
+                    mmu.load_cr3(val);
+                }
                 4 => cpu.regs.cr4 = val,
                 8 => cpu.regs.cr8 = val,
                 _ => return Err(VmError::UndefinedOpcode(0)),
@@ -6,7 +6,6 @@
 
 use crate::cpu::Cpu;
 use crate::error::Result;
-use crate::flags;
 use crate::instruction::DecodedInst;
 use crate::memory::{GuestMemory, Mmu};
 
@@ -40,7 +39,7 @@ pub fn exec_setcc(
     mmu: &Mmu,
 ) -> Result<()> {
     let cc = (inst.opcode as u8) & 0x0F;
-    let result = if flags::eval_cc(cc, cpu.regs.rflags) { 1u64 } else { 0u64 };
+    let result = if cpu.regs.eval_cc(cc) { 1u64 } else { 0u64 };
 
     // SETcc always writes an 8-bit result. We create a temporary byte-sized
     // instruction context for the write. The decoder should already have set
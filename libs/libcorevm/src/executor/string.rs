@@ -9,13 +9,21 @@
 //! - REPE (CMPS/SCAS): repeat while RCX != 0 AND ZF=1
 //! - REPNE (CMPS/SCAS): repeat while RCX != 0 AND ZF=0
 //! - Without REP: execute once
+//!
+//! Forward `REP MOVS` and `REP STOS` move whole runs at a time: while both
+//! sides of the next run of elements lie in one page of plain RAM, that
+//! run is translated once and copied or filled with a single host
+//! `memmove`/`memset`. The element-by-element loop handles everything
+//! else — MMIO, elements straddling a page, index wrap-around, faults,
+//! and destinations overlapping just above their source — so the guest
+//! sees the same registers, memory, and exceptions as before.
 
 use crate::cpu::Cpu;
 use crate::error::Result;
 use crate::flags::{self, OperandSize};
 use crate::instruction::{DecodedInst, RepPrefix};
 use crate::io::IoDispatch;
-use crate::memory::{GuestMemory, Mmu};
+use crate::memory::{AccessType, GuestMemory, Mmu, PAGE_SIZE};
 use crate::registers::{GprIndex, SegReg};
 
 use super::{translate_and_read, translate_and_write};
@@ -102,6 +110,103 @@ fn dst_linear(cpu: &Cpu, inst: &DecodedInst) -> u64 {
     base.wrapping_add(read_di(cpu, inst))
 }
 
+/// Number of `bytes`-sized elements from `linear` to the end of its page,
+/// capped by `count` and by `index` (the SI or DI value matching
+/// `linear`) wrapping at the instruction's address size.
+fn run_in_page(inst: &DecodedInst, linear: u64, index: u64, bytes: u64, count: u64) -> u64 {
+    let page_left = PAGE_SIZE - (linear & (PAGE_SIZE - 1));
+    let wrap_left = match inst.address_size {
+        OperandSize::Word => 0x1_0000 - (index & 0xFFFF),
+        OperandSize::Dword => 0x1_0000_0000 - (index & 0xFFFF_FFFF),
+        _ => u64::MAX,
+    };
+    (page_left.min(wrap_left) / bytes).min(count)
+}
+
+/// Move the next run of a forward `REP MOVS` with one RAM-to-RAM copy,
+/// then advance RSI, RDI, and RCX past it. Returns the number of
+/// elements moved; 0 means the next element must go through the
+/// element-by-element path (which also raises any fault).
+fn movs_run(
+    cpu: &mut Cpu,
+    inst: &DecodedInst,
+    elem: OperandSize,
+    count: u64,
+    memory: &mut GuestMemory,
+    mmu: &Mmu,
+) -> u64 {
+    let bytes = elem.bytes() as u64;
+    let s = src_linear(cpu, inst);
+    let d = dst_linear(cpu, inst);
+    let n = run_in_page(inst, s, read_si(cpu, inst), bytes, count)
+        .min(run_in_page(inst, d, read_di(cpu, inst), bytes, count));
+    if n < 2 {
+        return 0;
+    }
+    let cr3 = cpu.regs.cr3;
+    let cpl = cpu.regs.cpl;
+    let (sp, dp) = match (
+        mmu.translate_linear(s, cr3, AccessType::Read, cpl, memory),
+        mmu.translate_linear(d, cr3, AccessType::Write, cpl, memory),
+    ) {
+        (Ok(sp), Ok(dp)) => (sp, dp),
+        _ => return 0,
+    };
+    let len = n * bytes;
+    // Copying forward into a destination that starts inside the source
+    // repeats the leading bytes, which memmove would not.
+    if dp > sp && dp < sp + len {
+        return 0;
+    }
+    if !memory.copy_ram(dp, sp, len as usize) {
+        return 0;
+    }
+    write_si(cpu, inst, read_si(cpu, inst).wrapping_add(len));
+    write_di(cpu, inst, read_di(cpu, inst).wrapping_add(len));
+    write_counter(cpu, inst, count - n);
+    n
+}
+
+/// Store the next run of a forward `REP STOS` with one fill, then advance
+/// RDI and RCX past it. Returns the number of elements stored, as for
+/// [`movs_run`].
+fn stos_run(
+    cpu: &mut Cpu,
+    inst: &DecodedInst,
+    elem: OperandSize,
+    acc: u64,
+    count: u64,
+    memory: &mut GuestMemory,
+    mmu: &Mmu,
+) -> u64 {
+    let bytes = elem.bytes() as u64;
+    let d = dst_linear(cpu, inst);
+    let n = run_in_page(inst, d, read_di(cpu, inst), bytes, count);
+    if n < 2 {
+        return 0;
+    }
+    let dp = match mmu.translate_linear(d, cpu.regs.cr3, AccessType::Write, cpu.regs.cpl, memory) {
+        Ok(dp) => dp,
+        Err(_) => return 0,
+    };
+    let len = n * bytes;
+    let run = match memory.dma_slice_mut(dp, len as usize) {
+        Some(run) => run,
+        None => return 0,
+    };
+    if elem == OperandSize::Byte {
+        run.fill(acc as u8);
+    } else {
+        let pattern = acc.to_le_bytes();
+        for chunk in run.chunks_exact_mut(bytes as usize) {
+            chunk.copy_from_slice(&pattern[..bytes as usize]);
+        }
+    }
+    write_di(cpu, inst, read_di(cpu, inst).wrapping_add(len));
+    write_counter(cpu, inst, count - n);
+    n
+}
+
 /// MOVS: copy from DS:[RSI] to ES:[RDI].
 ///
 /// REP prefix: repeat while RCX != 0.
@@ -121,6 +226,9 @@ pub fn exec_movs(
             if count == 0 {
                 break;
             }
+            if delta > 0 && movs_run(cpu, inst, elem, count, memory, mmu) != 0 {
+                continue;
+            }
 
             let s = src_linear(cpu, inst);
             let d = dst_linear(cpu, inst);
@@ -253,6 +361,9 @@ pub fn exec_stos(
             if count == 0 {
                 break;
             }
+            if delta > 0 && stos_run(cpu, inst, elem, acc, count, memory, mmu) != 0 {
+                continue;
+            }
 
             let d = dst_linear(cpu, inst);
             translate_and_write(cpu, d, elem, acc, mmu, memory)?;
@@ -207,7 +207,8 @@ pub fn exec_ltr(
 /// Opcode 0F 22: MOV CRn, r64 (write control register)
 ///
 /// After writing CR0, calls `cpu.update_mode()` to recalculate the CPU mode.
-pub fn exec_mov_cr(cpu: &mut Cpu, inst: &DecodedInst) -> Result<()> {
+/// Writing CR3 flushes the non-global TLB entries.
+pub fn exec_mov_cr(cpu: &mut Cpu, inst: &DecodedInst, mmu: &Mmu) -> Result<()> {
     let op = inst.opcode as u8;
 
     if op == 0x20 {
@@ -234,7 +235,10 @@ pub fn exec_mov_cr(cpu: &mut Cpu, inst: &DecodedInst) -> Result<()> {
                 cpu.update_mode();
             }
             2 => cpu.regs.cr2 = val,
-            3 => cpu.regs.cr3 = val,
+            3 => {
+                cpu.regs.cr3 = val;
+                mmu.load_cr3(val);
+            }
             4 => cpu.regs.cr4 = val,
             8 => cpu.regs.cr8 = val,
             _ => return Err(VmError::UndefinedOpcode(op)),
@@ -341,8 +345,8 @@ pub fn exec_cpuid(cpu: &mut Cpu, inst: &DecodedInst) -> Result<()> {
         1 => {
             // Family 6, Model 0x3C, Stepping 1 -> EAX = 0x000306C1
             let eax_val = 0x0003_06C1u32;
-            // EBX: brand index=0, CLFLUSH=8, max IDs=1, APIC ID=0
-            let ebx_val = 0x0001_0800u32;
+            // EBX: brand index=0, CLFLUSH=8, max IDs=1, APIC ID
+            let ebx_val = 0x0001_0800u32 | (cpu.apic_id as u32) << 24;
             // ECX feature flags: SSE3(0), SSE4.1(19), SSE4.2(20), POPCNT(23)
             let ecx_val = (1 << 0) | (1 << 19) | (1 << 20) | (1 << 23);
             // EDX feature flags:
@@ -367,6 +371,8 @@ pub fn exec_cpuid(cpu: &mut Cpu, inst: &DecodedInst) -> Result<()> {
                 | (1 << 24)
                 | (1 << 25)
                 | (1 << 26);
+            // APIC(9) when the VM has local APICs.
+            let edx_val = if cpu.apic_cpus > 0 { edx_val | (1 << 9) } else { edx_val };
             (eax_val, ebx_val, ecx_val, edx_val)
         }
         // Leaf 0x80000000: max extended leaf
@@ -423,19 +429,16 @@ pub fn exec_rdtsc(cpu: &mut Cpu, inst: &DecodedInst) -> Result<()> {
 
 /// INVLPG: invalidate TLB entry for the page containing the memory operand.
 ///
-/// Since our emulator does not maintain a TLB, this is effectively a no-op.
-/// We still compute the address to validate the operand and advance RIP.
+/// Drops the software TLB's entries for that page, global or not.
 pub fn exec_invlpg(
     cpu: &mut Cpu,
     inst: &DecodedInst,
     _memory: &mut GuestMemory,
-    _mmu: &Mmu,
+    mmu: &Mmu,
 ) -> Result<()> {
-    // Validate that operand 0 is a memory operand (INVLPG requires it)
-    match &inst.operands[0] {
-        Operand::Memory(_) => {}
-        _ => return Err(VmError::UndefinedOpcode(inst.opcode as u8)),
-    }
+    // Operand 0 must be a memory operand (INVLPG requires it)
+    let linear = get_memory_linear(cpu, inst)?;
+    mmu.invalidate_page(linear);
 
     cpu.regs.rip += inst.length as u64;
     Ok(())
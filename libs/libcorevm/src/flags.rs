@@ -1,8 +1,16 @@
 //! RFLAGS computation helpers for x86 arithmetic, logic, and shift operations.
 //!
 //! Each flag helper is a pure function taking operands and result, returning
-//! the new flag bits. This eager-evaluation approach is simpler than lazy flags
-//! and fast enough for software emulation.
+//! the new flag bits.
+//!
+//! The most common flag writers (ADD, SUB, CMP, AND, OR, XOR, TEST, INC,
+//! DEC) do not call them directly. They record their operands and result in
+//! a [`LazyFlags`] instead, because the next instruction usually overwrites
+//! the flags unread. The record is turned into flag bits by the same helpers
+//! once something needs them. Conditions (`Jcc`, `SETcc`, `CMOVcc`) are
+//! evaluated from the record directly, and anything else that reads or
+//! writes RFLAGS folds it into the register first (see
+//! [`RegisterFile::materialize_flags`](crate::registers::RegisterFile::materialize_flags)).
 
 /// Operand size for flag computation and register access.
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -357,3 +365,186 @@ pub fn eval_cc(cc: u8, rflags: u64) -> bool {
     // Odd condition codes are the negation of even ones
     if (cc & 1) != 0 { !result } else { result }
 }
+
+// ── Lazy evaluation ──
+
+/// Operation a [`LazyFlags`] record stands for.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FlagOp {
+    /// Nothing deferred: RFLAGS holds the arithmetic flags.
+    None,
+    /// ADD (`flags_add`).
+    Add,
+    /// SUB/CMP (`flags_sub`).
+    Sub,
+    /// AND/OR/XOR/TEST (`flags_logic`).
+    Logic,
+    /// INC (`flags_inc`); CF is carried over in `op2`.
+    Inc,
+    /// DEC (`flags_dec`); CF is carried over in `op2`.
+    Dec,
+}
+
+/// Deferred arithmetic flags of the last flag-setting operation.
+#[derive(Debug, Clone, Copy)]
+pub struct LazyFlags {
+    pub op: FlagOp,
+    op1: u64,
+    op2: u64,
+    result: u64,
+    size: OperandSize,
+}
+
+impl LazyFlags {
+    pub const fn new() -> Self {
+        LazyFlags { op: FlagOp::None, op1: 0, op2: 0, result: 0, size: OperandSize::Byte }
+    }
+
+    /// Whether flags are deferred (and RFLAGS' arithmetic bits are stale).
+    #[inline]
+    pub fn is_pending(&self) -> bool {
+        self.op != FlagOp::None
+    }
+
+    /// Defer the flags of `op` on `op1`, `op2` giving `result`.
+    #[inline]
+    pub fn record(&mut self, op: FlagOp, op1: u64, op2: u64, result: u64, size: OperandSize) {
+        *self = LazyFlags { op, op1, op2, result, size };
+    }
+
+    /// The CF|PF|AF|ZF|SF|OF bits the record stands for.
+    #[inline]
+    pub fn arith_flags(&self) -> u64 {
+        let (op1, op2, result, size) = (self.op1, self.op2, self.result, self.size);
+        match self.op {
+            FlagOp::None => 0,
+            FlagOp::Add => flags_add(op1, op2, result, size),
+            FlagOp::Sub => flags_sub(op1, op2, result, size),
+            FlagOp::Logic => flags_logic(result, size),
+            FlagOp::Inc => flags_inc(op1, result, size) | (op2 & CF),
+            FlagOp::Dec => flags_dec(op1, result, size) | (op2 & CF),
+        }
+    }
+
+    /// CF as the record stands for it.
+    #[inline]
+    pub fn carry(&self) -> bool {
+        let mask = self.size.mask();
+        match self.op {
+            FlagOp::None | FlagOp::Logic => false,
+            FlagOp::Add => (self.result & mask) < (self.op1 & mask),
+            FlagOp::Sub => (self.op1 & mask) < (self.op2 & mask),
+            FlagOp::Inc | FlagOp::Dec => self.op2 & CF != 0,
+        }
+    }
+
+    /// Evaluate condition code `cc` (as `eval_cc`) against the record,
+    /// computing only the flags the common conditions need.
+    #[inline]
+    pub fn eval_cc(&self, cc: u8) -> bool {
+        let mask = self.size.mask();
+        let res = self.result & mask;
+        let result = match (cc & 0x0E, self.op) {
+            // E/Z and S don't depend on the operation.
+            (0x04, _) => res == 0,
+            (0x08, _) => res & self.size.sign_bit() != 0,
+            // Compares: B, BE, L, LE straight from the operands.
+            (0x02, FlagOp::Sub) | (0x02, FlagOp::Add) => self.carry(),
+            (0x06, FlagOp::Sub) => (self.op1 & mask) <= (self.op2 & mask),
+            (0x0C, FlagOp::Sub) => self.signed(self.op1) < self.signed(self.op2),
+            (0x0E, FlagOp::Sub) => self.signed(self.op1) <= self.signed(self.op2),
+            // Logic ops clear CF and OF.
+            (0x00, FlagOp::Logic) | (0x02, FlagOp::Logic) => false,
+            _ => return eval_cc(cc, self.arith_flags()),
+        };
+        if (cc & 1) != 0 { !result } else { result }
+    }
+
+    /// `v` truncated to the record's size and sign-extended.
+    #[inline]
+    fn signed(&self, v: u64) -> i64 {
+        let shift = 64 - self.size.bits();
+        ((v << shift) as i64) >> shift
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const SIZES: [OperandSize; 4] =
+        [OperandSize::Byte, OperandSize::Word, OperandSize::Dword, OperandSize::Qword];
+
+    /// Operand values around the size's edges plus pseudo-random ones.
+    fn operands(size: OperandSize) -> alloc::vec::Vec<u64> {
+        let mask = size.mask();
+        let sign = size.sign_bit();
+        let mut v = alloc::vec![0, 1, 2, 0x0F, 0x10, sign - 1, sign, sign + 1, mask - 1, mask];
+        let mut x = 0x9E37_79B9_7F4A_7C15u64;
+        for _ in 0..24 {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            v.push(x & mask);
+        }
+        v
+    }
+
+    /// Check a record against the eager flags the handler used to compute.
+    fn check(lazy: &LazyFlags, eager: u64) {
+        assert_eq!(lazy.arith_flags(), eager, "{:?}", lazy);
+        assert_eq!(lazy.carry(), eager & CF != 0, "{:?}", lazy);
+        for cc in 0..16 {
+            assert_eq!(lazy.eval_cc(cc), eval_cc(cc, eager), "cc {} {:?}", cc, lazy);
+        }
+    }
+
+    #[test]
+    fn test_lazy_binary_ops_match_eager() {
+        let mut lazy = LazyFlags::new();
+        for size in SIZES {
+            let mask = size.mask();
+            let ops = operands(size);
+            for &a in &ops {
+                for &b in &ops {
+                    // Immediates reach the handlers sign-extended past the size.
+                    let shift = 64 - size.bits();
+                    let b_sext = (((b << shift) as i64) >> shift) as u64;
+                    for b in [b, b_sext] {
+                        let sum = a.wrapping_add(b) & mask;
+                        lazy.record(FlagOp::Add, a, b, sum, size);
+                        check(&lazy, flags_add(a, b, sum, size));
+
+                        let diff = a.wrapping_sub(b) & mask;
+                        lazy.record(FlagOp::Sub, a, b, diff, size);
+                        check(&lazy, flags_sub(a, b, diff, size));
+
+                        for r in [a & b, a | b, a ^ b] {
+                            lazy.record(FlagOp::Logic, 0, 0, r & mask, size);
+                            check(&lazy, flags_logic(r & mask, size));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_lazy_inc_dec_match_eager() {
+        let mut lazy = LazyFlags::new();
+        for size in SIZES {
+            let mask = size.mask();
+            for a in operands(size) {
+                for cf in [0, 1] {
+                    let inc = a.wrapping_add(1) & mask;
+                    lazy.record(FlagOp::Inc, a, cf, inc, size);
+                    check(&lazy, flags_inc(a, inc, size) | cf);
+
+                    let dec = a.wrapping_sub(1) & mask;
+                    lazy.record(FlagOp::Dec, a, cf, dec, size);
+                    check(&lazy, flags_dec(a, dec, size) | cf);
+                }
+            }
+        }
+    }
+}
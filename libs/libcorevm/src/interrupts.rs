@@ -8,6 +8,7 @@
 use crate::error::{Result, VmError};
 use crate::flags;
 use crate::memory::MemoryBus;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
 
 /// IDT gate descriptor type, matching the x86 gate type field encoding.
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -262,3 +263,22 @@ impl InterruptController {
         })
     }
 }
+
+impl Snapshot for InterruptController {
+    fn save(&self, w: &mut StateWriter) {
+        for &word in &self.pending {
+            w.u64(word);
+        }
+        w.bool(self.interrupt_shadow);
+        w.bool(self.handling_exception);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        for word in self.pending.iter_mut() {
+            *word = r.u64()?;
+        }
+        self.interrupt_shadow = r.bool()?;
+        self.handling_exception = r.bool()?;
+        Ok(())
+    }
+}
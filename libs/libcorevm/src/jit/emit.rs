@@ -0,0 +1,224 @@
+//! Minimal x86-64 machine code emitter for the JIT tier.
+//!
+//! Only the handful of forms the translator needs: loads and stores
+//! relative to a base register, pushes and pops, the flag-neutral `lea`
+//! arithmetic used for bookkeeping, and rel32 jumps to labels that are
+//! patched once the code is complete.
+
+use alloc::vec::Vec;
+
+use crate::flags::OperandSize;
+
+/// Host register numbers (ModR/M encoding, REX extension in bit 3).
+pub const RAX: u8 = 0;
+pub const RCX: u8 = 1;
+pub const RDX: u8 = 2;
+pub const RBX: u8 = 3;
+pub const RBP: u8 = 5;
+pub const RSI: u8 = 6;
+pub const RDI: u8 = 7;
+pub const R8: u8 = 8;
+pub const R9: u8 = 9;
+pub const R10: u8 = 10;
+pub const R11: u8 = 11;
+pub const R12: u8 = 12;
+pub const R13: u8 = 13;
+pub const R14: u8 = 14;
+pub const R15: u8 = 15;
+
+/// A jump target, bound to a code offset by [`Emitter::bind`].
+#[derive(Clone, Copy)]
+pub struct Label(usize);
+
+/// Machine code buffer with label fixups.
+pub struct Emitter {
+    code: Vec<u8>,
+    /// Bound offset per label (`usize::MAX` while unbound).
+    labels: Vec<usize>,
+    /// (offset of a rel32 field, label it refers to).
+    fixups: Vec<(usize, Label)>,
+}
+
+impl Emitter {
+    pub fn new() -> Self {
+        Emitter { code: Vec::with_capacity(512), labels: Vec::new(), fixups: Vec::new() }
+    }
+
+    /// Patch all jumps and return the code. Every label used must be bound.
+    pub fn finish(mut self) -> Vec<u8> {
+        for &(at, label) in &self.fixups {
+            let target = self.labels[label.0];
+            debug_assert!(target != usize::MAX);
+            let rel = target as i64 - (at as i64 + 4);
+            self.code[at..at + 4].copy_from_slice(&(rel as i32).to_le_bytes());
+        }
+        self.code
+    }
+
+    pub fn pos(&self) -> usize {
+        self.code.len()
+    }
+
+    pub fn emit(&mut self, b: u8) {
+        self.code.push(b);
+    }
+
+    pub fn emit_bytes(&mut self, bytes: &[u8]) {
+        self.code.extend_from_slice(bytes);
+    }
+
+    fn emit_i32(&mut self, v: i32) {
+        self.code.extend_from_slice(&v.to_le_bytes());
+    }
+
+    // ── Labels ──
+
+    pub fn label(&mut self) -> Label {
+        self.labels.push(usize::MAX);
+        Label(self.labels.len() - 1)
+    }
+
+    pub fn bind(&mut self, label: Label) {
+        self.labels[label.0] = self.code.len();
+    }
+
+    fn rel32(&mut self, label: Label) {
+        self.fixups.push((self.code.len(), label));
+        self.emit_i32(0);
+    }
+
+    /// `jmp label`
+    pub fn jmp(&mut self, label: Label) {
+        self.emit(0xE9);
+        self.rel32(label);
+    }
+
+    /// `jcc label` for condition code `cc` (0-15, as in Jcc opcodes).
+    pub fn jcc(&mut self, cc: u8, label: Label) {
+        self.emit2(0x0F, 0x80 | cc);
+        self.rel32(label);
+    }
+
+    fn emit2(&mut self, a: u8, b: u8) {
+        self.code.push(a);
+        self.code.push(b);
+    }
+
+    // ── Prefixes ──
+
+    /// Emit the operand-size and REX prefixes for a `size` operation with
+    /// ModR/M `reg` and `rm` fields (host register numbers or digits).
+    pub fn prefixes(&mut self, size: OperandSize, reg: u8, rm: u8) {
+        if size == OperandSize::Word {
+            self.emit(0x66);
+        }
+        let rex = 0x40
+            | if size == OperandSize::Qword { 0x08 } else { 0 }
+            | if reg & 8 != 0 { 0x04 } else { 0 }
+            | if rm & 8 != 0 { 0x01 } else { 0 };
+        if rex != 0x40 {
+            self.emit(rex);
+        }
+    }
+
+    /// ModR/M byte for a register-direct operand.
+    pub fn modrm_rr(&mut self, reg: u8, rm: u8) {
+        self.emit(0xC0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    /// ModR/M + disp32 for `[base + disp]` (`base` is never RSP/R12).
+    fn modrm_mem(&mut self, reg: u8, base: u8, disp: i32) {
+        self.emit(0x80 | (reg & 7) << 3 | (base & 7));
+        self.emit_i32(disp);
+    }
+
+    // ── Moves and stack ──
+
+    /// `mov dst, qword [base + disp]`
+    pub fn load(&mut self, dst: u8, base: u8, disp: i32) {
+        self.prefixes(OperandSize::Qword, dst, base);
+        self.emit(0x8B);
+        self.modrm_mem(dst, base, disp);
+    }
+
+    /// `mov qword [base + disp], src`
+    pub fn store(&mut self, base: u8, disp: i32, src: u8) {
+        self.prefixes(OperandSize::Qword, src, base);
+        self.emit(0x89);
+        self.modrm_mem(src, base, disp);
+    }
+
+    /// `add dst, qword [base + disp]`
+    pub fn add_load(&mut self, dst: u8, base: u8, disp: i32) {
+        self.prefixes(OperandSize::Qword, dst, base);
+        self.emit(0x03);
+        self.modrm_mem(dst, base, disp);
+    }
+
+    /// `and dst, qword [base + disp]`
+    pub fn and_load(&mut self, dst: u8, base: u8, disp: i32) {
+        self.prefixes(OperandSize::Qword, dst, base);
+        self.emit(0x23);
+        self.modrm_mem(dst, base, disp);
+    }
+
+    /// `mov dst, imm32` (sign-extended to 64 bits; leaves flags alone).
+    pub fn mov_imm(&mut self, dst: u8, imm: i32) {
+        self.prefixes(OperandSize::Qword, 0, dst);
+        self.emit(0xC7);
+        self.modrm_rr(0, dst);
+        self.emit_i32(imm);
+    }
+
+    /// `lea dst, [dst + disp]` (leaves flags alone).
+    pub fn lea_add(&mut self, dst: u8, disp: i32) {
+        self.prefixes(OperandSize::Qword, dst, dst);
+        self.emit(0x8D);
+        self.modrm_mem(dst, dst, disp);
+    }
+
+    pub fn push(&mut self, r: u8) {
+        if r & 8 != 0 {
+            self.emit(0x41);
+        }
+        self.emit(0x50 | (r & 7));
+    }
+
+    pub fn pop(&mut self, r: u8) {
+        if r & 8 != 0 {
+            self.emit(0x41);
+        }
+        self.emit(0x58 | (r & 7));
+    }
+
+    /// `push qword [base + disp]`
+    pub fn push_mem(&mut self, base: u8, disp: i32) {
+        self.prefixes(OperandSize::Dword, 0, base);
+        self.emit(0xFF);
+        self.modrm_mem(6, base, disp);
+    }
+
+    /// `pop qword [base + disp]`
+    pub fn pop_mem(&mut self, base: u8, disp: i32) {
+        self.prefixes(OperandSize::Dword, 0, base);
+        self.emit(0x8F);
+        self.modrm_mem(0, base, disp);
+    }
+
+    pub fn pushfq(&mut self) {
+        self.emit(0x9C);
+    }
+
+    pub fn popfq(&mut self) {
+        self.emit(0x9D);
+    }
+
+    /// `jrcxz` over the next `skip` bytes.
+    pub fn jrcxz_skip(&mut self, skip: u8) {
+        self.emit2(0xE3, skip);
+    }
+
+    pub fn ret(&mut self) {
+        self.emit(0xC3);
+    }
+}
@@ -0,0 +1,453 @@
+//! JIT tier: hot decoded blocks translated to host x86-64 code.
+//!
+//! The interpreter (`executor/`) stays the cold tier and the reference
+//! for what every instruction does. Blocks of the [`BlockCache`] count how
+//! often they are entered; once a block is hot its decoded instructions
+//! are handed to [`compile`], which translates the longest prefix it can
+//! and leaves the rest of the block to the interpreter.
+//!
+//! Translated code only covers instructions that work on general-purpose
+//! registers: integer ALU operations, moves, `INC`/`DEC`, `NOT`/`NEG`,
+//! shifts by one, `CMOVcc`, and the direct branches (`Jcc`, `JMP`, `LOOP`)
+//! that end a block. Such an instruction cannot fault, touch memory or
+//! I/O, or change the CPU mode, so the only way out of translated code is
+//! one of its exits; anything else (memory operands, I/O, interrupts,
+//! system instructions) ends the translated prefix and runs in the
+//! interpreter. Pending interrupts are
+//! checked by the run loop between translated runs.
+//!
+//! Guest and host agree on what these instructions do, flags included, so
+//! each guest instruction is re-encoded with its registers mapped:
+//!
+//! - The guest registers a block uses are mapped to host registers from
+//!   [`POOL`], loaded from the register file on entry and stored back on
+//!   exit.
+//! - The guest's arithmetic flags are loaded into the host RFLAGS on entry
+//!   and read back on exit; between the two the host flags *are* the guest
+//!   flags, so nothing in translated code may disturb them except the
+//!   translated instructions (bookkeeping uses `lea`, `mov` and `jrcxz`).
+//! - A branch back to the start of the block (a loop) chains directly to
+//!   the top of the translated code, up to [`LOOP_BUDGET`] times per run.
+//!
+//! Exits compute RIP relative to the entry RIP, so the same code serves
+//! every CS:IP the block's physical address is reached through.
+//!
+//! Code lives in ordinary heap buffers (anyOS heap pages are executable,
+//! as for the libgl shader JIT). The tier is built on x86-64 hosts only;
+//! elsewhere [`compile`] never translates.
+
+pub mod emit;
+
+use alloc::vec::Vec;
+
+use crate::decoder::CpuMode;
+use crate::flags::{OperandSize, ARITH_MASK};
+use crate::instruction::{DecodedInst, OpcodeMap, Operand};
+use crate::registers::RegisterFile;
+use emit::*;
+
+/// Block entries before a block is translated.
+pub const HOT_THRESHOLD: u32 = 32;
+
+/// Loop iterations one run of translated code may chain before returning
+/// to the run loop.
+pub const LOOP_BUDGET: u64 = 64;
+
+/// Smallest translated prefix worth the entry and exit cost (unless it
+/// loops).
+const MIN_INSTS: usize = 3;
+
+/// Host registers guest registers are mapped to, in allocation order.
+/// RAX is scratch, RCX counts the loop budget, RDI points to the
+/// [`JitContext`] and R11 counts instructions.
+const POOL: [u8; 11] = [RBX, RBP, RSI, RDX, R8, R9, R10, R12, R13, R14, R15];
+
+/// Callee-saved host registers the code saves and restores.
+const SAVED: [u8; 6] = [RBX, RBP, R12, R13, R14, R15];
+
+/// State shared with translated code.
+#[repr(C)]
+struct JitContext {
+    /// Guest general-purpose registers.
+    gpr: *mut u64,
+    /// In: RIP at entry. Out: RIP at exit.
+    rip: u64,
+    /// In: guest RFLAGS arithmetic bits. Out: host RFLAGS at exit.
+    rflags: u64,
+    /// Mask applied to branch targets (16, 32 or 64 bits).
+    rip_mask: u64,
+    /// Loop iterations allowed.
+    budget: u64,
+    /// Out: instructions executed.
+    icount: u64,
+}
+
+const CTX_GPR: i32 = 0;
+const CTX_RIP: i32 = 8;
+const CTX_RFLAGS: i32 = 16;
+const CTX_RIP_MASK: i32 = 24;
+const CTX_BUDGET: i32 = 32;
+const CTX_ICOUNT: i32 = 40;
+
+/// Translated code for a block prefix.
+pub struct JitCode {
+    code: Vec<u8>,
+    /// Guest instructions translated (from the block start).
+    pub insts: u32,
+    /// Bytes of guest code they occupy.
+    pub bytes: u32,
+}
+
+impl JitCode {
+    /// Run the code on `regs`, whose RIP must be the block's first
+    /// instruction. Returns the number of guest instructions executed.
+    pub fn run(&self, regs: &mut RegisterFile, rip_mask: u64) -> u64 {
+        let mut ctx = JitContext {
+            gpr: regs.gpr.as_mut_ptr(),
+            rip: regs.rip,
+            rflags: (regs.rflags & ARITH_MASK) | 0x2,
+            rip_mask,
+            budget: LOOP_BUDGET,
+            icount: 0,
+        };
+        let f: extern "C" fn(*mut JitContext) = unsafe { core::mem::transmute(self.code.as_ptr()) };
+        f(&mut ctx);
+        regs.rip = ctx.rip;
+        regs.rflags = (regs.rflags & !ARITH_MASK) | (ctx.rflags & ARITH_MASK);
+        ctx.icount
+    }
+}
+
+/// A ModR/M reg field: a register, or an opcode extension digit.
+#[derive(Clone, Copy)]
+enum Field {
+    Reg(u8),
+    Digit(u8),
+}
+
+/// A translatable guest instruction.
+#[derive(Clone, Copy)]
+enum Op {
+    /// Re-encoded as is with its registers mapped.
+    Host {
+        size: OperandSize,
+        opcode: [u8; 2],
+        opcode_len: u8,
+        reg: Field,
+        rm: u8,
+        imm: u64,
+        imm_len: u8,
+    },
+    /// `MOV r, imm`.
+    MovImm { size: OperandSize, reg: u8, imm: u64 },
+    Nop,
+    /// Branches; targets are offsets from the block start.
+    Jcc { cc: u8, target: i32 },
+    Jmp { target: i32 },
+    /// `LOOP`, counting `rCX` at `size`.
+    Loop { size: OperandSize, target: i32 },
+}
+
+impl Op {
+    fn host(size: OperandSize, opcode: &[u8], reg: Field, rm: u8, imm: u64, imm_len: u8) -> Op {
+        let mut op = [0u8; 2];
+        op[..opcode.len()].copy_from_slice(opcode);
+        Op::Host { size, opcode: op, opcode_len: opcode.len() as u8, reg, rm, imm, imm_len }
+    }
+
+    /// Guest registers the instruction uses.
+    fn regs(&self) -> ([u8; 2], usize) {
+        match *self {
+            Op::Host { reg: Field::Reg(r), rm, .. } => ([r, rm], 2),
+            Op::Host { rm, .. } => ([rm, 0], 1),
+            Op::MovImm { reg, .. } => ([reg, 0], 1),
+            Op::Loop { .. } => ([1, 0], 1),
+            _ => ([0, 0], 0),
+        }
+    }
+
+    fn is_branch(&self) -> bool {
+        matches!(self, Op::Jcc { .. } | Op::Jmp { .. } | Op::Loop { .. })
+    }
+}
+
+/// Immediate width of a full-size ALU immediate.
+fn imm_len(size: OperandSize) -> u8 {
+    if size == OperandSize::Word { 2 } else { 4 }
+}
+
+/// Classify `inst`, which starts `offset` bytes into the block.
+fn classify(inst: &DecodedInst, mode: CpuMode, offset: i64) -> Option<Op> {
+    // None of the opcodes below has a byte form (those can name AH-BH,
+    // which have no fixed host counterpart).
+    let size = inst.operand_size;
+    if inst.prefix.lock {
+        return None;
+    }
+    let direct = inst.modrm.is_some() && inst.modrm_mod() == 3;
+    let digit = inst.modrm.map(|m| (m >> 3) & 7).unwrap_or(0);
+    let (reg, rm) = (inst.modrm_reg(), inst.modrm_rm());
+    let rex_b = if inst.prefix.rex_b() { 8 } else { 0 };
+    let target = || {
+        let rel = match inst.operands[0] {
+            Operand::RelativeOffset(rel) => rel,
+            _ => return None,
+        };
+        i32::try_from(offset + inst.length as i64 + rel).ok()
+    };
+
+    let op = inst.opcode;
+    match inst.opcode_map {
+        OpcodeMap::Primary => match op as u8 {
+            // (not ADC/SBB: the interpreter folds the carry into the source
+            // operand, which differs from the host's flags when that wraps)
+            0x01 | 0x03 | 0x09 | 0x0B | 0x21 | 0x23 | 0x29 | 0x2B | 0x31 | 0x33 | 0x39 | 0x3B
+            | 0x85 | 0x87 | 0x89 | 0x8B if direct => {
+                Some(Op::host(size, &[op as u8], Field::Reg(reg), rm, 0, 0))
+            }
+            // ALU eAX, imm → ALU r/m, imm on the mapped eAX
+            b @ (0x05 | 0x0D | 0x25 | 0x2D | 0x35 | 0x3D) => Some(Op::host(
+                size, &[0x81], Field::Digit(b >> 3), 0, inst.immediate, imm_len(size),
+            )),
+            0xA9 => Some(Op::host(size, &[0xF7], Field::Digit(0), 0, inst.immediate, imm_len(size))),
+            0x81 if direct && !matches!(digit, 2 | 3) => Some(Op::host(size, &[0x81], Field::Digit(digit), rm, inst.immediate, imm_len(size))),
+            0x83 if direct && !matches!(digit, 2 | 3) => Some(Op::host(size, &[0x83], Field::Digit(digit), rm, inst.immediate, 1)),
+            // SHL/SHR/SAR by one (larger counts leave OF undefined, and the
+            // host and the interpreter disagree on it)
+            0xC1 if direct && matches!(digit, 4 | 5 | 7) && inst.immediate & 0x1F == 1 => {
+                Some(Op::host(size, &[0xD1], Field::Digit(digit), rm, 0, 0))
+            }
+            0xD1 if direct && matches!(digit, 4 | 5 | 7) => {
+                Some(Op::host(size, &[0xD1], Field::Digit(digit), rm, 0, 0))
+            }
+            // TEST imm / NOT / NEG
+            0xF7 if direct && digit == 0 => {
+                Some(Op::host(size, &[0xF7], Field::Digit(0), rm, inst.immediate, imm_len(size)))
+            }
+            0xF7 if direct && matches!(digit, 2 | 3) => Some(Op::host(size, &[0xF7], Field::Digit(digit), rm, 0, 0)),
+            // INC/DEC r/m
+            0xFF if direct && digit <= 1 => Some(Op::host(size, &[0xFF], Field::Digit(digit), rm, 0, 0)),
+            // INC/DEC r (REX prefixes in long mode, so re-encoded as FF /0, /1)
+            b @ 0x40..=0x4F if mode != CpuMode::Long64 => {
+                Some(Op::host(size, &[0xFF], Field::Digit((b >> 3) & 1), b & 7, 0, 0))
+            }
+            // (the interpreter runs 0x90 as NOP even with REX.B)
+            0x90 => Some(Op::Nop),
+            b @ 0x91..=0x97 => Some(Op::host(size, &[0x87], Field::Reg(0), (b & 7) | rex_b, 0, 0)),
+            b @ 0xB8..=0xBF => Some(Op::MovImm { size, reg: (b & 7) | rex_b, imm: inst.immediate }),
+            b @ 0x70..=0x7F => Some(Op::Jcc { cc: b & 0xF, target: target()? }),
+            0xE9 | 0xEB => Some(Op::Jmp { target: target()? }),
+            0xE2 => Some(Op::Loop { size: inst.address_size, target: target()? }),
+            _ => None,
+        },
+        OpcodeMap::Secondary => match op {
+            // CMOVcc (the interpreter does not clear the upper half of a
+            // 64-bit register when a 32-bit move is not taken)
+            0x0F40..=0x0F4F if direct && !(mode == CpuMode::Long64 && size == OperandSize::Dword) => {
+                Some(Op::host(size, &[0x0F, op as u8], Field::Reg(reg), rm, 0, 0))
+            }
+            0x0F80..=0x0F8F => Some(Op::Jcc { cc: (op & 0xF) as u8, target: target()? }),
+            _ => None,
+        },
+        _ => None,
+    }
+}
+
+/// Exits of the code being emitted, bound after the body.
+struct Exits {
+    /// (label, RIP delta, mask the RIP, instructions executed)
+    exits: Vec<(Label, i32, bool, u32)>,
+    /// (label, instructions executed per iteration)
+    loopbacks: Vec<(Label, u32)>,
+}
+
+impl Exits {
+    fn exit(&mut self, e: &mut Emitter, delta: i32, mask: bool, n: u32) -> Label {
+        let label = e.label();
+        self.exits.push((label, delta, mask, n));
+        label
+    }
+
+    /// Label for a branch to `target` after `n` instructions.
+    fn branch(&mut self, e: &mut Emitter, target: i32, n: u32) -> Label {
+        if target != 0 {
+            return self.exit(e, target, true, n);
+        }
+        let label = e.label();
+        self.loopbacks.push((label, n));
+        label
+    }
+}
+
+/// Leave with RIP advanced by `delta` after `n` more instructions, through
+/// the `epilogue` that masks the RIP or not.
+fn exit_stub(e: &mut Emitter, delta: i32, n: u32, epilogue: Label) {
+    e.pushfq();
+    e.mov_imm(RAX, delta);
+    if n != 0 {
+        e.lea_add(R11, n as i32);
+    }
+    e.jmp(epilogue);
+}
+
+/// Translate the longest translatable prefix of a block decoded in `mode`.
+/// Returns `None` if it is too short to be worth running as host code.
+pub fn compile(insts: &[DecodedInst], mode: CpuMode) -> Option<JitCode> {
+    if !cfg!(target_arch = "x86_64") {
+        return None;
+    }
+
+    // Pass 1: the prefix, its guest register mapping and instruction ends.
+    let mut ops: Vec<(Op, i32)> = Vec::new();
+    let mut map = [u8::MAX; 16];
+    let mut mapped: Vec<u8> = Vec::new();
+    let mut offset: i64 = 0;
+    for inst in insts {
+        let op = match classify(inst, mode, offset) {
+            Some(op) => op,
+            None => break,
+        };
+        let (regs, n) = op.regs();
+        let new = regs[..n].iter().filter(|&&g| map[g as usize] == u8::MAX).count();
+        if mapped.len() + new > POOL.len() {
+            break;
+        }
+        for &g in &regs[..n] {
+            if map[g as usize] == u8::MAX {
+                map[g as usize] = POOL[mapped.len()];
+                mapped.push(g);
+            }
+        }
+        offset += inst.length as i64;
+        ops.push((op, offset as i32));
+        if op.is_branch() {
+            break;
+        }
+    }
+    let loops = ops.iter().any(|(op, _)| match *op {
+        Op::Jcc { target, .. } | Op::Jmp { target } | Op::Loop { target, .. } => target == 0,
+        _ => false,
+    });
+    if ops.len() < MIN_INSTS && !loops {
+        return None;
+    }
+
+    // Pass 2: emit.
+    let mut e = Emitter::new();
+    for &r in &SAVED {
+        e.push(r);
+    }
+    e.load(RAX, RDI, CTX_GPR);
+    for &g in &mapped {
+        e.load(map[g as usize], RAX, g as i32 * 8);
+    }
+    e.load(RCX, RDI, CTX_BUDGET);
+    e.emit_bytes(&[0x45, 0x31, 0xDB]); // xor r11d, r11d
+    e.push_mem(RDI, CTX_RFLAGS);
+    e.popfq();
+    let top = e.label();
+    e.bind(top);
+
+    let mut exits = Exits { exits: Vec::new(), loopbacks: Vec::new() };
+    let mut fell_through = true;
+    for (i, &(op, end)) in ops.iter().enumerate() {
+        let n = i as u32 + 1;
+        match op {
+            Op::Host { size, opcode, opcode_len, reg, rm, imm, imm_len } => {
+                let hreg = match reg {
+                    Field::Reg(g) => map[g as usize],
+                    Field::Digit(d) => d,
+                };
+                let hrm = map[rm as usize];
+                e.prefixes(size, hreg, hrm);
+                e.emit_bytes(&opcode[..opcode_len as usize]);
+                e.modrm_rr(hreg, hrm);
+                e.emit_bytes(&imm.to_le_bytes()[..imm_len as usize]);
+            }
+            Op::MovImm { size, reg, imm } => {
+                let h = map[reg as usize];
+                e.prefixes(size, 0, h);
+                e.emit(0xB8 | (h & 7));
+                e.emit_bytes(&imm.to_le_bytes()[..size.bytes() as usize]);
+            }
+            Op::Nop => {}
+            Op::Jcc { cc, target } => {
+                let taken = exits.branch(&mut e, target, n);
+                e.jcc(cc, taken);
+                let fall = exits.exit(&mut e, end, false, n);
+                e.jmp(fall);
+                fell_through = false;
+            }
+            Op::Jmp { target } => {
+                let taken = exits.branch(&mut e, target, n);
+                e.jmp(taken);
+                fell_through = false;
+            }
+            Op::Loop { size, target } => {
+                // DEC rCX sets ZF for the test; the guest flags are kept
+                // around it on the host stack.
+                let hc = map[1];
+                e.pushfq();
+                e.prefixes(size, 1, hc);
+                e.emit(0xFF);
+                e.modrm_rr(1, hc);
+                let restore = e.label();
+                e.jcc(0x5, restore); // jnz
+                e.popfq();
+                let fall = exits.exit(&mut e, end, false, n);
+                e.jmp(fall);
+                e.bind(restore);
+                e.popfq();
+                let taken = exits.branch(&mut e, target, n);
+                e.jmp(taken);
+                fell_through = false;
+            }
+        }
+    }
+
+    let masked = e.label();
+    let plain = e.label();
+    if fell_through {
+        let &(_, end) = ops.last()?;
+        exit_stub(&mut e, end, ops.len() as u32, plain);
+    }
+    for (label, n) in exits.loopbacks {
+        // Count the iteration; chain to the top while budget is left.
+        e.bind(label);
+        e.lea_add(R11, n as i32);
+        e.lea_add(RCX, -1);
+        e.jrcxz_skip(5); // over the jmp rel32
+        e.jmp(top);
+        exit_stub(&mut e, 0, 0, masked);
+    }
+    for (label, delta, mask, n) in exits.exits {
+        e.bind(label);
+        exit_stub(&mut e, delta, n, if mask { masked } else { plain });
+    }
+
+    // Shared epilogue: RFLAGS was pushed and RAX holds the RIP delta.
+    let tail = e.label();
+    e.bind(masked);
+    e.pop_mem(RDI, CTX_RFLAGS);
+    e.add_load(RAX, RDI, CTX_RIP);
+    e.and_load(RAX, RDI, CTX_RIP_MASK);
+    e.jmp(tail);
+    e.bind(plain);
+    e.pop_mem(RDI, CTX_RFLAGS);
+    e.add_load(RAX, RDI, CTX_RIP);
+    e.bind(tail);
+    e.store(RDI, CTX_RIP, RAX);
+    e.store(RDI, CTX_ICOUNT, R11);
+    e.load(RCX, RDI, CTX_GPR);
+    for &g in &mapped {
+        e.store(RCX, g as i32 * 8, map[g as usize]);
+    }
+    for &r in SAVED.iter().rev() {
+        e.pop(r);
+    }
+    e.ret();
+
+    let insts = ops.len() as u32;
+    let bytes = ops.last()?.1 as u32;
+    Some(JitCode { code: e.finish(), insts, bytes })
+}
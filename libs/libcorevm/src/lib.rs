@@ -12,10 +12,14 @@
 //!
 //! The library is organized into these layers:
 //! - **Decoder** (`decoder.rs`) — variable-length x86 instruction decoding
+//! - **Block cache** (`block_cache.rs`) — reuse of decoded instruction blocks
+//! - **JIT** (`jit/`) — hot blocks translated to host x86-64 code
 //! - **Executor** (`executor/`) — instruction execution grouped by category
 //! - **Memory** (`memory/`) — guest RAM, segmentation, paging, MMIO
 //! - **Devices** (`devices/`) — emulated hardware (SVGA, PS/2, E1000, etc.)
 //! - **CPU** (`cpu.rs`) — ties everything together in the fetch-decode-execute loop
+//! - **SMP** (`smp.rs`) — extra vCPUs interleaved with the bootstrap processor
+//! - **Snapshots** (`snapshot.rs`) — saved machine state, restored copy-on-write
 //!
 //! # C ABI
 //!
@@ -34,14 +38,18 @@ pub mod flags;
 pub mod registers;
 pub mod instruction;
 pub mod decoder;
+pub mod block_cache;
+pub mod jit;
 pub mod memory;
 pub mod cpu;
+pub mod smp;
 pub mod executor;
 pub mod interrupts;
 pub mod io;
 pub mod fpu_state;
 pub mod sse_state;
 pub mod devices;
+pub mod snapshot;
 
 /// Syscall wrappers for the allocator, panic handler, and debug output.
 mod syscall {
@@ -78,6 +86,7 @@ pub use registers::{RegisterFile, SegReg};
 pub use flags::OperandSize;
 
 use alloc::boxed::Box;
+use alloc::string::String;
 use alloc::vec::Vec;
 use core::ptr;
 
@@ -98,6 +107,8 @@ pub struct VmEngine {
     pub interrupts: InterruptController,
     /// Port I/O dispatcher (maps port ranges to device handlers).
     pub io: IoDispatch,
+    /// Application processors and local APICs (`None` for a uniprocessor VM).
+    pub smp: Option<smp::Smp>,
 }
 
 impl VmEngine {
@@ -111,9 +122,34 @@ impl VmEngine {
             mmu: Mmu::new(),
             interrupts: InterruptController::new(),
             io: IoDispatch::new(),
+            smp: None,
         }
     }
 
+    /// Give the VM `count` vCPUs (at most [`smp::MAX_VCPUS`]).
+    ///
+    /// Adds the local APICs at `0xFEE00000` and the application processors,
+    /// which wait for a startup IPI from the guest. Has no effect for
+    /// `count < 2` or if the VM is already SMP.
+    pub fn enable_smp(&mut self, count: usize) {
+        if count < 2 || self.smp.is_some() {
+            return;
+        }
+        let smp = smp::Smp::new(count.min(smp::MAX_VCPUS), &mut self.cpu);
+        self.memory.add_mmio(
+            devices::lapic::LAPIC_BASE,
+            devices::lapic::LAPIC_SIZE,
+            Box::new(MmioProxy { ptr: smp.apic_ptr() }),
+        );
+        self.memory.share_code_writes();
+        self.smp = Some(smp);
+    }
+
+    /// Number of vCPUs.
+    pub fn vcpu_count(&self) -> usize {
+        self.smp.as_ref().map_or(1, |s| s.aps.len() + 1)
+    }
+
     /// Load raw binary data at a guest physical address.
     pub fn load_binary(&mut self, addr: usize, data: &[u8]) {
         self.memory.load_at(addr, data);
@@ -127,14 +163,27 @@ impl VmEngine {
     /// Run the VM for up to `max_instructions` (0 = unlimited).
     ///
     /// Returns the reason the VM stopped executing.
+    ///
+    /// In an SMP VM the limit counts bootstrap-processor instructions and the
+    /// application processors run interleaved with it (see [`smp::Smp::run`]).
     pub fn run(&mut self, max_instructions: u64) -> ExitReason {
-        self.cpu.run(
-            &mut self.memory,
-            &mut self.mmu,
-            &mut self.interrupts,
-            &mut self.io,
-            max_instructions,
-        )
+        match self.smp.as_mut() {
+            Some(smp) => smp.run(
+                &mut self.cpu,
+                &mut self.memory,
+                &mut self.mmu,
+                &mut self.interrupts,
+                &mut self.io,
+                max_instructions,
+            ),
+            None => self.cpu.run(
+                &mut self.memory,
+                &mut self.mmu,
+                &mut self.interrupts,
+                &mut self.io,
+                max_instructions,
+            ),
+        }
     }
 
     /// Request the VM to stop at the next instruction boundary.
@@ -150,6 +199,9 @@ impl VmEngine {
         self.cpu.reset();
         self.mmu = Mmu::new();
         self.interrupts = InterruptController::new();
+        if let Some(smp) = self.smp.as_mut() {
+            smp.reset(&mut self.cpu);
+        }
         // Memory and I/O handlers are preserved across reset
     }
 
@@ -250,14 +302,25 @@ struct VmInstance {
     // Null when the corresponding device has not been set up.
     pic_ptr: *mut devices::pic::PicPair,
     pit_ptr: *mut devices::pit::Pit,
+    cmos_ptr: *mut devices::cmos::Cmos,
     ps2_ptr: *mut devices::ps2::Ps2Controller,
     serial_ptr: *mut devices::serial::Serial,
     svga_ptr: *mut devices::svga::Svga,
     e1000_ptr: *mut devices::e1000::E1000,
     bus_ptr: *mut devices::bus::PciBus,
+    ioapic_ptr: *mut devices::ioapic::IoApic,
     ide_ptr: *mut devices::ide::Ide,
     fw_cfg_ptr: *mut devices::fw_cfg::FwCfg,
     debug_port_ptr: *mut devices::debug_port::DebugPort,
+    virtio_blk_ptr: *mut devices::virtio::VirtioPci<devices::virtio::VirtioBlk>,
+    virtio_net_ptr: *mut devices::virtio::VirtioPci<devices::virtio::VirtioNet>,
+
+    /// Full snapshot file guest RAM is mapped from after a restore.
+    ram_backing: Option<String>,
+    /// Snapshot files the VM's state was last saved to or restored from,
+    /// oldest (a full snapshot) first; the last one is the parent of the
+    /// next incremental snapshot.
+    snapshot_chain: Vec<String>,
 }
 
 impl Drop for VmInstance {
@@ -267,14 +330,18 @@ impl Drop for VmInstance {
         unsafe {
             if !self.pic_ptr.is_null() { let _ = Box::from_raw(self.pic_ptr); }
             if !self.pit_ptr.is_null() { let _ = Box::from_raw(self.pit_ptr); }
+            if !self.cmos_ptr.is_null() { let _ = Box::from_raw(self.cmos_ptr); }
             if !self.ps2_ptr.is_null() { let _ = Box::from_raw(self.ps2_ptr); }
             if !self.serial_ptr.is_null() { let _ = Box::from_raw(self.serial_ptr); }
             if !self.svga_ptr.is_null() { let _ = Box::from_raw(self.svga_ptr); }
             if !self.e1000_ptr.is_null() { let _ = Box::from_raw(self.e1000_ptr); }
             if !self.bus_ptr.is_null() { let _ = Box::from_raw(self.bus_ptr); }
+            if !self.ioapic_ptr.is_null() { let _ = Box::from_raw(self.ioapic_ptr); }
             if !self.ide_ptr.is_null() { let _ = Box::from_raw(self.ide_ptr); }
             if !self.fw_cfg_ptr.is_null() { let _ = Box::from_raw(self.fw_cfg_ptr); }
             if !self.debug_port_ptr.is_null() { let _ = Box::from_raw(self.debug_port_ptr); }
+            if !self.virtio_blk_ptr.is_null() { let _ = Box::from_raw(self.virtio_blk_ptr); }
+            if !self.virtio_net_ptr.is_null() { let _ = Box::from_raw(self.virtio_net_ptr); }
         }
     }
 }
@@ -308,14 +375,20 @@ pub extern "C" fn corevm_create(ram_size_mb: u32) -> u64 {
         last_error_rip: 0,
         pic_ptr: ptr::null_mut(),
         pit_ptr: ptr::null_mut(),
+        cmos_ptr: ptr::null_mut(),
         ps2_ptr: ptr::null_mut(),
         serial_ptr: ptr::null_mut(),
         svga_ptr: ptr::null_mut(),
         e1000_ptr: ptr::null_mut(),
         bus_ptr: ptr::null_mut(),
+        ioapic_ptr: ptr::null_mut(),
         ide_ptr: ptr::null_mut(),
         fw_cfg_ptr: ptr::null_mut(),
         debug_port_ptr: ptr::null_mut(),
+        virtio_blk_ptr: ptr::null_mut(),
+        virtio_net_ptr: ptr::null_mut(),
+        ram_backing: None,
+        snapshot_chain: Vec::new(),
     });
     let h = Box::into_raw(instance) as u64;
     vm_log!("VM created (handle=0x{:X})", h);
@@ -429,7 +502,8 @@ pub extern "C" fn corevm_get_cr(handle: u64, n: u8) -> u64 {
 /// Write a control register (CR0, CR2, CR3, CR4, CR8).
 ///
 /// `n` selects the register: 0=CR0, 2=CR2, 3=CR3, 4=CR4, 8=CR8.
-/// After writing CR0 or CR4, the CPU mode is automatically updated.
+/// After writing CR0 or CR4, the CPU mode is automatically updated;
+/// writing CR3 flushes the whole guest TLB.
 /// Writes to unrecognized register numbers are silently ignored.
 #[no_mangle]
 pub extern "C" fn corevm_set_cr(handle: u64, n: u8, val: u64) {
@@ -440,7 +514,10 @@ pub extern "C" fn corevm_set_cr(handle: u64, n: u8, val: u64) {
             vm.engine.cpu.update_mode();
         }
         2 => vm.engine.cpu.regs.cr2 = val,
-        3 => vm.engine.cpu.regs.cr3 = val,
+        3 => {
+            vm.engine.cpu.regs.cr3 = val;
+            vm.engine.mmu.flush_tlb();
+        }
         4 => {
             vm.engine.cpu.regs.cr4 = val;
             vm.engine.cpu.update_mode();
@@ -570,6 +647,63 @@ pub extern "C" fn corevm_get_instruction_count(handle: u64) -> u64 {
     vm.engine.instruction_count()
 }
 
+/// Enable (`enabled != 0`) or disable the JIT tier.
+///
+/// With the JIT disabled every instruction runs in the interpreter, the
+/// reference the translated code must agree with. Translations made so far
+/// are kept and used again once it is re-enabled.
+#[no_mangle]
+pub extern "C" fn corevm_set_jit(handle: u64, enabled: u32) {
+    let vm = unsafe { vm_from_handle(handle) };
+    vm.engine.cpu.icache.jit_enabled = enabled != 0 && cfg!(target_arch = "x86_64");
+}
+
+/// Get JIT tier statistics.
+///
+/// Writes the number of blocks translated and the number of instructions
+/// executed by translated code through the output pointers (null pointers
+/// are skipped). The counters are cumulative since the VM was created.
+#[no_mangle]
+pub extern "C" fn corevm_jit_stats(handle: u64, translations: *mut u64, instructions: *mut u64) {
+    let vm = unsafe { vm_from_handle(handle) };
+    let stats = vm.engine.cpu.icache.stats;
+    if !translations.is_null() {
+        unsafe { *translations = stats.translations };
+    }
+    if !instructions.is_null() {
+        unsafe { *instructions = stats.jit_instructions };
+    }
+}
+
+/// Get decoded-block cache statistics.
+///
+/// Writes the instruction fetches, the fetches that needed a decode, the
+/// blocks dropped because their code was written and the live block count
+/// through the output pointers (null pointers are skipped). The counters
+/// are cumulative since the VM was created.
+#[no_mangle]
+pub extern "C" fn corevm_icache_stats(
+    handle: u64,
+    fetches: *mut u64,
+    decodes: *mut u64,
+    invalidations: *mut u64,
+    blocks: *mut u64,
+) {
+    let vm = unsafe { vm_from_handle(handle) };
+    let cache = &vm.engine.cpu.icache;
+    let stats = cache.stats;
+    for (out, val) in [
+        (fetches, stats.fetches),
+        (decodes, stats.decodes),
+        (invalidations, stats.invalidations),
+        (blocks, cache.block_count() as u64),
+    ] {
+        if !out.is_null() {
+            unsafe { *out = val };
+        }
+    }
+}
+
 /// Get the RIP at the time of the last error.
 ///
 /// Returns 0 if no error has occurred since the last reset.
@@ -777,8 +911,9 @@ pub extern "C" fn corevm_setup_standard_devices(handle: u64) {
 
     // CMOS — RTC and NVRAM. Pass actual guest RAM size.
     let ram_bytes = vm.engine.memory.ram().size();
-    let cmos = Box::new(devices::cmos::Cmos::new(ram_bytes));
-    vm.engine.io.register(0x70, 2, cmos);
+    let cmos = Box::into_raw(Box::new(devices::cmos::Cmos::new(ram_bytes)));
+    vm.cmos_ptr = cmos;
+    vm.engine.io.register(0x70, 2, Box::new(IoProxy { ptr: cmos }));
 
     // PS/2 — keyboard and mouse controller.
     let ps2 = Box::into_raw(Box::new(devices::ps2::Ps2Controller::new()));
@@ -867,6 +1002,7 @@ pub extern "C" fn corevm_setup_standard_devices(handle: u64) {
 
     // IO-APIC at standard MMIO address.
     let ioapic = Box::into_raw(Box::new(devices::ioapic::IoApic::new()));
+    vm.ioapic_ptr = ioapic;
     vm.engine.memory.add_mmio(0xFEC00000, 0x1000, Box::new(MmioProxy { ptr: ioapic }));
 
     // fw_cfg — QEMU firmware configuration interface.
@@ -889,6 +1025,25 @@ pub extern "C" fn corevm_setup_standard_devices(handle: u64) {
     vm_log!("PCI bus: 3 devices (host bridge 0:0.0, ISA bridge 0:1.0, VGA 0:2.0)");
 }
 
+/// Give the VM `count` vCPUs (clamped to 1-16).
+///
+/// Adds a local APIC per vCPU at 0xFEE00000 and the application processors,
+/// which sit in wait-for-SIPI state until the guest starts them. The count
+/// is also reported through fw_cfg, so SeaBIOS brings the APs up and lists
+/// them in its MP table and ACPI MADT. Call after
+/// [`corevm_setup_standard_devices`] and before the VM first runs; a count
+/// of 1 leaves the VM uniprocessor.
+#[no_mangle]
+pub extern "C" fn corevm_setup_smp(handle: u64, count: u32) {
+    let vm = unsafe { vm_from_handle(handle) };
+    let count = (count as usize).clamp(1, smp::MAX_VCPUS);
+    vm_log!("setting up {} vCPUs", count);
+    vm.engine.enable_smp(count);
+    if !vm.fw_cfg_ptr.is_null() {
+        unsafe { (*vm.fw_cfg_ptr).set_cpu_count(vm.engine.vcpu_count() as u16) };
+    }
+}
+
 /// Register a PCI bus at the standard configuration ports (0xCF8-0xCFF).
 ///
 /// Must only be called once per VM instance.
@@ -1210,8 +1365,15 @@ pub extern "C" fn corevm_e1000_take_tx_packets(
         return 0;
     }
     let packets = unsafe { (*vm.e1000_ptr).take_tx_packets() };
+    pack_packets(&packets, buf, buf_len)
+}
+
+/// Serialize `packets` into `buf` as `[u32 length][payload bytes]` records.
+///
+/// Stops at the first packet that does not fit; returns the bytes written.
+fn pack_packets(packets: &[Vec<u8>], buf: *mut u8, buf_len: u32) -> u32 {
     let mut offset: u32 = 0;
-    for pkt in &packets {
+    for pkt in packets {
         let header_size = 4u32; // u32 length prefix
         let pkt_len = pkt.len() as u32;
         let needed = header_size + pkt_len;
@@ -1298,10 +1460,16 @@ pub extern "C" fn corevm_pic_get_interrupt(handle: u64) -> i32 {
 // Device Setup — IDE/ATA Disk Controller
 // ════════════════════════════════════════════════════════════════════════
 
+/// I/O BAR of the PIIX3 IDE bus-master registers (PCI 0:1.1).
+const IDE_BM_PORT: u16 = 0xC080;
+
 /// Register an ATA/IDE disk controller on the primary channel.
 ///
 /// Registers I/O handlers at ports 0x1F0-0x1F7 (command block) and
-/// 0x3F6-0x3F7 (control block). Must only be called once per VM instance.
+/// 0x3F6-0x3F7 (control block). If the PCI bus exists (see
+/// [`corevm_setup_standard_devices`]), the controller also appears as the
+/// PIIX3 IDE function at 0:1.1 with bus-master DMA registers at
+/// 0xC080-0xC08F. Must only be called once per VM instance.
 #[no_mangle]
 pub extern "C" fn corevm_setup_ide(handle: u64) {
     vm_log!("setting up IDE controller (ports 0x1F0-0x1F7, 0x3F6-0x3F7)");
@@ -1311,6 +1479,29 @@ pub extern "C" fn corevm_setup_ide(handle: u64) {
     vm.ide_ptr = ide;
     vm.engine.io.register(0x1F0, 8, Box::new(IoProxy { ptr: ide }));
     vm.engine.io.register(0x3F6, 2, Box::new(IoProxy { ptr: ide }));
+
+    if vm.bus_ptr.is_null() {
+        return;
+    }
+    // PIIX3 IDE at 0:1.1 in legacy (ISA port and IRQ 14) mode; only the
+    // bus-master BAR is relocatable on real hardware, and it is fixed here
+    // because the handler is registered at a fixed port.
+    let mut pci = devices::bus::PciDevice::new(
+        0x8086,  // Vendor ID: Intel
+        0x7010,  // Device ID: PIIX3 IDE
+        0x01,    // Class: Mass storage
+        0x01,    // Subclass: IDE
+        0x80,    // Prog IF: bus master, both channels in compatibility mode
+    );
+    pci.bus = 0;
+    pci.device = 1;
+    pci.function = 1;
+    pci.set_fixed_bar(4, IDE_BM_PORT as u32, devices::ide::BM_BAR_SIZE as u32, false);
+    unsafe { (*vm.bus_ptr).add_device(pci) };
+
+    let memory: *mut GuestMemory = &mut vm.engine.memory;
+    unsafe { (*ide).enable_bus_master(memory, IDE_BM_PORT) };
+    vm.engine.io.register(IDE_BM_PORT, devices::ide::BM_BAR_SIZE, Box::new(IoProxy { ptr: ide }));
 }
 
 /// Attach a disk image to the IDE controller.
@@ -1371,3 +1562,399 @@ pub extern "C" fn corevm_ide_clear_irq(handle: u64) {
     }
     unsafe { (*vm.ide_ptr).clear_irq() };
 }
+
+// ════════════════════════════════════════════════════════════════════════
+// Device Setup — Virtio Block / Network
+// ════════════════════════════════════════════════════════════════════════
+
+/// I/O BAR of the virtio block device (PCI 0:3.0).
+const VIRTIO_BLK_PORT: u16 = 0xC000;
+/// I/O BAR of the virtio network card (PCI 0:4.0).
+const VIRTIO_NET_PORT: u16 = 0xC040;
+
+/// Add a virtio PCI function at `0:slot.0` with its I/O BAR fixed at `port`.
+///
+/// The interrupt pin is INTA; the firmware assigns the line through its
+/// PCI IRQ routing, and [`corevm_virtio_take_irqs`] reports whichever
+/// line it chose.
+fn add_virtio_pci(vm: &mut VmInstance, slot: u8, device_id: u16, subsystem: u16, class: u8, port: u16) {
+    if vm.bus_ptr.is_null() {
+        return;
+    }
+    let mut pci = devices::bus::PciDevice::new(
+        devices::virtio::VIRTIO_VENDOR_ID,
+        device_id,
+        class,
+        0x00,
+        0x00,
+    );
+    pci.bus = 0;
+    pci.device = slot;
+    pci.function = 0;
+    pci.set_subsystem(devices::virtio::VIRTIO_VENDOR_ID, subsystem);
+    // The handler is registered at a fixed port, so the BAR cannot move.
+    pci.set_fixed_bar(0, port as u32, devices::virtio::VIRTIO_BAR_SIZE as u32, false);
+    pci.set_interrupt(11, 1);
+    unsafe { (*vm.bus_ptr).add_device(pci) };
+}
+
+/// Add a virtio block device at PCI 0:3.0 (I/O ports 0xC000-0xC03F).
+///
+/// The device has no medium until [`corevm_virtio_blk_attach_image`] or
+/// [`corevm_virtio_blk_attach_file`] is called. Call after
+/// [`corevm_setup_standard_devices`] (which creates the PCI bus) and only
+/// once per VM instance.
+#[no_mangle]
+pub extern "C" fn corevm_setup_virtio_blk(handle: u64) {
+    let vm = unsafe { vm_from_handle(handle) };
+    if !vm.virtio_blk_ptr.is_null() {
+        return;
+    }
+    vm_log!("setting up virtio-blk (PCI 0:3.0, ports 0x{:X})", VIRTIO_BLK_PORT);
+    let memory: *mut GuestMemory = &mut vm.engine.memory;
+    let blk = Box::into_raw(Box::new(devices::virtio::VirtioPci::new(
+        devices::virtio::VirtioBlk::new(),
+        VIRTIO_BLK_PORT,
+        memory,
+    )));
+    vm.virtio_blk_ptr = blk;
+    vm.engine.io.register(
+        VIRTIO_BLK_PORT,
+        devices::virtio::VIRTIO_BAR_SIZE,
+        Box::new(IoProxy { ptr: blk }),
+    );
+    add_virtio_pci(vm, 3, devices::virtio::VIRTIO_BLK_DEVICE_ID, 2, 0x01, VIRTIO_BLK_PORT);
+}
+
+/// Attach an in-memory disk image to the virtio block device.
+///
+/// The data is copied into the VM, like [`corevm_ide_attach_disk`]; the
+/// guest sees `len / 512` sectors. No-op if `data` is null or virtio-blk
+/// has not been set up.
+#[no_mangle]
+pub extern "C" fn corevm_virtio_blk_attach_image(handle: u64, data: *const u8, len: u32) {
+    if data.is_null() || len == 0 {
+        return;
+    }
+    let vm = unsafe { vm_from_handle(handle) };
+    if vm.virtio_blk_ptr.is_null() {
+        return;
+    }
+    let slice = unsafe { core::slice::from_raw_parts(data, len as usize) };
+    vm_log!("attaching virtio-blk image ({} bytes)", len);
+    let image = slice.to_vec();
+    unsafe { (*vm.virtio_blk_ptr).device.attach(devices::virtio::BlockBacking::Image(image)) };
+}
+
+/// Back the virtio block device with a host file.
+///
+/// `path` points to `path_len` bytes of UTF-8 path. The file is opened for
+/// reading and writing and accessed in place through the VFS, so the image
+/// is never loaded whole and guest writes go to the file. Files are limited
+/// to 2 GiB. Returns 1 on success, 0 if the file cannot be opened or
+/// virtio-blk has not been set up.
+#[no_mangle]
+pub extern "C" fn corevm_virtio_blk_attach_file(handle: u64, path: *const u8, path_len: u32) -> u32 {
+    if path.is_null() || path_len == 0 {
+        return 0;
+    }
+    let vm = unsafe { vm_from_handle(handle) };
+    if vm.virtio_blk_ptr.is_null() {
+        return 0;
+    }
+    let bytes = unsafe { core::slice::from_raw_parts(path, path_len as usize) };
+    let path = match core::str::from_utf8(bytes) {
+        Ok(p) => p,
+        Err(_) => return 0,
+    };
+    let fd = libsyscall::open(path, libsyscall::O_WRITE);
+    if fd == u32::MAX {
+        vm_log!("virtio-blk: cannot open {}", path);
+        return 0;
+    }
+    let size = (libsyscall::file_size(fd) as u64).min(i32::MAX as u64);
+    vm_log!("attaching virtio-blk file {} ({} bytes)", path, size);
+    unsafe {
+        (*vm.virtio_blk_ptr)
+            .device
+            .attach(devices::virtio::BlockBacking::File { fd, size })
+    };
+    1
+}
+
+/// Add a virtio network card at PCI 0:4.0 (I/O ports 0xC040-0xC07F).
+///
+/// `mac` must point to exactly 6 bytes (the MAC address). If `mac` is null,
+/// the default MAC 52:54:00:12:34:57 is used. Frames are exchanged with the
+/// host through [`corevm_virtio_net_receive_packet`] and
+/// [`corevm_virtio_net_take_tx_packets`]. Call after
+/// [`corevm_setup_standard_devices`] and only once per VM instance.
+#[no_mangle]
+pub extern "C" fn corevm_setup_virtio_net(handle: u64, mac: *const u8) {
+    let vm = unsafe { vm_from_handle(handle) };
+    if !vm.virtio_net_ptr.is_null() {
+        return;
+    }
+    vm_log!("setting up virtio-net (PCI 0:4.0, ports 0x{:X})", VIRTIO_NET_PORT);
+    let mac_bytes = if mac.is_null() {
+        [0x52, 0x54, 0x00, 0x12, 0x34, 0x57]
+    } else {
+        let slice = unsafe { core::slice::from_raw_parts(mac, 6) };
+        [slice[0], slice[1], slice[2], slice[3], slice[4], slice[5]]
+    };
+    let memory: *mut GuestMemory = &mut vm.engine.memory;
+    let net = Box::into_raw(Box::new(devices::virtio::VirtioPci::new(
+        devices::virtio::VirtioNet::new(mac_bytes),
+        VIRTIO_NET_PORT,
+        memory,
+    )));
+    vm.virtio_net_ptr = net;
+    vm.engine.io.register(
+        VIRTIO_NET_PORT,
+        devices::virtio::VIRTIO_BAR_SIZE,
+        Box::new(IoProxy { ptr: net }),
+    );
+    add_virtio_pci(vm, 4, devices::virtio::VIRTIO_NET_DEVICE_ID, 1, 0x02, VIRTIO_NET_PORT);
+}
+
+/// Deliver a received network frame to the virtio network card.
+///
+/// The frame goes straight into a guest receive buffer if one is posted,
+/// otherwise it waits (up to 256 frames) for the guest to post one.
+/// No-op if `data` is null, `len` is 0, or virtio-net has not been set up.
+#[no_mangle]
+pub extern "C" fn corevm_virtio_net_receive_packet(handle: u64, data: *const u8, len: u32) {
+    if data.is_null() || len == 0 {
+        return;
+    }
+    let vm = unsafe { vm_from_handle(handle) };
+    if vm.virtio_net_ptr.is_null() {
+        return;
+    }
+    let slice = unsafe { core::slice::from_raw_parts(data, len as usize) };
+    unsafe { (*vm.virtio_net_ptr).receive_packet(slice) };
+}
+
+/// Drain frames transmitted by the guest on the virtio network card.
+///
+/// Same serialization as [`corevm_e1000_take_tx_packets`]. Returns 0 if
+/// `buf` is null or virtio-net has not been set up.
+#[no_mangle]
+pub extern "C" fn corevm_virtio_net_take_tx_packets(handle: u64, buf: *mut u8, buf_len: u32) -> u32 {
+    if buf.is_null() || buf_len == 0 {
+        return 0;
+    }
+    let vm = unsafe { vm_from_handle(handle) };
+    if vm.virtio_net_ptr.is_null() {
+        return 0;
+    }
+    let packets = unsafe { (*vm.virtio_net_ptr).device.take_tx_packets() };
+    pack_packets(&packets, buf, buf_len)
+}
+
+/// Collect the interrupts newly raised by the virtio devices.
+///
+/// Returns a bitmask of IRQ lines (bit N = IRQ N) for the host to pass to
+/// [`corevm_pic_raise_irq`]. Each assertion is reported once; the device
+/// lowers it when the guest reads its ISR register.
+#[no_mangle]
+pub extern "C" fn corevm_virtio_take_irqs(handle: u64) -> u32 {
+    let vm = unsafe { vm_from_handle(handle) };
+    let mut lines = 0u32;
+    let mut collect = |raised: bool, slot: u8| {
+        if !raised {
+            return;
+        }
+        let line = if vm.bus_ptr.is_null() {
+            11
+        } else {
+            unsafe { (*vm.bus_ptr).interrupt_line(slot) }.unwrap_or(11)
+        };
+        if line < 16 {
+            lines |= 1 << line;
+        }
+    };
+    if !vm.virtio_blk_ptr.is_null() {
+        collect(unsafe { (*vm.virtio_blk_ptr).take_irq() }, 3);
+    }
+    if !vm.virtio_net_ptr.is_null() {
+        collect(unsafe { (*vm.virtio_net_ptr).take_irq() }, 4);
+    }
+    lines
+}
+
+// ════════════════════════════════════════════════════════════════════════
+// Snapshots
+// ════════════════════════════════════════════════════════════════════════
+
+/// Encode the CPU and device state of `vm` as snapshot records.
+fn save_state(vm: &VmInstance) -> snapshot::StateWriter {
+    use snapshot::Snapshot;
+    let mut w = snapshot::StateWriter::new();
+    w.record(*b"CPU0", &vm.engine.cpu);
+    w.record(*b"INTC", &vm.engine.interrupts);
+    if let Some(smp) = vm.engine.smp.as_ref() {
+        w.record(*b"SMP ", smp);
+    }
+    let devices: [([u8; 4], Option<&dyn Snapshot>); 13] = unsafe {
+        [
+            (*b"PIC ", vm.pic_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"PIT ", vm.pit_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"CMOS", vm.cmos_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"PS2 ", vm.ps2_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"COM1", vm.serial_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"SVGA", vm.svga_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"PCI ", vm.bus_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"IOAP", vm.ioapic_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"FWCF", vm.fw_cfg_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"E1K ", vm.e1000_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"IDE ", vm.ide_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"VBLK", vm.virtio_blk_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+            (*b"VNET", vm.virtio_net_ptr.as_ref().map(|d| d as &dyn Snapshot)),
+        ]
+    };
+    for (tag, device) in devices {
+        if let Some(device) = device {
+            w.record(tag, device);
+        }
+    }
+    w
+}
+
+/// Load state encoded by [`save_state`] into `vm`, which must have the
+/// devices the snapshot has.
+fn load_state(vm: &mut VmInstance, state: &[u8]) -> Result<()> {
+    use snapshot::Snapshot;
+    let mut r = snapshot::StateReader::new(state);
+    while !r.is_empty() {
+        let (tag, mut body) = r.record()?;
+        let target: Option<&mut dyn Snapshot> = unsafe {
+            match &tag {
+                b"CPU0" => Some(&mut vm.engine.cpu),
+                b"INTC" => Some(&mut vm.engine.interrupts),
+                b"SMP " => vm.engine.smp.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"PIC " => vm.pic_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"PIT " => vm.pit_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"CMOS" => vm.cmos_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"PS2 " => vm.ps2_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"COM1" => vm.serial_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"SVGA" => vm.svga_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"PCI " => vm.bus_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"IOAP" => vm.ioapic_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"FWCF" => vm.fw_cfg_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"E1K " => vm.e1000_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"IDE " => vm.ide_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"VBLK" => vm.virtio_blk_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                b"VNET" => vm.virtio_net_ptr.as_mut().map(|d| d as &mut dyn Snapshot),
+                _ => None,
+            }
+        };
+        let target = target.ok_or(VmError::InvalidSnapshot)?;
+        target.load(&mut body)?;
+        snapshot::expect_end(&body)?;
+    }
+    // Translation state is rebuilt from the restored control registers.
+    vm.engine.mmu = Mmu::new();
+    Ok(())
+}
+
+/// Save a snapshot of the VM (CPU, device state and guest RAM) to `path`.
+///
+/// `path` points to `path_len` bytes of UTF-8 path. With `incremental`
+/// non-zero, only the RAM pages written since the last snapshot this VM
+/// saved or was restored from are stored, and that snapshot becomes the
+/// new one's parent (it must be kept for the new one to be restorable);
+/// with no earlier snapshot a full one is written. Disk images and
+/// queued network packets are host resources and not saved.
+///
+/// Returns 1 on success, 0 on failure (including `path` being a file the
+/// VM's RAM is currently mapped from, or the parent of an incremental).
+#[no_mangle]
+pub extern "C" fn corevm_snapshot_save(handle: u64, path: *const u8, path_len: u32, incremental: u32) -> u32 {
+    if path.is_null() || path_len == 0 {
+        return 0;
+    }
+    let vm = unsafe { vm_from_handle(handle) };
+    let bytes = unsafe { core::slice::from_raw_parts(path, path_len as usize) };
+    let path = match core::str::from_utf8(bytes) {
+        Ok(p) => p,
+        Err(_) => return 0,
+    };
+    let parent = if incremental != 0 { vm.snapshot_chain.last().cloned() } else { None };
+    let in_use = vm.ram_backing.as_deref() == Some(path)
+        || (parent.is_some() && vm.snapshot_chain.iter().any(|p| p == path));
+    if in_use {
+        vm_log!("snapshot: {} is in use by this VM", path);
+        return 0;
+    }
+    let state = save_state(vm);
+    let dirty = vm.engine.memory.ram().dirty_count();
+    match snapshot::save(path, vm.engine.memory.ram_mut(), state.as_bytes(), parent.as_deref()) {
+        Ok(()) => {
+            match parent {
+                Some(_) => {
+                    vm_log!("snapshot: saved {} ({} dirty pages)", path, dirty);
+                    vm.snapshot_chain.push(String::from(path));
+                }
+                None => {
+                    vm_log!("snapshot: saved {} (full)", path);
+                    vm.snapshot_chain = alloc::vec![String::from(path)];
+                }
+            }
+            1
+        }
+        Err(e) => {
+            vm_log!("snapshot: saving {} failed: {}", path, e);
+            0
+        }
+    }
+}
+
+/// Restore the VM from the snapshot at `path` and its parent chain.
+///
+/// The VM must be set up with the same RAM size and devices as the one
+/// that saved it, and the host must re-attach disk images. Guest RAM is
+/// mapped copy-on-write from the full snapshot at the root of the chain
+/// and read in lazily as the guest touches it, so restore time does not
+/// grow with the RAM size.
+///
+/// Returns 1 on success, 0 on failure. If only the device state turns
+/// out to be unusable, RAM has already been replaced and the VM should be
+/// reset or restored again before it runs.
+#[no_mangle]
+pub extern "C" fn corevm_snapshot_restore(handle: u64, path: *const u8, path_len: u32) -> u32 {
+    if path.is_null() || path_len == 0 {
+        return 0;
+    }
+    let vm = unsafe { vm_from_handle(handle) };
+    let bytes = unsafe { core::slice::from_raw_parts(path, path_len as usize) };
+    let path = match core::str::from_utf8(bytes) {
+        Ok(p) => p,
+        Err(_) => return 0,
+    };
+    let restored = match snapshot::restore(path) {
+        Ok(r) => r,
+        Err(e) => {
+            vm_log!("snapshot: restoring {} failed: {}", path, e);
+            return 0;
+        }
+    };
+    if vm.engine.memory.restore_ram(restored.ram).is_err() {
+        vm_log!("snapshot: {} has a different RAM size", path);
+        return 0;
+    }
+    vm.ram_backing = restored.chain.first().cloned();
+    vm.snapshot_chain = restored.chain;
+    vm.last_error = None;
+    vm.last_error_rip = 0;
+    match load_state(vm, &restored.state) {
+        Ok(()) => {
+            vm_log!("snapshot: restored {} ({} files)", path, vm.snapshot_chain.len());
+            1
+        }
+        Err(e) => {
+            vm_log!("snapshot: state of {} does not fit this VM: {}", path, e);
+            0
+        }
+    }
+}
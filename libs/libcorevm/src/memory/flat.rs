@@ -1,17 +1,63 @@
-//! Flat guest physical memory backed by a contiguous byte vector.
+//! Flat guest physical memory backed by a contiguous byte buffer.
 //!
 //! `FlatMemory` is the simplest guest RAM implementation: a single zeroed
 //! allocation that maps guest physical addresses 1:1 to host offsets.
 //! Out-of-bounds reads return `0xFF` (floating bus), matching real x86
 //! hardware behavior for accesses to unmapped physical address space.
 //! Out-of-bounds writes are silently ignored.
+//!
+//! Every write sets the page's bit in a dirty bitmap, which snapshots use
+//! to save only the pages changed since the previous one. The buffer is
+//! normally heap-allocated, but can also be a private (copy-on-write)
+//! file mapping, so a VM restored from a snapshot faults its RAM in from
+//! the snapshot file on first touch instead of reading all of it up front.
 
+use alloc::boxed::Box;
 use alloc::vec;
 use alloc::vec::Vec;
+use core::ops::{Deref, DerefMut};
 
-use super::MemoryBus;
+use super::{MemoryBus, PAGE_SIZE};
 use crate::error::Result;
 
+/// Storage of a [`FlatMemory`]: a heap allocation or a file mapping.
+struct RamBuf {
+    ptr: *mut u8,
+    len: usize,
+    /// File descriptor of the file mapped at `ptr` (else a boxed slice).
+    mapped: Option<u32>,
+}
+
+impl Deref for RamBuf {
+    type Target = [u8];
+
+    #[inline]
+    fn deref(&self) -> &[u8] {
+        // Safety: `ptr` is valid for `len` bytes for the life of `self`.
+        unsafe { core::slice::from_raw_parts(self.ptr, self.len) }
+    }
+}
+
+impl DerefMut for RamBuf {
+    #[inline]
+    fn deref_mut(&mut self) -> &mut [u8] {
+        unsafe { core::slice::from_raw_parts_mut(self.ptr, self.len) }
+    }
+}
+
+impl Drop for RamBuf {
+    fn drop(&mut self) {
+        unsafe {
+            if let Some(fd) = self.mapped {
+                libsyscall::munmap(self.ptr as u64, self.len as u32);
+                libsyscall::close(fd);
+            } else {
+                let _ = Box::from_raw(core::ptr::slice_from_raw_parts_mut(self.ptr, self.len));
+            }
+        }
+    }
+}
+
 /// Flat, contiguous guest physical memory.
 ///
 /// Addresses `0..size` are valid; anything beyond is out-of-bounds.
@@ -19,17 +65,39 @@ use crate::error::Result;
 /// matching the x86 memory model.
 pub struct FlatMemory {
     /// Backing storage.
-    data: Vec<u8>,
+    data: RamBuf,
     /// Logical size in bytes (always equals `data.len()`).
     size: usize,
+    /// One bit per 4 KiB page written since the last [`clear_dirty`](Self::clear_dirty).
+    dirty: Vec<u64>,
 }
 
 impl FlatMemory {
     /// Allocate `size` bytes of zeroed guest RAM.
     pub fn new(size: usize) -> Self {
+        let data = Box::into_raw(vec![0u8; size].into_boxed_slice()) as *mut u8;
+        Self::with_buf(RamBuf { ptr: data, len: size, mapped: None })
+    }
+
+    /// Use `size` bytes of file `fd` mapped at `addr` by
+    /// `libsyscall::mmap_file` as guest RAM. The mapping is unmapped and
+    /// `fd` closed when the memory is dropped.
+    ///
+    /// # Safety
+    ///
+    /// `addr` must be a writable mapping of at least `size` bytes that
+    /// nothing else uses; a private mapping keeps guest writes out of
+    /// the file.
+    pub unsafe fn from_mapping(addr: u64, size: usize, fd: u32) -> Self {
+        Self::with_buf(RamBuf { ptr: addr as *mut u8, len: size, mapped: Some(fd) })
+    }
+
+    fn with_buf(data: RamBuf) -> Self {
+        let pages = (data.len + PAGE_SIZE as usize - 1) / PAGE_SIZE as usize;
         FlatMemory {
-            data: vec![0u8; size],
-            size,
+            size: data.len,
+            data,
+            dirty: vec![0u64; (pages + 63) / 64],
         }
     }
 
@@ -48,6 +116,7 @@ impl FlatMemory {
             self.size,
         );
         self.data[offset..end].copy_from_slice(src);
+        self.mark_dirty(offset, src.len());
     }
 
     /// Borrow the entire guest RAM as a byte slice.
@@ -56,14 +125,72 @@ impl FlatMemory {
     }
 
     /// Borrow the entire guest RAM as a mutable byte slice.
+    ///
+    /// Every page counts as dirty afterwards; use
+    /// [`slice_mut`](Self::slice_mut) to borrow a smaller range.
     pub fn as_mut_slice(&mut self) -> &mut [u8] {
+        self.dirty.fill(u64::MAX);
         &mut self.data
     }
 
+    /// Borrow `[offset, offset + len)` mutably, marking its pages dirty.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the range exceeds the memory size.
+    pub fn slice_mut(&mut self, offset: usize, len: usize) -> &mut [u8] {
+        self.mark_dirty(offset, len);
+        &mut self.data[offset..offset + len]
+    }
+
+    /// Copy `len` bytes from `src` to `dst` (`memmove` semantics),
+    /// marking the destination pages dirty.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either range exceeds the memory size.
+    pub fn copy_within(&mut self, src: usize, dst: usize, len: usize) {
+        self.data.copy_within(src..src + len, dst);
+        self.mark_dirty(dst, len);
+    }
+
     /// Returns the size of guest RAM in bytes.
     pub fn size(&self) -> usize {
         self.size
     }
+
+    // ── Dirty-page tracking ──
+
+    /// Record a write of `len` bytes at `offset` (in bounds).
+    #[inline]
+    fn mark_dirty(&mut self, offset: usize, len: usize) {
+        if len == 0 {
+            return;
+        }
+        let first = offset / PAGE_SIZE as usize;
+        let last = (offset + len - 1) / PAGE_SIZE as usize;
+        self.dirty[first / 64] |= 1 << (first % 64);
+        for page in first + 1..=last {
+            self.dirty[page / 64] |= 1 << (page % 64);
+        }
+    }
+
+    /// Whether page `page` (4 KiB) was written since the last clear.
+    #[inline]
+    pub fn is_dirty(&self, page: usize) -> bool {
+        self.dirty.get(page / 64).map_or(false, |w| w & (1 << (page % 64)) != 0)
+    }
+
+    /// Number of pages written since the last clear.
+    pub fn dirty_count(&self) -> usize {
+        let pages = (self.size + PAGE_SIZE as usize - 1) / PAGE_SIZE as usize;
+        (0..pages).filter(|&p| self.is_dirty(p)).count()
+    }
+
+    /// Forget which pages were written (a snapshot has saved them).
+    pub fn clear_dirty(&mut self) {
+        self.dirty.fill(0);
+    }
 }
 
 impl MemoryBus for FlatMemory {
@@ -125,6 +252,7 @@ impl MemoryBus for FlatMemory {
             return Ok(()); // ignore write to unmapped physical memory
         }
         self.data[a] = val;
+        self.mark_dirty(a, 1);
         Ok(())
     }
 
@@ -137,6 +265,7 @@ impl MemoryBus for FlatMemory {
         let bytes = val.to_le_bytes();
         self.data[a] = bytes[0];
         self.data[a + 1] = bytes[1];
+        self.mark_dirty(a, 2);
         Ok(())
     }
 
@@ -151,6 +280,7 @@ impl MemoryBus for FlatMemory {
         self.data[a + 1] = bytes[1];
         self.data[a + 2] = bytes[2];
         self.data[a + 3] = bytes[3];
+        self.mark_dirty(a, 4);
         Ok(())
     }
 
@@ -169,6 +299,7 @@ impl MemoryBus for FlatMemory {
         self.data[a + 5] = bytes[5];
         self.data[a + 6] = bytes[6];
         self.data[a + 7] = bytes[7];
+        self.mark_dirty(a, 8);
         Ok(())
     }
 
@@ -191,6 +322,34 @@ impl MemoryBus for FlatMemory {
             return Ok(()); // ignore write to unmapped physical memory
         }
         self.data[a..end].copy_from_slice(buf);
+        self.mark_dirty(a, buf.len());
         Ok(())
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_writes_mark_pages_dirty() {
+        let mut mem = FlatMemory::new(0x10000);
+        assert_eq!(mem.dirty_count(), 0);
+        mem.write_u8(0x1000, 1).unwrap();
+        mem.write_u32(0x2FFE, 0xFFFF_FFFF).unwrap(); // straddles pages 2 and 3
+        mem.write_bytes(0x8000, &[0u8; 0x1001]).unwrap();
+        let _ = mem.write_u64(0x10000, 0); // out of bounds: ignored
+        let dirty: Vec<usize> = (0..16).filter(|&p| mem.is_dirty(p)).collect();
+        assert_eq!(dirty, [1, 2, 3, 8, 9]);
+        mem.clear_dirty();
+        assert_eq!(mem.dirty_count(), 0);
+        mem.slice_mut(0x5000, 16)[0] = 7;
+        assert!(mem.is_dirty(5) && mem.dirty_count() == 1);
+        assert_eq!(mem.read_u8(0x5000).unwrap(), 7);
+        mem.clear_dirty();
+        mem.copy_within(0x5000, 0x6FFF, 2);
+        assert_eq!(mem.read_u8(0x6FFF).unwrap(), 7);
+        let dirty: Vec<usize> = (0..16).filter(|&p| mem.is_dirty(p)).collect();
+        assert_eq!(dirty, [6, 7]);
+    }
+}
@@ -37,14 +37,15 @@ pub struct MmioRegion {
 
 /// Dispatcher that routes physical addresses to the correct MMIO handler.
 ///
-/// Regions must not overlap. The dispatcher performs a linear scan, which
-/// is efficient for the small number of MMIO regions typical in an emulated
-/// PC (usually fewer than 16).
+/// Regions must not overlap. They are kept sorted by base address, so a
+/// lookup is a binary search: with the VGA window, IOAPIC and PCI BARs all
+/// registered, most RAM above 640 KiB falls between regions and is told
+/// apart from MMIO in a couple of comparisons.
 ///
 /// A cached `min_base` / `max_end` pair provides fast rejection for
 /// addresses that fall entirely outside any MMIO region.
 pub struct MmioDispatch {
-    /// Registered MMIO regions, searched in insertion order.
+    /// Registered MMIO regions, sorted by `base`.
     regions: Vec<MmioRegion>,
     /// Lowest base address across all regions (for fast rejection).
     min_base: u64,
@@ -74,18 +75,14 @@ impl MmioDispatch {
         if end > self.max_end {
             self.max_end = end;
         }
-        self.regions.push(MmioRegion {
+        let at = self.regions.partition_point(|r| r.base < base);
+        self.regions.insert(at, MmioRegion {
             base,
             size,
             handler,
         });
     }
 
-    /// Find the MMIO region containing `addr`, if any.
-    ///
-    /// Returns a mutable reference so the caller can invoke the handler's
-    /// `read` or `write` method. Fast-rejects addresses outside the
-    /// aggregate MMIO range.
     /// Return the number of registered MMIO regions.
     pub fn region_count(&self) -> usize {
         self.regions.len()
@@ -96,14 +93,99 @@ impl MmioDispatch {
         (self.min_base, self.max_end)
     }
 
+    /// Whether any region overlaps `[start, end)`.
+    pub fn overlaps(&self, start: u64, end: u64) -> bool {
+        if end <= self.min_base || start >= self.max_end {
+            return false;
+        }
+        // Regions do not overlap, so their ends are sorted too.
+        let i = self.regions.partition_point(|r| r.base + r.size <= start);
+        i < self.regions.len() && self.regions[i].base < end
+    }
+
+    /// Base of the first region starting above `addr`, or `u64::MAX`.
+    pub fn next_base(&self, addr: u64) -> u64 {
+        let i = self.regions.partition_point(|r| r.base <= addr);
+        self.regions.get(i).map_or(u64::MAX, |r| r.base)
+    }
+
+    /// Find the MMIO region containing `addr`, if any.
+    ///
+    /// Returns a mutable reference so the caller can invoke the handler's
+    /// `read` or `write` method. Fast-rejects addresses outside the
+    /// aggregate MMIO range.
     #[inline]
     pub fn find(&mut self, addr: u64) -> Option<&mut MmioRegion> {
-        // Fast rejection: skip linear scan if address is outside all MMIO regions.
+        // Fast rejection: skip the search if address is outside all MMIO regions.
         if addr < self.min_base || addr >= self.max_end {
             return None;
         }
-        self.regions
-            .iter_mut()
-            .find(|r| addr >= r.base && addr < r.base + r.size)
+        let i = self.regions.partition_point(|r| r.base <= addr);
+        let region = self.regions.get_mut(i.checked_sub(1)?)?;
+        if addr < region.base + region.size {
+            Some(region)
+        } else {
+            None
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    struct Tag(u64);
+
+    impl MmioHandler for Tag {
+        fn read(&mut self, offset: u64, _size: u8) -> Result<u64> {
+            Ok(self.0 << 32 | offset)
+        }
+
+        fn write(&mut self, _offset: u64, _size: u8, _val: u64) -> Result<()> {
+            Ok(())
+        }
+    }
+
+    fn hit(d: &mut MmioDispatch, addr: u64) -> Option<u64> {
+        let r = d.find(addr)?;
+        let offset = addr - r.base;
+        Some(r.handler.read(offset, 1).unwrap())
+    }
+
+    #[test]
+    fn test_find_out_of_order_regions() {
+        let mut d = MmioDispatch::new();
+        d.register(0xFEC0_0000, 0x1000, Box::new(Tag(2)));
+        d.register(0xA0000, 0x20000, Box::new(Tag(1)));
+        d.register(0xFEBC_0000, 0x20000, Box::new(Tag(3)));
+
+        assert_eq!(hit(&mut d, 0x9FFFF), None);
+        assert_eq!(hit(&mut d, 0xA0000), Some(1 << 32));
+        assert_eq!(hit(&mut d, 0xBFFFF), Some(1 << 32 | 0x1FFFF));
+        assert_eq!(hit(&mut d, 0xC0000), None);
+        assert_eq!(hit(&mut d, 0x10_0000), None);
+        assert_eq!(hit(&mut d, 0xFEBC_0010), Some(3 << 32 | 0x10));
+        assert_eq!(hit(&mut d, 0xFEBE_0000), None);
+        assert_eq!(hit(&mut d, 0xFEC0_0FFF), Some(2 << 32 | 0xFFF));
+        assert_eq!(hit(&mut d, 0xFEC0_1000), None);
+    }
+
+    #[test]
+    fn test_overlaps_and_next_base() {
+        let mut d = MmioDispatch::new();
+        d.register(0x3000, 0x1000, Box::new(Tag(2)));
+        d.register(0x1000, 0x1000, Box::new(Tag(1)));
+
+        assert!(!d.overlaps(0, 0x1000));
+        assert!(d.overlaps(0xFFF, 0x1001));
+        assert!(!d.overlaps(0x2000, 0x3000));
+        assert!(d.overlaps(0x1800, 0x3800));
+        assert!(d.overlaps(0x3FFF, 0x5000));
+        assert!(!d.overlaps(0x4000, 0x5000));
+
+        assert_eq!(d.next_base(0), 0x1000);
+        assert_eq!(d.next_base(0x1000), 0x3000);
+        assert_eq!(d.next_base(0x2FFF), 0x3000);
+        assert_eq!(d.next_base(0x3000), u64::MAX);
     }
 }
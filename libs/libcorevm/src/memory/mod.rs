@@ -15,25 +15,34 @@
 //! [`GuestMemory`] ties everything together: it holds the flat RAM plus
 //! registered MMIO regions and implements [`MemoryBus`] with automatic MMIO
 //! routing. The [`Mmu`] struct tracks paging configuration derived from
-//! CR0/CR4/EFER and exposes the high-level `translate` method.
+//! CR0/CR4/EFER and exposes the high-level `translate` method, caching
+//! completed page walks in a software [`Tlb`].
+//!
+//! `GuestMemory` also tracks which RAM pages the CPU's decoded-block cache
+//! ([`crate::block_cache`]) has read code from, and reports writes to them
+//! so stale blocks are dropped before they run again.
 
 pub mod flat;
 pub mod mmio;
 pub mod paging;
 pub mod segment;
+pub mod tlb;
 
 use alloc::boxed::Box;
+use alloc::vec;
+use alloc::vec::Vec;
 use core::cell::UnsafeCell;
 
 use crate::error::Result;
 use crate::registers::{
-    SegmentDescriptor, CR0_PG, CR0_WP, CR4_PAE, CR4_PSE, EFER_LMA, EFER_NXE,
+    SegmentDescriptor, CR0_PG, CR0_WP, CR4_PAE, CR4_PGE, CR4_PSE, EFER_LMA, EFER_NXE,
 };
 
 pub use flat::FlatMemory;
 pub use mmio::{MmioDispatch, MmioHandler, MmioRegion};
 pub use paging::walk_page_tables;
 pub use segment::segment_translate;
+pub use tlb::Tlb;
 
 // ── AccessType ──
 
@@ -131,24 +140,45 @@ pub trait MemoryBus {
 ///
 /// Reads and writes are first checked against registered MMIO regions;
 /// if no MMIO region matches, the access falls through to flat RAM.
+/// Bulk [`read_bytes`](MemoryBus::read_bytes) / [`write_bytes`](MemoryBus::write_bytes)
+/// copy RAM-backed runs straight to or from the flat RAM and only split
+/// the parts that land in an MMIO region into handler accesses.
 ///
 /// `UnsafeCell` is used for the MMIO dispatch because device handlers
 /// are stateful (`read`/`write` take `&mut self`), but the `MemoryBus`
 /// trait requires `&self` for reads (used by paging, decode, etc.).
 /// Safety: the emulator is single-threaded and non-re-entrant.
+///
+/// Every write through `GuestMemory` (the [`MemoryBus`] methods and
+/// [`load_at`](Self::load_at)) is checked against the code-page bitmap;
+/// writes through [`ram_mut`](Self::ram_mut) bypass it.
 pub struct GuestMemory {
     /// Flat guest RAM.
     ram: FlatMemory,
     /// MMIO region dispatcher (interior mutability for `&self` read path).
     mmio: UnsafeCell<MmioDispatch>,
+    /// One bit per 4 KiB RAM page that cached blocks were decoded from.
+    code_pages: Vec<u64>,
+    /// Code pages written since the last [`take_code_writes`](Self::take_code_writes).
+    code_writes: Vec<u64>,
+    /// Copy of every page handed out by `take_code_writes`, kept for the
+    /// other vCPUs' caches in an SMP VM (see [`share_code_writes`](Self::share_code_writes)).
+    shared_code_writes: Option<Vec<u64>>,
 }
 
+/// Guest page size used for code-write tracking.
+pub const PAGE_SIZE: u64 = 4096;
+
 impl GuestMemory {
     /// Create a new guest memory with `ram_size` bytes of zeroed RAM.
     pub fn new(ram_size: usize) -> Self {
+        let pages = (ram_size as u64 + PAGE_SIZE - 1) / PAGE_SIZE;
         GuestMemory {
             ram: FlatMemory::new(ram_size),
             mmio: UnsafeCell::new(MmioDispatch::new()),
+            code_pages: vec![0u64; ((pages + 63) / 64) as usize],
+            code_writes: Vec::new(),
+            shared_code_writes: None,
         }
     }
 
@@ -173,6 +203,7 @@ impl GuestMemory {
     /// Panics if `offset + data.len()` exceeds the RAM size.
     pub fn load_at(&mut self, offset: usize, data: &[u8]) {
         self.ram.load_at(offset, data);
+        self.note_write(offset as u64, data.len());
     }
 
     /// Register an MMIO region at `base` with `size` bytes.
@@ -181,6 +212,10 @@ impl GuestMemory {
     /// will be routed to `handler` instead of flat RAM.
     pub fn add_mmio(&mut self, base: u64, size: u64, handler: Box<dyn MmioHandler>) {
         self.mmio.get_mut().register(base, size, handler);
+        // Code cached from RAM the region now shadows is stale.
+        if size > 0 && base < self.ram.size() as u64 {
+            self.note_write(base, size.min(self.ram.size() as u64 - base) as usize);
+        }
     }
 
     /// Borrow the underlying flat RAM.
@@ -193,6 +228,67 @@ impl GuestMemory {
         &mut self.ram
     }
 
+    /// Replace guest RAM with `ram` restored from a snapshot. Every page
+    /// counts as changed code, so the caller must flush the block caches
+    /// (loading a CPU from a snapshot does).
+    ///
+    /// Returns `ram` back if its size differs from the current RAM.
+    pub fn restore_ram(&mut self, ram: FlatMemory) -> core::result::Result<(), FlatMemory> {
+        if ram.size() != self.ram.size() {
+            return Err(ram);
+        }
+        self.ram = ram;
+        self.code_pages.fill(0);
+        self.code_writes.clear();
+        if let Some(shared) = self.shared_code_writes.as_mut() {
+            shared.clear();
+        }
+        Ok(())
+    }
+
+    /// Borrow `len` bytes of guest RAM at `addr` for a device to read in
+    /// place (DMA). `None` if any of the range is MMIO or beyond RAM;
+    /// the device then falls back to [`read_bytes`](MemoryBus::read_bytes).
+    pub fn dma_slice(&self, addr: u64, len: usize) -> Option<&[u8]> {
+        let end = addr.checked_add(len as u64)?;
+        if !self.is_cacheable(addr, end) {
+            return None;
+        }
+        Some(&self.ram.as_slice()[addr as usize..end as usize])
+    }
+
+    /// Borrow `len` bytes of guest RAM at `addr` for a device to write in
+    /// place (DMA). The range counts as written for code-write tracking.
+    /// `None` under the same conditions as [`dma_slice`](Self::dma_slice).
+    pub fn dma_slice_mut(&mut self, addr: u64, len: usize) -> Option<&mut [u8]> {
+        let end = addr.checked_add(len as u64)?;
+        if !self.is_cacheable(addr, end) {
+            return None;
+        }
+        if len > 0 {
+            self.note_write(addr, len);
+        }
+        Some(self.ram.slice_mut(addr as usize, len))
+    }
+
+    /// Copy `len` bytes of guest RAM from `src` to `dst` in place
+    /// (`memmove` semantics), for bulk string moves. The destination
+    /// counts as written for code-write tracking. Returns `false`, having
+    /// copied nothing, if either range is MMIO or beyond RAM.
+    pub fn copy_ram(&mut self, dst: u64, src: u64, len: usize) -> bool {
+        let (Some(src_end), Some(dst_end)) = (src.checked_add(len as u64), dst.checked_add(len as u64)) else {
+            return false;
+        };
+        if !self.is_cacheable(src, src_end) || !self.is_cacheable(dst, dst_end) {
+            return false;
+        }
+        if len > 0 {
+            self.note_write(dst, len);
+            self.ram.copy_within(src as usize, dst as usize, len);
+        }
+        true
+    }
+
     /// Return the number of registered MMIO regions (diagnostic).
     pub fn mmio_region_count(&self) -> usize {
         // Safety: single-threaded, non-re-entrant.
@@ -203,6 +299,95 @@ impl GuestMemory {
     pub fn mmio_bounds(&self) -> (u64, u64) {
         unsafe { &*self.mmio.get() }.bounds()
     }
+
+    // ── Code-write tracking ──
+
+    /// Whether code decoded from `[start, end)` may be cached: the range is
+    /// plain RAM, not MMIO (whose contents can change without a write).
+    pub fn is_cacheable(&self, start: u64, end: u64) -> bool {
+        end <= self.ram.size() as u64
+            && !unsafe { &*self.mmio.get() }.overlaps(start, end)
+    }
+
+    /// Mark the pages of `[start, end)` as holding cached code.
+    pub fn mark_code(&mut self, start: u64, end: u64) {
+        for page in start / PAGE_SIZE..=(end - 1) / PAGE_SIZE {
+            if let Some(word) = self.code_pages.get_mut((page / 64) as usize) {
+                *word |= 1 << (page % 64);
+            }
+        }
+    }
+
+    /// Whether a code page has been written since the last
+    /// [`take_code_writes`](Self::take_code_writes).
+    #[inline]
+    pub fn code_written(&self) -> bool {
+        !self.code_writes.is_empty()
+    }
+
+    /// Drain the numbers of the code pages written since the last call.
+    /// Their marks are cleared; decoding from them again re-marks them.
+    pub fn take_code_writes(&mut self) -> Vec<u64> {
+        let pages = core::mem::take(&mut self.code_writes);
+        if let Some(shared) = self.shared_code_writes.as_mut() {
+            shared.extend_from_slice(&pages);
+        }
+        pages
+    }
+
+    /// Also log the pages [`take_code_writes`](Self::take_code_writes)
+    /// drains, for block caches other than the one that drained them.
+    pub fn share_code_writes(&mut self) {
+        if self.shared_code_writes.is_none() {
+            self.shared_code_writes = Some(Vec::new());
+        }
+    }
+
+    /// Drain the pages logged since the last call (empty unless
+    /// [`share_code_writes`](Self::share_code_writes) was called).
+    pub fn take_shared_code_writes(&mut self) -> Vec<u64> {
+        match self.shared_code_writes.as_mut() {
+            Some(shared) if !shared.is_empty() => core::mem::take(shared),
+            _ => Vec::new(),
+        }
+    }
+
+    /// Unmark every page (the block cache was flushed).
+    ///
+    /// When code writes are shared the marks are kept: the other vCPUs'
+    /// caches may still hold blocks on those pages.
+    pub fn clear_code_pages(&mut self) {
+        if self.shared_code_writes.is_some() {
+            return;
+        }
+        self.code_pages.fill(0);
+        self.code_writes.clear();
+    }
+
+    /// Record a RAM write of `len` bytes at `addr`.
+    #[inline]
+    fn note_write(&mut self, addr: u64, len: usize) {
+        let first = addr / PAGE_SIZE;
+        let last = addr.wrapping_add(len.max(1) as u64 - 1) / PAGE_SIZE;
+        if first == last {
+            self.note_page(first);
+        } else {
+            for page in first..=last {
+                self.note_page(page);
+            }
+        }
+    }
+
+    #[inline]
+    fn note_page(&mut self, page: u64) {
+        if let Some(word) = self.code_pages.get_mut((page / 64) as usize) {
+            let bit = 1u64 << (page % 64);
+            if *word & bit != 0 {
+                *word &= !bit;
+                self.code_writes.push(page);
+            }
+        }
+    }
 }
 
 /// Helper: dispatch an MMIO read or fall through to RAM.
@@ -267,6 +452,7 @@ impl MemoryBus for GuestMemory {
         if let Some(res) = try_mmio_write(self.mmio_mut(), addr, 1, val as u64) {
             return res;
         }
+        self.note_write(addr, 1);
         self.ram.write_u8(addr, val)
     }
 
@@ -274,6 +460,7 @@ impl MemoryBus for GuestMemory {
         if let Some(res) = try_mmio_write(self.mmio_mut(), addr, 2, val as u64) {
             return res;
         }
+        self.note_write(addr, 2);
         self.ram.write_u16(addr, val)
     }
 
@@ -281,6 +468,7 @@ impl MemoryBus for GuestMemory {
         if let Some(res) = try_mmio_write(self.mmio_mut(), addr, 4, val as u64) {
             return res;
         }
+        self.note_write(addr, 4);
         self.ram.write_u32(addr, val)
     }
 
@@ -288,20 +476,88 @@ impl MemoryBus for GuestMemory {
         if let Some(res) = try_mmio_write(self.mmio_mut(), addr, 8, val) {
             return res;
         }
+        self.note_write(addr, 8);
         self.ram.write_u64(addr, val)
     }
 
     fn read_bytes(&self, addr: u64, buf: &mut [u8]) -> Result<()> {
-        self.ram.read_bytes(addr, buf)
+        let mmio = self.mmio_mut();
+        let end = addr.saturating_add(buf.len() as u64);
+        if !mmio.overlaps(addr, end) {
+            return self.ram.read_bytes(addr, buf);
+        }
+        let mut done = 0;
+        while done < buf.len() {
+            let a = addr + done as u64;
+            let piece = &mut buf[done..done + (piece_end(mmio, a, end) - a) as usize];
+            if let Some(region) = mmio.find(a) {
+                let mut off = 0;
+                while off < piece.len() {
+                    let n = mmio_chunk(a + off as u64, piece.len() - off);
+                    let val = region.handler.read(a + off as u64 - region.base, n as u8)?;
+                    piece[off..off + n].copy_from_slice(&val.to_le_bytes()[..n]);
+                    off += n;
+                }
+            } else {
+                self.ram.read_bytes(a, piece)?;
+            }
+            done += piece.len();
+        }
+        Ok(())
     }
 
     fn write_bytes(&mut self, addr: u64, buf: &[u8]) -> Result<()> {
-        // Bulk writes bypass MMIO for performance. Device models that need
-        // bulk writes should use their own handler interface.
-        self.ram.write_bytes(addr, buf)
+        // Safety: single-threaded, non-re-entrant; `note_write` and the
+        // RAM writes below do not touch the dispatch.
+        let mmio = unsafe { &mut *self.mmio.get() };
+        let end = addr.saturating_add(buf.len() as u64);
+        if !mmio.overlaps(addr, end) {
+            self.note_write(addr, buf.len());
+            return self.ram.write_bytes(addr, buf);
+        }
+        let mut done = 0;
+        while done < buf.len() {
+            let a = addr + done as u64;
+            let piece = &buf[done..done + (piece_end(mmio, a, end) - a) as usize];
+            if let Some(region) = mmio.find(a) {
+                let mut off = 0;
+                while off < piece.len() {
+                    let n = mmio_chunk(a + off as u64, piece.len() - off);
+                    let mut bytes = [0u8; 8];
+                    bytes[..n].copy_from_slice(&piece[off..off + n]);
+                    let val = u64::from_le_bytes(bytes);
+                    region.handler.write(a + off as u64 - region.base, n as u8, val)?;
+                    off += n;
+                }
+            } else {
+                self.note_write(a, piece.len());
+                self.ram.write_bytes(a, piece)?;
+            }
+            done += piece.len();
+        }
+        Ok(())
     }
 }
 
+/// End of the run of `[addr, end)` that is either all one MMIO region or
+/// all RAM, for splitting a bulk access.
+fn piece_end(mmio: &mut MmioDispatch, addr: u64, end: u64) -> u64 {
+    match mmio.find(addr) {
+        Some(region) => end.min(region.base + region.size),
+        None => end.min(mmio.next_base(addr)),
+    }
+}
+
+/// Size of the next access of a bulk MMIO transfer at `addr` with `left`
+/// bytes to go: the widest naturally aligned 1/2/4/8-byte access that fits.
+fn mmio_chunk(addr: u64, left: usize) -> usize {
+    let mut n = 8;
+    while n > 1 && (addr % n as u64 != 0 || n > left) {
+        n /= 2;
+    }
+    n
+}
+
 // ── Mmu ──
 
 /// Memory Management Unit state derived from control registers.
@@ -309,6 +565,10 @@ impl MemoryBus for GuestMemory {
 /// Tracks the paging mode and protection flags that affect address
 /// translation. Updated whenever the guest writes to CR0, CR4, or EFER
 /// via the `update_from_regs` method.
+///
+/// The TLB sits in an `UnsafeCell` because translation takes `&self`
+/// throughout the executor; like the MMIO dispatch in [`GuestMemory`] this
+/// relies on the emulator being single-threaded and non-re-entrant.
 pub struct Mmu {
     /// CR0.PG — paging is enabled.
     pub paging_enabled: bool,
@@ -322,6 +582,10 @@ pub struct Mmu {
     pub wp: bool,
     /// EFER.NXE — no-execute enable.
     pub nxe: bool,
+    /// CR4.PGE — global pages survive CR3 loads.
+    pub pge: bool,
+    /// Cached page walks.
+    tlb: UnsafeCell<Tlb>,
     /// Cached CR0/CR4/EFER for change detection.
     cached_cr0: u64,
     /// Cached CR4 value.
@@ -340,6 +604,8 @@ impl Mmu {
             long_mode: false,
             wp: false,
             nxe: false,
+            pge: false,
+            tlb: UnsafeCell::new(Tlb::new()),
             cached_cr0: 0,
             cached_cr4: 0,
             cached_efer: 0,
@@ -350,11 +616,22 @@ impl Mmu {
     ///
     /// Uses cached values to skip the update when nothing changed (which
     /// is the common case — control registers are written very rarely).
+    /// A change to any bit that affects translation flushes the TLB,
+    /// global entries included.
     #[inline]
     pub fn update_from_regs(&mut self, cr0: u64, cr4: u64, efer: u64) {
         if cr0 == self.cached_cr0 && cr4 == self.cached_cr4 && efer == self.cached_efer {
             return;
         }
+        const CR0_PAGING: u64 = CR0_PG | CR0_WP;
+        const CR4_PAGING: u64 = CR4_PSE | CR4_PAE | CR4_PGE;
+        const EFER_PAGING: u64 = EFER_LMA | EFER_NXE;
+        if (cr0 ^ self.cached_cr0) & CR0_PAGING != 0
+            || (cr4 ^ self.cached_cr4) & CR4_PAGING != 0
+            || (efer ^ self.cached_efer) & EFER_PAGING != 0
+        {
+            self.tlb_mut().flush(false);
+        }
         self.cached_cr0 = cr0;
         self.cached_cr4 = cr4;
         self.cached_efer = efer;
@@ -364,6 +641,32 @@ impl Mmu {
         self.pae = (cr4 & CR4_PAE) != 0;
         self.long_mode = (efer & EFER_LMA) != 0;
         self.nxe = (efer & EFER_NXE) != 0;
+        self.pge = (cr4 & CR4_PGE) != 0;
+    }
+
+    /// Get a mutable reference to the TLB.
+    ///
+    /// # Safety
+    ///
+    /// Safe because the emulator is single-threaded and translation is
+    /// non-re-entrant.
+    fn tlb_mut(&self) -> &mut Tlb {
+        unsafe { &mut *self.tlb.get() }
+    }
+
+    /// Flush the TLB for a CR3 load: every entry except global pages.
+    pub fn load_cr3(&self, cr3: u64) {
+        self.tlb_mut().load_cr3(cr3);
+    }
+
+    /// Flush the TLB entries for the page containing `linear` (`INVLPG`).
+    pub fn invalidate_page(&self, linear: u64) {
+        self.tlb_mut().invalidate_page(linear);
+    }
+
+    /// Flush the whole TLB, global pages included.
+    pub fn flush_tlb(&self) {
+        self.tlb_mut().flush(false);
     }
 
     /// Translate a logical address (segment descriptor + offset) to a physical address.
@@ -398,7 +701,8 @@ impl Mmu {
     /// Translate a linear (virtual) address to a physical address via paging.
     ///
     /// If paging is disabled, the linear address is returned unchanged.
-    /// Otherwise, the appropriate page-table walker is invoked.
+    /// Otherwise the TLB is consulted, and on a miss the appropriate
+    /// page-table walker is invoked and its result cached.
     ///
     /// # Parameters
     ///
@@ -419,6 +723,12 @@ impl Mmu {
         if !self.paging_enabled {
             return Ok(linear);
         }
-        walk_page_tables(linear, cr3, access, cpl, self, mem)
+        let tlb = self.tlb_mut();
+        if let Some(phys) = tlb.lookup(linear, cr3, access, cpl, self.wp, self.nxe) {
+            return Ok(phys);
+        }
+        let (phys, rights) = walk_page_tables(linear, cr3, access, cpl, self, mem)?;
+        tlb.insert(linear, phys, access, rights);
+        Ok(phys)
     }
 }
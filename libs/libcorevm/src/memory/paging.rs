@@ -14,10 +14,13 @@
 //!   huge pages, PDE bit 7 enables 2 MiB huge pages.
 //!
 //! The `walk_page_tables` function dispatches to the correct walker based
-//! on the `Mmu` configuration, which mirrors CR0/CR4/EFER state.
+//! on the `Mmu` configuration, which mirrors CR0/CR4/EFER state. Besides
+//! the physical address, a walk reports the page's effective rights for
+//! the [`Tlb`](super::tlb::Tlb).
 
 use crate::error::{Result, VmError};
 
+use super::tlb::{RIGHT_GLOBAL, RIGHT_LARGE, RIGHT_NX, RIGHT_USER, RIGHT_WRITE};
 use super::{AccessType, MemoryBus, Mmu};
 
 // ── PTE bit definitions ──
@@ -30,13 +33,16 @@ const PTE_RW: u64 = 1 << 1;
 const PTE_US: u64 = 1 << 2;
 /// Page size (huge page) in PDE/PDPTE.
 const PTE_PS: u64 = 1 << 7;
+/// Global page (leaf entries; honoured with CR4.PGE).
+const PTE_G: u64 = 1 << 8;
 /// No-execute (requires EFER.NXE=1).
 const PTE_NX: u64 = 1u64 << 63;
 
 /// Walk the guest page tables to translate a linear address to physical.
 ///
 /// Dispatches to the correct page table walker based on the current paging
-/// mode stored in `mmu`. Returns `VmError::PageFault` on access violations.
+/// mode stored in `mmu`. Returns the physical address and the page's
+/// effective `RIGHT_*` bits, or `VmError::PageFault` on access violations.
 ///
 /// # Parameters
 ///
@@ -53,7 +59,7 @@ pub fn walk_page_tables(
     cpl: u8,
     mmu: &Mmu,
     mem: &dyn MemoryBus,
-) -> Result<u64> {
+) -> Result<(u64, u8)> {
     if mmu.long_mode {
         walk_4level(linear, cr3, access, cpl, mmu, mem)
     } else if mmu.pae {
@@ -63,6 +69,40 @@ pub fn walk_page_tables(
     }
 }
 
+// ── Effective rights ──
+
+/// Rights of a walk before any entry is read.
+const ALL_RIGHTS: u8 = RIGHT_WRITE | RIGHT_USER;
+
+/// Narrow the rights of a walk by one of its entries.
+#[inline]
+fn narrow(rights: u8, pte: u64) -> u8 {
+    let mut r = rights;
+    if pte & PTE_RW == 0 {
+        r &= !RIGHT_WRITE;
+    }
+    if pte & PTE_US == 0 {
+        r &= !RIGHT_USER;
+    }
+    if pte & PTE_NX != 0 {
+        r |= RIGHT_NX;
+    }
+    r
+}
+
+/// Final rights of a walk ending at `leaf`.
+#[inline]
+fn leaf_rights(rights: u8, leaf: u64, large: bool, mmu: &Mmu) -> u8 {
+    let mut r = narrow(rights, leaf);
+    if mmu.pge && leaf & PTE_G != 0 {
+        r |= RIGHT_GLOBAL;
+    }
+    if large {
+        r |= RIGHT_LARGE;
+    }
+    r
+}
+
 // ── Permission check ──
 
 /// Check a page table entry for access violations.
@@ -152,7 +192,7 @@ fn walk_2level(
     cpl: u8,
     mmu: &Mmu,
     mem: &dyn MemoryBus,
-) -> Result<u64> {
+) -> Result<(u64, u8)> {
     let linear32 = linear as u32;
 
     // PD index: bits [31:22].
@@ -170,7 +210,7 @@ fn walk_2level(
         // the physical address in PSE-36, which we ignore for simplicity).
         let page_base = (pde & 0xFFC00000) as u64;
         let page_offset = (linear32 & 0x003FFFFF) as u64;
-        return Ok(page_base | page_offset);
+        return Ok((page_base | page_offset, leaf_rights(ALL_RIGHTS, pde, true, mmu)));
     }
 
     // PT index: bits [21:12].
@@ -184,7 +224,7 @@ fn walk_2level(
     // Physical address: PTE[31:12] || linear[11:0].
     let page_base = pte & 0xFFFFF000;
     let page_offset = (linear32 & 0xFFF) as u64;
-    Ok(page_base | page_offset)
+    Ok((page_base | page_offset, leaf_rights(narrow(ALL_RIGHTS, pde), pte, false, mmu)))
 }
 
 // ── PAE paging ──
@@ -202,7 +242,7 @@ fn walk_pae(
     cpl: u8,
     mmu: &Mmu,
     mem: &dyn MemoryBus,
-) -> Result<u64> {
+) -> Result<(u64, u8)> {
     let linear32 = linear as u32;
 
     // PDPT index: bits [31:30] (2 bits -> 4 entries).
@@ -231,7 +271,7 @@ fn walk_pae(
     if (pde & PTE_PS) != 0 {
         let page_base = pde & 0x000FFFFF_FFE00000;
         let page_offset = (linear32 & 0x001FFFFF) as u64;
-        return Ok(page_base | page_offset);
+        return Ok((page_base | page_offset, leaf_rights(ALL_RIGHTS, pde, true, mmu)));
     }
 
     // PT index: bits [20:12] (9 bits -> 512 entries).
@@ -245,7 +285,7 @@ fn walk_pae(
     // Physical address: PTE[51:12] || linear[11:0].
     let page_base = pte & 0x000FFFFF_FFFFF000;
     let page_offset = (linear32 & 0xFFF) as u64;
-    Ok(page_base | page_offset)
+    Ok((page_base | page_offset, leaf_rights(narrow(ALL_RIGHTS, pde), pte, false, mmu)))
 }
 
 // ── 4-level (IA-32e / long mode) paging ──
@@ -270,7 +310,7 @@ fn walk_4level(
     cpl: u8,
     mmu: &Mmu,
     mem: &dyn MemoryBus,
-) -> Result<u64> {
+) -> Result<(u64, u8)> {
     // ── PML4 ──
     let pml4_index = (linear >> 39) & 0x1FF;
     let pml4_base = cr3 & 0x000FFFFF_FFFFF000;
@@ -278,6 +318,7 @@ fn walk_4level(
     let pml4e = mem.read_u64(pml4e_addr)?;
 
     check_pte(pml4e, access, cpl, linear, mmu.wp, mmu.nxe)?;
+    let rights = narrow(ALL_RIGHTS, pml4e);
 
     // ── PDPT ──
     let pdpt_index = (linear >> 30) & 0x1FF;
@@ -291,8 +332,9 @@ fn walk_4level(
     if (pdpte & PTE_PS) != 0 {
         let page_base = pdpte & 0x000FFFFF_C0000000;
         let page_offset = linear & 0x3FFFFFFF;
-        return Ok(page_base | page_offset);
+        return Ok((page_base | page_offset, leaf_rights(rights, pdpte, true, mmu)));
     }
+    let rights = narrow(rights, pdpte);
 
     // ── PD ──
     let pd_index = (linear >> 21) & 0x1FF;
@@ -306,8 +348,9 @@ fn walk_4level(
     if (pde & PTE_PS) != 0 {
         let page_base = pde & 0x000FFFFF_FFE00000;
         let page_offset = linear & 0x1FFFFF;
-        return Ok(page_base | page_offset);
+        return Ok((page_base | page_offset, leaf_rights(rights, pde, true, mmu)));
     }
+    let rights = narrow(rights, pde);
 
     // ── PT ──
     let pt_index = (linear >> 12) & 0x1FF;
@@ -320,5 +363,5 @@ fn walk_4level(
     // Physical address: PTE[51:12] || linear[11:0].
     let page_base = pte & 0x000FFFFF_FFFFF000;
     let page_offset = linear & 0xFFF;
-    Ok(page_base | page_offset)
+    Ok((page_base | page_offset, leaf_rights(rights, pte, false, mmu)))
 }
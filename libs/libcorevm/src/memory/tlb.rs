@@ -0,0 +1,174 @@
+//! Software TLB for guest paging.
+//!
+//! Caches the result of successful page table walks so that repeated
+//! accesses to the same page skip the 2-4 page table reads of a walk.
+//! There are two direct-mapped tables, one for instruction fetches and one
+//! for data accesses, each indexed by the low bits of the linear page
+//! number. An entry maps one 4 KiB linear page to its physical page and
+//! records the page's effective rights (writable, user, no-execute) as
+//! seen through every level of the walk, so a hit is re-checked against
+//! the current access and CPL and anything the rights do not allow falls
+//! back to a full walk, which raises the `#PF`.
+//!
+//! Only successful translations are cached, so a guest making a page
+//! present needs no flush, as on hardware. Everything else follows the
+//! architectural rules a guest already obeys for the real TLB:
+//!
+//! - A CR3 write flushes every entry except global ones (PTE.G with
+//!   CR4.PGE set).
+//! - `INVLPG` drops the entries for one page, global or not.
+//! - Changes to the paging bits of CR0, CR4 or EFER flush everything.
+//!
+//! Huge pages are cached one 4 KiB piece at a time; if any are cached,
+//! `INVLPG` flushes the whole TLB rather than hunting for the pieces.
+
+use alloc::vec;
+use alloc::vec::Vec;
+
+use super::AccessType;
+
+/// Entries in each table (a power of two).
+const ENTRIES: usize = 512;
+
+/// Tag of an empty entry (no linear page number is this large).
+const EMPTY: u64 = u64::MAX;
+
+/// Every level of the walk allows writes.
+pub const RIGHT_WRITE: u8 = 1 << 0;
+/// Every level of the walk allows user (CPL 3) access.
+pub const RIGHT_USER: u8 = 1 << 1;
+/// Some level of the walk has the NX bit set.
+pub const RIGHT_NX: u8 = 1 << 2;
+/// The leaf entry is global (and CR4.PGE is set).
+pub const RIGHT_GLOBAL: u8 = 1 << 3;
+/// The page is a 2 MiB / 4 MiB / 1 GiB huge page.
+pub const RIGHT_LARGE: u8 = 1 << 4;
+
+#[derive(Clone, Copy)]
+struct Entry {
+    /// Linear page number, or `EMPTY`.
+    tag: u64,
+    /// Physical address of the page.
+    phys: u64,
+    /// `RIGHT_*` bits.
+    rights: u8,
+}
+
+const EMPTY_ENTRY: Entry = Entry { tag: EMPTY, phys: 0, rights: 0 };
+
+/// Instruction and data TLBs.
+pub struct Tlb {
+    itlb: Vec<Entry>,
+    dtlb: Vec<Entry>,
+    /// CR3 the entries were filled under.
+    cr3: u64,
+    /// Whether any cached entry comes from a huge page.
+    has_large: bool,
+}
+
+#[inline]
+fn slot(page: u64) -> usize {
+    page as usize & (ENTRIES - 1)
+}
+
+/// Whether a page with `rights` allows `access` at `cpl`.
+#[inline]
+fn allows(rights: u8, access: AccessType, cpl: u8, wp: bool, nxe: bool) -> bool {
+    let user = cpl == 3;
+    if user && rights & RIGHT_USER == 0 {
+        return false;
+    }
+    match access {
+        AccessType::Read => true,
+        // Supervisor writes to read-only pages only fault with CR0.WP.
+        AccessType::Write => rights & RIGHT_WRITE != 0 || (!user && !wp),
+        AccessType::Execute => !(nxe && rights & RIGHT_NX != 0),
+    }
+}
+
+impl Tlb {
+    pub fn new() -> Self {
+        Tlb {
+            itlb: vec![EMPTY_ENTRY; ENTRIES],
+            dtlb: vec![EMPTY_ENTRY; ENTRIES],
+            cr3: 0,
+            has_large: false,
+        }
+    }
+
+    #[inline]
+    fn table(&mut self, access: AccessType) -> &mut Vec<Entry> {
+        if access == AccessType::Execute { &mut self.itlb } else { &mut self.dtlb }
+    }
+
+    /// Physical address of `linear` if its page is cached under `cr3` with
+    /// rights that allow `access` at `cpl`.
+    #[inline]
+    pub fn lookup(
+        &mut self,
+        linear: u64,
+        cr3: u64,
+        access: AccessType,
+        cpl: u8,
+        wp: bool,
+        nxe: bool,
+    ) -> Option<u64> {
+        if cr3 != self.cr3 {
+            // CR3 changed without a `load_cr3` (e.g. a host-side register
+            // write); treat it like a guest CR3 load.
+            self.load_cr3(cr3);
+            return None;
+        }
+        let page = linear >> 12;
+        let e = self.table(access)[slot(page)];
+        if e.tag == page && allows(e.rights, access, cpl, wp, nxe) {
+            Some(e.phys | (linear & 0xFFF))
+        } else {
+            None
+        }
+    }
+
+    /// Cache the translation of `linear` to `phys` made by a walk for
+    /// `access`, with the page's effective `rights`.
+    #[inline]
+    pub fn insert(&mut self, linear: u64, phys: u64, access: AccessType, rights: u8) {
+        let page = linear >> 12;
+        if rights & RIGHT_LARGE != 0 {
+            self.has_large = true;
+        }
+        self.table(access)[slot(page)] = Entry { tag: page, phys: phys & !0xFFF, rights };
+    }
+
+    /// Drop every non-global entry for a load of `cr3`.
+    pub fn load_cr3(&mut self, cr3: u64) {
+        self.flush(true);
+        self.cr3 = cr3;
+    }
+
+    /// Drop every entry, keeping global ones if `keep_global`.
+    pub fn flush(&mut self, keep_global: bool) {
+        for e in self.itlb.iter_mut().chain(self.dtlb.iter_mut()) {
+            if !keep_global || e.rights & RIGHT_GLOBAL == 0 {
+                *e = EMPTY_ENTRY;
+            }
+        }
+        if !keep_global {
+            self.has_large = false;
+        }
+    }
+
+    /// Drop the entries for the page containing `linear` (`INVLPG`).
+    pub fn invalidate_page(&mut self, linear: u64) {
+        if self.has_large {
+            self.flush(false);
+            return;
+        }
+        let page = linear >> 12;
+        for table in [&mut self.itlb, &mut self.dtlb] {
+            let e = &mut table[slot(page)];
+            if e.tag == page {
+                *e = EMPTY_ENTRY;
+            }
+        }
+    }
+}
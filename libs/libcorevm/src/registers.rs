@@ -5,7 +5,7 @@
 //! registers, and model-specific registers (MSRs).
 
 use alloc::collections::BTreeMap;
-use crate::flags::OperandSize;
+use crate::flags::{self, FlagOp, LazyFlags, OperandSize};
 
 /// General-purpose register indices matching x86 encoding.
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -187,9 +187,13 @@ pub struct RegisterFile {
     /// Instruction pointer.
     pub rip: u64,
 
-    /// RFLAGS register.
+    /// RFLAGS register. Its arithmetic bits are stale while `lazy` is
+    /// pending; see [`flags`](Self::flags).
     pub rflags: u64,
 
+    /// Deferred arithmetic flags of the last ADD/SUB/logic/INC/DEC.
+    pub lazy: LazyFlags,
+
     /// Segment registers (visible selector + hidden cached descriptor).
     pub seg: [SegmentDescriptor; 6],
 
@@ -318,6 +322,7 @@ impl RegisterFile {
             gpr: [0u64; 16],
             rip: 0xFFF0,
             rflags: crate::flags::RFLAGS_FIXED,
+            lazy: LazyFlags::new(),
             seg: [
                 SegmentDescriptor::real_mode(0),      // ES
                 SegmentDescriptor::real_mode_code(0xF000), // CS
@@ -442,6 +447,57 @@ impl RegisterFile {
         }
     }
 
+    // ── Flags ──
+
+    /// RFLAGS with any deferred arithmetic flags folded in.
+    #[inline]
+    pub fn flags(&self) -> u64 {
+        if self.lazy.is_pending() {
+            (self.rflags & !flags::ARITH_MASK) | self.lazy.arith_flags()
+        } else {
+            self.rflags
+        }
+    }
+
+    /// Fold deferred arithmetic flags into `rflags`.
+    ///
+    /// Must run before anything reads or writes the arithmetic bits of
+    /// `rflags` directly; the CPU does it before every instruction that is
+    /// not known to go through the lazy accessors below.
+    #[inline]
+    pub fn materialize_flags(&mut self) {
+        if self.lazy.is_pending() {
+            self.rflags = self.flags();
+            self.lazy.op = FlagOp::None;
+        }
+    }
+
+    /// Defer the arithmetic flags of `op` (replacing all six flags).
+    #[inline]
+    pub fn set_lazy_flags(&mut self, op: FlagOp, op1: u64, op2: u64, result: u64, size: OperandSize) {
+        self.lazy.record(op, op1, op2, result, size);
+    }
+
+    /// Current CF.
+    #[inline]
+    pub fn carry(&self) -> bool {
+        if self.lazy.is_pending() {
+            self.lazy.carry()
+        } else {
+            self.rflags & flags::CF != 0
+        }
+    }
+
+    /// Evaluate condition code `cc` (0-15) against the current flags.
+    #[inline]
+    pub fn eval_cc(&self, cc: u8) -> bool {
+        if self.lazy.is_pending() {
+            self.lazy.eval_cc(cc)
+        } else {
+            flags::eval_cc(cc, self.rflags)
+        }
+    }
+
     // ── MSR access ──
 
     /// Read an MSR. Returns 0 for undefined MSRs.
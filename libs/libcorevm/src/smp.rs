@@ -0,0 +1,324 @@
+//! Multi-processor guests.
+//!
+//! An SMP VM has one [`Cpu`] per vCPU over the shared [`GuestMemory`] and
+//! I/O dispatch. The bootstrap processor is the engine's own `cpu`, so
+//! every single-CPU interface keeps addressing it; the application
+//! processors live in [`Smp::aps`], each with its own MMU (and TLB) and
+//! interrupt controller, and start in wait-for-SIPI state.
+//!
+//! The vCPUs are interleaved on the calling thread in slices of
+//! [`SLICE`] instructions. Device models, the MMIO dispatch and code-write
+//! tracking all rely on the emulator being single-threaded, and vCPUs only
+//! switch at instruction boundaries, so `LOCK`-prefixed instructions and
+//! `XCHG` are atomic with respect to the other vCPUs without further work.
+//!
+//! Legacy PIC interrupts go to the bootstrap processor (virtual wire
+//! mode); IPIs and local APIC timer interrupts reach any vCPU through the
+//! [`ApicBus`].
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+
+use crate::cpu::{Cpu, ExitReason};
+use crate::error::{Result, VmError};
+use crate::devices::lapic::{ApicBus, APIC_BASE_BSP, APIC_BASE_ENABLE, LAPIC_BASE, MSR_APIC_BASE};
+use crate::interrupts::InterruptController;
+use crate::io::IoDispatch;
+use crate::memory::{GuestMemory, Mmu};
+use crate::registers::SegReg;
+use crate::snapshot::{Snapshot, StateReader, StateWriter};
+
+/// Most vCPUs a VM can have.
+pub const MAX_VCPUS: usize = 16;
+
+/// Instructions a vCPU runs before the next one gets its turn.
+///
+/// Short enough that a vCPU spinning on a lock held by another one hands
+/// over quickly, long enough that the switch cost stays small.
+pub const SLICE: u64 = 2000;
+
+/// Execution state of an application processor.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum VcpuState {
+    /// Reset by INIT, waiting for a startup IPI.
+    WaitForSipi,
+    /// Executing instructions.
+    Running,
+    /// Stopped by HLT until an interrupt arrives.
+    Halted,
+    /// Stopped for good by an unrecoverable exception.
+    Shutdown,
+}
+
+/// An application processor.
+pub struct Vcpu {
+    pub cpu: Cpu,
+    pub mmu: Mmu,
+    pub interrupts: InterruptController,
+    pub state: VcpuState,
+}
+
+impl Vcpu {
+    /// Handle INIT: reset to wait-for-SIPI state as vCPU `index` of `count`.
+    fn init(&mut self, index: usize, count: usize) {
+        self.cpu.reset();
+        set_apic_identity(&mut self.cpu, index, count);
+        self.mmu = Mmu::new();
+        self.interrupts = InterruptController::new();
+        self.state = VcpuState::WaitForSipi;
+    }
+}
+
+/// Application processors and the local APICs of an SMP VM.
+pub struct Smp {
+    /// Application processors; vCPU `i + 1` (APIC ID `i + 1`) is `aps[i]`.
+    pub aps: Vec<Vcpu>,
+    /// Local APICs (owned), also registered as the MMIO handler at
+    /// `LAPIC_BASE` through [`apic_ptr`](Self::apic_ptr).
+    apic: *mut ApicBus,
+}
+
+/// Program the local APIC identity of `cpu` as vCPU `index`.
+fn set_apic_identity(cpu: &mut Cpu, index: usize, count: usize) {
+    cpu.apic_id = index as u8;
+    cpu.apic_cpus = count as u8;
+    let bsp = if index == 0 { APIC_BASE_BSP } else { 0 };
+    cpu.regs.write_msr(MSR_APIC_BASE, LAPIC_BASE | APIC_BASE_ENABLE | bsp);
+}
+
+impl Smp {
+    /// Create the local APICs and the `count - 1` application processors
+    /// of a `count`-vCPU VM. `bsp` is the bootstrap processor, which gets
+    /// APIC ID 0.
+    pub fn new(count: usize, bsp: &mut Cpu) -> Self {
+        let apic = Box::into_raw(Box::new(ApicBus::new(count)));
+        set_apic_identity(bsp, 0, count);
+        let aps = (1..count)
+            .map(|i| {
+                let mut cpu = Cpu::new();
+                set_apic_identity(&mut cpu, i, count);
+                Vcpu {
+                    cpu,
+                    mmu: Mmu::new(),
+                    interrupts: InterruptController::new(),
+                    state: VcpuState::WaitForSipi,
+                }
+            })
+            .collect();
+        Smp { aps, apic }
+    }
+
+    /// The local APICs, for registering them in the MMIO dispatch. Valid
+    /// for the life of the `Smp`.
+    pub fn apic_ptr(&self) -> *mut ApicBus {
+        self.apic
+    }
+
+    fn apic(&mut self) -> &mut ApicBus {
+        // Safety: owned by `self`; the emulator is single-threaded.
+        unsafe { &mut *self.apic }
+    }
+
+    /// Put every application processor back in wait-for-SIPI state.
+    pub fn reset(&mut self, bsp: &mut Cpu) {
+        let count = self.aps.len() + 1;
+        set_apic_identity(bsp, 0, count);
+        for (i, ap) in self.aps.iter_mut().enumerate() {
+            ap.init(i + 1, count);
+        }
+        let apic = self.apic();
+        *apic = ApicBus::new(count);
+    }
+
+    /// Run the bootstrap processor for up to `max_instructions` (0 =
+    /// unlimited), interleaving the application processors with it.
+    ///
+    /// Returns when the bootstrap processor exits, like [`Cpu::run`]. If it
+    /// halted, the application processors keep running until the budget is
+    /// used up, an interrupt is waiting for the bootstrap processor, or
+    /// they have all stopped too.
+    pub fn run(
+        &mut self,
+        bsp: &mut Cpu,
+        memory: &mut GuestMemory,
+        mmu: &mut Mmu,
+        interrupts: &mut InterruptController,
+        io: &mut IoDispatch,
+        max_instructions: u64,
+    ) -> ExitReason {
+        let target = if max_instructions > 0 {
+            bsp.instruction_count.saturating_add(max_instructions)
+        } else {
+            0
+        };
+        loop {
+            let slice = if target > 0 {
+                SLICE.min(target.saturating_sub(bsp.instruction_count)).max(1)
+            } else {
+                SLICE
+            };
+            let events = self.apic().take_events(0);
+            raise_requested(&events.irr, interrupts);
+            self.apic().current = 0;
+            let before = bsp.instruction_count;
+            let exit = bsp.run(memory, mmu, interrupts, io, slice);
+            self.apic().apics[0].tick(bsp.instruction_count - before);
+            self.share_code_writes(bsp, memory);
+            let ap_budget = self.run_aps(bsp, memory, io, SLICE);
+
+            match exit {
+                ExitReason::InstructionLimit => {
+                    if target > 0 && bsp.instruction_count >= target {
+                        return exit;
+                    }
+                }
+                ExitReason::Halted => {
+                    let mut left = if target > 0 {
+                        target.saturating_sub(bsp.instruction_count)
+                    } else {
+                        u64::MAX
+                    };
+                    let mut ran = ap_budget;
+                    while ran > 0 && left > 0 {
+                        // One round of AP slices is one slice of time.
+                        let apic = self.apic();
+                        apic.apics[0].tick(ran.min(SLICE));
+                        if apic.apics[0].events.irr.iter().any(|&w| w != 0) {
+                            break;
+                        }
+                        ran = self.run_aps(bsp, memory, io, SLICE.min(left));
+                        left = left.saturating_sub(ran);
+                    }
+                    return exit;
+                }
+                _ => return exit,
+            }
+        }
+    }
+
+    /// Give each application processor one slice of `slice` instructions.
+    /// Returns the number of instructions they executed in total.
+    fn run_aps(
+        &mut self,
+        bsp: &mut Cpu,
+        memory: &mut GuestMemory,
+        io: &mut IoDispatch,
+        slice: u64,
+    ) -> u64 {
+        let count = self.aps.len() + 1;
+        let mut total = 0;
+        for i in 0..self.aps.len() {
+            // Safety: see `apic`; it does not alias `self.aps`.
+            let apic = unsafe { &mut *self.apic };
+            let events = apic.take_events(i + 1);
+            let ap = &mut self.aps[i];
+            if events.init {
+                ap.init(i + 1, count);
+            }
+            if let Some(vector) = events.sipi {
+                if ap.state == VcpuState::WaitForSipi {
+                    ap.cpu.regs.load_segment_real(SegReg::Cs, (vector as u16) << 8);
+                    ap.cpu.regs.rip = 0;
+                    ap.state = VcpuState::Running;
+                }
+            }
+            if ap.state == VcpuState::Halted {
+                // Time passes for a halted vCPU too: its timer may wake it.
+                apic.apics[i + 1].tick(slice);
+                let late = apic.take_events(i + 1);
+                raise_requested(&late.irr, &mut ap.interrupts);
+            }
+            raise_requested(&events.irr, &mut ap.interrupts);
+            if ap.state == VcpuState::Halted
+                && ap.interrupts.pending_interrupt(ap.cpu.regs.rflags).is_some()
+            {
+                ap.state = VcpuState::Running;
+            }
+            if ap.state != VcpuState::Running {
+                continue;
+            }
+
+            apic.current = i + 1;
+            let before = ap.cpu.instruction_count;
+            let exit = ap.cpu.run(memory, &mut ap.mmu, &mut ap.interrupts, io, slice);
+            let ran = ap.cpu.instruction_count - before;
+            apic.apics[i + 1].tick(ran);
+            apic.current = 0;
+            total += ran;
+            match exit {
+                ExitReason::Halted => ap.state = VcpuState::Halted,
+                ExitReason::Exception(_) => ap.state = VcpuState::Shutdown,
+                _ => {}
+            }
+            self.share_code_writes(bsp, memory);
+        }
+        total
+    }
+
+    /// Drop the blocks on code pages written during the last slice from
+    /// every vCPU's cache, not just the one that noticed the write.
+    fn share_code_writes(&mut self, bsp: &mut Cpu, memory: &mut GuestMemory) {
+        let pages = memory.take_shared_code_writes();
+        if pages.is_empty() {
+            return;
+        }
+        bsp.icache.invalidate_pages(&pages);
+        for ap in &mut self.aps {
+            ap.cpu.icache.invalidate_pages(&pages);
+        }
+    }
+}
+
+impl Snapshot for Smp {
+    /// The application processors and all local APICs. The bootstrap
+    /// processor is saved with the engine's own CPU.
+    fn save(&self, w: &mut StateWriter) {
+        w.u32(self.aps.len() as u32);
+        for ap in &self.aps {
+            ap.cpu.save(w);
+            ap.interrupts.save(w);
+            w.u8(ap.state as u8);
+        }
+        // Safety: see `apic`.
+        unsafe { &*self.apic }.save(w);
+    }
+
+    fn load(&mut self, r: &mut StateReader) -> Result<()> {
+        if r.u32()? as usize != self.aps.len() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        for ap in self.aps.iter_mut() {
+            ap.cpu.load(r)?;
+            ap.interrupts.load(r)?;
+            ap.mmu = Mmu::new();
+            ap.state = match r.u8()? {
+                0 => VcpuState::WaitForSipi,
+                1 => VcpuState::Running,
+                2 => VcpuState::Halted,
+                3 => VcpuState::Shutdown,
+                _ => return Err(VmError::InvalidSnapshot),
+            };
+        }
+        self.apic().load(r)
+    }
+}
+
+impl Drop for Smp {
+    fn drop(&mut self) {
+        // The MMIO proxy holding the pointer never dereferences it on drop.
+        unsafe {
+            let _ = Box::from_raw(self.apic);
+        }
+    }
+}
+
+/// Raise every vector set in a 256-bit request bitmap.
+fn raise_requested(irr: &[u64; 4], interrupts: &mut InterruptController) {
+    for (word, &bits) in irr.iter().enumerate() {
+        let mut bits = bits;
+        while bits != 0 {
+            interrupts.raise_irq((word * 64) as u8 + bits.trailing_zeros() as u8);
+            bits &= bits - 1;
+        }
+    }
+}
@@ -0,0 +1,566 @@
+//! VM snapshots: saved CPU and device state plus guest RAM.
+//!
+//! A snapshot file starts with a 4 KiB header, followed by the state
+//! section and then the RAM pages:
+//!
+//! | Offset         | Contents                                            |
+//! |----------------|-----------------------------------------------------|
+//! | 0              | [`Header`] (magic, sizes, section offsets, parent)  |
+//! | 4096           | state section: tagged records from [`StateWriter`] |
+//! | `index_offset` | page numbers (`u32` each), incremental only         |
+//! | `pages_offset` | page data, 4 KiB aligned                            |
+//!
+//! A **full** snapshot stores all of RAM densely, so restoring it maps
+//! the page data privately with `mmap_file` instead of reading it: the
+//! guest faults its RAM in from the file on first touch, and its writes
+//! are copy-on-write and never reach the file.
+//!
+//! An **incremental** snapshot stores only the pages written since the
+//! previous snapshot (see the dirty bitmap in [`FlatMemory`]) and names
+//! that snapshot as its parent. Restoring it restores the parent chain
+//! down to the full snapshot at its root, then applies the pages of each
+//! incremental on top.
+//!
+//! The state section is a sequence of records: a four-byte tag, a `u32`
+//! length and the encoding of one component's [`Snapshot::save`]. Loading
+//! dispatches each record by tag, so a component that saves nothing is
+//! simply absent. All integers are little-endian.
+
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::error::{Result, VmError};
+use crate::memory::flat::FlatMemory;
+use crate::memory::PAGE_SIZE;
+
+/// First eight bytes of every snapshot file.
+pub const MAGIC: [u8; 8] = *b"CVMSNAP\0";
+/// Format version written by this library.
+pub const VERSION: u32 = 1;
+/// Header flag: the file holds only the pages dirtied since its parent.
+pub const FLAG_INCREMENTAL: u32 = 1 << 0;
+/// Size of the file header (one page, so the sections stay aligned).
+pub const HEADER_SIZE: usize = 4096;
+/// Longest parent path the header holds.
+pub const MAX_PATH: usize = 256;
+/// Longest parent chain a restore follows (guards against cycles).
+pub const MAX_CHAIN: usize = 64;
+
+const PAGE: usize = PAGE_SIZE as usize;
+
+/// Bytes moved per `read`/`write` syscall.
+const IO_CHUNK: usize = 1 << 20;
+
+// ── Snapshot trait ──
+
+/// State that can be saved into and restored from a snapshot.
+///
+/// `load` reads exactly what `save` wrote. It returns
+/// [`VmError::InvalidSnapshot`] if the record is truncated or holds a
+/// value the component cannot take; the component may then be left
+/// partially restored.
+pub trait Snapshot {
+    /// Append this component's state to `w`.
+    fn save(&self, w: &mut StateWriter);
+    /// Replace this component's state with the one read from `r`.
+    fn load(&mut self, r: &mut StateReader) -> Result<()>;
+}
+
+// ── StateWriter ──
+
+/// Little-endian encoder for the state section.
+pub struct StateWriter {
+    buf: Vec<u8>,
+}
+
+impl StateWriter {
+    /// Create an empty writer.
+    pub fn new() -> Self {
+        StateWriter { buf: Vec::new() }
+    }
+
+    /// The bytes written so far.
+    pub fn as_bytes(&self) -> &[u8] {
+        &self.buf
+    }
+
+    pub fn u8(&mut self, v: u8) {
+        self.buf.push(v);
+    }
+
+    pub fn bool(&mut self, v: bool) {
+        self.buf.push(v as u8);
+    }
+
+    pub fn u16(&mut self, v: u16) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    pub fn u32(&mut self, v: u32) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    pub fn u64(&mut self, v: u64) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    /// Write `data` as is; the reader must know its length.
+    pub fn bytes(&mut self, data: &[u8]) {
+        self.buf.extend_from_slice(data);
+    }
+
+    /// Write `data` preceded by its `u32` length.
+    pub fn blob(&mut self, data: &[u8]) {
+        self.u32(data.len() as u32);
+        self.bytes(data);
+    }
+
+    /// Write a record tagged `tag` holding `component`'s state.
+    pub fn record(&mut self, tag: [u8; 4], component: &dyn Snapshot) {
+        self.bytes(&tag);
+        let len_at = self.buf.len();
+        self.u32(0);
+        component.save(self);
+        let len = (self.buf.len() - len_at - 4) as u32;
+        self.buf[len_at..len_at + 4].copy_from_slice(&len.to_le_bytes());
+    }
+}
+
+// ── StateReader ──
+
+/// Decoder for what a [`StateWriter`] wrote.
+pub struct StateReader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> StateReader<'a> {
+    /// Read from `data`.
+    pub fn new(data: &'a [u8]) -> Self {
+        StateReader { data, pos: 0 }
+    }
+
+    /// Whether everything has been read.
+    pub fn is_empty(&self) -> bool {
+        self.pos == self.data.len()
+    }
+
+    /// Take the next `len` bytes.
+    pub fn bytes(&mut self, len: usize) -> Result<&'a [u8]> {
+        if self.data.len() - self.pos < len {
+            return Err(VmError::InvalidSnapshot);
+        }
+        let out = &self.data[self.pos..self.pos + len];
+        self.pos += len;
+        Ok(out)
+    }
+
+    /// Fill `out` with the next `out.len()` bytes.
+    pub fn fill(&mut self, out: &mut [u8]) -> Result<()> {
+        out.copy_from_slice(self.bytes(out.len())?);
+        Ok(())
+    }
+
+    pub fn u8(&mut self) -> Result<u8> {
+        Ok(self.bytes(1)?[0])
+    }
+
+    pub fn bool(&mut self) -> Result<bool> {
+        Ok(self.u8()? != 0)
+    }
+
+    pub fn u16(&mut self) -> Result<u16> {
+        let mut b = [0u8; 2];
+        self.fill(&mut b)?;
+        Ok(u16::from_le_bytes(b))
+    }
+
+    pub fn u32(&mut self) -> Result<u32> {
+        let mut b = [0u8; 4];
+        self.fill(&mut b)?;
+        Ok(u32::from_le_bytes(b))
+    }
+
+    pub fn u64(&mut self) -> Result<u64> {
+        let mut b = [0u8; 8];
+        self.fill(&mut b)?;
+        Ok(u64::from_le_bytes(b))
+    }
+
+    /// Read a length-prefixed blob written by [`StateWriter::blob`].
+    pub fn blob(&mut self) -> Result<&'a [u8]> {
+        let len = self.u32()? as usize;
+        self.bytes(len)
+    }
+
+    /// Read the next record: its tag and a reader over its contents.
+    pub fn record(&mut self) -> Result<([u8; 4], StateReader<'a>)> {
+        let mut tag = [0u8; 4];
+        self.fill(&mut tag)?;
+        let body = self.blob()?;
+        Ok((tag, StateReader::new(body)))
+    }
+}
+
+/// Check that a record was consumed exactly.
+pub fn expect_end(r: &StateReader) -> Result<()> {
+    if r.is_empty() { Ok(()) } else { Err(VmError::InvalidSnapshot) }
+}
+
+// ── File header ──
+
+/// Decoded snapshot file header.
+pub struct Header {
+    pub flags: u32,
+    /// Guest RAM size in bytes.
+    pub ram_size: u64,
+    /// RAM pages stored in the file.
+    pub page_count: u32,
+    pub state_len: u32,
+    pub index_offset: u32,
+    pub pages_offset: u32,
+    /// Snapshot the pages of an incremental one apply on top of.
+    pub parent: String,
+}
+
+impl Header {
+    fn encode(&self) -> Vec<u8> {
+        let mut out = vec![0u8; HEADER_SIZE];
+        out[0..8].copy_from_slice(&MAGIC);
+        out[8..12].copy_from_slice(&VERSION.to_le_bytes());
+        out[12..16].copy_from_slice(&self.flags.to_le_bytes());
+        out[16..24].copy_from_slice(&self.ram_size.to_le_bytes());
+        out[24..28].copy_from_slice(&self.page_count.to_le_bytes());
+        out[28..32].copy_from_slice(&self.state_len.to_le_bytes());
+        out[32..36].copy_from_slice(&self.index_offset.to_le_bytes());
+        out[36..40].copy_from_slice(&self.pages_offset.to_le_bytes());
+        let parent = self.parent.as_bytes();
+        out[40..42].copy_from_slice(&(parent.len() as u16).to_le_bytes());
+        out[64..64 + parent.len()].copy_from_slice(parent);
+        out
+    }
+
+    fn decode(raw: &[u8]) -> Result<Header> {
+        let u32_at = |o: usize| u32::from_le_bytes([raw[o], raw[o + 1], raw[o + 2], raw[o + 3]]);
+        if raw.len() < HEADER_SIZE || raw[0..8] != MAGIC || u32_at(8) != VERSION {
+            return Err(VmError::InvalidSnapshot);
+        }
+        let parent_len = u16::from_le_bytes([raw[40], raw[41]]) as usize;
+        if parent_len > MAX_PATH {
+            return Err(VmError::InvalidSnapshot);
+        }
+        let parent = core::str::from_utf8(&raw[64..64 + parent_len])
+            .map_err(|_| VmError::InvalidSnapshot)?;
+        Ok(Header {
+            flags: u32_at(12),
+            ram_size: u64::from_le_bytes(raw[16..24].try_into().unwrap()),
+            page_count: u32_at(24),
+            state_len: u32_at(28),
+            index_offset: u32_at(32),
+            pages_offset: u32_at(36),
+            parent: String::from(parent),
+        })
+    }
+
+    fn incremental(&self) -> bool {
+        self.flags & FLAG_INCREMENTAL != 0
+    }
+}
+
+fn align_page(n: usize) -> usize {
+    (n + PAGE - 1) & !(PAGE - 1)
+}
+
+// ── File I/O ──
+
+/// An open snapshot file, closed on drop.
+struct File(u32);
+
+impl File {
+    fn open(path: &str, flags: u32) -> Result<File> {
+        let fd = libsyscall::open(path, flags);
+        if fd == u32::MAX { Err(VmError::InvalidSnapshot) } else { Ok(File(fd)) }
+    }
+
+    fn write_all(&self, mut data: &[u8]) -> Result<()> {
+        while !data.is_empty() {
+            let n = libsyscall::write(self.0, &data[..data.len().min(IO_CHUNK)]);
+            if n == u32::MAX || n == 0 {
+                return Err(VmError::InvalidSnapshot);
+            }
+            data = &data[n as usize..];
+        }
+        Ok(())
+    }
+
+    fn read_exact(&self, mut out: &mut [u8]) -> Result<()> {
+        while !out.is_empty() {
+            let len = out.len().min(IO_CHUNK);
+            let n = libsyscall::read(self.0, &mut out[..len]);
+            if n == u32::MAX || n == 0 {
+                return Err(VmError::InvalidSnapshot);
+            }
+            out = &mut out[n as usize..];
+        }
+        Ok(())
+    }
+
+    fn seek(&self, offset: usize) -> Result<()> {
+        if offset > i32::MAX as usize
+            || libsyscall::lseek(self.0, offset as i32, libsyscall::SEEK_SET) == u32::MAX
+        {
+            return Err(VmError::InvalidSnapshot);
+        }
+        Ok(())
+    }
+
+    /// Give up ownership of the descriptor.
+    fn into_raw(self) -> u32 {
+        let fd = self.0;
+        core::mem::forget(self);
+        fd
+    }
+}
+
+impl Drop for File {
+    fn drop(&mut self) {
+        libsyscall::close(self.0);
+    }
+}
+
+// ── Save ──
+
+/// Write a snapshot of `ram` and the encoded device `state` to `path`.
+///
+/// With a `parent`, only the pages `ram` marks dirty are written and the
+/// file is an incremental snapshot on top of `parent`; otherwise all of
+/// RAM is. On success the dirty bitmap is cleared, so the next
+/// incremental snapshot holds the changes made after this one.
+pub fn save(path: &str, ram: &mut FlatMemory, state: &[u8], parent: Option<&str>) -> Result<()> {
+    let pages = align_page(ram.size()) / PAGE;
+    let index: Vec<u32> = match parent {
+        Some(_) => (0..pages).filter(|&p| ram.is_dirty(p)).map(|p| p as u32).collect(),
+        None => Vec::new(),
+    };
+    let parent = parent.unwrap_or("");
+    if parent.len() > MAX_PATH {
+        return Err(VmError::InvalidSnapshot);
+    }
+
+    let index_offset = HEADER_SIZE + state.len();
+    let pages_offset = align_page(index_offset + index.len() * 4);
+    if pages_offset > u32::MAX as usize {
+        return Err(VmError::InvalidSnapshot);
+    }
+    let header = Header {
+        flags: if parent.is_empty() { 0 } else { FLAG_INCREMENTAL },
+        ram_size: ram.size() as u64,
+        page_count: if parent.is_empty() { pages as u32 } else { index.len() as u32 },
+        state_len: state.len() as u32,
+        index_offset: index_offset as u32,
+        pages_offset: pages_offset as u32,
+        parent: String::from(parent),
+    };
+
+    let file = File::open(
+        path,
+        libsyscall::O_WRITE | libsyscall::O_CREATE | libsyscall::O_TRUNC,
+    )?;
+    file.write_all(&header.encode())?;
+    file.write_all(state)?;
+    let mut meta = Vec::with_capacity(pages_offset - index_offset);
+    for &page in &index {
+        meta.extend_from_slice(&page.to_le_bytes());
+    }
+    meta.resize(pages_offset - index_offset, 0);
+    file.write_all(&meta)?;
+
+    let data = ram.as_slice();
+    if header.incremental() {
+        // Write runs of consecutive dirty pages with one call each.
+        let mut i = 0;
+        while i < index.len() {
+            let first = index[i] as usize;
+            let mut last = first;
+            while i + 1 < index.len() && index[i + 1] as usize == last + 1 {
+                i += 1;
+                last += 1;
+            }
+            let end = ((last + 1) * PAGE).min(data.len());
+            file.write_all(&data[first * PAGE..end])?;
+            // A partial last page is padded so every stored page is whole.
+            if end - first * PAGE < (last - first + 1) * PAGE {
+                file.write_all(&vec![0u8; (last - first + 1) * PAGE - (end - first * PAGE)])?;
+            }
+            i += 1;
+        }
+    } else {
+        file.write_all(data)?;
+    }
+    if libsyscall::fsync(file.0) == u32::MAX {
+        return Err(VmError::InvalidSnapshot);
+    }
+    ram.clear_dirty();
+    Ok(())
+}
+
+// ── Restore ──
+
+/// Guest RAM and device state read back from a snapshot.
+pub struct Restored {
+    /// RAM as of the snapshot, with no pages marked dirty.
+    pub ram: FlatMemory,
+    /// The state section of the newest snapshot in the chain.
+    pub state: Vec<u8>,
+    /// The files read, oldest (the full snapshot) first.
+    pub chain: Vec<String>,
+}
+
+fn read_header(file: &File) -> Result<Header> {
+    let mut raw = vec![0u8; HEADER_SIZE];
+    file.read_exact(&mut raw)?;
+    Header::decode(&raw)
+}
+
+/// Restore the snapshot at `path`, following its parent chain.
+///
+/// The RAM of the full snapshot at the root of the chain is mapped
+/// copy-on-write from its file (read into memory instead if it cannot be
+/// mapped), so only the pages the guest touches are ever read.
+pub fn restore(path: &str) -> Result<Restored> {
+    // Walk up to the full snapshot first.
+    let mut chain: Vec<String> = vec![String::from(path)];
+    let mut headers = Vec::new();
+    loop {
+        let file = File::open(chain.last().unwrap(), 0)?;
+        let header = read_header(&file)?;
+        if let Some(first) = headers.first() {
+            let first: &Header = first;
+            if header.ram_size != first.ram_size {
+                return Err(VmError::InvalidSnapshot);
+            }
+        }
+        let parent = header.parent.clone();
+        let incremental = header.incremental();
+        headers.push(header);
+        if !incremental {
+            break;
+        }
+        if chain.len() == MAX_CHAIN || parent.is_empty() {
+            return Err(VmError::InvalidSnapshot);
+        }
+        chain.push(parent);
+    }
+    chain.reverse();
+    headers.reverse();
+
+    let base = &headers[0];
+    let size = base.ram_size as usize;
+    if size > u32::MAX as usize || base.page_count as usize != align_page(size) / PAGE {
+        return Err(VmError::InvalidSnapshot);
+    }
+    let mut ram = map_ram(&chain[0], base)?;
+
+    for (file_path, header) in chain.iter().zip(headers.iter()).skip(1) {
+        let file = File::open(file_path, 0)?;
+        file.seek(header.index_offset as usize)?;
+        let mut raw = vec![0u8; header.page_count as usize * 4];
+        file.read_exact(&mut raw)?;
+        file.seek(header.pages_offset as usize)?;
+        let mut page = vec![0u8; PAGE];
+        for entry in raw.chunks_exact(4) {
+            let offset = u32::from_le_bytes([entry[0], entry[1], entry[2], entry[3]]) as usize * PAGE;
+            if offset >= size {
+                return Err(VmError::InvalidSnapshot);
+            }
+            file.read_exact(&mut page)?;
+            let len = PAGE.min(size - offset);
+            ram.slice_mut(offset, len).copy_from_slice(&page[..len]);
+        }
+    }
+    ram.clear_dirty();
+
+    let newest = headers.last().unwrap();
+    let file = File::open(chain.last().unwrap(), 0)?;
+    file.seek(HEADER_SIZE)?;
+    let mut state = vec![0u8; newest.state_len as usize];
+    file.read_exact(&mut state)?;
+    Ok(Restored { ram, state, chain })
+}
+
+/// Map (or, failing that, read) the dense RAM image of a full snapshot.
+fn map_ram(path: &str, header: &Header) -> Result<FlatMemory> {
+    let size = header.ram_size as usize;
+    let file = File::open(path, 0)?;
+    if size > 0 {
+        let addr = libsyscall::mmap_file(file.0, header.pages_offset, size as u32, 2, 2);
+        if addr != u64::MAX {
+            // Safety: a fresh private mapping of `size` bytes; the
+            // descriptor stays open for as long as it is mapped.
+            return Ok(unsafe { FlatMemory::from_mapping(addr, size, file.into_raw()) });
+        }
+    }
+    let mut ram = FlatMemory::new(size);
+    file.seek(header.pages_offset as usize)?;
+    file.read_exact(ram.slice_mut(0, size))?;
+    Ok(ram)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    struct Pair(u16, u64);
+
+    impl Snapshot for Pair {
+        fn save(&self, w: &mut StateWriter) {
+            w.u16(self.0);
+            w.u64(self.1);
+        }
+        fn load(&mut self, r: &mut StateReader) -> Result<()> {
+            self.0 = r.u16()?;
+            self.1 = r.u64()?;
+            Ok(())
+        }
+    }
+
+    #[test]
+    fn test_records_round_trip() {
+        let mut w = StateWriter::new();
+        w.record(*b"PAIR", &Pair(0x1234, 0xDEAD_BEEF_0000_0001));
+        w.record(*b"NEXT", &Pair(7, 8));
+
+        let mut r = StateReader::new(w.as_bytes());
+        let (tag, mut body) = r.record().unwrap();
+        assert_eq!(&tag, b"PAIR");
+        let mut p = Pair(0, 0);
+        p.load(&mut body).unwrap();
+        expect_end(&body).unwrap();
+        assert_eq!((p.0, p.1), (0x1234, 0xDEAD_BEEF_0000_0001));
+        let (tag, _) = r.record().unwrap();
+        assert_eq!(&tag, b"NEXT");
+        assert!(r.is_empty());
+        assert_eq!(r.record().err(), Some(VmError::InvalidSnapshot));
+    }
+
+    #[test]
+    fn test_header_round_trip() {
+        let header = Header {
+            flags: FLAG_INCREMENTAL,
+            ram_size: 1 << 20,
+            page_count: 3,
+            state_len: 100,
+            index_offset: 4196,
+            pages_offset: 8192,
+            parent: String::from("/tmp/base.snap"),
+        };
+        let decoded = Header::decode(&header.encode()).unwrap();
+        assert!(decoded.incremental());
+        assert_eq!(decoded.parent, "/tmp/base.snap");
+        assert_eq!((decoded.page_count, decoded.pages_offset), (3, 8192));
+        let mut bad = header.encode();
+        bad[0] = b'X';
+        assert!(Header::decode(&bad).is_err());
+    }
+}
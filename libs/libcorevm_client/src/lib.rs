@@ -118,6 +118,31 @@ impl CpuMode {
     }
 }
 
+/// Decoded-block cache statistics, as returned by `corevm_icache_stats`.
+///
+/// The counters are cumulative since the VM was created.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct IcacheStats {
+    /// Instruction fetches.
+    pub fetches: u64,
+    /// Fetches that needed the decoder (the rest were cache hits).
+    pub decodes: u64,
+    /// Cached blocks dropped because the guest wrote their code.
+    pub invalidations: u64,
+    /// Blocks currently cached.
+    pub blocks: u64,
+}
+
+impl IcacheStats {
+    /// Cache hit rate in tenths of a percent (0-1000).
+    pub fn hit_permille(&self) -> u32 {
+        if self.fetches == 0 {
+            return 0;
+        }
+        (self.fetches.saturating_sub(self.decodes).saturating_mul(1000) / self.fetches) as u32
+    }
+}
+
 // ══════════════════════════════════════════════════════════════════════
 //  Internal: cached function pointers from libcorevm.so
 // ══════════════════════════════════════════════════════════════════════
@@ -177,6 +202,13 @@ struct CoreVmLib {
     get_cpl: extern "C" fn(u64) -> u8,
     /// Get the total number of instructions executed since last reset.
     get_instruction_count: extern "C" fn(u64) -> u64,
+    /// Get decoded-block cache statistics (fetches, decodes,
+    /// invalidations, live blocks).
+    icache_stats: extern "C" fn(u64, *mut u64, *mut u64, *mut u64, *mut u64),
+    /// Enable (1) or disable (0) the JIT tier.
+    set_jit: extern "C" fn(u64, u32),
+    /// Get JIT statistics (blocks translated, instructions run translated).
+    jit_stats: extern "C" fn(u64, *mut u64, *mut u64),
 
     // ── Memory access ────────────────────────────────────────────
     /// Load raw binary data at a guest physical address.
@@ -204,6 +236,8 @@ struct CoreVmLib {
     /// Register an E1000 NIC with the given MMIO base and MAC address.
     /// `mac_ptr` points to a 6-byte MAC address array.
     setup_e1000: extern "C" fn(u64, u64, *const u8),
+    /// Give the VM N vCPUs (local APICs + application processors).
+    setup_smp: extern "C" fn(u64, u32),
 
     // ── PS/2 keyboard and mouse input ────────────────────────────
     /// Inject a keyboard key press (scancode).
@@ -264,6 +298,28 @@ struct CoreVmLib {
     /// Clear the pending IDE IRQ.
     ide_clear_irq: extern "C" fn(u64),
 
+    // ── Virtio block / network ──────────────────────────────────
+    /// Add a virtio block device at PCI 0:3.0.
+    setup_virtio_blk: extern "C" fn(u64),
+    /// Attach an in-memory disk image (raw bytes) to the virtio block device.
+    virtio_blk_attach_image: extern "C" fn(u64, *const u8, u32),
+    /// Back the virtio block device with a host file (1=ok, 0=failed).
+    virtio_blk_attach_file: extern "C" fn(u64, *const u8, u32) -> u32,
+    /// Add a virtio network card at PCI 0:4.0.
+    setup_virtio_net: extern "C" fn(u64, *const u8),
+    /// Deliver a received frame to the virtio network card.
+    virtio_net_receive_packet: extern "C" fn(u64, *const u8, u32),
+    /// Drain frames transmitted on the virtio network card.
+    virtio_net_take_tx_packets: extern "C" fn(u64, *mut u8, u32) -> u32,
+    /// Bitmask of IRQ lines newly raised by the virtio devices.
+    virtio_take_irqs: extern "C" fn(u64) -> u32,
+
+    // ── Snapshots ─────────────────────────────────────────────
+    /// Save CPU, device state and RAM to a snapshot file.
+    snapshot_save: extern "C" fn(u64, *const u8, u32, u32) -> u32,
+    /// Restore the VM from a snapshot file.
+    snapshot_restore: extern "C" fn(u64, *const u8, u32) -> u32,
+
     // ── fw_cfg ────────────────────────────────────────────────
     /// Add a named file to the fw_cfg device.
     fw_cfg_add_file: extern "C" fn(u64, *const u8, *const u8, u32) -> i32,
@@ -346,6 +402,9 @@ pub fn init() -> bool {
             get_mode: resolve(&handle, "corevm_get_mode"),
             get_cpl: resolve(&handle, "corevm_get_cpl"),
             get_instruction_count: resolve(&handle, "corevm_get_instruction_count"),
+            icache_stats: resolve(&handle, "corevm_icache_stats"),
+            set_jit: resolve(&handle, "corevm_set_jit"),
+            jit_stats: resolve(&handle, "corevm_jit_stats"),
             // Memory
             load_binary: resolve(&handle, "corevm_load_binary"),
             read_phys_u8: resolve(&handle, "corevm_read_phys_u8"),
@@ -358,6 +417,7 @@ pub fn init() -> bool {
             setup_standard_devices: resolve(&handle, "corevm_setup_standard_devices"),
             setup_pci_bus: resolve(&handle, "corevm_setup_pci_bus"),
             setup_e1000: resolve(&handle, "corevm_setup_e1000"),
+            setup_smp: resolve(&handle, "corevm_setup_smp"),
             // PS/2
             ps2_key_press: resolve(&handle, "corevm_ps2_key_press"),
             ps2_key_release: resolve(&handle, "corevm_ps2_key_release"),
@@ -383,6 +443,17 @@ pub fn init() -> bool {
             ide_detach_disk: resolve(&handle, "corevm_ide_detach_disk"),
             ide_irq_raised: resolve(&handle, "corevm_ide_irq_raised"),
             ide_clear_irq: resolve(&handle, "corevm_ide_clear_irq"),
+            // Virtio
+            setup_virtio_blk: resolve(&handle, "corevm_setup_virtio_blk"),
+            virtio_blk_attach_image: resolve(&handle, "corevm_virtio_blk_attach_image"),
+            virtio_blk_attach_file: resolve(&handle, "corevm_virtio_blk_attach_file"),
+            setup_virtio_net: resolve(&handle, "corevm_setup_virtio_net"),
+            virtio_net_receive_packet: resolve(&handle, "corevm_virtio_net_receive_packet"),
+            virtio_net_take_tx_packets: resolve(&handle, "corevm_virtio_net_take_tx_packets"),
+            virtio_take_irqs: resolve(&handle, "corevm_virtio_take_irqs"),
+            // Snapshots
+            snapshot_save: resolve(&handle, "corevm_snapshot_save"),
+            snapshot_restore: resolve(&handle, "corevm_snapshot_restore"),
             // fw_cfg
             fw_cfg_add_file: resolve(&handle, "corevm_fw_cfg_add_file"),
             // Debug port
@@ -562,6 +633,35 @@ impl VmHandle {
         (lib().get_instruction_count)(self.handle)
     }
 
+    /// Get the decoded-block cache statistics.
+    pub fn icache_stats(&self) -> IcacheStats {
+        let mut s = IcacheStats::default();
+        (lib().icache_stats)(
+            self.handle,
+            &mut s.fetches as *mut u64,
+            &mut s.decodes as *mut u64,
+            &mut s.invalidations as *mut u64,
+            &mut s.blocks as *mut u64,
+        );
+        s
+    }
+
+    /// Enable or disable the JIT tier (on by default where supported).
+    ///
+    /// With it disabled every instruction goes through the interpreter.
+    pub fn set_jit(&self, enabled: bool) {
+        (lib().set_jit)(self.handle, enabled as u32)
+    }
+
+    /// Get the JIT statistics: blocks translated to host code and
+    /// instructions executed by translated code.
+    pub fn jit_stats(&self) -> (u64, u64) {
+        let mut translations = 0u64;
+        let mut instructions = 0u64;
+        (lib().jit_stats)(self.handle, &mut translations, &mut instructions);
+        (translations, instructions)
+    }
+
     // ── Memory access ────────────────────────────────────────────
 
     /// Load raw binary data into guest physical memory.
@@ -641,6 +741,16 @@ impl VmHandle {
         (lib().setup_e1000)(self.handle, mmio_base, mac.as_ptr());
     }
 
+    /// Give the VM `count` vCPUs (clamped to 1-16).
+    ///
+    /// Must be called after [`setup_standard_devices`](Self::setup_standard_devices)
+    /// (the count is reported to SeaBIOS through fw_cfg) and before the VM
+    /// first runs. The application processors are interleaved with the
+    /// bootstrap processor inside [`run`](Self::run).
+    pub fn setup_smp(&self, count: u32) {
+        (lib().setup_smp)(self.handle, count);
+    }
+
     // ── PS/2 keyboard and mouse ──────────────────────────────────
 
     /// Inject a keyboard key press event.
@@ -914,6 +1024,75 @@ impl VmHandle {
         (lib().ide_clear_irq)(self.handle);
     }
 
+    // ── Virtio block / network ──────────────────────────────────
+
+    /// Add a paravirtual virtio block device (PCI 0:3.0, ports 0xC000-0xC03F).
+    ///
+    /// Must be called after [`setup_standard_devices`](Self::setup_standard_devices).
+    /// The device has no medium until an image or file is attached.
+    pub fn setup_virtio_blk(&self) {
+        (lib().setup_virtio_blk)(self.handle);
+    }
+
+    /// Attach a disk image to the virtio block device.
+    ///
+    /// The raw image bytes are copied into the VM, as with
+    /// [`ide_attach_disk`](Self::ide_attach_disk).
+    pub fn virtio_blk_attach_image(&self, data: &[u8]) {
+        (lib().virtio_blk_attach_image)(self.handle, data.as_ptr(), data.len() as u32);
+    }
+
+    /// Back the virtio block device with the file at `path`.
+    ///
+    /// The file is read and written in place rather than loaded into
+    /// memory, and guest writes persist in it. Returns `false` if the file
+    /// cannot be opened.
+    pub fn virtio_blk_attach_file(&self, path: &str) -> bool {
+        (lib().virtio_blk_attach_file)(self.handle, path.as_ptr(), path.len() as u32) != 0
+    }
+
+    /// Add a paravirtual virtio network card (PCI 0:4.0, ports 0xC040-0xC07F)
+    /// with the given MAC address.
+    pub fn setup_virtio_net(&self, mac: &[u8; 6]) {
+        (lib().setup_virtio_net)(self.handle, mac.as_ptr());
+    }
+
+    /// Deliver a received Ethernet frame to the virtio network card.
+    pub fn virtio_net_receive_packet(&self, data: &[u8]) {
+        (lib().virtio_net_receive_packet)(self.handle, data.as_ptr(), data.len() as u32);
+    }
+
+    /// Drain frames transmitted by the guest on the virtio network card.
+    ///
+    /// Same `[u32 length][payload]` format as
+    /// [`e1000_take_tx_packets`](Self::e1000_take_tx_packets). Returns the
+    /// number of bytes written to `buf`.
+    pub fn virtio_net_take_tx_packets(&self, buf: &mut [u8]) -> usize {
+        (lib().virtio_net_take_tx_packets)(self.handle, buf.as_mut_ptr(), buf.len() as u32) as usize
+    }
+
+    /// Interrupts newly raised by the virtio devices, as a bitmask of IRQ
+    /// lines (bit N = IRQ N) to pass to [`pic_raise_irq`](Self::pic_raise_irq).
+    pub fn virtio_take_irqs(&self) -> u32 {
+        (lib().virtio_take_irqs)(self.handle)
+    }
+
+    // ── Snapshots ───────────────────────────────────────────────
+
+    /// Save a snapshot of the VM to `path`. With `incremental`, only the
+    /// RAM pages written since the previous snapshot are stored and that
+    /// snapshot must be kept as the new one's parent.
+    pub fn snapshot_save(&self, path: &str, incremental: bool) -> bool {
+        (lib().snapshot_save)(self.handle, path.as_ptr(), path.len() as u32, incremental as u32) != 0
+    }
+
+    /// Restore the VM from the snapshot at `path`. The VM must have the
+    /// same RAM size and devices as the one that saved it. RAM is paged in
+    /// from the snapshot lazily, copy-on-write.
+    pub fn snapshot_restore(&self, path: &str) -> bool {
+        (lib().snapshot_restore)(self.handle, path.as_ptr(), path.len() as u32) != 0
+    }
+
     // ── Error reporting ─────────────────────────────────────────
 
     /// Get a human-readable description of the last error.
@@ -0,0 +1,170 @@
+//! GROUP BY and aggregate functions.
+//!
+//! Rows are grouped by hash ([`HashIndex`]) as they stream past, so each
+//! group holds its key and one accumulator per aggregate, never its rows.
+//! Group keys compare like index keys: integers by value, text
+//! case-insensitively, and all NULLs as one group.
+//!
+//! `COUNT(col)`, `SUM`, `MIN`, `MAX` and `AVG` skip NULLs; `SUM`, `MIN`,
+//! `MAX` and `AVG` of no values are NULL.  There is no fractional type, so
+//! `AVG` is the integer quotient, rounded toward zero.
+
+extern crate alloc;
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::cmp::Ordering;
+use crate::types::*;
+use crate::btree;
+use crate::cursor::Columns;
+use crate::engine::ValueRef;
+use crate::hash::{self, HashIndex};
+
+/// One aggregate of a SELECT, with its argument resolved.
+pub struct AggSpec {
+    pub func: AggFunc,
+    /// Argument column; `None` for `COUNT(*)`.
+    pub col: Option<usize>,
+}
+
+/// Running state of one aggregate in one group.
+enum Acc {
+    Count(i64),
+    Sum(Option<i64>),
+    Min(Option<Value>),
+    Max(Option<Value>),
+    /// Sum and count of the values seen.
+    Avg(i64, i64),
+}
+
+impl Acc {
+    fn new(func: AggFunc) -> Acc {
+        match func {
+            AggFunc::Count => Acc::Count(0),
+            AggFunc::Sum => Acc::Sum(None),
+            AggFunc::Min => Acc::Min(None),
+            AggFunc::Max => Acc::Max(None),
+            AggFunc::Avg => Acc::Avg(0, 0),
+        }
+    }
+
+    fn add(&mut self, value: ValueRef) -> DbResult<()> {
+        if let ValueRef::Null = value {
+            return Ok(());
+        }
+        match self {
+            Acc::Count(n) => *n += 1,
+            Acc::Sum(sum) => {
+                if let ValueRef::Integer(v) = value {
+                    *sum = Some(add(sum.unwrap_or(0), v)?);
+                }
+            }
+            Acc::Min(best) => keep(best, value, Ordering::Less),
+            Acc::Max(best) => keep(best, value, Ordering::Greater),
+            Acc::Avg(sum, n) => {
+                if let ValueRef::Integer(v) = value {
+                    *sum = add(*sum, v)?;
+                    *n += 1;
+                }
+            }
+        }
+        Ok(())
+    }
+
+    fn result(self) -> Value {
+        match self {
+            Acc::Count(n) => Value::Integer(n),
+            Acc::Sum(sum) => sum.map_or(Value::Null, Value::Integer),
+            Acc::Min(v) | Acc::Max(v) => v.unwrap_or(Value::Null),
+            Acc::Avg(_, 0) => Value::Null,
+            Acc::Avg(sum, n) => Value::Integer(sum / n),
+        }
+    }
+}
+
+fn add(a: i64, b: i64) -> DbResult<i64> {
+    a.checked_add(b).ok_or_else(|| DbError::TypeMismatch(String::from("Integer overflow in aggregate")))
+}
+
+/// Replace `best` with `value` if it orders `wanted` relative to it.
+fn keep(best: &mut Option<Value>, value: ValueRef, wanted: Ordering) {
+    let better = match (&*best, value) {
+        (None, _) => true,
+        (Some(Value::Integer(b)), ValueRef::Integer(v)) => v.cmp(b) == wanted,
+        (Some(b), v) => btree::cmp_values(&v.to_value(), b) == wanted,
+    };
+    if better {
+        *best = Some(value.to_value());
+    }
+}
+
+/// Whether a row's key column matches a group's key value.
+fn same_key(value: ValueRef, key: &Value) -> bool {
+    match (value, key) {
+        (ValueRef::Null, Value::Null) => true,
+        (ValueRef::Integer(a), Value::Integer(b)) => a == *b,
+        (ValueRef::Text(a), Value::Text(b)) => a.eq_ignore_ascii_case(b),
+        _ => false,
+    }
+}
+
+struct Group {
+    key: Vec<Value>,
+    accs: Vec<Acc>,
+}
+
+/// Hash aggregation over a stream of rows.
+pub struct Grouper {
+    /// GROUP BY columns.
+    keys: Vec<usize>,
+    aggs: Vec<AggSpec>,
+    index: HashIndex,
+    groups: Vec<Group>,
+}
+
+impl Grouper {
+    pub fn new(keys: Vec<usize>, aggs: Vec<AggSpec>) -> Grouper {
+        Grouper { keys, aggs, index: HashIndex::new(), groups: Vec::new() }
+    }
+
+    /// Add a row to its group.
+    pub fn push<R: Columns + ?Sized>(&mut self, row: &R) -> DbResult<()> {
+        let hash = self.keys.iter().fold(hash::SEED, |h, &c| hash::hash_value(h, row.get(c)));
+        let (keys, groups) = (&self.keys, &self.groups);
+        let found = self.index.find(hash).find(|&g| {
+            groups[g].key.iter().zip(keys).all(|(key, &c)| same_key(row.get(c), key))
+        });
+        let g = match found {
+            Some(g) => g,
+            None => {
+                self.index.insert(hash);
+                self.groups.push(self.new_group(self.keys.iter().map(|&c| row.get(c).to_value()).collect()));
+                self.groups.len() - 1
+            }
+        };
+        for (acc, spec) in self.groups[g].accs.iter_mut().zip(&self.aggs) {
+            match spec.col {
+                Some(c) => acc.add(row.get(c))?,
+                None => acc.add(ValueRef::Integer(1))?,
+            }
+        }
+        Ok(())
+    }
+
+    fn new_group(&self, key: Vec<Value>) -> Group {
+        Group { key, accs: self.aggs.iter().map(|a| Acc::new(a.func)).collect() }
+    }
+
+    /// Each group's key and aggregate values, in the order the groups were
+    /// first seen.  Without GROUP BY columns there is exactly one group,
+    /// even over no rows.
+    pub fn finish(mut self) -> Vec<(Vec<Value>, Vec<Value>)> {
+        if self.keys.is_empty() && self.groups.is_empty() {
+            let group = self.new_group(Vec::new());
+            self.groups.push(group);
+        }
+        self.groups.into_iter()
+            .map(|g| (g.key, g.accs.into_iter().map(Acc::result).collect()))
+            .collect()
+    }
+}
@@ -0,0 +1,355 @@
+//! On-disk B+tree indexes.
+//!
+//! An index maps the values of one column to the rows holding them.  Each
+//! tree lives in ordinary 4 KiB pages taken from the same free list as data
+//! pages.  Keys are `(value, rowid)` pairs, so duplicate values are distinct
+//! keys and every entry names exactly one row; the rowid packs the row's
+//! data page and byte offset.  Leaves are chained left to right for range
+//! scans.
+//!
+//! Deletion only removes the key from its leaf: nodes are never merged, and
+//! a leaf left empty stays in the chain until the tree is cleared.  The
+//! root page of a tree never moves — a root split copies the old root to a
+//! new page — so the index directory only changes when indexes are created
+//! or dropped.
+
+extern crate alloc;
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::cmp::Ordering;
+use crate::types::*;
+use crate::engine::{self, Database};
+
+// ── Node page layout ─────────────────────────────────────────────────────────
+//
+// Byte   0      kind (1 = leaf, 2 = internal)
+// Byte   1      reserved
+// Bytes  2..4   key count (u16 LE)
+// Bytes  4..8   leaf: next leaf page (0 = last)
+//               internal: leftmost child page
+// Bytes  8..    keys, each: value (row value encoding) + rowid (u64 LE),
+//               followed in internal nodes by the child page (u32 LE) holding
+//               the keys from this one up to the next
+
+const NODE_HEADER: usize = 8;
+const KIND_LEAF: u8 = 1;
+const KIND_INTERNAL: u8 = 2;
+
+/// Pack a row location into a rowid.
+pub fn rowid(page_num: u32, offset: usize) -> u64 {
+    (page_num as u64) << 16 | offset as u64
+}
+
+/// Unpack a rowid into `(page_num, offset)`.
+pub fn row_location(rowid: u64) -> (u32, usize) {
+    ((rowid >> 16) as u32, (rowid & 0xFFFF) as usize)
+}
+
+/// An index entry.
+#[derive(Debug, Clone)]
+pub struct Key {
+    pub value: Value,
+    pub rowid: u64,
+}
+
+/// One end of a range scan.
+#[derive(Debug, Clone)]
+pub enum Bound {
+    Included(Value),
+    Excluded(Value),
+}
+
+/// Order of index values: NULL, then integers, then text.  Text compares
+/// case-insensitively, matching `=` in WHERE clauses.
+pub fn cmp_values(a: &Value, b: &Value) -> Ordering {
+    match (a, b) {
+        (Value::Integer(x), Value::Integer(y)) => x.cmp(y),
+        (Value::Text(x), Value::Text(y)) => {
+            x.bytes().map(|c| c.to_ascii_lowercase()).cmp(y.bytes().map(|c| c.to_ascii_lowercase()))
+        }
+        _ => value_class(a).cmp(&value_class(b)),
+    }
+}
+
+fn value_class(v: &Value) -> u8 {
+    match v {
+        Value::Null => 0,
+        Value::Integer(_) => 1,
+        Value::Text(_) => 2,
+    }
+}
+
+fn cmp_keys(a: &Key, b: &Key) -> Ordering {
+    cmp_values(&a.value, &b.value).then(a.rowid.cmp(&b.rowid))
+}
+
+// ── Nodes ────────────────────────────────────────────────────────────────────
+
+/// A node page parsed into memory.
+struct Node {
+    leaf: bool,
+    /// Next leaf, or leftmost child of an internal node.
+    link: u32,
+    keys: Vec<Key>,
+    /// Internal nodes: `children[i]` holds the keys from `keys[i]` on.
+    children: Vec<u32>,
+}
+
+impl Node {
+    fn empty_leaf() -> Node {
+        Node { leaf: true, link: 0, keys: Vec::new(), children: Vec::new() }
+    }
+
+    fn decode(page: &[u8; PAGE_SIZE]) -> DbResult<Node> {
+        let leaf = match page[0] {
+            KIND_LEAF => true,
+            KIND_INTERNAL => false,
+            _ => return Err(DbError::Corrupt(String::from("Invalid index node"))),
+        };
+        let count = u16::from_le_bytes([page[2], page[3]]) as usize;
+        let link = u32::from_le_bytes([page[4], page[5], page[6], page[7]]);
+
+        let mut node = Node { leaf, link, keys: Vec::with_capacity(count), children: Vec::new() };
+        let mut pos = NODE_HEADER;
+        for _ in 0..count {
+            let (value, next) = engine::decode_value(page, pos, PAGE_SIZE)
+                .ok_or_else(|| DbError::Corrupt(String::from("Invalid index key")))?;
+            let extra = if leaf { 8 } else { 12 };
+            if next + extra > PAGE_SIZE {
+                return Err(DbError::Corrupt(String::from("Index node overflows page")));
+            }
+            let rowid = u64::from_le_bytes(page[next..next + 8].try_into().unwrap());
+            if !leaf {
+                node.children.push(u32::from_le_bytes(page[next + 8..next + 12].try_into().unwrap()));
+            }
+            node.keys.push(Key { value, rowid });
+            pos = next + extra;
+        }
+        Ok(node)
+    }
+
+    fn entry_size(&self, key: &Key) -> usize {
+        key.value.serialized_size() + if self.leaf { 8 } else { 12 }
+    }
+
+    fn encoded_size(&self) -> usize {
+        NODE_HEADER + self.keys.iter().map(|k| self.entry_size(k)).sum::<usize>()
+    }
+
+    /// Encode into a page.  The node must fit (see [`encoded_size`](Self::encoded_size)).
+    fn encode(&self) -> DbResult<[u8; PAGE_SIZE]> {
+        let mut buf = Vec::with_capacity(self.encoded_size());
+        buf.push(if self.leaf { KIND_LEAF } else { KIND_INTERNAL });
+        buf.push(0);
+        buf.extend_from_slice(&(self.keys.len() as u16).to_le_bytes());
+        buf.extend_from_slice(&self.link.to_le_bytes());
+        for (i, key) in self.keys.iter().enumerate() {
+            engine::encode_value(&mut buf, &key.value)?;
+            buf.extend_from_slice(&key.rowid.to_le_bytes());
+            if !self.leaf {
+                buf.extend_from_slice(&self.children[i].to_le_bytes());
+            }
+        }
+        let mut page = [0u8; PAGE_SIZE];
+        page[..buf.len()].copy_from_slice(&buf);
+        Ok(page)
+    }
+
+    /// Position of the child that holds `key` (0 = leftmost).
+    fn child_index(&self, key: &Key) -> usize {
+        self.keys.partition_point(|k| cmp_keys(k, key) != Ordering::Greater)
+    }
+
+    fn child(&self, i: usize) -> u32 {
+        if i == 0 { self.link } else { self.children[i - 1] }
+    }
+
+    /// Split an overfull node in two by size.  Returns the right half and
+    /// the separator to insert into the parent.  A leaf's chain link is
+    /// handed to the right half; the caller points the left half at it.
+    fn split(&mut self) -> (Key, Node) {
+        let half = (self.encoded_size() - NODE_HEADER) / 2;
+        let mut mid = 0;
+        let mut size = 0;
+        while mid < self.keys.len() - 1 && size < half {
+            size += self.entry_size(&self.keys[mid]);
+            mid += 1;
+        }
+        let mid = mid.max(1);
+
+        if self.leaf {
+            let keys = self.keys.split_off(mid);
+            let sep = keys[0].clone();
+            (sep, Node { leaf: true, link: self.link, keys, children: Vec::new() })
+        } else {
+            // The middle key moves up; its child becomes the right half's leftmost
+            let keys = self.keys.split_off(mid + 1);
+            let children = self.children.split_off(mid + 1);
+            let sep = self.keys.pop().unwrap();
+            let link = self.children.pop().unwrap();
+            (sep, Node { leaf: false, link, keys, children })
+        }
+    }
+}
+
+// ── Tree operations ──────────────────────────────────────────────────────────
+
+impl Database {
+    fn read_node(&self, page_num: u32) -> DbResult<Node> {
+        let mut page = [0u8; PAGE_SIZE];
+        self.read_page(page_num, &mut page)?;
+        Node::decode(&page)
+    }
+
+    fn write_node(&self, page_num: u32, node: &Node) -> DbResult<()> {
+        self.write_page(page_num, &node.encode()?)
+    }
+
+    /// Create an empty tree. Returns its root page.
+    pub(crate) fn btree_create(&mut self) -> DbResult<u32> {
+        let root = self.alloc_page()?;
+        self.write_node(root, &Node::empty_leaf())?;
+        Ok(root)
+    }
+
+    /// Insert a key.  Inserting a key that is already present does nothing.
+    pub(crate) fn btree_insert(&mut self, root: u32, key: Key) -> DbResult<()> {
+        self.insert_into(root, root, key).map(|_| ())
+    }
+
+    /// Insert below `page_num`.  Returns the separator and page of the new
+    /// right sibling if the node split.
+    fn insert_into(&mut self, root: u32, page_num: u32, key: Key) -> DbResult<Option<(Key, u32)>> {
+        let mut node = self.read_node(page_num)?;
+        if node.leaf {
+            match node.keys.binary_search_by(|k| cmp_keys(k, &key)) {
+                Ok(_) => return Ok(None),
+                Err(pos) => node.keys.insert(pos, key),
+            }
+        } else {
+            let i = node.child_index(&key);
+            match self.insert_into(root, node.child(i), key)? {
+                None => return Ok(None),
+                Some((sep, right)) => {
+                    node.keys.insert(i, sep);
+                    node.children.insert(i, right);
+                }
+            }
+        }
+
+        if node.encoded_size() <= PAGE_SIZE {
+            self.write_node(page_num, &node)?;
+            return Ok(None);
+        }
+
+        let (sep, right) = node.split();
+        let right_page = self.alloc_page()?;
+        if node.leaf {
+            node.link = right_page;
+        }
+        self.write_node(right_page, &right)?;
+
+        if page_num != root {
+            self.write_node(page_num, &node)?;
+            return Ok(Some((sep, right_page)));
+        }
+
+        // Root split: the left half moves out so the root keeps its page
+        let left_page = self.alloc_page()?;
+        self.write_node(left_page, &node)?;
+        let new_root = Node {
+            leaf: false,
+            link: left_page,
+            keys: alloc::vec![sep],
+            children: alloc::vec![right_page],
+        };
+        self.write_node(root, &new_root)?;
+        Ok(None)
+    }
+
+    /// Remove a key. Returns false if it was not present.
+    pub(crate) fn btree_delete(&mut self, root: u32, key: &Key) -> DbResult<bool> {
+        let mut page_num = root;
+        let mut node = self.read_node(page_num)?;
+        while !node.leaf {
+            page_num = node.child(node.child_index(key));
+            node = self.read_node(page_num)?;
+        }
+        match node.keys.binary_search_by(|k| cmp_keys(k, key)) {
+            Ok(pos) => {
+                node.keys.remove(pos);
+                self.write_node(page_num, &node)?;
+                Ok(true)
+            }
+            Err(_) => Ok(false),
+        }
+    }
+
+    /// Rowids of all keys with values between `lo` and `hi`, in key order.
+    pub(crate) fn btree_scan(&self, root: u32, lo: &Bound, hi: &Bound) -> DbResult<Vec<u64>> {
+        let start = match lo {
+            Bound::Included(v) => Key { value: v.clone(), rowid: 0 },
+            Bound::Excluded(v) => Key { value: v.clone(), rowid: u64::MAX },
+        };
+
+        let mut node = self.read_node(root)?;
+        while !node.leaf {
+            node = self.read_node(node.child(node.child_index(&start)))?;
+        }
+
+        let mut rowids = Vec::new();
+        let mut pos = node.keys.partition_point(|k| cmp_keys(k, &start) == Ordering::Less);
+        loop {
+            for key in &node.keys[pos..] {
+                let past = match hi {
+                    Bound::Included(v) => cmp_values(&key.value, v) == Ordering::Greater,
+                    Bound::Excluded(v) => cmp_values(&key.value, v) != Ordering::Less,
+                };
+                if past {
+                    return Ok(rowids);
+                }
+                rowids.push(key.rowid);
+            }
+            if node.link == 0 {
+                return Ok(rowids);
+            }
+            node = self.read_node(node.link)?;
+            pos = 0;
+        }
+    }
+
+    /// Rowids of all keys equal to `value`.
+    pub(crate) fn btree_find(&self, root: u32, value: &Value) -> DbResult<Vec<u64>> {
+        let bound = Bound::Included(value.clone());
+        self.btree_scan(root, &bound, &bound)
+    }
+
+    /// Remove every key, freeing all pages except the root.
+    pub(crate) fn btree_clear(&mut self, root: u32) -> DbResult<()> {
+        let node = self.read_node(root)?;
+        if !node.leaf {
+            self.free_subtree(node.link)?;
+            for &child in &node.children {
+                self.free_subtree(child)?;
+            }
+        }
+        self.write_node(root, &Node::empty_leaf())
+    }
+
+    /// Free a whole tree, root included.
+    pub(crate) fn btree_free(&mut self, root: u32) -> DbResult<()> {
+        self.free_subtree(root)
+    }
+
+    fn free_subtree(&mut self, page_num: u32) -> DbResult<()> {
+        let node = self.read_node(page_num)?;
+        if !node.leaf {
+            self.free_subtree(node.link)?;
+            for &child in &node.children {
+                self.free_subtree(child)?;
+            }
+        }
+        self.free_page(page_num)
+    }
+}
@@ -0,0 +1,261 @@
+//! Page buffer pool.
+//!
+//! Keeps recently used pages of a database file in memory so repeated
+//! queries are served without a seek+read per page.  Writes land in the
+//! pool and stay there until their transaction commits
+//! ([`BufferPool::write_back`] hands them to the write-ahead log in page
+//! order), so a statement that touches the same page many times (page 0
+//! on every inserted row, an index leaf across several keys) logs it once,
+//! and a rollback only has to drop them.
+//!
+//! Frames are allocated as pages come in, up to the pool's capacity; after
+//! that, a clock sweep picks a clean victim.  Changed frames are never
+//! evicted — a transaction larger than the pool grows it until the commit.
+//! Callers copy pages in and out of the frames, so no frame is referenced
+//! between calls and none needs to be pinned.
+
+extern crate alloc;
+
+use alloc::boxed::Box;
+use alloc::collections::BTreeMap;
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::types::*;
+use crate::syscall;
+use crate::wal::Wal;
+
+/// Pages cached per open database unless changed with `PRAGMA cache_size`.
+pub const DEFAULT_CACHE_PAGES: usize = 256;
+
+/// Smallest pool `PRAGMA cache_size` accepts.
+pub const MIN_CACHE_PAGES: usize = 8;
+
+/// Largest pool `PRAGMA cache_size` accepts (16 MiB).
+pub const MAX_CACHE_PAGES: usize = 4096;
+
+struct Frame {
+    page_num: u32,
+    dirty: bool,
+    /// Clock reference bit: set on every access, cleared by the sweep.
+    referenced: bool,
+    data: Box<[u8; PAGE_SIZE]>,
+}
+
+/// Counters reported by `PRAGMA cache_stats`.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CacheStats {
+    /// Page reads served from the pool.
+    pub hits: u64,
+    /// Page reads that went to the file.
+    pub misses: u64,
+    /// Frames reused for another page.
+    pub evictions: u64,
+    /// Changed pages handed to the log at commit.
+    pub writes: u64,
+}
+
+/// Cache of database pages with write-back.
+pub struct BufferPool {
+    frames: Vec<Frame>,
+    /// Page number → frame index.
+    map: BTreeMap<u32, usize>,
+    capacity: usize,
+    /// Next frame the clock sweep looks at.
+    hand: usize,
+    pub stats: CacheStats,
+}
+
+impl BufferPool {
+    pub fn new(capacity: usize) -> BufferPool {
+        BufferPool {
+            frames: Vec::new(),
+            map: BTreeMap::new(),
+            capacity: capacity.clamp(MIN_CACHE_PAGES, MAX_CACHE_PAGES),
+            hand: 0,
+            stats: CacheStats::default(),
+        }
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// Pages currently held.
+    pub fn cached(&self) -> usize {
+        self.frames.len()
+    }
+
+    /// Read a page: from the pool if it is cached, else its committed
+    /// version from the log or the main file `fd`.
+    pub fn read(&mut self, fd: u32, wal: &Wal, page_num: u32, buf: &mut [u8; PAGE_SIZE]) -> DbResult<()> {
+        if let Some(&i) = self.map.get(&page_num) {
+            self.stats.hits += 1;
+            let frame = &mut self.frames[i];
+            frame.referenced = true;
+            buf.copy_from_slice(&frame.data[..]);
+            return Ok(());
+        }
+        self.stats.misses += 1;
+        if !wal.read(page_num, buf)? {
+            let n = read_at(fd, page_num * PAGE_SIZE as u32, buf)?;
+            // Zero-fill if we read less than a full page (new pages)
+            buf[n..].fill(0);
+        }
+        let i = self.frame_for(page_num);
+        self.frames[i].data.copy_from_slice(buf);
+        Ok(())
+    }
+
+    /// Write a page into the pool.  It reaches the log when its
+    /// transaction commits.
+    pub fn write(&mut self, page_num: u32, buf: &[u8; PAGE_SIZE]) {
+        let i = match self.map.get(&page_num) {
+            Some(&i) => i,
+            None => self.frame_for(page_num),
+        };
+        let frame = &mut self.frames[i];
+        frame.data.copy_from_slice(buf);
+        frame.dirty = true;
+        frame.referenced = true;
+    }
+
+    /// Commit every changed page to the log as one transaction.
+    pub fn write_back(&mut self, wal: &mut Wal, db_pages: u32) -> DbResult<()> {
+        let dirty: Vec<(u32, usize)> = self.map.iter()
+            .filter(|(_, &i)| self.frames[i].dirty)
+            .map(|(&page_num, &i)| (page_num, i))
+            .collect();
+        if dirty.is_empty() {
+            return Ok(());
+        }
+        let pages: Vec<(u32, &[u8; PAGE_SIZE])> = dirty.iter()
+            .map(|&(page_num, i)| (page_num, &*self.frames[i].data))
+            .collect();
+        wal.commit(&pages, db_pages)?;
+
+        for &(_, i) in &dirty {
+            self.frames[i].dirty = false;
+        }
+        self.stats.writes += dirty.len() as u64;
+        self.trim();
+        Ok(())
+    }
+
+    /// Drop every changed page (rollback).
+    pub fn discard_dirty(&mut self) {
+        let mut i = 0;
+        while i < self.frames.len() {
+            if self.frames[i].dirty {
+                self.remove_frame(i);
+            } else {
+                i += 1;
+            }
+        }
+    }
+
+    /// Drop every cached page (another handle committed).  The pool must
+    /// hold no changes.
+    pub fn clear(&mut self) {
+        self.frames.clear();
+        self.map.clear();
+        self.hand = 0;
+    }
+
+    /// Change the capacity, dropping clean frames that no longer fit.
+    pub fn resize(&mut self, capacity: usize) {
+        self.capacity = capacity.clamp(MIN_CACHE_PAGES, MAX_CACHE_PAGES);
+        self.trim();
+    }
+
+    /// Shrink back to capacity once changed frames are clean again.
+    fn trim(&mut self) {
+        let mut i = 0;
+        while self.frames.len() > self.capacity && i < self.frames.len() {
+            if self.frames[i].dirty {
+                i += 1;
+            } else {
+                self.remove_frame(i);
+            }
+        }
+        self.hand = 0;
+    }
+
+    fn remove_frame(&mut self, i: usize) {
+        self.map.remove(&self.frames[i].page_num);
+        self.frames.swap_remove(i);
+        if i < self.frames.len() {
+            self.map.insert(self.frames[i].page_num, i);
+        }
+    }
+
+    /// Take a frame for `page_num` (a free one, or the clock's victim) and
+    /// map the page to it.  The frame's data is left for the caller to fill.
+    fn frame_for(&mut self, page_num: u32) -> usize {
+        let victim = if self.frames.len() < self.capacity { None } else { self.victim() };
+        let i = match victim {
+            Some(i) => {
+                self.map.remove(&self.frames[i].page_num);
+                self.stats.evictions += 1;
+                let frame = &mut self.frames[i];
+                frame.page_num = page_num;
+                frame.referenced = true;
+                i
+            }
+            None => {
+                self.frames.push(Frame {
+                    page_num,
+                    dirty: false,
+                    referenced: true,
+                    data: Box::new([0u8; PAGE_SIZE]),
+                });
+                self.frames.len() - 1
+            }
+        };
+        self.map.insert(page_num, i);
+        i
+    }
+
+    /// Clock sweep: the first clean frame not referenced since the hand
+    /// last passed.  `None` if every frame holds changes.
+    fn victim(&mut self) -> Option<usize> {
+        for _ in 0..2 * self.frames.len() {
+            let i = self.hand;
+            self.hand = (self.hand + 1) % self.frames.len();
+            let frame = &mut self.frames[i];
+            if frame.dirty {
+                continue;
+            }
+            if !frame.referenced {
+                return Some(i);
+            }
+            frame.referenced = false;
+        }
+        None
+    }
+}
+
+// ── File I/O ─────────────────────────────────────────────────────────────────
+
+/// Read up to `buf.len()` bytes at `offset`. Returns the bytes read.
+pub fn read_at(fd: u32, offset: u32, buf: &mut [u8]) -> DbResult<usize> {
+    if syscall::lseek(fd, offset as i32, syscall::SEEK_SET) == u32::MAX {
+        return Err(DbError::Io(String::from("Seek failed")));
+    }
+    let n = syscall::read(fd, buf);
+    if n == u32::MAX {
+        return Err(DbError::Io(String::from("Read failed")));
+    }
+    Ok((n as usize).min(buf.len()))
+}
+
+/// Write all of `buf` at `offset`.
+pub fn write_at(fd: u32, offset: u32, buf: &[u8]) -> DbResult<()> {
+    if syscall::lseek(fd, offset as i32, syscall::SEEK_SET) == u32::MAX {
+        return Err(DbError::Io(String::from("Seek failed")));
+    }
+    let n = syscall::write(fd, buf);
+    if n == u32::MAX || n as usize != buf.len() {
+        return Err(DbError::Io(String::from("Write failed")));
+    }
+    Ok(())
+}
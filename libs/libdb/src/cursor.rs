@@ -0,0 +1,458 @@
+//! Row cursors.
+//!
+//! Queries pull rows one at a time straight out of their data pages instead
+//! of materializing the table first.  A [`Scan`] walks a table's page chain
+//! (or the rows an index named), a [`Filter`] skips rows failing a
+//! [`Predicate`], and a [`Limit`] ends the stream after a number of rows.
+//! Every cursor exposes its current row as a [`RawRow`] — the row's bytes
+//! in the page buffer — so a predicate decodes only the columns it names,
+//! and a [`Row`] is built only for rows that are kept.  On a handle opened
+//! with `open_readonly_mmap` the page buffer is the mapped file itself.
+//! Predicates read rows through [`Columns`], so they also apply to the rows
+//! a join pairs up ([`crate::join`]).
+
+extern crate alloc;
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::types::*;
+use crate::btree;
+use crate::engine::{self, Database, ValueRef};
+
+/// A stream of stored rows.
+pub trait Cursor {
+    /// Move to the next row.  Returns false once the stream is exhausted.
+    fn advance(&mut self) -> DbResult<bool>;
+
+    /// The current row; only valid after `advance` returned true.
+    fn current(&self) -> RawRow<'_>;
+}
+
+/// Column access common to stored rows, materialized rows and joined rows.
+pub trait Columns {
+    /// Column `col`; past the last column, NULL.
+    fn get(&self, col: usize) -> ValueRef<'_>;
+}
+
+/// One stored row, read in place.
+pub struct RawRow<'a> {
+    pub page_num: u32,
+    pub offset: usize,
+    page: &'a [u8; PAGE_SIZE],
+    /// Start of each column's value; values past `count` read as NULL.
+    cols: &'a [usize],
+    end: usize,
+}
+
+impl<'a> RawRow<'a> {
+    /// Column `col`, borrowed from the page.
+    pub fn get(&self, col: usize) -> ValueRef<'a> {
+        match self.cols.get(col) {
+            Some(&pos) => engine::decode_ref(self.page, pos, self.end)
+                .map_or(ValueRef::Null, |(v, _)| v),
+            None => ValueRef::Null,
+        }
+    }
+
+    /// Column `col` as an owned value.
+    pub fn value(&self, col: usize) -> Value {
+        self.get(col).to_value()
+    }
+
+    /// The listed columns, in that order.
+    pub fn project(&self, cols: &[usize]) -> Row {
+        Row { values: cols.iter().map(|&c| self.value(c)).collect() }
+    }
+
+    /// Every column, as stored.
+    pub fn row(&self) -> Row {
+        Row { values: (0..self.cols.len()).map(|c| self.value(c)).collect() }
+    }
+
+    /// The row's id as stored in indexes.
+    pub fn rowid(&self) -> u64 {
+        btree::rowid(self.page_num, self.offset)
+    }
+}
+
+impl<'a> Columns for RawRow<'a> {
+    fn get(&self, col: usize) -> ValueRef<'_> {
+        RawRow::get(self, col)
+    }
+}
+
+impl Columns for Row {
+    fn get(&self, col: usize) -> ValueRef<'_> {
+        self.values.get(col).map_or(ValueRef::Null, ValueRef::from)
+    }
+}
+
+// ── Scan ─────────────────────────────────────────────────────────────────────
+
+/// Reads a table's rows in file order, one page in memory at a time.
+pub struct Scan<'a> {
+    db: &'a Database,
+    col_count: usize,
+    /// Rows to visit (from an index, sorted); `None` walks the page chain.
+    rowids: Option<Vec<u64>>,
+    next_rowid: usize,
+    page: Box<[u8; PAGE_SIZE]>,
+    /// The loaded page in place in the mapped file, used instead of `page`.
+    mapped: Option<&'a [u8; PAGE_SIZE]>,
+    /// Page held in `page` (0 = none yet).
+    loaded: u32,
+    /// Next page of the chain to load.
+    next_page: u32,
+    /// Position of the next row in `page`, and the end of its data.
+    pos: usize,
+    data_end: usize,
+    /// Current row: location, column starts and end.
+    page_num: u32,
+    offset: usize,
+    cols: [usize; MAX_COLUMNS],
+    count: usize,
+    end: usize,
+}
+
+impl<'a> Scan<'a> {
+    /// Every active row of a table.
+    pub fn table(db: &'a Database, table_idx: usize) -> Scan<'a> {
+        let mut scan = Scan::new(db, table_idx, None);
+        scan.next_page = db.tables[table_idx].first_data_page;
+        scan
+    }
+
+    /// The active rows among `rowids` (as stored in indexes), in file
+    /// order; each page is read once.
+    pub fn rows(db: &'a Database, table_idx: usize, mut rowids: Vec<u64>) -> Scan<'a> {
+        rowids.sort_unstable();
+        rowids.dedup();
+        Scan::new(db, table_idx, Some(rowids))
+    }
+
+    fn new(db: &'a Database, table_idx: usize, rowids: Option<Vec<u64>>) -> Scan<'a> {
+        Scan {
+            db,
+            col_count: db.tables[table_idx].columns.len(),
+            rowids,
+            next_rowid: 0,
+            page: Box::new([0u8; PAGE_SIZE]),
+            mapped: None,
+            loaded: 0,
+            next_page: 0,
+            pos: 0,
+            data_end: 0,
+            page_num: 0,
+            offset: 0,
+            cols: [0; MAX_COLUMNS],
+            count: 0,
+            end: 0,
+        }
+    }
+
+    fn load(&mut self, page_num: u32) -> DbResult<()> {
+        if self.loaded != page_num {
+            self.mapped = self.db.mapped_page(page_num);
+            if self.mapped.is_none() {
+                self.db.read_page(page_num, &mut self.page)?;
+            }
+            self.loaded = page_num;
+        }
+        let page = self.page();
+        let data_end = u16::from_le_bytes([page[6], page[7]]) as usize;
+        self.data_end = if data_end == 0 { DATA_PAGE_HEADER } else { data_end };
+        Ok(())
+    }
+
+    /// The loaded page.
+    fn page(&self) -> &[u8; PAGE_SIZE] {
+        self.mapped.unwrap_or(&self.page)
+    }
+
+    /// Parse the row at `offset` of the loaded page as the current row.
+    /// Returns its total size and whether it is active, or `None` if no
+    /// row starts there.
+    fn parse(&mut self, offset: usize) -> Option<(usize, bool)> {
+        let page = self.mapped.unwrap_or(&self.page);
+        if offset + 3 > PAGE_SIZE {
+            return None;
+        }
+        let flag = page[offset];
+        if flag != ROW_ACTIVE && flag != ROW_DELETED {
+            return None;
+        }
+        let row_len = u16::from_le_bytes([page[offset + 1], page[offset + 2]]) as usize;
+        let total = 3 + row_len;
+        if flag == ROW_DELETED {
+            return Some((total, false));
+        }
+
+        let end = (offset + total).min(PAGE_SIZE);
+        let mut pos = offset + 3;
+        let mut count = 0;
+        while count < self.col_count {
+            match engine::decode_ref(page, pos, end) {
+                Some((_, next)) => {
+                    self.cols[count] = pos;
+                    count += 1;
+                    pos = next;
+                }
+                None => break,
+            }
+        }
+        // A row with no decodable value is treated like a deleted one
+        if count == 0 {
+            return Some((total, false));
+        }
+        self.page_num = self.loaded;
+        self.offset = offset;
+        self.count = count;
+        self.end = end;
+        Some((total, true))
+    }
+}
+
+impl<'a> Cursor for Scan<'a> {
+    fn advance(&mut self) -> DbResult<bool> {
+        if self.rowids.is_some() {
+            loop {
+                let rowid = match self.rowids.as_ref().and_then(|r| r.get(self.next_rowid)) {
+                    Some(&rowid) => rowid,
+                    None => return Ok(false),
+                };
+                self.next_rowid += 1;
+                let (page_num, offset) = btree::row_location(rowid);
+                self.load(page_num)?;
+                if offset < DATA_PAGE_HEADER || offset >= self.data_end {
+                    return Err(DbError::Corrupt(String::from("Index points outside a data page")));
+                }
+                if let Some((_, true)) = self.parse(offset) {
+                    return Ok(true);
+                }
+            }
+        }
+
+        loop {
+            if self.loaded == 0 || self.pos >= self.data_end {
+                if self.next_page == 0 {
+                    return Ok(false);
+                }
+                let page_num = self.next_page;
+                self.load(page_num)?;
+                let page = self.page();
+                self.next_page = u32::from_le_bytes([page[0], page[1], page[2], page[3]]);
+                self.pos = DATA_PAGE_HEADER;
+                continue;
+            }
+            match self.parse(self.pos) {
+                Some((total, active)) => {
+                    self.pos += total;
+                    if active {
+                        return Ok(true);
+                    }
+                }
+                // Garbage after the last row: skip the rest of the page
+                None => self.pos = self.data_end,
+            }
+        }
+    }
+
+    fn current(&self) -> RawRow<'_> {
+        RawRow {
+            page_num: self.page_num,
+            offset: self.offset,
+            page: self.page(),
+            cols: &self.cols[..self.count],
+            end: self.end,
+        }
+    }
+}
+
+// ── Filter and Limit ─────────────────────────────────────────────────────────
+
+/// Passes on the rows of `inner` that satisfy a predicate.
+pub struct Filter<C> {
+    inner: C,
+    predicate: Option<Predicate>,
+}
+
+impl<C: Cursor> Filter<C> {
+    /// With no predicate every row passes.
+    pub fn new(inner: C, predicate: Option<Predicate>) -> Filter<C> {
+        Filter { inner, predicate }
+    }
+}
+
+impl<C: Cursor> Cursor for Filter<C> {
+    fn advance(&mut self) -> DbResult<bool> {
+        while self.inner.advance()? {
+            match &self.predicate {
+                Some(p) if !p.matches(&self.inner.current()) => {}
+                _ => return Ok(true),
+            }
+        }
+        Ok(false)
+    }
+
+    fn current(&self) -> RawRow<'_> {
+        self.inner.current()
+    }
+}
+
+/// Ends the stream of `inner` after `limit` rows, without reading further.
+pub struct Limit<C> {
+    inner: C,
+    remaining: u32,
+}
+
+impl<C: Cursor> Limit<C> {
+    pub fn new(inner: C, limit: Option<u32>) -> Limit<C> {
+        Limit { inner, remaining: limit.unwrap_or(u32::MAX) }
+    }
+}
+
+impl<C: Cursor> Cursor for Limit<C> {
+    fn advance(&mut self) -> DbResult<bool> {
+        if self.remaining == 0 || !self.inner.advance()? {
+            return Ok(false);
+        }
+        if self.remaining != u32::MAX {
+            self.remaining -= 1;
+        }
+        Ok(true)
+    }
+
+    fn current(&self) -> RawRow<'_> {
+        self.inner.current()
+    }
+}
+
+// ── Predicates ───────────────────────────────────────────────────────────────
+
+/// A WHERE clause with its column names resolved, evaluated against
+/// [`RawRow`]s.
+pub enum Predicate {
+    Compare(CmpOp, Operand, Operand),
+    /// A bare column: true unless NULL or 0.
+    Truthy(usize),
+    Const(bool),
+    And(Box<Predicate>, Box<Predicate>),
+    Or(Box<Predicate>, Box<Predicate>),
+}
+
+/// One side of a comparison.
+pub enum Operand {
+    Column(usize),
+    Literal(Value),
+}
+
+impl Predicate {
+    /// Resolve a WHERE clause, with `params` substituted for its
+    /// placeholders.  `resolve` maps a column name to its position in the
+    /// rows the predicate will see (`None`: no such column).
+    pub fn compile(
+        expr: &Expr,
+        resolve: &dyn Fn(&str) -> DbResult<Option<usize>>,
+        params: &[Value],
+    ) -> DbResult<Predicate> {
+        let column = |name: &String| resolve(name)?
+            .ok_or_else(|| DbError::ColumnNotFound(name.clone()));
+        let operand = |e: &Expr| match e {
+            Expr::Column(name) => Ok(Operand::Column(column(name)?)),
+            _ => match e.value(params)? {
+                Some(v) => Ok(Operand::Literal(v.clone())),
+                None => Err(DbError::Parse(String::from("Complex expression in comparison"))),
+            },
+        };
+        if let Some(v) = expr.value(params)? {
+            return Ok(Predicate::Const(!matches!(v, Value::Integer(0))));
+        }
+        Ok(match expr {
+            Expr::BinOp { op, left, right } => Predicate::Compare(*op, operand(left)?, operand(right)?),
+            Expr::And(l, r) => Predicate::And(
+                Box::new(Predicate::compile(l, resolve, params)?),
+                Box::new(Predicate::compile(r, resolve, params)?),
+            ),
+            Expr::Or(l, r) => Predicate::Or(
+                Box::new(Predicate::compile(l, resolve, params)?),
+                Box::new(Predicate::compile(r, resolve, params)?),
+            ),
+            Expr::Column(name) => Predicate::Truthy(column(name)?),
+            Expr::Literal(_) | Expr::Param(_) => unreachable!(),
+        })
+    }
+
+    pub fn matches<R: Columns + ?Sized>(&self, row: &R) -> bool {
+        match self {
+            Predicate::Compare(op, l, r) => compare(operand(l, row), operand(r, row), *op),
+            Predicate::Truthy(col) => !matches!(row.get(*col), ValueRef::Null | ValueRef::Integer(0)),
+            Predicate::Const(b) => *b,
+            Predicate::And(l, r) => l.matches(row) && r.matches(row),
+            Predicate::Or(l, r) => l.matches(row) || r.matches(row),
+        }
+    }
+}
+
+fn operand<'a, R: Columns + ?Sized>(op: &'a Operand, row: &'a R) -> ValueRef<'a> {
+    match op {
+        Operand::Column(col) => row.get(*col),
+        Operand::Literal(v) => ValueRef::from(v),
+    }
+}
+
+/// Compare two values with a comparison operator.
+pub fn compare(left: ValueRef, right: ValueRef, op: CmpOp) -> bool {
+    match (left, right) {
+        (ValueRef::Null, ValueRef::Null) => matches!(op, CmpOp::Eq),
+        (ValueRef::Null, _) | (_, ValueRef::Null) => matches!(op, CmpOp::Ne),
+        (ValueRef::Integer(a), ValueRef::Integer(b)) => {
+            match op {
+                CmpOp::Eq => a == b,
+                CmpOp::Ne => a != b,
+                CmpOp::Lt => a < b,
+                CmpOp::Gt => a > b,
+                CmpOp::Le => a <= b,
+                CmpOp::Ge => a >= b,
+            }
+        }
+        (ValueRef::Text(a), ValueRef::Text(b)) => {
+            match op {
+                CmpOp::Eq => a.eq_ignore_ascii_case(b),
+                CmpOp::Ne => !a.eq_ignore_ascii_case(b),
+                CmpOp::Lt => a < b,
+                CmpOp::Gt => a > b,
+                CmpOp::Le => a <= b,
+                CmpOp::Ge => a >= b,
+            }
+        }
+        // Cross-type comparison: integer vs text
+        (ValueRef::Integer(a), ValueRef::Text(b)) => {
+            // Try parsing text as integer
+            match parse_int(b) {
+                Some(bv) => compare(ValueRef::Integer(a), ValueRef::Integer(bv), op),
+                None => matches!(op, CmpOp::Ne),
+            }
+        }
+        (ValueRef::Text(a), ValueRef::Integer(b)) => {
+            match parse_int(a) {
+                Some(av) => compare(ValueRef::Integer(av), ValueRef::Integer(b), op),
+                None => matches!(op, CmpOp::Ne),
+            }
+        }
+    }
+}
+
+/// Try to parse a string as i64.
+pub fn parse_int(s: &str) -> Option<i64> {
+    let bytes = s.as_bytes();
+    if bytes.is_empty() { return None; }
+    let (neg, start) = if bytes[0] == b'-' { (true, 1) } else { (false, 0) };
+    if start >= bytes.len() { return None; }
+    let mut val: i64 = 0;
+    for &b in &bytes[start..] {
+        if !b.is_ascii_digit() { return None; }
+        val = val.checked_mul(10)?.checked_add((b - b'0') as i64)?;
+    }
+    if neg { Some(-val) } else { Some(val) }
+}
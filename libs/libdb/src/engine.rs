@@ -1,16 +1,33 @@
 //! Page-based storage engine.
 //!
 //! Manages the on-disk database file: page I/O, row serialization,
-//! table scanning, row insertion, deletion, and page allocation.
-//! File I/O uses the `syscall` module (same pattern as libanyui).
+//! row insertion, deletion, and page allocation (scans are in
+//! [`crate::cursor`]).  Row
+//! changes keep the table's indexes (see [`crate::btree`]) in step.
+//! Page I/O goes through the database's [`BufferPool`], and committed
+//! changes go to its write-ahead log ([`Wal`]); file I/O uses the
+//! `syscall` module (same pattern as libanyui).
+//!
+//! Locking lets any number of processes share a database.  A statement (or
+//! a whole transaction) runs under its handle's lock: writers take the
+//! log's exclusive writer lock, read-only handles a shared `flock` of the
+//! main file.  A checkpoint, which rewrites the main file and restarts the
+//! log under every reader's feet, also needs the main file exclusively; it
+//! never waits for readers but is put off to a later commit instead.
 
 extern crate alloc;
 
 use alloc::string::String;
 use alloc::vec::Vec;
+use core::cell::RefCell;
 use crate::types::*;
+use crate::btree::{self, Key};
+use crate::bufpool::{self, BufferPool, CacheStats};
+use crate::cursor::{Cursor, Scan};
+use crate::prepare::ParseCache;
 use crate::schema;
 use crate::syscall;
+use crate::wal::{self, Wal};
 
 // ── Database handle ──────────────────────────────────────────────────────────
 
@@ -23,14 +40,67 @@ pub struct Database {
     pub tables: Vec<TableSchema>,
     /// Number of tables.
     pub table_count: u32,
+    /// Index definitions (in sync with the index directory page).
+    pub indexes: Vec<IndexSchema>,
+    /// Index directory page (0 = not allocated yet).
+    index_dir_page: u32,
     /// First free page (for page reuse — 0 = none, allocate at end).
     first_free_page: u32,
     /// Total pages in the file.
     total_pages: u32,
+    /// Cached pages (read through `&self`, hence the cell).
+    pool: RefCell<BufferPool>,
+    wal: Wal,
+    /// Inside `BEGIN` … `COMMIT`.
+    in_transaction: bool,
+    /// Holding the handle's lock (see the module docs).
+    locked: bool,
+    /// Row serialization buffer, reused by every insert.
+    row_buf: Vec<u8>,
+    /// Recently parsed SQL.
+    pub parse_cache: ParseCache,
+    /// The main file, mapped for a read-only handle.
+    map: Option<Mapping>,
     /// Last error message.
     pub last_error: String,
 }
 
+/// A database file mapped read-only into the address space.
+struct Mapping {
+    addr: u64,
+    pages: u32,
+}
+
+impl Mapping {
+    /// Map every whole page of the file `fd`.
+    fn new(fd: u32) -> DbResult<Mapping> {
+        let pages = syscall::file_size(fd) / PAGE_SIZE as u32;
+        if pages == 0 {
+            return Err(DbError::Corrupt(String::from("Database file is empty")));
+        }
+        let addr = syscall::mmap_file(fd, 0, pages * PAGE_SIZE as u32, 0, syscall::MAP_PRIVATE);
+        if addr == u64::MAX {
+            return Err(DbError::Io(String::from("Cannot map database file")));
+        }
+        Ok(Mapping { addr, pages })
+    }
+
+    fn page(&self, page_num: u32) -> Option<&[u8; PAGE_SIZE]> {
+        if page_num >= self.pages {
+            return None;
+        }
+        let ptr = (self.addr as usize + page_num as usize * PAGE_SIZE) as *const [u8; PAGE_SIZE];
+        // Mapped for as long as `self` lives, and never written
+        Some(unsafe { &*ptr })
+    }
+}
+
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        syscall::munmap(self.addr, self.pages * PAGE_SIZE as u32);
+    }
+}
+
 impl Database {
     /// Open or create a database file.
     pub fn open(path: &str) -> DbResult<Database> {
@@ -42,52 +112,122 @@ impl Database {
             syscall::close(fd);
         }
 
-        if file_exists && file_size >= PAGE_SIZE as u32 {
-            // File exists with valid content — open for read+write
-            let fd = syscall::open(path, syscall::O_WRITE);
-            if fd == u32::MAX {
-                return Err(DbError::Io(String::from("Cannot open database for writing")));
+        // An existing file is never truncated: its pages may be in the log
+        let flags = if file_exists { syscall::O_WRITE } else { syscall::O_WRITE | syscall::O_CREATE };
+        let fd = syscall::open(path, flags);
+        if fd == u32::MAX {
+            return Err(DbError::Io(String::from("Cannot open database for writing")));
+        }
+        let mut wal_path = String::from(path);
+        wal_path.push_str("-wal");
+        let wal = match Wal::open(&wal_path) {
+            Ok(wal) => wal,
+            Err(e) => {
+                syscall::close(fd);
+                return Err(e);
             }
-            let mut db = Database {
-                fd,
-                page0: [0u8; PAGE_SIZE],
-                tables: Vec::new(),
-                table_count: 0,
-                first_free_page: 0,
-                total_pages: 0,
-                last_error: String::new(),
-            };
+        };
+
+        let mut db = Database {
+            fd,
+            page0: [0u8; PAGE_SIZE],
+            tables: Vec::new(),
+            table_count: 0,
+            indexes: Vec::new(),
+            index_dir_page: 0,
+            first_free_page: 0,
+            total_pages: 1,
+            pool: RefCell::new(BufferPool::new(bufpool::DEFAULT_CACHE_PAGES)),
+            wal,
+            in_transaction: false,
+            // Wal::open returns holding the writer lock
+            locked: true,
+            row_buf: Vec::new(),
+            parse_cache: ParseCache::new(),
+            map: None,
+            last_error: String::new(),
+        };
+        if file_size >= PAGE_SIZE as u32 || db.wal.db_pages > 0 {
             db.load_page0()?;
-            Ok(db)
         } else {
-            // File does not exist or is empty — create/initialize new database
-            let flags = if file_exists {
-                syscall::O_WRITE | syscall::O_TRUNC
-            } else {
-                syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC
-            };
-            let fd = syscall::open(path, flags);
-            if fd == u32::MAX {
-                return Err(DbError::Io(String::from("Cannot create database file")));
-            }
-            let mut db = Database {
-                fd,
-                page0: [0u8; PAGE_SIZE],
-                tables: Vec::new(),
-                table_count: 0,
-                first_free_page: 0,
-                total_pages: 1,
-                last_error: String::new(),
-            };
+            // File does not exist or is empty — initialize new database
             schema::init_header(&mut db.page0);
             db.write_page(0, &db.page0.clone())?;
-            Ok(db)
+            db.write_back()?;
+        }
+        db.unlock();
+        Ok(db)
+    }
+
+    /// Open an existing database for reading only, with its file mapped
+    /// into memory.  Pages are read straight out of the mapping (only pages
+    /// committed to the log since the last checkpoint are read through it),
+    /// and queries decode rows in the mapped pages without copying them.
+    /// Every change fails with [`DbError::ReadOnly`].
+    pub fn open_readonly_mmap(path: &str) -> DbResult<Database> {
+        let fd = syscall::open(path, 0);
+        if fd == u32::MAX {
+            return Err(DbError::Io(String::from("Cannot open database")));
+        }
+        // Keep checkpoints out until the first look at the log is done
+        if syscall::flock(fd, syscall::LOCK_SH) != 0 {
+            syscall::close(fd);
+            return Err(DbError::Io(String::from("Cannot lock database")));
         }
+        let mut wal_path = String::from(path);
+        wal_path.push_str("-wal");
+        let opened = Wal::open_readonly(&wal_path)
+            .and_then(|wal| Ok((wal, Mapping::new(fd)?)));
+        let (wal, map) = match opened {
+            Ok(opened) => opened,
+            Err(e) => {
+                syscall::close(fd);
+                return Err(e);
+            }
+        };
+
+        let mut db = Database {
+            fd,
+            page0: [0u8; PAGE_SIZE],
+            tables: Vec::new(),
+            table_count: 0,
+            indexes: Vec::new(),
+            index_dir_page: 0,
+            first_free_page: 0,
+            total_pages: 1,
+            // Only logged pages and the index directory go through the pool
+            pool: RefCell::new(BufferPool::new(bufpool::MIN_CACHE_PAGES)),
+            wal,
+            in_transaction: false,
+            locked: true,
+            row_buf: Vec::new(),
+            parse_cache: ParseCache::new(),
+            map: Some(map),
+            last_error: String::new(),
+        };
+        db.load_page0()?;
+        db.unlock();
+        Ok(db)
     }
 
-    /// Close the database (flush and release fd).
+    /// Close the database: commit pending changes (an open transaction is
+    /// rolled back), checkpoint the log unless a reader is using it, and
+    /// release the files.  A read-only handle is just unmapped.
     pub fn close(&mut self) {
         if self.fd != u32::MAX {
+            if self.map.is_some() {
+                self.unlock();
+                self.map = None;
+            } else if self.lock().is_ok() {
+                if self.in_transaction {
+                    self.rollback();
+                } else {
+                    let _ = self.write_back();
+                }
+                let _ = self.try_checkpoint();
+                self.unlock();
+            }
+            self.wal.close();
             syscall::close(self.fd);
             self.fd = u32::MAX;
         }
@@ -95,59 +235,232 @@ impl Database {
 
     // ── Page I/O ─────────────────────────────────────────────────────────
 
-    /// Read a page from disk into buffer.
-    fn read_page(&self, page_num: u32, buf: &mut [u8; PAGE_SIZE]) -> DbResult<()> {
-        let offset = page_num as i32 * PAGE_SIZE as i32;
-        if syscall::lseek(self.fd, offset, syscall::SEEK_SET) == u32::MAX {
-            return Err(DbError::Io(String::from("Seek failed")));
+    /// Read a page into buffer.
+    pub(crate) fn read_page(&self, page_num: u32, buf: &mut [u8; PAGE_SIZE]) -> DbResult<()> {
+        if let Some(page) = self.mapped_page(page_num) {
+            buf.copy_from_slice(page);
+            return Ok(());
         }
-        let n = syscall::read(self.fd, buf);
-        if n == u32::MAX {
-            return Err(DbError::Io(String::from("Read failed")));
+        self.pool.borrow_mut().read(self.fd, &self.wal, page_num, buf)
+    }
+
+    /// A page of a read-only handle, in place in the mapped file; `None`
+    /// if the handle is not mapped or the current version of the page is
+    /// in the log.
+    pub(crate) fn mapped_page(&self, page_num: u32) -> Option<&[u8; PAGE_SIZE]> {
+        let map = self.map.as_ref()?;
+        if self.wal.contains(page_num) {
+            return None;
         }
-        // Zero-fill if we read less than a full page (new pages)
-        if (n as usize) < PAGE_SIZE {
-            buf[n as usize..].fill(0);
+        map.page(page_num)
+    }
+
+    /// Write a page.  It reaches the log when the statement (or the
+    /// transaction around it) commits.
+    pub(crate) fn write_page(&self, page_num: u32, buf: &[u8; PAGE_SIZE]) -> DbResult<()> {
+        if self.map.is_some() {
+            return Err(DbError::ReadOnly);
         }
+        self.pool.borrow_mut().write(page_num, buf);
         Ok(())
     }
 
-    /// Write a page to disk.
-    fn write_page(&self, page_num: u32, buf: &[u8; PAGE_SIZE]) -> DbResult<()> {
-        let offset = page_num as i32 * PAGE_SIZE as i32;
-        if syscall::lseek(self.fd, offset, syscall::SEEK_SET) == u32::MAX {
-            return Err(DbError::Io(String::from("Seek failed")));
+    // ── Transactions ─────────────────────────────────────────────────────
+
+    /// Called before each statement: outside a transaction, take the
+    /// handle's lock and pick up what other handles committed since the
+    /// last statement.
+    pub fn begin_statement(&mut self) -> DbResult<()> {
+        if self.in_transaction {
+            return Ok(());
+        }
+        self.lock()?;
+        let refreshed = self.refresh();
+        if refreshed.is_err() {
+            self.unlock();
         }
-        let n = syscall::write(self.fd, buf);
-        if n == u32::MAX || n as usize != PAGE_SIZE {
-            return Err(DbError::Io(String::from("Write failed")));
+        refreshed
+    }
+
+    fn refresh(&mut self) -> DbResult<()> {
+        let salt = self.wal.salt();
+        if self.wal.refresh()? {
+            self.pool.get_mut().clear();
+            // A checkpoint rewrote (and may have grown) the main file
+            if self.map.is_some() && self.wal.salt() != salt {
+                self.map = None;
+                self.map = Some(Mapping::new(self.fd)?);
+            }
+            self.load_page0()?;
         }
         Ok(())
     }
 
-    /// Load page 0 and parse table directory.
-    fn load_page0(&mut self) -> DbResult<()> {
-        // Inline page read to avoid borrow conflict (self vs self.page0)
-        if syscall::lseek(self.fd, 0, syscall::SEEK_SET) == u32::MAX {
-            return Err(DbError::Io(String::from("Seek failed")));
+    /// Called after each statement.  Outside a transaction its changes are
+    /// committed (or dropped if it failed); inside one they wait for
+    /// `COMMIT`, and a failed statement rolls the whole transaction back.
+    pub fn end_statement(&mut self, ok: bool) -> DbResult<()> {
+        let result = if ok && self.in_transaction {
+            Ok(())
+        } else if !ok {
+            self.in_transaction = false;
+            self.rollback();
+            Ok(())
+        } else {
+            self.write_back()
+        };
+        self.end_query();
+        result
+    }
+
+    /// Called after each query: outside a transaction, release the lock.
+    pub fn end_query(&mut self) {
+        if !self.in_transaction {
+            self.unlock();
+        }
+    }
+
+    fn lock(&mut self) -> DbResult<()> {
+        if self.locked {
+            return Ok(());
+        }
+        if self.map.is_some() {
+            if syscall::flock(self.fd, syscall::LOCK_SH) != 0 {
+                return Err(DbError::Io(String::from("Cannot lock database")));
+            }
+        } else {
+            self.wal.lock()?;
         }
-        let n = syscall::read(self.fd, &mut self.page0);
-        if n == u32::MAX {
-            return Err(DbError::Io(String::from("Read failed")));
+        self.locked = true;
+        Ok(())
+    }
+
+    fn unlock(&mut self) {
+        if !self.locked {
+            return;
+        }
+        if self.map.is_some() {
+            syscall::flock(self.fd, syscall::LOCK_UN);
+        } else {
+            self.wal.unlock();
+        }
+        self.locked = false;
+    }
+
+    /// `BEGIN`: hold changes until [`commit`](Self::commit).
+    pub fn begin(&mut self) -> DbResult<()> {
+        if self.in_transaction {
+            return Err(DbError::Parse(String::from("Transaction already active")));
+        }
+        self.in_transaction = true;
+        Ok(())
+    }
+
+    /// `COMMIT`: write the transaction's changes to the log.
+    pub fn commit(&mut self) -> DbResult<()> {
+        if !self.in_transaction {
+            return Err(DbError::Parse(String::from("No transaction is active")));
+        }
+        self.in_transaction = false;
+        self.write_back()
+    }
+
+    /// `ROLLBACK`: drop the transaction's changes.
+    pub fn rollback_transaction(&mut self) -> DbResult<()> {
+        if !self.in_transaction {
+            return Err(DbError::Parse(String::from("No transaction is active")));
+        }
+        self.in_transaction = false;
+        self.rollback();
+        Ok(())
+    }
+
+    /// Commit every changed page to the log, checkpointing once it is large.
+    fn write_back(&mut self) -> DbResult<()> {
+        self.pool.get_mut().write_back(&mut self.wal, self.total_pages)?;
+        if self.wal.frames() >= wal::CHECKPOINT_FRAMES {
+            self.try_checkpoint()?;
+        }
+        Ok(())
+    }
+
+    /// Checkpoint if no read-only handle is inside a statement.  Returns
+    /// false, having done nothing, if one is.
+    fn try_checkpoint(&mut self) -> DbResult<bool> {
+        if syscall::flock(self.fd, syscall::LOCK_EX | syscall::LOCK_NB) != 0 {
+            return Ok(false);
+        }
+        let result = self.wal.checkpoint(self.fd);
+        syscall::flock(self.fd, syscall::LOCK_UN);
+        result.map(|()| true)
+    }
+
+    /// Drop every uncommitted change and reload the committed schema.
+    fn rollback(&mut self) {
+        self.pool.get_mut().discard_dirty();
+        if self.load_page0().is_err() {
+            self.pool.get_mut().clear();
+        }
+    }
+
+    /// Checkpoint the log into the main file now (`PRAGMA wal_checkpoint`).
+    pub fn checkpoint(&mut self) -> DbResult<()> {
+        if self.map.is_some() {
+            return Err(DbError::ReadOnly);
+        }
+        if self.in_transaction {
+            return Err(DbError::Parse(String::from("Cannot checkpoint inside a transaction")));
         }
-        if (n as usize) < PAGE_SIZE {
-            self.page0[n as usize..].fill(0);
+        if !self.try_checkpoint()? {
+            return Err(DbError::Busy);
         }
+        Ok(())
+    }
+
+    /// Log counters, frames since the last checkpoint, and pages logged.
+    pub fn wal_stats(&self) -> (wal::WalStats, u32, usize) {
+        (self.wal.stats, self.wal.frames(), self.wal.pages())
+    }
+
+    /// Set how many commits share one sync of the log.
+    pub fn set_group_commit(&mut self, commits: u32) {
+        self.wal.group_commit = commits.clamp(1, wal::MAX_GROUP_COMMIT);
+    }
+
+    pub fn group_commit(&self) -> u32 {
+        self.wal.group_commit
+    }
+
+    /// Buffer pool counters, pages cached, and capacity in pages.
+    pub fn cache_stats(&self) -> (CacheStats, usize, usize) {
+        let pool = self.pool.borrow();
+        (pool.stats, pool.cached(), pool.capacity())
+    }
+
+    /// Change the buffer pool capacity (in pages, clamped to the allowed range).
+    pub fn set_cache_size(&mut self, pages: usize) {
+        self.pool.get_mut().resize(pages);
+    }
+
+    /// Load page 0 and parse table directory.
+    fn load_page0(&mut self) -> DbResult<()> {
+        let mut page0 = [0u8; PAGE_SIZE];
+        self.read_page(0, &mut page0)?;
+        self.page0 = page0;
         let (tc, ff) = schema::read_header(&self.page0)?;
         self.table_count = tc;
         self.first_free_page = ff;
         self.tables = schema::read_tables(&self.page0, tc)?;
-        let file_size = syscall::file_size(self.fd);
-        self.total_pages = if file_size > 0 {
-            (file_size as usize / PAGE_SIZE).max(1) as u32
-        } else {
-            1
-        };
+        let file_pages = (syscall::file_size(self.fd) as usize / PAGE_SIZE) as u32;
+        self.total_pages = file_pages.max(self.wal.db_pages).max(1);
+
+        self.indexes.clear();
+        self.index_dir_page = schema::read_index_dir_page(&self.page0);
+        if self.index_dir_page != 0 {
+            let mut dir = [0u8; PAGE_SIZE];
+            self.read_page(self.index_dir_page, &mut dir)?;
+            self.indexes = schema::read_indexes(&dir, &self.tables)?;
+        }
         Ok(())
     }
 
@@ -160,10 +473,22 @@ impl Database {
         self.write_page(0, &self.page0.clone())
     }
 
+    /// Flush the index directory to disk (after index changes), then page 0.
+    fn flush_indexes(&mut self) -> DbResult<()> {
+        if self.index_dir_page == 0 {
+            self.index_dir_page = self.alloc_page()?;
+            schema::write_index_dir_page(&mut self.page0, self.index_dir_page);
+        }
+        let mut dir = [0u8; PAGE_SIZE];
+        schema::write_indexes(&mut dir, &self.indexes);
+        self.write_page(self.index_dir_page, &dir)?;
+        self.flush_page0()
+    }
+
     // ── Page allocation ──────────────────────────────────────────────────
 
-    /// Allocate a new data page. Returns page number.
-    fn alloc_page(&mut self) -> DbResult<u32> {
+    /// Allocate a new data or index page. Returns page number.
+    pub(crate) fn alloc_page(&mut self) -> DbResult<u32> {
         if self.first_free_page != 0 {
             // Reuse a free page
             let page_num = self.first_free_page;
@@ -184,8 +509,8 @@ impl Database {
         }
     }
 
-    /// Free a data page (add to free list).
-    fn free_page(&mut self, page_num: u32) -> DbResult<()> {
+    /// Free a data or index page (add to free list).
+    pub(crate) fn free_page(&mut self, page_num: u32) -> DbResult<()> {
         let mut page = [0u8; PAGE_SIZE];
         // Write next-free pointer as first 4 bytes
         page[0..4].copy_from_slice(&self.first_free_page.to_le_bytes());
@@ -227,19 +552,26 @@ impl Database {
         self.flush_page0()
     }
 
-    /// Drop a table by name, freeing all its data pages.
+    /// Drop a table by name, freeing all its data pages and indexes.
     pub fn drop_table(&mut self, name: &str) -> DbResult<()> {
         let idx = schema::find_table(&self.tables, name)
             .ok_or_else(|| DbError::TableNotFound(String::from(name)))?;
 
-        // Free all data pages in the chain
-        let mut page_num = self.tables[idx].first_data_page;
-        while page_num != 0 {
-            let mut page = [0u8; PAGE_SIZE];
-            self.read_page(page_num, &mut page)?;
-            let next = u32::from_le_bytes([page[0], page[1], page[2], page[3]]);
-            self.free_page(page_num)?;
-            page_num = next;
+        self.free_data_pages(idx)?;
+
+        let mut i = 0;
+        let mut dropped = false;
+        while i < self.indexes.len() {
+            if self.indexes[i].table.eq_ignore_ascii_case(name) {
+                self.btree_free(self.indexes[i].root)?;
+                self.indexes.remove(i);
+                dropped = true;
+            } else {
+                i += 1;
+            }
+        }
+        if dropped {
+            self.flush_indexes()?;
         }
 
         // Remove from schema list and compact
@@ -253,10 +585,155 @@ impl Database {
         self.flush_page0()
     }
 
+    /// Delete every row of a table at once, freeing its data pages and
+    /// emptying its indexes.  Returns the number of rows deleted.
+    pub fn truncate_table(&mut self, table_idx: usize) -> DbResult<u32> {
+        let count = self.tables[table_idx].row_count;
+        self.free_data_pages(table_idx)?;
+        self.tables[table_idx].first_data_page = 0;
+        self.tables[table_idx].row_count = 0;
+        for i in 0..self.indexes.len() {
+            if self.indexes[i].table.eq_ignore_ascii_case(&self.tables[table_idx].name) {
+                self.btree_clear(self.indexes[i].root)?;
+            }
+        }
+        self.flush_page0()?;
+        Ok(count)
+    }
+
+    /// Free all data pages in a table's chain.
+    fn free_data_pages(&mut self, table_idx: usize) -> DbResult<()> {
+        let mut page_num = self.tables[table_idx].first_data_page;
+        while page_num != 0 {
+            let mut page = [0u8; PAGE_SIZE];
+            self.read_page(page_num, &mut page)?;
+            let next = u32::from_le_bytes([page[0], page[1], page[2], page[3]]);
+            self.free_page(page_num)?;
+            page_num = next;
+        }
+        Ok(())
+    }
+
+    // ── Index management ─────────────────────────────────────────────────
+
+    /// Create an index over one column and fill it from the table's rows.
+    pub fn create_index(
+        &mut self,
+        name: &str,
+        table_name: &str,
+        column: &str,
+        unique: bool,
+        primary: bool,
+    ) -> DbResult<()> {
+        if self.indexes.len() >= MAX_INDEXES {
+            return Err(DbError::TooManyIndexes);
+        }
+        if name.len() > MAX_INDEX_NAME {
+            return Err(DbError::Parse(String::from("Index name too long")));
+        }
+        if schema::find_index(&self.indexes, name).is_some() {
+            return Err(DbError::IndexExists(String::from(name)));
+        }
+        let table_idx = schema::find_table(&self.tables, table_name)
+            .ok_or_else(|| DbError::TableNotFound(String::from(table_name)))?;
+        let col = self.tables[table_idx].find_column(column)
+            .ok_or_else(|| DbError::ColumnNotFound(String::from(column)))?;
+
+        let index = IndexSchema {
+            name: String::from(name),
+            table: self.tables[table_idx].name.clone(),
+            column: col,
+            unique,
+            primary,
+            root: self.btree_create()?,
+        };
+        let mut keys = Vec::new();
+        let mut scan = Scan::table(self, table_idx);
+        while scan.advance()? {
+            let row = scan.current();
+            keys.push(Key { value: row.value(col), rowid: row.rowid() });
+        }
+        for key in keys {
+            let built = match self.check_key(&index, &key.value, None) {
+                Ok(()) => self.btree_insert(index.root, key),
+                Err(e) => Err(e),
+            };
+            if let Err(e) = built {
+                self.btree_free(index.root)?;
+                self.flush_page0()?;
+                return Err(e);
+            }
+        }
+
+        self.indexes.push(index);
+        self.flush_indexes()
+    }
+
+    /// Drop an index by name, freeing its pages.
+    pub fn drop_index(&mut self, name: &str) -> DbResult<()> {
+        let idx = schema::find_index(&self.indexes, name)
+            .ok_or_else(|| DbError::IndexNotFound(String::from(name)))?;
+        if self.indexes[idx].primary {
+            return Err(DbError::Parse(String::from("Cannot drop a PRIMARY KEY index")));
+        }
+        let index = self.indexes.remove(idx);
+        self.btree_free(index.root)?;
+        self.flush_indexes()
+    }
+
+    /// Check a key against an index's constraints.  `exclude` is the row
+    /// being replaced by an update, which may keep its own value.
+    fn check_key(&self, index: &IndexSchema, value: &Value, exclude: Option<u64>) -> DbResult<()> {
+        if *value == Value::Null {
+            if index.primary {
+                let mut msg = String::from("NULL in PRIMARY KEY column of ");
+                msg.push_str(&index.table);
+                return Err(DbError::Constraint(msg));
+            }
+            return Ok(());
+        }
+        if index.unique
+            && self.btree_find(index.root, value)?.iter().any(|&r| Some(r) != exclude)
+        {
+            let mut msg = String::from("duplicate key in unique index ");
+            msg.push_str(&index.name);
+            return Err(DbError::Constraint(msg));
+        }
+        Ok(())
+    }
+
+    /// Check a new row against every index of its table.
+    fn check_row(&self, table_idx: usize, values: &[Value], exclude: Option<u64>) -> DbResult<()> {
+        let table = &self.tables[table_idx].name;
+        for index in self.indexes.iter().filter(|i| i.table.eq_ignore_ascii_case(table)) {
+            let value = values.get(index.column).unwrap_or(&Value::Null);
+            self.check_key(index, value, exclude)?;
+        }
+        Ok(())
+    }
+
+    /// Add (or with `remove`, delete) a row's keys in every index of its table.
+    fn update_indexes(&mut self, table_idx: usize, values: &[Value], rowid: u64, remove: bool) -> DbResult<()> {
+        for i in 0..self.indexes.len() {
+            if !self.indexes[i].table.eq_ignore_ascii_case(&self.tables[table_idx].name) {
+                continue;
+            }
+            let root = self.indexes[i].root;
+            let value = values.get(self.indexes[i].column).cloned().unwrap_or(Value::Null);
+            let key = Key { value, rowid };
+            if remove {
+                self.btree_delete(root, &key)?;
+            } else {
+                self.btree_insert(root, key)?;
+            }
+        }
+        Ok(())
+    }
+
     // ── Row serialization ────────────────────────────────────────────────
 
-    /// Serialize a row's values into bytes. Returns serialized data.
-    pub fn serialize_row(values: &[Value]) -> DbResult<Vec<u8>> {
+    /// Serialize a row's values into `buf` (replacing its contents).
+    pub fn serialize_row(values: &[Value], buf: &mut Vec<u8>) -> DbResult<()> {
         let total_size: usize = values.iter().map(|v| v.serialized_size()).sum();
         // Row format: flag(1) + row_len(2) + value data
         let row_size = 1 + 2 + total_size;
@@ -264,30 +741,16 @@ impl Database {
             return Err(DbError::RowTooLarge);
         }
 
-        let mut buf = Vec::with_capacity(row_size);
+        buf.clear();
+        buf.reserve(row_size);
         buf.push(ROW_ACTIVE); // flag
         buf.push((total_size & 0xFF) as u8);       // row_len low
         buf.push(((total_size >> 8) & 0xFF) as u8); // row_len high
 
         for val in values {
-            match val {
-                Value::Null => buf.push(TAG_NULL),
-                Value::Integer(v) => {
-                    buf.push(TAG_INTEGER);
-                    buf.extend_from_slice(&v.to_le_bytes());
-                }
-                Value::Text(s) => {
-                    if s.len() > 255 {
-                        return Err(DbError::ValueTooLarge);
-                    }
-                    buf.push(TAG_TEXT);
-                    buf.push((s.len() & 0xFF) as u8);
-                    buf.push(((s.len() >> 8) & 0xFF) as u8);
-                    buf.extend_from_slice(s.as_bytes());
-                }
-            }
+            encode_value(buf, val)?;
         }
-        Ok(buf)
+        Ok(())
     }
 
     /// Deserialize a row from bytes at the given offset.
@@ -310,78 +773,109 @@ impl Database {
         let mut pos = offset + 3;
         let end = offset + 3 + row_len;
 
+        let end = end.min(data.len());
+
         for _ in 0..col_count {
-            if pos >= end { break; }
-            match data[pos] {
-                TAG_NULL => {
-                    values.push(Value::Null);
-                    pos += 1;
+            match decode_value(data, pos, end) {
+                Some((val, next)) => {
+                    values.push(val);
+                    pos = next;
                 }
-                TAG_INTEGER => {
-                    if pos + 9 > end { break; }
-                    let v = i64::from_le_bytes([
-                        data[pos + 1], data[pos + 2], data[pos + 3], data[pos + 4],
-                        data[pos + 5], data[pos + 6], data[pos + 7], data[pos + 8],
-                    ]);
-                    values.push(Value::Integer(v));
-                    pos += 9;
-                }
-                TAG_TEXT => {
-                    if pos + 3 > end { break; }
-                    let slen = u16::from_le_bytes([data[pos + 1], data[pos + 2]]) as usize;
-                    if pos + 3 + slen > end { break; }
-                    let s = core::str::from_utf8(&data[pos + 3..pos + 3 + slen]).unwrap_or("");
-                    values.push(Value::Text(String::from(s)));
-                    pos += 3 + slen;
-                }
-                _ => break,
+                None => break,
             }
         }
 
         Some((Row { values }, total))
     }
 
-    // ── Table scan ───────────────────────────────────────────────────────
+    // ── Row insertion ────────────────────────────────────────────────────
 
-    /// Scan all active rows of a table. Returns a Vec of (page_num, offset_in_page, Row).
-    pub fn scan_table(&self, table_idx: usize) -> DbResult<Vec<(u32, usize, Row)>> {
-        let table = &self.tables[table_idx];
-        let col_count = table.columns.len();
-        let mut results = Vec::new();
-        let mut page_num = table.first_data_page;
+    /// Insert a row into a table and its indexes. Returns the row's
+    /// location `(page_num, offset)`.
+    pub fn insert_row(&mut self, table_idx: usize, values: &[Value]) -> DbResult<(u32, usize)> {
+        self.check_row(table_idx, values, None)?;
+        let (page_num, offset) = self.append_row(table_idx, values)?;
+        self.update_indexes(table_idx, values, btree::rowid(page_num, offset), false)?;
+        Ok((page_num, offset))
+    }
 
-        while page_num != 0 {
-            let mut page = [0u8; PAGE_SIZE];
+    /// Insert many rows into a table and its indexes. Returns the number
+    /// inserted.
+    ///
+    /// Rows are packed in memory into the table's last page and then into
+    /// new pages, so each page is written once and page 0 once at the end.
+    /// Unlike [`insert_row`](Self::insert_row), earlier pages with room left
+    /// by deletions are not searched.
+    pub fn insert_rows(&mut self, table_idx: usize, rows: &[Vec<Value>]) -> DbResult<u32> {
+        if rows.is_empty() {
+            return Ok(0);
+        }
+        let mut row_data = core::mem::take(&mut self.row_buf);
+        let packed = self.pack_rows(table_idx, rows, &mut row_data);
+        self.row_buf = row_data;
+        packed?;
+
+        self.tables[table_idx].row_count += rows.len() as u32;
+        self.flush_page0()?;
+        Ok(rows.len() as u32)
+    }
+
+    fn pack_rows(&mut self, table_idx: usize, rows: &[Vec<Value>], row_data: &mut Vec<u8>) -> DbResult<()> {
+        // Find the tail of the chain; a fresh table has none
+        let mut page = [0u8; PAGE_SIZE];
+        let mut page_num: u32 = 0;
+        let mut next = self.tables[table_idx].first_data_page;
+        while next != 0 {
+            page_num = next;
             self.read_page(page_num, &mut page)?;
+            next = u32::from_le_bytes([page[0], page[1], page[2], page[3]]);
+        }
+        let mut data_end = match u16::from_le_bytes([page[6], page[7]]) as usize {
+            0 => DATA_PAGE_HEADER,
+            n => n,
+        };
 
-            let next_page = u32::from_le_bytes([page[0], page[1], page[2], page[3]]);
-            let data_end = u16::from_le_bytes([page[6], page[7]]) as usize;
-            let data_end = if data_end == 0 { DATA_PAGE_HEADER } else { data_end };
+        for values in rows {
+            self.check_row(table_idx, values, None)?;
+            Self::serialize_row(values, row_data)?;
+            let row_len = row_data.len();
 
-            let mut offset = DATA_PAGE_HEADER;
-            while offset < data_end {
-                match Self::deserialize_row(&page, offset, col_count) {
-                    Some((row, consumed)) => {
-                        if !row.values.is_empty() {
-                            results.push((page_num, offset, row));
-                        }
-                        offset += consumed;
-                    }
-                    None => break,
+            if page_num == 0 || data_end + row_len > PAGE_SIZE {
+                let new_page_num = self.alloc_page()?;
+                if page_num == 0 {
+                    self.tables[table_idx].first_data_page = new_page_num;
+                } else {
+                    page[0..4].copy_from_slice(&new_page_num.to_le_bytes());
+                    self.write_page(page_num, &page)?;
                 }
+                page.fill(0);
+                page_num = new_page_num;
+                data_end = DATA_PAGE_HEADER;
             }
 
-            page_num = next_page;
+            page[data_end..data_end + row_len].copy_from_slice(row_data);
+            let rc = u16::from_le_bytes([page[4], page[5]]);
+            page[4..6].copy_from_slice(&(rc + 1).to_le_bytes());
+            page[6..8].copy_from_slice(&((data_end + row_len) as u16).to_le_bytes());
+            self.update_indexes(table_idx, values, btree::rowid(page_num, data_end), false)?;
+            data_end += row_len;
         }
-
-        Ok(results)
+        self.write_page(page_num, &page)
     }
 
-    // ── Row insertion ────────────────────────────────────────────────────
+    /// Store a row in the table's page chain. Updates row count.
+    fn append_row(&mut self, table_idx: usize, values: &[Value]) -> DbResult<(u32, usize)> {
+        // The serialization buffer is kept between rows
+        let mut row_data = core::mem::take(&mut self.row_buf);
+        let stored = match Self::serialize_row(values, &mut row_data) {
+            Ok(()) => self.store_row(table_idx, &row_data),
+            Err(e) => Err(e),
+        };
+        self.row_buf = row_data;
+        stored
+    }
 
-    /// Insert a row into a table. Updates page chain and row count.
-    pub fn insert_row(&mut self, table_idx: usize, values: &[Value]) -> DbResult<()> {
-        let row_data = Self::serialize_row(values)?;
+    fn store_row(&mut self, table_idx: usize, row_data: &[u8]) -> DbResult<(u32, usize)> {
         let row_len = row_data.len();
 
         let table = &self.tables[table_idx];
@@ -397,7 +891,7 @@ impl Database {
             let data_end = if data_end == 0 { DATA_PAGE_HEADER } else { data_end };
 
             if data_end + row_len <= PAGE_SIZE {
-                page[data_end..data_end + row_len].copy_from_slice(&row_data);
+                page[data_end..data_end + row_len].copy_from_slice(row_data);
                 let new_end = (data_end + row_len) as u16;
                 page[6..8].copy_from_slice(&new_end.to_le_bytes());
                 let rc = u16::from_le_bytes([page[4], page[5]]);
@@ -406,7 +900,7 @@ impl Database {
 
                 self.tables[table_idx].row_count += 1;
                 self.flush_page0()?;
-                return Ok(());
+                return Ok((page_num, data_end));
             }
 
             prev_page_num = page_num;
@@ -419,7 +913,7 @@ impl Database {
         new_page[4..6].copy_from_slice(&1u16.to_le_bytes());
         let data_end = DATA_PAGE_HEADER + row_len;
         new_page[6..8].copy_from_slice(&(data_end as u16).to_le_bytes());
-        new_page[DATA_PAGE_HEADER..DATA_PAGE_HEADER + row_len].copy_from_slice(&row_data);
+        new_page[DATA_PAGE_HEADER..DATA_PAGE_HEADER + row_len].copy_from_slice(row_data);
         self.write_page(new_page_num, &new_page)?;
 
         if prev_page_num != 0 {
@@ -432,16 +926,23 @@ impl Database {
         }
 
         self.tables[table_idx].row_count += 1;
-        self.flush_page0()
+        self.flush_page0()?;
+        Ok((new_page_num, DATA_PAGE_HEADER))
     }
 
     // ── Row deletion ─────────────────────────────────────────────────────
 
-    /// Delete a row at a specific location (page_num, offset).
+    /// Delete a row at a specific location (page_num, offset), removing
+    /// its index keys.
     pub fn delete_row(&mut self, table_idx: usize, page_num: u32, offset: usize) -> DbResult<()> {
         let mut page = [0u8; PAGE_SIZE];
         self.read_page(page_num, &mut page)?;
 
+        let col_count = self.tables[table_idx].columns.len();
+        let old = match Self::deserialize_row(&page, offset, col_count) {
+            Some((row, _)) if !row.values.is_empty() => row,
+            _ => return Ok(()),
+        };
         page[offset] = ROW_DELETED;
 
         let rc = u16::from_le_bytes([page[4], page[5]]);
@@ -454,12 +955,14 @@ impl Database {
         if self.tables[table_idx].row_count > 0 {
             self.tables[table_idx].row_count -= 1;
         }
+        self.update_indexes(table_idx, &old.values, btree::rowid(page_num, offset), true)?;
         self.flush_page0()
     }
 
     // ── Row update ───────────────────────────────────────────────────────
 
     /// Update a row: delete old + insert new. Simple but correct for v1.
+    /// Constraints are checked first, against every row but this one.
     pub fn update_row(
         &mut self,
         table_idx: usize,
@@ -467,8 +970,91 @@ impl Database {
         offset: usize,
         new_values: &[Value],
     ) -> DbResult<()> {
+        self.check_row(table_idx, new_values, Some(btree::rowid(page_num, offset)))?;
         self.delete_row(table_idx, page_num, offset)?;
-        self.insert_row(table_idx, new_values)
+        let (new_page, new_offset) = self.append_row(table_idx, new_values)?;
+        self.update_indexes(table_idx, new_values, btree::rowid(new_page, new_offset), false)
+    }
+}
+
+// ── Value encoding ───────────────────────────────────────────────────────────
+
+/// Append a value in row format (tag + data). Shared by rows and index keys.
+pub(crate) fn encode_value(buf: &mut Vec<u8>, val: &Value) -> DbResult<()> {
+    match val {
+        Value::Null => buf.push(TAG_NULL),
+        Value::Integer(v) => {
+            buf.push(TAG_INTEGER);
+            buf.extend_from_slice(&v.to_le_bytes());
+        }
+        Value::Text(s) => {
+            if s.len() > 255 {
+                return Err(DbError::ValueTooLarge);
+            }
+            buf.push(TAG_TEXT);
+            buf.push((s.len() & 0xFF) as u8);
+            buf.push(((s.len() >> 8) & 0xFF) as u8);
+            buf.extend_from_slice(s.as_bytes());
+        }
+    }
+    Ok(())
+}
+
+/// A value borrowed from a page (see [`decode_ref`]).
+#[derive(Debug, Clone, Copy)]
+pub enum ValueRef<'a> {
+    Null,
+    Integer(i64),
+    Text(&'a str),
+}
+
+impl<'a> ValueRef<'a> {
+    pub fn to_value(self) -> Value {
+        match self {
+            ValueRef::Null => Value::Null,
+            ValueRef::Integer(v) => Value::Integer(v),
+            ValueRef::Text(s) => Value::Text(String::from(s)),
+        }
+    }
+}
+
+impl<'a> From<&'a Value> for ValueRef<'a> {
+    fn from(v: &'a Value) -> ValueRef<'a> {
+        match v {
+            Value::Null => ValueRef::Null,
+            Value::Integer(v) => ValueRef::Integer(*v),
+            Value::Text(s) => ValueRef::Text(s),
+        }
+    }
+}
+
+/// Decode the value at `pos`, which must end by `end`.
+/// Returns the value and the position after it.
+pub(crate) fn decode_value(data: &[u8], pos: usize, end: usize) -> Option<(Value, usize)> {
+    decode_ref(data, pos, end).map(|(v, next)| (v.to_value(), next))
+}
+
+/// [`decode_value`] without copying text out of `data`.
+pub(crate) fn decode_ref(data: &[u8], pos: usize, end: usize) -> Option<(ValueRef<'_>, usize)> {
+    if pos >= end { return None; }
+    match data[pos] {
+        TAG_NULL => Some((ValueRef::Null, pos + 1)),
+        TAG_INTEGER => {
+            if pos + 9 > end { return None; }
+            let v = i64::from_le_bytes([
+                data[pos + 1], data[pos + 2], data[pos + 3], data[pos + 4],
+                data[pos + 5], data[pos + 6], data[pos + 7], data[pos + 8],
+            ]);
+            Some((ValueRef::Integer(v), pos + 9))
+        }
+        TAG_TEXT => {
+            if pos + 3 > end { return None; }
+            let slen = u16::from_le_bytes([data[pos + 1], data[pos + 2]]) as usize;
+            if pos + 3 + slen > end { return None; }
+            let s = core::str::from_utf8(&data[pos + 3..pos + 3 + slen]).unwrap_or("");
+            Some((ValueRef::Text(s), pos + 3 + slen))
+        }
+        _ => None,
     }
 }
 
@@ -2,50 +2,121 @@
 //!
 //! Takes a parsed [`Statement`] AST and executes it against the storage engine,
 //! producing either a row count (for DDL/DML) or a [`ResultSet`] (for SELECT).
+//! Rows stream through [`crate::cursor`] operators (scan → filter → limit)
+//! and only the rows kept are decoded; WHERE clauses that constrain an
+//! indexed column read only the rows the index names (see [`open_scan`]).
+//! ORDER BY sorts the projected rows, keeping just the best `LIMIT` of them
+//! in a heap when both are given.  Aggregates and GROUP BY fold rows into
+//! [`crate::aggregate`] groups as they stream past; a two-table JOIN runs
+//! through [`crate::join`].
 
 extern crate alloc;
 
+use alloc::boxed::Box;
+use alloc::collections::BinaryHeap;
 use alloc::string::String;
 use alloc::vec::Vec;
+use core::cmp::Ordering;
 use crate::types::*;
+use crate::btree::{self, Bound};
+use crate::aggregate::{AggSpec, Grouper};
+use crate::cursor::{self, Columns, Cursor, Filter, Limit, Predicate, Scan};
 use crate::engine::Database;
+use crate::join;
 use crate::schema;
 
-/// Execute a non-query statement (CREATE, DROP, INSERT, UPDATE, DELETE).
-/// Returns the number of rows affected.
-pub fn exec(db: &mut Database, stmt: Statement) -> DbResult<u32> {
+/// Execute a non-query statement (CREATE, DROP, INSERT, UPDATE, DELETE,
+/// BEGIN/COMMIT/ROLLBACK, PRAGMA action). Returns the number of rows affected.
+///
+/// `params` are the values of the statement's `?` placeholders, in order.
+///
+/// Outside `BEGIN` … `COMMIT` each statement is its own transaction: its
+/// changes are committed once it succeeds and dropped if it fails.
+pub fn exec(db: &mut Database, stmt: &Statement, params: &[Value]) -> DbResult<u32> {
+    db.begin_statement()?;
+    let result = exec_statement(db, stmt, params);
+    let ended = db.end_statement(result.is_ok());
+    let count = result?;
+    ended?;
+    Ok(count)
+}
+
+fn exec_statement(db: &mut Database, stmt: &Statement, params: &[Value]) -> DbResult<u32> {
     match stmt {
-        Statement::CreateTable { name, columns } => {
+        Statement::CreateTable { name, columns, primary_key } => {
+            if primary_key.is_some() && schema::find_index(&db.indexes, name).is_some() {
+                return Err(DbError::IndexExists(name.clone()));
+            }
             db.create_table(&name, &columns)?;
+            if let Some(col) = primary_key {
+                // The primary key's index is named after its table
+                if let Err(e) = db.create_index(&name, &name, &col, true, true) {
+                    db.drop_table(&name)?;
+                    return Err(e);
+                }
+            }
             Ok(0)
         }
         Statement::DropTable { name } => {
             db.drop_table(&name)?;
             Ok(0)
         }
-        Statement::Insert { table, columns, values } => {
-            exec_insert(db, &table, &columns, &values)
+        Statement::CreateIndex { name, table, column, unique } => {
+            db.create_index(name, table, column, *unique, false)?;
+            Ok(0)
+        }
+        Statement::DropIndex { name } => {
+            db.drop_index(&name)?;
+            Ok(0)
+        }
+        Statement::Insert { table, columns, rows } => {
+            exec_insert(db, table, columns, rows, params)
         }
         Statement::Update { table, assignments, where_clause } => {
-            exec_update(db, &table, &assignments, where_clause.as_ref())
+            exec_update(db, table, assignments, where_clause.as_ref(), params)
         }
         Statement::Delete { table, where_clause } => {
-            exec_delete(db, &table, where_clause.as_ref())
+            exec_delete(db, table, where_clause.as_ref(), params)
         }
-        Statement::Select { .. } => {
+        Statement::Pragma { name, value: Some(value) } => {
+            exec_set_pragma(db, name, value)
+        }
+        Statement::Pragma { name, value: None } if name.eq_ignore_ascii_case("wal_checkpoint") => {
+            db.checkpoint()?;
+            Ok(0)
+        }
+        Statement::Pragma { .. } => {
+            Err(DbError::Parse(String::from("Use query() to read a PRAGMA")))
+        }
+        Statement::Begin => {
+            db.begin()?;
+            Ok(0)
+        }
+        Statement::Commit => {
+            db.commit()?;
+            Ok(0)
+        }
+        Statement::Rollback => {
+            db.rollback_transaction()?;
+            Ok(0)
+        }
+        Statement::Select(_) => {
             Err(DbError::Parse(String::from("Use query() for SELECT statements")))
         }
     }
 }
 
-/// Execute a SELECT query and return a result set.
-pub fn query(db: &mut Database, stmt: Statement) -> DbResult<ResultSet> {
-    match stmt {
-        Statement::Select { table, columns, where_clause } => {
-            exec_select(db, &table, &columns, where_clause.as_ref())
-        }
+/// Execute a SELECT query and return a result set.  Outside a transaction
+/// it sees everything committed so far, by any handle.
+pub fn query(db: &mut Database, stmt: &Statement, params: &[Value]) -> DbResult<ResultSet> {
+    db.begin_statement()?;
+    let result = match stmt {
+        Statement::Select(select) => exec_select(db, select, params),
+        Statement::Pragma { name, value: None } => query_pragma(db, name),
         _ => Err(DbError::Parse(String::from("Expected SELECT statement"))),
-    }
+    };
+    db.end_query();
+    result
 }
 
 // ── INSERT ───────────────────────────────────────────────────────────────────
@@ -54,159 +125,693 @@ fn exec_insert(
     db: &mut Database,
     table_name: &str,
     col_names: &[String],
-    values: &[Value],
+    rows: &[Vec<Expr>],
+    params: &[Value],
 ) -> DbResult<u32> {
     let table_idx = schema::find_table(&db.tables, table_name)
         .ok_or_else(|| DbError::TableNotFound(String::from(table_name)))?;
+    let schema_cols = &db.tables[table_idx].columns;
 
-    let table = &db.tables[table_idx];
-    let schema_cols = &table.columns;
-
-    // Build the row values in schema column order
-    let row_values = if col_names.is_empty() {
-        // No explicit columns — values must match schema order and count
-        if values.len() != schema_cols.len() {
-            let mut msg = String::from("Expected ");
-            fmt_usize(&mut msg, schema_cols.len());
-            msg.push_str(" values, got ");
-            fmt_usize(&mut msg, values.len());
-            return Err(DbError::TypeMismatch(msg));
-        }
-        // Type-check each value
-        for (i, val) in values.iter().enumerate() {
-            validate_type(val, &schema_cols[i])?;
-        }
-        values.to_vec()
+    // Position in the VALUES list of each schema column (None = NULL)
+    let positions: Vec<Option<usize>> = if col_names.is_empty() {
+        (0..schema_cols.len()).map(Some).collect()
     } else {
-        // Explicit column list — map named columns to schema positions
-        if col_names.len() != values.len() {
+        schema_cols.iter()
+            .map(|sc| col_names.iter().position(|c| c.eq_ignore_ascii_case(&sc.name)))
+            .collect()
+    };
+
+    let mut row_values = Vec::with_capacity(rows.len());
+    for values in rows {
+        if col_names.is_empty() {
+            // No explicit columns — values must match schema order and count
+            if values.len() != schema_cols.len() {
+                let mut msg = String::from("Expected ");
+                fmt_usize(&mut msg, schema_cols.len());
+                msg.push_str(" values, got ");
+                fmt_usize(&mut msg, values.len());
+                return Err(DbError::TypeMismatch(msg));
+            }
+        } else if col_names.len() != values.len() {
             return Err(DbError::TypeMismatch(String::from(
                 "Column count does not match value count",
             )));
         }
+
+        // Build the row values in schema column order, type-checking each
         let mut row = Vec::with_capacity(schema_cols.len());
-        for sc in schema_cols.iter() {
-            let idx = col_names.iter().position(|c| c.eq_ignore_ascii_case(&sc.name));
-            match idx {
+        for (sc, pos) in schema_cols.iter().zip(&positions) {
+            match pos {
                 Some(i) => {
-                    validate_type(&values[i], sc)?;
-                    row.push(values[i].clone());
+                    let val = arg(&values[*i], params)?;
+                    validate_type(&val, sc)?;
+                    row.push(val);
                 }
                 None => row.push(Value::Null),
             }
         }
-        row
-    };
+        row_values.push(row);
+    }
 
-    db.insert_row(table_idx, &row_values)?;
-    Ok(1)
+    // A single row may reuse space in any page; several are packed at the end
+    if let [row] = row_values.as_slice() {
+        db.insert_row(table_idx, row)?;
+        return Ok(1);
+    }
+    db.insert_rows(table_idx, &row_values)
 }
 
 // ── SELECT ───────────────────────────────────────────────────────────────────
 
-fn exec_select(
-    db: &mut Database,
-    table_name: &str,
-    columns: &SelectColumns,
-    where_clause: Option<&Expr>,
-) -> DbResult<ResultSet> {
-    let table_idx = schema::find_table(&db.tables, table_name)
-        .ok_or_else(|| DbError::TableNotFound(String::from(table_name)))?;
+/// A table a SELECT reads.  Its columns are numbered after those of the
+/// tables before it.
+struct Source<'a> {
+    table_idx: usize,
+    schema: &'a TableSchema,
+    /// Alias, or the table's name.
+    name: &'a str,
+    offset: usize,
+}
 
-    let table = &db.tables[table_idx];
-    let schema_cols = &table.columns;
-
-    // Determine which columns to output
-    let (col_indices, col_names, col_types) = match columns {
-        SelectColumns::All => {
-            let indices: Vec<usize> = (0..schema_cols.len()).collect();
-            let names: Vec<String> = schema_cols.iter().map(|c| c.name.clone()).collect();
-            let types: Vec<ColumnType> = schema_cols.iter().map(|c| c.col_type).collect();
-            (indices, names, types)
-        }
-        SelectColumns::Named(names) => {
-            let mut indices = Vec::with_capacity(names.len());
-            let mut out_names = Vec::with_capacity(names.len());
-            let mut out_types = Vec::with_capacity(names.len());
-            for name in names {
-                let idx = table.find_column(name)
-                    .ok_or_else(|| DbError::ColumnNotFound(name.clone()))?;
-                indices.push(idx);
-                out_names.push(schema_cols[idx].name.clone());
-                out_types.push(schema_cols[idx].col_type);
+impl<'a> Source<'a> {
+    /// A column number across all tables as one of this table's columns.
+    fn local(&self, col: usize) -> Option<usize> {
+        col.checked_sub(self.offset).filter(|&c| c < self.schema.columns.len())
+    }
+}
+
+/// The tables of a SELECT in FROM order, with column names resolved across
+/// all of them.
+struct Sources<'a> {
+    list: Vec<Source<'a>>,
+}
+
+impl<'a> Sources<'a> {
+    fn new(db: &'a Database, select: &'a Select) -> DbResult<Sources<'a>> {
+        let mut list: Vec<Source<'a>> = Vec::new();
+        let tables = core::iter::once(&select.from).chain(select.join.as_ref().map(|j| &j.table));
+        for table in tables {
+            let table_idx = schema::find_table(&db.tables, &table.name)
+                .ok_or_else(|| DbError::TableNotFound(table.name.clone()))?;
+            let offset = list.last().map_or(0, |s| s.offset + s.schema.columns.len());
+            list.push(Source {
+                table_idx,
+                schema: &db.tables[table_idx],
+                name: table.alias.as_deref().unwrap_or(&table.name),
+                offset,
+            });
+        }
+        Ok(Sources { list })
+    }
+
+    /// The number of a column across all tables.  `table.col` names the
+    /// table by alias or name; a bare name must belong to one table only.
+    fn resolve(&self, name: &str) -> DbResult<Option<usize>> {
+        if let Some((table, col)) = name.split_once('.') {
+            let source = self.list.iter().find(|s| s.name.eq_ignore_ascii_case(table))
+                .or_else(|| self.list.iter().find(|s| s.schema.name.eq_ignore_ascii_case(table)));
+            return Ok(source.and_then(|s| Some(s.offset + s.schema.find_column(col)?)));
+        }
+        let mut found = None;
+        for s in &self.list {
+            if let Some(c) = s.schema.find_column(name) {
+                if found.is_some() {
+                    let mut msg = String::from("Ambiguous column: ");
+                    msg.push_str(name);
+                    return Err(DbError::Parse(msg));
+                }
+                found = Some(s.offset + c);
             }
-            (indices, out_names, out_types)
+        }
+        Ok(found)
+    }
+
+    fn require(&self, name: &str) -> DbResult<usize> {
+        self.resolve(name)?.ok_or_else(|| DbError::ColumnNotFound(String::from(name)))
+    }
+
+    /// The table a column number belongs to.
+    fn source_of(&self, col: usize) -> usize {
+        self.list.iter().rposition(|s| col >= s.offset).unwrap_or(0)
+    }
+
+    fn column(&self, col: usize) -> &ColumnDef {
+        let s = &self.list[self.source_of(col)];
+        &s.schema.columns[col - s.offset]
+    }
+
+    fn width(&self) -> usize {
+        self.list.iter().map(|s| s.schema.columns.len()).sum()
+    }
+}
+
+/// What a result column is made of.
+enum Output {
+    /// A column number across the SELECT's tables.
+    Column(usize),
+    /// An entry of [`Projection::aggs`].
+    Aggregate(usize),
+}
+
+/// The result columns of a SELECT.
+struct Projection {
+    outputs: Vec<Output>,
+    aggs: Vec<AggSpec>,
+    names: Vec<String>,
+    /// Each result column's name before any `AS` alias.
+    unaliased: Vec<String>,
+    types: Vec<ColumnType>,
+}
+
+impl Projection {
+    fn new(sources: &Sources, columns: &SelectColumns) -> DbResult<Projection> {
+        let mut p = Projection {
+            outputs: Vec::new(), aggs: Vec::new(), names: Vec::new(), unaliased: Vec::new(), types: Vec::new(),
+        };
+        let items = match columns {
+            SelectColumns::All => {
+                for col in 0..sources.width() {
+                    let def = sources.column(col);
+                    p.outputs.push(Output::Column(col));
+                    p.names.push(def.name.clone());
+                    p.unaliased.push(def.name.clone());
+                    p.types.push(def.col_type);
+                }
+                return Ok(p);
+            }
+            SelectColumns::Named(items) => items,
+        };
+        for item in items {
+            let (name, col_type) = match &item.expr {
+                SelectExpr::Column(name) => {
+                    let col = sources.require(name)?;
+                    let def = sources.column(col);
+                    p.outputs.push(Output::Column(col));
+                    (def.name.clone(), def.col_type)
+                }
+                SelectExpr::Aggregate(func, arg) => {
+                    let col = match arg {
+                        Some(name) => Some(sources.require(name)?),
+                        None => None,
+                    };
+                    let arg_type = col.map(|c| sources.column(c).col_type);
+                    if matches!(func, AggFunc::Sum | AggFunc::Avg) && arg_type != Some(ColumnType::Integer) {
+                        let mut msg = String::from(func.name());
+                        msg.push_str(" expects an INTEGER column");
+                        return Err(DbError::TypeMismatch(msg));
+                    }
+                    p.outputs.push(Output::Aggregate(p.aggs.len()));
+                    p.aggs.push(AggSpec { func: *func, col });
+                    let col_type = match func {
+                        AggFunc::Min | AggFunc::Max => arg_type.unwrap_or(ColumnType::Integer),
+                        _ => ColumnType::Integer,
+                    };
+                    (func.call(arg.as_deref()), col_type)
+                }
+            };
+            p.names.push(item.alias.clone().unwrap_or_else(|| name.clone()));
+            p.unaliased.push(name);
+            p.types.push(col_type);
+        }
+        Ok(p)
+    }
+
+    /// The source columns of an ungrouped SELECT.
+    fn columns(&self) -> Vec<usize> {
+        self.outputs.iter().filter_map(|o| match o {
+            Output::Column(c) => Some(*c),
+            Output::Aggregate(_) => None,
+        }).collect()
+    }
+
+    /// The result column an ORDER BY term of a grouped SELECT names.
+    fn find(&self, sources: &Sources, name: &str) -> DbResult<usize> {
+        let named = self.names.iter().position(|n| n.eq_ignore_ascii_case(name))
+            .or_else(|| self.unaliased.iter().position(|n| n.eq_ignore_ascii_case(name)));
+        if let Some(i) = named {
+            return Ok(i);
+        }
+        let col = sources.resolve(name).ok().flatten();
+        self.outputs.iter()
+            .position(|o| matches!(o, Output::Column(c) if Some(*c) == col))
+            .ok_or_else(|| DbError::ColumnNotFound(String::from(name)))
+    }
+}
+
+fn exec_select(db: &mut Database, select: &Select, params: &[Value]) -> DbResult<ResultSet> {
+    let db: &Database = db;
+    let sources = Sources::new(db, select)?;
+    let projection = Projection::new(&sources, &select.columns)?;
+
+    let rows = if !projection.aggs.is_empty() || !select.group_by.is_empty() {
+        grouped_rows(db, &sources, select, &projection, params)?
+    } else {
+        // ORDER BY may name a result column's alias or any source column
+        let mut sort = Vec::with_capacity(select.order_by.len());
+        for term in &select.order_by {
+            let aliased = match &select.columns {
+                SelectColumns::Named(items) => items.iter()
+                    .position(|i| i.alias.as_deref().map_or(false, |a| a.eq_ignore_ascii_case(&term.column))),
+                SelectColumns::All => None,
+            };
+            let col = match aliased.map(|i| &projection.outputs[i]) {
+                Some(Output::Column(c)) => *c,
+                _ => sources.require(&term.column)?,
+            };
+            sort.push((col, term.descending));
+        }
+        let cols = projection.columns();
+        if select.join.is_none() {
+            single_table_rows(db, &sources, select.where_clause.as_ref(), &cols, &sort, select.limit, params)?
+        } else if sort.is_empty() {
+            let limit = select.limit.map_or(usize::MAX, |n| n as usize);
+            let mut rows = Vec::new();
+            if limit > 0 {
+                join_rows(db, &sources, select, params, &mut |row| {
+                    rows.push(project(row, &cols));
+                    Ok(rows.len() < limit)
+                })?;
+            }
+            rows
+        } else {
+            let mut sorter = Sorter::new(&sort, select.limit);
+            join_rows(db, &sources, select, params, &mut |row| {
+                sorter.push(row, &cols);
+                Ok(true)
+            })?;
+            sorter.finish()
         }
     };
 
-    // Scan and filter rows
-    let all_rows = db.scan_table(table_idx)?;
-    let mut result_rows = Vec::new();
+    Ok(ResultSet {
+        col_names: projection.names,
+        col_types: projection.types,
+        rows,
+    })
+}
+
+/// An ungrouped SELECT on one table: rows stream from the scan, so a LIMIT
+/// without ORDER BY stops it early.
+fn single_table_rows(
+    db: &Database,
+    sources: &Sources,
+    where_clause: Option<&Expr>,
+    cols: &[usize],
+    sort: &[(usize, bool)],
+    limit: Option<u32>,
+    params: &[Value],
+) -> DbResult<Vec<Row>> {
+    let filtered = open_source(db, sources, 0, &where_terms(where_clause), params)?;
+    if !sort.is_empty() {
+        return sorted_rows(filtered, cols, sort, limit);
+    }
+    let mut cursor = Limit::new(filtered, limit);
+    let mut rows = Vec::new();
+    while cursor.advance()? {
+        rows.push(cursor.current().project(cols));
+    }
+    Ok(rows)
+}
+
+/// A SELECT with aggregates or GROUP BY: rows feed a [`Grouper`] as they
+/// are read, and only the groups are sorted.
+fn grouped_rows(
+    db: &Database,
+    sources: &Sources,
+    select: &Select,
+    projection: &Projection,
+    params: &[Value],
+) -> DbResult<Vec<Row>> {
+    let mut keys = Vec::with_capacity(select.group_by.len());
+    for name in &select.group_by {
+        keys.push(sources.require(name)?);
+    }
+    if let SelectColumns::All = select.columns {
+        return Err(DbError::Parse(String::from("SELECT * cannot be used with GROUP BY or aggregates")));
+    }
+    // Each plain result column is one of the group keys
+    let mut key_of = Vec::with_capacity(projection.outputs.len());
+    for (i, output) in projection.outputs.iter().enumerate() {
+        key_of.push(match output {
+            Output::Column(c) => match keys.iter().position(|k| k == c) {
+                Some(k) => Some(k),
+                None => {
+                    let mut msg = String::from("Column '");
+                    msg.push_str(&projection.names[i]);
+                    msg.push_str("' must appear in GROUP BY or an aggregate");
+                    return Err(DbError::Parse(msg));
+                }
+            },
+            Output::Aggregate(_) => None,
+        });
+    }
+    let mut sort = Vec::with_capacity(select.order_by.len());
+    for term in &select.order_by {
+        sort.push((projection.find(sources, &term.column)?, term.descending));
+    }
 
-    for (_page, _offset, row) in &all_rows {
-        if let Some(expr) = where_clause {
-            if !eval_where(expr, &row.values, schema_cols)? {
-                continue;
+    let count_only = select.join.is_none() && select.where_clause.is_none() && keys.is_empty()
+        && projection.aggs.iter().all(|a| a.func == AggFunc::Count && a.col.is_none());
+    let groups = if count_only {
+        // COUNT(*) of a whole table is in its directory entry
+        let count = Value::Integer(sources.list[0].schema.row_count as i64);
+        alloc::vec![(Vec::new(), projection.aggs.iter().map(|_| count.clone()).collect())]
+    } else {
+        let aggs = projection.aggs.iter().map(|a| AggSpec { func: a.func, col: a.col }).collect();
+        let mut grouper = Grouper::new(keys, aggs);
+        if select.join.is_none() {
+            let mut cursor = open_source(db, sources, 0, &where_terms(select.where_clause.as_ref()), params)?;
+            while cursor.advance()? {
+                grouper.push(&cursor.current())?;
             }
+        } else {
+            join_rows(db, sources, select, params, &mut |row| {
+                grouper.push(row)?;
+                Ok(true)
+            })?;
         }
-        // Project selected columns
-        let projected: Vec<Value> = col_indices.iter().map(|&i| {
-            if i < row.values.len() {
-                row.values[i].clone()
-            } else {
-                Value::Null
+        grouper.finish()
+    };
+
+    let rows = groups.into_iter().map(|(key, values)| Row {
+        values: projection.outputs.iter().zip(&key_of).map(|(output, k)| match (output, k) {
+            (_, Some(k)) => key[*k].clone(),
+            (Output::Aggregate(a), None) => values[*a].clone(),
+            (Output::Column(_), None) => Value::Null,
+        }).collect(),
+    });
+    if sort.is_empty() {
+        return Ok(rows.take(select.limit.map_or(usize::MAX, |n| n as usize)).collect());
+    }
+    let all: Vec<usize> = (0..projection.outputs.len()).collect();
+    let mut sorter = Sorter::new(&sort, select.limit);
+    for row in rows {
+        sorter.push(&row, &all);
+    }
+    Ok(sorter.finish())
+}
+
+/// The top-level AND terms of an optional WHERE clause.
+fn where_terms(where_clause: Option<&Expr>) -> Vec<&Expr> {
+    let mut terms = Vec::new();
+    if let Some(expr) = where_clause {
+        and_terms(expr, &mut terms);
+    }
+    terms
+}
+
+/// A cursor over the rows of table `which` of `sources` passing `terms`,
+/// which only use its columns.
+fn open_source<'a>(
+    db: &'a Database,
+    sources: &Sources,
+    which: usize,
+    terms: &[&Expr],
+    params: &[Value],
+) -> DbResult<Filter<Scan<'a>>> {
+    let source = &sources.list[which];
+    let resolve = |name: &str| Ok(sources.resolve(name)?.and_then(|c| source.local(c)));
+    open_terms(db, source.table_idx, terms, &resolve, params)
+}
+
+/// Run the join of a two-table SELECT, passing it every joined row that
+/// satisfies the ON and WHERE clauses (see [`crate::join`]).
+fn join_rows(
+    db: &Database,
+    sources: &Sources,
+    select: &Select,
+    params: &[Value],
+    sink: &mut join::Sink,
+) -> DbResult<()> {
+    let mut terms = where_terms(select.where_clause.as_ref());
+    if let Some(j) = &select.join {
+        and_terms(&j.on, &mut terms);
+    }
+
+    // The first column = column term across the tables drives the join
+    let mut key = None;
+    for (i, term) in terms.iter().enumerate() {
+        if let Expr::BinOp { op: CmpOp::Eq, left, right } = term {
+            if let (Expr::Column(a), Expr::Column(b)) = (&**left, &**right) {
+                let (a, b) = (sources.require(a)?, sources.require(b)?);
+                match (sources.source_of(a), sources.source_of(b)) {
+                    (0, 1) => key = Some((i, a, b)),
+                    (1, 0) => key = Some((i, b, a)),
+                    _ => continue,
+                }
+                break;
             }
-        }).collect();
-        result_rows.push(Row { values: projected });
+        }
     }
+    let (key_term, left_key, right_key) = key.ok_or_else(|| DbError::Parse(String::from(
+        "JOIN needs an equality between a column of each table in its ON clause",
+    )))?;
+    terms.remove(key_term);
 
-    Ok(ResultSet {
-        col_names,
-        col_types,
-        rows: result_rows,
+    // Push the terms on one table into its scan
+    let mut side_terms: [Vec<&Expr>; 2] = [Vec::new(), Vec::new()];
+    let mut residual = Vec::new();
+    for term in terms {
+        match tables_used(term, sources)? {
+            0 | 1 => side_terms[0].push(term),
+            2 => side_terms[1].push(term),
+            _ => residual.push(term),
+        }
+    }
+    let resolve = |name: &str| sources.resolve(name);
+    let residual = conjunction(&residual, &resolve, params)?;
+    let mut sink = |row: &dyn Columns| match &residual {
+        Some(p) if !p.matches(row) => Ok(true),
+        _ => sink(row),
+    };
+
+    let (left, right) = (&sources.list[0], &sources.list[1]);
+    let split = left.schema.columns.len();
+    let keys = [left_key, right_key - split];
+    let index = |s: &Source, col: usize, other: ColumnType| {
+        if s.schema.columns[col].col_type != other {
+            return None;
+        }
+        db.indexes.iter()
+            .filter(|i| i.table.eq_ignore_ascii_case(&s.schema.name) && i.column == col)
+            .max_by_key(|i| i.unique)
+            .map(|i| i.root)
+    };
+    let roots = [
+        index(left, keys[0], right.schema.columns[keys[1]].col_type),
+        index(right, keys[1], left.schema.columns[keys[0]].col_type),
+    ];
+    // Seek into the indexed table, the larger one if both are; else hash the smaller
+    let inner = match roots {
+        [Some(_), Some(_)] => Some(if left.schema.row_count > right.schema.row_count { 0 } else { 1 }),
+        [None, Some(_)] => Some(1),
+        [Some(_), None] => Some(0),
+        [None, None] => None,
+    };
+    match inner {
+        Some(inner) => {
+            let outer = 1 - inner;
+            let cursor = open_source(db, sources, outer, &side_terms[outer], params)?;
+            let source = &sources.list[inner];
+            let local = |name: &str| Ok(sources.resolve(name)?.and_then(|c| source.local(c)));
+            let filter = conjunction(&side_terms[inner], &local, params)?;
+            join::index_nested_loop(
+                db, cursor, keys[outer], outer == 0,
+                source.table_idx, roots[inner].unwrap_or(0), filter.as_ref(), split, &mut sink,
+            )
+        }
+        None => {
+            let build = if left.schema.row_count <= right.schema.row_count { 0 } else { 1 };
+            let probe = 1 - build;
+            join::hash_join(
+                open_source(db, sources, build, &side_terms[build], params)?, keys[build],
+                open_source(db, sources, probe, &side_terms[probe], params)?, keys[probe],
+                build == 0, split, &mut sink,
+            )
+        }
+    }
+}
+
+/// Which tables a term reads: bit 0 the FROM table, bit 1 the JOIN table.
+fn tables_used(expr: &Expr, sources: &Sources) -> DbResult<u8> {
+    Ok(match expr {
+        Expr::Column(name) => 1 << sources.source_of(sources.require(name)?),
+        Expr::Literal(_) | Expr::Param(_) => 0,
+        Expr::BinOp { left, right, .. } | Expr::And(left, right) | Expr::Or(left, right) => {
+            tables_used(left, sources)? | tables_used(right, sources)?
+        }
     })
 }
 
+/// One predicate for all of `terms`; `None` if there are none.
+fn conjunction(
+    terms: &[&Expr],
+    resolve: &dyn Fn(&str) -> DbResult<Option<usize>>,
+    params: &[Value],
+) -> DbResult<Option<Predicate>> {
+    let mut predicate: Option<Predicate> = None;
+    for term in terms {
+        let p = Predicate::compile(term, resolve, params)?;
+        predicate = Some(match predicate {
+            Some(q) => Predicate::And(Box::new(q), Box::new(p)),
+            None => p,
+        });
+    }
+    Ok(predicate)
+}
+
+/// The listed columns of any row, in that order.
+fn project<R: Columns + ?Sized>(row: &R, cols: &[usize]) -> Row {
+    Row { values: cols.iter().map(|&c| row.get(c).to_value()).collect() }
+}
+
+// ── ORDER BY ─────────────────────────────────────────────────────────────────
+
+/// A projected row with its sort key.  Ties keep scan order.
+struct Ranked<'s> {
+    key: Vec<Value>,
+    seq: usize,
+    row: Row,
+    /// `(column, descending)` per ORDER BY term.
+    sort: &'s [(usize, bool)],
+}
+
+impl<'s> Ranked<'s> {
+    fn cmp_key(&self, key: &[Value], seq: usize) -> Ordering {
+        for (i, &(_, descending)) in self.sort.iter().enumerate() {
+            let ord = btree::cmp_values(&self.key[i], &key[i]);
+            let ord = if descending { ord.reverse() } else { ord };
+            if ord != Ordering::Equal {
+                return ord;
+            }
+        }
+        self.seq.cmp(&seq)
+    }
+}
+
+impl<'s> Ord for Ranked<'s> {
+    fn cmp(&self, other: &Self) -> Ordering {
+        self.cmp_key(&other.key, other.seq)
+    }
+}
+
+impl<'s> PartialOrd for Ranked<'s> {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl<'s> PartialEq for Ranked<'s> {
+    fn eq(&self, other: &Self) -> bool {
+        self.cmp(other) == Ordering::Equal
+    }
+}
+
+impl<'s> Eq for Ranked<'s> {}
+
+/// Collects rows in ORDER BY order.  With a LIMIT only the best `limit`
+/// rows are kept, in a max-heap whose top is the first row to drop; a row
+/// that cannot make the cut is never projected.
+struct Sorter<'s> {
+    sort: &'s [(usize, bool)],
+    limit: Option<u32>,
+    heap: BinaryHeap<Ranked<'s>>,
+    all: Vec<Ranked<'s>>,
+    seq: usize,
+}
+
+impl<'s> Sorter<'s> {
+    fn new(sort: &'s [(usize, bool)], limit: Option<u32>) -> Sorter<'s> {
+        Sorter { sort, limit, heap: BinaryHeap::new(), all: Vec::new(), seq: 0 }
+    }
+
+    /// Offer a row; `cols` are the columns it is projected to if kept.
+    fn push<R: Columns + ?Sized>(&mut self, row: &R, cols: &[usize]) {
+        let key: Vec<Value> = self.sort.iter().map(|&(col, _)| row.get(col).to_value()).collect();
+        self.seq += 1;
+        let k = match self.limit {
+            None => {
+                self.all.push(Ranked { key, seq: self.seq, row: project(row, cols), sort: self.sort });
+                return;
+            }
+            Some(0) => return,
+            Some(n) => n as usize,
+        };
+        if self.heap.len() == k {
+            match self.heap.peek() {
+                Some(worst) if worst.cmp_key(&key, self.seq) == Ordering::Greater => { self.heap.pop(); }
+                _ => return,
+            }
+        }
+        self.heap.push(Ranked { key, seq: self.seq, row: project(row, cols), sort: self.sort });
+    }
+
+    fn finish(self) -> Vec<Row> {
+        let ranked = if self.limit.is_none() {
+            let mut all = self.all;
+            all.sort_unstable();
+            all
+        } else {
+            self.heap.into_sorted_vec()
+        };
+        ranked.into_iter().map(|r| r.row).collect()
+    }
+}
+
+/// Drain `cursor` in ORDER BY order.
+fn sorted_rows<C: Cursor>(
+    mut cursor: C,
+    col_indices: &[usize],
+    sort: &[(usize, bool)],
+    limit: Option<u32>,
+) -> DbResult<Vec<Row>> {
+    let mut sorter = Sorter::new(sort, limit);
+    if limit == Some(0) {
+        return Ok(Vec::new());
+    }
+    while cursor.advance()? {
+        sorter.push(&cursor.current(), col_indices);
+    }
+    Ok(sorter.finish())
+}
+
 // ── UPDATE ───────────────────────────────────────────────────────────────────
 
 fn exec_update(
     db: &mut Database,
     table_name: &str,
-    assignments: &[(String, Value)],
+    assignments: &[(String, Expr)],
     where_clause: Option<&Expr>,
+    params: &[Value],
 ) -> DbResult<u32> {
     let table_idx = schema::find_table(&db.tables, table_name)
         .ok_or_else(|| DbError::TableNotFound(String::from(table_name)))?;
 
-    let schema_cols = db.tables[table_idx].columns.clone();
+    let schema_cols = &db.tables[table_idx].columns;
 
     // Resolve assignment column indices and validate types
     let mut assign_indices = Vec::with_capacity(assignments.len());
     for (col_name, val) in assignments {
         let idx = db.tables[table_idx].find_column(col_name)
             .ok_or_else(|| DbError::ColumnNotFound(col_name.clone()))?;
-        validate_type(val, &schema_cols[idx])?;
-        assign_indices.push((idx, val.clone()));
+        let val = arg(val, params)?;
+        validate_type(&val, &schema_cols[idx])?;
+        assign_indices.push((idx, val));
     }
 
-    // Scan for matching rows
-    let all_rows = db.scan_table(table_idx)?;
+    // Collect the matching rows, then change them
     let mut to_update: Vec<(u32, usize, Vec<Value>)> = Vec::new();
-
-    for (page, offset, row) in &all_rows {
-        if let Some(expr) = where_clause {
-            if !eval_where(expr, &row.values, &schema_cols)? {
-                continue;
-            }
-        }
+    let mut cursor = open_scan(db, table_idx, where_clause, params)?;
+    while cursor.advance()? {
+        let raw = cursor.current();
         // Build updated row
-        let mut new_values = row.values.clone();
+        let mut new_values = raw.row().values;
         for (idx, val) in &assign_indices {
             if *idx < new_values.len() {
                 new_values[*idx] = val.clone();
             }
         }
-        to_update.push((*page, *offset, new_values));
+        to_update.push((raw.page_num, raw.offset, new_values));
     }
 
     let count = to_update.len() as u32;
@@ -223,23 +828,22 @@ fn exec_delete(
     db: &mut Database,
     table_name: &str,
     where_clause: Option<&Expr>,
+    params: &[Value],
 ) -> DbResult<u32> {
     let table_idx = schema::find_table(&db.tables, table_name)
         .ok_or_else(|| DbError::TableNotFound(String::from(table_name)))?;
 
-    let schema_cols = db.tables[table_idx].columns.clone();
+    // Deleting everything frees the pages instead of marking each row
+    if where_clause.is_none() {
+        return db.truncate_table(table_idx);
+    }
 
-    // Scan for matching rows
-    let all_rows = db.scan_table(table_idx)?;
+    // Collect the matching rows, then delete them
     let mut to_delete: Vec<(u32, usize)> = Vec::new();
-
-    for (page, offset, row) in &all_rows {
-        if let Some(expr) = where_clause {
-            if !eval_where(expr, &row.values, &schema_cols)? {
-                continue;
-            }
-        }
-        to_delete.push((*page, *offset));
+    let mut cursor = open_scan(db, table_idx, where_clause, params)?;
+    while cursor.advance()? {
+        let raw = cursor.current();
+        to_delete.push((raw.page_num, raw.offset));
     }
 
     let count = to_delete.len() as u32;
@@ -251,118 +855,282 @@ fn exec_delete(
     Ok(count)
 }
 
-// ── WHERE expression evaluation ──────────────────────────────────────────────
+// ── Index planning ───────────────────────────────────────────────────────────
 
-/// Evaluate a WHERE expression against a row's values.
-fn eval_where(expr: &Expr, values: &[Value], schema: &[ColumnDef]) -> DbResult<bool> {
-    match expr {
-        Expr::BinOp { op, left, right } => {
-            let lval = eval_value(left, values, schema)?;
-            let rval = eval_value(right, values, schema)?;
-            Ok(compare_values(&lval, &rval, *op))
+/// What the top-level AND terms of a WHERE clause say about one indexed column.
+struct ColumnPlan {
+    column: usize,
+    root: u32,
+    unique: bool,
+    /// Value from a `col = literal` term.
+    eq: Option<Value>,
+    /// Range bounds `(value, inclusive)` from `<`, `<=`, `>`, `>=` terms.
+    lo: Option<(i64, bool)>,
+    hi: Option<(i64, bool)>,
+}
+
+impl ColumnPlan {
+    /// Preference between plans: unique seek, seek, closed range, open range.
+    fn score(&self) -> u8 {
+        match (&self.eq, self.lo.is_some(), self.hi.is_some()) {
+            (Some(_), _, _) if self.unique => 4,
+            (Some(_), _, _) => 3,
+            (None, true, true) => 2,
+            _ => 1,
         }
-        Expr::And(l, r) => {
-            Ok(eval_where(l, values, schema)? && eval_where(r, values, schema)?)
-        }
-        Expr::Or(l, r) => {
-            Ok(eval_where(l, values, schema)? || eval_where(r, values, schema)?)
-        }
-        Expr::Literal(Value::Integer(0)) => Ok(false),
-        Expr::Literal(_) => Ok(true),
-        Expr::Column(name) => {
-            // Truthy check: non-null, non-zero
-            let idx = schema.iter().position(|c| c.name.eq_ignore_ascii_case(name))
-                .ok_or_else(|| DbError::ColumnNotFound(name.clone()))?;
-            if idx < values.len() {
-                match &values[idx] {
-                    Value::Null => Ok(false),
-                    Value::Integer(0) => Ok(false),
-                    _ => Ok(true),
-                }
-            } else {
-                Ok(false)
-            }
+    }
+
+    fn bounds(&self) -> (Bound, Bound) {
+        if let Some(v) = &self.eq {
+            return (Bound::Included(v.clone()), Bound::Included(v.clone()));
         }
+        // An open end still stops at the integers: NULL never compares true
+        let bound = |b: Option<(i64, bool)>, open: i64| match b {
+            Some((v, true)) => Bound::Included(Value::Integer(v)),
+            Some((v, false)) => Bound::Excluded(Value::Integer(v)),
+            None => Bound::Included(Value::Integer(open)),
+        };
+        (bound(self.lo, i64::MIN), bound(self.hi, i64::MAX))
     }
 }
 
-/// Resolve an expression to a concrete value.
-fn eval_value(expr: &Expr, values: &[Value], schema: &[ColumnDef]) -> DbResult<Value> {
-    match expr {
-        Expr::Literal(v) => Ok(v.clone()),
-        Expr::Column(name) => {
-            let idx = schema.iter().position(|c| c.name.eq_ignore_ascii_case(name))
-                .ok_or_else(|| DbError::ColumnNotFound(name.clone()))?;
-            if idx < values.len() {
-                Ok(values[idx].clone())
-            } else {
-                Ok(Value::Null)
-            }
+/// A cursor over the rows matching a WHERE clause.
+fn open_scan<'a>(
+    db: &'a Database,
+    table_idx: usize,
+    where_clause: Option<&Expr>,
+    params: &[Value],
+) -> DbResult<Filter<Scan<'a>>> {
+    let table = &db.tables[table_idx];
+    open_terms(db, table_idx, &where_terms(where_clause), &|name| Ok(table.find_column(name)), params)
+}
+
+/// A cursor over the rows of a table matching all of `terms`, whose column
+/// names `resolve` maps to the table's columns.
+///
+/// Terms of the form `column op literal` (or a bound `?`) on an indexed
+/// column become an index seek (`=`) or a range scan (`<`, `<=`, `>`, `>=`
+/// on INTEGER columns); the best one is used and otherwise the whole table
+/// is read.  Every term is then checked on each row the scan yields,
+/// against the row's stored bytes.
+fn open_terms<'a>(
+    db: &'a Database,
+    table_idx: usize,
+    terms: &[&Expr],
+    resolve: &dyn Fn(&str) -> DbResult<Option<usize>>,
+    params: &[Value],
+) -> DbResult<Filter<Scan<'a>>> {
+    let predicate = conjunction(terms, resolve, params)?;
+    let scan = match plan_index(db, table_idx, terms, resolve, params) {
+        Some(plan) => {
+            let (lo, hi) = plan.bounds();
+            Scan::rows(db, table_idx, db.btree_scan(plan.root, &lo, &hi)?)
         }
-        _ => Err(DbError::Parse(String::from("Complex expression in comparison"))),
-    }
+        None => Scan::table(db, table_idx),
+    };
+    Ok(Filter::new(scan, predicate))
 }
 
-/// Compare two values with a comparison operator.
-fn compare_values(left: &Value, right: &Value, op: CmpOp) -> bool {
-    match (left, right) {
-        (Value::Null, Value::Null) => matches!(op, CmpOp::Eq),
-        (Value::Null, _) | (_, Value::Null) => matches!(op, CmpOp::Ne),
-        (Value::Integer(a), Value::Integer(b)) => {
-            match op {
-                CmpOp::Eq => a == b,
-                CmpOp::Ne => a != b,
-                CmpOp::Lt => a < b,
-                CmpOp::Gt => a > b,
-                CmpOp::Le => a <= b,
-                CmpOp::Ge => a >= b,
+/// Pick the index to answer a WHERE clause with, if any.
+fn plan_index(
+    db: &Database,
+    table_idx: usize,
+    terms: &[&Expr],
+    resolve: &dyn Fn(&str) -> DbResult<Option<usize>>,
+    params: &[Value],
+) -> Option<ColumnPlan> {
+    let table = &db.tables[table_idx];
+    let mut plans: Vec<ColumnPlan> = Vec::new();
+    for &term in terms {
+        let (name, op, literal) = match term {
+            Expr::BinOp { op, left, right } => match (&**left, &**right) {
+                (Expr::Column(c), other) => match other.value(params) {
+                    Ok(Some(v)) => (c, *op, v),
+                    _ => continue,
+                },
+                (other, Expr::Column(c)) => match other.value(params) {
+                    Ok(Some(v)) => (c, flip(*op), v),
+                    _ => continue,
+                },
+                _ => continue,
+            },
+            _ => continue,
+        };
+        let column = match resolve(name) {
+            Ok(Some(c)) => c,
+            _ => continue,
+        };
+        let value = match index_value(table.columns[column].col_type, literal) {
+            Some(v) => v,
+            None => continue,
+        };
+
+        let plan = match plans.iter().position(|p| p.column == column) {
+            Some(i) => &mut plans[i],
+            None => {
+                // Prefer a unique index when a column has several
+                let index = db.indexes.iter()
+                    .filter(|i| i.table.eq_ignore_ascii_case(&table.name) && i.column == column)
+                    .max_by_key(|i| i.unique)?;
+                plans.push(ColumnPlan {
+                    column,
+                    root: index.root,
+                    unique: index.unique,
+                    eq: None,
+                    lo: None,
+                    hi: None,
+                });
+                plans.last_mut().unwrap()
             }
-        }
-        (Value::Text(a), Value::Text(b)) => {
-            match op {
-                CmpOp::Eq => a.eq_ignore_ascii_case(b),
-                CmpOp::Ne => !a.eq_ignore_ascii_case(b),
-                CmpOp::Lt => a < b,
-                CmpOp::Gt => a > b,
-                CmpOp::Le => a <= b,
-                CmpOp::Ge => a >= b,
+        };
+
+        let int = match value {
+            Value::Integer(v) => Some(v),
+            _ => None,
+        };
+        match (op, int) {
+            (CmpOp::Eq, _) => {
+                if plan.eq.is_none() {
+                    plan.eq = Some(value);
+                }
             }
-        }
-        // Cross-type comparison: integer vs text
-        (Value::Integer(a), Value::Text(b)) => {
-            // Try parsing text as integer
-            if let Some(bv) = parse_int(b) {
-                compare_values(&Value::Integer(*a), &Value::Integer(bv), op)
-            } else {
-                matches!(op, CmpOp::Ne)
+            (CmpOp::Gt | CmpOp::Ge, Some(v)) => {
+                let incl = op == CmpOp::Ge;
+                if plan.lo.map_or(true, |(o, oi)| v > o || (v == o && oi && !incl)) {
+                    plan.lo = Some((v, incl));
+                }
             }
-        }
-        (Value::Text(a), Value::Integer(b)) => {
-            if let Some(av) = parse_int(a) {
-                compare_values(&Value::Integer(av), &Value::Integer(*b), op)
-            } else {
-                matches!(op, CmpOp::Ne)
+            (CmpOp::Lt | CmpOp::Le, Some(v)) => {
+                let incl = op == CmpOp::Le;
+                if plan.hi.map_or(true, |(o, oi)| v < o || (v == o && oi && !incl)) {
+                    plan.hi = Some((v, incl));
+                }
             }
+            _ => {}
+        }
+    }
+
+    plans.into_iter()
+        .filter(|p| p.eq.is_some() || p.lo.is_some() || p.hi.is_some())
+        .max_by_key(|p| p.score())
+}
+
+/// Flatten the top-level ANDs of a WHERE clause.
+fn and_terms<'a>(expr: &'a Expr, out: &mut Vec<&'a Expr>) {
+    match expr {
+        Expr::And(l, r) => {
+            and_terms(l, out);
+            and_terms(r, out);
         }
+        _ => out.push(expr),
+    }
+}
+
+/// The operator with its operands swapped (`5 < col` is `col > 5`).
+fn flip(op: CmpOp) -> CmpOp {
+    match op {
+        CmpOp::Lt => CmpOp::Gt,
+        CmpOp::Gt => CmpOp::Lt,
+        CmpOp::Le => CmpOp::Ge,
+        CmpOp::Ge => CmpOp::Le,
+        other => other,
     }
 }
 
-/// Try to parse a string as i64.
-fn parse_int(s: &str) -> Option<i64> {
-    let bytes = s.as_bytes();
-    if bytes.is_empty() { return None; }
-    let (neg, start) = if bytes[0] == b'-' { (true, 1) } else { (false, 0) };
-    if start >= bytes.len() { return None; }
-    let mut val: i64 = 0;
-    for &b in &bytes[start..] {
-        if !b.is_ascii_digit() { return None; }
-        val = val.checked_mul(10)?.checked_add((b - b'0') as i64)?;
+/// The index key a literal compares equal to, by [`compare_values`] rules,
+/// or `None` if the index order does not match them.  Text columns are
+/// only sought by text: `'007'` and `7` compare equal, but sort apart.
+fn index_value(col_type: ColumnType, literal: &Value) -> Option<Value> {
+    match (col_type, literal) {
+        (_, Value::Null) => Some(Value::Null),
+        (ColumnType::Integer, Value::Integer(v)) => Some(Value::Integer(*v)),
+        (ColumnType::Integer, Value::Text(s)) => cursor::parse_int(s).map(Value::Integer),
+        (ColumnType::Text, Value::Text(s)) => Some(Value::Text(s.clone())),
+        (ColumnType::Text, Value::Integer(_)) => None,
+    }
+}
+
+// ── PRAGMA ───────────────────────────────────────────────────────────────────
+
+/// `PRAGMA cache_size = pages`: resize the buffer pool.
+fn exec_set_pragma(db: &mut Database, name: &str, value: &Value) -> DbResult<u32> {
+    if name.eq_ignore_ascii_case("cache_size") {
+        return match value {
+            Value::Integer(n) if *n > 0 => {
+                db.set_cache_size(*n as usize);
+                Ok(0)
+            }
+            _ => Err(DbError::TypeMismatch(String::from("cache_size expects a positive INTEGER"))),
+        };
     }
-    if neg { Some(-val) } else { Some(val) }
+    if name.eq_ignore_ascii_case("group_commit") {
+        return match value {
+            Value::Integer(n) if *n > 0 => {
+                db.set_group_commit((*n).min(u32::MAX as i64) as u32);
+                Ok(0)
+            }
+            _ => Err(DbError::TypeMismatch(String::from("group_commit expects a positive INTEGER"))),
+        };
+    }
+    Err(DbError::Parse(unknown_pragma(name)))
+}
+
+/// `PRAGMA cache_size`, `cache_stats`, `group_commit` and `wal_stats`:
+/// one-row result sets.
+fn query_pragma(db: &Database, name: &str) -> DbResult<ResultSet> {
+    let (stats, cached, capacity) = db.cache_stats();
+    let fields: Vec<(&str, u64)> = if name.eq_ignore_ascii_case("cache_size") {
+        alloc::vec![("cache_size", capacity as u64)]
+    } else if name.eq_ignore_ascii_case("cache_stats") {
+        let reads = stats.hits + stats.misses;
+        let hit_pct = if reads == 0 { 0 } else { stats.hits * 100 / reads };
+        alloc::vec![
+            ("hits", stats.hits),
+            ("misses", stats.misses),
+            ("hit_pct", hit_pct),
+            ("evictions", stats.evictions),
+            ("writes", stats.writes),
+            ("cached", cached as u64),
+            ("capacity", capacity as u64),
+        ]
+    } else if name.eq_ignore_ascii_case("group_commit") {
+        alloc::vec![("group_commit", db.group_commit() as u64)]
+    } else if name.eq_ignore_ascii_case("wal_stats") {
+        let (wal, frames, pages) = db.wal_stats();
+        alloc::vec![
+            ("commits", wal.commits),
+            ("syncs", wal.syncs),
+            ("checkpoints", wal.checkpoints),
+            ("frames", frames as u64),
+            ("pages", pages as u64),
+        ]
+    } else {
+        return Err(DbError::Parse(unknown_pragma(name)));
+    };
+
+    Ok(ResultSet {
+        col_names: fields.iter().map(|(n, _)| String::from(*n)).collect(),
+        col_types: fields.iter().map(|_| ColumnType::Integer).collect(),
+        rows: alloc::vec![Row { values: fields.iter().map(|(_, v)| Value::Integer(*v as i64)).collect() }],
+    })
+}
+
+fn unknown_pragma(name: &str) -> String {
+    let mut msg = String::from("Unknown PRAGMA: ");
+    msg.push_str(name);
+    msg
 }
 
 // ── Helpers ──────────────────────────────────────────────────────────────────
 
+/// The value of an INSERT or SET operand: a literal or bound placeholder.
+fn arg(expr: &Expr, params: &[Value]) -> DbResult<Value> {
+    match expr.value(params)? {
+        Some(v) => Ok(v.clone()),
+        None => Err(DbError::Parse(String::from("Expected value"))),
+    }
+}
+
 /// Validate that a value matches the expected column type.
 fn validate_type(val: &Value, col: &ColumnDef) -> DbResult<()> {
     match (val, col.col_type) {
@@ -0,0 +1,117 @@
+//! Hash tables for GROUP BY and hash joins.
+//!
+//! A [`HashIndex`] only maps hashes to entry numbers; the caller keeps the
+//! entries (groups, or the rows a join builds from) in a `Vec` and checks
+//! each candidate for equality itself, under whatever rules it compares
+//! by.  [`hash_value`] therefore hashes values that any of those rules
+//! call equal alike: text case-insensitively, and text that reads as an
+//! integer as that integer (`'7'` equals `7` in a WHERE comparison).
+
+extern crate alloc;
+
+use alloc::vec;
+use alloc::vec::Vec;
+use crate::cursor;
+use crate::engine::ValueRef;
+
+const FNV_PRIME: u64 = 0x0000_0100_0000_01b3;
+
+/// Chain terminator.
+const NONE: u32 = u32::MAX;
+
+/// Buckets allocated for the first entry.
+const INITIAL_BUCKETS: usize = 64;
+
+/// Hash start value for [`hash_value`] (the FNV-1a offset basis).
+pub const SEED: u64 = 0xcbf2_9ce4_8422_2325;
+
+/// Fold `value` into the FNV-1a hash `h`.
+pub fn hash_value(h: u64, value: ValueRef) -> u64 {
+    let int = match value {
+        ValueRef::Null => return fnv(h, &[0]),
+        ValueRef::Integer(v) => Some(v),
+        ValueRef::Text(s) => cursor::parse_int(s),
+    };
+    match (int, value) {
+        (Some(v), _) => fnv(fnv(h, &[1]), &v.to_le_bytes()),
+        (None, ValueRef::Text(s)) => s.bytes().fold(fnv(h, &[2]), |h, b| fnv(h, &[b.to_ascii_lowercase()])),
+        (None, _) => h,
+    }
+}
+
+fn fnv(mut h: u64, bytes: &[u8]) -> u64 {
+    for &b in bytes {
+        h ^= b as u64;
+        h = h.wrapping_mul(FNV_PRIME);
+    }
+    h
+}
+
+/// Entry numbers by hash, chained through the entries.
+pub struct HashIndex {
+    /// First entry of each bucket's chain.
+    buckets: Vec<u32>,
+    /// Hash and next entry in the chain, per entry.
+    entries: Vec<(u64, u32)>,
+}
+
+impl HashIndex {
+    pub fn new() -> HashIndex {
+        HashIndex { buckets: Vec::new(), entries: Vec::new() }
+    }
+
+    /// Add the next entry (numbered from 0 in insertion order).
+    pub fn insert(&mut self, hash: u64) {
+        if self.entries.len() >= self.buckets.len() {
+            self.grow();
+        }
+        let bucket = self.bucket(hash);
+        self.entries.push((hash, self.buckets[bucket]));
+        self.buckets[bucket] = (self.entries.len() - 1) as u32;
+    }
+
+    /// Entries inserted with `hash`, most recent first.
+    pub fn find(&self, hash: u64) -> Candidates<'_> {
+        let next = if self.buckets.is_empty() { NONE } else { self.buckets[self.bucket(hash)] };
+        Candidates { index: self, hash, next }
+    }
+
+    fn bucket(&self, hash: u64) -> usize {
+        // Mix the high bits in: FNV's low bits are weakest
+        ((hash ^ (hash >> 32)) as usize) & (self.buckets.len() - 1)
+    }
+
+    /// Double the buckets (keeping one per entry) and rechain.
+    fn grow(&mut self) {
+        let n = (self.buckets.len() * 2).max(INITIAL_BUCKETS);
+        self.buckets = vec![NONE; n];
+        for i in 0..self.entries.len() {
+            let bucket = self.bucket(self.entries[i].0);
+            self.entries[i].1 = self.buckets[bucket];
+            self.buckets[bucket] = i as u32;
+        }
+    }
+}
+
+/// Iterator over the entries with one hash.
+pub struct Candidates<'a> {
+    index: &'a HashIndex,
+    hash: u64,
+    next: u32,
+}
+
+impl<'a> Iterator for Candidates<'a> {
+    type Item = usize;
+
+    fn next(&mut self) -> Option<usize> {
+        while self.next != NONE {
+            let i = self.next as usize;
+            let (hash, next) = self.index.entries[i];
+            self.next = next;
+            if hash == self.hash {
+                return Some(i);
+            }
+        }
+        None
+    }
+}
@@ -0,0 +1,130 @@
+//! Two-table inner joins on an equality.
+//!
+//! The executor splits the `ON` and `WHERE` terms: the equality between the
+//! two tables drives the join, terms on one table are pushed into that
+//! table's scan (where they can use its indexes), and the rest are checked
+//! on each joined row.  It then picks one of two strategies:
+//!
+//! - **Index nested loop** ([`index_nested_loop`]) when one table has an
+//!   index on its join column: each row of the other table seeks that
+//!   index for its key.  Nothing is materialized.
+//! - **Hash join** ([`hash_join`]) otherwise: the smaller table's rows are
+//!   read into a hash table on the join key, and the other table probes it
+//!   as it streams past.
+//!
+//! Keys match as `=` does in a WHERE clause.  Either way a joined row is a
+//! [`Pair`], numbering the FROM table's columns first whichever side the
+//! strategy made it.
+
+extern crate alloc;
+
+use alloc::vec::Vec;
+use crate::types::*;
+use crate::btree::Bound;
+use crate::cursor::{self, Columns, Cursor, Predicate, Scan};
+use crate::engine::{Database, ValueRef};
+use crate::hash::{self, HashIndex};
+
+/// Receives each joined row; returns false to stop the join.
+pub type Sink<'s> = dyn FnMut(&dyn Columns) -> DbResult<bool> + 's;
+
+/// A joined row: `first`'s columns, then `second`'s from `split` on.
+pub struct Pair<'r> {
+    pub first: &'r dyn Columns,
+    pub second: &'r dyn Columns,
+    pub split: usize,
+}
+
+impl<'r> Columns for Pair<'r> {
+    fn get(&self, col: usize) -> ValueRef<'_> {
+        if col < self.split {
+            self.first.get(col)
+        } else {
+            self.second.get(col - self.split)
+        }
+    }
+}
+
+/// Emit `a` joined with `b`, `a` being the FROM table's row if `a_first`.
+fn emit(a: &dyn Columns, b: &dyn Columns, a_first: bool, split: usize, sink: &mut Sink) -> DbResult<bool> {
+    let pair = if a_first {
+        Pair { first: a, second: b, split }
+    } else {
+        Pair { first: b, second: a, split }
+    };
+    sink(&pair)
+}
+
+/// For each row of `outer`, seek the index `root` on column `inner_key` of
+/// table `inner` for the outer row's column `outer_key`, and join every
+/// inner row that passes `inner_filter`.
+pub fn index_nested_loop<C: Cursor>(
+    db: &Database,
+    mut outer: C,
+    outer_key: usize,
+    outer_first: bool,
+    inner: usize,
+    root: u32,
+    inner_filter: Option<&Predicate>,
+    split: usize,
+    sink: &mut Sink,
+) -> DbResult<()> {
+    while outer.advance()? {
+        let row = outer.current();
+        let key = row.get(outer_key).to_value();
+        let rowids = db.btree_scan(root, &Bound::Included(key.clone()), &Bound::Included(key))?;
+        if rowids.is_empty() {
+            continue;
+        }
+        let mut matches = Scan::rows(db, inner, rowids);
+        while matches.advance()? {
+            let other = matches.current();
+            if inner_filter.map_or(false, |p| !p.matches(&other)) {
+                continue;
+            }
+            if !emit(&row, &other, outer_first, split, sink)? {
+                return Ok(());
+            }
+        }
+    }
+    Ok(())
+}
+
+/// Read `build` into a hash table on its column `build_key`, then join
+/// each row of `probe` to the rows whose key equals its column
+/// `probe_key`.  Rows come out in `probe` order.
+pub fn hash_join<B: Cursor, P: Cursor>(
+    mut build: B,
+    build_key: usize,
+    mut probe: P,
+    probe_key: usize,
+    build_first: bool,
+    split: usize,
+    sink: &mut Sink,
+) -> DbResult<()> {
+    let mut rows: Vec<Row> = Vec::new();
+    let mut index = HashIndex::new();
+    while build.advance()? {
+        let row = build.current();
+        index.insert(hash::hash_value(hash::SEED, row.get(build_key)));
+        rows.push(row.row());
+    }
+    if rows.is_empty() {
+        return Ok(());
+    }
+
+    while probe.advance()? {
+        let row = probe.current();
+        let key = row.get(probe_key);
+        for i in index.find(hash::hash_value(hash::SEED, key)) {
+            let other = &rows[i];
+            if !cursor::compare(Columns::get(other, build_key), key, CmpOp::Eq) {
+                continue;
+            }
+            if !emit(other, &row, build_first, split, sink)? {
+                return Ok(());
+            }
+        }
+    }
+    Ok(())
+}
@@ -6,8 +6,15 @@
 //! # Architecture
 //! - Single file per database, page-based layout (4096-byte pages)
 //! - Table directory in page 0, data pages in linked chains
-//! - SQL subset: CREATE/DROP TABLE, INSERT, SELECT, UPDATE, DELETE
-//! - 13 C ABI exports for use via dynlink
+//! - Single-column B+tree indexes; WHERE clauses use them for `=` and ranges
+//! - LRU-style (clock) buffer pool per database
+//! - Write-ahead log (`<file>-wal`) with group commit and checkpointing
+//! - SQL subset: CREATE/DROP TABLE, CREATE/DROP INDEX, INSERT, SELECT, UPDATE, DELETE,
+//!   BEGIN/COMMIT/ROLLBACK
+//! - SELECT with COUNT/SUM/MIN/MAX/AVG, GROUP BY and two-table inner joins
+//! - Prepared statements with `?` placeholders; parsed SQL is cached per handle
+//! - Read-only handles that map the file and read rows in place
+//! - 22 C ABI exports for use via dynlink
 //!
 //! # Export Convention
 //! All public functions are `extern "C"` with `#[no_mangle]` for use via `dl_sym()`.
@@ -21,12 +28,21 @@ mod types;
 mod parser;
 mod schema;
 mod engine;
+mod btree;
+mod cursor;
+mod hash;
+mod aggregate;
+mod join;
+mod bufpool;
+mod wal;
 mod executor;
+mod prepare;
 pub mod syscall;
 
 use alloc::vec::Vec;
 use crate::types::*;
 use crate::engine::Database;
+use crate::prepare::Prepared;
 
 // ── Allocator ────────────────────────────────────────────────────────────────
 
@@ -47,9 +63,13 @@ const MAX_HANDLES: usize = 8;
 /// Maximum concurrent result sets.
 const MAX_RESULTS: usize = 16;
 
+/// Maximum concurrent prepared statements.
+const MAX_STATEMENTS: usize = 64;
+
 struct GlobalState {
     handles: Vec<Option<Database>>,
     results: Vec<Option<ResultSet>>,
+    statements: Vec<Option<Prepared>>,
 }
 
 static mut STATE: Option<GlobalState> = None;
@@ -60,6 +80,7 @@ fn state() -> &'static mut GlobalState {
             STATE = Some(GlobalState {
                 handles: Vec::new(),
                 results: Vec::new(),
+                statements: Vec::new(),
             });
         }
         STATE.as_mut().unwrap()
@@ -116,6 +137,48 @@ fn get_result(result_id: u32) -> Option<&'static ResultSet> {
     s.results[idx - 1].as_ref()
 }
 
+/// Allocate a statement slot, returns statement id (1-based) or 0 on failure.
+fn alloc_statement(stmt: Prepared) -> u32 {
+    let s = state();
+    for (i, slot) in s.statements.iter_mut().enumerate() {
+        if slot.is_none() {
+            *slot = Some(stmt);
+            return (i + 1) as u32;
+        }
+    }
+    if s.statements.len() < MAX_STATEMENTS {
+        s.statements.push(Some(stmt));
+        return s.statements.len() as u32;
+    }
+    0
+}
+
+/// Get a prepared statement and the database it belongs to.
+fn get_statement(stmt_id: u32) -> Option<(&'static mut Prepared, &'static mut Database)> {
+    let s = state();
+    let idx = stmt_id as usize;
+    if idx == 0 || idx > s.statements.len() { return None; }
+    let stmt = s.statements[idx - 1].as_mut()?;
+    let db = get_db(stmt.handle)?;
+    Some((stmt, db))
+}
+
+/// Bind a value to a statement parameter. Returns 0 on success, u32::MAX on error.
+fn bind(stmt_id: u32, index: u32, value: Value) -> u32 {
+    let (stmt, db) = match get_statement(stmt_id) {
+        Some(p) => p,
+        None => return u32::MAX,
+    };
+    db.last_error.clear();
+    match stmt.bind(index, value) {
+        Ok(()) => 0,
+        Err(e) => {
+            db.last_error = e.message();
+            u32::MAX
+        }
+    }
+}
+
 // ══════════════════════════════════════════════════════════════════════════════
 //  Exported C API
 // ══════════════════════════════════════════════════════════════════════════════
@@ -147,6 +210,22 @@ pub extern "C" fn libdb_open(path_ptr: *const u8, path_len: u32) -> u32 {
     }
 }
 
+/// Open an existing database read-only, with its file memory-mapped.
+/// Returns handle (1+), or 0 on error.
+#[no_mangle]
+pub extern "C" fn libdb_open_readonly(path_ptr: *const u8, path_len: u32) -> u32 {
+    let path = unsafe {
+        let slice = core::slice::from_raw_parts(path_ptr, path_len as usize);
+        core::str::from_utf8(slice).unwrap_or("")
+    };
+    if path.is_empty() { return 0; }
+
+    match Database::open_readonly_mmap(path) {
+        Ok(db) => alloc_handle(db),
+        Err(_) => 0,
+    }
+}
+
 /// Close a database handle.
 #[no_mangle]
 pub extern "C" fn libdb_close(handle: u32) {
@@ -156,6 +235,12 @@ pub extern "C" fn libdb_close(handle: u32) {
         if let Some(mut db) = s.handles[idx - 1].take() {
             db.close();
         }
+        // Statements prepared on the handle go with it
+        for slot in s.statements.iter_mut() {
+            if slot.as_ref().map_or(false, |p| p.handle == handle) {
+                *slot = None;
+            }
+        }
     }
 }
 
@@ -192,15 +277,19 @@ pub extern "C" fn libdb_exec(handle: u32, sql_ptr: *const u8, sql_len: u32) -> u
 
     db.last_error.clear();
 
-    let stmt = match parser::parse_sql(sql) {
-        Ok(s) => s,
+    let compiled = match db.parse_cache.get(sql) {
+        Ok(c) => c,
         Err(e) => {
             db.last_error = e.message();
             return u32::MAX;
         }
     };
+    if compiled.params > 0 {
+        db.last_error = unbound_param(0).message();
+        return u32::MAX;
+    }
 
-    match executor::exec(db, stmt) {
+    match executor::exec(db, &compiled.stmt, &[]) {
         Ok(count) => count,
         Err(e) => {
             db.last_error = e.message();
@@ -224,15 +313,19 @@ pub extern "C" fn libdb_query(handle: u32, sql_ptr: *const u8, sql_len: u32) ->
 
     db.last_error.clear();
 
-    let stmt = match parser::parse_sql(sql) {
-        Ok(s) => s,
+    let compiled = match db.parse_cache.get(sql) {
+        Ok(c) => c,
         Err(e) => {
             db.last_error = e.message();
             return 0;
         }
     };
+    if compiled.params > 0 {
+        db.last_error = unbound_param(0).message();
+        return 0;
+    }
 
-    match executor::query(db, stmt) {
+    match executor::query(db, &compiled.stmt, &[]) {
         Ok(rs) => alloc_result(rs),
         Err(e) => {
             db.last_error = e.message();
@@ -241,6 +334,113 @@ pub extern "C" fn libdb_query(handle: u32, sql_ptr: *const u8, sql_len: u32) ->
     }
 }
 
+/// Prepare a statement with `?` placeholders. Returns statement id (1+), or 0 on error.
+#[no_mangle]
+pub extern "C" fn libdb_prepare(handle: u32, sql_ptr: *const u8, sql_len: u32) -> u32 {
+    let sql = unsafe {
+        let slice = core::slice::from_raw_parts(sql_ptr, sql_len as usize);
+        core::str::from_utf8(slice).unwrap_or("")
+    };
+
+    let db = match get_db(handle) {
+        Some(db) => db,
+        None => return 0,
+    };
+
+    db.last_error.clear();
+
+    let compiled = match db.parse_cache.get(sql) {
+        Ok(c) => c,
+        Err(e) => {
+            db.last_error = e.message();
+            return 0;
+        }
+    };
+
+    let id = alloc_statement(Prepared::new(handle, compiled));
+    if id == 0 {
+        db.last_error = alloc::string::String::from("Too many prepared statements");
+    }
+    id
+}
+
+/// Bind a 64-bit integer (given as low/high halves) to parameter `index` (1-based).
+/// Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libdb_bind_int(stmt_id: u32, index: u32, lo: u32, hi: u32) -> u32 {
+    bind(stmt_id, index, Value::Integer(((hi as u64) << 32 | lo as u64) as i64))
+}
+
+/// Bind a UTF-8 text value to parameter `index` (1-based).
+/// Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libdb_bind_text(stmt_id: u32, index: u32, text_ptr: *const u8, text_len: u32) -> u32 {
+    let text = unsafe {
+        let slice = core::slice::from_raw_parts(text_ptr, text_len as usize);
+        core::str::from_utf8(slice).unwrap_or("")
+    };
+    bind(stmt_id, index, Value::Text(alloc::string::String::from(text)))
+}
+
+/// Bind NULL to parameter `index` (1-based). Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libdb_bind_null(stmt_id: u32, index: u32) -> u32 {
+    bind(stmt_id, index, Value::Null)
+}
+
+/// Run a prepared non-query statement with its current bindings.
+/// Returns rows affected, or u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libdb_step(stmt_id: u32) -> u32 {
+    let (stmt, db) = match get_statement(stmt_id) {
+        Some(p) => p,
+        None => return u32::MAX,
+    };
+    db.last_error.clear();
+    match stmt.exec(db) {
+        Ok(count) => count,
+        Err(e) => {
+            db.last_error = e.message();
+            u32::MAX
+        }
+    }
+}
+
+/// Run a prepared SELECT with its current bindings. Returns result_id (1+), or 0 on error.
+#[no_mangle]
+pub extern "C" fn libdb_step_query(stmt_id: u32) -> u32 {
+    let (stmt, db) = match get_statement(stmt_id) {
+        Some(p) => p,
+        None => return 0,
+    };
+    db.last_error.clear();
+    match stmt.query(db) {
+        Ok(rs) => alloc_result(rs),
+        Err(e) => {
+            db.last_error = e.message();
+            0
+        }
+    }
+}
+
+/// Clear every binding of a prepared statement.
+#[no_mangle]
+pub extern "C" fn libdb_reset(stmt_id: u32) {
+    if let Some((stmt, _)) = get_statement(stmt_id) {
+        stmt.reset();
+    }
+}
+
+/// Free a prepared statement.
+#[no_mangle]
+pub extern "C" fn libdb_finalize(stmt_id: u32) {
+    let s = state();
+    let idx = stmt_id as usize;
+    if idx > 0 && idx <= s.statements.len() {
+        s.statements[idx - 1] = None;
+    }
+}
+
 /// Get row count of a result set.
 #[no_mangle]
 pub extern "C" fn libdb_result_row_count(result_id: u32) -> u32 {
@@ -1,8 +1,10 @@
 //! SQL tokenizer and recursive-descent parser.
 //!
 //! Parses a subset of SQL into an AST ([`Statement`]) for execution by the
-//! query executor. Supports CREATE TABLE, DROP TABLE, INSERT, SELECT, UPDATE,
-//! and DELETE statements with WHERE clauses.
+//! query executor. Supports CREATE TABLE, DROP TABLE, CREATE INDEX, DROP
+//! INDEX, INSERT, SELECT (with aggregates, a two-table JOIN, GROUP BY,
+//! ORDER BY and LIMIT), UPDATE, and DELETE statements with WHERE clauses,
+//! BEGIN/COMMIT/ROLLBACK, plus PRAGMA for engine settings.
 
 extern crate alloc;
 
@@ -38,6 +40,8 @@ enum Token {
     Ident(String),
     IntLit(i64),
     StrLit(String),
+    /// `?` placeholder
+    Param,
 
     // Operators
     Eq,       // =
@@ -53,10 +57,14 @@ enum Token {
     RParen,
     Comma,
     Semi,
+    Dot,
 
     Eof,
 }
 
+/// Words that end a FROM or JOIN table, so they are not taken as its alias.
+const CLAUSE_WORDS: [&str; 6] = ["JOIN", "INNER", "ON", "GROUP", "ORDER", "LIMIT"];
+
 // ── Tokenizer ────────────────────────────────────────────────────────────────
 
 /// Tokenizes a SQL string into a sequence of tokens.
@@ -110,7 +118,9 @@ impl<'a> Tokenizer<'a> {
             b')' => { self.advance(); Ok(Token::RParen) }
             b',' => { self.advance(); Ok(Token::Comma) }
             b';' => { self.advance(); Ok(Token::Semi) }
+            b'.' => { self.advance(); Ok(Token::Dot) }
             b'*' => { self.advance(); Ok(Token::Star) }
+            b'?' => { self.advance(); Ok(Token::Param) }
             b'=' => { self.advance(); Ok(Token::Eq) }
             b'<' => {
                 self.advance();
@@ -272,11 +282,13 @@ impl<'a> Tokenizer<'a> {
 struct Parser {
     tokens: Vec<Token>,
     pos: usize,
+    /// Placeholders seen so far.
+    params: usize,
 }
 
 impl Parser {
     fn new(tokens: Vec<Token>) -> Self {
-        Parser { tokens, pos: 0 }
+        Parser { tokens, pos: 0, params: 0 }
     }
 
     fn peek(&self) -> &Token {
@@ -306,6 +318,27 @@ impl Parser {
         }
     }
 
+    /// True if the token `ahead` positions on is the word `word`.  Words
+    /// that are keywords in one spot only (INDEX, UNIQUE, ON, PRIMARY, KEY,
+    /// PRAGMA, JOIN, GROUP, AS and the aggregate functions)
+    /// are matched this way, so they remain usable as names elsewhere.
+    fn word_at(&self, ahead: usize, word: &str) -> bool {
+        matches!(self.tokens.get(self.pos + ahead), Some(Token::Ident(s)) if s.eq_ignore_ascii_case(word))
+    }
+
+    fn expect_word(&mut self, word: &str) -> DbResult<()> {
+        if self.word_at(0, word) {
+            self.advance();
+            Ok(())
+        } else {
+            let mut msg = String::from("Expected ");
+            msg.push_str(word);
+            msg.push_str(", got ");
+            msg.push_str(&format_token(self.peek()));
+            Err(DbError::Parse(msg))
+        }
+    }
+
     fn expect_ident(&mut self) -> DbResult<String> {
         match self.advance() {
             Token::Ident(s) => Ok(s),
@@ -320,12 +353,30 @@ impl Parser {
     /// Parse the top-level statement.
     fn parse_statement(&mut self) -> DbResult<Statement> {
         match self.peek().clone() {
+            Token::Create if self.word_at(1, "INDEX") || self.word_at(1, "UNIQUE") => {
+                self.parse_create_index()
+            }
             Token::Create => self.parse_create_table(),
+            Token::Drop if self.word_at(1, "INDEX") => self.parse_drop_index(),
             Token::Drop => self.parse_drop_table(),
             Token::Insert => self.parse_insert(),
             Token::Select => self.parse_select(),
             Token::Update => self.parse_update(),
             Token::Delete => self.parse_delete(),
+            Token::Ident(_) if self.word_at(0, "PRAGMA") => self.parse_pragma(),
+            Token::Ident(_) if self.word_at(0, "BEGIN") => {
+                self.advance();
+                if self.word_at(0, "TRANSACTION") { self.advance(); }
+                self.parse_end(Statement::Begin)
+            }
+            Token::Ident(_) if self.word_at(0, "COMMIT") => {
+                self.advance();
+                self.parse_end(Statement::Commit)
+            }
+            Token::Ident(_) if self.word_at(0, "ROLLBACK") => {
+                self.advance();
+                self.parse_end(Statement::Rollback)
+            }
             ref other => {
                 let mut msg = String::from("Expected SQL statement, got ");
                 msg.push_str(&format_token(other));
@@ -334,7 +385,7 @@ impl Parser {
         }
     }
 
-    // ── CREATE TABLE name (col1 TYPE, col2 TYPE, ...) ───────────────────
+    // ── CREATE TABLE name (col1 TYPE [PRIMARY KEY], col2 TYPE, ...) ─────
 
     fn parse_create_table(&mut self) -> DbResult<Statement> {
         self.advance(); // CREATE
@@ -343,6 +394,7 @@ impl Parser {
         self.expect(&Token::LParen)?;
 
         let mut columns = Vec::new();
+        let mut primary_key = None;
         loop {
             let col_name = self.expect_ident()?;
             let col_type = match self.advance() {
@@ -354,6 +406,14 @@ impl Parser {
                     return Err(DbError::Parse(msg));
                 }
             };
+            if self.word_at(0, "PRIMARY") {
+                self.advance();
+                self.expect_word("KEY")?;
+                if primary_key.is_some() {
+                    return Err(DbError::Parse(String::from("Only one PRIMARY KEY column allowed")));
+                }
+                primary_key = Some(col_name.clone());
+            }
             columns.push(ColumnDef { name: col_name, col_type });
 
             match self.peek() {
@@ -370,7 +430,7 @@ impl Parser {
         // Optional semicolon
         if self.peek() == &Token::Semi { self.advance(); }
 
-        Ok(Statement::CreateTable { name, columns })
+        Ok(Statement::CreateTable { name, columns, primary_key })
     }
 
     // ── DROP TABLE name ─────────────────────────────────────────────────
@@ -383,6 +443,33 @@ impl Parser {
         Ok(Statement::DropTable { name })
     }
 
+    // ── CREATE [UNIQUE] INDEX name ON table (col) ───────────────────────
+
+    fn parse_create_index(&mut self) -> DbResult<Statement> {
+        self.advance(); // CREATE
+        let unique = self.word_at(0, "UNIQUE");
+        if unique { self.advance(); }
+        self.expect_word("INDEX")?;
+        let name = self.expect_ident()?;
+        self.expect_word("ON")?;
+        let table = self.expect_ident()?;
+        self.expect(&Token::LParen)?;
+        let column = self.expect_ident()?;
+        self.expect(&Token::RParen)?;
+        if self.peek() == &Token::Semi { self.advance(); }
+        Ok(Statement::CreateIndex { name, table, column, unique })
+    }
+
+    // ── DROP INDEX name ─────────────────────────────────────────────────
+
+    fn parse_drop_index(&mut self) -> DbResult<Statement> {
+        self.advance(); // DROP
+        self.advance(); // INDEX
+        let name = self.expect_ident()?;
+        if self.peek() == &Token::Semi { self.advance(); }
+        Ok(Statement::DropIndex { name })
+    }
+
     // ── INSERT INTO name (cols) VALUES (vals) ───────────────────────────
 
     fn parse_insert(&mut self) -> DbResult<Statement> {
@@ -413,26 +500,33 @@ impl Parser {
         };
 
         self.expect(&Token::Values)?;
-        self.expect(&Token::LParen)?;
 
-        let mut values = Vec::new();
+        // VALUES (...) [, (...) ...]
+        let mut rows = Vec::new();
         loop {
-            let val = self.parse_value()?;
-            values.push(val);
-            match self.peek() {
-                Token::Comma => { self.advance(); }
-                Token::RParen => break,
-                other => {
-                    let mut msg = String::from("Expected ',' or ')', got ");
-                    msg.push_str(&format_token(other));
-                    return Err(DbError::Parse(msg));
+            self.expect(&Token::LParen)?;
+            let mut values = Vec::new();
+            loop {
+                let val = self.parse_arg()?;
+                values.push(val);
+                match self.peek() {
+                    Token::Comma => { self.advance(); }
+                    Token::RParen => break,
+                    other => {
+                        let mut msg = String::from("Expected ',' or ')', got ");
+                        msg.push_str(&format_token(other));
+                        return Err(DbError::Parse(msg));
+                    }
                 }
             }
+            self.expect(&Token::RParen)?;
+            rows.push(values);
+            if self.peek() != &Token::Comma { break; }
+            self.advance();
         }
-        self.expect(&Token::RParen)?;
         if self.peek() == &Token::Semi { self.advance(); }
 
-        Ok(Statement::Insert { table, columns, values })
+        Ok(Statement::Insert { table, columns, rows })
     }
 
     // ── SELECT cols FROM name [WHERE ...] ───────────────────────────────
@@ -444,20 +538,37 @@ impl Parser {
             self.advance();
             SelectColumns::All
         } else {
-            let mut cols = Vec::new();
+            let mut items = Vec::new();
             loop {
-                cols.push(self.expect_ident()?);
+                let expr = self.parse_select_expr()?;
+                let alias = if self.word_at(0, "AS") {
+                    self.advance();
+                    Some(self.expect_ident()?)
+                } else {
+                    None
+                };
+                items.push(SelectItem { expr, alias });
                 if self.peek() == &Token::Comma {
                     self.advance();
                 } else {
                     break;
                 }
             }
-            SelectColumns::Named(cols)
+            SelectColumns::Named(items)
         };
 
         self.expect(&Token::From)?;
-        let table = self.expect_ident()?;
+        let from = self.parse_table_ref()?;
+
+        let join = if self.word_at(0, "JOIN") || (self.word_at(0, "INNER") && self.word_at(1, "JOIN")) {
+            if self.word_at(0, "INNER") { self.advance(); }
+            self.advance(); // JOIN
+            let table = self.parse_table_ref()?;
+            self.expect_word("ON")?;
+            Some(Join { table, on: self.parse_expr()? })
+        } else {
+            None
+        };
 
         let where_clause = if self.peek() == &Token::Where {
             self.advance();
@@ -465,9 +576,106 @@ impl Parser {
         } else {
             None
         };
+
+        let mut group_by = Vec::new();
+        if self.word_at(0, "GROUP") {
+            self.advance();
+            self.expect_word("BY")?;
+            loop {
+                group_by.push(self.expect_column()?);
+                if self.peek() == &Token::Comma {
+                    self.advance();
+                } else {
+                    break;
+                }
+            }
+        }
+
+        let mut order_by = Vec::new();
+        if self.word_at(0, "ORDER") {
+            self.advance();
+            self.expect_word("BY")?;
+            loop {
+                let column = match self.parse_select_expr()? {
+                    SelectExpr::Column(name) => name,
+                    SelectExpr::Aggregate(func, arg) => func.call(arg.as_deref()),
+                };
+                let descending = self.word_at(0, "DESC");
+                if descending || self.word_at(0, "ASC") {
+                    self.advance();
+                }
+                order_by.push(OrderBy { column, descending });
+                if self.peek() == &Token::Comma {
+                    self.advance();
+                } else {
+                    break;
+                }
+            }
+        }
+
+        let limit = if self.word_at(0, "LIMIT") {
+            self.advance();
+            match self.advance() {
+                Token::IntLit(n) if (0..=u32::MAX as i64).contains(&n) => Some(n as u32),
+                _ => return Err(DbError::Parse(String::from("LIMIT expects a non-negative integer"))),
+            }
+        } else {
+            None
+        };
         if self.peek() == &Token::Semi { self.advance(); }
 
-        Ok(Statement::Select { table, columns, where_clause })
+        Ok(Statement::Select(Select { from, join, columns, where_clause, group_by, order_by, limit }))
+    }
+
+    /// `table [[AS] alias]`.
+    fn parse_table_ref(&mut self) -> DbResult<TableRef> {
+        let name = self.expect_ident()?;
+        if self.word_at(0, "AS") {
+            self.advance();
+            return Ok(TableRef { name, alias: Some(self.expect_ident()?) });
+        }
+        let alias = match self.peek() {
+            Token::Ident(_) if !CLAUSE_WORDS.iter().any(|w| self.word_at(0, w)) => {
+                Some(self.expect_ident()?)
+            }
+            _ => None,
+        };
+        Ok(TableRef { name, alias })
+    }
+
+    /// A column or an aggregate call (`COUNT(*)`, `SUM(col)`, ...).
+    fn parse_select_expr(&mut self) -> DbResult<SelectExpr> {
+        let func = match self.peek() {
+            Token::Ident(name) if self.tokens.get(self.pos + 1) == Some(&Token::LParen) => {
+                AggFunc::from_name(name)
+            }
+            _ => None,
+        };
+        let func = match func {
+            Some(f) => f,
+            None => return Ok(SelectExpr::Column(self.expect_column()?)),
+        };
+        self.advance();
+        self.advance(); // (
+        let arg = if func == AggFunc::Count && self.peek() == &Token::Star {
+            self.advance();
+            None
+        } else {
+            Some(self.expect_column()?)
+        };
+        self.expect(&Token::RParen)?;
+        Ok(SelectExpr::Aggregate(func, arg))
+    }
+
+    /// A column name, optionally qualified: `col` or `table.col`.
+    fn expect_column(&mut self) -> DbResult<String> {
+        let mut name = self.expect_ident()?;
+        if self.peek() == &Token::Dot {
+            self.advance();
+            name.push('.');
+            name.push_str(&self.expect_ident()?);
+        }
+        Ok(name)
     }
 
     // ── UPDATE name SET col=val [, col=val] [WHERE ...] ─────────────────
@@ -481,7 +689,7 @@ impl Parser {
         loop {
             let col = self.expect_ident()?;
             self.expect(&Token::Eq)?;
-            let val = self.parse_value()?;
+            let val = self.parse_arg()?;
             assignments.push((col, val));
             if self.peek() == &Token::Comma {
                 self.advance();
@@ -519,6 +727,27 @@ impl Parser {
         Ok(Statement::Delete { table, where_clause })
     }
 
+    /// Accept an optional `;` after a statement with no further clauses.
+    fn parse_end(&mut self, stmt: Statement) -> DbResult<Statement> {
+        if self.peek() == &Token::Semi { self.advance(); }
+        Ok(stmt)
+    }
+
+    // ── PRAGMA name [= value] ───────────────────────────────────────────
+
+    fn parse_pragma(&mut self) -> DbResult<Statement> {
+        self.advance(); // PRAGMA
+        let name = self.expect_ident()?;
+        let value = if self.peek() == &Token::Eq {
+            self.advance();
+            Some(self.parse_value()?)
+        } else {
+            None
+        };
+        if self.peek() == &Token::Semi { self.advance(); }
+        Ok(Statement::Pragma { name, value })
+    }
+
     // ── Expression parsing (WHERE clause) ───────────────────────────────
 
     /// Parse an expression: handles OR at the lowest precedence.
@@ -571,7 +800,8 @@ impl Parser {
             Token::IntLit(v) => { self.advance(); Ok(Expr::Literal(Value::Integer(v))) }
             Token::StrLit(s) => { self.advance(); Ok(Expr::Literal(Value::Text(s))) }
             Token::Null => { self.advance(); Ok(Expr::Literal(Value::Null)) }
-            Token::Ident(s) => { self.advance(); Ok(Expr::Column(s)) }
+            Token::Param => { self.advance(); Ok(self.next_param()) }
+            Token::Ident(_) => Ok(Expr::Column(self.expect_column()?)),
             Token::LParen => {
                 self.advance();
                 let expr = self.parse_expr()?;
@@ -587,6 +817,20 @@ impl Parser {
     }
 
     /// Parse a literal value (for INSERT VALUES and UPDATE SET).
+    /// Parse a value or a `?` placeholder (INSERT values, SET clauses).
+    fn parse_arg(&mut self) -> DbResult<Expr> {
+        if self.peek() == &Token::Param {
+            self.advance();
+            return Ok(self.next_param());
+        }
+        Ok(Expr::Literal(self.parse_value()?))
+    }
+
+    fn next_param(&mut self) -> Expr {
+        self.params += 1;
+        Expr::Param(self.params - 1)
+    }
+
     fn parse_value(&mut self) -> DbResult<Value> {
         match self.advance() {
             Token::IntLit(v) => Ok(Value::Integer(v)),
@@ -650,6 +894,8 @@ fn format_token(tok: &Token) -> String {
         Token::RParen => String::from("')'"),
         Token::Comma => String::from("','"),
         Token::Semi => String::from("';'"),
+        Token::Dot => String::from("'.'"),
+        Token::Param => String::from("'?'"),
         Token::Eof => String::from("end of input"),
     }
 }
@@ -677,13 +923,15 @@ fn fmt_i64(out: &mut String, v: i64) {
 
 // ── Public API ───────────────────────────────────────────────────────────────
 
-/// Parse a SQL string into a [`Statement`] AST node.
-pub fn parse_sql(sql: &str) -> DbResult<Statement> {
+/// Parse a SQL string into a [`Statement`] AST node.  Also returns the
+/// number of `?` placeholders, numbered from 0 in order of appearance.
+pub fn parse_sql(sql: &str) -> DbResult<(Statement, usize)> {
     let mut tokenizer = Tokenizer::new(sql);
     let tokens = tokenizer.tokenize_all()?;
     if tokens.is_empty() {
         return Err(DbError::Parse(String::from("Empty SQL statement")));
     }
     let mut parser = Parser::new(tokens);
-    parser.parse_statement()
+    let stmt = parser.parse_statement()?;
+    Ok((stmt, parser.params))
 }
@@ -0,0 +1,133 @@
+//! Prepared statements and the per-database parse cache.
+//!
+//! A statement is parsed once (`libdb_prepare`, or the first time its text
+//! is seen by `libdb_exec`/`libdb_query`) and run many times.  `?`
+//! placeholders are numbered from 1 in the order they appear and take
+//! whatever value was bound to them last; the parsed statement is shared,
+//! so executing a prepared insert allocates nothing beyond what the rows
+//! themselves need.
+//!
+//! Only parsing is cached.  Which index a `WHERE` uses is still decided on
+//! every run, so a statement prepared before `CREATE INDEX` picks the new
+//! index up; planning only inspects the parsed statement and costs far
+//! less than parsing it.
+
+extern crate alloc;
+
+use alloc::format;
+use alloc::rc::Rc;
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::types::*;
+use crate::engine::Database;
+use crate::executor;
+use crate::parser;
+
+/// Distinct SQL strings remembered per database.
+const PARSE_CACHE_ENTRIES: usize = 16;
+
+/// A parsed statement and the number of `?` placeholders in it.
+pub struct Compiled {
+    pub stmt: Statement,
+    pub params: usize,
+}
+
+struct CacheEntry {
+    sql: String,
+    compiled: Rc<Compiled>,
+    /// Value of `ParseCache::tick` when the entry was last used.
+    used: u64,
+}
+
+/// Recently parsed SQL text, least recently used evicted first.
+pub struct ParseCache {
+    entries: Vec<CacheEntry>,
+    tick: u64,
+}
+
+impl ParseCache {
+    pub fn new() -> ParseCache {
+        ParseCache { entries: Vec::new(), tick: 0 }
+    }
+
+    /// Parse `sql`, or return the statement parsed from the same text
+    /// earlier.  Statements that fail to parse are not remembered.
+    pub fn get(&mut self, sql: &str) -> DbResult<Rc<Compiled>> {
+        self.tick += 1;
+        if let Some(entry) = self.entries.iter_mut().find(|e| e.sql == sql) {
+            entry.used = self.tick;
+            return Ok(entry.compiled.clone());
+        }
+
+        let (stmt, params) = parser::parse_sql(sql)?;
+        let compiled = Rc::new(Compiled { stmt, params });
+        let entry = CacheEntry { sql: String::from(sql), compiled: compiled.clone(), used: self.tick };
+        if self.entries.len() < PARSE_CACHE_ENTRIES {
+            self.entries.push(entry);
+        } else if let Some(oldest) = self.entries.iter_mut().min_by_key(|e| e.used) {
+            *oldest = entry;
+        }
+        Ok(compiled)
+    }
+}
+
+/// A statement prepared on one database handle, with its bound values.
+pub struct Prepared {
+    /// Handle of the database the statement runs against.
+    pub handle: u32,
+    compiled: Rc<Compiled>,
+    params: Vec<Value>,
+    bound: Vec<bool>,
+}
+
+impl Prepared {
+    pub fn new(handle: u32, compiled: Rc<Compiled>) -> Prepared {
+        let n = compiled.params;
+        Prepared {
+            handle,
+            compiled,
+            params: alloc::vec![Value::Null; n],
+            bound: alloc::vec![false; n],
+        }
+    }
+
+    /// Bind `value` to placeholder `index` (1-based).
+    pub fn bind(&mut self, index: u32, value: Value) -> DbResult<()> {
+        let i = index as usize;
+        if i == 0 || i > self.params.len() {
+            return Err(DbError::Parse(format!(
+                "Parameter index {} out of range (statement has {})", index, self.params.len()
+            )));
+        }
+        self.params[i - 1] = value;
+        self.bound[i - 1] = true;
+        Ok(())
+    }
+
+    /// Clear every binding.
+    pub fn reset(&mut self) {
+        for (value, bound) in self.params.iter_mut().zip(self.bound.iter_mut()) {
+            *value = Value::Null;
+            *bound = false;
+        }
+    }
+
+    /// Run a non-query statement. Returns rows affected.
+    pub fn exec(&self, db: &mut Database) -> DbResult<u32> {
+        self.check_bound()?;
+        executor::exec(db, &self.compiled.stmt, &self.params)
+    }
+
+    /// Run a SELECT.
+    pub fn query(&self, db: &mut Database) -> DbResult<ResultSet> {
+        self.check_bound()?;
+        executor::query(db, &self.compiled.stmt, &self.params)
+    }
+
+    fn check_bound(&self) -> DbResult<()> {
+        match self.bound.iter().position(|&b| !b) {
+            Some(i) => Err(unbound_param(i)),
+            None => Ok(()),
+        }
+    }
+}
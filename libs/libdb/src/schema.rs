@@ -2,7 +2,8 @@
 //!
 //! Reads and writes the table directory stored in page 0 of the database file.
 //! Each table entry is 128 bytes containing the table name, column definitions,
-//! row count, and first data page pointer.
+//! row count, and first data page pointer.  Index definitions live in a
+//! separate directory page referenced from the header.
 
 extern crate alloc;
 
@@ -16,7 +17,8 @@ use crate::types::*;
 // Bytes  8..12   page_size (u32 LE, always 4096)
 // Bytes 12..16   table_count (u32 LE)
 // Bytes 16..20   first_free_page (u32 LE, 0 = none)
-// Bytes 20..32   reserved (zeroed)
+// Bytes 20..24   index_dir_page (u32 LE, 0 = no indexes yet)
+// Bytes 24..32   reserved (zeroed)
 // Bytes 32..4096 table directory entries (128 bytes each, max 31)
 //
 // ── Table entry layout (128 bytes) ──────────────────────────────────────────
@@ -29,6 +31,21 @@ use crate::types::*;
 // Bytes 44..48   reserved
 // Bytes 48..128  columns: up to 8 entries of 10 bytes each = 80 bytes
 //                column entry: name[8] (null-terminated) + col_type (u16 LE)
+//
+// ── Index directory page ────────────────────────────────────────────────────
+//
+// Bytes  0..4    index_count (u32 LE)
+// Bytes  4..8    reserved
+// Bytes  8..4088 index entries (80 bytes each, max 51)
+//
+// ── Index entry layout (80 bytes) ───────────────────────────────────────────
+//
+// Bytes  0..32   index name (null-terminated ASCII)
+// Bytes 32..64   table name (null-terminated ASCII)
+// Bytes 64..66   column position (u16 LE)
+// Bytes 66..68   flags (u16 LE): bit 0 = unique, bit 1 = primary key
+// Bytes 68..72   root page of the B+tree (u32 LE)
+// Bytes 72..80   reserved
 
 /// Read the database file header and validate magic.
 pub fn read_header(page: &[u8; PAGE_SIZE]) -> DbResult<(u32, u32)> {
@@ -55,6 +72,16 @@ pub fn write_header_fields(page: &mut [u8; PAGE_SIZE], table_count: u32, first_f
     page[16..20].copy_from_slice(&first_free.to_le_bytes());
 }
 
+/// Read the index directory page number from page 0.
+pub fn read_index_dir_page(page: &[u8; PAGE_SIZE]) -> u32 {
+    u32::from_le_bytes([page[20], page[21], page[22], page[23]])
+}
+
+/// Write the index directory page number into page 0.
+pub fn write_index_dir_page(page: &mut [u8; PAGE_SIZE], dir_page: u32) {
+    page[20..24].copy_from_slice(&dir_page.to_le_bytes());
+}
+
 /// Read all table schemas from page 0.
 pub fn read_tables(page: &[u8; PAGE_SIZE], table_count: u32) -> DbResult<Vec<TableSchema>> {
     let count = table_count as usize;
@@ -140,6 +167,70 @@ pub fn write_table_entry(page: &mut [u8; PAGE_SIZE], index: usize, schema: &Tabl
     }
 }
 
+/// Read all index schemas from an index directory page.
+pub fn read_indexes(page: &[u8; PAGE_SIZE], tables: &[TableSchema]) -> DbResult<Vec<IndexSchema>> {
+    let count = u32::from_le_bytes([page[0], page[1], page[2], page[3]]) as usize;
+    if count > MAX_INDEXES {
+        return Err(DbError::Corrupt(String::from("Index count exceeds maximum")));
+    }
+    let mut indexes = Vec::with_capacity(count);
+    for i in 0..count {
+        let off = INDEX_DIR_HEADER + i * INDEX_ENTRY_SIZE;
+        let entry = &page[off..off + INDEX_ENTRY_SIZE];
+        let name = read_name(&entry[0..32])?;
+        let table = read_name(&entry[32..64])?;
+        let column = u16::from_le_bytes([entry[64], entry[65]]) as usize;
+        let flags = u16::from_le_bytes([entry[66], entry[67]]);
+        let root = u32::from_le_bytes([entry[68], entry[69], entry[70], entry[71]]);
+
+        let valid = find_table(tables, &table)
+            .map_or(false, |t| column < tables[t].columns.len());
+        if !valid || root == 0 {
+            return Err(DbError::Corrupt(String::from("Index refers to a missing column")));
+        }
+        indexes.push(IndexSchema {
+            name,
+            table,
+            column,
+            unique: flags & 1 != 0,
+            primary: flags & 2 != 0,
+            root,
+        });
+    }
+    Ok(indexes)
+}
+
+/// Build an index directory page from the index list.
+pub fn write_indexes(page: &mut [u8; PAGE_SIZE], indexes: &[IndexSchema]) {
+    page.fill(0);
+    page[0..4].copy_from_slice(&(indexes.len() as u32).to_le_bytes());
+    for (i, index) in indexes.iter().enumerate().take(MAX_INDEXES) {
+        let off = INDEX_DIR_HEADER + i * INDEX_ENTRY_SIZE;
+        let entry = &mut page[off..off + INDEX_ENTRY_SIZE];
+        write_name(&mut entry[0..32], &index.name);
+        write_name(&mut entry[32..64], &index.table);
+        entry[64..66].copy_from_slice(&(index.column as u16).to_le_bytes());
+        let flags = index.unique as u16 | (index.primary as u16) << 1;
+        entry[66..68].copy_from_slice(&flags.to_le_bytes());
+        entry[68..72].copy_from_slice(&index.root.to_le_bytes());
+    }
+}
+
+/// Read a null-terminated name from a 32-byte field.
+fn read_name(field: &[u8]) -> DbResult<String> {
+    let end = field.iter().position(|&b| b == 0).unwrap_or(field.len());
+    core::str::from_utf8(&field[..end])
+        .map(String::from)
+        .map_err(|_| DbError::Corrupt(String::from("Invalid index name encoding")))
+}
+
+/// Write a name into a zeroed 32-byte field, keeping the terminator.
+fn write_name(field: &mut [u8], name: &str) {
+    let bytes = name.as_bytes();
+    let len = bytes.len().min(field.len() - 1);
+    field[..len].copy_from_slice(&bytes[..len]);
+}
+
 /// Clear a table entry (fill with zeros).
 pub fn clear_table_entry(page: &mut [u8; PAGE_SIZE], index: usize) {
     let off = HEADER_SIZE + index * TABLE_ENTRY_SIZE;
@@ -150,3 +241,8 @@ pub fn clear_table_entry(page: &mut [u8; PAGE_SIZE], index: usize) {
 pub fn find_table(tables: &[TableSchema], name: &str) -> Option<usize> {
     tables.iter().position(|t| t.name.eq_ignore_ascii_case(name))
 }
+
+/// Find an index by name (case-insensitive). Returns index.
+pub fn find_index(indexes: &[IndexSchema], name: &str) -> Option<usize> {
+    indexes.iter().position(|i| i.name.eq_ignore_ascii_case(name))
+}
@@ -1,6 +1,10 @@
 //! Syscall wrappers for libdb — delegates to libsyscall.
 
 pub use libsyscall::{
-    exit, sbrk, mmap, munmap, open, close, read, write, lseek, file_size, log,
-    O_WRITE, O_CREATE, O_TRUNC, SEEK_SET,
+    exit, sbrk, mmap, mmap_file, munmap, open, close, read, write, lseek, file_size, fsync,
+    flock, uptime_ms, log, O_WRITE, O_CREATE, SEEK_SET, LOCK_SH, LOCK_EX, LOCK_NB,
+    LOCK_UN,
 };
+
+/// `mmap_file` flag: writes (none, for libdb) stay private to the process.
+pub const MAP_PRIVATE: u32 = 2;
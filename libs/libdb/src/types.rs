@@ -41,6 +41,18 @@ pub const DATA_PAGE_HEADER: usize = 8;
 /// Usable data area per page.
 pub const DATA_AREA_SIZE: usize = PAGE_SIZE - DATA_PAGE_HEADER;
 
+/// Index directory page header size in bytes.
+pub const INDEX_DIR_HEADER: usize = 8;
+
+/// Size of an index directory entry in bytes.
+pub const INDEX_ENTRY_SIZE: usize = 80;
+
+/// Maximum number of indexes per database (limited by the directory page).
+pub const MAX_INDEXES: usize = (PAGE_SIZE - INDEX_DIR_HEADER) / INDEX_ENTRY_SIZE; // 51
+
+/// Maximum index name length (null-terminated in 32 bytes).
+pub const MAX_INDEX_NAME: usize = 31;
+
 // ── Row tags ─────────────────────────────────────────────────────────────────
 
 /// Row is active (first byte of row).
@@ -137,6 +149,25 @@ impl TableSchema {
     }
 }
 
+// ── Index schema ─────────────────────────────────────────────────────────────
+
+/// In-memory representation of a single-column B+tree index.
+#[derive(Debug, Clone)]
+pub struct IndexSchema {
+    pub name: String,
+    /// Name of the indexed table.
+    pub table: String,
+    /// Position of the indexed column in the table schema.
+    pub column: usize,
+    /// No two rows may share a non-NULL key.
+    pub unique: bool,
+    /// Created by a `PRIMARY KEY` column; named after its table and dropped
+    /// with it.  Also rejects NULL keys.
+    pub primary: bool,
+    /// Root page of the B+tree.
+    pub root: u32,
+}
+
 // ── Result set ───────────────────────────────────────────────────────────────
 
 /// Query result set returned by SELECT statements.
@@ -174,6 +205,18 @@ pub enum DbError {
     Corrupt(String),
     /// Row too large to fit in a single page.
     RowTooLarge,
+    /// Index not found.
+    IndexNotFound(String),
+    /// Index already exists.
+    IndexExists(String),
+    /// Too many indexes (max 51).
+    TooManyIndexes,
+    /// A UNIQUE or PRIMARY KEY index rejected a row.
+    Constraint(String),
+    /// Change attempted through a read-only handle.
+    ReadOnly,
+    /// A checkpoint was refused because a reader is using the database.
+    Busy,
 }
 
 impl DbError {
@@ -219,6 +262,24 @@ impl DbError {
                 m
             }
             DbError::RowTooLarge => String::from("Row too large for page"),
+            DbError::IndexNotFound(s) => {
+                let mut m = String::from("Index not found: ");
+                m.push_str(s);
+                m
+            }
+            DbError::IndexExists(s) => {
+                let mut m = String::from("Index already exists: ");
+                m.push_str(s);
+                m
+            }
+            DbError::TooManyIndexes => String::from("Too many indexes (max 51)"),
+            DbError::Constraint(s) => {
+                let mut m = String::from("Constraint violation: ");
+                m.push_str(s);
+                m
+            }
+            DbError::ReadOnly => String::from("Database is opened read-only"),
+            DbError::Busy => String::from("Database is busy: a reader is using it"),
         }
     }
 }
@@ -234,23 +295,41 @@ pub enum Statement {
     CreateTable {
         name: String,
         columns: Vec<ColumnDef>,
+        /// Column declared `PRIMARY KEY`, if any.
+        primary_key: Option<String>,
     },
     DropTable {
         name: String,
     },
-    Insert {
+    CreateIndex {
+        name: String,
         table: String,
-        columns: Vec<String>,
-        values: Vec<Value>,
+        column: String,
+        unique: bool,
+    },
+    DropIndex {
+        name: String,
     },
-    Select {
+    /// `PRAGMA name` (query) or `PRAGMA name = value` (exec).
+    Pragma {
+        name: String,
+        value: Option<Value>,
+    },
+    /// `BEGIN [TRANSACTION]`.
+    Begin,
+    Commit,
+    Rollback,
+    Insert {
         table: String,
-        columns: SelectColumns,
-        where_clause: Option<Expr>,
+        columns: Vec<String>,
+        /// One list per row; each value a [`Expr::Literal`] or [`Expr::Param`].
+        rows: Vec<Vec<Expr>>,
     },
+    Select(Select),
     Update {
         table: String,
-        assignments: Vec<(String, Value)>,
+        /// Values as in [`Statement::Insert`] rows.
+        assignments: Vec<(String, Expr)>,
         where_clause: Option<Expr>,
     },
     Delete {
@@ -259,22 +338,121 @@ pub enum Statement {
     },
 }
 
+/// A parsed SELECT.
+#[derive(Debug)]
+pub struct Select {
+    pub from: TableRef,
+    /// `[INNER] JOIN table ON condition`.
+    pub join: Option<Join>,
+    pub columns: SelectColumns,
+    pub where_clause: Option<Expr>,
+    /// `GROUP BY` columns.
+    pub group_by: Vec<String>,
+    pub order_by: Vec<OrderBy>,
+    pub limit: Option<u32>,
+}
+
+/// A table in a FROM or JOIN clause.
+#[derive(Debug)]
+pub struct TableRef {
+    pub name: String,
+    /// `table [AS] alias`: the name its columns are qualified with.
+    pub alias: Option<String>,
+}
+
+/// The second table of a two-table inner join.
+#[derive(Debug)]
+pub struct Join {
+    pub table: TableRef,
+    /// The `ON` condition; one of its AND terms must equate a column of
+    /// each table.
+    pub on: Expr,
+}
+
 /// SELECT column specification.
 #[derive(Debug)]
 pub enum SelectColumns {
     /// SELECT *
     All,
-    /// SELECT col1, col2, ...
-    Named(Vec<String>),
+    /// SELECT item1, item2, ...
+    Named(Vec<SelectItem>),
+}
+
+/// One output column of a SELECT.
+#[derive(Debug)]
+pub struct SelectItem {
+    pub expr: SelectExpr,
+    /// `AS name`.
+    pub alias: Option<String>,
+}
+
+/// What a SELECT item computes.
+#[derive(Debug)]
+pub enum SelectExpr {
+    /// A column, by name as in [`Expr::Column`].
+    Column(String),
+    /// An aggregate call; `None` is `COUNT(*)`.
+    Aggregate(AggFunc, Option<String>),
+}
+
+/// Aggregate functions.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AggFunc {
+    Count,
+    Sum,
+    Min,
+    Max,
+    Avg,
+}
+
+impl AggFunc {
+    /// Look up a function name (case-insensitive).
+    pub fn from_name(name: &str) -> Option<AggFunc> {
+        [AggFunc::Count, AggFunc::Sum, AggFunc::Min, AggFunc::Max, AggFunc::Avg]
+            .into_iter()
+            .find(|f| f.name().eq_ignore_ascii_case(name))
+    }
+
+    pub fn name(self) -> &'static str {
+        match self {
+            AggFunc::Count => "COUNT",
+            AggFunc::Sum => "SUM",
+            AggFunc::Min => "MIN",
+            AggFunc::Max => "MAX",
+            AggFunc::Avg => "AVG",
+        }
+    }
+
+    /// The call as a result column is named, e.g. `COUNT(*)` or `SUM(v)`.
+    pub fn call(self, arg: Option<&str>) -> String {
+        let mut s = String::from(self.name());
+        s.push('(');
+        s.push_str(arg.unwrap_or("*"));
+        s.push(')');
+        s
+    }
+}
+
+/// One `ORDER BY` term.
+#[derive(Debug)]
+pub struct OrderBy {
+    /// A column, a result column's alias, or an aggregate call as named
+    /// by [`AggFunc::call`].
+    pub column: String,
+    pub descending: bool,
 }
 
 /// WHERE clause expression.
 #[derive(Debug)]
 pub enum Expr {
-    /// Column reference.
+    /// Column reference: `name`, or `table.name` with the table's name
+    /// or alias.
     Column(String),
     /// Literal value.
     Literal(Value),
+    /// `?` placeholder: the parameter with this index (0-based), bound
+    /// when a prepared statement is stepped.
+    Param(usize),
     /// Binary comparison: col op val.
     BinOp {
         op: CmpOp,
@@ -287,6 +465,39 @@ pub enum Expr {
     Or(Box<Expr>, Box<Expr>),
 }
 
+impl Expr {
+    /// The value of a literal, or of a placeholder from `params`; `None`
+    /// for any other expression.  Fails for a placeholder left unbound.
+    pub fn value<'a>(&'a self, params: &'a [Value]) -> DbResult<Option<&'a Value>> {
+        match self {
+            Expr::Literal(v) => Ok(Some(v)),
+            Expr::Param(i) => match params.get(*i) {
+                Some(v) => Ok(Some(v)),
+                None => Err(unbound_param(*i)),
+            },
+            _ => Ok(None),
+        }
+    }
+}
+
+/// Error for a `?` placeholder with no bound value (`index` is 0-based).
+pub fn unbound_param(index: usize) -> DbError {
+    let mut msg = String::from("Parameter ");
+    let mut digits = [0u8; 20];
+    let mut n = 0;
+    let mut v = index + 1;
+    while v > 0 {
+        digits[n] = b'0' + (v % 10) as u8;
+        v /= 10;
+        n += 1;
+    }
+    for i in (0..n).rev() {
+        msg.push(digits[i] as char);
+    }
+    msg.push_str(" is not bound");
+    DbError::Parse(msg)
+}
+
 /// Comparison operators for WHERE clauses.
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub enum CmpOp {
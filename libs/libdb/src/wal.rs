@@ -0,0 +1,382 @@
+//! Write-ahead log.
+//!
+//! Committed pages are appended to `<database>-wal` instead of being
+//! written over the main file.  A commit is one write of all the pages a
+//! transaction changed, the last one marked as the commit frame; a crash
+//! part-way through leaves frames without a valid commit frame behind them,
+//! which recovery ignores.  Reads look in the log first ([`Wal::read`]),
+//! so the main file only changes at a checkpoint, which copies the latest
+//! committed version of every logged page into it and starts a new log.
+//!
+//! Group commit: the log is synced to the device once per
+//! [`group_commit`](Wal::group_commit) commits (or once a commit comes
+//! [`GROUP_COMMIT_MS`] after the last sync), so a burst of small
+//! transactions shares one flush.  A crash can lose the commits of an
+//! unsynced group, but never splits a transaction.
+//!
+//! Other handles on the same database pick up new commits with
+//! [`refresh`](Wal::refresh); the frame salt changes with every checkpoint
+//! so they can tell a restarted log from a grown one.  A read-only handle
+//! ([`Wal::open_readonly`]) only ever reads the log, and waits for a writer
+//! to create it if there is none yet.
+//!
+//! Writers serialize on an exclusive `flock` of the log file
+//! ([`lock`](Wal::lock)), held from before a statement first looks at the
+//! log until its changes are committed.  A restart rewrites the header in
+//! place rather than recreating the file, so the lock survives it; frames
+//! of the old log left behind the new ones carry an older salt and end
+//! every scan.
+
+extern crate alloc;
+
+use alloc::collections::BTreeMap;
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::types::*;
+use crate::bufpool::{read_at, write_at};
+use crate::syscall;
+
+// ── Log layout ───────────────────────────────────────────────────────────────
+//
+// Header (32 bytes):
+// Bytes  0..8    magic "ANYWAL01"
+// Bytes  8..12   page_size (u32 LE, always 4096)
+// Bytes 12..16   salt (u32 LE, changes at every checkpoint)
+// Bytes 16..32   reserved
+//
+// Frames follow, each a 16-byte header and one page:
+// Bytes  0..4    page number (u32 LE)
+// Bytes  4..8    commit: database size in pages after the commit; 0 otherwise
+// Bytes  8..12   salt (u32 LE, must match the header)
+// Bytes 12..16   checksum (u32 LE, FNV-1a over bytes 0..12 and the page)
+// Bytes 16..4112 page data
+
+const WAL_MAGIC: &[u8; 8] = b"ANYWAL01";
+const WAL_HEADER_SIZE: u32 = 32;
+const FRAME_HEADER_SIZE: usize = 16;
+const FRAME_SIZE: u32 = (FRAME_HEADER_SIZE + PAGE_SIZE) as u32;
+
+/// Commits that share one sync of the log unless changed with
+/// `PRAGMA group_commit`.
+pub const DEFAULT_GROUP_COMMIT: u32 = 8;
+
+/// Largest `PRAGMA group_commit` accepted.
+pub const MAX_GROUP_COMMIT: u32 = 1000;
+
+/// A commit this long after the last sync syncs the log even if its group
+/// is not full.
+pub const GROUP_COMMIT_MS: u32 = 200;
+
+/// Log size (in frames, about 4 MiB) at which a commit checkpoints.
+pub const CHECKPOINT_FRAMES: u32 = 1024;
+
+/// Counters reported by `PRAGMA wal_stats`.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct WalStats {
+    /// Transactions committed to the log.
+    pub commits: u64,
+    /// Syncs of the log file.
+    pub syncs: u64,
+    /// Checkpoints into the main file.
+    pub checkpoints: u64,
+}
+
+/// An open write-ahead log.
+pub struct Wal {
+    fd: u32,
+    path: String,
+    salt: u32,
+    /// Committed pages: page number → file offset of the newest frame's data.
+    index: BTreeMap<u32, u32>,
+    /// End of the last committed frame; the next commit is written here.
+    end: u32,
+    /// Database size in pages as of the last commit (0 = nothing logged).
+    pub db_pages: u32,
+    /// Commits written since the last sync.
+    unsynced: u32,
+    last_sync_ms: u32,
+    pub group_commit: u32,
+    pub stats: WalStats,
+}
+
+impl Wal {
+    /// Open the log at `path`, recovering its committed frames, or start a
+    /// new one if there is none.
+    /// Returns holding the writer lock.
+    pub fn open(path: &str) -> DbResult<Wal> {
+        let mut wal = Wal::closed(path);
+
+        wal.fd = syscall::open(path, syscall::O_WRITE | syscall::O_CREATE);
+        if wal.fd == u32::MAX {
+            return Err(DbError::Io(String::from("Cannot create write-ahead log")));
+        }
+        let recovered = wal.lock().and_then(|()| wal.recover());
+        if let Err(e) = recovered {
+            syscall::close(wal.fd);
+            return Err(e);
+        }
+        Ok(wal)
+    }
+
+    fn recover(&mut self) -> DbResult<()> {
+        if let Some(salt) = self.read_salt()? {
+            self.salt = salt;
+            return self.scan(WAL_HEADER_SIZE);
+        }
+        self.salt = syscall::uptime_ms() | 1;
+        self.restart()
+    }
+
+    /// Open the log at `path` without creating or changing it.
+    pub fn open_readonly(path: &str) -> DbResult<Wal> {
+        let mut wal = Wal::closed(path);
+        wal.refresh()?;
+        Ok(wal)
+    }
+
+    fn closed(path: &str) -> Wal {
+        Wal {
+            fd: u32::MAX,
+            path: String::from(path),
+            salt: 0,
+            index: BTreeMap::new(),
+            end: WAL_HEADER_SIZE,
+            db_pages: 0,
+            unsynced: 0,
+            last_sync_ms: syscall::uptime_ms(),
+            group_commit: DEFAULT_GROUP_COMMIT,
+            stats: WalStats::default(),
+        }
+    }
+
+    /// Sync and close the log.
+    pub fn close(&mut self) {
+        if self.fd != u32::MAX {
+            let _ = self.sync();
+            syscall::close(self.fd);
+            self.fd = u32::MAX;
+        }
+    }
+
+    /// Take the writer lock, waiting for the handle that holds it.
+    pub fn lock(&self) -> DbResult<()> {
+        if syscall::flock(self.fd, syscall::LOCK_EX) != 0 {
+            return Err(DbError::Io(String::from("Cannot lock write-ahead log")));
+        }
+        Ok(())
+    }
+
+    /// Release the writer lock.
+    pub fn unlock(&self) {
+        syscall::flock(self.fd, syscall::LOCK_UN);
+    }
+
+    /// Pages currently held in the log.
+    pub fn pages(&self) -> usize {
+        self.index.len()
+    }
+
+    /// Frames written since the last checkpoint.
+    pub fn frames(&self) -> u32 {
+        (self.end - WAL_HEADER_SIZE) / FRAME_SIZE
+    }
+
+    /// The log's salt; it changes whenever a checkpoint rewrites the main
+    /// file.
+    pub fn salt(&self) -> u32 {
+        self.salt
+    }
+
+    /// Whether the log holds a committed copy of `page_num`.
+    pub fn contains(&self, page_num: u32) -> bool {
+        self.index.contains_key(&page_num)
+    }
+
+    /// Read the committed version of a page from the log.  Returns false if
+    /// the page is not logged (it is current in the main file).
+    pub fn read(&self, page_num: u32, buf: &mut [u8; PAGE_SIZE]) -> DbResult<bool> {
+        match self.index.get(&page_num) {
+            Some(&offset) => {
+                if read_at(self.fd, offset, buf)? != PAGE_SIZE {
+                    return Err(DbError::Corrupt(String::from("Truncated write-ahead log")));
+                }
+                Ok(true)
+            }
+            None => Ok(false),
+        }
+    }
+
+    /// Commit a transaction: append its pages (in page order) as frames,
+    /// the last marked with the new database size.
+    pub fn commit(&mut self, pages: &[(u32, &[u8; PAGE_SIZE])], db_pages: u32) -> DbResult<()> {
+        if pages.is_empty() {
+            return Ok(());
+        }
+        let mut buf = Vec::with_capacity(pages.len() * FRAME_SIZE as usize);
+        for (i, &(page_num, data)) in pages.iter().enumerate() {
+            let commit = if i == pages.len() - 1 { db_pages } else { 0 };
+            let mut header = [0u8; FRAME_HEADER_SIZE];
+            header[0..4].copy_from_slice(&page_num.to_le_bytes());
+            header[4..8].copy_from_slice(&commit.to_le_bytes());
+            header[8..12].copy_from_slice(&self.salt.to_le_bytes());
+            let sum = checksum(&header[0..12], data);
+            header[12..16].copy_from_slice(&sum.to_le_bytes());
+            buf.extend_from_slice(&header);
+            buf.extend_from_slice(data);
+        }
+        write_at(self.fd, self.end, &buf)?;
+
+        for (i, &(page_num, _)) in pages.iter().enumerate() {
+            let offset = self.end + i as u32 * FRAME_SIZE + FRAME_HEADER_SIZE as u32;
+            self.index.insert(page_num, offset);
+        }
+        self.end += buf.len() as u32;
+        self.db_pages = db_pages;
+        self.stats.commits += 1;
+
+        self.unsynced += 1;
+        let now = syscall::uptime_ms();
+        if self.unsynced >= self.group_commit || now.wrapping_sub(self.last_sync_ms) >= GROUP_COMMIT_MS {
+            self.sync()?;
+        }
+        Ok(())
+    }
+
+    /// Make every commit so far durable.
+    pub fn sync(&mut self) -> DbResult<()> {
+        if self.unsynced == 0 {
+            return Ok(());
+        }
+        if syscall::fsync(self.fd) != 0 {
+            return Err(DbError::Io(String::from("Sync of write-ahead log failed")));
+        }
+        self.unsynced = 0;
+        self.last_sync_ms = syscall::uptime_ms();
+        self.stats.syncs += 1;
+        Ok(())
+    }
+
+    /// Copy every logged page into the main file `db_fd`, then start a new
+    /// log.  The log is synced first, so a crash at any point leaves either
+    /// the old log (replayed again) or a checkpointed main file.
+    pub fn checkpoint(&mut self, db_fd: u32) -> DbResult<()> {
+        if self.index.is_empty() {
+            return Ok(());
+        }
+        self.sync()?;
+        let mut page = [0u8; PAGE_SIZE];
+        for (&page_num, _) in self.index.iter() {
+            self.read(page_num, &mut page)?;
+            write_at(db_fd, page_num * PAGE_SIZE as u32, &page)?;
+        }
+        if syscall::fsync(db_fd) != 0 {
+            return Err(DbError::Io(String::from("Sync of database file failed")));
+        }
+        self.salt = self.salt.wrapping_add(1);
+        self.restart()?;
+        self.stats.checkpoints += 1;
+        Ok(())
+    }
+
+    /// Pick up commits made through other handles since the last look.
+    /// Returns true if there were any; the caller must then drop its
+    /// cached pages.
+    pub fn refresh(&mut self) -> DbResult<bool> {
+        if self.fd == u32::MAX {
+            // Read-only handle: no log yet, or look again for one
+            self.fd = syscall::open(&self.path, 0);
+            if self.fd == u32::MAX {
+                return Ok(false);
+            }
+        }
+        match self.read_salt()? {
+            Some(salt) if salt == self.salt => {
+                let before = self.end;
+                if syscall::file_size(self.fd) >= self.end + FRAME_SIZE {
+                    self.scan(self.end)?;
+                }
+                Ok(self.end != before)
+            }
+            Some(salt) => {
+                // Checkpointed and restarted elsewhere
+                self.salt = salt;
+                self.index.clear();
+                self.scan(WAL_HEADER_SIZE)?;
+                Ok(true)
+            }
+            None => Ok(false),
+        }
+    }
+
+    /// Start an empty log: write a fresh header with the current salt over
+    /// the old one.  The file keeps its size; the next commits overwrite the
+    /// stale frames.
+    fn restart(&mut self) -> DbResult<()> {
+        let mut header = [0u8; WAL_HEADER_SIZE as usize];
+        header[0..8].copy_from_slice(WAL_MAGIC);
+        header[8..12].copy_from_slice(&(PAGE_SIZE as u32).to_le_bytes());
+        header[12..16].copy_from_slice(&self.salt.to_le_bytes());
+        write_at(self.fd, 0, &header)?;
+        if syscall::fsync(self.fd) != 0 {
+            return Err(DbError::Io(String::from("Sync of write-ahead log failed")));
+        }
+        self.index.clear();
+        self.end = WAL_HEADER_SIZE;
+        self.unsynced = 0;
+        Ok(())
+    }
+
+    /// The header's salt, or `None` if the header is missing or invalid.
+    fn read_salt(&self) -> DbResult<Option<u32>> {
+        let mut header = [0u8; WAL_HEADER_SIZE as usize];
+        if read_at(self.fd, 0, &mut header)? < header.len()
+            || &header[0..8] != WAL_MAGIC
+            || u32::from_le_bytes([header[8], header[9], header[10], header[11]]) != PAGE_SIZE as u32
+        {
+            return Ok(None);
+        }
+        Ok(Some(u32::from_le_bytes([header[12], header[13], header[14], header[15]])))
+    }
+
+    /// Read frames from `start` and apply each complete transaction.  Stops
+    /// at the first frame that is torn, from an older log, or fails its
+    /// checksum; frames after the last commit frame are left out.
+    fn scan(&mut self, start: u32) -> DbResult<()> {
+        let size = syscall::file_size(self.fd);
+        let mut pending: Vec<(u32, u32)> = Vec::new();
+        let mut frame = [0u8; FRAME_HEADER_SIZE + PAGE_SIZE];
+        let mut pos = start;
+        while pos + FRAME_SIZE <= size {
+            if read_at(self.fd, pos, &mut frame)? != frame.len() {
+                break;
+            }
+            let page_num = u32::from_le_bytes([frame[0], frame[1], frame[2], frame[3]]);
+            let commit = u32::from_le_bytes([frame[4], frame[5], frame[6], frame[7]]);
+            let salt = u32::from_le_bytes([frame[8], frame[9], frame[10], frame[11]]);
+            let sum = u32::from_le_bytes([frame[12], frame[13], frame[14], frame[15]]);
+            if salt != self.salt || sum != checksum(&frame[0..12], &frame[FRAME_HEADER_SIZE..]) {
+                break;
+            }
+            pending.push((page_num, pos + FRAME_HEADER_SIZE as u32));
+            pos += FRAME_SIZE;
+            if commit != 0 {
+                for (p, offset) in pending.drain(..) {
+                    self.index.insert(p, offset);
+                }
+                self.end = pos;
+                self.db_pages = commit;
+            }
+        }
+        Ok(())
+    }
+}
+
+/// FNV-1a over a frame header and its page.
+fn checksum(header: &[u8], page: &[u8]) -> u32 {
+    let mut h: u32 = 0x811C_9DC5;
+    for &b in header.iter().chain(page.iter()) {
+        h ^= b as u32;
+        h = h.wrapping_mul(0x0100_0193);
+    }
+    h
+}
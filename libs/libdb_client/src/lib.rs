@@ -1,7 +1,7 @@
 //! libdb_client — Safe Rust wrapper for the libdb shared library.
 //!
 //! Loads `libdb.so` via `dl_open`/`dl_sym` and provides ergonomic Rust types
-//! (`Database`, `QueryResult`) for database operations.
+//! (`Database`, `Statement`, `QueryResult`) for database operations.
 //!
 //! # Usage
 //! ```rust
@@ -11,6 +11,11 @@
 //! db.exec("INSERT INTO prefs (key, value) VALUES ('theme', 'dark')").unwrap();
 //! let result = db.query("SELECT * FROM prefs").unwrap();
 //! // ... iterate result ...
+//!
+//! let mut insert = db.prepare("INSERT INTO prefs VALUES (?, ?)").unwrap();
+//! insert.bind_text(1, "font");
+//! insert.bind_text(2, "mono");
+//! insert.step().unwrap();
 //! ```
 
 #![no_std]
@@ -27,6 +32,7 @@ struct LibDb {
     _handle: DlHandle,
     // Lifecycle
     open: extern "C" fn(*const u8, u32) -> u32,
+    open_readonly: extern "C" fn(*const u8, u32) -> u32,
     close: extern "C" fn(u32),
     error: extern "C" fn(u32, *mut u8, u32) -> u32,
     // Execute
@@ -41,6 +47,15 @@ struct LibDb {
     result_get_text: extern "C" fn(u32, u32, u32, *mut u8, u32) -> u32,
     result_is_null: extern "C" fn(u32, u32, u32) -> u32,
     result_free: extern "C" fn(u32),
+    // Prepared statements
+    prepare: extern "C" fn(u32, *const u8, u32) -> u32,
+    bind_int: extern "C" fn(u32, u32, u32, u32) -> u32,
+    bind_text: extern "C" fn(u32, u32, *const u8, u32) -> u32,
+    bind_null: extern "C" fn(u32, u32) -> u32,
+    step: extern "C" fn(u32) -> u32,
+    step_query: extern "C" fn(u32) -> u32,
+    reset: extern "C" fn(u32),
+    finalize: extern "C" fn(u32),
 }
 
 static mut LIB: Option<LibDb> = None;
@@ -72,6 +87,7 @@ pub fn init() -> bool {
     unsafe {
         let lib = LibDb {
             open: resolve(&handle, "libdb_open"),
+            open_readonly: resolve(&handle, "libdb_open_readonly"),
             close: resolve(&handle, "libdb_close"),
             error: resolve(&handle, "libdb_error"),
             exec: resolve(&handle, "libdb_exec"),
@@ -84,6 +100,14 @@ pub fn init() -> bool {
             result_get_text: resolve(&handle, "libdb_result_get_text"),
             result_is_null: resolve(&handle, "libdb_result_is_null"),
             result_free: resolve(&handle, "libdb_result_free"),
+            prepare: resolve(&handle, "libdb_prepare"),
+            bind_int: resolve(&handle, "libdb_bind_int"),
+            bind_text: resolve(&handle, "libdb_bind_text"),
+            bind_null: resolve(&handle, "libdb_bind_null"),
+            step: resolve(&handle, "libdb_step"),
+            step_query: resolve(&handle, "libdb_step_query"),
+            reset: resolve(&handle, "libdb_reset"),
+            finalize: resolve(&handle, "libdb_finalize"),
             _handle: handle,
         };
         LIB = Some(lib);
@@ -105,6 +129,13 @@ impl Database {
         if h == 0 { None } else { Some(Database { handle: h }) }
     }
 
+    /// Open an existing database for queries only. The file is mapped into
+    /// memory and rows are read in place; any change returns an error.
+    pub fn open_readonly(path: &str) -> Option<Database> {
+        let h = (lib().open_readonly)(path.as_ptr(), path.len() as u32);
+        if h == 0 { None } else { Some(Database { handle: h }) }
+    }
+
     /// Execute a non-query SQL statement (CREATE, DROP, INSERT, UPDATE, DELETE).
     /// Returns the number of rows affected, or an error message.
     pub fn exec(&self, sql: &str) -> Result<u32, String> {
@@ -126,6 +157,16 @@ impl Database {
         }
     }
 
+    /// Prepare a statement with `?` placeholders for repeated execution.
+    pub fn prepare(&self, sql: &str) -> Result<Statement<'_>, String> {
+        let id = (lib().prepare)(self.handle, sql.as_ptr(), sql.len() as u32);
+        if id == 0 {
+            Err(self.last_error())
+        } else {
+            Ok(Statement { db: self, id })
+        }
+    }
+
     /// Get the last error message (empty string if no error).
     pub fn last_error(&self) -> String {
         let mut buf = [0u8; 256];
@@ -152,6 +193,68 @@ impl Drop for Database {
     }
 }
 
+// ── Statement ────────────────────────────────────────────────────────────────
+
+/// A prepared statement. Parameters are numbered from 1 and keep their
+/// values across `step()` calls until rebound or `reset()`.
+pub struct Statement<'a> {
+    db: &'a Database,
+    id: u32,
+}
+
+impl<'a> Statement<'a> {
+    /// Bind an integer to parameter `index`.
+    pub fn bind_int(&mut self, index: u32, value: i64) -> Result<(), String> {
+        let v = value as u64;
+        self.check((lib().bind_int)(self.id, index, v as u32, (v >> 32) as u32))
+    }
+
+    /// Bind a text value to parameter `index`.
+    pub fn bind_text(&mut self, index: u32, value: &str) -> Result<(), String> {
+        self.check((lib().bind_text)(self.id, index, value.as_ptr(), value.len() as u32))
+    }
+
+    /// Bind NULL to parameter `index`.
+    pub fn bind_null(&mut self, index: u32) -> Result<(), String> {
+        self.check((lib().bind_null)(self.id, index))
+    }
+
+    /// Run a non-query statement. Returns the number of rows affected.
+    pub fn step(&mut self) -> Result<u32, String> {
+        let result = (lib().step)(self.id);
+        if result == u32::MAX {
+            Err(self.db.last_error())
+        } else {
+            Ok(result)
+        }
+    }
+
+    /// Run a SELECT statement.
+    pub fn step_query(&mut self) -> Result<QueryResult, String> {
+        let id = (lib().step_query)(self.id);
+        if id == 0 {
+            Err(self.db.last_error())
+        } else {
+            Ok(QueryResult { id })
+        }
+    }
+
+    /// Clear all bindings.
+    pub fn reset(&mut self) {
+        (lib().reset)(self.id);
+    }
+
+    fn check(&self, status: u32) -> Result<(), String> {
+        if status == u32::MAX { Err(self.db.last_error()) } else { Ok(()) }
+    }
+}
+
+impl Drop for Statement<'_> {
+    fn drop(&mut self) {
+        (lib().finalize)(self.id);
+    }
+}
+
 // ── QueryResult ──────────────────────────────────────────────────────────────
 
 /// A query result set returned by SELECT.
@@ -0,0 +1,372 @@
+//! Signed-area accumulation rasterizer for large glyphs (font-rs style).
+//!
+//! Every line segment adds, to each pixel it crosses, the exact signed area
+//! it covers to the right of itself within that scanline; one prefix sum per
+//! row then turns the accumulation buffer into coverage.  Areas are computed
+//! in f32 and accumulated as fixed-point i32 (`ACC_ONE` = full pixel), which
+//! keeps the prefix sum to one integer add per pixel.  Quadratic curves
+//! are flattened into as few segments as a fixed pixel tolerance allows, so
+//! the segment count grows with the square root of the curve's size rather
+//! than with a fixed recursion depth.
+//!
+//! Used from `ttf_rasterizer::AREA_MIN_SIZE` up; smaller sizes keep the
+//! fixed-point rasterizer the gamma LUTs were tuned against.
+//!
+//! The prefix sum runs 4 pixels at a time (SSE2 on x86_64, NEON on aarch64,
+//! scalar elsewhere) and clears the accumulation buffer as it goes, so one
+//! buffer is reused for every glyph instead of allocating and zeroing it.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use super::ttf::{GlyphOutline, GlyphPoint};
+
+/// Flattening tolerance; higher = more segments per curve.
+const FLATTEN_TOLERANCE: f32 = 3.0;
+
+/// Largest accumulation buffer (in cells) kept between glyphs.
+const SCRATCH_KEEP: usize = 256 * 1024;
+
+/// Accumulation buffer reused across glyphs.  `finish` clears every cell it
+/// reads, so the buffer is all zeros whenever it is parked here.
+static mut SCRATCH: Vec<i32> = Vec::new();
+
+/// Accumulator value of a fully covered pixel: coverage 255 with 8
+/// fractional bits, so coverage = (|sum| + 128) >> 8.
+const ACC_ONE: f32 = 255.0 * 256.0;
+
+#[derive(Clone, Copy)]
+struct Point {
+    x: f32,
+    y: f32,
+}
+
+fn lerp(a: Point, b: Point, t: f32) -> Point {
+    Point { x: a.x + (b.x - a.x) * t, y: a.y + (b.y - a.y) * t }
+}
+
+fn mid(a: Point, b: Point) -> Point {
+    Point { x: (a.x + b.x) * 0.5, y: (a.y + b.y) * 0.5 }
+}
+
+/// Truncate to i32.  Every value converted here is finite and bounded by
+/// the glyph size (at most 4096 px) times `ACC_ONE`, so the saturating `as`
+/// cast and its NaN/overflow checks can be skipped.
+#[inline(always)]
+fn trunc(v: f32) -> i32 {
+    unsafe { v.to_int_unchecked() }
+}
+
+/// `floor` for the non-negative coordinates used here (no libm in core).
+#[inline(always)]
+fn floor(v: f32) -> f32 {
+    trunc(v) as f32
+}
+
+#[inline(always)]
+fn ceil(v: f32) -> f32 {
+    let f = floor(v);
+    if f < v { f + 1.0 } else { f }
+}
+
+/// Smallest n with n⁴ >= v, i.e. ceil(v^(1/4)); at most 64.
+fn fourth_root_ceil(v: f32) -> u32 {
+    let mut n = 1u32;
+    while n < 64 && ((n * n * n * n) as f32) < v {
+        n += 1;
+    }
+    n
+}
+
+/// Rasterize `outline` into a `width` × `height` coverage bitmap.  Font
+/// units map to pixels as `x * scale_x - x_min`, `y_max - y * scale_y`.
+pub(crate) fn rasterize(
+    outline: &GlyphOutline, scale_x: f32, scale_y: f32,
+    x_min: i32, y_max: i32, width: u32, height: u32,
+) -> Vec<u8> {
+    let mut acc = Accumulator::new(width as usize, height as usize);
+    let to_px = |p: &GlyphPoint| Point {
+        x: p.x as f32 * scale_x - x_min as f32,
+        y: y_max as f32 - p.y as f32 * scale_y,
+    };
+
+    let mut start = 0usize;
+    for &end in &outline.contour_ends {
+        let end = end as usize;
+        if end >= outline.points.len() || start > end {
+            start = end + 1;
+            continue;
+        }
+        let contour = &outline.points[start..=end];
+        start = end + 1;
+        if contour.len() < 2 {
+            continue;
+        }
+
+        // Begin at an on-curve point, or at the implied midpoint of the
+        // first two control points when there is none.
+        let n = contour.len();
+        let first_on = contour.iter().position(|p| p.on_curve);
+        let (origin, first) = match first_on {
+            Some(i) => (to_px(&contour[i]), i + 1),
+            None => (mid(to_px(&contour[0]), to_px(&contour[1])), 1),
+        };
+        let mut pen = origin;
+        let mut ctrl: Option<Point> = None;
+        for k in 0..n {
+            let p = &contour[(first + k) % n];
+            let pt = to_px(p);
+            match (p.on_curve, ctrl) {
+                (true, None) => {
+                    acc.line(pen, pt);
+                    pen = pt;
+                }
+                (true, Some(c)) => {
+                    acc.quad(pen, c, pt);
+                    pen = pt;
+                    ctrl = None;
+                }
+                (false, None) => ctrl = Some(pt),
+                (false, Some(c)) => {
+                    let m = mid(c, pt);
+                    acc.quad(pen, c, m);
+                    pen = m;
+                    ctrl = Some(pt);
+                }
+            }
+        }
+        match ctrl {
+            Some(c) => acc.quad(pen, c, origin),
+            None => acc.line(pen, origin),
+        }
+    }
+
+    acc.finish()
+}
+
+struct Accumulator {
+    width: usize,
+    height: usize,
+    /// Row stride: `width` plus room for the area spilling past the last
+    /// column.
+    stride: usize,
+    area: Vec<i32>,
+}
+
+impl Accumulator {
+    fn new(width: usize, height: usize) -> Self {
+        let stride = width + 2;
+        let mut area = unsafe { core::mem::take(&mut *core::ptr::addr_of_mut!(SCRATCH)) };
+        if area.len() < stride * height {
+            area.resize(stride * height, 0);
+        }
+        Accumulator { width, height, stride, area }
+    }
+
+    fn quad(&mut self, p0: Point, p1: Point, p2: Point) {
+        let devx = p0.x - 2.0 * p1.x + p2.x;
+        let devy = p0.y - 2.0 * p1.y + p2.y;
+        let devsq = devx * devx + devy * devy;
+        if devsq < 0.333 {
+            self.line(p0, p2);
+            return;
+        }
+        // Segments needed for the tolerance: n ~ (tol * dev²)^(1/4).
+        let n = fourth_root_ceil(FLATTEN_TOLERANCE * devsq);
+        let step = 1.0 / n as f32;
+        let mut prev = p0;
+        for i in 1..n {
+            let t = i as f32 * step;
+            let p = lerp(lerp(p0, p1, t), lerp(p1, p2, t), t);
+            self.line(prev, p);
+            prev = p;
+        }
+        self.line(prev, p2);
+    }
+
+    fn line(&mut self, p0: Point, p1: Point) {
+        if p0.y == p1.y {
+            return;
+        }
+        let (dir, p0, p1) = if p0.y < p1.y { (1.0, p0, p1) } else { (-1.0, p1, p0) };
+        let dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+        let max_x = self.width as f32;
+        let mut x = p0.x;
+        let y_start = if p0.y < 0.0 {
+            x -= p0.y * dxdy;
+            0
+        } else {
+            trunc(p0.y)
+        };
+        let y_end = trunc(ceil(p1.y.max(0.0))).min(self.height as i32);
+        for y in y_start..y_end {
+            let row = y as usize * self.stride;
+            let dy = (p1.y.min((y + 1) as f32)) - (p0.y.max(y as f32));
+            let xnext = x + dxdy * dy;
+            let d = dy * dir * ACC_ONE;
+            let (x0, x1) = if x < xnext { (x, xnext) } else { (xnext, x) };
+            let (x0, x1) = (x0.max(0.0).min(max_x), x1.max(0.0).min(max_x));
+            let x0floor = floor(x0);
+            let x0i = trunc(x0floor) as usize;
+            let x1ceil = ceil(x1);
+            let x1i = trunc(x1ceil) as usize;
+            let a = &mut self.area[row..row + self.stride];
+            if x1i <= x0i + 1 {
+                // Crosses a single pixel: split at the mean x.
+                let xmf = 0.5 * (x0 + x1) - x0floor;
+                let right = trunc(d * xmf);
+                a[x0i] += trunc(d) - right;
+                a[x0i + 1] += right;
+            } else {
+                let s = 1.0 / (x1 - x0);
+                let x0f = x0 - x0floor;
+                let a0 = 0.5 * s * (1.0 - x0f) * (1.0 - x0f);
+                let x1f = x1 - x1ceil + 1.0;
+                let am = 0.5 * s * x1f * x1f;
+                // The row's contributions must add up to exactly `d`, or the
+                // rounding error would leak into the rest of the row.
+                let total = trunc(d);
+                let first = trunc(d * a0);
+                let last = trunc(d * am);
+                a[x0i] += first;
+                let mut mid = total - first - last;
+                if x1i > x0i + 2 {
+                    let a1 = s * (1.5 - x0f);
+                    let second = trunc(d * (a1 - a0));
+                    a[x0i + 1] += second;
+                    mid -= second;
+                    let step = trunc(d * s);
+                    for xi in x0i + 2..x1i - 1 {
+                        a[xi] += step;
+                        mid -= step;
+                    }
+                }
+                a[x1i - 1] += mid;
+                a[x1i] += last;
+            }
+            x = xnext;
+        }
+    }
+
+    /// Prefix-sum each row into 8-bit coverage (nonzero winding, clamped),
+    /// zeroing the buffer on the way, and park the buffer for the next glyph.
+    fn finish(mut self) -> Vec<u8> {
+        let mut out = vec![0u8; self.width * self.height];
+        for y in 0..self.height {
+            let row = &mut self.area[y * self.stride..(y + 1) * self.stride];
+            let (src, spill) = row.split_at_mut(self.width);
+            arch::accumulate_row(src, &mut out[y * self.width..(y + 1) * self.width]);
+            spill.fill(0);
+        }
+        if self.area.len() <= SCRATCH_KEEP {
+            unsafe { *core::ptr::addr_of_mut!(SCRATCH) = self.area; }
+        }
+        out
+    }
+}
+
+#[inline(always)]
+fn to_coverage(sum: i32) -> u8 {
+    ((sum.unsigned_abs() + 128) >> 8).min(255) as u8
+}
+
+/// Scalar prefix sum, starting from `sum`; clears `src`.
+fn accumulate_scalar(src: &mut [i32], dst: &mut [u8], mut sum: i32) {
+    for (d, a) in dst.iter_mut().zip(src) {
+        sum += *a;
+        *a = 0;
+        *d = to_coverage(sum);
+    }
+}
+
+// ── x86_64: SSE2 ────────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "x86_64")]
+mod arch {
+    use core::arch::x86_64::*;
+
+    /// Prefix sum of 4 lanes plus the running total in `carry`; returns
+    /// `(|x| + 128) >> 8` and clears the source cells.
+    #[inline(always)]
+    unsafe fn step(p: *mut i32, carry: &mut __m128i) -> __m128i {
+        let p = p as *mut __m128i;
+        let mut x = _mm_loadu_si128(p);
+        _mm_storeu_si128(p, _mm_setzero_si128());
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, *carry);
+        *carry = _mm_shuffle_epi32(x, 0xFF);
+        // No pabsd in SSE2.
+        let sign = _mm_srai_epi32(x, 31);
+        let abs = _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+        _mm_srli_epi32(_mm_add_epi32(abs, _mm_set1_epi32(128)), 8)
+    }
+
+    pub fn accumulate_row(src: &mut [i32], dst: &mut [u8]) {
+        let n = src.len().min(dst.len());
+        let mut i = 0;
+        unsafe {
+            let s = src.as_mut_ptr();
+            let d = dst.as_mut_ptr();
+            let mut carry = _mm_setzero_si128();
+            // 16 pixels per store; the saturating packs clamp to 255.
+            while i + 16 <= n {
+                let v0 = step(s.add(i), &mut carry);
+                let v1 = step(s.add(i + 4), &mut carry);
+                let v2 = step(s.add(i + 8), &mut carry);
+                let v3 = step(s.add(i + 12), &mut carry);
+                let packed = _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+                _mm_storeu_si128(d.add(i) as *mut __m128i, packed);
+                i += 16;
+            }
+            while i + 4 <= n {
+                let v = step(s.add(i), &mut carry);
+                let v16 = _mm_packs_epi32(v, v);
+                (d.add(i) as *mut i32).write_unaligned(_mm_cvtsi128_si32(_mm_packus_epi16(v16, v16)));
+                i += 4;
+            }
+            let sum = _mm_cvtsi128_si32(carry);
+            super::accumulate_scalar(&mut src[i..n], &mut dst[i..n], sum);
+        }
+    }
+}
+
+// ── aarch64: NEON ───────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "aarch64")]
+mod arch {
+    use core::arch::aarch64::*;
+
+    pub fn accumulate_row(src: &mut [i32], dst: &mut [u8]) {
+        let chunks = src.len().min(dst.len()) / 4;
+        unsafe {
+            let zero = vdupq_n_s32(0);
+            let max = vdupq_n_s32(255);
+            let mut carry = zero;
+            for i in 0..chunks {
+                let p = src.as_mut_ptr().add(i * 4);
+                let mut x = vld1q_s32(p);
+                vst1q_s32(p, zero);
+                x = vaddq_s32(x, vextq_s32(zero, x, 3));
+                x = vaddq_s32(x, vextq_s32(zero, x, 2));
+                x = vaddq_s32(x, carry);
+                carry = vdupq_laneq_s32(x, 3);
+                let v = vminq_s32(vrshrq_n_s32(vabsq_s32(x), 8), max);
+                dst[i * 4] = vgetq_lane_s32(v, 0) as u8;
+                dst[i * 4 + 1] = vgetq_lane_s32(v, 1) as u8;
+                dst[i * 4 + 2] = vgetq_lane_s32(v, 2) as u8;
+                dst[i * 4 + 3] = vgetq_lane_s32(v, 3) as u8;
+            }
+            let sum = vgetq_lane_s32(carry, 0);
+            super::accumulate_scalar(&mut src[chunks * 4..], &mut dst[chunks * 4..], sum);
+        }
+    }
+}
+
+// ── Scalar fallback ─────────────────────────────────────────────────────────
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+mod arch {
+    pub fn accumulate_row(src: &mut [i32], dst: &mut [u8]) {
+        super::accumulate_scalar(src, dst, 0);
+    }
+}
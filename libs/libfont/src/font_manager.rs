@@ -5,11 +5,13 @@
 //! glyph cache uses hash table for O(1) lookup, FIR filter uses fixed-point.
 
 use alloc::boxed::Box;
+use alloc::vec;
 use alloc::vec::Vec;
 
 use crate::ttf::TtfFont;
 use crate::ttf_rasterizer;
 use crate::png_decode;
+use crate::shared_cache;
 use crate::syscall;
 
 /// FontManager pointer — lives in per-process .bss (zero-initialized per process).
@@ -44,6 +46,17 @@ const MAX_CACHE_SIZE: usize = 4096;
 const GLYPH_HASH_SIZE: usize = 4096;
 const GLYPH_HASH_EMPTY: u16 = 0xFFFF;
 
+/// Slots of the direct-mapped shaped-run and measurement caches (power of 2).
+const RUN_CACHE_SIZE: usize = 512;
+const MEASURE_CACHE_SIZE: usize = 512;
+
+/// Longer strings (paragraphs, editor buffers) are laid out on every call.
+const MAX_RUN_TEXT: usize = 256;
+
+/// Largest composited run bitmap, and the budget for all of them.
+const MAX_RUN_MASK: usize = 32 * 1024;
+const RUN_MASK_BUDGET: usize = 1024 * 1024;
+
 /// System font IDs (must match kernel convention).
 pub const SYSTEM_FONT_ID: u16 = 0;
 pub const SYSTEM_FONT_BOLD: u16 = 1;
@@ -64,6 +77,9 @@ struct LoadedFont {
     /// char→glyph cache for ASCII codepoints (avoids cmap4 binary search).
     /// 0xFFFF = not cached yet.
     ascii_glyph_cache: [u16; 128],
+    /// Embedded system font: identical in every process, so its glyphs
+    /// go through the shared cache.
+    shared: bool,
 }
 
 impl LoadedFont {
@@ -71,6 +87,7 @@ impl LoadedFont {
         LoadedFont {
             ttf,
             ascii_glyph_cache: [0xFFFF; 128],
+            shared: false,
         }
     }
 
@@ -102,10 +119,69 @@ struct CachedGlyph {
     x_offset: i32,
     y_offset: i32,
     advance: u32,
-    coverage: Vec<u8>,
+    coverage: Coverage,
     use_count: u32,
 }
 
+/// Glyph bitmap, owned by this process or in the shared glyph cache.
+enum Coverage {
+    Owned(Vec<u8>),
+    Shared(&'static [u8]),
+}
+
+impl core::ops::Deref for Coverage {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        match self {
+            Coverage::Owned(v) => v,
+            Coverage::Shared(s) => s,
+        }
+    }
+}
+
+/// A glyph of a laid-out run.
+struct RunGlyph {
+    font_id: u16,
+    glyph_id: u16,
+    /// Bitmap position relative to the run origin.
+    x: i32,
+    y: i32,
+    is_color: bool,
+}
+
+/// Coverage of all non-color glyphs of a run composited into one bitmap,
+/// with the gamma LUT and LCD filter already applied, so a cached run is
+/// drawn in a single blend pass.
+struct RunMask {
+    x: i32,
+    y: i32,
+    width: u32,
+    height: u32,
+    /// 3 bytes (R, G, B coverage) per pixel when subpixel, else 1.
+    subpixel: bool,
+    alpha: Vec<u8>,
+}
+
+/// A string laid out for one font, size and smoothing mode.
+struct TextRun {
+    key: u64,
+    text: Vec<u8>,
+    font_id: u16,
+    size: u16,
+    smoothing: u32,
+    glyphs: Vec<RunGlyph>,
+    mask: Option<RunMask>,
+}
+
+struct MeasuredText {
+    key: u64,
+    text: Vec<u8>,
+    font_id: u16,
+    size: u16,
+    extent: (u32, u32),
+}
+
 pub struct FontManager {
     fonts: Vec<Option<LoadedFont>>,
     cache: Vec<CachedGlyph>,
@@ -114,6 +190,12 @@ pub struct FontManager {
     glyph_hash: [u16; GLYPH_HASH_SIZE],
     access_counter: u32,
     subpixel_enabled: bool,
+    /// Shaped-run cache, direct-mapped by `run_key`.
+    runs: Vec<Option<Box<TextRun>>>,
+    /// Bytes held by `RunMask` bitmaps.
+    run_mask_bytes: usize,
+    /// `measure_string` results, direct-mapped by `run_key`.
+    measures: Vec<Option<MeasuredText>>,
 }
 
 /// Compute hash table index from glyph cache key.
@@ -132,6 +214,9 @@ impl FontManager {
             glyph_hash: [GLYPH_HASH_EMPTY; GLYPH_HASH_SIZE],
             access_counter: 0,
             subpixel_enabled: false,
+            runs: Vec::new(),
+            run_mask_bytes: 0,
+            measures: Vec::new(),
         }
     }
 
@@ -161,6 +246,13 @@ impl FontManager {
             .and_then(|slot| slot.as_mut())
     }
 
+    fn is_shared(&self, font_id: u16) -> bool {
+        self.fonts
+            .get(font_id as usize)
+            .and_then(|slot| slot.as_ref())
+            .map_or(false, |f| f.shared)
+    }
+
     fn get_font_or_fallback(&self, font_id: u16) -> Option<&TtfFont> {
         self.get_font(font_id)
             .or_else(|| if font_id != SYSTEM_FONT_ID { self.get_font(SYSTEM_FONT_ID) } else { None })
@@ -170,6 +262,10 @@ impl FontManager {
         if let Some(slot) = self.fonts.get_mut(font_id as usize) {
             *slot = None;
         }
+        // The ID may be reused by the next font loaded.
+        self.runs.clear();
+        self.run_mask_bytes = 0;
+        self.measures.clear();
         // Invalidate all hash entries for this font, then remove from cache
         for i in (0..self.cache.len()).rev() {
             if self.cache[i].font_id == font_id {
@@ -261,22 +357,15 @@ impl FontManager {
         &mut self, font_id: u16, glyph_id: u16, size: u16, subpixel: bool,
         bitmap: ttf_rasterizer::GlyphBitmap,
     ) -> usize {
-        self.evict_if_needed();
-        self.access_counter += 1;
-        let idx = self.cache.len();
-        self.cache.push(CachedGlyph {
+        self.push_glyph(CachedGlyph {
             font_id, glyph_id, size, subpixel,
             is_color: false,
             width: bitmap.width, height: bitmap.height,
             x_offset: bitmap.x_offset, y_offset: bitmap.y_offset,
             advance: bitmap.advance,
-            coverage: bitmap.coverage,
-            use_count: self.access_counter,
-        });
-        // Store in hash table
-        let hash = glyph_hash_index(font_id, glyph_id, size, subpixel);
-        self.glyph_hash[hash] = idx as u16;
-        idx
+            coverage: Coverage::Owned(bitmap.coverage),
+            use_count: 0,
+        })
     }
 
     fn cache_color_glyph(
@@ -284,17 +373,37 @@ impl FontManager {
         width: u32, height: u32, x_offset: i32, y_offset: i32, advance: u32,
         rgba_data: Vec<u8>,
     ) -> usize {
-        self.evict_if_needed();
-        self.access_counter += 1;
-        let idx = self.cache.len();
-        self.cache.push(CachedGlyph {
+        self.push_glyph(CachedGlyph {
             font_id, glyph_id, size, subpixel,
             is_color: true,
             width, height, x_offset, y_offset, advance,
-            coverage: rgba_data,
-            use_count: self.access_counter,
-        });
-        let hash = glyph_hash_index(font_id, glyph_id, size, subpixel);
+            coverage: Coverage::Owned(rgba_data),
+            use_count: 0,
+        })
+    }
+
+    /// Add a glyph to the cache.  Bitmaps of system fonts are moved into
+    /// the shared glyph cache so other processes can use them too.
+    fn push_glyph(&mut self, mut glyph: CachedGlyph) -> usize {
+        if self.is_shared(glyph.font_id) {
+            if let Coverage::Owned(ref v) = glyph.coverage {
+                if let Some(data) = shared_cache::insert(
+                    glyph.font_id, glyph.glyph_id, glyph.size, glyph.subpixel,
+                    glyph.is_color, glyph.width, glyph.height,
+                    glyph.x_offset, glyph.y_offset, glyph.advance, v,
+                ) {
+                    glyph.coverage = Coverage::Shared(data);
+                }
+            }
+        }
+
+        self.evict_if_needed();
+        self.access_counter += 1;
+        glyph.use_count = self.access_counter;
+        let idx = self.cache.len();
+        let hash = glyph_hash_index(glyph.font_id, glyph.glyph_id, glyph.size, glyph.subpixel);
+        self.cache.push(glyph);
+        // Store in hash table
         self.glyph_hash[hash] = idx as u16;
         idx
     }
@@ -302,6 +411,21 @@ impl FontManager {
     fn rasterize_and_cache(
         &mut self, font_id: u16, glyph_id: u16, size: u16, subpixel: bool,
     ) -> Option<usize> {
+        // Another process may already have rasterized it.
+        if self.is_shared(font_id) {
+            if let Some(g) = shared_cache::lookup(font_id, glyph_id, size, subpixel) {
+                return Some(self.push_glyph(CachedGlyph {
+                    font_id, glyph_id, size, subpixel,
+                    is_color: g.is_color,
+                    width: g.width, height: g.height,
+                    x_offset: g.x_offset, y_offset: g.y_offset,
+                    advance: g.advance,
+                    coverage: Coverage::Shared(g.data),
+                    use_count: 0,
+                }));
+            }
+        }
+
         let ttf = self.get_font(font_id)?;
         let units_per_em = ttf.units_per_em;
         let advance_fu = ttf.advance_width(glyph_id);
@@ -457,6 +581,11 @@ pub fn init() {
         mgr.fonts.push(None);
     }
 
+    for font in mgr.fonts.iter_mut().flatten() {
+        font.shared = true;
+    }
+    shared_cache::init();
+
     if syscall::gpu_has_accel() != 0 {
         mgr.subpixel_enabled = true;
     }
@@ -528,7 +657,29 @@ pub fn measure_string(text: &str, font_id: u16, size: u16) -> (u32, u32) {
     };
 
     let actual_font_id = if mgr.get_font(font_id).is_some() { font_id } else { SYSTEM_FONT_ID };
+    let bytes = text.as_bytes();
+    if bytes.len() > MAX_RUN_TEXT {
+        return measure_uncached(mgr, text, actual_font_id, size);
+    }
 
+    let key = run_key(bytes, actual_font_id, size, 0);
+    let slot = key as usize & (MEASURE_CACHE_SIZE - 1);
+    if mgr.measures.is_empty() {
+        mgr.measures.resize_with(MEASURE_CACHE_SIZE, || None);
+    }
+    if let Some(ref m) = mgr.measures[slot] {
+        if m.key == key && m.font_id == actual_font_id && m.size == size && m.text == bytes {
+            return m.extent;
+        }
+    }
+    let extent = measure_uncached(mgr, text, actual_font_id, size);
+    mgr.measures[slot] = Some(MeasuredText {
+        key, text: bytes.to_vec(), font_id: actual_font_id, size, extent,
+    });
+    extent
+}
+
+fn measure_uncached(mgr: &mut FontManager, text: &str, actual_font_id: u16, size: u16) -> (u32, u32) {
     // Get UPM from font (immutable borrow)
     let upm = match mgr.get_font(actual_font_id) {
         Some(ttf) => ttf.units_per_em as u32,
@@ -606,6 +757,10 @@ pub fn draw_string_buf(
 
 /// Draw a string into an ARGB pixel buffer, clipped to a rectangle.
 /// Clip rect is (clip_x, clip_y, clip_r, clip_b) — left/top/right/bottom in pixels.
+///
+/// Strings up to `MAX_RUN_TEXT` bytes are laid out once per font, size and
+/// smoothing mode and kept in the run cache; labels redrawn every frame then
+/// cost one blend pass over the run's composited coverage.
 pub fn draw_string_buf_clipped(
     buf: *mut u32, buf_w: u32, buf_h: u32,
     x: i32, y: i32, color: u32,
@@ -626,115 +781,320 @@ pub fn draw_string_buf_clipped(
 
     // Read font smoothing mode from shared uisys page
     let smoothing = read_font_smoothing();
-    let subpixel = smoothing == 2;
     let actual_font_id = if mgr.get_font(font_id).is_some() { font_id } else { SYSTEM_FONT_ID };
-    let (upm, ascent_px, lh, tab_advance) = {
-        let ttf = match mgr.get_font(actual_font_id) {
-            Some(t) => t,
-            None => return,
-        };
-        let upm = ttf.units_per_em as u32;
-        let ascent_px = (ttf.ascent.unsigned_abs() as u32 * size as u32) / upm;
-        let lh = line_height_internal(ttf, size) as i32;
-        let space_gid = ttf.char_to_glyph(b' ' as u32);
-        let space_adv = ttf.advance_width(space_gid) as u32;
-        let tab_advance = (space_adv * 4 * size as u32 / upm) as i32;
-        (upm, ascent_px, lh, tab_advance)
-    };
+    if mgr.get_font(actual_font_id).is_none() { return; }
+
+    let clip = Clip { x: clip_x, y: clip_y, r: clip_r, b: clip_b };
+    let bytes = text.as_bytes();
+    if bytes.len() > MAX_RUN_TEXT {
+        // Not cached: lay out only up to the right edge of the clip rect.
+        let run = mgr.layout_run(text, actual_font_id, size, smoothing, 0, clip_r - x);
+        mgr.draw_run(&run, buf, buf_w, buf_h, x, y, color, clip);
+        return;
+    }
 
-    let mut cx = x;
-    let mut cy = y;
+    let key = run_key(bytes, actual_font_id, size, smoothing);
+    let slot = key as usize & (RUN_CACHE_SIZE - 1);
+    if mgr.runs.is_empty() {
+        mgr.runs.resize_with(RUN_CACHE_SIZE, || None);
+    }
+    let hit = mgr.runs[slot].as_ref().map_or(false, |r| {
+        r.key == key && r.font_id == actual_font_id && r.size == size
+            && r.smoothing == smoothing && r.text == bytes
+    });
+    let run = if hit {
+        mgr.runs[slot].take().unwrap()
+    } else {
+        if let Some(old) = mgr.runs[slot].take() {
+            mgr.run_mask_bytes -= old.mask.as_ref().map_or(0, |m| m.alpha.len());
+        }
+        let mut run = Box::new(mgr.layout_run(text, actual_font_id, size, smoothing, key, i32::MAX));
+        run.mask = mgr.composite_run(&run);
+        mgr.run_mask_bytes += run.mask.as_ref().map_or(0, |m| m.alpha.len());
+        run
+    };
+    mgr.draw_run(&run, buf, buf_w, buf_h, x, y, color, clip);
+    mgr.runs[slot] = Some(run);
+}
 
-    let col_a = ((color >> 24) & 0xFF) as u32;
-    let col_r = ((color >> 16) & 0xFF) as u8;
-    let col_g = ((color >> 8) & 0xFF) as u8;
-    let col_b = (color & 0xFF) as u8;
+/// Clip rectangle, already clamped to the target buffer.
+#[derive(Clone, Copy)]
+struct Clip {
+    x: i32,
+    y: i32,
+    r: i32,
+    b: i32,
+}
 
-    for ch in text.chars() {
-        // Early exit: cursor past right edge of clip rect
-        if cx >= clip_r { break; }
+/// Cache key of a string in a font, size and smoothing mode (FNV-1a).
+fn run_key(text: &[u8], font_id: u16, size: u16, smoothing: u32) -> u64 {
+    let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+    for &b in text {
+        h = (h ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    let params = (font_id as u64) << 32 | (size as u64) << 8 | smoothing as u64;
+    (h ^ params).wrapping_mul(0x0000_0100_0000_01b3)
+}
 
-        if ch == '\n' {
-            cx = x;
-            cy += lh;
-            continue;
-        }
-        if ch == '\t' {
-            cx += tab_advance;
-            continue;
+impl FontManager {
+    /// Map `text` to glyphs and position them, rasterizing missing glyphs.
+    /// Layout stops once the pen passes `stop_x` (relative to the origin).
+    fn layout_run(
+        &mut self, text: &str, font_id: u16, size: u16, smoothing: u32, key: u64, stop_x: i32,
+    ) -> TextRun {
+        let subpixel = smoothing == 2;
+        let mut run = TextRun {
+            key,
+            text: Vec::new(),
+            font_id, size, smoothing,
+            glyphs: Vec::new(),
+            mask: None,
+        };
+        let (ascent_px, lh, tab_advance) = match self.get_font(font_id) {
+            Some(ttf) => {
+                let upm = ttf.units_per_em as u32;
+                let ascent_px = (ttf.ascent.unsigned_abs() as u32 * size as u32) / upm;
+                let lh = line_height_internal(ttf, size) as i32;
+                let space_gid = ttf.char_to_glyph(b' ' as u32);
+                let space_adv = ttf.advance_width(space_gid) as u32;
+                let tab_advance = (space_adv * 4 * size as u32 / upm) as i32;
+                (ascent_px as i32, lh, tab_advance)
+            }
+            None => return run,
+        };
+        if key != 0 {
+            run.text.extend_from_slice(text.as_bytes());
         }
 
-        // Step 1: Get glyph ID from primary font
-        let primary_gid = match mgr.get_font_mut(actual_font_id) {
-            Some(f) => f.char_to_glyph_cached(ch as u32),
-            None => continue,
-        };
+        let mut cx = 0i32;
+        let mut cy = 0i32;
 
-        // Step 2: Fallback to emoji font if glyph missing
-        let (gid, render_font_id) = if primary_gid == 0 && actual_font_id != SYSTEM_FONT_EMOJI {
-            match mgr.get_font_mut(SYSTEM_FONT_EMOJI) {
-                Some(ef) => {
-                    let eid = ef.char_to_glyph_cached(ch as u32);
-                    if eid != 0 { (eid, SYSTEM_FONT_EMOJI) } else { (primary_gid, actual_font_id) }
-                }
-                None => (primary_gid, actual_font_id),
+        for ch in text.chars() {
+            // Early exit: cursor past right edge of clip rect
+            if cx >= stop_x { break; }
+
+            if ch == '\n' {
+                cx = 0;
+                cy += lh;
+                continue;
+            }
+            if ch == '\t' {
+                cx += tab_advance;
+                continue;
             }
-        } else {
-            (primary_gid, actual_font_id)
-        };
 
-        // Step 3: Compute advance width from the resolved font
-        let advance_px = match mgr.get_font(render_font_id) {
-            Some(ttf) => {
-                let adv_fu = ttf.advance_width(gid);
-                let font_upm = ttf.units_per_em as u32;
-                (adv_fu as u32 * size as u32 + font_upm / 2) / font_upm
+            // Step 1: Get glyph ID from primary font
+            let primary_gid = match self.get_font_mut(font_id) {
+                Some(f) => f.char_to_glyph_cached(ch as u32),
+                None => continue,
+            };
+
+            // Step 2: Fallback to emoji font if glyph missing
+            let (gid, render_font_id) = if primary_gid == 0 && font_id != SYSTEM_FONT_EMOJI {
+                match self.get_font_mut(SYSTEM_FONT_EMOJI) {
+                    Some(ef) => {
+                        let eid = ef.char_to_glyph_cached(ch as u32);
+                        if eid != 0 { (eid, SYSTEM_FONT_EMOJI) } else { (primary_gid, font_id) }
+                    }
+                    None => (primary_gid, font_id),
+                }
+            } else {
+                (primary_gid, font_id)
+            };
+
+            // Step 3: Compute advance width from the resolved font
+            let advance_px = match self.get_font(render_font_id) {
+                Some(ttf) => {
+                    let adv_fu = ttf.advance_width(gid);
+                    let font_upm = ttf.units_per_em as u32;
+                    (adv_fu as u32 * size as u32 + font_upm / 2) / font_upm
+                }
+                None => continue,
+            };
+
+            // Step 4: Rasterize/cache and place
+            if let Some(idx) = self.glyph_index(render_font_id, gid, size, subpixel) {
+                let glyph = &self.cache[idx];
+                if glyph.width > 0 && glyph.height > 0 {
+                    let gx = if glyph.is_color || !glyph.subpixel { glyph.x_offset } else { glyph.x_offset / 3 };
+                    run.glyphs.push(RunGlyph {
+                        font_id: render_font_id,
+                        glyph_id: gid,
+                        x: cx + gx,
+                        y: cy + ascent_px - glyph.y_offset,
+                        is_color: glyph.is_color,
+                    });
+                }
             }
-            None => continue,
-        };
 
-        // Step 4: Rasterize/cache and draw
-        let cache_idx = mgr.find_cached(render_font_id, gid, size, subpixel);
-        let idx = if let Some(i) = cache_idx {
-            i
-        } else {
-            match mgr.rasterize_and_cache(render_font_id, gid, size, subpixel) {
-                Some(i) => i,
-                None => {
-                    cx += advance_px as i32;
-                    continue;
+            cx += advance_px as i32;
+        }
+        run
+    }
+
+    /// Cache index of a glyph, rasterizing it on a miss.
+    fn glyph_index(&mut self, font_id: u16, glyph_id: u16, size: u16, subpixel: bool) -> Option<usize> {
+        match self.find_cached(font_id, glyph_id, size, subpixel) {
+            Some(i) => Some(i),
+            None => self.rasterize_and_cache(font_id, glyph_id, size, subpixel),
+        }
+    }
+
+    /// Composite the coverage of the run's non-color glyphs, or `None` when
+    /// the run has none, is too large, or smoothing is off (mode 0 writes
+    /// pixels instead of blending).
+    fn composite_run(&mut self, run: &TextRun) -> Option<RunMask> {
+        if run.smoothing == 0 {
+            return None;
+        }
+        let subpixel = run.smoothing == 2;
+        let bpp = if subpixel { 3 } else { 1 };
+
+        // Bounding box of the glyph bitmaps, in pixels.
+        let (mut x0, mut y0, mut x1, mut y1) = (i32::MAX, i32::MAX, i32::MIN, i32::MIN);
+        for g in run.glyphs.iter().filter(|g| !g.is_color) {
+            let idx = self.glyph_index(g.font_id, g.glyph_id, run.size, subpixel)?;
+            let glyph = &self.cache[idx];
+            let w = if glyph.subpixel { glyph.width / 3 } else { glyph.width };
+            x0 = x0.min(g.x);
+            y0 = y0.min(g.y);
+            x1 = x1.max(g.x + w as i32);
+            y1 = y1.max(g.y + glyph.height as i32);
+        }
+        if x0 >= x1 || y0 >= y1 {
+            return None;
+        }
+        let (width, height) = ((x1 - x0) as u32, (y1 - y0) as u32);
+        let len = width as usize * height as usize * bpp;
+        if len > MAX_RUN_MASK || self.run_mask_bytes + len > RUN_MASK_BUDGET {
+            return None;
+        }
+
+        let mut alpha = vec![0u8; len];
+        let lut = gamma_lut_for_size(run.size);
+        for g in run.glyphs.iter().filter(|g| !g.is_color) {
+            let idx = self.glyph_index(g.font_id, g.glyph_id, run.size, subpixel)?;
+            let glyph = &self.cache[idx];
+            let stride = glyph.width as usize;
+            let pixel_w = if glyph.subpixel { stride / 3 } else { stride };
+            if glyph.subpixel != subpixel {
+                return None;
+            }
+            for row in 0..glyph.height as usize {
+                let cov_row = match glyph.coverage.get(row * stride..(row + 1) * stride) {
+                    Some(r) => r,
+                    None => continue,
+                };
+                let dst_row = ((g.y - y0) as usize + row) * width as usize;
+                for col in 0..pixel_w {
+                    let di = (dst_row + (g.x - x0) as usize + col) * bpp;
+                    if subpixel {
+                        if let Some((r, gr, b)) = subpixel_coverage(cov_row, col * 3, lut) {
+                            // Overlapping glyphs combine like two blends.
+                            alpha[di] = coverage_union(alpha[di], r);
+                            alpha[di + 1] = coverage_union(alpha[di + 1], gr);
+                            alpha[di + 2] = coverage_union(alpha[di + 2], b);
+                        }
+                    } else {
+                        let raw = cov_row[col];
+                        if raw != 0 {
+                            let c = if let Some(tbl) = lut { tbl[raw as usize] } else { raw };
+                            alpha[di] = coverage_union(alpha[di], c);
+                        }
+                    }
                 }
             }
-        };
+        }
+        Some(RunMask { x: x0, y: y0, width, height, subpixel, alpha })
+    }
 
-        let glyph = &mgr.cache[idx];
-        if glyph.width > 0 && glyph.height > 0 {
+    /// Draw a laid-out run with its origin at (x, y).
+    fn draw_run(
+        &mut self, run: &TextRun, buf: *mut u32, buf_w: u32, buf_h: u32,
+        x: i32, y: i32, color: u32, clip: Clip,
+    ) {
+        let col_a = ((color >> 24) & 0xFF) as u32;
+        let col_r = ((color >> 16) & 0xFF) as u8;
+        let col_g = ((color >> 8) & 0xFF) as u8;
+        let col_b = (color & 0xFF) as u8;
+        let subpixel = run.smoothing == 2;
+
+        if let Some(ref mask) = run.mask {
+            draw_run_mask(buf, buf_w, x + mask.x, y + mask.y, mask, col_a, col_r, col_g, col_b, clip);
+        }
+
+        for g in &run.glyphs {
+            if run.mask.is_some() && !g.is_color {
+                continue;
+            }
+            let idx = match self.glyph_index(g.font_id, g.glyph_id, run.size, subpixel) {
+                Some(i) => i,
+                None => continue,
+            };
+            let glyph = &self.cache[idx];
+            let (gx, gy) = (x + g.x, y + g.y);
             if glyph.is_color {
                 // Color bitmap glyph (emoji)
-                let gx = cx + glyph.x_offset;
-                let gy = cy + ascent_px as i32 - glyph.y_offset;
                 draw_glyph_color_buf(buf, buf_w, buf_h, gx, gy, glyph,
-                    clip_x, clip_y, clip_r, clip_b);
+                    clip.x, clip.y, clip.r, clip.b);
+            } else if subpixel && glyph.subpixel {
+                draw_glyph_subpixel_buf(buf, buf_w, buf_h, gx, gy, glyph, col_a, col_r, col_g, col_b,
+                    clip.x, clip.y, clip.r, clip.b);
             } else {
-                let gx = cx + if glyph.subpixel { glyph.x_offset / 3 } else { glyph.x_offset };
-                let gy = cy + ascent_px as i32 - glyph.y_offset;
-
-                if subpixel && glyph.subpixel {
-                    draw_glyph_subpixel_buf(buf, buf_w, buf_h, gx, gy, glyph, col_a, col_r, col_g, col_b,
-                        clip_x, clip_y, clip_r, clip_b);
-                } else {
-                    draw_glyph_greyscale_buf(buf, buf_w, buf_h, gx, gy, glyph, col_a, col_r, col_g, col_b,
-                        clip_x, clip_y, clip_r, clip_b, smoothing);
-                }
+                draw_glyph_greyscale_buf(buf, buf_w, buf_h, gx, gy, glyph, col_a, col_r, col_g, col_b,
+                    clip.x, clip.y, clip.r, clip.b, run.smoothing);
             }
         }
-
-        cx += advance_px as i32;
     }
 }
 
 // ─── Internal rendering ──────────────────────────────────────────────────
 
+/// Coverage of two layers of the same color, as if blended one after the other.
+#[inline(always)]
+fn coverage_union(a: u8, b: u8) -> u8 {
+    (a as u32 + b as u32 - div255(a as u32 * b as u32)) as u8
+}
+
+/// Blend a composited run bitmap.  The clip rect is applied per row and
+/// column range up front, so the inner loops carry no bounds checks.
+fn draw_run_mask(
+    buf: *mut u32, sw: u32,
+    x: i32, y: i32, mask: &RunMask,
+    col_a: u32, col_r: u8, col_g: u8, col_b: u8,
+    clip: Clip,
+) {
+    let c0 = (clip.x - x).max(0);
+    let c1 = (clip.r - x).min(mask.width as i32);
+    let r0 = (clip.y - y).max(0);
+    let r1 = (clip.b - y).min(mask.height as i32);
+    if c0 >= c1 || r0 >= r1 {
+        return;
+    }
+    let bpp = if mask.subpixel { 3 } else { 1 };
+    let mw = mask.width as usize;
+    for row in r0 as usize..r1 as usize {
+        let src = &mask.alpha[(row * mw + c0 as usize) * bpp..(row * mw + c1 as usize) * bpp];
+        let dst_start = (y as usize + row) * sw as usize + (x + c0) as usize;
+        // SAFETY: the clip rect lies within the `sw`-wide buffer.
+        let dst = unsafe { core::slice::from_raw_parts_mut(buf.add(dst_start), (c1 - c0) as usize) };
+        if mask.subpixel {
+            for (d, px) in dst.iter_mut().zip(src.chunks_exact(3)) {
+                if px[0] | px[1] | px[2] != 0 {
+                    *d = subpixel_blend(*d, px[0], px[1], px[2], col_r, col_g, col_b);
+                }
+            }
+        } else {
+            for (d, &cov) in dst.iter_mut().zip(src) {
+                let alpha = div255(cov as u32 * col_a);
+                if alpha != 0 {
+                    *d = alpha_blend_pixel(*d, alpha, col_r, col_g, col_b);
+                }
+            }
+        }
+    }
+}
+
 fn draw_glyph_greyscale_buf(
     buf: *mut u32, sw: u32, sh: u32,
     x: i32, y: i32, glyph: &CachedGlyph,
@@ -792,9 +1152,6 @@ fn draw_glyph_subpixel_buf(
     let buf_len = sh as usize * sw as usize;
     let lut = gamma_lut_for_size(glyph.size);
 
-    // Fixed-point reciprocal for / 10: (1 << 16) / 10 = 6553.6 → 6554
-    const RECIP10: u32 = 6554;
-
     for row in 0..bh {
         let py = y + row;
         if py < clip_y || py >= clip_b { continue; }
@@ -805,30 +1162,9 @@ fn draw_glyph_subpixel_buf(
         for col in 0..pixel_w {
             let px = x + col;
             if px < clip_x || px >= clip_r { continue; }
-            let ci = col as usize * 3;
-            let r_raw = cov_row[ci] as u32;
-            let g_raw = cov_row[ci + 1] as u32;
-            let b_raw = cov_row[ci + 2] as u32;
-            if r_raw == 0 && g_raw == 0 && b_raw == 0 { continue; }
-
-            // 5-tap FIR filter with fixed-point division (replaces / 10)
-            let get = |i: usize| -> u32 {
-                if i < stride { cov_row[i] as u32 } else { 0 }
-            };
-            let ci_i = ci as isize;
-            let getl = |i: isize| -> u32 {
-                if i >= 0 && (i as usize) < stride { cov_row[i as usize] as u32 } else { 0 }
-            };
-            let r_sum = getl(ci_i - 2) + getl(ci_i - 1) * 2 + r_raw * 4 + g_raw * 2 + b_raw + 5;
-            let g_sum = getl(ci_i - 1) + r_raw * 2 + g_raw * 4 + b_raw * 2 + get(ci + 3) + 5;
-            let b_sum = r_raw + g_raw * 2 + b_raw * 4 + get(ci + 3) * 2 + get(ci + 4) + 5;
-            let r_val = ((r_sum * RECIP10) >> 16).min(255) as u8;
-            let g_val = ((g_sum * RECIP10) >> 16).min(255) as u8;
-            let b_val = ((b_sum * RECIP10) >> 16).min(255) as u8;
-            let (r_filt, g_filt, b_filt) = if let Some(tbl) = lut {
-                (tbl[r_val as usize], tbl[g_val as usize], tbl[b_val as usize])
-            } else {
-                (r_val, g_val, b_val)
+            let (r_filt, g_filt, b_filt) = match subpixel_coverage(cov_row, col as usize * 3, lut) {
+                Some(c) => c,
+                None => continue,
             };
 
             let idx = (py as u32 * sw + px as u32) as usize;
@@ -840,6 +1176,40 @@ fn draw_glyph_subpixel_buf(
     }
 }
 
+/// Filtered, gamma-corrected LCD coverage of the pixel whose subpixels
+/// start at `ci` in a glyph row, or `None` when the pixel itself is empty.
+#[inline(always)]
+fn subpixel_coverage(cov_row: &[u8], ci: usize, lut: Option<&[u8; 256]>) -> Option<(u8, u8, u8)> {
+    // Fixed-point reciprocal for / 10: (1 << 16) / 10 = 6553.6 → 6554
+    const RECIP10: u32 = 6554;
+
+    let stride = cov_row.len();
+    let r_raw = cov_row[ci] as u32;
+    let g_raw = cov_row[ci + 1] as u32;
+    let b_raw = cov_row[ci + 2] as u32;
+    if r_raw == 0 && g_raw == 0 && b_raw == 0 { return None; }
+
+    // 5-tap FIR filter with fixed-point division (replaces / 10)
+    let get = |i: usize| -> u32 {
+        if i < stride { cov_row[i] as u32 } else { 0 }
+    };
+    let ci_i = ci as isize;
+    let getl = |i: isize| -> u32 {
+        if i >= 0 && (i as usize) < stride { cov_row[i as usize] as u32 } else { 0 }
+    };
+    let r_sum = getl(ci_i - 2) + getl(ci_i - 1) * 2 + r_raw * 4 + g_raw * 2 + b_raw + 5;
+    let g_sum = getl(ci_i - 1) + r_raw * 2 + g_raw * 4 + b_raw * 2 + get(ci + 3) + 5;
+    let b_sum = r_raw + g_raw * 2 + b_raw * 4 + get(ci + 3) * 2 + get(ci + 4) + 5;
+    let r_val = ((r_sum * RECIP10) >> 16).min(255) as u8;
+    let g_val = ((g_sum * RECIP10) >> 16).min(255) as u8;
+    let b_val = ((b_sum * RECIP10) >> 16).min(255) as u8;
+    Some(if let Some(tbl) = lut {
+        (tbl[r_val as usize], tbl[g_val as usize], tbl[b_val as usize])
+    } else {
+        (r_val, g_val, b_val)
+    })
+}
+
 /// Draw a color (RGBA) bitmap glyph — used for emoji.
 fn draw_glyph_color_buf(
     buf: *mut u32, sw: u32, sh: u32,
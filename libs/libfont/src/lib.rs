@@ -23,9 +23,10 @@ libheap::dll_allocator!(crate::syscall::sbrk, crate::syscall::mmap, crate::sysca
 pub(crate) mod syscall;
 pub(crate) mod ttf;
 mod ttf_rasterizer;
-pub(crate) mod inflate;
+mod area_raster;
 pub(crate) mod png_decode;
 pub(crate) mod font_manager;
+mod shared_cache;
 
 // ── Embedded system fonts (.rodata — shared across all processes) ────
 
@@ -6,7 +6,6 @@
 
 use alloc::vec;
 use alloc::vec::Vec;
-use super::inflate;
 
 fn read_u32_be(data: &[u8], off: usize) -> u32 {
     (data[off] as u32) << 24 | (data[off + 1] as u32) << 16
@@ -83,8 +82,6 @@ pub fn decode_png(data: &[u8]) -> Option<PngImage> {
     if width == 0 || height == 0 || idat_data.is_empty() { return None; }
     if color_type == 3 && palette_len == 0 { return None; }
 
-    let raw = inflate::zlib_decompress(&idat_data)?;
-
     let bpp: usize = match color_type {
         6 => 4, // RGBA
         2 => 3, // RGB
@@ -94,6 +91,8 @@ pub fn decode_png(data: &[u8]) -> Option<PngImage> {
     let row_bytes = width as usize * bpp;
     let stride = row_bytes + 1; // +1 for filter byte
 
+    let raw = libinflate::zlib_decompress(&idat_data, height as usize * stride)?;
+
     if raw.len() < height as usize * stride { return None; }
 
     let mut pixels = vec![0u8; width as usize * height as usize * 4];
@@ -0,0 +1,251 @@
+//! System-wide glyph cache in shared memory.
+//!
+//! The compositor creates one shared memory region at startup and publishes
+//! its ID in the uisys export page (`UISYS_GLYPH_CACHE_ADDR`).  Every process
+//! using libfont maps it on init.  Glyphs of the embedded system fonts are
+//! rasterized by whichever process misses first and stored here; all other
+//! processes draw straight from the shared bitmap instead of keeping their
+//! own copy.
+//!
+//! The region is append-only: slots and bitmaps are never freed or moved, so
+//! readers need no lock and may keep `&'static` references to the data.  When
+//! the table or the data area is full, further glyphs stay per-process.
+//!
+//! Layout (zero-filled by the kernel on creation):
+//!
+//! ```text
+//!   0x0000  Header
+//!   0x0040  [Slot; SLOT_COUNT]   open addressing, linear probing
+//!   DATA    glyph bitmaps, 4-byte aligned, bump-allocated
+//! ```
+//!
+//! A slot is published by storing its key last (release); a reader that
+//! sees the key (acquire) sees the rest of the slot and the bitmap.  Writers
+//! serialize on a spin lock in the header holding the owner's uptime, so a
+//! lock left behind by a killed process is taken over after a second.
+
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+
+use crate::syscall;
+
+/// Address of the glyph cache SHM ID in the uisys.dlib export struct
+/// (written by the compositor, 0 = no shared cache).
+const UISYS_GLYPH_CACHE_ADDR: *const u32 = 0x0400_0018 as *const u32;
+
+/// Region size.  Must match `GLYPH_CACHE_SIZE` in the compositor.
+const REGION_SIZE: usize = 4 * 1024 * 1024;
+
+/// Number of slots (power of 2).
+const SLOT_COUNT: usize = 8192;
+
+/// Probes before a lookup gives up.
+const MAX_PROBE: usize = 32;
+
+const HEADER_SIZE: usize = 0x40;
+const DATA_START: usize = HEADER_SIZE + SLOT_COUNT * core::mem::size_of::<Slot>();
+
+/// Lock attempts before an insert is skipped.
+const LOCK_SPINS: u32 = 64;
+
+/// A lock held longer than this belongs to a dead process.
+const STALE_LOCK_MS: u32 = 1000;
+
+const FLAG_COLOR: u32 = 1;
+
+#[repr(C)]
+struct Header {
+    /// Spin lock: 0 = free, otherwise the holder's `uptime_ms() | 1`.
+    lock: AtomicU32,
+    /// End of the used data area (offset from the region start, 0 = `DATA_START`).
+    data_end: AtomicU32,
+    /// Number of published slots.
+    count: AtomicU32,
+}
+
+#[repr(C)]
+struct Slot {
+    /// Packed glyph key, 0 = empty.  Written last.
+    key: AtomicU64,
+    offset: u32,
+    len: u32,
+    width: u32,
+    height: u32,
+    x_offset: i32,
+    y_offset: i32,
+    advance: u32,
+    flags: u32,
+}
+
+/// A glyph read from the shared cache.
+pub(crate) struct SharedGlyph {
+    pub is_color: bool,
+    pub width: u32,
+    pub height: u32,
+    pub x_offset: i32,
+    pub y_offset: i32,
+    pub advance: u32,
+    pub data: &'static [u8],
+}
+
+/// Base address of the mapped region in this process, 0 = none.
+static mut REGION: usize = 0;
+
+/// Map the shared cache published by the compositor, if any.
+pub(crate) fn init() {
+    let shm_id = unsafe { core::ptr::read_volatile(UISYS_GLYPH_CACHE_ADDR) };
+    if shm_id == 0 {
+        return;
+    }
+    let addr = syscall::shm_map(shm_id);
+    unsafe { REGION = addr as usize; }
+}
+
+fn region() -> Option<usize> {
+    let base = unsafe { REGION };
+    if base == 0 { None } else { Some(base) }
+}
+
+fn header(base: usize) -> &'static Header {
+    unsafe { &*(base as *const Header) }
+}
+
+fn slot(base: usize, i: usize) -> *mut Slot {
+    (base + HEADER_SIZE + i * core::mem::size_of::<Slot>()) as *mut Slot
+}
+
+/// Pack a glyph key; never 0.
+fn pack_key(font_id: u16, glyph_id: u16, size: u16, subpixel: bool) -> u64 {
+    1u64 << 63
+        | (font_id as u64) << 40
+        | (glyph_id as u64) << 24
+        | (size as u64) << 8
+        | subpixel as u64
+}
+
+fn first_slot(key: u64) -> usize {
+    let h = (key ^ (key >> 29)).wrapping_mul(0x9E37_79B9_7F4A_7C15);
+    (h >> 32) as usize & (SLOT_COUNT - 1)
+}
+
+/// Bitmap size a slot's dimensions imply.
+fn expected_len(width: u32, height: u32, is_color: bool) -> Option<usize> {
+    let px = (width as usize).checked_mul(height as usize)?;
+    if is_color { px.checked_mul(4) } else { Some(px) }
+}
+
+/// Read a published slot.  Slots are written by other processes, so every
+/// field is validated before a bitmap reference is handed out.
+fn read_slot(base: usize, s: &Slot) -> Option<SharedGlyph> {
+    let is_color = s.flags & FLAG_COLOR != 0;
+    let (offset, len) = (s.offset as usize, s.len as usize);
+    if offset < DATA_START || offset + len > REGION_SIZE
+        || expected_len(s.width, s.height, is_color) != Some(len)
+    {
+        return None;
+    }
+    Some(SharedGlyph {
+        is_color,
+        width: s.width,
+        height: s.height,
+        x_offset: s.x_offset,
+        y_offset: s.y_offset,
+        advance: s.advance,
+        data: unsafe { core::slice::from_raw_parts((base + offset) as *const u8, len) },
+    })
+}
+
+/// Find the slot holding `key`: `Ok(index)` if present, `Err(first empty
+/// slot)` if not, `Err(None)` when the probe sequence is full.
+fn probe(base: usize, key: u64) -> Result<usize, Option<usize>> {
+    let start = first_slot(key);
+    for p in 0..MAX_PROBE {
+        let i = (start + p) & (SLOT_COUNT - 1);
+        let k = unsafe { (*slot(base, i)).key.load(Ordering::Acquire) };
+        if k == key {
+            return Ok(i);
+        }
+        if k == 0 {
+            return Err(Some(i));
+        }
+    }
+    Err(None)
+}
+
+/// Look up a glyph.
+pub(crate) fn lookup(font_id: u16, glyph_id: u16, size: u16, subpixel: bool) -> Option<SharedGlyph> {
+    let base = region()?;
+    let key = pack_key(font_id, glyph_id, size, subpixel);
+    let i = probe(base, key).ok()?;
+    read_slot(base, unsafe { &*slot(base, i) })
+}
+
+/// Store a freshly rasterized glyph.  Returns the shared copy of `data`, or
+/// `None` if the cache is unavailable or full (the caller keeps its own).
+pub(crate) fn insert(
+    font_id: u16, glyph_id: u16, size: u16, subpixel: bool,
+    is_color: bool, width: u32, height: u32, x_offset: i32, y_offset: i32, advance: u32,
+    data: &[u8],
+) -> Option<&'static [u8]> {
+    let base = region()?;
+    if expected_len(width, height, is_color) != Some(data.len()) {
+        return None;
+    }
+    let key = pack_key(font_id, glyph_id, size, subpixel);
+    let hdr = header(base);
+    if !lock(hdr) {
+        return None;
+    }
+
+    let result = match probe(base, key) {
+        // Another process got there first.
+        Ok(i) => read_slot(base, unsafe { &*slot(base, i) }).map(|g| g.data),
+        Err(None) => None,
+        Err(Some(i)) => {
+            let end = match hdr.data_end.load(Ordering::Relaxed) as usize {
+                0 => DATA_START,
+                e => e,
+            };
+            let offset = (end + 3) & !3;
+            if offset < DATA_START || offset + data.len() > REGION_SIZE {
+                None
+            } else {
+                unsafe {
+                    let dst = (base + offset) as *mut u8;
+                    core::ptr::copy_nonoverlapping(data.as_ptr(), dst, data.len());
+                    let s = slot(base, i);
+                    (*s).offset = offset as u32;
+                    (*s).len = data.len() as u32;
+                    (*s).width = width;
+                    (*s).height = height;
+                    (*s).x_offset = x_offset;
+                    (*s).y_offset = y_offset;
+                    (*s).advance = advance;
+                    (*s).flags = if is_color { FLAG_COLOR } else { 0 };
+                    (*s).key.store(key, Ordering::Release);
+                    hdr.data_end.store((offset + data.len()) as u32, Ordering::Relaxed);
+                    hdr.count.fetch_add(1, Ordering::Relaxed);
+                    Some(core::slice::from_raw_parts(dst, data.len()))
+                }
+            }
+        }
+    };
+
+    hdr.lock.store(0, Ordering::Release);
+    result
+}
+
+/// Take the writer lock, giving up after `LOCK_SPINS` attempts.
+fn lock(hdr: &Header) -> bool {
+    for _ in 0..LOCK_SPINS {
+        let now = syscall::uptime_ms() | 1;
+        let cur = hdr.lock.load(Ordering::Relaxed);
+        let stale = cur != 0 && now.wrapping_sub(cur) > STALE_LOCK_MS;
+        if (cur == 0 || stale)
+            && hdr.lock.compare_exchange(cur, now, Ordering::Acquire, Ordering::Relaxed).is_ok()
+        {
+            return true;
+        }
+        syscall::yield_cpu();
+    }
+    false
+}
@@ -1,6 +1,6 @@
 //! Syscall wrappers for libfont.dlib — delegates to libsyscall.
 
-pub use libsyscall::{sbrk, mmap, munmap, exit, close};
+pub use libsyscall::{sbrk, mmap, munmap, exit, close, shm_map, uptime_ms, yield_cpu};
 
 /// Query whether GPU acceleration is available.
 pub fn gpu_has_accel() -> u32 {
@@ -4,10 +4,14 @@
 //! compatibility.  The rasterizer walks each contour, flattens quadratic Bezier
 //! curves into line segments, and then computes per-pixel signed area coverage
 //! with a scanline accumulator.
+//!
+//! Sizes from `AREA_MIN_SIZE` up go through `area_raster`, whose exact area
+//! coverage and adaptive curve flattening scale better with glyph size.
 
 use alloc::vec;
 use alloc::vec::Vec;
 use super::ttf::{GlyphOutline, GlyphPoint};
+use super::area_raster;
 
 /// Rasterized glyph as a row-major 8-bit coverage bitmap.
 pub struct GlyphBitmap {
@@ -32,6 +36,11 @@ fn fp_floor(v: i32) -> i32 { v >> FP_SHIFT }
 #[inline(always)]
 fn fp_ceil(v: i32) -> i32 { (v + FP_ONE - 1) >> FP_SHIFT }
 
+/// Smallest pixel size rasterized by `area_raster`.  Below it output stays
+/// bit-identical to the fixed-point path, which the gamma LUTs (applied up
+/// to 24 px) were tuned against.
+pub const AREA_MIN_SIZE: u32 = 25;
+
 #[derive(Clone)]
 struct Edge { x0: i32, y0: i32, x1: i32, y1: i32, winding: i32 }
 
@@ -62,6 +71,13 @@ fn rasterize_impl(outline: &GlyphOutline, size_px: u32, units_per_em: u16, h_sca
     let width = (px_x_max - px_x_min) as u32;
     let height = (px_y_max - px_y_min) as u32;
     if width == 0 || height == 0 || width > 4096 || height > 4096 { return None; }
+    if size_px >= AREA_MIN_SIZE {
+        let scale = size_px as f32 / units_per_em as f32;
+        let coverage = area_raster::rasterize(
+            outline, scale * h_scale as f32, scale, px_x_min, px_y_max, width, height,
+        );
+        return Some(GlyphBitmap { width, height, x_offset: px_x_min, y_offset: px_y_max, advance: 0, coverage });
+    }
     let mut edges: Vec<Edge> = Vec::new();
     let mut contour_start: usize = 0;
     for &end_idx in &outline.contour_ends {
@@ -488,6 +488,12 @@ fn emit_inst(ctx: &mut CompileCtx, inst: &Inst, program: &ir::Program, is_vertex
             ctx.emit_1dst_1src(D3DSIO_FRC, *dst, st, sn);
         }
 
+        Inst::DFdx(dst, src) | Inst::DFdy(dst, src) => {
+            // SM 2.0 has no dsx/dsy: x - x = 0, like the per-pixel backends
+            let (st, sn) = ir_src(*src, const_map);
+            ctx.emit_2src(D3DSIO_SUB, *dst, st, sn, st, sn);
+        }
+
         Inst::Pow(dst, base, exp) => {
             let (bt, bn) = ir_src(*base, const_map);
             let (et, en) = ir_src(*exp, const_map);
@@ -25,12 +25,19 @@
 //! Shader virtual registers (up to 128) live in memory at `[RBX + reg * 16]`.
 //! Each instruction does load → operate → store, emitting straight-line SSE
 //! instructions with zero branching overhead.
+//!
+//! [`quad`] compiles the same IR for four invocations per call (2×2 pixel
+//! quads, or batches of vertices) with an SoA register file.  [`a64`] is
+//! the AArch64 (NEON) counterpart of the scalar backend.
 
 extern crate alloc;
 use alloc::vec::Vec;
 use super::ir::{Program, Inst};
 use crate::compiler::backend_sw::TexSampleFn;
 
+pub mod quad;
+pub mod a64;
+
 /// JIT-compiled shader code buffer.
 ///
 /// Holds the machine code in an executable heap buffer. The code is valid for
@@ -38,6 +45,8 @@ use crate::compiler::backend_sw::TexSampleFn;
 pub struct JitCode {
     /// Machine code buffer (heap-allocated, executable on anyOS).
     code: Vec<u8>,
+    /// Offsets of the absolute 64-bit helper addresses embedded in `code`.
+    relocs: Vec<u32>,
 }
 
 /// Context struct passed to JIT-compiled shader functions.
@@ -64,6 +73,8 @@ pub struct JitContext {
     pub point_size: *mut f32,
     /// Texture sampler function pointer (as usize for C ABI).
     pub tex_sample: usize,
+    /// Lanes that are really shaded (bit per lane); read by the [`quad`] JIT only.
+    pub coverage: u32,
 }
 
 /// Type of the JIT-compiled function.
@@ -81,6 +92,91 @@ impl JitCode {
     pub fn code_len(&self) -> usize {
         self.code.len()
     }
+
+    /// Serialize the code for the program cache, with every embedded helper
+    /// address replaced by its index in [`helper_table`].  Returns `false`
+    /// (nothing appended) if an address is not a known helper.
+    pub fn to_bytes(&self, out: &mut Vec<u8>) -> bool {
+        let table = helper_table();
+        let mut code = self.code.clone();
+        for &off in &self.relocs {
+            let addr = read_reloc(&code, off as usize);
+            match table.iter().position(|&h| h as u64 == addr) {
+                Some(id) => write_reloc(&mut code, off as usize, id as u64),
+                None => return false,
+            }
+        }
+        out.extend_from_slice(&(code.len() as u32).to_le_bytes());
+        out.extend_from_slice(&(self.relocs.len() as u32).to_le_bytes());
+        for &off in &self.relocs {
+            out.extend_from_slice(&off.to_le_bytes());
+        }
+        out.extend_from_slice(&code);
+        true
+    }
+
+    /// Rebuild code serialized by [`to_bytes`](Self::to_bytes), relocating
+    /// the helper addresses to this process.  Returns the code and the bytes
+    /// consumed.
+    pub fn from_bytes(data: &[u8]) -> Option<(JitCode, usize)> {
+        let word = |at: usize| -> Option<u32> {
+            let b = data.get(at..at + 4)?;
+            Some(u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+        };
+        let code_len = word(0)? as usize;
+        let nrelocs = word(4)? as usize;
+        let code_at = 8 + nrelocs * 4;
+        let mut code = Vec::from(data.get(code_at..code_at + code_len)?);
+        let mut relocs = Vec::with_capacity(nrelocs);
+        let table = helper_table();
+        for i in 0..nrelocs {
+            let off = word(8 + i * 4)? as usize;
+            if off + RELOC_LEN > code.len() {
+                return None;
+            }
+            let addr = *table.get(read_reloc(&code, off) as usize)?;
+            write_reloc(&mut code, off, addr as u64);
+            relocs.push(off as u32);
+        }
+        a64::sync_icache(&code);
+        Some((JitCode { code, relocs }, code_at + code_len))
+    }
+}
+
+/// Bytes of code holding one relocated address.
+const RELOC_LEN: usize = if cfg!(target_arch = "aarch64") { 16 } else { 8 };
+
+/// Address at relocation `off`: an `imm64` on x86_64, a `MOVZ`/`MOVK`
+/// sequence on AArch64.
+fn read_reloc(code: &[u8], off: usize) -> u64 {
+    if cfg!(target_arch = "aarch64") {
+        return a64::read_helper(code, off);
+    }
+    let s = &code[off..off + 8];
+    u64::from_le_bytes([s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7]])
+}
+
+fn write_reloc(code: &mut [u8], off: usize, v: u64) {
+    if cfg!(target_arch = "aarch64") {
+        a64::write_helper(code, off, v);
+    } else {
+        code[off..off + 8].copy_from_slice(&v.to_le_bytes());
+    }
+}
+
+/// Helper functions JIT code may call, by relocation index.  Append only:
+/// the index is stored in the program cache.
+fn helper_table() -> [usize; 8] {
+    [
+        jit_tex_sample as usize,
+        jit_pow as usize,
+        jit_sin as usize,
+        jit_cos as usize,
+        quad::jit_tex_sample_quad as usize,
+        quad::jit_pow_quad as usize,
+        quad::jit_sin_quad as usize,
+        quad::jit_cos_quad as usize,
+    ]
 }
 
 // ── JitContext field offsets (repr(C), all pointers are 8 bytes) ──────────
@@ -94,17 +190,24 @@ const CTX_POSITION: i32 = 40;
 const CTX_FRAG_COLOR: i32 = 48;
 const CTX_POINT_SIZE: i32 = 56;
 const CTX_TEX_SAMPLE: i32 = 64;
+const CTX_COVERAGE: i32 = 72;
 
 // ── x86_64 instruction encoding helpers ──────────────────────────────────
 
 /// Emit bytes to the code buffer.
 struct Emitter {
     code: Vec<u8>,
+    /// See [`JitCode::relocs`].
+    relocs: Vec<u32>,
 }
 
 impl Emitter {
     fn new() -> Self {
-        Self { code: Vec::with_capacity(4096) }
+        Self { code: Vec::with_capacity(4096), relocs: Vec::new() }
+    }
+
+    fn finish(self) -> JitCode {
+        JitCode { code: self.code, relocs: self.relocs }
     }
 
     #[inline(always)]
@@ -182,11 +285,31 @@ impl Emitter {
         self.emit_i32(disp);
     }
 
-    /// `mov reg64, imm64` — load 64-bit immediate.
-    fn mov_r64_imm64(&mut self, dst: u8, imm: u64) {
+    /// `mov reg32, [base64 + disp32]` — load 32-bit value (zero-extends).
+    fn mov_r32_mem(&mut self, dst: u8, base: u8, disp: i32) {
+        if dst >= 8 || base >= 8 {
+            self.rex(false, dst >= 8, false, base >= 8);
+        }
+        self.emit(0x8B);
+        self.modrm_disp32(dst & 7, base & 7);
+        self.emit_i32(disp);
+    }
+
+    /// `lea reg64, [base64 + disp32]` — address of a memory operand.
+    fn lea_r64_mem(&mut self, dst: u8, base: u8, disp: i32) {
+        self.rex(true, dst >= 8, false, base >= 8);
+        self.emit(0x8D);
+        self.modrm_disp32(dst & 7, base & 7);
+        self.emit_i32(disp);
+    }
+
+    /// `mov reg64, imm64` with the address of a [`helper_table`] function,
+    /// recorded for relocation.
+    fn mov_r64_helper(&mut self, dst: u8, addr: usize) {
         self.rex(true, false, false, dst >= 8);
         self.emit(0xB8 + (dst & 7));
-        self.emit_u64(imm);
+        self.relocs.push(self.code.len() as u32);
+        self.emit_u64(addr as u64);
     }
 
     /// `mov dst64, src64` — register-to-register 64-bit move.
@@ -395,6 +518,15 @@ impl Emitter {
         self.modrm_reg(dst_xmm & 7, src_gpr & 7);
     }
 
+    /// `cvttps2dq xmm_dst, xmm_src` — packed float to int (truncate).
+    fn cvttps2dq(&mut self, dst: u8, src: u8) {
+        self.emit(0xF3);
+        self.sse_rr(0x5B, dst, src);
+    }
+
+    /// `cvtdq2ps xmm_dst, xmm_src` — packed int to float.
+    fn cvtdq2ps(&mut self, dst: u8, src: u8) { self.sse_rr(0x5B, dst, src); }
+
     /// SSE4.1 `roundps xmm_dst, xmm_src, imm8` (0x66 0F 3A 08).
     fn roundps(&mut self, dst: u8, src: u8, mode: u8) {
         self.emit(0x66);
@@ -566,14 +698,40 @@ extern "C" fn jit_tex_sample(
 
 // ── JIT compiler ─────────────────────────────────────────────────────────
 
-/// Compile a shader IR program to native x86_64 machine code.
+/// Compile a shader IR program to native machine code for this CPU
+/// (x86_64 here, AArch64 through [`a64`]).
 ///
 /// Returns `None` if the program cannot be JIT-compiled (e.g., uses
 /// unsupported instructions). Falls back to the interpreter in that case.
 pub fn compile_jit(program: &Program) -> Option<JitCode> {
+    if cfg!(target_arch = "aarch64") {
+        return a64::compile_jit_a64(program);
+    }
+    compile_jit_x86(program)
+}
+
+/// x86_64 build of [`compile_jit`].
+fn compile_jit_x86(program: &Program) -> Option<JitCode> {
     let mut e = Emitter::new();
 
-    // ── Prologue: save callee-saved registers ────────────────────────
+    emit_prologue(&mut e);
+
+    // ── Build constant register table (SSA IR: each reg written once) ──
+    let const_regs = const_table(program);
+
+    // ── Emit instructions ────────────────────────────────────────────
+    for inst in &program.instructions {
+        emit_instruction(&mut e, inst, &const_regs);
+    }
+
+    emit_epilogue(&mut e);
+
+    Some(e.finish())
+}
+
+/// Function prologue: save callee-saved registers, align the stack and
+/// load the `JitContext` pointers into their fixed registers.
+fn emit_prologue(e: &mut Emitter) {
     e.push_r64(RBP);
     e.push_r64(RBX);
     e.push_r64(R12);
@@ -595,23 +753,10 @@ pub fn compile_jit(program: &Program) -> Option<JitCode> {
     e.mov_r64_mem(R13, RBP, CTX_ATTRIBUTES);      // R13 = attributes
     e.mov_r64_mem(R14, RBP, CTX_VARYINGS_IN);     // R14 = varyings_in
     e.mov_r64_mem(R15, RBP, CTX_VARYINGS_OUT);    // R15 = varyings_out
+}
 
-    // ── Build constant register table (SSA IR: each reg written once) ──
-    let mut const_regs: [Option<[f32; 4]>; 128] = [None; 128];
-    for inst in &program.instructions {
-        if let Inst::LoadConst(dst, val) = inst {
-            if (*dst as usize) < 128 {
-                const_regs[*dst as usize] = Some(*val);
-            }
-        }
-    }
-
-    // ── Emit instructions ────────────────────────────────────────────
-    for inst in &program.instructions {
-        emit_instruction(&mut e, inst, &const_regs);
-    }
-
-    // ── Epilogue: restore and return ─────────────────────────────────
+/// Function epilogue: undo [`emit_prologue`] and return.
+fn emit_epilogue(e: &mut Emitter) {
     e.add_rsp_imm8(8);
     e.pop_r64(R15);
     e.pop_r64(R14);
@@ -620,8 +765,20 @@ pub fn compile_jit(program: &Program) -> Option<JitCode> {
     e.pop_r64(RBX);
     e.pop_r64(RBP);
     e.ret();
+}
 
-    Some(JitCode { code: e.code })
+/// Constant propagation table: registers written by `LoadConst` (SSA IR:
+/// each register is written once).
+fn const_table(program: &Program) -> [Option<[f32; 4]>; 128] {
+    let mut const_regs: [Option<[f32; 4]>; 128] = [None; 128];
+    for inst in &program.instructions {
+        if let Inst::LoadConst(dst, val) = inst {
+            if (*dst as usize) < 128 {
+                const_regs[*dst as usize] = Some(*val);
+            }
+        }
+    }
+    const_regs
 }
 
 /// Emit native x86_64 code for a single IR instruction.
@@ -850,6 +1007,12 @@ fn emit_instruction(e: &mut Emitter, inst: &Inst, const_regs: &[Option<[f32; 4]>
             e.movups_store(RBX, reg_off(*dst), XMM0);
         }
 
+        // Single-fragment execution has no neighbours to difference.
+        Inst::DFdx(dst, _) | Inst::DFdy(dst, _) => {
+            e.xorps(XMM0, XMM0);
+            e.movups_store(RBX, reg_off(*dst), XMM0);
+        }
+
         // ── Texture sampling ─────────────────────────────────────────
         Inst::TexSample(dst, sampler, coord) => {
             emit_tex_sample(e, *dst, *sampler, *coord);
@@ -1169,7 +1332,7 @@ fn emit_per_component_unop(e: &mut Emitter, dst: u32, src: u32, func: usize) {
         // Load component into xmm0 (first float arg)
         e.movss_load(XMM0, RBX, reg_off(src) + comp as i32 * 4);
         // Call helper: float result in xmm0
-        e.mov_r64_imm64(RAX, func as u64);
+        e.mov_r64_helper(RAX, func);
         e.call_r64(RAX);
         // Store result component to stack
         e.movss_store(RSP, comp as i32 * 4, XMM0);
@@ -1189,7 +1352,7 @@ fn emit_per_component_binop(e: &mut Emitter, dst: u32, a: u32, b: u32, func: usi
         // xmm0 = a[comp], xmm1 = b[comp]
         e.movss_load(XMM0, RBX, reg_off(a) + comp as i32 * 4);
         e.movss_load(XMM1, RBX, reg_off(b) + comp as i32 * 4);
-        e.mov_r64_imm64(RAX, func as u64);
+        e.mov_r64_helper(RAX, func);
         e.call_r64(RAX);
         e.movss_store(RSP, comp as i32 * 4, XMM0);
     }
@@ -1238,7 +1401,7 @@ fn emit_tex_sample(e: &mut Emitter, dst: u32, sampler: u32, coord: u32) {
     e.mov_r64_r64(RDX, RSP);
 
     // Call jit_tex_sample
-    e.mov_r64_imm64(RAX, jit_tex_sample as usize as u64);
+    e.mov_r64_helper(RAX, jit_tex_sample as usize);
     e.call_r64(RAX);
 
     // Result is at [RSP], load it
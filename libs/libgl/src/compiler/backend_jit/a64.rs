@@ -0,0 +1,732 @@
+//! AArch64 (NEON) JIT backend for shader IR.
+//!
+//! Same entry point and [`JitContext`] ABI as the x86_64 backend: the
+//! generated function takes the context pointer in `X0` (AAPCS64).  Each
+//! IR register is a `[f32; 4]` at `[X19 + reg * 16]` and every instruction
+//! loads its operands into NEON registers, operates on all four lanes and
+//! stores the result back, mirroring the SSE code lane for lane.
+//!
+//! Register allocation in JIT code:
+//! - X19 = shader register file base (`ctx.regs`)
+//! - X20 = uniforms pointer, X21 = attributes pointer
+//! - X22 = varyings input pointer, X23 = varyings output pointer
+//! - X24 = saved ctx pointer
+//! - V0–V7, V16–V31 = scratch (V8–V15 are callee-saved and left alone)
+//! - X9, X16 = scratch (addresses, helper call targets)
+//!
+//! Constants are built with `MOVZ`/`MOVK` + `DUP`/`INS` instead of a literal
+//! pool, and helper addresses with a `MOVZ`/`MOVK` sequence recorded as a
+//! relocation, so the code has no alignment requirements.  The code buffer
+//! is cleaned to the point of unification before it is run (see
+//! [`sync_icache`]).
+
+use super::*;
+
+// ── Registers ────────────────────────────────────────────────────────────
+
+const X0: u32 = 0;
+const X1: u32 = 1;
+const X2: u32 = 2;
+const X9: u32 = 9;
+const X16: u32 = 16;
+const X19: u32 = 19;
+const X20: u32 = 20;
+const X21: u32 = 21;
+const X22: u32 = 22;
+const X23: u32 = 23;
+const X24: u32 = 24;
+const X29: u32 = 29;
+const X30: u32 = 30;
+/// `SP` in address/`ADD` operands, `XZR`/`WZR` in data operands.
+const SP: u32 = 31;
+const ZR: u32 = 31;
+
+const V0: u32 = 0;
+const V1: u32 = 1;
+const V2: u32 = 2;
+const V3: u32 = 3;
+const V4: u32 = 4;
+const V5: u32 = 5;
+
+/// Frame: X29/X30 + X19–X24 (64 bytes) + 16 bytes of scratch for helper
+/// results at `[SP + SCRATCH]`.
+const FRAME: i32 = 80;
+const SCRATCH: u32 = 64;
+
+// ── Encoder ──────────────────────────────────────────────────────────────
+
+struct A64 {
+    code: Vec<u8>,
+    relocs: Vec<u32>,
+}
+
+impl A64 {
+    fn new() -> Self {
+        A64 { code: Vec::with_capacity(4096), relocs: Vec::new() }
+    }
+
+    fn finish(self) -> JitCode {
+        let code = JitCode { code: self.code, relocs: self.relocs };
+        sync_icache(&code.code);
+        code
+    }
+
+    #[inline(always)]
+    fn emit(&mut self, word: u32) {
+        self.code.extend_from_slice(&word.to_le_bytes());
+    }
+
+    // ── General-purpose ──────────────────────────────────────────────
+
+    /// `stp xt, xt2, [sp, #-size]!`
+    fn stp_pre(&mut self, rt: u32, rt2: u32, size: i32) {
+        self.emit(0xA980_0000 | ((((-size) / 8) as u32 & 0x7F) << 15) | (rt2 << 10) | (SP << 5) | rt);
+    }
+
+    /// `ldp xt, xt2, [sp], #size`
+    fn ldp_post(&mut self, rt: u32, rt2: u32, size: i32) {
+        self.emit(0xA8C0_0000 | (((size / 8) as u32 & 0x7F) << 15) | (rt2 << 10) | (SP << 5) | rt);
+    }
+
+    /// `stp xt, xt2, [sp, #off]`
+    fn stp(&mut self, rt: u32, rt2: u32, off: i32) {
+        self.emit(0xA900_0000 | (((off / 8) as u32 & 0x7F) << 15) | (rt2 << 10) | (SP << 5) | rt);
+    }
+
+    /// `ldp xt, xt2, [sp, #off]`
+    fn ldp(&mut self, rt: u32, rt2: u32, off: i32) {
+        self.emit(0xA940_0000 | (((off / 8) as u32 & 0x7F) << 15) | (rt2 << 10) | (SP << 5) | rt);
+    }
+
+    /// `add xd, xn, #imm` (`xn`/`xd` may be SP).
+    fn add_imm(&mut self, rd: u32, rn: u32, imm: u32) {
+        self.emit(0x9100_0000 | ((imm & 0xFFF) << 10) | (rn << 5) | rd);
+    }
+
+    /// `add xd, xn, xm`
+    fn add_reg(&mut self, rd: u32, rn: u32, rm: u32) {
+        self.emit(0x8B00_0000 | (rm << 16) | (rn << 5) | rd);
+    }
+
+    /// `mov xd, xm`
+    fn mov_reg(&mut self, rd: u32, rm: u32) {
+        self.emit(0xAA00_03E0 | (rm << 16) | rd);
+    }
+
+    /// `ldr xt, [xn, #off]`
+    fn ldr_x(&mut self, rt: u32, rn: u32, off: u32) {
+        self.emit(0xF940_0000 | ((off / 8) << 10) | (rn << 5) | rt);
+    }
+
+    /// `movz`/`movk` sequence loading the 32-bit `v` into `wd`.
+    fn mov_w(&mut self, rd: u32, v: u32) {
+        self.emit(0x5280_0000 | ((v & 0xFFFF) << 5) | rd);
+        if v >> 16 != 0 {
+            self.emit(0x72A0_0000 | ((v >> 16) << 5) | rd);
+        }
+    }
+
+    /// `movz`/`movk` ×4 loading the 64-bit `v` into `xd` (fixed length, so
+    /// it can be patched by [`write_helper`]).
+    fn mov_x64(&mut self, rd: u32, v: u64) {
+        self.emit(0xD280_0000 | (((v & 0xFFFF) as u32) << 5) | rd);
+        for hw in 1..4u32 {
+            let part = ((v >> (hw * 16)) & 0xFFFF) as u32;
+            self.emit(0xF280_0000 | (hw << 21) | (part << 5) | rd);
+        }
+    }
+
+    /// Call a [`helper_table`] function (recorded for relocation).
+    fn call_helper(&mut self, addr: usize) {
+        self.relocs.push(self.code.len() as u32);
+        self.mov_x64(X16, addr as u64);
+        self.emit(0xD63F_0000 | (X16 << 5)); // blr x16
+    }
+
+    fn ret(&mut self) {
+        self.emit(0xD65F_03C0);
+    }
+
+    /// `fcvtzs wd, sn`
+    fn fcvtzs_w_s(&mut self, rd: u32, rn: u32) {
+        self.emit(0x1E38_0000 | (rn << 5) | rd);
+    }
+
+    // ── Loads and stores ─────────────────────────────────────────────
+
+    /// Base register and scaled offset for an access of `size` bytes at
+    /// `[base + off]`; large offsets go through X9.
+    fn addr(&mut self, base: u32, off: u32, size: u32) -> (u32, u32) {
+        if off % size == 0 && off / size < 4096 {
+            return (base, off / size);
+        }
+        self.mov_x64_short(X9, off);
+        self.add_reg(X9, base, X9);
+        (X9, 0)
+    }
+
+    /// `movz`/`movk` loading a 32-bit offset into `xd`.
+    fn mov_x64_short(&mut self, rd: u32, v: u32) {
+        self.emit(0xD280_0000 | ((v & 0xFFFF) << 5) | rd);
+        if v >> 16 != 0 {
+            self.emit(0xF2A0_0000 | ((v >> 16) << 5) | rd);
+        }
+    }
+
+    /// `ldr qt, [base, #off]`
+    fn ldr_q(&mut self, rt: u32, base: u32, off: u32) {
+        let (b, imm) = self.addr(base, off, 16);
+        self.emit(0x3DC0_0000 | (imm << 10) | (b << 5) | rt);
+    }
+
+    /// `str qt, [base, #off]`
+    fn str_q(&mut self, rt: u32, base: u32, off: u32) {
+        let (b, imm) = self.addr(base, off, 16);
+        self.emit(0x3D80_0000 | (imm << 10) | (b << 5) | rt);
+    }
+
+    /// `ldr st, [base, #off]`
+    fn ldr_s(&mut self, rt: u32, base: u32, off: u32) {
+        let (b, imm) = self.addr(base, off, 4);
+        self.emit(0xBD40_0000 | (imm << 10) | (b << 5) | rt);
+    }
+
+    /// `str st, [base, #off]`
+    fn str_s(&mut self, rt: u32, base: u32, off: u32) {
+        let (b, imm) = self.addr(base, off, 4);
+        self.emit(0xBD00_0000 | (imm << 10) | (b << 5) | rt);
+    }
+
+    /// Load IR register `r` into `vt`.
+    fn load(&mut self, vt: u32, r: u32) {
+        self.ldr_q(vt, X19, r * 16);
+    }
+
+    /// Store `vt` to IR register `r`.
+    fn store(&mut self, r: u32, vt: u32) {
+        self.str_q(vt, X19, r * 16);
+    }
+
+    // ── NEON (vector, 4 × f32) ───────────────────────────────────────
+
+    #[inline(always)]
+    fn v3(&mut self, op: u32, d: u32, n: u32, m: u32) {
+        self.emit(op | (m << 16) | (n << 5) | d);
+    }
+
+    #[inline(always)]
+    fn v2(&mut self, op: u32, d: u32, n: u32) {
+        self.emit(op | (n << 5) | d);
+    }
+
+    fn fadd(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4E20_D400, d, n, m); }
+    fn fsub(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4EA0_D400, d, n, m); }
+    fn fmul(&mut self, d: u32, n: u32, m: u32) { self.v3(0x6E20_DC00, d, n, m); }
+    fn fdiv(&mut self, d: u32, n: u32, m: u32) { self.v3(0x6E20_FC00, d, n, m); }
+    fn fmin(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4EA0_F400, d, n, m); }
+    fn fmax(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4E20_F400, d, n, m); }
+    fn fmla(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4E20_CC00, d, n, m); }
+    /// `fcmgt vd, vn, vm` — lanes `n > m` all ones.
+    fn fcmgt(&mut self, d: u32, n: u32, m: u32) { self.v3(0x6EA0_E400, d, n, m); }
+    /// `faddp vd.4s, vn.4s, vm.4s`
+    fn faddp(&mut self, d: u32, n: u32, m: u32) { self.v3(0x6E20_D400, d, n, m); }
+    fn and(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4E20_1C00, d, n, m); }
+    /// `bic vd, vn, vm` — `n & !m`.
+    fn bic(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4E60_1C00, d, n, m); }
+    /// `bsl vd, vn, vm` — `(d & n) | (!d & m)`.
+    fn bsl(&mut self, d: u32, n: u32, m: u32) { self.v3(0x6E60_1C00, d, n, m); }
+    fn mov_v(&mut self, d: u32, n: u32) { self.v3(0x4EA0_1C00, d, n, n); }
+    /// `tbl vd.16b, {vn.16b}, vm.16b` — out-of-range indices give 0.
+    fn tbl(&mut self, d: u32, n: u32, m: u32) { self.v3(0x4E00_0000, d, n, m); }
+
+    fn fneg(&mut self, d: u32, n: u32) { self.v2(0x6EA0_F800, d, n); }
+    fn fabs(&mut self, d: u32, n: u32) { self.v2(0x4EA0_F800, d, n); }
+    fn fsqrt(&mut self, d: u32, n: u32) { self.v2(0x6EA1_F800, d, n); }
+    /// `frintm` — round toward minus infinity (floor).
+    fn frintm(&mut self, d: u32, n: u32) { self.v2(0x4E21_9800, d, n); }
+    /// `fcmeq vd, vn, #0.0`
+    fn fcmeq_zero(&mut self, d: u32, n: u32) { self.v2(0x4EA0_D800, d, n); }
+    fn fcvtzs(&mut self, d: u32, n: u32) { self.v2(0x4EA1_B800, d, n); }
+    fn scvtf(&mut self, d: u32, n: u32) { self.v2(0x4E21_D800, d, n); }
+    /// `faddp sd, vn.2s` — lane 0 + lane 1.
+    fn faddp_scalar(&mut self, d: u32, n: u32) { self.v2(0x7E30_D800, d, n); }
+    /// `movi vd.2d, #0`
+    fn zero(&mut self, d: u32) { self.emit(0x6F00_E400 | d); }
+    /// `fmov vd.4s, #1.0`
+    fn ones(&mut self, d: u32) { self.emit(0x4F03_F600 | d); }
+
+    /// `fmul vd.4s, vn.4s, vm.s[lane]`
+    fn fmul_lane(&mut self, d: u32, n: u32, m: u32, lane: u32) {
+        self.emit(0x4F80_9000 | ((lane & 1) << 21) | ((m & 0x1F) << 16) | ((lane >> 1) << 11) | (n << 5) | d);
+    }
+
+    /// `fmla vd.4s, vn.4s, vm.s[lane]`
+    fn fmla_lane(&mut self, d: u32, n: u32, m: u32, lane: u32) {
+        self.emit(0x4F80_1000 | ((lane & 1) << 21) | ((m & 0x1F) << 16) | ((lane >> 1) << 11) | (n << 5) | d);
+    }
+
+    /// `dup vd.4s, vn.s[lane]`
+    fn dup_lane(&mut self, d: u32, n: u32, lane: u32) {
+        self.emit(0x4E04_0400 | (((lane << 3) | 4) << 16) | (n << 5) | d);
+    }
+
+    /// `dup vd.4s, wn`
+    fn dup_w(&mut self, d: u32, n: u32) {
+        self.emit(0x4E04_0C00 | (n << 5) | d);
+    }
+
+    /// `mov vd.s[lane], wn`
+    fn ins_w(&mut self, d: u32, lane: u32, n: u32) {
+        self.emit(0x4E00_1C00 | (((lane << 3) | 4) << 16) | (n << 5) | d);
+    }
+
+    /// `mov vd.s[lane], vn.s[src]`
+    fn ins_lane(&mut self, d: u32, lane: u32, n: u32, src: u32) {
+        self.emit(0x6E00_0400 | (((lane << 3) | 4) << 16) | ((src << 2) << 11) | (n << 5) | d);
+    }
+
+    /// Load the lanes `bits` into `vd` (clobbers W9).
+    fn load_const(&mut self, d: u32, bits: [u32; 4]) {
+        if bits == [0; 4] {
+            self.zero(d);
+        } else if bits.iter().all(|&b| b == bits[0]) {
+            self.mov_w(X9, bits[0]);
+            self.dup_w(d, X9);
+        } else {
+            for (lane, &b) in bits.iter().enumerate() {
+                if b == 0 {
+                    self.ins_w(d, lane as u32, ZR);
+                } else {
+                    self.mov_w(X9, b);
+                    self.ins_w(d, lane as u32, X9);
+                }
+            }
+        }
+    }
+
+    fn load_const_f32(&mut self, d: u32, val: [f32; 4]) {
+        self.load_const(d, [val[0].to_bits(), val[1].to_bits(), val[2].to_bits(), val[3].to_bits()]);
+    }
+
+    /// Clear lane 3 of `vd`.
+    fn clear_w(&mut self, d: u32) {
+        self.ins_w(d, 3, ZR);
+    }
+
+    /// Sum of the four lanes of `vn`, broadcast to `vd` (`vn` clobbered).
+    fn hsum(&mut self, d: u32, n: u32) {
+        self.faddp(n, n, n);
+        self.faddp_scalar(n, n);
+        self.dup_lane(d, n, 0);
+    }
+}
+
+// ── Relocation and cache maintenance ─────────────────────────────────────
+
+/// Address loaded by the `MOVZ`/`MOVK` sequence at `code[off..off + 16]`.
+pub(super) fn read_helper(code: &[u8], off: usize) -> u64 {
+    let mut v = 0u64;
+    for hw in 0..4 {
+        let at = off + hw * 4;
+        let word = u32::from_le_bytes([code[at], code[at + 1], code[at + 2], code[at + 3]]);
+        v |= (((word >> 5) & 0xFFFF) as u64) << (hw * 16);
+    }
+    v
+}
+
+/// Rewrite the `MOVZ`/`MOVK` sequence at `code[off..off + 16]` to load `v`.
+pub(super) fn write_helper(code: &mut [u8], off: usize, v: u64) {
+    for hw in 0..4 {
+        let at = off + hw * 4;
+        let word = u32::from_le_bytes([code[at], code[at + 1], code[at + 2], code[at + 3]]);
+        let part = ((v >> (hw * 16)) & 0xFFFF) as u32;
+        let word = (word & !(0xFFFF << 5)) | (part << 5);
+        code[at..at + 4].copy_from_slice(&word.to_le_bytes());
+    }
+}
+
+/// Make freshly written code visible to instruction fetch: clean the data
+/// cache and invalidate the instruction cache over `code` (EL0 access is
+/// enabled by SCTLR_EL1.UCT/UCI).
+#[cfg(target_arch = "aarch64")]
+pub(super) fn sync_icache(code: &[u8]) {
+    use core::arch::asm;
+    let ctr: u64;
+    unsafe { asm!("mrs {}, ctr_el0", out(reg) ctr, options(nomem, nostack)) };
+    let dline = 4usize << ((ctr >> 16) & 0xF);
+    let iline = 4usize << (ctr & 0xF);
+    let start = code.as_ptr() as usize;
+    let end = start + code.len();
+    let mut a = start & !(dline - 1);
+    while a < end {
+        unsafe { asm!("dc cvau, {}", in(reg) a, options(nostack)) };
+        a += dline;
+    }
+    unsafe { asm!("dsb ish", options(nostack)) };
+    a = start & !(iline - 1);
+    while a < end {
+        unsafe { asm!("ic ivau, {}", in(reg) a, options(nostack)) };
+        a += iline;
+    }
+    unsafe { asm!("dsb ish", "isb", options(nostack)) };
+}
+
+#[cfg(not(target_arch = "aarch64"))]
+pub(super) fn sync_icache(_code: &[u8]) {}
+
+// ── Compiler ─────────────────────────────────────────────────────────────
+
+/// Compile a shader IR program to AArch64 machine code.
+pub fn compile_jit_a64(program: &Program) -> Option<JitCode> {
+    let mut e = A64::new();
+
+    // Prologue: frame record, callee-saved X19–X24, context pointers.
+    e.stp_pre(X29, X30, FRAME);
+    e.add_imm(X29, SP, 0);
+    e.stp(X19, X20, 16);
+    e.stp(X21, X22, 32);
+    e.stp(X23, X24, 48);
+    e.mov_reg(X24, X0);
+    e.ldr_x(X19, X24, CTX_REGS as u32);
+    e.ldr_x(X20, X24, CTX_UNIFORMS as u32);
+    e.ldr_x(X21, X24, CTX_ATTRIBUTES as u32);
+    e.ldr_x(X22, X24, CTX_VARYINGS_IN as u32);
+    e.ldr_x(X23, X24, CTX_VARYINGS_OUT as u32);
+
+    let const_regs = const_table(program);
+    for inst in &program.instructions {
+        emit_instruction(&mut e, inst, &const_regs);
+    }
+
+    e.ldp(X23, X24, 48);
+    e.ldp(X21, X22, 32);
+    e.ldp(X19, X20, 16);
+    e.ldp_post(X29, X30, FRAME);
+    e.ret();
+
+    Some(e.finish())
+}
+
+/// `dst = op(a, b)` for a three-operand vector instruction.
+fn binop(e: &mut A64, dst: u32, a: u32, b: u32, op: fn(&mut A64, u32, u32, u32)) {
+    e.load(V0, a);
+    e.load(V1, b);
+    op(e, V0, V0, V1);
+    e.store(dst, V0);
+}
+
+/// `dst = op(src)` for a two-operand vector instruction.
+fn unop(e: &mut A64, dst: u32, src: u32, op: fn(&mut A64, u32, u32)) {
+    e.load(V0, src);
+    op(e, V0, V0);
+    e.store(dst, V0);
+}
+
+/// 3-component dot product of IR registers `a` and `b`, broadcast to `vd`
+/// (clobbers V4, V5).
+fn dp3_to(e: &mut A64, vd: u32, a: u32, b: u32) {
+    e.load(V4, a);
+    e.load(V5, b);
+    e.fmul(V4, V4, V5);
+    e.clear_w(V4);
+    e.hsum(vd, V4);
+}
+
+/// Call `func(s0, s1)` per component, results to `dst` via the scratch slot.
+fn per_component_call(e: &mut A64, dst: u32, a: u32, b: Option<u32>, func: usize) {
+    for comp in 0..4u32 {
+        e.ldr_s(V0, X19, a * 16 + comp * 4);
+        if let Some(b) = b {
+            e.ldr_s(V1, X19, b * 16 + comp * 4);
+        }
+        e.call_helper(func);
+        e.str_s(V0, SP, SCRATCH + comp * 4);
+    }
+    e.ldr_q(V0, SP, SCRATCH);
+    e.store(dst, V0);
+}
+
+/// Emit AArch64 code for a single IR instruction.
+///
+/// Results match the x86_64 backend lane for lane (including the zeroed
+/// `w` of cross / reflect / `mat3` products and the broadcast dot products).
+fn emit_instruction(e: &mut A64, inst: &Inst, const_regs: &[Option<[f32; 4]>; 128]) {
+    match *inst {
+        Inst::LoadConst(dst, val) => {
+            e.load_const_f32(V0, val);
+            e.store(dst, V0);
+        }
+        Inst::Mov(dst, src) | Inst::IntToFloat(dst, src) => {
+            if dst != src {
+                e.load(V0, src);
+                e.store(dst, V0);
+            }
+        }
+
+        Inst::Add(dst, a, b) => binop(e, dst, a, b, A64::fadd),
+        Inst::Sub(dst, a, b) => binop(e, dst, a, b, A64::fsub),
+        Inst::Mul(dst, a, b) => binop(e, dst, a, b, A64::fmul),
+        Inst::Min(dst, a, b) => binop(e, dst, a, b, A64::fmin),
+        Inst::Max(dst, a, b) => binop(e, dst, a, b, A64::fmax),
+        Inst::Div(dst, a, b) => {
+            // Safe div: lanes where b == 0 produce 0 instead of inf/NaN.
+            e.load(V0, a);
+            e.load(V1, b);
+            e.fdiv(V2, V0, V1);
+            e.fcmeq_zero(V3, V1);
+            e.bic(V2, V2, V3);
+            e.store(dst, V2);
+        }
+        Inst::Neg(dst, src) => unop(e, dst, src, A64::fneg),
+        Inst::Abs(dst, src) => unop(e, dst, src, A64::fabs),
+        Inst::Sqrt(dst, src) => unop(e, dst, src, A64::fsqrt),
+        Inst::Floor(dst, src) => unop(e, dst, src, A64::frintm),
+        Inst::Rsqrt(dst, src) => {
+            e.load(V0, src);
+            e.fsqrt(V0, V0);
+            e.ones(V1);
+            e.fdiv(V0, V1, V0);
+            e.store(dst, V0);
+        }
+        Inst::Fract(dst, src) => {
+            e.load(V0, src);
+            e.frintm(V1, V0);
+            e.fsub(V0, V0, V1);
+            e.store(dst, V0);
+        }
+        Inst::FloatToInt(dst, src) => {
+            e.load(V0, src);
+            e.fcvtzs(V0, V0);
+            e.scvtf(V0, V0);
+            e.store(dst, V0);
+        }
+
+        Inst::Clamp(dst, x, lo, hi) => {
+            e.load(V0, x);
+            e.load(V1, lo);
+            e.load(V2, hi);
+            e.fmax(V0, V0, V1);
+            e.fmin(V0, V0, V2);
+            e.store(dst, V0);
+        }
+        Inst::Mix(dst, a, b, t) => {
+            // a + (b - a) * t
+            e.load(V0, a);
+            e.load(V1, b);
+            e.load(V2, t);
+            e.fsub(V1, V1, V0);
+            e.fmla(V0, V1, V2);
+            e.store(dst, V0);
+        }
+
+        Inst::Dp3(dst, a, b) => {
+            dp3_to(e, V0, a, b);
+            e.store(dst, V0);
+        }
+        Inst::Dp4(dst, a, b) => {
+            e.load(V0, a);
+            e.load(V1, b);
+            e.fmul(V0, V0, V1);
+            e.hsum(V0, V0);
+            e.store(dst, V0);
+        }
+        Inst::Length(dst, src) => {
+            dp3_to(e, V0, src, src);
+            e.fsqrt(V0, V0);
+            e.store(dst, V0);
+        }
+        Inst::Normalize(dst, src) => {
+            dp3_to(e, V1, src, src);
+            e.fsqrt(V1, V1);
+            e.load(V0, src);
+            e.fdiv(V0, V0, V1);
+            e.store(dst, V0);
+        }
+        Inst::Cross(dst, a, b) => {
+            // a.yzx * b.zxy - a.zxy * b.yzx, w = 0
+            e.load(V0, a);
+            e.load(V1, b);
+            for (d, n, lanes) in [(V2, V0, [1, 2, 0]), (V3, V1, [2, 0, 1]), (V4, V0, [2, 0, 1]), (V5, V1, [1, 2, 0])] {
+                for (lane, &src) in lanes.iter().enumerate() {
+                    e.ins_lane(d, lane as u32, n, src);
+                }
+            }
+            e.fmul(V2, V2, V3);
+            e.fmul(V4, V4, V5);
+            e.fsub(V2, V2, V4);
+            e.clear_w(V2);
+            e.store(dst, V2);
+        }
+        Inst::Reflect(dst, i, n) => {
+            // I - 2 * dot(I, N) * N, w = 0
+            dp3_to(e, V2, i, n);
+            e.fadd(V2, V2, V2);
+            e.load(V1, n);
+            e.fmul(V2, V2, V1);
+            e.load(V0, i);
+            e.fsub(V0, V0, V2);
+            e.clear_w(V0);
+            e.store(dst, V0);
+        }
+
+        Inst::Pow(dst, base, exp) => {
+            let int_exp = const_regs.get(exp as usize)
+                .and_then(|v| *v)
+                .and_then(|val| {
+                    let n = val[0] as u32;
+                    (n as f32 == val[0] && n > 0 && n <= 256 && val.iter().all(|&c| c == val[0])).then_some(n)
+                });
+            match int_exp {
+                Some(n) => emit_pow_int(e, dst, base, n),
+                None => per_component_call(e, dst, base, Some(exp), jit_pow as usize),
+            }
+        }
+        Inst::Sin(dst, src) => per_component_call(e, dst, src, None, jit_sin as usize),
+        Inst::Cos(dst, src) => per_component_call(e, dst, src, None, jit_cos as usize),
+
+        // Single-fragment execution has no neighbours to difference.
+        Inst::DFdx(dst, _) | Inst::DFdy(dst, _) => {
+            e.zero(V0);
+            e.store(dst, V0);
+        }
+
+        Inst::TexSample(dst, sampler, coord) => {
+            // jit_tex_sample(tex_fn: X0, unit: W1, u: S0, v: S1, out: X2)
+            e.ldr_x(X0, X24, CTX_TEX_SAMPLE as u32);
+            e.ldr_s(V0, X19, sampler * 16);
+            e.fcvtzs_w_s(X1, V0);
+            e.ldr_s(V0, X19, coord * 16);
+            e.ldr_s(V1, X19, coord * 16 + 4);
+            e.add_imm(X2, SP, SCRATCH);
+            e.call_helper(jit_tex_sample as usize);
+            e.ldr_q(V0, SP, SCRATCH);
+            e.store(dst, V0);
+        }
+
+        Inst::MatMul4(dst, mat, vec) | Inst::MatMul3(dst, mat, vec) => {
+            let cols = if matches!(inst, Inst::MatMul4(..)) { 4 } else { 3 };
+            e.load(V0, vec);
+            for c in 0..cols {
+                e.load(V4 + c, mat + c);
+            }
+            e.fmul_lane(V1, V4, V0, 0);
+            for c in 1..cols {
+                e.fmla_lane(V1, V4 + c, V0, c);
+            }
+            if cols == 3 {
+                e.clear_w(V1);
+            }
+            e.store(dst, V1);
+        }
+
+        Inst::Swizzle(dst, src, indices, count) => {
+            e.load(V0, src);
+            if count == 1 {
+                e.dup_lane(V0, V0, (indices[0] & 3) as u32);
+            } else {
+                // Byte shuffle; lanes past `count` (and bad indices) read zero.
+                let mut table = [0xFFFF_FFFFu32; 4];
+                for (i, t) in table.iter_mut().enumerate().take(count as usize) {
+                    let idx = indices[i] as u32;
+                    if idx < 4 {
+                        let b = idx * 4;
+                        *t = b | (b + 1) << 8 | (b + 2) << 16 | (b + 3) << 24;
+                    }
+                }
+                e.load_const(V1, table);
+                e.tbl(V0, V0, V1);
+            }
+            e.store(dst, V0);
+        }
+        Inst::WriteMask(dst, src, mask) => {
+            if mask & 0x0F == 0x0F {
+                e.load(V0, src);
+            } else {
+                e.load(V0, dst);
+                e.load(V1, src);
+                for lane in 0..4 {
+                    if mask & (1 << lane) != 0 {
+                        e.ins_lane(V0, lane, V1, lane);
+                    }
+                }
+            }
+            e.store(dst, V0);
+        }
+
+        Inst::CmpLt(dst, a, b) => {
+            e.load(V0, a);
+            e.load(V1, b);
+            e.fcmgt(V0, V1, V0);
+            e.ones(V1);
+            e.and(V0, V0, V1);
+            e.store(dst, V0);
+        }
+        Inst::CmpEq(dst, a, b) => {
+            // |a - b| < 1e-6
+            e.load(V0, a);
+            e.load(V1, b);
+            e.fsub(V0, V0, V1);
+            e.fabs(V0, V0);
+            e.load_const_f32(V1, [1e-6; 4]);
+            e.fcmgt(V0, V1, V0);
+            e.ones(V1);
+            e.and(V0, V0, V1);
+            e.store(dst, V0);
+        }
+        Inst::Select(dst, cond, a, b) => {
+            // (cond != 0) ? a : b per lane
+            e.load(V0, cond);
+            e.load(V1, a);
+            e.load(V2, b);
+            e.fcmeq_zero(V3, V0);
+            e.bsl(V3, V2, V1);
+            e.store(dst, V3);
+        }
+
+        Inst::StorePosition(src) => {
+            e.load(V0, src);
+            e.ldr_x(X9, X24, CTX_POSITION as u32);
+            e.str_q(V0, X9, 0);
+        }
+        Inst::StoreFragColor(src) => {
+            e.load(V0, src);
+            e.ldr_x(X9, X24, CTX_FRAG_COLOR as u32);
+            e.str_q(V0, X9, 0);
+        }
+        Inst::StorePointSize(src) => {
+            e.ldr_s(V0, X19, src * 16);
+            e.ldr_x(X9, X24, CTX_POINT_SIZE as u32);
+            e.str_s(V0, X9, 0);
+        }
+        Inst::LoadVarying(dst, idx) => {
+            e.ldr_q(V0, X22, idx * 16);
+            e.store(dst, V0);
+        }
+        Inst::StoreVarying(idx, src) => {
+            e.load(V0, src);
+            e.str_q(V0, X23, idx * 16);
+        }
+        Inst::LoadUniform(dst, idx) => {
+            e.ldr_q(V0, X20, idx * 16);
+            e.store(dst, V0);
+        }
+        Inst::LoadAttribute(dst, idx) => {
+            e.ldr_q(V0, X21, idx * 16);
+            e.store(dst, V0);
+        }
+    }
+}
+
+/// `dst = base ^ n` by square-and-multiply, unrolled at compile time.
+fn emit_pow_int(e: &mut A64, dst: u32, base: u32, n: u32) {
+    e.load(V0, base);
+    e.mov_v(V1, V0);
+    let bits = 32 - n.leading_zeros();
+    for i in (0..bits - 1).rev() {
+        e.fmul(V1, V1, V1);
+        if (n >> i) & 1 == 1 {
+            e.fmul(V1, V1, V0);
+        }
+    }
+    e.store(dst, V1);
+}
@@ -0,0 +1,540 @@
+//! 2×2 quad variant of the JIT backend.
+//!
+//! Runs one shader over four invocations at once — the four pixels of a 2×2
+//! screen quad, or four vertices.  The register file is SoA: every virtual
+//! register holds four components of four lanes,
+//!
+//! ```text
+//! [RBX + reg * 64 + component * 16 + lane * 4]
+//! ```
+//!
+//! so each IR operation becomes one packed SSE op per component instead of
+//! one per invocation.  Varyings, attributes and outputs use the same
+//! layout (see [`QuadExec`]); uniforms stay AoS and are broadcast on load.
+//!
+//! Fragment lanes are numbered `0 = (x, y)`, `1 = (x+1, y)`, `2 = (x, y+1)`,
+//! `3 = (x+1, y+1)`, which makes `dFdx`/`dFdy` a shuffle and a subtract.
+//! `JitContext::coverage` selects the lanes that are really shaded; the
+//! others run along (their results are discarded by the caller) but skip
+//! texture fetches.  Texture fetches go through a [`TexSampleQuadFn`] that
+//! sees all four lanes, so it can derive the mip level from them.
+
+use super::*;
+use crate::compiler::backend_sw::MAX_REGS;
+use crate::rasterizer::MAX_VARYINGS;
+
+/// Register file and I/O of one quad invocation, laid out for the quad JIT.
+///
+/// All arrays are `[component][lane]` (per register / varying).  About 10 KB,
+/// so it is created once per draw call or tile and reused.
+#[repr(C, align(16))]
+pub struct QuadExec {
+    /// Register file: `regs[reg][component][lane]`.
+    pub regs: [[[f32; 4]; 4]; MAX_REGS],
+    /// gl_Position output (vertex shader).
+    pub position: [[f32; 4]; 4],
+    /// gl_FragColor output (fragment shader).
+    pub frag_color: [[f32; 4]; 4],
+    /// gl_PointSize output, one per lane.
+    pub point_size: [f32; 4],
+    /// Varying outputs (vertex shader).
+    pub varyings: [[[f32; 4]; 4]; MAX_VARYINGS],
+}
+
+impl QuadExec {
+    /// Create a zeroed execution context.
+    pub fn new() -> Self {
+        Self {
+            regs: [[[0.0; 4]; 4]; MAX_REGS],
+            position: [[0.0; 4]; 4],
+            frag_color: [[0.0; 4], [0.0; 4], [0.0; 4], [1.0; 4]],
+            point_size: [1.0; 4],
+            varyings: [[[0.0; 4]; 4]; MAX_VARYINGS],
+        }
+    }
+
+    /// Run quad-JIT code.  `attributes` (vertex shaders) and `varyings_in`
+    /// (fragment shaders) are SoA like the outputs; `coverage` has a bit per
+    /// live lane.  Outputs are reset to their GL defaults first.
+    #[inline]
+    pub fn run(
+        &mut self,
+        code: JitFn,
+        uniforms: &[[f32; 4]],
+        attributes: &[[[f32; 4]; 4]],
+        varyings_in: Option<&[[[f32; 4]; 4]; MAX_VARYINGS]>,
+        coverage: u32,
+    ) {
+        self.position = [[0.0; 4]; 4];
+        self.frag_color = [[0.0; 4], [0.0; 4], [0.0; 4], [1.0; 4]];
+        self.point_size = [1.0; 4];
+        let mut ctx = JitContext {
+            regs: self.regs.as_mut_ptr() as *mut f32,
+            uniforms: uniforms.as_ptr() as *const f32,
+            attributes: attributes.as_ptr() as *const f32,
+            varyings_in: varyings_in.map_or(core::ptr::null(), |v| v.as_ptr() as *const f32),
+            varyings_out: self.varyings.as_mut_ptr() as *mut f32,
+            position: self.position.as_mut_ptr() as *mut f32,
+            frag_color: self.frag_color.as_mut_ptr() as *mut f32,
+            point_size: self.point_size.as_mut_ptr(),
+            tex_sample: crate::rasterizer::raster::real_tex_sample_quad as usize,
+            coverage,
+        };
+        unsafe { code(&mut ctx); }
+    }
+}
+
+/// Coverage flag: the lanes are a 2×2 pixel quad (texture level of detail
+/// may be taken from their differences).
+pub const QUAD_PIXELS: u32 = 1 << 4;
+
+/// Quad texture sampler: `(unit, u, v, coverage, out[component][lane])`.
+pub type TexSampleQuadFn = fn(unit: u32, u: &[f32; 4], v: &[f32; 4], coverage: u32, out: &mut [[f32; 4]; 4]);
+
+/// Byte offset of one component (all four lanes) of a register or varying.
+#[inline(always)]
+fn soa(r: u32, c: u32) -> i32 {
+    (r as i32) * 64 + (c as i32) * 16
+}
+
+// ── Helper function wrappers (C ABI, 16 floats per call) ─────────────────
+
+/// `dst[i] = pow(a[i], b[i])` over one register (4 components × 4 lanes).
+pub(super) extern "C" fn jit_pow_quad(dst: *mut f32, a: *const f32, b: *const f32) {
+    for i in 0..16 {
+        unsafe { *dst.add(i) = crate::rasterizer::math::pow(*a.add(i), *b.add(i)); }
+    }
+}
+
+/// `dst[i] = sin(src[i])` over one register.
+pub(super) extern "C" fn jit_sin_quad(dst: *mut f32, src: *const f32) {
+    for i in 0..16 {
+        unsafe { *dst.add(i) = crate::rasterizer::math::sin(*src.add(i)); }
+    }
+}
+
+/// `dst[i] = cos(src[i])` over one register.
+pub(super) extern "C" fn jit_cos_quad(dst: *mut f32, src: *const f32) {
+    for i in 0..16 {
+        unsafe { *dst.add(i) = crate::rasterizer::math::cos(*src.add(i)); }
+    }
+}
+
+/// Sample texture `unit` for the covered lanes of an SoA coordinate
+/// register; uncovered lanes get zero.
+pub(super) extern "C" fn jit_tex_sample_quad(
+    tex_fn_ptr: usize,
+    unit: u32,
+    coord: *const [f32; 4],
+    out: *mut [[f32; 4]; 4],
+    coverage: u32,
+) {
+    let tex_fn: TexSampleQuadFn = unsafe { core::mem::transmute(tex_fn_ptr) };
+    // `out` may alias `coord`: read the coordinates first.
+    let (u, v) = unsafe { (*coord, *coord.add(1)) };
+    let mut texel = [[0.0f32; 4]; 4];
+    tex_fn(unit, &u, &v, coverage, &mut texel);
+    unsafe { *out = texel; }
+}
+
+// ── Compiler ─────────────────────────────────────────────────────────────
+
+/// Compile a shader IR program to quad (4-invocation SoA) machine code.
+///
+/// Entry point and calling convention are the same as [`compile_jit`]; the
+/// buffers in the `JitContext` must use the [`QuadExec`] layout.
+pub fn compile_jit_quad(program: &Program) -> Option<JitCode> {
+    // SSE only; AArch64 shades with the scalar [`a64`](super::a64) code.
+    if cfg!(target_arch = "aarch64") {
+        return None;
+    }
+    let mut e = Emitter::new();
+    emit_prologue(&mut e);
+    let const_regs = const_table(program);
+    for inst in &program.instructions {
+        emit_quad_instruction(&mut e, inst, &const_regs);
+    }
+    emit_epilogue(&mut e);
+    Some(e.finish())
+}
+
+/// Per-component operation: `dst.c = op(src.c, ...)` for every component.
+/// Component `c` of the operands is loaded into XMM0.. in order; `op`
+/// leaves the result in XMM0.  Registers above the operands survive across
+/// components (callers keep constants there).
+fn emit_each(e: &mut Emitter, dst: u32, srcs: &[u32], op: impl Fn(&mut Emitter)) {
+    for c in 0..4 {
+        for (i, &s) in srcs.iter().enumerate() {
+            e.movups_load(i as u8, RBX, soa(s, c));
+        }
+        op(e);
+        e.movups_store(RBX, soa(dst, c), XMM0);
+    }
+}
+
+/// Store XMM`xmm` into every component of `dst`.
+fn emit_store_broadcast(e: &mut Emitter, dst: u32, xmm: u8) {
+    for c in 0..4 {
+        e.movups_store(RBX, soa(dst, c), xmm);
+    }
+}
+
+/// Copy four components from `[src_base + src_off]` to `[dst_base + dst_off]`.
+fn emit_copy4(e: &mut Emitter, dst_base: u8, dst_off: i32, src_base: u8, src_off: i32) {
+    for c in 0..4 {
+        e.movups_load(XMM0, src_base, src_off + c * 16);
+        e.movups_store(dst_base, dst_off + c * 16, XMM0);
+    }
+}
+
+/// XMM`out` = `a.x*b.x + a.y*b.y + a.z*b.z (+ a.w*b.w)` per lane.
+/// Clobbers XMM`out + 1` and XMM7.
+fn emit_dot(e: &mut Emitter, out: u8, a: u32, b: u32, n: u32) {
+    let tmp = out + 1;
+    e.movups_load(out, RBX, soa(a, 0));
+    e.movups_load(tmp, RBX, soa(b, 0));
+    e.mulps(out, tmp);
+    for c in 1..n {
+        e.movups_load(tmp, RBX, soa(a, c));
+        e.movups_load(XMM7, RBX, soa(b, c));
+        e.mulps(tmp, XMM7);
+        e.addps(out, tmp);
+    }
+}
+
+/// Call a quad helper with `RDI`/`RSI`/`RDX` = addresses of `regs`.
+fn emit_helper_call(e: &mut Emitter, func: usize, regs: &[u32]) {
+    const ARGS: [u8; 3] = [RDI, RSI, RDX];
+    for (i, &r) in regs.iter().enumerate() {
+        e.lea_r64_mem(ARGS[i], RBX, soa(r, 0));
+    }
+    // RSP is 16-byte aligned after the prologue.
+    e.mov_r64_helper(RAX, func);
+    e.call_r64(RAX);
+}
+
+/// Emit quad code for a single IR instruction.
+fn emit_quad_instruction(e: &mut Emitter, inst: &Inst, const_regs: &[Option<[f32; 4]>; 128]) {
+    match inst {
+        // ── Data movement ────────────────────────────────────────────
+        Inst::LoadConst(dst, val) => {
+            for c in 0..4 {
+                let v = val[c as usize];
+                emit_load_const_xmm(e, XMM0, [v, v, v, v]);
+                e.movups_store(RBX, soa(*dst, c), XMM0);
+            }
+        }
+        Inst::Mov(dst, src) | Inst::IntToFloat(dst, src) => {
+            if dst != src {
+                emit_copy4(e, RBX, soa(*dst, 0), RBX, soa(*src, 0));
+            }
+        }
+
+        // ── Packed arithmetic ────────────────────────────────────────
+        Inst::Add(dst, a, b) => emit_each(e, *dst, &[*a, *b], |e| e.addps(XMM0, XMM1)),
+        Inst::Sub(dst, a, b) => emit_each(e, *dst, &[*a, *b], |e| e.subps(XMM0, XMM1)),
+        Inst::Mul(dst, a, b) => emit_each(e, *dst, &[*a, *b], |e| e.mulps(XMM0, XMM1)),
+        Inst::Div(dst, a, b) => {
+            // Safe div: lanes where b==0 produce 0 instead of NaN
+            emit_each(e, *dst, &[*a, *b], |e| {
+                e.xorps(XMM2, XMM2);
+                e.movaps_rr(XMM3, XMM1);
+                e.cmpneqps(XMM3, XMM2);
+                e.divps(XMM0, XMM1);
+                e.andps(XMM0, XMM3);
+            });
+        }
+        Inst::Neg(dst, src) => {
+            emit_load_const_xmm(e, XMM7, [-0.0f32, -0.0, -0.0, -0.0]);
+            emit_each(e, *dst, &[*src], |e| e.xorps(XMM0, XMM7));
+        }
+        Inst::Abs(dst, src) => {
+            let m = f32::from_bits(0x7FFF_FFFF);
+            emit_load_const_xmm(e, XMM7, [m, m, m, m]);
+            emit_each(e, *dst, &[*src], |e| e.andps(XMM0, XMM7));
+        }
+
+        // ── Min / Max / Clamp / Mix ──────────────────────────────────
+        Inst::Min(dst, a, b) => emit_each(e, *dst, &[*a, *b], |e| e.minps(XMM0, XMM1)),
+        Inst::Max(dst, a, b) => emit_each(e, *dst, &[*a, *b], |e| e.maxps(XMM0, XMM1)),
+        Inst::Clamp(dst, x, lo, hi) => {
+            emit_each(e, *dst, &[*x, *lo, *hi], |e| {
+                e.maxps(XMM0, XMM1);
+                e.minps(XMM0, XMM2);
+            });
+        }
+        Inst::Mix(dst, a, b, t) => {
+            emit_each(e, *dst, &[*a, *b, *t], |e| {
+                e.subps(XMM1, XMM0);
+                e.mulps(XMM1, XMM2);
+                e.addps(XMM0, XMM1);
+            });
+        }
+
+        // ── Dot products / geometry ──────────────────────────────────
+        Inst::Dp3(dst, a, b) => {
+            emit_dot(e, XMM0, *a, *b, 3);
+            emit_store_broadcast(e, *dst, XMM0);
+        }
+        Inst::Dp4(dst, a, b) => {
+            emit_dot(e, XMM0, *a, *b, 4);
+            emit_store_broadcast(e, *dst, XMM0);
+        }
+        Inst::Cross(dst, a, b) => {
+            // Load both operands first: dst may alias either.
+            for c in 0..3 {
+                e.movups_load(c as u8, RBX, soa(*a, c));
+                e.movups_load(3 + c as u8, RBX, soa(*b, c));
+            }
+            // (x, y, z) = (a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x)
+            for (c, (i, j)) in [(1u8, 2u8), (2, 0), (0, 1)].iter().enumerate() {
+                e.movaps_rr(XMM6, *i);
+                e.mulps(XMM6, 3 + *j);
+                e.movaps_rr(XMM7, *j);
+                e.mulps(XMM7, 3 + *i);
+                e.subps(XMM6, XMM7);
+                e.movups_store(RBX, soa(*dst, c as u32), XMM6);
+            }
+            e.xorps(XMM6, XMM6);
+            e.movups_store(RBX, soa(*dst, 3), XMM6);
+        }
+        Inst::Normalize(dst, src) => {
+            // rsqrtps + one Newton-Raphson step, as in the single-lane JIT
+            emit_dot(e, XMM0, *src, *src, 3);
+            e.rsqrtps(XMM2, XMM0);
+            emit_load_const_xmm(e, XMM3, [0.5, 0.5, 0.5, 0.5]);
+            e.mulps(XMM0, XMM3);
+            e.movaps_rr(XMM4, XMM2);
+            e.mulps(XMM4, XMM2);
+            e.mulps(XMM0, XMM4);
+            emit_load_const_xmm(e, XMM3, [1.5, 1.5, 1.5, 1.5]);
+            e.subps(XMM3, XMM0);
+            e.mulps(XMM2, XMM3);
+            emit_each(e, *dst, &[*src], |e| e.mulps(XMM0, XMM2));
+        }
+        Inst::Length(dst, src) => {
+            emit_dot(e, XMM0, *src, *src, 3);
+            e.sqrtps(XMM0, XMM0);
+            emit_store_broadcast(e, *dst, XMM0);
+        }
+        Inst::Reflect(dst, i, n) => {
+            // reflect(I, N) = I - 2 * dot(I, N) * N, w = 0
+            emit_dot(e, XMM2, *i, *n, 3);
+            e.addps(XMM2, XMM2);
+            for c in 0..3 {
+                e.movups_load(XMM0, RBX, soa(*i, c));
+                e.movups_load(XMM1, RBX, soa(*n, c));
+                e.mulps(XMM1, XMM2);
+                e.subps(XMM0, XMM1);
+                e.movups_store(RBX, soa(*dst, c), XMM0);
+            }
+            e.xorps(XMM0, XMM0);
+            e.movups_store(RBX, soa(*dst, 3), XMM0);
+        }
+
+        // ── Sqrt / Rsqrt / Floor / Fract ─────────────────────────────
+        Inst::Sqrt(dst, src) => emit_each(e, *dst, &[*src], |e| e.sqrtps(XMM0, XMM0)),
+        Inst::Rsqrt(dst, src) => {
+            emit_load_const_xmm(e, XMM6, [0.5, 0.5, 0.5, 0.5]);
+            emit_load_const_xmm(e, XMM7, [1.5, 1.5, 1.5, 1.5]);
+            emit_each(e, *dst, &[*src], |e| {
+                e.rsqrtps(XMM1, XMM0);
+                e.mulps(XMM0, XMM6);
+                e.movaps_rr(XMM2, XMM1);
+                e.mulps(XMM2, XMM1);
+                e.mulps(XMM0, XMM2);
+                e.movaps_rr(XMM2, XMM7);
+                e.subps(XMM2, XMM0);
+                e.mulps(XMM1, XMM2);
+                e.movaps_rr(XMM0, XMM1);
+            });
+        }
+        Inst::Floor(dst, src) => emit_each(e, *dst, &[*src], |e| e.roundps(XMM0, XMM0, 0x09)),
+        Inst::Fract(dst, src) => {
+            emit_each(e, *dst, &[*src], |e| {
+                e.movaps_rr(XMM1, XMM0);
+                e.roundps(XMM1, XMM1, 0x09);
+                e.subps(XMM0, XMM1);
+            });
+        }
+
+        // ── Derivatives: right/bottom lane minus left/top lane ───────
+        Inst::DFdx(dst, src) => {
+            emit_each(e, *dst, &[*src], |e| {
+                e.movaps_rr(XMM1, XMM0);
+                e.shufps(XMM0, XMM0, 0xF5); // lanes 1,1,3,3
+                e.shufps(XMM1, XMM1, 0xA0); // lanes 0,0,2,2
+                e.subps(XMM0, XMM1);
+            });
+        }
+        Inst::DFdy(dst, src) => {
+            emit_each(e, *dst, &[*src], |e| {
+                e.movaps_rr(XMM1, XMM0);
+                e.shufps(XMM0, XMM0, 0xEE); // lanes 2,3,2,3
+                e.shufps(XMM1, XMM1, 0x44); // lanes 0,1,0,1
+                e.subps(XMM0, XMM1);
+            });
+        }
+
+        // ── Transcendentals ──────────────────────────────────────────
+        Inst::Pow(dst, base, exp) => {
+            let int_exp = const_regs.get(*exp as usize)
+                .and_then(|v| *v)
+                .and_then(|val| {
+                    let ex = val[0];
+                    let n = ex as u32;
+                    if n as f32 == ex && n > 0 && n <= 256
+                        && val[1] == ex && val[2] == ex && val[3] == ex
+                    {
+                        Some(n)
+                    } else {
+                        None
+                    }
+                });
+            match int_exp {
+                Some(n) => emit_each(e, *dst, &[*base], |e| {
+                    e.movaps_rr(XMM1, XMM0);
+                    let bits = 32 - n.leading_zeros();
+                    for i in (0..bits - 1).rev() {
+                        e.mulps(XMM1, XMM1);
+                        if (n >> i) & 1 == 1 {
+                            e.mulps(XMM1, XMM0);
+                        }
+                    }
+                    e.movaps_rr(XMM0, XMM1);
+                }),
+                None => emit_helper_call(e, jit_pow_quad as usize, &[*dst, *base, *exp]),
+            }
+        }
+        Inst::Sin(dst, src) => emit_helper_call(e, jit_sin_quad as usize, &[*dst, *src]),
+        Inst::Cos(dst, src) => emit_helper_call(e, jit_cos_quad as usize, &[*dst, *src]),
+
+        // ── Texture sampling ─────────────────────────────────────────
+        Inst::TexSample(dst, sampler, coord) => {
+            // jit_tex_sample_quad(tex_fn, unit, coord, out, coverage)
+            e.mov_r64_mem(RDI, RBP, CTX_TEX_SAMPLE);
+            e.movss_load(XMM0, RBX, soa(*sampler, 0));
+            e.cvttss2si_r32_xmm(RSI, XMM0);
+            e.lea_r64_mem(RDX, RBX, soa(*coord, 0));
+            e.lea_r64_mem(RCX, RBX, soa(*dst, 0));
+            e.mov_r32_mem(R8, RBP, CTX_COVERAGE);
+            e.mov_r64_helper(RAX, jit_tex_sample_quad as usize);
+            e.call_r64(RAX);
+        }
+
+        // ── Matrix multiply ──────────────────────────────────────────
+        Inst::MatMul4(dst, mat, vec) | Inst::MatMul3(dst, mat, vec) => {
+            let n = if matches!(inst, Inst::MatMul4(..)) { 4 } else { 3 };
+            // Vector components stay in XMM4.. (dst may alias vec).
+            for k in 0..n {
+                e.movups_load(XMM4 + k as u8, RBX, soa(*vec, k));
+            }
+            for c in 0..n {
+                e.movups_load(XMM0, RBX, soa(*mat, c));
+                e.mulps(XMM0, XMM4);
+                for k in 1..n {
+                    e.movups_load(XMM1, RBX, soa(*mat + k, c));
+                    e.mulps(XMM1, XMM4 + k as u8);
+                    e.addps(XMM0, XMM1);
+                }
+                e.movups_store(RBX, soa(*dst, c), XMM0);
+            }
+            if n == 3 {
+                e.xorps(XMM0, XMM0);
+                e.movups_store(RBX, soa(*dst, 3), XMM0);
+            }
+        }
+
+        // ── Swizzle / WriteMask ──────────────────────────────────────
+        Inst::Swizzle(dst, src, indices, count) => {
+            // Gather into XMM0..XMM3 before storing (dst may alias src).
+            for i in 0..4u8 {
+                let from = if *count == 1 {
+                    Some(indices[0])
+                } else if i < *count {
+                    Some(indices[i as usize])
+                } else {
+                    None
+                };
+                match from {
+                    Some(c) if c < 4 => e.movups_load(i, RBX, soa(*src, c as u32)),
+                    _ => e.xorps(i, i),
+                }
+            }
+            for i in 0..4u8 {
+                e.movups_store(RBX, soa(*dst, i as u32), i);
+            }
+        }
+        Inst::WriteMask(dst, src, mask) => {
+            for c in 0..4 {
+                if mask & (1 << c) != 0 && dst != src {
+                    e.movups_load(XMM0, RBX, soa(*src, c));
+                    e.movups_store(RBX, soa(*dst, c), XMM0);
+                }
+            }
+        }
+
+        // ── Comparisons ──────────────────────────────────────────────
+        Inst::CmpLt(dst, a, b) => {
+            emit_load_const_xmm(e, XMM7, [1.0, 1.0, 1.0, 1.0]);
+            emit_each(e, *dst, &[*a, *b], |e| {
+                e.cmpltps(XMM0, XMM1);
+                e.andps(XMM0, XMM7);
+            });
+        }
+        Inst::CmpEq(dst, a, b) => {
+            // Epsilon comparison: |a - b| < 1e-6
+            let m = f32::from_bits(0x7FFF_FFFF);
+            emit_load_const_xmm(e, XMM5, [m, m, m, m]);
+            emit_load_const_xmm(e, XMM6, [1e-6, 1e-6, 1e-6, 1e-6]);
+            emit_load_const_xmm(e, XMM7, [1.0, 1.0, 1.0, 1.0]);
+            emit_each(e, *dst, &[*a, *b], |e| {
+                e.subps(XMM0, XMM1);
+                e.andps(XMM0, XMM5);
+                e.cmpltps(XMM0, XMM6);
+                e.andps(XMM0, XMM7);
+            });
+        }
+        Inst::Select(dst, cond, a, b) => {
+            emit_each(e, *dst, &[*cond, *a, *b], |e| {
+                e.xorps(XMM3, XMM3);
+                e.cmpneqps(XMM0, XMM3);
+                e.movaps_rr(XMM3, XMM0);
+                e.andps(XMM3, XMM1);
+                e.andnps(XMM0, XMM2);
+                e.orps(XMM0, XMM3);
+            });
+        }
+        Inst::FloatToInt(dst, src) => {
+            emit_each(e, *dst, &[*src], |e| {
+                e.cvttps2dq(XMM0, XMM0);
+                e.cvtdq2ps(XMM0, XMM0);
+            });
+        }
+
+        // ── I/O instructions ─────────────────────────────────────────
+        Inst::StorePosition(src) => {
+            e.mov_r64_mem(RAX, RBP, CTX_POSITION);
+            emit_copy4(e, RAX, 0, RBX, soa(*src, 0));
+        }
+        Inst::StoreFragColor(src) => {
+            e.mov_r64_mem(RAX, RBP, CTX_FRAG_COLOR);
+            emit_copy4(e, RAX, 0, RBX, soa(*src, 0));
+        }
+        Inst::StorePointSize(src) => {
+            e.movups_load(XMM0, RBX, soa(*src, 0));
+            e.mov_r64_mem(RAX, RBP, CTX_POINT_SIZE);
+            e.movups_store(RAX, 0, XMM0);
+        }
+        Inst::LoadVarying(dst, idx) => emit_copy4(e, RBX, soa(*dst, 0), R14, soa(*idx, 0)),
+        Inst::StoreVarying(idx, src) => emit_copy4(e, R15, soa(*idx, 0), RBX, soa(*src, 0)),
+        Inst::LoadAttribute(dst, idx) => emit_copy4(e, RBX, soa(*dst, 0), R13, soa(*idx, 0)),
+        Inst::LoadUniform(dst, idx) => {
+            for c in 0..4 {
+                e.movss_load(XMM0, R12, (*idx as i32) * 16 + c * 4);
+                e.shufps(XMM0, XMM0, 0x00);
+                e.movups_store(RBX, soa(*dst, c as u32), XMM0);
+            }
+        }
+    }
+}
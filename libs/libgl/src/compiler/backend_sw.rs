@@ -244,6 +244,10 @@ impl ShaderExec {
                     r[3] - math::floor(r[3]),
                 ];
             }
+            // Single-fragment execution has no neighbours to difference.
+            Inst::DFdx(dst, _) | Inst::DFdy(dst, _) => {
+                self.regs[*dst as usize] = [0.0; 4];
+            }
             Inst::Pow(dst, base, exp) => {
                 let rb = self.regs[*base as usize];
                 let re = self.regs[*exp as usize];
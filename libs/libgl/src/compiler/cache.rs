@@ -0,0 +1,409 @@
+//! Persistent shader cache.
+//!
+//! Compiled shader IR is cached under a hash of the shader type and source,
+//! and the JIT code of a linked program under the pair of its shader keys
+//! (linking only depends on the two IRs).  Entries live in a small
+//! in-memory table and in `/System/cache/gl/<key>`, so a program compiled by
+//! an earlier run of the app skips lexing, parsing, lowering and code
+//! generation.
+//!
+//! JIT code is stored with its helper calls as [`JitCode`] relocations and
+//! patched on load.  Keys mix in [`FORMAT_VERSION`], the OS version and the
+//! CPU architecture, so a new libgl never picks up code generated by an old
+//! one (or for another ISA).  Files carry a
+//! checksum; torn or foreign files are ignored and rewritten.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use super::backend_jit::JitCode;
+use super::ir::{Inst, Program, VarInfo};
+use crate::syscall;
+use crate::types::*;
+
+/// Bump when the IR, its encoding or the JIT backends change.
+const FORMAT_VERSION: u32 = 1;
+
+const CACHE_DIR: &str = "/System/cache/gl";
+const MAGIC: &[u8; 4] = b"AGLC";
+const HEADER_LEN: usize = 20;
+/// Entries kept in memory (oldest dropped first).
+const MEMORY_ENTRIES: usize = 64;
+/// Largest entry read back from disk.
+const MAX_FILE: usize = 1 << 20;
+
+const KIND_IR: u8 = 1;
+const KIND_JIT: u8 = 2;
+
+static mut MEMORY: Vec<(u64, Vec<u8>)> = Vec::new();
+
+// ── Keys ─────────────────────────────────────────────────────────────────────
+
+const FNV_OFFSET: u64 = 0xCBF2_9CE4_8422_2325;
+const FNV_PRIME: u64 = 0x0000_0100_0000_01B3;
+
+fn fnv(mut h: u64, bytes: &[u8]) -> u64 {
+    for &b in bytes {
+        h = (h ^ b as u64).wrapping_mul(FNV_PRIME);
+    }
+    h
+}
+
+fn key_base(kind: u8) -> u64 {
+    let h = fnv(FNV_OFFSET, &FORMAT_VERSION.to_le_bytes());
+    let h = fnv(h, option_env!("ANYOS_VERSION").unwrap_or("").as_bytes());
+    let h = fnv(h, if cfg!(target_arch = "aarch64") { b"aarch64" } else { b"x86_64" });
+    fnv(h, &[kind])
+}
+
+/// Nonzero cache key of a shader's IR.
+pub fn shader_key(shader_type: GLenum, source: &str) -> u64 {
+    let h = fnv(key_base(KIND_IR), &shader_type.to_le_bytes());
+    fnv(h, source.as_bytes()) | 1
+}
+
+/// Cache key of the JIT code of a program linking the given shaders.
+pub fn program_key(vs_key: u64, fs_key: u64) -> u64 {
+    let h = fnv(key_base(KIND_JIT), &vs_key.to_le_bytes());
+    fnv(h, &fs_key.to_le_bytes()) | 1
+}
+
+// ── Storage ──────────────────────────────────────────────────────────────────
+
+/// Cached payload for `key`, from memory or disk.
+pub fn lookup(key: u64) -> Option<Vec<u8>> {
+    let memory = unsafe { &mut *core::ptr::addr_of_mut!(MEMORY) };
+    if let Some((_, data)) = memory.iter().find(|(k, _)| *k == key) {
+        return Some(data.clone());
+    }
+    let data = load_file(key)?;
+    remember(key, data.clone());
+    Some(data)
+}
+
+/// Cache `data` under `key` in memory and on disk.
+pub fn store(key: u64, data: Vec<u8>) {
+    save_file(key, &data);
+    remember(key, data);
+}
+
+fn remember(key: u64, data: Vec<u8>) {
+    let memory = unsafe { &mut *core::ptr::addr_of_mut!(MEMORY) };
+    if memory.len() >= MEMORY_ENTRIES {
+        memory.remove(0);
+    }
+    memory.push((key, data));
+}
+
+fn path(key: u64) -> String {
+    let mut p = String::from(CACHE_DIR);
+    p.push('/');
+    for i in (0..16).rev() {
+        let nibble = ((key >> (i * 4)) & 0xF) as u8;
+        p.push(if nibble < 10 { (b'0' + nibble) as char } else { (b'a' + nibble - 10) as char });
+    }
+    p
+}
+
+fn load_file(key: u64) -> Option<Vec<u8>> {
+    let fd = syscall::open(&path(key), 0);
+    if fd == u32::MAX {
+        return None;
+    }
+    let size = syscall::file_size(fd) as usize;
+    let mut buf = Vec::new();
+    if (HEADER_LEN..=MAX_FILE).contains(&size) {
+        buf.resize(size, 0);
+        let mut got = 0;
+        while got < size {
+            let n = syscall::read(fd, &mut buf[got..]);
+            if n == 0 || n == u32::MAX {
+                break;
+            }
+            got += n as usize;
+        }
+        buf.truncate(got);
+    }
+    syscall::close(fd);
+
+    let mut r = Reader::new(&buf);
+    if r.bytes(4)? != MAGIC || r.u32()? != FORMAT_VERSION || r.u64()? != key {
+        return None;
+    }
+    let sum = r.u32()?;
+    let payload = &buf[HEADER_LEN..];
+    if fnv(FNV_OFFSET, payload) as u32 != sum {
+        return None;
+    }
+    Some(Vec::from(payload))
+}
+
+fn save_file(key: u64, data: &[u8]) {
+    let mut w = Writer::new();
+    w.bytes(MAGIC);
+    w.u32(FORMAT_VERSION);
+    w.u64(key);
+    w.u32(fnv(FNV_OFFSET, data) as u32);
+    w.bytes(data);
+
+    // Parents first; failures (already exists, read-only volume) surface below.
+    syscall::mkdir("/System/cache");
+    syscall::mkdir(CACHE_DIR);
+    let fd = syscall::open(&path(key), syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC);
+    if fd == u32::MAX {
+        return;
+    }
+    syscall::write(fd, &w.buf);
+    syscall::close(fd);
+}
+
+// ── Encoding ─────────────────────────────────────────────────────────────────
+
+struct Writer {
+    buf: Vec<u8>,
+}
+
+impl Writer {
+    fn new() -> Self { Writer { buf: Vec::new() } }
+    fn u8(&mut self, v: u8) { self.buf.push(v); }
+    fn u32(&mut self, v: u32) { self.buf.extend_from_slice(&v.to_le_bytes()); }
+    fn u64(&mut self, v: u64) { self.buf.extend_from_slice(&v.to_le_bytes()); }
+    fn f32(&mut self, v: f32) { self.u32(v.to_bits()); }
+    fn bytes(&mut self, b: &[u8]) { self.buf.extend_from_slice(b); }
+}
+
+struct Reader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn new(data: &'a [u8]) -> Self { Reader { data, pos: 0 } }
+
+    fn bytes(&mut self, n: usize) -> Option<&'a [u8]> {
+        let b = self.data.get(self.pos..self.pos.checked_add(n)?)?;
+        self.pos += n;
+        Some(b)
+    }
+
+    fn u8(&mut self) -> Option<u8> { Some(self.bytes(1)?[0]) }
+
+    fn u32(&mut self) -> Option<u32> {
+        let b = self.bytes(4)?;
+        Some(u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+    }
+
+    fn u64(&mut self) -> Option<u64> {
+        let b = self.bytes(8)?;
+        let mut a = [0u8; 8];
+        a.copy_from_slice(b);
+        Some(u64::from_le_bytes(a))
+    }
+
+    fn f32(&mut self) -> Option<f32> { Some(f32::from_bits(self.u32()?)) }
+
+    fn rest(&self) -> &'a [u8] { &self.data[self.pos..] }
+}
+
+/// Instructions whose operands are all registers / indices: one tag byte
+/// followed by the operands as `u32`.  Tags are part of the file format.
+macro_rules! simple_insts {
+    ($($tag:literal => $name:ident($($f:ident),+);)*) => {
+        fn put_simple(w: &mut Writer, inst: &Inst) -> bool {
+            match *inst {
+                $(Inst::$name($($f),+) => { w.u8($tag); $(w.u32($f);)+ true })*
+                _ => false,
+            }
+        }
+
+        fn get_simple(tag: u8, r: &mut Reader) -> Option<Inst> {
+            match tag {
+                $($tag => Some(Inst::$name($({ let $f = r.u32()?; $f }),+)),)*
+                _ => None,
+            }
+        }
+    };
+}
+
+simple_insts! {
+    1 => Mov(d, s);
+    2 => Add(d, a, b);
+    3 => Sub(d, a, b);
+    4 => Mul(d, a, b);
+    5 => Div(d, a, b);
+    6 => Neg(d, s);
+    7 => Dp3(d, a, b);
+    8 => Dp4(d, a, b);
+    9 => Cross(d, a, b);
+    10 => Normalize(d, s);
+    11 => Length(d, s);
+    12 => Min(d, a, b);
+    13 => Max(d, a, b);
+    14 => Clamp(d, x, lo, hi);
+    15 => Mix(d, a, b, t);
+    16 => Abs(d, s);
+    17 => Floor(d, s);
+    18 => Fract(d, s);
+    19 => DFdx(d, s);
+    20 => DFdy(d, s);
+    21 => Pow(d, a, b);
+    22 => Sqrt(d, s);
+    23 => Rsqrt(d, s);
+    24 => Sin(d, s);
+    25 => Cos(d, s);
+    26 => Reflect(d, i, n);
+    27 => TexSample(d, u, c);
+    28 => MatMul4(d, m, v);
+    29 => MatMul3(d, m, v);
+    30 => CmpLt(d, a, b);
+    31 => CmpEq(d, a, b);
+    32 => Select(d, c, a, b);
+    33 => IntToFloat(d, s);
+    34 => FloatToInt(d, s);
+    35 => StorePosition(s);
+    36 => StoreFragColor(s);
+    37 => StorePointSize(s);
+    38 => LoadVarying(d, i);
+    39 => StoreVarying(i, s);
+    40 => LoadUniform(d, i);
+    41 => LoadAttribute(d, i);
+}
+
+const TAG_LOAD_CONST: u8 = 64;
+const TAG_SWIZZLE: u8 = 65;
+const TAG_WRITE_MASK: u8 = 66;
+
+fn put_inst(w: &mut Writer, inst: &Inst) {
+    if put_simple(w, inst) {
+        return;
+    }
+    match *inst {
+        Inst::LoadConst(d, v) => {
+            w.u8(TAG_LOAD_CONST);
+            w.u32(d);
+            for c in v {
+                w.f32(c);
+            }
+        }
+        Inst::Swizzle(d, s, idx, n) => {
+            w.u8(TAG_SWIZZLE);
+            w.u32(d);
+            w.u32(s);
+            w.bytes(&idx);
+            w.u8(n);
+        }
+        Inst::WriteMask(d, s, mask) => {
+            w.u8(TAG_WRITE_MASK);
+            w.u32(d);
+            w.u32(s);
+            w.u8(mask);
+        }
+        _ => unreachable!(),
+    }
+}
+
+fn get_inst(r: &mut Reader) -> Option<Inst> {
+    let tag = r.u8()?;
+    Some(match tag {
+        TAG_LOAD_CONST => {
+            let d = r.u32()?;
+            Inst::LoadConst(d, [r.f32()?, r.f32()?, r.f32()?, r.f32()?])
+        }
+        TAG_SWIZZLE => {
+            let (d, s) = (r.u32()?, r.u32()?);
+            let b = r.bytes(4)?;
+            Inst::Swizzle(d, s, [b[0], b[1], b[2], b[3]], r.u8()?)
+        }
+        TAG_WRITE_MASK => {
+            let (d, s) = (r.u32()?, r.u32()?);
+            Inst::WriteMask(d, s, r.u8()?)
+        }
+        _ => get_simple(tag, r)?,
+    })
+}
+
+fn put_vars(w: &mut Writer, vars: &[VarInfo]) {
+    w.u32(vars.len() as u32);
+    for v in vars {
+        w.u32(v.name.len() as u32);
+        w.bytes(v.name.as_bytes());
+        w.u32(v.components);
+        w.u32(v.reg);
+    }
+}
+
+fn get_vars(r: &mut Reader) -> Option<Vec<VarInfo>> {
+    let n = r.u32()? as usize;
+    let mut vars = Vec::with_capacity(n.min(256));
+    for _ in 0..n {
+        let len = r.u32()? as usize;
+        let name = String::from(core::str::from_utf8(r.bytes(len)?).ok()?);
+        vars.push(VarInfo { name, components: r.u32()?, reg: r.u32()? });
+    }
+    Some(vars)
+}
+
+/// Serialize shader IR.
+pub fn encode_ir(program: &Program) -> Vec<u8> {
+    let mut w = Writer::new();
+    w.u32(program.num_regs);
+    w.u32(program.instructions.len() as u32);
+    for inst in &program.instructions {
+        put_inst(&mut w, inst);
+    }
+    put_vars(&mut w, &program.attributes);
+    put_vars(&mut w, &program.varyings);
+    put_vars(&mut w, &program.uniforms);
+    put_vars(&mut w, &program.locals);
+    w.buf
+}
+
+/// Deserialize shader IR written by [`encode_ir`].
+pub fn decode_ir(data: &[u8]) -> Option<Program> {
+    let mut r = Reader::new(data);
+    let num_regs = r.u32()?;
+    let n = r.u32()? as usize;
+    let mut instructions = Vec::with_capacity(n.min(4096));
+    for _ in 0..n {
+        instructions.push(get_inst(&mut r)?);
+    }
+    Some(Program {
+        instructions,
+        num_regs,
+        attributes: get_vars(&mut r)?,
+        varyings: get_vars(&mut r)?,
+        uniforms: get_vars(&mut r)?,
+        locals: get_vars(&mut r)?,
+    })
+}
+
+/// Serialize the JIT builds of a program (`None` entries included).
+/// Returns `None` if some code cannot be relocated.
+pub fn encode_jit(codes: &[Option<&JitCode>]) -> Option<Vec<u8>> {
+    let mut out = Vec::new();
+    for code in codes {
+        match code {
+            Some(c) => {
+                out.push(1);
+                if !c.to_bytes(&mut out) {
+                    return None;
+                }
+            }
+            None => out.push(0),
+        }
+    }
+    Some(out)
+}
+
+/// Deserialize JIT builds written by [`encode_jit`]; `N` must match.
+pub fn decode_jit<const N: usize>(data: &[u8]) -> Option<[Option<JitCode>; N]> {
+    let mut out: [Option<JitCode>; N] = core::array::from_fn(|_| None);
+    let mut r = Reader::new(data);
+    for slot in out.iter_mut() {
+        if r.u8()? != 0 {
+            let (code, used) = JitCode::from_bytes(r.rest())?;
+            r.bytes(used)?;
+            *slot = Some(code);
+        }
+    }
+    Some(out)
+}
@@ -86,6 +86,12 @@ pub enum Inst {
     /// Fract: dst = fract(src)
     Fract(Reg, Reg),
 
+    /// Screen-space derivative along x: dst = dFdx(src).
+    /// Zero unless the backend shades 2×2 quads.
+    DFdx(Reg, Reg),
+    /// Screen-space derivative along y: dst = dFdy(src).
+    DFdy(Reg, Reg),
+
     /// Power: dst = pow(base, exp)
     Pow(Reg, Reg, Reg),
     /// Square root: dst = sqrt(src)
@@ -742,6 +742,20 @@ fn lower_call(ctx: &mut LowerCtx, name: &str, args: &[Expr]) -> Result<u32, Stri
             ctx.insts.push(Inst::Fract(r, a));
             Ok(r)
         }
+        "dFdx" => {
+            if args.is_empty() { return Err(String::from("dFdx requires 1 arg")); }
+            let a = lower_expr(ctx, &args[0])?;
+            let r = ctx.alloc_reg();
+            ctx.insts.push(Inst::DFdx(r, a));
+            Ok(r)
+        }
+        "dFdy" => {
+            if args.is_empty() { return Err(String::from("dFdy requires 1 arg")); }
+            let a = lower_expr(ctx, &args[0])?;
+            let r = ctx.alloc_reg();
+            ctx.insts.push(Inst::DFdy(r, a));
+            Ok(r)
+        }
         _ => {
             // Unknown function — return zero
             let r = ctx.alloc_reg();
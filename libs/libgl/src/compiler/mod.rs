@@ -3,6 +3,7 @@
 //! Pipeline: Source → [`lexer`] → Tokens → [`parser`] → AST → [`lower`] → IR.
 //! The IR is executed by [`backend_sw`] (software interpreter) or translated
 //! to DX9 SM 2.0 bytecode by [`backend_dx9`] for SVGA3D GPU acceleration.
+//! Compiled IR and JIT code are reused across runs through [`cache`].
 
 pub mod lexer;
 pub mod ast;
@@ -12,6 +13,7 @@ pub mod lower;
 pub mod backend_sw;
 pub mod backend_dx9;
 pub mod backend_jit;
+pub mod cache;
 
 use alloc::string::String;
 use crate::types::*;
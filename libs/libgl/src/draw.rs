@@ -94,7 +94,35 @@ fn gl_cull_to_svga3d(cull_face: bool, mode: GLenum) -> u32 {
     }
 }
 
+/// Interleave the program's attributes for vertices `first..first + n`
+/// into `out` (one float4 per attribute).
+fn pack_vertices(ctx: &GlContext, program: &crate::shader::GlProgram, first: GLint, out: &mut [f32]) {
+    let mut k = 0;
+    let mut vi = first;
+    while k < out.len() {
+        for attr in &program.attributes {
+            let loc = attr.location as usize;
+            let v = if loc < ctx.attribs.len() && ctx.attribs[loc].enabled {
+                let va = &ctx.attribs[loc];
+                crate::rasterizer::vertex::fetch_single_attribute(
+                    ctx, va.size, va.typ, va.stride, va.offset, va.buffer_id, vi as u32,
+                )
+            } else {
+                [0.0, 0.0, 0.0, 1.0]
+            };
+            out[k..k + 4].copy_from_slice(&v);
+            k += 4;
+        }
+        vi += 1;
+    }
+}
+
 /// Hardware-accelerated draw arrays via SVGA3D.
+///
+/// Commands accumulate in the frame's command buffer and are submitted by
+/// `gl_swap_buffers` (or glFlush); state that did not change since the
+/// last draw is not re-emitted, and a program's shaders stay defined on
+/// the device across frames.
 fn draw_arrays_hw(ctx: &mut GlContext, mode: GLenum, first: GLint, count: GLsizei) {
     use crate::svga3d::*;
     use crate::compiler::backend_dx9;
@@ -120,61 +148,54 @@ fn draw_arrays_hw(ctx: &mut GlContext, mode: GLenum, first: GLint, count: GLsize
         Some(p) if p.linked => p,
         _ => return,
     };
-
-    // 1. Compile shaders to DX9 bytecode
-    let vs_ir = match &program.vs_ir {
-        Some(ir) => ir,
-        None => return,
-    };
-    let fs_ir = match &program.fs_ir {
-        Some(ir) => ir,
-        None => return,
-    };
-
-    let (vs_bytecode, vs_consts) = backend_dx9::compile(vs_ir, true);
-    let (fs_bytecode, fs_consts) = backend_dx9::compile(fs_ir, false);
-
-    if unsafe { crate::DIAG_FRAME } < 1 {
-        crate::serial_println!("[libgl] VS bytecode ({} dwords):", vs_bytecode.len());
-        for (i, w) in vs_bytecode.iter().enumerate() {
-            crate::serial_println!("  [{:3}] 0x{:08X}", i, w);
-        }
-        crate::serial_println!("[libgl] FS bytecode ({} dwords):", fs_bytecode.len());
-        for (i, w) in fs_bytecode.iter().enumerate() {
-            crate::serial_println!("  [{:3}] 0x{:08X}", i, w);
+    let attrib_count = program.attributes.len();
+    if attrib_count == 0 { return; }
+
+    // 1. Device shaders for this link (compiled to DX9 bytecode once)
+    if svga.program(prog_id, program.link_serial).is_none() {
+        let (vs_ir, fs_ir) = match (&program.vs_ir, &program.fs_ir) {
+            (Some(vs), Some(fs)) => (vs, fs),
+            _ => return,
+        };
+        let (vs_bytecode, vs_consts) = backend_dx9::compile(vs_ir, true);
+        let (fs_bytecode, fs_consts) = backend_dx9::compile(fs_ir, false);
+
+        if unsafe { crate::DIAG_FRAME } < 1 {
+            crate::serial_println!("[libgl] VS bytecode ({} dwords):", vs_bytecode.len());
+            for (i, w) in vs_bytecode.iter().enumerate() {
+                crate::serial_println!("  [{:3}] 0x{:08X}", i, w);
+            }
+            crate::serial_println!("[libgl] FS bytecode ({} dwords):", fs_bytecode.len());
+            for (i, w) in fs_bytecode.iter().enumerate() {
+                crate::serial_println!("  [{:3}] 0x{:08X}", i, w);
+            }
+            crate::serial_println!("[libgl] VS consts: {} entries, FS consts: {} entries",
+                vs_consts.len(), fs_consts.len());
         }
-        crate::serial_println!("[libgl] VS consts: {} entries, FS consts: {} entries",
-            vs_consts.len(), fs_consts.len());
+        svga.add_program(prog_id, program.link_serial, &vs_bytecode, &fs_bytecode, vs_consts, fs_consts);
     }
+    let (vs_id, fs_id, inline_consts) = match svga.program(prog_id, program.link_serial) {
+        Some(hw) => (hw.vs_id, hw.fs_id, (hw.vs_consts.clone(), hw.fs_consts.clone())),
+        None => return,
+    };
+    svga.set_shader(SVGA3D_SHADERTYPE_VS, vs_id);
+    svga.set_shader(SVGA3D_SHADERTYPE_PS, fs_id);
 
-    // 2. Allocate and upload shaders
-    let vs_id = svga.alloc_shader();
-    let fs_id = svga.alloc_shader();
-
-    svga.cmd.shader_define(svga.context_id, vs_id, SVGA3D_SHADERTYPE_VS, &vs_bytecode);
-    svga.cmd.shader_define(svga.context_id, fs_id, SVGA3D_SHADERTYPE_PS, &fs_bytecode);
-    svga.cmd.set_shader(svga.context_id, SVGA3D_SHADERTYPE_VS, vs_id);
-    svga.cmd.set_shader(svga.context_id, SVGA3D_SHADERTYPE_PS, fs_id);
-
-    // 3. Upload uniforms as shader constants
+    // 2. Uniforms and inline constants (only changed registers are sent)
     let uniforms = rasterizer::collect_uniforms(program);
     for (i, u) in uniforms.iter().enumerate() {
-        svga.cmd.set_shader_const_f(svga.context_id, i as u32, SVGA3D_SHADERTYPE_VS, u);
-        svga.cmd.set_shader_const_f(svga.context_id, i as u32, SVGA3D_SHADERTYPE_PS, u);
+        svga.set_shader_const_f(SVGA3D_SHADERTYPE_VS, i as u32, u);
+        svga.set_shader_const_f(SVGA3D_SHADERTYPE_PS, i as u32, u);
     }
-
-    // Upload inline constants (from LoadConst instructions) to VS
-    for &(creg, vals) in &vs_consts {
-        svga.cmd.set_shader_const_f(svga.context_id, creg, SVGA3D_SHADERTYPE_VS, &vals);
+    for &(creg, vals) in &inline_consts.0 {
+        svga.set_shader_const_f(SVGA3D_SHADERTYPE_VS, creg, &vals);
     }
-    // Upload inline constants to PS
-    for &(creg, vals) in &fs_consts {
-        svga.cmd.set_shader_const_f(svga.context_id, creg, SVGA3D_SHADERTYPE_PS, &vals);
+    for &(creg, vals) in &inline_consts.1 {
+        svga.set_shader_const_f(SVGA3D_SHADERTYPE_PS, creg, &vals);
     }
 
-    // 4. Set render states from GL context
-    let cid = svga.context_id;
-    svga.cmd.set_render_states(cid, &[
+    // 3. Render states from GL context
+    svga.set_render_states(&[
         (SVGA3D_RS_ZENABLE, ctx.depth_test as u32),
         (SVGA3D_RS_ZWRITEENABLE, ctx.depth_mask as u32),
         (SVGA3D_RS_ZFUNC, gl_depth_func_to_svga3d(ctx.depth_func)),
@@ -184,63 +205,50 @@ fn draw_arrays_hw(ctx: &mut GlContext, mode: GLenum, first: GLint, count: GLsize
         (SVGA3D_RS_CULLMODE, gl_cull_to_svga3d(ctx.cull_face, ctx.cull_face_mode)),
     ]);
 
-    // 5. Create a vertex buffer surface and upload vertex data via DMA
-    //
-    // Collect vertex data into a tightly-packed interleaved buffer.
-    // For each vertex: attribute0[float4] + attribute1[float4] + ...
-    let attrib_count = program.attributes.len();
+    // 4. Vertex data: tightly-packed interleaved float4 attributes
     let vertex_stride = (attrib_count * 4 * 4) as u32; // 4 floats * 4 bytes per attrib
     let total_bytes = vertex_stride * count as u32;
 
-    // Pack vertex data into a contiguous buffer
-    let mut vertex_data: Vec<f32> = Vec::with_capacity((count as usize) * attrib_count * 4);
-    for vi in first..(first + count) {
-        for attr in &program.attributes {
-            let loc = attr.location as usize;
-            if loc < ctx.attribs.len() && ctx.attribs[loc].enabled {
-                let va = &ctx.attribs[loc];
-                let fetched = crate::rasterizer::vertex::fetch_single_attribute(
-                    ctx, va.size, va.typ, va.stride, va.offset, va.buffer_id, vi as u32,
-                );
-                vertex_data.extend_from_slice(&fetched);
-            } else {
-                vertex_data.extend_from_slice(&[0.0, 0.0, 0.0, 1.0]);
+    let (vb_sid, vb_offset, temp_vb) = match svga.upload_alloc(total_bytes) {
+        Some((offset, data)) => {
+            // Written in place; one queued SURFACE_DMA copies it over.
+            pack_vertices(ctx, program, first, data);
+            (svga.upload_vertices(offset, total_bytes), offset, false)
+        }
+        None => {
+            // No upload ring (or an oversized draw): temporary surface and
+            // a kernel-mediated DMA, which needs prior commands submitted.
+            let mut vertex_data: Vec<f32> = Vec::new();
+            vertex_data.resize((total_bytes / 4) as usize, 0.0);
+            pack_vertices(ctx, program, first, &mut vertex_data);
+
+            let vb_sid = svga.alloc_surface();
+            let vb_width_pixels = total_bytes / 4; // X8R8G8B8 = 4 bytes per pixel
+            svga.cmd.surface_define(vb_sid, SVGA3D_SURFACE_HINT_VERTEXBUFFER, SVGA3D_X8R8G8B8, vb_width_pixels, 1);
+            svga.flush();
+
+            let vb_bytes: &[u8] = unsafe {
+                core::slice::from_raw_parts(vertex_data.as_ptr() as *const u8, vertex_data.len() * 4)
+            };
+            let dma_result = crate::syscall::gpu_3d_surface_dma(vb_sid, vb_bytes, vb_width_pixels, 1);
+            if dma_result != 0 {
+                if unsafe { crate::DIAG_FRAME } < 3 {
+                    crate::serial_println!("[libgl] DRAW: DMA FAILED (ret={})", dma_result);
+                }
+                svga.cmd.surface_destroy(vb_sid);
+                return;
             }
+            (vb_sid, 0, true)
         }
-    }
-
-    // Create a vertex buffer surface
-    let vb_sid = svga.alloc_surface();
-    let vb_width_pixels = total_bytes / 4; // X8R8G8B8 = 4 bytes per pixel
-    svga.cmd.surface_define(vb_sid, SVGA3D_SURFACE_HINT_VERTEXBUFFER, SVGA3D_X8R8G8B8, vb_width_pixels, 1);
-
-    // Submit surface definition before DMA (kernel DMA needs the surface to exist)
-    svga.cmd.submit();
-
-    // DMA vertex data to the surface via kernel GMR
-    let vb_bytes: &[u8] = unsafe {
-        core::slice::from_raw_parts(
-            vertex_data.as_ptr() as *const u8,
-            vertex_data.len() * 4,
-        )
     };
-    let dma_result = crate::syscall::gpu_3d_surface_dma(vb_sid, vb_bytes, vb_width_pixels, 1);
     if unsafe { crate::DIAG_FRAME } < 3 {
-        crate::serial_println!("[libgl] DRAW: vb_sid={} vb_bytes={} dma_ret={} attribs={} verts={}",
-            vb_sid, vb_bytes.len(), dma_result, attrib_count, count);
-    }
-    if dma_result != 0 {
-        // DMA failed — clean up and bail
-        if unsafe { crate::DIAG_FRAME } < 3 {
-            crate::serial_println!("[libgl] DRAW: DMA FAILED (ret={})", dma_result);
-        }
-        svga.cmd.surface_destroy(vb_sid);
-        svga.cmd.submit();
-        return;
+        crate::serial_println!("[libgl] DRAW: vb_sid={} offset={} bytes={} attribs={} verts={}",
+            vb_sid, vb_offset, total_bytes, attrib_count, count);
     }
+
     // Build vertex declaration array
-    let mut vertex_decl_words: Vec<u32> = Vec::new();
-    for (ai, attr) in program.attributes.iter().enumerate() {
+    let mut vertex_decl_words: Vec<u32> = Vec::with_capacity(attrib_count * 9);
+    for ai in 0..attrib_count {
         let offset_in_vertex = (ai * 16) as u32; // 4 floats * 4 bytes = 16 bytes per attribute
 
         // SVGA3dVertexDecl: {
@@ -254,7 +262,7 @@ fn draw_arrays_hw(ctx: &mut GlContext, mode: GLenum, first: GLint, count: GLsize
         vertex_decl_words.push(if ai == 0 { SVGA3D_DECLUSAGE_POSITION } else { SVGA3D_DECLUSAGE_TEXCOORD }); // usage
         vertex_decl_words.push(if ai == 0 { 0 } else { (ai - 1) as u32 }); // usageIndex
         vertex_decl_words.push(vb_sid);                  // array.surfaceId
-        vertex_decl_words.push(offset_in_vertex);        // array.offset
+        vertex_decl_words.push(vb_offset + offset_in_vertex); // array.offset
         vertex_decl_words.push(vertex_stride);           // array.stride
         vertex_decl_words.push(0);                       // rangeHint.first
         vertex_decl_words.push((count - 1) as u32);      // rangeHint.last
@@ -284,24 +292,15 @@ fn draw_arrays_hw(ctx: &mut GlContext, mode: GLenum, first: GLint, count: GLsize
     ];
 
     svga.cmd.draw_primitives(
-        cid,
+        svga.context_id,
         attrib_count as u32,
         1, // 1 primitive range
         &vertex_decl_words,
         &prim_range_words,
     );
-
-    // Submit all commands
-    let draw_ret = svga.cmd.submit();
-    if unsafe { crate::DIAG_FRAME } < 3 {
-        crate::serial_println!("[libgl] DRAW: draw_submit ret={} prim_type={} prim_count={}", draw_ret, prim_type, prim_count);
+    if temp_vb {
+        // Destroyed after the draw in FIFO order
+        svga.cmd.surface_destroy(vb_sid);
     }
-
-    // Clean up: destroy vertex buffer and shaders
-    svga.cmd.surface_destroy(vb_sid);
-    svga.cmd.shader_destroy(cid, vs_id, SVGA3D_SHADERTYPE_VS);
-    svga.cmd.shader_destroy(cid, fs_id, SVGA3D_SHADERTYPE_PS);
-    svga.cmd.set_shader(cid, SVGA3D_SHADERTYPE_VS, 0); // unbind
-    svga.cmd.set_shader(cid, SVGA3D_SHADERTYPE_PS, 0);
-    svga.cmd.submit();
+    svga.maybe_flush();
 }
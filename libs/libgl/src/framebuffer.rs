@@ -2,6 +2,9 @@
 //!
 //! `SwFramebuffer` owns a color buffer (`Vec<u32>` in ARGB) and a depth buffer
 //! (`Vec<f32>` with 1.0 = far). Uses simple scalar loops for bulk clears.
+//!
+//! Alongside the depth buffer it keeps the hierarchical-Z bounds: min and
+//! max depth per `HIZ_BLOCK`×`HIZ_BLOCK` block (see [`crate::rasterizer::hiz`]).
 
 use alloc::vec;
 use alloc::vec::Vec;
@@ -16,17 +19,27 @@ pub struct SwFramebuffer {
     pub width: u32,
     /// Height in pixels.
     pub height: u32,
+    /// Lowest depth per hierarchical-Z block.
+    pub hiz_min: Vec<f32>,
+    /// Highest depth per hierarchical-Z block.
+    pub hiz_max: Vec<f32>,
+    /// Hierarchical-Z blocks per row.
+    pub hiz_cols: u32,
 }
 
 impl SwFramebuffer {
     /// Allocate a new framebuffer. All pixels cleared to 0, depth to 1.0.
     pub fn new(width: u32, height: u32) -> Self {
         let size = (width * height) as usize;
+        let (hiz_cols, blocks) = hiz_dims(width, height);
         Self {
             color: vec![0u32; size],
             depth: vec![1.0f32; size],
             width,
             height,
+            hiz_min: vec![1.0f32; blocks],
+            hiz_max: vec![1.0f32; blocks],
+            hiz_cols,
         }
     }
 
@@ -42,6 +55,8 @@ impl SwFramebuffer {
         for p in self.depth.iter_mut() {
             *p = val;
         }
+        self.hiz_min.fill(val);
+        self.hiz_max.fill(val);
     }
 
     /// Resize the framebuffer (re-allocates and clears).
@@ -51,5 +66,16 @@ impl SwFramebuffer {
         let size = (width * height) as usize;
         self.color = vec![0u32; size];
         self.depth = vec![1.0f32; size];
+        let (hiz_cols, blocks) = hiz_dims(width, height);
+        self.hiz_min = vec![1.0f32; blocks];
+        self.hiz_max = vec![1.0f32; blocks];
+        self.hiz_cols = hiz_cols;
     }
 }
+
+/// Hierarchical-Z blocks per row and in total.
+fn hiz_dims(width: u32, height: u32) -> (u32, usize) {
+    let b = crate::rasterizer::hiz::HIZ_BLOCK as u32;
+    let cols = (width + b - 1) / b;
+    (cols, (cols * ((height + b - 1) / b)) as usize)
+}
@@ -30,6 +30,7 @@ pub mod rasterizer;
 pub mod simd;
 pub mod fxaa;
 pub mod svga3d;
+pub mod workers;
 
 mod syscall;
 
@@ -158,9 +159,10 @@ pub extern "C" fn gl_swap_buffers() -> *const u32 {
             let h = svga.height;
             let sid = svga.color_sid;
 
-            // PRESENT to screen 0 so we can visually verify GPU rendering
+            // PRESENT to screen 0 so we can visually verify GPU rendering;
+            // this submits the whole frame's commands.
             svga.cmd.present(sid, &[(0, 0, w, h)]);
-            svga.cmd.submit();
+            svga.end_frame();
 
             // Readback: kernel does BLIT_SURFACE_TO_SCREEN → staging GMR
             let c = ctx();
@@ -317,15 +319,10 @@ pub extern "C" fn glViewport(x: GLint, y: GLint, width: GLsizei, height: GLsizei
     c.viewport_w = width;
     c.viewport_h = height;
 
-    // Update SVGA3D viewport if HW backend is active
+    // Update SVGA3D viewport if HW backend is active (queued with the frame)
     if unsafe { USE_HW_BACKEND } {
         if let Some(svga) = unsafe { SVGA3D.as_mut() } {
-            svga.cmd.set_viewport(
-                svga.context_id,
-                x as f32, y as f32, width as f32, height as f32,
-                0.0, 1.0,
-            );
-            svga.cmd.submit();
+            svga.set_viewport(x as f32, y as f32, width as f32, height as f32);
         }
     }
 }
@@ -374,10 +371,9 @@ pub extern "C" fn glClear(mask: GLbitfield) {
                     0, // stencil
                     &[(0, 0, w, h)],
                 );
-                let ret = svga.cmd.submit();
                 if unsafe { DIAG_FRAME } < 3 {
-                    serial_println!("[libgl] CLEAR submit: ret={} flags={} color=0x{:08X} size={}x{}",
-                        ret, clear_flags, color, w, h);
+                    serial_println!("[libgl] CLEAR queued: flags={} color=0x{:08X} size={}x{}",
+                        clear_flags, color, w, h);
                 }
             }
         }
@@ -530,7 +526,7 @@ pub extern "C" fn glBindTexture(target: GLenum, texture: GLuint) {
 /// Upload texture image data.
 #[no_mangle]
 pub extern "C" fn glTexImage2D(
-    target: GLenum, _level: GLint, internal_format: GLint,
+    target: GLenum, level: GLint, internal_format: GLint,
     width: GLsizei, height: GLsizei, _border: GLint,
     format: GLenum, _type: GLenum, data: *const GLvoid,
 ) {
@@ -555,7 +551,8 @@ pub extern "C" fn glTexImage2D(
         Some(unsafe { core::slice::from_raw_parts(data as *const u8, len) })
     };
 
-    c.textures.tex_image_2d(tex_id, width as u32, height as u32, format, data_slice);
+    if level < 0 || width < 0 || height < 0 { c.set_error(GL_INVALID_VALUE); return; }
+    c.textures.tex_image_2d(tex_id, level as u32, width as u32, height as u32, format, data_slice);
     let _ = internal_format;
 }
 
@@ -601,10 +598,20 @@ pub extern "C" fn glActiveTexture(texture: GLenum) {
     }
 }
 
-/// Generate mipmaps (no-op in Phase 1).
+/// Regenerate the mip chain of the bound texture from level 0.
+///
+/// `glTexImage2D` on level 0 already builds the chain, so this only
+/// matters after levels were replaced individually.
 #[no_mangle]
-pub extern "C" fn glGenerateMipmap(_target: GLenum) {
-    // Mipmap generation not implemented in Phase 1
+pub extern "C" fn glGenerateMipmap(target: GLenum) {
+    let c = ctx();
+    if target != GL_TEXTURE_2D { c.set_error(GL_INVALID_ENUM); return; }
+    let unit = c.active_texture_unit as usize;
+    if unit >= state::MAX_TEXTURE_UNITS { return; }
+    let tex_id = c.bound_textures[unit];
+    if let Some(tex) = c.textures.get_mut(tex_id) {
+        tex.generate_mipmaps();
+    }
 }
 
 // ══════════════════════════════════════════════════════════════════════════════
@@ -1035,13 +1042,28 @@ pub extern "C" fn glReadPixels(
     }
 }
 
-/// Flush pending operations (no-op for SW rasterizer).
+/// Flush pending operations: submits the queued SVGA3D commands (no-op
+/// for the SW rasterizer).
 #[no_mangle]
-pub extern "C" fn glFlush() {}
+pub extern "C" fn glFlush() {
+    if unsafe { USE_HW_BACKEND } {
+        if let Some(svga) = unsafe { SVGA3D.as_mut() } {
+            svga.flush();
+        }
+    }
+}
 
-/// Finish all pending operations (no-op for SW rasterizer).
+/// Finish all pending operations: submits the queued SVGA3D commands and
+/// waits for the GPU (no-op for the SW rasterizer).
 #[no_mangle]
-pub extern "C" fn glFinish() {}
+pub extern "C" fn glFinish() {
+    if unsafe { USE_HW_BACKEND } {
+        if let Some(svga) = unsafe { SVGA3D.as_mut() } {
+            svga.end_frame();
+            syscall::gpu_3d_sync();
+        }
+    }
+}
 
 // ══════════════════════════════════════════════════════════════════════════════
 //  Anti-Aliasing
@@ -1081,6 +1103,35 @@ pub extern "C" fn gl_has_hw_backend() -> u32 {
     if has_hw { 1 } else { 0 }
 }
 
+/// Reorder the triangle list `indices` (`count` entries, each below
+/// `vertex_count`) in place for post-transform cache locality.  Intended for
+/// static meshes before `glBufferData`.  Returns 1 on success, 0 if the
+/// list is malformed (left unchanged).
+#[no_mangle]
+pub extern "C" fn gl_optimize_indices(indices: *mut u32, count: u32, vertex_count: u32) -> u32 {
+    if indices.is_null() {
+        return 0;
+    }
+    let list = unsafe { core::slice::from_raw_parts_mut(indices, count as usize) };
+    if rasterizer::vcache::optimize_triangle_order(list, vertex_count as usize) { 1 } else { 0 }
+}
+
+/// Early depth rejection counters of the software rasterizer: writes up to
+/// `len` of `[triangle tiles tested, tiles rejected by hierarchical Z,
+/// fragments killed before shading]` to `out` and returns the number
+/// written.  Nonzero `reset` zeroes the counters.
+#[no_mangle]
+pub extern "C" fn gl_get_depth_stats(out: *mut u64, len: u32, reset: u32) -> u32 {
+    let stats = rasterizer::hiz::stats(reset != 0);
+    let n = (len as usize).min(stats.len());
+    if !out.is_null() {
+        for (i, &v) in stats[..n].iter().enumerate() {
+            unsafe { *out.add(i) = v };
+        }
+    }
+    n as u32
+}
+
 // ══════════════════════════════════════════════════════════════════════════════
 //  Math Functions (FPU/SSE accelerated, usable by any app)
 // ══════════════════════════════════════════════════════════════════════════════
@@ -0,0 +1,107 @@
+//! Hierarchical Z: coarse depth bounds for whole-triangle rejection.
+//!
+//! The framebuffer keeps the min and max depth of every
+//! `HIZ_BLOCK`×`HIZ_BLOCK` block.  Before a triangle is rasterized into a
+//! tile, its depth range is compared against the bounds of the blocks its
+//! footprint touches; if the depth test would fail everywhere, the triangle
+//! is skipped without setting up a single span.
+//!
+//! The bounds only need to be conservative.  They are recomputed exactly
+//! from the depth buffer after a tile is drawn (for the blocks the drawn
+//! triangles touched) and reset by `glClear`.
+//!
+//! The counters are global relaxed atomics bumped by the tile workers and
+//! read through `gl_get_depth_stats`.
+
+use core::sync::atomic::{AtomicU64, Ordering};
+use crate::types::*;
+use super::raster::RasterTarget;
+
+/// Edge length of a hierarchical-Z block, in pixels.  Divides `TILE_SIZE`,
+/// so tiles never share a block.
+pub const HIZ_BLOCK: i32 = 8;
+
+/// Depth slack for the coarse test (interpolated depth may round below the
+/// triangle's vertex range).
+const EPSILON: f32 = 1e-6;
+
+/// Triangle footprints (one per tile) tested against the bounds.
+pub static TILES_TESTED: AtomicU64 = AtomicU64::new(0);
+/// Footprints rejected without rasterizing.
+pub static TILES_REJECTED: AtomicU64 = AtomicU64::new(0);
+/// Fragments that failed the depth test before shading.
+pub static FRAGMENTS_KILLED: AtomicU64 = AtomicU64::new(0);
+
+/// Whether the depth test rejects every fragment of a triangle with screen
+/// vertices `s` inside `rect` (inclusive pixel bounds).
+pub fn occluded(target: &RasterTarget, s: &[[f32; 3]; 3], rect: &[i32; 4]) -> bool {
+    if !target.depth_test {
+        return false;
+    }
+    let tri_min = s[0][2].min(s[1][2]).min(s[2][2]);
+    let tri_max = s[0][2].max(s[1][2]).max(s[2][2]);
+    TILES_TESTED.fetch_add(1, Ordering::Relaxed);
+
+    let (bz_min, bz_max) = bounds(target, rect);
+    let hidden = match target.depth_func {
+        GL_NEVER => true,
+        GL_LESS => tri_min - EPSILON >= bz_max,
+        GL_LEQUAL => tri_min - EPSILON > bz_max,
+        GL_GREATER => tri_max + EPSILON <= bz_min,
+        GL_GEQUAL => tri_max + EPSILON < bz_min,
+        _ => false,
+    };
+    if hidden {
+        TILES_REJECTED.fetch_add(1, Ordering::Relaxed);
+    }
+    hidden
+}
+
+/// Min and max depth over the blocks covering `rect`.
+fn bounds(target: &RasterTarget, rect: &[i32; 4]) -> (f32, f32) {
+    let (mut lo, mut hi) = (f32::MAX, f32::MIN);
+    for by in rect[1] / HIZ_BLOCK..=rect[3] / HIZ_BLOCK {
+        for bx in rect[0] / HIZ_BLOCK..=rect[2] / HIZ_BLOCK {
+            let i = (by as u32 * target.hiz_cols + bx as u32) as usize;
+            unsafe {
+                lo = lo.min(*target.hiz_min.add(i));
+                hi = hi.max(*target.hiz_max.add(i));
+            }
+        }
+    }
+    (lo, hi)
+}
+
+/// Recompute the bounds of the blocks covering `rect` from the depth
+/// buffer.  `clip` (the tile) limits the pixels read: blocks never straddle
+/// tiles, so this only touches the caller's own blocks.
+pub fn refresh(target: &RasterTarget, rect: &[i32; 4], clip: &[i32; 4]) {
+    for by in rect[1] / HIZ_BLOCK..=rect[3] / HIZ_BLOCK {
+        for bx in rect[0] / HIZ_BLOCK..=rect[2] / HIZ_BLOCK {
+            let (x0, y0) = (bx * HIZ_BLOCK, by * HIZ_BLOCK);
+            let x1 = (x0 + HIZ_BLOCK - 1).min(clip[2]);
+            let y1 = (y0 + HIZ_BLOCK - 1).min(clip[3]);
+            let (mut lo, mut hi) = (f32::MAX, f32::MIN);
+            for y in y0..=y1 {
+                let row = (y as u32 * target.width) as usize;
+                for x in x0..=x1 {
+                    let d = unsafe { *target.depth.add(row + x as usize) };
+                    lo = lo.min(d);
+                    hi = hi.max(d);
+                }
+            }
+            let i = (by as u32 * target.hiz_cols + bx as u32) as usize;
+            unsafe {
+                *target.hiz_min.add(i) = lo;
+                *target.hiz_max.add(i) = hi;
+            }
+        }
+    }
+}
+
+/// Current counters `[tested, rejected, fragments killed]`, optionally
+/// resetting them.
+pub fn stats(reset: bool) -> [u64; 3] {
+    let read = |c: &AtomicU64| if reset { c.swap(0, Ordering::Relaxed) } else { c.load(Ordering::Relaxed) };
+    [read(&TILES_TESTED), read(&TILES_REJECTED), read(&FRAGMENTS_KILLED)]
+}
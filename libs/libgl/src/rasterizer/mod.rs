@@ -5,8 +5,11 @@
 //! perspective divide → viewport transform → rasterization → fragment shader →
 //! depth test + blending → framebuffer write.
 //!
+//! Triangles are set up on the calling thread, then binned into screen tiles
+//! that are rasterized in parallel (see [`tiles`]).
+//!
 //! **Performance**: Zero heap allocations in the per-pixel hot path. Fixed-size
-//! `ClipVertex`, pre-allocated `ShaderExec`, incremental edge functions, and
+//! `ClipVertex`, pre-allocated `ShaderExec` / `QuadExec`, incremental edge functions, and
 //! pre-computed perspective correction factors yield ~100–1000× speedup over
 //! the original implementation.
 
@@ -15,12 +18,17 @@ pub mod vertex;
 pub mod clipper;
 pub mod raster;
 pub mod fragment;
+pub mod tiles;
+pub mod hiz;
+pub mod vcache;
 
 use alloc::vec::Vec;
 use crate::state::GlContext;
 use crate::types::*;
 use crate::compiler::backend_sw::ShaderExec;
+use crate::compiler::ir::Program as IrProgram;
 use crate::compiler::backend_jit::{JitFn, JitContext};
+use crate::compiler::backend_jit::quad::QuadExec;
 
 /// Maximum number of interpolated varyings between vertex and fragment shaders.
 ///
@@ -96,6 +104,8 @@ pub fn draw(ctx: &mut GlContext, mode: GLenum, first: i32, count: i32) {
     // Get JIT function pointers (compiled at link time)
     let vs_jit: Option<JitFn> = program.vs_jit.as_ref().map(|j| j.as_fn());
     let fs_jit: Option<JitFn> = program.fs_jit.as_ref().map(|j| j.as_fn());
+    let vs_jit_quad: Option<JitFn> = program.vs_jit_quad.as_ref().map(|j| j.as_fn());
+    let fs_jit_quad: Option<JitFn> = program.fs_jit_quad.as_ref().map(|j| j.as_fn());
 
     // Build attribute info (stack-allocated, max 16 entries)
     let mut attrib_info = [(0i32, 0i32, 0u32, 0i32, 0usize, 0u32); 16];
@@ -114,43 +124,16 @@ pub fn draw(ctx: &mut GlContext, mode: GLenum, first: i32, count: i32) {
         crate::BOUND_TEXTURES_PTR = &ctx.bound_textures as *const _;
     }
 
-    // ── Vertex Processing (one ShaderExec reused for all vertices) ────────
-    let mut vs_exec = ShaderExec::new(vs_ir.num_regs, num_varyings);
-    let mut attrib_buf = [[0.0f32, 0.0, 0.0, 1.0]; 16];
-    let mut clip_verts = Vec::with_capacity(count as usize);
-
-    let tex_sample_addr = raster::real_tex_sample as usize;
-
-    for i in first..(first + count) {
-        vertex::fetch_attributes_into(ctx, &attrib_info[..num_attribs], i as u32, &mut attrib_buf);
-        vs_exec.reset_vertex();
-        if let Some(jit) = vs_jit {
-            let mut jit_ctx = JitContext {
-                regs: vs_exec.regs.as_mut_ptr() as *mut f32,
-                uniforms: uniforms.as_ptr() as *const f32,
-                attributes: attrib_buf.as_ptr() as *const f32,
-                varyings_in: core::ptr::null(),
-                varyings_out: vs_exec.varyings.as_mut_ptr() as *mut f32,
-                position: vs_exec.position.as_mut_ptr(),
-                frag_color: vs_exec.frag_color.as_mut_ptr(),
-                point_size: &mut vs_exec.point_size,
-                tex_sample: tex_sample_addr,
-            };
-            unsafe { jit(&mut jit_ctx); }
-        } else {
-            vs_exec.execute(&vs_ir, &attrib_buf[..num_attribs], &uniforms, None, raster::real_tex_sample);
-        }
-        clip_verts.push(ClipVertex {
-            position: vs_exec.position,
-            varyings: vs_exec.varyings,
-            num_varyings,
-        });
-    }
+    // ── Vertex Processing ───────────────────────────────────────────────
+    let stage = VertexStage {
+        ir: &vs_ir, uniforms: &uniforms, jit: vs_jit, jit_quad: vs_jit_quad,
+        attribs: &attrib_info[..num_attribs], num_varyings,
+    };
+    let ids: Vec<u32> = (first..first + count).map(|i| i as u32).collect();
+    let mut clip_verts = Vec::with_capacity(ids.len());
+    shade_vertices(ctx, &stage, &ids, &mut clip_verts);
 
     // ── Primitive Assembly + Rasterization ───────────────────────────────
-    let fb_w = ctx.default_fb.width as i32;
-    let fb_h = ctx.default_fb.height as i32;
-
     // Try fast path: trivial FS (≤20 instructions) + bound texture + 2 varyings
     let fast = if fs_ir.instructions.len() <= 20 && num_varyings >= 2 && !ctx.blend {
         raster::ResolvedTexture::resolve_unit0().map(|tex| FastPathInfo {
@@ -163,42 +146,33 @@ pub fn draw(ctx: &mut GlContext, mode: GLenum, first: i32, count: i32) {
         None
     };
 
-    // Pre-allocate fragment shader exec (reused for all pixels in this draw call)
-    let mut fs_exec = ShaderExec::new(fs_ir.num_regs, num_varyings);
-
+    // ── Triangle setup in submission order, then tile-binned rasterization
+    let n = clip_verts.len();
+    let mut tris = Vec::with_capacity(n / 3);
     match mode {
         GL_TRIANGLES => {
             let mut i = 0;
-            while i + 2 < clip_verts.len() {
-                process_triangle(
-                    ctx, &fs_ir, &uniforms, &mut fs_exec, fs_jit, fast.as_ref(),
-                    &clip_verts[i], &clip_verts[i+1], &clip_verts[i+2],
-                    num_varyings, fb_w, fb_h,
-                );
+            while i + 2 < n {
+                setup_triangle(ctx, &mut clip_verts, [i, i + 1, i + 2], &mut tris);
                 i += 3;
             }
         }
         GL_TRIANGLE_STRIP => {
-            for i in 0..clip_verts.len().saturating_sub(2) {
-                let (a, b, c) = if i % 2 == 0 {
-                    (&clip_verts[i], &clip_verts[i+1], &clip_verts[i+2])
-                } else {
-                    (&clip_verts[i+1], &clip_verts[i], &clip_verts[i+2])
-                };
-                process_triangle(ctx, &fs_ir, &uniforms, &mut fs_exec, fs_jit, fast.as_ref(), a, b, c, num_varyings, fb_w, fb_h);
+            for i in 0..n.saturating_sub(2) {
+                let idx = if i % 2 == 0 { [i, i + 1, i + 2] } else { [i + 1, i, i + 2] };
+                setup_triangle(ctx, &mut clip_verts, idx, &mut tris);
             }
         }
         GL_TRIANGLE_FAN => {
-            for i in 1..clip_verts.len().saturating_sub(1) {
-                process_triangle(
-                    ctx, &fs_ir, &uniforms, &mut fs_exec, fs_jit, fast.as_ref(),
-                    &clip_verts[0], &clip_verts[i], &clip_verts[i+1],
-                    num_varyings, fb_w, fb_h,
-                );
+            for i in 1..n.saturating_sub(1) {
+                setup_triangle(ctx, &mut clip_verts, [0, i, i + 1], &mut tris);
             }
         }
         _ => {} // GL_LINES, GL_POINTS — Phase 2
     }
+
+    let shading = tiles::Shading { fs_ir: &fs_ir, uniforms: &uniforms, fs_jit, fs_jit_quad, fast, num_varyings };
+    tiles::rasterize(ctx, &clip_verts, &tris, &shading);
 }
 
 /// Render indexed primitives.
@@ -236,6 +210,8 @@ pub fn draw_elements(ctx: &mut GlContext, mode: GLenum, count: i32, type_: GLenu
     // Get JIT function pointers (compiled at link time)
     let vs_jit: Option<JitFn> = program.vs_jit.as_ref().map(|j| j.as_fn());
     let fs_jit: Option<JitFn> = program.fs_jit.as_ref().map(|j| j.as_fn());
+    let vs_jit_quad: Option<JitFn> = program.vs_jit_quad.as_ref().map(|j| j.as_fn());
+    let fs_jit_quad: Option<JitFn> = program.fs_jit_quad.as_ref().map(|j| j.as_fn());
 
     let mut attrib_info = [(0i32, 0i32, 0u32, 0i32, 0usize, 0u32); 16];
     let num_attribs = program.attributes.len().min(16);
@@ -282,58 +258,37 @@ pub fn draw_elements(ctx: &mut GlContext, mode: GLenum, count: i32, type_: GLenu
     }
 
     // ── Vertex Processing with post-transform cache ─────────────────────
-    let mut vs_exec = ShaderExec::new(vs_ir.num_regs, num_varyings);
-    let mut attrib_buf = [[0.0f32, 0.0, 0.0, 1.0]; 16];
-    let tex_sample_addr = raster::real_tex_sample as usize;
-
+    // For index ranges below 64K each distinct index is shaded once (in
+    // quads of 4 with the quad JIT), then fanned out to the index order;
+    // larger ranges go through the direct-mapped cache.
+    let stage = VertexStage {
+        ir: &vs_ir, uniforms: &uniforms, jit: vs_jit, jit_quad: vs_jit_quad,
+        attribs: &attrib_info[..num_attribs], num_varyings,
+    };
     let max_idx = indices.iter().copied().max().unwrap_or(0) as usize;
-    let mut cache: Vec<Option<ClipVertex>> = Vec::new();
     let use_cache = max_idx < 65536;
-    if use_cache {
-        cache.resize(max_idx + 1, None);
-    }
 
     let mut clip_verts = Vec::with_capacity(count as usize);
-    for &idx in &indices {
-        if use_cache {
-            if let Some(cached) = &cache[idx as usize] {
-                clip_verts.push(*cached);
-                continue;
+    if use_cache {
+        let mut slot = Vec::new();
+        slot.resize(max_idx + 1, u32::MAX);
+        let mut unique = Vec::new();
+        for &idx in &indices {
+            if slot[idx as usize] == u32::MAX {
+                slot[idx as usize] = unique.len() as u32;
+                unique.push(idx);
             }
         }
-        vertex::fetch_attributes_into(ctx, &attrib_info[..num_attribs], idx, &mut attrib_buf);
-        vs_exec.reset_vertex();
-        if let Some(jit) = vs_jit {
-            let mut jit_ctx = JitContext {
-                regs: vs_exec.regs.as_mut_ptr() as *mut f32,
-                uniforms: uniforms.as_ptr() as *const f32,
-                attributes: attrib_buf.as_ptr() as *const f32,
-                varyings_in: core::ptr::null(),
-                varyings_out: vs_exec.varyings.as_mut_ptr() as *mut f32,
-                position: vs_exec.position.as_mut_ptr(),
-                frag_color: vs_exec.frag_color.as_mut_ptr(),
-                point_size: &mut vs_exec.point_size,
-                tex_sample: tex_sample_addr,
-            };
-            unsafe { jit(&mut jit_ctx); }
-        } else {
-            vs_exec.execute(&vs_ir, &attrib_buf[..num_attribs], &uniforms, None, raster::real_tex_sample);
-        }
-        let cv = ClipVertex {
-            position: vs_exec.position,
-            varyings: vs_exec.varyings,
-            num_varyings,
-        };
-        if use_cache {
-            cache[idx as usize] = Some(cv);
-        }
-        clip_verts.push(cv);
+        let mut shaded = Vec::with_capacity(unique.len());
+        shade_vertices(ctx, &stage, &unique, &mut shaded);
+        clip_verts.extend(indices.iter().map(|&idx| shaded[slot[idx as usize] as usize]));
+    } else {
+        vcache::VertexCache::new().transform(&indices, &mut clip_verts, |ids, out| {
+            shade_vertices(ctx, &stage, ids, out)
+        });
     }
 
     // Rasterize
-    let fb_w = ctx.default_fb.width as i32;
-    let fb_h = ctx.default_fb.height as i32;
-
     // Try fast path (same logic as draw_arrays)
     let fast = if fs_ir.instructions.len() <= 20 && num_varyings >= 2 && !ctx.blend {
         raster::ResolvedTexture::resolve_unit0().map(|tex| FastPathInfo {
@@ -346,36 +301,107 @@ pub fn draw_elements(ctx: &mut GlContext, mode: GLenum, count: i32, type_: GLenu
         None
     };
 
-    let mut fs_exec = ShaderExec::new(fs_ir.num_regs, num_varyings);
-
+    let n = clip_verts.len();
+    let mut tris = Vec::with_capacity(n / 3);
     if mode == GL_TRIANGLES {
         let mut i = 0;
-        while i + 2 < clip_verts.len() {
-            process_triangle(
-                ctx, &fs_ir, &uniforms, &mut fs_exec, fs_jit, fast.as_ref(),
-                &clip_verts[i], &clip_verts[i+1], &clip_verts[i+2],
-                num_varyings, fb_w, fb_h,
-            );
+        while i + 2 < n {
+            setup_triangle(ctx, &mut clip_verts, [i, i + 1, i + 2], &mut tris);
             i += 3;
         }
     } else if mode == GL_TRIANGLE_STRIP {
-        for i in 0..clip_verts.len().saturating_sub(2) {
-            let (a, b, c) = if i % 2 == 0 {
-                (&clip_verts[i], &clip_verts[i+1], &clip_verts[i+2])
-            } else {
-                (&clip_verts[i+1], &clip_verts[i], &clip_verts[i+2])
-            };
-            process_triangle(ctx, &fs_ir, &uniforms, &mut fs_exec, fs_jit, fast.as_ref(), a, b, c, num_varyings, fb_w, fb_h);
+        for i in 0..n.saturating_sub(2) {
+            let idx = if i % 2 == 0 { [i, i + 1, i + 2] } else { [i + 1, i, i + 2] };
+            setup_triangle(ctx, &mut clip_verts, idx, &mut tris);
         }
     } else if mode == GL_TRIANGLE_FAN {
-        for i in 1..clip_verts.len().saturating_sub(1) {
-            process_triangle(
-                ctx, &fs_ir, &uniforms, &mut fs_exec, fs_jit, fast.as_ref(),
-                &clip_verts[0], &clip_verts[i], &clip_verts[i+1],
-                num_varyings, fb_w, fb_h,
-            );
+        for i in 1..n.saturating_sub(1) {
+            setup_triangle(ctx, &mut clip_verts, [0, i, i + 1], &mut tris);
         }
     }
+
+    let shading = tiles::Shading { fs_ir: &fs_ir, uniforms: &uniforms, fs_jit, fs_jit_quad, fast, num_varyings };
+    tiles::rasterize(ctx, &clip_verts, &tris, &shading);
+}
+
+/// Vertex stage of a draw call.
+struct VertexStage<'a> {
+    ir: &'a IrProgram,
+    uniforms: &'a [[f32; 4]],
+    jit: Option<JitFn>,
+    jit_quad: Option<JitFn>,
+    /// Attribute fetch info (location, size, type, stride, offset, buffer).
+    attribs: &'a [(i32, i32, GLenum, i32, usize, u32)],
+    num_varyings: usize,
+}
+
+/// Run the vertex shader for vertices `ids`, appending the results to `out`.
+///
+/// With the quad JIT, vertices are shaded four per call (attributes
+/// transposed to SoA); otherwise one `ShaderExec` is reused for all.
+fn shade_vertices(ctx: &GlContext, vs: &VertexStage, ids: &[u32], out: &mut Vec<ClipVertex>) {
+    let mut attrib_buf = [[0.0f32, 0.0, 0.0, 1.0]; 16];
+    let num_attribs = vs.attribs.len();
+    let num_varyings = vs.num_varyings;
+
+    if let Some(jit) = vs.jit_quad {
+        let mut exec = QuadExec::new();
+        let mut attrib_soa = [[[0.0f32; 4]; 4]; 16];
+        for chunk in ids.chunks(4) {
+            // Short last chunk: spare lanes repeat the first vertex
+            for lane in 0..4 {
+                let id = chunk[if lane < chunk.len() { lane } else { 0 }];
+                vertex::fetch_attributes_into(ctx, vs.attribs, id, &mut attrib_buf);
+                for a in 0..num_attribs {
+                    for c in 0..4 {
+                        attrib_soa[a][c][lane] = attrib_buf[a][c];
+                    }
+                }
+            }
+            exec.run(jit, vs.uniforms, &attrib_soa, None, (1 << chunk.len()) - 1);
+            for lane in 0..chunk.len() {
+                let mut cv = ClipVertex::zeroed();
+                cv.num_varyings = num_varyings;
+                for c in 0..4 {
+                    cv.position[c] = exec.position[c][lane];
+                    for vi in 0..num_varyings {
+                        cv.varyings[vi][c] = exec.varyings[vi][c][lane];
+                    }
+                }
+                out.push(cv);
+            }
+        }
+        return;
+    }
+
+    let mut vs_exec = ShaderExec::new(vs.ir.num_regs, num_varyings);
+    let tex_sample_addr = raster::real_tex_sample as usize;
+    for &id in ids {
+        vertex::fetch_attributes_into(ctx, vs.attribs, id, &mut attrib_buf);
+        vs_exec.reset_vertex();
+        if let Some(jit) = vs.jit {
+            let mut jit_ctx = JitContext {
+                regs: vs_exec.regs.as_mut_ptr() as *mut f32,
+                uniforms: vs.uniforms.as_ptr() as *const f32,
+                attributes: attrib_buf.as_ptr() as *const f32,
+                varyings_in: core::ptr::null(),
+                varyings_out: vs_exec.varyings.as_mut_ptr() as *mut f32,
+                position: vs_exec.position.as_mut_ptr(),
+                frag_color: vs_exec.frag_color.as_mut_ptr(),
+                point_size: &mut vs_exec.point_size,
+                tex_sample: tex_sample_addr,
+                coverage: 1,
+            };
+            unsafe { jit(&mut jit_ctx); }
+        } else {
+            vs_exec.execute(vs.ir, &attrib_buf[..num_attribs], vs.uniforms, None, raster::real_tex_sample);
+        }
+        out.push(ClipVertex {
+            position: vs_exec.position,
+            varyings: vs_exec.varyings,
+            num_varyings,
+        });
+    }
 }
 
 /// Fast-path triangle parameters (resolved once per draw call).
@@ -386,46 +412,28 @@ pub struct FastPathInfo {
     pub mat_b: f32,
 }
 
-/// Process a single triangle: clip → cull → rasterize.
+/// Set up a single triangle: clip → cull → viewport transform.
 ///
 /// Uses trivial-accept test to skip clipping for fully visible triangles.
-/// When `fast` is `Some`, uses the fast-path rasterizer (zero per-pixel calls).
-fn process_triangle(
-    ctx: &mut GlContext,
-    fs_ir: &crate::compiler::ir::Program,
-    uniforms: &[[f32; 4]],
-    fs_exec: &mut ShaderExec,
-    fs_jit: Option<JitFn>,
-    fast: Option<&FastPathInfo>,
-    v0: &ClipVertex,
-    v1: &ClipVertex,
-    v2: &ClipVertex,
-    num_varyings: usize,
-    fb_w: i32,
-    fb_h: i32,
+/// Vertices created by clipping are appended to `verts`; surviving
+/// triangles are appended to `tris` in submission order.
+fn setup_triangle(
+    ctx: &GlContext,
+    verts: &mut Vec<ClipVertex>,
+    idx: [usize; 3],
+    tris: &mut Vec<tiles::SetupTri>,
 ) {
+    let (v0, v1, v2) = (&verts[idx[0]], &verts[idx[1]], &verts[idx[2]]);
+
     // Fast path: if all vertices are inside the frustum, skip clipping entirely
     if trivially_inside(v0) && trivially_inside(v1) && trivially_inside(v2) {
-        let s0 = to_screen(&v0.position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h);
-        let s1 = to_screen(&v1.position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h);
-        let s2 = to_screen(&v2.position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h);
-
-        if ctx.cull_face {
-            let area = edge_function(&s0, &s1, &s2);
-            let front = match ctx.front_face { GL_CCW => area < 0.0, _ => area > 0.0 };
-            let cull = match ctx.cull_face_mode {
-                GL_FRONT => front,
-                GL_BACK => !front,
-                GL_FRONT_AND_BACK => true,
-                _ => false,
-            };
-            if cull { return; }
-        }
-
-        if let Some(fp) = fast {
-            raster::rasterize_triangle_fast(ctx, &fp.tex, fp.mat_r, fp.mat_g, fp.mat_b, v0, v1, v2, &s0, &s1, &s2, fb_w, fb_h);
-        } else {
-            raster::rasterize_triangle(ctx, fs_ir, uniforms, fs_exec, fs_jit, v0, v1, v2, &s0, &s1, &s2, num_varyings, fb_w, fb_h);
+        let s = [
+            to_screen(&v0.position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h),
+            to_screen(&v1.position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h),
+            to_screen(&v2.position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h),
+        ];
+        if !is_culled(ctx, &s) {
+            tris.push(tiles::SetupTri { v: [idx[0] as u32, idx[1] as u32, idx[2] as u32], s });
         }
         return;
     }
@@ -436,25 +444,29 @@ fn process_triangle(
 
     for t in clipped.chunks(3) {
         if t.len() < 3 { continue; }
-        let s0 = to_screen(&t[0].position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h);
-        let s1 = to_screen(&t[1].position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h);
-        let s2 = to_screen(&t[2].position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h);
-
-        if ctx.cull_face {
-            let area = edge_function(&s0, &s1, &s2);
-            let front = match ctx.front_face { GL_CCW => area < 0.0, _ => area > 0.0 };
-            let cull = match ctx.cull_face_mode {
-                GL_FRONT => front, GL_BACK => !front,
-                GL_FRONT_AND_BACK => true, _ => false,
-            };
-            if cull { continue; }
-        }
+        let s = [
+            to_screen(&t[0].position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h),
+            to_screen(&t[1].position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h),
+            to_screen(&t[2].position, ctx.viewport_x, ctx.viewport_y, ctx.viewport_w, ctx.viewport_h),
+        ];
+        if is_culled(ctx, &s) { continue; }
+        let base = verts.len() as u32;
+        verts.extend_from_slice(t);
+        tris.push(tiles::SetupTri { v: [base, base + 1, base + 2], s });
+    }
+}
 
-        if let Some(fp) = fast {
-            raster::rasterize_triangle_fast(ctx, &fp.tex, fp.mat_r, fp.mat_g, fp.mat_b, &t[0], &t[1], &t[2], &s0, &s1, &s2, fb_w, fb_h);
-        } else {
-            raster::rasterize_triangle(ctx, fs_ir, uniforms, fs_exec, fs_jit, &t[0], &t[1], &t[2], &s0, &s1, &s2, t[0].num_varyings, fb_w, fb_h);
-        }
+/// Face culling test for a screen-space triangle.
+#[inline(always)]
+fn is_culled(ctx: &GlContext, s: &[[f32; 3]; 3]) -> bool {
+    if !ctx.cull_face { return false; }
+    let area = edge_function(&s[0], &s[1], &s[2]);
+    let front = match ctx.front_face { GL_CCW => area < 0.0, _ => area > 0.0 };
+    match ctx.cull_face_mode {
+        GL_FRONT => front,
+        GL_BACK => !front,
+        GL_FRONT_AND_BACK => true,
+        _ => false,
     }
 }
 
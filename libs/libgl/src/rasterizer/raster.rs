@@ -5,6 +5,11 @@
 //! Perspective-correct varyings are pre-divided by clip-space W per vertex so
 //! the per-pixel inner loop only does multiply-add chains.
 //!
+//! The general path walks each pair of scanlines in **2×2 quads**: coverage,
+//! depth, perspective weight and varyings of the quad are computed in SIMD
+//! lanes (`Vec4` / `Vec4x4`), then the quad JIT shades all four pixels in
+//! one call (falling back to one invocation per covered pixel).
+//!
 //! **Zero heap allocation**: varying interpolation uses a stack buffer, and the
 //! `ShaderExec` is passed in pre-allocated from the draw call.
 
@@ -13,23 +18,78 @@ use crate::types::*;
 use crate::compiler::ir::Program as IrProgram;
 use crate::compiler::backend_sw::ShaderExec;
 use crate::compiler::backend_jit::{JitFn, JitContext};
-use crate::simd::Vec4;
+use crate::compiler::backend_jit::quad::{QuadExec, QUAD_PIXELS};
+use crate::simd::{Vec4, Vec4x4};
 use super::ClipVertex;
+use core::sync::atomic::Ordering::Relaxed;
 use super::fragment;
+use super::hiz;
 use super::MAX_VARYINGS;
+use crate::texture::GlTexture;
+
+/// Framebuffer and per-fragment state triangles are drawn with.
+///
+/// Plain pointers so the tile workers can share one copy: each tile only
+/// touches the pixels inside its own rectangle, so no locking is needed.
+#[derive(Clone, Copy)]
+pub struct RasterTarget {
+    pub color: *mut u32,
+    pub depth: *mut f32,
+    pub width: u32,
+    pub depth_test: bool,
+    pub depth_func: GLenum,
+    pub depth_mask: bool,
+    pub blend: bool,
+    pub blend_src: GLenum,
+    pub blend_dst: GLenum,
+    /// Hierarchical-Z bounds (see [`super::hiz`]).
+    pub hiz_min: *mut f32,
+    pub hiz_max: *mut f32,
+    pub hiz_cols: u32,
+}
+
+unsafe impl Send for RasterTarget {}
+unsafe impl Sync for RasterTarget {}
+
+impl RasterTarget {
+    /// Capture the default framebuffer and fragment state of `ctx`.
+    pub fn new(ctx: &mut GlContext) -> Self {
+        RasterTarget {
+            color: ctx.default_fb.color.as_mut_ptr(),
+            depth: ctx.default_fb.depth.as_mut_ptr(),
+            width: ctx.default_fb.width,
+            depth_test: ctx.depth_test,
+            depth_func: ctx.depth_func,
+            depth_mask: ctx.depth_mask,
+            blend: ctx.blend,
+            blend_src: ctx.blend_src_rgb,
+            blend_dst: ctx.blend_dst_rgb,
+            hiz_min: ctx.default_fb.hiz_min.as_mut_ptr(),
+            hiz_max: ctx.default_fb.hiz_max.as_mut_ptr(),
+            hiz_cols: ctx.default_fb.hiz_cols,
+        }
+    }
+}
 
 /// Rasterize a single triangle with incremental edge functions.
 ///
+/// Only pixels inside `clip` (inclusive `[x0, y0, x1, y1]`, within the
+/// framebuffer) are written.
+///
 /// `fs_exec` is a pre-allocated fragment shader execution context, reused
 /// across all triangles in a draw call to eliminate per-pixel allocation.
 /// `fs_jit` is an optional JIT-compiled fragment shader — if present, it is
 /// used instead of the interpreter for a ~10–20× per-pixel speedup.
+/// `fs_jit_quad` is the quad build of the same shader; if present it shades
+/// each 2×2 quad in one call (in `quad_exec`) and provides derivatives.
 pub fn rasterize_triangle(
-    ctx: &mut GlContext,
+    target: &RasterTarget,
     fs_ir: &IrProgram,
     uniforms: &[[f32; 4]],
     fs_exec: &mut ShaderExec,
     fs_jit: Option<JitFn>,
+    quad_exec: &mut QuadExec,
+    fs_jit_quad: Option<JitFn>,
     v0: &ClipVertex,
     v1: &ClipVertex,
     v2: &ClipVertex,
@@ -37,14 +97,13 @@ pub fn rasterize_triangle(
     s1: &[f32; 3],
     s2: &[f32; 3],
     num_varyings: usize,
-    fb_w: i32,
-    fb_h: i32,
+    clip: &[i32; 4],
 ) {
     // ── Bounding box ─────────────────────────────────────────────────────
-    let min_x = min3(s0[0], s1[0], s2[0]).max(0.0) as i32;
-    let max_x = (super::math::ceil(max3(s0[0], s1[0], s2[0])) as i32).min(fb_w - 1);
-    let min_y = min3(s0[1], s1[1], s2[1]).max(0.0) as i32;
-    let max_y = (super::math::ceil(max3(s0[1], s1[1], s2[1])) as i32).min(fb_h - 1);
+    let min_x = (min3(s0[0], s1[0], s2[0]).max(0.0) as i32).max(clip[0]);
+    let max_x = (super::math::ceil(max3(s0[0], s1[0], s2[0])) as i32).min(clip[2]);
+    let min_y = (min3(s0[1], s1[1], s2[1]).max(0.0) as i32).max(clip[1]);
+    let max_y = (super::math::ceil(max3(s0[1], s1[1], s2[1])) as i32).min(clip[3]);
 
     if min_x > max_x || min_y > max_y { return; }
 
@@ -91,7 +150,7 @@ pub fn rasterize_triangle(
     let z1 = s1[2];
     let z2 = s2[2];
 
-    let fb_width = ctx.default_fb.width;
+    let fb_width = target.width;
     let tex_sample = real_tex_sample;
     let tex_sample_addr = real_tex_sample as usize;
 
@@ -133,175 +192,244 @@ pub fn rasterize_triangle(
         a01 = -a01; b01 = -b01;
     }
 
-    // Stack-allocated varying interpolation buffer (zero heap alloc)
-    let mut varying_buf = [[0.0f32; 4]; MAX_VARYINGS];
-
-    let depth_test_enabled = ctx.depth_test;
-    let depth_func = ctx.depth_func;
-    let depth_mask = ctx.depth_mask;
-    let blend_enabled = ctx.blend;
-    let blend_src = ctx.blend_src_rgb;
-    let blend_dst = ctx.blend_dst_rgb;
-
-    // ── Scanline loop with span clipping ─────────────────────────────────
+    // Stack-allocated varying interpolation buffers (zero heap alloc):
+    // SoA `[varying][component][lane]` for the quad JIT, AoS per pixel
+    // for the single-pixel JIT and the interpreter
+    let mut varying_soa = [[[0.0f32; 4]; 4]; MAX_VARYINGS];
+    let mut varying_buf = [[[0.0f32; 4]; MAX_VARYINGS]; 4];
+
+    // Triangle constants broadcast for the 2×2 quad loop.  Quad lanes are
+    // 0 = (x, y), 1 = (x+1, y), 2 = (x, y+1), 3 = (x+1, y+1).
+    let zero = Vec4::zero();
+    let lane_dx = Vec4::new(0.0, 1.0, 0.0, 1.0);
+    let lane_dy = Vec4::new(0.0, 0.0, 1.0, 1.0);
+    let step = |a: f32, b: f32| lane_dx.mul(Vec4::splat(a)).add(lane_dy.mul(Vec4::splat(b)));
+    let (e0_lanes, e1_lanes, e2_lanes) = (step(a12, b12), step(a20, b20), step(a01, b01));
+    let (a12_quad, a20_quad, a01_quad) = (Vec4::splat(a12 * 2.0), Vec4::splat(a20 * 2.0), Vec4::splat(a01 * 2.0));
+    let inv_area_v = Vec4::splat(inv_area);
+    let (z0_v, z1_v, z2_v) = (Vec4::splat(z0), Vec4::splat(z1), Vec4::splat(z2));
+    let (inv_w0_v, inv_w1_v, inv_w2_v) = (Vec4::splat(inv_w0c), Vec4::splat(inv_w1c), Vec4::splat(inv_w2c));
+
+    let depth_test_enabled = target.depth_test;
+    let depth_func = target.depth_func;
+    let depth_mask = target.depth_mask;
+    let blend_enabled = target.blend;
+    let blend_src = target.blend_src;
+    let blend_dst = target.blend_dst;
+    let mut killed = 0u32;
+
+    // ── Quad-row loop with span clipping ─────────────────────────────────
     // Instead of scanning min_x..max_x and testing every pixel, we compute
     // the exact x range where all 3 edge functions are ≥ 0 per scanline.
     // For a sphere with 320 thin triangles, this eliminates ~95% of rejected
-    // pixel iterations (from ~7M down to ~50K).
-
-    for py in min_y..=max_y {
-        // ── Compute exact x span for this scanline ──────────────────
-        // Each edge: w(x) = w_row + a*(x-min_x).
-        // a > 0: left bound at x = min_x + ceil(-w_row/a) when w_row < 0
-        // a < 0: right bound at x = min_x + floor(w_row/|a|) when w_row >= 0
-        // a ≈ 0: whole row in/out depending on w_row sign
-        let mut span_left = min_x;
-        let mut span_right = max_x;
-        let mut empty = false;
-
-        macro_rules! edge_clip {
-            ($w:expr, $a:expr) => {
-                if !empty {
-                    let w_val: f32 = $w;
-                    let a_val: f32 = $a;
-                    if a_val > 1e-8 {
-                        if w_val < 0.0 {
-                            let x = min_x + super::math::ceil((-w_val) / a_val) as i32;
-                            if x > span_left { span_left = x; }
-                        }
-                    } else if a_val < -1e-8 {
-                        if w_val < 0.0 {
-                            empty = true;
-                        } else {
-                            let x = min_x + (w_val / (-a_val)) as i32;
-                            if x < span_right { span_right = x; }
-                        }
-                    } else if w_val < -1e-8 {
-                        empty = true;
-                    }
-                }
-            };
+    // pixel iterations (from ~7M down to ~50K).  Quads sit on even
+    // coordinates, so they never straddle a tile.
+
+    let mut qy = min_y & !1;
+    while qy <= max_y {
+        // Edge values at (min_x, qy): the row below needs one step down
+        let dy = (qy - min_y) as f32;
+        let w_row = [w0_row + b12 * dy, w1_row + b20 * dy, w2_row + b01 * dy];
+        let a = [a12, a20, a01];
+        // Union of the spans of both rows of the quad row
+        let mut span: Option<(i32, i32)> = None;
+        for row in 0..2 {
+            let y = qy + row;
+            if y < min_y || y > max_y { continue; }
+            let r = row as f32;
+            let w = [w_row[0] + b12 * r, w_row[1] + b20 * r, w_row[2] + b01 * r];
+            if let Some((l, rt)) = row_span(w, a, min_x, max_x) {
+                span = Some(match span {
+                    Some((l0, r0)) => (l0.min(l), r0.max(rt)),
+                    None => (l, rt),
+                });
+            }
         }
 
-        edge_clip!(w0_row, a12);
-        edge_clip!(w1_row, a20);
-        edge_clip!(w2_row, a01);
-
-        if !empty && span_left <= span_right {
-            // Advance edge functions from min_x to span_left
-            let dx = (span_left - min_x) as f32;
-            let mut w0 = w0_row + a12 * dx;
-            let mut w1 = w1_row + a20 * dx;
-            let mut w2 = w2_row + a01 * dx;
-
-            let row_base = py as u32 * fb_width;
-
-            for px in span_left..=span_right {
-                // Safety check (float precision at span edges)
-                if w0 >= 0.0 && w1 >= 0.0 && w2 >= 0.0 {
-                    // Barycentric coordinates
-                    let bary0 = w0 * inv_area;
-                    let bary1 = w1 * inv_area;
-                    let bary2 = w2 * inv_area;
-
-                    // Depth interpolation (screen-space linear)
-                    let depth = bary0 * z0 + bary1 * z1 + bary2 * z2;
+        if let Some((span_left, span_right)) = span {
+            let qx0 = span_left & !1;
+            let dx = (qx0 - min_x) as f32;
+
+            // Lanes in rows outside the bounding box never cover
+            let row_live = (if qy >= min_y { 0b0011 } else { 0 }) | (if qy < max_y { 0b1100 } else { 0 });
+
+            // Edge values of the 4 pixels of the quad at `qx`
+            let mut e0 = Vec4::splat(w_row[0] + a12 * dx).add(e0_lanes);
+            let mut e1 = Vec4::splat(w_row[1] + a20 * dx).add(e1_lanes);
+            let mut e2 = Vec4::splat(w_row[2] + a01 * dx).add(e2_lanes);
+
+            let mut qx = qx0;
+            while qx <= span_right {
+                // Coverage mask (safety check for float precision at span
+                // edges), minus lanes outside the bounding box
+                let col_live = (if qx >= min_x { 0b0101 } else { 0 }) | (if qx < max_x { 0b1010 } else { 0 });
+                let inside = e0.mask_ge(zero) & e1.mask_ge(zero) & e2.mask_ge(zero) & row_live & col_live;
+
+                if inside != 0 {
+                    // Barycentric coordinates, depth (screen-space linear)
+                    // and perspective weight of all 4 pixels
+                    let b0 = e0.mul(inv_area_v);
+                    let b1 = e1.mul(inv_area_v);
+                    let b2 = e2.mul(inv_area_v);
+                    let depth = b0.mul(z0_v).add(b1.mul(z1_v)).add(b2.mul(z2_v)).to_array();
+                    let inv_w = b0.mul(inv_w0_v).add(b1.mul(inv_w1_v)).add(b2.mul(inv_w2_v));
+                    let inv_w_abs = inv_w.abs().to_array();
+                    let fb_idx = |lane: usize| {
+                        ((qy as u32 + (lane as u32 >> 1)) * fb_width + qx as u32 + (lane as u32 & 1)) as usize
+                    };
 
                     // Early depth test — BEFORE varying interpolation and fragment shader
-                    let fb_idx = (row_base + px as u32) as usize;
-                    if depth_test_enabled {
-                        let current_depth = unsafe { *ctx.default_fb.depth.get_unchecked(fb_idx) };
-                        if !fragment::depth_test(depth, current_depth, depth_func) {
-                            w0 += a12;
-                            w1 += a20;
-                            w2 += a01;
+                    let mut pass = 0u32;
+                    for lane in 0..4 {
+                        if inside & (1 << lane) == 0 || inv_w_abs[lane] < 1e-10 {
                             continue;
                         }
+                        if depth_test_enabled {
+                            let current_depth = unsafe { *target.depth.add(fb_idx(lane)) };
+                            if !fragment::depth_test(depth[lane], current_depth, depth_func) {
+                                continue;
+                            }
+                        }
+                        pass |= 1 << lane;
                     }
+                    killed += (inside & !pass).count_ones();
+
+                    if pass != 0 {
+                        // Interpolate varyings with perspective correction,
+                        // one varying of all 4 pixels at a time (SoA).
+                        // Uncovered lanes are extrapolated: they are the
+                        // helper pixels derivatives are taken against.
+                        let corr = Vec4::splat(1.0).div_safe(inv_w);
+                        for vi in 0..nv {
+                            let v = Vec4x4::splat(&v0_persp[vi]).scale(b0)
+                                .add_scaled(Vec4x4::splat(&v1_persp[vi]), b1)
+                                .add_scaled(Vec4x4::splat(&v2_persp[vi]), b2)
+                                .scale(corr);
+                            if fs_jit_quad.is_some() {
+                                for c in 0..4 {
+                                    v.c[c].store(&mut varying_soa[vi][c]);
+                                }
+                            } else {
+                                let mut quad = [[0.0f32; 4]; 4];
+                                v.to_aos(&mut quad);
+                                for lane in 0..4 {
+                                    varying_buf[lane][vi] = quad[lane];
+                                }
+                            }
+                        }
 
-                    // Perspective-correct interpolation weight
-                    let inv_w = bary0 * inv_w0c + bary1 * inv_w1c + bary2 * inv_w2c;
-                    if inv_w.abs() < 1e-10 {
-                        w0 += a12;
-                        w1 += a20;
-                        w2 += a01;
-                        continue;
+                        // Whole quad in one JIT call; covered lanes only
+                        // sample textures
+                        if let Some(jit) = fs_jit_quad {
+                            quad_exec.run(jit, uniforms, &[], Some(&varying_soa), pass | QUAD_PIXELS);
+                        }
                     }
-                    // Fast reciprocal approximation (1 cycle vs ~20 for division)
-                    let corr = fast_rcp(inv_w);
 
-                    // Interpolate varyings with perspective correction (SIMD)
-                    let b0 = Vec4::splat(bary0);
-                    let b1 = Vec4::splat(bary1);
-                    let b2 = Vec4::splat(bary2);
-                    let corr_v = Vec4::splat(corr);
-
-                    for vi in 0..nv {
-                        b0.mul(Vec4::load(&v0_persp[vi]))
-                            .add(b1.mul(Vec4::load(&v1_persp[vi])))
-                            .add(b2.mul(Vec4::load(&v2_persp[vi])))
-                            .mul(corr_v)
-                            .store(&mut varying_buf[vi]);
-                    }
+                    for lane in 0..4 {
+                        if pass & (1 << lane) == 0 {
+                            continue;
+                        }
+                        let fb_idx = fb_idx(lane);
 
-                    // Run fragment shader — JIT path or interpreter fallback
-                    fs_exec.frag_color = [0.0, 0.0, 0.0, 1.0];
-                    if let Some(jit) = fs_jit {
-                        let mut jit_ctx = JitContext {
-                            regs: fs_exec.regs.as_mut_ptr() as *mut f32,
-                            uniforms: uniforms.as_ptr() as *const f32,
-                            attributes: core::ptr::null(),
-                            varyings_in: varying_buf.as_ptr() as *const f32,
-                            varyings_out: core::ptr::null_mut(),
-                            position: core::ptr::null_mut(),
-                            frag_color: fs_exec.frag_color.as_mut_ptr(),
-                            point_size: core::ptr::null_mut(),
-                            tex_sample: tex_sample_addr,
+                        // Run fragment shader — quad JIT, JIT or interpreter
+                        let fc = if fs_jit_quad.is_some() {
+                            let q = &quad_exec.frag_color;
+                            [q[0][lane], q[1][lane], q[2][lane], q[3][lane]]
+                        } else {
+                            let varyings = &varying_buf[lane];
+                            fs_exec.frag_color = [0.0, 0.0, 0.0, 1.0];
+                            if let Some(jit) = fs_jit {
+                                let mut jit_ctx = JitContext {
+                                    regs: fs_exec.regs.as_mut_ptr() as *mut f32,
+                                    uniforms: uniforms.as_ptr() as *const f32,
+                                    attributes: core::ptr::null(),
+                                    varyings_in: varyings.as_ptr() as *const f32,
+                                    varyings_out: core::ptr::null_mut(),
+                                    position: core::ptr::null_mut(),
+                                    frag_color: fs_exec.frag_color.as_mut_ptr(),
+                                    point_size: core::ptr::null_mut(),
+                                    tex_sample: tex_sample_addr,
+                                    coverage: 1,
+                                };
+                                unsafe { jit(&mut jit_ctx); }
+                            } else {
+                                fs_exec.execute(fs_ir, &[], uniforms, Some(&varyings[..nv]), tex_sample);
+                            }
+                            fs_exec.frag_color
                         };
-                        unsafe { jit(&mut jit_ctx); }
-                    } else {
-                        fs_exec.execute(fs_ir, &[], uniforms, Some(&varying_buf[..nv]), tex_sample);
-                    }
-                    let fc = fs_exec.frag_color;
-
-                    // Convert fragment color [r,g,b,a] to ARGB u32
-                    let r = (fc[0].clamp(0.0, 1.0) * 255.0) as u32;
-                    let g = (fc[1].clamp(0.0, 1.0) * 255.0) as u32;
-                    let b = (fc[2].clamp(0.0, 1.0) * 255.0) as u32;
-                    let a = (fc[3].clamp(0.0, 1.0) * 255.0) as u32;
-                    let color = (a << 24) | (r << 16) | (g << 8) | b;
-
-                    // Blending
-                    let final_color = if blend_enabled {
-                        let dst = unsafe { *ctx.default_fb.color.get_unchecked(fb_idx) };
-                        fragment::blend(color, dst, blend_src, blend_dst)
-                    } else {
-                        color
-                    };
 
-                    // Write to framebuffer
-                    unsafe {
-                        if depth_mask {
-                            *ctx.default_fb.depth.get_unchecked_mut(fb_idx) = depth;
+                        // Convert fragment color [r,g,b,a] to ARGB u32
+                        let r = (fc[0].clamp(0.0, 1.0) * 255.0) as u32;
+                        let g = (fc[1].clamp(0.0, 1.0) * 255.0) as u32;
+                        let b = (fc[2].clamp(0.0, 1.0) * 255.0) as u32;
+                        let a = (fc[3].clamp(0.0, 1.0) * 255.0) as u32;
+                        let color = (a << 24) | (r << 16) | (g << 8) | b;
+
+                        // Blending
+                        let final_color = if blend_enabled {
+                            let dst = unsafe { *target.color.add(fb_idx) };
+                            fragment::blend(color, dst, blend_src, blend_dst)
+                        } else {
+                            color
+                        };
+
+                        // Write to framebuffer
+                        unsafe {
+                            if depth_mask {
+                                *target.depth.add(fb_idx) = depth[lane];
+                            }
+                            *target.color.add(fb_idx) = final_color;
                         }
-                        *ctx.default_fb.color.get_unchecked_mut(fb_idx) = final_color;
                     }
                 }
 
-                // Step edge functions right (+1 pixel)
-                w0 += a12;
-                w1 += a20;
-                w2 += a01;
+                // Step edge functions right (+2 pixels)
+                e0 = e0.add(a12_quad);
+                e1 = e1.add(a20_quad);
+                e2 = e2.add(a01_quad);
+                qx += 2;
             }
         }
 
-        // Step edge functions down (+1 scanline)
-        w0_row += b12;
-        w1_row += b20;
-        w2_row += b01;
+        qy += 2;
+    }
+    if killed != 0 {
+        hiz::FRAGMENTS_KILLED.fetch_add(killed as u64, Relaxed);
     }
 }
 
+/// Exact `[left, right]` pixel range of one scanline where all 3 edge
+/// functions are ≥ 0, or `None` if the row is empty.
+///
+/// `w` holds the edge values at `min_x`; each edge is
+/// `w(x) = w + a * (x - min_x)`:
+/// - a > 0: left bound at x = min_x + ceil(-w/a) when w < 0
+/// - a < 0: right bound at x = min_x + floor(w/|a|) when w >= 0
+/// - a ≈ 0: whole row in/out depending on the sign of w
+#[inline(always)]
+fn row_span(w: [f32; 3], a: [f32; 3], min_x: i32, max_x: i32) -> Option<(i32, i32)> {
+    let mut left = min_x;
+    let mut right = max_x;
+    for i in 0..3 {
+        let (w_val, a_val) = (w[i], a[i]);
+        if a_val > 1e-8 {
+            if w_val < 0.0 {
+                let x = min_x + super::math::ceil((-w_val) / a_val) as i32;
+                if x > left { left = x; }
+            }
+        } else if a_val < -1e-8 {
+            if w_val < 0.0 {
+                return None;
+            }
+            let x = min_x + (w_val / (-a_val)) as i32;
+            if x < right { right = x; }
+        } else if w_val < -1e-8 {
+            return None;
+        }
+    }
+    if left <= right { Some((left, right)) } else { None }
+}
+
 /// Edge function: signed area of triangle (a, b, c).
 #[inline(always)]
 fn edge_fn(a: &[f32; 3], b: &[f32; 3], c: &[f32; 3]) -> f32 {
@@ -332,17 +460,18 @@ fn fast_rcp(x: f32) -> f32 {
 //  Fast-path rasterizer: "textured + vertex-lit" with zero per-pixel calls
 // ═══════════════════════════════════════════════════════════════════════════
 
-/// Pre-resolved texture data for the fast-path rasterizer.
+/// Pre-resolved texture for the fast-path rasterizer.
 ///
 /// Resolved once before the draw loop to avoid per-pixel indirection
 /// through the texture store.
 pub struct ResolvedTexture {
-    pub data: *const u32,
-    pub len: usize,
-    pub width: u32,
-    pub height: u32,
+    pub tex: *const GlTexture,
 }
 
+// Read-only texel data, shared by the tile workers for one draw call.
+unsafe impl Send for ResolvedTexture {}
+unsafe impl Sync for ResolvedTexture {}
+
 impl ResolvedTexture {
     /// Resolve the currently bound texture on unit 0.
     ///
@@ -355,12 +484,9 @@ impl ResolvedTexture {
             let tex_id = (*bound)[0];
             if tex_id == 0 { return None; }
             match (*store).get(tex_id) {
-                Some(tex) if tex.width > 0 && tex.height > 0 => Some(ResolvedTexture {
-                    data: tex.data.as_ptr(),
-                    len: tex.data.len(),
-                    width: tex.width,
-                    height: tex.height,
-                }),
+                Some(tex) if tex.width > 0 && tex.height > 0 && !tex.levels.is_empty() => {
+                    Some(ResolvedTexture { tex })
+                }
                 _ => None,
             }
         }
@@ -375,9 +501,10 @@ impl ResolvedTexture {
 /// - Depth test (inline compare)
 ///
 /// Varyings layout: [0] = lighting (rgb in xyz), [1] = texcoord (uv in xy).
-/// This matches the Gouraud vertex shader output.
+/// This matches the Gouraud vertex shader output.  Only pixels inside
+/// `clip` are written.
 pub fn rasterize_triangle_fast(
-    ctx: &mut GlContext,
+    target: &RasterTarget,
     tex: &ResolvedTexture,
     mat_r: f32, mat_g: f32, mat_b: f32,
     v0: &ClipVertex,
@@ -386,14 +513,13 @@ pub fn rasterize_triangle_fast(
     s0: &[f32; 3],
     s1: &[f32; 3],
     s2: &[f32; 3],
-    fb_w: i32,
-    fb_h: i32,
+    clip: &[i32; 4],
 ) {
     // ── Bounding box ─────────────────────────────────────────────────────
-    let min_x = min3(s0[0], s1[0], s2[0]).max(0.0) as i32;
-    let max_x = (super::math::ceil(max3(s0[0], s1[0], s2[0])) as i32).min(fb_w - 1);
-    let min_y = min3(s0[1], s1[1], s2[1]).max(0.0) as i32;
-    let max_y = (super::math::ceil(max3(s0[1], s1[1], s2[1])) as i32).min(fb_h - 1);
+    let min_x = (min3(s0[0], s1[0], s2[0]).max(0.0) as i32).max(clip[0]);
+    let max_x = (super::math::ceil(max3(s0[0], s1[0], s2[0])) as i32).min(clip[2]);
+    let min_y = (min3(s0[1], s1[1], s2[1]).max(0.0) as i32).max(clip[1]);
+    let max_y = (super::math::ceil(max3(s0[1], s1[1], s2[1])) as i32).min(clip[3]);
     if min_x > max_x || min_y > max_y { return; }
 
     // ── Triangle area ────────────────────────────────────────────────────
@@ -423,14 +549,28 @@ pub fn rasterize_triangle_fast(
     let v2_uv = [v2.varyings[1][0] * inv_w2c, v2.varyings[1][1] * inv_w2c];
 
     let z0 = s0[2]; let z1 = s1[2]; let z2 = s2[2];
-    let fb_width = ctx.default_fb.width;
-    let depth_test = ctx.depth_test;
-    let depth_func = ctx.depth_func;
-    let depth_mask = ctx.depth_mask;
-
-    let tex_data = tex.data;
-    let tex_w = tex.width;
-    let tex_h = tex.height;
+    let fb_width = target.width;
+    let depth_test = target.depth_test;
+    let depth_func = target.depth_func;
+    let depth_mask = target.depth_mask;
+
+    // One mip level per triangle, from the ratio of its texel area to its
+    // pixel area (the fast path has no per-pixel derivatives)
+    let tex = unsafe { &*tex.tex };
+    let mut level = 0;
+    if tex.is_mipmapped() {
+        let (du1, dv1) = (v1.varyings[1][0] - v0.varyings[1][0], v1.varyings[1][1] - v0.varyings[1][1]);
+        let (du2, dv2) = (v2.varyings[1][0] - v0.varyings[1][0], v2.varyings[1][1] - v0.varyings[1][1]);
+        let texel_area = (du1 * dv2 - du2 * dv1).abs() * tex.width as f32 * tex.height as f32;
+        let ratio = texel_area / area.abs();
+        if ratio > 1.0 {
+            let lod = 0.5 * super::math::log2(ratio);
+            level = ((lod + 0.5) as usize).min(tex.levels.len() - 1);
+        }
+    }
+    let mip = &tex.levels[level];
+    let tex_w = mip.width;
+    let tex_h = mip.height;
     let tex_w_f = tex_w as f32;
     let tex_h_f = tex_h as f32;
     let tex_w_max = (tex_w - 1) as i32;
@@ -457,6 +597,8 @@ pub fn rasterize_triangle_fast(
         a01 = -a01; b01 = -b01;
     }
 
+    let mut killed = 0u32;
+
     // ── Scanline loop with span clipping ─────────────────────────────────
     for py in min_y..=max_y {
         let mut span_left = min_x;
@@ -506,8 +648,9 @@ pub fn rasterize_triangle_fast(
                     let fb_idx = (row_base + px as u32) as usize;
 
                     if depth_test {
-                        let cur = unsafe { *ctx.default_fb.depth.get_unchecked(fb_idx) };
+                        let cur = unsafe { *target.depth.add(fb_idx) };
                         if !fragment::depth_test(depth, cur, depth_func) {
+                            killed += 1;
                             w0 += a12; w1 += a20; w2 += a01;
                             continue;
                         }
@@ -534,7 +677,7 @@ pub fn rasterize_triangle_fast(
 
                     let tx = ((u_w * tex_w_f) as i32).min(tex_w_max).max(0) as u32;
                     let ty = ((v_w * tex_h_f) as i32).min(tex_h_max).max(0) as u32;
-                    let texel = unsafe { *tex_data.add((ty * tex_w + tx) as usize) };
+                    let texel = unsafe { *mip.data.get_unchecked(mip.index(tx, ty)) };
 
                     // Inline ARGB unpack → multiply → repack
                     let tex_r = ((texel >> 16) & 0xFF) as f32;
@@ -550,9 +693,9 @@ pub fn rasterize_triangle_fast(
 
                     unsafe {
                         if depth_mask {
-                            *ctx.default_fb.depth.get_unchecked_mut(fb_idx) = depth;
+                            *target.depth.add(fb_idx) = depth;
                         }
-                        *ctx.default_fb.color.get_unchecked_mut(fb_idx) = color;
+                        *target.color.add(fb_idx) = color;
                     }
                 }
 
@@ -562,6 +705,38 @@ pub fn rasterize_triangle_fast(
 
         w0_row += b12; w1_row += b20; w2_row += b01;
     }
+    if killed != 0 {
+        hiz::FRAGMENTS_KILLED.fetch_add(killed as u64, Relaxed);
+    }
+}
+
+/// Quad texture sampler for the quad JIT: samples the covered lanes of
+/// `coverage` into `out[component][lane]`.  With [`QUAD_PIXELS`] set the
+/// lanes are a 2×2 pixel quad and the level of detail comes from their
+/// coordinate differences; otherwise level 0 is used.
+pub fn real_tex_sample_quad(unit: u32, u: &[f32; 4], v: &[f32; 4], coverage: u32, out: &mut [[f32; 4]; 4]) {
+    let tex = unsafe {
+        let bound = crate::BOUND_TEXTURES_PTR;
+        let store = crate::TEX_STORE_PTR;
+        if bound.is_null() || store.is_null() || unit as usize >= crate::state::MAX_TEXTURE_UNITS {
+            None
+        } else {
+            (*store).get((*bound)[unit as usize])
+        }
+    };
+    let lod = match tex {
+        Some(t) if coverage & QUAD_PIXELS != 0 => t.quad_lod(u, v),
+        _ => 0.0,
+    };
+    for lane in 0..4 {
+        if coverage & (1 << lane) == 0 {
+            continue;
+        }
+        let t = tex.map_or([1.0, 1.0, 1.0, 1.0], |t| t.sample_lod(u[lane], v[lane], lod));
+        for c in 0..4 {
+            out[c][lane] = t[c];
+        }
+    }
 }
 
 /// Texture sampler using raw pointers to avoid `&CTX` / `&mut CTX` aliasing.
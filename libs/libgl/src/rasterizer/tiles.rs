@@ -0,0 +1,166 @@
+//! Tile binning front end of the software rasterizer.
+//!
+//! A draw call's triangles are set up (clipped, culled, projected) in
+//! submission order on the calling thread, then sorted into
+//! `TILE_SIZE`×`TILE_SIZE` screen tiles.  Every tile is rasterized and shaded
+//! by one thread, walking its bin in submission order, so depth testing and
+//! blending within a tile follow OpenGL draw order.  A tile only touches its
+//! own rectangle of the color and depth buffers, so tiles need no locking.
+//!
+//! Draw calls covering little screen area are rasterized serially on the
+//! calling thread — waking the workers would cost more than it saves.
+//!
+//! Each triangle's footprint in a tile is first checked against the
+//! hierarchical-Z bounds ([`super::hiz`]); the bounds of the blocks a tile
+//! drew into are refreshed once its bin is done.
+
+use alloc::vec::Vec;
+use crate::state::GlContext;
+use crate::compiler::ir::Program as IrProgram;
+use crate::compiler::backend_sw::ShaderExec;
+use crate::compiler::backend_jit::JitFn;
+use crate::compiler::backend_jit::quad::QuadExec;
+use crate::workers;
+use super::hiz;
+use super::raster::{self, RasterTarget};
+use super::{ClipVertex, FastPathInfo};
+
+/// Tile edge length in pixels.
+pub const TILE_SIZE: i32 = 64;
+
+/// Summed bounding-box area (pixels) below which a draw call is
+/// rasterized serially.
+const PARALLEL_MIN_AREA: u64 = 4 * (TILE_SIZE * TILE_SIZE) as u64;
+
+/// A triangle after clipping, culling and viewport transform.
+pub struct SetupTri {
+    /// Vertex indices into the draw call's vertex list.
+    pub v: [u32; 3],
+    /// Screen-space x, y, depth per vertex.
+    pub s: [[f32; 3]; 3],
+}
+
+/// Fragment stage of a draw call (resolved once, shared by all tiles).
+pub struct Shading<'a> {
+    pub fs_ir: &'a IrProgram,
+    pub uniforms: &'a [[f32; 4]],
+    pub fs_jit: Option<JitFn>,
+    /// Quad (2×2) build of the fragment shader, preferred over `fs_jit`.
+    pub fs_jit_quad: Option<JitFn>,
+    /// Fast-path parameters when the fragment shader is the trivial
+    /// "textured + vertex-lit" one.
+    pub fast: Option<FastPathInfo>,
+    pub num_varyings: usize,
+}
+
+/// Rasterize set-up triangles into the default framebuffer of `ctx`.
+pub fn rasterize(ctx: &mut GlContext, verts: &[ClipVertex], tris: &[SetupTri], shading: &Shading) {
+    let fb_w = ctx.default_fb.width as i32;
+    let fb_h = ctx.default_fb.height as i32;
+    if tris.is_empty() || fb_w <= 0 || fb_h <= 0 { return; }
+    let target = RasterTarget::new(ctx);
+
+    let area: u64 = tris.iter()
+        .filter_map(|t| screen_bounds(t, fb_w, fb_h))
+        .map(|b| (b[2] - b[0] + 1) as u64 * (b[3] - b[1] + 1) as u64)
+        .sum();
+    if area < PARALLEL_MIN_AREA || workers::workers() == 0 {
+        let full = [0, 0, fb_w - 1, fb_h - 1];
+        let mut fs_exec = ShaderExec::new(shading.fs_ir.num_regs, shading.num_varyings);
+        let mut quad_exec = QuadExec::new();
+        let mut drawn = None;
+        for t in tris {
+            draw_triangle(&target, shading, &mut fs_exec, &mut quad_exec, verts, t, &full, &mut drawn);
+        }
+        if let (Some(rect), true) = (drawn, target.depth_mask) {
+            hiz::refresh(&target, &rect, &full);
+        }
+        return;
+    }
+
+    // ── Binning ──────────────────────────────────────────────────────────
+    let tiles_x = (fb_w + TILE_SIZE - 1) / TILE_SIZE;
+    let tiles_y = (fb_h + TILE_SIZE - 1) / TILE_SIZE;
+    let mut bins: Vec<Vec<u32>> = (0..tiles_x * tiles_y).map(|_| Vec::new()).collect();
+    for (i, t) in tris.iter().enumerate() {
+        let b = match screen_bounds(t, fb_w, fb_h) {
+            Some(b) => b,
+            None => continue,
+        };
+        for ty in b[1] / TILE_SIZE..=b[3] / TILE_SIZE {
+            for tx in b[0] / TILE_SIZE..=b[2] / TILE_SIZE {
+                bins[(ty * tiles_x + tx) as usize].push(i as u32);
+            }
+        }
+    }
+    let busy: Vec<u32> = (0..bins.len() as u32).filter(|&i| !bins[i as usize].is_empty()).collect();
+
+    // ── Parallel tile rasterization (no allocation past this point) ──────
+    workers::run(busy.len(), &|job| {
+        let tile = busy[job] as i32;
+        let x0 = (tile % tiles_x) * TILE_SIZE;
+        let y0 = (tile / tiles_x) * TILE_SIZE;
+        let clip = [x0, y0, (x0 + TILE_SIZE - 1).min(fb_w - 1), (y0 + TILE_SIZE - 1).min(fb_h - 1)];
+        let mut fs_exec = ShaderExec::new(shading.fs_ir.num_regs, shading.num_varyings);
+        let mut quad_exec = QuadExec::new();
+        let mut drawn = None;
+        for &i in &bins[tile as usize] {
+            draw_triangle(&target, shading, &mut fs_exec, &mut quad_exec, verts, &tris[i as usize], &clip, &mut drawn);
+        }
+        if let (Some(rect), true) = (drawn, target.depth_mask) {
+            hiz::refresh(&target, &rect, &clip);
+        }
+    });
+}
+
+/// Rasterize one triangle, restricted to `clip`, unless hierarchical Z
+/// shows it hidden there.  The footprint is merged into `drawn`.
+#[inline(always)]
+fn draw_triangle(
+    target: &RasterTarget,
+    shading: &Shading,
+    fs_exec: &mut ShaderExec,
+    quad_exec: &mut QuadExec,
+    verts: &[ClipVertex],
+    t: &SetupTri,
+    clip: &[i32; 4],
+    drawn: &mut Option<[i32; 4]>,
+) {
+    let b = match screen_bounds(t, clip[2] + 1, clip[3] + 1) {
+        Some(b) => b,
+        None => return,
+    };
+    let rect = [b[0].max(clip[0]), b[1].max(clip[1]), b[2], b[3]];
+    if rect[0] > rect[2] || rect[1] > rect[3] || hiz::occluded(target, &t.s, &rect) {
+        return;
+    }
+    *drawn = Some(match *drawn {
+        Some(d) => [d[0].min(rect[0]), d[1].min(rect[1]), d[2].max(rect[2]), d[3].max(rect[3])],
+        None => rect,
+    });
+
+    let (v0, v1, v2) = (&verts[t.v[0] as usize], &verts[t.v[1] as usize], &verts[t.v[2] as usize]);
+    if let Some(fp) = &shading.fast {
+        raster::rasterize_triangle_fast(
+            target, &fp.tex, fp.mat_r, fp.mat_g, fp.mat_b,
+            v0, v1, v2, &t.s[0], &t.s[1], &t.s[2], clip,
+        );
+    } else {
+        raster::rasterize_triangle(
+            target, shading.fs_ir, shading.uniforms, fs_exec, shading.fs_jit,
+            quad_exec, shading.fs_jit_quad,
+            v0, v1, v2, &t.s[0], &t.s[1], &t.s[2], shading.num_varyings, clip,
+        );
+    }
+}
+
+/// Pixel bounding box `[x0, y0, x1, y1]` of a triangle within the
+/// framebuffer (same rounding as the rasterizer), or `None` if off-screen.
+fn screen_bounds(t: &SetupTri, fb_w: i32, fb_h: i32) -> Option<[i32; 4]> {
+    let s = &t.s;
+    let x0 = s[0][0].min(s[1][0]).min(s[2][0]).max(0.0) as i32;
+    let x1 = (super::math::ceil(s[0][0].max(s[1][0]).max(s[2][0])) as i32).min(fb_w - 1);
+    let y0 = s[0][1].min(s[1][1]).min(s[2][1]).max(0.0) as i32;
+    let y1 = (super::math::ceil(s[0][1].max(s[1][1]).max(s[2][1])) as i32).min(fb_h - 1);
+    if x0 > x1 || y0 > y1 { None } else { Some([x0, y0, x1, y1]) }
+}
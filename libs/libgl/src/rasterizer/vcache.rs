@@ -0,0 +1,295 @@
+//! Post-transform vertex cache and index reordering.
+//!
+//! [`VertexCache`] is a direct-mapped cache of shaded vertices keyed by
+//! index, used by `draw_elements` when the index range is too large for a
+//! dense slot table.  Misses are collected into batches so the vertex
+//! shader still runs four vertices per call.
+//!
+//! [`optimize_triangle_order`] reorders a triangle list for locality of
+//! vertex reuse (Forsyth, "Linear-Speed Vertex Cache Optimisation").  It is
+//! meant for static meshes, run once at upload time.
+
+use alloc::vec::Vec;
+use super::ClipVertex;
+use super::math;
+
+/// Cache slots (power of two).
+pub const CACHE_SLOTS: usize = 512;
+/// Misses shaded per batch.
+pub const MISS_BATCH: usize = 64;
+
+const EMPTY: u32 = u32::MAX;
+const NOT_PENDING: u16 = u16::MAX;
+
+/// Direct-mapped post-transform cache.
+///
+/// A missing index claims its slot right away and is queued for shading;
+/// later references in the same batch resolve to the queued entry.  An
+/// entry evicted before its batch is shaded still delivers its vertex to
+/// the references recorded so far.
+pub struct VertexCache {
+    tags: Vec<u32>,
+    verts: Vec<ClipVertex>,
+    /// Batch position of the slot's pending miss, or `NOT_PENDING`.
+    pending: Vec<u16>,
+    /// Indices queued for shading.
+    batch: Vec<u32>,
+    /// `(output position, batch position)` of references to queued indices.
+    refs: Vec<(u32, u16)>,
+}
+
+impl VertexCache {
+    pub fn new() -> Self {
+        let mut verts = Vec::new();
+        verts.resize(CACHE_SLOTS, ClipVertex::zeroed());
+        let mut tags = Vec::new();
+        tags.resize(CACHE_SLOTS, EMPTY);
+        let mut pending = Vec::new();
+        pending.resize(CACHE_SLOTS, NOT_PENDING);
+        VertexCache {
+            tags, verts, pending,
+            batch: Vec::with_capacity(MISS_BATCH),
+            refs: Vec::new(),
+        }
+    }
+
+    #[inline(always)]
+    fn slot(idx: u32) -> usize {
+        // Fibonacci hash: strided index patterns spread across the slots.
+        (idx.wrapping_mul(0x9E37_79B9) >> 23) as usize & (CACHE_SLOTS - 1)
+    }
+
+    /// Produce the shaded vertex for each of `indices` into `out` (resized
+    /// to match).  `shade(ids, out)` runs the vertex shader for `ids`,
+    /// appending the results.
+    pub fn transform(
+        &mut self,
+        indices: &[u32],
+        out: &mut Vec<ClipVertex>,
+        mut shade: impl FnMut(&[u32], &mut Vec<ClipVertex>),
+    ) {
+        out.clear();
+        out.resize(indices.len(), ClipVertex::zeroed());
+        let mut shaded = Vec::with_capacity(MISS_BATCH);
+        for (k, &idx) in indices.iter().enumerate() {
+            let s = Self::slot(idx);
+            if self.tags[s] == idx {
+                match self.pending[s] {
+                    NOT_PENDING => out[k] = self.verts[s],
+                    b => self.refs.push((k as u32, b)),
+                }
+                continue;
+            }
+            if self.batch.len() == MISS_BATCH {
+                self.flush(out, &mut shaded, &mut shade);
+            }
+            self.tags[s] = idx;
+            self.pending[s] = self.batch.len() as u16;
+            self.refs.push((k as u32, self.batch.len() as u16));
+            self.batch.push(idx);
+        }
+        self.flush(out, &mut shaded, &mut shade);
+    }
+
+    fn flush(
+        &mut self,
+        out: &mut [ClipVertex],
+        shaded: &mut Vec<ClipVertex>,
+        shade: &mut impl FnMut(&[u32], &mut Vec<ClipVertex>),
+    ) {
+        if self.batch.is_empty() {
+            return;
+        }
+        shaded.clear();
+        shade(&self.batch, shaded);
+        for &(k, b) in &self.refs {
+            out[k as usize] = shaded[b as usize];
+        }
+        for (b, &idx) in self.batch.iter().enumerate() {
+            let s = Self::slot(idx);
+            if self.tags[s] == idx && self.pending[s] == b as u16 {
+                self.verts[s] = shaded[b];
+                self.pending[s] = NOT_PENDING;
+            }
+        }
+        self.batch.clear();
+        self.refs.clear();
+    }
+}
+
+// ── Forsyth triangle reordering ──────────────────────────────────────────────
+
+/// Size of the modelled LRU cache.
+const MODEL_CACHE: usize = 32;
+/// Score of the vertices of the triangle emitted last.
+const LAST_TRI_SCORE: f32 = 0.75;
+const VALENCE_BOOST_SCALE: f32 = 2.0;
+/// Valences with a precomputed boost.
+const MAX_VALENCE: usize = 32;
+
+struct Scores {
+    cache: [f32; MODEL_CACHE],
+    valence: [f32; MAX_VALENCE],
+}
+
+impl Scores {
+    fn new() -> Self {
+        let mut cache = [0.0f32; MODEL_CACHE];
+        for (i, c) in cache.iter_mut().enumerate() {
+            *c = if i < 3 {
+                LAST_TRI_SCORE
+            } else {
+                // (1 - (pos - 3) / (size - 3)) ^ 1.5
+                let x = 1.0 - (i - 3) as f32 / (MODEL_CACHE - 3) as f32;
+                x * math::sqrt(x)
+            };
+        }
+        let mut valence = [0.0f32; MAX_VALENCE];
+        for (n, v) in valence.iter_mut().enumerate().skip(1) {
+            *v = VALENCE_BOOST_SCALE / math::sqrt(n as f32);
+        }
+        Scores { cache, valence }
+    }
+
+    #[inline]
+    fn vertex(&self, cache_pos: i32, remaining: u32) -> f32 {
+        if remaining == 0 {
+            return -1.0;
+        }
+        let c = if cache_pos < 0 { 0.0 } else { self.cache[cache_pos as usize] };
+        let v = if (remaining as usize) < MAX_VALENCE {
+            self.valence[remaining as usize]
+        } else {
+            VALENCE_BOOST_SCALE / math::sqrt(remaining as f32)
+        };
+        c + v
+    }
+}
+
+/// Reorder the triangles of the list `indices` (a multiple of 3 long, every
+/// index below `vertex_count`) so shared vertices are referenced close
+/// together.  Triangle winding is preserved.  Returns `false`, leaving
+/// `indices` untouched, if the input is malformed.
+pub fn optimize_triangle_order(indices: &mut [u32], vertex_count: usize) -> bool {
+    let tri_count = indices.len() / 3;
+    if indices.len() % 3 != 0 || indices.iter().any(|&i| i as usize >= vertex_count) {
+        return false;
+    }
+    if tri_count < 2 {
+        return true;
+    }
+    let scores = Scores::new();
+
+    // Vertex → triangle adjacency (CSR); `remaining[v]` live entries.
+    let mut remaining = Vec::new();
+    remaining.resize(vertex_count, 0u32);
+    for &i in indices.iter() {
+        remaining[i as usize] += 1;
+    }
+    let mut start = Vec::with_capacity(vertex_count + 1);
+    let mut sum = 0u32;
+    for &n in &remaining {
+        start.push(sum);
+        sum += n;
+    }
+    start.push(sum);
+    let mut adj = Vec::new();
+    adj.resize(sum as usize, 0u32);
+    let mut fill = start.clone();
+    for (t, tri) in indices.chunks_exact(3).enumerate() {
+        for &v in tri {
+            adj[fill[v as usize] as usize] = t as u32;
+            fill[v as usize] += 1;
+        }
+    }
+
+    let mut cache_pos = Vec::new();
+    cache_pos.resize(vertex_count, -1i32);
+    let mut vscore = Vec::with_capacity(vertex_count);
+    for v in 0..vertex_count {
+        vscore.push(scores.vertex(-1, remaining[v]));
+    }
+    let mut tscore = Vec::with_capacity(tri_count);
+    for tri in indices.chunks_exact(3) {
+        tscore.push(tri.iter().map(|&v| vscore[v as usize]).sum::<f32>());
+    }
+    let mut emitted = Vec::new();
+    emitted.resize(tri_count, false);
+
+    let mut order: Vec<u32> = Vec::with_capacity(tri_count);
+    let mut cache: Vec<u32> = Vec::with_capacity(MODEL_CACHE + 3);
+    let mut next_cache: Vec<u32> = Vec::with_capacity(MODEL_CACHE + 3);
+    let mut scan = 0usize;
+
+    let mut best = (0..tri_count).max_by(|&a, &b| tscore[a].total_cmp(&tscore[b]));
+    while let Some(t) = best {
+        order.push(t as u32);
+        emitted[t] = true;
+        let tri = [indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]];
+
+        // Drop the triangle from its vertices' adjacency.
+        for &v in &tri {
+            let v = v as usize;
+            let (s, n) = (start[v] as usize, remaining[v] as usize);
+            if let Some(p) = adj[s..s + n].iter().position(|&a| a as usize == t) {
+                adj.swap(s + p, s + n - 1);
+                remaining[v] -= 1;
+            }
+        }
+
+        // LRU update: the triangle's vertices move to the front.
+        next_cache.clear();
+        next_cache.extend_from_slice(&tri);
+        for &v in &cache {
+            if !tri.contains(&v) {
+                next_cache.push(v);
+            }
+        }
+        for (p, &v) in next_cache.iter().enumerate() {
+            cache_pos[v as usize] = if p < MODEL_CACHE { p as i32 } else { -1 };
+        }
+        core::mem::swap(&mut cache, &mut next_cache);
+
+        // Rescore the touched vertices and their triangles; pick the best.
+        best = None;
+        let mut best_score = -1.0f32;
+        for &v in &cache {
+            let v = v as usize;
+            vscore[v] = scores.vertex(cache_pos[v], remaining[v]);
+        }
+        for &v in &cache {
+            let v = v as usize;
+            let s = start[v] as usize;
+            for &a in &adj[s..s + remaining[v] as usize] {
+                let a = a as usize;
+                let sc = vscore[indices[a * 3] as usize]
+                    + vscore[indices[a * 3 + 1] as usize]
+                    + vscore[indices[a * 3 + 2] as usize];
+                tscore[a] = sc;
+                if sc > best_score {
+                    best_score = sc;
+                    best = Some(a);
+                }
+            }
+        }
+        cache.truncate(MODEL_CACHE);
+
+        // Nothing adjacent to the cache: continue with the next triangle left.
+        if best.is_none() {
+            while scan < tri_count && emitted[scan] {
+                scan += 1;
+            }
+            if scan < tri_count {
+                best = Some(scan);
+            }
+        }
+    }
+
+    let mut reordered = Vec::with_capacity(indices.len());
+    for &t in &order {
+        let t = t as usize;
+        reordered.extend_from_slice(&indices[t * 3..t * 3 + 3]);
+    }
+    indices.copy_from_slice(&reordered);
+    true
+}
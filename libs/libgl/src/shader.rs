@@ -2,12 +2,15 @@
 //!
 //! Handles `glCreateShader`, `glShaderSource`, `glCompileShader`, `glCreateProgram`,
 //! `glAttachShader`, `glLinkProgram`, `glUseProgram`, and uniform/attribute binding.
+//! Compilation and linking go through the persistent shader cache
+//! ([`compiler::cache`]).
 
 use alloc::string::String;
 use alloc::vec::Vec;
 use crate::types::*;
 use crate::compiler;
 use crate::compiler::backend_jit::{JitCode, JitFn};
+use crate::compiler::cache;
 
 /// Maximum uniforms per program.
 pub const MAX_UNIFORMS: usize = 64;
@@ -22,6 +25,8 @@ pub struct GlShader {
     pub compiled: bool,
     pub info_log: String,
     pub ir: Option<compiler::ir::Program>,
+    /// Shader cache key of the compiled source (0 if not compiled).
+    pub cache_key: u64,
 }
 
 /// A uniform variable in a linked program.
@@ -77,6 +82,13 @@ pub struct GlProgram {
     pub vs_jit: Option<JitCode>,
     /// JIT-compiled fragment shader (cached, compiled on first draw).
     pub fs_jit: Option<JitCode>,
+    /// Quad (4-invocation) JIT build of the vertex shader.
+    pub vs_jit_quad: Option<JitCode>,
+    /// Quad (2×2 pixel) JIT build of the fragment shader.
+    pub fs_jit_quad: Option<JitCode>,
+    /// Changes on every successful link (0 = never linked); lets backends
+    /// cache per-link state under `(program id, link_serial)`.
+    pub link_serial: u32,
 }
 
 /// Storage for shader and program objects.
@@ -85,6 +97,7 @@ pub struct ShaderStore {
     programs: Vec<Option<GlProgram>>,
     next_shader_id: u32,
     next_program_id: u32,
+    next_link_serial: u32,
 }
 
 impl ShaderStore {
@@ -95,6 +108,7 @@ impl ShaderStore {
             programs: Vec::new(),
             next_shader_id: 1,
             next_program_id: 1,
+            next_link_serial: 1,
         }
     }
 
@@ -111,6 +125,7 @@ impl ShaderStore {
             compiled: false,
             info_log: String::new(),
             ir: None,
+            cache_key: 0,
         });
         id
     }
@@ -155,6 +170,9 @@ impl ShaderStore {
             attrib_bindings: Vec::new(),
             vs_jit: None,
             fs_jit: None,
+            vs_jit_quad: None,
+            fs_jit_quad: None,
+            link_serial: 0,
         });
         id
     }
@@ -178,23 +196,35 @@ impl ShaderStore {
         self.programs.get_mut(id as usize).and_then(|s| s.as_mut())
     }
 
-    /// Compile a shader from its source.
+    /// Compile a shader from its source (or take its IR from the shader cache).
     pub fn compile_shader(&mut self, id: u32) {
         let shader = match self.get_shader_mut(id) {
             Some(s) => s,
             None => return,
         };
 
+        let key = cache::shader_key(shader.shader_type, &shader.source);
+        if let Some(ir) = cache::lookup(key).and_then(|data| cache::decode_ir(&data)) {
+            shader.compiled = true;
+            shader.info_log.clear();
+            shader.ir = Some(ir);
+            shader.cache_key = key;
+            return;
+        }
+
         match compiler::compile(&shader.source, shader.shader_type) {
             Ok(ir) => {
+                cache::store(key, cache::encode_ir(&ir));
                 shader.compiled = true;
                 shader.info_log.clear();
                 shader.ir = Some(ir);
+                shader.cache_key = key;
             }
             Err(msg) => {
                 shader.compiled = false;
                 shader.info_log = msg;
                 shader.ir = None;
+                shader.cache_key = 0;
             }
         }
     }
@@ -210,6 +240,13 @@ impl ShaderStore {
             (prog.vertex_shader, prog.fragment_shader, prog.attrib_bindings.clone())
         };
 
+        let jit_key = match (self.get_shader(vs_id), self.get_shader(fs_id)) {
+            (Some(vs), Some(fs)) if vs.cache_key != 0 && fs.cache_key != 0 => {
+                cache::program_key(vs.cache_key, fs.cache_key)
+            }
+            _ => 0,
+        };
+
         let vs_ir = match self.get_shader(vs_id).and_then(|s| s.ir.clone()) {
             Some(ir) => ir,
             None => {
@@ -287,19 +324,46 @@ impl ShaderStore {
             }
         }
 
+        let link_serial = self.next_link_serial;
+        self.next_link_serial = self.next_link_serial.wrapping_add(1).max(1);
         let prog = match self.get_program_mut(program_id) {
             Some(p) => p,
             None => return,
         };
-        // JIT-compile both shaders for fast execution
-        let vs_jit = compiler::backend_jit::compile_jit(&vs_ir);
-        let fs_jit = compiler::backend_jit::compile_jit(&fs_ir);
+        // JIT-compile both shaders for fast execution (or reuse cached code)
+        let cached = if jit_key != 0 {
+            cache::lookup(jit_key).and_then(|data| cache::decode_jit::<4>(&data))
+        } else {
+            None
+        };
+        let from_cache = cached.is_some();
+        let [vs_jit, fs_jit, vs_jit_quad, fs_jit_quad] = match cached {
+            Some(codes) => codes,
+            None => {
+                let codes = [
+                    compiler::backend_jit::compile_jit(&vs_ir),
+                    compiler::backend_jit::compile_jit(&fs_ir),
+                    compiler::backend_jit::quad::compile_jit_quad(&vs_ir),
+                    compiler::backend_jit::quad::compile_jit_quad(&fs_ir),
+                ];
+                if jit_key != 0 {
+                    let refs: Vec<Option<&JitCode>> = codes.iter().map(|c| c.as_ref()).collect();
+                    if let Some(data) = cache::encode_jit(&refs) {
+                        cache::store(jit_key, data);
+                    }
+                }
+                codes
+            }
+        };
         crate::serial_println!(
-            "[libgl] JIT: VS={} ({} bytes), FS={} ({} bytes)",
+            "[libgl] JIT{}: VS={} ({} bytes, quad {}), FS={} ({} bytes, quad {})",
+            if from_cache { " (cached)" } else { "" },
             vs_jit.is_some(),
             vs_jit.as_ref().map_or(0, |j| j.code_len()),
+            vs_jit_quad.as_ref().map_or(0, |j| j.code_len()),
             fs_jit.is_some(),
             fs_jit.as_ref().map_or(0, |j| j.code_len()),
+            fs_jit_quad.as_ref().map_or(0, |j| j.code_len()),
         );
 
         prog.linked = true;
@@ -310,7 +374,10 @@ impl ShaderStore {
         prog.varying_count = varying_offset;
         prog.vs_jit = vs_jit;
         prog.fs_jit = fs_jit;
+        prog.vs_jit_quad = vs_jit_quad;
+        prog.fs_jit_quad = fs_jit_quad;
         prog.vs_ir = Some(vs_ir);
         prog.fs_ir = Some(fs_ir);
+        prog.link_serial = link_serial;
     }
 }
@@ -1,121 +1,327 @@
-//! Vec4 operations using scalar f32 arithmetic.
+//! Packed f32 vector operations for the shader interpreter and rasterizer.
 //!
-//! `Vec4` wraps `[f32; 4]` — portable pure-Rust implementation that works
-//! on both x86_64 and aarch64. On x86_64 the compiler auto-vectorizes
-//! most of these into SSE instructions anyway.
+//! `Vec4` holds one 128-bit register: `__m128` (SSE) on x86_64, `float32x4_t`
+//! (NEON) on aarch64, and a `[f32; 4]` scalar fallback elsewhere.  Each
+//! backend lives in its own `arch` module implementing the same small set of
+//! primitives; `Vec4` and `Vec4x4` are written once on top of them.
+//!
+//! x86_64 only assumes the SSE2 baseline.  `dp3`/`dp4` and `select` use
+//! SSE4.1 (`dpps`/`blendvps`) when the crate is built with that target
+//! feature and fall back to shuffles and masks otherwise.
+//!
+//! `Vec4x4` is the structure-of-arrays form for 4 pixels at once: one
+//! `Vec4` per component, each holding that component of all 4 pixels.
+//!
+//! Lane semantics match the original scalar implementation: `min`/`max`
+//! return `b` for unordered lanes, `div_safe`/`sqrt`/`rsqrt` return 0 where
+//! the scalar code did, and comparisons produce 1.0/0.0.
+
+// ── x86_64: SSE ─────────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "x86_64")]
+mod arch {
+    use core::arch::x86_64::*;
+
+    pub type Repr = __m128;
+
+    #[inline(always)] pub fn load(v: &[f32; 4]) -> Repr { unsafe { _mm_loadu_ps(v.as_ptr()) } }
+    #[inline(always)] pub fn store(a: Repr, v: &mut [f32; 4]) { unsafe { _mm_storeu_ps(v.as_mut_ptr(), a) } }
+    #[inline(always)] pub fn splat(x: f32) -> Repr { unsafe { _mm_set1_ps(x) } }
+    #[inline(always)] pub fn add(a: Repr, b: Repr) -> Repr { unsafe { _mm_add_ps(a, b) } }
+    #[inline(always)] pub fn sub(a: Repr, b: Repr) -> Repr { unsafe { _mm_sub_ps(a, b) } }
+    #[inline(always)] pub fn mul(a: Repr, b: Repr) -> Repr { unsafe { _mm_mul_ps(a, b) } }
+    #[inline(always)] pub fn div(a: Repr, b: Repr) -> Repr { unsafe { _mm_div_ps(a, b) } }
+    #[inline(always)] pub fn and(a: Repr, b: Repr) -> Repr { unsafe { _mm_and_ps(a, b) } }
+    #[inline(always)] pub fn xor(a: Repr, b: Repr) -> Repr { unsafe { _mm_xor_ps(a, b) } }
+    /// `a < b ? a : b` per lane.
+    #[inline(always)] pub fn min(a: Repr, b: Repr) -> Repr { unsafe { _mm_min_ps(a, b) } }
+    /// `a > b ? a : b` per lane.
+    #[inline(always)] pub fn max(a: Repr, b: Repr) -> Repr { unsafe { _mm_max_ps(a, b) } }
+    #[inline(always)] pub fn sqrt(a: Repr) -> Repr { unsafe { _mm_sqrt_ps(a) } }
+    /// ~12-bit reciprocal square root estimate.
+    #[inline(always)] pub fn rsqrt_est(a: Repr) -> Repr { unsafe { _mm_rsqrt_ps(a) } }
+
+    // Comparisons return all-ones lanes where true.
+    #[inline(always)] pub fn lt(a: Repr, b: Repr) -> Repr { unsafe { _mm_cmplt_ps(a, b) } }
+    #[inline(always)] pub fn ge(a: Repr, b: Repr) -> Repr { unsafe { _mm_cmpge_ps(a, b) } }
+    #[inline(always)] pub fn gt(a: Repr, b: Repr) -> Repr { unsafe { _mm_cmpgt_ps(a, b) } }
+    /// Unordered lanes (NaN) compare not-equal.
+    #[inline(always)] pub fn ne(a: Repr, b: Repr) -> Repr { unsafe { _mm_cmpneq_ps(a, b) } }
+    /// Bit i = lane i of mask `m` is set.
+    #[inline(always)] pub fn movemask(m: Repr) -> u32 { unsafe { _mm_movemask_ps(m) as u32 } }
+
+    /// `m ? a : b` per lane (`m` from a comparison).
+    #[inline(always)]
+    pub fn select(m: Repr, a: Repr, b: Repr) -> Repr {
+        #[cfg(target_feature = "sse4.1")]
+        unsafe { _mm_blendv_ps(b, a, m) }
+        #[cfg(not(target_feature = "sse4.1"))]
+        unsafe { _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)) }
+    }
+
+    /// Sum of all lanes of `a * b` (`lanes` = 3 or 4), broadcast.
+    #[inline(always)]
+    pub fn dot(a: Repr, b: Repr, lanes: usize) -> Repr {
+        #[cfg(target_feature = "sse4.1")]
+        unsafe {
+            if lanes == 3 { _mm_dp_ps(a, b, 0x7F) } else { _mm_dp_ps(a, b, 0xFF) }
+        }
+        #[cfg(not(target_feature = "sse4.1"))]
+        unsafe {
+            let mut m = _mm_mul_ps(a, b);
+            if lanes == 3 {
+                m = _mm_and_ps(m, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+            }
+            let s = _mm_add_ps(m, _mm_shuffle_ps(m, m, 0b01_00_11_10));
+            _mm_add_ps(s, _mm_shuffle_ps(s, s, 0b10_11_00_01))
+        }
+    }
 
-/// 128-bit aligned vec4, stored as 4 × f32.
+    /// Transpose the 4×4 matrix whose rows are `r`.
+    #[inline(always)]
+    pub fn transpose(r: [Repr; 4]) -> [Repr; 4] {
+        unsafe {
+            let t0 = _mm_unpacklo_ps(r[0], r[1]);
+            let t1 = _mm_unpacklo_ps(r[2], r[3]);
+            let t2 = _mm_unpackhi_ps(r[0], r[1]);
+            let t3 = _mm_unpackhi_ps(r[2], r[3]);
+            [_mm_movelh_ps(t0, t1), _mm_movehl_ps(t1, t0), _mm_movelh_ps(t2, t3), _mm_movehl_ps(t3, t2)]
+        }
+    }
+}
+
+// ── aarch64: NEON ───────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "aarch64")]
+mod arch {
+    use core::arch::aarch64::*;
+
+    pub type Repr = float32x4_t;
+
+    #[inline(always)] fn m(a: Repr) -> uint32x4_t { unsafe { vreinterpretq_u32_f32(a) } }
+    #[inline(always)] fn f(a: uint32x4_t) -> Repr { unsafe { vreinterpretq_f32_u32(a) } }
+
+    #[inline(always)] pub fn load(v: &[f32; 4]) -> Repr { unsafe { vld1q_f32(v.as_ptr()) } }
+    #[inline(always)] pub fn store(a: Repr, v: &mut [f32; 4]) { unsafe { vst1q_f32(v.as_mut_ptr(), a) } }
+    #[inline(always)] pub fn splat(x: f32) -> Repr { unsafe { vdupq_n_f32(x) } }
+    #[inline(always)] pub fn add(a: Repr, b: Repr) -> Repr { unsafe { vaddq_f32(a, b) } }
+    #[inline(always)] pub fn sub(a: Repr, b: Repr) -> Repr { unsafe { vsubq_f32(a, b) } }
+    #[inline(always)] pub fn mul(a: Repr, b: Repr) -> Repr { unsafe { vmulq_f32(a, b) } }
+    #[inline(always)] pub fn div(a: Repr, b: Repr) -> Repr { unsafe { vdivq_f32(a, b) } }
+    #[inline(always)] pub fn and(a: Repr, b: Repr) -> Repr { unsafe { f(vandq_u32(m(a), m(b))) } }
+    #[inline(always)] pub fn xor(a: Repr, b: Repr) -> Repr { unsafe { f(veorq_u32(m(a), m(b))) } }
+    /// `a < b ? a : b` per lane (not `vminq`, which propagates NaN).
+    #[inline(always)] pub fn min(a: Repr, b: Repr) -> Repr { select(lt(a, b), a, b) }
+    /// `a > b ? a : b` per lane.
+    #[inline(always)] pub fn max(a: Repr, b: Repr) -> Repr { select(gt(a, b), a, b) }
+    #[inline(always)] pub fn sqrt(a: Repr) -> Repr { unsafe { vsqrtq_f32(a) } }
+    /// ~8-bit reciprocal square root estimate.
+    #[inline(always)] pub fn rsqrt_est(a: Repr) -> Repr { unsafe { vrsqrteq_f32(a) } }
+
+    #[inline(always)] pub fn lt(a: Repr, b: Repr) -> Repr { unsafe { f(vcltq_f32(a, b)) } }
+    #[inline(always)] pub fn ge(a: Repr, b: Repr) -> Repr { unsafe { f(vcgeq_f32(a, b)) } }
+    #[inline(always)] pub fn gt(a: Repr, b: Repr) -> Repr { unsafe { f(vcgtq_f32(a, b)) } }
+    #[inline(always)] pub fn ne(a: Repr, b: Repr) -> Repr { unsafe { f(vmvnq_u32(vceqq_f32(a, b))) } }
+
+    #[inline(always)]
+    pub fn movemask(mk: Repr) -> u32 {
+        unsafe {
+            let bits = vshrq_n_u32::<31>(m(mk));
+            let weights: [u32; 4] = [1, 2, 4, 8];
+            vaddvq_u32(vmulq_u32(bits, vld1q_u32(weights.as_ptr())))
+        }
+    }
+
+    #[inline(always)]
+    pub fn select(mk: Repr, a: Repr, b: Repr) -> Repr { unsafe { vbslq_f32(m(mk), a, b) } }
+
+    #[inline(always)]
+    pub fn dot(a: Repr, b: Repr, lanes: usize) -> Repr {
+        unsafe {
+            let mut p = vmulq_f32(a, b);
+            if lanes == 3 {
+                p = vsetq_lane_f32::<3>(0.0, p);
+            }
+            vdupq_n_f32(vaddvq_f32(p))
+        }
+    }
+
+    #[inline(always)]
+    pub fn transpose(r: [Repr; 4]) -> [Repr; 4] {
+        unsafe {
+            let t01 = vtrnq_f32(r[0], r[1]);
+            let t23 = vtrnq_f32(r[2], r[3]);
+            let lo = |x: Repr| vget_low_f32(x);
+            let hi = |x: Repr| vget_high_f32(x);
+            [
+                vcombine_f32(lo(t01.0), lo(t23.0)),
+                vcombine_f32(lo(t01.1), lo(t23.1)),
+                vcombine_f32(hi(t01.0), hi(t23.0)),
+                vcombine_f32(hi(t01.1), hi(t23.1)),
+            ]
+        }
+    }
+}
+
+// ── Scalar fallback ─────────────────────────────────────────────────────────
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+mod arch {
+    pub type Repr = [f32; 4];
+
+    const TRUE: f32 = f32::from_bits(u32::MAX);
+
+    #[inline(always)]
+    fn map2(a: Repr, b: Repr, op: impl Fn(f32, f32) -> f32) -> Repr {
+        [op(a[0], b[0]), op(a[1], b[1]), op(a[2], b[2]), op(a[3], b[3])]
+    }
+    #[inline(always)]
+    fn bits2(a: Repr, b: Repr, op: impl Fn(u32, u32) -> u32) -> Repr {
+        map2(a, b, |x, y| f32::from_bits(op(x.to_bits(), y.to_bits())))
+    }
+    #[inline(always)]
+    fn cmp(a: Repr, b: Repr, op: impl Fn(f32, f32) -> bool) -> Repr {
+        map2(a, b, |x, y| if op(x, y) { TRUE } else { 0.0 })
+    }
+
+    #[inline(always)] pub fn load(v: &[f32; 4]) -> Repr { *v }
+    #[inline(always)] pub fn store(a: Repr, v: &mut [f32; 4]) { *v = a; }
+    #[inline(always)] pub fn splat(x: f32) -> Repr { [x; 4] }
+    #[inline(always)] pub fn add(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| x + y) }
+    #[inline(always)] pub fn sub(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| x - y) }
+    #[inline(always)] pub fn mul(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| x * y) }
+    #[inline(always)] pub fn div(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| x / y) }
+    #[inline(always)] pub fn and(a: Repr, b: Repr) -> Repr { bits2(a, b, |x, y| x & y) }
+    #[inline(always)] pub fn xor(a: Repr, b: Repr) -> Repr { bits2(a, b, |x, y| x ^ y) }
+    #[inline(always)] pub fn min(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| if x < y { x } else { y }) }
+    #[inline(always)] pub fn max(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| if x > y { x } else { y }) }
+    #[inline(always)] pub fn sqrt(a: Repr) -> Repr { a.map(super::scalar_sqrt) }
+    #[inline(always)] pub fn rsqrt_est(a: Repr) -> Repr { a.map(super::fast_inv_sqrt) }
+
+    #[inline(always)] pub fn lt(a: Repr, b: Repr) -> Repr { cmp(a, b, |x, y| x < y) }
+    #[inline(always)] pub fn ge(a: Repr, b: Repr) -> Repr { cmp(a, b, |x, y| x >= y) }
+    #[inline(always)] pub fn gt(a: Repr, b: Repr) -> Repr { cmp(a, b, |x, y| x > y) }
+    #[inline(always)] pub fn ne(a: Repr, b: Repr) -> Repr { cmp(a, b, |x, y| x != y) }
+
+    #[inline(always)]
+    pub fn movemask(m: Repr) -> u32 {
+        (0..4).fold(0, |acc, i| acc | ((m[i].to_bits() >> 31) << i))
+    }
+
+    #[inline(always)]
+    pub fn select(m: Repr, a: Repr, b: Repr) -> Repr {
+        [0, 1, 2, 3].map(|i| if m[i].to_bits() != 0 { a[i] } else { b[i] })
+    }
+
+    #[inline(always)]
+    pub fn dot(a: Repr, b: Repr, lanes: usize) -> Repr {
+        let mut d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        if lanes == 4 {
+            d += a[3] * b[3];
+        }
+        [d; 4]
+    }
+
+    #[inline(always)]
+    pub fn transpose(r: [Repr; 4]) -> [Repr; 4] {
+        [0, 1, 2, 3].map(|c| [r[0][c], r[1][c], r[2][c], r[3][c]])
+    }
+}
+
+// ── Vec4 ────────────────────────────────────────────────────────────────────
+
+/// 128-bit vec4 of 4 × f32 in a SIMD register.
 #[repr(C, align(16))]
 #[derive(Copy, Clone)]
-pub struct Vec4(pub [f32; 4]);
+pub struct Vec4(arch::Repr);
 
 impl Vec4 {
     /// Load 4 floats from memory.
     #[inline(always)]
     pub fn load(v: &[f32; 4]) -> Self {
-        Self(*v)
+        Self(arch::load(v))
     }
 
     /// Store 4 floats to memory.
     #[inline(always)]
     pub fn store(self, v: &mut [f32; 4]) {
-        *v = self.0;
+        arch::store(self.0, v)
+    }
+
+    /// Build from 4 lane values.
+    #[inline(always)]
+    pub fn new(x: f32, y: f32, z: f32, w: f32) -> Self {
+        Self::load(&[x, y, z, w])
+    }
+
+    /// Copy out the 4 lanes.
+    #[inline(always)]
+    pub fn to_array(self) -> [f32; 4] {
+        let mut v = [0.0; 4];
+        self.store(&mut v);
+        v
     }
 
     /// Broadcast a single f32 to all 4 lanes.
     #[inline(always)]
     pub fn splat(x: f32) -> Self {
-        Self([x, x, x, x])
+        Self(arch::splat(x))
     }
 
     /// All zeros.
     #[inline(always)]
     pub fn zero() -> Self {
-        Self([0.0; 4])
+        Self::splat(0.0)
     }
 
     /// Packed add.
     #[inline(always)]
     pub fn add(self, b: Self) -> Self {
-        Self([
-            self.0[0] + b.0[0],
-            self.0[1] + b.0[1],
-            self.0[2] + b.0[2],
-            self.0[3] + b.0[3],
-        ])
+        Self(arch::add(self.0, b.0))
     }
 
     /// Packed subtract.
     #[inline(always)]
     pub fn sub(self, b: Self) -> Self {
-        Self([
-            self.0[0] - b.0[0],
-            self.0[1] - b.0[1],
-            self.0[2] - b.0[2],
-            self.0[3] - b.0[3],
-        ])
+        Self(arch::sub(self.0, b.0))
     }
 
     /// Packed multiply.
     #[inline(always)]
     pub fn mul(self, b: Self) -> Self {
-        Self([
-            self.0[0] * b.0[0],
-            self.0[1] * b.0[1],
-            self.0[2] * b.0[2],
-            self.0[3] * b.0[3],
-        ])
+        Self(arch::mul(self.0, b.0))
     }
 
     /// Packed divide with zero protection.
     /// Lanes where `b == 0.0` produce `0.0` instead of NaN/inf.
     #[inline(always)]
     pub fn div_safe(self, b: Self) -> Self {
-        Self([
-            if b.0[0] != 0.0 { self.0[0] / b.0[0] } else { 0.0 },
-            if b.0[1] != 0.0 { self.0[1] / b.0[1] } else { 0.0 },
-            if b.0[2] != 0.0 { self.0[2] / b.0[2] } else { 0.0 },
-            if b.0[3] != 0.0 { self.0[3] / b.0[3] } else { 0.0 },
-        ])
+        let nonzero = arch::ne(b.0, arch::splat(0.0));
+        Self(arch::and(arch::div(self.0, b.0), nonzero))
     }
 
     /// Packed negate.
     #[inline(always)]
     pub fn neg(self) -> Self {
-        Self([-self.0[0], -self.0[1], -self.0[2], -self.0[3]])
+        Self(arch::xor(self.0, arch::splat(-0.0)))
     }
 
     /// Packed absolute value.
     #[inline(always)]
     pub fn abs(self) -> Self {
-        Self([
-            f32::from_bits(self.0[0].to_bits() & 0x7FFFFFFF),
-            f32::from_bits(self.0[1].to_bits() & 0x7FFFFFFF),
-            f32::from_bits(self.0[2].to_bits() & 0x7FFFFFFF),
-            f32::from_bits(self.0[3].to_bits() & 0x7FFFFFFF),
-        ])
+        Self(arch::and(self.0, arch::splat(f32::from_bits(0x7FFF_FFFF))))
     }
 
     /// Packed minimum.
     #[inline(always)]
     pub fn min(self, b: Self) -> Self {
-        Self([
-            if self.0[0] < b.0[0] { self.0[0] } else { b.0[0] },
-            if self.0[1] < b.0[1] { self.0[1] } else { b.0[1] },
-            if self.0[2] < b.0[2] { self.0[2] } else { b.0[2] },
-            if self.0[3] < b.0[3] { self.0[3] } else { b.0[3] },
-        ])
+        Self(arch::min(self.0, b.0))
     }
 
     /// Packed maximum.
     #[inline(always)]
     pub fn max(self, b: Self) -> Self {
-        Self([
-            if self.0[0] > b.0[0] { self.0[0] } else { b.0[0] },
-            if self.0[1] > b.0[1] { self.0[1] } else { b.0[1] },
-            if self.0[2] > b.0[2] { self.0[2] } else { b.0[2] },
-            if self.0[3] > b.0[3] { self.0[3] } else { b.0[3] },
-        ])
+        Self(arch::max(self.0, b.0))
     }
 
     /// Packed clamp to [lo, hi].
@@ -130,81 +336,145 @@ impl Vec4 {
         self.add(b.sub(self).mul(t))
     }
 
-    /// Packed square root.
+    /// Packed square root; lanes `<= 0` produce 0.
     #[inline(always)]
     pub fn sqrt(self) -> Self {
-        Self([
-            scalar_sqrt(self.0[0]),
-            scalar_sqrt(self.0[1]),
-            scalar_sqrt(self.0[2]),
-            scalar_sqrt(self.0[3]),
-        ])
+        let positive = arch::gt(self.0, arch::splat(0.0));
+        Self(arch::and(arch::sqrt(self.0), positive))
     }
 
-    /// Packed reciprocal square root (fast approximation).
+    /// Packed reciprocal square root (hardware estimate + one Newton-Raphson
+    /// step); lanes `<= 0` produce 0.
     #[inline(always)]
     pub fn rsqrt(self) -> Self {
-        Self([
-            fast_inv_sqrt(self.0[0]),
-            fast_inv_sqrt(self.0[1]),
-            fast_inv_sqrt(self.0[2]),
-            fast_inv_sqrt(self.0[3]),
-        ])
+        let positive = arch::gt(self.0, arch::splat(0.0));
+        let y = arch::rsqrt_est(self.0);
+        #[cfg(any(target_arch = "x86_64", target_arch = "aarch64"))]
+        let y = {
+            // y' = y * (1.5 - 0.5 * x * y * y)
+            let hxy2 = arch::mul(arch::mul(arch::splat(0.5), self.0), arch::mul(y, y));
+            arch::mul(y, arch::sub(arch::splat(1.5), hxy2))
+        };
+        Self(arch::and(y, positive))
     }
 
     /// 3-component dot product, broadcast to all lanes.
     #[inline(always)]
     pub fn dp3(self, b: Self) -> Self {
-        let d = self.0[0] * b.0[0] + self.0[1] * b.0[1] + self.0[2] * b.0[2];
-        Self([d, d, d, d])
+        Self(arch::dot(self.0, b.0, 3))
     }
 
     /// 4-component dot product, broadcast to all lanes.
     #[inline(always)]
     pub fn dp4(self, b: Self) -> Self {
-        let d = self.0[0] * b.0[0] + self.0[1] * b.0[1]
-              + self.0[2] * b.0[2] + self.0[3] * b.0[3];
-        Self([d, d, d, d])
+        Self(arch::dot(self.0, b.0, 4))
     }
 
     /// Less-than comparison: returns 1.0 where true, 0.0 where false.
     #[inline(always)]
     pub fn cmp_lt(self, b: Self) -> Self {
-        Self([
-            if self.0[0] < b.0[0] { 1.0 } else { 0.0 },
-            if self.0[1] < b.0[1] { 1.0 } else { 0.0 },
-            if self.0[2] < b.0[2] { 1.0 } else { 0.0 },
-            if self.0[3] < b.0[3] { 1.0 } else { 0.0 },
-        ])
+        Self(arch::and(arch::lt(self.0, b.0), arch::splat(1.0)))
     }
 
     /// Equality comparison (with epsilon): returns 1.0 where true, 0.0 where false.
     #[inline(always)]
     pub fn cmp_eq_eps(self, b: Self) -> Self {
         const EPS: f32 = 1e-6;
-        Self([
-            if abs_f32(self.0[0] - b.0[0]) < EPS { 1.0 } else { 0.0 },
-            if abs_f32(self.0[1] - b.0[1]) < EPS { 1.0 } else { 0.0 },
-            if abs_f32(self.0[2] - b.0[2]) < EPS { 1.0 } else { 0.0 },
-            if abs_f32(self.0[3] - b.0[3]) < EPS { 1.0 } else { 0.0 },
-        ])
+        let close = arch::lt(self.sub(b).abs().0, arch::splat(EPS));
+        Self(arch::and(close, arch::splat(1.0)))
+    }
+
+    /// Bit `i` is set where lane `i` of `self >= b`.
+    #[inline(always)]
+    pub fn mask_ge(self, b: Self) -> u32 {
+        arch::movemask(arch::ge(self.0, b.0))
     }
 
     /// Select: where cond != 0.0, pick `a`; else pick `b`.
     #[inline(always)]
     pub fn select(cond: Self, a: Self, b: Self) -> Self {
-        Self([
-            if cond.0[0] != 0.0 { a.0[0] } else { b.0[0] },
-            if cond.0[1] != 0.0 { a.0[1] } else { b.0[1] },
-            if cond.0[2] != 0.0 { a.0[2] } else { b.0[2] },
-            if cond.0[3] != 0.0 { a.0[3] } else { b.0[3] },
-        ])
+        Self(arch::select(arch::ne(cond.0, arch::splat(0.0)), a.0, b.0))
     }
 
     /// Extract a single lane (0–3).
     #[inline(always)]
     pub fn lane(self, i: usize) -> f32 {
-        self.0[i]
+        self.to_array()[i]
+    }
+}
+
+// ── Vec4x4 ──────────────────────────────────────────────────────────────────
+
+/// Four vec4s in structure-of-arrays form: `c[k]` holds component `k` of
+/// all 4 elements (typically 4 neighbouring pixels).
+#[derive(Copy, Clone)]
+pub struct Vec4x4 {
+    pub c: [Vec4; 4],
+}
+
+impl Vec4x4 {
+    /// The same vec4 in all 4 elements.
+    #[inline(always)]
+    pub fn splat(v: &[f32; 4]) -> Self {
+        Self { c: [Vec4::splat(v[0]), Vec4::splat(v[1]), Vec4::splat(v[2]), Vec4::splat(v[3])] }
+    }
+
+    /// Convert 4 vec4s (array-of-structures) to SoA.
+    #[inline(always)]
+    pub fn from_aos(v: &[[f32; 4]; 4]) -> Self {
+        let t = arch::transpose([arch::load(&v[0]), arch::load(&v[1]), arch::load(&v[2]), arch::load(&v[3])]);
+        Self { c: [Vec4(t[0]), Vec4(t[1]), Vec4(t[2]), Vec4(t[3])] }
+    }
+
+    /// Convert back to 4 vec4s.
+    #[inline(always)]
+    pub fn to_aos(self, out: &mut [[f32; 4]; 4]) {
+        let t = arch::transpose([self.c[0].0, self.c[1].0, self.c[2].0, self.c[3].0]);
+        for i in 0..4 {
+            arch::store(t[i], &mut out[i]);
+        }
+    }
+
+    /// Element-wise add.
+    #[inline(always)]
+    pub fn add(self, b: Self) -> Self {
+        Self { c: [0, 1, 2, 3].map(|k| self.c[k].add(b.c[k])) }
+    }
+
+    /// Element-wise subtract.
+    #[inline(always)]
+    pub fn sub(self, b: Self) -> Self {
+        Self { c: [0, 1, 2, 3].map(|k| self.c[k].sub(b.c[k])) }
+    }
+
+    /// Element-wise multiply.
+    #[inline(always)]
+    pub fn mul(self, b: Self) -> Self {
+        Self { c: [0, 1, 2, 3].map(|k| self.c[k].mul(b.c[k])) }
+    }
+
+    /// Scale element `i` by lane `i` of `s`.
+    #[inline(always)]
+    pub fn scale(self, s: Vec4) -> Self {
+        Self { c: [0, 1, 2, 3].map(|k| self.c[k].mul(s)) }
+    }
+
+    /// `self + b * s`, with element `i` of `b` scaled by lane `i` of `s`.
+    #[inline(always)]
+    pub fn add_scaled(self, b: Self, s: Vec4) -> Self {
+        Self { c: [0, 1, 2, 3].map(|k| self.c[k].add(b.c[k].mul(s))) }
+    }
+
+    /// Per-element 3-component dot product (lane `i` = element `i`).
+    #[inline(always)]
+    pub fn dp3(self, b: Self) -> Vec4 {
+        self.c[0].mul(b.c[0]).add(self.c[1].mul(b.c[1])).add(self.c[2].mul(b.c[2]))
+    }
+
+    /// Per-element 4-component dot product (lane `i` = element `i`).
+    #[inline(always)]
+    pub fn dp4(self, b: Self) -> Vec4 {
+        self.dp3(b).add(self.c[3].mul(b.c[3]))
     }
 }
 
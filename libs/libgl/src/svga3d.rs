@@ -132,10 +132,15 @@ pub const SVGA3D_CONST_TYPE_FLOAT: u32 = 0;
 // Command buffer builder
 // ══════════════════════════════════════════════════════════
 
+/// Most words the kernel accepts per `SYS_GPU_3D_SUBMIT`.
+const MAX_SUBMIT_WORDS: usize = 4096;
+
 /// SVGA3D command buffer builder.
 ///
 /// Accumulates commands as `Vec<u32>` and submits them to the kernel
-/// via `SYS_GPU_3D_SUBMIT` in a single syscall.
+/// via `SYS_GPU_3D_SUBMIT`, split at command boundaries into as few
+/// syscalls as the kernel's per-call limit allows.  The buffer is reused,
+/// so a frame's commands build up without reallocating.
 pub struct CmdBuf {
     words: Vec<u32>,
 }
@@ -153,15 +158,44 @@ impl CmdBuf {
         self.words.is_empty()
     }
 
+    /// Words accumulated since the last submit.
+    pub fn len(&self) -> usize {
+        self.words.len()
+    }
+
     /// Submit the accumulated commands to the GPU and clear the buffer.
     /// Returns 0 on success.
     pub fn submit(&mut self) -> u32 {
         if self.words.is_empty() { return 0; }
-        let result = crate::syscall::gpu_3d_submit(&self.words);
+        let mut result = 0;
+        let (mut start, mut pos) = (0, 0);
+        while pos + 1 < self.words.len() {
+            let len = 2 + ((self.words[pos + 1] + 3) / 4) as usize;
+            if pos > start && pos + len - start > MAX_SUBMIT_WORDS {
+                result |= crate::syscall::gpu_3d_submit(&self.words[start..pos]);
+                start = pos;
+            }
+            pos += len;
+        }
+        result |= crate::syscall::gpu_3d_submit(&self.words[start..]);
         self.words.clear();
         result
     }
 
+    /// Start a command whose payload is appended word by word; returns the
+    /// position to pass to [`end_cmd`](Self::end_cmd).
+    fn begin_cmd(&mut self, cmd_id: u32, cid: u32) -> usize {
+        let at = self.words.len();
+        self.words.push(cmd_id);
+        self.words.push(0);
+        self.words.push(cid);
+        at
+    }
+
+    fn end_cmd(&mut self, at: usize) {
+        self.words[at + 1] = ((self.words.len() - at - 2) * 4) as u32;
+    }
+
     /// Append a raw command: `[cmd_id, size_bytes, payload...]`
     fn push_cmd(&mut self, cmd_id: u32, payload: &[u32]) {
         self.words.push(cmd_id);
@@ -447,6 +481,63 @@ impl IdAllocator {
     }
 }
 
+/// Bytes of the persistent vertex upload ring.
+pub const UPLOAD_RING_BYTES: u32 = 256 * 1024;
+/// Linked programs kept defined on the device.
+const MAX_HW_PROGRAMS: usize = 32;
+/// Accumulated words that trigger a submit mid-frame.
+const FLUSH_WORDS: usize = 64 * 1024;
+
+const SHADER_VS: usize = 0;
+const SHADER_PS: usize = 1;
+
+/// Last state sent to the device, so draws only emit what changed.
+/// Cleared when the device state is unknown (init).
+struct Shadow {
+    render_states: Vec<(u32, u32)>,
+    viewport: Option<[u32; 6]>,
+    /// Bound shader per stage (`u32::MAX` = unknown).
+    shaders: [u32; 2],
+    /// Float4 constants per stage, by register.
+    consts: [Vec<Option<[u32; 4]>>; 2],
+}
+
+impl Shadow {
+    fn new() -> Self {
+        Self {
+            render_states: Vec::new(),
+            viewport: None,
+            shaders: [u32::MAX; 2],
+            consts: [Vec::new(), Vec::new()],
+        }
+    }
+}
+
+/// A linked program's shaders, defined on the device.
+pub struct HwProgram {
+    program: u32,
+    link_serial: u32,
+    pub vs_id: u32,
+    pub fs_id: u32,
+    /// Inline constants of each stage (uploaded through the shadow).
+    pub vs_consts: Vec<(u32, [f32; 4])>,
+    pub fs_consts: Vec<(u32, [f32; 4])>,
+}
+
+/// Guest memory shared with the device for uploads.
+///
+/// Vertex data is written straight into the ring and copied into the
+/// vertex buffer surface at the same offset by a queued `SURFACE_DMA`,
+/// so a frame's uploads cost no syscalls.  The ring restarts after the
+/// device has drained the frame.
+struct UploadRing {
+    gmr_id: u32,
+    base: *mut u8,
+    head: u32,
+    /// Vertex buffer surface, `UPLOAD_RING_BYTES` long.
+    vb_sid: u32,
+}
+
 /// Per-process SVGA3D state tracked in libgl.
 pub struct Svga3dState {
     pub cmd: CmdBuf,
@@ -458,6 +549,9 @@ pub struct Svga3dState {
     pub width: u32,
     pub height: u32,
     pub initialized: bool,
+    shadow: Shadow,
+    programs: Vec<HwProgram>,
+    ring: Option<UploadRing>,
 }
 
 impl Svga3dState {
@@ -472,6 +566,9 @@ impl Svga3dState {
             width: 0,
             height: 0,
             initialized: false,
+            shadow: Shadow::new(),
+            programs: Vec::new(),
+            ring: None,
         }
     }
 
@@ -489,6 +586,7 @@ impl Svga3dState {
     pub fn init(&mut self, width: u32, height: u32) -> bool {
         self.width = width;
         self.height = height;
+        self.shadow = Shadow::new();
 
         // Allocate resources
         self.context_id = 1;
@@ -517,13 +615,21 @@ impl Svga3dState {
         self.cmd.set_render_target(self.context_id, SVGA3D_RT_DEPTH, self.depth_sid);
 
         // Set viewport (SVGA3D uses floats for viewport dimensions)
-        self.cmd.set_viewport(self.context_id, 0.0, 0.0, width as f32, height as f32, 0.0, 1.0);
+        self.set_viewport(0.0, 0.0, width as f32, height as f32);
 
         // Set default render states
-        self.cmd.set_render_states(self.context_id, &[
+        self.set_render_states(&[
             (SVGA3D_RS_COLORWRITEENABLE, 0xF), // Write all RGBA channels
         ]);
 
+        // Persistent upload ring (older kernels: per-draw DMA syscalls)
+        if let Some((gmr_id, base)) = crate::syscall::gpu_3d_gmr_create(UPLOAD_RING_BYTES) {
+            let vb_sid = self.alloc_surface();
+            self.cmd.surface_define(vb_sid, SVGA3D_SURFACE_HINT_VERTEXBUFFER, SVGA3D_X8R8G8B8,
+                UPLOAD_RING_BYTES / 4, 1);
+            self.ring = Some(UploadRing { gmr_id, base, head: 0, vb_sid });
+        }
+
         let result = self.cmd.submit();
         self.initialized = result == 0;
         self.initialized
@@ -532,10 +638,184 @@ impl Svga3dState {
     /// Tear down SVGA3D resources.
     pub fn destroy(&mut self) {
         if !self.initialized { return; }
+        for p in core::mem::take(&mut self.programs) {
+            self.cmd.shader_destroy(self.context_id, p.vs_id, SVGA3D_SHADERTYPE_VS);
+            self.cmd.shader_destroy(self.context_id, p.fs_id, SVGA3D_SHADERTYPE_PS);
+        }
+        if let Some(ring) = self.ring.take() {
+            self.cmd.surface_destroy(ring.vb_sid);
+            self.cmd.submit();
+            crate::syscall::gpu_3d_gmr_release(ring.gmr_id);
+        }
         self.cmd.surface_destroy(self.depth_sid);
         self.cmd.surface_destroy(self.color_sid);
         self.cmd.context_destroy(self.context_id);
         self.cmd.submit();
         self.initialized = false;
     }
+
+    // ── Frame batching ───────────────────────────────────
+
+    /// Submit the commands queued so far (glFlush, or a full buffer).
+    pub fn flush(&mut self) -> u32 {
+        self.cmd.submit()
+    }
+
+    /// Submit the frame and wait for the device, so the upload ring can be
+    /// reused.
+    pub fn end_frame(&mut self) -> u32 {
+        let ret = self.cmd.submit();
+        if let Some(ring) = self.ring.as_mut() {
+            if ring.head != 0 {
+                crate::syscall::gpu_3d_sync();
+                ring.head = 0;
+            }
+        }
+        ret
+    }
+
+    /// Submit early if a long frame has queued many commands.
+    pub fn maybe_flush(&mut self) {
+        if self.cmd.len() >= FLUSH_WORDS {
+            self.cmd.submit();
+        }
+    }
+
+    // ── Uploads ──────────────────────────────────────────
+
+    /// Whether the persistent upload ring is available.
+    pub fn has_upload_ring(&self) -> bool {
+        self.ring.is_some()
+    }
+
+    /// Reserve `bytes` (a multiple of 4) in the upload ring, returning the
+    /// offset and a writable view.  A full ring ends the frame early.
+    pub fn upload_alloc(&mut self, bytes: u32) -> Option<(u32, &mut [f32])> {
+        if bytes == 0 || bytes > UPLOAD_RING_BYTES || self.ring.is_none() {
+            return None;
+        }
+        let head = self.ring.as_ref().map_or(0, |r| (r.head + 15) & !15);
+        let offset = if head + bytes > UPLOAD_RING_BYTES {
+            self.end_frame();
+            0
+        } else {
+            head
+        };
+        let ring = self.ring.as_mut()?;
+        ring.head = offset + bytes;
+        let data = unsafe {
+            core::slice::from_raw_parts_mut(ring.base.add(offset as usize) as *mut f32, (bytes / 4) as usize)
+        };
+        Some((offset, data))
+    }
+
+    /// Queue the copy of ring bytes `offset..offset + bytes` into the
+    /// vertex buffer surface; returns the surface ID.
+    pub fn upload_vertices(&mut self, offset: u32, bytes: u32) -> u32 {
+        let (gmr_id, vb_sid) = match self.ring.as_ref() {
+            Some(r) => (r.gmr_id, r.vb_sid),
+            None => return 0,
+        };
+        self.cmd.surface_dma(
+            gmr_id, offset,
+            vb_sid, 0, 0,
+            1, // SVGA3D_WRITE_HOST_VRAM
+            offset / 4, 0, bytes / 4, 1,
+            0, 0,
+            bytes,
+        );
+        vb_sid
+    }
+
+    // ── Programs ─────────────────────────────────────────
+
+    /// Device shaders for a linked program, if still defined.
+    pub fn program(&self, program: u32, link_serial: u32) -> Option<&HwProgram> {
+        self.programs.iter().find(|p| p.program == program && p.link_serial == link_serial)
+    }
+
+    /// Define a program's shaders, evicting the oldest cached program (and
+    /// any older link of the same one).
+    pub fn add_program(
+        &mut self,
+        program: u32, link_serial: u32,
+        vs_bytecode: &[u32], fs_bytecode: &[u32],
+        vs_consts: Vec<(u32, [f32; 4])>, fs_consts: Vec<(u32, [f32; 4])>,
+    ) -> &HwProgram {
+        let cid = self.context_id;
+        let mut i = 0;
+        while i < self.programs.len() {
+            if self.programs[i].program == program || self.programs.len() >= MAX_HW_PROGRAMS {
+                let old = self.programs.remove(i);
+                self.cmd.shader_destroy(cid, old.vs_id, SVGA3D_SHADERTYPE_VS);
+                self.cmd.shader_destroy(cid, old.fs_id, SVGA3D_SHADERTYPE_PS);
+                for (stage, id) in [(SHADER_VS, old.vs_id), (SHADER_PS, old.fs_id)] {
+                    if self.shadow.shaders[stage] == id {
+                        self.shadow.shaders[stage] = u32::MAX;
+                    }
+                }
+            } else {
+                i += 1;
+            }
+        }
+        let vs_id = self.alloc_shader();
+        let fs_id = self.alloc_shader();
+        self.cmd.shader_define(cid, vs_id, SVGA3D_SHADERTYPE_VS, vs_bytecode);
+        self.cmd.shader_define(cid, fs_id, SVGA3D_SHADERTYPE_PS, fs_bytecode);
+        self.programs.push(HwProgram { program, link_serial, vs_id, fs_id, vs_consts, fs_consts });
+        &self.programs[self.programs.len() - 1]
+    }
+
+    // ── Shadowed state ───────────────────────────────────
+
+    /// Set render states, emitting one command for those that changed.
+    pub fn set_render_states(&mut self, states: &[(u32, u32)]) {
+        let mut open = None;
+        for &(state, value) in states {
+            match self.shadow.render_states.iter_mut().find(|(s, _)| *s == state) {
+                Some((_, v)) if *v == value => continue,
+                Some((_, v)) => *v = value,
+                None => self.shadow.render_states.push((state, value)),
+            }
+            if open.is_none() {
+                open = Some(self.cmd.begin_cmd(CMD_SETRENDERSTATE, self.context_id));
+            }
+            self.cmd.words.push(state);
+            self.cmd.words.push(value);
+        }
+        if let Some(at) = open {
+            self.cmd.end_cmd(at);
+        }
+    }
+
+    pub fn set_viewport(&mut self, x: f32, y: f32, w: f32, h: f32) {
+        let vp = [x.to_bits(), y.to_bits(), w.to_bits(), h.to_bits(), 0.0f32.to_bits(), 1.0f32.to_bits()];
+        if self.shadow.viewport != Some(vp) {
+            self.shadow.viewport = Some(vp);
+            self.cmd.set_viewport(self.context_id, x, y, w, h, 0.0, 1.0);
+        }
+    }
+
+    /// Bind a shader (`SVGA3D_SHADERTYPE_VS` / `_PS`).
+    pub fn set_shader(&mut self, shader_type: u32, shid: u32) {
+        let stage = if shader_type == SVGA3D_SHADERTYPE_VS { SHADER_VS } else { SHADER_PS };
+        if self.shadow.shaders[stage] != shid {
+            self.shadow.shaders[stage] = shid;
+            self.cmd.set_shader(self.context_id, shader_type, shid);
+        }
+    }
+
+    /// Set a float4 shader constant if it changed.
+    pub fn set_shader_const_f(&mut self, shader_type: u32, reg: u32, values: &[f32; 4]) {
+        let stage = if shader_type == SVGA3D_SHADERTYPE_VS { SHADER_VS } else { SHADER_PS };
+        let bits = [values[0].to_bits(), values[1].to_bits(), values[2].to_bits(), values[3].to_bits()];
+        let consts = &mut self.shadow.consts[stage];
+        if consts.len() <= reg as usize {
+            consts.resize(reg as usize + 1, None);
+        }
+        if consts[reg as usize] != Some(bits) {
+            consts[reg as usize] = Some(bits);
+            self.cmd.set_shader_const_f(self.context_id, reg, shader_type, values);
+        }
+    }
 }
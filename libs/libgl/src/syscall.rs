@@ -3,8 +3,10 @@
 pub use libsyscall::{
     sbrk, mmap, munmap, exit, write_bytes,
     gpu_3d_has_hw, gpu_3d_hw_version, gpu_3d_submit, gpu_3d_sync,
-    gpu_3d_surface_dma, gpu_3d_surface_dma_read,
+    gpu_3d_surface_dma, gpu_3d_surface_dma_read, gpu_3d_gmr_create, gpu_3d_gmr_release,
     serial_print,
+    thread_create, futex_wait, futex_wake, cpu_count, FUTEX_FOREVER,
+    open, read, write, close, file_size, mkdir, O_WRITE, O_CREATE, O_TRUNC,
 };
 
 pub fn _serial_print(args: core::fmt::Arguments) {
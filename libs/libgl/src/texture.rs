@@ -1,16 +1,87 @@
 //! Texture objects (GL_TEXTURE_2D).
 //!
-//! Stores texture data as RGBA8 pixels. Supports `glTexImage2D`, `glTexSubImage2D`,
-//! `glTexParameteri`, and nearest/linear filtering for the software rasterizer.
+//! Stores texture data as ARGB8 texels in a full mip chain. Supports
+//! `glTexImage2D`, `glTexParameteri`, `glGenerateMipmap`, and nearest /
+//! bilinear / trilinear filtering for the software rasterizer.
+//!
+//! Texels are stored **tiled**: each level is split into 4×4 tiles of 16
+//! texels (64 bytes, one cache line), and texels within a tile are in Morton
+//! (Z) order.  A bilinear footprint almost always lies in a single line, and
+//! walking a minified texture along either axis stays cache-local — neither
+//! holds for row-major storage.
+//!
+//! Filtering works on packed texels in 8-bit fixed point and unpacks to
+//! float once per sample.
 
 use alloc::vec;
 use alloc::vec::Vec;
 use crate::types::*;
+use crate::rasterizer::math;
+
+/// Edge length of a storage tile, in texels.
+const TILE: u32 = 4;
+
+/// One mip level in tiled storage.
+pub struct MipLevel {
+    pub width: u32,
+    pub height: u32,
+    /// Tiles per row.
+    tiles_x: u32,
+    /// ARGB8 texels, tiled (see [`MipLevel::index`]).
+    pub data: Vec<u32>,
+}
+
+impl MipLevel {
+    fn new(width: u32, height: u32) -> Self {
+        let tiles_x = (width + TILE - 1) / TILE;
+        let tiles_y = (height + TILE - 1) / TILE;
+        Self { width, height, tiles_x, data: vec![0u32; (tiles_x * tiles_y * TILE * TILE) as usize] }
+    }
+
+    /// Storage index of texel (x, y).
+    #[inline(always)]
+    pub fn index(&self, x: u32, y: u32) -> usize {
+        let tile = (y / TILE) * self.tiles_x + x / TILE;
+        // Interleave the 2-bit in-tile coordinates: y1 x1 y0 x0
+        let morton = (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2);
+        (tile * TILE * TILE + morton) as usize
+    }
+
+    #[inline(always)]
+    pub fn get(&self, x: u32, y: u32) -> u32 {
+        self.data[self.index(x, y)]
+    }
+
+    #[inline(always)]
+    fn set(&mut self, x: u32, y: u32, px: u32) {
+        let i = self.index(x, y);
+        self.data[i] = px;
+    }
+
+    /// Next smaller level: 2×2 box filter (edge texels repeat on odd sizes).
+    fn downsample(&self) -> Self {
+        let mut out = MipLevel::new((self.width / 2).max(1), (self.height / 2).max(1));
+        let (xmax, ymax) = (self.width - 1, self.height - 1);
+        for y in 0..out.height {
+            for x in 0..out.width {
+                let (sx, sy) = (x * 2, y * 2);
+                let px = avg4_packed(
+                    self.get(sx, sy),
+                    self.get((sx + 1).min(xmax), sy),
+                    self.get(sx, (sy + 1).min(ymax)),
+                    self.get((sx + 1).min(xmax), (sy + 1).min(ymax)),
+                );
+                out.set(x, y, px);
+            }
+        }
+        out
+    }
+}
 
 /// A 2D texture object.
 pub struct GlTexture {
-    /// RGBA8 pixel data (row-major).
-    pub data: Vec<u32>,
+    /// Mip chain, level 0 first.  Empty until an image is specified.
+    pub levels: Vec<MipLevel>,
     pub width: u32,
     pub height: u32,
     pub min_filter: GLenum,
@@ -23,7 +94,7 @@ pub struct GlTexture {
 impl GlTexture {
     fn new() -> Self {
         Self {
-            data: Vec::new(),
+            levels: Vec::new(),
             width: 0,
             height: 0,
             min_filter: GL_NEAREST_MIPMAP_LINEAR,
@@ -34,60 +105,114 @@ impl GlTexture {
         }
     }
 
-    /// Sample a texel at (u, v) with nearest-neighbor filtering.
-    pub fn sample_nearest(&self, u: f32, v: f32) -> [f32; 4] {
-        if self.width == 0 || self.height == 0 {
-            return [0.0, 0.0, 0.0, 1.0];
+    /// Rebuild levels 1.. from level 0 (glGenerateMipmap).
+    pub fn generate_mipmaps(&mut self) {
+        self.levels.truncate(1);
+        while let Some(last) = self.levels.last() {
+            if last.width == 1 && last.height == 1 {
+                break;
+            }
+            let next = last.downsample();
+            self.levels.push(next);
         }
-        let u = wrap_coord(u, self.wrap_s);
-        let v = wrap_coord(v, self.wrap_t);
-        let x = ((u * self.width as f32) as i32).clamp(0, self.width as i32 - 1) as u32;
-        let y = ((v * self.height as f32) as i32).clamp(0, self.height as i32 - 1) as u32;
-        let px = self.data[(y * self.width + x) as usize];
-        unpack_rgba(px)
     }
 
-    /// Sample a texel at (u, v) with bilinear filtering.
-    pub fn sample_linear(&self, u: f32, v: f32) -> [f32; 4] {
-        if self.width == 0 || self.height == 0 {
-            return [0.0, 0.0, 0.0, 1.0];
-        }
-        let u = wrap_coord(u, self.wrap_s);
-        let v = wrap_coord(v, self.wrap_t);
-        let fx = u * self.width as f32 - 0.5;
-        let fy = v * self.height as f32 - 0.5;
+    /// Whether the min filter reads more than level 0.
+    #[inline(always)]
+    pub fn is_mipmapped(&self) -> bool {
+        matches!(self.min_filter,
+            GL_NEAREST_MIPMAP_NEAREST | GL_LINEAR_MIPMAP_NEAREST
+            | GL_NEAREST_MIPMAP_LINEAR | GL_LINEAR_MIPMAP_LINEAR)
+    }
+
+    /// Sample a texel at (u, v) of `level` with nearest-neighbor filtering.
+    #[inline(always)]
+    fn nearest_packed(&self, level: usize, u: f32, v: f32) -> u32 {
+        let l = &self.levels[level];
+        let x = wrap_texel(floor_f32(u * l.width as f32) as i32, l.width, self.wrap_s);
+        let y = wrap_texel(floor_f32(v * l.height as f32) as i32, l.height, self.wrap_t);
+        l.get(x, y)
+    }
+
+    /// Bilinear sample of `level` in 8-bit fixed point.
+    #[inline(always)]
+    fn linear_packed(&self, level: usize, u: f32, v: f32) -> u32 {
+        let l = &self.levels[level];
+        let fx = wrap_coord(u, self.wrap_s) * l.width as f32 - 0.5;
+        let fy = wrap_coord(v, self.wrap_t) * l.height as f32 - 0.5;
         let x0 = floor_f32(fx) as i32;
         let y0 = floor_f32(fy) as i32;
-        let frac_x = fx - x0 as f32;
-        let frac_y = fy - y0 as f32;
-
-        let w = self.width as i32;
-        let h = self.height as i32;
-        let s00 = self.fetch(x0.clamp(0, w - 1) as u32, y0.clamp(0, h - 1) as u32);
-        let s10 = self.fetch((x0 + 1).clamp(0, w - 1) as u32, y0.clamp(0, h - 1) as u32);
-        let s01 = self.fetch(x0.clamp(0, w - 1) as u32, (y0 + 1).clamp(0, h - 1) as u32);
-        let s11 = self.fetch((x0 + 1).clamp(0, w - 1) as u32, (y0 + 1).clamp(0, h - 1) as u32);
-
-        let mut result = [0.0f32; 4];
-        for i in 0..4 {
-            let top = s00[i] + (s10[i] - s00[i]) * frac_x;
-            let bot = s01[i] + (s11[i] - s01[i]) * frac_x;
-            result[i] = top + (bot - top) * frac_y;
+        let tx = ((fx - x0 as f32) * 256.0) as u32;
+        let ty = ((fy - y0 as f32) * 256.0) as u32;
+
+        let xa = wrap_texel(x0, l.width, self.wrap_s);
+        let xb = wrap_texel(x0 + 1, l.width, self.wrap_s);
+        let ya = wrap_texel(y0, l.height, self.wrap_t);
+        let yb = wrap_texel(y0 + 1, l.height, self.wrap_t);
+        let top = lerp_packed(l.get(xa, ya), l.get(xb, ya), tx);
+        let bot = lerp_packed(l.get(xa, yb), l.get(xb, yb), tx);
+        lerp_packed(top, bot, ty)
+    }
+
+    /// Sample at (u, v) with level of detail `lod` (log2 of the texel to
+    /// pixel ratio), following the GL filter selection rules.
+    pub fn sample_lod(&self, u: f32, v: f32, lod: f32) -> [f32; 4] {
+        if self.levels.is_empty() || self.width == 0 || self.height == 0 {
+            return [0.0, 0.0, 0.0, 1.0];
+        }
+        if lod <= 0.0 {
+            return unpack_rgba(match self.mag_filter {
+                GL_LINEAR => self.linear_packed(0, u, v),
+                _ => self.nearest_packed(0, u, v),
+            });
         }
-        result
+        let last = self.levels.len() - 1;
+        let px = match self.min_filter {
+            GL_LINEAR => self.linear_packed(0, u, v),
+            GL_NEAREST_MIPMAP_NEAREST | GL_LINEAR_MIPMAP_NEAREST => {
+                let level = ((lod + 0.5) as usize).min(last);
+                if self.min_filter == GL_LINEAR_MIPMAP_NEAREST {
+                    self.linear_packed(level, u, v)
+                } else {
+                    self.nearest_packed(level, u, v)
+                }
+            }
+            GL_NEAREST_MIPMAP_LINEAR | GL_LINEAR_MIPMAP_LINEAR => {
+                let level = (lod as usize).min(last);
+                let next = (level + 1).min(last);
+                let t = ((lod - level as f32) * 256.0) as u32;
+                let fetch = |l| if self.min_filter == GL_LINEAR_MIPMAP_LINEAR {
+                    self.linear_packed(l, u, v)
+                } else {
+                    self.nearest_packed(l, u, v)
+                };
+                let a = fetch(level);
+                if next == level { a } else { lerp_packed(a, fetch(next), t.min(256)) }
+            }
+            _ => self.nearest_packed(0, u, v),
+        };
+        unpack_rgba(px)
     }
 
-    /// Sample using the configured mag filter.
+    /// Sample using the configured mag filter (level 0).
     pub fn sample(&self, u: f32, v: f32) -> [f32; 4] {
-        match self.mag_filter {
-            GL_LINEAR => self.sample_linear(u, v),
-            _ => self.sample_nearest(u, v),
-        }
+        self.sample_lod(u, v, 0.0)
     }
 
-    fn fetch(&self, x: u32, y: u32) -> [f32; 4] {
-        let px = self.data[(y * self.width + x) as usize];
-        unpack_rgba(px)
+    /// Level of detail of a 2×2 pixel quad (lanes `(x, y)`, `(x+1, y)`,
+    /// `(x, y+1)`, `(x+1, y+1)`) from its texture coordinate differences.
+    pub fn quad_lod(&self, u: &[f32; 4], v: &[f32; 4]) -> f32 {
+        let (w, h) = (self.width as f32, self.height as f32);
+        let (dudx, dvdx) = ((u[1] - u[0]) * w, (v[1] - v[0]) * h);
+        let (dudy, dvdy) = ((u[2] - u[0]) * w, (v[2] - v[0]) * h);
+        let rho2 = (dudx * dudx + dvdx * dvdx).max(dudy * dudy + dvdy * dvdy);
+        // 0.5 * log2(rho²) = log2(rho)
+        if rho2 > 1.0 { 0.5 * math::log2(rho2) } else { 0.0 }
+    }
+
+    /// Texel at (x, y) of level 0, row-major coordinates.
+    pub fn texel(&self, x: u32, y: u32) -> u32 {
+        self.levels[0].get(x, y)
     }
 }
 
@@ -142,53 +267,56 @@ impl TextureStore {
     }
 
     /// Upload pixel data (glTexImage2D).
+    ///
+    /// Level 0 redefines the texture and builds the full mip chain from it;
+    /// a level > 0 of the matching size replaces that level of the chain.
     pub fn tex_image_2d(
         &mut self,
         id: u32,
+        level: u32,
         width: u32,
         height: u32,
         format: GLenum,
         data: Option<&[u8]>,
     ) {
         if let Some(tex) = self.get_mut(id) {
-            tex.width = width;
-            tex.height = height;
-            tex.internal_format = format;
-            let npixels = (width * height) as usize;
-            tex.data = vec![0u32; npixels];
-
+            let mut img = MipLevel::new(width, height);
             if let Some(src) = data {
-                match format {
-                    GL_RGBA => {
-                        for i in 0..npixels.min(src.len() / 4) {
-                            let r = src[i * 4] as u32;
-                            let g = src[i * 4 + 1] as u32;
-                            let b = src[i * 4 + 2] as u32;
-                            let a = src[i * 4 + 3] as u32;
-                            tex.data[i] = (a << 24) | (r << 16) | (g << 8) | b;
+                let bpp = match format {
+                    GL_RGBA => 4,
+                    GL_RGB => 3,
+                    GL_LUMINANCE | GL_ALPHA => 1,
+                    _ => return,
+                };
+                let npixels = (width * height) as usize;
+                for i in 0..npixels.min(src.len() / bpp) {
+                    let p = &src[i * bpp..i * bpp + bpp];
+                    let px = match format {
+                        GL_RGBA => {
+                            let (r, g, b, a) = (p[0] as u32, p[1] as u32, p[2] as u32, p[3] as u32);
+                            (a << 24) | (r << 16) | (g << 8) | b
                         }
-                    }
-                    GL_RGB => {
-                        for i in 0..npixels.min(src.len() / 3) {
-                            let r = src[i * 3] as u32;
-                            let g = src[i * 3 + 1] as u32;
-                            let b = src[i * 3 + 2] as u32;
-                            tex.data[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+                        GL_RGB => 0xFF000000 | ((p[0] as u32) << 16) | ((p[1] as u32) << 8) | p[2] as u32,
+                        GL_LUMINANCE => {
+                            let l = p[0] as u32;
+                            0xFF000000 | (l << 16) | (l << 8) | l
                         }
-                    }
-                    GL_LUMINANCE => {
-                        for i in 0..npixels.min(src.len()) {
-                            let l = src[i] as u32;
-                            tex.data[i] = 0xFF000000 | (l << 16) | (l << 8) | l;
-                        }
-                    }
-                    GL_ALPHA => {
-                        for i in 0..npixels.min(src.len()) {
-                            let a = src[i] as u32;
-                            tex.data[i] = a << 24;
-                        }
-                    }
-                    _ => {}
+                        _ => (p[0] as u32) << 24,
+                    };
+                    img.set(i as u32 % width, i as u32 / width, px);
+                }
+            }
+
+            if level == 0 {
+                tex.width = width;
+                tex.height = height;
+                tex.internal_format = format;
+                tex.levels.clear();
+                tex.levels.push(img);
+                tex.generate_mipmaps();
+            } else if let Some(slot) = tex.levels.get_mut(level as usize) {
+                if slot.width == width && slot.height == height {
+                    *slot = img;
                 }
             }
         }
@@ -210,6 +338,41 @@ fn floor_f32(x: f32) -> f32 {
     if x < 0.0 && x != i as f32 { (i - 1) as f32 } else { i as f32 }
 }
 
+/// Wrap an integer texel coordinate into `0..size` according to the wrap mode.
+#[inline(always)]
+fn wrap_texel(i: i32, size: u32, mode: GLenum) -> u32 {
+    let n = size as i32;
+    match mode {
+        GL_CLAMP_TO_EDGE => i.clamp(0, n - 1) as u32,
+        GL_MIRRORED_REPEAT => {
+            let m = i.rem_euclid(2 * n);
+            (if m >= n { 2 * n - 1 - m } else { m }) as u32
+        }
+        // GL_REPEAT
+        _ => i.rem_euclid(n) as u32,
+    }
+}
+
+/// Blend two ARGB8 texels: `a + (b - a) * t / 256`, all channels at once
+/// (two 8-bit channels per 16-bit half).
+#[inline(always)]
+fn lerp_packed(a: u32, b: u32, t: u32) -> u32 {
+    let it = 256 - t;
+    let rb = ((a & 0x00FF_00FF) * it + (b & 0x00FF_00FF) * t) >> 8;
+    let ag = ((a >> 8) & 0x00FF_00FF) * it + ((b >> 8) & 0x00FF_00FF) * t;
+    (rb & 0x00FF_00FF) | (ag & 0xFF00_FF00)
+}
+
+/// Rounded average of four ARGB8 texels.
+#[inline(always)]
+fn avg4_packed(a: u32, b: u32, c: u32, d: u32) -> u32 {
+    let lo = |p: u32| p & 0x00FF_00FF;
+    let hi = |p: u32| (p >> 8) & 0x00FF_00FF;
+    let rb = ((lo(a) + lo(b) + lo(c) + lo(d) + 0x0002_0002) >> 2) & 0x00FF_00FF;
+    let ag = ((hi(a) + hi(b) + hi(c) + hi(d) + 0x0002_0002) << 6) & 0xFF00_FF00;
+    rb | ag
+}
+
 /// Wrap a texture coordinate according to the wrap mode.
 fn wrap_coord(c: f32, mode: GLenum) -> f32 {
     match mode {
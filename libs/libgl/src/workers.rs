@@ -0,0 +1,135 @@
+//! Render worker threads for the tile-parallel rasterizer.
+//!
+//! One worker per additional CPU, started on the first parallel draw.  A job
+//! is a closure over task indices `0..count`; the calling thread publishes
+//! it, wakes the workers through a futex on the generation counter and
+//! takes tasks from the same atomic counter as they do.  [`run`] returns
+//! once every worker has finished the job, so the closure may borrow from
+//! the caller's stack.
+//!
+//! Workers never allocate: the heap of this library is not thread-safe.
+//! On a single-CPU system (or if no thread could be started) jobs run
+//! inline on the calling thread.
+
+use core::sync::atomic::{AtomicPtr, AtomicU32, AtomicUsize, Ordering};
+use crate::syscall::{cpu_count, futex_wait, futex_wake, mmap, thread_create, FUTEX_FOREVER};
+
+/// Upper bound on worker threads.
+const MAX_WORKERS: u32 = 15;
+/// Stack size of a worker thread.
+const WORKER_STACK_SIZE: usize = 256 * 1024;
+/// Polls of the generation counter before a worker sleeps.
+const IDLE_SPINS: u32 = 256;
+
+type Task = dyn Fn(usize) + Sync;
+
+struct Job {
+    run: *const Task,
+    count: usize,
+}
+
+const POOL_UNINIT: u32 = 0;
+const POOL_READY: u32 = 1;
+
+static POOL_STATE: AtomicU32 = AtomicU32::new(POOL_UNINIT);
+static WORKERS_STARTED: AtomicU32 = AtomicU32::new(0);
+/// Bumped when a job is published; idle workers futex-wait on it.
+static GENERATION: AtomicU32 = AtomicU32::new(0);
+/// Threads (workers + caller) still inside the current job.
+static ACTIVE: AtomicU32 = AtomicU32::new(0);
+/// Next task index of the current job.
+static NEXT_TASK: AtomicUsize = AtomicUsize::new(0);
+static JOB: AtomicPtr<Job> = AtomicPtr::new(core::ptr::null_mut());
+
+/// Number of worker threads besides the caller (starts them on first use).
+pub fn workers() -> usize {
+    if POOL_STATE.load(Ordering::Acquire) != POOL_READY {
+        start();
+    }
+    WORKERS_STARTED.load(Ordering::Relaxed) as usize
+}
+
+#[cold]
+fn start() {
+    let n = cpu_count().saturating_sub(1).min(MAX_WORKERS);
+    let mut started = 0;
+    for _ in 0..n {
+        let stack = mmap(WORKER_STACK_SIZE as u32);
+        if stack == u64::MAX {
+            break;
+        }
+        // x86_64 ABI: RSP must be STACK_TOP - 8 at function entry
+        let top = stack as usize + WORKER_STACK_SIZE - 8;
+        if thread_create(worker_main, top, "gl-raster") == 0 {
+            break;
+        }
+        started += 1;
+    }
+    WORKERS_STARTED.store(started, Ordering::Relaxed);
+    POOL_STATE.store(POOL_READY, Ordering::Release);
+}
+
+/// Run `task(i)` for every `i` in `0..count` on the workers and the calling
+/// thread, in no particular order.  Returns when all tasks are done.
+pub fn run(count: usize, task: &(dyn Fn(usize) + Sync + '_)) {
+    let n = workers() as u32;
+    if n == 0 || count <= 1 {
+        for i in 0..count {
+            task(i);
+        }
+        return;
+    }
+    // The job outlives every access to it: we wait for all workers below.
+    let run: *const Task = unsafe { core::mem::transmute(task) };
+    let job = Job { run, count };
+    NEXT_TASK.store(0, Ordering::Relaxed);
+    ACTIVE.store(n + 1, Ordering::Relaxed);
+    JOB.store(&job as *const Job as *mut Job, Ordering::Release);
+    GENERATION.fetch_add(1, Ordering::Release);
+    futex_wake(&GENERATION, u32::MAX);
+
+    work(&job);
+    ACTIVE.fetch_sub(1, Ordering::AcqRel);
+    loop {
+        let active = ACTIVE.load(Ordering::Acquire);
+        if active == 0 {
+            break;
+        }
+        futex_wait(&ACTIVE, active, FUTEX_FOREVER);
+    }
+    JOB.store(core::ptr::null_mut(), Ordering::Relaxed);
+}
+
+fn work(job: &Job) {
+    loop {
+        let i = NEXT_TASK.fetch_add(1, Ordering::Relaxed);
+        if i >= job.count {
+            break;
+        }
+        unsafe { (*job.run)(i) };
+    }
+}
+
+fn worker_main() {
+    // Workers exist before the first job, so generation 0 is never a job.
+    let mut seen = 0u32;
+    let mut spins = 0u32;
+    loop {
+        let gen = GENERATION.load(Ordering::Acquire);
+        if gen == seen {
+            if spins < IDLE_SPINS {
+                spins += 1;
+                core::hint::spin_loop();
+            } else {
+                futex_wait(&GENERATION, gen, FUTEX_FOREVER);
+            }
+            continue;
+        }
+        seen = gen;
+        spins = 0;
+        work(unsafe { &*JOB.load(Ordering::Acquire) });
+        if ACTIVE.fetch_sub(1, Ordering::AcqRel) == 1 {
+            futex_wake(&ACTIVE, 1);
+        }
+    }
+}
@@ -57,6 +57,8 @@ pub const GL_RGBA: GLenum = 0x1908;
 pub const GL_RGB: GLenum = 0x1907;
 pub const GL_NEAREST: GLenum = 0x2600;
 pub const GL_LINEAR: GLenum = 0x2601;
+pub const GL_NEAREST_MIPMAP_NEAREST: GLenum = 0x2700;
+pub const GL_LINEAR_MIPMAP_LINEAR: GLenum = 0x2703;
 pub const GL_TEXTURE_MIN_FILTER: GLenum = 0x2801;
 pub const GL_TEXTURE_MAG_FILTER: GLenum = 0x2800;
 pub const GL_VERTEX_SHADER: GLenum = 0x8B31;
@@ -169,6 +171,8 @@ struct LibGl {
     set_hw_backend: extern "C" fn(u32),
     get_hw_backend: extern "C" fn() -> u32,
     has_hw_backend: extern "C" fn() -> u32,
+    get_depth_stats: extern "C" fn(*mut u64, u32, u32) -> u32,
+    optimize_indices: extern "C" fn(*mut u32, u32, u32) -> u32,
     // Math
     math_sin: extern "C" fn(f32) -> f32,
     math_cos: extern "C" fn(f32) -> f32,
@@ -281,6 +285,8 @@ pub fn init() -> bool {
             set_hw_backend: resolve(&handle, "gl_set_hw_backend"),
             get_hw_backend: resolve(&handle, "gl_get_hw_backend"),
             has_hw_backend: resolve(&handle, "gl_has_hw_backend"),
+            get_depth_stats: resolve(&handle, "gl_get_depth_stats"),
+            optimize_indices: resolve(&handle, "gl_optimize_indices"),
             math_sin: resolve(&handle, "gl_math_sin"),
             math_cos: resolve(&handle, "gl_math_cos"),
             math_tan: resolve(&handle, "gl_math_tan"),
@@ -401,6 +407,9 @@ pub fn tex_image_2d(target: GLenum, level: i32, internal_format: i32,
                          format, type_, data.as_ptr());
 }
 
+/// Build the mip chain of the bound texture from level 0.
+pub fn generate_mipmap(target: GLenum) { (lib().generate_mipmap)(target); }
+
 /// Set active texture unit.
 pub fn active_texture(texture: GLenum) { (lib().active_texture)(texture); }
 
@@ -544,6 +553,23 @@ pub fn get_hw_backend() -> bool { (lib().get_hw_backend)() != 0 }
 /// Query whether SVGA3D hardware is available (even if not currently in use).
 pub fn has_hw_backend() -> bool { (lib().has_hw_backend)() != 0 }
 
+/// Software rasterizer depth rejection counters: `[triangle tiles tested,
+/// tiles rejected by hierarchical Z, fragments killed before shading]`.
+/// `reset` zeroes them after reading.
+pub fn depth_stats(reset: bool) -> [u64; 3] {
+    let mut out = [0u64; 3];
+    (lib().get_depth_stats)(out.as_mut_ptr(), 3, if reset { 1 } else { 0 });
+    out
+}
+
+/// Reorder a `GL_TRIANGLES` index list in place so shared vertices are
+/// referenced close together (fewer vertex shader runs for large meshes).
+/// Call once on static meshes before uploading them.  Returns `false` if an
+/// index is out of range or the length is not a multiple of 3.
+pub fn optimize_indices(indices: &mut [u32], vertex_count: u32) -> bool {
+    (lib().optimize_indices)(indices.as_mut_ptr(), indices.len() as u32, vertex_count) != 0
+}
+
 // ══════════════════════════════════════════════════════════════════════════════
 //  Math Functions (FPU/SSE accelerated via libgl)
 // ══════════════════════════════════════════════════════════════════════════════
@@ -1,9 +1,20 @@
 //! Shared free-list heap primitives for anyOS user-space allocators.
 //!
-//! Provides the core free-list search (first-fit with splitting) and
-//! dealloc (sorted insert with coalescing) logic used by all user-space
-//! allocators: stdlib (custom impl with mmap fallback) and all DLLs
-//! (via the [`dll_allocator!`] macro).
+//! Provides [`FreeLists`], the segregated free-block store used by all
+//! user-space allocators: stdlib (custom impl with mmap fallback) and all
+//! DLLs (via the [`dll_allocator!`] macro).
+//!
+//! # Layout
+//!
+//! - **Small bins** — blocks up to [`SMALL_MAX`] bytes live in one of 64
+//!   exact-size LIFO lists (16-byte steps).  Push and pop are O(1); freed
+//!   small blocks are not coalesced immediately.
+//! - **Block tree** — larger blocks live in an address-ordered treap.  Each
+//!   node caches the largest block in its subtree, so the lowest-address
+//!   first fit and both coalescing neighbours are found in O(log n).
+//!
+//! When a large request misses the tree, the small bins are consolidated
+//! into it (merging adjacent blocks) and the search is retried.
 //!
 //! # DLL Allocator Macro
 //!
@@ -23,17 +34,18 @@
 use core::alloc::Layout;
 use core::ptr;
 
-/// Free block node — stored in-place in freed memory.
-/// Blocks are sorted by address to enable coalescing.
-#[repr(C)]
-pub struct FreeBlock {
-    pub size: usize,
-    pub next: *mut FreeBlock,
-}
-
-/// Minimum block size (must fit a FreeBlock node = 16 bytes on 64-bit).
+/// Minimum block size (every block must fit a small-bin link).
 pub const MIN_BLOCK: usize = 16;
 
+/// Largest block size kept in the small bins.
+pub const SMALL_MAX: usize = 1024;
+
+/// Number of small bins (16, 32, ... [`SMALL_MAX`]).
+const NSMALL: usize = SMALL_MAX / 16;
+
+/// Smallest block that can be a tree node.
+const TREE_MIN: usize = core::mem::size_of::<TreeNode>();
+
 /// Round `value` up to the next multiple of `align`.
 #[inline]
 pub fn align_up(value: usize, align: usize) -> usize {
@@ -46,83 +58,351 @@ pub fn block_size(layout: Layout) -> usize {
     align_up(layout.size().max(MIN_BLOCK), layout.align().max(16))
 }
 
-/// Search the free list for a first-fit block of at least `size` bytes.
-///
-/// If a suitable block is found, it is removed from the free list (with optional
-/// splitting if the remainder is large enough) and returned as a pointer.
-/// Returns null if no suitable block exists.
-///
-/// # Safety
-/// `free_list` must point to a valid free list head pointer.
+/// Heap usage snapshot, reported to the kernel with `SYS_HEAP_REPORT`
+/// (same field order as the kernel's record).
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct HeapStats {
+    /// Bytes obtained from sbrk.
+    pub heap_bytes: u32,
+    /// Bytes handed out to callers (sbrk and mmap).
+    pub in_use: u32,
+    /// Bytes sitting on the free lists.
+    pub free: u32,
+    /// Size of the largest free block.
+    pub largest_free: u32,
+    /// Number of free blocks.
+    pub free_blocks: u32,
+    /// Bytes in direct mmap allocations.
+    pub mapped: u32,
+}
+
+/// Small-bin link — stored in-place in freed memory.
+#[repr(C)]
+struct BinBlock {
+    next: *mut BinBlock,
+}
+
+/// Block-tree node — stored in-place in freed memory, keyed by address.
+#[repr(C)]
+struct TreeNode {
+    size: usize,
+    /// Largest `size` in this subtree.
+    max: usize,
+    left: *mut TreeNode,
+    right: *mut TreeNode,
+}
+
+/// Treap priority, derived from the node address so it needs no storage.
 #[inline]
-pub unsafe fn free_list_alloc(free_list: *mut *mut FreeBlock, size: usize) -> *mut u8 {
-    let mut prev: *mut FreeBlock = ptr::null_mut();
-    let mut curr = *free_list;
-    while !curr.is_null() {
-        if (*curr).size >= size {
-            let remaining = (*curr).size - size;
-            if remaining >= MIN_BLOCK + 8 {
-                // Split: allocate from front, new free block after
-                let new_free = (curr as *mut u8).add(size) as *mut FreeBlock;
-                (*new_free).size = remaining;
-                (*new_free).next = (*curr).next;
-                if prev.is_null() { *free_list = new_free; } else { (*prev).next = new_free; }
-            } else {
-                // Use entire block
-                if prev.is_null() { *free_list = (*curr).next; } else { (*prev).next = (*curr).next; }
-            }
-            return curr as *mut u8;
+fn prio(n: *mut TreeNode) -> u64 {
+    ((n as u64) >> 4).wrapping_mul(0x9E37_79B9_7F4A_7C15)
+}
+
+#[inline]
+unsafe fn subtree_max(n: *mut TreeNode) -> usize {
+    if n.is_null() { 0 } else { (*n).max }
+}
+
+#[inline]
+unsafe fn update(n: *mut TreeNode) {
+    (*n).max = (*n).size.max(subtree_max((*n).left)).max(subtree_max((*n).right));
+}
+
+/// Split `t` into nodes below `key` (`*l`) and at or above it (`*r`).
+unsafe fn split(t: *mut TreeNode, key: usize, l: *mut *mut TreeNode, r: *mut *mut TreeNode) {
+    if t.is_null() {
+        *l = ptr::null_mut();
+        *r = ptr::null_mut();
+    } else if (t as usize) < key {
+        split((*t).right, key, &mut (*t).right, r);
+        *l = t;
+        update(t);
+    } else {
+        split((*t).left, key, l, &mut (*t).left);
+        *r = t;
+        update(t);
+    }
+}
+
+/// Join two treaps where every node of `a` lies below every node of `b`.
+unsafe fn merge(a: *mut TreeNode, b: *mut TreeNode) -> *mut TreeNode {
+    if a.is_null() { return b; }
+    if b.is_null() { return a; }
+    if prio(a) > prio(b) {
+        (*a).right = merge((*a).right, b);
+        update(a);
+        a
+    } else {
+        (*b).left = merge(a, (*b).left);
+        update(b);
+        b
+    }
+}
+
+unsafe fn tree_insert(link: *mut *mut TreeNode, n: *mut TreeNode) {
+    let t = *link;
+    if t.is_null() {
+        (*n).left = ptr::null_mut();
+        (*n).right = ptr::null_mut();
+        (*n).max = (*n).size;
+        *link = n;
+    } else if prio(n) > prio(t) {
+        split(t, n as usize, &mut (*n).left, &mut (*n).right);
+        update(n);
+        *link = n;
+    } else {
+        if (n as usize) < (t as usize) {
+            tree_insert(&mut (*t).left, n);
+        } else {
+            tree_insert(&mut (*t).right, n);
         }
-        prev = curr;
-        curr = (*curr).next;
+        update(t);
     }
-    ptr::null_mut()
 }
 
-/// Insert a freed block into the sorted free list with coalescing.
-///
-/// The block is inserted at its address-sorted position. Adjacent blocks
-/// are merged (coalesced) to reduce fragmentation.
+unsafe fn tree_remove(link: *mut *mut TreeNode, n: *mut TreeNode) {
+    let t = *link;
+    if t == n {
+        *link = merge((*t).left, (*t).right);
+    } else {
+        if (n as usize) < (t as usize) {
+            tree_remove(&mut (*t).left, n);
+        } else {
+            tree_remove(&mut (*t).right, n);
+        }
+        update(t);
+    }
+}
+
+/// Segregated free-block store: exact-size small bins plus an
+/// address-ordered block tree.  Not thread-safe; callers hold their own lock.
 ///
-/// # Safety
-/// `free_list` must point to a valid free list head pointer.
-/// `ptr` must point to a previously allocated block of `size` bytes.
-#[inline]
-pub unsafe fn free_list_dealloc(free_list: *mut *mut FreeBlock, ptr: *mut u8, size: usize) {
-    if ptr.is_null() { return; }
+/// Block sizes passed in and out are [`block_size`] values (multiples of
+/// 16, at least [`MIN_BLOCK`]); returned blocks are 16-byte aligned.
+pub struct FreeLists {
+    bins: [*mut BinBlock; NSMALL],
+    root: *mut TreeNode,
+    /// Bytes held by the small bins.
+    bin_bytes: usize,
+    /// Bytes held by the tree.
+    tree_bytes: usize,
+    /// Number of free blocks (bins and tree).
+    blocks: usize,
+}
+
+impl FreeLists {
+    pub const fn new() -> Self {
+        FreeLists {
+            bins: [ptr::null_mut(); NSMALL],
+            root: ptr::null_mut(),
+            bin_bytes: 0,
+            tree_bytes: 0,
+            blocks: 0,
+        }
+    }
+
+    /// Take a free block of exactly `size` bytes, or null if none fits.
+    ///
+    /// Blocks are only 16-byte aligned, so stricter alignments return null
+    /// and the caller carves a fresh, aligned block instead.
+    ///
+    /// # Safety
+    /// Every block handed to [`dealloc`](Self::dealloc) must still be owned
+    /// by this store.
+    pub unsafe fn alloc(&mut self, size: usize, align: usize) -> *mut u8 {
+        if align > 16 { return ptr::null_mut(); }
+
+        if size <= SMALL_MAX {
+            let p = self.bin_pop(size);
+            if !p.is_null() { return p; }
+        }
+
+        let mut p = self.tree_take(size);
+        if p.is_null() && size > SMALL_MAX && self.bin_bytes > 0 {
+            self.consolidate();
+            p = self.tree_take(size);
+        }
+        p
+    }
+
+    /// Return a block of `size` bytes to the store.
+    ///
+    /// # Safety
+    /// `ptr` must be a block of `size` bytes that is not already free.
+    pub unsafe fn dealloc(&mut self, ptr: *mut u8, size: usize) {
+        if ptr.is_null() { return; }
+        if size <= SMALL_MAX {
+            self.bin_push(ptr, size);
+        } else {
+            self.tree_free(ptr, size);
+        }
+    }
 
-    let block = ptr as *mut FreeBlock;
-    (*block).size = size;
+    /// Fill the free-list fields of `stats`.
+    pub fn fill_stats(&self, stats: &mut HeapStats) {
+        let mut largest = unsafe { subtree_max(self.root) };
+        if largest < SMALL_MAX {
+            if let Some(i) = self.bins.iter().rposition(|b| !b.is_null()) {
+                largest = largest.max((i + 1) * 16);
+            }
+        }
+        stats.free = (self.bin_bytes + self.tree_bytes) as u32;
+        stats.largest_free = largest as u32;
+        stats.free_blocks = self.blocks as u32;
+    }
+
+    #[inline]
+    unsafe fn bin_push(&mut self, p: *mut u8, size: usize) {
+        let i = size / 16 - 1;
+        let b = p as *mut BinBlock;
+        (*b).next = self.bins[i];
+        self.bins[i] = b;
+        self.bin_bytes += size;
+        self.blocks += 1;
+    }
+
+    #[inline]
+    unsafe fn bin_pop(&mut self, size: usize) -> *mut u8 {
+        let i = size / 16 - 1;
+        let b = self.bins[i];
+        if b.is_null() { return ptr::null_mut(); }
+        self.bins[i] = (*b).next;
+        self.bin_bytes -= size;
+        self.blocks -= 1;
+        b as *mut u8
+    }
+
+    /// Lowest-address tree block of at least `size` bytes.
+    unsafe fn tree_find(&self, size: usize) -> *mut TreeNode {
+        let mut t = self.root;
+        if subtree_max(t) < size { return ptr::null_mut(); }
+        loop {
+            if subtree_max((*t).left) >= size {
+                t = (*t).left;
+            } else if (*t).size >= size {
+                return t;
+            } else {
+                t = (*t).right;
+            }
+        }
+    }
 
-    // Insert sorted by address for coalescing
-    let mut prev: *mut FreeBlock = ptr::null_mut();
-    let mut curr = *free_list;
-    while !curr.is_null() && (curr as usize) < (block as usize) {
-        prev = curr;
-        curr = (*curr).next;
+    /// Tree block ending exactly at `addr`, if any.
+    unsafe fn tree_pred(&self, addr: usize) -> *mut TreeNode {
+        let mut t = self.root;
+        let mut best: *mut TreeNode = ptr::null_mut();
+        while !t.is_null() {
+            if (t as usize) < addr {
+                best = t;
+                t = (*t).right;
+            } else {
+                t = (*t).left;
+            }
+        }
+        if !best.is_null() && best as usize + (*best).size == addr { best } else { ptr::null_mut() }
     }
 
-    (*block).next = curr;
-    if prev.is_null() { *free_list = block; } else { (*prev).next = block; }
+    /// Tree block starting exactly at `addr`, if any.
+    unsafe fn tree_at(&self, addr: usize) -> *mut TreeNode {
+        let mut t = self.root;
+        while !t.is_null() && t as usize != addr {
+            t = if addr < t as usize { (*t).left } else { (*t).right };
+        }
+        t
+    }
 
-    // Coalesce with next
-    if !curr.is_null() && (block as *mut u8).add((*block).size) == curr as *mut u8 {
-        (*block).size += (*curr).size;
-        (*block).next = (*curr).next;
+    unsafe fn tree_unlink(&mut self, n: *mut TreeNode) {
+        tree_remove(&mut self.root, n);
+        self.tree_bytes -= (*n).size;
+        self.blocks -= 1;
     }
-    // Coalesce with prev
-    if !prev.is_null() && (prev as *mut u8).add((*prev).size) == block as *mut u8 {
-        (*prev).size += (*block).size;
-        (*prev).next = (*block).next;
+
+    unsafe fn tree_link(&mut self, n: *mut TreeNode, size: usize) {
+        (*n).size = size;
+        tree_insert(&mut self.root, n);
+        self.tree_bytes += size;
+        self.blocks += 1;
+    }
+
+    /// Remove a first-fit block and split off the tail it does not need.
+    unsafe fn tree_take(&mut self, size: usize) -> *mut u8 {
+        let n = self.tree_find(size);
+        if n.is_null() { return ptr::null_mut(); }
+        let total = (*n).size;
+        self.tree_unlink(n);
+        let rest = total - size;
+        if rest > 0 {
+            let tail = (n as *mut u8).add(size);
+            if rest > SMALL_MAX {
+                self.tree_link(tail as *mut TreeNode, rest);
+            } else {
+                self.bin_push(tail, rest);
+            }
+        }
+        n as *mut u8
+    }
+
+    /// Insert a block into the tree, merging it with free tree neighbours.
+    unsafe fn tree_free(&mut self, p: *mut u8, size: usize) {
+        let mut start = p as usize;
+        let mut size = size;
+
+        let next = self.tree_at(start + size);
+        if !next.is_null() {
+            size += (*next).size;
+            self.tree_unlink(next);
+        }
+        let prev = self.tree_pred(start);
+        if !prev.is_null() {
+            start = prev as usize;
+            size += (*prev).size;
+            self.tree_unlink(prev);
+        }
+
+        if size >= TREE_MIN {
+            self.tree_link(start as *mut TreeNode, size);
+        } else {
+            self.bin_push(start as *mut u8, size);
+        }
+    }
+
+    /// Move every small-bin block into the tree, coalescing as it goes.
+    /// 16-byte blocks are too small to be tree nodes: the ones that meet no
+    /// free neighbour go back to their bin, and that bin is swept again
+    /// while sweeps still merge something.
+    unsafe fn consolidate(&mut self) {
+        for i in 1..NSMALL {
+            self.drain_bin(i);
+        }
+        loop {
+            let before = self.blocks;
+            self.drain_bin(0);
+            if self.blocks == before { break; }
+        }
+    }
+
+    unsafe fn drain_bin(&mut self, i: usize) {
+        let size = (i + 1) * 16;
+        let mut b = self.bins[i];
+        self.bins[i] = ptr::null_mut();
+        while !b.is_null() {
+            let next = (*b).next;
+            self.bin_bytes -= size;
+            self.blocks -= 1;
+            self.tree_free(b as *mut u8, size);
+            b = next;
+        }
     }
 }
 
 /// Define a `#[global_allocator]` for a DLL with sbrk + mmap fallback.
 ///
 /// Generates a private module with a `DllFreeListAlloc` struct implementing
-/// `GlobalAlloc`. Small allocations use sbrk with a free list; large
+/// `GlobalAlloc`. Small allocations use sbrk with [`FreeLists`]; large
 /// allocations (>= 64 KiB) go directly through mmap. When sbrk fails,
-/// any allocation transparently falls back to mmap.
+/// any allocation transparently falls back to mmap. The free list and
+/// sbrk are guarded by a spinlock, so DLL threads may allocate.
 ///
 /// # Arguments
 ///
@@ -141,10 +421,14 @@ macro_rules! dll_allocator {
         mod _dll_heap {
             use core::alloc::{GlobalAlloc, Layout};
             use core::ptr;
+            use core::sync::atomic::{AtomicBool, Ordering};
 
             struct DllFreeListAlloc;
 
-            static mut FREE_LIST: *mut $crate::FreeBlock = ptr::null_mut();
+            /// Spinlock protecting the free list and sbrk.
+            static HEAP_LOCK: AtomicBool = AtomicBool::new(false);
+
+            static mut FREE: $crate::FreeLists = $crate::FreeLists::new();
 
             /// Allocations >= this size bypass sbrk and go directly through mmap.
             const MMAP_THRESHOLD: usize = 64 * 1024;
@@ -154,6 +438,21 @@ macro_rules! dll_allocator {
             /// End of the mmap virtual address region.
             const MMAP_REGION_END: u64 = 0xBF00_0000;
 
+            #[inline]
+            fn lock() {
+                while HEAP_LOCK
+                    .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+                    .is_err()
+                {
+                    core::hint::spin_loop();
+                }
+            }
+
+            #[inline]
+            fn unlock() {
+                HEAP_LOCK.store(false, Ordering::Release);
+            }
+
             /// Round `size` up to the next page boundary (4 KiB).
             #[inline]
             fn page_align(size: usize) -> usize {
@@ -191,9 +490,14 @@ macro_rules! dll_allocator {
                         return mmap_alloc(size);
                     }
 
-                    // 1) Search free list for first fit.
-                    let ptr = $crate::free_list_alloc(&mut FREE_LIST, size);
-                    if !ptr.is_null() { return ptr; }
+                    lock();
+
+                    // 1) Reuse a free block.
+                    let ptr = (*ptr::addr_of_mut!(FREE)).alloc(size, layout.align());
+                    if !ptr.is_null() {
+                        unlock();
+                        return ptr;
+                    }
 
                     // 2) Try sbrk.
                     let sbrk_fn: fn(u32) -> u64 = $sbrk;
@@ -204,9 +508,11 @@ macro_rules! dll_allocator {
                         let needed = (aligned - brk + size as u64) as u32;
                         let result = sbrk_fn(needed);
                         if result != u64::MAX {
+                            unlock();
                             return aligned as *mut u8;
                         }
                     }
+                    unlock();
 
                     // 3) sbrk failed — fall back to mmap.
                     mmap_alloc(size)
@@ -225,12 +531,10 @@ macro_rules! dll_allocator {
                         return;
                     }
 
-                    // sbrk allocations go back to the free list.
-                    $crate::free_list_dealloc(
-                        &mut FREE_LIST,
-                        ptr,
-                        size,
-                    );
+                    // sbrk allocations go back to the free lists.
+                    lock();
+                    (*ptr::addr_of_mut!(FREE)).dealloc(ptr, size);
+                    unlock();
                 }
             }
 
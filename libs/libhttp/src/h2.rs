@@ -0,0 +1,593 @@
+//! HTTP/2 client (RFC 9113) for libhttp.
+//!
+//! Used on HTTPS connections whose server selected `h2` during the TLS
+//! handshake (ALPN).  Requests become concurrent streams on the one
+//! connection, up to the server's SETTINGS_MAX_CONCURRENT_STREAMS, and
+//! responses are collected as their frames arrive in any order.
+//!
+//! Flow control: the receive windows are opened wide at start-up and
+//! replenished with WINDOW_UPDATE once half is consumed; request bodies
+//! (POST) are sent within the server's connection and stream windows.
+//! Server push is disabled.  Responses are handed back with an
+//! HTTP/1-style header block so `http` can parse them like any other.
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::hpack;
+use crate::http::{self, ERR_NO_RESPONSE, ERR_SEND_FAILURE};
+use crate::pool::Conn;
+use crate::url::{Url, parse_u32, push_u32};
+
+// ── Protocol constants ──────────────────────────────────────────────────────
+
+const PREFACE: &[u8] = b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+const FRAME_DATA: u8 = 0x0;
+const FRAME_HEADERS: u8 = 0x1;
+const FRAME_RST_STREAM: u8 = 0x3;
+const FRAME_SETTINGS: u8 = 0x4;
+const FRAME_PUSH_PROMISE: u8 = 0x5;
+const FRAME_PING: u8 = 0x6;
+const FRAME_GOAWAY: u8 = 0x7;
+const FRAME_WINDOW_UPDATE: u8 = 0x8;
+const FRAME_CONTINUATION: u8 = 0x9;
+
+const FLAG_END_STREAM: u8 = 0x1;
+const FLAG_ACK: u8 = 0x1;
+const FLAG_END_HEADERS: u8 = 0x4;
+const FLAG_PADDED: u8 = 0x8;
+const FLAG_PRIORITY: u8 = 0x20;
+
+const SETTINGS_HEADER_TABLE_SIZE: u16 = 0x1;
+const SETTINGS_ENABLE_PUSH: u16 = 0x2;
+const SETTINGS_MAX_CONCURRENT_STREAMS: u16 = 0x3;
+const SETTINGS_INITIAL_WINDOW_SIZE: u16 = 0x4;
+const SETTINGS_MAX_FRAME_SIZE: u16 = 0x5;
+
+/// Window size every connection and stream starts with (RFC 9113 §6.9.2).
+const DEFAULT_WINDOW: i64 = 65_535;
+/// Frame size both sides accept before SETTINGS say otherwise.
+const DEFAULT_MAX_FRAME: usize = 16_384;
+/// Receive window advertised per stream.
+const STREAM_WINDOW: u32 = 1 << 20;
+/// Receive window opened for the whole connection.
+const CONN_WINDOW: u32 = 16 << 20;
+/// HPACK dynamic table size we accept from the server (the default).
+const HEADER_TABLE_SIZE: usize = 4096;
+/// Largest header block (HEADERS + CONTINUATION) accepted.
+const MAX_HEADER_BLOCK: usize = 64 * 1024;
+/// Streams opened before the server's first SETTINGS arrives.
+const INITIAL_MAX_STREAMS: u32 = 100;
+
+const USER_AGENT: &str = "libhttp/1.0 (anyOS)";
+
+// ── Requests and replies ────────────────────────────────────────────────────
+
+/// A request to send on an HTTP/2 connection.
+pub(crate) struct Request<'a> {
+    pub url: &'a Url,
+    /// `(body, content_type)` for POST; `None` for GET.
+    pub post: Option<(&'a [u8], &'a str)>,
+    /// Do not ask for content-encoding (file downloads).
+    pub raw: bool,
+    /// Stale cache entry to revalidate (GET only).
+    pub cached: Option<&'a libhttpcache::Entry>,
+    /// Resume offset sent as `range: bytes=N-` (GET only; 0 for none).
+    pub range: u32,
+}
+
+/// A complete response.
+pub(crate) struct Reply {
+    /// `HTTP/2 <status>` line plus `name: value` lines, CRLF-separated,
+    /// so the HTTP/1 header helpers apply unchanged.
+    pub head: String,
+    pub body: Vec<u8>,
+}
+
+// ── Session ─────────────────────────────────────────────────────────────────
+
+/// Connection-level HTTP/2 state, kept with the pooled connection.
+pub(crate) struct Session {
+    decoder: hpack::Decoder,
+    next_stream_id: u32,
+    max_streams: u32,
+    peer_initial_window: i64,
+    peer_max_frame: usize,
+    send_window: i64,
+    recv_unacked: u32,
+    /// Last stream id the server will process, once it sent GOAWAY.
+    goaway: Option<u32>,
+    /// Set on a connection error; the session must not be reused.
+    broken: bool,
+}
+
+/// Per-request stream state.
+struct Stream {
+    id: u32,
+    slot: usize,
+    send_window: i64,
+    /// Bytes of the POST body already sent.
+    body_sent: usize,
+    head: String,
+    content_length: u32,
+    body: Vec<u8>,
+    recv_unacked: u32,
+    headers_done: bool,
+    done: bool,
+    failed: bool,
+}
+
+/// A frame read from the connection.
+struct Frame {
+    kind: u8,
+    flags: u8,
+    stream: u32,
+    payload: Vec<u8>,
+}
+
+impl Session {
+    /// Send the connection preface on a freshly negotiated `h2` connection.
+    pub fn start(conn: &Conn) -> Result<Box<Session>, u32> {
+        let mut out = Vec::with_capacity(64);
+        out.extend_from_slice(PREFACE);
+        let mut settings = Vec::new();
+        push_setting(&mut settings, SETTINGS_ENABLE_PUSH, 0);
+        push_setting(&mut settings, SETTINGS_INITIAL_WINDOW_SIZE, STREAM_WINDOW);
+        push_frame(&mut out, FRAME_SETTINGS, 0, 0, &settings);
+        push_window_update(&mut out, 0, CONN_WINDOW - DEFAULT_WINDOW as u32);
+        if !http::send_data(conn, &out) {
+            return Err(ERR_SEND_FAILURE);
+        }
+        Ok(Box::new(Session {
+            decoder: hpack::Decoder::new(HEADER_TABLE_SIZE),
+            next_stream_id: 1,
+            max_streams: INITIAL_MAX_STREAMS,
+            peer_initial_window: DEFAULT_WINDOW,
+            peer_max_frame: DEFAULT_MAX_FRAME,
+            send_window: DEFAULT_WINDOW,
+            recv_unacked: 0,
+            goaway: None,
+            broken: false,
+        }))
+    }
+
+    /// Whether new streams may still be opened.
+    pub fn usable(&self) -> bool {
+        !self.broken && self.goaway.is_none() && self.next_stream_id < 0x7FFF_FFFF
+    }
+}
+
+// ── Fetching ────────────────────────────────────────────────────────────────
+
+/// Run `requests` concurrently on `conn` (which must carry a session).
+///
+/// `on_done(index, result)` is called once per request as it completes.
+/// Requests the connection could not finish (reset, GOAWAY, connection
+/// failure) fail with `ERR_NO_RESPONSE` and may be retried elsewhere.
+pub(crate) fn fetch(
+    conn: &mut Conn,
+    requests: &[Request],
+    on_done: &mut dyn FnMut(usize, Result<Reply, u32>),
+) {
+    let mut session = match conn.h2.take() {
+        Some(s) => s,
+        None => {
+            for i in 0..requests.len() {
+                on_done(i, Err(ERR_NO_RESPONSE));
+            }
+            return;
+        }
+    };
+    run(conn, &mut session, requests, on_done);
+    conn.h2 = Some(session);
+}
+
+fn run(
+    conn: &mut Conn,
+    s: &mut Session,
+    requests: &[Request],
+    on_done: &mut dyn FnMut(usize, Result<Reply, u32>),
+) {
+    // Progress is only meaningful for a single transfer.
+    let report = requests.len() == 1;
+    let mut next = 0usize;
+    let mut active: Vec<Stream> = Vec::new();
+    // Header block being assembled: (stream, END_STREAM seen, bytes).
+    let mut block: Option<(u32, bool, Vec<u8>)> = None;
+
+    loop {
+        // Open as many streams as the server allows.
+        let mut out = Vec::new();
+        while next < requests.len() && s.usable() && (active.len() as u32) < s.max_streams {
+            let id = s.next_stream_id;
+            s.next_stream_id += 2;
+            push_request_headers(&mut out, s, id, &requests[next]);
+            active.push(Stream {
+                id,
+                slot: next,
+                send_window: s.peer_initial_window,
+                body_sent: 0,
+                head: String::new(),
+                content_length: 0,
+                body: Vec::new(),
+                recv_unacked: 0,
+                headers_done: false,
+                done: false,
+                failed: false,
+            });
+            next += 1;
+        }
+        push_bodies(&mut out, s, &mut active, requests);
+        if !out.is_empty() && !http::send_data(conn, &out) {
+            s.broken = true;
+        }
+
+        // Hand back finished streams.
+        let mut i = 0;
+        while i < active.len() {
+            if active[i].done || active[i].failed || s.broken {
+                let st = active.remove(i);
+                if st.done && !st.failed {
+                    on_done(st.slot, Ok(Reply { head: st.head, body: st.body }));
+                } else {
+                    on_done(st.slot, Err(ERR_NO_RESPONSE));
+                }
+            } else {
+                i += 1;
+            }
+        }
+        if active.is_empty() && (next >= requests.len() || !s.usable()) {
+            break;
+        }
+
+        let frame = match read_frame(conn) {
+            Some(f) => f,
+            None => {
+                s.broken = true;
+                continue;
+            }
+        };
+        if block.is_some() && frame.kind != FRAME_CONTINUATION {
+            s.broken = true; // CONTINUATION must follow immediately
+            continue;
+        }
+        let mut out = Vec::new();
+        match frame.kind {
+            FRAME_DATA => {
+                let len = frame.payload.len() as u32;
+                s.recv_unacked += len;
+                if s.recv_unacked >= CONN_WINDOW / 2 {
+                    push_window_update(&mut out, 0, s.recv_unacked);
+                    s.recv_unacked = 0;
+                }
+                let data = match strip_padding(&frame.payload, frame.flags) {
+                    Some(d) => d,
+                    None => { s.broken = true; continue; }
+                };
+                if let Some(st) = active.iter_mut().find(|st| st.id == frame.stream) {
+                    st.body.extend_from_slice(data);
+                    if report {
+                        http::report_progress(st.body.len() as u32, st.content_length);
+                    }
+                    if frame.flags & FLAG_END_STREAM != 0 {
+                        st.done = true;
+                    } else {
+                        st.recv_unacked += len;
+                        if st.recv_unacked >= STREAM_WINDOW / 2 {
+                            push_window_update(&mut out, st.id, st.recv_unacked);
+                            st.recv_unacked = 0;
+                        }
+                    }
+                }
+            }
+            FRAME_HEADERS => {
+                let mut data = match strip_padding(&frame.payload, frame.flags) {
+                    Some(d) => d,
+                    None => { s.broken = true; continue; }
+                };
+                if frame.flags & FLAG_PRIORITY != 0 {
+                    if data.len() < 5 { s.broken = true; continue; }
+                    data = &data[5..];
+                }
+                let end_stream = frame.flags & FLAG_END_STREAM != 0;
+                if frame.flags & FLAG_END_HEADERS != 0 {
+                    if !on_headers(s, &mut active, frame.stream, end_stream, data) {
+                        s.broken = true;
+                    }
+                } else {
+                    block = Some((frame.stream, end_stream, Vec::from(data)));
+                }
+            }
+            FRAME_CONTINUATION => {
+                let complete = match block.as_mut() {
+                    Some((id, _, bytes)) if *id == frame.stream => {
+                        bytes.extend_from_slice(&frame.payload);
+                        if bytes.len() > MAX_HEADER_BLOCK { s.broken = true; continue; }
+                        frame.flags & FLAG_END_HEADERS != 0
+                    }
+                    _ => { s.broken = true; continue; }
+                };
+                if complete {
+                    let (id, end_stream, bytes) = block.take().unwrap();
+                    if !on_headers(s, &mut active, id, end_stream, &bytes) {
+                        s.broken = true;
+                    }
+                }
+            }
+            FRAME_RST_STREAM => {
+                if let Some(st) = active.iter_mut().find(|st| st.id == frame.stream) {
+                    st.failed = true;
+                }
+            }
+            FRAME_SETTINGS => {
+                if frame.flags & FLAG_ACK == 0 {
+                    if !apply_settings(s, &mut active, &frame.payload) {
+                        s.broken = true;
+                        continue;
+                    }
+                    push_frame(&mut out, FRAME_SETTINGS, FLAG_ACK, 0, &[]);
+                }
+            }
+            FRAME_PING => {
+                if frame.flags & FLAG_ACK == 0 && frame.payload.len() == 8 {
+                    push_frame(&mut out, FRAME_PING, FLAG_ACK, 0, &frame.payload);
+                }
+            }
+            FRAME_GOAWAY => {
+                let last = if frame.payload.len() >= 4 { read_u31(&frame.payload) } else { 0 };
+                s.goaway = Some(last);
+                for st in active.iter_mut() {
+                    if st.id > last {
+                        st.failed = true;
+                    }
+                }
+            }
+            FRAME_WINDOW_UPDATE => {
+                if frame.payload.len() == 4 {
+                    let inc = read_u31(&frame.payload) as i64;
+                    if frame.stream == 0 {
+                        s.send_window += inc;
+                    } else if let Some(st) = active.iter_mut().find(|st| st.id == frame.stream) {
+                        st.send_window += inc;
+                    }
+                }
+            }
+            FRAME_PUSH_PROMISE => {
+                // Push was disabled in our SETTINGS.
+                s.broken = true;
+            }
+            _ => {} // PRIORITY and unknown frame types are ignored
+        }
+        if !out.is_empty() && !http::send_data(conn, &out) {
+            s.broken = true;
+        }
+    }
+
+    // Requests never opened (GOAWAY or broken connection).
+    for slot in next..requests.len() {
+        on_done(slot, Err(ERR_NO_RESPONSE));
+    }
+}
+
+/// Decode a complete header block for `stream_id`.  Returns false on a
+/// compression error (fatal: the HPACK state is lost).
+fn on_headers(s: &mut Session, active: &mut [Stream], stream_id: u32, end_stream: bool, block: &[u8]) -> bool {
+    // Always decode, even for unknown streams, to keep the table in sync.
+    let headers = match s.decoder.decode(block) {
+        Some(h) => h,
+        None => return false,
+    };
+    let st = match active.iter_mut().find(|st| st.id == stream_id) {
+        Some(st) => st,
+        None => return true,
+    };
+    if !st.headers_done {
+        let status = headers.iter()
+            .find(|(n, _)| n == ":status")
+            .and_then(|(_, v)| crate::url::parse_u16(v))
+            .unwrap_or(0);
+        if (100..200).contains(&status) {
+            return true; // interim response; the real one follows
+        }
+        let mut head = String::from("HTTP/2 ");
+        push_u32(&mut head, status as u32);
+        head.push_str("\r\n");
+        for (name, value) in headers.iter().filter(|(n, _)| !n.starts_with(':')) {
+            head.push_str(name);
+            head.push_str(": ");
+            head.push_str(value);
+            head.push_str("\r\n");
+            if name == "content-length" {
+                st.content_length = parse_u32(value).unwrap_or(0);
+            }
+        }
+        head.push_str("\r\n");
+        st.head = head;
+        st.headers_done = true;
+    }
+    // Headers after the first block are trailers and only end the stream.
+    if end_stream {
+        st.done = true;
+    }
+    true
+}
+
+/// Apply a SETTINGS frame from the server.
+fn apply_settings(s: &mut Session, active: &mut [Stream], payload: &[u8]) -> bool {
+    if payload.len() % 6 != 0 {
+        return false;
+    }
+    for entry in payload.chunks(6) {
+        let id = ((entry[0] as u16) << 8) | entry[1] as u16;
+        let value = ((entry[2] as u32) << 24) | ((entry[3] as u32) << 16)
+            | ((entry[4] as u32) << 8) | entry[5] as u32;
+        match id {
+            SETTINGS_MAX_CONCURRENT_STREAMS => s.max_streams = value.max(1),
+            SETTINGS_INITIAL_WINDOW_SIZE => {
+                if value > 0x7FFF_FFFF {
+                    return false;
+                }
+                // Changes apply to open streams too (RFC 9113 §6.9.2).
+                let delta = value as i64 - s.peer_initial_window;
+                for st in active.iter_mut() {
+                    st.send_window += delta;
+                }
+                s.peer_initial_window = value as i64;
+            }
+            SETTINGS_MAX_FRAME_SIZE => {
+                if !(16_384..=16_777_215).contains(&value) {
+                    return false;
+                }
+                s.peer_max_frame = value as usize;
+            }
+            // The encoder never indexes, so the server's table size does
+            // not matter to us.
+            SETTINGS_HEADER_TABLE_SIZE => {}
+            _ => {}
+        }
+    }
+    true
+}
+
+// ── Frame I/O ───────────────────────────────────────────────────────────────
+
+/// Read one frame, using bytes left in `conn.pending` first.
+fn read_frame(conn: &mut Conn) -> Option<Frame> {
+    let mut recv_buf = [0u8; 16384];
+    let mut buf = core::mem::take(&mut conn.pending);
+    loop {
+        if buf.len() >= 9 {
+            let len = ((buf[0] as usize) << 16) | ((buf[1] as usize) << 8) | buf[2] as usize;
+            if len > DEFAULT_MAX_FRAME {
+                return None; // we never raised SETTINGS_MAX_FRAME_SIZE
+            }
+            if buf.len() >= 9 + len {
+                let frame = Frame {
+                    kind: buf[3],
+                    flags: buf[4],
+                    stream: read_u31(&buf[5..9]),
+                    payload: Vec::from(&buf[9..9 + len]),
+                };
+                conn.pending = buf.split_off(9 + len);
+                return Some(frame);
+            }
+        }
+        let n = http::recv_some(conn, &mut recv_buf);
+        if n == 0 {
+            return None;
+        }
+        buf.extend_from_slice(&recv_buf[..n]);
+    }
+}
+
+/// Append the HEADERS (+ CONTINUATION) frames of a request.
+fn push_request_headers(out: &mut Vec<u8>, s: &Session, id: u32, req: &Request) {
+    let url = req.url;
+    let mut block = Vec::with_capacity(128);
+    hpack::encode_indexed(&mut block, if req.post.is_some() { hpack::IDX_METHOD_POST } else { hpack::IDX_METHOD_GET });
+    hpack::encode_indexed(&mut block, hpack::IDX_SCHEME_HTTPS);
+    hpack::encode_literal(&mut block, hpack::IDX_PATH, &url.path);
+    let mut authority = url.host.clone();
+    if url.port != 443 {
+        authority.push(':');
+        push_u32(&mut authority, url.port as u32);
+    }
+    hpack::encode_literal(&mut block, hpack::IDX_AUTHORITY, &authority);
+    hpack::encode_literal(&mut block, hpack::IDX_USER_AGENT, USER_AGENT);
+    hpack::encode_literal(&mut block, hpack::IDX_ACCEPT, "*/*");
+    if !req.raw {
+        hpack::encode_literal(&mut block, hpack::IDX_ACCEPT_ENCODING, "gzip, deflate");
+    }
+    if let Some(entry) = req.cached {
+        if let Some(etag) = entry.etag() {
+            hpack::encode_literal(&mut block, hpack::IDX_IF_NONE_MATCH, etag);
+        }
+        if let Some(modified) = entry.last_modified() {
+            hpack::encode_literal(&mut block, hpack::IDX_IF_MODIFIED_SINCE, modified);
+        }
+    }
+    if req.range > 0 {
+        let mut range = String::from("bytes=");
+        push_u32(&mut range, req.range);
+        range.push('-');
+        hpack::encode_literal(&mut block, hpack::IDX_RANGE, &range);
+    }
+    let mut flags = FLAG_END_STREAM;
+    if let Some((body, content_type)) = req.post {
+        hpack::encode_literal(&mut block, hpack::IDX_CONTENT_TYPE, content_type);
+        let mut len = String::new();
+        push_u32(&mut len, body.len() as u32);
+        hpack::encode_literal(&mut block, hpack::IDX_CONTENT_LENGTH, &len);
+        if !body.is_empty() {
+            flags = 0;
+        }
+    }
+
+    let mut chunks = block.chunks(s.peer_max_frame).peekable();
+    let mut kind = FRAME_HEADERS;
+    while let Some(chunk) = chunks.next() {
+        let mut f = if kind == FRAME_HEADERS { flags } else { 0 };
+        if chunks.peek().is_none() {
+            f |= FLAG_END_HEADERS;
+        }
+        push_frame(out, kind, f, id, chunk);
+        kind = FRAME_CONTINUATION;
+    }
+}
+
+/// Append DATA frames for POST bodies as far as the send windows allow.
+fn push_bodies(out: &mut Vec<u8>, s: &mut Session, active: &mut [Stream], requests: &[Request]) {
+    for st in active.iter_mut() {
+        let body = match requests[st.slot].post {
+            Some((body, _)) if st.body_sent < body.len() => body,
+            _ => continue,
+        };
+        while st.body_sent < body.len() {
+            let window = s.send_window.min(st.send_window);
+            if window <= 0 {
+                break;
+            }
+            let n = (body.len() - st.body_sent).min(window as usize).min(s.peer_max_frame);
+            let end = st.body_sent + n;
+            let flags = if end == body.len() { FLAG_END_STREAM } else { 0 };
+            push_frame(out, FRAME_DATA, flags, st.id, &body[st.body_sent..end]);
+            st.body_sent = end;
+            s.send_window -= n as i64;
+            st.send_window -= n as i64;
+        }
+    }
+}
+
+fn push_frame(out: &mut Vec<u8>, kind: u8, flags: u8, stream: u32, payload: &[u8]) {
+    let len = payload.len() as u32;
+    out.extend_from_slice(&[(len >> 16) as u8, (len >> 8) as u8, len as u8, kind, flags]);
+    out.extend_from_slice(&(stream & 0x7FFF_FFFF).to_be_bytes());
+    out.extend_from_slice(payload);
+}
+
+fn push_setting(out: &mut Vec<u8>, id: u16, value: u32) {
+    out.extend_from_slice(&id.to_be_bytes());
+    out.extend_from_slice(&value.to_be_bytes());
+}
+
+fn push_window_update(out: &mut Vec<u8>, stream: u32, increment: u32) {
+    push_frame(out, FRAME_WINDOW_UPDATE, 0, stream, &(increment & 0x7FFF_FFFF).to_be_bytes());
+}
+
+/// Remove the padding of a PADDED DATA/HEADERS payload.
+fn strip_padding(payload: &[u8], flags: u8) -> Option<&[u8]> {
+    if flags & FLAG_PADDED == 0 {
+        return Some(payload);
+    }
+    let pad = *payload.first()? as usize;
+    if pad + 1 > payload.len() {
+        return None;
+    }
+    Some(&payload[1..payload.len() - pad])
+}
+
+fn read_u31(b: &[u8]) -> u32 {
+    (((b[0] as u32) << 24) | ((b[1] as u32) << 16) | ((b[2] as u32) << 8) | b[3] as u32) & 0x7FFF_FFFF
+}
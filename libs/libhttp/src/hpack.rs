@@ -0,0 +1,343 @@
+//! HPACK header compression (RFC 7541) for the HTTP/2 client.
+//!
+//! The decoder implements the whole format: static and dynamic tables,
+//! prefixed integers and Huffman-coded string literals.  The encoder only
+//! emits literals without indexing and raw strings; requests carry a handful
+//! of headers, so leaving the server's decoder table untouched costs a few
+//! bytes and keeps the sending side stateless.
+
+use alloc::collections::VecDeque;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+/// Static table indices used by the encoder.
+pub const IDX_AUTHORITY: usize = 1;
+pub const IDX_METHOD_GET: usize = 2;
+pub const IDX_METHOD_POST: usize = 3;
+pub const IDX_PATH: usize = 4;
+pub const IDX_SCHEME_HTTPS: usize = 7;
+pub const IDX_ACCEPT_ENCODING: usize = 16;
+pub const IDX_ACCEPT: usize = 19;
+pub const IDX_CONTENT_LENGTH: usize = 28;
+pub const IDX_CONTENT_TYPE: usize = 31;
+pub const IDX_IF_MODIFIED_SINCE: usize = 40;
+pub const IDX_IF_NONE_MATCH: usize = 41;
+pub const IDX_RANGE: usize = 50;
+pub const IDX_USER_AGENT: usize = 58;
+
+/// Per-entry overhead counted against the table size (RFC 7541 §4.1).
+const ENTRY_OVERHEAD: usize = 32;
+
+// ── Decoder ─────────────────────────────────────────────────────────────────
+
+/// Header block decoder with its dynamic table.  One per connection.
+pub struct Decoder {
+    /// Dynamic table, newest entry first.
+    table: VecDeque<(String, String)>,
+    size: usize,
+    max_size: usize,
+    /// SETTINGS_HEADER_TABLE_SIZE we advertised (upper bound for updates).
+    limit: usize,
+}
+
+impl Decoder {
+    pub fn new(limit: usize) -> Self {
+        Decoder { table: VecDeque::new(), size: 0, max_size: limit, limit }
+    }
+
+    /// Decode a complete header block.  `None` is a compression error,
+    /// which is fatal for the connection.
+    pub fn decode(&mut self, block: &[u8]) -> Option<Vec<(String, String)>> {
+        let mut headers = Vec::new();
+        let mut pos = 0;
+        while pos < block.len() {
+            let b = block[pos];
+            if b & 0x80 != 0 {
+                // Indexed header field
+                let index = decode_int(block, &mut pos, 7)?;
+                let (name, value) = self.lookup(index)?;
+                headers.push((String::from(name), String::from(value)));
+            } else if b & 0x40 != 0 {
+                // Literal with incremental indexing
+                let (name, value) = self.decode_literal(block, &mut pos, 6)?;
+                self.insert(name.clone(), value.clone());
+                headers.push((name, value));
+            } else if b & 0x20 != 0 {
+                // Dynamic table size update
+                let size = decode_int(block, &mut pos, 5)?;
+                if size > self.limit {
+                    return None;
+                }
+                self.max_size = size;
+                self.evict(0);
+            } else {
+                // Literal without indexing / never indexed
+                let (name, value) = self.decode_literal(block, &mut pos, 4)?;
+                headers.push((name, value));
+            }
+        }
+        Some(headers)
+    }
+
+    fn decode_literal(&self, block: &[u8], pos: &mut usize, prefix: u32) -> Option<(String, String)> {
+        let index = decode_int(block, pos, prefix)?;
+        let name = if index == 0 {
+            decode_string(block, pos)?
+        } else {
+            String::from(self.lookup(index)?.0)
+        };
+        let value = decode_string(block, pos)?;
+        Some((name, value))
+    }
+
+    fn lookup(&self, index: usize) -> Option<(&str, &str)> {
+        if index == 0 {
+            None
+        } else if index <= STATIC_TABLE.len() {
+            Some(STATIC_TABLE[index - 1])
+        } else {
+            self.table.get(index - STATIC_TABLE.len() - 1)
+                .map(|(n, v)| (n.as_str(), v.as_str()))
+        }
+    }
+
+    fn insert(&mut self, name: String, value: String) {
+        let entry = name.len() + value.len() + ENTRY_OVERHEAD;
+        if entry > self.max_size {
+            // An oversized entry empties the table (RFC 7541 §4.4).
+            self.table.clear();
+            self.size = 0;
+            return;
+        }
+        self.evict(entry);
+        self.size += entry;
+        self.table.push_front((name, value));
+    }
+
+    /// Drop old entries until `incoming` more bytes fit.
+    fn evict(&mut self, incoming: usize) {
+        while self.size + incoming > self.max_size {
+            match self.table.pop_back() {
+                Some((n, v)) => self.size -= n.len() + v.len() + ENTRY_OVERHEAD,
+                None => break,
+            }
+        }
+    }
+}
+
+/// Decode a prefixed integer (RFC 7541 §5.1) starting at `*pos`.
+fn decode_int(data: &[u8], pos: &mut usize, prefix: u32) -> Option<usize> {
+    let mask = ((1u32 << prefix) - 1) as usize;
+    let mut value = (*data.get(*pos)? as usize) & mask;
+    *pos += 1;
+    if value < mask {
+        return Some(value);
+    }
+    let mut shift = 0;
+    loop {
+        let b = *data.get(*pos)?;
+        *pos += 1;
+        if shift > 28 {
+            return None;
+        }
+        value += ((b & 0x7F) as usize) << shift;
+        shift += 7;
+        if b & 0x80 == 0 {
+            return Some(value);
+        }
+    }
+}
+
+/// Decode a string literal (RFC 7541 §5.2) starting at `*pos`.
+fn decode_string(data: &[u8], pos: &mut usize) -> Option<String> {
+    let huffman = *data.get(*pos)? & 0x80 != 0;
+    let len = decode_int(data, pos, 7)?;
+    let end = pos.checked_add(len)?;
+    let raw = data.get(*pos..end)?;
+    *pos = end;
+    if huffman {
+        let bytes = huffman_decode(raw)?;
+        Some(String::from_utf8_lossy(&bytes).into_owned())
+    } else {
+        Some(String::from_utf8_lossy(raw).into_owned())
+    }
+}
+
+/// Decode Huffman-coded bytes.  The code is canonical, so symbols are
+/// found from the per-length counts alone (as in deflate).
+fn huffman_decode(data: &[u8]) -> Option<Vec<u8>> {
+    let mut out = Vec::with_capacity(data.len() * 8 / 5);
+    let mut code: u32 = 0; // bits of the current symbol so far
+    let mut first: u32 = 0; // first code of the current length
+    let mut index: usize = 0; // index of that code in HUFFMAN_SYMBOLS
+    let mut len: usize = 0;
+    let mut ones = true; // current partial code is all 1 bits (padding)
+
+    for &byte in data {
+        for bit in (0..8).rev() {
+            let b = ((byte >> bit) & 1) as u32;
+            code |= b;
+            ones &= b == 1;
+            len += 1;
+            let count = HUFFMAN_COUNTS[len] as u32;
+            if code.wrapping_sub(first) < count {
+                let sym = HUFFMAN_SYMBOLS[index + (code - first) as usize];
+                if sym == 256 {
+                    return None; // EOS inside a string is an error
+                }
+                out.push(sym as u8);
+                code = 0;
+                first = 0;
+                index = 0;
+                len = 0;
+                ones = true;
+                continue;
+            }
+            if len >= 30 {
+                return None;
+            }
+            index += count as usize;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+    }
+    // Leftover bits must be a prefix of EOS (all ones), shorter than a byte.
+    if len > 7 || !ones {
+        return None;
+    }
+    Some(out)
+}
+
+// ── Encoder ─────────────────────────────────────────────────────────────────
+
+/// Append an indexed header field (static table entry).
+pub fn encode_indexed(out: &mut Vec<u8>, index: usize) {
+    encode_int(out, index, 7, 0x80);
+}
+
+/// Append a literal without indexing whose name is static entry `name_index`.
+pub fn encode_literal(out: &mut Vec<u8>, name_index: usize, value: &str) {
+    encode_int(out, name_index, 4, 0x00);
+    encode_raw_string(out, value.as_bytes());
+}
+
+/// Append a literal without indexing with a literal (lowercase) name.
+pub fn encode_literal_new(out: &mut Vec<u8>, name: &str, value: &str) {
+    out.push(0x00);
+    encode_raw_string(out, name.as_bytes());
+    encode_raw_string(out, value.as_bytes());
+}
+
+fn encode_raw_string(out: &mut Vec<u8>, s: &[u8]) {
+    encode_int(out, s.len(), 7, 0x00);
+    out.extend_from_slice(s);
+}
+
+fn encode_int(out: &mut Vec<u8>, mut value: usize, prefix: u32, flags: u8) {
+    let mask = (1usize << prefix) - 1;
+    if value < mask {
+        out.push(flags | value as u8);
+        return;
+    }
+    out.push(flags | mask as u8);
+    value -= mask;
+    while value >= 0x80 {
+        out.push((value & 0x7F) as u8 | 0x80);
+        value >>= 7;
+    }
+    out.push(value as u8);
+}
+
+// ── Tables ──────────────────────────────────────────────────────────────────
+
+/// Static table (RFC 7541 Appendix A); index 1 is the first entry.
+const STATIC_TABLE: [(&str, &str); 61] = [
+    (":authority", ""),
+    (":method", "GET"),
+    (":method", "POST"),
+    (":path", "/"),
+    (":path", "/index.html"),
+    (":scheme", "http"),
+    (":scheme", "https"),
+    (":status", "200"),
+    (":status", "204"),
+    (":status", "206"),
+    (":status", "304"),
+    (":status", "400"),
+    (":status", "404"),
+    (":status", "500"),
+    ("accept-charset", ""),
+    ("accept-encoding", "gzip, deflate"),
+    ("accept-language", ""),
+    ("accept-ranges", ""),
+    ("accept", ""),
+    ("access-control-allow-origin", ""),
+    ("age", ""),
+    ("allow", ""),
+    ("authorization", ""),
+    ("cache-control", ""),
+    ("content-disposition", ""),
+    ("content-encoding", ""),
+    ("content-language", ""),
+    ("content-length", ""),
+    ("content-location", ""),
+    ("content-range", ""),
+    ("content-type", ""),
+    ("cookie", ""),
+    ("date", ""),
+    ("etag", ""),
+    ("expect", ""),
+    ("expires", ""),
+    ("from", ""),
+    ("host", ""),
+    ("if-match", ""),
+    ("if-modified-since", ""),
+    ("if-none-match", ""),
+    ("if-range", ""),
+    ("if-unmodified-since", ""),
+    ("last-modified", ""),
+    ("link", ""),
+    ("location", ""),
+    ("max-forwards", ""),
+    ("proxy-authenticate", ""),
+    ("proxy-authorization", ""),
+    ("range", ""),
+    ("referer", ""),
+    ("refresh", ""),
+    ("retry-after", ""),
+    ("server", ""),
+    ("set-cookie", ""),
+    ("strict-transport-security", ""),
+    ("transfer-encoding", ""),
+    ("user-agent", ""),
+    ("vary", ""),
+    ("via", ""),
+    ("www-authenticate", ""),
+];
+
+/// Number of Huffman codes per code length (index = length in bits).
+const HUFFMAN_COUNTS: [u16; 31] = [
+    0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3,
+    0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4,
+];
+
+/// Symbols ordered by (code length, symbol); 256 is EOS.
+const HUFFMAN_SYMBOLS: [u16; 257] = [
+    48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+    52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+    110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+    77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+    119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+    43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+    195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+    179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+    163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+    233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+    158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+    144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+    200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+    212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+    2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+    21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+    256,
+];
@@ -3,17 +3,32 @@
 //! Supports GET and POST requests with automatic redirect following,
 //! Content-Length and chunked transfer-encoding body reading,
 //! gzip/deflate content-encoding decompression, and HTTPS via BearSSL.
+//!
+//! Connections are kept alive and reused through `pool`; `get_many`
+//! additionally pipelines GETs to the same origin.  HTTPS connections on
+//! which the server negotiated HTTP/2 go through `h2` instead, where all
+//! requests to the origin run concurrently as streams.
+//!
+//! GET responses go through the shared disk cache (`libhttpcache`): fresh
+//! entries are returned without a request, stale ones are revalidated with
+//! `If-None-Match` / `If-Modified-Since`.
+//!
+//! `download_stream` hands the body to a caller-supplied sink as it arrives
+//! instead of buffering it, and resumes at an offset with `Range`.
 
+use alloc::collections::VecDeque;
 use alloc::string::String;
 use alloc::vec::Vec;
 
 use crate::syscall;
 use crate::tls;
+use crate::h2;
+use crate::pool::{self, Conn};
 use crate::url::{
     Url, clone_url, find_header_value, parse_hex, parse_u32, parse_url,
-    push_u32, resolve_url, starts_with_ignore_case, parse_ip,
+    push_u32, resolve_url, starts_with_ignore_case,
 };
-use crate::deflate;
+use libhttpcache::{self as cache, Entry, Lookup};
 
 // ── Error codes ─────────────────────────────────────────────────────────────
 
@@ -32,9 +47,10 @@ pub const ERR_FILE_WRITE: u32 = 9;
 // ── Constants ───────────────────────────────────────────────────────────────
 
 const MAX_REDIRECTS: usize = 10;
-const CONNECT_TIMEOUT_MS: u32 = 10_000;
 const MAX_HEADER_SIZE: usize = 16384;
 const RECV_BUF_SIZE: usize = 16384;
+/// Requests in flight per connection in `get_many`.
+const PIPELINE_DEPTH: usize = 4;
 
 // ── Last request state ──────────────────────────────────────────────────────
 
@@ -46,6 +62,28 @@ static mut PROGRESS_CB: Option<extern "C" fn(u32, u32, u64)> = None;
 /// Userdata passed to the progress callback.
 static mut PROGRESS_UD: u64 = 0;
 
+/// Body sink: `(data, len, offset, userdata) -> continue`.
+pub type SinkFn = extern "C" fn(*const u8, u32, u32, u64) -> u32;
+
+/// Streaming state of a `download_stream()` call.
+struct Sink {
+    write: SinkFn,
+    userdata: u64,
+    /// File offset of the next body byte; requested with `Range` when
+    /// non-zero, so a retried request continues where the last one broke.
+    pos: u32,
+    /// The current response's body goes to the sink (a 200 or 206).
+    active: bool,
+    /// The sink asked to stop.
+    aborted: bool,
+}
+
+/// Set by `download_stream()` for use by the request builders and body readers.
+static mut SINK: Option<Sink> = None;
+
+/// Use the shared HTTP cache for GETs.
+static mut CACHE_ENABLED: bool = true;
+
 /// Set the last HTTP status code.
 pub(crate) fn set_status(status: u32) {
     unsafe { LAST_STATUS = status; }
@@ -66,6 +104,15 @@ pub fn last_error() -> u32 {
     unsafe { LAST_ERROR }
 }
 
+/// Report body progress to the `download_to_file()` callback, if any.
+pub(crate) fn report_progress(received: u32, total: u32) {
+    unsafe {
+        if let Some(cb) = PROGRESS_CB {
+            cb(received, total, PROGRESS_UD);
+        }
+    }
+}
+
 // ── HTTP GET to buffer ──────────────────────────────────────────────────────
 
 /// Perform an HTTP(S) GET request and return the response body.
@@ -97,6 +144,9 @@ pub fn get(url_str: &str) -> Option<Vec<u8>> {
 /// Perform an HTTP(S) GET and write the response body directly to a file.
 /// Uses raw mode (no Accept-Encoding, no decompression) so the file is
 /// stored with exactly the bytes the server sends.
+///
+/// Cached copies are always revalidated, so a download never returns an
+/// outdated file without asking the server.
 pub fn download(url_str: &str, path: &str) -> bool {
     download_to_file(url_str, path, None, 0)
 }
@@ -152,6 +202,73 @@ pub fn download_to_file(
     }
 }
 
+/// Perform an HTTP(S) GET in raw mode and stream the body to `sink`,
+/// starting at byte `offset` of the resource.
+///
+/// A non-zero offset is requested with `Range: bytes=offset-`.  The sink
+/// is told where each piece belongs: a 206 continues at the offset, while
+/// a server that ignores the range answers 200 and restarts at 0.  Only
+/// 200/206 bodies reach the sink.  The sink returns 0 to abort.
+///
+/// Streamed bodies bypass the disk cache.  Over HTTP/2 the body is handed
+/// over once the stream completes.
+pub fn download_stream(
+    url_str: &str,
+    offset: u32,
+    sink: SinkFn,
+    callback: Option<extern "C" fn(u32, u32, u64)>,
+    userdata: u64,
+) -> bool {
+    set_status(0);
+    set_error(ERR_NONE);
+
+    let url = match parse_url(url_str) {
+        Some(u) => u,
+        None => {
+            set_error(ERR_INVALID_URL);
+            return false;
+        }
+    };
+
+    unsafe {
+        PROGRESS_CB = callback;
+        PROGRESS_UD = userdata;
+        SINK = Some(Sink { write: sink, userdata, pos: offset, active: false, aborted: false });
+    }
+
+    let result = fetch_stream(&url);
+
+    unsafe {
+        PROGRESS_CB = None;
+    }
+
+    let ok = match result {
+        Ok((status, head, mut body)) => {
+            set_status(status as u32);
+            if !body.is_empty() {
+                // HTTP/2 replies arrive whole.
+                sink_start(status, &head);
+                let mut streamed = 0usize;
+                stream_body(&mut body, &mut streamed, None);
+            }
+            if status >= 400 {
+                false
+            } else if unsafe { SINK.as_ref().map(|s| s.aborted).unwrap_or(false) } {
+                set_error(ERR_FILE_WRITE);
+                false
+            } else {
+                true
+            }
+        }
+        Err(err) => {
+            set_error(err);
+            false
+        }
+    };
+    unsafe { SINK = None; }
+    ok
+}
+
 /// Perform an HTTP(S) POST request.
 pub fn post(url_str: &str, body: &[u8], content_type: &str) -> Option<Vec<u8>> {
     set_status(0);
@@ -177,6 +294,272 @@ pub fn post(url_str: &str, body: &[u8], content_type: &str) -> Option<Vec<u8>> {
     }
 }
 
+// ── Batch GET ───────────────────────────────────────────────────────────────
+
+/// Fetch several URLs, reusing connections per origin.
+///
+/// URLs are grouped by scheme+host+port and fetched over pooled keep-alive
+/// connections.  Once a connection has returned one persistent response,
+/// up to `PIPELINE_DEPTH` GETs are written back to back before reading the
+/// responses in order.  Requests left unanswered when a connection fails
+/// or closes are re-sent on a fresh connection (once).
+///
+/// `on_done(index, result)` is called once per URL with the decompressed
+/// body, in completion order.  Returns the number of successful fetches.
+pub fn get_many(
+    urls: &[&str],
+    on_done: &mut dyn FnMut(usize, Result<(u16, Vec<u8>), u32>),
+) -> usize {
+    set_status(0);
+    set_error(ERR_NONE);
+
+    let parsed: Vec<Option<Url>> = urls.iter().map(|u| parse_url(u)).collect();
+    let mut cached: Vec<Option<(String, Lookup)>> = Vec::with_capacity(urls.len());
+    let mut origins: Vec<Vec<usize>> = Vec::new();
+    let mut ok = 0usize;
+
+    for (i, url) in parsed.iter().enumerate() {
+        cached.push(None);
+        let url = match url {
+            Some(u) => u,
+            None => {
+                on_done(i, Err(ERR_INVALID_URL));
+                continue;
+            }
+        };
+        match cache_lookup(url, false) {
+            (_, Lookup::Fresh(entry)) => {
+                ok += 1;
+                on_done(i, Ok((entry.status, entry.body)));
+                continue;
+            }
+            lookup => cached[i] = Some(lookup),
+        }
+        let group = origins.iter_mut().find(|g| {
+            let first = parsed[g[0]].as_ref().unwrap();
+            first.scheme == url.scheme && first.host == url.host && first.port == url.port
+        });
+        match group {
+            Some(g) => g.push(i),
+            None => origins.push(alloc::vec![i]),
+        }
+    }
+
+    let mut done = |i: usize, result: Result<(u16, Vec<u8>), u32>| {
+        if result.is_ok() { ok += 1; }
+        on_done(i, result);
+    };
+    for group in origins {
+        fetch_origin(&parsed, &mut cached, group, &mut done);
+    }
+    ok
+}
+
+/// Fetch all `indices` (same origin) from `urls`, see `get_many`.
+/// `cached[i]` holds the cache key and lookup result of `urls[i]`.
+fn fetch_origin(
+    urls: &[Option<Url>],
+    cached: &mut [Option<(String, Lookup)>],
+    indices: Vec<usize>,
+    on_done: &mut dyn FnMut(usize, Result<(u16, Vec<u8>), u32>),
+) {
+    let origin = match urls[indices[0]].as_ref() {
+        Some(u) => u,
+        None => return,
+    };
+    let https = origin.scheme == "https";
+    let mut attempts: Vec<u8> = alloc::vec![0; urls.len()];
+    let mut queue: VecDeque<usize> = indices.into_iter().collect();
+    // Followed after the origin's connection is released: a redirect to
+    // another HTTPS origin needs the single TLS session.
+    let mut redirects: Vec<(usize, Url)> = Vec::new();
+
+    'connections: while !queue.is_empty() {
+        let mut conn = match pool::checkout(&origin.host, origin.port, https) {
+            Ok(c) => c,
+            Err(err) => {
+                for i in queue.drain(..) {
+                    on_done(i, Err(err));
+                }
+                break;
+            }
+        };
+        if conn.h2.is_some() {
+            // HTTP/2: everything left goes out at once as streams.
+            let batch: Vec<usize> = queue.drain(..).collect();
+            let requests: Vec<h2::Request> = batch.iter().map(|&i| {
+                attempts[i] += 1;
+                h2::Request {
+                    url: urls[i].as_ref().unwrap(),
+                    post: None,
+                    raw: false,
+                    cached: stale_entry(cached, i),
+                    range: 0,
+                }
+            }).collect();
+            let mut completed: Vec<(usize, u16, String, Vec<u8>)> = Vec::new();
+            let mut failed: Vec<(usize, u32)> = Vec::new();
+            h2::fetch(&mut conn, &requests, &mut |k, result| {
+                let i = batch[k];
+                match result {
+                    Ok(reply) => match reply_action(reply, false) {
+                        ResponseAction::Redirect(location) => {
+                            redirects.push((i, resolve_url(urls[i].as_ref().unwrap(), &location)));
+                        }
+                        ResponseAction::Complete(status, head, body) => {
+                            completed.push((i, status, head, body));
+                        }
+                    },
+                    Err(err) => failed.push((i, err)),
+                }
+            });
+            drop(requests);
+            pool::checkin(conn);
+            for (i, status, head, body) in completed {
+                on_done(i, Ok(cache_complete(cached[i].take(), status, &head, body)));
+            }
+            for (i, err) in failed {
+                requeue(&mut queue, &[i], &attempts, err, on_done);
+            }
+            continue;
+        }
+
+        // Pipelining is only safe once the server has shown it keeps the
+        // connection open.
+        let mut proven = conn.reused;
+
+        while !queue.is_empty() {
+            let depth = if proven { PIPELINE_DEPTH } else { 1 };
+            let batch: Vec<usize> = queue.drain(..depth.min(queue.len())).collect();
+            let mut request = Vec::new();
+            for &i in &batch {
+                attempts[i] += 1;
+                let url = urls[i].as_ref().unwrap();
+                request.extend_from_slice(build_get_request(url, false, stale_entry(cached, i)).as_bytes());
+            }
+
+            if !send_data(&conn, &request) {
+                pool::close(conn);
+                requeue(&mut queue, &batch, &attempts, ERR_SEND_FAILURE, on_done);
+                continue 'connections;
+            }
+
+            for (k, &i) in batch.iter().enumerate() {
+                match receive_response(&mut conn, false) {
+                    Ok(resp) => {
+                        match resp.action {
+                            ResponseAction::Redirect(location) => {
+                                let url = urls[i].as_ref().unwrap();
+                                redirects.push((i, resolve_url(url, &location)));
+                            }
+                            ResponseAction::Complete(status, head, body) => {
+                                on_done(i, Ok(cache_complete(cached[i].take(), status, &head, body)));
+                            }
+                        }
+                        if !resp.keep_alive {
+                            pool::close(conn);
+                            requeue(&mut queue, &batch[k + 1..], &attempts, ERR_NO_RESPONSE, on_done);
+                            continue 'connections;
+                        }
+                    }
+                    Err(err) => {
+                        pool::close(conn);
+                        requeue(&mut queue, &batch[k..], &attempts, err, on_done);
+                        continue 'connections;
+                    }
+                }
+            }
+            proven = true;
+        }
+        pool::checkin(conn);
+    }
+
+    for (i, url) in redirects {
+        on_done(i, fetch_get(&url, false));
+    }
+}
+
+/// Put unanswered requests back at the front of `queue`, failing those
+/// that were already retried.
+fn requeue(
+    queue: &mut VecDeque<usize>,
+    batch: &[usize],
+    attempts: &[u8],
+    err: u32,
+    on_done: &mut dyn FnMut(usize, Result<(u16, Vec<u8>), u32>),
+) {
+    for &i in batch.iter().rev() {
+        if attempts[i] >= 2 {
+            on_done(i, Err(err));
+        } else {
+            queue.push_front(i);
+        }
+    }
+}
+
+/// Close all idle keep-alive connections.
+pub fn close_idle() {
+    pool::close_all();
+}
+
+// ── HTTP cache ──────────────────────────────────────────────────────────────
+
+/// Enable (the default) or disable the shared HTTP cache.
+pub fn set_cache(enabled: bool) {
+    unsafe { CACHE_ENABLED = enabled; }
+}
+
+fn cache_enabled() -> bool {
+    unsafe { CACHE_ENABLED }
+}
+
+/// Cache key and lookup result for a GET of `url`.
+///
+/// Raw and decoded bodies are cached separately.  Raw (download) entries
+/// are never returned as fresh, only revalidated.
+fn cache_lookup(url: &Url, raw: bool) -> (String, Lookup) {
+    if !cache_enabled() {
+        return (String::new(), Lookup::Miss);
+    }
+    let mut key = if raw { String::from("raw ") } else { String::new() };
+    key.push_str(&cache::url_key(&url.scheme, &url.host, url.port, &url.path));
+    let lookup = match cache::lookup(&key) {
+        Lookup::Fresh(entry) if raw => {
+            if entry.etag().is_some() || entry.last_modified().is_some() {
+                Lookup::Stale(entry)
+            } else {
+                Lookup::Miss
+            }
+        }
+        lookup => lookup,
+    };
+    (key, lookup)
+}
+
+/// The stale entry `get_many` revalidates for `urls[i]`.
+fn stale_entry(cached: &[Option<(String, Lookup)>], i: usize) -> Option<&Entry> {
+    cached[i].as_ref().and_then(|(_, lookup)| lookup.stale())
+}
+
+/// Store a GET response in the cache, or answer a `304 Not Modified`
+/// from the revalidated entry.
+fn cache_complete(cached: Option<(String, Lookup)>, status: u16, head: &str, body: Vec<u8>) -> (u16, Vec<u8>) {
+    let (key, lookup) = match cached {
+        Some(c) if cache_enabled() => c,
+        _ => return (status, body),
+    };
+    if status == 304 {
+        if let Lookup::Stale(_) = lookup {
+            if let Some(entry) = cache::refresh(&key, head) {
+                return (entry.status, entry.body);
+            }
+        }
+        return (status, body);
+    }
+    cache::store(&key, status, head, &body);
+    (status, body)
+}
+
 // ── Internal fetch logic ────────────────────────────────────────────────────
 
 /// Core GET implementation with redirect following.
@@ -187,28 +570,37 @@ fn fetch_get(url: &Url, raw: bool) -> Result<(u16, Vec<u8>), u32> {
     let mut current = clone_url(url);
 
     for _redirect_n in 0..MAX_REDIRECTS {
-        let is_https = current.scheme == "https";
+        let (key, lookup) = cache_lookup(&current, raw);
+        if let Lookup::Fresh(entry) = lookup {
+            return Ok((entry.status, entry.body));
+        }
+        match exchange(&current, None, raw, lookup.stale())? {
+            ResponseAction::Redirect(location) => {
+                current = resolve_url(&current, &location);
+                continue;
+            }
+            ResponseAction::Complete(status, head, body) => {
+                return Ok(cache_complete(Some((key, lookup)), status, &head, body));
+            }
+        }
+    }
 
-        // 1. Connect
-        let sock = connect_to(&current.host, current.port, is_https)?;
+    Err(ERR_TOO_MANY_REDIRECTS)
+}
 
-        // 2. Build and send GET request
-        let request = build_get_request(&current, raw);
-        if !send_data(sock, request.as_bytes(), is_https) {
-            close_conn(sock, is_https);
-            return Err(ERR_SEND_FAILURE);
-        }
+/// GET for `download_stream`: raw, uncached, with redirect following.
+/// Returns status, response head and whatever body was not streamed.
+fn fetch_stream(url: &Url) -> Result<(u16, String, Vec<u8>), u32> {
+    let mut current = clone_url(url);
 
-        // 3. Receive and parse response
-        match receive_response(sock, is_https, raw)? {
+    for _redirect_n in 0..MAX_REDIRECTS {
+        match exchange(&current, None, true, None)? {
             ResponseAction::Redirect(location) => {
-                close_conn(sock, is_https);
                 current = resolve_url(&current, &location);
                 continue;
             }
-            ResponseAction::Complete(status, body) => {
-                close_conn(sock, is_https);
-                return Ok((status, body));
+            ResponseAction::Complete(status, head, body) => {
+                return Ok((status, head, body));
             }
         }
     }
@@ -222,38 +614,17 @@ fn fetch_post_inner(url: &Url, body: &[u8], content_type: &str) -> Result<(u16,
     let mut is_first = true;
 
     for _redirect_n in 0..MAX_REDIRECTS {
-        let is_https = current.scheme == "https";
-
-        let sock = connect_to(&current.host, current.port, is_https)?;
-
-        let request = if is_first {
-            build_post_request(&current, body, content_type)
-        } else {
-            build_get_request(&current, false)
-        };
-
-        if !send_data(sock, request.as_bytes(), is_https) {
-            close_conn(sock, is_https);
-            return Err(ERR_SEND_FAILURE);
-        }
+        // Send POST body only on the first request, not on redirects
+        let post = if is_first { Some((body, content_type)) } else { None };
+        let action = exchange(&current, post, false, None)?;
 
-        // Send POST body after headers (only on first request, not redirects)
-        if is_first && !body.is_empty() {
-            if !send_data(sock, body, is_https) {
-                close_conn(sock, is_https);
-                return Err(ERR_SEND_FAILURE);
-            }
-        }
-
-        match receive_response(sock, is_https, false)? {
+        match action {
             ResponseAction::Redirect(location) => {
-                close_conn(sock, is_https);
                 current = resolve_url(&current, &location);
                 is_first = false;
                 continue;
             }
-            ResponseAction::Complete(status, resp_body) => {
-                close_conn(sock, is_https);
+            ResponseAction::Complete(status, _head, resp_body) => {
                 return Ok((status, resp_body));
             }
         }
@@ -262,52 +633,92 @@ fn fetch_post_inner(url: &Url, body: &[u8], content_type: &str) -> Result<(u16,
     Err(ERR_TOO_MANY_REDIRECTS)
 }
 
-// ── Connection management ───────────────────────────────────────────────────
+/// Send one request (GET, or POST with `(body, content_type)`) over a
+/// pooled connection and read the response.
+///
+/// A pooled connection may have been closed by the server while idle.
+/// If sending fails on one, the request is re-sent on a fresh connection;
+/// GETs are also retried when no response arrives.
+/// The connection goes back to the pool if the response left it reusable.
+///
+/// `cached` is a stale cache entry whose validators are sent with a GET.
+fn exchange(
+    url: &Url,
+    post: Option<(&[u8], &str)>,
+    raw: bool,
+    cached: Option<&Entry>,
+) -> Result<ResponseAction, u32> {
+    let is_https = url.scheme == "https";
+    let idempotent = post.is_none();
+    let mut conn = pool::checkout(&url.host, url.port, is_https)?;
 
-/// Establish a TCP connection (+ TLS handshake for HTTPS).
-fn connect_to(host: &str, port: u16, is_https: bool) -> Result<u32, u32> {
-    let ip = resolve_host(host).ok_or(ERR_DNS_FAILURE)?;
-    let sock = syscall::tcp_connect(&ip, port, CONNECT_TIMEOUT_MS);
-    if sock == u32::MAX {
-        return Err(ERR_CONNECT_FAILURE);
-    }
-    if is_https {
-        let ret = tls::connect(sock, host);
-        if ret != 0 {
-            syscall::tcp_close(sock);
-            return Err(ERR_TLS_HANDSHAKE_FAILED);
+    loop {
+        if conn.h2.is_some() {
+            let range = if post.is_none() { stream_offset() } else { 0 };
+            let request = h2::Request { url, post, raw, cached, range };
+            let mut result = Err(ERR_NO_RESPONSE);
+            h2::fetch(&mut conn, core::slice::from_ref(&request), &mut |_, r| result = r);
+            match result {
+                Ok(reply) => {
+                    pool::checkin(conn);
+                    return Ok(reply_action(reply, raw));
+                }
+                Err(err) => {
+                    let reused = conn.reused;
+                    pool::close(conn);
+                    if reused && idempotent {
+                        conn = pool::connect(&url.host, url.port, is_https)?;
+                        continue;
+                    }
+                    return Err(err);
+                }
+            }
         }
-    }
-    Ok(sock)
-}
 
-/// Close a connection (TLS + TCP).
-fn close_conn(sock: u32, is_https: bool) {
-    if is_https { tls::close(); }
-    syscall::tcp_close(sock);
-}
+        let (head, body) = match post {
+            Some((body, content_type)) => (build_post_request(url, body, content_type), body),
+            None => (build_get_request(url, raw, cached), &[][..]),
+        };
+        if !send_data(&conn, head.as_bytes()) || (!body.is_empty() && !send_data(&conn, body)) {
+            let reused = conn.reused;
+            pool::close(conn);
+            if reused {
+                conn = pool::connect(&url.host, url.port, is_https)?;
+                continue;
+            }
+            return Err(ERR_SEND_FAILURE);
+        }
 
-/// Resolve a hostname to an IPv4 address.
-fn resolve_host(host: &str) -> Option<[u8; 4]> {
-    if let Some(ip) = parse_ip(host) {
-        return Some(ip);
-    }
-    let mut resolved = [0u8; 4];
-    if syscall::dns_resolve(host, &mut resolved) == 0 {
-        Some(resolved)
-    } else {
-        None
+        match receive_response(&mut conn, raw) {
+            Ok(resp) => {
+                if resp.keep_alive {
+                    pool::checkin(conn);
+                } else {
+                    pool::close(conn);
+                }
+                return Ok(resp.action);
+            }
+            Err(err) => {
+                let reused = conn.reused;
+                pool::close(conn);
+                if reused && idempotent {
+                    conn = pool::connect(&url.host, url.port, is_https)?;
+                    continue;
+                }
+                return Err(err);
+            }
+        }
     }
 }
 
 // ── Data transport ──────────────────────────────────────────────────────────
 
 /// Send data over plain TCP or TLS.
-fn send_data(sock: u32, data: &[u8], is_https: bool) -> bool {
-    if is_https {
+pub(crate) fn send_data(conn: &Conn, data: &[u8]) -> bool {
+    if conn.https {
         tls::send(data) >= 0
     } else {
-        syscall::tcp_send(sock, data) != u32::MAX
+        syscall::tcp_send(conn.sock, data) != u32::MAX
     }
 }
 
@@ -316,13 +727,14 @@ fn send_data(sock: u32, data: &[u8], is_https: bool) -> bool {
 ///
 /// For plain TCP, retries up to 3 times on timeout (u32::MAX) if the
 /// connection is still alive, to handle transient delays during large transfers.
-fn recv_some(sock: u32, buf: &mut [u8], is_https: bool) -> usize {
-    if is_https {
+pub(crate) fn recv_some(conn: &Conn, buf: &mut [u8]) -> usize {
+    if conn.https {
         // TLS path — retry logic is in anyos_tcp_recv callback
         let n = tls::recv(buf);
         if n <= 0 { 0 } else { n as usize }
     } else {
         // Plain TCP path — retry on transient timeouts
+        let sock = conn.sock;
         for _ in 0..3 {
             let n = syscall::tcp_recv(sock, buf);
             if n == 0 {
@@ -347,24 +759,28 @@ fn recv_some(sock: u32, buf: &mut [u8], is_https: bool) -> usize {
 
 enum ResponseAction {
     Redirect(String),
-    Complete(u16, Vec<u8>),
+    /// Status, response head (status line and headers) and body.
+    Complete(u16, String, Vec<u8>),
+}
+
+struct Response {
+    action: ResponseAction,
+    /// The body was fully read and the server keeps the connection open.
+    keep_alive: bool,
 }
 
 /// Receive and parse an HTTP response (headers + body).
 /// When `raw` is true, body decompression is skipped.
-fn receive_response(sock: u32, is_https: bool, raw: bool) -> Result<ResponseAction, u32> {
+///
+/// Bytes already received past the previous response (`conn.pending`)
+/// are consumed first; bytes past the end of this one are left there.
+fn receive_response(conn: &mut Conn, raw: bool) -> Result<Response, u32> {
     // Receive headers
-    let mut response_buf: Vec<u8> = Vec::new();
+    let mut response_buf: Vec<u8> = core::mem::take(&mut conn.pending);
     let mut recv_buf = [0u8; RECV_BUF_SIZE];
     let header_end;
 
     loop {
-        let n = recv_some(sock, &mut recv_buf, is_https);
-        if n == 0 {
-            return Err(ERR_NO_RESPONSE);
-        }
-        response_buf.extend_from_slice(&recv_buf[..n]);
-
         if let Some(end) = find_header_end_bytes(&response_buf) {
             header_end = end;
             break;
@@ -372,51 +788,105 @@ fn receive_response(sock: u32, is_https: bool, raw: bool) -> Result<ResponseActi
         if response_buf.len() > MAX_HEADER_SIZE {
             return Err(ERR_NO_RESPONSE);
         }
+        let n = recv_some(conn, &mut recv_buf);
+        if n == 0 {
+            return Err(ERR_NO_RESPONSE);
+        }
+        response_buf.extend_from_slice(&recv_buf[..n]);
     }
 
     // Parse status line
     let header_str = core::str::from_utf8(&response_buf[..header_end]).unwrap_or("");
     let (status, _reason) = parse_status_line(header_str);
+    let persistent = match find_header_value(header_str, "connection") {
+        Some(v) if contains_ignore_case(v.as_bytes(), b"close") => false,
+        Some(v) if contains_ignore_case(v.as_bytes(), b"keep-alive") => true,
+        _ => !starts_with_ignore_case(header_str, "HTTP/1.0"),
+    };
 
-    // Handle redirects
-    if is_redirect(status) {
-        if let Some(location) = find_header_value(header_str, "location") {
-            return Ok(ResponseAction::Redirect(String::from(location)));
-        }
-        return Ok(ResponseAction::Complete(status, Vec::new()));
-    }
-
-    // Read body
     let is_chunked = find_header_value(header_str, "transfer-encoding")
         .map(|v| v.contains("chunked"))
         .unwrap_or(false);
     let content_length = parse_content_length(header_str);
     let content_encoding = find_header_value(header_str, "content-encoding")
         .map(|v| String::from(v));
+    let location = if is_redirect(status) {
+        find_header_value(header_str, "location").map(|v| String::from(v))
+    } else {
+        None
+    };
 
     let mut trailing = Vec::new();
     if header_end < response_buf.len() {
         trailing.extend_from_slice(&response_buf[header_end..]);
     }
 
-    let raw_body = if is_chunked {
-        read_chunked_body(sock, &trailing, is_https)
+    // Redirects and errors keep their bodies out of the sink.
+    sink_start(status, header_str);
+
+    // Handle redirects: drain a delimited body so the connection stays
+    // usable, without reporting it as download progress.
+    if let Some(location) = location {
+        let mut keep_alive = false;
+        if persistent && (is_chunked || content_length.is_some()) {
+            let cb = unsafe { PROGRESS_CB.take() };
+            keep_alive = if is_chunked {
+                read_chunked_body(conn, trailing).1
+            } else {
+                read_body(conn, trailing, content_length).1
+            };
+            unsafe { PROGRESS_CB = cb; }
+        }
+        return Ok(Response { action: ResponseAction::Redirect(location), keep_alive });
+    }
+
+    // Read body
+    let (raw_body, complete) = if status == 204 || status == 304 || (100..200).contains(&status) {
+        conn.pending = trailing;
+        (Vec::new(), true)
+    } else if is_chunked {
+        read_chunked_body(conn, trailing)
+    } else if content_length.is_some() {
+        read_body(conn, trailing, content_length)
     } else {
-        read_body(sock, &trailing, content_length, is_https)
+        // Delimited by connection close.
+        (read_body(conn, trailing, None).0, false)
     };
 
     // Decompress if content-encoded (skip in raw mode for file downloads)
     let body = if raw { raw_body } else { decompress_body(raw_body, &content_encoding) };
 
-    Ok(ResponseAction::Complete(status, body))
+    Ok(Response {
+        action: ResponseAction::Complete(status, String::from(header_str), body),
+        keep_alive: persistent && complete,
+    })
+}
+
+/// Turn an HTTP/2 reply into the same result `receive_response` gives.
+fn reply_action(reply: h2::Reply, raw: bool) -> ResponseAction {
+    let (status, _reason) = parse_status_line(&reply.head);
+    if is_redirect(status) {
+        if let Some(location) = find_header_value(&reply.head, "location") {
+            return ResponseAction::Redirect(String::from(location));
+        }
+    }
+    let body = if raw {
+        reply.body
+    } else {
+        let content_encoding = find_header_value(&reply.head, "content-encoding")
+            .map(|v| String::from(v));
+        decompress_body(reply.body, &content_encoding)
+    };
+    ResponseAction::Complete(status, reply.head, body)
 }
 
 // ── Request building ────────────────────────────────────────────────────────
 
 /// Build an HTTP GET request string.
 /// When `raw` is true, Accept-Encoding is omitted so the server sends
-/// uncompressed bytes (important for file downloads).
-fn build_get_request(url: &Url, raw: bool) -> String {
+/// uncompressed bytes (important for file downloads).  A stale `cached`
+/// entry adds its validators as conditional headers.
+fn build_get_request(url: &Url, raw: bool, cached: Option<&Entry>) -> String {
     let mut req = String::new();
     req.push_str("GET ");
     req.push_str(&url.path);
@@ -431,7 +901,23 @@ fn build_get_request(url: &Url, raw: bool) -> String {
     if !raw {
         req.push_str("\r\nAccept-Encoding: gzip, deflate");
     }
-    req.push_str("\r\nConnection: close");
+    if let Some(entry) = cached {
+        if let Some(etag) = entry.etag() {
+            req.push_str("\r\nIf-None-Match: ");
+            req.push_str(etag);
+        }
+        if let Some(modified) = entry.last_modified() {
+            req.push_str("\r\nIf-Modified-Since: ");
+            req.push_str(modified);
+        }
+    }
+    let range = stream_offset();
+    if range > 0 {
+        req.push_str("\r\nRange: bytes=");
+        push_u32(&mut req, range);
+        req.push('-');
+    }
+    req.push_str("\r\nConnection: keep-alive");
     req.push_str("\r\n\r\n");
     req
 }
@@ -453,7 +939,7 @@ fn build_post_request(url: &Url, body: &[u8], content_type: &str) -> String {
     req.push_str(content_type);
     req.push_str("\r\nContent-Length: ");
     push_u32(&mut req, body.len() as u32);
-    req.push_str("\r\nConnection: close");
+    req.push_str("\r\nConnection: keep-alive");
     req.push_str("\r\n\r\n");
     // Note: body bytes appended separately during send
     req
@@ -462,16 +948,25 @@ fn build_post_request(url: &Url, body: &[u8], content_type: &str) -> String {
 // ── Body reading ────────────────────────────────────────────────────────────
 
 /// Read body with Content-Length or until connection close.
+/// Returns the body and whether it was read completely; with a
+/// Content-Length, bytes past the body are left in `conn.pending`.
+/// While a sink is active the body goes there and the result is empty.
 ///
 /// When Content-Length is known, retries up to 5 times on recv_some()==0
 /// if the expected size hasn't been reached yet. This handles cases where
 /// TCP timeouts cause transient recv failures during large downloads.
-fn read_body(sock: u32, initial: &[u8], content_length: Option<u32>, is_https: bool) -> Vec<u8> {
-    let capacity = content_length
-        .map(|cl| (cl as usize).min(32 * 1024 * 1024))
-        .unwrap_or(65536);
-    let mut body: Vec<u8> = Vec::with_capacity(capacity);
-    body.extend_from_slice(initial);
+fn read_body(conn: &mut Conn, initial: Vec<u8>, content_length: Option<u32>) -> (Vec<u8>, bool) {
+    let capacity = if sink_active() {
+        RECV_BUF_SIZE * 2
+    } else {
+        content_length
+            .map(|cl| (cl as usize).min(32 * 1024 * 1024))
+            .unwrap_or(65536)
+    };
+    let mut body: Vec<u8> = initial;
+    body.reserve(capacity.saturating_sub(body.len()));
+    // Bytes already handed to the sink.
+    let mut streamed = 0usize;
 
     let total = content_length.unwrap_or(0);
 
@@ -481,21 +976,23 @@ fn read_body(sock: u32, initial: &[u8], content_length: Option<u32>, is_https: b
             cb(body.len() as u32, total, PROGRESS_UD);
         }
     }
+    let mut sink_ok = stream_body(&mut body, &mut streamed, content_length);
 
     let mut recv_buf = [0u8; RECV_BUF_SIZE];
     let mut consecutive_failures = 0u32;
     const MAX_RETRIES: u32 = 5;
 
-    loop {
+    while sink_ok {
+        let received = streamed + body.len();
         if let Some(cl) = content_length {
-            if body.len() >= cl as usize { break; }
+            if received >= cl as usize { break; }
         }
-        let n = recv_some(sock, &mut recv_buf, is_https);
+        let n = recv_some(conn, &mut recv_buf);
         if n == 0 {
             // recv_some returned 0 — could be EOF or transient failure.
             // If we know Content-Length and haven't received enough, retry.
             if let Some(cl) = content_length {
-                if body.len() < cl as usize && consecutive_failures < MAX_RETRIES {
+                if received < cl as usize && consecutive_failures < MAX_RETRIES {
                     consecutive_failures += 1;
                     syscall::sleep(200);
                     continue;
@@ -508,22 +1005,33 @@ fn read_body(sock: u32, initial: &[u8], content_length: Option<u32>, is_https: b
 
         unsafe {
             if let Some(cb) = PROGRESS_CB {
-                cb(body.len() as u32, total, PROGRESS_UD);
+                cb((streamed + body.len()) as u32, total, PROGRESS_UD);
             }
         }
+        sink_ok = stream_body(&mut body, &mut streamed, content_length);
+    }
+
+    match content_length {
+        Some(cl) if sink_ok && streamed + body.len() >= cl as usize => {
+            conn.pending = body.split_off(cl as usize - streamed);
+            (body, true)
+        }
+        _ => (body, false),
     }
-    body
 }
 
 /// Read a chunked transfer-encoded body.
+/// Returns the body and whether the terminating chunk and trailers were
+/// read; bytes past them are left in `conn.pending`.
 ///
 /// Retries on transient recv failures (up to 5 consecutive) to handle
 /// TCP timeouts during large chunked transfers.
-fn read_chunked_body(sock: u32, initial: &[u8], is_https: bool) -> Vec<u8> {
-    let mut buf: Vec<u8> = Vec::with_capacity(RECV_BUF_SIZE * 4);
-    buf.extend_from_slice(initial);
+fn read_chunked_body(conn: &mut Conn, initial: Vec<u8>) -> (Vec<u8>, bool) {
+    let mut buf: Vec<u8> = initial;
+    buf.reserve(RECV_BUF_SIZE * 4);
     let mut cursor: usize = 0;
     let mut body: Vec<u8> = Vec::with_capacity(65536);
+    let mut streamed = 0usize;
     let mut recv_buf = [0u8; RECV_BUF_SIZE];
 
     const MAX_RETRIES: u32 = 5;
@@ -543,10 +1051,10 @@ fn read_chunked_body(sock: u32, initial: &[u8], is_https: bool) -> Vec<u8> {
                 cursor += crlf + 2;
                 break;
             }
-            let n = recv_some(sock, &mut recv_buf, is_https);
+            let n = recv_some(conn, &mut recv_buf);
             if n == 0 {
                 failures += 1;
-                if failures >= MAX_RETRIES { return body; }
+                if failures >= MAX_RETRIES { return (body, false); }
                 syscall::sleep(200);
                 continue;
             }
@@ -559,7 +1067,7 @@ fn read_chunked_body(sock: u32, initial: &[u8], is_https: bool) -> Vec<u8> {
         // Read chunk data
         failures = 0;
         while buf.len() - cursor < chunk_size {
-            let n = recv_some(sock, &mut recv_buf, is_https);
+            let n = recv_some(conn, &mut recv_buf);
             if n == 0 {
                 failures += 1;
                 if failures >= MAX_RETRIES { break; }
@@ -573,21 +1081,27 @@ fn read_chunked_body(sock: u32, initial: &[u8], is_https: bool) -> Vec<u8> {
         let available = (buf.len() - cursor).min(chunk_size);
         body.extend_from_slice(&buf[cursor..cursor + available]);
         cursor += available;
+        if available < chunk_size {
+            return (body, false);
+        }
 
         // Fire progress callback after each chunk
         unsafe {
             if let Some(cb) = PROGRESS_CB {
-                cb(body.len() as u32, 0, PROGRESS_UD);
+                cb((streamed + body.len()) as u32, 0, PROGRESS_UD);
             }
         }
+        if !stream_body(&mut body, &mut streamed, None) {
+            return (body, false);
+        }
 
         // Skip trailing CRLF
         failures = 0;
         while buf.len() - cursor < 2 {
-            let n = recv_some(sock, &mut recv_buf, is_https);
+            let n = recv_some(conn, &mut recv_buf);
             if n == 0 {
                 failures += 1;
-                if failures >= MAX_RETRIES { return body; }
+                if failures >= MAX_RETRIES { return (body, false); }
                 syscall::sleep(200);
                 continue;
             }
@@ -605,7 +1119,90 @@ fn read_chunked_body(sock: u32, initial: &[u8], is_https: bool) -> Vec<u8> {
         }
     }
 
-    body
+    // Skip trailer fields up to the empty line ending the message.
+    let mut failures = 0u32;
+    loop {
+        if let Some(crlf) = find_crlf(&buf[cursor..]) {
+            cursor += crlf + 2;
+            if crlf == 0 { break; }
+            continue;
+        }
+        let n = recv_some(conn, &mut recv_buf);
+        if n == 0 {
+            failures += 1;
+            if failures >= MAX_RETRIES { return (body, false); }
+            syscall::sleep(200);
+            continue;
+        }
+        failures = 0;
+        buf.extend_from_slice(&recv_buf[..n]);
+    }
+
+    conn.pending = buf.split_off(cursor);
+    (body, true)
+}
+
+// ── Body streaming ──────────────────────────────────────────────────────────
+
+/// Offset to request with `Range` (0 outside `download_stream`).
+pub(crate) fn stream_offset() -> u32 {
+    unsafe { SINK.as_ref().map(|s| s.pos).unwrap_or(0) }
+}
+
+fn sink_active() -> bool {
+    unsafe { SINK.as_ref().map(|s| s.active).unwrap_or(false) }
+}
+
+/// Decide whether the body of a response with `status` and response head
+/// `head` goes to the sink, and at which offset it starts.
+fn sink_start(status: u16, head: &str) {
+    let sink = match unsafe { SINK.as_mut() } {
+        Some(s) => s,
+        None => return,
+    };
+    sink.active = match status {
+        200 => {
+            sink.pos = 0;
+            true
+        }
+        206 => {
+            // "Content-Range: bytes START-END/TOTAL"
+            if let Some(start) = find_header_value(head, "content-range")
+                .and_then(|v| v.trim_start_matches("bytes").trim().split('-').next())
+                .and_then(parse_u32)
+            {
+                sink.pos = start;
+            }
+            true
+        }
+        _ => false,
+    };
+}
+
+/// Hand the bytes of `body` up to `limit` bytes in total (`streamed` so far)
+/// to the active sink and drop them from `body`.
+/// Returns false if the sink asked to stop.
+fn stream_body(body: &mut Vec<u8>, streamed: &mut usize, limit: Option<u32>) -> bool {
+    let sink = match unsafe { SINK.as_mut() } {
+        Some(s) if s.active => s,
+        _ => return true,
+    };
+    let n = match limit {
+        Some(cl) => body.len().min((cl as usize).saturating_sub(*streamed)),
+        None => body.len(),
+    };
+    if n == 0 {
+        return true;
+    }
+    let ok = (sink.write)(body.as_ptr(), n as u32, sink.pos, sink.userdata) != 0;
+    sink.pos += n as u32;
+    *streamed += n;
+    body.drain(..n);
+    if !ok {
+        sink.aborted = true;
+        sink.active = false;
+    }
+    ok
 }
 
 // ── Header parsing helpers ──────────────────────────────────────────────────
@@ -667,12 +1264,12 @@ fn decompress_body(raw: Vec<u8>, content_encoding: &Option<String>) -> Vec<u8> {
     if let Some(ref enc) = content_encoding {
         let enc_bytes = enc.as_bytes();
         if contains_ignore_case(enc_bytes, b"gzip") {
-            if let Some(decoded) = deflate::decompress_gzip(&raw) {
+            if let Some(decoded) = libinflate::gzip_decompress(&raw) {
                 return decoded;
             }
         } else if contains_ignore_case(enc_bytes, b"deflate") {
-            if let Some(decoded) = deflate::decompress_zlib(&raw)
-                .or_else(|| deflate::decompress_deflate(&raw))
+            if let Some(decoded) = libinflate::zlib_decompress(&raw, 0)
+                .or_else(|| libinflate::inflate(&raw))
             {
                 return decoded;
             }
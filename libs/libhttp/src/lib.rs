@@ -7,8 +7,12 @@
 //! - HTTP and HTTPS (TLS via BearSSL with trust-all validator)
 //! - Automatic redirect following (301, 302, 303, 307, 308)
 //! - Chunked transfer-encoding support
-//! - gzip/deflate content-encoding decompression
+//! - gzip/deflate content-encoding decompression (libinflate)
 //! - Direct file download for memory efficiency
+//! - Keep-alive connection pool per process, with pipelined batch GETs
+//! - TLS session resumption, optionally persisted to a file
+//! - HTTP/2 over HTTPS (ALPN), with `get_many` requests multiplexed
+//! - Shared disk cache for GETs with conditional revalidation (`libhttpcache`)
 //!
 //! # Export Convention
 //! All public functions are `extern "C"` with `#[no_mangle]` for use via `dl_sym()`.
@@ -22,7 +26,9 @@ pub mod syscall;
 pub mod tls;
 pub mod url;
 pub mod http;
-pub mod deflate;
+pub mod pool;
+pub mod h2;
+pub mod hpack;
 
 // ── Allocator ───────────────────────────────────────────────────────────────
 
@@ -157,6 +163,99 @@ pub extern "C" fn libhttp_download_progress(
     if http::download_to_file(url_str, path, callback, userdata) { 0 } else { u32::MAX }
 }
 
+/// Download a URL, streaming the body to `sink` from byte `offset` on
+/// (sent as `Range: bytes=offset-` when non-zero).
+///
+/// `sink` is called with `(data_ptr, data_len, file_offset, userdata)` for
+/// each piece of the body and returns 0 to abort.  `file_offset` is where
+/// the piece belongs: a server that ignores the range restarts at 0.
+/// `callback` (optional) reports progress of this response as in
+/// `libhttp_download_progress`.  `libhttp_last_status()` tells 200 from 206.
+///
+/// Returns: 0 on success, `u32::MAX` on error.
+#[no_mangle]
+pub extern "C" fn libhttp_download_range(
+    url_ptr: *const u8, url_len: u32,
+    offset: u32,
+    sink: http::SinkFn,
+    callback: Option<extern "C" fn(u32, u32, u64)>,
+    userdata: u64,
+) -> u32 {
+    let url_str = unsafe {
+        core::str::from_utf8_unchecked(core::slice::from_raw_parts(url_ptr, url_len as usize))
+    };
+
+    if http::download_stream(url_str, offset, sink, callback, userdata) { 0 } else { u32::MAX }
+}
+
+/// Fetch several URLs, reusing and pipelining connections per origin.
+///
+/// `urls_ptr` holds the URLs separated by `\n`. `callback` is called once
+/// per URL with `(index, status, error, body_ptr, body_len, userdata)`;
+/// on failure `status` is 0 and `error` holds the error code. The body
+/// pointer is only valid during the callback.
+///
+/// Returns: number of URLs fetched successfully.
+#[no_mangle]
+pub extern "C" fn libhttp_get_many(
+    urls_ptr: *const u8, urls_len: u32,
+    callback: extern "C" fn(u32, u32, u32, *const u8, u32, u64),
+    userdata: u64,
+) -> u32 {
+    let urls_str = unsafe {
+        core::str::from_utf8_unchecked(core::slice::from_raw_parts(urls_ptr, urls_len as usize))
+    };
+    let urls: alloc::vec::Vec<&str> = urls_str.split('\n')
+        .map(|u| u.trim())
+        .filter(|u| !u.is_empty())
+        .collect();
+
+    let mut on_done = |index: usize, result: Result<(u16, alloc::vec::Vec<u8>), u32>| {
+        match result {
+            Ok((status, body)) => {
+                callback(index as u32, status as u32, http::ERR_NONE, body.as_ptr(), body.len() as u32, userdata)
+            }
+            Err(err) => callback(index as u32, 0, err, core::ptr::null(), 0, userdata),
+        }
+    };
+    http::get_many(&urls, &mut on_done) as u32
+}
+
+/// Close all idle keep-alive connections held by the library.
+#[no_mangle]
+pub extern "C" fn libhttp_close_idle() {
+    http::close_idle();
+}
+
+/// Keep the TLS session cache in the file at `path` so later processes can
+/// resume sessions instead of doing a full handshake. Sessions already in
+/// the file are loaded. `path_len` of 0 keeps the cache in memory only.
+#[no_mangle]
+pub extern "C" fn libhttp_set_session_cache(path_ptr: *const u8, path_len: u32) {
+    let path = if path_len == 0 {
+        ""
+    } else {
+        unsafe {
+            core::str::from_utf8_unchecked(core::slice::from_raw_parts(path_ptr, path_len as usize))
+        }
+    };
+    tls::set_session_cache_file(path);
+}
+
+/// Enable (`enable != 0`, the default) or disable HTTP/2 for HTTPS
+/// connections opened from now on.
+#[no_mangle]
+pub extern "C" fn libhttp_set_http2(enable: u32) {
+    pool::set_http2(enable != 0);
+}
+
+/// Enable (`enable != 0`, the default) or disable the shared HTTP cache
+/// for GET requests.
+#[no_mangle]
+pub extern "C" fn libhttp_set_cache(enable: u32) {
+    http::set_cache(enable != 0);
+}
+
 /// Returns the HTTP status code of the last request (e.g. 200, 404).
 #[no_mangle]
 pub extern "C" fn libhttp_last_status() -> u32 {
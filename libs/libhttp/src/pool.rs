@@ -0,0 +1,227 @@
+//! Per-process keep-alive connection pool for libhttp.
+//!
+//! Connections whose last response was delimited (Content-Length or
+//! chunked) and did not carry `Connection: close` are parked here keyed by
+//! scheme+host+port and handed out again for the next request to the same
+//! origin, saving the TCP handshake and, for HTTPS, the full TLS handshake.
+//!
+//! Idle connections are dropped after `IDLE_TIMEOUT_MS` or when the server
+//! has already closed them.  The BearSSL wrapper (`anyos_tls.c`) keeps a
+//! single global session, so at most one HTTPS connection exists at a
+//! time: opening a new one first closes an idle HTTPS connection to
+//! another origin.
+//!
+//! HTTPS connections offer `h2` via ALPN; when the server picks it, the
+//! connection carries an `h2::Session` and all its requests are
+//! multiplexed over it.
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::h2;
+use crate::syscall;
+use crate::tls;
+use crate::url::parse_ip;
+use crate::http::{ERR_CONNECT_FAILURE, ERR_DNS_FAILURE, ERR_TLS_HANDSHAKE_FAILED};
+
+// ── Constants ───────────────────────────────────────────────────────────────
+
+const CONNECT_TIMEOUT_MS: u32 = 10_000;
+
+/// Idle connections older than this are closed instead of reused.
+/// Common servers time out keep-alive connections after 5-60 s.
+const IDLE_TIMEOUT_MS: u32 = 15_000;
+
+/// Maximum number of idle connections kept per process.
+const MAX_IDLE: usize = 8;
+
+/// Maximum number of idle connections kept per origin.
+const MAX_IDLE_PER_ORIGIN: usize = 4;
+
+// ── Connection ──────────────────────────────────────────────────────────────
+
+/// An open connection to one origin.
+pub(crate) struct Conn {
+    pub sock: u32,
+    pub https: bool,
+    pub host: String,
+    pub port: u16,
+    /// Bytes received past the end of the previous response (pipelining).
+    pub pending: Vec<u8>,
+    /// True when the connection came out of the pool.  A failure on the
+    /// first exchange then most likely means the server closed it while
+    /// idle, and the request is retried on a fresh connection.
+    pub reused: bool,
+    /// HTTP/2 state when the server selected `h2`.
+    pub h2: Option<Box<h2::Session>>,
+}
+
+struct Idle {
+    conn: Conn,
+    since_ms: u32,
+}
+
+static mut IDLE_CONNS: Vec<Idle> = Vec::new();
+
+/// Offer HTTP/2 on new HTTPS connections.
+static mut HTTP2_ENABLED: bool = true;
+
+fn idle_conns() -> &'static mut Vec<Idle> {
+    unsafe { &mut *core::ptr::addr_of_mut!(IDLE_CONNS) }
+}
+
+// ── Public API ──────────────────────────────────────────────────────────────
+
+/// Get a connection to `host:port`, reusing an idle one when possible.
+pub(crate) fn checkout(host: &str, port: u16, https: bool) -> Result<Conn, u32> {
+    expire();
+    let idle = idle_conns();
+    // Most recently parked first: it is the least likely to have timed out.
+    if let Some(pos) = idle.iter().rposition(|i| {
+        i.conn.https == https && i.conn.port == port && i.conn.host == host
+    }) {
+        let mut conn = idle.remove(pos).conn;
+        conn.reused = true;
+        return Ok(conn);
+    }
+    connect(host, port, https)
+}
+
+/// Open a new connection, bypassing the idle list.
+pub(crate) fn connect(host: &str, port: u16, https: bool) -> Result<Conn, u32> {
+    if https {
+        close_idle_https();
+    }
+    let ip = resolve_host(host).ok_or(ERR_DNS_FAILURE)?;
+    let sock = syscall::tcp_connect(&ip, port, CONNECT_TIMEOUT_MS);
+    if sock == u32::MAX {
+        return Err(ERR_CONNECT_FAILURE);
+    }
+    if https {
+        tls::offer_h2(unsafe { HTTP2_ENABLED });
+        let ret = tls::connect(sock, host);
+        if ret != 0 {
+            syscall::tcp_close(sock);
+            return Err(ERR_TLS_HANDSHAKE_FAILED);
+        }
+    }
+    let mut conn = Conn {
+        sock,
+        https,
+        host: String::from(host),
+        port,
+        pending: Vec::new(),
+        reused: false,
+        h2: None,
+    };
+    if https && tls::selected_h2() {
+        match h2::Session::start(&conn) {
+            Ok(session) => conn.h2 = Some(session),
+            Err(err) => {
+                close(conn);
+                return Err(err);
+            }
+        }
+    }
+    Ok(conn)
+}
+
+/// Return a connection whose last response left it reusable.
+pub(crate) fn checkin(conn: Conn) {
+    let reusable = match conn.h2 {
+        Some(ref s) => s.usable(),
+        // Unread bytes would be taken for the next response.
+        None => conn.pending.is_empty(),
+    };
+    if !reusable {
+        close(conn);
+        return;
+    }
+    let idle = idle_conns();
+    let same_origin = idle.iter()
+        .filter(|i| i.conn.https == conn.https && i.conn.port == conn.port && i.conn.host == conn.host)
+        .count();
+    if same_origin >= MAX_IDLE_PER_ORIGIN {
+        if let Some(pos) = idle.iter().position(|i| {
+            i.conn.https == conn.https && i.conn.port == conn.port && i.conn.host == conn.host
+        }) {
+            close(idle.remove(pos).conn);
+        }
+    }
+    if idle.len() >= MAX_IDLE {
+        close(idle.remove(0).conn);
+    }
+    idle.push(Idle { conn, since_ms: syscall::uptime_ms() });
+}
+
+/// Close a connection (TLS + TCP).
+pub(crate) fn close(conn: Conn) {
+    if conn.https { tls::close(); }
+    syscall::tcp_close(conn.sock);
+}
+
+/// Enable or disable HTTP/2 for connections opened from now on.
+pub fn set_http2(enabled: bool) {
+    unsafe { HTTP2_ENABLED = enabled; }
+}
+
+/// Close every idle connection.
+pub fn close_all() {
+    for i in core::mem::take(idle_conns()) {
+        close(i.conn);
+    }
+}
+
+// ── Internal helpers ────────────────────────────────────────────────────────
+
+/// Drop idle connections that timed out or were closed by the server.
+fn expire() {
+    let now = syscall::uptime_ms();
+    let idle = idle_conns();
+    let mut i = 0;
+    while i < idle.len() {
+        let age = now.wrapping_sub(idle[i].since_ms);
+        let avail = syscall::tcp_recv_available(idle[i].conn.sock);
+        // Data on an idle HTTP/1 connection is either EOF or garbage; an
+        // HTTP/2 server may legitimately send SETTINGS, PING or
+        // WINDOW_UPDATE frames, which are read with the next request.
+        let dead = if idle[i].conn.h2.is_some() {
+            avail == u32::MAX || avail == u32::MAX - 1
+        } else {
+            avail != 0
+        };
+        if age > IDLE_TIMEOUT_MS || dead {
+            close(idle.remove(i).conn);
+        } else {
+            i += 1;
+        }
+    }
+}
+
+/// Close idle HTTPS connections before a new TLS handshake replaces the
+/// single global session.
+fn close_idle_https() {
+    let idle = idle_conns();
+    let mut i = 0;
+    while i < idle.len() {
+        if idle[i].conn.https {
+            close(idle.remove(i).conn);
+        } else {
+            i += 1;
+        }
+    }
+}
+
+/// Resolve a hostname to an IPv4 address.
+fn resolve_host(host: &str) -> Option<[u8; 4]> {
+    if let Some(ip) = parse_ip(host) {
+        return Some(ip);
+    }
+    let mut resolved = [0u8; 4];
+    if syscall::dns_resolve(host, &mut resolved) == 0 {
+        Some(resolved)
+    } else {
+        None
+    }
+}
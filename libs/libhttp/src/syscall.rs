@@ -4,6 +4,6 @@ pub use libsyscall::{
     exit, sleep, sbrk, mmap, munmap,
     open, close, read, write, file_size,
     dns_resolve, tcp_connect, tcp_send, tcp_recv, tcp_close, tcp_recv_available, tcp_status,
-    random, log,
+    random, log, uptime_ms,
     O_WRITE, O_CREATE, O_TRUNC,
 };
@@ -5,6 +5,13 @@
 //!
 //! The Rust side provides the TCP I/O callbacks (`anyos_tcp_send`,
 //! `anyos_tcp_recv`, `anyos_sleep`, `anyos_random`) that the C wrapper calls.
+//!
+//! The C wrapper caches session parameters per server name and resumes
+//! sessions on reconnect.  `set_session_cache_file` additionally keeps that
+//! cache in a file, so short-lived CLI processes share it.
+
+use alloc::string::String;
+use alloc::vec;
 
 use crate::syscall;
 
@@ -90,8 +97,19 @@ extern "C" {
     fn tls_recv(data: *mut u8, len: i32) -> i32;
     fn tls_close();
     fn tls_last_error() -> i32;
+    fn tls_session_cache_export(buf: *mut u8, len: i32) -> i32;
+    fn tls_session_cache_import(buf: *const u8, len: i32) -> i32;
+    fn tls_session_cache_dirty() -> i32;
+    fn tls_set_alpn_h2(enable: i32);
+    fn tls_alpn_is_h2() -> i32;
 }
 
+/// Upper bound for the exported session cache blob.
+const SESSION_BLOB_MAX: usize = 4096;
+
+/// File the session cache is persisted to (`None` = memory only).
+static mut SESSION_FILE: Option<String> = None;
+
 // ---------------------------------------------------------------------------
 // Public Rust API
 // ---------------------------------------------------------------------------
@@ -104,7 +122,9 @@ pub fn connect(fd: u32, host: &str) -> i32 {
     let len = host.len().min(host_buf.len() - 1);
     host_buf[..len].copy_from_slice(&host.as_bytes()[..len]);
     host_buf[len] = 0;
-    unsafe { tls_connect(fd as i32, host_buf.as_ptr()) }
+    let ret = unsafe { tls_connect(fd as i32, host_buf.as_ptr()) };
+    save_session_cache();
+    ret
 }
 
 /// Send data over the TLS connection.
@@ -128,3 +148,58 @@ pub fn close() {
 pub fn last_error() -> i32 {
     unsafe { tls_last_error() }
 }
+
+/// Offer `h2` via ALPN on subsequent connections.
+pub fn offer_h2(enable: bool) {
+    unsafe { tls_set_alpn_h2(enable as i32); }
+}
+
+/// Whether the server selected `h2` on the current connection.
+pub fn selected_h2() -> bool {
+    unsafe { tls_alpn_is_h2() != 0 }
+}
+
+/// Persist the session cache in `path` and load any sessions already
+/// stored there.  An empty path switches back to memory-only caching.
+pub fn set_session_cache_file(path: &str) {
+    let path = if path.is_empty() { None } else { Some(String::from(path)) };
+    if let Some(ref p) = path {
+        load_session_cache(p);
+    }
+    unsafe { SESSION_FILE = path; }
+}
+
+fn load_session_cache(path: &str) {
+    let fd = syscall::open(path, 0);
+    if fd == u32::MAX {
+        return;
+    }
+    let mut buf = vec![0u8; SESSION_BLOB_MAX];
+    let n = syscall::read(fd, &mut buf);
+    syscall::close(fd);
+    if n != u32::MAX && n > 0 {
+        unsafe { tls_session_cache_import(buf.as_ptr(), n as i32); }
+    }
+}
+
+/// Write the session cache back to its file if a session was added.
+fn save_session_cache() {
+    let path = match unsafe { (*core::ptr::addr_of!(SESSION_FILE)).as_ref() } {
+        Some(p) => p,
+        None => return,
+    };
+    if unsafe { tls_session_cache_dirty() } == 0 {
+        return;
+    }
+    let mut buf = vec![0u8; SESSION_BLOB_MAX];
+    let n = unsafe { tls_session_cache_export(buf.as_mut_ptr(), buf.len() as i32) };
+    if n <= 0 {
+        return;
+    }
+    let fd = syscall::open(path, syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC);
+    if fd == u32::MAX {
+        return;
+    }
+    syscall::write(fd, &buf[..n as usize]);
+    syscall::close(fd);
+}
@@ -24,6 +24,14 @@ use dynlink::{dl_open, dl_sym, DlHandle};
 /// `total_bytes` is 0 if the server did not provide Content-Length.
 pub type ProgressCallback = extern "C" fn(u32, u32, u64);
 
+/// Body sink of `libhttp_download_range`:
+/// `(data_ptr, data_len, file_offset, userdata) -> continue`.
+type SinkCallback = extern "C" fn(*const u8, u32, u32, u64) -> u32;
+
+/// Per-URL result callback of `libhttp_get_many`:
+/// `(index, status, error, body_ptr, body_len, userdata)`.
+type GetManyCallback = extern "C" fn(u32, u32, u32, *const u8, u32, u64);
+
 struct LibHttp {
     _handle: DlHandle,
     init_fn: extern "C" fn() -> u32,
@@ -31,7 +39,14 @@ struct LibHttp {
     download: extern "C" fn(*const u8, u32, *const u8, u32) -> u32,
     download_progress: extern "C" fn(*const u8, u32, *const u8, u32,
         Option<ProgressCallback>, u64) -> u32,
+    download_range: extern "C" fn(*const u8, u32, u32, SinkCallback,
+        Option<ProgressCallback>, u64) -> u32,
     post: extern "C" fn(*const u8, u32, *const u8, u32, *const u8, u32, *mut u8, u32) -> u32,
+    get_many: extern "C" fn(*const u8, u32, GetManyCallback, u64) -> u32,
+    close_idle: extern "C" fn(),
+    set_session_cache: extern "C" fn(*const u8, u32),
+    set_http2: extern "C" fn(u32),
+    set_cache: extern "C" fn(u32),
     last_status: extern "C" fn() -> u32,
     last_error: extern "C" fn() -> u32,
 }
@@ -63,7 +78,13 @@ pub fn init() -> bool {
             get: resolve(&handle, "libhttp_get"),
             download: resolve(&handle, "libhttp_download"),
             download_progress: resolve(&handle, "libhttp_download_progress"),
+            download_range: resolve(&handle, "libhttp_download_range"),
             post: resolve(&handle, "libhttp_post"),
+            get_many: resolve(&handle, "libhttp_get_many"),
+            close_idle: resolve(&handle, "libhttp_close_idle"),
+            set_session_cache: resolve(&handle, "libhttp_set_session_cache"),
+            set_http2: resolve(&handle, "libhttp_set_http2"),
+            set_cache: resolve(&handle, "libhttp_set_cache"),
             last_status: resolve(&handle, "libhttp_last_status"),
             last_error: resolve(&handle, "libhttp_last_error"),
             _handle: handle,
@@ -144,6 +165,47 @@ pub fn download_progress(
     result == 0
 }
 
+/// Download a URL from byte `offset` on, handing the body to `on_data`
+/// as it arrives instead of writing a file.
+///
+/// `on_data(file_offset, data)` gets each piece with the offset it belongs
+/// at; a server that ignores the `Range` request restarts at 0. Returning
+/// false aborts the transfer. `progress`, if given, reports
+/// `(received, total, userdata)` for this response only.
+/// Returns true on success; `last_status()` tells 200 from 206.
+pub fn download_range<F: FnMut(u32, &[u8]) -> bool>(
+    url: &str,
+    offset: u32,
+    progress: Option<(ProgressCallback, u64)>,
+    mut on_data: F,
+) -> bool {
+    struct Ctx<'a> {
+        on_data: &'a mut dyn FnMut(u32, &[u8]) -> bool,
+        progress: Option<(ProgressCallback, u64)>,
+    }
+
+    extern "C" fn sink(data: *const u8, len: u32, offset: u32, ud: u64) -> u32 {
+        let ctx = unsafe { &mut *(ud as *mut Ctx) };
+        let data = unsafe { core::slice::from_raw_parts(data, len as usize) };
+        (ctx.on_data)(offset, data) as u32
+    }
+
+    extern "C" fn report(received: u32, total: u32, ud: u64) {
+        let ctx = unsafe { &*(ud as *const Ctx) };
+        if let Some((cb, user)) = ctx.progress {
+            cb(received, total, user);
+        }
+    }
+
+    let mut ctx = Ctx { on_data: &mut on_data, progress };
+    let callback = if progress.is_some() { Some(report as ProgressCallback) } else { None };
+    let result = (lib().download_range)(
+        url.as_ptr(), url.len() as u32, offset,
+        sink, callback, &mut ctx as *mut Ctx as u64,
+    );
+    result == 0
+}
+
 /// Perform an HTTP(S) POST request.
 ///
 /// Returns `Some(response_body)` on success, `None` on error.
@@ -160,6 +222,82 @@ pub fn post(url: &str, body: &[u8], content_type: &str) -> Option<Vec<u8>> {
     Some(buf)
 }
 
+/// Fetch several URLs over reused (and, where safe, pipelined) connections.
+///
+/// `on_done(index, result)` is called once per URL, in completion order,
+/// with `Ok((status, body))` or `Err(error_code)`. Empty URLs are skipped
+/// and get no callback. Returns the number of successful fetches.
+pub fn get_many<F: FnMut(usize, Result<(u16, &[u8]), u32>)>(urls: &[&str], mut on_done: F) -> usize {
+    let mut list: Vec<u8> = Vec::new();
+    let mut index_map: Vec<usize> = Vec::new();
+    for (i, url) in urls.iter().enumerate() {
+        if url.trim().is_empty() { continue; }
+        list.extend_from_slice(url.as_bytes());
+        list.push(b'\n');
+        index_map.push(i);
+    }
+
+    struct Ctx<'a> {
+        index_map: &'a [usize],
+        on_done: &'a mut dyn FnMut(usize, Result<(u16, &[u8]), u32>),
+    }
+
+    extern "C" fn trampoline(index: u32, status: u32, error: u32, body: *const u8, len: u32, ud: u64) {
+        let ctx = unsafe { &mut *(ud as *mut Ctx) };
+        let index = ctx.index_map[index as usize];
+        if status == 0 {
+            (ctx.on_done)(index, Err(error));
+        } else {
+            let body = if body.is_null() || len == 0 {
+                &[][..]
+            } else {
+                unsafe { core::slice::from_raw_parts(body, len as usize) }
+            };
+            (ctx.on_done)(index, Ok((status as u16, body)));
+        }
+    }
+
+    let mut ctx = Ctx { index_map: &index_map, on_done: &mut on_done };
+    (lib().get_many)(
+        list.as_ptr(), list.len() as u32,
+        trampoline, &mut ctx as *mut Ctx as u64,
+    ) as usize
+}
+
+/// Close idle keep-alive connections held by libhttp.
+///
+/// Connections time out on their own; call this when a long pause in
+/// network activity is expected.
+pub fn close_idle() {
+    (lib().close_idle)()
+}
+
+/// Persist libhttp's TLS session cache in the file at `path`.
+///
+/// Sessions are always cached in memory and resumed on reconnect; with a
+/// file, later runs of a CLI tool resume them too. An empty path keeps the
+/// cache in memory only.
+pub fn set_session_cache(path: &str) {
+    (lib().set_session_cache)(path.as_ptr(), path.len() as u32)
+}
+
+/// Enable (the default) or disable HTTP/2 for new HTTPS connections.
+///
+/// With HTTP/2, `get_many` runs all requests to an origin concurrently
+/// over one TLS connection; the other calls are unaffected.
+pub fn set_http2(enabled: bool) {
+    (lib().set_http2)(enabled as u32)
+}
+
+/// Enable (the default) or disable the shared HTTP cache for GETs.
+///
+/// Cached responses are served without a request while fresh and
+/// revalidated with `If-None-Match` / `If-Modified-Since` once stale;
+/// `download` always revalidates.
+pub fn set_cache(enabled: bool) {
+    (lib().set_cache)(enabled as u32)
+}
+
 /// Returns the HTTP status code of the last request (e.g. 200, 404, 0 if no request).
 pub fn last_status() -> u32 {
     (lib().last_status)()
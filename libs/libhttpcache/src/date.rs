@@ -0,0 +1,96 @@
+//! HTTP-date parsing and the wall clock, in seconds since the Unix epoch.
+
+/// Current time from the RTC, or 0 when the clock is not set.
+///
+/// The RTC is read as UTC.  Callers treat 0 as "unknown" and never consider
+/// an entry fresh, so a machine without a usable clock still revalidates.
+pub(crate) fn now() -> u64 {
+    let mut buf = [0u8; 8];
+    libsyscall::time(&mut buf);
+    let year = u16::from_le_bytes([buf[0], buf[1]]) as i64;
+    if year < 2000 {
+        return 0;
+    }
+    to_unix(year, buf[2] as i64, buf[3] as i64, buf[4] as u64, buf[5] as u64, buf[6] as u64)
+}
+
+/// Parse an HTTP-date in any of the three formats of RFC 9110 §5.6.7:
+///
+/// - `Sun, 06 Nov 1994 08:49:37 GMT` (IMF-fixdate)
+/// - `Sunday, 06-Nov-94 08:49:37 GMT` (RFC 850)
+/// - `Sun Nov  6 08:49:37 1994` (asctime)
+pub(crate) fn parse_http_date(s: &str) -> Option<u64> {
+    let mut month = 0i64;
+    let mut month_before_day = false;
+    let mut nums = [0u64; 5];
+    let mut n = 0;
+    for tok in s.split(|c: char| !c.is_ascii_alphanumeric()) {
+        if tok.is_empty() {
+            continue;
+        }
+        if tok.as_bytes()[0].is_ascii_digit() {
+            if n == nums.len() {
+                return None;
+            }
+            nums[n] = tok.parse().ok()?;
+            n += 1;
+        } else if month == 0 {
+            if let Some(m) = month_number(tok) {
+                month = m;
+                month_before_day = n == 0;
+            }
+        }
+    }
+    if n != 5 || month == 0 {
+        return None;
+    }
+    // Day first: day, year, h, m, s.  asctime: day, h, m, s, year.
+    let (day, year, h, m, sec) = if month_before_day {
+        (nums[0], nums[4], nums[1], nums[2], nums[3])
+    } else {
+        (nums[0], nums[1], nums[2], nums[3], nums[4])
+    };
+    // RFC 850 two-digit years: interpret as the nearest century (RFC 9110).
+    let year = match year {
+        0..=69 => year + 2000,
+        70..=99 => year + 1900,
+        _ => year,
+    };
+    if !(1..=31).contains(&day) || h > 23 || m > 59 || sec > 60 || year < 1970 {
+        return None;
+    }
+    Some(to_unix(year as i64, month, day as i64, h, m, sec))
+}
+
+fn month_number(tok: &str) -> Option<i64> {
+    const MONTHS: [&str; 12] = [
+        "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec",
+    ];
+    if tok.len() < 3 {
+        return None;
+    }
+    let b = tok.as_bytes();
+    MONTHS.iter().position(|m| {
+        let m = m.as_bytes();
+        (0..3).all(|i| b[i].to_ascii_lowercase() == m[i])
+    }).map(|i| i as i64 + 1)
+}
+
+fn to_unix(year: i64, month: i64, day: i64, h: u64, m: u64, s: u64) -> u64 {
+    let days = days_from_civil(year, month, day);
+    if days < 0 {
+        return 0;
+    }
+    days as u64 * 86_400 + h * 3600 + m * 60 + s
+}
+
+/// Days since 1970-01-01 of a proleptic Gregorian date.
+fn days_from_civil(year: i64, month: i64, day: i64) -> i64 {
+    let y = if month <= 2 { year - 1 } else { year };
+    let era = if y >= 0 { y } else { y - 399 } / 400;
+    let yoe = y - era * 400;
+    let mp = (month + 9) % 12;
+    let doy = (153 * mp + 2) / 5 + day - 1;
+    let doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    era * 146_097 + doe - 719_468
+}
@@ -0,0 +1,579 @@
+//! libhttpcache — persistent HTTP response cache for anyOS.
+//!
+//! A private (per-user) cache shared by every process that links it: libhttp
+//! (and through it apkg and other `libhttp_client` users) and Surf.  Each
+//! response lives in `/System/cache/http/<hash>`, next to an `index` file
+//! listing every entry with its size and last use.  The index is kept in
+//! memory and re-read when it is older than `INDEX_RELOAD_MS`, so a miss
+//! costs no file system access and entries stored by another process show
+//! up within a few seconds.
+//!
+//! Freshness follows RFC 9111: `Cache-Control: max-age`, else `Expires`
+//! relative to `Date`, else 10% of the time since `Last-Modified` (capped at
+//! a day).  `no-store` responses are never written and `no-cache` ones are
+//! always revalidated.  A stale entry that carries an `ETag` or
+//! `Last-Modified` is returned as [`Lookup::Stale`] so the caller can send
+//! `If-None-Match` / `If-Modified-Since`; on `304 Not Modified` it calls
+//! [`refresh`] and uses the cached body.
+//!
+//! Bodies are stored as the caller hands them over (libhttp stores decoded
+//! bodies), so `Content-Encoding`, framing and cookie headers are dropped.
+//! The cache is bounded by `MAX_BYTES`; the least recently used entries are
+//! removed first.
+//!
+//! Not thread-safe: use it from one thread per process.
+
+#![no_std]
+
+extern crate alloc;
+
+mod date;
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use libsyscall as syscall;
+
+// ── Constants ───────────────────────────────────────────────────────────────
+
+const CACHE_DIR: &str = "/System/cache/http";
+const INDEX_PATH: &str = "/System/cache/http/index";
+
+const ENTRY_MAGIC: &[u8; 4] = b"AHC1";
+const ENTRY_HEADER_LEN: usize = 28;
+const INDEX_MAGIC: &[u8; 4] = b"AHCI";
+const INDEX_HEADER_LEN: usize = 16;
+const SLOT_LEN: usize = 16;
+
+/// Total size of all entry files.
+const MAX_BYTES: u64 = 32 << 20;
+/// Number of entries.
+const MAX_ENTRIES: usize = 2048;
+/// Largest single response kept.
+const MAX_ENTRY: usize = 4 << 20;
+
+/// Upper bound for the `Last-Modified` heuristic.
+const HEURISTIC_MAX_SECS: u64 = 86_400;
+
+/// Re-read the index when the in-memory copy is older than this.
+const INDEX_RELOAD_MS: u32 = 5_000;
+/// Write the index after this many hits, to keep the LRU order on disk.
+const TOUCH_FLUSH: usize = 16;
+
+/// Response headers not stored with an entry.
+const DROPPED_HEADERS: [&str; 9] = [
+    "connection", "keep-alive", "transfer-encoding", "content-encoding",
+    "content-length", "set-cookie", "trailer", "upgrade", "age",
+];
+
+// ── Public API ──────────────────────────────────────────────────────────────
+
+/// A cached response.
+pub struct Entry {
+    pub status: u16,
+    /// Status line and stored header lines, CRLF-separated, ending in an
+    /// empty line.
+    pub headers: String,
+    pub body: Vec<u8>,
+    fresh_until: u64,
+}
+
+impl Entry {
+    /// Value for `If-None-Match`.
+    pub fn etag(&self) -> Option<&str> {
+        find_header(&self.headers, "etag")
+    }
+
+    /// Value for `If-Modified-Since`.
+    pub fn last_modified(&self) -> Option<&str> {
+        find_header(&self.headers, "last-modified")
+    }
+}
+
+/// Result of [`lookup`].
+pub enum Lookup {
+    /// Usable without contacting the server.
+    Fresh(Entry),
+    /// Expired, but can be revalidated with its `ETag` / `Last-Modified`.
+    Stale(Entry),
+    Miss,
+}
+
+impl Lookup {
+    /// The entry to revalidate, if any.
+    pub fn stale(&self) -> Option<&Entry> {
+        match self {
+            Lookup::Stale(e) => Some(e),
+            _ => None,
+        }
+    }
+}
+
+/// Canonical key of a URL, shared by all clients of the cache.
+pub fn url_key(scheme: &str, host: &str, port: u16, path: &str) -> String {
+    let mut key = String::with_capacity(scheme.len() + host.len() + path.len() + 10);
+    key.push_str(scheme);
+    key.push_str("://");
+    for c in host.chars() {
+        key.push(c.to_ascii_lowercase());
+    }
+    key.push(':');
+    push_u32(&mut key, port as u32);
+    key.push_str(path);
+    key
+}
+
+/// Look up the response stored under `key`.
+pub fn lookup(key: &str) -> Lookup {
+    let hash = hash_key(key);
+    let ix = index();
+    if !ix.slots.iter().any(|s| s.hash == hash) {
+        return Lookup::Miss;
+    }
+    let entry = match read_entry(hash, key) {
+        Some(e) => e,
+        None => return Lookup::Miss,
+    };
+    ix.touched.push(hash);
+    let flush = ix.touched.len() >= TOUCH_FLUSH;
+    if flush {
+        update(|_| {});
+    }
+
+    let now = date::now();
+    if now != 0 && now < entry.fresh_until {
+        Lookup::Fresh(entry)
+    } else if entry.etag().is_some() || entry.last_modified().is_some() {
+        Lookup::Stale(entry)
+    } else {
+        Lookup::Miss
+    }
+}
+
+/// Store a response under `key` if it is cacheable.  `headers` is the full
+/// response head (status line first); `body` is stored as given.
+///
+/// Returns whether the response was stored.  A `no-store` response also
+/// removes any earlier entry for `key`.
+pub fn store(key: &str, status: u16, headers: &str, body: &[u8]) -> bool {
+    let cc = find_header(headers, "cache-control").unwrap_or("");
+    if has_directive(cc, "no-store") {
+        remove(key);
+        return false;
+    }
+    if !matches!(status, 200 | 203) || body.len() > MAX_ENTRY {
+        return false;
+    }
+    if find_header(headers, "vary").map(|v| v.trim() == "*").unwrap_or(false) {
+        return false;
+    }
+    let head = filter_headers(headers);
+    let fresh_until = fresh_until(&head, headers, date::now());
+    let entry = Entry { status, headers: head, body: Vec::new(), fresh_until };
+    if fresh_until == 0 && entry.etag().is_none() && entry.last_modified().is_none() {
+        // Neither fresh nor revalidatable: an entry would never be used.
+        return false;
+    }
+    write_entry(key, &entry, body)
+}
+
+/// Apply the headers of a `304 Not Modified` to the entry under `key`,
+/// and return the updated entry.
+pub fn refresh(key: &str, headers: &str) -> Option<Entry> {
+    let hash = hash_key(key);
+    let old = read_entry(hash, key)?;
+
+    // Headers in the 304 replace the stored ones of the same name.
+    let update_head = filter_headers(headers);
+    let mut head = String::with_capacity(old.headers.len() + update_head.len());
+    let mut lines = old.headers.split("\r\n");
+    head.push_str(lines.next().unwrap_or(""));
+    head.push_str("\r\n");
+    for line in lines.filter(|l| !l.is_empty()) {
+        let name = line.split(':').next().unwrap_or("");
+        if find_header(&update_head, name.trim()).is_none() {
+            head.push_str(line);
+            head.push_str("\r\n");
+        }
+    }
+    for line in update_head.split("\r\n").skip(1).filter(|l| !l.is_empty()) {
+        head.push_str(line);
+        head.push_str("\r\n");
+    }
+    head.push_str("\r\n");
+
+    let fresh_until = fresh_until(&head, headers, date::now());
+    let body = old.body;
+    let mut entry = Entry { status: old.status, headers: head, body: Vec::new(), fresh_until };
+    write_entry(key, &entry, &body);
+    entry.body = body;
+    Some(entry)
+}
+
+/// Remove the entry under `key`, if any.
+pub fn remove(key: &str) {
+    let hash = hash_key(key);
+    if !index().slots.iter().any(|s| s.hash == hash) {
+        return;
+    }
+    update(|ix| {
+        if let Some(pos) = ix.slots.iter().position(|s| s.hash == hash) {
+            ix.slots.remove(pos);
+            syscall::unlink(&entry_path(hash));
+        }
+    });
+}
+
+/// Write pending LRU updates to disk.
+pub fn flush() {
+    if !index().touched.is_empty() {
+        update(|_| {});
+    }
+}
+
+// ── Index ───────────────────────────────────────────────────────────────────
+
+struct Slot {
+    hash: u64,
+    size: u32,
+    /// Value of `Index::clock` at the last store or hit.
+    used: u32,
+}
+
+struct Index {
+    /// Uptime in ms when the index was read (`None` before the first read).
+    loaded_ms: Option<u32>,
+    /// LRU clock, incremented on every use.
+    clock: u32,
+    slots: Vec<Slot>,
+    /// Hits not yet written to disk.
+    touched: Vec<u64>,
+}
+
+static mut INDEX: Index = Index { loaded_ms: None, clock: 0, slots: Vec::new(), touched: Vec::new() };
+
+/// The in-memory index, re-read from disk when it is out of date.
+fn index() -> &'static mut Index {
+    let ix = unsafe { &mut *core::ptr::addr_of_mut!(INDEX) };
+    let now = syscall::uptime_ms();
+    let stale = match ix.loaded_ms {
+        Some(t) => now.wrapping_sub(t) > INDEX_RELOAD_MS,
+        None => true,
+    };
+    if stale {
+        reload(ix);
+    }
+    ix
+}
+
+fn reload(ix: &mut Index) {
+    ix.loaded_ms = Some(syscall::uptime_ms());
+    ix.clock = 0;
+    ix.slots.clear();
+    let data = match read_file(INDEX_PATH, 2 * INDEX_HEADER_LEN + MAX_ENTRIES * SLOT_LEN) {
+        Some(d) if d.len() >= INDEX_HEADER_LEN => d,
+        _ => return,
+    };
+    let count = u32_at(&data, 12) as usize;
+    if &data[..4] != INDEX_MAGIC
+        || data.len() != INDEX_HEADER_LEN + count * SLOT_LEN
+        || fnv(&data[8..]) as u32 != u32_at(&data, 4)
+    {
+        return;
+    }
+    ix.clock = u32_at(&data, 8);
+    for s in data[INDEX_HEADER_LEN..].chunks_exact(SLOT_LEN) {
+        ix.slots.push(Slot {
+            hash: u64::from_le_bytes(s[0..8].try_into().unwrap()),
+            size: u32_at(s, 8),
+            used: u32_at(s, 12),
+        });
+    }
+}
+
+/// Re-read the index, apply pending hits and `f`, evict down to the size
+/// limits and write it back.  Reading first keeps entries other processes
+/// added since our copy was loaded.
+fn update(f: impl FnOnce(&mut Index)) {
+    let ix = unsafe { &mut *core::ptr::addr_of_mut!(INDEX) };
+    reload(ix);
+    for hash in core::mem::take(&mut ix.touched) {
+        ix.clock = ix.clock.wrapping_add(1);
+        let clock = ix.clock;
+        if let Some(s) = ix.slots.iter_mut().find(|s| s.hash == hash) {
+            s.used = clock;
+        }
+    }
+    f(ix);
+
+    let mut total: u64 = ix.slots.iter().map(|s| s.size as u64).sum();
+    while total > MAX_BYTES || ix.slots.len() > MAX_ENTRIES {
+        let lru = ix.slots.iter().enumerate()
+            .min_by_key(|(_, s)| s.used)
+            .map(|(i, _)| i)
+            .unwrap();
+        let slot = ix.slots.remove(lru);
+        total -= slot.size as u64;
+        syscall::unlink(&entry_path(slot.hash));
+    }
+
+    let mut buf = Vec::with_capacity(INDEX_HEADER_LEN + ix.slots.len() * SLOT_LEN);
+    buf.extend_from_slice(INDEX_MAGIC);
+    buf.extend_from_slice(&[0; 4]);
+    buf.extend_from_slice(&ix.clock.to_le_bytes());
+    buf.extend_from_slice(&(ix.slots.len() as u32).to_le_bytes());
+    for s in &ix.slots {
+        buf.extend_from_slice(&s.hash.to_le_bytes());
+        buf.extend_from_slice(&s.size.to_le_bytes());
+        buf.extend_from_slice(&s.used.to_le_bytes());
+    }
+    let sum = fnv(&buf[8..]) as u32;
+    buf[4..8].copy_from_slice(&sum.to_le_bytes());
+    write_file(INDEX_PATH, &buf);
+}
+
+// ── Entry files ─────────────────────────────────────────────────────────────
+//
+// magic "AHC1" | checksum u32 | fresh_until u64 | status u16 | key_len u16
+// | headers_len u32 | body_len u32 | key | headers | body
+
+fn entry_path(hash: u64) -> String {
+    let mut p = String::from(CACHE_DIR);
+    p.push('/');
+    for i in (0..16).rev() {
+        let nibble = ((hash >> (i * 4)) & 0xF) as u8;
+        p.push(if nibble < 10 { (b'0' + nibble) as char } else { (b'a' + nibble - 10) as char });
+    }
+    p
+}
+
+fn read_entry(hash: u64, key: &str) -> Option<Entry> {
+    let data = read_file(&entry_path(hash), ENTRY_HEADER_LEN + MAX_ENTRY + 65_536)?;
+    if data.len() < ENTRY_HEADER_LEN || &data[..4] != ENTRY_MAGIC {
+        return None;
+    }
+    if fnv(&data[8..]) as u32 != u32_at(&data, 4) {
+        return None;
+    }
+    let fresh_until = u64::from_le_bytes(data[8..16].try_into().unwrap());
+    let status = u16::from_le_bytes([data[16], data[17]]);
+    let key_len = u16::from_le_bytes([data[18], data[19]]) as usize;
+    let head_len = u32_at(&data, 20) as usize;
+    let body_len = u32_at(&data, 24) as usize;
+    if data.len() != ENTRY_HEADER_LEN + key_len + head_len + body_len {
+        return None;
+    }
+    let head_start = ENTRY_HEADER_LEN + key_len;
+    let body_start = head_start + head_len;
+    // Another key with the same hash.
+    if &data[ENTRY_HEADER_LEN..head_start] != key.as_bytes() {
+        return None;
+    }
+    let headers = String::from(core::str::from_utf8(&data[head_start..body_start]).ok()?);
+    Some(Entry { status, headers, body: Vec::from(&data[body_start..]), fresh_until })
+}
+
+fn write_entry(key: &str, entry: &Entry, body: &[u8]) -> bool {
+    if key.len() > u16::MAX as usize {
+        return false;
+    }
+    let hash = hash_key(key);
+    let mut buf = Vec::with_capacity(ENTRY_HEADER_LEN + key.len() + entry.headers.len() + body.len());
+    buf.extend_from_slice(ENTRY_MAGIC);
+    buf.extend_from_slice(&[0; 4]);
+    buf.extend_from_slice(&entry.fresh_until.to_le_bytes());
+    buf.extend_from_slice(&entry.status.to_le_bytes());
+    buf.extend_from_slice(&(key.len() as u16).to_le_bytes());
+    buf.extend_from_slice(&(entry.headers.len() as u32).to_le_bytes());
+    buf.extend_from_slice(&(body.len() as u32).to_le_bytes());
+    buf.extend_from_slice(key.as_bytes());
+    buf.extend_from_slice(entry.headers.as_bytes());
+    buf.extend_from_slice(body);
+    let sum = fnv(&buf[8..]) as u32;
+    buf[4..8].copy_from_slice(&sum.to_le_bytes());
+
+    if !write_file(&entry_path(hash), &buf) {
+        return false;
+    }
+    let size = buf.len() as u32;
+    update(|ix| {
+        ix.clock = ix.clock.wrapping_add(1);
+        let used = ix.clock;
+        match ix.slots.iter_mut().find(|s| s.hash == hash) {
+            Some(s) => {
+                s.size = size;
+                s.used = used;
+            }
+            None => ix.slots.push(Slot { hash, size, used }),
+        }
+    });
+    true
+}
+
+fn read_file(path: &str, max: usize) -> Option<Vec<u8>> {
+    let fd = syscall::open(path, 0);
+    if fd == u32::MAX {
+        return None;
+    }
+    let size = syscall::file_size(fd) as usize;
+    if size > max {
+        syscall::close(fd);
+        return None;
+    }
+    let mut buf = alloc::vec![0u8; size];
+    let mut got = 0;
+    while got < size {
+        let n = syscall::read(fd, &mut buf[got..]);
+        if n == 0 || n == u32::MAX {
+            break;
+        }
+        got += n as usize;
+    }
+    syscall::close(fd);
+    if got != size {
+        return None;
+    }
+    Some(buf)
+}
+
+fn write_file(path: &str, data: &[u8]) -> bool {
+    // Parents first; failures (already exists, read-only volume) surface below.
+    syscall::mkdir("/System/cache");
+    syscall::mkdir(CACHE_DIR);
+    let fd = syscall::open(path, syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC);
+    if fd == u32::MAX {
+        return false;
+    }
+    let mut off = 0;
+    while off < data.len() {
+        let n = syscall::write(fd, &data[off..]);
+        if n == 0 || n == u32::MAX {
+            break;
+        }
+        off += n as usize;
+    }
+    syscall::close(fd);
+    off == data.len()
+}
+
+// ── Freshness ───────────────────────────────────────────────────────────────
+
+/// Absolute expiry time of a response received at `now` (0 = stale).
+/// `head` is the stored header block; `received` the headers as sent,
+/// which still carry `Age`.
+fn fresh_until(head: &str, received: &str, now: u64) -> u64 {
+    if now == 0 {
+        return 0;
+    }
+    let cc = find_header(head, "cache-control").unwrap_or("");
+    if has_directive(cc, "no-cache") {
+        return 0;
+    }
+    if cc.is_empty() && find_header(head, "pragma").map(|p| has_directive(p, "no-cache")).unwrap_or(false) {
+        return 0;
+    }
+    let age = find_header(received, "age").and_then(|v| v.trim().parse::<u64>().ok()).unwrap_or(0);
+
+    let lifetime = if let Some(max_age) = directive_value(cc, "max-age").and_then(|v| v.parse::<u64>().ok()) {
+        max_age
+    } else {
+        let date = find_header(head, "date").and_then(date::parse_http_date).unwrap_or(now);
+        if let Some(expires) = find_header(head, "expires") {
+            // Invalid dates (e.g. "0") mean already expired.
+            date::parse_http_date(expires).map(|e| e.saturating_sub(date)).unwrap_or(0)
+        } else if let Some(modified) = find_header(head, "last-modified").and_then(date::parse_http_date) {
+            (date.saturating_sub(modified) / 10).min(HEURISTIC_MAX_SECS)
+        } else {
+            0
+        }
+    };
+    let remaining = lifetime.saturating_sub(age);
+    if remaining == 0 { 0 } else { now + remaining }
+}
+
+// ── Header helpers ──────────────────────────────────────────────────────────
+
+/// Value of header `name` (case-insensitive) in a CRLF-separated head.
+fn find_header<'a>(headers: &'a str, name: &str) -> Option<&'a str> {
+    for line in headers.split('\n').skip(1) {
+        let line = line.trim_end_matches('\r');
+        if line.len() > name.len() && line.as_bytes()[name.len()] == b':'
+            && line[..name.len()].eq_ignore_ascii_case(name)
+        {
+            return Some(line[name.len() + 1..].trim());
+        }
+    }
+    None
+}
+
+/// Status line plus the storable header lines of `headers`.
+fn filter_headers(headers: &str) -> String {
+    let mut out = String::with_capacity(headers.len());
+    let mut lines = headers.split('\n').map(|l| l.trim_end_matches('\r'));
+    out.push_str(lines.next().unwrap_or(""));
+    out.push_str("\r\n");
+    for line in lines.filter(|l| !l.is_empty()) {
+        let name = line.split(':').next().unwrap_or("").trim();
+        if !DROPPED_HEADERS.iter().any(|d| name.eq_ignore_ascii_case(d)) {
+            out.push_str(line);
+            out.push_str("\r\n");
+        }
+    }
+    out.push_str("\r\n");
+    out
+}
+
+/// Whether a comma-separated directive list contains `name`.
+fn has_directive(list: &str, name: &str) -> bool {
+    list.split(',').any(|d| {
+        let d = d.trim();
+        let d = d.split('=').next().unwrap_or("").trim();
+        d.eq_ignore_ascii_case(name)
+    })
+}
+
+/// Value of `name=value` in a comma-separated directive list.
+fn directive_value<'a>(list: &'a str, name: &str) -> Option<&'a str> {
+    list.split(',').find_map(|d| {
+        let (k, v) = d.split_once('=')?;
+        if k.trim().eq_ignore_ascii_case(name) { Some(v.trim().trim_matches('"')) } else { None }
+    })
+}
+
+// ── Misc ────────────────────────────────────────────────────────────────────
+
+const FNV_OFFSET: u64 = 0xCBF2_9CE4_8422_2325;
+const FNV_PRIME: u64 = 0x0000_0100_0000_01B3;
+
+fn fnv(bytes: &[u8]) -> u64 {
+    let mut h = FNV_OFFSET;
+    for &b in bytes {
+        h = (h ^ b as u64).wrapping_mul(FNV_PRIME);
+    }
+    h
+}
+
+fn hash_key(key: &str) -> u64 {
+    fnv(key.as_bytes())
+}
+
+fn u32_at(data: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes(data[off..off + 4].try_into().unwrap())
+}
+
+fn push_u32(s: &mut String, mut val: u32) {
+    let mut digits = [0u8; 10];
+    let mut n = 0;
+    loop {
+        digits[n] = b'0' + (val % 10) as u8;
+        n += 1;
+        val /= 10;
+        if val == 0 {
+            break;
+        }
+    }
+    while n > 0 {
+        n -= 1;
+        s.push(digits[n] as char);
+    }
+}
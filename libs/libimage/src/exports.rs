@@ -5,7 +5,7 @@
 
 use crate::types::{ImageInfo, VideoInfo};
 
-const NUM_EXPORTS: u32 = 11;
+const NUM_EXPORTS: u32 = 18;
 
 /// Export function table — must be first in the binary (`.exports` section).
 #[repr(C)]
@@ -33,6 +33,17 @@ pub struct LibimageExports {
     pub iconpack_render_cached: extern "C" fn(*const u8, u32, u32, u32, u32, *mut u32) -> i32,
     // Trim transparent borders and scale
     pub trim_and_scale: extern "C" fn(*const u32, u32, u32, *mut u32, u32, u32) -> i32,
+    // Decode-time downscaling by 2^shift
+    pub image_probe_scaled: extern "C" fn(*const u8, u32, u32, *mut ImageInfo) -> i32,
+    pub image_decode_scaled: extern "C" fn(*const u8, u32, u32, *mut u32, u32, *mut u8, u32) -> i32,
+    // Scale with an explicit resampling filter
+    pub scale_image_filtered: extern "C" fn(*const u32, u32, u32, *mut u32, u32, u32, u32, u32) -> i32,
+    // Persistent thumbnail cache
+    pub thumbnail_lookup: extern "C" fn(*const u8, u32, u32, u32, *mut u32, u32, *mut ImageInfo) -> i32,
+    pub thumbnail_store: extern "C" fn(*const u8, u32, *const u32, u32, u32) -> i32,
+    pub thumbnail_generation: extern "C" fn() -> u32,
+    // Baseline JPEG encoder
+    pub jpeg_encode: extern "C" fn(*const u32, u32, u32, u32, u32, *mut u8, u32) -> i32,
 }
 
 #[link_section = ".exports"]
@@ -54,6 +65,13 @@ pub static LIBIMAGE_EXPORTS: LibimageExports = LibimageExports {
     iconpack_render: iconpack_render_export,
     iconpack_render_cached: iconpack_render_cached_export,
     trim_and_scale: trim_and_scale_export,
+    image_probe_scaled: image_probe_scaled,
+    image_decode_scaled: image_decode_scaled,
+    scale_image_filtered: scale_image_filtered_export,
+    thumbnail_lookup: thumbnail_lookup_export,
+    thumbnail_store: thumbnail_store_export,
+    thumbnail_generation: thumbnail_generation_export,
+    jpeg_encode: jpeg_encode_export,
 };
 
 // ── Video exports ──────────────────────────────────────
@@ -156,7 +174,11 @@ extern "C" fn image_decode(
         unsafe { core::slice::from_raw_parts_mut(scratch, scratch_len as usize) }
     };
 
-    // Detect format and dispatch to decoder
+    decode_any(data, out, scratch)
+}
+
+/// Detect the format of `data` and dispatch to its decoder.
+fn decode_any(data: &[u8], out: &mut [u32], scratch: &mut [u8]) -> i32 {
     if data.len() >= 2 && data[0] == b'B' && data[1] == b'M' {
         return crate::bmp::decode(data, out);
     }
@@ -182,9 +204,107 @@ extern "C" fn image_decode(
     crate::types::ERR_UNSUPPORTED
 }
 
+/// Probe an image for a decode at 1/2^`shift` of its size (`shift` 0..=3).
+///
+/// Reports the scaled dimensions (rounded up) and the scratch size
+/// `image_decode_scaled` needs.  JPEG scales in the DCT domain, so its
+/// scratch shrinks with the output; other formats are decoded at full size
+/// into scratch and then scaled down.
+extern "C" fn image_probe_scaled(data: *const u8, len: u32, shift: u32, info: *mut ImageInfo) -> i32 {
+    if data.is_null() || info.is_null() || len < 8 || shift > crate::scale::MAX_SCALE_SHIFT {
+        return crate::types::ERR_INVALID_DATA;
+    }
+    let ret = image_probe(data, len, info);
+    if ret != crate::types::ERR_OK {
+        return ret;
+    }
+    let slice = unsafe { core::slice::from_raw_parts(data, len as usize) };
+    let out = unsafe { &mut *info };
+
+    if out.format == crate::types::FMT_JPEG {
+        if let Some(i) = crate::jpeg::probe_scaled(slice, shift) {
+            *out = i;
+            return crate::types::ERR_OK;
+        }
+        return crate::types::ERR_UNSUPPORTED;
+    }
+    if shift > 0 {
+        // Full-size pixels ahead of the decoder's own scratch
+        let full = (out.width as u64) * (out.height as u64) * 4 + 4;
+        let total = full + out.scratch_needed as u64;
+        if total > u32::MAX as u64 {
+            return crate::types::ERR_UNSUPPORTED;
+        }
+        out.scratch_needed = total as u32;
+        out.width = crate::scale::scaled_dim(out.width, shift);
+        out.height = crate::scale::scaled_dim(out.height, shift);
+    }
+    crate::types::ERR_OK
+}
+
+/// Decode an image at 1/2^`shift` of its size into ARGB8888 pixels.
+///
+/// - `out_pixels`/`out_len`: output buffer of the `image_probe_scaled` size
+/// - `scratch`/`scratch_len`: working memory (size from `image_probe_scaled`)
+///
+/// Thumbnails of large JPEG photos cost a fraction of a full decode: at
+/// 1/8 scale only the DC coefficient of each block is used.
+extern "C" fn image_decode_scaled(
+    data: *const u8, len: u32, shift: u32,
+    out_pixels: *mut u32, out_len: u32,
+    scratch: *mut u8, scratch_len: u32,
+) -> i32 {
+    if data.is_null() || out_pixels.is_null() || len < 8 || shift > crate::scale::MAX_SCALE_SHIFT {
+        return crate::types::ERR_INVALID_DATA;
+    }
+    let slice = unsafe { core::slice::from_raw_parts(data, len as usize) };
+    if shift == 0 {
+        return image_decode(data, len, out_pixels, out_len, scratch, scratch_len);
+    }
+    let out = unsafe { core::slice::from_raw_parts_mut(out_pixels, out_len as usize) };
+    let scratch = if scratch.is_null() || scratch_len == 0 {
+        &mut [][..]
+    } else {
+        unsafe { core::slice::from_raw_parts_mut(scratch, scratch_len as usize) }
+    };
+
+    if slice.len() >= 2 && slice[0] == 0xFF && slice[1] == 0xD8 {
+        return crate::jpeg::decode_scaled(slice, out, scratch, shift);
+    }
+
+    // Other formats: decode at full size into scratch, then scale down.
+    let mut info = ImageInfo::zero();
+    let ret = image_probe(data, len, &mut info);
+    if ret != crate::types::ERR_OK {
+        return ret;
+    }
+    let (w, h) = (info.width, info.height);
+    let (sw, sh) = (crate::scale::scaled_dim(w, shift), crate::scale::scaled_dim(h, shift));
+    if out.len() < (sw as usize) * (sh as usize) {
+        return crate::types::ERR_BUFFER_TOO_SMALL;
+    }
+    let count = (w as usize) * (h as usize);
+    let pad = scratch.as_ptr().align_offset(4);
+    if pad + count * 4 > scratch.len() {
+        return crate::types::ERR_SCRATCH_TOO_SMALL;
+    }
+    let (full, rest) = scratch[pad..].split_at_mut(count * 4);
+    let full = unsafe { core::slice::from_raw_parts_mut(full.as_mut_ptr() as *mut u32, count) };
+    let ret = decode_any(slice, full, rest);
+    if ret != crate::types::ERR_OK {
+        return ret;
+    }
+    crate::scale::scale_image(
+        full.as_ptr(), w, h,
+        out.as_mut_ptr(), sw, sh,
+        crate::scale::MODE_SCALE,
+    )
+}
+
 // ── Scale export ──────────────────────────────────────
 
-/// Scale an ARGB8888 image using bilinear interpolation.
+/// Scale an ARGB8888 image (area averaging when shrinking, bilinear when
+/// enlarging).
 extern "C" fn scale_image_export(
     src: *const u32, src_w: u32, src_h: u32,
     dst: *mut u32, dst_w: u32, dst_h: u32,
@@ -193,6 +313,15 @@ extern "C" fn scale_image_export(
     crate::scale::scale_image(src, src_w, src_h, dst, dst_w, dst_h, mode)
 }
 
+/// Scale an ARGB8888 image with an explicit resampling filter.
+extern "C" fn scale_image_filtered_export(
+    src: *const u32, src_w: u32, src_h: u32,
+    dst: *mut u32, dst_w: u32, dst_h: u32,
+    mode: u32, filter: u32,
+) -> i32 {
+    crate::scale::scale_image_filtered(src, src_w, src_h, dst, dst_w, dst_h, mode, filter)
+}
+
 // ── ICO size-aware exports ───────────────────────────
 
 /// Probe an ICO file selecting the best entry for a preferred size.
@@ -255,6 +384,28 @@ extern "C" fn image_encode_export(
     crate::bmp::encode(px, width, height, buf)
 }
 
+// ── JPEG encode export ──────────────────────────────
+
+/// Encode ARGB8888 pixels as a baseline 4:2:0 JPEG.
+///
+/// - `pixels`/`width`/`height`/`stride`: source image (`stride` u32s per row)
+/// - `quality`: 1-100
+/// - `out`/`out_len`: output buffer for the JPEG file bytes
+///
+/// Returns total bytes written on success, or a negative error code.
+extern "C" fn jpeg_encode_export(
+    pixels: *const u32, width: u32, height: u32, stride: u32, quality: u32,
+    out: *mut u8, out_len: u32,
+) -> i32 {
+    if pixels.is_null() || out.is_null() || width == 0 || height == 0 || stride < width {
+        return crate::types::ERR_INVALID_DATA;
+    }
+    let count = (stride as usize) * (height as usize - 1) + width as usize;
+    let px = unsafe { core::slice::from_raw_parts(pixels, count) };
+    let buf = unsafe { core::slice::from_raw_parts_mut(out, out_len as usize) };
+    crate::jpeg_enc::encode(px, width, height, stride, quality, buf)
+}
+
 // ── Iconpack render export ───────────────────────────
 
 /// Render a system icon from an ico.pak file to ARGB8888 pixels.
@@ -318,6 +469,64 @@ extern "C" fn trim_and_scale_export(
     crate::scale::trim_and_scale(src, src_w, src_h, dst, dst_w, dst_h)
 }
 
+// ── Thumbnail cache exports ─────────────────────────
+
+/// Look up the cached thumbnail of a file, fitting within `size` x `size`.
+///
+/// - `path`/`path_len`: UTF-8 path of the source image
+/// - `queue`: non-zero to have a missing thumbnail generated in the background
+/// - `out_pixels`/`out_len`: output buffer of at least `size * size` pixels
+/// - `info`: receives the thumbnail dimensions
+///
+/// Returns `ERR_NOT_CACHED` when no thumbnail matches the file's current
+/// mtime and size.
+extern "C" fn thumbnail_lookup_export(
+    path: *const u8, path_len: u32, size: u32, queue: u32,
+    out_pixels: *mut u32, out_len: u32, info: *mut ImageInfo,
+) -> i32 {
+    if path.is_null() || out_pixels.is_null() || info.is_null() {
+        return crate::types::ERR_INVALID_DATA;
+    }
+    let path = unsafe { core::slice::from_raw_parts(path, path_len as usize) };
+    let Ok(path) = core::str::from_utf8(path) else {
+        return crate::types::ERR_INVALID_DATA;
+    };
+    let out = unsafe { core::slice::from_raw_parts_mut(out_pixels, out_len as usize) };
+
+    match crate::thumbnail::lookup(path, size, queue != 0, out) {
+        Ok((w, h)) => {
+            let info = unsafe { &mut *info };
+            *info = ImageInfo::zero();
+            info.width = w;
+            info.height = h;
+            crate::types::ERR_OK
+        }
+        Err(e) => e,
+    }
+}
+
+/// Store thumbnails of a file from its already decoded ARGB8888 pixels.
+extern "C" fn thumbnail_store_export(
+    path: *const u8, path_len: u32,
+    pixels: *const u32, width: u32, height: u32,
+) -> i32 {
+    if path.is_null() || pixels.is_null() {
+        return crate::types::ERR_INVALID_DATA;
+    }
+    let path = unsafe { core::slice::from_raw_parts(path, path_len as usize) };
+    let Ok(path) = core::str::from_utf8(path) else {
+        return crate::types::ERR_INVALID_DATA;
+    };
+    let pixels = unsafe { core::slice::from_raw_parts(pixels, (width as usize) * (height as usize)) };
+
+    crate::thumbnail::store(path, pixels, width, height)
+}
+
+/// Counter bumped each time a background thumbnail is ready.
+extern "C" fn thumbnail_generation_export() -> u32 {
+    crate::thumbnail::generation()
+}
+
 /// Shared render logic for both export variants.
 fn render_from_pak(pak_data: &[u8], name_data: &[u8], filled: bool, size: u32, color: u32, out: &mut [u32]) -> i32 {
     let pixel_count = (size as usize) * (size as usize);
@@ -1,16 +1,33 @@
 // Copyright (c) 2024-2026 Christian Moeller
 // SPDX-License-Identifier: MIT
 
-//! Baseline JPEG (JFIF) decoder.
+//! JPEG (JFIF) decoder.
 //!
-//! Supports SOF0 (baseline DCT), 8-bit precision, 1-3 components,
-//! chroma subsampling 4:4:4, 4:2:2, and 4:2:0.
+//! Supports SOF0 (baseline DCT) and SOF2 (progressive DCT), 8-bit precision,
+//! 1 or 3 components, chroma subsampling 4:4:4, 4:2:2, 4:4:0 and 4:2:0.
 //!
 //! All working memory is caller-provided via a scratch buffer.
 //! Fixed-point integer math only (no FPU).
+//!
+//! The IDCT and the YCbCr->RGB conversion run 4 lanes at a time on
+//! `simd::I32x4`.  Restart intervals (DRI) are decoded in parallel on the
+//! `workers` threads, and color conversion runs in bands of rows on them.
+//!
+//! [`decode_scaled`] decodes at 1/2, 1/4 or 1/8 size in the DCT domain: each
+//! block is inverse-transformed from its 4x4 or 2x2 lowest frequencies, or
+//! reduced to its DC value, so the planes, the IDCT and color conversion
+//! shrink with the output.  Progressive scans (`jpeg_progressive`) collect
+//! coefficients in scratch and are transformed once all scans are in.
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, Ordering};
 
 use crate::types::*;
+use crate::jpeg_progressive::{self, Coefs};
 use crate::jpeg_tables::*;
+use crate::scale::{scaled_dim, MAX_SCALE_SHIFT};
+use crate::simd::I32x4;
+use crate::workers;
 
 // ---------------------------------------------------------------------------
 // JPEG markers
@@ -19,6 +36,7 @@ use crate::jpeg_tables::*;
 const M_SOI: u8 = 0xD8;
 const M_EOI: u8 = 0xD9;
 const M_SOF0: u8 = 0xC0; // Baseline DCT
+const M_SOF2: u8 = 0xC2; // Progressive DCT
 const M_DHT: u8 = 0xC4;
 const M_DQT: u8 = 0xDB;
 const M_DRI: u8 = 0xDD;
@@ -26,12 +44,11 @@ const M_SOS: u8 = 0xDA;
 
 // Fixed-point precision for IDCT
 const IDCT_BITS: i32 = 13;
-const IDCT_HALF: i32 = 1 << (IDCT_BITS - 1);
 
 // Maximum image dimensions we support
 const MAX_DIM: u32 = 16384;
 // Max components (Y, Cb, Cr)
-const MAX_COMP: usize = 3;
+pub(crate) const MAX_COMP: usize = 3;
 // Max quantization tables
 const MAX_QTABLES: usize = 4;
 
@@ -43,6 +60,25 @@ fn read_u16_be(data: &[u8], off: usize) -> u16 {
     ((data[off] as u16) << 8) | data[off + 1] as u16
 }
 
+/// Find the next marker at or after `pos`, skipping fill bytes.  Returns
+/// the marker code and the position just past it.
+fn next_marker(data: &[u8], mut pos: usize) -> Option<(u8, usize)> {
+    while pos + 1 < data.len() {
+        if data[pos] != 0xFF {
+            pos += 1;
+            continue;
+        }
+        while pos + 1 < data.len() && data[pos + 1] == 0xFF {
+            pos += 1;
+        }
+        if pos + 1 >= data.len() {
+            break;
+        }
+        return Some((data[pos + 1], pos + 2));
+    }
+    None
+}
+
 // ---------------------------------------------------------------------------
 // Huffman table (flat lookup + slow fallback)
 // ---------------------------------------------------------------------------
@@ -51,7 +87,7 @@ fn read_u16_be(data: &[u8], off: usize) -> u16 {
 ///
 /// Uses an 8-bit lookup table for fast decode of short codes, and a linear
 /// walk for codes longer than 8 bits (rare in typical JPEG files).
-struct HuffTable {
+pub(crate) struct HuffTable {
     /// Fast lookup: index by next 8 bits from the stream.
     /// Value bits [15:8] = decoded symbol, bits [7:0] = code length (0 = invalid).
     fast: [u16; 256],
@@ -75,18 +111,19 @@ impl HuffTable {
         self.fast = [0u16; 256];
         self.num_codes = 0;
 
-        let mut code: u16 = 0;
+        let mut code: u32 = 0;
         let mut sym_idx: usize = 0;
 
         for bits in 0..16u8 {
             let length = bits + 1; // 1..16
             let count = counts[bits as usize] as usize;
             for _ in 0..count {
-                if sym_idx >= symbols.len() || self.num_codes >= 256 {
+                // Too many codes for their lengths: a corrupt table.
+                if sym_idx >= symbols.len() || self.num_codes >= 256 || code >= 1 << length {
                     return;
                 }
                 let sym = symbols[sym_idx];
-                self.codes[self.num_codes] = (code, length, sym);
+                self.codes[self.num_codes] = (code as u16, length, sym);
                 self.num_codes += 1;
 
                 // Fill fast table for codes <= 8 bits
@@ -114,15 +151,15 @@ impl HuffTable {
 // Bit reader (MSB-first, handles JPEG byte-stuffing 0xFF00)
 // ---------------------------------------------------------------------------
 
-struct BitReader<'a> {
+pub(crate) struct BitReader<'a> {
     data: &'a [u8],
-    pos: usize,
+    pub(crate) pos: usize,
     bits: u32,   // bit accumulator
     count: i32,  // number of valid bits in accumulator
 }
 
 impl<'a> BitReader<'a> {
-    fn new(data: &'a [u8], start: usize) -> Self {
+    pub(crate) fn new(data: &'a [u8], start: usize) -> Self {
         BitReader { data, pos: start, bits: 0, count: 0 }
     }
 
@@ -130,25 +167,21 @@ impl<'a> BitReader<'a> {
     #[inline]
     fn fill(&mut self, need: i32) {
         while self.count < need {
-            if self.pos >= self.data.len() {
-                // Pad with zeros at end of data (common for truncated streams)
-                self.bits <<= 8;
-                self.count += 8;
-                continue;
-            }
-            let byte = self.data[self.pos] as u32;
-            self.pos += 1;
-
-            if byte == 0xFF {
-                // Byte-stuffing: skip the 0x00 that follows 0xFF in entropy data
-                if self.pos < self.data.len() && self.data[self.pos] == 0x00 {
+            let mut byte = 0;
+            if self.pos < self.data.len() {
+                let b = self.data[self.pos];
+                if b != 0xFF {
+                    byte = b as u32;
                     self.pos += 1;
+                } else if self.data.get(self.pos + 1) == Some(&0x00) {
+                    // Byte-stuffing: 0xFF 0x00 is a literal 0xFF
+                    byte = 0xFF;
+                    self.pos += 2;
                 }
-                // If it's a real marker (non-zero), we've hit the end of the scan.
-                // We still push 0xFF into the accumulator; the decoder will notice
-                // EOB or run out of MCUs and stop naturally.
+                // Otherwise a marker ends the entropy-coded segment.  It is
+                // left unread and the stream padded with zeros, as at the
+                // end of data; the decoder runs out of MCUs and stops.
             }
-
             self.bits = (self.bits << 8) | byte;
             self.count += 8;
         }
@@ -156,7 +189,7 @@ impl<'a> BitReader<'a> {
 
     /// Read `n` bits and return as unsigned value.
     #[inline]
-    fn read_bits(&mut self, n: i32) -> i32 {
+    pub(crate) fn read_bits(&mut self, n: i32) -> i32 {
         if n == 0 {
             return 0;
         }
@@ -166,7 +199,7 @@ impl<'a> BitReader<'a> {
     }
 
     /// Decode a Huffman symbol using the given table.
-    fn decode_huff(&mut self, ht: &HuffTable) -> i32 {
+    pub(crate) fn decode_huff(&mut self, ht: &HuffTable) -> i32 {
         self.fill(16); // ensure enough bits for any code
 
         // Fast path: 8-bit lookup
@@ -200,7 +233,7 @@ impl<'a> BitReader<'a> {
     }
 
     /// Receive and extend: read `n` extra bits and sign-extend.
-    fn receive_extend(&mut self, n: i32) -> i32 {
+    pub(crate) fn receive_extend(&mut self, n: i32) -> i32 {
         if n == 0 {
             return 0;
         }
@@ -212,77 +245,107 @@ impl<'a> BitReader<'a> {
             val
         }
     }
+
+    /// Start the next restart interval: drop the buffered bits and step over
+    /// the RST marker.  Returns `false` if the next marker is not RST.
+    pub(crate) fn restart(&mut self) -> bool {
+        self.bits = 0;
+        self.count = 0;
+        // The reader stops in front of markers; skip anything left of a
+        // damaged interval.
+        match next_marker(self.data, self.pos) {
+            Some((0xD0..=0xD7, next)) => {
+                self.pos = next;
+                true
+            }
+            _ => false,
+        }
+    }
 }
 
 // ---------------------------------------------------------------------------
 // Frame / Component info
 // ---------------------------------------------------------------------------
 
-struct Component {
+pub(crate) struct Component {
     id: u8,
-    h_samples: u8, // horizontal sampling factor (1, 2)
-    v_samples: u8, // vertical sampling factor (1, 2)
-    qt_id: u8,     // quantization table index
-    dc_table: u8,  // DC Huffman table index
-    ac_table: u8,  // AC Huffman table index
-    dc_pred: i32,  // previous DC coefficient for differential coding
+    pub(crate) h_samples: u8, // horizontal sampling factor (1, 2)
+    pub(crate) v_samples: u8, // vertical sampling factor (1, 2)
+    pub(crate) qt_id: u8,     // quantization table index
+    pub(crate) dc_table: u8,  // DC Huffman table index
+    pub(crate) ac_table: u8,  // AC Huffman table index
 }
 
-struct FrameInfo {
-    width: u16,
-    height: u16,
-    num_comp: u8,
-    comp: [Component; MAX_COMP],
-    max_h: u8, // maximum horizontal sampling factor
-    max_v: u8, // maximum vertical sampling factor
+pub(crate) struct FrameInfo {
+    pub(crate) width: u16,
+    pub(crate) height: u16,
+    pub(crate) num_comp: u8,
+    pub(crate) comp: [Component; MAX_COMP],
+    pub(crate) max_h: u8, // maximum horizontal sampling factor
+    pub(crate) max_v: u8, // maximum vertical sampling factor
+    progressive: bool,
 }
 
 impl FrameInfo {
     const fn new() -> Self {
         const COMP_INIT: Component = Component {
             id: 0, h_samples: 1, v_samples: 1, qt_id: 0,
-            dc_table: 0, ac_table: 0, dc_pred: 0,
+            dc_table: 0, ac_table: 0,
         };
         FrameInfo {
             width: 0, height: 0, num_comp: 0,
             comp: [COMP_INIT; MAX_COMP],
             max_h: 1, max_v: 1,
+            progressive: false,
         }
     }
 }
 
+/// Tables defined by DQT, DHT and DRI segments.  Progressive files may
+/// redefine them between scans.
+pub(crate) struct Tables {
+    pub(crate) quant: [[i32; 64]; MAX_QTABLES],
+    pub(crate) huff_dc: [HuffTable; 2],
+    pub(crate) huff_ac: [HuffTable; 2],
+    pub(crate) restart_interval: u16,
+}
+
+/// A scan header (SOS): the frame components in the scan and, for
+/// progressive scans, the coefficient band (`ss..=se`) and the bit
+/// positions of successive approximation (`ah`, `al`).
+pub(crate) struct ScanHeader {
+    pub(crate) ns: usize,
+    pub(crate) comp: [usize; MAX_COMP],
+    pub(crate) ss: u8,
+    pub(crate) se: u8,
+    pub(crate) ah: u8,
+    pub(crate) al: u8,
+}
+
 // ---------------------------------------------------------------------------
 // Public API: probe
 // ---------------------------------------------------------------------------
 
 /// Detect a JPEG file and return metadata.
 ///
-/// Looks for the SOI marker (0xFFD8), then scans for SOF0 to extract
+/// Looks for the SOI marker (0xFFD8), then scans for SOF0/SOF2 to extract
 /// width, height, and component info. Computes the scratch buffer size
 /// needed for decoding.
 pub fn probe(data: &[u8]) -> Option<ImageInfo> {
-    if data.len() < 4 || data[0] != 0xFF || data[1] != M_SOI {
+    probe_scaled(data, 0)
+}
+
+/// [`probe`] for [`decode_scaled`]: reports the dimensions and scratch size
+/// of a decode at 1/2^`shift` scale.
+pub fn probe_scaled(data: &[u8], shift: u32) -> Option<ImageInfo> {
+    if data.len() < 4 || data[0] != 0xFF || data[1] != M_SOI || shift > MAX_SCALE_SHIFT {
         return None;
     }
 
-    // Walk markers to find SOF0
+    // Walk markers to find the frame header
     let mut pos: usize = 2;
-    while pos + 4 <= data.len() {
-        if data[pos] != 0xFF {
-            pos += 1;
-            continue;
-        }
-
-        // Skip padding 0xFF bytes
-        while pos + 1 < data.len() && data[pos + 1] == 0xFF {
-            pos += 1;
-        }
-        if pos + 1 >= data.len() {
-            break;
-        }
-
-        let marker = data[pos + 1];
-        pos += 2;
+    while let Some((marker, next)) = next_marker(data, pos) {
+        pos = next;
 
         if marker == M_EOI || marker == 0x00 {
             break;
@@ -300,8 +363,7 @@ pub fn probe(data: &[u8]) -> Option<ImageInfo> {
             break;
         }
 
-        if marker == M_SOF0 {
-            // Baseline DCT
+        if marker == M_SOF0 || marker == M_SOF2 {
             if seg_len < 8 {
                 return None;
             }
@@ -320,59 +382,38 @@ pub fn probe(data: &[u8]) -> Option<ImageInfo> {
                 return None;
             }
 
-            // Parse sampling factors to compute MCU dimensions
+            // Sampling factors; a single component is always one block per MCU
+            let mut hv = [(1u32, 1u32); MAX_COMP];
             let mut max_h: u32 = 1;
             let mut max_v: u32 = 1;
-            if pos + 8 + (num_comp as usize) * 3 <= pos + seg_len {
+            if num_comp > 1 && pos + 8 + (num_comp as usize) * 3 <= pos + seg_len {
                 for i in 0..num_comp as usize {
-                    let off = pos + 8 + i * 3;
-                    let hv = data[off + 1];
-                    let h = (hv >> 4) as u32;
-                    let v = (hv & 0x0F) as u32;
-                    if h > max_h { max_h = h; }
-                    if v > max_v { max_v = v; }
+                    let b = data[pos + 8 + i * 3 + 1];
+                    hv[i] = ((b >> 4) as u32, (b & 0x0F) as u32);
+                    max_h = max_h.max(hv[i].0);
+                    max_v = max_v.max(hv[i].1);
                 }
             }
 
-            // Scratch memory estimate:
-            //  - 4 quantization tables: 4 * 64 * 4 = 1024 bytes
-            //  - 4 Huffman tables: stored on stack (not in scratch)
-            //  - Decoded MCU coefficient blocks: max_h*max_v per component * 64 * 4 bytes
-            //    For 4:2:0 with 3 components: (4+1+1) * 256 = 1536
-            //  - Row buffer for upsampling: width * 3 * 2 rows = width * 6 * max_v
-            //  - Component planes: for each component, one row of MCUs tall
-            //    = (max_h*8) * (max_v*8) * num_comp * 1 byte each
-            //  - We keep it simple: allocate full component planes
-            //    Y plane: width*height bytes, Cb plane: (w/h_ratio)*(h/v_ratio) bytes, same for Cr
-            //  Total: generous upper bound
-            let mcu_w = max_h * 8;
-            let mcu_h = max_v * 8;
-            let mcus_x = (width + mcu_w - 1) / mcu_w;
-            let mcus_y = (height + mcu_h - 1) / mcu_h;
-            let total_mcu_pixels = mcus_x * mcu_w * mcus_y * mcu_h;
-
-            // Component plane sizes (in bytes)
-            let mut plane_total: u32 = 0;
-            if pos + 8 + (num_comp as usize) * 3 <= pos + seg_len {
-                for i in 0..num_comp as usize {
-                    let off = pos + 8 + i * 3;
-                    let hv = data[off + 1];
-                    let h = (hv >> 4) as u32;
-                    let v = (hv & 0x0F) as u32;
-                    let pw = mcus_x * h * 8;
-                    let ph = mcus_y * v * 8;
-                    plane_total += pw * ph;
-                }
-            } else {
-                plane_total = total_mcu_pixels * num_comp;
+            // Scratch memory: one byte per sample of each component plane,
+            // covering whole MCUs at the output block size, for progressive
+            // frames one i16 per coefficient of each full-size block, plus
+            // alignment slack.
+            let block = 8 >> shift;
+            let mcus_x = (width + max_h * 8 - 1) / (max_h * 8);
+            let mcus_y = (height + max_v * 8 - 1) / (max_v * 8);
+            let mut blocks: u32 = 0;
+            for &(h, v) in &hv[..num_comp as usize] {
+                blocks += mcus_x * h * mcus_y * v;
+            }
+            let mut scratch = blocks * block * block + 4096;
+            if marker == M_SOF2 {
+                scratch += blocks * 64 * 2;
             }
-
-            // Quantization tables + alignment slack
-            let scratch = plane_total + 4096;
 
             return Some(ImageInfo {
-                width,
-                height,
+                width: scaled_dim(width, shift),
+                height: scaled_dim(height, shift),
                 format: FMT_JPEG,
                 scratch_needed: scratch,
             });
@@ -388,41 +429,46 @@ pub fn probe(data: &[u8]) -> Option<ImageInfo> {
 // Public API: decode
 // ---------------------------------------------------------------------------
 
-/// Decode a baseline JPEG to ARGB8888 pixels.
+/// Decode a JPEG to ARGB8888 pixels.
 ///
 /// `data`: raw JPEG file bytes
 /// `out`:  output buffer, must hold at least width*height u32 elements
 /// `scratch`: working memory (size from `probe().scratch_needed`)
 pub fn decode(data: &[u8], out: &mut [u32], scratch: &mut [u8]) -> i32 {
+    decode_scaled(data, out, scratch, 0)
+}
+
+/// Decode a JPEG at 1/2^`shift` of its size (`shift` 0..=3), with the
+/// scaling done by the IDCT.
+///
+/// `out` must hold the `probe_scaled()` width*height pixels (each dimension
+/// divided by 2^`shift`, rounded up), and `scratch` its `scratch_needed`
+/// bytes; the scratch size of a full-size `probe()` is always enough.
+pub fn decode_scaled(data: &[u8], out: &mut [u32], scratch: &mut [u8], shift: u32) -> i32 {
     if data.len() < 4 || data[0] != 0xFF || data[1] != M_SOI {
         return ERR_INVALID_DATA;
     }
+    if shift > MAX_SCALE_SHIFT {
+        return ERR_INVALID_DATA;
+    }
 
     let mut frame = FrameInfo::new();
-    let mut quant = [[0i32; 64]; MAX_QTABLES];
-    let mut huff_dc = [HuffTable::new(), HuffTable::new()];
-    let mut huff_ac = [HuffTable::new(), HuffTable::new()];
-    let mut restart_interval: u16 = 0;
-    let mut sos_pos: usize = 0; // position of entropy-coded data
+    let mut tables = Tables {
+        quant: [[0i32; 64]; MAX_QTABLES],
+        huff_dc: [HuffTable::new(), HuffTable::new()],
+        huff_ac: [HuffTable::new(), HuffTable::new()],
+        restart_interval: 0,
+    };
+    let mut layout: Option<Layout> = None;
+    let mut sos_pos: usize = 0; // baseline: position of entropy-coded data
+    let mut scans = 0usize;     // progressive: scans decoded so far
 
     // ------------------------------------------------------------------
-    // Parse markers
+    // Parse markers (and decode progressive scans as they come)
     // ------------------------------------------------------------------
     let mut pos: usize = 2;
-    while pos + 2 <= data.len() {
-        if data[pos] != 0xFF {
-            pos += 1;
-            continue;
-        }
-        while pos + 1 < data.len() && data[pos + 1] == 0xFF {
-            pos += 1;
-        }
-        if pos + 1 >= data.len() {
-            break;
-        }
-
-        let marker = data[pos + 1];
-        pos += 2;
+    while let Some((marker, next)) = next_marker(data, pos) {
+        pos = next;
 
         if marker == M_EOI || marker == 0x00 {
             break;
@@ -431,40 +477,6 @@ pub fn decode(data: &[u8], out: &mut [u32], scratch: &mut [u8]) -> i32 {
             continue;
         }
 
-        // SOS is special: after the header comes the entropy-coded segment
-        if marker == M_SOS {
-            if pos + 2 > data.len() {
-                return ERR_INVALID_DATA;
-            }
-            let seg_len = read_u16_be(data, pos) as usize;
-            if seg_len < 6 || pos + seg_len > data.len() {
-                return ERR_INVALID_DATA;
-            }
-
-            let ns = data[pos + 2] as usize;
-            if ns == 0 || ns > MAX_COMP || ns != frame.num_comp as usize {
-                return ERR_INVALID_DATA;
-            }
-
-            for i in 0..ns {
-                let off = pos + 3 + i * 2;
-                let comp_id = data[off];
-                let td_ta = data[off + 1];
-                let td = td_ta >> 4;
-                let ta = td_ta & 0x0F;
-                // Match component by ID
-                for c in 0..frame.num_comp as usize {
-                    if frame.comp[c].id == comp_id {
-                        frame.comp[c].dc_table = td;
-                        frame.comp[c].ac_table = ta;
-                    }
-                }
-            }
-
-            sos_pos = pos + seg_len;
-            break;
-        }
-
         if pos + 2 > data.len() {
             break;
         }
@@ -473,369 +485,677 @@ pub fn decode(data: &[u8], out: &mut [u32], scratch: &mut [u8]) -> i32 {
             break;
         }
 
-        match marker {
-            M_SOF0 => {
-                // Baseline DCT frame header
-                if seg_len < 8 {
-                    return ERR_INVALID_DATA;
-                }
-                let precision = data[pos + 2];
-                if precision != 8 {
-                    return ERR_UNSUPPORTED;
-                }
-                frame.height = read_u16_be(data, pos + 3);
-                frame.width = read_u16_be(data, pos + 5);
-                frame.num_comp = data[pos + 7];
-
-                if frame.width == 0 || frame.height == 0
-                    || frame.width as u32 > MAX_DIM || frame.height as u32 > MAX_DIM
-                {
-                    return ERR_INVALID_DATA;
-                }
-                if frame.num_comp == 0 || frame.num_comp > MAX_COMP as u8 {
-                    return ERR_UNSUPPORTED;
+        let err = match marker {
+            M_SOF0 | M_SOF2 => parse_frame(data, pos, seg_len, marker == M_SOF2, &mut frame),
+            M_DQT => parse_dqt(data, pos, seg_len, &mut tables.quant),
+            M_DHT => parse_dht(data, pos, seg_len, &mut tables),
+            M_DRI => {
+                // Restart interval
+                if seg_len >= 4 {
+                    tables.restart_interval = read_u16_be(data, pos + 2);
                 }
-
-                let mut max_h: u8 = 1;
-                let mut max_v: u8 = 1;
-                for i in 0..frame.num_comp as usize {
-                    let off = pos + 8 + i * 3;
-                    if off + 2 >= pos + seg_len {
-                        return ERR_INVALID_DATA;
+                ERR_OK
+            }
+            M_SOS => {
+                // After the header comes the entropy-coded segment
+                let hdr = match parse_sos(data, pos, seg_len, &mut frame) {
+                    Ok(h) => h,
+                    Err(e) => return e,
+                };
+                if layout.is_none() {
+                    layout = match Layout::new(&frame, shift, scratch) {
+                        Ok(l) => Some(l),
+                        Err(e) => return e,
+                    };
+                    let out_w = scaled_dim(frame.width as u32, shift) as usize;
+                    let out_h = scaled_dim(frame.height as u32, shift) as usize;
+                    if out.len() < out_w * out_h {
+                        return ERR_BUFFER_TOO_SMALL;
                     }
-                    frame.comp[i].id = data[off];
-                    let hv = data[off + 1];
-                    frame.comp[i].h_samples = hv >> 4;
-                    frame.comp[i].v_samples = hv & 0x0F;
-                    frame.comp[i].qt_id = data[off + 2];
-                    if frame.comp[i].h_samples > 2 || frame.comp[i].v_samples > 2 {
+                }
+                if !frame.progressive {
+                    // One interleaved scan holds the whole image.
+                    if hdr.ns != frame.num_comp as usize {
                         return ERR_UNSUPPORTED;
                     }
-                    if frame.comp[i].h_samples > max_h {
-                        max_h = frame.comp[i].h_samples;
-                    }
-                    if frame.comp[i].v_samples > max_v {
-                        max_v = frame.comp[i].v_samples;
+                    sos_pos = pos + seg_len;
+                    break;
+                }
+                let l = layout.as_ref().unwrap();
+                // A scaled decode skips the bands above the frequencies it keeps
+                // without decoding them: at 1/8 scale, all AC scans.
+                let n = l.planes.block;
+                let scan_end = if hdr.ss as usize > IZIGZAG[(n - 1) * 9] as usize {
+                    Some(jpeg_progressive::end_of_scan(data, pos + seg_len))
+                } else {
+                    jpeg_progressive::decode_scan(
+                        data, pos + seg_len, &frame, &tables, &hdr, &l.coefs, l.mcus_x, l.mcus_y,
+                    )
+                };
+                match scan_end {
+                    Some(end) => {
+                        scans += 1;
+                        pos = end;
+                        continue;
                     }
+                    // A damaged or truncated scan ends the image; the scans
+                    // before it still give a coarser picture.
+                    None => break,
                 }
-                frame.max_h = max_h;
-                frame.max_v = max_v;
             }
+            _ => {
+                // Skip APP0, APPn, COM, etc.
+                ERR_OK
+            }
+        };
+        if err != ERR_OK {
+            return err;
+        }
 
-            M_DQT => {
-                // Quantization table(s)
-                let mut qpos = pos + 2;
-                while qpos < pos + seg_len {
-                    let pq_tq = data[qpos];
-                    let precision_q = pq_tq >> 4;
-                    let tq = (pq_tq & 0x0F) as usize;
-                    qpos += 1;
-
-                    if tq >= MAX_QTABLES {
-                        return ERR_INVALID_DATA;
-                    }
+        pos += seg_len;
+    }
 
-                    for i in 0..64usize {
-                        let zi = ZIGZAG[i] as usize;
-                        if precision_q == 0 {
-                            // 8-bit values
-                            if qpos >= data.len() {
-                                return ERR_INVALID_DATA;
-                            }
-                            quant[tq][zi] = data[qpos] as i32;
-                            qpos += 1;
-                        } else {
-                            // 16-bit values
-                            if qpos + 1 >= data.len() {
-                                return ERR_INVALID_DATA;
-                            }
-                            quant[tq][zi] = read_u16_be(data, qpos) as i32;
-                            qpos += 2;
-                        }
+    let layout = match layout {
+        Some(l) => l,
+        None => return ERR_INVALID_DATA,
+    };
+    let planes = layout.planes;
+
+    if frame.progressive {
+        if scans == 0 {
+            return ERR_INVALID_DATA;
+        }
+        jpeg_progressive::transform(&frame, &tables.quant, &layout.coefs, &planes);
+    } else {
+        // ------------------------------------------------------------------
+        // Decode entropy-coded data
+        // ------------------------------------------------------------------
+        // Every block of every plane is written, so the planes need no clearing.
+        let mcus_x = layout.mcus_x;
+        let scan = Scan {
+            data, frame: &frame, quant: &tables.quant,
+            huff_dc: &tables.huff_dc, huff_ac: &tables.huff_ac,
+            mcus_x, planes,
+        };
+        let total_mcus = mcus_x * layout.mcus_y;
+
+        if tables.restart_interval == 0 {
+            if !decode_mcus(&scan, sos_pos, 0, total_mcus) {
+                return ERR_INVALID_DATA;
+            }
+        } else {
+            // Restart intervals are independent (byte-aligned, DC predictors
+            // reset), so they are decoded in parallel.
+            let ri = tables.restart_interval as usize;
+            let starts = restart_starts(data, sos_pos, (total_mcus + ri - 1) / ri);
+            let tasks = starts.len().min((workers::workers() + 1) * 4);
+            let per_task = (starts.len() + tasks - 1) / tasks;
+            let failed = AtomicBool::new(false);
+            workers::run(tasks, &|t| {
+                let end = ((t + 1) * per_task).min(starts.len());
+                for i in t * per_task..end {
+                    let first = i * ri;
+                    // A stream with missing RST markers decodes its tail in one go.
+                    let count = if i + 1 == starts.len() { total_mcus - first } else { ri };
+                    if !decode_mcus(&scan, starts[i], first, count) {
+                        failed.store(true, Ordering::Relaxed);
                     }
                 }
+            });
+            if failed.load(Ordering::Relaxed) {
+                return ERR_INVALID_DATA;
             }
+        }
+    }
 
-            M_DHT => {
-                // Huffman table(s)
-                let mut hpos = pos + 2;
-                while hpos < pos + seg_len {
-                    if hpos >= data.len() {
-                        return ERR_INVALID_DATA;
-                    }
-                    let tc_th = data[hpos];
-                    let tc = tc_th >> 4; // 0 = DC, 1 = AC
-                    let th = (tc_th & 0x0F) as usize;
-                    hpos += 1;
+    // ------------------------------------------------------------------
+    // Color conversion + chroma upsampling, in bands of rows
+    // ------------------------------------------------------------------
+    let width = scaled_dim(frame.width as u32, shift) as usize;
+    let height = scaled_dim(frame.height as u32, shift) as usize;
+    let out = SyncPtr(out.as_mut_ptr());
+    let bands = height.min((workers::workers() + 1) * 4);
+    let band_rows = (height + bands - 1) / bands;
+    workers::run(bands, &|t| {
+        let end = ((t + 1) * band_rows).min(height);
+        for y in t * band_rows..end {
+            // SAFETY: bands cover disjoint rows of `out` (checked above to hold
+            // width * height pixels) and only read the planes.
+            let row = unsafe { core::slice::from_raw_parts_mut(out.get().add(y * width), width) };
+            convert_row(&frame, &planes, y, row);
+        }
+    });
 
-                    if th > 1 {
-                        return ERR_UNSUPPORTED; // Only tables 0 and 1
-                    }
+    ERR_OK
+}
 
-                    if hpos + 16 > data.len() {
-                        return ERR_INVALID_DATA;
-                    }
-                    let mut counts = [0u8; 16];
-                    let mut total_sym = 0usize;
-                    for i in 0..16 {
-                        counts[i] = data[hpos + i];
-                        total_sym += counts[i] as usize;
-                    }
-                    hpos += 16;
+// ---------------------------------------------------------------------------
+// Marker segments
+// ---------------------------------------------------------------------------
 
-                    if total_sym > 256 || hpos + total_sym > data.len() {
-                        return ERR_INVALID_DATA;
-                    }
+/// Parse a SOF0/SOF2 frame header.
+fn parse_frame(data: &[u8], pos: usize, seg_len: usize, progressive: bool, frame: &mut FrameInfo) -> i32 {
+    if seg_len < 8 {
+        return ERR_INVALID_DATA;
+    }
+    // Only single-frame (non-hierarchical) images.
+    if frame.num_comp != 0 {
+        return ERR_UNSUPPORTED;
+    }
+    let precision = data[pos + 2];
+    if precision != 8 {
+        return ERR_UNSUPPORTED;
+    }
+    frame.height = read_u16_be(data, pos + 3);
+    frame.width = read_u16_be(data, pos + 5);
+    frame.num_comp = data[pos + 7];
+    frame.progressive = progressive;
 
-                    let symbols = &data[hpos..hpos + total_sym];
-                    if tc == 0 {
-                        huff_dc[th].build(&counts, symbols);
-                    } else {
-                        huff_ac[th].build(&counts, symbols);
-                    }
-                    hpos += total_sym;
-                }
-            }
+    if frame.width == 0 || frame.height == 0
+        || frame.width as u32 > MAX_DIM || frame.height as u32 > MAX_DIM
+    {
+        return ERR_INVALID_DATA;
+    }
+    // Two components (no Cr) are not a valid JFIF color space.
+    if frame.num_comp == 0 || frame.num_comp == 2 || frame.num_comp > MAX_COMP as u8 {
+        return ERR_UNSUPPORTED;
+    }
 
-            M_DRI => {
-                // Restart interval
-                if seg_len >= 4 {
-                    restart_interval = read_u16_be(data, pos + 2);
+    let mut max_h: u8 = 1;
+    let mut max_v: u8 = 1;
+    for i in 0..frame.num_comp as usize {
+        let off = pos + 8 + i * 3;
+        if off + 2 >= pos + seg_len {
+            return ERR_INVALID_DATA;
+        }
+        frame.comp[i].id = data[off];
+        let hv = data[off + 1];
+        frame.comp[i].h_samples = hv >> 4;
+        frame.comp[i].v_samples = hv & 0x0F;
+        frame.comp[i].qt_id = data[off + 2];
+        if frame.comp[i].h_samples == 0 || frame.comp[i].v_samples == 0
+            || frame.comp[i].qt_id as usize >= MAX_QTABLES
+        {
+            return ERR_INVALID_DATA;
+        }
+        if frame.comp[i].h_samples > 2 || frame.comp[i].v_samples > 2 {
+            return ERR_UNSUPPORTED;
+        }
+        if frame.comp[i].h_samples > max_h {
+            max_h = frame.comp[i].h_samples;
+        }
+        if frame.comp[i].v_samples > max_v {
+            max_v = frame.comp[i].v_samples;
+        }
+    }
+    // A single component's scan is not interleaved: one block per MCU
+    // whatever its sampling factors say.
+    if frame.num_comp == 1 {
+        frame.comp[0].h_samples = 1;
+        frame.comp[0].v_samples = 1;
+        max_h = 1;
+        max_v = 1;
+    }
+    frame.max_h = max_h;
+    frame.max_v = max_v;
+    ERR_OK
+}
+
+/// Parse a DQT segment (one or more quantization tables).
+fn parse_dqt(data: &[u8], pos: usize, seg_len: usize, quant: &mut [[i32; 64]; MAX_QTABLES]) -> i32 {
+    let mut qpos = pos + 2;
+    while qpos < pos + seg_len {
+        let pq_tq = data[qpos];
+        let precision_q = pq_tq >> 4;
+        let tq = (pq_tq & 0x0F) as usize;
+        qpos += 1;
+
+        if tq >= MAX_QTABLES {
+            return ERR_INVALID_DATA;
+        }
+
+        for i in 0..64usize {
+            let zi = ZIGZAG[i] as usize;
+            if precision_q == 0 {
+                // 8-bit values
+                if qpos >= data.len() {
+                    return ERR_INVALID_DATA;
                 }
+                quant[tq][zi] = data[qpos] as i32;
+                qpos += 1;
+            } else {
+                // 16-bit values
+                if qpos + 1 >= data.len() {
+                    return ERR_INVALID_DATA;
+                }
+                quant[tq][zi] = read_u16_be(data, qpos) as i32;
+                qpos += 2;
             }
+        }
+    }
+    ERR_OK
+}
 
-            _ => {
-                // Skip APP0, APPn, COM, etc.
-            }
+/// Parse a DHT segment (one or more Huffman tables).
+fn parse_dht(data: &[u8], pos: usize, seg_len: usize, tables: &mut Tables) -> i32 {
+    let mut hpos = pos + 2;
+    while hpos < pos + seg_len {
+        if hpos >= data.len() {
+            return ERR_INVALID_DATA;
         }
+        let tc_th = data[hpos];
+        let tc = tc_th >> 4; // 0 = DC, 1 = AC
+        let th = (tc_th & 0x0F) as usize;
+        hpos += 1;
 
-        pos += seg_len;
-    }
+        if th > 1 {
+            return ERR_UNSUPPORTED; // Only tables 0 and 1
+        }
 
-    if sos_pos == 0 || frame.width == 0 {
-        return ERR_INVALID_DATA;
+        if hpos + 16 > data.len() {
+            return ERR_INVALID_DATA;
+        }
+        let mut counts = [0u8; 16];
+        let mut total_sym = 0usize;
+        for i in 0..16 {
+            counts[i] = data[hpos + i];
+            total_sym += counts[i] as usize;
+        }
+        hpos += 16;
+
+        if total_sym > 256 || hpos + total_sym > data.len() {
+            return ERR_INVALID_DATA;
+        }
+
+        let symbols = &data[hpos..hpos + total_sym];
+        if tc == 0 {
+            tables.huff_dc[th].build(&counts, symbols);
+        } else {
+            tables.huff_ac[th].build(&counts, symbols);
+        }
+        hpos += total_sym;
     }
+    ERR_OK
+}
 
-    let width = frame.width as usize;
-    let height = frame.height as usize;
+/// Parse a SOS header, assigning the Huffman tables of the scan's
+/// components.
+fn parse_sos(data: &[u8], pos: usize, seg_len: usize, frame: &mut FrameInfo) -> Result<ScanHeader, i32> {
+    if frame.num_comp == 0 || seg_len < 6 {
+        return Err(ERR_INVALID_DATA);
+    }
+    let ns = data[pos + 2] as usize;
+    if ns == 0 || ns > frame.num_comp as usize || seg_len < 6 + ns * 2 {
+        return Err(ERR_INVALID_DATA);
+    }
 
-    if out.len() < width * height {
-        return ERR_BUFFER_TOO_SMALL;
+    let mut hdr = ScanHeader { ns, comp: [0; MAX_COMP], ss: 0, se: 0, ah: 0, al: 0 };
+    for i in 0..ns {
+        let off = pos + 3 + i * 2;
+        let comp_id = data[off];
+        let td_ta = data[off + 1];
+        // Match component by ID
+        let c = match (0..frame.num_comp as usize).find(|&c| frame.comp[c].id == comp_id) {
+            Some(c) => c,
+            None => return Err(ERR_INVALID_DATA),
+        };
+        frame.comp[c].dc_table = td_ta >> 4;
+        frame.comp[c].ac_table = td_ta & 0x0F;
+        if frame.comp[c].dc_table > 1 || frame.comp[c].ac_table > 1 {
+            return Err(ERR_INVALID_DATA);
+        }
+        hdr.comp[i] = c;
     }
+    let off = pos + 3 + ns * 2;
+    hdr.ss = data[off];
+    hdr.se = data[off + 1];
+    hdr.ah = data[off + 2] >> 4;
+    hdr.al = data[off + 2] & 0x0F;
+    Ok(hdr)
+}
 
-    // ------------------------------------------------------------------
-    // Allocate component planes in scratch buffer
-    // ------------------------------------------------------------------
-    let mcu_w = frame.max_h as usize * 8;
-    let mcu_h = frame.max_v as usize * 8;
-    let mcus_x = (width + mcu_w - 1) / mcu_w;
-    let mcus_y = (height + mcu_h - 1) / mcu_h;
-
-    // Compute plane sizes and offsets within scratch
-    let mut plane_offset = [0usize; MAX_COMP];
-    let mut plane_w = [0usize; MAX_COMP];
-    let mut plane_h = [0usize; MAX_COMP];
-    let mut scratch_used = 0usize;
-
-    for c in 0..frame.num_comp as usize {
-        let pw = mcus_x * frame.comp[c].h_samples as usize * 8;
-        let ph = mcus_y * frame.comp[c].v_samples as usize * 8;
-        plane_w[c] = pw;
-        plane_h[c] = ph;
-        plane_offset[c] = scratch_used;
-        scratch_used += pw * ph;
+/// Where a decode keeps its data in scratch: the component planes at the
+/// output scale, then (progressive frames only) the coefficients.
+struct Layout {
+    mcus_x: usize,
+    mcus_y: usize,
+    planes: Planes,
+    coefs: Coefs,
+}
+
+impl Layout {
+    fn new(frame: &FrameInfo, shift: u32, scratch: &mut [u8]) -> Result<Layout, i32> {
+        // Luma is stored at full resolution; only chroma may be subsampled.
+        if frame.comp[0].h_samples != frame.max_h || frame.comp[0].v_samples != frame.max_v {
+            return Err(ERR_UNSUPPORTED);
+        }
+
+        let width = frame.width as usize;
+        let height = frame.height as usize;
+        let mcu_w = frame.max_h as usize * 8;
+        let mcu_h = frame.max_v as usize * 8;
+        let mcus_x = (width + mcu_w - 1) / mcu_w;
+        let mcus_y = (height + mcu_h - 1) / mcu_h;
+
+        // Compute plane sizes and offsets within scratch
+        let block = 8 >> shift;
+        let mut planes = Planes {
+            base: scratch.as_mut_ptr(),
+            offset: [0; MAX_COMP],
+            width: [0; MAX_COMP],
+            block,
+        };
+        let mut scratch_used = 0usize;
+        for c in 0..frame.num_comp as usize {
+            let pw = mcus_x * frame.comp[c].h_samples as usize * block;
+            let ph = mcus_y * frame.comp[c].v_samples as usize * block;
+            planes.width[c] = pw;
+            planes.offset[c] = scratch_used;
+            scratch_used += pw * ph;
+        }
+        if scratch_used > scratch.len() {
+            return Err(ERR_SCRATCH_TOO_SMALL);
+        }
+
+        let coefs = if frame.progressive {
+            match Coefs::new(frame, mcus_x, mcus_y, &mut scratch[scratch_used..]) {
+                Some(c) => c,
+                None => return Err(ERR_SCRATCH_TOO_SMALL),
+            }
+        } else {
+            Coefs::EMPTY
+        };
+
+        Ok(Layout { mcus_x, mcus_y, planes, coefs })
     }
+}
+
+/// `*mut T` shared with the worker threads; every task touches a disjoint
+/// part of the pointee.
+#[derive(Clone, Copy)]
+pub(crate) struct SyncPtr<T>(pub(crate) *mut T);
 
-    if scratch_used > scratch.len() {
-        return ERR_SCRATCH_TOO_SMALL;
+unsafe impl<T> Sync for SyncPtr<T> {}
+
+impl<T> SyncPtr<T> {
+    /// Accessor, so closures capture the wrapper rather than the raw field.
+    pub(crate) fn get(self) -> *mut T {
+        self.0
     }
+}
 
-    // Zero out scratch planes
-    let mut i = 0;
-    while i < scratch_used {
-        scratch[i] = 0;
-        i += 1;
+/// Component planes in the scratch buffer.  Decode tasks write disjoint
+/// blocks through `base`.
+#[derive(Clone, Copy)]
+pub(crate) struct Planes {
+    base: *mut u8,
+    offset: [usize; MAX_COMP],
+    width: [usize; MAX_COMP],
+    /// Samples per block side: 8 at full size, down to 1 at 1/8 scale.
+    block: usize,
+}
+
+unsafe impl Sync for Planes {}
+
+impl Planes {
+    /// Row `y` of component `c`'s plane.
+    ///
+    /// # Safety
+    /// `y` must be inside the plane, and no other thread may be writing
+    /// the bytes of that row being read (or vice versa).
+    unsafe fn row(&self, c: usize, y: usize) -> &mut [u8] {
+        let w = self.width[c];
+        core::slice::from_raw_parts_mut(self.base.add(self.offset[c] + y * w), w)
     }
+}
 
-    // ------------------------------------------------------------------
-    // Decode entropy-coded data (MCU by MCU)
-    // ------------------------------------------------------------------
-    let mut bits = BitReader::new(data, sos_pos);
-    let mut restart_count: u16 = 0;
-    let mut mcu_count: u32 = 0;
+/// Read-only state shared by all decode tasks of a scan.
+struct Scan<'a> {
+    data: &'a [u8],
+    frame: &'a FrameInfo,
+    quant: &'a [[i32; 64]; MAX_QTABLES],
+    huff_dc: &'a [HuffTable; 2],
+    huff_ac: &'a [HuffTable; 2],
+    mcus_x: usize,
+    planes: Planes,
+}
 
-    // Temporary block for one 8x8 DCT block
+/// Start of each restart interval in the entropy-coded data: `start`, then
+/// the byte after every RST marker, up to `max` intervals or the first
+/// other marker.
+fn restart_starts(data: &[u8], start: usize, max: usize) -> Vec<usize> {
+    let mut starts = Vec::with_capacity(max.min(data.len() / 2 + 1));
+    starts.push(start);
+    let mut i = start;
+    while starts.len() < max && i + 1 < data.len() {
+        if data[i] != 0xFF {
+            i += 1;
+            continue;
+        }
+        match data[i + 1] {
+            // Byte stuffing / fill bytes
+            0x00 | 0xFF => i += 1,
+            0xD0..=0xD7 => {
+                starts.push(i + 2);
+                i += 2;
+            }
+            _ => break,
+        }
+    }
+    starts
+}
+
+/// Decode `count` MCUs starting at MCU index `first` from the entropy-coded
+/// data at `start` (with fresh DC predictors), storing the pixels in the
+/// component planes.  Returns `false` on corrupt data.
+fn decode_mcus(scan: &Scan, start: usize, first: usize, count: usize) -> bool {
+    let frame = scan.frame;
+    let mut bits = BitReader::new(scan.data, start);
+    let mut dc_pred = [0i32; MAX_COMP];
     let mut block = [0i32; 64];
 
-    for mcu_y in 0..mcus_y {
-        for mcu_x in 0..mcus_x {
-            // Handle restart markers
-            if restart_interval > 0 && mcu_count > 0
-                && (mcu_count % restart_interval as u32) == 0
-            {
-                // Align to next byte boundary
-                bits.count = 0;
-                bits.bits = 0;
-                // Skip to next RST marker (0xFFDn)
-                while bits.pos + 1 < data.len() {
-                    if data[bits.pos] == 0xFF && data[bits.pos + 1] >= 0xD0
-                        && data[bits.pos + 1] <= 0xD7
-                    {
-                        bits.pos += 2;
-                        break;
-                    }
-                    bits.pos += 1;
+    for mcu in first..first + count {
+        let mcu_x = mcu % scan.mcus_x;
+        let mcu_y = mcu / scan.mcus_x;
+
+        // Decode each component's blocks in this MCU
+        for c in 0..frame.num_comp as usize {
+            let comp = &frame.comp[c];
+            let h_blocks = comp.h_samples as usize;
+            let v_blocks = comp.v_samples as usize;
+            let qt = &scan.quant[comp.qt_id as usize];
+            let dc_table = &scan.huff_dc[comp.dc_table as usize];
+            let ac_table = &scan.huff_ac[comp.ac_table as usize];
+
+            for bv in 0..v_blocks {
+                for bh in 0..h_blocks {
+                    let has_ac = match decode_block(
+                        &mut bits, dc_table, ac_table, qt, &mut dc_pred[c], &mut block,
+                        scan.planes.block,
+                    ) {
+                        Some(ac) => ac,
+                        None => return false,
+                    };
+
+                    store_block(
+                        &scan.planes, c,
+                        mcu_x * h_blocks + bh, mcu_y * v_blocks + bv,
+                        &block, has_ac,
+                    );
                 }
-                // Reset DC predictors
-                for c in 0..frame.num_comp as usize {
-                    frame.comp[c].dc_pred = 0;
-                }
-                restart_count = restart_count.wrapping_add(1);
             }
+        }
+    }
+    true
+}
 
-            // Decode each component's blocks in this MCU
-            for c in 0..frame.num_comp as usize {
-                let h_blocks = frame.comp[c].h_samples as usize;
-                let v_blocks = frame.comp[c].v_samples as usize;
-                let qt_id = frame.comp[c].qt_id as usize;
-                let dc_id = frame.comp[c].dc_table as usize;
-                let ac_id = frame.comp[c].ac_table as usize;
+/// Decode and dequantize one 8x8 block into `block` (natural order),
+/// keeping only the `n`x`n` lowest frequencies a scaled decode uses.
+/// Returns whether it has any (kept) AC coefficient, or `None` on corrupt
+/// data.
+fn decode_block(
+    bits: &mut BitReader, dc_table: &HuffTable, ac_table: &HuffTable,
+    qt: &[i32; 64], dc_pred: &mut i32, block: &mut [i32; 64], n: usize,
+) -> Option<bool> {
+    // At 1/8 scale only the DC coefficient is ever read.
+    if n > 1 {
+        *block = [0i32; 64];
+    }
 
-                if qt_id >= MAX_QTABLES || dc_id > 1 || ac_id > 1 {
-                    return ERR_INVALID_DATA;
-                }
+    // DC coefficient
+    let dc_sym = bits.decode_huff(dc_table);
+    if dc_sym < 0 {
+        return None;
+    }
+    let dc_diff = bits.receive_extend(dc_sym);
+    *dc_pred = dc_pred.wrapping_add(dc_diff);
+    block[0] = dc_pred.wrapping_mul(qt[0]);
+
+    // AC coefficients
+    let mut has_ac = false;
+    let mut k = 1;
+    while k < 64 {
+        let ac_sym = bits.decode_huff(ac_table);
+        if ac_sym < 0 {
+            return None;
+        }
+        if ac_sym == 0 {
+            break; // EOB
+        }
 
-                for bv in 0..v_blocks {
-                    for bh in 0..h_blocks {
-                        // Decode one 8x8 block
-                        // Clear block
-                        let mut j = 0;
-                        while j < 64 {
-                            block[j] = 0;
-                            j += 1;
-                        }
-
-                        // DC coefficient
-                        let dc_sym = bits.decode_huff(&huff_dc[dc_id]);
-                        if dc_sym < 0 {
-                            return ERR_INVALID_DATA;
-                        }
-                        let dc_diff = bits.receive_extend(dc_sym);
-                        frame.comp[c].dc_pred += dc_diff;
-                        block[0] = frame.comp[c].dc_pred;
-
-                        // AC coefficients
-                        let mut k = 1;
-                        while k < 64 {
-                            let ac_sym = bits.decode_huff(&huff_ac[ac_id]);
-                            if ac_sym < 0 {
-                                return ERR_INVALID_DATA;
-                            }
-                            if ac_sym == 0 {
-                                break; // EOB
-                            }
-
-                            let run = (ac_sym >> 4) & 0x0F;
-                            let size = ac_sym & 0x0F;
-
-                            k += run;
-                            if k >= 64 {
-                                break;
-                            }
-
-                            if size > 0 {
-                                block[ZIGZAG[k as usize] as usize] =
-                                    bits.receive_extend(size);
-                            }
-                            k += 1;
-                        }
-
-                        // Dequantize
-                        let qt = &quant[qt_id];
-                        let mut j = 0;
-                        while j < 64 {
-                            block[j] *= qt[j];
-                            j += 1;
-                        }
-
-                        // Inverse DCT
-                        idct(&mut block);
-
-                        // Store decoded 8x8 block into component plane
-                        let bx = (mcu_x * h_blocks + bh) * 8;
-                        let by = (mcu_y * v_blocks + bv) * 8;
-                        let pw = plane_w[c];
-                        let base = plane_offset[c];
-
-                        for row in 0..8 {
-                            for col in 0..8 {
-                                let px = bx + col;
-                                let py = by + row;
-                                if px < pw && py < plane_h[c] {
-                                    // Clamp to 0..255
-                                    let val = block[row * 8 + col] + 128;
-                                    let clamped = if val < 0 {
-                                        0u8
-                                    } else if val > 255 {
-                                        255u8
-                                    } else {
-                                        val as u8
-                                    };
-                                    scratch[base + py * pw + px] = clamped;
-                                }
-                            }
-                        }
-                    }
-                }
+        let run = (ac_sym >> 4) & 0x0F;
+        let size = ac_sym & 0x0F;
+
+        k += run;
+        if k >= 64 {
+            break;
+        }
+
+        if size > 0 {
+            let v = bits.receive_extend(size);
+            let zi = ZIGZAG[k as usize] as usize;
+            if zi & 7 < n && zi >> 3 < n {
+                block[zi] = v.wrapping_mul(qt[zi]);
+                has_ac = true;
             }
+        }
+        k += 1;
+    }
+    Some(has_ac)
+}
 
-            mcu_count += 1;
+/// Inverse-transform the dequantized `block` (natural order) into block
+/// (`bx`, `by`) of component `c`'s plane, at the plane's block size.
+/// `has_ac` tells whether any AC coefficient is set.
+pub(crate) fn store_block(
+    planes: &Planes, c: usize, bx: usize, by: usize, block: &[i32; 64], has_ac: bool,
+) {
+    let n = planes.block;
+    let (x, y) = (bx * n, by * n);
+    if !has_ac || n == 1 {
+        // DC only: the IDCT output is flat (and at 1/8 scale a block is its
+        // average).  Same value as `idct_store` (pass 1 scales by 4).
+        let v = clamp_u8(((block[0].wrapping_mul(4) + 16) >> 5) + 128);
+        for r in 0..n {
+            unsafe { planes.row(c, y + r)[x..x + n].fill(v) };
         }
+        return;
     }
+    // SAFETY (all rows): each task stores disjoint blocks.
+    match n {
+        8 => idct_store(block, core::array::from_fn(|r| unsafe {
+            &mut planes.row(c, y + r)[x..x + 8]
+        })),
+        4 => idct_reduced(block, &IDCT_4X4, core::array::from_fn(|r| unsafe {
+            &mut planes.row(c, y + r)[x..x + 4]
+        })),
+        _ => idct_reduced(block, &IDCT_2X2, core::array::from_fn(|r| unsafe {
+            &mut planes.row(c, y + r)[x..x + 2]
+        })),
+    }
+}
 
-    // ------------------------------------------------------------------
-    // Color conversion + chroma upsampling
-    // ------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+// Color conversion
+// ---------------------------------------------------------------------------
+
+/// Convert output row `y` from the component planes to ARGB8888.
+fn convert_row(frame: &FrameInfo, planes: &Planes, y: usize, out: &mut [u32]) {
+    let yrow = unsafe { planes.row(0, y) };
     if frame.num_comp == 1 {
         // Grayscale
-        for y in 0..height {
-            for x in 0..width {
-                let g = scratch[plane_offset[0] + y * plane_w[0] + x] as u32;
-                out[y * width + x] = 0xFF000000 | (g << 16) | (g << 8) | g;
-            }
+        for (o, &g) in out.iter_mut().zip(yrow.iter()) {
+            let g = g as u32;
+            *o = 0xFF000000 | (g << 16) | (g << 8) | g;
         }
-    } else {
-        // YCbCr -> RGB
-        for y in 0..height {
-            for x in 0..width {
-                let yy = scratch[plane_offset[0] + y * plane_w[0] + x] as i32;
-
-                // Map pixel coordinates to chroma plane coordinates
-                // using nearest-neighbor upsampling
-                let cx = x * frame.comp[1].h_samples as usize / frame.max_h as usize;
-                let cy = y * frame.comp[1].v_samples as usize / frame.max_v as usize;
-
-                let cb = scratch[plane_offset[1] + cy * plane_w[1] + cx] as i32 - 128;
-                let cr = scratch[plane_offset[2] + cy * plane_w[2] + cx] as i32 - 128;
-
-                // YCbCr -> RGB using fixed-point (Q10)
-                // R = Y + 1.402 * Cr
-                // G = Y - 0.34414 * Cb - 0.71414 * Cr
-                // B = Y + 1.772 * Cb
-                let r = yy + ((cr * 1436) >> 10);               // 1.402 * 1024 ≈ 1436
-                let g = yy - ((cb * 352) >> 10) - ((cr * 731) >> 10); // 0.344*1024≈352, 0.714*1024≈731
-                let b = yy + ((cb * 1815) >> 10);               // 1.772 * 1024 ≈ 1815
-
-                let r = clamp_u8(r) as u32;
-                let g = clamp_u8(g) as u32;
-                let b = clamp_u8(b) as u32;
-
-                out[y * width + x] = 0xFF000000 | (r << 16) | (g << 8) | b;
-            }
+        return;
+    }
+
+    // Nearest-neighbor chroma upsampling.  Sampling factors are at most 2,
+    // so chroma is either full width or half width.
+    let cy = y * frame.comp[1].v_samples as usize / frame.max_v as usize;
+    let half = frame.comp[1].h_samples < frame.max_h;
+    let cb_row = unsafe { planes.row(1, cy) };
+    let cr_row = unsafe { planes.row(2, cy) };
+
+    let width = out.len();
+    let mut x = 0;
+    while x + 4 <= width {
+        let (cb, cr) = if half {
+            let c = x / 2;
+            (
+                [cb_row[c], cb_row[c], cb_row[c + 1], cb_row[c + 1]],
+                [cr_row[c], cr_row[c], cr_row[c + 1], cr_row[c + 1]],
+            )
+        } else {
+            (
+                [cb_row[x], cb_row[x + 1], cb_row[x + 2], cb_row[x + 3]],
+                [cr_row[x], cr_row[x + 1], cr_row[x + 2], cr_row[x + 3]],
+            )
+        };
+        let yy = I32x4::from_u8([yrow[x], yrow[x + 1], yrow[x + 2], yrow[x + 3]]);
+        let mut px = [0i32; 4];
+        ycc_to_argb(yy, I32x4::from_u8(cb), I32x4::from_u8(cr)).store(&mut px);
+        for i in 0..4 {
+            out[x + i] = px[i] as u32;
         }
+        x += 4;
     }
+    while x < width {
+        let c = if half { x / 2 } else { x };
+        let yy = yrow[x] as i32;
+        let cb = cb_row[c] as i32 - 128;
+        let cr = cr_row[c] as i32 - 128;
+
+        // YCbCr -> RGB using fixed-point (Q10)
+        // R = Y + 1.402 * Cr
+        // G = Y - 0.34414 * Cb - 0.71414 * Cr
+        // B = Y + 1.772 * Cb
+        let r = yy + ((cr * 1436) >> 10);               // 1.402 * 1024 ≈ 1436
+        let g = yy - ((cb * 352) >> 10) - ((cr * 731) >> 10); // 0.344*1024≈352, 0.714*1024≈731
+        let b = yy + ((cb * 1815) >> 10);               // 1.772 * 1024 ≈ 1815
+
+        let r = clamp_u8(r) as u32;
+        let g = clamp_u8(g) as u32;
+        let b = clamp_u8(b) as u32;
+
+        out[x] = 0xFF000000 | (r << 16) | (g << 8) | b;
+        x += 1;
+    }
+}
 
-    ERR_OK
+/// The scalar conversion above, 4 pixels at a time.
+#[inline(always)]
+fn ycc_to_argb(yy: I32x4, cb: I32x4, cr: I32x4) -> I32x4 {
+    let cb = cb.sub(I32x4::splat(128));
+    let cr = cr.sub(I32x4::splat(128));
+    let r = yy.add(cr.scale(1436).sra::<10>());
+    let g = yy.sub(cb.scale(352).sra::<10>()).sub(cr.scale(731).sra::<10>());
+    let b = yy.add(cb.scale(1815).sra::<10>());
+    I32x4::splat(0xFF000000u32 as i32)
+        .or(r.clamp(0, 255).shl::<16>())
+        .or(g.clamp(0, 255).shl::<8>())
+        .or(b.clamp(0, 255))
 }
 
 // ---------------------------------------------------------------------------
@@ -853,189 +1173,125 @@ fn clamp_u8(v: i32) -> u8 {
 // Integer IDCT (Loeffler-Ligtenberg-Moschytz, Q13 fixed-point)
 // ---------------------------------------------------------------------------
 //
-// This is the standard LLM algorithm used by libjpeg and many other
-// implementations, adapted for fixed-point integer arithmetic.
+// This is the standard LLM algorithm used by libjpeg (`jpeg_idct_islow`),
+// adapted for fixed-point integer arithmetic.
 //
-// Two 1-D transforms: first on rows, then on columns.
-// The input block is in normal (not zig-zag) order, already dequantized.
-
-fn idct(block: &mut [i32; 64]) {
-    // Row pass
-    for row in 0..8 {
-        let base = row * 8;
-        idct_1d_row(block, base);
+// Two 1-D transforms: first on columns, then on rows.  The first pass keeps
+// PASS1_BITS of extra precision, the second removes them together with the
+// constant scale and the 8x gain of the two passes.  Each pass runs 4
+// transforms at once in the lanes of `I32x4`.  The input block is in natural
+// (not zig-zag) order, already dequantized.
+
+/// Extra precision kept between the two passes.
+const PASS1_BITS: i32 = 2;
+/// Pass 1 rounding: descale by `IDCT_BITS - PASS1_BITS`.
+const PASS1_ROUND: i32 = 1 << (IDCT_BITS - PASS1_BITS - 1);
+/// Pass 2 rounding, with the +128 level shift folded in: descale by
+/// `IDCT_BITS + PASS1_BITS + 3`.
+const PASS2_ROUND: i32 = (1 << (IDCT_BITS + PASS1_BITS + 2)) + (128 << (IDCT_BITS + PASS1_BITS + 3));
+
+/// Inverse-transform `block` and store the level-shifted, clamped result,
+/// one 8-pixel slice per output row.
+fn idct_store(block: &[i32; 64], rows: [&mut [u8]; 8]) {
+    // Pass 1: columns.  `ws[h][r]` holds columns h*4..h*4+4 of row r.
+    let mut ws = [[I32x4::splat(0); 8]; 2];
+    for h in 0..2 {
+        let s: [I32x4; 8] = core::array::from_fn(|r| {
+            let mut v = [0i32; 4];
+            v.copy_from_slice(&block[r * 8 + h * 4..r * 8 + h * 4 + 4]);
+            I32x4::load(&v)
+        });
+        let o = idct_1d(&s);
+        ws[h] = o.map(|v| v.add(I32x4::splat(PASS1_ROUND)).sra::<{ IDCT_BITS - PASS1_BITS }>());
     }
 
-    // Column pass
-    for col in 0..8 {
-        idct_1d_col(block, col);
+    // Pass 2: rows, transposed so each lane holds one row.
+    for g in 0..2 {
+        let r = g * 4;
+        let lo = I32x4::transpose([ws[0][r], ws[0][r + 1], ws[0][r + 2], ws[0][r + 3]]);
+        let hi = I32x4::transpose([ws[1][r], ws[1][r + 1], ws[1][r + 2], ws[1][r + 3]]);
+        let s = [lo[0], lo[1], lo[2], lo[3], hi[0], hi[1], hi[2], hi[3]];
+        let o = idct_1d(&s)
+            .map(|v| v.add(I32x4::splat(PASS2_ROUND)).sra::<{ IDCT_BITS + PASS1_BITS + 3 }>());
+        let lo = I32x4::transpose([o[0], o[1], o[2], o[3]]);
+        let hi = I32x4::transpose([o[4], o[5], o[6], o[7]]);
+        for i in 0..4 {
+            rows[r + i].copy_from_slice(&I32x4::pack_u8(lo[i], hi[i]));
+        }
     }
 }
 
-/// 1D IDCT on a row of 8 elements (in-place).
-fn idct_1d_row(block: &mut [i32; 64], base: usize) {
-    let s0 = block[base + 0];
-    let s1 = block[base + 1];
-    let s2 = block[base + 2];
-    let s3 = block[base + 3];
-    let s4 = block[base + 4];
-    let s5 = block[base + 5];
-    let s6 = block[base + 6];
-    let s7 = block[base + 7];
-
-    // Prescale: shift left to give more precision for row pass
-    // (column pass will shift right for final result)
-    let s0 = s0 << IDCT_BITS;
-    let s4 = s4 << IDCT_BITS;
-
-    // Check for all-zero AC (common shortcut)
-    if s1 == 0 && s2 == 0 && s3 == 0 && s4 == 0
-        && s5 == 0 && s6 == 0 && s7 == 0
-    {
-        let dc = s0 + (1 << (IDCT_BITS - 4)); // rounding for later shift
-        block[base + 0] = dc;
-        block[base + 1] = dc;
-        block[base + 2] = dc;
-        block[base + 3] = dc;
-        block[base + 4] = dc;
-        block[base + 5] = dc;
-        block[base + 6] = dc;
-        block[base + 7] = dc;
-        return;
-    }
-
+/// One 1-D IDCT of 8 inputs, undescaled; 4 independent transforms run in
+/// the lanes.
+#[inline(always)]
+fn idct_1d(s: &[I32x4; 8]) -> [I32x4; 8] {
     // Even part
-    let p2 = s2;
-    let p6 = s6;
-    let t2 = (p2 * FIX_0_541 + p6 * (FIX_0_541 - FIX_1_847)) + IDCT_HALF;
-    let t3 = (p2 * (FIX_0_541 + FIX_0_765) + p6 * FIX_0_541) + IDCT_HALF;
+    let z1 = s[2].add(s[6]).scale(FIX_0_541);
+    let t2 = z1.add(s[6].scale(-FIX_1_847));
+    let t3 = z1.add(s[2].scale(FIX_0_765));
 
-    let t0 = s0 + s4;
-    let t1 = s0 - s4;
+    let t0 = s[0].add(s[4]).shl::<IDCT_BITS>();
+    let t1 = s[0].sub(s[4]).shl::<IDCT_BITS>();
 
-    let e0 = t0 + t3;
-    let e3 = t0 - t3;
-    let e1 = t1 + t2;
-    let e2 = t1 - t2;
+    let e0 = t0.add(t3);
+    let e3 = t0.sub(t3);
+    let e1 = t1.add(t2);
+    let e2 = t1.sub(t2);
 
     // Odd part
-    let mut t0 = s7;
-    let mut t1 = s5;
-    let mut t2 = s3;
-    let mut t3 = s1;
-
-    let z1 = t0 + t3;
-    let z2 = t1 + t2;
-    let z3 = t0 + t2;
-    let z4 = t1 + t3;
-    let z5 = (z3 + z4) * FIX_1_175;
-
-    t0 = t0 * FIX_0_298;
-    t1 = t1 * FIX_2_053;
-    t2 = t2 * FIX_3_072;
-    t3 = t3 * FIX_1_501;
-
-    let z1 = z1 * -FIX_0_899;
-    let z2 = z2 * -FIX_2_562;
-    let z3 = z3 * -FIX_1_961 + z5;
-    let z4 = z4 * -FIX_0_390 + z5;
-
-    t0 = t0 + z1 + z3;
-    t1 = t1 + z2 + z4;
-    t2 = t2 + z2 + z3;
-    t3 = t3 + z1 + z4;
-
-    // Final butterfly and descale (row pass keeps IDCT_BITS of precision)
-    block[base + 0] = (e0 + t3) >> (IDCT_BITS - 2);
-    block[base + 7] = (e0 - t3) >> (IDCT_BITS - 2);
-    block[base + 1] = (e1 + t2) >> (IDCT_BITS - 2);
-    block[base + 6] = (e1 - t2) >> (IDCT_BITS - 2);
-    block[base + 2] = (e2 + t1) >> (IDCT_BITS - 2);
-    block[base + 5] = (e2 - t1) >> (IDCT_BITS - 2);
-    block[base + 3] = (e3 + t0) >> (IDCT_BITS - 2);
-    block[base + 4] = (e3 - t0) >> (IDCT_BITS - 2);
+    let (t0, t1, t2, t3) = (s[7], s[5], s[3], s[1]);
+
+    let z1 = t0.add(t3);
+    let z2 = t1.add(t2);
+    let z3 = t0.add(t2);
+    let z4 = t1.add(t3);
+    let z5 = z3.add(z4).scale(FIX_1_175);
+
+    let z1 = z1.scale(-FIX_0_899);
+    let z2 = z2.scale(-FIX_2_562);
+    let z3 = z3.scale(-FIX_1_961).add(z5);
+    let z4 = z4.scale(-FIX_0_390).add(z5);
+
+    let t0 = t0.scale(FIX_0_298).add(z1).add(z3);
+    let t1 = t1.scale(FIX_2_053).add(z2).add(z4);
+    let t2 = t2.scale(FIX_3_072).add(z2).add(z3);
+    let t3 = t3.scale(FIX_1_501).add(z1).add(z4);
+
+    // Final butterfly
+    [
+        e0.add(t3), e1.add(t2), e2.add(t1), e3.add(t0),
+        e3.sub(t0), e2.sub(t1), e1.sub(t2), e0.sub(t3),
+    ]
 }
 
-/// 1D IDCT on a column of 8 elements (in-place).
-fn idct_1d_col(block: &mut [i32; 64], col: usize) {
-    let s0 = block[0 * 8 + col];
-    let s1 = block[1 * 8 + col];
-    let s2 = block[2 * 8 + col];
-    let s3 = block[3 * 8 + col];
-    let s4 = block[4 * 8 + col];
-    let s5 = block[5 * 8 + col];
-    let s6 = block[6 * 8 + col];
-    let s7 = block[7 * 8 + col];
-
-    // Check for all-zero AC (common shortcut)
-    if s1 == 0 && s2 == 0 && s3 == 0 && s4 == 0
-        && s5 == 0 && s6 == 0 && s7 == 0
-    {
-        // Descale: row pass left IDCT_BITS-2 of extra precision,
-        // column pass needs to remove those plus the row prescale.
-        // Total shift: IDCT_BITS + IDCT_BITS - 2 + 3 = 2*IDCT_BITS + 1
-        let dc = (s0 + (1 << (IDCT_BITS + 1))) >> (IDCT_BITS + 2);
-        block[0 * 8 + col] = dc;
-        block[1 * 8 + col] = dc;
-        block[2 * 8 + col] = dc;
-        block[3 * 8 + col] = dc;
-        block[4 * 8 + col] = dc;
-        block[5 * 8 + col] = dc;
-        block[6 * 8 + col] = dc;
-        block[7 * 8 + col] = dc;
-        return;
+/// Pass 2 rounding of the reduced IDCT, with the +128 level shift folded
+/// in.  Its matrices are normalized, so there is no gain to remove.
+const REDUCED_ROUND: i32 = (1 << (IDCT_BITS + PASS1_BITS - 1)) + (128 << (IDCT_BITS + PASS1_BITS));
+
+/// Reduced IDCT for scaled decoding: the `N`-point inverse transform of
+/// the `N`x`N` lowest frequencies of `block` (natural order, dequantized),
+/// stored level-shifted and clamped, one `N`-pixel slice per output row.
+fn idct_reduced<const N: usize>(block: &[i32; 64], k: &[[i32; N]; N], rows: [&mut [u8]; N]) {
+    // Pass 1: columns.  `ws[y][u]` is frequency column u at output row y.
+    let mut ws = [[0i32; N]; N];
+    for u in 0..N {
+        for y in 0..N {
+            let mut acc = PASS1_ROUND;
+            for v in 0..N {
+                acc = acc.wrapping_add(k[y][v].wrapping_mul(block[v * 8 + u]));
+            }
+            ws[y][u] = acc >> (IDCT_BITS - PASS1_BITS);
+        }
     }
 
-    // Even part
-    let p2 = s2;
-    let p6 = s6;
-    let t2 = p2 * FIX_0_541 + p6 * (FIX_0_541 - FIX_1_847);
-    let t3 = p2 * (FIX_0_541 + FIX_0_765) + p6 * FIX_0_541;
-
-    let t0 = (s0 + s4) << IDCT_BITS;
-    let t1 = (s0 - s4) << IDCT_BITS;
-
-    let e0 = t0 + t3 + IDCT_HALF;
-    let e3 = t0 - t3 + IDCT_HALF;
-    let e1 = t1 + t2 + IDCT_HALF;
-    let e2 = t1 - t2 + IDCT_HALF;
-
-    // Odd part
-    let mut t0 = s7;
-    let mut t1 = s5;
-    let mut t2 = s3;
-    let mut t3 = s1;
-
-    let z1 = t0 + t3;
-    let z2 = t1 + t2;
-    let z3 = t0 + t2;
-    let z4 = t1 + t3;
-    let z5 = (z3 + z4) * FIX_1_175;
-
-    t0 = t0 * FIX_0_298;
-    t1 = t1 * FIX_2_053;
-    t2 = t2 * FIX_3_072;
-    t3 = t3 * FIX_1_501;
-
-    let z1 = z1 * -FIX_0_899;
-    let z2 = z2 * -FIX_2_562;
-    let z3 = z3 * -FIX_1_961 + z5;
-    let z4 = z4 * -FIX_0_390 + z5;
-
-    t0 = t0 + z1 + z3;
-    t1 = t1 + z2 + z4;
-    t2 = t2 + z2 + z3;
-    t3 = t3 + z1 + z4;
-
-    // Final butterfly and descale
-    // The combined descale from row + column pass
-    let shift = IDCT_BITS + 2;
-    block[0 * 8 + col] = (e0 + t3) >> shift;
-    block[7 * 8 + col] = (e0 - t3) >> shift;
-    block[1 * 8 + col] = (e1 + t2) >> shift;
-    block[6 * 8 + col] = (e1 - t2) >> shift;
-    block[2 * 8 + col] = (e2 + t1) >> shift;
-    block[5 * 8 + col] = (e2 - t1) >> shift;
-    block[3 * 8 + col] = (e3 + t0) >> shift;
-    block[4 * 8 + col] = (e3 - t0) >> shift;
+    // Pass 2: rows.
+    for (y, row) in rows.into_iter().enumerate() {
+        for x in 0..N {
+            let mut acc = REDUCED_ROUND;
+            for u in 0..N {
+                acc = acc.wrapping_add(k[x][u].wrapping_mul(ws[y][u]));
+            }
+            row[x] = clamp_u8(acc >> (IDCT_BITS + PASS1_BITS));
+        }
+    }
 }
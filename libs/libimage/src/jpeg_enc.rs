@@ -0,0 +1,386 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Baseline JPEG encoder.
+//!
+//! Writes 8-bit YCbCr with 2x2 chroma subsampling (4:2:0), the Annex K
+//! quantization tables scaled by a 1-100 quality, and the Annex K Huffman
+//! tables, so an image is encoded in one sweep without a statistics pass.
+//! The forward DCT is the AAN float transform; its output scale is folded
+//! into the quantizer divisors.
+
+use crate::jpeg_tables::{DEFAULT_CHROMA_QUANT, DEFAULT_LUMA_QUANT, ZIGZAG};
+use crate::types::*;
+
+// ── Annex K.3 Huffman tables ────────────────────────────────────────────────
+
+const DC_LUMA_BITS: [u8; 16] = [0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0];
+const DC_CHROMA_BITS: [u8; 16] = [0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0];
+const DC_VALS: [u8; 12] = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11];
+
+const AC_LUMA_BITS: [u8; 16] = [0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d];
+const AC_LUMA_VALS: [u8; 162] = [
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+];
+
+const AC_CHROMA_BITS: [u8; 16] = [0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77];
+const AC_CHROMA_VALS: [u8; 162] = [
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+];
+
+/// AAN output scale per frequency: `cos(k*pi/16) * sqrt(2)` (1 for k = 0).
+const AAN_SCALE: [f32; 8] = [
+    1.0, 1.387039845, 1.306562965, 1.175875602,
+    1.0, 0.785694958, 0.541196100, 0.275899379,
+];
+
+// ── Huffman codes ───────────────────────────────────────────────────────────
+
+/// Canonical Huffman code per symbol.
+struct Huff {
+    code: [u16; 256],
+    size: [u8; 256],
+}
+
+impl Huff {
+    fn build(bits: &[u8; 16], vals: &[u8]) -> Huff {
+        let mut h = Huff { code: [0; 256], size: [0; 256] };
+        let mut code = 0u16;
+        let mut k = 0usize;
+        for len in 1..=16u8 {
+            for _ in 0..bits[len as usize - 1] {
+                h.code[vals[k] as usize] = code;
+                h.size[vals[k] as usize] = len;
+                code += 1;
+                k += 1;
+            }
+            code <<= 1;
+        }
+        h
+    }
+}
+
+// ── Output ──────────────────────────────────────────────────────────────────
+
+/// Byte and entropy-coded bit writer over the caller's buffer.
+struct Writer<'a> {
+    buf: &'a mut [u8],
+    pos: usize,
+    overflow: bool,
+    acc: u32,
+    nbits: u32,
+}
+
+impl<'a> Writer<'a> {
+    fn byte(&mut self, b: u8) {
+        if self.pos < self.buf.len() {
+            self.buf[self.pos] = b;
+            self.pos += 1;
+        } else {
+            self.overflow = true;
+        }
+    }
+
+    fn bytes(&mut self, data: &[u8]) {
+        for &b in data {
+            self.byte(b);
+        }
+    }
+
+    fn u16(&mut self, v: u16) {
+        self.bytes(&v.to_be_bytes());
+    }
+
+    /// Append `len` (≤ 16) bits, stuffing a zero after every 0xFF byte.
+    fn bits(&mut self, code: u32, len: u32) {
+        self.acc = (self.acc << len) | (code & ((1 << len) - 1));
+        self.nbits += len;
+        while self.nbits >= 8 {
+            self.nbits -= 8;
+            let b = (self.acc >> self.nbits) as u8;
+            self.byte(b);
+            if b == 0xFF {
+                self.byte(0);
+            }
+        }
+        self.acc &= (1 << self.nbits) - 1;
+    }
+
+    /// Pad the last byte of entropy-coded data with 1 bits.
+    fn flush_bits(&mut self) {
+        if self.nbits > 0 {
+            let pad = 8 - self.nbits;
+            self.bits((1 << pad) - 1, pad);
+        }
+    }
+}
+
+// ── Transform and entropy coding ────────────────────────────────────────────
+
+/// In-place AAN forward DCT (rows, then columns).  Output is scaled by
+/// `8 * AAN_SCALE[u] * AAN_SCALE[v]`.
+fn fdct(d: &mut [f32; 64]) {
+    for pass in 0..2 {
+        for i in 0..8 {
+            let (base, step) = if pass == 0 { (i * 8, 1) } else { (i, 8) };
+            let at = |k: usize| base + k * step;
+            let tmp0 = d[at(0)] + d[at(7)];
+            let tmp7 = d[at(0)] - d[at(7)];
+            let tmp1 = d[at(1)] + d[at(6)];
+            let tmp6 = d[at(1)] - d[at(6)];
+            let tmp2 = d[at(2)] + d[at(5)];
+            let tmp5 = d[at(2)] - d[at(5)];
+            let tmp3 = d[at(3)] + d[at(4)];
+            let tmp4 = d[at(3)] - d[at(4)];
+
+            let tmp10 = tmp0 + tmp3;
+            let tmp13 = tmp0 - tmp3;
+            let tmp11 = tmp1 + tmp2;
+            let tmp12 = tmp1 - tmp2;
+            d[at(0)] = tmp10 + tmp11;
+            d[at(4)] = tmp10 - tmp11;
+            let z1 = (tmp12 + tmp13) * 0.707106781;
+            d[at(2)] = tmp13 + z1;
+            d[at(6)] = tmp13 - z1;
+
+            let tmp10 = tmp4 + tmp5;
+            let tmp11 = tmp5 + tmp6;
+            let tmp12 = tmp6 + tmp7;
+            let z5 = (tmp10 - tmp12) * 0.382683433;
+            let z2 = 0.541196100 * tmp10 + z5;
+            let z4 = 1.306562965 * tmp12 + z5;
+            let z3 = tmp11 * 0.707106781;
+            let z11 = tmp7 + z3;
+            let z13 = tmp7 - z3;
+            d[at(5)] = z13 + z2;
+            d[at(3)] = z13 - z2;
+            d[at(1)] = z11 + z4;
+            d[at(7)] = z11 - z4;
+        }
+    }
+}
+
+/// Bits needed for the magnitude of `v` (the JPEG "category").
+fn category(v: i32) -> u32 {
+    32 - v.unsigned_abs().leading_zeros()
+}
+
+/// Append `v` in `n` bits, ones' complement for negative values.
+fn put_value(w: &mut Writer, v: i32, n: u32) {
+    if n > 0 {
+        let bits = if v < 0 { v - 1 } else { v };
+        w.bits(bits as u32, n);
+    }
+}
+
+/// Transform, quantize and Huffman-code one 8x8 block of level-shifted samples.
+fn encode_block(w: &mut Writer, block: &mut [f32; 64], divisors: &[f32; 64],
+                prev_dc: &mut i32, dc: &Huff, ac: &Huff) {
+    fdct(block);
+    let mut q = [0i32; 64];
+    for k in 0..64 {
+        let i = ZIGZAG[k] as usize;
+        // Round half away from zero without libm.
+        q[k] = (block[i] * divisors[i] + 16384.5) as i32 - 16384;
+    }
+
+    let diff = q[0] - *prev_dc;
+    *prev_dc = q[0];
+    let n = category(diff);
+    w.bits(dc.code[n as usize] as u32, dc.size[n as usize] as u32);
+    put_value(w, diff, n);
+
+    let mut run = 0u32;
+    for k in 1..64 {
+        let v = q[k];
+        if v == 0 {
+            run += 1;
+            continue;
+        }
+        while run >= 16 {
+            w.bits(ac.code[0xF0] as u32, ac.size[0xF0] as u32);
+            run -= 16;
+        }
+        let n = category(v);
+        let sym = ((run << 4) | n) as usize;
+        w.bits(ac.code[sym] as u32, ac.size[sym] as u32);
+        put_value(w, v, n);
+        run = 0;
+    }
+    if run > 0 {
+        w.bits(ac.code[0] as u32, ac.size[0] as u32);
+    }
+}
+
+/// Scale an Annex K table by `quality` (libjpeg's mapping).
+fn scale_quant(base: &[u8; 64], quality: u32) -> [u8; 64] {
+    let q = quality.clamp(1, 100);
+    let scale = if q < 50 { 5000 / q } else { 200 - q * 2 };
+    let mut t = [0u8; 64];
+    for i in 0..64 {
+        t[i] = ((base[i] as u32 * scale + 50) / 100).clamp(1, 255) as u8;
+    }
+    t
+}
+
+/// Reciprocal quantizer per natural-order coefficient, including the DCT scale.
+fn divisors(qt: &[u8; 64]) -> [f32; 64] {
+    let mut d = [0f32; 64];
+    for row in 0..8 {
+        for col in 0..8 {
+            let i = row * 8 + col;
+            d[i] = 1.0 / (qt[i] as f32 * AAN_SCALE[row] * AAN_SCALE[col] * 8.0);
+        }
+    }
+    d
+}
+
+// ── Headers ─────────────────────────────────────────────────────────────────
+
+fn write_headers(w: &mut Writer, width: u32, height: u32, qt_luma: &[u8; 64], qt_chroma: &[u8; 64]) {
+    w.bytes(&[0xFF, 0xD8]); // SOI
+    // APP0 JFIF 1.1, no density, no thumbnail.
+    w.bytes(&[0xFF, 0xE0, 0, 16, b'J', b'F', b'I', b'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0]);
+
+    // DQT: both tables in zig-zag order.
+    w.bytes(&[0xFF, 0xDB]);
+    w.u16(2 + 2 * 65);
+    for (id, qt) in [(0u8, qt_luma), (1u8, qt_chroma)] {
+        w.byte(id);
+        for k in 0..64 {
+            w.byte(qt[ZIGZAG[k] as usize]);
+        }
+    }
+
+    // SOF0: Y sampled 2x2, Cb and Cr 1x1.
+    w.bytes(&[0xFF, 0xC0]);
+    w.u16(17);
+    w.byte(8);
+    w.u16(height as u16);
+    w.u16(width as u16);
+    w.bytes(&[3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1]);
+
+    // DHT: DC/AC luma (class/id 0x00, 0x10), DC/AC chroma (0x01, 0x11).
+    let tables: [(u8, &[u8; 16], &[u8]); 4] = [
+        (0x00, &DC_LUMA_BITS, &DC_VALS),
+        (0x10, &AC_LUMA_BITS, &AC_LUMA_VALS),
+        (0x01, &DC_CHROMA_BITS, &DC_VALS),
+        (0x11, &AC_CHROMA_BITS, &AC_CHROMA_VALS),
+    ];
+    let len: usize = 2 + tables.iter().map(|t| 17 + t.2.len()).sum::<usize>();
+    w.bytes(&[0xFF, 0xC4]);
+    w.u16(len as u16);
+    for (class, bits, vals) in tables {
+        w.byte(class);
+        w.bytes(bits);
+        w.bytes(vals);
+    }
+
+    // SOS: all three components, full spectral range.
+    w.bytes(&[0xFF, 0xDA]);
+    w.u16(12);
+    w.bytes(&[3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0]);
+}
+
+// ── Public API ──────────────────────────────────────────────────────────────
+
+/// Encode ARGB8888 pixels (`stride` pixels per row) as a baseline JPEG at
+/// `quality` (1-100).  Alpha is ignored.
+///
+/// Returns total bytes written on success, or a negative error code.
+pub fn encode(pixels: &[u32], width: u32, height: u32, stride: u32, quality: u32, out: &mut [u8]) -> i32 {
+    let w = width as usize;
+    let h = height as usize;
+    let stride = stride as usize;
+    if w == 0 || h == 0 || w > 0xFFFF || h > 0xFFFF || stride < w
+        || pixels.len() < (h - 1) * stride + w {
+        return ERR_INVALID_DATA;
+    }
+
+    let qt_luma = scale_quant(&DEFAULT_LUMA_QUANT, quality);
+    let qt_chroma = scale_quant(&DEFAULT_CHROMA_QUANT, quality);
+    let div_luma = divisors(&qt_luma);
+    let div_chroma = divisors(&qt_chroma);
+    let dc_luma = Huff::build(&DC_LUMA_BITS, &DC_VALS);
+    let ac_luma = Huff::build(&AC_LUMA_BITS, &AC_LUMA_VALS);
+    let dc_chroma = Huff::build(&DC_CHROMA_BITS, &DC_VALS);
+    let ac_chroma = Huff::build(&AC_CHROMA_BITS, &AC_CHROMA_VALS);
+
+    let mut wr = Writer { buf: out, pos: 0, overflow: false, acc: 0, nbits: 0 };
+    write_headers(&mut wr, width, height, &qt_luma, &qt_chroma);
+
+    let mut y_plane = [0f32; 256];
+    let mut cb_plane = [0f32; 256];
+    let mut cr_plane = [0f32; 256];
+    let mut block = [0f32; 64];
+    let (mut dc_y, mut dc_cb, mut dc_cr) = (0i32, 0i32, 0i32);
+
+    for my in (0..h).step_by(16) {
+        for mx in (0..w).step_by(16) {
+            // Convert the 16x16 MCU, replicating edge pixels past the image.
+            for dy in 0..16 {
+                let row = (my + dy).min(h - 1) * stride;
+                for dx in 0..16 {
+                    let p = pixels[row + (mx + dx).min(w - 1)];
+                    let r = ((p >> 16) & 0xFF) as f32;
+                    let g = ((p >> 8) & 0xFF) as f32;
+                    let b = (p & 0xFF) as f32;
+                    let i = dy * 16 + dx;
+                    y_plane[i] = 0.299 * r + 0.587 * g + 0.114 * b - 128.0;
+                    cb_plane[i] = -0.168736 * r - 0.331264 * g + 0.5 * b;
+                    cr_plane[i] = 0.5 * r - 0.418688 * g - 0.081312 * b;
+                }
+            }
+
+            for (bx, by) in [(0, 0), (8, 0), (0, 8), (8, 8)] {
+                for r in 0..8 {
+                    block[r * 8..r * 8 + 8]
+                        .copy_from_slice(&y_plane[(by + r) * 16 + bx..][..8]);
+                }
+                encode_block(&mut wr, &mut block, &div_luma, &mut dc_y, &dc_luma, &ac_luma);
+            }
+
+            for (plane, dc) in [(&cb_plane, &mut dc_cb), (&cr_plane, &mut dc_cr)] {
+                for r in 0..8 {
+                    for c in 0..8 {
+                        let i = r * 32 + c * 2;
+                        block[r * 8 + c] =
+                            (plane[i] + plane[i + 1] + plane[i + 16] + plane[i + 17]) * 0.25;
+                    }
+                }
+                encode_block(&mut wr, &mut block, &div_chroma, dc, &dc_chroma, &ac_chroma);
+            }
+
+            if wr.overflow {
+                return ERR_BUFFER_TOO_SMALL;
+            }
+        }
+    }
+
+    wr.flush_bits();
+    wr.bytes(&[0xFF, 0xD9]); // EOI
+    if wr.overflow {
+        return ERR_BUFFER_TOO_SMALL;
+    }
+    wr.pos as i32
+}
@@ -0,0 +1,324 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Progressive (SOF2) scans for the JPEG decoder.
+//!
+//! A progressive frame sends its coefficients in several scans: the DC
+//! coefficients first, then bands of AC coefficients (spectral selection),
+//! each band possibly split into a first pass carrying the high bits and
+//! refinement passes adding one bit each (successive approximation).
+//!
+//! The scans are decoded into a coefficient buffer in scratch, one `i16` per
+//! coefficient, which [`transform`] dequantizes and inverse-transforms into
+//! the component planes once all scans are in.  Scans follow ITU T.81
+//! G.1.2; the refinement passes mirror libjpeg's `jdphuff.c`.
+
+use crate::jpeg::{store_block, BitReader, FrameInfo, HuffTable, Planes, ScanHeader, Tables, MAX_COMP};
+use crate::jpeg_tables::ZIGZAG;
+use crate::workers;
+
+/// Coefficient buffer: 64 `i16` per block in zig-zag order.  Each component
+/// covers its whole MCU-padded block grid, like its plane.
+#[derive(Clone, Copy)]
+pub(crate) struct Coefs {
+    base: *mut i16,
+    /// First block of each component.
+    offset: [usize; MAX_COMP],
+    blocks_w: [usize; MAX_COMP],
+    blocks_h: [usize; MAX_COMP],
+}
+
+// Decode tasks touch disjoint blocks.
+unsafe impl Sync for Coefs {}
+
+impl Coefs {
+    /// No coefficients (baseline frames).
+    pub(crate) const EMPTY: Coefs = Coefs {
+        base: core::ptr::null_mut(),
+        offset: [0; MAX_COMP],
+        blocks_w: [0; MAX_COMP],
+        blocks_h: [0; MAX_COMP],
+    };
+
+    /// Lay out the buffer for `frame` at the start of `scratch` and clear
+    /// it.  Returns `None` if `scratch` is too small.
+    pub(crate) fn new(frame: &FrameInfo, mcus_x: usize, mcus_y: usize, scratch: &mut [u8]) -> Option<Coefs> {
+        let mut coefs = Coefs::EMPTY;
+        let mut blocks = 0;
+        for c in 0..frame.num_comp as usize {
+            coefs.offset[c] = blocks;
+            coefs.blocks_w[c] = mcus_x * frame.comp[c].h_samples as usize;
+            coefs.blocks_h[c] = mcus_y * frame.comp[c].v_samples as usize;
+            blocks += coefs.blocks_w[c] * coefs.blocks_h[c];
+        }
+        let pad = scratch.as_ptr().align_offset(core::mem::align_of::<i16>());
+        if pad + blocks * 64 * 2 > scratch.len() {
+            return None;
+        }
+        coefs.base = scratch[pad..].as_mut_ptr() as *mut i16;
+        // Coefficients no scan sends stay zero.
+        unsafe { core::slice::from_raw_parts_mut(coefs.base, blocks * 64).fill(0) };
+        Some(coefs)
+    }
+
+    /// Coefficients of block (`bx`, `by`) of component `c`.
+    ///
+    /// # Safety
+    /// The block must be inside the component's grid, and no other thread
+    /// may access it meanwhile.
+    unsafe fn block(&self, c: usize, bx: usize, by: usize) -> &mut [i16; 64] {
+        let i = self.offset[c] + by * self.blocks_w[c] + bx;
+        &mut *(self.base.add(i * 64) as *mut [i16; 64])
+    }
+}
+
+/// Decode one scan, whose entropy-coded data starts at `start`, into
+/// `coefs`.  Returns the position of the marker after the scan, or `None`
+/// on corrupt data.
+pub(crate) fn decode_scan(
+    data: &[u8], start: usize, frame: &FrameInfo, tables: &Tables, hdr: &ScanHeader,
+    coefs: &Coefs, mcus_x: usize, mcus_y: usize,
+) -> Option<usize> {
+    // DC and AC coefficients never share a scan, and AC scans hold a single
+    // component (G.1.1.1.1).
+    if hdr.se > 63 || hdr.ss > hdr.se || (hdr.ss == 0 && hdr.se != 0)
+        || (hdr.ss > 0 && hdr.ns != 1) || hdr.ah > 13 || hdr.al > 13
+    {
+        return None;
+    }
+
+    let mut bits = BitReader::new(data, start);
+    let mut dc_pred = [0i32; MAX_COMP];
+    let mut eobrun = 0u32;
+    let ri = tables.restart_interval as usize;
+
+    // A single-component scan codes the blocks covering the component one
+    // by one; an interleaved scan codes whole MCUs.
+    let (units_x, units_y) = if hdr.ns == 1 {
+        let comp = &frame.comp[hdr.comp[0]];
+        let (max_h, max_v) = (frame.max_h as usize, frame.max_v as usize);
+        let w = (frame.width as usize * comp.h_samples as usize + max_h - 1) / max_h;
+        let h = (frame.height as usize * comp.v_samples as usize + max_v - 1) / max_v;
+        ((w + 7) / 8, (h + 7) / 8)
+    } else {
+        (mcus_x, mcus_y)
+    };
+
+    for unit in 0..units_x * units_y {
+        if ri != 0 && unit != 0 && unit % ri == 0 {
+            if !bits.restart() {
+                return None;
+            }
+            dc_pred = [0; MAX_COMP];
+            eobrun = 0;
+        }
+        let (ux, uy) = (unit % units_x, unit / units_x);
+
+        if hdr.ns == 1 {
+            let c = hdr.comp[0];
+            // SAFETY: the units of a single-component scan lie inside the
+            // grid, which covers whole MCUs.
+            let blk = unsafe { coefs.block(c, ux, uy) };
+            if !decode_block(&mut bits, tables, frame, c, hdr, blk, &mut dc_pred[c], &mut eobrun) {
+                return None;
+            }
+            continue;
+        }
+        for &c in &hdr.comp[..hdr.ns] {
+            let (h, v) = (frame.comp[c].h_samples as usize, frame.comp[c].v_samples as usize);
+            for bv in 0..v {
+                for bh in 0..h {
+                    let blk = unsafe { coefs.block(c, ux * h + bh, uy * v + bv) };
+                    if !decode_block(&mut bits, tables, frame, c, hdr, blk, &mut dc_pred[c], &mut eobrun) {
+                        return None;
+                    }
+                }
+            }
+        }
+    }
+
+    Some(end_of_scan(data, bits.pos))
+}
+
+/// Position of the first marker at or after `pos` that is not RST: the end
+/// of a scan's entropy-coded data.
+pub(crate) fn end_of_scan(data: &[u8], mut pos: usize) -> usize {
+    while pos + 1 < data.len() {
+        if data[pos] == 0xFF && !matches!(data[pos + 1], 0x00 | 0xD0..=0xD7 | 0xFF) {
+            return pos;
+        }
+        pos += 1;
+    }
+    data.len()
+}
+
+/// Decode the part of one block that scan `hdr` carries.
+fn decode_block(
+    bits: &mut BitReader, tables: &Tables, frame: &FrameInfo, c: usize, hdr: &ScanHeader,
+    blk: &mut [i16; 64], dc_pred: &mut i32, eobrun: &mut u32,
+) -> bool {
+    let comp = &frame.comp[c];
+    let (ss, se, al) = (hdr.ss as usize, hdr.se as usize, hdr.al as i32);
+    match (ss == 0, hdr.ah == 0) {
+        (true, true) => dc_first(bits, &tables.huff_dc[comp.dc_table as usize], blk, dc_pred, al),
+        (true, false) => {
+            // One more bit of the DC coefficient, sent raw
+            if bits.read_bits(1) != 0 {
+                blk[0] |= 1 << al;
+            }
+            true
+        }
+        (false, true) => ac_first(bits, &tables.huff_ac[comp.ac_table as usize], blk, ss, se, al, eobrun),
+        (false, false) => ac_refine(bits, &tables.huff_ac[comp.ac_table as usize], blk, ss, se, al, eobrun),
+    }
+}
+
+/// First DC scan: the difference to the predictor, scaled by 2^`al`.
+fn dc_first(bits: &mut BitReader, table: &HuffTable, blk: &mut [i16; 64], pred: &mut i32, al: i32) -> bool {
+    let s = bits.decode_huff(table);
+    if !(0..=15).contains(&s) {
+        return false;
+    }
+    *pred = pred.wrapping_add(bits.receive_extend(s));
+    blk[0] = pred.wrapping_shl(al as u32) as i16;
+    true
+}
+
+/// First scan of an AC band: run-length coded like a baseline block, with
+/// end-of-band runs spanning several blocks.
+fn ac_first(
+    bits: &mut BitReader, table: &HuffTable, blk: &mut [i16; 64],
+    ss: usize, se: usize, al: i32, eobrun: &mut u32,
+) -> bool {
+    if *eobrun > 0 {
+        *eobrun -= 1;
+        return true;
+    }
+    let mut k = ss;
+    while k <= se {
+        let rs = bits.decode_huff(table);
+        if rs < 0 {
+            return false;
+        }
+        let r = (rs >> 4) as usize;
+        let s = rs & 15;
+        if s == 0 {
+            if r < 15 {
+                // End of band here and in the next EOBRUN - 1 blocks
+                *eobrun = (1u32 << r) + bits.read_bits(r as i32) as u32 - 1;
+                break;
+            }
+            // 16 zeros
+            k += 16;
+            continue;
+        }
+        k += r;
+        if k > se {
+            return false;
+        }
+        blk[k] = bits.receive_extend(s).wrapping_shl(al as u32) as i16;
+        k += 1;
+    }
+    true
+}
+
+/// Refinement scan of an AC band: one more bit of every coefficient that
+/// is already nonzero, and the coefficients that become nonzero at this
+/// bit (always +-1 << `al`).
+fn ac_refine(
+    bits: &mut BitReader, table: &HuffTable, blk: &mut [i16; 64],
+    ss: usize, se: usize, al: i32, eobrun: &mut u32,
+) -> bool {
+    let p1 = 1i16 << al;
+    let m1 = (-1i16).wrapping_shl(al as u32);
+    let mut k = ss;
+
+    if *eobrun == 0 {
+        while k <= se {
+            let rs = bits.decode_huff(table);
+            if rs < 0 {
+                return false;
+            }
+            let mut r = rs >> 4;
+            let mut s = 0i16;
+            if rs & 15 != 0 {
+                // New coefficient, magnitude 1 at this bit
+                s = if bits.read_bits(1) != 0 { p1 } else { m1 };
+            } else if r != 15 {
+                // End of band; the rest of this block is refined below
+                *eobrun = (1u32 << r) + bits.read_bits(r) as u32;
+                break;
+            }
+
+            // Skip `r` zero coefficients (refining the nonzero ones passed
+            // over) and place the new one on the zero after them.
+            while k <= se {
+                let coef = &mut blk[k];
+                if *coef != 0 {
+                    refine(bits, coef, p1, m1);
+                } else {
+                    if r == 0 {
+                        break;
+                    }
+                    r -= 1;
+                }
+                k += 1;
+            }
+            if s != 0 {
+                if k > se {
+                    return false;
+                }
+                blk[k] = s;
+            }
+            k += 1;
+        }
+    }
+
+    if *eobrun > 0 {
+        // Inside an end-of-band run only the nonzero coefficients get a bit.
+        while k <= se {
+            if blk[k] != 0 {
+                refine(bits, &mut blk[k], p1, m1);
+            }
+            k += 1;
+        }
+        *eobrun -= 1;
+    }
+    true
+}
+
+/// Apply a correction bit to a coefficient that is already nonzero: if set,
+/// its magnitude grows by `p1` (unless that bit is already there).
+#[inline]
+fn refine(bits: &mut BitReader, coef: &mut i16, p1: i16, m1: i16) {
+    if bits.read_bits(1) != 0 && *coef & p1 == 0 {
+        *coef = coef.wrapping_add(if *coef >= 0 { p1 } else { m1 });
+    }
+}
+
+/// Dequantize and inverse-transform every block into the planes, one
+/// block row per task.
+pub(crate) fn transform(frame: &FrameInfo, quant: &[[i32; 64]], coefs: &Coefs, planes: &Planes) {
+    let num_comp = frame.num_comp as usize;
+    let rows: usize = coefs.blocks_h[..num_comp].iter().sum();
+    workers::run(rows, &|t| {
+        let (mut c, mut by) = (0, t);
+        while by >= coefs.blocks_h[c] {
+            by -= coefs.blocks_h[c];
+            c += 1;
+        }
+        let qt = &quant[frame.comp[c].qt_id as usize];
+        let mut block = [0i32; 64];
+        for bx in 0..coefs.blocks_w[c] {
+            // SAFETY: tasks read disjoint block rows; no scan runs any more.
+            let coef = unsafe { coefs.block(c, bx, by) };
+            let mut has_ac = false;
+            for k in 0..64 {
+                let z = ZIGZAG[k] as usize;
+                block[z] = (coef[k] as i32).wrapping_mul(qt[z]);
+                has_ac |= k != 0 && coef[k] != 0;
+            }
+            store_block(planes, c, bx, by, &block, has_ac);
+        }
+    });
+}
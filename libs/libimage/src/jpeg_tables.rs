@@ -1,7 +1,7 @@
 // Copyright (c) 2024-2026 Christian Moeller
 // SPDX-License-Identifier: MIT
 
-//! Constant tables for the baseline JPEG decoder.
+//! Constant tables for the JPEG decoder.
 
 /// Zig-zag scan order: maps coefficient index 0..63 to the (row*8+col) position
 /// inside an 8x8 block.
@@ -65,6 +65,23 @@ pub const FIX_2_053: i32 = 16819;  // 2.053119869 * 2^13
 pub const FIX_2_562: i32 = 20995;  // 2.562915447 * 2^13
 pub const FIX_3_072: i32 = 25172;  // 3.072711026 * 2^13
 
+/// Reduced IDCT matrices in Q13 for decoding at 1/2 and 1/4 scale.
+///
+/// `IDCT_4X4[x][u] = round(c(u)/2 * cos((2x+1)*u*pi/8) * 2^13)` with
+/// c(0) = 1/sqrt(2), c(u) = 1 otherwise: the N-point inverse transform of
+/// the N lowest frequencies, keeping the 8-point normalization so the DC
+/// level is unchanged.  `IDCT_2X2` is the same for N = 2.
+pub const IDCT_4X4: [[i32; 4]; 4] = [
+    [2896,  3784,  2896,  1567],
+    [2896,  1567, -2896, -3784],
+    [2896, -1567, -2896,  3784],
+    [2896, -3784,  2896, -1567],
+];
+pub const IDCT_2X2: [[i32; 2]; 2] = [
+    [2896,  2896],
+    [2896, -2896],
+];
+
 /// Default luminance quantization table (JPEG Annex K, Table K.1).
 /// Used when the file omits a DQT marker (rare, but useful for reference).
 pub const DEFAULT_LUMA_QUANT: [u8; 64] = [
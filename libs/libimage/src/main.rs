@@ -10,17 +10,22 @@ pub mod types;
 pub mod exports;
 pub mod bmp;
 pub mod png;
-pub mod deflate;
 pub mod jpeg;
 pub mod jpeg_tables;
+pub mod jpeg_enc;
+mod jpeg_progressive;
 pub mod gif;
 pub mod ico;
 pub mod lzw;
 pub mod video;
 pub mod scale;
+mod resample;
 pub mod iconpack;
 pub mod svg_raster;
+mod thumbnail;
+mod simd;
 mod syscall;
+mod workers;
 libheap::dll_allocator!(crate::syscall::sbrk, crate::syscall::mmap, crate::syscall::munmap);
 
 /// Dummy entry point (never called — DLL has no entry).
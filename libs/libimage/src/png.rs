@@ -1,13 +1,27 @@
 // Copyright (c) 2024-2026 Christian Moeller
 // SPDX-License-Identifier: MIT
 
-//! PNG decoder (non-interlaced, 8-bit RGB/RGBA/Grayscale).
+//! PNG decoder (8-bit RGB/RGBA/Grayscale, non-interlaced and Adam7).
+//!
+//! Decoding streams one scanline at a time: the zlib stream is inflated
+//! straight out of the IDAT chunks into a row buffer, unfiltered against
+//! the previous row and converted into the output, so scratch holds only
+//! the 32 KiB DEFLATE window and two rows no matter how tall the image is.
+//!
+//! Sub, Avg and Paeth depend on the pixel to the left, so they run one
+//! pixel at a time with its channels side by side — Sub and Avg as packed
+//! bytes in a `u32`, Paeth in an [`I32x4`].  Up has no such dependency and
+//! runs over whole rows.
 
 use crate::types::*;
-use crate::deflate;
+use libinflate::Inflater;
+use crate::simd::I32x4;
 
 const PNG_SIG: [u8; 8] = [0x89, b'P', b'N', b'G', 0x0D, 0x0A, 0x1A, 0x0A];
 
+/// Scratch for the DEFLATE sliding window.
+const WINDOW_SIZE: usize = 32768;
+
 fn read_u32_be(data: &[u8], off: usize) -> u32 {
     u32::from_be_bytes([data[off], data[off + 1], data[off + 2], data[off + 3]])
 }
@@ -27,8 +41,25 @@ fn bpp(color_type: u8) -> usize {
     }
 }
 
-/// Probe a PNG file.
-pub fn probe(data: &[u8]) -> Option<ImageInfo> {
+/// Adam7 passes as (x0, y0, dx, dy).
+const ADAM7: [(usize, usize, usize, usize); 7] = [
+    (0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4),
+    (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2),
+];
+
+/// The single pass of a non-interlaced image.
+const NON_INTERLACED: [(usize, usize, usize, usize); 1] = [(0, 0, 1, 1)];
+
+/// Fields of IHDR the decoder uses.
+struct Header {
+    width: usize,
+    height: usize,
+    color_type: u8,
+    interlaced: bool,
+}
+
+/// Parse and validate the signature and IHDR chunk.
+fn parse_header(data: &[u8]) -> Option<Header> {
     if data.len() < 33 || data[0..8] != PNG_SIG {
         return None;
     }
@@ -43,6 +74,7 @@ pub fn probe(data: &[u8]) -> Option<ImageInfo> {
     let height = read_u32_be(data, 20);
     let bit_depth = data[24];
     let color_type = data[25];
+    let interlace = data[28];
 
     if width == 0 || height == 0 || width > 16384 || height > 16384 {
         return None;
@@ -50,314 +82,237 @@ pub fn probe(data: &[u8]) -> Option<ImageInfo> {
     if bit_depth != 8 {
         return None; // Only 8-bit supported
     }
-    let pixel_bytes = bpp(color_type);
-    if pixel_bytes == 0 {
+    if bpp(color_type) == 0 || interlace > 1 {
         return None;
     }
 
-    // Count total IDAT compressed data size (decode needs this in scratch)
-    let mut idat_total = 0usize;
-    let mut cpos = 8usize;
-    while cpos + 12 <= data.len() {
-        let clen = read_u32_be(data, cpos) as usize;
-        if &data[cpos + 4..cpos + 8] == b"IDAT" {
-            idat_total += clen;
-        }
-        cpos += 12 + clen;
-    }
+    Some(Header {
+        width: width as usize,
+        height: height as usize,
+        color_type,
+        interlaced: interlace == 1,
+    })
+}
 
-    // Scratch: 32K deflate window + decompressed scanlines + IDAT compressed data
-    let decompressed_size = (width as usize * pixel_bytes + 1) * height as usize;
-    let scratch = 32768 + decompressed_size + idat_total.max(1024);
+/// Scratch needed to decode an image `width` pixels wide: the DEFLATE
+/// window plus the previous and current scanline.
+fn scratch_size(width: usize, pixel_bytes: usize) -> usize {
+    WINDOW_SIZE + 2 * width * pixel_bytes
+}
 
+/// Probe a PNG file.
+pub fn probe(data: &[u8]) -> Option<ImageInfo> {
+    let hdr = parse_header(data)?;
     Some(ImageInfo {
-        width,
-        height,
+        width: hdr.width as u32,
+        height: hdr.height as u32,
         format: FMT_PNG,
-        scratch_needed: scratch as u32,
+        scratch_needed: scratch_size(hdr.width, bpp(hdr.color_type)) as u32,
     })
 }
 
-/// Decode PNG data into ARGB8888 pixels.
-pub fn decode(data: &[u8], out: &mut [u32], scratch: &mut [u8]) -> i32 {
-    if data.len() < 33 || data[0..8] != PNG_SIG {
-        return ERR_INVALID_DATA;
-    }
-
-    // Parse IHDR
-    let width = read_u32_be(data, 16) as usize;
-    let height = read_u32_be(data, 20) as usize;
-    let color_type = data[25];
-    let pixel_bytes = bpp(color_type);
-
-    if out.len() < width * height {
-        return ERR_BUFFER_TOO_SMALL;
-    }
-
-    // Collect all IDAT chunks
-    let mut idat_total = 0usize;
+/// Payload range of the first IDAT chunk.
+fn first_idat(data: &[u8]) -> Option<(usize, usize)> {
     let mut pos = 8;
-
-    // First pass: count IDAT data size
     while pos + 12 <= data.len() {
         let chunk_len = read_u32_be(data, pos) as usize;
-        let chunk_type = &data[pos + 4..pos + 8];
-        if chunk_type == b"IDAT" {
-            idat_total += chunk_len;
+        let start = pos + 8;
+        if &data[pos + 4..pos + 8] == b"IDAT" {
+            return Some((start, start.saturating_add(chunk_len).min(data.len())));
         }
-        pos += 12 + chunk_len; // length + type + data + crc
-    }
-
-    if idat_total == 0 {
-        return ERR_INVALID_DATA;
+        pos = start.saturating_add(chunk_len).saturating_add(4); // data + crc
     }
+    None
+}
 
-    // We need scratch for: deflate window (32K) + decompressed data + row buffer
-    let scanline_size = width * pixel_bytes + 1; // +1 for filter byte
-    let decompressed_size = scanline_size * height;
-    let needed = 32768 + decompressed_size + width * pixel_bytes;
-    if scratch.len() < needed {
-        return ERR_SCRATCH_TOO_SMALL;
+/// [`NextSegment`](libinflate::NextSegment) over the IDAT chunks: `end`
+/// is the end of the current chunk's payload and the next chunk follows its
+/// CRC.  IDAT chunks are consecutive, so the stream ends at any other chunk.
+fn next_idat(data: &[u8], end: usize) -> Option<(usize, usize)> {
+    let pos = end + 4;
+    if pos + 8 > data.len() || &data[pos + 4..pos + 8] != b"IDAT" {
+        return None;
     }
+    let start = pos + 8;
+    let chunk_len = read_u32_be(data, pos) as usize;
+    Some((start, start.saturating_add(chunk_len).min(data.len())))
+}
 
-    let decomp_area_start = 32768;
+/// Decode PNG data into ARGB8888 pixels.
+pub fn decode(data: &[u8], out: &mut [u32], scratch: &mut [u8]) -> i32 {
+    let hdr = match parse_header(data) {
+        Some(h) => h,
+        None => return if data.len() >= 8 && data[0..8] == PNG_SIG { ERR_UNSUPPORTED } else { ERR_INVALID_DATA },
+    };
+    let width = hdr.width;
+    let height = hdr.height;
+    let pixel_bytes = bpp(hdr.color_type);
 
-    // We need a temporary area for the compressed IDAT data
-    // Place it after the decompression output area
-    let idat_buf_start = decomp_area_start + decompressed_size;
-    if idat_buf_start + idat_total > scratch.len() {
+    if out.len() < width * height {
+        return ERR_BUFFER_TOO_SMALL;
+    }
+    if scratch.len() < scratch_size(width, pixel_bytes) {
         return ERR_SCRATCH_TOO_SMALL;
     }
 
-    // Second pass: copy IDAT data
-    pos = 8;
-    let mut idat_off = 0usize;
-    while pos + 12 <= data.len() {
-        let chunk_len = read_u32_be(data, pos) as usize;
-        let chunk_type = &data[pos + 4..pos + 8];
-        if chunk_type == b"IDAT" {
-            let src = &data[pos + 8..pos + 8 + chunk_len];
-            let dst = &mut scratch[idat_buf_start + idat_off..idat_buf_start + idat_off + chunk_len];
-            dst.copy_from_slice(src);
-            idat_off += chunk_len;
-        }
-        pos += 12 + chunk_len;
-    }
+    let (idat_start, idat_end) = match first_idat(data) {
+        Some(r) => r,
+        None => return ERR_INVALID_DATA,
+    };
 
-    let idat_data = &scratch[idat_buf_start..idat_buf_start + idat_total];
+    let row_bytes = width * pixel_bytes;
+    let (window, rows) = scratch.split_at_mut(WINDOW_SIZE);
+    let (mut prev, rest) = rows.split_at_mut(row_bytes);
+    let mut cur = &mut rest[..row_bytes];
 
-    // Strip zlib header (2 bytes: CMF + FLG)
-    if idat_data.len() < 6 {
-        return ERR_INVALID_DATA;
-    }
-    let cmf = idat_data[0];
-    if cmf & 0x0F != 8 {
-        return ERR_UNSUPPORTED; // Not deflate
-    }
-    // We can't use decomp_area as both input and output since input is in scratch.
-    // Instead, we need to decompress directly. Since idat_data borrows scratch immutably
-    // but we need mutable access, we must copy idat_data out. But we're in a DLL with no heap...
-    // Solution: deflate reads from the IDAT region which is past our output region.
-    // The output region is [decomp_area_start..decomp_area_start+decompressed_size]
-    // The input region is [idat_buf_start..idat_buf_start+idat_total]
-    // These don't overlap since idat_buf_start = decomp_area_start + decompressed_size.
-
-    // We need to split scratch into non-overlapping parts. Use unsafe pointer arithmetic.
-    let scratch_ptr = scratch.as_mut_ptr();
-    let window = unsafe { core::slice::from_raw_parts_mut(scratch_ptr, 32768) };
-    let decomp_out = unsafe {
-        core::slice::from_raw_parts_mut(scratch_ptr.add(decomp_area_start), decompressed_size)
+    let mut inflater = match Inflater::new(data, idat_start, idat_end, next_idat, window) {
+        Some(i) => i,
+        None => return ERR_SCRATCH_TOO_SMALL,
     };
-    let deflate_input = unsafe {
-        core::slice::from_raw_parts(scratch_ptr.add(idat_buf_start + 2) as *const u8,
-                                    idat_total.saturating_sub(2))
-    };
-
-    let decompressed_len = deflate::decompress(deflate_input, decomp_out, window);
-    if decompressed_len < 0 {
+    if !inflater.zlib_header() {
         return ERR_INVALID_DATA;
     }
-    let decompressed_len = decompressed_len as usize;
-    if decompressed_len < scanline_size * height {
-        return ERR_INVALID_DATA;
-    }
-
-    // Reconstruct filtered scanlines
-    let decomp = unsafe {
-        core::slice::from_raw_parts(scratch_ptr.add(decomp_area_start) as *const u8, decompressed_len)
-    };
-    reconstruct_and_convert(decomp, width, height, pixel_bytes, color_type, out)
-}
 
-/// Apply PNG filter reconstruction and convert to ARGB8888.
-/// Dispatches to a specialized routine per color type to avoid per-pixel
-/// match overhead on color_type and channel index.
-fn reconstruct_and_convert(
-    scanlines: &[u8],
-    width: usize,
-    height: usize,
-    pixel_bytes: usize,
-    color_type: u8,
-    out: &mut [u32],
-) -> i32 {
-    match color_type {
-        CT_RGB  => reconstruct_rgb(scanlines, width, height, out),
-        CT_RGBA => reconstruct_rgba(scanlines, width, height, out),
-        CT_GRAY => reconstruct_gray(scanlines, width, height, out),
-        _ => ERR_UNSUPPORTED,
-    }
-}
+    let passes: &[(usize, usize, usize, usize)] = if hdr.interlaced { &ADAM7 } else { &NON_INTERLACED };
+    for &(x0, y0, dx, dy) in passes {
+        if x0 >= width || y0 >= height {
+            continue; // empty pass: no scanlines, not even filter bytes
+        }
+        let pass_w = (width - x0 + dx - 1) / dx;
+        let n = pass_w * pixel_bytes;
+
+        // The row above the first row of a pass is all zeros
+        prev[..n].fill(0);
+        for y in (y0..height).step_by(dy) {
+            let mut filter = [0u8; 1];
+            if !inflater.read(&mut filter) || !inflater.read(&mut cur[..n]) {
+                return ERR_INVALID_DATA;
+            }
+            unfilter(filter[0], &mut cur[..n], &prev[..n], pixel_bytes);
 
-/// RGB reconstruction — inline channel extraction via shift+mask.
-fn reconstruct_rgb(scanlines: &[u8], width: usize, height: usize, out: &mut [u32]) -> i32 {
-    let row_bytes = width * 3;
-    let scanline_size = row_bytes + 1;
-
-    for y in 0..height {
-        let src_off = y * scanline_size;
-        let filter = scanlines[src_off];
-        let row_data = &scanlines[src_off + 1..src_off + 1 + row_bytes];
-
-        let mut prev_r: u8 = 0;
-        let mut prev_g: u8 = 0;
-        let mut prev_b: u8 = 0;
-
-        for x in 0..width {
-            let px_off = x * 3;
-            let raw_r = row_data[px_off];
-            let raw_g = row_data[px_off + 1];
-            let raw_b = row_data[px_off + 2];
-
-            let (above_r, above_g, above_b) = if y > 0 {
-                let p = out[(y - 1) * width + x];
-                (((p >> 16) & 0xFF) as u8, ((p >> 8) & 0xFF) as u8, (p & 0xFF) as u8)
+            let dst = &mut out[y * width..(y + 1) * width];
+            if dx == 1 {
+                convert_row(hdr.color_type, &cur[..n], dst);
             } else {
-                (0, 0, 0)
-            };
-
-            let (r, g, b) = match filter {
-                0 => (raw_r, raw_g, raw_b),
-                1 => (
-                    raw_r.wrapping_add(prev_r),
-                    raw_g.wrapping_add(prev_g),
-                    raw_b.wrapping_add(prev_b),
-                ),
-                2 => (
-                    raw_r.wrapping_add(above_r),
-                    raw_g.wrapping_add(above_g),
-                    raw_b.wrapping_add(above_b),
-                ),
-                3 => (
-                    raw_r.wrapping_add(((prev_r as u16 + above_r as u16) / 2) as u8),
-                    raw_g.wrapping_add(((prev_g as u16 + above_g as u16) / 2) as u8),
-                    raw_b.wrapping_add(((prev_b as u16 + above_b as u16) / 2) as u8),
-                ),
-                4 => {
-                    let (al_r, al_g, al_b) = if x > 0 && y > 0 {
-                        let p = out[(y - 1) * width + x - 1];
-                        (((p >> 16) & 0xFF) as u8, ((p >> 8) & 0xFF) as u8, (p & 0xFF) as u8)
-                    } else {
-                        (0, 0, 0)
-                    };
-                    (
-                        raw_r.wrapping_add(paeth(prev_r, above_r, al_r)),
-                        raw_g.wrapping_add(paeth(prev_g, above_g, al_g)),
-                        raw_b.wrapping_add(paeth(prev_b, above_b, al_b)),
-                    )
-                }
-                _ => (raw_r, raw_g, raw_b),
-            };
-
-            prev_r = r;
-            prev_g = g;
-            prev_b = b;
-            out[y * width + x] = 0xFF000000 | ((r as u32) << 16) | ((g as u32) << 8) | (b as u32);
+                convert_row_strided(hdr.color_type, &cur[..n], dst, x0, dx);
+            }
+            core::mem::swap(&mut prev, &mut cur);
         }
     }
     ERR_OK
 }
 
-/// RGBA reconstruction.
-fn reconstruct_rgba(scanlines: &[u8], width: usize, height: usize, out: &mut [u32]) -> i32 {
-    let row_bytes = width * 4;
-    let scanline_size = row_bytes + 1;
+// ── Unfiltering ─────────────────────────────────────────────────────────────
+
+/// Undo the scanline filter `filter` in place; `prev` is the unfiltered row
+/// above (zeros for the first row of a pass).  Unknown filter types are
+/// treated as None.
+fn unfilter(filter: u8, cur: &mut [u8], prev: &[u8], pixel_bytes: usize) {
+    match (filter, pixel_bytes) {
+        (1, 1) => unfilter_sub::<1>(cur),
+        (1, 3) => unfilter_sub::<3>(cur),
+        (1, _) => unfilter_sub::<4>(cur),
+        (2, _) => unfilter_up(cur, prev),
+        (3, 1) => unfilter_avg::<1>(cur, prev),
+        (3, 3) => unfilter_avg::<3>(cur, prev),
+        (3, _) => unfilter_avg::<4>(cur, prev),
+        (4, 1) => unfilter_paeth_gray(cur, prev),
+        (4, 3) => unfilter_paeth::<3>(cur, prev),
+        (4, _) => unfilter_paeth::<4>(cur, prev),
+        _ => {}
+    }
+}
+
+/// Low 7 bits of every byte; keeps carries from crossing into the next
+/// channel in the packed-byte arithmetic below.
+const LOW7: u32 = 0x7F7F_7F7F;
 
-    for y in 0..height {
-        let src_off = y * scanline_size;
-        let filter = scanlines[src_off];
-        let row_data = &scanlines[src_off + 1..src_off + 1 + row_bytes];
+/// Byte-wise wrapping add of packed channels.
+#[inline(always)]
+fn add_bytes(a: u32, b: u32) -> u32 {
+    ((a & LOW7) + (b & LOW7)) ^ ((a ^ b) & !LOW7)
+}
 
-        let mut prev: [u8; 4] = [0; 4];
+/// Byte-wise `(a + b) / 2` (rounded down) of packed channels.
+#[inline(always)]
+fn avg_bytes(a: u32, b: u32) -> u32 {
+    (a & b) + (((a ^ b) >> 1) & LOW7)
+}
 
-        for x in 0..width {
-            let px_off = x * 4;
-            let raw = [row_data[px_off], row_data[px_off + 1], row_data[px_off + 2], row_data[px_off + 3]];
+/// Load a `BPP`-byte pixel as packed channels.
+#[inline(always)]
+fn load_px<const BPP: usize>(row: &[u8], off: usize) -> u32 {
+    let mut px = [0u8; 4];
+    px[..BPP].copy_from_slice(&row[off..off + BPP]);
+    u32::from_le_bytes(px)
+}
 
-            let above = if y > 0 {
-                let p = out[(y - 1) * width + x];
-                [((p >> 16) & 0xFF) as u8, ((p >> 8) & 0xFF) as u8, (p & 0xFF) as u8, ((p >> 24) & 0xFF) as u8]
-            } else {
-                [0; 4]
-            };
-
-            let mut ch = [0u8; 4];
-            match filter {
-                0 => { ch = raw; }
-                1 => { for i in 0..4 { ch[i] = raw[i].wrapping_add(prev[i]); } }
-                2 => { for i in 0..4 { ch[i] = raw[i].wrapping_add(above[i]); } }
-                3 => { for i in 0..4 { ch[i] = raw[i].wrapping_add(((prev[i] as u16 + above[i] as u16) / 2) as u8); } }
-                4 => {
-                    let al = if x > 0 && y > 0 {
-                        let p = out[(y - 1) * width + x - 1];
-                        [((p >> 16) & 0xFF) as u8, ((p >> 8) & 0xFF) as u8, (p & 0xFF) as u8, ((p >> 24) & 0xFF) as u8]
-                    } else {
-                        [0; 4]
-                    };
-                    for i in 0..4 { ch[i] = raw[i].wrapping_add(paeth(prev[i], above[i], al[i])); }
-                }
-                _ => { ch = raw; }
-            }
+#[inline(always)]
+fn store_px<const BPP: usize>(row: &mut [u8], off: usize, v: u32) {
+    row[off..off + BPP].copy_from_slice(&v.to_le_bytes()[..BPP]);
+}
 
-            prev = ch;
-            out[y * width + x] = ((ch[3] as u32) << 24) | ((ch[0] as u32) << 16) | ((ch[1] as u32) << 8) | (ch[2] as u32);
-        }
+/// Sub: add the pixel to the left.
+fn unfilter_sub<const BPP: usize>(cur: &mut [u8]) {
+    let mut left = 0u32;
+    for off in (0..cur.len()).step_by(BPP) {
+        left = add_bytes(load_px::<BPP>(cur, off), left);
+        store_px::<BPP>(cur, off, left);
     }
-    ERR_OK
 }
 
-/// Grayscale reconstruction.
-fn reconstruct_gray(scanlines: &[u8], width: usize, height: usize, out: &mut [u32]) -> i32 {
-    let scanline_size = width + 1;
-
-    for y in 0..height {
-        let src_off = y * scanline_size;
-        let filter = scanlines[src_off];
-        let row_data = &scanlines[src_off + 1..src_off + 1 + width];
-
-        let mut prev_g: u8 = 0;
-
-        for x in 0..width {
-            let raw = row_data[x];
-            let above = if y > 0 { (out[(y - 1) * width + x] & 0xFF) as u8 } else { 0 };
-
-            let g = match filter {
-                0 => raw,
-                1 => raw.wrapping_add(prev_g),
-                2 => raw.wrapping_add(above),
-                3 => raw.wrapping_add(((prev_g as u16 + above as u16) / 2) as u8),
-                4 => {
-                    let al = if x > 0 && y > 0 { (out[(y - 1) * width + x - 1] & 0xFF) as u8 } else { 0 };
-                    raw.wrapping_add(paeth(prev_g, above, al))
-                }
-                _ => raw,
-            };
-
-            prev_g = g;
-            let g32 = g as u32;
-            out[y * width + x] = 0xFF000000 | (g32 << 16) | (g32 << 8) | g32;
-        }
+/// Up: add the pixel above.  No dependency between bytes, so this
+/// compiles to full-width vector adds.
+fn unfilter_up(cur: &mut [u8], prev: &[u8]) {
+    for (c, &p) in cur.iter_mut().zip(prev) {
+        *c = c.wrapping_add(p);
+    }
+}
+
+/// Avg: add the mean of the pixels to the left and above.
+fn unfilter_avg<const BPP: usize>(cur: &mut [u8], prev: &[u8]) {
+    let mut left = 0u32;
+    for off in (0..cur.len()).step_by(BPP) {
+        let up = load_px::<BPP>(prev, off);
+        left = add_bytes(load_px::<BPP>(cur, off), avg_bytes(left, up));
+        store_px::<BPP>(cur, off, left);
+    }
+}
+
+/// Paeth for multi-channel pixels: the predictor is evaluated for all
+/// channels of a pixel at once.  Only the left pixel `a` is carried from
+/// one pixel to the next, so it never leaves the vector register.
+fn unfilter_paeth<const BPP: usize>(cur: &mut [u8], prev: &[u8]) {
+    let low8 = I32x4::splat(0xFF);
+    let mut a = I32x4::splat(0); // left
+    let mut c = I32x4::splat(0); // above-left
+    for off in (0..cur.len()).step_by(BPP) {
+        let b = I32x4::from_u8(load_px::<BPP>(prev, off).to_le_bytes());
+        let raw = I32x4::from_u8(load_px::<BPP>(cur, off).to_le_bytes());
+        // With p = a + b - c: |p - a| = |b - c|, |p - b| = |a - c|,
+        // |p - c| = |(a - c) + (b - c)|
+        let bc = b.sub(c);
+        let ac = a.sub(c);
+        let pa = bc.abs();
+        let pb = ac.abs();
+        let pc = ac.add(bc).abs();
+        let min = pa.min(pb).min(pc);
+        let pred = I32x4::select(pa.eq(min), a, I32x4::select(pb.eq(min), b, c));
+        a = raw.add(pred).and(low8);
+        store_px::<BPP>(cur, off, u32::from_le_bytes(a.to_u8()));
+        c = b;
+    }
+}
+
+/// Paeth for grayscale, where a pixel is a single byte.
+fn unfilter_paeth_gray(cur: &mut [u8], prev: &[u8]) {
+    let mut a = 0u8;
+    let mut c = 0u8;
+    for (x, &b) in cur.iter_mut().zip(prev) {
+        *x = x.wrapping_add(paeth(a, b, c));
+        a = *x;
+        c = b;
     }
-    ERR_OK
 }
 
 /// Paeth predictor.
@@ -370,3 +325,56 @@ fn paeth(a: u8, b: u8, c: u8) -> u8 {
     else if pb <= pc { b }
     else { c }
 }
+
+// ── Pixel conversion ────────────────────────────────────────────────────────
+
+/// Convert one unfiltered scanline to ARGB8888.
+fn convert_row(color_type: u8, row: &[u8], dst: &mut [u32]) {
+    match color_type {
+        CT_RGBA => {
+            for (d, s) in dst.iter_mut().zip(row.chunks_exact(4)) {
+                *d = rgba_to_argb(s);
+            }
+        }
+        CT_RGB => {
+            for (d, s) in dst.iter_mut().zip(row.chunks_exact(3)) {
+                *d = 0xFF000000 | ((s[0] as u32) << 16) | ((s[1] as u32) << 8) | s[2] as u32;
+            }
+        }
+        _ => {
+            for (d, &g) in dst.iter_mut().zip(row) {
+                *d = 0xFF000000 | (g as u32 * 0x010101);
+            }
+        }
+    }
+}
+
+/// Convert one scanline of an Adam7 pass, whose pixels land every `dx`
+/// columns starting at `x0`.
+fn convert_row_strided(color_type: u8, row: &[u8], dst: &mut [u32], x0: usize, dx: usize) {
+    let dst = dst[x0..].iter_mut().step_by(dx);
+    match color_type {
+        CT_RGBA => {
+            for (d, s) in dst.zip(row.chunks_exact(4)) {
+                *d = rgba_to_argb(s);
+            }
+        }
+        CT_RGB => {
+            for (d, s) in dst.zip(row.chunks_exact(3)) {
+                *d = 0xFF000000 | ((s[0] as u32) << 16) | ((s[1] as u32) << 8) | s[2] as u32;
+            }
+        }
+        _ => {
+            for (d, &g) in dst.zip(row) {
+                *d = 0xFF000000 | (g as u32 * 0x010101);
+            }
+        }
+    }
+}
+
+/// RGBA bytes to ARGB8888: swap R and B of the little-endian word.
+#[inline(always)]
+fn rgba_to_argb(s: &[u8]) -> u32 {
+    let v = u32::from_le_bytes([s[0], s[1], s[2], s[3]]);
+    (v & 0xFF00FF00) | ((v >> 16) & 0xFF) | ((v & 0xFF) << 16)
+}
@@ -0,0 +1,246 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Separable resampling kernels behind [`crate::scale`].
+//!
+//! A resample is a vertical 1-D convolution of the source rows into one
+//! intermediate row, followed by a horizontal convolution of that row into
+//! the destination.  When an axis shrinks, the kernel is stretched by the
+//! scale factor, so every filter averages all source pixels it covers
+//! instead of aliasing.
+//!
+//! The taps of every destination row and column are computed once per call
+//! and quantized to Q14 weights that sum to exactly 1.0, so flat areas stay
+//! flat.  Pixels are convolved as [`I32x4`], one lane per ARGB channel:
+//! the vertical pass accumulates Q14 and keeps 6 fraction bits in the
+//! intermediate row, the horizontal pass accumulates Q20 and saturates to
+//! 8 bits.  Large outputs are split into bands of rows across the decode
+//! workers, each with its own intermediate row.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use crate::jpeg::SyncPtr;
+use crate::scale::{FILTER_BOX, FILTER_LANCZOS3};
+use crate::simd::I32x4;
+use crate::workers;
+
+/// Weight fraction bits.
+const W_BITS: u32 = 14;
+const W_ONE: i32 = 1 << W_BITS;
+/// Fraction bits dropped after the vertical pass (keeps 6 of the 14).
+const V_SHIFT: i32 = 8;
+/// Fraction bits of the horizontal accumulator.
+const H_SHIFT: i32 = 2 * W_BITS as i32 - V_SHIFT;
+
+/// Outputs with fewer pixels than this are resampled on the caller only.
+const PARALLEL_MIN_PIXELS: usize = 64 * 1024;
+
+/// A rectangle `(x, y, w, h)` in pixels.
+pub type Rect = (u32, u32, u32, u32);
+
+/// Per-axis convolution taps: destination index `i` reads `count[i]`
+/// source pixels starting at `start[i]`, with weights
+/// `weights[i * taps..][..count[i]]`.
+struct Taps {
+    start: Vec<u32>,
+    count: Vec<u32>,
+    taps: usize,
+    weights: Vec<i32>,
+}
+
+impl Taps {
+    /// Taps mapping `src_len` source pixels starting at `src_off` onto
+    /// `dst_len` destination pixels.
+    fn new(filter: u32, src_off: u32, src_len: u32, dst_len: u32) -> Taps {
+        let scale = src_len as f32 / dst_len as f32;
+        let stretch = if scale > 1.0 { scale } else { 1.0 };
+        let support = match filter {
+            FILTER_BOX => scale * 0.5,
+            FILTER_LANCZOS3 => 3.0 * stretch,
+            _ => stretch,
+        };
+        let taps = (support * 2.0) as usize + 3;
+
+        let mut start = Vec::with_capacity(dst_len as usize);
+        let mut count = Vec::with_capacity(dst_len as usize);
+        let mut weights = vec![0i32; dst_len as usize * taps];
+        let mut real = vec![0f32; taps];
+
+        for i in 0..dst_len as usize {
+            let center = (i as f32 + 0.5) * scale;
+            let lo = floor(center - support).max(0.0) as usize;
+            let hi = (ceil(center + support) as usize).min(src_len as usize).min(lo + taps);
+
+            let mut sum = 0.0;
+            for j in lo..hi {
+                let w = match filter {
+                    FILTER_BOX => {
+                        let a = (j as f32).max(center - support);
+                        let b = ((j + 1) as f32).min(center + support);
+                        (b - a).max(0.0)
+                    }
+                    FILTER_LANCZOS3 => lanczos3((j as f32 + 0.5 - center) / stretch),
+                    _ => triangle((j as f32 + 0.5 - center) / stretch),
+                };
+                real[j - lo] = w;
+                sum += w;
+            }
+            if sum <= 0.0 {
+                // Not reachable with these kernels; keep the nearest pixel
+                real[..hi - lo].fill(0.0);
+                real[(center as usize).clamp(lo, hi - 1) - lo] = 1.0;
+                sum = 1.0;
+            }
+
+            let row = &mut weights[i * taps..(i + 1) * taps];
+            let mut total = 0;
+            let mut peak = 0;
+            for k in 0..hi - lo {
+                let q = round(real[k] / sum * W_ONE as f32) as i32;
+                row[k] = q;
+                total += q;
+                if q > row[peak] {
+                    peak = k;
+                }
+            }
+            // Put the rounding error on the largest tap: weights sum to 1.0
+            row[peak] += W_ONE - total;
+
+            // Drop zero taps at either end
+            let first = row[..hi - lo].iter().position(|&w| w != 0).unwrap_or(peak);
+            let last = row[..hi - lo].iter().rposition(|&w| w != 0).unwrap_or(peak);
+            row.copy_within(first..=last, 0);
+            row[last - first + 1..].fill(0);
+            start.push(src_off + (lo + first) as u32);
+            count.push((last - first + 1) as u32);
+        }
+        Taps { start, count, taps, weights }
+    }
+
+    #[inline(always)]
+    fn get(&self, i: usize) -> (usize, &[i32]) {
+        let n = self.count[i] as usize;
+        (self.start[i] as usize, &self.weights[i * self.taps..i * self.taps + n])
+    }
+}
+
+/// Resample the `crop` rectangle of `src` (`src_w` pixels per row) into the
+/// `viewport` rectangle of `dst` (`dst_w` pixels per row).
+///
+/// `filter_x` / `filter_y` are `FILTER_*` constants for each axis (anything
+/// else is treated as bilinear); both rectangles must be non-empty and lie
+/// inside their images.
+pub fn resample(
+    src: &[u32], src_w: u32, crop: Rect,
+    dst: &mut [u32], dst_w: u32, viewport: Rect,
+    filter_x: u32, filter_y: u32,
+) {
+    let (cx, cy, cw, ch) = crop;
+    let (vx, vy, vw, vh) = viewport;
+    let taps_x = Taps::new(filter_x, cx, cw, vw);
+    let taps_y = Taps::new(filter_y, cy, ch, vh);
+
+    let (vw, vh) = (vw as usize, vh as usize);
+    let bands = if vw * vh >= PARALLEL_MIN_PIXELS { vh.min(workers::workers() + 1) } else { 1 };
+    let rows_per_band = (vh + bands - 1) / bands;
+    let mut tmp = vec![[0i32; 4]; bands * cw as usize];
+
+    let dst_base = SyncPtr(dst.as_mut_ptr());
+    let tmp_base = SyncPtr(tmp.as_mut_ptr());
+    let (src_stride, dst_stride) = (src_w as usize, dst_w as usize);
+    let (cx, cw) = (cx as usize, cw as usize);
+    let (vx, vy) = (vx as usize, vy as usize);
+    workers::run(bands, &|band| {
+        // SAFETY: each band has its own `cw` slots of `tmp` and writes its
+        // own destination rows; the caller checked `dst` holds the viewport.
+        let line = unsafe { core::slice::from_raw_parts_mut(tmp_base.get().add(band * cw), cw) };
+        let end = ((band + 1) * rows_per_band).min(vh);
+        for y in band * rows_per_band..end {
+            let (sy, wy) = taps_y.get(y);
+            vertical(src, src_stride, sy, wy, cx, line);
+            let out = unsafe {
+                core::slice::from_raw_parts_mut(dst_base.get().add((vy + y) * dst_stride + vx), vw)
+            };
+            horizontal(line, cx, &taps_x, out);
+        }
+    });
+}
+
+/// Convolve source rows `sy..sy + wy.len()`, columns `cx..cx + line.len()`,
+/// into `line`.
+fn vertical(src: &[u32], stride: usize, sy: usize, wy: &[i32], cx: usize, line: &mut [[i32; 4]]) {
+    let round = I32x4::splat(1 << (V_SHIFT - 1));
+    let rows = &src[sy * stride..];
+    for (x, l) in line.iter_mut().enumerate() {
+        let mut acc = round;
+        for (k, &w) in wy.iter().enumerate() {
+            let px = I32x4::from_u8(rows[k * stride + cx + x].to_le_bytes());
+            acc = acc.add(px.scale(w));
+        }
+        acc.sra::<V_SHIFT>().store(l);
+    }
+}
+
+/// Convolve the intermediate row `line` (source column `cx` first) into
+/// `out`.
+fn horizontal(line: &[[i32; 4]], cx: usize, taps: &Taps, out: &mut [u32]) {
+    let round = I32x4::splat(1 << (H_SHIFT - 1));
+    for (x, o) in out.iter_mut().enumerate() {
+        let (sx, wx) = taps.get(x);
+        let src = &line[sx - cx..sx - cx + wx.len()];
+        let mut acc = round;
+        for (px, &w) in src.iter().zip(wx) {
+            acc = acc.add(I32x4::load(px).scale(w));
+        }
+        let v = acc.sra::<H_SHIFT>();
+        *o = u32::from_le_bytes(I32x4::pack_u8(v, v)[..4].try_into().unwrap());
+    }
+}
+
+// ── Kernels ─────────────────────────────────────────────────────────────────
+
+fn triangle(x: f32) -> f32 {
+    let x = x.abs();
+    if x < 1.0 { 1.0 - x } else { 0.0 }
+}
+
+fn lanczos3(x: f32) -> f32 {
+    let x = x.abs();
+    if x < 1e-6 {
+        1.0
+    } else if x < 3.0 {
+        const PI2: f32 = core::f32::consts::PI * core::f32::consts::PI;
+        3.0 * sin_pi(x) * sin_pi(x / 3.0) / (PI2 * x * x)
+    } else {
+        0.0
+    }
+}
+
+/// `sin(pi * x)` for `x >= 0` (core has no libm).
+fn sin_pi(x: f32) -> f32 {
+    // Reduce to [0, 1) with the sign of each half period, then to [0, 0.5]
+    let n = x as u32;
+    let mut t = x - n as f32;
+    if t > 0.5 {
+        t = 1.0 - t;
+    }
+    // Taylor series of sin(pi t) on [0, pi/2], error below 4e-6
+    let a = core::f32::consts::PI * t;
+    let a2 = a * a;
+    let s = a * (1.0 - a2 / 6.0 * (1.0 - a2 / 20.0 * (1.0 - a2 / 42.0 * (1.0 - a2 / 72.0))));
+    if n & 1 == 1 { -s } else { s }
+}
+
+fn floor(x: f32) -> f32 {
+    let t = x as i32 as f32;
+    if t > x { t - 1.0 } else { t }
+}
+
+fn ceil(x: f32) -> f32 {
+    let t = x as i32 as f32;
+    if t < x { t + 1.0 } else { t }
+}
+
+fn round(x: f32) -> f32 {
+    floor(x + 0.5)
+}
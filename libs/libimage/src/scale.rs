@@ -1,9 +1,13 @@
 // Copyright (c) 2024-2026 Christian Moeller
 // SPDX-License-Identifier: MIT
 
-//! Bilinear image scaling with multiple fit modes.
+//! Image scaling with multiple fit modes and resampling filters.
 //!
-//! All arithmetic uses 16.16 fixed-point integers (no floating point).
+//! This module maps the fit modes onto a source crop and a destination
+//! viewport; [`crate::resample`] does the filtering.  Geometry uses 16.16
+//! fixed-point integers.
+
+use crate::resample::resample;
 
 /// Stretch source to fill destination, ignoring aspect ratio.
 pub const MODE_SCALE: u32 = 0;
@@ -15,11 +19,28 @@ pub const MODE_CONTAIN: u32 = 1;
 /// Fill destination maintaining aspect ratio; crop any excess.
 pub const MODE_COVER: u32 = 2;
 
+/// Area averaging on axes that shrink, bilinear on axes that grow.
+pub const FILTER_AUTO: u32 = 0;
+/// Area averaging: each source pixel is weighted by how much of it the
+/// destination pixel covers.
+pub const FILTER_BOX: u32 = 1;
+/// Triangle (tent) filter; plain bilinear interpolation when enlarging.
+pub const FILTER_BILINEAR: u32 = 2;
+/// Windowed sinc over 3 lobes; sharpest, with slight ringing at edges.
+pub const FILTER_LANCZOS3: u32 = 3;
+
+/// Largest `shift` accepted by the scaled decoders (1/8 size).
+pub const MAX_SCALE_SHIFT: u32 = 3;
+
+/// An image dimension decoded at 1/2^`shift` scale, rounded up.
+pub fn scaled_dim(v: u32, shift: u32) -> u32 {
+    (v + (1 << shift) - 1) >> shift
+}
+
 /// 16.16 fixed-point shift.
 const FP_SHIFT: u32 = 16;
-const FP_ONE: u32 = 1 << FP_SHIFT;
 
-/// Scale an image from `src` to `dst` using bilinear interpolation.
+/// Scale an image from `src` to `dst` with [`FILTER_AUTO`].
 ///
 /// - `src` / `src_w` / `src_h`: source ARGB8888 pixel buffer and dimensions.
 /// - `dst` / `dst_w` / `dst_h`: destination ARGB8888 pixel buffer and dimensions.
@@ -35,6 +56,24 @@ pub fn scale_image(
     dst_w: u32,
     dst_h: u32,
     mode: u32,
+) -> i32 {
+    scale_image_filtered(src, src_w, src_h, dst, dst_w, dst_h, mode, FILTER_AUTO)
+}
+
+/// Scale an image from `src` to `dst` with the resampling `filter`
+/// (one of the `FILTER_*` constants).
+///
+/// Returns 0 on success, -1 on error (null pointer, zero dimension, or
+/// invalid mode or filter).
+pub fn scale_image_filtered(
+    src: *const u32,
+    src_w: u32,
+    src_h: u32,
+    dst: *mut u32,
+    dst_w: u32,
+    dst_h: u32,
+    mode: u32,
+    filter: u32,
 ) -> i32 {
     if src.is_null() || dst.is_null() {
         return -1;
@@ -42,7 +81,7 @@ pub fn scale_image(
     if src_w == 0 || src_h == 0 || dst_w == 0 || dst_h == 0 {
         return -1;
     }
-    if mode > MODE_COVER {
+    if mode > MODE_COVER || filter > FILTER_LANCZOS3 {
         return -1;
     }
 
@@ -81,187 +120,23 @@ pub fn scale_image(
         return 0;
     }
 
-    let src_stride = src_w as usize;
-    let dst_stride = dst_w as usize;
-
-    // Choose algorithm: area averaging for downscaling, bilinear for upscaling.
-    let downscaling = crop_w > vp_w || crop_h > vp_h;
-
-    if downscaling {
-        // Area averaging (box filter): for each destination pixel, average ALL
-        // source pixels that map into its area. This prevents detail loss and
-        // aliasing that bilinear causes when shrinking.
-        //
-        // We use 8.24 fixed-point for sub-pixel source coordinate mapping.
-        const AA_SHIFT: u64 = 24;
-        const AA_ONE: u64 = 1 << AA_SHIFT;
-
-        let step_x_aa = ((crop_w as u64) << AA_SHIFT) / (vp_w as u64);
-        let step_y_aa = ((crop_h as u64) << AA_SHIFT) / (vp_h as u64);
-
-        for dy in 0..vp_h {
-            let dst_row = ((vp_y + dy) as usize) * dst_stride + (vp_x as usize);
-
-            // Source Y range for this destination row
-            let sy_start = (dy as u64) * step_y_aa + ((crop_y as u64) << AA_SHIFT);
-            let sy_end = sy_start + step_y_aa;
-
-            let sy0 = (sy_start >> AA_SHIFT) as usize;
-            let sy1_raw = ((sy_end + AA_ONE - 1) >> AA_SHIFT) as usize;
-            let sy1 = if sy1_raw > src_h as usize { src_h as usize } else { sy1_raw };
-
-            for dx in 0..vp_w {
-                // Source X range for this destination column
-                let sx_start = (dx as u64) * step_x_aa + ((crop_x as u64) << AA_SHIFT);
-                let sx_end = sx_start + step_x_aa;
-
-                let sx0 = (sx_start >> AA_SHIFT) as usize;
-                let sx1_raw = ((sx_end + AA_ONE - 1) >> AA_SHIFT) as usize;
-                let sx1 = if sx1_raw > src_w as usize { src_w as usize } else { sx1_raw };
-
-                // Accumulate weighted sum of all source pixels in the box.
-                // Weights account for partial pixel coverage at edges.
-                let mut sum_a: u64 = 0;
-                let mut sum_r: u64 = 0;
-                let mut sum_g: u64 = 0;
-                let mut sum_b: u64 = 0;
-                let mut weight_total: u64 = 0;
-
-                for sy in sy0..sy1 {
-                    // Vertical weight: how much of this source row is covered
-                    let wy = if sy1 - sy0 == 1 {
-                        AA_ONE
-                    } else if sy == sy0 {
-                        let frac = sy_start & (AA_ONE - 1);
-                        AA_ONE - frac
-                    } else if sy == sy1 - 1 {
-                        let frac = sy_end & (AA_ONE - 1);
-                        if frac == 0 { AA_ONE } else { frac }
-                    } else {
-                        AA_ONE
-                    };
-
-                    let row_off = sy * src_stride;
-
-                    for sx in sx0..sx1 {
-                        // Horizontal weight
-                        let wx = if sx1 - sx0 == 1 {
-                            AA_ONE
-                        } else if sx == sx0 {
-                            let frac = sx_start & (AA_ONE - 1);
-                            AA_ONE - frac
-                        } else if sx == sx1 - 1 {
-                            let frac = sx_end & (AA_ONE - 1);
-                            if frac == 0 { AA_ONE } else { frac }
-                        } else {
-                            AA_ONE
-                        };
-
-                        // Combined weight (reduce to 16-bit range to avoid overflow)
-                        let w = (wy >> 12) * (wx >> 12);
-                        let px = src_slice[row_off + sx];
-                        sum_a += ((px >> 24) & 0xFF) as u64 * w;
-                        sum_r += ((px >> 16) & 0xFF) as u64 * w;
-                        sum_g += ((px >> 8) & 0xFF) as u64 * w;
-                        sum_b += (px & 0xFF) as u64 * w;
-                        weight_total += w;
-                    }
-                }
-
-                let pixel = if weight_total == 0 {
-                    0
-                } else {
-                    let half = weight_total >> 1;
-                    let a = ((sum_a + half) / weight_total).min(255) as u32;
-                    let r = ((sum_r + half) / weight_total).min(255) as u32;
-                    let g = ((sum_g + half) / weight_total).min(255) as u32;
-                    let b = ((sum_b + half) / weight_total).min(255) as u32;
-                    (a << 24) | (r << 16) | (g << 8) | b
-                };
-
-                dst_slice[dst_row + dx as usize] = pixel;
-            }
-        }
-    } else {
-        // Bilinear interpolation: good for upscaling
-        let step_x = fp_div(crop_w << FP_SHIFT, vp_w << FP_SHIFT);
-        let step_y = fp_div(crop_h << FP_SHIFT, vp_h << FP_SHIFT);
-
-        let max_sx = ((src_w - 1) as u32) << FP_SHIFT;
-        let max_sy = ((src_h - 1) as u32) << FP_SHIFT;
-
-        let origin_x = (crop_x << FP_SHIFT) + (step_x >> 1);
-        let origin_y = (crop_y << FP_SHIFT) + (step_y >> 1);
-
-        let mut sy_fp = origin_y;
-        for dy in 0..vp_h {
-            let csy = clamp(sy_fp, max_sy);
-            let sy0 = (csy >> FP_SHIFT) as usize;
-            let sy1 = if sy0 + 1 < src_h as usize { sy0 + 1 } else { sy0 };
-            let fy = csy & (FP_ONE - 1);
-
-            let dst_row = ((vp_y + dy) as usize) * dst_stride + (vp_x as usize);
-
-            let mut sx_fp = origin_x;
-            for dx in 0..vp_w {
-                let csx = clamp(sx_fp, max_sx);
-                let sx0 = (csx >> FP_SHIFT) as usize;
-                let sx1 = if sx0 + 1 < src_w as usize { sx0 + 1 } else { sx0 };
-                let fx = csx & (FP_ONE - 1);
-
-                let c00 = src_slice[sy0 * src_stride + sx0];
-                let c10 = src_slice[sy0 * src_stride + sx1];
-                let c01 = src_slice[sy1 * src_stride + sx0];
-                let c11 = src_slice[sy1 * src_stride + sx1];
-
-                dst_slice[dst_row + dx as usize] = bilinear(c00, c10, c01, c11, fx, fy);
-
-                sx_fp = sx_fp.wrapping_add(step_x);
-            }
-            sy_fp = sy_fp.wrapping_add(step_y);
-        }
-    }
-
+    resample(
+        src_slice, src_w, (crop_x, crop_y, crop_w, crop_h),
+        dst_slice, dst_w, (vp_x, vp_y, vp_w, vp_h),
+        axis_filter(filter, crop_w, vp_w), axis_filter(filter, crop_h, vp_h),
+    );
     0
 }
 
 // ── Helpers ───────────────────────────────────────────────
 
-/// Clamp a 16.16 value to [0, max].
-#[inline(always)]
-fn clamp(v: u32, max: u32) -> u32 {
-    if v > max { max } else { v }
-}
-
-/// Bilinear blend of four ARGB8888 pixels.
-///
-/// `fx` and `fy` are the 16.16 fractional parts (0 .. FP_ONE-1).
-#[inline(always)]
-fn bilinear(c00: u32, c10: u32, c01: u32, c11: u32, fx: u32, fy: u32) -> u32 {
-    let inv_fx = FP_ONE - fx;
-    let inv_fy = FP_ONE - fy;
-
-    // Reduce to 8.8 before multiplying so the products fit in 32 bits.
-    let w00 = (inv_fx >> 8) * (inv_fy >> 8);
-    let w10 = (fx >> 8) * (inv_fy >> 8);
-    let w01 = (inv_fx >> 8) * (fy >> 8);
-    let w11 = (fx >> 8) * (fy >> 8);
-    let w_sum = w00 + w10 + w01 + w11;
-
-    if w_sum == 0 {
-        return c00;
+/// Resolve [`FILTER_AUTO`] for an axis scaled from `src` to `dst` pixels.
+fn axis_filter(filter: u32, src: u32, dst: u32) -> u32 {
+    match filter {
+        FILTER_AUTO if src > dst => FILTER_BOX,
+        FILTER_AUTO => FILTER_BILINEAR,
+        f => f,
     }
-
-    let blend = |shift: u32| -> u32 {
-        let v00 = (c00 >> shift) & 0xFF;
-        let v10 = (c10 >> shift) & 0xFF;
-        let v01 = (c01 >> shift) & 0xFF;
-        let v11 = (c11 >> shift) & 0xFF;
-        let sum = v00 * w00 + v10 * w10 + v01 * w01 + v11 * w11;
-        (sum + (w_sum >> 1)) / w_sum
-    };
-
-    (blend(24) << 24) | (blend(16) << 16) | (blend(8) << 8) | blend(0)
 }
 
 /// Fixed-point division: `a / b` (both 16.16) -> 16.16 result.
@@ -312,14 +187,14 @@ fn cover_crop(src_w: u32, src_h: u32, dst_w: u32, dst_h: u32) -> (u32, u32, u32,
         // Source is wider -- crop horizontally.
         // crop_h = src_h, crop_w = src_h * dst_w / dst_h
         let cw = ((src_h as u64) * (dst_w as u64) / (dst_h as u64)) as u32;
-        let cw = if cw > src_w { src_w } else { cw };
+        let cw = if cw > src_w { src_w } else { cw.max(1) };
         let cx = (src_w - cw) / 2;
         (cx, 0, cw, src_h)
     } else {
         // Source is taller (or exact match) -- crop vertically.
         // crop_w = src_w, crop_h = src_w * dst_h / dst_w
         let ch = ((src_w as u64) * (dst_h as u64) / (dst_w as u64)) as u32;
-        let ch = if ch > src_h { src_h } else { ch };
+        let ch = if ch > src_h { src_h } else { ch.max(1) };
         let cy = (src_h - ch) / 2;
         (0, cy, src_w, ch)
     }
@@ -375,7 +250,7 @@ pub fn find_content_bounds(
 ///
 /// This finds the bounding box of non-transparent content (alpha > 0),
 /// extracts that sub-rectangle, and scales it to exactly `dst_w x dst_h`
-/// using bilinear/area-average scaling (same quality as `scale_image`).
+/// with [`FILTER_AUTO`] (same quality as `scale_image`).
 ///
 /// Returns 0 on success, -1 on error, 1 if image is fully transparent.
 pub fn trim_and_scale(
@@ -409,141 +284,16 @@ pub fn trim_and_scale(
         return scale_image(src, src_w, src_h, dst, dst_w, dst_h, MODE_SCALE);
     }
 
-    // Scale from the content sub-rectangle directly using COVER-like logic:
-    // We set up a virtual source that is just the trimmed region.
-    // Reuse scale_image internals by pointing into the source at the crop offset.
-
+    // Resample the content rectangle straight out of the source.
     let src_slice =
         unsafe { core::slice::from_raw_parts(src, (src_w as usize) * (src_h as usize)) };
     let dst_slice =
         unsafe { core::slice::from_raw_parts_mut(dst, (dst_w as usize) * (dst_h as usize)) };
 
-    let src_stride = src_w as usize;
-    let dst_stride = dst_w as usize;
-
-    // Choose algorithm based on whether we're downscaling or upscaling
-    let downscaling = cw > dst_w || ch > dst_h;
-
-    if downscaling {
-        // Area averaging (box filter)
-        const AA_SHIFT: u64 = 24;
-        const AA_ONE: u64 = 1 << AA_SHIFT;
-
-        let step_x_aa = ((cw as u64) << AA_SHIFT) / (dst_w as u64);
-        let step_y_aa = ((ch as u64) << AA_SHIFT) / (dst_h as u64);
-
-        for dy in 0..dst_h {
-            let dst_row = (dy as usize) * dst_stride;
-
-            let sy_start = (dy as u64) * step_y_aa + ((cy as u64) << AA_SHIFT);
-            let sy_end = sy_start + step_y_aa;
-
-            let sy0 = (sy_start >> AA_SHIFT) as usize;
-            let sy1_raw = ((sy_end + AA_ONE - 1) >> AA_SHIFT) as usize;
-            let sy1 = if sy1_raw > src_h as usize { src_h as usize } else { sy1_raw };
-
-            for dx in 0..dst_w {
-                let sx_start = (dx as u64) * step_x_aa + ((cx as u64) << AA_SHIFT);
-                let sx_end = sx_start + step_x_aa;
-
-                let sx0 = (sx_start >> AA_SHIFT) as usize;
-                let sx1_raw = ((sx_end + AA_ONE - 1) >> AA_SHIFT) as usize;
-                let sx1 = if sx1_raw > src_w as usize { src_w as usize } else { sx1_raw };
-
-                let mut sum_a: u64 = 0;
-                let mut sum_r: u64 = 0;
-                let mut sum_g: u64 = 0;
-                let mut sum_b: u64 = 0;
-                let mut weight_total: u64 = 0;
-
-                for sy in sy0..sy1 {
-                    let wy = if sy1 - sy0 == 1 {
-                        AA_ONE
-                    } else if sy == sy0 {
-                        AA_ONE - (sy_start & (AA_ONE - 1))
-                    } else if sy == sy1 - 1 {
-                        let frac = sy_end & (AA_ONE - 1);
-                        if frac == 0 { AA_ONE } else { frac }
-                    } else {
-                        AA_ONE
-                    };
-
-                    let row_off = sy * src_stride;
-                    for sx in sx0..sx1 {
-                        let wx = if sx1 - sx0 == 1 {
-                            AA_ONE
-                        } else if sx == sx0 {
-                            AA_ONE - (sx_start & (AA_ONE - 1))
-                        } else if sx == sx1 - 1 {
-                            let frac = sx_end & (AA_ONE - 1);
-                            if frac == 0 { AA_ONE } else { frac }
-                        } else {
-                            AA_ONE
-                        };
-
-                        let w = (wy >> 12) * (wx >> 12);
-                        let px = src_slice[row_off + sx];
-                        sum_a += ((px >> 24) & 0xFF) as u64 * w;
-                        sum_r += ((px >> 16) & 0xFF) as u64 * w;
-                        sum_g += ((px >> 8) & 0xFF) as u64 * w;
-                        sum_b += (px & 0xFF) as u64 * w;
-                        weight_total += w;
-                    }
-                }
-
-                let pixel = if weight_total == 0 {
-                    0
-                } else {
-                    let half = weight_total >> 1;
-                    let a = ((sum_a + half) / weight_total).min(255) as u32;
-                    let r = ((sum_r + half) / weight_total).min(255) as u32;
-                    let g = ((sum_g + half) / weight_total).min(255) as u32;
-                    let b = ((sum_b + half) / weight_total).min(255) as u32;
-                    (a << 24) | (r << 16) | (g << 8) | b
-                };
-
-                dst_slice[dst_row + dx as usize] = pixel;
-            }
-        }
-    } else {
-        // Bilinear interpolation for upscaling
-        let step_x = fp_div(cw << FP_SHIFT, dst_w << FP_SHIFT);
-        let step_y = fp_div(ch << FP_SHIFT, dst_h << FP_SHIFT);
-
-        let max_sx = ((src_w - 1) as u32) << FP_SHIFT;
-        let max_sy = ((src_h - 1) as u32) << FP_SHIFT;
-
-        let origin_x = (cx << FP_SHIFT) + (step_x >> 1);
-        let origin_y = (cy << FP_SHIFT) + (step_y >> 1);
-
-        let mut sy_fp = origin_y;
-        for dy in 0..dst_h {
-            let csy = clamp(sy_fp, max_sy);
-            let sy0 = (csy >> FP_SHIFT) as usize;
-            let sy1 = if sy0 + 1 < src_h as usize { sy0 + 1 } else { sy0 };
-            let fy = csy & (FP_ONE - 1);
-
-            let dst_row = (dy as usize) * dst_stride;
-
-            let mut sx_fp = origin_x;
-            for dx in 0..dst_w {
-                let csx = clamp(sx_fp, max_sx);
-                let sx0 = (csx >> FP_SHIFT) as usize;
-                let sx1 = if sx0 + 1 < src_w as usize { sx0 + 1 } else { sx0 };
-                let fx = csx & (FP_ONE - 1);
-
-                let c00 = src_slice[sy0 * src_stride + sx0];
-                let c10 = src_slice[sy0 * src_stride + sx1];
-                let c01 = src_slice[sy1 * src_stride + sx0];
-                let c11 = src_slice[sy1 * src_stride + sx1];
-
-                dst_slice[dst_row + dx as usize] = bilinear(c00, c10, c01, c11, fx, fy);
-
-                sx_fp = sx_fp.wrapping_add(step_x);
-            }
-            sy_fp = sy_fp.wrapping_add(step_y);
-        }
-    }
-
+    resample(
+        src_slice, src_w, (cx, cy, cw, ch),
+        dst_slice, dst_w, (0, 0, dst_w, dst_h),
+        axis_filter(FILTER_AUTO, cw, dst_w), axis_filter(FILTER_AUTO, ch, dst_h),
+    );
     0
 }
@@ -0,0 +1,339 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Packed 4 × i32 integer vectors for the JPEG and PNG kernels.
+//!
+//! `I32x4` holds one 128-bit register: `__m128i` (SSE2) on x86_64,
+//! `int32x4_t` (NEON) on aarch64, and a `[i32; 4]` scalar fallback
+//! elsewhere.  Each backend lives in its own `arch` module implementing the
+//! same small set of primitives; the kernels are written once on top of
+//! them, so every backend produces bit-identical output.
+//!
+//! Arithmetic wraps on overflow in all backends.  x86_64 only assumes the
+//! SSE2 baseline; `mul`, `min` and `max` use the SSE4.1 instructions when
+//! the crate is built with that target feature and emulate them otherwise.
+
+// ── x86_64: SSE2 ────────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "x86_64")]
+mod arch {
+    use core::arch::x86_64::*;
+
+    pub type Repr = __m128i;
+
+    #[inline(always)] pub fn load(v: &[i32; 4]) -> Repr { unsafe { _mm_loadu_si128(v.as_ptr() as *const Repr) } }
+    #[inline(always)] pub fn store(a: Repr, v: &mut [i32; 4]) { unsafe { _mm_storeu_si128(v.as_mut_ptr() as *mut Repr, a) } }
+    #[inline(always)] pub fn splat(x: i32) -> Repr { unsafe { _mm_set1_epi32(x) } }
+    #[inline(always)] pub fn add(a: Repr, b: Repr) -> Repr { unsafe { _mm_add_epi32(a, b) } }
+    #[inline(always)] pub fn sub(a: Repr, b: Repr) -> Repr { unsafe { _mm_sub_epi32(a, b) } }
+    #[inline(always)] pub fn or(a: Repr, b: Repr) -> Repr { unsafe { _mm_or_si128(a, b) } }
+    #[inline(always)] pub fn and(a: Repr, b: Repr) -> Repr { unsafe { _mm_and_si128(a, b) } }
+    #[inline(always)] pub fn cmpeq(a: Repr, b: Repr) -> Repr { unsafe { _mm_cmpeq_epi32(a, b) } }
+    #[inline(always)] pub fn select(m: Repr, a: Repr, b: Repr) -> Repr { unsafe { _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)) } }
+    #[inline(always)] pub fn shl<const N: i32>(a: Repr) -> Repr { unsafe { _mm_slli_epi32::<N>(a) } }
+    #[inline(always)] pub fn sra<const N: i32>(a: Repr) -> Repr { unsafe { _mm_srai_epi32::<N>(a) } }
+
+    /// Low 32 bits of the lane products.
+    #[inline(always)]
+    pub fn mul(a: Repr, b: Repr) -> Repr {
+        #[cfg(target_feature = "sse4.1")]
+        unsafe { _mm_mullo_epi32(a, b) }
+        #[cfg(not(target_feature = "sse4.1"))]
+        unsafe {
+            let even = _mm_mul_epu32(a, b);
+            let odd = _mm_mul_epu32(_mm_srli_si128::<4>(a), _mm_srli_si128::<4>(b));
+            _mm_unpacklo_epi32(
+                _mm_shuffle_epi32::<0b00_00_10_00>(even),
+                _mm_shuffle_epi32::<0b00_00_10_00>(odd),
+            )
+        }
+    }
+
+    #[inline(always)]
+    pub fn min(a: Repr, b: Repr) -> Repr {
+        #[cfg(target_feature = "sse4.1")]
+        unsafe { _mm_min_epi32(a, b) }
+        #[cfg(not(target_feature = "sse4.1"))]
+        unsafe {
+            let m = _mm_cmpgt_epi32(a, b);
+            _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a))
+        }
+    }
+
+    #[inline(always)]
+    pub fn max(a: Repr, b: Repr) -> Repr {
+        #[cfg(target_feature = "sse4.1")]
+        unsafe { _mm_max_epi32(a, b) }
+        #[cfg(not(target_feature = "sse4.1"))]
+        unsafe {
+            let m = _mm_cmpgt_epi32(a, b);
+            _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+        }
+    }
+
+    #[inline(always)]
+    pub fn abs(a: Repr) -> Repr {
+        #[cfg(target_feature = "ssse3")]
+        unsafe { _mm_abs_epi32(a) }
+        #[cfg(not(target_feature = "ssse3"))]
+        unsafe {
+            let s = _mm_srai_epi32::<31>(a);
+            _mm_sub_epi32(_mm_xor_si128(a, s), s)
+        }
+    }
+
+    /// Zero-extend 4 bytes into the 4 lanes.
+    #[inline(always)]
+    pub fn from_u8(v: [u8; 4]) -> Repr {
+        unsafe {
+            let zero = _mm_setzero_si128();
+            let b = _mm_cvtsi32_si128(i32::from_le_bytes(v));
+            _mm_unpacklo_epi16(_mm_unpacklo_epi8(b, zero), zero)
+        }
+    }
+
+    /// Saturate the 8 lanes of `lo`, `hi` to 0..=255.
+    #[inline(always)]
+    pub fn pack_u8(lo: Repr, hi: Repr) -> [u8; 8] {
+        unsafe {
+            let w = _mm_packs_epi32(lo, hi);
+            let b = _mm_packus_epi16(w, w);
+            (_mm_cvtsi128_si64(b) as u64).to_le_bytes()
+        }
+    }
+
+    /// Transpose the 4×4 matrix whose rows are `r`.
+    #[inline(always)]
+    pub fn transpose(r: [Repr; 4]) -> [Repr; 4] {
+        unsafe {
+            let t0 = _mm_unpacklo_epi32(r[0], r[1]);
+            let t1 = _mm_unpacklo_epi32(r[2], r[3]);
+            let t2 = _mm_unpackhi_epi32(r[0], r[1]);
+            let t3 = _mm_unpackhi_epi32(r[2], r[3]);
+            [
+                _mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3),
+            ]
+        }
+    }
+}
+
+// ── aarch64: NEON ───────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "aarch64")]
+mod arch {
+    use core::arch::aarch64::*;
+
+    pub type Repr = int32x4_t;
+
+    #[inline(always)] pub fn load(v: &[i32; 4]) -> Repr { unsafe { vld1q_s32(v.as_ptr()) } }
+    #[inline(always)] pub fn store(a: Repr, v: &mut [i32; 4]) { unsafe { vst1q_s32(v.as_mut_ptr(), a) } }
+    #[inline(always)] pub fn splat(x: i32) -> Repr { unsafe { vdupq_n_s32(x) } }
+    #[inline(always)] pub fn add(a: Repr, b: Repr) -> Repr { unsafe { vaddq_s32(a, b) } }
+    #[inline(always)] pub fn sub(a: Repr, b: Repr) -> Repr { unsafe { vsubq_s32(a, b) } }
+    #[inline(always)] pub fn or(a: Repr, b: Repr) -> Repr { unsafe { vorrq_s32(a, b) } }
+    #[inline(always)] pub fn and(a: Repr, b: Repr) -> Repr { unsafe { vandq_s32(a, b) } }
+    #[inline(always)] pub fn cmpeq(a: Repr, b: Repr) -> Repr { unsafe { vreinterpretq_s32_u32(vceqq_s32(a, b)) } }
+    #[inline(always)] pub fn select(m: Repr, a: Repr, b: Repr) -> Repr { unsafe { vbslq_s32(vreinterpretq_u32_s32(m), a, b) } }
+    #[inline(always)] pub fn abs(a: Repr) -> Repr { unsafe { vabsq_s32(a) } }
+    #[inline(always)] pub fn shl<const N: i32>(a: Repr) -> Repr { unsafe { vshlq_n_s32::<N>(a) } }
+    #[inline(always)] pub fn sra<const N: i32>(a: Repr) -> Repr { unsafe { vshrq_n_s32::<N>(a) } }
+    #[inline(always)] pub fn mul(a: Repr, b: Repr) -> Repr { unsafe { vmulq_s32(a, b) } }
+    #[inline(always)] pub fn min(a: Repr, b: Repr) -> Repr { unsafe { vminq_s32(a, b) } }
+    #[inline(always)] pub fn max(a: Repr, b: Repr) -> Repr { unsafe { vmaxq_s32(a, b) } }
+
+    #[inline(always)]
+    pub fn from_u8(v: [u8; 4]) -> Repr {
+        let w = [v[0] as i32, v[1] as i32, v[2] as i32, v[3] as i32];
+        load(&w)
+    }
+
+    #[inline(always)]
+    pub fn pack_u8(lo: Repr, hi: Repr) -> [u8; 8] {
+        unsafe {
+            let w = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+            let mut out = [0u8; 8];
+            vst1_u8(out.as_mut_ptr(), vqmovun_s16(w));
+            out
+        }
+    }
+
+    #[inline(always)]
+    pub fn transpose(r: [Repr; 4]) -> [Repr; 4] {
+        unsafe {
+            let t01 = vtrnq_s32(r[0], r[1]);
+            let t23 = vtrnq_s32(r[2], r[3]);
+            [
+                vcombine_s32(vget_low_s32(t01.0), vget_low_s32(t23.0)),
+                vcombine_s32(vget_low_s32(t01.1), vget_low_s32(t23.1)),
+                vcombine_s32(vget_high_s32(t01.0), vget_high_s32(t23.0)),
+                vcombine_s32(vget_high_s32(t01.1), vget_high_s32(t23.1)),
+            ]
+        }
+    }
+}
+
+// ── Scalar fallback ─────────────────────────────────────────────────────────
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+mod arch {
+    pub type Repr = [i32; 4];
+
+    #[inline(always)]
+    fn map2(a: Repr, b: Repr, op: impl Fn(i32, i32) -> i32) -> Repr {
+        [op(a[0], b[0]), op(a[1], b[1]), op(a[2], b[2]), op(a[3], b[3])]
+    }
+
+    #[inline(always)] pub fn load(v: &[i32; 4]) -> Repr { *v }
+    #[inline(always)] pub fn store(a: Repr, v: &mut [i32; 4]) { *v = a; }
+    #[inline(always)] pub fn splat(x: i32) -> Repr { [x; 4] }
+    #[inline(always)] pub fn add(a: Repr, b: Repr) -> Repr { map2(a, b, i32::wrapping_add) }
+    #[inline(always)] pub fn sub(a: Repr, b: Repr) -> Repr { map2(a, b, i32::wrapping_sub) }
+    #[inline(always)] pub fn or(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| x | y) }
+    #[inline(always)] pub fn and(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| x & y) }
+    #[inline(always)] pub fn cmpeq(a: Repr, b: Repr) -> Repr { map2(a, b, |x, y| -((x == y) as i32)) }
+    #[inline(always)] pub fn select(m: Repr, a: Repr, b: Repr) -> Repr { map2(map2(m, a, |m, a| m & a), map2(m, b, |m, b| !m & b), |x, y| x | y) }
+    #[inline(always)] pub fn abs(a: Repr) -> Repr { a.map(i32::wrapping_abs) }
+    #[inline(always)] pub fn shl<const N: i32>(a: Repr) -> Repr { a.map(|x| x.wrapping_shl(N as u32)) }
+    #[inline(always)] pub fn sra<const N: i32>(a: Repr) -> Repr { a.map(|x| x >> N) }
+    #[inline(always)] pub fn mul(a: Repr, b: Repr) -> Repr { map2(a, b, i32::wrapping_mul) }
+    #[inline(always)] pub fn min(a: Repr, b: Repr) -> Repr { map2(a, b, i32::min) }
+    #[inline(always)] pub fn max(a: Repr, b: Repr) -> Repr { map2(a, b, i32::max) }
+    #[inline(always)] pub fn from_u8(v: [u8; 4]) -> Repr { v.map(|x| x as i32) }
+
+    #[inline(always)]
+    pub fn pack_u8(lo: Repr, hi: Repr) -> [u8; 8] {
+        let c = |x: i32| x.clamp(0, 255) as u8;
+        [c(lo[0]), c(lo[1]), c(lo[2]), c(lo[3]), c(hi[0]), c(hi[1]), c(hi[2]), c(hi[3])]
+    }
+
+    #[inline(always)]
+    pub fn transpose(r: [Repr; 4]) -> [Repr; 4] {
+        [0, 1, 2, 3].map(|c| [r[0][c], r[1][c], r[2][c], r[3][c]])
+    }
+}
+
+// ── I32x4 ───────────────────────────────────────────────────────────────────
+
+/// 4 × i32 in a SIMD register.
+#[derive(Copy, Clone)]
+pub struct I32x4(arch::Repr);
+
+impl I32x4 {
+    /// Load 4 lanes from memory.
+    #[inline(always)]
+    pub fn load(v: &[i32; 4]) -> Self {
+        Self(arch::load(v))
+    }
+
+    /// Store 4 lanes to memory.
+    #[inline(always)]
+    pub fn store(self, v: &mut [i32; 4]) {
+        arch::store(self.0, v)
+    }
+
+    /// Broadcast `x` to all 4 lanes.
+    #[inline(always)]
+    pub fn splat(x: i32) -> Self {
+        Self(arch::splat(x))
+    }
+
+    /// Zero-extend 4 bytes into the lanes.
+    #[inline(always)]
+    pub fn from_u8(v: [u8; 4]) -> Self {
+        Self(arch::from_u8(v))
+    }
+
+    #[inline(always)]
+    pub fn add(self, b: Self) -> Self {
+        Self(arch::add(self.0, b.0))
+    }
+
+    #[inline(always)]
+    pub fn sub(self, b: Self) -> Self {
+        Self(arch::sub(self.0, b.0))
+    }
+
+    /// Lane-wise product (low 32 bits).
+    #[inline(always)]
+    pub fn mul(self, b: Self) -> Self {
+        Self(arch::mul(self.0, b.0))
+    }
+
+    /// Multiply every lane by a constant.
+    #[inline(always)]
+    pub fn scale(self, k: i32) -> Self {
+        self.mul(Self::splat(k))
+    }
+
+    #[inline(always)]
+    pub fn or(self, b: Self) -> Self {
+        Self(arch::or(self.0, b.0))
+    }
+
+    #[inline(always)]
+    pub fn and(self, b: Self) -> Self {
+        Self(arch::and(self.0, b.0))
+    }
+
+    /// All-ones in the lanes where `self == b`, zero elsewhere.
+    #[inline(always)]
+    pub fn eq(self, b: Self) -> Self {
+        Self(arch::cmpeq(self.0, b.0))
+    }
+
+    /// Lanes of `a` where `mask` is all-ones, of `b` where it is zero.
+    #[inline(always)]
+    pub fn select(mask: Self, a: Self, b: Self) -> Self {
+        Self(arch::select(mask.0, a.0, b.0))
+    }
+
+    /// Lane-wise absolute value (wrapping for `i32::MIN`).
+    #[inline(always)]
+    pub fn abs(self) -> Self {
+        Self(arch::abs(self.0))
+    }
+
+    #[inline(always)]
+    pub fn min(self, b: Self) -> Self {
+        Self(arch::min(self.0, b.0))
+    }
+
+    /// Logical shift left by `N`.
+    #[inline(always)]
+    pub fn shl<const N: i32>(self) -> Self {
+        Self(arch::shl::<N>(self.0))
+    }
+
+    /// Arithmetic shift right by `N` (same as `>>` on i32).
+    #[inline(always)]
+    pub fn sra<const N: i32>(self) -> Self {
+        Self(arch::sra::<N>(self.0))
+    }
+
+    /// Clamp every lane to `lo..=hi`.
+    #[inline(always)]
+    pub fn clamp(self, lo: i32, hi: i32) -> Self {
+        Self(arch::min(arch::max(self.0, arch::splat(lo)), arch::splat(hi)))
+    }
+
+    /// Low byte of every lane (lanes must be in 0..=255).
+    #[inline(always)]
+    pub fn to_u8(self) -> [u8; 4] {
+        let b = arch::pack_u8(self.0, self.0);
+        [b[0], b[1], b[2], b[3]]
+    }
+
+    /// Saturate `lo` then `hi` to 8 bytes in 0..=255.
+    #[inline(always)]
+    pub fn pack_u8(lo: Self, hi: Self) -> [u8; 8] {
+        arch::pack_u8(lo.0, hi.0)
+    }
+
+    /// Transpose the 4×4 matrix whose rows are `r`.
+    #[inline(always)]
+    pub fn transpose(r: [Self; 4]) -> [Self; 4] {
+        let t = arch::transpose([r[0].0, r[1].0, r[2].0, r[3].0]);
+        [Self(t[0]), Self(t[1]), Self(t[2]), Self(t[3])]
+    }
+}
@@ -1,6 +1,8 @@
 //! Syscall wrappers for libimage.dlib — delegates to libsyscall.
 
 pub use libsyscall::{sbrk, mmap, munmap, exit, close};
+pub use libsyscall::{thread_create, futex_wait, futex_wake, cpu_count, FUTEX_FOREVER};
+pub use libsyscall::{stat, mkdir_bytes, O_WRITE, O_CREATE, O_TRUNC};
 
 /// Write bytes to a file descriptor.
 pub fn write(fd: u32, buf: &[u8]) {
@@ -21,3 +23,20 @@ pub fn read(fd: u32, buf: &mut [u8]) -> u32 {
 pub fn fstat(fd: u32, stat_buf: &mut [u32; 4]) -> u32 {
     libsyscall::fstat(fd, stat_buf)
 }
+
+/// Open a file with `O_*` flags. Returns fd or u32::MAX on error.
+pub fn open_flags(path: &str, flags: u32) -> u32 {
+    libsyscall::open(path, flags)
+}
+
+/// Write all of `buf` to `fd`. Returns false on error.
+pub fn write_all(fd: u32, mut buf: &[u8]) -> bool {
+    while !buf.is_empty() {
+        let n = libsyscall::write(fd, buf);
+        if n == 0 || n == u32::MAX {
+            return false;
+        }
+        buf = &buf[n as usize..];
+    }
+    true
+}
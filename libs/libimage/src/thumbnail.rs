@@ -0,0 +1,610 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Persistent thumbnail cache shared by all applications.
+//!
+//! Thumbnails are stored under [`CACHE_ROOT`], one directory per size in
+//! [`SIZES`], as `<size>/<hash of the path>.thm`.  Each file records the
+//! modification time and byte size of its source, so a thumbnail is only
+//! used while the source is unchanged (the freedesktop scheme: the key is
+//! path + mtime + size, and a changed file simply overwrites its entry).
+//!
+//! File layout (little-endian):
+//!
+//! | Offset | Size | Field                             |
+//! |--------|------|-----------------------------------|
+//! | 0      | 4    | magic `THM1`                      |
+//! | 4      | 2    | width                             |
+//! | 6      | 2    | height                            |
+//! | 8      | 4    | source mtime                      |
+//! | 12     | 4    | source size                       |
+//! | 16     | ...  | pixels, QOI chunk encoding        |
+//!
+//! The pixels use the chunk ops of the QOI format (runs, a 64-entry colour
+//! index and small deltas), which keeps a thumbnail at a fraction of its
+//! raw size while decoding cheaply enough for the UI thread.
+//!
+//! Missing thumbnails are generated by one background thread fed by a
+//! bounded queue; a full queue drops the request and the next lookup of the
+//! file asks again.  Files that fail to decode are remembered and not
+//! retried until they change.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use crate::syscall;
+use crate::types::*;
+
+/// Directory holding one subdirectory per thumbnail size.
+const CACHE_ROOT: &str = "/System/cache/thumbnails";
+/// Stored thumbnail sizes: each fits within `size` x `size`.
+const SIZES: [u32; 4] = [32, 64, 128, 256];
+
+const MAGIC: [u8; 4] = *b"THM1";
+const HEADER_LEN: usize = 16;
+
+/// Sources larger than this are not thumbnailed.
+const MAX_SOURCE_BYTES: u32 = 64 * 1024 * 1024;
+/// Pixel and scratch memory a single thumbnail decode may use.
+const MAX_DECODE_BYTES: u64 = 96 * 1024 * 1024;
+
+/// Pending generation requests.
+const QUEUE_LEN: usize = 32;
+const MAX_PATH: usize = 256;
+/// Recently failed sources (by path + mtime + size) not to retry.
+const FAILED_LEN: usize = 64;
+/// Stack size of the generator thread (decoders keep tables on the stack).
+const THREAD_STACK_SIZE: usize = 256 * 1024;
+
+// ── Lookup and store ────────────────────────────────────────────────────────
+
+/// Look up the thumbnail of `path` fitting within `size` x `size`.
+///
+/// The best stored size is scaled down to `size` when needed; thumbnails
+/// are never enlarged past the largest stored size or the source.  On a
+/// miss, `queue` asks the background thread to generate it.  Returns the
+/// dimensions written to `out`.
+pub fn lookup(path: &str, size: u32, queue: bool, out: &mut [u32]) -> Result<(u32, u32), i32> {
+    if size == 0 {
+        return Err(ERR_INVALID_DATA);
+    }
+    let (mtime, fsize) = source_stat(path).ok_or(ERR_INVALID_DATA)?;
+    let bucket = SIZES.iter().copied().find(|&s| s >= size).unwrap_or(SIZES[SIZES.len() - 1]);
+
+    let (pixels, w, h) = match read_thumb(path, bucket, mtime, fsize) {
+        Some(t) => t,
+        None => {
+            if queue {
+                request(path, source_key(path, mtime, fsize));
+            }
+            return Err(ERR_NOT_CACHED);
+        }
+    };
+    let (tw, th) = fit(w, h, size);
+    if out.len() < (tw as usize) * (th as usize) {
+        return Err(ERR_BUFFER_TOO_SMALL);
+    }
+    if (tw, th) == (w, h) {
+        out[..pixels.len()].copy_from_slice(&pixels);
+    } else {
+        crate::scale::scale_image_filtered(
+            pixels.as_ptr(), w, h,
+            out.as_mut_ptr(), tw, th,
+            crate::scale::MODE_SCALE, crate::scale::FILTER_AUTO,
+        );
+    }
+    Ok((tw, th))
+}
+
+/// Store thumbnails of `path` at every size from its decoded `pixels`.
+///
+/// For callers that decode the full image anyway (a viewer), so the
+/// background thread need not decode it again.
+pub fn store(path: &str, pixels: &[u32], w: u32, h: u32) -> i32 {
+    if w == 0 || h == 0 || pixels.len() < (w as usize) * (h as usize) {
+        return ERR_INVALID_DATA;
+    }
+    match source_stat(path) {
+        Some((mtime, fsize)) => store_all(path, mtime, fsize, pixels, w, h),
+        None => ERR_INVALID_DATA,
+    }
+}
+
+/// Counter bumped whenever the background thread has stored a thumbnail;
+/// clients poll it to know when to repeat lookups that missed.
+pub fn generation() -> u32 {
+    GENERATION.load(Ordering::Acquire)
+}
+
+/// Write all sizes, each scaled from the next larger one.
+fn store_all(path: &str, mtime: u32, fsize: u32, pixels: &[u32], w: u32, h: u32) -> i32 {
+    ensure_dirs();
+    let mut level: Vec<u32> = Vec::new();
+    let (mut lw, mut lh) = (w, h);
+    let mut ret = ERR_OK;
+    for &size in SIZES.iter().rev() {
+        let (tw, th) = fit(w, h, size);
+        if (tw, th) != (lw, lh) {
+            let src = if level.is_empty() { pixels } else { &level[..] };
+            let mut next = vec![0u32; (tw as usize) * (th as usize)];
+            crate::scale::scale_image_filtered(
+                src.as_ptr(), lw, lh,
+                next.as_mut_ptr(), tw, th,
+                crate::scale::MODE_SCALE, crate::scale::FILTER_AUTO,
+            );
+            level = next;
+            (lw, lh) = (tw, th);
+        }
+        let src = if level.is_empty() { &pixels[..(w as usize) * (h as usize)] } else { &level[..] };
+        if !write_thumb(path, size, mtime, fsize, src, lw, lh) {
+            ret = ERR_INVALID_DATA;
+        }
+    }
+    ret
+}
+
+/// Dimensions of a `w` x `h` image fitted within `size` x `size`.
+fn fit(w: u32, h: u32, size: u32) -> (u32, u32) {
+    if w <= size && h <= size {
+        return (w, h);
+    }
+    if w >= h {
+        (size, ((h as u64 * size as u64 + w as u64 / 2) / w as u64).max(1) as u32)
+    } else {
+        (((w as u64 * size as u64 + h as u64 / 2) / h as u64).max(1) as u32, size)
+    }
+}
+
+// ── Cache files ─────────────────────────────────────────────────────────────
+
+/// `(mtime, size)` of a regular file.
+fn source_stat(path: &str) -> Option<(u32, u32)> {
+    let mut st = [0u32; 7];
+    // stat: [type, size, flags, uid, gid, mode, mtime]; type 1 = directory
+    if syscall::stat(path, &mut st) != 0 || st[0] == 1 {
+        return None;
+    }
+    Some((st[6], st[1]))
+}
+
+/// FNV-1a over the path.
+fn path_hash(path: &str) -> u64 {
+    let mut h = 0xCBF2_9CE4_8422_2325u64;
+    for &b in path.as_bytes() {
+        h = (h ^ b as u64).wrapping_mul(0x0000_0100_0000_01B3);
+    }
+    h
+}
+
+/// Identity of one version of a source file.
+fn source_key(path: &str, mtime: u32, fsize: u32) -> u64 {
+    let h = path_hash(path) ^ ((mtime as u64) << 32 | fsize as u64);
+    h.wrapping_mul(0x9E37_79B9_7F4A_7C15)
+}
+
+/// `CACHE_ROOT/<size>/<16 hex digits>.thm`
+fn cache_path<'a>(path: &str, size: u32, buf: &'a mut [u8; 64]) -> &'a str {
+    let mut n = 0;
+    let mut put = |bytes: &[u8], n: &mut usize| {
+        buf[*n..*n + bytes.len()].copy_from_slice(bytes);
+        *n += bytes.len();
+    };
+    put(CACHE_ROOT.as_bytes(), &mut n);
+    put(b"/", &mut n);
+    let mut dec = [0u8; 10];
+    put(crate::fmt_u32(size, &mut dec), &mut n);
+    put(b"/", &mut n);
+    let h = path_hash(path);
+    let mut hex = [0u8; 16];
+    for (i, d) in hex.iter_mut().enumerate() {
+        let v = (h >> (60 - 4 * i)) as u8 & 0xF;
+        *d = if v < 10 { b'0' + v } else { b'a' + v - 10 };
+    }
+    put(&hex, &mut n);
+    put(b".thm", &mut n);
+    core::str::from_utf8(&buf[..n]).unwrap_or("")
+}
+
+static DIRS_READY: AtomicBool = AtomicBool::new(false);
+
+/// Create the cache directories once per process (existing ones are fine).
+fn ensure_dirs() {
+    if DIRS_READY.swap(true, Ordering::Relaxed) {
+        return;
+    }
+    syscall::mkdir_bytes(b"/System/cache");
+    syscall::mkdir_bytes(CACHE_ROOT.as_bytes());
+    for &size in &SIZES {
+        let mut buf = [0u8; 64];
+        let n = CACHE_ROOT.len();
+        buf[..n].copy_from_slice(CACHE_ROOT.as_bytes());
+        buf[n] = b'/';
+        let mut dec = [0u8; 10];
+        let d = crate::fmt_u32(size, &mut dec);
+        buf[n + 1..n + 1 + d.len()].copy_from_slice(d);
+        syscall::mkdir_bytes(&buf[..n + 1 + d.len()]);
+    }
+}
+
+/// Read and decode the stored thumbnail if it matches the source version.
+fn read_thumb(path: &str, size: u32, mtime: u32, fsize: u32) -> Option<(Vec<u32>, u32, u32)> {
+    let mut name = [0u8; 64];
+    let fd = syscall::open(cache_path(path, size, &mut name).as_bytes());
+    if fd == u32::MAX {
+        return None;
+    }
+    let mut header = [0u8; HEADER_LEN];
+    let ok = read_exact(fd, &mut header)
+        && header[0..4] == MAGIC
+        && u32_le(&header[8..]) == mtime
+        && u32_le(&header[12..]) == fsize;
+    let (w, h) = (u16_le(&header[4..]) as u32, u16_le(&header[6..]) as u32);
+    if !ok || w == 0 || h == 0 || w > size || h > size {
+        syscall::close(fd);
+        return None;
+    }
+    let mut stat = [0u32; 4];
+    let len = if syscall::fstat(fd, &mut stat) == 0 { stat[1] as usize } else { 0 };
+    let max = HEADER_LEN + (w * h) as usize * 5;
+    if len <= HEADER_LEN || len > max {
+        syscall::close(fd);
+        return None;
+    }
+    let mut data = vec![0u8; len - HEADER_LEN];
+    let ok = read_exact(fd, &mut data);
+    syscall::close(fd);
+
+    let mut pixels = vec![0u32; (w * h) as usize];
+    if ok && qoi_decode(&data, &mut pixels) { Some((pixels, w, h)) } else { None }
+}
+
+fn write_thumb(path: &str, size: u32, mtime: u32, fsize: u32, pixels: &[u32], w: u32, h: u32) -> bool {
+    let mut data = Vec::with_capacity(HEADER_LEN + pixels.len() * 2);
+    data.extend_from_slice(&MAGIC);
+    data.extend_from_slice(&(w as u16).to_le_bytes());
+    data.extend_from_slice(&(h as u16).to_le_bytes());
+    data.extend_from_slice(&mtime.to_le_bytes());
+    data.extend_from_slice(&fsize.to_le_bytes());
+    qoi_encode(pixels, &mut data);
+
+    let mut name = [0u8; 64];
+    let fd = syscall::open_flags(
+        cache_path(path, size, &mut name),
+        syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC,
+    );
+    if fd == u32::MAX {
+        return false;
+    }
+    let ok = syscall::write_all(fd, &data);
+    syscall::close(fd);
+    ok
+}
+
+fn read_exact(fd: u32, buf: &mut [u8]) -> bool {
+    let mut done = 0;
+    while done < buf.len() {
+        let n = syscall::read(fd, &mut buf[done..]);
+        if n == 0 || n == u32::MAX {
+            return false;
+        }
+        done += n as usize;
+    }
+    true
+}
+
+fn u16_le(b: &[u8]) -> u16 {
+    u16::from_le_bytes([b[0], b[1]])
+}
+
+fn u32_le(b: &[u8]) -> u32 {
+    u32::from_le_bytes([b[0], b[1], b[2], b[3]])
+}
+
+// ── QOI chunk coding ────────────────────────────────────────────────────────
+
+const OP_INDEX: u8 = 0x00;
+const OP_DIFF: u8 = 0x40;
+const OP_LUMA: u8 = 0x80;
+const OP_RUN: u8 = 0xC0;
+const OP_RGB: u8 = 0xFE;
+const OP_RGBA: u8 = 0xFF;
+const MAX_RUN: u8 = 62;
+
+#[inline]
+fn channels(px: u32) -> [u8; 4] {
+    // [r, g, b, a]
+    let [b, g, r, a] = px.to_le_bytes();
+    [r, g, b, a]
+}
+
+#[inline]
+fn argb(c: [u8; 4]) -> u32 {
+    u32::from_le_bytes([c[2], c[1], c[0], c[3]])
+}
+
+#[inline]
+fn index_of(px: u32) -> usize {
+    let [r, g, b, a] = channels(px);
+    (r as usize * 3 + g as usize * 5 + b as usize * 7 + a as usize * 11) % 64
+}
+
+fn qoi_encode(pixels: &[u32], out: &mut Vec<u8>) {
+    let mut index = [0u32; 64];
+    let mut prev = 0xFF00_0000u32;
+    let mut run = 0u8;
+    for &px in pixels {
+        if px == prev {
+            run += 1;
+            if run == MAX_RUN {
+                out.push(OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if run > 0 {
+            out.push(OP_RUN | (run - 1));
+            run = 0;
+        }
+        let slot = index_of(px);
+        if index[slot] == px {
+            out.push(OP_INDEX | slot as u8);
+        } else {
+            index[slot] = px;
+            let c = channels(px);
+            let p = channels(prev);
+            if c[3] == p[3] {
+                let dr = c[0].wrapping_sub(p[0]) as i8;
+                let dg = c[1].wrapping_sub(p[1]) as i8;
+                let db = c[2].wrapping_sub(p[2]) as i8;
+                let dr_dg = dr.wrapping_sub(dg);
+                let db_dg = db.wrapping_sub(dg);
+                if (-2..2).contains(&dr) && (-2..2).contains(&dg) && (-2..2).contains(&db) {
+                    out.push(OP_DIFF | ((dr + 2) as u8) << 4 | ((dg + 2) as u8) << 2 | (db + 2) as u8);
+                } else if (-32..32).contains(&dg) && (-8..8).contains(&dr_dg) && (-8..8).contains(&db_dg) {
+                    out.push(OP_LUMA | (dg + 32) as u8);
+                    out.push(((dr_dg + 8) as u8) << 4 | (db_dg + 8) as u8);
+                } else {
+                    out.extend_from_slice(&[OP_RGB, c[0], c[1], c[2]]);
+                }
+            } else {
+                out.extend_from_slice(&[OP_RGBA, c[0], c[1], c[2], c[3]]);
+            }
+        }
+        prev = px;
+    }
+    if run > 0 {
+        out.push(OP_RUN | (run - 1));
+    }
+}
+
+/// Decode exactly `out.len()` pixels; the data must end with the last one.
+fn qoi_decode(data: &[u8], out: &mut [u32]) -> bool {
+    let mut index = [0u32; 64];
+    let mut c = channels(0xFF00_0000);
+    let mut pos = 0;
+    let mut i = 0;
+    while i < out.len() {
+        let Some(&op) = data.get(pos) else { return false };
+        pos += 1;
+        if op == OP_RGB || op == OP_RGBA {
+            let n = if op == OP_RGB { 3 } else { 4 };
+            let Some(v) = data.get(pos..pos + n) else { return false };
+            c[..n].copy_from_slice(v);
+            pos += n;
+        } else {
+            match op & 0xC0 {
+                OP_INDEX => c = channels(index[op as usize & 63]),
+                OP_DIFF => {
+                    c[0] = c[0].wrapping_add((op >> 4 & 3).wrapping_sub(2));
+                    c[1] = c[1].wrapping_add((op >> 2 & 3).wrapping_sub(2));
+                    c[2] = c[2].wrapping_add((op & 3).wrapping_sub(2));
+                }
+                OP_LUMA => {
+                    let Some(&b) = data.get(pos) else { return false };
+                    pos += 1;
+                    let dg = (op & 63).wrapping_sub(32);
+                    c[0] = c[0].wrapping_add(dg.wrapping_sub(8).wrapping_add(b >> 4));
+                    c[1] = c[1].wrapping_add(dg);
+                    c[2] = c[2].wrapping_add(dg.wrapping_sub(8).wrapping_add(b & 15));
+                }
+                _ => {
+                    let run = (op & 63) as usize + 1;
+                    if i + run > out.len() {
+                        return false;
+                    }
+                    let px = argb(c);
+                    out[i..i + run].fill(px);
+                    index[index_of(px)] = px;
+                    i += run;
+                    continue;
+                }
+            }
+        }
+        let px = argb(c);
+        index[index_of(px)] = px;
+        out[i] = px;
+        i += 1;
+    }
+    pos == data.len()
+}
+
+// ── Background generation ───────────────────────────────────────────────────
+
+struct Queue {
+    paths: [[u8; MAX_PATH]; QUEUE_LEN],
+    lens: [u16; QUEUE_LEN],
+    head: usize,
+    count: usize,
+    failed: [u64; FAILED_LEN],
+    failed_next: usize,
+}
+
+/// Spinlock protecting `QUEUE` (held only to copy a path in or out).
+static QUEUE_LOCK: AtomicBool = AtomicBool::new(false);
+static mut QUEUE: Queue = Queue {
+    paths: [[0; MAX_PATH]; QUEUE_LEN],
+    lens: [0; QUEUE_LEN],
+    head: 0,
+    count: 0,
+    failed: [0; FAILED_LEN],
+    failed_next: 0,
+};
+
+/// Bumped on every push; the idle generator futex-waits on it.
+static SIGNAL: AtomicU32 = AtomicU32::new(0);
+static GENERATION: AtomicU32 = AtomicU32::new(0);
+
+const THREAD_NONE: u32 = 0;
+const THREAD_STARTING: u32 = 1;
+const THREAD_RUNNING: u32 = 2;
+static THREAD_STATE: AtomicU32 = AtomicU32::new(THREAD_NONE);
+
+fn with_queue<R>(f: impl FnOnce(&mut Queue) -> R) -> R {
+    while QUEUE_LOCK
+        .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+        .is_err()
+    {
+        core::hint::spin_loop();
+    }
+    let r = f(unsafe { &mut *core::ptr::addr_of_mut!(QUEUE) });
+    QUEUE_LOCK.store(false, Ordering::Release);
+    r
+}
+
+/// Queue `path` for generation unless it is queued, failed before or the
+/// queue is full.
+fn request(path: &str, key: u64) {
+    let bytes = path.as_bytes();
+    if bytes.len() > MAX_PATH {
+        return;
+    }
+    let queued = with_queue(|q| {
+        if q.failed.contains(&key) || q.count == QUEUE_LEN {
+            return false;
+        }
+        for k in 0..q.count {
+            let slot = (q.head + k) % QUEUE_LEN;
+            if &q.paths[slot][..q.lens[slot] as usize] == bytes {
+                return false;
+            }
+        }
+        let slot = (q.head + q.count) % QUEUE_LEN;
+        q.paths[slot][..bytes.len()].copy_from_slice(bytes);
+        q.lens[slot] = bytes.len() as u16;
+        q.count += 1;
+        true
+    });
+    if queued {
+        start_thread();
+        SIGNAL.fetch_add(1, Ordering::Release);
+        syscall::futex_wake(&SIGNAL, 1);
+    }
+}
+
+fn pop(out: &mut [u8; MAX_PATH]) -> Option<usize> {
+    with_queue(|q| {
+        if q.count == 0 {
+            return None;
+        }
+        let len = q.lens[q.head] as usize;
+        out[..len].copy_from_slice(&q.paths[q.head][..len]);
+        q.head = (q.head + 1) % QUEUE_LEN;
+        q.count -= 1;
+        Some(len)
+    })
+}
+
+fn start_thread() {
+    if THREAD_STATE
+        .compare_exchange(THREAD_NONE, THREAD_STARTING, Ordering::Acquire, Ordering::Relaxed)
+        .is_err()
+    {
+        return;
+    }
+    let stack = syscall::mmap(THREAD_STACK_SIZE as u32);
+    // x86_64 ABI: RSP must be STACK_TOP - 8 at function entry
+    if stack != u64::MAX
+        && syscall::thread_create(thread_main, stack as usize + THREAD_STACK_SIZE - 8, "img-thumb") != 0
+    {
+        THREAD_STATE.store(THREAD_RUNNING, Ordering::Release);
+    } else {
+        // Try again on the next request
+        THREAD_STATE.store(THREAD_NONE, Ordering::Release);
+    }
+}
+
+fn thread_main() {
+    let mut path = [0u8; MAX_PATH];
+    loop {
+        let signal = SIGNAL.load(Ordering::Acquire);
+        let Some(len) = pop(&mut path) else {
+            syscall::futex_wait(&SIGNAL, signal, syscall::FUTEX_FOREVER);
+            continue;
+        };
+        let Ok(path) = core::str::from_utf8(&path[..len]) else { continue };
+        let Some((mtime, fsize)) = source_stat(path) else { continue };
+        if generate(path, mtime, fsize) {
+            GENERATION.fetch_add(1, Ordering::Release);
+        } else {
+            let key = source_key(path, mtime, fsize);
+            with_queue(|q| {
+                q.failed[q.failed_next] = key;
+                q.failed_next = (q.failed_next + 1) % FAILED_LEN;
+            });
+        }
+    }
+}
+
+/// Decode `path` just large enough for the largest size and store all sizes.
+fn generate(path: &str, mtime: u32, fsize: u32) -> bool {
+    let largest = SIZES[SIZES.len() - 1];
+    // Another process may have made it since the lookup
+    if read_thumb(path, largest, mtime, fsize).is_some() {
+        return true;
+    }
+    if fsize < 8 || fsize > MAX_SOURCE_BYTES {
+        return false;
+    }
+    let fd = syscall::open(path.as_bytes());
+    if fd == u32::MAX {
+        return false;
+    }
+    let mut data = vec![0u8; fsize as usize];
+    let ok = read_exact(fd, &mut data);
+    syscall::close(fd);
+    if !ok {
+        return false;
+    }
+
+    let exports = &crate::exports::LIBIMAGE_EXPORTS;
+    let mut info = ImageInfo::zero();
+    if (exports.image_probe)(data.as_ptr(), fsize, &mut info) != ERR_OK {
+        return false;
+    }
+    // Largest decode-time downscale that still covers the thumbnail
+    let (tw, th) = fit(info.width, info.height, largest);
+    let mut shift = 0;
+    while shift < crate::scale::MAX_SCALE_SHIFT
+        && crate::scale::scaled_dim(info.width, shift + 1) >= tw
+        && crate::scale::scaled_dim(info.height, shift + 1) >= th
+    {
+        shift += 1;
+    }
+    if (exports.image_probe_scaled)(data.as_ptr(), fsize, shift, &mut info) != ERR_OK {
+        return false;
+    }
+    let count = (info.width as usize) * (info.height as usize);
+    if count as u64 * 4 + info.scratch_needed as u64 > MAX_DECODE_BYTES {
+        return false;
+    }
+    let mut pixels = vec![0u32; count];
+    let mut scratch = vec![0u8; info.scratch_needed as usize];
+    let ret = (exports.image_decode_scaled)(
+        data.as_ptr(), fsize, shift,
+        pixels.as_mut_ptr(), count as u32,
+        scratch.as_mut_ptr(), scratch.len() as u32,
+    );
+    drop(scratch);
+    drop(data);
+    ret == ERR_OK && store_all(path, mtime, fsize, &pixels, info.width, info.height) == ERR_OK
+}
@@ -17,6 +17,8 @@ pub const ERR_INVALID_DATA: i32 = -1;
 pub const ERR_UNSUPPORTED: i32 = -2;
 pub const ERR_BUFFER_TOO_SMALL: i32 = -3;
 pub const ERR_SCRATCH_TOO_SMALL: i32 = -4;
+/// No up-to-date thumbnail is cached for the file.
+pub const ERR_NOT_CACHED: i32 = -5;
 
 /// Image metadata returned by `image_probe`.
 #[repr(C)]
@@ -46,10 +48,14 @@ pub struct VideoInfo {
     pub fps: u32,
     pub num_frames: u32,
     pub scratch_needed: u32,
+    /// File offset of the PCM audio track (s16le stereo, 48 kHz).
+    pub audio_offset: u32,
+    /// Size of the audio track in bytes; 0 if the video is silent.
+    pub audio_size: u32,
 }
 
 impl VideoInfo {
     pub const fn zero() -> Self {
-        Self { width: 0, height: 0, fps: 0, num_frames: 0, scratch_needed: 0 }
+        Self { width: 0, height: 0, fps: 0, num_frames: 0, scratch_needed: 0, audio_offset: 0, audio_size: 0 }
     }
 }
@@ -4,7 +4,9 @@
 //! MJV (Motion JPEG Video) container parser.
 //!
 //! Format: 32-byte header + frame table + concatenated JPEG frames.
-//! Each frame is a standalone JPEG decoded via `crate::jpeg`.
+//! Each frame is a standalone JPEG decoded via `crate::jpeg`.  The last two
+//! header words, once reserved, locate an optional PCM audio track (s16le
+//! stereo, 48 kHz); files without one carry zeros there.
 
 use crate::types::*;
 
@@ -38,6 +40,8 @@ pub fn probe(data: &[u8]) -> Option<VideoInfo> {
     let height = read_u32_le(data, 12);
     let fps = read_u32_le(data, 16);
     let num_frames = read_u32_le(data, 20);
+    let mut audio_offset = read_u32_le(data, 24);
+    let mut audio_size = read_u32_le(data, 28) & !3;
 
     if width == 0 || height == 0 || fps == 0 || num_frames == 0 {
         return None;
@@ -49,6 +53,12 @@ pub fn probe(data: &[u8]) -> Option<VideoInfo> {
         return None;
     }
 
+    // An audio track that does not fit is ignored, not fatal
+    if audio_size == 0 || (audio_offset as usize).saturating_add(audio_size as usize) > data.len() {
+        audio_offset = 0;
+        audio_size = 0;
+    }
+
     // Probe first JPEG frame to determine scratch_needed
     let scratch_needed = if let Some(jpeg_data) = frame_data(data, num_frames, 0) {
         match crate::jpeg::probe(jpeg_data) {
@@ -65,6 +75,8 @@ pub fn probe(data: &[u8]) -> Option<VideoInfo> {
         fps,
         num_frames,
         scratch_needed,
+        audio_offset,
+        audio_size,
     })
 }
 
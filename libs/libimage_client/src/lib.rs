@@ -20,6 +20,15 @@ pub const MODE_CONTAIN: u32 = 1;
 /// Scale mode: fill destination, maintaining aspect ratio (cropped).
 pub const MODE_COVER: u32 = 2;
 
+/// Resampling filter: area averaging when shrinking, bilinear when enlarging.
+pub const FILTER_AUTO: u32 = 0;
+/// Resampling filter: area averaging (box).
+pub const FILTER_BOX: u32 = 1;
+/// Resampling filter: bilinear (triangle), widened when shrinking.
+pub const FILTER_BILINEAR: u32 = 2;
+/// Resampling filter: Lanczos-3; sharpest, slightly slower.
+pub const FILTER_LANCZOS3: u32 = 3;
+
 /// Error type for image/video operations.
 #[derive(Debug, Copy, Clone, PartialEq)]
 pub enum ImageError {
@@ -27,6 +36,8 @@ pub enum ImageError {
     Unsupported,
     BufferTooSmall,
     ScratchTooSmall,
+    /// No thumbnail of the file's current version is cached.
+    NotCached,
     Unknown(i32),
 }
 
@@ -36,6 +47,7 @@ fn err_from_code(code: i32) -> ImageError {
         -2 => ImageError::Unsupported,
         -3 => ImageError::BufferTooSmall,
         -4 => ImageError::ScratchTooSmall,
+        -5 => ImageError::NotCached,
         other => ImageError::Unknown(other),
     }
 }
@@ -85,6 +97,54 @@ pub fn decode(data: &[u8], pixels: &mut [u32], scratch: &mut [u8]) -> Result<(),
     }
 }
 
+/// Largest `shift` accepted by [`probe_scaled`] / [`decode_scaled`] (1/8 size).
+pub const MAX_SCALE_SHIFT: u32 = 3;
+
+/// Pick the largest downscale `shift` (at most [`MAX_SCALE_SHIFT`]) that
+/// keeps a `width` x `height` image at least `min_w` x `min_h` pixels.
+pub fn scale_shift_for(width: u32, height: u32, min_w: u32, min_h: u32) -> u32 {
+    let mut shift = 0;
+    while shift < MAX_SCALE_SHIFT
+        && (width >> (shift + 1)) >= min_w
+        && (height >> (shift + 1)) >= min_h
+    {
+        shift += 1;
+    }
+    shift
+}
+
+/// Probe an image for a decode at 1/2^`shift` of its size.
+///
+/// Returns the scaled dimensions (rounded up) and the scratch size
+/// [`decode_scaled`] needs.
+pub fn probe_scaled(data: &[u8], shift: u32) -> Option<ImageInfo> {
+    let mut info = ImageInfo {
+        width: 0,
+        height: 0,
+        format: FMT_UNKNOWN,
+        scratch_needed: 0,
+    };
+    let ret = (raw::exports().image_probe_scaled)(data.as_ptr(), data.len() as u32, shift, &mut info);
+    if ret == 0 { Some(info) } else { None }
+}
+
+/// Decode an image at 1/2^`shift` of its size (`shift` 0..=3).
+///
+/// JPEG is scaled while decoding (in the DCT domain), which makes
+/// thumbnails of large photos much cheaper than a full decode followed by
+/// [`scale_image`]; other formats are decoded at full size and scaled down.
+/// Buffer sizes come from [`probe_scaled`] with the same `shift`.
+pub fn decode_scaled(
+    data: &[u8], shift: u32, pixels: &mut [u32], scratch: &mut [u8],
+) -> Result<(), ImageError> {
+    let ret = (raw::exports().image_decode_scaled)(
+        data.as_ptr(), data.len() as u32, shift,
+        pixels.as_mut_ptr(), pixels.len() as u32,
+        scratch.as_mut_ptr(), scratch.len() as u32,
+    );
+    if ret == 0 { Ok(()) } else { Err(err_from_code(ret)) }
+}
+
 /// Probe an ICO file, selecting the best entry for a preferred display size.
 ///
 /// For example, `probe_ico_size(data, 48)` picks the closest entry to 48x48.
@@ -138,6 +198,39 @@ pub fn encode_bmp(pixels: &[u32], width: u32, height: u32, out: &mut [u8]) -> Re
     }
 }
 
+/// Encode an ARGB8888 region as a baseline JPEG (4:2:0, alpha ignored).
+///
+/// - `pixels`: source pixels, `stride` elements per row
+/// - `width`, `height`: region dimensions
+/// - `quality`: 1 (smallest) to 100 (best)
+/// - `out`: output buffer for the JPEG file bytes
+///
+/// Returns the number of bytes written on success, or
+/// `ImageError::BufferTooSmall` if `out` cannot hold the result.
+pub fn encode_jpeg(
+    pixels: &[u32], width: u32, height: u32, stride: u32, quality: u32, out: &mut [u8],
+) -> Result<usize, ImageError> {
+    if width == 0 || height == 0 || stride < width
+        || pixels.len() < (height as usize - 1) * stride as usize + width as usize
+    {
+        return Err(ImageError::InvalidData);
+    }
+    let ret = (raw::exports().jpeg_encode)(
+        pixels.as_ptr(),
+        width,
+        height,
+        stride,
+        quality,
+        out.as_mut_ptr(),
+        out.len() as u32,
+    );
+    if ret > 0 {
+        Ok(ret as usize)
+    } else {
+        Err(err_from_code(ret))
+    }
+}
+
 // ── Iconpack API ──────────────────────────────────────
 
 /// Render a system icon from an ico.pak file into ARGB8888 pixels.
@@ -178,6 +271,57 @@ pub fn iconpack_render_cached(
     if ret == 0 { Ok(()) } else { Err(err_from_code(ret)) }
 }
 
+// ── Thumbnail cache ────────────────────────────────
+
+/// Look up the cached thumbnail of the image file at `path`.
+///
+/// The thumbnail fits within `size` x `size` (keeping the aspect ratio, never
+/// enlarged) and is written to `pixels`, which needs `size * size` elements.
+/// Returns its dimensions.  Thumbnails are valid while the file's mtime and
+/// size are unchanged; on a miss, `ImageError::NotCached` is returned and
+/// the thumbnail is generated in the background. Poll
+/// [`thumbnail_generation`] to know when to look up again.
+pub fn thumbnail(path: &str, size: u32, pixels: &mut [u32]) -> Result<(u32, u32), ImageError> {
+    thumbnail_lookup(path, size, true, pixels)
+}
+
+/// Like [`thumbnail`], but only queues generation on a miss if `queue` is set.
+pub fn thumbnail_lookup(
+    path: &str, size: u32, queue: bool, pixels: &mut [u32],
+) -> Result<(u32, u32), ImageError> {
+    if (size as usize) * (size as usize) > pixels.len() {
+        return Err(ImageError::BufferTooSmall);
+    }
+    let mut info = ImageInfo { width: 0, height: 0, format: FMT_UNKNOWN, scratch_needed: 0 };
+    let ret = (raw::exports().thumbnail_lookup)(
+        path.as_ptr(), path.len() as u32,
+        size, queue as u32,
+        pixels.as_mut_ptr(), pixels.len() as u32,
+        &mut info,
+    );
+    if ret == 0 { Ok((info.width, info.height)) } else { Err(err_from_code(ret)) }
+}
+
+/// Store thumbnails for `path` from its full decoded image.
+///
+/// Viewers call this after decoding, so browsing the folder later needs no
+/// background decode.
+pub fn thumbnail_store(path: &str, pixels: &[u32], width: u32, height: u32) -> Result<(), ImageError> {
+    if (width as usize) * (height as usize) > pixels.len() {
+        return Err(ImageError::BufferTooSmall);
+    }
+    let ret = (raw::exports().thumbnail_store)(
+        path.as_ptr(), path.len() as u32,
+        pixels.as_ptr(), width, height,
+    );
+    if ret == 0 { Ok(()) } else { Err(err_from_code(ret)) }
+}
+
+/// Counter that increases whenever a background thumbnail is ready.
+pub fn thumbnail_generation() -> u32 {
+    (raw::exports().thumbnail_generation)()
+}
+
 /// Get the format name as a string.
 pub fn format_name(format: u32) -> &'static str {
     match format {
@@ -196,7 +340,7 @@ pub fn format_name(format: u32) -> &'static str {
 ///
 /// Returns `Some(VideoInfo)` on success, or `None` if the format is unrecognized.
 /// The `scratch_needed` field tells you how large a scratch buffer to allocate
-/// for `video_decode_frame()`.
+/// for `video_decode_frame()`; see [`video_audio`] for the audio track.
 pub fn video_probe(data: &[u8]) -> Option<VideoInfo> {
     let mut info = VideoInfo {
         width: 0,
@@ -204,6 +348,8 @@ pub fn video_probe(data: &[u8]) -> Option<VideoInfo> {
         fps: 0,
         num_frames: 0,
         scratch_needed: 0,
+        audio_offset: 0,
+        audio_size: 0,
     };
     let ret = (raw::exports().video_probe)(data.as_ptr(), data.len() as u32, &mut info);
     if ret == 0 {
@@ -213,6 +359,13 @@ pub fn video_probe(data: &[u8]) -> Option<VideoInfo> {
     }
 }
 
+/// The PCM audio track of a video (s16le stereo, 48 kHz, ready for
+/// `audio_write`), or an empty slice if it has none.
+pub fn video_audio<'a>(data: &'a [u8], info: &VideoInfo) -> &'a [u8] {
+    let start = info.audio_offset as usize;
+    data.get(start..start + info.audio_size as usize).unwrap_or(&[])
+}
+
 /// Decode a single video frame into ARGB8888 pixels.
 ///
 /// - `data`: the raw video file bytes (entire .mjv file)
@@ -246,7 +399,7 @@ pub fn video_decode_frame(
 
 // ── Scale API ──────────────────────────────────────
 
-/// Scale an ARGB8888 image using bilinear interpolation.
+/// Scale an ARGB8888 image with [`FILTER_AUTO`].
 ///
 /// - `src`: source pixel buffer (`src_w * src_h` elements)
 /// - `dst`: destination pixel buffer (`dst_w * dst_h` elements)
@@ -281,6 +434,40 @@ pub fn scale_image(
     ret == 0
 }
 
+/// Scale an ARGB8888 image with the resampling `filter` ([`FILTER_AUTO`],
+/// [`FILTER_BOX`], [`FILTER_BILINEAR`] or [`FILTER_LANCZOS3`]).
+///
+/// Same buffers and modes as [`scale_image`]. Returns `false` on error
+/// (e.g. wrong buffer size, invalid mode or filter).
+pub fn scale_image_filtered(
+    src: &[u32],
+    src_w: u32,
+    src_h: u32,
+    dst: &mut [u32],
+    dst_w: u32,
+    dst_h: u32,
+    mode: u32,
+    filter: u32,
+) -> bool {
+    if (src_w as usize) * (src_h as usize) > src.len() {
+        return false;
+    }
+    if (dst_w as usize) * (dst_h as usize) > dst.len() {
+        return false;
+    }
+    let ret = (raw::exports().scale_image_filtered)(
+        src.as_ptr(),
+        src_w,
+        src_h,
+        dst.as_mut_ptr(),
+        dst_w,
+        dst_h,
+        mode,
+        filter,
+    );
+    ret == 0
+}
+
 /// Trim transparent borders from an ARGB8888 image and scale the content
 /// to fill `dst_w x dst_h`.
 ///
@@ -25,6 +25,10 @@ pub struct VideoInfo {
     pub fps: u32,
     pub num_frames: u32,
     pub scratch_needed: u32,
+    /// File offset of the PCM audio track (s16le stereo, 48 kHz).
+    pub audio_offset: u32,
+    /// Size of the audio track in bytes; 0 if the video is silent.
+    pub audio_size: u32,
 }
 
 /// Format constants.
@@ -64,6 +68,13 @@ pub struct LibimageExports {
     pub iconpack_render: extern "C" fn(*const u8, u32, *const u8, u32, u32, u32, u32, *mut u32) -> i32,
     pub iconpack_render_cached: extern "C" fn(*const u8, u32, u32, u32, u32, *mut u32) -> i32,
     pub trim_and_scale: extern "C" fn(*const u32, u32, u32, *mut u32, u32, u32) -> i32,
+    pub image_probe_scaled: extern "C" fn(*const u8, u32, u32, *mut ImageInfo) -> i32,
+    pub image_decode_scaled: extern "C" fn(*const u8, u32, u32, *mut u32, u32, *mut u8, u32) -> i32,
+    pub scale_image_filtered: extern "C" fn(*const u32, u32, u32, *mut u32, u32, u32, u32, u32) -> i32,
+    pub thumbnail_lookup: extern "C" fn(*const u8, u32, u32, u32, *mut u32, u32, *mut ImageInfo) -> i32,
+    pub thumbnail_store: extern "C" fn(*const u8, u32, *const u32, u32, u32) -> i32,
+    pub thumbnail_generation: extern "C" fn() -> u32,
+    pub jpeg_encode: extern "C" fn(*const u32, u32, u32, u32, u32, *mut u8, u32) -> i32,
 }
 
 /// Get a reference to the DLL export table at the fixed load address.
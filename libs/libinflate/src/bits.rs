@@ -0,0 +1,195 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! LSB-first bit reader with a 64-bit buffer.
+//!
+//! A refill tops the buffer up to at least 56 bits with one unaligned
+//! 8-byte load, which covers a whole length/distance pair (at most 48
+//! bits), so the decode loops refill once per symbol.  Past the end of the
+//! input, zero bytes are fed in and counted; the decoders fail if any of
+//! them is consumed.
+
+/// Locates the next input segment once the current one ends.
+///
+/// Called with the whole input and the end of the current segment; returns
+/// the `(start, end)` of the next segment, or `None` at the end of input.
+/// This lets a stream continue across container chunks (PNG IDAT) without
+/// gathering them into one buffer first.
+pub type NextSegment = fn(&[u8], usize) -> Option<(usize, usize)>;
+
+/// [`NextSegment`] for contiguous input.
+pub(crate) fn single_segment(_: &[u8], _: usize) -> Option<(usize, usize)> {
+    None
+}
+
+/// Reader state carried from one input chunk to the next.
+#[derive(Copy, Clone, Default)]
+pub(crate) struct Carry {
+    buf: u64,
+    count: u32,
+    overrun: u32,
+}
+
+#[derive(Copy, Clone)]
+pub(crate) struct Bits<'a> {
+    data: &'a [u8],
+    pos: usize,
+    /// End of the current segment.
+    end: usize,
+    next: NextSegment,
+    pub buf: u64,
+    /// Valid bits in `buf`.
+    pub count: u32,
+    /// Zero bytes fed in after the input ran out.
+    overrun: u32,
+}
+
+impl<'a> Bits<'a> {
+    pub fn new(data: &'a [u8], start: usize, end: usize, next: NextSegment) -> Self {
+        let end = end.min(data.len());
+        Self { data, pos: start.min(end), end, next, buf: 0, count: 0, overrun: 0 }
+    }
+
+    /// Continue on contiguous `data` where an earlier reader left off.
+    pub fn resume(data: &'a [u8], carry: Carry) -> Self {
+        let Carry { buf, count, overrun } = carry;
+        Self { data, pos: 0, end: data.len(), next: single_segment, buf, count, overrun }
+    }
+
+    /// State to [`resume`](Self::resume) from once this input is used up.
+    pub fn carry(&self) -> Carry {
+        Carry { buf: self.buf, count: self.count, overrun: self.overrun }
+    }
+
+    /// Bytes of the current segment loaded into the buffer so far.
+    #[inline(always)]
+    pub fn position(&self) -> usize {
+        self.pos
+    }
+
+    /// Bytes of the current segment not loaded yet.
+    pub fn remaining(&self) -> usize {
+        self.end - self.pos
+    }
+
+    /// Whole input bytes still in the buffer, not counting padding.
+    pub fn buffered(&self) -> usize {
+        (self.count / 8).saturating_sub(self.overrun) as usize
+    }
+
+    /// Move to the next non-empty segment.  Returns false at end of input.
+    fn next_segment(&mut self) -> bool {
+        while self.pos == self.end {
+            match (self.next)(self.data, self.end) {
+                Some((start, end)) if start <= end && end <= self.data.len() => {
+                    self.pos = start;
+                    self.end = end;
+                }
+                _ => return false,
+            }
+        }
+        true
+    }
+
+    /// Top the buffer up to at least 56 bits.
+    #[inline(always)]
+    pub fn refill(&mut self) {
+        if self.end - self.pos >= 8 {
+            let word = u64::from_le_bytes(self.data[self.pos..self.pos + 8].try_into().unwrap());
+            self.buf |= word << self.count;
+            self.pos += ((63 - self.count) >> 3) as usize;
+            self.count |= 56;
+        } else {
+            self.refill_slow();
+        }
+    }
+
+    /// Refill near the end of a segment, moving on to the next one.
+    #[inline(never)]
+    fn refill_slow(&mut self) {
+        while self.count < 56 {
+            let byte = if self.pos < self.end || self.next_segment() {
+                self.pos += 1;
+                self.data[self.pos - 1]
+            } else {
+                self.overrun += 1;
+                0
+            };
+            self.buf |= (byte as u64) << self.count;
+            self.count += 8;
+        }
+    }
+
+    /// Drop `n` bits (at most `count`).
+    #[inline(always)]
+    pub fn consume(&mut self, n: u32) {
+        self.buf >>= n;
+        self.count -= n;
+    }
+
+    /// Consume and return `n` bits that are already buffered.
+    #[inline(always)]
+    pub fn take(&mut self, n: u32) -> usize {
+        let v = (self.buf & ((1u64 << n) - 1)) as usize;
+        self.consume(n);
+        v
+    }
+
+    /// Read `n` (at most 32) bits.
+    #[inline(always)]
+    pub fn read(&mut self, n: u32) -> u32 {
+        if self.count < n {
+            self.refill();
+        }
+        let v = (self.buf & ((1u64 << n) - 1)) as u32;
+        self.consume(n);
+        v
+    }
+
+    /// True once so much padding was fed in that some of it must have been
+    /// consumed: a decoder is running off the end of the input.  Cheap
+    /// enough to check per symbol; [`in_bounds`](Self::in_bounds) is exact.
+    #[inline(always)]
+    pub fn overrun(&self) -> bool {
+        self.overrun > 16
+    }
+
+    /// True if every consumed bit came from the input.
+    pub fn in_bounds(&self) -> bool {
+        self.overrun * 8 <= self.count
+    }
+
+    /// Drop bits up to the next byte boundary.
+    pub fn align(&mut self) {
+        self.consume(self.count % 8);
+    }
+
+    /// Copy whole bytes (after [`align`](Self::align)) into `out`, first from
+    /// the bit buffer, then straight from the input segments.
+    pub fn read_bytes(&mut self, out: &mut [u8]) -> bool {
+        let from_buf = out.len().min(self.buffered());
+        for b in &mut out[..from_buf] {
+            *b = self.buf as u8;
+            self.consume(8);
+        }
+        let mut i = from_buf;
+        if i < out.len() {
+            if self.overrun > 0 {
+                return false;
+            }
+            // The buffer holds no input bytes any more
+            self.buf = 0;
+            self.count = 0;
+        }
+        while i < out.len() {
+            if self.pos == self.end && !self.next_segment() {
+                return false;
+            }
+            let n = (out.len() - i).min(self.end - self.pos);
+            out[i..i + n].copy_from_slice(&self.data[self.pos..self.pos + n]);
+            self.pos += n;
+            i += n;
+        }
+        true
+    }
+}
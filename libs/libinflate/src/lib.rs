@@ -0,0 +1,357 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! libinflate — DEFLATE decompression (RFC 1951) for anyOS.
+//!
+//! The one inflate core linked by libzip (ZIP, gzip, tar.gz), libhttp
+//! (`Content-Encoding`), libimage (PNG) and libfont (PNG glyphs).
+//!
+//! - [`inflate`] / [`inflate_sized`] decode a whole stream into a `Vec`,
+//!   which doubles as the history window.  With the output size known up
+//!   front (ZIP entries, gzip `ISIZE`, PNG) the buffer is allocated once.
+//! - [`Inflater`] decodes incrementally into caller-sized pieces from input
+//!   split over several segments, keeping only a 32 KiB window resident.
+//! - [`InflateStream`] takes input in chunks as well, for streams that
+//!   never sit in memory whole.
+//!
+//! Both read input through a 64-bit bit buffer refilled with one unaligned
+//! load per symbol and decode with two-level lookup tables that resolve
+//! most codes — including pairs of short literal codes — in one load.
+//! Matches are copied 8 bytes at a time.
+
+#![no_std]
+
+extern crate alloc;
+
+mod bits;
+mod stream;
+mod table;
+
+use alloc::vec::Vec;
+use bits::Bits;
+use table::*;
+
+pub use bits::NextSegment;
+pub use stream::{InflateStream, Inflater};
+
+/// History window of a DEFLATE stream.
+pub const WINDOW_SIZE: usize = 32768;
+
+/// Longest match, and so the most output one symbol can produce.
+const MAX_MATCH: usize = 258;
+/// Bytes a word-at-a-time match copy may write past its end.
+const COPY_SLACK: usize = 8;
+/// Best compression ratio DEFLATE can reach (258 bytes from ~2 bits); a
+/// size hint beyond it cannot be right and is not trusted.
+const MAX_RATIO: usize = 1032;
+
+static CL_ORDER: [u8; 19] = [
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+];
+
+// ── Blocks ──────────────────────────────────────────────────────────────────
+
+/// Decode tables of the current Huffman block.
+pub(crate) struct Codes {
+    lit: Table,
+    dist: Table,
+    cl: Table,
+}
+
+impl Codes {
+    pub fn new() -> Self {
+        Codes { lit: Table::new(LIT_BITS), dist: Table::new(DIST_BITS), cl: Table::new(CL_BITS) }
+    }
+}
+
+pub(crate) enum Block {
+    /// Stored block of this many bytes.
+    Stored(usize),
+    /// Huffman block; the codes are in [`Codes`].
+    Huffman,
+}
+
+/// Read a block header; for Huffman blocks, build `codes`.  Returns
+/// `(is_final, block)`, or `None` if the header is corrupt.
+pub(crate) fn block_header(bits: &mut Bits, codes: &mut Codes) -> Option<(bool, Block)> {
+    let is_final = bits.read(1) == 1;
+    let block = match bits.read(2) {
+        0 => {
+            bits.align();
+            let len = bits.read(16);
+            let nlen = bits.read(16);
+            if len != !nlen & 0xFFFF {
+                return None;
+            }
+            Block::Stored(len as usize)
+        }
+        1 => {
+            static FIXED: [u8; 320] = fixed_lengths();
+            codes.lit.build(&FIXED[..288], lit_symbol);
+            codes.lit.pair_literals();
+            codes.dist.build(&FIXED[288..], dist_symbol);
+            Block::Huffman
+        }
+        2 => {
+            dynamic_codes(bits, codes)?;
+            Block::Huffman
+        }
+        _ => return None,
+    };
+    if bits.overrun() {
+        return None;
+    }
+    Some((is_final, block))
+}
+
+/// Fixed literal/length code lengths followed by the fixed distance ones.
+const fn fixed_lengths() -> [u8; 320] {
+    let mut t = [5u8; 320];
+    let mut i = 0;
+    while i < 288 {
+        t[i] = if i < 144 { 8 } else if i < 256 { 9 } else if i < 280 { 7 } else { 8 };
+        i += 1;
+    }
+    t
+}
+
+fn dynamic_codes(bits: &mut Bits, codes: &mut Codes) -> Option<()> {
+    let hlit = bits.read(5) as usize + 257;
+    let hdist = bits.read(5) as usize + 1;
+    let hclen = bits.read(4) as usize + 4;
+    if hlit > 286 || hdist > 30 {
+        return None;
+    }
+
+    let mut cl_lens = [0u8; 19];
+    for &sym in &CL_ORDER[..hclen] {
+        cl_lens[sym as usize] = bits.read(3) as u8;
+    }
+    if !codes.cl.build(&cl_lens, cl_symbol) {
+        return None;
+    }
+
+    let total = hlit + hdist;
+    let mut lens = [0u8; 320];
+    let mut i = 0;
+    while i < total {
+        // One code length code (7 bits) plus its repeat count (7 bits)
+        if bits.count < 14 {
+            bits.refill();
+        }
+        let e = codes.cl.lookup(bits.buf);
+        if kind(e) != KIND_LIT || bits.overrun() {
+            return None;
+        }
+        bits.consume(code_bits(e));
+        let (val, rep) = match value(e) {
+            sym @ 0..=15 => (sym as u8, 1),
+            16 if i > 0 => (lens[i - 1], 3 + bits.read(2) as usize),
+            17 => (0, 3 + bits.read(3) as usize),
+            18 => (0, 11 + bits.read(7) as usize),
+            _ => return None,
+        };
+        if i + rep > total {
+            return None;
+        }
+        lens[i..i + rep].fill(val);
+        i += rep;
+    }
+
+    // A block without an end-of-block code could never finish
+    if lens[256] == 0 {
+        return None;
+    }
+    if !codes.lit.build(&lens[..hlit], lit_symbol) || !codes.dist.build(&lens[hlit..total], dist_symbol) {
+        return None;
+    }
+    codes.lit.pair_literals();
+    Some(())
+}
+
+// ── Whole-stream decoding ───────────────────────────────────────────────────
+
+/// Decompress a raw DEFLATE stream.  Returns `None` if it is corrupt or
+/// truncated.
+pub fn inflate(data: &[u8]) -> Option<Vec<u8>> {
+    inflate_sized(data, 0)
+}
+
+/// Decompress a raw DEFLATE stream whose output is expected to be
+/// `size_hint` bytes (0 if unknown).  The hint only sizes the initial
+/// allocation; the output grows past it if needed.
+pub fn inflate_sized(data: &[u8], size_hint: usize) -> Option<Vec<u8>> {
+    let initial = if size_hint > 0 && size_hint / MAX_RATIO <= data.len() {
+        size_hint
+    } else {
+        data.len().saturating_mul(4).max(1024)
+    };
+    let mut out = Vec::new();
+    out.resize(initial + MAX_MATCH + COPY_SLACK, 0);
+
+    let mut bits = Bits::new(data, 0, data.len(), bits::single_segment);
+    let mut codes = Codes::new();
+    let mut pos = 0;
+    loop {
+        let (is_final, block) = block_header(&mut bits, &mut codes)?;
+        match block {
+            Block::Stored(len) => {
+                reserve(&mut out, pos, len);
+                if !bits.read_bytes(&mut out[pos..pos + len]) {
+                    return None;
+                }
+                pos += len;
+            }
+            Block::Huffman => pos = decode_block(&mut bits, &codes, &mut out, pos)?,
+        }
+        if is_final {
+            break;
+        }
+    }
+    if !bits.in_bounds() {
+        return None;
+    }
+    out.truncate(pos);
+    Some(out)
+}
+
+/// Make room for `len` more bytes plus a match and copy slack after `pos`.
+#[inline(never)]
+fn reserve(out: &mut Vec<u8>, pos: usize, len: usize) {
+    let need = pos + len + MAX_MATCH + COPY_SLACK;
+    if need > out.len() {
+        out.resize(need.max(out.len() * 2), 0);
+    }
+}
+
+/// Decode one Huffman block into `out` at `pos`; returns the new position.
+fn decode_block(bits: &mut Bits, codes: &Codes, out: &mut Vec<u8>, mut pos: usize) -> Option<usize> {
+    // Work on a local copy so the bit buffer stays in registers
+    let mut b = *bits;
+    let (lit, dist) = (&codes.lit, &codes.dist);
+    loop {
+        if pos + MAX_MATCH + COPY_SLACK > out.len() {
+            reserve(out, pos, 0);
+        }
+        b.refill();
+        if b.overrun() {
+            return None;
+        }
+        let e = lit.lookup(b.buf);
+        b.consume(code_bits(e));
+        match kind(e) {
+            KIND_LIT => {
+                out[pos] = e as u8;
+                pos += 1;
+            }
+            KIND_LIT2 => {
+                out[pos] = e as u8;
+                out[pos + 1] = (e >> 8) as u8;
+                pos += 2;
+            }
+            KIND_BASE => {
+                let len = value(e) as usize + b.take(extra_bits(e));
+                let d = dist.lookup(b.buf);
+                if kind(d) != KIND_BASE {
+                    return None;
+                }
+                b.consume(code_bits(d));
+                let distance = value(d) as usize + b.take(extra_bits(d));
+                if distance > pos {
+                    return None;
+                }
+                copy_match(out, pos, distance, len);
+                pos += len;
+            }
+            KIND_EOB => break,
+            _ => return None,
+        }
+    }
+    *bits = b;
+    Some(pos)
+}
+
+/// Copy a `len`-byte match from `distance` back.  `out` must have
+/// [`COPY_SLACK`] bytes of room past the match.
+#[inline(always)]
+fn copy_match(out: &mut [u8], pos: usize, distance: usize, len: usize) {
+    if distance >= COPY_SLACK {
+        // Every word read lies before the word written
+        let (mut src, mut dst) = (pos - distance, pos);
+        let end = pos + len;
+        while dst < end {
+            let word: [u8; 8] = out[src..src + 8].try_into().unwrap();
+            out[dst..dst + 8].copy_from_slice(&word);
+            src += 8;
+            dst += 8;
+        }
+    } else if distance == 1 {
+        let byte = out[pos - 1];
+        out[pos..pos + len].fill(byte);
+    } else {
+        for i in pos..pos + len {
+            out[i] = out[i - distance];
+        }
+    }
+}
+
+// ── Containers ──────────────────────────────────────────────────────────────
+
+/// Decompress a zlib stream (RFC 1950).  Preset dictionaries are not
+/// supported and the Adler-32 trailer is not checked.
+pub fn zlib_decompress(data: &[u8], size_hint: usize) -> Option<Vec<u8>> {
+    if data.len() < 2 || !zlib_header_ok(data[0], data[1]) {
+        return None;
+    }
+    inflate_sized(&data[2..], size_hint)
+}
+
+pub(crate) fn zlib_header_ok(cmf: u8, flg: u8) -> bool {
+    cmf & 0x0F == 8 && cmf >> 4 <= 7 && (cmf as u16 * 256 + flg as u16) % 31 == 0 && flg & 0x20 == 0
+}
+
+/// Locate the DEFLATE data of a gzip member (RFC 1952).  Returns
+/// `(start, end, isize)`: the deflate stream is `data[start..end]` and
+/// decompresses to `isize` bytes (mod 2^32).  The CRC-32 in the trailer
+/// is at `data[end..end + 4]`.
+pub fn gzip_member(data: &[u8]) -> Option<(usize, usize, u32)> {
+    const FHCRC: u8 = 0x02;
+    const FEXTRA: u8 = 0x04;
+    const FNAME: u8 = 0x08;
+    const FCOMMENT: u8 = 0x10;
+
+    if data.len() < 18 || data[0] != 0x1F || data[1] != 0x8B || data[2] != 8 {
+        return None;
+    }
+    let flags = data[3];
+    let mut pos = 10;
+    if flags & FEXTRA != 0 {
+        let xlen = u16::from_le_bytes([*data.get(pos)?, *data.get(pos + 1)?]) as usize;
+        pos += 2 + xlen;
+    }
+    for flag in [FNAME, FCOMMENT] {
+        if flags & flag != 0 {
+            pos += data.get(pos..)?.iter().position(|&b| b == 0)? + 1;
+        }
+    }
+    if flags & FHCRC != 0 {
+        pos += 2;
+    }
+    let end = data.len() - 8;
+    if pos > end {
+        return None;
+    }
+    let isize = u32::from_le_bytes(data[data.len() - 4..].try_into().unwrap());
+    Some((pos, end, isize))
+}
+
+/// Decompress a single-member gzip stream, checking its `ISIZE`.  The
+/// CRC-32 is not checked; see [`gzip_member`].
+pub fn gzip_decompress(data: &[u8]) -> Option<Vec<u8>> {
+    let (start, end, isize) = gzip_member(data)?;
+    let out = inflate_sized(&data[start..end], isize as usize)?;
+    if out.len() as u32 != isize {
+        return None;
+    }
+    Some(out)
+}
@@ -0,0 +1,380 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Incremental decompression into caller-sized pieces.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use crate::bits::{Bits, Carry, NextSegment};
+use crate::table::*;
+use crate::{block_header, zlib_header_ok, Block, Codes, MAX_MATCH, WINDOW_SIZE};
+
+const WINDOW_MASK: usize = WINDOW_SIZE - 1;
+
+#[derive(Copy, Clone, PartialEq)]
+enum State {
+    /// Expecting a block header.
+    Header,
+    /// Inside a stored block with this many bytes left.
+    Stored(usize),
+    /// Inside a Huffman block.
+    Huffman,
+    /// The final block has ended.
+    Done,
+    /// The stream is corrupt or truncated.
+    Failed,
+}
+
+/// Incremental DEFLATE decompressor.
+///
+/// Output is pulled with [`read`](Self::read) in pieces of any size — a PNG
+/// scanline, say — so only the 32 KiB history window has to stay resident
+/// instead of the whole decompressed stream.  A match that straddles two
+/// reads is resumed from `copy_len` / `copy_dist`.
+pub struct Inflater<'a> {
+    bits: Bits<'a>,
+    /// 32 KiB history ring.
+    window: &'a mut [u8],
+    /// Total bytes produced so far (window position).
+    win_pos: usize,
+    state: State,
+    is_final: bool,
+    codes: Codes,
+    /// Pending match bytes not yet copied out.
+    copy_len: usize,
+    copy_dist: usize,
+}
+
+impl<'a> Inflater<'a> {
+    /// Start decompressing a raw DEFLATE stream at `data[start..end]`,
+    /// continuing into the segments returned by `next`.
+    ///
+    /// Returns `None` if `window` is smaller than [`WINDOW_SIZE`].
+    pub fn new(data: &'a [u8], start: usize, end: usize, next: NextSegment,
+               window: &'a mut [u8]) -> Option<Self> {
+        if window.len() < WINDOW_SIZE {
+            return None;
+        }
+        Some(Self {
+            bits: Bits::new(data, start, end, next),
+            window,
+            win_pos: 0,
+            state: State::Header,
+            is_final: false,
+            codes: Codes::new(),
+            copy_len: 0,
+            copy_dist: 0,
+        })
+    }
+
+    /// Consume and check a zlib header (RFC 1950).  Preset dictionaries are
+    /// not supported.
+    pub fn zlib_header(&mut self) -> bool {
+        let cmf = self.bits.read(8) as u8;
+        let flg = self.bits.read(8) as u8;
+        zlib_header_ok(cmf, flg) && !self.bits.overrun()
+    }
+
+    /// Fill `out` completely with decompressed bytes.
+    ///
+    /// Returns false if the stream is corrupt or ends before `out` is full;
+    /// every later call fails as well.
+    pub fn read(&mut self, out: &mut [u8]) -> bool {
+        self.decode(out, usize::MAX) == Some(out.len())
+    }
+
+    /// Decompress into `out` until it is full, the stream ends, or the
+    /// input position reaches `limit` between symbols.  Returns the bytes
+    /// produced, or `None` (and fails from then on) if the stream is
+    /// corrupt or truncated.
+    fn decode(&mut self, out: &mut [u8], limit: usize) -> Option<usize> {
+        let mut pos = 0usize;
+        while pos < out.len() {
+            if self.copy_len > 0 {
+                self.copy_match(out, &mut pos);
+                continue;
+            }
+            if self.bits.position() >= limit {
+                break;
+            }
+            let ok = match self.state {
+                State::Header => match block_header(&mut self.bits, &mut self.codes) {
+                    Some((is_final, block)) => {
+                        self.is_final = is_final;
+                        self.state = match block {
+                            Block::Stored(0) => self.block_end(),
+                            Block::Stored(len) => State::Stored(len),
+                            Block::Huffman => State::Huffman,
+                        };
+                        true
+                    }
+                    None => false,
+                },
+                State::Stored(left) => {
+                    let mut n = left.min(out.len() - pos);
+                    if limit != usize::MAX {
+                        // More input may follow: copy only what is here
+                        n = n.min(self.bits.buffered() + self.bits.remaining());
+                    }
+                    let ok = self.bits.read_bytes(&mut out[pos..pos + n]);
+                    if ok {
+                        self.record(&out[pos..pos + n]);
+                        pos += n;
+                        self.state = if n == left { self.block_end() } else { State::Stored(left - n) };
+                    }
+                    ok
+                }
+                State::Huffman => self.decode_symbols(out, &mut pos, limit),
+                State::Done => break,
+                State::Failed => false,
+            };
+            if !ok {
+                self.state = State::Failed;
+                return None;
+            }
+        }
+        Some(pos)
+    }
+
+    fn block_end(&self) -> State {
+        if self.is_final { State::Done } else { State::Header }
+    }
+
+    /// Append `bytes` to the history window.
+    fn record(&mut self, bytes: &[u8]) {
+        let bytes = &bytes[bytes.len().saturating_sub(WINDOW_SIZE)..];
+        let start = self.win_pos & WINDOW_MASK;
+        let first = bytes.len().min(WINDOW_SIZE - start);
+        self.window[start..start + first].copy_from_slice(&bytes[..first]);
+        self.window[..bytes.len() - first].copy_from_slice(&bytes[first..]);
+        self.win_pos += bytes.len();
+    }
+
+    /// Decode literals and matches into `out` until it is full, the block
+    /// ends or the input position reaches `limit`.
+    fn decode_symbols(&mut self, out: &mut [u8], out_pos: &mut usize, limit: usize) -> bool {
+        // Work on local copies so the hot state stays in registers
+        let window = &mut *self.window;
+        let (lit, dist) = (&self.codes.lit, &self.codes.dist);
+        let mut b = self.bits;
+        let mut win_pos = self.win_pos;
+        let mut pos = *out_pos;
+        let ok = loop {
+            if pos >= out.len() || b.position() >= limit {
+                break true;
+            }
+            b.refill();
+            if b.overrun() {
+                break false;
+            }
+            let e = lit.lookup(b.buf);
+            match kind(e) {
+                KIND_LIT | KIND_LIT2 => {
+                    let byte = e as u8;
+                    out[pos] = byte;
+                    window[win_pos & WINDOW_MASK] = byte;
+                    pos += 1;
+                    win_pos += 1;
+                    if kind(e) == KIND_LIT2 && pos < out.len() {
+                        let byte = (e >> 8) as u8;
+                        out[pos] = byte;
+                        window[win_pos & WINDOW_MASK] = byte;
+                        pos += 1;
+                        win_pos += 1;
+                        b.consume(code_bits(e));
+                    } else {
+                        // Second literal of a pair left for the next read
+                        b.consume(if kind(e) == KIND_LIT2 { extra_bits(e) } else { code_bits(e) });
+                    }
+                    continue;
+                }
+                KIND_EOB => {
+                    b.consume(code_bits(e));
+                    self.state = if self.is_final { State::Done } else { State::Header };
+                    break true;
+                }
+                KIND_BASE => {}
+                _ => break false,
+            }
+
+            // Length/distance pair
+            b.consume(code_bits(e));
+            let length = value(e) as usize + b.take(extra_bits(e));
+            let d = dist.lookup(b.buf);
+            if kind(d) != KIND_BASE {
+                break false;
+            }
+            b.consume(code_bits(d));
+            let distance = value(d) as usize + b.take(extra_bits(d));
+            if distance > win_pos {
+                break false;
+            }
+
+            if out.len() - pos < MAX_MATCH {
+                // Near the end of `out`: let copy_match split it across reads
+                self.copy_len = length;
+                self.copy_dist = distance;
+                break true;
+            }
+            let src = (win_pos - distance) & WINDOW_MASK;
+            let dst = win_pos & WINDOW_MASK;
+            if distance >= length && src.max(dst) + length <= WINDOW_SIZE {
+                // Neither side wraps and they don't overlap: bulk copy
+                out[pos..pos + length].copy_from_slice(&window[src..src + length]);
+                window.copy_within(src..src + length, dst);
+            } else {
+                // Overlapping (run-length) or wrapping copy
+                for i in 0..length {
+                    let byte = window[(win_pos + i - distance) & WINDOW_MASK];
+                    out[pos + i] = byte;
+                    window[(win_pos + i) & WINDOW_MASK] = byte;
+                }
+            }
+            pos += length;
+            win_pos += length;
+        };
+        *out_pos = pos;
+        self.bits = b;
+        self.win_pos = win_pos;
+        ok
+    }
+
+    /// Continue a pending match into `out`.
+    fn copy_match(&mut self, out: &mut [u8], pos: &mut usize) {
+        let n = self.copy_len.min(out.len() - *pos);
+        for _ in 0..n {
+            let byte = self.window[(self.win_pos - self.copy_dist) & WINDOW_MASK];
+            out[*pos] = byte;
+            self.window[self.win_pos & WINDOW_MASK] = byte;
+            *pos += 1;
+            self.win_pos += 1;
+        }
+        self.copy_len -= n;
+    }
+}
+
+/// Input buffered by [`InflateStream`].
+const INPUT_SIZE: usize = 16 * 1024;
+/// Input kept unread until more arrives: enough for any block header (at
+/// most ~570 bytes) or symbol, so decoding never runs off a chunk's end.
+const LOOKAHEAD: usize = 1024;
+
+/// Push-style DEFLATE decompressor with fixed memory.
+///
+/// Input arrives in chunks of any size and output leaves in chunks of any
+/// size; between calls only the 32 KiB window, 16 KiB of input and the
+/// decode tables are kept.  Used where neither side fits in memory at once
+/// — gzip files, log archives.
+pub struct InflateStream {
+    /// Buffered input, unread from `in_pos` on; after the final block,
+    /// the bytes that followed it.
+    input: Vec<u8>,
+    in_pos: usize,
+    window: Vec<u8>,
+    /// Bit reader state carried over from the last call.
+    carry: Carry,
+    win_pos: usize,
+    state: State,
+    is_final: bool,
+    codes: Codes,
+    copy_len: usize,
+    copy_dist: usize,
+}
+
+impl InflateStream {
+    pub fn new() -> Self {
+        Self {
+            input: Vec::with_capacity(INPUT_SIZE),
+            in_pos: 0,
+            window: vec![0; WINDOW_SIZE],
+            carry: Carry::default(),
+            win_pos: 0,
+            state: State::Header,
+            is_final: false,
+            codes: Codes::new(),
+            copy_len: 0,
+            copy_dist: 0,
+        }
+    }
+
+    /// Feed `input` and decompress into `out`.  `last` marks the end of
+    /// the input; it applies once all of `input` has been consumed.
+    ///
+    /// Returns `(consumed, produced)`, or `None` if the stream is corrupt,
+    /// or truncated with `last` set.  Call again with the unconsumed rest
+    /// of the input (or none) while `produced == out.len()` or input is
+    /// left, until [`is_done`](Self::is_done).
+    pub fn decompress(&mut self, input: &[u8], last: bool, out: &mut [u8]) -> Option<(usize, usize)> {
+        match self.state {
+            State::Done => return Some((0, 0)),
+            State::Failed => return None,
+            _ => {}
+        }
+        if self.in_pos > 0 && self.input.len() + input.len() > INPUT_SIZE {
+            self.input.drain(..self.in_pos);
+            self.in_pos = 0;
+        }
+        let take = input.len().min(INPUT_SIZE - self.input.len());
+        self.input.extend_from_slice(&input[..take]);
+        let unread = &self.input[self.in_pos..];
+        let limit = if last && take == input.len() {
+            usize::MAX
+        } else {
+            (unread.len() + 1).saturating_sub(LOOKAHEAD)
+        };
+
+        let mut inf = Inflater {
+            bits: Bits::resume(unread, self.carry),
+            window: &mut self.window,
+            win_pos: self.win_pos,
+            state: self.state,
+            is_final: self.is_final,
+            codes: core::mem::replace(&mut self.codes, Codes::new()),
+            copy_len: self.copy_len,
+            copy_dist: self.copy_dist,
+        };
+        let produced = inf.decode(out, limit);
+        let Inflater { mut bits, win_pos, state, is_final, codes, copy_len, copy_dist, .. } = inf;
+        self.win_pos = win_pos;
+        self.state = state;
+        self.is_final = is_final;
+        self.codes = codes;
+        self.copy_len = copy_len;
+        self.copy_dist = copy_dist;
+
+        let used = self.in_pos + bits.position();
+        if state == State::Done {
+            // Hand back the whole bytes read past the final block
+            bits.align();
+            let mut rest = Vec::with_capacity(bits.buffered() + self.input.len() - used);
+            for _ in 0..bits.buffered() {
+                rest.push(bits.buf as u8);
+                bits.consume(8);
+            }
+            rest.extend_from_slice(&self.input[used..]);
+            self.input = rest;
+            self.in_pos = 0;
+            self.carry = Carry::default();
+        } else {
+            self.carry = bits.carry();
+            self.in_pos = used;
+        }
+        Some((take, produced?))
+    }
+
+    /// True once the final block has been decoded.
+    pub fn is_done(&self) -> bool {
+        self.state == State::Done
+    }
+
+    /// After [`is_done`](Self::is_done): input consumed by earlier calls
+    /// that follows the end of the stream (a container trailer, say).
+    pub fn trailing(&self) -> &[u8] {
+        if self.is_done() { &self.input } else { &[] }
+    }
+
+    /// Decompressed bytes produced so far.
+    pub fn total_out(&self) -> usize {
+        self.win_pos
+    }
+}
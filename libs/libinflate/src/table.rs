@@ -0,0 +1,225 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Two-level canonical Huffman decode tables.
+//!
+//! The primary table is indexed by the next `root` input bits.  Codes up to
+//! `root` bits long are replicated across every suffix; longer codes share a
+//! primary slot that links to a subtable indexed by the following bits
+//! (zlib's layout).  Each entry already holds what the decoder needs next —
+//! the literal, or the length/distance base and its extra bit count — so a
+//! symbol costs one or two loads.  In literal/length tables a primary slot
+//! whose bits contain two complete literal codes decodes both at once.
+
+use alloc::vec::Vec;
+
+/// Primary index bits of the literal/length, distance and code length
+/// tables.
+pub(crate) const LIT_BITS: u32 = 10;
+pub(crate) const DIST_BITS: u32 = 8;
+pub(crate) const CL_BITS: u32 = 7;
+
+// Entry layout:
+//   bits  0..16  value: literal (two in KIND_LIT2), base, or subtable start
+//   bits 16..21  code bits to consume (subtable index bits for KIND_LINK)
+//   bits 21..25  extra bits after the code (KIND_LIT2: first code's bits)
+//   bits 28..32  kind; 0 marks an unused code
+pub(crate) const KIND_LIT: u32 = 1;
+pub(crate) const KIND_LIT2: u32 = 2;
+pub(crate) const KIND_BASE: u32 = 3;
+pub(crate) const KIND_EOB: u32 = 4;
+const KIND_LINK: u32 = 5;
+
+#[inline(always)]
+pub(crate) fn kind(e: u32) -> u32 { e >> 28 }
+#[inline(always)]
+pub(crate) fn value(e: u32) -> u32 { e & 0xFFFF }
+#[inline(always)]
+pub(crate) fn code_bits(e: u32) -> u32 { (e >> 16) & 0x1F }
+#[inline(always)]
+pub(crate) fn extra_bits(e: u32) -> u32 { (e >> 21) & 0xF }
+
+const fn entry(kind: u32, value: u32, extra: u32) -> u32 {
+    kind << 28 | extra << 21 | value
+}
+
+static LEN_BASE: [u16; 29] = [
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13,
+    15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258,
+];
+
+static LEN_EXTRA: [u8; 29] = [
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+    1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+    4, 4, 4, 4, 5, 5, 5, 5, 0,
+];
+
+static DIST_BASE: [u16; 30] = [
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25,
+    33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+];
+
+static DIST_EXTRA: [u8; 30] = [
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3,
+    4, 4, 5, 5, 6, 6, 7, 7, 8, 8,
+    9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+];
+
+/// Literal/length symbol to entry.
+pub(crate) fn lit_symbol(sym: usize) -> u32 {
+    match sym {
+        0..=255 => entry(KIND_LIT, sym as u32, 0),
+        256 => entry(KIND_EOB, 0, 0),
+        257..=285 => entry(KIND_BASE, LEN_BASE[sym - 257] as u32, LEN_EXTRA[sym - 257] as u32),
+        _ => 0,
+    }
+}
+
+/// Distance symbol to entry.
+pub(crate) fn dist_symbol(sym: usize) -> u32 {
+    match sym {
+        0..=29 => entry(KIND_BASE, DIST_BASE[sym] as u32, DIST_EXTRA[sym] as u32),
+        _ => 0,
+    }
+}
+
+/// Code length symbol to entry.
+pub(crate) fn cl_symbol(sym: usize) -> u32 {
+    entry(KIND_LIT, sym as u32, 0)
+}
+
+pub(crate) struct Table {
+    /// Primary table followed by the subtables.
+    entries: Vec<u32>,
+    root: u32,
+}
+
+impl Table {
+    pub fn new(root: u32) -> Self {
+        Table { entries: Vec::new(), root }
+    }
+
+    /// Rebuild from code lengths (0-15, at most 288 symbols); `map` gives
+    /// the entry of each symbol.
+    ///
+    /// Returns false for an over-subscribed set of lengths.  Incomplete sets
+    /// are accepted; their unused codes decode as kind 0.
+    pub fn build(&mut self, lens: &[u8], map: fn(usize) -> u32) -> bool {
+        let mut count = [0u16; 16];
+        for &l in lens {
+            count[l as usize] += 1;
+        }
+        count[0] = 0;
+        let mut left = 1i32;
+        for l in 1..16 {
+            left = (left << 1) - count[l] as i32;
+            if left < 0 {
+                return false;
+            }
+        }
+
+        // Symbols in canonical order: by length, then by value
+        let mut offs = [0u16; 16];
+        for l in 1..15 {
+            offs[l + 1] = offs[l] + count[l];
+        }
+        let mut sorted = [0u16; 288];
+        let mut n = 0;
+        for (sym, &l) in lens.iter().enumerate() {
+            if l != 0 {
+                sorted[offs[l as usize] as usize] = sym as u16;
+                offs[l as usize] += 1;
+                n += 1;
+            }
+        }
+
+        let root = self.root;
+        let max_len = (1..16).rev().find(|&l| count[l] != 0).unwrap_or(0) as u32;
+        self.entries.clear();
+        self.entries.resize(1 << root, 0);
+
+        let mut remaining = count;
+        let mut code = 0u32;
+        let mut sub_low = u32::MAX;
+        let mut sub_start = 0usize;
+        let mut sub_bits = 0u32;
+        for i in 0..n {
+            let sym = sorted[i] as usize;
+            let l = lens[sym] as u32;
+            let rev = code.reverse_bits() >> (32 - l);
+            let e = map(sym) | l << 16;
+            if l <= root {
+                let mut j = rev as usize;
+                while j < 1 << root {
+                    self.entries[j] = e;
+                    j += 1 << l;
+                }
+            } else {
+                let low = rev & ((1 << root) - 1);
+                if low != sub_low {
+                    // Grow the subtable until the codes left for it fill it
+                    let mut bits = l - root;
+                    let mut room = 1i32 << bits;
+                    while root + bits < max_len {
+                        room -= remaining[(root + bits) as usize] as i32;
+                        if room <= 0 {
+                            break;
+                        }
+                        bits += 1;
+                        room <<= 1;
+                    }
+                    sub_start = self.entries.len();
+                    self.entries.resize(sub_start + (1 << bits), 0);
+                    self.entries[low as usize] = entry(KIND_LINK, sub_start as u32, 0) | bits << 16;
+                    sub_low = low;
+                    sub_bits = bits;
+                }
+                let mut j = (rev >> root) as usize;
+                while j < 1 << sub_bits {
+                    self.entries[sub_start + j] = e;
+                    j += 1 << (l - root);
+                }
+            }
+            remaining[l as usize] -= 1;
+            code += 1;
+            if i + 1 < n {
+                code <<= lens[sorted[i + 1] as usize] as u32 - l;
+            }
+        }
+        true
+    }
+
+    /// Merge pairs of literal codes that fit in the primary index together
+    /// into [`KIND_LIT2`] entries.
+    pub fn pair_literals(&mut self) {
+        let root = self.root;
+        let size = 1usize << root;
+        let mut single = [0u32; 1 << LIT_BITS];
+        let single = &mut single[..size];
+        single.copy_from_slice(&self.entries[..size]);
+        for (i, &e) in single.iter().enumerate() {
+            let l1 = code_bits(e);
+            if kind(e) != KIND_LIT || l1 >= root {
+                continue;
+            }
+            let e2 = single[i >> l1];
+            let l2 = code_bits(e2);
+            if kind(e2) == KIND_LIT && l2 <= root - l1 {
+                self.entries[i] = entry(KIND_LIT2, value(e) | value(e2) << 8, l1) | (l1 + l2) << 16;
+            }
+        }
+    }
+
+    /// Entry for the code at the bottom of `bits`.
+    #[inline(always)]
+    pub fn lookup(&self, bits: u64) -> u32 {
+        let e = self.entries[bits as usize & ((1 << self.root) - 1)];
+        if kind(e) != KIND_LINK {
+            return e;
+        }
+        let sub = (bits >> self.root) as usize & ((1 << code_bits(e)) - 1);
+        self.entries[value(e) as usize + sub]
+    }
+}
@@ -0,0 +1,504 @@
+//! Refcounted JavaScript strings and the atom table.
+//!
+//! A [`JsStr`] is an immutable string value.  Strings of up to
+//! [`INLINE_CAP`] bytes — most identifiers and property names — are stored
+//! inline and need no allocation at all.  Longer ones live behind one
+//! `Rc`, so copying a string value (`Dup`, argument passing, property
+//! stores) only bumps a count.  Besides flat text there are two lazy
+//! representations of heap strings:
+//!
+//! - **ropes**, built by [`JsStr::concat`] once the result is long enough
+//!   to be worth it.  `s += x` in a loop then costs O(1) per append; the
+//!   text is assembled on the first read and cached in the node.
+//! - **slices**, built by [`JsStr::slice`], which share the buffer of a
+//!   long parent instead of copying a substring out of it.
+//!
+//! Inline strings compare as two words.  The hash of a heap string is
+//! computed once and cached, so comparing two of them is a pointer check,
+//! then a length and hash check, and only then a byte compare.  An
+//! [`AtomTable`] interns identifiers and property names: two long keys
+//! interned by the same table are the same pointer, which makes the
+//! first check the one that decides.
+
+use alloc::borrow::Borrow;
+use alloc::boxed::Box;
+use alloc::collections::BTreeSet;
+use alloc::rc::Rc;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use core::cell::{Cell, OnceCell, RefCell};
+use core::cmp::Ordering;
+use core::fmt;
+use core::ops::{Deref, Range};
+use core::str;
+
+use crate::bytecode::{Chunk, Constant};
+
+/// Longest string stored inline (keeps `JsStr` at two words).
+pub const INLINE_CAP: usize = 14;
+
+/// Concatenations shorter than this are copied into a flat string; a rope
+/// node costs more than copying a few dozen bytes.
+const ROPE_MIN: usize = 64;
+
+/// Slices shorter than this are copied out, so a short substring does not
+/// keep a large parent alive.
+const SLICE_MIN: usize = 32;
+
+/// An immutable string value: inline when short, refcounted otherwise.
+///
+/// The representation is canonical — a string is inline exactly when it
+/// fits — so an inline and a heap string are never equal.
+#[derive(Clone)]
+pub struct JsStr(Repr);
+
+#[derive(Clone)]
+enum Repr {
+    Inline { len: u8, buf: [u8; INLINE_CAP] },
+    Heap(Rc<Node>),
+}
+
+struct Node {
+    /// Length in bytes (known without flattening).
+    len: usize,
+    /// FNV-1a of the bytes; 0 until first asked for.
+    hash: Cell<u32>,
+    /// The text: set at creation for flat strings, on first read for ropes.
+    text: OnceCell<Box<str>>,
+    kind: Kind,
+}
+
+enum Kind {
+    Flat,
+    /// The two halves, released once `text` has been assembled.
+    Concat(RefCell<Option<(JsStr, JsStr)>>),
+    /// `len` bytes of another string's text, starting at the byte offset.
+    Slice(JsStr, usize),
+}
+
+impl JsStr {
+    pub fn new(s: &str) -> JsStr {
+        JsStr::inline(s).unwrap_or_else(|| JsStr::flat(Box::from(s)))
+    }
+
+    fn inline(s: &str) -> Option<JsStr> {
+        if s.len() > INLINE_CAP {
+            return None;
+        }
+        let mut buf = [0u8; INLINE_CAP];
+        buf[..s.len()].copy_from_slice(s.as_bytes());
+        Some(JsStr(Repr::Inline { len: s.len() as u8, buf }))
+    }
+
+    fn flat(text: Box<str>) -> JsStr {
+        if let Some(s) = JsStr::inline(&text) {
+            return s;
+        }
+        let cell = OnceCell::new();
+        let len = text.len();
+        let _ = cell.set(text);
+        JsStr::heap(Node { len, hash: Cell::new(0), text: cell, kind: Kind::Flat })
+    }
+
+    fn heap(node: Node) -> JsStr {
+        JsStr(Repr::Heap(Rc::new(node)))
+    }
+
+    #[inline]
+    pub fn as_str(&self) -> &str {
+        match &self.0 {
+            // SAFETY: the buffer was copied from a `str`.
+            Repr::Inline { len, buf } => unsafe { str::from_utf8_unchecked(&buf[..*len as usize]) },
+            Repr::Heap(node) => node.as_str(),
+        }
+    }
+
+    /// Length in bytes.
+    #[inline]
+    pub fn len(&self) -> usize {
+        match &self.0 {
+            Repr::Inline { len, .. } => *len as usize,
+            Repr::Heap(node) => node.len,
+        }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Whether both handles are the same string: the same heap node, or
+    /// equal inline text.
+    #[inline]
+    pub fn ptr_eq(a: &JsStr, b: &JsStr) -> bool {
+        match (&a.0, &b.0) {
+            (Repr::Heap(x), Repr::Heap(y)) => Rc::ptr_eq(x, y),
+            (Repr::Inline { len: la, buf: ba }, Repr::Inline { len: lb, buf: bb }) => la == lb && ba == bb,
+            _ => false,
+        }
+    }
+
+    /// FNV-1a hash of the text (never 0); cached for heap strings.
+    pub fn hash(&self) -> u32 {
+        let node = match &self.0 {
+            Repr::Inline { .. } => return fnv1a(self.as_str()),
+            Repr::Heap(node) => node,
+        };
+        let h = node.hash.get();
+        if h != 0 {
+            return h;
+        }
+        let h = fnv1a(node.as_str());
+        node.hash.set(h);
+        h
+    }
+
+    /// `self + other`.  Long results are ropes; nothing is copied until
+    /// the text is read.
+    pub fn concat(&self, other: &JsStr) -> JsStr {
+        if other.is_empty() {
+            return self.clone();
+        }
+        if self.is_empty() {
+            return other.clone();
+        }
+        let len = self.len() + other.len();
+        if len < ROPE_MIN {
+            let mut s = String::with_capacity(len);
+            s.push_str(self.as_str());
+            s.push_str(other.as_str());
+            return JsStr::from(s);
+        }
+        JsStr::heap(Node {
+            len,
+            hash: Cell::new(0),
+            text: OnceCell::new(),
+            kind: Kind::Concat(RefCell::new(Some((self.clone(), other.clone())))),
+        })
+    }
+
+    /// `self + s`, as [`concat`](Self::concat).
+    pub fn concat_str(&self, s: &str) -> JsStr {
+        if s.is_empty() {
+            return self.clone();
+        }
+        self.concat(&JsStr::new(s))
+    }
+
+    /// The substring at byte range `range` (on char boundaries).  Long
+    /// slices share this string's buffer.
+    pub fn slice(&self, range: Range<usize>) -> JsStr {
+        if range.start == 0 && range.end == self.len() {
+            return self.clone();
+        }
+        let text = &self.as_str()[range.clone()];
+        if text.len() < SLICE_MIN {
+            return JsStr::new(text);
+        }
+        let (base, start) = match &self.0 {
+            Repr::Heap(node) => match &node.kind {
+                Kind::Slice(base, offset) => (base.clone(), offset + range.start),
+                _ => (self.clone(), range.start),
+            },
+            Repr::Inline { .. } => (self.clone(), range.start),
+        };
+        JsStr::heap(Node {
+            len: text.len(),
+            hash: Cell::new(0),
+            text: OnceCell::new(),
+            kind: Kind::Slice(base, start),
+        })
+    }
+
+    /// The heap node as a raw pointer that owns one reference, for packed
+    /// value encodings.  An inline string has none and is handed back.
+    pub(crate) fn into_raw(self) -> Result<*const (), JsStr> {
+        match self.0 {
+            Repr::Heap(node) => Ok(Rc::into_raw(node) as *const ()),
+            inline => Err(JsStr(inline)),
+        }
+    }
+
+    /// Take back the reference owned by a pointer from [`into_raw`](Self::into_raw).
+    ///
+    /// # Safety
+    /// `raw` must come from `into_raw`, and its reference is consumed.
+    pub(crate) unsafe fn from_raw(raw: *const ()) -> JsStr {
+        JsStr(Repr::Heap(Rc::from_raw(raw as *const Node)))
+    }
+
+    /// Add a reference to a pointer from [`into_raw`](Self::into_raw).
+    ///
+    /// # Safety
+    /// `raw` must come from `into_raw` and still own its reference.
+    pub(crate) unsafe fn retain_raw(raw: *const ()) {
+        Rc::increment_strong_count(raw as *const Node);
+    }
+
+    /// The rope node of `self`, unless already flattened.
+    fn rope_parts(&self) -> Option<&RefCell<Option<(JsStr, JsStr)>>> {
+        match &self.0 {
+            Repr::Heap(node) => match &node.kind {
+                Kind::Concat(parts) if node.text.get().is_none() => Some(parts),
+                _ => None,
+            },
+            Repr::Inline { .. } => None,
+        }
+    }
+}
+
+fn fnv1a(s: &str) -> u32 {
+    let mut h: u32 = 0x811c_9dc5;
+    for b in s.bytes() {
+        h = (h ^ b as u32).wrapping_mul(0x0100_0193);
+    }
+    if h == 0 { 1 } else { h }
+}
+
+impl Node {
+    #[inline]
+    fn as_str(&self) -> &str {
+        match &self.kind {
+            Kind::Flat => self.text.get().map(|t| &**t).unwrap_or(""),
+            Kind::Slice(base, start) => &base.as_str()[*start..*start + self.len],
+            Kind::Concat(parts) => {
+                if let Some(t) = self.text.get() {
+                    return t;
+                }
+                let text = self.text.get_or_init(|| self.assemble());
+                *parts.borrow_mut() = None;
+                text
+            }
+        }
+    }
+
+    /// Flatten a rope without recursion: ropes built by repeated `+=` are
+    /// as deep as the number of appends.
+    fn assemble(&self) -> Box<str> {
+        let mut out = String::with_capacity(self.len);
+        let mut pending: Vec<JsStr> = Vec::new();
+        if let Kind::Concat(parts) = &self.kind {
+            if let Some((l, r)) = &*parts.borrow() {
+                pending.push(r.clone());
+                pending.push(l.clone());
+            }
+        }
+        while let Some(s) = pending.pop() {
+            match s.rope_parts() {
+                Some(parts) => {
+                    if let Some((l, r)) = &*parts.borrow() {
+                        pending.push(r.clone());
+                        pending.push(l.clone());
+                    }
+                }
+                None => out.push_str(s.as_str()),
+            }
+        }
+        out.into_boxed_str()
+    }
+}
+
+impl Drop for Node {
+    /// Unlink rope children iteratively; dropping a deep rope recursively
+    /// would overflow the stack.
+    fn drop(&mut self) {
+        let mut pending: Vec<JsStr> = match &mut self.kind {
+            Kind::Concat(parts) => match parts.get_mut().take() {
+                Some((l, r)) => alloc::vec![l, r],
+                None => return,
+            },
+            _ => return,
+        };
+        while let Some(s) = pending.pop() {
+            if let Repr::Heap(rc) = s.0 {
+                if let Ok(mut node) = Rc::try_unwrap(rc) {
+                    if let Kind::Concat(parts) = &mut node.kind {
+                        if let Some((l, r)) = parts.get_mut().take() {
+                            pending.push(l);
+                            pending.push(r);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+impl Deref for JsStr {
+    type Target = str;
+
+    #[inline]
+    fn deref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl AsRef<str> for JsStr {
+    fn as_ref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl Borrow<str> for JsStr {
+    fn borrow(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl PartialEq for JsStr {
+    #[inline]
+    fn eq(&self, other: &JsStr) -> bool {
+        let (a, b) = match (&self.0, &other.0) {
+            (Repr::Heap(a), Repr::Heap(b)) => (a, b),
+            _ => return JsStr::ptr_eq(self, other),
+        };
+        if Rc::ptr_eq(a, b) {
+            return true;
+        }
+        if a.len != b.len {
+            return false;
+        }
+        let (ha, hb) = (a.hash.get(), b.hash.get());
+        if ha != 0 && hb != 0 && ha != hb {
+            return false;
+        }
+        a.as_str() == b.as_str()
+    }
+}
+
+impl Eq for JsStr {}
+
+impl PartialOrd for JsStr {
+    fn partial_cmp(&self, other: &JsStr) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for JsStr {
+    fn cmp(&self, other: &JsStr) -> Ordering {
+        self.as_str().cmp(other.as_str())
+    }
+}
+
+impl PartialEq<str> for JsStr {
+    fn eq(&self, other: &str) -> bool {
+        self.as_str() == other
+    }
+}
+
+impl PartialEq<&str> for JsStr {
+    fn eq(&self, other: &&str) -> bool {
+        self.as_str() == *other
+    }
+}
+
+impl PartialEq<String> for JsStr {
+    fn eq(&self, other: &String) -> bool {
+        self.as_str() == other.as_str()
+    }
+}
+
+impl From<&str> for JsStr {
+    fn from(s: &str) -> JsStr {
+        JsStr::new(s)
+    }
+}
+
+impl From<String> for JsStr {
+    fn from(s: String) -> JsStr {
+        JsStr::inline(&s).unwrap_or_else(|| JsStr::flat(s.into_boxed_str()))
+    }
+}
+
+impl From<&String> for JsStr {
+    fn from(s: &String) -> JsStr {
+        JsStr::new(s)
+    }
+}
+
+impl From<&JsStr> for JsStr {
+    fn from(s: &JsStr) -> JsStr {
+        s.clone()
+    }
+}
+
+impl From<char> for JsStr {
+    fn from(c: char) -> JsStr {
+        let mut buf = [0u8; 4];
+        JsStr::new(c.encode_utf8(&mut buf))
+    }
+}
+
+impl From<JsStr> for String {
+    fn from(s: JsStr) -> String {
+        String::from(s.as_str())
+    }
+}
+
+impl fmt::Display for JsStr {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+impl fmt::Debug for JsStr {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Debug::fmt(self.as_str(), f)
+    }
+}
+
+/// Interned strings: one shared [`JsStr`] per distinct text.
+pub struct AtomTable {
+    atoms: BTreeSet<JsStr>,
+}
+
+impl AtomTable {
+    pub fn new() -> Self {
+        AtomTable { atoms: BTreeSet::new() }
+    }
+
+    pub fn len(&self) -> usize {
+        self.atoms.len()
+    }
+
+    /// The atom for `s`, created on first use.  Inline strings are their
+    /// own atoms and are not stored.
+    pub fn intern(&mut self, s: &str) -> JsStr {
+        if let Some(atom) = JsStr::inline(s) {
+            return atom;
+        }
+        if let Some(atom) = self.atoms.get(s) {
+            return atom.clone();
+        }
+        let atom = JsStr::new(s);
+        atom.hash();
+        self.atoms.insert(atom.clone());
+        atom
+    }
+
+    /// The atom with the text of `s`; `s` itself becomes the atom if the
+    /// text is new.
+    pub fn intern_str(&mut self, s: &JsStr) -> JsStr {
+        if let Repr::Inline { .. } = s.0 {
+            return s.clone();
+        }
+        if let Some(atom) = self.atoms.get(s.as_str()) {
+            return atom.clone();
+        }
+        s.hash();
+        self.atoms.insert(s.clone());
+        s.clone()
+    }
+
+    /// Intern every string constant of `chunk` and its nested functions.
+    pub fn intern_chunk(&mut self, chunk: &mut Chunk) {
+        for c in chunk.constants.iter_mut() {
+            match c {
+                Constant::String(s) => *s = self.intern_str(s),
+                Constant::Function(f) => self.intern_chunk(f),
+                Constant::Number(_) => {}
+            }
+        }
+    }
+}
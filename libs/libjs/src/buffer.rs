@@ -0,0 +1,218 @@
+//! Binary data: `ArrayBuffer` storage and the typed views over it.
+//!
+//! An `ArrayBuffer` is a [`ByteBuffer`], a shared `Vec<u8>`.  Typed arrays
+//! and `DataView`s are objects whose [`JsObject::view`] describes a window
+//! on such a buffer, so every view of one buffer sees the same bytes and
+//! native code can hand a `Vec<u8>` to scripts (or read one back) without
+//! copying it — see [`Vm::new_array_buffer`] and [`JsValue::view`].
+//!
+//! Buffers never resize, so a view's bounds are fixed when it is made and
+//! its `length`, `byteLength`, `byteOffset` and `buffer` are plain
+//! read-only properties.  Only indexed access goes through the view.
+//!
+//! [`JsObject::view`]: crate::value::JsObject::view
+//! [`Vm::new_array_buffer`]: crate::vm::Vm::new_array_buffer
+//! [`JsValue::view`]: crate::value::JsValue::view
+
+use alloc::rc::Rc;
+use alloc::vec::Vec;
+
+use core::cell::RefCell;
+
+use crate::vm::native_math::to_uint32;
+
+/// The bytes of an `ArrayBuffer`, shared by all views of it.
+pub type ByteBuffer = Rc<RefCell<Vec<u8>>>;
+
+/// Element type of a typed array (and of a `DataView` accessor).
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum TypedKind {
+    Int8,
+    Uint8,
+    Uint8Clamped,
+    Int16,
+    Uint16,
+    Int32,
+    Uint32,
+    Float32,
+    Float64,
+}
+
+impl TypedKind {
+    pub const ALL: [TypedKind; 9] = [
+        TypedKind::Int8,
+        TypedKind::Uint8,
+        TypedKind::Uint8Clamped,
+        TypedKind::Int16,
+        TypedKind::Uint16,
+        TypedKind::Int32,
+        TypedKind::Uint32,
+        TypedKind::Float32,
+        TypedKind::Float64,
+    ];
+
+    /// Constructor name, e.g. `Uint8Array`.
+    pub fn name(self) -> &'static str {
+        match self {
+            TypedKind::Int8 => "Int8Array",
+            TypedKind::Uint8 => "Uint8Array",
+            TypedKind::Uint8Clamped => "Uint8ClampedArray",
+            TypedKind::Int16 => "Int16Array",
+            TypedKind::Uint16 => "Uint16Array",
+            TypedKind::Int32 => "Int32Array",
+            TypedKind::Uint32 => "Uint32Array",
+            TypedKind::Float32 => "Float32Array",
+            TypedKind::Float64 => "Float64Array",
+        }
+    }
+
+    /// Index in [`TypedKind::ALL`].
+    pub fn index(self) -> usize {
+        self as usize
+    }
+
+    /// `BYTES_PER_ELEMENT`.
+    pub fn size(self) -> usize {
+        match self {
+            TypedKind::Int8 | TypedKind::Uint8 | TypedKind::Uint8Clamped => 1,
+            TypedKind::Int16 | TypedKind::Uint16 => 2,
+            TypedKind::Int32 | TypedKind::Uint32 | TypedKind::Float32 => 4,
+            TypedKind::Float64 => 8,
+        }
+    }
+
+    /// Decode one element from the first `size()` bytes of `b`.
+    pub fn read(self, b: &[u8], little: bool) -> f64 {
+        macro_rules! get {
+            ($t:ty, $n:expr) => {{
+                let mut raw = [0u8; $n];
+                raw.copy_from_slice(&b[..$n]);
+                if little { <$t>::from_le_bytes(raw) } else { <$t>::from_be_bytes(raw) }
+            }};
+        }
+        match self {
+            TypedKind::Int8 => b[0] as i8 as f64,
+            TypedKind::Uint8 | TypedKind::Uint8Clamped => b[0] as f64,
+            TypedKind::Int16 => get!(i16, 2) as f64,
+            TypedKind::Uint16 => get!(u16, 2) as f64,
+            TypedKind::Int32 => get!(i32, 4) as f64,
+            TypedKind::Uint32 => get!(u32, 4) as f64,
+            TypedKind::Float32 => get!(f32, 4) as f64,
+            TypedKind::Float64 => get!(f64, 8),
+        }
+    }
+
+    /// Encode `n` into the first `size()` bytes of `b`, with the spec's
+    /// conversions (modular for integers, clamped for `Uint8Clamped`).
+    pub fn write(self, b: &mut [u8], n: f64, little: bool) {
+        macro_rules! put {
+            ($v:expr) => {{
+                let v = $v;
+                let raw = if little { v.to_le_bytes() } else { v.to_be_bytes() };
+                b[..raw.len()].copy_from_slice(&raw);
+            }};
+        }
+        match self {
+            TypedKind::Int8 | TypedKind::Uint8 => b[0] = to_uint32(n) as u8,
+            TypedKind::Uint8Clamped => b[0] = clamp_u8(n),
+            TypedKind::Int16 | TypedKind::Uint16 => put!(to_uint32(n) as u16),
+            TypedKind::Int32 | TypedKind::Uint32 => put!(to_uint32(n)),
+            TypedKind::Float32 => put!(n as f32),
+            TypedKind::Float64 => put!(n),
+        }
+    }
+}
+
+/// ToUint8Clamp: round half to even, NaN to 0.
+fn clamp_u8(n: f64) -> u8 {
+    if !(n > 0.0) {
+        return 0;
+    }
+    if n >= 255.0 {
+        return 255;
+    }
+    let f = n as u32;
+    let frac = n - f as f64;
+    if frac > 0.5 || (frac == 0.5 && f % 2 == 1) {
+        (f + 1) as u8
+    } else {
+        f as u8
+    }
+}
+
+/// What a binary-data object is a view of.
+#[derive(Clone, Debug)]
+pub enum BufferView {
+    /// An `ArrayBuffer` itself.
+    Buffer(ByteBuffer),
+    /// A typed array of `length` elements starting at byte `offset`.
+    Typed { kind: TypedKind, buffer: ByteBuffer, offset: usize, length: usize },
+    /// A `DataView` of `length` bytes starting at byte `offset`.
+    Data { buffer: ByteBuffer, offset: usize, length: usize },
+}
+
+impl BufferView {
+    pub fn buffer(&self) -> &ByteBuffer {
+        match self {
+            BufferView::Buffer(b) => b,
+            BufferView::Typed { buffer, .. } | BufferView::Data { buffer, .. } => buffer,
+        }
+    }
+
+    pub fn byte_offset(&self) -> usize {
+        match self {
+            BufferView::Buffer(_) => 0,
+            BufferView::Typed { offset, .. } | BufferView::Data { offset, .. } => *offset,
+        }
+    }
+
+    pub fn byte_length(&self) -> usize {
+        match self {
+            BufferView::Buffer(b) => b.borrow().len(),
+            BufferView::Typed { kind, length, .. } => length * kind.size(),
+            BufferView::Data { length, .. } => *length,
+        }
+    }
+
+    /// Copy of the bytes in view.
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let start = self.byte_offset();
+        self.buffer().borrow()[start..start + self.byte_length()].to_vec()
+    }
+
+    /// Element `index` of a typed array.
+    #[inline]
+    pub fn get_index(&self, index: usize) -> Option<f64> {
+        match self {
+            BufferView::Typed { kind, buffer, offset, length } if index < *length => {
+                let at = offset + index * kind.size();
+                Some(kind.read(&buffer.borrow()[at..], true))
+            }
+            _ => None,
+        }
+    }
+
+    /// Store element `index` of a typed array; out-of-bounds stores are
+    /// ignored.  Returns `false` if this is not a typed array.
+    #[inline]
+    pub fn set_index(&self, index: usize, n: f64) -> bool {
+        match self {
+            BufferView::Typed { kind, buffer, offset, length } => {
+                if index < *length {
+                    let at = offset + index * kind.size();
+                    kind.write(&mut buffer.borrow_mut()[at..], n, true);
+                }
+                true
+            }
+            _ => false,
+        }
+    }
+
+    /// Number of elements of a typed array.
+    pub fn typed_len(&self) -> Option<usize> {
+        match self {
+            BufferView::Typed { length, .. } => Some(*length),
+            _ => None,
+        }
+    }
+}
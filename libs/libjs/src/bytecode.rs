@@ -2,9 +2,15 @@
 //!
 //! Opcodes for a stack-based virtual machine.
 
+use alloc::rc::Rc;
 use alloc::string::String;
 use alloc::vec::Vec;
 
+use core::cell::RefCell;
+
+use crate::atom::JsStr;
+use crate::vm::ic::{IcTable, InlineCache};
+
 /// A single bytecode instruction.
 #[derive(Debug, Clone)]
 pub enum Op {
@@ -97,10 +103,12 @@ pub enum Op {
     GetProp,
     /// Set property: stack = [..., object, key, value] → [..., value]
     SetProp,
-    /// Get property by name (constant pool index): stack = [..., object] → [..., value]
-    GetPropNamed(u16),
-    /// Set property by name: stack = [..., object, value] → [..., value]
-    SetPropNamed(u16),
+    /// Get property by name: GetPropNamed(name constant, inline cache slot).
+    /// Stack = [..., object] → [..., value]
+    GetPropNamed(u16, u16),
+    /// Set property by name: SetPropNamed(name constant, inline cache slot).
+    /// Stack = [..., object, value] → [..., value]
+    SetPropNamed(u16, u16),
     /// Create new empty object.
     NewObject,
     /// Create new array with N elements from stack.
@@ -200,6 +208,26 @@ pub enum Op {
     /// the same value.  Used for per-iteration `let` binding in `for` loops so that
     /// closures created in each iteration capture their own cell.
     CloneLocal(u16),
+
+    // ── Superinstructions (emitted by the optimizer only) ──
+    /// LoadLocal(a); LoadLocal(b).
+    LoadLocal2(u16, u16),
+    /// StoreLocal(slot); Pop.
+    StoreLocalPop(u16),
+    /// LoadLocal(slot); LoadConst(idx); Add.
+    AddLocalConst(u16, u16),
+    /// `slot++` / `++slot` as a statement: no value is pushed.
+    IncLocal(u16),
+    /// `slot--` / `--slot` as a statement: no value is pushed.
+    DecLocal(u16),
+    /// Lt; JumpIfFalse(offset).
+    JumpIfNotLt(i32),
+    /// Le; JumpIfFalse(offset).
+    JumpIfNotLe(i32),
+    /// Gt; JumpIfFalse(offset).
+    JumpIfNotGt(i32),
+    /// Ge; JumpIfFalse(offset).
+    JumpIfNotGe(i32),
 }
 
 /// Describes how a compiled function captures one upvalue from its enclosing scope.
@@ -227,6 +255,9 @@ pub struct Chunk {
     pub name: Option<String>,
     /// Upvalue capture descriptors — one entry per upvalue the function closes over.
     pub upvalues: Vec<UpvalueRef>,
+    /// Inline caches of the named property sites.  Shared by every clone of
+    /// the chunk, so all frames and closures of a function warm the same caches.
+    pub ics: IcTable,
 }
 
 impl Chunk {
@@ -238,7 +269,19 @@ impl Chunk {
             param_count: 0,
             name: None,
             upvalues: Vec::new(),
+            ics: Rc::new(RefCell::new(Vec::new())),
+        }
+    }
+
+    /// Allocate an inline cache slot for a named property site.  Past the
+    /// `u16` range, sites share the last slot (it just stops caching).
+    pub fn add_ic(&mut self) -> u16 {
+        let mut ics = self.ics.borrow_mut();
+        if ics.len() > u16::MAX as usize {
+            return u16::MAX;
         }
+        ics.push(InlineCache::Empty);
+        (ics.len() - 1) as u16
     }
 
     /// Add a constant and return its index.
@@ -288,7 +331,8 @@ impl Chunk {
 #[derive(Debug, Clone)]
 pub enum Constant {
     Number(f64),
-    String(String),
+    /// An atom (interned by the compiler and again by the VM on load).
+    String(JsStr),
     /// A nested function prototype.
     Function(Chunk),
 }
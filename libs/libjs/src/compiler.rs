@@ -5,8 +5,10 @@ use alloc::vec::Vec;
 use alloc::string::ToString;
 
 use crate::ast::*;
+use crate::atom::AtomTable;
 use crate::bytecode::{Chunk, Constant, Op, UpvalueRef};
 use crate::lexer::Lexer;
+use crate::optimizer;
 use crate::parser::Parser;
 
 /// How a name was resolved during compilation.
@@ -92,6 +94,10 @@ pub struct Compiler {
     /// `bind_ident` and `compile_pattern_binding` emit StoreGlobal instead
     /// of StoreLocal.  Mirrors JavaScript's var-hoisting-to-global behaviour.
     binding_is_global: bool,
+    /// Run the bytecode optimizer on every finished chunk (default on).
+    optimize: bool,
+    /// Atoms for every string constant, shared by all chunks compiled here.
+    atoms: AtomTable,
 }
 
 impl Compiler {
@@ -99,9 +105,16 @@ impl Compiler {
         Compiler {
             scopes: Vec::new(),
             binding_is_global: false,
+            optimize: true,
+            atoms: AtomTable::new(),
         }
     }
 
+    /// Turn the bytecode optimizer off, e.g. to compare against it.
+    pub fn set_optimize(&mut self, on: bool) {
+        self.optimize = on;
+    }
+
     /// Returns true when we are at the outermost (global) function scope,
     /// i.e. not inside any compiled function body.
     fn is_global_scope(&self) -> bool {
@@ -114,7 +127,7 @@ impl Compiler {
     /// is popped from the stack afterwards.
     fn bind_ident(&mut self, name: &str) {
         if self.binding_is_global {
-            let ci = self.add_const(Constant::String(name.to_string()));
+            let ci = self.add_str(name);
             self.emit(Op::StoreGlobal(ci));
             self.emit(Op::Pop);
         } else {
@@ -133,7 +146,11 @@ impl Compiler {
         // Implicit return undefined
         self.emit(Op::LoadUndefined);
         self.emit(Op::Return);
-        self.scopes.pop().unwrap().chunk
+        let mut chunk = self.scopes.pop().unwrap().chunk;
+        if self.optimize {
+            optimizer::optimize(&mut chunk);
+        }
+        chunk
     }
 
     fn scope(&self) -> &Scope {
@@ -148,10 +165,28 @@ impl Compiler {
         self.scope_mut().chunk.emit(op)
     }
 
+    /// Emit `GetPropNamed` with a fresh inline cache slot.
+    fn emit_get_named(&mut self, name_idx: u16) -> usize {
+        let ic = self.scope_mut().chunk.add_ic();
+        self.emit(Op::GetPropNamed(name_idx, ic))
+    }
+
+    /// Emit `SetPropNamed` with a fresh inline cache slot.
+    fn emit_set_named(&mut self, name_idx: u16) -> usize {
+        let ic = self.scope_mut().chunk.add_ic();
+        self.emit(Op::SetPropNamed(name_idx, ic))
+    }
+
     fn add_const(&mut self, c: Constant) -> u16 {
         self.scope_mut().chunk.add_const(c)
     }
 
+    /// Add a string constant, interned.
+    fn add_str(&mut self, s: &str) -> u16 {
+        let atom = self.atoms.intern(s);
+        self.add_const(Constant::String(atom))
+    }
+
     fn offset(&self) -> usize {
         self.scope().chunk.offset()
     }
@@ -222,7 +257,7 @@ impl Compiler {
             NameLookup::Local(slot) => { self.emit(Op::LoadLocal(slot)); }
             NameLookup::Upvalue(idx) => { self.emit(Op::LoadUpvalue(idx)); }
             NameLookup::Global => {
-                let ci = self.add_const(Constant::String(name.to_string()));
+                let ci = self.add_str(name);
                 self.emit(Op::LoadGlobal(ci));
             }
         }
@@ -242,7 +277,7 @@ impl Compiler {
                 self.emit(Op::Pop);
             }
             NameLookup::Global => {
-                let ci = self.add_const(Constant::String(name.to_string()));
+                let ci = self.add_str(name);
                 self.emit(Op::Dup);
                 self.emit(Op::StoreGlobal(ci));
                 self.emit(Op::Pop);
@@ -463,7 +498,7 @@ impl Compiler {
                 self.compile_function(Some(name), params, body, *is_async);
                 // At the global scope function declarations are global bindings.
                 if self.is_global_scope() {
-                    let ci = self.add_const(Constant::String(name.clone()));
+                    let ci = self.add_str(&name);
                     self.emit(Op::StoreGlobal(ci));
                     self.emit(Op::Pop);
                 } else {
@@ -475,7 +510,7 @@ impl Compiler {
             Stmt::ClassDecl { name, super_class, body } => {
                 self.compile_class(Some(name), super_class, body);
                 if self.is_global_scope() {
-                    let ci = self.add_const(Constant::String(name.clone()));
+                    let ci = self.add_str(&name);
                     self.emit(Op::StoreGlobal(ci));
                     self.emit(Op::Pop);
                 } else {
@@ -551,8 +586,8 @@ impl Compiler {
                         // Second Dup is the `this` for CallMethod.
                         self.emit(Op::Dup); // arr stays for final Pop
                         self.emit(Op::Dup); // this for CallMethod
-                        let slice_ci = self.add_const(Constant::String(String::from("slice")));
-                        self.emit(Op::GetPropNamed(slice_ci)); // [..., arr, slice_fn]
+                        let slice_ci = self.add_str("slice");
+                        self.emit_get_named(slice_ci); // [..., arr, slice_fn]
                         let i_ci = self.add_const(Constant::Number(i as f64));
                         self.emit(Op::LoadConst(i_ci));        // [..., arr, slice_fn, i]
                         self.emit(Op::CallMethod(1));           // [..., arr, rest_array]
@@ -589,8 +624,8 @@ impl Compiler {
                 continue;
             }
             self.emit(Op::Dup);
-            let name_idx = self.add_const(Constant::String(prop.key.clone()));
-            self.emit(Op::GetPropNamed(name_idx));
+            let name_idx = self.add_str(&prop.key);
+            self.emit_get_named(name_idx);
             self.compile_pattern_binding(&prop.value);
         }
 
@@ -601,7 +636,7 @@ impl Compiler {
                     // Stack: [..., src_obj] — Dup it, push excluded keys, emit ObjectRest.
                     self.emit(Op::Dup);
                     for key in &excluded_keys {
-                        let ki = self.add_const(Constant::String(key.clone()));
+                        let ki = self.add_str(&key);
                         self.emit(Op::LoadConst(ki));
                     }
                     let n = excluded_keys.len() as u8;
@@ -713,7 +748,7 @@ impl Compiler {
                     self.emit(Op::StoreLocal(slot));
                     self.emit(Op::Pop);
                 } else {
-                    let ci = self.add_const(Constant::String(name.clone()));
+                    let ci = self.add_str(&name);
                     self.emit(Op::StoreGlobal(ci));
                     self.emit(Op::Pop);
                 }
@@ -980,6 +1015,9 @@ impl Compiler {
             is_local: uv.is_local,
             index: uv.index,
         }).collect();
+        if self.optimize {
+            optimizer::optimize(&mut func_chunk);
+        }
         let ci = self.add_const(Constant::Function(func_chunk));
         self.emit(Op::Closure(ci));
 
@@ -987,7 +1025,7 @@ impl Compiler {
         // name as a global (simplified — avoids needing a scope wrapper object).
         if named_expr {
             if let Some(n) = name {
-                let ni = self.add_const(Constant::String(n.clone()));
+                let ni = self.add_str(&n);
                 self.emit(Op::Dup);
                 self.emit(Op::StoreGlobal(ni));
                 self.emit(Op::Pop);
@@ -1032,14 +1070,14 @@ impl Compiler {
         if let Some(super_slot) = super_local {
             // Stack: [..., Constructor]
             self.emit(Op::Dup);
-            let proto_idx = self.add_const(Constant::String(String::from("prototype")));
-            self.emit(Op::GetPropNamed(proto_idx));    // [..., Constructor, Constructor.prototype]
+            let proto_idx = self.add_str("prototype");
+            self.emit_get_named(proto_idx);    // [..., Constructor, Constructor.prototype]
             self.emit(Op::LoadLocal(super_slot));      // [..., Constructor, Constructor.prototype, SuperClass]
-            let proto_idx2 = self.add_const(Constant::String(String::from("prototype")));
-            self.emit(Op::GetPropNamed(proto_idx2));   // [..., Constructor, Constructor.prototype, SuperClass.prototype]
+            let proto_idx2 = self.add_str("prototype");
+            self.emit_get_named(proto_idx2);   // [..., Constructor, Constructor.prototype, SuperClass.prototype]
             // Set Constructor.prototype.__proto__ = SuperClass.prototype
-            let proto_key_idx = self.add_const(Constant::String(String::from("__proto__")));
-            self.emit(Op::SetPropNamed(proto_key_idx)); // [..., Constructor, SuperClass.prototype]
+            let proto_key_idx = self.add_str("__proto__");
+            self.emit_set_named(proto_key_idx); // [..., Constructor, SuperClass.prototype]
             self.emit(Op::Pop);                          // [..., Constructor]
         }
 
@@ -1058,15 +1096,15 @@ impl Compiler {
                     ClassMemberKind::Method { params, body } => {
                         self.emit(Op::Dup); // dup Constructor
                         self.compile_function(Some(&key_name), params, body, false);
-                        let ki = self.add_const(Constant::String(key_name));
-                        self.emit(Op::SetPropNamed(ki));
+                        let ki = self.add_str(&key_name);
+                        self.emit_set_named(ki);
                         self.emit(Op::Pop);
                     }
                     ClassMemberKind::Property { value } => {
                         self.emit(Op::Dup);
                         if let Some(v) = value { self.compile_expr(v); } else { self.emit(Op::LoadUndefined); }
-                        let ki = self.add_const(Constant::String(key_name));
-                        self.emit(Op::SetPropNamed(ki));
+                        let ki = self.add_str(&key_name);
+                        self.emit_set_named(ki);
                         self.emit(Op::Pop);
                     }
                     _ => {}
@@ -1077,14 +1115,14 @@ impl Compiler {
                     ClassMemberKind::Method { params, body } => {
                         // Stack before: [..., Constructor]
                         self.emit(Op::Dup); // [..., Constructor, Constructor]
-                        let proto_idx = self.add_const(Constant::String(String::from("prototype")));
-                        self.emit(Op::GetPropNamed(proto_idx));
+                        let proto_idx = self.add_str("prototype");
+                        self.emit_get_named(proto_idx);
                         // GetPropNamed pops Constructor-dup, pushes prototype
                         // Stack: [..., Constructor, Constructor.prototype]
                         self.compile_function(Some(&key_name), params, body, false);
                         // Stack: [..., Constructor, Constructor.prototype, methodFn]
-                        let ki = self.add_const(Constant::String(key_name));
-                        self.emit(Op::SetPropNamed(ki));
+                        let ki = self.add_str(&key_name);
+                        self.emit_set_named(ki);
                         // SetPropNamed pops methodFn+prototype, sets prop, pushes methodFn
                         // Stack: [..., Constructor, methodFn]
                         self.emit(Op::Pop); // pop methodFn
@@ -1157,14 +1195,14 @@ impl Compiler {
         parts.push(Ok(current));
 
         // Emit code: start with empty string, then + each part
-        let empty_ci = self.add_const(Constant::String(String::new()));
+        let empty_ci = self.add_str("");
         self.emit(Op::LoadConst(empty_ci));
 
         for part in &parts {
             match part {
                 Ok(text) => {
                     if !text.is_empty() {
-                        let ci = self.add_const(Constant::String(text.clone()));
+                        let ci = self.add_str(&text);
                         self.emit(Op::LoadConst(ci));
                         self.emit(Op::Add);
                     }
@@ -1195,7 +1233,7 @@ impl Compiler {
                 self.emit(Op::LoadConst(ci));
             }
             Expr::String(s) => {
-                let ci = self.add_const(Constant::String(s.clone()));
+                let ci = self.add_str(&s);
                 self.emit(Op::LoadConst(ci));
             }
             Expr::Template(s) => {
@@ -1255,8 +1293,8 @@ impl Compiler {
                         PropKey::Ident(name) | PropKey::String(name) => {
                             self.emit(Op::Dup);           // [obj, obj]
                             self.compile_expr(&prop.value); // [obj, obj, val]
-                            let ci = self.add_const(Constant::String(name.clone()));
-                            self.emit(Op::SetPropNamed(ci)); // [obj, val]
+                            let ci = self.add_str(&name);
+                            self.emit_set_named(ci); // [obj, val]
                             self.emit(Op::Pop);             // [obj]
                         }
                         PropKey::Number(n) => {
@@ -1281,8 +1319,8 @@ impl Compiler {
             }
             Expr::Member { object, property, .. } => {
                 self.compile_expr(object);
-                let ci = self.add_const(Constant::String(property.clone()));
-                self.emit(Op::GetPropNamed(ci));
+                let ci = self.add_str(&property);
+                self.emit_get_named(ci);
             }
             Expr::Index { object, index } => {
                 self.compile_expr(object);
@@ -1307,10 +1345,10 @@ impl Compiler {
                         // Stack layout: [..., this, SuperClass.prototype.method, arg1..argN]
                         self.emit(Op::LoadThis);
                         self.emit_load_name("$$super$$");
-                        let proto_ci = self.add_const(Constant::String(String::from("prototype")));
-                        self.emit(Op::GetPropNamed(proto_ci));
-                        let method_ci = self.add_const(Constant::String(property.clone()));
-                        self.emit(Op::GetPropNamed(method_ci));
+                        let proto_ci = self.add_str("prototype");
+                        self.emit_get_named(proto_ci);
+                        let method_ci = self.add_str(&property);
+                        self.emit_get_named(method_ci);
                         for arg in arguments { self.compile_expr(arg); }
                         self.emit(Op::CallMethod(arguments.len() as u8));
                     }
@@ -1318,8 +1356,8 @@ impl Compiler {
                         // Stack: [..., this_obj, method_fn, arg1, ..., argN]
                         self.compile_expr(object);   // push this
                         self.emit(Op::Dup);          // dup for GetPropNamed
-                        let ci = self.add_const(Constant::String(property.clone()));
-                        self.emit(Op::GetPropNamed(ci)); // pop dup, push method
+                        let ci = self.add_str(&property);
+                        self.emit_get_named(ci); // pop dup, push method
                         if Self::args_have_spread(arguments) {
                             self.compile_args_as_array(arguments);
                             self.emit(Op::CallMethodSpread);
@@ -1487,7 +1525,7 @@ impl Compiler {
                 match inner.as_ref() {
                     Expr::Member { object, property, .. } => {
                         self.compile_expr(object);
-                        let ci = self.add_const(Constant::String(property.clone()));
+                        let ci = self.add_str(&property);
                         self.emit(Op::LoadConst(ci));
                         self.emit(Op::Delete);
                     }
@@ -1522,8 +1560,8 @@ impl Compiler {
                 self.compile_expr(object);
                 self.emit(Op::Dup);
                 let skip = self.emit(Op::JumpIfNullish(0));
-                let ci = self.add_const(Constant::String(property.clone()));
-                self.emit(Op::GetPropNamed(ci));
+                let ci = self.add_str(&property);
+                self.emit_get_named(ci);
                 let end = self.emit(Op::Jump(0));
                 self.patch_jump(skip);
                 self.emit(Op::Pop);
@@ -1532,7 +1570,7 @@ impl Compiler {
             }
             Expr::TaggedTemplate { tag, template } => {
                 self.compile_expr(tag);
-                let ci = self.add_const(Constant::String(template.clone()));
+                let ci = self.add_str(&template);
                 self.emit(Op::LoadConst(ci));
                 self.emit(Op::NewArray(1));
                 self.emit(Op::Call(1));
@@ -1559,15 +1597,15 @@ impl Compiler {
                 self.compile_expr(object);
                 if *op != AssignOp::Assign {
                     self.emit(Op::Dup);
-                    let ci = self.add_const(Constant::String(property.clone()));
-                    self.emit(Op::GetPropNamed(ci));
+                    let ci = self.add_str(&property);
+                    self.emit_get_named(ci);
                     self.compile_expr(right);
                     self.emit_compound_op(op);
                 } else {
                     self.compile_expr(right);
                 }
-                let ci = self.add_const(Constant::String(property.clone()));
-                self.emit(Op::SetPropNamed(ci));
+                let ci = self.add_str(&property);
+                self.emit_set_named(ci);
             }
             Expr::Index { object, index } => {
                 self.compile_expr(object);
@@ -1621,10 +1659,9 @@ impl Compiler {
                             UpdateOp::Inc => { self.emit(Op::Inc); }
                             UpdateOp::Dec => { self.emit(Op::Dec); }
                         }
+                        // StoreLocal peeks: the new value is the prefix result.
                         self.emit(Op::StoreLocal(slot));
-                        if prefix {
-                            self.emit(Op::LoadLocal(slot)); // reload after store
-                        } else {
+                        if !prefix {
                             self.emit(Op::Pop); // pop stored value, old value remains
                         }
                     }
@@ -1638,14 +1675,12 @@ impl Compiler {
                             UpdateOp::Dec => { self.emit(Op::Dec); }
                         }
                         self.emit(Op::StoreUpvalue(idx));
-                        if prefix {
-                            self.emit(Op::LoadUpvalue(idx));
-                        } else {
+                        if !prefix {
                             self.emit(Op::Pop);
                         }
                     }
                     NameLookup::Global => {
-                        let ci = self.add_const(Constant::String(name.clone()));
+                        let ci = self.add_str(&name);
                         if !prefix {
                             self.emit(Op::LoadGlobal(ci));
                         }
@@ -1655,9 +1690,7 @@ impl Compiler {
                             UpdateOp::Dec => { self.emit(Op::Dec); }
                         }
                         self.emit(Op::StoreGlobal(ci));
-                        if prefix {
-                            self.emit(Op::LoadGlobal(ci));
-                        } else {
+                        if !prefix {
                             self.emit(Op::Pop);
                         }
                     }
@@ -1672,14 +1705,14 @@ impl Compiler {
                 // we emit pre-increment semantics (result = new_val) as a simplification.
                 self.compile_expr(object);
                 self.emit(Op::Dup);
-                let ci = self.add_const(Constant::String(property.clone()));
-                self.emit(Op::GetPropNamed(ci));
+                let ci = self.add_str(&property);
+                self.emit_get_named(ci);
                 match op {
                     UpdateOp::Inc => { self.emit(Op::Inc); }
                     UpdateOp::Dec => { self.emit(Op::Dec); }
                 }
-                let ci2 = self.add_const(Constant::String(property.clone()));
-                self.emit(Op::SetPropNamed(ci2));
+                let ci2 = self.add_str(&property);
+                self.emit_set_named(ci2);
                 // SetPropNamed pops [obj, new_val], pushes new_val — that is the expression result.
             }
             _ => {
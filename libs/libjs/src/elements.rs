@@ -0,0 +1,329 @@
+//! Array element storage specialized by element kind.
+//!
+//! Most arrays hold only small integers or only numbers, and boxing each
+//! of those in a [`JsValue`] costs 16 bytes and a tagged match per access.
+//! [`Elements`] keeps such arrays packed:
+//!
+//! - `Int`: every element is an integer that fits in an `i32`;
+//! - `Double`: every element is a number or `undefined`;
+//! - `Generic`: anything else.
+//!
+//! Kinds only widen (`Int` → `Double` → `Generic`), as in V8: an array that
+//! once held an object stays generic even after the object is removed, so
+//! hot code never flips an array back and forth.  `undefined` in a double
+//! array (e.g. the slots of `new Array(n)`) is a NaN with a payload no
+//! arithmetic produces; stored NaNs are canonicalized so the two cannot
+//! be confused.
+
+use alloc::vec::Vec;
+
+use crate::value::JsValue;
+
+/// Bit pattern of `undefined` in `Elements::Double`.
+const UNDEFINED_BITS: u64 = 0x7ff8_dead_0000_0001;
+
+/// Packed or generic array elements.
+#[derive(Clone, Debug)]
+pub enum Elements {
+    Int(Vec<i32>),
+    Double(Vec<f64>),
+    Generic(Vec<JsValue>),
+}
+
+impl Default for Elements {
+    fn default() -> Self {
+        Elements::Int(Vec::new())
+    }
+}
+
+/// `n` as an `i32` element, if that is lossless (`-0` is not).
+#[inline]
+fn as_int(n: f64) -> Option<i32> {
+    let i = n as i32;
+    if i as f64 == n && (i != 0 || n.is_sign_positive()) {
+        Some(i)
+    } else {
+        None
+    }
+}
+
+/// `v` as a `Double` element.
+#[inline]
+fn as_double(v: &JsValue) -> Option<f64> {
+    match v {
+        JsValue::Number(n) if n.is_nan() => Some(f64::NAN),
+        JsValue::Number(n) => Some(*n),
+        JsValue::Undefined => Some(f64::from_bits(UNDEFINED_BITS)),
+        _ => None,
+    }
+}
+
+#[inline]
+fn from_double(d: f64) -> JsValue {
+    if d.to_bits() == UNDEFINED_BITS {
+        JsValue::Undefined
+    } else {
+        JsValue::Number(d)
+    }
+}
+
+impl Elements {
+    pub fn new() -> Self {
+        Elements::default()
+    }
+
+    /// Pack `values` in the narrowest kind that holds them all.
+    pub fn from_vec(values: Vec<JsValue>) -> Self {
+        let mut ints = true;
+        for v in &values {
+            match v {
+                JsValue::Number(n) if ints && as_int(*n).is_some() => {}
+                JsValue::Number(_) | JsValue::Undefined => ints = false,
+                _ => return Elements::Generic(values),
+            }
+        }
+        if ints {
+            Elements::Int(values.iter().map(|v| as_int(v.to_number()).unwrap_or(0)).collect())
+        } else {
+            Elements::Double(values.iter().map(|v| as_double(v).unwrap_or(f64::NAN)).collect())
+        }
+    }
+
+    /// Name of the current kind, for diagnostics.
+    pub fn kind_name(&self) -> &'static str {
+        match self {
+            Elements::Int(_) => "int",
+            Elements::Double(_) => "double",
+            Elements::Generic(_) => "generic",
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        match self {
+            Elements::Int(v) => v.len(),
+            Elements::Double(v) => v.len(),
+            Elements::Generic(v) => v.len(),
+        }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    #[inline]
+    pub fn get(&self, index: usize) -> Option<JsValue> {
+        match self {
+            Elements::Int(v) => v.get(index).map(|&i| JsValue::Number(i as f64)),
+            Elements::Double(v) => v.get(index).map(|&d| from_double(d)),
+            Elements::Generic(v) => v.get(index).cloned(),
+        }
+    }
+
+    /// The boxed elements of a generic array; empty for packed kinds,
+    /// which cannot reference heap values.
+    pub fn values(&self) -> &[JsValue] {
+        match self {
+            Elements::Generic(v) => v,
+            _ => &[],
+        }
+    }
+
+    /// Widen to the narrowest kind that can also hold `value`.
+    fn widen_for(&mut self, value: &JsValue) {
+        let fits = match (&*self, value) {
+            (Elements::Generic(_), _) => true,
+            (Elements::Double(_), v) => as_double(v).is_some(),
+            (Elements::Int(_), JsValue::Number(n)) => as_int(*n).is_some(),
+            (Elements::Int(_), _) => false,
+        };
+        if fits {
+            return;
+        }
+        let widened = match core::mem::take(self) {
+            Elements::Int(v) if as_double(value).is_some() => {
+                Elements::Double(v.into_iter().map(|i| i as f64).collect())
+            }
+            Elements::Int(v) => {
+                Elements::Generic(v.into_iter().map(|i| JsValue::Number(i as f64)).collect())
+            }
+            Elements::Double(v) => Elements::Generic(v.into_iter().map(from_double).collect()),
+            generic => generic,
+        };
+        *self = widened;
+    }
+
+    /// Store `value` at `index`, which must be in bounds.
+    #[inline]
+    pub fn set(&mut self, index: usize, value: JsValue) {
+        if let (Elements::Int(v), JsValue::Number(n)) = (&mut *self, &value) {
+            if let Some(i) = as_int(*n) {
+                v[index] = i;
+                return;
+            }
+        }
+        self.widen_for(&value);
+        match self {
+            Elements::Int(v) => v[index] = as_int(value.to_number()).unwrap_or(0),
+            Elements::Double(v) => v[index] = as_double(&value).unwrap_or(f64::NAN),
+            Elements::Generic(v) => v[index] = value,
+        }
+    }
+
+    #[inline]
+    pub fn push(&mut self, value: JsValue) {
+        self.widen_for(&value);
+        match self {
+            Elements::Int(v) => v.push(as_int(value.to_number()).unwrap_or(0)),
+            Elements::Double(v) => v.push(as_double(&value).unwrap_or(f64::NAN)),
+            Elements::Generic(v) => v.push(value),
+        }
+    }
+
+    pub fn pop(&mut self) -> Option<JsValue> {
+        match self {
+            Elements::Int(v) => v.pop().map(|i| JsValue::Number(i as f64)),
+            Elements::Double(v) => v.pop().map(from_double),
+            Elements::Generic(v) => v.pop(),
+        }
+    }
+
+    pub fn insert(&mut self, index: usize, value: JsValue) {
+        self.widen_for(&value);
+        match self {
+            Elements::Int(v) => v.insert(index, as_int(value.to_number()).unwrap_or(0)),
+            Elements::Double(v) => v.insert(index, as_double(&value).unwrap_or(f64::NAN)),
+            Elements::Generic(v) => v.insert(index, value),
+        }
+    }
+
+    pub fn remove(&mut self, index: usize) -> JsValue {
+        match self {
+            Elements::Int(v) => JsValue::Number(v.remove(index) as f64),
+            Elements::Double(v) => from_double(v.remove(index)),
+            Elements::Generic(v) => v.remove(index),
+        }
+    }
+
+    pub fn truncate(&mut self, len: usize) {
+        match self {
+            Elements::Int(v) => v.truncate(len),
+            Elements::Double(v) => v.truncate(len),
+            Elements::Generic(v) => v.truncate(len),
+        }
+    }
+
+    /// Truncate or pad with `undefined` to `len` elements.
+    pub fn resize(&mut self, len: usize) {
+        if len <= self.len() {
+            self.truncate(len);
+            return;
+        }
+        self.widen_for(&JsValue::Undefined);
+        match self {
+            Elements::Int(_) => {}
+            Elements::Double(v) => v.resize(len, f64::from_bits(UNDEFINED_BITS)),
+            Elements::Generic(v) => v.resize(len, JsValue::Undefined),
+        }
+    }
+
+    pub fn clear(&mut self) {
+        self.truncate(0);
+    }
+
+    pub fn reverse(&mut self) {
+        match self {
+            Elements::Int(v) => v.reverse(),
+            Elements::Double(v) => v.reverse(),
+            Elements::Generic(v) => v.reverse(),
+        }
+    }
+
+    /// Remove `start..end` and return the removed elements.
+    pub fn drain(&mut self, start: usize, end: usize) -> Vec<JsValue> {
+        match self {
+            Elements::Int(v) => v.drain(start..end).map(|i| JsValue::Number(i as f64)).collect(),
+            Elements::Double(v) => v.drain(start..end).map(from_double).collect(),
+            Elements::Generic(v) => v.drain(start..end).collect(),
+        }
+    }
+
+    pub fn retain(&mut self, mut f: impl FnMut(&JsValue) -> bool) {
+        match self {
+            Elements::Int(v) => v.retain(|&i| f(&JsValue::Number(i as f64))),
+            Elements::Double(v) => v.retain(|&d| f(&from_double(d))),
+            Elements::Generic(v) => v.retain(|x| f(x)),
+        }
+    }
+
+    /// Append all of `other`, staying packed when both sides are.
+    pub fn extend_from(&mut self, other: &Elements) {
+        match (&mut *self, other) {
+            (Elements::Int(a), Elements::Int(b)) => a.extend_from_slice(b),
+            (Elements::Double(a), Elements::Double(b)) => a.extend_from_slice(b),
+            (Elements::Double(a), Elements::Int(b)) => a.extend(b.iter().map(|&i| i as f64)),
+            (Elements::Generic(a), Elements::Generic(b)) => a.extend_from_slice(b),
+            _ => {
+                for v in other.iter() {
+                    self.push(v);
+                }
+            }
+        }
+    }
+
+    /// Copy of `start..end` in the same kind.
+    pub fn slice(&self, start: usize, end: usize) -> Elements {
+        match self {
+            Elements::Int(v) => Elements::Int(v[start..end].to_vec()),
+            Elements::Double(v) => Elements::Double(v[start..end].to_vec()),
+            Elements::Generic(v) => Elements::Generic(v[start..end].to_vec()),
+        }
+    }
+
+    pub fn iter(&self) -> Iter<'_> {
+        Iter { elements: self, index: 0 }
+    }
+
+    pub fn to_vec(&self) -> Vec<JsValue> {
+        match self {
+            Elements::Generic(v) => v.clone(),
+            _ => self.iter().collect(),
+        }
+    }
+
+    /// Move the boxed values out, leaving the array empty.
+    pub fn take_values(&mut self) -> Vec<JsValue> {
+        match core::mem::take(self) {
+            Elements::Generic(v) => v,
+            _ => Vec::new(),
+        }
+    }
+}
+
+impl From<Vec<JsValue>> for Elements {
+    fn from(values: Vec<JsValue>) -> Self {
+        Elements::from_vec(values)
+    }
+}
+
+/// Iterator over elements as values.
+pub struct Iter<'a> {
+    elements: &'a Elements,
+    index: usize,
+}
+
+impl Iterator for Iter<'_> {
+    type Item = JsValue;
+
+    fn next(&mut self) -> Option<JsValue> {
+        let v = self.elements.get(self.index)?;
+        self.index += 1;
+        Some(v)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let n = self.elements.len() - self.index;
+        (n, Some(n))
+    }
+}
+
+impl ExactSizeIterator for Iter<'_> {}
@@ -4,8 +4,12 @@
 //! - Lexer/tokenizer
 //! - Recursive descent parser (full ES2020+ syntax)
 //! - AST (Abstract Syntax Tree) representation
-//! - Bytecode compiler (AST → opcodes)
-//! - Stack-based virtual machine with prototype chains
+//! - Bytecode compiler (AST → opcodes) with a peephole optimizer
+//! - Binary chunk serialization for caching compiled scripts
+//! - Stack-based virtual machine with a NaN-boxed operand stack and
+//!   prototype chains
+//! - Refcounted strings with ropes, slices and interned property names
+//! - Packed number arrays, ArrayBuffer, typed arrays and DataView
 //! - Built-in objects: Object, Array, String, Number, Math, JSON, console
 //! - Async/await and Promise support
 //!
@@ -33,13 +37,20 @@ pub mod ast;
 pub mod parser;
 pub mod bytecode;
 pub mod compiler;
+pub mod optimizer;
+pub mod serialize;
 pub mod vm;
 pub mod value;
+pub mod nanbox;
+pub mod shape;
+pub mod atom;
+pub mod elements;
+pub mod buffer;
 
 use alloc::string::String;
 use alloc::vec::Vec;
 
-pub use value::JsValue;
+pub use value::{JsStr, JsValue};
 pub use vm::Vm;
 pub use bytecode::Chunk;
 
@@ -71,6 +82,12 @@ impl JsEngine {
         self.vm.execute(chunk)
     }
 
+    /// Execute an already compiled chunk (from [`JsEngine::compile`] or
+    /// [`serialize::decode`]) and return the result.
+    pub fn execute(&mut self, chunk: Chunk) -> JsValue {
+        self.vm.execute(chunk)
+    }
+
     /// Set a global variable in the engine.
     pub fn set_global(&mut self, name: &str, value: JsValue) {
         self.vm.set_global(name, value);
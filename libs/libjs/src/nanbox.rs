@@ -0,0 +1,261 @@
+//! NaN-boxed values for the VM operand stack.
+//!
+//! A [`Value`] is one 64-bit word.  Numbers are stored as their IEEE bits;
+//! everything else lives in the NaN space no arithmetic produces (NaNs are
+//! canonicalized on the way in):
+//!
+//! ```text
+//! 0xFFF9 | 0..3         undefined, null, false, true
+//! 0xFFFA | ptr          Rc<RefCell<JsObject>>
+//! 0xFFFB | ptr          Rc<RefCell<JsArray>>
+//! 0xFFFC | ptr          Rc<RefCell<JsFunction>>
+//! 0xFFFD | ptr          heap JsStr node
+//! 0xFFFE | ptr          Rc<JsStr> holding an inline JsStr of 7..=14 bytes
+//! 0x7FF9 + len | bytes  string of up to 6 bytes, in the word itself
+//! ```
+//!
+//! Pointers are 48-bit user-space addresses and each one owns a strong
+//! reference, so the cycle collector sees exactly the counts it would for
+//! the equivalent [`JsValue`].
+//!
+//! `JsValue` remains the type of locals, properties and the native API;
+//! [`Value::from`] / [`Value::into_js`] convert at the boundary, and the
+//! interpreter only looks inside a `Value` on its number fast paths.  Code
+//! can move to `Value` an opcode or a builtin at a time.
+
+use alloc::rc::Rc;
+
+use core::cell::RefCell;
+use core::fmt;
+use core::mem::ManuallyDrop;
+
+use crate::atom::JsStr;
+use crate::value::{JsArray, JsFunction, JsObject, JsValue};
+
+const PAYLOAD: u64 = 0x0000_FFFF_FFFF_FFFF;
+const SIGN: u64 = 0x8000_0000_0000_0000;
+
+/// Words below this (ignoring the sign) are numbers.
+const BOXED_MIN: u64 = 0x7FF9_0000_0000_0000;
+const CANONICAL_NAN: u64 = 0x7FF8_0000_0000_0000;
+
+const TAG_SPECIAL: u64 = 0xFFF9 << 48;
+const TAG_OBJECT: u64 = 0xFFFA << 48;
+const TAG_ARRAY: u64 = 0xFFFB << 48;
+const TAG_FUNCTION: u64 = 0xFFFC << 48;
+const TAG_HEAP_STR: u64 = 0xFFFD << 48;
+const TAG_BOXED_STR: u64 = 0xFFFE << 48;
+const TAG_SHORT_STR: u64 = 0x7FF9 << 48;
+
+/// Longest string packed into the word.
+const SHORT_CAP: usize = 6;
+
+/// A JavaScript value in one word.
+#[repr(transparent)]
+pub struct Value(u64);
+
+impl Value {
+    pub const UNDEFINED: Value = Value(TAG_SPECIAL);
+    pub const NULL: Value = Value(TAG_SPECIAL | 1);
+    pub const FALSE: Value = Value(TAG_SPECIAL | 2);
+    pub const TRUE: Value = Value(TAG_SPECIAL | 3);
+
+    #[inline]
+    pub fn number(n: f64) -> Value {
+        if n.is_nan() {
+            Value(CANONICAL_NAN)
+        } else {
+            Value(n.to_bits())
+        }
+    }
+
+    #[inline]
+    pub fn bool(b: bool) -> Value {
+        if b { Value::TRUE } else { Value::FALSE }
+    }
+
+    #[inline]
+    pub fn is_number(&self) -> bool {
+        self.0 & !SIGN < BOXED_MIN
+    }
+
+    #[inline]
+    pub fn as_number(&self) -> Option<f64> {
+        if self.is_number() { Some(f64::from_bits(self.0)) } else { None }
+    }
+
+    #[inline]
+    pub fn is_undefined(&self) -> bool {
+        self.0 == Value::UNDEFINED.0
+    }
+
+    #[inline]
+    pub fn is_nullish(&self) -> bool {
+        self.0 == Value::UNDEFINED.0 || self.0 == Value::NULL.0
+    }
+
+    /// ToBoolean, without unboxing.
+    #[inline]
+    pub fn to_boolean(&self) -> bool {
+        if self.is_number() {
+            let n = f64::from_bits(self.0);
+            return n != 0.0 && !n.is_nan();
+        }
+        match self.tag() {
+            TAG_SPECIAL => self.0 == Value::TRUE.0,
+            // Only a short string can be empty.
+            t if t >= TAG_SHORT_STR && t & SIGN == 0 => self.short_len() > 0,
+            _ => true,
+        }
+    }
+
+    /// Add a reference to a packed value.
+    #[inline]
+    pub fn from_ref(v: &JsValue) -> Value {
+        match v {
+            JsValue::Undefined => Value::UNDEFINED,
+            JsValue::Null => Value::NULL,
+            JsValue::Bool(b) => Value::bool(*b),
+            JsValue::Number(n) => Value::number(*n),
+            _ => Value::from(v.clone()),
+        }
+    }
+
+    /// Unpack into a `JsValue`, moving this value's reference.
+    #[inline]
+    pub fn into_js(self) -> JsValue {
+        let this = ManuallyDrop::new(self);
+        // SAFETY: the reference owned by `this` moves into the result and
+        // `this` is never dropped.
+        unsafe { this.unpack() }
+    }
+
+    /// A `JsValue` copy, adding a reference.
+    #[inline]
+    pub fn to_js(&self) -> JsValue {
+        self.clone().into_js()
+    }
+
+    #[inline]
+    fn tag(&self) -> u64 {
+        self.0 & !PAYLOAD
+    }
+
+    #[inline]
+    fn ptr(&self) -> *const () {
+        (self.0 & PAYLOAD) as usize as *const ()
+    }
+
+    #[inline]
+    fn short_len(&self) -> usize {
+        ((self.tag() - TAG_SHORT_STR) >> 48) as usize
+    }
+
+    #[inline]
+    fn pack_ptr(tag: u64, p: *const ()) -> Value {
+        let addr = p as usize as u64;
+        debug_assert!(addr & !PAYLOAD == 0, "pointer outside the 48-bit payload");
+        Value(tag | addr)
+    }
+
+    /// Rebuild the `JsValue` that owns this word's reference.
+    ///
+    /// # Safety
+    /// The caller takes over the reference: `self` must not be dropped or
+    /// unpacked again unless a reference was added first.
+    unsafe fn unpack(&self) -> JsValue {
+        if self.is_number() {
+            return JsValue::Number(f64::from_bits(self.0));
+        }
+        match self.tag() {
+            TAG_SPECIAL => match self.0 & PAYLOAD {
+                0 => JsValue::Undefined,
+                1 => JsValue::Null,
+                2 => JsValue::Bool(false),
+                _ => JsValue::Bool(true),
+            },
+            TAG_OBJECT => JsValue::Object(Rc::from_raw(self.ptr() as *const RefCell<JsObject>)),
+            TAG_ARRAY => JsValue::Array(Rc::from_raw(self.ptr() as *const RefCell<JsArray>)),
+            TAG_FUNCTION => JsValue::Function(Rc::from_raw(self.ptr() as *const RefCell<JsFunction>)),
+            TAG_HEAP_STR => JsValue::String(JsStr::from_raw(self.ptr())),
+            TAG_BOXED_STR => {
+                let boxed = Rc::from_raw(self.ptr() as *const JsStr);
+                JsValue::String(Rc::try_unwrap(boxed).unwrap_or_else(|rc| (*rc).clone()))
+            }
+            _ => {
+                let len = self.short_len();
+                let bytes = (self.0 & PAYLOAD).to_le_bytes();
+                // SAFETY: packed from a `str` of `len` bytes.
+                JsValue::String(JsStr::new(core::str::from_utf8_unchecked(&bytes[..len])))
+            }
+        }
+    }
+}
+
+impl From<JsValue> for Value {
+    #[inline]
+    fn from(v: JsValue) -> Value {
+        match v {
+            JsValue::Undefined => Value::UNDEFINED,
+            JsValue::Null => Value::NULL,
+            JsValue::Bool(b) => Value::bool(b),
+            JsValue::Number(n) => Value::number(n),
+            JsValue::Object(o) => Value::pack_ptr(TAG_OBJECT, Rc::into_raw(o) as *const ()),
+            JsValue::Array(a) => Value::pack_ptr(TAG_ARRAY, Rc::into_raw(a) as *const ()),
+            JsValue::Function(f) => Value::pack_ptr(TAG_FUNCTION, Rc::into_raw(f) as *const ()),
+            JsValue::String(s) if s.len() <= SHORT_CAP => {
+                let mut bytes = [0u8; 8];
+                bytes[..s.len()].copy_from_slice(s.as_bytes());
+                Value(TAG_SHORT_STR + ((s.len() as u64) << 48) | u64::from_le_bytes(bytes))
+            }
+            JsValue::String(s) => match s.into_raw() {
+                Ok(p) => Value::pack_ptr(TAG_HEAP_STR, p),
+                Err(inline) => Value::pack_ptr(TAG_BOXED_STR, Rc::into_raw(Rc::new(inline)) as *const ()),
+            },
+        }
+    }
+}
+
+impl Clone for Value {
+    #[inline]
+    fn clone(&self) -> Value {
+        if self.is_number() {
+            return Value(self.0);
+        }
+        // SAFETY: pointer tags own a reference, so the pointee is alive.
+        unsafe {
+            match self.tag() {
+                TAG_OBJECT => Rc::increment_strong_count(self.ptr() as *const RefCell<JsObject>),
+                TAG_ARRAY => Rc::increment_strong_count(self.ptr() as *const RefCell<JsArray>),
+                TAG_FUNCTION => Rc::increment_strong_count(self.ptr() as *const RefCell<JsFunction>),
+                TAG_HEAP_STR => JsStr::retain_raw(self.ptr()),
+                TAG_BOXED_STR => Rc::increment_strong_count(self.ptr() as *const JsStr),
+                _ => {}
+            }
+        }
+        Value(self.0)
+    }
+}
+
+impl Drop for Value {
+    #[inline]
+    fn drop(&mut self) {
+        if self.is_number() || self.tag() == TAG_SPECIAL {
+            return;
+        }
+        // SAFETY: `self` is going away; its reference is released here.
+        drop(unsafe { self.unpack() });
+    }
+}
+
+impl Default for Value {
+    fn default() -> Value {
+        Value::UNDEFINED
+    }
+}
+
+impl fmt::Debug for Value {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt::Debug::fmt(&self.to_js(), f)
+    }
+}
@@ -0,0 +1,432 @@
+//! Bytecode optimizer.
+//!
+//! Runs over every chunk the compiler finishes, in three passes:
+//!
+//! 1. **simplify** — constant folding (`LoadConst a; LoadConst b; Mul` →
+//!    `LoadConst a*b`, cascading through whole constant expressions),
+//!    redundant `Dup`/`Pop` pairs around stores, pushes that are popped
+//!    right away, and dead stores (locals that are never read or captured,
+//!    such as an unused `arguments` array);
+//! 2. **jumps** — jump threading (a jump to a jump goes straight to the
+//!    final target, a jump to `Return` becomes `Return`), unreachable code
+//!    and jumps to the next instruction are removed;
+//! 3. **fuse** — common sequences become superinstructions (`LoadLocal2`,
+//!    `AddLocalConst`, `StoreLocalPop`, `IncLocal`, `JumpIfNotLt`, ...),
+//!    saving a dispatch and the stack traffic in between.
+//!
+//! While optimizing, jump offsets are absolute instruction indices.  A
+//! rewrite never merges an instruction that a jump lands on into the one
+//! before it, so every jump target keeps meaning the same program point.
+//!
+//! The implicit tail `Pop; LoadUndefined; Return` of a script is kept
+//! verbatim: hosts rewrite it to return the completion value of `eval`.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::atom::JsStr;
+use crate::bytecode::{Chunk, Constant, Op};
+use crate::vm::native_math::pow_f64;
+
+/// Hops followed when threading a jump through a chain of jumps.
+const MAX_THREAD: usize = 8;
+
+/// Longest sequence replaced by a superinstruction.
+const MAX_FUSED: usize = 6;
+
+/// `TryCatch` finally field without a target (offset 0 in encoded form).
+const NO_TARGET: i32 = i32::MIN;
+
+/// Optimize `chunk` in place.  Nested functions are optimized when they
+/// are compiled, before the enclosing chunk.
+pub fn optimize(chunk: &mut Chunk) {
+    let Some(code) = to_absolute(&chunk.code) else { return };
+    let live = live_locals(chunk, &code);
+    let code = simplify(chunk, code, &live);
+    let code = jumps(code);
+    let code = fuse(code);
+    chunk.code = to_relative(code);
+}
+
+// ── Jump targets ──
+
+fn for_each_target(op: &mut Op, mut f: impl FnMut(&mut i32)) {
+    match op {
+        Op::Jump(t) | Op::JumpIfTrue(t) | Op::JumpIfFalse(t) | Op::JumpIfNullish(t)
+        | Op::JumpIfNotLt(t) | Op::JumpIfNotLe(t) | Op::JumpIfNotGt(t) | Op::JumpIfNotGe(t) => f(t),
+        Op::TryCatch(catch, finally) => {
+            f(catch);
+            if *finally != NO_TARGET {
+                f(finally);
+            }
+        }
+        _ => {}
+    }
+}
+
+/// Offsets → absolute indices; `None` if a target is out of range.
+fn to_absolute(code: &[Op]) -> Option<Vec<Op>> {
+    let len = code.len() as i32;
+    let mut out = Vec::with_capacity(code.len());
+    let mut ok = true;
+    for (i, op) in code.iter().enumerate() {
+        let mut op = op.clone();
+        if let Op::TryCatch(_, finally) = &mut op {
+            if *finally == 0 {
+                *finally = NO_TARGET;
+            }
+        }
+        for_each_target(&mut op, |t| {
+            *t += i as i32 + 1;
+            ok &= *t >= 0 && *t <= len;
+        });
+        out.push(op);
+    }
+    if ok { Some(out) } else { None }
+}
+
+fn to_relative(mut code: Vec<Op>) -> Vec<Op> {
+    for (i, op) in code.iter_mut().enumerate() {
+        for_each_target(op, |t| *t -= i as i32 + 1);
+        if let Op::TryCatch(_, finally) = op {
+            if *finally == NO_TARGET {
+                *finally = 0;
+            }
+        }
+    }
+    code
+}
+
+/// `labels[i]`: some jump lands on instruction `i` (or it is pinned).
+fn labels(code: &[Op]) -> Vec<bool> {
+    let mut labels = alloc::vec![false; code.len() + 1];
+    for op in code {
+        let mut op = op.clone();
+        for_each_target(&mut op, |t| labels[*t as usize] = true);
+    }
+    for l in &mut labels[pinned_tail(code)..] {
+        *l = true;
+    }
+    labels
+}
+
+/// Start of the script tail kept verbatim (see the module docs).
+fn pinned_tail(code: &[Op]) -> usize {
+    let n = code.len();
+    if n >= 3
+        && matches!(code[n - 3], Op::Pop)
+        && matches!(code[n - 2], Op::LoadUndefined)
+        && matches!(code[n - 1], Op::Return)
+    {
+        n - 3
+    } else {
+        n
+    }
+}
+
+/// Output of a pass, with the new index of every input instruction.
+struct Rewrite {
+    out: Vec<Op>,
+    label: Vec<bool>,
+    map: Vec<usize>,
+    /// A label of dropped instructions, moved to the next one emitted.
+    pending: bool,
+}
+
+impl Rewrite {
+    fn new(len: usize) -> Self {
+        Rewrite {
+            out: Vec::with_capacity(len),
+            label: Vec::with_capacity(len),
+            map: Vec::with_capacity(len + 1),
+            pending: false,
+        }
+    }
+
+    /// Begin the next input instruction; returns whether a jump lands on
+    /// it (or on an instruction dropped just before it).
+    fn start(&mut self, labeled: bool) -> bool {
+        self.map.push(self.out.len());
+        self.pending |= labeled;
+        self.pending
+    }
+
+    fn push(&mut self, op: Op) {
+        self.out.push(op);
+        self.label.push(core::mem::replace(&mut self.pending, false));
+    }
+
+    /// The last `n` outputs, if no jump lands inside them (the first may
+    /// be a target).
+    fn tail(&self, n: usize) -> Option<&[Op]> {
+        let len = self.out.len();
+        if len < n || self.label[len - n + 1..].iter().any(|&l| l) {
+            return None;
+        }
+        Some(&self.out[len - n..])
+    }
+
+    /// Replace the last `n` outputs with `op`, keeping the first's label.
+    fn replace(&mut self, n: usize, op: Op) {
+        let len = self.out.len();
+        self.out.truncate(len - n + 1);
+        self.label.truncate(len - n + 1);
+        self.out[len - n] = op;
+    }
+
+    /// Remove the last output; a jump to it now lands on what follows.
+    fn drop_last(&mut self) {
+        self.out.pop();
+        self.pending |= self.label.pop().unwrap_or(false);
+    }
+
+    fn finish(mut self) -> Vec<Op> {
+        self.map.push(self.out.len());
+        let map = self.map;
+        for op in &mut self.out {
+            for_each_target(op, |t| *t = map[*t as usize] as i32);
+        }
+        self.out
+    }
+}
+
+// ── Pass 1: simplify ──
+
+/// `live[slot]`: the local is read, or captured by a nested function.
+fn live_locals(chunk: &Chunk, code: &[Op]) -> Vec<bool> {
+    let mut live = alloc::vec![false; chunk.local_count as usize];
+    let mut mark = |slot: u16| {
+        if let Some(l) = live.get_mut(slot as usize) {
+            *l = true;
+        }
+    };
+    for op in code {
+        match op {
+            Op::LoadLocal(s) | Op::CloneLocal(s) => mark(*s),
+            _ => {}
+        }
+    }
+    for c in &chunk.constants {
+        if let Constant::Function(f) = c {
+            for uv in f.upvalues.iter().filter(|uv| uv.is_local) {
+                mark(uv.index);
+            }
+        }
+    }
+    live
+}
+
+/// Pushes without side effects, so `push; Pop` does nothing.
+fn is_pure_push(op: &Op) -> bool {
+    matches!(
+        op,
+        Op::LoadConst(_) | Op::LoadUndefined | Op::LoadNull | Op::LoadTrue | Op::LoadFalse
+            | Op::LoadLocal(_) | Op::LoadUpvalue(_) | Op::LoadThis | Op::LoadSelf
+            | Op::LoadArgsArray(_) | Op::Dup
+    )
+}
+
+fn simplify(chunk: &mut Chunk, code: Vec<Op>, live: &[bool]) -> Vec<Op> {
+    let labels = labels(&code);
+    let mut rw = Rewrite::new(code.len());
+    for (i, op) in code.into_iter().enumerate() {
+        let labeled = rw.start(labels[i]);
+        if labeled {
+            rw.push(op);
+            continue;
+        }
+        match op {
+            Op::Nop => {}
+            Op::Pop => simplify_pop(&mut rw, live),
+            Op::Neg => match rw.tail(1) {
+                Some([Op::LoadConst(a)]) => match number(chunk, *a) {
+                    Some(a) => {
+                        let k = chunk.add_const(Constant::Number(-a));
+                        rw.replace(1, Op::LoadConst(k));
+                    }
+                    None => rw.push(op),
+                },
+                _ => rw.push(op),
+            },
+            _ => {
+                let folded = match rw.tail(2) {
+                    Some([Op::LoadConst(a), Op::LoadConst(b)]) => fold(chunk, &op, *a, *b),
+                    _ => None,
+                };
+                match folded {
+                    Some(k) => rw.replace(2, Op::LoadConst(k)),
+                    None => rw.push(op),
+                }
+            }
+        }
+    }
+    rw.finish()
+}
+
+/// An unlabeled `Pop` against the instructions before it.
+fn simplify_pop(rw: &mut Rewrite, live: &[bool]) {
+    // `Dup; Store; Pop` → `Store` (stores peek).
+    if let Some([Op::Dup, store @ (Op::StoreLocal(_) | Op::StoreGlobal(_) | Op::StoreUpvalue(_))]) = rw.tail(2) {
+        let store = store.clone();
+        rw.replace(2, store);
+        return;
+    }
+    // Dead store: the value is popped and the local never read.
+    if let Some(&Op::StoreLocal(slot)) = rw.out.last() {
+        if !live.get(slot as usize).copied().unwrap_or(true) {
+            rw.drop_last();
+        }
+    }
+    match rw.out.last() {
+        Some(last) if is_pure_push(last) && !rw.pending => rw.drop_last(),
+        _ => rw.push(Op::Pop),
+    }
+}
+
+fn number(chunk: &Chunk, idx: u16) -> Option<f64> {
+    match chunk.constants.get(idx as usize)? {
+        Constant::Number(n) => Some(*n),
+        _ => None,
+    }
+}
+
+/// Fold `LoadConst a; LoadConst b; op`, with the VM's semantics.
+fn fold(chunk: &mut Chunk, op: &Op, a: u16, b: u16) -> Option<u16> {
+    if let (Op::Add, Some(Constant::String(sa)), Some(Constant::String(sb))) =
+        (op, chunk.constants.get(a as usize), chunk.constants.get(b as usize))
+    {
+        let mut s = String::with_capacity(sa.len() + sb.len());
+        s.push_str(sa);
+        s.push_str(sb);
+        return Some(chunk.add_const(Constant::String(JsStr::from(s))));
+    }
+    let (x, y) = (number(chunk, a)?, number(chunk, b)?);
+    let (ix, iy) = (x as i32, y as i32);
+    let r = match op {
+        Op::Add => x + y,
+        Op::Sub => x - y,
+        Op::Mul => x * y,
+        Op::Div => x / y,
+        Op::Mod => x % y,
+        Op::Exp => pow_f64(x, y),
+        Op::BitAnd => (ix & iy) as f64,
+        Op::BitOr => (ix | iy) as f64,
+        Op::BitXor => (ix ^ iy) as f64,
+        Op::Shl => (ix << (iy & 31)) as f64,
+        Op::Shr => (ix >> (iy & 31)) as f64,
+        Op::UShr => ((x as u32) >> ((y as u32) & 31)) as f64,
+        _ => return None,
+    };
+    Some(chunk.add_const(Constant::Number(r)))
+}
+
+// ── Pass 2: jumps ──
+
+fn jumps(mut code: Vec<Op>) -> Vec<Op> {
+    let len = code.len();
+
+    // Threading.
+    for i in 0..len {
+        let mut op = code[i].clone();
+        if matches!(op, Op::TryCatch(..)) {
+            continue;
+        }
+        for_each_target(&mut op, |t| {
+            for _ in 0..MAX_THREAD {
+                match code.get(*t as usize) {
+                    Some(Op::Jump(next)) if *next != *t => *t = *next,
+                    _ => break,
+                }
+            }
+        });
+        if let Op::Jump(t) = op {
+            if matches!(code.get(t as usize), Some(Op::Return)) {
+                op = Op::Return;
+            }
+        }
+        code[i] = op;
+    }
+
+    // Reachability from the entry and the exception handlers in reach.
+    let mut keep = alloc::vec![false; len];
+    let mut work = alloc::vec![0usize];
+    while let Some(i) = work.pop() {
+        if i >= len || keep[i] {
+            continue;
+        }
+        keep[i] = true;
+        let mut op = code[i].clone();
+        for_each_target(&mut op, |t| work.push(*t as usize));
+        if !matches!(op, Op::Jump(_) | Op::Return | Op::Throw) {
+            work.push(i + 1);
+        }
+    }
+    for k in &mut keep[pinned_tail(&code)..] {
+        *k = true;
+    }
+
+    // Jumps to the next instruction kept.
+    let mut next_kept = alloc::vec![len; len + 1];
+    for i in (0..len).rev() {
+        next_kept[i] = if keep[i] { i } else { next_kept[i + 1] };
+    }
+    for i in 0..len {
+        if let Op::Jump(t) = code[i] {
+            if keep[i] && next_kept[t as usize] == next_kept[i + 1] {
+                keep[i] = false;
+            }
+        }
+    }
+
+    let mut rw = Rewrite::new(len);
+    for (i, op) in code.into_iter().enumerate() {
+        rw.start(false);
+        if keep[i] {
+            rw.push(op);
+        }
+    }
+    rw.finish()
+}
+
+// ── Pass 3: superinstructions ──
+
+fn fuse(code: Vec<Op>) -> Vec<Op> {
+    let labels = labels(&code);
+    let mut rw = Rewrite::new(code.len());
+    let mut i = 0;
+    while i < code.len() {
+        // A window may only start at a label.
+        let window = labels[i + 1..].iter().take(MAX_FUSED - 1).take_while(|&&l| !l).count() + 1;
+        let (op, used) = superinstruction(&code[i..i + window.min(code.len() - i)]);
+        for k in 0..used {
+            rw.start(labels[i + k]);
+        }
+        rw.push(op);
+        i += used;
+    }
+    rw.finish()
+}
+
+/// The longest superinstruction at the start of `w` (which no jump lands
+/// inside), and the instructions it replaces.
+fn superinstruction(w: &[Op]) -> (Op, usize) {
+    match w {
+        [Op::LoadLocal(a), Op::LoadLocal(b), inc @ (Op::Inc | Op::Dec), Op::StoreLocal(c), Op::Pop, Op::Pop, ..]
+            if a == b && b == c =>
+        {
+            (if matches!(inc, Op::Inc) { Op::IncLocal(*a) } else { Op::DecLocal(*a) }, 6)
+        }
+        [Op::LoadLocal(a), inc @ (Op::Inc | Op::Dec), Op::StoreLocal(b), Op::Pop, ..] if a == b => {
+            (if matches!(inc, Op::Inc) { Op::IncLocal(*a) } else { Op::DecLocal(*a) }, 4)
+        }
+        [Op::LoadLocal(s), Op::LoadConst(k), Op::Add, ..] => (Op::AddLocalConst(*s, *k), 3),
+        [Op::StoreLocal(s), Op::Pop, ..] => (Op::StoreLocalPop(*s), 2),
+        [Op::Lt, Op::JumpIfFalse(t), ..] => (Op::JumpIfNotLt(*t), 2),
+        [Op::Le, Op::JumpIfFalse(t), ..] => (Op::JumpIfNotLe(*t), 2),
+        [Op::Gt, Op::JumpIfFalse(t), ..] => (Op::JumpIfNotGt(*t), 2),
+        [Op::Ge, Op::JumpIfFalse(t), ..] => (Op::JumpIfNotGe(*t), 2),
+        [Op::LoadLocal(a), Op::LoadLocal(b), ..] => (Op::LoadLocal2(*a, *b), 2),
+        [op, ..] => (op.clone(), 1),
+        [] => (Op::Nop, 1),
+    }
+}
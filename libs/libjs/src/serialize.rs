@@ -0,0 +1,360 @@
+//! Binary serialization of compiled [`Chunk`]s.
+//!
+//! Lets a host cache compiled scripts and skip lexing, parsing and
+//! compiling when the same source is seen again.  The format is private to
+//! one build of libjs: it starts with a magic and [`FORMAT_VERSION`], and
+//! [`decode`] rejects anything else, so a stale cache is simply a miss.
+//!
+//! Layout (all integers little-endian):
+//!
+//! ```text
+//! file     := "AJBC" version:u16 chunk
+//! chunk    := name:opt_str local_count:u16 param_count:u16
+//!             upvalues:u32 (is_local:u8 index:u16)*
+//!             ic_count:u32
+//!             constants:u32 constant*
+//!             ops:u32 op*
+//! constant := 0 f64 | 1 str | 2 chunk
+//! str      := len:u32 utf8
+//! op       := tag:u8 operand*
+//! ```
+//!
+//! Inline caches are not stored, only their count: a decoded chunk starts
+//! with cold caches.  String constants are plain strings; the VM interns
+//! them when the chunk is executed.
+
+use alloc::rc::Rc;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use core::cell::RefCell;
+
+use crate::atom::JsStr;
+use crate::bytecode::{Chunk, Constant, Op, UpvalueRef};
+use crate::vm::ic::InlineCache;
+
+/// Bumped whenever [`Op`] or the layout changes.
+pub const FORMAT_VERSION: u16 = 1;
+
+const MAGIC: &[u8; 4] = b"AJBC";
+
+/// Deepest function nesting [`decode`] accepts.
+const MAX_DEPTH: usize = 256;
+
+/// Serialize `chunk` and all nested functions.
+pub fn encode(chunk: &Chunk) -> Vec<u8> {
+    let mut w = Writer { out: Vec::with_capacity(64 + chunk.code.len() * 3) };
+    w.out.extend_from_slice(MAGIC);
+    w.u16(FORMAT_VERSION);
+    w.chunk(chunk);
+    w.out
+}
+
+/// Deserialize a chunk written by [`encode`].  Returns `None` for data from
+/// another format version or truncated/corrupt input.
+pub fn decode(bytes: &[u8]) -> Option<Chunk> {
+    let mut r = Reader { buf: bytes, pos: 0 };
+    if r.take(4)? != MAGIC || r.u16()? != FORMAT_VERSION {
+        return None;
+    }
+    let chunk = r.chunk(0)?;
+    if r.pos != bytes.len() {
+        return None;
+    }
+    Some(chunk)
+}
+
+// ── Writer ──
+
+struct Writer {
+    out: Vec<u8>,
+}
+
+impl Writer {
+    fn u8(&mut self, v: u8) {
+        self.out.push(v);
+    }
+
+    fn u16(&mut self, v: u16) {
+        self.out.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn u32(&mut self, v: u32) {
+        self.out.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn i32(&mut self, v: i32) {
+        self.out.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn f64(&mut self, v: f64) {
+        self.out.extend_from_slice(&v.to_bits().to_le_bytes());
+    }
+
+    fn str(&mut self, s: &str) {
+        self.u32(s.len() as u32);
+        self.out.extend_from_slice(s.as_bytes());
+    }
+
+    fn chunk(&mut self, chunk: &Chunk) {
+        match &chunk.name {
+            Some(name) => {
+                self.u8(1);
+                self.str(name);
+            }
+            None => self.u8(0),
+        }
+        self.u16(chunk.local_count);
+        self.u16(chunk.param_count);
+
+        self.u32(chunk.upvalues.len() as u32);
+        for uv in &chunk.upvalues {
+            self.u8(uv.is_local as u8);
+            self.u16(uv.index);
+        }
+
+        self.u32(chunk.ics.borrow().len() as u32);
+
+        self.u32(chunk.constants.len() as u32);
+        for c in &chunk.constants {
+            match c {
+                Constant::Number(n) => {
+                    self.u8(0);
+                    self.f64(*n);
+                }
+                Constant::String(s) => {
+                    self.u8(1);
+                    self.str(s.as_str());
+                }
+                Constant::Function(f) => {
+                    self.u8(2);
+                    self.chunk(f);
+                }
+            }
+        }
+
+        self.u32(chunk.code.len() as u32);
+        for op in &chunk.code {
+            put_op(self, op);
+        }
+    }
+}
+
+// ── Reader ──
+
+struct Reader<'a> {
+    buf: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, n: usize) -> Option<&'a [u8]> {
+        let end = self.pos.checked_add(n)?;
+        let s = self.buf.get(self.pos..end)?;
+        self.pos = end;
+        Some(s)
+    }
+
+    fn u8(&mut self) -> Option<u8> {
+        Some(self.take(1)?[0])
+    }
+
+    fn u16(&mut self) -> Option<u16> {
+        let b = self.take(2)?;
+        Some(u16::from_le_bytes([b[0], b[1]]))
+    }
+
+    fn u32(&mut self) -> Option<u32> {
+        let b = self.take(4)?;
+        Some(u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+    }
+
+    fn i32(&mut self) -> Option<i32> {
+        Some(self.u32()? as i32)
+    }
+
+    fn f64(&mut self) -> Option<f64> {
+        let b = self.take(8)?;
+        let mut raw = [0u8; 8];
+        raw.copy_from_slice(b);
+        Some(f64::from_bits(u64::from_le_bytes(raw)))
+    }
+
+    fn str(&mut self) -> Option<&'a str> {
+        let len = self.u32()? as usize;
+        core::str::from_utf8(self.take(len)?).ok()
+    }
+
+    /// A count of items at least `min_size` bytes each, checked against the
+    /// remaining input so corrupt data cannot request a huge allocation.
+    fn count(&mut self, min_size: usize) -> Option<usize> {
+        let n = self.u32()? as usize;
+        if n.checked_mul(min_size)? > self.buf.len() - self.pos {
+            return None;
+        }
+        Some(n)
+    }
+
+    fn chunk(&mut self, depth: usize) -> Option<Chunk> {
+        if depth > MAX_DEPTH {
+            return None;
+        }
+        let mut chunk = Chunk::new();
+        chunk.name = match self.u8()? {
+            0 => None,
+            1 => Some(String::from(self.str()?)),
+            _ => return None,
+        };
+        chunk.local_count = self.u16()?;
+        chunk.param_count = self.u16()?;
+
+        let n = self.count(3)?;
+        chunk.upvalues.reserve_exact(n);
+        for _ in 0..n {
+            let is_local = self.u8()? != 0;
+            let index = self.u16()?;
+            chunk.upvalues.push(UpvalueRef { is_local, index });
+        }
+
+        let n = self.u32()? as usize;
+        if n > u16::MAX as usize + 1 {
+            return None;
+        }
+        let mut ics = Vec::with_capacity(n);
+        ics.resize_with(n, || InlineCache::Empty);
+        chunk.ics = Rc::new(RefCell::new(ics));
+
+        let n = self.count(1)?;
+        chunk.constants.reserve_exact(n);
+        for _ in 0..n {
+            let c = match self.u8()? {
+                0 => Constant::Number(self.f64()?),
+                1 => Constant::String(JsStr::from(self.str()?)),
+                2 => Constant::Function(self.chunk(depth + 1)?),
+                _ => return None,
+            };
+            chunk.constants.push(c);
+        }
+
+        let n = self.count(1)?;
+        chunk.code.reserve_exact(n);
+        for _ in 0..n {
+            chunk.code.push(get_op(self)?);
+        }
+        Some(chunk)
+    }
+}
+
+// ── Opcodes ──
+
+/// Defines `put_op` / `get_op` from one table of tags, so the two
+/// directions cannot disagree.  Tags are part of the format: append new
+/// opcodes and bump [`FORMAT_VERSION`] when changing existing ones.
+macro_rules! op_codec {
+    ($($tag:literal => $name:ident $(($($f:ident: $t:ident),*))?,)*) => {
+        fn put_op(w: &mut Writer, op: &Op) {
+            match op {
+                $(Op::$name $(($($f),*))? => {
+                    w.u8($tag);
+                    $($(w.$t(*$f);)*)?
+                })*
+            }
+        }
+
+        fn get_op(r: &mut Reader) -> Option<Op> {
+            Some(match r.u8()? {
+                $($tag => Op::$name $(($(r.$t()?),*))?,)*
+                _ => return None,
+            })
+        }
+    };
+}
+
+op_codec! {
+    0 => LoadConst(a: u16),
+    1 => LoadUndefined,
+    2 => LoadNull,
+    3 => LoadTrue,
+    4 => LoadFalse,
+    5 => Pop,
+    6 => Dup,
+    7 => LoadLocal(a: u16),
+    8 => StoreLocal(a: u16),
+    9 => LoadGlobal(a: u16),
+    10 => StoreGlobal(a: u16),
+    11 => LoadUpvalue(a: u16),
+    12 => StoreUpvalue(a: u16),
+    13 => Add,
+    14 => Sub,
+    15 => Mul,
+    16 => Div,
+    17 => Mod,
+    18 => Exp,
+    19 => Neg,
+    20 => Pos,
+    21 => BitAnd,
+    22 => BitOr,
+    23 => BitXor,
+    24 => BitNot,
+    25 => Shl,
+    26 => Shr,
+    27 => UShr,
+    28 => Eq,
+    29 => Ne,
+    30 => StrictEq,
+    31 => StrictNe,
+    32 => Lt,
+    33 => Le,
+    34 => Gt,
+    35 => Ge,
+    36 => Not,
+    37 => Jump(a: i32),
+    38 => JumpIfTrue(a: i32),
+    39 => JumpIfFalse(a: i32),
+    40 => JumpIfNullish(a: i32),
+    41 => Call(a: u8),
+    42 => CallMethod(a: u8),
+    43 => Return,
+    44 => Closure(a: u16),
+    45 => GetProp,
+    46 => SetProp,
+    47 => GetPropNamed(a: u16, b: u16),
+    48 => SetPropNamed(a: u16, b: u16),
+    49 => NewObject,
+    50 => NewArray(a: u16),
+    51 => New(a: u8),
+    52 => Typeof,
+    53 => Void,
+    54 => Delete,
+    55 => InstanceOf,
+    56 => In,
+    57 => GetIterator,
+    58 => IterNext,
+    59 => TryCatch(a: i32, b: i32),
+    60 => TryEnd,
+    61 => Throw,
+    62 => Inc,
+    63 => Dec,
+    64 => LoadThis,
+    65 => Spread,
+    66 => ObjectSpread,
+    67 => ArrayPush,
+    68 => LoadArgsArray(a: u16),
+    69 => CallSpread,
+    70 => CallMethodSpread,
+    71 => LoadSelf,
+    72 => Debugger,
+    73 => Await,
+    74 => Nop,
+    75 => ObjectRest(a: u8),
+    76 => CloneLocal(a: u16),
+    77 => LoadLocal2(a: u16, b: u16),
+    78 => StoreLocalPop(a: u16),
+    79 => AddLocalConst(a: u16, b: u16),
+    80 => IncLocal(a: u16),
+    81 => DecLocal(a: u16),
+    82 => JumpIfNotLt(a: i32),
+    83 => JumpIfNotLe(a: i32),
+    84 => JumpIfNotGt(a: i32),
+    85 => JumpIfNotGe(a: i32),
+}
@@ -0,0 +1,301 @@
+//! Hidden classes (shapes) and slot-indexed property storage.
+//!
+//! A [`Shape`] is an immutable list of property keys; the position of a
+//! key is the index of its value in the object's slot vector.  Adding a
+//! key moves the object along a transition to a child shape, and the
+//! transitions are shared, so objects built the same way (same keys in
+//! the same order) end up with the same shape.  That lets the VM's inline
+//! caches remember "shape → slot" instead of looking keys up by name.
+//!
+//! The empty layout has no shape to transition from: objects first meet
+//! at a shared shape through the inline cache of the site that adds their
+//! first key.
+//!
+//! Objects with many keys, or that had a key deleted, switch to
+//! dictionary mode: a private index owned by the object.  Every layout has
+//! a [`shape id`](PropertyMap::shape_id); equal ids imply the same key →
+//! slot mapping.  A dictionary takes a fresh id whenever its key set
+//! changes, so caches keyed on ids stay sound in both modes.
+//!
+//! Keys are [`JsStr`]s shared with the strings that created them, usually
+//! atoms from a chunk's constant pool; [`PropertyMap::find_key`] compares
+//! those by pointer before falling back to the text.
+
+use alloc::collections::BTreeMap;
+use alloc::rc::{Rc, Weak};
+use alloc::vec::Vec;
+
+use core::cell::RefCell;
+use core::fmt;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::atom::JsStr;
+use crate::value::Property;
+
+/// Shape id of an object without properties.
+pub const EMPTY_SHAPE: u64 = 0;
+
+/// Keys kept in shaped mode; one more switches the object to a dictionary.
+/// Lookups in a shape are a linear key scan, which beats a tree below this.
+const MAX_SHAPED_KEYS: usize = 16;
+
+/// Transitions recorded per shape.  Objects used as hash maps with
+/// arbitrary keys would otherwise grow the tree without bound.
+const MAX_TRANSITIONS: usize = 32;
+
+/// Ids are never reused (64 bits do not wrap in practice).
+static NEXT_SHAPE_ID: AtomicU64 = AtomicU64::new(EMPTY_SHAPE + 1);
+
+fn next_id() -> u64 {
+    NEXT_SHAPE_ID.fetch_add(1, Ordering::Relaxed)
+}
+
+/// An immutable property layout.
+pub struct Shape {
+    id: u64,
+    keys: Vec<JsStr>,
+    /// Children, one per added key.  Weak: a shape no object uses any
+    /// more dies with its subtree.
+    transitions: RefCell<Vec<Weak<Shape>>>,
+}
+
+impl Shape {
+    fn with_keys(keys: Vec<JsStr>) -> Rc<Shape> {
+        Rc::new(Shape { id: next_id(), keys, transitions: RefCell::new(Vec::new()) })
+    }
+
+    pub fn id(&self) -> u64 {
+        self.id
+    }
+
+    pub fn len(&self) -> usize {
+        self.keys.len()
+    }
+
+    pub fn find(&self, key: &str) -> Option<usize> {
+        self.keys.iter().position(|k| k.as_str() == key)
+    }
+
+    pub fn find_key(&self, key: &JsStr) -> Option<usize> {
+        self.keys.iter().position(|k| k == key)
+    }
+
+    /// The shape with `key` appended, shared with earlier objects that
+    /// took the same transition.
+    fn transition(self: &Rc<Self>, key: &JsStr) -> Rc<Shape> {
+        let mut transitions = self.transitions.borrow_mut();
+        let mut found = None;
+        transitions.retain(|weak| match weak.upgrade() {
+            Some(child) => {
+                if found.is_none() && child.keys.last() == Some(key) {
+                    found = Some(child);
+                }
+                true
+            }
+            None => false,
+        });
+        if let Some(child) = found {
+            return child;
+        }
+        let mut keys = Vec::with_capacity(self.keys.len() + 1);
+        keys.extend(self.keys.iter().cloned());
+        keys.push(key.clone());
+        let child = Shape::with_keys(keys);
+        if transitions.len() < MAX_TRANSITIONS {
+            transitions.push(Rc::downgrade(&child));
+        }
+        child
+    }
+}
+
+#[derive(Clone)]
+enum Layout {
+    /// `None` is the empty layout ([`EMPTY_SHAPE`]).
+    Shaped(Option<Rc<Shape>>),
+    Dictionary {
+        id: u64,
+        keys: Vec<JsStr>,
+        index: BTreeMap<JsStr, u32>,
+    },
+}
+
+/// Own properties of an object, in insertion order.
+///
+/// The map API mirrors the `BTreeMap<String, Property>` it replaces; the
+/// slot-level methods are for the inline caches.
+#[derive(Clone)]
+pub struct PropertyMap {
+    layout: Layout,
+    slots: Vec<Property>,
+}
+
+impl PropertyMap {
+    pub fn new() -> Self {
+        PropertyMap { layout: Layout::Shaped(None), slots: Vec::new() }
+    }
+
+    /// Identifies the key → slot mapping (see the module docs).
+    #[inline]
+    pub fn shape_id(&self) -> u64 {
+        match &self.layout {
+            Layout::Shaped(None) => EMPTY_SHAPE,
+            Layout::Shaped(Some(shape)) => shape.id,
+            Layout::Dictionary { id, .. } => *id,
+        }
+    }
+
+    /// The shared shape, unless empty or in dictionary mode.
+    pub fn shape(&self) -> Option<&Rc<Shape>> {
+        match &self.layout {
+            Layout::Shaped(shape) => shape.as_ref(),
+            Layout::Dictionary { .. } => None,
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.slots.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.slots.is_empty()
+    }
+
+    /// Slot index of `key`.
+    #[inline]
+    pub fn find(&self, key: &str) -> Option<usize> {
+        match &self.layout {
+            Layout::Shaped(None) => None,
+            Layout::Shaped(Some(shape)) => shape.find(key),
+            Layout::Dictionary { index, .. } => index.get(key).map(|&i| i as usize),
+        }
+    }
+
+    /// Slot index of `key`, comparing keys by pointer first.
+    #[inline]
+    pub fn find_key(&self, key: &JsStr) -> Option<usize> {
+        match &self.layout {
+            Layout::Shaped(None) => None,
+            Layout::Shaped(Some(shape)) => shape.find_key(key),
+            Layout::Dictionary { index, .. } => index.get(key).map(|&i| i as usize),
+        }
+    }
+
+    #[inline]
+    pub fn slot(&self, slot: usize) -> &Property {
+        &self.slots[slot]
+    }
+
+    #[inline]
+    pub fn slot_mut(&mut self, slot: usize) -> &mut Property {
+        &mut self.slots[slot]
+    }
+
+    pub fn get(&self, key: &str) -> Option<&Property> {
+        self.find(key).map(|i| &self.slots[i])
+    }
+
+    pub fn get_mut(&mut self, key: &str) -> Option<&mut Property> {
+        self.find(key).map(move |i| &mut self.slots[i])
+    }
+
+    pub fn contains_key(&self, key: &str) -> bool {
+        self.find(key).is_some()
+    }
+
+    /// Insert or replace; returns the previous property.
+    pub fn insert(&mut self, key: JsStr, prop: Property) -> Option<Property> {
+        if let Some(i) = self.find_key(&key) {
+            return Some(core::mem::replace(&mut self.slots[i], prop));
+        }
+        match &mut self.layout {
+            Layout::Shaped(shape) if self.slots.len() < MAX_SHAPED_KEYS => {
+                let next = match shape {
+                    Some(s) => s.transition(&key),
+                    None => Shape::with_keys(alloc::vec![key]),
+                };
+                *shape = Some(next);
+            }
+            Layout::Shaped(_) => {
+                self.to_dictionary();
+                return self.insert(key, prop);
+            }
+            Layout::Dictionary { id, keys, index } => {
+                index.insert(key.clone(), keys.len() as u32);
+                keys.push(key);
+                *id = next_id();
+            }
+        }
+        self.slots.push(prop);
+        None
+    }
+
+    /// Append a property whose layout is known: `next` must be the
+    /// transition of this map's shape by the new key (as recorded by an
+    /// inline cache for this shape id).
+    pub fn push_with_shape(&mut self, next: Rc<Shape>, prop: Property) {
+        debug_assert_eq!(next.len(), self.slots.len() + 1);
+        self.layout = Layout::Shaped(Some(next));
+        self.slots.push(prop);
+    }
+
+    pub fn remove(&mut self, key: &str) -> Option<Property> {
+        let i = self.find(key)?;
+        self.to_dictionary();
+        if let Layout::Dictionary { id, keys, index } = &mut self.layout {
+            keys.remove(i);
+            index.remove(key);
+            for slot in index.values_mut() {
+                if *slot as usize > i {
+                    *slot -= 1;
+                }
+            }
+            *id = next_id();
+        }
+        Some(self.slots.remove(i))
+    }
+
+    fn to_dictionary(&mut self) {
+        let keys: Vec<JsStr> = match &self.layout {
+            Layout::Dictionary { .. } => return,
+            Layout::Shaped(None) => Vec::new(),
+            Layout::Shaped(Some(shape)) => shape.keys.clone(),
+        };
+        let index = keys.iter().enumerate().map(|(i, k)| (k.clone(), i as u32)).collect();
+        self.layout = Layout::Dictionary { id: next_id(), keys, index };
+    }
+
+    fn key_slice(&self) -> &[JsStr] {
+        match &self.layout {
+            Layout::Shaped(None) => &[],
+            Layout::Shaped(Some(shape)) => &shape.keys,
+            Layout::Dictionary { keys, .. } => keys,
+        }
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = (&JsStr, &Property)> {
+        self.key_slice().iter().zip(self.slots.iter())
+    }
+
+    pub fn keys(&self) -> impl Iterator<Item = &JsStr> {
+        self.key_slice().iter()
+    }
+
+    pub fn values(&self) -> impl Iterator<Item = &Property> {
+        self.slots.iter()
+    }
+}
+
+impl<'a> IntoIterator for &'a PropertyMap {
+    type Item = (&'a JsStr, &'a Property);
+    type IntoIter = core::iter::Zip<core::slice::Iter<'a, JsStr>, core::slice::Iter<'a, Property>>;
+
+    fn into_iter(self) -> Self::IntoIter {
+        self.key_slice().iter().zip(self.slots.iter())
+    }
+}
+
+impl fmt::Debug for PropertyMap {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_map().entries(self.iter()).finish()
+    }
+}
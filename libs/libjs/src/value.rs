@@ -13,20 +13,26 @@ use alloc::format;
 use core::cell::RefCell;
 use core::fmt;
 
+use crate::buffer::BufferView;
 use crate::bytecode::Chunk;
+use crate::elements::Elements;
+use crate::shape::PropertyMap;
+
+pub use crate::atom::JsStr;
 
 /// A JavaScript value.
 ///
 /// Objects, Arrays, and Functions use Rc for reference semantics:
 /// cloning a JsValue only bumps the reference count, so mutations
-/// through one handle are visible through all others.
+/// through one handle are visible through all others.  Strings are
+/// immutable [`JsStr`]s, which are refcounted the same way.
 #[derive(Clone)]
 pub enum JsValue {
     Undefined,
     Null,
     Bool(bool),
     Number(f64),
-    String(String),
+    String(JsStr),
     Object(Rc<RefCell<JsObject>>),
     Array(Rc<RefCell<JsArray>>),
     Function(Rc<RefCell<JsFunction>>),
@@ -60,7 +66,8 @@ impl fmt::Debug for JsValue {
 /// A JavaScript object (property map).
 #[derive(Clone, Debug)]
 pub struct JsObject {
-    pub properties: BTreeMap<String, Property>,
+    /// Own properties, slot-indexed by shape (see [`crate::shape`]).
+    pub properties: PropertyMap,
     pub prototype: Option<Rc<RefCell<JsObject>>>,
     pub internal_tag: Option<String>,
     /// The `[[PrimitiveValue]]` for wrapper objects (Boolean, Number, String).
@@ -70,6 +77,9 @@ pub struct JsObject {
     /// Optional hook called when a property is set. Args: (userdata, key, value).
     pub set_hook: Option<fn(*mut u8, &str, &JsValue)>,
     pub set_hook_data: *mut u8,
+    /// Bytes behind an `ArrayBuffer`, typed array or `DataView` (see
+    /// [`crate::buffer`]).
+    pub view: Option<Box<BufferView>>,
 }
 
 /// A property descriptor (simplified).
@@ -113,23 +123,25 @@ impl Property {
 impl JsObject {
     pub fn new() -> Self {
         JsObject {
-            properties: BTreeMap::new(),
+            properties: PropertyMap::new(),
             prototype: None,
             internal_tag: None,
             primitive_value: None,
             set_hook: None,
             set_hook_data: core::ptr::null_mut(),
+            view: None,
         }
     }
 
     pub fn with_tag(tag: &str) -> Self {
         JsObject {
-            properties: BTreeMap::new(),
+            properties: PropertyMap::new(),
             prototype: None,
             internal_tag: Some(String::from(tag)),
             primitive_value: None,
             set_hook: None,
             set_hook_data: core::ptr::null_mut(),
+            view: None,
         }
     }
 
@@ -143,15 +155,16 @@ impl JsObject {
         JsValue::Undefined
     }
 
-    pub fn set(&mut self, key: String, value: JsValue) {
+    pub fn set(&mut self, key: impl Into<JsStr>, value: JsValue) {
+        let key = key.into();
         if let Some(hook) = self.set_hook {
             hook(self.set_hook_data, &key, &value);
         }
         self.properties.insert(key, Property::data(value));
     }
 
-    pub fn set_hidden(&mut self, key: String, value: JsValue) {
-        self.properties.insert(key, Property::hidden(value));
+    pub fn set_hidden(&mut self, key: impl Into<JsStr>, value: JsValue) {
+        self.properties.insert(key.into(), Property::hidden(value));
     }
 
     pub fn has(&self, key: &str) -> bool {
@@ -177,7 +190,7 @@ impl JsObject {
         self.properties.remove(key).is_some()
     }
 
-    pub fn keys(&self) -> Vec<String> {
+    pub fn keys(&self) -> Vec<JsStr> {
         self.properties
             .iter()
             .filter(|(_, p)| p.enumerable)
@@ -189,34 +202,42 @@ impl JsObject {
 /// A JavaScript array.
 #[derive(Clone, Debug)]
 pub struct JsArray {
-    pub elements: Vec<JsValue>,
+    /// Elements, packed by kind (see [`crate::elements`]).
+    pub elements: Elements,
     pub properties: BTreeMap<String, Property>,
 }
 
 impl JsArray {
     pub fn new() -> Self {
         JsArray {
-            elements: Vec::new(),
+            elements: Elements::new(),
             properties: BTreeMap::new(),
         }
     }
 
     pub fn from_vec(elements: Vec<JsValue>) -> Self {
         JsArray {
-            elements,
+            elements: Elements::from_vec(elements),
             properties: BTreeMap::new(),
         }
     }
 
+    #[inline]
     pub fn get(&self, index: usize) -> JsValue {
-        self.elements.get(index).cloned().unwrap_or(JsValue::Undefined)
+        self.elements.get(index).unwrap_or(JsValue::Undefined)
     }
 
+    #[inline]
     pub fn set(&mut self, index: usize, value: JsValue) {
-        while self.elements.len() <= index {
-            self.elements.push(JsValue::Undefined);
+        let len = self.elements.len();
+        if index == len {
+            self.elements.push(value);
+            return;
+        }
+        if index > len {
+            self.elements.resize(index + 1);
         }
-        self.elements[index] = value;
+        self.elements.set(index, value);
     }
 
     pub fn push(&mut self, value: JsValue) {
@@ -314,6 +335,16 @@ impl JsValue {
         matches!(self, JsValue::Function(_))
     }
 
+    /// The binary view behind an `ArrayBuffer`, typed array or `DataView`
+    /// value.  The clone shares the buffer: writes through it are visible
+    /// to the script.
+    pub fn view(&self) -> Option<BufferView> {
+        match self {
+            JsValue::Object(o) => o.borrow().view.as_deref().cloned(),
+            _ => None,
+        }
+    }
+
     // ── Type conversions (ECMAScript abstract operations) ──
 
     /// ToBoolean
@@ -348,8 +379,19 @@ impl JsValue {
             JsValue::Bool(true) => String::from("true"),
             JsValue::Bool(false) => String::from("false"),
             JsValue::Number(n) => format_number(*n),
-            JsValue::String(s) => s.clone(),
-            JsValue::Object(_) => String::from("[object Object]"),
+            JsValue::String(s) => String::from(s.as_str()),
+            JsValue::Object(o) => {
+                let o = o.borrow();
+                match o.view.as_deref() {
+                    Some(view @ BufferView::Typed { length, .. }) => {
+                        let parts: Vec<String> = (0..*length)
+                            .map(|i| format_number(view.get_index(i).unwrap_or(0.0)))
+                            .collect();
+                        parts.join(",")
+                    }
+                    _ => String::from("[object Object]"),
+                }
+            }
             JsValue::Array(a) => {
                 let arr = a.borrow();
                 let parts: Vec<String> = arr.elements.iter().map(|v| v.to_js_string()).collect();
@@ -373,6 +415,14 @@ impl JsValue {
         }
     }
 
+    /// ToString as a [`JsStr`]: strings are shared, not copied.
+    pub fn to_js_str(&self) -> JsStr {
+        match self {
+            JsValue::String(s) => s.clone(),
+            _ => JsStr::from(self.to_js_string()),
+        }
+    }
+
     /// typeof operator result
     pub fn type_of(&self) -> &'static str {
         match self {
@@ -446,7 +496,15 @@ impl JsValue {
     /// Get a property (works on objects, arrays, strings).
     pub fn get_property(&self, key: &str) -> JsValue {
         match self {
-            JsValue::Object(obj) => obj.borrow().get(key),
+            JsValue::Object(obj) => {
+                let o = obj.borrow();
+                if let (Some(view), Some(idx)) = (&o.view, parse_index(key)) {
+                    if view.typed_len().is_some() {
+                        return view.get_index(idx).map(JsValue::Number).unwrap_or(JsValue::Undefined);
+                    }
+                }
+                o.get(key)
+            }
             JsValue::Array(arr) => {
                 let a = arr.borrow();
                 if key == "length" {
@@ -466,9 +524,7 @@ impl JsValue {
                 }
                 if let Some(idx) = parse_index(key) {
                     if let Some(ch) = s.chars().nth(idx) {
-                        let mut buf = String::new();
-                        buf.push(ch);
-                        return JsValue::String(buf);
+                        return JsValue::String(JsStr::from(ch));
                     }
                 }
                 JsValue::Undefined
@@ -478,10 +534,17 @@ impl JsValue {
     }
 
     /// Set a property.
-    pub fn set_property(&self, key: String, value: JsValue) {
+    pub fn set_property(&self, key: impl Into<JsStr>, value: JsValue) {
+        let key = key.into();
         match self {
             JsValue::Object(obj) => {
-                obj.borrow_mut().set(key, value);
+                let mut o = obj.borrow_mut();
+                if let (Some(view), Some(idx)) = (&o.view, parse_index(&key)) {
+                    if view.set_index(idx, value.to_number()) {
+                        return;
+                    }
+                }
+                o.set(key, value);
             }
             JsValue::Array(arr) => {
                 let mut a = arr.borrow_mut();
@@ -489,18 +552,14 @@ impl JsValue {
                     a.set(idx, value);
                 } else if key == "length" {
                     if let JsValue::Number(n) = &value {
-                        let new_len = *n as usize;
-                        a.elements.truncate(new_len);
-                        while a.elements.len() < new_len {
-                            a.elements.push(JsValue::Undefined);
-                        }
+                        a.elements.resize(*n as usize);
                     }
                 } else {
-                    a.properties.insert(key, Property::data(value));
+                    a.properties.insert(String::from(key), Property::data(value));
                 }
             }
             JsValue::Function(f) => {
-                f.borrow_mut().own_props.insert(key, value);
+                f.borrow_mut().own_props.insert(String::from(key), value);
             }
             _ => {} // silently ignore
         }
@@ -140,8 +140,8 @@ impl Vm {
         {
             let mut p = self.error_proto.borrow_mut();
             p.prototype = Some(self.object_proto.clone());
-            p.set(String::from("name"), JsValue::String(String::from("Error")));
-            p.set(String::from("message"), JsValue::String(String::new()));
+            p.set(String::from("name"), JsValue::String(JsStr::from("Error")));
+            p.set(String::from("message"), JsValue::String(JsStr::from("")));
             p.set(String::from("toString"), native_fn("toString", native_error::error_to_string));
         }
     }
@@ -219,6 +219,9 @@ impl Vm {
         self.set_global("clearTimeout", native_fn("clearTimeout", native_timer::clear_timeout));
         self.set_global("clearInterval", native_fn("clearInterval", native_timer::clear_interval));
 
+        // ── ArrayBuffer, typed arrays, DataView ──
+        self.init_buffers();
+
         // ── Symbol ──
         let symbol_ctor = native_fn("Symbol", native_symbol::ctor_symbol);
         native_symbol::install_well_known_symbols(&symbol_ctor);
@@ -244,6 +247,7 @@ impl Vm {
         console.set_property(String::from("error"), native_fn("error", native_console::console_error));
         console.set_property(String::from("info"), native_fn("info", native_console::console_log));
         console.set_property(String::from("debug"), native_fn("debug", native_console::console_log));
+        console.set_property(String::from("heap"), native_fn("heap", native_console::console_heap));
         self.set_global("console", console);
     }
 
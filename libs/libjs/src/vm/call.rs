@@ -4,6 +4,7 @@ use alloc::rc::Rc;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
+use crate::nanbox::Value;
 use crate::value::*;
 use super::{Vm, CallFrame};
 
@@ -11,15 +12,13 @@ impl Vm {
     /// Regular function call: Stack = [..., callee, arg1..argN]
     pub fn call_function(&mut self, argc: usize) {
         if self.stack.len() < argc + 1 {
-            self.stack.push(JsValue::Undefined);
+            self.push(JsValue::Undefined);
             return;
         }
         let args_start = self.stack.len() - argc;
-        let callee_idx = args_start - 1;
 
-        let callee = self.stack[callee_idx].clone();
-        let args: Vec<JsValue> = self.stack[args_start..].to_vec();
-        self.stack.truncate(callee_idx);
+        let args: Vec<JsValue> = self.stack.drain(args_start..).map(Value::into_js).collect();
+        let callee = self.pop();
 
         self.current_this = JsValue::Undefined;
         self.invoke_function(&callee, &args, JsValue::Undefined);
@@ -28,17 +27,14 @@ impl Vm {
     /// Method call: Stack = [..., this_obj, method_fn, arg1..argN]
     pub fn call_method(&mut self, argc: usize) {
         if self.stack.len() < argc + 2 {
-            self.stack.push(JsValue::Undefined);
+            self.push(JsValue::Undefined);
             return;
         }
         let args_start = self.stack.len() - argc;
-        let method_idx = args_start - 1;
-        let this_idx = method_idx - 1;
 
-        let args: Vec<JsValue> = self.stack[args_start..].to_vec();
-        let callee = self.stack[method_idx].clone();
-        let this_val = self.stack[this_idx].clone();
-        self.stack.truncate(this_idx);
+        let args: Vec<JsValue> = self.stack.drain(args_start..).map(Value::into_js).collect();
+        let callee = self.pop();
+        let this_val = self.pop();
 
         self.current_this = this_val.clone();
         self.invoke_function(&callee, &args, this_val);
@@ -62,10 +58,10 @@ impl Vm {
                         // Check if the native function signalled an exception.
                         if let Some(exc) = self.pending_exception.take() {
                             if !self.handle_exception(exc) {
-                                self.stack.push(JsValue::Undefined);
+                                self.push(JsValue::Undefined);
                             }
                         } else {
-                            self.stack.push(result);
+                            self.push(result);
                         }
                     }
                     FnKind::Bytecode(chunk) => {
@@ -95,7 +91,7 @@ impl Vm {
             }
             _ => {
                 self.log_engine("[libjs] WARN: attempted to call non-function");
-                self.stack.push(JsValue::Undefined);
+                self.push(JsValue::Undefined);
             }
         }
     }
@@ -103,15 +99,13 @@ impl Vm {
     /// `new Constructor(args)` — creates a new object and calls constructor.
     pub fn new_object(&mut self, argc: usize) {
         if self.stack.len() < argc + 1 {
-            self.stack.push(JsValue::Undefined);
+            self.push(JsValue::Undefined);
             return;
         }
         let args_start = self.stack.len() - argc;
-        let ctor_idx = args_start - 1;
 
-        let ctor = self.stack[ctor_idx].clone();
-        let args: Vec<JsValue> = self.stack[args_start..].to_vec();
-        self.stack.truncate(ctor_idx);
+        let args: Vec<JsValue> = self.stack.drain(args_start..).map(Value::into_js).collect();
+        let ctor = self.pop();
 
         match ctor {
             JsValue::Function(func_rc) => {
@@ -129,13 +123,15 @@ impl Vm {
                     }
                 };
                 let new_obj = JsValue::Object(Rc::new(RefCell::new(JsObject {
-                    properties: alloc::collections::BTreeMap::new(),
+                    properties: crate::shape::PropertyMap::new(),
                     prototype: ctor_proto.or(Some(self.object_proto.clone())),
                     internal_tag: None,
                     primitive_value: None,
                     set_hook: None,
                     set_hook_data: core::ptr::null_mut(),
+                    view: None,
                 })));
+                let new_obj = self.heap.track(new_obj);
 
                 self.current_this = new_obj.clone();
 
@@ -144,12 +140,12 @@ impl Vm {
                         let result = native_fn(self, &args);
                         if let Some(exc) = self.pending_exception.take() {
                             if !self.handle_exception(exc) {
-                                self.stack.push(JsValue::Undefined);
+                                self.push(JsValue::Undefined);
                             }
                         } else if result.is_object() || result.is_array() {
-                            self.stack.push(result);
+                            self.push(result);
                         } else {
-                            self.stack.push(new_obj);
+                            self.push(new_obj);
                         }
                     }
                     FnKind::Bytecode(chunk) => {
@@ -181,7 +177,7 @@ impl Vm {
             }
             _ => {
                 self.log_engine("[libjs] WARN: new called on non-function");
-                self.stack.push(JsValue::Undefined);
+                self.push(JsValue::Undefined);
             }
         }
     }
@@ -194,7 +190,7 @@ impl Vm {
 
         // Native function: result already on stack, no new frame pushed.
         if self.frames.len() <= saved_depth {
-            return self.stack.pop().unwrap_or(JsValue::Undefined);
+            return self.pop();
         }
 
         // Bytecode function: run until we're back to saved depth.
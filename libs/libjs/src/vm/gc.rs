@@ -0,0 +1,375 @@
+//! Cycle collector for the reference-counted heap.
+//!
+//! Values stay `Rc<RefCell<..>>`, which frees acyclic garbage immediately
+//! but leaks cycles (a closure stored in a variable it captures, objects
+//! pointing at each other).  The VM registers the objects, arrays,
+//! functions and captured variable cells it creates with the [`Heap`], and
+//! periodically runs a trial-deletion pass over them:
+//!
+//! 1. every tracked node starts with its strong count;
+//! 2. each reference from one tracked node to another is subtracted;
+//! 3. nodes left with a positive count are referenced from outside the
+//!    tracked set — the VM stack, frame locals, globals, natives, the host —
+//!    and everything they reach is live;
+//! 4. the rest are only reachable from each other: their contents are
+//!    cleared, which breaks the cycles and lets the counts drop to zero.
+//!
+//! Because outside references are counted rather than enumerated, no root
+//! can be missed, and nodes the VM never registered simply act as roots.
+//! A node that is mutably borrowed when the pass runs is also treated as
+//! a root.
+//!
+//! The heap is generational: collections normally look only at nodes
+//! registered since the last one (references from older nodes count as
+//! outside references), and survivors are promoted.  A full collection
+//! runs when the old generation has doubled since the last full one.
+
+use alloc::collections::BTreeMap;
+use alloc::rc::{Rc, Weak};
+use alloc::vec::Vec;
+
+use core::cell::{Cell, RefCell};
+
+use crate::value::*;
+
+/// Young nodes that trigger a collection.
+const YOUNG_LIMIT: usize = 8192;
+/// Smallest old generation considered for a full collection.
+const MIN_FULL: usize = 4 * YOUNG_LIMIT;
+
+/// A registered allocation.
+enum Node {
+    Object(Weak<RefCell<JsObject>>),
+    Array(Weak<RefCell<JsArray>>),
+    Function(Weak<RefCell<JsFunction>>),
+    Cell(Weak<RefCell<JsValue>>),
+}
+
+/// A registered allocation, held alive during a collection.
+enum Live {
+    Object(Rc<RefCell<JsObject>>),
+    Array(Rc<RefCell<JsArray>>),
+    Function(Rc<RefCell<JsFunction>>),
+    Cell(Rc<RefCell<JsValue>>),
+}
+
+#[inline]
+fn addr<T>(rc: &Rc<T>) -> usize {
+    Rc::as_ptr(rc) as *const () as usize
+}
+
+impl Node {
+    fn upgrade(&self) -> Option<Live> {
+        Some(match self {
+            Node::Object(w) => Live::Object(w.upgrade()?),
+            Node::Array(w) => Live::Array(w.upgrade()?),
+            Node::Function(w) => Live::Function(w.upgrade()?),
+            Node::Cell(w) => Live::Cell(w.upgrade()?),
+        })
+    }
+}
+
+impl Live {
+    fn addr(&self) -> usize {
+        match self {
+            Live::Object(rc) => addr(rc),
+            Live::Array(rc) => addr(rc),
+            Live::Function(rc) => addr(rc),
+            Live::Cell(rc) => addr(rc),
+        }
+    }
+
+    /// Strong references other than the one held by the collector.
+    fn strong_count(&self) -> usize {
+        match self {
+            Live::Object(rc) => Rc::strong_count(rc) - 1,
+            Live::Array(rc) => Rc::strong_count(rc) - 1,
+            Live::Function(rc) => Rc::strong_count(rc) - 1,
+            Live::Cell(rc) => Rc::strong_count(rc) - 1,
+        }
+    }
+
+    fn downgrade(&self) -> Node {
+        match self {
+            Live::Object(rc) => Node::Object(Rc::downgrade(rc)),
+            Live::Array(rc) => Node::Array(Rc::downgrade(rc)),
+            Live::Function(rc) => Node::Function(Rc::downgrade(rc)),
+            Live::Cell(rc) => Node::Cell(Rc::downgrade(rc)),
+        }
+    }
+
+    /// Call `f` with the address of every heap value this node references.
+    /// Returns `false` if the node is borrowed and could not be inspected.
+    fn visit(&self, f: &mut impl FnMut(usize)) -> bool {
+        fn value(v: &JsValue, f: &mut impl FnMut(usize)) {
+            match v {
+                JsValue::Object(rc) => f(addr(rc)),
+                JsValue::Array(rc) => f(addr(rc)),
+                JsValue::Function(rc) => f(addr(rc)),
+                _ => {}
+            }
+        }
+        match self {
+            Live::Object(rc) => {
+                let Ok(o) = rc.try_borrow() else { return false };
+                for p in o.properties.values() {
+                    value(&p.value, f);
+                }
+                if let Some(proto) = &o.prototype {
+                    f(addr(proto));
+                }
+                if let Some(prim) = &o.primitive_value {
+                    value(prim, f);
+                }
+            }
+            Live::Array(rc) => {
+                let Ok(a) = rc.try_borrow() else { return false };
+                for v in a.elements.values() {
+                    value(v, f);
+                }
+                for p in a.properties.values() {
+                    value(&p.value, f);
+                }
+            }
+            Live::Function(rc) => {
+                let Ok(func) = rc.try_borrow() else { return false };
+                for cell in &func.upvalues {
+                    f(addr(cell));
+                }
+                if let Some(this) = &func.this_binding {
+                    value(this, f);
+                }
+                if let Some(proto) = &func.prototype {
+                    f(addr(proto));
+                }
+                for v in func.own_props.values() {
+                    value(v, f);
+                }
+            }
+            Live::Cell(rc) => {
+                let Ok(v) = rc.try_borrow() else { return false };
+                value(&v, f);
+            }
+        }
+        true
+    }
+}
+
+/// Contents removed from garbage nodes, dropped once no node is borrowed.
+#[derive(Default)]
+struct Cleared {
+    objects: Vec<JsObject>,
+    values: Vec<JsValue>,
+    cells: Vec<Rc<RefCell<JsValue>>>,
+    protos: Vec<Rc<RefCell<JsObject>>>,
+    props: Vec<alloc::collections::BTreeMap<alloc::string::String, JsValue>>,
+}
+
+impl Live {
+    fn clear(&self, out: &mut Cleared) {
+        match self {
+            Live::Object(rc) => {
+                out.objects.push(core::mem::replace(&mut *rc.borrow_mut(), JsObject::new()));
+            }
+            Live::Array(rc) => {
+                let mut a = rc.borrow_mut();
+                out.values.append(&mut a.elements.take_values());
+                let props = core::mem::take(&mut a.properties);
+                out.values.extend(props.into_values().map(|p| p.value));
+            }
+            Live::Function(rc) => {
+                let mut func = rc.borrow_mut();
+                out.cells.append(&mut func.upvalues);
+                out.values.extend(func.this_binding.take());
+                out.protos.extend(func.prototype.take());
+                out.props.push(core::mem::take(&mut func.own_props));
+            }
+            Live::Cell(rc) => {
+                out.values.push(core::mem::replace(&mut *rc.borrow_mut(), JsValue::Undefined));
+            }
+        }
+    }
+}
+
+/// Collector counters, as reported by `console.heap()`.
+#[derive(Clone, Copy, Default)]
+pub struct HeapStats {
+    /// Nodes registered and not yet found dead.
+    pub tracked: usize,
+    pub young: usize,
+    pub old: usize,
+    pub collections: u64,
+    pub full_collections: u64,
+    /// Nodes freed by breaking cycles.
+    pub freed: u64,
+}
+
+/// Registry of collectable allocations.
+pub struct Heap {
+    young: RefCell<Vec<Node>>,
+    old: RefCell<Vec<Node>>,
+    /// Old generation size after the last full collection.
+    old_after_full: Cell<usize>,
+    stats: Cell<HeapStats>,
+}
+
+impl Heap {
+    pub fn new() -> Self {
+        Heap {
+            young: RefCell::new(Vec::new()),
+            old: RefCell::new(Vec::new()),
+            old_after_full: Cell::new(0),
+            stats: Cell::new(HeapStats::default()),
+        }
+    }
+
+    pub fn track_object(&self, rc: &Rc<RefCell<JsObject>>) {
+        self.young.borrow_mut().push(Node::Object(Rc::downgrade(rc)));
+    }
+
+    pub fn track_array(&self, rc: &Rc<RefCell<JsArray>>) {
+        self.young.borrow_mut().push(Node::Array(Rc::downgrade(rc)));
+    }
+
+    pub fn track_function(&self, rc: &Rc<RefCell<JsFunction>>) {
+        self.young.borrow_mut().push(Node::Function(Rc::downgrade(rc)));
+    }
+
+    pub fn track_cell(&self, rc: &Rc<RefCell<JsValue>>) {
+        self.young.borrow_mut().push(Node::Cell(Rc::downgrade(rc)));
+    }
+
+    /// Register `val` if it is a heap value; returns it for chaining.
+    pub fn track(&self, val: JsValue) -> JsValue {
+        match &val {
+            JsValue::Object(rc) => self.track_object(rc),
+            JsValue::Array(rc) => self.track_array(rc),
+            JsValue::Function(rc) => self.track_function(rc),
+            _ => {}
+        }
+        val
+    }
+
+    /// Whether enough has been allocated to make a collection worthwhile.
+    #[inline]
+    pub fn should_collect(&self) -> bool {
+        self.young.borrow().len() >= YOUNG_LIMIT
+    }
+
+    pub fn stats(&self) -> HeapStats {
+        let mut s = self.stats.get();
+        s.young = self.young.borrow().len();
+        s.old = self.old.borrow().len();
+        s.tracked = s.young + s.old;
+        s
+    }
+
+    /// Collect the young generation, or everything when the old generation
+    /// has grown enough (or `full` is set).  Returns the nodes freed.
+    pub fn collect(&self, full: bool) -> usize {
+        let old_len = self.old.borrow().len();
+        let full = full || (old_len >= MIN_FULL && old_len >= 2 * self.old_after_full.get());
+
+        let mut nodes: Vec<Node> = core::mem::take(&mut *self.young.borrow_mut());
+        if full {
+            nodes.append(&mut self.old.borrow_mut());
+        }
+
+        // Live nodes, deduplicated (a cell is registered once per capture).
+        let mut live: Vec<Live> = Vec::with_capacity(nodes.len());
+        let mut index: BTreeMap<usize, usize> = BTreeMap::new();
+        for node in &nodes {
+            if let Some(l) = node.upgrade() {
+                let a = l.addr();
+                if !index.contains_key(&a) {
+                    index.insert(a, live.len());
+                    live.push(l);
+                }
+            }
+        }
+        drop(nodes);
+
+        // Steps 1-2: outside references per node.
+        let mut refs: Vec<isize> = live.iter().map(|l| l.strong_count() as isize).collect();
+        let mut pinned = alloc::vec![false; live.len()];
+        for (i, l) in live.iter().enumerate() {
+            let ok = l.visit(&mut |a| {
+                if let Some(&j) = index.get(&a) {
+                    refs[j] -= 1;
+                }
+            });
+            if !ok {
+                pinned[i] = true;
+            }
+        }
+
+        // Step 3: mark everything reachable from outside.
+        let mut reachable = alloc::vec![false; live.len()];
+        let mut work: Vec<usize> = Vec::new();
+        for i in 0..live.len() {
+            if refs[i] > 0 || pinned[i] {
+                reachable[i] = true;
+                work.push(i);
+            }
+        }
+        while let Some(i) = work.pop() {
+            live[i].visit(&mut |a| {
+                if let Some(&j) = index.get(&a) {
+                    if !reachable[j] {
+                        reachable[j] = true;
+                        work.push(j);
+                    }
+                }
+            });
+        }
+
+        // Step 4: break the garbage cycles; survivors move to the old generation.
+        let mut cleared = Cleared::default();
+        let mut survivors = Vec::with_capacity(live.len());
+        let mut freed = 0usize;
+        for (i, l) in live.iter().enumerate() {
+            if reachable[i] {
+                survivors.push(l.downgrade());
+            } else {
+                l.clear(&mut cleared);
+                freed += 1;
+            }
+        }
+        self.old.borrow_mut().append(&mut survivors);
+        if full {
+            self.old_after_full.set(self.old.borrow().len());
+        }
+        drop(live);
+        drop(cleared);
+
+        let mut s = self.stats.get();
+        s.collections += 1;
+        if full {
+            s.full_collections += 1;
+        }
+        s.freed += freed as u64;
+        self.stats.set(s);
+        freed
+    }
+}
+
+impl super::Vm {
+    /// Run a full collection now (e.g. when the host unloads a page).
+    /// Returns the nodes freed.
+    pub fn collect_garbage(&mut self) -> usize {
+        self.heap.collect(true)
+    }
+}
+
+impl Drop for super::Vm {
+    /// Drop the VM's own roots first so cycles that only the VM kept alive
+    /// are broken instead of leaking with it.
+    fn drop(&mut self) {
+        self.stack.clear();
+        self.frames.clear();
+        self.globals = JsObject::new();
+        self.current_this = JsValue::Undefined;
+        self.pending_exception = None;
+        self.heap.collect(true);
+    }
+}
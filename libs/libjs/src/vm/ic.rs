@@ -0,0 +1,239 @@
+//! Inline caches for named property access.
+//!
+//! Every `GetPropNamed` / `SetPropNamed` site owns an [`InlineCache`] in its
+//! chunk's table.  A cache remembers, per receiver shape id, where the
+//! property was found: an own slot, or a slot of an object up to
+//! [`MAX_CHAIN`] prototypes away (with the shape ids of the prototypes in
+//! between, which prove the key is still absent there).  Stores remember the
+//! slot to overwrite, or the shape transition that adds the key.
+//!
+//! A site caches up to [`IC_WAYS`] shapes (polymorphic); beyond that it goes
+//! megamorphic and only takes the generic path.  Hits never touch the
+//! property name.  Only plain objects are cached; arrays, strings and
+//! functions keep their special-cased lookups.
+
+use alloc::rc::Rc;
+use alloc::vec::Vec;
+
+use core::cell::RefCell;
+use core::fmt;
+
+use crate::shape::Shape;
+use crate::value::*;
+use super::Vm;
+
+/// Shapes cached per site.
+pub const IC_WAYS: usize = 4;
+/// Deepest prototype a cached load may come from.
+pub const MAX_CHAIN: usize = 4;
+
+/// Inline caches of one chunk, indexed by the slot in the opcode.
+pub type IcTable = Rc<RefCell<Vec<InlineCache>>>;
+
+/// A cached load.
+#[derive(Clone, Copy)]
+pub struct LoadEntry {
+    receiver: u64,
+    /// Shape ids of the prototypes walked, the last one holding the key.
+    chain: [u64; MAX_CHAIN],
+    depth: u8,
+    slot: u32,
+}
+
+/// A cached store.
+#[derive(Clone)]
+pub struct StoreEntry {
+    receiver: u64,
+    slot: u32,
+    /// Shape after adding the key; `None` overwrites an existing slot.
+    transition: Option<Rc<Shape>>,
+}
+
+/// The state of one site.
+#[derive(Clone)]
+pub enum InlineCache {
+    Empty,
+    Load(Vec<LoadEntry>),
+    Store(Vec<StoreEntry>),
+    Megamorphic,
+}
+
+impl fmt::Debug for InlineCache {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            InlineCache::Empty => write!(f, "Empty"),
+            InlineCache::Load(e) => write!(f, "Load({})", e.len()),
+            InlineCache::Store(e) => write!(f, "Store({})", e.len()),
+            InlineCache::Megamorphic => write!(f, "Megamorphic"),
+        }
+    }
+}
+
+impl InlineCache {
+    fn add_load(&mut self, entry: LoadEntry) {
+        match self {
+            InlineCache::Empty => *self = InlineCache::Load(alloc::vec![entry]),
+            InlineCache::Load(entries) if entries.len() < IC_WAYS => entries.push(entry),
+            _ => *self = InlineCache::Megamorphic,
+        }
+    }
+
+    fn add_store(&mut self, entry: StoreEntry) {
+        match self {
+            InlineCache::Empty => *self = InlineCache::Store(alloc::vec![entry]),
+            InlineCache::Store(entries) if entries.len() < IC_WAYS => entries.push(entry),
+            _ => *self = InlineCache::Megamorphic,
+        }
+    }
+}
+
+impl Vm {
+    /// `obj.name` through the inline cache `ic` of the current frame.
+    pub(super) fn get_named(&self, frame_idx: usize, name_idx: u16, ic: u16, obj: &JsValue) -> JsValue {
+        let obj_rc = match obj {
+            JsValue::Object(o) => o,
+            _ => {
+                let name = self.get_const_string(frame_idx, name_idx);
+                return self.get_property_with_proto(obj, &name);
+            }
+        };
+        let ics = &self.frames[frame_idx].chunk.ics;
+        {
+            let caches = ics.borrow();
+            if let Some(InlineCache::Load(entries)) = caches.get(ic as usize) {
+                let receiver = obj_rc.borrow().properties.shape_id();
+                for e in entries.iter().filter(|e| e.receiver == receiver) {
+                    if let Some(v) = self.cached_load(obj_rc, e) {
+                        return v;
+                    }
+                }
+            }
+        }
+        let name = self.get_const_string(frame_idx, name_idx);
+        let (val, entry) = self.lookup_for_cache(obj_rc, &name);
+        if let Some(entry) = entry {
+            if let Some(cache) = ics.borrow_mut().get_mut(ic as usize) {
+                cache.add_load(entry);
+            }
+        }
+        val
+    }
+
+    /// Replay a cached load; `None` if a prototype on the way changed.
+    fn cached_load(&self, obj_rc: &Rc<RefCell<JsObject>>, e: &LoadEntry) -> Option<JsValue> {
+        let o = obj_rc.borrow();
+        if e.depth == 0 {
+            return Some(o.properties.slot(e.slot as usize).value.clone());
+        }
+        // Missing prototype on the receiver falls back to Object.prototype,
+        // as in `get_property_with_proto`.
+        let mut cur = o.prototype.clone().unwrap_or_else(|| self.object_proto.clone());
+        drop(o);
+        for level in 0..e.depth as usize {
+            let next = {
+                let p = cur.borrow();
+                if p.properties.shape_id() != e.chain[level] {
+                    return None;
+                }
+                if level + 1 == e.depth as usize {
+                    return Some(p.properties.slot(e.slot as usize).value.clone());
+                }
+                p.prototype.clone()?
+            };
+            cur = next;
+        }
+        None
+    }
+
+    /// Generic load of `key` from a plain object, with the cache entry
+    /// describing where it was found.
+    fn lookup_for_cache(&self, obj_rc: &Rc<RefCell<JsObject>>, key: &JsStr) -> (JsValue, Option<LoadEntry>) {
+        let o = obj_rc.borrow();
+        let mut entry = LoadEntry {
+            receiver: o.properties.shape_id(),
+            chain: [0; MAX_CHAIN],
+            depth: 0,
+            slot: 0,
+        };
+        if let Some(slot) = o.properties.find_key(key) {
+            entry.slot = slot as u32;
+            return (o.properties.slot(slot).value.clone(), Some(entry));
+        }
+        let mut cur = o.prototype.clone().unwrap_or_else(|| self.object_proto.clone());
+        drop(o);
+        loop {
+            let next = {
+                let p = cur.borrow();
+                let level = entry.depth as usize;
+                if let Some(slot) = p.properties.find_key(key) {
+                    let val = p.properties.slot(slot).value.clone();
+                    if level >= MAX_CHAIN {
+                        return (val, None);
+                    }
+                    entry.chain[level] = p.properties.shape_id();
+                    entry.depth += 1;
+                    entry.slot = slot as u32;
+                    return (val, Some(entry));
+                }
+                if level < MAX_CHAIN {
+                    entry.chain[level] = p.properties.shape_id();
+                }
+                entry.depth = entry.depth.saturating_add(1);
+                match p.prototype.clone() {
+                    Some(next) => next,
+                    None => return (JsValue::Undefined, None),
+                }
+            };
+            cur = next;
+        }
+    }
+
+    /// `obj.name = val` through the inline cache `ic` of the current frame.
+    /// `name` must not be `__proto__` (the caller handles it).
+    pub(super) fn set_named(&self, frame_idx: usize, name_idx: u16, ic: u16, obj: &JsValue, val: JsValue) {
+        let obj_rc = match obj {
+            JsValue::Object(o) if o.borrow().set_hook.is_none() => o,
+            _ => {
+                let name = self.get_const_string(frame_idx, name_idx);
+                obj.set_property(name, val);
+                return;
+            }
+        };
+        let ics = &self.frames[frame_idx].chunk.ics;
+        {
+            let mut o = obj_rc.borrow_mut();
+            let receiver = o.properties.shape_id();
+            let caches = ics.borrow();
+            if let Some(InlineCache::Store(entries)) = caches.get(ic as usize) {
+                if let Some(e) = entries.iter().find(|e| e.receiver == receiver) {
+                    match &e.transition {
+                        None => *o.properties.slot_mut(e.slot as usize) = Property::data(val),
+                        Some(next) => o.properties.push_with_shape(next.clone(), Property::data(val)),
+                    }
+                    return;
+                }
+            }
+        }
+
+        let name = self.get_const_string(frame_idx, name_idx);
+        let mut o = obj_rc.borrow_mut();
+        let receiver = o.properties.shape_id();
+        let existing = o.properties.find_key(&name);
+        o.properties.insert(name, Property::data(val));
+        let entry = match existing {
+            Some(slot) => StoreEntry { receiver, slot: slot as u32, transition: None },
+            // Adds are cacheable while the object stays shaped.
+            None => match o.properties.shape() {
+                Some(next) => StoreEntry {
+                    receiver,
+                    slot: (next.len() - 1) as u32,
+                    transition: Some(next.clone()),
+                },
+                None => return,
+            },
+        };
+        if let Some(cache) = ics.borrow_mut().get_mut(ic as usize) {
+            cache.add_store(entry);
+        }
+    }
+}
@@ -6,7 +6,7 @@ use alloc::vec::Vec;
 use core::cell::RefCell;
 
 use crate::value::*;
-use super::Vm;
+use super::{Vm, native_buffer};
 
 impl Vm {
     /// Create an iterator object from a value.
@@ -14,18 +14,15 @@ impl Vm {
     pub fn create_iterator(&self, val: &JsValue) -> JsValue {
         let items: Vec<JsValue> = match val {
             JsValue::Array(arr) => {
-                arr.borrow().elements.clone()
+                arr.borrow().elements.to_vec()
             }
             JsValue::String(s) => {
-                s.chars().map(|c| {
-                    let mut cs = String::new();
-                    cs.push(c);
-                    JsValue::String(cs)
-                }).collect()
-            }
-            JsValue::Object(obj) => {
-                obj.borrow().keys().into_iter().map(JsValue::String).collect()
+                s.chars().map(|c| JsValue::String(JsStr::from(c))).collect()
             }
+            JsValue::Object(obj) => match native_buffer::typed_values(val) {
+                Some(values) => values,
+                None => obj.borrow().keys().into_iter().map(JsValue::String).collect(),
+            },
             _ => Vec::new(),
         };
 
@@ -42,7 +39,7 @@ impl Vm {
     /// Returns (value, has_more).
     pub fn iter_next_mut(&mut self) -> (JsValue, bool) {
         let iter = match self.stack.last() {
-            Some(v) => v.clone(),
+            Some(v) => v.to_js(),
             None => return (JsValue::Undefined, false),
         };
 
@@ -61,7 +58,7 @@ impl Vm {
                     JsValue::Array(arr) => {
                         let a = arr.borrow();
                         if index < a.elements.len() {
-                            let val = a.elements[index].clone();
+                            let val = a.get(index);
                             // Advance index
                             o.set(String::from("__index__"), JsValue::Number((index + 1) as f64));
                             (val, true) // has_more = true
@@ -12,7 +12,10 @@ use alloc::format;
 
 use core::cell::RefCell;
 
+use crate::atom::AtomTable;
 use crate::bytecode::{Chunk, Constant, Op};
+use crate::nanbox::Value;
+use crate::shape::PropertyMap;
 use crate::value::*;
 
 pub mod call;
@@ -33,7 +36,10 @@ pub mod native_date;
 pub mod native_timer;
 pub mod native_symbol;
 pub mod native_proxy;
+pub mod native_buffer;
 pub mod iter;
+pub mod ic;
+pub mod gc;
 
 // ── Internal structures ──
 
@@ -68,7 +74,8 @@ pub struct TryHandler {
 
 /// The JavaScript virtual machine.
 pub struct Vm {
-    pub stack: Vec<JsValue>,
+    /// Operand stack, NaN-boxed; see [`Vm::push`] / [`Vm::pop`].
+    pub stack: Vec<Value>,
     pub frames: Vec<CallFrame>,
     pub globals: JsObject,
     pub try_handlers: Vec<TryHandler>,
@@ -81,6 +88,12 @@ pub struct Vm {
     pub number_proto: Rc<RefCell<JsObject>>,
     pub boolean_proto: Rc<RefCell<JsObject>>,
     pub error_proto: Rc<RefCell<JsObject>>,
+    pub array_buffer_proto: Rc<RefCell<JsObject>>,
+    pub data_view_proto: Rc<RefCell<JsObject>>,
+    /// `Int8Array.prototype` … `Float64Array.prototype`, by [`TypedKind::index`].
+    ///
+    /// [`TypedKind::index`]: crate::buffer::TypedKind::index
+    pub typed_protos: Vec<Rc<RefCell<JsObject>>>,
     pub step_limit: u64,
     pub steps: u64,
     pub userdata: *mut u8,
@@ -91,6 +104,11 @@ pub struct Vm {
     /// Pending exception set by native functions via `throw_native()`.
     /// Checked after every native call and turned into a VM-level throw.
     pub pending_exception: Option<JsValue>,
+    /// Cycle collector registry for values created by the VM.
+    pub heap: gc::Heap,
+    /// Property names and identifiers of every loaded script, and keys
+    /// interned by natives (e.g. `JSON.parse`).
+    pub atoms: AtomTable,
 }
 
 impl Vm {
@@ -109,12 +127,17 @@ impl Vm {
             number_proto: Rc::new(RefCell::new(JsObject::new())),
             boolean_proto: Rc::new(RefCell::new(JsObject::new())),
             error_proto: Rc::new(RefCell::new(JsObject::new())),
+            array_buffer_proto: Rc::new(RefCell::new(JsObject::new())),
+            data_view_proto: Rc::new(RefCell::new(JsObject::new())),
+            typed_protos: Vec::new(),
             step_limit: 10_000_000,
             steps: 0,
             userdata: core::ptr::null_mut(),
             current_this: JsValue::Undefined,
             run_target_depth: 0,
             pending_exception: None,
+            heap: gc::Heap::new(),
+            atoms: AtomTable::new(),
         };
         vm.init_prototypes();
         vm.init_globals();
@@ -136,15 +159,26 @@ impl Vm {
 
     /// Create a `TypeError` object (for use in native function throws).
     pub fn make_type_error(&self, message: &str) -> JsValue {
+        self.make_error("TypeError", message)
+    }
+
+    /// Create a `RangeError` object (for use in native function throws).
+    pub fn make_range_error(&self, message: &str) -> JsValue {
+        self.make_error("RangeError", message)
+    }
+
+    fn make_error(&self, name: &str, message: &str) -> JsValue {
         let mut obj = JsObject::new();
         obj.prototype = Some(self.error_proto.clone());
-        obj.set(String::from("name"), JsValue::String(String::from("TypeError")));
-        obj.set(String::from("message"), JsValue::String(String::from(message)));
+        obj.set(String::from("name"), JsValue::String(JsStr::from(name)));
+        obj.set(String::from("message"), JsValue::String(JsStr::from(message)));
         JsValue::Object(Rc::new(RefCell::new(obj)))
     }
 
-    pub fn execute(&mut self, chunk: Chunk) -> JsValue {
+    pub fn execute(&mut self, mut chunk: Chunk) -> JsValue {
         self.steps = 0;
+        // Scripts share atoms with each other, not just within one compile.
+        self.atoms.intern_chunk(&mut chunk);
         let local_count = chunk.local_count as usize;
         let frame = CallFrame {
             chunk,
@@ -198,7 +232,11 @@ impl Vm {
             }
 
             if self.frames.is_empty() || self.frames.len() <= self.run_target_depth {
-                return self.stack.pop().unwrap_or(JsValue::Undefined);
+                return self.pop();
+            }
+
+            if self.heap.should_collect() {
+                self.heap.collect(false);
             }
 
             let frame_idx = self.frames.len() - 1;
@@ -206,7 +244,7 @@ impl Vm {
             if ip >= self.frames[frame_idx].chunk.code.len() {
                 if self.frames.len() <= self.run_target_depth + 1 {
                     self.frames.pop();
-                    return self.stack.pop().unwrap_or(JsValue::Undefined);
+                    return self.pop();
                 }
                 self.frames.pop();
                 continue;
@@ -219,12 +257,12 @@ impl Vm {
                 // ── Stack operations ──
                 Op::LoadConst(idx) => {
                     let val = self.load_constant(frame_idx, idx);
-                    self.stack.push(val);
+                    self.push(val);
                 }
-                Op::LoadUndefined => self.stack.push(JsValue::Undefined),
-                Op::LoadNull => self.stack.push(JsValue::Null),
-                Op::LoadTrue => self.stack.push(JsValue::Bool(true)),
-                Op::LoadFalse => self.stack.push(JsValue::Bool(false)),
+                Op::LoadUndefined => self.stack.push(Value::UNDEFINED),
+                Op::LoadNull => self.stack.push(Value::NULL),
+                Op::LoadTrue => self.stack.push(Value::TRUE),
+                Op::LoadFalse => self.stack.push(Value::FALSE),
                 Op::Pop => { self.stack.pop(); }
                 Op::Dup => {
                     if let Some(val) = self.stack.last().cloned() {
@@ -234,28 +272,21 @@ impl Vm {
 
                 // ── Variables ──
                 Op::LoadLocal(slot) => {
-                    let val = self.frames[frame_idx].locals
-                        .get(slot as usize)
-                        .map(|c| c.borrow().clone())
-                        .unwrap_or(JsValue::Undefined);
+                    let val = self.get_local_value(frame_idx, slot);
                     self.stack.push(val);
                 }
                 Op::StoreLocal(slot) => {
-                    let val = self.stack.last().cloned().unwrap_or(JsValue::Undefined);
-                    let locals = &mut self.frames[frame_idx].locals;
-                    while locals.len() <= slot as usize {
-                        locals.push(Rc::new(RefCell::new(JsValue::Undefined)));
-                    }
-                    *locals[slot as usize].borrow_mut() = val;
+                    let val = self.peek();
+                    self.set_local(frame_idx, slot, val);
                 }
                 Op::LoadGlobal(name_idx) => {
                     let name = self.get_const_string(frame_idx, name_idx);
                     let val = self.globals.get(&name);
-                    self.stack.push(val);
+                    self.push(val);
                 }
                 Op::StoreGlobal(name_idx) => {
                     let name = self.get_const_string(frame_idx, name_idx);
-                    let val = self.stack.last().cloned().unwrap_or(JsValue::Undefined);
+                    let val = self.peek();
                     self.globals.set(name, val);
                 }
                 Op::LoadUpvalue(idx) => {
@@ -263,10 +294,10 @@ impl Vm {
                         .get(idx as usize)
                         .map(|c| c.borrow().clone())
                         .unwrap_or(JsValue::Undefined);
-                    self.stack.push(val);
+                    self.push(val);
                 }
                 Op::StoreUpvalue(idx) => {
-                    let val = self.stack.last().cloned().unwrap_or(JsValue::Undefined);
+                    let val = self.peek();
                     if let Some(cell) = self.frames[frame_idx].upvalue_cells.get(idx as usize) {
                         *cell.borrow_mut() = val;
                     }
@@ -274,9 +305,13 @@ impl Vm {
 
                 // ── Arithmetic ──
                 Op::Add => {
-                    let b = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(self.op_add(&a, &b));
+                    if let Some((a, b)) = self.pop_numbers() {
+                        self.stack.push(Value::number(a + b));
+                    } else {
+                        let b = self.pop();
+                        let a = self.pop();
+                        self.push(self.op_add(&a, &b));
+                    }
                 }
                 Op::Sub => self.binary_num_op(|a, b| a - b),
                 Op::Mul => self.binary_num_op(|a, b| a * b),
@@ -284,12 +319,12 @@ impl Vm {
                 Op::Mod => self.binary_num_op(|a, b| a % b),
                 Op::Exp => self.binary_num_op(|a, b| native_math::pow_f64(a, b)),
                 Op::Neg => {
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Number(-a.to_number()));
+                    let a = self.pop();
+                    self.push(JsValue::Number(-a.to_number()));
                 }
                 Op::Pos => {
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Number(a.to_number()));
+                    let a = self.pop();
+                    self.push(JsValue::Number(a.to_number()));
                 }
 
                 // ── Bitwise ──
@@ -297,37 +332,37 @@ impl Vm {
                 Op::BitOr  => self.binary_int_op(|a, b| a | b),
                 Op::BitXor => self.binary_int_op(|a, b| a ^ b),
                 Op::BitNot => {
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Number((!(a.to_number() as i32)) as f64));
+                    let a = self.pop();
+                    self.push(JsValue::Number((!(a.to_number() as i32)) as f64));
                 }
                 Op::Shl  => self.binary_int_op(|a, b| a << (b & 31)),
                 Op::Shr  => self.binary_int_op(|a, b| a >> (b & 31)),
                 Op::UShr => {
-                    let b = self.stack.pop().unwrap_or(JsValue::Undefined).to_number() as u32;
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined).to_number() as u32;
-                    self.stack.push(JsValue::Number((a >> (b & 31)) as f64));
+                    let b = self.pop().to_number() as u32;
+                    let a = self.pop().to_number() as u32;
+                    self.push(JsValue::Number((a >> (b & 31)) as f64));
                 }
 
                 // ── Comparison ──
                 Op::Eq => {
-                    let b = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Bool(a.abstract_eq(&b)));
+                    let b = self.pop();
+                    let a = self.pop();
+                    self.push(JsValue::Bool(a.abstract_eq(&b)));
                 }
                 Op::Ne => {
-                    let b = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Bool(!a.abstract_eq(&b)));
+                    let b = self.pop();
+                    let a = self.pop();
+                    self.push(JsValue::Bool(!a.abstract_eq(&b)));
                 }
                 Op::StrictEq => {
-                    let b = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Bool(a.strict_eq(&b)));
+                    let b = self.pop();
+                    let a = self.pop();
+                    self.push(JsValue::Bool(a.strict_eq(&b)));
                 }
                 Op::StrictNe => {
-                    let b = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Bool(!a.strict_eq(&b)));
+                    let b = self.pop();
+                    let a = self.pop();
+                    self.push(JsValue::Bool(!a.strict_eq(&b)));
                 }
                 Op::Lt => self.compare_op(|a, b| a < b),
                 Op::Le => self.compare_op(|a, b| a <= b),
@@ -336,8 +371,8 @@ impl Vm {
 
                 // ── Logical ──
                 Op::Not => {
-                    let a = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Bool(!a.to_boolean()));
+                    let a = self.stack.pop().unwrap_or_default();
+                    self.stack.push(Value::bool(!a.to_boolean()));
                 }
 
                 // ── Control flow ──
@@ -346,22 +381,21 @@ impl Vm {
                     self.frames[frame_idx].ip = ip as usize;
                 }
                 Op::JumpIfTrue(offset) => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.stack.pop().unwrap_or_default();
                     if val.to_boolean() {
                         let ip = self.frames[frame_idx].ip as i32 + offset;
                         self.frames[frame_idx].ip = ip as usize;
                     }
                 }
                 Op::JumpIfFalse(offset) => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.stack.pop().unwrap_or_default();
                     if !val.to_boolean() {
                         let ip = self.frames[frame_idx].ip as i32 + offset;
                         self.frames[frame_idx].ip = ip as usize;
                     }
                 }
                 Op::JumpIfNullish(offset) => {
-                    let val = self.stack.last().unwrap_or(&JsValue::Undefined).clone();
-                    if val.is_nullish() {
+                    if self.stack.last().map_or(true, Value::is_nullish) {
                         let ip = self.frames[frame_idx].ip as i32 + offset;
                         self.frames[frame_idx].ip = ip as usize;
                     }
@@ -375,7 +409,7 @@ impl Vm {
                     self.call_method(argc as usize);
                 }
                 Op::Return => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.pop();
                     let frame = self.frames.pop().unwrap();
                     self.stack.truncate(frame.stack_base);
                     // `new` calls: if constructor returned non-object, return `this` instead.
@@ -384,7 +418,7 @@ impl Vm {
                     } else {
                         val
                     };
-                    self.stack.push(ret.clone());
+                    self.push(ret.clone());
                     if self.frames.is_empty() || self.frames.len() <= self.run_target_depth {
                         return ret;
                     }
@@ -399,10 +433,12 @@ impl Vm {
                     for uv_ref in &chunk.upvalues.clone() {
                         let cell = if uv_ref.is_local {
                             // Capture the Rc<RefCell> of a local from the current frame.
-                            self.frames[frame_idx].locals
+                            let cell = self.frames[frame_idx].locals
                                 .get(uv_ref.index as usize)
                                 .cloned()
-                                .unwrap_or_else(|| Rc::new(RefCell::new(JsValue::Undefined)))
+                                .unwrap_or_else(|| Rc::new(RefCell::new(JsValue::Undefined)));
+                            self.heap.track_cell(&cell);
+                            cell
                         } else {
                             // Re-capture from this frame's own upvalue cells (upvalue-of-upvalue).
                             self.frames[frame_idx].upvalue_cells
@@ -424,21 +460,33 @@ impl Vm {
                         prototype: Some(Rc::new(RefCell::new(JsObject::new()))),
                         own_props: BTreeMap::new(),
                     };
-                    self.stack.push(JsValue::Function(Rc::new(RefCell::new(func))));
+                    if let Some(proto) = &func.prototype {
+                        self.heap.track_object(proto);
+                    }
+                    let func = self.heap.track(JsValue::Function(Rc::new(RefCell::new(func))));
+                    self.push(func);
                 }
 
                 // ── Objects and Properties ──
                 Op::GetProp => {
-                    let key = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let obj = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let key = self.pop();
+                    let obj = self.pop();
+                    if let Some(val) = get_element(&obj, &key) {
+                        self.push(val);
+                        continue;
+                    }
                     let key_str = key.to_js_string();
                     let val = self.get_property_with_proto(&obj, &key_str);
-                    self.stack.push(val);
+                    self.push(val);
                 }
                 Op::SetProp => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let key = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let obj = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.pop();
+                    let key = self.pop();
+                    let obj = self.pop();
+                    if set_element(&obj, &key, &val) {
+                        self.push(val);
+                        continue;
+                    }
                     let key_str = key.to_js_string();
                     // `__proto__` assignment updates the actual prototype chain.
                     if key_str == "__proto__" {
@@ -452,20 +500,18 @@ impl Vm {
                     } else {
                         obj.set_property(key_str, val.clone());
                     }
-                    self.stack.push(val);
+                    self.push(val);
                 }
-                Op::GetPropNamed(name_idx) => {
-                    let name = self.get_const_string(frame_idx, name_idx);
-                    let obj = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let val = self.get_property_with_proto(&obj, &name);
-                    self.stack.push(val);
+                Op::GetPropNamed(name_idx, ic) => {
+                    let obj = self.pop();
+                    let val = self.get_named(frame_idx, name_idx, ic, &obj);
+                    self.push(val);
                 }
-                Op::SetPropNamed(name_idx) => {
-                    let name = self.get_const_string(frame_idx, name_idx);
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let obj = self.stack.pop().unwrap_or(JsValue::Undefined);
+                Op::SetPropNamed(name_idx, ic) => {
+                    let val = self.pop();
+                    let obj = self.pop();
                     // `__proto__` assignment updates the actual prototype chain.
-                    if name == "__proto__" {
+                    if self.const_is_str(frame_idx, name_idx, "__proto__") {
                         if let JsValue::Object(obj_rc) = &obj {
                             match &val {
                                 JsValue::Object(proto_rc) => { obj_rc.borrow_mut().prototype = Some(proto_rc.clone()); }
@@ -474,29 +520,32 @@ impl Vm {
                             }
                         }
                     } else {
-                        obj.set_property(name, val.clone());
+                        self.set_named(frame_idx, name_idx, ic, &obj, val.clone());
                     }
                     // Push the assigned value (ECMAScript: assignment evaluates
                     // to the right-hand side). The compiler always emits a Pop
                     // or uses this value directly — both cases are correct.
-                    self.stack.push(val);
+                    self.push(val);
                 }
                 Op::NewObject => {
                     let obj = JsObject {
-                        properties: BTreeMap::new(),
+                        properties: PropertyMap::new(),
                         prototype: Some(self.object_proto.clone()),
                         internal_tag: None,
                         primitive_value: None,
                         set_hook: None,
                         set_hook_data: core::ptr::null_mut(),
+                        view: None,
                     };
-                    self.stack.push(JsValue::Object(Rc::new(RefCell::new(obj))));
+                    let obj = self.heap.track(JsValue::Object(Rc::new(RefCell::new(obj))));
+                    self.push(obj);
                 }
                 Op::NewArray(count) => {
                     let start = self.stack.len().saturating_sub(count as usize);
-                    let elements: Vec<JsValue> = self.stack.drain(start..).collect();
+                    let elements: Vec<JsValue> = self.stack.drain(start..).map(Value::into_js).collect();
                     let arr = JsArray::from_vec(elements);
-                    self.stack.push(JsValue::Array(Rc::new(RefCell::new(arr))));
+                    let arr = self.heap.track(JsValue::Array(Rc::new(RefCell::new(arr))));
+                    self.push(arr);
                 }
 
                 // ── Constructors ──
@@ -506,28 +555,28 @@ impl Vm {
 
                 // ── Special operators ──
                 Op::Typeof => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::String(String::from(val.type_of())));
+                    let val = self.pop();
+                    self.push(JsValue::String(JsStr::from(val.type_of())));
                 }
                 Op::Void => {
                     self.stack.pop();
-                    self.stack.push(JsValue::Undefined);
+                    self.push(JsValue::Undefined);
                 }
                 Op::Delete => {
-                    let key = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let obj = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let key = self.pop();
+                    let obj = self.pop();
                     let success = obj.delete_property(&key.to_js_string());
-                    self.stack.push(JsValue::Bool(success));
+                    self.push(JsValue::Bool(success));
                 }
                 Op::InstanceOf => {
-                    let right = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let left = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let right = self.pop();
+                    let left = self.pop();
                     let result = self.instance_of(&left, &right);
-                    self.stack.push(JsValue::Bool(result));
+                    self.push(JsValue::Bool(result));
                 }
                 Op::In => {
-                    let obj = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let key = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let obj = self.pop();
+                    let key = self.pop();
                     let key_str = key.to_js_string();
                     let result = match &obj {
                         JsValue::Object(o) => o.borrow().has(&key_str),
@@ -541,19 +590,19 @@ impl Vm {
                         }
                         _ => false,
                     };
-                    self.stack.push(JsValue::Bool(result));
+                    self.push(JsValue::Bool(result));
                 }
 
                 // ── Iteration ──
                 Op::GetIterator => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.pop();
                     let iter_obj = self.create_iterator(&val);
-                    self.stack.push(iter_obj);
+                    self.push(iter_obj);
                 }
                 Op::IterNext => {
                     let (value, has_more) = self.iter_next_mut();
-                    self.stack.push(value);
-                    self.stack.push(JsValue::Bool(has_more));
+                    self.push(value);
+                    self.push(JsValue::Bool(has_more));
                 }
 
                 // ── Exception handling ──
@@ -569,7 +618,7 @@ impl Vm {
                     self.try_handlers.pop();
                 }
                 Op::Throw => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.pop();
                     self.log_engine(&format!("[libjs] exception thrown: {:?}", val));
                     if !self.handle_exception(val) {
                         return JsValue::Undefined;
@@ -578,55 +627,55 @@ impl Vm {
 
                 // ── Inc/Dec ──
                 Op::Inc => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Number(val.to_number() + 1.0));
+                    let val = self.pop();
+                    self.push(JsValue::Number(val.to_number() + 1.0));
                 }
                 Op::Dec => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    self.stack.push(JsValue::Number(val.to_number() - 1.0));
+                    let val = self.pop();
+                    self.push(JsValue::Number(val.to_number() - 1.0));
                 }
 
                 // ── This ──
                 Op::LoadThis => {
                     let this_val = self.frames[frame_idx].this_val.clone();
-                    self.stack.push(this_val);
+                    self.push(this_val);
                 }
 
                 // ── Spread / ArrayPush ──
                 Op::Spread => {
                     // Stack: [..., target_array, value_to_spread]
                     // Pop both, extend target with elements of value, push target back.
-                    let src = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let tgt = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let src = self.pop();
+                    let tgt = self.pop();
                     if let JsValue::Array(tgt_rc) = &tgt {
                         match &src {
                             JsValue::Array(src_rc) => {
                                 let elems = src_rc.borrow().elements.clone();
-                                for el in elems {
-                                    tgt_rc.borrow_mut().elements.push(el);
-                                }
+                                tgt_rc.borrow_mut().elements.extend_from(&elems);
                             }
                             JsValue::String(s) => {
                                 for ch in s.chars() {
-                                    let mut cs = String::new();
-                                    cs.push(ch);
-                                    tgt_rc.borrow_mut().elements.push(JsValue::String(cs));
+                                    tgt_rc.borrow_mut().elements.push(JsValue::String(JsStr::from(ch)));
+                                }
+                            }
+                            _ => {
+                                for el in native_buffer::typed_values(&src).unwrap_or_default() {
+                                    tgt_rc.borrow_mut().elements.push(el);
                                 }
                             }
-                            _ => {}
                         }
                     }
-                    self.stack.push(tgt);
+                    self.push(tgt);
                 }
                 Op::ObjectSpread => {
                     // Stack: [..., target_object, source_object]
                     // Copy all own enumerable properties of source into target.
-                    let src = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let tgt = self.stack.last().cloned().unwrap_or(JsValue::Undefined);
+                    let src = self.pop();
+                    let tgt = self.peek();
                     if let JsValue::Object(tgt_rc) = &tgt {
                         match &src {
                             JsValue::Object(src_rc) => {
-                                let props: Vec<(String, JsValue)> = src_rc.borrow()
+                                let props: Vec<(JsStr, JsValue)> = src_rc.borrow()
                                     .properties.iter()
                                     .filter(|(_, p)| p.enumerable)
                                     .map(|(k, p)| (k.clone(), p.value.clone()))
@@ -644,29 +693,30 @@ impl Vm {
                 Op::ArrayPush => {
                     // Stack: [..., target_array, value]
                     // Pop both, push value to target, push target back.
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let tgt = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.pop();
+                    let tgt = self.pop();
                     if let JsValue::Array(tgt_rc) = &tgt {
                         tgt_rc.borrow_mut().elements.push(val);
                     }
-                    self.stack.push(tgt);
+                    self.push(tgt);
                 }
                 Op::LoadArgsArray(start) => {
                     // Create an Array containing all call arguments from index `start` onward.
                     let all = self.frames[frame_idx].all_args.clone();
                     let elems: Vec<JsValue> = all.into_iter().skip(start as usize).collect();
-                    self.stack.push(JsValue::new_array(elems));
+                    let arr = self.heap.track(JsValue::new_array(elems));
+                    self.push(arr);
                 }
                 Op::LoadSelf => {
                     let self_val = self.frames[frame_idx].self_ref.clone();
-                    self.stack.push(self_val);
+                    self.push(self_val);
                 }
                 Op::CallSpread => {
                     // Stack: [..., callee, args_array]
-                    let args_val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let callee = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let args_val = self.pop();
+                    let callee = self.pop();
                     let args: Vec<JsValue> = match &args_val {
-                        JsValue::Array(arr) => arr.borrow().elements.clone(),
+                        JsValue::Array(arr) => arr.borrow().elements.to_vec(),
                         _ => Vec::new(),
                     };
                     self.current_this = JsValue::Undefined;
@@ -674,11 +724,11 @@ impl Vm {
                 }
                 Op::CallMethodSpread => {
                     // Stack: [..., this_obj, method_fn, args_array]
-                    let args_val = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let callee = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let this_val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let args_val = self.pop();
+                    let callee = self.pop();
+                    let this_val = self.pop();
                     let args: Vec<JsValue> = match &args_val {
-                        JsValue::Array(arr) => arr.borrow().elements.clone(),
+                        JsValue::Array(arr) => arr.borrow().elements.to_vec(),
                         _ => Vec::new(),
                     };
                     self.current_this = this_val.clone();
@@ -687,13 +737,13 @@ impl Vm {
 
                 // ── Async ──
                 Op::Await => {
-                    let val = self.stack.pop().unwrap_or(JsValue::Undefined);
+                    let val = self.pop();
                     // Check if the value is a Promise (has __state property).
                     if let JsValue::Object(ref obj) = val {
                         let state = obj.borrow().get("__state").to_js_string();
                         if state == "fulfilled" {
                             let resolved = obj.borrow().get("__value");
-                            self.stack.push(resolved);
+                            self.push(resolved);
                         } else if state == "rejected" {
                             let reason = obj.borrow().get("__value");
                             // Throw the rejection reason.
@@ -702,26 +752,61 @@ impl Vm {
                             }
                         } else {
                             // Pending promise — push undefined (no event loop to wait).
-                            self.stack.push(JsValue::Undefined);
+                            self.push(JsValue::Undefined);
                         }
                     } else {
                         // Non-promise value — pass through unchanged.
-                        self.stack.push(val);
+                        self.push(val);
                     }
                 }
 
                 Op::Debugger | Op::Nop => {}
 
+                // ── Superinstructions ──
+                Op::LoadLocal2(a, b) => {
+                    let a = self.get_local_value(frame_idx, a);
+                    let b = self.get_local_value(frame_idx, b);
+                    self.stack.push(a);
+                    self.stack.push(b);
+                }
+                Op::StoreLocalPop(slot) => {
+                    let val = self.pop();
+                    self.set_local(frame_idx, slot, val);
+                }
+                Op::AddLocalConst(slot, idx) => {
+                    let a = self.get_local(frame_idx, slot);
+                    let val = match (&a, &self.frames[frame_idx].chunk.constants[idx as usize]) {
+                        (JsValue::Number(x), Constant::Number(y)) => JsValue::Number(x + y),
+                        _ => {
+                            let b = self.load_constant(frame_idx, idx);
+                            self.op_add(&a, &b)
+                        }
+                    };
+                    self.push(val);
+                }
+                Op::IncLocal(slot) => {
+                    let n = self.get_local(frame_idx, slot).to_number();
+                    self.set_local(frame_idx, slot, JsValue::Number(n + 1.0));
+                }
+                Op::DecLocal(slot) => {
+                    let n = self.get_local(frame_idx, slot).to_number();
+                    self.set_local(frame_idx, slot, JsValue::Number(n - 1.0));
+                }
+                Op::JumpIfNotLt(offset) => self.compare_jump(frame_idx, offset, |a, b| a < b),
+                Op::JumpIfNotLe(offset) => self.compare_jump(frame_idx, offset, |a, b| a <= b),
+                Op::JumpIfNotGt(offset) => self.compare_jump(frame_idx, offset, |a, b| a > b),
+                Op::JumpIfNotGe(offset) => self.compare_jump(frame_idx, offset, |a, b| a >= b),
+
                 Op::ObjectRest(count) => {
                     // Pop `count` excluded key strings, then pop source object.
                     // Push new object with all enumerable own properties except excluded ones.
                     let count = count as usize;
-                    let mut excluded: Vec<String> = (0..count)
-                        .map(|_| self.stack.pop().unwrap_or(JsValue::Undefined).to_js_string())
+                    let mut excluded: Vec<JsStr> = (0..count)
+                        .map(|_| self.pop().to_js_str())
                         .collect();
                     excluded.reverse();
-                    let src = self.stack.pop().unwrap_or(JsValue::Undefined);
-                    let result = JsValue::new_object();
+                    let src = self.pop();
+                    let result = self.heap.track(JsValue::new_object());
                     if let JsValue::Object(src_rc) = &src {
                         let keys = src_rc.borrow().keys();
                         for key in keys {
@@ -731,7 +816,7 @@ impl Vm {
                             }
                         }
                     }
-                    self.stack.push(result);
+                    self.push(result);
                 }
 
                 Op::CloneLocal(slot) => {
@@ -754,6 +839,25 @@ impl Vm {
         }
     }
 
+    // ── Operand stack ──
+
+    #[inline]
+    pub fn push(&mut self, val: JsValue) {
+        self.stack.push(Value::from(val));
+    }
+
+    /// Pop the top value (`undefined` if the stack is empty).
+    #[inline]
+    pub fn pop(&mut self) -> JsValue {
+        self.stack.pop().map(Value::into_js).unwrap_or(JsValue::Undefined)
+    }
+
+    /// Copy of the top value (`undefined` if the stack is empty).
+    #[inline]
+    pub fn peek(&self) -> JsValue {
+        self.stack.last().map(Value::to_js).unwrap_or(JsValue::Undefined)
+    }
+
     // ── Helpers ──
 
     pub fn load_constant(&self, frame_idx: usize, idx: u16) -> JsValue {
@@ -772,24 +876,35 @@ impl Vm {
                     prototype: None,
                     own_props: BTreeMap::new(),
                 };
-                JsValue::Function(Rc::new(RefCell::new(func)))
+                self.heap.track(JsValue::Function(Rc::new(RefCell::new(func))))
             }
         }
     }
 
-    pub fn get_const_string(&self, frame_idx: usize, idx: u16) -> String {
+    /// String constant `idx` (shared, not copied).
+    pub fn get_const_string(&self, frame_idx: usize, idx: u16) -> JsStr {
         match &self.frames[frame_idx].chunk.constants[idx as usize] {
             Constant::String(s) => s.clone(),
-            Constant::Number(n) => format_number(*n),
-            _ => String::new(),
+            Constant::Number(n) => JsStr::from(format_number(*n)),
+            _ => JsStr::from(""),
         }
     }
 
+    /// Whether constant `idx` is the string `s` (without cloning it).
+    pub fn const_is_str(&self, frame_idx: usize, idx: u16, s: &str) -> bool {
+        matches!(&self.frames[frame_idx].chunk.constants[idx as usize], Constant::String(c) if c == s)
+    }
+
     /// Get property with prototype chain lookup.
     pub fn get_property_with_proto(&self, val: &JsValue, key: &str) -> JsValue {
         match val {
             JsValue::Object(obj) => {
                 let o = obj.borrow();
+                if let (Some(view), Some(idx)) = (&o.view, try_parse_index(key)) {
+                    if view.typed_len().is_some() {
+                        return view.get_index(idx).map(JsValue::Number).unwrap_or(JsValue::Undefined);
+                    }
+                }
                 if let Some(prop) = o.properties.get(key) {
                     return prop.value.clone();
                 }
@@ -821,9 +936,7 @@ impl Vm {
                 }
                 if let Some(idx) = try_parse_index(key) {
                     if let Some(ch) = s.chars().nth(idx) {
-                        let mut buf = String::new();
-                        buf.push(ch);
-                        return JsValue::String(buf);
+                        return JsValue::String(JsStr::from(ch));
                     }
                 }
                 get_proto_prop_rc(&self.string_proto, key)
@@ -839,8 +952,8 @@ impl Vm {
                 }
                 if key == "name" {
                     return func.name.as_ref()
-                        .map(|n| JsValue::String(n.clone()))
-                        .unwrap_or(JsValue::String(String::new()));
+                        .map(|n| JsValue::String(JsStr::from(n)))
+                        .unwrap_or(JsValue::String(JsStr::from("")));
                 }
                 if key == "length" {
                     return JsValue::Number(func.params.len() as f64);
@@ -853,6 +966,7 @@ impl Vm {
                     // Create and cache a new prototype on first access.
                     drop(func);
                     let proto = Rc::new(RefCell::new(JsObject::new()));
+                    self.heap.track_object(&proto);
                     f.borrow_mut().prototype = Some(proto.clone());
                     return JsValue::Object(proto);
                 }
@@ -865,40 +979,93 @@ impl Vm {
 
     pub fn op_add(&self, a: &JsValue, b: &JsValue) -> JsValue {
         match (a, b) {
-            (JsValue::String(sa), _) => {
-                let mut result = sa.clone();
-                result.push_str(&b.to_js_string());
-                JsValue::String(result)
-            }
-            (_, JsValue::String(sb)) => {
-                let mut result = a.to_js_string();
-                result.push_str(sb);
-                JsValue::String(result)
-            }
+            (JsValue::String(sa), _) => JsValue::String(sa.concat(&b.to_js_str())),
+            (_, JsValue::String(sb)) => JsValue::String(a.to_js_str().concat(sb)),
             _ => JsValue::Number(a.to_number() + b.to_number()),
         }
     }
 
+    #[inline]
+    fn get_local(&self, frame_idx: usize, slot: u16) -> JsValue {
+        self.frames[frame_idx].locals
+            .get(slot as usize)
+            .map(|c| c.borrow().clone())
+            .unwrap_or(JsValue::Undefined)
+    }
+
+    /// Local `slot` packed for the stack, without an intermediate `JsValue`.
+    #[inline]
+    fn get_local_value(&self, frame_idx: usize, slot: u16) -> Value {
+        self.frames[frame_idx].locals
+            .get(slot as usize)
+            .map(|c| Value::from_ref(&c.borrow()))
+            .unwrap_or(Value::UNDEFINED)
+    }
+
+    #[inline]
+    fn set_local(&mut self, frame_idx: usize, slot: u16, val: JsValue) {
+        let locals = &mut self.frames[frame_idx].locals;
+        while locals.len() <= slot as usize {
+            locals.push(Rc::new(RefCell::new(JsValue::Undefined)));
+        }
+        *locals[slot as usize].borrow_mut() = val;
+    }
+
+    /// Pop the two top values if both are numbers (the typed fast path of
+    /// the binary operators); otherwise leave the stack alone.
+    #[inline]
+    fn pop_numbers(&mut self) -> Option<(f64, f64)> {
+        let n = self.stack.len();
+        if n < 2 {
+            return None;
+        }
+        let pair = (self.stack[n - 2].as_number()?, self.stack[n - 1].as_number()?);
+        // Numbers own nothing, so truncating drops no references.
+        self.stack.truncate(n - 2);
+        Some(pair)
+    }
+
     fn binary_num_op(&mut self, f: fn(f64, f64) -> f64) {
-        let b = self.stack.pop().unwrap_or(JsValue::Undefined).to_number();
-        let a = self.stack.pop().unwrap_or(JsValue::Undefined).to_number();
-        self.stack.push(JsValue::Number(f(a, b)));
+        if let Some((a, b)) = self.pop_numbers() {
+            self.stack.push(Value::number(f(a, b)));
+            return;
+        }
+        let b = self.pop().to_number();
+        let a = self.pop().to_number();
+        self.push(JsValue::Number(f(a, b)));
     }
 
     fn binary_int_op(&mut self, f: fn(i32, i32) -> i32) {
-        let b = self.stack.pop().unwrap_or(JsValue::Undefined).to_number() as i32;
-        let a = self.stack.pop().unwrap_or(JsValue::Undefined).to_number() as i32;
-        self.stack.push(JsValue::Number(f(a, b) as f64));
+        let b = self.pop().to_number() as i32;
+        let a = self.pop().to_number() as i32;
+        self.push(JsValue::Number(f(a, b) as f64));
     }
 
     fn compare_op(&mut self, f: fn(f64, f64) -> bool) {
-        let b = self.stack.pop().unwrap_or(JsValue::Undefined);
-        let a = self.stack.pop().unwrap_or(JsValue::Undefined);
+        let result = self.pop_compare(f);
+        self.stack.push(Value::bool(result));
+    }
+
+    /// Pop two values and compare them (strings by code units).
+    fn pop_compare(&mut self, f: fn(f64, f64) -> bool) -> bool {
+        if let Some((a, b)) = self.pop_numbers() {
+            return f(a, b);
+        }
+        let b = self.pop();
+        let a = self.pop();
         if let (JsValue::String(sa), JsValue::String(sb)) = (&a, &b) {
             let cmp = if *sa < *sb { -1.0 } else if *sa > *sb { 1.0 } else { 0.0 };
-            self.stack.push(JsValue::Bool(f(cmp, 0.0)));
+            f(cmp, 0.0)
         } else {
-            self.stack.push(JsValue::Bool(f(a.to_number(), b.to_number())));
+            f(a.to_number(), b.to_number())
+        }
+    }
+
+    /// Fused compare-and-branch: jump by `offset` unless `f` holds.
+    fn compare_jump(&mut self, frame_idx: usize, offset: i32, f: fn(f64, f64) -> bool) {
+        if !self.pop_compare(f) {
+            let ip = self.frames[frame_idx].ip as i32 + offset;
+            self.frames[frame_idx].ip = ip as usize;
         }
     }
 
@@ -911,7 +1078,7 @@ impl Vm {
             if let Some(frame) = self.frames.last_mut() {
                 frame.ip = handler.catch_ip;
             }
-            self.stack.push(val);
+            self.push(val);
             true
         } else {
             self.log_engine("[libjs] WARN: unhandled exception");
@@ -936,6 +1103,52 @@ pub fn get_proto_prop_rc(proto: &Rc<RefCell<JsObject>>, key: &str) -> JsValue {
     JsValue::Undefined
 }
 
+/// A number key as an element index (`-0` is index 0, as its string is).
+#[inline]
+fn element_index(key: &JsValue) -> Option<usize> {
+    match key {
+        JsValue::Number(n) if *n >= 0.0 && *n <= u32::MAX as f64 && (*n as usize) as f64 == *n => {
+            Some(*n as usize)
+        }
+        _ => None,
+    }
+}
+
+/// `obj[key]` for a number key into an array or typed array, without
+/// the round trip through a string key.  `None` takes the generic path.
+#[inline]
+fn get_element(obj: &JsValue, key: &JsValue) -> Option<JsValue> {
+    let idx = element_index(key)?;
+    match obj {
+        JsValue::Array(a) => Some(a.borrow().get(idx)),
+        JsValue::Object(o) => {
+            let o = o.borrow();
+            let view = o.view.as_ref()?;
+            view.typed_len()?;
+            Some(view.get_index(idx).map(JsValue::Number).unwrap_or(JsValue::Undefined))
+        }
+        _ => None,
+    }
+}
+
+/// `obj[key] = val` counterpart of [`get_element`]; `false` if the
+/// generic path must handle it.
+#[inline]
+fn set_element(obj: &JsValue, key: &JsValue, val: &JsValue) -> bool {
+    let Some(idx) = element_index(key) else { return false };
+    match obj {
+        JsValue::Array(a) => {
+            a.borrow_mut().set(idx, val.clone());
+            true
+        }
+        JsValue::Object(o) => match &o.borrow().view {
+            Some(view) => view.set_index(idx, val.to_number()),
+            None => false,
+        },
+        _ => false,
+    }
+}
+
 pub fn try_parse_index(s: &str) -> Option<usize> {
     if s.is_empty() { return None; }
     let mut n: usize = 0;
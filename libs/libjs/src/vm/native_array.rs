@@ -6,8 +6,9 @@ use alloc::vec;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
+use crate::elements::Elements;
 use crate::value::*;
-use super::Vm;
+use super::{Vm, native_buffer};
 
 // ═══════════════════════════════════════════════════════════
 // Helper: extract array elements from `this`
@@ -92,7 +93,7 @@ pub fn array_splice(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         } else {
             len - start
         };
-        let removed: Vec<JsValue> = a.elements.drain(start..start + delete_count).collect();
+        let removed: Vec<JsValue> = a.elements.drain(start, start + delete_count);
         // Insert new elements
         if args.len() > 2 {
             for (i, item) in args[2..].iter().enumerate() {
@@ -122,7 +123,7 @@ pub fn array_sort(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         // Extract elements, sort, put back
         let mut elements = {
             let a = arr.borrow();
-            a.elements.clone()
+            a.elements.to_vec()
         };
 
         if let Some(cmp) = &comparefn {
@@ -149,8 +150,11 @@ pub fn array_sort(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         }
 
         {
+            // Store back in place so the array keeps its element kind.
             let mut a = arr.borrow_mut();
-            a.elements = elements;
+            for (i, v) in elements.into_iter().enumerate() {
+                a.elements.set(i, v);
+            }
         }
         JsValue::Array(arr)
     } else {
@@ -166,7 +170,7 @@ pub fn array_fill(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let start = resolve_index(args.get(1).map(|v| v.to_number()).unwrap_or(0.0), len);
         let end = resolve_index(args.get(2).map(|v| v.to_number()).unwrap_or(len as f64), len);
         for i in start..end {
-            a.elements[i] = value.clone();
+            a.elements.set(i, value.clone());
         }
         drop(a);
         JsValue::Array(arr)
@@ -183,9 +187,9 @@ pub fn array_copy_within(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let start = resolve_index(args.get(1).map(|v| v.to_number()).unwrap_or(0.0), len);
         let end = resolve_index(args.get(2).map(|v| v.to_number()).unwrap_or(len as f64), len);
         let count = (end - start).min(len - target);
-        let copy: Vec<JsValue> = a.elements[start..start + count].to_vec();
-        for (i, v) in copy.into_iter().enumerate() {
-            a.elements[target + i] = v;
+        let copy = a.elements.slice(start, start + count);
+        for (i, v) in copy.iter().enumerate() {
+            a.elements.set(target + i, v);
         }
         drop(a);
         JsValue::Array(arr)
@@ -204,7 +208,7 @@ pub fn array_index_of(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let search = args.first().cloned().unwrap_or(JsValue::Undefined);
         let from = args.get(1).map(|v| v.to_number() as usize).unwrap_or(0);
         for i in from..a.elements.len() {
-            if a.elements[i].strict_eq(&search) {
+            if a.get(i).strict_eq(&search) {
                 return JsValue::Number(i as f64);
             }
         }
@@ -223,7 +227,7 @@ pub fn array_last_index_of(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         }).unwrap_or(if len > 0 { len - 1 } else { 0 });
         if len == 0 { return JsValue::Number(-1.0); }
         for i in (0..=from).rev() {
-            if a.elements[i].strict_eq(&search) {
+            if a.get(i).strict_eq(&search) {
                 return JsValue::Number(i as f64);
             }
         }
@@ -237,11 +241,12 @@ pub fn array_includes(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let search = args.first().cloned().unwrap_or(JsValue::Undefined);
         let from = args.get(1).map(|v| resolve_index(v.to_number(), a.elements.len())).unwrap_or(0);
         for i in from..a.elements.len() {
-            if a.elements[i].strict_eq(&search) {
+            let el = a.get(i);
+            if el.strict_eq(&search) {
                 return JsValue::Bool(true);
             }
             // NaN check: NaN !== NaN but includes should find NaN
-            if let (JsValue::Number(a_n), JsValue::Number(s_n)) = (&a.elements[i], &search) {
+            if let (JsValue::Number(a_n), JsValue::Number(s_n)) = (&el, &search) {
                 if a_n.is_nan() && s_n.is_nan() {
                     return JsValue::Bool(true);
                 }
@@ -266,9 +271,9 @@ pub fn array_join(vm: &mut Vm, args: &[JsValue]) -> JsValue {
                 _ => out.push_str(&el.to_js_string()),
             }
         }
-        JsValue::String(out)
+        JsValue::String(JsStr::from(out))
     } else {
-        JsValue::String(String::new())
+        JsValue::String(JsStr::from(""))
     }
 }
 
@@ -278,33 +283,28 @@ pub fn array_slice(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let len = a.elements.len();
         let start = resolve_index(args.first().map(|v| v.to_number()).unwrap_or(0.0), len);
         let end = resolve_index(args.get(1).map(|v| v.to_number()).unwrap_or(len as f64), len);
-        let result: Vec<JsValue> = if start < end {
-            a.elements[start..end].to_vec()
-        } else {
-            Vec::new()
-        };
-        JsValue::Array(Rc::new(RefCell::new(JsArray::from_vec(result))))
+        let mut result = JsArray::new();
+        if start < end {
+            result.elements = a.elements.slice(start, end);
+        }
+        JsValue::Array(Rc::new(RefCell::new(result)))
     } else {
         JsValue::new_array(Vec::new())
     }
 }
 
 pub fn array_concat(vm: &mut Vm, args: &[JsValue]) -> JsValue {
-    let mut result = Vec::new();
+    let mut result = JsArray::new();
     if let Some(arr) = this_array(vm) {
-        let a = arr.borrow();
-        result.extend(a.elements.iter().cloned());
+        result.elements = arr.borrow().elements.clone();
     }
     for arg in args {
         match arg {
-            JsValue::Array(a) => {
-                let arr = a.borrow();
-                result.extend(arr.elements.iter().cloned());
-            }
-            _ => result.push(arg.clone()),
+            JsValue::Array(a) => result.elements.extend_from(&a.borrow().elements),
+            _ => result.elements.push(arg.clone()),
         }
     }
-    JsValue::Array(Rc::new(RefCell::new(JsArray::from_vec(result))))
+    JsValue::Array(Rc::new(RefCell::new(result)))
 }
 
 pub fn array_flat(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -318,17 +318,17 @@ pub fn array_flat(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     }
 }
 
-fn flatten_elements(elements: &[JsValue], depth: usize) -> Vec<JsValue> {
+fn flatten_elements(elements: &Elements, depth: usize) -> Vec<JsValue> {
     let mut result = Vec::new();
-    for el in elements {
+    for el in elements.iter() {
         if depth > 0 {
-            if let JsValue::Array(a) = el {
+            if let JsValue::Array(a) = &el {
                 let inner = a.borrow();
                 result.extend(flatten_elements(&inner.elements, depth - 1));
                 continue;
             }
         }
-        result.push(el.clone());
+        result.push(el);
     }
     result
 }
@@ -340,7 +340,7 @@ pub fn array_at(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let len = a.elements.len() as i64;
         let actual = if idx < 0 { len + idx } else { idx };
         if actual >= 0 && actual < len {
-            a.elements[actual as usize].clone()
+            a.get(actual as usize)
         } else {
             JsValue::Undefined
         }
@@ -419,7 +419,7 @@ pub fn array_for_each(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn array_reduce(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let callback = args.first().cloned().unwrap_or(JsValue::Undefined);
     if let Some(arr) = this_array(vm) {
-        let elements = arr.borrow().elements.clone();
+        let elements = arr.borrow().elements.to_vec();
         let mut start_idx = 0;
         let mut acc = if args.len() > 1 {
             args[1].clone()
@@ -440,7 +440,7 @@ pub fn array_reduce(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn array_reduce_right(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let callback = args.first().cloned().unwrap_or(JsValue::Undefined);
     if let Some(arr) = this_array(vm) {
-        let elements = arr.borrow().elements.clone();
+        let elements = arr.borrow().elements.to_vec();
         let len = elements.len();
         if len == 0 && args.len() <= 1 { return JsValue::Undefined; }
         let mut acc = if args.len() > 1 {
@@ -524,7 +524,7 @@ pub fn array_flat_map(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             match val {
                 JsValue::Array(a) => {
                     let inner = a.borrow();
-                    result.extend(inner.elements.iter().cloned());
+                    result.extend(inner.elements.iter());
                 }
                 _ => result.push(val),
             }
@@ -566,7 +566,9 @@ pub fn array_keys(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
 pub fn array_values(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     if let Some(arr) = this_array(vm) {
         let a = arr.borrow();
-        JsValue::Array(Rc::new(RefCell::new(JsArray::from_vec(a.elements.clone()))))
+        let mut copy = JsArray::new();
+        copy.elements = a.elements.clone();
+        JsValue::Array(Rc::new(RefCell::new(copy)))
     } else {
         JsValue::new_array(Vec::new())
     }
@@ -584,13 +586,9 @@ pub fn array_from(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let source = args.first().cloned().unwrap_or(JsValue::Undefined);
     let map_fn = args.get(1).cloned();
     let elements: Vec<JsValue> = match &source {
-        JsValue::Array(a) => a.borrow().elements.clone(),
-        JsValue::String(s) => s.chars().map(|c| {
-            let mut buf = String::new();
-            buf.push(c);
-            JsValue::String(buf)
-        }).collect(),
-        _ => Vec::new(),
+        JsValue::Array(a) => a.borrow().elements.to_vec(),
+        JsValue::String(s) => s.chars().map(|c| JsValue::String(JsStr::from(c))).collect(),
+        _ => native_buffer::typed_values(&source).unwrap_or_default(),
     };
     if let Some(callback) = map_fn {
         let mut result = Vec::with_capacity(elements.len());
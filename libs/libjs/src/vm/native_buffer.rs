@@ -0,0 +1,500 @@
+//! ArrayBuffer, typed arrays and DataView.
+//!
+//! The objects carry a [`BufferView`] (see [`crate::buffer`]); their fixed
+//! `length` / `byteLength` / `byteOffset` / `buffer` are read-only,
+//! non-enumerable properties and their methods live on shared prototypes.
+
+use alloc::rc::Rc;
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::cell::RefCell;
+
+use crate::buffer::{BufferView, ByteBuffer, TypedKind};
+use crate::value::*;
+use super::{Vm, native_fn};
+use super::native_array::call_callback_pub;
+
+fn fixed(value: JsValue) -> Property {
+    Property { value, writable: false, enumerable: false, configurable: false }
+}
+
+/// The elements of a typed array value, boxed.
+pub fn typed_values(val: &JsValue) -> Option<Vec<JsValue>> {
+    let view = val.view()?;
+    let len = view.typed_len()?;
+    Some((0..len).map(|i| JsValue::Number(view.get_index(i).unwrap_or(0.0))).collect())
+}
+
+fn this_view(vm: &Vm) -> Option<BufferView> {
+    vm.current_this.view()
+}
+
+fn arg_num(args: &[JsValue], i: usize) -> f64 {
+    args.get(i).map(|v| v.to_number()).unwrap_or(f64::NAN)
+}
+
+/// Resolve a relative (possibly negative) `begin`/`end` argument.
+fn relative(arg: Option<&JsValue>, len: usize, default: usize) -> usize {
+    match arg {
+        None | Some(JsValue::Undefined) => default,
+        Some(v) => {
+            let n = v.to_number();
+            if n.is_nan() {
+                0
+            } else if n < 0.0 {
+                (len as f64 + n).max(0.0) as usize
+            } else {
+                (n as usize).min(len)
+            }
+        }
+    }
+}
+
+/// A non-negative integer argument (ToIndex), or `None` if out of range.
+fn to_index(arg: Option<&JsValue>) -> Option<usize> {
+    match arg {
+        None | Some(JsValue::Undefined) => Some(0),
+        Some(v) => {
+            let n = v.to_number();
+            let n = if n.is_nan() { 0.0 } else { n };
+            if n < 0.0 || n > u32::MAX as f64 { None } else { Some(n as usize) }
+        }
+    }
+}
+
+impl Vm {
+    /// A new `ArrayBuffer` owning `bytes` (not copied).
+    pub fn new_array_buffer(&self, bytes: Vec<u8>) -> JsValue {
+        let len = bytes.len();
+        let mut obj = JsObject::new();
+        obj.prototype = Some(self.array_buffer_proto.clone());
+        obj.view = Some(alloc::boxed::Box::new(BufferView::Buffer(Rc::new(RefCell::new(bytes)))));
+        obj.properties.insert(JsStr::from("byteLength"), fixed(JsValue::Number(len as f64)));
+        JsValue::Object(Rc::new(RefCell::new(obj)))
+    }
+
+    /// A typed array of `kind` over all of `bytes` (not copied; a trailing
+    /// partial element is not addressable).
+    pub fn new_typed_array(&self, kind: TypedKind, bytes: Vec<u8>) -> JsValue {
+        let length = bytes.len() / kind.size();
+        let buffer = self.new_array_buffer(bytes);
+        self.typed_array_on(kind, &buffer, 0, length)
+    }
+
+    /// A typed array of `length` elements of `buffer` (an `ArrayBuffer`
+    /// value) from byte `offset`; the caller checks the bounds.
+    pub fn typed_array_on(&self, kind: TypedKind, buffer: &JsValue, offset: usize, length: usize) -> JsValue {
+        let Some(bytes) = buffer.view().map(|v| v.buffer().clone()) else {
+            return JsValue::Undefined;
+        };
+        let mut obj = JsObject::new();
+        obj.prototype = Some(self.typed_protos[kind.index()].clone());
+        obj.view = Some(alloc::boxed::Box::new(BufferView::Typed { kind, buffer: bytes, offset, length }));
+        obj.properties.insert(JsStr::from("length"), fixed(JsValue::Number(length as f64)));
+        obj.properties.insert(JsStr::from("byteLength"), fixed(JsValue::Number((length * kind.size()) as f64)));
+        obj.properties.insert(JsStr::from("byteOffset"), fixed(JsValue::Number(offset as f64)));
+        obj.properties.insert(JsStr::from("buffer"), fixed(buffer.clone()));
+        JsValue::Object(Rc::new(RefCell::new(obj)))
+    }
+
+    /// Create `ArrayBuffer.prototype`, `%TypedArray%.prototype`, one
+    /// prototype per element kind, `DataView.prototype`, and the global
+    /// constructors.
+    pub(super) fn init_buffers(&mut self) {
+        {
+            let mut p = self.array_buffer_proto.borrow_mut();
+            p.prototype = Some(self.object_proto.clone());
+            p.set(String::from("slice"), native_fn("slice", array_buffer_slice));
+        }
+        let ab_ctor = native_fn("ArrayBuffer", ctor_array_buffer);
+        ab_ctor.set_property(String::from("isView"), native_fn("isView", array_buffer_is_view));
+        ab_ctor.set_property(String::from("prototype"), JsValue::Object(self.array_buffer_proto.clone()));
+        self.set_global("ArrayBuffer", ab_ctor);
+
+        let typed_proto = Rc::new(RefCell::new(JsObject::new()));
+        {
+            let mut p = typed_proto.borrow_mut();
+            p.prototype = Some(self.object_proto.clone());
+            p.set(String::from("set"), native_fn("set", typed_set));
+            p.set(String::from("subarray"), native_fn("subarray", typed_subarray));
+            p.set(String::from("slice"), native_fn("slice", typed_slice));
+            p.set(String::from("fill"), native_fn("fill", typed_fill));
+            p.set(String::from("indexOf"), native_fn("indexOf", typed_index_of));
+            p.set(String::from("includes"), native_fn("includes", typed_includes));
+            p.set(String::from("join"), native_fn("join", typed_join));
+            p.set(String::from("toString"), native_fn("toString", typed_join));
+            p.set(String::from("forEach"), native_fn("forEach", typed_for_each));
+            p.set(String::from("map"), native_fn("map", typed_map));
+        }
+        let ctors: [fn(&mut Vm, &[JsValue]) -> JsValue; 9] = [
+            ctor_int8_array, ctor_uint8_array, ctor_uint8_clamped_array,
+            ctor_int16_array, ctor_uint16_array, ctor_int32_array,
+            ctor_uint32_array, ctor_float32_array, ctor_float64_array,
+        ];
+        self.typed_protos.clear();
+        for (kind, ctor_fn) in TypedKind::ALL.iter().zip(ctors) {
+            let bytes = JsValue::Number(kind.size() as f64);
+            let mut p = JsObject::new();
+            p.prototype = Some(typed_proto.clone());
+            p.set(String::from("BYTES_PER_ELEMENT"), bytes.clone());
+            let proto = Rc::new(RefCell::new(p));
+            let ctor = native_fn(kind.name(), ctor_fn);
+            ctor.set_property(String::from("BYTES_PER_ELEMENT"), bytes);
+            ctor.set_property(String::from("prototype"), JsValue::Object(proto.clone()));
+            proto.borrow_mut().set(String::from("constructor"), ctor.clone());
+            self.typed_protos.push(proto);
+            self.set_global(kind.name(), ctor);
+        }
+
+        {
+            let mut p = self.data_view_proto.borrow_mut();
+            p.prototype = Some(self.object_proto.clone());
+            p.set(String::from("getInt8"), native_fn("getInt8", dv_get_int8));
+            p.set(String::from("getUint8"), native_fn("getUint8", dv_get_uint8));
+            p.set(String::from("getInt16"), native_fn("getInt16", dv_get_int16));
+            p.set(String::from("getUint16"), native_fn("getUint16", dv_get_uint16));
+            p.set(String::from("getInt32"), native_fn("getInt32", dv_get_int32));
+            p.set(String::from("getUint32"), native_fn("getUint32", dv_get_uint32));
+            p.set(String::from("getFloat32"), native_fn("getFloat32", dv_get_float32));
+            p.set(String::from("getFloat64"), native_fn("getFloat64", dv_get_float64));
+            p.set(String::from("setInt8"), native_fn("setInt8", dv_set_int8));
+            p.set(String::from("setUint8"), native_fn("setUint8", dv_set_uint8));
+            p.set(String::from("setInt16"), native_fn("setInt16", dv_set_int16));
+            p.set(String::from("setUint16"), native_fn("setUint16", dv_set_uint16));
+            p.set(String::from("setInt32"), native_fn("setInt32", dv_set_int32));
+            p.set(String::from("setUint32"), native_fn("setUint32", dv_set_uint32));
+            p.set(String::from("setFloat32"), native_fn("setFloat32", dv_set_float32));
+            p.set(String::from("setFloat64"), native_fn("setFloat64", dv_set_float64));
+        }
+        let dv_ctor = native_fn("DataView", ctor_data_view);
+        dv_ctor.set_property(String::from("prototype"), JsValue::Object(self.data_view_proto.clone()));
+        self.set_global("DataView", dv_ctor);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════
+// ArrayBuffer
+// ═══════════════════════════════════════════════════════════
+
+/// `new ArrayBuffer(byteLength)` — zero-filled.
+pub fn ctor_array_buffer(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    match to_index(args.first()) {
+        Some(len) => vm.new_array_buffer(vec![0u8; len]),
+        None => {
+            let err = vm.make_range_error("Invalid array buffer length");
+            vm.throw_native(err);
+            JsValue::Undefined
+        }
+    }
+}
+
+pub fn array_buffer_is_view(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let is_view = matches!(
+        args.first().and_then(|v| v.view()),
+        Some(BufferView::Typed { .. } | BufferView::Data { .. })
+    );
+    JsValue::Bool(is_view)
+}
+
+/// `ArrayBuffer.prototype.slice(begin, end)` — a copy.
+pub fn array_buffer_slice(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let Some(BufferView::Buffer(bytes)) = this_view(vm) else {
+        return JsValue::Undefined;
+    };
+    let copy = {
+        let b = bytes.borrow();
+        let begin = relative(args.first(), b.len(), 0);
+        let end = relative(args.get(1), b.len(), b.len()).max(begin);
+        b[begin..end].to_vec()
+    };
+    vm.new_array_buffer(copy)
+}
+
+// ═══════════════════════════════════════════════════════════
+// Typed array constructors
+// ═══════════════════════════════════════════════════════════
+
+/// `new XArray(length | array | typedArray | buffer[, byteOffset[, length]])`.
+fn construct_typed(vm: &mut Vm, kind: TypedKind, args: &[JsValue]) -> JsValue {
+    let size = kind.size();
+    let source = args.first().cloned().unwrap_or(JsValue::Undefined);
+    let values: Vec<JsValue> = match &source {
+        JsValue::Array(a) => a.borrow().elements.to_vec(),
+        JsValue::Object(_) => match source.view() {
+            Some(BufferView::Buffer(bytes)) => {
+                let buf_len = bytes.borrow().len();
+                let offset = to_index(args.get(1));
+                let length = match args.get(2) {
+                    None | Some(JsValue::Undefined) => offset
+                        .filter(|&o| o <= buf_len && (buf_len - o) % size == 0)
+                        .map(|o| (buf_len - o) / size),
+                    len => to_index(len),
+                };
+                return match (offset, length) {
+                    (Some(o), Some(l)) if o % size == 0 && o + l * size <= buf_len => {
+                        vm.typed_array_on(kind, &source, o, l)
+                    }
+                    _ => {
+                        let err = vm.make_range_error("Invalid typed array length or offset");
+                        vm.throw_native(err);
+                        JsValue::Undefined
+                    }
+                };
+            }
+            Some(_) => typed_values(&source).unwrap_or_default(),
+            None => Vec::new(),
+        },
+        _ => match to_index(Some(&source)) {
+            Some(len) => return vm.new_typed_array(kind, vec![0u8; len * size]),
+            None => {
+                let err = vm.make_range_error("Invalid typed array length");
+                vm.throw_native(err);
+                return JsValue::Undefined;
+            }
+        },
+    };
+    let mut bytes = vec![0u8; values.len() * size];
+    for (i, v) in values.iter().enumerate() {
+        kind.write(&mut bytes[i * size..], v.to_number(), true);
+    }
+    vm.new_typed_array(kind, bytes)
+}
+
+macro_rules! typed_ctor {
+    ($($name:ident => $kind:ident),* $(,)?) => {$(
+        pub fn $name(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+            construct_typed(vm, TypedKind::$kind, args)
+        }
+    )*};
+}
+
+typed_ctor! {
+    ctor_int8_array => Int8,
+    ctor_uint8_array => Uint8,
+    ctor_uint8_clamped_array => Uint8Clamped,
+    ctor_int16_array => Int16,
+    ctor_uint16_array => Uint16,
+    ctor_int32_array => Int32,
+    ctor_uint32_array => Uint32,
+    ctor_float32_array => Float32,
+    ctor_float64_array => Float64,
+}
+
+// ═══════════════════════════════════════════════════════════
+// %TypedArray%.prototype
+// ═══════════════════════════════════════════════════════════
+
+/// `this` as (kind, offset, length) of a typed array.
+fn this_typed(vm: &Vm) -> Option<(TypedKind, ByteBuffer, usize, usize)> {
+    match this_view(vm)? {
+        BufferView::Typed { kind, buffer, offset, length } => Some((kind, buffer, offset, length)),
+        _ => None,
+    }
+}
+
+/// `ta.set(source[, offset])` — copy an array or typed array into `ta`.
+pub fn typed_set(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let Some(view) = this_view(vm) else { return JsValue::Undefined };
+    let Some(len) = view.typed_len() else { return JsValue::Undefined };
+    let source = args.first().cloned().unwrap_or(JsValue::Undefined);
+    let values = match &source {
+        JsValue::Array(a) => a.borrow().elements.to_vec(),
+        _ => typed_values(&source).unwrap_or_default(),
+    };
+    let offset = to_index(args.get(1));
+    match offset {
+        Some(o) if o + values.len() <= len => {
+            for (i, v) in values.iter().enumerate() {
+                view.set_index(o + i, v.to_number());
+            }
+        }
+        _ => {
+            let err = vm.make_range_error("Source is too large");
+            vm.throw_native(err);
+        }
+    }
+    JsValue::Undefined
+}
+
+/// `ta.subarray(begin, end)` — a new view on the same bytes.
+pub fn typed_subarray(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let Some((kind, _, offset, length)) = this_typed(vm) else { return JsValue::Undefined };
+    let begin = relative(args.first(), length, 0);
+    let end = relative(args.get(1), length, length).max(begin);
+    let buffer = vm.current_this.get_property("buffer");
+    vm.typed_array_on(kind, &buffer, offset + begin * kind.size(), end - begin)
+}
+
+/// `ta.slice(begin, end)` — a copy.
+pub fn typed_slice(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let Some((kind, buffer, offset, length)) = this_typed(vm) else { return JsValue::Undefined };
+    let begin = relative(args.first(), length, 0);
+    let end = relative(args.get(1), length, length).max(begin);
+    let size = kind.size();
+    let bytes = buffer.borrow()[offset + begin * size..offset + end * size].to_vec();
+    vm.new_typed_array(kind, bytes)
+}
+
+pub fn typed_fill(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    if let Some(view) = this_view(vm) {
+        let len = view.typed_len().unwrap_or(0);
+        let value = arg_num(args, 0);
+        let start = relative(args.get(1), len, 0);
+        let end = relative(args.get(2), len, len);
+        for i in start..end {
+            view.set_index(i, value);
+        }
+    }
+    vm.current_this.clone()
+}
+
+fn typed_find(vm: &Vm, args: &[JsValue]) -> Option<usize> {
+    let view = this_view(vm)?;
+    let len = view.typed_len()?;
+    let search = match args.first() {
+        Some(JsValue::Number(n)) => *n,
+        _ => return None,
+    };
+    let from = relative(args.get(1), len, 0);
+    (from..len).find(|&i| view.get_index(i) == Some(search))
+}
+
+pub fn typed_index_of(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    JsValue::Number(typed_find(vm, args).map(|i| i as f64).unwrap_or(-1.0))
+}
+
+pub fn typed_includes(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    JsValue::Bool(typed_find(vm, args).is_some())
+}
+
+pub fn typed_join(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let sep = match args.first() {
+        Some(JsValue::Undefined) | None => String::from(","),
+        Some(v) => v.to_js_string(),
+    };
+    let values = typed_values(&vm.current_this).unwrap_or_default();
+    let mut out = String::new();
+    for (i, v) in values.iter().enumerate() {
+        if i > 0 {
+            out.push_str(&sep);
+        }
+        out.push_str(&v.to_js_string());
+    }
+    JsValue::String(JsStr::from(out))
+}
+
+pub fn typed_for_each(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let callback = args.first().cloned().unwrap_or(JsValue::Undefined);
+    let this = vm.current_this.clone();
+    let values = typed_values(&this).unwrap_or_default();
+    for (i, v) in values.into_iter().enumerate() {
+        call_callback_pub(vm, &callback, &[v, JsValue::Number(i as f64), this.clone()]);
+    }
+    JsValue::Undefined
+}
+
+/// `ta.map(fn)` — a new typed array of the same kind.
+pub fn typed_map(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let Some((kind, ..)) = this_typed(vm) else { return JsValue::Undefined };
+    let callback = args.first().cloned().unwrap_or(JsValue::Undefined);
+    let this = vm.current_this.clone();
+    let values = typed_values(&this).unwrap_or_default();
+    let size = kind.size();
+    let mut bytes = vec![0u8; values.len() * size];
+    for (i, v) in values.into_iter().enumerate() {
+        let mapped = call_callback_pub(vm, &callback, &[v, JsValue::Number(i as f64), this.clone()]);
+        kind.write(&mut bytes[i * size..], mapped.to_number(), true);
+    }
+    vm.new_typed_array(kind, bytes)
+}
+
+// ═══════════════════════════════════════════════════════════
+// DataView
+// ═══════════════════════════════════════════════════════════
+
+/// `new DataView(buffer[, byteOffset[, byteLength]])`.
+pub fn ctor_data_view(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+    let buffer = args.first().cloned().unwrap_or(JsValue::Undefined);
+    let Some(BufferView::Buffer(bytes)) = buffer.view() else {
+        let err = vm.make_type_error("DataView requires an ArrayBuffer");
+        vm.throw_native(err);
+        return JsValue::Undefined;
+    };
+    let buf_len = bytes.borrow().len();
+    let offset = to_index(args.get(1)).filter(|&o| o <= buf_len);
+    let length = match (offset, args.get(2)) {
+        (Some(o), None | Some(JsValue::Undefined)) => Some(buf_len - o),
+        (Some(o), len) => to_index(len).filter(|&l| o + l <= buf_len),
+        (None, _) => None,
+    };
+    let (Some(offset), Some(length)) = (offset, length) else {
+        let err = vm.make_range_error("Invalid DataView length or offset");
+        vm.throw_native(err);
+        return JsValue::Undefined;
+    };
+    let mut obj = JsObject::new();
+    obj.prototype = Some(vm.data_view_proto.clone());
+    obj.view = Some(alloc::boxed::Box::new(BufferView::Data { buffer: bytes, offset, length }));
+    obj.properties.insert(JsStr::from("byteLength"), fixed(JsValue::Number(length as f64)));
+    obj.properties.insert(JsStr::from("byteOffset"), fixed(JsValue::Number(offset as f64)));
+    obj.properties.insert(JsStr::from("buffer"), fixed(buffer));
+    JsValue::Object(Rc::new(RefCell::new(obj)))
+}
+
+/// Byte position of a `kind` access at `args[0]` in a DataView `this`,
+/// or a thrown RangeError.
+fn dv_locate(vm: &mut Vm, kind: TypedKind, args: &[JsValue]) -> Option<(ByteBuffer, usize)> {
+    let Some(BufferView::Data { buffer, offset, length }) = this_view(vm) else {
+        let err = vm.make_type_error("not a DataView");
+        vm.throw_native(err);
+        return None;
+    };
+    match to_index(args.first()) {
+        Some(at) if at + kind.size() <= length => Some((buffer, offset + at)),
+        _ => {
+            let err = vm.make_range_error("Offset is outside the bounds of the DataView");
+            vm.throw_native(err);
+            None
+        }
+    }
+}
+
+fn dv_get(vm: &mut Vm, kind: TypedKind, args: &[JsValue]) -> JsValue {
+    let little = args.get(1).map(|v| v.to_boolean()).unwrap_or(false);
+    match dv_locate(vm, kind, args) {
+        Some((buffer, at)) => JsValue::Number(kind.read(&buffer.borrow()[at..], little)),
+        None => JsValue::Undefined,
+    }
+}
+
+fn dv_set(vm: &mut Vm, kind: TypedKind, args: &[JsValue]) -> JsValue {
+    let value = arg_num(args, 1);
+    let little = args.get(2).map(|v| v.to_boolean()).unwrap_or(false);
+    if let Some((buffer, at)) = dv_locate(vm, kind, args) {
+        kind.write(&mut buffer.borrow_mut()[at..], value, little);
+    }
+    JsValue::Undefined
+}
+
+macro_rules! dv_accessors {
+    ($($get:ident, $set:ident => $kind:ident;)*) => {$(
+        pub fn $get(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+            dv_get(vm, TypedKind::$kind, args)
+        }
+        pub fn $set(vm: &mut Vm, args: &[JsValue]) -> JsValue {
+            dv_set(vm, TypedKind::$kind, args)
+        }
+    )*};
+}
+
+dv_accessors! {
+    dv_get_int8, dv_set_int8 => Int8;
+    dv_get_uint8, dv_set_uint8 => Uint8;
+    dv_get_int16, dv_set_int16 => Int16;
+    dv_get_uint16, dv_set_uint16 => Uint16;
+    dv_get_int32, dv_set_int32 => Int32;
+    dv_get_uint32, dv_set_uint32 => Uint32;
+    dv_get_float32, dv_set_float32 => Float32;
+    dv_get_float64, dv_set_float64 => Float64;
+}
@@ -1,4 +1,4 @@
-//! console.log / console.warn / console.error
+//! console.log / console.warn / console.error / console.heap
 
 use alloc::string::String;
 
@@ -29,6 +29,19 @@ pub fn console_error(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     JsValue::Undefined
 }
 
+/// `console.heap()` — cycle collector statistics as an object.
+pub fn console_heap(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
+    let s = vm.heap.stats();
+    let obj = JsValue::new_object();
+    obj.set_property(String::from("tracked"), JsValue::Number(s.tracked as f64));
+    obj.set_property(String::from("young"), JsValue::Number(s.young as f64));
+    obj.set_property(String::from("old"), JsValue::Number(s.old as f64));
+    obj.set_property(String::from("collections"), JsValue::Number(s.collections as f64));
+    obj.set_property(String::from("fullCollections"), JsValue::Number(s.full_collections as f64));
+    obj.set_property(String::from("freed"), JsValue::Number(s.freed as f64));
+    obj
+}
+
 // ═══════════════════════════════════════════════════════════
 // Helper
 // ═══════════════════════════════════════════════════════════
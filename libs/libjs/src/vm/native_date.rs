@@ -206,15 +206,15 @@ pub fn date_set_time(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
 pub fn date_to_iso_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let ms_val = get_ms(vm);
-    if ms_val.is_nan() { return JsValue::String(String::from("Invalid Date")); }
+    if ms_val.is_nan() { return JsValue::String(JsStr::from("Invalid Date")); }
     let (y, mo, d, h, mi, s, ms) = decompose(ms_val);
     let result = format!("{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.{:03}Z", y, mo + 1, d, h, mi, s, ms);
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 pub fn date_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let ms_val = get_ms(vm);
-    if ms_val.is_nan() { return JsValue::String(String::from("Invalid Date")); }
+    if ms_val.is_nan() { return JsValue::String(JsStr::from("Invalid Date")); }
     let (y, mo, d, h, mi, s, _) = decompose(ms_val);
     let months = ["Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"];
     let days = ["Sun","Mon","Tue","Wed","Thu","Fri","Sat"];
@@ -224,7 +224,7 @@ pub fn date_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     };
     let result = format!("{} {} {:02} {} {:02}:{:02}:{:02} GMT",
         days[day_of_week], months[mo as usize], d, y, h, mi, s);
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 // ═══════════════════════════════════════════════════════════
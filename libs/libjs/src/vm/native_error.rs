@@ -22,8 +22,8 @@ pub fn ctor_error(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj_rc) = &vm.current_this.clone() {
         // Called as a constructor or super() — set properties on the existing object.
         let mut o = obj_rc.borrow_mut();
-        o.set(String::from("message"), JsValue::String(message));
-        o.set(String::from("name"), JsValue::String(String::from("Error")));
+        o.set(String::from("message"), JsValue::String(JsStr::from(message)));
+        o.set(String::from("name"), JsValue::String(JsStr::from("Error")));
         // Ensure the prototype is error_proto if not already set to something useful.
         if o.prototype.is_none() {
             o.prototype = Some(vm.error_proto.clone());
@@ -34,8 +34,8 @@ pub fn ctor_error(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     // Called as a plain function (rare) — create a new error object.
     let mut obj = JsObject::new();
     obj.prototype = Some(vm.error_proto.clone());
-    obj.set(String::from("message"), JsValue::String(message));
-    obj.set(String::from("name"), JsValue::String(String::from("Error")));
+    obj.set(String::from("message"), JsValue::String(JsStr::from(message)));
+    obj.set(String::from("name"), JsValue::String(JsStr::from("Error")));
     JsValue::Object(Rc::new(RefCell::new(obj)))
 }
 
@@ -56,14 +56,14 @@ pub fn error_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
                 None => String::new(),
             };
             if message.is_empty() {
-                JsValue::String(name)
+                JsValue::String(JsStr::from(name))
             } else {
                 let mut s = name;
                 s.push_str(": ");
                 s.push_str(&message);
-                JsValue::String(s)
+                JsValue::String(JsStr::from(s))
             }
         }
-        _ => JsValue::String(String::from("Error")),
+        _ => JsValue::String(JsStr::from("Error")),
     }
 }
@@ -31,7 +31,7 @@ pub fn function_apply(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let func = vm.current_this.clone();
     let this_arg = args.first().cloned().unwrap_or(JsValue::Undefined);
     let call_args: Vec<JsValue> = match args.get(1) {
-        Some(JsValue::Array(arr)) => arr.borrow().elements.clone(),
+        Some(JsValue::Array(arr)) => arr.borrow().elements.to_vec(),
         _ => Vec::new(),
     };
 
@@ -85,9 +85,9 @@ pub fn function_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
         JsValue::Function(f) => {
             let func = f.borrow();
             let name = func.name.as_deref().unwrap_or("anonymous");
-            JsValue::String(format!("function {}() {{ [native code] }}", name))
+            JsValue::String(JsStr::from(format!("function {}() {{ [native code] }}", name)))
         }
-        _ => JsValue::String(String::from("function() { [native code] }")),
+        _ => JsValue::String(JsStr::from("function() { [native code] }")),
     }
 }
 
@@ -95,7 +95,7 @@ pub fn global_encode_uri_component(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
             }
         }
     }
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 pub fn global_decode_uri_component(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -114,7 +114,7 @@ pub fn global_decode_uri_component(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
         result.push(bytes[i]);
         i += 1;
     }
-    JsValue::String(String::from_utf8(result).unwrap_or_default())
+    JsValue::String(JsStr::from(String::from_utf8(result).unwrap_or_default()))
 }
 
 // ═══════════════════════════════════════════════════════════
@@ -146,7 +146,7 @@ pub fn ctor_array(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 /// `String(value)` — converts to string.
 pub fn ctor_string(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let s = args.first().map(|v| v.to_js_string()).unwrap_or_default();
-    JsValue::String(s)
+    JsValue::String(JsStr::from(s))
 }
 
 /// `Number(value)` — converts to number.
@@ -210,9 +210,9 @@ pub fn boolean_value_of(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
 /// Throws TypeError when called on a non-Boolean `this`.
 pub fn boolean_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     match extract_bool_this(vm) {
-        Some(JsValue::Bool(true))  => JsValue::String(String::from("true")),
-        Some(JsValue::Bool(false)) => JsValue::String(String::from("false")),
-        Some(_) => JsValue::String(String::from("false")),
+        Some(JsValue::Bool(true))  => JsValue::String(JsStr::from("true")),
+        Some(JsValue::Bool(false)) => JsValue::String(JsStr::from("false")),
+        Some(_) => JsValue::String(JsStr::from("false")),
         None => {
             let err = vm.make_type_error("Boolean.prototype.toString called on non-Boolean");
             vm.throw_native(err);
@@ -35,7 +35,7 @@ pub fn json_stringify(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     }).unwrap_or_default();
 
     match stringify_value(&val, &indent, 0) {
-        Some(s) => JsValue::String(s),
+        Some(s) => JsValue::String(JsStr::from(s)),
         None => JsValue::Undefined,
     }
 }
@@ -68,7 +68,7 @@ fn stringify_value(val: &JsValue, indent: &str, depth: usize) -> Option<String>
                     out.push('\n');
                     push_indent(&mut out, indent, new_depth);
                 }
-                match stringify_value(el, indent, new_depth) {
+                match stringify_value(&el, indent, new_depth) {
                     Some(s) => out.push_str(&s),
                     None => out.push_str("null"),
                 }
@@ -200,7 +200,7 @@ fn parse_literal(bytes: &[u8], pos: &mut usize, expected: &[u8], val: JsValue) -
 }
 
 fn parse_string_val(bytes: &[u8], pos: &mut usize) -> Option<JsValue> {
-    parse_string_raw(bytes, pos).map(JsValue::String)
+    parse_string_raw(bytes, pos).map(|s| JsValue::String(JsStr::from(s)))
 }
 
 fn parse_string_raw(bytes: &[u8], pos: &mut usize) -> Option<String> {
@@ -311,7 +311,8 @@ fn parse_object(vm: &mut Vm, bytes: &[u8], pos: &mut usize) -> Option<JsValue> {
 
     loop {
         skip_ws(bytes, pos);
-        let key = parse_string_raw(bytes, pos)?;
+        // Interned: every object of a document shares its key strings.
+        let key = vm.atoms.intern(&parse_string_raw(bytes, pos)?);
         skip_ws(bytes, pos);
         if *pos >= bytes.len() || bytes[*pos] != b':' { return None; }
         *pos += 1;
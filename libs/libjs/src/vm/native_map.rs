@@ -68,7 +68,7 @@ pub fn map_set(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         };
         if let (JsValue::Array(keys), JsValue::Array(vals)) = (keys_arr, vals_arr) {
             if let Some(idx) = existing_idx {
-                vals.borrow_mut().elements[idx] = value;
+                vals.borrow_mut().elements.set(idx, value);
             } else {
                 keys.borrow_mut().elements.push(key);
                 vals.borrow_mut().elements.push(value);
@@ -86,7 +86,7 @@ pub fn map_get(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         if let Some(idx) = map_find_index(&o, &key) {
             if let JsValue::Array(vals) = o.get("__values") {
                 let v = vals.borrow();
-                return v.elements.get(idx).cloned().unwrap_or(JsValue::Undefined);
+                return v.get(idx);
             }
         }
     }
@@ -138,7 +138,7 @@ pub fn map_keys(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj_rc) = &vm.current_this {
         let o = obj_rc.borrow();
         if let JsValue::Array(keys) = o.get("__keys") {
-            return JsValue::new_array(keys.borrow().elements.clone());
+            return JsValue::new_array(keys.borrow().elements.to_vec());
         }
     }
     JsValue::new_array(Vec::new())
@@ -148,7 +148,7 @@ pub fn map_values(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj_rc) = &vm.current_this {
         let o = obj_rc.borrow();
         if let JsValue::Array(vals) = o.get("__values") {
-            return JsValue::new_array(vals.borrow().elements.clone());
+            return JsValue::new_array(vals.borrow().elements.to_vec());
         }
     }
     JsValue::new_array(Vec::new())
@@ -174,8 +174,8 @@ pub fn map_for_each(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj_rc) = &vm.current_this {
         let (keys, vals) = {
             let o = obj_rc.borrow();
-            let k = if let JsValue::Array(arr) = o.get("__keys") { arr.borrow().elements.clone() } else { Vec::new() };
-            let v = if let JsValue::Array(arr) = o.get("__values") { arr.borrow().elements.clone() } else { Vec::new() };
+            let k = if let JsValue::Array(arr) = o.get("__keys") { arr.borrow().elements.to_vec() } else { Vec::new() };
+            let v = if let JsValue::Array(arr) = o.get("__values") { arr.borrow().elements.to_vec() } else { Vec::new() };
             (k, v)
         };
         for (i, (k, v)) in keys.iter().zip(vals.iter()).enumerate() {
@@ -198,9 +198,9 @@ pub fn ctor_set(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
         Some(JsValue::Array(arr)) => {
             let a = arr.borrow();
             let mut seen: Vec<JsValue> = Vec::new();
-            for v in &a.elements {
-                if !seen.iter().any(|s| s.strict_eq(v)) {
-                    seen.push(v.clone());
+            for v in a.elements.iter() {
+                if !seen.iter().any(|s| s.strict_eq(&v)) {
+                    seen.push(v);
                 }
             }
             seen
@@ -297,7 +297,7 @@ pub fn set_values(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj_rc) = &vm.current_this {
         let o = obj_rc.borrow();
         if let JsValue::Array(items) = o.get("__items") {
-            return JsValue::new_array(items.borrow().elements.clone());
+            return JsValue::new_array(items.borrow().elements.to_vec());
         }
     }
     JsValue::new_array(Vec::new())
@@ -321,7 +321,7 @@ pub fn set_for_each(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj_rc) = &vm.current_this {
         let items = {
             let o = obj_rc.borrow();
-            if let JsValue::Array(arr) = o.get("__items") { arr.borrow().elements.clone() } else { Vec::new() }
+            if let JsValue::Array(arr) = o.get("__items") { arr.borrow().elements.to_vec() } else { Vec::new() }
         };
         for v in &items {
             super::native_array::call_callback_pub(vm, &callback, &[v.clone(), v.clone()]);
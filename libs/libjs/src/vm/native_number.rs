@@ -15,15 +15,15 @@ pub fn number_to_string(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let radix = args.first().map(|v| v.to_number() as u32).unwrap_or(10);
 
     if radix == 10 || radix < 2 || radix > 36 {
-        return JsValue::String(format_number(n));
+        return JsValue::String(JsStr::from(format_number(n)));
     }
 
-    if n.is_nan() { return JsValue::String(String::from("NaN")); }
+    if n.is_nan() { return JsValue::String(JsStr::from("NaN")); }
     if n.is_infinite() {
         return JsValue::String(if n > 0.0 {
-            String::from("Infinity")
+            JsStr::from("Infinity")
         } else {
-            String::from("-Infinity")
+            JsStr::from("-Infinity")
         });
     }
 
@@ -32,7 +32,7 @@ pub fn number_to_string(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let mut value = if negative { -n } else { n } as u64;
 
     if value == 0 {
-        return JsValue::String(String::from("0"));
+        return JsValue::String(JsStr::from("0"));
     }
 
     let digits = b"0123456789abcdefghijklmnopqrstuvwxyz";
@@ -46,7 +46,7 @@ pub fn number_to_string(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     }
     buf.reverse();
     // SAFETY: buf contains only ASCII
-    JsValue::String(unsafe { String::from_utf8_unchecked(buf) })
+    JsValue::String(unsafe { JsStr::from(String::from_utf8_unchecked(buf)) })
 }
 
 pub fn number_value_of(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
@@ -57,12 +57,12 @@ pub fn number_to_fixed(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let n = vm.current_this.to_number();
     let digits = args.first().map(|v| v.to_number() as usize).unwrap_or(0).min(100);
 
-    if n.is_nan() { return JsValue::String(String::from("NaN")); }
+    if n.is_nan() { return JsValue::String(JsStr::from("NaN")); }
     if n.is_infinite() {
         return JsValue::String(if n > 0.0 {
-            String::from("Infinity")
+            JsStr::from("Infinity")
         } else {
-            String::from("-Infinity")
+            JsStr::from("-Infinity")
         });
     }
 
@@ -94,7 +94,7 @@ pub fn number_to_fixed(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         result.push_str(&frac_str);
     }
 
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 // ── Helpers ──
@@ -59,10 +59,10 @@ pub fn object_is_prototype_of(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
 pub fn object_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     match &vm.current_this {
-        JsValue::Array(_) => JsValue::String(String::from("[object Array]")),
-        JsValue::Function(_) => JsValue::String(String::from("[object Function]")),
-        JsValue::Null => JsValue::String(String::from("[object Null]")),
-        JsValue::Undefined => JsValue::String(String::from("[object Undefined]")),
+        JsValue::Array(_) => JsValue::String(JsStr::from("[object Array]")),
+        JsValue::Function(_) => JsValue::String(JsStr::from("[object Function]")),
+        JsValue::Null => JsValue::String(JsStr::from("[object Null]")),
+        JsValue::Undefined => JsValue::String(JsStr::from("[object Undefined]")),
         JsValue::Object(obj) => {
             // Return the appropriate [object X] tag based on the object's internal tag.
             let tag = obj.borrow().internal_tag.clone();
@@ -74,9 +74,9 @@ pub fn object_to_string(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
                 Some("__date__")    => "Date",
                 _                   => "Object",
             };
-            JsValue::String(alloc::format!("[object {}]", kind))
+            JsValue::String(JsStr::from(alloc::format!("[object {}]", kind)))
         }
-        _ => JsValue::String(String::from("[object Object]")),
+        _ => JsValue::String(JsStr::from("[object Object]")),
     }
 }
 
@@ -109,7 +109,7 @@ pub fn object_keys(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
         Some(JsValue::Array(arr)) => {
             let a = arr.borrow();
             let keys: Vec<JsValue> = (0..a.elements.len())
-                .map(|i| JsValue::String(format_usize(i)))
+                .map(|i| JsValue::String(JsStr::from(format_usize(i))))
                 .collect();
             JsValue::new_array(keys)
         }
@@ -128,7 +128,7 @@ pub fn object_values(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
         }
         Some(JsValue::Array(arr)) => {
             let a = arr.borrow();
-            JsValue::new_array(a.elements.clone())
+            JsValue::new_array(a.elements.to_vec())
         }
         _ => JsValue::new_array(Vec::new()),
     }
@@ -170,7 +170,7 @@ pub fn object_assign(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn object_freeze(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let Some(JsValue::Object(obj)) = args.first() {
         let mut o = obj.borrow_mut();
-        let keys: Vec<String> = o.properties.keys().cloned().collect();
+        let keys: Vec<JsStr> = o.properties.keys().cloned().collect();
         for key in keys {
             if let Some(prop) = o.properties.get_mut(&key) {
                 prop.writable = false;
@@ -181,21 +181,22 @@ pub fn object_freeze(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     args.first().cloned().unwrap_or(JsValue::Undefined)
 }
 
-pub fn object_create(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
+pub fn object_create(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let proto = match args.first() {
         Some(JsValue::Object(obj)) => Some(obj.clone()),
         Some(JsValue::Null) => None,
         _ => None,
     };
     let obj = JsObject {
-        properties: alloc::collections::BTreeMap::new(),
+        properties: crate::shape::PropertyMap::new(),
         prototype: proto,
         internal_tag: None,
         primitive_value: None,
         set_hook: None,
         set_hook_data: core::ptr::null_mut(),
+        view: None,
     };
-    JsValue::Object(Rc::new(RefCell::new(obj)))
+    vm.heap.track(JsValue::Object(Rc::new(RefCell::new(obj))))
 }
 
 pub fn object_define_property(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -216,7 +217,7 @@ pub fn object_define_property(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
                 enumerable,
                 configurable,
             };
-            target_obj.borrow_mut().properties.insert(key, prop);
+            target_obj.borrow_mut().properties.insert(JsStr::from(key), prop);
         }
     }
     target
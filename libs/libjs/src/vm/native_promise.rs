@@ -25,7 +25,7 @@ pub fn ctor_promise(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     let mut obj = JsObject::new();
     obj.internal_tag = Some(String::from("__promise__"));
-    obj.set(String::from("__state"), JsValue::String(String::from("pending")));
+    obj.set(String::from("__state"), JsValue::String(JsStr::from("pending")));
     obj.set(String::from("__value"), JsValue::Undefined);
     obj.set(String::from("__then_cbs"), JsValue::new_array(Vec::new()));
     obj.set(String::from("__catch_cbs"), JsValue::new_array(Vec::new()));
@@ -103,7 +103,7 @@ fn settle_promise(vm: &mut Vm, promise: &JsValue, state: &str, value: &JsValue)
             // Only settle if still pending
             let current_state = o.get("__state").to_js_string();
             if current_state != "pending" { return; }
-            o.set(String::from("__state"), JsValue::String(String::from(state)));
+            o.set(String::from("__state"), JsValue::String(JsStr::from(state)));
             o.set(String::from("__value"), value.clone());
         }
 
@@ -114,7 +114,7 @@ fn settle_promise(vm: &mut Vm, promise: &JsValue, state: &str, value: &JsValue)
             o.get(cb_key)
         };
         if let JsValue::Array(arr) = cbs {
-            let callbacks = arr.borrow().elements.clone();
+            let callbacks = arr.borrow().elements.to_vec();
             for cb in &callbacks {
                 call_callback(vm, cb, &[value.clone()]);
             }
@@ -140,7 +140,7 @@ pub fn promise_then(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         // Create a new promise for chaining
         let mut new_obj = JsObject::new();
         new_obj.internal_tag = Some(String::from("__promise__"));
-        new_obj.set(String::from("__state"), JsValue::String(String::from("pending")));
+        new_obj.set(String::from("__state"), JsValue::String(JsStr::from("pending")));
         new_obj.set(String::from("__value"), JsValue::Undefined);
         new_obj.set(String::from("__then_cbs"), JsValue::new_array(Vec::new()));
         new_obj.set(String::from("__catch_cbs"), JsValue::new_array(Vec::new()));
@@ -220,7 +220,7 @@ pub fn promise_resolve(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     }
     let mut obj = JsObject::new();
     obj.internal_tag = Some(String::from("__promise__"));
-    obj.set(String::from("__state"), JsValue::String(String::from("fulfilled")));
+    obj.set(String::from("__state"), JsValue::String(JsStr::from("fulfilled")));
     obj.set(String::from("__value"), value);
     obj.set(String::from("__then_cbs"), JsValue::new_array(Vec::new()));
     obj.set(String::from("__catch_cbs"), JsValue::new_array(Vec::new()));
@@ -234,7 +234,7 @@ pub fn promise_reject(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let value = args.first().cloned().unwrap_or(JsValue::Undefined);
     let mut obj = JsObject::new();
     obj.internal_tag = Some(String::from("__promise__"));
-    obj.set(String::from("__state"), JsValue::String(String::from("rejected")));
+    obj.set(String::from("__state"), JsValue::String(JsStr::from("rejected")));
     obj.set(String::from("__value"), value);
     obj.set(String::from("__then_cbs"), JsValue::new_array(Vec::new()));
     obj.set(String::from("__catch_cbs"), JsValue::new_array(Vec::new()));
@@ -247,7 +247,7 @@ pub fn promise_reject(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn promise_all(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let iterable = args.first().cloned().unwrap_or(JsValue::Undefined);
     let promises = match &iterable {
-        JsValue::Array(arr) => arr.borrow().elements.clone(),
+        JsValue::Array(arr) => arr.borrow().elements.to_vec(),
         _ => Vec::new(),
     };
 
@@ -274,7 +274,7 @@ pub fn promise_all(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn promise_all_settled(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let iterable = args.first().cloned().unwrap_or(JsValue::Undefined);
     let promises = match &iterable {
-        JsValue::Array(arr) => arr.borrow().elements.clone(),
+        JsValue::Array(arr) => arr.borrow().elements.to_vec(),
         _ => Vec::new(),
     };
 
@@ -285,7 +285,7 @@ pub fn promise_all_settled(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             let o = obj.borrow();
             if o.internal_tag.as_deref() == Some("__promise__") {
                 let state = o.get("__state").to_js_string();
-                entry.set_property(String::from("status"), JsValue::String(state.clone()));
+                entry.set_property(String::from("status"), JsValue::String(JsStr::from(state.clone())));
                 if state == "fulfilled" {
                     entry.set_property(String::from("value"), o.get("__value"));
                 } else {
@@ -295,7 +295,7 @@ pub fn promise_all_settled(vm: &mut Vm, args: &[JsValue]) -> JsValue {
                 continue;
             }
         }
-        entry.set_property(String::from("status"), JsValue::String(String::from("fulfilled")));
+        entry.set_property(String::from("status"), JsValue::String(JsStr::from("fulfilled")));
         entry.set_property(String::from("value"), p.clone());
         results.push(entry);
     }
@@ -305,7 +305,7 @@ pub fn promise_all_settled(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn promise_race(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let iterable = args.first().cloned().unwrap_or(JsValue::Undefined);
     let promises = match &iterable {
-        JsValue::Array(arr) => arr.borrow().elements.clone(),
+        JsValue::Array(arr) => arr.borrow().elements.to_vec(),
         _ => Vec::new(),
     };
     // Return the first settled promise
@@ -75,7 +75,7 @@ fn proxy_get_trap(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             if let JsValue::Function(f) = get_fn {
                 let kind = f.borrow().kind.clone();
                 if let FnKind::Native(native) = kind {
-                    return native(vm, &[target, JsValue::String(prop)]);
+                    return native(vm, &[target, JsValue::String(JsStr::from(prop))]);
                 }
             }
         }
@@ -103,7 +103,7 @@ fn proxy_set_trap(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             if let JsValue::Function(f) = set_fn {
                 let kind = f.borrow().kind.clone();
                 if let FnKind::Native(native) = kind {
-                    return native(vm, &[target, JsValue::String(prop), value]);
+                    return native(vm, &[target, JsValue::String(JsStr::from(prop)), value]);
                 }
             }
         }
@@ -128,7 +128,7 @@ fn proxy_has_trap(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             if let JsValue::Function(f) = has_fn {
                 let kind = f.borrow().kind.clone();
                 if let FnKind::Native(native) = kind {
-                    return native(vm, &[target, JsValue::String(prop)]);
+                    return native(vm, &[target, JsValue::String(JsStr::from(prop))]);
                 }
             }
         }
@@ -157,7 +157,7 @@ fn proxy_delete_trap(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             if let JsValue::Function(f) = del_fn {
                 let kind = f.borrow().kind.clone();
                 if let FnKind::Native(native) = kind {
-                    return native(vm, &[target, JsValue::String(prop)]);
+                    return native(vm, &[target, JsValue::String(JsStr::from(prop))]);
                 }
             }
         }
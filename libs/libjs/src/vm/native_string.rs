@@ -8,11 +8,27 @@ use crate::value::*;
 use super::Vm;
 
 // ═══════════════════════════════════════════════════════════
-// Helper: get `this` as a String
+// Helper: get `this` as a string
 // ═══════════════════════════════════════════════════════════
 
-fn this_string(vm: &Vm) -> String {
-    vm.current_this.to_js_string()
+/// `this` as a string; a string receiver is shared, not copied.
+fn this_string(vm: &Vm) -> JsStr {
+    vm.current_this.to_js_str()
+}
+
+/// `part`, a subslice of `s`, as a string sharing `s`'s buffer.
+fn sub(s: &JsStr, part: &str) -> JsStr {
+    let start = part.as_ptr() as usize - s.as_ptr() as usize;
+    s.slice(start..start + part.len())
+}
+
+/// `s` from char `start` to char `end`, sharing `s`'s buffer.
+fn char_slice(s: &JsStr, start: usize, end: usize) -> JsStr {
+    let byte = |idx: usize| s.char_indices().nth(idx).map(|(b, _)| b).unwrap_or(s.len());
+    if s.is_ascii() {
+        return s.slice(start..end);
+    }
+    s.slice(byte(start)..byte(end))
 }
 
 /// Collect the string into chars for indexing.
@@ -40,11 +56,9 @@ pub fn string_char_at(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let chars = chars_vec(&s);
     let idx = args.first().map(|v| v.to_number() as usize).unwrap_or(0);
     if idx < chars.len() {
-        let mut buf = String::new();
-        buf.push(chars[idx]);
-        JsValue::String(buf)
+        JsValue::String(JsStr::from(chars[idx]))
     } else {
-        JsValue::String(String::new())
+        JsValue::String(JsStr::from(""))
     }
 }
 
@@ -170,22 +184,19 @@ pub fn string_ends_with(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
 pub fn string_slice(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let s = this_string(vm);
-    let chars = chars_vec(&s);
-    let len = chars.len();
+    let len = s.chars().count();
     let start = resolve_index(args.first().map(|v| v.to_number()).unwrap_or(0.0), len);
     let end = resolve_index(args.get(1).map(|v| v.to_number()).unwrap_or(len as f64), len);
 
     if start >= end {
-        return JsValue::String(String::new());
+        return JsValue::String(JsStr::from(""));
     }
-    let result: String = chars[start..end].iter().collect();
-    JsValue::String(result)
+    JsValue::String(char_slice(&s, start, end))
 }
 
 pub fn string_substring(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let s = this_string(vm);
-    let chars = chars_vec(&s);
-    let len = chars.len();
+    let len = s.chars().count();
 
     let raw_start = args.first().map(|v| v.to_number()).unwrap_or(0.0);
     let raw_end = args.get(1).map(|v| v.to_number()).unwrap_or(len as f64);
@@ -194,8 +205,7 @@ pub fn string_substring(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let s2 = if raw_end.is_nan() || raw_end < 0.0 { 0 } else { (raw_end as usize).min(len) };
 
     let (start, end) = if s1 <= s2 { (s1, s2) } else { (s2, s1) };
-    let result: String = chars[start..end].iter().collect();
-    JsValue::String(result)
+    JsValue::String(char_slice(&s, start, end))
 }
 
 pub fn string_to_lower_case(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
@@ -206,7 +216,7 @@ pub fn string_to_lower_case(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
             out.push(lc);
         }
     }
-    JsValue::String(out)
+    JsValue::String(JsStr::from(out))
 }
 
 pub fn string_to_upper_case(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
@@ -217,19 +227,22 @@ pub fn string_to_upper_case(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
             out.push(uc);
         }
     }
-    JsValue::String(out)
+    JsValue::String(JsStr::from(out))
 }
 
 pub fn string_trim(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
-    JsValue::String(String::from(this_string(vm).trim()))
+    let s = this_string(vm);
+    JsValue::String(sub(&s, s.trim()))
 }
 
 pub fn string_trim_start(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
-    JsValue::String(String::from(this_string(vm).trim_start()))
+    let s = this_string(vm);
+    JsValue::String(sub(&s, s.trim_start()))
 }
 
 pub fn string_trim_end(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
-    JsValue::String(String::from(this_string(vm).trim_end()))
+    let s = this_string(vm);
+    JsValue::String(sub(&s, s.trim_end()))
 }
 
 pub fn string_split(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -246,11 +259,7 @@ pub fn string_split(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         }
         Some(ref sep_str) if sep_str.is_empty() => {
             // Split into individual characters
-            s.chars().take(limit).map(|c| {
-                let mut buf = String::new();
-                buf.push(c);
-                JsValue::String(buf)
-            }).collect()
+            s.chars().take(limit).map(|c| JsValue::String(JsStr::from(c))).collect()
         }
         Some(ref sep_str) => {
             let mut result = Vec::new();
@@ -258,14 +267,14 @@ pub fn string_split(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             let mut count = 0;
             while count + 1 < limit {
                 if let Some(idx) = remaining.find(sep_str.as_str()) {
-                    result.push(JsValue::String(String::from(&remaining[..idx])));
+                    result.push(JsValue::String(sub(&s, &remaining[..idx])));
                     remaining = &remaining[idx + sep_str.len()..];
                     count += 1;
                 } else {
                     break;
                 }
             }
-            result.push(JsValue::String(String::from(remaining)));
+            result.push(JsValue::String(sub(&s, remaining)));
             result
         }
     };
@@ -284,7 +293,7 @@ pub fn string_replace(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         result.push_str(&s[..idx]);
         result.push_str(&replacement);
         result.push_str(&s[idx + search.len()..]);
-        JsValue::String(result)
+        JsValue::String(JsStr::from(result))
     } else {
         JsValue::String(s)
     }
@@ -303,7 +312,7 @@ pub fn string_replace_all(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             result.push(c);
             result.push_str(&replacement);
         }
-        return JsValue::String(result);
+        return JsValue::String(JsStr::from(result));
     }
 
     let mut result = String::new();
@@ -318,7 +327,7 @@ pub fn string_replace_all(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             break;
         }
     }
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 pub fn string_repeat(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -328,7 +337,7 @@ pub fn string_repeat(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     for _ in 0..count {
         result.push_str(&s);
     }
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 pub fn string_pad_start(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -350,7 +359,7 @@ pub fn string_pad_start(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         i += 1;
     }
     result.push_str(&s);
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 pub fn string_pad_end(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -365,13 +374,13 @@ pub fn string_pad_end(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     let pad_chars = chars_vec(&pad_str);
     let needed = target_len - chars.len();
-    let mut result = s;
+    let mut result = String::from(s.as_str());
     let mut i = 0;
     while i < needed {
         result.push(pad_chars[i % pad_chars.len()]);
         i += 1;
     }
-    JsValue::String(result)
+    JsValue::String(JsStr::from(result))
 }
 
 pub fn string_at(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -381,9 +390,7 @@ pub fn string_at(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let len = chars.len() as i64;
     let actual = if idx < 0 { len + idx } else { idx };
     if actual >= 0 && actual < len {
-        let mut buf = String::new();
-        buf.push(chars[actual as usize]);
-        JsValue::String(buf)
+        JsValue::String(JsStr::from(chars[actual as usize]))
     } else {
         JsValue::Undefined
     }
@@ -392,7 +399,7 @@ pub fn string_at(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 pub fn string_concat(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let mut s = this_string(vm);
     for arg in args {
-        s.push_str(&arg.to_js_string());
+        s = s.concat(&arg.to_js_str());
     }
     JsValue::String(s)
 }
@@ -28,7 +28,7 @@ pub fn ctor_symbol(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
         NEXT_SYMBOL_ID += 1;
         id
     };
-    JsValue::String(format!("__symbol__{}_{}", id, desc))
+    JsValue::String(JsStr::from(format!("__symbol__{}_{}", id, desc)))
 }
 
 // ═══════════════════════════════════════════════════════════
@@ -39,14 +39,14 @@ pub fn ctor_symbol(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 /// We implement a simple global registry via a naming convention.
 pub fn symbol_for(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let key = args.first().map(|v| v.to_js_string()).unwrap_or_default();
-    JsValue::String(format!("__symbol_global__{}", key))
+    JsValue::String(JsStr::from(format!("__symbol_global__{}", key)))
 }
 
 /// `Symbol.keyFor(sym)` — reverse lookup of Symbol.for.
 pub fn symbol_key_for(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let Some(JsValue::String(s)) = args.first() {
         if let Some(rest) = s.strip_prefix("__symbol_global__") {
-            return JsValue::String(String::from(rest));
+            return JsValue::String(JsStr::from(rest));
         }
     }
     JsValue::Undefined
@@ -54,18 +54,18 @@ pub fn symbol_key_for(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
 /// Install well-known symbols on the Symbol constructor object.
 pub fn install_well_known_symbols(symbol_ctor: &JsValue) {
-    symbol_ctor.set_property(String::from("iterator"), JsValue::String(String::from("Symbol.iterator")));
-    symbol_ctor.set_property(String::from("toPrimitive"), JsValue::String(String::from("Symbol.toPrimitive")));
-    symbol_ctor.set_property(String::from("toStringTag"), JsValue::String(String::from("Symbol.toStringTag")));
-    symbol_ctor.set_property(String::from("hasInstance"), JsValue::String(String::from("Symbol.hasInstance")));
-    symbol_ctor.set_property(String::from("isConcatSpreadable"), JsValue::String(String::from("Symbol.isConcatSpreadable")));
-    symbol_ctor.set_property(String::from("species"), JsValue::String(String::from("Symbol.species")));
-    symbol_ctor.set_property(String::from("match"), JsValue::String(String::from("Symbol.match")));
-    symbol_ctor.set_property(String::from("replace"), JsValue::String(String::from("Symbol.replace")));
-    symbol_ctor.set_property(String::from("search"), JsValue::String(String::from("Symbol.search")));
-    symbol_ctor.set_property(String::from("split"), JsValue::String(String::from("Symbol.split")));
-    symbol_ctor.set_property(String::from("unscopables"), JsValue::String(String::from("Symbol.unscopables")));
-    symbol_ctor.set_property(String::from("asyncIterator"), JsValue::String(String::from("Symbol.asyncIterator")));
+    symbol_ctor.set_property(String::from("iterator"), JsValue::String(JsStr::from("Symbol.iterator")));
+    symbol_ctor.set_property(String::from("toPrimitive"), JsValue::String(JsStr::from("Symbol.toPrimitive")));
+    symbol_ctor.set_property(String::from("toStringTag"), JsValue::String(JsStr::from("Symbol.toStringTag")));
+    symbol_ctor.set_property(String::from("hasInstance"), JsValue::String(JsStr::from("Symbol.hasInstance")));
+    symbol_ctor.set_property(String::from("isConcatSpreadable"), JsValue::String(JsStr::from("Symbol.isConcatSpreadable")));
+    symbol_ctor.set_property(String::from("species"), JsValue::String(JsStr::from("Symbol.species")));
+    symbol_ctor.set_property(String::from("match"), JsValue::String(JsStr::from("Symbol.match")));
+    symbol_ctor.set_property(String::from("replace"), JsValue::String(JsStr::from("Symbol.replace")));
+    symbol_ctor.set_property(String::from("search"), JsValue::String(JsStr::from("Symbol.search")));
+    symbol_ctor.set_property(String::from("split"), JsValue::String(JsStr::from("Symbol.split")));
+    symbol_ctor.set_property(String::from("unscopables"), JsValue::String(JsStr::from("Symbol.unscopables")));
+    symbol_ctor.set_property(String::from("asyncIterator"), JsValue::String(JsStr::from("Symbol.asyncIterator")));
 
     // Static methods
     symbol_ctor.set_property(String::from("for"), native_fn("for", symbol_for));
@@ -0,0 +1,51 @@
+// JSON round trip — builds a document of nested objects, arrays, strings
+// and numbers, then repeatedly serializes and re-parses it.  Exercises
+// JSON.stringify / JSON.parse, string building and object creation.
+//
+// Evaluates to "rounds:checksum" ("20:" followed by the document's
+// checksum when every round trip was lossless).
+
+function makeDocument(items) {
+    var doc = { version: 3, name: "inventory", tags: ["a", "b", "c"], items: [] };
+    for (var i = 0; i < items; i++) {
+        doc.items.push({
+            id: i,
+            sku: "SKU-" + (i * 7919 % 10007),
+            price: (i % 97) * 1.25,
+            stock: i % 13,
+            active: i % 3 != 0,
+            dims: { w: i % 17, h: i % 19, d: i % 23 },
+            history: [i, i * 2, i * 3, i * 4],
+            note: i % 5 == 0 ? "restock \"soon\"\nline2" : null
+        });
+    }
+    return doc;
+}
+
+function checksum(doc) {
+    var sum = doc.version + doc.tags.length;
+    for (var i = 0; i < doc.items.length; i++) {
+        var it = doc.items[i];
+        sum += it.id + it.price + it.stock + it.dims.w + it.dims.h + it.dims.d;
+        sum += it.history[3] + it.sku.length;
+        if (it.active) sum += 1;
+        if (it.note != null) sum += it.note.length;
+    }
+    return sum;
+}
+
+function runJson(rounds) {
+    var doc = makeDocument(200);
+    var expected = checksum(doc);
+    var text = JSON.stringify(doc);
+    for (var r = 0; r < rounds; r++) {
+        var copy = JSON.parse(text);
+        if (checksum(copy) != expected) throw new Error("checksum mismatch in round " + r);
+        var again = JSON.stringify(copy);
+        if (again != text) throw new Error("text mismatch in round " + r);
+        text = again;
+    }
+    return rounds + ":" + expected;
+}
+
+runJson(20);
@@ -0,0 +1,71 @@
+// Pixels — canvas-style image processing on an RGBA Uint8ClampedArray:
+// fill a gradient, convert to grayscale, run a 3x3 box blur into a second
+// buffer and build a 256-bin histogram in a plain number array.
+// Exercises typed-array element access and packed small-int arrays.
+//
+// Evaluates to "width x height:checksum".
+
+var WIDTH = 96;
+var HEIGHT = 64;
+
+function fillGradient(px, w, h, t) {
+    for (var y = 0; y < h; y++) {
+        for (var x = 0; x < w; x++) {
+            var i = (y * w + x) * 4;
+            px[i] = (x * 255 / w + t) | 0;
+            px[i + 1] = (y * 255 / h) | 0;
+            px[i + 2] = ((x ^ y) * 4 + t * 3) & 255;
+            px[i + 3] = 255;
+        }
+    }
+}
+
+function grayscale(px) {
+    for (var i = 0; i < px.length; i += 4) {
+        var g = (px[i] * 77 + px[i + 1] * 150 + px[i + 2] * 29) >> 8;
+        px[i] = g;
+        px[i + 1] = g;
+        px[i + 2] = g;
+    }
+}
+
+function blur(src, dst, w, h) {
+    for (var y = 1; y < h - 1; y++) {
+        for (var x = 1; x < w - 1; x++) {
+            var sum = 0;
+            for (var dy = -1; dy <= 1; dy++) {
+                var row = ((y + dy) * w + x) * 4;
+                sum += src[row - 4] + src[row] + src[row + 4];
+            }
+            var o = (y * w + x) * 4;
+            dst[o] = dst[o + 1] = dst[o + 2] = sum / 9;
+            dst[o + 3] = 255;
+        }
+    }
+}
+
+function histogram(px) {
+    var bins = new Array(256);
+    for (var b = 0; b < 256; b++) bins[b] = 0;
+    for (var i = 0; i < px.length; i += 4) {
+        var v = px[i];
+        bins[v] = bins[v] + 1;
+    }
+    return bins;
+}
+
+function runPixels(frames) {
+    var src = new Uint8ClampedArray(WIDTH * HEIGHT * 4);
+    var dst = new Uint8ClampedArray(src.length);
+    var checksum = 0;
+    for (var t = 0; t < frames; t++) {
+        fillGradient(src, WIDTH, HEIGHT, t);
+        grayscale(src);
+        blur(src, dst, WIDTH, HEIGHT);
+        var bins = histogram(dst);
+        for (var b = 0; b < 256; b++) checksum = (checksum * 31 + bins[b] * b) % 1000003;
+    }
+    return WIDTH + "x" + HEIGHT + ":" + checksum;
+}
+
+runPixels(6);
@@ -0,0 +1,66 @@
+//! Benchmark corpus (`bench/*.js`), shared by the `js_bench` binary and
+//! `tests/13_benchmarks.rs`.
+//!
+//! Each script evaluates to a value that proves it ran correctly, so the
+//! corpus doubles as an end-to-end check of the bytecode optimizer.
+
+/// One benchmark script and its expected completion value.
+pub struct Benchmark {
+    pub name: &'static str,
+    pub source: &'static str,
+    /// `to_js_string()` of the completion value.
+    pub expected: &'static str,
+}
+
+pub const CORPUS: &[Benchmark] = &[
+    Benchmark { name: "richards", source: include_str!("../bench/richards.js"), expected: "2322,928" },
+    Benchmark { name: "deltablue", source: include_str!("../bench/deltablue.js"), expected: "298" },
+    Benchmark { name: "json", source: include_str!("../bench/json.js"), expected: "20:120328.75" },
+    Benchmark { name: "pixels", source: include_str!("../bench/pixels.js"), expected: "96x64:838485" },
+];
+
+/// Step limit large enough for one run of any benchmark.
+pub const STEP_LIMIT: u64 = 1_000_000_000;
+
+/// Host stack for running the corpus.  Native helpers such as
+/// `Function.prototype.call` re-enter the VM on the Rust stack, and
+/// DeltaBlue nests them deeper than the default test thread allows.
+const STACK_SIZE: usize = 256 << 20;
+
+/// Compile `bench` (optionally without the optimizer) and run it in a
+/// fresh engine; returns the completion value as a string.
+pub fn run(bench: &Benchmark, optimize: bool) -> String {
+    let tokens = crate::lexer::Lexer::tokenize(bench.source);
+    let program = crate::parser::Parser::new(tokens).parse_program();
+    let mut compiler = crate::compiler::Compiler::new();
+    compiler.set_optimize(optimize);
+    let mut chunk = compiler.compile(&program);
+    crate::patch_chunk_for_eval(&mut chunk);
+    let mut engine = crate::JsEngine::new();
+    engine.set_step_limit(STEP_LIMIT);
+    engine.vm().execute(chunk).to_js_string()
+}
+
+/// Like [`run`], but passes the compiled chunk through
+/// `serialize::encode` / `decode` first, as a bytecode cache would.
+pub fn run_decoded(bench: &Benchmark) -> String {
+    let tokens = crate::lexer::Lexer::tokenize(bench.source);
+    let program = crate::parser::Parser::new(tokens).parse_program();
+    let mut chunk = crate::compiler::Compiler::new().compile(&program);
+    crate::patch_chunk_for_eval(&mut chunk);
+    let bytes = crate::serialize::encode(&chunk);
+    let chunk = crate::serialize::decode(&bytes).expect("decode benchmark chunk");
+    let mut engine = crate::JsEngine::new();
+    engine.set_step_limit(STEP_LIMIT);
+    engine.vm().execute(chunk).to_js_string()
+}
+
+/// Run `f` on a thread with a stack large enough for the corpus.
+pub fn with_stack<T: Send + 'static>(f: impl FnOnce() -> T + Send + 'static) -> T {
+    std::thread::Builder::new()
+        .stack_size(STACK_SIZE)
+        .spawn(f)
+        .expect("spawn benchmark thread")
+        .join()
+        .expect("benchmark thread panicked")
+}
@@ -0,0 +1,96 @@
+//! js_bench — times the libjs benchmark corpus (Richards, DeltaBlue, JSON
+//! round trip) with and without the bytecode optimizer.
+//!
+//! Usage:
+//!   js_bench [--iterations N] [--no-opt] [name...]
+//!
+//! Every iteration compiles and runs the script in a fresh engine.  The
+//! report gives the median and minimum wall time per benchmark; a run whose
+//! completion value differs from the expected one is reported as FAILED.
+//! Build with `--release` for meaningful numbers.
+
+use std::env;
+use std::process;
+use std::time::{Duration, Instant};
+
+use libjs_tests::bench::{self, Benchmark, CORPUS};
+
+const DEFAULT_ITERATIONS: usize = 5;
+
+fn ms(d: Duration) -> f64 {
+    d.as_secs_f64() * 1000.0
+}
+
+fn main() {
+    let args: Vec<String> = env::args().skip(1).collect();
+    let mut iterations = DEFAULT_ITERATIONS;
+    let mut optimize = true;
+    let mut names: Vec<String> = Vec::new();
+
+    let mut it = args.iter();
+    while let Some(arg) = it.next() {
+        match arg.as_str() {
+            "--iterations" => {
+                iterations = it.next().and_then(|n| n.parse().ok()).unwrap_or(iterations).max(1);
+            }
+            "--no-opt" => optimize = false,
+            "-h" | "--help" => {
+                println!("Usage: js_bench [--iterations N] [--no-opt] [name...]");
+                println!();
+                println!("Benchmarks:");
+                for b in CORPUS {
+                    println!("  {}", b.name);
+                }
+                return;
+            }
+            _ if arg.starts_with("--") => {
+                eprintln!("js_bench: unknown option {arg}");
+                process::exit(1);
+            }
+            _ => names.push(arg.clone()),
+        }
+    }
+
+    let selected: Vec<&'static Benchmark> = CORPUS
+        .iter()
+        .filter(|b| names.is_empty() || names.iter().any(|n| n == b.name))
+        .collect();
+    if selected.is_empty() {
+        eprintln!("js_bench: no benchmark matches the selection");
+        process::exit(1);
+    }
+
+    let failed = bench::with_stack(move || {
+        println!(
+            "optimizer {}, {} iteration(s)",
+            if optimize { "on" } else { "off" },
+            iterations
+        );
+        let mut failed = false;
+        for b in selected {
+            let mut times: Vec<Duration> = Vec::with_capacity(iterations);
+            let mut result = String::new();
+            for _ in 0..iterations {
+                let start = Instant::now();
+                result = bench::run(b, optimize);
+                times.push(start.elapsed());
+            }
+            times.sort();
+            let status = if result == b.expected { "ok" } else { "FAILED" };
+            failed |= result != b.expected;
+            println!(
+                "  {:<10} median {:>9.2} ms   min {:>9.2} ms   {} ({})",
+                b.name,
+                ms(times[times.len() / 2]),
+                ms(times[0]),
+                status,
+                result
+            );
+        }
+        failed
+    });
+
+    if failed {
+        process::exit(1);
+    }
+}
@@ -244,7 +244,7 @@ __test_passed = true;
             Outcome::Pass
         } else {
             let msg = match error_val {
-                JsValue::String(s) => s,
+                JsValue::String(s) => s.to_string(),
                 JsValue::Undefined | JsValue::Null => "unknown error".to_string(),
                 other => other.to_js_string(),
             };
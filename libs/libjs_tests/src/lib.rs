@@ -47,15 +47,40 @@ pub mod bytecode;
 #[path = "../../libjs/src/compiler.rs"]
 pub mod compiler;
 
+#[path = "../../libjs/src/optimizer.rs"]
+pub mod optimizer;
+
+#[path = "../../libjs/src/serialize.rs"]
+pub mod serialize;
+
 #[path = "../../libjs/src/value.rs"]
 pub mod value;
 
+#[path = "../../libjs/src/nanbox.rs"]
+pub mod nanbox;
+
+#[path = "../../libjs/src/shape.rs"]
+pub mod shape;
+
+#[path = "../../libjs/src/atom.rs"]
+pub mod atom;
+
+#[path = "../../libjs/src/elements.rs"]
+pub mod elements;
+
+#[path = "../../libjs/src/buffer.rs"]
+pub mod buffer;
+
 #[path = "../../libjs/src/vm/mod.rs"]
 pub mod vm;
 
+// ── Benchmark corpus ─────────────────────────────────────────────────────────
+
+pub mod bench;
+
 // ── Public re-exports ─────────────────────────────────────────────────────────
 
-pub use value::JsValue;
+pub use value::{JsStr, JsValue};
 pub use vm::Vm;
 pub use bytecode::Chunk;
 
@@ -123,6 +148,11 @@ impl JsEngine {
         self.vm.execute(chunk)
     }
 
+    /// Execute an already compiled chunk.
+    pub fn execute(&mut self, chunk: Chunk) -> JsValue {
+        self.vm.execute(chunk)
+    }
+
     /// Set a global variable.
     pub fn set_global(&mut self, name: &str, value: JsValue) {
         self.vm.set_global(name, value);
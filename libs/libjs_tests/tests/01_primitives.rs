@@ -288,3 +288,71 @@ fn nan_not_equal_to_itself() {
     assert!(!bool_("NaN === NaN"));
     assert!(!bool_("NaN == NaN"));
 }
+
+// ── NaN-boxed stack values ───────────────────────────────────────────────────
+
+use libjs_tests::nanbox::Value;
+use libjs_tests::{JsStr, JsValue};
+
+/// Pack `v`, unpack it again and check nothing changed.
+fn round_trip(v: JsValue) -> JsValue {
+    let packed = Value::from(v.clone());
+    let copy = packed.clone().into_js();
+    assert!(copy.strict_eq(&v) || (copy.to_number().is_nan() && v.to_number().is_nan()));
+    packed.into_js()
+}
+
+#[test]
+fn value_is_one_word() {
+    assert_eq!(core::mem::size_of::<Value>(), 8);
+}
+
+#[test]
+fn value_round_trips_primitives() {
+    for n in [0.0, -0.0, 1.5, -1e308, f64::INFINITY, f64::NEG_INFINITY, f64::MIN_POSITIVE] {
+        let back = round_trip(JsValue::Number(n)).to_number();
+        assert_eq!(back.to_bits(), n.to_bits());
+    }
+    assert!(round_trip(JsValue::Number(f64::NAN)).to_number().is_nan());
+    assert!(round_trip(JsValue::Number(-f64::NAN)).to_number().is_nan());
+    assert!(matches!(round_trip(JsValue::Undefined), JsValue::Undefined));
+    assert!(matches!(round_trip(JsValue::Null), JsValue::Null));
+    assert!(matches!(round_trip(JsValue::Bool(true)), JsValue::Bool(true)));
+    assert!(matches!(round_trip(JsValue::Bool(false)), JsValue::Bool(false)));
+}
+
+#[test]
+fn value_round_trips_strings_of_every_size() {
+    for s in ["", "a\0b", "héllo", "sixsix", "seven77", "fourteen-bytes", "a much longer heap string"] {
+        let back = round_trip(JsValue::String(JsStr::from(s)));
+        assert_eq!(back.to_js_string(), s);
+    }
+}
+
+#[test]
+fn value_truthiness_matches_js_value() {
+    let cases = [
+        JsValue::Number(0.0), JsValue::Number(-0.0), JsValue::Number(f64::NAN), JsValue::Number(2.0),
+        JsValue::String(JsStr::from("")), JsValue::String(JsStr::from("0")),
+        JsValue::String(JsStr::from("a longer string here")),
+        JsValue::Undefined, JsValue::Null, JsValue::Bool(false), JsValue::new_object(),
+    ];
+    for v in cases {
+        assert_eq!(Value::from(v.clone()).to_boolean(), v.to_boolean(), "{:?}", v);
+    }
+}
+
+#[test]
+fn value_keeps_reference_counts() {
+    let obj = JsValue::new_object();
+    let JsValue::Object(rc) = &obj else { unreachable!() };
+    let before = std::rc::Rc::strong_count(rc);
+    let packed = Value::from(obj.clone());
+    let copies: Vec<Value> = (0..3).map(|_| packed.clone()).collect();
+    assert_eq!(std::rc::Rc::strong_count(rc), before + 4);
+    drop(copies);
+    let back = packed.into_js();
+    assert_eq!(std::rc::Rc::strong_count(rc), before + 1);
+    drop(back);
+    assert_eq!(std::rc::Rc::strong_count(rc), before);
+}
@@ -284,3 +284,37 @@ fn ternary_with_side_effect() {
 fn comma_operator_returns_last() {
     assert_eq!(num("(1, 2, 3)"), 3.0);
 }
+
+// ── update expressions as operands ───────────────────────────────────────────
+
+#[test]
+fn prefix_increment_as_argument() {
+    // The prefix result must not leave an extra value on the stack.
+    assert_eq!(num("function f(a, b) { return a * 10 + b; } function g() { let i = 0; return f(++i, 2); } g()"), 12.0);
+}
+
+#[test]
+fn update_expressions_in_local_loop() {
+    assert_eq!(num(r#"
+        function f() {
+            var s = 0;
+            for (let i = 0; i < 10; i++) { s += i; }
+            for (var j = 10; j > 0; --j) { s -= 1; }
+            var k = 5; k--; ++k; k++;
+            return s * 100 + k;
+        }
+        f()
+    "#), 3506.0);
+}
+
+// ── constant folding ──────────────────────────────────────────────────────────
+
+#[test]
+fn constant_folding_matches_runtime() {
+    assert_eq!(num("1 + 2 * 3 - 8 / 4 + 7 % 4"), 8.0);
+    assert_eq!(num("(1 << 4) | 3"), 19.0);
+    assert_eq!(num("-(2 ** 3)"), -8.0);
+    assert_eq!(num("1024 >>> 3"), 128.0);
+    assert_eq!(str_("'ab' + 'cd'"), "abcd");
+    assert_eq!(str_("1 + 2 + 'x'"), "3x");
+}
@@ -263,3 +263,54 @@ fn string_string_method_chaining() {
         "hi world"
     );
 }
+
+// ── ropes, slices and atoms ───────────────────────────────────────────────────
+
+#[test]
+fn long_concatenation_loop() {
+    // Builds a rope 100 000 appends deep; reading and dropping it must not
+    // recurse.
+    assert_eq!(num(r#"
+        var s = "";
+        for (var i = 0; i < 100000; i++) { s += "ab"; }
+        s.length
+    "#), 200000.0);
+    assert_eq!(str_(r#"
+        var s = "";
+        for (var i = 0; i < 1000; i++) { s += i % 10; }
+        s.slice(0, 12) + "|" + s.slice(-3)
+    "#), "012345678901|789");
+}
+
+#[test]
+fn rope_equals_flat_string() {
+    assert!(bool_(r#"
+        var a = "";
+        for (var i = 0; i < 40; i++) { a = a + "xy"; }
+        a === "xy".repeat(40) && a == "xy".repeat(40)
+    "#));
+}
+
+#[test]
+fn rope_as_property_key() {
+    assert_eq!(num(r#"
+        var k = "a-fairly-long-property-name-" + "built-at-runtime-0123456789";
+        var o = {};
+        o[k] = 7;
+        o["a-fairly-long-property-name-built-at-runtime-0123456789"]
+    "#), 7.0);
+}
+
+#[test]
+fn slices_of_long_strings() {
+    assert_eq!(str_(r#"
+        var s = "the quick brown fox jumps over the lazy dog, again and again";
+        var t = s.substring(4, 40);
+        t.slice(6, 15) + "|" + t.length
+    "#), "brown fox|36");
+    assert_eq!(str_(r#"
+        var parts = "  first-long-field-value, second-long-field-value  ".trim().split(", ");
+        parts[1].toUpperCase() + "|" + parts.length
+    "#), "SECOND-LONG-FIELD-VALUE|2");
+    assert_eq!(str_(r#""héllo wörld, this is a long non-ascii string".slice(1, 11)"#), "éllo wörld");
+}
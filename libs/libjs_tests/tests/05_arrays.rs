@@ -282,3 +282,30 @@ fn for_each_sums() {
     e.eval("var sum = 0; [1,2,3,4].forEach(function(x){ sum += x; });");
     assert_eq!(e.get_global("sum").to_number(), 10.0);
 }
+
+// ── element kinds ─────────────────────────────────────────────────────────────
+
+#[test]
+fn int_array_widens_to_double() {
+    assert_eq!(str_("var a = [1, 2, 3]; a[1] = 2.5; a.join(',')"), "1,2.5,3");
+}
+
+#[test]
+fn number_array_widens_to_generic() {
+    assert_eq!(str_("var a = [1, 2.5]; a.push('x'); a.push(null); a.join('|')"), "1|2.5|x|");
+}
+
+#[test]
+fn new_array_holds_undefined_until_filled() {
+    assert_eq!(str_("var a = new Array(3); var t = typeof a[1]; a[1] = 7; t + ':' + a[1] + ':' + a.length"), "undefined:7:3");
+}
+
+#[test]
+fn nan_and_negative_zero_survive_packing() {
+    assert!(bool_("var a = [1, 2]; a[0] = NaN; a[1] = -0; a[0] != a[0] && 1 / a[1] == -Infinity"));
+}
+
+#[test]
+fn sort_keeps_values_after_widening() {
+    assert_eq!(str_("var a = [3, 1, 2]; a.push('0'); a.sort(); a.join(',')"), "0,1,2,3");
+}
@@ -212,3 +212,80 @@ fn object_create_inherits_property() {
     "#);
     assert_eq!(e.get_global("result").to_js_string(), "hello");
 }
+
+// ── shapes and inline caches ─────────────────────────────────────────────────
+
+#[test]
+fn polymorphic_property_site() {
+    assert_eq!(num(r#"
+        function getX(o) { return o.x; }
+        var objs = [{ x: 1 }, { y: 0, x: 2 }, { a: 0, b: 0, x: 3 }, { x: 4, z: 0 }, { q: 0, x: 5 }];
+        var sum = 0;
+        for (var i = 0; i < 3; i++) {
+            for (var j = 0; j < objs.length; j++) { sum += getX(objs[j]); }
+        }
+        sum
+    "#), 45.0);
+}
+
+#[test]
+fn cached_prototype_load_sees_shadowing() {
+    assert_eq!(str_(r#"
+        var proto = { who: function() { return "proto"; } };
+        var o = Object.create(proto);
+        var out = "";
+        for (var i = 0; i < 3; i++) {
+            if (i == 2) { o.who = function() { return "own"; }; }
+            out += o.who() + ",";
+        }
+        out
+    "#), "proto,proto,own,");
+}
+
+#[test]
+fn cached_prototype_load_sees_proto_change() {
+    assert_eq!(str_(r#"
+        var a = { v: "a" };
+        var b = { v: "b" };
+        var o = Object.create(a);
+        var out = "";
+        for (var i = 0; i < 3; i++) {
+            if (i == 1) { o.__proto__ = b; }
+            out += o.v;
+        }
+        out
+    "#), "abb");
+}
+
+#[test]
+fn cached_load_after_delete() {
+    assert_eq!(str_(r#"
+        var o = { x: 1, y: 2 };
+        var out = "";
+        for (var i = 0; i < 3; i++) {
+            if (i == 1) { delete o.x; }
+            out += o.y + ":" + o.x + ",";
+        }
+        out
+    "#), "2:1,2:undefined,2:undefined,");
+}
+
+#[test]
+fn constructor_stores_share_layout() {
+    assert_eq!(num(r#"
+        function P(x, y) { this.x = x; this.y = y; }
+        var s = 0;
+        for (var i = 0; i < 50; i++) { var p = new P(i, 1); s += p.x + p.y; }
+        s
+    "#), 1275.0);
+}
+
+#[test]
+fn many_properties_dictionary_mode() {
+    assert_eq!(num(r#"
+        var o = {};
+        for (var i = 0; i < 40; i++) { o["k" + i] = i; }
+        o.k3 = 100;
+        o.k3 + o.k39 + Object.keys(o).length
+    "#), 179.0);
+}
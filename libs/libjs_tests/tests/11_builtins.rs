@@ -211,3 +211,74 @@ fn set_iteration() {
     "#);
     assert_eq!(e.get_global("sum").to_number(), 60.0);
 }
+
+// ── ArrayBuffer / typed arrays / DataView ─────────────────────────────────────
+
+#[test]
+fn typed_array_zero_filled() {
+    assert_eq!(str_("var t = new Uint8Array(4); t.length + ':' + t.byteLength + ':' + t[2]"), "4:4:0");
+}
+
+#[test]
+fn typed_array_wraps_and_clamps() {
+    assert_eq!(str_("var a = new Uint8Array([256, -1, 3.7]); a.join(',')"), "0,255,3");
+    assert_eq!(str_("var c = new Uint8ClampedArray([300, -5, 2.5, 3.5]); c.join(',')"), "255,0,2,4");
+}
+
+#[test]
+fn typed_arrays_share_a_buffer() {
+    assert_eq!(num(r#"
+        var buf = new ArrayBuffer(8);
+        var bytes = new Uint8Array(buf);
+        var words = new Uint32Array(buf, 4, 1);
+        words[0] = 0x01020304;
+        bytes[4] + bytes[7] * 100
+    "#), 4.0 + 100.0);
+}
+
+#[test]
+fn subarray_aliases_and_slice_copies() {
+    assert_eq!(str_(r#"
+        var a = new Int16Array([1, 2, 3, 4]);
+        var s = a.subarray(1, 3); s[0] = 20;
+        var c = a.slice(2); c[0] = 30;
+        a.join(',') + '/' + s.length + '/' + c.join(',')
+    "#), "1,20,3,4/2/30,4");
+}
+
+#[test]
+fn float_arrays_round_to_precision() {
+    assert!(bool_("var f = new Float32Array(1); f[0] = 0.1; f[0] != 0.1 && Math.abs(f[0] - 0.1) < 1e-7"));
+    assert_eq!(num("var d = new Float64Array([0.1]); d[0]"), 0.1);
+}
+
+#[test]
+fn data_view_endianness() {
+    assert_eq!(str_(r#"
+        var dv = new DataView(new ArrayBuffer(4));
+        dv.setUint16(0, 0x1234);
+        dv.setUint16(2, 0x1234, true);
+        var b = new Uint8Array(dv.buffer);
+        b.join(',') + ':' + dv.getUint16(0) + ':' + dv.getInt8(3)
+    "#), "18,52,52,18:4660:18");
+}
+
+#[test]
+fn data_view_out_of_range_throws() {
+    assert_eq!(str_(r#"
+        var r = 'none';
+        try { new DataView(new ArrayBuffer(2)).getUint32(0); } catch (e) { r = e.name; }
+        r
+    "#), "RangeError");
+}
+
+#[test]
+fn typed_array_iteration_and_spread() {
+    assert_eq!(num("var s = 0; for (var v of new Int8Array([1, -2, 3])) s += v; s"), 2.0);
+    assert_eq!(str_("[...new Uint8Array([5, 6])].concat(Array.from(new Int8Array([7]))).join(',')"), "5,6,7");
+}
+
+#[test]
+fn typed_array_instanceof_and_is_view() {
+    assert!(bool_("var t = new Float64Array(2); t instanceof Float64Array && ArrayBuffer.isView(t) && !ArrayBuffer.isView(t.buffer)"));
+}
@@ -431,3 +431,37 @@ fn group_by_with_reduce() {
     assert_eq!(e.get_global("a_sum").to_number(), 4.0);   // 1+3
     assert_eq!(e.get_global("b_count").to_number(), 2.0); // [2,4]
 }
+
+// ── cycle collection ─────────────────────────────────────────────────────────
+
+#[test]
+fn cycles_are_collected() {
+    let mut e = JsEngine::new();
+    e.eval(r#"
+        for (var i = 0; i < 200; i++) {
+            var a = { name: "a" };
+            var b = { peer: a };
+            a.peer = b;
+            (function () { var o = {}; o.f = function () { return o; }; })();
+        }
+    "#);
+    let freed = e.vm().collect_garbage();
+    // 199 unreachable a/b pairs, 200 object ↔ closure ↔ captured cell rings.
+    assert!(freed >= 1000, "freed {}", freed);
+}
+
+#[test]
+fn collector_keeps_reachable_cycles() {
+    let mut e = JsEngine::new();
+    e.eval(r#"
+        var keep = { v: 42 };
+        keep.self = keep;
+        function counter() { var n = 0; return function () { n += 1; return n; }; }
+        var next = counter();
+        next();
+    "#);
+    e.vm().collect_garbage();
+    assert_eq!(e.eval("keep.self.self.v").to_number(), 42.0);
+    assert_eq!(e.eval("next()").to_number(), 2.0);
+    assert!(e.eval("console.heap().collections").to_number() >= 1.0);
+}
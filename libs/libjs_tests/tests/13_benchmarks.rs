@@ -0,0 +1,36 @@
+//! Benchmark corpus — Richards, DeltaBlue, a JSON round trip and a typed
+//! array image pass run to completion, with and without the bytecode
+//! optimizer.
+//!
+//! Level 13: whole programs; the optimizer must not change their results.
+
+use libjs_tests::bench::{self, CORPUS};
+
+fn check(name: &'static str, optimize: bool) {
+    let b = CORPUS.iter().find(|b| b.name == name).unwrap();
+    assert_eq!(bench::with_stack(move || bench::run(b, optimize)), b.expected);
+}
+
+#[test]
+fn richards() { check("richards", true); }
+
+#[test]
+fn richards_unoptimized() { check("richards", false); }
+
+#[test]
+fn deltablue() { check("deltablue", true); }
+
+#[test]
+fn deltablue_unoptimized() { check("deltablue", false); }
+
+#[test]
+fn json_round_trip() { check("json", true); }
+
+#[test]
+fn json_round_trip_unoptimized() { check("json", false); }
+
+#[test]
+fn pixels() { check("pixels", true); }
+
+#[test]
+fn pixels_unoptimized() { check("pixels", false); }
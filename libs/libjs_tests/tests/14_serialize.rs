@@ -0,0 +1,92 @@
+//! Bytecode serialization — chunks survive `encode` / `decode` unchanged,
+//! and bad input is rejected instead of producing a broken chunk.
+//!
+//! Level 14: the compiled-script cache format.
+
+use libjs_tests::bench::{self, CORPUS};
+use libjs_tests::serialize::{decode, encode, FORMAT_VERSION};
+use libjs_tests::JsEngine;
+
+/// Compile `src`, round-trip it through the cache format and run it.
+fn run_decoded(src: &str) -> JsEngine {
+    let mut e = JsEngine::new();
+    let chunk = e.compile(src);
+    let chunk = decode(&encode(&chunk)).expect("decode");
+    e.execute(chunk);
+    e
+}
+
+fn check_corpus(name: &'static str) {
+    let b = CORPUS.iter().find(|b| b.name == name).unwrap();
+    assert_eq!(bench::with_stack(move || bench::run_decoded(b)), b.expected);
+}
+
+// ── round trips ──────────────────────────────────────────────────────────────
+
+#[test]
+fn closures_and_upvalues() {
+    let mut e = run_decoded(r#"
+        function counter(start) {
+            var n = start;
+            return function() { n = n + 1; return n; };
+        }
+        var c = counter(10);
+        c(); c();
+        var result = c();
+    "#);
+    assert_eq!(e.get_global("result").to_number(), 13.0);
+}
+
+#[test]
+fn classes_strings_and_exceptions() {
+    let mut e = run_decoded(r#"
+        class Point {
+            constructor(x, y) { this.x = x; this.y = y; }
+            toString() { return "(" + this.x + ", " + this.y + ")"; }
+        }
+        var caught = "";
+        try { throw new Error("boom"); } catch (err) { caught = err.message; }
+        var result = new Point(1.5, -2).toString() + " " + caught;
+    "#);
+    assert_eq!(e.get_global("result").to_js_string(), "(1.5, -2) boom");
+}
+
+#[test]
+fn encoding_is_stable() {
+    let e = JsEngine::new();
+    let chunk = e.compile("function f(a, b) { return a * b + 0.25; } var r = f(3, 4);");
+    let bytes = encode(&chunk);
+    assert_eq!(encode(&decode(&bytes).unwrap()), bytes);
+}
+
+#[test]
+fn richards() { check_corpus("richards"); }
+
+#[test]
+fn deltablue() { check_corpus("deltablue"); }
+
+#[test]
+fn json_round_trip() { check_corpus("json"); }
+
+// ── rejection ────────────────────────────────────────────────────────────────
+
+#[test]
+fn rejects_other_versions() {
+    let mut bytes = encode(&JsEngine::new().compile("var x = 1;"));
+    let other = (FORMAT_VERSION + 1).to_le_bytes();
+    bytes[4] = other[0];
+    bytes[5] = other[1];
+    assert!(decode(&bytes).is_none());
+}
+
+#[test]
+fn rejects_truncated_and_garbage() {
+    let bytes = encode(&JsEngine::new().compile("function f() { return 'x'; } f();"));
+    for len in 0..bytes.len() {
+        assert!(decode(&bytes[..len]).is_none(), "truncated at {}", len);
+    }
+    let mut trailing = bytes.clone();
+    trailing.push(0);
+    assert!(decode(&trailing).is_none());
+    assert!(decode(b"not bytecode").is_none());
+}
@@ -0,0 +1,82 @@
+//! Anti-aliased coverage of rounded-rectangle corners.
+//!
+//! A corner of radius `r` is an `r x r` block whose coverage depends only on
+//! `r`, so the masks for every radius up to [`MAX_CACHED_RADIUS`] are built
+//! at compile time and live in `.rodata`, shared by every process that maps
+//! the library. Radii are in physical pixels (callers pre-scale them), so
+//! the radius alone is the cache key. Larger radii compute coverage per row.
+
+/// Largest radius with a precomputed mask.
+pub const MAX_CACHED_RADIUS: usize = 32;
+
+/// Offset of the mask for radius `r` in the tables (`sum k*k, k < r`).
+const fn mask_offset(r: usize) -> usize {
+    (r - 1) * r * (2 * r - 1) / 6
+}
+
+const TABLE_LEN: usize = mask_offset(MAX_CACHED_RADIUS + 1);
+
+/// Coverage (0-255) of pixel (`dx`, `dy`) in the top-left corner of radius
+/// `r`, with (0, 0) the outermost pixel. The edge is a band of width `3r`
+/// around the circle in doubled coordinates.
+pub const fn coverage(r: i32, dx: i32, dy: i32) -> u8 {
+    let cy = 2 * dy + 1 - 2 * r;
+    let cx = 2 * dx + 1 - 2 * r;
+    let dist_sq = cx * cx + cy * cy;
+    let r2x4 = (2 * r) * (2 * r);
+    let transition = 3 * r;
+    if dist_sq >= r2x4 + transition {
+        0
+    } else if dist_sq <= r2x4 - transition {
+        255
+    } else {
+        let alpha = 255 * (r2x4 + transition - dist_sq) / (2 * transition);
+        if alpha <= 0 { 0 } else if alpha >= 255 { 255 } else { alpha as u8 }
+    }
+}
+
+/// First column of row `dy` that is fully covered (`r` if none is).
+pub fn fill_start(r: i32, dy: i32) -> i32 {
+    let mut dx = 0;
+    while dx < r && coverage(r, dx, dy) != 255 {
+        dx += 1;
+    }
+    dx
+}
+
+const fn build(mirror: bool) -> [u8; TABLE_LEN] {
+    let mut table = [0u8; TABLE_LEN];
+    let mut r = 1;
+    while r <= MAX_CACHED_RADIUS {
+        let base = mask_offset(r);
+        let mut dy = 0;
+        while dy < r {
+            let mut dx = 0;
+            while dx < r {
+                let col = if mirror { r - 1 - dx } else { dx };
+                table[base + dy * r + col] = coverage(r as i32, dx as i32, dy as i32);
+                dx += 1;
+            }
+            dy += 1;
+        }
+        r += 1;
+    }
+    table
+}
+
+/// Rows of the left-hand corners, outermost pixel first.
+static LEFT: [u8; TABLE_LEN] = build(false);
+/// Rows of the right-hand corners, outermost pixel last.
+static RIGHT: [u8; TABLE_LEN] = build(true);
+
+/// Cached coverage of row `dy` across a left (`mirror` false) or right
+/// corner of radius `r`, left to right, or `None` if `r` is not cached.
+pub fn row(r: i32, dy: i32, mirror: bool) -> Option<&'static [u8]> {
+    if r <= 0 || r as usize > MAX_CACHED_RADIUS {
+        return None;
+    }
+    let r = r as usize;
+    let start = mask_offset(r) + dy as usize * r;
+    let table = if mirror { &RIGHT } else { &LEFT };
+    Some(&table[start..start + r])
+}
@@ -2,10 +2,12 @@
 #![no_main]
 
 pub mod color;
+pub mod corner;
 pub mod rect;
 pub mod surface;
 pub mod renderer;
 pub mod exports;
+pub mod simd;
 
 /// Dummy entry point (never called — DLL has no entry).
 #[no_mangle]
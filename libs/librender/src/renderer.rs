@@ -1,19 +1,21 @@
 //! High-level 2D renderer providing geometric primitives on top of a RenderSurface.
 
 use crate::color::Color;
+use crate::corner;
 use crate::rect::Rect;
 use crate::surface::RenderSurface;
 
-/// Integer square root (no floating point needed).
-fn isqrt(n: i32) -> i32 {
+/// Step `x` to `isqrt(n)`. Successive rows of a circle change `n` by little,
+/// so carrying `x` over from the previous row keeps this O(1) amortized.
+fn step_isqrt(mut x: i32, n: i32) -> i32 {
     if n <= 0 {
         return 0;
     }
-    let mut x = n;
-    let mut y = (x + 1) / 2;
-    while y < x {
-        x = y;
-        y = (x + n / x) / 2;
+    while (x + 1) * (x + 1) <= n {
+        x += 1;
+    }
+    while x * x > n {
+        x -= 1;
     }
     x
 }
@@ -102,8 +104,9 @@ impl<'a> Renderer<'a> {
     }
 
     pub fn fill_circle(&mut self, cx: i32, cy: i32, radius: i32, color: Color) {
+        let mut dx = 0;
         for dy in -radius..=radius {
-            let dx = isqrt(radius * radius - dy * dy);
+            dx = step_isqrt(dx, radius * radius - dy * dy);
             let y = cy + dy;
             self.surface.fill_rect(
                 Rect::new(cx - dx, y, (dx * 2 + 1) as u32, 1),
@@ -196,66 +199,43 @@ impl<'a> Renderer<'a> {
             );
         }
 
-        let r2x4 = (2 * r) * (2 * r);
-        let transition = 3 * r;
         for dy in 0..r {
-            let cy = 2 * dy + 1 - 2 * r;
-            let cy2 = cy * cy;
-
-            let mut fill_start = r;
-            for dx in 0..r {
-                let cx = 2 * dx + 1 - 2 * r;
-                let dist_sq = cx * cx + cy2;
-                if dist_sq <= r2x4 - transition {
-                    fill_start = dx;
-                    break;
+            let top = rect.y + dy;
+            let bottom = rect.bottom() - 1 - dy;
+            if let (Some(left), Some(right)) = (corner::row(r, dy, false), corner::row(r, dy, true)) {
+                for y in [top, bottom] {
+                    self.surface.fill_span_masked(rect.x, y, left, color);
+                    self.surface.fill_span_masked(rect.right() - r, y, right, color);
                 }
+                continue;
             }
 
+            // Uncached radius: fill the covered part of the row, then build
+            // the edge coverage in chunks.
+            let fill_start = corner::fill_start(r, dy);
             let fill_width = (r - fill_start) as u32;
             if fill_width > 0 {
-                self.surface.fill_rect(
-                    Rect::new(rect.x + fill_start, rect.y + dy, fill_width, 1),
-                    color,
-                );
-                self.surface.fill_rect(
-                    Rect::new(rect.right() - r, rect.y + dy, fill_width, 1),
-                    color,
-                );
-                self.surface.fill_rect(
-                    Rect::new(rect.x + fill_start, rect.bottom() - 1 - dy, fill_width, 1),
-                    color,
-                );
-                self.surface.fill_rect(
-                    Rect::new(rect.right() - r, rect.bottom() - 1 - dy, fill_width, 1),
-                    color,
-                );
+                for y in [top, bottom] {
+                    self.surface.fill_rect(Rect::new(rect.x + fill_start, y, fill_width, 1), color);
+                    self.surface.fill_rect(Rect::new(rect.right() - r, y, fill_width, 1), color);
+                }
             }
-
-            for dx in 0..fill_start {
-                let cx = 2 * dx + 1 - 2 * r;
-                let dist_sq = cx * cx + cy2;
-
-                if dist_sq >= r2x4 + transition {
-                    continue;
+            let mut buf = [0u8; 64];
+            let mut dx0 = 0;
+            while dx0 < fill_start {
+                let n = (fill_start - dx0).min(buf.len() as i32);
+                for i in 0..n {
+                    buf[i as usize] = corner::coverage(r, dx0 + i, dy);
                 }
-
-                let alpha = if dist_sq <= r2x4 - transition {
-                    255i32
-                } else {
-                    255 * (r2x4 + transition - dist_sq) / (2 * transition)
-                };
-
-                if alpha <= 0 {
-                    continue;
+                let left = &mut buf[..n as usize];
+                for y in [top, bottom] {
+                    self.surface.fill_span_masked(rect.x + dx0, y, left, color);
                 }
-                let a = (alpha.min(255) as u32 * color.a as u32 / 255) as u8;
-                let aa_color = Color::with_alpha(a, color.r, color.g, color.b);
-
-                self.surface.put_pixel(rect.x + dx, rect.y + dy, aa_color);
-                self.surface.put_pixel(rect.right() - 1 - dx, rect.y + dy, aa_color);
-                self.surface.put_pixel(rect.x + dx, rect.bottom() - 1 - dy, aa_color);
-                self.surface.put_pixel(rect.right() - 1 - dx, rect.bottom() - 1 - dy, aa_color);
+                left.reverse();
+                for y in [top, bottom] {
+                    self.surface.fill_span_masked(rect.right() - dx0 - n, y, left, color);
+                }
+                dx0 += n;
             }
         }
     }
@@ -264,10 +244,10 @@ impl<'a> Renderer<'a> {
         if radius <= 0 {
             return;
         }
+        let mut dx_max = 0;
         for dy in -radius..=radius {
             let y = cy + dy;
-            let inner_sq = radius * radius - dy * dy;
-            let dx_max = isqrt(inner_sq);
+            dx_max = step_isqrt(dx_max, radius * radius - dy * dy);
 
             if dx_max > 1 {
                 self.surface.fill_rect(
@@ -397,18 +377,16 @@ impl<'a> Renderer<'a> {
     }
 
     pub fn fill_gradient_h(&mut self, rect: Rect, left: Color, right: Color) {
-        for x in 0..rect.width {
-            let t = x as u32 * 255 / rect.width.max(1);
-            let color = Color::new(
+        let w = rect.width.max(1);
+        self.surface.fill_columns(rect, |sx| {
+            let t = (sx - rect.x) as u32 * 255 / w;
+            Color::new(
                 ((left.r as u32 * (255 - t) + right.r as u32 * t) / 255) as u8,
                 ((left.g as u32 * (255 - t) + right.g as u32 * t) / 255) as u8,
                 ((left.b as u32 * (255 - t) + right.b as u32 * t) / 255) as u8,
-            );
-            self.surface.fill_rect(
-                Rect::new(rect.x + x as i32, rect.y, 1, rect.height),
-                color,
-            );
-        }
+            )
+            .to_u32()
+        });
     }
 
     pub fn fill_gradient_v(&mut self, rect: Rect, top: Color, bottom: Color) {
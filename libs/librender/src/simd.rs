@@ -0,0 +1,527 @@
+//! SIMD span kernels behind the surface fill, blend and blit paths.
+//!
+//! Solid fills, constant-colour blends, coverage-masked blends (anti-aliased
+//! edges) and per-pixel-alpha blits, processed 4 (SSE2, NEON: 8) or 8 (AVX2)
+//! pixels at a time. SSE2 is the x86_64 baseline; AVX2 is picked from CPUID
+//! on first use, since a DLL has no init hook. `Color::blend_over` stays the
+//! reference for every kernel (and handles span tails), and all variants
+//! produce bit-identical results to it.
+//!
+//! Blending uses `div255(s*a + d*(255-a))` per channel in 16-bit lanes, with
+//! the output alpha forced to 255 like `blend_over`. Pixels whose effective
+//! alpha is 0 keep the destination untouched, alpha included.
+
+use core::sync::atomic::{AtomicU8, Ordering};
+
+use crate::color::Color;
+
+const LEVEL_UNKNOWN: u8 = 0xFF;
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+const LEVEL_SCALAR: u8 = 0;
+#[cfg(target_arch = "x86_64")]
+const LEVEL_SSE2: u8 = 1;
+#[cfg(target_arch = "x86_64")]
+const LEVEL_AVX2: u8 = 2;
+#[cfg(target_arch = "aarch64")]
+const LEVEL_NEON: u8 = 3;
+
+static LEVEL: AtomicU8 = AtomicU8::new(LEVEL_UNKNOWN);
+
+/// Widest kernel set the CPU supports, detected once per process.
+#[inline]
+fn level() -> u8 {
+    let l = LEVEL.load(Ordering::Relaxed);
+    if l != LEVEL_UNKNOWN {
+        return l;
+    }
+    let l = detect();
+    LEVEL.store(l, Ordering::Relaxed);
+    l
+}
+
+#[cfg(target_arch = "x86_64")]
+fn detect() -> u8 {
+    use core::arch::x86_64::{__cpuid, __cpuid_count};
+    let leaf1 = unsafe { __cpuid(1) };
+    // AVX2 needs the OS to save YMM state (OSXSAVE + XCR0 bits 1-2).
+    let osxsave = leaf1.ecx & (1 << 27) != 0;
+    let avx = leaf1.ecx & (1 << 28) != 0;
+    if osxsave && avx && unsafe { __cpuid(0) }.eax >= 7 {
+        let xcr0: u32;
+        unsafe {
+            core::arch::asm!("xgetbv", in("ecx") 0u32, out("eax") xcr0, out("edx") _,
+                options(nomem, nostack, preserves_flags));
+        }
+        let avx2 = unsafe { __cpuid_count(7, 0) }.ebx & (1 << 5) != 0;
+        if xcr0 & 0x6 == 0x6 && avx2 {
+            return LEVEL_AVX2;
+        }
+    }
+    LEVEL_SSE2
+}
+
+#[cfg(target_arch = "aarch64")]
+fn detect() -> u8 {
+    // NEON is mandatory on AArch64.
+    LEVEL_NEON
+}
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+fn detect() -> u8 {
+    LEVEL_SCALAR
+}
+
+// ── Public span kernels ─────────────────────────────────────────────────────
+
+/// Fill `dst` with the packed pixel `val`.
+pub fn fill_row(dst: &mut [u32], val: u32) {
+    let n = dst.len();
+    let done = match level() {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::fill_row_avx2(dst, val, n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE2 => unsafe { x86::fill_row_sse2(dst, val, n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::fill_row(dst, val, n) },
+        _ => 0,
+    };
+    for d in &mut dst[done..] {
+        *d = val;
+    }
+}
+
+/// Blend `color` over every pixel of `dst`.
+pub fn blend_const_row(dst: &mut [u32], color: Color) {
+    if color.a == 0 {
+        return;
+    }
+    if color.a == 255 {
+        fill_row(dst, color.to_u32());
+        return;
+    }
+    let n = dst.len();
+    let done = match level() {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::blend_const_row_avx2(dst, color.to_u32(), n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE2 => unsafe { x86::blend_const_row_sse2(dst, color.to_u32(), n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::blend_const_row(dst, color, n) },
+        _ => 0,
+    };
+    for d in &mut dst[done..] {
+        *d = color.blend_over(Color::from_u32(*d)).to_u32();
+    }
+}
+
+/// Blend `color` over `dst`, scaling its alpha by the per-pixel `coverage`.
+pub fn mask_row(dst: &mut [u32], coverage: &[u8], color: Color) {
+    let n = dst.len().min(coverage.len());
+    if color.a == 0 {
+        return;
+    }
+    let done = match level() {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::mask_row_avx2(dst, coverage, color.to_u32(), n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE2 => unsafe { x86::mask_row_sse2(dst, coverage, color.to_u32(), n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::mask_row(dst, coverage, color, n) },
+        _ => 0,
+    };
+    for (d, &m) in dst[done..n].iter_mut().zip(&coverage[done..n]) {
+        let a = (m as u32 * color.a as u32 / 255) as u8;
+        if a != 0 {
+            let c = Color::with_alpha(a, color.r, color.g, color.b);
+            *d = c.blend_over(Color::from_u32(*d)).to_u32();
+        }
+    }
+}
+
+/// Blend `src` over `dst` using each source pixel's alpha.
+pub fn blend_row(dst: &mut [u32], src: &[u32]) {
+    let n = dst.len().min(src.len());
+    let done = match level() {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::blend_row_avx2(dst, src, n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE2 => unsafe { x86::blend_row_sse2(dst, src, n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::blend_row(dst, src, n) },
+        _ => 0,
+    };
+    for (d, &s) in dst[done..n].iter_mut().zip(&src[done..n]) {
+        let a = s >> 24;
+        if a >= 255 {
+            *d = s;
+        } else if a != 0 {
+            *d = Color::from_u32(s).blend_over(Color::from_u32(*d)).to_u32();
+        }
+    }
+}
+
+/// Copy `src` to `dst` without blending.
+pub fn copy_row(dst: &mut [u32], src: &[u32]) {
+    let n = dst.len().min(src.len());
+    let done = match level() {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::copy_row_avx2(dst, src, n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE2 => unsafe { x86::copy_row_sse2(dst, src, n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::copy_row(dst, src, n) },
+        _ => 0,
+    };
+    dst[done..n].copy_from_slice(&src[done..n]);
+}
+
+// ── x86_64: SSE2 / AVX2 ─────────────────────────────────────────────────────
+
+#[cfg(target_arch = "x86_64")]
+mod x86 {
+    use core::arch::x86_64::*;
+
+    /// `div255` on 16-bit lanes: `(x + 1 + (x >> 8)) >> 8`.
+    #[inline(always)]
+    unsafe fn div255_epi16(x: __m128i) -> __m128i {
+        let one = _mm_set1_epi16(1);
+        _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8)
+    }
+
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn div255_epi16_256(x: __m256i) -> __m256i {
+        let one = _mm256_set1_epi16(1);
+        _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, one), _mm256_srli_epi16(x, 8)), 8)
+    }
+
+    /// Blend 4 pixels `s` over `d`; the result is opaque in every lane.
+    #[inline(always)]
+    unsafe fn blend4(s: __m128i, d: __m128i) -> __m128i {
+        let zero = _mm_setzero_si128();
+        let c255 = _mm_set1_epi16(255);
+        let s_lo = _mm_unpacklo_epi8(s, zero);
+        let s_hi = _mm_unpackhi_epi8(s, zero);
+        // Broadcast each pixel's alpha (16-bit lanes 3 and 7) to its channels.
+        let sa_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xFF), 0xFF);
+        let sa_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xFF), 0xFF);
+        let t_lo = _mm_add_epi16(
+            _mm_mullo_epi16(s_lo, sa_lo),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(c255, sa_lo)),
+        );
+        let t_hi = _mm_add_epi16(
+            _mm_mullo_epi16(s_hi, sa_hi),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(c255, sa_hi)),
+        );
+        let out = _mm_packus_epi16(div255_epi16(t_lo), div255_epi16(t_hi));
+        _mm_or_si128(out, _mm_set1_epi32(0xFF00_0000u32 as i32))
+    }
+
+    /// Blend 8 pixels `s` over `d` (same lane layout as [`blend4`], per 128-bit half).
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn blend8(s: __m256i, d: __m256i) -> __m256i {
+        let zero = _mm256_setzero_si256();
+        let c255 = _mm256_set1_epi16(255);
+        let s_lo = _mm256_unpacklo_epi8(s, zero);
+        let s_hi = _mm256_unpackhi_epi8(s, zero);
+        let sa_lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xFF), 0xFF);
+        let sa_hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xFF), 0xFF);
+        let t_lo = _mm256_add_epi16(
+            _mm256_mullo_epi16(s_lo, sa_lo),
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(c255, sa_lo)),
+        );
+        let t_hi = _mm256_add_epi16(
+            _mm256_mullo_epi16(s_hi, sa_hi),
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(c255, sa_hi)),
+        );
+        let out = _mm256_packus_epi16(div255_epi16_256(t_lo), div255_epi16_256(t_hi));
+        _mm256_or_si256(out, _mm256_set1_epi32(0xFF00_0000u32 as i32))
+    }
+
+    /// `r` where `keep` is clear, `d` where it is set.
+    #[inline(always)]
+    unsafe fn select4(keep: __m128i, d: __m128i, r: __m128i) -> __m128i {
+        _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, r))
+    }
+
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn select8(keep: __m256i, d: __m256i, r: __m256i) -> __m256i {
+        _mm256_or_si256(_mm256_and_si256(keep, d), _mm256_andnot_si256(keep, r))
+    }
+
+    pub(super) unsafe fn fill_row_sse2(dst: &mut [u32], val: u32, n: usize) -> usize {
+        let v = _mm_set1_epi32(val as i32);
+        let mut i = 0;
+        while i + 4 <= n {
+            _mm_storeu_si128(dst.as_mut_ptr().add(i) as *mut __m128i, v);
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn fill_row_avx2(dst: &mut [u32], val: u32, n: usize) -> usize {
+        let v = _mm256_set1_epi32(val as i32);
+        let mut i = 0;
+        while i + 8 <= n {
+            _mm256_storeu_si256(dst.as_mut_ptr().add(i) as *mut __m256i, v);
+            i += 8;
+        }
+        i
+    }
+
+    // A constant colour has the same source term for every pixel, so only
+    // `d * (255 - a)` is computed per lane.
+
+    pub(super) unsafe fn blend_const_row_sse2(dst: &mut [u32], color: u32, n: usize) -> usize {
+        let zero = _mm_setzero_si128();
+        let a = (color >> 24) as i16;
+        let s = _mm_unpacklo_epi8(_mm_set1_epi32(color as i32), zero);
+        let sa = _mm_mullo_epi16(s, _mm_set1_epi16(a));
+        let inv = _mm_set1_epi16(255 - a);
+        let amask = _mm_set1_epi32(0xFF00_0000u32 as i32);
+        let mut i = 0;
+        while i + 4 <= n {
+            let dp = dst.as_mut_ptr().add(i) as *mut __m128i;
+            let d = _mm_loadu_si128(dp);
+            let t_lo = _mm_add_epi16(sa, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv));
+            let t_hi = _mm_add_epi16(sa, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv));
+            let out = _mm_packus_epi16(div255_epi16(t_lo), div255_epi16(t_hi));
+            _mm_storeu_si128(dp, _mm_or_si128(out, amask));
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn blend_const_row_avx2(dst: &mut [u32], color: u32, n: usize) -> usize {
+        let zero = _mm256_setzero_si256();
+        let a = (color >> 24) as i16;
+        let s = _mm256_unpacklo_epi8(_mm256_set1_epi32(color as i32), zero);
+        let sa = _mm256_mullo_epi16(s, _mm256_set1_epi16(a));
+        let inv = _mm256_set1_epi16(255 - a);
+        let amask = _mm256_set1_epi32(0xFF00_0000u32 as i32);
+        let mut i = 0;
+        while i + 8 <= n {
+            let dp = dst.as_mut_ptr().add(i) as *mut __m256i;
+            let d = _mm256_loadu_si256(dp);
+            let t_lo = _mm256_add_epi16(sa, _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv));
+            let t_hi = _mm256_add_epi16(sa, _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv));
+            let out = _mm256_packus_epi16(div255_epi16_256(t_lo), div255_epi16_256(t_hi));
+            _mm256_storeu_si256(dp, _mm256_or_si256(out, amask));
+            i += 8;
+        }
+        i
+    }
+
+    // Coverage-masked blends synthesise a source `rgb | div255(m * a) << 24`
+    // and go through the per-pixel blend.
+
+    pub(super) unsafe fn mask_row_sse2(dst: &mut [u32], coverage: &[u8], color: u32, n: usize) -> usize {
+        let zero = _mm_setzero_si128();
+        let rgb = _mm_set1_epi32((color & 0x00FF_FFFF) as i32);
+        let ca = _mm_set1_epi16((color >> 24) as i16);
+        let mut i = 0;
+        while i + 4 <= n {
+            let m4 = (coverage.as_ptr().add(i) as *const u32).read_unaligned();
+            if m4 != 0 {
+                let m = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(m4 as i32), zero), zero);
+                let a = div255_epi16(_mm_mullo_epi16(m, ca));
+                let s = _mm_or_si128(rgb, _mm_slli_epi32(a, 24));
+                let dp = dst.as_mut_ptr().add(i) as *mut __m128i;
+                let d = _mm_loadu_si128(dp);
+                _mm_storeu_si128(dp, select4(_mm_cmpeq_epi32(a, zero), d, blend4(s, d)));
+            }
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn mask_row_avx2(dst: &mut [u32], coverage: &[u8], color: u32, n: usize) -> usize {
+        let zero = _mm256_setzero_si256();
+        let rgb = _mm256_set1_epi32((color & 0x00FF_FFFF) as i32);
+        let ca = _mm256_set1_epi16((color >> 24) as i16);
+        let mut i = 0;
+        while i + 8 <= n {
+            let m8 = (coverage.as_ptr().add(i) as *const u64).read_unaligned();
+            if m8 != 0 {
+                let m = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(m8 as i64));
+                let a = div255_epi16_256(_mm256_mullo_epi16(m, ca));
+                let s = _mm256_or_si256(rgb, _mm256_slli_epi32(a, 24));
+                let dp = dst.as_mut_ptr().add(i) as *mut __m256i;
+                let d = _mm256_loadu_si256(dp);
+                _mm256_storeu_si256(dp, select8(_mm256_cmpeq_epi32(a, zero), d, blend8(s, d)));
+            }
+            i += 8;
+        }
+        i
+    }
+
+    pub(super) unsafe fn blend_row_sse2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let amask = _mm_set1_epi32(0xFF00_0000u32 as i32);
+        let zero = _mm_setzero_si128();
+        let mut i = 0;
+        while i + 4 <= n {
+            let s = _mm_loadu_si128(src.as_ptr().add(i) as *const __m128i);
+            let sa = _mm_and_si128(s, amask);
+            let clear = _mm_cmpeq_epi32(sa, zero);
+            if _mm_movemask_epi8(clear) != 0xFFFF {
+                let dp = dst.as_mut_ptr().add(i) as *mut __m128i;
+                if _mm_movemask_epi8(_mm_cmpeq_epi32(sa, amask)) == 0xFFFF {
+                    _mm_storeu_si128(dp, s);
+                } else {
+                    let d = _mm_loadu_si128(dp);
+                    _mm_storeu_si128(dp, select4(clear, d, blend4(s, d)));
+                }
+            }
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn blend_row_avx2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let amask = _mm256_set1_epi32(0xFF00_0000u32 as i32);
+        let zero = _mm256_setzero_si256();
+        let mut i = 0;
+        while i + 8 <= n {
+            let s = _mm256_loadu_si256(src.as_ptr().add(i) as *const __m256i);
+            let sa = _mm256_and_si256(s, amask);
+            let clear = _mm256_cmpeq_epi32(sa, zero);
+            if _mm256_movemask_epi8(clear) != -1 {
+                let dp = dst.as_mut_ptr().add(i) as *mut __m256i;
+                if _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, amask)) == -1 {
+                    _mm256_storeu_si256(dp, s);
+                } else {
+                    let d = _mm256_loadu_si256(dp);
+                    _mm256_storeu_si256(dp, select8(clear, d, blend8(s, d)));
+                }
+            }
+            i += 8;
+        }
+        i
+    }
+
+    pub(super) unsafe fn copy_row_sse2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 4 <= n {
+            let v = _mm_loadu_si128(src.as_ptr().add(i) as *const __m128i);
+            _mm_storeu_si128(dst.as_mut_ptr().add(i) as *mut __m128i, v);
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn copy_row_avx2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 8 <= n {
+            let v = _mm256_loadu_si256(src.as_ptr().add(i) as *const __m256i);
+            _mm256_storeu_si256(dst.as_mut_ptr().add(i) as *mut __m256i, v);
+            i += 8;
+        }
+        i
+    }
+}
+
+// ── aarch64: NEON ───────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "aarch64")]
+mod neon {
+    use core::arch::aarch64::*;
+
+    use crate::color::Color;
+
+    #[inline(always)]
+    unsafe fn div255_u16(x: uint16x8_t) -> uint8x8_t {
+        vshrn_n_u16::<8>(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16::<8>(x)))
+    }
+
+    /// Blend 8 deinterleaved pixels (`.0`=B, `.1`=G, `.2`=R, `.3`=A) into
+    /// opaque results; lanes where `s.3` is 0 keep `d`.
+    #[inline(always)]
+    unsafe fn blend8(s: uint8x8x4_t, d: uint8x8x4_t) -> uint8x8x4_t {
+        let sa = s.3;
+        let inv = vmvn_u8(sa);
+        let keep = vceq_u8(sa, vdup_n_u8(0));
+        uint8x8x4_t(
+            vbsl_u8(keep, d.0, div255_u16(vmlal_u8(vmull_u8(s.0, sa), d.0, inv))),
+            vbsl_u8(keep, d.1, div255_u16(vmlal_u8(vmull_u8(s.1, sa), d.1, inv))),
+            vbsl_u8(keep, d.2, div255_u16(vmlal_u8(vmull_u8(s.2, sa), d.2, inv))),
+            vbsl_u8(keep, d.3, vdup_n_u8(255)),
+        )
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn fill_row(dst: &mut [u32], val: u32, n: usize) -> usize {
+        let v = vdupq_n_u32(val);
+        let mut i = 0;
+        while i + 4 <= n {
+            vst1q_u32(dst.as_mut_ptr().add(i), v);
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn blend_const_row(dst: &mut [u32], color: Color, n: usize) -> usize {
+        let s = uint8x8x4_t(vdup_n_u8(color.b), vdup_n_u8(color.g), vdup_n_u8(color.r), vdup_n_u8(color.a));
+        let mut i = 0;
+        while i + 8 <= n {
+            let dp = dst.as_mut_ptr().add(i) as *mut u8;
+            vst4_u8(dp, blend8(s, vld4_u8(dp)));
+            i += 8;
+        }
+        i
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn mask_row(dst: &mut [u32], coverage: &[u8], color: Color, n: usize) -> usize {
+        let (b, g, r) = (vdup_n_u8(color.b), vdup_n_u8(color.g), vdup_n_u8(color.r));
+        let ca = vdup_n_u8(color.a);
+        let mut i = 0;
+        while i + 8 <= n {
+            let m = vld1_u8(coverage.as_ptr().add(i));
+            if vmaxv_u8(m) != 0 {
+                let a = div255_u16(vmull_u8(m, ca));
+                let dp = dst.as_mut_ptr().add(i) as *mut u8;
+                vst4_u8(dp, blend8(uint8x8x4_t(b, g, r, a), vld4_u8(dp)));
+            }
+            i += 8;
+        }
+        i
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn blend_row(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 8 <= n {
+            let sp = src.as_ptr().add(i) as *const u8;
+            let dp = dst.as_mut_ptr().add(i) as *mut u8;
+            let s = vld4_u8(sp);
+            if vmaxv_u8(s.3) != 0 {
+                if vminv_u8(s.3) == 255 {
+                    vst1q_u32(dp as *mut u32, vld1q_u32(sp as *const u32));
+                    vst1q_u32((dp as *mut u32).add(4), vld1q_u32((sp as *const u32).add(4)));
+                } else {
+                    vst4_u8(dp, blend8(s, vld4_u8(dp)));
+                }
+            }
+            i += 8;
+        }
+        i
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn copy_row(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 4 <= n {
+            vst1q_u32(dst.as_mut_ptr().add(i), vld1q_u32(src.as_ptr().add(i)));
+            i += 4;
+        }
+        i
+    }
+}
@@ -5,6 +5,7 @@
 
 use crate::color::Color;
 use crate::rect::Rect;
+use crate::simd;
 
 /// A pixel surface backed by a raw ARGB8888 buffer.
 ///
@@ -78,39 +79,63 @@ impl RenderSurface {
 
     /// Fill the entire surface with a solid color (no blending).
     pub fn fill(&mut self, color: Color) {
-        let val = color.to_u32();
         let len = (self.width * self.height) as usize;
-        unsafe {
-            for i in 0..len {
-                *self.pixels.add(i) = val;
-            }
+        let pixels = unsafe { core::slice::from_raw_parts_mut(self.pixels, len) };
+        simd::fill_row(pixels, color.to_u32());
+    }
+
+    /// Clip `rect` to the surface; returns `(x0, y0, x1, y1)` or `None` if empty.
+    fn clip(&self, rect: Rect) -> Option<(usize, usize, usize, usize)> {
+        let x0 = rect.x.max(0);
+        let y0 = rect.y.max(0);
+        let x1 = rect.right().min(self.width as i32);
+        let y1 = rect.bottom().min(self.height as i32);
+        if x0 >= x1 || y0 >= y1 {
+            return None;
         }
+        Some((x0 as usize, y0 as usize, x1 as usize, y1 as usize))
+    }
+
+    /// Pixels `x0..x1` of row `y` (already clipped).
+    fn span_mut(&mut self, y: usize, x0: usize, x1: usize) -> &mut [u32] {
+        let start = y * self.width as usize + x0;
+        unsafe { core::slice::from_raw_parts_mut(self.pixels.add(start), x1 - x0) }
     }
 
     /// Fill a rectangle with the given color. Opaque colors use direct writes;
     /// semi-transparent colors are alpha-blended per pixel.
     pub fn fill_rect(&mut self, rect: Rect, color: Color) {
-        let x0 = rect.x.max(0) as u32;
-        let y0 = rect.y.max(0) as u32;
-        let x1 = (rect.right() as u32).min(self.width);
-        let y1 = (rect.bottom() as u32).min(self.height);
-
-        let val = color.to_u32();
+        if color.a == 0 {
+            return;
+        }
+        let Some((x0, y0, x1, y1)) = self.clip(rect) else { return };
         for y in y0..y1 {
-            let row_base = (y * self.width) as usize;
-            if color.a == 255 {
-                for x in x0..x1 {
-                    unsafe { *self.pixels.add(row_base + x as usize) = val; }
-                }
-            } else {
-                for x in x0..x1 {
-                    let idx = row_base + x as usize;
-                    unsafe {
-                        let dst = Color::from_u32(*self.pixels.add(idx));
-                        *self.pixels.add(idx) = color.blend_over(dst).to_u32();
-                    }
-                }
-            }
+            simd::blend_const_row(self.span_mut(y, x0, x1), color);
+        }
+    }
+
+    /// Blend `color` over a horizontal span starting at (`x`, `y`), scaling
+    /// its alpha by `coverage` (one byte per pixel).
+    pub fn fill_span_masked(&mut self, x: i32, y: i32, coverage: &[u8], color: Color) {
+        let Some((x0, y0, x1, _)) = self.clip(Rect::new(x, y, coverage.len() as u32, 1)) else {
+            return;
+        };
+        let skip = (x0 as i32 - x) as usize;
+        simd::mask_row(self.span_mut(y0, x0, x1), &coverage[skip..skip + (x1 - x0)], color);
+    }
+
+    /// Fill a rectangle with a pattern that varies only horizontally:
+    /// `column(x)` gives the packed pixel for surface column `x`. The first
+    /// visible row is computed once and copied to the others.
+    pub fn fill_columns(&mut self, rect: Rect, column: impl Fn(i32) -> u32) {
+        let Some((x0, y0, x1, y1)) = self.clip(rect) else { return };
+        let first = self.span_mut(y0, x0, x1);
+        for (i, px) in first.iter_mut().enumerate() {
+            *px = column((x0 + i) as i32);
+        }
+        let first = first as *const [u32];
+        for y in y0 + 1..y1 {
+            simd::copy_row(self.span_mut(y, x0, x1), unsafe { &*first });
         }
     }
 
@@ -159,29 +184,9 @@ impl RenderSurface {
                 let dst_row = core::slice::from_raw_parts_mut(self.pixels.add(dst_start), cw);
 
                 if src_opaque {
-                    dst_row.copy_from_slice(src_row);
+                    simd::copy_row(dst_row, src_row);
                 } else {
-                    // Opaque span batching
-                    let mut i = 0;
-                    while i < cw {
-                        let span_start = i;
-                        while i < cw && (src_row[i] >> 24) >= 255 {
-                            i += 1;
-                        }
-                        if i > span_start {
-                            dst_row[span_start..i].copy_from_slice(&src_row[span_start..i]);
-                        }
-                        while i < cw && (src_row[i] >> 24) < 255 {
-                            let sp = src_row[i];
-                            let a = sp >> 24;
-                            if a > 0 {
-                                let sc = Color::from_u32(sp);
-                                let dc = Color::from_u32(dst_row[i]);
-                                dst_row[i] = sc.blend_over(dc).to_u32();
-                            }
-                            i += 1;
-                        }
-                    }
+                    simd::blend_row(dst_row, src_row);
                 }
             }
         }
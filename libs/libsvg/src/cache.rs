@@ -0,0 +1,188 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Per-process document and bitmap caches.
+//!
+//! Apps re-render the same icons at the same sizes every time a view
+//! opens. Documents are identified by an FNV-1a hash of their bytes plus
+//! their length, so callers need not keep buffers alive or pass ids:
+//!
+//! - the parsed-document cache skips XML parsing for a known document;
+//! - the bitmap cache returns a finished rendering for a known
+//!   (document, width, height, background) without rasterizing at all.
+//!   Output sizes are physical pixels, so the HiDPI scale is part of them.
+//!
+//! Both caches are small LRU lists; only bitmaps up to
+//! [`MAX_BITMAP_PIXELS`] are kept, within a [`BITMAP_BUDGET`] total. The
+//! caches are guarded by a try-lock: a thread that finds them busy parses
+//! and renders uncached rather than waiting.
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, Ordering};
+
+use crate::parser;
+use crate::render;
+use crate::types::SvgDoc;
+
+/// Parsed documents kept at once.
+const MAX_DOCS: usize = 16;
+/// Largest rendering cached (256x256).
+const MAX_BITMAP_PIXELS: usize = 256 * 256;
+/// Pixels held by all cached renderings together (4 MiB).
+const BITMAP_BUDGET: usize = 1024 * 1024;
+
+/// Content key of an SVG document.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub struct DocKey {
+    hash: u64,
+    len: usize,
+}
+
+impl DocKey {
+    pub fn of(data: &[u8]) -> Self {
+        let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+        for &b in data {
+            hash ^= b as u64;
+            hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+        }
+        DocKey { hash, len: data.len() }
+    }
+}
+
+struct DocEntry {
+    key: DocKey,
+    doc: SvgDoc,
+    last_use: u64,
+}
+
+struct BitmapEntry {
+    key: DocKey,
+    w: u32,
+    h: u32,
+    bg: u32,
+    pixels: Vec<u32>,
+    last_use: u64,
+}
+
+struct Cache {
+    docs: Vec<DocEntry>,
+    bitmaps: Vec<BitmapEntry>,
+    bitmap_pixels: usize,
+    clock: u64,
+}
+
+static mut CACHE: Cache = Cache {
+    docs: Vec::new(),
+    bitmaps: Vec::new(),
+    bitmap_pixels: 0,
+    clock: 0,
+};
+
+static LOCKED: AtomicBool = AtomicBool::new(false);
+
+/// Run `f` on the cache, or return `None` if another thread holds it.
+fn with_cache<R>(f: impl FnOnce(&mut Cache) -> R) -> Option<R> {
+    if LOCKED.swap(true, Ordering::Acquire) {
+        return None;
+    }
+    let r = f(unsafe { &mut *core::ptr::addr_of_mut!(CACHE) });
+    LOCKED.store(false, Ordering::Release);
+    Some(r)
+}
+
+impl Cache {
+    fn tick(&mut self) -> u64 {
+        self.clock += 1;
+        self.clock
+    }
+
+    /// Index of the parsed document for `data`, parsing it on a miss.
+    fn doc_index(&mut self, key: DocKey, data: &[u8]) -> Option<usize> {
+        let now = self.tick();
+        if let Some(i) = self.docs.iter().position(|e| e.key == key) {
+            self.docs[i].last_use = now;
+            return Some(i);
+        }
+        let doc = parser::parse(data)?;
+        if self.docs.len() >= MAX_DOCS {
+            let oldest = lru_index(self.docs.iter().map(|e| e.last_use));
+            self.docs.swap_remove(oldest);
+        }
+        self.docs.push(DocEntry { key, doc, last_use: now });
+        Some(self.docs.len() - 1)
+    }
+
+    /// Copy a cached rendering into `out`; returns false on a miss.
+    fn lookup_bitmap(&mut self, key: DocKey, w: u32, h: u32, bg: u32, out: &mut [u32]) -> bool {
+        let now = self.tick();
+        let Some(e) = self.bitmaps.iter_mut()
+            .find(|e| e.key == key && e.w == w && e.h == h && e.bg == bg)
+        else {
+            return false;
+        };
+        e.last_use = now;
+        out[..e.pixels.len()].copy_from_slice(&e.pixels);
+        true
+    }
+
+    fn store_bitmap(&mut self, key: DocKey, w: u32, h: u32, bg: u32, pixels: &[u32]) {
+        let n = pixels.len();
+        if n > MAX_BITMAP_PIXELS {
+            return;
+        }
+        while self.bitmap_pixels + n > BITMAP_BUDGET && !self.bitmaps.is_empty() {
+            let oldest = lru_index(self.bitmaps.iter().map(|e| e.last_use));
+            self.bitmap_pixels -= self.bitmaps.swap_remove(oldest).pixels.len();
+        }
+        let now = self.tick();
+        self.bitmaps.push(BitmapEntry { key, w, h, bg, pixels: pixels.to_vec(), last_use: now });
+        self.bitmap_pixels += n;
+    }
+}
+
+fn lru_index(stamps: impl Iterator<Item = u64>) -> usize {
+    stamps.enumerate().min_by_key(|&(_, t)| t).map(|(i, _)| i).unwrap_or(0)
+}
+
+/// Declared `(width, height)` of a document, or `None` if it does not parse.
+pub fn probe(data: &[u8]) -> Option<(f32, f32)> {
+    let size = |doc: &SvgDoc| (doc.width, doc.height);
+    with_cache(|c| {
+        let i = c.doc_index(DocKey::of(data), data)?;
+        Some(size(&c.docs[i].doc))
+    })
+    .unwrap_or_else(|| parser::parse(data).as_ref().map(size))
+}
+
+/// Render `data` into `out` (`w * h` pixels) through both caches.
+/// Returns false if the document does not parse.
+pub fn render(data: &[u8], out: &mut [u32], w: u32, h: u32, bg: u32) -> bool {
+    let cached = with_cache(|c| {
+        let key = DocKey::of(data);
+        if c.lookup_bitmap(key, w, h, bg, out) {
+            return true;
+        }
+        let Some(i) = c.doc_index(key, data) else {
+            return false;
+        };
+        render::render(&c.docs[i].doc, out, w, h, bg);
+        c.store_bitmap(key, w, h, bg, &out[..(w as usize) * (h as usize)]);
+        true
+    });
+    cached.unwrap_or_else(|| match parser::parse(data) {
+        Some(doc) => {
+            render::render(&doc, out, w, h, bg);
+            true
+        }
+        None => false,
+    })
+}
+
+/// Drop every cached document and rendering.
+pub fn clear() {
+    with_cache(|c| {
+        c.docs = Vec::new();
+        c.bitmaps = Vec::new();
+        c.bitmap_pixels = 0;
+    });
+}
@@ -4,7 +4,10 @@
 //! Gradient colour computation.
 //!
 //! Evaluates linear and radial gradients at a given (x,y) position,
-//! returning ARGB8888.
+//! returning ARGB8888. The rasterizer resolves each paint once per shape
+//! into a [`Sampler`], which bakes the stops into a lookup table.
+
+use alloc::boxed::Box;
 
 use crate::types::{
     LinearGradient, RadialGradient, GradientUnits, Spread, GradientStop,
@@ -20,86 +23,195 @@ pub struct Bounds {
 
 // ── Linear gradient ──────────────────────────────────────────────────
 
-/// Evaluate a linear gradient at pixel position `(px, py)`.
-pub fn eval_linear(grad: &LinearGradient, px: f32, py: f32, bounds: Bounds) -> u32 {
-    let (x1, y1, x2, y2) = if grad.units == GradientUnits::ObjectBoundingBox {
-        (
-            bounds.x + grad.x1 * bounds.w,
-            bounds.y + grad.y1 * bounds.h,
-            bounds.x + grad.x2 * bounds.w,
-            bounds.y + grad.y2 * bounds.h,
-        )
-    } else {
-        let (gx1, gy1) = grad.xform.apply(grad.x1, grad.y1);
-        let (gx2, gy2) = grad.xform.apply(grad.x2, grad.y2);
-        (gx1, gy1, gx2, gy2)
-    };
+/// A linear gradient's axis resolved to pixel space for one shape.
+#[derive(Clone, Copy)]
+pub struct LinearGeom {
+    x1: f32, y1: f32,
+    /// Axis direction divided by its squared length, so `t` is a dot product.
+    gx: f32, gy: f32,
+}
 
-    let dx = x2 - x1;
-    let dy = y2 - y1;
-    let len2 = dx * dx + dy * dy;
-    let t = if len2 < 1e-10 {
-        0.0
-    } else {
-        ((px - x1) * dx + (py - y1) * dy) / len2
-    };
+impl LinearGeom {
+    pub fn new(grad: &LinearGradient, bounds: Bounds) -> Self {
+        let (x1, y1, x2, y2) = if grad.units == GradientUnits::ObjectBoundingBox {
+            (
+                bounds.x + grad.x1 * bounds.w,
+                bounds.y + grad.y1 * bounds.h,
+                bounds.x + grad.x2 * bounds.w,
+                bounds.y + grad.y2 * bounds.h,
+            )
+        } else {
+            let (gx1, gy1) = grad.xform.apply(grad.x1, grad.y1);
+            let (gx2, gy2) = grad.xform.apply(grad.x2, grad.y2);
+            (gx1, gy1, gx2, gy2)
+        };
+
+        let dx = x2 - x1;
+        let dy = y2 - y1;
+        let len2 = dx * dx + dy * dy;
+        if len2 < 1e-10 {
+            Self { x1, y1, gx: 0.0, gy: 0.0 }
+        } else {
+            Self { x1, y1, gx: dx / len2, gy: dy / len2 }
+        }
+    }
+
+    /// Unspread gradient parameter at `(px, py)`.
+    #[inline]
+    pub fn t(&self, px: f32, py: f32) -> f32 {
+        (px - self.x1) * self.gx + (py - self.y1) * self.gy
+    }
+}
 
+/// Evaluate a linear gradient at pixel position `(px, py)`.
+pub fn eval_linear(grad: &LinearGradient, px: f32, py: f32, bounds: Bounds) -> u32 {
+    let t = LinearGeom::new(grad, bounds).t(px, py);
     let t = apply_spread(t, grad.spread);
     interpolate_stops(&grad.stops, t)
 }
 
 // ── Radial gradient ──────────────────────────────────────────────────
 
+/// A radial gradient's circles resolved to pixel space for one shape.
+#[derive(Clone, Copy)]
+pub struct RadialGeom {
+    r: f32,
+    fx: f32, fy: f32,
+    /// Focal point offset from the centre (`F - C`).
+    dfx: f32, dfy: f32,
+    /// Focal point coincides with the centre.
+    centred: bool,
+}
+
+impl RadialGeom {
+    /// Resolve the geometry, or `None` for a degenerate (zero) radius.
+    pub fn new(grad: &RadialGradient, bounds: Bounds) -> Option<Self> {
+        let (cx, cy, r, fx, fy) = if grad.units == GradientUnits::ObjectBoundingBox {
+            (
+                bounds.x + grad.cx * bounds.w,
+                bounds.y + grad.cy * bounds.h,
+                (grad.r * (bounds.w + bounds.h) * 0.5),
+                bounds.x + grad.fx * bounds.w,
+                bounds.y + grad.fy * bounds.h,
+            )
+        } else {
+            let (gcx, gcy) = grad.xform.apply(grad.cx, grad.cy);
+            let (gfx, gfy) = grad.xform.apply(grad.fx, grad.fy);
+            // scale r by the transform scale
+            let sx = libm_sqrt(grad.xform.0[0]*grad.xform.0[0] + grad.xform.0[1]*grad.xform.0[1]);
+            (gcx, gcy, grad.r * sx, gfx, gfy)
+        };
+
+        if r < 1e-6 {
+            return None;
+        }
+        let dfx = fx - cx;
+        let dfy = fy - cy;
+        Some(Self { r, fx, fy, dfx, dfy, centred: (dfx * dfx + dfy * dfy) < 1e-6 })
+    }
+
+    /// Unspread gradient parameter at `(px, py)`.
+    #[inline]
+    pub fn t(&self, px: f32, py: f32) -> f32 {
+        let r = self.r;
+        let (dfx, dfy) = (self.dfx, self.dfy);
+        // Distance from focal point to pixel
+        let dx = px - self.fx;
+        let dy = py - self.fy;
+
+        // Solve: |P - F + t*(F - C)| = t*r  (SVG spec focal-point formula)
+        // Simplified when fx==cx, fy==cy: t = distance/r
+        if self.centred {
+            libm_sqrt(dx * dx + dy * dy) / r
+        } else {
+            // General focal-point case
+            let a = (dx - dfx) * (dx - dfx) + (dy - dfy) * (dy - dfy)
+                  - r * r * ((dfx * dfx + dfy * dfy) / (r * r));
+            let b2 = dx * (dx - dfx) + dy * (dy - dfy);
+            let disc = b2 * b2 - a * (dx * dx + dy * dy - r * r);
+            if disc < 0.0 { 1.0 }
+            else {
+                let sq = libm_sqrt(disc);
+                let t1 = (b2 + sq) / a;
+                let t2 = (b2 - sq) / a;
+                let t = if t1 > 0.0 { t1 } else { t2 };
+                if t < 0.0 { 0.0 } else { t }
+            }
+        }
+    }
+}
+
 /// Evaluate a radial gradient at pixel position `(px, py)`.
 pub fn eval_radial(grad: &RadialGradient, px: f32, py: f32, bounds: Bounds) -> u32 {
-    let (cx, cy, r, fx, fy) = if grad.units == GradientUnits::ObjectBoundingBox {
-        (
-            bounds.x + grad.cx * bounds.w,
-            bounds.y + grad.cy * bounds.h,
-            (grad.r * (bounds.w + bounds.h) * 0.5),
-            bounds.x + grad.fx * bounds.w,
-            bounds.y + grad.fy * bounds.h,
-        )
-    } else {
-        let (gcx, gcy) = grad.xform.apply(grad.cx, grad.cy);
-        let (gfx, gfy) = grad.xform.apply(grad.fx, grad.fy);
-        // scale r by the transform scale
-        let sx = libm_sqrt(grad.xform.0[0]*grad.xform.0[0] + grad.xform.0[1]*grad.xform.0[1]);
-        (gcx, gcy, grad.r * sx, gfx, gfy)
+    let Some(geom) = RadialGeom::new(grad, bounds) else {
+        return grad.stops.last().map(|s| s.1).unwrap_or(0);
     };
+    let t = apply_spread(geom.t(px, py), grad.spread);
+    interpolate_stops(&grad.stops, t)
+}
 
-    if r < 1e-6 {
-        return grad.stops.last().map(|s| s.1).unwrap_or(0);
+// ── Per-paint sampler ────────────────────────────────────────────────
+
+/// Entries in a gradient colour lookup table.
+const LUT_SIZE: usize = 256;
+
+/// A fill paint resolved once per shape: solid colours and gradients with
+/// their geometry in pixel space and their stops baked into a lookup table,
+/// with the shape's opacity already applied.
+pub enum Sampler {
+    Solid(u32),
+    Linear(LinearGeom, Spread, Box<[u32; LUT_SIZE]>),
+    Radial(RadialGeom, Spread, Box<[u32; LUT_SIZE]>),
+}
+
+impl Sampler {
+    pub fn linear(grad: &LinearGradient, bounds: Bounds, alpha: f32) -> Self {
+        Sampler::Linear(LinearGeom::new(grad, bounds), grad.spread, build_lut(&grad.stops, alpha))
     }
 
-    // Distance from focal point to pixel
-    let dx = px - fx;
-    let dy = py - fy;
-    let dfx = fx - cx;
-    let dfy = fy - cy;
-
-    // Solve: |P - F + t*(F - C)| = t*r  (SVG spec focal-point formula)
-    // Simplified when fx==cx, fy==cy: t = distance/r
-    let t = if (dfx * dfx + dfy * dfy) < 1e-6 {
-        libm_sqrt(dx * dx + dy * dy) / r
-    } else {
-        // General focal-point case
-        let a = (dx - dfx) * (dx - dfx) + (dy - dfy) * (dy - dfy)
-              - r * r * ((dfx * dfx + dfy * dfy) / (r * r));
-        let b2 = dx * (dx - dfx) + dy * (dy - dfy);
-        let disc = b2 * b2 - a * (dx * dx + dy * dy - r * r);
-        if disc < 0.0 { 1.0 }
-        else {
-            let sq = libm_sqrt(disc);
-            let t1 = (b2 + sq) / a;
-            let t2 = (b2 - sq) / a;
-            let t = if t1 > 0.0 { t1 } else { t2 };
-            if t < 0.0 { 0.0 } else { t }
+    pub fn radial(grad: &RadialGradient, bounds: Bounds, alpha: f32) -> Self {
+        match RadialGeom::new(grad, bounds) {
+            Some(geom) => Sampler::Radial(geom, grad.spread, build_lut(&grad.stops, alpha)),
+            None => {
+                let last = grad.stops.last().map(|s| s.1).unwrap_or(0);
+                Sampler::Solid(apply_alpha(last, alpha))
+            }
         }
-    };
+    }
 
-    let t = apply_spread(t, grad.spread);
-    interpolate_stops(&grad.stops, t)
+    /// Colour at pixel position `(px, py)`.
+    #[inline]
+    pub fn sample(&self, px: f32, py: f32) -> u32 {
+        match self {
+            Sampler::Solid(c) => *c,
+            Sampler::Linear(geom, spread, lut) => lut_lookup(lut, apply_spread(geom.t(px, py), *spread)),
+            Sampler::Radial(geom, spread, lut) => lut_lookup(lut, apply_spread(geom.t(px, py), *spread)),
+        }
+    }
+}
+
+/// Sample the stops at `LUT_SIZE` evenly spaced parameters.
+fn build_lut(stops: &[GradientStop], alpha: f32) -> Box<[u32; LUT_SIZE]> {
+    let mut lut = Box::new([0u32; LUT_SIZE]);
+    for (i, entry) in lut.iter_mut().enumerate() {
+        let t = i as f32 / (LUT_SIZE - 1) as f32;
+        *entry = apply_alpha(interpolate_stops(stops, t), alpha);
+    }
+    lut
+}
+
+#[inline]
+fn lut_lookup(lut: &[u32; LUT_SIZE], t: f32) -> u32 {
+    let i = (t * (LUT_SIZE - 1) as f32 + 0.5) as usize;
+    lut[i.min(LUT_SIZE - 1)]
+}
+
+/// Scale the alpha channel of an ARGB8888 colour by `factor` ∈ [0, 1].
+#[inline]
+pub fn apply_alpha(color: u32, factor: f32) -> u32 {
+    if factor >= 1.0 { return color; }
+    let a = ((color >> 24) as f32 * factor) as u32;
+    (a << 24) | (color & 0x00FFFFFF)
 }
 
 // ── Stop interpolation ───────────────────────────────────────────────
@@ -18,7 +18,8 @@
 //! - CSS: inline style="" attributes, most CSS colour formats
 //!
 //! Loaded via dl_open("/Libraries/libsvg.so"), symbols resolved via dl_sym.
-//! State is per-process via .bss statics; heap via SYS_SBRK.
+//! State is per-process via .bss statics; heap via SYS_SBRK. Parsed
+//! documents and small renderings are cached per process (see [`cache`]).
 
 #![no_std]
 #![no_main]
@@ -33,6 +34,7 @@ pub mod parser;
 pub mod path;
 pub mod gradient;
 pub mod render;
+pub mod cache;
 
 // ── Error codes ──────────────────────────────────────────────────────
 
@@ -60,10 +62,10 @@ pub extern "C" fn svg_probe(
     }
     let bytes = unsafe { core::slice::from_raw_parts(data, len as usize) };
 
-    match parser::parse(bytes) {
-        Some(doc) => {
-            unsafe { *out_w = doc.width; }
-            unsafe { *out_h = doc.height; }
+    match cache::probe(bytes) {
+        Some((w, h)) => {
+            unsafe { *out_w = w; }
+            unsafe { *out_h = h; }
             ERR_OK
         }
         None => ERR_UNSUPPORTED,
@@ -119,13 +121,51 @@ pub extern "C" fn svg_render_to_size(
     let out_count = (out_w as usize) * (out_h as usize);
     let out = unsafe { core::slice::from_raw_parts_mut(out_pixels, out_count) };
 
-    match parser::parse(bytes) {
-        Some(doc) => {
-            render::render(&doc, out, out_w, out_h, bg_color);
-            ERR_OK
+    if cache::render(bytes, out, out_w, out_h, bg_color) { ERR_OK } else { ERR_UNSUPPORTED }
+}
+
+/// One request of a [`svg_render_batch`] call.
+#[repr(C)]
+pub struct SvgRenderItem {
+    /// Raw SVG bytes.
+    pub data:       *const u8,
+    /// ARGB8888 output buffer (`out_w * out_h` u32s).
+    pub out_pixels: *mut u32,
+    pub len:        u32,
+    pub out_w:      u32,
+    pub out_h:      u32,
+    /// ARGB8888 background colour (0x00000000 = transparent).
+    pub bg_color:   u32,
+    /// Receives the [`svg_render_to_size`] result for this item.
+    pub status:     i32,
+}
+
+/// Render several SVG documents in one call.
+///
+/// Each item is rendered as by [`svg_render_to_size`] and its result
+/// stored in `status`. Items sharing a document are parsed once.
+///
+/// Returns the number of items rendered successfully.
+#[no_mangle]
+pub extern "C" fn svg_render_batch(items: *mut SvgRenderItem, count: u32) -> u32 {
+    if items.is_null() {
+        return 0;
+    }
+    let items = unsafe { core::slice::from_raw_parts_mut(items, count as usize) };
+    let mut ok = 0;
+    for it in items.iter_mut() {
+        it.status = svg_render_to_size(it.data, it.len, it.out_pixels, it.out_w, it.out_h, it.bg_color);
+        if it.status == ERR_OK {
+            ok += 1;
         }
-        None => ERR_UNSUPPORTED,
     }
+    ok
+}
+
+/// Drop all cached parsed documents and renderings of this process.
+#[no_mangle]
+pub extern "C" fn svg_cache_clear() {
+    cache::clear();
 }
 
 // ── Dummy entry point ────────────────────────────────────────────────
@@ -14,7 +14,7 @@ use alloc::string::String;
 
 use crate::types::{self, *};
 use crate::path;
-use crate::gradient::{self, Bounds};
+use crate::gradient::{Bounds, Sampler, apply_alpha};
 
 // ── Public API ───────────────────────────────────────────────────────
 
@@ -217,6 +217,7 @@ impl<'a> RenderCtx<'a> {
         let y_max = y_max.min(h - 1);
 
         let fill_rule = style.fill_rule;
+        let sampler = self.sampler(&style.fill, bounds, total_alpha);
 
         for y in y_min..=y_max {
             let mut crossings: Vec<f32> = Vec::new();
@@ -248,8 +249,7 @@ impl<'a> RenderCtx<'a> {
                         let x0 = (types::libm_ceil(crossings[i]) as i32).max(0);
                         let x1 = (types::libm_floor(crossings[i + 1]) as i32).min(w - 1);
                         if x0 <= x1 {
-                            self.fill_span(y as u32, x0 as u32, x1 as u32,
-                                           style, bounds, total_alpha);
+                            self.fill_span(y as u32, x0 as u32, x1 as u32, &sampler);
                         }
                         i += 2;
                     }
@@ -262,8 +262,7 @@ impl<'a> RenderCtx<'a> {
                         let x0 = x0.max(0);
                         let x1 = x1.min(w - 1);
                         if x0 <= x1 {
-                            self.fill_span(y as u32, x0 as u32, x1 as u32,
-                                           style, bounds, total_alpha);
+                            self.fill_span(y as u32, x0 as u32, x1 as u32, &sampler);
                         }
                         i += 2;
                     }
@@ -272,21 +271,28 @@ impl<'a> RenderCtx<'a> {
         }
     }
 
-    /// Fill a horizontal pixel span with the style's fill paint.
-    fn fill_span(
-        &mut self,
-        y: u32, x_start: u32, x_end: u32,
-        style: &Style, bounds: Bounds, alpha: f32,
-    ) {
+    /// Fill a horizontal pixel span with a resolved paint.
+    fn fill_span(&mut self, y: u32, x_start: u32, x_end: u32, sampler: &Sampler) {
         let row_off = (y * self.width) as usize;
-        for x in x_start..=x_end {
-            let px = x as f32 + 0.5;
-            let py = y as f32 + 0.5;
-            let color = self.resolve_paint(&style.fill, px, py, bounds);
-            let color = apply_alpha(color, alpha);
-            let idx = row_off + x as usize;
-            if idx < self.pixels.len() {
-                self.pixels[idx] = alpha_blend(self.pixels[idx], color);
+        let Some(span) = self.pixels.get_mut(row_off + x_start as usize..=row_off + x_end as usize) else {
+            return;
+        };
+        match sampler {
+            Sampler::Solid(color) => {
+                if color >> 24 == 255 {
+                    span.fill(*color);
+                } else {
+                    for px in span.iter_mut() {
+                        *px = alpha_blend(*px, *color);
+                    }
+                }
+            }
+            _ => {
+                let py = y as f32 + 0.5;
+                for (i, px) in span.iter_mut().enumerate() {
+                    let color = sampler.sample((x_start as usize + i) as f32 + 0.5, py);
+                    *px = alpha_blend(*px, color);
+                }
             }
         }
     }
@@ -335,15 +341,16 @@ impl<'a> RenderCtx<'a> {
 
     // ── Paint resolution ─────────────────────────────────────────────
 
-    fn resolve_paint(&self, paint: &Paint, x: f32, y: f32, bounds: Bounds) -> u32 {
+    /// Resolve `paint` for one shape, folding in `alpha`.
+    fn sampler(&self, paint: &Paint, bounds: Bounds, alpha: f32) -> Sampler {
         match paint {
-            Paint::None => 0,
-            Paint::Color(c) => *c,
+            Paint::None => Sampler::Solid(0),
+            Paint::Color(c) => Sampler::Solid(apply_alpha(*c, alpha)),
             Paint::Url(id) => {
                 match self.defs.get(id.as_str()) {
-                    Some(Def::LinearGradient(g)) => gradient::eval_linear(g, x, y, bounds),
-                    Some(Def::RadialGradient(g)) => gradient::eval_radial(g, x, y, bounds),
-                    None => 0xFF808080,
+                    Some(Def::LinearGradient(g)) => Sampler::linear(g, bounds, alpha),
+                    Some(Def::RadialGradient(g)) => Sampler::radial(g, bounds, alpha),
+                    None => Sampler::Solid(apply_alpha(0xFF808080, alpha)),
                 }
             }
         }
@@ -490,11 +497,3 @@ fn alpha_blend(dst: u32, src: u32) -> u32 {
       | (blend_ch( 8,  8) <<  8)
       |  blend_ch( 0,  0)
 }
-
-/// Scale the alpha channel of an ARGB8888 colour by `factor` ∈ [0, 1].
-#[inline]
-fn apply_alpha(color: u32, factor: f32) -> u32 {
-    if factor >= 1.0 { return color; }
-    let a = ((color >> 24) as f32 * factor) as u32;
-    (a << 24) | (color & 0x00FFFFFF)
-}
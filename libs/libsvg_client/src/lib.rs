@@ -25,6 +25,7 @@
 
 extern crate alloc;
 
+use alloc::vec::Vec;
 use dynlink::{DlHandle, dl_open, dl_sym};
 
 // ── Function pointer table ────────────────────────────────────────────
@@ -37,6 +38,22 @@ struct SvgLib {
     render_fn:        extern "C" fn(*const u8, u32, *mut u32, u32, u32) -> i32,
     /// `svg_render_to_size(data, len, out_pixels, out_w, out_h, bg_color) -> i32`
     render_bg_fn:     extern "C" fn(*const u8, u32, *mut u32, u32, u32, u32) -> i32,
+    /// `svg_render_batch(items, count) -> u32`
+    render_batch_fn:  extern "C" fn(*mut RawItem, u32) -> u32,
+    /// `svg_cache_clear()`
+    cache_clear_fn:   extern "C" fn(),
+}
+
+/// Mirror of libsvg's `SvgRenderItem`.
+#[repr(C)]
+struct RawItem {
+    data:       *const u8,
+    out_pixels: *mut u32,
+    len:        u32,
+    out_w:      u32,
+    out_h:      u32,
+    bg_color:   u32,
+    status:     i32,
 }
 
 static mut LIB: Option<SvgLib> = None;
@@ -69,6 +86,8 @@ pub fn init() -> bool {
             probe_fn:     resolve(&handle, "svg_probe"),
             render_fn:    resolve(&handle, "svg_render"),
             render_bg_fn: resolve(&handle, "svg_render_to_size"),
+            render_batch_fn: resolve(&handle, "svg_render_batch"),
+            cache_clear_fn:  resolve(&handle, "svg_cache_clear"),
             _handle:      handle,
         };
         LIB = Some(lib);
@@ -137,3 +156,48 @@ pub fn render_to_size(
     );
     rc == 0
 }
+
+/// One icon of a [`render_batch`] call.
+pub struct BatchItem<'a> {
+    /// Raw SVG bytes.
+    pub data: &'a [u8],
+    /// Output buffer — must contain `width * height` `u32` slots.
+    pub pixels: &'a mut [u32],
+    pub width: u32,
+    pub height: u32,
+    /// ARGB8888 background colour (`0x00000000` = transparent).
+    pub bg_color: u32,
+    /// Set to `true` if this item rendered successfully.
+    pub ok: bool,
+}
+
+/// Render many SVG documents (e.g. a view's icons) in one library call.
+///
+/// Documents and renderings are cached inside libsvg, so icons that repeat
+/// across items or across calls are parsed and rasterized once.
+///
+/// Returns the number of items rendered successfully.
+pub fn render_batch(items: &mut [BatchItem]) -> usize {
+    let mut raw: Vec<RawItem> = items.iter_mut().map(|it| {
+        let fits = it.pixels.len() >= (it.width as usize) * (it.height as usize);
+        RawItem {
+            data: it.data.as_ptr(),
+            out_pixels: if fits { it.pixels.as_mut_ptr() } else { core::ptr::null_mut() },
+            len: it.data.len() as u32,
+            out_w: it.width,
+            out_h: it.height,
+            bg_color: it.bg_color,
+            status: -1,
+        }
+    }).collect();
+    let n = (lib().render_batch_fn)(raw.as_mut_ptr(), raw.len() as u32);
+    for (it, r) in items.iter_mut().zip(&raw) {
+        it.ok = r.status == 0;
+    }
+    n as usize
+}
+
+/// Drop libsvg's cached documents and renderings for this process.
+pub fn cache_clear() {
+    (lib().cache_clear_fn)();
+}
@@ -31,14 +31,23 @@ pub const SYS_SLEEP: u32 = 8;
 pub const SYS_SBRK: u32 = 9;
 pub const SYS_MMAP: u32 = 14;
 pub const SYS_MUNMAP: u32 = 15;
+pub const SYS_MMAP_FILE: u32 = 36;
+
+// Threads
+pub const SYS_THREAD_CREATE: u32 = 170;
+pub const SYS_FUTEX_WAIT: u32 = 173;
+pub const SYS_FUTEX_WAKE: u32 = 174;
 
 // Filesystem
 pub const SYS_READDIR: u32 = 23;
 pub const SYS_STAT: u32 = 24;
 pub const SYS_GETCWD: u32 = 25;
 pub const SYS_MKDIR: u32 = 90;
+pub const SYS_UNLINK: u32 = 91;
 pub const SYS_LSEEK: u32 = 105;
 pub const SYS_FSTAT: u32 = 106;
+pub const SYS_FSYNC: u32 = 109;
+pub const SYS_FLOCK: u32 = 113;
 
 // DLL
 pub const SYS_DLL_LOAD: u32 = 80;
@@ -61,12 +70,16 @@ pub const SYS_GPU_3D_SUBMIT: u32 = 512;
 pub const SYS_GPU_3D_SYNC: u32 = 514;
 pub const SYS_GPU_3D_SURFACE_DMA: u32 = 515;
 pub const SYS_GPU_3D_SURFACE_DMA_READ: u32 = 516;
+pub const SYS_GPU_3D_GMR_CREATE: u32 = 517;
+pub const SYS_GPU_3D_GMR_RELEASE: u32 = 518;
 
 // Shared memory
 pub const SYS_SHM_CREATE: u32 = 140;
 pub const SYS_SHM_MAP: u32 = 141;
 pub const SYS_SHM_UNMAP: u32 = 142;
 pub const SYS_SHM_DESTROY: u32 = 143;
+pub const SYS_SHM_GRANT: u32 = 74;
+pub const SYS_SHM_CLAIM: u32 = 75;
 
 // Event channels
 pub const SYS_EVT_CHAN_CREATE: u32 = 63;
@@ -75,8 +88,12 @@ pub const SYS_EVT_CHAN_EMIT: u32 = 65;
 pub const SYS_EVT_CHAN_POLL: u32 = 66;
 pub const SYS_EVT_CHAN_EMIT_TO: u32 = 69;
 pub const SYS_EVT_CHAN_WAIT: u32 = 70;
+pub const SYS_EVT_CHAN_POLL_BATCH: u32 = 71;
+pub const SYS_EVT_CHAN_RING: u32 = 73;
 
 // System info
+pub const SYS_TIME: u32 = 30;
+pub const SYS_SYSINFO: u32 = 32;
 pub const SYS_UPTIME_MS: u32 = 35;
 
 // Random
@@ -330,6 +347,14 @@ pub fn munmap(addr: u64, size: u32) -> u64 {
     syscall2(SYS_MUNMAP, addr, size as u64)
 }
 
+/// Map `len` bytes of file `fd` from page-aligned `offset`, demand-paged.
+/// `prot`: 2 = write, 4 = exec; `flags`: 1 = MAP_SHARED, 2 = MAP_PRIVATE.
+/// Returns address or `u64::MAX` on failure.
+pub fn mmap_file(fd: u32, offset: u32, len: u32, prot: u32, flags: u32) -> u64 {
+    let ret = syscall5(SYS_MMAP_FILE, fd as u64, offset as u64, len as u64, prot as u64, flags as u64);
+    if ret == u32::MAX as u64 { u64::MAX } else { ret }
+}
+
 /// Write bytes to a file descriptor. Returns bytes written, or `u32::MAX` on error.
 pub fn write(fd: u32, buf: &[u8]) -> u32 {
     let ret = syscall3(SYS_WRITE, fd as u64, buf.as_ptr() as u64, buf.len() as u64);
@@ -373,6 +398,23 @@ pub fn lseek(fd: u32, offset: i32, whence: u32) -> u32 {
     if (ret as i64) < 0 { u32::MAX } else { ret as u32 }
 }
 
+/// Flush a file's written data to its device. Returns 0 on success.
+pub fn fsync(fd: u32) -> u32 {
+    syscall1(SYS_FSYNC, fd as u64) as u32
+}
+
+/// `flock` operations: shared, exclusive, non-blocking modifier, unlock.
+pub const LOCK_SH: u32 = 1;
+pub const LOCK_EX: u32 = 2;
+pub const LOCK_NB: u32 = 4;
+pub const LOCK_UN: u32 = 8;
+
+/// Take or release an advisory lock on an open file. Returns 0 on success,
+/// `u32::MAX - 10` (EAGAIN) if `LOCK_NB` was given and the file is locked.
+pub fn flock(fd: u32, op: u32) -> u32 {
+    syscall2(SYS_FLOCK, fd as u64, op as u64) as u32
+}
+
 /// Get file size via fstat. Returns file size or 0 on error.
 pub fn file_size(fd: u32) -> u32 {
     let mut stat_buf = [0u32; 4];
@@ -396,16 +438,104 @@ pub fn yield_cpu() {
     syscall0(SYS_YIELD);
 }
 
+/// Create a thread in the current process (shared address space).
+///
+/// `stack_top` is the top of a caller-allocated stack, already lowered by 8
+/// for x86_64 ABI alignment.  Returns the TID, or 0 on error.
+pub fn thread_create(entry: fn(), stack_top: usize, name: &str) -> u32 {
+    syscall5(
+        SYS_THREAD_CREATE,
+        entry as u64,
+        stack_top as u64,
+        name.as_ptr() as u64,
+        name.len() as u64,
+        0,
+    ) as u32
+}
+
+/// Timeout value for [`futex_wait`] meaning "wait forever".
+pub const FUTEX_FOREVER: u32 = u32::MAX;
+
+/// Sleep while `word` holds `expected`, for at most `timeout_ms`.
+/// Wake-ups may be spurious: always re-check the condition.
+pub fn futex_wait(word: &core::sync::atomic::AtomicU32, expected: u32, timeout_ms: u32) -> u32 {
+    syscall3(SYS_FUTEX_WAIT, word.as_ptr() as u64, expected as u64, timeout_ms as u64) as u32
+}
+
+/// Wake up to `count` threads sleeping on `word`. Returns the number woken.
+pub fn futex_wake(word: &core::sync::atomic::AtomicU32, count: u32) -> u32 {
+    syscall2(SYS_FUTEX_WAKE, word.as_ptr() as u64, count as u64) as u32
+}
+
+/// Number of online CPUs (sysinfo cmd 2).
+pub fn cpu_count() -> u32 {
+    let mut buf = [0u8; 4];
+    syscall3(SYS_SYSINFO, 2, buf.as_mut_ptr() as u64, buf.len() as u64) as u32
+}
+
 /// Get the current thread ID.
 pub fn get_tid() -> u32 {
     syscall0(SYS_GETPID) as u32
 }
 
-/// Get uptime in milliseconds.
+/// User address of the kernel's shared time page (layout in
+/// kernel/src/task/timepage.rs: seq, version, tsc_hz, tsc_boot, ...).
+#[cfg(target_arch = "x86_64")]
+const TIME_PAGE_ADDR: usize = 0x07FF_F000;
+
+/// Milliseconds since boot from the shared time page, without a syscall.
+/// Returns `None` if the TSC is not the kernel's timebase.
+#[cfg(target_arch = "x86_64")]
+fn time_page_ms() -> Option<u64> {
+    use core::sync::atomic::{compiler_fence, Ordering};
+    let page = TIME_PAGE_ADDR as *const u32;
+    loop {
+        unsafe {
+            let seq = core::ptr::read_volatile(page);
+            if seq & 1 != 0 {
+                core::hint::spin_loop();
+                continue;
+            }
+            compiler_fence(Ordering::Acquire);
+            let version = core::ptr::read_volatile(page.add(1));
+            let tsc_hz = core::ptr::read_volatile((page as *const u64).add(1));
+            let tsc_boot = core::ptr::read_volatile((page as *const u64).add(2));
+            let lo: u32;
+            let hi: u32;
+            asm!("rdtsc", out("eax") lo, out("edx") hi, options(nomem, nostack));
+            compiler_fence(Ordering::Acquire);
+            if core::ptr::read_volatile(page) != seq {
+                continue;
+            }
+            if version != 1 || tsc_hz == 0 {
+                return None;
+            }
+            let elapsed = ((hi as u64) << 32 | lo as u64).wrapping_sub(tsc_boot);
+            return Some(elapsed / tsc_hz * 1000 + elapsed % tsc_hz * 1000 / tsc_hz);
+        }
+    }
+}
+
+/// Get uptime in milliseconds (read from the shared time page when possible).
 pub fn uptime_ms() -> u32 {
+    #[cfg(target_arch = "x86_64")]
+    if let Some(ms) = time_page_ms() {
+        return ms as u32;
+    }
     syscall0(SYS_UPTIME_MS) as u32
 }
 
+/// Read the RTC wall clock into `buf`:
+/// `[year_lo, year_hi, month, day, hour, min, sec, 0]`.
+pub fn time(buf: &mut [u8; 8]) -> u32 {
+    syscall1(SYS_TIME, buf.as_mut_ptr() as u64) as u32
+}
+
+/// Milliseconds since the calling thread was spawned or exec'd (sysinfo cmd 7).
+pub fn ms_since_spawn() -> u32 {
+    syscall3(SYS_SYSINFO, 7, 0, 0) as u32
+}
+
 /// Write to stdout (fd=1) for debug logging.
 pub fn log(msg: &[u8]) {
     write(1, msg);
@@ -441,6 +571,16 @@ pub fn mkdir_bytes(path: &[u8]) -> u32 {
     if (ret as i64) < 0 { u32::MAX } else { ret as u32 }
 }
 
+/// Delete a file. Returns 0 on success, `u32::MAX` on error.
+pub fn unlink(path: &str) -> u32 {
+    let mut buf = [0u8; 257];
+    let len = path.len().min(256);
+    buf[..len].copy_from_slice(&path.as_bytes()[..len]);
+    buf[len] = 0;
+    let ret = syscall1(SYS_UNLINK, buf.as_ptr() as u64);
+    if (ret as i64) < 0 { u32::MAX } else { ret as u32 }
+}
+
 /// Get current working directory. Returns length or `u32::MAX` on error.
 pub fn getcwd(buf: &mut [u8]) -> u32 {
     syscall2(SYS_GETCWD, buf.as_mut_ptr() as u64, buf.len() as u64) as u32
@@ -498,6 +638,16 @@ pub fn shm_destroy(shm_id: u32) -> u32 {
     syscall1(SYS_SHM_DESTROY, shm_id as u64) as u32
 }
 
+/// Hand an owned region to the next process that claims it; unmaps it here.
+pub fn shm_grant(shm_id: u32) -> u32 {
+    syscall1(SYS_SHM_GRANT, shm_id as u64) as u32
+}
+
+/// Take ownership of a granted region and map it. Returns address or 0.
+pub fn shm_claim(shm_id: u32) -> u64 {
+    syscall1(SYS_SHM_CLAIM, shm_id as u64)
+}
+
 // ── Event Channels ───────────────────────────────────────────────────
 
 pub fn evt_chan_create(name_ptr: *const u8, name_len: u32) -> u32 {
@@ -524,6 +674,47 @@ pub fn evt_chan_wait(channel_id: u32, sub_id: u32, timeout_ms: u32) -> u32 {
     syscall3(SYS_EVT_CHAN_WAIT, channel_id as u64, sub_id as u64, timeout_ms as u64) as u32
 }
 
+/// Drain up to `buf.len()` (at most 64) events in one syscall. Returns the count.
+pub fn evt_chan_poll_batch(channel_id: u32, sub_id: u32, buf: &mut [[u32; 5]]) -> u32 {
+    syscall4(SYS_EVT_CHAN_POLL_BATCH, channel_id as u64, sub_id as u64,
+        buf.as_mut_ptr() as u64, buf.len() as u64) as u32
+}
+
+/// Map the subscription's shared event ring. Returns its address, or 0.
+pub fn evt_chan_ring(channel_id: u32, sub_id: u32) -> usize {
+    syscall2(SYS_EVT_CHAN_RING, channel_id as u64, sub_id as u64) as u32 as usize
+}
+
+/// Pop the next event from a ring returned by [`evt_chan_ring`] without a
+/// syscall. Returns `false` when the ring is empty.
+pub fn evt_ring_pop(ring: usize, buf: &mut [u32; 5]) -> bool {
+    use core::sync::atomic::{AtomicU32, Ordering};
+    let hdr = ring as *const AtomicU32;
+    unsafe {
+        let head = (*hdr).load(Ordering::Relaxed);
+        if head == (*hdr.add(1)).load(Ordering::Acquire) {
+            return false;
+        }
+        let capacity = (*hdr.add(2)).load(Ordering::Relaxed);
+        if capacity == 0 {
+            return false;
+        }
+        let ev = (ring + 64 + (head % capacity) as usize * 20) as *const u32;
+        for (i, w) in buf.iter_mut().enumerate() {
+            *w = core::ptr::read_volatile(ev.add(i));
+        }
+        (*hdr).store(head.wrapping_add(1), Ordering::Release);
+    }
+    true
+}
+
+/// Events that did not fit in the ring and wait in the kernel queue;
+/// fetch them with [`evt_chan_poll_batch`].
+pub fn evt_ring_spilled(ring: usize) -> u32 {
+    use core::sync::atomic::{AtomicU32, Ordering};
+    unsafe { (*(ring as *const AtomicU32).add(3)).load(Ordering::Acquire) }
+}
+
 // ── Networking ───────────────────────────────────────────────────────
 
 /// Resolve a hostname to an IPv4 address. Returns 0 on success.
@@ -631,6 +822,20 @@ pub fn gpu_3d_surface_dma_read(sid: u32, buf: &mut [u8], width: u32, height: u32
     ) as u32
 }
 
+/// Create a persistent guest memory region of `size` bytes for 3D uploads.
+/// Returns `(gmr_id, mapped address)`; `SURFACE_DMA` commands name the
+/// region by `gmr_id` and byte offset.
+pub fn gpu_3d_gmr_create(size: u32) -> Option<(u32, *mut u8)> {
+    let mut addr: u32 = 0;
+    let id = syscall2(SYS_GPU_3D_GMR_CREATE, size as u64, &mut addr as *mut u32 as u64) as u32;
+    if id == u32::MAX || addr == 0 { None } else { Some((id, addr as usize as *mut u8)) }
+}
+
+/// Release a region from [`gpu_3d_gmr_create`] (waits for queued commands).
+pub fn gpu_3d_gmr_release(gmr_id: u32) {
+    syscall1(SYS_GPU_3D_GMR_RELEASE, gmr_id as u64);
+}
+
 // ── Serial print (for DLLs without anyos_std) ────────────────────────
 
 /// Write bytes to stdout (fd=1).
@@ -0,0 +1,455 @@
+//! Display list — the paint commands of a layout tree.
+//!
+//! `DisplayList::build` walks the `LayoutBox` tree once per layout and
+//! records every fill, text run and image as a `DisplayItem` in absolute
+//! document coordinates, in paint order.  Items are indexed by tile row, so
+//! rasterizing a tile only touches the items that overlap it instead of
+//! re-walking the whole tree.
+//!
+//! `position: fixed` and animated boxes (CSS animations) are recorded into
+//! separate [`Layer`]s.  The renderer gives each layer its
+//! own canvas so the compositor can move it without repainting the
+//! content underneath.
+//!
+//! Every item carries a hash of its geometry and content.  Comparing the
+//! lists of two consecutive layouts tells the renderer which parts of its
+//! cached tiles are stale (`row_damage`), and only the items intersecting
+//! those rects are repainted.
+
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::dom::NodeId;
+use crate::layout::{FormFieldKind, LayoutBox};
+use crate::renderer::{blit_image_buf, fill_rect_buf, ImageCache};
+use crate::style::TextDeco;
+
+/// Layers larger than this (in pixels) are painted into the tiles instead.
+const MAX_LAYER_PIXELS: i64 = 2 * 1024 * 1024;
+
+/// An axis-aligned rectangle in document (or layer) coordinates.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub(crate) struct Rect {
+    pub x: i32,
+    pub y: i32,
+    pub w: i32,
+    pub h: i32,
+}
+
+impl Rect {
+    pub fn is_empty(&self) -> bool {
+        self.w <= 0 || self.h <= 0
+    }
+
+    pub fn intersects(&self, o: &Rect) -> bool {
+        self.x < o.x + o.w && o.x < self.x + self.w && self.y < o.y + o.h && o.y < self.y + self.h
+    }
+
+    pub fn union(&self, o: &Rect) -> Rect {
+        if self.is_empty() {
+            return *o;
+        }
+        if o.is_empty() {
+            return *self;
+        }
+        let x = self.x.min(o.x);
+        let y = self.y.min(o.y);
+        let x1 = (self.x + self.w).max(o.x + o.w);
+        let y1 = (self.y + self.h).max(o.y + o.h);
+        Rect { x, y, w: x1 - x, h: y1 - y }
+    }
+
+    pub fn intersect(&self, o: &Rect) -> Rect {
+        let x = self.x.max(o.x);
+        let y = self.y.max(o.y);
+        let x1 = (self.x + self.w).min(o.x + o.w);
+        let y1 = (self.y + self.h).min(o.y + o.h);
+        Rect { x, y, w: (x1 - x).max(0), h: (y1 - y).max(0) }
+    }
+}
+
+pub(crate) const EMPTY: Rect = Rect { x: 0, y: 0, w: 0, h: 0 };
+
+pub(crate) enum PaintOp {
+    /// Fill `bounds` with an ARGB color (alpha-blended).
+    Fill(u32),
+    /// Draw a text run with its top-left corner at the bounds origin.
+    Text { text: String, color: u32, font_id: u32, font_size: u16 },
+    /// Blit an image from the `ImageCache`, scaled to the bounds.
+    Image(String),
+}
+
+pub(crate) struct DisplayItem {
+    pub bounds: Rect,
+    pub op: PaintOp,
+    /// Hash of `bounds` and `op` (and the image's cache state).
+    pub hash: u64,
+}
+
+/// Content painted into its own canvas.
+pub(crate) struct Layer {
+    /// DOM node of the promoted box.
+    pub node_id: Option<NodeId>,
+    /// `position: fixed` — `bounds` are viewport-relative.
+    pub fixed: bool,
+    /// Extent of the layer's items, in document (or viewport) coordinates.
+    pub bounds: Rect,
+    /// Items relative to the layer origin.
+    pub items: Vec<DisplayItem>,
+    /// Hash of all items; equal hashes mean identical pixels.
+    pub hash: u64,
+}
+
+pub(crate) struct DisplayList {
+    items: Vec<DisplayItem>,
+    /// Item indices per tile row, in paint order.
+    rows: Vec<Vec<u32>>,
+    row_height: i32,
+    pub layers: Vec<Layer>,
+}
+
+impl DisplayList {
+    pub fn new() -> Self {
+        Self { items: Vec::new(), rows: Vec::new(), row_height: 1, layers: Vec::new() }
+    }
+
+    /// Record the paint commands of `root`, indexed by rows of `row_height`.
+    pub fn build(root: &LayoutBox, images: &ImageCache, row_height: u32) -> Self {
+        let mut rec = Recorder { images, items: Vec::new(), layers: Vec::new() };
+        rec.walk(root, 0, 0, false);
+
+        let row_height = row_height.max(1) as i32;
+        let mut rows: Vec<Vec<u32>> = Vec::new();
+        for (i, item) in rec.items.iter().enumerate() {
+            let b = item.bounds;
+            if b.is_empty() || b.y + b.h <= 0 {
+                continue;
+            }
+            let first = (b.y.max(0) / row_height) as usize;
+            let last = ((b.y + b.h - 1) / row_height) as usize;
+            if rows.len() <= last {
+                rows.resize_with(last + 1, Vec::new);
+            }
+            for row in &mut rows[first..=last] {
+                row.push(i as u32);
+            }
+        }
+
+        Self { items: rec.items, rows, row_height, layers: rec.layers }
+    }
+
+    /// Items overlapping tile row `row`, in paint order.
+    pub fn row(&self, row: u32) -> impl Iterator<Item = &DisplayItem> {
+        self.rows.get(row as usize).map(|r| r.as_slice()).unwrap_or(&[])
+            .iter()
+            .map(move |&i| &self.items[i as usize])
+    }
+
+    /// The part of tile row `row` whose pixels differ between `old` and
+    /// `self`: the union of the items present on only one side (or of all
+    /// the row's items if the same items were merely reordered), clipped to
+    /// the row band of `width`.  `None` when the row paints identically.
+    pub fn row_damage(&self, old: &DisplayList, row: u32, width: i32) -> Option<Rect> {
+        let a: Vec<&DisplayItem> = old.row(row).collect();
+        let b: Vec<&DisplayItem> = self.row(row).collect();
+        if a.len() == b.len() && a.iter().zip(b.iter()).all(|(x, y)| x.hash == y.hash) {
+            return None;
+        }
+
+        let mut ha: Vec<u64> = a.iter().map(|i| i.hash).collect();
+        let mut hb: Vec<u64> = b.iter().map(|i| i.hash).collect();
+        ha.sort_unstable();
+        hb.sort_unstable();
+        let mut damage = EMPTY;
+        for item in &a {
+            if hb.binary_search(&item.hash).is_err() {
+                damage = damage.union(&item.bounds);
+            }
+        }
+        for item in &b {
+            if ha.binary_search(&item.hash).is_err() {
+                damage = damage.union(&item.bounds);
+            }
+        }
+        if damage.is_empty() {
+            for item in a.iter().chain(b.iter()) {
+                damage = damage.union(&item.bounds);
+            }
+        }
+
+        let band = Rect { x: 0, y: row as i32 * self.row_height, w: width, h: self.row_height };
+        let damage = damage.intersect(&band);
+        if damage.is_empty() { None } else { Some(damage) }
+    }
+}
+
+/// Paint `items` into `buf` (`stride × buf_h`), shifted by (`dx`, `dy`);
+/// only items intersecting `clip` (in item coordinates) are drawn.
+pub(crate) fn paint<'a>(
+    items: impl Iterator<Item = &'a DisplayItem>,
+    images: &ImageCache,
+    buf: *mut u32,
+    stride: u32,
+    buf_h: u32,
+    dx: i32,
+    dy: i32,
+    clip: &Rect,
+) {
+    for item in items {
+        if !item.bounds.intersects(clip) {
+            continue;
+        }
+        let b = item.bounds;
+        match &item.op {
+            PaintOp::Fill(color) => {
+                fill_rect_buf(buf, stride, buf_h, b.x + dx, b.y + dy, b.w, b.h, *color);
+            }
+            PaintOp::Text { text, color, font_id, font_size } => {
+                libfont_client::draw_string_buf(
+                    buf, stride, buf_h,
+                    b.x + dx, b.y + dy,
+                    *color, *font_id, *font_size,
+                    text,
+                );
+            }
+            PaintOp::Image(src) => {
+                if let Some(entry) = images.get_ref(src) {
+                    blit_image_buf(
+                        buf, stride, buf_h,
+                        b.x + dx, b.y + dy, b.w, b.h,
+                        &entry.pixels, entry.pixel_width, entry.pixel_height,
+                    );
+                }
+            }
+        }
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Recording
+// ═══════════════════════════════════════════════════════════════════════════
+
+struct Recorder<'a> {
+    images: &'a ImageCache,
+    items: Vec<DisplayItem>,
+    layers: Vec<Layer>,
+}
+
+impl<'a> Recorder<'a> {
+    /// Mirrors the paint order of a box: background, border, rule, list
+    /// marker, text and its decorations, image, button face, children.
+    fn walk(&mut self, bx: &LayoutBox, offset_x: i32, offset_y: i32, in_layer: bool) {
+        if bx.visibility_hidden {
+            return;
+        }
+
+        let abs_x = if bx.is_fixed { bx.x } else { offset_x + bx.x };
+        let abs_y = if bx.is_fixed { bx.y } else { offset_y + bx.y };
+
+        if !in_layer && (bx.is_fixed || bx.animated) {
+            let start = self.items.len();
+            self.walk(bx, offset_x, offset_y, true);
+            self.promote(bx, start);
+            return;
+        }
+
+        // Background.
+        if bx.bg_color != 0 {
+            self.fill(abs_x, abs_y, bx.width, bx.height, bx.bg_color);
+        }
+
+        // Border (4 edges).
+        if bx.border_width > 0 && bx.border_color != 0 {
+            let bw = bx.border_width;
+            let w = bx.width;
+            let h = bx.height;
+            let inner_h = (h - bw * 2).max(0);
+            self.fill(abs_x, abs_y, w, bw, bx.border_color);
+            self.fill(abs_x, abs_y + h - bw, w, bw, bx.border_color);
+            self.fill(abs_x, abs_y + bw, bw, inner_h, bx.border_color);
+            self.fill(abs_x + w - bw, abs_y + bw, bw, inner_h, bx.border_color);
+        }
+
+        // Horizontal rule.
+        if bx.is_hr {
+            self.fill(abs_x, abs_y, bx.width, 1, 0xFF999999);
+        }
+
+        // List marker.
+        if let Some(ref marker) = bx.list_marker {
+            let color = if bx.color != 0 { bx.color } else { 0xFF000000 };
+            self.text(abs_x - 20, abs_y, None, marker, color, 0, bx.font_size.max(1) as u16);
+        }
+
+        // Text fragment.
+        if let Some(ref text) = bx.text {
+            if !text.is_empty() && bx.form_field.is_none() {
+                let font_id = if bx.bold { 1u32 } else if bx.italic { 3u32 } else { 0u32 };
+                let color = if bx.color != 0 { bx.color } else { 0xFF000000 };
+                let font_size = bx.font_size.max(1) as u16;
+                self.text(abs_x, abs_y, Some((bx.width, bx.height)), text, color, font_id, font_size);
+
+                // Underline for links or text-decoration.
+                if bx.text_decoration == TextDeco::Underline || bx.link_url.is_some() {
+                    self.fill(abs_x, abs_y + bx.height - 1, bx.width, 1, color);
+                }
+
+                // Line-through.
+                if bx.text_decoration == TextDeco::LineThrough {
+                    self.fill(abs_x, abs_y + bx.height / 2, bx.width, 1, color);
+                }
+            }
+        }
+
+        // Image.
+        if let Some(ref src) = bx.image_src {
+            let dw = bx.image_width.unwrap_or(bx.width);
+            let dh = bx.image_height.unwrap_or(bx.height);
+            let bounds = Rect { x: abs_x, y: abs_y, w: dw, h: dh };
+            if !bounds.is_empty() {
+                let mut h = hash_rect(3, &bounds);
+                h = fnv(h, src.as_bytes());
+                // Repaint once the image arrives (or is replaced).
+                if let Some(entry) = self.images.get_ref(src) {
+                    h = fnv(h, &entry.pixel_width.to_le_bytes());
+                    h = fnv(h, &entry.pixel_height.to_le_bytes());
+                    h = fnv(h, &(entry.pixels.as_ptr() as usize).to_le_bytes());
+                }
+                self.items.push(DisplayItem { bounds, op: PaintOp::Image(src.clone()), hash: h });
+            }
+        }
+
+        // Submit/button face.
+        if let Some(kind) = bx.form_field {
+            if matches!(kind, FormFieldKind::Submit | FormFieldKind::ButtonEl) {
+                self.button(bx, abs_x, abs_y);
+            }
+        }
+
+        // Recurse into children.
+        for child in &bx.children {
+            let (cx, cy) = if bx.is_fixed { (bx.x, bx.y) } else { (abs_x, abs_y) };
+            self.walk(child, cx, cy, in_layer);
+        }
+    }
+
+    /// Move the items recorded since `start` into a layer for `bx`.
+    fn promote(&mut self, bx: &LayoutBox, start: usize) {
+        let mut bounds = EMPTY;
+        for item in &self.items[start..] {
+            bounds = bounds.union(&item.bounds);
+        }
+        if bounds.is_empty() || bounds.w as i64 * bounds.h as i64 > MAX_LAYER_PIXELS {
+            // Nothing to paint, or too big to keep a private canvas for.
+            return;
+        }
+
+        let mut items = self.items.split_off(start);
+        let mut hash = fnv(0xcbf2_9ce4_8422_2325, &[]);
+        for item in &mut items {
+            item.bounds.x -= bounds.x;
+            item.bounds.y -= bounds.y;
+            item.hash = rehash(item);
+            hash = fnv(hash, &item.hash.to_le_bytes());
+        }
+        self.layers.push(Layer { node_id: bx.node_id, fixed: bx.is_fixed, bounds, items, hash });
+    }
+
+    fn fill(&mut self, x: i32, y: i32, w: i32, h: i32, color: u32) {
+        let bounds = Rect { x, y, w, h };
+        if bounds.is_empty() || color >> 24 == 0 {
+            return;
+        }
+        let hash = fnv(hash_rect(1, &bounds), &color.to_le_bytes());
+        self.items.push(DisplayItem { bounds, op: PaintOp::Fill(color), hash });
+    }
+
+    /// A text run; `size` is its layout box, measured when `None`.
+    fn text(&mut self, x: i32, y: i32, size: Option<(i32, i32)>, text: &str, color: u32, font_id: u32, font_size: u16) {
+        let (w, h) = match size {
+            Some(s) => s,
+            None => {
+                let (w, h) = libfont_client::measure(font_id, font_size, text);
+                (w as i32, h as i32)
+            }
+        };
+        // Glyphs may overhang the layout box slightly.
+        let bounds = Rect { x, y, w: w.max(1) + 2, h: h.max(font_size as i32 + font_size as i32 / 4) };
+        let mut hash = fnv(hash_rect(2, &bounds), text.as_bytes());
+        hash = fnv(hash, &color.to_le_bytes());
+        hash = fnv(hash, &[font_id as u8, font_size as u8, (font_size >> 8) as u8]);
+        self.items.push(DisplayItem {
+            bounds,
+            op: PaintOp::Text { text: String::from(text), color, font_id, font_size },
+            hash,
+        });
+    }
+
+    /// Submit button appearance (default face unless styled) and label.
+    fn button(&mut self, bx: &LayoutBox, x: i32, y: i32) {
+        let label = match bx.text {
+            Some(ref t) => t.as_str(),
+            None => "Submit",
+        };
+
+        // Default web button bg + border if no CSS styling.
+        if bx.bg_color == 0 && bx.border_width == 0 {
+            let inner_h = (bx.height - 2).max(0);
+            self.fill(x, y, bx.width, bx.height, 0xFFE0E0E0);
+            self.fill(x, y, bx.width, 1, 0xFF808080);
+            self.fill(x, y + bx.height - 1, bx.width, 1, 0xFF808080);
+            self.fill(x, y + 1, 1, inner_h, 0xFF808080);
+            self.fill(x + bx.width - 1, y + 1, 1, inner_h, 0xFF808080);
+        }
+
+        // Center text in button.
+        let font_size = bx.font_size.max(1) as u16;
+        let color = if bx.color != 0 { bx.color } else { 0xFF000000 };
+        let (tw, th) = libfont_client::measure(0, font_size, label);
+        let tx = x + (bx.width - tw as i32) / 2;
+        let ty = y + (bx.height - font_size as i32) / 2;
+        self.text(tx, ty, Some((tw as i32, th as i32)), label, color, 0, font_size);
+    }
+}
+
+/// Recompute an item's hash after its bounds moved.
+fn rehash(item: &DisplayItem) -> u64 {
+    match &item.op {
+        PaintOp::Fill(color) => fnv(hash_rect(1, &item.bounds), &color.to_le_bytes()),
+        PaintOp::Text { text, color, font_id, font_size } => {
+            let mut h = fnv(hash_rect(2, &item.bounds), text.as_bytes());
+            h = fnv(h, &color.to_le_bytes());
+            fnv(h, &[*font_id as u8, *font_size as u8, (*font_size >> 8) as u8])
+        }
+        // Keep the image-state part of the original hash.
+        PaintOp::Image(_) => fnv(hash_rect(3, &item.bounds), &item.hash.to_le_bytes()),
+    }
+}
+
+fn hash_rect(kind: u8, r: &Rect) -> u64 {
+    let mut h = fnv(0xcbf2_9ce4_8422_2325, &[kind]);
+    for v in [r.x, r.y, r.w, r.h] {
+        h = fnv(h, &v.to_le_bytes());
+    }
+    h
+}
+
+/// 64-bit FNV-1a, continuing from `h`.
+fn fnv(mut h: u64, bytes: &[u8]) -> u64 {
+    for &b in bytes {
+        h ^= b as u64;
+        h = h.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    h
+}
+
+/// Pixels of a layer, `w × h`, cleared to transparent.
+pub(crate) fn rasterize_layer(layer: &Layer, images: &ImageCache) -> Vec<u32> {
+    let w = layer.bounds.w.max(1) as u32;
+    let h = layer.bounds.h.max(1) as u32;
+    let mut buf = vec![0u32; (w * h) as usize];
+    let clip = Rect { x: 0, y: 0, w: w as i32, h: h as i32 };
+    paint(layer.items.iter(), images, buf.as_mut_ptr(), w, h, 0, 0, &clip);
+    buf
+}
@@ -4,6 +4,7 @@
 //! (a plain `usize` index). This avoids recursive Box/Rc trees and keeps
 //! allocation patterns simple for the anyOS bump allocator.
 
+use alloc::collections::BTreeMap;
 use alloc::string::String;
 use alloc::vec::Vec;
 
@@ -14,18 +15,72 @@ use alloc::vec::Vec;
 /// Index into `Dom::nodes`.
 pub type NodeId = usize;
 
+/// Interned, ASCII-lowercased `class` or `id` value (see `AtomTable`).
+pub type Atom = u32;
+
 // ---------------------------------------------------------------------------
 // DOM tree
 // ---------------------------------------------------------------------------
 
 pub struct Dom {
     pub nodes: Vec<DomNode>,
+    /// Invalidation flags per node (`STYLE_DIRTY_*`, `LAYOUT_DIRTY`),
+    /// indexed by `NodeId`.  New nodes start dirty; `JsRuntime::apply_mutations`
+    /// marks the nodes JS touched, and the owner clears the flags once styles
+    /// and layout are up to date (see `style::StyleCache`, `layout::LayoutCache`).
+    pub style_dirty: Vec<u8>,
+    /// Every class name and id used in the document.
+    pub atoms: AtomTable,
 }
 
+/// The node's own attributes changed, or it was created or moved.
+pub const STYLE_DIRTY_SELF: u8 = 1;
+/// The node's child list changed.
+pub const STYLE_DIRTY_CHILDREN: u8 = 2;
+/// Only the node's layout inputs changed (e.g. its image finished loading).
+pub const LAYOUT_DIRTY: u8 = 4;
+
 pub struct DomNode {
     pub node_type: NodeType,
     pub parent: Option<NodeId>,
     pub children: Vec<NodeId>,
+    /// The `class` attribute tokenized into a sorted atom set.
+    pub classes: Vec<Atom>,
+    /// The `id` attribute as an atom.
+    pub id_atom: Option<Atom>,
+}
+
+/// Interning table for class names and ids, so selector matching compares
+/// integers instead of re-scanning attribute strings.  Matching is ASCII
+/// case-insensitive, so names are stored lowercased.
+pub struct AtomTable {
+    map: BTreeMap<String, Atom>,
+}
+
+impl AtomTable {
+    pub fn new() -> AtomTable {
+        AtomTable { map: BTreeMap::new() }
+    }
+
+    /// Atom for `name`, adding it if new.
+    pub fn intern(&mut self, name: &str) -> Atom {
+        if let Some(a) = self.get(name) {
+            return a;
+        }
+        let atom = self.map.len() as Atom;
+        self.map.insert(name.to_ascii_lowercase(), atom);
+        atom
+    }
+
+    /// Atom for `name` if any node uses it.  `None` means no element of
+    /// the document can match a selector requiring `name`.
+    pub fn get(&self, name: &str) -> Option<Atom> {
+        if name.bytes().any(|b| b.is_ascii_uppercase()) {
+            self.map.get(name.to_ascii_lowercase().as_str()).copied()
+        } else {
+            self.map.get(name).copied()
+        }
+    }
 }
 
 pub enum NodeType {
@@ -248,7 +303,7 @@ impl Tag {
 impl Dom {
     /// Create an empty DOM with no nodes.
     pub fn new() -> Dom {
-        Dom { nodes: Vec::new() }
+        Dom { nodes: Vec::new(), style_dirty: Vec::new(), atoms: AtomTable::new() }
     }
 
     /// Append a node to the arena, wiring up the parent/child link.
@@ -259,13 +314,49 @@ impl Dom {
             node_type,
             parent,
             children: Vec::new(),
+            classes: Vec::new(),
+            id_atom: None,
         });
+        self.style_dirty.push(STYLE_DIRTY_SELF);
         if let Some(pid) = parent {
             self.nodes[pid].children.push(id);
         }
+        self.update_atoms(id);
         id
     }
 
+    /// Re-tokenize the `class` and `id` attributes of `id` into atoms.
+    /// Must be called whenever the attributes of an element change.
+    pub fn update_atoms(&mut self, id: NodeId) {
+        if id >= self.nodes.len() { return; }
+        let mut classes = core::mem::take(&mut self.nodes[id].classes);
+        classes.clear();
+        let mut id_atom = None;
+        if let NodeType::Element { attrs, .. } = &self.nodes[id].node_type {
+            for a in attrs {
+                if eq_ignore_case(&a.name, "class") {
+                    for tok in a.value.split(|c: char| c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\x0c') {
+                        if !tok.is_empty() {
+                            classes.push(self.atoms.intern(tok));
+                        }
+                    }
+                } else if eq_ignore_case(&a.name, "id") {
+                    id_atom = Some(self.atoms.intern(&a.value));
+                }
+            }
+        }
+        classes.sort_unstable();
+        classes.dedup();
+        let node = &mut self.nodes[id];
+        node.classes = classes;
+        node.id_atom = id_atom;
+    }
+
+    /// Whether element `id` has the class `atom`.
+    pub fn has_class(&self, id: NodeId, atom: Atom) -> bool {
+        self.nodes[id].classes.binary_search(&atom).is_ok()
+    }
+
     /// Get a shared reference to a node by id.
     pub fn get(&self, id: NodeId) -> &DomNode {
         &self.nodes[id]
@@ -332,6 +423,21 @@ impl Dom {
 
     // -- mutation methods ---------------------------------------------------
 
+    /// Record that `id` needs restyling or relayout (`STYLE_DIRTY_*` /
+    /// `LAYOUT_DIRTY` flags).
+    pub fn mark_style_dirty(&mut self, id: NodeId, flags: u8) {
+        if let Some(f) = self.style_dirty.get_mut(id) {
+            *f |= flags;
+        }
+    }
+
+    /// Reset all style invalidation flags (after styles were resolved).
+    pub fn clear_style_dirty(&mut self) {
+        for f in self.style_dirty.iter_mut() {
+            *f = 0;
+        }
+    }
+
     /// Set or add an attribute on an element node.
     pub fn set_attr(&mut self, id: NodeId, name: &str, value: &str) {
         if id >= self.nodes.len() { return; }
@@ -342,6 +448,7 @@ impl Dom {
                 attrs.push(Attr { name: String::from(name), value: String::from(value) });
             }
         }
+        self.update_atoms(id);
     }
 
     /// Remove an attribute from an element node.
@@ -350,6 +457,7 @@ impl Dom {
         if let NodeType::Element { attrs, .. } = &mut self.nodes[id].node_type {
             attrs.retain(|a| a.name != name);
         }
+        self.update_atoms(id);
     }
 
     /// Replace all children with a single text node.
@@ -1,10 +1,11 @@
 // html.rs — HTML tokenizer + tree-builder for surf browser
 // Handles real-world HTML: entities, void elements, auto-closing, implicit structure.
+// The tree builder is incremental: markup can be fed in chunks as it arrives.
 
 use alloc::string::String;
 use alloc::vec::Vec;
 
-use crate::dom::{Attr, Dom, NodeId, NodeType, Tag};
+use crate::dom::{Attr, Dom, NodeId, NodeType, Tag, STYLE_DIRTY_CHILDREN};
 
 // ---------------------------------------------------------------------------
 // Phase 1: Tokenizer
@@ -393,116 +394,187 @@ fn read_attr_value(bytes: &[u8], pos: &mut usize) -> String {
     }
 }
 
-pub fn tokenize(html: &str) -> Vec<Token> {
-    crate::debug_surf!("[html] tokenize: {} bytes input", html.len());
-    let bytes = html.as_bytes();
-    let mut pos: usize = 0;
-    let mut tokens = Vec::new();
-
+/// Whether the start tag whose name begins at `pos` is complete: its `>`
+/// (outside quoted attribute values) is within `bytes`.
+fn tag_complete(bytes: &[u8], mut pos: usize) -> bool {
     while pos < bytes.len() {
-        if bytes[pos] == b'<' {
-            pos += 1; // skip '<'
-            if pos >= bytes.len() {
-                break;
-            }
-
-            // Comment: <!-- ... -->
-            if bytes.len() - pos >= 3
-                && bytes[pos] == b'!'
-                && bytes[pos + 1] == b'-'
-                && bytes[pos + 2] == b'-'
-            {
-                pos += 3;
-                // Scan for -->
-                loop {
-                    if pos + 2 >= bytes.len() {
-                        pos = bytes.len(); // unterminated comment — consume rest
-                        break;
-                    }
-                    if bytes[pos] == b'-' && bytes[pos + 1] == b'-' && bytes[pos + 2] == b'>' {
-                        pos += 3;
-                        break;
+        match bytes[pos] {
+            b'>' => return true,
+            b'=' => {
+                pos += 1;
+                skip_whitespace(bytes, &mut pos);
+                if pos < bytes.len() && (bytes[pos] == b'"' || bytes[pos] == b'\'') {
+                    let quote = bytes[pos];
+                    match bytes[pos + 1..].iter().position(|&b| b == quote) {
+                        Some(off) => pos += off + 2,
+                        None => return false,
                     }
-                    pos += 1;
                 }
-                tokens.push(Token::Comment);
-                continue;
             }
+            _ => pos += 1,
+        }
+    }
+    false
+}
 
-            // Doctype or other <!...> declaration
-            if bytes[pos] == b'!' {
-                pos += 1; // skip '!'
-                while pos < bytes.len() && bytes[pos] != b'>' {
-                    pos += 1;
-                }
-                if pos < bytes.len() {
-                    pos += 1;
-                }
-                tokens.push(Token::Doctype);
-                continue;
-            }
+/// Whether the closing `</tag_name>` of a raw text element is within
+/// `bytes` (same matching rules as `collect_raw_text`).
+fn raw_text_complete(bytes: &[u8], pos: usize, tag_name: &str) -> bool {
+    let end_len = tag_name.len() + 2;
+    let mut i = pos;
+    while i + end_len < bytes.len() {
+        if bytes[i] == b'<'
+            && bytes[i + 1] == b'/'
+            && bytes[i + 2..i + end_len].eq_ignore_ascii_case(tag_name.as_bytes())
+            && matches!(bytes[i + end_len], b'>' | b' ' | b'\t')
+        {
+            return bytes[i + end_len..].contains(&b'>');
+        }
+        i += 1;
+    }
+    false
+}
 
-            // End tag: </name>
-            if bytes[pos] == b'/' {
-                pos += 1;
-                skip_whitespace(bytes, &mut pos);
-                let name = read_name(bytes, &mut pos);
-                // Skip to '>'
-                while pos < bytes.len() && bytes[pos] != b'>' {
-                    pos += 1;
-                }
-                if pos < bytes.len() {
-                    pos += 1;
-                }
-                if !name.is_empty() {
-                    tokens.push(Token::EndTag { name });
-                }
-                continue;
-            }
+/// Tokenize the construct (text run, tag, comment, raw text element) at
+/// `*pos`, appending its tokens to `out`.
+///
+/// Unless `eof` is set, a construct that may continue past the end of
+/// `bytes` is left alone and `false` is returned: nothing is emitted and
+/// `*pos` is unchanged, so the caller can retry once more input arrived.
+fn next_tokens(bytes: &[u8], pos: &mut usize, eof: bool, out: &mut Vec<Token>) -> bool {
+    if bytes[*pos] != b'<' {
+        // Text content — runs up to the next tag.
+        if !eof && !bytes[*pos..].contains(&b'<') {
+            return false;
+        }
+        let text = collect_text(bytes, pos);
+        if !text.is_empty() {
+            out.push(Token::Text(text));
+        }
+        return true;
+    }
 
-            // Processing instruction: <? ... > (skip)
-            if bytes[pos] == b'?' {
-                while pos < bytes.len() && bytes[pos] != b'>' {
-                    pos += 1;
-                }
-                if pos < bytes.len() {
-                    pos += 1;
-                }
-                continue;
-            }
+    let mut p = *pos + 1; // skip '<'
+    if p >= bytes.len() {
+        if !eof {
+            return false;
+        }
+        *pos = p;
+        return true;
+    }
 
-            // Start tag
-            let name = read_name(bytes, &mut pos);
-            if name.is_empty() {
-                // Malformed tag — emit '<' as text
-                tokens.push(Token::Text(String::from("<")));
-                continue;
+    if bytes[p] == b'!' {
+        // Too short to tell a comment from a declaration yet.
+        if !eof && bytes.len() - p < 3 && b"!--".starts_with(&bytes[p..]) {
+            return false;
+        }
+
+        // Comment: <!-- ... -->
+        if bytes.len() - p >= 3 && bytes[p + 1] == b'-' && bytes[p + 2] == b'-' {
+            p += 3;
+            match bytes[p..].windows(3).position(|w| w == b"-->") {
+                Some(off) => p += off + 3,
+                None if !eof => return false,
+                None => p = bytes.len(), // unterminated comment — consume rest
             }
+            out.push(Token::Comment);
+            *pos = p;
+            return true;
+        }
+    }
 
-            let (attrs, self_closing) = parse_attrs(bytes, &mut pos);
+    // Declarations, end tags and processing instructions run to '>'.
+    if matches!(bytes[p], b'!' | b'/' | b'?') && !eof && !bytes[p..].contains(&b'>') {
+        return false;
+    }
 
-            // For raw text elements, collect content now
-            let is_raw = name == "script" || name == "style";
-            tokens.push(Token::StartTag {
-                name: name.clone(),
-                attrs,
-                self_closing,
-            });
+    // Doctype or other <!...> declaration
+    if bytes[p] == b'!' {
+        p += 1; // skip '!'
+        while p < bytes.len() && bytes[p] != b'>' {
+            p += 1;
+        }
+        if p < bytes.len() {
+            p += 1;
+        }
+        out.push(Token::Doctype);
+        *pos = p;
+        return true;
+    }
 
-            if is_raw && !self_closing {
-                let raw = collect_raw_text(bytes, &mut pos, &name);
-                if !raw.is_empty() {
-                    tokens.push(Token::Text(raw));
-                }
-                tokens.push(Token::EndTag { name });
-            }
-        } else {
-            // Text content
-            let text = collect_text(bytes, &mut pos);
-            if !text.is_empty() {
-                tokens.push(Token::Text(text));
-            }
+    // End tag: </name>
+    if bytes[p] == b'/' {
+        p += 1;
+        skip_whitespace(bytes, &mut p);
+        let name = read_name(bytes, &mut p);
+        // Skip to '>'
+        while p < bytes.len() && bytes[p] != b'>' {
+            p += 1;
+        }
+        if p < bytes.len() {
+            p += 1;
+        }
+        if !name.is_empty() {
+            out.push(Token::EndTag { name });
+        }
+        *pos = p;
+        return true;
+    }
+
+    // Processing instruction: <? ... > (skip)
+    if bytes[p] == b'?' {
+        while p < bytes.len() && bytes[p] != b'>' {
+            p += 1;
+        }
+        if p < bytes.len() {
+            p += 1;
+        }
+        *pos = p;
+        return true;
+    }
+
+    // Start tag
+    if !is_name_char(bytes[p]) {
+        // Malformed tag — emit '<' as text
+        out.push(Token::Text(String::from("<")));
+        *pos = p;
+        return true;
+    }
+    if !eof && !tag_complete(bytes, p) {
+        return false;
+    }
+    let name = read_name(bytes, &mut p);
+    let (attrs, self_closing) = parse_attrs(bytes, &mut p);
+
+    // For raw text elements, collect content now
+    let is_raw = (name == "script" || name == "style") && !self_closing;
+    if is_raw && !eof && !raw_text_complete(bytes, p, &name) {
+        return false;
+    }
+    out.push(Token::StartTag {
+        name: name.clone(),
+        attrs,
+        self_closing,
+    });
+    if is_raw {
+        let raw = collect_raw_text(bytes, &mut p, &name);
+        if !raw.is_empty() {
+            out.push(Token::Text(raw));
         }
+        out.push(Token::EndTag { name });
+    }
+    *pos = p;
+    true
+}
+
+pub fn tokenize(html: &str) -> Vec<Token> {
+    crate::debug_surf!("[html] tokenize: {} bytes input", html.len());
+    let bytes = html.as_bytes();
+    let mut pos: usize = 0;
+    let mut tokens = Vec::new();
+
+    while pos < bytes.len() {
+        next_tokens(bytes, &mut pos, true, &mut tokens);
     }
 
     crate::debug_surf!("[html] tokenize done: {} tokens", tokens.len());
@@ -592,67 +664,192 @@ fn in_pre(dom: &Dom, stack: &[NodeId]) -> bool {
     stack_has(dom, stack, Tag::Pre)
 }
 
-pub fn parse(html: &str) -> Dom {
-    let tokens = tokenize(html);
-    crate::debug_surf!("[html] tree build start: {} tokens", tokens.len());
-    #[cfg(feature = "debug_surf")]
-    crate::debug_surf!("[html]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
-    let mut dom = Dom::new();
+/// Kind of subresource found while parsing (see [`HtmlParser::take_preloads`]).
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum PreloadKind {
+    Image,
+    Stylesheet,
+    Script,
+}
 
-    // Create implicit root (html-like)
-    let root = dom.add_node(
-        NodeType::Element {
-            tag: Tag::Html,
-            attrs: Vec::new(),
-        },
-        None,
-    );
+/// A subresource URL (as written in the markup) discovered by the parser.
+pub struct Preload {
+    pub kind: PreloadKind,
+    pub url: String,
+}
 
-    let mut stack: Vec<NodeId> = Vec::new();
-    stack.push(root);
+/// Incremental HTML tree builder.
+///
+/// Markup can be fed in arbitrary pieces as it arrives from the network;
+/// every complete construct is tokenized and its nodes are attached to the
+/// DOM right away, so a partially received document can already be laid
+/// out and rendered.  An incomplete tail (a tag, comment, text run or raw
+/// `<script>`/`<style>` element cut off by the chunk boundary) is kept
+/// until more input arrives or `finish()` is called.
+///
+/// All calls must be given the same `Dom` the parser was created with.
+/// New nodes carry `STYLE_DIRTY_SELF` and their parents
+/// `STYLE_DIRTY_CHILDREN`, so a later incremental restyle/relayout only
+/// touches what was appended.
+pub struct HtmlParser {
+    /// Unconsumed input (an incomplete construct).
+    buf: Vec<u8>,
+    root: NodeId,
+    /// Open elements.
+    stack: Vec<NodeId>,
+    head_id: Option<NodeId>,
+    body_id: Option<NodeId>,
+    preloads: Vec<Preload>,
+    /// Set when a `<style>` element or its text was added; cleared by the
+    /// owner after re-collecting inline stylesheets.
+    pub style_changed: bool,
+}
+
+impl HtmlParser {
+    /// Start a new document in the empty `dom`.
+    pub fn new(dom: &mut Dom) -> Self {
+        // Create implicit root (html-like)
+        let root = dom.add_node(
+            NodeType::Element {
+                tag: Tag::Html,
+                attrs: Vec::new(),
+            },
+            None,
+        );
+        let mut stack = Vec::new();
+        stack.push(root);
+        Self {
+            buf: Vec::new(),
+            root,
+            stack,
+            head_id: None,
+            body_id: None,
+            preloads: Vec::new(),
+            style_changed: false,
+        }
+    }
 
-    // Track whether we've seen explicit structural tags
-    let mut saw_head = false;
-    let mut saw_body = false;
-    let mut head_id: Option<NodeId> = None;
-    let mut body_id: Option<NodeId> = None;
-
-    // First pass: check for explicit html/head/body
-    for tok in &tokens {
-        if let Token::StartTag { name, .. } = tok {
-            match name.as_str() {
-                "head" => saw_head = true,
-                "body" => saw_body = true,
-                _ => {}
+    /// Parse the next piece of the document.
+    pub fn feed(&mut self, dom: &mut Dom, chunk: &[u8]) {
+        if self.buf.is_empty() {
+            // Common case: tokenize straight from the chunk, keep the tail.
+            let used = self.run(dom, chunk, false);
+            self.buf.extend_from_slice(&chunk[used..]);
+        } else {
+            let mut buf = core::mem::take(&mut self.buf);
+            buf.extend_from_slice(chunk);
+            let used = self.run(dom, &buf, false);
+            buf.drain(..used);
+            self.buf = buf;
+        }
+    }
+
+    /// End of input: flush the buffered tail and complete the implicit
+    /// document structure.
+    pub fn finish(&mut self, dom: &mut Dom) {
+        let buf = core::mem::take(&mut self.buf);
+        self.run(dom, &buf, true);
+        self.head(dom);
+        self.body(dom);
+
+        #[cfg(feature = "debug_surf")]
+        {
+            let max_depth = dom.nodes.iter().map(|n| {
+                let mut depth = 0u32;
+                let mut cur = n.parent;
+                while let Some(pid) = cur {
+                    depth += 1;
+                    cur = dom.nodes.get(pid).and_then(|p| p.parent);
+                    if depth > 500 { break; } // safety
+                }
+                depth
+            }).max().unwrap_or(0);
+            crate::debug_surf!("[html] tree build done: {} nodes, max_depth={}", dom.nodes.len(), max_depth);
+            crate::debug_surf!("[html]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
+        }
+    }
+
+    /// Subresources discovered since the last call, in document order.
+    pub fn take_preloads(&mut self) -> Vec<Preload> {
+        core::mem::take(&mut self.preloads)
+    }
+
+    /// Tokenize and build from `bytes`; returns the number of bytes used.
+    fn run(&mut self, dom: &mut Dom, bytes: &[u8], eof: bool) -> usize {
+        let mut pos = 0;
+        let mut tokens = Vec::new();
+        while pos < bytes.len() {
+            if !next_tokens(bytes, &mut pos, eof, &mut tokens) {
+                break;
+            }
+            for tok in tokens.drain(..) {
+                self.push_token(dom, tok);
             }
         }
+        pos
     }
 
-    // If no explicit structure, create implicit <head> and <body>
-    if !saw_head {
-        head_id = Some(dom.add_node(
-            NodeType::Element {
-                tag: Tag::Head,
-                attrs: Vec::new(),
-            },
-            Some(root),
-        ));
+    /// Attach a node under `parent`.
+    fn add(&mut self, dom: &mut Dom, node_type: NodeType, parent: NodeId) -> NodeId {
+        let id = dom.add_node(node_type, Some(parent));
+        dom.mark_style_dirty(parent, STYLE_DIRTY_CHILDREN);
+        if node_tag(dom, id) == Some(Tag::Style) || node_tag(dom, parent) == Some(Tag::Style) {
+            self.style_changed = true;
+        }
+        id
     }
-    if !saw_body {
-        body_id = Some(dom.add_node(
-            NodeType::Element {
-                tag: Tag::Body,
-                attrs: Vec::new(),
-            },
-            Some(root),
-        ));
-        // Push body as default insertion point when no explicit body
-        if let Some(bid) = body_id {
-            stack.push(bid);
+
+    /// The `<head>`, created (before `<body>`) on first use.
+    fn head(&mut self, dom: &mut Dom) -> NodeId {
+        if let Some(hid) = self.head_id {
+            return hid;
         }
+        let hid = self.add(dom, NodeType::Element { tag: Tag::Head, attrs: Vec::new() }, self.root);
+        if let Some(bid) = self.body_id {
+            dom.insert_before(self.root, hid, bid);
+        }
+        self.head_id = Some(hid);
+        hid
     }
 
-    for tok in tokens {
+    /// The `<body>`, created and made the insertion point on first use.
+    fn body(&mut self, dom: &mut Dom) -> NodeId {
+        if let Some(bid) = self.body_id {
+            return bid;
+        }
+        let bid = self.add(dom, NodeType::Element { tag: Tag::Body, attrs: Vec::new() }, self.root);
+        self.body_id = Some(bid);
+        self.stack.retain(|&id| node_tag(dom, id) != Some(Tag::Head));
+        self.stack.push(bid);
+        bid
+    }
+
+    /// Content at the top level before any `<body>` opens an implicit body.
+    fn ensure_body_for_content(&mut self, dom: &mut Dom) {
+        if self.body_id.is_none() && self.stack.last().copied() == Some(self.root) {
+            self.body(dom);
+        }
+    }
+
+    fn note_preload(&mut self, tag: Tag, attrs: &[Attr]) {
+        let get = |name: &str| attrs.iter().find(|a| a.name == name).map(|a| a.value.as_str());
+        let (kind, url) = match tag {
+            Tag::Img => (PreloadKind::Image, get("src")),
+            Tag::Script => (PreloadKind::Script, get("src")),
+            Tag::Link if get("rel").map_or(false, |r| r.eq_ignore_ascii_case("stylesheet")) => {
+                (PreloadKind::Stylesheet, get("href"))
+            }
+            _ => return,
+        };
+        if let Some(url) = url {
+            if !url.is_empty() && !url.starts_with("data:") {
+                self.preloads.push(Preload { kind, url: String::from(url) });
+            }
+        }
+    }
+
+    fn push_token(&mut self, dom: &mut Dom, tok: Token) {
+        let root = self.root;
         match tok {
             Token::Doctype | Token::Comment => {
                 // Skip
@@ -674,7 +871,7 @@ pub fn parse(html: &str) -> Dom {
                     Tag::Html => {
                         // Merge attrs onto root if desired; otherwise skip creating duplicate
                         if dom_attrs.is_empty() {
-                            continue;
+                            return;
                         }
                         // Apply attrs to root node
                         if let NodeType::Element { ref mut attrs, .. } =
@@ -682,85 +879,72 @@ pub fn parse(html: &str) -> Dom {
                         {
                             *attrs = dom_attrs;
                         }
-                        continue;
+                        dom.update_atoms(root);
+                        return;
                     }
                     Tag::Head => {
-                        if head_id.is_none() {
-                            let hid = dom.add_node(
-                                NodeType::Element {
-                                    tag: Tag::Head,
-                                    attrs: dom_attrs,
-                                },
-                                Some(root),
-                            );
-                            head_id = Some(hid);
-                            stack.push(hid);
-                        } else {
-                            stack.push(head_id.unwrap());
-                        }
-                        continue;
+                        let hid = self.head(dom);
+                        set_attrs_if_empty(dom, hid, dom_attrs);
+                        self.stack.push(hid);
+                        return;
                     }
                     Tag::Body => {
-                        if body_id.is_none() {
-                            let bid = dom.add_node(
-                                NodeType::Element {
-                                    tag: Tag::Body,
-                                    attrs: dom_attrs,
-                                },
-                                Some(root),
-                            );
-                            body_id = Some(bid);
-                            // Replace implicit body in stack
-                            stack.retain(|&id| node_tag(&dom, id) != Some(Tag::Head));
-                            stack.push(bid);
-                        } else {
-                            // Pop back to body level
-                            while stack.len() > 1 {
-                                if node_tag(&dom, *stack.last().unwrap()) == Some(Tag::Body) {
-                                    break;
-                                }
-                                stack.pop();
-                            }
-                            if stack.last().map(|&id| node_tag(&dom, id)) != Some(Some(Tag::Body))
-                            {
-                                stack.push(body_id.unwrap());
+                        let bid = self.body(dom);
+                        // Content before <body> may have opened it implicitly.
+                        set_attrs_if_empty(dom, bid, dom_attrs);
+                        // Pop back to body level
+                        while self.stack.len() > 1 {
+                            if node_tag(dom, *self.stack.last().unwrap()) == Some(Tag::Body) {
+                                break;
                             }
+                            self.stack.pop();
                         }
-                        continue;
+                        if self.stack.last().map(|&id| node_tag(dom, id)) != Some(Some(Tag::Body)) {
+                            self.stack.push(bid);
+                        }
+                        return;
                     }
                     _ => {}
                 }
 
+                self.note_preload(tag, &dom_attrs);
+
                 // Head-only elements go into <head>
                 let is_head_element =
                     matches!(tag, Tag::Title | Tag::Meta | Tag::Link | Tag::Style)
-                        && !stack_has(&dom, &stack, Tag::Body);
+                        && !stack_has(dom, &self.stack, Tag::Body);
                 if is_head_element {
-                    if let Some(hid) = head_id {
-                        let parent = hid;
-                        let id = dom.add_node(
-                            NodeType::Element {
-                                tag,
-                                attrs: dom_attrs,
-                            },
-                            Some(parent),
-                        );
-                        if !tag.is_void() && !self_closing && stack.len() < 256 {
-                            stack.push(id);
-                        }
-                        continue;
+                    let parent = self.head(dom);
+                    let id = self.add(
+                        dom,
+                        NodeType::Element {
+                            tag,
+                            attrs: dom_attrs,
+                        },
+                        parent,
+                    );
+                    if !tag.is_void() && !self_closing && self.stack.len() < 256 {
+                        self.stack.push(id);
                     }
+                    return;
+                }
+
+                // Scripts and templates may sit between </head> and <body>.
+                if !matches!(tag, Tag::Script | Tag::Noscript | Tag::Template) {
+                    self.ensure_body_for_content(dom);
                 }
 
+                let stack = &mut self.stack;
+
                 // Auto-close <p> when block element opens inside it
-                if closes_p(tag) && stack_has(&dom, &stack, Tag::P) {
-                    pop_to(&dom, &mut stack, Tag::P);
+                if closes_p(tag) && stack_has(dom, stack, Tag::P) {
+                    pop_to(dom, stack, Tag::P);
                 }
 
                 // Auto-close <li> when another <li> opens
                 if tag == Tag::Li {
                     if let Some(&top) = stack.last() {
-                        if node_tag(&dom, top) == Some(Tag::Li) {
+                        if node_tag(dom, top) == Some(Tag::Li) {
                             stack.pop();
                         }
                     }
@@ -769,7 +953,7 @@ pub fn parse(html: &str) -> Dom {
                 // Auto-close <td>/<th> when another opens
                 if tag == Tag::Td || tag == Tag::Th {
                     if let Some(&top) = stack.last() {
-                        let top_tag = node_tag(&dom, top);
+                        let top_tag = node_tag(dom, top);
                         if top_tag == Some(Tag::Td) || top_tag == Some(Tag::Th) {
                             stack.pop();
                         }
@@ -779,7 +963,7 @@ pub fn parse(html: &str) -> Dom {
                 // Auto-close <tr> when another <tr> opens
                 if tag == Tag::Tr {
                     if let Some(&top) = stack.last() {
-                        if node_tag(&dom, top) == Some(Tag::Tr) {
+                        if node_tag(dom, top) == Some(Tag::Tr) {
                             stack.pop();
                         }
                     }
@@ -788,19 +972,20 @@ pub fn parse(html: &str) -> Dom {
                 // Determine parent
                 let parent = stack.last().copied().unwrap_or(root);
 
-                let id = dom.add_node(
+                let id = self.add(
+                    dom,
                     NodeType::Element {
                         tag,
                         attrs: dom_attrs,
                     },
-                    Some(parent),
+                    parent,
                 );
 
                 // Push to stack unless void or self-closing.
                 // Cap nesting depth at 256 to prevent stack overflow in
                 // downstream recursive layout/rendering passes.
-                if !tag.is_void() && !self_closing && stack.len() < 256 {
-                    stack.push(id);
+                if !tag.is_void() && !self_closing && self.stack.len() < 256 {
+                    self.stack.push(id);
                 }
             }
 
@@ -810,68 +995,82 @@ pub fn parse(html: &str) -> Dom {
                 match tag {
                     Tag::Html | Tag::Body => {
                         // Don't actually pop these — they stay until the end
-                        continue;
+                        return;
                     }
                     Tag::Head => {
                         // Pop head and ensure body is on stack
-                        if stack_has(&dom, &stack, Tag::Head) {
-                            pop_to(&dom, &mut stack, Tag::Head);
+                        if stack_has(dom, &self.stack, Tag::Head) {
+                            pop_to(dom, &mut self.stack, Tag::Head);
                         }
                         // Ensure body is insertion point
-                        if let Some(bid) = body_id {
-                            if stack.last().copied() != Some(bid) {
-                                stack.push(bid);
+                        if let Some(bid) = self.body_id {
+                            if self.stack.last().copied() != Some(bid) {
+                                self.stack.push(bid);
                             }
                         }
-                        continue;
+                        return;
                     }
                     _ => {}
                 }
 
                 // Pop stack to matching open tag
-                if stack_has(&dom, &stack, tag) {
-                    pop_to(&dom, &mut stack, tag);
+                if stack_has(dom, &self.stack, tag) {
+                    pop_to(dom, &mut self.stack, tag);
                 }
                 // If not found, just ignore the end tag (error recovery)
             }
 
             Token::Text(text) => {
                 if text.is_empty() {
-                    continue;
+                    return;
                 }
 
-                let processed = if in_pre(&dom, &stack) {
+                let processed = if in_pre(dom, &self.stack) {
                     text
                 } else {
                     collapse_whitespace(&text)
                 };
 
                 if processed.is_empty() {
-                    continue;
+                    return;
                 }
 
-                let parent = stack.last().copied().unwrap_or(root);
-                dom.add_node(NodeType::Text(processed), Some(parent));
+                if processed.bytes().all(|b| b.is_ascii_whitespace()) {
+                    // Inter-element whitespace does not open the body.
+                    if self.body_id.is_none() && self.stack.last().copied() == Some(root) {
+                        return;
+                    }
+                } else {
+                    self.ensure_body_for_content(dom);
+                }
+
+                let parent = self.stack.last().copied().unwrap_or(root);
+                self.add(dom, NodeType::Text(processed), parent);
             }
         }
     }
+}
 
-    #[cfg(feature = "debug_surf")]
-    {
-        let max_depth = dom.nodes.iter().map(|n| {
-            let mut depth = 0u32;
-            let mut cur = n.parent;
-            while let Some(pid) = cur {
-                depth += 1;
-                cur = dom.nodes.get(pid).and_then(|p| p.parent);
-                if depth > 500 { break; } // safety
-            }
-            depth
-        }).max().unwrap_or(0);
-        crate::debug_surf!("[html] tree build done: {} nodes, max_depth={}", dom.nodes.len(), max_depth);
-        crate::debug_surf!("[html]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
+/// Give an implicitly created element the attributes of its late tag.
+fn set_attrs_if_empty(dom: &mut Dom, id: NodeId, new_attrs: Vec<Attr>) {
+    if new_attrs.is_empty() {
+        return;
+    }
+    if let NodeType::Element { ref mut attrs, .. } = dom.nodes[id].node_type {
+        if attrs.is_empty() {
+            *attrs = new_attrs;
+        }
     }
+    dom.update_atoms(id);
+}
 
+pub fn parse(html: &str) -> Dom {
+    #[cfg(feature = "debug_surf")]
+    crate::debug_surf!("[html]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
+    let mut dom = Dom::new();
+    let mut parser = HtmlParser::new(&mut dom);
+    parser.feed(&mut dom, html.as_bytes());
+    parser.finish(&mut dom);
     dom
 }
 
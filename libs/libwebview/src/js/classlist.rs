@@ -5,7 +5,7 @@ use alloc::string::String;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::JsObject;
 use libjs::vm::native_fn;
@@ -16,7 +16,7 @@ use super::{get_bridge, this_node_id, arg_string, DomMutation};
 pub fn make_class_list(node_id: i64, initial_class: &str) -> JsValue {
     let mut obj = JsObject::new();
     obj.set(String::from("__nodeId"), JsValue::Number(node_id as f64));
-    obj.set(String::from("__value"), JsValue::String(String::from(initial_class)));
+    obj.set(String::from("__value"), JsValue::String(JsStr::from(initial_class)));
 
     obj.set(String::from("add"), native_fn("add", cl_add));
     obj.set(String::from("remove"), native_fn("remove", cl_remove));
@@ -28,31 +28,32 @@ pub fn make_class_list(node_id: i64, initial_class: &str) -> JsValue {
     JsValue::Object(Rc::new(RefCell::new(obj)))
 }
 
-/// Read the current class string from the classList's __value.
-fn get_class_value(vm: &Vm) -> String {
+/// Read the current class string from the classList's __value (shared,
+/// not copied).
+fn get_class_value(vm: &Vm) -> JsStr {
     if let JsValue::Object(obj) = &vm.current_this {
         if let Some(p) = obj.borrow().properties.get("__value") {
-            return p.value.to_js_string();
+            return p.value.to_js_str();
         }
     }
-    String::new()
+    JsStr::from("")
 }
 
 /// Write class string back and record mutation.
-fn set_class_value(vm: &mut Vm, new_val: &str) {
+fn set_class_value(vm: &mut Vm, new_val: JsStr) {
     let nid = this_node_id(vm);
-    if let JsValue::Object(obj) = &vm.current_this {
-        obj.borrow_mut().set(String::from("__value"), JsValue::String(String::from(new_val)));
-    }
     if let Some(bridge) = get_bridge(vm) {
         if nid >= 0 {
             bridge.mutations.push(DomMutation::SetAttribute {
                 node_id: nid as usize,
                 name: String::from("class"),
-                value: String::from(new_val),
+                value: String::from(new_val.as_str()),
             });
         }
     }
+    if let JsValue::Object(obj) = &vm.current_this {
+        obj.borrow_mut().set("__value", JsValue::String(new_val));
+    }
 }
 
 fn cl_add(vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -61,11 +62,11 @@ fn cl_add(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let has = current.split_whitespace().any(|c| c == class);
     if !has {
         let new_val = if current.is_empty() {
-            class
+            JsStr::from(class)
         } else {
-            alloc::format!("{} {}", current, class)
+            current.concat_str(" ").concat_str(&class)
         };
-        set_class_value(vm, &new_val);
+        set_class_value(vm, new_val);
     }
     JsValue::Undefined
 }
@@ -74,8 +75,8 @@ fn cl_remove(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let class = arg_string(args, 0);
     let current = get_class_value(vm);
     let parts: Vec<&str> = current.split_whitespace().filter(|c| *c != class).collect();
-    let new_val = parts.join(" ");
-    set_class_value(vm, &new_val);
+    let new_val = JsStr::from(parts.join(" "));
+    set_class_value(vm, new_val);
     JsValue::Undefined
 }
 
@@ -93,15 +94,15 @@ fn cl_toggle(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     if should_add && !has {
         let new_val = if current.is_empty() {
-            class
+            JsStr::from(class)
         } else {
-            alloc::format!("{} {}", current, class)
+            current.concat_str(" ").concat_str(&class)
         };
-        set_class_value(vm, &new_val);
+        set_class_value(vm, new_val);
         JsValue::Bool(true)
     } else if !should_add && has {
         let parts: Vec<&str> = current.split_whitespace().filter(|c| *c != class).collect();
-        set_class_value(vm, &parts.join(" "));
+        set_class_value(vm, JsStr::from(parts.join(" ")));
         JsValue::Bool(false)
     } else {
         JsValue::Bool(has)
@@ -119,7 +120,7 @@ fn cl_item(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let current = get_class_value(vm);
     let parts: Vec<&str> = current.split_whitespace().collect();
     match parts.get(idx) {
-        Some(s) => JsValue::String(String::from(*s)),
+        Some(s) => JsValue::String(JsStr::from(*s)),
         None => JsValue::Null,
     }
 }
@@ -5,7 +5,7 @@ use alloc::string::String;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::{JsObject, JsArray};
 use libjs::vm::native_fn;
@@ -126,31 +126,31 @@ pub fn make_document(vm: &mut Vm, dom: &Dom, url: &str, cookies: &str) -> JsValu
     let mut obj = JsObject::new();
 
     // Properties.
-    obj.set(String::from("title"), JsValue::String(title));
+    obj.set(String::from("title"), JsValue::String(JsStr::from(title)));
     obj.set(String::from("documentElement"), doc_el);
     obj.set(String::from("body"), body_el);
     obj.set(String::from("head"), head_el);
     // cookie — readable; writes are intercepted by doc_property_hook
-    obj.set(String::from("cookie"), JsValue::String(String::from(cookies)));
-    obj.set(String::from("readyState"), JsValue::String(String::from("complete")));
-    obj.set(String::from("referrer"), JsValue::String(String::new()));
-    obj.set(String::from("domain"), JsValue::String(hostname.clone()));
-    obj.set(String::from("URL"), JsValue::String(href.clone()));
-    obj.set(String::from("characterSet"), JsValue::String(String::from("UTF-8")));
-    obj.set(String::from("contentType"), JsValue::String(String::from("text/html")));
-    obj.set(String::from("compatMode"), JsValue::String(String::from("CSS1Compat")));
+    obj.set(String::from("cookie"), JsValue::String(JsStr::from(cookies)));
+    obj.set(String::from("readyState"), JsValue::String(JsStr::from("complete")));
+    obj.set(String::from("referrer"), JsValue::String(JsStr::from("")));
+    obj.set(String::from("domain"), JsValue::String(JsStr::from(hostname.clone())));
+    obj.set(String::from("URL"), JsValue::String(JsStr::from(href.clone())));
+    obj.set(String::from("characterSet"), JsValue::String(JsStr::from("UTF-8")));
+    obj.set(String::from("contentType"), JsValue::String(JsStr::from("text/html")));
+    obj.set(String::from("compatMode"), JsValue::String(JsStr::from("CSS1Compat")));
     obj.set(String::from("defaultView"), JsValue::Null);
 
     // location sub-object — all fields populated from the current URL.
     let loc = JsValue::new_object();
-    loc.set_property(String::from("href"), JsValue::String(href));
-    loc.set_property(String::from("hostname"), JsValue::String(hostname));
-    loc.set_property(String::from("port"), JsValue::String(port));
-    loc.set_property(String::from("pathname"), JsValue::String(pathname));
-    loc.set_property(String::from("protocol"), JsValue::String(protocol));
-    loc.set_property(String::from("search"), JsValue::String(search));
-    loc.set_property(String::from("hash"), JsValue::String(hash));
-    loc.set_property(String::from("origin"), JsValue::String(origin));
+    loc.set_property(String::from("href"), JsValue::String(JsStr::from(href)));
+    loc.set_property(String::from("hostname"), JsValue::String(JsStr::from(hostname)));
+    loc.set_property(String::from("port"), JsValue::String(JsStr::from(port)));
+    loc.set_property(String::from("pathname"), JsValue::String(JsStr::from(pathname)));
+    loc.set_property(String::from("protocol"), JsValue::String(JsStr::from(protocol)));
+    loc.set_property(String::from("search"), JsValue::String(JsStr::from(search)));
+    loc.set_property(String::from("hash"), JsValue::String(JsStr::from(hash)));
+    loc.set_property(String::from("origin"), JsValue::String(JsStr::from(origin)));
     loc.set_property(String::from("assign"), native_fn("assign", |_,_| JsValue::Undefined));
     loc.set_property(String::from("replace"), native_fn("replace", |_,_| JsValue::Undefined));
     loc.set_property(String::from("reload"), native_fn("reload", |_,_| JsValue::Undefined));
@@ -292,8 +292,8 @@ fn doc_create_text_node(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let mut obj = JsObject::new();
     obj.set(String::from("__nodeId"), JsValue::Number(virtual_id as f64));
     obj.set(String::from("nodeType"), JsValue::Number(3.0));
-    obj.set(String::from("textContent"), JsValue::String(text.clone()));
-    obj.set(String::from("innerText"), JsValue::String(text));
+    obj.set(String::from("textContent"), JsValue::String(JsStr::from(text.clone())));
+    obj.set(String::from("innerText"), JsValue::String(JsStr::from(text)));
     obj.set_hook = Some(dom_property_hook);
     obj.set_hook_data = virtual_id as usize as *mut u8;
     JsValue::Object(Rc::new(RefCell::new(obj)))
@@ -315,14 +315,14 @@ fn doc_create_comment(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let text = arg_string(args, 0);
     let mut obj = JsObject::new();
     obj.set(String::from("nodeType"), JsValue::Number(8.0));
-    obj.set(String::from("textContent"), JsValue::String(text));
+    obj.set(String::from("textContent"), JsValue::String(JsStr::from(text)));
     JsValue::Object(Rc::new(RefCell::new(obj)))
 }
 
 fn doc_create_event(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let typ = arg_string(args, 0);
     let evt = JsValue::new_object();
-    evt.set_property(String::from("type"), JsValue::String(typ));
+    evt.set_property(String::from("type"), JsValue::String(JsStr::from(typ)));
     evt.set_property(String::from("target"), JsValue::Null);
     evt.set_property(String::from("preventDefault"), native_fn("preventDefault", doc_noop));
     evt.set_property(String::from("stopPropagation"), native_fn("stopPropagation", doc_noop));
@@ -391,5 +391,5 @@ fn frag_remove_child(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
 /// Image constructor: `new Image()` → `document.createElement('img')`.
 pub fn native_image_ctor(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
-    doc_create_element(vm, &[JsValue::String(String::from("img"))])
+    doc_create_element(vm, &[JsValue::String(JsStr::from("img"))])
 }
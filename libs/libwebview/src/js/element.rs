@@ -8,7 +8,7 @@ use alloc::string::String;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::{JsObject, JsArray};
 use libjs::vm::native_fn;
@@ -96,14 +96,14 @@ fn make_element_impl(vm: &mut Vm, node_id: i64, include_siblings: bool) -> JsVal
     let inner_html = read_inner_html(vm, node_id);
     let class_name = match read_attribute(vm, node_id, "class") {
         JsValue::String(s) => s,
-        _ => String::new(),
+        _ => JsStr::from(""),
     };
 
     // Helper to read a string attribute or empty string.
-    let attr_or_empty = |vm: &mut Vm, name: &str| -> String {
+    let attr_or_empty = |vm: &mut Vm, name: &str| -> JsStr {
         match read_attribute(vm, node_id, name) {
             JsValue::String(s) => s,
-            _ => String::new(),
+            _ => JsStr::from(""),
         }
     };
 
@@ -133,12 +133,13 @@ fn make_element_impl(vm: &mut Vm, node_id: i64, include_siblings: bool) -> JsVal
 
     // Properties.
     obj.set(String::from("nodeType"), JsValue::Number(node_type));
-    obj.set(String::from("tagName"), JsValue::String(tag_name));
+    obj.set(String::from("tagName"), JsValue::String(JsStr::from(tag_name)));
     obj.set(String::from("id"), JsValue::String(id_val));
     obj.set(String::from("className"), JsValue::String(class_name.clone()));
+    let text = JsStr::from(text);
     obj.set(String::from("textContent"), JsValue::String(text.clone()));
     obj.set(String::from("innerText"), JsValue::String(text));
-    obj.set(String::from("innerHTML"), JsValue::String(inner_html));
+    obj.set(String::from("innerHTML"), JsValue::String(JsStr::from(inner_html)));
     obj.set(String::from("value"), JsValue::String(value_val));
     obj.set(String::from("src"), JsValue::String(src_val));
     obj.set(String::from("href"), JsValue::String(href_val));
@@ -268,9 +269,9 @@ fn el_set_attribute(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     // Update cached properties on `this`.
     if let JsValue::Object(obj) = &vm.current_this {
         let mut o = obj.borrow_mut();
-        if name == "id" { o.set(String::from("id"), JsValue::String(value.clone())); }
-        if name == "class" { o.set(String::from("className"), JsValue::String(value.clone())); }
-        if name == "value" { o.set(String::from("value"), JsValue::String(value)); }
+        if name == "id" { o.set(String::from("id"), JsValue::String(JsStr::from(value.clone()))); }
+        if name == "class" { o.set(String::from("className"), JsValue::String(JsStr::from(value.clone()))); }
+        if name == "value" { o.set(String::from("value"), JsValue::String(JsStr::from(value))); }
     }
     JsValue::Undefined
 }
@@ -480,7 +481,7 @@ fn el_insert_before(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let children_arr = obj.borrow().get("children");
         if let JsValue::Array(arr) = &children_arr {
             let mut a = arr.borrow_mut();
-            let idx = a.elements.iter().position(|el| extract_node_id(el) == ref_id);
+            let idx = a.elements.iter().position(|el| extract_node_id(&el) == ref_id);
             if let Some(i) = idx {
                 a.elements.insert(i, new_node.clone());
             } else {
@@ -523,8 +524,8 @@ fn el_replace_child(vm: &mut Vm, args: &[JsValue]) -> JsValue {
         let children_arr = obj.borrow().get("children");
         if let JsValue::Array(arr) = &children_arr {
             let mut a = arr.borrow_mut();
-            if let Some(idx) = a.elements.iter().position(|el| extract_node_id(el) == old_id) {
-                a.elements[idx] = new_node.clone();
+            if let Some(idx) = a.elements.iter().position(|el| extract_node_id(&el) == old_id) {
+                a.elements.set(idx, new_node.clone());
             }
         }
         let (first, last) = get_first_last(&children_arr);
@@ -579,8 +580,8 @@ fn el_set_text_content(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     if let JsValue::Object(obj) = &vm.current_this {
         let mut o = obj.borrow_mut();
-        o.set(String::from("textContent"), JsValue::String(text.clone()));
-        o.set(String::from("innerText"), JsValue::String(text));
+        o.set(String::from("textContent"), JsValue::String(JsStr::from(text.clone())));
+        o.set(String::from("innerText"), JsValue::String(JsStr::from(text)));
     }
     JsValue::Undefined
 }
@@ -594,7 +595,7 @@ fn el_set_inner_html(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     }
 
     if let JsValue::Object(obj) = &vm.current_this {
-        obj.borrow_mut().set(String::from("innerHTML"), JsValue::String(html));
+        obj.borrow_mut().set(String::from("innerHTML"), JsValue::String(JsStr::from(html)));
     }
     JsValue::Undefined
 }
@@ -614,7 +615,7 @@ fn el_set_style(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let JsValue::Object(obj) = &vm.current_this {
         let o = obj.borrow();
         if let Some(sp) = o.properties.get("style") {
-            sp.value.set_property(prop, JsValue::String(val));
+            sp.value.set_property(prop, JsValue::String(JsStr::from(val)));
         }
     }
     JsValue::Undefined
@@ -635,7 +636,7 @@ fn el_get_client_rects(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
 }
 
 fn el_to_string(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
-    JsValue::String(String::from("[object HTMLElement]"))
+    JsValue::String(JsStr::from("[object HTMLElement]"))
 }
 
 fn el_noop(_vm: &mut Vm, _args: &[JsValue]) -> JsValue { JsValue::Undefined }
@@ -659,9 +660,9 @@ fn extract_node_id(val: &JsValue) -> i64 {
 /// Extract first and last child from a children JsValue (array).
 fn get_first_last(children: &JsValue) -> (JsValue, JsValue) {
     if let JsValue::Array(arr) = children {
-        let elems = &arr.borrow().elements;
-        if !elems.is_empty() {
-            return (elems[0].clone(), elems[elems.len() - 1].clone());
+        let a = arr.borrow();
+        if a.len() > 0 {
+            return (a.get(0), a.get(a.len() - 1));
         }
     }
     (JsValue::Null, JsValue::Null)
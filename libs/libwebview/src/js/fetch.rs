@@ -4,7 +4,7 @@ use alloc::rc::Rc;
 use alloc::string::String;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::JsObject;
 use libjs::vm::native_fn;
@@ -38,10 +38,10 @@ pub fn native_fetch(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     // Perform the request.
     let result = http::http_request(vm, &[
-        JsValue::String(method),
-        JsValue::String(url.clone()),
-        JsValue::String(headers_str),
-        JsValue::String(body),
+        JsValue::String(JsStr::from(method)),
+        JsValue::String(JsStr::from(url.clone())),
+        JsValue::String(JsStr::from(headers_str)),
+        JsValue::String(JsStr::from(body)),
     ]);
 
     let status = result.get_property("status").to_number();
@@ -74,7 +74,7 @@ pub fn native_fetch(vm: &mut Vm, args: &[JsValue]) -> JsValue {
             if let JsValue::Function(f) = reject_fn {
                 let kind = f.borrow().kind.clone();
                 if let libjs::value::FnKind::Native(native) = kind {
-                    let err = JsValue::String(String::from("Network request failed"));
+                    let err = JsValue::String(JsStr::from("Network request failed"));
                     return native(vm, &[err]);
                 }
             }
@@ -87,12 +87,12 @@ fn make_response(status: f64, status_text: &str, url: &str, body: &str) -> JsVal
     let mut obj = JsObject::new();
     obj.set(String::from("ok"), JsValue::Bool(status >= 200.0 && status < 300.0));
     obj.set(String::from("status"), JsValue::Number(status));
-    obj.set(String::from("statusText"), JsValue::String(String::from(status_text)));
-    obj.set(String::from("url"), JsValue::String(String::from(url)));
+    obj.set(String::from("statusText"), JsValue::String(JsStr::from(status_text)));
+    obj.set(String::from("url"), JsValue::String(JsStr::from(url)));
     obj.set(String::from("redirected"), JsValue::Bool(false));
-    obj.set(String::from("type"), JsValue::String(String::from("basic")));
+    obj.set(String::from("type"), JsValue::String(JsStr::from("basic")));
     obj.set(String::from("bodyUsed"), JsValue::Bool(false));
-    obj.set(String::from("__body"), JsValue::String(String::from(body)));
+    obj.set(String::from("__body"), JsValue::String(JsStr::from(body)));
 
     // Headers sub-object.
     let headers = JsValue::new_object();
@@ -105,7 +105,7 @@ fn make_response(status: f64, status_text: &str, url: &str, body: &str) -> JsVal
     obj.set(String::from("text"), native_fn("text", resp_text));
     obj.set(String::from("json"), native_fn("json", resp_json));
     obj.set(String::from("blob"), native_fn("blob", resp_text));
-    obj.set(String::from("arrayBuffer"), native_fn("arrayBuffer", resp_text));
+    obj.set(String::from("arrayBuffer"), native_fn("arrayBuffer", resp_array_buffer));
     obj.set(String::from("clone"), native_fn("clone", resp_clone));
 
     JsValue::Object(Rc::new(RefCell::new(obj)))
@@ -115,12 +115,22 @@ fn resp_text(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let body = if let JsValue::Object(obj) = &vm.current_this {
         obj.borrow().get("__body")
     } else {
-        JsValue::String(String::new())
+        JsValue::String(JsStr::from(""))
     };
     // Wrap in Promise.resolve.
     wrap_promise_resolve(vm, body)
 }
 
+fn resp_array_buffer(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
+    let body = if let JsValue::Object(obj) = &vm.current_this {
+        obj.borrow().get("__body").to_js_string()
+    } else {
+        String::new()
+    };
+    let buffer = vm.new_array_buffer(body.into_bytes());
+    wrap_promise_resolve(vm, buffer)
+}
+
 fn resp_json(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let body_str = if let JsValue::Object(obj) = &vm.current_this {
         obj.borrow().get("__body").to_js_string()
@@ -133,7 +143,7 @@ fn resp_json(vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let parsed = if let JsValue::Function(f) = parse_fn {
         let kind = f.borrow().kind.clone();
         if let libjs::value::FnKind::Native(native) = kind {
-            native(vm, &[JsValue::String(body_str)])
+            native(vm, &[JsValue::String(JsStr::from(body_str))])
         } else {
             JsValue::Undefined
         }
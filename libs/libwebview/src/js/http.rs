@@ -10,7 +10,7 @@ use alloc::string::String;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::{JsObject, FnKind};
 
@@ -52,7 +52,7 @@ pub fn http_request(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     // Return empty response.
     let mut obj = JsObject::new();
     obj.set(String::from("status"), JsValue::Number(0.0));
-    obj.set(String::from("statusText"), JsValue::String(String::new()));
-    obj.set(String::from("body"), JsValue::String(String::new()));
+    obj.set(String::from("statusText"), JsValue::String(JsStr::from("")));
+    obj.set(String::from("body"), JsValue::String(JsStr::from("")));
     JsValue::Object(Rc::new(RefCell::new(obj)))
 }
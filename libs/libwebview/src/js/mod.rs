@@ -14,6 +14,7 @@ mod fetch;
 mod storage;
 mod http;
 mod selector;
+mod script_cache;
 pub mod websocket;
 
 use alloc::collections::BTreeMap;
@@ -23,11 +24,11 @@ use alloc::vec;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::{JsEngine, JsValue, Vm};
+use libjs::{JsEngine, JsStr, JsValue, Vm};
 use libjs::value::JsArray;
 use libjs::vm::native_fn;
 
-use crate::dom::{Dom, NodeId, NodeType, Tag};
+use crate::dom::{Dom, NodeId, NodeType, Tag, STYLE_DIRTY_CHILDREN, STYLE_DIRTY_SELF};
 use crate::css::{Declaration, KeyframeSet};
 use crate::style::{apply_timing, TimingFunction, TransitionDef};
 
@@ -320,6 +321,8 @@ pub struct JsRuntime {
     pub active_animations: Vec<ActiveAnimation>,
     /// Currently running CSS transitions.
     pub active_transitions: Vec<ActiveTransition>,
+    /// Compiled `<script>` bodies, reused across page loads.
+    script_cache: script_cache::ScriptCache,
 }
 
 impl JsRuntime {
@@ -340,6 +343,7 @@ impl JsRuntime {
             ws_registry: Vec::new(),
             active_animations: Vec::new(),
             active_transitions: Vec::new(),
+            script_cache: script_cache::ScriptCache::new(),
         }
     }
 
@@ -350,6 +354,12 @@ impl JsRuntime {
         self.cookies = String::from(cookies);
     }
 
+    /// Also keep compiled scripts in `dir` so later sessions skip compiling
+    /// them; `None` keeps the cache in memory only (the default).
+    pub fn set_script_cache_dir(&mut self, dir: Option<&str>) {
+        self.script_cache.set_disk_dir(dir);
+    }
+
     /// Execute all `<script>` tags in the DOM.
     ///
     /// * `url` — the current page URL, used to populate `window.location` /
@@ -422,8 +432,11 @@ impl JsRuntime {
                 continue;
             }
             anyos_std::println!("[js] eval #{}: {} bytes", idx, script.len());
-            self.engine.eval(script);
+            let chunk = self.script_cache.get_or_compile(&self.engine, url, script);
+            self.engine.execute(chunk);
         }
+        anyos_std::println!("[js] script cache: {} hit(s), {} miss(es)",
+            self.script_cache.hits, self.script_cache.misses);
         if scripts.len() > script_count {
             anyos_std::println!("[js] skipped {} script(s) (limit={})",
                 scripts.len() - script_count, MAX_SCRIPTS);
@@ -578,7 +591,7 @@ impl JsRuntime {
             ws_obj.set_property(String::from("readyState"), JsValue::Number(1.0));
             ws_obj.set_property(
                 String::from("protocol"),
-                JsValue::String(String::from(negotiated_protocol)),
+                JsValue::String(JsStr::from(negotiated_protocol)),
             );
             let cb = ws_obj.get_property("onopen");
             self.fire_ws_callback(cb, &ws_obj, &[]);
@@ -590,9 +603,9 @@ impl JsRuntime {
     pub fn ws_message(&mut self, id: u64, data: &str) {
         if let Some(ws_obj) = self.find_ws(id) {
             let evt = JsValue::new_object();
-            evt.set_property(String::from("data"), JsValue::String(String::from(data)));
-            evt.set_property(String::from("type"), JsValue::String(String::from("message")));
-            evt.set_property(String::from("origin"), JsValue::String(String::new()));
+            evt.set_property(String::from("data"), JsValue::String(JsStr::from(data)));
+            evt.set_property(String::from("type"), JsValue::String(JsStr::from("message")));
+            evt.set_property(String::from("origin"), JsValue::String(JsStr::from("")));
             evt.set_property(String::from("source"), JsValue::Null);
             let cb = ws_obj.get_property("onmessage");
             self.fire_ws_callback(cb, &ws_obj, &[evt]);
@@ -600,10 +613,25 @@ impl JsRuntime {
     }
 
     /// Called by the host when a binary frame is received.
-    /// Fires `onmessage` with the data represented as a JS string (UTF-8 lossy).
+    /// Fires `onmessage` with an `ArrayBuffer` when `binaryType` is
+    /// `"arraybuffer"`, otherwise with the data as a JS string (UTF-8 lossy).
     pub fn ws_message_binary(&mut self, id: u64, data: &[u8]) {
-        let text = core::str::from_utf8(data).unwrap_or("[binary]");
-        self.ws_message(id, text);
+        let ws_obj = match self.find_ws(id) {
+            Some(ws) => ws,
+            None => return,
+        };
+        if ws_obj.get_property("binaryType").to_js_string() != "arraybuffer" {
+            let text = core::str::from_utf8(data).unwrap_or("[binary]");
+            self.ws_message(id, text);
+            return;
+        }
+        let evt = JsValue::new_object();
+        evt.set_property(String::from("data"), self.engine.vm().new_array_buffer(data.to_vec()));
+        evt.set_property(String::from("type"), JsValue::String(JsStr::from("message")));
+        evt.set_property(String::from("origin"), JsValue::String(JsStr::from("")));
+        evt.set_property(String::from("source"), JsValue::Null);
+        let cb = ws_obj.get_property("onmessage");
+        self.fire_ws_callback(cb, &ws_obj, &[evt]);
     }
 
     /// Called by the host when a connection error occurs.
@@ -671,18 +699,23 @@ impl JsRuntime {
                 }
                 DomMutation::SetAttribute { node_id, name, value } => {
                     dom.set_attr(*node_id, name, value);
+                    dom.mark_style_dirty(*node_id, STYLE_DIRTY_SELF);
                 }
                 DomMutation::RemoveAttribute { node_id, name } => {
                     dom.remove_attr(*node_id, name);
+                    dom.mark_style_dirty(*node_id, STYLE_DIRTY_SELF);
                 }
                 DomMutation::SetTextContent { node_id, text } => {
                     dom.set_text(*node_id, text);
+                    dom.mark_style_dirty(*node_id, STYLE_DIRTY_CHILDREN);
                 }
                 DomMutation::AppendChild { parent_id, child_id } => {
                     let real_parent = resolve_id(*parent_id, &id_map);
                     let real_child = resolve_id(*child_id, &id_map);
                     if let (Some(p), Some(c)) = (real_parent, real_child) {
+                        let old = dom.nodes.get(c).and_then(|n| n.parent);
                         dom.append_child(p, c);
+                        mark_moved(dom, old, p, c);
                     }
                 }
                 DomMutation::RemoveChild { parent_id, child_id } => {
@@ -690,6 +723,7 @@ impl JsRuntime {
                     let real_child = resolve_id(*child_id, &id_map);
                     if let (Some(p), Some(c)) = (real_parent, real_child) {
                         dom.remove_child(p, c);
+                        dom.mark_style_dirty(p, STYLE_DIRTY_CHILDREN);
                     }
                 }
                 DomMutation::InsertBefore { parent_id, new_child_id, ref_child_id } => {
@@ -697,7 +731,9 @@ impl JsRuntime {
                     let real_new = resolve_id(*new_child_id, &id_map);
                     let real_ref = resolve_id(*ref_child_id, &id_map);
                     if let (Some(p), Some(n), Some(r)) = (real_parent, real_new, real_ref) {
+                        let old = dom.nodes.get(n).and_then(|n| n.parent);
                         dom.insert_before(p, n, r);
+                        mark_moved(dom, old, p, n);
                     }
                 }
                 DomMutation::ReplaceChild { parent_id, new_child_id, old_child_id } => {
@@ -705,8 +741,10 @@ impl JsRuntime {
                     let real_new = resolve_id(*new_child_id, &id_map);
                     let real_old = resolve_id(*old_child_id, &id_map);
                     if let (Some(p), Some(n), Some(o)) = (real_parent, real_new, real_old) {
+                        let old = dom.nodes.get(n).and_then(|n| n.parent);
                         dom.remove_child(p, o);
                         dom.append_child(p, n);
+                        mark_moved(dom, old, p, n);
                     }
                 }
                 DomMutation::RemoveNode { node_id } => {
@@ -714,6 +752,7 @@ impl JsRuntime {
                         // Remove from parent.
                         if let Some(pid) = dom.nodes.get(real_id).and_then(|n| n.parent) {
                             dom.remove_child(pid, real_id);
+                            dom.mark_style_dirty(pid, STYLE_DIRTY_CHILDREN);
                         }
                     }
                 }
@@ -731,6 +770,7 @@ impl JsRuntime {
                             let fragment = crate::html::parse_fragment(html);
                             dom.adopt_children_from(real_id, &fragment);
                         }
+                        dom.mark_style_dirty(real_id, STYLE_DIRTY_CHILDREN);
                     }
                 }
                 DomMutation::SetStyleProperty { node_id, property, value } => {
@@ -744,6 +784,7 @@ impl JsRuntime {
                             alloc::format!("{}; {}: {}", existing, property, value)
                         };
                         dom.set_attr(real_id, "style", &new_style);
+                        dom.mark_style_dirty(real_id, STYLE_DIRTY_SELF);
                     }
                 }
                 DomMutation::SetCookie { .. } => {
@@ -781,7 +822,7 @@ impl JsRuntime {
 
         // Create event object.
         let evt = JsValue::new_object();
-        evt.set_property(String::from("type"), JsValue::String(String::from(event_name)));
+        evt.set_property(String::from("type"), JsValue::String(JsStr::from(event_name)));
         let target_el = element::make_element(self.engine.vm(), node_id as i64);
         evt.set_property(String::from("target"), target_el.clone());
         evt.set_property(String::from("currentTarget"), target_el);
@@ -1059,13 +1100,13 @@ fn read_attribute(vm: &mut Vm, node_id: i64, name: &str) -> JsValue {
             let nid = node_id as usize;
             if nid < dom.nodes.len() {
                 return match dom.attr(nid, name) {
-                    Some(val) => JsValue::String(String::from(val)),
+                    Some(val) => JsValue::String(JsStr::from(val)),
                     None => JsValue::Null,
                 };
             }
         } else if let Some(vn) = bridge.get_virtual(node_id) {
             for (k, v) in &vn.attrs {
-                if k == name { return JsValue::String(v.clone()); }
+                if k == name { return JsValue::String(JsStr::from(v.clone())); }
             }
             return JsValue::Null;
         }
@@ -1224,6 +1265,16 @@ fn js_escape_string(s: &str) -> String {
     out
 }
 
+/// Flag a node moved from `old_parent` to `parent` for restyling: it may
+/// match different rules and inherit different values there.
+fn mark_moved(dom: &mut Dom, old_parent: Option<NodeId>, parent: NodeId, child: NodeId) {
+    dom.mark_style_dirty(child, STYLE_DIRTY_SELF);
+    dom.mark_style_dirty(parent, STYLE_DIRTY_CHILDREN);
+    if let Some(op) = old_parent {
+        dom.mark_style_dirty(op, STYLE_DIRTY_CHILDREN);
+    }
+}
+
 /// Resolve a (possibly virtual) node ID to a real DOM NodeId.
 fn resolve_id(id: i64, map: &BTreeMap<i64, usize>) -> Option<usize> {
     if id >= 0 {
@@ -1240,9 +1291,9 @@ fn resolve_id(id: i64, map: &BTreeMap<i64, usize>) -> Option<usize> {
 /// Build a CloseEvent-like JS object for `onclose` callbacks.
 fn make_close_event(code: u16, reason: &str, was_clean: bool) -> JsValue {
     let evt = JsValue::new_object();
-    evt.set_property(String::from("type"),     JsValue::String(String::from("close")));
+    evt.set_property(String::from("type"),     JsValue::String(JsStr::from("close")));
     evt.set_property(String::from("code"),     JsValue::Number(code as f64));
-    evt.set_property(String::from("reason"),   JsValue::String(String::from(reason)));
+    evt.set_property(String::from("reason"),   JsValue::String(JsStr::from(reason)));
     evt.set_property(String::from("wasClean"), JsValue::Bool(was_clean));
     evt
 }
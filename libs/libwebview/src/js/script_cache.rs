@@ -0,0 +1,136 @@
+//! Compiled-script cache.
+//!
+//! Pages tend to run the same scripts on every load, so `execute_scripts`
+//! asks this cache for each `<script>` before compiling it.  Entries are
+//! keyed by the script URL plus a hash of its source; a hit hands back the
+//! compiled chunk and skips the lexer, parser and compiler entirely.
+//!
+//! The cache lives for the session in memory.  With a directory set (see
+//! [`ScriptCache::set_disk_dir`]) compiled chunks are also written there in
+//! the `libjs::serialize` format, so a new session starts warm.  Files from
+//! another libjs build fail to decode and are recompiled.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use libjs::{Chunk, JsEngine};
+use libjs::serialize;
+
+/// Compiled scripts kept in memory; the oldest is dropped beyond this.
+const MAX_ENTRIES: usize = 64;
+
+struct Entry {
+    url: String,
+    hash: u64,
+    len: usize,
+    chunk: Chunk,
+}
+
+pub struct ScriptCache {
+    entries: Vec<Entry>,
+    disk_dir: Option<String>,
+    /// Lookups answered without compiling (memory or disk).
+    pub hits: u32,
+    /// Lookups that had to compile.
+    pub misses: u32,
+}
+
+impl ScriptCache {
+    pub fn new() -> Self {
+        Self { entries: Vec::new(), disk_dir: None, hits: 0, misses: 0 }
+    }
+
+    /// Also persist compiled scripts under `dir` (e.g. `"/tmp"`), or stop
+    /// doing so with `None`.
+    pub fn set_disk_dir(&mut self, dir: Option<&str>) {
+        self.disk_dir = dir.map(String::from);
+    }
+
+    /// Compiled chunk for `source`, loaded from `url`; compiles (and
+    /// caches) it with `engine` on a miss.
+    pub fn get_or_compile(&mut self, engine: &JsEngine, url: &str, source: &str) -> Chunk {
+        let hash = fnv1a64(source.as_bytes());
+        if let Some(e) = self.entries.iter()
+            .find(|e| e.hash == hash && e.len == source.len() && e.url == url)
+        {
+            self.hits += 1;
+            return e.chunk.clone();
+        }
+
+        let path = self.disk_dir.as_deref().map(|dir| disk_path(dir, url, hash));
+        if let Some(chunk) = path.as_deref().and_then(|p| load(p, hash, source.len())) {
+            self.hits += 1;
+            self.insert(url, hash, source.len(), chunk.clone());
+            return chunk;
+        }
+
+        self.misses += 1;
+        let chunk = engine.compile(source);
+        if let Some(p) = &path {
+            store(p, hash, source.len(), &chunk);
+        }
+        self.insert(url, hash, source.len(), chunk.clone());
+        chunk
+    }
+
+    fn insert(&mut self, url: &str, hash: u64, len: usize, chunk: Chunk) {
+        if self.entries.len() >= MAX_ENTRIES {
+            self.entries.remove(0);
+        }
+        self.entries.push(Entry { url: String::from(url), hash, len, chunk });
+    }
+}
+
+// ═══════════════════════════════════════════════════════════
+// On-disk entries
+// ═══════════════════════════════════════════════════════════
+
+// File layout: source_hash:u64 source_len:u32 serialized_chunk.
+
+/// `<dir>/surf_jsc_<hash of url and source>.bin`.
+fn disk_path(dir: &str, url: &str, hash: u64) -> String {
+    let mut key = fnv1a64(url.as_bytes());
+    key ^= hash.rotate_left(29);
+    let mut path = String::from(dir.trim_end_matches('/'));
+    path.push_str("/surf_jsc_");
+    for i in (0..16).rev() {
+        let nib = ((key >> (i * 4)) & 0xF) as u8;
+        path.push(if nib < 10 { (b'0' + nib) as char } else { (b'a' + nib - 10) as char });
+    }
+    path.push_str(".bin");
+    path
+}
+
+fn load(path: &str, hash: u64, len: usize) -> Option<Chunk> {
+    let data = anyos_std::fs::read_to_vec(path).ok()?;
+    if data.len() < 12 {
+        return None;
+    }
+    let mut h = [0u8; 8];
+    h.copy_from_slice(&data[..8]);
+    let mut l = [0u8; 4];
+    l.copy_from_slice(&data[8..12]);
+    if u64::from_le_bytes(h) != hash || u32::from_le_bytes(l) as usize != len {
+        return None;
+    }
+    serialize::decode(&data[12..])
+}
+
+fn store(path: &str, hash: u64, len: usize, chunk: &Chunk) {
+    let body = serialize::encode(chunk);
+    let mut data = Vec::with_capacity(12 + body.len());
+    data.extend_from_slice(&hash.to_le_bytes());
+    data.extend_from_slice(&(len as u32).to_le_bytes());
+    data.extend_from_slice(&body);
+    let _ = anyos_std::fs::write_bytes(path, &data);
+}
+
+/// 64-bit FNV-1a.
+fn fnv1a64(bytes: &[u8]) -> u64 {
+    let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+    for &b in bytes {
+        h ^= b as u64;
+        h = h.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    h
+}
@@ -14,10 +14,9 @@
 
 use alloc::rc::Rc;
 use alloc::string::String;
-use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::JsObject;
 use libjs::vm::native_fn;
@@ -44,7 +43,7 @@ pub fn make_storage(origin: &str, persistent: bool) -> JsValue {
         if let Ok(contents) = anyos_std::fs::read_to_string(&path) {
             load_entries_into(&obj, &contents);
         }
-        obj.set(String::from("__path"), JsValue::String(path));
+        obj.set(String::from("__path"), JsValue::String(JsStr::from(path)));
     }
 
     obj.set(String::from("getItem"), native_fn("getItem", storage_get_item));
@@ -125,7 +124,7 @@ fn load_entries_into(obj: &JsObject, contents: &str) {
         if let Some(tab_pos) = line.find('\t') {
             let key = unescape(&line[..tab_pos]);
             let val = unescape(&line[tab_pos + 1..]);
-            data.set_property(key, JsValue::String(val));
+            data.set_property(key, JsValue::String(JsStr::from(val)));
         }
     }
 }
@@ -177,7 +176,7 @@ fn get_path(vm: &Vm) -> String {
     if let JsValue::Object(obj) = &vm.current_this {
         let o = obj.borrow();
         if let Some(p) = o.properties.get("__path") {
-            if let JsValue::String(s) = &p.value { return s.clone(); }
+            if let JsValue::String(s) = &p.value { return String::from(s.as_str()); }
         }
     }
     String::new()
@@ -201,7 +200,7 @@ fn storage_set_item(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let key = arg_string(args, 0);
     let val = arg_string(args, 1);
     if let Some(data) = get_data(vm) {
-        data.set_property(key, JsValue::String(val));
+        data.set_property(key, JsValue::String(JsStr::from(val)));
     }
     persist(vm);
     JsValue::Undefined
@@ -230,10 +229,9 @@ fn storage_key(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let idx = args.first().map(|v| v.to_number() as usize).unwrap_or(0);
     if let Some(data) = get_data(vm) {
         if let JsValue::Object(obj) = &data {
-            let o = obj.borrow();
-            let keys: Vec<&String> = o.properties.keys().collect();
-            if let Some(k) = keys.get(idx) {
-                return JsValue::String((*k).clone());
+            let key = obj.borrow().properties.keys().nth(idx).cloned();
+            if let Some(k) = key {
+                return JsValue::String(k);
             }
         }
     }
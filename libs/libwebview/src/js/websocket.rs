@@ -15,7 +15,7 @@ use alloc::vec;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::JsObject;
 use libjs::vm::native_fn;
@@ -55,10 +55,7 @@ fn ws_ctor(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     // Optional sub-protocols (string or array of strings).
     let protocols: Vec<String> = match args.get(1) {
-        Some(JsValue::String(s)) => {
-            let s = s.clone();
-            vec![s]
-        }
+        Some(JsValue::String(s)) => vec![String::from(s.as_str())],
         Some(JsValue::Array(arr)) => arr
             .borrow()
             .elements
@@ -80,11 +77,11 @@ fn ws_ctor(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     // State.
     obj.set(String::from("readyState"),     JsValue::Number(0.0)); // CONNECTING
-    obj.set(String::from("url"),            JsValue::String(url.clone()));
-    obj.set(String::from("protocol"),       JsValue::String(String::new()));
-    obj.set(String::from("extensions"),     JsValue::String(String::new()));
+    obj.set(String::from("url"),            JsValue::String(JsStr::from(url.clone())));
+    obj.set(String::from("protocol"),       JsValue::String(JsStr::from("")));
+    obj.set(String::from("extensions"),     JsValue::String(JsStr::from("")));
     obj.set(String::from("bufferedAmount"), JsValue::Number(0.0));
-    obj.set(String::from("binaryType"),     JsValue::String(String::from("blob")));
+    obj.set(String::from("binaryType"),     JsValue::String(JsStr::from("blob")));
 
     // Internal: unique socket ID used to route callbacks back to this object.
     obj.set(String::from("_ws_id"), JsValue::Number(ws_id as f64));
@@ -122,9 +119,13 @@ fn ws_ctor(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 // WebSocket methods
 // ═══════════════════════════════════════════════════════════
 
-/// `ws.send(data)` — queue a text frame to be sent by surf.
+/// `ws.send(data)` — queue a frame to be sent by surf: binary for an
+/// `ArrayBuffer`, typed array or `DataView`, text for anything else.
 fn ws_send(vm: &mut Vm, args: &[JsValue]) -> JsValue {
-    let data = arg_string(args, 0);
+    let (data, is_binary) = match args.first().and_then(|v| v.view()) {
+        Some(view) => (view.to_bytes(), true),
+        None => (arg_string(args, 0).into_bytes(), false),
+    };
     let ws_id = get_this_ws_id(vm);
     if ws_id == 0 { return JsValue::Undefined; }
 
@@ -135,8 +136,8 @@ fn ws_send(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     if let Some(bridge) = get_bridge(vm) {
         bridge.pending_ws_sends.push(PendingWsSend {
             id: ws_id,
-            data: data.into_bytes(),
-            is_binary: false,
+            data,
+            is_binary,
         });
     }
     JsValue::Undefined
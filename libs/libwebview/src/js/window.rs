@@ -6,7 +6,7 @@ use alloc::vec;
 use alloc::vec::Vec;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::JsObject;
 use libjs::vm::native_fn;
@@ -31,15 +31,15 @@ pub fn make_window(_vm: &mut Vm, document: JsValue, origin: &str) -> JsValue {
 
     // navigator.
     let nav = JsValue::new_object();
-    nav.set_property(String::from("userAgent"), JsValue::String(String::from("anyOS Surf/1.0")));
-    nav.set_property(String::from("language"), JsValue::String(String::from("en-US")));
-    nav.set_property(String::from("languages"), make_array(vec![JsValue::String(String::from("en-US"))]));
-    nav.set_property(String::from("platform"), JsValue::String(String::from("anyOS")));
+    nav.set_property(String::from("userAgent"), JsValue::String(JsStr::from("anyOS Surf/1.0")));
+    nav.set_property(String::from("language"), JsValue::String(JsStr::from("en-US")));
+    nav.set_property(String::from("languages"), make_array(vec![JsValue::String(JsStr::from("en-US"))]));
+    nav.set_property(String::from("platform"), JsValue::String(JsStr::from("anyOS")));
     nav.set_property(String::from("cookieEnabled"), JsValue::Bool(true));
     nav.set_property(String::from("onLine"), JsValue::Bool(true));
-    nav.set_property(String::from("vendor"), JsValue::String(String::from("anyOS")));
-    nav.set_property(String::from("appName"), JsValue::String(String::from("Surf")));
-    nav.set_property(String::from("appVersion"), JsValue::String(String::from("1.0")));
+    nav.set_property(String::from("vendor"), JsValue::String(JsStr::from("anyOS")));
+    nav.set_property(String::from("appName"), JsValue::String(JsStr::from("Surf")));
+    nav.set_property(String::from("appVersion"), JsValue::String(JsStr::from("1.0")));
     obj.set(String::from("navigator"), nav);
 
     // screen.
@@ -51,7 +51,7 @@ pub fn make_window(_vm: &mut Vm, document: JsValue, origin: &str) -> JsValue {
     screen.set_property(String::from("colorDepth"), JsValue::Number(32.0));
     screen.set_property(String::from("pixelDepth"), JsValue::Number(32.0));
     let orient = JsValue::new_object();
-    orient.set_property(String::from("type"), JsValue::String(String::from("landscape-primary")));
+    orient.set_property(String::from("type"), JsValue::String(JsStr::from("landscape-primary")));
     orient.set_property(String::from("angle"), JsValue::Number(0.0));
     screen.set_property(String::from("orientation"), orient);
     obj.set(String::from("screen"), screen);
@@ -195,7 +195,7 @@ fn win_noop(_vm: &mut Vm, _args: &[JsValue]) -> JsValue { JsValue::Undefined }
 fn win_noop_obj(_vm: &mut Vm, _args: &[JsValue]) -> JsValue { JsValue::new_object() }
 
 fn win_passthrough(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
-    args.first().cloned().unwrap_or(JsValue::String(String::new()))
+    args.first().cloned().unwrap_or(JsValue::String(JsStr::from("")))
 }
 
 fn win_get_computed_style(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
@@ -214,7 +214,7 @@ fn win_match_media(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let q = arg_string(args, 0);
     let mql = JsValue::new_object();
     mql.set_property(String::from("matches"), JsValue::Bool(false));
-    mql.set_property(String::from("media"), JsValue::String(q));
+    mql.set_property(String::from("media"), JsValue::String(JsStr::from(q)));
     mql.set_property(String::from("addListener"), native_fn("addListener", win_noop));
     mql.set_property(String::from("removeListener"), native_fn("removeListener", win_noop));
     mql.set_property(String::from("addEventListener"), native_fn("addEventListener", win_noop));
@@ -224,7 +224,7 @@ fn win_match_media(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
 fn win_get_selection(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let sel = JsValue::new_object();
-    sel.set_property(String::from("toString"), native_fn("toString", |_,_| JsValue::String(String::new())));
+    sel.set_property(String::from("toString"), native_fn("toString", |_,_| JsValue::String(JsStr::from(""))));
     sel.set_property(String::from("rangeCount"), JsValue::Number(0.0));
     sel
 }
@@ -249,7 +249,7 @@ fn win_custom_event(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let typ = arg_string(args, 0);
     let opts = args.get(1).cloned().unwrap_or(JsValue::new_object());
     let evt = JsValue::new_object();
-    evt.set_property(String::from("type"), JsValue::String(typ));
+    evt.set_property(String::from("type"), JsValue::String(JsStr::from(typ)));
     evt.set_property(String::from("detail"), opts.get_property("detail"));
     evt.set_property(String::from("bubbles"), JsValue::Bool(opts.get_property("bubbles").to_boolean()));
     evt.set_property(String::from("cancelable"), JsValue::Bool(opts.get_property("cancelable").to_boolean()));
@@ -264,7 +264,7 @@ fn win_event(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let typ = arg_string(args, 0);
     let opts = args.get(1).cloned().unwrap_or(JsValue::new_object());
     let evt = JsValue::new_object();
-    evt.set_property(String::from("type"), JsValue::String(typ));
+    evt.set_property(String::from("type"), JsValue::String(JsStr::from(typ)));
     evt.set_property(String::from("bubbles"), JsValue::Bool(opts.get_property("bubbles").to_boolean()));
     evt.set_property(String::from("cancelable"), JsValue::Bool(opts.get_property("cancelable").to_boolean()));
     evt.set_property(String::from("target"), JsValue::Null);
@@ -277,12 +277,12 @@ fn win_event(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
 fn win_url_ctor(_vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let url = arg_string(args, 0);
     let u = JsValue::new_object();
-    u.set_property(String::from("href"), JsValue::String(url.clone()));
+    u.set_property(String::from("href"), JsValue::String(JsStr::from(url.clone())));
     u.set_property(String::from("toString"), native_fn("toString", |vm, _| {
         if let JsValue::Object(o) = &vm.current_this {
             return o.borrow().get("href");
         }
-        JsValue::String(String::new())
+        JsValue::String(JsStr::from(""))
     }));
     u
 }
@@ -296,7 +296,7 @@ fn win_text_encoder(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
 fn win_text_decoder(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     let dec = JsValue::new_object();
     dec.set_property(String::from("decode"), native_fn("decode", |_, args| {
-        args.first().map(|v| JsValue::String(v.to_js_string())).unwrap_or(JsValue::String(String::new()))
+        args.first().map(|v| JsValue::String(JsStr::from(v.to_js_string()))).unwrap_or(JsValue::String(JsStr::from("")))
     }));
     dec
 }
@@ -7,7 +7,7 @@ use alloc::rc::Rc;
 use alloc::string::String;
 use core::cell::RefCell;
 
-use libjs::JsValue;
+use libjs::{JsStr, JsValue};
 use libjs::Vm;
 use libjs::value::{JsObject, FnKind};
 use libjs::vm::native_fn;
@@ -26,19 +26,19 @@ fn xhr_ctor(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
     // State.
     obj.set(String::from("readyState"), JsValue::Number(0.0));
     obj.set(String::from("status"), JsValue::Number(0.0));
-    obj.set(String::from("statusText"), JsValue::String(String::new()));
-    obj.set(String::from("responseText"), JsValue::String(String::new()));
+    obj.set(String::from("statusText"), JsValue::String(JsStr::from("")));
+    obj.set(String::from("responseText"), JsValue::String(JsStr::from("")));
     obj.set(String::from("responseXML"), JsValue::Null);
-    obj.set(String::from("responseType"), JsValue::String(String::new()));
-    obj.set(String::from("response"), JsValue::String(String::new()));
-    obj.set(String::from("responseURL"), JsValue::String(String::new()));
+    obj.set(String::from("responseType"), JsValue::String(JsStr::from("")));
+    obj.set(String::from("response"), JsValue::String(JsStr::from("")));
+    obj.set(String::from("responseURL"), JsValue::String(JsStr::from("")));
     obj.set(String::from("timeout"), JsValue::Number(0.0));
     obj.set(String::from("withCredentials"), JsValue::Bool(false));
     obj.set(String::from("upload"), JsValue::new_object());
 
     // Internal state.
-    obj.set(String::from("_method"), JsValue::String(String::from("GET")));
-    obj.set(String::from("_url"), JsValue::String(String::new()));
+    obj.set(String::from("_method"), JsValue::String(JsStr::from("GET")));
+    obj.set(String::from("_url"), JsValue::String(JsStr::from("")));
     obj.set(String::from("_async"), JsValue::Bool(true));
     obj.set(String::from("_headers"), JsValue::new_object());
     obj.set(String::from("_sent"), JsValue::Bool(false));
@@ -81,16 +81,16 @@ fn xhr_open(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let url = arg_string(args, 1);
     let is_async = args.get(2).map(|v| v.to_boolean()).unwrap_or(true);
 
-    set_this_prop(vm, "_method", JsValue::String(if method.is_empty() { String::from("GET") } else { method }));
-    set_this_prop(vm, "_url", JsValue::String(url));
+    set_this_prop(vm, "_method", JsValue::String(if method.is_empty() { JsStr::from(String::from("GET")) } else { JsStr::from(method) }));
+    set_this_prop(vm, "_url", JsValue::String(JsStr::from(url)));
     set_this_prop(vm, "_async", JsValue::Bool(is_async));
     set_this_prop(vm, "_headers", JsValue::new_object());
     set_this_prop(vm, "_sent", JsValue::Bool(false));
     set_this_prop(vm, "readyState", JsValue::Number(1.0));
     set_this_prop(vm, "status", JsValue::Number(0.0));
-    set_this_prop(vm, "statusText", JsValue::String(String::new()));
-    set_this_prop(vm, "responseText", JsValue::String(String::new()));
-    set_this_prop(vm, "response", JsValue::String(String::new()));
+    set_this_prop(vm, "statusText", JsValue::String(JsStr::from("")));
+    set_this_prop(vm, "responseText", JsValue::String(JsStr::from("")));
+    set_this_prop(vm, "response", JsValue::String(JsStr::from("")));
 
     fire_callback(vm, "onreadystatechange");
     JsValue::Undefined
@@ -100,7 +100,7 @@ fn xhr_set_request_header(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let name = arg_string(args, 0);
     let value = arg_string(args, 1);
     let headers = get_this_prop(vm, "_headers");
-    headers.set_property(name, JsValue::String(value));
+    headers.set_property(name, JsValue::String(JsStr::from(value)));
     JsValue::Undefined
 }
 
@@ -124,10 +124,10 @@ fn xhr_send(vm: &mut Vm, args: &[JsValue]) -> JsValue {
 
     // Perform the HTTP request via the bridge.
     let result = http::http_request(vm, &[
-        JsValue::String(method),
-        JsValue::String(url),
-        JsValue::String(headers_str),
-        JsValue::String(body),
+        JsValue::String(JsStr::from(method)),
+        JsValue::String(JsStr::from(url)),
+        JsValue::String(JsStr::from(headers_str)),
+        JsValue::String(JsStr::from(body)),
     ]);
 
     // readyState = 3 (LOADING).
@@ -141,9 +141,9 @@ fn xhr_send(vm: &mut Vm, args: &[JsValue]) -> JsValue {
     let resp_body = result.get_property("body").to_js_string();
 
     set_this_prop(vm, "status", JsValue::Number(status));
-    set_this_prop(vm, "statusText", JsValue::String(status_text));
-    set_this_prop(vm, "responseText", JsValue::String(resp_body.clone()));
-    set_this_prop(vm, "response", JsValue::String(resp_body));
+    set_this_prop(vm, "statusText", JsValue::String(JsStr::from(status_text)));
+    set_this_prop(vm, "responseText", JsValue::String(JsStr::from(resp_body.clone())));
+    set_this_prop(vm, "response", JsValue::String(JsStr::from(resp_body)));
 
     // readyState = 4 (DONE).
     set_this_prop(vm, "readyState", JsValue::Number(4.0));
@@ -171,7 +171,7 @@ fn xhr_get_response_header(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
 }
 
 fn xhr_get_all_response_headers(_vm: &mut Vm, _args: &[JsValue]) -> JsValue {
-    JsValue::String(String::new())
+    JsValue::String(JsStr::from(""))
 }
 
 fn xhr_noop(_vm: &mut Vm, _args: &[JsValue]) -> JsValue { JsValue::Undefined }
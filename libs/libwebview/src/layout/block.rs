@@ -15,6 +15,7 @@ use super::{
     link_href, list_marker_for, image_dimensions,
     layout_children,
 };
+use super::cache::{LayoutCache, patch_boundaries};
 use super::flex::layout_flex;
 use super::grid::layout_grid;
 
@@ -22,7 +23,22 @@ use super::grid::layout_grid;
 ///
 /// `viewport_w` is the full viewport width, passed down to child layout calls
 /// so that `position:fixed` descendants can be positioned correctly.
-pub fn build_block(dom: &Dom, styles: &[ComputedStyle], node_id: NodeId, available_width: i32, images: &ImageCache, viewport_w: i32) -> LayoutBox {
+///
+/// Returns last frame's box from `cache` when the node's subtree is
+/// unchanged and `available_width` is the same.
+pub fn build_block(dom: &Dom, styles: &[ComputedStyle], node_id: NodeId, available_width: i32, images: &ImageCache, cache: &mut LayoutCache, viewport_w: i32) -> LayoutBox {
+    if let Some(mut bx) = cache.take(node_id, available_width, viewport_w, false) {
+        if cache.needs_patch(node_id) {
+            patch_boundaries(&mut bx, dom, styles, images, cache);
+        }
+        return bx;
+    }
+    let mut bx = build_block_box(dom, styles, node_id, available_width, images, cache, viewport_w);
+    cache.stamp(&mut bx, available_width, viewport_w, false);
+    bx
+}
+
+fn build_block_box(dom: &Dom, styles: &[ComputedStyle], node_id: NodeId, available_width: i32, images: &ImageCache, cache: &mut LayoutCache, viewport_w: i32) -> LayoutBox {
     let style = &styles[node_id];
     let tag = dom.tag(node_id);
 
@@ -43,6 +59,7 @@ pub fn build_block(dom: &Dom, styles: &[ComputedStyle], node_id: NodeId, availab
         || matches!(style.overflow_y, OverflowVal::Hidden);
     bx.visibility_hidden = matches!(style.visibility, Visibility::Hidden | Visibility::Collapse);
     bx.opacity = style.opacity;
+    bx.animated = !style.animations.is_empty();
     bx.margin = edges_from(
         style.margin_top, style.margin_right,
         style.margin_bottom, style.margin_left,
@@ -154,11 +171,11 @@ pub fn build_block(dom: &Dom, styles: &[ComputedStyle], node_id: NodeId, availab
     // Lay out children — dispatch to flex, grid, or block flow.
     let children: Vec<NodeId> = dom.get(node_id).children.iter().copied().collect();
     let content_h = if matches!(style.display, Display::Flex | Display::InlineFlex) {
-        layout_flex(dom, styles, &children, inner_w, &mut bx, images, viewport_w)
+        layout_flex(dom, styles, &children, inner_w, &mut bx, images, cache, viewport_w)
     } else if matches!(style.display, Display::Grid | Display::InlineGrid) {
-        layout_grid(dom, styles, &children, inner_w, &mut bx, images, viewport_w)
+        layout_grid(dom, styles, &children, inner_w, &mut bx, images, cache, viewport_w)
     } else {
-        layout_children(dom, styles, &children, inner_w, &mut bx, node_id, images, viewport_w)
+        layout_children(dom, styles, &children, inner_w, &mut bx, node_id, images, cache, viewport_w)
     };
 
     // ---- Height resolution ----
@@ -0,0 +1,257 @@
+//! Layout box reuse across relayouts.
+//!
+//! `build_block` and `layout_table` stamp every box they return with a
+//! `LayoutKey`: the constraints it was laid out under plus its geometry
+//! before the parent positioned (or stretched) it.  Between frames the old
+//! tree is handed to [`LayoutCache::begin`], which files its top-level
+//! boxes by `NodeId`.  When the new layout asks for a node whose subtree is
+//! clean under the same constraints, the old box is moved back in whole;
+//! boxes of dirty nodes are split open so their clean descendants can still
+//! be reused.  Nothing is copied: a box lives either in the old tree, in the
+//! cache or in the new tree.
+//!
+//! A node is dirty when it was restyled, flagged in `Dom::style_dirty`
+//! (DOM mutation, image load) or when its parent's child list changed, and
+//! dirtiness spreads to all ancestors — except across an element with a
+//! fixed width and height.  Such a relayout boundary cannot change size, so
+//! its ancestors are reused as they are and only the boundary is rebuilt
+//! in place.
+
+use alloc::collections::BTreeMap;
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::dom::{Dom, NodeId, NodeType};
+use crate::style::{ComputedStyle, Display};
+use crate::ImageCache;
+
+use super::{LayoutBox, BoxType};
+use super::block::build_block;
+use super::table::layout_table;
+
+/// Constraints and pristine geometry of a box built by `build_block` or
+/// `layout_table`.
+#[derive(Clone, Copy)]
+pub struct LayoutKey {
+    pub available_width: i32,
+    pub viewport_w: i32,
+    pub table: bool,
+    x: i32,
+    y: i32,
+    width: i32,
+    height: i32,
+    box_type: BoxType,
+}
+
+// Per-node flags.
+/// The node's box must be rebuilt.
+const DIRTY: u8 = 1;
+/// A relayout boundary below this node must be rebuilt in place.
+const HAS_BOUNDARY: u8 = 2;
+/// This node is a relayout boundary whose contents changed.
+const BOUNDARY: u8 = 4;
+
+pub struct LayoutCache {
+    /// Boxes from the last frame still up for reuse.
+    slots: BTreeMap<NodeId, LayoutBox>,
+    flags: Vec<u8>,
+    /// Boxes moved over from the last frame by the current layout.
+    pub reused: usize,
+    /// Boxes built from scratch by the current layout.
+    pub built: usize,
+}
+
+impl LayoutCache {
+    pub fn new() -> Self {
+        Self { slots: BTreeMap::new(), flags: Vec::new(), reused: 0, built: 0 }
+    }
+
+    /// Forget everything (new page).
+    pub fn clear(&mut self) {
+        self.slots.clear();
+        self.flags.clear();
+    }
+
+    /// Prepare for a layout of `dom`, offering the boxes of `old_root`.
+    ///
+    /// `restyled[id]` marks nodes whose style was recomputed since the old
+    /// tree was built; `dom.style_dirty` must still hold this frame's flags.
+    pub fn begin(
+        &mut self,
+        dom: &Dom,
+        styles: &[ComputedStyle],
+        restyled: &[bool],
+        old_root: Option<LayoutBox>,
+    ) {
+        self.slots.clear();
+        self.reused = 0;
+        self.built = 0;
+        let count = dom.nodes.len();
+        self.flags = vec![0u8; count];
+
+        // Nodes whose own inputs changed.  A changed child list can renumber
+        // list items and move children around, so the children count too.
+        let mut changed = vec![false; count];
+        for id in 0..count {
+            let f = dom.style_dirty.get(id).copied().unwrap_or(0);
+            if f != 0 || restyled.get(id).copied().unwrap_or(true) {
+                changed[id] = true;
+            }
+            if f & crate::dom::STYLE_DIRTY_CHILDREN != 0 {
+                for &c in &dom.nodes[id].children {
+                    if c < count {
+                        changed[c] = true;
+                    }
+                }
+            }
+        }
+
+        for id in 0..count {
+            if !changed[id] {
+                continue;
+            }
+            self.flags[id] |= DIRTY;
+            // Walk up; past a boundary, ancestors only need patching.
+            let mut flag = DIRTY;
+            let mut cur = id;
+            while let Some(pid) = dom.nodes[cur].parent {
+                if pid >= count {
+                    break;
+                }
+                if flag == DIRTY && !changed[cur] && is_boundary(dom, styles, cur) {
+                    self.flags[cur] |= BOUNDARY;
+                    flag = HAS_BOUNDARY;
+                }
+                if self.flags[pid] & flag != 0 {
+                    break;
+                }
+                self.flags[pid] |= flag;
+                cur = pid;
+            }
+        }
+
+        if let Some(root) = old_root {
+            self.harvest(root);
+        }
+    }
+
+    /// Release boxes the new layout did not claim.
+    pub fn finish(&mut self) {
+        self.slots.clear();
+    }
+
+    /// Reuse last frame's box for `node_id` if it is clean and was built
+    /// under the same constraints.
+    pub(super) fn take(&mut self, node_id: NodeId, available_width: i32, viewport_w: i32, table: bool) -> Option<LayoutBox> {
+        let key = self.slots.get(&node_id)?.layout_key?;
+        if self.flag(node_id) & DIRTY != 0 {
+            // Rebuilt this frame: offer its descendants instead.
+            let old = self.slots.remove(&node_id)?;
+            self.harvest(old);
+            return None;
+        }
+        if key.available_width != available_width || key.viewport_w != viewport_w || key.table != table {
+            // Leave it for a call with matching constraints (e.g. the final
+            // pass after a shrink-to-fit trial).
+            return None;
+        }
+        let mut bx = self.slots.remove(&node_id)?;
+        bx.x = key.x;
+        bx.y = key.y;
+        bx.width = key.width;
+        bx.height = key.height;
+        bx.box_type = key.box_type;
+        self.reused += 1;
+        Some(bx)
+    }
+
+    /// Record the constraints of a freshly built box.
+    pub(super) fn stamp(&mut self, bx: &mut LayoutBox, available_width: i32, viewport_w: i32, table: bool) {
+        bx.layout_key = Some(LayoutKey {
+            available_width,
+            viewport_w,
+            table,
+            x: bx.x,
+            y: bx.y,
+            width: bx.width,
+            height: bx.height,
+            box_type: bx.box_type,
+        });
+        self.built += 1;
+    }
+
+    /// Whether a reused box for `node_id` contains boundaries to rebuild.
+    pub(super) fn needs_patch(&self, node_id: NodeId) -> bool {
+        self.flag(node_id) & HAS_BOUNDARY != 0
+    }
+
+    fn flag(&self, node_id: NodeId) -> u8 {
+        self.flags.get(node_id).copied().unwrap_or(DIRTY)
+    }
+
+    /// File the cacheable boxes below `bx` by node.
+    fn harvest(&mut self, mut bx: LayoutBox) {
+        for child in bx.children.drain(..) {
+            match (child.node_id, child.layout_key) {
+                (Some(id), Some(_)) if !self.slots.contains_key(&id) => {
+                    self.slots.insert(id, child);
+                }
+                _ => self.harvest(child),
+            }
+        }
+    }
+}
+
+/// Rebuild the changed relayout boundaries inside a reused box, keeping
+/// the position and size its parent gave them.
+pub(super) fn patch_boundaries(
+    bx: &mut LayoutBox,
+    dom: &Dom,
+    styles: &[ComputedStyle],
+    images: &ImageCache,
+    cache: &mut LayoutCache,
+) {
+    for child in bx.children.iter_mut() {
+        let id = match child.node_id {
+            Some(id) => id,
+            None => {
+                patch_boundaries(child, dom, styles, images, cache);
+                continue;
+            }
+        };
+        let flag = cache.flag(id);
+        if flag & BOUNDARY != 0 {
+            if let Some(key) = child.layout_key {
+                let old = core::mem::replace(child, LayoutBox::new(None, BoxType::Block));
+                let (x, y, w, h, bt) = (old.x, old.y, old.width, old.height, old.box_type);
+                cache.slots.insert(id, old);
+                let mut fresh = if key.table {
+                    layout_table(dom, styles, id, key.available_width, images, cache, key.viewport_w)
+                } else {
+                    build_block(dom, styles, id, key.available_width, images, cache, key.viewport_w)
+                };
+                fresh.x = x;
+                fresh.y = y;
+                fresh.width = w;
+                fresh.height = h;
+                fresh.box_type = bt;
+                *child = fresh;
+                continue;
+            }
+        }
+        if flag & HAS_BOUNDARY != 0 {
+            patch_boundaries(child, dom, styles, images, cache);
+        }
+    }
+}
+
+/// An element whose size does not depend on its contents.
+fn is_boundary(dom: &Dom, styles: &[ComputedStyle], id: NodeId) -> bool {
+    let s = &styles[id];
+    matches!(dom.nodes[id].node_type, NodeType::Element { .. })
+        && matches!(s.display, Display::Block | Display::Flex | Display::Grid | Display::InlineBlock)
+        && s.width.map_or(false, |w| w > 0)
+        && s.height.is_some()
+        && s.max_width.is_none()
+        && s.max_height.is_none()
+}
@@ -11,6 +11,7 @@ use crate::ImageCache;
 
 use super::LayoutBox;
 use super::block::build_block;
+use super::cache::LayoutCache;
 
 struct FlexItem {
     node_id: NodeId,
@@ -41,6 +42,7 @@ pub fn layout_flex(
     available_width: i32,
     parent: &mut LayoutBox,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     viewport_w: i32,
 ) -> i32 {
     let parent_style_idx = parent.node_id.unwrap_or(0);
@@ -89,7 +91,7 @@ pub fn layout_flex(
             } else if let Some((px100, pct100)) = st.width_calc {
                 item.main_base = px100 / 100 + (available_width as i64 * pct100 as i64 / 10000) as i32;
             } else {
-                let child_box = build_block(dom, styles, item.node_id, available_width, images, viewport_w);
+                let child_box = build_block(dom, styles, item.node_id, available_width, images, cache, viewport_w);
                 item.main_base = child_box.width + child_box.margin.left + child_box.margin.right;
                 item.cross_base = child_box.height + child_box.margin.top + child_box.margin.bottom;
                 item.layout = Some(child_box);
@@ -98,7 +100,7 @@ pub fn layout_flex(
             if let Some(h) = st.height {
                 item.main_base = h;
             } else {
-                let child_box = build_block(dom, styles, item.node_id, available_width, images, viewport_w);
+                let child_box = build_block(dom, styles, item.node_id, available_width, images, cache, viewport_w);
                 item.main_base = child_box.height + child_box.margin.top + child_box.margin.bottom;
                 item.cross_base = child_box.width + child_box.margin.left + child_box.margin.right;
                 item.layout = Some(child_box);
@@ -168,12 +170,12 @@ pub fn layout_flex(
             let child_avail = if is_row { item_main } else { available_width };
             let mut child_box = if let Some(existing) = items[i].layout.take() {
                 if is_row && (existing.width + existing.margin.left + existing.margin.right) != item_main {
-                    build_block(dom, styles, items[i].node_id, child_avail, images, viewport_w)
+                    build_block(dom, styles, items[i].node_id, child_avail, images, cache, viewport_w)
                 } else {
                     existing
                 }
             } else {
-                build_block(dom, styles, items[i].node_id, child_avail, images, viewport_w)
+                build_block(dom, styles, items[i].node_id, child_avail, images, cache, viewport_w)
             };
 
             if is_row && total_grow > 0 && items[i].grow > 0 {
@@ -26,6 +26,7 @@ use crate::ImageCache;
 
 use super::LayoutBox;
 use super::block::build_block;
+use super::cache::LayoutCache;
 
 // ────────────────────────────────────────────────────────────
 // Public entry-point
@@ -40,6 +41,7 @@ pub fn layout_grid(
     available_width: i32,
     parent: &mut LayoutBox,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     viewport_w: i32,
 ) -> i32 {
     let parent_idx = parent.node_id.unwrap_or(0);
@@ -109,7 +111,7 @@ pub fn layout_grid(
     // ── 7. Measure each item at its column span width ─────────────────────
     for item in &mut items {
         let col_w = span_width(&col_widths, item.placed_col, item.span_cols, col_gap);
-        let bx = build_block(dom, styles, item.node_id, col_w, images, viewport_w);
+        let bx = build_block(dom, styles, item.node_id, col_w, images, cache, viewport_w);
         item.layout = Some(bx);
     }
 
@@ -157,10 +159,10 @@ pub fn layout_grid(
             // Vertical alignment (align-items).
             let y_offset = align_offset(container_align, item_h, cell_h);
 
-            // Translate the subtree so that (bx.x, bx.y) lands at (x + x_offset, y + y_offset).
-            let dx = parent.x + x + x_offset - bx.x;
-            let dy = parent.y + y + y_offset - bx.y;
-            translate_box(&mut bx, dx, dy);
+            // Move the item so that (bx.x, bx.y) lands at (x + x_offset, y + y_offset).
+            // Children are positioned relative to the item and stay put.
+            bx.x = parent.x + x + x_offset;
+            bx.y = parent.y + y + y_offset;
 
             parent.children.push(bx);
         }
@@ -509,15 +511,6 @@ fn align_offset(align: AlignItems, item_size: i32, cell_size: i32) -> i32 {
     }
 }
 
-/// Recursively translate a `LayoutBox` and all its children by (dx, dy).
-fn translate_box(bx: &mut LayoutBox, dx: i32, dy: i32) {
-    bx.x += dx;
-    bx.y += dy;
-    for child in &mut bx.children {
-        translate_box(child, dx, dy);
-    }
-}
-
 // ────────────────────────────────────────────────────────────
 // Internal data
 // ────────────────────────────────────────────────────────────
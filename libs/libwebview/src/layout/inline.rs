@@ -14,6 +14,7 @@ use super::{
     is_ascii_ws, ascii_lower_str, size_attr_width,
     apply_text_transform,
 };
+use super::cache::LayoutCache;
 
 /// Represents a single inline fragment before line-breaking.
 struct InlineFragment {
@@ -32,6 +33,7 @@ pub fn layout_inline_content(
     available_width: i32,
     start_x: i32,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     text_align: TextAlignVal,
     line_height: i32,
     viewport_w: i32,
@@ -43,7 +45,7 @@ pub fn layout_inline_content(
         if style.display == Display::None {
             continue;
         }
-        collect_inline_fragments(dom, styles, cid, &mut fragments, available_width, images, 0, viewport_w);
+        collect_inline_fragments(dom, styles, cid, &mut fragments, available_width, images, cache, 0, viewport_w);
     }
 
     // 2. Break fragments into lines.
@@ -141,6 +143,7 @@ fn collect_inline_fragments(
     out: &mut Vec<InlineFragment>,
     available_width: i32,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     inherited_bg: u32,
     viewport_w: i32,
 ) {
@@ -254,7 +257,7 @@ fn collect_inline_fragments(
             // Handle display: inline-block / inline-flex — lay out as block, emit as inline fragment.
             if matches!(style.display, Display::InlineBlock | Display::InlineFlex) {
                 use super::block::build_block;
-                let mut block_box = build_block(dom, styles, node_id, available_width, images, viewport_w);
+                let mut block_box = build_block(dom, styles, node_id, available_width, images, cache, viewport_w);
                 block_box.box_type = BoxType::InlineBlock;
                 let w = block_box.width + block_box.margin.left + block_box.margin.right;
                 let h = block_box.height + block_box.margin.top + block_box.margin.bottom;
@@ -282,7 +285,7 @@ fn collect_inline_fragments(
                 if cs.display == Display::None {
                     continue;
                 }
-                collect_inline_fragments(dom, styles, cid, out, available_width, images, child_bg, viewport_w);
+                collect_inline_fragments(dom, styles, cid, out, available_width, images, cache, child_bg, viewport_w);
             }
 
             // Right padding + margin → insert spacer.
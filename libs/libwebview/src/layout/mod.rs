@@ -8,8 +8,10 @@
 //!   - `flex`: Flexbox layout (`layout_flex`)
 //!   - `inline`: Inline/text layout, form element fragments
 //!   - `form`: Form field position collection
+//!   - `cache`: Reuse of unchanged boxes across relayouts (`LayoutCache`)
 
 pub mod block;
+pub mod cache;
 pub mod flex;
 pub mod grid;
 pub mod inline;
@@ -28,6 +30,7 @@ use crate::ImageCache;
 
 // Re-export sub-module public items.
 pub use form::{FormFieldPos, collect_form_positions};
+pub use cache::LayoutCache;
 use block::build_block;
 use inline::layout_inline_content;
 
@@ -79,6 +82,12 @@ pub struct LayoutBox {
     /// If true, this box is `position:fixed` and its x/y are viewport-relative.
     /// The renderer will ignore accumulated parent offsets and use x/y directly.
     pub is_fixed: bool,
+    /// The element runs a CSS animation; the renderer paints it into its
+    /// own layer.
+    pub animated: bool,
+    /// Set on boxes from `build_block` / `layout_table` so the next relayout
+    /// can reuse them (see `cache`).
+    pub layout_key: Option<cache::LayoutKey>,
 }
 
 #[derive(Clone, Copy, PartialEq, Eq)]
@@ -151,6 +160,8 @@ impl LayoutBox {
             visibility_hidden: false,
             opacity: 255,
             is_fixed: false,
+            animated: false,
+            layout_key: None,
         }
     }
 
@@ -335,7 +346,10 @@ pub(super) fn size_attr_width(dom: &Dom, node_id: NodeId, default: i32) -> i32 {
 // ---------------------------------------------------------------------------
 
 /// Build a layout tree from the DOM and computed styles.
-pub fn layout(dom: &Dom, styles: &[ComputedStyle], viewport_width: i32, images: &ImageCache) -> LayoutBox {
+///
+/// Boxes offered to `cache` (see [`LayoutCache::begin`]) are reused where
+/// their subtree is unchanged.
+pub fn layout(dom: &Dom, styles: &[ComputedStyle], viewport_width: i32, images: &ImageCache, cache: &mut LayoutCache) -> LayoutBox {
     crate::debug_surf!("[layout] layout start: {} nodes, viewport_width={}", dom.nodes.len(), viewport_width);
     #[cfg(feature = "debug_surf")]
     crate::debug_surf!("[layout]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
@@ -362,7 +376,7 @@ pub fn layout(dom: &Dom, styles: &[ComputedStyle], viewport_width: i32, images:
     let children = &dom.get(body_id).children;
     let child_ids: Vec<NodeId> = children.iter().copied().collect();
     crate::debug_surf!("[layout] body has {} direct children, content_width={}", child_ids.len(), content_width);
-    let height = layout_children(dom, styles, &child_ids, content_width, &mut root, body_id, images, viewport_width);
+    let height = layout_children(dom, styles, &child_ids, content_width, &mut root, body_id, images, cache, viewport_width);
 
     root.height = height + root.padding.top + root.padding.bottom;
     crate::debug_surf!("[layout] layout done: root height={}", root.height);
@@ -389,6 +403,7 @@ pub(super) fn layout_children(
     parent: &mut LayoutBox,
     _parent_node: NodeId,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     viewport_w: i32,
 ) -> i32 {
     // Children start after the border and padding on the top-left.
@@ -432,11 +447,11 @@ pub(super) fn layout_children(
 
             // ── Floated elements ──
             if float_val != FloatVal::None {
-                let stf_width = shrink_to_fit_width(dom, styles, cid, available_width, images, viewport_w);
+                let stf_width = shrink_to_fit_width(dom, styles, cid, available_width, images, cache, viewport_w);
                 let mut placed = if is_table_element(dom, cid) {
-                    table::layout_table(dom, styles, cid, stf_width, images, viewport_w)
+                    table::layout_table(dom, styles, cid, stf_width, images, cache, viewport_w)
                 } else {
-                    build_block(dom, styles, cid, stf_width, images, viewport_w)
+                    build_block(dom, styles, cid, stf_width, images, cache, viewport_w)
                 };
 
                 let total_w = placed.width + placed.margin.left + placed.margin.right;
@@ -473,9 +488,9 @@ pub(super) fn layout_children(
             let effective_avail = (available_width - li - ri).max(0);
 
             let child_box = if is_table_element(dom, cid) {
-                table::layout_table(dom, styles, cid, effective_avail, images, viewport_w)
+                table::layout_table(dom, styles, cid, effective_avail, images, cache, viewport_w)
             } else {
-                build_block(dom, styles, cid, effective_avail, images, viewport_w)
+                build_block(dom, styles, cid, effective_avail, images, cache, viewport_w)
             };
 
             let collapsed = if prev_margin_bottom > child_box.margin.top {
@@ -537,7 +552,7 @@ pub(super) fn layout_children(
             let parent_style = &styles[_parent_node];
             let parent_align = parent_style.text_align;
             let line_boxes = layout_inline_content(
-                dom, styles, &inline_ids, inline_avail, bw + parent.padding.left + li, images,
+                dom, styles, &inline_ids, inline_avail, bw + parent.padding.left + li, images, cache,
                 parent_align, parent_style.line_height, viewport_w,
             );
             for lb in line_boxes {
@@ -560,9 +575,9 @@ pub(super) fn layout_children(
         let sizing_width = if is_fixed_pos { viewport_w } else { available_width };
 
         let mut abs_box = if is_table_element(dom, abs_id) {
-            table::layout_table(dom, styles, abs_id, sizing_width, images, viewport_w)
+            table::layout_table(dom, styles, abs_id, sizing_width, images, cache, viewport_w)
         } else {
-            build_block(dom, styles, abs_id, sizing_width, images, viewport_w)
+            build_block(dom, styles, abs_id, sizing_width, images, cache, viewport_w)
         };
 
         if is_fixed_pos {
@@ -762,6 +777,7 @@ fn shrink_to_fit_width(
     node_id: NodeId,
     max_width: i32,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     viewport_w: i32,
 ) -> i32 {
     let style = &styles[node_id];
@@ -770,7 +786,7 @@ fn shrink_to_fit_width(
         if w > 0 { return w.min(max_width); }
     }
     // Otherwise, lay out with max_width and use the resulting content width.
-    let trial = build_block(dom, styles, node_id, max_width, images, viewport_w);
+    let trial = build_block(dom, styles, node_id, max_width, images, cache, viewport_w);
     // Shrink-to-fit: use the content width (sum of children) capped at max_width.
     let content_w = trial.children.iter()
         .map(|c| c.x + c.width + c.margin.right)
@@ -25,14 +25,37 @@ use super::{
     font_size_px, is_bold, edges_from,
 };
 use super::block::build_block;
+use super::cache::{LayoutCache, patch_boundaries};
 
-/// Build a table layout box for a `<table>` element.
+/// Build a table layout box for a `<table>` element, reusing last frame's
+/// box from `cache` when the table is unchanged.
 pub fn layout_table(
     dom: &Dom,
     styles: &[ComputedStyle],
     node_id: NodeId,
     available_width: i32,
     images: &ImageCache,
+    cache: &mut LayoutCache,
+    viewport_w: i32,
+) -> LayoutBox {
+    if let Some(mut bx) = cache.take(node_id, available_width, viewport_w, true) {
+        if cache.needs_patch(node_id) {
+            patch_boundaries(&mut bx, dom, styles, images, cache);
+        }
+        return bx;
+    }
+    let mut bx = layout_table_box(dom, styles, node_id, available_width, images, cache, viewport_w);
+    cache.stamp(&mut bx, available_width, viewport_w, true);
+    bx
+}
+
+fn layout_table_box(
+    dom: &Dom,
+    styles: &[ComputedStyle],
+    node_id: NodeId,
+    available_width: i32,
+    images: &ImageCache,
+    cache: &mut LayoutCache,
     viewport_w: i32,
 ) -> LayoutBox {
     let style = &styles[node_id];
@@ -170,7 +193,7 @@ pub fn layout_table(
 
             // Try laying out with generous width to get preferred width.
             let test_w = content_width;
-            let cell_box = layout_cell(dom, styles, cell_id, test_w, cellpadding, table_border, images, viewport_w);
+            let cell_box = layout_cell(dom, styles, cell_id, test_w, cellpadding, table_border, images, cache, viewport_w);
             let pref_w = cell_content_width(&cell_box) + cell_overhead;
 
             if colspan == 1 {
@@ -246,7 +269,7 @@ pub fn layout_table(
 
     // Layout caption if present.
     if let Some(cap_id) = caption_id {
-        let cap_box = build_block(dom, styles, cap_id, table_width - bx.padding.left - bx.padding.right, images, viewport_w);
+        let cap_box = build_block(dom, styles, cap_id, table_width - bx.padding.left - bx.padding.right, images, cache, viewport_w);
         let mut placed = cap_box;
         placed.x = bx.padding.left;
         placed.y = cursor_y;
@@ -282,7 +305,7 @@ pub fn layout_table(
             }
 
             // Layout cell content.
-            let cell_box = layout_cell(dom, styles, cell_id, cell_w, cellpadding, table_border, images, viewport_w);
+            let cell_box = layout_cell(dom, styles, cell_id, cell_w, cellpadding, table_border, images, cache, viewport_w);
             let ch = cell_box.height;
             if ch > row_height { row_height = ch; }
 
@@ -327,6 +350,7 @@ fn layout_cell(
     cellpadding: i32,
     table_border: i32,
     images: &ImageCache,
+    cache: &mut LayoutCache,
     viewport_w: i32,
 ) -> LayoutBox {
     let style = &styles[cell_id];
@@ -356,7 +380,7 @@ fn layout_cell(
     let inner_w = inner_w.max(0);
 
     let child_ids: Vec<NodeId> = dom.get(cell_id).children.iter().copied().collect();
-    let height = layout_children(dom, styles, &child_ids, inner_w, &mut bx, cell_id, images, viewport_w);
+    let height = layout_children(dom, styles, &child_ids, inner_w, &mut bx, cell_id, images, cache, viewport_w);
 
     bx.height = height + bx.padding.top + bx.padding.bottom + cell_border * 2;
     bx
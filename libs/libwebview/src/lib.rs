@@ -60,6 +60,7 @@ pub mod css;
 pub mod style;
 pub mod layout;
 pub mod js;
+mod display_list;
 mod renderer;
 
 use alloc::string::String;
@@ -80,6 +81,10 @@ pub struct WebView {
     content_view: ui::View,
     renderer: renderer::Renderer,
     dom_val: Option<dom::Dom>,
+    /// Tree builder of a document still arriving via `feed_html()`.
+    html_parser: Option<html::HtmlParser>,
+    /// Subresources the parser discovered, not yet taken by the embedder.
+    preloads: Vec<html::Preload>,
     /// Browser default stylesheet — parsed once in `new()`, reused on every relayout.
     default_sheet: css::Stylesheet,
     /// Pre-parsed external stylesheets — parsed once in `add_stylesheet()` and cached.
@@ -90,6 +95,15 @@ pub struct WebView {
     inline_sheets: Vec<css::Stylesheet>,
     /// Whether inline sheets need re-parsing (set by JS mutations, cleared after parse).
     inline_sheets_dirty: bool,
+    /// Hash of the `<style>` text `inline_sheets` was parsed from; a JS
+    /// mutation that leaves it unchanged keeps the parsed sheets.
+    inline_sheets_hash: u64,
+    /// Bumped whenever the set of stylesheets changes (forces a full restyle).
+    sheets_generation: u32,
+    /// Computed styles kept across relayouts for incremental restyling.
+    style_cache: style::StyleCache,
+    /// Reuse of unchanged layout boxes from `layout_root` on relayout.
+    layout_cache: layout::LayoutCache,
     /// Cached parsed inline `style="..."` declarations per node_id.
     /// Avoids re-parsing the same style attribute on every relayout.
     inline_style_cache: Vec<(usize, Vec<css::Declaration>)>,
@@ -136,10 +150,16 @@ impl WebView {
             content_view,
             renderer: renderer::Renderer::new(),
             dom_val: None,
+            html_parser: None,
+            preloads: Vec::new(),
             default_sheet: css::parse_stylesheet(DEFAULT_CSS),
             external_sheets: Vec::new(),
             inline_sheets: Vec::new(),
             inline_sheets_dirty: true,
+            inline_sheets_hash: 0,
+            sheets_generation: 0,
+            style_cache: style::StyleCache::new(),
+            layout_cache: layout::LayoutCache::new(),
             inline_style_cache: Vec::new(),
             images: ImageCache::new(),
             viewport_width: w as i32,
@@ -196,6 +216,7 @@ impl WebView {
     /// hundreds of kilobytes of CSS text on every image or resource load.
     pub fn add_stylesheet(&mut self, css_text: &str) {
         self.external_sheets.push(css::parse_stylesheet(css_text));
+        self.sheets_generation = self.sheets_generation.wrapping_add(1);
     }
 
     /// Clear all cached external and inline stylesheets.
@@ -203,11 +224,67 @@ impl WebView {
         self.external_sheets.clear();
         self.inline_sheets.clear();
         self.inline_sheets_dirty = true;
+        self.inline_sheets_hash = 0;
+        self.sheets_generation = self.sheets_generation.wrapping_add(1);
     }
 
     /// Add a decoded image to the cache. Will be displayed on next render.
     pub fn add_image(&mut self, src: &str, pixels: Vec<u32>, w: u32, h: u32) {
-        self.images.add(String::from(src), pixels, w, h);
+        self.add_image_scaled(src, pixels, w, h, w, h);
+    }
+
+    /// Add an image decoded at `pixel_w × pixel_h` whose natural size is
+    /// `w × h` (see `image_display_size`).  The pixels are stretched to the
+    /// layout boxes; layout only reruns for the `<img>` nodes if the natural
+    /// size differs from the one reserved with `reserve_image`.
+    pub fn add_image_scaled(&mut self, src: &str, pixels: Vec<u32>, pixel_w: u32, pixel_h: u32, w: u32, h: u32) {
+        if self.images.add_scaled(String::from(src), pixels, pixel_w, pixel_h, w, h) {
+            self.mark_images_dirty(src);
+        }
+    }
+
+    /// Reserve the natural size of an image whose pixels are still being
+    /// decoded, so the next layout gives its boxes their final size.
+    pub fn reserve_image(&mut self, src: &str, w: u32, h: u32) {
+        if self.images.reserve(src, w, h) {
+            self.mark_images_dirty(src);
+        }
+    }
+
+    /// The largest size any `<img>` showing `src` is laid out at, assuming
+    /// a natural size of `w × h`.  Decoding at this size instead of the
+    /// natural one saves memory and blit time for downscaled images.
+    pub fn image_display_size(&self, src: &str, w: u32, h: u32) -> (u32, u32) {
+        let d = match self.dom_val.as_ref() {
+            Some(d) => d,
+            None => return (w, h),
+        };
+        let mut probe = ImageCache::new();
+        probe.reserve(src, w, h);
+        let (mut dw, mut dh) = (0u32, 0u32);
+        for id in 0..d.nodes.len() {
+            if d.tag(id) == Some(dom::Tag::Img) && d.attr(id, "src") == Some(src) {
+                let (bw, bh) = layout::image_dimensions(d, id, self.viewport_width, &probe);
+                dw = dw.max(bw.max(1) as u32);
+                dh = dh.max(bh.max(1) as u32);
+            }
+        }
+        if dw == 0 || dh == 0 {
+            // Not (yet) in the document, e.g. a CSS or preloaded image.
+            return (w, h);
+        }
+        (dw.min(w), dh.min(h))
+    }
+
+    /// Flag the `<img>` boxes showing `src` for relayout.
+    fn mark_images_dirty(&mut self, src: &str) {
+        if let Some(d) = self.dom_val.as_mut() {
+            for id in 0..d.nodes.len() {
+                if d.tag(id) == Some(dom::Tag::Img) && d.attr(id, "src") == Some(src) {
+                    d.mark_style_dirty(id, dom::LAYOUT_DIRTY);
+                }
+            }
+        }
     }
 
     /// Set HTML content and render it.
@@ -220,20 +297,90 @@ impl WebView {
             anyos_std::println!("[webview] set_html: RSP=0x{:X} heap=0x{:X}", rsp0, heap0);
         }
 
-        // Parse HTML → DOM.
-        debug_surf!("[webview] html::parse start");
-        let mut parsed_dom = html::parse(html_text);
-        debug_surf!("[webview] html::parse done: {} nodes", parsed_dom.nodes.len());
-        #[cfg(feature = "debug_surf")]
-        anyos_std::println!("[webview]   RSP=0x{:X} heap=0x{:X}", debug_rsp(), debug_heap_pos());
+        self.begin_html();
+        self.feed_html(html_text.as_bytes());
+        self.finish_html();
+    }
+
+    /// Start a new page whose HTML arrives in pieces.
+    ///
+    /// Feed the markup with `feed_html()` as it is received, call
+    /// `render_partial()` whenever the partial document should be shown,
+    /// and `finish_html()` at the end of input.  `set_html()` is the same
+    /// sequence with the whole document as one piece.
+    pub fn begin_html(&mut self) {
+        let mut parsed_dom = dom::Dom::new();
+        self.html_parser = Some(html::HtmlParser::new(&mut parsed_dom));
+        self.dom_val = Some(parsed_dom);
+        self.preloads.clear();
 
         // New page — inline <style> blocks and style attribute cache need re-parsing.
         self.inline_sheets.clear();
         self.inline_sheets_dirty = true;
+        self.inline_sheets_hash = 0;
         self.inline_style_cache.clear();
+        self.style_cache.clear();
+        self.layout_cache.clear();
+        self.layout_root = None;
+    }
+
+    /// Parse the next piece of a page started with `begin_html()`.
+    ///
+    /// Chunks may split the markup anywhere (inside tags, entities or
+    /// multi-byte characters); nodes are added to the DOM as soon as they
+    /// are complete.
+    pub fn feed_html(&mut self, chunk: &[u8]) {
+        if let (Some(parser), Some(d)) = (self.html_parser.as_mut(), self.dom_val.as_mut()) {
+            parser.feed(d, chunk);
+            self.preloads.extend(parser.take_preloads());
+            if parser.style_changed {
+                parser.style_changed = false;
+                self.inline_sheets_dirty = true;
+            }
+        }
+    }
+
+    /// Lay out and render the part of the page parsed so far.
+    ///
+    /// Only nodes added since the previous render are restyled, and layout
+    /// boxes of finished subtrees are reused.  Scripts do not run until
+    /// `finish_html()`.
+    pub fn render_partial(&mut self) {
+        if self.html_parser.is_some() {
+            self.relayout();
+        }
+    }
+
+    /// Subresource URLs (`<img src>`, `<link rel=stylesheet href>`,
+    /// `<script src>`) discovered by the parser since the last call, as
+    /// written in the markup.  Lets the embedder start fetching them while
+    /// the rest of the document is still loading.
+    pub fn take_preloads(&mut self) -> Vec<html::Preload> {
+        core::mem::take(&mut self.preloads)
+    }
+
+    /// End of input for a page started with `begin_html()`: complete the
+    /// DOM, render it and run its scripts.
+    pub fn finish_html(&mut self) {
+        let (mut parser, mut parsed_dom) = match (self.html_parser.take(), self.dom_val.take()) {
+            (Some(p), Some(d)) => (p, d),
+            (_, d) => {
+                self.dom_val = d;
+                return;
+            }
+        };
+        parser.finish(&mut parsed_dom);
+        self.preloads.extend(parser.take_preloads());
+        if parser.style_changed {
+            self.inline_sheets_dirty = true;
+        }
+        debug_surf!("[webview] html parse done: {} nodes", parsed_dom.nodes.len());
+        #[cfg(feature = "debug_surf")]
+        anyos_std::println!("[webview]   RSP=0x{:X} heap=0x{:X}", debug_rsp(), debug_heap_pos());
 
         // Collect stylesheets and resolve + layout + render.
         self.do_layout_and_render(&parsed_dom);
+        parsed_dom.clear_style_dirty();
 
         // Execute JavaScript <script> tags after initial render so that DOM
         // elements already exist for querySelector / getElementById calls.
@@ -247,15 +394,16 @@ impl WebView {
         // and re-layout so the mutated content becomes visible.
         if !self.js_runtime.mutations.is_empty() {
             debug_surf!("[webview] applying {} JS mutations + relayout", self.js_runtime.mutations.len());
+            // Only the nodes JS touched are restyled (see `Dom::style_dirty`).
             self.js_runtime.apply_mutations(&mut parsed_dom);
             self.inline_sheets_dirty = true; // JS may have altered <style> tags
-            self.inline_style_cache.clear(); // JS may have altered style="..." attrs
             self.do_layout_and_render(&parsed_dom);
+            parsed_dom.clear_style_dirty();
         }
 
         // Store DOM for title queries etc.
         self.dom_val = Some(parsed_dom);
-        debug_surf!("[webview] set_html complete");
+        debug_surf!("[webview] page load complete");
     }
 
     /// Get the page title from the current DOM (if any).
@@ -268,6 +416,11 @@ impl WebView {
         self.total_height_val
     }
 
+    /// Number of nodes whose style was recomputed by the last layout pass.
+    pub fn last_restyle_count(&self) -> usize {
+        self.style_cache.restyled
+    }
+
     /// Resize the viewport and re-layout.
     pub fn resize(&mut self, w: u32, h: u32) {
         self.viewport_width = w as i32;
@@ -287,11 +440,12 @@ impl WebView {
             // Apply any pending JS mutations before re-rendering.
             if !self.js_runtime.mutations.is_empty() {
                 self.js_runtime.apply_mutations(&mut d);
-                // JS may have modified <style> tags or style="..." attributes.
+                // JS may have modified <style> tags; changed style="..."
+                // attributes are dropped from the cache by the restyle.
                 self.inline_sheets_dirty = true;
-                self.inline_style_cache.clear();
             }
             self.do_layout_and_render(&d);
+            d.clear_style_dirty();
             self.dom_val = Some(d);
         }
     }
@@ -333,6 +487,8 @@ impl WebView {
         // 2 per tick to avoid blocking the event loop).
         if self.layout_root.is_some() {
             let scroll_y = self.scroll_view.get_state() as i32;
+            // Fixed layers follow every scroll step, not just tile rows.
+            self.renderer.position_layers(scroll_y);
             let delta = (scroll_y - self.last_render_scroll_y).abs();
             // Check every 64px of scroll movement for new tiles needed.
             if delta > 64 {
@@ -353,30 +509,23 @@ impl WebView {
     /// present.  Cache-miss tiles are rasterized incrementally (max 2 per
     /// call).  Returns `true` if there are still pending tiles.
     fn render_viewport(&mut self, scroll_y: i32) -> bool {
-        // Split borrows: layout_root (immut), renderer (mut), content_view (immut), images (immut).
-        let root = match self.layout_root {
-            Some(ref root) => root as *const LayoutBox,
-            None => return false,
-        };
+        if self.layout_root.is_none() {
+            return false;
+        }
         let doc_w = self.viewport_width as u32;
         let doc_h = (self.total_height_val as u32).max(1);
 
-        // SAFETY: root points into self.layout_root which is not modified during render_scroll().
-        // We use a raw pointer to break the borrow conflict between layout_root and renderer.
-        unsafe {
-            self.renderer.render_scroll(
-                &*root,
-                &self.content_view,
-                &self.images,
-                doc_w,
-                doc_h,
-                self.viewport_height,
-                scroll_y,
-                self.bg_color_cached,
-                self.link_cb,
-                self.link_cb_ud,
-            )
-        }
+        self.renderer.render_scroll(
+            &self.content_view,
+            &self.images,
+            doc_w,
+            doc_h,
+            self.viewport_height,
+            scroll_y,
+            self.bg_color_cached,
+            self.link_cb,
+            self.link_cb_ud,
+        )
     }
 
     /// Clear all content (remove all controls, reset DOM).
@@ -385,7 +534,11 @@ impl WebView {
         self.renderer.clear_all();
         self.images.clear();
         self.dom_val = None;
+        self.html_parser = None;
+        self.preloads.clear();
         self.layout_root = None;
+        self.style_cache.clear();
+        self.layout_cache.clear();
         self.total_height_val = 0;
         self.last_render_scroll_y = 0;
         self.content_view.set_size(self.viewport_width as u32, 1);
@@ -525,22 +678,33 @@ impl WebView {
         // visible in logs as repeated 150 KB parses per image load.
 
         // Phase A: Parse inline <style> blocks — cached across relayouts.
-        // Only re-parsed when dirty (new page via set_html, or JS mutations).
+        // Only re-parsed when dirty (new page via set_html, or JS mutations)
+        // and the <style> text actually changed.
         if self.inline_sheets_dirty {
-            self.inline_sheets.clear();
-            let mut inline_count = 0u32;
+            let mut texts: Vec<String> = Vec::new();
+            let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
             for (i, node) in d.nodes.iter().enumerate() {
                 if let dom::NodeType::Element { tag: dom::Tag::Style, .. } = &node.node_type {
                     let css_text = d.text_content(i);
                     if !css_text.is_empty() {
-                        debug_surf!("[webview] parse inline <style> #{}: {} bytes", inline_count, css_text.len());
-                        self.inline_sheets.push(css::parse_stylesheet(&css_text));
-                        inline_count += 1;
+                        for &b in css_text.as_bytes().iter().chain(&[0u8]) {
+                            hash = (hash ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+                        }
+                        texts.push(css_text);
                     }
                 }
             }
+            if hash != self.inline_sheets_hash || self.inline_sheets.len() != texts.len() {
+                self.inline_sheets.clear();
+                for css_text in &texts {
+                    debug_surf!("[webview] parse inline <style>: {} bytes", css_text.len());
+                    self.inline_sheets.push(css::parse_stylesheet(css_text));
+                }
+                self.inline_sheets_hash = hash;
+                self.sheets_generation = self.sheets_generation.wrapping_add(1);
+                debug_surf!("[webview] parsed {} inline <style> blocks", texts.len());
+            }
             self.inline_sheets_dirty = false;
-            debug_surf!("[webview] parsed {} inline <style> blocks", inline_count);
         }
 
         debug_surf!("[webview] total stylesheets: {} (1 default + {} external + {} inline)",
@@ -551,16 +715,20 @@ impl WebView {
         let vw = self.viewport_width;
         let vh = self.total_height_val.max(self.viewport_width);
         debug_surf!("[webview] resolve_styles start ({} nodes)", d.nodes.len());
-        let styles = {
+        {
             let mut all_sheets: Vec<&css::Stylesheet> = Vec::with_capacity(
                 1 + self.external_sheets.len() + self.inline_sheets.len()
             );
             all_sheets.push(&self.default_sheet);
             for sheet in &self.external_sheets { all_sheets.push(sheet); }
             for sheet in &self.inline_sheets { all_sheets.push(sheet); }
-            style::resolve_styles(d, &all_sheets, vw, vh, &mut self.inline_style_cache)
-        };
-        debug_surf!("[webview] resolve_styles done: {} styles", styles.len());
+            self.style_cache.resolve(
+                d, &all_sheets, self.sheets_generation, vw, vh, &mut self.inline_style_cache,
+            );
+        }
+        let styles = self.style_cache.styles();
+        debug_surf!("[webview] resolve_styles done: {} styles, {} restyled ({} shared)",
+            styles.len(), self.style_cache.restyled, self.style_cache.shared);
 
         // Register new @keyframe animations for nodes that request them.
         // DISABLED: CSS animations are disabled for performance investigation.
@@ -568,13 +736,17 @@ impl WebView {
         #[cfg(feature = "debug_surf")]
         debug_surf!("[webview]   RSP=0x{:X} heap=0x{:X}", debug_rsp(), debug_heap_pos());
 
-        // Drop old layout tree before allocating the new one — avoids holding
-        // two full trees in memory simultaneously (can save several MB on complex pages).
-        self.layout_root = None;
+        // Hand the old layout tree to the cache: unchanged subtrees move into
+        // the new tree, the rest is dropped as it is rebuilt — the two full
+        // trees never coexist (can save several MB on complex pages).
+        self.layout_cache.begin(d, styles, self.style_cache.restyled_nodes(), self.layout_root.take());
 
         // Layout.
         debug_surf!("[webview] layout start (viewport_width={})", self.viewport_width);
-        let root = layout::layout(d, &styles, self.viewport_width, &self.images);
+        let root = layout::layout(d, styles, self.viewport_width, &self.images, &mut self.layout_cache);
+        self.layout_cache.finish();
+        debug_surf!("[webview] layout boxes: {} reused, {} built",
+            self.layout_cache.reused, self.layout_cache.built);
         self.total_height_val = calc_total_height(&root);
         #[cfg(feature = "debug_surf")]
         {
@@ -601,8 +773,9 @@ impl WebView {
         // Cache body background for scroll re-renders.
         self.bg_color_cached = bg_color;
 
-        // Render into canvas + update form controls.
-        // Initial render starts at scroll_y=0.
+        // Render into canvas + update form controls, at the current scroll
+        // position (unchanged tiles are kept, so this is cheap).
+        let scroll_y = (self.scroll_view.get_state() as i32).min(doc_h.saturating_sub(self.viewport_height) as i32);
         debug_surf!("[webview] renderer start");
         self.renderer.render(
             &root,
@@ -611,14 +784,14 @@ impl WebView {
             doc_w,
             doc_h,
             self.viewport_height,
-            0, // scroll_y = 0 for initial render
+            scroll_y,
             bg_color,
             self.link_cb,
             self.link_cb_ud,
             self.submit_cb,
             self.submit_cb_ud,
         );
-        self.last_render_scroll_y = 0;
+        self.last_render_scroll_y = scroll_y.max(0);
         debug_surf!("[webview] renderer done: {} form_controls", self.renderer.control_count());
         #[cfg(feature = "debug_surf")]
         debug_surf!("[webview]   RSP=0x{:X} heap=0x{:X}", debug_rsp(), debug_heap_pos());
@@ -6,14 +6,20 @@
 //! compositor's ScrollView handles smooth pixel-level scrolling natively —
 //! zero per-frame work from the application.  Only new tiles entering the
 //! pre-render zone are rasterized and created (~900 KB each).
+//!
+//! Tiles are painted from a `DisplayList` rather than the layout tree.  On
+//! relayout the old and new lists are compared per tile row and only the
+//! damaged rects of cached tiles are repainted; fixed and animated boxes
+//! live in their own layer canvases above the tiles.
 
 use alloc::string::String;
 use alloc::vec::Vec;
 
 use libanyui_client::{self as ui, Widget};
 
+use crate::display_list::{paint, rasterize_layer, DisplayList, Rect};
+use crate::dom::NodeId;
 use crate::layout::{LayoutBox, FormFieldKind};
-use crate::style::TextDeco;
 
 // ═══════════════════════════════════════════════════════════════════════════
 // Image cache
@@ -29,8 +35,13 @@ const IMAGE_CACHE_MAX_BYTES: usize = 128 * 1024 * 1024;
 pub struct ImageEntry {
     pub src: String,
     pub pixels: Vec<u32>,
+    /// Natural size of the image, used by layout.
     pub width: u32,
     pub height: u32,
+    /// Size of `pixels`.  Smaller than the natural size when the image was
+    /// decoded at its display size; 0×0 while only the size is known.
+    pub pixel_width: u32,
+    pub pixel_height: u32,
     /// LRU generation (higher = more recently used).
     generation: u64,
 }
@@ -76,26 +87,56 @@ impl ImageCache {
 
     /// Add a decoded image.  Evicts LRU entries if the cache exceeds the byte cap.
     pub fn add(&mut self, src: String, pixels: Vec<u32>, width: u32, height: u32) {
+        self.add_scaled(src, pixels, width, height, width, height);
+    }
+
+    /// Add an image decoded at `pixel_width × pixel_height` whose natural
+    /// size is `width × height`.  Returns `true` if the natural size is new
+    /// or changed (layout must run again), `false` if only the pixels did.
+    pub fn add_scaled(
+        &mut self,
+        src: String,
+        pixels: Vec<u32>,
+        pixel_width: u32,
+        pixel_height: u32,
+        width: u32,
+        height: u32,
+    ) -> bool {
         let new_bytes = pixels.len() * 4;
 
         // Replace existing entry for the same URL.
         if let Some(entry) = self.entries.iter_mut().find(|e| e.src == src) {
+            let resized = entry.width != width || entry.height != height;
             self.total_bytes -= entry.byte_size();
             entry.pixels = pixels;
             entry.width = width;
             entry.height = height;
+            entry.pixel_width = pixel_width;
+            entry.pixel_height = pixel_height;
             self.generation += 1;
             entry.generation = self.generation;
             self.total_bytes += new_bytes;
             self.evict_to_budget();
-            return;
+            return resized;
         }
 
         self.generation += 1;
         let gen = self.generation;
-        self.entries.push(ImageEntry { src, pixels, width, height, generation: gen });
+        self.entries.push(ImageEntry {
+            src, pixels, width, height, pixel_width, pixel_height, generation: gen,
+        });
         self.total_bytes += new_bytes;
         self.evict_to_budget();
+        true
+    }
+
+    /// Record the natural size of an image that is still being decoded, so
+    /// layout can reserve its box.  No-op if the image is already cached.
+    pub fn reserve(&mut self, src: &str, width: u32, height: u32) -> bool {
+        if self.entries.iter().any(|e| e.src == src) {
+            return false;
+        }
+        self.add_scaled(String::from(src), Vec::new(), 0, 0, width, height)
     }
 
     /// Drop all cached images (called on page navigation).
@@ -246,10 +287,27 @@ impl TileCache {
 struct TileCanvas {
     /// Tile row index.
     row: u32,
+    /// Canvas height (the last row is cut off at the document height).
+    height: u32,
     /// The Canvas control.
     canvas: ui::Canvas,
 }
 
+/// A Canvas holding one paint layer (`position: fixed` or animated box).
+///
+/// Layers stack above the tiles.  Moving one is a `set_position`; the tiles
+/// underneath keep their pixels.
+struct LayerCanvas {
+    node_id: Option<NodeId>,
+    fixed: bool,
+    bounds: Rect,
+    /// Content hash of the layer's display items.
+    hash: u64,
+    /// Pixels, kept to restack the canvas above newly created tiles.
+    pixels: Vec<u32>,
+    canvas: ui::Canvas,
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // Renderer
 // ═══════════════════════════════════════════════════════════════════════════
@@ -260,15 +318,25 @@ struct TileCanvas {
 /// inside the content_view.  The compositor's ScrollView clips and scrolls
 /// natively — zero work from the application during scroll.  Only tiles
 /// entering the pre-render zone are rasterized (~900 KB per tile).
+///
+/// Tiles are painted from the `DisplayList` of the current layout.  After a
+/// relayout, the new list is diffed against the previous one row by row and
+/// only the damaged rects of cached tiles are repainted.
 pub(crate) struct Renderer {
     /// Per-tile canvases — each tile is a separate Canvas in the content_view.
     tile_canvases: Vec<TileCanvas>,
     /// Tile pixel data cache (survives canvas eviction for fast recreation).
     tile_cache: TileCache,
+    /// Canvases of the display list's layers, stacked above the tiles.
+    layer_canvases: Vec<LayerCanvas>,
+    /// Paint commands of the current layout.
+    list: DisplayList,
     /// Current document width (for tile sizing).
     doc_w: u32,
     /// Current document height.
     doc_h: u32,
+    /// Background the tiles were cleared to.
+    clear_color: u32,
     /// Clickable regions (links, submit buttons) — absolute document coordinates.
     pub hit_regions: Vec<HitRegion>,
     /// Persistent form controls — only destroyed on full page navigation.
@@ -280,6 +348,8 @@ pub(crate) struct Renderer {
     link_cb_ud: u64,
     /// Last scroll Y that triggered tile management.
     last_scroll_y: i32,
+    /// Scroll Y the fixed layers are positioned for.
+    layer_scroll_y: i32,
 }
 
 impl Renderer {
@@ -287,19 +357,23 @@ impl Renderer {
         Self {
             tile_canvases: Vec::new(),
             tile_cache: TileCache::new(),
+            layer_canvases: Vec::new(),
+            list: DisplayList::new(),
             doc_w: 0,
             doc_h: 0,
+            clear_color: 0,
             hit_regions: Vec::new(),
             form_controls: Vec::new(),
             link_map: Vec::new(),
             link_cb: None,
             link_cb_ud: 0,
             last_scroll_y: 0,
+            layer_scroll_y: 0,
         }
     }
 
-    /// Check if a control ID belongs to any tile canvas, and if so return
-    /// the mouse position translated to absolute document coordinates.
+    /// Check if a control ID belongs to any tile or layer canvas, and if so
+    /// return the mouse position translated to absolute document coordinates.
     pub fn tile_hit_coords(&self, ctrl_id: u32) -> Option<(i32, i32)> {
         for tc in &self.tile_canvases {
             if tc.canvas.id() == ctrl_id {
@@ -308,6 +382,12 @@ impl Renderer {
                 return Some((mx, doc_y));
             }
         }
+        for lc in &self.layer_canvases {
+            if lc.canvas.id() == ctrl_id {
+                let (mx, my, _) = lc.canvas.get_mouse();
+                return Some((lc.bounds.x + mx, lc.bounds.y + my));
+            }
+        }
         None
     }
 
@@ -316,17 +396,12 @@ impl Renderer {
         self.form_controls.len()
     }
 
-    /// Soft clear: reset hit regions and link map, invalidate tile cache,
-    /// destroy tile canvases, and mark form controls for GC.
-    /// Called on each relayout.
+    /// Soft clear: reset hit regions and link map, and mark form controls
+    /// for GC.  Called on each relayout; tiles and layers stay until
+    /// `render()` knows which parts of them changed.
     pub fn clear(&mut self) {
         self.hit_regions.clear();
         self.link_map.clear();
-        self.tile_cache.invalidate_all();
-        // Destroy all tile canvases (content is stale after relayout).
-        for tc in self.tile_canvases.drain(..) {
-            ui::Control::from_id(tc.canvas.id()).remove();
-        }
         for fc in &mut self.form_controls {
             fc.seen = false;
         }
@@ -341,17 +416,21 @@ impl Renderer {
             }
         }
         self.form_controls.clear();
-        for tc in self.tile_canvases.drain(..) {
-            ui::Control::from_id(tc.canvas.id()).remove();
+        self.remove_tile_canvases();
+        for lc in self.layer_canvases.drain(..) {
+            ui::Control::from_id(lc.canvas.id()).remove();
         }
+        self.list = DisplayList::new();
         self.doc_w = 0;
         self.doc_h = 0;
+        self.clear_color = 0;
         self.hit_regions.clear();
         self.link_map.clear();
         self.tile_cache.invalidate_all();
         self.link_cb = None;
         self.link_cb_ud = 0;
         self.last_scroll_y = 0;
+        self.layer_scroll_y = 0;
     }
 
     /// Hit-test at absolute document coordinates for a link URL.
@@ -388,9 +467,10 @@ impl Renderer {
 
     /// Render the layout tree using per-tile canvases.
     ///
-    /// Called after relayout.  Invalidates the tile cache, walks the full
-    /// tree for form controls and hit regions, creates tile canvases for
-    /// visible rows, and GCs unseen form controls.
+    /// Called after relayout.  Records the tree's display list, walks it for
+    /// form controls and hit regions, repaints the parts of cached tiles
+    /// whose display items changed, creates tile canvases for visible rows,
+    /// updates the layer canvases, and GCs unseen form controls.
     pub fn render(
         &mut self,
         root: &LayoutBox,
@@ -412,35 +492,45 @@ impl Renderer {
         let w = doc_w.max(1);
         let clear_color = if bg_color != 0 { bg_color } else { 0xFFFFFFFF };
 
+        // 1. Record the new display list; retire the stale parts of the tiles.
+        let list = DisplayList::build(root, images, TILE_HEIGHT);
+        if w != self.doc_w || clear_color != self.clear_color {
+            // Every pixel moved or changed colour.
+            self.tile_cache.invalidate_all();
+            self.remove_tile_canvases();
+        } else {
+            self.repaint_damage(&list, images, doc_h);
+        }
+        self.list = list;
+
         self.doc_w = w;
         self.doc_h = doc_h;
+        self.clear_color = clear_color;
         self.link_cb = link_cb;
         self.link_cb_ud = link_cb_ud;
         self.last_scroll_y = scroll_y;
 
-        // 1. Invalidate tile cache (layout has changed).
-        self.tile_cache.invalidate_all();
-
         // 2. Walk full tree for form controls + hit regions (document coords).
         self.walk_controls(root, 0, 0, parent, submit_cb, submit_cb_ud);
 
-        // 3. Compute visible tile rows.
-        let render_y_start = (scroll_y - BUFFER_ZONE).max(0);
-        let render_y_end = (scroll_y + viewport_h as i32 + BUFFER_ZONE).min(doc_h as i32);
-        let first_row = render_y_start as u32 / TILE_HEIGHT;
-        let last_row = if render_y_end > 0 {
-            ((render_y_end - 1) as u32) / TILE_HEIGHT
-        } else {
-            0
-        };
-
-        // 4. Rasterize visible tile rows, cache them, and create canvases.
+        // 3. Rasterize missing visible tiles and create their canvases.
+        let (first_row, last_row) = visible_rows(scroll_y, viewport_h, doc_h);
+        let mut created = false;
         for row in first_row..=last_row {
-            let tile_buf = rasterize_tile(root, images, w, row, doc_h, clear_color);
-            self.tile_cache.insert(row, tile_buf);
+            if self.tile_canvases.iter().any(|tc| tc.row == row) {
+                continue;
+            }
+            if self.tile_cache.get(row).is_none() {
+                let tile_buf = rasterize_tile(&self.list, images, w, row, clear_color);
+                self.tile_cache.insert(row, tile_buf);
+            }
             self.create_tile_canvas(row, w, doc_h, parent);
+            created = true;
         }
 
+        // 4. Layers.
+        self.update_layers(parent, images, scroll_y, created);
+
         // 5. GC unseen form controls.
         self.form_controls.retain(|fc| {
             if !fc.seen && fc.control_id != 0 {
@@ -451,8 +541,8 @@ impl Renderer {
             }
         });
 
-        crate::debug_surf!("[render] full render done: {} tile canvases, {} hit_regions, {} form_controls",
-            self.tile_canvases.len(), self.hit_regions.len(), self.form_controls.len());
+        crate::debug_surf!("[render] full render done: {} tile canvases, {} layers, {} hit_regions, {} form_controls",
+            self.tile_canvases.len(), self.layer_canvases.len(), self.hit_regions.len(), self.form_controls.len());
     }
 
     // ─────────────────────────────────────────────────────────────────────
@@ -465,13 +555,12 @@ impl Renderer {
     /// This method only needs to create canvases for newly visible tile rows
     /// and remove distant ones.  Tiles already in the cache are free to
     /// create (just a ~900 KB `copy_pixels_from`).  Cache-miss tiles are
-    /// rasterized incrementally (max 2 per call to avoid blocking the
-    /// event loop).
+    /// rasterized from the display list incrementally (max 2 per call to
+    /// avoid blocking the event loop).
     ///
     /// Returns `true` if there are still pending tiles that need creation.
     pub fn render_scroll(
         &mut self,
-        root: &LayoutBox,
         parent: &ui::View,
         images: &ImageCache,
         doc_w: u32,
@@ -490,18 +579,12 @@ impl Renderer {
         self.last_scroll_y = scroll_y;
 
         // 1. Compute tile rows that should have canvases (viewport + buffer).
-        let render_y_start = (scroll_y - BUFFER_ZONE).max(0);
-        let render_y_end = (scroll_y + viewport_h as i32 + BUFFER_ZONE).min(doc_h as i32);
-        let first_row = render_y_start as u32 / TILE_HEIGHT;
-        let last_row = if render_y_end > 0 {
-            ((render_y_end - 1) as u32) / TILE_HEIGHT
-        } else {
-            0
-        };
+        let (first_row, last_row) = visible_rows(scroll_y, viewport_h, doc_h);
 
         // 2. Create canvases for new tile rows (limit rasterization to avoid blocking).
         let mut rasterized = 0usize;
         let mut pending = false;
+        let mut created = false;
         for row in first_row..=last_row {
             // Skip if canvas already exists.
             if self.tile_canvases.iter().any(|tc| tc.row == row) {
@@ -514,13 +597,14 @@ impl Renderer {
                     pending = true;
                     continue;
                 }
-                let tile_buf = rasterize_tile(root, images, w, row, doc_h, clear_color);
+                let tile_buf = rasterize_tile(&self.list, images, w, row, clear_color);
                 self.tile_cache.insert(row, tile_buf);
                 rasterized += 1;
             }
 
             // Create canvas from cached pixel data.
             self.create_tile_canvas(row, w, doc_h, parent);
+            created = true;
         }
 
         // 3. Evict tile canvases that are far from the viewport.
@@ -552,9 +636,32 @@ impl Renderer {
             ui::Control::from_id(tc.canvas.id()).remove();
         }
 
+        // 4. Keep layers above the new tiles and fixed layers in view.
+        if created {
+            self.restack_layers(parent);
+        }
+        self.position_layers(scroll_y);
+
         pending
     }
 
+    /// Keep `position: fixed` layers at their viewport position.
+    ///
+    /// The content_view scrolls as a whole, so a fixed layer sits at its
+    /// viewport offset plus the scroll position.  Cheap: one `set_position`
+    /// per fixed layer, and nothing when the scroll position is unchanged.
+    pub fn position_layers(&mut self, scroll_y: i32) {
+        if scroll_y == self.layer_scroll_y {
+            return;
+        }
+        self.layer_scroll_y = scroll_y;
+        for lc in &self.layer_canvases {
+            if lc.fixed {
+                lc.canvas.set_position(lc.bounds.x, lc.bounds.y + scroll_y);
+            }
+        }
+    }
+
     // ─────────────────────────────────────────────────────────────────────
     // Internal helpers
     // ─────────────────────────────────────────────────────────────────────
@@ -567,7 +674,7 @@ impl Renderer {
         };
 
         let tile_y = (row * TILE_HEIGHT) as i32;
-        let tile_h = TILE_HEIGHT.min(doc_h.saturating_sub(row * TILE_HEIGHT)).max(1);
+        let tile_h = tile_height(row, doc_h);
 
         let c = ui::Canvas::new(doc_w, tile_h);
         c.set_position(0, tile_y);
@@ -578,7 +685,157 @@ impl Renderer {
         parent.add(&c);
         c.copy_pixels_from(pixels);
 
-        self.tile_canvases.push(TileCanvas { row, canvas: c });
+        self.tile_canvases.push(TileCanvas { row, height: tile_h, canvas: c });
+    }
+
+    fn remove_tile_canvases(&mut self) {
+        for tc in self.tile_canvases.drain(..) {
+            ui::Control::from_id(tc.canvas.id()).remove();
+        }
+    }
+
+    /// Bring cached tiles and live tile canvases up to date with `list`.
+    ///
+    /// Rows whose display items are unchanged are left alone.  Otherwise
+    /// only the damaged rect is cleared and repainted from the items that
+    /// intersect it; a tile whose pixels were evicted is rasterized whole.
+    fn repaint_damage(&mut self, list: &DisplayList, images: &ImageCache, doc_h: u32) {
+        let last_row = if doc_h > 0 { (doc_h - 1) / TILE_HEIGHT } else { 0 };
+        let w = self.doc_w;
+        let clear_color = self.clear_color;
+
+        // Rows past the end of the document are gone.
+        self.tile_cache.tiles.retain(|t| t.row <= last_row);
+        self.tile_canvases.retain(|tc| {
+            if tc.row > last_row {
+                ui::Control::from_id(tc.canvas.id()).remove();
+                false
+            } else {
+                true
+            }
+        });
+
+        let mut rows: Vec<u32> = self.tile_cache.tiles.iter().map(|t| t.row).collect();
+        for tc in &self.tile_canvases {
+            if !rows.contains(&tc.row) {
+                rows.push(tc.row);
+            }
+        }
+
+        for row in rows {
+            let damage = match list.row_damage(&self.list, row, w as i32) {
+                Some(d) => d,
+                None => continue,
+            };
+
+            match self.tile_cache.tiles.iter_mut().find(|t| t.row == row) {
+                Some(tile) => {
+                    repaint_rect(list, images, &mut tile.pixels, w, row, &damage, clear_color);
+                    crate::debug_surf!("[render] row {} repainted {}x{} at ({}, {})",
+                        row, damage.w, damage.h, damage.x, damage.y);
+                }
+                None => {
+                    let tile_buf = rasterize_tile(list, images, w, row, clear_color);
+                    self.tile_cache.insert(row, tile_buf);
+                }
+            }
+
+            if let Some(tc) = self.tile_canvases.iter().find(|tc| tc.row == row) {
+                if let Some(px) = self.tile_cache.get(row) {
+                    tc.canvas.copy_pixels_from(px);
+                }
+            }
+        }
+
+        // The last row's canvas must follow the document height.
+        self.tile_canvases.retain(|tc| {
+            if tc.height != tile_height(tc.row, doc_h) {
+                ui::Control::from_id(tc.canvas.id()).remove();
+                false
+            } else {
+                true
+            }
+        });
+    }
+
+    /// Match the layer canvases to the display list's layers.
+    ///
+    /// A layer whose content hash is unchanged keeps its canvas and pixels
+    /// (at most it is moved); changed layers are re-rasterized.  `restack`
+    /// re-adds the canvases so they stay above tiles created this frame.
+    fn update_layers(&mut self, parent: &ui::View, images: &ImageCache, scroll_y: i32, restack: bool) {
+        let mut old = core::mem::take(&mut self.layer_canvases);
+        let mut added = 0usize;
+
+        for layer in &self.list.layers {
+            let y = if layer.fixed { layer.bounds.y + scroll_y } else { layer.bounds.y };
+            let pos = old.iter().position(|lc| {
+                lc.node_id == layer.node_id && lc.hash == layer.hash && lc.bounds.w == layer.bounds.w
+                    && lc.bounds.h == layer.bounds.h
+            });
+            if let Some(i) = pos {
+                let mut lc = old.swap_remove(i);
+                if lc.bounds.x != layer.bounds.x || lc.bounds.y != layer.bounds.y
+                    || lc.fixed != layer.fixed || self.layer_scroll_y != scroll_y
+                {
+                    lc.canvas.set_position(layer.bounds.x, y);
+                }
+                lc.bounds = layer.bounds;
+                lc.fixed = layer.fixed;
+                self.layer_canvases.push(lc);
+                continue;
+            }
+
+            let pixels = rasterize_layer(layer, images);
+            let (w, h) = (layer.bounds.w as u32, layer.bounds.h as u32);
+            let c = ui::Canvas::new(w, h);
+            c.set_position(layer.bounds.x, y);
+            c.set_size(w, h);
+            if let Some(cb) = self.link_cb {
+                c.on_click_raw(cb, self.link_cb_ud);
+            }
+            parent.add(&c);
+            c.copy_pixels_from(&pixels);
+            self.layer_canvases.push(LayerCanvas {
+                node_id: layer.node_id,
+                fixed: layer.fixed,
+                bounds: layer.bounds,
+                hash: layer.hash,
+                pixels,
+                canvas: c,
+            });
+            added += 1;
+        }
+
+        for lc in old {
+            ui::Control::from_id(lc.canvas.id()).remove();
+        }
+        self.layer_scroll_y = scroll_y;
+
+        // Canvases added this frame are already on top, but reused ones sit
+        // below any tile created after them.
+        if restack && self.layer_canvases.len() > added {
+            self.restack_layers(parent);
+        }
+    }
+
+    /// Recreate the layer canvases from their pixels so they stack above
+    /// every tile canvas (children are drawn in insertion order).
+    fn restack_layers(&mut self, parent: &ui::View) {
+        for lc in &mut self.layer_canvases {
+            let (w, h) = (lc.bounds.w as u32, lc.bounds.h as u32);
+            let y = if lc.fixed { lc.bounds.y + self.layer_scroll_y } else { lc.bounds.y };
+            let c = ui::Canvas::new(w, h);
+            c.set_position(lc.bounds.x, y);
+            c.set_size(w, h);
+            if let Some(cb) = self.link_cb {
+                c.on_click_raw(cb, self.link_cb_ud);
+            }
+            parent.add(&c);
+            c.copy_pixels_from(&lc.pixels);
+            ui::Control::from_id(lc.canvas.id()).remove();
+            lc.canvas = c;
+        }
     }
 
     // ─────────────────────────────────────────────────────────────────────
@@ -772,184 +1029,76 @@ impl Renderer {
 // Free functions: tile rasterization, pixel helpers
 // ═══════════════════════════════════════════════════════════════════════════
 
+/// First and last tile rows of the viewport plus the pre-render zone.
+fn visible_rows(scroll_y: i32, viewport_h: u32, doc_h: u32) -> (u32, u32) {
+    let render_y_start = (scroll_y - BUFFER_ZONE).max(0);
+    let render_y_end = (scroll_y + viewport_h as i32 + BUFFER_ZONE).min(doc_h as i32);
+    let first_row = render_y_start as u32 / TILE_HEIGHT;
+    let last_row = if render_y_end > 0 {
+        ((render_y_end - 1) as u32) / TILE_HEIGHT
+    } else {
+        0
+    };
+    (first_row, last_row.max(first_row))
+}
+
+/// Visible height of a tile row (the last row ends at the document height).
+fn tile_height(row: u32, doc_h: u32) -> u32 {
+    TILE_HEIGHT.min(doc_h.saturating_sub(row * TILE_HEIGHT)).max(1)
+}
+
 /// Rasterize a single tile row (pixel-only, no form controls or hit regions).
 ///
-/// Allocates a `doc_w × TILE_HEIGHT` buffer, walks the layout tree with
-/// culling to the tile's Y range, and returns the pixel buffer for caching.
+/// Allocates a `doc_w × TILE_HEIGHT` buffer, paints the display items
+/// indexed under the row, and returns the pixel buffer for caching.
 fn rasterize_tile(
-    root: &LayoutBox,
+    list: &DisplayList,
     images: &ImageCache,
     doc_w: u32,
     row: u32,
-    doc_h: u32,
     clear_color: u32,
 ) -> Vec<u32> {
-    let tile_y_start = (row * TILE_HEIGHT) as i32;
-    let tile_y_end = (tile_y_start + TILE_HEIGHT as i32).min(doc_h as i32);
-    let tile_h = ((tile_y_end - tile_y_start) as u32).max(1);
-
+    let tile_y = (row * TILE_HEIGHT) as i32;
     let pixel_count = (doc_w as usize) * (TILE_HEIGHT as usize);
     let mut buf = Vec::with_capacity(pixel_count);
     buf.resize(pixel_count, clear_color);
 
-    walk_pixels(
-        root, buf.as_mut_ptr(), doc_w, TILE_HEIGHT,
-        images, 0, 0, tile_y_start, tile_y_start + tile_h as i32,
-    );
+    let clip = Rect { x: 0, y: tile_y, w: doc_w as i32, h: TILE_HEIGHT as i32 };
+    paint(list.row(row), images, buf.as_mut_ptr(), doc_w, TILE_HEIGHT, 0, -tile_y, &clip);
 
     buf
 }
 
-/// Pixel-only tree walk — draws backgrounds, borders, text, images, and
-/// submit button appearances into the tile buffer.
+/// Repaint `damage` (document coordinates, inside tile `row`) of a cached
+/// tile: clear it and redraw the row's items that intersect it.
 ///
-/// Skips form controls and hit regions (handled by `walk_controls()`).
-fn walk_pixels(
-    bx: &LayoutBox,
-    buf: *mut u32,
-    stride: u32,
-    buf_h: u32,
+/// Items are painted into a scratch buffer the size of the rect, so nothing
+/// outside it is touched.
+fn repaint_rect(
+    list: &DisplayList,
     images: &ImageCache,
-    offset_x: i32,
-    offset_y: i32,
-    tile_y_start: i32,
-    tile_y_end: i32,
+    tile: &mut [u32],
+    doc_w: u32,
+    row: u32,
+    damage: &Rect,
+    clear_color: u32,
 ) {
-    if bx.visibility_hidden {
-        return;
-    }
-
-    let abs_x = if bx.is_fixed { bx.x } else { offset_x + bx.x };
-    let abs_y = if bx.is_fixed { bx.y } else { offset_y + bx.y };
-
-    // Cull boxes entirely outside the tile.
-    let in_tile = abs_y + bx.height > tile_y_start && abs_y < tile_y_end;
-
-    // Translate Y to tile-local coordinates.
-    let draw_y = abs_y - tile_y_start;
-
-    if in_tile {
-        // Background.
-        if bx.bg_color != 0 && bx.bg_color != 0x00000000 {
-            fill_rect_buf(buf, stride, buf_h, abs_x, draw_y, bx.width, bx.height, bx.bg_color);
-        }
-
-        // Border (4 edges).
-        if bx.border_width > 0 && bx.border_color != 0 && bx.border_color != 0x00000000 {
-            let bw = bx.border_width;
-            let w = bx.width;
-            let h = bx.height;
-            fill_rect_buf(buf, stride, buf_h, abs_x, draw_y, w, bw, bx.border_color);
-            fill_rect_buf(buf, stride, buf_h, abs_x, draw_y + h - bw, w, bw, bx.border_color);
-            let inner_h = (h - bw * 2).max(0);
-            fill_rect_buf(buf, stride, buf_h, abs_x, draw_y + bw, bw, inner_h, bx.border_color);
-            fill_rect_buf(buf, stride, buf_h, abs_x + w - bw, draw_y + bw, bw, inner_h, bx.border_color);
-        }
-
-        // Horizontal rule.
-        if bx.is_hr {
-            fill_rect_buf(buf, stride, buf_h, abs_x, draw_y, bx.width, 1, 0xFF999999);
-        }
-
-        // List marker.
-        if let Some(ref marker) = bx.list_marker {
-            let font_id = 0u32;
-            let font_size = bx.font_size.max(1) as u16;
-            let color = if bx.color != 0 { bx.color } else { 0xFF000000 };
-            libfont_client::draw_string_buf(
-                buf, stride, buf_h,
-                abs_x - 20, draw_y,
-                color, font_id, font_size,
-                marker,
-            );
-        }
-
-        // Text fragment.
-        if let Some(ref text) = bx.text {
-            if !text.is_empty() && bx.form_field.is_none() {
-                let font_id = if bx.bold && bx.italic {
-                    1u32
-                } else if bx.bold {
-                    1u32
-                } else if bx.italic {
-                    3u32
-                } else {
-                    0u32
-                };
-                let font_size = bx.font_size.max(1) as u16;
-                let color = if bx.color != 0 { bx.color } else { 0xFF000000 };
-
-                libfont_client::draw_string_buf(
-                    buf, stride, buf_h,
-                    abs_x, draw_y,
-                    color, font_id, font_size,
-                    text,
-                );
-
-                // Underline for links or text-decoration.
-                if bx.text_decoration == TextDeco::Underline || bx.link_url.is_some() {
-                    fill_rect_buf(buf, stride, buf_h,
-                        abs_x, draw_y + bx.height - 1,
-                        bx.width, 1, color);
-                }
-
-                // Line-through.
-                if bx.text_decoration == TextDeco::LineThrough {
-                    fill_rect_buf(buf, stride, buf_h,
-                        abs_x, draw_y + bx.height / 2,
-                        bx.width, 1, color);
-                }
-            }
-        }
-
-        // Image.
-        if let Some(ref src) = bx.image_src {
-            if let Some(entry) = images.get_ref(src) {
-                let dw = bx.image_width.unwrap_or(bx.width);
-                let dh = bx.image_height.unwrap_or(bx.height);
-                blit_image_buf(
-                    buf, stride, buf_h,
-                    abs_x, draw_y, dw, dh,
-                    &entry.pixels, entry.width, entry.height,
-                );
-            }
-        }
+    let (w, h) = (damage.w as usize, damage.h as usize);
+    let mut scratch = Vec::with_capacity(w * h);
+    scratch.resize(w * h, clear_color);
+    paint(
+        list.row(row), images, scratch.as_mut_ptr(), w as u32, h as u32,
+        -damage.x, -damage.y, damage,
+    );
 
-        // Submit/button pixel drawing (hit region is in walk_controls).
-        if let Some(kind) = bx.form_field {
-            if matches!(kind, FormFieldKind::Submit | FormFieldKind::ButtonEl) {
-                draw_submit_pixels(buf, stride, buf_h, abs_x, draw_y, bx);
-            }
+    let tile_x = damage.x as usize;
+    let tile_y = (damage.y - (row * TILE_HEIGHT) as i32) as usize;
+    for (i, line) in scratch.chunks_exact(w).enumerate() {
+        let start = (tile_y + i) * doc_w as usize + tile_x;
+        if let Some(dst) = tile.get_mut(start..start + w) {
+            dst.copy_from_slice(line);
         }
     }
-
-    // Recurse into children.
-    for child in &bx.children {
-        let (cx, cy) = if bx.is_fixed { (bx.x, bx.y) } else { (abs_x, abs_y) };
-        walk_pixels(child, buf, stride, buf_h, images, cx, cy, tile_y_start, tile_y_end);
-    }
-}
-
-/// Draw submit button appearance into the pixel buffer.
-fn draw_submit_pixels(buf: *mut u32, stride: u32, buf_h: u32, x: i32, y: i32, bx: &LayoutBox) {
-    let label_text = if let Some(ref t) = bx.text { t.as_str() } else { "Submit" };
-
-    // Default web button bg + border if no CSS styling.
-    if bx.bg_color == 0 && bx.border_width == 0 {
-        fill_rect_buf(buf, stride, buf_h, x, y, bx.width, bx.height, 0xFFE0E0E0);
-        fill_rect_buf(buf, stride, buf_h, x, y, bx.width, 1, 0xFF808080);
-        fill_rect_buf(buf, stride, buf_h, x, y + bx.height - 1, bx.width, 1, 0xFF808080);
-        fill_rect_buf(buf, stride, buf_h, x, y + 1, 1, (bx.height - 2).max(0), 0xFF808080);
-        fill_rect_buf(buf, stride, buf_h, x + bx.width - 1, y + 1, 1, (bx.height - 2).max(0), 0xFF808080);
-    }
-
-    // Center text in button.
-    let font_size = bx.font_size.max(1) as u16;
-    let text_color = if bx.color != 0 { bx.color } else { 0xFF000000 };
-    let (tw, _) = libfont_client::measure(0, font_size, label_text);
-    let tx = x + (bx.width - tw as i32) / 2;
-    let ty = y + (bx.height - font_size as i32) / 2;
-    libfont_client::draw_string_buf(buf, stride, buf_h, tx, ty, text_color, 0, font_size, label_text);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -957,7 +1106,7 @@ fn draw_submit_pixels(buf: *mut u32, stride: u32, buf_h: u32, x: i32, y: i32, bx
 // ═══════════════════════════════════════════════════════════════════════════
 
 /// Fill a rectangle directly in the ARGB pixel buffer with clipping.
-fn fill_rect_buf(buf: *mut u32, stride: u32, buf_h: u32, x: i32, y: i32, w: i32, h: i32, color: u32) {
+pub(crate) fn fill_rect_buf(buf: *mut u32, stride: u32, buf_h: u32, x: i32, y: i32, w: i32, h: i32, color: u32) {
     if w <= 0 || h <= 0 || buf.is_null() { return; }
     let s = stride as i32;
     let bh = buf_h as i32;
@@ -1000,7 +1149,7 @@ fn fill_rect_buf(buf: *mut u32, stride: u32, buf_h: u32, x: i32, y: i32, w: i32,
 }
 
 /// Blit image pixels into the buffer with scaling and clipping.
-fn blit_image_buf(
+pub(crate) fn blit_image_buf(
     buf: *mut u32, stride: u32, buf_h: u32,
     dx: i32, dy: i32, dw: i32, dh: i32,
     src: &[u32], src_w: u32, src_h: u32,
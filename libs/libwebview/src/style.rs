@@ -5,6 +5,7 @@
 //! specificity) -> inline styles.  Inheritable properties that are not
 //! explicitly set by any declaration are inherited from the parent node.
 
+use alloc::collections::BTreeMap;
 use alloc::vec;
 use alloc::vec::Vec;
 
@@ -14,7 +15,7 @@ use crate::css::{
     AttrOp, CssValue, Declaration, PseudoClass, Property, Rule, Selector, SimpleSelector,
     Stylesheet, Unit,
 };
-use crate::dom::{Dom, NodeId, NodeType, Tag};
+use crate::dom::{Atom, AtomTable, Dom, NodeId, NodeType, Tag, STYLE_DIRTY_CHILDREN, STYLE_DIRTY_SELF};
 
 // ---------------------------------------------------------------------------
 // Enums
@@ -581,88 +582,80 @@ const TAG_COUNT: usize = 128; // Tag enum has ~100 variants, 128 is safe
 /// we partition rules into buckets so that for a given `<div id="foo" class="bar baz">`
 /// we only check rules whose leaf selector requires `div`, `#foo`, `.bar`, or `.baz`
 /// — plus the "wildcard" rules that have no tag/id/class restriction.
+///
+/// Each selector is filed under one key only (id, else first class, else
+/// tag), since its leaf must match all of them anyway.  Ids and classes are
+/// looked up as atoms of the document (`Dom::atoms`): a selector naming one
+/// that no element has can never match and is not indexed at all.
 struct RuleIndex {
     /// `by_tag[tag_discriminant]` = rule indices whose leaf selector requires that tag.
     by_tag: [Vec<usize>; TAG_COUNT],
-    /// Rules whose leaf selector requires a specific ID.  Key = id string.
-    by_id: Vec<(String, Vec<usize>)>,
-    /// Rules whose leaf selector requires a specific class.  Key = class string.
-    by_class: Vec<(String, Vec<usize>)>,
+    /// Rules whose leaf selector requires a specific ID.
+    by_id: BTreeMap<Atom, Vec<usize>>,
+    /// Rules whose leaf selector requires a specific class.
+    by_class: BTreeMap<Atom, Vec<usize>>,
     /// Rules with no tag/id/class restriction (universal, attribute-only, pseudo-only).
     wildcard: Vec<usize>,
     /// Total number of rules (for bitset sizing).
     rule_count: usize,
+    /// `ancestor_keys[rule][selector]`: Bloom filter keys of the ancestors
+    /// the selector requires, or `None` if it can never match.
+    ancestor_keys: Vec<Vec<Option<AncestorKeys>>>,
 }
 
 impl RuleIndex {
     /// Build the rule index from the collected rules.
-    fn build(all_rules: &[(&Rule, usize)]) -> Self {
+    fn build(all_rules: &[(&Rule, usize)], dom: &Dom) -> Self {
         const EMPTY_VEC: Vec<usize> = Vec::new();
         let mut idx = RuleIndex {
             by_tag: [EMPTY_VEC; TAG_COUNT],
-            by_id: Vec::new(),
-            by_class: Vec::new(),
+            by_id: BTreeMap::new(),
+            by_class: BTreeMap::new(),
             wildcard: Vec::new(),
             rule_count: all_rules.len(),
+            ancestor_keys: Vec::with_capacity(all_rules.len()),
         };
 
         for (rule_idx, (rule, _order)) in all_rules.iter().enumerate() {
             // A rule can have multiple selectors (comma-separated).
             // We must put the rule in every bucket that any of its selectors' leaves require.
-            let mut added_to_any = false;
-
+            let mut keys = Vec::with_capacity(rule.selectors.len());
             for sel in &rule.selectors {
-                match leaf_simple(sel) {
-                    Some(leaf) => {
-                        // Index by the most specific leaf attribute (tag > id > class).
-                        let mut indexed = false;
-
-                        if let Some(tag) = leaf.tag {
-                            let t = tag as usize;
-                            if t < TAG_COUNT {
-                                idx.by_tag[t].push(rule_idx);
-                                indexed = true;
-                            }
-                        }
+                let sel_keys = selector_keys(sel, &dom.atoms);
+                let bucket = match (sel_keys, leaf_simple(sel)) {
+                    (None, _) => None,
+                    (Some(_), Some(leaf)) => {
                         if let Some(ref id) = leaf.id {
-                            push_keyed(&mut idx.by_id, id, rule_idx);
-                            indexed = true;
-                        }
-                        for cls in &leaf.classes {
-                            push_keyed(&mut idx.by_class, cls, rule_idx);
-                            indexed = true;
-                        }
-
-                        if !indexed {
+                            dom.atoms.get(id).map(|a| idx.by_id.entry(a).or_default())
+                        } else if let Some(cls) = leaf.classes.first() {
+                            dom.atoms.get(cls).map(|a| idx.by_class.entry(a).or_default())
+                        } else if let Some(tag) = leaf.tag.filter(|&t| (t as usize) < TAG_COUNT) {
+                            Some(&mut idx.by_tag[tag as usize])
+                        } else {
                             // Attribute-only or pseudo-only selector — goes to wildcard.
-                            if !idx.wildcard.contains(&rule_idx) {
-                                idx.wildcard.push(rule_idx);
-                            }
+                            Some(&mut idx.wildcard)
                         }
-                        added_to_any = true;
                     }
-                    None => {
-                        // Universal selector — matches any element.
-                        if !idx.wildcard.contains(&rule_idx) {
-                            idx.wildcard.push(rule_idx);
-                        }
-                        added_to_any = true;
+                    // Universal selector — matches any element.
+                    (Some(_), None) => Some(&mut idx.wildcard),
+                };
+                if let Some(bucket) = bucket {
+                    if bucket.last() != Some(&rule_idx) {
+                        bucket.push(rule_idx);
                     }
                 }
+                keys.push(sel_keys);
             }
-
-            if !added_to_any {
-                idx.wildcard.push(rule_idx);
-            }
+            idx.ancestor_keys.push(keys);
         }
 
         idx
     }
 
     /// Get candidate rule indices for a node with the given tag, id, and classes.
-    /// Returns a deduplicated list of rule indices to check.
+    /// Returns a deduplicated list of rule indices to check, in rule order.
     /// Uses a bitset for O(1) deduplication instead of Vec::contains() O(n).
-    fn candidates(&self, tag: Tag, id_attr: Option<&str>, class_attr: Option<&str>,
+    fn candidates(&self, tag: Tag, id_atom: Option<Atom>, classes: &[Atom],
                   buf: &mut Vec<usize>, seen: &mut Vec<u64>) {
         buf.clear();
 
@@ -671,10 +664,8 @@ impl RuleIndex {
         seen.clear();
         seen.resize(words_needed, 0u64);
 
-        // Tag bucket.
-        let t = tag as usize;
-        if t < TAG_COUNT {
-            for &ri in &self.by_tag[t] {
+        let mut add = |indices: &[usize]| {
+            for &ri in indices {
                 let word = ri / 64;
                 let bit = 1u64 << (ri % 64);
                 if word < seen.len() && seen[word] & bit == 0 {
@@ -682,47 +673,75 @@ impl RuleIndex {
                     buf.push(ri);
                 }
             }
-        }
+        };
 
+        // Tag bucket.
+        let t = tag as usize;
+        if t < TAG_COUNT {
+            add(&self.by_tag[t]);
+        }
         // ID bucket.
-        if let Some(id) = id_attr {
-            if let Some((_, indices)) = self.by_id.iter().find(|(k, _)| eq_ignore_ascii_case(k, id)) {
-                for &ri in indices {
-                    let word = ri / 64;
-                    let bit = 1u64 << (ri % 64);
-                    if word < seen.len() && seen[word] & bit == 0 {
-                        seen[word] |= bit;
-                        buf.push(ri);
-                    }
-                }
-            }
+        if let Some(indices) = id_atom.and_then(|a| self.by_id.get(&a)) {
+            add(indices);
         }
-
         // Class buckets.
-        if let Some(classes) = class_attr {
-            for (cls_key, indices) in &self.by_class {
-                if has_class(classes, cls_key) {
-                    for &ri in indices {
-                        let word = ri / 64;
-                        let bit = 1u64 << (ri % 64);
-                        if word < seen.len() && seen[word] & bit == 0 {
-                            seen[word] |= bit;
-                            buf.push(ri);
-                        }
-                    }
-                }
+        for cls in classes {
+            if let Some(indices) = self.by_class.get(cls) {
+                add(indices);
             }
         }
-
         // Wildcard rules (always checked).
-        for &ri in &self.wildcard {
-            let word = ri / 64;
-            let bit = 1u64 << (ri % 64);
-            if word < seen.len() && seen[word] & bit == 0 {
-                seen[word] |= bit;
-                buf.push(ri);
+        add(&self.wildcard);
+
+        buf.sort_unstable();
+    }
+}
+
+/// Memoized `RuleIndex::candidates` results.  The candidates only depend
+/// on an element's tag, id and class set, which repeat a lot within a page.
+struct CandidateCache {
+    /// Hash of (tag, id, classes) → lists with that hash.
+    lists: BTreeMap<u64, Vec<CandidateList>>,
+    seen: Vec<u64>,
+}
+
+struct CandidateList {
+    tag: Tag,
+    id_atom: Option<Atom>,
+    classes: Vec<Atom>,
+    rules: Vec<usize>,
+}
+
+impl CandidateCache {
+    fn new() -> Self {
+        CandidateCache { lists: BTreeMap::new(), seen: Vec::new() }
+    }
+
+    /// Candidate rules for element `node_id`.
+    fn get(&mut self, index: &RuleIndex, dom: &Dom, node_id: NodeId, tag: Tag) -> &[usize] {
+        let node = &dom.nodes[node_id];
+        let (id_atom, classes) = (node.id_atom, node.classes.as_slice());
+        let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+        let mut mix = |v: u64| h = (h ^ v).wrapping_mul(0x0000_0100_0000_01b3);
+        mix(tag as u64);
+        mix(id_atom.map_or(0, |a| a as u64 + 1));
+        for &c in classes {
+            mix(c as u64);
+        }
+
+        let bucket = self.lists.entry(h).or_default();
+        let pos = match bucket.iter().position(|l| {
+            l.tag == tag && l.id_atom == id_atom && l.classes == classes
+        }) {
+            Some(pos) => pos,
+            None => {
+                let mut rules = Vec::new();
+                index.candidates(tag, id_atom, classes, &mut rules, &mut self.seen);
+                bucket.push(CandidateList { tag, id_atom, classes: classes.to_vec(), rules });
+                bucket.len() - 1
             }
-        }
+        };
+        &bucket[pos].rules
     }
 }
 
@@ -739,15 +758,184 @@ fn leaf_simple(sel: &Selector) -> Option<&SimpleSelector> {
     }
 }
 
-/// Push `value` into the keyed bucket list.
-fn push_keyed(buckets: &mut Vec<(String, Vec<usize>)>, key: &str, value: usize) {
-    if let Some((_, vec)) = buckets.iter_mut().find(|(k, _)| eq_ignore_ascii_case(k, key)) {
-        vec.push(value);
-    } else {
-        let mut v = Vec::new();
-        v.push(value);
-        buckets.push((String::from(key), v));
+// ---------------------------------------------------------------------------
+// Ancestor Bloom filter
+// ---------------------------------------------------------------------------
+
+/// log2 of the number of filter counters.
+const BLOOM_BITS: u32 = 12;
+const BLOOM_MASK: u32 = (1 << BLOOM_BITS) - 1;
+
+/// Ancestor requirements checked per selector (0 = unused slot).
+type AncestorKeys = [u32; 4];
+
+const KEY_TAG: u32 = 1;
+const KEY_ID: u32 = 2;
+const KEY_CLASS: u32 = 3;
+
+/// Filter key of a tag, id or class; never 0.
+fn bloom_key(kind: u32, value: u32) -> u32 {
+    let h = (value ^ kind.wrapping_mul(0x9e37_79b9)).wrapping_mul(0x85eb_ca6b);
+    let h = h ^ (h >> 15);
+    if h == 0 { 1 } else { h }
+}
+
+/// Counting Bloom filter of the tags, ids and classes of the ancestors of
+/// the element being styled, as in WebKit and Servo.
+///
+/// A descendant or child selector whose ancestor compounds need a tag, id
+/// or class missing from the filter cannot match, which rejects most such
+/// rules without walking up the tree.  `enter` keeps the filter in step
+/// with the traversal: in document order that is a push or a few pops.
+struct AncestorFilter {
+    counters: Vec<u8>,
+    /// Elements in the filter, root first.
+    path: Vec<NodeId>,
+    /// Scratch for `enter`.
+    chain: Vec<NodeId>,
+}
+
+impl AncestorFilter {
+    fn new() -> Self {
+        AncestorFilter {
+            counters: vec![0; 1 << BLOOM_BITS],
+            path: Vec::new(),
+            chain: Vec::new(),
+        }
+    }
+
+    /// Make the filter hold exactly the ancestors of a node whose parent
+    /// is `parent`.
+    fn enter(&mut self, dom: &Dom, parent: Option<NodeId>) {
+        if parent.is_some() && self.path.last() == parent.as_ref() {
+            return;
+        }
+        // Climb from the parent until reaching a node already on the path.
+        self.chain.clear();
+        let mut cur = parent;
+        while let Some(p) = cur {
+            if let Some(pos) = self.path.iter().rposition(|&n| n == p) {
+                while self.path.len() > pos + 1 {
+                    self.pop(dom);
+                }
+                break;
+            }
+            if p >= dom.nodes.len() || self.chain.len() > dom.nodes.len() {
+                break;
+            }
+            self.chain.push(p);
+            cur = dom.nodes[p].parent;
+        }
+        if cur.is_none() {
+            while !self.path.is_empty() {
+                self.pop(dom);
+            }
+        }
+        while let Some(p) = self.chain.pop() {
+            self.path.push(p);
+            for_each_key(dom, p, |k| {
+                for i in [k & BLOOM_MASK, (k >> BLOOM_BITS) & BLOOM_MASK] {
+                    let c = &mut self.counters[i as usize];
+                    *c = c.saturating_add(1);
+                }
+            });
+        }
+    }
+
+    fn pop(&mut self, dom: &Dom) {
+        if let Some(n) = self.path.pop() {
+            for_each_key(dom, n, |k| {
+                for i in [k & BLOOM_MASK, (k >> BLOOM_BITS) & BLOOM_MASK] {
+                    // Saturated counters stay set: the filter only errs
+                    // towards "maybe present".
+                    let c = &mut self.counters[i as usize];
+                    if *c != u8::MAX && *c != 0 {
+                        *c -= 1;
+                    }
+                }
+            });
+        }
+    }
+
+    /// False if some key is certainly not on any ancestor.
+    fn might_contain(&self, keys: &AncestorKeys) -> bool {
+        keys.iter().all(|&k| {
+            k == 0
+                || (self.counters[(k & BLOOM_MASK) as usize] != 0
+                    && self.counters[((k >> BLOOM_BITS) & BLOOM_MASK) as usize] != 0)
+        })
+    }
+}
+
+/// Call `f` with the filter key of the tag, id and each class of `id`.
+fn for_each_key(dom: &Dom, id: NodeId, mut f: impl FnMut(u32)) {
+    let node = &dom.nodes[id];
+    if let NodeType::Element { tag, .. } = &node.node_type {
+        f(bloom_key(KEY_TAG, *tag as u32));
+        if let Some(a) = node.id_atom {
+            f(bloom_key(KEY_ID, a));
+        }
+        for &c in &node.classes {
+            f(bloom_key(KEY_CLASS, c));
+        }
+    }
+}
+
+/// Filter keys for the ancestors `sel` requires, or `None` if the selector
+/// names an id or class that does not occur in the document.
+///
+/// Only compounds reached through descendant and child combinators are
+/// ancestors; the walk stops at a sibling combinator.
+fn selector_keys(sel: &Selector, atoms: &AtomTable) -> Option<AncestorKeys> {
+    let mut keys = [0u32; 4];
+    let mut n = 0;
+    if let Some(leaf) = leaf_simple(sel) {
+        // Leaf compounds add no keys but must be satisfiable.
+        simple_keys(leaf, atoms, &mut [0u32; 4], &mut 4)?;
+    }
+    let mut cur = match sel {
+        Selector::Descendant(a, _) | Selector::Child(a, _) => Some(&**a),
+        _ => None,
+    };
+    while let Some(s) = cur {
+        cur = match s {
+            Selector::Universal => None,
+            Selector::Simple(x) => {
+                simple_keys(x, atoms, &mut keys, &mut n)?;
+                None
+            }
+            Selector::Descendant(a, x) | Selector::Child(a, x) => {
+                simple_keys(x, atoms, &mut keys, &mut n)?;
+                Some(&**a)
+            }
+            Selector::AdjacentSibling(_, x) | Selector::GeneralSibling(_, x) => {
+                simple_keys(x, atoms, &mut keys, &mut n)?;
+                None
+            }
+        };
+    }
+    Some(keys)
+}
+
+/// Append the keys of one compound (id first, the most selective), while
+/// slots remain.  `None` if it names an unknown id or class.
+fn simple_keys(s: &SimpleSelector, atoms: &AtomTable, keys: &mut AncestorKeys, n: &mut usize) -> Option<()> {
+    let mut push = |k: u32| {
+        if *n < keys.len() {
+            keys[*n] = k;
+            *n += 1;
+        }
+    };
+    if let Some(ref id) = s.id {
+        push(bloom_key(KEY_ID, atoms.get(id)?));
+    }
+    for cls in &s.classes {
+        push(bloom_key(KEY_CLASS, atoms.get(cls)?));
+    }
+    if let Some(tag) = s.tag {
+        push(bloom_key(KEY_TAG, tag as u32));
     }
+    Some(())
 }
 
 // ---------------------------------------------------------------------------
@@ -849,24 +1037,17 @@ fn simple_matches(sel: &SimpleSelector, dom: &Dom, node_id: NodeId) -> bool {
 
     // ID check.
     if let Some(ref sel_id) = sel.id {
-        let node_id_attr = attrs.iter().find(|a| eq_ignore_ascii_case(&a.name, "id"));
-        match node_id_attr {
-            Some(a) if eq_ignore_ascii_case(&a.value, sel_id) => {}
+        match dom.atoms.get(sel_id) {
+            Some(a) if node.id_atom == Some(a) => {}
             _ => return false,
         }
     }
 
     // Class check: every selector class must be present on the node.
-    if !sel.classes.is_empty() {
-        let class_attr = attrs.iter().find(|a| eq_ignore_ascii_case(&a.name, "class"));
-        let class_str = match class_attr {
-            Some(a) => &a.value,
-            Option::None => return false,
-        };
-        for sc in &sel.classes {
-            if !has_class(class_str, sc) {
-                return false;
-            }
+    for sc in &sel.classes {
+        match dom.atoms.get(sc) {
+            Some(a) if dom.has_class(node_id, a) => {}
+            _ => return false,
         }
     }
 
@@ -1095,200 +1276,431 @@ pub fn resolve_styles(
     viewport_height: i32,
     inline_style_cache: &mut Vec<(usize, Vec<Declaration>)>,
 ) -> Vec<ComputedStyle> {
-    let count = dom.nodes.len();
-    crate::debug_surf!("[style] resolve_styles: {} nodes, {} stylesheets", count, stylesheets.len());
-    #[cfg(feature = "debug_surf")]
-    crate::debug_surf!("[style]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
-
-    let mut styles: Vec<ComputedStyle> = Vec::with_capacity(count);
-    let root_font_size: i32 = 16;
-
-    // ── Pre-collect all applicable CSS rules ONCE (node-independent). ──
-    let mut all_rules: Vec<(&Rule, usize)> = Vec::new();
-    let mut order = 0usize;
-    for sheet in stylesheets {
-        for rule in &sheet.rules {
-            all_rules.push((rule, order));
-            order += 1;
-        }
-        for mr in &sheet.media_rules {
-            if crate::css::evaluate_media_query(&mr.query, viewport_width, viewport_height) {
-                for rule in &mr.rules {
-                    all_rules.push((rule, order));
-                    order += 1;
-                }
-            }
+    let mut cache = StyleCache::new();
+    cache.resolve(dom, stylesheets, 0, viewport_width, viewport_height, inline_style_cache);
+    cache.styles
+}
+
+/// Computed styles kept across relayouts.
+///
+/// [`StyleCache::resolve`] only recomputes the nodes whose style a DOM
+/// mutation could have changed: every node flagged in `Dom::style_dirty`
+/// plus its subtree, and — when the stylesheets use `+`/`~` or structural
+/// pseudo-classes — the affected siblings.  Everything else keeps last
+/// frame's style.  A change of stylesheets or of the media queries that
+/// apply restyles the whole document.
+pub struct StyleCache {
+    styles: Vec<ComputedStyle>,
+    /// Custom properties defined on each node (`--name: value`).
+    custom_props: Vec<Vec<(String, String)>>,
+    /// Hash of each element's tag and matched rules; 0 if its style cannot
+    /// be shared (inline `style=`).  Used for sibling style sharing.
+    rule_sigs: Vec<u64>,
+    /// Stylesheet generation and media-query results the cache was built with.
+    sheets_key: Option<(u32, u64)>,
+    /// Nodes recomputed by the last `resolve`, indexed by `NodeId`.
+    restyle: Vec<bool>,
+    /// Nodes recomputed by the last `resolve`.
+    pub restyled: usize,
+    /// Of those, nodes that copied a sibling's style instead of cascading.
+    pub shared: usize,
+}
+
+/// Selector features that widen invalidation beyond a node's subtree.
+#[derive(Clone, Copy, Default)]
+struct SheetFeatures {
+    /// `A + B` / `A ~ B`.
+    siblings: bool,
+    /// `:first-child`, `:nth-child()`, `:last-of-type`, ...
+    structural: bool,
+    /// `:empty`.
+    empty: bool,
+}
+
+impl StyleCache {
+    pub fn new() -> Self {
+        Self {
+            styles: Vec::new(),
+            custom_props: Vec::new(),
+            rule_sigs: Vec::new(),
+            sheets_key: None,
+            restyle: Vec::new(),
+            restyled: 0,
+            shared: 0,
         }
     }
-    crate::debug_surf!("[style] collected {} applicable rules (once)", all_rules.len());
 
-    // Build rule index for O(1) tag/id/class lookup (avoids O(nodes × rules) brute force).
-    let rule_index = RuleIndex::build(&all_rules);
-    crate::debug_surf!("[style] rule index: {} wildcard, {} id-buckets, {} class-buckets",
-        rule_index.wildcard.len(), rule_index.by_id.len(), rule_index.by_class.len());
+    /// Styles from the last `resolve`, indexed by `NodeId`.
+    pub fn styles(&self) -> &[ComputedStyle] {
+        &self.styles
+    }
 
-    // Reusable scratch buffers for per-node matching (avoids repeated alloc/free).
-    let mut matches: Vec<((u32, u32, u32), usize)> = Vec::with_capacity(64);
-    let mut candidates: Vec<usize> = Vec::with_capacity(128);
-    let mut seen_bitset: Vec<u64> = Vec::with_capacity((all_rules.len() + 63) / 64);
+    /// Which nodes the last `resolve` recomputed, indexed by `NodeId`.
+    pub fn restyled_nodes(&self) -> &[bool] {
+        &self.restyle
+    }
 
-    // Separate storage for custom properties (--name: value).
-    // Only nodes that DEFINE custom properties have non-empty entries.
-    // var() references are resolved on-demand by walking the DOM parent chain,
-    // eliminating the per-node clone that caused heap-stack collision on large
-    // pages (~54 MiB for chip.de's 6228 nodes).
-    let mut custom_props: Vec<Vec<(String, String)>> = vec![Vec::new(); count];
+    /// Drop all cached styles; the next `resolve` restyles every node.
+    pub fn clear(&mut self) {
+        self.styles.clear();
+        self.custom_props.clear();
+        self.rule_sigs.clear();
+        self.sheets_key = None;
+    }
 
-    for id in 0..count {
+    /// Bring the cached styles up to date with `dom`.
+    ///
+    /// `generation` identifies the stylesheet set: the caller bumps it
+    /// whenever a sheet is added, removed or re-parsed.  Style-dirty flags
+    /// are read but not cleared; the caller owns the DOM and clears them.
+    pub fn resolve(
+        &mut self,
+        dom: &Dom,
+        stylesheets: &[&Stylesheet],
+        generation: u32,
+        viewport_width: i32,
+        viewport_height: i32,
+        inline_style_cache: &mut Vec<(usize, Vec<Declaration>)>,
+    ) {
+        let count = dom.nodes.len();
+        crate::debug_surf!("[style] resolve_styles: {} nodes, {} stylesheets", count, stylesheets.len());
         #[cfg(feature = "debug_surf")]
-        {
-            if id < 5 || id % 1000 == 0 {
-                crate::debug_surf!("[style] node {}/{} RSP=0x{:X} heap=0x{:X}",
-                    id, count, crate::debug_rsp(), crate::debug_heap_pos());
+        crate::debug_surf!("[style]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
+
+        let root_font_size: i32 = 16;
+
+        // ── Pre-collect all applicable CSS rules ONCE (node-independent). ──
+        // The media-query results are hashed into the cache key: a viewport
+        // change only forces a full restyle if it flips a query.
+        let mut all_rules: Vec<(&Rule, usize)> = Vec::new();
+        let mut order = 0usize;
+        let mut media_key: u64 = 0xcbf2_9ce4_8422_2325;
+        for sheet in stylesheets {
+            for rule in &sheet.rules {
+                all_rules.push((rule, order));
+                order += 1;
+            }
+            for mr in &sheet.media_rules {
+                let applies = crate::css::evaluate_media_query(&mr.query, viewport_width, viewport_height);
+                media_key = (media_key ^ applies as u64).wrapping_mul(0x0000_0100_0000_01b3);
+                if applies {
+                    for rule in &mr.rules {
+                        all_rules.push((rule, order));
+                        order += 1;
+                    }
+                }
             }
         }
+        crate::debug_surf!("[style] collected {} applicable rules (once)", all_rules.len());
+
+        // Decide which nodes to recompute.
+        let key = (generation, media_key);
+        let full = self.sheets_key != Some(key);
+        self.sheets_key = Some(key);
+        self.styles.truncate(count);
+        self.styles.resize_with(count, default_style);
+        self.custom_props.truncate(count);
+        self.custom_props.resize_with(count, Vec::new);
+        self.rule_sigs.truncate(count);
+        self.rule_sigs.resize(count, 0);
+        self.restyle = if full {
+            vec![true; count]
+        } else {
+            restyle_set(dom, sheet_features(&all_rules))
+        };
+        let restyle = &self.restyle;
+        self.restyled = 0;
+        self.shared = 0;
+        if !full && !restyle.iter().any(|&r| r) {
+            crate::debug_surf!("[style] resolve_styles: nothing dirty");
+            return;
+        }
 
-        let node = &dom.nodes[id];
-        let parent_fs = node.parent.map_or(16, |pid| {
-            if pid < id { styles[pid].font_size } else { 16 }
+        // A changed style="" attribute must be re-parsed.
+        inline_style_cache.retain(|(nid, _)| {
+            dom.style_dirty.get(*nid).map_or(false, |&f| f & STYLE_DIRTY_SELF == 0)
         });
 
-        // Phase 1: Start from UA defaults (elements) or initial values (text).
-        let (mut style, mut set_flags) = match &node.node_type {
-            NodeType::Element { tag, .. } => ua_style_and_flags(*tag),
-            NodeType::Text(_) => {
-                let mut s = default_style();
-                s.display = Display::Inline;
-                (s, 0u16)
+        // Build rule index for O(1) tag/id/class lookup (avoids O(nodes × rules) brute force).
+        let rule_index = RuleIndex::build(&all_rules, dom);
+        crate::debug_surf!("[style] rule index: {} wildcard, {} id-buckets, {} class-buckets",
+            rule_index.wildcard.len(), rule_index.by_id.len(), rule_index.by_class.len());
+
+        // Reusable scratch buffers for per-node matching (avoids repeated alloc/free).
+        let mut matches: Vec<((u32, u32, u32), usize)> = Vec::with_capacity(64);
+        let mut candidates = CandidateCache::new();
+        let mut ancestors = AncestorFilter::new();
+
+        // Custom properties (--name: value) are stored separately from the
+        // styles.  Only nodes that DEFINE custom properties have non-empty
+        // entries; var() references are resolved on-demand by walking the DOM
+        // parent chain, eliminating the per-node clone that caused heap-stack
+        // collision on large pages (~54 MiB for chip.de's 6228 nodes).
+        let styles = &mut self.styles;
+        let custom_props = &mut self.custom_props;
+        let rule_sigs = &mut self.rule_sigs;
+
+        for id in 0..count {
+            if !restyle[id] {
+                continue;
+            }
+            self.restyled += 1;
+            #[cfg(feature = "debug_surf")]
+            {
+                if id < 5 || id % 1000 == 0 {
+                    crate::debug_surf!("[style] node {}/{} RSP=0x{:X} heap=0x{:X}",
+                        id, count, crate::debug_rsp(), crate::debug_heap_pos());
+                }
             }
-        };
 
-        // Phase 2 + 3: Apply author rules and inline styles.
-        // Custom property declarations are stored in custom_props[id].
-        // var() references are resolved by walking the parent chain.
-        if matches!(node.node_type, NodeType::Element { .. }) {
-            let (ancestors_cp, current_and_rest) = custom_props.split_at_mut(id);
-            let node_cp = &mut current_and_rest[0];
-
-            set_flags |= apply_author_rules(
-                &mut style, dom, id, &all_rules, &rule_index,
-                &mut candidates, &mut seen_bitset, &mut matches,
-                parent_fs, root_font_size, node_cp, ancestors_cp,
-            );
-
-            // Phase 3: Apply inline styles (highest specificity).
-            // Uses a cache to avoid re-parsing style="..." on every relayout.
-            if let NodeType::Element { attrs, .. } = &node.node_type {
-                for a in attrs {
-                    if eq_ignore_ascii_case(&a.name, "style") {
-                        // Look up cached declarations for this node, or parse and cache.
-                        let cached_idx = inline_style_cache.iter().position(|(nid, _)| *nid == id);
-                        let inline_decls: &[Declaration] = if let Some(ci) = cached_idx {
-                            &inline_style_cache[ci].1
-                        } else {
-                            let parsed = crate::css::parse_inline_style(&a.value);
-                            inline_style_cache.push((id, parsed));
-                            &inline_style_cache.last().unwrap().1
-                        };
-
-                        for decl in inline_decls {
-                            if let Property::CustomProperty(ref name) = decl.property {
-                                if let CssValue::Keyword(ref val) = decl.value {
-                                    store_custom_prop(node_cp, name, val);
-                                }
-                            } else if let CssValue::Var(_, _) = &decl.value {
-                                let resolved = resolve_var_in_decl(
-                                    decl, dom, id, node_cp, ancestors_cp,
-                                );
-                                set_flags |= decl_set_flag(&resolved.property);
-                                apply_declaration(
-                                    &mut style, &resolved, parent_fs, root_font_size,
-                                );
-                            } else {
-                                set_flags |= decl_set_flag(&decl.property);
-                                apply_declaration(
-                                    &mut style, decl, parent_fs, root_font_size,
-                                );
+            let node = &dom.nodes[id];
+            let parent_fs = node.parent.map_or(16, |pid| {
+                if pid < id { styles[pid].font_size } else { 16 }
+            });
+            custom_props[id].clear();
+            rule_sigs[id] = 0;
+
+            // Phase 1: Start from UA defaults (elements) or initial values (text).
+            let (mut style, mut set_flags) = match &node.node_type {
+                NodeType::Element { tag, .. } => ua_style_and_flags(*tag),
+                NodeType::Text(_) => {
+                    let mut s = default_style();
+                    s.display = Display::Inline;
+                    (s, 0u16)
+                }
+            };
+
+            // Phase 2 + 3: Apply author rules and inline styles.
+            // Custom property declarations are stored in custom_props[id].
+            // var() references are resolved by walking the parent chain.
+            if let NodeType::Element { tag, attrs } = &node.node_type {
+                ancestors.enter(dom, node.parent);
+                match_author_rules(
+                    dom, id, &all_rules, &rule_index,
+                    &mut candidates, &ancestors, &mut matches,
+                );
+
+                // Style sharing: an element with the same tag and matched
+                // rules as its preceding sibling (and no inline style on
+                // either) cascades to the same style, so copy it.
+                let inline = attrs.iter().find(|a| eq_ignore_ascii_case(&a.name, "style"));
+                if inline.is_none() {
+                    let sig = rule_signature(*tag, &matches);
+                    rule_sigs[id] = sig;
+                    if let (Some(pid), Some(sib)) = (node.parent, preceding_element_sibling(dom, id)) {
+                        if pid < sib && sib < id && rule_sigs[sib] == sig {
+                            styles[id] = styles[sib].clone();
+                            custom_props[id] = custom_props[sib].clone();
+                            self.shared += 1;
+                            continue;
+                        }
+                    }
+                }
+
+                let (ancestors_cp, current_and_rest) = custom_props.split_at_mut(id);
+                let node_cp = &mut current_and_rest[0];
+
+                set_flags |= apply_author_rules(
+                    &mut style, dom, id, &all_rules, &matches,
+                    parent_fs, root_font_size, node_cp, ancestors_cp,
+                );
+
+                // Phase 3: Apply inline styles (highest specificity).
+                // Uses a cache to avoid re-parsing style="..." on every relayout.
+                if let Some(a) = inline {
+                    // Look up cached declarations for this node, or parse and cache.
+                    let cached_idx = inline_style_cache.iter().position(|(nid, _)| *nid == id);
+                    let inline_decls: &[Declaration] = if let Some(ci) = cached_idx {
+                        &inline_style_cache[ci].1
+                    } else {
+                        let parsed = crate::css::parse_inline_style(&a.value);
+                        inline_style_cache.push((id, parsed));
+                        &inline_style_cache.last().unwrap().1
+                    };
+
+                    for decl in inline_decls {
+                        if let Property::CustomProperty(ref name) = decl.property {
+                            if let CssValue::Keyword(ref val) = decl.value {
+                                store_custom_prop(node_cp, name, val);
                             }
+                        } else if let CssValue::Var(_, _) = &decl.value {
+                            let resolved = resolve_var_in_decl(
+                                decl, dom, id, node_cp, ancestors_cp,
+                            );
+                            set_flags |= decl_set_flag(&resolved.property);
+                            apply_declaration(
+                                &mut style, &resolved, parent_fs, root_font_size,
+                            );
+                        } else {
+                            set_flags |= decl_set_flag(&decl.property);
+                            apply_declaration(
+                                &mut style, decl, parent_fs, root_font_size,
+                            );
                         }
-                        break;
                     }
                 }
             }
-        }
 
-        // (Phase 3b removed: custom properties are resolved on-demand via
-        // parent chain walk, eliminating the per-node clone that caused
-        // heap-stack collision on large pages.)
+            // (Phase 3b removed: custom properties are resolved on-demand via
+            // parent chain walk, eliminating the per-node clone that caused
+            // heap-stack collision on large pages.)
 
-        // Phase 4: Inherit inheritable properties NOT explicitly set.
-        if let Some(pid) = node.parent {
-            if pid < id {
-                inherit_unset(&mut style, &styles[pid], set_flags);
+            // Phase 4: Inherit inheritable properties NOT explicitly set.
+            if let Some(pid) = node.parent {
+                if pid < id {
+                    inherit_unset(&mut style, &styles[pid], set_flags);
+                }
             }
-        }
 
-        // Phase 5: Resolve `li` list_style from parent (ol -> decimal).
-        if let NodeType::Element { tag: Tag::Li, .. } = &node.node_type {
-            if set_flags & SET_LIST_STYLE != 0 && style.list_style == ListStyle::Disc {
-                if let Some(pid) = node.parent {
-                    if dom.tag(pid) == Some(Tag::Ol) {
-                        style.list_style = ListStyle::Decimal;
+            // Phase 5: Resolve `li` list_style from parent (ol -> decimal).
+            if let NodeType::Element { tag: Tag::Li, .. } = &node.node_type {
+                if set_flags & SET_LIST_STYLE != 0 && style.list_style == ListStyle::Disc {
+                    if let Some(pid) = node.parent {
+                        if dom.tag(pid) == Some(Tag::Ol) {
+                            style.list_style = ListStyle::Decimal;
+                        }
                     }
                 }
             }
+
+            // Phase 6: Resolve auto line_height.
+            if style.line_height == 0 {
+                style.line_height = (style.font_size * 6 + 2) / 5;
+            }
+
+            styles[id] = style;
+        }
+
+        crate::debug_surf!("[style] resolve_styles done: {} of {} nodes restyled ({} shared, full={})",
+            self.restyled, count, self.shared, full);
+        #[cfg(feature = "debug_surf")]
+        crate::debug_surf!("[style]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
+    }
+}
+
+/// Scan the collected rules for selector features that widen invalidation.
+fn sheet_features(all_rules: &[(&Rule, usize)]) -> SheetFeatures {
+    let mut f = SheetFeatures::default();
+    for (rule, _) in all_rules {
+        for sel in &rule.selectors {
+            selector_features(sel, &mut f);
         }
+    }
+    f
+}
 
-        // Phase 6: Resolve auto line_height.
-        if style.line_height == 0 {
-            style.line_height = (style.font_size * 6 + 2) / 5;
+fn selector_features(sel: &Selector, f: &mut SheetFeatures) {
+    match sel {
+        Selector::Universal => {}
+        Selector::Simple(s) => simple_features(s, f),
+        Selector::Descendant(a, s) | Selector::Child(a, s) => {
+            selector_features(a, f);
+            simple_features(s, f);
         }
+        Selector::AdjacentSibling(a, s) | Selector::GeneralSibling(a, s) => {
+            f.siblings = true;
+            selector_features(a, f);
+            simple_features(s, f);
+        }
+    }
+}
 
-        styles.push(style);
+fn simple_features(sel: &SimpleSelector, f: &mut SheetFeatures) {
+    for pc in &sel.pseudo_classes {
+        match pc {
+            PseudoClass::FirstChild | PseudoClass::LastChild
+            | PseudoClass::NthChild(_) | PseudoClass::NthLastChild(_)
+            | PseudoClass::FirstOfType | PseudoClass::LastOfType => f.structural = true,
+            PseudoClass::Empty => f.empty = true,
+            PseudoClass::Not(inner) => simple_features(inner, f),
+            _ => {}
+        }
     }
+}
 
-    crate::debug_surf!("[style] resolve_styles done: {} styles", styles.len());
-    #[cfg(feature = "debug_surf")]
-    crate::debug_surf!("[style]   RSP=0x{:X} heap=0x{:X}", crate::debug_rsp(), crate::debug_heap_pos());
-    styles
+/// Nodes to recompute this frame, from `Dom::style_dirty`.
+///
+/// A dirty node restyles its subtree (inheritance and descendant
+/// selectors); with sibling combinators its following siblings too.  A
+/// changed child list restyles the children when their position can
+/// matter, and the parent itself under `:empty`.
+fn restyle_set(dom: &Dom, features: SheetFeatures) -> Vec<bool> {
+    let count = dom.nodes.len();
+    let mut restyle = vec![false; count];
+    let mut stack: Vec<NodeId> = Vec::new();
+    for id in 0..count {
+        let flags = dom.style_dirty.get(id).copied().unwrap_or(0);
+        if flags == 0 {
+            continue;
+        }
+        if flags & STYLE_DIRTY_SELF != 0 {
+            stack.push(id);
+            if features.siblings {
+                if let Some(pid) = dom.nodes[id].parent {
+                    let siblings = &dom.nodes[pid].children;
+                    if let Some(pos) = siblings.iter().position(|&c| c == id) {
+                        stack.extend_from_slice(&siblings[pos + 1..]);
+                    }
+                }
+            }
+        }
+        if flags & STYLE_DIRTY_CHILDREN != 0 {
+            if features.empty {
+                stack.push(id);
+            } else if features.siblings || features.structural {
+                stack.extend_from_slice(&dom.nodes[id].children);
+            }
+        }
+        // Mark whole subtrees; an already-marked node's subtree is marked.
+        while let Some(n) = stack.pop() {
+            if n >= count || restyle[n] {
+                continue;
+            }
+            restyle[n] = true;
+            stack.extend_from_slice(&dom.nodes[n].children);
+        }
+    }
+    restyle
 }
 
-fn apply_author_rules(
-    style: &mut ComputedStyle,
+/// Sharing key for an element: its tag and the rules it matched.  Never 0.
+fn rule_signature(tag: Tag, matches: &[((u32, u32, u32), usize)]) -> u64 {
+    let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+    let mut mix = |v: u64| h = (h ^ v).wrapping_mul(0x0000_0100_0000_01b3);
+    mix(tag as u64);
+    mix(matches.len() as u64);
+    for &(_, idx) in matches {
+        mix(idx as u64);
+    }
+    h | 1
+}
+
+/// Collect the author rules matching `node_id` into `matches`, sorted into
+/// cascade order.
+fn match_author_rules(
     dom: &Dom,
     node_id: NodeId,
     all_rules: &[(&Rule, usize)],
     rule_index: &RuleIndex,
-    candidates: &mut Vec<usize>,
-    seen_bitset: &mut Vec<u64>,
+    candidates: &mut CandidateCache,
+    ancestors: &AncestorFilter,
     matches: &mut Vec<((u32, u32, u32), usize)>,
-    parent_fs: i32,
-    root_fs: i32,
-    node_cp: &mut Vec<(String, String)>,
-    ancestors_cp: &[Vec<(String, String)>],
-) -> u16 {
+) {
     // Reuse the caller's matches buffer (avoids alloc/free per node).
     matches.clear();
 
     // Use the rule index to get only candidate rules for this node's tag/id/classes.
-    let node = &dom.nodes[node_id];
-    let (tag, attrs) = match &node.node_type {
-        NodeType::Element { tag, attrs } => (*tag, attrs),
-        _ => return 0,
+    let tag = match &dom.nodes[node_id].node_type {
+        NodeType::Element { tag, .. } => *tag,
+        _ => return,
     };
-    let id_attr = attrs.iter()
-        .find(|a| eq_ignore_ascii_case(&a.name, "id"))
-        .map(|a| a.value.as_str());
-    let class_attr = attrs.iter()
-        .find(|a| eq_ignore_ascii_case(&a.name, "class"))
-        .map(|a| a.value.as_str());
-
-    rule_index.candidates(tag, id_attr, class_attr, candidates, seen_bitset);
 
-    for &idx in candidates.iter() {
+    for &idx in candidates.get(rule_index, dom, node_id, tag) {
         let (rule, _order) = all_rules[idx];
-        for sel in &rule.selectors {
-            if selector_matches(sel, dom, node_id) {
+        for (sel, keys) in rule.selectors.iter().zip(&rule_index.ancestor_keys[idx]) {
+            // Reject on the ancestor filter before walking up the tree.
+            let possible = keys.map_or(false, |k| ancestors.might_contain(&k));
+            if possible && selector_matches(sel, dom, node_id) {
                 matches.push((sel.specificity(), idx));
                 break;
             }
@@ -1297,7 +1709,21 @@ fn apply_author_rules(
 
     // Sort by specificity (ascending); equal specificity keeps source order.
     matches.sort_by(|a, b| a.0.cmp(&b.0).then(a.1.cmp(&b.1)));
+}
 
+/// Apply the declarations of the rules in `matches` (from
+/// `match_author_rules`).  Returns the inheritable properties they set.
+fn apply_author_rules(
+    style: &mut ComputedStyle,
+    dom: &Dom,
+    node_id: NodeId,
+    all_rules: &[(&Rule, usize)],
+    matches: &[((u32, u32, u32), usize)],
+    parent_fs: i32,
+    root_fs: i32,
+    node_cp: &mut Vec<(String, String)>,
+    ancestors_cp: &[Vec<(String, String)>],
+) -> u16 {
     let mut set_flags: u16 = 0;
 
     // Phase 1: Apply normal (non-!important) declarations.
@@ -1,85 +1,65 @@
 //! DEFLATE compression (RFC 1951).
 //!
-//! Implements stored blocks (no compression) and fixed Huffman encoding with
-//! LZ77 matching for reasonable compression ratios.
-
+//! LZ77 matching on hash chains, followed by Huffman coding of each block
+//! with whichever of stored, fixed or dynamic (per-block) codes is
+//! smallest.  Compression levels 1-9 follow zlib's parameter table: levels
+//! 1-3 match greedily and skip indexing inside long matches, levels 4-9
+//! use lazy matching (a match is deferred by one byte if the next position
+//! has a longer one), and every level bounds the hash chain walk.
+
+use alloc::vec;
 use alloc::vec::Vec;
 
+/// Level used by [`deflate`].
+pub const DEFAULT_LEVEL: u32 = 6;
+/// Highest compression level.
+pub const MAX_LEVEL: u32 = 9;
+
 // ─── Bit Writer ─────────────────────────────────────────────────────────────
 
 struct BitWriter {
     output: Vec<u8>,
-    bit_buf: u32,
-    bit_count: u8,
+    bit_buf: u64,
+    bit_count: u32,
 }
 
 impl BitWriter {
-    fn new() -> Self {
-        BitWriter { output: Vec::new(), bit_buf: 0, bit_count: 0 }
+    fn new(capacity: usize) -> Self {
+        BitWriter { output: Vec::with_capacity(capacity), bit_buf: 0, bit_count: 0 }
     }
 
-    fn write_bits(&mut self, value: u32, count: u8) {
-        self.bit_buf |= value << self.bit_count;
+    /// Append the low `count` (at most 32) bits of `value`, which must
+    /// have no higher bits set.
+    #[inline]
+    fn write_bits(&mut self, value: u32, count: u32) {
+        self.bit_buf |= (value as u64) << self.bit_count;
         self.bit_count += count;
-        while self.bit_count >= 8 {
-            self.output.push(self.bit_buf as u8);
-            self.bit_buf >>= 8;
-            self.bit_count -= 8;
+        if self.bit_count >= 32 {
+            self.output.extend_from_slice(&(self.bit_buf as u32).to_le_bytes());
+            self.bit_buf >>= 32;
+            self.bit_count -= 32;
         }
     }
 
-    fn flush(&mut self) {
-        if self.bit_count > 0 {
+    /// Pad with zero bits to a byte boundary.
+    fn align(&mut self) {
+        while self.bit_count > 0 {
             self.output.push(self.bit_buf as u8);
-            self.bit_buf = 0;
-            self.bit_count = 0;
+            self.bit_buf >>= 8;
+            self.bit_count = self.bit_count.saturating_sub(8);
         }
+        self.bit_buf = 0;
     }
 
     fn finish(mut self) -> Vec<u8> {
-        self.flush();
+        self.align();
         self.output
     }
 }
 
-// ─── Fixed Huffman Codes ────────────────────────────────────────────────────
-
-/// Encode a literal/length symbol using fixed Huffman codes.
-fn encode_fixed_literal(writer: &mut BitWriter, sym: u16) {
-    // Fixed Huffman code table (reversed bit order for DEFLATE):
-    // 0-143:   8-bit codes 00110000..10111111 (0x30..0xBF)
-    // 144-255: 9-bit codes 110010000..111111111 (0x190..0x1FF)
-    // 256-279: 7-bit codes 0000000..0010111 (0x00..0x17)
-    // 280-287: 8-bit codes 11000000..11000111 (0xC0..0xC7)
-    if sym <= 143 {
-        let code = 0x30 + sym as u32;
-        writer.write_bits(reverse_bits(code, 8), 8);
-    } else if sym <= 255 {
-        let code = 0x190 + (sym as u32 - 144);
-        writer.write_bits(reverse_bits(code, 9), 9);
-    } else if sym <= 279 {
-        let code = sym as u32 - 256;
-        writer.write_bits(reverse_bits(code, 7), 7);
-    } else {
-        let code = 0xC0 + (sym as u32 - 280);
-        writer.write_bits(reverse_bits(code, 8), 8);
-    }
-}
-
-/// Encode a distance symbol using fixed Huffman codes (all 5-bit).
-fn encode_fixed_distance(writer: &mut BitWriter, sym: u8) {
-    writer.write_bits(reverse_bits(sym as u32, 5), 5);
-}
-
 /// Reverse the lowest `bits` bits of `value`.
-fn reverse_bits(value: u32, bits: u8) -> u32 {
-    let mut result = 0u32;
-    let mut v = value;
-    for _ in 0..bits {
-        result = (result << 1) | (v & 1);
-        v >>= 1;
-    }
-    result
+fn reverse_bits(value: u32, bits: u32) -> u32 {
+    value.reverse_bits() >> (32 - bits)
 }
 
 // ─── Length / Distance Encoding ─────────────────────────────────────────────
@@ -109,147 +89,686 @@ const DIST_EXTRA: [u8; 30] = [
     9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
 ];
 
-fn find_length_code(length: u16) -> (u16, u8, u16) {
-    for i in (0..29).rev() {
-        if length >= LENGTH_BASE[i] {
-            let extra_val = length - LENGTH_BASE[i];
-            return (257 + i as u16, LENGTH_EXTRA[i], extra_val);
+/// Length code index (0..29) of each match length minus 3.
+static LENGTH_CODE: [u8; 256] = length_codes();
+/// Distance code of distances 1..=256 (index `dist - 1`).
+static DIST_CODE_LO: [u8; 256] = dist_codes(0);
+/// Distance code of distances 257..=32768 (index `(dist - 1) >> 7`).
+static DIST_CODE_HI: [u8; 256] = dist_codes(7);
+
+const fn length_codes() -> [u8; 256] {
+    let mut t = [0u8; 256];
+    let mut code = 0;
+    let mut len = 0;
+    while len < 256 {
+        while code < 28 && len + 3 >= LENGTH_BASE[code + 1] as usize {
+            code += 1;
         }
+        t[len] = code as u8;
+        len += 1;
     }
-    (257, 0, 0)
+    t
 }
 
-fn find_distance_code(dist: u16) -> (u8, u8, u16) {
-    for i in (0..30).rev() {
-        if dist >= DIST_BASE[i] {
-            let extra_val = dist - DIST_BASE[i];
-            return (i as u8, DIST_EXTRA[i], extra_val);
+const fn dist_codes(shift: u32) -> [u8; 256] {
+    let mut t = [0u8; 256];
+    let mut code = 0;
+    let mut i = 0;
+    while i < 256 {
+        let dist = (i << shift) + 1;
+        while code < 29 && dist >= DIST_BASE[code + 1] as usize {
+            code += 1;
         }
+        t[i] = code as u8;
+        i += 1;
+    }
+    t
+}
+
+#[inline]
+fn dist_code(dist: usize) -> usize {
+    if dist <= 256 {
+        DIST_CODE_LO[dist - 1] as usize
+    } else {
+        DIST_CODE_HI[(dist - 1) >> 7] as usize
     }
-    (0, 0, 0)
 }
 
+// ─── Levels ─────────────────────────────────────────────────────────────────
+
+struct Level {
+    /// Quarter the chain once the previous match is this long.
+    good: u16,
+    /// Lazy levels: no lazy search after a match this long.
+    /// Greedy levels: longest match whose positions are all indexed.
+    lazy: u16,
+    /// Stop searching at a match this long.
+    nice: u16,
+    /// Hash chain entries visited per search.
+    chain: u16,
+    lazy_match: bool,
+}
+
+/// zlib's configuration table (index = level).
+const LEVELS: [Level; 10] = [
+    Level { good: 0, lazy: 0, nice: 0, chain: 0, lazy_match: false },
+    Level { good: 4, lazy: 4, nice: 8, chain: 4, lazy_match: false },
+    Level { good: 4, lazy: 5, nice: 16, chain: 8, lazy_match: false },
+    Level { good: 4, lazy: 6, nice: 32, chain: 32, lazy_match: false },
+    Level { good: 4, lazy: 4, nice: 16, chain: 16, lazy_match: true },
+    Level { good: 8, lazy: 16, nice: 32, chain: 32, lazy_match: true },
+    Level { good: 8, lazy: 16, nice: 128, chain: 128, lazy_match: true },
+    Level { good: 8, lazy: 32, nice: 128, chain: 256, lazy_match: true },
+    Level { good: 32, lazy: 128, nice: 258, chain: 1024, lazy_match: true },
+    Level { good: 32, lazy: 258, nice: 258, chain: 4096, lazy_match: true },
+];
+
 // ─── LZ77 Hash Chain ───────────────────────────────────────────────────────
 
-const HASH_SIZE: usize = 4096;
-const HASH_MASK: usize = HASH_SIZE - 1;
+const HASH_BITS: u32 = 15;
+const HASH_SIZE: usize = 1 << HASH_BITS;
 const MAX_MATCH: usize = 258;
 const MIN_MATCH: usize = 3;
 const WINDOW_SIZE: usize = 32768;
-
-fn hash3(data: &[u8], pos: usize) -> usize {
-    if pos + 2 >= data.len() {
-        return 0;
-    }
-    let h = (data[pos] as usize) ^ ((data[pos + 1] as usize) << 4) ^ ((data[pos + 2] as usize) << 8);
-    h & HASH_MASK
+const WINDOW_MASK: usize = WINDOW_SIZE - 1;
+/// Length-3 matches farther than this cost more than three literals.
+const TOO_FAR: usize = 4096;
+const NIL: u32 = u32::MAX;
+
+/// Tokens per block before its Huffman codes are rebuilt.
+const BLOCK_TOKENS: usize = 16 * 1024;
+
+struct Matcher<'a> {
+    data: &'a [u8],
+    head: Vec<u32>,
+    prev: Vec<u32>,
 }
 
-/// Find best match at `pos` using hash chain. Returns (length, distance) or (0, 0).
-fn find_match(data: &[u8], pos: usize, head: &[u32; HASH_SIZE], prev: &[u32]) -> (usize, usize) {
-    if pos + MIN_MATCH > data.len() {
-        return (0, 0);
+impl<'a> Matcher<'a> {
+    fn new(data: &'a [u8]) -> Self {
+        Matcher { data, head: vec![NIL; HASH_SIZE], prev: vec![NIL; WINDOW_SIZE] }
     }
 
-    let h = hash3(data, pos);
-    let mut chain = head[h];
-    let mut best_len = 0usize;
-    let mut best_dist = 0usize;
-    let mut chain_limit = 64; // Max chain depth to search
+    #[inline]
+    fn hash(&self, pos: usize) -> usize {
+        let d = self.data;
+        let v = d[pos] as u32 | (d[pos + 1] as u32) << 8 | (d[pos + 2] as u32) << 16;
+        (v.wrapping_mul(0x9E37_79B1) >> (32 - HASH_BITS)) as usize
+    }
 
-    while chain != u32::MAX && chain_limit > 0 {
-        let candidate = chain as usize;
-        if candidate >= pos || pos - candidate > WINDOW_SIZE {
-            break;
+    /// Index the string at `pos`; returns the previous chain head.
+    #[inline]
+    fn insert(&mut self, pos: usize) -> u32 {
+        if pos + MIN_MATCH > self.data.len() {
+            return NIL;
         }
-        let dist = pos - candidate;
+        let h = self.hash(pos);
+        let old = self.head[h];
+        self.prev[pos & WINDOW_MASK] = old;
+        self.head[h] = pos as u32;
+        old
+    }
 
-        // Compare
+    /// Longest match for `pos` longer than `best`, walking the chain from
+    /// `cand`.  Returns `(length, distance)`, length 0 if none.
+    fn longest(&self, pos: usize, mut cand: u32, best: usize, level: &Level) -> (usize, usize) {
+        let data = self.data;
         let max_len = (data.len() - pos).min(MAX_MATCH);
-        let mut len = 0;
-        while len < max_len && data[candidate + len] == data[pos + len] {
-            len += 1;
+        if max_len < MIN_MATCH {
+            return (0, 0);
+        }
+        let mut chain = level.chain as u32;
+        if best >= level.good as usize {
+            chain >>= 2;
         }
+        let nice = (level.nice as usize).min(max_len);
+        let mut best_len = best.max(MIN_MATCH - 1);
+        let mut best_dist = 0;
 
-        if len >= MIN_MATCH && len > best_len {
-            best_len = len;
-            best_dist = dist;
-            if len == MAX_MATCH {
+        while cand != NIL && chain > 0 {
+            let c = cand as usize;
+            if pos - c > WINDOW_SIZE {
                 break;
             }
+            // A longer match must agree at its last byte
+            if best_len < max_len && data[c + best_len] == data[pos + best_len] {
+                let len = match_len(data, c, pos, max_len);
+                if len > best_len {
+                    best_len = len;
+                    best_dist = pos - c;
+                    if len >= nice {
+                        break;
+                    }
+                }
+            }
+            cand = self.prev[c & WINDOW_MASK];
+            chain -= 1;
         }
-
-        chain = prev[candidate % WINDOW_SIZE];
-        chain_limit -= 1;
+        if best_dist == 0 || (best_len == MIN_MATCH && best_dist > TOO_FAR) {
+            return (0, 0);
+        }
+        (best_len, best_dist)
     }
+}
 
-    (best_len, best_dist)
+/// Length of the common prefix of `data[a..]` and `data[b..]` (`a < b`), at
+/// most `max_len`.
+#[inline]
+fn match_len(data: &[u8], a: usize, b: usize, max_len: usize) -> usize {
+    let mut len = 0;
+    while len + 8 <= max_len {
+        let x = u64::from_le_bytes(data[a + len..a + len + 8].try_into().unwrap());
+        let y = u64::from_le_bytes(data[b + len..b + len + 8].try_into().unwrap());
+        let diff = x ^ y;
+        if diff != 0 {
+            return len + (diff.trailing_zeros() / 8) as usize;
+        }
+        len += 8;
+    }
+    while len < max_len && data[a + len] == data[b + len] {
+        len += 1;
+    }
+    len
 }
 
 // ─── Deflate ────────────────────────────────────────────────────────────────
 
-/// Compress data using DEFLATE with fixed Huffman codes and LZ77.
+/// Compress data using DEFLATE at [`DEFAULT_LEVEL`].
 pub fn deflate(data: &[u8]) -> Vec<u8> {
-    if data.is_empty() {
-        // Empty stored block
-        let mut writer = BitWriter::new();
-        writer.write_bits(1, 1); // bfinal
-        writer.write_bits(1, 2); // btype = fixed
-        encode_fixed_literal(&mut writer, 256); // end of block
-        return writer.finish();
-    }
+    deflate_level(data, DEFAULT_LEVEL)
+}
 
-    let mut writer = BitWriter::new();
-    writer.write_bits(1, 1); // bfinal
-    writer.write_bits(1, 2); // btype = fixed Huffman
+/// Compress data using DEFLATE at `level` (0 = stored, 1 = fastest,
+/// 9 = smallest; higher values are clamped to 9).
+pub fn deflate_level(data: &[u8], level: u32) -> Vec<u8> {
+    deflate_segment(data, 0, level, true)
+}
 
-    // Initialize hash chains
-    let mut head = [u32::MAX; HASH_SIZE];
-    let mut prev = alloc::vec![u32::MAX; WINDOW_SIZE];
-    let mut pos = 0;
+/// Compress `buf[start..]` as one piece of a longer DEFLATE stream, with
+/// `buf[..start]` (up to the last 32 KiB of it) as the preceding history.
+///
+/// Matches may reach back into the history but never past the end of
+/// `buf`, so pieces can be compressed independently — in parallel even —
+/// and concatenated.  Only the piece with `last` set ends the stream; the
+/// others end with an empty stored block, which byte-aligns them (a zlib
+/// "sync flush").
+pub fn deflate_segment(buf: &[u8], start: usize, level: u32, last: bool) -> Vec<u8> {
+    let start = start.min(buf.len());
+    let mut enc = Encoder {
+        writer: BitWriter::new((buf.len() - start) / 2 + 64),
+        data: buf,
+        tokens: Vec::with_capacity(BLOCK_TOKENS),
+        block_start: start,
+        block_len: 0,
+    };
+    if level == 0 {
+        write_stored(&mut enc.writer, &buf[start..], last);
+        return enc.writer.finish();
+    }
+    let level = &LEVELS[level.min(MAX_LEVEL) as usize];
+    let mut m = Matcher::new(buf);
+    for pos in start.saturating_sub(WINDOW_SIZE)..start {
+        m.insert(pos);
+    }
+    if level.lazy_match {
+        compress_lazy(&mut enc, &mut m, start, level);
+    } else {
+        compress_greedy(&mut enc, &mut m, start, level);
+    }
+    if last || !enc.tokens.is_empty() {
+        enc.flush_block(last);
+    }
+    if !last {
+        write_stored(&mut enc.writer, &[], false);
+    }
+    enc.writer.finish()
+}
 
+/// Levels 1-3: take the first match found; inside matches longer than
+/// `level.lazy` positions are not indexed.
+fn compress_greedy(enc: &mut Encoder, m: &mut Matcher, start: usize, level: &Level) {
+    let data = m.data;
+    let mut pos = start;
     while pos < data.len() {
-        let (match_len, match_dist) = find_match(data, pos, &head, &prev);
-
-        if match_len >= MIN_MATCH {
-            // Emit length/distance pair
-            let (len_code, len_extra_bits, len_extra_val) = find_length_code(match_len as u16);
-            encode_fixed_literal(&mut writer, len_code);
-            if len_extra_bits > 0 {
-                writer.write_bits(len_extra_val as u32, len_extra_bits);
+        let cand = m.insert(pos);
+        let (len, dist) = if cand != NIL { m.longest(pos, cand, 0, level) } else { (0, 0) };
+        if len >= MIN_MATCH {
+            enc.push_match(len, dist);
+            if len <= level.lazy as usize {
+                for p in pos + 1..pos + len {
+                    m.insert(p);
+                }
             }
+            pos += len;
+        } else {
+            enc.push_literal();
+            pos += 1;
+        }
+    }
+}
+
+/// Levels 4-9: a match at `pos - 1` is only taken if `pos` has no longer one.
+fn compress_lazy(enc: &mut Encoder, m: &mut Matcher, start: usize, level: &Level) {
+    let data = m.data;
+    let mut pos = start;
+    let mut prev_len = 0;
+    let mut prev_dist = 0;
+    let mut pending = false; // literal at pos - 1 not emitted yet
+    while pos < data.len() {
+        let cand = m.insert(pos);
+        let (len, dist) = if cand != NIL && prev_len < level.lazy as usize {
+            m.longest(pos, cand, prev_len, level)
+        } else {
+            (0, 0)
+        };
+        if prev_len >= MIN_MATCH && len <= prev_len {
+            enc.push_match(prev_len, prev_dist);
+            let end = pos - 1 + prev_len;
+            for p in pos + 1..end {
+                m.insert(p);
+            }
+            pos = end;
+            pending = false;
+            prev_len = 0;
+        } else {
+            if pending {
+                enc.push_literal();
+            }
+            pending = true;
+            prev_len = len;
+            prev_dist = dist;
+            pos += 1;
+        }
+    }
+    if pending {
+        enc.push_literal();
+    }
+}
+
+// ─── Block Encoding ─────────────────────────────────────────────────────────
+
+/// Order in which code length code lengths are sent.
+const CL_ORDER: [usize; 19] = [16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15];
+
+struct Encoder<'a> {
+    writer: BitWriter,
+    data: &'a [u8],
+    /// `dist << 16 | len` for matches, the byte for literals (dist 0).
+    tokens: Vec<u32>,
+    /// Input range covered by `tokens`.
+    block_start: usize,
+    block_len: usize,
+}
+
+/// Huffman code: bit-reversed codes and their lengths.
+struct Code {
+    codes: Vec<u16>,
+    lens: Vec<u8>,
+}
 
-            let (dist_code, dist_extra_bits, dist_extra_val) = find_distance_code(match_dist as u16);
-            encode_fixed_distance(&mut writer, dist_code);
-            if dist_extra_bits > 0 {
-                writer.write_bits(dist_extra_val as u32, dist_extra_bits);
+impl Code {
+    fn from_lengths(lens: &[u8]) -> Code {
+        let mut count = [0u16; 16];
+        for &l in lens {
+            count[l as usize] += 1;
+        }
+        count[0] = 0;
+        let mut next = [0u16; 16];
+        let mut code = 0u16;
+        for bits in 1..16 {
+            code = (code + count[bits - 1]) << 1;
+            next[bits] = code;
+        }
+        let mut codes = vec![0u16; lens.len()];
+        for (sym, &l) in lens.iter().enumerate() {
+            if l != 0 {
+                codes[sym] = reverse_bits(next[l as usize] as u32, l as u32) as u16;
+                next[l as usize] += 1;
             }
+        }
+        Code { codes, lens: lens.to_vec() }
+    }
 
-            // Update hash for all matched positions
-            for i in 0..match_len {
-                if pos + i + MIN_MATCH <= data.len() {
-                    let h = hash3(data, pos + i);
-                    prev[(pos + i) % WINDOW_SIZE] = head[h];
-                    head[h] = (pos + i) as u32;
-                }
+    fn fixed_lit() -> Code {
+        let mut lens = [8u8; 288];
+        lens[144..256].fill(9);
+        lens[256..280].fill(7);
+        Code::from_lengths(&lens)
+    }
+
+    fn fixed_dist() -> Code {
+        Code::from_lengths(&[5u8; 30])
+    }
+
+    #[inline]
+    fn put(&self, w: &mut BitWriter, sym: usize) {
+        w.write_bits(self.codes[sym] as u32, self.lens[sym] as u32);
+    }
+}
+
+impl<'a> Encoder<'a> {
+    #[inline]
+    fn push_literal(&mut self) {
+        self.tokens.push(self.data[self.block_start + self.block_len] as u32);
+        self.block_len += 1;
+        if self.tokens.len() == BLOCK_TOKENS {
+            self.flush_block(false);
+        }
+    }
+
+    #[inline]
+    fn push_match(&mut self, len: usize, dist: usize) {
+        self.tokens.push((dist as u32) << 16 | len as u32);
+        self.block_len += len;
+        if self.tokens.len() == BLOCK_TOKENS {
+            self.flush_block(false);
+        }
+    }
+
+    /// Emit the pending tokens as the smallest of a stored, fixed or
+    /// dynamic block.
+    fn flush_block(&mut self, last: bool) {
+        let mut lit_freq = [0u32; 286];
+        let mut dist_freq = [0u32; 30];
+        for &t in &self.tokens {
+            let dist = (t >> 16) as usize;
+            if dist == 0 {
+                lit_freq[t as usize] += 1;
+            } else {
+                lit_freq[257 + LENGTH_CODE[(t & 0xFFFF) as usize - 3] as usize] += 1;
+                dist_freq[dist_code(dist)] += 1;
             }
-            pos += match_len;
+        }
+        lit_freq[256] = 1;
+
+        // Extra bits are the same for fixed and dynamic codes
+        let mut extra = 0u64;
+        for (i, &f) in lit_freq[257..].iter().enumerate() {
+            extra += f as u64 * LENGTH_EXTRA[i] as u64;
+        }
+        for (i, &f) in dist_freq.iter().enumerate() {
+            extra += f as u64 * DIST_EXTRA[i] as u64;
+        }
+
+        let fixed_lit = Code::fixed_lit();
+        let fixed_dist = Code::fixed_dist();
+        let fixed_cost = 3 + extra + cost(&lit_freq, &fixed_lit.lens) + cost(&dist_freq, &fixed_dist.lens);
+
+        let dynamic = DynamicHeader::new(&lit_freq, &dist_freq);
+        let dyn_cost = 3 + extra + dynamic.header_bits
+            + cost(&lit_freq, &dynamic.lit.lens) + cost(&dist_freq, &dynamic.dist.lens);
+
+        let raw = &self.data[self.block_start..self.block_start + self.block_len];
+        let chunks = (raw.len() / 65535 + 1) as u64;
+        let stored_cost = raw.len() as u64 * 8 + chunks * (3 + 7 + 32);
+
+        let w = &mut self.writer;
+        if stored_cost < fixed_cost.min(dyn_cost) {
+            write_stored(w, raw, last);
+        } else if fixed_cost <= dyn_cost {
+            w.write_bits(last as u32 | 1 << 1, 3);
+            write_tokens(w, &self.tokens, &fixed_lit, &fixed_dist);
         } else {
-            // Emit literal
-            encode_fixed_literal(&mut writer, data[pos] as u16);
-
-            // Update hash
-            if pos + MIN_MATCH <= data.len() {
-                let h = hash3(data, pos);
-                prev[pos % WINDOW_SIZE] = head[h];
-                head[h] = pos as u32;
+            w.write_bits(last as u32 | 2 << 1, 3);
+            dynamic.write(w);
+            write_tokens(w, &self.tokens, &dynamic.lit, &dynamic.dist);
+        }
+
+        self.block_start += self.block_len;
+        self.block_len = 0;
+        self.tokens.clear();
+    }
+}
+
+fn cost(freq: &[u32], lens: &[u8]) -> u64 {
+    freq.iter().zip(lens).map(|(&f, &l)| f as u64 * l as u64).sum()
+}
+
+fn write_tokens(w: &mut BitWriter, tokens: &[u32], lit: &Code, dist: &Code) {
+    for &t in tokens {
+        let d = (t >> 16) as usize;
+        if d == 0 {
+            lit.put(w, t as usize);
+            continue;
+        }
+        let len = (t & 0xFFFF) as usize;
+        let lc = LENGTH_CODE[len - 3] as usize;
+        lit.put(w, 257 + lc);
+        if LENGTH_EXTRA[lc] > 0 {
+            w.write_bits((len - LENGTH_BASE[lc] as usize) as u32, LENGTH_EXTRA[lc] as u32);
+        }
+        let dc = dist_code(d);
+        dist.put(w, dc);
+        if DIST_EXTRA[dc] > 0 {
+            w.write_bits((d - DIST_BASE[dc] as usize) as u32, DIST_EXTRA[dc] as u32);
+        }
+    }
+    lit.put(w, 256);
+}
+
+fn write_stored(w: &mut BitWriter, raw: &[u8], last: bool) {
+    let mut chunks = raw.chunks(65535).peekable();
+    if raw.is_empty() {
+        w.write_bits(last as u32, 3);
+        w.align();
+        w.output.extend_from_slice(&[0, 0, 0xFF, 0xFF]);
+        return;
+    }
+    while let Some(chunk) = chunks.next() {
+        let final_chunk = last && chunks.peek().is_none();
+        w.write_bits(final_chunk as u32, 3);
+        w.align();
+        let len = chunk.len() as u16;
+        w.output.extend_from_slice(&len.to_le_bytes());
+        w.output.extend_from_slice(&(!len).to_le_bytes());
+        w.output.extend_from_slice(chunk);
+    }
+}
+
+/// Dynamic block codes and their run-length coded header.
+struct DynamicHeader {
+    lit: Code,
+    dist: Code,
+    hlit: usize,
+    hdist: usize,
+    /// Code length symbols with their extra bits value.
+    cl_syms: Vec<(u8, u8)>,
+    cl: Code,
+    hclen: usize,
+    header_bits: u64,
+}
+
+impl DynamicHeader {
+    fn new(lit_freq: &[u32; 286], dist_freq: &[u32; 30]) -> Self {
+        let mut lit_freq = *lit_freq;
+        let mut dist_freq = *dist_freq;
+        // At least two codes per tree keep every code complete
+        ensure_two(&mut lit_freq);
+        ensure_two(&mut dist_freq);
+
+        let mut lit_lens = [0u8; 286];
+        let mut dist_lens = [0u8; 30];
+        huffman_lengths(&lit_freq, 15, &mut lit_lens);
+        huffman_lengths(&dist_freq, 15, &mut dist_lens);
+        let hlit = 257.max(lit_lens.iter().rposition(|&l| l != 0).unwrap_or(0) + 1);
+        let hdist = 1.max(dist_lens.iter().rposition(|&l| l != 0).unwrap_or(0) + 1);
+
+        let mut all = Vec::with_capacity(hlit + hdist);
+        all.extend_from_slice(&lit_lens[..hlit]);
+        all.extend_from_slice(&dist_lens[..hdist]);
+        let cl_syms = run_length(&all);
+
+        let mut cl_freq = [0u32; 19];
+        for &(sym, _) in &cl_syms {
+            cl_freq[sym as usize] += 1;
+        }
+        let mut cl_lens = [0u8; 19];
+        huffman_lengths(&cl_freq, 7, &mut cl_lens);
+        let hclen = 4.max(CL_ORDER.iter().rposition(|&s| cl_lens[s] != 0).unwrap_or(0) + 1);
+
+        let mut header_bits = 5 + 5 + 4 + 3 * hclen as u64;
+        for &(sym, _) in &cl_syms {
+            header_bits += cl_lens[sym as usize] as u64 + [2, 3, 7].get((sym as usize).wrapping_sub(16)).copied().unwrap_or(0);
+        }
+
+        DynamicHeader {
+            lit: Code::from_lengths(&lit_lens),
+            dist: Code::from_lengths(&dist_lens),
+            hlit,
+            hdist,
+            cl_syms,
+            cl: Code::from_lengths(&cl_lens),
+            hclen,
+            header_bits,
+        }
+    }
+
+    fn write(&self, w: &mut BitWriter) {
+        w.write_bits((self.hlit - 257) as u32, 5);
+        w.write_bits((self.hdist - 1) as u32, 5);
+        w.write_bits((self.hclen - 4) as u32, 4);
+        for &s in &CL_ORDER[..self.hclen] {
+            w.write_bits(self.cl.lens[s] as u32, 3);
+        }
+        for &(sym, val) in &self.cl_syms {
+            self.cl.put(w, sym as usize);
+            match sym {
+                16 => w.write_bits(val as u32, 2),
+                17 => w.write_bits(val as u32, 3),
+                18 => w.write_bits(val as u32, 7),
+                _ => {}
             }
-            pos += 1;
         }
     }
+}
+
+fn ensure_two(freq: &mut [u32]) {
+    let used = freq.iter().filter(|&&f| f != 0).count();
+    for i in 0..freq.len() {
+        if used + i >= 2 {
+            break;
+        }
+        if freq[i] == 0 {
+            freq[i] = 1;
+        } else if freq[i + 1] == 0 {
+            freq[i + 1] = 1;
+        }
+    }
+}
+
+/// Run-length code a sequence of code lengths with symbols 16-18.
+fn run_length(lens: &[u8]) -> Vec<(u8, u8)> {
+    let mut out = Vec::with_capacity(lens.len());
+    let mut i = 0;
+    while i < lens.len() {
+        let l = lens[i];
+        let mut run = lens[i..].iter().take_while(|&&x| x == l).count();
+        i += run;
+        if l == 0 {
+            while run >= 11 {
+                let r = run.min(138);
+                out.push((18, (r - 11) as u8));
+                run -= r;
+            }
+            if run >= 3 {
+                out.push((17, (run - 3) as u8));
+                run = 0;
+            }
+        } else {
+            out.push((l, 0));
+            run -= 1;
+            while run >= 3 {
+                let r = run.min(6);
+                out.push((16, (r - 3) as u8));
+                run -= r;
+            }
+        }
+        for _ in 0..run {
+            out.push((l, 0));
+        }
+    }
+    out
+}
+
+/// Huffman code lengths for `freq`, at most `limit` bits.
+fn huffman_lengths(freq: &[u32], limit: usize, lens: &mut [u8]) {
+    lens.fill(0);
+    let mut syms: Vec<(u32, u16)> = freq
+        .iter()
+        .enumerate()
+        .filter(|(_, &f)| f != 0)
+        .map(|(s, &f)| (f, s as u16))
+        .collect();
+    match syms.len() {
+        0 => return,
+        1 => {
+            lens[syms[0].1 as usize] = 1;
+            return;
+        }
+        _ => {}
+    }
+    syms.sort_unstable();
+
+    // Two-queue construction: leaves in frequency order, internal nodes in
+    // creation order (which is also non-decreasing).
+    let n = syms.len();
+    let mut weight: Vec<u64> = syms.iter().map(|&(f, _)| f as u64).collect();
+    weight.resize(2 * n - 1, 0);
+    let mut parent = vec![0usize; 2 * n - 1];
+    let (mut leaf, mut node) = (0, n);
+    for k in n..2 * n - 1 {
+        let mut pick = || {
+            if leaf < n && (node >= k || weight[leaf] <= weight[node]) {
+                leaf += 1;
+                leaf - 1
+            } else {
+                node += 1;
+                node - 1
+            }
+        };
+        let (a, b) = (pick(), pick());
+        weight[k] = weight[a] + weight[b];
+        parent[a] = k;
+        parent[b] = k;
+    }
 
-    encode_fixed_literal(&mut writer, 256); // End of block
-    writer.finish()
+    // Leaf depths, counted per length (deeper than 32 lumped at 32)
+    let mut depth = vec![0u8; 2 * n - 1];
+    let mut count = [0u32; 33];
+    for k in (0..2 * n - 2).rev() {
+        depth[k] = (depth[parent[k]] + 1).min(32);
+        if k < n {
+            count[depth[k] as usize] += 1;
+        }
+    }
+
+    // Fold overlong codes into `limit`, then restore the Kraft equality by
+    // lengthening the deepest codes that are still short enough
+    for l in limit + 1..=32 {
+        count[limit] += count[l];
+        count[l] = 0;
+    }
+    let mut total: u64 = (1..=limit).map(|l| (count[l] as u64) << (limit - l)).sum();
+    while total > 1 << limit {
+        count[limit] -= 1;
+        for l in (1..limit).rev() {
+            if count[l] != 0 {
+                count[l] -= 1;
+                count[l + 1] += 2;
+                break;
+            }
+        }
+        total -= 1;
+    }
+
+    // Longest codes to the rarest symbols
+    let mut s = 0;
+    for l in (1..=limit).rev() {
+        for _ in 0..count[l] {
+            lens[syms[s].1 as usize] = l as u8;
+            s += 1;
+        }
+    }
 }
 
 /// Store data without compression (stored blocks).
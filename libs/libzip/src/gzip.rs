@@ -1,12 +1,11 @@
 //! Gzip compression/decompression (RFC 1952).
 //!
 //! Gzip is a thin wrapper around DEFLATE with a 10-byte header and 8-byte trailer.
-//! Reuses the existing `deflate` and `inflate` modules for the actual compression.
+//! Reuses the `deflate` module and libinflate for the actual compression.
 
 use alloc::vec::Vec;
 use crate::crc32;
 use crate::deflate;
-use crate::inflate;
 
 // ── Gzip constants ──────────────────────────────────────────────────────────
 
@@ -24,20 +23,17 @@ const FCOMMENT: u8 = 0x10;
 
 /// Compress data into gzip format (RFC 1952).
 pub fn gzip_compress(data: &[u8]) -> Vec<u8> {
+    gzip_compress_level(data, deflate::DEFAULT_LEVEL)
+}
+
+/// Compress data into gzip format at DEFLATE `level` (0-9).
+pub fn gzip_compress_level(data: &[u8], level: u32) -> Vec<u8> {
     let crc = crc32::crc32(data);
     let isize = data.len() as u32;
-    let compressed = deflate::deflate(data);
+    let compressed = deflate::deflate_level(data, level);
 
     let mut out = Vec::with_capacity(10 + compressed.len() + 8);
-
-    // Header (10 bytes)
-    out.push(GZIP_MAGIC[0]);       // ID1
-    out.push(GZIP_MAGIC[1]);       // ID2
-    out.push(METHOD_DEFLATE);      // CM
-    out.push(0);                    // FLG (no extras)
-    out.extend_from_slice(&[0; 4]); // MTIME (unknown)
-    out.push(0);                    // XFL
-    out.push(0xFF);                 // OS = unknown
+    out.extend_from_slice(&header(level));
 
     // Compressed data (raw DEFLATE stream)
     out.extend_from_slice(&compressed);
@@ -49,6 +45,23 @@ pub fn gzip_compress(data: &[u8]) -> Vec<u8> {
     out
 }
 
+/// The 10-byte header written in front of data compressed at `level`.
+pub fn header(level: u32) -> [u8; 10] {
+    [
+        GZIP_MAGIC[0],      // ID1
+        GZIP_MAGIC[1],      // ID2
+        METHOD_DEFLATE,     // CM
+        0,                  // FLG (no extras)
+        0, 0, 0, 0,         // MTIME (unknown)
+        match level {       // XFL
+            9.. => 2,       //   maximum compression
+            1 => 4,         //   fastest
+            _ => 0,
+        },
+        0xFF,               // OS = unknown
+    ]
+}
+
 // ── Decompress ──────────────────────────────────────────────────────────────
 
 /// Decompress gzip data (RFC 1952). Returns None on error.
@@ -57,44 +70,10 @@ pub fn gzip_decompress(data: &[u8]) -> Option<Vec<u8>> {
         return None; // minimum: 10 header + 0 data + 8 trailer
     }
 
-    // Validate magic and method
-    if data[0] != GZIP_MAGIC[0] || data[1] != GZIP_MAGIC[1] {
-        return None;
-    }
-    if data[2] != METHOD_DEFLATE {
-        return None;
-    }
-
-    let flags = data[3];
-    let mut pos = 10usize; // skip fixed header
-
-    // Skip optional FEXTRA field
-    if flags & FEXTRA != 0 {
-        if pos + 2 > data.len() { return None; }
-        let xlen = u16::from_le_bytes([data[pos], data[pos + 1]]) as usize;
-        pos += 2 + xlen;
-    }
-
-    // Skip optional FNAME (null-terminated string)
-    if flags & FNAME != 0 {
-        while pos < data.len() && data[pos] != 0 {
-            pos += 1;
-        }
-        pos += 1; // skip null terminator
-    }
-
-    // Skip optional FCOMMENT (null-terminated string)
-    if flags & FCOMMENT != 0 {
-        while pos < data.len() && data[pos] != 0 {
-            pos += 1;
-        }
-        pos += 1;
-    }
-
-    // Skip optional FHCRC (2-byte CRC16 of header)
-    if flags & FHCRC != 0 {
-        pos += 2;
-    }
+    let pos = match header_len(data) {
+        Header::Complete(len) => len,
+        _ => return None,
+    };
 
     if pos >= data.len() { return None; }
 
@@ -113,7 +92,7 @@ pub fn gzip_decompress(data: &[u8]) -> Option<Vec<u8>> {
 
     // Decompress the DEFLATE stream (between header and trailer)
     let compressed = &data[pos..trailer_start];
-    let decompressed = inflate::inflate(compressed)?;
+    let decompressed = libinflate::inflate_sized(compressed, expected_isize as usize)?;
 
     // Verify CRC-32
     let actual_crc = crc32::crc32(&decompressed);
@@ -130,6 +109,55 @@ pub fn gzip_decompress(data: &[u8]) -> Option<Vec<u8>> {
     Some(decompressed)
 }
 
+/// Result of [`header_len`].
+pub enum Header {
+    /// The header is this many bytes long.
+    Complete(usize),
+    /// `data` ends inside the header.
+    Partial,
+    /// Not a gzip header.
+    Invalid,
+}
+
+/// Parse the gzip header at the start of `data`, which may hold only part
+/// of the file.
+pub fn header_len(data: &[u8]) -> Header {
+    for (i, &b) in data.iter().take(3).enumerate() {
+        if b != [GZIP_MAGIC[0], GZIP_MAGIC[1], METHOD_DEFLATE][i] {
+            return Header::Invalid;
+        }
+    }
+    if data.len() < 10 {
+        return Header::Partial;
+    }
+    let flags = data[3];
+    let mut pos = 10usize; // fixed header
+
+    // Optional FEXTRA field
+    if flags & FEXTRA != 0 {
+        if pos + 2 > data.len() { return Header::Partial; }
+        let xlen = u16::from_le_bytes([data[pos], data[pos + 1]]) as usize;
+        pos += 2 + xlen;
+    }
+
+    // Optional FNAME and FCOMMENT (null-terminated strings)
+    for flag in [FNAME, FCOMMENT] {
+        if flags & flag != 0 {
+            match data.get(pos..).and_then(|rest| rest.iter().position(|&b| b == 0)) {
+                Some(len) => pos += len + 1,
+                None => return Header::Partial,
+            }
+        }
+    }
+
+    // Optional FHCRC (2-byte CRC16 of header)
+    if flags & FHCRC != 0 {
+        pos += 2;
+    }
+
+    if pos > data.len() { Header::Partial } else { Header::Complete(pos) }
+}
+
 /// Check if data starts with gzip magic bytes.
 pub fn is_gzip(data: &[u8]) -> bool {
     data.len() >= 2 && data[0] == GZIP_MAGIC[0] && data[1] == GZIP_MAGIC[1]
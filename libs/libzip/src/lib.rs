@@ -5,9 +5,13 @@
 //!
 //! # Architecture
 //! - Supports Stored (no compression) and DEFLATE methods
-//! - Full inflate (decompression) with fixed and dynamic Huffman
-//! - DEFLATE compression with LZ77 and fixed Huffman encoding
+//! - Full inflate (decompression) via the shared libinflate crate
+//! - DEFLATE compression levels 1-9 (lazy LZ77, dynamic Huffman blocks)
 //! - CRC-32 verification on extraction
+//! - Streaming gzip/DEFLATE handles with fixed memory, and independently
+//!   compressible DEFLATE segments for parallel compression
+//! - Streaming tar/tar.gz reading and writing; extracted files are written
+//!   by a background thread while the next data is decompressed
 //!
 //! # Export Convention
 //! All public functions are `extern "C"` with `#[no_mangle]` for use via `dl_sym()`.
@@ -19,15 +23,17 @@ extern crate alloc;
 
 pub mod syscall;
 pub mod crc32;
-pub mod inflate;
 pub mod deflate;
 pub mod zip;
 pub mod gzip;
 pub mod tar;
+pub mod stream;
+pub mod writer;
 
 use alloc::vec::Vec;
 use zip::{ZipReader, ZipWriter};
-use tar::{TarReader, TarWriter};
+use tar::{TarReader, TarStreamReader, TarStreamWriter, TarWriter};
+use stream::{Compressor, Decompressor, Format};
 
 // ── Allocator ───────────────────────────────────────────────────────────────
 
@@ -50,6 +56,10 @@ enum ZipHandle {
     Writer(ZipWriter),
     TarReader(TarReader),
     TarWriter(TarWriter),
+    TarStreamReader(TarStreamReader),
+    TarStreamWriter(TarStreamWriter),
+    Compressor(Compressor),
+    Decompressor(Decompressor),
 }
 
 static mut HANDLES: [Option<ZipHandle>; MAX_HANDLES] = [
@@ -112,6 +122,39 @@ fn get_tar_writer(handle: u32) -> Option<&'static mut TarWriter> {
     }
 }
 
+fn get_tar_stream_reader(handle: u32) -> Option<&'static mut TarStreamReader> {
+    let idx = handle as usize;
+    if idx == 0 || idx > MAX_HANDLES { return None; }
+    unsafe {
+        match &mut HANDLES[idx - 1] {
+            Some(ZipHandle::TarStreamReader(r)) => Some(r),
+            _ => None,
+        }
+    }
+}
+
+fn get_tar_stream_writer(handle: u32) -> Option<&'static mut TarStreamWriter> {
+    let idx = handle as usize;
+    if idx == 0 || idx > MAX_HANDLES { return None; }
+    unsafe {
+        match &mut HANDLES[idx - 1] {
+            Some(ZipHandle::TarStreamWriter(w)) => Some(w),
+            _ => None,
+        }
+    }
+}
+
+fn get_stream(handle: u32) -> Option<&'static mut ZipHandle> {
+    let idx = handle as usize;
+    if idx == 0 || idx > MAX_HANDLES { return None; }
+    unsafe {
+        match &mut HANDLES[idx - 1] {
+            Some(h @ (ZipHandle::Compressor(_) | ZipHandle::Decompressor(_))) => Some(h),
+            _ => None,
+        }
+    }
+}
+
 fn free_handle(handle: u32) {
     let idx = handle as usize;
     if idx > 0 && idx <= MAX_HANDLES {
@@ -313,6 +356,19 @@ pub extern "C" fn libzip_add_file(
     0
 }
 
+/// Set the DEFLATE level (1-9, default 6) for files added to a ZIP writer
+/// afterwards. Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_set_level(handle: u32, level: u32) -> u32 {
+    match get_writer(handle) {
+        Some(w) => {
+            w.set_level(level);
+            0
+        }
+        None => u32::MAX,
+    }
+}
+
 /// Add a directory entry to a ZIP writer.
 /// Returns 0 on success, u32::MAX on error.
 #[no_mangle]
@@ -410,6 +466,19 @@ fn write_vec_to_file(path: &str, data: &[u8]) -> bool {
 pub extern "C" fn libzip_gzip_compress_file(
     in_path_ptr: *const u8, in_path_len: u32,
     out_path_ptr: *const u8, out_path_len: u32,
+) -> u32 {
+    libzip_gzip_compress_file_level(
+        in_path_ptr, in_path_len, out_path_ptr, out_path_len, deflate::DEFAULT_LEVEL,
+    )
+}
+
+/// Compress a file with gzip at DEFLATE `level` (0=stored, 1=fastest,
+/// 9=smallest). Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_gzip_compress_file_level(
+    in_path_ptr: *const u8, in_path_len: u32,
+    out_path_ptr: *const u8, out_path_len: u32,
+    level: u32,
 ) -> u32 {
     let in_path = unsafe {
         core::str::from_utf8_unchecked(core::slice::from_raw_parts(in_path_ptr, in_path_len as usize))
@@ -423,7 +492,7 @@ pub extern "C" fn libzip_gzip_compress_file(
         None => return u32::MAX,
     };
 
-    let compressed = gzip::gzip_compress(&data);
+    let compressed = gzip::gzip_compress_level(&data, level);
     if write_vec_to_file(out_path, &compressed) { 0 } else { u32::MAX }
 }
 
@@ -640,3 +709,243 @@ pub extern "C" fn libzip_tar_write_to_file(
 
     if write_vec_to_file(path, &output) { 0 } else { u32::MAX }
 }
+
+// ── Tar Stream C ABI Exports ────────────────────────────────────────────────
+
+/// Open a tar (or tar.gz) archive for streaming reads.  Entries are visited
+/// in order with `libzip_tar_stream_next`; close with `libzip_tar_close`.
+/// Returns handle (>0) on success, 0 on error.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_open(path_ptr: *const u8, path_len: u32) -> u32 {
+    let path = unsafe {
+        core::str::from_utf8_unchecked(core::slice::from_raw_parts(path_ptr, path_len as usize))
+    };
+    match TarStreamReader::open(path) {
+        Some(r) => alloc_handle(ZipHandle::TarStreamReader(r)),
+        None => 0,
+    }
+}
+
+/// Advance to the next entry, skipping the rest of the current one.  Writes
+/// its name to `buf`, its size to `*size` and 1/0 to `*is_dir`.
+/// Returns the name length, 0 at the end of the archive, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_next(
+    handle: u32, buf: *mut u8, buf_len: u32, size: *mut u64, is_dir: *mut u32,
+) -> u32 {
+    let reader = match get_tar_stream_reader(handle) {
+        Some(r) => r,
+        None => return u32::MAX,
+    };
+    let (name, entry_size, dir) = match reader.next_entry() {
+        Ok(Some(e)) => e,
+        Ok(None) => return 0,
+        Err(()) => return u32::MAX,
+    };
+    let name = name.as_bytes();
+    let copy_len = name.len().min(buf_len as usize);
+    unsafe {
+        core::ptr::copy_nonoverlapping(name.as_ptr(), buf, copy_len);
+        *size = entry_size;
+        *is_dir = dir as u32;
+    }
+    // An empty name would read as the end of the archive
+    copy_len.max(1) as u32
+}
+
+/// Read data of the current entry. Returns bytes read (0 at its end), or
+/// u32::MAX if the archive is truncated or corrupt.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_read(handle: u32, buf: *mut u8, buf_len: u32) -> u32 {
+    let reader = match get_tar_stream_reader(handle) {
+        Some(r) => r,
+        None => return u32::MAX,
+    };
+    let out = unsafe { core::slice::from_raw_parts_mut(buf, buf_len as usize) };
+    match reader.read(out) {
+        Some(n) => n as u32,
+        None => u32::MAX,
+    }
+}
+
+/// Write the rest of the current entry to a file. Returns 0 on success,
+/// u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_extract(handle: u32, path_ptr: *const u8, path_len: u32) -> u32 {
+    let reader = match get_tar_stream_reader(handle) {
+        Some(r) => r,
+        None => return u32::MAX,
+    };
+    let path = unsafe {
+        core::str::from_utf8_unchecked(core::slice::from_raw_parts(path_ptr, path_len as usize))
+    };
+    if reader.extract_to_file(path) { 0 } else { u32::MAX }
+}
+
+/// Create a tar archive written as entries are added.  `level` 1-9
+/// gzips it (.tar.gz), 0 writes a plain tar.
+/// Returns handle (>0) on success, 0 on error.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_create(path_ptr: *const u8, path_len: u32, level: u32) -> u32 {
+    let path = unsafe {
+        core::str::from_utf8_unchecked(core::slice::from_raw_parts(path_ptr, path_len as usize))
+    };
+    match TarStreamWriter::create(path, level.min(9)) {
+        Some(w) => alloc_handle(ZipHandle::TarStreamWriter(w)),
+        None => 0,
+    }
+}
+
+/// Add the file at `path` under `name`, reading it in pieces.
+/// Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_add_file(
+    handle: u32,
+    name_ptr: *const u8, name_len: u32,
+    path_ptr: *const u8, path_len: u32,
+) -> u32 {
+    let writer = match get_tar_stream_writer(handle) {
+        Some(w) => w,
+        None => return u32::MAX,
+    };
+    let (name, path) = unsafe {
+        (
+            core::str::from_utf8_unchecked(core::slice::from_raw_parts(name_ptr, name_len as usize)),
+            core::str::from_utf8_unchecked(core::slice::from_raw_parts(path_ptr, path_len as usize)),
+        )
+    };
+    if writer.add_file(name, path) { 0 } else { u32::MAX }
+}
+
+/// Add a directory entry to a streaming tar writer.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_add_dir(handle: u32, name_ptr: *const u8, name_len: u32) -> u32 {
+    let writer = match get_tar_stream_writer(handle) {
+        Some(w) => w,
+        None => return u32::MAX,
+    };
+    let name = unsafe {
+        core::str::from_utf8_unchecked(core::slice::from_raw_parts(name_ptr, name_len as usize))
+    };
+    if writer.add_directory(name) { 0 } else { u32::MAX }
+}
+
+/// End the archive and close its file. Handle is consumed by this call.
+/// Returns 0 on success, u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_tar_stream_finish(handle: u32) -> u32 {
+    let idx = handle as usize;
+    if idx == 0 || idx > MAX_HANDLES { return u32::MAX; }
+
+    let writer = unsafe {
+        match HANDLES[idx - 1].take() {
+            Some(ZipHandle::TarStreamWriter(w)) => w,
+            other => {
+                HANDLES[idx - 1] = other;
+                return u32::MAX;
+            }
+        }
+    };
+    if writer.finish() { 0 } else { u32::MAX }
+}
+
+// ── Stream C ABI Exports ────────────────────────────────────────────────────
+
+/// Start streaming compression. `format`: 0 = raw DEFLATE, 1 = gzip.
+/// Returns handle (>0) on success, 0 on error.
+#[no_mangle]
+pub extern "C" fn libzip_stream_deflate(format: u32, level: u32) -> u32 {
+    match Format::from_u32(format) {
+        Some(f) => alloc_handle(ZipHandle::Compressor(Compressor::new(f, level))),
+        None => 0,
+    }
+}
+
+/// Start streaming decompression. `format`: 0 = raw DEFLATE, 1 = gzip.
+/// Returns handle (>0) on success, 0 on error.
+#[no_mangle]
+pub extern "C" fn libzip_stream_inflate(format: u32) -> u32 {
+    match Format::from_u32(format) {
+        Some(f) => alloc_handle(ZipHandle::Decompressor(Decompressor::new(f))),
+        None => 0,
+    }
+}
+
+/// Feed input to a stream and take output. `finish` = 1 marks the end of
+/// the input. Stores the bytes of input consumed in `*consumed`.
+/// Returns the bytes written to `out`, or u32::MAX on error.
+#[no_mangle]
+pub extern "C" fn libzip_stream_process(
+    handle: u32,
+    in_ptr: *const u8, in_len: u32,
+    out_ptr: *mut u8, out_len: u32,
+    finish: u32,
+    consumed: *mut u32,
+) -> u32 {
+    let input = if in_len == 0 { &[][..] } else {
+        unsafe { core::slice::from_raw_parts(in_ptr, in_len as usize) }
+    };
+    let out = if out_len == 0 { &mut [][..] } else {
+        unsafe { core::slice::from_raw_parts_mut(out_ptr, out_len as usize) }
+    };
+    let result = match get_stream(handle) {
+        Some(ZipHandle::Compressor(c)) => Some(c.process(input, finish != 0, out)),
+        Some(ZipHandle::Decompressor(d)) => d.process(input, finish != 0, out),
+        _ => None,
+    };
+    match result {
+        Some((c, p)) => {
+            if !consumed.is_null() {
+                unsafe { *consumed = c as u32; }
+            }
+            p as u32
+        }
+        None => u32::MAX,
+    }
+}
+
+/// Returns 1 once a stream has ended and all its output was taken.
+#[no_mangle]
+pub extern "C" fn libzip_stream_done(handle: u32) -> u32 {
+    match get_stream(handle) {
+        Some(ZipHandle::Compressor(c)) => c.is_done() as u32,
+        Some(ZipHandle::Decompressor(d)) => d.is_done() as u32,
+        _ => 0,
+    }
+}
+
+/// Close a stream handle.
+#[no_mangle]
+pub extern "C" fn libzip_stream_close(handle: u32) {
+    free_handle(handle);
+}
+
+/// Compress `buf[start..len]` as one segment of a DEFLATE stream, with
+/// `buf[..start]` as history (see `deflate::deflate_segment`). Safe to call
+/// from several threads at once. `out_len` must be at least
+/// `len - start + (len - start) / 2048 + 32`.
+/// Returns the compressed size, or u32::MAX if `out` is too small.
+#[no_mangle]
+pub extern "C" fn libzip_deflate_segment(
+    buf_ptr: *const u8, buf_len: u32, start: u32,
+    level: u32, last: u32,
+    out_ptr: *mut u8, out_len: u32,
+) -> u32 {
+    let buf = if buf_len == 0 { &[][..] } else {
+        unsafe { core::slice::from_raw_parts(buf_ptr, buf_len as usize) }
+    };
+    let seg = deflate::deflate_segment(buf, start as usize, level, last != 0);
+    if seg.len() > out_len as usize {
+        return u32::MAX;
+    }
+    unsafe { core::ptr::copy_nonoverlapping(seg.as_ptr(), out_ptr, seg.len()); }
+    seg.len() as u32
+}
+
+/// Continue a CRC-32 (start with 0) over `len` bytes.
+#[no_mangle]
+pub extern "C" fn libzip_crc32(crc: u32, data_ptr: *const u8, len: u32) -> u32 {
+    if len == 0 { return crc; }
+    let data = unsafe { core::slice::from_raw_parts(data_ptr, len as usize) };
+    crc32::crc32_update(crc, data)
+}
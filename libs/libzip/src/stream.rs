@@ -0,0 +1,233 @@
+//! Streaming compression and decompression with fixed memory.
+//!
+//! [`Compressor`] and [`Decompressor`] take input and hand out output in
+//! chunks of any size, so files of any length pass through a few hundred
+//! KiB of buffers.  The compressor cuts the input into 128 KiB segments and
+//! compresses each with the preceding 32 KiB as history — the same pieces
+//! [`deflate_segment`](crate::deflate::deflate_segment) produces when a
+//! caller compresses segments in parallel.
+
+use alloc::vec::Vec;
+use libinflate::InflateStream;
+use crate::{crc32, deflate, gzip};
+
+/// Input compressed per DEFLATE segment.
+pub const SEGMENT_SIZE: usize = 128 * 1024;
+/// History carried from one segment into the next.
+pub const DICT_SIZE: usize = 32 * 1024;
+
+/// Longest gzip header accepted (the name and comment are unbounded).
+const MAX_HEADER: usize = 64 * 1024;
+
+/// Container around the DEFLATE data.
+#[derive(Copy, Clone, PartialEq)]
+pub enum Format {
+    /// Bare DEFLATE stream (RFC 1951).
+    Raw,
+    /// Single-member gzip file (RFC 1952).
+    Gzip,
+}
+
+impl Format {
+    pub fn from_u32(v: u32) -> Option<Format> {
+        match v {
+            0 => Some(Format::Raw),
+            1 => Some(Format::Gzip),
+            _ => None,
+        }
+    }
+}
+
+// ── Compress ────────────────────────────────────────────────────────────────
+
+pub struct Compressor {
+    format: Format,
+    level: u32,
+    /// History (the first `dict` bytes) followed by uncompressed input.
+    buf: Vec<u8>,
+    dict: usize,
+    /// Output not handed out yet, from `out_pos` on.
+    out: Vec<u8>,
+    out_pos: usize,
+    crc: u32,
+    total: u32,
+    finished: bool,
+}
+
+impl Compressor {
+    pub fn new(format: Format, level: u32) -> Self {
+        let out = match format {
+            Format::Gzip => gzip::header(level).to_vec(),
+            Format::Raw => Vec::new(),
+        };
+        Compressor {
+            format,
+            level,
+            buf: Vec::with_capacity(DICT_SIZE + SEGMENT_SIZE),
+            dict: 0,
+            out,
+            out_pos: 0,
+            crc: 0,
+            total: 0,
+            finished: false,
+        }
+    }
+
+    /// Consume `input` and write compressed bytes to `out`.  With `finish`
+    /// set, the stream is ended once all of `input` is consumed.
+    ///
+    /// Returns `(consumed, produced)`.  Call again with the rest of the
+    /// input while any is left or `out` came back full, until
+    /// [`is_done`](Self::is_done).
+    pub fn process(&mut self, input: &[u8], finish: bool, out: &mut [u8]) -> (usize, usize) {
+        let mut consumed = 0;
+        let mut produced = 0;
+        loop {
+            let n = (self.out.len() - self.out_pos).min(out.len() - produced);
+            out[produced..produced + n].copy_from_slice(&self.out[self.out_pos..self.out_pos + n]);
+            self.out_pos += n;
+            produced += n;
+            if self.out_pos < self.out.len() || self.finished {
+                break;
+            }
+
+            let room = self.dict + SEGMENT_SIZE - self.buf.len();
+            let more = consumed < input.len();
+            if room == 0 && (more || !finish) {
+                self.compress(false);
+            } else if more && room > 0 {
+                let n = room.min(input.len() - consumed);
+                let chunk = &input[consumed..consumed + n];
+                self.crc = crc32::crc32_update(self.crc, chunk);
+                self.total = self.total.wrapping_add(n as u32);
+                self.buf.extend_from_slice(chunk);
+                consumed += n;
+            } else if finish {
+                self.compress(true);
+            } else {
+                break;
+            }
+        }
+        (consumed, produced)
+    }
+
+    /// True once the stream is ended and all output handed out.
+    pub fn is_done(&self) -> bool {
+        self.finished && self.out_pos == self.out.len()
+    }
+
+    fn compress(&mut self, last: bool) {
+        self.out = deflate::deflate_segment(&self.buf, self.dict, self.level, last);
+        self.out_pos = 0;
+        let keep = self.buf.len().min(DICT_SIZE);
+        self.buf.drain(..self.buf.len() - keep);
+        self.dict = keep;
+        if last {
+            if self.format == Format::Gzip {
+                self.out.extend_from_slice(&self.crc.to_le_bytes());
+                self.out.extend_from_slice(&self.total.to_le_bytes());
+            }
+            self.finished = true;
+        }
+    }
+}
+
+// ── Decompress ──────────────────────────────────────────────────────────────
+
+#[derive(Copy, Clone, PartialEq)]
+enum Phase {
+    Header,
+    Body,
+    Trailer,
+    Done,
+}
+
+pub struct Decompressor {
+    format: Format,
+    phase: Phase,
+    /// Gzip header or trailer bytes gathered so far.
+    pending: Vec<u8>,
+    inflate: InflateStream,
+    crc: u32,
+}
+
+impl Decompressor {
+    pub fn new(format: Format) -> Self {
+        Decompressor {
+            format,
+            phase: if format == Format::Gzip { Phase::Header } else { Phase::Body },
+            pending: Vec::new(),
+            inflate: InflateStream::new(),
+            crc: 0,
+        }
+    }
+
+    /// Consume `input` and write decompressed bytes to `out`; `finish`
+    /// marks the end of the input.
+    ///
+    /// Returns `(consumed, produced)`, or `None` if the data is corrupt,
+    /// fails its CRC or size check, or (with `finish`) is truncated.
+    pub fn process(&mut self, input: &[u8], finish: bool, out: &mut [u8]) -> Option<(usize, usize)> {
+        let mut consumed = 0;
+        let mut produced = 0;
+        loop {
+            match self.phase {
+                Phase::Header => {
+                    // Byte by byte: the header's length is only known at its end
+                    while consumed < input.len() && self.phase == Phase::Header {
+                        self.pending.push(input[consumed]);
+                        consumed += 1;
+                        match gzip::header_len(&self.pending) {
+                            gzip::Header::Complete(_) => {
+                                self.pending.clear();
+                                self.phase = Phase::Body;
+                            }
+                            gzip::Header::Partial if self.pending.len() < MAX_HEADER => {}
+                            _ => return None,
+                        }
+                    }
+                    if self.phase == Phase::Header {
+                        return if finish { None } else { Some((consumed, produced)) };
+                    }
+                }
+                Phase::Body => {
+                    let (c, p) = self.inflate.decompress(&input[consumed..], finish, &mut out[produced..])?;
+                    self.crc = crc32::crc32_update(self.crc, &out[produced..produced + p]);
+                    consumed += c;
+                    produced += p;
+                    if self.inflate.is_done() {
+                        if self.format == Format::Gzip {
+                            self.pending = self.inflate.trailing().to_vec();
+                            self.phase = Phase::Trailer;
+                        } else {
+                            self.phase = Phase::Done;
+                        }
+                    } else if produced == out.len() || (c == 0 && p == 0) {
+                        break;
+                    }
+                }
+                Phase::Trailer => {
+                    let n = 8usize.saturating_sub(self.pending.len()).min(input.len() - consumed);
+                    self.pending.extend_from_slice(&input[consumed..consumed + n]);
+                    consumed += n;
+                    if self.pending.len() < 8 {
+                        return if finish { None } else { Some((consumed, produced)) };
+                    }
+                    let crc = u32::from_le_bytes(self.pending[..4].try_into().unwrap());
+                    let isize = u32::from_le_bytes(self.pending[4..8].try_into().unwrap());
+                    if crc != self.crc || isize != self.inflate.total_out() as u32 {
+                        return None;
+                    }
+                    self.phase = Phase::Done;
+                }
+                Phase::Done => break,
+            }
+        }
+        Some((consumed, produced))
+    }
+
+    /// True once the whole stream (and its trailer) has been decoded.
+    pub fn is_done(&self) -> bool {
+        self.phase == Phase::Done
+    }
+}
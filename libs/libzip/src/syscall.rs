@@ -2,6 +2,7 @@
 
 pub use libsyscall::{
     sbrk, mmap, munmap, exit, close, lseek, file_size, mkdir, stat,
+    thread_create, futex_wait, futex_wake, cpu_count, FUTEX_FOREVER,
     O_WRITE, O_CREATE, O_TRUNC, SEEK_SET,
 };
 
@@ -2,10 +2,17 @@
 //!
 //! Supports reading and writing tar archives with ustar format headers.
 //! Transparently handles `.tar.gz` via the `gzip` module.
+//!
+//! [`TarReader`] and [`TarWriter`] hold the whole archive in memory;
+//! [`TarStreamReader`] and [`TarStreamWriter`] pass it through fixed-size
+//! buffers, so archives of any size fit in a small heap.
 
 use alloc::string::String;
 use alloc::vec;
 use alloc::vec::Vec;
+use crate::stream::{Compressor, Decompressor, Format};
+use crate::syscall;
+use crate::writer::{write_all, Writer};
 
 // ── Constants ───────────────────────────────────────────────────────────────
 
@@ -67,12 +74,7 @@ impl TarReader {
                 break;
             }
 
-            // Parse entry
-            let name = parse_name(header);
-            let size = parse_octal(&header[OFF_SIZE..OFF_SIZE + 12]);
-            let typeflag = header[OFF_TYPEFLAG];
-            let is_dir = typeflag == b'5' || name.ends_with('/');
-
+            let (name, size, is_dir) = parse_header(header);
             let data_offset = pos + BLOCK_SIZE;
 
             entries.push(TarEntry {
@@ -123,44 +125,14 @@ impl TarWriter {
 
     /// Add a file with data.
     pub fn add_file(&mut self, name: &str, data: &[u8]) {
-        let mut header = [0u8; BLOCK_SIZE];
-        write_name(&mut header, name);
-        write_octal(&mut header[OFF_MODE..OFF_MODE + 8], 0o644, 7);
-        write_octal(&mut header[OFF_SIZE..OFF_SIZE + 12], data.len() as u64, 11);
-        header[OFF_TYPEFLAG] = b'0'; // regular file
-        write_ustar_magic(&mut header);
-        write_checksum(&mut header);
-
-        self.output.extend_from_slice(&header);
+        self.output.extend_from_slice(&file_header(name, data.len() as u64));
         self.output.extend_from_slice(data);
-
-        // Pad to 512-byte boundary
-        let remainder = data.len() % BLOCK_SIZE;
-        if remainder != 0 {
-            let padding = BLOCK_SIZE - remainder;
-            self.output.extend(core::iter::repeat(0u8).take(padding));
-        }
+        self.output.resize(self.output.len() + padding(data.len() as u64), 0);
     }
 
     /// Add a directory entry.
     pub fn add_directory(&mut self, name: &str) {
-        let mut header = [0u8; BLOCK_SIZE];
-        // Ensure directory name ends with '/'
-        let dir_name = if name.ends_with('/') {
-            String::from(name)
-        } else {
-            let mut s = String::from(name);
-            s.push('/');
-            s
-        };
-        write_name(&mut header, &dir_name);
-        write_octal(&mut header[OFF_MODE..OFF_MODE + 8], 0o755, 7);
-        write_octal(&mut header[OFF_SIZE..OFF_SIZE + 12], 0, 11);
-        header[OFF_TYPEFLAG] = b'5'; // directory
-        write_ustar_magic(&mut header);
-        write_checksum(&mut header);
-
-        self.output.extend_from_slice(&header);
+        self.output.extend_from_slice(&dir_header(name));
     }
 
     /// Finalize the archive and return raw tar bytes.
@@ -172,8 +144,365 @@ impl TarWriter {
     }
 }
 
+// ── Streaming ───────────────────────────────────────────────────────────────
+
+/// Tar bytes buffered between the file and the parser, in either direction.
+const STREAM_BUF: usize = 64 * 1024;
+
+/// Reads a tar (or tar.gz) file front to back without holding it in
+/// memory: headers are parsed from a sliding 64 KiB window, which gzip
+/// input is decompressed into as the parser advances, and entry data is
+/// handed out as it arrives.
+pub struct TarStreamReader {
+    fd: u32,
+    inflate: Option<Decompressor>,
+    /// Compressed input (gzip only), unread from `in_pos` to `in_len`.
+    input: Vec<u8>,
+    in_pos: usize,
+    in_len: usize,
+    in_eof: bool,
+    /// Tar bytes, unread from `pos` to `len`.
+    buf: Vec<u8>,
+    pos: usize,
+    len: usize,
+    /// No tar bytes beyond `len`.
+    eof: bool,
+    /// Data bytes of the current entry not read yet.
+    remaining: u64,
+    /// Padding after the current entry's data.
+    pad: usize,
+    /// End-of-archive block seen.
+    done: bool,
+}
+
+impl TarStreamReader {
+    pub fn open(path: &str) -> Option<TarStreamReader> {
+        let fd = syscall::open(path, 0);
+        if fd == u32::MAX {
+            return None;
+        }
+        let mut r = TarStreamReader {
+            fd,
+            inflate: None,
+            input: Vec::new(),
+            in_pos: 0,
+            in_len: 0,
+            in_eof: false,
+            buf: vec![0u8; STREAM_BUF],
+            pos: 0,
+            len: 0,
+            eof: false,
+            remaining: 0,
+            pad: 0,
+            done: false,
+        };
+        // Sniff the first bytes; gzip input moves over to the input buffer
+        r.fill()?;
+        if crate::gzip::is_gzip(&r.buf[..r.len]) {
+            r.input = core::mem::replace(&mut r.buf, vec![0u8; STREAM_BUF]);
+            r.in_len = r.len;
+            r.in_eof = r.eof;
+            r.len = 0;
+            r.eof = false;
+            r.inflate = Some(Decompressor::new(Format::Gzip));
+        }
+        Some(r)
+    }
+
+    /// Advance to the next entry, skipping what is left of the current
+    /// one.  Returns `Ok(None)` at the end of the archive, `Err` if it is
+    /// corrupt or truncated.
+    pub fn next_entry(&mut self) -> Result<Option<(String, u64, bool)>, ()> {
+        let skip = self.remaining + self.pad as u64;
+        self.skip(skip).ok_or(())?;
+        self.remaining = 0;
+        self.pad = 0;
+        if self.done {
+            return Ok(None);
+        }
+        while self.len - self.pos < BLOCK_SIZE && !self.eof {
+            self.fill().ok_or(())?;
+        }
+        match self.len - self.pos {
+            // An archive may end without its zero blocks
+            0 => return Ok(None),
+            n if n < BLOCK_SIZE => return Err(()),
+            _ => {}
+        }
+        let header = &self.buf[self.pos..self.pos + BLOCK_SIZE];
+        if header.iter().all(|&b| b == 0) {
+            self.done = true;
+            return Ok(None);
+        }
+        if !verify_checksum(header) {
+            return Err(());
+        }
+        let (name, size, is_dir) = parse_header(header);
+        self.pos += BLOCK_SIZE;
+        self.remaining = size;
+        self.pad = padding(size);
+        Ok(Some((name, size, is_dir)))
+    }
+
+    /// Read data of the current entry into `out`, as much as fits.
+    /// Returns the bytes read (0 at its end), or `None` if the archive is
+    /// truncated or corrupt.
+    pub fn read(&mut self, out: &mut [u8]) -> Option<usize> {
+        let want = (out.len() as u64).min(self.remaining) as usize;
+        let mut n = 0;
+        while n < want {
+            if self.pos == self.len {
+                self.fill()?;
+                if self.pos == self.len {
+                    return None;
+                }
+            }
+            let k = (want - n).min(self.len - self.pos);
+            out[n..n + k].copy_from_slice(&self.buf[self.pos..self.pos + k]);
+            self.pos += k;
+            n += k;
+        }
+        self.remaining -= n as u64;
+        Some(n)
+    }
+
+    /// Write the rest of the current entry's data to a new file at `path`.
+    /// File writes run on the background writer while the next data is
+    /// decompressed.
+    pub fn extract_to_file(&mut self, path: &str) -> bool {
+        let mut writer = Writer::create(path);
+        let mut ok = true;
+        while self.remaining > 0 {
+            let buf = writer.buffer();
+            match self.read(buf) {
+                Some(n) => writer.submit(n),
+                None => {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        writer.finish() && ok
+    }
+
+    /// Discard `n` bytes of tar data.
+    fn skip(&mut self, mut n: u64) -> Option<()> {
+        while n > 0 {
+            if self.pos == self.len {
+                self.fill()?;
+                if self.pos == self.len {
+                    return None;
+                }
+            }
+            let k = ((self.len - self.pos) as u64).min(n);
+            self.pos += k as usize;
+            n -= k;
+        }
+        Some(())
+    }
+
+    /// Slide the unread bytes to the front of the window and add more.
+    /// Adds nothing once the tar data has ended; `None` on a read error or
+    /// corrupt gzip data.
+    fn fill(&mut self) -> Option<()> {
+        if self.pos > 0 {
+            self.buf.copy_within(self.pos..self.len, 0);
+            self.len -= self.pos;
+            self.pos = 0;
+        }
+        while !self.eof && self.len < self.buf.len() {
+            let inflate = match &mut self.inflate {
+                None => {
+                    let n = syscall::read(self.fd, &mut self.buf[self.len..]);
+                    if n == u32::MAX {
+                        return None;
+                    }
+                    self.len += n as usize;
+                    self.eof = n == 0;
+                    return Some(());
+                }
+                Some(d) => d,
+            };
+            if self.in_pos == self.in_len && !self.in_eof {
+                let n = syscall::read(self.fd, &mut self.input);
+                if n == u32::MAX {
+                    return None;
+                }
+                self.in_pos = 0;
+                self.in_len = n as usize;
+                self.in_eof = n == 0;
+            }
+            let (c, p) = inflate.process(&self.input[self.in_pos..self.in_len], self.in_eof, &mut self.buf[self.len..])?;
+            self.in_pos += c;
+            self.len += p;
+            self.eof = inflate.is_done();
+            if p > 0 {
+                break;
+            }
+            if c == 0 && self.in_eof && !self.eof {
+                return None;
+            }
+        }
+        Some(())
+    }
+}
+
+impl Drop for TarStreamReader {
+    fn drop(&mut self) {
+        syscall::close(self.fd);
+    }
+}
+
+/// Writes a tar (or tar.gz) file as entries are added, reading file data
+/// in 64 KiB pieces and compressing them on the way out.
+pub struct TarStreamWriter {
+    fd: u32,
+    deflate: Option<Compressor>,
+    /// Tar bytes not written (or compressed) yet.
+    buf: Vec<u8>,
+    /// Compressed output (gzip only).
+    out: Vec<u8>,
+}
+
+impl TarStreamWriter {
+    /// Create the archive at `path`; `level` 1-9 gzips it, 0 writes a
+    /// plain tar.
+    pub fn create(path: &str, level: u32) -> Option<TarStreamWriter> {
+        let fd = syscall::open(path, syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC);
+        if fd == u32::MAX {
+            return None;
+        }
+        let (deflate, out) = if level > 0 {
+            (Some(Compressor::new(Format::Gzip, level)), vec![0u8; STREAM_BUF])
+        } else {
+            (None, Vec::new())
+        };
+        Some(TarStreamWriter { fd, deflate, buf: Vec::with_capacity(STREAM_BUF), out })
+    }
+
+    /// Add the file at `path` as `name`.
+    pub fn add_file(&mut self, name: &str, path: &str) -> bool {
+        let src = syscall::open(path, 0);
+        if src == u32::MAX {
+            return false;
+        }
+        let size = syscall::file_size(src) as u64;
+        let ok = self.copy_file(src, name, size);
+        syscall::close(src);
+        ok
+    }
+
+    fn copy_file(&mut self, src: u32, name: &str, size: u64) -> bool {
+        if !self.emit(&file_header(name, size)) {
+            return false;
+        }
+        let mut left = size;
+        while left > 0 {
+            // Read straight into the spare room of the output buffer
+            let start = self.buf.len();
+            let want = ((STREAM_BUF - start) as u64).min(left) as usize;
+            self.buf.resize(start + want, 0);
+            let n = syscall::read(src, &mut self.buf[start..]);
+            if n == 0 || n == u32::MAX {
+                // The file shrank since its size was taken
+                return false;
+            }
+            self.buf.truncate(start + n as usize);
+            left -= n as u64;
+            if self.buf.len() >= STREAM_BUF && !self.flush(false) {
+                return false;
+            }
+        }
+        self.emit(&[0u8; BLOCK_SIZE][..padding(size)])
+    }
+
+    /// Add a directory entry.
+    pub fn add_directory(&mut self, name: &str) -> bool {
+        self.emit(&dir_header(name))
+    }
+
+    /// Write the end-of-archive blocks and everything still buffered.
+    pub fn finish(mut self) -> bool {
+        self.emit(&[0u8; BLOCK_SIZE * 2]) && self.flush(true)
+    }
+
+    fn emit(&mut self, data: &[u8]) -> bool {
+        self.buf.extend_from_slice(data);
+        self.buf.len() < STREAM_BUF || self.flush(false)
+    }
+
+    /// Write out the buffer; `finish` also ends the gzip stream.
+    fn flush(&mut self, finish: bool) -> bool {
+        let ok = match &mut self.deflate {
+            None => write_all(self.fd, &self.buf),
+            Some(c) => {
+                let mut consumed = 0;
+                loop {
+                    let (n, p) = c.process(&self.buf[consumed..], finish, &mut self.out);
+                    consumed += n;
+                    if !write_all(self.fd, &self.out[..p]) {
+                        break false;
+                    }
+                    if consumed == self.buf.len() && (!finish || c.is_done()) {
+                        break true;
+                    }
+                }
+            }
+        };
+        self.buf.clear();
+        ok
+    }
+}
+
+impl Drop for TarStreamWriter {
+    fn drop(&mut self) {
+        syscall::close(self.fd);
+    }
+}
+
 // ── Helper Functions ────────────────────────────────────────────────────────
 
+/// Parse a header block into `(name, size, is_dir)`.
+fn parse_header(header: &[u8]) -> (String, u64, bool) {
+    let name = parse_name(header);
+    let size = parse_octal(&header[OFF_SIZE..OFF_SIZE + 12]);
+    let is_dir = header[OFF_TYPEFLAG] == b'5' || name.ends_with('/');
+    (name, size, is_dir)
+}
+
+/// Zero bytes that pad `size` bytes of data to a block boundary.
+fn padding(size: u64) -> usize {
+    (BLOCK_SIZE - (size % BLOCK_SIZE as u64) as usize) % BLOCK_SIZE
+}
+
+/// Header block of a regular file.
+fn file_header(name: &str, size: u64) -> [u8; BLOCK_SIZE] {
+    let mut header = [0u8; BLOCK_SIZE];
+    write_name(&mut header, name);
+    write_octal(&mut header[OFF_MODE..OFF_MODE + 8], 0o644, 7);
+    write_octal(&mut header[OFF_SIZE..OFF_SIZE + 12], size, 11);
+    header[OFF_TYPEFLAG] = b'0'; // regular file
+    write_ustar_magic(&mut header);
+    write_checksum(&mut header);
+    header
+}
+
+/// Header block of a directory; the name gets a trailing '/'.
+fn dir_header(name: &str) -> [u8; BLOCK_SIZE] {
+    let mut header = [0u8; BLOCK_SIZE];
+    let mut dir_name = String::from(name);
+    if !dir_name.ends_with('/') {
+        dir_name.push('/');
+    }
+    write_name(&mut header, &dir_name);
+    write_octal(&mut header[OFF_MODE..OFF_MODE + 8], 0o755, 7);
+    write_octal(&mut header[OFF_SIZE..OFF_SIZE + 12], 0, 11);
+    header[OFF_TYPEFLAG] = b'5'; // directory
+    write_ustar_magic(&mut header);
+    write_checksum(&mut header);
+    header
+}
+
 /// Parse a null-terminated string from a fixed-size field.
 fn parse_str(field: &[u8]) -> &str {
     let end = field.iter().position(|&b| b == 0).unwrap_or(field.len());
@@ -222,10 +551,13 @@ fn write_name(header: &mut [u8; BLOCK_SIZE], name: &str) {
     if bytes.len() <= 100 {
         header[OFF_NAME..OFF_NAME + bytes.len()].copy_from_slice(bytes);
     } else {
-        // Split at last '/' before position 100
-        let split = bytes[..100].iter().rposition(|&b| b == b'/').unwrap_or(100);
+        // Split at the first '/' that leaves at most 100 bytes of name and
+        // 155 of prefix; names with no such '/' are truncated
+        let split = (1..bytes.len().min(156))
+            .find(|&i| bytes[i] == b'/' && bytes.len() - i - 1 <= 100)
+            .unwrap_or(100);
         let prefix_bytes = &bytes[..split];
-        let name_bytes = &bytes[split + 1..]; // skip the '/'
+        let name_bytes = &bytes[(split + 1).min(bytes.len())..]; // skip the '/'
         let plen = prefix_bytes.len().min(155);
         let nlen = name_bytes.len().min(100);
         header[OFF_PREFIX..OFF_PREFIX + plen].copy_from_slice(&prefix_bytes[..plen]);
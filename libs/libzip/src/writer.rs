@@ -0,0 +1,238 @@
+//! Background file writer for streaming extraction.
+//!
+//! One thread, started on the first extraction, writes filled buffers to
+//! their files while the caller decompresses the next ones.  The buffers
+//! form a ring of [`SLOTS`] × [`SLOT_SIZE`] bytes: the caller fills slots
+//! at the head and sleeps when all are in flight, the writer drains them
+//! at the tail and sleeps when none are.  Data in flight never exceeds the
+//! ring, whatever the size of the archive.
+//!
+//! Threads do not share file descriptors, so the writer opens and closes
+//! the files itself: a file is an open slot (holding its path), data slots
+//! and a close slot.
+//!
+//! Only one extraction uses the thread at a time; another one meanwhile
+//! (or a single-CPU system, or no thread could be started) writes inline.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicPtr, AtomicU32, Ordering};
+use crate::syscall::{self, cpu_count, futex_wait, futex_wake, mmap, thread_create, FUTEX_FOREVER};
+
+/// Buffers in the ring.
+const SLOTS: u32 = 4;
+/// Bytes per buffer.
+pub const SLOT_SIZE: usize = 64 * 1024;
+/// Stack size of the writer thread.
+const WRITER_STACK_SIZE: usize = 16 * 1024;
+/// Polls of the head before the writer sleeps.
+const IDLE_SPINS: u32 = 256;
+
+const WRITER_UNINIT: u32 = 0;
+const WRITER_STARTING: u32 = 1;
+const WRITER_READY: u32 = 2;
+const WRITER_NONE: u32 = 3;
+
+static STATE: AtomicU32 = AtomicU32::new(WRITER_UNINIT);
+/// Set while an extraction owns the ring.
+static BUSY: AtomicBool = AtomicBool::new(false);
+/// Slots filled / slots written, counting up and wrapping.
+static HEAD: AtomicU32 = AtomicU32::new(0);
+static TAIL: AtomicU32 = AtomicU32::new(0);
+/// A write failed since the owner started.
+static FAILED: AtomicBool = AtomicBool::new(false);
+/// `SLOTS * SLOT_SIZE` bytes, allocated with the thread.
+static RING: AtomicPtr<u8> = AtomicPtr::new(core::ptr::null_mut());
+/// Operation and length of each slot; published by the release of `HEAD`.
+static mut META: [(Op, u32); SLOTS as usize] = [(Op::Close, 0); SLOTS as usize];
+
+#[derive(Copy, Clone, PartialEq)]
+enum Op {
+    /// Create the file whose path is in the slot.
+    Open,
+    /// Append the slot's bytes to the file.
+    Data,
+    /// Close the file.
+    Close,
+}
+
+#[cold]
+fn start() -> bool {
+    if STATE
+        .compare_exchange(WRITER_UNINIT, WRITER_STARTING, Ordering::Acquire, Ordering::Relaxed)
+        .is_err()
+    {
+        return STATE.load(Ordering::Acquire) == WRITER_READY;
+    }
+    let mut state = WRITER_NONE;
+    if cpu_count() > 1 {
+        let stack = mmap(WRITER_STACK_SIZE as u32);
+        if stack != u64::MAX {
+            let ring = vec![0u8; SLOTS as usize * SLOT_SIZE].leak();
+            RING.store(ring.as_mut_ptr(), Ordering::Relaxed);
+            // x86_64 ABI: RSP must be STACK_TOP - 8 at function entry
+            let top = stack as usize + WRITER_STACK_SIZE - 8;
+            if thread_create(writer_main, top, "zip-writer") != 0 {
+                state = WRITER_READY;
+            }
+        }
+    }
+    STATE.store(state, Ordering::Release);
+    state == WRITER_READY
+}
+
+/// Writes one file, through the ring when the writer thread is free.
+pub struct Writer {
+    /// File written inline, or `u32::MAX`.
+    fd: u32,
+    threaded: bool,
+    /// Buffer used when writing inline.
+    local: Vec<u8>,
+    ok: bool,
+}
+
+impl Writer {
+    /// Start writing a new file at `path`.
+    pub fn create(path: &str) -> Writer {
+        let ready = STATE.load(Ordering::Acquire) == WRITER_READY || start();
+        if ready && !BUSY.swap(true, Ordering::Acquire) {
+            let mut w = Writer { fd: u32::MAX, threaded: true, local: Vec::new(), ok: true };
+            let len = path.len().min(SLOT_SIZE);
+            w.buffer()[..len].copy_from_slice(&path.as_bytes()[..len]);
+            w.push(Op::Open, len);
+            return w;
+        }
+        let fd = syscall::open(path, syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC);
+        Writer { fd, threaded: false, local: vec![0u8; SLOT_SIZE], ok: fd != u32::MAX }
+    }
+
+    /// An empty buffer to fill; waits while every slot is in flight.
+    pub fn buffer(&mut self) -> &mut [u8] {
+        if !self.threaded {
+            return &mut self.local;
+        }
+        let head = HEAD.load(Ordering::Relaxed);
+        loop {
+            let tail = TAIL.load(Ordering::Acquire);
+            if head.wrapping_sub(tail) < SLOTS {
+                break;
+            }
+            futex_wait(&TAIL, tail, FUTEX_FOREVER);
+        }
+        let slot = (head % SLOTS) as usize;
+        unsafe {
+            core::slice::from_raw_parts_mut(RING.load(Ordering::Relaxed).add(slot * SLOT_SIZE), SLOT_SIZE)
+        }
+    }
+
+    /// Hand the first `len` bytes of the last [`buffer`](Self::buffer) over
+    /// for writing.
+    pub fn submit(&mut self, len: usize) {
+        if self.threaded {
+            self.push(Op::Data, len);
+        } else if self.ok {
+            self.ok = write_all(self.fd, &self.local[..len]);
+        }
+    }
+
+    fn push(&mut self, op: Op, len: usize) {
+        let head = HEAD.load(Ordering::Relaxed);
+        unsafe { META[(head % SLOTS) as usize] = (op, len as u32) };
+        HEAD.store(head.wrapping_add(1), Ordering::Release);
+        futex_wake(&HEAD, 1);
+    }
+
+    /// Close the file once everything submitted is written; false if it
+    /// could not be created or any write failed.
+    pub fn finish(mut self) -> bool {
+        self.close();
+        self.ok
+    }
+
+    fn close(&mut self) {
+        if !self.threaded {
+            if self.fd != u32::MAX {
+                syscall::close(self.fd);
+                self.fd = u32::MAX;
+            }
+            return;
+        }
+        self.buffer();
+        self.push(Op::Close, 0);
+        let head = HEAD.load(Ordering::Relaxed);
+        loop {
+            let tail = TAIL.load(Ordering::Acquire);
+            if tail == head {
+                break;
+            }
+            futex_wait(&TAIL, tail, FUTEX_FOREVER);
+        }
+        self.ok &= !FAILED.swap(false, Ordering::Relaxed);
+        self.threaded = false;
+        BUSY.store(false, Ordering::Release);
+    }
+}
+
+impl Drop for Writer {
+    fn drop(&mut self) {
+        self.close();
+    }
+}
+
+/// Write all of `data` to `fd`.
+pub fn write_all(fd: u32, mut data: &[u8]) -> bool {
+    while !data.is_empty() {
+        let n = syscall::write(fd, data);
+        if n == 0 || n == u32::MAX {
+            return false;
+        }
+        data = &data[n as usize..];
+    }
+    true
+}
+
+fn writer_main() {
+    let ring = RING.load(Ordering::Relaxed);
+    let mut fd = u32::MAX;
+    let mut tail = 0u32;
+    let mut spins = 0u32;
+    loop {
+        let head = HEAD.load(Ordering::Acquire);
+        if head == tail {
+            if spins < IDLE_SPINS {
+                spins += 1;
+                core::hint::spin_loop();
+            } else {
+                futex_wait(&HEAD, head, FUTEX_FOREVER);
+            }
+            continue;
+        }
+        spins = 0;
+        let slot = (tail % SLOTS) as usize;
+        let (op, len) = unsafe { META[slot] };
+        let data = unsafe { core::slice::from_raw_parts(ring.add(slot * SLOT_SIZE), len as usize) };
+        match op {
+            Op::Open => {
+                let path = unsafe { core::str::from_utf8_unchecked(data) };
+                fd = syscall::open(path, syscall::O_WRITE | syscall::O_CREATE | syscall::O_TRUNC);
+                if fd == u32::MAX {
+                    FAILED.store(true, Ordering::Relaxed);
+                }
+            }
+            Op::Data => {
+                if fd != u32::MAX && !write_all(fd, data) {
+                    FAILED.store(true, Ordering::Relaxed);
+                }
+            }
+            Op::Close => {
+                if fd != u32::MAX {
+                    syscall::close(fd);
+                    fd = u32::MAX;
+                }
+            }
+        }
+        tail = tail.wrapping_add(1);
+        TAIL.store(tail, Ordering::Release);
+        futex_wake(&TAIL, 1);
+    }
+}
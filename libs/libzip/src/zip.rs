@@ -5,7 +5,6 @@
 use alloc::string::String;
 use alloc::vec::Vec;
 use crate::crc32;
-use crate::inflate;
 use crate::deflate;
 
 // ─── Constants ──────────────────────────────────────────────────────────────
@@ -150,7 +149,7 @@ impl ZipReader {
 
         let decompressed = match entry.method {
             METHOD_STORED => compressed.to_vec(),
-            METHOD_DEFLATE => inflate::inflate(compressed)?,
+            METHOD_DEFLATE => libinflate::inflate_sized(compressed, entry.uncompressed_size as usize)?,
             _ => return None, // Unsupported method
         };
 
@@ -186,11 +185,17 @@ struct WriterEntry {
 /// Builds a new ZIP archive in memory.
 pub struct ZipWriter {
     entries: Vec<WriterEntry>,
+    level: u32,
 }
 
 impl ZipWriter {
     pub fn new() -> Self {
-        ZipWriter { entries: Vec::new() }
+        ZipWriter { entries: Vec::new(), level: deflate::DEFAULT_LEVEL }
+    }
+
+    /// Set the DEFLATE level (1-9) used by later [`add`](Self::add) calls.
+    pub fn set_level(&mut self, level: u32) {
+        self.level = level.clamp(1, deflate::MAX_LEVEL);
     }
 
     /// Add a file entry with optional DEFLATE compression.
@@ -200,7 +205,7 @@ impl ZipWriter {
         let uncompressed_size = data.len() as u32;
 
         let (method, compressed_data) = if compress && !data.is_empty() {
-            let compressed = deflate::deflate(data);
+            let compressed = deflate::deflate_level(data, self.level);
             // Only use compressed if it's actually smaller
             if compressed.len() < data.len() {
                 (METHOD_DEFLATE, compressed)
@@ -1,7 +1,8 @@
 //! libzip_client — Safe Rust wrapper for the libzip shared library.
 //!
 //! Loads `libzip.so` via `dl_open`/`dl_sym` and provides ergonomic Rust types
-//! (`ZipReader`, `ZipWriter`) for archive operations.
+//! (`ZipReader`, `ZipWriter`, `TarStream`, `Stream`, ...) for archive
+//! operations.
 //!
 //! # Usage
 //! ```rust
@@ -39,10 +40,12 @@ struct LibZip {
     extract_to_file: extern "C" fn(u32, u32, *const u8, u32) -> u32,
     add_file: extern "C" fn(u32, *const u8, u32, *const u8, u32, u32) -> u32,
     add_dir: extern "C" fn(u32, *const u8, u32) -> u32,
+    set_level: extern "C" fn(u32, u32) -> u32,
     write_to_file: extern "C" fn(u32, *const u8, u32) -> u32,
     // Gzip functions
     gzip_compress_file: extern "C" fn(*const u8, u32, *const u8, u32) -> u32,
     gzip_decompress_file: extern "C" fn(*const u8, u32, *const u8, u32) -> u32,
+    gzip_compress_file_level: extern "C" fn(*const u8, u32, *const u8, u32, u32) -> u32,
     // Tar functions
     tar_open: extern "C" fn(*const u8, u32) -> u32,
     tar_create: extern "C" fn() -> u32,
@@ -56,6 +59,22 @@ struct LibZip {
     tar_add_file: extern "C" fn(u32, *const u8, u32, *const u8, u32) -> u32,
     tar_add_dir: extern "C" fn(u32, *const u8, u32) -> u32,
     tar_write_to_file: extern "C" fn(u32, *const u8, u32, u32) -> u32,
+    tar_stream_open: extern "C" fn(*const u8, u32) -> u32,
+    tar_stream_next: extern "C" fn(u32, *mut u8, u32, *mut u64, *mut u32) -> u32,
+    tar_stream_read: extern "C" fn(u32, *mut u8, u32) -> u32,
+    tar_stream_extract: extern "C" fn(u32, *const u8, u32) -> u32,
+    tar_stream_create: extern "C" fn(*const u8, u32, u32) -> u32,
+    tar_stream_add_file: extern "C" fn(u32, *const u8, u32, *const u8, u32) -> u32,
+    tar_stream_add_dir: extern "C" fn(u32, *const u8, u32) -> u32,
+    tar_stream_finish: extern "C" fn(u32) -> u32,
+    // Streams
+    stream_deflate: extern "C" fn(u32, u32) -> u32,
+    stream_inflate: extern "C" fn(u32) -> u32,
+    stream_process: extern "C" fn(u32, *const u8, u32, *mut u8, u32, u32, *mut u32) -> u32,
+    stream_done: extern "C" fn(u32) -> u32,
+    stream_close: extern "C" fn(u32),
+    deflate_segment: extern "C" fn(*const u8, u32, u32, u32, u32, *mut u8, u32) -> u32,
+    crc32: extern "C" fn(u32, *const u8, u32) -> u32,
 }
 
 static mut LIB: Option<LibZip> = None;
@@ -94,10 +113,12 @@ pub fn init() -> bool {
             extract_to_file: resolve(&handle, "libzip_extract_to_file"),
             add_file: resolve(&handle, "libzip_add_file"),
             add_dir: resolve(&handle, "libzip_add_dir"),
+            set_level: resolve(&handle, "libzip_set_level"),
             write_to_file: resolve(&handle, "libzip_write_to_file"),
             // Gzip
             gzip_compress_file: resolve(&handle, "libzip_gzip_compress_file"),
             gzip_decompress_file: resolve(&handle, "libzip_gzip_decompress_file"),
+            gzip_compress_file_level: resolve(&handle, "libzip_gzip_compress_file_level"),
             // Tar
             tar_open: resolve(&handle, "libzip_tar_open"),
             tar_create: resolve(&handle, "libzip_tar_create"),
@@ -111,6 +132,22 @@ pub fn init() -> bool {
             tar_add_file: resolve(&handle, "libzip_tar_add_file"),
             tar_add_dir: resolve(&handle, "libzip_tar_add_dir"),
             tar_write_to_file: resolve(&handle, "libzip_tar_write_to_file"),
+            tar_stream_open: resolve(&handle, "libzip_tar_stream_open"),
+            tar_stream_next: resolve(&handle, "libzip_tar_stream_next"),
+            tar_stream_read: resolve(&handle, "libzip_tar_stream_read"),
+            tar_stream_extract: resolve(&handle, "libzip_tar_stream_extract"),
+            tar_stream_create: resolve(&handle, "libzip_tar_stream_create"),
+            tar_stream_add_file: resolve(&handle, "libzip_tar_stream_add_file"),
+            tar_stream_add_dir: resolve(&handle, "libzip_tar_stream_add_dir"),
+            tar_stream_finish: resolve(&handle, "libzip_tar_stream_finish"),
+            // Streams
+            stream_deflate: resolve(&handle, "libzip_stream_deflate"),
+            stream_inflate: resolve(&handle, "libzip_stream_inflate"),
+            stream_process: resolve(&handle, "libzip_stream_process"),
+            stream_done: resolve(&handle, "libzip_stream_done"),
+            stream_close: resolve(&handle, "libzip_stream_close"),
+            deflate_segment: resolve(&handle, "libzip_deflate_segment"),
+            crc32: resolve(&handle, "libzip_crc32"),
             _handle: handle,
         };
         LIB = Some(lib);
@@ -214,6 +251,12 @@ impl ZipWriter {
         ) == 0
     }
 
+    /// Set the DEFLATE level (1 = fastest, 9 = smallest, default 6) for
+    /// files added afterwards.
+    pub fn set_level(&self, level: u32) -> bool {
+        (lib().set_level)(self.handle, level) == 0
+    }
+
     /// Add a directory entry (name should end with '/').
     pub fn add_dir(&self, name: &str) -> bool {
         (lib().add_dir)(self.handle, name.as_ptr(), name.len() as u32) == 0
@@ -246,6 +289,16 @@ pub fn gzip_compress_file(in_path: &str, out_path: &str) -> bool {
     ) == 0
 }
 
+/// Compress a file with gzip at DEFLATE `level` (0 = stored, 1 = fastest,
+/// 9 = smallest). Returns true on success.
+pub fn gzip_compress_file_level(in_path: &str, out_path: &str, level: u32) -> bool {
+    (lib().gzip_compress_file_level)(
+        in_path.as_ptr(), in_path.len() as u32,
+        out_path.as_ptr(), out_path.len() as u32,
+        level,
+    ) == 0
+}
+
 /// Decompress a gzip file. Returns true on success.
 pub fn gzip_decompress_file(in_path: &str, out_path: &str) -> bool {
     (lib().gzip_decompress_file)(
@@ -254,6 +307,93 @@ pub fn gzip_decompress_file(in_path: &str, out_path: &str) -> bool {
     ) == 0
 }
 
+// ── Streams ─────────────────────────────────────────────────────────────────
+
+/// Container of a [`Stream`].
+#[derive(Copy, Clone, PartialEq)]
+pub enum Format {
+    /// Bare DEFLATE stream.
+    Raw = 0,
+    /// Gzip file (header, DEFLATE data, CRC-32 and size trailer).
+    Gzip = 1,
+}
+
+/// A streaming compressor or decompressor with fixed memory.
+pub struct Stream {
+    handle: u32,
+}
+
+impl Stream {
+    /// Start compressing at DEFLATE `level` (0 = stored, 1 = fastest,
+    /// 9 = smallest).
+    pub fn deflate(format: Format, level: u32) -> Option<Stream> {
+        let h = (lib().stream_deflate)(format as u32, level);
+        if h == 0 { None } else { Some(Stream { handle: h }) }
+    }
+
+    /// Start decompressing.
+    pub fn inflate(format: Format) -> Option<Stream> {
+        let h = (lib().stream_inflate)(format as u32);
+        if h == 0 { None } else { Some(Stream { handle: h }) }
+    }
+
+    /// Feed `input` and write output to `out`; `finish` marks the end of
+    /// the input.  Returns `(consumed, produced)`, or `None` on corrupt
+    /// (or, when finishing, truncated) data.  Call again with the rest of
+    /// the input while any is left or `out` came back full, until
+    /// [`is_done`](Self::is_done).
+    pub fn process(&mut self, input: &[u8], finish: bool, out: &mut [u8]) -> Option<(usize, usize)> {
+        let mut consumed = 0u32;
+        let n = (lib().stream_process)(
+            self.handle,
+            input.as_ptr(), input.len() as u32,
+            out.as_mut_ptr(), out.len() as u32,
+            finish as u32,
+            &mut consumed,
+        );
+        if n == u32::MAX { None } else { Some((consumed as usize, n as usize)) }
+    }
+
+    /// True once the stream has ended and all output was taken.
+    pub fn is_done(&self) -> bool {
+        (lib().stream_done)(self.handle) != 0
+    }
+}
+
+impl Drop for Stream {
+    fn drop(&mut self) {
+        (lib().stream_close)(self.handle);
+    }
+}
+
+/// Input per segment of [`Stream`] compression; parallel compressors cut
+/// their input the same way.
+pub const SEGMENT_SIZE: usize = 128 * 1024;
+/// History each segment may refer back into.
+pub const DICT_SIZE: usize = 32 * 1024;
+
+/// Compress `buf[start..]` as one segment of a DEFLATE stream, with
+/// `buf[..start]` as history.  Segments compressed this way — on any
+/// thread — concatenate into one valid stream; only the one with `last`
+/// set ends it.
+pub fn deflate_segment(buf: &[u8], start: usize, level: u32, last: bool) -> Option<alloc::vec::Vec<u8>> {
+    let n = buf.len().saturating_sub(start);
+    let mut out = vec![0u8; n + n / 2048 + 32];
+    let len = (lib().deflate_segment)(
+        buf.as_ptr(), buf.len() as u32, start as u32,
+        level, last as u32,
+        out.as_mut_ptr(), out.len() as u32,
+    );
+    if len == u32::MAX { return None; }
+    out.truncate(len as usize);
+    Some(out)
+}
+
+/// Continue a CRC-32 (start with 0) over `data`.
+pub fn crc32_update(crc: u32, data: &[u8]) -> u32 {
+    (lib().crc32)(crc, data.as_ptr(), data.len() as u32)
+}
+
 // ── TarReader ───────────────────────────────────────────────────────────────
 
 /// An open tar archive for reading.
@@ -364,3 +504,119 @@ impl Drop for TarWriter {
         }
     }
 }
+
+// ── TarStream ───────────────────────────────────────────────────────────────
+
+/// Header of the entry a [`TarStream`] is positioned on.
+pub struct TarStreamEntry {
+    pub name: String,
+    pub size: u64,
+    pub is_dir: bool,
+}
+
+/// A tar (or .tar.gz) archive read front to back in fixed memory.
+pub struct TarStream {
+    handle: u32,
+}
+
+impl TarStream {
+    /// Open a tar (or .tar.gz) archive for streaming reads.
+    pub fn open(path: &str) -> Option<TarStream> {
+        let h = (lib().tar_stream_open)(path.as_ptr(), path.len() as u32);
+        if h == 0 { None } else { Some(TarStream { handle: h }) }
+    }
+
+    /// Advance to the next entry, skipping the rest of the current one.
+    /// `Ok(None)` at the end of the archive, `Err` if it is corrupt or
+    /// truncated.
+    pub fn next_entry(&mut self) -> Result<Option<TarStreamEntry>, ()> {
+        let mut buf = [0u8; 512];
+        let mut size = 0u64;
+        let mut is_dir = 0u32;
+        let n = (lib().tar_stream_next)(self.handle, buf.as_mut_ptr(), 512, &mut size, &mut is_dir);
+        match n {
+            0 => Ok(None),
+            u32::MAX => Err(()),
+            n => Ok(Some(TarStreamEntry {
+                name: String::from(core::str::from_utf8(&buf[..n as usize]).unwrap_or("")),
+                size,
+                is_dir: is_dir != 0,
+            })),
+        }
+    }
+
+    /// Read data of the current entry; `Some(0)` at its end.
+    pub fn read(&mut self, buf: &mut [u8]) -> Option<usize> {
+        let n = (lib().tar_stream_read)(self.handle, buf.as_mut_ptr(), buf.len() as u32);
+        if n == u32::MAX { None } else { Some(n as usize) }
+    }
+
+    /// Read the rest of the current entry into a byte vector.
+    pub fn read_to_vec(&mut self, size: u64) -> Option<alloc::vec::Vec<u8>> {
+        let mut buf = vec![0u8; size as usize];
+        let mut len = 0;
+        while len < buf.len() {
+            match self.read(&mut buf[len..])? {
+                0 => break,
+                n => len += n,
+            }
+        }
+        buf.truncate(len);
+        Some(buf)
+    }
+
+    /// Write the rest of the current entry to a file; the writes overlap
+    /// with decompressing the data that follows.
+    pub fn extract_to_file(&mut self, path: &str) -> bool {
+        (lib().tar_stream_extract)(self.handle, path.as_ptr(), path.len() as u32) == 0
+    }
+}
+
+impl Drop for TarStream {
+    fn drop(&mut self) {
+        (lib().tar_close)(self.handle);
+    }
+}
+
+// ── TarStreamWriter ─────────────────────────────────────────────────────────
+
+/// A tar archive written to its file as entries are added.
+pub struct TarStreamWriter {
+    handle: u32,
+}
+
+impl TarStreamWriter {
+    /// Create the archive at `path`.  `level` 1-9 gzips it (.tar.gz),
+    /// 0 writes a plain tar.
+    pub fn create(path: &str, level: u32) -> Option<TarStreamWriter> {
+        let h = (lib().tar_stream_create)(path.as_ptr(), path.len() as u32, level);
+        if h == 0 { None } else { Some(TarStreamWriter { handle: h }) }
+    }
+
+    /// Add the file at `path` as `name`; its data is read in pieces.
+    pub fn add_file(&self, name: &str, path: &str) -> bool {
+        (lib().tar_stream_add_file)(
+            self.handle,
+            name.as_ptr(), name.len() as u32,
+            path.as_ptr(), path.len() as u32,
+        ) == 0
+    }
+
+    /// Add a directory entry.
+    pub fn add_dir(&self, name: &str) -> bool {
+        (lib().tar_stream_add_dir)(self.handle, name.as_ptr(), name.len() as u32) == 0
+    }
+
+    /// End the archive and close its file.
+    pub fn finish(self) -> bool {
+        let result = (lib().tar_stream_finish)(self.handle) == 0;
+        core::mem::forget(self);
+        result
+    }
+}
+
+impl Drop for TarStreamWriter {
+    fn drop(&mut self) {
+        (lib().tar_close)(self.handle);
+    }
+}
@@ -4,19 +4,24 @@
 //! Audio playback API.
 //!
 //! Provides functions to write PCM audio data, control volume, and play WAV files.
-//! Audio output is 48 kHz, 16-bit signed stereo (native AC'97 format).
+//! Audio is 16-bit signed stereo. Each thread writes to its own stream in
+//! the kernel mixer, at 48 kHz unless set otherwise with [`audio_set_rate`];
+//! several programs can play at once.
 
 use crate::raw::*;
 
-/// Write raw PCM data to the audio output.
+/// Write raw PCM data to the calling thread's stream.
 ///
-/// `data` must contain 16-bit signed little-endian stereo samples at 48 kHz
-/// (4 bytes per sample frame). Returns number of bytes accepted.
+/// `data` must contain 16-bit signed little-endian stereo samples at the
+/// stream's rate (4 bytes per sample frame). Returns number of bytes
+/// accepted, which is less than `pcm_data.len()` once the stream's queue is
+/// full (about 340 ms of audio); offer the rest again after some of it has
+/// played.
 pub fn audio_write(pcm_data: &[u8]) -> u32 {
     syscall2(SYS_AUDIO_WRITE, pcm_data.as_ptr() as u64, pcm_data.len() as u64)
 }
 
-/// Stop audio playback.
+/// Drop what this thread has queued and not played yet.
 pub fn audio_stop() {
     syscall2(SYS_AUDIO_CTL, 0, 0);
 }
@@ -31,7 +36,8 @@ pub fn audio_get_volume() -> u8 {
     syscall2(SYS_AUDIO_CTL, 2, 0) as u8
 }
 
-/// Check if audio playback is active.
+/// Check if the audio output is running (any program is playing).
+/// Wait for this thread's own sound with [`audio_buffered`].
 pub fn audio_is_playing() -> bool {
     syscall2(SYS_AUDIO_CTL, 3, 0) != 0
 }
@@ -41,17 +47,78 @@ pub fn audio_is_available() -> bool {
     syscall2(SYS_AUDIO_CTL, 4, 0) != 0
 }
 
+/// Sample frames of this thread's stream played so far (wraps at 2^32).
+///
+/// Derived from the DMA position, so it advances at exactly 48 kHz while
+/// the stream plays and stands still otherwise: a clock to time video or
+/// other output against.  Compare two readings with `wrapping_sub`.
+pub fn audio_position() -> u32 {
+    syscall2(SYS_AUDIO_CTL, 5, 0)
+}
+
+/// Sample frames written with [`audio_write`] but not played yet.
+pub fn audio_buffered() -> u32 {
+    syscall2(SYS_AUDIO_CTL, 6, 0)
+}
+
+/// Set the sample rate of this thread's stream (8000-192000 Hz); the
+/// mixer resamples it to 48 kHz. Returns false if out of range or there
+/// is no audio hardware.
+pub fn audio_set_rate(hz: u32) -> bool {
+    syscall2(SYS_AUDIO_CTL, 7, hz as u64) == 0
+}
+
+/// Output latency in 48 kHz frames: how long a frame takes from the mixer
+/// to the speaker. Add it to [`audio_buffered`] for the delay of a frame
+/// written now.
+pub fn audio_latency() -> u32 {
+    syscall2(SYS_AUDIO_CTL, 8, 0)
+}
+
+/// Set the mixer period (64-1024 frames, rounded to a multiple of 32).
+/// Shorter periods lower the latency at the cost of more interrupts.
+/// Returns the period applied.
+pub fn audio_set_period(frames: u32) -> u32 {
+    syscall2(SYS_AUDIO_CTL, 9, frames as u64)
+}
+
+/// Current mixer period in frames.
+pub fn audio_period() -> u32 {
+    syscall2(SYS_AUDIO_CTL, 10, 0)
+}
+
+/// Write all of `pcm_data`, waiting for room in the driver's queue.
+/// Returns once the last byte is queued, not when it has played.
+pub fn audio_write_all(mut pcm_data: &[u8]) {
+    while pcm_data.len() >= 4 {
+        let n = audio_write(pcm_data) as usize;
+        if n == 0 || n > pcm_data.len() {
+            if !audio_is_available() {
+                return;
+            }
+            crate::process::sleep(10);
+            continue;
+        }
+        pcm_data = &pcm_data[n..];
+    }
+}
+
 /// Parse and play a WAV file from raw bytes.
 ///
-/// Supports: PCM format, 8/16-bit, mono/stereo.
-/// Resamples to 48 kHz if needed (nearest-neighbor).
+/// Supports: PCM format, 8/16-bit, mono/stereo, 8-192 kHz (the mixer
+/// resamples to 48 kHz).  Blocks until the whole file is queued; the tail
+/// is still playing when this returns.  Leaves the stream at the file's
+/// sample rate.
 pub fn play_wav(data: &[u8]) -> Result<(), &'static str> {
     let wav = parse_wav(data)?;
 
-    // Convert to 48 kHz 16-bit stereo
+    // Convert to 16-bit stereo at the file's rate
     let pcm = convert_wav(&wav)?;
+    if !audio_set_rate(wav.sample_rate) {
+        return Err("Unsupported sample rate");
+    }
 
-    audio_write(&pcm);
+    audio_write_all(&pcm);
     Ok(())
 }
 
@@ -151,15 +218,11 @@ fn convert_wav(wav: &WavInfo) -> Result<alloc::vec::Vec<u8>, &'static str> {
         return Err("No audio data");
     }
 
-    // Output: 48000 Hz, 16-bit stereo = 4 bytes per frame
-    let out_frames = ((num_frames as u64 * 48000) / wav.sample_rate as u64) as usize;
-    let mut out = alloc::vec![0u8; out_frames * 4];
+    // Output: 16-bit stereo = 4 bytes per frame
+    let mut out = alloc::vec![0u8; num_frames * 4];
 
-    for i in 0..out_frames {
-        // Nearest-neighbor resample
-        let src_frame = ((i as u64 * wav.sample_rate as u64) / 48000) as usize;
-        let src_frame = src_frame.min(num_frames - 1);
-        let src_off = src_frame * frame_size;
+    for i in 0..num_frames {
+        let src_off = i * frame_size;
 
         let (left, right) = if wav.bits_per_sample == 16 {
             let l = i16::from_le_bytes([wav.pcm_data[src_off], wav.pcm_data[src_off + 1]]);
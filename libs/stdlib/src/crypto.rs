@@ -1,72 +1,108 @@
 //! Cryptographic utilities for user-space programs.
 
-/// Compute MD5 hex digest of input bytes.
-/// Returns a 32-byte array containing the hex characters.
-pub fn md5_hex(input: &[u8]) -> [u8; 32] {
-    let digest = md5(input);
-    let mut hex = [0u8; 32];
-    let hex_chars = b"0123456789abcdef";
-    for (i, &byte) in digest.iter().enumerate() {
-        hex[i * 2] = hex_chars[(byte >> 4) as usize];
-        hex[i * 2 + 1] = hex_chars[(byte & 0xF) as usize];
-    }
-    hex
+const HEX_CHARS: &[u8; 16] = b"0123456789abcdef";
+
+const MD5_S: [u32; 64] = [
+    7,12,17,22, 7,12,17,22, 7,12,17,22, 7,12,17,22,
+    5, 9,14,20, 5, 9,14,20, 5, 9,14,20, 5, 9,14,20,
+    4,11,16,23, 4,11,16,23, 4,11,16,23, 4,11,16,23,
+    6,10,15,21, 6,10,15,21, 6,10,15,21, 6,10,15,21,
+];
+
+const MD5_K: [u32; 64] = [
+    0xd76aa478,0xe8c7b756,0x242070db,0xc1bdceee,
+    0xf57c0faf,0x4787c62a,0xa8304613,0xfd469501,
+    0x698098d8,0x8b44f7af,0xffff5bb1,0x895cd7be,
+    0x6b901122,0xfd987193,0xa679438e,0x49b40821,
+    0xf61e2562,0xc040b340,0x265e5a51,0xe9b6c7aa,
+    0xd62f105d,0x02441453,0xd8a1e681,0xe7d3fbc8,
+    0x21e1cde6,0xc33707d6,0xf4d50d87,0x455a14ed,
+    0xa9e3e905,0xfcefa3f8,0x676f02d9,0x8d2a4c8a,
+    0xfffa3942,0x8771f681,0x6d9d6122,0xfde5380c,
+    0xa4beea44,0x4bdecfa9,0xf6bb4b60,0xbebfbc70,
+    0x289b7ec6,0xeaa127fa,0xd4ef3085,0x04881d05,
+    0xd9d4d039,0xe6db99e5,0x1fa27cf8,0xc4ac5665,
+    0xf4292244,0x432aff97,0xab9423a7,0xfc93a039,
+    0x655b59c3,0x8f0ccc92,0xffeff47d,0x85845dd1,
+    0x6fa87e4f,0xfe2ce6e0,0xa3014314,0x4e0811a1,
+    0xf7537e82,0xbd3af235,0x2ad7d2bb,0xeb86d391,
+];
+
+/// Incremental MD5, for hashing data as it streams in (e.g. a download)
+/// instead of reading it back afterwards.
+#[derive(Clone)]
+pub struct Md5 {
+    state: [u32; 4],
+    block: [u8; 64],
+    block_len: usize,
+    total: u64,
 }
 
-/// Compute raw MD5 digest (16 bytes).
-pub fn md5(input: &[u8]) -> [u8; 16] {
-    let s: [u32; 64] = [
-        7,12,17,22, 7,12,17,22, 7,12,17,22, 7,12,17,22,
-        5, 9,14,20, 5, 9,14,20, 5, 9,14,20, 5, 9,14,20,
-        4,11,16,23, 4,11,16,23, 4,11,16,23, 4,11,16,23,
-        6,10,15,21, 6,10,15,21, 6,10,15,21, 6,10,15,21,
-    ];
-    let k: [u32; 64] = [
-        0xd76aa478,0xe8c7b756,0x242070db,0xc1bdceee,
-        0xf57c0faf,0x4787c62a,0xa8304613,0xfd469501,
-        0x698098d8,0x8b44f7af,0xffff5bb1,0x895cd7be,
-        0x6b901122,0xfd987193,0xa679438e,0x49b40821,
-        0xf61e2562,0xc040b340,0x265e5a51,0xe9b6c7aa,
-        0xd62f105d,0x02441453,0xd8a1e681,0xe7d3fbc8,
-        0x21e1cde6,0xc33707d6,0xf4d50d87,0x455a14ed,
-        0xa9e3e905,0xfcefa3f8,0x676f02d9,0x8d2a4c8a,
-        0xfffa3942,0x8771f681,0x6d9d6122,0xfde5380c,
-        0xa4beea44,0x4bdecfa9,0xf6bb4b60,0xbebfbc70,
-        0x289b7ec6,0xeaa127fa,0xd4ef3085,0x04881d05,
-        0xd9d4d039,0xe6db99e5,0x1fa27cf8,0xc4ac5665,
-        0xf4292244,0x432aff97,0xab9423a7,0xfc93a039,
-        0x655b59c3,0x8f0ccc92,0xffeff47d,0x85845dd1,
-        0x6fa87e4f,0xfe2ce6e0,0xa3014314,0x4e0811a1,
-        0xf7537e82,0xbd3af235,0x2ad7d2bb,0xeb86d391,
-    ];
-
-    let orig_len_bits = (input.len() as u64) * 8;
-
-    // Build padded message
-    let pad_len = {
-        let rem = input.len() % 64;
-        if rem < 56 { 56 - rem } else { 120 - rem }
-    };
-    let total = input.len() + pad_len + 8;
-    let mut msg = alloc::vec![0u8; total];
-    msg[..input.len()].copy_from_slice(input);
-    msg[input.len()] = 0x80;
-    let len_bytes = orig_len_bits.to_le_bytes();
-    msg[total - 8..total].copy_from_slice(&len_bytes);
-
-    let mut a0: u32 = 0x67452301;
-    let mut b0: u32 = 0xefcdab89;
-    let mut c0: u32 = 0x98badcfe;
-    let mut d0: u32 = 0x10325476;
-
-    for chunk in msg.chunks_exact(64) {
+impl Md5 {
+    pub fn new() -> Md5 {
+        Md5 {
+            state: [0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476],
+            block: [0; 64],
+            block_len: 0,
+            total: 0,
+        }
+    }
+
+    /// Feed more input.
+    pub fn update(&mut self, mut input: &[u8]) {
+        self.total += input.len() as u64;
+        if self.block_len > 0 {
+            let n = (64 - self.block_len).min(input.len());
+            self.block[self.block_len..self.block_len + n].copy_from_slice(&input[..n]);
+            self.block_len += n;
+            input = &input[n..];
+            if self.block_len < 64 {
+                return;
+            }
+            let block = self.block;
+            self.compress(&block);
+            self.block_len = 0;
+        }
+        let mut chunks = input.chunks_exact(64);
+        for chunk in &mut chunks {
+            self.compress(chunk);
+        }
+        let rest = chunks.remainder();
+        self.block[..rest.len()].copy_from_slice(rest);
+        self.block_len = rest.len();
+    }
+
+    /// Finish and return the raw digest (16 bytes).
+    pub fn finish(mut self) -> [u8; 16] {
+        let len_bits = self.total.wrapping_mul(8);
+        let pad_len = if self.block_len < 56 { 56 - self.block_len } else { 120 - self.block_len };
+        let mut pad = [0u8; 72];
+        pad[0] = 0x80;
+        pad[pad_len..pad_len + 8].copy_from_slice(&len_bits.to_le_bytes());
+        let total = self.total;
+        self.update(&pad[..pad_len + 8]);
+        self.total = total;
+
+        let mut result = [0u8; 16];
+        for (i, word) in self.state.iter().enumerate() {
+            result[i * 4..i * 4 + 4].copy_from_slice(&word.to_le_bytes());
+        }
+        result
+    }
+
+    /// Finish and return the hex digest (32 lowercase hex characters).
+    pub fn finish_hex(self) -> [u8; 32] {
+        to_hex(&self.finish())
+    }
+
+    fn compress(&mut self, chunk: &[u8]) {
         let mut m = [0u32; 16];
         for (i, word) in m.iter_mut().enumerate() {
             let base = i * 4;
             *word = u32::from_le_bytes([chunk[base], chunk[base+1], chunk[base+2], chunk[base+3]]);
         }
 
-        let (mut a, mut b, mut c, mut d) = (a0, b0, c0, d0);
+        let [mut a, mut b, mut c, mut d] = self.state;
 
         for i in 0..64 {
             let (f, g) = match i {
@@ -79,21 +115,36 @@ pub fn md5(input: &[u8]) -> [u8; 16] {
             let temp = d;
             d = c;
             c = b;
-            let sum = a.wrapping_add(f).wrapping_add(k[i]).wrapping_add(m[g]);
-            b = b.wrapping_add(sum.rotate_left(s[i]));
+            let sum = a.wrapping_add(f).wrapping_add(MD5_K[i]).wrapping_add(m[g]);
+            b = b.wrapping_add(sum.rotate_left(MD5_S[i]));
             a = temp;
         }
 
-        a0 = a0.wrapping_add(a);
-        b0 = b0.wrapping_add(b);
-        c0 = c0.wrapping_add(c);
-        d0 = d0.wrapping_add(d);
+        self.state[0] = self.state[0].wrapping_add(a);
+        self.state[1] = self.state[1].wrapping_add(b);
+        self.state[2] = self.state[2].wrapping_add(c);
+        self.state[3] = self.state[3].wrapping_add(d);
     }
+}
 
-    let mut result = [0u8; 16];
-    result[0..4].copy_from_slice(&a0.to_le_bytes());
-    result[4..8].copy_from_slice(&b0.to_le_bytes());
-    result[8..12].copy_from_slice(&c0.to_le_bytes());
-    result[12..16].copy_from_slice(&d0.to_le_bytes());
-    result
+fn to_hex(digest: &[u8; 16]) -> [u8; 32] {
+    let mut hex = [0u8; 32];
+    for (i, &byte) in digest.iter().enumerate() {
+        hex[i * 2] = HEX_CHARS[(byte >> 4) as usize];
+        hex[i * 2 + 1] = HEX_CHARS[(byte & 0xF) as usize];
+    }
+    hex
+}
+
+/// Compute MD5 hex digest of input bytes.
+/// Returns a 32-byte array containing the hex characters.
+pub fn md5_hex(input: &[u8]) -> [u8; 32] {
+    to_hex(&md5(input))
+}
+
+/// Compute raw MD5 digest (16 bytes).
+pub fn md5(input: &[u8]) -> [u8; 16] {
+    let mut ctx = Md5::new();
+    ctx.update(input);
+    ctx.finish()
 }
@@ -1,9 +1,11 @@
 //! Debug / trace API for anyTrace.
 //!
-//! Provides userspace wrappers for the debug syscalls (300-313).
+//! Provides userspace wrappers for the debug syscalls (300-317) and the
+//! kernel tracepoints (326-327).
 //! All functions require `CAP_DEBUG`.
 
 use crate::raw::*;
+use alloc::vec::Vec;
 
 // ---- Debug event types ----
 
@@ -113,6 +115,205 @@ impl Default for ThreadInfoEx {
     }
 }
 
+/// Lock flavour of a [`LockStat`] site.
+pub const LOCK_KIND_SPIN: u32 = 0;
+pub const LOCK_KIND_TICKET: u32 = 1;
+pub const LOCK_KIND_MUTEX: u32 = 2;
+
+/// Contention counters for one kernel lock call site (96 bytes).
+///
+/// Layout matches `LockStatRecord` in the kernel's `sync::lock_profile`.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct LockStat {
+    /// Tail of the source path, NUL-padded.
+    pub file: [u8; 40],
+    pub line: u32,
+    /// `LOCK_KIND_SPIN`, `LOCK_KIND_TICKET` or `LOCK_KIND_MUTEX`.
+    pub kind: u32,
+    /// Kernel address of the last lock taken at this site.
+    pub lock_addr: u64,
+    pub acquires: u64,
+    /// Acquisitions that had to wait.
+    pub contended: u64,
+    pub spin_cycles: u64,
+    pub hold_cycles: u64,
+    pub max_hold_cycles: u64,
+}
+
+impl LockStat {
+    /// The source file as a string (without padding).
+    pub fn file_str(&self) -> &str {
+        let len = self.file.iter().position(|&b| b == 0).unwrap_or(self.file.len());
+        core::str::from_utf8(&self.file[..len]).unwrap_or("?")
+    }
+}
+
+/// Result of [`lock_stats`].
+pub struct LockStats {
+    /// The kernel was built with the lock profiler.
+    pub enabled: bool,
+    /// Frequency of the cycle counts, in Hz (0 = unknown).
+    pub cycle_hz: u64,
+    pub sites: Vec<LockStat>,
+}
+
+/// Flags for [`syscall_stats`].
+pub const SYSCALL_STATS_RESET: u32 = 1;
+pub const SYSCALL_STATS_ENABLE: u32 = 2;
+pub const SYSCALL_STATS_DISABLE: u32 = 4;
+/// Record only the thread passed as `tid` (0 = all threads).
+pub const SYSCALL_STATS_FILTER: u32 = 8;
+
+/// Latency histogram buckets of a [`SyscallStat`].
+pub const SYSCALL_BUCKETS: usize = 32;
+
+/// Call count and latency of one syscall number (176 bytes).
+///
+/// Layout matches `SyscallStatRecord` in the kernel's `syscall::stats`.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct SyscallStat {
+    /// Syscall name, NUL-padded.
+    pub name: [u8; 24],
+    pub num: u32,
+    pub _pad: u32,
+    pub calls: u64,
+    /// Total cycles spent in the syscall (including time blocked).
+    pub cycles: u64,
+    /// `hist[i]` counts calls that took `[2^i, 2^(i+1))` cycles.
+    pub hist: [u32; SYSCALL_BUCKETS],
+}
+
+impl SyscallStat {
+    /// The syscall name as a string (without padding).
+    pub fn name_str(&self) -> &str {
+        let len = self.name.iter().position(|&b| b == 0).unwrap_or(self.name.len());
+        core::str::from_utf8(&self.name[..len]).unwrap_or("?")
+    }
+}
+
+/// Syscall totals of one thread (24 bytes).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct SyscallThreadStat {
+    pub tid: u32,
+    pub _pad: u32,
+    pub calls: u64,
+    pub cycles: u64,
+}
+
+/// Result of [`syscall_stats`].
+pub struct SyscallStats {
+    /// The kernel is currently recording.
+    pub enabled: bool,
+    /// Thread the recording is restricted to (0 = all).
+    pub filter_tid: u32,
+    /// Frequency of the cycle counts, in Hz (0 = unknown).
+    pub cycle_hz: u64,
+    pub syscalls: Vec<SyscallStat>,
+    pub threads: Vec<SyscallThreadStat>,
+}
+
+/// Sample source of a profiling session.
+pub const PROF_SOURCE_STOPPED: u32 = 0;
+/// Performance-counter overflow NMI (requested rate, sees kernel code).
+pub const PROF_SOURCE_PMU: u32 = 1;
+/// LAPIC timer interrupt (tick rate, busy CPUs only) — no usable PMU.
+pub const PROF_SOURCE_TIMER: u32 = 2;
+
+/// Sample flag: the CPU was in kernel mode.
+pub const PROF_FLAG_KERNEL: u16 = 1;
+/// Sample flag: 32-bit process (call chain holds 32-bit addresses).
+pub const PROF_FLAG_COMPAT: u16 = 2;
+
+/// Return addresses per sample.
+pub const PROF_CHAIN_DEPTH: usize = 13;
+
+/// One profiler sample (128 bytes, matches `SampleRecord` in the kernel).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct ProfSample {
+    /// Cycle counter at the sample (see [`Profiler::cycle_hz`]).
+    pub tsc: u64,
+    pub rip: u64,
+    pub tid: u32,
+    /// `PROF_FLAG_*`.
+    pub flags: u16,
+    /// Valid entries in `chain`.
+    pub depth: u16,
+    /// Return addresses, innermost first.
+    pub chain: [u64; PROF_CHAIN_DEPTH],
+}
+
+impl ProfSample {
+    pub fn is_kernel(&self) -> bool {
+        self.flags & PROF_FLAG_KERNEL != 0
+    }
+
+    pub fn call_chain(&self) -> &[u64] {
+        &self.chain[..(self.depth as usize).min(PROF_CHAIN_DEPTH)]
+    }
+}
+
+/// A running system-wide sampling session and its mapped per-CPU rings
+/// (see [`Profiler::start`]).
+pub struct Profiler {
+    base: *mut u8,
+}
+
+// ---- Kernel tracepoints ----
+
+/// Tracepoint event numbers ([`TraceEvent::event`]; bit `1 << n` in a mask).
+pub const TRACE_SCHED_SWITCH: u16 = 0;
+pub const TRACE_SCHED_WAKEUP: u16 = 1;
+pub const TRACE_IRQ_ENTRY: u16 = 2;
+pub const TRACE_IRQ_EXIT: u16 = 3;
+pub const TRACE_SYSCALL_ENTRY: u16 = 4;
+pub const TRACE_SYSCALL_EXIT: u16 = 5;
+pub const TRACE_PAGE_FAULT: u16 = 6;
+pub const TRACE_BLOCK_SUBMIT: u16 = 7;
+pub const TRACE_BLOCK_COMPLETE: u16 = 8;
+pub const TRACE_TCP_SEND: u16 = 9;
+pub const TRACE_TCP_RECV: u16 = 10;
+/// Mask with every event enabled.
+pub const TRACE_ALL: u32 = (1 << 11) - 1;
+
+/// Flag for [`trace_ctl`]: enable exactly the events in `mask`.
+pub const TRACE_CTL_SET: u32 = 1;
+/// Flag for [`trace_ctl`]: discard pending records.
+pub const TRACE_CTL_RESET: u32 = 2;
+
+/// One tracepoint record (32 bytes, matches `TraceRecord` in the kernel's
+/// `task::tracepoints`, which also documents `arg0` / `arg1` per event).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct TraceEvent {
+    /// Cycle counter when the event fired (see [`TraceBatch::cycle_hz`]).
+    pub tsc: u64,
+    /// Thread current on the CPU.
+    pub tid: u32,
+    pub cpu: u16,
+    /// `TRACE_*` event number.
+    pub event: u16,
+    pub arg0: u64,
+    pub arg1: u64,
+}
+
+/// Result of [`trace_read`].
+pub struct TraceBatch {
+    /// Events enabled in the kernel.
+    pub mask: u32,
+    /// CPUs with a trace ring.
+    pub ncpus: u32,
+    /// Records dropped since the previous read because a ring was full.
+    pub lost: u32,
+    /// Frequency of [`TraceEvent::tsc`], in Hz (0 = unknown).
+    pub cycle_hz: u64,
+    /// Records grouped by CPU, in order within each CPU.
+    pub events: Vec<TraceEvent>,
+}
+
 // ---- API ----
 
 /// Attach to a running thread as debugger.
@@ -236,3 +437,162 @@ pub fn thread_info_ex(tid: u32, info: &mut ThreadInfoEx) -> bool {
     let ret = syscall3(SYS_THREAD_INFO_EX, tid as u64, buf, size as u64);
     ret != u32::MAX
 }
+
+/// Read the kernel lock contention profile (up to `max_sites` sites).
+///
+/// With `reset`, the kernel zeroes its counters after the read, so the
+/// next call reports only what happened in between.
+pub fn lock_stats(max_sites: usize, reset: bool) -> LockStats {
+    const HEADER: usize = 16;
+    let rec = core::mem::size_of::<LockStat>();
+    // u64 backing keeps the records 8-byte aligned.
+    let mut buf: Vec<u64> = alloc::vec![0; (HEADER + max_sites * rec + 7) / 8];
+    let size = (buf.len() * 8) as u64;
+    let ret = syscall3(SYS_LOCK_STATS, buf.as_mut_ptr() as u64, size, reset as u64);
+    if ret == u32::MAX {
+        return LockStats { enabled: false, cycle_hz: 0, sites: Vec::new() };
+    }
+    let enabled = buf[0] as u32 != 0;
+    let count = ((ret as usize).min(max_sites)).min((buf.len() * 8 - HEADER) / rec);
+    let cycle_hz = buf[1];
+    let base = unsafe { (buf.as_ptr() as *const u8).add(HEADER) as *const LockStat };
+    let sites = (0..count).map(|i| unsafe { *base.add(i) }).collect();
+    LockStats { enabled, cycle_hz, sites }
+}
+
+/// Read the per-syscall statistics, then apply `flags`
+/// (`SYSCALL_STATS_*`; `tid` is used with `SYSCALL_STATS_FILTER`).
+///
+/// Recording is off until a call passes `SYSCALL_STATS_ENABLE`.
+pub fn syscall_stats(flags: u32, tid: u32) -> SyscallStats {
+    const HEADER: usize = 32;
+    let empty = SyscallStats {
+        enabled: false, filter_tid: 0, cycle_hz: 0, syscalls: Vec::new(), threads: Vec::new(),
+    };
+    // Size the buffer from the kernel's answer, with slack for threads that
+    // show up in between (records that do not fit are left out).
+    let size = syscall4(SYS_SYSCALL_STATS, 0, 0, 0, 0);
+    if size == u32::MAX {
+        return empty;
+    }
+    // u64 backing keeps the records 8-byte aligned.
+    let mut buf: Vec<u64> = alloc::vec![0; (size as usize + 1024 + 7) / 8];
+    let ret = syscall4(SYS_SYSCALL_STATS, buf.as_mut_ptr() as u64, (buf.len() * 8) as u64,
+                       flags as u64, tid as u64);
+    if ret == u32::MAX {
+        return empty;
+    }
+    let words = buf.as_ptr() as *const u32;
+    let (n_sys, n_thr, filter_tid) = unsafe {
+        (*words.add(1) as usize, *words.add(2) as usize, *words.add(3))
+    };
+    let base = unsafe { (buf.as_ptr() as *const u8).add(HEADER) };
+    let sys = base as *const SyscallStat;
+    let syscalls = (0..n_sys).map(|i| unsafe { *sys.add(i) }).collect();
+    let thr = unsafe { base.add(n_sys * core::mem::size_of::<SyscallStat>()) } as *const SyscallThreadStat;
+    let threads = (0..n_thr).map(|i| unsafe { *thr.add(i) }).collect();
+    SyscallStats { enabled: unsafe { *words } != 0, filter_tid, cycle_hz: buf[2], syscalls, threads }
+}
+
+/// Apply `flags` (`TRACE_CTL_*`) to the kernel tracepoints; `mask` is used
+/// with `TRACE_CTL_SET`.  Returns the event mask enabled before the call.
+pub fn trace_ctl(mask: u32, flags: u32) -> u32 {
+    syscall2(SYS_TRACE_CTL, mask as u64, flags as u64)
+}
+
+/// Drain up to `max` pending tracepoint records.
+pub fn trace_read(max: usize) -> TraceBatch {
+    const HEADER: usize = 32;
+    let rec = core::mem::size_of::<TraceEvent>();
+    // u64 backing keeps the records 8-byte aligned.
+    let mut buf: Vec<u64> = alloc::vec![0; (HEADER + max * rec) / 8];
+    let ret = syscall2(SYS_TRACE_READ, buf.as_mut_ptr() as u64, (buf.len() * 8) as u64);
+    if ret == u32::MAX {
+        return TraceBatch { mask: 0, ncpus: 0, lost: 0, cycle_hz: 0, events: Vec::new() };
+    }
+    let words = buf.as_ptr() as *const u32;
+    let (mask, ncpus, lost) = unsafe { (*words, *words.add(1), *words.add(3)) };
+    let base = unsafe { (buf.as_ptr() as *const u8).add(HEADER) as *const TraceEvent };
+    let events = (0..(ret as usize).min(max)).map(|i| unsafe { *base.add(i) }).collect();
+    TraceBatch { mask, ncpus, lost, cycle_hz: buf[2], events }
+}
+
+impl Profiler {
+    const HEADER_CPU: usize = 64;
+
+    /// Start sampling every CPU at `hz` samples per second (0 = 1000, at
+    /// most 10000) and map the sample rings.  Restarting clears them.
+    pub fn start(hz: u32) -> Option<Profiler> {
+        let addr = syscall1(SYS_PROF_START, hz as u64);
+        if addr == 0 || addr == u32::MAX {
+            return None;
+        }
+        Some(Profiler { base: addr as usize as *mut u8 })
+    }
+
+    /// Stop sampling; samples already taken can still be drained.
+    pub fn stop(&self) {
+        syscall0(SYS_PROF_STOP);
+    }
+
+    fn word(&self, offset: usize) -> *mut u32 {
+        unsafe { self.base.add(offset) as *mut u32 }
+    }
+
+    fn read(&self, offset: usize) -> u32 {
+        unsafe { core::ptr::read_volatile(self.word(offset)) }
+    }
+
+    pub fn ncpus(&self) -> usize {
+        self.read(4) as usize
+    }
+
+    /// `PROF_SOURCE_*` of the session.
+    pub fn source(&self) -> u32 {
+        self.read(8)
+    }
+
+    /// Effective samples per second per busy CPU.
+    pub fn sample_hz(&self) -> u32 {
+        self.read(12)
+    }
+
+    /// Frequency of [`ProfSample::tsc`], in Hz.
+    pub fn cycle_hz(&self) -> u64 {
+        unsafe { core::ptr::read_volatile(self.base.add(24) as *const u64) }
+    }
+
+    /// Samples dropped because a ring was full (drain more often).
+    pub fn lost(&self) -> u64 {
+        (0..self.ncpus()).map(|cpu| self.read(Self::HEADER_CPU + cpu * 64 + 8) as u64).sum()
+    }
+
+    /// Move up to `max` pending samples from all CPUs into `out`.
+    /// Returns the number taken.
+    pub fn drain(&self, out: &mut Vec<ProfSample>, max: usize) -> usize {
+        use core::sync::atomic::{AtomicU32, Ordering};
+        let capacity = self.read(16);
+        let rec_size = self.read(20) as usize;
+        if capacity == 0 || rec_size != core::mem::size_of::<ProfSample>() {
+            return 0;
+        }
+        let ring_bytes = capacity as usize * rec_size;
+        let mut taken = 0;
+        for cpu in 0..self.ncpus() {
+            let ctl = Self::HEADER_CPU + cpu * 64;
+            let (head, tail) = unsafe {
+                (&*(self.word(ctl) as *const AtomicU32), &*(self.word(ctl + 4) as *const AtomicU32))
+            };
+            let ring = unsafe { self.base.add(4096 + cpu * ring_bytes) as *const ProfSample };
+            let mut h = head.load(Ordering::Relaxed);
+            let t = tail.load(Ordering::Acquire);
+            while h != t && taken < max {
+                out.push(unsafe { core::ptr::read_volatile(ring.add((h % capacity) as usize)) });
+                h = h.wrapping_add(1);
+                taken += 1;
+            }
+            head.store(h, Ordering::Release);
+        }
+        taken
+    }
+}
@@ -104,6 +104,44 @@ pub fn set_fd_nonblock(fd: u32, nonblock: bool) {
     syscall3(SYS_FCNTL_SC, fd as u64, F_SETFL as u64, if nonblock { O_NONBLOCK as u64 } else { 0 });
 }
 
+/// Create an anonymous pipe.  Returns `(read_fd, write_fd)`: reads block
+/// until data arrives (0 once the write end is closed), writes block while
+/// the pipe is full.
+pub fn pipe() -> Option<(u32, u32)> {
+    let mut fds = [0u32; 2];
+    if syscall2(SYS_PIPE2, fds.as_mut_ptr() as u64, 0) != 0 {
+        return None;
+    }
+    Some((fds[0], fds[1]))
+}
+
+/// Set the capacity of an anonymous pipe (either end) in bytes, up to
+/// 1 MiB. Returns the new capacity, or u32::MAX if `fd` is not a pipe, the
+/// size is too large, or more data than that is buffered.
+pub fn set_pipe_size(fd: u32, size: u32) -> u32 {
+    const F_SETPIPE_SZ: u32 = 1031;
+    syscall3(SYS_FCNTL_SC, fd as u64, F_SETPIPE_SZ as u64, size as u64)
+}
+
+/// Current capacity of an anonymous pipe in bytes, or u32::MAX.
+pub fn pipe_size(fd: u32) -> u32 {
+    const F_GETPIPE_SZ: u32 = 1032;
+    syscall3(SYS_FCNTL_SC, fd as u64, F_GETPIPE_SZ as u64, 0)
+}
+
+/// `splice` flag: the input end is a TCP socket id.
+pub const SPLICE_SOCKET_IN: u32 = 1 << 0;
+/// `splice` flag: the output end is a TCP socket id.
+pub const SPLICE_SOCKET_OUT: u32 = 1 << 1;
+
+/// Move up to `len` bytes between an anonymous pipe and a file or TCP
+/// socket inside the kernel, without copying through user space. Exactly
+/// one of `fd_in` / `fd_out` must be a pipe; `flags` marks the other end
+/// as a socket id. Returns bytes moved, 0 at EOF, or u32::MAX on error.
+pub fn splice(fd_in: u32, fd_out: u32, len: u32, flags: u32) -> u32 {
+    syscall4(SYS_SPLICE, fd_in as u64, fd_out as u64, len as u64, flags as u64)
+}
+
 pub fn open(path: &str, flags: u32) -> u32 {
     let mut buf = [0u8; 257];
     prepare_path(path, &mut buf);
@@ -122,6 +160,18 @@ pub fn readdir(path: &str, buf: &mut [u8]) -> u32 {
     sys_err(syscall3(SYS_READDIR, path_buf.as_ptr() as u64, buf.as_mut_ptr() as u64, buf.len() as u64))
 }
 
+/// Read a batch of directory entries with their attributes, starting at
+/// entry index `*cookie`; `*cookie` is advanced past the returned entries.
+/// Returns the number of records (0 at the end, u32::MAX on error).
+/// Each record: [reclen:u16, type:u8, flags:u8, size:u32, uid:u16, gid:u16,
+/// mode:u16, name_len:u16, mtime:u32, name, NUL] padded to 4 bytes.
+pub fn getdents(path: &str, buf: &mut [u8], cookie: &mut u32) -> u32 {
+    let mut path_buf = [0u8; 257];
+    prepare_path(path, &mut path_buf);
+    sys_err(syscall4(SYS_GETDENTS, path_buf.as_ptr() as u64, buf.as_mut_ptr() as u64,
+        buf.len() as u64, cookie as *mut u32 as u64))
+}
+
 /// Get file status (follows symlinks). Returns 0 on success.
 /// Writes [type:u32, size:u32, flags:u32, uid:u32, gid:u32, mode:u32, mtime:u32] to buf.
 /// flags: bit 0 = is_symlink
@@ -225,6 +275,27 @@ pub fn isatty(fd: u32) -> u32 {
     syscall1(SYS_ISATTY, fd as u64)
 }
 
+/// Write buffered data of the file's filesystem to disk.
+/// Returns 0 on success, u32::MAX on error.
+pub fn fsync(fd: u32) -> u32 {
+    sys_err(syscall1(SYS_FSYNC, fd as u64))
+}
+
+/// `flock` operations: shared, exclusive, non-blocking modifier, unlock.
+pub const LOCK_SH: u32 = 1;
+pub const LOCK_EX: u32 = 2;
+pub const LOCK_NB: u32 = 4;
+pub const LOCK_UN: u32 = 8;
+
+/// Take (`LOCK_SH`/`LOCK_EX`, optionally `| LOCK_NB`) or release (`LOCK_UN`)
+/// an advisory whole-file lock. The lock belongs to the open file and is
+/// released when its last descriptor closes.
+/// Returns 0 on success, -11 (EAGAIN) if `LOCK_NB` was given and the file
+/// is locked, or another negative value on error.
+pub fn flock(fd: u32, op: u32) -> i32 {
+    syscall2(SYS_FLOCK, fd as u64, op as u64) as i32
+}
+
 /// Mount a filesystem.
 /// `mount_path`: where to mount (e.g. "/mnt/cdrom0")
 /// `device`: device path (e.g. "/dev/cdrom0")
@@ -455,6 +526,14 @@ pub struct DirEntry {
     pub file_type: u8,
     /// File size in bytes.
     pub size: u32,
+    /// True if the entry itself is a symbolic link (type and size are the target's).
+    pub is_symlink: bool,
+    pub uid: u16,
+    pub gid: u16,
+    /// Permission mode, as in `stat`.
+    pub mode: u16,
+    /// Modification time (Unix seconds, 0 if unknown).
+    pub mtime: u32,
 }
 
 impl DirEntry {
@@ -485,7 +564,10 @@ impl Iterator for ReadDir {
             // Move out of the vec by swapping with a dummy
             Some(core::mem::replace(
                 &mut self.entries[i],
-                DirEntry { name: String::new(), file_type: 0, size: 0 },
+                DirEntry {
+                    name: String::new(), file_type: 0, size: 0,
+                    is_symlink: false, uid: 0, gid: 0, mode: 0, mtime: 0,
+                },
             ))
         } else {
             None
@@ -494,38 +576,38 @@ impl Iterator for ReadDir {
 }
 
 /// Read directory entries and return an iterator.
+/// Entries carry the attributes `stat` would report, so listing a
+/// directory needs no further path lookups.
 pub fn read_dir(path: &str) -> error::Result<ReadDir> {
-    // Allocate buffer for up to 128 entries (128 * 64 = 8192 bytes)
-    let mut buf = vec![0u8; 8192];
-    let count = readdir(path, &mut buf);
-    if count == u32::MAX {
-        return Err(error::Error::NotFound);
-    }
-    let count = count as usize;
-    let mut entries = Vec::with_capacity(count);
-    for i in 0..count {
-        let base = i * 64;
-        if base + 64 > buf.len() {
+    let mut buf = vec![0u8; 16 * 1024];
+    let mut cookie = 0u32;
+    let mut entries = Vec::new();
+    loop {
+        let count = getdents(path, &mut buf, &mut cookie);
+        if count == u32::MAX {
+            return Err(error::Error::NotFound);
+        }
+        if count == 0 {
             break;
         }
-        let entry_type = buf[base];
-        let name_len = buf[base + 1] as usize;
-        let size = u32::from_le_bytes([
-            buf[base + 4],
-            buf[base + 5],
-            buf[base + 6],
-            buf[base + 7],
-        ]);
-        let name_start = base + 8;
-        let name_end = (name_start + name_len).min(base + 64);
-        let name = core::str::from_utf8(&buf[name_start..name_end])
-            .unwrap_or("")
-            .into();
-        entries.push(DirEntry {
-            name,
-            file_type: entry_type,
-            size,
-        });
+        let mut off = 0;
+        for _ in 0..count {
+            let rec = &buf[off..];
+            let reclen = u16::from_le_bytes([rec[0], rec[1]]) as usize;
+            let name_len = u16::from_le_bytes([rec[14], rec[15]]) as usize;
+            let name = core::str::from_utf8(&rec[20..20 + name_len]).unwrap_or("").into();
+            entries.push(DirEntry {
+                name,
+                file_type: rec[2],
+                size: u32::from_le_bytes([rec[4], rec[5], rec[6], rec[7]]),
+                is_symlink: rec[3] & 1 != 0,
+                uid: u16::from_le_bytes([rec[8], rec[9]]),
+                gid: u16::from_le_bytes([rec[10], rec[11]]),
+                mode: u16::from_le_bytes([rec[12], rec[13]]),
+                mtime: u32::from_le_bytes([rec[16], rec[17], rec[18], rec[19]]),
+            });
+            off += reclen;
+        }
     }
     Ok(ReadDir { entries, index: 0 })
 }
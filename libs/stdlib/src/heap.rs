@@ -1,7 +1,8 @@
-//! User-space heap allocator with free-list, coalescing, and mmap fallback.
+//! User-space heap allocator with segregated free lists and mmap fallback.
 //!
-//! Small allocations use `sbrk()` with a sorted linked-list free list (via
-//! libheap).  When the sbrk region is exhausted, the allocator transparently
+//! Small allocations use `sbrk()` with libheap's [`FreeLists`] (exact-size
+//! bins for small blocks, an address-ordered coalescing tree for larger
+//! ones).  When the sbrk region is exhausted, the allocator transparently
 //! falls back to `mmap()` which draws from a separate 1.25 GiB virtual region
 //! (0x70000000–0xBF000000).
 //!
@@ -11,12 +12,19 @@
 //!
 //! The `GlobalAlloc` trait provides the `Layout` on dealloc, so no per-block
 //! header is needed — the block size is recomputed from the layout.
+//!
+//! Usage counters ([`HeapStats`]) are pushed to the kernel with
+//! `SYS_HEAP_REPORT` whenever the heap grows and every
+//! [`REPORT_INTERVAL`] operations, so the task manager can show per-process
+//! heap use and fragmentation.
 
 use core::alloc::{GlobalAlloc, Layout};
 use core::sync::atomic::{AtomicBool, Ordering};
 use core::ptr;
 
-use libheap::{FreeBlock, block_size, free_list_alloc, free_list_dealloc};
+use libheap::{block_size, FreeLists, HeapStats};
+
+use crate::raw::{syscall2, SYS_HEAP_REPORT};
 
 #[global_allocator]
 static ALLOCATOR: FreeListAlloc = FreeListAlloc;
@@ -31,8 +39,19 @@ static mut HEAP_POS: u64 = 0;
 /// Current end of mapped heap pages (kernel break).
 static mut HEAP_END: u64 = 0;
 
-/// Head of the sorted free list.
-static mut FREE_LIST: *mut FreeBlock = ptr::null_mut();
+/// Free blocks of the sbrk heap.
+static mut FREE: FreeLists = FreeLists::new();
+
+/// Allocator counters (free-list fields are filled in on snapshot).
+static mut STATS: HeapStats = HeapStats {
+    heap_bytes: 0, in_use: 0, free: 0, largest_free: 0, free_blocks: 0, mapped: 0,
+};
+
+/// Heap operations since start; every `REPORT_INTERVAL`th one reports.
+static mut OPS: u32 = 0;
+
+/// Operations between unconditional `SYS_HEAP_REPORT` calls.
+const REPORT_INTERVAL: u32 = 4096;
 
 /// Allocations ≥ this size bypass sbrk and go directly through mmap/munmap.
 /// 64 KiB — matches typical OS large-allocation thresholds.
@@ -50,6 +69,38 @@ pub fn init() {
         HEAP_POS = brk;
         HEAP_END = brk;
     }
+    // Clear any record left over from the image we were exec'd from.
+    report(Some(HeapStats::default()));
+}
+
+/// Current heap usage of this process.
+pub fn stats() -> HeapStats {
+    lock();
+    let s = unsafe { snapshot() };
+    unlock();
+    s
+}
+
+/// Counters plus free-list state.  Caller holds `HEAP_LOCK`.
+unsafe fn snapshot() -> HeapStats {
+    let mut s = *ptr::addr_of!(STATS);
+    (*ptr::addr_of!(FREE)).fill_stats(&mut s);
+    s
+}
+
+/// Count one heap operation.  Returns the snapshot to report when the sbrk
+/// heap grew (`force`) or the interval elapsed.  Caller holds `HEAP_LOCK`.
+unsafe fn note_op(force: bool) -> Option<HeapStats> {
+    OPS = OPS.wrapping_add(1);
+    if force || OPS % REPORT_INTERVAL == 0 { Some(snapshot()) } else { None }
+}
+
+/// Push a snapshot to the kernel (called without `HEAP_LOCK` held).
+#[inline]
+fn report(stats: Option<HeapStats>) {
+    if let Some(s) = stats {
+        syscall2(SYS_HEAP_REPORT, &s as *const HeapStats as u64, core::mem::size_of::<HeapStats>() as u64);
+    }
 }
 
 #[inline]
@@ -100,6 +151,70 @@ fn is_mmap_ptr(ptr: *mut u8) -> bool {
     addr >= MMAP_REGION_START && addr < MMAP_REGION_END
 }
 
+/// `mmap_alloc` plus accounting.
+unsafe fn mmap_alloc_counted(size: usize) -> *mut u8 {
+    let ptr = mmap_alloc(size);
+    if ptr.is_null() { return ptr; }
+    lock();
+    STATS.in_use += size as u32;
+    STATS.mapped += page_align(size) as u32;
+    let r = note_op(false);
+    unlock();
+    report(r);
+    ptr
+}
+
+/// Hand out `size` bytes from the heap top, growing it with sbrk.  The
+/// caller holds `HEAP_LOCK`; returns null when sbrk is exhausted.
+unsafe fn sbrk_alloc(size: usize, align: u64) -> *mut u8 {
+    let aligned = (HEAP_POS + align - 1) & !(align - 1);
+    let new_pos = aligned + size as u64;
+
+    if new_pos > HEAP_END {
+        let grow = ((new_pos - HEAP_END + 4095) & !4095) as usize;
+        let result = crate::process::sbrk(grow as i32);
+
+        if result == u32::MAX as usize {
+            return ptr::null_mut();
+        }
+
+        let result = result as u64;
+        let grow = grow as u64;
+        STATS.heap_bytes += grow as u32;
+
+        if result == HEAP_END {
+            // Contiguous extension.
+            HEAP_END += grow;
+        } else {
+            // Non-contiguous: another allocator (DLL) moved the break.
+            // Relocate the allocation to start at `result`.
+            let aligned = (result + align - 1) & !(align - 1);
+            let new_pos = aligned + size as u64;
+            let mapped_end = result + grow;
+
+            // The original `grow` may not cover the full allocation
+            // from the new position — request extra pages if needed.
+            if new_pos > mapped_end {
+                let extra = ((new_pos - mapped_end + 4095) & !4095) as usize;
+                let r2 = crate::process::sbrk(extra as i32);
+                if r2 == u32::MAX as usize {
+                    return ptr::null_mut();
+                }
+                STATS.heap_bytes += extra as u32;
+                HEAP_END = mapped_end + extra as u64;
+            } else {
+                HEAP_END = mapped_end;
+            }
+
+            HEAP_POS = new_pos;
+            return aligned as *mut u8;
+        }
+    }
+
+    HEAP_POS = new_pos;
+    aligned as *mut u8
+}
+
 unsafe impl GlobalAlloc for FreeListAlloc {
     unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
         let size = block_size(layout);
@@ -107,70 +222,34 @@ unsafe impl GlobalAlloc for FreeListAlloc {
         // Large allocations go directly through mmap (no free-list overhead,
         // and the pages are returned to the OS on dealloc).
         if size >= MMAP_THRESHOLD {
-            return mmap_alloc(size);
+            return mmap_alloc_counted(size);
         }
 
         lock();
 
-        // 1) Search free list for first fit.
-        let ptr = free_list_alloc(&mut FREE_LIST, size);
+        // 1) Reuse a free block.
+        let ptr = (*ptr::addr_of_mut!(FREE)).alloc(size, layout.align());
         if !ptr.is_null() {
+            STATS.in_use += size as u32;
+            let r = note_op(false);
             unlock();
+            report(r);
             return ptr;
         }
 
-        // 2) No free block found — try to grow via sbrk.
-        let align = layout.align().max(16) as u64;
-        let aligned = (HEAP_POS + align - 1) & !(align - 1);
-        let new_pos = aligned + size as u64;
-
-        if new_pos > HEAP_END {
-            let grow = ((new_pos - HEAP_END + 4095) & !4095) as usize;
-            let result = crate::process::sbrk(grow as i32);
-
-            if result == u32::MAX as usize {
-                // sbrk failed — fall back to mmap for this allocation.
-                unlock();
-                return mmap_alloc(size);
-            }
-
-            let result = result as u64;
-            let grow = grow as u64;
-
-            if result == HEAP_END {
-                // Contiguous extension.
-                HEAP_END += grow;
-            } else {
-                // Non-contiguous: another allocator (DLL) moved the break.
-                // Relocate the allocation to start at `result`.
-                let aligned = (result + align - 1) & !(align - 1);
-                let new_pos = aligned + size as u64;
-                let mapped_end = result + grow;
-
-                // The original `grow` may not cover the full allocation
-                // from the new position — request extra pages if needed.
-                if new_pos > mapped_end {
-                    let extra = ((new_pos - mapped_end + 4095) & !4095) as usize;
-                    let r2 = crate::process::sbrk(extra as i32);
-                    if r2 == u32::MAX as usize {
-                        // sbrk ran out even for the extra — mmap fallback.
-                        unlock();
-                        return mmap_alloc(size);
-                    }
-                    HEAP_END = mapped_end + extra as u64;
-                } else {
-                    HEAP_END = mapped_end;
-                }
-
-                HEAP_POS = new_pos;
-                unlock();
-                return aligned as *mut u8;
-            }
+        // 2) No free block found — carve from the top, growing via sbrk.
+        let heap_before = STATS.heap_bytes;
+        let ptr = sbrk_alloc(size, layout.align().max(16) as u64);
+        if ptr.is_null() {
+            // sbrk failed — fall back to mmap for this allocation.
+            unlock();
+            return mmap_alloc_counted(size);
         }
-
-        HEAP_POS = new_pos;
+        STATS.in_use += size as u32;
+        let r = note_op(STATS.heap_bytes != heap_before);
         unlock();
-        aligned as *mut u8
+        report(r);
+        ptr
     }
 
     unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
@@ -183,12 +262,21 @@ unsafe impl GlobalAlloc for FreeListAlloc {
         if is_mmap_ptr(ptr) {
             let mapped_size = page_align(size);
             crate::process::munmap(ptr, mapped_size);
+            lock();
+            STATS.in_use -= size as u32;
+            STATS.mapped -= mapped_size as u32;
+            let r = note_op(false);
+            unlock();
+            report(r);
             return;
         }
 
-        // Small sbrk allocations go back to the free list.
+        // Small sbrk allocations go back to the free lists.
         lock();
-        free_list_dealloc(&mut FREE_LIST, ptr, size);
+        (*ptr::addr_of_mut!(FREE)).dealloc(ptr, size);
+        STATS.in_use -= size as u32;
+        let r = note_op(false);
         unlock();
+        report(r);
     }
 }
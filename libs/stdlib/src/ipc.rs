@@ -1,4 +1,5 @@
-//! Inter-process communication — named pipes and event bus.
+//! Inter-process communication — named pipes, event bus, readiness wait sets
+//! and asynchronous I/O rings.
 
 use crate::raw::*;
 
@@ -109,11 +110,78 @@ pub fn evt_chan_destroy(channel_id: u32) {
 /// Block until an event is available on a channel subscription, or timeout.
 ///
 /// Returns 1 if events are available, 0 on timeout/spurious wake.
-/// `timeout_ms` = `u32::MAX` means wait indefinitely (kernel caps at 60s safety net).
+/// `timeout_ms` = `u32::MAX` means wait indefinitely.
 pub fn evt_chan_wait(channel_id: u32, sub_id: u32, timeout_ms: u32) -> u32 {
     syscall3(SYS_EVT_CHAN_WAIT, channel_id as u64, sub_id as u64, timeout_ms as u64)
 }
 
+/// Drain up to `buf.len()` (at most 64) events in one syscall. Returns the count.
+pub fn evt_chan_poll_batch(channel_id: u32, sub_id: u32, buf: &mut [[u32; 5]]) -> u32 {
+    syscall4(SYS_EVT_CHAN_POLL_BATCH, channel_id as u64, sub_id as u64,
+        buf.as_mut_ptr() as u64, buf.len() as u64)
+}
+
+/// Map the subscription's shared event ring into this process. Returns its
+/// address for [`evt_ring_pop`], or 0 if no ring is available.
+pub fn evt_chan_ring(channel_id: u32, sub_id: u32) -> usize {
+    syscall2(SYS_EVT_CHAN_RING, channel_id as u64, sub_id as u64) as usize
+}
+
+/// Pop the next event from a ring returned by [`evt_chan_ring`] without a
+/// syscall. Returns `false` when the ring is empty; check
+/// [`evt_ring_spilled`] before blocking.
+pub fn evt_ring_pop(ring: usize, buf: &mut [u32; 5]) -> bool {
+    use core::sync::atomic::{AtomicU32, Ordering};
+    let hdr = ring as *const AtomicU32;
+    unsafe {
+        let head = (*hdr).load(Ordering::Relaxed);
+        if head == (*hdr.add(1)).load(Ordering::Acquire) {
+            return false;
+        }
+        let capacity = (*hdr.add(2)).load(Ordering::Relaxed);
+        if capacity == 0 {
+            return false;
+        }
+        let ev = (ring + 64 + (head % capacity) as usize * 20) as *const u32;
+        for (i, w) in buf.iter_mut().enumerate() {
+            *w = core::ptr::read_volatile(ev.add(i));
+        }
+        (*hdr).store(head.wrapping_add(1), Ordering::Release);
+    }
+    true
+}
+
+/// Events that did not fit in the ring and wait in the kernel queue;
+/// fetch them with [`evt_chan_poll_batch`] (which also refills the ring).
+pub fn evt_ring_spilled(ring: usize) -> u32 {
+    use core::sync::atomic::{AtomicU32, Ordering};
+    unsafe { (*(ring as *const AtomicU32).add(3)).load(Ordering::Acquire) }
+}
+
+// ─── Service Readiness ──────────────────────────────────────────────
+
+/// Module channel on which services report to init.
+pub const INIT_CHANNEL: &str = "sys:init";
+/// Event on [`INIT_CHANNEL`]: `[EVT_SERVICE_READY, tid, uptime_ms, 0, 0]`.
+pub const EVT_SERVICE_READY: u32 = 0x0110;
+
+/// Tell init that the calling service is ready to serve. Units declared
+/// `ready=notify` in init.conf hold back their dependents until they call
+/// this; for anything else it only marks the boot timeline.
+pub fn notify_ready() {
+    let chan = evt_chan_create(INIT_CHANNEL);
+    let event = [EVT_SERVICE_READY, crate::process::getpid(), crate::sys::uptime_ms(), 0, 0];
+    evt_chan_emit(chan, &event);
+}
+
+// ─── Launch Reports ─────────────────────────────────────────────────
+
+/// Module channel on which libanyui reports the first frame of each process.
+pub const LAUNCH_CHANNEL: &str = "sys:launch";
+/// Event on [`LAUNCH_CHANNEL`]:
+/// `[EVT_FIRST_FRAME, tid, ms_since_spawn, uptime_ms, 0]`.
+pub const EVT_FIRST_FRAME: u32 = 0x0120;
+
 // ─── Shared Memory ──────────────────────────────────────────────────
 
 /// Create a shared memory region. Returns shm_id (>0) or 0 on failure.
@@ -137,6 +205,213 @@ pub fn shm_destroy(shm_id: u32) -> u32 {
     syscall1(SYS_SHM_DESTROY, shm_id as u64)
 }
 
+/// Hand an owned region to the next process that calls [`shm_claim`] on it,
+/// without copying. Unmaps it from the caller; unclaimed grants are freed
+/// after 5 s. Returns 0 on success.
+pub fn shm_grant(shm_id: u32) -> u32 {
+    syscall1(SYS_SHM_GRANT, shm_id as u64)
+}
+
+/// Take ownership of a granted region and map it (the caller then destroys
+/// it when done). Returns virtual address or 0 if it is not granted.
+pub fn shm_claim(shm_id: u32) -> u32 {
+    syscall1(SYS_SHM_CLAIM, shm_id as u64)
+}
+
+// ─── Readiness Wait Sets ────────────────────────────────────────────
+
+/// Interest kind: TCP socket or listener (`id` = socket id).
+pub const POLL_TCP: u32 = 1;
+/// Interest kind: bound UDP port (`id` = port).
+pub const POLL_UDP: u32 = 2;
+/// Interest kind: file descriptor (`id` = fd); pipe ends are tracked.
+pub const POLL_FD: u32 = 3;
+/// Interest kind: event-bus channel (`id` = channel id, `aux` = sub_id).
+pub const POLL_CHAN: u32 = 4;
+
+pub const POLL_CTL_ADD: u32 = 1;
+pub const POLL_CTL_MOD: u32 = 2;
+pub const POLL_CTL_DEL: u32 = 3;
+
+pub const POLLIN: u16 = 0x001;
+pub const POLLOUT: u16 = 0x004;
+pub const POLLERR: u16 = 0x008;
+pub const POLLHUP: u16 = 0x010;
+pub const POLLNVAL: u16 = 0x020;
+
+/// One interest of a wait set (24 bytes, kernel layout).
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct PollItem {
+    pub kind: u32,
+    pub id: u32,
+    pub aux: u32,
+    pub events: u16,
+    pub revents: u16,
+    /// Caller's cookie, returned unchanged.
+    pub data: u64,
+}
+
+/// Create an empty wait set. Returns its fd (closed with `fs::close`),
+/// or u32::MAX on failure.
+pub fn poll_create() -> u32 {
+    syscall0(SYS_POLL_CREATE)
+}
+
+/// Add, modify or remove (`POLL_CTL_*`) an interest, identified by
+/// `(kind, id, aux)`. Returns 0 on success, u32::MAX on failure.
+pub fn poll_ctl(set_fd: u32, op: u32, item: &PollItem) -> u32 {
+    syscall3(SYS_POLL_CTL, set_fd as u64, op as u64, item as *const PollItem as u64)
+}
+
+/// Block until interests of `set_fd` are ready or `timeout_ms` expires
+/// (u32::MAX = forever). Ready items are stored in `out` with `revents`
+/// set. Returns how many (0 on timeout), or u32::MAX on error.
+pub fn poll_wait(set_fd: u32, out: &mut [PollItem], timeout_ms: u32) -> u32 {
+    syscall4(SYS_POLL_WAIT, set_fd as u64, out.as_mut_ptr() as u64, out.len() as u64, timeout_ms as u64)
+}
+
+/// One-shot wait on `items` without a set (poll(2) semantics): fills each
+/// item's `revents`. Returns the number of ready items, or u32::MAX.
+pub fn poll_once(items: &mut [PollItem], timeout_ms: u32) -> u32 {
+    syscall4(SYS_POLL_WAIT, u32::MAX as u64, items.as_mut_ptr() as u64, items.len() as u64, timeout_ms as u64)
+}
+
+// ─── Asynchronous I/O Rings ─────────────────────────────────────────
+
+/// Ring opcode: open `addr` (NUL-terminated path) with `op_flags` as in
+/// `fs::open`; the result is the new fd.
+pub const IORING_OP_OPEN: u8 = 1;
+/// Ring opcode: read up to `len` bytes of file `fd` into `addr`.
+pub const IORING_OP_READ: u8 = 2;
+/// Ring opcode: write `len` bytes at `addr` to file `fd`.
+pub const IORING_OP_WRITE: u8 = 3;
+/// Ring opcode: stat path `addr` into `addr2` (`[u32; 7]`, as `fs::stat`).
+pub const IORING_OP_STAT: u8 = 4;
+/// Ring opcode: close `fd`.
+pub const IORING_OP_CLOSE: u8 = 5;
+/// Ring opcode: send `len` bytes at `addr` on TCP socket `fd`
+/// (`op_flags` = timeout in ms, 0 = default).
+pub const IORING_OP_TCP_SEND: u8 = 6;
+/// Ring opcode: receive up to `len` bytes from TCP socket `fd` into `addr`
+/// (`op_flags` = timeout in ms, 0 = default).
+pub const IORING_OP_TCP_RECV: u8 = 7;
+
+/// Submission queue entry (40 bytes, kernel layout).
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct IoSqe {
+    pub opcode: u8,
+    pub flags: u8,
+    pub reserved: u16,
+    pub fd: u32,
+    pub addr: u64,
+    pub addr2: u64,
+    pub len: u32,
+    pub op_flags: u32,
+    /// Caller's cookie, returned unchanged in the completion.
+    pub user_data: u64,
+}
+
+/// Completion queue entry (16 bytes, kernel layout).
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct IoCqe {
+    pub user_data: u64,
+    /// Byte count, new fd, 0, or an error (u32::MAX / negative errno).
+    pub result: u32,
+    pub flags: u32,
+}
+
+const IORING_HEADER_WORDS: usize = 8;
+
+/// An I/O ring: queue operations with [`IoRing::push`], hand them to the
+/// kernel worker pool with [`IoRing::enter`], and collect results with
+/// [`IoRing::pop`]. Buffers named by queued entries must stay valid until
+/// their completion is popped. Completions may arrive in any order.
+///
+/// The ring fd can be added to a wait set (`POLL_FD`); it is readable when
+/// completions are waiting for `enter`.
+pub struct IoRing {
+    fd: u32,
+    mem: alloc::vec::Vec<u64>,
+    sq_entries: u32,
+    cq_entries: u32,
+}
+
+impl IoRing {
+    /// Create a ring with `entries` submission slots (power of two, up to
+    /// 256) and twice as many completion slots.
+    pub fn new(entries: u32) -> Option<IoRing> {
+        let bytes = 32 + entries as usize * core::mem::size_of::<IoSqe>()
+            + entries as usize * 2 * core::mem::size_of::<IoCqe>();
+        let mut mem = alloc::vec![0u64; bytes / 8];
+        let fd = syscall3(SYS_IO_RING_SETUP, entries as u64, mem.as_mut_ptr() as u64, bytes as u64);
+        if fd == u32::MAX {
+            return None;
+        }
+        Some(IoRing { fd, mem, sq_entries: entries, cq_entries: entries * 2 })
+    }
+
+    /// The ring's fd, for wait sets.
+    pub fn fd(&self) -> u32 {
+        self.fd
+    }
+
+    fn word(&self, idx: usize) -> &core::sync::atomic::AtomicU32 {
+        unsafe { &*((self.mem.as_ptr() as *const core::sync::atomic::AtomicU32).add(idx)) }
+    }
+
+    /// Queue `sqe`. Returns false if the submission queue is full.
+    pub fn push(&mut self, sqe: &IoSqe) -> bool {
+        use core::sync::atomic::Ordering;
+        let head = self.word(0).load(Ordering::Acquire);
+        let tail = self.word(1).load(Ordering::Relaxed);
+        if tail.wrapping_sub(head) >= self.sq_entries {
+            return false;
+        }
+        let slot = (tail & (self.sq_entries - 1)) as usize;
+        unsafe {
+            let sq = (self.mem.as_mut_ptr() as *mut u32).add(IORING_HEADER_WORDS) as *mut IoSqe;
+            core::ptr::write_volatile(sq.add(slot), *sqe);
+        }
+        self.word(1).store(tail.wrapping_add(1), Ordering::Release);
+        true
+    }
+
+    /// Submit every queued entry, then wait until `min_complete`
+    /// completions are available or `timeout_ms` expires (u32::MAX =
+    /// forever). Returns the number of entries submitted, or u32::MAX.
+    pub fn enter(&mut self, min_complete: u32, timeout_ms: u32) -> u32 {
+        syscall4(SYS_IO_RING_ENTER, self.fd as u64, self.sq_entries as u64,
+            min_complete as u64, timeout_ms as u64)
+    }
+
+    /// Take the next completion posted by [`IoRing::enter`].
+    pub fn pop(&mut self) -> Option<IoCqe> {
+        use core::sync::atomic::Ordering;
+        let head = self.word(2).load(Ordering::Relaxed);
+        let tail = self.word(3).load(Ordering::Acquire);
+        if head == tail {
+            return None;
+        }
+        let slot = (head & (self.cq_entries - 1)) as usize;
+        let cqe = unsafe {
+            let sq = (self.mem.as_ptr() as *const u32).add(IORING_HEADER_WORDS) as *const IoSqe;
+            let cq = sq.add(self.sq_entries as usize) as *const IoCqe;
+            core::ptr::read_volatile(cq.add(slot))
+        };
+        self.word(2).store(head.wrapping_add(1), Ordering::Release);
+        Some(cqe)
+    }
+}
+
+impl Drop for IoRing {
+    fn drop(&mut self) {
+        syscall1(SYS_CLOSE, self.fd as u64);
+    }
+}
+
 // ─── Compositor-Privileged ──────────────────────────────────────────
 
 /// Register calling process as the compositor. Returns 0 on success.
@@ -187,6 +462,36 @@ pub fn gpu_register_backbuffer(buf_ptr: u32, buf_size: u32) -> u32 {
     syscall2(SYS_GPU_REGISTER_BACKBUFFER, buf_ptr as u64, buf_size as u64)
 }
 
+/// Wait for the start of the next vertical retrace. Compositor-only.
+/// Returns `Some(true)` at the retrace edge, `Some(false)` on timeout, and
+/// `None` if the GPU does not report retrace status.
+pub fn gpu_wait_vblank(timeout_ms: u32) -> Option<bool> {
+    match syscall1(SYS_GPU_WAIT_VBLANK, timeout_ms as u64) {
+        0 => Some(true),
+        1 => Some(false),
+        _ => None,
+    }
+}
+
+/// Register a GPU command ring of `ring_bytes` at `ring_ptr` (0 to
+/// unregister). Compositor-only. Returns the number of command slots, or 0
+/// if the kernel has no ring support.
+pub fn gpu_ring_setup(ring_ptr: u32, ring_bytes: u32) -> u32 {
+    syscall2(SYS_GPU_RING_SETUP, ring_ptr as u64, ring_bytes as u64)
+}
+
+/// Execute the commands queued in the GPU command ring. Compositor-only.
+/// Returns the completed fence value, or u32::MAX without a ring.
+pub fn gpu_ring_doorbell() -> u32 {
+    syscall0(SYS_GPU_RING_DOORBELL)
+}
+
+/// Block until GPU ring fence `fence` has completed. Compositor-only.
+/// Returns the completed fence value, or u32::MAX without a ring.
+pub fn gpu_fence_wait(fence: u32) -> u32 {
+    syscall1(SYS_GPU_FENCE_WAIT, fence as u64)
+}
+
 /// Poll raw input events. Returns number of events written to buf.
 /// Each event is [u32; 5]: { event_type, arg0, arg1, arg2, arg3 }.
 pub fn input_poll(buf: &mut [[u32; 5]]) -> u32 {
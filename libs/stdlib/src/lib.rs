@@ -25,8 +25,10 @@ pub mod json;
 pub mod kbd;
 pub mod net;
 pub mod permissions;
+pub mod pool;
 pub mod prelude;
 pub mod process;
+pub mod sync;
 pub mod sys;
 pub mod ui;
 pub mod users;
@@ -1,9 +1,15 @@
 //! Structured logging API for anyOS user programs.
 //!
-//! Messages are sent to the central `logd` daemon via the "log" named pipe.
-//! The pipe is opened lazily on first use and cached for the process lifetime.
+//! Messages go to the central `logd` daemon.  On first use a process creates
+//! a [`Ring`] in shared memory and announces it over the "log" named pipe;
+//! after that a message is written into the ring with an atomic reservation
+//! and no syscall, and `logd` drains all rings in batches.  A full ring drops
+//! the message and counts it instead of blocking.  When no ring can be set
+//! up, every message is written to the pipe as before.
 //!
-//! Wire format: `LEVEL|source|message\n`
+//! Wire format (pipe lines and ring records): `LEVEL|source|message\n`;
+//! ring records omit the newline.  `RING|<shm_id>\n` on the pipe announces
+//! a ring.
 //!
 //! # Example
 //! ```ignore
@@ -12,11 +18,17 @@
 //! anyos_std::log_error!("failed to open file: {}", path);
 //! ```
 
-use core::sync::atomic::{AtomicU32, Ordering};
+use core::sync::atomic::{AtomicU32, AtomicUsize, Ordering};
 
 /// Pipe ID cache. 0 = not yet opened, u32::MAX = open failed.
 static LOG_PIPE: AtomicU32 = AtomicU32::new(0);
 
+/// This process's ring: 0 = not set up, `RING_BUSY` = being set up,
+/// `RING_NONE` = unavailable (use the pipe), else the mapped address.
+static LOG_RING: AtomicUsize = AtomicUsize::new(0);
+const RING_BUSY: usize = 1;
+const RING_NONE: usize = usize::MAX;
+
 /// Log severity levels matching logd protocol.
 pub const LEVEL_INFO: &str = "INFO";
 pub const LEVEL_WARN: &str = "WARN";
@@ -67,6 +79,257 @@ fn source_name(buf: &mut [u8; 32]) -> usize {
     name_len
 }
 
+// ─── Shared-memory ring ─────────────────────────────────────────────
+
+/// Bytes of record data in a ring (power of two, so cursors can wrap).
+pub const RING_DATA_SIZE: usize = 16 * 1024;
+/// Header bytes before the data.
+const RING_HEADER_SIZE: usize = 64;
+const RING_MAGIC: u32 = 0x4C47_5231; // "LGR1"
+
+/// Ring states (header word `state`).
+const STATE_PENDING: u32 = 0;
+const STATE_ATTACHED: u32 = 1;
+const STATE_DETACHED: u32 = 2;
+
+/// Record header: payload length plus flags.
+const REC_READY: u32 = 1 << 31;
+const REC_PAD: u32 = 1 << 30;
+const REC_LEN_MASK: u32 = 0xFFFF;
+
+/// A multi-producer, single-consumer log ring in shared memory.
+///
+/// Layout: a 64-byte header of u32 words `[magic, state, reserve, read,
+/// dropped, shm_id, source_len, 0, source[32]]`, then [`RING_DATA_SIZE`]
+/// bytes of records.  A record is a u32 header (`len | REC_READY`) and
+/// `len` payload bytes, padded to 4.  Producers claim space by advancing
+/// `reserve` with a CAS and publish the header last; a record that would
+/// cross the end of the data is preceded by a `REC_PAD` filler.  The
+/// consumer zeroes what it has read before advancing `read`, so an
+/// unpublished header always reads as 0.
+///
+/// `logd` detaches a ring that stays idle (`state` = detached, unmapped);
+/// the next producer that sees this announces the ring again.
+pub struct Ring {
+    base: *mut u8,
+}
+
+impl Ring {
+    /// View the ring mapped at `addr`.
+    ///
+    /// # Safety
+    /// `addr` must map at least `RING_HEADER_SIZE + RING_DATA_SIZE` bytes.
+    pub unsafe fn from_addr(addr: usize) -> Ring {
+        Ring { base: addr as *mut u8 }
+    }
+
+    /// Shared-memory size of a ring.
+    pub const fn shm_size() -> u32 {
+        (RING_HEADER_SIZE + RING_DATA_SIZE) as u32
+    }
+
+    fn word(&self, i: usize) -> &AtomicU32 {
+        unsafe { &*(self.base as *const AtomicU32).add(i) }
+    }
+
+    fn data_word(&self, off: usize) -> &AtomicU32 {
+        unsafe { &*(self.base.add(RING_HEADER_SIZE + off) as *const AtomicU32) }
+    }
+
+    /// True if the header was initialized by [`init`](Self::init).
+    pub fn is_valid(&self) -> bool {
+        self.word(0).load(Ordering::Acquire) == RING_MAGIC
+    }
+
+    /// The region's id, as recorded by its creator.
+    pub fn shm_id(&self) -> u32 {
+        self.word(5).load(Ordering::Relaxed)
+    }
+
+    /// The creating program's name.
+    pub fn source(&self) -> &[u8] {
+        let len = (self.word(6).load(Ordering::Relaxed) as usize).min(32);
+        unsafe { core::slice::from_raw_parts(self.base.add(32), len) }
+    }
+
+    fn init(&self, shm_id: u32, source: &[u8]) {
+        let len = source.len().min(32);
+        unsafe { core::ptr::copy_nonoverlapping(source.as_ptr(), self.base.add(32), len) };
+        self.word(6).store(len as u32, Ordering::Relaxed);
+        self.word(5).store(shm_id, Ordering::Relaxed);
+        self.word(0).store(RING_MAGIC, Ordering::Release);
+    }
+
+    /// Append one record.  Returns false (and counts a drop) if it does not fit.
+    pub fn push(&self, payload: &[u8]) -> bool {
+        let len = payload.len().min(REC_LEN_MASK as usize);
+        let need = 4 + ((len + 3) & !3);
+        let (off, total) = loop {
+            let res = self.word(2).load(Ordering::Relaxed);
+            let read = self.word(3).load(Ordering::Acquire);
+            let off = res as usize % RING_DATA_SIZE;
+            let to_end = RING_DATA_SIZE - off;
+            let total = if need <= to_end { need } else { to_end + need };
+            if res.wrapping_sub(read) as usize + total > RING_DATA_SIZE {
+                self.word(4).fetch_add(1, Ordering::Relaxed);
+                return false;
+            }
+            if self.word(2)
+                .compare_exchange_weak(res, res.wrapping_add(total as u32), Ordering::SeqCst, Ordering::Relaxed)
+                .is_ok()
+            {
+                break (off, total);
+            }
+        };
+        let mut pos = off;
+        if total != need {
+            // Fill the tail and start the record at the beginning of the data.
+            let pad = (RING_DATA_SIZE - off - 4) as u32;
+            self.data_word(off).store(pad | REC_PAD | REC_READY, Ordering::Release);
+            pos = 0;
+        }
+        unsafe {
+            core::ptr::copy_nonoverlapping(payload.as_ptr(), self.base.add(RING_HEADER_SIZE + pos + 4), len);
+        }
+        self.data_word(pos).store(len as u32 | REC_READY, Ordering::Release);
+        true
+    }
+
+    /// Consumer: call `f` with up to `max` published records, oldest first,
+    /// and free them.  Returns the number of records passed to `f`.
+    pub fn drain(&self, max: usize, mut f: impl FnMut(&[u8])) -> usize {
+        let mut n = 0;
+        while n < max {
+            let read = self.word(3).load(Ordering::Relaxed);
+            if read == self.word(2).load(Ordering::Acquire) {
+                break;
+            }
+            let off = read as usize % RING_DATA_SIZE;
+            let hdr = self.data_word(off).load(Ordering::Acquire);
+            if hdr & REC_READY == 0 {
+                break; // reserved but not yet written
+            }
+            let len = (hdr & REC_LEN_MASK) as usize;
+            let total = 4 + ((len + 3) & !3);
+            if total > RING_DATA_SIZE - off {
+                // Corrupt header: skip everything reserved so far.
+                let res = self.word(2).load(Ordering::Acquire);
+                unsafe { core::ptr::write_bytes(self.base.add(RING_HEADER_SIZE), 0, RING_DATA_SIZE) };
+                self.word(3).store(res, Ordering::Release);
+                break;
+            }
+            if hdr & REC_PAD == 0 {
+                f(unsafe { core::slice::from_raw_parts(self.base.add(RING_HEADER_SIZE + off + 4), len) });
+                n += 1;
+            }
+            unsafe { core::ptr::write_bytes(self.base.add(RING_HEADER_SIZE + off), 0, total) };
+            self.word(3).store(read.wrapping_add(total as u32), Ordering::Release);
+        }
+        n
+    }
+
+    /// Consumer: take and reset the dropped-record counter.
+    pub fn take_dropped(&self) -> u32 {
+        self.word(4).swap(0, Ordering::Relaxed)
+    }
+
+    /// Consumer: mark the ring attached (after mapping it).
+    pub fn attach(&self) {
+        self.word(1).store(STATE_ATTACHED, Ordering::SeqCst);
+    }
+
+    /// Consumer: detach an empty ring.  Returns false if a record arrived
+    /// meanwhile or the producer already re-announced it; the ring then
+    /// stays attached.
+    pub fn try_detach(&self) -> bool {
+        let read = self.word(3).load(Ordering::Relaxed);
+        if self.word(2).load(Ordering::SeqCst) != read {
+            return false;
+        }
+        if self.word(1)
+            .compare_exchange(STATE_ATTACHED, STATE_DETACHED, Ordering::SeqCst, Ordering::SeqCst)
+            .is_err()
+        {
+            return false;
+        }
+        if self.word(2).load(Ordering::SeqCst) != read {
+            // A producer reserved before it could see the detach: keep going.
+            let _ = self.word(1).compare_exchange(
+                STATE_DETACHED, STATE_ATTACHED, Ordering::SeqCst, Ordering::SeqCst);
+            return false;
+        }
+        true
+    }
+
+    /// Producer: claim the right to re-announce a detached ring.
+    fn take_detached(&self) -> bool {
+        self.word(1).load(Ordering::SeqCst) == STATE_DETACHED
+            && self.word(1)
+                .compare_exchange(STATE_DETACHED, STATE_PENDING, Ordering::SeqCst, Ordering::Relaxed)
+                .is_ok()
+    }
+}
+
+/// Announce ring `shm_id` to logd over `pipe`.
+fn announce_ring(pipe: u32, shm_id: u32) {
+    let mut buf = [0u8; 16];
+    buf[..5].copy_from_slice(b"RING|");
+    let mut pos = 5;
+    let mut digits = [0u8; 10];
+    let mut n = 0;
+    let mut v = shm_id;
+    loop {
+        digits[n] = b'0' + (v % 10) as u8;
+        n += 1;
+        v /= 10;
+        if v == 0 {
+            break;
+        }
+    }
+    while n > 0 {
+        n -= 1;
+        buf[pos] = digits[n];
+        pos += 1;
+    }
+    buf[pos] = b'\n';
+    crate::ipc::pipe_write(pipe, &buf[..pos + 1]);
+}
+
+/// This process's ring, set up on first use.  `None` while another thread
+/// is setting it up or if shared memory is unavailable.
+fn get_ring(pipe: u32) -> Option<Ring> {
+    match LOG_RING.load(Ordering::Acquire) {
+        0 => {}
+        RING_BUSY | RING_NONE => return None,
+        addr => return Some(unsafe { Ring::from_addr(addr) }),
+    }
+    if LOG_RING.compare_exchange(0, RING_BUSY, Ordering::AcqRel, Ordering::Relaxed).is_err() {
+        return None;
+    }
+    let shm_id = crate::ipc::shm_create(Ring::shm_size());
+    let addr = if shm_id != 0 { crate::ipc::shm_map(shm_id) as usize } else { 0 };
+    if addr == 0 {
+        if shm_id != 0 {
+            crate::ipc::shm_destroy(shm_id);
+        }
+        LOG_RING.store(RING_NONE, Ordering::Release);
+        return None;
+    }
+    let ring = unsafe { Ring::from_addr(addr) };
+    let mut name_buf = [0u8; 32];
+    let name_len = source_name(&mut name_buf);
+    ring.init(shm_id, &name_buf[..name_len]);
+    announce_ring(pipe, shm_id);
+    LOG_RING.store(addr, Ordering::Release);
+    Some(ring)
+}
+
+/// Forget the parent's ring in a forked child: the child's copy of the
+/// region is private, so logd would never see its records.
+pub(crate) fn reset_after_fork() {
+    LOG_RING.store(0, Ordering::Relaxed);
+}
+
 /// Send a log message to logd. This is the core function used by the macros.
 /// Format: `LEVEL|source|message\n`
 pub fn log_msg(level: &str, args: core::fmt::Arguments) {
@@ -74,6 +337,7 @@ pub fn log_msg(level: &str, args: core::fmt::Arguments) {
     if pipe == 0 {
         return; // logd not running, silently drop
     }
+    let ring = get_ring(pipe);
 
     // Build the message in a stack buffer to avoid heap allocation
     let mut buf = [0u8; 512];
@@ -88,10 +352,19 @@ pub fn log_msg(level: &str, args: core::fmt::Arguments) {
     pos += 1;
 
     // Source
-    let mut name_buf = [0u8; 32];
-    let name_len = source_name(&mut name_buf);
-    buf[pos..pos + name_len].copy_from_slice(&name_buf[..name_len]);
-    pos += name_len;
+    match &ring {
+        Some(r) => {
+            let name = r.source();
+            buf[pos..pos + name.len()].copy_from_slice(name);
+            pos += name.len();
+        }
+        None => {
+            let mut name_buf = [0u8; 32];
+            let name_len = source_name(&mut name_buf);
+            buf[pos..pos + name_len].copy_from_slice(&name_buf[..name_len]);
+            pos += name_len;
+        }
+    }
     buf[pos] = b'|';
     pos += 1;
 
@@ -115,6 +388,15 @@ pub fn log_msg(level: &str, args: core::fmt::Arguments) {
     let _ = core::fmt::write(&mut writer, args);
     pos += writer.pos;
 
+    if let Some(r) = ring {
+        // A full ring counts the drop; logd reports it.
+        r.push(&buf[..pos]);
+        if r.take_detached() {
+            announce_ring(pipe, r.shm_id());
+        }
+        return;
+    }
+
     // Newline terminator
     if pos < 512 {
         buf[pos] = b'\n';
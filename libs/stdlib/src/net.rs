@@ -125,6 +125,14 @@ pub fn tcp_send(socket_id: u32, data: &[u8]) -> u32 {
     syscall3(SYS_TCP_SEND, socket_id as u64, data.as_ptr() as u64, data.len() as u64)
 }
 
+/// Send `len` bytes of the open file `fd`, starting at file offset
+/// `offset`, on a TCP connection.  The kernel streams the data straight
+/// from the page cache; the file position is not moved.
+/// Returns bytes sent (short at end of file) or u32::MAX on error.
+pub fn sendfile(fd: u32, socket_id: u32, offset: u32, len: u32) -> u32 {
+    syscall4(SYS_SENDFILE, fd as u64, socket_id as u64, offset as u64, len as u64)
+}
+
 /// Receive data from a TCP connection.
 /// Returns bytes received, 0=EOF (remote closed), u32::MAX=error/timeout.
 pub fn tcp_recv(socket_id: u32, buf: &mut [u8]) -> u32 {
@@ -153,11 +161,25 @@ pub fn tcp_recv_available(socket_id: u32) -> u32 {
     syscall1(SYS_TCP_RECV_AVAILABLE, socket_id as u64)
 }
 
+/// Bit 31 of `backlog` lets other listeners that set it share the port.
+const TCP_LISTEN_REUSEPORT: u64 = 0x8000_0000;
+
 /// Listen on a TCP port. Returns listener socket_id or u32::MAX.
+///
+/// `backlog` bounds pending connections (0 = kernel default, max 1024).
+/// Calling it again on a port this thread already listens on just updates
+/// the backlog and returns the same listener.
 pub fn tcp_listen(port: u16, backlog: u16) -> u32 {
     syscall2(SYS_TCP_LISTEN, port as u64, backlog as u64)
 }
 
+/// Listen on a TCP port shared with other `tcp_listen_shared` callers
+/// (SO_REUSEPORT-style). The kernel spreads incoming connections across
+/// all listeners on the port. Returns listener socket_id or u32::MAX.
+pub fn tcp_listen_shared(port: u16, backlog: u16) -> u32 {
+    syscall2(SYS_TCP_LISTEN, port as u64, backlog as u64 | TCP_LISTEN_REUSEPORT)
+}
+
 /// Accept a connection from a listening socket. Blocks until a connection
 /// arrives or timeout (30s). Returns (socket_id, remote_ip, remote_port)
 /// or (u32::MAX, [0;4], 0) on error/timeout.
@@ -182,15 +204,25 @@ pub struct TcpConnInfo {
     pub state: u8,
     pub owner_tid: u8,
     pub recv_buf_len: u16,
+    /// Congestion window in bytes.
+    pub cwnd: u32,
+    /// Smoothed round-trip time in ms (0 before the first sample).
+    pub srtt_ms: u32,
+    /// Retransmission timeout in ms.
+    pub rto_ms: u32,
 }
 
+/// Bit 31 of `max_entries` requests the 32-byte extended entry format.
+const TCP_LIST_EXTENDED: u64 = 0x8000_0000;
+
 /// List all active TCP connections/listeners. Returns a Vec of connection info.
 pub fn tcp_list() -> alloc::vec::Vec<TcpConnInfo> {
-    let mut buf = [0u8; 64 * 16]; // max 64 entries * 16 bytes each
-    let count = syscall2(SYS_TCP_LIST, buf.as_mut_ptr() as u64, 64);
+    let mut buf = [0u8; 64 * 32]; // max 64 entries * 32 bytes each
+    let count = syscall2(SYS_TCP_LIST, buf.as_mut_ptr() as u64, 64 | TCP_LIST_EXTENDED);
     let mut result = alloc::vec::Vec::new();
-    for i in 0..count as usize {
-        let off = i * 16;
+    let le32 = |o: usize| u32::from_le_bytes([buf[o], buf[o+1], buf[o+2], buf[o+3]]);
+    for i in 0..(count as usize).min(64) {
+        let off = i * 32;
         result.push(TcpConnInfo {
             local_ip: [buf[off], buf[off+1], buf[off+2], buf[off+3]],
             local_port: u16::from_be_bytes([buf[off+4], buf[off+5]]),
@@ -199,6 +231,9 @@ pub fn tcp_list() -> alloc::vec::Vec<TcpConnInfo> {
             state: buf[off+12],
             owner_tid: buf[off+13],
             recv_buf_len: u16::from_le_bytes([buf[off+14], buf[off+15]]),
+            cwnd: le32(off + 16),
+            srtt_ms: le32(off + 20),
+            rto_ms: le32(off + 24),
         });
     }
     result
@@ -297,12 +332,17 @@ pub struct NetStats {
     pub tcp_resets_sent: u64,
     pub tcp_curr_established: u32,
     pub tcp_conn_errors: u32,
+    // NIC receive passes (one budgeted poll of the RX ring each)
+    pub rx_passes: u64,
+    pub rx_pass_frames: u64,
+    pub rx_pass_max: u64,
+    pub rx_budget_exhausted: u64,
 }
 
 /// Get network protocol statistics.
 pub fn net_stats() -> Option<NetStats> {
-    let mut buf = [0u8; 104];
-    let rc = syscall2(SYS_NET_STATS, buf.as_mut_ptr() as u64, 104);
+    let mut buf = [0u8; 136];
+    let rc = syscall2(SYS_NET_STATS, buf.as_mut_ptr() as u64, 136);
     if rc != 0 { return None; }
     Some(NetStats {
         rx_packets: u64::from_le_bytes(buf[0..8].try_into().unwrap()),
@@ -319,5 +359,9 @@ pub fn net_stats() -> Option<NetStats> {
         tcp_resets_sent: u64::from_le_bytes(buf[88..96].try_into().unwrap()),
         tcp_curr_established: u32::from_le_bytes(buf[96..100].try_into().unwrap()),
         tcp_conn_errors: u32::from_le_bytes(buf[100..104].try_into().unwrap()),
+        rx_passes: u64::from_le_bytes(buf[104..112].try_into().unwrap()),
+        rx_pass_frames: u64::from_le_bytes(buf[112..120].try_into().unwrap()),
+        rx_pass_max: u64::from_le_bytes(buf[120..128].try_into().unwrap()),
+        rx_budget_exhausted: u64::from_le_bytes(buf[128..136].try_into().unwrap()),
     })
 }
@@ -0,0 +1,693 @@
+//! Work-stealing thread pool — `join`, `scope` and parallel slice helpers.
+//!
+//! One pool per process, started on first use with one worker per CPU.
+//! Every worker owns a fixed-size Chase–Lev deque: it pushes and pops work at
+//! the bottom, idle workers steal from the top of the others.  Work submitted
+//! from a thread outside the pool goes through a shared injector queue and
+//! the submitting thread sleeps on a futex until it completes.  Idle workers
+//! sleep on one futex event counter and are woken only when work is pushed
+//! while someone sleeps.
+//!
+//! [`join`] is the primitive: it offers the second closure for stealing,
+//! runs the first, then runs the second itself unless a thief took it.  The
+//! helpers split their range recursively with [`join`], so the load balances
+//! itself.  All libraries in a process share the pool, so nesting them does
+//! not oversubscribe the CPUs.  On a single-CPU system everything runs
+//! inline on the calling thread.
+//!
+//! Panics abort the process, so no closure result needs unwinding support.
+
+use alloc::boxed::Box;
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use core::marker::PhantomData;
+use core::ops::Range;
+use core::sync::atomic::{fence, AtomicIsize, AtomicPtr, AtomicU32, AtomicUsize, Ordering};
+use crate::process::{mmap, thread_create, yield_cpu};
+use crate::sync::{futex_wait, futex_wake, Mutex, FUTEX_FOREVER};
+
+/// Upper bound on pool workers.
+const MAX_WORKERS: usize = 32;
+/// Slots per worker deque (power of two); a full deque runs work inline.
+const DEQUE_SIZE: usize = 256;
+/// Stack size of a worker thread.
+const WORKER_STACK_SIZE: usize = 256 * 1024;
+/// Failed searches before an idle worker sleeps.
+const IDLE_SPINS: u32 = 64;
+/// Slices shorter than this are sorted serially by [`par_sort_unstable_by`].
+const SORT_SERIAL_LEN: usize = 4096;
+
+// =========================================================================
+// Jobs and latches
+// =========================================================================
+
+/// Header at offset 0 of every job; the deques hold pointers to it.
+#[repr(C)]
+struct JobHeader {
+    execute: unsafe fn(*const JobHeader),
+}
+
+unsafe fn execute(job: *const JobHeader) {
+    ((*job).execute)(job)
+}
+
+const LATCH_UNSET: u32 = 0;
+const LATCH_SET: u32 = 1;
+/// Unset, and a thread may be sleeping on the word.
+const LATCH_SLEEPING: u32 = 2;
+
+/// One-shot completion flag, waitable with a futex.
+struct Latch {
+    state: AtomicU32,
+}
+
+impl Latch {
+    const fn new() -> Self {
+        Latch { state: AtomicU32::new(LATCH_UNSET) }
+    }
+
+    fn probe(&self) -> bool {
+        self.state.load(Ordering::Acquire) == LATCH_SET
+    }
+
+    fn set(&self) {
+        // The waiter may return (and free the latch) as soon as the swap is
+        // visible: only the address is used afterwards, and a wake on a
+        // reused or unmapped address is at worst spurious.
+        let word = &self.state as *const AtomicU32;
+        if self.state.swap(LATCH_SET, Ordering::Release) == LATCH_SLEEPING {
+            futex_wake(unsafe { &*word }, u32::MAX);
+        }
+    }
+
+    /// Sleep until set, for at most `timeout_ms`.
+    fn sleep(&self, timeout_ms: u32) {
+        let s = self.state.load(Ordering::Acquire);
+        if s == LATCH_SET {
+            return;
+        }
+        if s == LATCH_UNSET
+            && self.state.compare_exchange(LATCH_UNSET, LATCH_SLEEPING, Ordering::Acquire, Ordering::Acquire).is_err()
+        {
+            return;
+        }
+        futex_wait(&self.state, LATCH_SLEEPING, timeout_ms);
+    }
+
+    /// Block a thread outside the pool until set.
+    fn wait_blocking(&self) {
+        while !self.probe() {
+            self.sleep(FUTEX_FOREVER);
+        }
+    }
+}
+
+/// A job living on the stack of the thread that waits for it.
+#[repr(C)]
+struct StackJob<F, R> {
+    header: JobHeader,
+    latch: Latch,
+    func: UnsafeCell<Option<F>>,
+    result: UnsafeCell<Option<R>>,
+}
+
+impl<F: FnOnce() -> R, R> StackJob<F, R> {
+    fn new(func: F) -> Self {
+        StackJob {
+            header: JobHeader { execute: Self::execute },
+            latch: Latch::new(),
+            func: UnsafeCell::new(Some(func)),
+            result: UnsafeCell::new(None),
+        }
+    }
+
+    fn as_job(&self) -> *const JobHeader {
+        &self.header
+    }
+
+    unsafe fn execute(job: *const JobHeader) {
+        let this = &*(job as *const Self);
+        let func = (*this.func.get()).take().unwrap();
+        *this.result.get() = Some(func());
+        this.latch.set();
+    }
+
+    /// Run the closure on the owning thread (it was never stolen).
+    fn run_inline(self) -> R {
+        (self.func.into_inner().unwrap())()
+    }
+
+    fn into_result(self) -> R {
+        self.result.into_inner().unwrap()
+    }
+}
+
+/// A heap-allocated fire-and-forget job (used by [`Scope::spawn`]).
+#[repr(C)]
+struct HeapJob<F> {
+    header: JobHeader,
+    func: F,
+}
+
+impl<F: FnOnce()> HeapJob<F> {
+    fn into_job(func: F) -> *const JobHeader {
+        let job = Box::new(HeapJob { header: JobHeader { execute: Self::execute }, func });
+        Box::into_raw(job) as *const JobHeader
+    }
+
+    unsafe fn execute(job: *const JobHeader) {
+        let this = Box::from_raw(job as *mut Self);
+        (this.func)();
+    }
+}
+
+// =========================================================================
+// Chase–Lev deque
+// =========================================================================
+
+/// Fixed-capacity work-stealing deque: the owner pushes and pops at
+/// `bottom`, thieves take from `top`.
+struct Deque {
+    top: AtomicIsize,
+    bottom: AtomicIsize,
+    slots: [AtomicPtr<JobHeader>; DEQUE_SIZE],
+}
+
+impl Deque {
+    fn new() -> Self {
+        Deque {
+            top: AtomicIsize::new(0),
+            bottom: AtomicIsize::new(0),
+            slots: [const { AtomicPtr::new(core::ptr::null_mut()) }; DEQUE_SIZE],
+        }
+    }
+
+    fn slot(&self, i: isize) -> &AtomicPtr<JobHeader> {
+        &self.slots[i as usize & (DEQUE_SIZE - 1)]
+    }
+
+    /// Owner only. Returns `false` if the deque is full.
+    fn push(&self, job: *const JobHeader) -> bool {
+        let b = self.bottom.load(Ordering::Relaxed);
+        let t = self.top.load(Ordering::Acquire);
+        if b - t >= DEQUE_SIZE as isize {
+            return false;
+        }
+        self.slot(b).store(job as *mut JobHeader, Ordering::Relaxed);
+        self.bottom.store(b + 1, Ordering::Release);
+        true
+    }
+
+    /// Owner only: take the most recently pushed job.
+    fn pop(&self) -> Option<*const JobHeader> {
+        let b = self.bottom.load(Ordering::Relaxed) - 1;
+        self.bottom.store(b, Ordering::Relaxed);
+        fence(Ordering::SeqCst);
+        let t = self.top.load(Ordering::Relaxed);
+        if t > b {
+            self.bottom.store(b + 1, Ordering::Relaxed);
+            return None;
+        }
+        let job = self.slot(b).load(Ordering::Relaxed);
+        if t == b {
+            // Last job: race the thieves for it.
+            let won = self.top.compare_exchange(t, t + 1, Ordering::SeqCst, Ordering::Relaxed).is_ok();
+            self.bottom.store(b + 1, Ordering::Relaxed);
+            if !won {
+                return None;
+            }
+        }
+        Some(job)
+    }
+
+    /// Any thread: take the oldest job.
+    fn steal(&self) -> Option<*const JobHeader> {
+        loop {
+            let t = self.top.load(Ordering::Acquire);
+            fence(Ordering::SeqCst);
+            let b = self.bottom.load(Ordering::Acquire);
+            if t >= b {
+                return None;
+            }
+            let job = self.slot(t).load(Ordering::Relaxed);
+            if self.top.compare_exchange(t, t + 1, Ordering::SeqCst, Ordering::Relaxed).is_ok() {
+                return Some(job);
+            }
+        }
+    }
+}
+
+// =========================================================================
+// Registry
+// =========================================================================
+
+struct Worker {
+    deque: Deque,
+    /// Stack range, used to recognise the current thread as this worker.
+    stack_lo: usize,
+    stack_hi: usize,
+}
+
+struct JobPtr(*const JobHeader);
+unsafe impl Send for JobPtr {}
+
+struct Registry {
+    workers: Vec<Worker>,
+    injector: Mutex<VecDeque<JobPtr>>,
+    injected: AtomicUsize,
+    /// Bumped on every push; idle workers futex-wait on it.
+    events: AtomicU32,
+    sleepers: AtomicU32,
+}
+
+const POOL_UNINIT: u32 = 0;
+const POOL_STARTING: u32 = 1;
+const POOL_READY: u32 = 2;
+
+static POOL_STATE: AtomicU32 = AtomicU32::new(POOL_UNINIT);
+/// Null when the pool has no workers (everything runs inline).
+static REGISTRY: AtomicPtr<Registry> = AtomicPtr::new(core::ptr::null_mut());
+static WORKERS_STARTED: AtomicU32 = AtomicU32::new(0);
+
+fn registry() -> Option<&'static Registry> {
+    if POOL_STATE.load(Ordering::Acquire) != POOL_READY {
+        start_pool();
+    }
+    unsafe { REGISTRY.load(Ordering::Acquire).as_ref() }
+}
+
+#[cold]
+fn start_pool() {
+    if POOL_STATE.compare_exchange(POOL_UNINIT, POOL_STARTING, Ordering::Acquire, Ordering::Acquire).is_err() {
+        while POOL_STATE.load(Ordering::Acquire) != POOL_READY {
+            yield_cpu();
+        }
+        return;
+    }
+    let cpus = crate::sys::sysinfo(2, &mut [0u8; 4]) as usize;
+    let n = cpus.min(MAX_WORKERS);
+    if n > 1 {
+        let mut workers = Vec::with_capacity(n);
+        for _ in 0..n {
+            let stack = mmap(WORKER_STACK_SIZE) as usize;
+            let stack_hi = if stack == 0 { 0 } else { stack + WORKER_STACK_SIZE };
+            workers.push(Worker { deque: Deque::new(), stack_lo: stack, stack_hi });
+        }
+        let reg: &'static Registry = Box::leak(Box::new(Registry {
+            workers,
+            injector: Mutex::new(VecDeque::new()),
+            injected: AtomicUsize::new(0),
+            events: AtomicU32::new(0),
+            sleepers: AtomicU32::new(0),
+        }));
+        REGISTRY.store(reg as *const Registry as *mut Registry, Ordering::Release);
+        let mut started = 0;
+        for w in &reg.workers {
+            // x86_64 ABI: RSP must be STACK_TOP - 8 at function entry
+            if w.stack_lo != 0 && thread_create(worker_main, w.stack_hi - 8, "pool") != 0 {
+                started += 1;
+            }
+        }
+        WORKERS_STARTED.store(started, Ordering::Relaxed);
+        if started == 0 {
+            // Nobody would run injected work; fall back to inline execution.
+            REGISTRY.store(core::ptr::null_mut(), Ordering::Release);
+        }
+    }
+    POOL_STATE.store(POOL_READY, Ordering::Release);
+}
+
+/// Forget the parent's pool in a freshly forked child: its workers were not
+/// duplicated.  The child starts its own pool on first use.
+pub(crate) fn reset_after_fork() {
+    REGISTRY.store(core::ptr::null_mut(), Ordering::Relaxed);
+    WORKERS_STARTED.store(0, Ordering::Relaxed);
+    POOL_STATE.store(POOL_UNINIT, Ordering::Release);
+}
+
+impl Registry {
+    /// Index of the worker running on the calling thread, if any.
+    fn current(&self) -> Option<usize> {
+        let marker = 0u8;
+        let sp = &marker as *const u8 as usize;
+        self.workers.iter().position(|w| sp >= w.stack_lo && sp < w.stack_hi)
+    }
+
+    fn notify(&self) {
+        self.events.fetch_add(1, Ordering::SeqCst);
+        if self.sleepers.load(Ordering::SeqCst) != 0 {
+            futex_wake(&self.events, 1);
+        }
+    }
+
+    /// Queue a job from any thread.
+    fn submit(&self, job: *const JobHeader) {
+        let pushed = match self.current() {
+            Some(i) => self.workers[i].deque.push(job),
+            None => false,
+        };
+        if !pushed {
+            self.injector.lock().push_back(JobPtr(job));
+            self.injected.fetch_add(1, Ordering::Release);
+        }
+        self.notify();
+    }
+
+    fn find_work(&self, me: usize) -> Option<*const JobHeader> {
+        if let Some(job) = self.workers[me].deque.pop() {
+            return Some(job);
+        }
+        let n = self.workers.len();
+        for k in 1..n {
+            if let Some(job) = self.workers[(me + k) % n].deque.steal() {
+                return Some(job);
+            }
+        }
+        if self.injected.load(Ordering::Acquire) != 0 {
+            if let Some(JobPtr(job)) = self.injector.lock().pop_front() {
+                self.injected.fetch_sub(1, Ordering::Relaxed);
+                return Some(job);
+            }
+        }
+        None
+    }
+
+    /// Run other work on worker `me` until `latch` is set.
+    fn wait_until(&self, me: usize, latch: &Latch) {
+        let mut idle = 0;
+        while !latch.probe() {
+            if let Some(job) = self.find_work(me) {
+                unsafe { execute(job); }
+                idle = 0;
+            } else if idle < IDLE_SPINS {
+                idle += 1;
+                core::hint::spin_loop();
+            } else {
+                // Re-check for stealable work every tick while the thief runs.
+                latch.sleep(1);
+            }
+        }
+    }
+
+    /// Run `f` on a worker from a thread outside the pool and wait for it.
+    fn run_external<F, R>(&'static self, f: F) -> R
+    where
+        F: FnOnce(usize) -> R + Send,
+        R: Send,
+    {
+        let job = StackJob::new(move || f(self.current().unwrap()));
+        self.submit(job.as_job());
+        job.latch.wait_blocking();
+        job.into_result()
+    }
+}
+
+fn worker_main() {
+    let reg = unsafe { &*REGISTRY.load(Ordering::Acquire) };
+    let me = match reg.current() {
+        Some(i) => i,
+        None => return,
+    };
+    let mut idle = 0;
+    loop {
+        if let Some(job) = reg.find_work(me) {
+            unsafe { execute(job); }
+            idle = 0;
+            continue;
+        }
+        if idle < IDLE_SPINS {
+            idle += 1;
+            core::hint::spin_loop();
+            continue;
+        }
+        let seq = reg.events.load(Ordering::SeqCst);
+        reg.sleepers.fetch_add(1, Ordering::SeqCst);
+        match reg.find_work(me) {
+            Some(job) => {
+                reg.sleepers.fetch_sub(1, Ordering::SeqCst);
+                unsafe { execute(job); }
+                idle = 0;
+            }
+            None => {
+                futex_wait(&reg.events, seq, FUTEX_FOREVER);
+                reg.sleepers.fetch_sub(1, Ordering::SeqCst);
+            }
+        }
+    }
+}
+
+// =========================================================================
+// Public API
+// =========================================================================
+
+/// Number of threads work is spread over (1 = everything runs inline).
+pub fn current_num_threads() -> usize {
+    match registry() {
+        Some(_) => WORKERS_STARTED.load(Ordering::Relaxed) as usize,
+        None => 1,
+    }
+}
+
+/// Run `a` and `b`, potentially in parallel, and return both results.
+pub fn join<A, B, RA, RB>(a: A, b: B) -> (RA, RB)
+where
+    A: FnOnce() -> RA + Send,
+    B: FnOnce() -> RB + Send,
+    RA: Send,
+    RB: Send,
+{
+    let reg = match registry() {
+        Some(r) => r,
+        None => return (a(), b()),
+    };
+    match reg.current() {
+        Some(me) => join_on(reg, me, a, b),
+        None => reg.run_external(move |me| join_on(reg, me, a, b)),
+    }
+}
+
+fn join_on<A, B, RA, RB>(reg: &Registry, me: usize, a: A, b: B) -> (RA, RB)
+where
+    A: FnOnce() -> RA,
+    B: FnOnce() -> RB,
+{
+    let job_b = StackJob::new(b);
+    let deque = &reg.workers[me].deque;
+    if !deque.push(job_b.as_job()) {
+        let ra = a();
+        return (ra, job_b.run_inline());
+    }
+    reg.notify();
+    let ra = a();
+    while !job_b.latch.probe() {
+        match deque.pop() {
+            Some(job) if job == job_b.as_job() => return (ra, job_b.run_inline()),
+            // Left behind by a scope spawned inside `a`.
+            Some(job) => unsafe { execute(job) },
+            None => {
+                reg.wait_until(me, &job_b.latch);
+                break;
+            }
+        }
+    }
+    (ra, job_b.into_result())
+}
+
+/// Counts a scope's outstanding spawns (plus one for the scope body).
+struct CountLatch {
+    count: AtomicUsize,
+    latch: Latch,
+}
+
+impl CountLatch {
+    fn increment(&self) {
+        self.count.fetch_add(1, Ordering::Relaxed);
+    }
+
+    fn decrement(&self) {
+        if self.count.fetch_sub(1, Ordering::AcqRel) == 1 {
+            self.latch.set();
+        }
+    }
+}
+
+/// A scope in which closures borrowing from the enclosing stack frame can be
+/// spawned; [`scope`] returns only after all of them have finished.
+pub struct Scope<'s> {
+    pending: CountLatch,
+    registry: Option<&'static Registry>,
+    marker: PhantomData<&'s mut &'s ()>,
+}
+
+unsafe impl Sync for Scope<'_> {}
+
+struct ScopePtr<'s>(*const Scope<'s>);
+unsafe impl Send for ScopePtr<'_> {}
+
+impl<'s> Scope<'s> {
+    /// Queue `f` to run on the pool before the scope ends.
+    pub fn spawn<F>(&self, f: F)
+    where
+        F: FnOnce(&Scope<'s>) + Send + 's,
+    {
+        let reg = match self.registry {
+            Some(r) => r,
+            None => return f(self),
+        };
+        self.pending.increment();
+        let scope = ScopePtr(self);
+        let job = HeapJob::into_job(move || {
+            let scope = unsafe { &*scope.0 };
+            f(scope);
+            scope.pending.decrement();
+        });
+        reg.submit(job);
+    }
+}
+
+/// Create a [`Scope`], run `f` in it, and wait for everything spawned into it.
+pub fn scope<'s, F, R>(f: F) -> R
+where
+    F: FnOnce(&Scope<'s>) -> R + Send,
+    R: Send,
+{
+    let reg = registry();
+    let body = move |me: Option<usize>| {
+        let s = Scope {
+            pending: CountLatch { count: AtomicUsize::new(1), latch: Latch::new() },
+            registry: reg,
+            marker: PhantomData,
+        };
+        let r = f(&s);
+        s.pending.decrement();
+        if let (Some(reg), Some(me)) = (reg, me) {
+            reg.wait_until(me, &s.pending.latch);
+        }
+        r
+    };
+    match reg {
+        None => body(None),
+        Some(reg) => match reg.current() {
+            Some(me) => body(Some(me)),
+            None => reg.run_external(move |me| body(Some(me))),
+        },
+    }
+}
+
+/// A good split granularity for `len` items over the pool.
+fn default_grain(len: usize) -> usize {
+    (len / (current_num_threads() * 8)).max(1)
+}
+
+/// Call `f(i)` for every `i` in `range`, in parallel.  Ranges of at most
+/// `grain` indices run serially (0 = pick automatically).
+pub fn par_for<F>(range: Range<usize>, grain: usize, f: F)
+where
+    F: Fn(usize) + Sync,
+{
+    let grain = if grain == 0 { default_grain(range.len()) } else { grain };
+    par_for_split(range.start, range.end, grain, &f);
+}
+
+fn par_for_split<F: Fn(usize) + Sync>(lo: usize, hi: usize, grain: usize, f: &F) {
+    if hi - lo <= grain {
+        for i in lo..hi {
+            f(i);
+        }
+        return;
+    }
+    let mid = lo + (hi - lo) / 2;
+    join(|| par_for_split(lo, mid, grain, f), || par_for_split(mid, hi, grain, f));
+}
+
+/// Call `f(chunk_index, chunk)` for each `chunk_size`-element chunk of
+/// `data` (the last may be shorter), in parallel.
+pub fn par_chunks<T, F>(data: &[T], chunk_size: usize, f: F)
+where
+    T: Sync,
+    F: Fn(usize, &[T]) + Sync,
+{
+    let chunk_size = chunk_size.max(1);
+    let chunks = data.len().div_ceil(chunk_size);
+    par_for(0..chunks, 1, |i| {
+        let lo = i * chunk_size;
+        f(i, &data[lo..(lo + chunk_size).min(data.len())]);
+    });
+}
+
+/// Mutable counterpart of [`par_chunks`].
+pub fn par_chunks_mut<T, F>(data: &mut [T], chunk_size: usize, f: F)
+where
+    T: Send,
+    F: Fn(usize, &mut [T]) + Sync,
+{
+    par_chunks_mut_split(data, chunk_size.max(1), 0, &f);
+}
+
+fn par_chunks_mut_split<T: Send, F: Fn(usize, &mut [T]) + Sync>(data: &mut [T], chunk_size: usize, first: usize, f: &F) {
+    let chunks = data.len().div_ceil(chunk_size);
+    if chunks <= 1 {
+        if !data.is_empty() {
+            f(first, data);
+        }
+        return;
+    }
+    let half = chunks / 2;
+    let (left, right) = data.split_at_mut(half * chunk_size);
+    join(
+        || par_chunks_mut_split(left, chunk_size, first, f),
+        || par_chunks_mut_split(right, chunk_size, first + half, f),
+    );
+}
+
+/// Map every index of `range` with `map` and combine the results with
+/// `reduce` (which must be associative), in parallel.
+pub fn par_map_reduce<T, M, R>(range: Range<usize>, grain: usize, identity: T, map: M, reduce: R) -> T
+where
+    T: Send + Clone,
+    M: Fn(usize) -> T + Sync,
+    R: Fn(T, T) -> T + Sync,
+{
+    let grain = if grain == 0 { default_grain(range.len()) } else { grain };
+    map_reduce_split(range.start, range.end, grain, identity, &map, &reduce)
+}
+
+fn map_reduce_split<T, M, R>(lo: usize, hi: usize, grain: usize, identity: T, map: &M, reduce: &R) -> T
+where
+    T: Send + Clone,
+    M: Fn(usize) -> T + Sync,
+    R: Fn(T, T) -> T + Sync,
+{
+    if hi - lo <= grain {
+        return (lo..hi).fold(identity, |acc, i| reduce(acc, map(i)));
+    }
+    let mid = lo + (hi - lo) / 2;
+    let identity_b = identity.clone();
+    let (a, b) = join(
+        move || map_reduce_split(lo, mid, grain, identity, map, reduce),
+        move || map_reduce_split(mid, hi, grain, identity_b, map, reduce),
+    );
+    reduce(a, b)
+}
+
+/// Parallel unstable sort: partitions around the median and sorts both
+/// halves with [`join`].
+pub fn par_sort_unstable_by<T, F>(data: &mut [T], compare: F)
+where
+    T: Send,
+    F: Fn(&T, &T) -> core::cmp::Ordering + Sync,
+{
+    sort_split(data, &compare);
+}
+
+fn sort_split<T: Send, F: Fn(&T, &T) -> core::cmp::Ordering + Sync>(data: &mut [T], compare: &F) {
+    if data.len() <= SORT_SERIAL_LEN {
+        data.sort_unstable_by(compare);
+        return;
+    }
+    let mid = data.len() / 2;
+    data.select_nth_unstable_by(mid, compare);
+    let (left, right) = data.split_at_mut(mid);
+    join(|| sort_split(left, compare), || sort_split(&mut right[1..], compare));
+}
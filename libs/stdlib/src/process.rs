@@ -35,6 +35,12 @@ pub fn sleep(ms: u32) {
     syscall1(SYS_SLEEP, ms as u64);
 }
 
+/// Sleep for `ns` nanoseconds. Not rounded to the 1 ms scheduler tick, so it
+/// suits audio and frame pacing.
+pub fn sleep_ns(ns: u64) {
+    syscall2(SYS_SLEEP_NS, ns & 0xFFFF_FFFF, ns >> 32);
+}
+
 pub fn sbrk(increment: i32) -> usize {
     syscall1(SYS_SBRK, increment as i64 as u64) as usize
 }
@@ -60,6 +66,30 @@ pub fn munmap(addr: *mut u8, size: usize) -> bool {
     syscall2(SYS_MUNMAP, addr as u64, size as u64) == 0
 }
 
+/// `mmap_file` protection bit: pages may be written.
+pub const PROT_WRITE: u32 = 2;
+/// `mmap_file` protection bit: pages may be executed.
+pub const PROT_EXEC: u32 = 4;
+/// `mmap_file` flag: writes go back to the file (on `munmap` / exit).
+pub const MAP_SHARED: u32 = 1;
+/// `mmap_file` flag: writes stay private to this process.
+pub const MAP_PRIVATE: u32 = 2;
+
+/// Map `len` bytes of the open file `fd`, starting at the page-aligned
+/// `offset`, into the process address space.  Pages are read from the page
+/// cache on first access, so large files are never copied up front.
+/// `prot` is a combination of `PROT_WRITE` / `PROT_EXEC` (reading is always
+/// allowed); `flags` is `MAP_SHARED` or `MAP_PRIVATE`.
+/// Returns a pointer to the mapping, or null on failure.  Free it with `munmap`.
+pub fn mmap_file(fd: u32, offset: u32, len: usize, prot: u32, flags: u32) -> *mut u8 {
+    let result = syscall5(SYS_MMAP_FILE, fd as u64, offset as u64, len as u64, prot as u64, flags as u64);
+    if result == u32::MAX {
+        core::ptr::null_mut()
+    } else {
+        result as *mut u8
+    }
+}
+
 pub fn waitpid(tid: u32) -> u32 {
     // Must use syscall3 to explicitly pass child_tid_ptr=0, options=0.
     // syscall1 leaves RDX (options) unset — if bit 0 is set by leftover
@@ -101,7 +131,12 @@ pub fn reboot() -> ! {
 /// - In the child: 0
 /// - On error: u32::MAX
 pub fn fork() -> u32 {
-    syscall0(SYS_FORK)
+    let ret = syscall0(SYS_FORK);
+    if ret == 0 {
+        crate::pool::reset_after_fork();
+        crate::log::reset_after_fork();
+    }
+    ret
 }
 
 /// Replace the current process with a new program.
@@ -34,6 +34,7 @@ pub(crate) const SYS_EXEC: u32 = 11;
 pub(crate) const SYS_WAITPID: u32 = 12;
 pub(crate) const SYS_MMAP: u32 = 14;
 pub(crate) const SYS_MUNMAP: u32 = 15;
+pub(crate) const SYS_MMAP_FILE: u32 = 36;
 pub(crate) const SYS_KILL: u32 = 13;
 pub(crate) const SYS_SPAWN: u32 = 27;
 pub(crate) const SYS_GETARGS: u32 = 28;
@@ -61,6 +62,11 @@ pub(crate) const SYS_DMESG: u32 = 33;
 pub(crate) const SYS_TICK_HZ: u32 = 34;
 pub(crate) const SYS_UPTIME_MS: u32 = 35;
 
+// Readiness wait sets
+pub(crate) const SYS_POLL_CREATE: u32 = 37;
+pub(crate) const SYS_POLL_CTL: u32 = 38;
+pub(crate) const SYS_POLL_WAIT: u32 = 39;
+
 // Networking
 pub(crate) const SYS_NET_CONFIG: u32 = 40;
 pub(crate) const SYS_NET_PING: u32 = 41;
@@ -109,6 +115,9 @@ pub(crate) const SYS_CHDIR: u32 = 26;
 pub(crate) const SYS_LSEEK: u32 = 105;
 pub(crate) const SYS_FSTAT: u32 = 106;
 pub(crate) const SYS_ISATTY: u32 = 108;
+pub(crate) const SYS_FSYNC: u32 = 109;
+pub(crate) const SYS_FLOCK: u32 = 113;
+pub(crate) const SYS_GETDENTS: u32 = 114;
 
 // TCP networking
 pub(crate) const SYS_TCP_CONNECT: u32 = 100;
@@ -119,6 +128,7 @@ pub(crate) const SYS_TCP_STATUS: u32 = 104;
 pub(crate) const SYS_TCP_LISTEN: u32 = 132;
 pub(crate) const SYS_TCP_ACCEPT: u32 = 133;
 pub(crate) const SYS_TCP_LIST: u32 = 134;
+pub(crate) const SYS_SENDFILE: u32 = 136;
 pub(crate) const SYS_TCP_RECV_AVAILABLE: u32 = 130;
 
 // Display / GPU / wallpaper
@@ -133,6 +143,8 @@ pub(crate) const SYS_SHM_CREATE: u32 = 140;
 pub(crate) const SYS_SHM_MAP: u32 = 141;
 pub(crate) const SYS_SHM_UNMAP: u32 = 142;
 pub(crate) const SYS_SHM_DESTROY: u32 = 143;
+pub(crate) const SYS_SHM_GRANT: u32 = 74;
+pub(crate) const SYS_SHM_CLAIM: u32 = 75;
 
 // Compositor-privileged
 pub(crate) const SYS_MAP_FRAMEBUFFER: u32 = 144;
@@ -148,6 +160,9 @@ pub(crate) const SYS_CAPTURE_SCREEN: u32 = 161;
 pub(crate) const SYS_THREAD_CREATE: u32 = 170;
 pub(crate) const SYS_SET_PRIORITY: u32 = 171;
 pub(crate) const SYS_SET_CRITICAL: u32 = 172;
+pub(crate) const SYS_FUTEX_WAIT: u32 = 173;
+pub(crate) const SYS_FUTEX_WAKE: u32 = 174;
+pub(crate) const SYS_SLEEP_NS: u32 = 175;
 
 // Device / Pipe listing
 pub(crate) const SYS_DEVLIST: u32 = 16;
@@ -240,10 +255,30 @@ pub(crate) const SYS_DEBUG_SINGLE_STEP: u32    = 310;
 pub(crate) const SYS_DEBUG_GET_MEM_MAP: u32    = 311;
 pub(crate) const SYS_DEBUG_WAIT_EVENT: u32     = 312;
 pub(crate) const SYS_THREAD_INFO_EX: u32       = 313;
+pub(crate) const SYS_LOCK_STATS: u32           = 314;
+pub(crate) const SYS_SYSCALL_STATS: u32        = 315;
+pub(crate) const SYS_PROF_START: u32           = 316;
+pub(crate) const SYS_PROF_STOP: u32            = 317;
+pub(crate) const SYS_GPU_WAIT_VBLANK: u32      = 318;
+pub(crate) const SYS_GPU_RING_SETUP: u32       = 319;
+pub(crate) const SYS_GPU_RING_DOORBELL: u32    = 320;
+pub(crate) const SYS_GPU_FENCE_WAIT: u32       = 321;
+pub(crate) const SYS_HEAP_REPORT: u32          = 322;
+pub(crate) const SYS_THREAD_SNAPSHOT: u32      = 323;
+pub(crate) const SYS_IRQ_STATS: u32            = 324;
+pub(crate) const SYS_IRQ_AFFINITY: u32         = 325;
+pub(crate) const SYS_TRACE_CTL: u32            = 326;
+pub(crate) const SYS_TRACE_READ: u32           = 327;
 
 // Anonymous-pipe / fcntl
 pub(crate) const SYS_PIPE_BYTES_AVAILABLE: u32 = 157;
+pub(crate) const SYS_PIPE2: u32 = 240;
 pub(crate) const SYS_FCNTL_SC: u32 = 243;
+pub(crate) const SYS_SPLICE: u32 = 248;
+
+// Asynchronous I/O rings
+pub(crate) const SYS_IO_RING_SETUP: u32 = 261;
+pub(crate) const SYS_IO_RING_ENTER: u32 = 262;
 
 // Event bus
 pub(crate) const SYS_EVT_SYS_SUBSCRIBE: u32 = 60;
@@ -257,6 +292,8 @@ pub(crate) const SYS_EVT_CHAN_UNSUBSCRIBE: u32 = 67;
 pub(crate) const SYS_EVT_CHAN_DESTROY: u32 = 68;
 pub(crate) const SYS_EVT_CHAN_EMIT_TO: u32 = 69;
 pub(crate) const SYS_EVT_CHAN_WAIT: u32 = 70;
+pub(crate) const SYS_EVT_CHAN_POLL_BATCH: u32 = 71;
+pub(crate) const SYS_EVT_CHAN_RING: u32 = 73;
 
 // =========================================================================
 // Raw syscall helpers (x86-64 SYSCALL instruction)
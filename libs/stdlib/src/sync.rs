@@ -0,0 +1,437 @@
+//! Futex-backed synchronization primitives — Mutex, Condvar, RwLock, Once.
+//!
+//! Every primitive keeps its whole state in one `AtomicU32`.  The uncontended
+//! paths are a single atomic operation and never enter the kernel; only a
+//! thread that actually has to sleep calls `SYS_FUTEX_WAIT`, and an unlock
+//! calls `SYS_FUTEX_WAKE` only when the state records a sleeper.
+//!
+//! Futexes are keyed by physical address, so a primitive placed in a shared
+//! memory region also synchronizes threads of different processes.
+
+use core::cell::UnsafeCell;
+use core::ops::{Deref, DerefMut};
+use core::sync::atomic::{AtomicU32, Ordering};
+use crate::raw::*;
+
+/// `futex_wait` result: woken by [`futex_wake`] (or spuriously).
+pub const FUTEX_WOKEN: u32 = 0;
+/// `futex_wait` result: the word did not hold the expected value.
+pub const FUTEX_EAGAIN: u32 = u32::MAX - 10;
+/// `futex_wait` result: the timeout expired.
+pub const FUTEX_ETIMEDOUT: u32 = u32::MAX - 109;
+/// Timeout value meaning "wait forever".
+pub const FUTEX_FOREVER: u32 = u32::MAX;
+
+/// Sleep while `word` holds `expected`, for at most `timeout_ms`
+/// ([`FUTEX_FOREVER`] = no limit).
+///
+/// Returns [`FUTEX_WOKEN`], [`FUTEX_EAGAIN`], [`FUTEX_ETIMEDOUT`], or
+/// `u32::MAX` for an invalid address.  Wake-ups may be spurious: always
+/// re-check the condition.
+pub fn futex_wait(word: &AtomicU32, expected: u32, timeout_ms: u32) -> u32 {
+    syscall3(SYS_FUTEX_WAIT, word.as_ptr() as u64, expected as u64, timeout_ms as u64)
+}
+
+/// Wake up to `count` threads sleeping on `word`. Returns the number woken.
+pub fn futex_wake(word: &AtomicU32, count: u32) -> u32 {
+    syscall2(SYS_FUTEX_WAKE, word.as_ptr() as u64, count as u64)
+}
+
+/// Spin iterations before a contended lock falls back to sleeping.
+const SPIN_LIMIT: u32 = 100;
+
+// =========================================================================
+// Mutex
+// =========================================================================
+
+const UNLOCKED: u32 = 0;
+const LOCKED: u32 = 1;
+/// Locked, and at least one thread may be sleeping on the word.
+const CONTENDED: u32 = 2;
+
+/// A mutual-exclusion lock protecting a `T`.
+pub struct Mutex<T: ?Sized> {
+    state: AtomicU32,
+    data: UnsafeCell<T>,
+}
+
+unsafe impl<T: ?Sized + Send> Send for Mutex<T> {}
+unsafe impl<T: ?Sized + Send> Sync for Mutex<T> {}
+
+/// RAII guard returned by [`Mutex::lock`]; unlocks on drop.
+pub struct MutexGuard<'a, T: ?Sized> {
+    mutex: &'a Mutex<T>,
+}
+
+impl<T> Mutex<T> {
+    pub const fn new(value: T) -> Self {
+        Mutex { state: AtomicU32::new(UNLOCKED), data: UnsafeCell::new(value) }
+    }
+
+    pub fn into_inner(self) -> T {
+        self.data.into_inner()
+    }
+}
+
+impl<T: ?Sized> Mutex<T> {
+    /// Acquire the lock, sleeping in the kernel only if it is contended.
+    pub fn lock(&self) -> MutexGuard<'_, T> {
+        if self.state.compare_exchange(UNLOCKED, LOCKED, Ordering::Acquire, Ordering::Relaxed).is_err() {
+            self.lock_contended();
+        }
+        MutexGuard { mutex: self }
+    }
+
+    /// Acquire the lock only if it is free right now.
+    pub fn try_lock(&self) -> Option<MutexGuard<'_, T>> {
+        self.state
+            .compare_exchange(UNLOCKED, LOCKED, Ordering::Acquire, Ordering::Relaxed)
+            .ok()
+            .map(|_| MutexGuard { mutex: self })
+    }
+
+    /// Mutable access without locking (the borrow proves exclusivity).
+    pub fn get_mut(&mut self) -> &mut T {
+        self.data.get_mut()
+    }
+
+    #[cold]
+    fn lock_contended(&self) {
+        let mut spins = 0;
+        while spins < SPIN_LIMIT {
+            let s = self.state.load(Ordering::Relaxed);
+            if s == UNLOCKED
+                && self.state.compare_exchange_weak(UNLOCKED, LOCKED, Ordering::Acquire, Ordering::Relaxed).is_ok()
+            {
+                return;
+            }
+            if s == CONTENDED {
+                break; // Others are already sleeping; don't burn the CPU.
+            }
+            core::hint::spin_loop();
+            spins += 1;
+        }
+        // Marking the word CONTENDED before sleeping makes the holder's unlock
+        // issue a wake.  We may be the only waiter; one spurious wake is cheap.
+        while self.state.swap(CONTENDED, Ordering::Acquire) != UNLOCKED {
+            futex_wait(&self.state, CONTENDED, FUTEX_FOREVER);
+        }
+    }
+
+    fn unlock(&self) {
+        if self.state.swap(UNLOCKED, Ordering::Release) == CONTENDED {
+            futex_wake(&self.state, 1);
+        }
+    }
+}
+
+impl<T: Default> Default for Mutex<T> {
+    fn default() -> Self {
+        Mutex::new(T::default())
+    }
+}
+
+impl<T: ?Sized> Deref for MutexGuard<'_, T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        unsafe { &*self.mutex.data.get() }
+    }
+}
+
+impl<T: ?Sized> DerefMut for MutexGuard<'_, T> {
+    fn deref_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.mutex.data.get() }
+    }
+}
+
+impl<T: ?Sized> Drop for MutexGuard<'_, T> {
+    fn drop(&mut self) {
+        self.mutex.unlock();
+    }
+}
+
+// =========================================================================
+// Condvar
+// =========================================================================
+
+/// A condition variable used together with a [`Mutex`].
+///
+/// The word is a sequence number bumped by every notify; a waiter sleeps on
+/// the value it saw before releasing the mutex, so a notify that lands in
+/// between makes its `futex_wait` return immediately.
+pub struct Condvar {
+    seq: AtomicU32,
+}
+
+impl Condvar {
+    pub const fn new() -> Self {
+        Condvar { seq: AtomicU32::new(0) }
+    }
+
+    /// Release `guard`'s mutex, sleep until notified, and re-acquire it.
+    /// Wake-ups may be spurious: wait in a loop on the actual condition.
+    pub fn wait<'a, T: ?Sized>(&self, guard: MutexGuard<'a, T>) -> MutexGuard<'a, T> {
+        self.wait_timeout(guard, FUTEX_FOREVER).0
+    }
+
+    /// Like [`wait`](Self::wait) with a timeout in milliseconds.
+    /// The returned flag is `true` if the wait timed out.
+    pub fn wait_timeout<'a, T: ?Sized>(
+        &self,
+        guard: MutexGuard<'a, T>,
+        timeout_ms: u32,
+    ) -> (MutexGuard<'a, T>, bool) {
+        let mutex = guard.mutex;
+        let seq = self.seq.load(Ordering::Relaxed);
+        drop(guard);
+        let r = futex_wait(&self.seq, seq, timeout_ms);
+        // Other waiters may have been woken with us and now queue on the
+        // mutex, so take it in the contended state to keep wakes flowing.
+        while mutex.state.swap(CONTENDED, Ordering::Acquire) != UNLOCKED {
+            futex_wait(&mutex.state, CONTENDED, FUTEX_FOREVER);
+        }
+        (MutexGuard { mutex }, r == FUTEX_ETIMEDOUT)
+    }
+
+    /// Wake one waiting thread.
+    pub fn notify_one(&self) {
+        self.seq.fetch_add(1, Ordering::Release);
+        futex_wake(&self.seq, 1);
+    }
+
+    /// Wake all waiting threads.
+    pub fn notify_all(&self) {
+        self.seq.fetch_add(1, Ordering::Release);
+        futex_wake(&self.seq, u32::MAX);
+    }
+}
+
+impl Default for Condvar {
+    fn default() -> Self {
+        Condvar::new()
+    }
+}
+
+// =========================================================================
+// RwLock
+// =========================================================================
+
+/// Reader count mask (bits 0..29).
+const READERS_MASK: u32 = (1 << 30) - 1;
+/// A writer holds the lock.
+const WRITE_LOCKED: u32 = 1 << 30;
+/// At least one thread may be sleeping on the word.
+const RW_WAITING: u32 = 1 << 31;
+
+/// A reader-writer lock protecting a `T`.
+pub struct RwLock<T: ?Sized> {
+    state: AtomicU32,
+    data: UnsafeCell<T>,
+}
+
+unsafe impl<T: ?Sized + Send> Send for RwLock<T> {}
+unsafe impl<T: ?Sized + Send + Sync> Sync for RwLock<T> {}
+
+/// Shared-access guard returned by [`RwLock::read`].
+pub struct RwLockReadGuard<'a, T: ?Sized> {
+    lock: &'a RwLock<T>,
+}
+
+/// Exclusive-access guard returned by [`RwLock::write`].
+pub struct RwLockWriteGuard<'a, T: ?Sized> {
+    lock: &'a RwLock<T>,
+}
+
+impl<T> RwLock<T> {
+    pub const fn new(value: T) -> Self {
+        RwLock { state: AtomicU32::new(0), data: UnsafeCell::new(value) }
+    }
+
+    pub fn into_inner(self) -> T {
+        self.data.into_inner()
+    }
+}
+
+impl<T: ?Sized> RwLock<T> {
+    /// Acquire shared access.
+    pub fn read(&self) -> RwLockReadGuard<'_, T> {
+        let s = self.state.load(Ordering::Relaxed);
+        if s & WRITE_LOCKED != 0
+            || s & READERS_MASK == READERS_MASK
+            || self.state.compare_exchange_weak(s, s + 1, Ordering::Acquire, Ordering::Relaxed).is_err()
+        {
+            self.lock_slow(false);
+        }
+        RwLockReadGuard { lock: self }
+    }
+
+    /// Acquire exclusive access.
+    pub fn write(&self) -> RwLockWriteGuard<'_, T> {
+        if self.state.compare_exchange(0, WRITE_LOCKED, Ordering::Acquire, Ordering::Relaxed).is_err() {
+            self.lock_slow(true);
+        }
+        RwLockWriteGuard { lock: self }
+    }
+
+    /// Mutable access without locking (the borrow proves exclusivity).
+    pub fn get_mut(&mut self) -> &mut T {
+        self.data.get_mut()
+    }
+
+    #[cold]
+    fn lock_slow(&self, write: bool) {
+        let mut spins = 0;
+        loop {
+            let s = self.state.load(Ordering::Relaxed);
+            let free = if write {
+                s & (WRITE_LOCKED | READERS_MASK) == 0
+            } else {
+                s & WRITE_LOCKED == 0 && s & READERS_MASK != READERS_MASK
+            };
+            if free {
+                let new = if write { s | WRITE_LOCKED } else { s + 1 };
+                if self.state.compare_exchange_weak(s, new, Ordering::Acquire, Ordering::Relaxed).is_ok() {
+                    return;
+                }
+                continue;
+            }
+            if spins < SPIN_LIMIT && s & RW_WAITING == 0 {
+                core::hint::spin_loop();
+                spins += 1;
+                continue;
+            }
+            // Record that we sleep so the releasing side issues a wake.
+            if s & RW_WAITING == 0
+                && self.state.compare_exchange_weak(s, s | RW_WAITING, Ordering::Relaxed, Ordering::Relaxed).is_err()
+            {
+                continue;
+            }
+            futex_wait(&self.state, s | RW_WAITING, FUTEX_FOREVER);
+        }
+    }
+
+    /// Clear the waiting flag and wake every sleeper; they re-contend.
+    #[cold]
+    fn wake_all(&self) {
+        self.state.fetch_and(!RW_WAITING, Ordering::Relaxed);
+        futex_wake(&self.state, u32::MAX);
+    }
+
+    fn read_unlock(&self) {
+        let prev = self.state.fetch_sub(1, Ordering::Release);
+        if prev & READERS_MASK == 1 && prev & RW_WAITING != 0 {
+            self.wake_all();
+        }
+    }
+
+    fn write_unlock(&self) {
+        let prev = self.state.fetch_and(!WRITE_LOCKED, Ordering::Release);
+        if prev & RW_WAITING != 0 {
+            self.wake_all();
+        }
+    }
+}
+
+impl<T: Default> Default for RwLock<T> {
+    fn default() -> Self {
+        RwLock::new(T::default())
+    }
+}
+
+impl<T: ?Sized> Deref for RwLockReadGuard<'_, T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        unsafe { &*self.lock.data.get() }
+    }
+}
+
+impl<T: ?Sized> Drop for RwLockReadGuard<'_, T> {
+    fn drop(&mut self) {
+        self.lock.read_unlock();
+    }
+}
+
+impl<T: ?Sized> Deref for RwLockWriteGuard<'_, T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        unsafe { &*self.lock.data.get() }
+    }
+}
+
+impl<T: ?Sized> DerefMut for RwLockWriteGuard<'_, T> {
+    fn deref_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.lock.data.get() }
+    }
+}
+
+impl<T: ?Sized> Drop for RwLockWriteGuard<'_, T> {
+    fn drop(&mut self) {
+        self.lock.write_unlock();
+    }
+}
+
+// =========================================================================
+// Once
+// =========================================================================
+
+const ONCE_INCOMPLETE: u32 = 0;
+const ONCE_RUNNING: u32 = 1;
+/// Running, and at least one thread sleeps waiting for completion.
+const ONCE_WAITING: u32 = 2;
+const ONCE_COMPLETE: u32 = 3;
+
+/// One-time initialization: the first [`call_once`](Once::call_once) runs
+/// its closure, concurrent callers sleep until it has finished.
+pub struct Once {
+    state: AtomicU32,
+}
+
+impl Once {
+    pub const fn new() -> Self {
+        Once { state: AtomicU32::new(ONCE_INCOMPLETE) }
+    }
+
+    /// Whether the initialization has completed.
+    pub fn is_completed(&self) -> bool {
+        self.state.load(Ordering::Acquire) == ONCE_COMPLETE
+    }
+
+    /// Run `f` if no call has run yet; otherwise wait for that call to finish.
+    pub fn call_once<F: FnOnce()>(&self, f: F) {
+        if self.state.load(Ordering::Acquire) == ONCE_COMPLETE {
+            return;
+        }
+        self.call_once_slow(f);
+    }
+
+    #[cold]
+    fn call_once_slow<F: FnOnce()>(&self, f: F) {
+        match self.state.compare_exchange(ONCE_INCOMPLETE, ONCE_RUNNING, Ordering::Acquire, Ordering::Acquire) {
+            Ok(_) => {
+                f();
+                if self.state.swap(ONCE_COMPLETE, Ordering::Release) == ONCE_WAITING {
+                    futex_wake(&self.state, u32::MAX);
+                }
+            }
+            Err(_) => loop {
+                match self.state.load(Ordering::Acquire) {
+                    ONCE_COMPLETE => return,
+                    ONCE_RUNNING => {
+                        let _ = self.state.compare_exchange(
+                            ONCE_RUNNING, ONCE_WAITING, Ordering::Relaxed, Ordering::Relaxed,
+                        );
+                    }
+                    _ => {
+                        futex_wait(&self.state, ONCE_WAITING, FUTEX_FOREVER);
+                    }
+                }
+            },
+        }
+    }
+}
+
+impl Default for Once {
+    fn default() -> Self {
+        Once::new()
+    }
+}
@@ -2,6 +2,88 @@
 
 use crate::raw::*;
 
+/// User address of the kernel's shared time page.
+#[cfg(target_arch = "x86_64")]
+const TIME_PAGE_ADDR: usize = 0x07FF_F000;
+
+/// Layout of the time page (must match kernel/src/task/timepage.rs).
+#[cfg(target_arch = "x86_64")]
+#[repr(C)]
+struct TimePage {
+    seq: u32,
+    version: u32,
+    tsc_hz: u64,
+    tsc_boot: u64,
+    realtime_offset_ns: u64,
+    tick_hz: u32,
+}
+
+/// A consistent reading of the time page.
+struct TimeSnapshot {
+    /// TSC frequency in Hz (never 0).
+    tsc_hz: u64,
+    /// TSC cycles since uptime 0.
+    elapsed: u64,
+    /// Unix time in ns at uptime 0 (0 = unknown).
+    realtime_offset_ns: u64,
+    tick_hz: u32,
+}
+
+impl TimeSnapshot {
+    /// Nanoseconds since boot.
+    fn ns(&self) -> u64 {
+        let secs = self.elapsed / self.tsc_hz;
+        let rem = self.elapsed % self.tsc_hz;
+        secs * 1_000_000_000 + rem * 1_000_000_000 / self.tsc_hz
+    }
+}
+
+/// Read the time page under its seqlock.  Returns `None` when the TSC is not
+/// the kernel's timebase; callers then fall back to a syscall.
+#[cfg(target_arch = "x86_64")]
+fn time_snapshot() -> Option<TimeSnapshot> {
+    use core::ptr::{addr_of, read_volatile};
+    use core::sync::atomic::{compiler_fence, Ordering};
+    let page = TIME_PAGE_ADDR as *const TimePage;
+    loop {
+        unsafe {
+            let seq = read_volatile(addr_of!((*page).seq));
+            if seq & 1 != 0 {
+                core::hint::spin_loop();
+                continue;
+            }
+            compiler_fence(Ordering::Acquire);
+            let version = read_volatile(addr_of!((*page).version));
+            let tsc_hz = read_volatile(addr_of!((*page).tsc_hz));
+            let tsc_boot = read_volatile(addr_of!((*page).tsc_boot));
+            let realtime_offset_ns = read_volatile(addr_of!((*page).realtime_offset_ns));
+            let tick_hz = read_volatile(addr_of!((*page).tick_hz));
+            let lo: u32;
+            let hi: u32;
+            core::arch::asm!("rdtsc", out("eax") lo, out("edx") hi, options(nomem, nostack));
+            compiler_fence(Ordering::Acquire);
+            if read_volatile(addr_of!((*page).seq)) != seq {
+                continue;
+            }
+            if version != 1 || tsc_hz == 0 || tick_hz == 0 {
+                return None;
+            }
+            let now = (hi as u64) << 32 | lo as u64;
+            return Some(TimeSnapshot {
+                tsc_hz,
+                elapsed: now.wrapping_sub(tsc_boot),
+                realtime_offset_ns,
+                tick_hz,
+            });
+        }
+    }
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+fn time_snapshot() -> Option<TimeSnapshot> {
+    None
+}
+
 /// Get current time. Writes [year_lo, year_hi, month, day, hour, min, sec, 0] to buf.
 pub fn time(buf: &mut [u8; 8]) -> u32 {
     syscall1(SYS_TIME, buf.as_mut_ptr() as u64)
@@ -9,18 +91,57 @@ pub fn time(buf: &mut [u8; 8]) -> u32 {
 
 /// Get uptime in PIT ticks.
 pub fn uptime() -> u32 {
-    syscall0(SYS_UPTIME)
+    match time_snapshot() {
+        Some(t) => (t.elapsed / (t.tsc_hz / t.tick_hz as u64)) as u32,
+        None => syscall0(SYS_UPTIME),
+    }
 }
 
 /// Get the PIT tick rate in Hz (e.g. 100 = 100 ticks/second).
 pub fn tick_hz() -> u32 {
-    syscall0(SYS_TICK_HZ)
+    match time_snapshot() {
+        Some(t) => t.tick_hz,
+        None => syscall0(SYS_TICK_HZ),
+    }
 }
 
 /// Get uptime in milliseconds (TSC-based, sub-ms precision).
 /// Wraps at ~49 days — use wrapping_sub for deltas.
 pub fn uptime_ms() -> u32 {
-    syscall0(SYS_UPTIME_MS)
+    match time_snapshot() {
+        Some(t) => (t.ns() / 1_000_000) as u32,
+        None => syscall0(SYS_UPTIME_MS),
+    }
+}
+
+/// Nanoseconds since boot, read from the shared time page without a syscall
+/// (millisecond resolution when the TSC is not calibrated).
+pub fn monotonic_ns() -> u64 {
+    match time_snapshot() {
+        Some(t) => t.ns(),
+        None => syscall0(SYS_UPTIME_MS) as u64 * 1_000_000,
+    }
+}
+
+/// Wall-clock time in nanoseconds since 1970-01-01 UTC, or 0 if unknown.
+/// Read from the shared time page; falls back to `SYS_TIME` (1 s resolution).
+pub fn realtime_ns() -> u64 {
+    if let Some(t) = time_snapshot() {
+        if t.realtime_offset_ns != 0 {
+            return t.realtime_offset_ns + t.ns();
+        }
+    }
+    let mut buf = [0u8; 8];
+    time(&mut buf);
+    let year = u16::from_le_bytes([buf[0], buf[1]]) as u64;
+    let (month, day) = (buf[2] as u64, buf[3] as u64);
+    if year < 1970 || month == 0 || day == 0 {
+        return 0;
+    }
+    let (y, m) = if month <= 2 { (year - 1, month + 9) } else { (year, month - 3) };
+    let days = 365 * y + y / 4 - y / 100 + y / 400 + (153 * m + 2) / 5 + day - 1 - 719_468;
+    let secs = days * 86400 + buf[4] as u64 * 3600 + buf[5] as u64 * 60 + buf[6] as u64;
+    secs * 1_000_000_000
 }
 
 /// Get system info. cmd: 0=memory, 1=threads, 2=cpus.
@@ -28,6 +149,193 @@ pub fn sysinfo(cmd: u32, buf: &mut [u8]) -> u32 {
     syscall3(SYS_SYSINFO, cmd as u64, buf.as_mut_ptr() as u64, buf.len() as u64)
 }
 
+/// [`ThreadRecord::flags`]: a per-CPU idle thread.
+pub const THREAD_FLAG_IDLE: u8 = 1;
+/// [`ThreadRecord::flags`]: a critical system thread.
+pub const THREAD_FLAG_CRITICAL: u8 = 2;
+/// [`ThreadRecord::flags`]: a user-mode thread.
+pub const THREAD_FLAG_USER: u8 = 4;
+
+/// One thread of a [`ThreadSnapshot`] (must match `ThreadSnapRecord` in
+/// kernel/src/task/scheduler/diagnostics.rs, layout version 1).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct ThreadRecord {
+    pub tid: u32,
+    /// TID of the thread owning the address space (the process).
+    pub pid: u32,
+    pub parent_tid: u32,
+    /// 0=ready, 1=running, 2=blocked.
+    pub state: u8,
+    pub priority: u8,
+    /// 0=x86_64, 1=x86.
+    pub arch_mode: u8,
+    /// `THREAD_FLAG_*`.
+    pub flags: u8,
+    pub last_cpu: u16,
+    pub uid: u16,
+    pub gid: u16,
+    _pad: u16,
+    pub cpu_ticks: u32,
+    /// Ticks since the previous [`ThreadSnapshot::refresh`].
+    pub tick_delta: u32,
+    pub user_pages: u32,
+    /// Heap bytes in use, as last reported by the process allocator.
+    pub heap_in_use: u32,
+    /// Free heap bytes and the largest free block, from the same report.
+    pub heap_free: u32,
+    pub heap_largest_free: u32,
+    pub io_read_bytes: u64,
+    pub io_write_bytes: u64,
+    /// NUL-padded.
+    pub name: [u8; 32],
+}
+
+impl ThreadRecord {
+    pub fn name_str(&self) -> &str {
+        let len = self.name.iter().position(|&b| b == 0).unwrap_or(32);
+        core::str::from_utf8(&self.name[..len]).unwrap_or("?")
+    }
+}
+
+/// All threads, read in one scheduler pass (`SYS_THREAD_SNAPSHOT`).
+///
+/// The buffer is kept between refreshes: the kernel reads the previous
+/// snapshot from it to fill in per-thread tick deltas, so a monitor needs
+/// one call per refresh and no bookkeeping of its own.
+pub struct ThreadSnapshot {
+    /// Header and records; u64 backing keeps the records 8-byte aligned.
+    buf: alloc::vec::Vec<u64>,
+}
+
+impl ThreadSnapshot {
+    const HEADER: usize = 32;
+    const VERSION: u32 = 1;
+    const DELTA: u64 = 1;
+
+    /// An empty snapshot; call [`refresh`](Self::refresh) to fill it.
+    pub fn new() -> Self {
+        let mut s = ThreadSnapshot { buf: alloc::vec::Vec::new() };
+        s.reserve(64);
+        s
+    }
+
+    fn word(&self, i: usize) -> u32 {
+        let w = self.buf[i / 2];
+        (if i % 2 == 0 { w } else { w >> 32 }) as u32
+    }
+
+    fn capacity(&self) -> usize {
+        (self.buf.len() * 8 - Self::HEADER) / core::mem::size_of::<ThreadRecord>()
+    }
+
+    /// Grow to hold `threads` records, keeping the current snapshot.
+    fn reserve(&mut self, threads: usize) {
+        let bytes = Self::HEADER + threads * core::mem::size_of::<ThreadRecord>();
+        if bytes > self.buf.len() * 8 {
+            self.buf.resize((bytes + 7) / 8, 0);
+        }
+    }
+
+    /// Take a new snapshot.  Returns false if the kernel refused.
+    pub fn refresh(&mut self) -> bool {
+        // Room for every thread of the last snapshot, plus some new ones
+        let live = self.word(2) as usize;
+        if live > self.capacity() {
+            self.reserve(live + 16);
+        }
+        let ret = syscall3(SYS_THREAD_SNAPSHOT, self.buf.as_mut_ptr() as u64,
+                           (self.buf.len() * 8) as u64, Self::DELTA);
+        ret != u32::MAX && self.word(0) == Self::VERSION
+    }
+
+    /// Threads in the snapshot (all live ones, unless more were created
+    /// since the previous refresh than it had room for).
+    pub fn threads(&self) -> &[ThreadRecord] {
+        if self.word(0) != Self::VERSION {
+            return &[];
+        }
+        let n = (self.word(3) as usize).min(self.capacity());
+        let base = unsafe { (self.buf.as_ptr() as *const u8).add(Self::HEADER) } as *const ThreadRecord;
+        unsafe { core::slice::from_raw_parts(base, n) }
+    }
+
+    /// Total scheduler ticks (all CPUs) at the snapshot.
+    pub fn total_ticks(&self) -> u32 { self.word(4) }
+    /// Idle scheduler ticks (all CPUs) at the snapshot.
+    pub fn idle_ticks(&self) -> u32 { self.word(5) }
+    /// Total scheduler ticks since the previous refresh (0 on the first),
+    /// the denominator for [`ThreadRecord::tick_delta`].
+    pub fn ticks_delta(&self) -> u32 { self.word(6) }
+    pub fn num_cpus(&self) -> u32 { self.word(7) }
+}
+
+/// [`IrqRecord::kind`]: I/O APIC line (IRQ 0-15).
+pub const IRQ_KIND_LINE: u8 = 0;
+/// [`IrqRecord::kind`]: MSI / MSI-X vector.
+pub const IRQ_KIND_MSI: u8 = 1;
+/// [`IrqRecord::kind`]: LAPIC vector (timer, IPIs), taken on every CPU.
+pub const IRQ_KIND_LOCAL: u8 = 2;
+/// [`IrqRecord::flags`]: the vector is bound to one CPU.
+pub const IRQ_FLAG_PINNED: u8 = 1;
+/// [`IrqRecord::flags`]: the interrupt balancer may move the vector.
+pub const IRQ_FLAG_BALANCED: u8 = 2;
+
+/// One IRQ of [`irq_stats`] (must match `IrqRecord` in
+/// kernel/src/arch/x86/irq_balance.rs, layout version 1).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct IrqRecord {
+    pub irq: u8,
+    /// `IRQ_KIND_*`.
+    pub kind: u8,
+    /// CPU the vector is delivered to (0xFF for LAPIC vectors).
+    pub cpu: u8,
+    /// `IRQ_FLAG_*`.
+    pub flags: u8,
+    /// NUL-padded source name ("network", "storage", "tlb-ipi", ...).
+    pub name: [u8; 12],
+    /// Interrupts taken per CPU since boot (wrapping).
+    pub counts: [u32; 16],
+}
+
+impl IrqRecord {
+    pub fn name_str(&self) -> &str {
+        let len = self.name.iter().position(|&b| b == 0).unwrap_or(12);
+        core::str::from_utf8(&self.name[..len]).unwrap_or("?")
+    }
+
+    /// Interrupts taken on all CPUs.
+    pub fn total(&self) -> u64 {
+        self.counts.iter().map(|&c| c as u64).sum()
+    }
+}
+
+/// Per-CPU interrupt counters of every active IRQ (`SYS_IRQ_STATS`).
+/// Returns the CPU count and the IRQs, or None if unsupported.
+pub fn irq_stats() -> Option<(u32, alloc::vec::Vec<IrqRecord>)> {
+    const HEADER: usize = 16;
+    const MAX_IRQS: usize = 64;
+    let rec_size = core::mem::size_of::<IrqRecord>();
+    // u64 backing keeps the records aligned
+    let mut buf = alloc::vec![0u64; (HEADER + MAX_IRQS * rec_size + 7) / 8];
+    let ret = syscall2(SYS_IRQ_STATS, buf.as_mut_ptr() as u64, (buf.len() * 8) as u64);
+    let word = |i: usize| (buf[i / 2] >> (32 * (i % 2))) as u32;
+    if ret == u32::MAX || word(0) != 1 || word(1) as usize != rec_size {
+        return None;
+    }
+    let n = (word(2) as usize).min(MAX_IRQS);
+    let base = unsafe { (buf.as_ptr() as *const u8).add(HEADER) } as *const IrqRecord;
+    let irqs = unsafe { core::slice::from_raw_parts(base, n) }.to_vec();
+    Some((word(3), irqs))
+}
+
+/// Deliver device interrupt `irq` to `cpu` only, or hand it back to the
+/// interrupt balancer with `None`.  Root only.  Returns true on success.
+pub fn set_irq_affinity(irq: u32, cpu: Option<u32>) -> bool {
+    syscall2(SYS_IRQ_AFFINITY, irq as u64, cpu.unwrap_or(u32::MAX) as u64) == 0
+}
+
 /// Read kernel log (dmesg). Returns bytes written to buf.
 pub fn dmesg(buf: &mut [u8]) -> u32 {
     syscall2(SYS_DMESG, buf.as_mut_ptr() as u64, buf.len() as u64)
@@ -61,6 +61,8 @@ struct DirEntry {
     name_len: u8,
     entry_type: u8,    // 1 = file, 2 = dir
     size: u32,
+    thumb: Vec<u32>,   // THUMB_SIZE² pixels, empty if none
+    thumb_pending: bool,
 }
 
 struct DialogState {
@@ -103,6 +105,9 @@ const NAME_ROW_H: i16 = 32;
 const BTN_H: u16 = 28;
 const BTN_MIN_W: u16 = 72;
 const PAD: i16 = 8;
+/// Width of the icon column before entry names.
+const ICON_COL_W: i16 = 20;
+const THUMB_SIZE: u32 = 16;
 
 // ── Main file browser dialog ────────────────────────────────────────────────
 
@@ -149,6 +154,7 @@ fn run_dialog(mode: Mode, starting_path: &str, default_name: &str) -> FileDialog
     window::present(win);
 
     let mut event = [0u32; 5];
+    let mut thumb_generation = thumbnail_generation();
     let mut last_click_tick: u32 = 0;
     let mut last_click_idx: Option<usize> = None;
     let dblclick_ticks = {
@@ -358,6 +364,14 @@ fn run_dialog(mode: Mode, starting_path: &str, default_name: &str) -> FileDialog
                 _ => {}
             }
         } else {
+            let generation = thumbnail_generation();
+            if generation != thumb_generation {
+                thumb_generation = generation;
+                if load_pending_thumbnails(&mut state) {
+                    render_file_dialog(win, &state);
+                    window::present(win);
+                }
+            }
             process::sleep(16);
         }
     }
@@ -586,15 +600,19 @@ fn render_file_dialog(win: u32, state: &DialogState) {
             if entry.entry_type == 2 {
                 // Directory
                 window::draw_text_ex(win, PAD, ry + 4, COLOR_DIR_ICON, 0, 13, "D");
-                window::draw_text_ex(win, PAD + 14, ry + 4, COLOR_TEXT, 0, 13, &name);
+                window::draw_text_ex(win, PAD + ICON_COL_W, ry + 4, COLOR_TEXT, 0, 13, &name);
                 window::draw_text_ex(win,
-                    PAD + 14 + {
+                    PAD + ICON_COL_W + {
                         let (tw, _) = window::font_measure(0, 13, &name);
                         tw as i16
                     },
                     ry + 4, COLOR_TEXT_SEC, 0, 13, "/");
             } else {
-                window::draw_text_ex(win, PAD + 14, ry + 4, COLOR_TEXT, 0, 13, &name);
+                if !entry.thumb.is_empty() {
+                    let t = THUMB_SIZE as u16;
+                    window::blit_alpha(win, PAD, ry + (ROW_H - t as i16) / 2, t, t, &entry.thumb);
+                }
+                window::draw_text_ex(win, PAD + ICON_COL_W, ry + 4, COLOR_TEXT, 0, 13, &name);
                 // File size (right-aligned)
                 let size_str = format_size(entry.size);
                 let (sw, _) = window::font_measure(0, 13, &size_str);
@@ -700,6 +718,8 @@ fn load_entries(state: &mut DialogState) {
             name_len: name_len as u8,
             entry_type,
             size,
+            thumb: Vec::new(),
+            thumb_pending: entry_type == 1 && is_image_name(&name[..name_len]),
         });
     }
 
@@ -713,6 +733,105 @@ fn load_entries(state: &mut DialogState) {
             a.name[..a.name_len as usize].cmp(&b.name[..b.name_len as usize])
         }
     });
+
+    load_pending_thumbnails(state);
+}
+
+// ── Thumbnails (libimage.dlib at 0x0410_0000) ──────────────────────────────
+
+const LIBIMAGE_BASE: usize = 0x0410_0000;
+/// Export count of the first libimage.dlib with the thumbnail cache.
+const LIBIMAGE_THUMB_EXPORTS: u32 = 17;
+/// libimage error: no thumbnail generated yet.
+const ERR_NOT_CACHED: i32 = -5;
+
+#[repr(C)]
+struct ImageInfo {
+    width: u32,
+    height: u32,
+    format: u32,
+    scratch_needed: u32,
+}
+
+/// Prefix of libimage's export table up to the thumbnail functions.
+#[repr(C)]
+struct LibimageExports {
+    magic: [u8; 4],
+    version: u32,
+    num_exports: u32,
+    _pad: u32,
+    _decode_exports: [usize; 14],
+    thumbnail_lookup: extern "C" fn(
+        path: *const u8, path_len: u32, size: u32, queue: u32,
+        out: *mut u32, out_len: u32, info: *mut ImageInfo,
+    ) -> i32,
+    _thumbnail_store: extern "C" fn(*const u8, u32, *const u32, u32, u32) -> i32,
+    thumbnail_generation: extern "C" fn() -> u32,
+}
+
+fn libimage() -> Option<&'static LibimageExports> {
+    let exports = unsafe { &*(LIBIMAGE_BASE as *const LibimageExports) };
+    if exports.magic == *b"DLIB" && exports.num_exports >= LIBIMAGE_THUMB_EXPORTS {
+        Some(exports)
+    } else {
+        None
+    }
+}
+
+fn thumbnail_generation() -> u32 {
+    libimage().map_or(0, |lib| (lib.thumbnail_generation)())
+}
+
+fn is_image_name(name: &[u8]) -> bool {
+    let ext = match name.iter().rposition(|&b| b == b'.') {
+        Some(dot) => &name[dot + 1..],
+        None => return false,
+    };
+    [&b"png"[..], b"jpg", b"jpeg", b"bmp", b"gif", b"ico"]
+        .iter()
+        .any(|e| ext.eq_ignore_ascii_case(e))
+}
+
+/// Look up the thumbnails still missing; misses are generated in the
+/// background and picked up once the thumbnail generation changes.
+/// Returns true if any thumbnail was loaded.
+fn load_pending_thumbnails(state: &mut DialogState) -> bool {
+    let lib = match libimage() {
+        Some(lib) => lib,
+        None => return false,
+    };
+    let mut loaded = false;
+    let mut thumb = [0u32; (THUMB_SIZE * THUMB_SIZE) as usize];
+    for i in 0..state.entries.len() {
+        if !state.entries[i].thumb_pending {
+            continue;
+        }
+        let full = build_full_path(state, &entry_name(&state.entries[i]));
+        let mut info = ImageInfo { width: 0, height: 0, format: 0, scratch_needed: 0 };
+        let ret = (lib.thumbnail_lookup)(
+            full.as_ptr(), full.len() as u32, THUMB_SIZE, 1,
+            thumb.as_mut_ptr(), thumb.len() as u32, &mut info,
+        );
+        let entry = &mut state.entries[i];
+        match ret {
+            0 => {
+                // Center in the icon square
+                let (w, h) = (info.width as usize, info.height as usize);
+                let size = THUMB_SIZE as usize;
+                let (x0, y0) = ((size - w) / 2, (size - h) / 2);
+                entry.thumb = alloc::vec![0u32; size * size];
+                for row in 0..h {
+                    let dst = (y0 + row) * size + x0;
+                    entry.thumb[dst..dst + w].copy_from_slice(&thumb[row * w..(row + 1) * w]);
+                }
+                entry.thumb_pending = false;
+                loaded = true;
+            }
+            ERR_NOT_CACHED => {}
+            _ => entry.thumb_pending = false,
+        }
+    }
+    loaded
 }
 
 fn navigate_parent(state: &mut DialogState) {
@@ -597,6 +597,46 @@ pub fn blit(window_id: u32, x: i16, y: i16, w: u16, h: u16, data: &[u32]) -> u32
     0
 }
 
+/// Move the pixels inside a rectangle vertically by `dy` (negative = up).
+/// Rows scrolled in at the opposite edge keep their old contents; the caller
+/// is expected to repaint them.
+pub fn scroll_rect(window_id: u32, x: i16, y: i16, w: u16, h: u16, dy: i16) -> u32 {
+    let win = match find_win(window_id) {
+        Some(w) => w,
+        None => return u32::MAX,
+    };
+    let sw = win.surface.width as i32;
+    let sh = win.surface.height as i32;
+    let x0 = (x as i32).max(0);
+    let x1 = (x as i32 + w as i32).min(sw);
+    let y0 = (y as i32).max(0);
+    let y1 = (y as i32 + h as i32).min(sh);
+    let dy = dy as i32;
+    if x0 >= x1 || y1 - y0 <= dy.abs() || dy == 0 {
+        return 0;
+    }
+    let stride = win.surface.width as usize;
+    let count = (x1 - x0) as usize;
+    let rows = y1 - y0 - dy.abs();
+    let copy_row = |src: i32, dst: i32| unsafe {
+        core::ptr::copy_nonoverlapping(
+            win.surface.pixels.add(src as usize * stride + x0 as usize),
+            win.surface.pixels.add(dst as usize * stride + x0 as usize),
+            count,
+        );
+    };
+    if dy < 0 {
+        for r in 0..rows {
+            copy_row(y0 + r - dy, y0 + r);
+        }
+    } else {
+        for r in (0..rows).rev() {
+            copy_row(y0 + r, y0 + r + dy);
+        }
+    }
+    0
+}
+
 /// Alpha-blend ARGB pixel data onto window content surface.
 /// Unlike `blit`, this properly handles transparent and semi-transparent pixels.
 pub fn blit_alpha(window_id: u32, x: i16, y: i16, w: u16, h: u16, data: &[u32]) -> u32 {
@@ -19,6 +19,8 @@ pub struct UisysExports {
     /// Font smoothing mode: 0 = none, 1 = greyscale AA (default), 2 = subpixel LCD.
     /// Written by compositor, read by libfont via volatile pointer.
     pub font_smoothing: u32,
+    /// [0] = DPI scale percent, [1] = shared glyph cache SHM ID (libfont),
+    /// [2] unused.  Written by compositor.
     pub _reserved: [u32; 3],
 
     // --- Label (4) ---
@@ -11,6 +11,8 @@ pub struct UisysExports {
     pub theme: u32,
     /// Font smoothing mode: 0 = none, 1 = greyscale AA, 2 = subpixel LCD.
     pub font_smoothing: u32,
+    /// [0] = DPI scale percent, [1] = shared glyph cache SHM ID (libfont),
+    /// [2] unused.  Written by compositor.
     pub _reserved: [u32; 3],
 
     // Label (4)
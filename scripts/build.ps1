@@ -7,7 +7,7 @@
 # SPDX-License-Identifier: MIT
 
 # Build anyOS on Windows
-# Usage: .\scripts\build.ps1 [-Clean] [-Reset] [-Uefi] [-Iso] [-All] [-Debug] [-NoCross]
+# Usage: .\scripts\build.ps1 [-Clean] [-Reset] [-Uefi] [-Iso] [-All] [-Debug] [-LockProfile] [-NoCross]
 #                             [-IMinor] [-IMajor] [-NoVer]
 
 param(
@@ -18,6 +18,7 @@ param(
     [switch]$All,
     [switch]$Debug,
     [switch]$DebugSurf,
+    [switch]$LockProfile,
     [switch]$NoCross,
     [switch]$IMinor,
     [switch]$IMajor,
@@ -69,9 +70,10 @@ Write-Host "Version: $($env:ANYOS_VERSION)" -ForegroundColor Cyan
 # CMake flags
 $debugFlag     = if ($Debug)     { "ON" } else { "OFF" }
 $debugSurfFlag = if ($DebugSurf) { "ON" } else { "OFF" }
+$lockProfFlag  = if ($LockProfile) { "ON" } else { "OFF" }
 $noCrossFlag   = if ($NoCross)   { "ON" } else { "OFF" }
 $resetFlag     = if ($Reset)     { "ON" } else { "OFF" }
-$cmakeExtra    = "-DANYOS_DEBUG_VERBOSE=$debugFlag", "-DANYOS_DEBUG_SURF=$debugSurfFlag", "-DANYOS_NO_CROSS=$noCrossFlag", "-DANYOS_RESET=$resetFlag", "-DANYOS_VERSION=$($env:ANYOS_VERSION)"
+$cmakeExtra    = "-DANYOS_DEBUG_VERBOSE=$debugFlag", "-DANYOS_DEBUG_SURF=$debugSurfFlag", "-DANYOS_LOCK_PROFILE=$lockProfFlag", "-DANYOS_NO_CROSS=$noCrossFlag", "-DANYOS_RESET=$resetFlag", "-DANYOS_VERSION=$($env:ANYOS_VERSION)"
 
 # Ensure build directory exists and is configured
 if (-not (Test-Path (Join-Path $BuildDir "build.ninja"))) {
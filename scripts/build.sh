@@ -8,7 +8,7 @@
 # SPDX-License-Identifier: MIT
 
 # Build anyOS
-# Usage: ./build.sh [--clean] [--reset] [--uefi] [--iso] [--all] [--debug] [--no-cross]
+# Usage: ./build.sh [--clean] [--reset] [--uefi] [--iso] [--all] [--debug] [--lock-profile] [--no-cross]
 #                   [--iminor] [--imajor] [--nover] [--arm64]
 
 BUILD_START=$(date +%s)
@@ -23,6 +23,7 @@ BUILD_ISO=0
 BUILD_ALL=0
 DEBUG_VERBOSE=0
 DEBUG_SURF=0
+LOCK_PROFILE=0
 NO_CROSS=0
 VER_MODE="patch"
 ANYOS_ARCH="x86_64"
@@ -50,6 +51,9 @@ for arg in "$@"; do
         --debug-surf)
             DEBUG_SURF=1
             ;;
+        --lock-profile)
+            LOCK_PROFILE=1
+            ;;
         --no-cross)
             NO_CROSS=1
             ;;
@@ -66,7 +70,7 @@ for arg in "$@"; do
             ANYOS_ARCH="arm64"
             ;;
         *)
-            echo "Usage: $0 [--clean] [--reset] [--uefi] [--iso] [--all] [--debug] [--debug-surf] [--no-cross]"
+            echo "Usage: $0 [--clean] [--reset] [--uefi] [--iso] [--all] [--debug] [--debug-surf] [--lock-profile] [--no-cross]"
             echo "       [--iminor] [--imajor] [--nover] [--arm64]"
             echo ""
             echo "  --clean       Force full rebuild of all components"
@@ -76,6 +80,7 @@ for arg in "$@"; do
             echo "  --all         Build BIOS, UEFI, and ISO images"
             echo "  --debug       Enable verbose kernel debug prints"
             echo "  --debug-surf  Enable Surf browser debug logging (HTML/CSS/JS pipeline)"
+            echo "  --lock-profile  Record kernel lock contention per call site (anyTrace Locks tab)"
             echo "  --no-cross    Disable cross-compilation (skip libc, TCC, games, curl)"
             echo "  --iminor      Increment minor version (reset patch to 0)"
             echo "  --imajor      Increment major version (reset minor and patch to 0)"
@@ -115,7 +120,7 @@ echo "${ANYOS_VERSION}" > "$VERSION_FILE"
 echo "Version: ${ANYOS_VERSION}"
 
 # CMake flags
-CMAKE_EXTRA_FLAGS="-DANYOS_DEBUG_VERBOSE=$([ "$DEBUG_VERBOSE" -eq 1 ] && echo ON || echo OFF) -DANYOS_DEBUG_SURF=$([ "$DEBUG_SURF" -eq 1 ] && echo ON || echo OFF) -DANYOS_NO_CROSS=$([ "$NO_CROSS" -eq 1 ] && echo ON || echo OFF) -DANYOS_RESET=$([ "$RESET" -eq 1 ] && echo ON || echo OFF) -DANYOS_VERSION=${ANYOS_VERSION} -DANYOS_ARCH=${ANYOS_ARCH}"
+CMAKE_EXTRA_FLAGS="-DANYOS_DEBUG_VERBOSE=$([ "$DEBUG_VERBOSE" -eq 1 ] && echo ON || echo OFF) -DANYOS_DEBUG_SURF=$([ "$DEBUG_SURF" -eq 1 ] && echo ON || echo OFF) -DANYOS_LOCK_PROFILE=$([ "$LOCK_PROFILE" -eq 1 ] && echo ON || echo OFF) -DANYOS_NO_CROSS=$([ "$NO_CROSS" -eq 1 ] && echo ON || echo OFF) -DANYOS_RESET=$([ "$RESET" -eq 1 ] && echo ON || echo OFF) -DANYOS_VERSION=${ANYOS_VERSION} -DANYOS_ARCH=${ANYOS_ARCH}"
 
 # Ensure build directory exists
 if [ ! -f "${BUILD_DIR}/build.ninja" ]; then
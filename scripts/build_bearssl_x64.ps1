@@ -100,6 +100,14 @@ foreach ($src in $srcFiles) {
     $count++
 }
 
+# The TLS wrapper used by libhttp and surf (tls_connect & co.)
+& $CC @CFLAGS -c (Join-Path $ProjectDir "libs\libhttp\anyos_tls.c") -o (Join-Path $ObjDir "anyos_tls.o")
+if ($LASTEXITCODE -ne 0) {
+    Write-Host "  FAILED: anyos_tls.c" -ForegroundColor Red
+    exit 1
+}
+$count++
+
 Write-Host "  AR  libbearssl_x64.a"
 $objFiles = Get-ChildItem -Path $ObjDir -Filter "*.o"
 & $AR rcs $Output ($objFiles | ForEach-Object { $_.FullName })
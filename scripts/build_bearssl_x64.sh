@@ -46,6 +46,9 @@ find "$BEARSSL_DIR/src" -name '*.c' | while read src; do
     $CC $CFLAGS -c "$src" -o "$obj"
 done
 
+# The TLS wrapper used by libhttp and surf (tls_connect & co.)
+$CC $CFLAGS -c "$ROOT/libs/libhttp/anyos_tls.c" -o "$OBJDIR/anyos_tls.o"
+
 echo "  AR  libbearssl_x64.a"
 $AR rcs "$OUTPUT" "$OBJDIR"/*.o
 
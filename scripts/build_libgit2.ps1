@@ -57,7 +57,10 @@ $CFLAGS = @(
     "-I$LibcDir\include",
     "-DHAVE_STDINT_H", "-DHAVE_LIMITS_H",
     "-DPCRE_STATIC", "-DHAVE_CONFIG_H",
-    "-DNO_READDIR_R"
+    "-DNO_READDIR_R",
+    # Delta-base cache: larger than the 16 MiB / 1 MiB upstream defaults
+    "-DGIT_PACK_CACHE_MEMORY_LIMIT=(64*1024*1024)",
+    "-DGIT_PACK_CACHE_SIZE_LIMIT=(4*1024*1024)"
 )
 
 New-Item -ItemType Directory -Force -Path $ObjDir | Out-Null
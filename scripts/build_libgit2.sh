@@ -31,6 +31,10 @@ CFLAGS="$CFLAGS -I$LIBC_DIR/include"
 CFLAGS="$CFLAGS -DHAVE_STDINT_H -DHAVE_LIMITS_H"
 CFLAGS="$CFLAGS -DPCRE_STATIC -DHAVE_CONFIG_H"
 CFLAGS="$CFLAGS -DNO_READDIR_R"
+# Delta-base cache: keep more (and larger) resolved bases across a clone's
+# delta chains than the 16 MiB / 1 MiB upstream defaults
+CFLAGS="$CFLAGS -DGIT_PACK_CACHE_MEMORY_LIMIT=(64*1024*1024)"
+CFLAGS="$CFLAGS -DGIT_PACK_CACHE_SIZE_LIMIT=(4*1024*1024)"
 
 mkdir -p "$OBJ_DIR"
 
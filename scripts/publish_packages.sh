@@ -182,6 +182,7 @@ if [[ "$PKG_COUNT" -gt 0 ]]; then
     "$APKG_INDEX" \
         -d "${HOSTING_DIR}/packages/${ARCH}" \
         -o "${HOSTING_DIR}/index.json" \
+        -b "${HOSTING_DIR}/index.bin" \
         -n "anyOS Packages" \
         -a "$ARCH"
     echo ""
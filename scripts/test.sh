@@ -11,7 +11,8 @@
 # Usage: ./scripts/test.sh [OPTIONS]
 #
 # Options:
-#   --js                 Run all 12 libjs ECMAScript unit-test suites
+#   --js                 Run all 13 libjs ECMAScript unit-test suites
+#   --js-bench           Time the libjs benchmark corpus, optimizer on and off
 #   --js-suite NAME      Run a single suite (e.g. --js-suite 07_functions)
 #   --tc39               Run tc39/test262 conformance tests
 #   --tc39-download      Download the test262 subset first, then run
@@ -36,6 +37,7 @@ NC='\033[0m'
 
 RUN_JS=0
 RUN_TC39=0
+RUN_BENCH=0
 TC39_DOWNLOAD=0
 JS_SUITE=""
 TC39_DIR="${LIBJS_TESTS_DIR}/test262"
@@ -50,6 +52,7 @@ while [[ $# -gt 0 ]]; do
         --js)             RUN_JS=1 ;;
         --js-suite)       RUN_JS=1; shift; JS_SUITE="$1" ;;
         --tc39)           RUN_TC39=1 ;;
+        --js-bench)       RUN_BENCH=1 ;;
         --tc39-download)  RUN_TC39=1; TC39_DOWNLOAD=1 ;;
         --tc39-dir)       shift; TC39_DIR="$1" ;;
         --verbose)        VERBOSE=1 ;;
@@ -69,7 +72,8 @@ if [ "$SHOW_HELP" -eq 1 ]; then
     echo ""
     echo "Usage: ./scripts/test.sh [OPTIONS]"
     echo ""
-    echo "  --js                 Run all 12 libjs ECMAScript unit-test suites"
+    echo "  --js                 Run all 13 libjs ECMAScript unit-test suites"
+    echo "  --js-bench           Time the libjs benchmark corpus (optimizer on/off)"
     echo "  --js-suite NAME      Run one suite, e.g. --js-suite 07_functions"
     echo "  --tc39               Run tc39/test262 conformance suite"
     echo "  --tc39-download      Download test262 subset, then run"
@@ -118,6 +122,7 @@ run_js_tests() {
         "10_error_handling"
         "11_builtins"
         "12_advanced"
+        "13_benchmarks"
     )
 
     if [ -n "$JS_SUITE" ]; then suites=("$JS_SUITE"); fi
@@ -260,6 +265,22 @@ run_tc39_tests() {
     echo ""
 }
 
+# ── benchmark corpus ──────────────────────────────────────────────────────────
+
+run_js_bench() {
+    echo ""
+    echo -e "${CYAN}${BOLD}━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━${NC}"
+    echo -e "${CYAN}${BOLD}  libjs Benchmark Corpus${NC}"
+    echo -e "${CYAN}${BOLD}━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━${NC}"
+    echo ""
+
+    # Timings are only meaningful in release mode.
+    (cd "$LIBJS_TESTS_DIR" && "$CARGO" +stable build --release --bin js_bench 2>&1 \
+        | grep -v '^warning:' || true)
+    local bin="${LIBJS_TESTS_DIR}/target/aarch64-apple-darwin/release/js_bench"
+    "$bin" && "$bin" --no-opt
+}
+
 # ── dispatch ──────────────────────────────────────────────────────────────────
 
 FAILED=0
@@ -272,4 +293,8 @@ if [ "$RUN_TC39" -eq 1 ]; then
     run_tc39_tests || FAILED=1
 fi
 
+if [ "$RUN_BENCH" -eq 1 ]; then
+    run_js_bench || FAILED=1
+fi
+
 exit "$FAILED"
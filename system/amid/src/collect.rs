@@ -1,10 +1,13 @@
 //! Data collectors for the ami database.
 //!
 //! Each function collects system information via syscalls, clears the
-//! corresponding table, and inserts fresh rows. Uses the same binary
+//! corresponding table, and inserts the fresh rows with one multi-row
+//! `INSERT` whose values are bound as parameters. Uses the same binary
 //! formats as `system/taskmanager/src/data.rs` and `bin/devlist`.
 
 use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
 use libdb_client::Database;
 
 // ── Constants ────────────────────────────────────────────────────────────────
@@ -22,42 +25,87 @@ fn str_from_bytes(buf: &[u8]) -> &str {
 }
 
 /// Format an IPv4 address from 4 bytes.
-fn format_ip(b: &[u8]) -> alloc::string::String {
+fn format_ip(b: &[u8]) -> String {
     format!("{}.{}.{}.{}", b[0], b[1], b[2], b[3])
 }
 
 /// Format a MAC address from 6 bytes.
-fn format_mac(b: &[u8]) -> alloc::string::String {
+fn format_mac(b: &[u8]) -> String {
     format!("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
             b[0], b[1], b[2], b[3], b[4], b[5])
 }
 
-/// Escape single quotes in a text value for safe SQL insertion.
-fn escape_sql(s: &str) -> alloc::string::String {
-    if !s.contains('\'') {
-        return alloc::string::String::from(s);
+/// A value bound into a [`Rows`] batch.
+enum Cell {
+    Int(i64),
+    Text(String),
+}
+
+/// Rows for one table, inserted together by a single multi-row `INSERT`
+/// so a refresh packs its table's pages in one go.
+struct Rows {
+    /// `INSERT INTO table (cols...)`, without `VALUES`.
+    head: &'static str,
+    cols: usize,
+    cells: Vec<Cell>,
+}
+
+impl Rows {
+    fn new(head: &'static str, cols: usize) -> Rows {
+        Rows { head, cols, cells: Vec::new() }
+    }
+
+    fn int(&mut self, value: i64) {
+        self.cells.push(Cell::Int(value));
     }
-    let mut out = alloc::string::String::with_capacity(s.len() + 4);
-    for ch in s.chars() {
-        if ch == '\'' {
-            out.push('\'');
+
+    fn text(&mut self, value: &str) {
+        self.cells.push(Cell::Text(String::from(value)));
+    }
+
+    /// Insert every complete row.
+    fn insert(self, db: &Database) {
+        let rows = self.cells.len() / self.cols;
+        if rows == 0 { return; }
+
+        let mut tuple = String::from("(?");
+        for _ in 1..self.cols {
+            tuple.push_str(", ?");
+        }
+        tuple.push(')');
+        let mut sql = String::with_capacity(self.head.len() + 8 + rows * (tuple.len() + 2));
+        sql.push_str(self.head);
+        sql.push_str(" VALUES ");
+        for r in 0..rows {
+            if r > 0 { sql.push_str(", "); }
+            sql.push_str(&tuple);
         }
-        out.push(ch);
+
+        let mut stmt = match db.prepare(&sql) {
+            Ok(s) => s,
+            Err(_) => return,
+        };
+        for (i, cell) in self.cells.iter().take(rows * self.cols).enumerate() {
+            let index = i as u32 + 1;
+            let _ = match cell {
+                Cell::Int(v) => stmt.bind_int(index, *v),
+                Cell::Text(t) => stmt.bind_text(index, t),
+            };
+        }
+        let _ = stmt.step();
     }
-    out
 }
 
-/// Insert a key/value text pair into a table.
-fn insert_kv_text(db: &Database, table: &str, key: &str, value: &str) {
-    let sql = format!("INSERT INTO {} (key, value) VALUES ('{}', '{}')",
-                      table, key, escape_sql(value));
-    let _ = db.exec(&sql);
+/// Add a key/value text pair to a `(key, value)` batch.
+fn insert_kv_text(rows: &mut Rows, key: &str, value: &str) {
+    rows.text(key);
+    rows.text(value);
 }
 
-/// Insert a key/value integer pair into the mem table.
-fn insert_kv_int(db: &Database, key: &str, value: u32) {
-    let sql = format!("INSERT INTO mem (key, value) VALUES ('{}', {})", key, value);
-    let _ = db.exec(&sql);
+/// Add a key/value integer pair to a `(key, value)` batch.
+fn insert_kv_int(rows: &mut Rows, key: &str, value: u32) {
+    rows.text(key);
+    rows.int(value as i64);
 }
 
 // ── Static: Hardware Info ────────────────────────────────────────────────────
@@ -80,19 +128,22 @@ pub fn collect_hw(db: &Database) {
     let fb_h = u32::from_le_bytes([buf[88], buf[89], buf[90], buf[91]]);
     let fb_bpp = u32::from_le_bytes([buf[92], buf[93], buf[94], buf[95]]);
 
-    insert_kv_text(db, "hw", "cpu_brand", brand);
-    insert_kv_text(db, "hw", "cpu_vendor", vendor);
-    insert_kv_text(db, "hw", "tsc_mhz", &format!("{}", tsc_mhz));
-    insert_kv_text(db, "hw", "cpu_count", &format!("{}", cpu_count));
-    insert_kv_text(db, "hw", "boot_mode", match boot_mode {
+    let mut rows = Rows::new("INSERT INTO hw (key, value)", 2);
+
+    insert_kv_text(&mut rows, "cpu_brand", brand);
+    insert_kv_text(&mut rows, "cpu_vendor", vendor);
+    insert_kv_text(&mut rows, "tsc_mhz", &format!("{}", tsc_mhz));
+    insert_kv_text(&mut rows, "cpu_count", &format!("{}", cpu_count));
+    insert_kv_text(&mut rows, "boot_mode", match boot_mode {
         0 => "BIOS",
         1 => "UEFI",
         _ => "Unknown",
     });
-    insert_kv_text(db, "hw", "total_mem_mib", &format!("{}", total_mem));
-    insert_kv_text(db, "hw", "fb_width", &format!("{}", fb_w));
-    insert_kv_text(db, "hw", "fb_height", &format!("{}", fb_h));
-    insert_kv_text(db, "hw", "fb_bpp", &format!("{}", fb_bpp));
+    insert_kv_text(&mut rows, "total_mem_mib", &format!("{}", total_mem));
+    insert_kv_text(&mut rows, "fb_width", &format!("{}", fb_w));
+    insert_kv_text(&mut rows, "fb_height", &format!("{}", fb_h));
+    insert_kv_text(&mut rows, "fb_bpp", &format!("{}", fb_bpp));
+    rows.insert(db);
 }
 
 // ── Fast: Memory Stats ───────────────────────────────────────────────────────
@@ -113,11 +164,14 @@ pub fn collect_mem(db: &Database) {
     // Derive MiB: each frame = 4 KiB
     let free_mib = free_frames / 256;
 
-    insert_kv_int(db, "total_frames", total_frames);
-    insert_kv_int(db, "free_frames", free_frames);
-    insert_kv_int(db, "heap_used", heap_used);
-    insert_kv_int(db, "heap_total", heap_total);
-    insert_kv_int(db, "free_mem_mib", free_mib);
+    let mut rows = Rows::new("INSERT INTO mem (key, value)", 2);
+
+    insert_kv_int(&mut rows, "total_frames", total_frames);
+    insert_kv_int(&mut rows, "free_frames", free_frames);
+    insert_kv_int(&mut rows, "heap_used", heap_used);
+    insert_kv_int(&mut rows, "heap_total", heap_total);
+    insert_kv_int(&mut rows, "free_mem_mib", free_mib);
+    rows.insert(db);
 }
 
 // ── Fast: CPU Load ───────────────────────────────────────────────────────────
@@ -165,9 +219,11 @@ pub fn collect_cpu(db: &Database, state: &mut CpuState) {
     state.prev_total = total;
     state.prev_idle = idle;
 
+    let mut rows = Rows::new("INSERT INTO cpu (core, load_pct)", 2);
+
     // Use -1 as i64 for "overall" row
-    let sql = format!("INSERT INTO cpu (core, load_pct) VALUES (-1, {})", overall);
-    let _ = db.exec(&sql);
+    rows.int(-1);
+    rows.int(overall as i64);
 
     // Per-core load
     for i in 0..ncpu {
@@ -185,9 +241,10 @@ pub fn collect_cpu(db: &Database, state: &mut CpuState) {
         state.prev_core_total[i] = ct;
         state.prev_core_idle[i] = ci;
 
-        let sql = format!("INSERT INTO cpu (core, load_pct) VALUES ({}, {})", i, pct);
-        let _ = db.exec(&sql);
+        rows.int(i as i64);
+        rows.int(pct as i64);
     }
+    rows.insert(db);
 }
 
 // ── Fast: Thread List ────────────────────────────────────────────────────────
@@ -200,6 +257,8 @@ pub fn collect_threads(db: &Database) {
     let count = anyos_std::sys::sysinfo(1, &mut buf);
     if count == u32::MAX { return; }
 
+    let mut rows = Rows::new("INSERT INTO threads (tid, name, state, prio, arch, uid, pages, ticks)", 8);
+
     for i in 0..count as usize {
         let off = i * THREAD_ENTRY_SIZE;
         if off + THREAD_ENTRY_SIZE > buf.len() { break; }
@@ -213,12 +272,16 @@ pub fn collect_threads(db: &Database) {
         let user_pages = u32::from_le_bytes([buf[off + 32], buf[off + 33], buf[off + 34], buf[off + 35]]);
         let cpu_ticks = u32::from_le_bytes([buf[off + 36], buf[off + 37], buf[off + 38], buf[off + 39]]);
 
-        let sql = format!(
-            "INSERT INTO threads (tid, name, state, prio, arch, uid, pages, ticks) VALUES ({}, '{}', {}, {}, {}, {}, {}, {})",
-            tid, escape_sql(name), state, prio, arch, uid, user_pages, cpu_ticks
-        );
-        let _ = db.exec(&sql);
+        rows.int(tid as i64);
+        rows.text(name);
+        rows.int(state as i64);
+        rows.int(prio as i64);
+        rows.int(arch as i64);
+        rows.int(uid as i64);
+        rows.int(user_pages as i64);
+        rows.int(cpu_ticks as i64);
     }
+    rows.insert(db);
 }
 
 // ── Slow: Device List ────────────────────────────────────────────────────────
@@ -231,6 +294,8 @@ pub fn collect_devices(db: &Database) {
     let count = anyos_std::sys::devlist(&mut buf);
     if count == 0 { return; }
 
+    let mut rows = Rows::new("INSERT INTO devices (path, driver, dtype)", 3);
+
     for i in 0..count as usize {
         if (i + 1) * 64 > buf.len() { break; }
         let entry = &buf[i * 64..(i + 1) * 64];
@@ -239,12 +304,11 @@ pub fn collect_devices(db: &Database) {
         let driver = str_from_bytes(&entry[32..56]);
         let dtype = entry[56] as u32;
 
-        let sql = format!(
-            "INSERT INTO devices (path, driver, dtype) VALUES ('{}', '{}', {})",
-            escape_sql(path), escape_sql(driver), dtype
-        );
-        let _ = db.exec(&sql);
+        rows.text(path);
+        rows.text(driver);
+        rows.int(dtype as i64);
     }
+    rows.insert(db);
 }
 
 // ── Slow: Disk List ──────────────────────────────────────────────────────────
@@ -257,6 +321,8 @@ pub fn collect_disks(db: &Database) {
     let count = anyos_std::sys::disk_list(&mut buf);
     if count == 0 || count == u32::MAX { return; }
 
+    let mut rows = Rows::new("INSERT INTO disks (id, disk_id, part, start_lba, size_sect)", 5);
+
     for i in 0..count as usize {
         let off = i * 32;
         if off + 32 > buf.len() { break; }
@@ -273,12 +339,13 @@ pub fn collect_disks(db: &Database) {
             buf[off + 20], buf[off + 21], buf[off + 22], buf[off + 23],
         ]);
 
-        let sql = format!(
-            "INSERT INTO disks (id, disk_id, part, start_lba, size_sect) VALUES ({}, {}, {}, {}, {})",
-            id, disk_id, part, start_lba as i64, size_sect as i64
-        );
-        let _ = db.exec(&sql);
+        rows.int(id as i64);
+        rows.int(disk_id as i64);
+        rows.int(part as i64);
+        rows.int(start_lba as i64);
+        rows.int(size_sect as i64);
     }
+    rows.insert(db);
 }
 
 // ── Slow: Network Config ─────────────────────────────────────────────────────
@@ -290,18 +357,21 @@ pub fn collect_net(db: &Database) {
     let mut buf = [0u8; 24];
     anyos_std::net::get_config(&mut buf);
 
+    let mut rows = Rows::new("INSERT INTO net (key, value)", 2);
+
     // [ip:4, mask:4, gw:4, dns:4, mac:6, link:1, pad:1]
-    insert_kv_text(db, "net", "ip", &format_ip(&buf[0..4]));
-    insert_kv_text(db, "net", "mask", &format_ip(&buf[4..8]));
-    insert_kv_text(db, "net", "gateway", &format_ip(&buf[8..12]));
-    insert_kv_text(db, "net", "dns", &format_ip(&buf[12..16]));
-    insert_kv_text(db, "net", "mac", &format_mac(&buf[16..22]));
-    insert_kv_text(db, "net", "link", if buf[22] != 0 { "up" } else { "down" });
+    insert_kv_text(&mut rows, "ip", &format_ip(&buf[0..4]));
+    insert_kv_text(&mut rows, "mask", &format_ip(&buf[4..8]));
+    insert_kv_text(&mut rows, "gateway", &format_ip(&buf[8..12]));
+    insert_kv_text(&mut rows, "dns", &format_ip(&buf[12..16]));
+    insert_kv_text(&mut rows, "mac", &format_mac(&buf[16..22]));
+    insert_kv_text(&mut rows, "link", if buf[22] != 0 { "up" } else { "down" });
 
     let nic_enabled = anyos_std::net::is_nic_enabled();
     let nic_available = anyos_std::net::is_nic_available();
-    insert_kv_text(db, "net", "nic_enabled", if nic_enabled { "true" } else { "false" });
-    insert_kv_text(db, "net", "nic_available", if nic_available { "true" } else { "false" });
+    insert_kv_text(&mut rows, "nic_enabled", if nic_enabled { "true" } else { "false" });
+    insert_kv_text(&mut rows, "nic_available", if nic_available { "true" } else { "false" });
+    rows.insert(db);
 }
 
 // ── Slow: Service List ───────────────────────────────────────────────────────
@@ -320,6 +390,8 @@ pub fn collect_svc(db: &Database) {
     let mut thread_buf = [0u8; THREAD_ENTRY_SIZE * MAX_THREADS];
     let thread_count = anyos_std::sys::sysinfo(1, &mut thread_buf);
 
+    let mut rows = Rows::new("INSERT INTO svc (name, status, tid)", 3);
+
     // Parse directory entries (newline-separated names)
     let dir_data = &dir_buf[..dir_len as usize];
     for entry in dir_data.split(|&b| b == b'\n') {
@@ -333,12 +405,11 @@ pub fn collect_svc(db: &Database) {
         // Check if a thread with this name is running
         let (status, tid) = find_thread_status(name, &thread_buf, thread_count);
 
-        let sql = format!(
-            "INSERT INTO svc (name, status, tid) VALUES ('{}', '{}', {})",
-            escape_sql(name), status, tid
-        );
-        let _ = db.exec(&sql);
+        rows.text(name);
+        rows.text(status);
+        rows.int(tid as i64);
     }
+    rows.insert(db);
 }
 
 /// Search the thread list for a thread matching `name`.
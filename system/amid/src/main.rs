@@ -123,20 +123,25 @@ fn main() {
         // Check refresh timers
         let now = anyos_std::sys::uptime_ms();
 
-        // Fast refresh: mem, cpu, threads (every 2s)
+        // Fast refresh: mem, cpu, threads (every 2s).  Each refresh is one
+        // transaction, so the tables are replaced with a single log write.
         if now.wrapping_sub(last_fast) >= FAST_INTERVAL_MS {
+            let _ = db.exec("BEGIN");
             collect::collect_mem(&db);
             collect::collect_cpu(&db, &mut cpu_state);
             collect::collect_threads(&db);
+            let _ = db.exec("COMMIT");
             last_fast = now;
         }
 
         // Slow refresh: devices, disks, net, svc (every 10s)
         if now.wrapping_sub(last_slow) >= SLOW_INTERVAL_MS {
+            let _ = db.exec("BEGIN");
             collect::collect_devices(&db);
             collect::collect_disks(&db);
             collect::collect_net(&db);
             collect::collect_svc(&db);
+            let _ = db.exec("COMMIT");
             last_slow = now;
         }
 
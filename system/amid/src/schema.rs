@@ -17,11 +17,14 @@ const CREATE_STATEMENTS: &[&str] = &[
     "CREATE TABLE disks (id INTEGER, disk_id INTEGER, part INTEGER, start_lba INTEGER, size_sect INTEGER)",
     "CREATE TABLE net (key TEXT, value TEXT)",
     "CREATE TABLE svc (name TEXT, status TEXT, tid INTEGER)",
+    // Lookups by thread id and service name seek instead of scanning
+    "CREATE INDEX threads_tid ON threads (tid)",
+    "CREATE INDEX svc_name ON svc (name)",
 ];
 
 /// Initialize all database tables.
 ///
-/// Attempts CREATE TABLE for each; ignores "already exists" errors
+/// Attempts each CREATE TABLE / CREATE INDEX; ignores "already exists" errors
 /// so the daemon can safely restart without losing schema.
 pub fn init_tables(db: &Database) {
     for sql in CREATE_STATEMENTS {
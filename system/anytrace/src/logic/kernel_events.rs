@@ -0,0 +1,329 @@
+//! Kernel event tracing via SYS_TRACE_CTL / SYS_TRACE_READ.
+//!
+//! While recording, every kernel tracepoint is enabled and the per-CPU
+//! rings are drained on the poll timer.  Records are merged by timestamp
+//! into a bounded window, and entry/exit pairs become latency spans:
+//! syscalls (per thread, including time blocked), IRQ handlers, block I/O
+//! requests and wakeup-to-run delays.  [`KernelTrace::breakdown`] lists
+//! what happened inside a span, so a spike can be tied to its cause.
+
+use alloc::collections::BTreeMap;
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::debug::{self, TraceEvent};
+
+/// Records kept for the timeline and breakdowns (~3 MiB).
+const MAX_EVENTS: usize = 100_000;
+/// Spans kept (oldest dropped first).
+const MAX_SPANS: usize = 8192;
+/// Records fetched per SYS_TRACE_READ.
+const DRAIN_MAX: usize = 16384;
+/// Reads per poll before giving up for this round.
+const DRAIN_ROUNDS: usize = 4;
+
+#[derive(Clone, Copy, PartialEq)]
+pub enum SpanKind {
+    Syscall,
+    Irq,
+    BlockIo,
+    Wakeup,
+}
+
+impl SpanKind {
+    pub fn name(self) -> &'static str {
+        match self {
+            SpanKind::Syscall => "syscall",
+            SpanKind::Irq => "irq",
+            SpanKind::BlockIo => "block I/O",
+            SpanKind::Wakeup => "wakeup",
+        }
+    }
+}
+
+/// A matched entry/exit pair.
+#[derive(Clone, Copy)]
+pub struct Span {
+    pub kind: SpanKind,
+    /// CPU of the entry (for a wakeup: the CPU the thread ran on).
+    pub cpu: u16,
+    /// Thread that entered (for a wakeup: the woken thread).
+    pub tid: u32,
+    /// Syscall number, IRQ, `disk << 56 | lba` or woken TID.
+    pub what: u64,
+    /// Syscall return value / block request sectors and flags.
+    pub info: u64,
+    pub start: u64,
+    pub end: u64,
+}
+
+impl Span {
+    pub fn cycles(&self) -> u64 {
+        self.end.saturating_sub(self.start)
+    }
+}
+
+/// Recording state and the collected window.
+pub struct KernelTrace {
+    pub recording: bool,
+    /// Frequency of the timestamps, in Hz.
+    pub cycle_hz: u64,
+    /// Records the kernel dropped because a ring was full.
+    pub lost: u64,
+    pub ncpus: usize,
+    /// Records, oldest first.
+    pub events: Vec<TraceEvent>,
+    /// Completed spans, oldest first.
+    pub spans: Vec<Span>,
+    /// Syscalls in progress: tid -> (cpu, number, entry tsc).
+    open_syscalls: BTreeMap<u32, (u16, u64, u64)>,
+    /// IRQ handlers running per CPU (nested ones on top).
+    open_irqs: Vec<Vec<(u64, u64)>>,
+    /// Block requests in flight: key -> (cpu, tid, submit tsc).
+    open_blocks: BTreeMap<u64, (u16, u32, u64)>,
+    /// Woken threads not yet running: tid -> wakeup tsc.
+    pending_wakeups: BTreeMap<u32, u64>,
+}
+
+impl KernelTrace {
+    pub fn new() -> Self {
+        Self {
+            recording: false,
+            cycle_hz: 0,
+            lost: 0,
+            ncpus: 0,
+            events: Vec::new(),
+            spans: Vec::new(),
+            open_syscalls: BTreeMap::new(),
+            open_irqs: Vec::new(),
+            open_blocks: BTreeMap::new(),
+            pending_wakeups: BTreeMap::new(),
+        }
+    }
+
+    /// Clear the window and enable every tracepoint.
+    pub fn start(&mut self) {
+        *self = Self::new();
+        debug::trace_ctl(debug::TRACE_ALL, debug::TRACE_CTL_SET | debug::TRACE_CTL_RESET);
+        self.recording = true;
+    }
+
+    /// Disable the tracepoints, keeping what was collected.
+    pub fn stop(&mut self) {
+        self.poll();
+        debug::trace_ctl(0, debug::TRACE_CTL_SET);
+        self.recording = false;
+    }
+
+    /// Drain the kernel rings.  Returns the number of new records.
+    pub fn poll(&mut self) -> usize {
+        if !self.recording {
+            return 0;
+        }
+        let mut batch: Vec<TraceEvent> = Vec::new();
+        for _ in 0..DRAIN_ROUNDS {
+            let b = debug::trace_read(DRAIN_MAX);
+            self.cycle_hz = b.cycle_hz;
+            self.ncpus = self.ncpus.max(b.ncpus as usize);
+            self.lost += b.lost as u64;
+            let full = b.events.len() == DRAIN_MAX;
+            batch.extend_from_slice(&b.events);
+            if !full {
+                break;
+            }
+        }
+        if batch.is_empty() {
+            return 0;
+        }
+        // The kernel groups records by CPU; merge them by time.
+        batch.sort_by_key(|e| e.tsc);
+        if self.open_irqs.len() < self.ncpus {
+            self.open_irqs.resize(self.ncpus, Vec::new());
+        }
+        for ev in &batch {
+            self.pair(ev);
+        }
+        let n = batch.len();
+        if self.events.last().map_or(false, |l| l.tsc > batch[0].tsc) {
+            self.events.extend_from_slice(&batch);
+            self.events.sort_by_key(|e| e.tsc);
+        } else {
+            self.events.extend_from_slice(&batch);
+        }
+        if self.events.len() > MAX_EVENTS {
+            let excess = self.events.len() - MAX_EVENTS;
+            self.events.drain(..excess);
+        }
+        if self.spans.len() > MAX_SPANS {
+            let excess = self.spans.len() - MAX_SPANS;
+            self.spans.drain(..excess);
+        }
+        n
+    }
+
+    /// Match one record against the open entries.
+    fn pair(&mut self, ev: &TraceEvent) {
+        let cpu = ev.cpu as usize;
+        match ev.event {
+            debug::TRACE_SYSCALL_ENTRY => {
+                self.open_syscalls.insert(ev.tid, (ev.cpu, ev.arg0, ev.tsc));
+            }
+            debug::TRACE_SYSCALL_EXIT => {
+                if let Some((c, num, t0)) = self.open_syscalls.remove(&ev.tid) {
+                    if num == ev.arg0 {
+                        self.push(SpanKind::Syscall, c, ev.tid, num, ev.arg1, t0, ev.tsc);
+                    }
+                }
+            }
+            debug::TRACE_IRQ_ENTRY if cpu < self.open_irqs.len() => {
+                self.open_irqs[cpu].push((ev.arg0, ev.tsc));
+            }
+            debug::TRACE_IRQ_EXIT if cpu < self.open_irqs.len() => {
+                if self.open_irqs[cpu].last().map_or(false, |&(irq, _)| irq == ev.arg0) {
+                    let (irq, t0) = self.open_irqs[cpu].pop().unwrap();
+                    self.push(SpanKind::Irq, ev.cpu, ev.tid, irq, 0, t0, ev.tsc);
+                }
+            }
+            debug::TRACE_SCHED_SWITCH => {
+                // A handler that switches threads (timer tick) ends here;
+                // its exit record comes whenever the thread runs again.
+                if cpu < self.open_irqs.len() {
+                    while let Some((irq, t0)) = self.open_irqs[cpu].pop() {
+                        self.push(SpanKind::Irq, ev.cpu, ev.arg0 as u32, irq, 0, t0, ev.tsc);
+                    }
+                }
+                let next = ev.arg1 as u32;
+                if let Some(t0) = self.pending_wakeups.remove(&next) {
+                    self.push(SpanKind::Wakeup, ev.cpu, next, next as u64, 0, t0, ev.tsc);
+                }
+            }
+            debug::TRACE_SCHED_WAKEUP => {
+                self.pending_wakeups.entry(ev.arg0 as u32).or_insert(ev.tsc);
+            }
+            debug::TRACE_BLOCK_SUBMIT => {
+                self.open_blocks.insert(ev.arg0, (ev.cpu, ev.tid, ev.tsc));
+            }
+            debug::TRACE_BLOCK_COMPLETE => {
+                if let Some((c, tid, t0)) = self.open_blocks.remove(&ev.arg0) {
+                    self.push(SpanKind::BlockIo, c, tid, ev.arg0, ev.arg1, t0, ev.tsc);
+                }
+            }
+            _ => {}
+        }
+    }
+
+    fn push(&mut self, kind: SpanKind, cpu: u16, tid: u32, what: u64, info: u64, start: u64, end: u64) {
+        self.spans.push(Span { kind, cpu, tid, what, info, start, end });
+    }
+
+    /// Cycles to microseconds.
+    pub fn us(&self, cycles: u64) -> u64 {
+        (cycles as u128 * 1_000_000 / self.cycle_hz.max(1) as u128) as u64
+    }
+
+    /// Indices of the `n` longest spans, longest first.
+    pub fn longest(&self, n: usize) -> Vec<usize> {
+        let mut idx: Vec<usize> = (0..self.spans.len()).collect();
+        idx.sort_unstable_by(|&a, &b| self.spans[b].cycles().cmp(&self.spans[a].cycles()));
+        idx.truncate(n);
+        idx
+    }
+
+    /// Records with `start <= tsc <= end`.
+    pub fn window(&self, start: u64, end: u64) -> &[TraceEvent] {
+        let lo = self.events.partition_point(|e| e.tsc < start);
+        let hi = self.events.partition_point(|e| e.tsc <= end);
+        &self.events[lo..hi]
+    }
+
+    /// Short label for what a span is about.
+    pub fn describe(&self, span: &Span) -> String {
+        match span.kind {
+            SpanKind::Syscall => format!("#{} -> {:#x}", span.what, span.info as u32),
+            SpanKind::Irq => format!("IRQ {}", span.what),
+            SpanKind::BlockIo => format!(
+                "disk {} lba {} {} x{}{}",
+                span.what >> 56,
+                span.what & ((1 << 56) - 1),
+                if span.info & (1 << 32) != 0 { "write" } else { "read" },
+                span.info as u32,
+                if span.info & (1 << 33) != 0 { " FAILED" } else { "" },
+            ),
+            SpanKind::Wakeup => format!("TID {} runnable", span.what),
+        }
+    }
+
+    /// What happened inside `span`: time the thread spent switched out and
+    /// the interrupts, page faults, disk and network activity it met.
+    pub fn breakdown(&self, span: &Span) -> String {
+        let events = self.window(span.start, span.end);
+        let mut irqs = 0u32;
+        let mut faults = 0u32;
+        let mut blocks = 0u32;
+        let mut tcp = 0u32;
+        let mut off_cpu = 0u64;
+        let mut switched_out: Option<u64> = None;
+        let mut others: Vec<u32> = Vec::new();
+
+        for ev in events {
+            // Events of the span's thread, or of its CPU for spans that are
+            // about the CPU rather than a thread.
+            let relevant = match span.kind {
+                SpanKind::Syscall | SpanKind::BlockIo => ev.tid == span.tid,
+                SpanKind::Irq | SpanKind::Wakeup => ev.cpu == span.cpu,
+            };
+            match ev.event {
+                debug::TRACE_SCHED_SWITCH if ev.arg0 as u32 == span.tid => {
+                    switched_out = Some(ev.tsc);
+                }
+                debug::TRACE_SCHED_SWITCH if ev.arg1 as u32 == span.tid => {
+                    if let Some(t) = switched_out.take() {
+                        off_cpu += ev.tsc - t;
+                    }
+                }
+                debug::TRACE_SCHED_SWITCH if span.kind == SpanKind::Wakeup && relevant => {
+                    let tid = ev.arg1 as u32;
+                    if tid != span.tid && !others.contains(&tid) && others.len() < 3 {
+                        others.push(tid);
+                    }
+                }
+                debug::TRACE_IRQ_ENTRY if relevant => irqs += 1,
+                debug::TRACE_PAGE_FAULT if relevant => faults += 1,
+                debug::TRACE_BLOCK_SUBMIT if relevant => blocks += 1,
+                debug::TRACE_TCP_SEND | debug::TRACE_TCP_RECV if relevant => tcp += 1,
+                _ => {}
+            }
+        }
+        if let Some(t) = switched_out {
+            off_cpu += span.end.saturating_sub(t);
+        }
+
+        let mut parts: Vec<String> = Vec::new();
+        if off_cpu != 0 {
+            parts.push(format!("off-CPU {} us", self.us(off_cpu)));
+        }
+        if span.kind == SpanKind::Wakeup {
+            if let Some(prev) = self.running_before(span.cpu, span.start) {
+                parts.push(format!("CPU{} running TID {}", span.cpu, prev));
+            }
+        }
+        if !others.is_empty() {
+            let list: Vec<String> = others.iter().map(|t| format!("{}", t)).collect();
+            parts.push(format!("ran first: {}", list.join(",")));
+        }
+        for (count, what) in [(irqs, "IRQ"), (faults, "page fault"), (blocks, "disk I/O"), (tcp, "TCP segment")] {
+            if count != 0 {
+                parts.push(format!("{} {}{}", count, what, if count == 1 { "" } else { "s" }));
+            }
+        }
+        parts.join(", ")
+    }
+
+    /// Thread running on `cpu` at `tsc`, if a switch to it was recorded.
+    fn running_before(&self, cpu: u16, tsc: u64) -> Option<u32> {
+        let hi = self.events.partition_point(|e| e.tsc < tsc);
+        self.events[..hi].iter().rev()
+            .find(|e| e.cpu == cpu && e.event == debug::TRACE_SCHED_SWITCH)
+            .map(|e| e.arg1 as u32)
+    }
+}
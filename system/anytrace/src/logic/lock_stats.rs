@@ -0,0 +1,68 @@
+//! Kernel lock contention profile via SYS_LOCK_STATS.
+//!
+//! Only populated when the kernel was built with `--lock-profile`; the
+//! kernel then attributes every lock acquisition to its call site.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use anyos_std::debug::{self, LockStat};
+
+/// Maximum sites fetched per poll (the kernel table holds 256).
+const MAX_SITES: usize = 256;
+
+/// One lock call site, with cycle counts converted to microseconds.
+#[derive(Clone)]
+pub struct LockSite {
+    /// `file:line` of the `lock()` call.
+    pub site: String,
+    pub kind: &'static str,
+    pub lock_addr: u64,
+    pub acquires: u64,
+    pub contended: u64,
+    pub spin_us: u64,
+    pub avg_hold_us: u64,
+    pub max_hold_us: u64,
+}
+
+/// Latest profile snapshot.
+pub struct LockProfile {
+    /// Kernel has the profiler compiled in.
+    pub enabled: bool,
+    /// Sites, most spin time first.
+    pub sites: Vec<LockSite>,
+}
+
+impl LockProfile {
+    pub fn new() -> Self {
+        Self { enabled: false, sites: Vec::new() }
+    }
+
+    /// Re-read the kernel counters.
+    pub fn poll(&mut self) {
+        let stats = debug::lock_stats(MAX_SITES, false);
+        self.enabled = stats.enabled;
+        let hz = stats.cycle_hz.max(1);
+        let mut raw = stats.sites;
+        raw.sort_unstable_by(|a, b| b.spin_cycles.cmp(&a.spin_cycles));
+        self.sites = raw.iter().map(|s| convert(s, hz)).collect();
+    }
+
+}
+
+fn convert(s: &LockStat, hz: u64) -> LockSite {
+    let us = |cycles: u64| (cycles as u128 * 1_000_000 / hz as u128) as u64;
+    LockSite {
+        site: alloc::format!("{}:{}", s.file_str(), s.line),
+        kind: match s.kind {
+            debug::LOCK_KIND_TICKET => "ticket",
+            debug::LOCK_KIND_MUTEX => "mutex",
+            _ => "spin",
+        },
+        lock_addr: s.lock_addr,
+        acquires: s.acquires,
+        contended: s.contended,
+        spin_us: us(s.spin_cycles),
+        avg_hold_us: us(s.hold_cycles / s.acquires.max(1)),
+        max_hold_us: us(s.max_hold_cycles),
+    }
+}
@@ -8,3 +8,5 @@ pub mod snapshots;
 pub mod traces;
 pub mod memory;
 pub mod process_list;
+pub mod lock_stats;
+pub mod kernel_events;
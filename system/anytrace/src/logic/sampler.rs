@@ -1,19 +1,36 @@
 //! CPU sampling profiler.
 //!
-//! Periodically suspends/resumes the target thread and records RIP to
-//! build an instruction-pointer histogram for hotspot detection.
+//! Uses the kernel's system-wide sampler (`SYS_PROF_START`): every CPU
+//! records RIP, TID, kernel/user mode and a frame-pointer call chain into a
+//! ring mapped into this process, drained on the poll timer.  If the kernel
+//! sampler cannot be started, falls back to recording RIP whenever the
+//! target is suspended.
 
+use alloc::collections::BTreeMap;
 use alloc::vec::Vec;
+use anyos_std::debug::{self, ProfSample, Profiler, PROF_CHAIN_DEPTH};
 
 /// A single CPU sample.
 #[derive(Clone, Copy)]
 pub struct Sample {
-    /// Timestamp (uptime_ms at sample time).
+    /// Timestamp (ms since boot).
     pub timestamp: u64,
-    /// Target TID.
+    /// TID running on the sampled CPU.
     pub tid: u32,
     /// Instruction pointer at sample time.
     pub rip: u64,
+    /// The CPU was in kernel mode.
+    pub kernel: bool,
+    /// Valid entries in `chain`.
+    pub depth: u8,
+    /// Return addresses, innermost first.
+    pub chain: [u64; PROF_CHAIN_DEPTH],
+}
+
+impl Sample {
+    pub fn call_chain(&self) -> &[u64] {
+        &self.chain[..self.depth as usize]
+    }
 }
 
 /// Sampling profiler state.
@@ -22,10 +39,15 @@ pub struct Sampler {
     pub samples: Vec<Sample>,
     /// Whether sampling is active.
     pub active: bool,
-    /// Sample interval in milliseconds.
-    pub interval_ms: u32,
+    /// Requested samples per second per CPU (kernel sampler).
+    pub hz: u32,
     /// Maximum number of samples to collect.
     pub max_samples: usize,
+    /// Samples the kernel dropped because its rings filled up.
+    pub lost: u64,
+    /// Kernel sampler session, if it could be started.
+    profiler: Option<Profiler>,
+    drain_buf: Vec<ProfSample>,
 }
 
 impl Sampler {
@@ -34,29 +56,92 @@ impl Sampler {
         Self {
             samples: Vec::new(),
             active: false,
-            interval_ms: 10,
+            hz: 1000,
             max_samples: 10000,
+            lost: 0,
+            profiler: None,
+            drain_buf: Vec::new(),
         }
     }
 
     /// Start sampling.
     pub fn start(&mut self) {
         self.samples.clear();
+        self.lost = 0;
         self.active = true;
+        if self.profiler.is_none() {
+            self.profiler = Profiler::start(self.hz);
+        }
     }
 
     /// Stop sampling.
     pub fn stop(&mut self) {
+        self.poll();
+        if let Some(p) = self.profiler.take() {
+            p.stop();
+        }
         self.active = false;
     }
 
-    /// Record a sample if active and below limit.
+    /// Human-readable sample source.
+    pub fn source_name(&self) -> &'static str {
+        match self.profiler.as_ref().map(|p| p.source()) {
+            Some(debug::PROF_SOURCE_PMU) => "PMU NMI",
+            Some(debug::PROF_SOURCE_TIMER) => "LAPIC timer",
+            Some(_) => "stopped",
+            None => "suspend/resume",
+        }
+    }
+
+    /// Drain the kernel sampler.  Returns the number of new samples.
+    pub fn poll(&mut self) -> usize {
+        let p = match self.profiler.as_ref() {
+            Some(p) if self.active => p,
+            _ => return 0,
+        };
+        let room = self.max_samples.saturating_sub(self.samples.len());
+        self.drain_buf.clear();
+        // Drain everything so the rings do not overflow; keep what fits.
+        p.drain(&mut self.drain_buf, usize::MAX);
+        self.lost = p.lost();
+        let hz = p.cycle_hz().max(1);
+        let taken = self.drain_buf.len().min(room);
+        for s in &self.drain_buf[..taken] {
+            self.samples.push(Sample {
+                timestamp: (s.tsc as u128 * 1000 / hz as u128) as u64,
+                tid: s.tid,
+                rip: s.rip,
+                kernel: s.is_kernel(),
+                depth: s.call_chain().len() as u8,
+                chain: s.chain,
+            });
+        }
+        taken
+    }
+
+    /// Record a sample if active and below limit (suspend/resume fallback;
+    /// ignored while the kernel sampler runs).
     pub fn record(&mut self, tid: u32, rip: u64) {
-        if !self.active || self.samples.len() >= self.max_samples {
+        if !self.active || self.profiler.is_some() || self.samples.len() >= self.max_samples {
             return;
         }
         let timestamp = anyos_std::sys::uptime_ms() as u64;
-        self.samples.push(Sample { timestamp, tid, rip });
+        self.samples.push(Sample { timestamp, tid, rip, kernel: false, depth: 0, chain: [0; PROF_CHAIN_DEPTH] });
+    }
+
+    /// Collapse samples into unique stacks (outermost frame first, leaf =
+    /// RIP) with their counts, most frequent first — the "folded" input of
+    /// a flame graph.  `tid` 0 = all threads.
+    pub fn folded_stacks(&self, tid: u32) -> Vec<(Vec<u64>, u32)> {
+        let mut counts: BTreeMap<Vec<u64>, u32> = BTreeMap::new();
+        for s in self.samples.iter().filter(|s| tid == 0 || s.tid == tid) {
+            let mut stack: Vec<u64> = s.call_chain().iter().rev().copied().collect();
+            stack.push(s.rip);
+            *counts.entry(stack).or_insert(0) += 1;
+        }
+        let mut stacks: Vec<(Vec<u64>, u32)> = counts.into_iter().collect();
+        stacks.sort_unstable_by(|a, b| b.1.cmp(&a.1));
+        stacks
     }
 
     /// Clear all samples.
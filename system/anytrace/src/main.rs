@@ -18,13 +18,18 @@ mod util;
 
 use alloc::format;
 use alloc::string::String;
+use alloc::vec::Vec;
 use libanyui_client as anyui;
 use anyui::Widget;
 
-use crate::logic::{debugger, breakpoints, sampler, snapshots, traces, process_list, unwinder, disasm};
+use crate::logic::{
+    debugger, breakpoints, sampler, snapshots, traces, process_list, unwinder, disasm, lock_stats,
+    kernel_events,
+};
 use crate::ui::{
     toolbar, process_tree, registers_view, stack_view, disasm_view,
-    memory_view, timeline_view, output_panel, snapshot_view, trace_view, status_bar,
+    memory_view, timeline_view, output_panel, snapshot_view, trace_view, lock_view,
+    event_timeline_view, status_bar,
 };
 
 // ════════════════════════════════════════════════════════════════
@@ -39,6 +44,8 @@ struct AppState {
     snapshots: snapshots::SnapshotStore,
     traces: traces::TraceStore,
     process_list: alloc::vec::Vec<process_list::ProcessEntry>,
+    lock_profile: lock_stats::LockProfile,
+    kernel_trace: kernel_events::KernelTrace,
     // UI
     toolbar: toolbar::DebugToolbar,
     process_tree: process_tree::ProcessTreeView,
@@ -50,6 +57,8 @@ struct AppState {
     output_panel: output_panel::OutputPanel,
     snapshot_view: snapshot_view::SnapshotView,
     trace_view: trace_view::TraceView,
+    lock_view: lock_view::LockView,
+    event_view: event_timeline_view::EventTimelineView,
     status_bar: status_bar::StatusBar,
     // Timer IDs
     poll_timer_id: u32,
@@ -150,11 +159,11 @@ fn main() {
 
     right_split.add(&top_container);
 
-    // ── Bottom tab bar: Call Stack | Timeline | Output | Traces ──
+    // ── Bottom tab bar: Call Stack | Timeline | Output | Traces | Locks | Events ──
     let bottom_container = anyui::View::new();
     bottom_container.set_dock(anyui::DOCK_FILL);
 
-    let bottom_tabs = anyui::TabBar::new("Call Stack|Timeline|Output|Traces");
+    let bottom_tabs = anyui::TabBar::new("Call Stack|Timeline|Output|Traces|Locks|Events");
     bottom_tabs.set_dock(anyui::DOCK_TOP);
     bottom_container.add(&bottom_tabs);
 
@@ -170,9 +179,18 @@ fn main() {
     let trace_v = trace_view::TraceView::new(&bottom_container);
     bottom_container.add(&trace_v.grid);
 
+    let lock_v = lock_view::LockView::new(&bottom_container);
+    bottom_container.add(&lock_v.grid);
+
+    let event_v = event_timeline_view::EventTimelineView::new(&bottom_container);
+    bottom_container.add(&event_v.container);
+
     // Manual tab switching (heterogeneous control types)
     {
-        let ids = [stack_v.tree.id(), timeline_v.canvas.id(), output_p.text_area.id(), trace_v.grid.id()];
+        let ids = [
+            stack_v.tree.id(), timeline_v.canvas.id(), output_p.text_area.id(),
+            trace_v.grid.id(), lock_v.grid.id(), event_v.container.id(),
+        ];
         for i in 1..ids.len() {
             anyui::Control::from_id(ids[i]).set_visible(false);
         }
@@ -196,6 +214,8 @@ fn main() {
             snapshots: snapshots::SnapshotStore::new(),
             traces: traces::TraceStore::new(),
             process_list: initial_procs,
+            lock_profile: lock_stats::LockProfile::new(),
+            kernel_trace: kernel_events::KernelTrace::new(),
             toolbar: tb,
             process_tree: ptree,
             registers_view: regs_v,
@@ -206,6 +226,8 @@ fn main() {
             output_panel: output_p,
             snapshot_view: snap_v,
             trace_view: trace_v,
+            lock_view: lock_v,
+            event_view: event_v,
             status_bar: status,
             poll_timer_id: 0,
             proclist_timer_id: 0,
@@ -264,6 +286,11 @@ fn main() {
         on_snapshot();
     });
 
+    // ── Toolbar: Record kernel events ──
+    app().toolbar.btn_ktrace.on_click(|_| {
+        on_toggle_kernel_trace();
+    });
+
     // ── Process tree: double-click to attach ──
     app().process_tree.tree.on_selection_changed(|_| {
         // Selection changed — no action needed until attach button clicked
@@ -274,12 +301,21 @@ fn main() {
         on_snapshot_selected();
     });
 
+    // ── Event grid: click to center the timeline on a span ──
+    app().event_view.grid.on_selection_changed(|_| {
+        let s = app();
+        let row = s.event_view.grid.selected_row();
+        if row != u32::MAX {
+            s.event_view.show_row(&s.kernel_trace, row);
+        }
+    });
+
     // ── Timers ──
 
-    // Poll timer (100ms): debug events only
+    // Poll timer (100ms): debug events, profiler samples and kernel events
     app().poll_timer_id = anyui::set_timer(100, poll_timer_callback);
 
-    // Process list timer (2000ms): refresh process tree
+    // Process list timer (2000ms): refresh process tree and lock profile
     app().proclist_timer_id = anyui::set_timer(2000, proclist_timer_callback);
 
     // Status timer (1000ms): uptime
@@ -315,6 +351,7 @@ fn on_attach() {
         s.status_bar.set_state(&format!("TID {} — Suspended", tid));
         // Start profiler sampling on attach
         s.sampler.start();
+        s.output_panel.log(&format!("Profiler: {} sampling", s.sampler.source_name()));
         update_all_views();
     } else {
         s.output_panel.log(&format!("Failed to attach to TID {}.", tid));
@@ -328,12 +365,45 @@ fn on_detach() {
     let tid = s.debugger.target_tid;
     s.breakpoints.clear_all(tid);
     s.sampler.stop();
+    log_hot_stacks(tid);
     s.debugger.detach();
     s.output_panel.log("Detached.");
     s.status_bar.set_state("Detached");
     update_toolbar_state();
 }
 
+/// Start or stop recording kernel tracepoints.
+fn on_toggle_kernel_trace() {
+    let s = app();
+    if s.kernel_trace.recording {
+        s.kernel_trace.stop();
+        s.output_panel.log(&format!(
+            "Kernel events: stopped ({} events, {} spans, {} lost).",
+            s.kernel_trace.events.len(), s.kernel_trace.spans.len(), s.kernel_trace.lost,
+        ));
+    } else {
+        s.kernel_trace.start();
+        s.output_panel.log("Kernel events: recording.");
+    }
+    s.toolbar.set_recording(s.kernel_trace.recording);
+    s.event_view.update(&s.kernel_trace);
+}
+
+/// Log the target's most frequent call stacks (folded, leaf last).
+fn log_hot_stacks(tid: u32) {
+    let s = app();
+    let stacks = s.sampler.folded_stacks(tid);
+    if stacks.is_empty() {
+        return;
+    }
+    s.output_panel.log(&format!("Hot stacks for TID {} ({} samples, {} lost):",
+        tid, s.sampler.samples.len(), s.sampler.lost));
+    for (stack, count) in stacks.iter().take(10) {
+        let frames: Vec<String> = stack.iter().map(|&a| crate::util::format::hex64(a)).collect();
+        s.output_panel.log(&format!("  {:5}  {}", count, frames.join(";")));
+    }
+}
+
 /// Suspend the running target.
 fn on_suspend() {
     let s = app();
@@ -482,6 +552,14 @@ fn update_toolbar_state() {
 fn poll_timer_callback() {
     let s = app();
 
+    // Drain the kernel sampler
+    if s.sampler.poll() > 0 {
+        s.timeline_view.update_timeline(&s.sampler.samples);
+    }
+
+    // Drain the kernel tracepoint rings
+    s.kernel_trace.poll();
+
     // Poll debug events
     if s.debugger.is_attached() && !s.debugger.is_suspended() {
         if s.debugger.poll_event() {
@@ -501,18 +579,24 @@ fn poll_timer_callback() {
     }
 }
 
-/// Process list timer (2000ms): refresh process tree.
+/// Process list timer (2000ms): refresh process tree and lock profile.
 fn proclist_timer_callback() {
     let s = app();
     s.process_list = process_list::poll_processes();
     s.process_tree.refresh(&s.process_list);
+    s.lock_profile.poll();
+    s.lock_view.update(&s.lock_profile);
 }
 
-/// Status timer (1000ms): update uptime display.
+/// Status timer (1000ms): update uptime display and the kernel event view.
 fn status_timer_callback() {
     let s = app();
     s.status_bar.update_uptime();
 
+    if s.kernel_trace.recording {
+        s.event_view.update(&s.kernel_trace);
+    }
+
     // Update status bar state text
     if s.debugger.is_attached() {
         let tid = s.debugger.target_tid;
@@ -0,0 +1,205 @@
+//! Kernel event timeline: one lane per CPU on a Canvas, and the longest
+//! latency spans with their breakdown in a DataGrid.
+//!
+//! Lanes show the last [`WINDOW_US`] of the trace, or the window around the
+//! span selected in the grid.  Thread runs are shaded by TID; IRQ handlers
+//! (red), syscalls (blue) and block I/O (green) are bars, page faults
+//! (orange) and TCP segments (purple) are ticks.
+
+use alloc::format;
+use alloc::vec::Vec;
+use libanyui_client as ui;
+use ui::Widget;
+use ui::ColumnDef;
+use anyos_std::debug;
+use crate::logic::kernel_events::{KernelTrace, Span, SpanKind};
+use crate::util::format::fmt_u64;
+
+/// Time shown across the canvas.
+const WINDOW_US: u64 = 50_000;
+/// Spans listed in the grid.
+const MAX_ROWS: usize = 200;
+const LANE_MAX: u32 = 32;
+
+const BG: u32 = 0xFF1E1E1E;
+const LANE_SEP: u32 = 0xFF333333;
+const IRQ_COLOR: u32 = 0xFFE0504A;
+const SYSCALL_COLOR: u32 = 0xFF4A90E2;
+const BLOCK_COLOR: u32 = 0xFF50C878;
+const FAULT_COLOR: u32 = 0xFFF5A623;
+const TCP_COLOR: u32 = 0xFFB06AE0;
+const FOCUS_COLOR: u32 = 0xFFFFE066;
+
+/// Kernel event panel.
+pub struct EventTimelineView {
+    pub container: ui::View,
+    pub canvas: ui::Canvas,
+    pub grid: ui::DataGrid,
+    /// Span index of each grid row.
+    rows: Vec<usize>,
+}
+
+impl EventTimelineView {
+    /// Create the event view.
+    pub fn new(_parent: &impl Widget) -> Self {
+        let container = ui::View::new();
+        container.set_dock(ui::DOCK_FILL);
+
+        let canvas = ui::Canvas::new(800, 140);
+        canvas.set_dock(ui::DOCK_TOP);
+        container.add(&canvas);
+
+        let grid = ui::DataGrid::new(600, 200);
+        grid.set_dock(ui::DOCK_FILL);
+        grid.set_columns(&[
+            ColumnDef::new("Latency (us)").width(100),
+            ColumnDef::new("Kind").width(80),
+            ColumnDef::new("CPU").width(50),
+            ColumnDef::new("TID").width(60),
+            ColumnDef::new("What").width(220),
+            ColumnDef::new("At (ms)").width(90),
+            ColumnDef::new("Inside").width(420),
+        ]);
+        container.add(&grid);
+
+        Self { container, canvas, grid, rows: Vec::new() }
+    }
+
+    /// Refresh the span list and draw the latest window.
+    pub fn update(&mut self, trace: &KernelTrace) {
+        if !trace.recording && trace.spans.is_empty() {
+            self.rows.clear();
+            self.grid.set_row_count(1);
+            self.grid.set_cell(0, 0, "");
+            self.grid.set_cell(0, 1, "");
+            self.grid.set_cell(0, 6, "Start recording kernel events from the toolbar");
+            for col in 2..6 {
+                self.grid.set_cell(0, col, "");
+            }
+            self.draw(trace, None);
+            return;
+        }
+        let t_base = trace.events.first().map_or(0, |e| e.tsc);
+        self.rows = trace.longest(MAX_ROWS);
+        self.grid.set_row_count(self.rows.len() as u32);
+        for (row, &i) in self.rows.iter().enumerate() {
+            let span = &trace.spans[i];
+            let row = row as u32;
+            self.grid.set_cell(row, 0, &fmt_u64(trace.us(span.cycles())));
+            self.grid.set_cell(row, 1, span.kind.name());
+            self.grid.set_cell(row, 2, &format!("{}", span.cpu));
+            self.grid.set_cell(row, 3, &format!("{}", span.tid));
+            self.grid.set_cell(row, 4, &trace.describe(span));
+            self.grid.set_cell(row, 5, &fmt_u64(trace.us(span.start.saturating_sub(t_base)) / 1000));
+            self.grid.set_cell(row, 6, &trace.breakdown(span));
+        }
+        self.draw(trace, None);
+    }
+
+    /// Center the timeline on the span in grid row `row`.
+    pub fn show_row(&self, trace: &KernelTrace, row: u32) {
+        if let Some(&i) = self.rows.get(row as usize) {
+            if let Some(span) = trace.spans.get(i) {
+                self.draw(trace, Some(span));
+            }
+        }
+    }
+
+    fn draw(&self, trace: &KernelTrace, focus: Option<&Span>) {
+        let w = self.canvas.get_stride();
+        let h = self.canvas.get_height();
+        if w == 0 || h == 0 {
+            return;
+        }
+        self.canvas.clear(BG);
+        let ncpus = trace.ncpus.max(1) as u32;
+        let lane_h = ((h - 4) / ncpus).clamp(4, LANE_MAX);
+        for cpu in 1..ncpus {
+            let y = (2 + cpu * lane_h) as i32;
+            self.canvas.draw_line(0, y, w as i32, y, LANE_SEP);
+        }
+        let Some(last) = trace.events.last() else { return };
+
+        let window = (WINDOW_US as u128 * trace.cycle_hz.max(1) as u128 / 1_000_000) as u64;
+        let (t0, t1) = match focus {
+            Some(s) => {
+                let pad = window.saturating_sub(s.cycles()) / 2;
+                (s.start.saturating_sub(pad), s.start.saturating_sub(pad) + window.max(s.cycles()))
+            }
+            None => (last.tsc.saturating_sub(window), last.tsc),
+        };
+        let span_cycles = (t1 - t0).max(1) as u128;
+        let x_of = |tsc: u64| ((tsc.clamp(t0, t1) - t0) as u128 * w as u128 / span_cycles) as i32;
+        let lane_y = |cpu: u16| (2 + cpu as u32 * lane_h) as i32;
+
+        // Thread runs: from each switch to the next one on the same CPU
+        let mut running: Vec<Option<(u32, u64)>> = alloc::vec![None; ncpus as usize];
+        let events = trace.window(t0, t1);
+        for ev in events {
+            if ev.event != debug::TRACE_SCHED_SWITCH || ev.cpu as u32 >= ncpus {
+                continue;
+            }
+            let cpu = ev.cpu as usize;
+            let (tid, start) = running[cpu].unwrap_or((ev.arg0 as u32, t0));
+            self.shade(x_of(start), x_of(ev.tsc), lane_y(ev.cpu), lane_h, tid);
+            running[cpu] = Some((ev.arg1 as u32, ev.tsc));
+        }
+        for (cpu, r) in running.iter().enumerate() {
+            if let Some((tid, start)) = *r {
+                self.shade(x_of(start), x_of(t1), lane_y(cpu as u16), lane_h, tid);
+            }
+        }
+
+        // Spans overlapping the window
+        let bar_h = (lane_h / 4).max(2);
+        for span in trace.spans.iter().rev() {
+            if span.end < t0 || span.start > t1 || span.cpu as u32 >= ncpus {
+                continue;
+            }
+            let (color, row) = match span.kind {
+                SpanKind::Irq => (IRQ_COLOR, 0),
+                SpanKind::Syscall => (SYSCALL_COLOR, 1),
+                SpanKind::BlockIo => (BLOCK_COLOR, 2),
+                SpanKind::Wakeup => continue,
+            };
+            let x = x_of(span.start);
+            let bw = (x_of(span.end) - x).max(1) as u32;
+            let y = lane_y(span.cpu) + 1 + (row * bar_h) as i32;
+            self.canvas.fill_rect(x, y, bw, bar_h - 1, color);
+        }
+
+        // Point events
+        for ev in events {
+            let color = match ev.event {
+                debug::TRACE_PAGE_FAULT => FAULT_COLOR,
+                debug::TRACE_TCP_SEND | debug::TRACE_TCP_RECV => TCP_COLOR,
+                _ => continue,
+            };
+            if ev.cpu as u32 >= ncpus {
+                continue;
+            }
+            let x = x_of(ev.tsc);
+            let y = lane_y(ev.cpu) + (3 * bar_h) as i32;
+            self.canvas.draw_line(x, y, x, y + bar_h as i32 - 1, color);
+        }
+
+        if let Some(s) = focus {
+            let x = x_of(s.start);
+            let bw = (x_of(s.end) - x).max(2) as u32;
+            self.canvas.draw_rect(x, lane_y(s.cpu), bw, lane_h, FOCUS_COLOR, 1);
+        }
+    }
+
+    /// Shade a thread run in a lane (a dim color derived from the TID).
+    fn shade(&self, x0: i32, x1: i32, y: i32, lane_h: u32, tid: u32) {
+        if x1 <= x0 {
+            return;
+        }
+        let hash = tid.wrapping_mul(0x9E37_79B9);
+        let r = 0x28 + (hash >> 24 & 0x1F);
+        let g = 0x28 + (hash >> 16 & 0x1F);
+        let b = 0x30 + (hash >> 8 & 0x1F);
+        let color = 0xFF00_0000 | r << 16 | g << 8 | b;
+        self.canvas.fill_rect(x0, y + 1, (x1 - x0) as u32, lane_h - 1, color);
+    }
+}
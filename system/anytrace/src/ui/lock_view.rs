@@ -0,0 +1,55 @@
+//! Kernel lock contention view using DataGrid.
+
+use libanyui_client as ui;
+use ui::Widget;
+use ui::ColumnDef;
+use crate::logic::lock_stats::LockProfile;
+use crate::util::format::{hex64, fmt_u64};
+
+/// Lock profile panel.
+pub struct LockView {
+    pub grid: ui::DataGrid,
+}
+
+impl LockView {
+    /// Create the lock view.
+    pub fn new(_parent: &impl Widget) -> Self {
+        let grid = ui::DataGrid::new(600, 300);
+        grid.set_dock(ui::DOCK_FILL);
+        grid.set_columns(&[
+            ColumnDef::new("Call Site").width(280),
+            ColumnDef::new("Kind").width(60),
+            ColumnDef::new("Lock").width(150),
+            ColumnDef::new("Acquires").width(90),
+            ColumnDef::new("Contended").width(90),
+            ColumnDef::new("Spin (us)").width(90),
+            ColumnDef::new("Avg Hold (us)").width(100),
+            ColumnDef::new("Max Hold (us)").width(100),
+        ]);
+        Self { grid }
+    }
+
+    /// Refresh the site list.
+    pub fn update(&self, profile: &LockProfile) {
+        if !profile.enabled {
+            self.grid.set_row_count(1);
+            self.grid.set_cell(0, 0, "Kernel built without --lock-profile");
+            for col in 1..8 {
+                self.grid.set_cell(0, col, "");
+            }
+            return;
+        }
+        self.grid.set_row_count(profile.sites.len() as u32);
+        for (i, site) in profile.sites.iter().enumerate() {
+            let row = i as u32;
+            self.grid.set_cell(row, 0, &site.site);
+            self.grid.set_cell(row, 1, site.kind);
+            self.grid.set_cell(row, 2, &hex64(site.lock_addr));
+            self.grid.set_cell(row, 3, &fmt_u64(site.acquires));
+            self.grid.set_cell(row, 4, &fmt_u64(site.contended));
+            self.grid.set_cell(row, 5, &fmt_u64(site.spin_us));
+            self.grid.set_cell(row, 6, &fmt_u64(site.avg_hold_us));
+            self.grid.set_cell(row, 7, &fmt_u64(site.max_hold_us));
+        }
+    }
+}
@@ -8,4 +8,6 @@ pub mod timeline_view;
 pub mod output_panel;
 pub mod snapshot_view;
 pub mod trace_view;
+pub mod lock_view;
+pub mod event_timeline_view;
 pub mod status_bar;
@@ -1,4 +1,5 @@
-//! Debug toolbar with attach, suspend, resume, step, and snapshot buttons.
+//! Debug toolbar with attach, suspend, resume, step, snapshot and kernel
+//! event recording buttons.
 
 use libanyui_client as ui;
 use ui::IconType;
@@ -16,6 +17,7 @@ pub struct DebugToolbar {
     pub btn_step_over: ui::IconButton,
     pub btn_step_out: ui::IconButton,
     pub btn_snapshot: ui::IconButton,
+    pub btn_ktrace: ui::IconButton,
 }
 
 impl DebugToolbar {
@@ -79,6 +81,13 @@ impl DebugToolbar {
         btn_snapshot.set_tooltip("Take Snapshot");
         btn_snapshot.set_enabled(false);
 
+        toolbar.add_separator();
+
+        let btn_ktrace = toolbar.add_icon_button("");
+        btn_ktrace.set_size(34, 34);
+        btn_ktrace.set_system_icon("activity", IconType::Outline, tc.text, ICON_SZ);
+        btn_ktrace.set_tooltip("Record Kernel Events");
+
         Self {
             toolbar,
             btn_attach,
@@ -89,6 +98,7 @@ impl DebugToolbar {
             btn_step_over,
             btn_step_out,
             btn_snapshot,
+            btn_ktrace,
         }
     }
 
@@ -103,4 +113,12 @@ impl DebugToolbar {
         self.btn_step_out.set_enabled(attached && suspended);
         self.btn_snapshot.set_enabled(attached && suspended);
     }
+
+    /// Reflect whether kernel events are being recorded.
+    pub fn set_recording(&self, recording: bool) {
+        let tc = ui::theme::colors();
+        let color = if recording { tc.destructive } else { tc.text };
+        self.btn_ktrace.set_system_icon("activity", IconType::Outline, color, ICON_SZ);
+        self.btn_ktrace.set_tooltip(if recording { "Stop Recording Kernel Events" } else { "Record Kernel Events" });
+    }
 }
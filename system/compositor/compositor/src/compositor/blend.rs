@@ -1,4 +1,4 @@
-//! Color blending, blur, and shadow cache computation.
+//! Color blending, blur, and shadow/blur cache computation.
 //!
 //! Performance-critical: all hot-path divisions replaced with `div255()`
 //! bit trick (exact for 0..=65025, which covers all 255*255 products).
@@ -6,7 +6,9 @@
 use alloc::vec;
 use alloc::vec::Vec;
 
-use super::layer::{ShadowCache, shadow_spread, SHADOW_ALPHA_FOCUSED, SHADOW_ALPHA_UNFOCUSED};
+use super::layer::{BlurCache, BLUR_PASSES, ShadowCache, shadow_spread, SHADOW_ALPHA_FOCUSED, SHADOW_ALPHA_UNFOCUSED};
+use super::rect::Rect;
+use super::simd::{blur_h_row, blur_v_pass, MAX_BLUR_LANES};
 
 /// Fast exact division by 255 using bit manipulation.
 /// Exact for all x in 0..=65025 (255*255), which covers every possible
@@ -173,6 +175,7 @@ pub(crate) fn compute_shadow_cache(layer_w: u32, layer_h: u32) -> ShadowCache {
 /// Fast two-pass (H+V) box blur on a rectangular region of a pixel buffer.
 /// `passes` iterations: 1=box, 2=triangle, 3~=gaussian.
 /// `temp` is a reusable scratch buffer (avoids per-call heap allocation).
+/// Each pass runs through the SIMD row kernels (`simd.rs`).
 pub(crate) fn blur_back_buffer_region(
     bb: &mut [u32], fb_w: u32, fb_h: u32,
     rx: i32, ry: i32, rw: u32, rh: u32,
@@ -195,68 +198,216 @@ pub(crate) fn blur_back_buffer_region(
     // Max input: 255 * kernel. For kernel=17: 255*17=4335, 4335*recip=16,711,425 < u32::MAX.
     let recip = ((1u32 << 16) + kernel - 1) / kernel;
 
-    let max_dim = w.max(h);
-    if temp.len() < max_dim {
-        temp.resize(max_dim, 0);
+    // Vertical kernels buffer a group of up to MAX_BLUR_LANES columns.
+    let need = w.max(h * MAX_BLUR_LANES);
+    if temp.len() < need {
+        temp.resize(need, 0);
     }
 
     for _ in 0..passes {
         // Horizontal pass
         for row in y0..y1 {
             let row_off = row * stride;
-            let (mut sr, mut sg, mut sb) = (0u32, 0u32, 0u32);
-            for i in 0..=(2 * r) {
-                let sx = (x0 as i32 + i as i32 - r as i32).max(0).min(fb_w as i32 - 1) as usize;
-                let px = bb[row_off + sx];
-                sr += (px >> 16) & 0xFF;
-                sg += (px >> 8) & 0xFF;
-                sb += px & 0xFF;
-            }
-            for col in 0..w {
-                let cx = x0 + col;
-                temp[col] = 0xFF000000
-                    | (((sr * recip) >> 16) << 16)
-                    | (((sg * recip) >> 16) << 8)
-                    | ((sb * recip) >> 16);
-                let add_x = (cx as i32 + r as i32 + 1).min(fb_w as i32 - 1).max(0) as usize;
-                let rem_x = (cx as i32 - r as i32).max(0).min(fb_w as i32 - 1) as usize;
-                let add_px = bb[row_off + add_x];
-                let rem_px = bb[row_off + rem_x];
-                sr += ((add_px >> 16) & 0xFF) - ((rem_px >> 16) & 0xFF);
-                sg += ((add_px >> 8) & 0xFF) - ((rem_px >> 8) & 0xFF);
-                sb += (add_px & 0xFF) - (rem_px & 0xFF);
-            }
-            for col in 0..w {
-                bb[row_off + x0 + col] = temp[col];
-            }
+            blur_h_row(&bb[row_off..row_off + stride], x0, w, r, recip, temp);
+            bb[row_off + x0..row_off + x1].copy_from_slice(&temp[..w]);
         }
         // Vertical pass
-        for col in x0..x1 {
+        blur_v_pass(bb, stride, fb_h as usize, x0, x1, y0, h, r, recip, temp);
+    }
+}
+
+/// Recapture the downsampled background of `rect` (screen coordinates,
+/// whole tiles) from the back buffer into `cache.source`.  The back buffer
+/// must hold the layers below the blur layer in that region.
+pub(crate) fn capture_blur_source(cache: &mut BlurCache, bb: &[u32], fb_w: u32, rect: &Rect) {
+    let r = match rect.intersect(&cache.area) {
+        Some(r) => r,
+        None => return,
+    };
+    let s = cache.scale as i32;
+    let (ax, ay) = (cache.area.x, cache.area.y);
+    let (area_r, area_b) = (cache.area.right(), cache.area.bottom());
+    let stride = fb_w as usize;
+    let lw = cache.lr_w as usize;
+    let gx0 = ((r.x - ax) / s) as usize;
+    let gx1 = ((r.right() - ax + s - 1) / s) as usize;
+    let gy0 = ((r.y - ay) / s) as usize;
+    let gy1 = ((r.bottom() - ay + s - 1) / s) as usize;
+
+    if s == 1 {
+        for gy in gy0..gy1 {
+            let src = (ay as usize + gy) * stride + ax as usize;
+            cache.source[gy * lw + gx0..gy * lw + gx1].copy_from_slice(&bb[src + gx0..src + gx1]);
+        }
+        return;
+    }
+    for gy in gy0..gy1 {
+        let y0 = ay + gy as i32 * s;
+        let y1 = (y0 + s).min(area_b);
+        for gx in gx0..gx1 {
+            let x0 = ax + gx as i32 * s;
+            let x1 = (x0 + s).min(area_r);
             let (mut sr, mut sg, mut sb) = (0u32, 0u32, 0u32);
-            for i in 0..=(2 * r) {
-                let sy = (y0 as i32 + i as i32 - r as i32).max(0).min(fb_h as i32 - 1) as usize;
-                let px = bb[sy * stride + col];
-                sr += (px >> 16) & 0xFF;
-                sg += (px >> 8) & 0xFF;
-                sb += px & 0xFF;
-            }
-            for row in 0..h {
-                let cy = y0 + row;
-                temp[row] = 0xFF000000
-                    | (((sr * recip) >> 16) << 16)
-                    | (((sg * recip) >> 16) << 8)
-                    | ((sb * recip) >> 16);
-                let add_y = (cy as i32 + r as i32 + 1).min(fb_h as i32 - 1).max(0) as usize;
-                let rem_y = (cy as i32 - r as i32).max(0).min(fb_h as i32 - 1) as usize;
-                let add_px = bb[add_y * stride + col];
-                let rem_px = bb[rem_y * stride + col];
-                sr += ((add_px >> 16) & 0xFF) - ((rem_px >> 16) & 0xFF);
-                sg += ((add_px >> 8) & 0xFF) - ((rem_px >> 8) & 0xFF);
-                sb += (add_px & 0xFF) - (rem_px & 0xFF);
-            }
-            for row in 0..h {
-                bb[(y0 + row) * stride + col] = temp[row];
+            for y in y0..y1 {
+                let row = &bb[y as usize * stride..][x0 as usize..x1 as usize];
+                for &px in row {
+                    sr += (px >> 16) & 0xFF;
+                    sg += (px >> 8) & 0xFF;
+                    sb += px & 0xFF;
+                }
             }
+            let n = ((x1 - x0) * (y1 - y0)) as u32;
+            cache.source[gy * lw + gx] = 0xFF000000 | ((sr / n) << 16) | ((sg / n) << 8) | (sb / n);
         }
     }
 }
+
+/// Reblur the low-res pixels of `cache` affected by source changes inside
+/// `changed` (screen coordinates).  Only the changed pixels plus the blur
+/// reach are rewritten; the pass reads a further reach of source around
+/// them, so the result equals blurring the whole cache.
+pub(crate) fn reblur_cache(cache: &mut BlurCache, changed: &Rect, work: &mut Vec<u32>, temp: &mut Vec<u32>) {
+    let d = match changed.intersect(&cache.area) {
+        Some(d) => d,
+        None => return,
+    };
+    let s = cache.scale as i32;
+    let (lw, lh) = (cache.lr_w as usize, cache.lr_h as usize);
+    let reach = (BLUR_PASSES * cache.lr_radius) as usize;
+    let gx0 = ((d.x - cache.area.x) / s) as usize;
+    let gx1 = (((d.right() - cache.area.x + s - 1) / s) as usize).min(lw);
+    let gy0 = ((d.y - cache.area.y) / s) as usize;
+    let gy1 = (((d.bottom() - cache.area.y + s - 1) / s) as usize).min(lh);
+    let (ox0, ox1) = (gx0.saturating_sub(reach), (gx1 + reach).min(lw));
+    let (oy0, oy1) = (gy0.saturating_sub(reach), (gy1 + reach).min(lh));
+    let (ix0, ix1) = (ox0.saturating_sub(reach), (ox1 + reach).min(lw));
+    let (iy0, iy1) = (oy0.saturating_sub(reach), (oy1 + reach).min(lh));
+    let (iw, ih) = (ix1 - ix0, iy1 - iy0);
+
+    if work.len() < iw * ih {
+        work.resize(iw * ih, 0);
+    }
+    let work = &mut work[..iw * ih];
+    for y in iy0..iy1 {
+        work[(y - iy0) * iw..][..iw].copy_from_slice(&cache.source[y * lw + ix0..y * lw + ix1]);
+    }
+    blur_back_buffer_region(
+        work, iw as u32, ih as u32,
+        0, 0, iw as u32, ih as u32,
+        cache.lr_radius, BLUR_PASSES,
+        temp,
+    );
+    let ow = ox1 - ox0;
+    for y in oy0..oy1 {
+        let src = (y - iy0) * iw + (ox0 - ix0);
+        cache.blurred[y * lw + ox0..][..ow].copy_from_slice(&work[src..src + ow]);
+    }
+}
+
+/// Per-channel linear interpolation of two opaque pixels, `t` in 0..=256.
+#[inline(always)]
+fn lerp_px(a: u32, b: u32, t: u32) -> u32 {
+    let u = 256 - t;
+    let rb = (((a & 0xFF00FF) * u + (b & 0xFF00FF) * t) >> 8) & 0xFF00FF;
+    let g = ((((a >> 8) & 0xFF) * u + ((b >> 8) & 0xFF) * t) >> 8) & 0xFF;
+    0xFF000000 | rb | (g << 8)
+}
+
+/// Low-res neighbors and 8-bit weight for full-res coordinate `p` (relative
+/// to the cache origin) on an axis of `n` low-res pixels.
+#[inline(always)]
+fn blur_sample(p: u32, scale: u32, n: usize) -> (usize, usize, u32) {
+    // Pixel centers: low-res position (p + 0.5) / scale - 0.5, as 24.8.
+    let f = ((2 * p + 1) * 128 / scale) as i32 - 128;
+    if f <= 0 {
+        return (0, 0, 0);
+    }
+    let i = (f >> 8) as usize;
+    if i + 1 >= n {
+        return (n - 1, n - 1, 0);
+    }
+    (i, i + 1, (f & 0xFF) as u32)
+}
+
+/// Upscale one row of the cached blur into `out`, which covers screen
+/// pixels `x..x + out.len()` of row `y` (inside `cache.area`).
+pub(crate) fn blur_cache_row(cache: &BlurCache, x: i32, y: i32, out: &mut [u32]) {
+    let lw = cache.lr_w as usize;
+    let lx = (x - cache.area.x) as u32;
+    let ly = (y - cache.area.y) as u32;
+    if cache.scale == 1 {
+        let off = ly as usize * lw + lx as usize;
+        out.copy_from_slice(&cache.blurred[off..off + out.len()]);
+        return;
+    }
+    let (r0, r1, fy) = blur_sample(ly, cache.scale, cache.lr_h as usize);
+    let row0 = &cache.blurred[r0 * lw..][..lw];
+    let row1 = &cache.blurred[r1 * lw..][..lw];
+    for (k, px) in out.iter_mut().enumerate() {
+        let (c0, c1, fx) = blur_sample(lx + k as u32, cache.scale, lw);
+        let top = lerp_px(row0[c0], row0[c1], fx);
+        let bottom = lerp_px(row1[c0], row1[c1], fx);
+        *px = lerp_px(top, bottom, fy);
+    }
+}
+
+/// Scalar reference for one horizontal blur row: box sum over `row`
+/// (one full framebuffer row, clamped at its ends) for `x0..x0+w`.
+pub(crate) fn blur_h_row_scalar(row: &[u32], x0: usize, w: usize, r: usize, recip: u32, out: &mut [u32]) {
+    let fb_w = row.len() as i32;
+    let (mut sr, mut sg, mut sb) = (0u32, 0u32, 0u32);
+    for i in 0..=(2 * r) {
+        let sx = (x0 as i32 + i as i32 - r as i32).max(0).min(fb_w - 1) as usize;
+        let px = row[sx];
+        sr += (px >> 16) & 0xFF;
+        sg += (px >> 8) & 0xFF;
+        sb += px & 0xFF;
+    }
+    for col in 0..w {
+        let cx = x0 + col;
+        out[col] = 0xFF000000
+            | (((sr * recip) >> 16) << 16)
+            | (((sg * recip) >> 16) << 8)
+            | ((sb * recip) >> 16);
+        let add_x = (cx as i32 + r as i32 + 1).min(fb_w - 1).max(0) as usize;
+        let rem_x = (cx as i32 - r as i32).max(0).min(fb_w - 1) as usize;
+        let add_px = row[add_x];
+        let rem_px = row[rem_x];
+        sr = sr.wrapping_add(((add_px >> 16) & 0xFF).wrapping_sub((rem_px >> 16) & 0xFF));
+        sg = sg.wrapping_add(((add_px >> 8) & 0xFF).wrapping_sub((rem_px >> 8) & 0xFF));
+        sb = sb.wrapping_add((add_px & 0xFF).wrapping_sub(rem_px & 0xFF));
+    }
+}
+
+/// Scalar reference for one vertical blur column, in place (rows `y0..y0+h`).
+pub(crate) fn blur_v_column_scalar(
+    bb: &mut [u32], stride: usize, fb_h: usize, col: usize,
+    y0: usize, h: usize, r: usize, recip: u32, temp: &mut [u32],
+) {
+    let fb_h = fb_h as i32;
+    let (mut sr, mut sg, mut sb) = (0u32, 0u32, 0u32);
+    for i in 0..=(2 * r) {
+        let sy = (y0 as i32 + i as i32 - r as i32).max(0).min(fb_h - 1) as usize;
+        let px = bb[sy * stride + col];
+        sr += (px >> 16) & 0xFF;
+        sg += (px >> 8) & 0xFF;
+        sb += px & 0xFF;
+    }
+    for row in 0..h {
+        let cy = y0 + row;
+        temp[row] = 0xFF000000
+            | (((sr * recip) >> 16) << 16)
+            | (((sg * recip) >> 16) << 8)
+            | ((sb * recip) >> 16);
+        let add_y = (cy as i32 + r as i32 + 1).min(fb_h - 1).max(0) as usize;
+        let rem_y = (cy as i32 - r as i32).max(0).min(fb_h - 1) as usize;
+        let add_px = bb[add_y * stride + col];
+        let rem_px = bb[rem_y * stride + col];
+        sr = sr.wrapping_add(((add_px >> 16) & 0xFF).wrapping_sub((rem_px >> 16) & 0xFF));
+        sg = sg.wrapping_add(((add_px >> 8) & 0xFF).wrapping_sub((rem_px >> 8) & 0xFF));
+        sb = sb.wrapping_add((add_px & 0xFF).wrapping_sub(rem_px & 0xFF));
+    }
+    for row in 0..h {
+        bb[(y0 + row) * stride + col] = temp[row];
+    }
+}
@@ -3,49 +3,82 @@
 //! Performance-critical hot path. Key optimizations:
 //!   - div255() bit trick replaces all `/ 255` divisions (~10x faster per blend)
 //!   - shadow_blend() specialized for R=G=B=0 (halves multiplies)
+//!   - SSE4.1/AVX2/NEON row kernels (simd.rs) for blend, shadow, copy and blur
 //!   - Blur uses fixed-point reciprocal instead of `/ kernel`
 //!   - Reusable scratch buffers (no per-frame heap allocations)
-//!   - Transparent-run scanning in alpha-blend path
+//!   - 64×64 tile damage grid merged into row spans (damage.rs)
+//!   - Transparent/opaque pixel groups skipped or copied in the blend kernel
 //!   - fill() for background clear (LLVM vectorizes to rep stosd)
+//!   - Large damage rects composited as parallel bands on the thread pool
+//!   - Fullscreen VRAM surfaces scanned out directly (scanout.rs)
+//!   - Blur-behind backgrounds cached at reduced resolution per layer and
+//!     refreshed only for tiles whose underlying content changed
 
 use super::Compositor;
+use super::metrics::FrameCounters;
 use super::rect::Rect;
-use super::layer::{AccelMoveHint, SHADOW_OFFSET_X, shadow_offset_y, shadow_spread};
-use super::blend::{alpha_blend, shadow_blend, compute_shadow_cache, blur_back_buffer_region};
-use super::gpu::{GPU_UPDATE, GPU_FLIP, GPU_RECT_COPY, GPU_SYNC};
+use super::layer::{AccelMoveHint, BlurCache, SHADOW_OFFSET_X, shadow_offset_y, shadow_spread};
+use super::blend::{blur_cache_row, capture_blur_source, compute_shadow_cache, reblur_cache};
+use super::simd::{blend_row, copy_row, shadow_row};
+use super::gpu::{GPU_UPDATE, GPU_FLIP, GPU_RECT_COPY};
+use alloc::vec::Vec;
+
+/// Damage rects smaller than this (pixels) are composited on the render thread.
+const PARALLEL_MIN_PIXELS: usize = 256 * 256;
+/// Minimum height of one parallel band.
+const MIN_BAND_ROWS: usize = 32;
+
+/// Shares the compositor read-only with pool workers during a banded pass.
+/// Layer pixel pointers and `fb_ptr` are only read while the render thread
+/// waits in `pool::scope`.
+#[derive(Clone, Copy)]
+struct SharedCompositor<'a>(&'a Compositor);
+unsafe impl Send for SharedCompositor<'_> {}
+unsafe impl Sync for SharedCompositor<'_> {}
+
+impl<'a> SharedCompositor<'a> {
+    fn get(self) -> &'a Compositor {
+        self.0
+    }
+}
 
 impl Compositor {
     /// Collect damage from all dirty layers.
     /// Any dirty layer (visible or invisible) gets its bounds added as damage.
     /// This ensures that resized, moved, or content-updated layers always
-    /// trigger recomposition of their region.
+    /// trigger recomposition of their region.  Only blur caches of layers
+    /// above a dirty layer are invalidated by it.
     fn collect_dirty_damage(&mut self) {
         for i in 0..self.layers.len() {
             if self.layers[i].dirty {
-                self.damage.push(self.layers[i].damage_bounds());
+                let bounds = self.layers[i].damage_bounds();
+                self.push_damage_above(bounds, i + 1);
                 self.layers[i].dirty = false;
             }
         }
     }
 
-    /// Merge damage rects if there are too many (prevents performance explosion).
-    fn merge_damage_if_needed(&mut self) {
-        if self.damage.len() > 128 {
-            let merged = self.damage.iter().copied().reduce(|a, b| a.union(&b));
-            self.damage.clear();
-            if let Some(r) = merged {
-                let clipped = r.clip_to_screen(self.fb_width, self.fb_height);
-                if !clipped.is_empty() {
-                    self.damage.push(clipped);
-                }
-            }
-        }
+    /// Add the area of this frame's damage rects to the frame counters.
+    pub(crate) fn count_damaged_pixels(&self) {
+        let px: u64 = self.compositing_damage.iter()
+            .map(|r| r.width as u64 * r.height as u64)
+            .sum();
+        self.counters.damaged_px.fetch_add(px, core::sync::atomic::Ordering::Relaxed);
     }
 
     /// Main compositing function. Composites all dirty regions.
     /// Returns `true` if any damage was processed (screen content changed).
     pub fn compose(&mut self) -> bool {
         self.collect_dirty_damage();
+        if self.update_direct_scanout() {
+            return self.compose_scanout();
+        }
+        if self.gmr_active {
+            // The GPU DMAs from the back buffer: let the previous frame's
+            // transfers finish before compositing over it.
+            self.wait_gpu(self.frame_fence);
+        }
+        let blur_refreshed = self.refresh_blur_caches();
 
         // Check for GPU-accelerated RECT_COPY path (window drag optimization)
         let hint = self.accel_move_hint.take();
@@ -54,23 +87,9 @@ impl Compositor {
             return false;
         }
 
-        self.merge_damage_if_needed();
-
-        // Clip all damage to screen bounds in-place, remove empty rects
-        let fb_w = self.fb_width;
-        let fb_h = self.fb_height;
-        for r in &mut self.damage {
-            *r = r.clip_to_screen(fb_w, fb_h);
-        }
-        self.damage.retain(|r| !r.is_empty());
-
-        if self.damage.is_empty() {
-            return false;
-        }
-
-        // Swap damage into compositing_damage (avoids drain+collect heap allocation).
-        // self.damage keeps its capacity for next frame's pushes.
-        core::mem::swap(&mut self.damage, &mut self.compositing_damage);
+        // Merge dirty tiles into row spans (compositing_damage is empty between frames)
+        self.damage.drain_into(&mut self.compositing_damage);
+        self.count_damaged_pixels();
 
         // Try GPU RECT_COPY fast path for window drags (requires gpu_accel + valid hint).
         // Works for both opaque and non-opaque layers (decorated windows with rounded corners).
@@ -78,7 +97,9 @@ impl Compositor {
         // Disabled in GMR mode: RECT_COPY operates on the back buffer (registered as GPU
         // framebuffer), which corrupts freshly composited content. Since flush_region is
         // already a no-op in GMR mode, there's no VRAM memcpy cost to optimize away.
-        if self.gpu_accel && !self.hw_double_buffer && !self.gmr_active {
+        // Skipped when blur caches were refreshed: their stale tiles hold
+        // partial compositions that only the full damage pass overwrites.
+        if self.gpu_accel && !self.hw_double_buffer && !self.gmr_active && !blur_refreshed {
             if let Some(ref h) = hint {
                 if let Some(moved_idx) = self.layer_index(h.layer_id) {
                     let layer = &self.layers[moved_idx];
@@ -90,17 +111,19 @@ impl Compositor {
             }
         }
 
-        // Standard SW compositing path
+        // Standard SW compositing path; large rects are split into bands
+        let top = self.layers.len();
         let damage_len = self.compositing_damage.len();
         for i in 0..damage_len {
             let rect = self.compositing_damage[i];
-            self.composite_rect(&rect);
+            self.composite_damage_rect(&rect, top);
         }
 
         if let Some(outline) = self.resize_outline {
             self.draw_outline_to_bb(&outline);
         }
 
+        let flush_start = anyos_std::sys::monotonic_ns();
         if self.hw_double_buffer {
             let back_offset = if self.current_page == 0 {
                 self.fb_height
@@ -130,10 +153,16 @@ impl Compositor {
                 self.gpu_cmds
                     .push([GPU_UPDATE, r.x as u32, r.y as u32, r.width, r.height, 0, 0, 0, 0]);
             }
-            self.compositing_damage.clear();
         }
 
-        self.flush_gpu();
+        self.frame_fence = self.flush_gpu();
+        FrameCounters::add_since(&self.counters.flush_ns, flush_start);
+        if self.hw_double_buffer {
+            self.damage.publish(&self.prev_damage);
+        } else {
+            self.damage.publish(&self.compositing_damage);
+            self.compositing_damage.clear();
+        }
         true
     }
 
@@ -149,12 +178,13 @@ impl Compositor {
 
         let exposed = super::layer::subtract_rects(&old_b, &new_b);
 
+        let top = self.layers.len();
         for rect in &exposed {
             if !rect.is_empty() {
-                self.composite_rect(rect);
+                self.composite_rect(rect, top);
             }
         }
-        self.composite_rect(&new_b);
+        self.composite_rect(&new_b, top);
 
         if let Some(outline) = self.resize_outline {
             self.draw_outline_to_bb(&outline);
@@ -170,8 +200,8 @@ impl Compositor {
             new_b.height,
             0, 0,
         ]);
-        self.gpu_cmds.push([GPU_SYNC, 0, 0, 0, 0, 0, 0, 0, 0]);
-        self.flush_gpu();
+        let flush_start = anyos_std::sys::monotonic_ns();
+        self.sync_gpu();
 
         for rect in &exposed {
             if !rect.is_empty() {
@@ -238,12 +268,154 @@ impl Compositor {
             0, 0, 0, 0,
         ]);
 
+        self.frame_fence = self.flush_gpu();
+        FrameCounters::add_since(&self.counters.flush_ns, flush_start);
+        self.damage.publish(&self.compositing_damage);
         self.compositing_damage.clear();
-        self.flush_gpu();
     }
 
-    /// Composite all layers within a damage rect into the back buffer.
-    fn composite_rect(&mut self, rect: &Rect) {
+    /// Composite layers `..top` within a damage rect into the back buffer,
+    /// as parallel bands when the rect is large.
+    fn composite_damage_rect(&mut self, rect: &Rect, top: usize) {
+        let threads = self.render_threads();
+        if threads > 1 && rect.width as usize * rect.height as usize >= PARALLEL_MIN_PIXELS {
+            self.composite_rect_parallel(rect, threads, top);
+        } else {
+            self.composite_rect(rect, top);
+        }
+    }
+
+    /// Composite layers `..top` within a damage rect into the back buffer.
+    fn composite_rect(&mut self, rect: &Rect, top: usize) {
+        self.prepare_shadow_caches(rect);
+        let mut bb = core::mem::take(&mut self.back_buffer);
+        self.composite_rect_into(rect, &mut bb, 0, top);
+        self.back_buffer = bb;
+    }
+
+    /// Composite a large damage rect as horizontal bands on the thread pool.
+    /// Every band writes a disjoint row range of the back buffer; the call
+    /// returns only after all bands are done, so flushes and `GPU_FLIP`
+    /// still follow the complete frame.
+    fn composite_rect_parallel(&mut self, rect: &Rect, threads: usize, top: usize) {
+        let bands = threads.min(rect.height as usize / MIN_BAND_ROWS).max(1);
+        if bands < 2 {
+            self.composite_rect(rect, top);
+            return;
+        }
+        self.prepare_shadow_caches(rect);
+        let stride = self.fb_width as usize;
+        let band_h = (rect.height as usize).div_ceil(bands);
+        let mut bb = core::mem::take(&mut self.back_buffer);
+        {
+            let mut jobs: Vec<(Rect, &mut [u32], usize)> = Vec::with_capacity(bands);
+            let mut y = rect.y as usize;
+            let bottom = rect.bottom() as usize;
+            let (_, mut rest) = bb.split_at_mut(y * stride);
+            while y < bottom {
+                let rows = band_h.min(bottom - y);
+                let len = (rows * stride).min(rest.len());
+                let (band, tail) = core::mem::take(&mut rest).split_at_mut(len);
+                rest = tail;
+                jobs.push((Rect::new(rect.x, y as i32, rect.width, rows as u32), band, y * stride));
+                y += rows;
+            }
+            let shared = SharedCompositor(self);
+            anyos_std::pool::scope(|s| {
+                for (band_rect, band, base) in jobs {
+                    s.spawn(move |_| shared.get().composite_rect_into(&band_rect, band, base, top));
+                }
+            });
+        }
+        self.back_buffer = bb;
+    }
+
+    /// Bring the blur cache of every visible blur-behind layer up to date
+    /// before the frame is composited, bottom layer first so a blur layer's
+    /// background can include the cached blur of one below it.
+    ///
+    /// Stale tiles get the layers below composited into the back buffer and
+    /// downsampled into the cache; the region within blur reach of them is
+    /// reblurred at low resolution.  Those tiles are part of this frame's
+    /// damage (`push_damage_above`), so the main pass overwrites them.
+    /// Returns whether any cache was refreshed.
+    fn refresh_blur_caches(&mut self) -> bool {
+        let mut refreshed = false;
+        for li in 0..self.layers.len() {
+            let layer = &self.layers[li];
+            if !layer.blur_behind || layer.blur_radius == 0 {
+                if layer.blur_cache.is_some() {
+                    self.layers[li].blur_cache = None;
+                }
+                continue;
+            }
+            if !layer.visible {
+                continue;
+            }
+            let area = BlurCache::area_for(&layer.bounds(), self.fb_width, self.fb_height);
+            if area.is_empty() {
+                continue;
+            }
+            let radius = layer.blur_radius;
+            let current = matches!(&layer.blur_cache, Some(c) if c.area == area && c.radius == radius);
+            if !current {
+                // Moved, resized, new radius or first frame: rebuild it all.
+                let bounds = layer.bounds();
+                self.layers[li].blur_cache = Some(BlurCache::new(area, radius));
+                self.damage.push(bounds);
+            }
+            let mut cache = match self.layers[li].blur_cache.take() {
+                Some(c) => c,
+                None => continue,
+            };
+            if cache.has_stale() {
+                let blur_start = anyos_std::sys::monotonic_ns();
+                let mut stale = core::mem::take(&mut self.blur_stale);
+                cache.drain_stale(&mut stale);
+                let mut changed = Rect::new(0, 0, 0, 0);
+                for r in &stale {
+                    if let Some(r) = r.intersect(&area) {
+                        self.composite_damage_rect(&r, li);
+                        capture_blur_source(&mut cache, &self.back_buffer, self.fb_width, &r);
+                        changed = changed.union(&r);
+                    }
+                }
+                reblur_cache(&mut cache, &changed, &mut self.blur_work, &mut self.blur_temp);
+                stale.clear();
+                self.blur_stale = stale;
+                refreshed = true;
+                FrameCounters::add_since(&self.counters.blur_ns, blur_start);
+            }
+            self.layers[li].blur_cache = Some(cache);
+        }
+        refreshed
+    }
+
+    /// Make sure every shadowed layer touching `rect` has an up-to-date
+    /// shadow cache (the compositing pass itself only reads layers).
+    fn prepare_shadow_caches(&mut self, rect: &Rect) {
+        for li in 0..self.layers.len() {
+            let layer = &self.layers[li];
+            if !layer.visible || !layer.has_shadow || rect.intersect(&layer.damage_bounds()).is_none() {
+                continue;
+            }
+            let (w, h) = (layer.width, layer.height);
+            let needs_recompute = match &layer.shadow_cache {
+                Some(c) => c.layer_w != w || c.layer_h != h,
+                None => true,
+            };
+            if needs_recompute {
+                let start = anyos_std::sys::monotonic_ns();
+                self.layers[li].shadow_cache = Some(compute_shadow_cache(w, h));
+                FrameCounters::add_since(&self.counters.shadow_ns, start);
+            }
+        }
+    }
+
+    /// Composite layers `..top` within `rect` into `bb`, which holds the back
+    /// buffer from pixel offset `bb_base` on (the rows of `rect` at least).
+    /// Blur-behind layers read their cached background (`refresh_blur_caches`).
+    fn composite_rect_into(&self, rect: &Rect, bb: &mut [u32], bb_base: usize, top: usize) {
         let bb_stride = self.fb_width as usize;
         let rx = rect.x as usize;
         let ry = rect.y as usize;
@@ -258,7 +430,7 @@ impl Compositor {
         let mut skip_bg_clear = false;
         const CORNER_RADIUS: i32 = 8;
 
-        for li in (0..self.layers.len()).rev() {
+        for li in (0..top).rev() {
             if !self.layers[li].visible { continue; }
             let bounds = self.layers[li].bounds();
             if self.layers[li].opaque {
@@ -282,6 +454,11 @@ impl Compositor {
             }
         }
 
+        if base_layer_idx > 0 {
+            let skipped = self.layers[..base_layer_idx].iter().filter(|l| l.visible).count();
+            FrameCounters::add(&self.counters.occlusion_skips, skipped as u32);
+        }
+
         // Background fill — uses fill() which LLVM compiles to rep stosd (vectorized)
         if !skip_bg_clear {
             for row in 0..rh {
@@ -289,16 +466,19 @@ impl Compositor {
                 if y >= self.fb_height as usize {
                     break;
                 }
-                let off = y * bb_stride + rx;
-                let end = (off + rw).min(self.back_buffer.len());
-                self.back_buffer[off..end].fill(0xFF1E1E1E);
+                let off = y * bb_stride + rx - bb_base;
+                if off >= bb.len() {
+                    break;
+                }
+                let end = (off + rw).min(bb.len());
+                bb[off..end].fill(0xFF1E1E1E);
             }
         }
 
         // Composite layers from base upward (skip everything below)
         let pitch_stride = (self.fb_pitch / 4) as usize;
 
-        for li in base_layer_idx..self.layers.len() {
+        for li in base_layer_idx..top {
             if !self.layers[li].visible {
                 continue;
             }
@@ -308,28 +488,33 @@ impl Compositor {
             if rect.intersect(&layer_damage).is_none() {
                 continue;
             }
+            FrameCounters::add(&self.counters.layers_visited, 1);
 
             // Draw shadow before the layer itself
             let has_shadow = self.layers[li].has_shadow;
             if has_shadow {
-                self.draw_shadow_to_bb(rect, li);
+                let start = anyos_std::sys::monotonic_ns();
+                self.draw_shadow_to_bb(rect, li, bb, bb_base);
+                FrameCounters::add_since(&self.counters.shadow_ns, start);
             }
 
-            // Blur the back buffer behind this layer (frosted glass effect)
-            let blur_behind = self.layers[li].blur_behind;
-            let blur_radius = self.layers[li].blur_radius;
-            if blur_behind && blur_radius > 0 {
-                let lb = self.layers[li].bounds();
-                if let Some(blur_area) = rect.intersect(&lb) {
-                    // Split borrow: take blur_temp out to avoid &mut self conflict
-                    let mut blur_temp = core::mem::take(&mut self.blur_temp);
-                    blur_back_buffer_region(
-                        &mut self.back_buffer, self.fb_width, self.fb_height,
-                        blur_area.x, blur_area.y, blur_area.width, blur_area.height,
-                        blur_radius, 2,
-                        &mut blur_temp,
-                    );
-                    self.blur_temp = blur_temp;
+            // Blurred background behind this layer (frosted glass effect)
+            if self.layers[li].blur_behind && self.layers[li].blur_radius > 0 {
+                if let Some(cache) = self.layers[li].blur_cache.as_ref() {
+                    let start = anyos_std::sys::monotonic_ns();
+                    let lb = self.layers[li].bounds();
+                    if let Some(area) = rect.intersect(&lb).and_then(|a| a.intersect(&cache.area)) {
+                        for row in 0..area.height as usize {
+                            let y = area.y as usize + row;
+                            let off = y * bb_stride + area.x as usize - bb_base;
+                            let end = off + area.width as usize;
+                            if end > bb.len() {
+                                break;
+                            }
+                            blur_cache_row(cache, area.x, y as i32, &mut bb[off..end]);
+                        }
+                    }
+                    FrameCounters::add_since(&self.counters.blur_ns, start);
                 }
             }
 
@@ -360,71 +545,34 @@ impl Compositor {
                     for row in 0..overlap.height as usize {
                         let src_off = (sy + row) * lw + sx;
                         let dst_off =
-                            (overlap.y as usize + row) * bb_stride + overlap.x as usize;
+                            (overlap.y as usize + row) * bb_stride + overlap.x as usize - bb_base;
                         let w = overlap.width as usize;
                         let src_end = (src_off + w).min(lp_len);
-                        let dst_end = (dst_off + w).min(self.back_buffer.len());
+                        let dst_end = (dst_off + w).min(bb.len());
+                        if src_off >= src_end || dst_off >= dst_end {
+                            break;
+                        }
                         let copy_w = (src_end - src_off).min(dst_end - dst_off);
-                        self.back_buffer[dst_off..dst_off + copy_w]
-                            .copy_from_slice(&layer_pixels[src_off..src_off + copy_w]);
+                        copy_row(
+                            &mut bb[dst_off..dst_off + copy_w],
+                            &layer_pixels[src_off..src_off + copy_w],
+                        );
                     }
                 } else {
-                    // Alpha-blend path with opaque-run + transparent-run scanning.
+                    // Alpha-blend path: the row kernel skips transparent and
+                    // copies opaque pixel groups itself.
                     for row in 0..overlap.height as usize {
                         let src_off = (sy + row) * lw + sx;
                         let dst_off =
-                            (overlap.y as usize + row) * bb_stride + overlap.x as usize;
-                        let row_width = overlap.width as usize;
-                        let mut col = 0usize;
-                        while col < row_width {
-                            let si = src_off + col;
-                            if si >= lp_len {
-                                break;
-                            }
-                            let src_px = layer_pixels[si];
-                            let a = src_px >> 24;
-                            if a >= 255 {
-                                // Scan ahead for contiguous opaque run
-                                let run_start = col;
-                                col += 1;
-                                while col < row_width {
-                                    let si2 = src_off + col;
-                                    if si2 >= lp_len {
-                                        break;
-                                    }
-                                    if layer_pixels[si2] >> 24 < 255 {
-                                        break;
-                                    }
-                                    col += 1;
-                                }
-                                // Bulk copy the opaque run
-                                let run_len = col - run_start;
-                                let ss = src_off + run_start;
-                                let ds = dst_off + run_start;
-                                let safe = run_len
-                                    .min(lp_len.saturating_sub(ss))
-                                    .min(self.back_buffer.len().saturating_sub(ds));
-                                if safe > 0 {
-                                    self.back_buffer[ds..ds + safe]
-                                        .copy_from_slice(&layer_pixels[ss..ss + safe]);
-                                }
-                            } else if a > 0 {
-                                let di = dst_off + col;
-                                if di < self.back_buffer.len() {
-                                    self.back_buffer[di] =
-                                        alpha_blend(src_px, self.back_buffer[di]);
-                                }
-                                col += 1;
-                            } else {
-                                // Fully transparent — scan ahead for transparent run
-                                col += 1;
-                                while col < row_width {
-                                    let si2 = src_off + col;
-                                    if si2 >= lp_len { break; }
-                                    if layer_pixels[si2] >> 24 != 0 { break; }
-                                    col += 1;
-                                }
-                            }
+                            (overlap.y as usize + row) * bb_stride + overlap.x as usize - bb_base;
+                        let n = (overlap.width as usize)
+                            .min(lp_len.saturating_sub(src_off))
+                            .min(bb.len().saturating_sub(dst_off));
+                        if n > 0 {
+                            blend_row(
+                                &mut bb[dst_off..dst_off + n],
+                                &layer_pixels[src_off..src_off + n],
+                            );
                         }
                     }
                 }
@@ -434,7 +582,8 @@ impl Compositor {
 
     /// Draw a soft gradient shadow for a layer into the back buffer (within damage rect).
     /// Uses pre-baked alpha arrays (focused/unfocused) to skip per-pixel div255 multiply.
-    fn draw_shadow_to_bb(&mut self, rect: &Rect, layer_idx: usize) {
+    /// The shadow cache must be current (see `prepare_shadow_caches`).
+    fn draw_shadow_to_bb(&self, rect: &Rect, layer_idx: usize, bb: &mut [u32], bb_base: usize) {
         let layer_id = self.layers[layer_idx].id;
         let layer_w = self.layers[layer_idx].width;
         let layer_h = self.layers[layer_idx].height;
@@ -442,16 +591,6 @@ impl Compositor {
         let ly = self.layers[layer_idx].y + shadow_offset_y();
         let spread = shadow_spread();
 
-        // Ensure shadow cache exists and matches current layer dimensions
-        let needs_recompute = match &self.layers[layer_idx].shadow_cache {
-            Some(c) => c.layer_w != layer_w || c.layer_h != layer_h,
-            None => true,
-        };
-        if needs_recompute {
-            let cache = compute_shadow_cache(layer_w, layer_h);
-            self.layers[layer_idx].shadow_cache = Some(cache);
-        }
-
         // Pick focused or unfocused pre-baked alpha array
         let is_focused = self.focused_layer_id == Some(layer_id);
 
@@ -467,8 +606,10 @@ impl Compositor {
             let shadow_ox = lx - spread;
             let shadow_oy = ly - spread;
 
-            // Split borrow: read all layer data first, then take mutable ref to back_buffer
-            let cache = self.layers[layer_idx].shadow_cache.as_ref().unwrap();
+            let cache = match self.layers[layer_idx].shadow_cache.as_ref() {
+                Some(c) => c,
+                None => return,
+            };
             let cache_w = cache.cache_w as usize;
             let alphas = if is_focused { &cache.focused_alphas } else { &cache.unfocused_alphas };
             let cache_alphas = alphas.as_ptr();
@@ -482,14 +623,16 @@ impl Compositor {
             let win_abs_y0 = self.layers[layer_idx].y;
             let win_abs_y1 = self.layers[layer_idx].y + layer_h as i32;
 
-            let bb = &mut self.back_buffer;
             let bb_len = bb.len();
 
             for row in 0..overlap.height as usize {
                 let py = overlap.y + row as i32;
                 let cy = (py - shadow_oy) as usize;
                 let cache_row_off = cy * cache_w;
-                let bb_row_off = py as usize * bb_stride;
+                let bb_row_off = match (py as usize * bb_stride).checked_sub(bb_base) {
+                    Some(off) => off,
+                    None => continue,
+                };
 
                 let ol_x0 = overlap.x;
                 let ol_x1 = overlap.x + overlap.width as i32;
@@ -530,17 +673,14 @@ impl Compositor {
         cache_alphas: *const u8, cache_len: usize, cache_row_off: usize,
         shadow_ox: i32, x_start: i32, x_end: i32,
     ) {
-        for px in x_start..x_end {
-            let cx = (px - shadow_ox) as usize;
-            let cache_idx = cache_row_off + cx;
-            if cache_idx >= cache_len { break; }
-            let a = unsafe { *cache_alphas.add(cache_idx) } as u32;
-            if a == 0 { continue; }
-            let di = bb_row_off + px as usize;
-            if di < bb_len {
-                bb[di] = shadow_blend(a, bb[di]);
-            }
-        }
+        let cache_idx = cache_row_off + (x_start - shadow_ox) as usize;
+        let di = bb_row_off + x_start as usize;
+        let n = ((x_end - x_start) as usize)
+            .min(cache_len.saturating_sub(cache_idx))
+            .min(bb_len.saturating_sub(di));
+        if n == 0 { return; }
+        let alphas = unsafe { core::slice::from_raw_parts(cache_alphas.add(cache_idx), n) };
+        shadow_row(&mut bb[di..di + n], alphas);
     }
 
     /// Draw resize outline rectangle into back buffer.
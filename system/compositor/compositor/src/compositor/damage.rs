@@ -0,0 +1,295 @@
+//! Tile-based damage tracking.
+//!
+//! Damage is recorded as a bitmap of `TILE_SIZE`×`TILE_SIZE` screen tiles.
+//! Each frame the dirty tiles of a tile row are merged into spans, and a
+//! span matching the one directly above it extends that rect downward.
+//! Two small updates in opposite corners therefore recomposite two tiles,
+//! not the bounding box between them.
+//!
+//! Tiles that reached the framebuffer are also published to attached damage
+//! maps (SHM regions owned by clients such as `vncd`) so they can skip
+//! comparing unchanged parts of the screen.  Map layout, in `u32` words:
+//! `[tile_size, cols, rows, frame_seq, move[8], tile_seq[rows * cols]...]`.
+//! `tile_seq` holds the `frame_seq` that last touched the tile; `frame_seq`
+//! is written last (release) once the frame is on screen.
+//!
+//! `move` describes the last layer move that reached the screen:
+//! `[move_seq, layer_id, x, y, width, height, old_x, old_y]` (coordinates as
+//! `i32` bit patterns).  Clients use it to replay window drags as copies
+//! (RFB CopyRect) instead of re-sending the moved pixels.
+
+use super::rect::Rect;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// log2 of the tile edge.
+pub(crate) const TILE_SHIFT: u32 = 6;
+/// Tile edge in pixels.
+pub(crate) const TILE_SIZE: u32 = 1 << TILE_SHIFT;
+/// Header words at the start of a damage map.
+pub(crate) const MAP_HEADER_WORDS: usize = 12;
+/// Word index of the move record.
+const MAP_MOVE_WORD: usize = 4;
+/// Maximum simultaneously attached damage maps.
+const MAX_MAPS: usize = 4;
+
+/// An attached damage map.
+struct DamageMap {
+    shm_id: u32,
+    base: *mut u32,
+    words: usize,
+}
+
+/// A layer move waiting to be published with the next frame.
+#[derive(Clone, Copy)]
+struct MoveRecord {
+    layer_id: u32,
+    old_x: i32,
+    old_y: i32,
+    x: i32,
+    y: i32,
+    width: u32,
+    height: u32,
+}
+
+/// Per-frame dirty-tile bitmap for one screen.
+pub(crate) struct DamageGrid {
+    width: u32,
+    height: u32,
+    cols: u32,
+    rows: u32,
+    /// u64 words per tile row.
+    row_words: usize,
+    bits: Vec<u64>,
+    dirty: bool,
+    /// Rects extended by the previous/current tile row (indices into the output).
+    open: Vec<usize>,
+    next_open: Vec<usize>,
+    /// Dirty tiles in the last drained frame.
+    last_frame_tiles: u32,
+    frame_seq: u32,
+    maps: Vec<DamageMap>,
+    pending_move: Option<MoveRecord>,
+}
+
+impl DamageGrid {
+    pub fn new(width: u32, height: u32) -> Self {
+        let mut g = DamageGrid {
+            width: 0,
+            height: 0,
+            cols: 0,
+            rows: 0,
+            row_words: 0,
+            bits: Vec::new(),
+            dirty: false,
+            open: Vec::with_capacity(16),
+            next_open: Vec::with_capacity(16),
+            last_frame_tiles: 0,
+            frame_seq: 0,
+            maps: Vec::new(),
+            pending_move: None,
+        };
+        g.resize(width, height);
+        g
+    }
+
+    /// Re-dimension the grid for a new screen size (drops pending damage).
+    pub fn resize(&mut self, width: u32, height: u32) {
+        self.width = width;
+        self.height = height;
+        self.cols = (width + TILE_SIZE - 1) >> TILE_SHIFT;
+        self.rows = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+        self.row_words = ((self.cols + 63) / 64) as usize;
+        self.bits = vec![0u64; self.row_words * self.rows as usize];
+        self.dirty = false;
+        for i in 0..self.maps.len() {
+            self.write_map_header(i);
+        }
+    }
+
+    /// Mark every tile touched by `rect` dirty.
+    pub fn push(&mut self, rect: Rect) {
+        let r = rect.clip_to_screen(self.width, self.height);
+        if r.is_empty() {
+            return;
+        }
+        let tx0 = r.x as u32 >> TILE_SHIFT;
+        let tx1 = (r.right() as u32 - 1) >> TILE_SHIFT;
+        let ty0 = r.y as u32 >> TILE_SHIFT;
+        let ty1 = (r.bottom() as u32 - 1) >> TILE_SHIFT;
+        for ty in ty0..=ty1 {
+            let row = &mut self.bits[ty as usize * self.row_words..][..self.row_words];
+            for w in (tx0 / 64)..=(tx1 / 64) {
+                let lo = if w == tx0 / 64 { tx0 % 64 } else { 0 };
+                let hi = if w == tx1 / 64 { tx1 % 64 } else { 63 };
+                row[w as usize] |= (u64::MAX >> (63 - hi)) & (u64::MAX << lo);
+            }
+        }
+        self.dirty = true;
+    }
+
+    pub fn is_empty(&self) -> bool {
+        !self.dirty
+    }
+
+    /// Dirty tiles in the last drained frame.
+    pub fn last_frame_tiles(&self) -> u32 {
+        self.last_frame_tiles
+    }
+
+    /// Convert the pending tiles into screen-clipped rects appended to `out`
+    /// and clear the grid.  Returns the number of dirty tiles.
+    pub fn drain_into(&mut self, out: &mut Vec<Rect>) -> u32 {
+        if !self.dirty {
+            self.last_frame_tiles = 0;
+            return 0;
+        }
+        let mut tiles = 0u32;
+        self.open.clear();
+        for ty in 0..self.rows {
+            let row_off = ty as usize * self.row_words;
+            let y = (ty << TILE_SHIFT) as i32;
+            let h = TILE_SIZE.min(self.height - (ty << TILE_SHIFT));
+            self.next_open.clear();
+            let mut oi = 0usize;
+            let mut tx = 0u32;
+            while tx < self.cols {
+                let word = self.bits[row_off + (tx / 64) as usize] >> (tx % 64);
+                if word == 0 {
+                    tx = (tx / 64 + 1) * 64;
+                    continue;
+                }
+                tx += word.trailing_zeros();
+                let start = tx;
+                loop {
+                    let run = (self.bits[row_off + (tx / 64) as usize] >> (tx % 64)).trailing_ones();
+                    tx += run;
+                    if run == 0 || tx % 64 != 0 || tx >= self.cols {
+                        break;
+                    }
+                }
+                tiles += tx - start;
+
+                let x = (start << TILE_SHIFT) as i32;
+                let w = (tx << TILE_SHIFT).min(self.width) - (start << TILE_SHIFT);
+                // Spans are sorted by x, so the open rects are scanned once per row.
+                while oi < self.open.len() && out[self.open[oi]].x < x {
+                    oi += 1;
+                }
+                match self.open.get(oi) {
+                    Some(&idx) if out[idx].x == x && out[idx].width == w => {
+                        out[idx].height += h;
+                        self.next_open.push(idx);
+                        oi += 1;
+                    }
+                    _ => {
+                        self.next_open.push(out.len());
+                        out.push(Rect::new(x, y, w, h));
+                    }
+                }
+            }
+            core::mem::swap(&mut self.open, &mut self.next_open);
+        }
+        self.bits.fill(0);
+        self.dirty = false;
+        self.last_frame_tiles = tiles;
+        tiles
+    }
+
+    // ── Damage maps ─────────────────────────────────────────────────────
+
+    /// Attach a client damage map of `words` u32 words.  Returns false if
+    /// the region cannot be mapped or the map limit is reached.
+    pub fn attach_map(&mut self, shm_id: u32, words: usize) -> bool {
+        self.detach_map(shm_id);
+        if self.maps.len() >= MAX_MAPS || words < MAP_HEADER_WORDS {
+            return false;
+        }
+        let addr = anyos_std::ipc::shm_map(shm_id);
+        if addr == 0 {
+            return false;
+        }
+        self.maps.push(DamageMap { shm_id, base: addr as usize as *mut u32, words });
+        self.write_map_header(self.maps.len() - 1);
+        true
+    }
+
+    /// Whether any client damage map is attached.
+    pub fn has_maps(&self) -> bool {
+        !self.maps.is_empty()
+    }
+
+    /// Detach (and unmap) a client damage map.
+    pub fn detach_map(&mut self, shm_id: u32) {
+        if let Some(i) = self.maps.iter().position(|m| m.shm_id == shm_id) {
+            self.maps.swap_remove(i);
+            anyos_std::ipc::shm_unmap(shm_id);
+        }
+    }
+
+    /// Note that layer `layer_id` (content `width`×`height`) moved from
+    /// `old_x, old_y` to `x, y`; published with the next frame.  Moves of the
+    /// same layer within one frame are merged.
+    pub fn note_move(&mut self, layer_id: u32, old_x: i32, old_y: i32, x: i32, y: i32, width: u32, height: u32) {
+        if self.maps.is_empty() {
+            return;
+        }
+        let (old_x, old_y) = match self.pending_move {
+            Some(m) if m.layer_id == layer_id => (m.old_x, m.old_y),
+            _ => (old_x, old_y),
+        };
+        self.pending_move = Some(MoveRecord { layer_id, old_x, old_y, x, y, width, height });
+    }
+
+    /// Record that `rects` reached the framebuffer in attached maps.
+    pub fn publish(&mut self, rects: &[Rect]) {
+        if self.maps.is_empty() || rects.is_empty() {
+            return;
+        }
+        self.frame_seq = self.frame_seq.wrapping_add(1).max(1);
+        let seq = self.frame_seq;
+        let cols = self.cols as usize;
+        let mv = self.pending_move.take();
+        for m in &self.maps {
+            if m.words < MAP_HEADER_WORDS + cols * self.rows as usize {
+                continue;
+            }
+            if let Some(mv) = mv {
+                let words = [
+                    seq, mv.layer_id, mv.x as u32, mv.y as u32,
+                    mv.width, mv.height, mv.old_x as u32, mv.old_y as u32,
+                ];
+                for (i, &w) in words.iter().enumerate() {
+                    unsafe { m.base.add(MAP_MOVE_WORD + i).write_volatile(w) };
+                }
+            }
+            for r in rects {
+                let r = r.clip_to_screen(self.width, self.height);
+                if r.is_empty() {
+                    continue;
+                }
+                let tx0 = (r.x as u32 >> TILE_SHIFT) as usize;
+                let tx1 = ((r.right() as u32 - 1) >> TILE_SHIFT) as usize;
+                for ty in (r.y as u32 >> TILE_SHIFT)..=((r.bottom() as u32 - 1) >> TILE_SHIFT) {
+                    let row = MAP_HEADER_WORDS + ty as usize * cols;
+                    for tx in tx0..=tx1 {
+                        unsafe { m.base.add(row + tx).write_volatile(seq) };
+                    }
+                }
+            }
+            unsafe { (*(m.base.add(3) as *const AtomicU32)).store(seq, Ordering::Release) };
+        }
+    }
+
+    fn write_map_header(&self, i: usize) {
+        let m = &self.maps[i];
+        let fits = m.words >= MAP_HEADER_WORDS + (self.cols * self.rows) as usize;
+        let (cols, rows) = if fits { (self.cols, self.rows) } else { (0, 0) };
+        unsafe {
+            m.base.write_volatile(TILE_SIZE);
+            m.base.add(1).write_volatile(cols);
+            m.base.add(2).write_volatile(rows);
+        }
+    }
+}
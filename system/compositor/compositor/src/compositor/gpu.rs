@@ -2,6 +2,7 @@
 
 use anyos_std::ipc;
 use super::Compositor;
+use super::gpu_ring::GpuRing;
 use super::rect::Rect;
 
 // ── GPU Command Types ───────────────────────────────────────────────────────
@@ -15,6 +16,8 @@ pub(crate) const GPU_CURSOR_SHOW: u32 = 5;
 pub(crate) const GPU_DEFINE_CURSOR: u32 = 6;
 pub(crate) const GPU_FLIP: u32 = 7;
 pub(crate) const GPU_SYNC: u32 = 8;
+/// Scan out from a VRAM row: [GPU_SCANOUT, enable, vram_y, ...].
+pub(crate) const GPU_SCANOUT: u32 = 10;
 
 impl Compositor {
     pub fn enable_double_buffer(&mut self) {
@@ -77,7 +80,16 @@ impl Compositor {
         self.gpu_cmds.push([GPU_UPDATE, x, y, w, h, 0, 0, 0, 0]);
     }
 
-    pub fn flush_gpu(&mut self) {
+    /// Register the shared GPU command ring; without it every flush is a
+    /// `SYS_GPU_COMMAND` batch.
+    pub fn try_enable_gpu_ring(&mut self) {
+        self.gpu_ring = GpuRing::new();
+    }
+
+    /// Submit the queued GPU commands.  Returns the ring fence that
+    /// completes once the GPU has executed them (0 without a ring: the
+    /// commands were executed synchronously, up to the device's queue).
+    pub fn flush_gpu(&mut self) -> u32 {
         if !self.gpu_cmds.is_empty() {
             // Only issue sfence when VRAM was actually written (flush_region sets vram_dirty).
             // Without this barrier after VRAM writes, the CPU's WC buffers may not be
@@ -90,9 +102,32 @@ impl Compositor {
                 unsafe { core::arch::asm!("dsb st", options(nostack, preserves_flags)); }
                 self.vram_dirty = false;
             }
-            ipc::gpu_command(&self.gpu_cmds);
+            match self.gpu_ring {
+                Some(ref mut ring) => ring.push(&self.gpu_cmds),
+                None => { ipc::gpu_command(&self.gpu_cmds); }
+            }
             self.gpu_cmds.clear();
         }
+        match self.gpu_ring {
+            Some(ref mut ring) => ring.submit(),
+            None => 0,
+        }
+    }
+
+    /// Block until the GPU has executed the commands behind `fence`.
+    pub(crate) fn wait_gpu(&self, fence: u32) {
+        if let Some(ref ring) = self.gpu_ring {
+            ring.wait(fence);
+        }
+    }
+
+    /// Submit the queued commands and wait until the GPU has executed them.
+    pub(crate) fn sync_gpu(&mut self) {
+        if self.gpu_ring.is_none() {
+            self.gpu_cmds.push([GPU_SYNC, 0, 0, 0, 0, 0, 0, 0, 0]);
+        }
+        let fence = self.flush_gpu();
+        self.wait_gpu(fence);
     }
 
     /// Flush a region from back buffer to the visible framebuffer (no offset).
@@ -115,5 +150,6 @@ impl Compositor {
             self.gpu_cmds.push([GPU_UPDATE, rect.x as u32, rect.y as u32, rect.width, rect.height, 0, 0, 0, 0]);
             self.flush_gpu();
         }
+        self.damage.publish(core::slice::from_ref(rect));
     }
 }
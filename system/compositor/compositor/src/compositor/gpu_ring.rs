@@ -0,0 +1,113 @@
+//! GPU command ring shared with the kernel.
+//!
+//! Commands are written into a ring in compositor memory and executed by
+//! the kernel when the doorbell syscall is rung, so a frame's updates,
+//! flip and cursor commands go down in one submission instead of one
+//! `SYS_GPU_COMMAND` per flush.  Each submission ends with a FENCE whose
+//! value the kernel publishes once the device has finished the work; the
+//! compositor blocks only where it must (before the CPU overwrites memory
+//! the GPU may still read).
+//!
+//! Layout (u32 words): `[entries, head, tail, completed_fence, ..16]`
+//! followed by `entries` 9-word commands.  `head` and `completed_fence`
+//! are written by the kernel, `tail` by the compositor.
+
+use alloc::vec;
+use alloc::vec::Vec;
+use anyos_std::ipc;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// Ring command: FENCE(value).
+pub(crate) const GPU_FENCE: u32 = 11;
+
+const HEADER_WORDS: usize = 16;
+const HEAD: usize = 1;
+const TAIL: usize = 2;
+const COMPLETED: usize = 3;
+/// Command slots requested from the kernel.
+const RING_ENTRIES: usize = 512;
+
+pub(crate) struct GpuRing {
+    buf: Vec<u32>,
+    entries: u32,
+    tail: u32,
+    /// Commands queued since the last doorbell.
+    queued: bool,
+    /// Last fence value handed out.
+    fence: u32,
+}
+
+/// Whether fence value `a` is at or after `b` (wrapping).
+fn reached(a: u32, b: u32) -> bool {
+    (a.wrapping_sub(b) as i32) >= 0
+}
+
+impl GpuRing {
+    /// Allocate the ring and register it with the kernel.  Returns `None`
+    /// if the kernel has no ring support.
+    pub(crate) fn new() -> Option<Self> {
+        let buf = vec![0u32; HEADER_WORDS + RING_ENTRIES * 9];
+        let entries = ipc::gpu_ring_setup(buf.as_ptr() as u32, (buf.len() * 4) as u32);
+        if entries == 0 || entries == u32::MAX {
+            return None;
+        }
+        Some(GpuRing { buf, entries, tail: 0, queued: false, fence: 0 })
+    }
+
+    fn header(&self, i: usize) -> &AtomicU32 {
+        unsafe { &*(self.buf.as_ptr().add(i) as *const AtomicU32) }
+    }
+
+    /// Fence value the kernel reported complete.
+    pub(crate) fn completed(&self) -> u32 {
+        self.header(COMPLETED).load(Ordering::Acquire)
+    }
+
+    /// Append commands, ringing the doorbell first whenever the ring is
+    /// full.  Nothing executes until [`submit`](Self::submit).
+    pub(crate) fn push(&mut self, cmds: &[[u32; 9]]) {
+        for cmd in cmds {
+            let head = self.header(HEAD).load(Ordering::Acquire);
+            if self.tail.wrapping_sub(head) >= self.entries {
+                // The kernel drains the whole ring on each doorbell.
+                self.doorbell();
+            }
+            let off = HEADER_WORDS + (self.tail % self.entries) as usize * 9;
+            self.buf[off..off + 9].copy_from_slice(cmd);
+            self.tail = self.tail.wrapping_add(1);
+            self.queued = true;
+        }
+    }
+
+    fn doorbell(&mut self) {
+        self.header(TAIL).store(self.tail, Ordering::Release);
+        ipc::gpu_ring_doorbell();
+        self.queued = false;
+    }
+
+    /// Execute everything queued, followed by a new fence.  Returns the
+    /// fence, or the previous one if nothing was queued.
+    pub(crate) fn submit(&mut self) -> u32 {
+        if !self.queued {
+            return self.fence;
+        }
+        self.fence = self.fence.wrapping_add(1).max(1);
+        let fence = self.fence;
+        self.push(&[[GPU_FENCE, fence, 0, 0, 0, 0, 0, 0, 0]]);
+        self.doorbell();
+        fence
+    }
+
+    /// Block until `fence` has completed on the device.
+    pub(crate) fn wait(&self, fence: u32) {
+        if fence != 0 && !reached(self.completed(), fence) {
+            ipc::gpu_fence_wait(fence);
+        }
+    }
+}
+
+impl Drop for GpuRing {
+    fn drop(&mut self) {
+        ipc::gpu_ring_setup(0, 0);
+    }
+}
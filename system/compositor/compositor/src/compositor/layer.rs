@@ -1,6 +1,8 @@
-//! Layer and shadow data structures for the compositor.
+//! Layer, shadow and blur-behind cache data structures for the compositor.
 
+use alloc::vec;
 use alloc::vec::Vec;
+use super::damage::{DamageGrid, TILE_SIZE};
 use super::rect::Rect;
 
 // ── Shadow Constants ────────────────────────────────────────────────────────
@@ -36,6 +38,106 @@ pub(crate) struct ShadowCache {
     pub(crate) layer_h: u32,
 }
 
+// ── Blur Cache ──────────────────────────────────────────────────────────────
+
+/// Box-blur passes for blur-behind (2 = triangle filter).
+pub(crate) const BLUR_PASSES: u32 = 2;
+
+/// Downscale factor for a blur radius: wide blurs are computed at 1/2 or
+/// 1/4 resolution and upscaled bilinearly, where the loss is invisible.
+fn blur_downscale(radius: u32) -> u32 {
+    if radius >= 8 { 4 } else if radius >= 4 { 2 } else { 1 }
+}
+
+/// Blurred background behind a blur-behind layer, kept at reduced resolution.
+///
+/// `area` is the layer's on-screen bounds widened to the 64×64 damage tile
+/// grid, so each stale tile is recaptured whole.  `source` holds the
+/// downsampled content of the layers below, `blurred` the blur of it.
+/// Damage from layers below marks tiles stale; only those are recaptured
+/// and only the low-res pixels within the blur reach of them are reblurred.
+/// Damage from the layer's own content leaves the cache alone.
+pub(crate) struct BlurCache {
+    pub(crate) area: Rect,
+    /// Layer blur radius (full resolution) this was built for.
+    pub(crate) radius: u32,
+    /// Full-resolution pixels per low-res pixel edge.
+    pub(crate) scale: u32,
+    /// Blur radius at low resolution.
+    pub(crate) lr_radius: u32,
+    pub(crate) lr_w: u32,
+    pub(crate) lr_h: u32,
+    pub(crate) source: Vec<u32>,
+    pub(crate) blurred: Vec<u32>,
+    /// Tiles (in `area`-local coordinates) whose source must be recaptured.
+    stale: DamageGrid,
+}
+
+impl BlurCache {
+    /// A cache for `area` with every tile stale.
+    pub(crate) fn new(area: Rect, radius: u32) -> Self {
+        let scale = blur_downscale(radius);
+        let lr_w = area.width.div_ceil(scale);
+        let lr_h = area.height.div_ceil(scale);
+        let mut stale = DamageGrid::new(area.width, area.height);
+        stale.push(Rect::new(0, 0, area.width, area.height));
+        BlurCache {
+            area,
+            radius,
+            scale,
+            lr_radius: ((radius + scale / 2) / scale).max(1),
+            lr_w,
+            lr_h,
+            source: vec![0u32; (lr_w * lr_h) as usize],
+            blurred: vec![0u32; (lr_w * lr_h) as usize],
+            stale,
+        }
+    }
+
+    /// Cache area for a layer at `bounds`: clipped to the screen and widened
+    /// to whole damage tiles.
+    pub(crate) fn area_for(bounds: &Rect, fb_w: u32, fb_h: u32) -> Rect {
+        let b = bounds.clip_to_screen(fb_w, fb_h);
+        if b.is_empty() {
+            return b;
+        }
+        let mask = !(TILE_SIZE as i32 - 1);
+        let x = b.x & mask;
+        let y = b.y & mask;
+        let r = ((b.right() + TILE_SIZE as i32 - 1) & mask).min(fb_w as i32);
+        let bt = ((b.bottom() + TILE_SIZE as i32 - 1) & mask).min(fb_h as i32);
+        Rect::new(x, y, (r - x) as u32, (bt - y) as u32)
+    }
+
+    /// Full-resolution distance over which a source change affects the
+    /// blurred output (both passes plus the bilinear neighbor).
+    pub(crate) fn reach(&self) -> i32 {
+        ((BLUR_PASSES * self.lr_radius + 1) * self.scale) as i32
+    }
+
+    /// Mark the tiles under screen rect `rect` stale.  Returns the screen
+    /// region whose blurred output changes and must be recomposited.
+    pub(crate) fn invalidate(&mut self, rect: &Rect) -> Option<Rect> {
+        let hit = rect.intersect(&self.area)?;
+        self.stale.push(Rect::new(hit.x - self.area.x, hit.y - self.area.y, hit.width, hit.height));
+        hit.expand(self.reach()).intersect(&self.area)
+    }
+
+    pub(crate) fn has_stale(&self) -> bool {
+        !self.stale.is_empty()
+    }
+
+    /// Move the stale tiles, as screen rects, into `out`.
+    pub(crate) fn drain_stale(&mut self, out: &mut Vec<Rect>) {
+        let first = out.len();
+        self.stale.drain_into(out);
+        for r in &mut out[first..] {
+            r.x += self.area.x;
+            r.y += self.area.y;
+        }
+    }
+}
+
 // ── Layer ───────────────────────────────────────────────────────────────────
 
 pub struct Layer {
@@ -58,6 +160,8 @@ pub struct Layer {
     pub blur_radius: u32,
     /// Cached shadow alpha bitmap (computed lazily, invalidated on resize).
     pub(crate) shadow_cache: Option<ShadowCache>,
+    /// Cached blurred background (built lazily by the compositing pass).
+    pub(crate) blur_cache: Option<BlurCache>,
     /// VRAM-direct surface: app writes directly to off-screen VRAM, compositor
     /// uses GPU RECT_COPY instead of CPU pixel copy during compositing.
     pub is_vram: bool,
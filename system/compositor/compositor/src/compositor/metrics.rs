@@ -0,0 +1,177 @@
+//! Per-frame compositing counters and a per-second history of them.
+//!
+//! The compositing pass runs on pool workers with only `&Compositor`, so the
+//! counters it bumps are relaxed atomics.  The render thread drains them
+//! after every frame into the current one-second sample of [`PerfHistory`],
+//! which keeps the last [`HISTORY_SECS`] seconds for the HUD and
+//! `CMD_GET_PERF_METRICS`.
+//!
+//! Shadow and blur times are summed over worker threads (CPU time, not
+//! wall time); compose and flush times are wall time on the render thread.
+
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+
+/// Seconds of history kept.
+pub const HISTORY_SECS: usize = 60;
+/// u32 words per sample in a metrics dump (see [`PerfSample::to_words`]).
+pub const SAMPLE_WORDS: usize = 10;
+
+/// Counters for the frame being composited.
+pub(crate) struct FrameCounters {
+    pub(crate) damaged_px: AtomicU64,
+    pub(crate) layers_visited: AtomicU32,
+    pub(crate) occlusion_skips: AtomicU32,
+    pub(crate) shadow_ns: AtomicU64,
+    pub(crate) blur_ns: AtomicU64,
+    pub(crate) flush_ns: AtomicU64,
+}
+
+/// Counters of one finished frame.
+#[derive(Clone, Copy, Default)]
+pub struct FrameMetrics {
+    pub damaged_px: u64,
+    pub layers_visited: u32,
+    pub occlusion_skips: u32,
+    pub shadow_us: u32,
+    pub blur_us: u32,
+    pub flush_us: u32,
+}
+
+impl FrameCounters {
+    pub(crate) const fn new() -> Self {
+        FrameCounters {
+            damaged_px: AtomicU64::new(0),
+            layers_visited: AtomicU32::new(0),
+            occlusion_skips: AtomicU32::new(0),
+            shadow_ns: AtomicU64::new(0),
+            blur_ns: AtomicU64::new(0),
+            flush_ns: AtomicU64::new(0),
+        }
+    }
+
+    #[inline]
+    pub(crate) fn add(counter: &AtomicU32, n: u32) {
+        counter.fetch_add(n, Ordering::Relaxed);
+    }
+
+    /// Add the time since `start_ns` (a `monotonic_ns` value) to `counter`.
+    #[inline]
+    pub(crate) fn add_since(counter: &AtomicU64, start_ns: u64) {
+        let ns = anyos_std::sys::monotonic_ns().saturating_sub(start_ns);
+        counter.fetch_add(ns, Ordering::Relaxed);
+    }
+
+    /// Read and reset every counter.
+    pub(crate) fn take(&self) -> FrameMetrics {
+        let us = |c: &AtomicU64| (c.swap(0, Ordering::Relaxed) / 1000) as u32;
+        FrameMetrics {
+            damaged_px: self.damaged_px.swap(0, Ordering::Relaxed),
+            layers_visited: self.layers_visited.swap(0, Ordering::Relaxed),
+            occlusion_skips: self.occlusion_skips.swap(0, Ordering::Relaxed),
+            shadow_us: us(&self.shadow_ns),
+            blur_us: us(&self.blur_ns),
+            flush_us: us(&self.flush_ns),
+        }
+    }
+}
+
+/// Totals of all frames in one second.
+#[derive(Clone, Copy)]
+pub struct PerfSample {
+    /// Uptime (seconds) the sample started at.
+    pub second: u32,
+    pub frames: u32,
+    pub compose_us_total: u32,
+    pub compose_us_max: u32,
+    pub damaged_px: u32,
+    pub layers_visited: u32,
+    pub occlusion_skips: u32,
+    pub shadow_us: u32,
+    pub blur_us: u32,
+    pub flush_us: u32,
+}
+
+impl PerfSample {
+    const EMPTY: PerfSample = PerfSample {
+        second: 0, frames: 0, compose_us_total: 0, compose_us_max: 0, damaged_px: 0,
+        layers_visited: 0, occlusion_skips: 0, shadow_us: 0, blur_us: 0, flush_us: 0,
+    };
+
+    /// Average compose time of the sample's frames.
+    pub fn compose_us_avg(&self) -> u32 {
+        self.compose_us_total / self.frames.max(1)
+    }
+
+    /// Layout of one sample in a `CMD_GET_PERF_METRICS` dump.
+    pub fn to_words(&self) -> [u32; SAMPLE_WORDS] {
+        [
+            self.second, self.frames, self.compose_us_avg(), self.compose_us_max,
+            self.damaged_px, self.layers_visited, self.occlusion_skips,
+            self.shadow_us, self.blur_us, self.flush_us,
+        ]
+    }
+}
+
+/// Ring of per-second samples.
+pub struct PerfHistory {
+    samples: [PerfSample; HISTORY_SECS],
+    /// Completed samples in the ring.
+    len: usize,
+    /// Next slot to complete.
+    pos: usize,
+    /// Sample of the current second.
+    pub current: PerfSample,
+}
+
+impl PerfHistory {
+    pub const fn new() -> Self {
+        PerfHistory {
+            samples: [PerfSample::EMPTY; HISTORY_SECS],
+            len: 0,
+            pos: 0,
+            current: PerfSample::EMPTY,
+        }
+    }
+
+    /// Add a composited frame to the current second.
+    pub fn record(&mut self, compose_us: u32, m: &FrameMetrics) {
+        let c = &mut self.current;
+        c.frames += 1;
+        c.compose_us_total = c.compose_us_total.saturating_add(compose_us);
+        c.compose_us_max = c.compose_us_max.max(compose_us);
+        c.damaged_px = c.damaged_px.saturating_add(m.damaged_px.min(u32::MAX as u64) as u32);
+        c.layers_visited = c.layers_visited.saturating_add(m.layers_visited);
+        c.occlusion_skips = c.occlusion_skips.saturating_add(m.occlusion_skips);
+        c.shadow_us = c.shadow_us.saturating_add(m.shadow_us);
+        c.blur_us = c.blur_us.saturating_add(m.blur_us);
+        c.flush_us = c.flush_us.saturating_add(m.flush_us);
+    }
+
+    /// Close the current sample if `now_s` is a later second.  Returns
+    /// whether a sample was completed.
+    pub fn roll(&mut self, now_s: u32) -> bool {
+        if now_s == self.current.second {
+            return false;
+        }
+        self.samples[self.pos] = self.current;
+        self.pos = (self.pos + 1) % HISTORY_SECS;
+        self.len = (self.len + 1).min(HISTORY_SECS);
+        self.current = PerfSample { second: now_s, ..PerfSample::EMPTY };
+        true
+    }
+
+    /// Completed samples, oldest first.
+    pub fn iter(&self) -> impl Iterator<Item = &PerfSample> {
+        let start = (self.pos + HISTORY_SECS - self.len) % HISTORY_SECS;
+        (0..self.len).map(move |i| &self.samples[(start + i) % HISTORY_SECS])
+    }
+
+    /// Most recently completed sample.
+    pub fn last(&self) -> Option<&PerfSample> {
+        if self.len == 0 {
+            None
+        } else {
+            Some(&self.samples[(self.pos + HISTORY_SECS - 1) % HISTORY_SECS])
+        }
+    }
+}
@@ -5,9 +5,14 @@
 
 mod blend;
 mod compositing;
+mod damage;
 pub(crate) mod gpu;
+mod gpu_ring;
 mod layer;
+pub mod metrics;
 mod rect;
+mod scanout;
+mod simd;
 pub mod vram_alloc;
 
 pub use blend::alpha_blend;
@@ -16,6 +21,9 @@ pub use rect::Rect;
 
 use alloc::vec;
 use alloc::vec::Vec;
+use anyos_std::ipc;
+use damage::DamageGrid;
+use gpu::{GPU_RECT_COPY, GPU_SYNC};
 use layer::AccelMoveHint;
 use vram_alloc::VramAllocator;
 
@@ -36,8 +44,8 @@ pub struct Compositor {
     pub layers: Vec<Layer>,
     pub(crate) next_layer_id: u32,
 
-    /// Damage regions to recompose this frame
-    pub(crate) damage: Vec<Rect>,
+    /// Dirty tiles to recompose this frame
+    pub(crate) damage: DamageGrid,
 
     /// Hardware double-buffering
     pub(crate) hw_double_buffer: bool,
@@ -68,8 +76,12 @@ pub struct Compositor {
 
     /// Reusable scratch buffer for blur operations (avoids per-frame heap allocation).
     pub(crate) blur_temp: Vec<u32>,
+    /// Scratch for partial reblurs of blur caches.
+    pub(crate) blur_work: Vec<u32>,
+    /// Scratch for stale blur-cache tiles drained each frame.
+    pub(crate) blur_stale: Vec<Rect>,
 
-    /// Reusable Vec for compositing loop (swap with self.damage to avoid drain+collect alloc).
+    /// Reusable Vec for compositing loop (tile spans drained from self.damage).
     pub(crate) compositing_damage: Vec<Rect>,
 
     /// Tracks whether VRAM was written since the last sfence.
@@ -77,12 +89,29 @@ pub struct Compositor {
 
     /// GPU DMA mode: back_buffer is registered as a GMR, no memcpy to VRAM needed.
     pub(crate) gmr_active: bool,
+
+    /// Command ring shared with the kernel (see `gpu_ring.rs`).
+    pub(crate) gpu_ring: Option<gpu_ring::GpuRing>,
+    /// Ring fence covering the last frame's flush.
+    pub(crate) frame_fence: u32,
+
+    /// Threads for banded compositing: 0 = one per CPU, 1 = render thread only.
+    pub(crate) render_threads: usize,
+
+    /// Layer id and VRAM row being scanned out directly (see `scanout.rs`).
+    pub(crate) scanout_layer: Option<(u32, u32)>,
+    /// The GPU refused direct scanout once; do not retry.
+    pub(crate) scanout_unsupported: bool,
+
+    /// Counters of the frame being composited (see `metrics.rs`).
+    pub(crate) counters: metrics::FrameCounters,
 }
 
 impl Compositor {
     /// Create a new compositor with the given framebuffer parameters.
     pub fn new(fb_ptr: *mut u32, width: u32, height: u32, pitch: u32) -> Self {
         let pixel_count = (width * height) as usize;
+        simd::init();
         Compositor {
             fb_ptr,
             fb_width: width,
@@ -91,7 +120,7 @@ impl Compositor {
             back_buffer: vec![0u32; pixel_count],
             layers: Vec::with_capacity(32),
             next_layer_id: 1,
-            damage: Vec::with_capacity(32),
+            damage: DamageGrid::new(width, height),
             hw_double_buffer: false,
             current_page: 0,
             prev_damage: Vec::with_capacity(32),
@@ -103,9 +132,30 @@ impl Compositor {
             accel_move_hint: None,
             vram_allocator: None,
             blur_temp: Vec::with_capacity(width.max(height) as usize),
+            blur_work: Vec::new(),
+            blur_stale: Vec::with_capacity(16),
             compositing_damage: Vec::with_capacity(32),
             vram_dirty: false,
             gmr_active: false,
+            gpu_ring: None,
+            frame_fence: 0,
+            render_threads: 0,
+            scanout_layer: None,
+            scanout_unsupported: false,
+            counters: metrics::FrameCounters::new(),
+        }
+    }
+
+    /// Set the compositing thread count (`[display] render_threads`).
+    pub fn set_render_threads(&mut self, threads: u32) {
+        self.render_threads = threads as usize;
+    }
+
+    /// Effective compositing thread count.
+    pub(crate) fn render_threads(&self) -> usize {
+        match self.render_threads {
+            0 => anyos_std::pool::current_num_threads(),
+            n => n.min(anyos_std::pool::current_num_threads()),
         }
     }
 
@@ -139,6 +189,7 @@ impl Compositor {
             blur_behind: false,
             blur_radius: 0,
             shadow_cache: None,
+            blur_cache: None,
             is_vram: false,
             vram_y: 0,
             dpi_aware: false,
@@ -174,6 +225,7 @@ impl Compositor {
             blur_behind: false,
             blur_radius: 0,
             shadow_cache: None,
+            blur_cache: None,
             is_vram: false,
             vram_y: 0,
             dpi_aware: false,
@@ -211,6 +263,7 @@ impl Compositor {
             blur_behind: false,
             blur_radius: 0,
             shadow_cache: None,
+            blur_cache: None,
             is_vram: false,
             vram_y: 0,
             dpi_aware: false,
@@ -221,10 +274,10 @@ impl Compositor {
     /// Remove a layer by ID.
     pub fn remove_layer(&mut self, id: u32) {
         if let Some(idx) = self.layer_index(id) {
-            let layer = &self.layers[idx];
-            self.damage.push(layer.damage_bounds());
+            let bounds = self.layers[idx].damage_bounds();
+            self.push_damage(bounds);
             // Free off-screen VRAM allocation if this was a VRAM-direct layer
-            if layer.is_vram {
+            if self.layers[idx].is_vram {
                 if let Some(ref mut alloc) = self.vram_allocator {
                     alloc.free(id);
                 }
@@ -263,6 +316,7 @@ impl Compositor {
             blur_behind: false,
             blur_radius: 0,
             shadow_cache: None,
+            blur_cache: None,
             is_vram: true,
             vram_y: alloc.vram_y,
             dpi_aware: false,
@@ -291,6 +345,47 @@ impl Compositor {
         self.layers.iter().find(|l| l.id == layer_id && l.is_vram).map(|l| l.vram_y)
     }
 
+    /// Copy a VRAM surface to off-screen row `new_row` (GPU RECT_COPY, or a
+    /// CPU copy if the GPU rejects it).  The caller remaps the owner's view
+    /// and commits the allocator move.  Not done while the surface is
+    /// scanned out.
+    pub(crate) fn copy_vram_surface(&mut self, layer_id: u32, new_row: u32) -> bool {
+        if self.scanout_layer.map_or(false, |(id, _)| id == layer_id) {
+            return false;
+        }
+        let alloc = match self.vram_allocator.as_ref().and_then(|a| a.get(layer_id)) {
+            Some(a) => *a,
+            None => return false,
+        };
+        self.flush_gpu();
+        let copied = ipc::gpu_command(&[
+            [GPU_RECT_COPY, 0, alloc.vram_y, 0, new_row, alloc.width, alloc.height, 0, 0],
+            [GPU_SYNC, 0, 0, 0, 0, 0, 0, 0, 0],
+        ]) == 2;
+        if !copied {
+            // Free extents never overlap the surface, so rows copy independently.
+            let stride = (self.fb_pitch / 4) as usize;
+            for row in 0..alloc.height as usize {
+                unsafe {
+                    core::ptr::copy_nonoverlapping(
+                        self.fb_ptr.add((alloc.vram_y as usize + row) * stride),
+                        self.fb_ptr.add((new_row as usize + row) * stride),
+                        alloc.width as usize,
+                    );
+                }
+            }
+        }
+        true
+    }
+
+    /// Point a VRAM layer at its surface's new row after compaction.
+    pub(crate) fn set_vram_layer_y(&mut self, layer_id: u32, vram_y: u32) {
+        if let Some(layer) = self.layers.iter_mut().find(|l| l.id == layer_id && l.is_vram) {
+            layer.vram_y = vram_y;
+            layer.dirty = true;
+        }
+    }
+
     /// Get layer index by ID.
     pub fn layer_index(&self, id: u32) -> Option<usize> {
         self.layers.iter().position(|l| l.id == id)
@@ -315,9 +410,12 @@ impl Compositor {
     pub fn move_layer(&mut self, id: u32, new_x: i32, new_y: i32) {
         if let Some(idx) = self.layer_index(id) {
             let old_bounds = self.layers[idx].damage_bounds();
+            let (old_x, old_y) = (self.layers[idx].x, self.layers[idx].y);
             self.layers[idx].x = new_x;
             self.layers[idx].y = new_y;
             let new_bounds = self.layers[idx].damage_bounds();
+            let (w, h) = (self.layers[idx].width, self.layers[idx].height);
+            self.damage.note_move(id, old_x, old_y, new_x, new_y, w, h);
 
             if self.gpu_accel {
                 // Coalesce: keep first old_bounds, update last new_bounds
@@ -335,8 +433,8 @@ impl Compositor {
                 }
             }
             // Always add damage (fallback path + merge logic)
-            self.damage.push(old_bounds);
-            self.damage.push(new_bounds);
+            self.push_damage(old_bounds);
+            self.push_damage(new_bounds);
         }
     }
 
@@ -347,7 +445,7 @@ impl Compositor {
                 let layer = self.layers.remove(idx);
                 let bounds = layer.damage_bounds();
                 self.layers.push(layer);
-                self.damage.push(bounds);
+                self.push_damage(bounds);
             }
         }
     }
@@ -359,13 +457,13 @@ impl Compositor {
             if let Some(old_id) = self.focused_layer_id {
                 if let Some(idx) = self.layer_index(old_id) {
                     let bounds = self.layers[idx].damage_bounds();
-                    self.damage.push(bounds);
+                    self.push_damage(bounds);
                 }
             }
             if let Some(new_id) = id {
                 if let Some(idx) = self.layer_index(new_id) {
                     let bounds = self.layers[idx].damage_bounds();
-                    self.damage.push(bounds);
+                    self.push_damage(bounds);
                 }
             }
             self.focused_layer_id = id;
@@ -377,7 +475,7 @@ impl Compositor {
         if let Some(idx) = self.layer_index(id) {
             if self.layers[idx].visible != visible {
                 self.layers[idx].visible = visible;
-                self.damage.push(self.layers[idx].damage_bounds());
+                self.push_damage(self.layers[idx].damage_bounds());
             }
         }
     }
@@ -393,7 +491,7 @@ impl Compositor {
     pub fn resize_layer(&mut self, id: u32, new_w: u32, new_h: u32) {
         if let Some(idx) = self.layer_index(id) {
             let old_bounds = self.layers[idx].damage_bounds();
-            self.damage.push(old_bounds);
+            self.push_damage(old_bounds);
 
             self.layers[idx].width = new_w;
             self.layers[idx].height = new_h;
@@ -407,12 +505,57 @@ impl Compositor {
 
     /// Add a damage rectangle (region that needs recomposition).
     pub fn add_damage(&mut self, rect: Rect) {
-        let clipped = rect.clip_to_screen(self.fb_width, self.fb_height);
-        if !clipped.is_empty() {
-            self.damage.push(clipped);
+        self.push_damage(rect);
+    }
+
+    /// Add damage caused by a content update of layer `id` alone.  Unlike
+    /// `add_damage` it keeps the blurred backgrounds of the layer itself
+    /// and of the layers below it.
+    pub fn add_layer_damage(&mut self, id: u32, rect: Rect) {
+        let above = self.layer_index(id).map_or(0, |i| i + 1);
+        self.push_damage_above(rect, above);
+    }
+
+    /// Record damage of unknown origin: it may change the background of
+    /// every blur-behind layer it touches.
+    fn push_damage(&mut self, rect: Rect) {
+        self.push_damage_above(rect, 0);
+    }
+
+    /// Record damage that changes what layers `above..` see beneath them.
+    /// Their blur caches lose the tiles under `rect`, and the wider region
+    /// whose blurred output shifts is damaged too.
+    pub(crate) fn push_damage_above(&mut self, rect: Rect, above: usize) {
+        self.damage.push(rect);
+        for layer in self.layers.iter_mut().skip(above) {
+            if let Some(cache) = layer.blur_cache.as_mut() {
+                if let Some(spill) = cache.invalidate(&rect) {
+                    self.damage.push(spill);
+                }
+            }
         }
     }
 
+    /// Dirty 64×64 tiles composited in the last frame.
+    pub fn last_frame_tiles(&self) -> u32 {
+        self.damage.last_frame_tiles()
+    }
+
+    /// Counters of the frame composited last; resets them.
+    pub fn take_frame_metrics(&self) -> metrics::FrameMetrics {
+        self.counters.take()
+    }
+
+    /// Publish per-tile frame sequence numbers into a client SHM region of
+    /// `words` u32 words (see `damage.rs` for the layout).
+    pub fn attach_damage_map(&mut self, shm_id: u32, words: usize) -> bool {
+        self.damage.attach_map(shm_id, words)
+    }
+
+    pub fn detach_damage_map(&mut self, shm_id: u32) {
+        self.damage.detach_map(shm_id);
+    }
+
     // ── Framebuffer I/O ─────────────────────────────────────────────────
 
     /// Copy a region from back buffer to the framebuffer (at y_offset for double-buffering).
@@ -449,8 +592,7 @@ impl Compositor {
 
     /// Full-screen damage (force recomposition of everything).
     pub fn damage_all(&mut self) {
-        self.damage
-            .push(Rect::new(0, 0, self.fb_width, self.fb_height));
+        self.push_damage(Rect::new(0, 0, self.fb_width, self.fb_height));
     }
 
     /// Resize the compositor for a new screen resolution.
@@ -470,7 +612,7 @@ impl Compositor {
         self.hw_double_buffer = false;
         self.current_page = 0;
         self.prev_damage.clear();
-        self.damage.clear();
+        self.damage.resize(new_width, new_height);
         // Invalidate VRAM allocations — resolution changed so off-screen layout is invalid.
         // Mark all VRAM layers as non-VRAM (they'll fall back to SHM compositing).
         for layer in &mut self.layers {
@@ -480,7 +622,7 @@ impl Compositor {
             }
         }
         if let Some(ref mut alloc) = self.vram_allocator {
-            let vram_total = alloc.off_screen_bytes() + new_pitch * new_height;
+            let vram_total = alloc.total_bytes();
             alloc.update_fb(new_pitch, new_height, vram_total);
         }
     }
@@ -1,7 +1,7 @@
 //! Axis-aligned rectangle for damage tracking and hit testing.
 
 /// An axis-aligned rectangle with integer coordinates.
-#[derive(Clone, Copy, Debug)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
 pub struct Rect {
     pub x: i32,
     pub y: i32,
@@ -0,0 +1,92 @@
+//! Direct scanout of fullscreen VRAM surfaces.
+//!
+//! When the topmost visible layer is an opaque VRAM-direct surface covering
+//! the whole screen, the display is pointed at that surface (`GPU_SCANOUT`)
+//! and compositing stops: a present only forwards its damage as
+//! `GPU_UPDATE`, with no back-buffer pass and no copy to the framebuffer.
+//! Any visible layer appearing above it (volume HUD, notifications,
+//! menus), a software cursor, a resize outline or an attached damage map
+//! (`vncd` reads the framebuffer) ends the mode, and the next frame is
+//! composited in full.
+
+use super::Compositor;
+use super::gpu::{GPU_SCANOUT, GPU_UPDATE};
+use super::metrics::FrameCounters;
+use super::rect::Rect;
+use anyos_std::ipc;
+
+impl Compositor {
+    /// Layer that can be scanned out directly, with its VRAM row.
+    fn scanout_candidate(&self) -> Option<(u32, u32)> {
+        if !self.hw_cursor || self.hw_double_buffer || self.gmr_active
+            || self.resize_outline.is_some() || self.damage.has_maps()
+        {
+            return None;
+        }
+        let screen = Rect::new(0, 0, self.fb_width, self.fb_height);
+        let layer = self.layers.iter().rev().find(|l| {
+            l.visible && l.damage_bounds().intersect(&screen).is_some()
+        })?;
+        let covers = layer.x == 0 && layer.y == 0
+            && layer.width == self.fb_width && layer.height == self.fb_height;
+        if layer.is_vram && layer.opaque && !layer.has_shadow && covers {
+            Some((layer.id, layer.vram_y))
+        } else {
+            None
+        }
+    }
+
+    /// Enter or leave direct scanout to match the layer stack.  Returns
+    /// whether the display is scanning out a surface this frame.
+    pub(crate) fn update_direct_scanout(&mut self) -> bool {
+        if self.scanout_unsupported {
+            return false;
+        }
+        let candidate = self.scanout_candidate();
+        if candidate == self.scanout_layer {
+            return candidate.is_some();
+        }
+        if self.scanout_layer.take().is_some() {
+            self.set_scanout(None);
+            // The framebuffer and back buffer are stale under the surface.
+            self.damage_all();
+        }
+        if let Some((_, vram_y)) = candidate {
+            if self.set_scanout(Some(vram_y)) {
+                self.scanout_layer = candidate;
+                self.damage_all();
+            } else {
+                self.scanout_unsupported = true;
+                anyos_std::println!("compositor: direct scanout unsupported by GPU");
+            }
+        }
+        self.scanout_layer.is_some()
+    }
+
+    /// Frame while scanning out a surface: forward the damage to the display.
+    pub(crate) fn compose_scanout(&mut self) -> bool {
+        if self.damage.is_empty() {
+            return false;
+        }
+        self.damage.drain_into(&mut self.compositing_damage);
+        self.count_damaged_pixels();
+        for r in &self.compositing_damage {
+            self.gpu_cmds.push([GPU_UPDATE, r.x as u32, r.y as u32, r.width, r.height, 0, 0, 0, 0]);
+        }
+        self.compositing_damage.clear();
+        let flush_start = anyos_std::sys::monotonic_ns();
+        self.flush_gpu();
+        FrameCounters::add_since(&self.counters.flush_ns, flush_start);
+        true
+    }
+
+    /// Point the display at VRAM row `line`, or back at the framebuffer.
+    fn set_scanout(&mut self, line: Option<u32>) -> bool {
+        self.flush_gpu();
+        let (on, y) = match line {
+            Some(y) => (1, y),
+            None => (0, 0),
+        };
+        ipc::gpu_command(&[[GPU_SCANOUT, on, y, 0, 0, 0, 0, 0, 0]]) == 1
+    }
+}
@@ -0,0 +1,602 @@
+//! SIMD row kernels for the compositing hot path.
+//!
+//! Src-over blending, constant-colour shadows, opaque copies and the two box
+//! blur passes, processed 4 (SSE4.1, NEON) or 8 (AVX2) pixels at a time.
+//! The variant is chosen once by [`init`] from CPUID; the scalar code in
+//! `blend.rs` stays the reference for every kernel (and handles row tails),
+//! and all variants produce bit-identical results to it.
+//!
+//! Blending uses `div255(s*a + d*(255-a))` per channel in 16-bit lanes.  The
+//! alpha channel is blended with a source alpha forced to 255, which equals
+//! the scalar `sa + div255(da*(255-sa))` exactly, so one formula covers
+//! opaque, transparent and partial pixels.
+
+use core::sync::atomic::{AtomicU8, Ordering};
+
+use super::blend::{alpha_blend, blur_h_row_scalar, blur_v_column_scalar, shadow_blend};
+
+const LEVEL_SCALAR: u8 = 0;
+const LEVEL_SSE41: u8 = 1;
+const LEVEL_AVX2: u8 = 2;
+const LEVEL_NEON: u8 = 3;
+
+static LEVEL: AtomicU8 = AtomicU8::new(LEVEL_SCALAR);
+
+/// Widest column group processed by a vertical blur kernel.
+pub(crate) const MAX_BLUR_LANES: usize = 8;
+
+/// Pick the widest kernel set the CPU supports.
+pub(crate) fn init() {
+    LEVEL.store(detect(), Ordering::Relaxed);
+    anyos_std::println!("compositor: row kernels: {}", level_name());
+}
+
+#[cfg(target_arch = "x86_64")]
+fn detect() -> u8 {
+    use core::arch::x86_64::{__cpuid, __cpuid_count};
+    let leaf1 = unsafe { __cpuid(1) };
+    if leaf1.ecx & (1 << 19) == 0 || leaf1.ecx & (1 << 9) == 0 {
+        return LEVEL_SCALAR;
+    }
+    // AVX2 needs the OS to save YMM state (OSXSAVE + XCR0 bits 1-2).
+    let osxsave = leaf1.ecx & (1 << 27) != 0;
+    let avx = leaf1.ecx & (1 << 28) != 0;
+    if osxsave && avx && unsafe { __cpuid(0) }.eax >= 7 {
+        let xcr0: u32;
+        unsafe {
+            core::arch::asm!("xgetbv", in("ecx") 0u32, out("eax") xcr0, out("edx") _,
+                options(nomem, nostack, preserves_flags));
+        }
+        let avx2 = unsafe { __cpuid_count(7, 0) }.ebx & (1 << 5) != 0;
+        if xcr0 & 0x6 == 0x6 && avx2 {
+            return LEVEL_AVX2;
+        }
+    }
+    LEVEL_SSE41
+}
+
+#[cfg(target_arch = "aarch64")]
+fn detect() -> u8 {
+    // NEON is mandatory on AArch64.
+    LEVEL_NEON
+}
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+fn detect() -> u8 {
+    LEVEL_SCALAR
+}
+
+/// Name of the selected kernel set.
+pub(crate) fn level_name() -> &'static str {
+    match LEVEL.load(Ordering::Relaxed) {
+        LEVEL_SSE41 => "SSE4.1",
+        LEVEL_AVX2 => "AVX2",
+        LEVEL_NEON => "NEON",
+        _ => "scalar",
+    }
+}
+
+// ── Public row kernels ──────────────────────────────────────────────────────
+
+/// Blend `src` over `dst` (ARGB8888, equal lengths).
+pub(crate) fn blend_row(dst: &mut [u32], src: &[u32]) {
+    let n = dst.len().min(src.len());
+    let done = match LEVEL.load(Ordering::Relaxed) {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::blend_row_avx2(dst, src, n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE41 => unsafe { x86::blend_row_sse41(dst, src, n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::blend_row(dst, src, n) },
+        _ => 0,
+    };
+    blend_row_scalar(&mut dst[done..n], &src[done..n]);
+}
+
+/// Blend a black shadow with per-pixel `alphas` onto `dst`.
+pub(crate) fn shadow_row(dst: &mut [u32], alphas: &[u8]) {
+    let n = dst.len().min(alphas.len());
+    let done = match LEVEL.load(Ordering::Relaxed) {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::shadow_row_avx2(dst, alphas, n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE41 => unsafe { x86::shadow_row_sse41(dst, alphas, n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::shadow_row(dst, alphas, n) },
+        _ => 0,
+    };
+    for (d, &a) in dst[done..n].iter_mut().zip(&alphas[done..n]) {
+        if a != 0 {
+            *d = shadow_blend(a as u32, *d);
+        }
+    }
+}
+
+/// Copy an opaque row.
+pub(crate) fn copy_row(dst: &mut [u32], src: &[u32]) {
+    let n = dst.len().min(src.len());
+    let done = match LEVEL.load(Ordering::Relaxed) {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 => unsafe { x86::copy_row_avx2(dst, src, n) },
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_SSE41 => unsafe { x86::copy_row_sse2(dst, src, n) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::copy_row(dst, src, n) },
+        _ => 0,
+    };
+    dst[done..n].copy_from_slice(&src[done..n]);
+}
+
+/// Horizontal box-blur pass over `x0..x0+w` of one framebuffer row
+/// (`row.len()` = framebuffer width), written to `out[..w]`.
+pub(crate) fn blur_h_row(row: &[u32], x0: usize, w: usize, r: usize, recip: u32, out: &mut [u32]) {
+    match LEVEL.load(Ordering::Relaxed) {
+        #[cfg(target_arch = "x86_64")]
+        LEVEL_AVX2 | LEVEL_SSE41 => unsafe { x86::blur_h_row_sse41(row, x0, w, r, recip, out) },
+        #[cfg(target_arch = "aarch64")]
+        LEVEL_NEON => unsafe { neon::blur_h_row(row, x0, w, r, recip, out) },
+        _ => blur_h_row_scalar(row, x0, w, r, recip, out),
+    }
+}
+
+/// Vertical box-blur pass over columns `x0..x1`, rows `y0..y0+h`, in place.
+/// `temp` must hold `h * MAX_BLUR_LANES` pixels.
+pub(crate) fn blur_v_pass(
+    bb: &mut [u32], stride: usize, fb_h: usize,
+    x0: usize, x1: usize, y0: usize, h: usize,
+    r: usize, recip: u32, temp: &mut [u32],
+) {
+    let lanes = match LEVEL.load(Ordering::Relaxed) {
+        LEVEL_AVX2 => 8,
+        LEVEL_SSE41 | LEVEL_NEON => 4,
+        _ => 1,
+    };
+    let mut col = x0;
+    while lanes > 1 && col + lanes <= x1 {
+        match lanes {
+            #[cfg(target_arch = "x86_64")]
+            8 => unsafe { x86::blur_v_cols_avx2(bb, stride, fb_h, col, y0, h, r, recip, temp) },
+            #[cfg(target_arch = "x86_64")]
+            4 => unsafe { x86::blur_v_cols_sse41(bb, stride, fb_h, col, y0, h, r, recip, temp) },
+            #[cfg(target_arch = "aarch64")]
+            4 => unsafe { neon::blur_v_cols(bb, stride, fb_h, col, y0, h, r, recip, temp) },
+            _ => unreachable!(),
+        }
+        for row in 0..h {
+            let d = (y0 + row) * stride + col;
+            bb[d..d + lanes].copy_from_slice(&temp[row * lanes..(row + 1) * lanes]);
+        }
+        col += lanes;
+    }
+    while col < x1 {
+        blur_v_column_scalar(bb, stride, fb_h, col, y0, h, r, recip, temp);
+        col += 1;
+    }
+}
+
+fn blend_row_scalar(dst: &mut [u32], src: &[u32]) {
+    for (d, &s) in dst.iter_mut().zip(src) {
+        let a = s >> 24;
+        if a >= 255 {
+            *d = s;
+        } else if a != 0 {
+            *d = alpha_blend(s, *d);
+        }
+    }
+}
+
+// ── x86_64: SSE4.1 / AVX2 ───────────────────────────────────────────────────
+
+#[cfg(target_arch = "x86_64")]
+mod x86 {
+    use core::arch::x86_64::*;
+
+    /// `div255` on 16-bit lanes: `(x + 1 + (x >> 8)) >> 8`.
+    #[inline(always)]
+    unsafe fn div255_epi16(x: __m128i) -> __m128i {
+        let one = _mm_set1_epi16(1);
+        _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8)
+    }
+
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn div255_epi16_256(x: __m256i) -> __m256i {
+        let one = _mm256_set1_epi16(1);
+        _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, one), _mm256_srli_epi16(x, 8)), 8)
+    }
+
+    /// Blend 4 pixels `s` over `d`.
+    #[inline]
+    #[target_feature(enable = "ssse3,sse4.1")]
+    unsafe fn blend4(s: __m128i, d: __m128i) -> __m128i {
+        let zero = _mm_setzero_si128();
+        let amask = _mm_set1_epi32(0xFF00_0000u32 as i32);
+        // Broadcast each pixel's alpha byte to its four 16-bit channel lanes.
+        let bcast_lo = _mm_setr_epi8(3, -1, 3, -1, 3, -1, 3, -1, 7, -1, 7, -1, 7, -1, 7, -1);
+        let bcast_hi = _mm_setr_epi8(11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1);
+        let sa_lo = _mm_shuffle_epi8(s, bcast_lo);
+        let sa_hi = _mm_shuffle_epi8(s, bcast_hi);
+        let c255 = _mm_set1_epi16(255);
+        let inv_lo = _mm_sub_epi16(c255, sa_lo);
+        let inv_hi = _mm_sub_epi16(c255, sa_hi);
+        let s1 = _mm_or_si128(s, amask);
+        let t_lo = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(s1, zero), sa_lo),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_lo),
+        );
+        let t_hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(s1, zero), sa_hi),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_hi),
+        );
+        _mm_packus_epi16(div255_epi16(t_lo), div255_epi16(t_hi))
+    }
+
+    /// Blend 8 pixels `s` over `d` (same lane layout as [`blend4`], per 128-bit half).
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn blend8(s: __m256i, d: __m256i) -> __m256i {
+        let zero = _mm256_setzero_si256();
+        let amask = _mm256_set1_epi32(0xFF00_0000u32 as i32);
+        let bcast_lo = _mm256_setr_epi8(
+            3, -1, 3, -1, 3, -1, 3, -1, 7, -1, 7, -1, 7, -1, 7, -1,
+            3, -1, 3, -1, 3, -1, 3, -1, 7, -1, 7, -1, 7, -1, 7, -1,
+        );
+        let bcast_hi = _mm256_setr_epi8(
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1,
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1,
+        );
+        let sa_lo = _mm256_shuffle_epi8(s, bcast_lo);
+        let sa_hi = _mm256_shuffle_epi8(s, bcast_hi);
+        let c255 = _mm256_set1_epi16(255);
+        let inv_lo = _mm256_sub_epi16(c255, sa_lo);
+        let inv_hi = _mm256_sub_epi16(c255, sa_hi);
+        let s1 = _mm256_or_si256(s, amask);
+        let t_lo = _mm256_add_epi16(
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(s1, zero), sa_lo),
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv_lo),
+        );
+        let t_hi = _mm256_add_epi16(
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(s1, zero), sa_hi),
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv_hi),
+        );
+        _mm256_packus_epi16(div255_epi16_256(t_lo), div255_epi16_256(t_hi))
+    }
+
+    #[target_feature(enable = "ssse3,sse4.1")]
+    pub(super) unsafe fn blend_row_sse41(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let amask = _mm_set1_epi32(0xFF00_0000u32 as i32);
+        let zero = _mm_setzero_si128();
+        let mut i = 0;
+        while i + 4 <= n {
+            let s = _mm_loadu_si128(src.as_ptr().add(i) as *const __m128i);
+            let sa = _mm_and_si128(s, amask);
+            if _mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) != 0xFFFF {
+                let dp = dst.as_mut_ptr().add(i) as *mut __m128i;
+                if _mm_movemask_epi8(_mm_cmpeq_epi32(sa, amask)) == 0xFFFF {
+                    _mm_storeu_si128(dp, s);
+                } else {
+                    _mm_storeu_si128(dp, blend4(s, _mm_loadu_si128(dp)));
+                }
+            }
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn blend_row_avx2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let amask = _mm256_set1_epi32(0xFF00_0000u32 as i32);
+        let zero = _mm256_setzero_si256();
+        let mut i = 0;
+        while i + 8 <= n {
+            let s = _mm256_loadu_si256(src.as_ptr().add(i) as *const __m256i);
+            let sa = _mm256_and_si256(s, amask);
+            if _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) != -1 {
+                let dp = dst.as_mut_ptr().add(i) as *mut __m256i;
+                if _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, amask)) == -1 {
+                    _mm256_storeu_si256(dp, s);
+                } else {
+                    _mm256_storeu_si256(dp, blend8(s, _mm256_loadu_si256(dp)));
+                }
+            }
+            i += 8;
+        }
+        i
+    }
+
+    // A shadow pixel is black with the cached alpha, so it goes through the
+    // plain blend with a synthesised source `a << 24`.
+
+    #[target_feature(enable = "ssse3,sse4.1")]
+    pub(super) unsafe fn shadow_row_sse41(dst: &mut [u32], alphas: &[u8], n: usize) -> usize {
+        let mut i = 0;
+        while i + 4 <= n {
+            let a4 = (alphas.as_ptr().add(i) as *const u32).read_unaligned();
+            if a4 != 0 {
+                let s = _mm_slli_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(a4 as i32)), 24);
+                let dp = dst.as_mut_ptr().add(i) as *mut __m128i;
+                _mm_storeu_si128(dp, blend4(s, _mm_loadu_si128(dp)));
+            }
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn shadow_row_avx2(dst: &mut [u32], alphas: &[u8], n: usize) -> usize {
+        let mut i = 0;
+        while i + 8 <= n {
+            let a8 = (alphas.as_ptr().add(i) as *const u64).read_unaligned();
+            if a8 != 0 {
+                let s = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi64_si128(a8 as i64)), 24);
+                let dp = dst.as_mut_ptr().add(i) as *mut __m256i;
+                _mm256_storeu_si256(dp, blend8(s, _mm256_loadu_si256(dp)));
+            }
+            i += 8;
+        }
+        i
+    }
+
+    pub(super) unsafe fn copy_row_sse2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 4 <= n {
+            let v = _mm_loadu_si128(src.as_ptr().add(i) as *const __m128i);
+            _mm_storeu_si128(dst.as_mut_ptr().add(i) as *mut __m128i, v);
+            i += 4;
+        }
+        i
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn copy_row_avx2(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 8 <= n {
+            let v = _mm256_loadu_si256(src.as_ptr().add(i) as *const __m256i);
+            _mm256_storeu_si256(dst.as_mut_ptr().add(i) as *mut __m256i, v);
+            i += 8;
+        }
+        i
+    }
+
+    /// One pixel as `[b, g, r, a]` in 32-bit lanes.
+    #[inline]
+    #[target_feature(enable = "sse4.1")]
+    unsafe fn unpack_px(px: u32) -> __m128i {
+        _mm_cvtepu8_epi32(_mm_cvtsi32_si128(px as i32))
+    }
+
+    /// Horizontal pass: all three channel sums slide in one register.
+    #[target_feature(enable = "sse4.1")]
+    pub(super) unsafe fn blur_h_row_sse41(row: &[u32], x0: usize, w: usize, r: usize, recip: u32, out: &mut [u32]) {
+        let last = row.len() as isize - 1;
+        let clamp = |x: isize| x.max(0).min(last) as usize;
+        let recipv = _mm_set1_epi32(recip as i32);
+        let mut sum = _mm_setzero_si128();
+        for i in 0..=(2 * r) {
+            sum = _mm_add_epi32(sum, unpack_px(row[clamp(x0 as isize + i as isize - r as isize)]));
+        }
+        for col in 0..w {
+            let cx = (x0 + col) as isize;
+            let v = _mm_srli_epi32(_mm_mullo_epi32(sum, recipv), 16);
+            let packed = _mm_packus_epi16(_mm_packus_epi32(v, v), v);
+            out[col] = 0xFF00_0000 | _mm_cvtsi128_si32(packed) as u32;
+            let add_px = row[clamp(cx + r as isize + 1)];
+            let rem_px = row[clamp(cx - r as isize)];
+            sum = _mm_sub_epi32(_mm_add_epi32(sum, unpack_px(add_px)), unpack_px(rem_px));
+        }
+    }
+
+    /// Vertical pass over 4 adjacent columns starting at `col`; results go
+    /// to `temp[row * 4 + lane]`.
+    #[target_feature(enable = "sse4.1")]
+    pub(super) unsafe fn blur_v_cols_sse41(
+        bb: &[u32], stride: usize, fb_h: usize, col: usize,
+        y0: usize, h: usize, r: usize, recip: u32, temp: &mut [u32],
+    ) {
+        let last = fb_h as isize - 1;
+        // A macro rather than a closure, so the load stays in this
+        // function's target-feature context.
+        macro_rules! load {
+            ($y:expr) => {
+                _mm_loadu_si128(bb.as_ptr().add(($y).max(0).min(last) as usize * stride + col) as *const __m128i)
+            };
+        }
+        let m = _mm_set1_epi32(0xFF);
+        let recipv = _mm_set1_epi32(recip as i32);
+        let (mut sr, mut sg, mut sb) = (_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128());
+        for i in 0..=(2 * r) {
+            let p = load!(y0 as isize + i as isize - r as isize);
+            sr = _mm_add_epi32(sr, _mm_and_si128(_mm_srli_epi32(p, 16), m));
+            sg = _mm_add_epi32(sg, _mm_and_si128(_mm_srli_epi32(p, 8), m));
+            sb = _mm_add_epi32(sb, _mm_and_si128(p, m));
+        }
+        let alpha = _mm_set1_epi32(0xFF00_0000u32 as i32);
+        for row in 0..h {
+            let cy = (y0 + row) as isize;
+            let r_ = _mm_srli_epi32(_mm_mullo_epi32(sr, recipv), 16);
+            let g_ = _mm_srli_epi32(_mm_mullo_epi32(sg, recipv), 16);
+            let b_ = _mm_srli_epi32(_mm_mullo_epi32(sb, recipv), 16);
+            let px = _mm_or_si128(
+                _mm_or_si128(alpha, _mm_slli_epi32(r_, 16)),
+                _mm_or_si128(_mm_slli_epi32(g_, 8), b_),
+            );
+            _mm_storeu_si128(temp.as_mut_ptr().add(row * 4) as *mut __m128i, px);
+            let a = load!(cy + r as isize + 1);
+            let d = load!(cy - r as isize);
+            sr = _mm_sub_epi32(_mm_add_epi32(sr, _mm_and_si128(_mm_srli_epi32(a, 16), m)), _mm_and_si128(_mm_srli_epi32(d, 16), m));
+            sg = _mm_sub_epi32(_mm_add_epi32(sg, _mm_and_si128(_mm_srli_epi32(a, 8), m)), _mm_and_si128(_mm_srli_epi32(d, 8), m));
+            sb = _mm_sub_epi32(_mm_add_epi32(sb, _mm_and_si128(a, m)), _mm_and_si128(d, m));
+        }
+    }
+
+    /// Vertical pass over 8 adjacent columns starting at `col`.
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn blur_v_cols_avx2(
+        bb: &[u32], stride: usize, fb_h: usize, col: usize,
+        y0: usize, h: usize, r: usize, recip: u32, temp: &mut [u32],
+    ) {
+        let last = fb_h as isize - 1;
+        macro_rules! load {
+            ($y:expr) => {
+                _mm256_loadu_si256(bb.as_ptr().add(($y).max(0).min(last) as usize * stride + col) as *const __m256i)
+            };
+        }
+        let m = _mm256_set1_epi32(0xFF);
+        let recipv = _mm256_set1_epi32(recip as i32);
+        let (mut sr, mut sg, mut sb) = (_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256());
+        for i in 0..=(2 * r) {
+            let p = load!(y0 as isize + i as isize - r as isize);
+            sr = _mm256_add_epi32(sr, _mm256_and_si256(_mm256_srli_epi32(p, 16), m));
+            sg = _mm256_add_epi32(sg, _mm256_and_si256(_mm256_srli_epi32(p, 8), m));
+            sb = _mm256_add_epi32(sb, _mm256_and_si256(p, m));
+        }
+        let alpha = _mm256_set1_epi32(0xFF00_0000u32 as i32);
+        for row in 0..h {
+            let cy = (y0 + row) as isize;
+            let r_ = _mm256_srli_epi32(_mm256_mullo_epi32(sr, recipv), 16);
+            let g_ = _mm256_srli_epi32(_mm256_mullo_epi32(sg, recipv), 16);
+            let b_ = _mm256_srli_epi32(_mm256_mullo_epi32(sb, recipv), 16);
+            let px = _mm256_or_si256(
+                _mm256_or_si256(alpha, _mm256_slli_epi32(r_, 16)),
+                _mm256_or_si256(_mm256_slli_epi32(g_, 8), b_),
+            );
+            _mm256_storeu_si256(temp.as_mut_ptr().add(row * 8) as *mut __m256i, px);
+            let a = load!(cy + r as isize + 1);
+            let d = load!(cy - r as isize);
+            sr = _mm256_sub_epi32(_mm256_add_epi32(sr, _mm256_and_si256(_mm256_srli_epi32(a, 16), m)), _mm256_and_si256(_mm256_srli_epi32(d, 16), m));
+            sg = _mm256_sub_epi32(_mm256_add_epi32(sg, _mm256_and_si256(_mm256_srli_epi32(a, 8), m)), _mm256_and_si256(_mm256_srli_epi32(d, 8), m));
+            sb = _mm256_sub_epi32(_mm256_add_epi32(sb, _mm256_and_si256(a, m)), _mm256_and_si256(d, m));
+        }
+    }
+}
+
+// ── aarch64: NEON ───────────────────────────────────────────────────────────
+
+#[cfg(target_arch = "aarch64")]
+mod neon {
+    use core::arch::aarch64::*;
+
+    #[inline(always)]
+    unsafe fn div255_u16(x: uint16x8_t) -> uint8x8_t {
+        vshrn_n_u16::<8>(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16::<8>(x)))
+    }
+
+    /// Blend 8 deinterleaved pixels (`.0`=B, `.1`=G, `.2`=R, `.3`=A).
+    #[inline(always)]
+    unsafe fn blend8(s: uint8x8x4_t, d: uint8x8x4_t) -> uint8x8x4_t {
+        let sa = s.3;
+        let inv = vmvn_u8(sa);
+        uint8x8x4_t(
+            div255_u16(vmlal_u8(vmull_u8(s.0, sa), d.0, inv)),
+            div255_u16(vmlal_u8(vmull_u8(s.1, sa), d.1, inv)),
+            div255_u16(vmlal_u8(vmull_u8(s.2, sa), d.2, inv)),
+            div255_u16(vmlal_u8(vmull_u8(vdup_n_u8(255), sa), d.3, inv)),
+        )
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn blend_row(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 8 <= n {
+            let sp = src.as_ptr().add(i) as *const u8;
+            let dp = dst.as_mut_ptr().add(i) as *mut u8;
+            let s = vld4_u8(sp);
+            if vmaxv_u8(s.3) != 0 {
+                if vminv_u8(s.3) == 255 {
+                    vst1q_u32(dp as *mut u32, vld1q_u32(sp as *const u32));
+                    vst1q_u32((dp as *mut u32).add(4), vld1q_u32((sp as *const u32).add(4)));
+                } else {
+                    vst4_u8(dp, blend8(s, vld4_u8(dp)));
+                }
+            }
+            i += 8;
+        }
+        i
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn shadow_row(dst: &mut [u32], alphas: &[u8], n: usize) -> usize {
+        let mut i = 0;
+        let zero = vdup_n_u8(0);
+        while i + 8 <= n {
+            let a = vld1_u8(alphas.as_ptr().add(i));
+            if vmaxv_u8(a) != 0 {
+                let dp = dst.as_mut_ptr().add(i) as *mut u8;
+                vst4_u8(dp, blend8(uint8x8x4_t(zero, zero, zero, a), vld4_u8(dp)));
+            }
+            i += 8;
+        }
+        i
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn copy_row(dst: &mut [u32], src: &[u32], n: usize) -> usize {
+        let mut i = 0;
+        while i + 4 <= n {
+            vst1q_u32(dst.as_mut_ptr().add(i), vld1q_u32(src.as_ptr().add(i)));
+            i += 4;
+        }
+        i
+    }
+
+    /// One pixel as `[b, g, r, a]` in 32-bit lanes.
+    #[inline(always)]
+    unsafe fn unpack_px(px: u32) -> uint32x4_t {
+        vmovl_u16(vget_low_u16(vmovl_u8(vcreate_u8(px as u64))))
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn blur_h_row(row: &[u32], x0: usize, w: usize, r: usize, recip: u32, out: &mut [u32]) {
+        let last = row.len() as isize - 1;
+        let clamp = |x: isize| x.max(0).min(last) as usize;
+        let recipv = vdupq_n_u32(recip);
+        let mut sum = vdupq_n_u32(0);
+        for i in 0..=(2 * r) {
+            sum = vaddq_u32(sum, unpack_px(row[clamp(x0 as isize + i as isize - r as isize)]));
+        }
+        for col in 0..w {
+            let cx = (x0 + col) as isize;
+            let v = vmovn_u32(vshrq_n_u32::<16>(vmulq_u32(sum, recipv)));
+            let b = vmovn_u16(vcombine_u16(v, v));
+            out[col] = 0xFF00_0000 | vget_lane_u32::<0>(vreinterpret_u32_u8(b));
+            let add_px = row[clamp(cx + r as isize + 1)];
+            let rem_px = row[clamp(cx - r as isize)];
+            sum = vsubq_u32(vaddq_u32(sum, unpack_px(add_px)), unpack_px(rem_px));
+        }
+    }
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn blur_v_cols(
+        bb: &[u32], stride: usize, fb_h: usize, col: usize,
+        y0: usize, h: usize, r: usize, recip: u32, temp: &mut [u32],
+    ) {
+        let last = fb_h as isize - 1;
+        let load = |y: isize| {
+            let y = y.max(0).min(last) as usize;
+            vld1q_u32(bb.as_ptr().add(y * stride + col))
+        };
+        let m = vdupq_n_u32(0xFF);
+        let recipv = vdupq_n_u32(recip);
+        let (mut sr, mut sg, mut sb) = (vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0));
+        for i in 0..=(2 * r) {
+            let p = load(y0 as isize + i as isize - r as isize);
+            sr = vaddq_u32(sr, vandq_u32(vshrq_n_u32::<16>(p), m));
+            sg = vaddq_u32(sg, vandq_u32(vshrq_n_u32::<8>(p), m));
+            sb = vaddq_u32(sb, vandq_u32(p, m));
+        }
+        let alpha = vdupq_n_u32(0xFF00_0000);
+        for row in 0..h {
+            let cy = (y0 + row) as isize;
+            let r_ = vshrq_n_u32::<16>(vmulq_u32(sr, recipv));
+            let g_ = vshrq_n_u32::<16>(vmulq_u32(sg, recipv));
+            let b_ = vshrq_n_u32::<16>(vmulq_u32(sb, recipv));
+            let px = vorrq_u32(vorrq_u32(alpha, vshlq_n_u32::<16>(r_)), vorrq_u32(vshlq_n_u32::<8>(g_), b_));
+            vst1q_u32(temp.as_mut_ptr().add(row * 4), px);
+            let a = load(cy + r as isize + 1);
+            let d = load(cy - r as isize);
+            sr = vsubq_u32(vaddq_u32(sr, vandq_u32(vshrq_n_u32::<16>(a), m)), vandq_u32(vshrq_n_u32::<16>(d), m));
+            sg = vsubq_u32(vaddq_u32(sg, vandq_u32(vshrq_n_u32::<8>(a), m)), vandq_u32(vshrq_n_u32::<8>(d), m));
+            sb = vsubq_u32(vaddq_u32(sb, vandq_u32(a, m)), vandq_u32(d, m));
+        }
+    }
+}
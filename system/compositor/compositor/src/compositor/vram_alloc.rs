@@ -1,20 +1,37 @@
 //! Off-screen VRAM allocator for VRAM-direct surfaces.
 //!
-//! Manages off-screen VRAM (beyond the visible framebuffer) as a simple
-//! linear allocator with a free list. Each allocation is pitch-aligned
-//! (one row per pitch bytes) so GPU RECT_COPY can address it directly.
+//! Manages off-screen VRAM (beyond the visible framebuffer) in whole rows of
+//! the screen pitch, so GPU RECT_COPY can address every surface directly.
+//! Free space is kept as a sorted list of row extents that are coalesced on
+//! free; allocations take the smallest extent that fits (best-fit).
+//!
+//! Surfaces start on rows whose byte offset is page-aligned (`vram_map`
+//! maps whole pages), and their row counts are rounded to the same
+//! granularity so every free extent stays aligned too.
+//!
+//! Windows opening and closing still leave holes between long-lived
+//! surfaces.  [`VramAllocator::plan_move`] picks a surface that fits into a
+//! hole below it; the caller copies it there and commits the move with
+//! [`VramAllocator::relocate`], packing surfaces toward the framebuffer so
+//! the free space collects in one extent at the top.
 
 use alloc::vec::Vec;
 
+/// Fragmentation (‰ of free VRAM outside the largest extent) above which
+/// idle-time compaction moves surfaces.
+pub const COMPACT_THRESHOLD_PERMILLE: u32 = 250;
+
 /// A single VRAM allocation (off-screen region for an app surface).
 #[derive(Clone, Copy)]
 pub struct VramAlloc {
     /// Byte offset from VRAM start.
     pub offset: u32,
-    /// Allocation size in bytes.
+    /// Allocation size in bytes (the mapped surface, `pitch * height`).
     pub size: u32,
     /// Y-coordinate in VRAM (row index, for RECT_COPY source).
     pub vram_y: u32,
+    /// Rows reserved for the surface (`height` rounded to the row alignment).
+    pub rows: u32,
     /// Surface width in pixels.
     pub width: u32,
     /// Surface height in pixels.
@@ -23,6 +40,18 @@ pub struct VramAlloc {
     pub layer_id: u32,
 }
 
+/// Allocator state for the stats log.
+#[derive(Clone, Copy, Default)]
+pub struct VramStats {
+    pub surfaces: u32,
+    pub free_bytes: u32,
+    pub largest_free_bytes: u32,
+    /// Free VRAM outside the largest free extent, in ‰ of all free VRAM.
+    pub fragmentation_permille: u32,
+    /// Surfaces moved by compaction since start.
+    pub moves: u32,
+}
+
 /// VRAM off-screen allocator.
 pub struct VramAllocator {
     /// Total VRAM size in bytes.
@@ -31,28 +60,44 @@ pub struct VramAllocator {
     fb_used_bytes: u32,
     /// Screen pitch in bytes.
     pitch: u32,
+    /// Row granularity of surface starts and sizes.
+    align_rows: u32,
     /// Active allocations, sorted by offset.
     allocs: Vec<VramAlloc>,
+    /// Free `(start_row, rows)` extents, sorted and coalesced.
+    free: Vec<(u32, u32)>,
+    moves: u32,
 }
 
 impl VramAllocator {
     /// Create a new allocator. `fb_pitch` is the screen pitch in bytes,
     /// `fb_height` is the visible screen height, `vram_total` is the total VRAM.
     pub fn new(fb_pitch: u32, fb_height: u32, vram_total: u32) -> Self {
-        let fb_used = fb_pitch * fb_height;
-        VramAllocator {
-            total_bytes: vram_total,
-            fb_used_bytes: fb_used,
-            pitch: fb_pitch,
+        let mut a = VramAllocator {
+            total_bytes: 0,
+            fb_used_bytes: 0,
+            pitch: 0,
+            align_rows: 1,
             allocs: Vec::with_capacity(16),
-        }
+            free: Vec::with_capacity(16),
+            moves: 0,
+        };
+        a.update_fb(fb_pitch, fb_height, vram_total);
+        a
+    }
+
+    fn align_up(&self, rows: u32) -> u32 {
+        rows.div_ceil(self.align_rows) * self.align_rows
     }
 
     /// Available off-screen VRAM in bytes.
     pub fn free_bytes(&self) -> u32 {
-        let used: u32 = self.allocs.iter().map(|a| a.size).sum();
-        let off_screen = self.total_bytes.saturating_sub(self.fb_used_bytes);
-        off_screen.saturating_sub(used)
+        self.free.iter().map(|&(_, rows)| rows * self.pitch).sum()
+    }
+
+    /// Total VRAM size in bytes.
+    pub fn total_bytes(&self) -> u32 {
+        self.total_bytes
     }
 
     /// Total off-screen VRAM in bytes.
@@ -60,66 +105,81 @@ impl VramAllocator {
         self.total_bytes.saturating_sub(self.fb_used_bytes)
     }
 
-    /// Allocate an off-screen VRAM region for a surface of given dimensions.
-    /// The allocation uses `pitch * height` bytes (matching screen stride).
-    /// Returns `Some(VramAlloc)` on success, `None` if out of VRAM.
-    pub fn alloc(&mut self, width: u32, height: u32, layer_id: u32) -> Option<VramAlloc> {
-        if width == 0 || height == 0 || self.pitch == 0 {
-            return None;
+    /// Best-fit free extent of at least `rows` rows starting below `limit`.
+    fn best_fit(&self, rows: u32, limit: u32) -> Option<usize> {
+        let mut best: Option<usize> = None;
+        for (i, &(start, len)) in self.free.iter().enumerate() {
+            if start >= limit {
+                break;
+            }
+            if len >= rows && best.map_or(true, |b| len < self.free[b].1) {
+                best = Some(i);
+            }
         }
+        best
+    }
 
-        // Each row in off-screen VRAM uses the full screen pitch
-        let size = self.pitch * height;
-        let off_screen_start = self.fb_used_bytes;
-        let off_screen_end = self.total_bytes;
-
-        if size > off_screen_end.saturating_sub(off_screen_start) {
-            return None;
+    /// Remove `rows` rows from the start of free extent `i`.  Returns the row.
+    fn take(&mut self, i: usize, rows: u32) -> u32 {
+        let (start, len) = self.free[i];
+        if len == rows {
+            self.free.remove(i);
+        } else {
+            self.free[i] = (start + rows, len - rows);
         }
+        start
+    }
 
-        // Find the first gap that fits (first-fit)
-        // Align start offset to pitch boundary
-        let align_to_pitch = |off: u32| -> u32 {
-            let rem = off % self.pitch;
-            if rem == 0 { off } else { off + self.pitch - rem }
-        };
-
-        let mut candidate = align_to_pitch(off_screen_start);
-
-        for alloc in &self.allocs {
-            if candidate + size <= alloc.offset {
-                // Gap before this allocation
-                break;
+    /// Return rows to the free list, merging with adjacent extents.
+    fn release(&mut self, start: u32, rows: u32) {
+        let i = self.free.partition_point(|&(s, _)| s < start);
+        let merge_prev = i > 0 && self.free[i - 1].0 + self.free[i - 1].1 == start;
+        let merge_next = i < self.free.len() && start + rows == self.free[i].0;
+        match (merge_prev, merge_next) {
+            (true, true) => {
+                self.free[i - 1].1 += rows + self.free[i].1;
+                self.free.remove(i);
             }
-            // Move past this allocation
-            candidate = align_to_pitch(alloc.offset + alloc.size);
+            (true, false) => self.free[i - 1].1 += rows,
+            (false, true) => self.free[i] = (start, rows + self.free[i].1),
+            (false, false) => self.free.insert(i, (start, rows)),
         }
+    }
 
-        if candidate + size > off_screen_end {
-            return None; // No room
-        }
+    fn insert_sorted(&mut self, entry: VramAlloc) {
+        let pos = self.allocs.partition_point(|a| a.offset < entry.offset);
+        self.allocs.insert(pos, entry);
+    }
 
-        let vram_y = candidate / self.pitch;
+    /// Allocate an off-screen VRAM region for a surface of given dimensions.
+    /// The allocation uses `pitch * height` bytes (matching screen stride).
+    /// Returns `Some(VramAlloc)` on success, `None` if out of VRAM.
+    pub fn alloc(&mut self, width: u32, height: u32, layer_id: u32) -> Option<VramAlloc> {
+        if width == 0 || height == 0 || self.pitch == 0 || width * 4 > self.pitch {
+            return None;
+        }
+        let rows = self.align_up(height);
+        let i = self.best_fit(rows, u32::MAX)?;
+        let vram_y = self.take(i, rows);
         let entry = VramAlloc {
-            offset: candidate,
-            size,
+            offset: vram_y * self.pitch,
+            size: self.pitch * height,
             vram_y,
+            rows,
             width,
             height,
             layer_id,
         };
-
-        // Insert sorted by offset
-        let pos = self.allocs.iter().position(|a| a.offset > candidate)
-            .unwrap_or(self.allocs.len());
-        self.allocs.insert(pos, entry);
-
+        self.insert_sorted(entry);
         Some(entry)
     }
 
     /// Free a VRAM allocation by layer ID.
     pub fn free(&mut self, layer_id: u32) {
-        self.allocs.retain(|a| a.layer_id != layer_id);
+        if let Some(i) = self.allocs.iter().position(|a| a.layer_id == layer_id) {
+            let a = self.allocs.remove(i);
+            self.release(a.vram_y, a.rows);
+        }
     }
 
     /// Look up allocation by layer ID.
@@ -127,6 +187,55 @@ impl VramAllocator {
         self.allocs.iter().find(|a| a.layer_id == layer_id)
     }
 
+    /// Free VRAM outside the largest free extent, in ‰ of all free VRAM
+    /// (0 = all free space is contiguous).
+    pub fn fragmentation_permille(&self) -> u32 {
+        let total: u64 = self.free.iter().map(|&(_, rows)| rows as u64).sum();
+        let largest = self.free.iter().map(|&(_, rows)| rows).max().unwrap_or(0) as u64;
+        if total == 0 { 0 } else { (1000 - largest * 1000 / total) as u32 }
+    }
+
+    pub fn stats(&self) -> VramStats {
+        let largest = self.free.iter().map(|&(_, rows)| rows).max().unwrap_or(0);
+        VramStats {
+            surfaces: self.allocs.len() as u32,
+            free_bytes: self.free_bytes(),
+            largest_free_bytes: largest * self.pitch,
+            fragmentation_permille: self.fragmentation_permille(),
+            moves: self.moves,
+        }
+    }
+
+    /// Next compaction step: the highest surface that fits into a free
+    /// extent below it, with the row to move it to.  `None` if VRAM is not
+    /// fragmented enough to be worth it or nothing can move down.
+    pub fn plan_move(&self) -> Option<(VramAlloc, u32)> {
+        if self.fragmentation_permille() <= COMPACT_THRESHOLD_PERMILLE {
+            return None;
+        }
+        self.allocs.iter().rev().find_map(|a| {
+            let i = self.best_fit(a.rows, a.vram_y)?;
+            Some((*a, self.free[i].0))
+        })
+    }
+
+    /// Commit a move planned by [`plan_move`](Self::plan_move) after the
+    /// surface contents were copied to `new_row`.  Returns the updated
+    /// allocation, or `None` if the rows are no longer free.
+    pub fn relocate(&mut self, layer_id: u32, new_row: u32) -> Option<VramAlloc> {
+        let ai = self.allocs.iter().position(|a| a.layer_id == layer_id)?;
+        let rows = self.allocs[ai].rows;
+        let fi = self.free.iter().position(|&(s, len)| s == new_row && len >= rows)?;
+        self.take(fi, rows);
+        let mut a = self.allocs.remove(ai);
+        self.release(a.vram_y, a.rows);
+        a.vram_y = new_row;
+        a.offset = new_row * self.pitch;
+        self.insert_sorted(a);
+        self.moves = self.moves.wrapping_add(1);
+        Some(a)
+    }
+
     /// Update screen parameters (e.g., after resolution change).
     /// Frees all allocations since they're no longer valid.
     pub fn update_fb(&mut self, fb_pitch: u32, fb_height: u32, vram_total: u32) {
@@ -134,5 +243,23 @@ impl VramAllocator {
         self.fb_used_bytes = fb_pitch * fb_height;
         self.total_bytes = vram_total;
         self.allocs.clear();
+        self.free.clear();
+        if fb_pitch == 0 {
+            return;
+        }
+        // Smallest row count whose byte size is a whole number of pages.
+        let mut a = fb_pitch;
+        let mut b = 4096u32;
+        while b != 0 {
+            let t = a % b;
+            a = b;
+            b = t;
+        }
+        self.align_rows = 4096 / a;
+        let first = self.align_up(fb_height);
+        let end = vram_total / fb_pitch / self.align_rows * self.align_rows;
+        if end > first {
+            self.free.push((first, end - first));
+        }
     }
 }
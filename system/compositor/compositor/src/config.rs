@@ -4,6 +4,7 @@
 //!   `[resolution]` — saved display resolution (width, height)
 //!   `[login]`      — programs to launch before the login screen (e.g. inputmon)
 //!   `[autostart]`  — programs to launch after compositor + dock are ready
+//!   `[display]`    — font smoothing, DPI scale, render threads
 //!
 //! Example:
 //! ```text
@@ -159,6 +160,58 @@ pub fn launch_autostart() -> alloc::vec::Vec<u32> {
     tids
 }
 
+// ── Render Threads ───────────────────────────────────────────────────────────
+
+/// Read the `[display]` section for the `render_threads` key: threads that
+/// composite large damage rects in parallel (0 = one per CPU, 1 = off).
+pub fn read_render_threads() -> Option<u32> {
+    let text = read_conf()?;
+    let mut in_display = false;
+
+    for line in text.split('\n') {
+        let line = line.trim();
+        if line.is_empty() || line.starts_with('#') {
+            continue;
+        }
+        if line.starts_with('[') {
+            in_display = line == "[display]";
+            continue;
+        }
+        if !in_display {
+            continue;
+        }
+        if let Some(val) = line.strip_prefix("render_threads=") {
+            return val.trim().parse::<u32>().ok();
+        }
+    }
+    None
+}
+
+/// Read the `[display]` section for the `refresh_hz` key: frame clock rate
+/// used when the GPU does not report vertical retrace.
+pub fn read_refresh_hz() -> Option<u32> {
+    let text = read_conf()?;
+    let mut in_display = false;
+
+    for line in text.split('\n') {
+        let line = line.trim();
+        if line.is_empty() || line.starts_with('#') {
+            continue;
+        }
+        if line.starts_with('[') {
+            in_display = line == "[display]";
+            continue;
+        }
+        if !in_display {
+            continue;
+        }
+        if let Some(val) = line.strip_prefix("refresh_hz=") {
+            return val.trim().parse::<u32>().ok().filter(|&hz| hz > 0);
+        }
+    }
+    None
+}
+
 // ── Font Smoothing ───────────────────────────────────────────────────────────
 
 /// Read the `[display]` section for the `font_smoothing` key.
@@ -1,7 +1,7 @@
 //! Input handling — mouse, keyboard, scroll, drag, and resize interaction.
 
 use crate::compositor::Rect;
-use crate::keys::{encode_scancode, KEY_VOLUME_UP, KEY_VOLUME_DOWN, KEY_VOLUME_MUTE};
+use crate::keys::{encode_scancode, KEY_F12, KEY_VOLUME_UP, KEY_VOLUME_DOWN, KEY_VOLUME_MUTE};
 use crate::menu::MenuBarHit;
 
 use super::cursors::CursorShape;
@@ -169,7 +169,7 @@ impl Desktop {
                     self.menu_bar.rerender_system_dropdown(&mut self.compositor);
                 }
                 // Slide from system menu to app menus
-                if self.mouse_y < menubar_height() as i32 {
+                if self.in_menubar(self.mouse_y) {
                     if let MenuBarHit::MenuTitle { menu_idx } =
                         self.menu_bar.hit_test_menubar(self.mouse_x, self.mouse_y)
                     {
@@ -190,7 +190,7 @@ impl Desktop {
                     self.menu_bar.render_dropdown(&mut self.compositor);
                 }
                 // Slide between app menus or to system menu
-                if self.mouse_y < menubar_height() as i32 {
+                if self.in_menubar(self.mouse_y) {
                     match self.menu_bar.hit_test_menubar(self.mouse_x, self.mouse_y) {
                         MenuBarHit::SystemMenu => {
                             self.menu_bar
@@ -328,7 +328,12 @@ impl Desktop {
         let now = anyos_std::sys::uptime();
 
         // Always tick overlays (independent of button animations)
+        let hud_was_visible = self.volume_hud.is_visible();
         let hud_active = self.volume_hud.tick(&mut self.compositor);
+        if hud_was_visible && !self.volume_hud.is_visible() {
+            // The HUD raised the menubar; put a fullscreen window back on top.
+            self.ensure_top_layers();
+        }
 
         if !self.btn_anims.has_active(now) {
             return hud_active;
@@ -439,7 +444,7 @@ impl Desktop {
                     return;
                 }
 
-                if self.mouse_y < menubar_height() as i32 {
+                if self.in_menubar(self.mouse_y) {
                     self.handle_menubar_click();
                     return;
                 }
@@ -451,7 +456,7 @@ impl Desktop {
             }
 
             // Check menubar click
-            if self.mouse_y < menubar_height() as i32 {
+            if self.in_menubar(self.mouse_y) {
                 self.handle_menubar_click();
                 return;
             }
@@ -797,6 +802,12 @@ impl Desktop {
                     }
                     return;
                 }
+                // Ctrl+Alt+F12: performance HUD
+                KEY_F12 if mods & 0x6 == 0x6 => {
+                    let visible = !self.perf_hud.is_visible();
+                    self.set_perf_hud(visible);
+                    return;
+                }
                 _ => {}
             }
         }
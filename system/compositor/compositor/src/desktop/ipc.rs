@@ -378,13 +378,13 @@ impl Desktop {
                 let shm_id = cmd[1];
                 let len = cmd[2] as usize;
                 let format = cmd[3];
-                if shm_id == 0 || len == 0 || len > 65536 {
+                if shm_id == 0 || len == 0 || len > proto::MAX_CLIPBOARD_SIZE {
                     anyos_std::println!("[clipboard] SET rejected: shm={} len={}", shm_id, len);
                     return None;
                 }
-                let shm_addr = anyos_std::ipc::shm_map(shm_id);
+                let shm_addr = anyos_std::ipc::shm_claim(shm_id);
                 if shm_addr == 0 {
-                    anyos_std::println!("[clipboard] SET shm_map failed for shm_id={}", shm_id);
+                    anyos_std::println!("[clipboard] SET shm_claim failed for shm_id={}", shm_id);
                     return None;
                 }
                 let data = unsafe {
@@ -393,6 +393,7 @@ impl Desktop {
                 self.clipboard_data = data.to_vec();
                 self.clipboard_format = format;
                 anyos_std::ipc::shm_unmap(shm_id);
+                anyos_std::ipc::shm_destroy(shm_id);
                 let preview_len = len.min(40);
                 let preview = core::str::from_utf8(&self.clipboard_data[..preview_len]).unwrap_or("(binary)");
                 anyos_std::println!("[clipboard] SET ok: {} bytes, preview='{}'", len, preview);
@@ -430,7 +431,7 @@ impl Desktop {
                 if shm_id == 0 {
                     return None;
                 }
-                let shm_addr = anyos_std::ipc::shm_map(shm_id);
+                let shm_addr = anyos_std::ipc::shm_claim(shm_id);
                 if shm_addr == 0 {
                     return None;
                 }
@@ -456,6 +457,7 @@ impl Desktop {
                     self.save_user_wallpaper();
                 }
                 anyos_std::ipc::shm_unmap(shm_id);
+                anyos_std::ipc::shm_destroy(shm_id);
                 None
             }
             proto::CMD_SHOW_NOTIFICATION => {
@@ -484,6 +486,35 @@ impl Desktop {
                     Some((target, [proto::RESP_WINDOW_POS, window_id, 0, 0, requester_tid]))
                 }
             }
+            proto::CMD_GET_FRAME_STATS => {
+                let requester_tid = cmd[1];
+                let p = self.frame_stats.percentiles();
+                let target = self.get_sub_id_for_tid(requester_tid);
+                Some((target, [proto::RESP_FRAME_STATS, p.p50_us, p.p95_us, p.p99_us, requester_tid]))
+            }
+            proto::CMD_GET_PERF_METRICS => {
+                let requester_tid = cmd[1];
+                let shm_id = cmd[2];
+                let capacity = cmd[3] as usize;
+                let (samples, clients) = self.write_perf_metrics(shm_id, capacity);
+                let target = self.get_sub_id_for_tid(requester_tid);
+                Some((target, [proto::RESP_PERF_METRICS, shm_id, samples, clients, requester_tid]))
+            }
+            proto::CMD_SET_PERF_HUD => {
+                self.set_perf_hud(cmd[1] != 0);
+                None
+            }
+            proto::CMD_SET_DAMAGE_MAP => {
+                // vncd: per-tile frame sequence numbers for incremental updates.
+                let shm_id = cmd[1];
+                let words = cmd[2] as usize;
+                if words == 0 {
+                    self.compositor.detach_damage_map(shm_id);
+                } else if !self.compositor.attach_damage_map(shm_id, words) {
+                    anyos_std::println!("compositor: damage map shm={} rejected", shm_id);
+                }
+                None
+            }
             proto::CMD_INJECT_KEY => {
                 // vncd: relay keyboard input from VNC client into the focused window.
                 // [CMD, scancode, char_val, is_down (1/0), modifiers]
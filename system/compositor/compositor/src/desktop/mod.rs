@@ -7,6 +7,7 @@ pub mod drawing;
 pub mod input;
 pub mod ipc;
 pub mod theme;
+pub mod perf_hud;
 pub mod volume_hud;
 pub mod window;
 
@@ -146,6 +147,17 @@ pub struct Desktop {
     /// Frame ACK queue: (sub_id, window_id) pairs to emit after compose.
     /// Populated during compose(), drained by render thread via evt_chan_emit_to.
     pub(crate) frame_ack_queue: Vec<(u32, u32)>,
+    /// Frame-time history, recorded by the render thread after each frame.
+    pub(crate) frame_stats: crate::frame_clock::FrameStats,
+    /// Per-second compositing metrics (see `compositor/metrics.rs`).
+    pub(crate) perf_history: crate::compositor::metrics::PerfHistory,
+    /// Present rates of the last second: (window_id, owner_tid, presents/s),
+    /// busiest first.
+    pub(crate) perf_rates: Vec<(u32, u32, u32)>,
+    /// Uptime (ms) the current history second started at.
+    pub(crate) perf_roll_ms: u32,
+    /// Performance HUD overlay (top-right).
+    pub(crate) perf_hud: perf_hud::PerfHud,
 
     /// Set to true when the user selects "Log Out" from the system menu.
     /// The management loop checks this flag and initiates the logout sequence.
@@ -232,6 +244,11 @@ impl Desktop {
             cascade_x: 120,
             cascade_y: menubar_height() as i32 + 50,
             frame_ack_queue: Vec::new(),
+            frame_stats: crate::frame_clock::FrameStats::new(),
+            perf_history: crate::compositor::metrics::PerfHistory::new(),
+            perf_rates: Vec::new(),
+            perf_roll_ms: 0,
+            perf_hud: perf_hud::PerfHud::new(),
             logout_requested: false,
             shutdown_mode: 0,
             logo_white: Vec::new(),
@@ -246,6 +263,7 @@ impl Desktop {
             vnc_buttons: 0,
         };
 
+        desktop.compositor.try_enable_gpu_ring();
         if desktop.has_gpu_accel {
             desktop.compositor.enable_gpu_accel();
             // Try to register back buffer as GPU GMR for DMA transfers.
@@ -651,10 +669,12 @@ impl Desktop {
         } else {
             let dst_count = (sw * sh) as usize;
             let mut dst = vec![0u32; dst_count];
-            if !libimage_client::scale_image(
+            // One-off per wallpaper change, so use the sharpest filter
+            if !libimage_client::scale_image_filtered(
                 &pixels, info.width, info.height,
                 &mut dst, sw, sh,
                 libimage_client::MODE_COVER,
+                libimage_client::FILTER_LANCZOS3,
             ) {
                 return false;
             }
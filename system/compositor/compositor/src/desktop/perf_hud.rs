@@ -0,0 +1,245 @@
+//! Performance HUD — top-right overlay with the compositor's frame metrics.
+//!
+//! Toggled with Ctrl+Alt+F12 or `CMD_SET_PERF_HUD`.  Redrawn once per
+//! second from the last completed [`PerfSample`]: compose time, damaged
+//! pixels, layers visited, occlusion skips, shadow/blur/flush time, the
+//! busiest presenting clients and a graph of the compose time over the
+//! history.  The HUD's own redraw is part of the metrics it shows (one small
+//! damage rect per second).
+
+use alloc::format;
+use alloc::string::String;
+
+use crate::compositor::metrics::{PerfHistory, PerfSample, HISTORY_SECS, SAMPLE_WORDS};
+use crate::compositor::{Compositor, Rect};
+
+use super::drawing::{draw_rounded_rect_outline, fill_rect, fill_rounded_rect};
+use super::theme;
+use super::window::menubar_height;
+use super::Desktop;
+
+// ── Layout Constants ──────────────────────────────────────────────────────
+
+const HUD_W: u32 = 300;
+const RADIUS: u32 = 10;
+const PAD: i32 = 10;
+const MARGIN: i32 = 12;
+const LINE_H: i32 = 15;
+/// Metric lines plus up to three client lines.
+const TEXT_LINES: i32 = 5 + MAX_CLIENTS as i32;
+const GRAPH_H: u32 = 40;
+const HUD_H: u32 = (PAD * 3 + LINE_H * TEXT_LINES) as u32 + GRAPH_H;
+
+/// Clients listed by present rate.
+pub(crate) const MAX_CLIENTS: usize = 3;
+
+const FONT_ID: u16 = 0;
+const FONT_SIZE: u16 = 11;
+
+const COLOR_GRAPH: u32 = 0xFF34C759;
+const COLOR_GRAPH_SLOW: u32 = 0xFFFF3B30;
+
+// ── PerfHud ───────────────────────────────────────────────────────────────
+
+pub(crate) struct PerfHud {
+    layer_id: Option<u32>,
+    visible: bool,
+    /// Refresh period of the last update (graph bars above it are red).
+    period_us: u32,
+}
+
+impl PerfHud {
+    pub fn new() -> Self {
+        PerfHud { layer_id: None, visible: false, period_us: 1_000_000 / crate::frame_clock::DEFAULT_REFRESH_HZ }
+    }
+
+    pub fn is_visible(&self) -> bool {
+        self.visible
+    }
+
+    /// The HUD's layer while it is shown.
+    pub fn visible_layer(&self) -> Option<u32> {
+        self.layer_id.filter(|_| self.visible)
+    }
+
+    /// Show or hide the HUD.  `menubar_layer_id` is raised above it.
+    pub fn set_visible(&mut self, compositor: &mut Compositor, screen_width: u32, visible: bool, menubar_layer_id: u32) {
+        if visible == self.visible {
+            return;
+        }
+        self.visible = visible;
+        let x = screen_width as i32 - HUD_W as i32 - MARGIN;
+        let y = menubar_height() as i32 + MARGIN;
+        let id = match self.layer_id {
+            Some(id) => id,
+            None => {
+                let id = compositor.add_layer(x, y, HUD_W, HUD_H, false);
+                self.layer_id = Some(id);
+                id
+            }
+        };
+        compositor.set_layer_visible(id, visible);
+        if visible {
+            compositor.move_layer(id, x, y);
+            compositor.raise_layer(id);
+            compositor.raise_layer(menubar_layer_id);
+        }
+        compositor.add_damage(Rect::new(x, y, HUD_W, HUD_H));
+    }
+
+    /// Redraw the HUD from the history.  `clients` holds
+    /// `(title, presents per second)` of the busiest clients.
+    pub fn update(&mut self, compositor: &mut Compositor, history: &PerfHistory, clients: &[(String, u32)], period_us: u32) {
+        let id = match self.layer_id {
+            Some(id) if self.visible => id,
+            _ => return,
+        };
+        self.period_us = period_us;
+        if let Some(pixels) = compositor.layer_pixels(id) {
+            render_hud(pixels, history, clients, period_us);
+        }
+        compositor.mark_layer_dirty(id);
+    }
+}
+
+// ── Desktop integration ───────────────────────────────────────────────────
+
+impl Desktop {
+    /// Add the frame just composited (compose wall time `compose_us`) to
+    /// the performance history.
+    pub(crate) fn record_frame_metrics(&mut self, compose_us: u32) {
+        let m = self.compositor.take_frame_metrics();
+        self.perf_history.record(compose_us, &m);
+    }
+
+    /// Close the history's current second once it is over: update the
+    /// per-client present rates and redraw the HUD.  Returns whether the HUD
+    /// needs a frame.
+    pub(crate) fn tick_perf(&mut self, now_ms: u32, period_us: u32) -> bool {
+        let elapsed = now_ms.wrapping_sub(self.perf_roll_ms);
+        if !self.perf_history.roll(now_ms / 1000) {
+            return false;
+        }
+        self.perf_roll_ms = now_ms;
+        self.perf_rates.clear();
+        for win in &mut self.windows {
+            if win.presents > 0 {
+                let rate = (win.presents as u64 * 1000 / elapsed.max(1) as u64) as u32;
+                self.perf_rates.push((win.id, win.owner_tid, rate));
+                win.presents = 0;
+            }
+        }
+        self.perf_rates.sort_unstable_by(|a, b| b.2.cmp(&a.2));
+        if !self.perf_hud.is_visible() {
+            return false;
+        }
+        let clients: alloc::vec::Vec<(String, u32)> = self.perf_rates.iter()
+            .take(MAX_CLIENTS)
+            .map(|&(id, _, rate)| {
+                let title = self.windows.iter().find(|w| w.id == id)
+                    .map(|w| w.title.clone()).unwrap_or_default();
+                (title, rate)
+            })
+            .collect();
+        self.perf_hud.update(&mut self.compositor, &self.perf_history, &clients, period_us);
+        true
+    }
+
+    /// Dump the history and present rates into a client SHM of `capacity`
+    /// bytes (layout in `CMD_GET_PERF_METRICS`).  Returns the sample and
+    /// client counts written.
+    pub(crate) fn write_perf_metrics(&self, shm_id: u32, capacity: usize) -> (u32, u32) {
+        const HEADER: usize = 5;
+        let words = capacity / 4;
+        if shm_id == 0 || words < HEADER {
+            return (0, 0);
+        }
+        let addr = anyos_std::ipc::shm_map(shm_id);
+        if addr == 0 {
+            return (0, 0);
+        }
+        let out = unsafe { core::slice::from_raw_parts_mut(addr as usize as *mut u32, words) };
+        let mut pos = HEADER;
+        let mut samples = 0u32;
+        for sample in self.perf_history.iter() {
+            if pos + SAMPLE_WORDS > words {
+                break;
+            }
+            out[pos..pos + SAMPLE_WORDS].copy_from_slice(&sample.to_words());
+            pos += SAMPLE_WORDS;
+            samples += 1;
+        }
+        let mut clients = 0u32;
+        for &(id, tid, rate) in &self.perf_rates {
+            if pos + 3 > words {
+                break;
+            }
+            out[pos..pos + 3].copy_from_slice(&[id, tid, rate]);
+            pos += 3;
+            clients += 1;
+        }
+        out[..HEADER].copy_from_slice(&[1, samples, SAMPLE_WORDS as u32, clients, 0]);
+        anyos_std::ipc::shm_unmap(shm_id);
+        (samples, clients)
+    }
+
+    /// Show or hide the performance HUD.
+    pub(crate) fn set_perf_hud(&mut self, visible: bool) {
+        let (sw, mb) = (self.screen_width, self.menubar_layer_id);
+        self.perf_hud.set_visible(&mut self.compositor, sw, visible, mb);
+        if visible {
+            // Draw right away instead of waiting for the next second.
+            let period_us = self.perf_hud.period_us;
+            self.perf_hud.update(&mut self.compositor, &self.perf_history, &[], period_us);
+        }
+    }
+}
+
+// ── Rendering ─────────────────────────────────────────────────────────────
+
+fn render_hud(pixels: &mut [u32], history: &PerfHistory, clients: &[(String, u32)], period_us: u32) {
+    let (w, h) = (HUD_W, HUD_H);
+    pixels.fill(0);
+    fill_rounded_rect(pixels, w, h, 0, 0, w, h, RADIUS, theme::color_hud_bg());
+    draw_rounded_rect_outline(pixels, w, h, 0, 0, w, h, RADIUS, 0x30FFFFFF);
+
+    let s: PerfSample = history.last().copied().unwrap_or(history.current);
+    let frames = s.frames.max(1);
+    let lines = [
+        format!("{} fps  compose avg {}us max {}us", s.frames, s.compose_us_avg(), s.compose_us_max),
+        format!("damage {} px/frame", s.damaged_px / frames),
+        format!("layers {}/frame  occluded {}/frame", s.layers_visited / frames, s.occlusion_skips / frames),
+        format!("shadow {}us  blur {}us  (per frame)", s.shadow_us / frames, s.blur_us / frames),
+        format!("gpu flush {}us/frame", s.flush_us / frames),
+    ];
+    let mut y = PAD;
+    for line in lines.iter() {
+        draw_text(pixels, PAD, y, line);
+        y += LINE_H;
+    }
+    for (title, rate) in clients.iter().take(MAX_CLIENTS) {
+        draw_text(pixels, PAD, y, &format!("  {} presents/s  {}", rate, title));
+        y += LINE_H;
+    }
+
+    // Compose time per second (avg), newest on the right; red above one refresh period.
+    let graph_y = PAD * 2 + LINE_H * TEXT_LINES;
+    let graph_w = w - PAD as u32 * 2;
+    fill_rect(pixels, w, h, PAD, graph_y, graph_w, GRAPH_H, theme::color_hud_bar_bg());
+    let scale_us = history.iter().map(|s| s.compose_us_avg()).max().unwrap_or(0).max(period_us).max(1);
+    let bar_w = (graph_w / HISTORY_SECS as u32).max(1);
+    let count = history.iter().count() as u32;
+    for (i, s) in history.iter().enumerate() {
+        let avg = s.compose_us_avg();
+        let bar_h = ((avg as u64 * GRAPH_H as u64 / scale_us as u64) as u32).clamp(if avg > 0 { 1 } else { 0 }, GRAPH_H);
+        let x = PAD + (graph_w - (count - i as u32) * bar_w) as i32;
+        let color = if avg > period_us { COLOR_GRAPH_SLOW } else { COLOR_GRAPH };
+        fill_rect(pixels, w, h, x, graph_y + (GRAPH_H - bar_h) as i32, bar_w, bar_h, color);
+    }
+}
+
+fn draw_text(pixels: &mut [u32], x: i32, y: i32, text: &str) {
+    anyos_std::ui::window::font_render_buf(
+        FONT_ID, FONT_SIZE, pixels, HUD_W, HUD_H, x, y, theme::color_hud_text(), text,
+    );
+}
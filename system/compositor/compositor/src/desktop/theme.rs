@@ -117,6 +117,25 @@ pub fn read_font_smoothing() -> u32 {
     }
 }
 
+// ── Shared Glyph Cache ───────────────────────────────────────────────────
+
+const UISYS_GLYPH_CACHE_OFFSET: u32 = 0x18;
+
+/// Size of the shared glyph cache.  Must match `REGION_SIZE` in libfont.
+const GLYPH_CACHE_SIZE: u32 = 4 * 1024 * 1024;
+
+/// Create the system-wide glyph cache and publish its SHM ID in the shared
+/// DLIB page, where libfont picks it up on init.  libfont lays out the
+/// (zero-filled) region itself.
+pub fn create_glyph_cache() {
+    let shm_id = anyos_std::ipc::shm_create(GLYPH_CACHE_SIZE);
+    if shm_id == 0 {
+        anyos_std::println!("compositor: failed to create shared glyph cache");
+        return;
+    }
+    anyos_std::dll::set_dll_u32(UISYS_BASE, UISYS_GLYPH_CACHE_OFFSET, shm_id);
+}
+
 // ── Desktop Background ─────────────────────────────────────────────────────
 
 pub(crate) const COLOR_DESKTOP_BG: u32 = 0xFF1E1E1E;
@@ -71,6 +71,10 @@ impl VolumeHud {
         }
     }
 
+    pub fn is_visible(&self) -> bool {
+        self.visible
+    }
+
     /// Show (or update) the volume HUD with the given volume level.
     pub fn show(
         &mut self,
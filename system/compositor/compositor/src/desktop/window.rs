@@ -171,6 +171,8 @@ pub struct WindowInfo {
     pub shm_height: u32,
     /// Set true on CMD_PRESENT, cleared after compose emits EVT_FRAME_ACK.
     pub needs_frame_ack: bool,
+    /// Presents since the performance history's current second began.
+    pub presents: u32,
 }
 
 impl WindowInfo {
@@ -186,6 +188,12 @@ impl WindowInfo {
         self.flags & WIN_FLAG_ALWAYS_ON_TOP != 0
     }
 
+    /// Borderless window covering the whole screen.
+    pub fn is_fullscreen(&self, screen_w: u32, screen_h: u32) -> bool {
+        self.is_borderless() && self.x == 0 && self.y == 0
+            && self.content_width == screen_w && self.content_height == screen_h
+    }
+
     /// Full window width (same as content for borderless).
     pub fn full_width(&self) -> u32 {
         self.content_width
@@ -400,6 +408,7 @@ impl Desktop {
             shm_width: 0,
             shm_height: 0,
             needs_frame_ack: false,
+            presents: 0,
         };
 
         self.windows.push(win);
@@ -532,14 +541,39 @@ impl Desktop {
         }
     }
 
-    /// Re-raise always-on-top windows and the menubar.
+    /// Layer of the focused window if it is fullscreen (covering the menubar).
+    pub(crate) fn fullscreen_layer(&self) -> Option<u32> {
+        let (sw, sh) = (self.screen_width, self.screen_height);
+        self.windows.iter()
+            .find(|w| w.focused && w.is_fullscreen(sw, sh))
+            .map(|w| w.layer_id)
+    }
+
+    /// Whether screen row `y` hits the menubar (not covered by a fullscreen window).
+    pub(crate) fn in_menubar(&self, y: i32) -> bool {
+        y < menubar_height() as i32 && self.fullscreen_layer().is_none()
+    }
+
+    /// Re-raise always-on-top windows and the menubar.  A focused
+    /// fullscreen window is kept above the menubar (so it can be scanned
+    /// out directly); always-on-top windows such as notifications stay above it.
     pub(crate) fn ensure_top_layers(&mut self) {
+        let fullscreen = self.fullscreen_layer();
+        if let Some(layer_id) = fullscreen {
+            self.compositor.raise_layer(self.menubar_layer_id);
+            self.compositor.raise_layer(layer_id);
+        }
         for win in &self.windows {
             if win.is_always_on_top() {
                 self.compositor.raise_layer(win.layer_id);
             }
         }
-        self.compositor.raise_layer(self.menubar_layer_id);
+        if let Some(id) = self.perf_hud.visible_layer() {
+            self.compositor.raise_layer(id);
+        }
+        if fullscreen.is_none() {
+            self.compositor.raise_layer(self.menubar_layer_id);
+        }
     }
 
     /// Get a window's event queue.
@@ -980,6 +1014,7 @@ impl Desktop {
             shm_width: content_w,
             shm_height: content_h,
             needs_frame_ack: false,
+            presents: 0,
         };
 
         self.windows.push(win);
@@ -1061,6 +1096,7 @@ impl Desktop {
             shm_width: content_w,
             shm_height: content_h,
             needs_frame_ack: false,
+            presents: 0,
         };
 
         self.windows.push(win);
@@ -1075,6 +1111,37 @@ impl Desktop {
         ])
     }
 
+    /// One step of idle-time VRAM compaction: move a surface into a free
+    /// extent below it and remap the owning app's view of it.  Returns
+    /// whether a surface moved.  Meant for idle periods, when apps are not
+    /// drawing; a write racing the copy lasts until the app's next redraw.
+    pub fn compact_vram(&mut self) -> bool {
+        let (alloc, new_row) = match self.compositor.vram_allocator.as_ref().and_then(|a| a.plan_move()) {
+            Some(m) => m,
+            None => return false,
+        };
+        let owner_tid = match self.windows.iter().find(|w| w.layer_id == alloc.layer_id) {
+            Some(w) => w.owner_tid,
+            None => return false,
+        };
+        if !self.compositor.copy_vram_surface(alloc.layer_id, new_row) {
+            return false;
+        }
+        let new_offset = new_row * self.compositor.fb_pitch;
+        if anyos_std::ipc::vram_map(owner_tid, new_offset, alloc.size) == 0 {
+            return false;
+        }
+        let moved = self.compositor.vram_allocator.as_mut()
+            .and_then(|a| a.relocate(alloc.layer_id, new_row));
+        match moved {
+            Some(a) => {
+                self.compositor.set_vram_layer_y(alloc.layer_id, a.vram_y);
+                true
+            }
+            None => false,
+        }
+    }
+
     /// Create an IPC window using pre-rendered pixels (fast path).
     pub fn create_ipc_window_fast(
         &mut self,
@@ -1151,6 +1218,7 @@ impl Desktop {
             shm_width: content_w,
             shm_height: content_h,
             needs_frame_ack: false,
+            presents: 0,
         };
 
         self.windows.push(win);
@@ -1170,6 +1238,7 @@ impl Desktop {
 
         // Mark for frame ACK — render thread will send EVT_FRAME_ACK after compositing
         self.windows[win_idx].needs_frame_ack = true;
+        self.windows[win_idx].presents = self.windows[win_idx].presents.wrapping_add(1);
 
         let layer_id = self.windows[win_idx].layer_id;
 
@@ -1178,7 +1247,7 @@ impl Desktop {
             if layer.is_vram {
                 let bounds = layer.damage_bounds();
                 self.compositor.mark_layer_dirty(layer_id);
-                self.compositor.add_damage(bounds);
+                self.compositor.add_layer_damage(layer_id, bounds);
                 return;
             }
         }
@@ -1275,11 +1344,11 @@ impl Desktop {
                     dr.width,
                     dr.height,
                 );
-                self.compositor.add_damage(screen_rect);
+                self.compositor.add_layer_damage(layer_id, screen_rect);
             }
         } else if let Some(layer) = self.compositor.get_layer(layer_id) {
             let bounds = layer.damage_bounds();
-            self.compositor.add_damage(bounds);
+            self.compositor.add_layer_damage(layer_id, bounds);
         }
     }
 }
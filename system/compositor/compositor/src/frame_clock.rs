@@ -0,0 +1,199 @@
+//! Frame clock and frame-time statistics.
+//!
+//! The render thread composites at most once per display refresh: damage
+//! and `CMD_PRESENT`s arriving between two ticks are composited together on
+//! the next tick.  Ticks come from a nanosecond timer whose phase is locked
+//! to the GPU's vertical retrace when the driver reports it
+//! (`gpu_wait_vblank`); otherwise the timer free-runs at the configured
+//! refresh rate (`[display] refresh_hz`).
+
+use anyos_std::{ipc, process, sys};
+
+/// Nominal refresh rate without a vblank source.
+pub const DEFAULT_REFRESH_HZ: u32 = 60;
+/// Re-lock the phase to vblank every this many ticks.
+const RESYNC_TICKS: u32 = 120;
+/// Start waiting for the retrace this long before the predicted edge.
+const VBLANK_LEAD_NS: u64 = 2_000_000;
+/// Plausible refresh periods (250 Hz .. 24 Hz); anything else means the
+/// device's retrace bit is not real and we fall back to the timer.
+const MIN_PERIOD_NS: u64 = 4_000_000;
+const MAX_PERIOD_NS: u64 = 42_000_000;
+/// Implausible vblank measurements tolerated before giving up on vblank.
+const MAX_BAD_SYNCS: u32 = 3;
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Vblank {
+    /// Not probed yet, or locked and periodically resynced.
+    Active,
+    /// The GPU has no usable retrace status.
+    Unavailable,
+}
+
+/// Render-thread frame scheduler.
+pub struct FrameClock {
+    period_ns: u64,
+    next_ns: u64,
+    vblank: Vblank,
+    last_sync_ns: u64,
+    ticks_since_sync: u32,
+    bad_syncs: u32,
+}
+
+impl FrameClock {
+    pub fn new(refresh_hz: u32) -> Self {
+        let hz = refresh_hz.clamp(24, 250) as u64;
+        FrameClock {
+            period_ns: 1_000_000_000 / hz,
+            next_ns: 0,
+            vblank: Vblank::Active,
+            last_sync_ns: 0,
+            ticks_since_sync: RESYNC_TICKS,
+            bad_syncs: 0,
+        }
+    }
+
+    /// Refresh period in microseconds.
+    pub fn period_us(&self) -> u32 {
+        (self.period_ns / 1000) as u32
+    }
+
+    /// Whether ticks are locked to the display's vertical retrace.
+    pub fn vblank_locked(&self) -> bool {
+        self.vblank == Vblank::Active && self.last_sync_ns != 0
+    }
+
+    /// Block until the next tick and return its time (`monotonic_ns`).
+    /// If the tick already passed (the render thread was idle or a frame
+    /// ran long) it returns immediately and the following tick stays on the
+    /// refresh grid.
+    pub fn wait(&mut self) -> u64 {
+        if self.vblank == Vblank::Active && self.ticks_since_sync >= RESYNC_TICKS {
+            if let Some(t) = self.sync_vblank() {
+                return t;
+            }
+        }
+        let now = sys::monotonic_ns();
+        if self.next_ns > now {
+            process::sleep_ns(self.next_ns - now);
+        }
+        let now = sys::monotonic_ns();
+        let tick = if self.next_ns > now { self.next_ns } else { now };
+        self.advance(now);
+        self.ticks_since_sync = self.ticks_since_sync.saturating_add(1);
+        tick
+    }
+
+    /// Move `next_ns` to the first grid point after `now`.
+    fn advance(&mut self, now: u64) {
+        if self.next_ns == 0 {
+            self.next_ns = now + self.period_ns;
+        } else if self.next_ns <= now {
+            let behind = (now - self.next_ns) / self.period_ns + 1;
+            self.next_ns += behind * self.period_ns;
+        }
+    }
+
+    /// Wait for the retrace edge near the predicted tick and re-phase the
+    /// timer on it.  Returns the tick time, or `None` to use the timer.
+    fn sync_vblank(&mut self) -> Option<u64> {
+        let now = sys::monotonic_ns();
+        if self.next_ns > now + VBLANK_LEAD_NS {
+            process::sleep_ns(self.next_ns - now - VBLANK_LEAD_NS);
+        }
+        let timeout_ms = (2 * self.period_ns / 1_000_000) as u32 + 1;
+        match ipc::gpu_wait_vblank(timeout_ms) {
+            Some(true) => {}
+            Some(false) => {
+                self.reject_sync();
+                return None;
+            }
+            None => {
+                self.vblank = Vblank::Unavailable;
+                return None;
+            }
+        }
+        let t = sys::monotonic_ns();
+        if self.last_sync_ns != 0 {
+            // Estimate the true period from the frames elapsed since the
+            // previous edge; smooth it so one late wakeup cannot skew it.
+            let elapsed = t - self.last_sync_ns;
+            let frames = (elapsed + self.period_ns / 2) / self.period_ns;
+            let measured = if frames > 0 { elapsed / frames } else { 0 };
+            if !(MIN_PERIOD_NS..=MAX_PERIOD_NS).contains(&measured) {
+                self.reject_sync();
+                self.last_sync_ns = 0;
+                return None;
+            }
+            self.period_ns = (self.period_ns * 3 + measured) / 4;
+        }
+        self.bad_syncs = 0;
+        self.last_sync_ns = t;
+        self.ticks_since_sync = 0;
+        self.next_ns = t + self.period_ns;
+        Some(t)
+    }
+
+    fn reject_sync(&mut self) {
+        self.bad_syncs += 1;
+        self.ticks_since_sync = 0;
+        if self.bad_syncs >= MAX_BAD_SYNCS {
+            self.vblank = Vblank::Unavailable;
+            anyos_std::println!("compositor: vblank unusable, pacing with timer");
+        }
+    }
+}
+
+// ── Frame-time statistics ───────────────────────────────────────────────────
+
+/// Frames kept for percentile queries.
+const HISTORY: usize = 256;
+
+/// Compose + flush time of recent frames, in microseconds.
+pub struct FrameStats {
+    times_us: [u32; HISTORY],
+    len: usize,
+    pos: usize,
+    /// Frames presented since start.
+    pub frames: u32,
+    /// Frames whose cost exceeded the refresh period.
+    pub missed: u32,
+}
+
+/// Percentiles over the recent history.
+#[derive(Clone, Copy, Default)]
+pub struct FramePercentiles {
+    pub p50_us: u32,
+    pub p95_us: u32,
+    pub p99_us: u32,
+    pub max_us: u32,
+}
+
+impl FrameStats {
+    pub const fn new() -> Self {
+        FrameStats { times_us: [0; HISTORY], len: 0, pos: 0, frames: 0, missed: 0 }
+    }
+
+    /// Record one presented frame.
+    pub fn record(&mut self, time_us: u32, period_us: u32) {
+        self.times_us[self.pos] = time_us;
+        self.pos = (self.pos + 1) % HISTORY;
+        self.len = (self.len + 1).min(HISTORY);
+        self.frames = self.frames.wrapping_add(1);
+        if time_us > period_us {
+            self.missed = self.missed.wrapping_add(1);
+        }
+    }
+
+    pub fn percentiles(&self) -> FramePercentiles {
+        if self.len == 0 {
+            return FramePercentiles::default();
+        }
+        let mut sorted = [0u32; HISTORY];
+        let s = &mut sorted[..self.len];
+        s.copy_from_slice(&self.times_us[..self.len]);
+        s.sort_unstable();
+        let at = |pct: usize| s[(s.len() * pct / 100).min(s.len() - 1)];
+        FramePercentiles { p50_us: at(50), p95_us: at(95), p99_us: at(99), max_us: s[s.len() - 1] }
+    }
+}
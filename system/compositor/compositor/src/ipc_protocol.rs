@@ -60,6 +60,14 @@ pub const RESP_CLIPBOARD_DATA: u32 = 0x2010;
 /// content_x/content_y are the screen coordinates of the window's content area top-left.
 pub const RESP_WINDOW_POS: u32 = 0x2006;
 
+/// Frame-time statistics: [RESP, p50_us, p95_us, p99_us, requester_tid]
+/// Compose + flush time per frame, measured from the frame clock tick.
+pub const RESP_FRAME_STATS: u32 = 0x2007;
+
+/// Performance metrics written: [RESP, shm_id, sample_count, client_count, requester_tid]
+/// sample_count = 0 and client_count = 0 if the SHM could not be used.
+pub const RESP_PERF_METRICS: u32 = 0x2008;
+
 // ── Compositor → App Input Events ────────────────────────────────────────────
 
 /// Key down: [EVT, window_id, scancode, char_code, modifiers]
@@ -143,15 +151,20 @@ pub const CMD_CREATE_VRAM_WINDOW: u32 = 0x1010;
 /// Set desktop wallpaper by file path.
 /// [CMD, shm_id, 0, 0, 0]
 /// SHM contains a null-terminated UTF-8 path string (e.g. "/media/wallpapers/mountains.jpg").
-/// Compositor maps SHM, reads path, loads wallpaper, unmaps SHM, damages all.
+/// The sender grants the SHM (`shm_grant`); the compositor claims it, reads the path,
+/// loads the wallpaper, destroys the SHM and damages all.
 pub const CMD_SET_WALLPAPER: u32 = 0x100F;
 
 /// Set clipboard contents.
 /// [CMD, shm_id, len, format, 0]
-/// SHM contains raw clipboard data (text or binary). Compositor copies data internally.
+/// SHM contains raw clipboard data (text or binary), granted by the sender
+/// (`shm_grant`). Compositor claims it, copies data internally and destroys it.
 /// format: 0 = text/plain, 1 = text/uri-list
 pub const CMD_SET_CLIPBOARD: u32 = 0x1011;
 
+/// Largest clipboard payload accepted by CMD_SET_CLIPBOARD.
+pub const MAX_CLIPBOARD_SIZE: usize = 4 * 1024 * 1024;
+
 /// Get clipboard contents.
 /// [CMD, shm_id, capacity, 0, 0]
 /// App creates empty SHM with `capacity` bytes. Compositor writes clipboard data into it
@@ -175,6 +188,23 @@ pub const CMD_DISMISS_NOTIFICATION: u32 = 0x1021;
 /// Compositor responds with RESP_WINDOW_POS containing content_x, content_y.
 pub const CMD_GET_WINDOW_POS: u32 = 0x1013;
 
+/// Query the compositor's per-second performance history.
+/// [CMD, requester_tid, shm_id, capacity_bytes, 0]
+/// The app creates the SHM; the compositor fills it and responds with
+/// RESP_PERF_METRICS.  Layout (u32 words):
+///   [version = 1, sample_count, sample_words = 10, client_count, 0]
+///   sample_count × [uptime_s, frames, compose_us_avg, compose_us_max,
+///                   damaged_px, layers_visited, occlusion_skips,
+///                   shadow_us, blur_us, flush_us]   (oldest first, up to 60)
+///   client_count × [window_id, owner_tid, presents_per_sec]
+/// Sample counters are totals over the second (divide by frames for per-frame
+/// values).  Samples and clients are truncated to fit `capacity_bytes`.
+pub const CMD_GET_PERF_METRICS: u32 = 0x101A;
+
+/// Show or hide the performance HUD (also Ctrl+Alt+F12).
+/// [CMD, visible (1/0), 0, 0, 0]
+pub const CMD_SET_PERF_HUD: u32 = 0x101B;
+
 /// Hide all windows of a given TID (move off-screen with saved bounds).
 /// [CMD, owner_tid, 0, 0, 0]
 /// Windows are moved to (-10000, -10000) and their original position is saved
@@ -199,6 +229,21 @@ pub const CMD_SET_FONT_SMOOTHING: u32 = 0x1016;
 /// and broadcasts EVT_SCALE_CHANGED.
 pub const CMD_SET_SCALE: u32 = 0x1017;
 
+/// Attach or detach a damage map.
+/// [CMD, shm_id, size_words, 0, 0]   size_words = 0 detaches.
+/// The client creates the SHM; the compositor maps it and, after every frame,
+/// writes the frame sequence number into each 64x64 tile that reached the
+/// framebuffer.  Layout (u32): [tile_size, cols, rows, frame_seq,
+/// move_seq, layer_id, x, y, width, height, old_x, old_y, tile_seq...];
+/// the move words describe the last layer move (see compositor/damage.rs).
+/// cols = rows = 0 means the map is too small for the current resolution.
+pub const CMD_SET_DAMAGE_MAP: u32 = 0x1018;
+
+/// Query frame-time percentiles over the last 256 composited frames.
+/// [CMD, requester_tid, 0, 0, 0]
+/// Compositor responds with RESP_FRAME_STATS.
+pub const CMD_GET_FRAME_STATS: u32 = 0x1019;
+
 /// Inject a synthetic key event into the focused window.
 /// [CMD, scancode, char_val, is_down (1=down/0=up), modifiers]
 /// vncd maps RFB KeySyms → (scancode, char_val) before emitting this command.
@@ -245,10 +290,12 @@ pub const EVT_STATUS_ICON_CLICK: u32 = 0x3009;
 /// Mouse move: [EVT, window_id, local_x, local_y, 0]
 pub const EVT_MOUSE_MOVE: u32 = 0x300A;
 
-/// Frame acknowledgment: [EVT, window_id, 0, 0, 0]
+/// Frame acknowledgment: [EVT, window_id, frame_seq, present_ms, refresh_period_us]
 /// Sent by the render thread after compositing a window's content to screen
-/// (i.e. after VSync — RESOURCE_FLUSH completion on VirtIO-GPU).
-/// Apps use this for back-pressure: don't present a new frame until ACK.
+/// (i.e. after VSync — RESOURCE_FLUSH completion on VirtIO-GPU). All presents
+/// of one refresh interval are composited in one frame on the frame clock tick.
+/// Apps use this for back-pressure: don't present a new frame until ACK, and
+/// can schedule the next one for present_ms + refresh_period_us.
 pub const EVT_FRAME_ACK: u32 = 0x300B;
 
 /// Focus lost: [EVT, window_id, 0, 0, 0]
@@ -22,6 +22,7 @@ use anyos_std::Vec;
 mod compositor;
 mod config;
 mod desktop;
+mod frame_clock;
 mod ipc_protocol;
 mod keys;
 mod menu;
@@ -63,7 +64,9 @@ fn main() {
     let height = fb_info.height;
     let fb_ptr = fb_info.fb_addr as *mut u32;
 
-    // Step 3: Initialize fonts (must happen before any text rendering)
+    // Step 3: Publish the shared glyph cache, then initialize fonts
+    // (must happen before any text rendering)
+    desktop::theme::create_glyph_cache();
     libfont_client::init();
 
     // Step 4: Initialize desktop at current (boot) resolution
@@ -128,6 +131,18 @@ fn main() {
         desktop::theme::set_scale_factor(100);
     }
 
+    // Step 4f: Parallel compositing thread count from compositor.conf
+    if let Some(threads) = config::read_render_threads() {
+        desktop.compositor.set_render_threads(threads);
+        println!("compositor: render threads: {}", threads);
+    }
+
+    // Step 4g: Frame clock rate for displays without a vblank source
+    if let Some(hz) = config::read_refresh_hz() {
+        render::set_refresh_hz(hz);
+        println!("compositor: refresh rate: {} Hz", hz);
+    }
+
     // Step 3b: Take over cursor from kernel splash mode
     let (splash_x, splash_y) = ipc::cursor_takeover();
     desktop.set_cursor_pos(splash_x, splash_y);
@@ -375,7 +390,7 @@ fn management_loop(
             let desktop = unsafe { desktop_ref() };
             desktop.process_input(&events_buf, event_count);
             desktop.damage_cursor();
-            desktop.compositor.flush_gpu();
+            // Cursor moves stay queued and go down with the frame's submission.
             release_lock();
             signal_render();
         }
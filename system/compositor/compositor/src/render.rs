@@ -12,9 +12,10 @@
 use anyos_std::process;
 use anyos_std::sys;
 use anyos_std::println;
-use core::sync::atomic::{AtomicBool, Ordering};
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
 
 use crate::desktop::Desktop;
+use crate::frame_clock::{FrameClock, DEFAULT_REFRESH_HZ};
 
 // ── Shared State ─────────────────────────────────────────────────────────────
 
@@ -28,6 +29,9 @@ static mut DESKTOP_PTR: *mut Desktop = core::ptr::null_mut();
 /// The render thread checks this to decide whether to compose or sleep.
 static RENDER_NEEDED: AtomicBool = AtomicBool::new(true);
 
+/// Frame clock rate used when the GPU reports no vertical retrace.
+static REFRESH_HZ: AtomicU32 = AtomicU32::new(DEFAULT_REFRESH_HZ);
+
 /// Event channel ID for sending frame ACKs directly from the render thread.
 /// Set once during init by the management thread, never changed.
 static mut COMPOSITOR_CHANNEL: u32 = 0;
@@ -67,6 +71,12 @@ pub unsafe fn set_compositor_channel(ch: u32) {
     COMPOSITOR_CHANNEL = ch;
 }
 
+/// Set the timer refresh rate (`[display] refresh_hz`). Call before the
+/// render thread starts.
+pub fn set_refresh_hz(hz: u32) {
+    REFRESH_HZ.store(hz, Ordering::Relaxed);
+}
+
 /// Signal the render thread that new work is available (damage, input, etc.).
 /// Called by the management thread after processing events or IPC commands.
 pub fn signal_render() {
@@ -75,11 +85,12 @@ pub fn signal_render() {
 
 // ── Render Thread ────────────────────────────────────────────────────────────
 
-/// Render thread entry point — event-driven compositing at up to ~60 Hz.
+/// Render thread entry point — event-driven compositing, one frame per refresh.
 ///
 /// Instead of polling at a fixed 16ms interval, the render thread:
 /// 1. Checks if new work was signaled (RENDER_NEEDED flag)
-/// 2. If yes: compose and pace to 60fps
+/// 2. If yes: wait for the next frame-clock tick (vblank-locked when the GPU
+///    reports retrace, see frame_clock.rs) and compose everything pending
 /// 3. If no: sleep with adaptive interval (up to 250ms) and re-check
 ///
 /// The clock is checked during idle at ~1Hz. If the minute changed,
@@ -102,32 +113,66 @@ pub fn render_thread_entry() {
     let mut stat_no_damage: u32 = 0;     // times compose() had NO damage
     let mut stat_lock_fail: u32 = 0;     // times try_lock() failed
     let mut stat_idle_loops: u32 = 0;    // times we entered idle branch
+    let mut stat_tiles: u32 = 0;         // 64x64 damage tiles composited
+    let mut stat_max_tiles: u32 = 0;     // most tiles in a single frame
     let mut stat_last_report: u32 = sys::uptime_ms();
 
+    let mut clock = FrameClock::new(REFRESH_HZ.load(Ordering::Relaxed));
+    // Tick whose frame could not take the lock yet.
+    let mut pending_tick: Option<u64> = None;
+
     loop {
         // ── Periodic stats dump (every 30 seconds) ──
         let now_ms = sys::uptime_ms();
         if now_ms.wrapping_sub(stat_last_report) >= 30000 {
             println!(
-                "GPU-STATS: wake={} dmg={} anim={} no_dmg={} lock_fail={} idle={}",
+                "GPU-STATS: wake={} dmg={} anim={} no_dmg={} lock_fail={} idle={} tiles={} tiles/frame={} max_tiles={}",
                 stat_wakeups, stat_damage, stat_animations,
-                stat_no_damage, stat_lock_fail, stat_idle_loops
+                stat_no_damage, stat_lock_fail, stat_idle_loops,
+                stat_tiles, stat_tiles / stat_damage.max(1), stat_max_tiles
             );
+            if try_lock() {
+                let desktop = unsafe { desktop_ref() };
+                let p = desktop.frame_stats.percentiles();
+                let missed = desktop.frame_stats.missed;
+                let vram = desktop.compositor.vram_allocator.as_ref().map(|a| a.stats());
+                release_lock();
+                println!(
+                    "FRAME-STATS: period={}us vblank={} p50={}us p95={}us p99={}us max={}us missed={}",
+                    clock.period_us(), clock.vblank_locked(),
+                    p.p50_us, p.p95_us, p.p99_us, p.max_us, missed
+                );
+                if let Some(v) = vram {
+                    println!(
+                        "VRAM-STATS: surfaces={} free={}KiB largest={}KiB frag={}permille moves={}",
+                        v.surfaces, v.free_bytes / 1024, v.largest_free_bytes / 1024,
+                        v.fragmentation_permille, v.moves
+                    );
+                }
+            }
             stat_wakeups = 0;
             stat_damage = 0;
             stat_animations = 0;
             stat_no_damage = 0;
             stat_lock_fail = 0;
             stat_idle_loops = 0;
+            stat_tiles = 0;
+            stat_max_tiles = 0;
             stat_last_report = now_ms;
         }
 
         // Check if the management thread signaled new work
-        let work_available = RENDER_NEEDED.swap(false, Ordering::Acquire);
+        let work_available = pending_tick.is_some() || RENDER_NEEDED.load(Ordering::Acquire);
 
         if work_available {
             stat_wakeups += 1;
-            let t0 = sys::uptime_ms();
+            // Wait for the next refresh tick; everything presented until then
+            // is composited together in this frame.
+            let tick = match pending_tick.take() {
+                Some(t) => t,
+                None => clock.wait(),
+            };
+            RENDER_NEEDED.store(false, Ordering::Release);
 
             if try_lock() {
                 crate::desktop::theme::refresh_theme_cache();
@@ -138,15 +183,30 @@ pub fn render_thread_entry() {
                 let has_animations = desktop.tick_animations();
                 desktop.update_clock();
                 desktop.process_deferred_wallpaper();
+                let compose_start = sys::monotonic_ns();
                 let had_damage = desktop.compose();
+                if had_damage {
+                    let tiles = desktop.compositor.last_frame_tiles();
+                    stat_tiles = stat_tiles.saturating_add(tiles);
+                    stat_max_tiles = stat_max_tiles.max(tiles);
+                    let done = sys::monotonic_ns();
+                    let cost_us = (done.saturating_sub(tick) / 1000) as u32;
+                    desktop.frame_stats.record(cost_us, clock.period_us());
+                    desktop.record_frame_metrics((done.saturating_sub(compose_start) / 1000) as u32);
+                }
+                let hud_redrawn = desktop.tick_perf(sys::uptime_ms(), clock.period_us());
 
-                // Emit frame ACKs immediately after VSync (compose + flush_gpu).
-                // This is the VSync callback — apps learn their frame is on screen.
+                // Emit frame-done events right after the frame reached the screen
+                // (compose + flush_gpu): [EVT, window_id, frame_seq, present_ms,
+                // refresh_period_us]. Apps pace their rendering on these.
                 let channel = unsafe { COMPOSITOR_CHANNEL };
                 if channel != 0 && !desktop.frame_ack_queue.is_empty() {
+                    let seq = desktop.frame_stats.frames;
+                    let present_ms = (tick / 1_000_000) as u32;
+                    let period_us = clock.period_us();
                     for &(sub_id, window_id) in &desktop.frame_ack_queue {
                         anyos_std::ipc::evt_chan_emit_to(channel, sub_id, &[
-                            crate::ipc_protocol::EVT_FRAME_ACK, window_id, 0, 0, 0,
+                            crate::ipc_protocol::EVT_FRAME_ACK, window_id, seq, present_ms, period_us,
                         ]);
                     }
                     desktop.frame_ack_queue.clear();
@@ -156,28 +216,20 @@ pub fn render_thread_entry() {
                 if has_animations { stat_animations += 1; }
                 if had_damage { stat_damage += 1; } else { stat_no_damage += 1; }
 
-                // If animations are still active, keep rendering next frame
-                if has_animations {
+                // If animations are still active (or the perf HUD was
+                // redrawn), keep rendering next frame
+                if has_animations || hud_redrawn {
                     RENDER_NEEDED.store(true, Ordering::Release);
                 }
-
-                // Frame pacing: only sleep when actual pixels were composited.
-                // If compose() had no damage, the cycle was nearly free — skip
-                // the 16ms sleep so the render thread returns to idle quickly.
                 if had_damage || has_animations {
                     idle_count = 0;
-                    let elapsed = sys::uptime_ms().wrapping_sub(t0);
-                    let target = 16u32;
-                    if elapsed < target {
-                        process::sleep(target - elapsed);
-                    }
                 }
             } else {
                 stat_lock_fail += 1;
                 // Lock contended — management thread is doing work.
-                // Sleep briefly and retry. Previous frame stays on screen.
+                // Retry this tick shortly. Previous frame stays on screen.
                 process::sleep(1);
-                RENDER_NEEDED.store(true, Ordering::Release);
+                pending_tick = Some(tick);
                 continue;
             }
         } else {
@@ -206,8 +258,11 @@ pub fn render_thread_entry() {
                 if try_lock() {
                     let desktop = unsafe { desktop_ref() };
                     let clock_changed = desktop.update_clock();
+                    // Idle is the time to defragment VRAM: one surface per check.
+                    let compacted = desktop.compact_vram();
+                    let hud_redrawn = desktop.tick_perf(now, clock.period_us());
                     release_lock();
-                    if clock_changed {
+                    if clock_changed || compacted || hud_redrawn {
                         signal_render();
                     }
                 }
@@ -1,6 +1,7 @@
 //! Event Viewer — Windows EventViewer-style log viewer for anyOS.
 //!
-//! Reads log files produced by logd (/System/logs/system.log and rotated files)
+//! Reads log files produced by logd (/System/logs/system.log and rotated files,
+//! gzipped or not) and the boot timeline written by init (/System/logs/boot.log),
 //! and presents them in a sortable, filterable DataGrid with a detail pane.
 
 #![no_std]
@@ -31,6 +32,7 @@ const COLOR_ERROR: u32 = 0xFFFF4444;
 const COLOR_WARN: u32 = 0xFFFFAA00;
 const COLOR_INFO: u32 = 0xFF58D68D;
 const COLOR_KERN: u32 = 0xFF5DADE2;
+const COLOR_BOOT: u32 = 0xFFAF7AC5;
 
 // ── Parsed log entry ─────────────────────────────────────────────────────────
 
@@ -48,10 +50,12 @@ struct App {
     entries: Vec<LogEntry>,
     /// Filtered view indices into `entries`.
     filtered: Vec<usize>,
-    /// Current level filter: 0=All, 1=Error, 2=Warn, 3=Info, 4=Kern, 5=Debug.
+    /// Current level filter: 0=All, 1=Error, 2=Warn, 3=Info, 4=Kern, 5=Debug, 6=Boot.
     filter_level: u32,
     /// Current search text (lowercase).
     search_text: String,
+    /// Sort requested by the grid: (logical column or u32::MAX, direction).
+    sort: (u32, u32),
     /// DataGrid control.
     grid: ui::DataGrid,
     /// Detail label.
@@ -109,19 +113,32 @@ fn parse_log_line(line: &str) -> Option<LogEntry> {
     })
 }
 
-/// Read and parse all log files (system.log, system.log.1, etc.).
-/// Returns entries with newest first.
+/// Read and parse all log files (system.log, system.log.1, etc.) and the
+/// boot timeline. Returns entries with newest first.
 fn load_log_files() -> Vec<LogEntry> {
     let mut entries = Vec::new();
 
+    // Boot timeline of this session (BOOT entries), kept at the end
+    load_single_file(&format!("{}/boot.log", LOG_DIR), &mut entries);
+
     // Read current log file first (has newest entries)
     load_single_file(&format!("{}/system.log", LOG_DIR), &mut entries);
 
-    // Read rotated files (older entries)
+    // Read rotated files (older entries), plain or gzipped by logd
+    let mut zip_loaded = false;
     for i in 1..=8 {
         let path = format!("{}/system.log.{}", LOG_DIR, i);
         let before = entries.len();
         load_single_file(&path, &mut entries);
+        if entries.len() == before {
+            let gz = format!("{}.gz", path);
+            if anyos_std::fs::File::open(&gz).is_ok() && (zip_loaded || libzip_client::init()) {
+                zip_loaded = true;
+                if let Some(data) = gunzip_file(&gz) {
+                    parse_log_text(&String::from_utf8_lossy(&data), &mut entries);
+                }
+            }
+        }
         if entries.len() == before {
             break; // No more rotated files
         }
@@ -135,14 +152,36 @@ fn load_log_files() -> Vec<LogEntry> {
 /// Parse a single log file and append entries to the vector.
 fn load_single_file(path: &str, entries: &mut Vec<LogEntry>) {
     if let Ok(content) = anyos_std::fs::read_to_string(path) {
-        for line in content.split('\n') {
-            if let Some(entry) = parse_log_line(line) {
-                entries.push(entry);
-            }
+        parse_log_text(&content, entries);
+    }
+}
+
+fn parse_log_text(content: &str, entries: &mut Vec<LogEntry>) {
+    for line in content.split('\n') {
+        if let Some(entry) = parse_log_line(line) {
+            entries.push(entry);
         }
     }
 }
 
+/// Decompress a gzipped log file.
+fn gunzip_file(path: &str) -> Option<Vec<u8>> {
+    let compressed = anyos_std::fs::read_to_vec(path).ok()?;
+    let mut stream = libzip_client::Stream::inflate(libzip_client::Format::Gzip)?;
+    let mut out = Vec::new();
+    let mut chunk = alloc::vec![0u8; 16 * 1024];
+    let mut pos = 0;
+    while !stream.is_done() {
+        let (consumed, produced) = stream.process(&compressed[pos..], true, &mut chunk)?;
+        if consumed == 0 && produced == 0 {
+            return None;
+        }
+        pos += consumed;
+        out.extend_from_slice(&chunk[..produced]);
+    }
+    Some(out)
+}
+
 // ── Filtering ────────────────────────────────────────────────────────────────
 
 /// Level name for filter index.
@@ -154,6 +193,7 @@ fn level_matches(entry_level: &str, filter: u32) -> bool {
         3 => entry_level == "INFO",
         4 => entry_level == "KERN",
         5 => entry_level == "DEBUG",
+        6 => entry_level == "BOOT",
         _ => true,
     }
 }
@@ -179,6 +219,30 @@ fn apply_filters(a: &mut App) {
         }
         a.filtered.push(i);
     }
+    apply_sort(a);
+}
+
+/// Sort the filtered view by the grid's sort column (stable, so equal
+/// keys keep the newest-first order).
+fn apply_sort(a: &mut App) {
+    let (col, dir) = a.sort;
+    if dir == ui::SORT_NONE || col == u32::MAX {
+        return;
+    }
+    let entries = &a.entries;
+    a.filtered.sort_by(|&x, &y| {
+        let ord = column_text(&entries[x], col).cmp(column_text(&entries[y], col));
+        if dir == ui::SORT_DESCENDING { ord.reverse() } else { ord }
+    });
+}
+
+fn column_text(e: &LogEntry, col: u32) -> &str {
+    match col {
+        0 => &e.timestamp,
+        1 => &e.level,
+        2 => &e.source,
+        _ => &e.message,
+    }
 }
 
 /// Simple ASCII lowercase conversion.
@@ -198,7 +262,7 @@ fn to_lower(s: &str) -> String {
 
 /// Color for a log level string.
 ///
-/// Severity-specific colors (error, warn, info, kern) are fixed; debug and
+/// Severity-specific colors (error, warn, info, kern, boot) are fixed; debug and
 /// default levels derive from the current theme palette so they adapt to
 /// light/dark mode.
 fn level_color(level: &str) -> u32 {
@@ -208,37 +272,17 @@ fn level_color(level: &str) -> u32 {
         "WARN" => COLOR_WARN,
         "INFO" => COLOR_INFO,
         "KERN" => COLOR_KERN,
+        "BOOT" => COLOR_BOOT,
         "DEBUG" => tc.text_secondary,
         _ => tc.text,
     }
 }
 
-/// Populate the DataGrid from the filtered entries.
+/// Point the (virtual) DataGrid at the filtered entries; it requests the
+/// rows it shows through `supply_rows`.
 fn populate_grid(a: &App) {
-    let count = a.filtered.len();
-
-    // Build row data
-    let mut rows: Vec<Vec<&str>> = Vec::with_capacity(count);
-    for &idx in &a.filtered {
-        let e = &a.entries[idx];
-        rows.push(alloc::vec![
-            e.timestamp.as_str(),
-            e.level.as_str(),
-            e.source.as_str(),
-            e.message.as_str(),
-        ]);
-    }
-    a.grid.set_data(&rows);
-
-    // Set level column colors
-    let col_count = 4u32;
-    let mut colors = alloc::vec![0u32; count * col_count as usize];
-    for (row, &idx) in a.filtered.iter().enumerate() {
-        let color = level_color(&a.entries[idx].level);
-        // Color the level cell (column 1)
-        colors[row * col_count as usize + 1] = color;
-    }
-    a.grid.set_cell_colors(&colors);
+    a.grid.set_row_count(a.filtered.len() as u32);
+    a.grid.invalidate_rows();
 
     // Update status bar
     let total = a.entries.len();
@@ -250,6 +294,29 @@ fn populate_grid(a: &App) {
     }
 }
 
+/// Answer a grid row request from the filtered view.
+fn supply_rows(a: &mut App, req: &ui::DataRequestEvent) {
+    if (req.sort_column, req.sort_direction) != a.sort {
+        a.sort = (req.sort_column, req.sort_direction);
+        apply_filters(a);
+    }
+    let first = req.first as usize;
+    let end = (first + req.count as usize).min(a.filtered.len());
+    let mut buf = Vec::new();
+    let mut colors = Vec::with_capacity(end.saturating_sub(first) * 4);
+    for row in first..end {
+        let e = &a.entries[a.filtered[row]];
+        if row > first { buf.push(0x1E); }
+        for (ci, text) in [&e.timestamp, &e.level, &e.source, &e.message].iter().enumerate() {
+            if ci > 0 { buf.push(0x1F); }
+            buf.extend_from_slice(text.as_bytes());
+        }
+        // Color the level cell (column 1)
+        colors.extend_from_slice(&[0, level_color(&e.level), 0, 0]);
+    }
+    a.grid.set_rows_raw(req.first, &buf, &colors);
+}
+
 /// Show detail for a selected row.
 fn show_detail(a: &App, row_index: u32) {
     if (row_index as usize) >= a.filtered.len() {
@@ -300,8 +367,8 @@ fn main() {
 
     toolbar.add_separator();
 
-    let seg_level = ui::SegmentedControl::new("All|Error|Warn|Info|Kern|Debug");
-    seg_level.set_size(360, 28);
+    let seg_level = ui::SegmentedControl::new("All|Error|Warn|Info|Kern|Debug|Boot");
+    seg_level.set_size(420, 28);
     toolbar.add(&seg_level);
 
     toolbar.add_separator();
@@ -373,6 +440,8 @@ fn main() {
         ui::ColumnDef::new("Message").width(450),
     ];
     grid.set_columns(&cols);
+    // Virtual mode: the grid holds only the rows on screen.
+    grid.set_virtual(true);
     win.add(&grid);
 
     // ── Initialize app state ──
@@ -389,6 +458,7 @@ fn main() {
             filtered,
             filter_level: 0,
             search_text: String::new(),
+            sort: (u32::MAX, ui::SORT_NONE),
             grid,
             detail: detail_label,
             status: status_label,
@@ -424,6 +494,11 @@ fn main() {
         a.detail.set_text("");
     });
 
+    // Grid rows on demand
+    app().grid.on_data_request(|e| {
+        supply_rows(app(), e);
+    });
+
     // Grid row selection
     app().grid.on_selection_changed(|e| {
         show_detail(app(), e.index);
@@ -0,0 +1,351 @@
+// Copyright (c) 2024-2026 Christian Moeller
+// SPDX-License-Identifier: MIT
+
+//! Background directory listing and icon loading.
+//!
+//! One I/O thread does the disk work of the window, so a large or remote
+//! folder never stalls the UI thread:
+//!
+//! - it lists the current directory with `getdents`, handing the entries
+//!   over batch by batch as they are read;
+//! - it resolves and decodes the icons the UI asks for. The UI only asks
+//!   for entries near the viewport, and the thread always serves the
+//!   request closest to it first, so visible icons come in first even
+//!   while scrolling through a long listing.
+//!
+//! Every [`list`] call starts a new generation. Listing batches and icon
+//! requests of an older one are dropped; finished icons are still handed
+//! out (tagged with their generation) so their pixels can be cached.
+//! The UI thread collects everything with [`take`] from a timer.
+
+use anyos_std::sync::{Condvar, Mutex};
+use anyos_std::{fs, icons, String, Vec};
+
+use crate::{FileEntry, TYPE_DIR};
+
+/// Stack of the I/O thread.
+const WORKER_STACK_SIZE: usize = 128 * 1024;
+/// `getdents` buffer; also the largest batch handed over at once.
+const LIST_BUF_SIZE: usize = 8 * 1024;
+
+/// Icon request for one entry of the current listing.
+pub struct IconJob {
+    /// Entry id (`FileEntry::id`).
+    pub id: u32,
+    /// Position of the entry in the view, for prioritizing.
+    pub pos: usize,
+    pub size: u32,
+    /// Full path of the entry.
+    pub path: String,
+    pub entry_type: u8,
+    /// Try the cached thumbnail of the image before its type icon.
+    pub thumbnail: bool,
+    /// Type icon resolved by an earlier request, if any.
+    pub type_icon: Option<String>,
+}
+
+/// Finished icon request.
+pub struct IconDone {
+    pub gen: u32,
+    pub id: u32,
+    pub size: u32,
+    /// Icon cache key: the image itself for a thumbnail, else `type_icon`.
+    pub key: String,
+    /// Type icon of the entry (not resolved if the thumbnail was found).
+    pub type_icon: Option<String>,
+    /// `size x size` pixels for `key`, or `None` if they were sent before
+    /// (or could not be loaded).
+    pub pixels: Option<Vec<u32>>,
+    pub thumbnail: bool,
+    /// The thumbnail is not generated yet (and has been queued).
+    pub thumb_pending: bool,
+}
+
+/// Everything collected by [`take`].
+pub struct Batch {
+    pub entries: Vec<FileEntry>,
+    /// The listing of the current generation is complete.
+    pub listed: bool,
+    pub icons: Vec<IconDone>,
+}
+
+struct Queue {
+    gen: u32,
+    /// Directory to list, taken by the worker.
+    list: Option<String>,
+    entries: Vec<FileEntry>,
+    listed: bool,
+    jobs: Vec<(u32, IconJob)>,
+    done: Vec<IconDone>,
+    /// Visible range of the view (`first..last`).
+    view: (usize, usize),
+}
+
+static QUEUE: Mutex<Queue> = Mutex::new(Queue {
+    gen: 0,
+    list: None,
+    entries: Vec::new(),
+    listed: true,
+    jobs: Vec::new(),
+    done: Vec::new(),
+    view: (0, 0),
+});
+/// Signalled when there is a listing or an icon request to serve.
+static WORK: Condvar = Condvar::new();
+
+/// Start the I/O thread. Returns false if it could not be created.
+pub fn start() -> bool {
+    let stack = anyos_std::process::mmap(WORKER_STACK_SIZE) as usize;
+    if stack == 0 {
+        return false;
+    }
+    // x86_64 ABI: RSP must be STACK_TOP - 8 at function entry
+    let top = stack + WORKER_STACK_SIZE - 8;
+    anyos_std::process::thread_create(worker_main, top, "finder-io") != 0
+}
+
+/// Start listing `path`, cancelling all outstanding work. Returns the new
+/// generation.
+pub fn list(path: &str) -> u32 {
+    let mut q = QUEUE.lock();
+    q.gen = q.gen.wrapping_add(1);
+    q.list = Some(String::from(path));
+    q.entries.clear();
+    q.listed = false;
+    q.jobs.clear();
+    q.view = (0, 0);
+    let gen = q.gen;
+    drop(q);
+    WORK.notify_all();
+    gen
+}
+
+/// Queue icon requests for the current generation.
+pub fn request(jobs: Vec<IconJob>) {
+    let mut q = QUEUE.lock();
+    let gen = q.gen;
+    q.jobs.extend(jobs.into_iter().map(|j| (gen, j)));
+    drop(q);
+    WORK.notify_all();
+}
+
+/// Drop the queued icon requests (the view was rebuilt).
+pub fn cancel_icons() {
+    QUEUE.lock().jobs.clear();
+}
+
+/// Tell the worker which positions are on screen.
+pub fn set_view(first: usize, last: usize) {
+    QUEUE.lock().view = (first, last);
+}
+
+/// Collect new entries and finished icons.
+pub fn take() -> Batch {
+    let mut q = QUEUE.lock();
+    Batch {
+        entries: core::mem::take(&mut q.entries),
+        listed: q.listed,
+        icons: core::mem::take(&mut q.done),
+    }
+}
+
+/// Load `path` as an icon of exactly `size x size` pixels.
+pub fn load_icon(path: &str, size: u32) -> Option<Vec<u32>> {
+    // Icon API selects the best ICO variant for the size
+    let icon = libanyui_client::Icon::load(path, size)?;
+    if icon.width == size && icon.height == size {
+        return Some(icon.pixels);
+    }
+    let mut scaled = Vec::new();
+    scaled.resize((size * size) as usize, 0u32);
+    libimage_client::scale_image(
+        &icon.pixels, icon.width, icon.height,
+        &mut scaled, size, size,
+        libimage_client::MODE_CONTAIN,
+    );
+    Some(scaled)
+}
+
+/// Cached thumbnail of the image file `path`, centered in a `size x size`
+/// square, or `None` if it is not generated yet (it is then queued).
+pub fn load_thumbnail(path: &str, size: u32) -> Option<Vec<u32>> {
+    let mut thumb = Vec::new();
+    thumb.resize((size * size) as usize, 0u32);
+    let (w, h) = libimage_client::thumbnail(path, size, &mut thumb).ok()?;
+
+    let mut pixels = Vec::new();
+    pixels.resize((size * size) as usize, 0u32);
+    let x0 = ((size - w) / 2) as usize;
+    let y0 = ((size - h) / 2) as usize;
+    for row in 0..h as usize {
+        let dst = (y0 + row) * size as usize + x0;
+        pixels[dst..dst + w as usize].copy_from_slice(&thumb[row * w as usize..(row + 1) * w as usize]);
+    }
+    Some(pixels)
+}
+
+/// Type icon of the entry `path`: the bundle or binary icon, the folder
+/// icon or the icon of its mimetype.
+pub fn type_icon(path: &str, entry_type: u8, mimetypes: &icons::MimeDb) -> String {
+    let name = path.rsplit('/').next().unwrap_or(path);
+    if entry_type == TYPE_DIR {
+        if name.ends_with(".app") {
+            return String::from(icons::app_icon_path(path).as_str());
+        }
+        return String::from(icons::FOLDER_ICON);
+    }
+
+    // File: check for app icon first, then mimetype
+    let p = icons::app_icon_path(path);
+    if p.as_str() != icons::DEFAULT_APP_ICON {
+        return String::from(p.as_str());
+    }
+    match crate::get_extension(name) {
+        Some(ext) => String::from(mimetypes.icon_for_ext(ext)),
+        None => String::from(icons::DEFAULT_FILE_ICON),
+    }
+}
+
+// ============================================================================
+// Worker
+// ============================================================================
+
+/// Listing in progress on the worker.
+struct Listing {
+    gen: u32,
+    path: String,
+    cookie: u32,
+    next_id: u32,
+}
+
+enum Work {
+    List(Listing),
+    Icon(u32, IconJob),
+    Continue,
+}
+
+fn worker_main() {
+    let mimetypes = icons::MimeDb::load();
+    let mut buf = anyos_std::vec![0u8; LIST_BUF_SIZE];
+    let mut listing: Option<Listing> = None;
+    // Type icons whose pixels were handed out; the UI keeps them for good
+    let mut sent: Vec<(String, u32)> = Vec::new();
+
+    loop {
+        let work = {
+            let mut q = QUEUE.lock();
+            loop {
+                if let Some(path) = q.list.take() {
+                    break Work::List(Listing { gen: q.gen, path, cookie: 0, next_id: 0 });
+                }
+                if let Some(i) = next_job(&q) {
+                    let (gen, job) = q.jobs.swap_remove(i);
+                    break Work::Icon(gen, job);
+                }
+                if listing.as_ref().map_or(false, |l| l.gen == q.gen) {
+                    break Work::Continue;
+                }
+                listing = None;
+                q = WORK.wait(q);
+            }
+        };
+
+        match work {
+            Work::List(l) => listing = Some(l),
+            Work::Icon(gen, job) => {
+                let done = serve_icon(gen, job, &mimetypes, &mut sent);
+                QUEUE.lock().done.push(done);
+                continue;
+            }
+            Work::Continue => {}
+        }
+
+        // Icon requests come first; the listing goes on one batch at a time
+        if let Some(l) = listing.as_mut() {
+            if !list_batch(l, &mut buf) {
+                listing = None;
+            }
+        }
+    }
+}
+
+/// Index of the queued request closest to the view.
+fn next_job(q: &Queue) -> Option<usize> {
+    let (first, last) = q.view;
+    q.jobs.iter()
+        .enumerate()
+        .min_by_key(|(_, (_, j))| {
+            if j.pos < first { first - j.pos } else { j.pos.saturating_sub(last) }
+        })
+        .map(|(i, _)| i)
+}
+
+/// Read and hand over the next batch of `l`. Returns false once the
+/// listing is complete (or was superseded).
+fn list_batch(l: &mut Listing, buf: &mut [u8]) -> bool {
+    let count = fs::getdents(&l.path, buf, &mut l.cookie);
+    let end = count == 0 || count == u32::MAX;
+
+    let mut batch = Vec::new();
+    let mut off = 0usize;
+    for _ in 0..if end { 0 } else { count } {
+        let rec = &buf[off..];
+        let reclen = u16::from_le_bytes([rec[0], rec[1]]) as usize;
+        let entry_type = rec[2];
+        let size = u32::from_le_bytes([rec[4], rec[5], rec[6], rec[7]]);
+        let name_len = u16::from_le_bytes([rec[14], rec[15]]) as usize;
+        let mut name = [0u8; 56];
+        let copy_len = name_len.min(55);
+        name[..copy_len].copy_from_slice(&rec[20..20 + copy_len]);
+        batch.push(FileEntry::new(l.next_id, name, copy_len, entry_type, size));
+        l.next_id += 1;
+        off += reclen;
+    }
+
+    let mut q = QUEUE.lock();
+    if q.gen != l.gen {
+        return false;
+    }
+    q.entries.extend(batch);
+    if end {
+        q.listed = true;
+    }
+    !end
+}
+
+fn serve_icon(gen: u32, job: IconJob, mimetypes: &icons::MimeDb, sent: &mut Vec<(String, u32)>) -> IconDone {
+    let mut done = IconDone {
+        gen,
+        id: job.id,
+        size: job.size,
+        key: String::new(),
+        type_icon: job.type_icon,
+        pixels: None,
+        thumbnail: false,
+        thumb_pending: false,
+    };
+
+    if job.thumbnail {
+        match load_thumbnail(&job.path, job.size) {
+            Some(pixels) => {
+                done.key = job.path;
+                done.pixels = Some(pixels);
+                done.thumbnail = true;
+                return done;
+            }
+            None => done.thumb_pending = true,
+        }
+    }
+
+    let key = done.type_icon.take()
+        .unwrap_or_else(|| type_icon(&job.path, job.entry_type, mimetypes));
+    if !sent.iter().any(|(p, s)| *p == key && *s == job.size) {
+        done.pixels = load_icon(&key, job.size);
+        if done.pixels.is_some() {
+            sent.push((key.clone(), job.size));
+        }
+    }
+    done.type_icon = Some(key.clone());
+    done.key = key;
+    done
+}
@@ -8,7 +8,9 @@ use anyos_std::icons;
 use anyos_std::process;
 
 use libanyui_client as ui;
-use ui::{Icon, Widget};
+use ui::Widget;
+
+mod loader;
 
 anyos_std::entry!(main);
 
@@ -23,9 +25,19 @@ const ICON_SIZE_SMALL: u32 = 16;
 const ICON_SIZE_LARGE: u32 = 48;
 const GRID_CELL_W: u32 = 90;
 const GRID_CELL_H: u32 = 80;
+const LIST_ROW_H: u32 = 26;
 
 const MAX_LOCATIONS: usize = 16;
 
+/// How often to check whether background thumbnails became ready.
+const THUMB_POLL_MS: u32 = 250;
+/// How often to collect listed entries and loaded icons.
+const LOADER_POLL_MS: u32 = 40;
+/// Entries beyond either edge of the viewport whose icons are loaded ahead.
+const ICON_LOOKAHEAD: usize = 32;
+/// Extensions of files shown by their thumbnail.
+const THUMB_EXTENSIONS: [&str; 6] = ["png", "jpg", "jpeg", "bmp", "gif", "ico"];
+
 // Default sidebar locations (used if no finder.conf found)
 const DEFAULT_LOCATIONS: [(&str, &str); 6] = [
     ("Root", "/"),
@@ -124,13 +136,25 @@ fn load_locations() -> Vec<Location> {
 // ============================================================================
 
 struct FileEntry {
+    /// Position in listing order, which names the entry across re-sorting.
+    id: u32,
     name: [u8; 56],
     name_len: usize,
     entry_type: u8,
     size: u32,
+    /// Type icon, once the loader resolved it.
+    icon: Option<String>,
+    /// An icon request for the current view was queued (or is not needed).
+    requested: bool,
+    /// Shown with its type icon until its thumbnail is generated.
+    thumb_wait: bool,
 }
 
 impl FileEntry {
+    fn new(id: u32, name: [u8; 56], name_len: usize, entry_type: u8, size: u32) -> Self {
+        Self { id, name, name_len, entry_type, size, icon: None, requested: false, thumb_wait: false }
+    }
+
     fn name_str(&self) -> &str {
         core::str::from_utf8(&self.name[..self.name_len]).unwrap_or("???")
     }
@@ -149,6 +173,7 @@ struct CachedIcon {
     pixels: Vec<u32>,
     width: u32,
     height: u32,
+    thumbnail: bool,
 }
 
 struct IconCache {
@@ -160,6 +185,10 @@ impl IconCache {
         Self { entries: Vec::new() }
     }
 
+    fn contains(&self, path: &str, target_size: u32) -> bool {
+        self.entries.iter().any(|e| e.path == path && e.width == target_size)
+    }
+
     /// Load an icon, ensuring it is exactly `target_size x target_size` pixels.
     fn get_or_load(&mut self, path: &str, target_size: u32) -> Option<(&[u32], u32, u32)> {
         // Build cache key: path + size
@@ -168,32 +197,46 @@ impl IconCache {
             return Some((&e.pixels, e.width, e.height));
         }
 
-        // Load via Icon API (selects best ICO variant for preferred_size)
-        let icon = Icon::load(path, target_size)?;
-
-        // If the icon isn't the exact target size, scale it
-        let (final_pixels, final_w, final_h) = if icon.width == target_size && icon.height == target_size {
-            (icon.pixels, icon.width, icon.height)
-        } else {
-            let pixel_count = (target_size * target_size) as usize;
-            let mut scaled = Vec::new();
-            scaled.resize(pixel_count, 0u32);
-            libimage_client::scale_image(
-                &icon.pixels, icon.width, icon.height,
-                &mut scaled, target_size, target_size,
-                libimage_client::MODE_CONTAIN,
-            );
-            (scaled, target_size, target_size)
-        };
+        let pixels = loader::load_icon(path, target_size)?;
+        self.insert(path, pixels, target_size, false);
+        let e = self.entries.last().unwrap();
+        Some((&e.pixels, e.width, e.height))
+    }
 
+    /// Add `target_size x target_size` pixels loaded elsewhere for `path`.
+    fn insert(&mut self, path: &str, pixels: Vec<u32>, target_size: u32, thumbnail: bool) {
+        if self.contains(path, target_size) {
+            return;
+        }
         self.entries.push(CachedIcon {
             path: String::from(path),
-            pixels: final_pixels,
-            width: final_w,
-            height: final_h,
+            pixels,
+            width: target_size,
+            height: target_size,
+            thumbnail,
         });
-        let e = self.entries.last().unwrap();
-        Some((&e.pixels, e.width, e.height))
+    }
+
+    /// Load the cached thumbnail of the image file `path`, centered in a
+    /// `target_size` square, so that `get_or_load(path, target_size)` finds it.
+    ///
+    /// Returns false if it is not generated yet (it is then queued).
+    fn load_thumbnail(&mut self, path: &str, target_size: u32) -> bool {
+        if self.contains(path, target_size) {
+            return true;
+        }
+        match loader::load_thumbnail(path, target_size) {
+            Some(pixels) => {
+                self.insert(path, pixels, target_size, true);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Drop thumbnails so changed files are looked up again.
+    fn forget_thumbnails(&mut self) {
+        self.entries.retain(|e| !e.thumbnail);
     }
 }
 
@@ -216,6 +259,7 @@ struct AppState {
     icon_scroll: ui::ScrollView,
     icon_flow: ui::FlowPanel,
     icon_item_ids: Vec<u32>,   // track created items for cleanup
+    icon_views: Vec<ui::ImageView>, // icon of each item in icon view
     icon_selected: Vec<bool>,  // per-item selection state in icon view
     icon_anchor: usize,        // anchor index for Shift+Click range selection
     path_field: ui::TextField,
@@ -238,6 +282,12 @@ struct AppState {
     clip_is_cut: bool,
     // Copy/move operation state
     copy_op: Option<CopyOperation>,
+    // Background listing: generation of the current one, whether it is
+    // complete, and the position of each entry by id
+    load_gen: u32,
+    listed: bool,
+    entry_pos: Vec<usize>,
+    thumb_generation: u32,
 }
 
 /// State for an ongoing copy/move operation (timer-driven).
@@ -267,33 +317,70 @@ fn app() -> &'static mut AppState {
 // Directory reading
 // ============================================================================
 
-fn read_directory(path: &str) -> Vec<FileEntry> {
-    let mut buf = [0u8; 256 * 64];
-    let count = fs::readdir(path, &mut buf);
-    if count == u32::MAX {
-        return Vec::new();
-    }
+/// Start listing the current directory in the background; the entries
+/// arrive through `loader_tick`.
+fn load_directory() {
+    let s = app();
+    s.load_gen = loader::list(&s.cwd);
+    s.entries.clear();
+    s.entry_pos.clear();
+    s.listed = false;
+}
 
-    let mut entries = Vec::new();
-    for i in 0..count as usize {
-        let off = i * 64;
-        let entry_type = buf[off];
-        let name_len = buf[off + 1] as usize;
-        let size = u32::from_le_bytes([buf[off + 4], buf[off + 5], buf[off + 6], buf[off + 7]]);
-        let mut name = [0u8; 56];
-        let copy_len = name_len.min(55);
-        name[..copy_len].copy_from_slice(&buf[off + 8..off + 8 + copy_len]);
-        entries.push(FileEntry { name, name_len: copy_len, entry_type, size });
+fn is_sorted(entries: &[FileEntry]) -> bool {
+    entries.windows(2).all(|w| entry_order(&w[0], &w[1]) != core::cmp::Ordering::Greater)
+}
+
+/// Directories first, then by name.
+fn entry_order(a: &FileEntry, b: &FileEntry) -> core::cmp::Ordering {
+    if a.entry_type != b.entry_type {
+        return a.entry_type.cmp(&b.entry_type).reverse();
     }
+    a.name[..a.name_len].cmp(&b.name[..b.name_len])
+}
 
-    entries.sort_by(|a, b| {
-        if a.entry_type != b.entry_type {
-            return a.entry_type.cmp(&b.entry_type).reverse();
+/// Collect listed entries and loaded icons, and queue icon requests for
+/// the entries around the viewport.
+fn loader_tick() {
+    let s = app();
+    let batch = loader::take();
+
+    let shown = s.entries.len();
+    s.entries.extend(batch.entries);
+    let mut rebuilt = false;
+    if batch.listed && !s.listed {
+        s.listed = true;
+        if !is_sorted(&s.entries) {
+            s.entries.sort_by(entry_order);
+            if shown > 0 {
+                // Positions changed under the view: lay it out again
+                s.entry_pos.clear();
+                loader::cancel_icons();
+                clear_selection();
+                rebuilt = true;
+            }
         }
-        a.name[..a.name_len].cmp(&b.name[..b.name_len])
-    });
+    }
+    if s.entry_pos.len() < s.entries.len() {
+        s.entry_pos.resize(s.entries.len(), 0);
+        for (pos, e) in s.entries.iter().enumerate() {
+            s.entry_pos[e.id as usize] = pos;
+        }
+    }
+    if rebuilt {
+        refresh_view();
+    } else if s.entries.len() > shown {
+        append_to_view(shown);
+    }
+    if s.entries.len() != shown || rebuilt {
+        let count_str = anyos_std::format!("{} items", s.entries.len());
+        s.sb_items_label.set_text(&count_str);
+    }
 
-    entries
+    for done in batch.icons {
+        apply_icon(done);
+    }
+    request_visible_icons();
 }
 
 // ============================================================================
@@ -608,28 +695,151 @@ fn get_selected_indices() -> Vec<usize> {
 // Icon path resolution (same logic as original — folder, .app, mimetype)
 // ============================================================================
 
-fn resolve_icon_path(s: &AppState, entry_idx: usize) -> String {
+fn resolve_icon_path(s: &mut AppState, entry_idx: usize) -> String {
+    if let Some(icon) = &s.entries[entry_idx].icon {
+        return icon.clone();
+    }
     let entry = &s.entries[entry_idx];
-    let name = entry.name_str();
+    let full = build_full_path(&s.cwd, entry.name_str());
+    let icon = loader::type_icon(&full, entry.entry_type, &s.mimetypes);
+    s.entries[entry_idx].icon = Some(icon.clone());
+    icon
+}
+
+fn is_thumbnail_file(entry: &FileEntry) -> bool {
+    entry.entry_type == TYPE_FILE
+        && get_extension(entry.name_str())
+            .map_or(false, |ext| THUMB_EXTENSIONS.iter().any(|t| t.eq_ignore_ascii_case(ext)))
+}
 
-    if entry.entry_type == TYPE_DIR {
-        if name.ends_with(".app") {
-            let full = build_full_path(&s.cwd, name);
-            let p = icons::app_icon_path(&full);
-            return String::from(p.as_str());
+fn view_icon_size(s: &AppState) -> u32 {
+    if s.view_mode == VIEW_LIST { ICON_SIZE_SMALL } else { ICON_SIZE_LARGE }
+}
+
+/// Icon key for entry `entry_idx` that needs no disk access: its thumbnail
+/// or type icon if cached already, else a generic folder or file icon
+/// until the loader delivers the real one.
+fn cached_icon_path(s: &mut AppState, entry_idx: usize, size: u32) -> String {
+    let full = build_full_path(&s.cwd, s.entries[entry_idx].name_str());
+    let entry = &mut s.entries[entry_idx];
+    entry.thumb_wait = false;
+    entry.requested = true;
+    if entry.icon.is_none() && entry.entry_type == TYPE_DIR && !entry.is_app_bundle() {
+        entry.icon = Some(String::from(icons::FOLDER_ICON));
+    }
+    if is_thumbnail_file(entry) && s.icon_cache.contains(&full, size) {
+        return full;
+    }
+    if !is_thumbnail_file(entry) {
+        if let Some(icon) = &entry.icon {
+            if s.icon_cache.contains(icon, size) {
+                return icon.clone();
+            }
+        }
+    }
+    entry.requested = false;
+    let generic = if entry.entry_type == TYPE_DIR { icons::FOLDER_ICON } else { icons::DEFAULT_FILE_ICON };
+    String::from(generic)
+}
+
+/// Show the cached icon `icon_path` for entry `entry_idx` in the current view.
+fn show_icon(s: &mut AppState, entry_idx: usize, icon_path: &str) {
+    let size = view_icon_size(s);
+    let (view_mode, grid, icon_view) = (s.view_mode, s.grid, s.icon_views.get(entry_idx).copied());
+    if let Some((pixels, w, h)) = s.icon_cache.get_or_load(icon_path, size) {
+        if view_mode == VIEW_LIST {
+            grid.set_cell_icon(entry_idx as u32, 0, pixels, w, h);
+        } else if let Some(iv) = icon_view {
+            iv.set_pixels(pixels, w, h);
         }
-        return String::from(icons::FOLDER_ICON);
     }
+}
+
+/// Take in an icon finished by the loader.
+fn apply_icon(done: loader::IconDone) {
+    let s = app();
+    if let Some(pixels) = done.pixels {
+        s.icon_cache.insert(&done.key, pixels, done.size, done.thumbnail);
+    }
+    if done.gen != s.load_gen || done.size != view_icon_size(s) {
+        return;
+    }
+    let Some(&idx) = s.entry_pos.get(done.id as usize) else {
+        return;
+    };
+    let entry = &mut s.entries[idx];
+    if done.type_icon.is_some() {
+        entry.icon = done.type_icon;
+    }
+    entry.thumb_wait = done.thumb_pending;
+    show_icon(s, idx, &done.key);
+}
 
-    // File: check for app icon first, then mimetype
-    let full = build_full_path(&s.cwd, name);
-    let p = icons::app_icon_path(&full);
-    if p.as_str() != icons::DEFAULT_APP_ICON {
-        return String::from(p.as_str());
+/// Range of entry positions currently on screen.
+fn visible_range(s: &AppState) -> (usize, usize) {
+    if s.view_mode == VIEW_LIST {
+        let (_, h) = s.grid.get_size();
+        let first = (s.grid.scroll_offset() / LIST_ROW_H) as usize;
+        (first, first + (h / LIST_ROW_H) as usize + 1)
+    } else {
+        let cols = icon_cols_per_row();
+        let (_, h) = s.icon_scroll.get_size();
+        let top = ui::Control::from_id(s.icon_scroll.id()).get_state();
+        let first = (top / GRID_CELL_H) as usize * cols;
+        (first, first + ((h / GRID_CELL_H) as usize + 2) * cols)
     }
-    match get_extension(name) {
-        Some(ext) => String::from(s.mimetypes.icon_for_ext(ext)),
-        None => String::from(icons::DEFAULT_FILE_ICON),
+}
+
+/// Ask the loader for the icons of the entries around the viewport that
+/// do not have theirs yet.
+fn request_visible_icons() {
+    let s = app();
+    let n = s.entries.len();
+    if n == 0 {
+        return;
+    }
+    let (first, last) = visible_range(s);
+    loader::set_view(first, last);
+
+    let size = view_icon_size(s);
+    let mut jobs = Vec::new();
+    for pos in first.saturating_sub(ICON_LOOKAHEAD)..(last + ICON_LOOKAHEAD).min(n) {
+        let entry = &mut s.entries[pos];
+        if entry.requested {
+            continue;
+        }
+        entry.requested = true;
+        jobs.push(loader::IconJob {
+            id: entry.id,
+            pos,
+            size,
+            path: build_full_path(&s.cwd, entry.name_str()),
+            entry_type: entry.entry_type,
+            thumbnail: is_thumbnail_file(entry),
+            type_icon: entry.icon.clone(),
+        });
+    }
+    if !jobs.is_empty() {
+        loader::request(jobs);
+    }
+}
+
+/// Ask again for the thumbnails generated in the background since the
+/// last tick.
+fn thumbnail_tick() {
+    let s = app();
+    if !s.entries.iter().any(|e| e.thumb_wait) {
+        return;
+    }
+    let generation = libimage_client::thumbnail_generation();
+    if generation == s.thumb_generation {
+        return;
+    }
+    s.thumb_generation = generation;
+
+    for entry in s.entries.iter_mut().filter(|e| e.thumb_wait) {
+        entry.thumb_wait = false;
+        entry.requested = false;
     }
 }
 
@@ -663,7 +873,7 @@ fn navigate(path: &str) {
         s.history.truncate(s.history_pos + 1);
     }
     s.cwd = String::from(path);
-    s.entries = read_directory(path);
+    load_directory();
     s.history.push(s.cwd.clone());
     s.history_pos = s.history.len() - 1;
     sync_sidebar(path);
@@ -676,7 +886,7 @@ fn navigate_back() {
     s.history_pos -= 1;
     let path = s.history[s.history_pos].clone();
     s.cwd = path.clone();
-    s.entries = read_directory(&path);
+    load_directory();
     clear_selection();
     sync_sidebar(&path);
     refresh_ui();
@@ -688,7 +898,7 @@ fn navigate_forward() {
     s.history_pos += 1;
     let path = s.history[s.history_pos].clone();
     s.cwd = path.clone();
-    s.entries = read_directory(&path);
+    load_directory();
     clear_selection();
     sync_sidebar(&path);
     refresh_ui();
@@ -703,8 +913,8 @@ fn navigate_up() {
 
 fn refresh_current() {
     let s = app();
-    let path = s.cwd.clone();
-    s.entries = read_directory(&path);
+    load_directory();
+    s.icon_cache.forget_thumbnails();
     refresh_ui();
 }
 
@@ -1676,16 +1886,22 @@ fn show_properties(idx: usize) {
     let name = String::from(entry.name_str());
     let is_dir = entry.entry_type == TYPE_DIR;
     let is_app = entry.is_app_bundle();
+    let is_image = is_thumbnail_file(entry);
+    let entry_size = entry.size;
     let full_path = build_full_path(&s.cwd, &name);
     let location = String::from(s.cwd.as_str());
 
     // Get icon
-    let icon_path = resolve_icon_path(s, idx);
+    let icon_path = if is_image && s.icon_cache.load_thumbnail(&full_path, ICON_SIZE_LARGE) {
+        full_path.clone()
+    } else {
+        resolve_icon_path(s, idx)
+    };
 
     // Stat the file for metadata
     let mut stat_buf = [0u32; 7];
     let has_stat = fs::stat(&full_path, &mut stat_buf) == 0;
-    let file_size = if has_stat { stat_buf[1] } else { entry.size };
+    let file_size = if has_stat { stat_buf[1] } else { entry_size };
     let mtime = if has_stat { stat_buf[6] } else { 0 };
     let mode = if has_stat { stat_buf[5] } else { 0 };
 
@@ -1930,50 +2146,47 @@ fn refresh_ui() {
 
 fn populate_grid() {
     let s = app();
-    let n = s.entries.len();
-
-    if n == 0 {
-        s.grid.set_data(&[]);
-        return;
-    }
+    s.grid.set_data(&[]);
+    append_grid_rows(0);
+    s.grid.set_scroll_offset(0);
+}
 
-    let mut display_names: Vec<String> = Vec::new();
-    let mut size_strings: Vec<String> = Vec::new();
+/// Add list rows for the entries from `first` on.
+fn append_grid_rows(first: usize) {
+    let s = app();
+    let n = s.entries.len();
+    s.grid.set_row_count(n as u32);
 
-    for entry in &s.entries {
+    for i in first..n {
+        let entry = &s.entries[i];
         let name = entry.name_str();
         let display = if entry.entry_type == TYPE_DIR {
-            String::from(name.strip_suffix(".app").unwrap_or(name))
+            name.strip_suffix(".app").unwrap_or(name)
         } else {
-            String::from(name)
+            name
         };
-        display_names.push(display);
-
+        s.grid.set_cell(i as u32, 0, display);
         if entry.entry_type == TYPE_FILE {
-            size_strings.push(fmt_size(entry.size));
+            s.grid.set_cell(i as u32, 1, &fmt_size(entry.size));
         } else {
-            size_strings.push(String::from("--"));
+            s.grid.set_cell(i as u32, 1, "--");
         }
-    }
 
-    let mut rows: Vec<Vec<&str>> = Vec::new();
-    for i in 0..n {
-        let mut row = Vec::new();
-        row.push(display_names[i].as_str());
-        row.push(size_strings[i].as_str());
-        rows.push(row);
+        // Icons are always scaled to ICON_SIZE_SMALL
+        let icon_path = cached_icon_path(s, i, ICON_SIZE_SMALL);
+        show_icon(s, i, &icon_path);
     }
-    s.grid.set_data(&rows);
+}
 
-    // Set icons (always scaled to ICON_SIZE_SMALL)
-    for i in 0..n {
-        let icon_path = resolve_icon_path(s, i);
-        if let Some((pixels, w, h)) = s.icon_cache.get_or_load(&icon_path, ICON_SIZE_SMALL) {
-            s.grid.set_cell_icon(i as u32, 0, pixels, w, h);
+/// Add the entries from `first` on to the current view.
+fn append_to_view(first: usize) {
+    if app().view_mode == VIEW_LIST {
+        append_grid_rows(first);
+    } else {
+        for i in first..app().entries.len() {
+            add_icon_cell(i);
         }
     }
-
-    s.grid.set_scroll_offset(0);
 }
 
 // ============================================================================
@@ -1988,71 +2201,74 @@ fn populate_icon_view() {
         ui::Control::from_id(id).remove();
     }
     s.icon_item_ids.clear();
+    s.icon_views.clear();
     s.icon_selected.clear();
 
-    let n = s.entries.len();
+    for i in 0..s.entries.len() {
+        add_icon_cell(i);
+    }
+}
 
-    for i in 0..n {
-        // Resolve icon path first (returns owned String)
-        let icon_path = resolve_icon_path(s, i);
+/// Create the icon view cell of entry `i` (the next one).
+fn add_icon_cell(i: usize) {
+    let s = app();
+    let icon_path = cached_icon_path(s, i, ICON_SIZE_LARGE);
 
-        let entry = &s.entries[i];
-        let name = entry.name_str();
-        let display_name = if entry.entry_type == TYPE_DIR {
-            name.strip_suffix(".app").unwrap_or(name)
-        } else {
-            name
-        };
+    let entry = &s.entries[i];
+    let name = entry.name_str();
+    let display_name = if entry.entry_type == TYPE_DIR {
+        name.strip_suffix(".app").unwrap_or(name)
+    } else {
+        name
+    };
 
-        // Truncate long names
-        let max_chars = 12usize;
-        let label_text = if display_name.len() > max_chars {
-            let mut t = String::from(&display_name[..max_chars]);
-            t.push_str("..");
-            t
-        } else {
-            String::from(display_name)
-        };
+    // Truncate long names
+    let max_chars = 12usize;
+    let label_text = if display_name.len() > max_chars {
+        let mut t = String::from(&display_name[..max_chars]);
+        t.push_str("..");
+        t
+    } else {
+        String::from(display_name)
+    };
 
-        // Create a cell: View containing ImageView + Label
-        let cell = ui::View::new();
-        cell.set_size(GRID_CELL_W, GRID_CELL_H);
-        cell.set_color(0x00000000); // transparent
-
-        // Icon (centered at top of cell)
-        let iv = ui::ImageView::new(ICON_SIZE_LARGE, ICON_SIZE_LARGE);
-        iv.set_dock(ui::DOCK_TOP);
-        iv.set_margin(
-            ((GRID_CELL_W - ICON_SIZE_LARGE) / 2) as i32,
-            4,
-            ((GRID_CELL_W - ICON_SIZE_LARGE) / 2) as i32,
-            0,
-        );
-        if let Some((pixels, w, h)) = s.icon_cache.get_or_load(&icon_path, ICON_SIZE_LARGE) {
-            iv.set_pixels(pixels, w, h);
-        }
-        cell.add(&iv);
+    // Create a cell: View containing ImageView + Label
+    let cell = ui::View::new();
+    cell.set_size(GRID_CELL_W, GRID_CELL_H);
+    cell.set_color(0x00000000); // transparent
+
+    // Icon (centered at top of cell)
+    let iv = ui::ImageView::new(ICON_SIZE_LARGE, ICON_SIZE_LARGE);
+    iv.set_dock(ui::DOCK_TOP);
+    iv.set_margin(
+        ((GRID_CELL_W - ICON_SIZE_LARGE) / 2) as i32,
+        4,
+        ((GRID_CELL_W - ICON_SIZE_LARGE) / 2) as i32,
+        0,
+    );
+    cell.add(&iv);
+    s.icon_views.push(iv);
+    show_icon(s, i, &icon_path);
 
-        // Label below icon
-        let tc = ui::theme::colors();
-        let lbl = ui::Label::new(&label_text);
-        lbl.set_dock(ui::DOCK_TOP);
-        lbl.set_size(GRID_CELL_W, 18);
-        lbl.set_font_size(11);
-        lbl.set_text_color(tc.text);
-        lbl.set_text_align(ui::TEXT_ALIGN_CENTER);
-        cell.add(&lbl);
+    // Label below icon
+    let tc = ui::theme::colors();
+    let lbl = ui::Label::new(&label_text);
+    lbl.set_dock(ui::DOCK_TOP);
+    lbl.set_size(GRID_CELL_W, 18);
+    lbl.set_font_size(11);
+    lbl.set_text_color(tc.text);
+    lbl.set_text_align(ui::TEXT_ALIGN_CENTER);
+    cell.add(&lbl);
 
-        // Click → select, double-click → open, right-click → select + context menu
-        cell.on_click_raw(icon_item_click_handler, i as u64);
-        cell.on_double_click_raw(icon_item_dblclick_handler, i as u64);
-        cell.on_event_raw(ui::EVENT_CONTEXT_MENU, icon_item_context_handler, i as u64);
-        cell.set_context_menu(&s.ctx_menu);
+    // Click → select, double-click → open, right-click → select + context menu
+    cell.on_click_raw(icon_item_click_handler, i as u64);
+    cell.on_double_click_raw(icon_item_dblclick_handler, i as u64);
+    cell.on_event_raw(ui::EVENT_CONTEXT_MENU, icon_item_context_handler, i as u64);
+    cell.set_context_menu(&s.ctx_menu);
 
-        s.icon_flow.add(&cell);
-        s.icon_item_ids.push(cell.id());
-        s.icon_selected.push(false);
-    }
+    s.icon_flow.add(&cell);
+    s.icon_item_ids.push(cell.id());
+    s.icon_selected.push(false);
 }
 
 fn update_selection_status_multi() {
@@ -2381,7 +2597,7 @@ fn main() {
         ui::ColumnDef::new("Name").width(400),
         ui::ColumnDef::new("Size").width(100).align(ui::ALIGN_RIGHT).numeric(),
     ]);
-    grid.set_row_height(26);
+    grid.set_row_height(LIST_ROW_H);
     grid.set_header_height(28);
     grid.set_selection_mode(ui::SELECTION_MULTI);
 
@@ -2426,6 +2642,7 @@ fn main() {
             icon_scroll,
             icon_flow,
             icon_item_ids: Vec::new(),
+            icon_views: Vec::new(),
             icon_selected: Vec::new(),
             icon_anchor: 0,
             path_field,
@@ -2443,6 +2660,10 @@ fn main() {
             clip_files: Vec::new(),
             clip_is_cut: false,
             copy_op: None,
+            load_gen: 0,
+            listed: true,
+            entry_pos: Vec::new(),
+            thumb_generation: libimage_client::thumbnail_generation(),
         });
     }
 
@@ -2454,7 +2675,10 @@ fn main() {
     } else {
         "/"
     };
+    loader::start();
     navigate(initial_path);
+    ui::set_timer(LOADER_POLL_MS, loader_tick);
+    ui::set_timer(THUMB_POLL_MS, thumbnail_tick);
 
     // ── Event handlers ───────────────────────────────────────────────────
 
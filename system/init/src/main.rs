@@ -6,6 +6,7 @@ use anyos_std::sys;
 use anyos_std::fs;
 use anyos_std::ipc;
 use anyos_std::println;
+use anyos_std::{format, String, Vec};
 
 anyos_std::entry!(main);
 
@@ -69,91 +70,397 @@ fn benchmark_memory(duration_ticks: u32) -> u32 {
     iterations
 }
 
-// ─── Init Config Parser ─────────────────────────────────────────────────────
+// ─── Units ──────────────────────────────────────────────────────────────────
+
+const INIT_CONF: &str = "/System/etc/init/init.conf";
+/// Timeline of the last boot, shown by the Event Viewer.
+const BOOT_LOG: &str = "/System/logs/boot.log";
+/// Thread whose readiness ends the boot timeline.
+const LOGIN_NAME: &str = "login";
+/// How often running units are checked for exit while waiting for events.
+const POLL_MS: u32 = 50;
+/// A `ready=notify` unit that has not signalled by then counts as ready.
+const NOTIFY_TIMEOUT_MS: u32 = 10_000;
+/// How long to wait for the login window once all units are settled.
+const LOGIN_TIMEOUT_MS: u32 = 30_000;
+
+/// When a started unit counts as ready.
+#[derive(Clone, Copy, PartialEq)]
+enum Ready {
+    /// As soon as it is running.
+    Spawn,
+    /// When it exits with code 0 (one-shot jobs).
+    Exit,
+    /// When it calls `ipc::notify_ready()`.
+    Notify,
+}
 
-/// Read /System/etc/init/init.conf and spawn each program listed (one path per line).
-/// Lines starting with '#' are comments. Empty lines are skipped.
-fn run_init_conf() {
-    // Read config file
-    let fd = fs::open("/System/etc/init/init.conf", 0); // read-only
-    if fd == u32::MAX {
-        println!("init: /System/etc/init/init.conf not found, skipping");
-        return;
+#[derive(Clone, Copy, PartialEq)]
+enum State {
+    Waiting,
+    Running,
+    Ready,
+    Failed,
+}
+
+struct Unit {
+    name: String,
+    exec: String,
+    args: String,
+    /// Units that must be ready first; the unit is skipped if one fails.
+    after: Vec<String>,
+    /// Units that must be settled first; their failure is not fatal.
+    wants: Vec<String>,
+    ready: Ready,
+    state: State,
+    tid: u32,
+    started_ms: u32,
+}
+
+impl Unit {
+    fn new(name: &str) -> Self {
+        Unit {
+            name: String::from(name),
+            exec: String::new(),
+            args: String::new(),
+            after: Vec::new(),
+            wants: Vec::new(),
+            ready: Ready::Spawn,
+            state: State::Waiting,
+            tid: 0,
+            started_ms: 0,
+        }
     }
 
-    let mut buf = [0u8; 1024];
-    let n = fs::read(fd, &mut buf) as usize;
-    fs::close(fd);
+    /// Apply one `key=value` line of a section or service config.
+    fn set(&mut self, key: &str, value: &str) {
+        let list = || value.split(',').map(str::trim).filter(|n| !n.is_empty()).map(String::from);
+        match key {
+            "exec" => self.exec = String::from(value),
+            "args" => self.args = String::from(value),
+            // `depends=` is the svc spelling of `after=`
+            "after" | "depends" => self.after.extend(list()),
+            "wants" => self.wants.extend(list()),
+            "ready" => match value {
+                "spawn" => self.ready = Ready::Spawn,
+                "exit" => self.ready = Ready::Exit,
+                "notify" => self.ready = Ready::Notify,
+                _ => println!("init: {}: unknown ready={}", self.name, value),
+            },
+            _ => {}
+        }
+    }
 
-    if n == 0 {
-        println!("init: /System/etc/init/init.conf is empty");
-        return;
+    fn settled(&self) -> bool {
+        self.state == State::Ready || self.state == State::Failed
     }
+}
 
-    // Parse line by line
-    let data = &buf[..n];
-    let mut line_start = 0;
-    for i in 0..=n {
-        let at_end = i == n;
-        let is_newline = !at_end && data[i] == b'\n';
+/// Add `unit` unless it has no program or its name is taken.
+fn push_unit(units: &mut Vec<Unit>, unit: Unit) {
+    if unit.exec.is_empty() {
+        println!("init: {}: no exec=, skipped", unit.name);
+    } else if units.iter().any(|u| u.name == unit.name) {
+        println!("init: {}: declared twice, keeping the first", unit.name);
+    } else {
+        units.push(unit);
+    }
+}
 
-        if is_newline || at_end {
-            let line_end = if !at_end && i > 0 && data[i.saturating_sub(1)] == b'\r' {
-                i - 1
-            } else {
-                i
+/// Read the units of init.conf.
+///
+/// A `[name]` section declares a unit with `exec=`, `args=`, `after=`,
+/// `wants=` and `ready=` lines; `include=<dir>` declares one unit per
+/// service config in `dir` (the svc format). A line starting with `/` is
+/// an old-style command: it runs after the previous waited-on command, and
+/// is itself waited on (`ready=exit`) unless it ends in `&`.
+fn load_units() -> Vec<Unit> {
+    let mut units = Vec::new();
+    let text = match fs::read_to_string(INIT_CONF) {
+        Ok(t) => t,
+        Err(_) => {
+            println!("init: {} not found, skipping", INIT_CONF);
+            return units;
+        }
+    };
+
+    let mut section: Option<Unit> = None;
+    let mut prev_fg: Option<String> = None;
+    for line in text.split('\n') {
+        let line = line.trim();
+        if line.is_empty() || line.starts_with('#') {
+            continue;
+        }
+        if line.starts_with('[') && line.ends_with(']') {
+            if let Some(u) = section.take() { push_unit(&mut units, u); }
+            section = Some(Unit::new(line[1..line.len() - 1].trim()));
+        } else if line.starts_with('/') {
+            if let Some(u) = section.take() { push_unit(&mut units, u); }
+            let (cmd, background) = match line.strip_suffix('&') {
+                Some(c) => (c.trim_end(), true),
+                None => (line, false),
             };
-            let line = &data[line_start..line_end];
-            line_start = i + 1;
+            let (exec, args) = cmd.split_once(' ').unwrap_or((cmd, ""));
+            let base = exec.rsplit('/').next().unwrap_or(exec);
+            let mut name = String::from(base);
+            let mut n = 2;
+            while units.iter().any(|u| u.name == name) {
+                name = format!("{}-{}", base, n);
+                n += 1;
+            }
+            let mut unit = Unit::new(&name);
+            unit.exec = String::from(exec);
+            unit.args = String::from(args.trim());
+            unit.wants.extend(prev_fg.take());
+            if background {
+                prev_fg = unit.wants.first().cloned();
+            } else {
+                unit.ready = Ready::Exit;
+                prev_fg = Some(name);
+            }
+            push_unit(&mut units, unit);
+        } else if let Some(dir) = line.strip_prefix("include=") {
+            if let Some(u) = section.take() { push_unit(&mut units, u); }
+            load_unit_dir(dir.trim(), &mut units);
+        } else if let Some((key, value)) = line.split_once('=') {
+            match section.as_mut() {
+                Some(u) => u.set(key.trim(), value.trim()),
+                None => println!("init: ignoring '{}'", line),
+            }
+        }
+    }
+    if let Some(u) = section.take() { push_unit(&mut units, u); }
+
+    // Unknown dependencies would keep a unit waiting forever
+    let names: Vec<String> = units.iter().map(|u| u.name.clone()).collect();
+    for u in units.iter_mut() {
+        for dep in u.after.iter().chain(u.wants.iter()) {
+            if !names.contains(dep) {
+                println!("init: {}: unknown unit '{}' ignored", u.name, dep);
+            }
+        }
+        u.after.retain(|d| names.contains(d));
+        u.wants.retain(|d| names.contains(d));
+    }
+    units
+}
 
-            // Skip empty lines and comments
-            if line.is_empty() || line[0] == b'#' {
-                continue;
+/// Declare one unit per service config file in `dir`.
+fn load_unit_dir(dir: &str, units: &mut Vec<Unit>) {
+    let entries = match fs::read_dir(dir) {
+        Ok(e) => e,
+        Err(_) => {
+            println!("init: cannot read {}", dir);
+            return;
+        }
+    };
+    for entry in entries {
+        if !entry.is_file() || entry.name.starts_with('.') {
+            continue;
+        }
+        let Ok(text) = fs::read_to_string(&format!("{}/{}", dir, entry.name)) else { continue };
+        let mut unit = Unit::new(&entry.name);
+        for line in text.split('\n') {
+            if let Some((key, value)) = line.trim().split_once('=') {
+                unit.set(key.trim(), value.trim());
             }
+        }
+        push_unit(units, unit);
+    }
+}
+
+// ─── Boot Timeline ──────────────────────────────────────────────────────────
+
+struct Mark {
+    ms: u32,
+    stamp: String,
+    source: String,
+    what: String,
+}
+
+/// Milestones of this boot, in milliseconds since power-on.
+struct Timeline {
+    marks: Vec<Mark>,
+    login_seen: bool,
+}
+
+impl Timeline {
+    fn mark_at(&mut self, ms: u32, source: &str, what: String) {
+        println!("init: +{} ms {}: {}", ms, source, what);
+        self.marks.push(Mark { ms, stamp: wall_clock(), source: String::from(source), what });
+    }
+
+    fn mark(&mut self, source: &str, what: String) {
+        self.mark_at(sys::uptime_ms(), source, what);
+    }
+
+    /// Write the timeline in logd's line format, with level `BOOT`.
+    fn write(&mut self) {
+        self.marks.sort_by_key(|m| m.ms);
+        let mut out = String::new();
+        for m in &self.marks {
+            out.push_str(&format!("{} BOOT  {}: +{} ms {}\n", m.stamp, m.source, m.ms, m.what));
+        }
+        if fs::write_bytes(BOOT_LOG, out.as_bytes()).is_err() {
+            println!("init: cannot write {}", BOOT_LOG);
+        }
+    }
+}
+
+/// Wall-clock time as `[YYYY-MM-DD HH:MM:SS]`.
+fn wall_clock() -> String {
+    let mut t = [0u8; 8];
+    sys::time(&mut t);
+    let year = t[0] as u32 | ((t[1] as u32) << 8);
+    format!("[{:04}-{:02}-{:02} {:02}:{:02}:{:02}]", year, t[2], t[3], t[4], t[5], t[6])
+}
+
+/// Name of thread `tid`, for readiness signals from threads init did not start.
+fn thread_name(tid: u32) -> String {
+    let mut snap = sys::ThreadSnapshot::new();
+    if snap.refresh() {
+        if let Some(t) = snap.threads().iter().find(|t| t.tid == tid) {
+            return String::from(t.name_str());
+        }
+    }
+    format!("tid {}", tid)
+}
+
+// ─── Scheduling ─────────────────────────────────────────────────────────────
+
+enum Deps {
+    Met,
+    Pending,
+    Failed(usize),
+}
+
+fn deps_of(units: &[Unit], i: usize) -> Deps {
+    let find = |name: &String| units.iter().position(|u| u.name == *name).unwrap();
+    for dep in units[i].after.iter().map(find) {
+        match units[dep].state {
+            State::Ready => {}
+            State::Failed => return Deps::Failed(dep),
+            _ => return Deps::Pending,
+        }
+    }
+    if units[i].wants.iter().map(find).all(|d| units[d].settled()) {
+        Deps::Met
+    } else {
+        Deps::Pending
+    }
+}
+
+fn start_unit(u: &mut Unit, tl: &mut Timeline) {
+    // The full command line is passed as args (argv[0] = program name);
+    // process::args() strips argv[0] on the receiving side
+    let cmd = if u.args.is_empty() { u.exec.clone() } else { format!("{} {}", u.exec, u.args) };
+    let tid = process::spawn(&u.exec, &cmd);
+    if tid == u32::MAX || tid == 0 {
+        u.state = State::Failed;
+        tl.mark(&u.name, format!("FAILED to spawn {}", u.exec));
+        return;
+    }
+    u.tid = tid;
+    u.started_ms = sys::uptime_ms();
+    u.state = if u.ready == Ready::Spawn { State::Ready } else { State::Running };
+    tl.mark(&u.name, format!("started (TID {})", tid));
+}
 
-            // Trim leading whitespace
-            let trimmed = trim_bytes(line);
-            if trimmed.is_empty() {
+/// Start every unit whose dependencies allow it, repeating until nothing
+/// changes (`ready=spawn` units satisfy their dependents immediately).
+fn start_ready_units(units: &mut [Unit], tl: &mut Timeline) {
+    let mut progress = true;
+    while progress {
+        progress = false;
+        for i in 0..units.len() {
+            if units[i].state != State::Waiting {
                 continue;
             }
+            match deps_of(units, i) {
+                Deps::Pending => continue,
+                Deps::Met => start_unit(&mut units[i], tl),
+                Deps::Failed(dep) => {
+                    units[i].state = State::Failed;
+                    let what = format!("not started, '{}' failed", units[dep].name);
+                    tl.mark(&units[i].name, what);
+                }
+            }
+            progress = true;
+        }
+    }
+}
 
-            if let Ok(entry) = core::str::from_utf8(trimmed) {
-                // Suffix '&' means background (don't wait)
-                let (cmd, background) = if entry.ends_with('&') {
-                    (entry[..entry.len() - 1].trim_end(), true)
-                } else {
-                    (entry, false)
-                };
-                // Split path from arguments at first space
-                let path = match cmd.find(' ') {
-                    Some(idx) => &cmd[..idx],
-                    None => cmd,
-                };
-                // Pass the full command line as args (argv[0] = program name)
-                // process::args() strips argv[0] on the receiving side
-                println!("init: spawning '{}'{}", cmd, if background { " [bg]" } else { "" });
-                let tid = process::spawn(path, cmd);
-                if tid == u32::MAX {
-                    println!("init: FAILED to spawn '{}'", path);
-                } else if !background {
-                    let code = process::waitpid(tid);
-                    println!("init: '{}' exited (code={})", path, code);
+/// Settle running units that exited or timed out.
+fn poll_running(units: &mut [Unit], tl: &mut Timeline) {
+    let now = sys::uptime_ms();
+    for u in units.iter_mut().filter(|u| u.state == State::Running) {
+        let code = process::try_waitpid(u.tid);
+        if code != process::STILL_RUNNING {
+            if u.ready == Ready::Exit && code == 0 {
+                u.state = State::Ready;
+                tl.mark(&u.name, String::from("finished"));
+            } else {
+                u.state = State::Failed;
+                tl.mark(&u.name, format!("exited before ready (code={})", code));
+            }
+        } else if u.ready == Ready::Notify && now.wrapping_sub(u.started_ms) >= NOTIFY_TIMEOUT_MS {
+            u.state = State::Ready;
+            tl.mark(&u.name, format!("no readiness signal after {} ms, continuing", NOTIFY_TIMEOUT_MS));
+        }
+    }
+}
+
+/// Wait up to `timeout_ms` for readiness signals and apply them.
+fn wait_signals(chan: u32, sub: u32, timeout_ms: u32, units: &mut [Unit], tl: &mut Timeline) {
+    if ipc::evt_chan_wait(chan, sub, timeout_ms) == 0 {
+        return;
+    }
+    let mut evt = [0u32; 5];
+    while ipc::evt_chan_poll(chan, sub, &mut evt) {
+        if evt[0] != ipc::EVT_SERVICE_READY {
+            continue;
+        }
+        let (tid, ms) = (evt[1], evt[2]);
+        match units.iter_mut().find(|u| u.tid == tid) {
+            Some(u) => {
+                if u.state == State::Running {
+                    u.state = State::Ready;
                 }
+                tl.mark_at(ms, &u.name, String::from("ready"));
+            }
+            None => {
+                let name = thread_name(tid);
+                tl.login_seen |= name == LOGIN_NAME;
+                tl.mark_at(ms, &name, String::from("ready"));
             }
         }
     }
 }
 
-fn trim_bytes(b: &[u8]) -> &[u8] {
-    let mut start = 0;
-    while start < b.len() && (b[start] == b' ' || b[start] == b'\t') {
-        start += 1;
+/// Start all units of init.conf, each as soon as its dependencies allow,
+/// then record the boot timeline.
+fn run_units(chan: u32, sub: u32, tl: &mut Timeline) {
+    let mut units = load_units();
+    loop {
+        start_ready_units(&mut units, tl);
+        if !units.iter().any(|u| u.state == State::Running) {
+            break;
+        }
+        wait_signals(chan, sub, POLL_MS, &mut units, tl);
+        poll_running(&mut units, tl);
     }
-    let mut end = b.len();
-    while end > start && (b[end - 1] == b' ' || b[end - 1] == b'\t') {
-        end -= 1;
+    // Whatever still waits is part of a dependency cycle
+    for u in units.iter_mut().filter(|u| u.state == State::Waiting) {
+        u.state = State::Failed;
+        tl.mark(&u.name, String::from("not started, dependency cycle"));
+    }
+    let failed = units.iter().filter(|u| u.state == State::Failed).count();
+    tl.mark("init", format!("{} units up, {} failed", units.len() - failed, failed));
+
+    let deadline = sys::uptime_ms().wrapping_add(LOGIN_TIMEOUT_MS);
+    while !tl.login_seen && (deadline.wrapping_sub(sys::uptime_ms()) as i32) > 0 {
+        wait_signals(chan, sub, deadline.wrapping_sub(sys::uptime_ms()), &mut units, tl);
     }
-    &b[start..end]
 }
 
 // ─── Formatting ─────────────────────────────────────────────────────────────
@@ -180,6 +487,12 @@ fn fmt_u32(buf: &mut [u8], val: u32) -> usize {
 // ─── Main ────────────────────────────────────────────────────────────────────
 
 fn main() {
+    // Subscribe before anything else so no readiness signal is missed
+    let chan = ipc::evt_chan_create(ipc::INIT_CHANNEL);
+    let sub = ipc::evt_chan_subscribe(chan, ipc::EVT_SERVICE_READY);
+    let mut tl = Timeline { marks: Vec::new(), login_seen: false };
+    let now = sys::uptime_ms();
+    tl.mark_at(now.saturating_sub(sys::sysinfo(7, &mut [])), "kernel", String::from("init spawned"));
 
     let hz = sys::tick_hz();
 
@@ -232,9 +545,12 @@ fn main() {
 
     // ── Signal boot ready ──
     sys::boot_ready();
+    tl.mark("init", String::from("benchmarks done"));
 
-    // ── Phase 3: Run init config ──
-    run_init_conf();
+    // ── Phase 3: Start units ──
+    run_units(chan, sub, &mut tl);
+    tl.write();
+    ipc::evt_chan_unsubscribe(chan, sub);
 }
 
 
@@ -200,6 +200,9 @@ fn main() -> u32 {
         }
     });
 
+    // Ends the boot timeline recorded by init
+    anyos_std::ipc::notify_ready();
+
     // Blocks until quit() is called
     ui::run();
 
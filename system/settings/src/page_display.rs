@@ -640,7 +640,20 @@ fn load_thumbnail(
         return Vec::new();
     }
 
-    let info = match libimage_client::probe(&file_buf[..bytes_read]) {
+    let data = &file_buf[..bytes_read];
+    let full = match libimage_client::probe(data) {
+        Some(i) => i,
+        None => return Vec::new(),
+    };
+
+    // JPEG wallpapers are shrunk while decoding, down to no less than the
+    // thumbnail size.  Other formats would need a full-size copy in scratch.
+    let shift = if full.format == libimage_client::FMT_JPEG {
+        libimage_client::scale_shift_for(full.width, full.height, THUMB_W, THUMB_H)
+    } else {
+        0
+    };
+    let info = match libimage_client::probe_scaled(data, shift) {
         Some(i) => i,
         None => return Vec::new(),
     };
@@ -662,8 +675,9 @@ fn load_thumbnail(
         *p = 0;
     }
 
-    if libimage_client::decode(
-        &file_buf[..bytes_read],
+    if libimage_client::decode_scaled(
+        data,
+        shift,
         &mut pixel_buf[..pixel_count],
         &mut scratch_buf[..scratch_needed],
     )
@@ -713,13 +727,16 @@ fn set_wallpaper_ipc(path: &str) {
         *dst.add(path_len as usize) = 0;
     }
 
+    // The compositor claims the region and frees it
+    if ipc::shm_grant(shm_id) != 0 {
+        ipc::shm_unmap(shm_id);
+        ipc::shm_destroy(shm_id);
+        return;
+    }
+
     const CMD_SET_WALLPAPER: u32 = 0x100F;
     let cmd: [u32; 5] = [CMD_SET_WALLPAPER, shm_id, 0, 0, 0];
     ipc::evt_chan_emit(ui::get_compositor_channel(), &cmd);
-
-    process::sleep(32);
-    ipc::shm_unmap(shm_id);
-    ipc::shm_destroy(shm_id);
 }
 
 // ── Wallpaper preference persistence ────────────────────────────────────────
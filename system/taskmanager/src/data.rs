@@ -1,64 +1,54 @@
 use alloc::vec::Vec;
+use anyos_std::debug;
 use anyos_std::sys;
 use crate::types::*;
 
-pub fn fetch_tasks(buf: &mut [u8; THREAD_ENTRY_SIZE * 64], prev: &mut PrevTicks, total_sched_ticks: u32, result: &mut Vec<TaskEntry>) {
+/// Refresh `snap` and rebuild `result` from it: one scheduler pass, with
+/// per-thread CPU ticks since the previous refresh filled in by the kernel.
+pub fn fetch_tasks(snap: &mut sys::ThreadSnapshot, result: &mut Vec<TaskEntry>) {
     result.clear();
-    let count = sys::sysinfo(1, buf);
-    if count == u32::MAX { return; }
-
-    let dt = total_sched_ticks.wrapping_sub(prev.prev_total);
-
-    for i in 0..count as usize {
-        let off = i * THREAD_ENTRY_SIZE;
-        if off + THREAD_ENTRY_SIZE > buf.len() { break; }
-        let tid = u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]]);
-        let prio = buf[off + 4];
-        let state = buf[off + 5];
-        let arch = buf[off + 6];
-        let mut name = [0u8; 24];
-        name.copy_from_slice(&buf[off + 8..off + 32]);
-        let name_len = name.iter().position(|&b| b == 0).unwrap_or(24);
-        let user_pages = u32::from_le_bytes([buf[off + 32], buf[off + 33], buf[off + 34], buf[off + 35]]);
-        let cpu_ticks = u32::from_le_bytes([buf[off + 36], buf[off + 37], buf[off + 38], buf[off + 39]]);
-        let io_read_bytes = u64::from_le_bytes([
-            buf[off + 40], buf[off + 41], buf[off + 42], buf[off + 43],
-            buf[off + 44], buf[off + 45], buf[off + 46], buf[off + 47],
-        ]);
-        let io_write_bytes = u64::from_le_bytes([
-            buf[off + 48], buf[off + 49], buf[off + 50], buf[off + 51],
-            buf[off + 52], buf[off + 53], buf[off + 54], buf[off + 55],
-        ]);
+    if !snap.refresh() { return; }
 
-        let prev_ticks = prev.entries[..prev.count]
-            .iter()
-            .find(|e| e.0 == tid)
-            .map(|e| e.1)
-            .unwrap_or(cpu_ticks);
-
-        let d_ticks = cpu_ticks.wrapping_sub(prev_ticks);
-        let cpu_pct_x10 = if dt > 0 && d_ticks > 0 {
-            (d_ticks as u64 * 1000 / dt as u64).min(1000) as u32
+    let dt = snap.ticks_delta();
+    for t in snap.threads() {
+        let cpu_pct_x10 = if dt > 0 && t.tick_delta > 0 {
+            (t.tick_delta as u64 * 1000 / dt as u64).min(1000) as u32
+        } else {
+            0
+        };
+        let name_len = t.name.iter().position(|&b| b == 0).unwrap_or(t.name.len());
+        // External fragmentation: 1 - largest_free / free
+        let free = t.heap_free;
+        let heap_frag_x10 = if free > 0 {
+            ((free - t.heap_largest_free.min(free)) as u64 * 1000 / free as u64) as u32
         } else {
             0
         };
 
-        let uid = u16::from_le_bytes([buf[off + 56], buf[off + 57]]);
-
-        result.push(TaskEntry { tid, name, name_len, state, priority: prio, arch, uid, user_pages, cpu_pct_x10, io_read_bytes, io_write_bytes });
+        result.push(TaskEntry {
+            tid: t.tid, name: t.name, name_len, state: t.state, priority: t.priority,
+            arch: t.arch_mode, uid: t.uid, user_pages: t.user_pages, cpu_pct_x10,
+            io_read_bytes: t.io_read_bytes, io_write_bytes: t.io_write_bytes,
+            heap_in_use: t.heap_in_use, heap_frag_x10,
+            resident_pages: 0, swapped_pages: 0,
+        });
     }
+    fetch_proc_mem(result);
+}
 
-    prev.count = 0;
-    for i in 0..count as usize {
-        if prev.count >= MAX_TASKS { break; }
-        let off = i * THREAD_ENTRY_SIZE;
-        if off + THREAD_ENTRY_SIZE > buf.len() { break; }
-        let tid = u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]]);
-        let cpu_ticks = u32::from_le_bytes([buf[off + 36], buf[off + 37], buf[off + 38], buf[off + 39]]);
-        prev.entries[prev.count] = (tid, cpu_ticks);
-        prev.count += 1;
+/// Fill in resident/swapped pages per process (`sysinfo` cmd 10).
+fn fetch_proc_mem(result: &mut Vec<TaskEntry>) {
+    let mut buf = [0u8; 12 * 128];
+    let count = sys::sysinfo(10, &mut buf);
+    if count == u32::MAX { return; }
+    let rd = |off: usize| u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]]);
+    for i in 0..(count as usize).min(128) {
+        let tid = rd(i * 12);
+        if let Some(t) = result.iter_mut().find(|t| t.tid == tid) {
+            t.resident_pages = rd(i * 12 + 4);
+            t.swapped_pages = rd(i * 12 + 8);
+        }
     }
-    prev.prev_total = total_sched_ticks;
 }
 
 pub fn fetch_memory() -> Option<MemInfo> {
@@ -72,6 +62,24 @@ pub fn fetch_memory() -> Option<MemInfo> {
     })
 }
 
+pub fn fetch_swap() -> Option<SwapInfo> {
+    let mut buf = [0u8; 64];
+    if sys::sysinfo(9, &mut buf) != 0 { return None; }
+    let rd = |i: usize| u32::from_le_bytes([buf[i * 4], buf[i * 4 + 1], buf[i * 4 + 2], buf[i * 4 + 3]]);
+    Some(SwapInfo {
+        cache_active: rd(0),
+        cache_inactive: rd(1),
+        cache_reclaimed: rd(2),
+        image_reclaimed: rd(3),
+        zram_pages: rd(6),
+        zram_frames: rd(7),
+        disk_used: rd(10),
+        disk_pages: rd(11),
+        swap_outs: rd(12),
+        swap_ins: rd(13),
+    })
+}
+
 pub fn fetch_cpu(state: &mut CpuState) {
     let mut buf = [0u8; 16 + 8 * MAX_CPUS];
     sys::sysinfo(3, &mut buf);
@@ -109,6 +117,20 @@ pub fn fetch_cpu(state: &mut CpuState) {
     }
 }
 
+pub fn fetch_migrations() -> MigrationInfo {
+    let mut buf = [0u8; 16 + 8 * MAX_CPUS];
+    let mut info = MigrationInfo { steals: 0, hot_skips: 0, rebalances: 0 };
+    if sys::sysinfo(5, &mut buf) != 0 { return info; }
+    let rd = |off: usize| u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]]);
+    let ncpu = (rd(0) as usize).min(MAX_CPUS);
+    info.hot_skips = rd(4);
+    info.rebalances = rd(8);
+    for i in 0..ncpu {
+        info.steals = info.steals.wrapping_add(rd(16 + i * 8));
+    }
+    info
+}
+
 pub fn fetch_hwinfo() -> HwInfo {
     let mut buf = [0u8; 108];
     sys::sysinfo(4, &mut buf);
@@ -131,3 +153,27 @@ pub fn fetch_hwinfo() -> HwInfo {
         power_features: u32::from_le_bytes([buf[104], buf[105], buf[106], buf[107]]),
     }
 }
+
+/// Cycles to microseconds.
+pub fn cycles_to_us(cycles: u64, hz: u64) -> u64 {
+    if hz == 0 { return 0; }
+    (cycles as u128 * 1_000_000 / hz as u128) as u64
+}
+
+/// Upper bound (cycles) of the histogram bucket holding the 99th
+/// percentile call.
+pub fn p99_cycles(stat: &debug::SyscallStat) -> u64 {
+    let target = (stat.calls * 99 + 99) / 100;
+    let mut seen = 0u64;
+    for (i, &n) in stat.hist.iter().enumerate() {
+        seen += n as u64;
+        if seen >= target { return 1u64 << (i + 1); }
+    }
+    1u64 << stat.hist.len()
+}
+
+/// Calls since the previous sample of `key` (all calls if it is new).
+pub fn calls_delta(prev: &[(u32, u64)], key: u32, calls: u64) -> u64 {
+    let before = prev.iter().find(|e| e.0 == key).map(|e| e.1).unwrap_or(0);
+    calls.saturating_sub(before)
+}
@@ -6,6 +6,14 @@ pub fn fmt_u32<'a>(buf: &'a mut [u8; 12], val: u32) -> &'a str {
     unsafe { core::str::from_utf8_unchecked(&buf[..n]) }
 }
 
+pub fn fmt_u64<'a>(buf: &'a mut [u8; 20], val: u64) -> &'a str {
+    if val == 0 { buf[0] = b'0'; return unsafe { core::str::from_utf8_unchecked(&buf[..1]) }; }
+    let mut v = val; let mut tmp = [0u8; 20]; let mut n = 0;
+    while v > 0 { tmp[n] = b'0' + (v % 10) as u8; v /= 10; n += 1; }
+    for i in 0..n { buf[i] = tmp[n - 1 - i]; }
+    unsafe { core::str::from_utf8_unchecked(&buf[..n]) }
+}
+
 pub fn fmt_pct<'a>(buf: &'a mut [u8; 12], pct_x10: u32) -> &'a str {
     let whole = pct_x10 / 10;
     let frac = pct_x10 % 10;
@@ -9,6 +9,7 @@ mod graph;
 
 use alloc::vec::Vec;
 
+use anyos_std::debug;
 use anyos_std::sys;
 use anyos_std::process;
 
@@ -25,8 +26,7 @@ use graph::*;
 
 // ─── Global mutable state (accessed from timer + button callbacks) ───────────
 
-static mut THREAD_BUF: [u8; THREAD_ENTRY_SIZE * 64] = [0u8; THREAD_ENTRY_SIZE * 64];
-static mut PREV_TICKS: Option<*mut PrevTicks> = None;
+static mut THREAD_SNAP: Option<*mut sys::ThreadSnapshot> = None;
 static mut CPU_STATE: Option<*mut CpuState> = None;
 static mut CPU_HISTORY: Option<*mut CpuHistory> = None;
 static mut ICON_CACHE: Option<*mut Vec<IconEntry>> = None;
@@ -36,6 +36,7 @@ static mut PREV_PROC_COUNT: usize = 0;
 static mut PREV_TASK_TIDS: Option<*mut Vec<u32>> = None;
 static mut PREV_TASK_STATES: Option<*mut Vec<u8>> = None;
 static mut PREV_DISK_COUNT: usize = 0;
+static mut PREV_SYSCALLS: Option<*mut PrevSyscalls> = None;
 
 // Reusable buffers (avoid per-tick heap allocations)
 static mut TASKS_BUF: Option<*mut Vec<TaskEntry>> = None;
@@ -66,9 +67,9 @@ fn main() {
     header.add(&header_top);
 
     // Centered segmented control (manually positioned)
-    let seg = ui::SegmentedControl::new("Processes|Graphs|Disk|System");
-    seg.set_size(380, 24);
-    seg.set_position((580 - 380) / 2, 4);
+    let seg = ui::SegmentedControl::new("Processes|Graphs|Disk|System|Syscalls");
+    seg.set_size(460, 24);
+    seg.set_position((580 - 460) / 2, 4);
     header_top.add(&seg);
 
     // Memory info row (DOCK_TOP, 20px): mem_label left, uptime right
@@ -166,6 +167,10 @@ fn main() {
         ColumnDef::new("CPU%").width(55).align(ALIGN_RIGHT).numeric(),
         ColumnDef::new("Memory").width(65).align(ALIGN_RIGHT).numeric(),
         ColumnDef::new("Priority").width(50).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Heap").width(70).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Frag").width(50).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("RSS").width(65).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Swap").width(65).align(ALIGN_RIGHT).numeric(),
     ]);
     proc_grid.set_row_height(20);
     panel_procs.add(&proc_grid);
@@ -242,7 +247,7 @@ fn main() {
 
     // -- Processor card --
     let cpu_card = ui::Card::new();
-    cpu_card.set_size(560, 110);
+    cpu_card.set_size(560, 128);
     cpu_card.set_margin(0, 0, 0, 8);
     cpu_card.set_padding(12, 8, 12, 8);
     sys_stack.add(&cpu_card);
@@ -274,9 +279,13 @@ fn main() {
     cpu_speed_label.set_size(536, 18);
     cpu_card_stack.add(&cpu_speed_label);
 
+    let cpu_migr_label = ui::Label::new("");
+    cpu_migr_label.set_size(536, 18);
+    cpu_card_stack.add(&cpu_migr_label);
+
     // -- Memory card --
     let mem_card = ui::Card::new();
-    mem_card.set_size(560, 72);
+    mem_card.set_size(560, 108);
     mem_card.set_margin(0, 0, 0, 8);
     mem_card.set_padding(12, 8, 12, 8);
     sys_stack.add(&mem_card);
@@ -300,6 +309,14 @@ fn main() {
     mem_free_label.set_size(536, 18);
     mem_card_stack.add(&mem_free_label);
 
+    let mem_swap_label = ui::Label::new("");
+    mem_swap_label.set_size(536, 18);
+    mem_card_stack.add(&mem_swap_label);
+
+    let mem_reclaim_label = ui::Label::new("");
+    mem_reclaim_label.set_size(536, 18);
+    mem_card_stack.add(&mem_reclaim_label);
+
     // -- System card --
     let sys_card = ui::Card::new();
     sys_card.set_size(560, 72);
@@ -348,13 +365,67 @@ fn main() {
     disp_res_label.set_margin(0, 2, 0, 0);
     disp_card_stack.add(&disp_res_label);
 
+    // ── Panel: Syscalls (DOCK_FILL, initially hidden) ──
+    let panel_sys = ui::View::new();
+    panel_sys.set_dock(ui::DOCK_FILL);
+    panel_sys.set_visible(false);
+    win.add(&panel_sys);
+
+    // Syscall toolbar (DOCK_TOP, 32px)
+    let sys_toolbar = ui::View::new();
+    sys_toolbar.set_size(0, 32);
+    sys_toolbar.set_dock(ui::DOCK_TOP);
+    panel_sys.add(&sys_toolbar);
+
+    let rec_btn = ui::Button::new("Start Recording");
+    rec_btn.set_position(8, 4);
+    rec_btn.set_size(120, 24);
+    sys_toolbar.add(&rec_btn);
+
+    let reset_btn = ui::Button::new("Reset");
+    reset_btn.set_position(136, 4);
+    reset_btn.set_size(70, 24);
+    sys_toolbar.add(&reset_btn);
+
+    let sys_info_label = ui::Label::new("");
+    sys_info_label.set_position(216, 6);
+    sys_info_label.set_size(350, 20);
+    sys_toolbar.add(&sys_info_label);
+
+    // Per-process totals (DOCK_BOTTOM) below the per-syscall table (DOCK_FILL)
+    let sys_proc_grid = ui::DataGrid::new(400, 120);
+    sys_proc_grid.set_size(0, 120);
+    sys_proc_grid.set_dock(ui::DOCK_BOTTOM);
+    sys_proc_grid.set_font_size(11);
+    sys_proc_grid.set_columns(&[
+        ColumnDef::new("TID").width(45).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Process").width(150),
+        ColumnDef::new("Calls").width(90).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Calls/s").width(80).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Time (ms)").width(90).align(ALIGN_RIGHT).numeric(),
+    ]);
+    sys_proc_grid.set_row_height(20);
+    panel_sys.add(&sys_proc_grid);
+
+    let syscall_grid = ui::DataGrid::new(400, 200);
+    syscall_grid.set_dock(ui::DOCK_FILL);
+    syscall_grid.set_font_size(11);
+    syscall_grid.set_columns(&[
+        ColumnDef::new("Syscall").width(140),
+        ColumnDef::new("Calls").width(80).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Calls/s").width(70).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Time (ms)").width(80).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("Avg (us)").width(75).align(ALIGN_RIGHT).numeric(),
+        ColumnDef::new("p99 (us)").width(75).align(ALIGN_RIGHT).numeric(),
+    ]);
+    syscall_grid.set_row_height(20);
+    panel_sys.add(&syscall_grid);
+
     // ── Connect segmented control to panels ──
-    seg.connect_panels(&[&panel_procs, &panel_graphs, &panel_disk, &panel_system]);
+    seg.connect_panels(&[&panel_procs, &panel_graphs, &panel_disk, &panel_system, &panel_sys]);
 
     // ── Allocate state on heap (accessed from callbacks) ──
-    let prev_ticks = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(
-        PrevTicks { entries: [(0, 0); MAX_TASKS], count: 0, prev_total: 0 }
-    ));
+    let thread_snap = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(sys::ThreadSnapshot::new()));
     let cpu_state = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(CpuState::new()));
     let cpu_history = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(CpuHistory::new()));
     let icon_cache = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(Vec::<IconEntry>::new()));
@@ -363,9 +434,12 @@ fn main() {
     let prev_task_states = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(Vec::<u8>::new()));
     let tasks_buf = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(Vec::<TaskEntry>::new()));
     let colors_buf = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(Vec::<u32>::new()));
+    let prev_syscalls = alloc::boxed::Box::into_raw(alloc::boxed::Box::new(
+        PrevSyscalls { syscalls: Vec::new(), threads: Vec::new() }
+    ));
 
     unsafe {
-        PREV_TICKS = Some(prev_ticks);
+        THREAD_SNAP = Some(thread_snap);
         CPU_STATE = Some(cpu_state);
         CPU_HISTORY = Some(cpu_history);
         ICON_CACHE = Some(icon_cache);
@@ -373,6 +447,7 @@ fn main() {
         PREV_TASK_STATES = Some(prev_task_states);
         TASKS_BUF = Some(tasks_buf);
         COLORS_BUF = Some(colors_buf);
+        PREV_SYSCALLS = Some(prev_syscalls);
     }
 
     // Initial CPU fetch
@@ -453,15 +528,29 @@ fn main() {
         }
     });
 
+    // ── Syscall recording controls ──
+    rec_btn.on_click(move |_| {
+        let on = debug::syscall_stats(0, 0).enabled;
+        let flags = if on { debug::SYSCALL_STATS_DISABLE } else { debug::SYSCALL_STATS_ENABLE };
+        debug::syscall_stats(flags, 0);
+        rec_btn.set_text(if on { "Start Recording" } else { "Stop Recording" });
+    });
+
+    reset_btn.on_click(move |_| {
+        debug::syscall_stats(debug::SYSCALL_STATS_RESET, 0);
+        let prev = unsafe { &mut *PREV_SYSCALLS.unwrap() };
+        prev.syscalls.clear();
+        prev.threads.clear();
+    });
+
     // ── Timer: refresh every 1s ──
     // All controls are Copy — captured directly by value.
     ui::set_timer(1000, move || {
         let tc = ui::theme::colors();
         let cpu_st = unsafe { &mut *CPU_STATE.unwrap() };
         let hist = unsafe { &mut *CPU_HISTORY.unwrap() };
-        let prev = unsafe { &mut *PREV_TICKS.unwrap() };
+        let snap = unsafe { &mut *THREAD_SNAP.unwrap() };
         let cache = unsafe { &mut *ICON_CACHE.unwrap() };
-        let tbuf = unsafe { &mut THREAD_BUF };
         let prev_tids = unsafe { &mut *PREV_TASK_TIDS.unwrap() };
         let prev_states = unsafe { &mut *PREV_TASK_STATES.unwrap() };
         let tasks = unsafe { &mut *TASKS_BUF.unwrap() };
@@ -473,10 +562,11 @@ fn main() {
 
         let active_tab = seg.get_state();
 
-        // Task data: only needed for Processes (tab 0) and Disk (tab 2) tabs.
+        // Task data: only needed for Processes (tab 0), Disk (tab 2) and
+        // Syscalls (tab 4, for names).
         // Skipping fetch_tasks() on Graphs/System tabs saves ~0.5ms per tick.
-        if active_tab == 0 || active_tab == 2 {
-            fetch_tasks(tbuf, prev, cpu_st.total_sched_ticks, tasks);
+        if active_tab == 0 || active_tab == 2 || active_tab == 4 {
+            fetch_tasks(snap, tasks);
         }
 
         // ── Update uptime label ──
@@ -541,8 +631,8 @@ fn main() {
         {
             let mut t = [0u8; 12];
 
-            // Task count (from tasks buf — updated on tabs 0/2, retained otherwise)
-            if active_tab == 0 || active_tab == 2 {
+            // Task count (from tasks buf — updated on tabs 0/2/4, retained otherwise)
+            if active_tab == 0 || active_tab == 2 || active_tab == 4 {
                 let mut tbuf2 = [0u8; 24];
                 let mut p = 0;
                 let s = fmt_u32(&mut t, tasks.len() as u32); tbuf2[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
@@ -602,7 +692,7 @@ fn main() {
             }
 
             let mut colors_dirty = false;
-            let col_count = 8usize;
+            let col_count = 12usize;
             let needed = new_count * col_count;
             colors.clear();
             colors.resize(needed, 0u32);
@@ -674,6 +764,24 @@ fn main() {
                     let s = fmt_mem_pages(&mut mbuf, task.user_pages);
                     proc_grid.set_cell(ri as u32, 6, s);
                 }
+                if task.heap_in_use > 0 {
+                    let mut hbuf = [0u8; 20];
+                    proc_grid.set_cell(ri as u32, 8, fmt_bytes(&mut hbuf, task.heap_in_use as u64));
+                    let mut fbuf = [0u8; 12];
+                    proc_grid.set_cell(ri as u32, 9, fmt_pct(&mut fbuf, task.heap_frag_x10));
+                } else {
+                    proc_grid.set_cell(ri as u32, 8, "-");
+                    proc_grid.set_cell(ri as u32, 9, "-");
+                }
+                if task.resident_pages > 0 || task.swapped_pages > 0 {
+                    let mut rbuf = [0u8; 16];
+                    proc_grid.set_cell(ri as u32, 10, fmt_mem_pages(&mut rbuf, task.resident_pages));
+                    let mut sbuf = [0u8; 16];
+                    proc_grid.set_cell(ri as u32, 11, fmt_mem_pages(&mut sbuf, task.swapped_pages));
+                } else {
+                    proc_grid.set_cell(ri as u32, 10, "-");
+                    proc_grid.set_cell(ri as u32, 11, "-");
+                }
 
                 // Build colors row
                 let state_color = match task.state {
@@ -836,6 +944,18 @@ fn main() {
                     buf[p] = b')'; p += 1;
                 }
                 if let Ok(s) = core::str::from_utf8(&buf[..p]) { cpu_speed_label.set_text(s); }
+
+                let mi = fetch_migrations();
+                let mut buf = [0u8; 80];
+                let mut p = 0;
+                buf[p..p + 8].copy_from_slice(b"Moves:  "); p += 8;
+                let s = fmt_u32(&mut t, mi.steals); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                buf[p..p + 9].copy_from_slice(b" stolen, "); p += 9;
+                let s = fmt_u32(&mut t, mi.rebalances); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                buf[p..p + 13].copy_from_slice(b" rebalanced, "); p += 13;
+                let s = fmt_u32(&mut t, mi.hot_skips); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                buf[p..p + 10].copy_from_slice(b" kept warm"); p += 10;
+                if let Ok(s) = core::str::from_utf8(&buf[..p]) { cpu_migr_label.set_text(s); }
             }
 
             // Memory card
@@ -853,6 +973,36 @@ fn main() {
                 let s = fmt_u32(&mut t, hw.free_mem_mib); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
                 buf[p..p + 4].copy_from_slice(b" MiB"); p += 4;
                 if let Ok(s) = core::str::from_utf8(&buf[..p]) { mem_free_label.set_text(s); }
+
+                if let Some(sw) = fetch_swap() {
+                    let mut buf = [0u8; 96];
+                    let mut p = 0;
+                    buf[p..p + 8].copy_from_slice(b"Swap:   "); p += 8;
+                    let s = fmt_u32(&mut t, sw.zram_pages / 256); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 8].copy_from_slice(b" MiB in "); p += 8;
+                    let s = fmt_u32(&mut t, sw.zram_frames / 256); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 11].copy_from_slice(b" MiB, disk "); p += 11;
+                    let s = fmt_u32(&mut t, sw.disk_used / 256); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p] = b'/'; p += 1;
+                    let s = fmt_u32(&mut t, sw.disk_pages / 256); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 4].copy_from_slice(b" MiB"); p += 4;
+                    if let Ok(s) = core::str::from_utf8(&buf[..p]) { mem_swap_label.set_text(s); }
+
+                    let mut buf = [0u8; 120];
+                    let mut p = 0;
+                    buf[p..p + 8].copy_from_slice(b"Cache:  "); p += 8;
+                    let s = fmt_u32(&mut t, sw.cache_active); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 9].copy_from_slice(b" active, "); p += 9;
+                    let s = fmt_u32(&mut t, sw.cache_inactive); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 11].copy_from_slice(b" inactive, "); p += 11;
+                    let s = fmt_u32(&mut t, sw.cache_reclaimed + sw.image_reclaimed); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 12].copy_from_slice(b" reclaimed; "); p += 12;
+                    let s = fmt_u32(&mut t, sw.swap_outs); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 6].copy_from_slice(b" out, "); p += 6;
+                    let s = fmt_u32(&mut t, sw.swap_ins); buf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                    buf[p..p + 3].copy_from_slice(b" in"); p += 3;
+                    if let Ok(s) = core::str::from_utf8(&buf[..p]) { mem_reclaim_label.set_text(s); }
+                }
             }
 
             // System card
@@ -895,6 +1045,74 @@ fn main() {
                 if let Ok(s) = core::str::from_utf8(&buf[..p]) { disp_res_label.set_text(s); }
             }
         }
+
+        // ── Update syscalls tab ──
+        if active_tab == 4 {
+            let stats = debug::syscall_stats(0, 0);
+            let prev = unsafe { &mut *PREV_SYSCALLS.unwrap() };
+            let hz = stats.cycle_hz;
+            rec_btn.set_text(if stats.enabled { "Stop Recording" } else { "Start Recording" });
+
+            let mut rows: Vec<&debug::SyscallStat> = stats.syscalls.iter().collect();
+            rows.sort_unstable_by(|a, b| b.cycles.cmp(&a.cycles));
+            let total_calls: u64 = rows.iter().map(|s| s.calls).sum();
+            {
+                let mut t = [0u8; 20];
+                let mut ibuf = [0u8; 64];
+                let mut p = 0;
+                let head: &[u8] = if stats.enabled { b"Recording: " } else { b"Stopped: " };
+                ibuf[p..p + head.len()].copy_from_slice(head); p += head.len();
+                let s = fmt_u64(&mut t, total_calls); ibuf[p..p + s.len()].copy_from_slice(s.as_bytes()); p += s.len();
+                ibuf[p..p + 6].copy_from_slice(b" calls"); p += 6;
+                if let Ok(s) = core::str::from_utf8(&ibuf[..p]) {
+                    sys_info_label.set_text(s);
+                }
+            }
+
+            syscall_grid.set_row_count(rows.len() as u32);
+            for (ri, s) in rows.iter().enumerate() {
+                let ri = ri as u32;
+                let mut t = [0u8; 20];
+                let name = s.name_str();
+                if name == "unknown" {
+                    let mut nb = [0u8; 16];
+                    let mut t12 = [0u8; 12];
+                    nb[0] = b'#';
+                    let n = fmt_u32(&mut t12, s.num);
+                    nb[1..1 + n.len()].copy_from_slice(n.as_bytes());
+                    syscall_grid.set_cell(ri, 0, core::str::from_utf8(&nb[..1 + n.len()]).unwrap_or("?"));
+                } else {
+                    syscall_grid.set_cell(ri, 0, name);
+                }
+                syscall_grid.set_cell(ri, 1, fmt_u64(&mut t, s.calls));
+                syscall_grid.set_cell(ri, 2, fmt_u64(&mut t, calls_delta(&prev.syscalls, s.num, s.calls)));
+                syscall_grid.set_cell(ri, 3, fmt_u64(&mut t, cycles_to_us(s.cycles, hz) / 1000));
+                syscall_grid.set_cell(ri, 4, fmt_u64(&mut t, cycles_to_us(s.cycles / s.calls.max(1), hz)));
+                syscall_grid.set_cell(ri, 5, fmt_u64(&mut t, cycles_to_us(p99_cycles(s), hz)));
+            }
+
+            let mut threads: Vec<&debug::SyscallThreadStat> = stats.threads.iter().collect();
+            threads.sort_unstable_by(|a, b| b.calls.cmp(&a.calls));
+            sys_proc_grid.set_row_count(threads.len() as u32);
+            for (ri, th) in threads.iter().enumerate() {
+                let ri = ri as u32;
+                let mut t = [0u8; 20];
+                let mut t12 = [0u8; 12];
+                sys_proc_grid.set_cell(ri, 0, fmt_u32(&mut t12, th.tid));
+                let name = tasks.iter().find(|e| e.tid == th.tid)
+                    .and_then(|e| core::str::from_utf8(&e.name[..e.name_len]).ok())
+                    .unwrap_or("(exited)");
+                sys_proc_grid.set_cell(ri, 1, name);
+                sys_proc_grid.set_cell(ri, 2, fmt_u64(&mut t, th.calls));
+                sys_proc_grid.set_cell(ri, 3, fmt_u64(&mut t, calls_delta(&prev.threads, th.tid, th.calls)));
+                sys_proc_grid.set_cell(ri, 4, fmt_u64(&mut t, cycles_to_us(th.cycles, hz) / 1000));
+            }
+
+            prev.syscalls.clear();
+            prev.syscalls.extend(stats.syscalls.iter().map(|s| (s.num, s.calls)));
+            prev.threads.clear();
+            prev.threads.extend(stats.threads.iter().map(|t| (t.tid, t.calls)));
+        }
     });
 
     ui::run();
@@ -1,14 +1,12 @@
 use alloc::vec::Vec;
 
 pub const MAX_CPUS: usize = 16;
-pub const MAX_TASKS: usize = 64;
-pub const THREAD_ENTRY_SIZE: usize = 60;
 pub const ICON_SIZE: u32 = 16;
 pub const GRAPH_SAMPLES: usize = 60;
 
 pub struct TaskEntry {
     pub tid: u32,
-    pub name: [u8; 24],
+    pub name: [u8; 32],
     pub name_len: usize,
     pub state: u8,
     pub priority: u8,
@@ -18,12 +16,21 @@ pub struct TaskEntry {
     pub cpu_pct_x10: u32,
     pub io_read_bytes: u64,
     pub io_write_bytes: u64,
+    /// Heap bytes in use as reported by the process allocator (0 = no report).
+    pub heap_in_use: u32,
+    /// External heap fragmentation: 1 - largest_free / free, in 0.1%.
+    pub heap_frag_x10: u32,
+    /// Resident / swapped-out pages of the process, sampled by the kernel
+    /// reclaim thread (both 0 for threads that share another's memory).
+    pub resident_pages: u32,
+    pub swapped_pages: u32,
 }
 
-pub struct PrevTicks {
-    pub entries: [(u32, u32); MAX_TASKS],
-    pub count: usize,
-    pub prev_total: u32,
+/// Call counts from the previous syscall-stats sample, keyed by syscall
+/// number (`syscalls`) and TID (`threads`), for calls/s.
+pub struct PrevSyscalls {
+    pub syscalls: Vec<(u32, u64)>,
+    pub threads: Vec<(u32, u64)>,
 }
 
 pub struct MemInfo {
@@ -33,6 +40,22 @@ pub struct MemInfo {
     pub heap_total: u32,
 }
 
+/// Page reclaim and swap counters (`sysinfo` cmd 9).
+pub struct SwapInfo {
+    pub cache_active: u32,
+    pub cache_inactive: u32,
+    pub cache_reclaimed: u32,
+    pub image_reclaimed: u32,
+    /// Pages stored in RAM (compressed or same-filled).
+    pub zram_pages: u32,
+    /// Frames holding them.
+    pub zram_frames: u32,
+    pub disk_used: u32,
+    pub disk_pages: u32,
+    pub swap_outs: u32,
+    pub swap_ins: u32,
+}
+
 pub struct HwInfo {
     pub brand: [u8; 48],
     pub vendor: [u8; 16],
@@ -49,6 +72,15 @@ pub struct HwInfo {
     pub power_features: u32,
 }
 
+pub struct MigrationInfo {
+    /// Threads moved by idle-time work stealing (sum over CPUs).
+    pub steals: u32,
+    /// Steal attempts refused because candidates were cache-hot.
+    pub hot_skips: u32,
+    /// Affinity moves by the periodic rebalancer.
+    pub rebalances: u32,
+}
+
 pub struct CpuState {
     pub num_cpus: u32,
     pub total_sched_ticks: u32,
@@ -64,7 +64,7 @@ const MOD_CTRL: u32 = 2;
 
 #[derive(Clone, Copy)]
 struct CellPos {
-    row: usize, // absolute line index in TerminalBuffer.lines[]
+    row: usize, // absolute line index in TerminalBuffer.lines
     col: usize, // column index within that line
 }
 
@@ -116,13 +116,13 @@ fn extract_selected_text(buf: &TerminalBuffer, sel: &Selection) -> String {
         if row >= buf.lines.len() {
             break;
         }
-        let line = &buf.lines[row];
+        let line = buf.lines.line(row);
         let c0 = if row == start.row { start.col } else { 0 };
         let c1 = if row == end.row { end.col + 1 } else { line.len() };
         let c1 = c1.min(line.len());
         let mut line_text = String::new();
         for col in c0..c1 {
-            line_text.push(line[col].0);
+            line_text.push(cell_char(line[col]));
         }
         // Trim trailing spaces
         while line_text.ends_with(' ') {
@@ -189,19 +189,19 @@ fn parse_redirects(line: &str) -> (String, Option<Redirect>) {
 
 /// Write data to a redirect target file.
 /// On first call with `>` mode, the file is truncated; subsequent calls append.
-fn write_redirect(redirect: &mut Redirect, data: &str) {
+fn write_redirect(redirect: &mut Redirect, data: &[u8]) {
     if redirect.target == "/dev/null" {
         return; // discard
     }
 
     if redirect.append {
         // Append: read existing content, concat, write back
-        let existing = fs::read_to_string(&redirect.target).unwrap_or_default();
-        let combined = format!("{}{}", existing, data);
-        let _ = fs::write_bytes(&redirect.target, combined.as_bytes());
+        let mut combined = fs::read_to_string(&redirect.target).unwrap_or_default().into_bytes();
+        combined.extend_from_slice(data);
+        let _ = fs::write_bytes(&redirect.target, &combined);
     } else {
         // Truncate: write new content (first chunk only)
-        let _ = fs::write_bytes(&redirect.target, data.as_bytes());
+        let _ = fs::write_bytes(&redirect.target, data);
         // Switch to append for subsequent chunks
         redirect.append = true;
     }
@@ -522,48 +522,460 @@ fn expand_tildes_vec(tokens: Vec<String>) -> Vec<String> {
     result
 }
 
+// ─── Packed Cells ────────────────────────────────────────────────────────────
+
+// A cell is a u32: bits 0..21 hold the codepoint, bits 24..32 an index into
+// TerminalBuffer.palette. Bits 21..24 are only used by the screen cache to
+// flag selected and cursor cells.
+const CELL_CHAR_MASK: u32 = 0x001F_FFFF;
+const CELL_ATTR_SHIFT: u32 = 24;
+const CELL_SELECTED: u32 = 1 << 21;
+const CELL_CURSOR: u32 = 1 << 22;
+const CELL_STYLE_MASK: u32 = !CELL_CHAR_MASK;
+
+// Fixed palette slots
+const ATTR_FG: u8 = 0;
+const ATTR_BG: u8 = 1;
+const MAX_ATTRS: usize = 256;
+
+/// Blank cell used to pad lines and to represent cleared screen area.
+const CELL_BLANK: u32 = pack_cell(' ', ATTR_BG);
+
+const fn pack_cell(ch: char, attr: u8) -> u32 {
+    ((attr as u32) << CELL_ATTR_SHIFT) | (ch as u32 & CELL_CHAR_MASK)
+}
+
+fn cell_char(cell: u32) -> char {
+    char::from_u32(cell & CELL_CHAR_MASK).unwrap_or(' ')
+}
+
+fn cell_attr(cell: u32) -> usize {
+    ((cell >> CELL_ATTR_SHIFT) & 0xFF) as usize
+}
+
+// ─── Scrollback Ring ─────────────────────────────────────────────────────────
+
+/// Fixed-capacity ring of lines. Every line owns a `stride`-wide slot in one
+/// flat cell array, so appending a line never allocates and dropping the
+/// oldest line is a head increment.
+struct Scrollback {
+    cells: Vec<u32>,
+    lens: Vec<u16>,
+    stride: usize,
+    capacity: usize,
+    head: usize,  // slot of the oldest line
+    count: usize, // number of lines in use
+}
+
+impl Scrollback {
+    fn new(capacity: usize, stride: usize) -> Self {
+        let stride = stride.max(1);
+        Scrollback {
+            cells: alloc::vec![CELL_BLANK; capacity * stride],
+            lens: alloc::vec![0; capacity],
+            stride,
+            capacity,
+            head: 0,
+            count: 1,
+        }
+    }
+
+    fn len(&self) -> usize {
+        self.count
+    }
+
+    fn slot(&self, row: usize) -> usize {
+        (self.head + row) % self.capacity
+    }
+
+    fn line(&self, row: usize) -> &[u32] {
+        let s = self.slot(row);
+        let base = s * self.stride;
+        &self.cells[base..base + self.lens[s] as usize]
+    }
+
+    fn line_len(&self, row: usize) -> usize {
+        self.lens[self.slot(row)] as usize
+    }
+
+    /// Append an empty line. Returns true if the oldest line was dropped to
+    /// make room (all row indices shift down by one).
+    fn push_line(&mut self) -> bool {
+        if self.count < self.capacity {
+            let s = self.slot(self.count);
+            self.lens[s] = 0;
+            self.count += 1;
+            false
+        } else {
+            self.lens[self.head] = 0;
+            self.head = (self.head + 1) % self.capacity;
+            true
+        }
+    }
+
+    /// Store a cell, padding the line with blanks up to `col`.
+    fn put(&mut self, row: usize, col: usize, cell: u32) {
+        if col >= self.stride {
+            return;
+        }
+        let s = self.slot(row);
+        let base = s * self.stride;
+        let len = self.lens[s] as usize;
+        if col > len {
+            self.cells[base + len..base + col].fill(CELL_BLANK);
+        }
+        self.cells[base + col] = cell;
+        if col >= len {
+            self.lens[s] = (col + 1) as u16;
+        }
+    }
+
+    /// Store a run of printable ASCII bytes starting at `col`.
+    fn put_ascii(&mut self, row: usize, col: usize, bytes: &[u8], attr: u8) {
+        if col >= self.stride {
+            return;
+        }
+        let n = bytes.len().min(self.stride - col);
+        let s = self.slot(row);
+        let base = s * self.stride;
+        let len = self.lens[s] as usize;
+        if col > len {
+            self.cells[base + len..base + col].fill(CELL_BLANK);
+        }
+        let hi = (attr as u32) << CELL_ATTR_SHIFT;
+        for (dst, &b) in self.cells[base + col..base + col + n].iter_mut().zip(bytes) {
+            *dst = hi | b as u32;
+        }
+        if col + n > len {
+            self.lens[s] = (col + n) as u16;
+        }
+    }
+
+    /// Insert a cell at `col`, shifting the rest right (the last cell falls
+    /// off a full line).
+    fn insert(&mut self, row: usize, col: usize, cell: u32) {
+        let len = self.line_len(row);
+        if col >= len {
+            self.put(row, col, cell);
+            return;
+        }
+        let s = self.slot(row);
+        let base = s * self.stride;
+        let end = (len + 1).min(self.stride);
+        self.cells.copy_within(base + col..base + end - 1, base + col + 1);
+        self.cells[base + col] = cell;
+        self.lens[s] = end as u16;
+    }
+
+    fn remove(&mut self, row: usize, col: usize) {
+        let s = self.slot(row);
+        let base = s * self.stride;
+        let len = self.lens[s] as usize;
+        if col < len {
+            self.cells.copy_within(base + col + 1..base + len, base + col);
+            self.lens[s] = (len - 1) as u16;
+        }
+    }
+
+    fn truncate(&mut self, row: usize, len: usize) {
+        let s = self.slot(row);
+        if (self.lens[s] as usize) > len {
+            self.lens[s] = len as u16;
+        }
+    }
+
+    /// Blank the cells in `from..to` that lie within the line.
+    fn blank(&mut self, row: usize, from: usize, to: usize) {
+        let s = self.slot(row);
+        let base = s * self.stride;
+        let to = to.min(self.lens[s] as usize);
+        if from < to {
+            self.cells[base + from..base + to].fill(CELL_BLANK);
+        }
+    }
+
+    fn copy_line(&mut self, src: usize, dst: usize) {
+        let (ss, ds) = (self.slot(src), self.slot(dst));
+        if ss == ds {
+            return;
+        }
+        let len = self.lens[ss] as usize;
+        self.cells.copy_within(ss * self.stride..ss * self.stride + len, ds * self.stride);
+        self.lens[ds] = len as u16;
+    }
+
+    fn clear(&mut self) {
+        self.head = 0;
+        self.count = 1;
+        self.lens[0] = 0;
+    }
+
+    /// Grow the per-line slot width. Lines keep their content; the ring is
+    /// re-laid out with the oldest line in slot 0.
+    fn set_width(&mut self, cols: usize) {
+        if cols <= self.stride {
+            return;
+        }
+        let mut cells = alloc::vec![CELL_BLANK; self.capacity * cols];
+        let mut lens = alloc::vec![0u16; self.capacity];
+        for row in 0..self.count {
+            let line = self.line(row);
+            cells[row * cols..row * cols + line.len()].copy_from_slice(line);
+            lens[row] = line.len() as u16;
+        }
+        self.cells = cells;
+        self.lens = lens;
+        self.stride = cols;
+        self.head = 0;
+    }
+}
+
 // ─── Terminal Buffer ─────────────────────────────────────────────────────────
 
+/// A pending vertical shift of screen rows `top..bottom` by `delta` rows
+/// (positive = content moves up). Replayed on the window surface as a pixel
+/// copy by the next render.
+#[derive(Clone, Copy)]
+struct ScrollOp {
+    top: usize,
+    bottom: usize,
+    delta: isize,
+}
+
+// More pending shifts than this in one frame fall back to a full repaint.
+const MAX_SCROLL_OPS: usize = 16;
+
 struct TerminalBuffer {
-    lines: Vec<Vec<(char, u32)>>, // (character, color)
+    lines: Scrollback,
+    palette: Vec<u32>, // attribute index -> ARGB foreground
     cols: usize,
     visible_rows: usize,
     cursor_row: usize,
     cursor_col: usize,
     scroll_offset: usize,
     current_color: u32,
+    attr_color: u32, // color last resolved by current_attr()
+    attr_idx: u8,
     // ANSI escape sequence parser state
     ansi_state: u8,          // 0=Normal, 1=Escape (\x1B seen), 2=CSI ([ seen)
     ansi_params: [u8; 16],
     ansi_param_len: usize,
     ansi_bold: bool,
+    // UTF-8 decoder state for write_bytes
+    utf8_acc: u32,
+    utf8_need: u8,
+    // Scroll region (DECSTBM) in screen rows, bottom exclusive
+    region_top: usize,
+    region_bottom: usize,
+    // Damage since the last render: absolute line range, surface shifts, or everything
+    dirty_lo: usize,
+    dirty_hi: usize,
+    scroll_ops: Vec<ScrollOp>,
+    full_redraw: bool,
     // Capture mode: when set, write_char appends to this instead of terminal lines
     capture: Option<String>,
 }
 
 impl TerminalBuffer {
     fn new(cols: usize, rows: usize) -> Self {
-        let mut lines = Vec::new();
-        lines.push(Vec::new());
+        let mut palette = Vec::new();
+        palette.push(COLOR_FG);
+        palette.push(COLOR_BG);
         TerminalBuffer {
-            lines,
+            lines: Scrollback::new(MAX_SCROLLBACK, cols),
+            palette,
             cols,
             visible_rows: rows,
             cursor_row: 0,
             cursor_col: 0,
             scroll_offset: 0,
             current_color: COLOR_FG,
+            attr_color: COLOR_FG,
+            attr_idx: ATTR_FG,
             ansi_state: 0,
             ansi_params: [0; 16],
             ansi_param_len: 0,
             ansi_bold: false,
+            utf8_acc: 0,
+            utf8_need: 0,
+            region_top: 0,
+            region_bottom: rows,
+            dirty_lo: 0,
+            dirty_hi: 0,
+            scroll_ops: Vec::new(),
+            full_redraw: true,
             capture: None,
         }
     }
 
-    fn ensure_line(&mut self, row: usize) {
+    /// Palette index for `current_color`, interning it on first use.
+    fn current_attr(&mut self) -> u8 {
+        if self.current_color != self.attr_color {
+            let color = self.current_color;
+            self.attr_idx = match self.palette.iter().position(|&c| c == color) {
+                Some(i) => i as u8,
+                None if self.palette.len() < MAX_ATTRS => {
+                    self.palette.push(color);
+                    (self.palette.len() - 1) as u8
+                }
+                None => ATTR_FG,
+            };
+            self.attr_color = color;
+        }
+        self.attr_idx
+    }
+
+    fn mark_dirty(&mut self, row: usize) {
+        if self.dirty_lo >= self.dirty_hi {
+            self.dirty_lo = row;
+            self.dirty_hi = row + 1;
+        } else {
+            self.dirty_lo = self.dirty_lo.min(row);
+            self.dirty_hi = self.dirty_hi.max(row + 1);
+        }
+    }
+
+    fn is_dirty(&self, row: usize) -> bool {
+        row >= self.dirty_lo && row < self.dirty_hi
+    }
+
+    fn clear_damage(&mut self) {
+        self.dirty_lo = 0;
+        self.dirty_hi = 0;
+        self.scroll_ops.clear();
+        self.full_redraw = false;
+    }
+
+    /// Record that screen rows `top..bottom` moved by `delta` rows.
+    fn push_scroll_op(&mut self, top: usize, bottom: usize, delta: isize) {
+        if self.full_redraw || delta == 0 || top >= bottom {
+            return;
+        }
+        if let Some(last) = self.scroll_ops.last_mut() {
+            if last.top == top && last.bottom == bottom {
+                last.delta += delta;
+                if last.delta == 0 {
+                    self.scroll_ops.pop();
+                }
+                return;
+            }
+        }
+        if self.scroll_ops.len() >= MAX_SCROLL_OPS {
+            self.scroll_ops.clear();
+            self.full_redraw = true;
+            return;
+        }
+        self.scroll_ops.push(ScrollOp { top, bottom, delta });
+    }
+
+    fn set_scroll_offset(&mut self, offset: usize) {
+        let delta = offset as isize - self.scroll_offset as isize;
+        self.push_scroll_op(0, self.visible_rows, delta);
+        self.scroll_offset = offset;
+    }
+
+    /// Make sure line `row` exists, returning its index after any lines were
+    /// dropped from the front of the ring.
+    fn ensure_line(&mut self, mut row: usize) -> usize {
         while self.lines.len() <= row {
-            self.lines.push(Vec::new());
+            if self.lines.push_line() {
+                row -= 1;
+                self.line_dropped();
+            }
+        }
+        row
+    }
+
+    /// The oldest line fell off the ring: shift every absolute row index.
+    fn line_dropped(&mut self) {
+        self.cursor_row = self.cursor_row.saturating_sub(1);
+        if self.scroll_offset == 0 {
+            self.full_redraw = true;
+        }
+        self.scroll_offset = self.scroll_offset.saturating_sub(1);
+        self.dirty_lo = self.dirty_lo.saturating_sub(1);
+        self.dirty_hi = self.dirty_hi.saturating_sub(1);
+    }
+
+    /// Keep the cursor row on screen by scrolling the view.
+    fn follow_cursor(&mut self) {
+        if self.cursor_row >= self.scroll_offset + self.visible_rows {
+            self.set_scroll_offset(self.cursor_row + 1 - self.visible_rows);
+        }
+    }
+
+    fn has_region(&self) -> bool {
+        self.region_top > 0 || self.region_bottom < self.visible_rows
+    }
+
+    fn reset_region(&mut self) {
+        self.region_top = 0;
+        self.region_bottom = self.visible_rows;
+    }
+
+    /// Scroll screen rows `top..bottom` by `n` lines (positive = up). Line
+    /// contents move inside the buffer; the surface is shifted by the same
+    /// amount at render time instead of being repainted.
+    fn scroll_region(&mut self, top: usize, bottom: usize, n: isize) {
+        let bottom = bottom.min(self.visible_rows);
+        if top >= bottom || n == 0 {
+            return;
+        }
+        let h = bottom - top;
+        let k = (n.unsigned_abs()).min(h);
+        self.ensure_line(self.scroll_offset + bottom - 1);
+        let base = self.scroll_offset + top;
+        if n > 0 {
+            for r in 0..h - k {
+                self.lines.copy_line(base + r + k, base + r);
+            }
+            for r in h - k..h {
+                self.lines.truncate(base + r, 0);
+            }
+        } else {
+            for r in (k..h).rev() {
+                self.lines.copy_line(base + r - k, base + r);
+            }
+            for r in 0..k {
+                self.lines.truncate(base + r, 0);
+            }
+        }
+        // Pending damage inside the region moved with the lines
+        if self.dirty_lo < self.dirty_hi && self.dirty_lo < base + h && self.dirty_hi > base {
+            self.mark_dirty(base);
+            self.mark_dirty(base + h - 1);
+        }
+        let delta = if n > 0 { k as isize } else { -(k as isize) };
+        self.push_scroll_op(top, bottom, delta);
+    }
+
+    /// Line feed: move down one row, scrolling the region when the cursor
+    /// sits on its bottom margin.
+    fn line_feed(&mut self) {
+        if self.has_region() {
+            let screen_row = self.cursor_row.saturating_sub(self.scroll_offset);
+            if screen_row + 1 == self.region_bottom {
+                self.scroll_region(self.region_top, self.region_bottom, 1);
+                return;
+            }
+            if screen_row + 1 < self.visible_rows {
+                self.cursor_row += 1;
+                self.cursor_row = self.ensure_line(self.cursor_row);
+            }
+            return;
+        }
+        self.cursor_row += 1;
+        self.cursor_row = self.ensure_line(self.cursor_row);
+        self.follow_cursor();
+    }
+
+    /// Reverse line feed (ESC M): move up, scrolling down at the top margin.
+    fn reverse_line_feed(&mut self) {
+        let screen_row = self.cursor_row.saturating_sub(self.scroll_offset);
+        if screen_row == self.region_top {
+            self.scroll_region(self.region_top, self.region_bottom, -1);
+        } else {
+            self.cursor_row = self.cursor_row.saturating_sub(1);
         }
     }
 
@@ -598,11 +1010,14 @@ impl TerminalBuffer {
         // ANSI escape sequence state machine
         match self.ansi_state {
             1 => {
-                // Saw \x1B, expecting '['
+                // Saw \x1B, expecting '[' (or 'M' for reverse index)
                 if ch == '[' {
                     self.ansi_state = 2;
                     self.ansi_param_len = 0;
                 } else {
+                    if ch == 'M' {
+                        self.reverse_line_feed();
+                    }
                     self.ansi_state = 0; // not a CSI sequence, discard
                 }
                 return;
@@ -631,37 +1046,21 @@ impl TerminalBuffer {
                 self.ansi_state = 1;
             }
             '\n' => {
-                self.cursor_row += 1;
+                self.line_feed();
                 self.cursor_col = 0;
-                self.ensure_line(self.cursor_row);
-                if self.cursor_row >= self.scroll_offset + self.visible_rows {
-                    self.scroll_offset = self.cursor_row - self.visible_rows + 1;
-                }
-                if self.lines.len() > MAX_SCROLLBACK {
-                    let excess = self.lines.len() - MAX_SCROLLBACK;
-                    self.lines.drain(0..excess);
-                    self.cursor_row = self.cursor_row.saturating_sub(excess);
-                    self.scroll_offset = self.scroll_offset.saturating_sub(excess);
-                }
             }
             '\r' => {
                 self.cursor_col = 0;
             }
             _ => {
-                self.ensure_line(self.cursor_row);
-                let line = &mut self.lines[self.cursor_row];
-                while line.len() <= self.cursor_col {
-                    line.push((' ', COLOR_BG));
-                }
-                line[self.cursor_col] = (ch, self.current_color);
+                self.cursor_row = self.ensure_line(self.cursor_row);
+                let attr = self.current_attr();
+                self.lines.put(self.cursor_row, self.cursor_col, pack_cell(ch, attr));
+                self.mark_dirty(self.cursor_row);
                 self.cursor_col += 1;
                 if self.cursor_col >= self.cols {
                     self.cursor_col = 0;
-                    self.cursor_row += 1;
-                    self.ensure_line(self.cursor_row);
-                    if self.cursor_row >= self.scroll_offset + self.visible_rows {
-                        self.scroll_offset = self.cursor_row - self.visible_rows + 1;
-                    }
+                    self.line_feed();
                 }
             }
         }
@@ -695,43 +1094,37 @@ impl TerminalBuffer {
                 let mode = if num_count > 0 { nums[0] } else { 0 };
                 if mode == 2 || mode == 3 {
                     // Clear entire screen
-                    self.lines.clear();
-                    self.lines.push(Vec::new());
-                    self.cursor_row = 0;
-                    self.cursor_col = 0;
-                    self.scroll_offset = 0;
+                    self.clear();
                 }
             }
             'H' | 'f' => {
                 // Cursor position (1-based, default 1;1)
                 let row = if num_count > 0 && nums[0] > 0 { nums[0] as usize - 1 } else { 0 };
                 let col = if num_count > 1 && nums[1] > 0 { nums[1] as usize - 1 } else { 0 };
-                self.cursor_row = self.scroll_offset + row;
+                self.cursor_row = self.ensure_line(self.scroll_offset + row);
                 self.cursor_col = col.min(self.cols.saturating_sub(1));
-                self.ensure_line(self.cursor_row);
             }
             'K' => {
                 // Erase in line
                 let mode = if num_count > 0 { nums[0] } else { 0 };
-                self.ensure_line(self.cursor_row);
-                let line = &mut self.lines[self.cursor_row];
+                self.cursor_row = self.ensure_line(self.cursor_row);
+                let row = self.cursor_row;
                 match mode {
                     0 => {
                         // Erase from cursor to end of line
-                        line.truncate(self.cursor_col);
+                        self.lines.truncate(row, self.cursor_col);
                     }
                     1 => {
                         // Erase from start to cursor
-                        for i in 0..=self.cursor_col.min(line.len().saturating_sub(1)) {
-                            if i < line.len() { line[i] = (' ', COLOR_BG); }
-                        }
+                        self.lines.blank(row, 0, self.cursor_col + 1);
                     }
                     2 => {
                         // Erase entire line
-                        line.clear();
+                        self.lines.truncate(row, 0);
                     }
                     _ => {}
                 }
+                self.mark_dirty(row);
             }
             'A' => {
                 // Cursor up
@@ -741,8 +1134,7 @@ impl TerminalBuffer {
             'B' => {
                 // Cursor down
                 let n = if num_count > 0 && nums[0] > 0 { nums[0] as usize } else { 1 };
-                self.cursor_row += n;
-                self.ensure_line(self.cursor_row);
+                self.cursor_row = self.ensure_line(self.cursor_row + n);
             }
             'C' => {
                 // Cursor forward
@@ -754,6 +1146,35 @@ impl TerminalBuffer {
                 let n = if num_count > 0 && nums[0] > 0 { nums[0] as usize } else { 1 };
                 self.cursor_col = self.cursor_col.saturating_sub(n);
             }
+            'r' => {
+                // Set scroll region (1-based top;bottom, default full screen)
+                let top = if num_count > 0 && nums[0] > 0 { nums[0] as usize - 1 } else { 0 };
+                let bottom = if num_count > 1 && nums[1] > 0 { nums[1] as usize } else { self.visible_rows };
+                let bottom = bottom.min(self.visible_rows);
+                if top + 1 < bottom {
+                    self.region_top = top;
+                    self.region_bottom = bottom;
+                } else {
+                    self.reset_region();
+                }
+                self.cursor_row = self.ensure_line(self.scroll_offset);
+                self.cursor_col = 0;
+            }
+            'S' | 'T' => {
+                // Scroll region up / down
+                let n = if num_count > 0 && nums[0] > 0 { nums[0] as isize } else { 1 };
+                let n = if cmd == 'S' { n } else { -n };
+                self.scroll_region(self.region_top, self.region_bottom, n);
+            }
+            'L' | 'M' => {
+                // Insert / delete lines at the cursor row within the region
+                let screen_row = self.cursor_row.saturating_sub(self.scroll_offset);
+                if screen_row >= self.region_top && screen_row < self.region_bottom {
+                    let n = if num_count > 0 && nums[0] > 0 { nums[0] as isize } else { 1 };
+                    let n = if cmd == 'M' { n } else { -n };
+                    self.scroll_region(screen_row, self.region_bottom, n);
+                }
+            }
             'm' => {
                 // SGR (Select Graphic Rendition) — foreground color/style codes
                 // Standard 8-color + bright 8-color palette (Dracula-inspired)
@@ -810,33 +1231,129 @@ impl TerminalBuffer {
         }
     }
 
+    /// Feed raw child output. UTF-8 sequences may be split across calls;
+    /// runs of printable ASCII outside escape sequences bypass the per-char
+    /// state machine and are stored a line segment at a time.
+    fn write_bytes(&mut self, data: &[u8]) {
+        let mut i = 0;
+        while i < data.len() {
+            let b = data[i];
+            if self.utf8_need > 0 {
+                if b & 0xC0 == 0x80 {
+                    self.utf8_acc = (self.utf8_acc << 6) | (b & 0x3F) as u32;
+                    self.utf8_need -= 1;
+                    if self.utf8_need == 0 {
+                        self.write_char(char::from_u32(self.utf8_acc).unwrap_or('?'));
+                    }
+                    i += 1;
+                    continue;
+                }
+                // Truncated sequence: emit a placeholder, then handle b normally
+                self.utf8_need = 0;
+                self.write_char('?');
+            }
+            if b >= 0x20 && b < 0x7F && self.ansi_state == 0 && self.capture.is_none() {
+                let start = i;
+                while i < data.len() && data[i] >= 0x20 && data[i] < 0x7F {
+                    i += 1;
+                }
+                self.write_ascii(&data[start..i]);
+                continue;
+            }
+            match b {
+                0x00..=0x7F => self.write_char(b as char),
+                0xC0..=0xDF => { self.utf8_acc = (b & 0x1F) as u32; self.utf8_need = 1; }
+                0xE0..=0xEF => { self.utf8_acc = (b & 0x0F) as u32; self.utf8_need = 2; }
+                0xF0..=0xF7 => { self.utf8_acc = (b & 0x07) as u32; self.utf8_need = 3; }
+                _ => self.write_char('?'),
+            }
+            i += 1;
+        }
+    }
+
+    /// Write printable ASCII at the cursor, wrapping at the right margin.
+    fn write_ascii(&mut self, mut run: &[u8]) {
+        while !run.is_empty() {
+            if self.cursor_col >= self.cols {
+                // Cursor parked past the margin: take the per-char path to wrap
+                self.write_char(run[0] as char);
+                run = &run[1..];
+                continue;
+            }
+            let n = run.len().min(self.cols - self.cursor_col);
+            self.cursor_row = self.ensure_line(self.cursor_row);
+            let attr = self.current_attr();
+            self.lines.put_ascii(self.cursor_row, self.cursor_col, &run[..n], attr);
+            self.mark_dirty(self.cursor_row);
+            self.cursor_col += n;
+            run = &run[n..];
+            if self.cursor_col >= self.cols {
+                self.cursor_col = 0;
+                self.line_feed();
+            }
+        }
+    }
+
     fn backspace(&mut self) {
         if self.cursor_col > 0 {
             self.cursor_col -= 1;
             if self.cursor_row < self.lines.len() {
-                let line = &mut self.lines[self.cursor_row];
-                if self.cursor_col < line.len() {
-                    line.remove(self.cursor_col);
-                }
+                self.lines.remove(self.cursor_row, self.cursor_col);
+                self.mark_dirty(self.cursor_row);
             }
         }
     }
 
+    /// Insert a character at the cursor, shifting the rest of the line right.
+    fn insert_char(&mut self, ch: char) {
+        self.cursor_row = self.ensure_line(self.cursor_row);
+        let attr = self.current_attr();
+        self.lines.insert(self.cursor_row, self.cursor_col, pack_cell(ch, attr));
+        self.mark_dirty(self.cursor_row);
+        self.cursor_col += 1;
+    }
+
+    /// Delete the character under the cursor.
+    fn delete_char(&mut self) {
+        if self.cursor_row < self.lines.len() {
+            self.lines.remove(self.cursor_row, self.cursor_col);
+            self.mark_dirty(self.cursor_row);
+        }
+    }
+
+    /// Cut the cursor line back to `len` cells.
+    fn truncate_line(&mut self, len: usize) {
+        if self.cursor_row < self.lines.len() {
+            self.lines.truncate(self.cursor_row, len);
+            self.mark_dirty(self.cursor_row);
+        }
+    }
+
     fn clear(&mut self) {
         self.lines.clear();
-        self.lines.push(Vec::new());
         self.cursor_row = 0;
         self.cursor_col = 0;
         self.scroll_offset = 0;
+        self.reset_region();
+        self.full_redraw = true;
+    }
+
+    /// Apply a new window size in cells.
+    fn resize(&mut self, cols: usize, rows: usize) {
+        self.cols = cols;
+        self.visible_rows = rows;
+        self.lines.set_width(cols);
+        self.reset_region();
+        self.full_redraw = true;
     }
 
     fn scroll_up(&mut self, lines: usize) {
-        self.scroll_offset = self.scroll_offset.saturating_sub(lines);
+        self.set_scroll_offset(self.scroll_offset.saturating_sub(lines));
     }
 
     fn scroll_down(&mut self, lines: usize) {
         let max_offset = self.lines.len().saturating_sub(self.visible_rows);
-        self.scroll_offset = (self.scroll_offset + lines).min(max_offset);
+        self.set_scroll_offset((self.scroll_offset + lines).min(max_offset));
     }
 }
 
@@ -1211,7 +1728,7 @@ impl Shell {
                 // Disable capture for su (interactive)
                 if let Some(captured) = buf.capture.take() {
                     if let Some(ref mut redir) = redirect {
-                        write_redirect(redir, &captured);
+                        write_redirect(redir, captured.as_bytes());
                     }
                 }
                 let pending = self.cmd_su(args, buf);
@@ -1338,7 +1855,7 @@ impl Shell {
         // Flush capture buffer for builtin commands with redirect
         if let Some(captured) = buf.capture.take() {
             if let Some(ref mut redir) = redirect {
-                write_redirect(redir, &captured);
+                write_redirect(redir, captured.as_bytes());
             }
         }
 
@@ -1857,9 +2374,7 @@ const BUILTINS: &[&str] = &[
 /// Erase the input portion of the current display line and rewrite it.
 fn redraw_input_line(buf: &mut TerminalBuffer, shell: &Shell) {
     let prompt_len = shell.prompt().len();
-    if buf.cursor_row < buf.lines.len() {
-        buf.lines[buf.cursor_row].truncate(prompt_len);
-    }
+    buf.truncate_line(prompt_len);
     buf.cursor_col = prompt_len;
     buf.current_color = COLOR_FG;
     buf.write_str(&shell.input);
@@ -2032,36 +2547,191 @@ fn handle_tab(shell: &mut Shell, buf: &mut TerminalBuffer) {
 
 // ─── Rendering ───────────────────────────────────────────────────────────────
 
-fn render_terminal(win_id: u32, buf: &TerminalBuffer, win_w: u32, win_h: u32, sel: Option<&Selection>) {
-    // Clear background
-    window::fill_rect(win_id, 0, 0, win_w as u16, win_h as u16, COLOR_BG);
+const COLOR_CURSOR: u32 = 0xFFCCCCCC;
 
-    let start_row = buf.scroll_offset;
-    let end_row = (start_row + buf.visible_rows).min(buf.lines.len());
+// Shadow value for screen cells whose pixels are unknown
+const CELL_UNKNOWN: u32 = u32::MAX;
 
-    // Precompute selection range (if any)
-    let sel_range = sel.map(|s| s.ordered());
+/// What is currently on the window surface, one packed cell per screen
+/// position (with selection/cursor flags). Rendering diffs the wanted cells
+/// against it and only draws the runs that changed.
+struct ScreenCache {
+    cells: Vec<u32>,
+    row_valid: Vec<bool>, // false = row must be compared cell by cell
+    cols: usize,
+    rows: usize,
+    cursor_row: Option<usize>,
+    selection: Option<(usize, usize, usize, usize)>,
+    wanted: Vec<u32>,
+    text: String,
+}
 
-    // Build text line by line and draw
-    for (screen_y, line_idx) in (start_row..end_row).enumerate() {
-        let line = &buf.lines[line_idx];
-        let py = TEXT_PAD + (screen_y as u16) * CELL_H;
+impl ScreenCache {
+    fn new() -> Self {
+        ScreenCache {
+            cells: Vec::new(),
+            row_valid: Vec::new(),
+            cols: 0,
+            rows: 0,
+            cursor_row: None,
+            selection: None,
+            wanted: Vec::new(),
+            text: String::new(),
+        }
+    }
 
-        // Group characters by color AND selection state for efficient drawing
-        let mut run_start = 0;
-        let mut run_color = if !line.is_empty() { line[0].1 } else { COLOR_FG };
-        let mut run_selected = false;
-        let mut text_buf = String::new();
+    /// Forget the surface contents after it was cleared to the background.
+    fn reset(&mut self, cols: usize, rows: usize) {
+        self.cols = cols;
+        self.rows = rows;
+        self.cells.clear();
+        self.cells.resize(cols * rows, CELL_BLANK);
+        self.row_valid.clear();
+        self.row_valid.resize(rows, false);
+        self.cursor_row = None;
+    }
 
-        for (col, &(ch, color)) in line.iter().enumerate() {
-            if col >= buf.cols {
-                break;
+    fn invalidate_rows(&mut self, top: usize, bottom: usize) {
+        for r in top..bottom {
+            self.cells[r * self.cols..(r + 1) * self.cols].fill(CELL_UNKNOWN);
+            self.row_valid[r] = false;
+        }
+    }
+
+    /// Replay a buffer scroll on the surface with a pixel copy.
+    fn apply_scroll(&mut self, win_id: u32, op: &ScrollOp) {
+        let bottom = op.bottom.min(self.rows);
+        if op.top >= bottom || self.cols == 0 {
+            return;
+        }
+        let h = bottom - op.top;
+        let n = op.delta.unsigned_abs();
+        if let Some(row) = self.cursor_row {
+            if row >= op.top && row < bottom {
+                let moved = row as isize - op.delta;
+                self.cursor_row = if moved >= op.top as isize && moved < bottom as isize {
+                    Some(moved as usize)
+                } else {
+                    None
+                };
             }
+        }
+        if n >= h {
+            self.invalidate_rows(op.top, bottom);
+            return;
+        }
+        let dy = -op.delta * CELL_H as isize;
+        window::scroll_rect(
+            win_id,
+            TEXT_PAD as i16,
+            (TEXT_PAD as usize + op.top * CELL_H as usize) as i16,
+            (self.cols * CELL_W as usize) as u16,
+            (h * CELL_H as usize) as u16,
+            dy as i16,
+        );
+        let cols = self.cols;
+        if op.delta > 0 {
+            self.cells.copy_within((op.top + n) * cols..bottom * cols, op.top * cols);
+            self.row_valid.copy_within(op.top + n..bottom, op.top);
+            self.invalidate_rows(bottom - n, bottom);
+        } else {
+            self.cells.copy_within(op.top * cols..(bottom - n) * cols, (op.top + n) * cols);
+            self.row_valid.copy_within(op.top..bottom - n, op.top + n);
+            self.invalidate_rows(op.top, op.top + n);
+        }
+    }
+}
+
+/// Draw one run of cells that share a style.
+fn draw_cell_run(win_id: u32, buf: &TerminalBuffer, screen_row: usize, col: usize,
+                 cells: &[u32], text: &mut String) {
+    let style = cells[0] & CELL_STYLE_MASK;
+    let (bg, fg) = if style & CELL_CURSOR != 0 {
+        (COLOR_CURSOR, COLOR_BG)
+    } else if style & CELL_SELECTED != 0 {
+        (COLOR_SELECT_BG, COLOR_SELECT_FG)
+    } else {
+        (COLOR_BG, buf.palette.get(cell_attr(style)).copied().unwrap_or(COLOR_FG))
+    };
+    let px = TEXT_PAD + (col as u16) * CELL_W;
+    let py = TEXT_PAD + (screen_row as u16) * CELL_H;
+    window::fill_rect(win_id, px as i16, py as i16, (cells.len() as u16) * CELL_W, CELL_H, bg);
+
+    text.clear();
+    let mut visible = false;
+    for &cell in cells {
+        let ch = cell_char(cell);
+        // The mono font covers printable ASCII; keep one byte per cell
+        if ch > ' ' && (ch as u32) < 127 {
+            text.push(ch);
+            visible = true;
+        } else if ch == ' ' {
+            text.push(' ');
+        } else {
+            text.push('?');
+            visible = true;
+        }
+    }
+    if visible {
+        window::draw_text_mono(win_id, px as i16, py as i16, fg, text);
+    }
+}
+
+fn render_terminal(win_id: u32, buf: &mut TerminalBuffer, screen: &mut ScreenCache,
+                   win_w: u32, win_h: u32, sel: Option<&Selection>) {
+    let cols = buf.cols;
+    let rows = buf.visible_rows;
+    if buf.full_redraw || screen.cols != cols || screen.rows != rows {
+        window::fill_rect(win_id, 0, 0, win_w as u16, win_h as u16, COLOR_BG);
+        screen.reset(cols, rows);
+    } else {
+        for op in buf.scroll_ops.iter() {
+            screen.apply_scroll(win_id, op);
+        }
+    }
 
-            // Check if this cell is within the selection
+    // Precompute selection range (if any); a changed selection rechecks every row
+    let sel_range = sel.map(|s| s.ordered());
+    let sel_key = sel_range.map(|(s, e)| (s.row, s.col, e.row, e.col));
+    let check_all = sel_key != screen.selection;
+
+    let cursor_screen_row = buf.cursor_row as isize - buf.scroll_offset as isize;
+    let cursor_row = if cursor_screen_row >= 0 && (cursor_screen_row as usize) < rows
+        && buf.cursor_col < cols
+    {
+        Some(cursor_screen_row as usize)
+    } else {
+        None
+    };
+
+    let mut wanted = core::mem::take(&mut screen.wanted);
+    let mut text = core::mem::take(&mut screen.text);
+    wanted.resize(cols, CELL_BLANK);
+
+    for screen_row in 0..rows {
+        let line_idx = buf.scroll_offset + screen_row;
+        if !(check_all
+            || !screen.row_valid[screen_row]
+            || buf.is_dirty(line_idx)
+            || Some(screen_row) == screen.cursor_row
+            || Some(screen_row) == cursor_row)
+        {
+            continue;
+        }
+
+        // Compose the wanted cells for this row
+        let line: &[u32] = if line_idx < buf.lines.len() { buf.lines.line(line_idx) } else { &[] };
+        for col in 0..cols {
+            let mut cell = if col < line.len() { line[col] } else { CELL_BLANK };
+            if cell & CELL_CHAR_MASK == ' ' as u32 {
+                cell = CELL_BLANK;
+            }
             let selected = if let Some((ref s, ref e)) = sel_range {
                 if line_idx > s.row && line_idx < e.row {
+                    // Middle rows highlight the full width, past the line end too
                     true
+                } else if col >= line.len() {
+                    false
                 } else if line_idx == s.row && line_idx == e.row {
                     col >= s.col && col <= e.col
                 } else if line_idx == s.row {
@@ -2074,59 +2744,80 @@ fn render_terminal(win_id: u32, buf: &TerminalBuffer, win_w: u32, win_h: u32, se
             } else {
                 false
             };
-
-            let effective_color = if selected { COLOR_SELECT_FG } else { color };
-
-            if (!text_buf.is_empty()) && (effective_color != run_color || selected != run_selected) {
-                // Flush current run
-                if run_selected {
-                    let rx = TEXT_PAD + (run_start as u16) * CELL_W;
-                    let rw = (text_buf.len() as u16) * CELL_W;
-                    window::fill_rect(win_id, rx as i16, py as i16, rw, CELL_H, COLOR_SELECT_BG);
-                }
-                let px = TEXT_PAD + (run_start as u16) * CELL_W;
-                window::draw_text_mono(win_id, px as i16, py as i16, run_color, &text_buf);
-                text_buf.clear();
-            }
-            if text_buf.is_empty() {
-                run_start = col;
-                run_color = effective_color;
-                run_selected = selected;
+            if selected {
+                cell |= CELL_SELECTED;
             }
-            text_buf.push(ch);
-        }
-        if !text_buf.is_empty() {
-            if run_selected {
-                let rx = TEXT_PAD + (run_start as u16) * CELL_W;
-                let rw = (text_buf.len() as u16) * CELL_W;
-                window::fill_rect(win_id, rx as i16, py as i16, rw, CELL_H, COLOR_SELECT_BG);
+            if Some(screen_row) == cursor_row && col == buf.cursor_col {
+                cell |= CELL_CURSOR;
             }
-            let px = TEXT_PAD + (run_start as u16) * CELL_W;
-            window::draw_text_mono(win_id, px as i16, py as i16, run_color, &text_buf);
+            wanted[col] = cell;
         }
 
-        // For multiline selections: highlight empty area after line end on middle lines
-        if let Some((ref s, ref e)) = sel_range {
-            if line_idx > s.row && line_idx < e.row && line.len() < buf.cols {
-                let rx = TEXT_PAD + (line.len() as u16) * CELL_W;
-                let rw = ((buf.cols - line.len()) as u16) * CELL_W;
-                window::fill_rect(win_id, rx as i16, py as i16, rw, CELL_H, COLOR_SELECT_BG);
+        // Draw only the runs that differ from what is on screen
+        let shown = &mut screen.cells[screen_row * cols..(screen_row + 1) * cols];
+        let mut col = 0;
+        while col < cols {
+            if wanted[col] == shown[col] {
+                col += 1;
+                continue;
             }
+            let start = col;
+            let style = wanted[col] & CELL_STYLE_MASK;
+            while col < cols && wanted[col] != shown[col] && wanted[col] & CELL_STYLE_MASK == style {
+                col += 1;
+            }
+            draw_cell_run(win_id, buf, screen_row, start, &wanted[start..col], &mut text);
+            shown[start..col].copy_from_slice(&wanted[start..col]);
         }
+        screen.row_valid[screen_row] = true;
     }
 
-    // Draw cursor (inverted block)
-    let cursor_screen_row = buf.cursor_row as i32 - buf.scroll_offset as i32;
-    if cursor_screen_row >= 0 && (cursor_screen_row as usize) < buf.visible_rows {
-        let cx = TEXT_PAD + (buf.cursor_col as u16) * CELL_W;
-        let cy = TEXT_PAD + (cursor_screen_row as u16) * CELL_H;
-        // Draw a white cursor block
-        window::fill_rect(win_id, cx as i16, cy as i16, CELL_W, CELL_H, 0xFFCCCCCC);
-    }
+    screen.wanted = wanted;
+    screen.text = text;
+    screen.cursor_row = cursor_row;
+    screen.selection = sel_key;
+    buf.clear_damage();
 
     window::present(win_id);
 }
 
+// ─── Child Output ────────────────────────────────────────────────────────────
+
+// Bytes read from the child's pipe per syscall
+const OUTPUT_CHUNK: usize = 64 * 1024;
+// Redraw at most at this interval (~60 Hz) while output is streaming
+const FRAME_MS: u32 = 16;
+// Pipe poll interval when nothing is happening
+const IDLE_POLL_MS: u32 = 8;
+
+/// Read and parse pending child output in large chunks. Stops when the pipe
+/// is drained or after `budget_ms`, so a flooding producer cannot starve
+/// input handling or redraws. Returns true if anything was read.
+fn pump_output(fp: &mut ForegroundProcess, buf: &mut TerminalBuffer,
+               chunk: &mut [u8], budget_ms: u32) -> bool {
+    let start = anyos_std::sys::uptime_ms();
+    let mut got = false;
+    loop {
+        let n = ipc::pipe_read(fp.pipe_id, chunk);
+        if n == 0 || n == u32::MAX {
+            break;
+        }
+        got = true;
+        let data = &chunk[..n as usize];
+        if let Some(ref mut redir) = fp.redirect {
+            write_redirect(redir, data);
+        } else {
+            buf.write_bytes(data);
+        }
+        if (n as usize) < chunk.len()
+            || anyos_std::sys::uptime_ms().wrapping_sub(start) >= budget_ms
+        {
+            break;
+        }
+    }
+    got
+}
+
 // ─── Main ────────────────────────────────────────────────────────────────────
 
 fn main() {
@@ -2153,6 +2844,7 @@ fn main() {
     let rows = (win_h.saturating_sub(TEXT_PAD as u32 * 2) / CELL_H as u32) as usize;
 
     let mut buf = TerminalBuffer::new(cols, rows);
+    let mut screen = ScreenCache::new();
     let mut shell = Shell::new();
     let mut selection: Option<Selection> = None;
 
@@ -2180,9 +2872,12 @@ fn main() {
     buf.current_color = COLOR_FG;
 
     // Initial render
-    render_terminal(win_id, &buf, win_w, win_h, selection.as_ref());
+    render_terminal(win_id, &mut buf, &mut screen, win_w, win_h, selection.as_ref());
 
     let mut dirty = false;
+    let mut urgent = false; // keyboard echo: render without waiting for the frame clock
+    let mut last_frame = anyos_std::sys::uptime_ms();
+    let mut read_buf: Vec<u8> = alloc::vec![0u8; OUTPUT_CHUNK];
     let mut event = [0u32; 5];
     let mut fg_proc: Option<ForegroundProcess> = None;
 
@@ -2191,43 +2886,20 @@ fn main() {
     let mut su_password = String::new();
 
     loop {
+        let mut busy = false;
+
         // Poll foreground process pipe for real-time output
         if let Some(ref mut fp) = fg_proc {
-            let mut read_buf = [0u8; 512];
-            loop {
-                let n = ipc::pipe_read(fp.pipe_id, &mut read_buf);
-                if n == 0 || n == u32::MAX {
-                    break;
-                }
-                if let Ok(s) = core::str::from_utf8(&read_buf[..n as usize]) {
-                    if let Some(ref mut redir) = fp.redirect {
-                        write_redirect(redir, s);
-                    } else {
-                        buf.current_color = COLOR_FG;
-                        buf.write_str(s);
-                    }
-                }
+            if pump_output(fp, &mut buf, &mut read_buf, FRAME_MS) {
                 dirty = true;
+                busy = true;
             }
 
             // Check if process exited (non-blocking)
             let status = process::try_waitpid(fp.tid);
             if status != process::STILL_RUNNING {
                 // Drain remaining pipe data
-                loop {
-                    let n = ipc::pipe_read(fp.pipe_id, &mut read_buf);
-                    if n == 0 || n == u32::MAX {
-                        break;
-                    }
-                    if let Ok(s) = core::str::from_utf8(&read_buf[..n as usize]) {
-                        if let Some(ref mut redir) = fp.redirect {
-                            write_redirect(redir, s);
-                        } else {
-                            buf.current_color = COLOR_FG;
-                            buf.write_str(s);
-                        }
-                    }
-                }
+                while pump_output(fp, &mut buf, &mut read_buf, u32::MAX) {}
                 // Copy out pipe IDs before dropping fg_proc
                 let pipe_id = fp.pipe_id;
                 let stdin_pipe_id = fp.stdin_pipe;
@@ -2261,6 +2933,7 @@ fn main() {
         // Poll events
         let got = window::get_event(win_id, &mut event);
         if got == 1 {
+            busy = true;
             if event[0] == EVENT_WINDOW_CLOSE {
                 window::destroy(win_id);
                 return;
@@ -2294,8 +2967,7 @@ fn main() {
                 win_h = event[2];
                 let new_cols = (win_w.saturating_sub(TEXT_PAD as u32 * 2) / CELL_W as u32) as usize;
                 let new_rows = (win_h.saturating_sub(TEXT_PAD as u32 * 2) / CELL_H as u32) as usize;
-                buf.cols = new_cols;
-                buf.visible_rows = new_rows;
+                buf.resize(new_cols, new_rows);
                 // Update terminal size env vars for child processes
                 anyos_std::env::set("COLUMNS", &format!("{}", new_cols));
                 anyos_std::env::set("LINES", &format!("{}", new_rows));
@@ -2356,6 +3028,7 @@ fn main() {
                     dirty = true;
                 }
             } else if event[0] == EVENT_KEY_DOWN {
+                urgent = true;
                 // Clear selection on any keyboard input
                 if selection.is_some() {
                     selection = None;
@@ -2507,11 +3180,7 @@ fn main() {
                         KEY_DELETE => {
                             if shell.cursor < shell.input.len() {
                                 shell.delete_at_cursor();
-                                let row = buf.cursor_row;
-                                let col = buf.cursor_col;
-                                if row < buf.lines.len() && col < buf.lines[row].len() {
-                                    buf.lines[row].remove(col);
-                                }
+                                buf.delete_char();
                                 dirty = true;
                             }
                         }
@@ -2528,12 +3197,7 @@ fn main() {
                                     if at_end {
                                         buf.write_char(c);
                                     } else {
-                                        buf.ensure_line(buf.cursor_row);
-                                        let row = buf.cursor_row;
-                                        let col = buf.cursor_col;
-                                        let color = buf.current_color;
-                                        buf.lines[row].insert(col, (c, color));
-                                        buf.cursor_col += 1;
+                                        buf.insert_char(c);
                                     }
                                     dirty = true;
                                 }
@@ -2584,13 +3248,21 @@ fn main() {
                     }
                 }
             }
-        } else {
-            // No event — render if dirty, then yield
-            if dirty {
-                render_terminal(win_id, &buf, win_w, win_h, selection.as_ref());
-                dirty = false;
-            }
-            process::sleep(8); // ~125 Hz poll for pipe output
+        }
+
+        // Redraw at most once per frame; keystrokes are echoed immediately
+        let now = anyos_std::sys::uptime_ms();
+        let since = now.wrapping_sub(last_frame);
+        if dirty && (urgent || since >= FRAME_MS) {
+            render_terminal(win_id, &mut buf, &mut screen, win_w, win_h, selection.as_ref());
+            dirty = false;
+            urgent = false;
+            last_frame = now;
+        }
+        if !busy {
+            // Idle: sleep until the next frame is due (or the next output poll)
+            let wait = if dirty { FRAME_MS.saturating_sub(since) } else { IDLE_POLL_MS };
+            process::sleep(wait.clamp(1, IDLE_POLL_MS));
         }
     }
 
@@ -80,8 +80,12 @@ struct pack_chain_elem {
 
 typedef git_array_t(struct pack_chain_elem) git_dependency_chain;
 
+#ifndef GIT_PACK_CACHE_MEMORY_LIMIT
 #define GIT_PACK_CACHE_MEMORY_LIMIT 16 * 1024 * 1024
+#endif
+#ifndef GIT_PACK_CACHE_SIZE_LIMIT
 #define GIT_PACK_CACHE_SIZE_LIMIT 1024 * 1024 /* don't bother caching anything over 1MB */
+#endif
 
 typedef struct {
 	size_t memory_used;
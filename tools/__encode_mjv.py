@@ -8,7 +8,10 @@ encode_mjv.py - Convert video files to MJV (Motion JPEG Video) format.
 Uses ffmpeg to extract JPEG frames and packs them into the MJV container.
 
 Usage:
-    python3 tools/encode_mjv.py input.mp4 output.mjv [--fps 15] [--width 320] [--height 240] [--quality 80]
+    python3 tools/encode_mjv.py input.mp4 output.mjv [--fps 15] [--width 320] [--height 240] [--quality 80] [--audio]
+
+With --audio the soundtrack is appended as 16-bit stereo PCM at 48 kHz and
+located by the two header words after the frame count.
 """
 
 import argparse
@@ -32,6 +35,7 @@ def main():
     parser.add_argument("--width", type=int, default=320, help="Output width (default: 320)")
     parser.add_argument("--height", type=int, default=240, help="Output height (default: 240)")
     parser.add_argument("--quality", type=int, default=80, help="JPEG quality 1-100 (default: 80)")
+    parser.add_argument("--audio", action="store_true", help="Include the soundtrack as 48 kHz stereo PCM")
     args = parser.parse_args()
 
     if not os.path.exists(args.input):
@@ -77,17 +81,38 @@ def main():
             with open(f, "rb") as fh:
                 frame_data.append(fh.read())
 
+        # Extract the soundtrack as raw PCM in the format audio_write() takes
+        audio = b""
+        if args.audio:
+            pcm_path = os.path.join(tmpdir, "audio.pcm")
+            cmd = [
+                "ffmpeg", "-i", args.input,
+                "-vn", "-f", "s16le", "-acodec", "pcm_s16le",
+                "-ac", "2", "-ar", "48000",
+                "-y", pcm_path,
+            ]
+            result = subprocess.run(cmd, capture_output=True)
+            if result.returncode != 0 or not os.path.exists(pcm_path):
+                print("Warning: no audio track extracted, writing a silent video", file=sys.stderr)
+            else:
+                with open(pcm_path, "rb") as fh:
+                    audio = fh.read()
+                audio = audio[:len(audio) & ~3]
+                print(f"Extracted {len(audio) // 4 / 48000:.1f}s of audio")
+
         # Build MJV file
         table_size = num_frames * MJV_FRAME_ENTRY_SIZE
         data_offset = MJV_HEADER_SIZE + table_size
+        audio_offset = data_offset + sum(len(fd) for fd in frame_data) if audio else 0
 
-        # Header: magic(4) + version(4) + width(4) + height(4) + fps(4) + num_frames(4) + reserved(8)
+        # Header: magic(4) + version(4) + width(4) + height(4) + fps(4) + num_frames(4)
+        #         + audio_offset(4) + audio_size(4)
         header = struct.pack(
             "<4sIIIIIII",
             MJV_MAGIC, MJV_VERSION,
             args.width, args.height,
             args.fps, num_frames,
-            0, 0,  # reserved
+            audio_offset, len(audio),
         )
 
         # Build frame table
@@ -103,8 +128,9 @@ def main():
             out.write(table)
             for fd in frame_data:
                 out.write(fd)
+            out.write(audio)
 
-        total_size = current_offset
+        total_size = current_offset + len(audio)
         duration = num_frames / args.fps
         print(f"Written {args.output}: {total_size:,} bytes ({total_size / 1024:.1f} KiB), {duration:.1f}s")
 